@@ -9,6 +9,7 @@
 
 #include "sphere.h"
 #include "convexPolytope.h"
+#include "sweepAndPrune.h"
 
 
 namespace Collision
@@ -433,6 +434,144 @@ static void PolytopeContainer_UnitTest()
 
 
 
+static void ConvexPolytopeDistanceField_UnitTest()
+{
+    ConvexPolytope analytic( sTestCubeHullFaces , sTestCubeNumFaces ) ;
+    ConvexPolytope sampled( sTestCubeHullFaces , sTestCubeNumFaces ) ;
+    ASSERT( ! analytic.HasDistanceField() ) ;   // Few faces, so analytic by default.
+    sampled.EnableDistanceField( 16 ) ;
+    ASSERT( sampled.HasDistanceField() ) ;
+
+    const Vec3 queryPoints[] =
+    {   // Points far enough from edges that a single face dominates their cell.
+            Vec3(  0.5f ,  0.0f ,  0.0f )
+        ,   Vec3( -0.5f ,  0.1f ,  0.0f )
+        ,   Vec3(  0.0f ,  0.6f , -0.2f )
+        ,   Vec3(  0.0f ,  0.0f ,  1.1f )
+        ,   Vec3(  0.2f , -0.3f , -0.7f )
+        ,   Vec3(  3.0f ,  0.0f ,  0.0f )  // Outside field, so falls back to analytic.
+    } ;
+    const unsigned numQueryPoints = sizeof( queryPoints ) / sizeof( queryPoints[ 0 ] ) ;
+
+    for( unsigned iQuery = 0 ; iQuery < numQueryPoints ; ++ iQuery )
+    {
+        unsigned idxPlaneAnalytic   = ~0U ;
+        unsigned idxPlaneSampled    = ~0U ;
+        const float distAnalytic    = analytic.ContactDistance( queryPoints[ iQuery ] , idxPlaneAnalytic ) ;
+        const float distSampled     = sampled.ContactDistance( queryPoints[ iQuery ] , idxPlaneSampled ) ;
+        ASSERT( Math::Resembles( distAnalytic , distSampled , 1.0e-3f ) ) ;
+        ASSERT( idxPlaneAnalytic == idxPlaneSampled ) ;
+    }
+
+    {   // Distance field of a hole has flipped sign, like the analytic query.
+        ConvexPolytope hole( sTestCubeHullFaces , sTestCubeNumFaces , true /* isHole */ ) ;
+        hole.EnableDistanceField( 16 ) ;
+        unsigned idxPlane = ~0U ;
+        ASSERT( Math::Resembles( hole.ContactDistance( Vec3( 0.5f , 0.0f , 0.0f ) , idxPlane ) , 0.5f , 1.0e-3f ) ) ;
+        ASSERT( 0 == idxPlane ) ;
+    }
+
+    sampled.DisableDistanceField() ;
+    ASSERT( ! sampled.HasDistanceField() ) ;
+}
+
+
+
+
+static void CollideMany_UnitTest()
+{
+    // Particle-like structure, so queries use a stride other than sizeof( Vec3 ).
+    struct TestParticle
+    {
+        Vec3    mPosition   ;
+        Vec3    mVelocity   ;
+        float   mPadding    ;
+    } ;
+
+    static const unsigned numParticles = 11 ; // Not a multiple of SIMD width, to exercise partial groups.
+    TestParticle particles[ numParticles ] ;
+    for( unsigned iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+    {   // For each particle, assign a position straddling the cube surface, and a velocity.
+        const float t = float( iPcl ) ;
+        particles[ iPcl ].mPosition = Vec3( 1.8f * sinf( 1.3f * t ) , 1.6f * cosf( 0.7f * t ) , 1.4f * sinf( 2.1f * t + 0.5f ) ) ;
+        particles[ iPcl ].mVelocity = Vec3( cosf( 0.9f * t ) , - sinf( 1.7f * t ) , cosf( 2.3f * t ) ) ;
+        particles[ iPcl ].mPadding  = 0.0f ;
+    }
+
+    const Vec3  position( 0.1f , -0.2f , 0.3f ) ;
+    const Vec3  polytopeVelocity( 0.2f , 0.0f , -0.1f ) ;
+    Mat33       orientation ;
+    orientation.SetRotationXYZ( Vec3( 0.3f , -0.5f , 0.7f ) ) ;
+
+    for( int iHole = 0 ; iHole < 2 ; ++ iHole )
+    {   // For solid and hole...
+        ConvexPolytope polytope( sTestCubeHullFaces , sTestCubeNumFaces , iHole != 0 ) ;
+
+        for( unsigned numQueries = 1 ; numQueries <= numParticles ; numQueries += 5 )
+        {   // For various numbers of query points...
+            ConvexPolytope::ContactS contacts[ numParticles ] ;
+            ConvexPolytope::ContactS collisions[ numParticles ] ;
+            polytope.ContactDistanceMany( & particles[ 0 ].mPosition , sizeof( TestParticle ) , numQueries , position , orientation , contacts ) ;
+            polytope.CollisionDistanceMany( & particles[ 0 ].mPosition , & particles[ 0 ].mVelocity , sizeof( TestParticle ) , numQueries , position , orientation , polytopeVelocity , collisions ) ;
+            for( unsigned iPcl = 0 ; iPcl < numQueries ; ++ iPcl )
+            {   // For each query point, compare batch against single-point query.
+                unsigned idxPlane = ~0U ;
+                const float contactDistance = polytope.ContactDistance( particles[ iPcl ].mPosition , position , orientation , idxPlane ) ;
+                ASSERT( Math::Resembles( contacts[ iPcl ].mDistance , contactDistance ) ) ;
+                ASSERT( contacts[ iPcl ].mIdxPlane == idxPlane ) ;
+
+                idxPlane = ~0U ;
+                const float collisionDistance = polytope.CollisionDistance( particles[ iPcl ].mPosition , particles[ iPcl ].mVelocity , position , orientation , polytopeVelocity , idxPlane ) ;
+                ASSERT( Math::Resembles( collisions[ iPcl ].mDistance , collisionDistance ) ) ;
+                ASSERT( ( collisions[ iPcl ].mIdxPlane == idxPlane ) || ( ~0U == idxPlane ) ) ;  // Single-point query leaves index alone when it rejects every plane.
+            }
+        }
+    }
+
+    {   // Sphere.
+        const Sphere sphere( Vec3( 0.5f , -0.25f , 0.125f ) , 1.0f ) ;
+        float distances[ numParticles ] ;
+        sphere.DistanceMany( & particles[ 0 ].mPosition , sizeof( TestParticle ) , numParticles , distances ) ;
+        for( unsigned iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+        {   // For each query point, compare batch against exact distance, since Sphere::Distance approximates its square root.
+            const float exactDistance = ( sphere.GetPosition() - particles[ iPcl ].mPosition ).Magnitude() - sphere.GetRadius() ;
+            ASSERT( Math::Resembles( distances[ iPcl ] , exactDistance ) ) ;
+        }
+    }
+}
+
+
+
+
+static void SweepAndPrune_UnitTest()
+{
+    VECTOR< Sphere > bounds ;
+    bounds.PushBack( Sphere( Vec3(  0.0f , 0.0f , 0.0f ) , 1.0f ) ) ;
+    bounds.PushBack( Sphere( Vec3(  1.5f , 0.0f , 0.0f ) , 1.0f ) ) ;   // Overlaps 0.
+    bounds.PushBack( Sphere( Vec3(  1.5f , 5.0f , 0.0f ) , 1.0f ) ) ;   // Overlaps others along x only.
+    bounds.PushBack( Sphere( Vec3( 10.0f , 0.0f , 0.0f ) , 1.0f ) ) ;   // Overlaps nothing.
+
+    SweepAndPrune sweepAndPrune ;
+    sweepAndPrune.Update( bounds ) ;
+    ASSERT( 1 == sweepAndPrune.GetPairs().Size() ) ;
+    ASSERT( SweepAndPrune::Pair( 0 , 1 ) == sweepAndPrune.GetPairs()[ 0 ] ) ;
+
+    // Move sphere 3 past the others, so sorted order from previous update no longer holds.
+    bounds[ 3 ].SetPosition( Vec3( -1.0f , 0.0f , 0.0f ) ) ;
+    sweepAndPrune.Update( bounds ) ;
+    ASSERT( 2 == sweepAndPrune.GetPairs().Size() ) ;
+    ASSERT( SweepAndPrune::Pair( 0 , 1 ) == sweepAndPrune.GetPairs()[ 0 ] ) ;
+    ASSERT( SweepAndPrune::Pair( 0 , 3 ) == sweepAndPrune.GetPairs()[ 1 ] ) ;
+
+    // Changing the number of bounds starts over.
+    bounds.PopBack() ;
+    sweepAndPrune.Update( bounds ) ;
+    ASSERT( 1 == sweepAndPrune.GetPairs().Size() ) ;
+}
+
+
+
+
 void UnitTests()
 {
     DebugPrintf( "Shape::UnitTest ----------------------------------------------\n" ) ;
@@ -440,6 +579,9 @@ void UnitTests()
     Sphere_UnitTest() ;
     ConvexHull_UnitTest() ;
     PolytopeContainer_UnitTest() ;
+    ConvexPolytopeDistanceField_UnitTest() ;
+    CollideMany_UnitTest() ;
+    SweepAndPrune_UnitTest() ;
 
     DebugPrintf( "Shape::UnitTest: THE END ----------------------------------------------\n" ) ;
 }
@@ -14,6 +14,8 @@
 
 #include "convexPolytope.h"
 
+#include "Core/Math/vec3x4.h"
+
 namespace Collision
 {
 
@@ -21,6 +23,22 @@ namespace Collision
 // Private variables -----------------------------------------------------------
 // Public variables ------------------------------------------------------------
 // Private functions -----------------------------------------------------------
+
+/** Store per-lane plane indices and distances, of the given number of valid lanes, into the given contacts.
+*/
+static void StoreContacts( const Float4 & distances , const Float4 & idxPlanes , unsigned numValid , ConvexPolytope::ContactS contacts[] )
+{
+    float distanceLanes[ Float4::WIDTH ] ;
+    float idxPlaneLanes[ Float4::WIDTH ] ;
+    distances.Store( distanceLanes ) ;
+    idxPlanes.Store( idxPlaneLanes ) ;
+    for( unsigned iLane = 0 ; iLane < numValid ; ++ iLane )
+    {   // For each valid lane...
+        contacts[ iLane ].mDistance = distanceLanes[ iLane ] ;
+        contacts[ iLane ].mIdxPlane = static_cast< unsigned >( idxPlaneLanes[ iLane ] ) ;
+    }
+}
+
 // Public functions ------------------------------------------------------------
 
 /** Set polytope faces given an array of planes.
@@ -37,6 +55,62 @@ void ConvexPolytope::SetFaces( const Math::Plane faces[] , const unsigned numFac
         ASSERT( dSign == ( faces[ idxFace ].GetD() >= 0.0f ) ) ; // All planes must have same sense (interior or exterior).
         mPlanes.PushBack( faces[ idxFace ] ) ;
     }
+
+    if( ( 0 == mDistanceFieldNumCellsPerAxis ) && ( numFaces >= CONVEX_POLYTOPE_DISTANCE_FIELD_MIN_FACES ) )
+    {   // Polytope has enough faces that sampling a distance field costs less than testing each face.
+        mDistanceFieldNumCellsPerAxis = CONVEX_POLYTOPE_DISTANCE_FIELD_NUM_CELLS_PER_AXIS ;
+    }
+    // Faces changed, so any distance field is stale.
+    BakeDistanceField() ;
+}
+
+
+
+
+/** Precompute ContactDistance on a grid, so subsequent queries cost one lookup instead of one test per face.
+
+    \param numCellsPerAxis  Approximate number of grid cells along each axis.
+
+    The field lives in polytope-local space, so it remains valid as the body
+    moves and rotates.  SetFaces bakes it again whenever the faces change.
+
+    Within one cell of an edge or vertex, sampled distances and faces
+    approximate those of the analytic query.  Outside the field, which extends
+    a little beyond the polytope, queries fall back to testing each face.
+*/
+void ConvexPolytope::EnableDistanceField( unsigned numCellsPerAxis )
+{
+    ASSERT( numCellsPerAxis > 0 ) ;
+    mDistanceFieldNumCellsPerAxis = numCellsPerAxis ;
+    BakeDistanceField() ;
+}
+
+
+
+
+/** Discard distance field, so queries test each face.
+*/
+void ConvexPolytope::DisableDistanceField()
+{
+    mDistanceFieldNumCellsPerAxis = 0 ;
+    mDistanceField.Clear() ;
+}
+
+
+
+
+/** Bake distance field from current faces, if enabled.
+*/
+void ConvexPolytope::BakeDistanceField()
+{
+    if( ( mDistanceFieldNumCellsPerAxis > 0 ) && ! mPlanes.Empty() )
+    {
+        mDistanceField.BakeConvexPolytope( mPlanes , GetParity() , mDistanceFieldNumCellsPerAxis ) ;
+    }
+    else
+    {
+        mDistanceField.Clear() ;
+    }
 }
 
 
@@ -46,6 +120,7 @@ void ConvexPolytope::SetFaces( const Math::Plane faces[] , const unsigned numFac
 */
 ConvexPolytope::ConvexPolytope( const Math::Plane faces[] , const unsigned numFaces , bool isHole )
     : ShapeBase( sShapeType , isHole )
+    , mDistanceFieldNumCellsPerAxis( 0 )
 {
     SetFaces( faces , numFaces ) ;
 }
@@ -57,6 +132,7 @@ ConvexPolytope::ConvexPolytope( const Math::Plane faces[] , const unsigned numFa
 */
 ConvexPolytope::ConvexPolytope( const ConvexPolytope & that , const Mat33 & rotation )
     : ShapeBase( sShapeType , that.IsHole() )
+    , mDistanceFieldNumCellsPerAxis( that.mDistanceFieldNumCellsPerAxis )
 {
     const size_t numFaces = that.mPlanes.Size() ;
     mPlanes.Reserve( numFaces ) ;
@@ -66,6 +142,7 @@ ConvexPolytope::ConvexPolytope( const ConvexPolytope & that , const Mat33 & rota
         Math::Plane rotatedPlane( rotatedNormal , that.mPlanes[ idxFace ].GetD() ) ;
         mPlanes.PushBack( rotatedPlane ) ;
     }
+    BakeDistanceField() ;
 }
 
 
@@ -93,9 +170,19 @@ ConvexPolytope::ConvexPolytope( const ConvexPolytope & that , const Mat33 & rota
 
     \note   The notion of "inside" for a hole means that the opposite of what it
             means for non-holes.
+
+    \note   When this polytope has a distance field (see EnableDistanceField)
+            and queryPoint lies inside it, this samples the field instead of
+            testing each face.
 */
 float ConvexPolytope::ContactDistance( const Vec3 & queryPoint , unsigned & idxPlaneLeastPenetration ) const
 {
+    float sampledDistance ;
+    if( mDistanceField.Sample( queryPoint , sampledDistance , idxPlaneLeastPenetration ) )
+    {   // Query point lies within precomputed distance field, which already has parity applied.
+        return sampledDistance ;
+    }
+
     float largestDistance = - FLT_MAX ;
     const size_t numPlanes = mPlanes.Size() ;
     for( unsigned iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
@@ -196,8 +283,131 @@ float ConvexPolytope::CollisionDistance( const Vec3 & queryPoint , const Vec3 &
 }
 
 
-        
-        
+
+
+/** Compute ContactDistance for many query points at once.
+
+    \param queryPoints      First world-space query point.
+
+    \param strideInBytes    Distance, in bytes, from each query point to the next, so query points can be members of larger structures, such as particles.
+
+    \param numQueryPoints   Number of query points.
+
+    \param position         World-space position of this polytope.
+
+    \param orientation      World-space orientation of this polytope.
+
+    \param contacts         (out) Per query point, what ContactDistance would return, and the plane it would choose.
+
+    This transforms Float4::WIDTH query points at once into polytope space,
+    then tests them all against each face in turn, so each face costs one
+    broadcast and the per-point work runs in SIMD lanes.  Results (including
+    which plane wins ties) match ContactDistance, to within roundoff.
+    Polytopes with distance fields call ContactDistance per point instead.
+*/
+void ConvexPolytope::ContactDistanceMany( const Vec3 * queryPoints , size_t strideInBytes , size_t numQueryPoints , const Vec3 & position , const Mat33 & orientation , ContactS contacts[] ) const
+{
+    ASSERT( orientation.IsOrthonormal() ) ;
+
+    if( HasDistanceField() )
+    {   // Sampling the field costs less than testing faces, even in lanes.
+        for( size_t iQuery = 0 ; iQuery < numQueryPoints ; ++ iQuery )
+        {   // For each query point...
+            const Vec3 & queryPoint = * reinterpret_cast< const Vec3 * >( reinterpret_cast< const char * >( queryPoints ) + iQuery * strideInBytes ) ;
+            contacts[ iQuery ].mDistance = ContactDistance( queryPoint , position , orientation , contacts[ iQuery ].mIdxPlane ) ;
+        }
+        return ;
+    }
+
+    const Vec3x4    positionLanes   ( position ) ;
+    const Mat33x4   orientationLanes( orientation ) ;
+    const Float4    parity          ( GetParity() ) ;
+    const size_t    numPlanes       = mPlanes.Size() ;
+
+    for( size_t iQuery = 0 ; iQuery < numQueryPoints ; iQuery += Float4::WIDTH )
+    {   // For each group of query points...
+        const unsigned  numValid        = static_cast< unsigned >( Min2( numQueryPoints - iQuery , size_t( Float4::WIDTH ) ) ) ;
+        const Vec3 *    firstPoint      = reinterpret_cast< const Vec3 * >( reinterpret_cast< const char * >( queryPoints ) + iQuery * strideInBytes ) ;
+        const Vec3x4    reorientedPoint = orientationLanes.TransformByTranspose( Vec3x4::LoadTransposeStrided( firstPoint , strideInBytes , numValid ) - positionLanes ) ;
+
+        Float4 largestDistance( - FLT_MAX ) ;
+        Float4 idxPlaneLeastPenetration( 0.0f ) ;
+        for( unsigned iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
+        {   // For each planar face of this convex hull...
+            const Math::Plane & plane       = mPlanes[ iPlane ] ;
+            const Float4        distToPlane = reorientedPoint * Vec3x4( plane.GetNormal() ) - Float4( plane.GetD() ) ;
+            const Float4        isLarger    = largestDistance.LessThan( distToPlane ) ;
+            largestDistance             = Float4::Select( isLarger , distToPlane , largestDistance ) ;
+            idxPlaneLeastPenetration    = Float4::Select( isLarger , Float4( float( iPlane ) ) , idxPlaneLeastPenetration ) ;
+        }
+
+        StoreContacts( largestDistance * parity , idxPlaneLeastPenetration , numValid , contacts + iQuery ) ;
+    }
+}
+
+
+
+
+/** Compute CollisionDistance for many moving query points at once.
+
+    \param queryPoints          See ContactDistanceMany.
+
+    \param queryPointVelocities First world-space query point velocity.  Velocities must have the same stride as query points.
+
+    \param polytopeVelocity     World-space velocity of this polytope.
+
+    Other parameters and results are as for ContactDistanceMany, with
+    results matching CollisionDistance, to within roundoff.
+*/
+void ConvexPolytope::CollisionDistanceMany( const Vec3 * queryPoints , const Vec3 * queryPointVelocities , size_t strideInBytes , size_t numQueryPoints , const Vec3 & position , const Mat33 & orientation , const Vec3 & polytopeVelocity , ContactS contacts[] ) const
+{
+    ASSERT( orientation.IsOrthonormal() ) ;
+
+    const Vec3x4    positionLanes       ( position ) ;
+    const Vec3x4    polytopeVelocityLanes( polytopeVelocity ) ;
+    const Mat33x4   orientationLanes    ( orientation ) ;
+    const Float4    parity              ( GetParity() ) ;
+    const Float4    zero                ( 0.0f ) ;
+    const Float4    rejected            ( - FLT_MAX ) ;
+    const size_t    numPlanes           = mPlanes.Size() ;
+    const bool      isHole              = IsHole() ;
+
+    for( size_t iQuery = 0 ; iQuery < numQueryPoints ; iQuery += Float4::WIDTH )
+    {   // For each group of query points...
+        const unsigned  numValid            = static_cast< unsigned >( Min2( numQueryPoints - iQuery , size_t( Float4::WIDTH ) ) ) ;
+        const size_t    offset              = iQuery * strideInBytes ;
+        const Vec3 *    firstPoint          = reinterpret_cast< const Vec3 * >( reinterpret_cast< const char * >( queryPoints          ) + offset ) ;
+        const Vec3 *    firstVelocity       = reinterpret_cast< const Vec3 * >( reinterpret_cast< const char * >( queryPointVelocities ) + offset ) ;
+        const Vec3x4    reorientedPoint     = orientationLanes.TransformByTranspose( Vec3x4::LoadTransposeStrided( firstPoint    , strideInBytes , numValid ) - positionLanes ) ;
+        const Vec3x4    reorientedVelocity  = orientationLanes.TransformByTranspose( Vec3x4::LoadTransposeStrided( firstVelocity , strideInBytes , numValid ) - polytopeVelocityLanes ) ;
+
+        Float4 largestDistance( - FLT_MAX ) ;
+        Float4 idxPlaneLeastPenetration( 0.0f ) ;
+        for( unsigned iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
+        {   // For each planar face of this convex hull...
+            const Math::Plane & plane       = mPlanes[ iPlane ] ;
+            const Vec3x4        normal      ( plane.GetNormal() ) ;
+            const Float4        distToPlane = reorientedPoint * normal - Float4( plane.GetD() ) ;
+            Float4              candidate   = distToPlane ;
+            if( ! isHole )
+            {   // Only accept planes the query point is going deeper through, unless it lies outside polytope.  See CollisionDistance.
+                const Float4 speedThroughPlane  = reorientedVelocity * normal * parity ;
+                const Float4 isLeaving          = zero.LessThan( speedThroughPlane ) ;
+                const Float4 isInside           = distToPlane.LessThan( zero ) ;
+                candidate = Float4::Select( isLeaving , Float4::Select( isInside , rejected , distToPlane ) , distToPlane ) ;
+            }
+            const Float4 isLarger       = largestDistance.LessThan( candidate ) ;
+            largestDistance             = Float4::Select( isLarger , candidate , largestDistance ) ;
+            idxPlaneLeastPenetration    = Float4::Select( isLarger , Float4( float( iPlane ) ) , idxPlaneLeastPenetration ) ;
+        }
+
+        StoreContacts( largestDistance * parity , idxPlaneLeastPenetration , numValid , contacts + iQuery ) ;
+    }
+}
+
+
+
+
 /** Return distance of the given sphere from a feature of this convex polytope.
 
     \param queryPoint   Center of sphere being asked about.
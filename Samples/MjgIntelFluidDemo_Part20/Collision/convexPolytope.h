@@ -14,11 +14,24 @@
 #include "Core/Containers/vector.h"
 
 #include "collisionShape.h"
+#include "signedDistanceField.h"
 
 namespace Collision
 {
 
 // Macros ----------------------------------------------------------------------
+
+/** Minimum number of faces for which SetFaces bakes a SignedDistanceField automatically.
+
+    Sampling the field costs one trilinear lookup, about as much as testing
+    several planes, so polytopes with few faces, such as boxes, stay analytic
+    unless a caller asks for a field explicitly, using EnableDistanceField.
+*/
+#define CONVEX_POLYTOPE_DISTANCE_FIELD_MIN_FACES            16
+
+/// Default number of cells along each axis of a ConvexPolytope distance field.
+#define CONVEX_POLYTOPE_DISTANCE_FIELD_NUM_CELLS_PER_AXIS   32
+
 // Types -----------------------------------------------------------------------
 
 class ConvexPolytope : public ShapeBase
@@ -26,10 +39,18 @@ class ConvexPolytope : public ShapeBase
     public:
         static const ShapeType sShapeType = 'stcp' ;
 
+        /// Result of a batch query, per query point.
+        struct ContactS
+        {
+            float       mDistance   ;   ///< Distance, as the corresponding single-point query returns.
+            unsigned    mIdxPlane   ;   ///< Index of plane in which the query point has the least penetration.
+        } ;
+
         /** Construct a convex polytope.
         */
         explicit ConvexPolytope( bool isHole = false )
             : ShapeBase( sShapeType , isHole )
+            , mDistanceFieldNumCellsPerAxis( 0 )
         {}
 
         ConvexPolytope( const Math::Plane faces[] , const unsigned numFaces , bool isHole = false ) ;
@@ -37,10 +58,18 @@ class ConvexPolytope : public ShapeBase
 
         void SetFaces( const Math::Plane faces[] , const unsigned numFaces ) ;
 
+        void EnableDistanceField( unsigned numCellsPerAxis = CONVEX_POLYTOPE_DISTANCE_FIELD_NUM_CELLS_PER_AXIS ) ;
+        void DisableDistanceField() ;
+
+        /// Return whether ContactDistance samples a precomputed distance field instead of testing each face.
+        bool HasDistanceField() const { return mDistanceField.IsBaked() ; }
+
         float ContactDistance( const Vec3 & queryPoint , unsigned & idxPlaneLeastPenetration ) const ;
         float ContactDistance( const Vec3 & queryPoint , const Vec3 & position , const Mat33 & orientation , unsigned & idxPlaneLeastPenetration ) const ;
         float CollisionDistance( const Vec3 & queryPoint , const Vec3 & queryPointRelativeVelocity , unsigned & idxPlaneLeastPenetration ) const ;
         float CollisionDistance( const Vec3 & queryPoint , const Vec3 & queryPointVelocity , const Vec3 & position , const Mat33 & orientation , const Vec3 & polytopeVelocity , unsigned & idxPlaneLeastPenetration ) const ;
+        void  ContactDistanceMany( const Vec3 * queryPoints , size_t strideInBytes , size_t numQueryPoints , const Vec3 & position , const Mat33 & orientation , ContactS contacts[] ) const ;
+        void  CollisionDistanceMany( const Vec3 * queryPoints , const Vec3 * queryPointVelocities , size_t strideInBytes , size_t numQueryPoints , const Vec3 & position , const Mat33 & orientation , const Vec3 & polytopeVelocity , ContactS contacts[] ) const ;
         float ContactDistanceSphere( const Vec3 & queryPoint , const float sphereRadius , unsigned & idxPlaneLeastPenetration ) const ;
         float ContactDistanceSphere( const Vec3 & queryPoint , float sphereRadius , const Vec3 & position , const Mat33 & orientation , unsigned & idxPlaneLeastPenetration ) const ;
         Vec3  ContactPoint( const Vec3 & queryPoint , const unsigned idxPlaneLeastPenetration , const float distance ) const ;
@@ -51,8 +80,18 @@ class ConvexPolytope : public ShapeBase
             return mPlanes[ idxPlane ] ;
         }
 
+        /// Return number of planar faces that constitute this polytope.
+        size_t GetNumPlanes() const
+        {
+            return mPlanes.Size() ;
+        }
+
     private:
-        VECTOR< Math::Plane >  mPlanes ;   ///< List of planar faces that constitute this polytope.
+        void BakeDistanceField() ;
+
+        VECTOR< Math::Plane >   mPlanes                         ;   ///< List of planar faces that constitute this polytope.
+        SignedDistanceField     mDistanceField                  ;   ///< Optional precomputed ContactDistance, in polytope-local space.  Empty means query planes directly.
+        unsigned                mDistanceFieldNumCellsPerAxis   ;   ///< Resolution of mDistanceField, or zero if disabled.
 } ;
 
 // Public variables ------------------------------------------------------------
@@ -0,0 +1,213 @@
+/** \file signedDistanceField.cpp
+
+    \brief Precomputed signed distance field, in shape-local space, for collision queries.
+
+    \author Copyright 2012 MJG; All rights reserved.
+*/
+
+#include "Core/Performance/perfBlock.h"
+
+#include "signedDistanceField.h"
+
+namespace Collision
+{
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/// Fraction of the largest polytope extent by which to pad the field, so it covers the region just outside the shape.
+static const float sPaddingFraction     = 0.25f ;
+
+/// Distance outside a plane within which a vertex still counts as lying on the polytope.
+static const float sVertexTolerance     = 1.0e-4f ;
+
+/// Fraction of a cell by which Sample insets the region it accepts, so interpolation never indexes past the last cell.
+static const float sInsetFraction       = 1.0e-3f ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Return whether the given point lies inside (or on) every one of the given planes.
+*/
+static bool IsInsideAllPlanes( const VECTOR< Math::Plane > & planes , const Vec3 & point )
+{
+    const size_t numPlanes = planes.Size() ;
+    for( unsigned iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
+    {   // For each plane...
+        if( planes[ iPlane ].Distance( point ) > sVertexTolerance )
+        {   // Point lies outside this plane.
+            return false ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Find the axis-aligned bounding box of the convex polytope bounded by the given planes.
+
+    \return Whether the polytope has any vertices.  Unbounded polytopes, e.g. a single half-space, have none.
+
+    This visits every triple of planes, so it costs O(planes^4), which is fine
+    for baking, but not for per-frame use.
+*/
+static bool FindPolytopeBoundingBox( const VECTOR< Math::Plane > & planes , Vec3 & minCorner , Vec3 & maxCorner )
+{
+    minCorner = Vec3(   FLT_MAX ,   FLT_MAX ,   FLT_MAX ) ;
+    maxCorner = Vec3( - FLT_MAX , - FLT_MAX , - FLT_MAX ) ;
+    bool foundVertex = false ;
+
+    const size_t numPlanes = planes.Size() ;
+    for( unsigned i0 = 0 ; i0 < numPlanes ; ++ i0 )
+    {
+        for( unsigned i1 = i0 + 1 ; i1 < numPlanes ; ++ i1 )
+        {
+            for( unsigned i2 = i1 + 1 ; i2 < numPlanes ; ++ i2 )
+            {   // For each triple of planes...
+                const Vec3 &    n0          = planes[ i0 ].GetNormal() ;
+                const Vec3 &    n1          = planes[ i1 ].GetNormal() ;
+                const Vec3 &    n2          = planes[ i2 ].GetNormal() ;
+                const Vec3      n1CrossN2   = n1 ^ n2 ;
+                const float     det         = n0 * n1CrossN2 ;
+                if( fabsf( det ) < FLT_EPSILON )
+                {   // Planes do not meet at a single point.
+                    continue ;
+                }
+                // Solve n_i . x = d_i for the point where the 3 planes meet.
+                const Vec3 vertex = ( n1CrossN2 * planes[ i0 ].GetD() + ( n2 ^ n0 ) * planes[ i1 ].GetD() + ( n0 ^ n1 ) * planes[ i2 ].GetD() ) / det ;
+                if( IsInsideAllPlanes( planes , vertex ) )
+                {   // Point is a vertex of the polytope.
+                    minCorner.x = Min2( minCorner.x , vertex.x ) ;
+                    minCorner.y = Min2( minCorner.y , vertex.y ) ;
+                    minCorner.z = Min2( minCorner.z , vertex.z ) ;
+                    maxCorner.x = Max2( maxCorner.x , vertex.x ) ;
+                    maxCorner.y = Max2( maxCorner.y , vertex.y ) ;
+                    maxCorner.z = Max2( maxCorner.z , vertex.z ) ;
+                    foundVertex = true ;
+                }
+            }
+        }
+    }
+    return foundVertex ;
+}
+
+// Public functions ------------------------------------------------------------
+
+/** Discard field, so Sample fails until the next bake.
+*/
+void SignedDistanceField::Clear()
+{
+    mDistances.Clear() ;
+    mFeatures.Clear() ;
+    mSampleMin = mSampleMax = Vec3( 0.0f , 0.0f , 0.0f ) ;
+}
+
+
+
+
+/** Sample, on a grid, the signed distance of a convex polytope given by its planar faces.
+
+    \param planes   Faces of convex polytope, in shape-local space.
+
+    \param parity   +1 for a solid, -1 for a hole.  See ShapeBase.
+
+    \param numCellsPerAxis  Approximate number of grid cells along each axis.
+
+    Each gridpoint records the same value ConvexPolytope::ContactDistance
+    would compute there, i.e. the largest distance to any plane, and the index
+    of that plane.  That distance is linear inside the region where a single
+    plane dominates, so trilinear interpolation reproduces it exactly
+    everywhere except within one cell of an edge or vertex.
+*/
+void SignedDistanceField::BakeConvexPolytope( const VECTOR< Math::Plane > & planes , float parity , unsigned numCellsPerAxis )
+{
+    PERF_BLOCK( SignedDistanceField__BakeConvexPolytope ) ;
+
+    Clear() ;
+
+    Vec3 minCorner ;
+    Vec3 maxCorner ;
+    if( ( numCellsPerAxis < 1 ) || ! FindPolytopeBoundingBox( planes , minCorner , maxCorner ) )
+    {   // Polytope is unbounded, or caller wants no field.  Leave field empty, so queries fall back to analytic.
+        return ;
+    }
+
+    // Pad box so the field also covers the region just outside the polytope.
+    const Vec3  extent  = maxCorner - minCorner ;
+    const float padding = sPaddingFraction * MAX3( extent.x , extent.y , extent.z ) ;
+    const Vec3  padding3( padding , padding , padding ) ;
+    minCorner -= padding3 ;
+    maxCorner += padding3 ;
+
+    mDistances.DefineShape( numCellsPerAxis * numCellsPerAxis * numCellsPerAxis , minCorner , maxCorner , false ) ;
+    mDistances.Init( 0.0f ) ;
+    mFeatures.Resize( mDistances.GetGridCapacity() ) ;
+
+    const size_t numPlanes = planes.Size() ;
+    unsigned idx[3] ;
+    for( idx[2] = 0 ; idx[2] < mDistances.GetNumPoints( 2 ) ; ++ idx[2] )
+    {
+        for( idx[1] = 0 ; idx[1] < mDistances.GetNumPoints( 1 ) ; ++ idx[1] )
+        {
+            for( idx[0] = 0 ; idx[0] < mDistances.GetNumPoints( 0 ) ; ++ idx[0] )
+            {   // For each gridpoint...
+                const Vec3      gridPointPosition   = mDistances.PositionFromIndices( idx ) ;
+                const size_t    offset              = mDistances.OffsetFromIndices( idx[0] , idx[1] , idx[2] ) ;
+                float           largestDistance     = - FLT_MAX ;
+                unsigned        idxPlaneLeast       = 0 ;
+                for( unsigned iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
+                {   // For each planar face of the polytope...
+                    const float distToPlane = planes[ iPlane ].Distance( gridPointPosition ) ;
+                    if( distToPlane > largestDistance )
+                    {   // Gridpoint distance to iPlane is largest of all planes visited so far.
+                        largestDistance = distToPlane ;
+                        idxPlaneLeast   = iPlane ;
+                    }
+                }
+                mDistances[ offset ] = largestDistance * parity ;
+                mFeatures[ offset ]  = idxPlaneLeast ;
+            }
+        }
+    }
+
+    const Vec3 inset = mDistances.GetCellSpacing() * sInsetFraction ;
+    mSampleMin = mDistances.GetMinCorner() ;
+    mSampleMax = mDistances.GetMaxCorner() - inset ;
+}
+
+
+
+
+/** Look up signed distance and nearest feature at the given point.
+
+    \param localPoint   Query point, in shape-local space.
+
+    \param distance     (out) Signed distance, interpolated trilinearly.
+
+    \param idxFeature   (out) Index of feature nearest the gridpoint nearest localPoint.
+
+    \return Whether localPoint lies inside the field.  When false, outputs are unchanged,
+        and the caller should query the shape analytically instead.
+*/
+bool SignedDistanceField::Sample( const Vec3 & localPoint , float & distance , unsigned & idxFeature ) const
+{
+    // Note the form of these tests, which also rejects NaN.
+    if( ! (     IsBaked()
+            &&  ( localPoint.x >= mSampleMin.x ) && ( localPoint.x <= mSampleMax.x )
+            &&  ( localPoint.y >= mSampleMin.y ) && ( localPoint.y <= mSampleMax.y )
+            &&  ( localPoint.z >= mSampleMin.z ) && ( localPoint.z <= mSampleMax.z ) ) )
+    {   // Point lies outside field.
+        return false ;
+    }
+
+    mDistances.Interpolate( distance , localPoint ) ;
+
+    // Use feature recorded at nearest gridpoint, i.e. at the cell corner nearest the point.
+    const Vec3 nearestGridPointProbe = localPoint + mDistances.GetCellSpacing() * 0.5f ;
+    idxFeature = mFeatures[ mDistances.OffsetOfPosition( nearestGridPointProbe ) ] ;
+    return true ;
+}
+
+
+} ;
@@ -0,0 +1,65 @@
+/** \file signedDistanceField.h
+
+    \brief Precomputed signed distance field, in shape-local space, for collision queries.
+
+    \author Copyright 2012 MJG; All rights reserved.
+*/
+#ifndef SHAPE_SIGNED_DISTANCE_FIELD_H
+#define SHAPE_SIGNED_DISTANCE_FIELD_H
+
+#include "Core/Math/vec3.h"
+#include "Core/Math/plane.h"
+
+#include "Core/Containers/vector.h"
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+namespace Collision
+{
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+/** Precomputed signed distance field, in shape-local space, for collision queries.
+
+    Sampling a shape analytically can cost a lot, e.g. one plane test per face
+    of a convex polytope, for every query point.  This instead samples the
+    shape once, on a uniform grid in shape-local space, so each query costs one
+    trilinear lookup regardless of shape complexity.  Since the field lives in
+    shape-local space, it remains valid as the body moves; it only needs to
+    be baked again when the shape itself changes.
+
+    Alongside each distance, the field records which shape feature (e.g. which
+    face) lies closest to each gridpoint, so callers can compute contact points
+    and normals the same way they would have from an analytic query.
+
+    The field covers a box around the shape.  Queries outside that box report
+    failure, and callers should fall back to the analytic query.
+*/
+class SignedDistanceField
+{
+    public:
+        SignedDistanceField() {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        void Clear() ;
+        void BakeConvexPolytope( const VECTOR< Math::Plane > & planes , float parity , unsigned numCellsPerAxis ) ;
+        bool Sample( const Vec3 & localPoint , float & distance , unsigned & idxFeature ) const ;
+
+        /// Return whether this field has been baked and is ready to sample.
+        bool IsBaked() const { return ! mDistances.Empty() ; }
+
+    private:
+        UniformGrid< float >    mDistances      ;   ///< Signed distance (negative inside solids) at each gridpoint, in shape-local space.
+        VECTOR< unsigned >      mFeatures       ;   ///< Index of shape feature nearest each gridpoint, e.g. index of plane of least penetration.
+        Vec3                    mSampleMin      ;   ///< Minimal corner of region Sample accepts, slightly inside grid.
+        Vec3                    mSampleMax      ;   ///< Maximal corner of region Sample accepts, slightly inside grid.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+} ;
+
+#endif
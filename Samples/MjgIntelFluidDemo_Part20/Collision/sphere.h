@@ -64,6 +64,7 @@ class Sphere
 
         float Distance( const Vec3 & point ) const ;
         float Distance( const Sphere & otherSphere ) const ;
+        void  DistanceMany( const Vec3 * points , size_t strideInBytes , size_t numPoints , float distances[] ) const ;
 
     private:
         Vec4    mPositionRadius ;   ///< Position (x,y,w) and radius (w) of this sphere.
@@ -0,0 +1,137 @@
+/** \file sweepAndPrune.cpp
+
+    \brief Broad phase collision detection that sorts bounding volumes along an axis.
+
+    \author Copyright 2012 MJG; All rights reserved.
+*/
+
+#include "Core/Performance/perfBlock.h"
+
+#include "sweepAndPrune.h"
+
+#include <algorithm>
+
+namespace Collision
+{
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Return whether the given spheres overlap.
+*/
+static bool SpheresOverlap( const Sphere & sphereA , const Sphere & sphereB )
+{
+    const float sumOfRadii = sphereA.GetRadius() + sphereB.GetRadius() ;
+    return ( sphereA.GetPosition() - sphereB.GetPosition() ).Mag2() <= Pow2( sumOfRadii ) ;
+}
+
+// Public functions ------------------------------------------------------------
+
+/** Discard sorted order and pairs, e.g. because the set of shapes changed.
+*/
+void SweepAndPrune::Clear()
+{
+    mEndpoints.Clear() ;
+    mActive.Clear() ;
+    mPairs.Clear() ;
+}
+
+
+
+
+/** Find pairs of overlapping bounding spheres.
+
+    \param bounds   Bounding spheres to test.  Between calls, each index must
+                    refer to the same shape, otherwise the order from the
+                    previous call is no help; in that case call Clear first.
+
+    \see GetPairs.
+*/
+void SweepAndPrune::Update( const VECTOR< Sphere > & bounds )
+{
+    PERF_BLOCK( SweepAndPrune__Update ) ;
+
+    const size_t numBounds = bounds.Size() ;
+    if( mEndpoints.Size() != 2 * numBounds )
+    {   // Number of shapes changed.  Start over.
+        mEndpoints.Clear() ;
+        mEndpoints.Reserve( 2 * numBounds ) ;
+        for( unsigned idxBounds = 0 ; idxBounds < numBounds ; ++ idxBounds )
+        {   // For each bounding sphere...
+            Endpoint endpoint ;
+            endpoint.mValue     = 0.0f ;
+            endpoint.mIdxBounds = idxBounds ;
+            endpoint.mIsLower   = true ;
+            mEndpoints.PushBack( endpoint ) ;
+            endpoint.mIsLower   = false ;
+            mEndpoints.PushBack( endpoint ) ;
+        }
+    }
+
+    const size_t numEndpoints = mEndpoints.Size() ;
+
+    // Refresh endpoint values from current bounds.
+    for( unsigned idxEnd = 0 ; idxEnd < numEndpoints ; ++ idxEnd )
+    {   // For each endpoint...
+        Endpoint &      rEndpoint   = mEndpoints[ idxEnd ] ;
+        const Sphere &  sphere      = bounds[ rEndpoint.mIdxBounds ] ;
+        rEndpoint.mValue = rEndpoint.mIsLower ? ( sphere.GetPosition().x - sphere.GetRadius() )
+                                              : ( sphere.GetPosition().x + sphere.GetRadius() ) ;
+    }
+
+    // Restore sorted order.  Insertion sort costs O(N) when the previous order nearly holds, as it usually does.
+    for( unsigned idxEnd = 1 ; idxEnd < numEndpoints ; ++ idxEnd )
+    {   // For each endpoint after the first...
+        const Endpoint endpoint = mEndpoints[ idxEnd ] ;
+        unsigned idxHole = idxEnd ;
+        while( ( idxHole > 0 ) && ( endpoint < mEndpoints[ idxHole - 1 ] ) )
+        {   // Previous endpoint belongs after this one.  Shift it up.
+            mEndpoints[ idxHole ] = mEndpoints[ idxHole - 1 ] ;
+            -- idxHole ;
+        }
+        mEndpoints[ idxHole ] = endpoint ;
+    }
+
+    // Sweep along x, testing each interval that opens against every interval still open.
+    mPairs.Clear() ;
+    mActive.Clear() ;
+    for( unsigned idxEnd = 0 ; idxEnd < numEndpoints ; ++ idxEnd )
+    {   // For each endpoint, in order along x...
+        const Endpoint & endpoint = mEndpoints[ idxEnd ] ;
+        if( endpoint.mIsLower )
+        {   // Interval opens.
+            const Sphere & sphere = bounds[ endpoint.mIdxBounds ] ;
+            const size_t numActive = mActive.Size() ;
+            for( unsigned iActive = 0 ; iActive < numActive ; ++ iActive )
+            {   // For each interval still open...
+                const unsigned & idxOther = mActive[ iActive ] ;
+                if( SpheresOverlap( sphere , bounds[ idxOther ] ) )
+                {   // Bounding spheres overlap.
+                    mPairs.PushBack( Pair( Min2( idxOther , endpoint.mIdxBounds ) , Max2( idxOther , endpoint.mIdxBounds ) ) ) ;
+                }
+            }
+            mActive.PushBack( endpoint.mIdxBounds ) ;
+        }
+        else
+        {   // Interval closes.
+            const size_t numActive = mActive.Size() ;
+            for( unsigned iActive = 0 ; iActive < numActive ; ++ iActive )
+            {   // For each interval still open...
+                if( mActive[ iActive ] == endpoint.mIdxBounds )
+                {   // Found interval closing.  Replace it with last, since order does not matter.
+                    mActive[ iActive ] = mActive.Back() ;
+                    mActive.PopBack() ;
+                    break ;
+                }
+            }
+        }
+    }
+    ASSERT( mActive.Empty() ) ;
+
+    std::sort( mPairs.begin() , mPairs.end() ) ;
+}
+
+
+} ;
@@ -0,0 +1,95 @@
+/** \file sweepAndPrune.h
+
+    \brief Broad phase collision detection that sorts bounding volumes along an axis.
+
+    \author Copyright 2012 MJG; All rights reserved.
+*/
+#ifndef SHAPE_SWEEP_AND_PRUNE_H
+#define SHAPE_SWEEP_AND_PRUNE_H
+
+#include "Core/Containers/vector.h"
+
+#include "sphere.h"
+
+namespace Collision
+{
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+/** Broad phase collision detection that sorts bounding volumes along an axis.
+
+    Testing every pair of N shapes costs O(N^2).  Instead, this sorts the x
+    extents of each bounding sphere, then sweeps along x, testing only pairs
+    whose x intervals overlap.
+
+    Between calls to Update, the sorted order persists.  Bodies move little
+    from one step to the next, so the order rarely changes, and the insertion
+    sort Update uses costs nearly O(N) instead of O(N log N).
+*/
+class SweepAndPrune
+{
+    public:
+        /** Pair of bounding spheres whose volumes overlap.
+        */
+        struct Pair
+        {
+            Pair( unsigned idxA , unsigned idxB )
+                : mIdxA( idxA )
+                , mIdxB( idxB )
+            {
+                ASSERT( idxA < idxB ) ;
+            }
+
+            /// Order pairs lexicographically, so callers can merge sorted lists of pairs.
+            bool operator<( const Pair & that ) const
+            {
+                return ( mIdxA < that.mIdxA ) || ( ( mIdxA == that.mIdxA ) && ( mIdxB < that.mIdxB ) ) ;
+            }
+
+            bool operator==( const Pair & that ) const
+            {
+                return ( mIdxA == that.mIdxA ) && ( mIdxB == that.mIdxB ) ;
+            }
+
+            unsigned    mIdxA   ;   ///< Index of first bounding sphere.  Always less than mIdxB.
+            unsigned    mIdxB   ;   ///< Index of second bounding sphere.
+        } ;
+
+        SweepAndPrune() {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        void Clear() ;
+        void Update( const VECTOR< Sphere > & bounds ) ;
+
+        /// Return pairs of overlapping bounding spheres found by most recent Update, sorted.
+        const VECTOR< Pair > & GetPairs() const { return mPairs ; }
+
+    private:
+        /** Lower or upper end of the x interval of a bounding sphere.
+        */
+        struct Endpoint
+        {
+            /// Order endpoints by value, with lower ends first when values tie, so touching intervals overlap.
+            bool operator<( const Endpoint & that ) const
+            {
+                return ( mValue < that.mValue ) || ( ( mValue == that.mValue ) && mIsLower && ! that.mIsLower ) ;
+            }
+
+            float       mValue      ;   ///< X coordinate of this end of the interval.
+            unsigned    mIdxBounds  ;   ///< Index of bounding sphere this endpoint belongs to.
+            bool        mIsLower    ;   ///< Whether this is the lower end of the interval.
+        } ;
+
+        VECTOR< Endpoint >  mEndpoints  ;   ///< Ends of x intervals, sorted by x.  Order persists between updates.
+        VECTOR< unsigned >  mActive     ;   ///< Scratch space: Indices of bounding spheres whose interval contains the sweep position.
+        VECTOR< Pair >      mPairs      ;   ///< Pairs of overlapping bounding spheres.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+} ;
+
+#endif
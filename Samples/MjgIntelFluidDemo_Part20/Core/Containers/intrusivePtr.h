@@ -9,6 +9,13 @@
 
 #include "Core/Utility/macros.h"
 
+#if defined( _MSC_VER ) && ( _MSC_VER < 1700 )  // Older compiler that lacks std::atomic.
+#   include <intrin.h>
+#   pragma intrinsic( _InterlockedIncrement , _InterlockedDecrement )
+#else   // Modern compiler that has std::atomic.
+#   include <atomic>
+#endif
+
 // Macros ----------------------------------------------------------------------
 // Types -----------------------------------------------------------------------
 
@@ -87,6 +94,106 @@ class RefCountedMixin
 
 
 
+/** Reference-counted mix-in class, like RefCountedMixin, whose reference count threads can change concurrently.
+
+    Use this for objects that IntrusivePtr instances on different threads
+    share, such as render resources that a loader thread creates and the
+    render thread draws.
+
+    Incrementing only needs atomicity, not ordering, since a thread can only
+    add a reference through one it already holds, so AddReference uses
+    relaxed ordering, which costs no more than a locked add.
+
+    Decrementing uses release ordering, so every access through a reference
+    happens before the count drops, and the thread that drops it to zero
+    then issues an acquire fence, so it sees those accesses before deleting
+    the object.  Only that last release pays for the fence.
+
+    Legacy compilers that lack std::atomic use interlocked intrinsics, which
+    are full barriers, so are correct, albeit stronger than necessary.
+
+    \see RefCountedMixin, IntrusivePtr.
+*/
+class AtomicRefCountedMixin
+{
+    public:
+
+        /// Increment the number of references to this object.
+        void AddReference()
+        {
+        #if defined( _MSC_VER ) && ( _MSC_VER < 1700 )
+            const long refCountBefore = _InterlockedIncrement( & mRefCount ) - 1 ;
+        #else
+            const int refCountBefore = mRefCount.fetch_add( 1 , std::memory_order_relaxed ) ;
+        #endif
+            ASSERT( refCountBefore >= 0 ) ;
+            (void) refCountBefore ;
+        }
+
+        /** Get number of references to this object.
+
+            Other threads could change the count at any time, so this is only
+            meaningful when the caller knows no other thread references this object.
+        */
+        int GetRefCount() const
+        {
+        #if defined( _MSC_VER ) && ( _MSC_VER < 1700 )
+            return int( mRefCount ) ;
+        #else
+            return mRefCount.load( std::memory_order_relaxed ) ;
+        #endif
+        }
+
+    protected:
+        /** Initialize the reference count to zero.
+
+            \note   Constructor is protected to prevent instantiating AtomicRefCountedMixin objects.
+                    This class is meant to be inherited, not instantiated.
+        */
+        AtomicRefCountedMixin()
+            : mRefCount( 0 )
+        {}
+
+        /// Destruct a reference-counted object.
+        ~AtomicRefCountedMixin()
+        {
+            ASSERT( 0 == GetRefCount() ) ;
+        }
+
+        /// Decrement the number of references to this object, and return true if this was the last one.
+        /// Derived class must call _ReleaseReference and delete this object (or arrange for its deletion) if it returns true.
+        bool _ReleaseReference()
+        {
+        #if defined( _MSC_VER ) && ( _MSC_VER < 1700 )
+            const long refCountBefore = _InterlockedDecrement( & mRefCount ) + 1 ;
+            ASSERT( refCountBefore > 0 ) ;
+            return 1 == refCountBefore ;
+        #else
+            const int refCountBefore = mRefCount.fetch_sub( 1 , std::memory_order_release ) ;
+            ASSERT( refCountBefore > 0 ) ;
+            if( 1 == refCountBefore )
+            {   // That was the last reference.  Synchronize with releases on other threads before caller deletes this object.
+                std::atomic_thread_fence( std::memory_order_acquire ) ;
+                return true ;
+            }
+            return false ;
+        #endif
+        }
+
+    private:
+        AtomicRefCountedMixin( const AtomicRefCountedMixin & ) ;                // Disallow copy, which would copy the count.
+        AtomicRefCountedMixin & operator=( const AtomicRefCountedMixin & ) ;    // Disallow assignment, which would copy the count.
+
+    #if defined( _MSC_VER ) && ( _MSC_VER < 1700 )
+        volatile long       mRefCount   ;   ///< Number of references to this object.
+    #else
+        std::atomic< int >  mRefCount   ;   ///< Number of references to this object.
+    #endif
+} ;
+
+
+
+
 /** Smart pointer that uses intrusive reference counting.
 
     Calls these functions:
@@ -0,0 +1,858 @@
+/** \file asyncLog.cpp
+
+    \brief Log that defers formatting and writing of messages to a background thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "asyncLog.h"
+
+#include "Core/Utility/macros.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <wchar.h>
+
+#if ASYNC_LOG_THREADED
+#   include <windows.h>
+#endif
+
+#pragma warning( disable : 4996 ) // This function may be unsafe (sprintf)
+
+#if ASYNC_LOG_THREADED
+
+// Types --------------------------------------------------------------
+
+/** Kind of argument a printf conversion consumes.
+*/
+enum AsyncLogArgKind
+{
+    ASYNC_LOG_ARG_NONE          ,   ///< Conversion consumes no argument, i.e. %%.
+    ASYNC_LOG_ARG_INVALID       ,   ///< Conversion is malformed, so gets written literally and consumes no argument.
+    ASYNC_LOG_ARG_SIGNED        ,   ///< Signed integer, e.g. %d.
+    ASYNC_LOG_ARG_UNSIGNED      ,   ///< Unsigned integer, e.g. %u or %x.
+    ASYNC_LOG_ARG_DOUBLE        ,   ///< Floating-point number, e.g. %g.
+    ASYNC_LOG_ARG_POINTER       ,   ///< Pointer, i.e. %p.
+    ASYNC_LOG_ARG_CHAR          ,   ///< Character, i.e. %c.
+    ASYNC_LOG_ARG_STRING        ,   ///< Narrow string, i.e. %s.
+    ASYNC_LOG_ARG_WIDE_STRING   ,   ///< Wide string, i.e. %ls or %S, which gets narrowed.
+    ASYNC_LOG_ARG_COUNT             ///< Count of characters written, i.e. %n, which this log ignores.
+} ;
+
+
+
+
+/** Size of the argument a printf conversion consumes, according to its length modifier.
+*/
+enum AsyncLogArgLength
+{
+    ASYNC_LOG_LENGTH_DEFAULT    ,   ///< No modifier, or one that does not change argument size (hh, h, I32).
+    ASYNC_LOG_LENGTH_LONG       ,   ///< l
+    ASYNC_LOG_LENGTH_LONG_LONG  ,   ///< ll or I64
+    ASYNC_LOG_LENGTH_SIZE       ,   ///< z or I
+    ASYNC_LOG_LENGTH_INTMAX     ,   ///< j
+    ASYNC_LOG_LENGTH_PTRDIFF    ,   ///< t
+    ASYNC_LOG_LENGTH_LONG_DOUBLE    ///< L
+} ;
+
+
+
+
+/** Parsed printf conversion specification, e.g. "%-8.3lf".
+*/
+struct AsyncLogConversion
+{
+    const char *        mSpecBegin  ;   ///< First character after '%', where flags, width and precision begin.
+    const char *        mSpecEnd    ;   ///< Character after flags, width and precision, where length modifier begins.
+    unsigned            mNumStars   ;   ///< Number of '*' in width and precision, each of which consumes an int argument.
+    AsyncLogArgLength   mLength     ;   ///< Size of argument.
+    char                mConversion ;   ///< Conversion character, e.g. 'd'.
+    AsyncLogArgKind     mKind       ;   ///< Kind of argument.
+} ;
+
+
+
+
+/** Value of one argument, or one field of a record, in the ring.
+*/
+union AsyncLogValue
+{
+    long long           mSigned     ;
+    unsigned long long  mUnsigned   ;
+    double              mDouble     ;
+    const void *        mPointer    ;
+} ;
+
+
+
+
+/** Start of each record in the ring.
+
+    Arguments follow the header, in the order the format consumes them,
+    each in one AsyncLogValue.  A string takes one AsyncLogValue holding
+    its length, followed by its characters and terminator, padded to the
+    size of AsyncLogValue.  If mFormat is NULLPTR, the format follows the
+    header as a string, before the arguments.
+*/
+struct AsyncLogRecordHeader
+{
+    unsigned            mNumBytes   ;   ///< Size of record, including this header.  Multiple of sizeof( AsyncLogValue ).
+    unsigned            mFlags      ;   ///< Combination of ASYNC_LOG_RECORD_* flags.
+    FILE *              mStream     ;   ///< Stream to which to write message.
+    const char *        mFormat     ;   ///< Format of message, or NULLPTR if it follows this header.
+} ;
+
+static const unsigned ASYNC_LOG_RECORD_PADDING = 1 ;    ///< Record only fills the end of the ring, so the next record starts at the beginning.  Only mNumBytes and mFlags are valid.
+
+
+
+
+/** Ring buffer of records that one thread writes and the flush thread reads.
+*/
+struct AsyncLogRing
+{
+    static const unsigned   NUM_BYTES = 1 << 16 ;   ///< Capacity of ring.  Must be a power of 2.
+
+    unsigned char * GetBytes() { return reinterpret_cast< unsigned char * >( mStorage ) ; }
+
+    AsyncLogValue       mStorage[ NUM_BYTES / sizeof( AsyncLogValue ) ] ;   ///< Records, typed to align them.
+    volatile unsigned   mNumBytesWritten    ;   ///< Total bytes the owning thread has written.  Only that thread modifies this.
+    volatile unsigned   mNumBytesRead       ;   ///< Total bytes the flush thread has consumed.  Only that thread modifies this.
+    AsyncLogRing *      mNext               ;   ///< Next ring in sRings.
+} ;
+
+
+
+
+/** Cursor that appends values and strings at the end of a record being built.
+*/
+struct AsyncLogRecordWriter
+{
+    AsyncLogRecordWriter( unsigned char * begin , unsigned char * end )
+        : mCursor( begin )
+        , mEnd( end )
+        , mOverflowed( false )
+    {
+    }
+
+    void AppendValue( const AsyncLogValue & value )
+    {
+        if( mCursor + sizeof( AsyncLogValue ) > mEnd )
+        {   // Record has no room for this value.
+            mOverflowed = true ;
+            return ;
+        }
+        memcpy( mCursor , & value , sizeof( AsyncLogValue ) ) ;
+        mCursor += sizeof( AsyncLogValue ) ;
+    }
+
+    /// Append characters, truncated to fit in the record.
+    void AppendChars( const char * chars , const wchar_t * wideChars , size_t length )
+    {
+        const ptrdiff_t room = ( mEnd - mCursor ) - ptrdiff_t( sizeof( AsyncLogValue ) ) - 1 ;
+        if( room < 0 )
+        {   // Record has no room for even an empty string.
+            mOverflowed = true ;
+            return ;
+        }
+        length = Min2( length , size_t( room ) ) ;
+        AsyncLogValue lengthValue ;
+        lengthValue.mUnsigned = length ;
+        AppendValue( lengthValue ) ;
+        if( chars != NULLPTR )
+        {
+            memcpy( mCursor , chars , length ) ;
+        }
+        else
+        {   // Narrow each wide character, replacing those beyond ASCII.
+            for( size_t iChar = 0 ; iChar < length ; ++ iChar )
+            {
+                mCursor[ iChar ] = ( wideChars[ iChar ] < 128 ) ? char( wideChars[ iChar ] ) : '?' ;
+            }
+        }
+        mCursor[ length ] = '\0' ;
+        const size_t paddedLength = ( length + sizeof( AsyncLogValue ) ) & ~ ( sizeof( AsyncLogValue ) - 1 ) ;
+        mCursor += paddedLength ;
+    }
+
+    void AppendString( const char * string )
+    {
+        if( NULLPTR == string ) string = "(null)" ;
+        AppendChars( string , NULLPTR , strlen( string ) ) ;
+    }
+
+    void AppendWideString( const wchar_t * string )
+    {
+        if( NULLPTR == string ) string = L"(null)" ;
+        AppendChars( NULLPTR , string , wcslen( string ) ) ;
+    }
+
+    unsigned char * mCursor     ;   ///< Where the next value goes.
+    unsigned char * mEnd        ;   ///< End of room for the record.
+    bool            mOverflowed ;   ///< Whether some value did not fit.
+} ;
+
+
+
+
+/** Cursor that reads values and strings from a record, in the order AsyncLogRecordWriter appended them.
+*/
+struct AsyncLogRecordReader
+{
+    explicit AsyncLogRecordReader( const unsigned char * begin )
+        : mCursor( begin )
+    {
+    }
+
+    AsyncLogValue ReadValue()
+    {
+        AsyncLogValue value ;
+        memcpy( & value , mCursor , sizeof( AsyncLogValue ) ) ;
+        mCursor += sizeof( AsyncLogValue ) ;
+        return value ;
+    }
+
+    const char * ReadString()
+    {
+        const size_t    length  = size_t( ReadValue().mUnsigned ) ;
+        const char *    string  = reinterpret_cast< const char * >( mCursor ) ;
+        mCursor += ( length + sizeof( AsyncLogValue ) ) & ~ ( sizeof( AsyncLogValue ) - 1 ) ;
+        return string ;
+    }
+
+    const unsigned char * mCursor ; ///< Where the next value is.
+} ;
+
+// Private variables --------------------------------------------------------------
+
+static const size_t     sMaxRecordBytes             = 1024      ;   ///< Largest record.  Strings get truncated to fit.
+static const DWORD      sFlushIntervalMilliseconds  = 20        ;   ///< How long the flush thread sleeps between drains, unless a ring fills past half.
+static const size_t     sMaxStreamsPerDrain         = 8         ;   ///< Number of distinct streams a drain remembers to flush at its end.  Others flush after each message.
+
+static _declspec( thread ) AsyncLogRing * sThisThreadRing = NULLPTR ; ///< Ring of the current thread, or NULLPTR if it has not logged yet.
+
+static AsyncLogRing * volatile  sRings                  = NULLPTR   ;   ///< Every ring, newest first.  Rings only get added, never removed.
+static volatile bool            sIsRunning              = false     ;   ///< Whether the flush thread runs, so messages go to rings.
+static volatile bool            sStopRequested          = false     ;   ///< Whether Stop wants the flush thread to exit.
+static volatile LONG            sNumDropped             = 0         ;   ///< Number of messages dropped because a ring was full.
+static HANDLE                   sFlushThread            = NULL      ;   ///< Thread that drains rings.
+static HANDLE                   sWakeEvent              = NULL      ;   ///< Event that wakes the flush thread early.
+static CRITICAL_SECTION         sDrainLock                          ;   ///< Lets only one thread at a time drain, i.e. the flush thread or a caller of Flush.  Writers never take this.
+static bool                     sDrainLockInitialized   = false     ;   ///< Whether sDrainLock is initialized.
+
+// Private functions --------------------------------------------------------------
+
+
+
+
+/** Parse a printf conversion specification.
+
+    \param afterPercent     First character after the '%' that starts the specification.
+
+    \param conversion       (out) Parsed specification.
+
+    \return First character after the specification.
+*/
+static const char * ParseConversion( const char * afterPercent , AsyncLogConversion & conversion )
+{
+    const char * c = afterPercent ;
+    conversion.mSpecBegin   = c ;
+    conversion.mNumStars    = 0 ;
+    conversion.mLength      = ASYNC_LOG_LENGTH_DEFAULT ;
+
+    while( ( * c != '\0' ) && strchr( "-+ #0" , * c ) ) ++ c ;      // Flags
+    if( '*' == * c ) { ++ conversion.mNumStars ; ++ c ; }           // Width
+    else while( ( * c >= '0' ) && ( * c <= '9' ) ) ++ c ;
+    if( '.' == * c )
+    {   // Precision
+        ++ c ;
+        if( '*' == * c ) { ++ conversion.mNumStars ; ++ c ; }
+        else while( ( * c >= '0' ) && ( * c <= '9' ) ) ++ c ;
+    }
+    conversion.mSpecEnd = c ;
+
+    switch( * c )
+    {   // Length modifier
+        case 'h': ++ c ; if( 'h' == * c ) ++ c ; break ;
+        case 'l': ++ c ; if( 'l' == * c ) { ++ c ; conversion.mLength = ASYNC_LOG_LENGTH_LONG_LONG ; } else conversion.mLength = ASYNC_LOG_LENGTH_LONG ; break ;
+        case 'L': ++ c ; conversion.mLength = ASYNC_LOG_LENGTH_LONG_DOUBLE  ; break ;
+        case 'j': ++ c ; conversion.mLength = ASYNC_LOG_LENGTH_INTMAX       ; break ;
+        case 'z': ++ c ; conversion.mLength = ASYNC_LOG_LENGTH_SIZE         ; break ;
+        case 't': ++ c ; conversion.mLength = ASYNC_LOG_LENGTH_PTRDIFF      ; break ;
+        case 'I':
+            ++ c ;
+            if( ( '6' == c[ 0 ] ) && ( '4' == c[ 1 ] ) )        { c += 2 ; conversion.mLength = ASYNC_LOG_LENGTH_LONG_LONG ; }
+            else if( ( '3' == c[ 0 ] ) && ( '2' == c[ 1 ] ) )   { c += 2 ; }
+            else                                                { conversion.mLength = ASYNC_LOG_LENGTH_SIZE ; }
+        break ;
+        default: break ;
+    }
+
+    conversion.mConversion = * c ;
+    switch( * c )
+    {
+        case 'd': case 'i':
+            conversion.mKind = ASYNC_LOG_ARG_SIGNED ;
+        break ;
+        case 'u': case 'o': case 'x': case 'X':
+            conversion.mKind = ASYNC_LOG_ARG_UNSIGNED ;
+        break ;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            conversion.mKind = ASYNC_LOG_ARG_DOUBLE ;
+        break ;
+        case 'p':
+            conversion.mKind = ASYNC_LOG_ARG_POINTER ;
+        break ;
+        case 'c': case 'C':
+            conversion.mKind = ASYNC_LOG_ARG_CHAR ;
+        break ;
+        case 's':
+            conversion.mKind = ( ASYNC_LOG_LENGTH_LONG == conversion.mLength ) ? ASYNC_LOG_ARG_WIDE_STRING : ASYNC_LOG_ARG_STRING ;
+        break ;
+        case 'S':
+            conversion.mKind = ASYNC_LOG_ARG_WIDE_STRING ;
+        break ;
+        case 'n':
+            conversion.mKind = ASYNC_LOG_ARG_COUNT ;
+        break ;
+        case '%':
+            conversion.mKind = ASYNC_LOG_ARG_NONE ;
+        break ;
+        default:
+            conversion.mKind = ASYNC_LOG_ARG_INVALID ;
+        break ;
+    }
+
+    if( ( conversion.mSpecEnd - conversion.mSpecBegin ) > 32 )
+    {   // Flags, width and precision are implausibly long, and would not fit in the specification FormatRecord builds.
+        conversion.mKind = ASYNC_LOG_ARG_INVALID ;
+    }
+
+    return ( * c != '\0' ) ? c + 1 : c ;
+}
+
+
+
+
+/** Append to a record the arguments the given format consumes.
+
+    \return Whether every argument fit in the record.
+*/
+static bool CaptureArguments( AsyncLogRecordWriter & writer , const char * format , va_list args )
+{
+    for( const char * c = format ; * c != '\0' ; )
+    {   // For each character of format...
+        if( * c != '%' )
+        {   // Character is literal.
+            ++ c ;
+            continue ;
+        }
+
+        AsyncLogConversion conversion ;
+        c = ParseConversion( c + 1 , conversion ) ;
+        if( ( ASYNC_LOG_ARG_NONE == conversion.mKind ) || ( ASYNC_LOG_ARG_INVALID == conversion.mKind ) )
+        {   // Conversion consumes no arguments.
+            continue ;
+        }
+
+        AsyncLogValue value ;
+        for( unsigned iStar = 0 ; iStar < conversion.mNumStars ; ++ iStar )
+        {   // For each width or precision given as argument...
+            value.mSigned = va_arg( args , int ) ;
+            writer.AppendValue( value ) ;
+        }
+
+        switch( conversion.mKind )
+        {
+            case ASYNC_LOG_ARG_SIGNED:
+                switch( conversion.mLength )
+                {
+                    case ASYNC_LOG_LENGTH_LONG      : value.mSigned = va_arg( args , long       ) ; break ;
+                    case ASYNC_LOG_LENGTH_LONG_LONG : value.mSigned = va_arg( args , long long  ) ; break ;
+                    case ASYNC_LOG_LENGTH_INTMAX    : value.mSigned = va_arg( args , long long  ) ; break ;
+                    case ASYNC_LOG_LENGTH_SIZE      : value.mSigned = va_arg( args , ptrdiff_t  ) ; break ;
+                    case ASYNC_LOG_LENGTH_PTRDIFF   : value.mSigned = va_arg( args , ptrdiff_t  ) ; break ;
+                    default                         : value.mSigned = va_arg( args , int        ) ; break ;
+                }
+                writer.AppendValue( value ) ;
+            break ;
+            case ASYNC_LOG_ARG_UNSIGNED:
+                switch( conversion.mLength )
+                {
+                    case ASYNC_LOG_LENGTH_LONG      : value.mUnsigned = va_arg( args , unsigned long        ) ; break ;
+                    case ASYNC_LOG_LENGTH_LONG_LONG : value.mUnsigned = va_arg( args , unsigned long long   ) ; break ;
+                    case ASYNC_LOG_LENGTH_INTMAX    : value.mUnsigned = va_arg( args , unsigned long long   ) ; break ;
+                    case ASYNC_LOG_LENGTH_SIZE      : value.mUnsigned = va_arg( args , size_t               ) ; break ;
+                    case ASYNC_LOG_LENGTH_PTRDIFF   : value.mUnsigned = va_arg( args , size_t               ) ; break ;
+                    default                         : value.mUnsigned = va_arg( args , unsigned             ) ; break ;
+                }
+                writer.AppendValue( value ) ;
+            break ;
+            case ASYNC_LOG_ARG_DOUBLE:
+                if( ASYNC_LOG_LENGTH_LONG_DOUBLE == conversion.mLength )
+                {
+                    value.mDouble = double( va_arg( args , long double ) ) ;
+                }
+                else
+                {
+                    value.mDouble = va_arg( args , double ) ;
+                }
+                writer.AppendValue( value ) ;
+            break ;
+            case ASYNC_LOG_ARG_CHAR:
+                value.mSigned = va_arg( args , int ) ;
+                writer.AppendValue( value ) ;
+            break ;
+            case ASYNC_LOG_ARG_POINTER:
+            case ASYNC_LOG_ARG_COUNT:
+                value.mPointer = va_arg( args , const void * ) ;
+                writer.AppendValue( value ) ;
+            break ;
+            case ASYNC_LOG_ARG_STRING:
+                writer.AppendString( va_arg( args , const char * ) ) ;
+            break ;
+            case ASYNC_LOG_ARG_WIDE_STRING:
+                writer.AppendWideString( va_arg( args , const wchar_t * ) ) ;
+            break ;
+            default:
+                FAIL() ;
+            break ;
+        }
+    }
+    return ! writer.mOverflowed ;
+}
+
+
+
+
+/** Write a message, formatting arguments read from its record.
+*/
+static void FormatRecord( FILE * stream , const char * format , AsyncLogRecordReader & reader )
+{
+    const char * literalBegin = format ;
+    for( const char * c = format ; * c != '\0' ; )
+    {   // For each character of format...
+        if( * c != '%' )
+        {   // Character is literal.
+            ++ c ;
+            continue ;
+        }
+
+        fwrite( literalBegin , 1 , c - literalBegin , stream ) ;
+
+        AsyncLogConversion  conversion ;
+        const char *        conversionEnd = ParseConversion( c + 1 , conversion ) ;
+
+        if( ASYNC_LOG_ARG_INVALID == conversion.mKind )
+        {   // Write malformed conversion as it appears.
+            fwrite( c , 1 , conversionEnd - c , stream ) ;
+        }
+        else if( ASYNC_LOG_ARG_NONE == conversion.mKind )
+        {
+            fputc( '%' , stream ) ;
+        }
+        else
+        {   // Conversion consumes arguments.  Rebuild its specification, with stars replaced by their values, and length matching the value stored.
+            char    spec[ 96 ] ;
+            char *  specCursor = spec ;
+            * specCursor ++ = '%' ;
+            for( const char * s = conversion.mSpecBegin ; s < conversion.mSpecEnd ; ++ s )
+            {   // For each flag, width and precision character...
+                if( '*' == * s )
+                {
+                    specCursor += sprintf( specCursor , "%d" , int( reader.ReadValue().mSigned ) ) ;
+                }
+                else
+                {
+                    * specCursor ++ = * s ;
+                }
+            }
+
+            switch( conversion.mKind )
+            {
+                case ASYNC_LOG_ARG_SIGNED:
+                case ASYNC_LOG_ARG_UNSIGNED:
+                    * specCursor ++ = 'l' ;
+                    * specCursor ++ = 'l' ;
+                    * specCursor ++ = conversion.mConversion ;
+                    * specCursor    = '\0' ;
+                    fprintf( stream , spec , reader.ReadValue().mSigned ) ;
+                break ;
+                case ASYNC_LOG_ARG_DOUBLE:
+                    * specCursor ++ = conversion.mConversion ;
+                    * specCursor    = '\0' ;
+                    fprintf( stream , spec , reader.ReadValue().mDouble ) ;
+                break ;
+                case ASYNC_LOG_ARG_POINTER:
+                    * specCursor ++ = 'p' ;
+                    * specCursor    = '\0' ;
+                    fprintf( stream , spec , reader.ReadValue().mPointer ) ;
+                break ;
+                case ASYNC_LOG_ARG_CHAR:
+                    * specCursor ++ = 'c' ;
+                    * specCursor    = '\0' ;
+                    fprintf( stream , spec , int( reader.ReadValue().mSigned ) ) ;
+                break ;
+                case ASYNC_LOG_ARG_STRING:
+                case ASYNC_LOG_ARG_WIDE_STRING:
+                    * specCursor ++ = 's' ;
+                    * specCursor    = '\0' ;
+                    fprintf( stream , spec , reader.ReadString() ) ;
+                break ;
+                case ASYNC_LOG_ARG_COUNT:
+                    reader.ReadValue() ;    // Skip pointer.  Writing through it would happen long after the caller returned.
+                break ;
+                default:
+                    FAIL() ;
+                break ;
+            }
+        }
+
+        c               = conversionEnd ;
+        literalBegin    = c ;
+    }
+    fwrite( literalBegin , 1 , strlen( literalBegin ) , stream ) ;
+}
+
+
+
+
+/** Return ring of the current thread, creating it upon first use.
+*/
+static AsyncLogRing * GetThisThreadRing()
+{
+    if( NULLPTR == sThisThreadRing )
+    {   // This thread has not logged yet.
+        AsyncLogRing * ring = new AsyncLogRing ;
+        ring->mNumBytesWritten  = 0 ;
+        ring->mNumBytesRead     = 0 ;
+        // Prepend ring to sRings.  Other threads might prepend concurrently, so retry until no other thread intervened.
+        do
+        {
+            ring->mNext = sRings ;
+        }
+        while( InterlockedCompareExchangePointer( reinterpret_cast< PVOID volatile * >( & sRings ) , ring , ring->mNext ) != ring->mNext ) ;
+        sThisThreadRing = ring ;
+    }
+    return sThisThreadRing ;
+}
+
+
+
+
+/** Copy a record into the ring of the current thread.
+
+    \return Whether the ring had room.
+*/
+static bool PushRecord( const unsigned char * record , unsigned numBytes )
+{
+    AsyncLogRing *  ring    = GetThisThreadRing() ;
+    const unsigned  written = ring->mNumBytesWritten ;
+    const unsigned  read    = ring->mNumBytesRead ;     // Flush thread might advance this meanwhile, which only frees more room.
+    MemoryBarrier() ;   // Read mNumBytesRead before overwriting the bytes it frees.
+
+    unsigned        offset  = written & ( AsyncLogRing::NUM_BYTES - 1 ) ;
+    const unsigned  padding = ( offset + numBytes > AsyncLogRing::NUM_BYTES ) ? ( AsyncLogRing::NUM_BYTES - offset ) : 0 ;
+    const unsigned  numBytesUsed = written - read ;
+    if( numBytesUsed + padding + numBytes > AsyncLogRing::NUM_BYTES )
+    {   // Ring is full.
+        return false ;
+    }
+
+    unsigned char * bytes = ring->GetBytes() ;
+    if( padding > 0 )
+    {   // Record would straddle the end of the ring, so fill the end with padding and start record at the beginning.
+        unsigned * paddingHeader = reinterpret_cast< unsigned * >( bytes + offset ) ;
+        paddingHeader[ 0 ] = padding ;
+        paddingHeader[ 1 ] = ASYNC_LOG_RECORD_PADDING ;
+        offset = 0 ;
+    }
+    memcpy( bytes + offset , record , numBytes ) ;
+
+    MemoryBarrier() ;   // Write record before publishing it.
+    ring->mNumBytesWritten = written + padding + numBytes ;
+
+    if( numBytesUsed + padding + numBytes > AsyncLogRing::NUM_BYTES / 2 )
+    {   // Ring is filling up, so wake flush thread rather than wait for it to wake itself.
+        SetEvent( sWakeEvent ) ;
+    }
+    return true ;
+}
+
+
+
+
+/** Capture a message into a record and push it into the ring of the current thread, or drop it if it does not fit.
+*/
+static void Enqueue( FILE * stream , const char * format , bool copyFormat , va_list args )
+{
+    AsyncLogValue           storage[ sMaxRecordBytes / sizeof( AsyncLogValue ) ] ;
+    unsigned char *         record  = reinterpret_cast< unsigned char * >( storage ) ;
+    AsyncLogRecordWriter    writer( record + sizeof( AsyncLogRecordHeader ) , record + sMaxRecordBytes ) ;
+
+    if( copyFormat )
+    {   // Format might not outlive the flush, so copy it into the record.
+        writer.AppendString( format ) ;
+    }
+
+    if( ! CaptureArguments( writer , format , args ) )
+    {   // Message does not fit in a record.
+        InterlockedIncrement( & sNumDropped ) ;
+        return ;
+    }
+
+    AsyncLogRecordHeader * header = reinterpret_cast< AsyncLogRecordHeader * >( record ) ;
+    header->mNumBytes   = unsigned( writer.mCursor - record ) ;
+    header->mFlags      = 0 ;
+    header->mStream     = stream ;
+    header->mFormat     = copyFormat ? NULLPTR : format ;
+
+    if( ! PushRecord( record , header->mNumBytes ) )
+    {   // Ring is full.  Drop message rather than wait.
+        InterlockedIncrement( & sNumDropped ) ;
+    }
+}
+
+
+
+
+/** Format and write every message in every ring, then flush the streams they went to.
+*/
+static void Drain()
+{
+    EnterCriticalSection( & sDrainLock ) ;
+
+    FILE *  streams[ sMaxStreamsPerDrain ] ;
+    size_t  numStreams = 0 ;
+
+    for( AsyncLogRing * ring = sRings ; ring != NULLPTR ; ring = ring->mNext )
+    {   // For each ring...
+        const unsigned  written = ring->mNumBytesWritten ;
+        MemoryBarrier() ;   // Read mNumBytesWritten before the records it publishes.
+        unsigned        read    = ring->mNumBytesRead ;
+        unsigned char * bytes   = ring->GetBytes() ;
+
+        while( read != written )
+        {   // For each record in ring...
+            const unsigned          offset  = read & ( AsyncLogRing::NUM_BYTES - 1 ) ;
+            const unsigned *        prefix  = reinterpret_cast< const unsigned * >( bytes + offset ) ;
+            if( prefix[ 1 ] & ASYNC_LOG_RECORD_PADDING )
+            {   // Record only fills the end of the ring.
+                read += prefix[ 0 ] ;
+                continue ;
+            }
+
+            const AsyncLogRecordHeader *    header  = reinterpret_cast< const AsyncLogRecordHeader * >( bytes + offset ) ;
+            AsyncLogRecordReader            reader( bytes + offset + sizeof( AsyncLogRecordHeader ) ) ;
+            const char *                    format  = ( header->mFormat != NULLPTR ) ? header->mFormat : reader.ReadString() ;
+            FormatRecord( header->mStream , format , reader ) ;
+
+            size_t iStream = 0 ;
+            while( ( iStream < numStreams ) && ( streams[ iStream ] != header->mStream ) ) ++ iStream ;
+            if( iStream == numStreams )
+            {   // This drain has not written to this stream yet.
+                if( numStreams < sMaxStreamsPerDrain )
+                {   // Remember to flush stream at end.
+                    streams[ numStreams ++ ] = header->mStream ;
+                }
+                else
+                {   // Too many streams to remember, so flush now.
+                    fflush( header->mStream ) ;
+                }
+            }
+
+            read += header->mNumBytes ;
+            MemoryBarrier() ;   // Finish reading record before freeing it.
+            ring->mNumBytesRead = read ;
+        }
+    }
+
+    for( size_t iStream = 0 ; iStream < numStreams ; ++ iStream )
+    {   // For each stream this drain wrote to...
+        fflush( streams[ iStream ] ) ;
+    }
+
+    LeaveCriticalSection( & sDrainLock ) ;
+}
+
+
+
+
+/** Drain rings periodically, until Stop says to exit.
+*/
+static DWORD WINAPI FlushThreadMain( LPVOID /* context */ )
+{
+    while( ! sStopRequested )
+    {   // Until Stop...
+        WaitForSingleObject( sWakeEvent , sFlushIntervalMilliseconds ) ;
+        Drain() ;
+    }
+    Drain() ;
+    return 0 ;
+}
+
+#endif // ASYNC_LOG_THREADED
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+/** Start the thread that formats and writes messages.
+
+    Until this is called, messages get written synchronously.
+*/
+/* static */ void AsyncLog::Start()
+{
+#if ASYNC_LOG_THREADED
+    if( sIsRunning )
+    {   // Already started.
+        return ;
+    }
+    if( ! sDrainLockInitialized )
+    {
+        InitializeCriticalSection( & sDrainLock ) ;
+        sDrainLockInitialized = true ;
+    }
+    sStopRequested  = false ;
+    sWakeEvent      = CreateEvent( NULL , FALSE , FALSE , NULL ) ;
+    sFlushThread    = CreateThread( NULL , 0 , FlushThreadMain , NULL , 0 , NULL ) ;
+    ASSERT( sFlushThread ) ;
+    sIsRunning      = ( sFlushThread != NULL ) ;
+#endif
+}
+
+
+
+
+/** Write every pending message, and stop the thread that formats and writes messages.
+
+    After this, messages get written synchronously.  Call this only once
+    other threads have stopped logging, since a message some thread
+    pushes while this runs would wait until the next Start to appear.
+*/
+/* static */ void AsyncLog::Stop()
+{
+#if ASYNC_LOG_THREADED
+    if( ! sIsRunning )
+    {   // Not started.
+        return ;
+    }
+    sIsRunning      = false ;   // New messages go straight to their streams from here on.
+    sStopRequested  = true ;
+    SetEvent( sWakeEvent ) ;
+    WaitForSingleObject( sFlushThread , INFINITE ) ;
+    CloseHandle( sFlushThread ) ;
+    CloseHandle( sWakeEvent ) ;
+    sFlushThread    = NULL ;
+    sWakeEvent      = NULL ;
+    Drain() ;   // Write messages pushed after the last drain of the flush thread.
+#endif
+}
+
+
+
+
+/** Write every message pushed so far, and flush their streams, before returning.
+
+    Call this before closing a stream that messages go to.
+*/
+/* static */ void AsyncLog::Flush()
+{
+#if ASYNC_LOG_THREADED
+    if( sDrainLockInitialized )
+    {
+        Drain() ;
+    }
+#endif
+}
+
+
+
+
+/** Return whether messages go to the background thread, i.e. Start has run and Stop has not run since.
+*/
+/* static */ bool AsyncLog::IsRunning()
+{
+#if ASYNC_LOG_THREADED
+    return sIsRunning ;
+#else
+    return false ;
+#endif
+}
+
+
+
+
+/** Return number of messages dropped, because the ring of the thread that logged it was full, or it had too many arguments.
+*/
+/* static */ unsigned AsyncLog::GetNumDropped()
+{
+#if ASYNC_LOG_THREADED
+    return unsigned( sNumDropped ) ;
+#else
+    return 0 ;
+#endif
+}
+
+
+
+
+/** Log a message to stdout.  Format must outlive the flush, as string literals do.
+*/
+/* static */ void AsyncLog::Printf( const char * format , ... )
+{
+    va_list args ;
+    va_start( args , format ) ;
+    VFPrintf( stdout , format , args ) ;
+    va_end( args ) ;
+}
+
+
+
+
+/** Log a message to the given stream.  Format must outlive the flush, as string literals do.
+*/
+/* static */ void AsyncLog::FPrintf( FILE * stream , const char * format , ... )
+{
+    va_list args ;
+    va_start( args , format ) ;
+    VFPrintf( stream , format , args ) ;
+    va_end( args ) ;
+}
+
+
+
+
+/** Log a message to the given stream.  Format must outlive the flush, as string literals do.
+*/
+/* static */ void AsyncLog::VFPrintf( FILE * stream , const char * format , va_list args )
+{
+#if ASYNC_LOG_THREADED
+    if( sIsRunning )
+    {
+        Enqueue( stream , format , false , args ) ;
+        return ;
+    }
+#endif
+    vfprintf( stream , format , args ) ;
+}
+
+
+
+
+/** Log a message to the given stream, copying its format, which may therefore be a transient buffer.
+*/
+/* static */ void AsyncLog::VFPrintfTransientFormat( FILE * stream , const char * format , va_list args )
+{
+#if ASYNC_LOG_THREADED
+    if( sIsRunning )
+    {
+        Enqueue( stream , format , true , args ) ;
+        return ;
+    }
+#endif
+    vfprintf( stream , format , args ) ;
+}
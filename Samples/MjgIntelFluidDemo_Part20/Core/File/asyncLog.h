@@ -0,0 +1,72 @@
+/** \file asyncLog.h
+
+    \brief Log that defers formatting and writing of messages to a background thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+// Macros --------------------------------------------------------------
+
+/** Whether AsyncLog formats and writes messages on a background thread.
+
+    Otherwise each call formats and writes synchronously, which produces the
+    same text but makes the caller wait for it.
+*/
+#if defined( WIN32 )
+#   define ASYNC_LOG_THREADED 1
+#else
+#   define ASYNC_LOG_THREADED 0
+#endif
+
+// Types --------------------------------------------------------------
+
+/** Log that defers formatting and writing of messages to a background thread.
+
+    Printf and its relatives copy the format address and argument values,
+    not formatted text, into a ring buffer that belongs to the calling
+    thread, then return.  Only that thread writes its ring and only the
+    flush thread reads it, so neither ever takes a lock.  The flush thread
+    periodically formats each message and writes it to its stream.  So
+    threads that log never wait for each other, for formatting, or for the
+    disk, and diagnostic logging can stay on in parallel code.
+
+    Arguments must be plain data: integers, floating-point numbers,
+    pointers and C strings.  Strings get copied, so callers may reuse them
+    after the call.  Formats do not, so Printf, FPrintf and VFPrintf
+    require formats that outlive the flush, as string literals do.  Use
+    VFPrintfTransientFormat for formats built at run time.
+
+    Messages from one thread stay in order, but messages from different
+    threads can appear in a different order than they happened.  When the
+    ring of a thread is full, its message gets dropped, and counted, rather
+    than making the thread wait.
+
+    Before Start and after Stop, messages get written synchronously.
+*/
+class AsyncLog
+{
+    public:
+        static void     Start() ;
+        static void     Stop() ;
+        static void     Flush() ;
+
+        static bool     IsRunning() ;
+        static unsigned GetNumDropped() ;
+
+        static void     Printf( const char * format , ... ) ;
+        static void     FPrintf( FILE * stream , const char * format , ... ) ;
+        static void     VFPrintf( FILE * stream , const char * format , va_list args ) ;
+        static void     VFPrintfTransientFormat( FILE * stream , const char * format , va_list args ) ;
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -1,5 +1,19 @@
+/** Whether DebugPrintf goes through AsyncLog, so threads that print do not wait for each other or for stdout.
+
+    Messages still go to stdout.  Until AsyncLog::Start runs, they print synchronously.
+    Formats must be string literals, which every DebugPrintf in this code uses.
+*/
+#if ! defined( DEBUG_PRINTF_ASYNC )
+#   define DEBUG_PRINTF_ASYNC 1
+#endif
+
 #if defined( _DEBUG )
-    #include <stdio.h>
-    #define DebugPrintf printf
+    #if DEBUG_PRINTF_ASYNC
+        #include "Core/File/asyncLog.h"
+        #define DebugPrintf AsyncLog::Printf
+    #else
+        #include <stdio.h>
+        #define DebugPrintf printf
+    #endif
     #define UNIT_TEST
 #endif
\ No newline at end of file
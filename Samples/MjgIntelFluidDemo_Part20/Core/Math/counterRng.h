@@ -0,0 +1,237 @@
+/** \file counterRng.h
+
+    \brief Counter-based pseudo-random number generator, whose outputs depend only on a key and a counter, so threads can draw numbers in any order.
+
+    \author Written and Copyright 2005-2016 MJG; All rights reserved.
+*/
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <string.h>
+
+#include "Core/Utility/macros.h"
+
+#include "Core/Math/vec3.h"
+
+// Macros ----------------------------------------------------------------------
+
+/// Whether CounterRng::UniformBatch uses SSE2 intrinsics.  Otherwise it uses portable lane loops, which compilers can vectorize for other instruction sets.
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __SSE2__ )
+    #define COUNTER_RNG_USE_SSE2 1
+#else
+    #define COUNTER_RNG_USE_SSE2 0
+#endif
+
+#if COUNTER_RNG_USE_SSE2
+    #include <emmintrin.h>  // SSE2 intrinsics
+#endif
+
+// Types -----------------------------------------------------------------------
+
+/** Counter-based pseudo-random number generator (Philox4x32-10).
+
+    RandomSpread calls rand, whose hidden global state makes every caller
+    serial, and makes results depend on the order in which threads call
+    it.  Instead, this maps a 4-word counter to 4 pseudo-random words, with
+    a bijection keyed by a 2-word key, as in Salmon et al. 2011, "Parallel
+    Random Numbers: As Easy as 1, 2, 3".  It has no state to advance, so
+    callers choose counters that identify what each number is for (e.g.
+    particle index, frame and which draw), and get the same numbers no
+    matter which thread asks, or in which order.
+
+    Ten rounds of Philox pass BigCrush, and cost about 20 multiplies per 4 words.
+
+    UniformBatch generates numbers for 4 consecutive items at a time, in SIMD
+    lanes, for loops that need numbers for many items.
+*/
+class CounterRng
+{
+    public:
+        /// Construct generator with the given key.  Generators with different keys yield unrelated numbers for the same counters.
+        explicit CounterRng( unsigned seed = 0 , unsigned stream = 0 )
+        {
+            mKey[ 0 ] = seed ;
+            mKey[ 1 ] = stream ;
+        }
+
+        /** Generate 4 pseudo-random words for the given counter.
+        */
+        void Generate( unsigned bits[ 4 ] , unsigned c0 , unsigned c1 , unsigned c2 = 0 , unsigned c3 = 0 ) const
+        {
+            unsigned x[ 4 ] = { c0 , c1 , c2 , c3 } ;
+            unsigned k[ 2 ] = { mKey[ 0 ] , mKey[ 1 ] } ;
+            for( unsigned round = 0 ; round < NUM_ROUNDS ; ++ round )
+            {   // For each Philox round...
+                unsigned hi0 , lo0 , hi1 , lo1 ;
+                MulHiLo( hi0 , lo0 , MULTIPLIER_0 , x[ 0 ] ) ;
+                MulHiLo( hi1 , lo1 , MULTIPLIER_1 , x[ 2 ] ) ;
+                x[ 0 ] = hi1 ^ x[ 1 ] ^ k[ 0 ] ;
+                x[ 1 ] = lo1 ;
+                x[ 2 ] = hi0 ^ x[ 3 ] ^ k[ 1 ] ;
+                x[ 3 ] = lo0 ;
+                k[ 0 ] += WEYL_0 ;
+                k[ 1 ] += WEYL_1 ;
+            }
+            bits[ 0 ] = x[ 0 ] ;
+            bits[ 1 ] = x[ 1 ] ;
+            bits[ 2 ] = x[ 2 ] ;
+            bits[ 3 ] = x[ 3 ] ;
+        }
+
+
+        /** Generate 4 pseudo-random floats in [0,1) for the given counter.
+        */
+        void Uniform4( float values[ 4 ] , unsigned c0 , unsigned c1 , unsigned c2 = 0 , unsigned c3 = 0 ) const
+        {
+            unsigned bits[ 4 ] ;
+            Generate( bits , c0 , c1 , c2 , c3 ) ;
+            for( unsigned i = 0 ; i < 4 ; ++ i )
+            {
+                values[ i ] = UnitFromBits( bits[ i ] ) ;
+            }
+        }
+
+
+        /** Return pseudo-random value in [-spread/2,+spread/2), for the given counter, like RandomSpread.
+        */
+        float Spread( float spread , unsigned c0 , unsigned c1 , unsigned c2 = 0 ) const
+        {
+            unsigned bits[ 4 ] ;
+            Generate( bits , c0 , c1 , c2 , 0 ) ;
+            return spread * ( UnitFromBits( bits[ 0 ] ) - 0.5f ) ;
+        }
+
+
+        /** Return pseudo-random Vec3 whose components lie in [-spread/2,+spread/2), for the given counter, like RandomSpread.
+        */
+        Vec3 Spread( const Vec3 & vSpread , unsigned c0 , unsigned c1 , unsigned c2 = 0 ) const
+        {
+            unsigned bits[ 4 ] ;
+            Generate( bits , c0 , c1 , c2 , 0 ) ;
+            return Vec3( vSpread.x * ( UnitFromBits( bits[ 0 ] ) - 0.5f )
+                       , vSpread.y * ( UnitFromBits( bits[ 1 ] ) - 0.5f )
+                       , vSpread.z * ( UnitFromBits( bits[ 2 ] ) - 0.5f ) ) ;
+        }
+
+
+        /** Return pseudo-random Vec3 whose components lie in [-spread/2,+spread/2), keyed by the given position.
+
+            This suits callbacks that receive a position but no index, such
+            as vorticity distributions.  Distinct positions get unrelated
+            values, and the same position always gets the same value.
+        */
+        Vec3 SpreadAt( const Vec3 & vSpread , const Vec3 & vPosition ) const
+        {
+            return Spread( vSpread , BitsOfFloat( vPosition.x ) , BitsOfFloat( vPosition.y ) , BitsOfFloat( vPosition.z ) ) ;
+        }
+
+
+        /** Generate 4 pseudo-random floats in [0,1) for each of a range of items.
+
+            \param values - (out) Array of 4 * numItems floats.  Item i gets values[ 4*i ] through values[ 4*i+3 ].
+
+            \param numItems - Number of items to generate values for.
+
+            \param iItemBegin - Counter word 0 of first item.  Successive items use successive values.
+
+            \param c1 - Counter word 1, shared by all items, e.g. frame.
+
+            \param c2 - Counter word 2, shared by all items, e.g. which draw, for callers needing more than 4 values per item.
+
+            Results equal those of Uniform4( values + 4*i , iItemBegin + i , c1 , c2 , 0 ),
+            but this computes 4 items at a time, one per SIMD lane.
+        */
+        void UniformBatch( float * values , size_t numItems , unsigned iItemBegin , unsigned c1 , unsigned c2 = 0 ) const
+        {
+            size_t iItem = 0 ;
+        #if COUNTER_RNG_USE_SSE2
+            const __m128i   lanes       = _mm_set_epi32( 3 , 2 , 1 , 0 ) ;
+            const __m128    unitScale   = _mm_set1_ps( 1.0f / 16777216.0f ) ;
+            for( ; iItem + 4 <= numItems ; iItem += 4 )
+            {   // For each group of 4 items...
+                __m128i x0 = _mm_add_epi32( _mm_set1_epi32( int( iItemBegin + unsigned( iItem ) ) ) , lanes ) ;
+                __m128i x1 = _mm_set1_epi32( int( c1 ) ) ;
+                __m128i x2 = _mm_set1_epi32( int( c2 ) ) ;
+                __m128i x3 = _mm_setzero_si128() ;
+                unsigned k0 = mKey[ 0 ] ;
+                unsigned k1 = mKey[ 1 ] ;
+                for( unsigned round = 0 ; round < NUM_ROUNDS ; ++ round )
+                {   // For each Philox round, on 4 counters at once...
+                    __m128i hi0 , lo0 , hi1 , lo1 ;
+                    MulHiLo4( hi0 , lo0 , MULTIPLIER_0 , x0 ) ;
+                    MulHiLo4( hi1 , lo1 , MULTIPLIER_1 , x2 ) ;
+                    x0 = _mm_xor_si128( _mm_xor_si128( hi1 , x1 ) , _mm_set1_epi32( int( k0 ) ) ) ;
+                    x1 = lo1 ;
+                    x2 = _mm_xor_si128( _mm_xor_si128( hi0 , x3 ) , _mm_set1_epi32( int( k1 ) ) ) ;
+                    x3 = lo0 ;
+                    k0 += WEYL_0 ;
+                    k1 += WEYL_1 ;
+                }
+                // Convert top 24 bits of each word to [0,1).  Shifting right by 8 leaves values a signed conversion handles exactly.
+                __m128 u0 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( x0 , 8 ) ) , unitScale ) ;
+                __m128 u1 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( x1 , 8 ) ) , unitScale ) ;
+                __m128 u2 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( x2 , 8 ) ) , unitScale ) ;
+                __m128 u3 = _mm_mul_ps( _mm_cvtepi32_ps( _mm_srli_epi32( x3 , 8 ) ) , unitScale ) ;
+                // Lanes hold items, and registers hold words, so transpose to store each item's 4 words together.
+                _MM_TRANSPOSE4_PS( u0 , u1 , u2 , u3 ) ;
+                _mm_storeu_ps( values + 4 * iItem      , u0 ) ;
+                _mm_storeu_ps( values + 4 * iItem + 4  , u1 ) ;
+                _mm_storeu_ps( values + 4 * iItem + 8  , u2 ) ;
+                _mm_storeu_ps( values + 4 * iItem + 12 , u3 ) ;
+            }
+        #endif
+            for( ; iItem < numItems ; ++ iItem )
+            {   // For each remaining item...
+                Uniform4( values + 4 * iItem , iItemBegin + unsigned( iItem ) , c1 , c2 , 0 ) ;
+            }
+        }
+
+
+        /// Return float in [0,1) made from the top 24 bits of the given word.
+        static float UnitFromBits( unsigned bits )
+        {
+            return float( bits >> 8 ) * ( 1.0f / 16777216.0f ) ;
+        }
+
+    private:
+        static const unsigned NUM_ROUNDS    = 10 ;          ///< Number of Philox rounds.  Fewer than 7 fail statistical tests.
+        static const unsigned MULTIPLIER_0  = 0xD2511F53u ; ///< Philox4x32 multiplier for words 0 and 1.
+        static const unsigned MULTIPLIER_1  = 0xCD9E8D57u ; ///< Philox4x32 multiplier for words 2 and 3.
+        static const unsigned WEYL_0        = 0x9E3779B9u ; ///< Amount by which key word 0 increases each round (golden ratio).
+        static const unsigned WEYL_1        = 0xBB67AE85u ; ///< Amount by which key word 1 increases each round (sqrt(3)-1).
+
+        /// Compute high and low words of product of 2 words.
+        static void MulHiLo( unsigned & hi , unsigned & lo , unsigned a , unsigned b )
+        {
+            const unsigned long long product = static_cast< unsigned long long >( a ) * b ;
+            hi = static_cast< unsigned >( product >> 32 ) ;
+            lo = static_cast< unsigned >( product ) ;
+        }
+
+    #if COUNTER_RNG_USE_SSE2
+        /// Compute high and low words of products of the given word with each lane of b.
+        static void MulHiLo4( __m128i & hi , __m128i & lo , unsigned a , const __m128i & b )
+        {
+            const __m128i aa        = _mm_set1_epi32( int( a ) ) ;
+            const __m128i evenProd  = _mm_mul_epu32( b , aa ) ;                         // 64-bit products of lanes 0 and 2.
+            const __m128i oddProd   = _mm_mul_epu32( _mm_srli_epi64( b , 32 ) , aa ) ;  // 64-bit products of lanes 1 and 3.
+            lo = _mm_unpacklo_epi32( _mm_shuffle_epi32( evenProd , _MM_SHUFFLE( 0 , 0 , 2 , 0 ) ) , _mm_shuffle_epi32( oddProd , _MM_SHUFFLE( 0 , 0 , 2 , 0 ) ) ) ;
+            hi = _mm_unpacklo_epi32( _mm_shuffle_epi32( evenProd , _MM_SHUFFLE( 0 , 0 , 3 , 1 ) ) , _mm_shuffle_epi32( oddProd , _MM_SHUFFLE( 0 , 0 , 3 , 1 ) ) ) ;
+        }
+    #endif
+
+        /// Return bits of the given float, as a word.
+        static unsigned BitsOfFloat( float value )
+        {
+            unsigned bits ;
+            memcpy( & bits , & value , sizeof( bits ) ) ;
+            return bits ;
+        }
+
+        unsigned mKey[ 2 ] ;    ///< Key that selects which of many unrelated bijections this generator computes.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
@@ -0,0 +1,197 @@
+/** \file fft.cpp
+
+    \brief Fast Fourier transform of complex sequences of any length
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+
+*/
+
+#include "fft.h"
+
+#include "Core/Performance/perfBlock.h"
+#include "Core/Utility/macros.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Private variables --------------------------------------------------------------
+
+static const double sTwoPi = 6.283185307179586476925286766559 ;
+
+// Public functions --------------------------------------------------------------
+
+/** Return smallest power of two no smaller than n.
+*/
+/* static */ size_t FftPlan::NextPowerOfTwo( size_t n )
+{
+    size_t powerOfTwo = 1 ;
+    while( powerOfTwo < n )
+    {
+        powerOfTwo <<= 1 ;
+    }
+    return powerOfTwo ;
+}
+
+
+
+
+/** Precompute factors Transform uses, for sequences of the given length.
+
+    \param length   Number of elements of sequences to transform.  Must be positive.
+*/
+void FftPlan::Init( size_t length )
+{
+    PERF_BLOCK( FftPlan__Init ) ;
+
+    ASSERT( length > 0 ) ;
+
+    mLength = length ;
+    mChirp.Clear() ;
+    mChirpSpectrum.Clear() ;
+
+    if( IsPowerOfTwo( length ) )
+    {
+        mConvolutionLength = 0 ;
+        MakeTwiddles( mTwiddles , length ) ;
+        return ;
+    }
+
+    // Bluestein's algorithm uses j k = ( j^2 + k^2 - (k-j)^2 ) / 2 to rewrite
+    // X[k] = chirp[k] sum_j ( x[j] chirp[j] ) conj( chirp[k-j] ),
+    // which is a convolution, computed here as a cyclic convolution whose
+    // length is a power of two long enough to avoid wrapping.
+    mConvolutionLength = NextPowerOfTwo( 2 * length - 1 ) ;
+    MakeTwiddles( mTwiddles , mConvolutionLength ) ;
+
+    mChirp.Resize( length ) ;
+    for( size_t k = 0 ; k < length ; ++ k )
+    {   // For each element...
+        // Reduce k^2 modulo 2 length before converting to angle, to retain precision for large k.
+        const size_t    kSquaredMod = ( k * k ) % ( 2 * length ) ;
+        const double    angle       = - 0.5 * sTwoPi * double( kSquaredMod ) / double( length ) ;
+        mChirp[ k ] = Complex( float( cos( angle ) ) , float( sin( angle ) ) ) ;
+    }
+
+    mChirpSpectrum.Resize( mConvolutionLength , Complex( 0.0f , 0.0f ) ) ;
+    const float oneOverConvolutionLength = 1.0f / float( mConvolutionLength ) ;
+    mChirpSpectrum[ 0 ] = std::conj( mChirp[ 0 ] ) * oneOverConvolutionLength ;
+    for( size_t k = 1 ; k < length ; ++ k )
+    {   // For each element after the first, place conjugate chirp at both k and -k, since convolution uses negative offsets.
+        mChirpSpectrum[ k ]                         = std::conj( mChirp[ k ] ) * oneOverConvolutionLength ;
+        mChirpSpectrum[ mConvolutionLength - k ]    = mChirpSpectrum[ k ] ;
+    }
+    TransformPowerOfTwo( & mChirpSpectrum[ 0 ] , mConvolutionLength , mTwiddles , false ) ;
+}
+
+
+
+
+/** Compute discrete Fourier transform of the given sequence, in place.
+
+    \param data     (in/out) GetLength values to transform.
+
+    \param inverse  Whether to compute inverse transform, which uses exp( +2 pi i j k / n ) and does not divide by n.
+
+    \param scratch  GetScratchSize values of space this can overwrite, or NULL if that is zero.
+*/
+void FftPlan::Transform( Complex * data , bool inverse , Complex * scratch ) const
+{
+    ASSERT( mLength > 0 ) ; // Must call Init first.
+
+    if( 0 == mConvolutionLength )
+    {
+        TransformPowerOfTwo( data , mLength , mTwiddles , inverse ) ;
+        return ;
+    }
+
+    ASSERT( scratch != NULLPTR ) ;
+
+    // Inverse transform is conjugate of forward transform of conjugate.
+    for( size_t k = 0 ; k < mLength ; ++ k )
+    {   // For each element, weight by chirp.
+        const Complex value = inverse ? std::conj( data[ k ] ) : data[ k ] ;
+        scratch[ k ] = value * mChirp[ k ] ;
+    }
+    for( size_t k = mLength ; k < mConvolutionLength ; ++ k )
+    {   // For each element in padding...
+        scratch[ k ] = Complex( 0.0f , 0.0f ) ;
+    }
+
+    // Convolve with conjugate chirp.
+    TransformPowerOfTwo( scratch , mConvolutionLength , mTwiddles , false ) ;
+    for( size_t k = 0 ; k < mConvolutionLength ; ++ k )
+    {
+        scratch[ k ] *= mChirpSpectrum[ k ] ;
+    }
+    TransformPowerOfTwo( scratch , mConvolutionLength , mTwiddles , true ) ;
+
+    for( size_t k = 0 ; k < mLength ; ++ k )
+    {   // For each element, weight by chirp again.
+        const Complex value = scratch[ k ] * mChirp[ k ] ;
+        data[ k ] = inverse ? std::conj( value ) : value ;
+    }
+}
+
+
+
+
+/** Assign twiddle factors exp( -2 pi i k / n ) for k in [0,n/2).
+*/
+/* static */ void FftPlan::MakeTwiddles( VECTOR< Complex > & twiddles , size_t n )
+{
+    twiddles.Resize( Max2( n / 2 , size_t( 1 ) ) ) ;
+    for( size_t k = 0 ; k < twiddles.Size() ; ++ k )
+    {
+        const double angle = - sTwoPi * double( k ) / double( n ) ;
+        twiddles[ k ] = Complex( float( cos( angle ) ) , float( sin( angle ) ) ) ;
+    }
+}
+
+
+
+
+/** Compute discrete Fourier transform of a sequence whose length is a power of two, in place, using iterative radix-2 Cooley-Tukey.
+
+    \param twiddles     Twiddle factors for length n, from MakeTwiddles.
+*/
+/* static */ void FftPlan::TransformPowerOfTwo( Complex * data , size_t n , const VECTOR< Complex > & twiddles , bool inverse )
+{
+    ASSERT( IsPowerOfTwo( n ) ) ;
+    ASSERT( twiddles.Size() == Max2( n / 2 , size_t( 1 ) ) ) ;
+
+    // Permute into bit-reversed order.
+    for( size_t i = 1 , j = 0 ; i < n ; ++ i )
+    {
+        size_t bit = n >> 1 ;
+        for( ; j & bit ; bit >>= 1 )
+        {
+            j ^= bit ;
+        }
+        j ^= bit ;
+        if( i < j )
+        {
+            std::swap( data[ i ] , data[ j ] ) ;
+        }
+    }
+
+    // Combine pairs of half-length transforms, doubling length each pass.
+    for( size_t halfLength = 1 ; halfLength < n ; halfLength <<= 1 )
+    {   // For each pass...
+        const size_t twiddleStride = n / ( 2 * halfLength ) ;
+        for( size_t start = 0 ; start < n ; start += 2 * halfLength )
+        {   // For each pair of half-length transforms...
+            for( size_t k = 0 ; k < halfLength ; ++ k )
+            {   // For each butterfly...
+                const Complex & twiddleForward  = twiddles[ k * twiddleStride ] ;
+                const Complex   twiddle         = inverse ? std::conj( twiddleForward ) : twiddleForward ;
+                Complex &       even            = data[ start + k ] ;
+                Complex &       odd             = data[ start + k + halfLength ] ;
+                const Complex   oddTwiddled     = odd * twiddle ;
+                odd  = even - oddTwiddled ;
+                even = even + oddTwiddled ;
+            }
+        }
+    }
+}
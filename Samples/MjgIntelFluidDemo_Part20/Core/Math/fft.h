@@ -0,0 +1,72 @@
+/** \file fft.h
+
+    \brief Fast Fourier transform of complex sequences of any length
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+
+*/
+#ifndef FFT_H
+#define FFT_H
+
+#include "Core/Containers/vector.h"
+
+#include <complex>
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+typedef std::complex< float > Complex ;
+
+
+
+
+/** Plan for computing discrete Fourier transforms of complex sequences of one length.
+
+    Transform computes X[k] = sum_j x[j] exp( -2 pi i j k / n ) in place,
+    or the inverse, which omits the 1/n factor, so callers can fold it
+    into other scaling.
+
+    Power-of-two lengths use iterative radix-2 Cooley-Tukey.  Other lengths
+    use Bluestein's algorithm, which re-expresses the transform as a
+    convolution of power-of-two length, so every length costs O(n log n),
+    albeit about 3 times more than the next power of two.
+
+    A plan is read-only after Init, so threads can share one, as long as
+    each passes its own scratch space.
+*/
+class FftPlan
+{
+    public:
+        FftPlan() : mLength( 0 ) , mConvolutionLength( 0 ) {}
+
+        void    Init( size_t length ) ;
+
+        /// Return length of sequences this plan transforms.
+        size_t  GetLength() const       { return mLength ; }
+
+        /// Return number of Complex values of scratch space Transform needs.  Zero for powers of two.
+        size_t  GetScratchSize() const  { return mConvolutionLength ; }
+
+        void    Transform( Complex * data , bool inverse , Complex * scratch ) const ;
+
+        static bool     IsPowerOfTwo( size_t n )    { return ( n > 0 ) && ( 0 == ( n & ( n - 1 ) ) ) ; }
+        static size_t   NextPowerOfTwo( size_t n ) ;
+
+    private:
+        static void MakeTwiddles( VECTOR< Complex > & twiddles , size_t n ) ;
+        static void TransformPowerOfTwo( Complex * data , size_t n , const VECTOR< Complex > & twiddles , bool inverse ) ;
+
+        size_t              mLength             ;   ///< Length of sequences this plan transforms.
+        size_t              mConvolutionLength  ;   ///< Power-of-two length of Bluestein convolution, or zero when mLength is a power of two.
+        VECTOR< Complex >   mTwiddles           ;   ///< exp( -2 pi i k / m ) for k in [0,m/2), where m is mLength or mConvolutionLength, whichever is a power of two.
+        VECTOR< Complex >   mChirp              ;   ///< exp( -pi i k^2 / mLength ) for k in [0,mLength), for Bluestein's algorithm.
+        VECTOR< Complex >   mChirpSpectrum      ;   ///< Transform of conjugate chirp, wrapped to mConvolutionLength and scaled by 1/mConvolutionLength.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
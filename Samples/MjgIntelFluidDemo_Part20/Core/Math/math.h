@@ -14,6 +14,10 @@
 
 #include "Core/Utility/macros.h" // for ASSERT
 
+#if defined( _MSC_VER ) && ( _MSC_VER >= 1400 )
+    #include <intrin.h> // For _BitScanForward
+#endif
+
 // Macros ----------------------------------------------------------------------
 // Types -----------------------------------------------------------------------
 
@@ -177,6 +181,38 @@ inline size_t NearestPowerOfTwo( size_t iVal )
 
 
 
+/** Return index of the least significant set bit of the given nonzero word.
+
+    \param word - 64-bit word, which must have at least one bit set.
+*/
+inline unsigned LowestSetBitIndex( unsigned long long word )
+{
+    ASSERT( word != 0 ) ;
+#if defined( _MSC_VER ) && ( _MSC_VER >= 1400 )
+    // Scan 32 bits at a time, since _BitScanForward64 exists only on 64-bit targets.
+    unsigned long index ;
+    if( _BitScanForward( & index , static_cast< unsigned long >( word ) ) )
+    {
+        return index ;
+    }
+    _BitScanForward( & index , static_cast< unsigned long >( word >> 32 ) ) ;
+    return index + 32 ;
+#elif defined( __GNUC__ )
+    return static_cast< unsigned >( __builtin_ctzll( word ) ) ;
+#else
+    unsigned index = 0 ;
+    while( 0 == ( word & 1 ) )
+    {
+        word >>= 1 ;
+        ++ index ;
+    }
+    return index ;
+#endif
+}
+
+
+
+
 /** Generate a pseudo-random floating-point number.
     \param fSpread - range of output values from -fSpread/2 to +fSpread/2
 */
@@ -344,6 +380,47 @@ inline float ImpreciseSinF( float angleInRadians )
 
 
 
+/** Compute exponential of given value, approximately.
+
+    This writes exp(x) as 2^i 2^f, where i=floor(x log2(e)) and f is the
+    fractional remainder, assembles 2^i directly in the exponent bits of an
+    IEEE 754 float, and approximates 2^f with a polynomial in f-1/2, which
+    keeps relative error below 1e-5.
+
+    \return exp(x), or zero when x is so negative that exp(x) would be denormal.
+*/
+inline float ImpreciseExpF( float x )
+{
+    static const float LOG2_E   =  1.4426950408889634f ;
+    static const float SQRT_2   =  1.4142135623730950f ;
+    static const float ARG_MIN  = -87.0f ;   // exp(ARG_MIN) is near the smallest normalized float.
+    static const float ARG_MAX  =  88.0f ;   // exp(ARG_MAX) is near the largest float.
+    // Taylor coefficients of 2^g = exp( g ln 2 ), i.e. (ln 2)^k / k!.
+    static const float c1 = 0.69314718f ;
+    static const float c2 = 0.24022651f ;
+    static const float c3 = 0.05550411f ;
+    static const float c4 = 0.00961813f ;
+    static const float c5 = 0.00133336f ;
+    if( x < ARG_MIN )
+    {
+        return 0.0f ;
+    }
+    const float t           = Min2( x , ARG_MAX ) * LOG2_E ;
+    int         exponent    = int( t ) ;
+    if( t < float( exponent ) )
+    {   // Conversion truncated toward zero; round toward negative infinity instead.
+        -- exponent ;
+    }
+    const float g           = t - float( exponent ) - 0.5f ;    // In [-1/2,1/2).
+    const float pow2Frac    = SQRT_2 * ( 1.0f + g * ( c1 + g * ( c2 + g * ( c3 + g * ( c4 + g * c5 ) ) ) ) ) ;
+    long        bits        = long( exponent + 127 ) << 23 ;    // Exploit IEEE 754 inner workings.
+    const float pow2Int     = (float&) bits ;
+    return pow2Int * pow2Frac ;
+}
+
+
+
+
 #if defined( WIN32 ) // && defined( __MACHINEI ) // Accelerated for x86
 
 /** Set multimedia extended control status register.
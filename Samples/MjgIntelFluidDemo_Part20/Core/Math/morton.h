@@ -0,0 +1,73 @@
+/** \file morton.h
+
+    \brief Morton (Z-order) codes, which interleave the bits of 3 integer coordinates into one key.
+
+    \author Written and Copyright 2005-2016 MJG; All rights reserved.
+*/
+#ifndef MORTON_H
+#define MORTON_H
+
+#include "Core/Utility/macros.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+// Public variables ------------------------------------------------------------
+
+static const unsigned MORTON_BITS_PER_AXIS  = 10 ;                                  ///< Number of bits of each coordinate that a 32-bit Morton key holds.
+static const unsigned MORTON_MAX_COORD      = ( 1 << MORTON_BITS_PER_AXIS ) - 1 ;   ///< Largest coordinate a 32-bit Morton key holds.
+
+// Public functions ------------------------------------------------------------
+
+/** Spread the lower 10 bits of the given value so that 2 zero bits separate each.
+
+    For example, binary 111 becomes 1001001.
+*/
+inline unsigned MortonSpreadBitsBy2( unsigned value )
+{
+    value &= 0x000003ff ;
+    value = ( value ^ ( value << 16 ) ) & 0xff0000ff ;
+    value = ( value ^ ( value <<  8 ) ) & 0x0300f00f ;
+    value = ( value ^ ( value <<  4 ) ) & 0x030c30c3 ;
+    value = ( value ^ ( value <<  2 ) ) & 0x09249249 ;
+    return value ;
+}
+
+
+
+
+/** Gather every third bit of the given value into its lower 10 bits.  Inverse of MortonSpreadBitsBy2.
+*/
+inline unsigned MortonCompactBitsBy2( unsigned value )
+{
+    value &= 0x09249249 ;
+    value = ( value ^ ( value >>  2 ) ) & 0x030c30c3 ;
+    value = ( value ^ ( value >>  4 ) ) & 0x0300f00f ;
+    value = ( value ^ ( value >>  8 ) ) & 0xff0000ff ;
+    value = ( value ^ ( value >> 16 ) ) & 0x000003ff ;
+    return value ;
+}
+
+
+
+
+/** Return Morton key of the given coordinates, each at most MORTON_MAX_COORD, with x in the least significant bit.
+*/
+inline unsigned MortonEncode( unsigned ix , unsigned iy , unsigned iz )
+{
+    ASSERT( ( ix <= MORTON_MAX_COORD ) && ( iy <= MORTON_MAX_COORD ) && ( iz <= MORTON_MAX_COORD ) ) ;
+    return MortonSpreadBitsBy2( ix ) | ( MortonSpreadBitsBy2( iy ) << 1 ) | ( MortonSpreadBitsBy2( iz ) << 2 ) ;
+}
+
+
+
+
+/** Recover coordinates from the given Morton key.  Inverse of MortonEncode.
+*/
+inline void MortonDecode( unsigned indices[ 3 ] , unsigned key )
+{
+    indices[ 0 ] = MortonCompactBitsBy2( key      ) ;
+    indices[ 1 ] = MortonCompactBitsBy2( key >> 1 ) ;
+    indices[ 2 ] = MortonCompactBitsBy2( key >> 2 ) ;
+}
+
+#endif
@@ -0,0 +1,345 @@
+/** \file vec3x4.h
+
+    \brief Packed 4-wide float, 3-vector and 3x3 matrix types, in structure-of-arrays layout, for kernels that process 4 items at a time.
+
+    \author Copyright 2005-2012 MJG; All rights reserved.
+*/
+#ifndef VEC3X4_H
+#define VEC3X4_H
+
+#include "Core/Utility/macros.h"
+
+#include "Core/Math/vec3.h"
+#include "Core/Math/mat33.h"
+
+// Macros ----------------------------------------------------------------------
+
+/// Whether Float4 uses SSE intrinsics.  Otherwise it uses portable lane loops, which compilers can vectorize for other instruction sets.
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __SSE__ )
+    #define VEC3X4_USE_SSE 1
+#else
+    #define VEC3X4_USE_SSE 0
+#endif
+
+#if VEC3X4_USE_SSE
+    #include <xmmintrin.h>  // SSE intrinsics
+#endif
+
+// Types -----------------------------------------------------------------------
+
+/** Four floats, operated on together.
+
+    Comparisons return a mask, i.e. a Float4 whose lanes are either all bits
+    set or all bits clear, which Select consumes.  Callers should treat masks
+    as opaque.
+
+    Loads and stores need not be aligned.
+*/
+struct Float4
+{
+    public:
+        static const unsigned WIDTH = 4 ;   ///< Number of lanes.
+
+        /// Construct an uninitialized Float4.
+        Float4() {}
+
+        /// Construct a Float4 with the same value in every lane.
+        explicit Float4( float value )
+        {
+        #if VEC3X4_USE_SSE
+            mLanes = _mm_set1_ps( value ) ;
+        #else
+            mLanes[ 0 ] = mLanes[ 1 ] = mLanes[ 2 ] = mLanes[ 3 ] = value ;
+        #endif
+        }
+
+        /// Return Float4 loaded from WIDTH consecutive floats.
+        static Float4 Load( const float * src )
+        {
+            Float4 result ;
+        #if VEC3X4_USE_SSE
+            result.mLanes = _mm_loadu_ps( src ) ;
+        #else
+            for( unsigned iLane = 0 ; iLane < WIDTH ; ++ iLane ) result.mLanes[ iLane ] = src[ iLane ] ;
+        #endif
+            return result ;
+        }
+
+        /// Store lanes into WIDTH consecutive floats.
+        void Store( float * dst ) const
+        {
+        #if VEC3X4_USE_SSE
+            _mm_storeu_ps( dst , mLanes ) ;
+        #else
+            for( unsigned iLane = 0 ; iLane < WIDTH ; ++ iLane ) dst[ iLane ] = mLanes[ iLane ] ;
+        #endif
+        }
+
+        /// Return sum of all lanes.
+        float HorizontalSum() const
+        {
+            float lanes[ WIDTH ] ;
+            Store( lanes ) ;
+            return ( lanes[ 0 ] + lanes[ 1 ] ) + ( lanes[ 2 ] + lanes[ 3 ] ) ;
+        }
+
+    #if VEC3X4_USE_SSE
+        Float4 operator+( const Float4 & rhs ) const { return Float4( _mm_add_ps( mLanes , rhs.mLanes ) ) ; }
+        Float4 operator-( const Float4 & rhs ) const { return Float4( _mm_sub_ps( mLanes , rhs.mLanes ) ) ; }
+        Float4 operator*( const Float4 & rhs ) const { return Float4( _mm_mul_ps( mLanes , rhs.mLanes ) ) ; }
+        Float4 operator/( const Float4 & rhs ) const { return Float4( _mm_div_ps( mLanes , rhs.mLanes ) ) ; }
+        Float4 operator-() const                     { return Float4( _mm_sub_ps( _mm_setzero_ps() , mLanes ) ) ; }
+
+        /// Return mask of lanes where this is less than rhs.
+        Float4 LessThan( const Float4 & rhs ) const  { return Float4( _mm_cmplt_ps( mLanes , rhs.mLanes ) ) ; }
+
+        /// Return, per lane, onTrue where mask is set, otherwise onFalse.  Discards inf and NaN in unselected lanes.
+        static Float4 Select( const Float4 & mask , const Float4 & onTrue , const Float4 & onFalse )
+        {
+            return Float4( _mm_or_ps( _mm_and_ps( mask.mLanes , onTrue.mLanes ) , _mm_andnot_ps( mask.mLanes , onFalse.mLanes ) ) ) ;
+        }
+
+        /// Return per-lane minimum.
+        static Float4 Min( const Float4 & a , const Float4 & b ) { return Float4( _mm_min_ps( a.mLanes , b.mLanes ) ) ; }
+
+        /// Return per-lane maximum.
+        static Float4 Max( const Float4 & a , const Float4 & b ) { return Float4( _mm_max_ps( a.mLanes , b.mLanes ) ) ; }
+
+        /// Return per-lane square root.
+        Float4 Sqrt() const { return Float4( _mm_sqrt_ps( mLanes ) ) ; }
+
+        /** Return per-lane approximate reciprocal square root.
+
+            Refines the hardware estimate with one Newton iteration, like finvsqrtf.
+        */
+        Float4 InvSqrt() const
+        {
+            const __m128 estimate = _mm_rsqrt_ps( mLanes ) ;
+            return Float4( _mm_mul_ps( estimate , _mm_sub_ps( _mm_set1_ps( 1.5f ) , _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5f ) , mLanes ) , _mm_mul_ps( estimate , estimate ) ) ) ) ) ;
+        }
+
+    private:
+        explicit Float4( const __m128 & lanes ) : mLanes( lanes ) {}
+
+        __m128  mLanes  ;   ///< Lane values.
+    #else
+        Float4 operator+( const Float4 & rhs ) const { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = mLanes[ i ] + rhs.mLanes[ i ] ; return r ; }
+        Float4 operator-( const Float4 & rhs ) const { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = mLanes[ i ] - rhs.mLanes[ i ] ; return r ; }
+        Float4 operator*( const Float4 & rhs ) const { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = mLanes[ i ] * rhs.mLanes[ i ] ; return r ; }
+        Float4 operator/( const Float4 & rhs ) const { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = mLanes[ i ] / rhs.mLanes[ i ] ; return r ; }
+        Float4 operator-() const                     { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = - mLanes[ i ] ; return r ; }
+
+        /// Return mask of lanes where this is less than rhs.
+        Float4 LessThan( const Float4 & rhs ) const  { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = ( mLanes[ i ] < rhs.mLanes[ i ] ) ? 1.0f : 0.0f ; return r ; }
+
+        /// Return, per lane, onTrue where mask is set, otherwise onFalse.
+        static Float4 Select( const Float4 & mask , const Float4 & onTrue , const Float4 & onFalse )
+        {
+            Float4 r ;
+            for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = ( mask.mLanes[ i ] != 0.0f ) ? onTrue.mLanes[ i ] : onFalse.mLanes[ i ] ; // Select, which compilers emit as a blend.
+            return r ;
+        }
+
+        /// Return per-lane minimum.
+        static Float4 Min( const Float4 & a , const Float4 & b ) { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = Min2( a.mLanes[ i ] , b.mLanes[ i ] ) ; return r ; }
+
+        /// Return per-lane maximum.
+        static Float4 Max( const Float4 & a , const Float4 & b ) { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = Max2( a.mLanes[ i ] , b.mLanes[ i ] ) ; return r ; }
+
+        /// Return per-lane square root.
+        Float4 Sqrt() const { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = sqrtf( mLanes[ i ] ) ; return r ; }
+
+        /// Return per-lane approximate reciprocal square root, using finvsqrtf.
+        Float4 InvSqrt() const { Float4 r ; for( unsigned i = 0 ; i < WIDTH ; ++ i ) r.mLanes[ i ] = finvsqrtf( mLanes[ i ] ) ; return r ; }
+
+    private:
+        float   mLanes[ WIDTH ] ;   ///< Lane values.
+    #endif
+} ;
+
+/// Return Float4 scaled by a scalar.
+inline Float4 operator*( float scale , const Float4 & rhs ) { return Float4( scale ) * rhs ; }
+
+
+
+
+/** Four 3-vectors, operated on together, stored as one Float4 per component.
+
+    Operators follow the conventions of Vec3:  "*" between vectors is the dot
+    product and "^" is the cross product.
+*/
+struct Vec3x4
+{
+    public:
+        /// Construct an uninitialized Vec3x4.
+        Vec3x4() {}
+
+        /// Construct a Vec3x4 from its component lanes.
+        Vec3x4( const Float4 & x0 , const Float4 & y0 , const Float4 & z0 )
+            : x( x0 )
+            , y( y0 )
+            , z( z0 )
+        {}
+
+        /// Construct a Vec3x4 with the same vector in every lane.
+        explicit Vec3x4( const Vec3 & v )
+            : x( v.x )
+            , y( v.y )
+            , z( v.z )
+        {}
+
+        /// Return Vec3x4 loaded from structure-of-arrays components, each with Float4::WIDTH consecutive floats.
+        static Vec3x4 Load( const float * px , const float * py , const float * pz )
+        {
+            return Vec3x4( Float4::Load( px ) , Float4::Load( py ) , Float4::Load( pz ) ) ;
+        }
+
+        /// Return Vec3x4 loaded from Float4::WIDTH consecutive Vec3 objects, transposing them into lanes.
+        static Vec3x4 LoadTranspose( const Vec3 * src )
+        {
+            float px[ Float4::WIDTH ] , py[ Float4::WIDTH ] , pz[ Float4::WIDTH ] ;
+            for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+            {   // For each lane...
+                px[ iLane ] = src[ iLane ].x ;
+                py[ iLane ] = src[ iLane ].y ;
+                pz[ iLane ] = src[ iLane ].z ;
+            }
+            return Load( px , py , pz ) ;
+        }
+
+        /** Return Vec3x4 loaded from up to Float4::WIDTH Vec3 objects the given number of bytes apart, transposing them into lanes.
+
+            Lanes past numValid replicate the last valid vector, so they compute harmless values.
+            This suits gathering positions out of arrays of larger structures, such as particles.
+        */
+        static Vec3x4 LoadTransposeStrided( const Vec3 * first , size_t strideInBytes , unsigned numValid )
+        {
+            ASSERT( ( numValid > 0 ) && ( numValid <= Float4::WIDTH ) ) ;
+            float px[ Float4::WIDTH ] , py[ Float4::WIDTH ] , pz[ Float4::WIDTH ] ;
+            for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+            {   // For each lane...
+                const unsigned iSrc = Min2( iLane , numValid - 1 ) ;
+                const Vec3 & src = * reinterpret_cast< const Vec3 * >( reinterpret_cast< const char * >( first ) + iSrc * strideInBytes ) ;
+                px[ iLane ] = src.x ;
+                py[ iLane ] = src.y ;
+                pz[ iLane ] = src.z ;
+            }
+            return Load( px , py , pz ) ;
+        }
+
+        /// Store lanes into structure-of-arrays components, each with Float4::WIDTH consecutive floats.
+        void Store( float * px , float * py , float * pz ) const
+        {
+            x.Store( px ) ;
+            y.Store( py ) ;
+            z.Store( pz ) ;
+        }
+
+        /// Store lanes into Float4::WIDTH consecutive Vec3 objects, transposing them out of lanes.
+        void StoreTranspose( Vec3 * dst ) const
+        {
+            float px[ Float4::WIDTH ] , py[ Float4::WIDTH ] , pz[ Float4::WIDTH ] ;
+            Store( px , py , pz ) ;
+            for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+            {   // For each lane...
+                dst[ iLane ] = Vec3( px[ iLane ] , py[ iLane ] , pz[ iLane ] ) ;
+            }
+        }
+
+        /// Return sum of all lanes.
+        Vec3 HorizontalSum() const { return Vec3( x.HorizontalSum() , y.HorizontalSum() , z.HorizontalSum() ) ; }
+
+        Vec3x4 operator+( const Vec3x4 & rhs ) const { return Vec3x4( x + rhs.x , y + rhs.y , z + rhs.z ) ; }
+        Vec3x4 operator-( const Vec3x4 & rhs ) const { return Vec3x4( x - rhs.x , y - rhs.y , z - rhs.z ) ; }
+        Vec3x4 operator-() const                     { return Vec3x4( - x , - y , - z ) ; }
+
+        /// Return vectors scaled per lane.
+        Vec3x4 operator*( const Float4 & scale ) const { return Vec3x4( x * scale , y * scale , z * scale ) ; }
+
+        /// Return dot product per lane.
+        Float4 operator*( const Vec3x4 & rhs ) const { return x * rhs.x + y * rhs.y + z * rhs.z ; }
+
+        /// Return cross product per lane.
+        Vec3x4 operator^( const Vec3x4 & rhs ) const
+        {
+            return Vec3x4( y * rhs.z - z * rhs.y
+                         , z * rhs.x - x * rhs.z
+                         , x * rhs.y - y * rhs.x ) ;
+        }
+
+        /// Return squared magnitude per lane.
+        Float4 Mag2() const { return x * x + y * y + z * z ; }
+
+        /// Return magnitude per lane.
+        Float4 Magnitude() const { return Mag2().Sqrt() ; }
+
+        /** Return approximately unit-length vectors with the same direction, using Float4::InvSqrt.
+
+            Lanes with zero magnitude yield inf or NaN, as Vec3::Normalize would assert on.
+        */
+        Vec3x4 GetDir() const { return ( * this ) * Mag2().InvSqrt() ; }
+
+        Float4 x ;  ///< x-components
+        Float4 y ;  ///< y-components
+        Float4 z ;  ///< z-components
+} ;
+
+/// Return vectors scaled per lane.
+inline Vec3x4 operator*( const Float4 & scale , const Vec3x4 & rhs ) { return rhs * scale ; }
+
+
+
+
+/** Four 3x3 matrices, operated on together, stored as one Vec3x4 per column, like Mat33.
+*/
+struct Mat33x4
+{
+    public:
+        /// Construct an uninitialized Mat33x4.
+        Mat33x4() {}
+
+        /// Construct a Mat33x4 from its column lanes.
+        Mat33x4( const Vec3x4 & x0 , const Vec3x4 & y0 , const Vec3x4 & z0 )
+            : x( x0 )
+            , y( y0 )
+            , z( z0 )
+        {}
+
+        /// Construct a Mat33x4 with the same matrix in every lane.
+        explicit Mat33x4( const Mat33 & m )
+            : x( m.x )
+            , y( m.y )
+            , z( m.z )
+        {}
+
+        /// Return Mat33x4 loaded from Float4::WIDTH consecutive Mat33 objects, transposing them into lanes.
+        static Mat33x4 LoadTranspose( const Mat33 * src )
+        {
+            Vec3 cols[ 3 ][ Float4::WIDTH ] ;
+            for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+            {   // For each lane...
+                cols[ 0 ][ iLane ] = src[ iLane ].x ;
+                cols[ 1 ][ iLane ] = src[ iLane ].y ;
+                cols[ 2 ][ iLane ] = src[ iLane ].z ;
+            }
+            return Mat33x4( Vec3x4::LoadTranspose( cols[ 0 ] ) , Vec3x4::LoadTranspose( cols[ 1 ] ) , Vec3x4::LoadTranspose( cols[ 2 ] ) ) ;
+        }
+
+        /// Return vectors transformed by these matrices, per lane.  \see Mat33::Transform.
+        Vec3x4 Transform( const Vec3x4 & v ) const { return x * v.x + y * v.y + z * v.z ; }
+
+        /// Return vectors transformed by these matrices, per lane.
+        Vec3x4 operator*( const Vec3x4 & v ) const { return Transform( v ) ; }
+
+        /// Return vectors transformed by the transposes of these matrices, per lane.  \see Mat33::TransformByTranspose.
+        Vec3x4 TransformByTranspose( const Vec3x4 & v ) const { return Vec3x4( x * v , y * v , z * v ) ; }
+
+        Vec3x4 x ;  ///< x-columns
+        Vec3x4 y ;  ///< y-columns
+        Vec3x4 z ;  ///< z-columns
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
@@ -0,0 +1,79 @@
+/** \file firstTouchAllocator.cpp
+
+    \brief Standard-library allocator that places large blocks near the threads that will use them.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "Core/Memory/firstTouchAllocator.h"
+
+#include "Core/parallelExecution.h"
+#include "Core/Performance/perfBlock.h"
+
+// Private variables --------------------------------------------------------------
+
+static const size_t sPageSize = 4096 ;  ///< Smallest page size of supported platforms.  Touching more often than each page is harmless.
+
+// Private functions --------------------------------------------------------------
+
+#if USE_TBB
+/** Touch pages of a block of memory, so the operating system places them near the touching thread.
+
+    \param memory      First byte of block whose pages to touch.
+
+    \param numBytes    Number of bytes in block.
+
+    \param iPageStart  Index of first page to touch.
+
+    \param iPageEnd    One past index of last page to touch.
+*/
+static void TouchPagesSlice( char * memory , size_t numBytes , size_t iPageStart , size_t iPageEnd )
+{
+    for( size_t iPage = iPageStart ; iPage < iPageEnd ; ++ iPage )
+    {   // For each page in subrange...
+        const size_t iByte = iPage * sPageSize ;
+        if( iByte < numBytes )
+        {   // Last page can be partial, and block need not start on a page boundary, so stay inside the block.
+            memory[ iByte ] = 0 ;
+        }
+    }
+}
+#endif
+
+
+
+
+// Public functions --------------------------------------------------------------
+
+/** Touch each page of the given block of memory, in parallel, so pages get placed on the memory node of the thread that touches them.
+
+    \param memory   Raw memory, holding no objects yet.  This overwrites some of its bytes.
+
+    \param numBytes Number of bytes in block.
+
+    This gives each thread one contiguous share of pages, so pages land in
+    long runs, rather than interleaved page by page, which would make every
+    kernel straddle nodes.  When USE_TBB is 0, or inside a SerialScope,
+    this does nothing, since the calling thread would touch every page
+    anyway.
+*/
+void FirstTouchInParallel( void * memory , size_t numBytes )
+{
+#if USE_TBB
+    if( Parallel::IsSerial() || ( Parallel::GetNumThreads() < 2 ) )
+    {   // Only one thread would touch pages, which is what happens without this.
+        return ;
+    }
+
+    PERF_BLOCK( FirstTouchInParallel ) ;
+
+    const size_t numPages   = ( numBytes + sPageSize - 1 ) / sPageSize ;
+    const size_t grainSize  = Max2( size_t( 1 ) , numPages / Parallel::GetNumThreads() ) ;
+    Parallel::For( 0 , numPages , grainSize , Parallel::Function( TouchPagesSlice , static_cast< char * >( memory ) , numBytes ) ) ;
+#else
+    UNUSED_PARAM( memory ) ;
+    UNUSED_PARAM( numBytes ) ;
+#endif
+}
@@ -0,0 +1,111 @@
+/** \file firstTouchAllocator.h
+
+    \brief Standard-library allocator that places large blocks near the threads that will use them.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FIRST_TOUCH_ALLOCATOR_H
+#define FIRST_TOUCH_ALLOCATOR_H
+
+#include "Core/Memory/largePages.h"
+
+#include "Core/Utility/macros.h"
+
+#include <new>
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+
+/// Smallest block, in bytes, whose pages FirstTouchAllocator touches in parallel.  Smaller blocks cost less to place than to schedule.
+#define FIRST_TOUCH_MIN_BYTES ( 1 << 20 )
+
+// Public functions --------------------------------------------------------------
+
+extern void FirstTouchInParallel( void * memory , size_t numBytes ) ;
+
+// Types --------------------------------------------------------------
+
+/** Standard-library allocator whose large blocks get their pages first touched by worker threads, each touching a contiguous share.
+
+    On machines with non-uniform memory access (e.g. multiple sockets), an
+    operating system places each page of memory on the node of the thread
+    that first touches it.  A std::vector constructs its elements on the
+    calling thread, so without this, all pages of a large array land on the
+    main thread's node, and workers on other nodes pay remote latency and
+    share one node's bandwidth for as long as the array lives.
+
+    This touches the pages of each new block in parallel, before the
+    container constructs elements there, so pages spread across nodes in
+    contiguous runs.  For arrays laid out z-major, like UniformGrid, each
+    run is a set of whole z slabs, matching how parallel kernels split
+    those arrays.  TBB does not promise that a kernel assigns a slab to the
+    thread that touched it, so placement is only statistically local, but
+    it balances bandwidth across nodes either way.
+
+    Only placement of new blocks changes; containers still construct,
+    copy and destroy elements as usual.  Blocks smaller than
+    FIRST_TOUCH_MIN_BYTES, and all blocks when USE_TBB is 0, behave as they
+    would with std::allocator.
+
+    Memory comes from LargePageAllocate, so blocks of at least
+    LARGE_PAGE_MIN_BYTES use large pages where the operating system
+    permits, which also reduces TLB misses for kernels that stride across
+    z slabs.  First touch still decides which node each large page lands on.
+*/
+template< typename ItemT > class FirstTouchAllocator
+{
+    public:
+        typedef ItemT               value_type      ;
+        typedef ItemT *             pointer         ;
+        typedef const ItemT *       const_pointer   ;
+        typedef ItemT &             reference       ;
+        typedef const ItemT &       const_reference ;
+        typedef size_t              size_type       ;
+        typedef ptrdiff_t           difference_type ;
+
+        template< typename OtherT > struct rebind { typedef FirstTouchAllocator< OtherT > other ; } ;
+
+        FirstTouchAllocator() {}
+        template< typename OtherT > FirstTouchAllocator( const FirstTouchAllocator< OtherT > & ) {}
+
+        pointer         address( reference item ) const             { return & item ; }
+        const_pointer   address( const_reference item ) const       { return & item ; }
+
+        pointer         allocate( size_type numItems , const void * /* hint */ = 0 )
+        {
+            const size_t    numBytes    = numItems * sizeof( ItemT ) ;
+            void *          memory      = LargePageAllocate( numBytes ) ;
+            if( numBytes >= FIRST_TOUCH_MIN_BYTES )
+            {   // Block is large enough to be worth placing.
+                FirstTouchInParallel( memory , numBytes ) ;
+            }
+            return static_cast< pointer >( memory ) ;
+        }
+
+        void            deallocate( pointer items , size_type /* numItems */ )  { LargePageFree( items ) ; }
+        size_type       max_size() const                                    { return size_type( -1 ) / sizeof( ItemT ) ; }
+        void            construct( pointer item , const ItemT & value )     { new( item ) ItemT( value ) ; }
+        void            destroy( pointer item )                             { item->~ItemT() ; UNUSED_PARAM( item ) ; }
+} ;
+
+
+
+
+template< typename ItemT , typename OtherT > inline bool operator==( const FirstTouchAllocator< ItemT > & , const FirstTouchAllocator< OtherT > & )
+{   // All instances share LargePageAllocate, so any can deallocate memory from any other.
+    return true ;
+}
+
+
+
+
+template< typename ItemT , typename OtherT > inline bool operator!=( const FirstTouchAllocator< ItemT > & , const FirstTouchAllocator< OtherT > & )
+{
+    return false ;
+}
+
+// Public variables --------------------------------------------------------------
+
+#endif
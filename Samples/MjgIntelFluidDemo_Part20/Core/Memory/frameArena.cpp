@@ -0,0 +1,218 @@
+/** \file frameArena.cpp
+
+    \brief Linear allocator for temporaries that live no longer than one simulation step, and an STL allocator that uses it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "Core/Memory/frameArena.h"
+
+#include "Core/useTbb.h"
+#include "Core/Performance/perfBlock.h"
+
+#if USE_TBB
+#   include "tbb/enumerable_thread_specific.h"
+#endif
+
+// Private variables --------------------------------------------------------------
+
+#if USE_TBB
+static tbb::enumerable_thread_specific< FrameArena * > sArenas ;   ///< Address of arena of each thread, or NULL until that thread first asks for one.
+#else
+static FrameArena sArena ;  ///< Arena for the only thread.
+#endif
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct arena that holds no memory yet.
+*/
+FrameArena::FrameArena()
+    : mNumBytesUsedInLastChunk( 0 )
+    , mNumBytesInUse( 0 )
+    , mHighWaterMark( 0 )
+    , mMostRecentAllocation( NULLPTR )
+#if defined( _DEBUG )
+    , mNumLiveAllocations( 0 )
+#endif
+{
+}
+
+
+
+
+FrameArena::~FrameArena()
+{
+    FreeAllChunks() ;
+}
+
+
+
+
+/** Return the given number of bytes, aligned to the given boundary, valid until the next Reset.
+
+    \param numBytes     Number of bytes to allocate.
+
+    \param alignment    Alignment of returned address, which must be a power of 2 no greater than sDefaultAlignment.
+*/
+void * FrameArena::Allocate( size_t numBytes , size_t alignment )
+{
+    ASSERT( ( alignment > 0 ) && ( 0 == ( alignment & ( alignment - 1 ) ) ) && ( alignment <= sDefaultAlignment ) ) ;
+
+    size_t padding = 0 ;
+    if( ! mChunks.Empty() )
+    {   // Pad start of allocation to alignment.
+        const size_t address = reinterpret_cast< size_t >( mChunks.Back().mMemory ) + mNumBytesUsedInLastChunk ;
+        padding = ( alignment - ( address & ( alignment - 1 ) ) ) & ( alignment - 1 ) ;
+    }
+
+    if( mChunks.Empty() || ( mNumBytesUsedInLastChunk + padding + numBytes > mChunks.Back().mCapacity ) )
+    {   // Last chunk cannot hold this allocation.
+        AddChunk( numBytes ) ;
+        padding = 0 ;   // AddChunk aligns start of chunk.
+    }
+
+    char * memory = mChunks.Back().mMemory + mNumBytesUsedInLastChunk + padding ;
+    mNumBytesUsedInLastChunk    += padding + numBytes ;
+    mNumBytesInUse              += padding + numBytes ;
+    mHighWaterMark               = Max2( mHighWaterMark , mNumBytesInUse ) ;
+    mMostRecentAllocation        = memory ;
+    DEBUG_ONLY( ++ mNumLiveAllocations ) ;
+    return memory ;
+}
+
+
+
+
+/** Give back memory Allocate returned.
+
+    This only reclaims the most recent allocation, so a dynamic array that
+    grows by reallocating reuses the space of its previous buffer when
+    nothing else got allocated meanwhile.  Otherwise space remains in use
+    until Reset.
+*/
+void FrameArena::Deallocate( void * memory , size_t numBytes )
+{
+    if( NULLPTR == memory )
+    {
+        return ;
+    }
+    ASSERT( mNumLiveAllocations > 0 ) ;
+    DEBUG_ONLY( -- mNumLiveAllocations ) ;
+
+    if( memory == mMostRecentAllocation )
+    {   // Memory is at the top of the last chunk, so reclaim it.
+        ASSERT( mNumBytesUsedInLastChunk >= numBytes ) ;
+        mNumBytesUsedInLastChunk    -= numBytes ;
+        mNumBytesInUse              -= numBytes ;
+        mMostRecentAllocation        = NULLPTR ;
+    }
+}
+
+
+
+
+/** Reclaim everything this arena allocated.
+
+    All memory Allocate returned becomes invalid, so every container that
+    uses this arena must have been destroyed already.
+*/
+void FrameArena::Reset()
+{
+    ASSERT( 0 == mNumLiveAllocations ) ;   // Something allocated from this arena outlived the step.
+
+    if( mChunks.Size() > 1 )
+    {   // Previous step outgrew the first chunk.  Replace all chunks with one that can hold everything that step used.
+        FreeAllChunks() ;
+        AddChunk( mHighWaterMark ) ;
+    }
+    mNumBytesUsedInLastChunk    = 0 ;
+    mNumBytesInUse              = 0 ;
+    mMostRecentAllocation       = NULLPTR ;
+}
+
+
+
+
+/** Add a chunk that can hold at least the given number of bytes, and make it the one allocations come from.
+*/
+void FrameArena::AddChunk( size_t minCapacity )
+{
+    PERF_BLOCK( FrameArena__AddChunk ) ;
+
+    // Grow geometrically, so a step that needs much memory adds few chunks.
+    const size_t previousCapacity = mChunks.Empty() ? sInitialChunkSize : 2 * mChunks.Back().mCapacity ;
+    Chunk chunk ;
+    chunk.mCapacity = Max2( previousCapacity , minCapacity ) ;
+    chunk.mMemory   = new char[ chunk.mCapacity + sDefaultAlignment ] ;
+    mChunks.PushBack( chunk ) ;
+
+    // Start handing out memory from the first aligned address in the chunk.
+    const size_t address = reinterpret_cast< size_t >( chunk.mMemory ) ;
+    mNumBytesUsedInLastChunk = ( sDefaultAlignment - ( address & ( sDefaultAlignment - 1 ) ) ) & ( sDefaultAlignment - 1 ) ;
+    mChunks.Back().mCapacity += mNumBytesUsedInLastChunk ;
+    mNumBytesInUse += mNumBytesUsedInLastChunk ;
+}
+
+
+
+
+/** Return all chunks to the global heap.
+*/
+void FrameArena::FreeAllChunks()
+{
+    for( size_t iChunk = 0 ; iChunk < mChunks.Size() ; ++ iChunk )
+    {   // For each chunk...
+        delete [] mChunks[ iChunk ].mMemory ;
+    }
+    mChunks.Clear() ;
+    mNumBytesUsedInLastChunk = 0 ;
+}
+
+
+
+
+/** Return arena that belongs to the calling thread, creating it if necessary.
+*/
+/* static */ FrameArena & FrameArena::ForThisThread()
+{
+#if USE_TBB
+    FrameArena * & arena = sArenas.local() ;
+    if( NULLPTR == arena )
+    {   // First time this thread asked for its arena.
+        arena = new FrameArena ;
+    }
+    return * arena ;
+#else
+    return sArena ;
+#endif
+}
+
+
+
+
+/** Reset the arena of every thread.
+
+    Call this at the end of each simulation step, from the main thread,
+    while no other thread runs work that uses an arena.
+*/
+/* static */ void FrameArena::ResetAllThreads()
+{
+    PERF_BLOCK( FrameArena__ResetAllThreads ) ;
+
+#if USE_TBB
+    for( tbb::enumerable_thread_specific< FrameArena * >::iterator arena = sArenas.begin() ; arena != sArenas.end() ; ++ arena )
+    {   // For each thread that has an arena...
+        if( * arena )
+        {
+            ( * arena )->Reset() ;
+        }
+    }
+#else
+    sArena.Reset() ;
+#endif
+}
@@ -0,0 +1,152 @@
+/** \file frameArena.h
+
+    \brief Linear allocator for temporaries that live no longer than one simulation step, and an STL allocator that uses it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include "Core/Containers/vector.h"
+#include "Core/Utility/macros.h"
+
+#include <stddef.h>
+#include <new>
+
+// Types --------------------------------------------------------------
+
+/** Linear ("bump") allocator for temporaries that live no longer than one simulation step.
+
+    Allocate hands out consecutive pieces of large chunks, so it costs a few
+    instructions and never touches the global heap, once chunks exist.
+    Deallocate only reclaims the most recent allocation (which is what a
+    dynamic array does when it grows), and otherwise does nothing. Reset reclaims
+    everything at once, at the end of each step.
+
+    When a step outgrows the first chunk, Reset replaces all chunks with one
+    chunk big enough for everything that step used, so in steady state, each
+    arena holds one chunk and allocates nothing from the heap.
+
+    Each thread has its own arena (see ForThisThread), so threads never
+    contend for a lock, as they would for the global heap.  An arena itself
+    is not thread-safe: only the thread that owns it may allocate from it.
+*/
+class FrameArena
+{
+    public:
+        FrameArena() ;
+        ~FrameArena() ;
+
+        void *  Allocate( size_t numBytes , size_t alignment = sDefaultAlignment ) ;
+        void    Deallocate( void * memory , size_t numBytes ) ;
+        void    Reset() ;
+
+        /// Return number of bytes allocated since the most recent Reset, including alignment padding.
+        size_t  GetNumBytesInUse() const    { return mNumBytesInUse ; }
+
+        /// Return greatest number of bytes any single step used.
+        size_t  GetHighWaterMark() const    { return mHighWaterMark ; }
+
+        static FrameArena & ForThisThread() ;
+        static void         ResetAllThreads() ;
+
+        static const size_t sDefaultAlignment   = 16 ;          ///< Alignment of allocations, suitable for SSE types.
+        static const size_t sInitialChunkSize   = 1 << 20 ;     ///< Size of first chunk, in bytes.
+
+    private:
+        FrameArena( const FrameArena & ) ;              // Disallow copy
+        FrameArena & operator=( const FrameArena & ) ;  // Disallow assignment
+
+        /// Contiguous region of memory that allocations come from.
+        struct Chunk
+        {
+            char *  mMemory     ;   ///< Start of region, from global heap.
+            size_t  mCapacity   ;   ///< Number of bytes in region.
+        } ;
+
+        void    AddChunk( size_t minCapacity ) ;
+        void    FreeAllChunks() ;
+
+        VECTOR< Chunk > mChunks                 ;   ///< Chunks, in the order they got added.  Allocations come from the last.
+        size_t          mNumBytesUsedInLastChunk;   ///< Number of bytes already handed out from the last chunk.
+        size_t          mNumBytesInUse          ;   ///< Number of bytes allocated since the most recent Reset.
+        size_t          mHighWaterMark          ;   ///< Greatest value mNumBytesInUse reached.
+        char *          mMostRecentAllocation   ;   ///< Address Allocate most recently returned, which Deallocate can reclaim.
+    #if defined( _DEBUG )
+        size_t          mNumLiveAllocations     ;   ///< Number of allocations not yet deallocated, to catch arena memory that outlives Reset.
+    #endif
+} ;
+
+
+
+
+/** STL-compatible allocator that allocates from a FrameArena.
+
+    Use this for dynamic arrays that only live during a simulation step, for example:
+
+        VECTOR< Vec3 , FrameArenaAllocator< Vec3 > > accelerations ;
+
+    The default constructor binds to the arena of the constructing thread, so
+    the array must grow only on that thread.  (Worker threads may read and
+    write elements, just not reallocate.)  Arrays must get destroyed before
+    that arena's Reset.
+*/
+template< typename ItemT > class FrameArenaAllocator
+{
+    public:
+        typedef ItemT               value_type      ;
+        typedef ItemT *             pointer         ;
+        typedef const ItemT *       const_pointer   ;
+        typedef ItemT &             reference       ;
+        typedef const ItemT &       const_reference ;
+        typedef size_t              size_type       ;
+        typedef ptrdiff_t           difference_type ;
+
+        template< typename OtherT > struct rebind { typedef FrameArenaAllocator< OtherT > other ; } ;
+
+        FrameArenaAllocator()                                                       : mArena( & FrameArena::ForThisThread() ) {}
+        explicit FrameArenaAllocator( FrameArena & arena )                          : mArena( & arena ) {}
+        template< typename OtherT > FrameArenaAllocator( const FrameArenaAllocator< OtherT > & that ) : mArena( that.GetArena() ) {}
+
+        pointer         address( reference item ) const             { return & item ; }
+        const_pointer   address( const_reference item ) const       { return & item ; }
+
+        pointer         allocate( size_type numItems , const void * /* hint */ = 0 )
+        {
+            return static_cast< pointer >( mArena->Allocate( numItems * sizeof( ItemT ) ) ) ;
+        }
+
+        void            deallocate( pointer items , size_type numItems )    { mArena->Deallocate( items , numItems * sizeof( ItemT ) ) ; }
+        size_type       max_size() const                                    { return size_type( -1 ) / sizeof( ItemT ) ; }
+        void            construct( pointer item , const ItemT & value )     { new( item ) ItemT( value ) ; }
+        void            destroy( pointer item )                             { item->~ItemT() ; UNUSED_PARAM( item ) ; }
+
+        /// Return arena this allocates from.
+        FrameArena *    GetArena() const                                    { return mArena ; }
+
+    private:
+        FrameArena *    mArena  ;   ///< Arena this allocates from.
+} ;
+
+
+
+
+template< typename ItemT , typename OtherT > inline bool operator==( const FrameArenaAllocator< ItemT > & lhs , const FrameArenaAllocator< OtherT > & rhs )
+{   // Memory from one allocator can be deallocated by another if and only if they share an arena.
+    return lhs.GetArena() == rhs.GetArena() ;
+}
+
+
+
+
+template< typename ItemT , typename OtherT > inline bool operator!=( const FrameArenaAllocator< ItemT > & lhs , const FrameArenaAllocator< OtherT > & rhs )
+{
+    return lhs.GetArena() != rhs.GetArena() ;
+}
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
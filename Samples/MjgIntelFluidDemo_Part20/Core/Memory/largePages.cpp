@@ -0,0 +1,283 @@
+/** \file largePages.cpp
+
+    \brief Allocation of large blocks backed by large (e.g. 2 MB) pages, to reduce translation lookaside buffer misses.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "Core/Memory/largePages.h"
+
+#include "Core/useTbb.h"
+#include "Core/Utility/macros.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <new>
+
+#if defined( WIN32 )
+#   include <windows.h>
+#   ifdef min
+#       undef min
+#   endif
+#   ifdef max
+#       undef max
+#   endif
+#elif defined( __linux__ )
+#   include <sys/mman.h>
+#endif
+
+#if USE_TBB
+#   include "tbb/atomic.h"
+#endif
+
+// Macros --------------------------------------------------------------
+
+/// Size, in bytes, of the header LargePageAllocate puts before each block.  It preserves the alignment ::operator new would provide, and more.
+#define LARGE_PAGE_HEADER_BYTES 64
+
+// Types --------------------------------------------------------------
+
+/// How LargePageAllocate obtained a block, so LargePageFree can release it the same way.
+enum LargePageKindE
+{
+    LARGE_PAGE_KIND_HEAP    ,   ///< Block came from ::operator new, because the request was small or large pages were unavailable.
+    LARGE_PAGE_KIND_MAPPED      ///< Block came from the operating system, mapped with (or advised to use) large pages.
+} ;
+
+/// Header stored immediately before each block LargePageAllocate returns.
+struct LargePageHeader
+{
+    void *          mBase       ;   ///< Address the allocator returned, i.e. address of this header.
+    size_t          mNumBytes   ;   ///< Number of bytes mapped, including header, for LARGE_PAGE_KIND_MAPPED.
+    LargePageKindE  mKind       ;   ///< How block was obtained.
+} ;
+
+// Private variables --------------------------------------------------------------
+
+static const size_t sLargePageSizeDefault = 2 << 20 ;   ///< Size of large pages on x86-64 when the operating system does not say otherwise.
+
+#if USE_TBB
+static tbb::atomic< size_t > sNumBytesInLargePages ;    ///< Number of bytes currently mapped with large pages, for diagnostics.
+#else
+static size_t sNumBytesInLargePages = 0 ;               ///< Number of bytes currently mapped with large pages, for diagnostics.
+#endif
+
+// Private functions --------------------------------------------------------------
+
+#if defined( WIN32 )
+/** Return size of large pages, or zero if this process cannot allocate them.
+
+    Windows only grants large pages to processes holding SeLockMemoryPrivilege,
+    which a user must have been granted ("Lock pages in memory"), and which
+    a process must then enable.  This tries once, and remembers the answer.
+*/
+static size_t GetLargePageSizeIfPermitted()
+{
+    static int sIsPermitted = -1 ; // 1 for yes, 0 for no, -1 for not yet queried.
+    if( sIsPermitted < 0 )
+    {   // First call.  Try to enable privilege.
+        sIsPermitted = 0 ;
+        HANDLE token = NULLPTR ;
+        if( OpenProcessToken( GetCurrentProcess() , TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY , & token ) )
+        {
+            TOKEN_PRIVILEGES privileges ;
+            privileges.PrivilegeCount               = 1 ;
+            privileges.Privileges[ 0 ].Attributes   = SE_PRIVILEGE_ENABLED ;
+            if( LookupPrivilegeValue( NULLPTR , SE_LOCK_MEMORY_NAME , & privileges.Privileges[ 0 ].Luid ) )
+            {   // AdjustTokenPrivileges succeeds even when it assigns nothing, so also check GetLastError.
+                if( AdjustTokenPrivileges( token , FALSE , & privileges , 0 , NULLPTR , NULLPTR ) && ( ERROR_SUCCESS == GetLastError() ) )
+                {
+                    sIsPermitted = 1 ;
+                }
+            }
+            CloseHandle( token ) ;
+        }
+    }
+    return sIsPermitted ? GetLargePageMinimum() : 0 ;
+}
+#endif
+
+
+
+
+/** Map the given number of bytes, backed by large pages if possible.
+
+    \return Address of mapped memory, or NULLPTR if the operating system provided none.
+
+    \param numBytes - Requested number of bytes.  On return, number of bytes actually mapped.
+*/
+static void * MapLargePages( size_t & numBytes )
+{
+#if defined( WIN32 )
+    const size_t largePageSize = GetLargePageSizeIfPermitted() ;
+    if( largePageSize > 0 )
+    {   // Process can allocate large pages.  Size must be a multiple of large page size.
+        const size_t roundedNumBytes = ( numBytes + largePageSize - 1 ) & ~ ( largePageSize - 1 ) ;
+        void * memory = VirtualAlloc( NULLPTR , roundedNumBytes , MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES , PAGE_READWRITE ) ;
+        if( memory != NULLPTR )
+        {
+            numBytes = roundedNumBytes ;
+            return memory ;
+        }
+        // Else physical memory has too few contiguous free runs, so fall back to ordinary pages.
+    }
+    return NULLPTR ;
+#elif defined( __linux__ )
+    // Map a multiple of the large page size, then ask for transparent huge pages.
+    // The kernel aligns large mappings to large pages when it can, and falls back to ordinary pages when it cannot.
+    const size_t roundedNumBytes = ( numBytes + sLargePageSizeDefault - 1 ) & ~ ( sLargePageSizeDefault - 1 ) ;
+    void * memory = mmap( NULLPTR , roundedNumBytes , PROT_READ | PROT_WRITE , MAP_PRIVATE | MAP_ANONYMOUS , -1 , 0 ) ;
+    if( MAP_FAILED == memory )
+    {
+        return NULLPTR ;
+    }
+    madvise( memory , roundedNumBytes , MADV_HUGEPAGE ) ;  // Failure only means ordinary pages.
+    numBytes = roundedNumBytes ;
+    return memory ;
+#else
+    UNUSED_PARAM( numBytes ) ;
+    return NULLPTR ;
+#endif
+}
+
+
+
+
+/** Unmap memory that MapLargePages mapped.
+*/
+static void UnmapLargePages( void * memory , size_t numBytes )
+{
+#if defined( WIN32 )
+    UNUSED_PARAM( numBytes ) ;
+    VirtualFree( memory , 0 , MEM_RELEASE ) ;
+#elif defined( __linux__ )
+    munmap( memory , numBytes ) ;
+#else
+    UNUSED_PARAM( memory ) ;
+    UNUSED_PARAM( numBytes ) ;
+#endif
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Allocate a block of memory, backed by large pages if it is large enough and the operating system permits.
+
+    \param numBytes - Number of bytes to allocate.
+
+    \return Address of block, aligned at least as well as ::operator new would align it.
+        Free it with LargePageFree, never with ::operator delete.
+
+    Blocks smaller than LARGE_PAGE_MIN_BYTES, blocks the operating system
+    cannot back with large pages, and all blocks when USE_LARGE_PAGES is 0,
+    come from ::operator new, which throws std::bad_alloc on failure, as
+    usual.
+*/
+void * LargePageAllocate( size_t numBytes )
+{
+    const size_t numBytesWithHeader = numBytes + LARGE_PAGE_HEADER_BYTES ;
+    LargePageHeader * header = NULLPTR ;
+
+#if USE_LARGE_PAGES
+    if( numBytes >= LARGE_PAGE_MIN_BYTES )
+    {   // Block is large enough to benefit from large pages.
+        PERF_BLOCK( LargePageAllocate ) ;
+
+        size_t numBytesMapped = numBytesWithHeader ;
+        void * base = MapLargePages( numBytesMapped ) ;
+        if( base != NULLPTR )
+        {
+            header = static_cast< LargePageHeader * >( base ) ;
+            header->mBase       = base ;
+            header->mNumBytes   = numBytesMapped ;
+            header->mKind       = LARGE_PAGE_KIND_MAPPED ;
+            sNumBytesInLargePages += numBytesMapped ;
+        }
+    }
+#endif
+
+    if( NULLPTR == header )
+    {   // Block is small, large pages are disabled, or operating system could not provide them.
+        void * base = ::operator new( numBytesWithHeader ) ;
+        header = static_cast< LargePageHeader * >( base ) ;
+        header->mBase       = base ;
+        header->mNumBytes   = numBytesWithHeader ;
+        header->mKind       = LARGE_PAGE_KIND_HEAP ;
+    }
+
+    return reinterpret_cast< char * >( header ) + LARGE_PAGE_HEADER_BYTES ;
+}
+
+
+
+
+/** Free a block that LargePageAllocate allocated.
+
+    \param memory - Address LargePageAllocate returned, or NULLPTR, which does nothing.
+*/
+void LargePageFree( void * memory )
+{
+    if( NULLPTR == memory )
+    {
+        return ;
+    }
+
+    LargePageHeader * header = reinterpret_cast< LargePageHeader * >( static_cast< char * >( memory ) - LARGE_PAGE_HEADER_BYTES ) ;
+    ASSERT( header->mBase == header ) ;
+    if( LARGE_PAGE_KIND_MAPPED == header->mKind )
+    {
+        sNumBytesInLargePages -= header->mNumBytes ;
+        UnmapLargePages( header->mBase , header->mNumBytes ) ;
+    }
+    else
+    {
+        ::operator delete( header->mBase ) ;
+    }
+}
+
+
+
+
+/** Advise the operating system to back the given block, which some other allocator owns, with large pages.
+
+    \param memory - Address of a block.  It need not be aligned.
+
+    \param numBytes - Number of bytes in block.
+
+    This suits containers whose allocator cannot change, such as arrays of
+    particles.  Only whole large pages inside the block qualify, and pages
+    the block already touched convert only when the kernel gets to them, so
+    call this soon after the block grows.
+
+    Only Linux (with transparent huge pages) supports advising memory that
+    is already allocated.  Elsewhere, and when USE_LARGE_PAGES is 0, this
+    does nothing.
+*/
+void AdviseLargePages( void * memory , size_t numBytes )
+{
+#if USE_LARGE_PAGES && defined( __linux__ )
+    if( numBytes < LARGE_PAGE_MIN_BYTES )
+    {   // Block is too small to span a whole aligned large page, or nearly so.
+        return ;
+    }
+    const size_t begin  = ( reinterpret_cast< size_t >( memory ) + sLargePageSizeDefault - 1 ) & ~ ( sLargePageSizeDefault - 1 ) ;
+    const size_t end    = ( reinterpret_cast< size_t >( memory ) + numBytes ) & ~ ( sLargePageSizeDefault - 1 ) ;
+    if( end > begin )
+    {   // Block spans at least one whole, aligned large page.
+        madvise( reinterpret_cast< void * >( begin ) , end - begin , MADV_HUGEPAGE ) ;
+    }
+#else
+    UNUSED_PARAM( memory ) ;
+    UNUSED_PARAM( numBytes ) ;
+#endif
+}
+
+
+
+
+/** Return number of bytes currently allocated with large pages (or, on Linux, advised to use them), for diagnostics.
+*/
+size_t GetNumBytesInLargePages()
+{
+    return sNumBytesInLargePages ;
+}
@@ -0,0 +1,41 @@
+/** \file largePages.h
+
+    \brief Allocation of large blocks backed by large (e.g. 2 MB) pages, to reduce translation lookaside buffer misses.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef LARGE_PAGES_H
+#define LARGE_PAGES_H
+
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+
+/** Whether to back large blocks with large pages.
+
+    Grids and particle arrays span tens to hundreds of megabytes, and
+    kernels that walk them (especially along y and z, or by particle
+    position) touch more 4 KB pages than the translation lookaside buffer
+    (TLB) holds, so many loads also pay for a page-table walk.  A 2 MB page
+    covers 512 times as much memory per TLB entry.
+
+    When the operating system cannot provide large pages (e.g. on Windows
+    the user lacks the "Lock pages in memory" privilege, or physical memory
+    is too fragmented), allocation falls back to ordinary pages, so setting
+    this costs nothing beyond a failed request.
+*/
+#define USE_LARGE_PAGES 1
+
+/// Smallest block, in bytes, that LargePageAllocate requests large pages for.  Smaller blocks would waste most of a large page.
+#define LARGE_PAGE_MIN_BYTES ( 2 << 20 )
+
+// Public functions --------------------------------------------------------------
+
+extern void *   LargePageAllocate( size_t numBytes ) ;
+extern void     LargePageFree( void * memory ) ;
+extern void     AdviseLargePages( void * memory , size_t numBytes ) ;
+extern size_t   GetNumBytesInLargePages() ;
+
+#endif
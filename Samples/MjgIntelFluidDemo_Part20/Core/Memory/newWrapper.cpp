@@ -0,0 +1,192 @@
+/** \file newWrapper.cpp
+
+    \brief Replacement global operator new and delete that count heap allocations.
+
+    \see NEW_WRAPPER_TRACK_ALLOCATIONS
+
+    \author Copyright 2006-2012 MJG; All rights reserved.
+*/
+
+#include "Core/Memory/newWrapper.h"
+
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    #if defined( WIN32 )
+        #include <windows.h>    // For InterlockedExchangeAdd64, InterlockedCompareExchange64
+        #ifdef min
+            #undef min
+        #endif
+        #ifdef max
+            #undef max
+        #endif
+    #endif
+
+    #include <new>
+    #include <stdlib.h>
+#endif
+
+// Private variables -----------------------------------------------------------
+
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+
+#if defined( WIN32 )
+    #define NEW_WRAPPER_THREAD_LOCAL_STORAGE static __declspec( thread )
+#else   // Fallback -- not really thread-local but it will compile and run okay in single-threaded code.
+    #define NEW_WRAPPER_THREAD_LOCAL_STORAGE static
+#endif
+
+/** Number of bytes preceding each allocation, to remember its size.
+
+    This is a multiple of the strictest alignment malloc provides, so memory
+    handed to callers keeps that alignment.
+*/
+static const size_t sHeaderSize = 16 ;
+
+NEW_WRAPPER_THREAD_LOCAL_STORAGE AllocationCounts sTlsAllocationCounts = { 0 , 0 } ;   ///< Allocations the current thread made.
+
+static volatile long long sLiveBytes        = 0 ;   ///< Number of bytes currently allocated, across all threads.
+static volatile long long sPeakLiveBytes    = 0 ;   ///< Largest value of sLiveBytes since ResetPeakLiveBytes.
+
+// Private functions -----------------------------------------------------------
+
+/** Add to the number of live bytes, and raise the high-water mark if that exceeds it.
+*/
+static inline void AdjustLiveBytes( long long numBytes )
+{
+#if defined( WIN32 )
+    const long long liveBytes = InterlockedExchangeAdd64( & sLiveBytes , numBytes ) + numBytes ;
+    long long peak = sPeakLiveBytes ;
+    while( liveBytes > peak )
+    {   // Another thread might raise the peak concurrently, so retry until this thread's value is not larger.
+        const long long previousPeak = InterlockedCompareExchange64( & sPeakLiveBytes , liveBytes , peak ) ;
+        if( previousPeak == peak )
+        {   // This thread raised the peak.
+            break ;
+        }
+        peak = previousPeak ;
+    }
+#else
+    sLiveBytes += numBytes ;
+    if( sLiveBytes > sPeakLiveBytes )
+    {
+        sPeakLiveBytes = sLiveBytes ;
+    }
+#endif
+}
+
+
+
+
+/** Allocate memory and count the allocation.
+
+    \return Address of memory the caller may use, or NULL if none was available.
+*/
+static void * AllocateTracked( size_t numBytes )
+{
+    char * block = static_cast< char * >( malloc( numBytes + sHeaderSize ) ) ;
+    if( 0 == block )
+    {
+        return 0 ;
+    }
+    * reinterpret_cast< size_t * >( block ) = numBytes ;
+    ++ sTlsAllocationCounts.mNumAllocations ;
+    sTlsAllocationCounts.mNumBytes += numBytes ;
+    AdjustLiveBytes( static_cast< long long >( numBytes ) ) ;
+    return block + sHeaderSize ;
+}
+
+
+
+
+/** Allocate memory, or throw std::bad_alloc as operator new must when none is available.
+*/
+static void * AllocateTrackedOrThrow( size_t numBytes )
+{
+    void * memory = AllocateTracked( numBytes ) ;
+    if( 0 == memory )
+    {
+        throw std::bad_alloc() ;
+    }
+    return memory ;
+}
+
+
+
+
+/** Free memory that AllocateTracked returned.
+*/
+static void FreeTracked( void * memory )
+{
+    if( 0 == memory )
+    {
+        return ;
+    }
+    char * block = static_cast< char * >( memory ) - sHeaderSize ;
+    AdjustLiveBytes( - static_cast< long long >( * reinterpret_cast< size_t * >( block ) ) ) ;
+    free( block ) ;
+}
+
+// Replacement global operators ------------------------------------------------
+
+void * operator new( size_t numBytes )                                      { return AllocateTrackedOrThrow( numBytes ) ; }
+void * operator new[]( size_t numBytes )                                    { return AllocateTrackedOrThrow( numBytes ) ; }
+void * operator new( size_t numBytes , const std::nothrow_t & ) throw()     { return AllocateTracked( numBytes ) ; }
+void * operator new[]( size_t numBytes , const std::nothrow_t & ) throw()   { return AllocateTracked( numBytes ) ; }
+void   operator delete( void * memory ) throw()                             { FreeTracked( memory ) ; }
+void   operator delete[]( void * memory ) throw()                           { FreeTracked( memory ) ; }
+void   operator delete( void * memory , const std::nothrow_t & ) throw()    { FreeTracked( memory ) ; }
+void   operator delete[]( void * memory , const std::nothrow_t & ) throw()  { FreeTracked( memory ) ; }
+
+#endif
+
+// Public functions ------------------------------------------------------------
+
+/** Read counts of allocations the calling thread has made since it began.
+*/
+/* static */ void AllocationTracker::ReadThisThread( AllocationCounts & counts )
+{
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    counts = sTlsAllocationCounts ;
+#else
+    counts.Reset() ;
+#endif
+}
+
+
+
+
+/** Return number of bytes currently allocated, across all threads.
+*/
+/* static */ long long AllocationTracker::GetLiveBytes()
+{
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    return sLiveBytes ;
+#else
+    return 0 ;
+#endif
+}
+
+
+
+
+/** Return largest number of bytes allocated at once, across all threads, since the most recent call to ResetPeakLiveBytes.
+*/
+/* static */ long long AllocationTracker::GetPeakLiveBytes()
+{
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    return sPeakLiveBytes ;
+#else
+    return 0 ;
+#endif
+}
+
+
+
+
+/** Lower the high-water mark of live bytes to the number currently live.
+*/
+/* static */ void AllocationTracker::ResetPeakLiveBytes()
+{
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    sPeakLiveBytes = sLiveBytes ;
+#endif
+}
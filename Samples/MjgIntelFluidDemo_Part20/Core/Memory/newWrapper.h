@@ -7,6 +7,94 @@
 #ifndef NEW_WRAPPER_H
 #define NEW_WRAPPER_H
 
+#include <stddef.h>
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether to count heap allocations by replacing global operator new and delete.
+
+    When nonzero, newWrapper.cpp replaces global operator new and delete
+    (including array forms) with versions that count, for the calling thread,
+    the number of allocations and the number of bytes requested, and track
+    for the process the number of bytes currently live and its high-water mark.
+    That covers NEW and every other use of operator new, including standard
+    containers, so steady-state per-frame allocations cannot hide.
+
+    PerfBlock then records allocation counts per block (inclusive of callees)
+    alongside its timings, and PerfBlock logs report them next to PerfTally
+    durations, along with per-frame high-water marks for each thread.  See
+    PerfAggregatedStats::mAllocationTotalsInclusive.
+
+    Counts belong to the thread that allocates, so allocations inside TBB
+    tasks running on worker threads count toward those workers, not toward
+    the block on the main thread that spawned the tasks.  Workers lack a
+    main PerfBlock, so their counts appear only in AllocationTracker totals.
+
+    Tracking adds a header to each allocation and a few instructions to each
+    call, so this is off by default.  Allocations via malloc, _aligned_malloc
+    or operating system calls bypass tracking.
+*/
+#if ! defined( NEW_WRAPPER_TRACK_ALLOCATIONS )
+#   define NEW_WRAPPER_TRACK_ALLOCATIONS 0
+#endif
+
 #define NEW new
 
+// Types -----------------------------------------------------------------------
+
+/** Snapshot, or sum of differences, of heap allocation counts.
+
+    This deliberately lacks constructors so it can reside in thread-local storage,
+    which requires a constant initializer.  Call Reset to zero it.
+*/
+struct AllocationCounts
+{
+    void Reset()
+    {
+        mNumAllocations = 0 ;
+        mNumBytes       = 0 ;
+    }
+
+    /// Accumulate the difference between two snapshots into this.
+    void AccumulateDifference( const AllocationCounts & end , const AllocationCounts & begin )
+    {
+        mNumAllocations += end.mNumAllocations - begin.mNumAllocations ;
+        mNumBytes       += end.mNumBytes       - begin.mNumBytes       ;
+    }
+
+    /// Accumulate another sum into this.
+    void Accumulate( const AllocationCounts & that )
+    {
+        mNumAllocations += that.mNumAllocations ;
+        mNumBytes       += that.mNumBytes       ;
+    }
+
+    /// Raise each count in this to at least that in another.
+    void AccumulateMax( const AllocationCounts & that )
+    {
+        if( that.mNumAllocations > mNumAllocations ) mNumAllocations = that.mNumAllocations ;
+        if( that.mNumBytes       > mNumBytes       ) mNumBytes       = that.mNumBytes       ;
+    }
+
+    unsigned long long  mNumAllocations ;   ///< Number of calls to operator new.
+    unsigned long long  mNumBytes       ;   ///< Number of bytes requested from operator new.
+} ;
+
+
+
+
+/** Heap allocation counts, as replacement global operator new and delete record them.
+
+    When NEW_WRAPPER_TRACK_ALLOCATIONS is 0, all counts read as zero.
+*/
+class AllocationTracker
+{
+    public:
+        static bool IsEnabled() { return NEW_WRAPPER_TRACK_ALLOCATIONS != 0 ; }
+        static void ReadThisThread( AllocationCounts & counts ) ;
+        static long long GetLiveBytes() ;
+        static long long GetPeakLiveBytes() ;
+        static void ResetPeakLiveBytes() ;
+} ;
+
 #endif
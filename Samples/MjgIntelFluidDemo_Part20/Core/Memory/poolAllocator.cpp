@@ -0,0 +1,204 @@
+/** \file poolAllocator.cpp
+
+    \brief Allocator of fixed-size blocks, and class-specific new and delete operators that use it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "Core/Memory/poolAllocator.h"
+
+#include "Core/Memory/newWrapper.h"
+#include "Core/Performance/perfBlock.h"
+#include "Core/Performance/perfTally.h" // For SpinLock
+
+#include <new>
+
+// Types --------------------------------------------------------------
+
+/** Pools, one per size class, that PoolAllocator::AllocateBytes uses.
+*/
+struct SizeClassPools
+{
+    static const size_t sNumSizeClasses = PoolAllocator::sMaxSizeClassBytes / PoolAllocator::sSizeClassGranularity ;
+
+    SizeClassPools()
+    {
+        for( size_t iClass = 0 ; iClass < sNumSizeClasses ; ++ iClass )
+        {   // For each size class...
+            mPools[ iClass ].Initialize( ( iClass + 1 ) * PoolAllocator::sSizeClassGranularity ) ;
+        }
+    }
+
+    /// Return index of smallest size class whose blocks hold the given number of bytes.
+    static size_t SizeClassIndex( size_t numBytes )
+    {
+        return ( Max2( numBytes , size_t( 1 ) ) - 1 ) / PoolAllocator::sSizeClassGranularity ;
+    }
+
+    PoolAllocator   mPools[ sNumSizeClasses ] ; ///< Pool for each size class, in order of increasing block size.
+    SpinLock        mLocks[ sNumSizeClasses ] ; ///< Mutex for synchronizing access to each pool.
+} ;
+
+// Private functions --------------------------------------------------------------
+
+/** Return pools that PoolAllocator::AllocateBytes uses.
+
+    This creates them upon first use, and deliberately never destroys them,
+    since objects still alive when static destructors run (for example,
+    members of static objects constructed before the pools) would
+    otherwise free into destroyed pools.
+*/
+static SizeClassPools & GetSizeClassPools()
+{
+    static SizeClassPools * sSizeClassPools = NEW SizeClassPools ;
+    return * sSizeClassPools ;
+}
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+/** Construct pool that has no block size yet.  Call Initialize before allocating.
+*/
+PoolAllocator::PoolAllocator()
+    : mFreeList( NULLPTR )
+    , mBlockSize( 0 )
+    , mNumBlocksPerPage( 0 )
+    , mNumBlocksInUse( 0 )
+{
+}
+
+
+
+
+/** Destruct pool, returning its pages to the global heap.
+*/
+PoolAllocator::~PoolAllocator()
+{
+    ASSERT( 0 == mNumBlocksInUse ) ; // Blocks outlived their pool.
+    for( size_t iPage = 0 ; iPage < mPages.Size() ; ++ iPage )
+    {   // For each page...
+        ::operator delete( mPages[ iPage ] ) ;
+    }
+}
+
+
+
+
+/** Assign size of blocks this pool hands out.
+
+    \param blockSize        Number of bytes in each block.  This rounds it up to a multiple of sSizeClassGranularity,
+                            so consecutive blocks keep the alignment of the page, which comes from global operator new.
+
+    \param numBlocksPerPage Number of blocks to obtain from the global heap at a time.
+*/
+void PoolAllocator::Initialize( size_t blockSize , size_t numBlocksPerPage )
+{
+    ASSERT( mPages.Empty() ) ; // Not allowed to change after allocating.
+    ASSERT( numBlocksPerPage > 0 ) ;
+    mBlockSize          = ( Max2( blockSize , sizeof( FreeBlock ) ) + sSizeClassGranularity - 1 ) / sSizeClassGranularity * sSizeClassGranularity ;
+    mNumBlocksPerPage   = numBlocksPerPage ;
+}
+
+
+
+
+/** Return a block of GetBlockSize bytes, which has the same alignment as memory from global operator new.
+*/
+void * PoolAllocator::Allocate()
+{
+    ASSERT( mBlockSize > 0 ) ; // Must call Initialize first.
+
+    if( NULLPTR == mFreeList )
+    {   // All blocks are in use.
+        AddPage() ;
+    }
+    FreeBlock * block = mFreeList ;
+    mFreeList = block->mNext ;
+    ++ mNumBlocksInUse ;
+    return block ;
+}
+
+
+
+
+/** Return the given block, which Allocate of this pool returned, to this pool.
+*/
+void PoolAllocator::Free( void * block )
+{
+    if( NULLPTR == block )
+    {
+        return ;
+    }
+
+    ASSERT( mNumBlocksInUse > 0 ) ;
+    FreeBlock * freeBlock = static_cast< FreeBlock * >( block ) ;
+    freeBlock->mNext = mFreeList ;
+    mFreeList = freeBlock ;
+    -- mNumBlocksInUse ;
+}
+
+
+
+
+/** Obtain another page from the global heap, and put its blocks on the free list.
+*/
+void PoolAllocator::AddPage()
+{
+    PERF_BLOCK( PoolAllocator__AddPage ) ;
+
+    char * page = static_cast< char * >( ::operator new( mBlockSize * mNumBlocksPerPage ) ) ;
+    mPages.PushBack( page ) ;
+    for( size_t iBlock = mNumBlocksPerPage ; iBlock > 0 ; -- iBlock )
+    {   // For each block in page, last first, so blocks come off the free list in address order...
+        FreeBlock * block = reinterpret_cast< FreeBlock * >( page + ( iBlock - 1 ) * mBlockSize ) ;
+        block->mNext = mFreeList ;
+        mFreeList = block ;
+    }
+}
+
+
+
+
+/** Allocate the given number of bytes from the pool of the smallest size class that fits, or from the global heap if none does.
+
+    \see POOLED_ALLOCATION
+*/
+/* static */ void * PoolAllocator::AllocateBytes( size_t numBytes )
+{
+    if( numBytes > sMaxSizeClassBytes )
+    {   // Too large for any size class.
+        return ::operator new( numBytes ) ;
+    }
+    SizeClassPools &    pools       = GetSizeClassPools() ;
+    const size_t        iClass      = SizeClassPools::SizeClassIndex( numBytes ) ;
+    ScopedSpinLock      lock( pools.mLocks[ iClass ] ) ;
+    return pools.mPools[ iClass ].Allocate() ;
+}
+
+
+
+
+/** Free memory that AllocateBytes returned.
+
+    \param numBytes Number of bytes passed to AllocateBytes.
+*/
+/* static */ void PoolAllocator::FreeBytes( void * memory , size_t numBytes )
+{
+    if( NULLPTR == memory )
+    {
+        return ;
+    }
+    if( numBytes > sMaxSizeClassBytes )
+    {   // Came from global heap.
+        ::operator delete( memory ) ;
+        return ;
+    }
+    SizeClassPools &    pools       = GetSizeClassPools() ;
+    const size_t        iClass      = SizeClassPools::SizeClassIndex( numBytes ) ;
+    ScopedSpinLock      lock( pools.mLocks[ iClass ] ) ;
+    pools.mPools[ iClass ].Free( memory ) ;
+}
@@ -0,0 +1,103 @@
+/** \file poolAllocator.h
+
+    \brief Allocator of fixed-size blocks, and class-specific new and delete operators that use it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include "Core/Containers/vector.h"
+#include "Core/Utility/macros.h"
+
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+
+/** Declare class-specific new and delete operators that allocate from PoolAllocator size classes.
+
+    Put this in the public section of a base class with a virtual
+    destructor.  Then NEW of that class, or of any class derived from it,
+    takes a block from the pool whose block size fits the derived class,
+    and deleting through any base pointer returns the block to that pool,
+    since a virtual destructor passes the size of the most derived class.
+
+    Arrays (NEW ClassT[n]) still use the global heap.
+*/
+#define POOLED_ALLOCATION                                                                                                   \
+    /** Allocate object from pool whose block size fits it. */                                                                \
+    static void * operator new( size_t numBytes )                   { return PoolAllocator::AllocateBytes( numBytes ) ; }   \
+    /** Return object to pool it came from. */                                                                                \
+    static void   operator delete( void * memory , size_t numBytes ) { PoolAllocator::FreeBytes( memory , numBytes ) ; }
+
+// Types --------------------------------------------------------------
+
+/** Allocator that hands out fixed-size blocks from pages it keeps, and recycles freed blocks.
+
+    Allocate and Free each cost a few instructions, once pages exist, since
+    they just pop or push a free list.  Freed blocks stay in the pool for
+    reuse, so objects that a program repeatedly destroys and recreates in
+    similar numbers, such as scene nodes on reset, or particle operations
+    on particle-system copies, stop fragmenting or touching the global heap
+    after the first time.
+
+    Pages only return to the heap when the pool gets destroyed, so a pool
+    holds as many blocks as were ever simultaneously in use.
+
+    A pool itself is not thread-safe.  AllocateBytes and FreeBytes route
+    requests to a shared set of pools, one per size class, each with its own
+    lock, so any thread can use them, even to free blocks other threads
+    allocated.  That is what POOLED_ALLOCATION uses.
+*/
+class PoolAllocator
+{
+    public:
+        PoolAllocator() ;
+        ~PoolAllocator() ;
+
+        void    Initialize( size_t blockSize , size_t numBlocksPerPage = sDefaultNumBlocksPerPage ) ;
+
+        void *  Allocate() ;
+        void    Free( void * block ) ;
+
+        /// Return number of bytes in each block.
+        size_t  GetBlockSize() const        { return mBlockSize ; }
+
+        /// Return number of blocks allocated but not yet freed.
+        size_t  GetNumBlocksInUse() const   { return mNumBlocksInUse ; }
+
+        /// Return number of pages this pool obtained from the global heap.
+        size_t  GetNumPages() const         { return mPages.Size() ; }
+
+        static void *   AllocateBytes( size_t numBytes ) ;
+        static void     FreeBytes( void * memory , size_t numBytes ) ;
+
+        static const size_t sDefaultNumBlocksPerPage    = 64 ;  ///< Number of blocks each page holds, unless Initialize says otherwise.
+        static const size_t sSizeClassGranularity       = 16 ;  ///< Difference between block sizes of consecutive size classes, in bytes.
+        static const size_t sMaxSizeClassBytes          = 512 ; ///< Largest block size of size classes.  AllocateBytes serves larger requests from the global heap.
+
+    private:
+        PoolAllocator( const PoolAllocator & ) ;                // Disallow copy
+        PoolAllocator & operator=( const PoolAllocator & ) ;    // Disallow assignment
+
+        /// Block on free list.  Overlays the memory of a freed block.
+        struct FreeBlock
+        {
+            FreeBlock * mNext   ;   ///< Next free block, or NULL if this is the last.
+        } ;
+
+        void    AddPage() ;
+
+        VECTOR< char * >    mPages              ;   ///< Regions of memory, from global heap, that blocks come from.
+        FreeBlock *         mFreeList           ;   ///< Most recently freed block, or NULL when all blocks are in use.
+        size_t              mBlockSize          ;   ///< Number of bytes in each block.
+        size_t              mNumBlocksPerPage   ;   ///< Number of blocks in each page.
+        size_t              mNumBlocksInUse     ;   ///< Number of blocks allocated but not yet freed.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
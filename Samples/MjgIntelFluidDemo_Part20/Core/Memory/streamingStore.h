@@ -0,0 +1,102 @@
+/** \file streamingStore.h
+
+    \brief Non-temporal ("streaming") stores, for writing memory the CPU never reads back, such as mapped vertex buffers.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef STREAMING_STORE_H
+#define STREAMING_STORE_H
+
+#include "Core/Utility/macros.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Macros ----------------------------------------------------------------------
+
+/// Whether streaming stores use SSE intrinsics.  Otherwise they fall back to ordinary (cached) stores.
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __SSE__ )
+    #define STREAMING_STORE_USE_SSE 1
+#else
+    #define STREAMING_STORE_USE_SSE 0
+#endif
+
+#if STREAMING_STORE_USE_SSE
+    #include <xmmintrin.h>  // SSE intrinsics
+#endif
+
+// Public functions ------------------------------------------------------------
+
+/// Number of bytes each streaming store writes, which is also the alignment destinations require.
+static const size_t STREAMING_STORE_BYTES = 16 ;
+
+
+/** Return whether the given address is aligned for StreamingStore_Copy.
+
+    Vertex buffers that OpenGL maps are aligned (usually to 64 bytes or more), but
+    arrays from operator new[] might only be aligned to 8 bytes, so callers
+    that cannot vouch for their destination should check, and fall back to
+    ordinary stores if this returns false.
+*/
+inline bool StreamingStore_IsAligned( const void * address )
+{
+    return 0 == ( reinterpret_cast< size_t >( address ) & ( STREAMING_STORE_BYTES - 1 ) ) ;
+}
+
+
+
+
+/** Copy the given number of bytes from a cached source into a destination, bypassing caches.
+
+    \param dst      Destination.  Must be aligned to STREAMING_STORE_BYTES.
+
+    \param src      Source, typically a small staging record on the stack, which stays in cache.  Need not be aligned.
+
+    \param numBytes Number of bytes to copy.  Must be a multiple of STREAMING_STORE_BYTES.
+
+    Ordinary stores first read each destination cache line (to own it), then
+    leave it in cache, where it evicts data other threads need, such as
+    particles the simulation reads next frame.  Non-temporal stores instead
+    gather writes in write-combining buffers and send whole lines to memory.
+    That suits destinations the CPU writes once and never reads, like vertex
+    buffers the GPU consumes.  Writing each destination line completely and
+    in order lets write-combining buffers flush without partial writes.
+
+    Streaming stores are weakly ordered, so call StreamingStore_Fence before
+    another thread (e.g. the one that unmaps the buffer) relies on the data.
+*/
+inline void StreamingStore_Copy( void * dst , const void * src , size_t numBytes )
+{
+    ASSERT( StreamingStore_IsAligned( dst ) ) ;
+    ASSERT( 0 == ( numBytes % STREAMING_STORE_BYTES ) ) ;
+#if STREAMING_STORE_USE_SSE
+    float *         dstFloats   = reinterpret_cast< float * >( dst ) ;
+    const float *   srcFloats   = reinterpret_cast< const float * >( src ) ;
+    const size_t    numFloats   = numBytes / sizeof( float ) ;
+    for( size_t iFloat = 0 ; iFloat < numFloats ; iFloat += 4 )
+    {   // For each 16-byte block...
+        _mm_stream_ps( dstFloats + iFloat , _mm_loadu_ps( srcFloats + iFloat ) ) ;
+    }
+#else
+    memcpy( dst , src , numBytes ) ;
+#endif
+}
+
+
+
+
+/** Make streaming stores this thread issued visible to other threads.
+
+    Call this once, after the last streaming store of a batch, such as at the
+    end of each slice of a parallel vertex buffer fill.
+*/
+inline void StreamingStore_Fence()
+{
+#if STREAMING_STORE_USE_SSE
+    _mm_sfence() ;
+#endif
+}
+
+#endif
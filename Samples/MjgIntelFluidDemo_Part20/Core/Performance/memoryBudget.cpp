@@ -0,0 +1,136 @@
+/** \file memoryBudget.cpp
+
+    \brief Accounting of memory each subsystem uses, with optional caps.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#if defined( WIN32 )
+    #include <windows.h>
+    #ifdef min
+        #undef min
+    #endif
+    #ifdef max
+        #undef max
+    #endif
+#endif
+
+#include "Core/Utility/macros.h"
+
+#include "memoryBudget.h"
+
+#include <string.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+#if defined( WIN32 )
+static volatile LONGLONG    sTrackedUsage[ MemoryBudget::NUM_SUBSYSTEMS ] ; ///< Number of bytes each subsystem that calls Track uses, across the process.  Signed, so a free that races ahead of its allocation does not wrap.
+#else
+static volatile long long   sTrackedUsage[ MemoryBudget::NUM_SUBSYSTEMS ] ; ///< Number of bytes each subsystem that calls Track uses, across the process.
+#endif
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+/** Construct a budget with no usage and no caps.
+*/
+MemoryBudget::MemoryBudget()
+{
+    memset( mUsage      , 0 , sizeof( mUsage      ) ) ;
+    memset( mPeakUsage  , 0 , sizeof( mPeakUsage  ) ) ;
+    memset( mCap        , 0 , sizeof( mCap        ) ) ;
+}
+
+
+
+
+/** Set number of bytes the given subsystem uses, and update its peak.
+*/
+void MemoryBudget::SetUsage( SubsystemE subsystem , size_t numBytes )
+{
+    ASSERT( subsystem < NUM_SUBSYSTEMS ) ;
+    mUsage[ subsystem ]     = numBytes ;
+    mPeakUsage[ subsystem ] = Max2( mPeakUsage[ subsystem ] , numBytes ) ;
+}
+
+
+
+
+/** Return number of bytes all subsystems use.
+*/
+size_t MemoryBudget::GetTotalUsage() const
+{
+    size_t total = 0 ;
+    for( int subsystem = 0 ; subsystem < NUM_SUBSYSTEMS ; ++ subsystem )
+    {
+        total += mUsage[ subsystem ] ;
+    }
+    return total ;
+}
+
+
+
+
+/** Copy process-wide tallies, which subsystems with no owner accumulate through Track, into this budget.
+*/
+void MemoryBudget::SampleTrackedUsage()
+{
+    SetUsage( SUBSYSTEM_RENDER_BUFFERS  , GetTrackedUsage( SUBSYSTEM_RENDER_BUFFERS  ) ) ;
+    SetUsage( SUBSYSTEM_RENDER_TEXTURES , GetTrackedUsage( SUBSYSTEM_RENDER_TEXTURES ) ) ;
+}
+
+
+
+
+/** Add the given number of bytes to the process-wide tally of the given subsystem.
+
+    \param numBytes     Number of bytes allocated, or negative number of bytes freed.
+
+    Any thread can call this.  It costs one interlocked add.
+*/
+void MemoryBudget::Track( SubsystemE subsystem , ptrdiff_t numBytes )
+{
+    ASSERT( subsystem < NUM_SUBSYSTEMS ) ;
+#if defined( WIN32 )
+    InterlockedExchangeAdd64( & sTrackedUsage[ subsystem ] , LONGLONG( numBytes ) ) ;
+#else
+    sTrackedUsage[ subsystem ] += numBytes ;
+#endif
+}
+
+
+
+
+/** Return number of bytes the process-wide tally of the given subsystem holds.
+*/
+size_t MemoryBudget::GetTrackedUsage( SubsystemE subsystem )
+{
+    ASSERT( subsystem < NUM_SUBSYSTEMS ) ;
+    const long long numBytes = sTrackedUsage[ subsystem ] ;
+    return ( numBytes > 0 ) ? size_t( numBytes ) : 0 ;
+}
+
+
+
+
+/** Return name of the given subsystem, suitable for a telemetry label.
+*/
+const char * MemoryBudget::GetSubsystemName( SubsystemE subsystem )
+{
+    static const char * sNames[ NUM_SUBSYSTEMS ] =
+    {
+        "grids"             ,
+        "multigrids"        ,
+        "influence_tree"    ,
+        "vorton_partition"  ,
+        "vortons"           ,
+        "tracers"           ,
+        "render_buffers"    ,
+        "render_textures"   ,
+    } ;
+    ASSERT( subsystem < NUM_SUBSYSTEMS ) ;
+    return sNames[ subsystem ] ;
+}
@@ -0,0 +1,107 @@
+/** \file memoryBudget.h
+
+    \brief Accounting of memory each subsystem uses, with optional caps.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include "Core/wrapperMacros.h"
+
+#include <stddef.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+/** Accounting of memory each subsystem uses, with optional caps.
+
+    Subsystems report memory in one of two ways:
+
+    -   Objects with an owner that can enumerate them, such as grids,
+        trees and particle groups, report through GetMemoryUsage methods
+        (UniformGrid::GetMemoryUsage, NestedGrid::GetMemoryUsage,
+        ParticleGroup::GetMemoryUsage, etc.), which the owner sums and
+        passes to SetUsage each frame.  See VortonSim::ReportMemoryUsage.
+
+    -   Objects with no such owner, such as render resources, call Track
+        when they allocate or free memory, which adds to a process-wide
+        tally.  SampleTrackedUsage copies those tallies into a budget.
+
+    Usage counts capacity rather than population, since capacity is what
+    occupies memory.  Render resources count what they asked the render
+    API for, which approximates what the driver allocates.
+
+    Each subsystem can have a cap, which QualityGovernor treats like a
+    time budget:  Usage above a cap lowers quality until usage drops.
+    Caps default to zero, which means unlimited.
+*/
+class MemoryBudget
+{
+    public:
+        /// Subsystems whose memory this accounts for.
+        enum SubsystemE
+        {
+            SUBSYSTEM_GRIDS             ,   ///< Uniform grids of the fluid simulation, such as velocity, density and signed distance.
+            SUBSYSTEM_MULTIGRIDS        ,   ///< Layers of multi-resolution grids, such as those of the Poisson solver.
+            SUBSYSTEM_INFLUENCE_TREE    ,   ///< Tree of vorton clusters, and its scratch.
+            SUBSYSTEM_VORTON_PARTITION  ,   ///< Spatial partition of vortons.
+            SUBSYSTEM_VORTONS           ,   ///< Vorton particle group.
+            SUBSYSTEM_TRACERS           ,   ///< Tracer particle group.
+            SUBSYSTEM_RENDER_BUFFERS    ,   ///< Vertex and index buffers.
+            SUBSYSTEM_RENDER_TEXTURES   ,   ///< Textures.
+            NUM_SUBSYSTEMS
+        } ;
+
+        MemoryBudget() ;
+
+        void        SetUsage( SubsystemE subsystem , size_t numBytes ) ;
+
+        /// Return number of bytes the given subsystem used, as of the most recent SetUsage or SampleTrackedUsage.
+        size_t      GetUsage( SubsystemE subsystem ) const              { return mUsage[ subsystem ] ; }
+
+        /// Return largest number of bytes the given subsystem has used since construction.
+        size_t      GetPeakUsage( SubsystemE subsystem ) const          { return mPeakUsage[ subsystem ] ; }
+
+        size_t      GetTotalUsage() const ;
+
+        /// Set number of bytes above which the given subsystem counts as over budget.  Zero means unlimited.
+        void        SetCap( SubsystemE subsystem , size_t numBytes )    { mCap[ subsystem ] = numBytes ; }
+
+        /// Return number of bytes above which the given subsystem counts as over budget, or zero if unlimited.
+        size_t      GetCap( SubsystemE subsystem ) const                { return mCap[ subsystem ] ; }
+
+        /// Return whether the given subsystem has a cap.
+        bool        HasCap( SubsystemE subsystem ) const                { return mCap[ subsystem ] > 0 ; }
+
+        /// Return ratio of usage to cap for the given subsystem, or zero if it has no cap.
+        float       GetLoad( SubsystemE subsystem ) const               { return HasCap( subsystem ) ? float( mUsage[ subsystem ] ) / float( mCap[ subsystem ] ) : 0.0f ; }
+
+        /// Return whether the given subsystem uses more than its cap.
+        bool        IsOverCap( SubsystemE subsystem ) const             { return HasCap( subsystem ) && ( mUsage[ subsystem ] > mCap[ subsystem ] ) ; }
+
+        void        SampleTrackedUsage() ;
+
+        static void         Track( SubsystemE subsystem , ptrdiff_t numBytes ) ;
+        static size_t       GetTrackedUsage( SubsystemE subsystem ) ;
+        static const char * GetSubsystemName( SubsystemE subsystem ) ;
+
+    private:
+        size_t      mUsage[ NUM_SUBSYSTEMS ]        ;   ///< Number of bytes each subsystem uses.
+        size_t      mPeakUsage[ NUM_SUBSYSTEMS ]    ;   ///< Largest number of bytes each subsystem has used.
+        size_t      mCap[ NUM_SUBSYSTEMS ]          ;   ///< Number of bytes above which each subsystem counts as over budget.  Zero means unlimited.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+/** Return number of bytes the given dynamic array occupies, counting capacity rather than population.
+
+    This omits memory elements themselves own, such as that of nested arrays.
+*/
+template< class VectorT > size_t MemoryUsageOf( const VectorT & vec )
+{
+    return vec.Capacity() * sizeof( typename VectorT::value_type ) ;
+}
+
+#endif
@@ -0,0 +1,389 @@
+/** \file perfBaseline.cpp
+
+    \brief Per-frame statistics of profiled blocks, to save as a baseline and to compare against another build.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Core/Utility/macros.h"
+
+#include "perfTally.h"
+#include "perfBlock.h"
+#include "perfBaseline.h"
+
+#pragma warning( disable : 4996 ) // This function may be unsafe (fopen, sscanf, strncpy)
+
+// Private variables -----------------------------------------------------------
+
+/* static */ const double PerfBaseline::sSignificance = 3.0 ;
+
+static const char * sCsvHeader = "context,label,frames,meanMs,stdDevMs,minMs,maxMs\n" ;    ///< First line of each baseline file.
+
+// Private functions -----------------------------------------------------------
+
+/** Copy a string into a fixed-capacity buffer, truncating it if necessary.
+*/
+static void CopyName( char * destination , const char * source )
+{
+    strncpy( destination , source , PerfBaselineEntry::MAX_NAME_LENGTH - 1 ) ;
+    destination[ PerfBaselineEntry::MAX_NAME_LENGTH - 1 ] = '\0' ;
+}
+
+// Public functions ------------------------------------------------------------
+
+
+
+
+PerfBaselineEntry::PerfBaselineEntry()
+    : mNumFrames( 0 )
+    , mMeanMs( 0.0 )
+    , mSumSquaredDeviations( 0.0 )
+    , mMinMs( DBL_MAX )
+    , mMaxMs( 0.0 )
+    , mPreviousTotalTicks( 0.0 )
+    , mCurrentTotalTicks( 0.0 )
+{
+    mContext[ 0 ]   = '\0' ;
+    mLabel[ 0 ]     = '\0' ;
+}
+
+
+
+
+/** Add the duration of one frame to these statistics.
+
+    This uses Welford's method, which remains accurate for long runs, unlike summing squares.
+*/
+void PerfBaselineEntry::AddSample( double durationMs )
+{
+    ++ mNumFrames ;
+    const double deviationBefore = durationMs - mMeanMs ;
+    mMeanMs += deviationBefore / double( mNumFrames ) ;
+    mSumSquaredDeviations += deviationBefore * ( durationMs - mMeanMs ) ;
+    mMinMs = Min2( mMinMs , durationMs ) ;
+    mMaxMs = Max2( mMaxMs , durationMs ) ;
+}
+
+
+
+
+/** Return sample variance of duration per frame, in square milliseconds.
+*/
+double PerfBaselineEntry::GetVariance() const
+{
+    return ( mNumFrames > 1 ) ? mSumSquaredDeviations / double( mNumFrames - 1 ) : 0.0 ;
+}
+
+
+
+
+PerfBaseline::PerfBaseline()
+{
+    mContext[ 0 ] = '\0' ;
+}
+
+
+
+
+/** Set the context into which subsequent samples go, such as which scenario runs with how many threads.
+
+    Blocks with the same label in different contexts have separate statistics.
+    Context names must not contain commas.
+*/
+void PerfBaseline::SetContext( const char * context )
+{
+    ASSERT( NULLPTR == strchr( context , ',' ) ) ;
+    CopyName( mContext , context ) ;
+}
+
+
+
+
+/** Find statistics of the given block in the given context.
+
+    \return Address of statistics, or NULL if none exist.
+*/
+const PerfBaselineEntry * PerfBaseline::Find( const char * context , const char * label ) const
+{
+    const size_t numEntries = mEntries.Size() ;
+    for( size_t iEntry = 0 ; iEntry < numEntries ; ++ iEntry )
+    {   // For each entry...
+        const PerfBaselineEntry & entry = mEntries[ iEntry ] ;
+        if( ( 0 == strcmp( entry.mLabel , label ) ) && ( 0 == strcmp( entry.mContext , context ) ) )
+        {
+            return & entry ;
+        }
+    }
+    return NULLPTR ;
+}
+
+
+
+
+/** Find statistics of the given block in the given context, or add empty statistics if none exist.
+*/
+PerfBaselineEntry * PerfBaseline::FindOrAppend( const char * context , const char * label )
+{
+    PerfBaselineEntry * entry = const_cast< PerfBaselineEntry * >( Find( context , label ) ) ;
+    if( NULLPTR == entry )
+    {   // This block has no statistics in this context yet.
+        mEntries.PushBack( PerfBaselineEntry() ) ;
+        entry = & mEntries.Back() ;
+        CopyName( entry->mContext , context ) ;
+        CopyName( entry->mLabel , label ) ;
+    }
+    return entry ;
+}
+
+
+
+
+/** Add inclusive durations of the given tally and its callees into current totals of the current context.
+*/
+void PerfBaseline::ReadTotals( const PerfTally * tally )
+{
+    for( const PerfTally * callee = tally->mFirstCallee ; callee != NULLPTR ; callee = callee->mNextSiblingCallee )
+    {   // For each callee under this block...
+        PerfBaselineEntry * entry = FindOrAppend( mContext , callee->mId.mLabel ) ;
+        entry->mCurrentTotalTicks += double( callee->mInContextAggregate.mTotalDurationInclusive ) ;
+        ReadTotals( callee ) ;
+    }
+}
+
+
+
+
+/** Read current totals of every block on the calling thread, into entries of the current context.
+
+    This omits the main block, whose totals accumulate only when profiling aggregates.
+
+    \return Whether totals were available, which requires a PROFILE build with profiling in progress.
+*/
+bool PerfBaseline::ReadTotalsThisThread()
+{
+#if PROFILE
+    if( ! PerfBlock::IsProfileInProgressThisThread() )
+    {   // Blocks only record durations while profiling.
+        return false ;
+    }
+    const size_t numEntries = mEntries.Size() ;
+    for( size_t iEntry = 0 ; iEntry < numEntries ; ++ iEntry )
+    {   // For each entry...
+        PerfBaselineEntry & entry = mEntries[ iEntry ] ;
+        if( 0 == strcmp( entry.mContext , mContext ) )
+        {   // Entry is in the current context.
+            entry.mCurrentTotalTicks = 0.0 ;
+        }
+    }
+    ReadTotals( PerfBlock::GetMainTallyThisThread() ) ;
+    return true ;
+#else
+    return false ;
+#endif
+}
+
+
+
+
+/** Start sampling frames in the current context.
+
+    This discards durations blocks recorded before now, for example while
+    running other contexts, so the first sample covers only the first frame.
+*/
+void PerfBaseline::BeginSampling()
+{
+    if( ! ReadTotalsThisThread() )
+    {
+        return ;
+    }
+    const size_t numEntries = mEntries.Size() ;
+    for( size_t iEntry = 0 ; iEntry < numEntries ; ++ iEntry )
+    {   // For each entry...
+        PerfBaselineEntry & entry = mEntries[ iEntry ] ;
+        if( 0 == strcmp( entry.mContext , mContext ) )
+        {   // Entry is in the current context.
+            entry.mPreviousTotalTicks = entry.mCurrentTotalTicks ;
+        }
+    }
+}
+
+
+
+
+/** Add the inclusive duration each block took since the previous sample, as one frame of the current context.
+
+    Call BeginSampling before the first frame of each context.
+*/
+void PerfBaseline::SampleFrame()
+{
+    if( ! ReadTotalsThisThread() )
+    {
+        return ;
+    }
+    const double milliSecondsPerTick = PerfTally::MilliSecondsPerTick() ;
+    const size_t numEntries = mEntries.Size() ;
+    for( size_t iEntry = 0 ; iEntry < numEntries ; ++ iEntry )
+    {   // For each entry...
+        PerfBaselineEntry & entry = mEntries[ iEntry ] ;
+        if( 0 == strcmp( entry.mContext , mContext ) )
+        {   // Entry is in the current context.
+            entry.AddSample( ( entry.mCurrentTotalTicks - entry.mPreviousTotalTicks ) * milliSecondsPerTick ) ;
+            entry.mPreviousTotalTicks = entry.mCurrentTotalTicks ;
+        }
+    }
+}
+
+
+
+
+/** Write statistics as comma-separated values, one row per block per context.
+
+    Blocks that never ran are omitted.
+
+    \return Whether writing succeeded.
+*/
+bool PerfBaseline::Save( const char * filename ) const
+{
+    FILE * fp = fopen( filename , "w" ) ;
+    if( NULLPTR == fp )
+    {
+        return false ;
+    }
+    fputs( sCsvHeader , fp ) ;
+    const size_t numEntries = mEntries.Size() ;
+    for( size_t iEntry = 0 ; iEntry < numEntries ; ++ iEntry )
+    {   // For each entry...
+        const PerfBaselineEntry & entry = mEntries[ iEntry ] ;
+        if( entry.mMaxMs > 0.0 )
+        {   // Block ran during at least one frame.
+            fprintf( fp , "%s,%s,%u,%.9g,%.9g,%.9g,%.9g\n" , entry.mContext , entry.mLabel , entry.mNumFrames
+                , entry.mMeanMs , sqrt( entry.GetVariance() ) , entry.mMinMs , entry.mMaxMs ) ;
+        }
+    }
+    const bool succeeded = ! ferror( fp ) ;
+    fclose( fp ) ;
+    return succeeded ;
+}
+
+
+
+
+/** Read statistics that Save wrote, replacing any this object had.
+
+    \return Whether reading succeeded.
+*/
+bool PerfBaseline::Load( const char * filename )
+{
+    mEntries.Clear() ;
+    FILE * fp = fopen( filename , "r" ) ;
+    if( NULLPTR == fp )
+    {
+        return false ;
+    }
+    char line[ 2 * PerfBaselineEntry::MAX_NAME_LENGTH + 256 ] ;
+    bool succeeded = ( NULLPTR != fgets( line , sizeof( line ) , fp ) ) && ( 0 == strcmp( line , sCsvHeader ) ) ;
+    while( succeeded && fgets( line , sizeof( line ) , fp ) )
+    {   // For each row...
+        PerfBaselineEntry entry ;
+        double stdDevMs = 0.0 ;
+        if( 7 != sscanf( line , "%127[^,],%127[^,],%u,%lf,%lf,%lf,%lf" , entry.mContext , entry.mLabel , & entry.mNumFrames
+                       , & entry.mMeanMs , & stdDevMs , & entry.mMinMs , & entry.mMaxMs ) )
+        {   // Row is malformed.
+            succeeded = false ;
+            break ;
+        }
+        entry.mSumSquaredDeviations = ( entry.mNumFrames > 1 ) ? stdDevMs * stdDevMs * double( entry.mNumFrames - 1 ) : 0.0 ;
+        mEntries.PushBack( entry ) ;
+    }
+    fclose( fp ) ;
+    return succeeded ;
+}
+
+
+
+
+/** Compare these statistics against a baseline and report per-block differences.
+
+    \param baseline             Statistics from an earlier build or configuration.
+
+    \param regressionThreshold  Fraction of baseline mean by which a block must slow to count as a regression, for example 0.05 for 5%.
+
+    \param report               Stream to write a comma-separated row per block into, or NULL for none.
+
+    A block regresses when its mean duration per frame exceeds the baseline
+    mean by more than regressionThreshold and the difference exceeds
+    sSignificance standard errors, per Welch's t statistic, so that
+    frame-to-frame noise alone does not trigger a regression.  Improvements
+    are reported likewise but do not count.
+
+    \return Number of blocks that regressed.
+*/
+unsigned PerfBaseline::Compare( const PerfBaseline & baseline , double regressionThreshold , FILE * report ) const
+{
+    if( report )
+    {
+        fprintf( report , "context,label,baseFrames,baseMeanMs,baseStdDevMs,frames,meanMs,stdDevMs,deltaMs,deltaPercent,tStatistic,verdict\n" ) ;
+    }
+    unsigned numRegressions = 0 ;
+    const size_t numEntries = mEntries.Size() ;
+    for( size_t iEntry = 0 ; iEntry < numEntries ; ++ iEntry )
+    {   // For each block in each context of these statistics...
+        const PerfBaselineEntry & entry = mEntries[ iEntry ] ;
+        if( entry.mMaxMs <= 0.0 )
+        {   // Block never ran, and Save would omit it, so skip it.
+            continue ;
+        }
+        const PerfBaselineEntry * baseEntry = baseline.Find( entry.mContext , entry.mLabel ) ;
+        if( NULLPTR == baseEntry )
+        {   // Baseline lacks this block.
+            if( report )
+            {
+                fprintf( report , "%s,%s,,,,%u,%g,%g,,,,new\n" , entry.mContext , entry.mLabel , entry.mNumFrames , entry.mMeanMs , sqrt( entry.GetVariance() ) ) ;
+            }
+            continue ;
+        }
+
+        const double deltaMs        = entry.mMeanMs - baseEntry->mMeanMs ;
+        const double deltaFraction  = ( baseEntry->mMeanMs > 0.0 ) ? deltaMs / baseEntry->mMeanMs : 0.0 ;
+        const double standardError  = sqrt( entry.GetVariance() / double( entry.mNumFrames ) + baseEntry->GetVariance() / double( Max2( baseEntry->mNumFrames , 1u ) ) ) ;
+        const double tStatistic     = ( standardError > 0.0 ) ? deltaMs / standardError : ( ( deltaMs != 0.0 ) ? ( deltaMs > 0.0 ? DBL_MAX : - DBL_MAX ) : 0.0 ) ;
+        const bool   significant    = fabs( tStatistic ) > sSignificance ;
+        const char * verdict        = "same" ;
+        if( significant && ( deltaFraction > regressionThreshold ) )
+        {
+            verdict = "REGRESSION" ;
+            ++ numRegressions ;
+        }
+        else if( significant && ( deltaFraction < - regressionThreshold ) )
+        {
+            verdict = "improvement" ;
+        }
+        if( report )
+        {
+            fprintf( report , "%s,%s,%u,%g,%g,%u,%g,%g,%g,%g,%g,%s\n" , entry.mContext , entry.mLabel
+                , baseEntry->mNumFrames , baseEntry->mMeanMs , sqrt( baseEntry->GetVariance() )
+                , entry.mNumFrames , entry.mMeanMs , sqrt( entry.GetVariance() )
+                , deltaMs , 100.0 * deltaFraction , tStatistic , verdict ) ;
+        }
+    }
+
+    if( report )
+    {   // Also report baseline blocks these statistics lack, since a block that vanished could hide a regression elsewhere.
+        const size_t numBaseEntries = baseline.mEntries.Size() ;
+        for( size_t iBase = 0 ; iBase < numBaseEntries ; ++ iBase )
+        {   // For each block in each context of the baseline...
+            const PerfBaselineEntry & baseEntry = baseline.mEntries[ iBase ] ;
+            const PerfBaselineEntry * entry = Find( baseEntry.mContext , baseEntry.mLabel ) ;
+            if( ( NULLPTR == entry ) || ( entry->mMaxMs <= 0.0 ) )
+            {   // These statistics lack this block.
+                fprintf( report , "%s,%s,%u,%g,%g,,,,,,,missing\n" , baseEntry.mContext , baseEntry.mLabel , baseEntry.mNumFrames , baseEntry.mMeanMs , sqrt( baseEntry.GetVariance() ) ) ;
+            }
+        }
+    }
+    return numRegressions ;
+}
@@ -0,0 +1,98 @@
+/** \file perfBaseline.h
+
+    \brief Per-frame statistics of profiled blocks, to save as a baseline and to compare against another build.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PERF_BASELINE_H
+#define PERF_BASELINE_H
+
+#include <stdio.h>
+
+#include "Core/Containers/vector.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+struct PerfTally ;
+
+
+
+
+/** Statistics of inclusive duration per frame of one profiled block, within one context.
+*/
+struct PerfBaselineEntry
+{
+    PerfBaselineEntry() ;
+
+    void    AddSample( double durationMs ) ;
+    double  GetVariance() const ;
+
+    static const size_t MAX_NAME_LENGTH = 128 ; ///< Capacity of context and label strings, including terminator.
+
+    char        mContext[ MAX_NAME_LENGTH ] ;   ///< What ran, for example which benchmark scenario with how many threads.
+    char        mLabel[ MAX_NAME_LENGTH ]   ;   ///< Label of PerfBlock.
+    unsigned    mNumFrames                  ;   ///< Number of frames sampled.
+    double      mMeanMs                     ;   ///< Mean inclusive duration per frame, in milliseconds.
+    double      mSumSquaredDeviations       ;   ///< Sum of squared differences between each sample and the mean, in square milliseconds.
+    double      mMinMs                      ;   ///< Shortest inclusive duration of any frame, in milliseconds.
+    double      mMaxMs                      ;   ///< Longest inclusive duration of any frame, in milliseconds.
+    double      mPreviousTotalTicks         ;   ///< Inclusive duration, summed across call contexts, as of the previous sample.  Only meaningful while sampling.
+    double      mCurrentTotalTicks          ;   ///< Inclusive duration, summed across call contexts, as of the current sample.  Only meaningful while sampling.
+} ;
+
+
+
+
+/** Per-frame statistics of every block PerfTally records on the calling thread.
+
+    Like PerfAggregatedStatsWithId, this aggregates each block across call
+    contexts, but it keys blocks by label alone, so baselines from builds in
+    different directories still match.  Unlike PerfTally, which keeps only
+    totals, this keeps mean and variance across frames, to tell whether a
+    difference between builds exceeds frame-to-frame noise.
+
+    Typical use, for example in a headless benchmark:
+
+        PerfBaseline current ;
+        current.SetContext( "scenario0_threads4" ) ;
+        current.BeginSampling() ;
+        for each frame: { run frame ; current.SampleFrame() ; }
+        current.Save( "perf-new.csv" ) ;
+
+        PerfBaseline baseline ;
+        baseline.Load( "perf-old.csv" ) ;
+        numRegressions = current.Compare( baseline , 0.05 , stderr ) ;
+
+    Sampling requires a PROFILE build, with profiling in progress on the
+    calling thread.  See PERF_BLOCK_ENABLE_PROFILING.
+*/
+class PerfBaseline
+{
+    public:
+        PerfBaseline() ;
+
+        void        SetContext( const char * context ) ;
+        void        BeginSampling() ;
+        void        SampleFrame() ;
+
+        bool        Save( const char * filename ) const ;
+        bool        Load( const char * filename ) ;
+
+        unsigned    Compare( const PerfBaseline & baseline , double regressionThreshold , FILE * report ) const ;
+
+        size_t      GetNumEntries() const { return mEntries.Size() ; }
+
+        static const double sSignificance ; ///< Number of standard errors by which means must differ for Compare to consider the difference significant.
+
+    private:
+        const PerfBaselineEntry *   Find( const char * context , const char * label ) const ;
+        PerfBaselineEntry *         FindOrAppend( const char * context , const char * label ) ;
+        void                        ReadTotals( const PerfTally * tally ) ;
+        bool                        ReadTotalsThisThread() ;
+
+        VECTOR< PerfBaselineEntry > mEntries                                        ;   ///< Statistics of each block in each context.
+        char                        mContext[ PerfBaselineEntry::MAX_NAME_LENGTH ]  ;   ///< Context that SampleFrame records into.
+} ;
+
+#endif
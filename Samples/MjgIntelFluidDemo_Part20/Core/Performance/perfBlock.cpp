@@ -10,6 +10,8 @@
 #include "Core/File/debugPrint.h"
 
 #include "perfTally.h"
+#include "perfTrace.h"
+#include "perfGpu.h"
 #include "perfBlock.h"
 
 #if defined( _DEBUG )
@@ -31,17 +33,25 @@ struct PerfBlockPerThreadInfo
     int            _numFramesToProfile      ;   /// Number of frames remaining until profiling automatically terminates.
     PerfBlock *    _outermostPerfBlock      ;   /// "MAIN", outer-most caller block for this thread.
     PerfBlock *    _caller                  ;   /// Current inner-most caller block for this thread.
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    AllocationCounts _allocationsAtFrameStart ; /// Heap allocation counts of this thread when the current frame began.
+    AllocationCounts _maxAllocationsPerFrame  ; /// Largest number of heap allocations, and bytes, this thread made in any one frame since profiling began.
+#endif
 } ;
 
 // Private variables -----------------------------------------------------------
 
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+THREAD_LOCAL_STORAGE PerfBlockPerThreadInfo sTls = { false , false , 0 , 0, NULLPTR , NULLPTR , { 0 , 0 } , { 0 , 0 } } ;
+#else
 THREAD_LOCAL_STORAGE PerfBlockPerThreadInfo sTls = { false , false , 0 , 0, NULLPTR , NULLPTR } ;
+#endif
 
 // Supporting having a single global TerminateAndLogAllThreads, that generates a report from each thread, e.g. upon termination of the process.
-SpinLock                            sPerThreadInfoLock                                  ;   /// Mutex for synchronizing access to sPerThreadInfos, sPerThreadInfoCount.
-static const size_t                 sMaxNumPerThreadInfos                   = 128       ;   /// Maximum number of threads supported.
-PerfBlockPerThreadInfo *            sPerThreadInfos[ sMaxNumPerThreadInfos ]            ;   /// Container of "main" PerfBlock objects, one for each thread.
-size_t                              sPerThreadInfoCount                     = 0         ;   /// Number of populated elements in sPerThreadInfos.
+// Threads register without a lock: each claims a slot by atomically incrementing sPerThreadInfoCount, then publishes its info there.
+static const int                    sMaxNumPerThreadInfos                   = 128       ;   /// Maximum number of threads supported.
+PerfBlockPerThreadInfo * volatile   sPerThreadInfos[ sMaxNumPerThreadInfos ]            ;   /// Container of "main" PerfBlock objects, one for each thread.  NULLPTR in slots claimed but not yet published.
+AtomicInt                           sPerThreadInfoCount( 0 )                            ;   /// Number of claimed elements in sPerThreadInfos.
 
 SpinLock                            sPerfLogLock                                        ;   /// Mutex for synchronizing logging output.
 PerfLogFunc                         sPerfLogFunc                            = PerfLoggerStdout::LogFunc ;   /// Global shared callback for logging perf info
@@ -55,9 +65,12 @@ static PerfTally::PerfLogFormat     sPerfLogFormat                          = Pe
 #if PROFILE
 static void PushPerThreadInfo( PerfBlockPerThreadInfo * perThreadInfo )
 {
-    ASSERT( sPerThreadInfoCount < sMaxNumPerThreadInfos ) ;
-    sPerThreadInfos[ sPerThreadInfoCount ] = perThreadInfo ;
-    ++ sPerThreadInfoCount ;
+    const int slot = sPerThreadInfoCount ++ ; // Claim a slot.  No other thread will write to it.
+    ASSERT( slot < sMaxNumPerThreadInfos ) ;
+    if( slot < sMaxNumPerThreadInfos )
+    {   // Publish info for this thread.  Readers skip slots still NULLPTR.
+        sPerThreadInfos[ slot ] = perThreadInfo ;
+    }
 }
 #endif
 
@@ -75,7 +88,9 @@ PerfBlock::PerfBlock( const char * filename , unsigned line , const char * threa
 
     ASSERT( NULLPTR == sTls._caller ) ; // This ctor establishes the main PerfBlock for this thread.
 
-    mCaller = NULLPTR ;  // MAIN block has no caller.
+    mCaller     = NULLPTR ;  // MAIN block has no caller.
+    mTraceLabel = NULLPTR ;  // MAIN block spans the whole thread, so omit it from the timeline.
+    PerfTrace::SetThreadName( threadName ) ;
 
     // Create persistent tally object associated with this PerfBlock object.
     mPerfTallyHead  = PerfTally::New( threadName , filename , line ) ;
@@ -86,11 +101,15 @@ PerfBlock::PerfBlock( const char * filename , unsigned line , const char * threa
     sTls._outermostPerfBlock  = this  ;
     sTls._caller              = this  ;  // Set new calling scope for nested profile blocks.
 
-    // Synchronously add this PerfBlock (which is the main block for the current thread) to the list of main PerfBlocks.
-    {
-        ScopedSpinLock lock( sPerThreadInfoLock ) ;
-        PushPerThreadInfo( & sTls ) ;
-    }
+    // Add this PerfBlock (which is the main block for the current thread) to the list of main PerfBlocks.
+    PushPerThreadInfo( & sTls ) ;
+
+#if PERF_COUNTERS_BACKEND != PERF_COUNTERS_BACKEND_NONE
+    PerfCounters::ReadThisThread( mCountersBegin ) ;
+#endif
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    AllocationTracker::ReadThisThread( mAllocationsBegin ) ;
+#endif
 
     // Query performance counter to get block entry time.
     QueryPerformanceCounter( & mCtorExitTime ) ;
@@ -108,6 +127,16 @@ PerfBlock::PerfBlock( const char * label , const char * filename , unsigned line
 {
 #if PROFILE
 
+    if( PerfTrace::IsRecording() )
+    {   // Record this block in the timeline, even on threads that lack a main block, such as TBB workers.
+        mTraceLabel = label ;
+        QueryPerformanceCounter( & mTraceBeginTime ) ;
+    }
+    else
+    {
+        mTraceLabel = NULLPTR ;
+    }
+
     if( NULLPTR == sTls._caller )
     {   // Not inside the main block yet, so do nothing.
         // This can happen if we're running construction code prior to hitting the main loop function, or there is no main block on the current thread.
@@ -138,6 +167,13 @@ PerfBlock::PerfBlock( const char * label , const char * filename , unsigned line
 
     sTls._caller      = this      ;  // Set new calling scope for nested profile blocks.
 
+#if PERF_COUNTERS_BACKEND != PERF_COUNTERS_BACKEND_NONE
+    PerfCounters::ReadThisThread( mCountersBegin ) ;
+#endif
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    AllocationTracker::ReadThisThread( mAllocationsBegin ) ;
+#endif
+
     // Query performance counter to get block entry time.
     QueryPerformanceCounter( & mCtorExitTime ) ;
 #else
@@ -171,6 +207,17 @@ inline void PerfBlock::RecordBlockExit()
     LARGE_INTEGER dtorEnterTime ;
     QueryPerformanceCounter( & dtorEnterTime ) ;
 
+#if PERF_COUNTERS_BACKEND != PERF_COUNTERS_BACKEND_NONE
+    PerfCounterValues countersEnd ;
+    PerfCounters::ReadThisThread( countersEnd ) ;
+    mPerfTallyHead->mInContextAggregate.mCounterTotalsInclusive.AccumulateDifference( countersEnd , mCountersBegin ) ;
+#endif
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    AllocationCounts allocationsEnd ;
+    AllocationTracker::ReadThisThread( allocationsEnd ) ;
+    mPerfTallyHead->mInContextAggregate.mAllocationTotalsInclusive.AccumulateDifference( allocationsEnd , mAllocationsBegin ) ;
+#endif
+
     LONGLONG blockDuration = dtorEnterTime.QuadPart - mCtorExitTime.QuadPart ;
 
     mPerfTallyHead->mInContextAggregate.mTotalDurationInclusive  += blockDuration ;
@@ -230,6 +277,12 @@ inline void PerfBlock::EndBlock()
 PerfBlock::~PerfBlock()
 {
 #if PROFILE
+    if( mTraceLabel )
+    {   // Tracing was on when this block began.
+        LARGE_INTEGER traceEndTime ;
+        QueryPerformanceCounter( & traceEndTime ) ;
+        PerfTrace::RecordEvent( mTraceLabel , mTraceBeginTime.QuadPart , traceEndTime.QuadPart ) ;
+    }
     EndBlock() ;
 #endif
 }
@@ -246,6 +299,11 @@ PerfBlock::~PerfBlock()
     sTls._frameCounter            = 0 ;
     //sTls._startProfilingNextFrame    = true ;
     sTls._isProfileInProgress     = true ;
+#if NEW_WRAPPER_TRACK_ALLOCATIONS
+    AllocationTracker::ReadThisThread( sTls._allocationsAtFrameStart ) ;
+    sTls._maxAllocationsPerFrame.Reset() ;
+    AllocationTracker::ResetPeakLiveBytes() ;
+#endif
 #else
     UNUSED_PARAM( numFramesToProfile ) ;
 #endif
@@ -285,6 +343,17 @@ PerfBlock::~PerfBlock()
     {   // Profile is running.
         ++ sTls._frameCounter ;
 
+    #if NEW_WRAPPER_TRACK_ALLOCATIONS
+        {   // Track the high-water mark of allocations per frame.
+            AllocationCounts allocationsNow ;
+            AllocationTracker::ReadThisThread( allocationsNow ) ;
+            AllocationCounts allocationsThisFrame = { 0 , 0 } ;
+            allocationsThisFrame.AccumulateDifference( allocationsNow , sTls._allocationsAtFrameStart ) ;
+            sTls._maxAllocationsPerFrame.AccumulateMax( allocationsThisFrame ) ;
+            sTls._allocationsAtFrameStart = allocationsNow ;
+        }
+    #endif
+
         if( sTls._numFramesToProfile > 0 )
         {   // We're not in 'run forever' mode and profiling is still running
             -- sTls._numFramesToProfile ;    // Decrement expiration counter.
@@ -302,6 +371,8 @@ PerfBlock::~PerfBlock()
         }
     }
 
+    PerfTrace::CrossFrameBoundaryThisThread() ;
+
     //if( sTls._startProfilingNextFrame )
     //{   // Somebody previously requested to start profiling.  Do it now.
     //    sTls._isProfileInProgress        = true ;
@@ -357,6 +428,22 @@ PerfBlock::~PerfBlock()
     {
         ScopedSpinLock logLock( sPerfLogLock ) ; // Obtain lock on log.
         pti->_outermostPerfBlock->mPerfTallyHead->LogThread( 1 , sPerfLogFunc , sPerfLogFormat ) ;
+    #if NEW_WRAPPER_TRACK_ALLOCATIONS
+        if( PerfTally::PERF_LOG_FORMAT_TABLE == sPerfLogFormat )
+        {   // Report per-frame high-water marks after the per-block allocation columns.
+            sPerfLogFunc( "AllocationHighWater,MaxAllocsPerFrame,%g,MaxAllocBytesPerFrame,%g,PeakLiveBytes,%g\n"
+                , double( pti->_maxAllocationsPerFrame.mNumAllocations )
+                , double( pti->_maxAllocationsPerFrame.mNumBytes )
+                , double( AllocationTracker::GetPeakLiveBytes() )
+                ) ;
+        }
+        pti->_maxAllocationsPerFrame.Reset() ;
+    #endif
+        if( ( pti == & sTls ) && PerfGpuLane::IsRecordingThread() )
+        {   // This is the render thread, which owns the GPU lane, so report GPU passes along with its blocks.
+            PerfGpuLane::Log( sPerfLogFunc , sPerfLogFormat ) ;
+            PerfGpuLane::Reset() ;
+        }
         pti->_outermostPerfBlock->mPerfTallyHead->LogFooter( sPerfLogFunc , sPerfLogFormat ) ;
     }
     pti->_outermostPerfBlock->mPerfTallyHead->Reset() ;
@@ -418,6 +505,26 @@ PerfBlock::~PerfBlock()
 
 
 
+/** Add load balance measurements of a parallel loop to the tally of the innermost block on the current thread.
+
+    \see PERF_MEASURE_LOAD_BALANCE
+*/
+/* static */ void PerfBlock::AccumulateLoadBalanceThisThread( const PerfLoadBalanceStats & loadBalance )
+{
+#if PROFILE
+    if( ( NULLPTR == sTls._caller ) || ! sTls._isProfileInProgress )
+    {   // Not inside a main block, or not profiling, so do nothing.
+        return ;
+    }
+    sTls._caller->mPerfTallyHead->mInContextAggregate.mLoadBalance.Accumulate( loadBalance ) ;
+#else
+    UNUSED_PARAM( loadBalance ) ;
+#endif
+}
+
+
+
+
 /** Get main PerfBlock (i.e. root of call tree, i.e. main block for thread) for given PerfBlock.
 */
 PerfBlock * PerfBlock::GetMain() const
@@ -451,15 +558,24 @@ PerfBlock * PerfBlock::GetMain() const
 */
 /* static */ void PerfBlock::TerminateAndLogAllThreads()
 {
-    // BEWARE: This routine ends up holding multiple locks (sPerThreadInfoLock and sPerfLogLock).  Make sure EVERYWHERE that these locks are always obtained in the same order, otherwise deadlock can occur.
-    ScopedSpinLock perThreadInfoLock( sPerThreadInfoLock ) ; // Obtain lock on sPerThreadInfos, sPerThreadInfoCount
+    PerfTrace::StopTracing() ;  // Write timeline, if tracing is in progress.  Do this before obtaining other locks.
+
     ScopedSpinLock lock( sPerfLogLock ) ; // Obtain lock on log.
 
-    for( size_t iThread = 0 ; iThread < sPerThreadInfoCount ; ++ iThread )
+    const int numPerThreadInfos = Min2( static_cast< int >( sPerThreadInfoCount ) , sMaxNumPerThreadInfos ) ;
+    for( int iThread = 0 ; iThread < numPerThreadInfos ; ++ iThread )
     {   // For each thread...
-        TerminateAndLog( sPerThreadInfos[ iThread ] ) ;
+        PerfBlockPerThreadInfo * pti = sPerThreadInfos[ iThread ] ;
+        if( pti != NULLPTR )
+        {   // Thread has published its info.
+            TerminateAndLog( pti ) ;
+        }
     }
 
+    // Report GPU passes not yet reported, e.g. if this thread is not the render thread.
+    PerfGpuLane::Log( sPerfLogFunc , sPerfLogFormat ) ;
+    PerfGpuLane::Reset() ;
+
     PerfTally::LogFooter( sPerfLogFunc , sPerfLogFormat ) ;
 }
 
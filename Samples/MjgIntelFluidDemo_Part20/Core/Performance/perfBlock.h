@@ -25,6 +25,15 @@
 
 #include <stdio.h>
 
+#include "perfTrace.h"
+#include "perfCounters.h"
+#include "perfSampler.h"
+
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/asyncLog.h"
+
+struct PerfLoadBalanceStats ;
+
 // Macros --------------------------------------------------------------
 
 #if defined( _DEBUG )   // Enable profiling for debug builds -- mainly to test profiling library, not because profiles of debug builds are useful.
@@ -33,17 +42,49 @@
 #   endif
 #endif
 
+/** Most detailed level of PERF_BLOCK to compile.
+
+    -   1: Only PERF_BLOCK, for routines that run a few times per frame.
+    -   2: Also PERF_BLOCK_INNER, for routines that run once per thread chunk, such as the slice routines that Parallel::For calls.
+    -   3: Also PERF_BLOCK_FINE, for routines that run per item, such as per particle or per grid cell.
+
+    Blocks above this level compile to nothing, neither timing nor sampling.
+    By default, PROFILE builds compile levels 1 and 2, and other builds
+    (where PERF_SAMPLING can still use blocks) compile only level 1.
+*/
+#if ! defined( PERF_BLOCK_LEVEL )
+    #if PROFILE
+        #define PERF_BLOCK_LEVEL 2
+    #else
+        #define PERF_BLOCK_LEVEL 1
+    #endif
+#endif
+
 #if PROFILE
-    #define PERF_BLOCK_MAIN( threadName )                       PerfBlock perfBlock_MAIN( __FILE__ , __LINE__ , threadName ) ;
-    #define PERF_BLOCK( label )                                 PerfBlock perfBlock_ ## label ## _( # label , __FILE__ , __LINE__ ) ;
+    #define PERF_BLOCK_MAIN( threadName )                       PERF_SAMPLE_THREAD_NAME( threadName ) PerfBlock perfBlock_MAIN( __FILE__ , __LINE__ , threadName ) ;
+    #define PERF_BLOCK( label )                                 PERF_SAMPLE_SCOPE( label ) PerfBlock perfBlock_ ## label ## _( # label , __FILE__ , __LINE__ ) ;
     #define PERF_BLOCK_ENABLE_PROFILING( numFrames )            PerfBlock::EnableProfilingThisThread( numFrames ) ;
     #define PERF_BLOCK_CROSS_FRAME_BOUNDARY( tallyEveryFrame )  PerfBlock::CrossFrameBoundaryThisThread( tallyEveryFrame ) ;
+    #define PERF_BLOCK_ENABLE_TRACING( numFrames , filename )   PerfTrace::EnableTracingThisThread( numFrames , filename ) ;
 #else
-    #define PERF_BLOCK_MAIN( threadName )
+    #define PERF_BLOCK_MAIN( threadName )                       PERF_SAMPLE_THREAD_NAME( threadName )
     #define PERF_BLOCK_STATIC_MAIN()
-    #define PERF_BLOCK( label )
+    #define PERF_BLOCK( label )                                 PERF_SAMPLE_SCOPE( label )
     #define PERF_BLOCK_ENABLE_PROFILING( numFrames )
     #define PERF_BLOCK_CROSS_FRAME_BOUNDARY( tallyEveryFrame )
+    #define PERF_BLOCK_ENABLE_TRACING( numFrames , filename )
+#endif
+
+#if PERF_BLOCK_LEVEL >= 2
+    #define PERF_BLOCK_INNER( label )                           PERF_BLOCK( label )
+#else
+    #define PERF_BLOCK_INNER( label )
+#endif
+
+#if PERF_BLOCK_LEVEL >= 3
+    #define PERF_BLOCK_FINE( label )                            PERF_BLOCK( label )
+#else
+    #define PERF_BLOCK_FINE( label )
 #endif
 
 // Use this as an argument to PERF_BLOCK_ENABLE_PROFILING, to continue profile indefinitely
@@ -85,6 +126,17 @@ public:
 
 
 
+/** Whether PerfLoggerFileStream hands text to AsyncLog, so reporting a profile does not make threads wait for the file.
+
+    AsyncLog only defers once AsyncLog::Start has run; until then, this writes synchronously either way.
+*/
+#if ! defined( PERF_LOGGER_FILE_STREAM_ASYNC )
+#   define PERF_LOGGER_FILE_STREAM_ASYNC ASYNC_LOG_THREADED
+#endif
+
+
+
+
 /** Simple example performance logging function.
 
     This class is a singleton, i.e. there can be at most one object of this class.
@@ -116,6 +168,9 @@ public:
 
     ~PerfLoggerFileStream()
     {
+    #if PERF_LOGGER_FILE_STREAM_ASYNC
+        AsyncLog::Flush() ; // Write messages still pending for this file, before closing it.
+    #endif
         fclose( sFilePointer ) ;
         sFilePointer = 0 ;
     }
@@ -126,9 +181,18 @@ public:
 
         va_list argList ;
         va_start( argList, strFormat ) ;
+    #if PERF_LOGGER_FILE_STREAM_ASYNC
+        AsyncLog::VFPrintfTransientFormat( sFilePointer , strFormat , argList ) ;    // Some callers format into a stack buffer and pass that as the format.
+        va_end( argList ) ;
+        if( ! AsyncLog::IsRunning() )
+        {   // AsyncLog wrote synchronously, so flush here as it would have.
+            fflush( sFilePointer ) ;
+        }
+    #else
         vfprintf( sFilePointer , strFormat , argList ) ;
         va_end( argList ) ;
         fflush( sFilePointer ) ;
+    #endif
     }
 
 private:
@@ -166,6 +230,13 @@ private:
 
     Notice TerminateAndLogAllThreads.  It is meant for the case where the profiling run terminates before Finalize and Aggregate get called automatically.
 
+    Separately, PERF_BLOCK_ENABLE_TRACING records a timeline of blocks on every thread, including worker threads that lack a main block.
+    See PerfTrace.
+
+    Timing every block costs too much for blocks inside tight loops, so PERF_BLOCK_INNER and PERF_BLOCK_FINE
+    mark such blocks, which compile out below the corresponding PERF_BLOCK_LEVEL.  For always-on attribution
+    without timing every block, see PERF_SAMPLING and PerfSampler.
+
 */
 class PerfBlock
 {
@@ -178,6 +249,7 @@ class PerfBlock
         static bool IsProfileInProgressThisThread();
         static void CrossFrameBoundaryThisThread( bool tallyEveryFrame ) ;
         static PerfTally * GetMainTallyThisThread() ;
+        static void AccumulateLoadBalanceThisThread( const PerfLoadBalanceStats & loadBalance ) ;
 
         static void TerminateAndLogAllThreads() ;
 
@@ -198,6 +270,14 @@ class PerfBlock
         LARGE_INTEGER   mCtorExitTime   ;   /// Time (in ticks) when the PerfBlock constructor exited -- used to keep track of perf overhead.
         PerfBlock *     mCaller         ;   /// PerfBlock that called (i.e. contains) this one.
         PerfTally *     mPerfTallyHead  ;   /// First PerfTally object associated with this block.  This is the head of a linked list.
+        const char *    mTraceLabel     ;   /// Label to record in the PerfTrace timeline when this block ends, or NULL if tracing was off when it began.
+        LARGE_INTEGER   mTraceBeginTime ;   /// Time (in ticks) when this block began, for PerfTrace.
+    #if PERF_COUNTERS_BACKEND != PERF_COUNTERS_BACKEND_NONE
+        PerfCounterValues mCountersBegin;   /// Hardware counters when this block began.  See PERF_COUNTERS_BACKEND.
+    #endif
+    #if NEW_WRAPPER_TRACK_ALLOCATIONS
+        AllocationCounts mAllocationsBegin ;   /// Heap allocation counts of this thread when this block began.  See NEW_WRAPPER_TRACK_ALLOCATIONS.
+    #endif
 } ;
 
 // Private variables -----------------------------------------------------------
@@ -0,0 +1,114 @@
+/** \file perfCounters.cpp
+
+    \brief Hardware performance counters sampled inside performance profiling blocks.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Core/Utility/macros.h"
+
+#include "perfCounters.h"
+
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_RDPMC
+    #include <intrin.h>     // For __readpmc
+#endif
+
+// Macros ----------------------------------------------------------------------
+
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_RDPMC
+    #define PERF_COUNTERS_RDPMC_FIXED( iFixedCounter ) ( ( 1UL << 30 ) | ( iFixedCounter ) )   ///< RDPMC index of an Intel fixed-function counter.
+#endif
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_THREAD_CYCLES
+static const char * sCounterNames[] = { "Cycles" } ;
+#elif PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_RDPMC
+static const char * sCounterNames[] = { "InstructionsRetired" , "CoreCycles" , PERF_COUNTERS_RDPMC_PMC0_NAME , PERF_COUNTERS_RDPMC_PMC1_NAME } ;
+#endif
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+/** Return number of counters the configured backend samples, which is zero if it samples none.
+*/
+/* static */ unsigned PerfCounters::GetNumCounters()
+{
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_NONE
+    return 0 ;
+#else
+    return sizeof( sCounterNames ) / sizeof( sCounterNames[ 0 ] ) ;
+#endif
+}
+
+
+
+
+/** Return name of the given counter, for logs and reports.
+*/
+/* static */ const char * PerfCounters::GetCounterName( unsigned iCounter )
+{
+    ASSERT( iCounter < GetNumCounters() ) ;
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_NONE
+    UNUSED_PARAM( iCounter ) ;
+    return "" ;
+#else
+    return sCounterNames[ iCounter ] ;
+#endif
+}
+
+
+
+
+/** Return index of the counter that counts instructions retired, or -1 if no counter does.
+
+    Reports divide other counts (e.g. cache or TLB misses) by this to get
+    rates per instruction, which, unlike raw counts, compare across
+    problem sizes.
+*/
+/* static */ int PerfCounters::GetInstructionsCounterIndex()
+{
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_RDPMC
+    return 0 ;
+#else
+    return -1 ;
+#endif
+}
+
+
+
+
+/** Take a snapshot of counters for the current thread.
+*/
+/* static */ void PerfCounters::ReadThisThread( PerfCounterValues & values )
+{
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_THREAD_CYCLES
+    QueryThreadCycleTime( GetCurrentThread() , & values.mCounts[ 0 ] ) ;
+#elif PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_RDPMC
+    values.mCounts[ 0 ] = __readpmc( PERF_COUNTERS_RDPMC_FIXED( 0 ) ) ;
+    values.mCounts[ 1 ] = __readpmc( PERF_COUNTERS_RDPMC_FIXED( 1 ) ) ;
+    values.mCounts[ 2 ] = __readpmc( 0 ) ;
+    values.mCounts[ 3 ] = __readpmc( 1 ) ;
+#else
+    UNUSED_PARAM( values ) ;
+#endif
+}
+
+
+
+
+/** Take a snapshot of counters summed across all threads of this process.
+
+    PERF_COUNTERS_BACKEND_RDPMC cannot sum across threads, so with that backend,
+    this reads counters of the core running the current thread only.
+*/
+/* static */ void PerfCounters::ReadThisProcess( PerfCounterValues & values )
+{
+#if PERF_COUNTERS_BACKEND == PERF_COUNTERS_BACKEND_THREAD_CYCLES
+    QueryProcessCycleTime( GetCurrentProcess() , & values.mCounts[ 0 ] ) ;
+#else
+    ReadThisThread( values ) ;
+#endif
+}
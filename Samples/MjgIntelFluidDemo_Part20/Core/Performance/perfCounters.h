@@ -0,0 +1,156 @@
+/** \file perfCounters.h
+
+    \brief Hardware performance counters sampled inside performance profiling blocks.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#if defined( _XBOX )
+    #include <xtl.h>        // For ULONGLONG
+#elif defined( WIN32 )
+    #include <windows.h>    // For ULONGLONG
+    #ifdef min
+        #undef min
+    #endif
+    #ifdef max
+        #undef max
+    #endif
+#else
+    #error "unknown platform"
+#endif
+
+// Macros ----------------------------------------------------------------------
+
+/// Do not sample hardware counters.  PerfBlock records wall-clock ticks only.
+#define PERF_COUNTERS_BACKEND_NONE          0
+
+/** Sample CPU cycles the current thread consumed, via QueryThreadCycleTime.
+
+    This works without special privileges.  Comparing cycles with wall-clock
+    duration reveals blocks that wait (on locks, I/O or other threads)
+    rather than compute.
+*/
+#define PERF_COUNTERS_BACKEND_THREAD_CYCLES 1
+
+/** Sample core performance monitoring counters (PMC), via the RDPMC instruction.
+
+    This reads Intel fixed counters for instructions retired and unhalted core
+    cycles, and general-purpose counters 0 and 1, which a counter driver or
+    tool (e.g. Intel VTune or PCM) must program, and must enable user-mode RDPMC
+    for, before the process runs.  Otherwise RDPMC faults.  By default, names
+    of general-purpose counters assume they count last-level cache misses and
+    mispredicted branches; see PERF_COUNTERS_RDPMC_EVENTS for other choices.
+
+    These counters belong to the core, not the thread, so a block that the
+    operating system migrates to another core mid-block reads garbage.
+    Pin threads (set FLUID_PIN_THREADS) for meaningful numbers.
+*/
+#define PERF_COUNTERS_BACKEND_RDPMC         2
+
+/** Which hardware counter backend PerfBlock samples.
+
+    Sampling adds overhead to every profiling block, so this is off by default.
+*/
+#if ! defined( PERF_COUNTERS_BACKEND )
+#   define PERF_COUNTERS_BACKEND PERF_COUNTERS_BACKEND_NONE
+#endif
+
+/// General-purpose counters count last-level cache misses (LONGEST_LAT_CACHE.MISS) and mispredicted branches (BR_MISP_RETIRED.ALL_BRANCHES).
+#define PERF_COUNTERS_RDPMC_EVENTS_CACHE_AND_BRANCH 0
+
+/** General-purpose counters count data TLB misses that caused page walks, for loads and stores.
+
+    On recent Intel cores, program them with DTLB_LOAD_MISSES.MISS_CAUSES_A_WALK
+    and DTLB_STORE_MISSES.MISS_CAUSES_A_WALK (or .WALK_COMPLETED, depending on
+    microarchitecture).  Compare runs with and without USE_LARGE_PAGES to
+    measure what large pages save.
+*/
+#define PERF_COUNTERS_RDPMC_EVENTS_TLB              1
+
+/** Which events the tool that programs general-purpose counters assigned to them, which determines their names in logs and reports.
+
+    This only names counters; the tool that programs them decides what they count.
+*/
+#if ! defined( PERF_COUNTERS_RDPMC_EVENTS )
+#   define PERF_COUNTERS_RDPMC_EVENTS PERF_COUNTERS_RDPMC_EVENTS_CACHE_AND_BRANCH
+#endif
+
+#if ! defined( PERF_COUNTERS_RDPMC_PMC0_NAME )
+#   if PERF_COUNTERS_RDPMC_EVENTS == PERF_COUNTERS_RDPMC_EVENTS_TLB
+#       define PERF_COUNTERS_RDPMC_PMC0_NAME "DtlbLoadMissWalks"    ///< Name of what general-purpose counter 0 counts, for logs and reports.
+#   else
+#       define PERF_COUNTERS_RDPMC_PMC0_NAME "LlcMisses"            ///< Name of what general-purpose counter 0 counts, for logs and reports.
+#   endif
+#endif
+
+#if ! defined( PERF_COUNTERS_RDPMC_PMC1_NAME )
+#   if PERF_COUNTERS_RDPMC_EVENTS == PERF_COUNTERS_RDPMC_EVENTS_TLB
+#       define PERF_COUNTERS_RDPMC_PMC1_NAME "DtlbStoreMissWalks"   ///< Name of what general-purpose counter 1 counts, for logs and reports.
+#   else
+#       define PERF_COUNTERS_RDPMC_PMC1_NAME "BranchMispredicts"    ///< Name of what general-purpose counter 1 counts, for logs and reports.
+#   endif
+#endif
+
+// Types -----------------------------------------------------------------------
+
+/** Snapshot, or sum of differences, of hardware performance counters.
+*/
+struct PerfCounterValues
+{
+    static const unsigned MAX_NUM_COUNTERS = 4 ;    ///< Maximum number of counters any backend samples.
+
+    PerfCounterValues()
+    {
+        Reset() ;
+    }
+
+    void Reset()
+    {
+        for( unsigned iCounter = 0 ; iCounter < MAX_NUM_COUNTERS ; ++ iCounter )
+        {
+            mCounts[ iCounter ] = 0 ;
+        }
+    }
+
+    /// Accumulate the difference between two snapshots into this.
+    void AccumulateDifference( const PerfCounterValues & end , const PerfCounterValues & begin )
+    {
+        for( unsigned iCounter = 0 ; iCounter < MAX_NUM_COUNTERS ; ++ iCounter )
+        {
+            mCounts[ iCounter ] += end.mCounts[ iCounter ] - begin.mCounts[ iCounter ] ;
+        }
+    }
+
+    /// Accumulate another sum into this.
+    void Accumulate( const PerfCounterValues & that )
+    {
+        for( unsigned iCounter = 0 ; iCounter < MAX_NUM_COUNTERS ; ++ iCounter )
+        {
+            mCounts[ iCounter ] += that.mCounts[ iCounter ] ;
+        }
+    }
+
+    ULONGLONG   mCounts[ MAX_NUM_COUNTERS ] ;   ///< Value of each counter.  Only the first PerfCounters::GetNumCounters() are meaningful.
+} ;
+
+
+
+
+/** Hardware performance counters, as the configured PERF_COUNTERS_BACKEND provides them.
+*/
+class PerfCounters
+{
+    public:
+        static unsigned     GetNumCounters() ;
+        static const char * GetCounterName( unsigned iCounter ) ;
+        static int          GetInstructionsCounterIndex() ;
+        static void         ReadThisThread( PerfCounterValues & values ) ;
+        static void         ReadThisProcess( PerfCounterValues & values ) ;
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
@@ -0,0 +1,125 @@
+/** \file perfGpu.cpp
+
+    \brief Durations of GPU render passes, as GPU timestamp queries measure them.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Core/Utility/macros.h"
+
+#include "perfTrace.h"
+#include "perfGpu.h"
+
+#include <string.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/* static */ PerfGpuPassStats   PerfGpuLane::sPasses[ PERF_GPU_MAX_PASSES ] ;
+/* static */ size_t             PerfGpuLane::sNumPasses     = 0 ;
+/* static */ DWORD              PerfGpuLane::sRecordingThreadId = 0 ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+/** Record one completed execution of a GPU pass.
+
+    \param label        Name of pass.  Must persist for the process lifetime, as string literals do.
+
+    \param beginTime    Time (in CPU ticks, as QueryPerformanceCounter reports them) when the GPU began the pass.
+
+    \param endTime      Time (in CPU ticks) when the GPU finished the pass.
+*/
+/* static */ void PerfGpuLane::RecordPass( const char * label , LONGLONG beginTime , LONGLONG endTime )
+{
+    sRecordingThreadId = GetCurrentThreadId() ;
+
+    if( PerfTrace::IsRecording() )
+    {
+        PerfTrace::RecordGpuEvent( label , beginTime , endTime ) ;
+    }
+
+    size_t iPass = 0 ;
+    while( ( iPass < sNumPasses ) && ( sPasses[ iPass ].mLabel != label ) && ( strcmp( sPasses[ iPass ].mLabel , label ) != 0 ) )
+    {   // For each pass already tallied, until finding the one with this label...
+        ++ iPass ;
+    }
+
+    if( iPass == sNumPasses )
+    {   // This is the first execution of this pass.
+        if( sNumPasses >= PERF_GPU_MAX_PASSES )
+        {   // No room to tally another label.
+            return ;
+        }
+        PerfGpuPassStats & newPass = sPasses[ sNumPasses ] ;
+        newPass.mLabel      = label ;
+        newPass.mNumCalls   = 0 ;
+        newPass.mTotalTicks = 0.0 ;
+        newPass.mMaxTicks   = 0.0 ;
+        ++ sNumPasses ;
+    }
+
+    PerfGpuPassStats & pass     = sPasses[ iPass ] ;
+    const double durationTicks  = double( endTime - beginTime ) ;
+    ++ pass.mNumCalls ;
+    pass.mTotalTicks += durationTicks ;
+    pass.mMaxTicks    = Max2( pass.mMaxTicks , durationTicks ) ;
+}
+
+
+
+
+/** Log durations of each GPU pass recorded since the most recent Reset.
+
+    In table format, this writes a section of its own, after the call graph
+    of a thread, with one row per pass, durations in milliseconds.  In call
+    graph format, each pass becomes a callee of a node named GPU.
+*/
+/* static */ void PerfGpuLane::Log( PerfLogFunc logFunc , PerfTally::PerfLogFormat perfLogFormat )
+{
+    ASSERT( logFunc ) ;
+
+    if( 0 == sNumPasses )
+    {   // No GPU timer recorded anything, so omit the section entirely.
+        return ;
+    }
+
+    const double milliSecondsPerTick = PerfTally::MilliSecondsPerTick() ;
+
+    if( PerfTally::PERF_LOG_FORMAT_TABLE == perfLogFormat )
+    {
+        logFunc( "GpuPass,NumCalls,TotDur,AvgDur,MaxDur\n" ) ;
+    }
+
+    for( size_t iPass = 0 ; iPass < sNumPasses ; ++ iPass )
+    {   // For each pass...
+        const PerfGpuPassStats & pass = sPasses[ iPass ] ;
+        if( PerfTally::PERF_LOG_FORMAT_TABLE == perfLogFormat )
+        {
+            logFunc( "%s,%u,%g,%g,%g\n"
+                , pass.mLabel
+                , pass.mNumCalls
+                , pass.mTotalTicks * milliSecondsPerTick
+                , pass.mNumCalls > 0 ? pass.mTotalTicks * milliSecondsPerTick / double( pass.mNumCalls ) : 0.0
+                , pass.mMaxTicks * milliSecondsPerTick
+                ) ;
+        }
+        else
+        {
+            ASSERT( PerfTally::PERF_LOG_FORMAT_CALL_GRAPH == perfLogFormat ) ;
+            logFunc( "  GPU -> %s ;\n" , pass.mLabel ) ;
+        }
+    }
+}
+
+
+
+
+/** Discard statistics of all GPU passes.
+*/
+/* static */ void PerfGpuLane::Reset()
+{
+    sNumPasses = 0 ;
+}
@@ -0,0 +1,71 @@
+/** \file perfGpu.h
+
+    \brief Durations of GPU render passes, as GPU timestamp queries measure them.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PERF_GPU_H
+#define PERF_GPU_H
+
+#include "perfTally.h"  // For PerfLogFunc, PerfTally::PerfLogFormat, LONGLONG
+
+// Macros ----------------------------------------------------------------------
+
+/// Maximum number of distinct GPU pass labels PerfGpuLane can aggregate.  Passes with other labels go untallied, but still appear in traces.
+#define PERF_GPU_MAX_PASSES 64
+
+// Types -----------------------------------------------------------------------
+
+/** Sums of durations of one GPU pass, across executions.
+*/
+struct PerfGpuPassStats
+{
+    const char *    mLabel          ;   ///< Name of pass.  Must persist for the process lifetime, as string literals do.
+    unsigned        mNumCalls       ;   ///< Number of times the pass ran.
+    double          mTotalTicks     ;   ///< Duration of every execution, summed, in CPU ticks.
+    double          mMaxTicks       ;   ///< Duration of longest execution, in CPU ticks.
+} ;
+
+
+
+
+/** GPU lane of performance profiles: how long the GPU spent on each render pass.
+
+    PerfBlock measures CPU time, so render cost only shows up indirectly, as
+    time the CPU spends blocked in buffer swaps or buffer maps.  A GPU timer
+    (see PeGaSys::Render::GpuTimerBase) brackets each render pass with
+    timestamp queries, reads their results a few frames later, once the GPU
+    has finished with them, converts them to CPU ticks, and records them
+    here.
+
+    This aggregates passes by label, like PerfTally does for blocks on a
+    thread, without a call tree, and forwards each pass to PerfTrace so
+    traces show a "GPU" lane alongside CPU threads.  PerfBlock logs the
+    aggregate after the call graph of the thread that records passes, when
+    that thread finalizes profiling, then resets it.
+
+    Only the render thread records passes, so this takes no locks.
+*/
+class PerfGpuLane
+{
+    public:
+        static void RecordPass( const char * label , LONGLONG beginTime , LONGLONG endTime ) ;
+        static void Log( PerfLogFunc logFunc , PerfTally::PerfLogFormat perfLogFormat ) ;
+        static void Reset() ;
+
+        /// Return number of distinct pass labels recorded since the most recent Reset.
+        static size_t GetNumPasses() { return sNumPasses ; }
+
+        /// Return whether the current thread is the one that records passes.
+        static bool IsRecordingThread() { return GetCurrentThreadId() == sRecordingThreadId ; }
+
+    private:
+        static PerfGpuPassStats sPasses[ PERF_GPU_MAX_PASSES ]  ;   ///< Statistics of each pass label.
+        static size_t           sNumPasses                      ;   ///< Number of populated elements in sPasses.
+        static DWORD            sRecordingThreadId              ;   ///< Identifier of thread that most recently recorded a pass, or 0 if none has.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
@@ -0,0 +1,84 @@
+/** \file perfLoadBalance.h
+
+    \brief Load balance statistics of parallel loops run inside performance profiling blocks.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PERF_LOAD_BALANCE_H
+#define PERF_LOAD_BALANCE_H
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether Parallel::For and Parallel::For3d measure how evenly their chunks spread across threads.
+
+    PerfBlock reports inclusive duration for the thread that opened a block,
+    so a parallel loop that takes 8ms could be 8 threads each busy for 8ms,
+    or one thread busy for 8ms while the rest idle.  When this is enabled
+    (and USE_TBB and PROFILE are too), each loop times every chunk it runs,
+    on every thread, and adds a summary to the PerfTally of the innermost
+    PerfBlock on the thread that started the loop.  PerfTally logs then
+    report, per block: number of loops and chunks, mean and maximum chunk
+    duration, mean and maximum busy time per thread, imbalance ratio (busiest
+    thread over mean) and efficiency (mean busy time over wall-clock time).
+
+    Parallel::Reduce is not measured, since wrapping its splitting bodies
+    would change how it copies them.
+
+    Timing each chunk costs two timer reads, so this is off by default.
+*/
+#if ! defined( PERF_MEASURE_LOAD_BALANCE )
+#   define PERF_MEASURE_LOAD_BALANCE 0
+#endif
+
+// Types -----------------------------------------------------------------------
+
+/** Sums, across parallel loops, of load balance measurements, in ticks.
+
+    \see PERF_MEASURE_LOAD_BALANCE
+*/
+struct PerfLoadBalanceStats
+{
+    PerfLoadBalanceStats()
+    {
+        Reset() ;
+    }
+
+    void Reset()
+    {
+        mNumLoops                   = 0 ;
+        mNumChunks                  = 0.0 ;
+        mWallTicks                  = 0.0 ;
+        mBusyTicks                  = 0.0 ;
+        mMeanBusyPerThreadTicks     = 0.0 ;
+        mMaxBusyPerThreadTicks      = 0.0 ;
+        mMaxChunkTicks              = 0.0 ;
+    }
+
+    /// Accumulate another sum into this.
+    void Accumulate( const PerfLoadBalanceStats & that )
+    {
+        mNumLoops                   += that.mNumLoops ;
+        mNumChunks                  += that.mNumChunks ;
+        mWallTicks                  += that.mWallTicks ;
+        mBusyTicks                  += that.mBusyTicks ;
+        mMeanBusyPerThreadTicks     += that.mMeanBusyPerThreadTicks ;
+        mMaxBusyPerThreadTicks      += that.mMaxBusyPerThreadTicks ;
+        mMaxChunkTicks              =  ( that.mMaxChunkTicks > mMaxChunkTicks ) ? that.mMaxChunkTicks : mMaxChunkTicks ;
+    }
+
+    /// Return ratio of busiest thread's busy time to mean busy time per thread.  One means perfect balance.
+    double GetImbalance() const     { return ( mMeanBusyPerThreadTicks > 0.0 ) ? mMaxBusyPerThreadTicks / mMeanBusyPerThreadTicks : 0.0 ; }
+
+    /// Return fraction of wall-clock time threads spent running chunks.  The remainder is idle or scheduling time.
+    double GetEfficiency() const    { return ( mWallTicks > 0.0 ) ? mMeanBusyPerThreadTicks / mWallTicks : 0.0 ; }
+
+    unsigned    mNumLoops               ;   ///< Number of parallel loops measured.
+    double      mNumChunks              ;   ///< Number of chunks those loops ran, summed across loops.
+    double      mWallTicks              ;   ///< Wall-clock duration of each loop, summed across loops.
+    double      mBusyTicks              ;   ///< Duration of every chunk, summed across threads and loops.
+    double      mMeanBusyPerThreadTicks ;   ///< Duration of chunks each loop ran, divided by that loop's number of threads, summed across loops.
+    double      mMaxBusyPerThreadTicks  ;   ///< Duration of chunks the busiest thread of each loop ran, summed across loops.
+    double      mMaxChunkTicks          ;   ///< Duration of longest chunk of any loop.
+} ;
+
+#endif
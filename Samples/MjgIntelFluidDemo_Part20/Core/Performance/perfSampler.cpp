@@ -0,0 +1,393 @@
+/** \file perfSampler.cpp
+
+    \brief Statistical sampling of the active PerfBlock stack of each thread.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Core/Utility/macros.h"
+
+#include "perfTally.h"      // For SpinLock, THREAD_LOCAL_STORAGE
+#include "perfBlock.h"      // For PerfLoggerStdout
+#include "perfSampler.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+THREAD_LOCAL_STORAGE PerfSampleStack *  sTlsSampleStack                         = NULLPTR   ;   ///< Sampled stack of the current thread, or NULL if it has not yet pushed a label.
+static SpinLock                         sSampleStackLock                                    ;   ///< Mutex for registering thread stacks.
+
+/* static */ PerfSampleStack *          PerfSampler::sStacks[ PERF_SAMPLE_MAX_THREADS ]     ;
+/* static */ volatile long              PerfSampler::sNumStacks                 = 0         ;
+/* static */ PerfSampler::StackTally *  PerfSampler::sTallies                   = NULLPTR   ;
+/* static */ unsigned long              PerfSampler::sNumSamples                = 0         ;
+/* static */ unsigned long              PerfSampler::sNumUntallied              = 0         ;
+/* static */ HANDLE                     PerfSampler::sSamplerThread             = NULL      ;
+/* static */ DWORD                      PerfSampler::sSamplePeriodMs            = 1000 / PERF_SAMPLE_DEFAULT_RATE ;
+/* static */ volatile bool              PerfSampler::sIsSampling                = false     ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Return a hash of the given thread and stack of labels.
+
+    Labels are string literals, so their addresses identify them.
+*/
+static size_t HashStack( size_t threadIndex , const char * const * labels , size_t depth )
+{
+    size_t hash = threadIndex * 2654435761u ;
+    for( size_t iLabel = 0 ; iLabel < depth ; ++ iLabel )
+    {
+        hash = ( hash ^ reinterpret_cast< size_t >( labels[ iLabel ] ) ) * 16777619u ;
+    }
+    return hash ;
+}
+
+// Public functions ------------------------------------------------------------
+
+/** Return sampled stack of the current thread, registering it if necessary, or NULL if too many threads have registered.
+
+    A thread that found no room keeps looking, so each of its pushes takes the lock.
+    That only happens beyond PERF_SAMPLE_MAX_THREADS threads.
+*/
+/* static */ PerfSampleStack * PerfSampler::GetOrCreateStackThisThread()
+{
+    if( sTlsSampleStack )
+    {
+        return sTlsSampleStack ;
+    }
+
+    ScopedSpinLock lock( sSampleStackLock ) ;
+    if( sNumStacks >= PERF_SAMPLE_MAX_THREADS )
+    {   // No room to register another thread.  Leave its blocks unsampled.
+        return NULLPTR ;
+    }
+
+    PerfSampleStack * stack = new PerfSampleStack ;
+    memset( stack , 0 , sizeof( * stack ) ) ;
+    stack->mThreadId = GetCurrentThreadId() ;
+    sStacks[ sNumStacks ] = stack ;
+    ++ sNumStacks ;  // Publish stack after initializing it.
+
+    sTlsSampleStack = stack ;
+    return stack ;
+}
+
+
+
+
+/** Push the given label onto the sampled stack of the current thread.
+
+    \param label    Name of block.  Must persist for the process lifetime, as string literals do.
+*/
+/* static */ void PerfSampler::PushThisThread( const char * label )
+{
+    PerfSampleStack * stack = GetOrCreateStackThisThread() ;
+    if( NULLPTR == stack )
+    {
+        return ;
+    }
+    const long depth = stack->mDepth ;
+    if( depth < PERF_SAMPLE_MAX_DEPTH )
+    {
+        stack->mLabels[ depth ] = label ;
+    }
+    stack->mDepth = depth + 1 ;  // Publish label after writing it.
+}
+
+
+
+
+/** Pop the innermost label from the sampled stack of the current thread.
+*/
+/* static */ void PerfSampler::PopThisThread()
+{
+    PerfSampleStack * stack = sTlsSampleStack ;
+    if( stack && ( stack->mDepth > 0 ) )
+    {
+        -- stack->mDepth ;
+    }
+}
+
+
+
+
+/** Name the current thread in sampled stacks.
+
+    \param threadName   Name of thread.  Must persist while sampling, or until this thread names itself again.
+*/
+/* static */ void PerfSampler::SetThreadNameThisThread( const char * threadName )
+{
+    PerfSampleStack * stack = GetOrCreateStackThisThread() ;
+    if( stack )
+    {
+        stack->mThreadName = threadName ;
+    }
+}
+
+
+
+
+/** Start a thread that samples the stack of every thread at the given rate.
+
+    \param samplesPerSecond     Number of samples per second.  Rates beyond the resolution of Sleep, typically 1 to 16 milliseconds, take fewer samples.
+
+    \return Whether sampling started.
+
+    Sampling continues from the previous session's tally, unless Reset was called in between.
+*/
+/* static */ bool PerfSampler::Start( unsigned samplesPerSecond )
+{
+    Stop() ;
+
+    if( NULLPTR == sTallies )
+    {
+        sTallies = new StackTally[ PERF_SAMPLE_MAX_STACKS ] ;
+        Reset() ;
+    }
+
+    sSamplePeriodMs = ( samplesPerSecond > 0 ) ? Max2( DWORD( 1 ) , DWORD( 1000 / samplesPerSecond ) ) : DWORD( 1000 / PERF_SAMPLE_DEFAULT_RATE ) ;
+    sIsSampling     = true ;
+    sSamplerThread  = CreateThread( NULL , 0 , SamplerThreadMain , NULL , 0 , NULL ) ;
+    if( NULL == sSamplerThread )
+    {
+        sIsSampling = false ;
+        return false ;
+    }
+    SetThreadPriority( sSamplerThread , THREAD_PRIORITY_TIME_CRITICAL ) ;  // Wake on time, even when all cores are busy.
+    return true ;
+}
+
+
+
+
+/** Stop the sampler thread, if it is running, retaining its tally.
+*/
+/* static */ void PerfSampler::Stop()
+{
+    if( ! sIsSampling )
+    {
+        return ;
+    }
+    sIsSampling = false ;
+    WaitForSingleObject( sSamplerThread , INFINITE ) ;
+    CloseHandle( sSamplerThread ) ;
+    sSamplerThread = NULL ;
+}
+
+
+
+
+/** Discard all samples.
+
+    Only call this while not sampling.
+*/
+/* static */ void PerfSampler::Reset()
+{
+    ASSERT( ! sIsSampling ) ;
+    if( sTallies )
+    {
+        for( size_t iTally = 0 ; iTally < PERF_SAMPLE_MAX_STACKS ; ++ iTally )
+        {
+            sTallies[ iTally ].mCount = 0 ;
+        }
+    }
+    sNumSamples     = 0 ;
+    sNumUntallied   = 0 ;
+}
+
+
+
+
+/** Take samples until Stop.
+*/
+/* static */ DWORD WINAPI PerfSampler::SamplerThreadMain( LPVOID context )
+{
+    UNUSED_PARAM( context ) ;
+
+    while( sIsSampling )
+    {
+        Sleep( sSamplePeriodMs ) ;
+        SampleAllThreads() ;
+    }
+    return 0 ;
+}
+
+
+
+
+/** Copy the stack of each registered thread into the tally.
+
+    This reads stacks other threads write, without locking.  See PerfSampleStack.
+*/
+/* static */ void PerfSampler::SampleAllThreads()
+{
+    const size_t numStacks = sNumStacks ;
+    for( size_t iThread = 0 ; iThread < numStacks ; ++ iThread )
+    {   // For each thread...
+        const PerfSampleStack & stack = * sStacks[ iThread ] ;
+        const long              depth = stack.mDepth ;
+        const size_t            numLabels = Min2( size_t( depth > 0 ? depth : 0 ) , size_t( PERF_SAMPLE_MAX_DEPTH ) ) ;
+
+        const char * labels[ PERF_SAMPLE_MAX_DEPTH ] ;
+        for( size_t iLabel = 0 ; iLabel < numLabels ; ++ iLabel )
+        {
+            labels[ iLabel ] = stack.mLabels[ iLabel ] ;
+        }
+        TallySample( iThread , labels , numLabels ) ;
+    }
+}
+
+
+
+
+/** Add one sample of the given stack of the given thread to the tally.
+*/
+/* static */ void PerfSampler::TallySample( size_t threadIndex , const char * const * labels , size_t depth )
+{
+    ++ sNumSamples ;
+
+    const size_t hash = HashStack( threadIndex , labels , depth ) ;
+    for( size_t iProbe = 0 ; iProbe < PERF_SAMPLE_MAX_STACKS ; ++ iProbe )
+    {   // Probe linearly for this stack's tally, or an empty one.
+        StackTally & tally = sTallies[ ( hash + iProbe ) % PERF_SAMPLE_MAX_STACKS ] ;
+        if( 0 == tally.mCount )
+        {   // Found empty slot, so this stack has no tally yet.
+            memcpy( tally.mLabels , labels , depth * sizeof( labels[ 0 ] ) ) ;
+            tally.mDepth        = depth ;
+            tally.mThreadIndex  = threadIndex ;
+            tally.mCount        = 1 ;
+            return ;
+        }
+        if(     ( tally.mThreadIndex == threadIndex )
+            &&  ( tally.mDepth == depth )
+            &&  ( 0 == memcmp( tally.mLabels , labels , depth * sizeof( labels[ 0 ] ) ) ) )
+        {   // Found this stack's tally.
+            ++ tally.mCount ;
+            return ;
+        }
+    }
+    ++ sNumUntallied ;  // Table is full.
+}
+
+
+
+
+/** Log each distinct stack sampled since the most recent Reset, with its number of samples, as folded stacks.
+
+    Each line names the thread, then each block outermost first, separated by semicolons, then the count.
+    Samples that found a thread outside every block appear as just the thread name.
+
+    Only call this while not sampling.
+*/
+/* static */ void PerfSampler::Log( PerfLogFunc logFunc )
+{
+    ASSERT( logFunc ) ;
+    ASSERT( ! sIsSampling ) ;
+
+    if( NULLPTR == sTallies )
+    {
+        return ;
+    }
+
+    for( size_t iTally = 0 ; iTally < PERF_SAMPLE_MAX_STACKS ; ++ iTally )
+    {   // For each tallied stack...
+        const StackTally & tally = sTallies[ iTally ] ;
+        if( 0 == tally.mCount )
+        {
+            continue ;
+        }
+
+        const PerfSampleStack & stack = * sStacks[ tally.mThreadIndex ] ;
+        if( stack.mThreadName )
+        {
+            logFunc( "%s" , stack.mThreadName ) ;
+        }
+        else
+        {   // Worker threads lack a PERF_BLOCK_MAIN, so name them by identifier.
+            logFunc( "thread%lu" , (unsigned long) stack.mThreadId ) ;
+        }
+        for( size_t iLabel = 0 ; iLabel < tally.mDepth ; ++ iLabel )
+        {
+            logFunc( ";%s" , tally.mLabels[ iLabel ] ) ;
+        }
+        logFunc( " %lu\n" , tally.mCount ) ;
+    }
+
+    if( sNumUntallied > 0 )
+    {
+        logFunc( "(untallied) %lu\n" , sNumUntallied ) ;
+    }
+}
+
+
+
+
+static FILE * sFoldedStacksFile = NULLPTR ;   ///< File to which FoldedStacksFileLogFunc writes.
+
+/** Write formatted output to sFoldedStacksFile.
+*/
+static void FoldedStacksFileLogFunc( const char * strFormat , ... )
+{
+    va_list argList ;
+    va_start( argList , strFormat ) ;
+    vfprintf( sFoldedStacksFile , strFormat , argList ) ;
+    va_end( argList ) ;
+}
+
+
+
+
+/** Write folded stacks to the given file, stopping sampling first.
+
+    \return Whether the file was written.
+
+    \see Log
+*/
+/* static */ bool PerfSampler::WriteFoldedStacks( const char * filename )
+{
+    Stop() ;
+
+    sFoldedStacksFile = fopen( filename , "w" ) ;
+    if( NULLPTR == sFoldedStacksFile )
+    {
+        return false ;
+    }
+    Log( FoldedStacksFileLogFunc ) ;
+    fclose( sFoldedStacksFile ) ;
+    sFoldedStacksFile = NULLPTR ;
+    return true ;
+}
+
+
+
+
+#if defined( UNIT_TEST )
+
+/** Spin inside a nested sampled block, then check that samples found it.
+*/
+void PerfSampler::UnitTest()
+{
+    Reset() ;
+    Start( 1000 ) ;
+    {
+        PerfSampleScope outer( "PerfSampler_UnitTest_outer" ) ;
+        PerfSampleScope inner( "PerfSampler_UnitTest_inner" ) ;
+        const DWORD startMs = GetTickCount() ;
+        while( GetTickCount() - startMs < 100 )
+        {   // Busy-wait, so samples find this thread inside both blocks.
+        }
+    }
+    Stop() ;
+
+    ASSERT( GetNumSamples() > 0 ) ;
+    Log( PerfLoggerStdout::LogFunc ) ;
+    Reset() ;
+}
+
+#endif
@@ -0,0 +1,180 @@
+/** \file perfSampler.h
+
+    \brief Statistical sampling of the active PerfBlock stack of each thread.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PERF_SAMPLER_H
+#define PERF_SAMPLER_H
+
+#if defined( _XBOX )
+    #include <xtl.h>
+#elif defined( WIN32 )
+    #include <windows.h>    // For DWORD, HANDLE
+    #ifdef min
+        #undef min
+    #endif
+    #ifdef max
+        #undef max
+    #endif
+#else
+    #error "unknown platform"
+#endif
+
+#include <stddef.h>
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether PERF_BLOCK also maintains a stack of labels per thread, which PerfSampler samples.
+
+    Pushing and popping a label costs a thread-local lookup and two stores,
+    with no timer query and no tally lookup, so this can stay on in builds
+    without PROFILE.  Time then goes to blocks in proportion to how often
+    the sampler finds them on the stack.
+*/
+#if ! defined( PERF_SAMPLING )
+    #define PERF_SAMPLING 0
+#endif
+
+/// Deepest stack of labels a thread can record.  Deeper blocks go unrecorded, and samples attribute their time to their callers.
+#define PERF_SAMPLE_MAX_DEPTH       32
+
+/// Maximum number of threads whose stacks PerfSampler samples.  Blocks on further threads go unsampled.
+#define PERF_SAMPLE_MAX_THREADS     64
+
+/// Maximum number of distinct stacks PerfSampler tallies.  Samples of further stacks count toward a catch-all total.
+#define PERF_SAMPLE_MAX_STACKS      4096
+
+/// Default number of samples PerfSampler takes per second, of each thread.
+#define PERF_SAMPLE_DEFAULT_RATE    200
+
+#if PERF_SAMPLING
+    #define PERF_SAMPLE_SCOPE( label )              PerfSampleScope perfSample_ ## label ## _( # label ) ;
+    #define PERF_SAMPLE_THREAD_NAME( threadName )   PerfSampler::SetThreadNameThisThread( threadName ) ;
+#else
+    #define PERF_SAMPLE_SCOPE( label )
+    #define PERF_SAMPLE_THREAD_NAME( threadName )
+#endif
+
+// Types -----------------------------------------------------------------------
+
+typedef void (*PerfLogFunc)( const char * strFormat , ... ) ;
+
+/** Stack of labels of the blocks that one thread is currently inside.
+
+    Only the owning thread writes this.  The sampler thread reads it without
+    locking, so a sample can catch a push or pop half-done; labels are
+    string literals, so a stale label is still valid to read, and such
+    samples are rare enough not to skew statistics.
+*/
+struct PerfSampleStack
+{
+    const char * volatile   mLabels[ PERF_SAMPLE_MAX_DEPTH ]    ;   ///< Labels of active blocks, outermost first.
+    volatile long           mDepth                              ;   ///< Number of active blocks, including any beyond PERF_SAMPLE_MAX_DEPTH.
+    const char * volatile   mThreadName                         ;   ///< Name of thread, from PERF_BLOCK_MAIN, or NULL.
+    DWORD                   mThreadId                           ;   ///< Identifier of thread that owns this stack.
+} ;
+
+
+
+
+/** Statistical sampling of the active PerfBlock stack of each thread.
+
+    PerfBlock measures every execution of every block, which costs two timer
+    queries and a tally lookup each time, too much to leave fine-grained
+    blocks on in production.  With PERF_SAMPLING, each PERF_BLOCK instead
+    (or also) pushes its label onto a stack for its thread, and a sampler
+    thread periodically copies every thread's stack into a tally of how
+    often each distinct stack was active.
+
+    A stack found in N of M samples of a thread accounts for roughly N/M of
+    that thread's wall-clock time, including time spent waiting, such as for
+    locks or the GPU.  Sampling costs nothing on the sampled threads beyond
+    the pushes and pops; the sampler thread sleeps between samples.
+
+    Log writes the tally as "folded stacks", one line per stack, which is
+    the input format of flame graph tools:
+
+    \verbatim
+        main;InteSiVis__UpdateSimulation;VortonSim__Update 1234
+    \endverbatim
+
+    Usage:
+
+    \verbatim
+        PerfSampler::Start( PERF_SAMPLE_DEFAULT_RATE ) ;
+        ...run...
+        PerfSampler::Stop() ;
+        PerfSampler::WriteFoldedStacks( "perfSamples.txt" ) ;
+    \endverbatim
+*/
+class PerfSampler
+{
+    public:
+        static bool Start( unsigned samplesPerSecond = PERF_SAMPLE_DEFAULT_RATE ) ;
+        static void Stop() ;
+
+        /// Return whether the sampler thread is running.
+        static bool IsSampling() { return sIsSampling ; }
+
+        static void PushThisThread( const char * label ) ;
+        static void PopThisThread() ;
+        static void SetThreadNameThisThread( const char * threadName ) ;
+
+        static void Log( PerfLogFunc logFunc ) ;
+        static bool WriteFoldedStacks( const char * filename ) ;
+        static void Reset() ;
+
+        /// Return total number of samples taken since the most recent Reset, including those of stacks not tallied individually.
+        static unsigned long GetNumSamples() { return sNumSamples ; }
+
+        static void UnitTest() ;
+
+    private:
+        /** Number of samples of one distinct stack of one thread.
+        */
+        struct StackTally
+        {
+            const char *    mLabels[ PERF_SAMPLE_MAX_DEPTH ]    ;   ///< Labels of blocks in stack, outermost first.
+            size_t          mDepth                              ;   ///< Number of populated elements of mLabels.
+            size_t          mThreadIndex                        ;   ///< Index into sStacks of thread whose stack this was.
+            unsigned long   mCount                              ;   ///< Number of samples that found this stack.
+        } ;
+
+        static PerfSampleStack *    GetOrCreateStackThisThread() ;
+        static void                 SampleAllThreads() ;
+        static void                 TallySample( size_t threadIndex , const char * const * labels , size_t depth ) ;
+        static DWORD WINAPI         SamplerThreadMain( LPVOID context ) ;
+
+        static PerfSampleStack *    sStacks[ PERF_SAMPLE_MAX_THREADS ]  ;   ///< Stack of each registered thread.
+        static volatile long        sNumStacks                          ;   ///< Number of populated elements of sStacks.
+        static StackTally *         sTallies                            ;   ///< Hash table of PERF_SAMPLE_MAX_STACKS tallies, allocated by Start.
+        static unsigned long        sNumSamples                         ;   ///< Total number of samples taken since the most recent Reset.
+        static unsigned long        sNumUntallied                       ;   ///< Number of samples of stacks that did not fit in sTallies.
+        static HANDLE               sSamplerThread                      ;   ///< Thread that takes samples.
+        static DWORD                sSamplePeriodMs                     ;   ///< Milliseconds between samples.
+        static volatile bool        sIsSampling                         ;   ///< Whether the sampler thread should keep running.
+} ;
+
+
+
+
+/** Push a label onto the sampled stack of the current thread, for the lifetime of this object.
+
+    \see PERF_SAMPLE_SCOPE
+*/
+class PerfSampleScope
+{
+    public:
+        explicit PerfSampleScope( const char * label )  { PerfSampler::PushThisThread( label ) ; }
+        ~PerfSampleScope()                              { PerfSampler::PopThisThread() ; }
+
+    private:
+        PerfSampleScope( const PerfSampleScope & ) ;              // Disallow copy
+        PerfSampleScope & operator=( const PerfSampleScope & ) ;  // Disallow assignment
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
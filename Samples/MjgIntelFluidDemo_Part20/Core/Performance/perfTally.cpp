@@ -10,16 +10,7 @@
 #include <new>  // For placement new.
 
 #include <stdio.h>
-
-// NOTE: I doubt sPerfTallyCount needs to be atomic now that sPerfTalliesLock synchronizes access to it.
-#if _MSC_VER && ( _MSC_VER < 1700 ) // Older compiler that lacks atomic.
-    typedef volatile int    AtomicInt ;
-    AtomicInt   sPerfTallyCount = 0 ;   /// Used by linear allocator to index into sPerfTallies pool.
-#else   // Modern compiler that has atomic.
-    #include <atomic>
-    typedef std::atomic_int AtomicInt ;
-    AtomicInt   sPerfTallyCount ;   /// Used by linear allocator to index into sPerfTallies pool.
-#endif
+#include <string.h> // For strlen, strcpy
 
 #include "Core/Utility/macros.h"
 
@@ -37,12 +28,13 @@ void * SpinLock::sTlsAddressIsThreadId = NULLPTR ; // Address is used as a uniqu
 
 // Allocate PerfTally objects linearly to reduce profiling overhead.
 static const int    MAX_NUM_PERF_TALLIES    = 2048                  ;   ///< Maximum number of PerfTally objects for entire process.
-PerfTally           sPerfTallies[ MAX_NUM_PERF_TALLIES ]            ;   ///< Global pool of PerfTally objects, shared across entire process.  NOTE: If sPerfTallyCount and sPerfTallies were TLS, it wouldn't need a lock.  Would need to make PerfTally POD without ctor.
-SpinLock            sPerfTalliesLock                                ;   ///< Mutex for synchronizing access to sPerfTallies and sPerfTallyCount.
+PerfTally           sPerfTallies[ MAX_NUM_PERF_TALLIES ]            ;   ///< Global pool of PerfTally objects, shared across entire process.
+AtomicInt           sPerfTallyCount( 0 )                            ;   ///< Used by linear allocator to index into sPerfTallies pool.  Each thread claims an index by atomically incrementing this, so allocating needs no lock.
+SpinLock            sPerfTalliesLock                                ;   ///< Mutex for synchronizing appending to sPerfAggregatedStats.
 
 static const size_t         MAX_NUM_PERF_AGG_STATS  = 1024                  ;   ///< Maximum number of PerfAggregatedStatsWithId objects for entire process.
 PerfAggregatedStatsWithId   sPerfAggregatedStats[ MAX_NUM_PERF_AGG_STATS ]  ;   ///< Global pool for PerfAggregatedStatsWithId objects, shared across entire process.
-size_t                      sPerfAggregatedStatsCount = 0                   ;   ///< Used by linear allocator to index into sPerfAggregatedStats pool.
+AtomicInt                   sPerfAggregatedStatsCount( 0 )                  ;   ///< Used by linear allocator to index into sPerfAggregatedStats pool.  Incremented only after the new element is populated, so Find can read without a lock.
 
 // Private functions -----------------------------------------------------------
 
@@ -96,13 +88,17 @@ static int strCmpUnifySlashes( const char * s1 , const char * s2 )
 
 
 /** Find PerfAggregatedStatsWithId object associated with the given identifier.
+
+    This does not lock, because elements only ever get appended, and each
+    becomes visible (via sPerfAggregatedStatsCount) only once populated.
+    So a thread aggregating its tallies never waits for another thread.
+    An element still being appended might be missed, which FindOrNew handles.
 */
 PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::Find( const PerfBlockIdentifier * id )
 {
-    // Synchronously search global pool.
-    ScopedSpinLock  lock( sPerfTalliesLock ) ;
+    const size_t count = static_cast< size_t >( static_cast< int >( sPerfAggregatedStatsCount ) ) ;
 
-    for( size_t idx = 0 ; idx < sPerfAggregatedStatsCount ; ++ idx )
+    for( size_t idx = 0 ; idx < count ; ++ idx )
     {   // For each PerfAggregatedStats in global pool...
         PerfAggregatedStatsWithId * tuple = & sPerfAggregatedStats[ idx ] ;
         if( ( tuple->mId ) && ! strcmp( tuple->mId->mLabel , id->mLabel ) )
@@ -129,20 +125,24 @@ PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::Find( const PerfBlockIden
 
 
 /** Allocate and initialize a new PerfAggregatedStatsWithId object.
+
+    \param id  Identifier to associate with the new object.  Assigned before the object becomes visible to Find.
 */
-PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::New()
+PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::New( const PerfBlockIdentifier * id )
 {
     // Synchronously allocate PerfAggregatedStats from global pool.
     ScopedSpinLock  lock( sPerfTalliesLock ) ;
 
     // Allocate a new object.
-    ASSERT( sPerfAggregatedStatsCount < MAX_NUM_PERF_AGG_STATS ) ;
-    PANIC ( sPerfAggregatedStatsCount < MAX_NUM_PERF_AGG_STATS ) ;
+    const size_t count = static_cast< size_t >( static_cast< int >( sPerfAggregatedStatsCount ) ) ;
+    ASSERT( count < MAX_NUM_PERF_AGG_STATS ) ;
+    PANIC ( count < MAX_NUM_PERF_AGG_STATS ) ;
 
-    if( sPerfAggregatedStatsCount < MAX_NUM_PERF_AGG_STATS )
+    if( count < MAX_NUM_PERF_AGG_STATS )
     {   // Pool has room to allocate another object.
-        PerfAggregatedStatsWithId * tuple = new ( & sPerfAggregatedStats[ sPerfAggregatedStatsCount ] ) PerfAggregatedStatsWithId() ;
-        ++ sPerfAggregatedStatsCount ;
+        PerfAggregatedStatsWithId * tuple = new ( & sPerfAggregatedStats[ count ] ) PerfAggregatedStatsWithId() ;
+        tuple->mId = id ;
+        ++ sPerfAggregatedStatsCount ; // Publish object.  Do this after populating it, so Find never sees it incomplete.
 
         return tuple ;
     }
@@ -161,14 +161,21 @@ PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::New()
     a new cross-context PerfAggregatedStatsWithId object is allocated.  Subsequently, other PerfTally
     objects with the same identifier reuse that PerfAggregatedStatsWithId object.
 
+    Only the rare case of allocating takes a lock.  Since each PerfTally caches the result,
+    that happens at most once per block per call path.
+
 */
 PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::FindOrNew( const PerfBlockIdentifier * id )
 {
     PerfAggregatedStatsWithId * object = PerfAggregatedStatsWithId::Find( id ) ;
     if( NULLPTR == object )
-    {
-        object = PerfAggregatedStatsWithId::New() ;
-        object->mId = id ;
+    {   // Object probably does not exist yet.
+        ScopedSpinLock  lock( sPerfTalliesLock ) ;
+        object = PerfAggregatedStatsWithId::Find( id ) ;    // Search again, in case another thread appended it after the search above.
+        if( NULLPTR == object )
+        {
+            object = PerfAggregatedStatsWithId::New( id ) ;
+        }
     }
     return object ;
 }
@@ -184,20 +191,23 @@ PerfAggregatedStatsWithId * PerfAggregatedStatsWithId::FindOrNew( const PerfBloc
 
 
 /** Allocate and initialize a new PerfTally object.
+
+    Each thread claims a distinct element of the global pool by atomically
+    incrementing sPerfTallyCount, so threads never wait on each other here.
+    Only the thread that allocates a PerfTally uses it, so publishing it needs nothing more.
 */
 PerfTally * PerfTally::New( const char * label , const char * filename , unsigned line )
 {
-    // Synchronously allocate PerfTally from global pool.
-    ScopedSpinLock  lock( sPerfTalliesLock ) ;
+    // Claim an element of the global pool.
+    const int index = sPerfTallyCount ++ ;
 
     // Allocate a new object.
-    ASSERT( sPerfTallyCount < MAX_NUM_PERF_TALLIES ) ;
-    PANIC ( sPerfTallyCount < MAX_NUM_PERF_TALLIES ) ;
+    ASSERT( index < MAX_NUM_PERF_TALLIES ) ;
+    PANIC ( index < MAX_NUM_PERF_TALLIES ) ;
 
-    if( sPerfTallyCount < MAX_NUM_PERF_TALLIES )
+    if( index < MAX_NUM_PERF_TALLIES )
     {   // Pool has room to allocate another object.
-        PerfTally * newPerfTally = new ( & sPerfTallies[ sPerfTallyCount ] ) PerfTally( label , filename , line ) ;
-        ++ sPerfTallyCount ;
+        PerfTally * newPerfTally = new ( & sPerfTallies[ index ] ) PerfTally( label , filename , line ) ;
 
         return newPerfTally ;
     }
@@ -217,9 +227,22 @@ PerfTally * PerfTally::New( const char * label , const char * filename , unsigne
     \param filename Name of the source file in which the performance profiling block resides.
 
     \param line     Line within source file where the performance profiling block starts.
+
+    Each block label is a string literal unique to its PERF_BLOCK, so its address
+    (with line) hashes into mCalleeCache, which usually finds the callee without
+    walking the callee list.  The list remains authoritative, for when callees collide in the cache.
 */
 PerfTally * PerfTally::FindOrAppendCallee( const char * label , const char * filename , unsigned line )
 {
+    const size_t cacheSlot  = CalleeCacheSlot( label , line ) ;
+    PerfTally *  cached     = mCalleeCache[ cacheSlot ] ;
+    if(     ( cached != NULLPTR )
+        &&  ( line     == cached->mId.mLine     )
+        &&  ( filename == cached->mId.mFilename ) )
+    {   // Cache has callee matching this one.
+        return cached ;
+    }
+
     PerfTally * lastCallee = NULLPTR ;
     for( PerfTally * callee = mFirstCallee ; callee != NULLPTR ; callee = callee->mNextSiblingCallee )
     {   // For each callee under this block...
@@ -227,6 +250,7 @@ PerfTally * PerfTally::FindOrAppendCallee( const char * label , const char * fil
             &&  ( filename == callee->mId.mFilename ) )
         {   // Found callee matching this one.
             ASSERT( callee->mId.mLabel == label ) ; // Paranoid sanity check.  Should not have multiple labels at a single <file,line>.
+            mCalleeCache[ cacheSlot ] = callee ;
             return callee ;
         }
         lastCallee = callee ;
@@ -245,6 +269,7 @@ PerfTally * PerfTally::FindOrAppendCallee( const char * label , const char * fil
         ASSERT( NULLPTR == lastCallee->mNextSiblingCallee ) ; // Paranoid sanity check.
         lastCallee->mNextSiblingCallee = newPerfTally ;
     }
+    mCalleeCache[ cacheSlot ] = newPerfTally ;
     return newPerfTally ;
 }
 
@@ -292,6 +317,9 @@ void PerfTally::TallyCrossContext( int frameCount )
     mCrossContextAggregate->mTotalDurationInclusive     += mInContextAggregate.mTotalDurationInclusive      ;
     mCrossContextAggregate->mMaxDurationInclusive       += mInContextAggregate.mMaxDurationInclusive        ;
     mCrossContextAggregate->mNumCalls                   += mInContextAggregate.mNumCalls                    ;
+    mCrossContextAggregate->mCounterTotalsInclusive.Accumulate( mInContextAggregate.mCounterTotalsInclusive )    ;
+    mCrossContextAggregate->mAllocationTotalsInclusive.Accumulate( mInContextAggregate.mAllocationTotalsInclusive ) ;
+    mCrossContextAggregate->mLoadBalance.Accumulate( mInContextAggregate.mLoadBalance ) ;
 
     mCrossContextAggregate->mTotalDurationExclusive     += mInContextAggregate.mTotalDurationExclusive      ;
     mCrossContextAggregate->mCalleeProfileOverheadSum   += mInContextAggregate.mCalleeProfileOverheadSum    ;
@@ -435,14 +463,30 @@ void PerfTally::LogHeader( PerfLogFunc logFunc , PerfTally::PerfLogFormat perfLo
 
     static const char * tableHeader = "myOrder,callerOrder,IndentedLabel,Filename,Line,Label,Depth,"
                                 "InContext TotDurIncl,AvgDurInc,TotDurExcl,AvgDurExc,MaxDurInc,ProfOvrheadTot,ProfOvrheadCallees,NumCalls,"
-                                "CrossContext TotDurIncl,AvgDurInc,TotDurExcl,AvgDurExc,MaxDurInc,ProfOvrheadTot,ProfOvrheadCallees,NumCalls,"
-                                "\n" ;
+                                "CrossContext TotDurIncl,AvgDurInc,TotDurExcl,AvgDurExc,MaxDurInc,ProfOvrheadTot,ProfOvrheadCallees,NumCalls," ;
 
     static const char * callGraphHeader = "digraph {\n" ;
 
-    const char * header = ( PERF_LOG_FORMAT_TABLE == perfLogFormat ) ? tableHeader : callGraphHeader ;
-
-    logFunc( header ) ;
+    if( PERF_LOG_FORMAT_TABLE == perfLogFormat )
+    {
+        logFunc( tableHeader ) ;
+        for( unsigned iCounter = 0 ; iCounter < PerfCounters::GetNumCounters() ; ++ iCounter )
+        {   // For each hardware counter...
+            logFunc( "InContext %s TotIncl,CrossContext %s TotIncl," , PerfCounters::GetCounterName( iCounter ) , PerfCounters::GetCounterName( iCounter ) ) ;
+        }
+        if( AllocationTracker::IsEnabled() )
+        {   // Heap allocations are tracked.
+            logFunc( "InContext Allocs TotIncl,AllocBytes TotIncl,Allocs PerCall,CrossContext Allocs TotIncl,AllocBytes TotIncl,Allocs PerCall," ) ;
+        }
+    #if PERF_MEASURE_LOAD_BALANCE
+        logFunc( "CrossContext ParLoops,ParChunks,AvgChunkDur,MaxChunkDur,AvgBusyPerThread,MaxBusyPerThread,Imbalance,Efficiency," ) ;
+    #endif
+        logFunc( "\n" ) ;
+    }
+    else
+    {
+        logFunc( callGraphHeader ) ;
+    }
 }
 
 
@@ -517,15 +561,14 @@ size_t PerfTally::Log(
     const double profOhTt_crCtx = double( mCrossContextAggregate->mTotalProfileOverheadSum                                                      ) * milliSecondsPerTick ;
     const double profOhCl_crCtx = double( mCrossContextAggregate->mCalleeProfileOverheadSum                                                     ) * milliSecondsPerTick ;
 
-    char logLine[ 512 ] ;
+    char logLine[ 1024 ] ;  // Room for hardware counter and allocation columns.
 
     if( PERF_LOG_FORMAT_TABLE == perfLogFormat )
     {
         // Use comma-separated values, for easy import into a spreadsheet program.
         const char * formatStr = /* myOrder */ "%i," /* callerOrder */ "%i," /* indent-label */ "%s%s," /* filename , line */ "%s,%i," /* label , depth */ "%s,%i,"
             /*    in-context stats */ /* inclusive tot,avg */ "%g,%g," /* exclusive tot,avg */ "%g,%g," /* max */ "%g," /* overhead tot, callee */ "%g,%g," /* #calls */ "%u,"
-            /* cross-context stats */ /* inclusive tot,avg */ "%g,%g," /* exclusive tot,avg */ "%g,%g," /* max */ "%g," /* overhead tot, callee */ "%g,%g," /* #calls */ "%u,"
-            "\n" ;
+            /* cross-context stats */ /* inclusive tot,avg */ "%g,%g," /* exclusive tot,avg */ "%g,%g," /* max */ "%g," /* overhead tot, callee */ "%g,%g," /* #calls */ "%u," ;
 
         // Find name part of full filename
         const char * filename = mId.mFilename;
@@ -556,6 +599,42 @@ size_t PerfTally::Log(
             , mCrossContextAggregate->mNumCalls
 
             ) ;
+
+        char * logLineEnd = logLine + strlen( logLine ) ;
+        for( unsigned iCounter = 0 ; iCounter < PerfCounters::GetNumCounters() ; ++ iCounter )
+        {   // For each hardware counter...
+            logLineEnd += sprintf( logLineEnd , "%g,%g,"
+                , double( mInContextAggregate.mCounterTotalsInclusive.mCounts[ iCounter ] )
+                , double( mCrossContextAggregate->mCounterTotalsInclusive.mCounts[ iCounter ] )
+                ) ;
+        }
+        if( AllocationTracker::IsEnabled() )
+        {   // Heap allocations are tracked.
+            const AllocationCounts & allocs_inCtx = mInContextAggregate.mAllocationTotalsInclusive ;
+            const AllocationCounts & allocs_crCtx = mCrossContextAggregate->mAllocationTotalsInclusive ;
+            logLineEnd += sprintf( logLineEnd , "%g,%g,%g,%g,%g,%g,"
+                , double( allocs_inCtx.mNumAllocations ) , double( allocs_inCtx.mNumBytes )
+                , mInContextAggregate.mNumCalls > 0 ? double( allocs_inCtx.mNumAllocations ) / double( mInContextAggregate.mNumCalls ) : 0.0
+                , double( allocs_crCtx.mNumAllocations ) , double( allocs_crCtx.mNumBytes )
+                , mCrossContextAggregate->mNumCalls > 0 ? double( allocs_crCtx.mNumAllocations ) / double( mCrossContextAggregate->mNumCalls ) : 0.0
+                ) ;
+        }
+    #if PERF_MEASURE_LOAD_BALANCE
+        {   // Parallel loop load balance is measured.  Report durations per loop, in milliseconds.
+            const PerfLoadBalanceStats & loadBal_crCtx = mCrossContextAggregate->mLoadBalance ;
+            const double oneOverNumLoops  = loadBal_crCtx.mNumLoops  > 0   ? 1.0 / double( loadBal_crCtx.mNumLoops ) : 0.0 ;
+            const double oneOverNumChunks = loadBal_crCtx.mNumChunks > 0.0 ? 1.0 / loadBal_crCtx.mNumChunks          : 0.0 ;
+            logLineEnd += sprintf( logLineEnd , "%u,%g,%g,%g,%g,%g,%g,%g,"
+                , loadBal_crCtx.mNumLoops , loadBal_crCtx.mNumChunks
+                , loadBal_crCtx.mBusyTicks * oneOverNumChunks * milliSecondsPerTick
+                , loadBal_crCtx.mMaxChunkTicks * milliSecondsPerTick
+                , loadBal_crCtx.mMeanBusyPerThreadTicks * oneOverNumLoops * milliSecondsPerTick
+                , loadBal_crCtx.mMaxBusyPerThreadTicks  * oneOverNumLoops * milliSecondsPerTick
+                , loadBal_crCtx.GetImbalance() , loadBal_crCtx.GetEfficiency()
+                ) ;
+        }
+    #endif
+        strcpy( logLineEnd , "\n" ) ;
     }
     else
     {
@@ -25,6 +25,11 @@
 #   define NULLPTR 0
 #endif
 
+#include "perfCounters.h"
+#include "perfLoadBalance.h"
+
+#include "Core/Memory/newWrapper.h"
+
 // Macros ----------------------------------------------------------------------
 
 #if defined( WIN32 )
@@ -51,9 +56,11 @@
     private:
         volatile bool mValue ;
     } ;
+    typedef volatile int        AtomicInt   ;   // Fake atomic int for legacy compilers.  Increment is NOT thread safe.
 #else   // Presumed to be using modern compiler that has std::atomic.
     #include <atomic>
     typedef std::atomic<bool>   AtomicBool  ;
+    typedef std::atomic_int     AtomicInt   ;
 #endif
 
 
@@ -192,7 +199,9 @@ struct PerfAggregatedStats
         , mAverageDurationExclusive( 0.0 )
         , mPerFrameDurationInclusive( 0.0 )
         , mPerFrameDurationExclusive( 0.0 )
-    {}
+    {
+        mAllocationTotalsInclusive.Reset() ;
+    }
 
     void Reset()
     {
@@ -209,6 +218,10 @@ struct PerfAggregatedStats
         mAverageDurationExclusive = 0;
         mPerFrameDurationInclusive = 0;
         mPerFrameDurationExclusive = 0;
+
+        mCounterTotalsInclusive.Reset() ;
+        mAllocationTotalsInclusive.Reset() ;
+        mLoadBalance.Reset() ;
     }
 
     // Primary tally quantities.  These are initially accumulated per call.
@@ -217,6 +230,9 @@ struct PerfAggregatedStats
     LONGLONG        mTotalDurationInclusive     ;   ///< Total run duration, in ticks, including all callee durations.
     LONGLONG        mMaxDurationInclusive       ;   ///< Longest run duration, in ticks, including all callee durations.
     unsigned        mNumCalls                   ;   ///< Number of calls of this block, within a single callstack context.
+    PerfCounterValues mCounterTotalsInclusive   ;   ///< Total hardware counter increments, including all callees.  See PERF_COUNTERS_BACKEND.
+    AllocationCounts mAllocationTotalsInclusive ;   ///< Total heap allocations this thread made, including all callees.  See NEW_WRAPPER_TRACK_ALLOCATIONS.
+    PerfLoadBalanceStats mLoadBalance           ;   ///< Load balance of parallel loops this block ran directly.  See PERF_MEASURE_LOAD_BALANCE.
 
     // Quantities derived from primary tallies:
     LONGLONG        mTotalDurationExclusive     ;   ///< Total run duration, in ticks, excluding all callee durations.
@@ -239,7 +255,7 @@ struct PerfAggregatedStats
 struct PerfAggregatedStatsWithId
 {
     static PerfAggregatedStatsWithId *  Find( const PerfBlockIdentifier * id ) ;
-    static PerfAggregatedStatsWithId *  New() ;
+    static PerfAggregatedStatsWithId *  New( const PerfBlockIdentifier * id ) ;
     static PerfAggregatedStatsWithId *  FindOrNew( const PerfBlockIdentifier * id ) ;
 
     const PerfBlockIdentifier * mId     ;
@@ -272,17 +288,23 @@ struct PerfTally
         PERF_LOG_FORMAT_CALL_GRAPH
     } ;
 
+    static const size_t NUM_CALLEE_CACHE_SLOTS = 8 ;  ///< Number of slots in direct-mapped cache of callees.  Must be a power of 2.
+
     PerfTally()
         : mFirstCallee( 0 )
         , mNextSiblingCallee( NULLPTR )
-    {}
+    {
+        ClearCalleeCache() ;
+    }
 
     PerfTally( const char * label , const char * filename , unsigned line )
         : mId( label , filename , line )
         , mFirstCallee( 0 )
         , mNextSiblingCallee( 0 )
         , mCrossContextAggregate( NULLPTR )
-    {}
+    {
+        ClearCalleeCache() ;
+    }
 
     static double       SecondsPerTick() ;
     static double       MilliSecondsPerTick() ;
@@ -308,7 +330,24 @@ struct PerfTally
 
     PerfAggregatedStats *   mCrossContextAggregate      ;   ///< Aggregated performance stats across all calls across all callstack contexts.
 
+    PerfTally   *           mCalleeCache[ NUM_CALLEE_CACHE_SLOTS ] ;   ///< Callees most recently found, indexed by hash of label address and line, to avoid walking the callee list.
+
 private:
+    /// Return slot in mCalleeCache for a block with the given label and line.
+    static size_t       CalleeCacheSlot( const char * label , unsigned line )
+    {
+        const size_t address = reinterpret_cast< size_t >( label ) ;
+        return ( ( address >> 3 ) ^ ( address >> 11 ) ^ line ) & ( NUM_CALLEE_CACHE_SLOTS - 1 ) ;
+    }
+
+    void                ClearCalleeCache()
+    {
+        for( size_t slot = 0 ; slot < NUM_CALLEE_CACHE_SLOTS ; ++ slot )
+        {
+            mCalleeCache[ slot ] = NULLPTR ;
+        }
+    }
+
     void                TallyCrossContext( int frameCount ) ;
 } ;
 
@@ -0,0 +1,301 @@
+/** \file perfTrace.cpp
+
+    \brief Timeline of performance profiling blocks, exportable in Chrome Trace Event format.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Core/Utility/macros.h"
+
+#include "perfTally.h"  // For SpinLock, THREAD_LOCAL_STORAGE
+#include "perfTrace.h"
+
+#include <stdio.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+/** Ring buffer of trace events that one thread records.
+*/
+struct PerfTracePerThreadBuffer
+{
+    DWORD                   mThreadId                                       ;   ///< Operating system identifier of thread that owns this buffer.
+    const char *            mThreadName                                     ;   ///< Name of thread, from its PERF_BLOCK_MAIN, or NULL if it has none.
+    volatile LONGLONG       mNumEventsRecorded                              ;   ///< Number of events recorded since the last Clear, including those overwritten.
+    PerfTraceEvent          mEvents[ PERF_TRACE_EVENTS_PER_THREAD ]         ;   ///< Ring buffer of events.  Event i lives at i % PERF_TRACE_EVENTS_PER_THREAD.
+} ;
+
+// Private variables -----------------------------------------------------------
+
+THREAD_LOCAL_STORAGE PerfTracePerThreadBuffer * sTlsTraceBuffer = NULLPTR ;   ///< Trace buffer for current thread, or NULL if it has not recorded yet.
+THREAD_LOCAL_STORAGE const char *               sTlsThreadName  = NULLPTR ;   ///< Name of current thread, from its PERF_BLOCK_MAIN.
+
+static SpinLock                     sTraceBufferLock                                ;   ///< Mutex for synchronizing access to sTraceBuffers, sTraceBufferCount.
+static const size_t                 sMaxNumTraceBuffers                 = 128       ;   ///< Maximum number of threads supported.
+static PerfTracePerThreadBuffer *   sTraceBuffers[ sMaxNumTraceBuffers ]            ;   ///< Trace buffers, one for each thread that has recorded.
+static size_t                       sTraceBufferCount                   = 0         ;   ///< Number of populated elements in sTraceBuffers.
+
+static DWORD                        sControllingThreadId                = 0         ;   ///< Thread that enabled tracing, which counts frames.
+static int                          sNumFramesToTrace                   = 0         ;   ///< Number of frames remaining until tracing stops, or negative to trace indefinitely.
+static const char *                 sTraceFilename                      = NULLPTR   ;   ///< File to write when tracing stops.
+static LONGLONG                     sTraceOriginTime                    = 0         ;   ///< Time (in ticks) when tracing started.  Exported timestamps are relative to this.
+
+static PerfTracePerThreadBuffer *   sGpuTraceBuffer                     = NULLPTR   ;   ///< Trace buffer for GPU passes, or NULL if none has been recorded yet.
+static const DWORD                  sGpuLaneThreadId                    = 0         ;   ///< Identifier under which to export the GPU lane.  No real thread has identifier 0.
+
+/* static */ volatile bool          PerfTrace::sIsRecording             = false     ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Create and register a trace buffer, or return NULL if too many have been registered.
+*/
+static PerfTracePerThreadBuffer * CreateTraceBuffer( DWORD threadId , const char * threadName )
+{
+    ScopedSpinLock lock( sTraceBufferLock ) ;
+    if( sTraceBufferCount >= sMaxNumTraceBuffers )
+    {   // No room to register another thread.  Drop its events rather than fail.
+        return NULLPTR ;
+    }
+
+    PerfTracePerThreadBuffer * buffer = new PerfTracePerThreadBuffer ;
+    buffer->mThreadId           = threadId ;
+    buffer->mThreadName         = threadName ;
+    buffer->mNumEventsRecorded  = 0 ;
+    sTraceBuffers[ sTraceBufferCount ] = buffer ;
+    ++ sTraceBufferCount ;
+    return buffer ;
+}
+
+
+
+
+/** Return trace buffer for the current thread, creating it if necessary, or NULL if too many threads have recorded.
+*/
+static PerfTracePerThreadBuffer * GetOrCreateTraceBufferThisThread()
+{
+    if( NULLPTR == sTlsTraceBuffer )
+    {
+        sTlsTraceBuffer = CreateTraceBuffer( GetCurrentThreadId() , sTlsThreadName ) ;
+    }
+    return sTlsTraceBuffer ;
+}
+
+
+
+
+/** Append an event to a trace buffer, overwriting its oldest event if full.
+
+    Only the thread that owns the buffer may call this.
+*/
+static void AppendEvent( PerfTracePerThreadBuffer & buffer , const char * label , LONGLONG beginTime , LONGLONG endTime )
+{
+    const LONGLONG      numEventsRecorded   = buffer.mNumEventsRecorded ;
+    PerfTraceEvent &    event               = buffer.mEvents[ numEventsRecorded % PERF_TRACE_EVENTS_PER_THREAD ] ;
+    event.mLabel        = label ;
+    event.mBeginTime    = beginTime ;
+    event.mEndTime      = endTime ;
+    buffer.mNumEventsRecorded = numEventsRecorded + 1 ;  // Publish event after writing it.
+}
+
+// Public functions ------------------------------------------------------------
+
+/** Start recording trace events on all threads, lasting the given number of frames.
+
+    \param numFrames    Number of frames to record, counted as this thread crosses frame boundaries.
+                        Use PROFILE_FOREVER to record until the process calls PerfBlock::TerminateAndLogAllThreads.
+                        Use 0 to stop recording now.
+
+    \param filename     File into which to write the trace when recording stops.
+
+    Calling this while tracing is in progress first stops that tracing and writes its file.
+*/
+/* static */ void PerfTrace::EnableTracingThisThread( int numFrames , const char * filename )
+{
+    StopTracing() ;
+
+    if( 0 == numFrames )
+    {   // Caller wants to stop tracing.
+        return ;
+    }
+
+    ASSERT( filename != NULLPTR ) ;
+
+    Clear() ;
+
+    LARGE_INTEGER now ;
+    QueryPerformanceCounter( & now ) ;
+    sTraceOriginTime        = now.QuadPart ;
+    sControllingThreadId    = GetCurrentThreadId() ;
+    sNumFramesToTrace       = numFrames ;
+    sTraceFilename          = filename ;
+    sIsRecording            = true ;
+}
+
+
+
+
+/** Stop recording trace events and write the trace file, if tracing is in progress.
+*/
+/* static */ void PerfTrace::StopTracing()
+{
+    if( ! sIsRecording )
+    {
+        return ;
+    }
+    sIsRecording = false ;
+    WriteChromeTrace( sTraceFilename ) ;
+    sTraceFilename = NULLPTR ;
+}
+
+
+
+
+/** Cross a frame boundary for the current thread, which stops tracing if this thread enabled it and its frame count expired.
+*/
+/* static */ void PerfTrace::CrossFrameBoundaryThisThread()
+{
+    if( ! sIsRecording || ( GetCurrentThreadId() != sControllingThreadId ) || ( sNumFramesToTrace < 0 ) )
+    {   // Not tracing, or this thread does not control tracing, or tracing runs indefinitely.
+        return ;
+    }
+
+    -- sNumFramesToTrace ;
+    if( 0 == sNumFramesToTrace )
+    {   // Reached end of tracing duration.
+        StopTracing() ;
+    }
+}
+
+
+
+
+/** Record one completed execution of a profiling block, on the current thread.
+
+    This only touches the current thread's buffer, so it takes no locks, except the first time a thread records.
+*/
+/* static */ void PerfTrace::RecordEvent( const char * label , LONGLONG beginTime , LONGLONG endTime )
+{
+    PerfTracePerThreadBuffer * buffer = GetOrCreateTraceBufferThisThread() ;
+    if( NULLPTR == buffer )
+    {
+        return ;
+    }
+    AppendEvent( * buffer , label , beginTime , endTime ) ;
+}
+
+
+
+
+/** Record one completed GPU pass, into the GPU lane.
+
+    \param beginTime    Time (in CPU ticks) when the GPU began the pass, as PerfGpuLane converted it from GPU timestamps.
+
+    \param endTime      Time (in CPU ticks) when the GPU finished the pass.
+
+    Only the render thread, which resolves GPU timestamp queries, may call this.
+*/
+/* static */ void PerfTrace::RecordGpuEvent( const char * label , LONGLONG beginTime , LONGLONG endTime )
+{
+    if( NULLPTR == sGpuTraceBuffer )
+    {
+        sGpuTraceBuffer = CreateTraceBuffer( sGpuLaneThreadId , "GPU" ) ;
+        if( NULLPTR == sGpuTraceBuffer )
+        {
+            return ;
+        }
+    }
+    AppendEvent( * sGpuTraceBuffer , label , beginTime , endTime ) ;
+}
+
+
+
+
+/** Remember the name of the current thread, so exported traces can show it.
+*/
+/* static */ void PerfTrace::SetThreadName( const char * threadName )
+{
+    sTlsThreadName = threadName ;
+    if( sTlsTraceBuffer )
+    {
+        sTlsTraceBuffer->mThreadName = threadName ;
+    }
+}
+
+
+
+
+/** Discard events recorded on all threads.
+
+    Only call this while no thread records events.
+*/
+/* static */ void PerfTrace::Clear()
+{
+    ScopedSpinLock lock( sTraceBufferLock ) ;
+    for( size_t iBuffer = 0 ; iBuffer < sTraceBufferCount ; ++ iBuffer )
+    {   // For each thread...
+        sTraceBuffers[ iBuffer ]->mNumEventsRecorded = 0 ;
+    }
+}
+
+
+
+
+/** Write events recorded on all threads, in Chrome Trace Event format.
+
+    chrome://tracing and Perfetto (ui.perfetto.dev) can load the resulting file.
+
+    \return Whether writing succeeded.
+*/
+/* static */ bool PerfTrace::WriteChromeTrace( const char * filename )
+{
+    FILE * fp = fopen( filename , "w" ) ;
+    if( NULLPTR == fp )
+    {
+        return false ;
+    }
+
+    LARGE_INTEGER perfCtrTickPerSec ;
+    QueryPerformanceFrequency( & perfCtrTickPerSec ) ;
+    const double microSecondsPerTick = 1.0e6 / double( perfCtrTickPerSec.QuadPart ) ;
+
+    ScopedSpinLock lock( sTraceBufferLock ) ;
+
+    fprintf( fp , "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" ) ;
+    const char * separator = "" ;
+    for( size_t iBuffer = 0 ; iBuffer < sTraceBufferCount ; ++ iBuffer )
+    {   // For each thread...
+        const PerfTracePerThreadBuffer & buffer     = * sTraceBuffers[ iBuffer ] ;
+        const char *                     category   = ( & buffer == sGpuTraceBuffer ) ? "GpuPass" : "PerfBlock" ;
+
+        // Name thread.  Worker threads lack a PERF_BLOCK_MAIN, so name them by index.
+        if( buffer.mThreadName )
+        {
+            fprintf( fp , "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}" , separator , (unsigned long) buffer.mThreadId , buffer.mThreadName ) ;
+        }
+        else
+        {
+            fprintf( fp , "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"worker %u\"}}" , separator , (unsigned long) buffer.mThreadId , unsigned( iBuffer ) ) ;
+        }
+        separator = ",\n" ;
+
+        // Write events oldest first.  If the ring buffer overflowed, oldest events are gone.
+        const LONGLONG numEventsRecorded    = buffer.mNumEventsRecorded ;
+        const LONGLONG numEventsRetained    = Min2( numEventsRecorded , LONGLONG( PERF_TRACE_EVENTS_PER_THREAD ) ) ;
+        for( LONGLONG iEvent = numEventsRecorded - numEventsRetained ; iEvent < numEventsRecorded ; ++ iEvent )
+        {   // For each event this thread recorded...
+            const PerfTraceEvent & event = buffer.mEvents[ iEvent % PERF_TRACE_EVENTS_PER_THREAD ] ;
+            fprintf( fp , ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}"
+                , event.mLabel
+                , category
+                , double( event.mBeginTime - sTraceOriginTime ) * microSecondsPerTick
+                , double( event.mEndTime - event.mBeginTime ) * microSecondsPerTick
+                , (unsigned long) buffer.mThreadId
+                ) ;
+        }
+    }
+    fprintf( fp , "\n]}\n" ) ;
+
+    fclose( fp ) ;
+    return true ;
+}
@@ -0,0 +1,99 @@
+/** \file perfTrace.h
+
+    \brief Timeline of performance profiling blocks, exportable in Chrome Trace Event format.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PERF_TRACE_H
+#define PERF_TRACE_H
+
+#if defined( _XBOX )
+    #include <xtl.h>        // For LONGLONG
+#elif defined( WIN32 )
+    #include <windows.h>    // For LONGLONG
+    #ifdef min
+        #undef min
+    #endif
+    #ifdef max
+        #undef max
+    #endif
+#else
+    #error "unknown platform"
+#endif
+
+// Macros ----------------------------------------------------------------------
+
+/// Number of events each thread's ring buffer holds.  Upon overflow, newer events overwrite the oldest.
+#define PERF_TRACE_EVENTS_PER_THREAD 65536
+
+// Types -----------------------------------------------------------------------
+
+/** One completed execution of a profiling block.
+*/
+struct PerfTraceEvent
+{
+    const char *    mLabel      ;   ///< Name of profiling block.  Must persist for the process lifetime, as string literals do.
+    LONGLONG        mBeginTime  ;   ///< Time (in ticks) when the block began.
+    LONGLONG        mEndTime    ;   ///< Time (in ticks) when the block ended.
+} ;
+
+
+
+
+/** Timeline of performance profiling blocks, recorded on every thread.
+
+    Whereas PerfTally aggregates a call tree per thread, PerfTrace records
+    when each block ran, on which thread, so viewers can show worker idle
+    gaps and stalls between stages.  Export the timeline in Chrome Trace
+    Event format, which chrome://tracing and Perfetto (ui.perfetto.dev) read.
+
+    Each thread records into its own fixed-size ring buffer, which only that
+    thread writes, so recording takes no locks.  The only lock guards
+    registering a thread's buffer, the first time that thread records.
+
+    Recording is process-wide, since worker threads (e.g. those TBB owns)
+    have no frame loop of their own, but it starts and stops on the thread
+    that enables it, in the same way as PerfBlock::EnableProfilingThisThread:
+    that thread counts frames as it crosses frame boundaries, and when the
+    count expires, it stops recording and writes the trace file.
+
+    Example usage:
+
+        PERF_BLOCK_MAIN( "main" ) ;
+        PERF_BLOCK_ENABLE_TRACING( 60 , "trace.json" ) ; // Record the next 60 frames.
+        while( running )
+        {
+            ...code with PERF_BLOCK inside, on any thread...
+            PERF_BLOCK_CROSS_FRAME_BOUNDARY( false ) ;
+        }
+
+    GPU passes that PerfGpuLane records appear in a lane of their own,
+    named "GPU", as though the GPU were another thread.
+
+    Exporting reads every thread's buffer, so only export while no
+    profiling blocks run on other threads, e.g. between frames.
+*/
+class PerfTrace
+{
+    public:
+        static void EnableTracingThisThread( int numFrames , const char * filename ) ;
+        static void StopTracing() ;
+        static void CrossFrameBoundaryThisThread() ;
+        static bool WriteChromeTrace( const char * filename ) ;
+        static void Clear() ;
+
+        /// Return whether blocks should record trace events now.
+        static bool IsRecording() { return sIsRecording ; }
+
+        static void RecordEvent( const char * label , LONGLONG beginTime , LONGLONG endTime ) ;
+        static void RecordGpuEvent( const char * label , LONGLONG beginTime , LONGLONG endTime ) ;
+        static void SetThreadName( const char * threadName ) ;
+
+    private:
+        static volatile bool sIsRecording ;   ///< Whether blocks on any thread record trace events.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
@@ -0,0 +1,322 @@
+/** \file telemetry.cpp
+
+    \brief Registry of counters and gauges that a running application publishes, and a tiny HTTP server that exports them.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#if defined( WIN32 )
+    #include <winsock2.h>   // Must precede windows.h, which otherwise includes the older winsock.h.
+    #pragma comment( lib , "ws2_32.lib" )
+#endif
+
+#include "Core/Utility/macros.h"
+
+#include "telemetry.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#pragma warning( disable : 4996 ) // This function may be unsafe (sprintf)
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+static const size_t sResponseBufferSize = 16384 ;   ///< Maximum size of response body.  Each metric takes one line, plus help and type lines.
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Append formatted text to the given buffer, and advance its length, unless that would overflow it.
+
+    \return Whether text fit.
+*/
+static bool AppendText( char * buffer , size_t bufferSize , size_t & length , const char * format , ... )
+{
+    va_list args ;
+    va_start( args , format ) ;
+    const int numChars = _vsnprintf( buffer + length , bufferSize - length , format , args ) ;
+    va_end( args ) ;
+    if( ( numChars < 0 ) || ( size_t( numChars ) >= bufferSize - length ) )
+    {   // Text did not fit.  Terminate at previous length, so buffer only has whole lines.
+        buffer[ length ] = '\0' ;
+        return false ;
+    }
+    length += size_t( numChars ) ;
+    return true ;
+}
+
+// Public functions ------------------------------------------------------------
+
+/** Construct an empty registry, with no server running.
+*/
+Telemetry::Telemetry()
+    : mNumMetrics( 0 )
+#if defined( WIN32 )
+    , mServerThread( NULL )
+    , mListenSocket( INVALID_SOCKET )
+#endif
+    , mIsServing( false )
+{
+}
+
+
+
+
+Telemetry::~Telemetry()
+{
+    StopServer() ;
+}
+
+
+
+
+/** Register a metric.
+
+    \param kind         Whether metric is a counter or gauge.
+
+    \param name         Name of metric, which monitoring sees, such as "fluid_vortons".
+                        Use lowercase letters, digits and underscores.
+
+    \param help         Description of metric, for people browsing metrics.
+
+    \param labelName    Name of label that distinguishes metrics that share a name, such as "stage", or NULL.
+
+    \param labelValue   Value of label that distinguishes this metric, such as "Velocity", or NULL.
+
+    All strings must outlive this registry; string literals suit.
+    Metrics that share a name must register consecutively.
+
+    \return Handle that identifies metric to Increment, SetCounter and SetGauge.
+*/
+Telemetry::MetricId Telemetry::Register( KindE kind , const char * name , const char * help , const char * labelName , const char * labelValue )
+{
+    ASSERT( ! mIsServing ) ;    // Server thread reads mMetrics without locking.
+    ASSERT( mNumMetrics < MAX_NUM_METRICS ) ;
+    ASSERT( ( NULL == labelName ) == ( NULL == labelValue ) ) ;
+
+    Metric & metric = mMetrics[ mNumMetrics ] ;
+    metric.mName        = name ;
+    metric.mHelp        = help ;
+    metric.mLabelName   = labelName ;
+    metric.mLabelValue  = labelValue ;
+    metric.mKind        = kind ;
+    metric.mCount       = 0 ;
+    metric.mGauge       = 0.0f ;
+    return mNumMetrics ++ ;
+}
+
+
+
+
+void Telemetry::Increment( MetricId id , long amount )
+{
+    ASSERT( id < mNumMetrics ) ;
+    ASSERT( KIND_COUNTER == mMetrics[ id ].mKind ) ;
+#if defined( WIN32 )
+    InterlockedExchangeAdd( & mMetrics[ id ].mCount , amount ) ;
+#else
+    mMetrics[ id ].mCount += amount ;
+#endif
+}
+
+
+
+
+void Telemetry::SetCounter( MetricId id , unsigned long total )
+{
+    ASSERT( id < mNumMetrics ) ;
+    ASSERT( KIND_COUNTER == mMetrics[ id ].mKind ) ;
+    mMetrics[ id ].mCount = static_cast< long >( total ) ;
+}
+
+
+
+
+/** Write every metric into the given buffer, in Prometheus text exposition format.
+
+    \param buffer       (out) Text of metrics, nul-terminated.
+
+    \param bufferSize   Number of bytes buffer has.  Metrics that do not fit get omitted.
+
+    \return Number of characters written, not counting the terminating nul.
+
+    This only reads metrics, so can run on any thread while other threads publish.
+*/
+size_t Telemetry::Format( char * buffer , size_t bufferSize ) const
+{
+    ASSERT( bufferSize > 0 ) ;
+    size_t length = 0 ;
+    buffer[ 0 ] = '\0' ;
+
+    const char * previousName = NULL ;
+    for( size_t iMetric = 0 ; iMetric < mNumMetrics ; ++ iMetric )
+    {   // For each registered metric...
+        const Metric & metric = mMetrics[ iMetric ] ;
+        const size_t   metricBegin = length ;
+        if( ( NULL == previousName ) || ( strcmp( previousName , metric.mName ) != 0 ) )
+        {   // First metric of this name.
+            if( ! AppendText( buffer , bufferSize , length , "# HELP %s %s\n# TYPE %s %s\n" , metric.mName , metric.mHelp , metric.mName , ( KIND_COUNTER == metric.mKind ) ? "counter" : "gauge" ) )
+            {
+                break ;
+            }
+            previousName = metric.mName ;
+        }
+
+        bool fit ;
+        if( metric.mLabelName )
+        {
+            fit = AppendText( buffer , bufferSize , length , "%s{%s=\"%s\"} " , metric.mName , metric.mLabelName , metric.mLabelValue ) ;
+        }
+        else
+        {
+            fit = AppendText( buffer , bufferSize , length , "%s " , metric.mName ) ;
+        }
+        if( fit )
+        {
+            if( KIND_COUNTER == metric.mKind )
+            {
+                fit = AppendText( buffer , bufferSize , length , "%lu\n" , static_cast< unsigned long >( metric.mCount ) ) ;
+            }
+            else
+            {
+                fit = AppendText( buffer , bufferSize , length , "%g\n" , metric.mGauge ) ;
+            }
+        }
+        if( ! fit )
+        {   // Buffer is full.  Omit this metric entirely, rather than leave part of it.
+            length = metricBegin ;
+            buffer[ length ] = '\0' ;
+            break ;
+        }
+    }
+    return length ;
+}
+
+
+
+
+/** Start a thread that answers HTTP requests on the given port with every metric.
+
+    \param port     TCP port on which to listen, on every network interface, so monitoring on other machines can scrape.
+
+    \return Whether server started.  False means sockets are unavailable or the port is in use.
+
+    The server answers one request at a time, each with a short response,
+    so it needs no more than one thread however often monitoring scrapes.
+*/
+bool Telemetry::StartServer( unsigned short port )
+{
+#if defined( WIN32 )
+    StopServer() ;
+
+    WSADATA wsaData ;
+    if( WSAStartup( MAKEWORD( 2 , 2 ) , & wsaData ) != 0 )
+    {
+        return false ;
+    }
+
+    const SOCKET listenSocket = socket( AF_INET , SOCK_STREAM , IPPROTO_TCP ) ;
+    if( INVALID_SOCKET == listenSocket )
+    {
+        WSACleanup() ;
+        return false ;
+    }
+
+    sockaddr_in address ;
+    memset( & address , 0 , sizeof( address ) ) ;
+    address.sin_family      = AF_INET ;
+    address.sin_addr.s_addr = htonl( INADDR_ANY ) ;
+    address.sin_port        = htons( port ) ;
+    if(     ( bind( listenSocket , reinterpret_cast< sockaddr * >( & address ) , sizeof( address ) ) != 0 )
+        ||  ( listen( listenSocket , SOMAXCONN ) != 0 ) )
+    {   // Port is in use, or similar.
+        closesocket( listenSocket ) ;
+        WSACleanup() ;
+        return false ;
+    }
+
+    mListenSocket   = listenSocket ;
+    mIsServing      = true ;
+    mServerThread   = CreateThread( NULL , 0 , ServerThreadMain , this , 0 , NULL ) ;
+    ASSERT( mServerThread ) ;
+    return true ;
+#else
+    (void) port ;
+    return false ;
+#endif
+}
+
+
+
+
+/** Stop the server thread, if it is running.
+*/
+void Telemetry::StopServer()
+{
+#if defined( WIN32 )
+    if( ! mIsServing )
+    {
+        return ;
+    }
+    mIsServing = false ;
+    closesocket( mListenSocket ) ;  // Makes accept in server thread fail, so it exits.
+    mListenSocket = INVALID_SOCKET ;
+    WaitForSingleObject( mServerThread , INFINITE ) ;
+    CloseHandle( mServerThread ) ;
+    mServerThread = NULL ;
+    WSACleanup() ;
+#endif
+}
+
+
+
+
+#if defined( WIN32 )
+
+/** Answer requests until StopServer closes the listen socket.
+
+    \param context  Address of the Telemetry instance.
+
+    This reads and ignores each request, so any path, such as /metrics, gets the same answer.
+*/
+/* static */ DWORD WINAPI Telemetry::ServerThreadMain( LPVOID context )
+{
+    Telemetry * telemetry = reinterpret_cast< Telemetry * >( context ) ;
+
+    static char sResponse[ sResponseBufferSize ] ;  // Static rather than on stack, since it is large.  Only this thread uses it.
+    char        request[ 1024 ] ;
+
+    for( ;; )
+    {   // For each connection...
+        const SOCKET connection = accept( static_cast< SOCKET >( telemetry->mListenSocket ) , NULL , NULL ) ;
+        if( INVALID_SOCKET == connection )
+        {   // StopServer closed listen socket.
+            break ;
+        }
+
+        // Read (and ignore) request.  A scraper sends it in one segment, so one recv suffices.
+        recv( connection , request , sizeof( request ) , 0 ) ;
+
+        // Leave room for header, then write body after it.
+        static const size_t sHeaderRoom = 128 ;
+        char * const body = sResponse + sHeaderRoom ;
+        const size_t bodyLength = telemetry->Format( body , sizeof( sResponse ) - sHeaderRoom ) ;
+
+        char header[ sHeaderRoom ] ;
+        const int headerLength = sprintf( header , "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\n\r\n" , unsigned( bodyLength ) ) ;
+        ASSERT( ( headerLength > 0 ) && ( size_t( headerLength ) < sHeaderRoom ) ) ;
+        char * const response = body - headerLength ;
+        memcpy( response , header , headerLength ) ;
+
+        send( connection , response , int( headerLength + bodyLength ) , 0 ) ;
+        shutdown( connection , SD_SEND ) ;
+        closesocket( connection ) ;
+    }
+
+    return 0 ;
+}
+
+#endif
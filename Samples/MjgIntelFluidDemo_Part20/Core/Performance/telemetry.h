@@ -0,0 +1,117 @@
+/** \file telemetry.h
+
+    \brief Registry of counters and gauges that a running application publishes, and a tiny HTTP server that exports them.
+
+    \author Written and copyright 2005-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#if defined( WIN32 )
+    #include <windows.h>
+    #ifdef min
+        #undef min
+    #endif
+    #ifdef max
+        #undef max
+    #endif
+#endif
+
+#include <stddef.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+/** Registry of counters and gauges that a running application publishes, and a tiny HTTP server that exports them.
+
+    Publishing a metric costs one store (gauge) or one interlocked add
+    (counter), and no lock or allocation, so code can publish every frame.
+    Register every metric before starting the server; registration is
+    not thread-safe.
+
+    StartServer runs a thread that answers each HTTP request, regardless of
+    its path, with every metric in the Prometheus text exposition format,
+    for example:
+
+        # HELP fluid_vortons Number of vortons.
+        # TYPE fluid_vortons gauge
+        fluid_vortons 4096
+        fluid_update_stage_ms{stage="Velocity"} 3.25
+
+    Monitoring tools that scrape Prometheus endpoints read this directly;
+    so does a web browser or curl.  The server only reads metrics, so
+    scraping never stalls the publisher.
+*/
+class Telemetry
+{
+    public:
+        typedef size_t MetricId ;   ///< Handle of a registered metric.
+
+        static const size_t MAX_NUM_METRICS = 128 ;    ///< Maximum number of metrics a registry holds.
+
+        /// Kinds of metrics.
+        enum KindE
+        {
+            KIND_COUNTER    ,   ///< Value that only increases, such as number of frames.  Monitoring computes rates from it.
+            KIND_GAUGE      ,   ///< Value that can go up and down, such as number of vortons.
+        } ;
+
+        Telemetry() ;
+        ~Telemetry() ;
+
+        MetricId    Register( KindE kind , const char * name , const char * help , const char * labelName = NULL , const char * labelValue = NULL ) ;
+
+        /// Add the given amount to the given counter.
+        void        Increment( MetricId id , long amount = 1 ) ;
+
+        /// Set the given counter to the given total, for counters some other code already tallies.
+        void        SetCounter( MetricId id , unsigned long total ) ;
+
+        /// Set the given gauge to the given value.
+        void        SetGauge( MetricId id , float value )   { mMetrics[ id ].mGauge = value ; }
+
+        size_t      Format( char * buffer , size_t bufferSize ) const ;
+
+        bool        StartServer( unsigned short port ) ;
+        void        StopServer() ;
+
+        /// Return whether the server is running.
+        bool        IsServing() const   { return mIsServing ; }
+
+    private:
+        /** Registered metric.
+
+            Strings must outlive the registry, so are typically string literals.
+            Metrics that share a name, differing by label value, must register consecutively.
+        */
+        struct Metric
+        {
+            const char *    mName       ;   ///< Name of metric, as monitoring sees it.
+            const char *    mHelp       ;   ///< Description of metric.
+            const char *    mLabelName  ;   ///< Name of label that distinguishes metrics of the same name, or NULL.
+            const char *    mLabelValue ;   ///< Value of label, or NULL.
+            KindE           mKind       ;   ///< Whether metric is a counter or gauge.
+            volatile long   mCount      ;   ///< Value of counter.  Reads as unsigned, so wraps rather than going negative.
+            volatile float  mGauge      ;   ///< Value of gauge.
+        } ;
+
+        Telemetry( const Telemetry & ) ;                // Disallow copy
+        Telemetry & operator=( const Telemetry & ) ;    // Disallow assignment
+
+    #if defined( WIN32 )
+        static DWORD WINAPI ServerThreadMain( LPVOID context ) ;
+    #endif
+
+        Metric              mMetrics[ MAX_NUM_METRICS ] ;   ///< Registered metrics.
+        size_t              mNumMetrics                 ;   ///< Number of registered metrics.
+    #if defined( WIN32 )
+        HANDLE              mServerThread               ;   ///< Thread that answers requests.
+        UINT_PTR            mListenSocket               ;   ///< Socket on which server accepts connections.  Closing it tells the server thread to exit.
+    #endif
+        volatile bool       mIsServing                  ;   ///< Whether the server is running.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+#endif
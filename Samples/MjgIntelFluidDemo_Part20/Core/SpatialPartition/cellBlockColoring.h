@@ -0,0 +1,181 @@
+/** \file cellBlockColoring.h
+
+    \brief Conflict-free parallel scheduling of cell blocks, for routines that exchange data between neighboring cells
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef CELL_BLOCK_COLORING_H
+#define CELL_BLOCK_COLORING_H
+
+#include <math.h>
+
+#include "Core/parallelExecution.h"
+#include "Core/Utility/macros.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Half-open box of cell indices along each axis.
+*/
+struct CellBox
+{
+    /// Construct empty box.
+    CellBox()
+    {
+        mBegin[ 0 ] = mBegin[ 1 ] = mBegin[ 2 ] = 0 ;
+        mEnd[ 0 ]   = mEnd[ 1 ]   = mEnd[ 2 ]   = 0 ;
+    }
+
+    /// Construct box that spans the given number of cells along each axis.
+    explicit CellBox( const size_t numCells[ 3 ] )
+    {
+        mBegin[ 0 ] = mBegin[ 1 ] = mBegin[ 2 ] = 0 ;
+        mEnd[ 0 ]   = numCells[ 0 ] ;
+        mEnd[ 1 ]   = numCells[ 1 ] ;
+        mEnd[ 2 ]   = numCells[ 2 ] ;
+    }
+
+    size_t  mBegin[ 3 ] ;   ///< Index of first cell along each axis.
+    size_t  mEnd[ 3 ]   ;   ///< One past index of last cell along each axis.
+} ;
+
+
+/** Function object to visit the cell blocks of one color, for use with Parallel::For.
+
+    Indices in the range passed to operator() enumerate the blocks of one
+    color, x fastest.  Along each axis, block b of this color is block
+    2*b+parity of the domain, where parity is the bit of the color for that
+    axis.
+
+    \see ForEachCellBlockByColor.
+*/
+template< class BodyT > class CellBlockColoringVisitor
+{
+    public:
+        CellBlockColoringVisitor( const BodyT & body , const size_t numCells[ 3 ] , const size_t blockSize[ 3 ] , unsigned color )
+            : mBody( body )
+        {
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {
+                size_t numBlocks = ( numCells[ axis ] + blockSize[ axis ] - 1 ) / blockSize[ axis ] ;
+                if( ( numBlocks > 1 ) && ( numBlocks & 1 ) )
+                {   // Odd number of blocks would give first and last blocks the same color.
+                    // Neighbor offsets of -1 along x or y wrap around to the far end of the previous row,
+                    // so first and last blocks can reach the same cells.  Merge last block into its predecessor.
+                    -- numBlocks ;
+                }
+                mNumCells[ axis ]           = numCells[ axis ] ;
+                mBlockSize[ axis ]          = blockSize[ axis ] ;
+                mNumBlocks[ axis ]          = numBlocks ;
+                mParity[ axis ]             = ( color >> axis ) & 1 ;
+                mNumBlocksOfColor[ axis ]   = numBlocks > mParity[ axis ] ? ( numBlocks - mParity[ axis ] + 1 ) / 2 : 0 ;
+            }
+        }
+
+        /// Return number of blocks of this color, i.e. the extent of the range to pass to operator().
+        size_t GetNumBlocks() const { return mNumBlocksOfColor[ 0 ] * mNumBlocksOfColor[ 1 ] * mNumBlocksOfColor[ 2 ] ; }
+
+        void operator() ( const Parallel::Range & r ) const
+        {   // Visit a subset of blocks of this color.
+            for( size_t iBlock = r.begin() ; iBlock < r.end() ; ++ iBlock )
+            {   // For each block in subset...
+                size_t blockIdx[ 3 ] ;
+                blockIdx[ 0 ] = iBlock % mNumBlocksOfColor[ 0 ] ;
+                blockIdx[ 1 ] = ( iBlock / mNumBlocksOfColor[ 0 ] ) % mNumBlocksOfColor[ 1 ] ;
+                blockIdx[ 2 ] = iBlock / ( mNumBlocksOfColor[ 0 ] * mNumBlocksOfColor[ 1 ] ) ;
+                CellBox box ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis, find cells in this block.
+                    const size_t blockInDomain = 2 * blockIdx[ axis ] + mParity[ axis ] ;
+                    box.mBegin[ axis ] = blockInDomain * mBlockSize[ axis ] ;
+                    box.mEnd[ axis ]   = ( blockInDomain + 1 == mNumBlocks[ axis ] ) ? mNumCells[ axis ] : box.mBegin[ axis ] + mBlockSize[ axis ] ;
+                }
+                mBody( box ) ;
+            }
+        }
+
+    private:
+        CellBlockColoringVisitor & operator=( const CellBlockColoringVisitor & ) ; // Disallow assignment
+
+        const BodyT &   mBody                   ;   ///< Function object to run on each block.
+        size_t          mNumCells[ 3 ]          ;   ///< Number of cells in domain along each axis.
+        size_t          mBlockSize[ 3 ]         ;   ///< Number of cells per block along each axis.  The last block along an axis can be larger.
+        size_t          mNumBlocks[ 3 ]         ;   ///< Number of blocks in domain along each axis, of all colors.
+        size_t          mParity[ 3 ]            ;   ///< Parity of blocks of this color along each axis.
+        size_t          mNumBlocksOfColor[ 3 ]  ;   ///< Number of blocks of this color along each axis.
+} ;
+
+// Public functions --------------------------------------------------------------
+
+/** Run body on every block of cells in the domain, such that no two blocks that run concurrently are adjacent.
+
+    This is for routines that visit each cell and its adjacent cells (i.e.
+    offsets of -1, 0 or +1 per axis), and write to data in both.  Running
+    those routines on adjacent blocks concurrently would race.
+
+    This splits the domain into blocks and assigns each block one of 8
+    colors, according to the parity of its block index along each axis.
+    Blocks of the same color have at least one whole block between them, and
+    blocks span at least 2 cells, so the cells that two blocks of the same
+    color reach never overlap, and all blocks of one color can run
+    concurrently.  This runs each color in turn.
+
+    Offsets of -1 along x from the first cell in a row reach the last
+    gridpoint of an earlier row, so this only works when the first and last
+    cells of each row lie in blocks of different colors.  That requires at
+    least 2 blocks along x, so when the domain is too thin for that, this
+    runs body once on the whole domain.
+
+    Compared to alternating odd and even z slices, this exposes parallelism
+    along all 3 axes, so thin domains still yield enough work per thread.
+
+    \param numCells - Number of cells along each axis.  Cells this visits a
+        neighbor of must be included, so pass one less than the number of
+        gridpoints along each axis.
+
+    \param body - Function object with operator()( const CellBox & ) const.
+
+    \note When USE_TBB is 0, this runs body once on the whole domain.
+*/
+template< class BodyT > void ForEachCellBlockByColor( const size_t numCells[ 3 ] , const BodyT & body )
+{
+    if( ( 0 == numCells[ 0 ] ) || ( 0 == numCells[ 1 ] ) || ( 0 == numCells[ 2 ] ) )
+    {   // No cells.
+        return ;
+    }
+
+#if USE_TBB
+    static const size_t minBlockSize    = 2 ;   // Blocks of one color have a block between them, which must be wider than the 1-cell reach of each.
+    if( numCells[ 0 ] <= minBlockSize )
+    {   // Domain is too thin along x to have 2 blocks along x.
+        body( CellBox( numCells ) ) ;
+        return ;
+    }
+
+    // Choose block size so each color has several blocks per thread, to balance load.
+    static const size_t numColors       = 8 ;
+    static const size_t blocksPerThread = 4 ;
+    const size_t        numCellsTotal   = numCells[ 0 ] * numCells[ 1 ] * numCells[ 2 ] ;
+    const float         cellsPerBlock   = float( numCellsTotal ) / float( numColors * blocksPerThread * Parallel::GetNumThreads() ) ;
+    const size_t        blockEdge       = Max2( minBlockSize , size_t( powf( cellsPerBlock , 1.0f / 3.0f ) ) ) ;
+    size_t              blockSize[ 3 ]  ;
+    blockSize[ 0 ] = Min2( blockEdge , Max2( minBlockSize , ( numCells[ 0 ] + 1 ) / 2 ) ) ;  // Ensure at least 2 blocks along x.
+    blockSize[ 1 ] = blockEdge ;
+    blockSize[ 2 ] = blockEdge ;
+
+    for( unsigned color = 0 ; color < numColors ; ++ color )
+    {   // For each color...
+        const CellBlockColoringVisitor< BodyT > visitor( body , numCells , blockSize , color ) ;
+        const size_t numBlocks = visitor.GetNumBlocks() ;
+        if( numBlocks > 0 )
+        {   // Domain has blocks of this color.
+            Parallel::For( 0 , numBlocks , 1 , visitor ) ;
+        }
+    }
+#else
+    body( CellBox( numCells ) ) ;
+#endif
+}
+
+#endif
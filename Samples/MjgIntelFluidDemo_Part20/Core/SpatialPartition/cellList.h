@@ -0,0 +1,865 @@
+/** \file cellList.h
+
+    \brief Spatial partition of item indices stored in flat, cell-sorted arrays
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef CELL_LIST_H
+#define CELL_LIST_H
+
+#include "Core/SpatialPartition/uniformGrid.h"
+#include "Core/SpatialPartition/cellBlockColoring.h"
+
+#include "Core/Containers/vector.h"
+#include "Core/parallelExecution.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Spatial partition of item indices, stored in flat arrays sorted by cell.
+
+    This serves the same purpose as UniformGrid< VECTOR< unsigned > >, but
+    instead of one dynamic array per cell, it stores the indices of all items
+    in one contiguous array, sorted by cell, and one array of offsets into that
+    array, one offset per cell.
+    Those "compressed sparse row" arrays avoid the heap block and vector
+    header per cell, and visiting the items in a cell reads contiguous memory.
+
+    Cells are addressed by the same offsets that UniformGrid uses, i.e. by the
+    offset of the minimal-corner gridpoint of each cell, so code that walks a
+    UniformGrid by offset can walk a CellList the same way.
+
+    Partition builds the arrays using a counting sort, which runs in parallel
+    when USE_TBB is enabled.
+    When the number of cells along each axis, and the number of items, remain
+    the same as in the previous call, and few items crossed cell boundaries
+    since, Partition instead moves only those indices that changed cells,
+    leaving the rest in place.  That holds even when the grid moves or
+    stretches slightly, e.g. to track a bounding box.
+
+    Alongside those arrays, this keeps one occupancy bit per cell, packed 64
+    cells per word in offset order, i.e. along x.  Sparse distributions leave
+    most cells empty, so neighbor loops test bits, and skip runs of empty
+    cells using bit scans, before reading any per-cell offsets or indices.
+    See IsOccupied and FindOccupiedCell.
+
+    Neighbor loops also read as many item indices as item payloads, so this
+    keeps a second copy of item indices, each in 16 bits, relative to the
+    first slot of its cell.  That fits when items are stored in the same
+    order as this partition, e.g. after PclOpSortMorton with mSortByCell,
+    and stays within range while items drift between sorts.  Cells whose
+    indices do not fit keep only 32-bit indices.  See IsCompact.
+*/
+class CellList : public UniformGridGeometry
+{
+        /// Stages of Rebuild.  Each stage runs once per chunk; chunks of the same stage run concurrently.
+        enum RebuildStageE
+        {
+            REBUILD_STAGE_COUNT     ,   ///< Find cell of each item in chunk, and count items in each cell, per chunk.
+            REBUILD_STAGE_TOTAL     ,   ///< For each cell in block, total its per-chunk counts and convert them to offsets within the cell.
+            REBUILD_STAGE_SCAN      ,   ///< For each cell in block, convert totals to offsets using an exclusive prefix sum.
+            REBUILD_STAGE_SCATTER       ///< Scatter indices of items in chunk into their cells.
+        } ;
+
+    public:
+        /** Read-only view of the indices of items inside one cell.
+
+            Access resembles that of a VECTOR< unsigned >, for use by code
+            written against UniformGrid< VECTOR< unsigned > >.
+        */
+        class Cell
+        {
+            public:
+                Cell( const unsigned * indices , size_t numIndices ) : mIndices( indices ) , mNumIndices( numIndices ) {}
+
+                size_t              Size() const                        { return mNumIndices ; }
+                bool                Empty() const                       { return 0 == mNumIndices ; }
+                const unsigned &    operator[]( size_t index ) const    { ASSERT( index < mNumIndices ) ; return mIndices[ index ] ; }
+
+            private:
+                const unsigned *    mIndices    ;   ///< Address of first index of an item in this cell.
+                size_t              mNumIndices ;   ///< Number of items in this cell.
+        } ;
+
+        /** Read-only view of the indices of items inside one cell, each stored in 16 bits relative to the first slot of the cell.
+
+            Access resembles that of Cell, except operator[] returns by value.
+        */
+        class CompactCell
+        {
+            public:
+                CompactCell( unsigned cellBegin , const short * offsets , size_t numIndices ) : mCellBegin( cellBegin ) , mOffsets( offsets ) , mNumIndices( numIndices ) {}
+
+                size_t              Size() const                        { return mNumIndices ; }
+                bool                Empty() const                       { return 0 == mNumIndices ; }
+                unsigned            operator[]( size_t index ) const    { ASSERT( index < mNumIndices ) ; return mCellBegin + mOffsets[ index ] ; }
+
+            private:
+                unsigned            mCellBegin  ;   ///< Slot of first item in this cell, to which each offset is relative.
+                const short *       mOffsets    ;   ///< Address of offset of first item in this cell.
+                size_t              mNumIndices ;   ///< Number of items in this cell.
+        } ;
+
+        CellList()
+            : mNumChunks( 1 )
+            , mNumItemsMovedIncrementally( 0 )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        void Clear()
+        {
+            mCellBegin.Clear() ;
+            mOccupancy.Clear() ;
+            mItemIndices.Clear() ;
+            mItemOffsets.Clear() ;
+            mCellOfItem.Clear() ;
+            mSlotOfItem.Clear() ;
+            UniformGridGeometry::Clear() ;
+        }
+
+
+        /** Assign each of the given items to the cell that contains it.
+
+            \param items - Dynamic array of items to partition.  ItemT must have a Vec3 member named mPosition.
+
+            \param gridTemplate - Geometry of the partition.
+
+            \param minCellSpacing - Minimum size of each cell.  See UniformGridGeometry::FitShape.
+
+            If gridTemplate and minCellSpacing yield the same number of cells
+            along each axis as in the previous call, and items has the same
+            number of elements, then this routine reuses the previous partition:
+            It recomputes which cell each item occupies, then moves only the
+            indices of items that changed cells.
+            Otherwise this routine rebuilds the partition from scratch.
+
+            \note gridTemplate may be this object itself.
+        */
+        template <class ItemT> void Partition( const VECTOR< ItemT > & items , const UniformGridGeometry & gridTemplate , float minCellSpacing )
+        {
+            PERF_BLOCK( CellList__Partition ) ;
+
+            UniformGridGeometry fitted ;
+            fitted.FitShape( gridTemplate , minCellSpacing ) ;
+
+            // Cell offsets depend only on the number of points along each axis,
+            // so the previous partition remains structurally valid if those match,
+            // even if the grid moved.
+            const bool reusable =   ( fitted.GetNumPoints( 0 ) == GetNumPoints( 0 ) )
+                                &&  ( fitted.GetNumPoints( 1 ) == GetNumPoints( 1 ) )
+                                &&  ( fitted.GetNumPoints( 2 ) == GetNumPoints( 2 ) )
+                                &&  ( items.Size() == mCellOfItem.Size() )
+                                &&  ( mCellBegin.Size() == size_t( GetGridCapacity() ) + 1 ) ;
+
+            UniformGridGeometry::CopyShape( fitted ) ;
+
+            if( reusable )
+            {   // Layout and population are unchanged, so previous partition remains mostly valid.
+                Repartition( items ) ;
+            }
+            else
+            {   // Layout or population changed, so previous partition is useless.
+                Rebuild( items ) ;
+            }
+
+            RebuildCompactIndices() ;
+
+        #if defined( _DEBUG )
+            CheckConsistency() ;
+        #endif
+        }
+
+
+        /** Update this partition to account for items having been reordered.
+
+            \param newIndexOfOld - New index of each item, indexed by its old index.
+
+            This lets the caller reorder items (for example to improve memory locality)
+            without forcing the next call to Partition to rebuild from scratch.
+            Each cell retains the same items; only their indices change.
+            If the number of items differs from that of the most recent
+            partition, the partition is stale anyway, so this clears it.
+        */
+        void Permute( const VECTOR< unsigned > & newIndexOfOld )
+        {
+            PERF_BLOCK( CellList__Permute ) ;
+
+            const size_t numItems = newIndexOfOld.Size() ;
+            if( numItems != mCellOfItem.Size() )
+            {   // Partition does not correspond to items.
+                Clear() ;
+                return ;
+            }
+
+            for( size_t slot = 0 ; slot < mItemIndices.Size() ; ++ slot )
+            {   // For each item index in partition...
+                mItemIndices[ slot ] = newIndexOfOld[ mItemIndices[ slot ] ] ;
+            }
+
+            // Reuse scratch arrays from Rebuild to hold permuted per-item arrays.
+            mChunkSlots.Resize( numItems ) ;
+            mBlockBegin.Resize( numItems ) ;
+            for( size_t iOld = 0 ; iOld < numItems ; ++ iOld )
+            {   // For each item, in old order...
+                const unsigned iNew = newIndexOfOld[ iOld ] ;
+                mChunkSlots[ iNew ] = mCellOfItem[ iOld ] ;
+                mBlockBegin[ iNew ] = mSlotOfItem[ iOld ] ;
+            }
+            std::swap( mCellOfItem , mChunkSlots ) ;
+            std::swap( mSlotOfItem , mBlockBegin ) ;
+
+            RebuildCompactIndices() ;
+
+        #if defined( _DEBUG )
+            CheckConsistency() ;
+        #endif
+        }
+
+
+        /// Return view of the indices of items in the cell with the given indices.
+        Cell operator[]( const size_t indices[] ) const { return ( * this )[ OffsetFromIndices( indices ) ] ; }
+
+        /// Return view of the indices of items in the cell with the given indices.
+        Cell Get( size_t ix , size_t iy , size_t iz ) const { return ( * this )[ OffsetFromIndices( ix , iy , iz ) ] ; }
+
+        /// Return whether this has no cells, i.e. has not been partitioned since construction or Clear.
+        bool Empty() const { return mCellBegin.Empty() ; }
+
+        /// Return number of items in the cell with the given offset.
+        size_t GetNumItemsInCell( size_t cellOffset ) const
+        {
+            ASSERT( cellOffset + 1 < mCellBegin.Size() ) ;
+            return mCellBegin[ cellOffset + 1 ] - mCellBegin[ cellOffset ] ;
+        }
+
+        /// Return total number of items in cells with offsets in [cellBegin,cellEnd), e.g. a z slab when those span whole xy planes.
+        size_t GetNumItemsInCells( size_t cellBegin , size_t cellEnd ) const
+        {
+            ASSERT( ( cellBegin <= cellEnd ) && ( cellEnd < mCellBegin.Size() ) ) ;
+            return mCellBegin[ cellEnd ] - mCellBegin[ cellBegin ] ;
+        }
+
+        /// Return whether the cell with the given offset contains any items.
+        bool IsOccupied( size_t cellOffset ) const
+        {
+            ASSERT( ( cellOffset >> 6 ) < mOccupancy.Size() ) ;
+            return 0 != ( mOccupancy[ cellOffset >> 6 ] & ( 1ULL << ( cellOffset & 63 ) ) ) ;
+        }
+
+        /** Return offset of the first occupied cell with offset in [cellBegin,cellEnd), or cellEnd if all those cells are empty.
+
+            This scans 64 cells per word, so a loop over a row of cells, e.g.
+
+                for( size_t offset = FindOccupiedCell( rowBegin , rowEnd ) ; offset < rowEnd ; offset = FindOccupiedCell( offset + 1 , rowEnd ) )
+
+            costs little more per empty run than per occupied cell.
+        */
+        size_t FindOccupiedCell( size_t cellBegin , size_t cellEnd ) const
+        {
+            ASSERT( cellEnd <= mOccupancy.Size() * 64 ) ;
+            if( cellBegin >= cellEnd )
+            {
+                return cellEnd ;
+            }
+            size_t              iWord   = cellBegin >> 6 ;
+            unsigned long long  word    = mOccupancy[ iWord ] & ( ~ 0ULL << ( cellBegin & 63 ) ) ;  // Ignore cells before cellBegin.
+            const size_t        iWordLast = ( cellEnd - 1 ) >> 6 ;
+            while( 0 == word )
+            {   // All remaining cells in this word are empty.
+                if( iWord == iWordLast )
+                {
+                    return cellEnd ;
+                }
+                word = mOccupancy[ ++ iWord ] ;
+            }
+            const size_t cellOffset = ( iWord << 6 ) + LowestSetBitIndex( word ) ;
+            return Min2( cellOffset , cellEnd ) ;
+        }
+
+        /// Return view of the indices of items in the cell with the given offset.
+        Cell operator[]( size_t cellOffset ) const
+        {
+            ASSERT( cellOffset + 1 < mCellBegin.Size() ) ;
+            return Cell( mItemIndices.Empty() ? 0 : & mItemIndices[ mCellBegin[ cellOffset ] ] , GetNumItemsInCell( cellOffset ) ) ;
+        }
+
+        /// Return view of the indices of items in the cell containing the given position.
+        Cell operator[]( const Vec3 & vPosition ) const { return ( * this )[ OffsetOfPosition( vPosition ) ] ; }
+
+        /// Return whether the occupied cell with the given offset stores indices of its items in 16 bits.  See GetCompactCell.
+        bool IsCompact( size_t cellOffset ) const
+        {
+            ASSERT( GetNumItemsInCell( cellOffset ) > 0 ) ;
+            return WIDE_CELL != mItemOffsets[ mCellBegin[ cellOffset ] ] ;
+        }
+
+        /// Return view of the 16-bit indices of items in the cell with the given offset, which must be compact.
+        CompactCell GetCompactCell( size_t cellOffset ) const
+        {
+            ASSERT( IsCompact( cellOffset ) ) ;
+            const unsigned cellBegin = mCellBegin[ cellOffset ] ;
+            return CompactCell( cellBegin , & mItemOffsets[ cellBegin ] , mCellBegin[ cellOffset + 1 ] - cellBegin ) ;
+        }
+
+        /// Return number of items in the most recent partition.
+        size_t GetNumItems() const { return mCellOfItem.Size() ; }
+
+        /// Return offset of the cell that item iItem occupies.
+        unsigned GetCellOfItem( size_t iItem ) const { return mCellOfItem[ iItem ] ; }
+
+        /// Return offset into the indices of all items, sorted by cell, where the index of item iItem resides.
+        unsigned GetSlotOfItem( size_t iItem ) const { return mSlotOfItem[ iItem ] ; }
+
+        /// Return number of items whose index the most recent call to Partition moved incrementally; useful for tuning.
+        size_t GetNumItemsMovedIncrementally() const { return mNumItemsMovedIncrementally ; }
+
+        /// Return number of bytes this partition occupies, including scratch retained for reuse.  See MemoryBudget.
+        size_t GetMemoryUsage() const
+        {
+            return  mCellBegin.Capacity()   * sizeof( unsigned )
+                +   mOccupancy.Capacity()   * sizeof( unsigned long long )
+                +   mItemIndices.Capacity() * sizeof( unsigned )
+                +   mItemOffsets.Capacity() * sizeof( short )
+                +   mCellOfItem.Capacity()  * sizeof( unsigned )
+                +   mSlotOfItem.Capacity()  * sizeof( unsigned )
+                +   mChunkSlots.Capacity()  * sizeof( unsigned )
+                +   mBlockBegin.Capacity()  * sizeof( unsigned )
+                +   mMovedItems.Capacity()  * sizeof( MovedItem ) ;
+        }
+
+
+        /** Release memory this partition retains for reuse, for example after its grid became coarser.
+
+            \see UniformGrid::TrimMemory
+        */
+        void TrimMemory()
+        {
+            TrimVector( mCellBegin   ) ;
+            TrimVector( mOccupancy   ) ;
+            TrimVector( mItemIndices ) ;
+            TrimVector( mItemOffsets ) ;
+            TrimVector( mCellOfItem  ) ;
+            TrimVector( mSlotOfItem  ) ;
+            TrimVector( mChunkSlots  ) ;
+            TrimVector( mBlockBegin  ) ;
+            TrimVector( mMovedItems  ) ;
+        }
+
+
+        /** Visit each pair of items in the same or adjacent cells once, for pairs whose "here" item lies in the given box of cells.
+
+            This walks the "half neighborhood" of each cell:  Each item pairs
+            with the items that follow it in its own cell, and with every item
+            in the 13 adjacent cells whose offsets exceed that of its cell.
+            Every pair of items in the same or adjacent cells has exactly one
+            of its cells visit the other that way, so visiting every cell
+            visits every pair exactly once, and pairFunc should apply
+            equal and opposite contributions to both items.
+
+            \param box - Box of cells whose items are "here" items.  Adjacent
+                cells can lie outside the box, so when pairFunc modifies items
+                in place, boxes that run concurrently must not be adjacent; see
+                ForEachCellBlockByColor.  When pairFunc instead accumulates into
+                a buffer per concurrent task, any boxes can run concurrently.
+
+            \param pairFunc - Function object with operator()( unsigned idxHere , unsigned idxThere ).
+
+            Cells that IsCompact supply indices in 16 bits, so for those,
+            inner loops read half as many bytes of indices.
+
+            \note Offsets of -1 along x or y from the first cell of a row or
+                layer reach gridpoints past the last cell of an earlier row or
+                layer.  Those hold no items, since items lie within the grid
+                extent, and every offset from a cell in the domain stays within
+                the grid capacity, so this needs no bounds checks.
+        */
+        template< class PairFuncT > void ForEachPairInHalfNeighborhood( const CellBox & box , PairFuncT & pairFunc ) const
+        {
+            ASSERT( box.mEnd[0] <= GetNumCells( 0 ) ) ;
+            ASSERT( box.mEnd[1] <= GetNumCells( 1 ) ) ;
+            ASSERT( box.mEnd[2] <= GetNumCells( 2 ) ) ;
+
+            const int nx    = int( GetNumPoints( 0 ) ) ;
+            const int nxy   = int( GetNumPoints( 0 ) * GetNumPoints( 1 ) ) ;
+
+            const int neighborCellOffsets[] =
+            {   // Offsets to neighboring cells whose indices exceed this one:
+                   1            // + , 0 , 0 ( 1)
+                , -1 + nx       // - , + , 0 ( 2)
+                ,    + nx       // 0 , + , 0 ( 3)
+                ,  1 + nx       // + , + , 0 ( 4)
+                , -1 - nx + nxy // - , - , + ( 5)
+                ,    - nx + nxy // 0 , - , + ( 6)
+                ,  1 - nx + nxy // + , - , + ( 7)
+                , -1      + nxy // - , 0 , + ( 8)
+                ,         + nxy // 0 , 0 , + ( 9)
+                ,  1      + nxy // + , 0 , + (10)
+                , -1 + nx + nxy // - , + , + (11)
+                ,      nx + nxy // 0 , + , + (12)
+                ,  1 + nx + nxy // + , + , + (13)
+            } ;
+            static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
+
+            size_t idx[3] ;
+            for( idx[2] = box.mBegin[2] ; idx[2] < box.mEnd[2] ; ++ idx[2] )
+            {   // For all grid cells along z...
+                const size_t offsetZ0 = idx[2] * nxy ;
+                for( idx[1] = box.mBegin[1] ; idx[1] < box.mEnd[1] ; ++ idx[1] )
+                {   // For all grid cells along y...
+                    const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
+                    const size_t rowBegin   = box.mBegin[0] + offsetY0Z0 ;
+                    const size_t rowEnd     = box.mEnd[0]   + offsetY0Z0 ;
+                    for( size_t offsetX0Y0Z0 = FindOccupiedCell( rowBegin , rowEnd ) ; offsetX0Y0Z0 < rowEnd ; offsetX0Y0Z0 = FindOccupiedCell( offsetX0Y0Z0 + 1 , rowEnd ) )
+                    {   // For each occupied grid cell along x...
+                        if( IsCompact( offsetX0Y0Z0 ) )
+                        {   // Indices of items here fit in 16 bits.
+                            ForEachPairWithCellHere( GetCompactCell( offsetX0Y0Z0 ) , offsetX0Y0Z0 , neighborCellOffsets , numNeighborCells , pairFunc ) ;
+                        }
+                        else
+                        {
+                            ForEachPairWithCellHere( ( * this )[ offsetX0Y0Z0 ] , offsetX0Y0Z0 , neighborCellOffsets , numNeighborCells , pairFunc ) ;
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        /// Value, in the first slot of a cell in mItemOffsets, indicating that indices of items in that cell do not fit in 16 bits.
+        static const short WIDE_CELL = -32767 - 1 ;
+
+        /** Visit pairs whose "here" item lies in the given cell, for ForEachPairInHalfNeighborhood.
+
+            \param cellHere - View of indices of items in the cell with offset offsetHere; either Cell or CompactCell.
+        */
+        template< class CellT , class PairFuncT > void ForEachPairWithCellHere( const CellT & cellHere , size_t offsetHere , const int neighborCellOffsets[] , size_t numNeighborCells , PairFuncT & pairFunc ) const
+        {
+            const size_t numInCellHere = cellHere.Size() ;
+            for( unsigned ivHere = 0 ; ivHere < numInCellHere ; ++ ivHere )
+            {   // For each item in this cell...
+                const unsigned idxHere = cellHere[ ivHere ] ;
+                for( unsigned ivThere = ivHere + 1 ; ivThere < numInCellHere ; ++ ivThere )
+                {   // For each OTHER item that follows it within this same cell...
+                    pairFunc( idxHere , cellHere[ ivThere ] ) ;
+                }
+                for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
+                {   // For each cell in half neighborhood...
+                    const size_t offsetThere = offsetHere + neighborCellOffsets[ idxNeighborCell ] ;
+                    if( ! IsOccupied( offsetThere ) ) continue ;
+                    if( IsCompact( offsetThere ) )
+                    {
+                        PairWithCell( idxHere , GetCompactCell( offsetThere ) , pairFunc ) ;
+                    }
+                    else
+                    {
+                        PairWithCell( idxHere , ( * this )[ offsetThere ] , pairFunc ) ;
+                    }
+                }
+            }
+        }
+
+
+        /** Visit pairs of the given item with each item in the given cell, which is either Cell or CompactCell.
+        */
+        template< class CellT , class PairFuncT > static void PairWithCell( unsigned idxHere , const CellT & cellThere , PairFuncT & pairFunc )
+        {
+            const size_t numInCellThere = cellThere.Size() ;
+            for( unsigned ivThere = 0 ; ivThere < numInCellThere ; ++ ivThere )
+            {   // For each item in neighboring cell...
+                pairFunc( idxHere , cellThere[ ivThere ] ) ;
+            }
+        }
+
+
+        /** Encode index of each item in 16 bits, relative to the first slot of its cell, in cells where all those fit.
+
+            Runs after every change to mItemIndices, in O(items + cells) time.
+            Each cell where some index does not fit gets WIDE_CELL in its
+            first slot, so readers use its 32-bit indices instead.
+        */
+        void RebuildCompactIndices()
+        {
+            const size_t numCells = GetGridCapacity() ;
+            mItemOffsets.Resize( mItemIndices.Size() ) ;
+            for( size_t iCell = FindOccupiedCell( 0 , numCells ) ; iCell < numCells ; iCell = FindOccupiedCell( iCell + 1 , numCells ) )
+            {   // For each occupied cell...
+                const unsigned cellBegin    = mCellBegin[ iCell ] ;
+                const unsigned cellEnd      = mCellBegin[ iCell + 1 ] ;
+                for( unsigned slot = cellBegin ; slot < cellEnd ; ++ slot )
+                {   // For each item in cell...
+                    const int offset = int( mItemIndices[ slot ] ) - int( cellBegin ) ;
+                    if( ( offset < -32767 ) || ( offset > 32767 ) )
+                    {   // Index lies too far from its slot, so this cell keeps only 32-bit indices.
+                        mItemOffsets[ cellBegin ] = WIDE_CELL ;
+                        break ;
+                    }
+                    mItemOffsets[ slot ] = static_cast< short >( offset ) ;
+                }
+            }
+        }
+
+
+        /** Build partition from scratch using a counting sort.
+
+            Items split into contiguous chunks, one per processor, and cells
+            split into the same number of contiguous blocks.  Each chunk counts
+            its own items per cell, so chunks need no synchronization, and
+            a two-level prefix sum (within each block, then across blocks)
+            turns those counts into the slot where each chunk starts writing
+            into each cell.  Chunks write in order of increasing item index, so
+            the result does not depend on the number of chunks.
+        */
+        template <class ItemT> void Rebuild( const VECTOR< ItemT > & items )
+        {
+            const size_t numItems = items.Size() ;
+            const size_t numCells = GetGridCapacity() ;
+
+            mCellOfItem.Resize( numItems ) ;
+            mSlotOfItem.Resize( numItems ) ;
+            mItemIndices.Resize( numItems ) ;
+            mCellBegin.Resize( numCells + 1 ) ;
+            mNumItemsMovedIncrementally = 0 ;
+
+        #if USE_TBB
+            // Use one chunk per processor, but avoid chunks so small that scheduling them costs more than sorting them.
+            static const size_t minItemsPerChunk = 4096 ;
+            mNumChunks = Clamp( numItems / minItemsPerChunk , size_t( 1 ) , size_t( gNumberOfProcessors ) ) ;
+        #else
+            mNumChunks = 1 ;
+        #endif
+            mChunkSlots.Resize( mNumChunks * numCells ) ;
+            mBlockBegin.Resize( mNumChunks ) ;
+
+            RunRebuildStage( items , REBUILD_STAGE_COUNT ) ;
+            RunRebuildStage( items , REBUILD_STAGE_TOTAL ) ;
+
+            // Convert block totals to offsets using an exclusive prefix sum.  There is one block per chunk, so this is cheap.
+            unsigned blockBegin = 0 ;
+            for( size_t iBlock = 0 ; iBlock < mNumChunks ; ++ iBlock )
+            {
+                const unsigned blockTotal = mBlockBegin[ iBlock ] ;
+                mBlockBegin[ iBlock ] = blockBegin ;
+                blockBegin += blockTotal ;
+            }
+            ASSERT( numItems == blockBegin ) ;
+            mCellBegin[ numCells ] = blockBegin ;
+
+            RunRebuildStage( items , REBUILD_STAGE_SCAN ) ;
+            RunRebuildStage( items , REBUILD_STAGE_SCATTER ) ;
+
+            RebuildOccupancy() ;
+        }
+
+
+        /** Set occupancy bits of all cells from their offsets.
+
+            Words span cells of adjacent rebuild blocks, so this runs after
+            the parallel stages rather than within them.
+        */
+        void RebuildOccupancy()
+        {
+            const size_t numCells = GetGridCapacity() ;
+            const size_t numWords = ( numCells + 63 ) >> 6 ;
+            mOccupancy.Resize( numWords ) ;
+            for( size_t iWord = 0 ; iWord < numWords ; ++ iWord )
+            {   // For each word of occupancy bits...
+                const size_t        cellBegin   = iWord << 6 ;
+                const size_t        cellEnd     = Min2( cellBegin + 64 , numCells ) ;
+                unsigned long long  word        = 0 ;
+                for( size_t iCell = cellBegin ; iCell < cellEnd ; ++ iCell )
+                {   // For each cell in word...
+                    if( mCellBegin[ iCell + 1 ] != mCellBegin[ iCell ] )
+                    {   // Cell has items.
+                        word |= 1ULL << ( iCell - cellBegin ) ;
+                    }
+                }
+                mOccupancy[ iWord ] = word ;
+            }
+        }
+
+
+        /** Run the given stage of Rebuild for every chunk.
+        */
+        template <class ItemT> void RunRebuildStage( const VECTOR< ItemT > & items , RebuildStageE stage )
+        {
+            Parallel::For( 0 , mNumChunks , 1 , Parallel::Method( this , & CellList::RebuildChunks< ItemT > , items , stage ) ) ;
+        }
+
+
+        /** Run the given stage of Rebuild for chunks [chunkBegin,chunkEnd).
+        */
+        template <class ItemT> void RebuildChunks( const VECTOR< ItemT > & items , RebuildStageE stage , size_t chunkBegin , size_t chunkEnd )
+        {
+            for( size_t iChunk = chunkBegin ; iChunk < chunkEnd ; ++ iChunk )
+            {
+                RebuildChunk( items , iChunk , stage ) ;
+            }
+        }
+
+
+        /** Run the given stage of Rebuild for one chunk of items, or one block of cells.
+
+            mChunkSlots has one row per chunk, and one column per cell.
+            After REBUILD_STAGE_COUNT, each element holds the number of items
+            of that chunk in that cell.  After REBUILD_STAGE_TOTAL, it holds
+            the number of items in that cell from preceding chunks, i.e. the
+            offset within the cell where that chunk starts writing.
+        */
+        template <class ItemT> void RebuildChunk( const VECTOR< ItemT > & items , size_t iChunk , RebuildStageE stage )
+        {
+            const size_t numItems       = items.Size() ;
+            const size_t numCells       = GetGridCapacity() ;
+            unsigned *   chunkSlots     = & mChunkSlots[ iChunk * numCells ] ;
+
+            // Chunk iChunk spans items [itemBegin,itemEnd), and block iChunk spans cells [cellBegin,cellEnd).
+            const size_t itemBegin      = numItems * iChunk         / mNumChunks ;
+            const size_t itemEnd        = numItems * ( iChunk + 1 ) / mNumChunks ;
+            const size_t cellBegin      = numCells * iChunk         / mNumChunks ;
+            const size_t cellEnd        = numCells * ( iChunk + 1 ) / mNumChunks ;
+
+            switch( stage )
+            {
+            case REBUILD_STAGE_COUNT:
+                for( size_t iCell = 0 ; iCell < numCells ; ++ iCell )
+                {
+                    chunkSlots[ iCell ] = 0 ;
+                }
+                for( size_t iItem = itemBegin ; iItem < itemEnd ; ++ iItem )
+                {   // For each item in chunk...
+                    const unsigned cellOffset = OffsetOfPosition( items[ iItem ].mPosition ) ;
+                    mCellOfItem[ iItem ] = cellOffset ;
+                    ++ chunkSlots[ cellOffset ] ;
+                }
+                break ;
+
+            case REBUILD_STAGE_TOTAL:
+            {
+                unsigned blockTotal = 0 ;
+                for( size_t iCell = cellBegin ; iCell < cellEnd ; ++ iCell )
+                {   // For each cell in block...
+                    unsigned cellTotal = 0 ;
+                    for( size_t jChunk = 0 ; jChunk < mNumChunks ; ++ jChunk )
+                    {   // For each chunk...
+                        unsigned & rSlot = mChunkSlots[ jChunk * numCells + iCell ] ;
+                        const unsigned count = rSlot ;
+                        rSlot = cellTotal ;
+                        cellTotal += count ;
+                    }
+                    mCellBegin[ iCell ] = cellTotal ;   // Temporarily store total; REBUILD_STAGE_SCAN converts it to an offset.
+                    blockTotal += cellTotal ;
+                }
+                mBlockBegin[ iChunk ] = blockTotal ;    // Temporarily store total; Rebuild converts it to an offset.
+            }
+                break ;
+
+            case REBUILD_STAGE_SCAN:
+            {
+                unsigned slot = mBlockBegin[ iChunk ] ;
+                for( size_t iCell = cellBegin ; iCell < cellEnd ; ++ iCell )
+                {   // For each cell in block...
+                    const unsigned cellTotal = mCellBegin[ iCell ] ;
+                    mCellBegin[ iCell ] = slot ;
+                    slot += cellTotal ;
+                }
+            }
+                break ;
+
+            case REBUILD_STAGE_SCATTER:
+                for( size_t iItem = itemBegin ; iItem < itemEnd ; ++ iItem )
+                {   // For each item in chunk...
+                    const unsigned cellOffset   = mCellOfItem[ iItem ] ;
+                    const unsigned slot         = mCellBegin[ cellOffset ] + chunkSlots[ cellOffset ] ++ ;
+                    Place( static_cast< unsigned >( iItem ) , slot ) ;
+                }
+                break ;
+
+            default:
+                FAIL() ;
+                break ;
+            }
+        }
+
+
+        /** Update existing partition, moving only indices of items that changed cells.
+
+            Moving an index from one cell to another shifts the boundaries of every
+            cell in between, which costs one copy per intervening cell.  If those
+            moves would cost more than rebuilding, this rebuilds instead.
+        */
+        template <class ItemT> void Repartition( const VECTOR< ItemT > & items )
+        {
+            const size_t numItems = items.Size() ;
+
+            // Find which items changed cells, and estimate the cost of moving their indices.
+            mMovedItems.Clear() ;
+            size_t moveCost = 0 ;
+            for( size_t iItem = 0 ; iItem < numItems ; ++ iItem )
+            {   // For each item...
+                const unsigned cellOffset = OffsetOfPosition( items[ iItem ].mPosition ) ;
+                if( cellOffset != mCellOfItem[ iItem ] )
+                {   // Item changed cells.
+                    mMovedItems.PushBack( MovedItem( static_cast< unsigned >( iItem ) , cellOffset ) ) ;
+                    moveCost += ( cellOffset > mCellOfItem[ iItem ] ) ? ( cellOffset - mCellOfItem[ iItem ] ) : ( mCellOfItem[ iItem ] - cellOffset ) ;
+                }
+            }
+
+            if( moveCost > numItems + mCellBegin.Size() )
+            {   // Moving would cost more than rebuilding, which visits every item and every cell.
+                Rebuild( items ) ;
+                return ;
+            }
+
+            const size_t numMoved = mMovedItems.Size() ;
+            for( size_t iMoved = 0 ; iMoved < numMoved ; ++ iMoved )
+            {   // For each item that changed cells...
+                MoveItem( mMovedItems[ iMoved ].mItem , mMovedItems[ iMoved ].mNewCell ) ;
+            }
+            mNumItemsMovedIncrementally = numMoved ;
+        }
+
+
+        /** Place an index into the given slot, and remember where it went.
+        */
+        void Place( unsigned iItem , unsigned slot )
+        {
+            mItemIndices[ slot ] = iItem ;
+            mSlotOfItem[ iItem ] = slot ;
+        }
+
+
+        /** Move index of the given item from its current cell into the given cell.
+
+            This keeps every cell contiguous by carrying a "hole" across the
+            intervening cells:  Each intervening cell slides by one slot, by moving
+            one of its end indices into the hole at its other end.
+        */
+        void MoveItem( unsigned iItem , unsigned newCell )
+        {
+            const unsigned oldCell = mCellOfItem[ iItem ] ;
+            ASSERT( oldCell != newCell ) ;
+
+            if( newCell > oldCell )
+            {   // Item moves toward higher slots.
+                // Swap item to last slot of its old cell, so it vacates that slot.
+                unsigned hole = mCellBegin[ oldCell + 1 ] - 1 ;
+                Place( mItemIndices[ hole ] , mSlotOfItem[ iItem ] ) ;
+                for( unsigned iCell = oldCell + 1 ; iCell < newCell ; ++ iCell )
+                {   // For each intervening cell, slide it down by one slot.
+                    // Move its last index into the hole just before its first slot.
+                    const unsigned last = mCellBegin[ iCell + 1 ] - 1 ;
+                    if( last != hole )
+                    {   // Cell is not empty.
+                        Place( mItemIndices[ last ] , hole ) ;
+                    }
+                    -- mCellBegin[ iCell ] ;
+                    hole = last ;
+                }
+                // New cell grows downward into the hole.
+                -- mCellBegin[ newCell ] ;
+                Place( iItem , hole ) ;
+            }
+            else
+            {   // Item moves toward lower slots.
+                // Swap item to first slot of its old cell, so it vacates that slot.
+                unsigned hole = mCellBegin[ oldCell ] ;
+                Place( mItemIndices[ hole ] , mSlotOfItem[ iItem ] ) ;
+                for( unsigned iCell = oldCell - 1 ; iCell > newCell ; -- iCell )
+                {   // For each intervening cell, slide it up by one slot.
+                    // Move its first index into the hole just after its last slot.
+                    const unsigned first = mCellBegin[ iCell ] ;
+                    if( first != hole )
+                    {   // Cell is not empty.
+                        Place( mItemIndices[ first ] , hole ) ;
+                    }
+                    ++ mCellBegin[ iCell + 1 ] ;
+                    hole = first ;
+                }
+                // New cell grows upward into the hole.
+                ++ mCellBegin[ newCell + 1 ] ;
+                Place( iItem , hole ) ;
+            }
+            mCellOfItem[ iItem ] = newCell ;
+
+            // Intervening cells only slid, so only the old and new cells can change occupancy.
+            mOccupancy[ newCell >> 6 ] |= 1ULL << ( newCell & 63 ) ;
+            if( mCellBegin[ oldCell + 1 ] == mCellBegin[ oldCell ] )
+            {   // Old cell became empty.
+                mOccupancy[ oldCell >> 6 ] &= ~ ( 1ULL << ( oldCell & 63 ) ) ;
+            }
+        }
+
+
+    #if defined( _DEBUG )
+        /** Verify that cell offsets, item indices and their inverses agree.
+        */
+        void CheckConsistency() const
+        {
+            const size_t numItems = mItemIndices.Size() ;
+            ASSERT( mCellBegin.Size() == size_t( GetGridCapacity() ) + 1 ) ;
+            ASSERT( 0 == mCellBegin[ 0 ] ) ;
+            ASSERT( numItems == mCellBegin[ GetGridCapacity() ] ) ;
+            for( size_t iItem = 0 ; iItem < numItems ; ++ iItem )
+            {
+                const unsigned slot = mSlotOfItem[ iItem ] ;
+                const unsigned cell = mCellOfItem[ iItem ] ;
+                ASSERT( iItem == mItemIndices[ slot ] ) ;
+                ASSERT( ( slot >= mCellBegin[ cell ] ) && ( slot < mCellBegin[ cell + 1 ] ) ) ;
+                (void) slot , cell ;
+            }
+            ASSERT( mOccupancy.Size() == ( size_t( GetGridCapacity() ) + 63 ) >> 6 ) ;
+            for( size_t iCell = 0 ; iCell < size_t( GetGridCapacity() ) ; ++ iCell )
+            {
+                ASSERT( IsOccupied( iCell ) == ( mCellBegin[ iCell + 1 ] != mCellBegin[ iCell ] ) ) ;
+            }
+            ASSERT( mItemOffsets.Size() == numItems ) ;
+            for( size_t iCell = FindOccupiedCell( 0 , GetGridCapacity() ) ; iCell < GetGridCapacity() ; iCell = FindOccupiedCell( iCell + 1 , GetGridCapacity() ) )
+            {
+                if( IsCompact( iCell ) )
+                {   // 16-bit indices must match 32-bit indices.
+                    const CompactCell   compactCell = GetCompactCell( iCell ) ;
+                    const Cell          cell        = ( * this )[ iCell ] ;
+                    for( size_t iv = 0 ; iv < cell.Size() ; ++ iv )
+                    {
+                        ASSERT( compactCell[ iv ] == cell[ iv ] ) ;
+                    }
+                }
+            }
+        }
+    #endif
+
+        /// Release memory the given array retains beyond its population.
+        template< class VectorT > static void TrimVector( VectorT & vec )
+        {
+            if( vec.Capacity() > vec.Size() )
+            {
+                VectorT( vec ).swap( vec ) ;
+            }
+        }
+
+        /// Item that changed cells since the previous partition.
+        struct MovedItem
+        {
+            MovedItem( unsigned item , unsigned newCell ) : mItem( item ) , mNewCell( newCell ) {}
+            unsigned    mItem       ;   ///< Index of item
+            unsigned    mNewCell    ;   ///< Offset of cell item now occupies
+        } ;
+
+        VECTOR< unsigned >  mCellBegin                  ;   ///< Offset into mItemIndices of first index in each cell.  Has one more element than cells, so cell i spans [mCellBegin[i],mCellBegin[i+1]).
+        VECTOR< unsigned long long > mOccupancy         ;   ///< One bit per cell, set when cell has items.  Bit (i%64) of word (i/64) belongs to cell with offset i.
+        VECTOR< unsigned >  mItemIndices                ;   ///< Indices of items, sorted by cell.
+        VECTOR< short >     mItemOffsets                ;   ///< Indices of items, sorted by cell, each minus the first slot of its cell.  Cells where those do not fit hold WIDE_CELL in their first slot.
+        VECTOR< unsigned >  mCellOfItem                 ;   ///< Offset of cell each item occupies, indexed by item.
+        VECTOR< unsigned >  mSlotOfItem                 ;   ///< Offset into mItemIndices where each item's index resides, indexed by item.
+        VECTOR< unsigned >  mChunkSlots                 ;   ///< Per-chunk, per-cell counts then offsets, used while rebuilding.  See RebuildChunk.
+        VECTOR< unsigned >  mBlockBegin                 ;   ///< Per-block totals then offsets, used while rebuilding.
+        size_t              mNumChunks                  ;   ///< Number of chunks into which Rebuild splits items, and blocks into which it splits cells.
+        VECTOR< MovedItem > mMovedItems                 ;   ///< Items that changed cells, used while repartitioning.
+        size_t              mNumItemsMovedIncrementally ;   ///< Number of items the most recent Partition moved without rebuilding.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
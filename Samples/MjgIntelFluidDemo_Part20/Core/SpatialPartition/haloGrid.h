@@ -0,0 +1,177 @@
+/** \file haloGrid.h
+
+    \brief Copy of a UniformGrid padded with one layer of ghost gridpoints on each face, so stencils need no boundary branches
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef HALO_GRID_H
+#define HALO_GRID_H
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+#include "Core/Containers/vector.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Copy of a UniformGrid padded with one layer of ghost gridpoints ("halo") on each face.
+
+    Finite-difference stencils that read neighbors of each gridpoint need
+    different forms at the domain boundary, where some neighbors do not
+    exist.  Testing indices against GetNumPoints inside loops costs branches
+    and defeats vectorization, and splitting loops into interior and
+    boundary passes duplicates every stencil.
+
+    Instead, this stores a copy of the grid with one extra gridpoint at each
+    end of each axis.  CopyFrom fills those ghost gridpoints in a separate
+    pass, by extrapolating from the values just inside, so that a centered
+    stencil applied at a boundary gridpoint yields the one-sided stencil the
+    boundary calls for.  Stencil kernels then run the same centered form,
+    without branches, over every gridpoint.
+
+    Only ghost gridpoints adjacent to a face are filled, not those along
+    edges or at corners, so this suits stencils that only read neighbors
+    along one axis at a time, such as 7-point Laplacian and centered
+    difference stencils.
+
+    Geometry (GetNumPoints, GetCellSpacing and so on) describes the grid
+    this copied, without the halo.  Indices passed to OffsetFromIndices
+    refer to that grid, so index 0 is the first non-ghost gridpoint.
+*/
+template <class ItemT> class HaloGrid : public UniformGridGeometry
+{
+    public:
+        /// How CopyFrom extrapolates values into ghost gridpoints.
+        enum HaloFillE
+        {
+            HALO_FILL_COPY      ,   ///< Ghost equals boundary value, so centered first derivatives across the boundary have half their usual weight.
+            HALO_FILL_LINEAR    ,   ///< Ghost lies on the line through the 2 values nearest the boundary, so centered first differences become one-sided first differences.
+            HALO_FILL_QUADRATIC     ///< Ghost lies on the parabola through the 3 values nearest the boundary, so centered second differences become the second difference just inside.
+        } ;
+
+        HaloGrid()
+        {
+            mStrides[ 0 ] = mStrides[ 1 ] = mStrides[ 2 ] = 0 ;
+        }
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+
+        /** Copy values and shape from the given grid, then fill ghost gridpoints.
+
+            \param src - Grid to copy.  It must have values, i.e. src.Size() == src.GetGridCapacity().
+
+            \param fill - How to extrapolate values into ghost gridpoints.
+                Along axes with too few gridpoints for the given rule, this
+                uses the next simpler rule, down to HALO_FILL_COPY.
+
+            This reuses memory from previous calls.
+        */
+        void CopyFrom( const UniformGrid< ItemT > & src , HaloFillE fill )
+        {
+            PERF_BLOCK( HaloGrid__CopyFrom ) ;
+
+            ASSERT( src.Size() == src.GetGridCapacity() ) ;
+
+            UniformGridGeometry::CopyShape( src ) ;
+            mStrides[ 0 ] = 1 ;
+            mStrides[ 1 ] = GetNumPoints( 0 ) + 2 ;
+            mStrides[ 2 ] = mStrides[ 1 ] * ( GetNumPoints( 1 ) + 2 ) ;
+            mContents.Resize( mStrides[ 2 ] * ( GetNumPoints( 2 ) + 2 ) ) ;
+
+            Parallel::For( 0 , GetNumPoints( 2 ) , 1 , Parallel::Method( this , & HaloGrid::CopyLayers , src ) ) ;
+
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {
+                FillFaces( axis , fill ) ;
+            }
+        }
+
+
+        /// Return offset into contents of the gridpoint with the given indices, which may be -1 or GetNumPoints for ghost gridpoints.
+        size_t OffsetFromIndices( ptrdiff_t ix , ptrdiff_t iy , ptrdiff_t iz ) const
+        {
+            return size_t( ( ix + 1 ) + ( iy + 1 ) * ptrdiff_t( mStrides[ 1 ] ) + ( iz + 1 ) * ptrdiff_t( mStrides[ 2 ] ) ) ;
+        }
+
+        /// Return distance, in elements, between adjacent gridpoints along the given axis.
+        const size_t &  GetStride( unsigned axis ) const    { return mStrides[ axis ] ; }
+
+        /// Return value at the gridpoint with the given offset.  See OffsetFromIndices.
+        const ItemT &   operator[]( size_t offset ) const   { return mContents[ offset ] ; }
+
+        /// Return whether this has no values, i.e. has not been filled since construction.
+        bool            Empty() const                       { return mContents.Empty() ; }
+
+    private:
+        /** Copy non-ghost values of the given range of z-layers from src.
+        */
+        void CopyLayers( const UniformGrid< ItemT > & src , size_t izBegin , size_t izEnd )
+        {
+            const size_t nx = GetNumPoints( 0 ) ;
+            const size_t ny = GetNumPoints( 1 ) ;
+            for( size_t iz = izBegin ; iz < izEnd ; ++ iz )
+            {   // For each z-layer...
+                for( size_t iy = 0 ; iy < ny ; ++ iy )
+                {   // For each row along x...
+                    const ItemT *   srcRow  = & src[ src.OffsetFromIndices( 0 , iy , iz ) ] ;
+                    ItemT *         dstRow  = & mContents[ OffsetFromIndices( 0 , ptrdiff_t( iy ) , ptrdiff_t( iz ) ) ] ;
+                    for( size_t ix = 0 ; ix < nx ; ++ ix )
+                    {
+                        dstRow[ ix ] = srcRow[ ix ] ;
+                    }
+                }
+            }
+        }
+
+
+        /** Fill ghost gridpoints on both faces perpendicular to the given axis.
+        */
+        void FillFaces( unsigned axis , HaloFillE fill )
+        {
+            const unsigned  axisU       = ( axis + 1 ) % 3 ;    // Axes that span the face.
+            const unsigned  axisV       = ( axis + 2 ) % 3 ;
+            const size_t    numAlong    = GetNumPoints( axis ) ;
+            const ptrdiff_t stride      = ptrdiff_t( mStrides[ axis ] ) ;
+
+            // Choose the richest rule this axis has enough gridpoints for.
+            if( ( HALO_FILL_QUADRATIC == fill ) && ( numAlong < 3 ) ) fill = HALO_FILL_LINEAR ;
+            if( ( HALO_FILL_LINEAR    == fill ) && ( numAlong < 2 ) ) fill = HALO_FILL_COPY ;
+
+            ptrdiff_t idx[ 3 ] ;
+            for( idx[ axisV ] = 0 ; idx[ axisV ] < ptrdiff_t( GetNumPoints( axisV ) ) ; ++ idx[ axisV ] )
+            {
+                for( idx[ axisU ] = 0 ; idx[ axisU ] < ptrdiff_t( GetNumPoints( axisU ) ) ; ++ idx[ axisU ] )
+                {   // For each gridpoint on face...
+                    idx[ axis ] = 0 ;
+                    ItemT * lo = & mContents[ OffsetFromIndices( idx[ 0 ] , idx[ 1 ] , idx[ 2 ] ) ] ;
+                    idx[ axis ] = ptrdiff_t( numAlong ) - 1 ;
+                    ItemT * hi = & mContents[ OffsetFromIndices( idx[ 0 ] , idx[ 1 ] , idx[ 2 ] ) ] ;
+                    switch( fill )
+                    {
+                        case HALO_FILL_COPY:
+                            lo[ - stride ] = lo[ 0 ] ;
+                            hi[   stride ] = hi[ 0 ] ;
+                        break ;
+                        case HALO_FILL_LINEAR:
+                            lo[ - stride ] = 2.0f * lo[ 0 ] - lo[   stride ] ;
+                            hi[   stride ] = 2.0f * hi[ 0 ] - hi[ - stride ] ;
+                        break ;
+                        case HALO_FILL_QUADRATIC:
+                            lo[ - stride ] = 3.0f * ( lo[ 0 ] - lo[   stride ] ) + lo[   2 * stride ] ;
+                            hi[   stride ] = 3.0f * ( hi[ 0 ] - hi[ - stride ] ) + hi[ - 2 * stride ] ;
+                        break ;
+                    }
+                }
+            }
+        }
+
+        VECTOR< ItemT > mContents       ;   ///< Values at gridpoints, including ghosts, x fastest.
+        size_t          mStrides[ 3 ]   ;   ///< Distance, in elements, between adjacent gridpoints along each axis, including ghosts.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
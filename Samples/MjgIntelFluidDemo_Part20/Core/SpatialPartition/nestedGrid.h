@@ -65,26 +65,70 @@ template <class ItemT> class NestedGrid
 
             \param src - UniformGrid upon which this NestedGrid is based.
 
+            Callers reinitialize the same nested grid every step, so this reuses
+            existing layers and the memory they hold, instead of destroying and
+            recreating them.  See UniformGrid::Init.
+
         */
         void Initialize( const UniformGridGeometry & src )
         {
             PERF_BLOCK( NestedGrid__Initialize ) ;
 
-            mLayers.Clear() ;
             const size_t numLayers = PrecomputeNumLayers( src ) ;
             mLayers.Reserve( numLayers ) ;  // Preallocate number of layers to avoid reallocation during PushBack.
-            AddLayer( src , 1 ) ;
+            ReinitializeLayer( 0 , src , 1 ) ;
             unsigned index = 1 ;
             while( mLayers[ index-1 ].GetGridCapacity() > 8 /* a cell has 8 corners */ )
             {   // Layer to decimate has more than 1 cell.
-                AddLayer( mLayers[ index - 1 ] , 2 ) ; // Initialize child layer based on decimation of its parent grid.
+                ReinitializeLayer( index , mLayers[ index - 1 ] , 2 ) ; // Initialize child layer based on decimation of its parent grid.
                 ++ index ;
             }
+            while( mLayers.Size() > index )
+            {   // Previous shape had more layers than this one.
+                mLayers.PopBack() ;
+            }
 
             PrecomputeDecimations() ;
         }
 
 
+        /** Move and stretch this nested grid to match the given geometry, keeping the contents of each layer, if possible.
+
+            \param src - UniformGrid upon which this NestedGrid is based.
+
+            \return Whether this kept its contents.  That happens when the leaf
+                layer already had the same number of points along each axis as src.
+                Otherwise this calls Initialize, which empties every layer, and returns false.
+
+            Offsets into each layer depend only on the number of points along
+            each axis, and so do the number of layers and their decimations.
+            So when those match, each cell keeps its offset even though the grid
+            moved, and callers can update only the cells whose contents changed.
+
+        */
+        bool Refit( const UniformGridGeometry & src )
+        {
+            PERF_BLOCK( NestedGrid__Refit ) ;
+
+            const bool reusable =   ! Empty()
+                                &&  ( src.GetNumPoints( 0 ) == mLayers[ 0 ].GetNumPoints( 0 ) )
+                                &&  ( src.GetNumPoints( 1 ) == mLayers[ 0 ].GetNumPoints( 1 ) )
+                                &&  ( src.GetNumPoints( 2 ) == mLayers[ 0 ].GetNumPoints( 2 ) ) ;
+            if( ! reusable )
+            {
+                Initialize( src ) ;
+                return false ;
+            }
+
+            mLayers[ 0 ].Decimate( src , 1 ) ;
+            for( size_t index = 1 ; index < GetDepth() ; ++ index )
+            {   // For each parent layer, reshape it to match its child without touching its contents.
+                mLayers[ index ].Decimate( mLayers[ index - 1 ] , 2 ) ;
+            }
+            return true ;
+        }
+
+
         /** Add a layer to the top of the nested grid.
 
             \param layerTemplate - UniformGridGeometry defining child layer.
@@ -104,11 +148,69 @@ template <class ItemT> class NestedGrid
         }
 
 
+        /** Reshape the layer at the given depth, adding it if it does not exist yet.
+
+            \param index - Depth of layer to reshape.  Must not exceed GetDepth.
+
+            \param layerTemplate - UniformGridGeometry defining child layer.
+
+            \param iDecimation - Amount by which to decimate child layer, in each direction.
+
+            Unlike AddLayer, this reuses memory an existing layer already holds.
+
+        */
+        void ReinitializeLayer( size_t index , const UniformGridGeometry & layerTemplate , unsigned iDecimation )
+        {
+            ASSERT( index <= GetDepth() ) ;
+            if( index == GetDepth() )
+            {   // Layer does not exist yet.
+                AddLayer( layerTemplate , iDecimation ) ;
+            }
+            else
+            {   // Layer exists, so reuse it.
+                mLayers[ index ].Decimate( layerTemplate , iDecimation ) ;
+                mLayers[ index ].Init() ;
+            }
+        }
+
+
         /** Return number of layers in tree.
         */
         size_t GetDepth( ) const { return mLayers.Size() ; }
 
 
+        /** Return number of bytes the layers of this tree occupy, including memory retained for reuse.
+
+            \see MemoryBudget
+        */
+        size_t GetMemoryUsage() const
+        {
+            size_t numBytes = mLayers.Capacity() * sizeof( Layer ) ;
+            for( size_t index = 0 ; index < GetDepth() ; ++ index )
+            {   // For each layer...
+                numBytes += mLayers[ index ].GetMemoryUsage() ;
+            }
+            if( mDecimations )
+            {
+                numBytes += GetDepth() * sizeof( mDecimations[ 0 ] ) ;
+            }
+            return numBytes ;
+        }
+
+
+        /** Release memory the layers of this tree retain for reuse.
+
+            \see UniformGrid::TrimMemory
+        */
+        void TrimMemory()
+        {
+            for( size_t index = 0 ; index < GetDepth() ; ++ index )
+            {   // For each layer...
+                mLayers[ index ].TrimMemory() ;
+            }
+        }
+
+
         /** Get layer, a uniform grid, at specified depth of this tree.
 
             \param index - depth of layer to obtain, where 0 means leaf layer and GetDepth()-1 means root layer.
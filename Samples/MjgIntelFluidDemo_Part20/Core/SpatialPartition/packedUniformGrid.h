@@ -0,0 +1,352 @@
+/** \file packedUniformGrid.h
+
+    \brief Uniform grid container that stores each gridpoint in fewer bits than a float, and decodes to float on load
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef PACKED_UNIFORM_GRID_H
+#define PACKED_UNIFORM_GRID_H
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+#include "Core/Containers/vector.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Encoding that stores a float as an IEEE 754 half-precision (binary16) float.
+
+    Half-precision has an 11-bit significand, so it keeps about 3 decimal
+    digits, relative to the magnitude of each value, which suits quantities
+    like signed distance and density whose precision matters most near zero.
+    GPUs read this format natively, so packed contents can go directly into
+    half-float textures.
+*/
+struct UniformGridCodecFloat16
+{
+    typedef unsigned short StorageT ;   ///< Type that holds one encoded float.
+
+    static const bool       USES_RANGE  = false ;   ///< Whether encoding depends on the range of values in the grid.
+    static const unsigned   MAX_CODE    = 0     ;   ///< Unused, since encoding does not depend on range.
+
+
+    /** Return half-precision float nearest the given single-precision float.
+
+        Rounds to nearest, ties to even, like hardware conversion.  Finite
+        values beyond the half-precision range saturate to the largest finite
+        half, so a packed grid never acquires infinities that its source lacked.
+    */
+    static StorageT Encode( float value , float /* rangeMin */ , float /* codesPerUnit */ )
+    {
+        union { float f ; unsigned u ; } bits ;
+        bits.f = value ;
+        const unsigned sign      = ( bits.u >> 16 ) & 0x8000 ;
+        const unsigned magnitude = bits.u & 0x7fffffff ;
+
+        if( magnitude >= 0x7f800000 )
+        {   // Infinity or NaN.
+            return StorageT( sign | ( ( magnitude > 0x7f800000 ) ? 0x7e00 : 0x7c00 ) ) ;
+        }
+        if( magnitude < 0x38800000 )
+        {   // Value is smaller than smallest normal half.
+            if( magnitude < 0x33000000 )
+            {   // Value rounds to zero.
+                return StorageT( sign ) ;
+            }
+            // Encode as subnormal half, i.e. significand in units of 2^-24.
+            const unsigned significand = ( magnitude & 0x007fffff ) | 0x00800000 ;
+            const unsigned shift       = 126 - ( magnitude >> 23 ) ;
+            const unsigned remainder   = significand & ( ( 1u << shift ) - 1 ) ;
+            const unsigned halfway     = 1u << ( shift - 1 ) ;
+            unsigned       half        = significand >> shift ;
+            if( ( remainder > halfway ) || ( ( remainder == halfway ) && ( half & 1 ) ) )
+            {   // Round up.
+                ++ half ;
+            }
+            return StorageT( sign | half ) ;
+        }
+        // Rebias exponent from 127 to 15 and drop 13 low bits of significand.
+        unsigned        half        = ( magnitude - 0x38000000 ) >> 13 ;
+        const unsigned  remainder   = magnitude & 0x1fff ;
+        if( ( remainder > 0x1000 ) || ( ( remainder == 0x1000 ) && ( half & 1 ) ) )
+        {   // Round up.  Carry into exponent is correct.
+            ++ half ;
+        }
+        return StorageT( sign | Min2( half , 0x7bffu ) ) ;
+    }
+
+
+    /** Return single-precision float equal to the given half-precision float.
+    */
+    static float Decode( StorageT code , float /* rangeMin */ , float /* unitsPerCode */ )
+    {
+        const unsigned sign         = unsigned( code & 0x8000 ) << 16 ;
+        const unsigned exponent     = ( code >> 10 ) & 0x1f ;
+        const unsigned significand  = code & 0x3ff ;
+        union { float f ; unsigned u ; } bits ;
+        if( 0x1f == exponent )
+        {   // Infinity or NaN.
+            bits.u = sign | 0x7f800000 | ( significand << 13 ) ;
+        }
+        else if( 0 == exponent )
+        {   // Zero or subnormal.
+            const float subnormal = float( significand ) * ( 1.0f / 16777216.0f ) ;
+            return sign ? - subnormal : subnormal ;
+        }
+        else
+        {   // Normal.  Rebias exponent from 15 to 127.
+            bits.u = sign | ( ( exponent + 112 ) << 23 ) | ( significand << 13 ) ;
+        }
+        return bits.f ;
+    }
+} ;
+
+
+
+
+/** Encoding that stores a float as an 8-bit fraction of the range of values in the grid.
+
+    This halves storage again relative to UniformGridCodecFloat16, but its
+    error is uniform across the range instead of relative to each value, so
+    it suits bounded quantities, like fuel, flame and smoke fractions, better
+    than quantities with a wide dynamic range.
+*/
+struct UniformGridCodecUnorm8
+{
+    typedef unsigned char StorageT ;    ///< Type that holds one encoded float.
+
+    static const bool       USES_RANGE  = true  ;   ///< Whether encoding depends on the range of values in the grid.
+    static const unsigned   MAX_CODE    = 255   ;   ///< Code that represents the largest value in the grid.
+
+
+    /** Return code nearest the given value, where 0 represents rangeMin and MAX_CODE represents the largest value in the grid.
+    */
+    static StorageT Encode( float value , float rangeMin , float codesPerUnit )
+    {
+        const float code = ( value - rangeMin ) * codesPerUnit + 0.5f ;
+        return StorageT( Clamp( code , 0.0f , float( MAX_CODE ) ) ) ;
+    }
+
+
+    /** Return value the given code represents.
+    */
+    static float Decode( StorageT code , float rangeMin , float unitsPerCode )
+    {
+        return rangeMin + float( code ) * unitsPerCode ;
+    }
+} ;
+
+
+
+
+/** Uniform grid container that stores each gridpoint in fewer bits than a float, and decodes to float on load.
+
+    Large grids that rendering reads -- signed distance, density, fuel,
+    flame and smoke fractions, velocity -- cost memory bandwidth each time
+    something copies or samples them.  Rendering tolerates less precision
+    than simulation does, so this container stores each float component of
+    each gridpoint using CodecT (e.g. UniformGridCodecFloat16 or
+    UniformGridCodecUnorm8), and decodes to float whenever it returns an item,
+    so arithmetic on items still happens in float.
+
+    Simulation should keep accumulating into a UniformGrid, since scattering
+    into reduced-precision storage would lose small contributions.  This
+    container is for the copy that crosses to rendering: CopyFromDense packs
+    a UniformGrid, then readers either Interpolate this directly, CopyToDense
+    for routines that require a UniformGrid, or upload GetCodes to a texture.
+
+    This container has the same geometry as UniformGrid (it derives from
+    UniformGridGeometry) and the same Get and Interpolate interface, except
+    that Get returns items by value.
+
+    \param ItemT    Type of item each gridpoint holds.  Must consist only of
+                    floats, e.g. float or Vec3.
+
+    \param CodecT   Encoding of each float.  Must provide StorageT,
+                    USES_RANGE, MAX_CODE, Encode and Decode like UniformGridCodecFloat16.
+*/
+template < class ItemT , class CodecT > class PackedUniformGrid : public UniformGridGeometry
+{
+    public:
+        typedef UniformGridGeometry         Parent      ;   ///< Nickname for UniformGridGeometry.
+        typedef typename CodecT::StorageT   StorageT    ;   ///< Type that holds one encoded float.
+
+        static const unsigned NUM_COMPONENTS = sizeof( ItemT ) / sizeof( float ) ;  ///< Number of floats in each item.
+
+        /** Construct an empty PackedUniformGrid.
+            \see CopyFromDense
+        */
+        PackedUniformGrid()
+            : UniformGridGeometry()
+            , mRangeMin( 0.0f )
+            , mUnitsPerCode( 0.0f )
+            , mCodesPerUnit( 0.0f )
+        {
+            ASSERT( sizeof( ItemT ) == NUM_COMPONENTS * sizeof( float ) ) ;
+        }
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+
+        void Clear()
+        {
+            mContents.Clear() ;
+            Parent::Clear() ;
+        }
+
+
+        /// Return whether this container contains any items.
+        bool Empty() const { return mContents.Empty() ; }
+
+        /// Return number of bytes used to store contents.
+        size_t GetMemoryUsed() const { return mContents.Capacity() * sizeof( StorageT ) ; }
+
+        /** Return encoded contents, NUM_COMPONENTS codes per gridpoint, gridpoints x fastest, e.g. to upload to a texture.
+
+            When CodecT::USES_RANGE, code c represents GetRangeMin() + c * GetUnitsPerCode().
+        */
+        const StorageT * GetCodes() const { return mContents.Empty() ? 0 : & mContents[ 0 ] ; }
+
+        /// Return value that code 0 represents, for encodings that use a range.
+        const float & GetRangeMin() const { return mRangeMin ; }
+
+        /// Return difference between values that consecutive codes represent, for encodings that use a range.
+        const float & GetUnitsPerCode() const { return mUnitsPerCode ; }
+
+
+        /// Return item at given offset, decoded to float.
+        ItemT Get( size_t offset ) const
+        {
+            ItemT           item ;
+            float *         components  = reinterpret_cast< float * >( & item ) ;
+            const StorageT * codes      = & mContents[ offset * NUM_COMPONENTS ] ;
+            for( unsigned iComp = 0 ; iComp < NUM_COMPONENTS ; ++ iComp )
+            {   // For each float in item...
+                components[ iComp ] = CodecT::Decode( codes[ iComp ] , mRangeMin , mUnitsPerCode ) ;
+            }
+            return item ;
+        }
+
+        /// Return item at given indices, decoded to float.
+        ItemT Get( size_t ix , size_t iy , size_t iz ) const { return Get( OffsetFromIndices( ix , iy , iz ) ) ; }
+
+        /// Return item at given indices, decoded to float.
+        ItemT Get( const unsigned indices[3] ) const { return Get( indices[ 0 ] , indices[ 1 ] , indices[ 2 ] ) ; }
+
+
+        /** Interpolate values from grid to get value at given position.
+
+            \param vResult      Interpolated value corresponding to value of grid contents at vPosition.
+
+            \param vPosition    Position to sample.
+
+            \see UniformGrid::Interpolate
+        */
+        void Interpolate( ItemT & vResult , const Vec3 & vPosition ) const
+        {
+            unsigned        indices[4] ; // Indices of grid cell containing position.
+            DEBUG_ONLY( UniformGridGeometry::sInterpolating = true ) ;
+            IndicesOfPosition( indices , vPosition ) ;
+            DEBUG_ONLY( UniformGridGeometry::sInterpolating = false ) ;
+            ASSERT( indices[0] < GetNumCells( 0 ) ) ;
+            ASSERT( indices[1] < GetNumCells( 1 ) ) ;
+            ASSERT( indices[2] < GetNumCells( 2 ) ) ;
+            Vec3            vMinCorner ;
+            PositionFromIndices( vMinCorner , indices ) ;
+            const Vec3      vDiff         = vPosition - vMinCorner ; // Relative location of position within its containing grid cell.
+            const Vec3      tween         = Vec3( vDiff.x * GetCellsPerExtent().x , vDiff.y * GetCellsPerExtent().y , vDiff.z * GetCellsPerExtent().z ) ;
+            const Vec3      oneMinusTween = Vec3( 1.0f , 1.0f , 1.0f ) - tween ;
+            const size_t    offsetX0Y0Z0  = OffsetFromIndices( indices[0] , indices[1] , indices[2] ) ;
+            const size_t    offsetX0Y1Z0  = offsetX0Y0Z0 + GetNumPoints( 0 ) ;
+            const size_t    offsetX0Y0Z1  = offsetX0Y0Z0 + GetNumPoints( 0 ) * GetNumPoints( 1 ) ;
+            const size_t    offsetX0Y1Z1  = offsetX0Y1Z0 + GetNumPoints( 0 ) * GetNumPoints( 1 ) ;
+            vResult =     ( ( oneMinusTween.x * Get( offsetX0Y0Z0 )
+                            +         tween.x * Get( offsetX0Y0Z0 + 1 ) ) * oneMinusTween.y
+                          + ( oneMinusTween.x * Get( offsetX0Y1Z0 )
+                            +         tween.x * Get( offsetX0Y1Z0 + 1 ) ) * tween.y        ) * oneMinusTween.z
+                        + ( ( oneMinusTween.x * Get( offsetX0Y0Z1 )
+                            +         tween.x * Get( offsetX0Y0Z1 + 1 ) ) * oneMinusTween.y
+                          + ( oneMinusTween.x * Get( offsetX0Y1Z1 )
+                            +         tween.x * Get( offsetX0Y1Z1 + 1 ) ) * tween.y        ) * tween.z ;
+        }
+
+
+        /** Copy shape and contents of given dense grid, encoding each float.
+
+            Assigning into a grid that already holds a previous copy reuses its
+            storage, so repeatedly packing a grid of steady size does not allocate.
+        */
+        void CopyFromDense( const UniformGrid< ItemT > & dense )
+        {
+            PERF_BLOCK( PackedUniformGrid__CopyFromDense ) ;
+
+            CopyShape( dense ) ;
+            const size_t    numFloats   = dense.Size() * NUM_COMPONENTS ;
+            const float *   src         = reinterpret_cast< const float * >( dense.Data() ) ;
+            mContents.Resize( numFloats ) ;
+            if( 0 == numFloats )
+            {   // Dense grid has no contents.
+                return ;
+            }
+
+            mRangeMin       = 0.0f ;
+            mUnitsPerCode   = 0.0f ;
+            mCodesPerUnit   = 0.0f ;
+            if( CodecT::USES_RANGE )
+            {   // Encoding spans range of values, so find that range.
+                float rangeMax = src[ 0 ] ;
+                mRangeMin = src[ 0 ] ;
+                for( size_t iFloat = 1 ; iFloat < numFloats ; ++ iFloat )
+                {   // For each float in dense grid...
+                    mRangeMin = Min2( mRangeMin , src[ iFloat ] ) ;
+                    rangeMax  = Max2( rangeMax  , src[ iFloat ] ) ;
+                }
+                if( rangeMax > mRangeMin )
+                {   // Values vary.  Otherwise every code represents mRangeMin.
+                    mUnitsPerCode = ( rangeMax - mRangeMin ) / float( CodecT::MAX_CODE ) ;
+                    mCodesPerUnit = float( CodecT::MAX_CODE ) / ( rangeMax - mRangeMin ) ;
+                }
+            }
+
+            StorageT * dst = & mContents[ 0 ] ;
+            for( size_t iFloat = 0 ; iFloat < numFloats ; ++ iFloat )
+            {   // For each float in dense grid...
+                dst[ iFloat ] = CodecT::Encode( src[ iFloat ] , mRangeMin , mCodesPerUnit ) ;
+            }
+        }
+
+
+        /** Copy shape and contents of this grid into the given dense grid, decoding each float, for routines that require a UniformGrid.
+        */
+        void CopyToDense( UniformGrid< ItemT > & dense ) const
+        {
+            PERF_BLOCK( PackedUniformGrid__CopyToDense ) ;
+
+            dense.Clear() ;
+            if( Empty() )
+            {   // This grid has no contents, so neither should dense grid.
+                return ;
+            }
+            dense.CopyShape( * this ) ;
+            dense.Init() ;
+            const size_t    numFloats   = mContents.Size() ;
+            ASSERT( dense.Size() * NUM_COMPONENTS == numFloats ) ;
+            float *         dst         = reinterpret_cast< float * >( dense.Data() ) ;
+            for( size_t iFloat = 0 ; iFloat < numFloats ; ++ iFloat )
+            {   // For each float in this grid...
+                dst[ iFloat ] = CodecT::Decode( mContents[ iFloat ] , mRangeMin , mUnitsPerCode ) ;
+            }
+        }
+
+    private:
+        VECTOR< StorageT >  mContents       ;   ///< Encoded contents, NUM_COMPONENTS codes per gridpoint, gridpoints x fastest.
+        float               mRangeMin       ;   ///< Value that code 0 represents, for encodings that use a range.
+        float               mUnitsPerCode   ;   ///< Difference between values that consecutive codes represent, for encodings that use a range.
+        float               mCodesPerUnit   ;   ///< Reciprocal of mUnitsPerCode, or zero when all values are equal.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,290 @@
+/** \file patchedGrid.h
+
+    \brief Finer UniformGrid patches over selected cells of a coarse UniformGrid, for block-structured mesh refinement
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef PATCHED_GRID_H
+#define PATCHED_GRID_H
+
+#include <float.h>
+#include <math.h>
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+#include "Core/Containers/vector.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Finer UniformGrid patches over selected cells of a coarse UniformGrid, for block-structured mesh refinement.
+
+    A single uniform grid spends the same resolution everywhere, so resolving
+    a thin feature, such as the flow near a body, makes the whole grid finer,
+    and memory grows with the cube of resolution.  Instead, this keeps a set
+    of patches, each a UniformGrid that spans a box of whole cells of a
+    coarse grid, subdivided by an integer refinement factor.  Resolution goes
+    only where patches go.
+
+    Every gridpoint of a patch that lies on its boundary also lies on a face
+    of the coarse cells the patch spans, so FillBoundaryFromCoarse assigns
+    those from the coarse grid.  Patches that share a face thereby agree
+    along it, and so does the coarse grid, so interpolated values stay
+    continuous across patch boundaries.  The caller assigns interior
+    gridpoints, for example by evaluating the field exactly there.
+
+    Interpolate reads the finest patch that contains the query point, and
+    otherwise the coarse grid.  A lookup table over coarse cells makes
+    finding that patch cost the same regardless of the number of patches.
+
+    This does not own the coarse grid; callers pass it to the routines that
+    read it, so copying a PatchedGrid copies only the patches.
+*/
+template <class ItemT> class PatchedGrid
+{
+    public:
+        PatchedGrid()
+            : mNumPatches( 0 )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+
+        /** Remove all patches and adopt the shape of the given coarse grid.
+
+            This reuses memory from previous calls, including that of patches.
+        */
+        void Reset( const UniformGridGeometry & coarse )
+        {
+            mCoarseShape.CopyShape( coarse ) ;
+            mNumPatches = 0 ;
+            const size_t numCells = ( 0 == coarse.GetGridCapacity() ) ? 0 : size_t( coarse.GetNumCells( 0 ) ) * coarse.GetNumCells( 1 ) * coarse.GetNumCells( 2 ) ;
+            mPatchOfCell.Clear() ;
+            mPatchOfCell.Resize( numCells , 0 ) ;
+        }
+
+
+        /// Remove all patches and release memory.
+        void Clear()
+        {
+            mPatches.Clear() ;
+            mRefinements.Clear() ;
+            mPatchOfCell.Clear() ;
+            mNumPatches = 0 ;
+        }
+
+
+        /** Add a patch that spans the given box of coarse cells, with the given number of patch cells per coarse cell along each axis.
+
+            \param cellBegin - Indices of the first coarse cell the patch spans, along each axis.
+
+            \param cellEnd - One past indices of the last coarse cell the patch spans, along each axis.
+                This gets clipped to the coarse grid.
+
+            \param refinement - Number of patch cells along each edge of each coarse cell.  Must be at least 2.
+
+            \return Index of the new patch, or GetNumPatches() if the box spans no cells.
+                The new patch has geometry but no values.  Call Init, then
+                FillBoundaryFromCoarse, then assign interior values.
+
+            Where patches overlap, the one with the greater refinement takes
+            precedence; among those with equal refinement, the one added last.
+        */
+        size_t AddPatch( const unsigned cellBegin[ 3 ] , const unsigned cellEnd[ 3 ] , unsigned refinement )
+        {
+            ASSERT( refinement >= 2 ) ;
+            ASSERT( ! mPatchOfCell.Empty() ) ;   // Call Reset first.
+
+            unsigned    begin[ 3 ] , end[ 3 ] , numPoints[ 3 ] ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis, clip cell range to coarse grid.
+                begin[ axis ] = cellBegin[ axis ] ;
+                end  [ axis ] = Min2( cellEnd[ axis ] , mCoarseShape.GetNumCells( axis ) ) ;
+                if( begin[ axis ] >= end[ axis ] )
+                {   // Box spans no cells.
+                    return mNumPatches ;
+                }
+                numPoints[ axis ] = ( end[ axis ] - begin[ axis ] ) * refinement + 1 ;
+            }
+
+            if( mNumPatches == mPatches.Size() )
+            {   // Need a new patch.  Otherwise reuse one from a previous Reset.
+                mPatches.PushBack( UniformGrid< ItemT >() ) ;
+                mRefinements.PushBack( 0 ) ;
+            }
+            const size_t            iPatch      = mNumPatches ++ ;
+            UniformGrid< ItemT > &  patch       = mPatches[ iPatch ] ;
+            const Vec3 &            spacing     = mCoarseShape.GetCellSpacing() ;
+            Vec3                    minCorner ;
+            mCoarseShape.PositionFromIndices( minCorner , begin ) ;
+            const Vec3              extent( float( end[ 0 ] - begin[ 0 ] ) * spacing.x
+                                          , float( end[ 1 ] - begin[ 1 ] ) * spacing.y
+                                          , float( end[ 2 ] - begin[ 2 ] ) * spacing.z ) ;
+            patch.DefineShapeFromPoints( minCorner , extent , numPoints ) ;
+            mRefinements[ iPatch ] = refinement ;
+
+            const unsigned numX     = mCoarseShape.GetNumCells( 0 ) ;
+            const unsigned numXY    = numX * mCoarseShape.GetNumCells( 1 ) ;
+            for( unsigned iz = begin[ 2 ] ; iz < end[ 2 ] ; ++ iz )
+            for( unsigned iy = begin[ 1 ] ; iy < end[ 1 ] ; ++ iy )
+            for( unsigned ix = begin[ 0 ] ; ix < end[ 0 ] ; ++ ix )
+            {   // For each coarse cell the patch spans...
+                unsigned & patchOfCell = mPatchOfCell[ ix + iy * numX + iz * numXY ] ;
+                if( ( 0 == patchOfCell ) || ( mRefinements[ patchOfCell - 1 ] <= refinement ) )
+                {   // Cell has no patch yet, or this patch is at least as fine as the one it has.
+                    patchOfCell = unsigned( iPatch + 1 ) ;
+                }
+            }
+            return iPatch ;
+        }
+
+
+        /** Assign values at boundary gridpoints of the given patch by interpolating the given coarse grid.
+
+            \param iPatch - Index of patch, which must have values, i.e. Init must have run on it.
+
+            \param coarse - Grid this patches, with the shape given to Reset.
+        */
+        void FillBoundaryFromCoarse( size_t iPatch , const UniformGrid< ItemT > & coarse )
+        {
+            ASSERT( coarse.ShapeMatches( mCoarseShape ) ) ;
+            UniformGrid< ItemT > &  patch       = mPatches[ iPatch ] ;
+            ASSERT( patch.Size() == patch.GetGridCapacity() ) ;
+            const unsigned          dims[ 3 ]   = { patch.GetNumPoints( 0 ) , patch.GetNumPoints( 1 ) , patch.GetNumPoints( 2 ) } ;
+            unsigned                idx[ 3 ] ;
+            for( idx[2] = 0 ; idx[2] < dims[2] ; ++ idx[2] )
+            {
+                const bool onZFace = ( 0 == idx[2] ) || ( dims[2] - 1 == idx[2] ) ;
+                for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
+                {
+                    const bool onYZFace = onZFace || ( 0 == idx[1] ) || ( dims[1] - 1 == idx[1] ) ;
+                    // Interior rows only have boundary gridpoints at their ends.
+                    const unsigned ixStep = onYZFace ? 1 : dims[0] - 1 ;
+                    for( idx[0] = 0 ; idx[0] < dims[0] ; idx[0] += ixStep )
+                    {   // For each boundary gridpoint...
+                        Vec3 position ;
+                        patch.PositionFromIndices( position , idx ) ;
+                        coarse.Interpolate( patch[ patch.OffsetFromIndices( idx[0] , idx[1] , idx[2] ) ] , ClampInside( coarse , position ) ) ;
+                    }
+                }
+            }
+        }
+
+
+        /** Return whether the gridpoint with the given indices lies on the boundary of the given patch.
+
+            FillBoundaryFromCoarse assigns such gridpoints; callers assign the others.
+        */
+        bool IsBoundaryGridpoint( size_t iPatch , const unsigned indices[ 3 ] ) const
+        {
+            const UniformGrid< ItemT > & patch = mPatches[ iPatch ] ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {
+                if( ( 0 == indices[ axis ] ) || ( patch.GetNumPoints( axis ) - 1 == indices[ axis ] ) )
+                {
+                    return true ;
+                }
+            }
+            return false ;
+        }
+
+
+        /** Return the finest patch that contains the given position, or NULL if none does.
+        */
+        const UniformGrid< ItemT > * FindPatch( const Vec3 & position ) const
+        {
+            if( 0 == mNumPatches )
+            {   // No patches, so skip finding cell.
+                return NULLPTR ;
+            }
+            const Vec3      rel         = position - mCoarseShape.GetMinCorner() ;
+            const Vec3 &    perExtent   = mCoarseShape.GetCellsPerExtent() ;
+            const float     fIdx[ 3 ]   = { floorf( rel.x * perExtent.x ) , floorf( rel.y * perExtent.y ) , floorf( rel.z * perExtent.z ) } ;
+            unsigned        idx[ 3 ] ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis, find index of coarse cell containing position.
+                const unsigned numCells = mCoarseShape.GetNumCells( axis ) ;
+                if( ( fIdx[ axis ] < 0.0f ) || ( fIdx[ axis ] > float( numCells ) ) )
+                {   // Position lies outside coarse grid.
+                    return NULLPTR ;
+                }
+                // Positions on the maximal face belong to the last cell.
+                idx[ axis ] = Min2( unsigned( fIdx[ axis ] ) , numCells - 1 ) ;
+            }
+            const unsigned patchOfCell = mPatchOfCell[ idx[ 0 ] + mCoarseShape.GetNumCells( 0 ) * ( idx[ 1 ] + mCoarseShape.GetNumCells( 1 ) * idx[ 2 ] ) ] ;
+            return patchOfCell ? & mPatches[ patchOfCell - 1 ] : NULLPTR ;
+        }
+
+
+        /** Interpolate value at the given position from the finest patch that contains it, or otherwise from the given coarse grid.
+
+            \param result - Interpolated value.
+
+            \param position - Position to sample.  It must lie inside coarse.
+
+            \param coarse - Grid this patches, with the shape given to Reset.
+        */
+        void Interpolate( ItemT & result , const Vec3 & position , const UniformGrid< ItemT > & coarse ) const
+        {
+            const UniformGrid< ItemT > * patch = FindPatch( position ) ;
+            if( patch )
+            {   // Position lies in a patch.
+                // Coarse cell lookup and patch bounds round differently, so keep position strictly inside patch.
+                patch->Interpolate( result , ClampInside( * patch , position ) ) ;
+            }
+            else
+            {
+                coarse.Interpolate( result , position ) ;
+            }
+        }
+
+
+        /// Return number of patches.
+        size_t                          GetNumPatches() const               { return mNumPatches ; }
+
+        /// Return patch with given index.
+              UniformGrid< ItemT > &    GetPatch( size_t iPatch )           { ASSERT( iPatch < mNumPatches ) ; return mPatches[ iPatch ] ; }
+        const UniformGrid< ItemT > &    GetPatch( size_t iPatch ) const     { ASSERT( iPatch < mNumPatches ) ; return mPatches[ iPatch ] ; }
+
+        /// Return number of patch cells along each edge of a coarse cell, for patch with given index.
+        unsigned                        GetRefinement( size_t iPatch ) const { ASSERT( iPatch < mNumPatches ) ; return mRefinements[ iPatch ] ; }
+
+        /// Return whether this has no patches.
+        bool                            Empty() const                       { return 0 == mNumPatches ; }
+
+        /// Return number of bytes patches occupy, including those retained for reuse.  See MemoryBudget.
+        size_t                          GetMemoryUsage() const
+        {
+            size_t numBytes = mPatches.Capacity() * sizeof( UniformGrid< ItemT > ) + ( mRefinements.Capacity() + mPatchOfCell.Capacity() ) * sizeof( unsigned ) ;
+            for( size_t iPatch = 0 ; iPatch < mPatches.Size() ; ++ iPatch )
+            {   // For each patch, in use or not...
+                numBytes += mPatches[ iPatch ].GetMemoryUsage() ;
+            }
+            return numBytes ;
+        }
+
+    private:
+        /// Return given position, moved if necessary to lie strictly within the given grid, as UniformGrid::Interpolate requires.
+        static Vec3 ClampInside( const UniformGridGeometry & grid , const Vec3 & position )
+        {
+            static const float  nudge   = 1.0f - 4.0f * FLT_EPSILON ;
+            const Vec3          extent  = grid.GetExtent() * nudge ;
+            const Vec3          minPos  = grid.GetMinCorner() + ( grid.GetExtent() - extent ) * 0.5f ;
+            const Vec3          maxPos  = minPos + extent ;
+            return Vec3( Clamp( position.x , minPos.x , maxPos.x )
+                       , Clamp( position.y , minPos.y , maxPos.y )
+                       , Clamp( position.z , minPos.z , maxPos.z ) ) ;
+        }
+
+        UniformGridGeometry             mCoarseShape    ;   ///< Shape of grid this patches, as of the last Reset.
+        VECTOR< UniformGrid< ItemT > >  mPatches        ;   ///< Patches.  Only the first mNumPatches are in use; the rest retain memory for reuse.
+        VECTOR< unsigned >              mRefinements    ;   ///< Number of patch cells along each edge of a coarse cell, for each patch.
+        VECTOR< unsigned >              mPatchOfCell    ;   ///< For each coarse cell, one plus index of finest patch spanning it, or 0 if none does.
+        size_t                          mNumPatches     ;   ///< Number of patches in use.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
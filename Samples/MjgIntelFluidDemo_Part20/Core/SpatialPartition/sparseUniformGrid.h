@@ -0,0 +1,316 @@
+/** \file sparseUniformGrid.h
+
+    \brief Uniform grid container that stores only bricks of gridpoints that contain data
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef SPARSE_UNIFORM_GRID_H
+#define SPARSE_UNIFORM_GRID_H
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+#include "Core/Containers/vector.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Uniform grid container that stores only bricks of gridpoints that contain data.
+
+    UniformGrid stores every gridpoint in its domain.  When the domain is
+    large and mostly empty -- for example when a single stray particle
+    stretches the bounding box -- most of that storage holds the initial
+    value, and sweeps over the grid spend most of their time there.
+
+    This container has the same geometry (it derives from
+    UniformGridGeometry, so IndicesOfPosition, OffsetFromIndices and so on
+    behave the same) and the same Interpolate and Accumulate interface as
+    UniformGrid, but stores gridpoints in bricks of BRICK_SIZE^3 points.
+    A two-level index maps each gridpoint to its brick:  A dense table,
+    with one entry per brick in the domain, holds the index of that brick in
+    a pool, or INVALID_BRICK if the brick holds only the background value.
+    The table is BRICK_CAPACITY times smaller than a dense grid.
+
+    Bricks come from a pool that Init empties but does not free, so a grid
+    reused across frames stops allocating once its pool reaches the size it
+    needs.
+
+    Reading a gridpoint in an unallocated brick yields the background value.
+    Writing one allocates its brick, so writes (GetOrAllocate, Accumulate,
+    CopyFromDense) are not thread-safe.  Reads are.
+*/
+template <class ItemT> class SparseUniformGrid : public UniformGridGeometry
+{
+    public:
+        typedef UniformGridGeometry Parent ;    ///< Nickname for UniformGridGeometry.
+
+        static const unsigned BRICK_SHIFT       = 3                                     ;   ///< Base-2 logarithm of number of gridpoints per brick, along each axis.
+        static const unsigned BRICK_SIZE        = 1 << BRICK_SHIFT                      ;   ///< Number of gridpoints per brick, along each axis.
+        static const unsigned BRICK_MASK        = BRICK_SIZE - 1                        ;   ///< Mask to extract index of gridpoint within its brick.
+        static const unsigned BRICK_CAPACITY    = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE  ;   ///< Number of gridpoints per brick.
+        static const unsigned INVALID_BRICK     = ~0U                                   ;   ///< Brick table entry for a brick that holds only the background value.
+
+        /** Construct an empty SparseUniformGrid.
+            \see Init
+        */
+        SparseUniformGrid()
+            : UniformGridGeometry()
+            , mBackground()
+        {
+            mNumBricks[ 0 ] = mNumBricks[ 1 ] = mNumBricks[ 2 ] = 0 ;
+        }
+
+
+        /** Copy shape from given uniform grid.
+            \see Init
+        */
+        explicit SparseUniformGrid( const UniformGridGeometry & that )
+            : UniformGridGeometry( that )
+            , mBackground()
+        {
+            mNumBricks[ 0 ] = mNumBricks[ 1 ] = mNumBricks[ 2 ] = 0 ;
+        }
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+
+        /** Discard all bricks and make every gridpoint hold the given background value.
+
+            Call this after changing the shape of this grid, e.g. with
+            CopyShape or DefineShape.
+        */
+        void Init( const ItemT & background = ItemT() )
+        {
+            PERF_BLOCK( SparseUniformGrid__Init ) ;
+
+            mBackground = background ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis, find number of bricks that span gridpoints.
+                mNumBricks[ axis ] = ( GetNumPoints( axis ) + BRICK_MASK ) >> BRICK_SHIFT ;
+            }
+            mBrickTable.Clear() ;
+            mBrickTable.Resize( size_t( mNumBricks[ 0 ] ) * size_t( mNumBricks[ 1 ] ) * size_t( mNumBricks[ 2 ] ) , unsigned( INVALID_BRICK ) ) ;
+            mPool.Clear() ;  // Retains capacity, so later allocations reuse memory.
+        }
+
+
+        void Clear()
+        {
+            mBrickTable.Clear() ;
+            mPool.Clear() ;
+            mNumBricks[ 0 ] = mNumBricks[ 1 ] = mNumBricks[ 2 ] = 0 ;
+            Parent::Clear() ;
+        }
+
+
+        /// Return value that gridpoints in unallocated bricks hold.
+        const ItemT & GetBackground() const { return mBackground ; }
+
+        /// Return number of bricks allocated.
+        size_t GetNumBricksAllocated() const { return mPool.Size() / BRICK_CAPACITY ; }
+
+        /// Return number of bytes used to store bricks and brick table.
+        size_t GetMemoryUsed() const { return mPool.Capacity() * sizeof( ItemT ) + mBrickTable.Capacity() * sizeof( unsigned ) ; }
+
+        /// Return whether the brick that contains the gridpoint at the given indices is allocated.
+        bool IsAllocated( size_t ix , size_t iy , size_t iz ) const { return mBrickTable[ BrickOffset( ix , iy , iz ) ] != INVALID_BRICK ; }
+
+
+        /// Return item at given indices, or the background value if its brick is not allocated.
+        const ItemT & Get( size_t ix , size_t iy , size_t iz ) const
+        {
+            const unsigned brick = mBrickTable[ BrickOffset( ix , iy , iz ) ] ;
+            if( INVALID_BRICK == brick )
+            {   // Brick holds only background value.
+                return mBackground ;
+            }
+            return mPool[ size_t( brick ) * BRICK_CAPACITY + OffsetInBrick( ix , iy , iz ) ] ;
+        }
+
+        /// Return item at given indices.
+        const ItemT & Get( const unsigned indices[3] ) const { return Get( indices[ 0 ] , indices[ 1 ] , indices[ 2 ] ) ; }
+
+        /// Return item at given position.
+        const ItemT & operator[]( const Vec3 & vPosition ) const
+        {
+            unsigned indices[4] ;
+            IndicesOfPosition( indices , vPosition ) ;
+            return Get( indices ) ;
+        }
+
+
+        /** Return item at given indices, allocating its brick if necessary.
+
+            A newly allocated brick holds the background value at every gridpoint.
+        */
+        ItemT & GetOrAllocate( size_t ix , size_t iy , size_t iz )
+        {
+            unsigned & brick = mBrickTable[ BrickOffset( ix , iy , iz ) ] ;
+            if( INVALID_BRICK == brick )
+            {   // Brick does not exist yet, so take one from pool.
+                brick = unsigned( GetNumBricksAllocated() ) ;
+                mPool.Resize( mPool.Size() + BRICK_CAPACITY , mBackground ) ;
+            }
+            return mPool[ size_t( brick ) * BRICK_CAPACITY + OffsetInBrick( ix , iy , iz ) ] ;
+        }
+
+        /// Return item at given indices, allocating its brick if necessary.
+        ItemT & GetOrAllocate( const unsigned indices[3] ) { return GetOrAllocate( indices[ 0 ] , indices[ 1 ] , indices[ 2 ] ) ; }
+
+
+        /** Interpolate values from grid to get value at given position.
+
+            \param vResult      Interpolated value corresponding to value of grid contents at vPosition.
+
+            \param vPosition    Position to sample.
+
+            \see UniformGrid::Interpolate
+        */
+        void Interpolate( ItemT & vResult , const Vec3 & vPosition ) const
+        {
+            unsigned        indices[4] ; // Indices of grid cell containing position.
+            DEBUG_ONLY( UniformGridGeometry::sInterpolating = true ) ;
+            IndicesOfPosition( indices , vPosition ) ;
+            DEBUG_ONLY( UniformGridGeometry::sInterpolating = false ) ;
+            InterpolateWithinCell( vResult , vPosition , indices ) ;
+        }
+
+
+        /** Interpolate values from grid to get value at given position.
+
+            Assumes floating point control word is set to use truncation instead of nearest, for rounding.
+
+            \see UniformGrid::Interpolate_AssumesFpcwSetToTruncate
+        */
+        void Interpolate_AssumesFpcwSetToTruncate( ItemT & vResult , const Vec3 & vPosition ) const
+        {
+            unsigned        indices[4] ; // Indices of grid cell containing position.
+            DEBUG_ONLY( UniformGridGeometry::sInterpolating = true ) ;
+            IndicesOfPosition_AssumesFpcwSetToTruncate( indices , vPosition ) ;
+            DEBUG_ONLY( UniformGridGeometry::sInterpolating = false ) ;
+            InterpolateWithinCell( vResult , vPosition , indices ) ;
+        }
+
+
+        /** Add a contribution to the 8 gridpoints that surround the given position, allocating bricks as needed.
+
+            \see UniformGrid::Accumulate
+        */
+        void Accumulate( const Vec3 & vPosition , const ItemT & item )
+        {
+            unsigned        indices[4] ; // Indices of grid cell containing position.
+            IndicesOfPosition( indices , vPosition ) ;
+            Vec3            vMinCorner ;
+            PositionFromIndices( vMinCorner , indices ) ;
+            const Vec3      vDiff         = vPosition - vMinCorner ; // Relative location of position within its containing grid cell.
+            const Vec3      tween         = Clamp0to1( Vec3( vDiff.x * GetCellsPerExtent().x , vDiff.y * GetCellsPerExtent().y , vDiff.z * GetCellsPerExtent().z ) ) ;
+            const Vec3      oneMinusTween = Vec3( 1.0f , 1.0f , 1.0f ) - tween ;
+            const unsigned  ix0 = indices[0] , ix1 = ix0 + 1 ;
+            const unsigned  iy0 = indices[1] , iy1 = iy0 + 1 ;
+            const unsigned  iz0 = indices[2] , iz1 = iz0 + 1 ;
+            GetOrAllocate( ix0 , iy0 , iz0 ) += oneMinusTween.x * oneMinusTween.y * oneMinusTween.z * item ;
+            GetOrAllocate( ix1 , iy0 , iz0 ) +=         tween.x * oneMinusTween.y * oneMinusTween.z * item ;
+            GetOrAllocate( ix0 , iy1 , iz0 ) += oneMinusTween.x *         tween.y * oneMinusTween.z * item ;
+            GetOrAllocate( ix1 , iy1 , iz0 ) +=         tween.x *         tween.y * oneMinusTween.z * item ;
+            GetOrAllocate( ix0 , iy0 , iz1 ) += oneMinusTween.x * oneMinusTween.y *         tween.z * item ;
+            GetOrAllocate( ix1 , iy0 , iz1 ) +=         tween.x * oneMinusTween.y *         tween.z * item ;
+            GetOrAllocate( ix0 , iy1 , iz1 ) += oneMinusTween.x *         tween.y *         tween.z * item ;
+            GetOrAllocate( ix1 , iy1 , iz1 ) +=         tween.x *         tween.y *         tween.z * item ;
+        }
+
+
+        /** Copy shape and contents of given dense grid, allocating only bricks that hold values other than the given background.
+        */
+        void CopyFromDense( const UniformGrid< ItemT > & dense , const ItemT & background = ItemT() )
+        {
+            PERF_BLOCK( SparseUniformGrid__CopyFromDense ) ;
+
+            CopyShape( dense ) ;
+            Init( background ) ;
+            const size_t numX = GetNumPoints( 0 ) ;
+            const size_t numY = GetNumPoints( 1 ) ;
+            const size_t numZ = GetNumPoints( 2 ) ;
+            for( size_t iz = 0 ; iz < numZ ; ++ iz )
+            for( size_t iy = 0 ; iy < numY ; ++ iy )
+            for( size_t ix = 0 ; ix < numX ; ++ ix )
+            {   // For each gridpoint in dense grid...
+                const ItemT & value = dense.Get( ix , iy , iz ) ;
+                if( ! ( value == mBackground ) )
+                {   // Gridpoint holds data, so store it.
+                    GetOrAllocate( ix , iy , iz ) = value ;
+                }
+            }
+        }
+
+
+        /** Copy shape and contents of this grid into the given dense grid, for routines that require a UniformGrid.
+        */
+        void CopyToDense( UniformGrid< ItemT > & dense ) const
+        {
+            PERF_BLOCK( SparseUniformGrid__CopyToDense ) ;
+
+            dense.Clear() ;
+            dense.CopyShape( * this ) ;
+            dense.Init( mBackground ) ;
+            const size_t numX = GetNumPoints( 0 ) ;
+            const size_t numY = GetNumPoints( 1 ) ;
+            const size_t numZ = GetNumPoints( 2 ) ;
+            for( size_t iz = 0 ; iz < numZ ; ++ iz )
+            for( size_t iy = 0 ; iy < numY ; ++ iy )
+            for( size_t ix = 0 ; ix < numX ; ++ ix )
+            {   // For each gridpoint...
+                if( IsAllocated( ix , iy , iz ) )
+                {   // Brick holds data.
+                    dense.Get( ix , iy , iz ) = Get( ix , iy , iz ) ;
+                }
+            }
+        }
+
+    private:
+        /// Return offset into brick table of brick that contains gridpoint at given indices.
+        size_t BrickOffset( size_t ix , size_t iy , size_t iz ) const
+        {
+            ASSERT( ( ix < GetNumPoints( 0 ) ) && ( iy < GetNumPoints( 1 ) ) && ( iz < GetNumPoints( 2 ) ) ) ;
+            return ( ix >> BRICK_SHIFT ) + mNumBricks[ 0 ] * ( ( iy >> BRICK_SHIFT ) + mNumBricks[ 1 ] * ( iz >> BRICK_SHIFT ) ) ;
+        }
+
+        /// Return offset, within its brick, of gridpoint at given indices.
+        static size_t OffsetInBrick( size_t ix , size_t iy , size_t iz )
+        {
+            return ( ix & BRICK_MASK ) + ( ( iy & BRICK_MASK ) << BRICK_SHIFT ) + ( ( iz & BRICK_MASK ) << ( 2 * BRICK_SHIFT ) ) ;
+        }
+
+        /// Interpolate values at the 8 corners of the cell with the given indices.
+        void InterpolateWithinCell( ItemT & vResult , const Vec3 & vPosition , const unsigned indices[4] ) const
+        {
+            ASSERT( indices[0] < GetNumCells( 0 ) ) ;
+            ASSERT( indices[1] < GetNumCells( 1 ) ) ;
+            ASSERT( indices[2] < GetNumCells( 2 ) ) ;
+            Vec3            vMinCorner ;
+            PositionFromIndices( vMinCorner , indices ) ;
+            const Vec3      vDiff         = vPosition - vMinCorner ; // Relative location of position within its containing grid cell.
+            const Vec3      tween         = Vec3( vDiff.x * GetCellsPerExtent().x , vDiff.y * GetCellsPerExtent().y , vDiff.z * GetCellsPerExtent().z ) ;
+            const Vec3      oneMinusTween = Vec3( 1.0f , 1.0f , 1.0f ) - tween ;
+            const unsigned  ix0 = indices[0] , ix1 = ix0 + 1 ;
+            const unsigned  iy0 = indices[1] , iy1 = iy0 + 1 ;
+            const unsigned  iz0 = indices[2] , iz1 = iz0 + 1 ;
+            vResult =     ( ( oneMinusTween.x * Get( ix0 , iy0 , iz0 )
+                            +         tween.x * Get( ix1 , iy0 , iz0 ) ) * oneMinusTween.y
+                          + ( oneMinusTween.x * Get( ix0 , iy1 , iz0 )
+                            +         tween.x * Get( ix1 , iy1 , iz0 ) ) * tween.y        ) * oneMinusTween.z
+                        + ( ( oneMinusTween.x * Get( ix0 , iy0 , iz1 )
+                            +         tween.x * Get( ix1 , iy0 , iz1 ) ) * oneMinusTween.y
+                          + ( oneMinusTween.x * Get( ix0 , iy1 , iz1 )
+                            +         tween.x * Get( ix1 , iy1 , iz1 ) ) * tween.y        ) * tween.z ;
+        }
+
+        ItemT               mBackground         ;   ///< Value of gridpoints in unallocated bricks.
+        unsigned            mNumBricks[ 3 ]     ;   ///< Number of bricks along each axis.
+        VECTOR< unsigned >  mBrickTable         ;   ///< Index into mPool, in units of bricks, of each brick in domain, or INVALID_BRICK.
+        VECTOR< ItemT >     mPool               ;   ///< Contents of allocated bricks, BRICK_CAPACITY items per brick, gridpoints x fastest.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
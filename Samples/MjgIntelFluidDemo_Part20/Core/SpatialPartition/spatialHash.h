@@ -0,0 +1,242 @@
+/** \file spatialHash.h
+
+    \brief Spatial partition of item indices over an unbounded domain, with cells of fixed size, addressed by hashing cell coordinates
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <math.h>
+
+#include "Core/SpatialPartition/cellList.h"
+
+#include "Core/Math/vec3.h"
+#include "Core/Containers/vector.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Spatial partition of item indices over an unbounded domain, with cells of fixed size, addressed by hashing cell coordinates.
+
+    CellList and UniformGrid span a box, usually the bounding box of all
+    items, with a given number of cells.  When a few items stray far from
+    the rest, that box grows, so cells grow too, and each cell holds more
+    items, which costs every neighbor search in the domain.
+
+    This instead divides all of space into cubes of a given size, and
+    stores only the cells that hold items.  Cell coordinates are the floor
+    of position divided by cell size, so they need no bounding box, and
+    outliers cost only the cells they occupy.
+
+    An open-addressing table (linear probing) maps cell coordinates to a
+    range within one contiguous array of item indices, sorted by cell, as
+    CellList stores them.  The table has at least twice as many slots as
+    there are items, so probes stay short.
+
+    Partition runs serially, in time linear in the number of items, and
+    reuses memory from previous calls.  Lookups are read-only so they are
+    thread-safe.
+*/
+class SpatialHash
+{
+    public:
+        typedef CellList::Cell Cell ;   ///< Read-only view of the indices of items inside one cell.
+
+        SpatialHash()
+            : mCellSize( 0.0f )
+            , mCellsPerLength( 0.0f )
+            , mTableMask( 0 )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        /// Discard all cells.
+        void Clear()
+        {
+            mTable.Clear() ;
+            mCellBegin.Clear() ;
+            mItemIndices.Clear() ;
+            mSlotOfItem.Clear() ;
+            mCellSize       = 0.0f ;
+            mCellsPerLength = 0.0f ;
+            mTableMask      = 0 ;
+        }
+
+
+        /** Assign each of the given items to the cell that contains it.
+
+            \param items - Dynamic array of items to partition.  ItemT must have a Vec3 member named mPosition.
+
+            \param cellSize - Length of each edge of each cubic cell.
+        */
+        template <class ItemT> void Partition( const VECTOR< ItemT > & items , float cellSize )
+        {
+            PERF_BLOCK( SpatialHash__Partition ) ;
+
+            ASSERT( cellSize > 0.0f ) ;
+
+            mCellSize       = cellSize ;
+            mCellsPerLength = 1.0f / cellSize ;
+
+            const size_t numItems = items.Size() ;
+
+            // Choose table capacity:  power of 2, at least twice number of items.
+            size_t tableCapacity = 16 ;
+            while( tableCapacity < 2 * numItems )
+            {
+                tableCapacity *= 2 ;
+            }
+            mTableMask = unsigned( tableCapacity - 1 ) ;
+            mTable.Resize( tableCapacity ) ;
+            for( size_t slot = 0 ; slot < tableCapacity ; ++ slot )
+            {   // For each slot, mark it empty.
+                mTable[ slot ].mNumItems = 0 ;
+            }
+
+            // Find or insert the cell of each item, and count items per cell.
+            mSlotOfItem.Resize( numItems ) ;
+            for( size_t iItem = 0 ; iItem < numItems ; ++ iItem )
+            {   // For each item...
+                int indices[ 3 ] ;
+                IndicesOfPosition( indices , items[ iItem ].mPosition ) ;
+                const unsigned slot = FindOrInsertSlot( indices ) ;
+                ++ mTable[ slot ].mNumItems ;
+                mSlotOfItem[ iItem ] = slot ;
+            }
+
+            // Convert counts to offsets, using an exclusive prefix sum over occupied slots.
+            mCellBegin.Resize( tableCapacity ) ;
+            unsigned numItemsBefore = 0 ;
+            for( size_t slot = 0 ; slot < tableCapacity ; ++ slot )
+            {   // For each slot...
+                mCellBegin[ slot ] = numItemsBefore ;
+                numItemsBefore += mTable[ slot ].mNumItems ;
+            }
+            ASSERT( numItemsBefore == numItems ) ;
+
+            // Scatter item indices into their cells.  mTable[].mNumItems counts them again.
+            mItemIndices.Resize( numItems ) ;
+            for( size_t slot = 0 ; slot < tableCapacity ; ++ slot )
+            {
+                mTable[ slot ].mNumItems = 0 ;
+            }
+            for( size_t iItem = 0 ; iItem < numItems ; ++ iItem )
+            {   // For each item, in order, so indices within each cell ascend.
+                const unsigned slot = mSlotOfItem[ iItem ] ;
+                mItemIndices[ mCellBegin[ slot ] + mTable[ slot ].mNumItems ] = unsigned( iItem ) ;
+                ++ mTable[ slot ].mNumItems ;
+            }
+        }
+
+
+        /** Compute coordinates of the cell containing the given position.
+
+            \note Coordinates are signed, and are the floor, not truncation, of
+                position divided by cell size, so cells on either side of
+                zero have the same size.
+        */
+        void IndicesOfPosition( int indices[ 3 ] , const Vec3 & vPosition ) const
+        {
+            indices[ 0 ] = int( floorf( vPosition.x * mCellsPerLength ) ) ;
+            indices[ 1 ] = int( floorf( vPosition.y * mCellsPerLength ) ) ;
+            indices[ 2 ] = int( floorf( vPosition.z * mCellsPerLength ) ) ;
+        }
+
+
+        /// Return view of the indices of items in the cell with the given coordinates, which is empty if no item occupies that cell.
+        Cell Get( int ix , int iy , int iz ) const
+        {
+            const int indices[ 3 ] = { ix , iy , iz } ;
+            return ( * this )[ indices ] ;
+        }
+
+        /// Return view of the indices of items in the cell with the given coordinates, which is empty if no item occupies that cell.
+        Cell operator[]( const int indices[ 3 ] ) const
+        {
+            if( mTable.Empty() )
+            {   // Partition has not run.
+                return Cell( 0 , 0 ) ;
+            }
+            unsigned slot = Hash( indices ) ;
+            while( mTable[ slot ].mNumItems != 0 )
+            {   // Slot is occupied.
+                const Entry & entry = mTable[ slot ] ;
+                if( ( entry.mIndices[ 0 ] == indices[ 0 ] ) && ( entry.mIndices[ 1 ] == indices[ 1 ] ) && ( entry.mIndices[ 2 ] == indices[ 2 ] ) )
+                {   // Found cell.
+                    return Cell( & mItemIndices[ mCellBegin[ slot ] ] , entry.mNumItems ) ;
+                }
+                slot = ( slot + 1 ) & mTableMask ;
+            }
+            // Reached an empty slot, so no item occupies this cell.
+            return Cell( 0 , 0 ) ;
+        }
+
+        /// Return view of the indices of items in the same cell as item iItem.
+        Cell GetCellOfItem( size_t iItem ) const
+        {
+            const unsigned slot = mSlotOfItem[ iItem ] ;
+            return Cell( & mItemIndices[ mCellBegin[ slot ] ] , mTable[ slot ].mNumItems ) ;
+        }
+
+        /// Return coordinates of the cell that item iItem occupies.
+        const int * GetIndicesOfItem( size_t iItem ) const { return mTable[ mSlotOfItem[ iItem ] ].mIndices ; }
+
+        /// Return whether this has no cells, i.e. has not been partitioned since construction or Clear.
+        bool            Empty() const       { return mTable.Empty() ; }
+
+        /// Return length of each edge of each cell.
+        const float &   GetCellSize() const { return mCellSize ; }
+
+        /// Return number of items partitioned.
+        size_t          GetNumItems() const { return mItemIndices.Size() ; }
+
+    private:
+        /// Slot of hash table, which holds one occupied cell or nothing.
+        struct Entry
+        {
+            int         mIndices[ 3 ]   ;   ///< Coordinates of cell occupying this slot.
+            unsigned    mNumItems       ;   ///< Number of items in cell, or zero if slot is empty.
+        } ;
+
+        /// Return slot where the cell with the given coordinates would reside, if no other cell collided with it.
+        unsigned Hash( const int indices[ 3 ] ) const
+        {   // Multiply each coordinate by a large prime and combine, as in Teschner et al. 2003, "Optimized Spatial Hashing for Collision Detection of Deformable Objects".
+            const unsigned hash = ( unsigned( indices[ 0 ] ) * 73856093u ) ^ ( unsigned( indices[ 1 ] ) * 19349663u ) ^ ( unsigned( indices[ 2 ] ) * 83492791u ) ;
+            return hash & mTableMask ;
+        }
+
+        /// Return slot holding the cell with the given coordinates, claiming an empty slot for it if no slot holds it yet.
+        unsigned FindOrInsertSlot( const int indices[ 3 ] )
+        {
+            unsigned slot = Hash( indices ) ;
+            while( mTable[ slot ].mNumItems != 0 )
+            {   // Slot is occupied.
+                const Entry & entry = mTable[ slot ] ;
+                if( ( entry.mIndices[ 0 ] == indices[ 0 ] ) && ( entry.mIndices[ 1 ] == indices[ 1 ] ) && ( entry.mIndices[ 2 ] == indices[ 2 ] ) )
+                {   // Found cell.
+                    return slot ;
+                }
+                slot = ( slot + 1 ) & mTableMask ;
+            }
+            // Claim empty slot.  Caller increments mNumItems, which marks it occupied.
+            mTable[ slot ].mIndices[ 0 ] = indices[ 0 ] ;
+            mTable[ slot ].mIndices[ 1 ] = indices[ 1 ] ;
+            mTable[ slot ].mIndices[ 2 ] = indices[ 2 ] ;
+            return slot ;
+        }
+
+        VECTOR< Entry >     mTable          ;   ///< Hash table of occupied cells, addressed by Hash of cell coordinates, with linear probing.
+        VECTOR< unsigned >  mCellBegin      ;   ///< Per slot of mTable, offset into mItemIndices of first item in that cell.
+        VECTOR< unsigned >  mItemIndices    ;   ///< Indices of items, sorted by slot of their cell.
+        VECTOR< unsigned >  mSlotOfItem     ;   ///< Per item, slot of mTable holding its cell.
+        float               mCellSize       ;   ///< Length of each edge of each cell.
+        float               mCellsPerLength ;   ///< Reciprocal of mCellSize.
+        unsigned            mTableMask      ;   ///< Number of slots in mTable, minus one.  Number of slots is a power of 2.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
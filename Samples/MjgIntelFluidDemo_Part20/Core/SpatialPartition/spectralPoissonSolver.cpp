@@ -0,0 +1,401 @@
+/** \file spectralPoissonSolver.cpp
+
+    \brief Direct solver for vector Poisson equations on uniform grids, using fast Fourier transforms
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+
+*/
+
+#include "spectralPoissonSolver.h"
+
+#include "Core/parallelExecution.h"
+#include "Core/Performance/perfBlock.h"
+#include "Core/Utility/macros.h"
+
+#include <algorithm>
+#include <math.h>
+
+// Private variables --------------------------------------------------------------
+
+static const double sPi = 3.1415926535897932384626433832795 ;
+
+/** Integral of 1/r over a cube of unit edge length centered on the origin.
+
+    The free-space Green's function is singular at zero offset, so its
+    value there is the average over a cell, which is this divided by 4 pi,
+    times edge length squared.
+*/
+static const double sUnitCubeInverseDistanceIntegral = 2.3800772 ;
+
+// Private functions --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+SpectralPoissonSolver::SpectralPoissonSolver()
+    : mBoundaryCondition( BC_NUM )
+    , mGridSpacing( 0.0f , 0.0f , 0.0f )
+{
+    mGridNumPoints[ 0 ] = mGridNumPoints[ 1 ] = mGridNumPoints[ 2 ] = 0 ;
+    mDims[ 0 ]          = mDims[ 1 ]          = mDims[ 2 ]          = 0 ;
+}
+
+
+
+
+/** Solve vector Poisson equation, lap = Laplacian of soln, with the given boundary condition.
+
+    \param soln     (in/out) Solution.  With BC_DIRICHLET, its boundary gridpoints must hold
+                    boundary values on entry, and this assigns only its interior gridpoints.
+                    Otherwise this assigns every gridpoint.
+
+    \param lap      Right-hand side, i.e. Laplacian of the solution.  Must have the same shape as soln.
+
+    \param boundaryCondition    BC_DIRICHLET, BC_PERIODIC or BC_FREE_SPACE.  See SpectralPoissonSolver.
+
+    This uses the same 7-point discrete Laplacian as SolveVectorPoisson, except
+    BC_FREE_SPACE, which convolves with the continuous Green's function.
+*/
+void SpectralPoissonSolver::Solve( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , BoundaryConditionE boundaryCondition )
+{
+    PERF_BLOCK( SpectralPoissonSolver__Solve ) ;
+
+    ASSERT( soln.ShapeMatches( lap ) ) ;
+    ASSERT( soln.Size() == soln.GetGridCapacity() ) ;
+    ASSERT( lap.Size()  == lap.GetGridCapacity()  ) ;
+    ASSERT( ( BC_DIRICHLET == boundaryCondition ) || ( BC_PERIODIC == boundaryCondition ) || ( BC_FREE_SPACE == boundaryCondition ) ) ;
+
+    PrepareForShape( lap , boundaryCondition ) ;
+
+    if( ( 0 == mDims[ 0 ] ) || ( 0 == mDims[ 1 ] ) || ( 0 == mDims[ 2 ] ) )
+    {   // No interior gridpoints to solve for.
+        return ;
+    }
+
+    const bool      dirichlet   = ( BC_DIRICHLET  == boundaryCondition ) ;
+    const bool      freeSpace   = ( BC_FREE_SPACE == boundaryCondition ) ;
+    const size_t    first       = dirichlet ? 1 : 0 ;   // Index of first gridpoint along each axis that working arrays hold.
+    const size_t    gridStrides[ 3 ] = { 1 , mGridNumPoints[ 0 ] , mGridNumPoints[ 0 ] * mGridNumPoints[ 1 ] } ;
+    // Extent of region of working arrays that gridpoints occupy.  Free-space padding beyond this is zero.
+    const size_t    occupied[ 3 ]    = { Min2( mDims[ 0 ] , mGridNumPoints[ 0 ] ) , Min2( mDims[ 1 ] , mGridNumPoints[ 1 ] ) , Min2( mDims[ 2 ] , mGridNumPoints[ 2 ] ) } ;
+    // Avoid divide-by-zero when z size is effectively 0 (for 2D domains), as StepTowardVectorPoissonSolution does.
+    const Vec3      reciprocalSpacing( 1.0f / mGridSpacing.x , 1.0f / mGridSpacing.y , mGridSpacing.z > FLT_EPSILON ? 1.0f / mGridSpacing.z : 0.0f ) ;
+    const Vec3      reciprocalSpacing2( POW2( reciprocalSpacing.x ) , POW2( reciprocalSpacing.y ) , POW2( reciprocalSpacing.z ) ) ;
+
+    {
+        PERF_BLOCK( SpectralPoissonSolver__Solve_Load ) ;
+        if( freeSpace )
+        {   // Padding must be zero, so cyclic convolution matches open convolution.
+            std::fill( mFieldXY.Begin() , mFieldXY.End() , Complex( 0.0f , 0.0f ) ) ;
+            std::fill( mFieldZ.Begin()  , mFieldZ.End()  , Complex( 0.0f , 0.0f ) ) ;
+        }
+        size_t idx[ 3 ] ;
+        for( idx[2] = 0 ; idx[2] < occupied[ 2 ] ; ++ idx[2] )
+        for( idx[1] = 0 ; idx[1] < occupied[ 1 ] ; ++ idx[1] )
+        for( idx[0] = 0 ; idx[0] < occupied[ 0 ] ; ++ idx[0] )
+        {   // For each gridpoint working arrays hold...
+            const size_t    gridOffset  = ( idx[0] + first ) + gridStrides[ 1 ] * ( idx[1] + first ) + gridStrides[ 2 ] * ( idx[2] + first ) ;
+            const size_t    workOffset  = idx[0] + mDims[ 0 ] * ( idx[1] + mDims[ 1 ] * idx[2] ) ;
+            Vec3            rhs         = lap[ gridOffset ] ;
+            if( dirichlet )
+            {   // Move known values of boundary neighbors to right-hand side, leaving a problem with zero boundary values.
+                const float * reciprocalSpacing2Components = reinterpret_cast< const float * >( & reciprocalSpacing2 ) ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis...
+                    if( 0 == idx[ axis ] )
+                    {
+                        rhs -= soln[ gridOffset - gridStrides[ axis ] ] * reciprocalSpacing2Components[ axis ] ;
+                    }
+                    if( mDims[ axis ] - 1 == idx[ axis ] )
+                    {
+                        rhs -= soln[ gridOffset + gridStrides[ axis ] ] * reciprocalSpacing2Components[ axis ] ;
+                    }
+                }
+            }
+            mFieldXY[ workOffset ] = Complex( rhs.x , rhs.y ) ;
+            mFieldZ[ workOffset ]  = Complex( rhs.z , 0.0f  ) ;
+        }
+    }
+
+    const LineTransformE forward = dirichlet ? LINE_TRANSFORM_SINE : LINE_TRANSFORM_FORWARD ;
+    const LineTransformE inverse = dirichlet ? LINE_TRANSFORM_SINE : LINE_TRANSFORM_INVERSE ;
+    TransformField( & mFieldXY[ 0 ] , occupied , forward , false ) ;
+    TransformField( & mFieldZ[ 0 ]  , occupied , forward , false ) ;
+
+    {
+        // Apply inverse of Laplacian, which the transforms diagonalized.
+        PERF_BLOCK( SpectralPoissonSolver__Solve_Divide ) ;
+        if( freeSpace )
+        {
+            for( size_t offset = 0 ; offset < mGreensSpectrum.Size() ; ++ offset )
+            {   // For each wavenumber...
+                mFieldXY[ offset ] *= mGreensSpectrum[ offset ] ;
+                mFieldZ[ offset ]  *= mGreensSpectrum[ offset ] ;
+            }
+        }
+        else
+        {
+            // Forward and inverse transforms together scale by this reciprocal.
+            const float normalization = dirichlet
+                ? float( 8.0 / ( double( mDims[ 0 ] + 1 ) * double( mDims[ 1 ] + 1 ) * double( mDims[ 2 ] + 1 ) ) )
+                : float( 1.0 / ( double( mDims[ 0 ] ) * double( mDims[ 1 ] ) * double( mDims[ 2 ] ) ) ) ;
+            size_t k[ 3 ] ;
+            size_t offset = 0 ;
+            for( k[2] = 0 ; k[2] < mDims[ 2 ] ; ++ k[2] )
+            for( k[1] = 0 ; k[1] < mDims[ 1 ] ; ++ k[1] )
+            for( k[0] = 0 ; k[0] < mDims[ 0 ] ; ++ k[0] , ++ offset )
+            {   // For each wavenumber...
+                const float eigenvalue  = mEigenvalues[ 0 ][ k[0] ] + mEigenvalues[ 1 ][ k[1] ] + mEigenvalues[ 2 ][ k[2] ] ;
+                // Periodic domain has zero eigenvalue for uniform mode, which the solution omits.
+                const float scale       = ( eigenvalue != 0.0f ) ? normalization / eigenvalue : 0.0f ;
+                mFieldXY[ offset ] *= scale ;
+                mFieldZ[ offset ]  *= scale ;
+            }
+        }
+    }
+
+    TransformField( & mFieldXY[ 0 ] , occupied , inverse , true ) ;
+    TransformField( & mFieldZ[ 0 ]  , occupied , inverse , true ) ;
+
+    {
+        PERF_BLOCK( SpectralPoissonSolver__Solve_Store ) ;
+        size_t idx[ 3 ] ;
+        for( idx[2] = 0 ; idx[2] < occupied[ 2 ] ; ++ idx[2] )
+        for( idx[1] = 0 ; idx[1] < occupied[ 1 ] ; ++ idx[1] )
+        for( idx[0] = 0 ; idx[0] < occupied[ 0 ] ; ++ idx[0] )
+        {   // For each gridpoint working arrays hold...
+            const size_t    gridOffset  = ( idx[0] + first ) + gridStrides[ 1 ] * ( idx[1] + first ) + gridStrides[ 2 ] * ( idx[2] + first ) ;
+            const size_t    workOffset  = idx[0] + mDims[ 0 ] * ( idx[1] + mDims[ 1 ] * idx[2] ) ;
+            soln[ gridOffset ] = Vec3( mFieldXY[ workOffset ].real() , mFieldXY[ workOffset ].imag() , mFieldZ[ workOffset ].real() ) ;
+        }
+    }
+}
+
+
+
+
+/** Allocate working arrays, and compute transform plans and eigenvalues, for the given grid and boundary condition, unless already done.
+*/
+void SpectralPoissonSolver::PrepareForShape( const UniformGridGeometry & grid , BoundaryConditionE boundaryCondition )
+{
+    if(     ( mBoundaryCondition == boundaryCondition )
+        &&  ( mGridNumPoints[ 0 ] == grid.GetNumPoints( 0 ) )
+        &&  ( mGridNumPoints[ 1 ] == grid.GetNumPoints( 1 ) )
+        &&  ( mGridNumPoints[ 2 ] == grid.GetNumPoints( 2 ) )
+        &&  ( mGridSpacing == grid.GetCellSpacing() ) )
+    {   // Already prepared for this shape.
+        return ;
+    }
+
+    PERF_BLOCK( SpectralPoissonSolver__PrepareForShape ) ;
+
+    mBoundaryCondition  = boundaryCondition ;
+    mGridSpacing        = grid.GetCellSpacing() ;
+    const float * spacing = reinterpret_cast< const float * >( & mGridSpacing ) ;
+
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        const size_t numPoints = grid.GetNumPoints( axis ) ;
+        mGridNumPoints[ axis ] = numPoints ;
+        switch( boundaryCondition )
+        {
+            case BC_DIRICHLET : mDims[ axis ] = ( numPoints > 2 ) ? numPoints - 2 : 0 ;                 break ;
+            case BC_PERIODIC  : mDims[ axis ] = numPoints ;                                             break ;
+            case BC_FREE_SPACE: mDims[ axis ] = FftPlan::NextPowerOfTwo( 2 * numPoints - 1 ) ;          break ;
+            default: FAIL() ; mDims[ axis ] = 0 ; break ;
+        }
+        if( 0 == mDims[ axis ] )
+        {
+            continue ;
+        }
+
+        // Sine transform of length n uses Fourier transform of odd extension, of length 2(n+1).
+        mPlans[ axis ].Init( ( BC_DIRICHLET == boundaryCondition ) ? 2 * ( mDims[ axis ] + 1 ) : mDims[ axis ] ) ;
+
+        // Eigenvalues of 1D discrete Laplacian, ( u[j-1] - 2 u[j] + u[j+1] ) / h^2, for each basis function.
+        const float reciprocalSpacing2 = ( spacing[ axis ] > FLT_EPSILON ) ? 1.0f / POW2( spacing[ axis ] ) : 0.0f ;
+        mEigenvalues[ axis ].Resize( mDims[ axis ] ) ;
+        for( size_t k = 0 ; k < mDims[ axis ] ; ++ k )
+        {   // For each wavenumber...
+            const double angle = ( BC_DIRICHLET == boundaryCondition )
+                ?       sPi * double( k + 1 ) / double( mDims[ axis ] + 1 )  // sin( pi (j+1) (k+1) / (n+1) )
+                : 2.0 * sPi * double( k )     / double( mDims[ axis ] ) ;    // exp( 2 pi i j k / n )
+            mEigenvalues[ axis ][ k ] = float( 2.0 * cos( angle ) - 2.0 ) * reciprocalSpacing2 ;
+        }
+    }
+
+    const size_t numElements = mDims[ 0 ] * mDims[ 1 ] * mDims[ 2 ] ;
+    mFieldXY.Resize( numElements ) ;
+    mFieldZ.Resize( numElements ) ;
+
+    mGreensSpectrum.Clear() ;
+    if( ( BC_FREE_SPACE == boundaryCondition ) && ( numElements > 0 ) )
+    {
+        ComputeGreensFunctionSpectrum() ;
+    }
+}
+
+
+
+
+/** Compute transform of free-space Green's function, sampled at offsets between gridpoints, wrapped cyclically into working array.
+
+    \note This uses mFieldZ as scratch space.
+*/
+void SpectralPoissonSolver::ComputeGreensFunctionSpectrum()
+{
+    PERF_BLOCK( SpectralPoissonSolver__ComputeGreensFunctionSpectrum ) ;
+
+    const float     cellVolume      = mGridSpacing.x * mGridSpacing.y * mGridSpacing.z ;
+    ASSERT( cellVolume > 0.0f ) ;   // Free-space boundary condition only applies to 3D domains.
+    const double    FourPi          = 4.0 * sPi ;
+    // Average of Green's function over the cell at zero offset, approximating the cell as a cube of the same volume.
+    const double    cellEdge        = pow( double( cellVolume ) , 1.0 / 3.0 ) ;
+    const float     greensAtOrigin  = float( - sUnitCubeInverseDistanceIntegral * cellEdge * cellEdge / FourPi ) ;
+
+    // Sample Green's function at every offset the working array can represent.  Only offsets
+    // less than mGridNumPoints along each axis contribute to gridpoints, and with padding, those
+    // map to distinct elements, so the rest could hold anything, but sampling them too keeps the
+    // array symmetric, so its transform is real.
+    size_t idx[ 3 ] ;
+    size_t offset = 0 ;
+    for( idx[2] = 0 ; idx[2] < mDims[ 2 ] ; ++ idx[2] )
+    for( idx[1] = 0 ; idx[1] < mDims[ 1 ] ; ++ idx[1] )
+    for( idx[0] = 0 ; idx[0] < mDims[ 0 ] ; ++ idx[0] , ++ offset )
+    {   // For each element...
+        Vec3 displacement ;
+        float * displacementComponents = reinterpret_cast< float * >( & displacement ) ;
+        const float * spacing = reinterpret_cast< const float * >( & mGridSpacing ) ;
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {   // For each axis, find offset, wrapped into [-dims/2,dims/2).
+            const double wrapped = ( idx[ axis ] < mDims[ axis ] / 2 ) ? double( idx[ axis ] ) : double( idx[ axis ] ) - double( mDims[ axis ] ) ;
+            displacementComponents[ axis ] = float( wrapped ) * spacing[ axis ] ;
+        }
+        const float distance = displacement.Magnitude() ;
+        const float greens   = ( 0 == offset ) ? greensAtOrigin : float( - double( cellVolume ) / ( FourPi * double( distance ) ) ) ;
+        mFieldZ[ offset ] = Complex( greens , 0.0f ) ;
+    }
+
+    const size_t all[ 3 ] = { mDims[ 0 ] , mDims[ 1 ] , mDims[ 2 ] } ;
+    TransformField( & mFieldZ[ 0 ] , all , LINE_TRANSFORM_FORWARD , false ) ;
+
+    // Fold inverse transform normalization into spectrum, so Solve only multiplies.
+    const float normalization = float( 1.0 / double( mFieldZ.Size() ) ) ;
+    mGreensSpectrum.Resize( mFieldZ.Size() ) ;
+    for( size_t offset = 0 ; offset < mFieldZ.Size() ; ++ offset )
+    {   // For each wavenumber...
+        mGreensSpectrum[ offset ] = mFieldZ[ offset ].real() * normalization ;
+    }
+}
+
+
+
+
+/** Transform a working array along each axis in turn.
+
+    \param field            Working array to transform in place.
+
+    \param occupiedCounts   Extent, along each axis, of region of field that can hold nonzero values, before a forward transform,
+                            or that the caller reads, after an inverse transform.  Lines lying wholly outside that region
+                            (in free-space padding) hold zeros, or do not matter, so this skips them.
+
+    \param lineTransform    Which transform to apply along every axis.
+
+    \param inverseOrder     Whether to transform axes in order z, y, x rather than x, y, z.
+                            Inverse transforms should use the reverse order of forward transforms, so both skip the same lines.
+*/
+void SpectralPoissonSolver::TransformField( Complex * field , const size_t occupiedCounts[ 3 ] , LineTransformE lineTransform , bool inverseOrder ) const
+{
+    for( unsigned iAxis = 0 ; iAxis < 3 ; ++ iAxis )
+    {   // For each axis...
+        const unsigned axis = inverseOrder ? 2 - iAxis : iAxis ;
+        // Axes already transformed (in forward order) have spread values throughout,
+        // whereas axes not yet transformed still only hold values in the occupied region.
+        size_t lineCounts[ 3 ] ;
+        for( unsigned other = 0 ; other < 3 ; ++ other )
+        {
+            lineCounts[ other ] = ( other < axis ) ? mDims[ other ] : occupiedCounts[ other ] ;
+        }
+        lineCounts[ axis ] = mDims[ axis ] ;
+        TransformLines( field , lineCounts , axis , lineTransform ) ;
+    }
+}
+
+
+
+
+/** Transform lines of a working array along the given axis, using multiple threads if possible.
+
+    \param lineCounts   Number of elements to visit along each axis.  Along axis, this must be mDims[axis].
+*/
+void SpectralPoissonSolver::TransformLines( Complex * field , const size_t lineCounts[ 3 ] , unsigned axis , LineTransformE lineTransform ) const
+{
+    const size_t numLines = lineCounts[ 0 ] * lineCounts[ 1 ] * lineCounts[ 2 ] / lineCounts[ axis ] ;
+    // Estimate grain size based on size of problem and number of processors.
+    const size_t grainSize =  Max2( size_t( 1 ) , numLines / gNumberOfProcessors ) ;
+    Parallel::For( 0 , numLines , grainSize , Parallel::Method( this , & SpectralPoissonSolver::TransformLinesSlice , field , lineCounts , axis , lineTransform ) ) ;
+}
+
+
+
+
+/** Transform a subset of lines of a working array along the given axis.
+
+    \param iLineBegin   Index of first line to transform, where lines are numbered with the lower remaining axis varying fastest.
+
+    \param iLineEnd     One past index of last line to transform.
+*/
+void SpectralPoissonSolver::TransformLinesSlice( Complex * field , const size_t lineCounts[ 3 ] , unsigned axis , LineTransformE lineTransform , size_t iLineBegin , size_t iLineEnd ) const
+{
+    ASSERT( lineCounts[ axis ] == mDims[ axis ] ) ;
+
+    const size_t    strides[ 3 ]    = { 1 , mDims[ 0 ] , mDims[ 0 ] * mDims[ 1 ] } ;
+    const unsigned  axisB           = ( 0 == axis ) ? 1 : 0 ;       // Lower of remaining axes.
+    const unsigned  axisC           = ( 2 == axis ) ? 1 : 2 ;       // Higher of remaining axes.
+    const size_t    length          = mDims[ axis ] ;
+    const size_t    stride          = strides[ axis ] ;
+    const FftPlan & plan            = mPlans[ axis ] ;
+
+    // Each thread has its own line and scratch space, so threads share only the plan, which is read-only.
+    VECTOR< Complex > line( plan.GetLength() ) ;
+    VECTOR< Complex > scratch( Max2( plan.GetScratchSize() , size_t( 1 ) ) ) ;
+
+    for( size_t iLine = iLineBegin ; iLine < iLineEnd ; ++ iLine )
+    {   // For each line in this slice...
+        const size_t    indexB  = iLine % lineCounts[ axisB ] ;
+        const size_t    indexC  = iLine / lineCounts[ axisB ] ;
+        Complex *       first   = field + indexB * strides[ axisB ] + indexC * strides[ axisC ] ;
+
+        if( LINE_TRANSFORM_SINE == lineTransform )
+        {   // Compute sine transform from Fourier transform of odd extension:
+            // y = { 0 , x[0] , ... , x[n-1] , 0 , -x[n-1] , ... , -x[0] } has transform -2 i S[k-1] at k in [1,n].
+            const size_t extendedLength = plan.GetLength() ;
+            line[ 0 ]           = Complex( 0.0f , 0.0f ) ;
+            line[ length + 1 ]  = Complex( 0.0f , 0.0f ) ;
+            for( size_t j = 0 ; j < length ; ++ j )
+            {
+                const Complex & value = first[ j * stride ] ;
+                line[ j + 1 ]                   =   value ;
+                line[ extendedLength - 1 - j ]  = - value ;
+            }
+            plan.Transform( & line[ 0 ] , false , & scratch[ 0 ] ) ;
+            static const Complex halfI( 0.0f , 0.5f ) ;
+            for( size_t k = 0 ; k < length ; ++ k )
+            {
+                first[ k * stride ] = line[ k + 1 ] * halfI ;
+            }
+        }
+        else
+        {
+            for( size_t j = 0 ; j < length ; ++ j )
+            {
+                line[ j ] = first[ j * stride ] ;
+            }
+            plan.Transform( & line[ 0 ] , LINE_TRANSFORM_INVERSE == lineTransform , & scratch[ 0 ] ) ;
+            for( size_t j = 0 ; j < length ; ++ j )
+            {
+                first[ j * stride ] = line[ j ] ;
+            }
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/** \file spectralPoissonSolver.h
+
+    \brief Direct solver for vector Poisson equations on uniform grids, using fast Fourier transforms
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+
+*/
+#ifndef SPECTRAL_POISSON_SOLVER_H
+#define SPECTRAL_POISSON_SOLVER_H
+
+#include "Core/SpatialPartition/uniformGridMath.h"
+#include "Core/Math/fft.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Direct solver for vector Poisson equations on uniform grids, using fast Fourier transforms.
+
+    Unlike SolveVectorPoisson and SolveVectorPoissonMultiGrid, which iterate
+    until the residual is small, this solves in a fixed number of passes,
+    each of which transforms every line of the grid along one axis, so it
+    costs O(N log N) for N gridpoints, and yields the exact solution of the
+    discretized problem, to within roundoff.  Passes run lines concurrently.
+
+    It packs the x and y components of the vector field into the real and
+    imaginary parts of one complex field, and the z component into another,
+    which works because each solution operator is real and linear.
+
+    Boundary conditions:
+
+    -   BC_DIRICHLET solves for interior gridpoints, given the solution on
+        boundary gridpoints, using discrete sine transforms, which
+        diagonalize the 7-point Laplacian with zero boundary values.
+        Boundary values move into the right-hand side.
+
+    -   BC_PERIODIC solves on a domain that repeats every GetNumPoints
+        gridpoints along each axis, using discrete Fourier transforms.
+        Periodic solutions are only defined to within a constant, so this
+        yields the one with zero mean, and ignores the mean of the
+        right-hand side.
+
+    -   BC_FREE_SPACE solves as though the domain were embedded in infinite
+        space where the right-hand side is zero, by convolving with the
+        free-space Green's function -1/(4 pi r).  It uses the method of
+        Hockney and Eastwood: Zero-padding each axis to at least twice its
+        length makes a cyclic convolution equal the open one.  This needs no
+        boundary values, but uses 8 times the memory of the grid.
+
+    The solver keeps its working arrays, transform plans and (for
+    BC_FREE_SPACE) the transform of the Green's function, so solving
+    repeatedly on grids of the same shape avoids reallocating and
+    recomputing them.
+*/
+class SpectralPoissonSolver
+{
+    public:
+        SpectralPoissonSolver() ;
+
+        void Solve( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , BoundaryConditionE boundaryCondition ) ;
+
+    private:
+        /// Kind of one-dimensional transform TransformLines applies.
+        enum LineTransformE
+        {
+            LINE_TRANSFORM_FORWARD  ,   ///< Discrete Fourier transform.
+            LINE_TRANSFORM_INVERSE  ,   ///< Inverse discrete Fourier transform, without the 1/n factor.
+            LINE_TRANSFORM_SINE     ,   ///< Discrete sine transform of type I, which is its own inverse, to within a factor of 2/(n+1).
+        } ;
+
+        void PrepareForShape( const UniformGridGeometry & grid , BoundaryConditionE boundaryCondition ) ;
+        void TransformLines( Complex * field , const size_t lineCounts[ 3 ] , unsigned axis , LineTransformE lineTransform ) const ;
+        void TransformLinesSlice( Complex * field , const size_t lineCounts[ 3 ] , unsigned axis , LineTransformE lineTransform , size_t iLineBegin , size_t iLineEnd ) const ;
+        void TransformField( Complex * field , const size_t occupiedCounts[ 3 ] , LineTransformE lineTransform , bool inverseOrder ) const ;
+        void ComputeGreensFunctionSpectrum() ;
+
+        BoundaryConditionE  mBoundaryCondition      ;   ///< Boundary condition for which working arrays and plans are prepared.
+        size_t              mGridNumPoints[ 3 ]     ;   ///< Number of gridpoints along each axis of grid for which working arrays and plans are prepared.
+        Vec3                mGridSpacing            ;   ///< Cell spacing of grid for which working arrays and plans are prepared.
+        size_t              mDims[ 3 ]              ;   ///< Number of elements along each axis of working arrays.
+        FftPlan             mPlans[ 3 ]             ;   ///< Transform plan for lines along each axis.  Sine transforms use a Fourier transform of length 2(n+1).
+        VECTOR< Complex >   mFieldXY                ;   ///< Working array holding x and y components as real and imaginary parts.
+        VECTOR< Complex >   mFieldZ                 ;   ///< Working array holding z component as real part.
+        VECTOR< float >     mEigenvalues[ 3 ]       ;   ///< Eigenvalues of one-dimensional discrete Laplacian along each axis, indexed by wavenumber.
+        VECTOR< float >     mGreensSpectrum         ;   ///< Transform of free-space Green's function, times cell volume, divided by working array size.  Real, since the Green's function is even.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -9,6 +9,7 @@
 #define UNIFORM_GRID_H
 
 #include <Core/useTbb.h>
+#include <Core/parallelExecution.h>
 
 #include <Core/Performance/perfBlock.h>
 
@@ -17,10 +18,7 @@
 #include <Core/Utility/macros.h>
 #include <Core/File/debugPrint.h>
 #include <Core/Containers/vector.h>
-
-#if USE_TBB
-#   include <tbb/atomic.h>
-#endif
+#include <Core/Memory/firstTouchAllocator.h>
 
 #include <algorithm>
 
@@ -30,6 +28,72 @@
 
 #define UNIFORM_GRID_INVALID_VALUE std::numeric_limits< float >::quiet_NaN()
 
+/// Whether UniformGrid::InterpolateMany uses SSE2 intrinsics to compute indices and weights.  Otherwise it uses a portable lane loop.
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __SSE2__ )
+    #define UNIFORM_GRID_USE_SSE2 1
+#else
+    #define UNIFORM_GRID_USE_SSE2 0
+#endif
+
+#if UNIFORM_GRID_USE_SSE2
+    #include <emmintrin.h>  // SSE2 intrinsics
+#endif
+
+/** Whether IndicesOfPosition_AssumesFpcwSetToTruncate requires the caller to set the x87 floating-point control word to truncate.
+
+    When UNIFORM_GRID_USE_SSE2 is enabled, index computation uses cvttps2dq,
+    which always truncates, regardless of the x87 control word and MXCSR
+    rounding mode.  Then callers can skip Changex87FloatingPointToTruncate,
+    which does nothing for SSE code on x64 and which would have to be
+    repeated on each worker thread.
+*/
+#define UNIFORM_GRID_TRUNCATE_NEEDS_FPCW ( ! UNIFORM_GRID_USE_SSE2 )
+
+/** Percentage of extra capacity UniformGrid::Init reserves whenever a grid outgrows its memory.
+
+    Simulation grids get reshaped every step to fit a bounding box that
+    changes slightly from step to step.  Init, Clear and DefineShape retain
+    memory, so shrinking never reallocates, but without headroom, a grid whose
+    box grows a little each step would reallocate (and page-fault on fresh
+    memory) every step.  Reserving headroom means memory only gets reallocated
+    when the grid grows past what it ever needed before, plus this margin.
+*/
+#define UNIFORM_GRID_CAPACITY_HEADROOM_PERCENT 25
+
+/** Number of bytes of grid data a stencil kernel should touch while it visits one tile.  See UniformGridGeometry::ComputeTileShape.
+
+    Each tile, plus the layer of neighbors a stencil reads around it, should
+    fit in each core's share of cache, so successive rows and planes within a
+    tile reuse what earlier ones loaded.  This is a conservative fraction of a
+    typical per-core L2.
+*/
+#define UNIFORM_GRID_TILE_CACHE_BYTES ( 128 * 1024 )
+
+/** Whether UniformGrid::DownSample and UpSample use dedicated kernels when one grid has exactly twice the cells of the other.
+
+    Nested grid layers usually have that 2:1 relation, so the weights each
+    gridpoint uses are known in advance and are the same along every row.
+    Then restriction and prolongation become separable filters: weighted sums
+    of whole rows, along y and z, which vectorize, followed by a short filter
+    along x.  This avoids per-gridpoint cluster index arithmetic and, when
+    up-sampling, the per-gridpoint position and weight computation that
+    Interpolate does.
+*/
+#define UNIFORM_GRID_RESAMPLE_BY_TWO 1
+
+/** Whether hot UniformGrid loops dispatch to UniformGridFixedShape when the grid has one of a few common shapes.
+
+    DefineShape with bPowerOf2 yields 2^n cells, hence 2^n+1 points, per
+    axis, so simulations that fit grids to similar regions every step tend to
+    produce the same few shapes.  When the shape is a compile-time constant,
+    offset arithmetic uses constant multipliers (shifts and adds), index
+    recovery uses constant divisors (shifts and masks for powers of two,
+    multiply-high otherwise), and neighbor offsets become immediates.
+
+    \see DispatchOnShape.
+*/
+#define UNIFORM_GRID_DISPATCH_FIXED_SHAPES 1
+
 /** Whether to use all neighbors when performing downsamping.
 
     \note   The "diffusing" version of this downsampler might be more appropriate
@@ -55,18 +119,24 @@
 #define ABS( x ) ( ( (x) < 0 ) ? ( - (x) ) : (x) )
 
 #if USE_TBB
+#include <atomic>
+
 namespace Math
 {
-    /// Atomically increment sum.
+    /** Atomically increment sum.
+
+        Neither classic tbb::atomic nor std::atomic (before C++20) has a floating-point
+        fetch_add, so this loops on compare-exchange until no other thread
+        changed sum between reading and writing it.
+    */
     inline void Float_FetchAndAdd( float & sum , const float & increment )
     {
-        tbb::atomic<float> & atomicSum = reinterpret_cast< tbb::atomic<float> & >( sum );
-        float sumOld , sumNew ;
-        do
-        {
-            sumOld = atomicSum ;
-            sumNew = sumOld + increment ;
-        } while( atomicSum.compare_and_swap( sumNew , sumOld ) != sumOld ) ;
+        ASSERT( ( sizeof( std::atomic< float > ) == sizeof( float ) ) && std::atomic< float >().is_lock_free() ) ; // Reinterpreting requires same layout.
+        std::atomic< float > & atomicSum = reinterpret_cast< std::atomic< float > & >( sum ) ;
+        float sumOld = atomicSum.load( std::memory_order_relaxed ) ;
+        while( ! atomicSum.compare_exchange_weak( sumOld , sumOld + increment ) )
+        {   // Another thread changed sum.  compare_exchange_weak loaded its new value into sumOld, so retry with that.
+        }
     }
 
 
@@ -221,6 +291,24 @@ class UniformGridGeometry
 
 
 
+        /** Return whether this grid has exactly twice as many cells as the given grid along each axis, spanning the same region.
+
+            Then the gridpoints of this grid with even indices coincide with those of loRes,
+            and those with odd indices lie midway between them.
+
+            \see UNIFORM_GRID_RESAMPLE_BY_TWO.
+        */
+        bool IsRefinementByTwoOf( const UniformGridGeometry & loRes ) const
+        {
+            return      ( GetNumCells( 0 )  == 2 * loRes.GetNumCells( 0 ) )
+                    &&  ( GetNumCells( 1 )  == 2 * loRes.GetNumCells( 1 ) )
+                    &&  ( GetNumCells( 2 )  == 2 * loRes.GetNumCells( 2 ) )
+                    &&  ( GetMinCorner()    == loRes.GetMinCorner()    )
+                    &&  ( GetExtent()       == loRes.GetExtent()       ) ;
+        }
+
+
+
         bool operator==( const UniformGridGeometry & that ) const
         {
             return ShapeMatches( that )
@@ -421,6 +509,24 @@ class UniformGridGeometry
         }
 
 
+        /** Define shape of this grid from the values GetMinCorner, GetExtent and GetNumPoints report.
+
+            Unlike DefineShape, which chooses number of points to suit a number
+            of elements, this reproduces a given shape exactly, for example one
+            read from a file.
+        */
+        void DefineShapeFromPoints( const Vec3 & minCorner , const Vec3 & extent , const unsigned numPoints[ 3 ] )
+        {
+            ASSERT( ( numPoints[ 0 ] >= 2 ) && ( numPoints[ 1 ] >= 2 ) && ( numPoints[ 2 ] >= 2 ) ) ;
+            mMinCorner      = minCorner ;
+            mGridExtent     = extent ;
+            mNumPoints[ 0 ] = numPoints[ 0 ] ;
+            mNumPoints[ 1 ] = numPoints[ 1 ] ;
+            mNumPoints[ 2 ] = numPoints[ 2 ] ;
+            PrecomputeSpacing() ;
+        }
+
+
 
 
         /** Use shape information from another UniformGrid and contraints to determine shape of this grid.
@@ -494,6 +600,34 @@ class UniformGridGeometry
         unsigned GetGridCapacity() const { return GetNumPoints( 0 ) * GetNumPoints( 1 ) * GetNumPoints( 2 ) ; }
 
 
+        /** Compute shape of tiles into which to split gridpoints, for kernels that read a stencil around each gridpoint.
+
+            \param tileShape - (output) Number of gridpoints along each axis of a tile.
+
+            \param bytesPerGridpoint - Total size of the values, across all grids, that the kernel reads or writes per gridpoint.
+
+            Tiles span entire rows along x, so hardware prefetch streams each row,
+            unless even a single plane of rows would overflow the cache
+            budget.  Along y and z, they have the same length, chosen so the
+            tile plus a one-gridpoint halo fits in UNIFORM_GRID_TILE_CACHE_BYTES.
+
+            \see Parallel::ForTiles.
+        */
+        void ComputeTileShape( size_t tileShape[ 3 ] , size_t bytesPerGridpoint ) const
+        {
+            ASSERT( bytesPerGridpoint > 0 ) ;
+            const size_t numPointsInBudget  = Max2( size_t( 1 ) , size_t( UNIFORM_GRID_TILE_CACHE_BYTES ) / bytesPerGridpoint ) ;
+            // Use whole rows unless 3 rows (a row plus its halo) would not fit even in a tile only one row wide.
+            tileShape[ 0 ] = Max2( size_t( 1 ) , Min2( size_t( GetNumPoints( 0 ) ) , numPointsInBudget / 9 ) ) ;
+            // Solve ( side + 2 )^2 * rowLength = budget for side.
+            const size_t numRowsInBudget    = numPointsInBudget / ( tileShape[ 0 ] + 2 ) ;
+            const size_t sidePlusHalo       = size_t( sqrtf( float( numRowsInBudget ) ) ) ;
+            const size_t side               = Max2( size_t( 1 ) , ( sidePlusHalo > 2 ) ? sidePlusHalo - 2 : size_t( 1 ) ) ;
+            tileShape[ 1 ] = Min2( side , size_t( Max2( 1U , GetNumPoints( 1 ) ) ) ) ;
+            tileShape[ 2 ] = Min2( side , size_t( Max2( 1U , GetNumPoints( 2 ) ) ) ) ;
+        }
+
+
         /** Return extent (in world units) of a grid cell.
         */
         const Vec3 &    GetCellSpacing() const  { return mCellExtent ; }
@@ -543,6 +677,8 @@ class UniformGridGeometry
             indices[0] = unsigned( vIdx.x ) ;
             indices[1] = unsigned( vIdx.y ) ;
             indices[2] = unsigned( vIdx.z ) ;
+        #elif UNIFORM_GRID_USE_SSE2 // Optimization 5: SSE2 intrinsics, which truncate without changing control word
+            TruncateIndices( indices , vIdx ) ;
         #elif 1 // Optimization 1: change control word once for all 3 conversions
             const WORD OldCtrlWord = Changex87FloatingPointToTruncate() ;
             indices[0] = StoreFloatAsInt( vIdx.x ) ;
@@ -607,21 +743,31 @@ class UniformGridGeometry
         
             Assumes floating point control word is set to use truncation instead of nearest, for rounding.
 
+            \note When UNIFORM_GRID_TRUNCATE_NEEDS_FPCW is 0, this truncates
+                    regardless of the floating point control word, so it is
+                    safe to call from any thread without changing it.
+
             \see IndicesOfPosition, StoreFloatAsInt, Changex87FloatingPointToTruncate.
 
         */
         void IndicesOfPosition_AssumesFpcwSetToTruncate( unsigned indices[4] , const Vec3 & vPosition ) const
         {
+        #if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
             ASSERT( FpcwTruncates() ) ;
+        #endif
             // Notice the pecular test here.  vPosition may lie slightly outside of the extent give by vMax.
             // Review the geometry described in the class header comment.
             Vec3 vPosRel( vPosition - GetMinCorner() ) ;   // position of given point relative to container region
             Vec3 vIdx( vPosRel.x * GetCellsPerExtent().x , vPosRel.y * GetCellsPerExtent().y , vPosRel.z * GetCellsPerExtent().z ) ;
+        #if UNIFORM_GRID_USE_SSE2
+            TruncateIndices( indices , vIdx ) ;
+        #else
             // The following 3 float-to-int conversions assume the
             // floating-point-control-word is set to truncate, by the outer caller.
             indices[0] = StoreFloatAsInt( vIdx.x ) ;
             indices[1] = StoreFloatAsInt( vIdx.y ) ;
             indices[2] = StoreFloatAsInt( vIdx.z ) ;
+        #endif
             ASSERT( indices[0] < GetNumPoints( 0 ) ) ;
             ASSERT( indices[1] < GetNumPoints( 1 ) ) ;
             ASSERT( indices[2] < GetNumPoints( 2 ) ) ;
@@ -833,6 +979,43 @@ class UniformGridGeometry
         }
 
 
+    #if UNIFORM_GRID_USE_SSE2
+        /** Truncate the 3 components of the given fractional indices to integers, without depending on the floating point control word.
+
+            cvttps2dq always truncates, unlike fistp, which obeys the x87
+            control word, and cvtps2dq, which obeys MXCSR.  This fills all 4
+            elements of indices, which is why index arrays have 4 elements.
+        */
+        static void TruncateIndices( unsigned indices[4] , const Vec3 & vIdx )
+        {
+            const __m128i truncated = _mm_cvttps_epi32( _mm_set_ps( 0.0f , vIdx.z , vIdx.y , vIdx.x ) ) ;
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( indices ) , truncated ) ;
+        }
+    #endif
+
+
+        /** Add scale times each element of src to the corresponding element of dst.
+
+            Resampling kernels treat a row of gridpoints as a flat array of floats,
+            so this accumulates a whole row, regardless of ItemT, 4 floats at a time.
+        */
+        static void AccumulateScaledFloats( float * dst , const float * src , float scale , size_t numFloats )
+        {
+            size_t idx = 0 ;
+        #if UNIFORM_GRID_USE_SSE2
+            const __m128 scales = _mm_set1_ps( scale ) ;
+            for( ; idx + 4 <= numFloats ; idx += 4 )
+            {
+                _mm_storeu_ps( dst + idx , _mm_add_ps( _mm_loadu_ps( dst + idx ) , _mm_mul_ps( scales , _mm_loadu_ps( src + idx ) ) ) ) ;
+            }
+        #endif
+            for( ; idx < numFloats ; ++ idx )
+            {   // For each float remaining...
+                dst[ idx ] += scale * src[ idx ] ;
+            }
+        }
+
+
         Vec3    mMinCorner      ;   ///< Minimum position (in world units) of grid in X, Y and Z directions.
         Vec3    mGridExtent     ;   ///< Size (in world units) of grid in X, Y and Z directions.
         Vec3    mCellExtent     ;   ///< Size (in world units) of a cell.
@@ -845,13 +1028,135 @@ class UniformGridGeometry
 
 
 
+/** Index arithmetic for a block of gridpoints whose shape is known only at run time.
+
+    This and UniformGridFixedShape have the same interface, so kernels templated
+    on the shape policy compile to specialized code for each.
+
+    \see UniformGridFixedShape, DispatchOnShape.
+*/
+class UniformGridRuntimeShape
+{
+    public:
+        explicit UniformGridRuntimeShape( const UniformGridGeometry & geometry )
+            : mNumX( geometry.GetNumPoints( 0 ) )
+            , mNumXY( geometry.GetNumPoints( 0 ) * geometry.GetNumPoints( 1 ) )
+        {}
+
+        UniformGridRuntimeShape( size_t numX , size_t numY )
+            : mNumX( numX )
+            , mNumXY( numX * numY )
+        {}
+
+        /// Return distance, in elements, between adjacent gridpoints along y.
+        size_t GetNumX() const  { return mNumX ; }
+
+        /// Return distance, in elements, between adjacent gridpoints along z.
+        size_t GetNumXY() const { return mNumXY ; }
+
+        /// Return offset, into contents array, of gridpoint with given indices.
+        size_t OffsetFromIndices( size_t ix , size_t iy , size_t iz ) const
+        {
+            return ix + GetNumX() * iy + GetNumXY() * iz ;
+        }
+
+        /// Compute indices of gridpoint at given offset into contents array.
+        void IndicesFromOffset( unsigned indices[3] , size_t offset ) const
+        {
+            indices[2] = unsigned( offset / GetNumXY() ) ;
+            const size_t offsetInLayer = offset - indices[2] * GetNumXY() ;
+            indices[1] = unsigned( offsetInLayer / GetNumX() ) ;
+            indices[0] = unsigned( offsetInLayer - indices[1] * GetNumX() ) ;
+        }
+
+    private:
+        size_t  mNumX   ;   ///< Number of gridpoints along x.
+        size_t  mNumXY  ;   ///< Number of gridpoints in each layer normal to z.
+} ;
+
+
+
+
+/** Index arithmetic for a block of gridpoints whose shape is a compile-time constant.
+
+    \param NX, NY, NZ - Number of gridpoints along each axis.
+
+    Since strides are constants, compilers replace multiplies and divides by
+    them with shifts, masks and adds, and fold neighbor offsets into
+    addressing modes.
+
+    \see UniformGridRuntimeShape, UNIFORM_GRID_DISPATCH_FIXED_SHAPES.
+*/
+template< unsigned NX , unsigned NY , unsigned NZ > class UniformGridFixedShape
+{
+    public:
+        /// Return whether the given geometry has the shape this policy assumes.
+        static bool Matches( const UniformGridGeometry & geometry )
+        {
+            return ( NX == geometry.GetNumPoints( 0 ) ) && ( NY == geometry.GetNumPoints( 1 ) ) && ( NZ == geometry.GetNumPoints( 2 ) ) ;
+        }
+
+        size_t GetNumX() const  { return NX ; }
+        size_t GetNumXY() const { return NX * NY ; }
+
+        size_t OffsetFromIndices( size_t ix , size_t iy , size_t iz ) const
+        {
+            return ix + GetNumX() * iy + GetNumXY() * iz ;
+        }
+
+        void IndicesFromOffset( unsigned indices[3] , size_t offset ) const
+        {
+            indices[2] = unsigned( offset / GetNumXY() ) ;
+            const size_t offsetInLayer = offset - indices[2] * GetNumXY() ;
+            indices[1] = unsigned( offsetInLayer / GetNumX() ) ;
+            indices[0] = unsigned( offsetInLayer - indices[1] * GetNumX() ) ;
+        }
+} ;
+
+
+
+
+/** Call func with the most specialized shape policy that matches the given geometry.
+
+    \param func - Function object with a member template operator()( const ShapeT & shape ),
+                    where ShapeT is UniformGridRuntimeShape or some UniformGridFixedShape.
+
+    The fixed shapes are cubes with 2^n+1 points per side, which DefineShape
+    with bPowerOf2 produces for cubical regions.  Each shape listed here
+    instantiates another copy of each dispatched kernel, so this list should
+    stay short.  Other shapes use UniformGridRuntimeShape.
+*/
+template< class FuncT > void DispatchOnShape( const UniformGridGeometry & geometry , FuncT & func )
+{
+#if UNIFORM_GRID_DISPATCH_FIXED_SHAPES
+    if( UniformGridFixedShape< 17 , 17 , 17 >::Matches( geometry ) )
+    {
+        func( UniformGridFixedShape< 17 , 17 , 17 >() ) ;
+        return ;
+    }
+    if( UniformGridFixedShape< 33 , 33 , 33 >::Matches( geometry ) )
+    {
+        func( UniformGridFixedShape< 33 , 33 , 33 >() ) ;
+        return ;
+    }
+    if( UniformGridFixedShape< 65 , 65 , 65 >::Matches( geometry ) )
+    {
+        func( UniformGridFixedShape< 65 , 65 , 65 >() ) ;
+        return ;
+    }
+#endif
+    func( UniformGridRuntimeShape( geometry ) ) ;
+}
+
+
+
+
 /** Templated container for fast spatial lookups and insertions.
 */
 template <class ItemT> class UniformGrid : public UniformGridGeometry
 {
 
-#if USE_TBB
-    /** Templated function object to down-sample
+    /** Templated function object to down-sample a tile at a time, possibly using Threading Building Blocks.
     */
     class UniformGrid_DownSample_TBB
     {
@@ -859,11 +1164,13 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             const UniformGrid &                         mHiResSrc               ;   /// Reference to object from which to down-sample
             UniformGridGeometry::AccuracyVersusSpeedE   mAccuracyVersusSpeed    ;   /// How to down-sample from finer grid
         public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
+            void operator() ( const Parallel::Range3d & r ) const
             {   // Perform subset of down-sampling
                 SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
                 SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mLoResDst.DownSampleSlice( mHiResSrc , mAccuracyVersusSpeed , r.begin() , r.end() ) ;
+                const size_t begin[ 3 ] = { r.cols().begin() , r.rows().begin() , r.pages().begin() } ;
+                const size_t end  [ 3 ] = { r.cols().end()   , r.rows().end()   , r.pages().end()   } ;
+                mLoResDst.DownSampleSlice( mHiResSrc , mAccuracyVersusSpeed , begin , end ) ;
             }
             UniformGrid_DownSample_TBB( UniformGrid & loResDst , const UniformGrid & hiResSrc , UniformGridGeometry::AccuracyVersusSpeedE accuracyVsSpeed )
                 : mLoResDst( loResDst )
@@ -879,7 +1186,7 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
     } ;
 
 
-    /** Templated function object to up-sample
+    /** Templated function object to up-sample a tile at a time, possibly using Threading Building Blocks.
     */
     class UniformGrid_UpSample_TBB
     {
@@ -887,11 +1194,13 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             const UniformGrid &             mLoResSrc   ;   /// Reference to object from which to up-sample
             UniformGridGeometry::RegionE    mRegion     ;   /// Into what region to up-sample
         public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Perform subset of down-sampling
+            void operator() ( const Parallel::Range3d & r ) const
+            {   // Perform subset of up-sampling
                 SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
                 SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mHiResDst.UpSampleSlice( mLoResSrc , mRegion , r.begin() , r.end() ) ;
+                const size_t begin[ 3 ] = { r.cols().begin() , r.rows().begin() , r.pages().begin() } ;
+                const size_t end  [ 3 ] = { r.cols().end()   , r.rows().end()   , r.pages().end()   } ;
+                mHiResDst.UpSampleSlice( mLoResSrc , mRegion , begin , end ) ;
             }
             UniformGrid_UpSample_TBB( UniformGrid & hiResDst , const UniformGrid & loResSrc , UniformGridGeometry::RegionE region )
                 : mHiResDst( hiResDst )
@@ -905,7 +1214,6 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             WORD        mMasterThreadFloatingPointControlWord   ;
             unsigned    mMasterThreadMmxControlStatusRegister   ;
     } ;
-#endif
 
 
     public:
@@ -964,12 +1272,27 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             if( this != & that )
             {
                 this->Parent::operator=( that ) ;
+                const size_t numPoints = that.mContents.Size() ;
+                if( numPoints > mContents.Capacity() )
+                {   // Reserve headroom, like Init, so copying a slowly growing grid, such as each step's snapshot, does not reallocate each time.
+                    mContents.Clear() ;
+                    mContents.Reserve( numPoints + numPoints * UNIFORM_GRID_CAPACITY_HEADROOM_PERCENT / 100 ) ;
+                }
                 // Note, in MSVC 7.1 (.NET) for vector-of-vectors, this seems to corrupt the original vector.
                 mContents = that.mContents ;
             }
             return * this ;
         }
 
+        /// Exchange shape and contents of this grid with another, without copying items.
+        void Swap( UniformGrid & that )
+        {
+            const UniformGridGeometry geometry( * this ) ;
+            this->Parent::operator=( that ) ;
+            that.Parent::operator=( geometry ) ;
+            mContents.swap( that.mContents ) ;
+        }
+
         /// Return contents
 
 #   if _MSC_VER && ( _MSC_VER < 1700 ) // Older compiler...
@@ -1040,17 +1363,28 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
 
 
         /** Initialize contents to whatever default ctor provides.
+
+            This reuses memory the grid already holds, and only reallocates when the
+            current shape needs more points than ever before.
+
+            \see UNIFORM_GRID_CAPACITY_HEADROOM_PERCENT
         */
         void Init( const ItemT & initialValue = ItemT() )
         {
             PERF_BLOCK( UniformGrid__Init ) ;
 
-            // First clear because Resize only assigns values to new items.
-            mContents.Clear() ;
-            mContents.Resize( GetGridCapacity() , initialValue ) ;
+            const size_t numPoints = GetGridCapacity() ;
+            if( numPoints > mContents.Capacity() )
+            {   // Grid outgrew its memory.  Clear first, so reallocating does not copy stale contents.
+                mContents.Clear() ;
+                mContents.Reserve( numPoints + numPoints * UNIFORM_GRID_CAPACITY_HEADROOM_PERCENT / 100 ) ;
+            }
+            mContents.assign( numPoints , initialValue ) ;
         }
 
 
+        /** Define shape of this grid, and discard contents, but retain memory for reuse by Init.
+        */
         void DefineShape( size_t uNumElements , const Vec3 & vMin , const Vec3 & vMax , bool bPowerOf2 )
         {
             mContents.Clear() ;
@@ -1063,6 +1397,29 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
         size_t Size() const { return mContents.Size() ; }
 
 
+        /** Return number of bytes the contents of this grid occupy, including memory retained for reuse.
+
+            \see MemoryBudget
+        */
+        size_t GetMemoryUsage() const { return mContents.Capacity() * sizeof( ItemT ) ; }
+
+
+        /** Release memory this grid retains for reuse beyond its headroom, for example after its shape shrank.
+
+            Init and operator= only grow memory, so without this, usage reflects the largest shape the grid ever had.
+
+            \see MemoryBudget, UNIFORM_GRID_CAPACITY_HEADROOM_PERCENT
+        */
+        void TrimMemory()
+        {
+            const size_t numPoints = mContents.Size() ;
+            if( mContents.Capacity() > numPoints + numPoints * UNIFORM_GRID_CAPACITY_HEADROOM_PERCENT / 100 )
+            {   // Grid retains more than headroom.  Copy contents into a vector with exactly enough capacity.
+                VECTOR< ItemT , FirstTouchAllocator< ItemT > >( mContents ).swap( mContents ) ;
+            }
+        }
+
+
         /** Return whether this container contains any items.
         */
         bool Empty() const { return mContents.Empty() ; }
@@ -1259,6 +1616,75 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
 
 
 
+        static const unsigned INTERPOLATE_BATCH_SIZE = 4 ;  ///< Number of positions for which InterpolateMany computes indices and weights at a time.
+
+        /** Interpolate values from grid at each of several positions.
+
+            This computes cell indices and interpolation weights for
+            INTERPOLATE_BATCH_SIZE positions at a time, using SSE2 when
+            available, then blends the 8 gridpoints around each position.
+            SSE2 truncation does not depend on the x87 floating-point control
+            word, so callers need not change it, unlike with
+            Interpolate_AssumesFpcwSetToTruncate.
+
+            \param positions    Array of n positions to sample.  Each must lie inside this grid.
+
+            \param results      Array of n values, each assigned the value interpolated at the corresponding position.
+
+            \param n            Number of positions.
+
+            \see Interpolate, which this matches to within roundoff.
+        */
+        void InterpolateMany( const Vec3 * positions , ItemT * results , size_t n ) const
+        {
+            InterpolateManyFunc func( * this , positions , results , n ) ;
+            DispatchOnShape( * this , func ) ;
+        }
+
+
+
+        /** Interpolate values from grid at each of several positions, using the given shape policy for offset arithmetic.
+
+            \param shape - UniformGridRuntimeShape or UniformGridFixedShape that matches this grid.
+
+            \see InterpolateMany, DispatchOnShape.
+        */
+        template< class ShapeT > void InterpolateManyInShape( const ShapeT & shape , const Vec3 * positions , ItemT * results , size_t n ) const
+        {
+            ASSERT( shape.GetNumX() == GetNumPoints( 0 ) ) ;
+            ASSERT( shape.GetNumXY() == GetNumPoints( 0 ) * GetNumPoints( 1 ) ) ;
+            int             indices[ 3 ][ INTERPOLATE_BATCH_SIZE ] ;
+            float           tweens [ 3 ][ INTERPOLATE_BATCH_SIZE ] ;
+            for( size_t iBatchBegin = 0 ; iBatchBegin < n ; iBatchBegin += INTERPOLATE_BATCH_SIZE )
+            {   // For each batch of positions...
+                const size_t numInBatch = Min2( size_t( INTERPOLATE_BATCH_SIZE ) , n - iBatchBegin ) ;
+                IndicesAndTweensOfPositions( indices , tweens , positions + iBatchBegin , numInBatch ) ;
+                for( size_t lane = 0 ; lane < numInBatch ; ++ lane )
+                {   // For each position in batch...
+                    ASSERT( unsigned( indices[0][ lane ] ) < GetNumCells( 0 ) ) ;
+                    ASSERT( unsigned( indices[1][ lane ] ) < GetNumCells( 1 ) ) ;
+                    ASSERT( unsigned( indices[2][ lane ] ) < GetNumCells( 2 ) ) ;
+                    const Vec3      tween         = Vec3( tweens[0][ lane ] , tweens[1][ lane ] , tweens[2][ lane ] ) ;
+                    const Vec3      oneMinusTween = Vec3( 1.0f , 1.0f , 1.0f ) - tween ;
+                    const size_t    offsetX0Y0Z0  = shape.OffsetFromIndices( size_t( indices[0][ lane ] ) , size_t( indices[1][ lane ] ) , size_t( indices[2][ lane ] ) ) ;
+                    const size_t    offsetX0Y1Z0  = offsetX0Y0Z0 + shape.GetNumX() ;
+                    const size_t    offsetX0Y0Z1  = offsetX0Y0Z0 + shape.GetNumXY() ;
+                    const size_t    offsetX0Y1Z1  = offsetX0Y0Z1 + shape.GetNumX() ;
+                    results[ iBatchBegin + lane ] =
+                                  ( ( oneMinusTween.x * (*this)[ offsetX0Y0Z0     ]
+                                    +         tween.x * (*this)[ offsetX0Y0Z0 + 1 ] ) * oneMinusTween.y
+                                  + ( oneMinusTween.x * (*this)[ offsetX0Y1Z0     ]
+                                    +         tween.x * (*this)[ offsetX0Y1Z0 + 1 ] ) * tween.y        ) * oneMinusTween.z
+                                + ( ( oneMinusTween.x * (*this)[ offsetX0Y0Z1     ]
+                                    +         tween.x * (*this)[ offsetX0Y0Z1 + 1 ] ) * oneMinusTween.y
+                                  + ( oneMinusTween.x * (*this)[ offsetX0Y1Z1     ]
+                                    +         tween.x * (*this)[ offsetX0Y1Z1 + 1 ] ) * tween.y        ) * tween.z ;
+                }
+            }
+        }
+
+
+
         /** Accumulate given value into grid at given position.
 
             \param vPosition - position of a "source" whose contents this routine stores in a grid cell.
@@ -1445,14 +1871,26 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
 
             \param hiRes - hiRes grid from which information will be aggregated.
 
+            \param idxBegin - Indices of first loRes gridpoint, along each axis, of the tile to down-sample.
+
+            \param idxEnd - One past indices of last loRes gridpoint, along each axis, of the tile to down-sample.
+
             \note This loRes grid must have 3 or greater points in at least one of its dimensions.
 
             \see SolvePoissonMultiGrid UpSampleFrom
 
         */
-        void DownSampleSlice( const UniformGrid< ItemT > & hiRes , AccuracyVersusSpeedE accuracyVsSpeed , size_t izStart , size_t izEnd )
+        void DownSampleSlice( const UniformGrid< ItemT > & hiRes , AccuracyVersusSpeedE accuracyVsSpeed , const size_t idxBegin[ 3 ] , const size_t idxEnd[ 3 ] )
         {
-            PERF_BLOCK( UniformGrid__DownSampleSlice ) ;
+            PERF_BLOCK_INNER( UniformGrid__DownSampleSlice ) ;
+
+        #if UNIFORM_GRID_RESAMPLE_BY_TWO
+            if( hiRes.IsRefinementByTwoOf( * this ) )
+            {   // Grids have 2:1 relation typical of nested grid layers.
+                DownSampleByTwoSlice( hiRes , accuracyVsSpeed , idxBegin , idxEnd ) ;
+                return ;
+            }
+        #endif
 
             ASSERT( hiRes.Size() == hiRes.GetGridCapacity() ) ;
             UniformGrid< ItemT > &  loRes        = * this ;
@@ -1469,8 +1907,8 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             ASSERT( pClusterDims[0] > 1 ) ;
             ASSERT( pClusterDims[0] > 1 ) ;
 
-            const unsigned  numPointsLoRes[3]   = { loRes.GetNumPoints( 0 ) , loRes.GetNumPoints( 1 ) , loRes.GetNumPoints( 2 ) } ;
             const unsigned  numXYLoRes          = loRes.GetNumPoints( 0 ) * loRes.GetNumPoints( 1 ) ;
+            ASSERT( ( idxEnd[0] <= loRes.GetNumPoints( 0 ) ) && ( idxEnd[1] <= loRes.GetNumPoints( 1 ) ) && ( idxEnd[2] <= loRes.GetNumPoints( 2 ) ) ) ;
 
             const unsigned          numPointsHiRes[3]   = { hiRes.GetNumPoints( 0 ) , hiRes.GetNumPoints( 1 ) , hiRes.GetNumPoints( 2 ) } ;
 #       if USE_ALL_NEIGHBORS
@@ -1483,13 +1921,13 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             // moved outside the loop.  Accomplish this by limiting the loRes indices to
             // be in [1,N-2] and then creating 6 2D loops below, for the boundary planes.
             unsigned idxLoRes[3] ;
-            for( idxLoRes[2] = unsigned( izStart ) ; idxLoRes[2] < unsigned( izEnd ) ; ++ idxLoRes[2] )
+            for( idxLoRes[2] = unsigned( idxBegin[2] ) ; idxLoRes[2] < unsigned( idxEnd[2] ) ; ++ idxLoRes[2] )
             {
                 const unsigned offsetLoZ = idxLoRes[2] * numXYLoRes ;
-                for( idxLoRes[1] = 0 ; idxLoRes[1] < numPointsLoRes[1] ; ++ idxLoRes[1] )
+                for( idxLoRes[1] = unsigned( idxBegin[1] ) ; idxLoRes[1] < unsigned( idxEnd[1] ) ; ++ idxLoRes[1] )
                 {
                     const unsigned offsetLoYZ = idxLoRes[1] * loRes.GetNumPoints( 0 ) + offsetLoZ ;
-                    for( idxLoRes[0] = 0 ; idxLoRes[0] < numPointsLoRes[0] ; ++ idxLoRes[0] )
+                    for( idxLoRes[0] = unsigned( idxBegin[0] ) ; idxLoRes[0] < unsigned( idxEnd[0] ) ; ++ idxLoRes[0] )
                     {   // For each cell in the loRes layer...
                         const unsigned  offsetLoXYZ   = idxLoRes[0] + offsetLoYZ ;
                         ItemT        &  rValLoRes  = loRes[ offsetLoXYZ ] ;
@@ -1573,35 +2011,132 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
                     }
                 }
             }
+        }
 
-#           if defined( _DEBUG )
-            if( UniformGridGeometry::SLOWER_MORE_ACCURATE == accuracyVsSpeed )
+
+
+
+        /** Restrict values from a given high-resolution grid, with exactly twice as many cells, into this low-resolution grid.
+
+            This yields the same values as the general DownSampleSlice, but exploits the
+            fixed 2:1 ratio.  Each loRes gridpoint (i,j,k) aggregates hiRes gridpoints
+            (2i+a,2j+b,2k+c) where a, b and c range over {-1,0,1}, with weight w(a)w(b)w(c)/64,
+            where w(0)=2 and w(+-1)=1.  Those weights are separable, so this first sums,
+            into a scratch row, the 9 hiRes rows around each loRes row, weighted along y and
+            z, using AccumulateScaledFloats, then filters that row along x.
+
+            \see DownSampleSlice, IsRefinementByTwoOf.
+        */
+        void DownSampleByTwoSlice( const UniformGrid< ItemT > & hiRes , AccuracyVersusSpeedE accuracyVsSpeed , const size_t idxBegin[ 3 ] , const size_t idxEnd[ 3 ] )
+        {
+            UniformGrid< ItemT > &  loRes               = * this ;
+            ASSERT( hiRes.Size() == hiRes.GetGridCapacity() ) ;
+            ASSERT( hiRes.IsRefinementByTwoOf( loRes ) ) ;
+            ASSERT( 0 == sizeof( ItemT ) % sizeof( float ) ) ;  // Rows get accumulated as arrays of floats.
+            const size_t            numPointsHiRes[3]   = { hiRes.GetNumPoints( 0 ) , hiRes.GetNumPoints( 1 ) , hiRes.GetNumPoints( 2 ) } ;
+            const size_t            numXhiRes           = numPointsHiRes[0] ;
+            const size_t            numXYhiRes          = numXhiRes * numPointsHiRes[1] ;
+            const size_t            numXloRes           = loRes.GetNumPoints( 0 ) ;
+            const size_t            numXYloRes          = numXloRes * loRes.GetNumPoints( 1 ) ;
+            size_t                  idxLoRes[3] ;
+
+            if( UniformGridGeometry::FASTER_LESS_ACCURATE == accuracyVsSpeed )
+            {   // Copy values from hiRes gridpoints that coincide with loRes gridpoints.
+                for( idxLoRes[2] = idxBegin[2] ; idxLoRes[2] < idxEnd[2] ; ++ idxLoRes[2] )
+                for( idxLoRes[1] = idxBegin[1] ; idxLoRes[1] < idxEnd[1] ; ++ idxLoRes[1] )
+                {
+                    const size_t    offsetLoYZ  = idxLoRes[1] * numXloRes + idxLoRes[2] * numXYloRes ;
+                    const size_t    offsetHiYZ  = 2 * idxLoRes[1] * numXhiRes + 2 * idxLoRes[2] * numXYhiRes ;
+                    for( idxLoRes[0] = idxBegin[0] ; idxLoRes[0] < idxEnd[0] ; ++ idxLoRes[0] )
+                    {
+                        loRes[ idxLoRes[0] + offsetLoYZ ] = hiRes[ 2 * idxLoRes[0] + offsetHiYZ ] ;
+                    }
+                }
+                return ;
+            }
+
+            ASSERT( UniformGridGeometry::SLOWER_MORE_ACCURATE == accuracyVsSpeed ) ;
+            // Weight of hiRes gridpoints along each axis, indexed by offset+1 from gridpoint coinciding with loRes gridpoint.
+            static const float  sWeights[ 3 ]       = { 1.0f , 2.0f , 1.0f } ;
+            static const float  sOneOverWeightSum   = 1.0f / 64.0f ;
+            static const size_t sNumFloatsPerItem   = sizeof( ItemT ) / sizeof( float ) ;
+
+            // Range of hiRes x indices this tile reads.
+            const size_t    ixHiBegin       = ( idxBegin[0] > 0 ) ? 2 * idxBegin[0] - 1 : 0 ;
+            const size_t    ixHiEnd         = Min2( 2 * idxEnd[0] , numXhiRes ) ;
+            const size_t    numRowFloats    = ( ixHiEnd - ixHiBegin ) * sNumFloatsPerItem ;
+            VECTOR< ItemT > rowSum( ixHiEnd - ixHiBegin ) ;
+            float *         rowSumFloats    = reinterpret_cast< float * >( & rowSum[ 0 ] ) ;
+
+            for( idxLoRes[2] = idxBegin[2] ; idxLoRes[2] < idxEnd[2] ; ++ idxLoRes[2] )
             {
-                const ItemT zerothMomentLoRes = loRes.Sum() * loRes.GetCellVolume() ;
-                const ItemT zerothMomentHiRes = hiRes.Sum() * hiRes.GetCellVolume() ;
-                ASSERT( zerothMomentLoRes.Resembles( zerothMomentHiRes , 1.0e-2f ) ) ;
+                const size_t izHiBegin  = ( idxLoRes[2] > 0 ) ? 2 * idxLoRes[2] - 1 : 0 ;
+                const size_t izHiEnd    = Min2( 2 * idxLoRes[2] + 2 , numPointsHiRes[2] ) ;
+                for( idxLoRes[1] = idxBegin[1] ; idxLoRes[1] < idxEnd[1] ; ++ idxLoRes[1] )
+                {
+                    const size_t iyHiBegin  = ( idxLoRes[1] > 0 ) ? 2 * idxLoRes[1] - 1 : 0 ;
+                    const size_t iyHiEnd    = Min2( 2 * idxLoRes[1] + 2 , numPointsHiRes[1] ) ;
+
+                    // Sum hiRes rows neighboring this loRes row, weighted along y and z.
+                    memset( rowSumFloats , 0 , numRowFloats * sizeof( float ) ) ;
+                    for( size_t izHi = izHiBegin ; izHi < izHiEnd ; ++ izHi )
+                    for( size_t iyHi = iyHiBegin ; iyHi < iyHiEnd ; ++ iyHi )
+                    {   // For each hiRes row within one cell of this loRes row...
+                        const float     weight      = sWeights[ izHi + 1 - 2 * idxLoRes[2] ] * sWeights[ iyHi + 1 - 2 * idxLoRes[1] ] * sOneOverWeightSum ;
+                        const ItemT &   rowBegin    = hiRes[ ixHiBegin + iyHi * numXhiRes + izHi * numXYhiRes ] ;
+                        AccumulateScaledFloats( rowSumFloats , reinterpret_cast< const float * >( & rowBegin ) , weight , numRowFloats ) ;
+                    }
+
+                    // Filter summed row along x.
+                    const size_t offsetLoYZ = idxLoRes[1] * numXloRes + idxLoRes[2] * numXYloRes ;
+                    for( idxLoRes[0] = idxBegin[0] ; idxLoRes[0] < idxEnd[0] ; ++ idxLoRes[0] )
+                    {   // For each loRes gridpoint in this row...
+                        const size_t    ixHi        = 2 * idxLoRes[0] ;
+                        ItemT &         rValLoRes   = loRes[ idxLoRes[0] + offsetLoYZ ] ;
+                        rValLoRes = sWeights[ 1 ] * rowSum[ ixHi - ixHiBegin ] ;
+                        if( ixHi > 0 )
+                        {   // Gridpoint has a hiRes neighbor in -X direction.
+                            rValLoRes += rowSum[ ixHi - 1 - ixHiBegin ] ;
+                        }
+                        if( ixHi + 1 < numXhiRes )
+                        {   // Gridpoint has a hiRes neighbor in +X direction.
+                            rValLoRes += rowSum[ ixHi + 1 - ixHiBegin ] ;
+                        }
+                        ASSERT( ! IsInf( rValLoRes ) && ! IsNan( rValLoRes ) ) ;
+                    }
+                }
             }
-#           endif
         }
 
 
 
 
+        /** Restrict values from a given high-resolution grid into this low-resolution grid, a tile at a time.
+
+            Each loRes gridpoint reads a cluster of hiRes gridpoints, so tiles
+            are sized by the loRes and hiRes bytes touched per loRes gridpoint.
+
+            \see DownSampleSlice.
+        */
         void DownSample( const UniformGrid & hiResSrc , AccuracyVersusSpeedE accuracyVsSpeed )
         {
             PERF_BLOCK( UniformGrid__DownSample ) ;
 
-            const size_t numZ = GetNumPoints( 2 ) ;
+            const size_t    begin[ 3 ]      = { 0 , 0 , 0 } ;
+            const size_t    end[ 3 ]        = { GetNumPoints( 0 ) , GetNumPoints( 1 ) , GetNumPoints( 2 ) } ;
+            const size_t    hiResPerLoRes   = Max2( size_t( 1 ) , size_t( hiResSrc.GetGridCapacity() / Max2( 1U , GetGridCapacity() ) ) ) ;
+            size_t          tileShape[ 3 ]  ;
+            ComputeTileShape( tileShape , sizeof( ItemT ) * ( 1 + hiResPerLoRes ) ) ;
+            Parallel::ForTiles( begin , end , tileShape , UniformGrid_DownSample_TBB( * this , hiResSrc , accuracyVsSpeed ) ) ;
 
-#       if USE_TBB
+#           if defined( _DEBUG )
+            if( UniformGridGeometry::SLOWER_MORE_ACCURATE == accuracyVsSpeed )
             {
-                // Estimate grain size based on size of problem and number of processors.
-                const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
-                parallel_for( tbb::blocked_range<size_t>( 0 , numZ , grainSize ) , UniformGrid_DownSample_TBB( * this , hiResSrc , accuracyVsSpeed ) ) ;
+                const ItemT zerothMomentLoRes = Sum() * GetCellVolume() ;
+                const ItemT zerothMomentHiRes = hiResSrc.Sum() * hiResSrc.GetCellVolume() ;
+                ASSERT( Math::Resembles( zerothMomentLoRes , zerothMomentHiRes , 1.0e-2f ) ) ;  // Math::Resembles, unlike a member, also applies to scalar grids.
             }
-#       else
-            DownSampleSlice( hiResSrc , accuracyVsSpeed , 0 , numZ ) ;
-#       endif
+#           endif
         }
 
 
@@ -1618,6 +2153,10 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
 
             \param loRes - low-resolution grid from which information will be read.
 
+            \param idxBegin - Indices of first hiRes gridpoint, along each axis, of the tile to up-sample.
+
+            \param idxEnd - One past indices of last hiRes gridpoint, along each axis, of the tile to up-sample.
+
             \see SolvePoissonMultiGrid DownSample
 
             \note As of 2009nov19, this routine does NOT properly "undo" the operations of DownSampleInto.
@@ -1634,9 +2173,9 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
                     quadratic, where values come from all 27 neighbors of a position.
 
         */
-        void UpSampleSlice( const UniformGrid< ItemT > & loRes , UniformGridGeometry::RegionE region , size_t izStart , size_t izEnd )
+        void UpSampleSlice( const UniformGrid< ItemT > & loRes , UniformGridGeometry::RegionE region , const size_t idxBegin[ 3 ] , const size_t idxEnd[ 3 ] )
         {
-            PERF_BLOCK( UniformGrid__UpSampleSlice ) ;
+            PERF_BLOCK_INNER( UniformGrid__UpSampleSlice ) ;
 
             UniformGrid< ItemT > &  hiRes         = * this ;
             ASSERT( loRes.Size() == loRes.GetGridCapacity() ) ;
@@ -1651,19 +2190,25 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
             ASSERT( ( hiRes.GetCellSpacing().x >= 0.0f ) && ( hiRes.GetCellSpacing().y >= 0.0f ) && ( hiRes.GetCellSpacing().z >= 0.0f ) ) ;
             const Vec3              vSpacing            = hiRes.GetCellSpacing() * ( 1.0f - 4.0f * FLT_EPSILON ) ;
 
-            unsigned                idxMin[ 3 ]         = { 0 , 0 , unsigned( izStart ) } ;
-            unsigned                idxMax[ 3 ]         = { numPointsHiRes[0] , numPointsHiRes[1] , unsigned( izEnd ) } ;
+            unsigned                idxMin[ 3 ]         = { unsigned( idxBegin[0] ) , unsigned( idxBegin[1] ) , unsigned( idxBegin[2] ) } ;
+            unsigned                idxMax[ 3 ]         = { unsigned( idxEnd[0] )   , unsigned( idxEnd[1] )   , unsigned( idxEnd[2] )   } ;
 
             if( UniformGridGeometry::INTERIOR_ONLY == region )
             {   // Up-sample only into interior gridpoint -- omit writing to boundary values.
-                idxMin[0] = 1 ;
-                idxMin[1] = 1 ;
-                idxMin[2] = MAX2( 1U , unsigned( izStart ) ) ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis, clip tile to interior.
+                    idxMin[ axis ] = MAX2( 1U , idxMin[ axis ] ) ;
+                    idxMax[ axis ] = Min2( MAX2( 1U , numPointsHiRes[ axis ] ) - 1 , idxMax[ axis ] ) ;
+                }
+            }
 
-                idxMax[0] = MAX2( 1U , numPointsHiRes[0] ) - 1 ;
-                idxMax[1] = MAX2( 1U , numPointsHiRes[1] ) - 1 ;
-                idxMax[2] = MAX2( 1U , unsigned( izEnd ) ) - 1 ;
+        #if UNIFORM_GRID_RESAMPLE_BY_TWO
+            if( hiRes.IsRefinementByTwoOf( loRes ) )
+            {   // Grids have 2:1 relation typical of nested grid layers.
+                UpSampleByTwoSlice( loRes , idxMin , idxMax ) ;
+                return ;
             }
+        #endif
 
             // Since this loop iterates over each destination cell, it parallelizes without contention.
             unsigned idxHiRes[3] ;
@@ -1688,36 +2233,174 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
                     }
                 }
             }
+        }
 
-#       if defined( _DEBUG )
-            if( UniformGridGeometry::ENTIRE_DOMAIN == region )
+
+        /** Interpolate values from the given low-resolution grid, with exactly half as many cells, into this high-resolution grid.
+
+            \param loRes - low-resolution grid from which information will be read.
+
+            \param idxMin - Indices of first hiRes gridpoint, along each axis, to assign.
+
+            \param idxMax - One past indices of last hiRes gridpoint, along each axis, to assign.
+
+            This yields the values UpSampleSlice would, via trilinear interpolation, but
+            exploits the fixed 2:1 ratio.  Along each axis, a hiRes gridpoint with an even
+            index coincides with a loRes gridpoint, and one with an odd index lies midway
+            between two, so each hiRes row blends at most 4 loRes rows, with weights
+            known in advance.  This sums those rows into a scratch row, using
+            AccumulateScaledFloats, then interpolates that row along x.
+
+            \see UpSampleSlice, IsRefinementByTwoOf.
+        */
+        void UpSampleByTwoSlice( const UniformGrid< ItemT > & loRes , const unsigned idxMin[ 3 ] , const unsigned idxMax[ 3 ] )
+        {
+            UniformGrid< ItemT > &  hiRes               = * this ;
+            ASSERT( loRes.Size() == loRes.GetGridCapacity() ) ;
+            ASSERT( hiRes.IsRefinementByTwoOf( loRes ) ) ;
+            ASSERT( 0 == sizeof( ItemT ) % sizeof( float ) ) ;  // Rows get accumulated as arrays of floats.
+            if( ( idxMin[0] >= idxMax[0] ) || ( idxMin[1] >= idxMax[1] ) || ( idxMin[2] >= idxMax[2] ) )
+            {   // Nothing to assign, e.g. tile lies entirely on boundary and caller wants only interior.
+                return ;
+            }
+
+            static const size_t sNumFloatsPerItem   = sizeof( ItemT ) / sizeof( float ) ;
+            const size_t        numXhiRes           = hiRes.GetNumPoints( 0 ) ;
+            const size_t        numXYhiRes          = numXhiRes * hiRes.GetNumPoints( 1 ) ;
+            const size_t        numXloRes           = loRes.GetNumPoints( 0 ) ;
+            const size_t        numXYloRes          = numXloRes * loRes.GetNumPoints( 1 ) ;
+
+            // Range of loRes x indices this tile reads.
+            const size_t        ixLoBegin           = idxMin[0] / 2 ;
+            const size_t        ixLoEnd             = idxMax[0] / 2 + 1 ;
+            ASSERT( ixLoEnd <= numXloRes ) ;
+            const size_t        numRowFloats        = ( ixLoEnd - ixLoBegin ) * sNumFloatsPerItem ;
+            VECTOR< ItemT >     rowSum( ixLoEnd - ixLoBegin ) ;
+            float *             rowSumFloats        = reinterpret_cast< float * >( & rowSum[ 0 ] ) ;
+
+            unsigned idxHiRes[3] ;
+            for( idxHiRes[2] = idxMin[2] ; idxHiRes[2] < idxMax[2] ; ++ idxHiRes[2] )
             {
-                const ItemT zerothMomentLoRes = loRes.ComputeZerothMoment() ;
-                const ItemT zerothMomentHiRes = hiRes.ComputeZerothMoment() ;
-                ASSERT( zerothMomentLoRes.Resembles( zerothMomentHiRes , 1.0e-2f ) ) ;
+                // Choose loRes layers, and their weights, for this hiRes layer.
+                const size_t    izLo[ 2 ]       = { idxHiRes[2] / 2 , ( idxHiRes[2] + 1 ) / 2 } ;
+                const float     weightZ         = ( idxHiRes[2] & 1 ) ? 0.5f : 1.0f ;
+                const size_t    numLayersZ      = ( idxHiRes[2] & 1 ) ? 2 : 1 ;
+                for( idxHiRes[1] = idxMin[1] ; idxHiRes[1] < idxMax[1] ; ++ idxHiRes[1] )
+                {
+                    const size_t    iyLo[ 2 ]       = { idxHiRes[1] / 2 , ( idxHiRes[1] + 1 ) / 2 } ;
+                    const float     weightYZ        = ( ( idxHiRes[1] & 1 ) ? 0.5f : 1.0f ) * weightZ ;
+                    const size_t    numRowsY        = ( idxHiRes[1] & 1 ) ? 2 : 1 ;
+
+                    // Sum loRes rows neighboring this hiRes row, weighted along y and z.
+                    memset( rowSumFloats , 0 , numRowFloats * sizeof( float ) ) ;
+                    for( size_t iz = 0 ; iz < numLayersZ ; ++ iz )
+                    for( size_t iy = 0 ; iy < numRowsY ; ++ iy )
+                    {   // For each loRes row adjacent to this hiRes row...
+                        const ItemT & rowBegin = loRes[ ixLoBegin + iyLo[ iy ] * numXloRes + izLo[ iz ] * numXYloRes ] ;
+                        AccumulateScaledFloats( rowSumFloats , reinterpret_cast< const float * >( & rowBegin ) , weightYZ , numRowFloats ) ;
+                    }
+
+                    // Interpolate summed row along x.
+                    const size_t offsetHiYZ = idxHiRes[1] * numXhiRes + idxHiRes[2] * numXYhiRes ;
+                    for( idxHiRes[0] = idxMin[0] ; idxHiRes[0] < idxMax[0] ; ++ idxHiRes[0] )
+                    {   // For each hiRes gridpoint in this row...
+                        const size_t    ixLo        = idxHiRes[0] / 2 - ixLoBegin ;
+                        ItemT &         rValHiRes   = hiRes[ idxHiRes[0] + offsetHiYZ ] ;
+                        if( idxHiRes[0] & 1 )
+                        {   // Gridpoint lies midway between loRes gridpoints.
+                            rValHiRes = 0.5f * ( rowSum[ ixLo ] + rowSum[ ixLo + 1 ] ) ;
+                        }
+                        else
+                        {   // Gridpoint coincides with loRes gridpoint.
+                            rValHiRes = rowSum[ ixLo ] ;
+                        }
+                        ASSERT( ! IsNan( rValHiRes ) && ! IsInf( rValHiRes ) ) ;
+                    }
+                }
             }
-#       endif
         }
 
 
+        /** Interpolate value from the given low-resolution grid into this high-resolution grid, a tile at a time.
+
+            \see UpSampleSlice.
+        */
         void UpSample( const UniformGrid< ItemT > & loResSrc , UniformGridGeometry::RegionE region )
         {
             PERF_BLOCK( UniformGrid__UpSample ) ;
 
-            const size_t numZ = GetNumPoints( 2 ) ;
+            const size_t    begin[ 3 ]      = { 0 , 0 , 0 } ;
+            const size_t    end[ 3 ]        = { GetNumPoints( 0 ) , GetNumPoints( 1 ) , GetNumPoints( 2 ) } ;
+            size_t          tileShape[ 3 ]  ;
+            // Each hiRes gridpoint writes itself and reads a fraction of a loRes cell.
+            ComputeTileShape( tileShape , 2 * sizeof( ItemT ) ) ;
+            Parallel::ForTiles( begin , end , tileShape , UniformGrid_UpSample_TBB( * this , loResSrc , region ) ) ;
 
-#       if USE_TBB
+#       if defined( _DEBUG )
+            if( UniformGridGeometry::ENTIRE_DOMAIN == region )
             {
-                // Estimate grain size based on size of problem and number of processors.
-                const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
-                parallel_for( tbb::blocked_range<size_t>( 0 , numZ , grainSize ) , UniformGrid_UpSample_TBB( * this , loResSrc , region ) ) ;
+                const ItemT zerothMomentLoRes = loResSrc.ComputeZerothMoment() ;
+                const ItemT zerothMomentHiRes = ComputeZerothMoment() ;
+                ASSERT( zerothMomentLoRes.Resembles( zerothMomentHiRes , 1.0e-2f ) ) ;
             }
-#       else
-            UpSampleSlice( loResSrc , region , 0 , numZ ) ;
 #       endif
         }
 
 
+        /** Interpolate values from the given grid, whose geometry can differ arbitrarily from this one, into every gridpoint of this grid.
+
+            \param src - Grid from which to read values.  It must have values and at least 2 points along each axis.
+
+            Gridpoints of this grid that lie outside src take the value of the
+            nearest point inside src, so this suits carrying a solution over to
+            a domain that moved or changed resolution, e.g. as an initial guess.
+        */
+        void Resample( const UniformGrid< ItemT > & src )
+        {
+            PERF_BLOCK( UniformGrid__Resample ) ;
+
+            ASSERT( src.Size() == src.GetGridCapacity() ) ;
+            ASSERT( ( src.GetNumCells( 0 ) > 0 ) && ( src.GetNumCells( 1 ) > 0 ) && ( src.GetNumCells( 2 ) > 0 ) ) ;
+            Init() ;
+            Parallel::For( 0 , GetNumPoints( 2 ) , 1 , Parallel::Method( this , & UniformGrid::ResampleSlice , src ) ) ;
+        }
+
+
+        /** Interpolate values from the given grid into a subset of z-layers of this grid.
+
+            \see Resample.
+        */
+        void ResampleSlice( const UniformGrid< ItemT > & src , size_t izBegin , size_t izEnd )
+        {
+            // Clamp sampling positions to lie strictly within src, as Interpolate requires.
+            static const float  nudge       = 1.0f - 4.0f * FLT_EPSILON ;
+            const Vec3          srcExtent   = src.GetExtent() * nudge ;
+            const Vec3          srcMin      = src.GetMinCorner() + ( src.GetExtent() - srcExtent ) * 0.5f ;
+            const Vec3          srcMax      = srcMin + srcExtent ;
+            const Vec3 &        vMinCorner  = GetMinCorner() ;
+            const Vec3 &        vSpacing    = GetCellSpacing() ;
+            unsigned            idx[ 3 ] ;
+            for( idx[2] = unsigned( izBegin ) ; idx[2] < izEnd ; ++ idx[2] )
+            {   // For each z-layer in this slice...
+                Vec3 vPosition ;
+                vPosition.z = Clamp( vMinCorner.z + float( idx[2] ) * vSpacing.z , srcMin.z , srcMax.z ) ;
+                for( idx[1] = 0 ; idx[1] < GetNumPoints( 1 ) ; ++ idx[1] )
+                {
+                    vPosition.y = Clamp( vMinCorner.y + float( idx[1] ) * vSpacing.y , srcMin.y , srcMax.y ) ;
+                    idx[0] = 0 ;
+                    const size_t offsetY = OffsetFromIndices( idx ) ;
+                    for( idx[0] = 0 ; idx[0] < GetNumPoints( 0 ) ; ++ idx[0] )
+                    {   // For each gridpoint in this row...
+                        vPosition.x = Clamp( vMinCorner.x + float( idx[0] ) * vSpacing.x , srcMin.x , srcMax.x ) ;
+                        src.Interpolate( (*this)[ offsetY + idx[0] ] , vPosition ) ;
+                    }
+                }
+            }
+        }
+
+
+        /** Discard shape and contents, but retain memory, so a subsequent Init need not reallocate.
+        */
         void Clear()
         {
             //PERF_BLOCK( UniformGrid__Clear ) ;
@@ -1781,7 +2464,70 @@ template <class ItemT> class UniformGrid : public UniformGridGeometry
 
 
     private:
-        VECTOR<ItemT>   mContents   ;   ///< 3D array of items.
+        /** Function object for DispatchOnShape, to call InterpolateManyInShape with the shape policy that matches a grid.
+        */
+        class InterpolateManyFunc
+        {
+            public:
+                InterpolateManyFunc( const UniformGrid & grid , const Vec3 * positions , ItemT * results , size_t n )
+                    : mGrid( grid ) , mPositions( positions ) , mResults( results ) , mNumPositions( n )
+                {}
+                template< class ShapeT > void operator()( const ShapeT & shape ) const
+                {
+                    mGrid.InterpolateManyInShape( shape , mPositions , mResults , mNumPositions ) ;
+                }
+            private:
+                InterpolateManyFunc & operator=( const InterpolateManyFunc & ) ; // Disallow assignment
+
+                const UniformGrid & mGrid           ;   ///< Grid from which to interpolate.
+                const Vec3 *        mPositions      ;   ///< Positions at which to interpolate.
+                ItemT *             mResults        ;   ///< Values interpolated at each position.
+                size_t              mNumPositions   ;   ///< Number of elements in mPositions and mResults.
+        } ;
+
+
+        /** Compute indices of cells containing given positions, and locations of positions within those cells.
+
+            \param indices     (out) Indices, along each axis, of cell containing each position.
+
+            \param tweens      (out) Location, along each axis, of each position within its cell, in [0,1).
+
+            \param positions   Array of numPositions positions, at most INTERPOLATE_BATCH_SIZE.
+
+            \param numPositions    Number of positions.  Lanes beyond this get indices of the minimal cell.
+        */
+        void IndicesAndTweensOfPositions( int indices[ 3 ][ INTERPOLATE_BATCH_SIZE ] , float tweens[ 3 ][ INTERPOLATE_BATCH_SIZE ] , const Vec3 * positions , size_t numPositions ) const
+        {
+            ASSERT( numPositions <= INTERPOLATE_BATCH_SIZE ) ;
+            const float *   minCorner       = reinterpret_cast< const float * >( & GetMinCorner() ) ;
+            const float *   cellsPerExtent  = reinterpret_cast< const float * >( & GetCellsPerExtent() ) ;
+            float           coords[ 3 ][ INTERPOLATE_BATCH_SIZE ] ;
+            for( size_t lane = 0 ; lane < INTERPOLATE_BATCH_SIZE ; ++ lane )
+            {   // Transpose positions into structure-of-arrays form.
+                const Vec3 & position = ( lane < numPositions ) ? positions[ lane ] : GetMinCorner() ;
+                coords[ 0 ][ lane ] = position.x ;
+                coords[ 1 ][ lane ] = position.y ;
+                coords[ 2 ][ lane ] = position.z ;
+            }
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis...
+        #if UNIFORM_GRID_USE_SSE2
+                const __m128    cellCoords  = _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( coords[ axis ] ) , _mm_set1_ps( minCorner[ axis ] ) ) , _mm_set1_ps( cellsPerExtent[ axis ] ) ) ;
+                const __m128i   cellIndices = _mm_cvttps_epi32( cellCoords ) ;
+                _mm_storeu_si128( reinterpret_cast< __m128i * >( indices[ axis ] ) , cellIndices ) ;
+                _mm_storeu_ps( tweens[ axis ] , _mm_sub_ps( cellCoords , _mm_cvtepi32_ps( cellIndices ) ) ) ;
+        #else
+                for( size_t lane = 0 ; lane < INTERPOLATE_BATCH_SIZE ; ++ lane )
+                {   // For each position in batch...
+                    const float cellCoord   = ( coords[ axis ][ lane ] - minCorner[ axis ] ) * cellsPerExtent[ axis ] ;
+                    indices[ axis ][ lane ] = int( cellCoord ) ;
+                    tweens [ axis ][ lane ] = cellCoord - float( indices[ axis ][ lane ] ) ;
+                }
+        #endif
+            }
+        }
+
+        VECTOR< ItemT , FirstTouchAllocator< ItemT > >  mContents   ;   ///< 3D array of items.  Pages of large grids get spread across memory nodes in runs of z slabs.  See FirstTouchAllocator.
 } ;
 
 // Public variables --------------------------------------------------------------
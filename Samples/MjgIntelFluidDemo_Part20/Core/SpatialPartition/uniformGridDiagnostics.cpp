@@ -19,6 +19,7 @@
 
 #include "Core/SpatialPartition/uniformGrid.h"
 #include "Core/SpatialPartition/uniformGridMath.h"
+#include "Core/SpatialPartition/spectralPoissonSolver.h"
 
 
 DEBUG_ONLY( bool UniformGridGeometry::sInterpolating = false ) ;
@@ -845,3 +846,79 @@ void UnitTestPoisson2D( void )
     }
     PrintFunc2D( funcSolved , "TestData/funcSoln2.dat" ) ;
 }
+
+
+
+
+/** Return largest magnitude of difference between corresponding elements of two grids with the same shape.
+*/
+static float MaxDifferenceMagnitude( const UniformGrid<Vec3> & a , const UniformGrid<Vec3> & b )
+{
+    ASSERT( a.ShapeMatches( b ) ) ;
+    float maxDiffMag = 0.0f ;
+    for( size_t offset = 0 ; offset < a.Size() ; ++ offset )
+    {
+        maxDiffMag = Max2( maxDiffMag , ( a[ offset ] - b[ offset ] ).Magnitude() ) ;
+    }
+    return maxDiffMag ;
+}
+
+
+
+
+/** Check that multigrid Poisson solvers converge, to the same solution as the direct solver, and leave their inputs intact.
+*/
+void UnitTestVectorPoissonMultiGrid( void )
+{
+#if defined( _DEBUG )
+    static const float      residualTolerance   = 1.0e-4f ;
+    static const size_t     maxCycles           = 30 ;
+    static const unsigned   cycleIndex          = 1 ;   // V-cycle
+
+    UniformGridGeometry geometry ;
+    const unsigned numPoints[ 3 ] = { 33 , 33 , 33 } ;
+    geometry.DefineShapeFromPoints( Vec3( 0.0f , 0.0f , 0.0f ) , Vec3( 1.0f , 1.0f , 1.0f ) , numPoints ) ;
+
+    NestedGrid< Vec3 > lap( geometry ) ;
+    UniformGrid_AssignTestValues( lap[ 0 ] ) ;
+
+    // Populate a coarser layer of lap, to check that solvers leave it intact.
+    lap[ 1 ].DownSample( lap[ 0 ] , UniformGridGeometry::SLOWER_MORE_ACCURATE ) ;
+    UniformGrid< Vec3 > lapCoarseOriginal ;
+    lapCoarseOriginal = lap[ 1 ] ;
+
+    VectorPoissonMultiGridScratch scratch ;
+
+    {   // Dirichlet boundary conditions: compare with direct solver.
+        NestedGrid< Vec3 > soln( geometry ) ;   // Zero initial guess and boundary values.
+        Stats_Float residualStats ;
+        const size_t numCycles = SolveVectorPoissonMultiGrid( soln , lap , scratch , BC_DIRICHLET , residualTolerance , maxCycles , cycleIndex , /* warmStart */ false , residualStats ) ;
+        ASSERT( numCycles < maxCycles ) ;
+
+        UniformGrid< Vec3 > solnDirect( geometry ) ;
+        solnDirect.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+        SpectralPoissonSolver spectralPoissonSolver ;
+        spectralPoissonSolver.Solve( solnDirect , lap[ 0 ] , BC_DIRICHLET ) ;
+
+        float maxSolnMag = 0.0f ;
+        for( size_t offset = 0 ; offset < solnDirect.Size() ; ++ offset )
+        {
+            maxSolnMag = Max2( maxSolnMag , solnDirect[ offset ].Magnitude() ) ;
+        }
+        ASSERT( maxSolnMag > 0.0f ) ;
+        const float maxDiffMag = MaxDifferenceMagnitude( soln[ 0 ] , solnDirect ) ;
+        DebugPrintf( "UnitTestVectorPoissonMultiGrid: Dirichlet cycles=%u residual=%g maxDiff=%g maxSoln=%g\n" , unsigned( numCycles ) , residualStats.mMean , maxDiffMag , maxSolnMag ) ;
+        ASSERT( maxDiffMag <= 1.0e-2f * maxSolnMag ) ;
+    }
+
+    {   // Neumann boundary conditions, which need screening to have a unique solution.
+        NestedGrid< Vec3 > soln( geometry ) ;
+        Stats_Float residualStats ;
+        const size_t numCycles = SolveVectorScreenedPoissonMultiGrid( soln , lap , /* screening */ 10.0f , scratch , BC_NEUMANN , residualTolerance , maxCycles , cycleIndex , /* warmStart */ false , residualStats ) ;
+        DebugPrintf( "UnitTestVectorPoissonMultiGrid: Neumann cycles=%u residual=%g\n" , unsigned( numCycles ) , residualStats.mMean ) ;
+        ASSERT( numCycles < maxCycles ) ;
+    }
+
+    ASSERT( 0.0f == MaxDifferenceMagnitude( lap[ 1 ] , lapCoarseOriginal ) ) ;
+#endif
+}
@@ -9,6 +9,7 @@
 
 
 #include "uniformGridMath.h"
+#include "haloGrid.h"
 
 #include "Core/useTbb.h"
 #include "Core/Performance/perfBlock.h"
@@ -38,6 +39,17 @@
 /// Which Poisson technique to use.
 #define POISSON_TECHNIQUE                           POISSON_TECHNIQUE_GAUSS_SEIDEL_RED_BLACK
 
+/** Whether ComputeGradient, ComputeJacobian and ComputeLaplacian apply stencils to a HaloGrid copy of their input.
+
+    When enabled, those routines copy their input into a grid padded with
+    ghost gridpoints, extrapolated so that centered stencils at the boundary
+    yield the same one-sided stencils the boundary passes would, then run one
+    branch-free kernel over every gridpoint.  When disabled, they run
+    centered stencils over the interior, then separate, branchy passes over
+    the 6 faces.
+*/
+#define USE_HALO_FOR_BOUNDARY_STENCILS              1
+
 
 
 
@@ -78,60 +90,146 @@ enum GaussSeidelPortionE
 
 
 
-#if USE_TBB
-    static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , size_t izStart , size_t izEnd , GaussSeidelPortionE redOrBlack , BoundaryConditionE boundaryCondition , Stats_Float & residualStats ) ;
-    static void ComputeGradientInteriorSlice( UniformGrid< Vec3 > & gradient , const UniformGrid< float > & val , size_t izStart , size_t izEnd ) ;
-    unsigned gNumberOfProcessors = 8 ;  ///< Number of processors this machine has.  This will get reassigned later.
+/** Raw sums from which to compute statistics of residual magnitudes.
 
-    /** Function object to solve vector Poisson equation using Threading Building Blocks.
+    Each thread tallies residuals for its own subset of gridpoints,
+    then partial tallies combine into a total, as parallel_reduce requires.
+    That avoids multiple threads writing to a shared Stats_Float.
+
+    \note   Combining partial sums in a different order yields slightly
+            different results, so statistics tallied by parallel_reduce
+            are not deterministic, unless PARALLEL_DETERMINISTIC is enabled.
+            They suffice for judging convergence.
+*/
+struct ResidualTally
+{
+    ResidualTally() : mSum( 0.0f ) , mSum2( 0.0f ) , mMin( FLT_MAX ) , mMax( -FLT_MAX ) , mCount( 0 ) {}
+
+    /// Include the given residual in this tally.
+    void Accumulate( float residual )
+    {
+        mSum  += residual ;
+        mSum2 += Pow2( residual ) ;
+        mMin   = Min2( residual , mMin ) ;
+        mMax   = Max2( residual , mMax ) ;
+        ++ mCount ;
+    }
+
+    /// Include another tally, e.g. from another thread, in this tally.
+    void Merge( const ResidualTally & that )
+    {
+        mSum   += that.mSum ;
+        mSum2  += that.mSum2 ;
+        mMin    = Min2( that.mMin , mMin ) ;
+        mMax    = Max2( that.mMax , mMax ) ;
+        mCount += that.mCount ;
+    }
+
+    /// Compute statistics from this tally.
+    void Cook( Stats_Float & stats ) const
+    {
+        if( mCount != 0 )
+        {   // Residual raw stats were tallied.  Cook them.
+            stats.mMean           = mSum  / float( mCount ) ;
+            const float mean2     = mSum2 / float( mCount ) ;
+            const float variance  = Max2( mean2 - Pow2( stats.mMean ) , 0.0f ) ; // Roundoff can make variance slightly negative.
+            stats.mStdDev         = fsqrtf( variance ) ;
+            stats.mMin            = mMin ;
+            stats.mMax            = mMax ;
+        }
+        else
+        {
+            stats.mMean = stats.mStdDev = stats.mMin = stats.mMax = 0.0f ;
+        }
+    }
+
+    float   mSum    ;   ///< Sum of residuals
+    float   mSum2   ;   ///< Sum of residuals-squared
+    float   mMin    ;   ///< Smallest residual
+    float   mMax    ;   ///< Largest residual
+    size_t  mCount  ;   ///< Number of gridpoints involved in computing residual stats
+} ;
+
+
+
+
+    static void ComputeGradientInteriorSlice( UniformGrid< Vec3 > & gradient , const UniformGrid< float > & val , const size_t idxBegin[ 3 ] , const size_t idxEnd[ 3 ] ) ;
+
+    /** Function object to compute gradient of the interior of a grid, a tile at a time, possibly using Threading Building Blocks.
     */
-    class UniformGrid_StepTowardVectorPoissonSolution_TBB
+    class UniformGrid_ComputeGradientInterior_TBB
     {
-            UniformGrid< Vec3 > &       mSolution           ;   /// Reference to object containing solution
-            const UniformGrid< Vec3 > & mLaplacian          ;   /// Reference to object containing Laplacian
-            const GaussSeidelPortionE   mRedOrBlack         ;   /// Whether this pass operates on red or black portion of grid
-            const BoundaryConditionE    mBoundaryCondition  ;   /// Which kind of boundary condition to impose
-            Stats_Float &               mResidualStats      ;   /// Stats on residuals.  Not thread-safe when used with parallel_for.  Would need to use parallel_reduce to make thread-safe, parallel_invoke to make determinisitic.
+            UniformGrid< Vec3 > &           mGradient   ;   ///< Address of object containing gradient
+            const UniformGrid< float > &    mValues     ;   ///< Address of object containing scalar values
         public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of velocity grid.
+            void operator() ( const Parallel::Range3d & r ) const
+            {   // Compute subset of gradient grid.
                 SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
                 SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                ASSERT( mSolution.ShapeMatches( mLaplacian ) ) ;
-                StepTowardVectorPoissonSolution( mSolution , mLaplacian , r.begin() , r.end() , mRedOrBlack , mBoundaryCondition , mResidualStats ) ;
+                ASSERT( mGradient.ShapeMatches( mValues ) ) ;
+                const size_t begin[ 3 ] = { r.cols().begin() , r.rows().begin() , r.pages().begin() } ;
+                const size_t end  [ 3 ] = { r.cols().end()   , r.rows().end()   , r.pages().end()   } ;
+                ComputeGradientInteriorSlice( mGradient , mValues , begin , end ) ;
             }
-            UniformGrid_StepTowardVectorPoissonSolution_TBB( UniformGrid< Vec3 > & solution , const UniformGrid< Vec3 > & laplacian , GaussSeidelPortionE redOrBlack , BoundaryConditionE boundaryCondition , Stats_Float & residualStats )
-                : mSolution( solution ) , mLaplacian( laplacian ) , mRedOrBlack( redOrBlack ) , mBoundaryCondition( boundaryCondition ) , mResidualStats( residualStats )
+            UniformGrid_ComputeGradientInterior_TBB( UniformGrid< Vec3 > & gradient , const UniformGrid< float > & values )
+                : mGradient( gradient )
+                , mValues( values )
             {
                 mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
                 mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
             }
         private:
+            UniformGrid_ComputeGradientInterior_TBB & operator=( const UniformGrid_ComputeGradientInterior_TBB & ) ; // Disallow assignment
+
             WORD        mMasterThreadFloatingPointControlWord   ;
             unsigned    mMasterThreadMmxControlStatusRegister   ;
     } ;
 
-    /** Function object to compute gradient of the interior of a grid, using Threading Building Blocks.
+    unsigned gNumberOfProcessors = 8 ;  ///< Number of processors this machine has.  This will get reassigned later.
+
+#if USE_TBB
+    static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , float screening , size_t izStart , size_t izEnd , GaussSeidelPortionE redOrBlack , float relax , BoundaryConditionE boundaryCondition , ResidualTally & residualTally ) ;
+
+    /** Function object to solve vector Poisson equation using Threading Building Blocks.
+
+        Use with parallel_reduce, which tallies residuals per thread then joins tallies.
     */
-    class UniformGrid_ComputeGradientInterior_TBB
+    class UniformGrid_StepTowardVectorPoissonSolution_TBB
     {
-            UniformGrid< Vec3 > &           mGradient   ;   ///< Address of object containing gradient
-            const UniformGrid< float > &    mValues     ;   ///< Address of object containing scalar values
+            UniformGrid< Vec3 > &       mSolution           ;   /// Reference to object containing solution
+            const UniformGrid< Vec3 > & mLaplacian          ;   /// Reference to object containing Laplacian
+            const float                 mScreening          ;   /// Screening coefficient; see StepTowardVectorPoissonSolution
+            const GaussSeidelPortionE   mRedOrBlack         ;   /// Whether this pass operates on red or black portion of grid
+            const float                 mRelax              ;   /// Successive over-relaxation parameter
+            const BoundaryConditionE    mBoundaryCondition  ;   /// Which kind of boundary condition to impose
         public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of gradient grid.
+            void operator() ( const tbb::blocked_range<size_t> & r )
+            {   // Compute subset of velocity grid.
                 SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
                 SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                ASSERT( mGradient.ShapeMatches( mValues ) ) ;
-                ComputeGradientInteriorSlice( mGradient , mValues , r.begin() , r.end() ) ;
+                ASSERT( mSolution.ShapeMatches( mLaplacian ) ) ;
+                StepTowardVectorPoissonSolution( mSolution , mLaplacian , mScreening , r.begin() , r.end() , mRedOrBlack , mRelax , mBoundaryCondition , mResidualTally ) ;
             }
-            UniformGrid_ComputeGradientInterior_TBB( UniformGrid< Vec3 > & gradient , const UniformGrid< float > & values )
-                : mGradient( gradient )
-                , mValues( values )
+            UniformGrid_StepTowardVectorPoissonSolution_TBB( UniformGrid< Vec3 > & solution , const UniformGrid< Vec3 > & laplacian , float screening , GaussSeidelPortionE redOrBlack , float relax , BoundaryConditionE boundaryCondition )
+                : mSolution( solution ) , mLaplacian( laplacian ) , mScreening( screening ) , mRedOrBlack( redOrBlack ) , mRelax( relax ) , mBoundaryCondition( boundaryCondition )
             {
                 mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
                 mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
             }
+            /// Splitting copy constructor used by TBB parallel_reduce.  Each split starts with an empty tally.
+            UniformGrid_StepTowardVectorPoissonSolution_TBB( UniformGrid_StepTowardVectorPoissonSolution_TBB & that , tbb::split )
+                : mSolution( that.mSolution ) , mLaplacian( that.mLaplacian ) , mScreening( that.mScreening ) , mRedOrBlack( that.mRedOrBlack ) , mRelax( that.mRelax ) , mBoundaryCondition( that.mBoundaryCondition )
+                , mMasterThreadFloatingPointControlWord( that.mMasterThreadFloatingPointControlWord )
+                , mMasterThreadMmxControlStatusRegister( that.mMasterThreadMmxControlStatusRegister )
+            {
+            }
+            /// Join the residual tallies of two threads spawned by parallel_reduce.
+            void join( const UniformGrid_StepTowardVectorPoissonSolution_TBB & other )
+            {
+                mResidualTally.Merge( other.mResidualTally ) ;
+            }
+
+            ResidualTally               mResidualTally      ;   /// Tally of residuals at gridpoints visited by this thread
         private:
             WORD        mMasterThreadFloatingPointControlWord   ;
             unsigned    mMasterThreadMmxControlStatusRegister   ;
@@ -195,6 +293,138 @@ enum GaussSeidelPortionE
 
 
 
+#if USE_HALO_FOR_BOUNDARY_STENCILS
+
+/** Centered-difference gradient of a scalar field.  See ApplyStencilWithHalo.
+*/
+struct GradientStencil
+{
+    typedef float   ValueT  ;
+    typedef Vec3    ResultT ;
+    static Vec3 Apply( const float * v , ptrdiff_t strideY , ptrdiff_t strideZ , const Vec3 & halfReciprocalSpacing )
+    {
+        return Vec3(    ( v[ 1       ] - v[ - 1       ] ) * halfReciprocalSpacing.x
+                    ,   ( v[ strideY ] - v[ - strideY ] ) * halfReciprocalSpacing.y
+                    ,   ( v[ strideZ ] - v[ - strideZ ] ) * halfReciprocalSpacing.z ) ;
+    }
+} ;
+
+
+
+
+/** Centered-difference Jacobian of a vector field.  See ApplyStencilWithHalo.
+*/
+struct JacobianStencil
+{
+    typedef Vec3    ValueT  ;
+    typedef Mat33   ResultT ;
+    static Mat33 Apply( const Vec3 * v , ptrdiff_t strideY , ptrdiff_t strideZ , const Vec3 & halfReciprocalSpacing )
+    {
+        Mat33 jacobian ;
+        jacobian.x = ( v[ 1       ] - v[ - 1       ] ) * halfReciprocalSpacing.x ;
+        jacobian.y = ( v[ strideY ] - v[ - strideY ] ) * halfReciprocalSpacing.y ;
+        jacobian.z = ( v[ strideZ ] - v[ - strideZ ] ) * halfReciprocalSpacing.z ;
+        return jacobian ;
+    }
+} ;
+
+
+
+
+/** 7-point Laplacian of a vector field.  See ApplyStencilWithHalo.
+*/
+struct LaplacianStencil
+{
+    typedef Vec3    ValueT  ;
+    typedef Vec3    ResultT ;
+    static Vec3 Apply( const Vec3 * v , ptrdiff_t strideY , ptrdiff_t strideZ , const Vec3 & reciprocalSpacing2 )
+    {
+        const Vec3 twiceCenter = 2.0f * v[ 0 ] ;
+        return  ( v[ 1       ] + v[ - 1       ] - twiceCenter ) * reciprocalSpacing2.x
+            +   ( v[ strideY ] + v[ - strideY ] - twiceCenter ) * reciprocalSpacing2.y
+            +   ( v[ strideZ ] + v[ - strideZ ] - twiceCenter ) * reciprocalSpacing2.z ;
+    }
+} ;
+
+
+
+
+/** Apply a stencil to a tile of gridpoints of a HaloGrid.
+
+    \param result - (output) UniformGrid of stencil results.
+
+    \param halo - Values to apply stencil to, with ghost gridpoints filled.
+
+    \param scale - Per-axis factors to pass to StencilT::Apply, e.g. reciprocal spacing.
+
+    \param r - Tile of gridpoints to compute.
+
+    The loop along x has no branches, since ghost gridpoints supply every neighbor.
+*/
+template< class StencilT > static void ApplyStencilWithHaloSlice( UniformGrid< typename StencilT::ResultT > & result , const HaloGrid< typename StencilT::ValueT > & halo , const Vec3 & scale , const Parallel::Range3d & r )
+{
+    const size_t idxBegin[ 3 ] = { r.cols().begin() , r.rows().begin() , r.pages().begin() } ;
+    const size_t idxEnd  [ 3 ] = { r.cols().end()   , r.rows().end()   , r.pages().end()   } ;
+    typedef typename StencilT::ValueT   ValueT  ;
+    typedef typename StencilT::ResultT  ResultT ;
+
+    ASSERT( result.ShapeMatches( halo ) ) ;
+
+    const ptrdiff_t strideY = ptrdiff_t( halo.GetStride( 1 ) ) ;
+    const ptrdiff_t strideZ = ptrdiff_t( halo.GetStride( 2 ) ) ;
+
+    for( size_t iz = idxBegin[ 2 ] ; iz < idxEnd[ 2 ] ; ++ iz )
+    {
+        for( size_t iy = idxBegin[ 1 ] ; iy < idxEnd[ 1 ] ; ++ iy )
+        {
+            const ValueT *  src = & halo[ halo.OffsetFromIndices( 0 , ptrdiff_t( iy ) , ptrdiff_t( iz ) ) ] ;
+            ResultT *       dst = & result[ result.OffsetFromIndices( 0 , iy , iz ) ] ;
+            for( size_t ix = idxBegin[ 0 ] ; ix < idxEnd[ 0 ] ; ++ ix )
+            {
+                dst[ ix ] = StencilT::Apply( src + ix , strideY , strideZ , scale ) ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Apply a stencil to every gridpoint of a grid, using ghost gridpoints instead of boundary passes.
+
+    \param result - (output) UniformGrid of stencil results.  Must have the same shape as values, and be allocated.
+
+    \param values - UniformGrid of values to apply stencil to.
+
+    \param fill - How to extrapolate ghost gridpoints.  Choose the rule
+        that makes the centered stencil yield the desired one-sided stencil:
+        HALO_FILL_LINEAR for first derivatives, HALO_FILL_QUADRATIC for second.
+
+    \param scale - Per-axis factors to pass to StencilT::Apply.
+
+    This costs one extra pass to copy values, but then every gridpoint runs
+    the same branch-free stencil, in parallel tiles.
+*/
+template< class StencilT > static void ApplyStencilWithHalo( UniformGrid< typename StencilT::ResultT > & result , const UniformGrid< typename StencilT::ValueT > & values , typename HaloGrid< typename StencilT::ValueT >::HaloFillE fill , const Vec3 & scale )
+{
+    ASSERT( result.ShapeMatches( values ) ) ;
+    ASSERT( result.Size() == result.GetGridCapacity() ) ;
+
+    HaloGrid< typename StencilT::ValueT > halo ;
+    halo.CopyFrom( values , fill ) ;
+
+    const size_t    begin[ 3 ]      = { 0 , 0 , 0 } ;
+    const size_t    end[ 3 ]        = { values.GetNumPoints( 0 ) , values.GetNumPoints( 1 ) , values.GetNumPoints( 2 ) } ;
+    size_t          tileShape[ 3 ]  ;
+    values.ComputeTileShape( tileShape , sizeof( typename StencilT::ValueT ) + sizeof( typename StencilT::ResultT ) ) ;
+    Parallel::ForTiles( begin , end , tileShape , Parallel::Function( ApplyStencilWithHaloSlice< StencilT > , result , halo , scale ) ) ;
+}
+
+#endif // USE_HALO_FOR_BOUNDARY_STENCILS
+
+
+
+
 /** Compute curl of a vector field, from its Jacobian.
 
     \param curl - (output) UniformGrid of 3-vector values.
@@ -312,6 +542,10 @@ void ComputeJacobian( UniformGrid< Mat33 > & jacobian , const UniformGrid< Vec3
     // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
     const Vec3      reciprocalSpacing( 1.0f / spacing.x , 1.0f / spacing.y , spacing.z > FLT_EPSILON ? 1.0f / spacing.z : 0.0f ) ;
     const Vec3      halfReciprocalSpacing( 0.5f * reciprocalSpacing ) ;
+#if USE_HALO_FOR_BOUNDARY_STENCILS
+    // Linear extrapolation into ghosts turns centered differences at boundaries into one-sided differences.
+    ApplyStencilWithHalo< JacobianStencil >( jacobian , vec , HaloGrid< Vec3 >::HALO_FILL_LINEAR , halfReciprocalSpacing ) ;
+#else
     const size_t    dims[3]                 = { vec.GetNumPoints( 0 )   , vec.GetNumPoints( 1 )   , vec.GetNumPoints( 2 )   } ;
     const size_t    dimsMinus1[3]           = { vec.GetNumPoints( 0 )-1 , vec.GetNumPoints( 1 )-1 , vec.GetNumPoints( 2 )-1 } ;
     const size_t    numXY                   = dims[0] * dims[1] ;
@@ -448,6 +682,186 @@ void ComputeJacobian( UniformGrid< Mat33 > & jacobian , const UniformGrid< Vec3
         }
     }
 #undef COMPUTE_FINITE_PARTIAL_DIFFERENTIALS_AT_BOUNDARIES
+#endif
+}
+
+
+
+
+/** Quantity derived from the Jacobian of a vector field: its curl.  See ComputeDerivedFromJacobianSlice.
+*/
+struct DeriveCurl
+{
+    typedef Vec3 ResultT ;
+    static Vec3 FromJacobian( const Mat33 & j )
+    {   // Meaning of j.i.k is the derivative of the kth component with respect to i, i.e. di/dk.
+        return Vec3( j.y.z - j.z.y , j.z.x - j.x.z , j.x.y - j.y.x ) ;
+    }
+} ;
+
+
+
+
+/** Quantity derived from the Jacobian of a vector field: its divergence.  See ComputeDerivedFromJacobianSlice.
+*/
+struct DeriveDivergence
+{
+    typedef float ResultT ;
+    static float FromJacobian( const Mat33 & j )
+    {
+        return j.x.x + j.y.y + j.z.z ;
+    }
+} ;
+
+
+
+
+/** Compute a quantity derived from the Jacobian of a vector field, for a tile of gridpoints, without storing the Jacobian.
+
+    \param result - (output) UniformGrid of derived values.
+
+    \param vec - UniformGrid of 3-vector values.
+
+    \param r - Tile of gridpoints to compute.
+
+    DeriveT::FromJacobian maps the Jacobian at a gridpoint, computed exactly as
+    ComputeJacobian would, to the derived quantity.  The Jacobian only lives
+    in registers, so this reads the vector field and writes the result in a
+    single pass, instead of writing, then reading, a UniformGrid< Mat33 >,
+    which costs 36 bytes per gridpoint.
+
+    Each row chooses its y and z stencils (centered inside, one-sided on
+    boundaries) once, so the loop along x has no branches except at its ends.
+    Each tile only reads its own gridpoints plus one layer each side, so it
+    reuses rows and planes while they remain in cache.
+*/
+template< class DeriveT > static void ComputeDerivedFromJacobianSlice( UniformGrid< typename DeriveT::ResultT > & result , const UniformGrid< Vec3 > & vec , const Parallel::Range3d & r )
+{
+    const size_t    idxBegin[ 3 ]           = { r.cols().begin() , r.rows().begin() , r.pages().begin() } ;
+    const size_t    idxEnd  [ 3 ]           = { r.cols().end()   , r.rows().end()   , r.pages().end()   } ;
+    const Vec3      spacing                 = vec.GetCellSpacing() ;
+    // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
+    const Vec3      reciprocalSpacing( 1.0f / spacing.x , 1.0f / spacing.y , spacing.z > FLT_EPSILON ? 1.0f / spacing.z : 0.0f ) ;
+    const Vec3      halfReciprocalSpacing( 0.5f * reciprocalSpacing ) ;
+    const size_t    dims[3]                 = { vec.GetNumPoints( 0 )   , vec.GetNumPoints( 1 )   , vec.GetNumPoints( 2 )   } ;
+    const size_t    dimsMinus1[3]           = { vec.GetNumPoints( 0 )-1 , vec.GetNumPoints( 1 )-1 , vec.GetNumPoints( 2 )-1 } ;
+    const size_t    numXY                   = dims[0] * dims[1] ;
+    size_t          index[3] ;
+
+    ASSERT( result.ShapeMatches( vec ) ) ;
+    ASSERT( ( idxBegin[0] < idxEnd[0] ) && ( idxBegin[1] < idxEnd[1] ) && ( idxBegin[2] < idxEnd[2] ) ) ;
+    ASSERT( ( idxEnd[0] <= dims[0] ) && ( idxEnd[1] <= dims[1] ) && ( idxEnd[2] <= dims[2] ) ) ;
+    ASSERT( dims[0] > 1 ) ; // Stencils along y and z degenerate gracefully to zero for a single layer, but the stencil along x does not.
+
+    const size_t    ixInteriorBegin         = Max2( size_t( 1 ) , idxBegin[0] ) ;
+    const size_t    ixInteriorEnd           = Min2( dimsMinus1[0] , idxEnd[0] ) ;
+
+    for( index[2] = idxBegin[2] ; index[2] < idxEnd[2] ; ++ index[2] )
+    {
+        // Choose z stencil for this layer: one-sided at boundaries, otherwise centered.
+        const size_t    offsetZLo   = numXY * ( ( index[2] == 0             ) ? index[2] : index[2] - 1 ) ;
+        const size_t    offsetZHi   = numXY * ( ( index[2] == dimsMinus1[2] ) ? index[2] : index[2] + 1 ) ;
+        const float     scaleZ      = ( ( index[2] == 0 ) || ( index[2] == dimsMinus1[2] ) ) ? reciprocalSpacing.z : halfReciprocalSpacing.z ;
+        const size_t    offsetZ0    = numXY * index[2] ;
+        for( index[1] = idxBegin[1] ; index[1] < idxEnd[1] ; ++ index[1] )
+        {
+            // Choose y stencil for this row: one-sided at boundaries, otherwise centered.
+            const size_t    offsetY0Z0  = dims[0] * index[1] + offsetZ0 ;
+            const size_t    offsetYLoZ0 = dims[0] * ( ( index[1] == 0             ) ? index[1] : index[1] - 1 ) + offsetZ0 ;
+            const size_t    offsetYHiZ0 = dims[0] * ( ( index[1] == dimsMinus1[1] ) ? index[1] : index[1] + 1 ) + offsetZ0 ;
+            const float     scaleY      = ( ( index[1] == 0 ) || ( index[1] == dimsMinus1[1] ) ) ? reciprocalSpacing.y : halfReciprocalSpacing.y ;
+            const size_t    offsetY0ZLo = dims[0] * index[1] + offsetZLo ;
+            const size_t    offsetY0ZHi = dims[0] * index[1] + offsetZHi ;
+            Mat33           jacobian ;
+
+            #define COMPUTE_YZ_DERIVATIVES_AND_STORE                                                                \
+                jacobian.y = ( vec[ index[0] + offsetYHiZ0 ] - vec[ index[0] + offsetYLoZ0 ] ) * scaleY ;       \
+                jacobian.z = ( vec[ index[0] + offsetY0ZHi ] - vec[ index[0] + offsetY0ZLo ] ) * scaleZ ;       \
+                result[ index[0] + offsetY0Z0 ] = DeriveT::FromJacobian( jacobian ) ;
+
+            if( 0 == idxBegin[0] )
+            {   // Compute derivatives at -X boundary.
+                index[0] = 0 ;
+                jacobian.x = ( vec[ offsetY0Z0 + 1 ] - vec[ offsetY0Z0 ] ) * reciprocalSpacing.x ;
+                COMPUTE_YZ_DERIVATIVES_AND_STORE ;
+            }
+
+            // Compute derivatives for interior of row.
+            for( index[0] = ixInteriorBegin ; index[0] < ixInteriorEnd ; ++ index[0] )
+            {
+                const size_t offsetX0Y0Z0 = index[0] + offsetY0Z0 ;
+                jacobian.x = ( vec[ offsetX0Y0Z0 + 1 ] - vec[ offsetX0Y0Z0 - 1 ] ) * halfReciprocalSpacing.x ;
+                COMPUTE_YZ_DERIVATIVES_AND_STORE ;
+            }
+
+            if( dims[0] == idxEnd[0] )
+            {   // Compute derivatives at +X boundary.
+                index[0] = dimsMinus1[0] ;
+                jacobian.x = ( vec[ index[0] + offsetY0Z0 ] - vec[ index[0] + offsetY0Z0 - 1 ] ) * reciprocalSpacing.x ;
+                COMPUTE_YZ_DERIVATIVES_AND_STORE ;
+            }
+
+            #undef COMPUTE_YZ_DERIVATIVES_AND_STORE
+        }
+    }
+}
+
+
+
+
+/** Compute a quantity derived from the Jacobian of a vector field, for every gridpoint.
+
+    \see ComputeDerivedFromJacobianSlice.
+*/
+template< class DeriveT > static void ComputeDerivedFromJacobian( UniformGrid< typename DeriveT::ResultT > & result , const UniformGrid< Vec3 > & vec )
+{
+    ASSERT( result.ShapeMatches( vec ) ) ;
+    ASSERT( result.Size() == result.GetGridCapacity() ) ;
+
+    const size_t    begin[ 3 ]      = { 0 , 0 , 0 } ;
+    const size_t    end[ 3 ]        = { vec.GetNumPoints( 0 ) , vec.GetNumPoints( 1 ) , vec.GetNumPoints( 2 ) } ;
+    size_t          tileShape[ 3 ]  ;
+    vec.ComputeTileShape( tileShape , sizeof( Vec3 ) + sizeof( typename DeriveT::ResultT ) ) ;
+    Parallel::ForTiles( begin , end , tileShape , Parallel::Function( ComputeDerivedFromJacobianSlice< DeriveT > , result , vec ) ) ;
+}
+
+
+
+
+/** Compute curl of a vector field, directly, without storing its Jacobian.
+
+    \param curl - (output) UniformGrid of 3-vector values.
+
+    \param vec - UniformGrid of 3-vector values.
+
+    This yields the same result as ComputeJacobian followed by
+    ComputeCurlFromJacobian, in one pass, without a UniformGrid< Mat33 >.
+
+*/
+void ComputeCurl( UniformGrid< Vec3 > & curl , const UniformGrid< Vec3 > & vec )
+{
+    PERF_BLOCK( ComputeCurl ) ;
+
+    ComputeDerivedFromJacobian< DeriveCurl >( curl , vec ) ;
+}
+
+
+
+
+/** Compute divergence of a vector field, directly, without storing its Jacobian.
+
+    \param divergence - (output) UniformGrid of scalar values.
+
+    \param vec - UniformGrid of 3-vector values.
+
+    This yields the trace of the matrix ComputeJacobian would compute.
+
+*/
+void ComputeDivergence( UniformGrid< float > & divergence , const UniformGrid< Vec3 > & vec )
+{
+    PERF_BLOCK( ComputeDivergence ) ;
+
+    ComputeDerivedFromJacobian< DeriveDivergence >( divergence , vec ) ;
 }
 
 
@@ -465,7 +879,7 @@ void ComputeJacobian( UniformGrid< Mat33 > & jacobian , const UniformGrid< Vec3
     \param val - UniformGrid of scalar values
 
 */
-static void ComputeGradientInteriorSlice( UniformGrid< Vec3 > & gradientGrid , const UniformGrid< float > & val , size_t izStart , size_t izEnd )
+static void ComputeGradientInteriorSlice( UniformGrid< Vec3 > & gradientGrid , const UniformGrid< float > & val , const size_t idxBegin[ 3 ] , const size_t idxEnd[ 3 ] )
 {
     const Vec3      spacing                 = val.GetCellSpacing() ;
     // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
@@ -476,17 +890,17 @@ static void ComputeGradientInteriorSlice( UniformGrid< Vec3 > & gradientGrid , c
     const size_t    numXY                   = dims[0] * dims[1] ;
     size_t          index[3] ;
 
-    ASSERT( izStart <= izEnd ) ;
-    ASSERT( izEnd   <= dimsMinus1[2] ) ;
+    ASSERT( ( idxBegin[0] >= 1 ) && ( idxBegin[1] >= 1 ) && ( idxBegin[2] >= 1 ) ) ;
+    ASSERT( ( idxEnd[0] <= dimsMinus1[0] ) && ( idxEnd[1] <= dimsMinus1[1] ) && ( idxEnd[2] <= dimsMinus1[2] ) ) ;
 
     // Compute derivatives for interior (i.e. away from boundaries).
-    for( index[2] = izStart ; index[2] < izEnd ; ++ index[2] )
+    for( index[2] = idxBegin[2] ; index[2] < idxEnd[2] ; ++ index[2] )
     {
         ASSIGN_Z_OFFSETS ;
-        for( index[1] = 1 ; index[1] < dimsMinus1[1] ; ++ index[1] )
+        for( index[1] = idxBegin[1] ; index[1] < idxEnd[1] ; ++ index[1] )
         {
             ASSIGN_YZ_OFFSETS ;
-            for( index[0] = 1 ; index[0] < dimsMinus1[0] ; ++ index[0] )
+            for( index[0] = idxBegin[0] ; index[0] < idxEnd[0] ; ++ index[0] )
             {
                 ASSIGN_XYZ_OFFSETS ;
 
@@ -656,22 +1070,22 @@ void ComputeGradient( UniformGrid< Vec3 > & gradientGrid , const UniformGrid< fl
     // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
     const Vec3      reciprocalSpacing( 1.0f / spacing.x , 1.0f / spacing.y , spacing.z > FLT_EPSILON ? 1.0f / spacing.z : 0.0f ) ;
     const Vec3      halfReciprocalSpacing( 0.5f * reciprocalSpacing ) ;
+#if USE_HALO_FOR_BOUNDARY_STENCILS
+    // Linear extrapolation into ghosts turns centered differences at boundaries into one-sided differences.
+    ApplyStencilWithHalo< GradientStencil >( gradientGrid , scalarVals , HaloGrid< float >::HALO_FILL_LINEAR , halfReciprocalSpacing ) ;
+#else
     const size_t    dims[3]                 = { scalarVals.GetNumPoints( 0 )   , scalarVals.GetNumPoints( 1 )   , scalarVals.GetNumPoints( 2 )   } ;
     const size_t    dimsMinus1[3]           = { scalarVals.GetNumPoints( 0 )-1 , scalarVals.GetNumPoints( 1 )-1 , scalarVals.GetNumPoints( 2 )-1 } ;
     const size_t    numXY                   = dims[0] * dims[1] ;
     size_t          index[3] ;
 
     // Compute derivatives for interior (i.e. away from boundaries).
-    #if USE_TBB
-        {
-            const size_t numZ = dimsMinus1[2] - 1 ;
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
-            parallel_for( tbb::blocked_range<size_t>( 1 , dimsMinus1[2] , grainSize ) , UniformGrid_ComputeGradientInterior_TBB( gradientGrid , scalarVals ) ) ;
-        }
-    #else
-        ComputeGradientInteriorSlice( gradientGrid , scalarVals , 1 , dimsMinus1[2] ) ;
-    #endif
+    {
+        const size_t    interiorBegin[ 3 ]  = { 1 , 1 , 1 } ;
+        size_t          tileShape[ 3 ]      ;
+        scalarVals.ComputeTileShape( tileShape , sizeof( float ) + sizeof( Vec3 ) ) ;
+        Parallel::ForTiles( interiorBegin , dimsMinus1 , tileShape , UniformGrid_ComputeGradientInterior_TBB( gradientGrid , scalarVals ) ) ;
+    }
 
     // Compute derivatives for boundaries: 6 faces of box.
     // In some situations, these macros compute extraneous data.
@@ -780,6 +1194,7 @@ void ComputeGradient( UniformGrid< Vec3 > & gradientGrid , const UniformGrid< fl
         }
     }
 #undef COMPUTE_FINITE_PARTIAL_DIFFERENTIALS_AT_BOUNDARIES
+#endif
 }
 
 
@@ -914,6 +1329,11 @@ void ComputeLaplacian( UniformGrid< Vec3 > & laplacian , const UniformGrid< Vec3
     // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
     const Vec3      reciprocalSpacing( 1.0f / spacing.x , 1.0f / spacing.y , spacing.z > FLT_EPSILON ? 1.0f / spacing.z : 0.0f ) ;
     const Vec3      reciprocalSpacing2( POW2( reciprocalSpacing.x ) , POW2( reciprocalSpacing.y ) , POW2( reciprocalSpacing.z ) ) ;
+#if USE_HALO_FOR_BOUNDARY_STENCILS
+    // Quadratic extrapolation into ghosts turns the centered second difference at each boundary gridpoint
+    // into the second difference at its interior neighbor, which is what the boundary passes compute.
+    ApplyStencilWithHalo< LaplacianStencil >( laplacian , vec , HaloGrid< Vec3 >::HALO_FILL_QUADRATIC , reciprocalSpacing2 ) ;
+#else
     const size_t    dims[3]                 = { vec.GetNumPoints( 0 )   , vec.GetNumPoints( 1 )   , vec.GetNumPoints( 2 )   } ;
     const size_t    dimsMinus1[3]           = { vec.GetNumPoints( 0 )-1 , vec.GetNumPoints( 1 )-1 , vec.GetNumPoints( 2 )-1 } ;
     const size_t    numXY                   = dims[0] * dims[1] ;
@@ -1055,6 +1475,7 @@ void ComputeLaplacian( UniformGrid< Vec3 > & laplacian , const UniformGrid< Vec3
             }
         }
     }
+#endif
 }
 
 
@@ -1079,9 +1500,10 @@ void ComputeLaplacian( UniformGrid< Vec3 > & laplacian , const UniformGrid< Vec3
 
 /** Make one step toward solving the discretized vector Poisson equation.
 
-    This routine takes a step toward solving the discretized form of the Poisson equation,
-        D soln = lap ,
-    where D is the Laplacian partial differential operator.
+    This routine takes a step toward solving the discretized form of the screened Poisson equation,
+        D soln - screening soln = lap ,
+    where D is the Laplacian partial differential operator.  When screening is zero,
+    that is the ordinary Poisson equation.
 
     This routine uses a finite difference representation of the Laplacian operator,
     and uses the Gauss-Seidel method, augmented with successive over-relaxation,
@@ -1098,6 +1520,9 @@ void ComputeLaplacian( UniformGrid< Vec3 > & laplacian , const UniformGrid< Vec3
 
     \param lap - (input) UniformGrid of 3-vector values.
 
+    \param screening - Non-negative coefficient of the screening term.  Positive values make the
+                    equation diagonally dominant, so each step converges faster.
+
     \param izStart - starting value for z index
 
     \param izEnd - one past final value for z index
@@ -1110,55 +1535,63 @@ void ComputeLaplacian( UniformGrid< Vec3 > & laplacian , const UniformGrid< Vec3
 
                     red squares start at (0,0).
 
+    \param relax - Successive over-relaxation parameter, in [1,2).  1 yields canonical Gauss-Seidel.
+
+    \param residualTally - (in/out) tally into which to accumulate magnitudes of changes this step makes to interior gridpoints.
+
     \see ComputeJacobian.
 
 */
-static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , size_t izStart , size_t izEnd , GaussSeidelPortionE redOrBlack , BoundaryConditionE boundaryCondition , Stats_Float & residualStats )
+static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , float screening , size_t izStart , size_t izEnd , GaussSeidelPortionE redOrBlack , float relax , BoundaryConditionE boundaryCondition , ResidualTally & residualTally )
 {
     ASSERT( soln.Size() == soln.GetGridCapacity() ) ;
     ASSERT( izStart <  lap.GetNumPoints( 2 )    ) ;
     ASSERT( izEnd   <= lap.GetNumPoints( 2 )    ) ;
     ASSERT( ( redOrBlack >= GS_MIN ) && ( redOrBlack < GS_NUM ) ) ;
+    ASSERT( screening >= 0.0f ) ;
 
     const Vec3      spacing                 = lap.GetCellSpacing() ;
     // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
     const Vec3      reciprocalSpacing( 1.0f / spacing.x , 1.0f / spacing.y , spacing.z > FLT_EPSILON ? 1.0f / spacing.z : 0.0f ) ;
     const Vec3      reciprocalSpacing2( POW2( reciprocalSpacing.x ) , POW2( reciprocalSpacing.y ) , POW2( reciprocalSpacing.z ) ) ;
-    const float     HalfSpacing2Sum         = 0.5f / ( reciprocalSpacing2.x + reciprocalSpacing2.y + reciprocalSpacing2.z ) ;
+    const float     reciprocalDiagonal      = 1.0f / ( 2.0f * ( reciprocalSpacing2.x + reciprocalSpacing2.y + reciprocalSpacing2.z ) + screening ) ;
     const size_t    dims[3]                 = { lap.GetNumPoints( 0 )   , lap.GetNumPoints( 1 )   , lap.GetNumPoints( 2 )   } ;
     const size_t    dimsMinus1[3]           = { lap.GetNumPoints( 0 )-1 , lap.GetNumPoints( 1 )-1 , lap.GetNumPoints( 2 )-1 } ;
     const size_t    numXY                   = dims[0] * dims[1] ;
 
-    // Note: Setting "relax" to 1 would yield the canonical Gauss-Seidel algorithm.
-
-    // Experiment: Approximate optimal relaxation parameter.
-    //const float     relax                   = 2.0f / ( 1.0f + sin( PI / float( MAX3( dims[0] , dims[1] , dims[2] ) ) ) ) ;
-
-    // MJG emperically determined relax using non-MultiGrid on a vortex ring with dims=32^3 advancing from t=0 to t=3.3e-5. Minimum residual occurred with relax in [1.72,1.74].
-    // relax=1.25 had nearly same residual as relax=1.  Halved for relax=1.5. Dropped to 1/100 of that going to relax=1.73.  Doubled from there for relax=1.75.
-    const float     relax                   = 1.72f ;
     const float     oneMinusRelax           = 1.0f - relax ;
     ASSERT( relax >= 1.0f ) ;
     ASSERT( relax <  2.0f ) ;
 
-    residualStats.mMean = 0.0f ; // Also temporarily used to store sum of residuals
-    residualStats.mStdDev = 0.0f ; // Also temporarily used to store sum of residuals-squared
-    residualStats.mMin =  FLT_MAX ;
-    residualStats.mMax = -FLT_MAX ;
-    unsigned residualsCount = 0 ; // number of gridpoints involved in computing residual stats
-
     // To make this routine work in red-black mode, the index range for the interior depends on redOrBlack.
     const size_t    idxZMinInterior         = Max2( size_t( 1 )   , izStart ) ;
     const size_t    idxZMaxInterior         = Min2( dimsMinus1[2] , izEnd   ) ;
     const size_t    iyStep                  = ( GS_BOTH == redOrBlack ) ? 1 : 2 ;
     size_t          index[3] ;
 
+    // Visit interior in tiles of whole rows, so each tile reuses neighboring rows and planes while they remain in cache.
+    // Within a red or black pass, each update reads only gridpoints of the other color, so visiting order does not affect results.
+    // Plain Gauss-Seidel reads values it updated earlier in the same pass, so in that case, keep the canonical order.
+    size_t          tileShape[ 3 ]          ;
+    lap.ComputeTileShape( tileShape , 2 * sizeof( Vec3 ) ) ;
+    if( GS_BOTH == redOrBlack )
     {
+        tileShape[ 1 ] = dims[ 1 ] ;
+        tileShape[ 2 ] = dims[ 2 ] ;
+    }
+
+    for( size_t izTile = idxZMinInterior ; izTile < idxZMaxInterior ; izTile += tileShape[ 2 ] )
+    for( size_t iyTile = 1 ; iyTile < dimsMinus1[1] ; iyTile += tileShape[ 1 ] )
+    {   // For each tile in interior of this slab...
+        const size_t izTileEnd = Min2( izTile + tileShape[ 2 ] , idxZMaxInterior ) ;
+        const size_t iyTileEnd = Min2( iyTile + tileShape[ 1 ] , dimsMinus1[1]   ) ;
         // Solve equation for interior (i.e. away from boundaries).
-        for( index[2] = idxZMinInterior ; index[2] < idxZMaxInterior ; ++ index[2] )
+        for( index[2] = izTile ; index[2] < izTileEnd ; ++ index[2] )
         {
             ASSIGN_Z_OFFSETS_AND_Y_SHIFT ;
-            for( index[1] = 1 + idxYShift ; index[1] < dimsMinus1[1] ; index[1] += iyStep )
+            // First row of this tile with the color of this pass.
+            const size_t iyBegin = iyTile + ( ( iyTile + 1 + idxYShift ) % 2 ) * ( iyStep - 1 ) ;
+            for( index[1] = iyBegin ; index[1] < iyTileEnd ; index[1] += iyStep )
             {
                 ASSIGN_YZ_OFFSETS ;
                 for( index[0] = 1 ; index[0] < dimsMinus1[0] ; ++ index[0] )
@@ -1168,21 +1601,13 @@ static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const
                         +   ( soln[ offsetX0YPZ0 ] + soln[ offsetX0YMZ0 ] ) * reciprocalSpacing2.y
                         +   ( soln[ offsetX0Y0ZP ] + soln[ offsetX0Y0ZM ] ) * reciprocalSpacing2.z
                         -   lap[ offsetX0Y0Z0 ]
-                        ) * HalfSpacing2Sum ;
+                        ) * reciprocalDiagonal ;
                         ASSERT( ! IsNan( vSolution ) && ! IsInf( vSolution ) ) ;
-#                   if ! USE_TBB
-                        {   // Useful for tuning number of steps, SOR parameter.  Beware; not thread-safe nor would aggregation be deterministic if using parallel_reduce.  Would need to aggregate with parallel_invoke.
-                            const Vec3 updatedVal = oneMinusRelax * soln[ offsetX0Y0Z0 ] + relax * vSolution ;
-                            const Vec3 residualVec = updatedVal - soln[ offsetX0Y0Z0 ] ;
-                            const float residual = residualVec.Magnitude() ;
-                            residualStats.mMean += residual ;
-                            residualStats.mStdDev += Pow2( residual ) ;
-                            residualStats.mMin = Min2( residual , residualStats.mMin ) ;
-                            residualStats.mMax = Max2( residual , residualStats.mMax ) ;
-                            ++ residualsCount ;
-                        }
-#                   endif
-                        soln[ offsetX0Y0Z0 ] = oneMinusRelax * soln[ offsetX0Y0Z0 ] + relax * vSolution ;
+                        const Vec3 updatedVal = oneMinusRelax * soln[ offsetX0Y0Z0 ] + relax * vSolution ;
+                        // Useful for tuning number of steps, SOR parameter, and for deciding when to stop.
+                        // Each thread has its own tally so this is thread-safe, though aggregation is not deterministic.
+                        residualTally.Accumulate( ( updatedVal - soln[ offsetX0Y0Z0 ] ).Magnitude() ) ;
+                        soln[ offsetX0Y0Z0 ] = updatedVal ;
                 }
             }
         }
@@ -1328,14 +1753,81 @@ static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const
         }
     }
 
-    if( residualsCount != 0 )
-    {   // Residual raw stats were tallied.  Cook them.
-        residualStats.mMean  = residualStats.mMean   / float( residualsCount ) ;
-        const float mean2    = residualStats.mStdDev / float( residualsCount ) ;
-        const float variance = mean2 - Pow2( residualStats.mMean ) ;
-        residualStats.mStdDev = fsqrtf( variance ) ;
-    }
+}
+
+
+
+/** Compute residual of the discretized vector Poisson equation, for a subset of gridpoints.
+
+    The residual is
+        residual = lap - ( D soln - screening soln ) ,
+    where D is the finite difference form of the Laplacian operator that StepTowardVectorPoissonSolution uses.
+
+    Residuals on the domain boundary are zero, because boundary values are either
+    prescribed (Dirichlet) or derived from the interior (Neumann).  That makes the
+    residual suitable as the right-hand side of a coarse-grid correction equation
+    whose solution vanishes on the boundary.
+
+    \param residual - (output) UniformGrid of 3-vector residuals.
+
+    \param soln - (input) UniformGrid of 3-vector values, the approximate solution to the vector Poisson equation.
+
+    \param lap - (input) UniformGrid of 3-vector values.
+
+    \param screening - Coefficient of the screening term.  \see StepTowardVectorPoissonSolution.
+
+    \param izStart - starting value for z index
+
+    \param izEnd - one past final value for z index
+
+    \param residualTally - (in/out) tally into which to accumulate residual magnitudes at interior gridpoints.
+
+    \see SolveVectorPoissonMultiGrid.
+
+*/
+static void ComputeVectorPoissonResidualSlice( UniformGrid< Vec3 > & residual , const UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , float screening , size_t izStart , size_t izEnd , ResidualTally & residualTally )
+{
+    ASSERT( residual.ShapeMatches( lap ) ) ;
+    ASSERT( soln.ShapeMatches( lap ) ) ;
+    ASSERT( izEnd <= lap.GetNumPoints( 2 ) ) ;
+
+    const Vec3      spacing                 = lap.GetCellSpacing() ;
+    // Avoid divide-by-zero when z size is effectively 0 (for 2D domains)
+    const Vec3      reciprocalSpacing( 1.0f / spacing.x , 1.0f / spacing.y , spacing.z > FLT_EPSILON ? 1.0f / spacing.z : 0.0f ) ;
+    const Vec3      reciprocalSpacing2( POW2( reciprocalSpacing.x ) , POW2( reciprocalSpacing.y ) , POW2( reciprocalSpacing.z ) ) ;
+    const size_t    dims[3]                 = { lap.GetNumPoints( 0 )   , lap.GetNumPoints( 1 )   , lap.GetNumPoints( 2 )   } ;
+    const size_t    dimsMinus1[3]           = { lap.GetNumPoints( 0 )-1 , lap.GetNumPoints( 1 )-1 , lap.GetNumPoints( 2 )-1 } ;
+    const size_t    numXY                   = dims[0] * dims[1] ;
+    size_t          index[3] ;
 
+    for( index[2] = izStart ; index[2] < izEnd ; ++ index[2] )
+    {
+        ASSIGN_Z_OFFSETS ;
+        const bool onBoundaryZ = ( 0 == index[2] ) || ( dimsMinus1[2] == index[2] ) ;
+        for( index[1] = 0 ; index[1] < dims[1] ; ++ index[1] )
+        {
+            ASSIGN_YZ_OFFSETS ;
+            const bool onBoundaryYZ = onBoundaryZ || ( 0 == index[1] ) || ( dimsMinus1[1] == index[1] ) ;
+            for( index[0] = 0 ; index[0] < dims[0] ; ++ index[0] )
+            {
+                ASSIGN_XYZ_OFFSETS ;
+                if( onBoundaryYZ || ( 0 == index[0] ) || ( dimsMinus1[0] == index[0] ) )
+                {   // Gridpoint lies on domain boundary.
+                    residual[ offsetX0Y0Z0 ] = Vec3( 0.0f , 0.0f , 0.0f ) ;
+                }
+                else
+                {   // Gridpoint lies in domain interior.
+                    residual[ offsetX0Y0Z0 ] = lap[ offsetX0Y0Z0 ]
+                        - ( soln[ offsetXPY0Z0 ] + soln[ offsetXMY0Z0 ] - 2.0f * soln[ offsetX0Y0Z0 ] ) * reciprocalSpacing2.x
+                        - ( soln[ offsetX0YPZ0 ] + soln[ offsetX0YMZ0 ] - 2.0f * soln[ offsetX0Y0Z0 ] ) * reciprocalSpacing2.y
+                        - ( soln[ offsetX0Y0ZP ] + soln[ offsetX0Y0ZM ] - 2.0f * soln[ offsetX0Y0Z0 ] ) * reciprocalSpacing2.z
+                        + screening * soln[ offsetX0Y0Z0 ] ;
+                    ASSERT( ! IsNan( residual[ offsetX0Y0Z0 ] ) && ! IsInf( residual[ offsetX0Y0Z0 ] ) ) ;
+                    residualTally.Accumulate( residual[ offsetX0Y0Z0 ].Magnitude() ) ;
+                }
+            }
+        }
+    }
 }
 
 #undef ASSIGN_XYZ_OFFSETS
@@ -1350,27 +1842,95 @@ static void StepTowardVectorPoissonSolution( UniformGrid< Vec3 > & soln , const
 
 
 
-/** Solve the discretized vector Poisson equation.
+/** Apply a number of red-black Gauss-Seidel sweeps toward solving the discretized vector Poisson equation.
 
-    This routine solves the discretized form of the Poisson equation,
-        D soln = lap ,
+    \param soln (in/out) UniformGrid of 3-vector values, the solution to the vector Poisson equation.
+
+    \param lap  (input) UniformGrid of 3-vector values.
+
+    \param screening Coefficient of the screening term.  \see StepTowardVectorPoissonSolution.
+
+    \param numSteps Maximum number of solver iterations (StepTowardVectorPoissonSolution) to apply.
+
+    \param relax Successive over-relaxation parameter.
+
+    \param convergenceTolerance Stop iterating once the mean change per iteration falls below this fraction of that from the first iteration.
+                                Zero means always apply numSteps iterations.
+
+    \param residualStats (output) Statistics of the magnitude of changes made by the final iteration.
+
+    \return Number of iterations applied.
+
+    \see StepTowardVectorPoissonSolution.
+*/
+static size_t RelaxVectorPoisson( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , float screening , size_t numSteps , float relax , BoundaryConditionE boundaryCondition , float convergenceTolerance , Stats_Float & residualStats )
+{
+    float   targetResidual  = 0.0f ;
+    size_t  iter            = 0 ;
+    while( iter < numSteps )
+    {
+        const size_t numZ = soln.GetNumPoints( 2 ) ;
+        ResidualTally residualTally ;
+#   if USE_TBB
+        {
+            // Estimate grain size based on size of problem and number of processors.
+            const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
+            UniformGrid_StepTowardVectorPoissonSolution_TBB stepRed(   soln , lap , screening , GS_RED   , relax , boundaryCondition ) ;
+            Parallel::Reduce( 0 , numZ , grainSize , stepRed ) ;
+            UniformGrid_StepTowardVectorPoissonSolution_TBB stepBlack( soln , lap , screening , GS_BLACK , relax , boundaryCondition ) ;
+            Parallel::Reduce( 0 , numZ , grainSize , stepBlack ) ;
+            residualTally.Merge( stepRed.mResidualTally ) ;
+            residualTally.Merge( stepBlack.mResidualTally ) ;
+        }
+#   elif POISSON_TECHNIQUE == POISSON_TECHNIQUE_GAUSS_SEIDEL_RED_BLACK
+        StepTowardVectorPoissonSolution( soln , lap , screening , 0 , numZ , GS_RED   , relax , boundaryCondition , residualTally ) ;
+        StepTowardVectorPoissonSolution( soln , lap , screening , 0 , numZ , GS_BLACK , relax , boundaryCondition , residualTally ) ;
+#   elif POISSON_TECHNIQUE == POISSON_TECHNIQUE_GAUSS_SEIDEL
+        StepTowardVectorPoissonSolution( soln , lap , screening , 0 , numZ , GS_BOTH  , relax , boundaryCondition , residualTally ) ;
+#   else
+#       error Invalid or undefined POISSON_TECHNIQUE.  Either define POISSON_TECHNIQUE appropriately or change this code.
+#   endif
+        residualTally.Cook( residualStats ) ;
+        ++ iter ;
+
+        if( 1 == iter )
+        {   // First iteration sets the scale against which to judge convergence.
+            targetResidual = convergenceTolerance * residualStats.mMean ;
+        }
+        else if( residualStats.mMean <= targetResidual )
+        {   // Solution stopped changing appreciably.
+            break ;
+        }
+    }
+    return iter ;
+}
+
+
+
+
+/** Solve the discretized vector screened Poisson equation.
+
+    This routine solves the discretized form of the screened Poisson equation,
+        D soln - screening soln = lap ,
     where D is the Laplacian partial differential operator.
 
     \param soln (output) UniformGrid of 3-vector values, the solution to the vector Poisson equation.
 
     \param lap  (input) UniformGrid of 3-vector values.
 
+    \param screening Coefficient of the screening term.  \see StepTowardVectorPoissonSolution.
+
     \param numSteps Maximum number of solver iterations (StepTowardVectorPoissonSolution) to apply.
 
     \param enforceNeumannBoundaryCondition  Whether to enforce Neumann boundary condition.  If false, enforce Dirichlet boundary condition instead.
 
-    \see StepTowardVectorPoissonSolution.
+    \see SolveVectorPoisson.
 */
-void SolveVectorPoisson( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , size_t numSteps , BoundaryConditionE boundaryCondition , Stats_Float & residualStats )
+static void SolveVectorScreenedPoisson( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , float screening , size_t numSteps , BoundaryConditionE boundaryCondition , Stats_Float & residualStats )
 {
-    PERF_BLOCK( SolveVectorPoisson ) ;
 
     ASSERT( soln.ShapeMatches( lap ) ) ;
+    ASSERT( ( BC_NEUMANN == boundaryCondition ) || ( BC_DIRICHLET == boundaryCondition ) ) ; // Use SpectralPoissonSolver for others.
 
     // Init soln to zero here would disconnect multigrid V-cycle stages, overwrite boundary values, so don't do it. This would be bad: //soln.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
 
@@ -1383,23 +1943,334 @@ void SolveVectorPoisson( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 >
     const size_t  numStepsAuto  = 2 * gridDimMax ;
 #endif
     const size_t  maxIters      = ( numSteps > 0 ) ? numSteps : numStepsAuto ;
-    for( size_t iter = 0 ; iter < maxIters ; ++ iter )
+
+    // Experiment: Approximate optimal relaxation parameter.
+    //const float     relax                   = 2.0f / ( 1.0f + sin( PI / float( gridDimMax ) ) ) ;
+
+    // MJG emperically determined relax using non-MultiGrid on a vortex ring with dims=32^3 advancing from t=0 to t=3.3e-5. Minimum residual occurred with relax in [1.72,1.74].
+    // relax=1.25 had nearly same residual as relax=1.  Halved for relax=1.5. Dropped to 1/100 of that going to relax=1.73.  Doubled from there for relax=1.75.
+    static const float relax = 1.72f ;
+
+    // Stop early once sweeps barely change the solution, e.g. when the initial guess was already close.
+    static const float convergenceTolerance = 1.0e-3f ;
+
+    RelaxVectorPoisson( soln , lap , screening , maxIters , relax , boundaryCondition , convergenceTolerance , residualStats ) ;
+}
+
+
+
+
+/** Solve the discretized vector Poisson equation.
+
+    This routine solves the discretized form of the Poisson equation,
+        D soln = lap ,
+    where D is the Laplacian partial differential operator.
+
+    \param soln (output) UniformGrid of 3-vector values, the solution to the vector Poisson equation.
+
+    \param lap  (input) UniformGrid of 3-vector values.
+
+    \param numSteps Maximum number of solver iterations (StepTowardVectorPoissonSolution) to apply.
+
+    \param enforceNeumannBoundaryCondition  Whether to enforce Neumann boundary condition.  If false, enforce Dirichlet boundary condition instead.
+
+    \see StepTowardVectorPoissonSolution, SolveVectorPoissonMultiGrid.
+*/
+void SolveVectorPoisson( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , size_t numSteps , BoundaryConditionE boundaryCondition , Stats_Float & residualStats )
+{
+    PERF_BLOCK( SolveVectorPoisson ) ;
+
+    SolveVectorScreenedPoisson( soln , lap , /* screening */ 0.0f , numSteps , boundaryCondition , residualStats ) ;
+}
+
+
+
+
+/** Compute residual of the discretized vector Poisson equation, and statistics of its magnitude over the domain interior.
+
+    \param residual - (output) UniformGrid of 3-vector residuals.
+
+    \param soln - (input) approximate solution.
+
+    \param lap - (input) right-hand side of vector Poisson equation.
+
+    \param screening - Coefficient of the screening term.  \see StepTowardVectorPoissonSolution.
+
+    \param residualStats - (output) statistics of residual magnitude.
+
+    \see ComputeVectorPoissonResidualSlice.
+*/
+static void ComputeVectorPoissonResidual( UniformGrid< Vec3 > & residual , const UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , float screening , Stats_Float & residualStats )
+{
+    const size_t    numZ        = lap.GetNumPoints( 2 ) ;
+    // Estimate grain size based on size of problem and number of processors.
+    const size_t    grainSize   = Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
+    ResidualTally   residualTally ;
+    Parallel::Reduce( 0 , numZ , grainSize , Parallel::Reduction< Parallel::MergeResults >( residualTally , ResidualTally() , ComputeVectorPoissonResidualSlice , residual , soln , lap , screening ) ) ;
+    residualTally.Cook( residualStats ) ;
+}
+
+
+
+
+/** Add interior values of a correction to a solution.
+
+    \param soln - (in/out) solution to correct.
+
+    \param correction - (input) values to add to interior gridpoints of soln.
+*/
+static void AddInteriorCorrection( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & correction )
+{
+    ASSERT( soln.ShapeMatches( correction ) ) ;
+
+    const size_t    dims[3]         = { soln.GetNumPoints( 0 ) , soln.GetNumPoints( 1 ) , soln.GetNumPoints( 2 ) } ;
+    const size_t    numXY           = dims[0] * dims[1] ;
+    for( size_t iz = 1 ; iz + 1 < dims[2] ; ++ iz )
     {
-        const size_t numZ = soln.GetNumPoints( 2 ) ;
-#   if USE_TBB
+        for( size_t iy = 1 ; iy + 1 < dims[1] ; ++ iy )
         {
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
-            parallel_for( tbb::blocked_range<size_t>( 0 , numZ , grainSize ) , UniformGrid_StepTowardVectorPoissonSolution_TBB( soln , lap , GS_RED   , boundaryCondition , residualStats ) ) ;
-            parallel_for( tbb::blocked_range<size_t>( 0 , numZ , grainSize ) , UniformGrid_StepTowardVectorPoissonSolution_TBB( soln , lap , GS_BLACK , boundaryCondition , residualStats ) ) ;
+            const size_t offsetYZ = iy * dims[0] + iz * numXY ;
+            for( size_t ix = 1 ; ix + 1 < dims[0] ; ++ ix )
+            {
+                soln[ ix + offsetYZ ] += correction[ ix + offsetYZ ] ;
+            }
         }
-#   elif POISSON_TECHNIQUE == POISSON_TECHNIQUE_GAUSS_SEIDEL_RED_BLACK
-        StepTowardVectorPoissonSolution( soln , lap , 0 , numZ , GS_RED   , boundaryCondition , residualStats ) ;
-        StepTowardVectorPoissonSolution( soln , lap , 0 , numZ , GS_BLACK , boundaryCondition , residualStats ) ;
-#   elif POISSON_TECHNIQUE == POISSON_TECHNIQUE_GAUSS_SEIDEL
-        StepTowardVectorPoissonSolution( soln , lap , 0 , numZ , GS_BOTH  , boundaryCondition , residualStats ) ;
-#   else
-#       error Invalid or undefined POISSON_TECHNIQUE.  Either define POISSON_TECHNIQUE appropriately or change this code.
-#   endif
     }
 }
+
+
+
+
+/** Assign each boundary gridpoint the value of its nearest interior gridpoint.
+
+    This enforces the Neumann boundary condition the same way StepTowardVectorPoissonSolution does,
+    so that values it would assign after its next sweep are already in place.
+
+    \param soln - (in/out) grid whose boundary values to assign from its interior.
+*/
+static void AssignNeumannBoundaryValues( UniformGrid< Vec3 > & soln )
+{
+    const size_t    dims[3]         = { soln.GetNumPoints( 0 ) , soln.GetNumPoints( 1 ) , soln.GetNumPoints( 2 ) } ;
+    const size_t    dimsMinus1[3]   = { dims[0] - 1 , dims[1] - 1 , dims[2] - 1 } ;
+    const size_t    numXY           = dims[0] * dims[1] ;
+    ASSERT( ( dims[0] > 2 ) && ( dims[1] > 2 ) && ( dims[2] > 2 ) ) ;
+    for( size_t iz = 0 ; iz < dims[2] ; ++ iz )
+    {
+        const bool      onBoundaryZ = ( 0 == iz ) || ( dimsMinus1[2] == iz ) ;
+        const size_t    izInterior  = Clamp( iz , size_t( 1 ) , dimsMinus1[2] - 1 ) ;
+        for( size_t iy = 0 ; iy < dims[1] ; ++ iy )
+        {
+            const bool      onBoundaryYZ    = onBoundaryZ || ( 0 == iy ) || ( dimsMinus1[1] == iy ) ;
+            const size_t    iyInterior      = Clamp( iy , size_t( 1 ) , dimsMinus1[1] - 1 ) ;
+            // Interior rows have boundary points only at their ends.
+            const size_t    ixStep          = onBoundaryYZ ? 1 : dimsMinus1[0] ;
+            for( size_t ix = 0 ; ix < dims[0] ; ix += ixStep )
+            {   // For each gridpoint on domain boundary in this row...
+                const size_t ixInterior = Clamp( ix , size_t( 1 ) , dimsMinus1[0] - 1 ) ;
+                soln[ ix + iy * dims[0] + iz * numXY ] = soln[ ixInterior + iyInterior * dims[0] + izInterior * numXY ] ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Relaxation parameter for smoothing within SolveVectorPoissonMultiGrid.
+
+    The heavy over-relaxation SolveVectorPoisson uses speeds convergence of
+    smooth error components, but those are what coarse grids correct.
+    As a smoother, red-black Gauss-Seidel needs only mild over-relaxation,
+    which damps high-frequency error better.
+*/
+static const float sMultiGridSmootherRelax = 1.15f ;
+
+
+
+
+/** Apply one multigrid cycle, recursively, starting at the given layer.
+
+    \param soln - (in/out) On entry, initial guess on layer iLayer.  On return, improved solution.
+
+    \param rhs - Right-hand side on layer iLayer.
+
+    \param scratch - Grids for residuals, coarse-grid corrections and restricted residuals, on layers coarser than iLayer.
+
+    The screening coefficient multiplies soln itself, not a derivative,
+    so it is the same on every layer.
+
+    \param cycleIndex - 1 for V-cycle, 2 for W-cycle.
+
+    \see SolveVectorScreenedPoissonMultiGrid.
+*/
+static void VectorPoissonMultiGridCycle( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & rhs , float screening , VectorPoissonMultiGridScratch & scratch , unsigned iLayer , unsigned coarsestLayer , unsigned cycleIndex , BoundaryConditionE boundaryCondition , Stats_Float & residualStats )
+{
+    static const size_t numPreSmoothingSteps    = 2 ;
+    static const size_t numPostSmoothingSteps   = 2 ;
+
+    if( iLayer == coarsestLayer )
+    {   // Reached coarsest layer.  Solve it thoroughly; it has few gridpoints.
+        SolveVectorScreenedPoisson( soln , rhs , screening , /* numSteps; 0 means auto-choose */ 0 , boundaryCondition , residualStats ) ;
+        return ;
+    }
+
+    UniformGrid< Vec3 > &   residual    = scratch.mResiduals[ iLayer ] ;
+    UniformGrid< Vec3 > &   coarseSoln  = scratch.mCorrections[ iLayer ] ;      // Layer iLayer of scratch corrections has the shape of layer iLayer+1.
+    UniformGrid< Vec3 > &   coarseRhs   = scratch.mRightHandSides[ iLayer ] ;   // Likewise for scratch right-hand sides.
+
+    // Smooth high-frequency error on this layer.
+    RelaxVectorPoisson( soln , rhs , screening , numPreSmoothingSteps , sMultiGridSmootherRelax , boundaryCondition , /* convergenceTolerance */ 0.0f , residualStats ) ;
+
+    // Restrict residual into right-hand side of coarse-grid correction equation.
+    Stats_Float unusedStats ;
+    ComputeVectorPoissonResidual( residual , soln , rhs , screening , unusedStats ) ;
+    coarseRhs.DownSample( residual , UniformGridGeometry::SLOWER_MORE_ACCURATE ) ;
+
+    // Zero is the natural initial guess for the correction.
+    // For Dirichlet boundary conditions, the correction also vanishes on the boundary.
+    // For Neumann, smoothing assigns its boundary values from its interior, as it does for soln.
+    coarseSoln.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+
+    for( unsigned iCycle = 0 ; iCycle < cycleIndex ; ++ iCycle )
+    {   // Solve coarse-grid correction equation; twice for W-cycle.
+        VectorPoissonMultiGridCycle( coarseSoln , coarseRhs , screening , scratch , iLayer + 1 , coarsestLayer , cycleIndex , boundaryCondition , residualStats ) ;
+    }
+
+    // Interpolate coarse-grid correction and apply it to interior of this layer.
+    residual.UpSample( coarseSoln , UniformGridGeometry::INTERIOR_ONLY ) ;
+    AddInteriorCorrection( soln , residual ) ;
+    if( BC_NEUMANN == boundaryCondition )
+    {   // Boundary values follow interior values, so update them to match the corrected interior before smoothing reads them.
+        AssignNeumannBoundaryValues( soln ) ;
+    }
+
+    // Smooth error introduced by interpolation.
+    RelaxVectorPoisson( soln , rhs , screening , numPostSmoothingSteps , sMultiGridSmootherRelax , boundaryCondition , /* convergenceTolerance */ 0.0f , residualStats ) ;
+}
+
+
+
+
+/** Solve the discretized vector screened Poisson equation using a geometric multigrid method.
+
+    This routine solves the discretized form of the screened Poisson equation,
+        D soln - screening soln = lap ,
+    on the finest layer (layer 0) of the given nested grids, by repeating
+    multigrid cycles until the residual falls below a tolerance.
+
+    Each cycle smooths the error on a layer using a few red-black Gauss-Seidel
+    sweeps, restricts the residual to the next coarser layer, recursively
+    solves for a coarse-grid correction there, interpolates that correction
+    back and smooths again.  Each cycle reduces the residual by a factor
+    roughly independent of grid resolution, so the number of cycles needed
+    does not grow with the grid, unlike SolveVectorPoisson.
+
+    \param soln (in/out) Nested grid whose layer 0 holds the initial guess and receives the solution.
+                            For Dirichlet boundary conditions, layer 0 boundary values must already be assigned.
+
+    \param lap  Nested grid whose layer 0 holds the right-hand side of the vector Poisson equation.
+                Its other layers give the shapes of coarser layers, and this leaves their contents intact.
+
+    \param screening Non-negative coefficient of the screening term.  Zero yields the ordinary Poisson equation.
+                        An implicit diffusion step, ( 1 - diffusivity timeStep D ) soln = original,
+                        has this form with screening = 1 / ( diffusivity timeStep ) and lap = - screening original.
+
+    \param scratch (in/out) Grids for residuals, corrections and restricted residuals on each layer.
+                    This reshapes them to match lap, reusing their memory when its shape has not changed.
+
+    \param boundaryCondition Which kind of boundary condition to enforce.
+
+    \param residualTolerance Stop cycling when the mean residual magnitude falls below this fraction of its initial value,
+                                or, for a warm start, of the mean magnitude of lap.
+
+    \param maxCycles Maximum number of multigrid cycles to apply.
+
+    \param cycleIndex 1 for V-cycles, 2 for W-cycles.
+
+    \param residualStats (output) Statistics of residual magnitude on layer 0 after the final cycle.
+
+    \note This reads and writes only layer 0 of soln.
+
+    \param warmStart Whether soln holds a solution of a similar problem, e.g. from the previous frame.
+                        Then its initial residual is already small, so measuring tolerance against
+                        it would demand as many cycles as a cold start.  Instead, tolerance applies
+                        to the mean magnitude of lap, which is what the residual of a zero guess
+                        would be, apart from boundary values, so a better guess takes fewer cycles.
+
+    \return Number of cycles applied.
+
+    \see SolveVectorPoissonMultiGrid, StepTowardVectorPoissonSolution.
+*/
+size_t SolveVectorScreenedPoissonMultiGrid( NestedGrid< Vec3 > & soln , const NestedGrid< Vec3 > & lap , float screening , VectorPoissonMultiGridScratch & scratch , BoundaryConditionE boundaryCondition , float residualTolerance , size_t maxCycles , unsigned cycleIndex , bool warmStart , Stats_Float & residualStats )
+{
+    PERF_BLOCK( SolveVectorScreenedPoissonMultiGrid ) ;
+
+    ASSERT( soln.GetDepth() == lap.GetDepth() ) ;
+    ASSERT( soln[ 0 ].ShapeMatches( lap[ 0 ] ) ) ;
+    ASSERT( ( cycleIndex >= 1 ) && ( cycleIndex <= 2 ) ) ;
+    ASSERT( ( BC_NEUMANN == boundaryCondition ) || ( BC_DIRICHLET == boundaryCondition ) ) ; // Use SpectralPoissonSolver for others.
+    ASSERT( screening >= 0.0f ) ;
+
+    // Find coarsest layer that still has interior gridpoints along every axis.
+    unsigned coarsestLayer = 0 ;
+    for( unsigned iLayer = 1 ; iLayer < lap.GetDepth() ; ++ iLayer )
+    {
+        const unsigned minDim = MIN3( lap[ iLayer ].GetNumPoints( 0 ) , lap[ iLayer ].GetNumPoints( 1 ) , lap[ iLayer ].GetNumPoints( 2 ) ) ;
+        if( minDim <= 2 )
+        {
+            break ;
+        }
+        coarsestLayer = iLayer ;
+    }
+
+    // Shape scratch grids to match.  Initialize reuses memory of existing layers.
+    scratch.mResiduals.Initialize( lap[ 0 ] ) ;
+    if( coarsestLayer > 0 )
+    {   // Solver uses coarser layers.
+        scratch.mCorrections.Initialize( lap[ 1 ] ) ;
+        scratch.mRightHandSides.Initialize( lap[ 1 ] ) ;
+    }
+
+    ComputeVectorPoissonResidual( scratch.mResiduals[ 0 ] , soln[ 0 ] , lap[ 0 ] , screening , residualStats ) ;
+    float referenceResidual = residualStats.mMean ;
+    if( warmStart )
+    {   // Measure tolerance against residual of a zero guess, not of the given guess.
+        const size_t numPoints = lap[ 0 ].GetGridCapacity() ;
+        float sumMagnitudes = 0.0f ;
+        for( size_t offset = 0 ; offset < numPoints ; ++ offset )
+        {
+            sumMagnitudes += lap[ 0 ][ offset ].Magnitude() ;
+        }
+        referenceResidual = sumMagnitudes / float( Max2( numPoints , size_t( 1 ) ) ) ;
+    }
+    const float targetResidual  = residualTolerance * referenceResidual ;
+
+    Stats_Float cycleStats ;
+    size_t iCycle = 0 ;
+    while( ( iCycle < maxCycles ) && ( residualStats.mMean > targetResidual ) )
+    {   // Until residual is small enough...
+        VectorPoissonMultiGridCycle( soln[ 0 ] , lap[ 0 ] , screening , scratch , 0 , coarsestLayer , cycleIndex , boundaryCondition , cycleStats ) ;
+        ComputeVectorPoissonResidual( scratch.mResiduals[ 0 ] , soln[ 0 ] , lap[ 0 ] , screening , residualStats ) ;
+        ++ iCycle ;
+    }
+
+    return iCycle ;
+}
+
+
+
+
+/** Solve the discretized vector Poisson equation using a geometric multigrid method.
+
+    This routine solves the discretized form of the Poisson equation,
+        D soln = lap ,
+    on the finest layer (layer 0) of the given nested grids.
+
+    \see SolveVectorScreenedPoissonMultiGrid for descriptions of parameters and return value.
+*/
+size_t SolveVectorPoissonMultiGrid( NestedGrid< Vec3 > & soln , const NestedGrid< Vec3 > & lap , VectorPoissonMultiGridScratch & scratch , BoundaryConditionE boundaryCondition , float residualTolerance , size_t maxCycles , unsigned cycleIndex , bool warmStart , Stats_Float & residualStats )
+{
+    PERF_BLOCK( SolveVectorPoissonMultiGrid ) ;
+
+    return SolveVectorScreenedPoissonMultiGrid( soln , lap , /* screening */ 0.0f , scratch , boundaryCondition , residualTolerance , maxCycles , cycleIndex , warmStart , residualStats ) ;
+}
@@ -12,6 +12,7 @@
 
 #include "Core/Math/mat33.h"
 #include "Core/SpatialPartition/uniformGrid.h"
+#include "Core/SpatialPartition/nestedGrid.h"
 
 
 // Macros --------------------------------------------------------------
@@ -23,10 +24,51 @@ enum BoundaryConditionE
 {
     BC_NEUMANN      ,   /// Enforce Neumann boundary condition
     BC_DIRICHLET    ,   /// Enforce Dirichley boundary condition
+    BC_PERIODIC     ,   /// Treat domain as periodic.  Only SpectralPoissonSolver supports this.
+    BC_FREE_SPACE   ,   /// Treat domain as embedded in unbounded space where source is zero.  Only SpectralPoissonSolver supports this.
     BC_NUM
 } ;
 
 
+/** Scratch grids that SolveVectorScreenedPoissonMultiGrid uses on each layer.
+
+    Callers keep one of these between solves, so its layers get allocated once,
+    and so the solver leaves coarser layers of the caller's grids intact.
+
+    Layer k of mCorrections and mRightHandSides has the shape of layer k+1 of
+    the grids the solver works on, since layer 0 uses the caller's solution
+    and right-hand side instead.
+*/
+struct VectorPoissonMultiGridScratch
+{
+    NestedGrid< Vec3 >  mResiduals          ;   ///< Residual on each layer; also holds interpolated corrections.
+    NestedGrid< Vec3 >  mCorrections        ;   ///< Coarse-grid correction ("error") on each layer coarser than 0.
+    NestedGrid< Vec3 >  mRightHandSides     ;   ///< Restricted residual, i.e. right-hand side of the coarse-grid correction equation, on each layer coarser than 0.
+
+    /// Return number of bytes these grids occupy.
+    size_t GetMemoryUsage() const
+    {
+        return mResiduals.GetMemoryUsage() + mCorrections.GetMemoryUsage() + mRightHandSides.GetMemoryUsage() ;
+    }
+
+    /// Release memory these grids retain beyond what their current shapes need.
+    void TrimMemory()
+    {
+        mResiduals.TrimMemory() ;
+        mCorrections.TrimMemory() ;
+        mRightHandSides.TrimMemory() ;
+    }
+
+    /// Release all memory these grids hold.
+    void Clear()
+    {
+        mResiduals.Clear() ;
+        mCorrections.Clear() ;
+        mRightHandSides.Clear() ;
+    }
+} ;
+
+
 // Public variables --------------------------------------------------------------
 // Public functions --------------------------------------------------------------
 
@@ -37,7 +79,11 @@ extern void ComputeGradient( UniformGrid< Vec3 > & gradient , const UniformGrid<
 extern void ComputeGradientConditionally( UniformGrid< Vec3 > & gradient , const UniformGrid< float > & val ) ;
 extern void ComputeJacobian( UniformGrid< Mat33 > & jacobian , const UniformGrid< Vec3 > & vec ) ;
 extern void ComputeCurlFromJacobian( UniformGrid< Vec3 > & curl , const UniformGrid< Mat33 > & jacobian ) ;
+extern void ComputeCurl( UniformGrid< Vec3 > & curl , const UniformGrid< Vec3 > & vec ) ;
+extern void ComputeDivergence( UniformGrid< float > & divergence , const UniformGrid< Vec3 > & vec ) ;
 extern void ComputeLaplacian( UniformGrid< Vec3 > & laplacian , const UniformGrid< Vec3 > & vec ) ;
 extern void SolveVectorPoisson( UniformGrid< Vec3 > & soln , const UniformGrid< Vec3 > & lap , size_t numSteps , BoundaryConditionE boundaryCondition , Stats_Float & residualStats ) ;
+extern size_t SolveVectorPoissonMultiGrid( NestedGrid< Vec3 > & soln , const NestedGrid< Vec3 > & lap , VectorPoissonMultiGridScratch & scratch , BoundaryConditionE boundaryCondition , float residualTolerance , size_t maxCycles , unsigned cycleIndex , bool warmStart , Stats_Float & residualStats ) ;
+extern size_t SolveVectorScreenedPoissonMultiGrid( NestedGrid< Vec3 > & soln , const NestedGrid< Vec3 > & lap , float screening , VectorPoissonMultiGridScratch & scratch , BoundaryConditionE boundaryCondition , float residualTolerance , size_t maxCycles , unsigned cycleIndex , bool warmStart , Stats_Float & residualStats ) ;
 
 #endif
@@ -0,0 +1,315 @@
+/** \file uniformGridScatter.h
+
+    \brief Parallel accumulation of many sources into uniform grids
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef UNIFORM_GRID_SCATTER_H
+#define UNIFORM_GRID_SCATTER_H
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+#include "Core/Containers/vector.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Accumulate many sources into one or more uniform grids that share the same geometry.
+
+    This has the same effect as calling UniformGrid::Accumulate for each
+    source and each grid, except for the order in which contributions add.
+
+    When there are enough sources, this splits them into contiguous chunks,
+    one per processor.  Each chunk accumulates into its own private tile:
+    a dense block of gridpoints that spans only the cells its sources occupy.
+    Then a second pass merges tiles into the grids, with each thread
+    owning distinct z-layers of gridpoints.  Neither pass needs locks or
+    atomic operations, and the result does not depend on thread timing.
+
+    Tiles stay small when sources adjacent in memory are also adjacent in
+    space, e.g. particles sorted by PclOpSortMorton.  Otherwise each tile can
+    span the entire grid, so memory use grows with the number of chunks.
+
+    When there are too few sources to pay for tiles, this accumulates
+    directly into the grids, serially.
+
+    SourceT must provide these members:
+        - size_t GetNumSources() const
+        - const Vec3 & GetPosition( size_t iSource ) const
+        - void GetValues( size_t iSource , ItemT values[] ) const, which assigns one value per grid.
+
+    \see UniformGrid::Accumulate.
+*/
+template <class ItemT , class SourceT> class UniformGridScatter
+{
+    public:
+        /// Maximum number of grids one scatter can populate.
+        static const size_t MAX_NUM_GRIDS = 8 ;
+
+        /** Prepare to accumulate the given sources into the given grids.
+
+            \param grids - Addresses of grids into which to accumulate.  All must have the same geometry and already be initialized, typically to zero.
+
+            \param numGrids - Number of elements in grids.  SourceT::GetValues must assign this many values.
+
+            \param sources - Object providing source positions and values.
+        */
+        UniformGridScatter( UniformGrid< ItemT > * const grids[] , size_t numGrids , const SourceT & sources )
+            : mGeometry( * grids[ 0 ] )
+            , mNumGrids( numGrids )
+            , mSources( sources )
+            , mNumChunks( 1 )
+        {
+            ASSERT( ( numGrids > 0 ) && ( numGrids <= MAX_NUM_GRIDS ) ) ;
+            for( size_t iGrid = 0 ; iGrid < numGrids ; ++ iGrid )
+            {
+                ASSERT( grids[ iGrid ]->ShapeMatches( mGeometry ) ) ;
+                ASSERT( grids[ iGrid ]->Size() == mGeometry.GetGridCapacity() ) ;
+                mGrids[ iGrid ] = grids[ iGrid ] ;
+            }
+        }
+
+
+        /** Accumulate every source into every grid.
+        */
+        void Scatter()
+        {
+            PERF_BLOCK( UniformGridScatter__Scatter ) ;
+
+            const size_t numSources = mSources.GetNumSources() ;
+            if( 0 == numSources )
+            {
+                return ;
+            }
+
+        #if USE_TBB
+            // Use one chunk per processor, but avoid chunks so small that populating and merging tiles costs more than it saves.
+            static const size_t minSourcesPerChunk = 4096 ;
+            mNumChunks = Clamp( numSources / minSourcesPerChunk , size_t( 1 ) , size_t( gNumberOfProcessors ) ) ;
+        #else
+            mNumChunks = 1 ;
+        #endif
+
+            if( 1 == mNumChunks )
+            {   // Too few sources to benefit from tiles.  Accumulate directly into grids.
+                Tile whole ;
+                whole.mMinIndices[ 0 ] = whole.mMinIndices[ 1 ] = whole.mMinIndices[ 2 ] = 0 ;
+                whole.mNumPoints[ 0 ] = mGeometry.GetNumPoints( 0 ) ;
+                whole.mNumPoints[ 1 ] = mGeometry.GetNumPoints( 1 ) ;
+                whole.mNumPoints[ 2 ] = mGeometry.GetNumPoints( 2 ) ;
+                ItemT * dst[ MAX_NUM_GRIDS ] ;
+                for( size_t iGrid = 0 ; iGrid < mNumGrids ; ++ iGrid )
+                {
+                    dst[ iGrid ] = mGrids[ iGrid ]->Data() ;
+                }
+                // Tile is the whole grid, so its shape might be one that has specialized offset arithmetic.
+                AccumulateRangeFunc func( * this , whole , dst , numSources ) ;
+                DispatchOnShape( mGeometry , func ) ;
+                return ;
+            }
+
+            mTiles.Resize( mNumChunks ) ;
+            Parallel::For( 0 , mNumChunks , 1 , Parallel::Method( this , & UniformGridScatter::AccumulateChunks ) ) ;
+            Parallel::For( 0 , mGeometry.GetNumPoints( 2 ) , 1 , Parallel::Method( this , & UniformGridScatter::MergeLayers ) ) ;
+        }
+
+    private:
+        /// Dense block of gridpoints, private to one chunk of sources.
+        struct Tile
+        {
+            unsigned            mMinIndices[ 3 ]    ;   ///< Indices, within grid, of minimal gridpoint of this tile.
+            unsigned            mNumPoints[ 3 ]     ;   ///< Number of gridpoints along each axis of this tile.
+            VECTOR< ItemT >     mValues             ;   ///< Values of gridpoints in this tile, for each grid in turn.
+        } ;
+
+        /** Function object for DispatchOnShape, to call AccumulateRangeInShape with the shape policy that matches a tile.
+        */
+        class AccumulateRangeFunc
+        {
+            public:
+                AccumulateRangeFunc( const UniformGridScatter & scatter , const Tile & tile , ItemT * const dst[] , size_t numSources )
+                    : mScatter( scatter ) , mTile( tile ) , mDst( dst ) , mNumSources( numSources )
+                {}
+                template< class ShapeT > void operator()( const ShapeT & shape ) const
+                {
+                    mScatter.AccumulateRangeInShape( shape , mTile , mDst , 0 , mNumSources ) ;
+                }
+            private:
+                AccumulateRangeFunc & operator=( const AccumulateRangeFunc & ) ; // Disallow assignment
+
+                const UniformGridScatter &  mScatter    ;   ///< Object doing the scattering
+                const Tile &                mTile       ;   ///< Block of gridpoints into which to accumulate
+                ItemT * const *             mDst        ;   ///< Address of first gridpoint of mTile, for each grid
+                size_t                      mNumSources ;   ///< Number of sources to accumulate, starting at first
+        } ;
+
+        /** Accumulate the given range of chunks of sources into their private tiles.
+        */
+        void AccumulateChunks( size_t iChunkStart , size_t iChunkEnd )
+        {
+            for( size_t iChunk = iChunkStart ; iChunk < iChunkEnd ; ++ iChunk )
+            {
+                AccumulateChunk( iChunk ) ;
+            }
+        }
+
+
+        /** Accumulate one chunk of sources into its private tile.
+        */
+        void AccumulateChunk( size_t iChunk )
+        {
+            const size_t numSources     = mSources.GetNumSources() ;
+            const size_t sourceBegin    = numSources * iChunk         / mNumChunks ;
+            const size_t sourceEnd      = numSources * ( iChunk + 1 ) / mNumChunks ;
+            Tile &       tile           = mTiles[ iChunk ] ;
+
+            // Find the range of cells these sources occupy.
+            unsigned idxMin[ 3 ] = { mGeometry.GetNumPoints( 0 ) , mGeometry.GetNumPoints( 1 ) , mGeometry.GetNumPoints( 2 ) } ;
+            unsigned idxMax[ 3 ] = { 0 , 0 , 0 } ;
+            for( size_t iSource = sourceBegin ; iSource < sourceEnd ; ++ iSource )
+            {   // For each source in chunk...
+                unsigned indices[ 4 ] ;
+                mGeometry.IndicesOfPosition( indices , mSources.GetPosition( iSource ) ) ;
+                for( int axis = 0 ; axis < 3 ; ++ axis )
+                {
+                    idxMin[ axis ] = Min2( idxMin[ axis ] , indices[ axis ] ) ;
+                    idxMax[ axis ] = Max2( idxMax[ axis ] , indices[ axis ] ) ;
+                }
+            }
+
+            // Each source contributes to the gridpoints at both ends of its cell, so the tile spans one more gridpoint than cell.
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {
+                tile.mMinIndices[ axis ] = idxMin[ axis ] ;
+                tile.mNumPoints[ axis ]  = Min2( idxMax[ axis ] + 2 , unsigned( mGeometry.GetNumPoints( axis ) ) ) - idxMin[ axis ] ;
+            }
+            const size_t tileCapacity = size_t( tile.mNumPoints[ 0 ] ) * tile.mNumPoints[ 1 ] * tile.mNumPoints[ 2 ] ;
+            tile.mValues.Resize( tileCapacity * mNumGrids ) ;
+            memset( & tile.mValues[ 0 ] , 0 , tile.mValues.Size() * sizeof( ItemT ) ) ;
+
+            ItemT * dst[ MAX_NUM_GRIDS ] ;
+            for( size_t iGrid = 0 ; iGrid < mNumGrids ; ++ iGrid )
+            {
+                dst[ iGrid ] = & tile.mValues[ iGrid * tileCapacity ] ;
+            }
+            AccumulateRangeInShape( UniformGridRuntimeShape( tile.mNumPoints[ 0 ] , tile.mNumPoints[ 1 ] ) , tile , dst , sourceBegin , sourceEnd ) ;
+        }
+
+
+        /** Accumulate the given range of sources into the gridpoints of the given tile.
+
+            \param tile - Block of gridpoints, which must encompass the cells the given sources occupy.
+
+            \param shape - UniformGridRuntimeShape or UniformGridFixedShape matching the shape of tile.
+
+            \param dst - Address of the first gridpoint of tile, for each grid.
+
+            This uses the same formulae as UniformGrid::Accumulate.
+        */
+        template< class ShapeT > void AccumulateRangeInShape( const ShapeT & shape , const Tile & tile , ItemT * const dst[] , size_t sourceBegin , size_t sourceEnd ) const
+        {
+            ASSERT( shape.GetNumX() == tile.mNumPoints[ 0 ] ) ;
+            ASSERT( shape.GetNumXY() == size_t( tile.mNumPoints[ 0 ] ) * tile.mNumPoints[ 1 ] ) ;
+            ItemT           values[ MAX_NUM_GRIDS ] ;
+            for( size_t iSource = sourceBegin ; iSource < sourceEnd ; ++ iSource )
+            {   // For each source in range...
+                const Vec3 &    vPosition   = mSources.GetPosition( iSource ) ;
+                unsigned        indices[4] ; // Indices of grid cell containing position.
+                mGeometry.IndicesOfPosition( indices , vPosition ) ;
+                Vec3            vMinCorner ;
+                mGeometry.PositionFromIndices( vMinCorner , indices ) ;
+                ASSERT( ( indices[ 0 ] >= tile.mMinIndices[ 0 ] ) && ( indices[ 0 ] + 1 < tile.mMinIndices[ 0 ] + tile.mNumPoints[ 0 ] ) ) ;
+                ASSERT( ( indices[ 1 ] >= tile.mMinIndices[ 1 ] ) && ( indices[ 1 ] + 1 < tile.mMinIndices[ 1 ] + tile.mNumPoints[ 1 ] ) ) ;
+                ASSERT( ( indices[ 2 ] >= tile.mMinIndices[ 2 ] ) && ( indices[ 2 ] + 1 < tile.mMinIndices[ 2 ] + tile.mNumPoints[ 2 ] ) ) ;
+                const size_t    offsetX0Y0Z0  = shape.OffsetFromIndices( indices[ 0 ] - tile.mMinIndices[ 0 ]
+                                                                 , indices[ 1 ] - tile.mMinIndices[ 1 ]
+                                                                 , indices[ 2 ] - tile.mMinIndices[ 2 ] ) ;
+                const Vec3      vDiff         = vPosition - vMinCorner ; // Relative location of position within its containing grid cell.
+                const Vec3      tween         = Clamp0to1( Vec3( vDiff.x * mGeometry.GetCellsPerExtent().x , vDiff.y * mGeometry.GetCellsPerExtent().y , vDiff.z * mGeometry.GetCellsPerExtent().z ) ) ;
+                const Vec3      oneMinusTween = Vec3( 1.0f , 1.0f , 1.0f ) - tween ;
+                const size_t    offsetX1Y0Z0  = offsetX0Y0Z0 + 1 ;
+                const size_t    offsetX0Y1Z0  = offsetX0Y0Z0 + shape.GetNumX() ;
+                const size_t    offsetX1Y1Z0  = offsetX0Y0Z0 + shape.GetNumX() + 1 ;
+                const size_t    offsetX0Y0Z1  = offsetX0Y0Z0 + shape.GetNumXY() ;
+                const size_t    offsetX1Y0Z1  = offsetX0Y0Z0 + shape.GetNumXY() + 1 ;
+                const size_t    offsetX0Y1Z1  = offsetX0Y0Z0 + shape.GetNumXY() + shape.GetNumX() ;
+                const size_t    offsetX1Y1Z1  = offsetX0Y0Z0 + shape.GetNumXY() + shape.GetNumX() + 1 ;
+                mSources.GetValues( iSource , values ) ;
+                for( size_t iGrid = 0 ; iGrid < mNumGrids ; ++ iGrid )
+                {   // For each grid...
+                    ItemT * const   pGrid   = dst[ iGrid ] ;
+                    const ItemT &   item    = values[ iGrid ] ;
+                    pGrid[ offsetX0Y0Z0 ] += oneMinusTween.x * oneMinusTween.y * oneMinusTween.z * item ;
+                    pGrid[ offsetX1Y0Z0 ] +=         tween.x * oneMinusTween.y * oneMinusTween.z * item ;
+                    pGrid[ offsetX0Y1Z0 ] += oneMinusTween.x *         tween.y * oneMinusTween.z * item ;
+                    pGrid[ offsetX1Y1Z0 ] +=         tween.x *         tween.y * oneMinusTween.z * item ;
+                    pGrid[ offsetX0Y0Z1 ] += oneMinusTween.x * oneMinusTween.y *         tween.z * item ;
+                    pGrid[ offsetX1Y0Z1 ] +=         tween.x * oneMinusTween.y *         tween.z * item ;
+                    pGrid[ offsetX0Y1Z1 ] += oneMinusTween.x *         tween.y *         tween.z * item ;
+                    pGrid[ offsetX1Y1Z1 ] +=         tween.x *         tween.y *         tween.z * item ;
+                }
+            }
+        }
+
+
+        /** Add the given z-layers of every tile into the grids.
+
+            Each call touches only gridpoints in layers [zBegin,zEnd), so calls with disjoint ranges can run concurrently.
+            Tiles merge in chunk order, so the result does not depend on how layers split among threads.
+        */
+        void MergeLayers( size_t zBegin , size_t zEnd )
+        {
+            const size_t numX   = mGeometry.GetNumPoints( 0 ) ;
+            const size_t numXY  = numX * mGeometry.GetNumPoints( 1 ) ;
+            for( size_t iChunk = 0 ; iChunk < mNumChunks ; ++ iChunk )
+            {   // For each tile...
+                const Tile &    tile            = mTiles[ iChunk ] ;
+                const size_t    tileNumXY       = size_t( tile.mNumPoints[ 0 ] ) * tile.mNumPoints[ 1 ] ;
+                const size_t    tileCapacity    = tileNumXY * tile.mNumPoints[ 2 ] ;
+                const size_t    tileZBegin      = Max2( zBegin , size_t( tile.mMinIndices[ 2 ] ) ) ;
+                const size_t    tileZEnd        = Min2( zEnd   , size_t( tile.mMinIndices[ 2 ] + tile.mNumPoints[ 2 ] ) ) ;
+                for( size_t iz = tileZBegin ; iz < tileZEnd ; ++ iz )
+                {   // For each layer of this tile within the given range...
+                    for( size_t ty = 0 ; ty < tile.mNumPoints[ 1 ] ; ++ ty )
+                    {   // For each row of tile within layer...
+                        const size_t tileRowOffset  = ( iz - tile.mMinIndices[ 2 ] ) * tileNumXY + ty * tile.mNumPoints[ 0 ] ;
+                        const size_t gridRowOffset  = iz * numXY + ( ty + tile.mMinIndices[ 1 ] ) * numX + tile.mMinIndices[ 0 ] ;
+                        for( size_t iGrid = 0 ; iGrid < mNumGrids ; ++ iGrid )
+                        {   // For each grid...
+                            const ItemT *   pSrc = & tile.mValues[ iGrid * tileCapacity + tileRowOffset ] ;
+                            ItemT *         pDst = mGrids[ iGrid ]->Data() + gridRowOffset ;
+                            for( size_t tx = 0 ; tx < tile.mNumPoints[ 0 ] ; ++ tx )
+                            {
+                                pDst[ tx ] += pSrc[ tx ] ;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        UniformGridScatter & operator=( const UniformGridScatter & ) ; // Disallow assignment.
+
+        const UniformGridGeometry &     mGeometry                   ;   ///< Geometry shared by all grids.
+        UniformGrid< ItemT > *          mGrids[ MAX_NUM_GRIDS ]     ;   ///< Addresses of grids into which to accumulate.
+        size_t                          mNumGrids                   ;   ///< Number of elements in mGrids.
+        const SourceT &                 mSources                    ;   ///< Object providing source positions and values.
+        size_t                          mNumChunks                  ;   ///< Number of chunks into which Scatter splits sources.
+        VECTOR< Tile >                  mTiles                      ;   ///< Private tile for each chunk.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+/** Accumulate the given sources into the given grids, in parallel when that helps.
+
+    \see UniformGridScatter.
+*/
+template <class ItemT , class SourceT> void ScatterIntoGrids( UniformGrid< ItemT > * const grids[] , size_t numGrids , const SourceT & sources )
+{
+    UniformGridScatter< ItemT , SourceT > scatter( grids , numGrids , sources ) ;
+    scatter.Scatter() ;
+}
+
+#endif
@@ -0,0 +1,337 @@
+/** \file depthSorter.cpp
+
+    \brief Order of items by depth along a view direction, using a parallel radix sort
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+
+#include "Core/Utility/depthSorter.h"
+
+#include "Core/Math/math.h"
+#include "Core/Utility/macros.h"
+#include "Core/Performance/perfBlock.h"
+#include "Core/parallelExecution.h"
+
+#include <float.h>
+#include <string.h>
+
+#include <algorithm>
+
+// Private variables --------------------------------------------------------------
+// Types --------------------------------------------------------------
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct object to order items by depth.
+*/
+DepthSorter::DepthSorter()
+    : mPositions( 0 )
+    , mStride( 0 )
+    , mViewForward( 0.0f , 0.0f , 0.0f )
+    , mMinDepth( 0.0f )
+    , mKeysPerDepth( 0.0f )
+    , mDigitShift( 0 )
+    , mNumChunks( 0 )
+    , mWasAlreadySorted( false )
+{
+}
+
+
+
+
+/** Order items by increasing depth along the given direction.
+
+    \param positions    Address of position (Vec3) of first item.
+
+    \param stride       Number of bytes between positions of adjacent items.
+
+    \param numItems     Number of items to sort.
+
+    \param viewForward  Direction along which to measure depth.
+                        For back-to-front rendering, this should point from the scene toward the viewer,
+                        i.e. the world-space direction of the view +z axis, so the farthest item comes first.
+
+    Afterwards, operator[] and GetOrder provide indices of items in sorted order.
+    Items whose depths quantize to the same key keep their previous order.
+*/
+void DepthSorter::Sort( const char * positions , size_t stride , size_t numItems , const Vec3 & viewForward )
+{
+    PERF_BLOCK( DepthSorter__Sort ) ;
+
+    mPositions          = positions ;
+    mStride             = stride ;
+    mViewForward        = viewForward ;
+    mWasAlreadySorted   = true ;
+
+    SeedOrderFromPrevious( numItems ) ;
+
+    if( numItems < 2 )
+    {   // Trivially sorted.
+        return ;
+    }
+
+#if USE_TBB
+    // Use one chunk per processor, but avoid chunks so small that scheduling them costs more than sorting them.
+    static const size_t minItemsPerChunk = 4096 ;
+    mNumChunks = Clamp( numItems / minItemsPerChunk , size_t( 1 ) , size_t( gNumberOfProcessors ) ) ;
+#else
+    mNumChunks = 1 ;
+#endif
+
+    mKeys.Resize( numItems ) ;
+    mDepths.Resize( numItems ) ;
+    mScratchKeys.Resize( numItems ) ;
+    mScratchOrder.Resize( numItems ) ;
+    mChunkSlots.Resize( mNumChunks * sNumDigitValues ) ;
+    mChunkMinDepth.Resize( mNumChunks ) ;
+    mChunkMaxDepth.Resize( mNumChunks ) ;
+    mChunkIsSorted.Resize( mNumChunks ) ;
+
+    RunStage( STAGE_DEPTH ) ;
+
+    // Quantize depths to keys spanning the range of depths, so few bits (hence few radix passes) give fine resolution.
+    float minDepth =   FLT_MAX ;
+    float maxDepth = - FLT_MAX ;
+    for( size_t iChunk = 0 ; iChunk < mNumChunks ; ++ iChunk )
+    {
+        minDepth = Min2( minDepth , mChunkMinDepth[ iChunk ] ) ;
+        maxDepth = Max2( maxDepth , mChunkMaxDepth[ iChunk ] ) ;
+    }
+    const float depthRange = maxDepth - minDepth ;
+    mMinDepth       = minDepth ;
+    mKeysPerDepth   = ( depthRange > 0.0f ) ? float( ( 1 << sNumKeyBits ) - 1 ) / depthRange : 0.0f ;
+
+    RunStage( STAGE_KEY ) ;
+
+    // Items are already in order if keys in each chunk are, and each chunk starts no lower than the previous chunk ends.
+    for( size_t iChunk = 0 ; iChunk < mNumChunks ; ++ iChunk )
+    {
+        const size_t itemBegin = numItems * iChunk / mNumChunks ;
+        if( ! mChunkIsSorted[ iChunk ] || ( ( iChunk > 0 ) && ( mKeys[ itemBegin - 1 ] > mKeys[ itemBegin ] ) ) )
+        {
+            mWasAlreadySorted = false ;
+            break ;
+        }
+    }
+    if( mWasAlreadySorted )
+    {   // Previous order remains sorted, as happens when neither the camera nor the items moved much.
+        return ;
+    }
+
+    for( mDigitShift = 0 ; mDigitShift < sNumKeyBits ; mDigitShift += sNumDigitBits )
+    {   // For each digit, from least to most significant...
+        RunStage( STAGE_COUNT ) ;
+
+        // Convert counts to slots using an exclusive prefix sum over digit values then chunks.
+        // Chunks with the same digit value write in chunk order, so each pass is stable, which LSD radix sort requires.
+        unsigned    slot            = 0 ;
+        bool        allShareDigit   = false ;
+        for( unsigned digit = 0 ; digit < sNumDigitValues ; ++ digit )
+        {   // For each digit value...
+            const unsigned digitBegin = slot ;
+            for( size_t iChunk = 0 ; iChunk < mNumChunks ; ++ iChunk )
+            {   // For each chunk...
+                unsigned &      rSlot = mChunkSlots[ iChunk * sNumDigitValues + digit ] ;
+                const unsigned  count = rSlot ;
+                rSlot = slot ;
+                slot += count ;
+            }
+            allShareDigit = allShareDigit || ( slot - digitBegin == numItems ) ;
+        }
+        ASSERT( numItems == slot ) ;
+
+        if( allShareDigit )
+        {   // Every key has the same value of this digit, so this pass would not move anything.
+            continue ;
+        }
+
+        RunStage( STAGE_SCATTER ) ;
+        std::swap( mKeys  , mScratchKeys  ) ;
+        std::swap( mOrder , mScratchOrder ) ;
+    }
+}
+
+
+
+
+/** Replace the order the previous Sort left, from which the next Sort starts.
+
+    \param order        Item indices, in the order to start from, e.g. the
+                        previous order translated to where items moved since.
+                        Indices of at least numItems, and repeats, get dropped.
+
+    \param orderSize    Number of entries in order.
+
+    \param numItems     Number of items the next Sort will receive.  Items
+                        absent from order get appended in increasing order.
+*/
+void DepthSorter::SetPreviousOrder( const unsigned * order , size_t orderSize , size_t numItems )
+{
+    PERF_BLOCK( DepthSorter__SetPreviousOrder ) ;
+
+    // Use key scratch space to mark which items order includes; Sort overwrites it anyway.
+    mScratchKeys.Resize( numItems ) ;
+    memset( mScratchKeys.Data() , 0 , numItems * sizeof( unsigned ) ) ;
+
+    mOrder.Clear() ;
+    mOrder.Reserve( numItems ) ;
+    for( size_t place = 0 ; place < orderSize ; ++ place )
+    {   // For each place in the given order...
+        const unsigned iItem = order[ place ] ;
+        if( ( iItem < numItems ) && ! mScratchKeys[ iItem ] )
+        {   // Item is valid and not yet placed.
+            mScratchKeys[ iItem ] = 1 ;
+            mOrder.PushBack( iItem ) ;
+        }
+    }
+    for( unsigned iItem = 0 ; iItem < numItems ; ++ iItem )
+    {   // For each item...
+        if( ! mScratchKeys[ iItem ] )
+        {   // Given order lacked this item, e.g. because it is new.
+            mOrder.PushBack( iItem ) ;
+        }
+    }
+    ASSERT( mOrder.Size() == numItems ) ;
+}
+
+
+
+
+/** Make mOrder a permutation of the given number of item indices, keeping the order the previous Sort left.
+
+    When the number of items changed, this keeps the previous order of indices
+    that remain valid, and appends new indices in increasing order.
+*/
+void DepthSorter::SeedOrderFromPrevious( size_t numItems )
+{
+    const size_t numPrevious = mOrder.Size() ;
+
+    if( numItems < numPrevious )
+    {   // Items went away.  Keep indices that remain valid.
+        size_t numKept = 0 ;
+        for( size_t place = 0 ; place < numPrevious ; ++ place )
+        {
+            if( mOrder[ place ] < numItems )
+            {
+                mOrder[ numKept ++ ] = mOrder[ place ] ;
+            }
+        }
+        ASSERT( numItems == numKept ) ;
+        mOrder.Resize( numItems ) ;
+    }
+    else if( numItems > numPrevious )
+    {   // Items arrived.  Append their indices.
+        mOrder.Resize( numItems ) ;
+        for( size_t iItem = numPrevious ; iItem < numItems ; ++ iItem )
+        {
+            mOrder[ iItem ] = static_cast< unsigned >( iItem ) ;
+        }
+    }
+}
+
+
+
+
+/** Run the given stage of Sort for every chunk.
+*/
+void DepthSorter::RunStage( StageE stage )
+{
+    Parallel::For( 0 , mNumChunks , 1 , Parallel::Method( this , & DepthSorter::RunStageForChunks , stage ) ) ;
+}
+
+
+
+
+/** Run the given stage of Sort for the given range of chunks.
+*/
+void DepthSorter::RunStageForChunks( StageE stage , size_t iChunkStart , size_t iChunkEnd )
+{
+    for( size_t iChunk = iChunkStart ; iChunk < iChunkEnd ; ++ iChunk )
+    {
+        RunStageForChunk( iChunk , stage ) ;
+    }
+}
+
+
+
+
+/** Run the given stage of Sort for one chunk of items.
+
+    mChunkSlots has one row per chunk, and one column per digit value.
+    After STAGE_COUNT, each element holds the number of keys in that chunk
+    with that digit value.  Sort then converts those to the slot where that
+    chunk writes its first key with that digit value.
+*/
+void DepthSorter::RunStageForChunk( size_t iChunk , StageE stage )
+{
+    const size_t numItems   = mOrder.Size() ;
+    unsigned *   chunkSlots = & mChunkSlots[ iChunk * sNumDigitValues ] ;
+
+    // Chunk iChunk spans places [itemBegin,itemEnd).
+    const size_t itemBegin  = numItems * iChunk         / mNumChunks ;
+    const size_t itemEnd    = numItems * ( iChunk + 1 ) / mNumChunks ;
+
+    switch( stage )
+    {
+    case STAGE_DEPTH:
+    {
+        float minDepth =   FLT_MAX ;
+        float maxDepth = - FLT_MAX ;
+        for( size_t place = itemBegin ; place < itemEnd ; ++ place )
+        {   // For each item in chunk...
+            const Vec3 &    position    = * reinterpret_cast< const Vec3 * >( mPositions + size_t( mOrder[ place ] ) * mStride ) ;
+            const float     depth       = position * mViewForward ;
+            mDepths[ place ] = depth ;
+            minDepth = Min2( minDepth , depth ) ;
+            maxDepth = Max2( maxDepth , depth ) ;
+        }
+        mChunkMinDepth[ iChunk ] = minDepth ;
+        mChunkMaxDepth[ iChunk ] = maxDepth ;
+    }
+        break ;
+
+    case STAGE_KEY:
+    {
+        static const unsigned maxKey = ( 1 << sNumKeyBits ) - 1 ;
+        bool        isSorted    = true ;
+        unsigned    keyPrev     = 0 ;
+        for( size_t place = itemBegin ; place < itemEnd ; ++ place )
+        {   // For each item in chunk...
+            const unsigned key = Min2( static_cast< unsigned >( ( mDepths[ place ] - mMinDepth ) * mKeysPerDepth ) , maxKey ) ;
+            mKeys[ place ] = key ;
+            isSorted = isSorted && ( key >= keyPrev ) ;
+            keyPrev  = key ;
+        }
+        mChunkIsSorted[ iChunk ] = isSorted ;
+    }
+        break ;
+
+    case STAGE_COUNT:
+        for( unsigned digit = 0 ; digit < sNumDigitValues ; ++ digit )
+        {
+            chunkSlots[ digit ] = 0 ;
+        }
+        for( size_t place = itemBegin ; place < itemEnd ; ++ place )
+        {   // For each item in chunk...
+            ++ chunkSlots[ ( mKeys[ place ] >> mDigitShift ) & ( sNumDigitValues - 1 ) ] ;
+        }
+        break ;
+
+    case STAGE_SCATTER:
+        for( size_t place = itemBegin ; place < itemEnd ; ++ place )
+        {   // For each item in chunk...
+            const unsigned key  = mKeys[ place ] ;
+            const unsigned slot = chunkSlots[ ( key >> mDigitShift ) & ( sNumDigitValues - 1 ) ] ++ ;
+            mScratchKeys [ slot ] = key ;
+            mScratchOrder[ slot ] = mOrder[ place ] ;
+        }
+        break ;
+
+    default:
+        FAIL() ;
+        break ;
+    }
+}
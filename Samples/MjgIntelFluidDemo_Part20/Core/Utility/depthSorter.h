@@ -0,0 +1,98 @@
+/** \file depthSorter.h
+
+    \brief Order of items by depth along a view direction, using a parallel radix sort
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+        - http://www.mijagourlay.com/
+*/
+#ifndef DEPTH_SORTER_H
+#define DEPTH_SORTER_H
+
+#include "Core/Math/vec3.h"
+
+#include "Core/Containers/vector.h"
+
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Order of items by depth along a view direction, using a parallel LSD radix sort.
+
+    Renderers use this to draw translucent particles back-to-front: Sort
+    computes the depth of each item, quantizes depths to integer keys
+    spanning the range of depths, then sorts keys with a least-significant-digit
+    radix sort that runs in parallel when USE_TBB is enabled.  That takes
+    O(N) time, with no comparison callbacks.
+
+    Items with equal keys keep the order they had in the previous call, and
+    Sort starts from that previous order.  Since depths change little from one
+    frame to the next, scatters touch memory mostly in order, and when the
+    previous order remains sorted, Sort skips the radix passes entirely.
+    When items move between indices (e.g. particles killed or reordered),
+    callers that can track them pass the translated order to SetPreviousOrder,
+    so Sort still starts from nearly sorted.
+*/
+class DepthSorter
+{
+        /// Stages of Sort.  Each stage runs once per chunk; chunks of the same stage run concurrently.
+        enum StageE
+        {
+            STAGE_DEPTH     ,   ///< Compute depth of each item in chunk, and the range of depths in chunk.
+            STAGE_KEY       ,   ///< Quantize depth of each item in chunk into a key, and find whether keys in chunk are in order.
+            STAGE_COUNT     ,   ///< Count keys in chunk with each value of the current digit.
+            STAGE_SCATTER       ///< Move keys and indices in chunk to their places, ordered by current digit.
+        } ;
+
+    public:
+        DepthSorter() ;
+
+        void Sort( const char * positions , size_t stride , size_t numItems , const Vec3 & viewForward ) ;
+        void SetPreviousOrder( const unsigned * order , size_t orderSize , size_t numItems ) ;
+
+        /// Return index of the item that belongs at the given place, after Sort.  Place 0 holds the item with the least depth.
+        const unsigned & operator[]( size_t place ) const { return mOrder[ place ] ; }
+
+        /// Return array of item indices, ordered by increasing depth, after Sort.
+        const unsigned * GetOrder() const { return mOrder.Empty() ? 0 : & mOrder[ 0 ] ; }
+
+        /// Forget order, so GetOrder returns NULL until the next Sort.  Keeps memory, so the next Sort need not allocate.
+        void Clear() { mOrder.Clear() ; mKeys.Clear() ; }
+
+        /// Return whether the most recent call to Sort found items already in order, and skipped radix passes; useful for tuning.
+        bool GetWasAlreadySorted() const { return mWasAlreadySorted ; }
+
+    private:
+        void    SeedOrderFromPrevious( size_t numItems ) ;
+        void    RunStage( StageE stage ) ;
+        void    RunStageForChunks( StageE stage , size_t iChunkStart , size_t iChunkEnd ) ;
+        void    RunStageForChunk( size_t iChunk , StageE stage ) ;
+
+        static const unsigned sNumKeyBits       = 16 ;                      ///< Number of bits of precision in quantized depth.
+        static const unsigned sNumDigitBits     = 8 ;                       ///< Number of bits sorted per radix pass.
+        static const unsigned sNumDigitValues   = 1 << sNumDigitBits ;      ///< Number of distinct values of one digit.
+
+        const char *        mPositions          ;   ///< Address of position (Vec3) of first item, during Sort.
+        size_t              mStride             ;   ///< Number of bytes between positions of adjacent items, during Sort.
+        Vec3                mViewForward        ;   ///< Direction along which to measure depth, during Sort.
+        float               mMinDepth           ;   ///< Least depth of any item, during Sort.
+        float               mKeysPerDepth       ;   ///< Scale from depth to key, during Sort.
+        unsigned            mDigitShift         ;   ///< Bit position of current digit, during Sort.
+        size_t              mNumChunks          ;   ///< Number of chunks into which items split, during Sort.
+
+        VECTOR< unsigned >  mOrder              ;   ///< Indices of items, sorted by depth.  Sort starts from the order in which the previous call left these.
+        VECTOR< unsigned >  mKeys               ;   ///< Quantized depth of each item in mOrder.
+        VECTOR< unsigned >  mScratchOrder       ;   ///< Destination of mOrder for each radix pass.
+        VECTOR< unsigned >  mScratchKeys        ;   ///< Destination of mKeys for each radix pass.
+        VECTOR< float >     mDepths             ;   ///< Depth of each item in mOrder.
+        VECTOR< unsigned >  mChunkSlots         ;   ///< Per chunk and digit value, count of keys, then slot where chunk writes its first such key.
+        VECTOR< float >     mChunkMinDepth      ;   ///< Least depth within each chunk.
+        VECTOR< float >     mChunkMaxDepth      ;   ///< Greatest depth within each chunk.
+        VECTOR< char >      mChunkIsSorted      ;   ///< Whether keys within each chunk are in order.
+        bool                mWasAlreadySorted   ;   ///< Whether the most recent Sort found items already in order.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,531 @@
+/** \file parallelExecution.cpp
+
+    \brief Thin layer over Threading Building Blocks to control worker threads and run parallel loops
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include <stdlib.h>
+
+#if defined( WIN32 )
+#   include <windows.h>
+#endif
+
+#include "Core/Math/math.h"
+#include "Core/Utility/macros.h"
+
+#include "parallelExecution.h"
+
+#if USE_TBB && PERF_MEASURE_LOAD_BALANCE
+#   include <string.h>
+#   include "Core/Performance/perfBlock.h"
+#endif
+
+namespace Parallel
+{
+
+// Macros --------------------------------------------------------------
+
+#if defined( _MSC_VER )
+#   define PARALLEL_THREAD_LOCAL __declspec( thread )
+#else
+#   define PARALLEL_THREAD_LOCAL __thread
+#endif
+
+// Private variables --------------------------------------------------------------
+
+Executor * Executor::sCurrent = NULLPTR ;
+
+static PARALLEL_THREAD_LOCAL unsigned sSerialScopeDepth = 0 ;   ///< Number of SerialScope objects that currently exist on this thread.
+
+#if USE_TBB && PERF_MEASURE_LOAD_BALANCE
+static tbb::atomic< unsigned >          sNumLoadBalanceThreads      ;   ///< Number of threads that have recorded a chunk into any LoadBalanceMeter.
+static PARALLEL_THREAD_LOCAL unsigned   sLoadBalanceThreadIndex = 0 ;   ///< One more than index of this thread's tally in each LoadBalanceMeter, or zero if not yet assigned.
+#endif
+
+// Types --------------------------------------------------------------
+
+#if USE_TBB
+    /** Function object to run a node of a task graph, then feed successors whose predecessors have all finished.
+    */
+    class TaskGraphNodeRunner
+    {
+            const VECTOR< TaskGraph::Node > &   mNodes                  ;   ///< Nodes in task graph.
+            tbb::atomic< unsigned > *           mNumPredecessorsPending ;   ///< Number of unfinished predecessors of each node.
+        public:
+            void operator() ( const TaskGraph::NodeId & nodeId , tbb::parallel_do_feeder< TaskGraph::NodeId > & feeder ) const
+            {   // Run task at this node.
+                mFloatingPointState.Apply() ;
+                const TaskGraph::Node & node = mNodes[ nodeId ] ;
+                node.mTask->Run() ;
+                const size_t numSuccessors = node.mSuccessors.Size() ;
+                for( size_t iSuccessor = 0 ; iSuccessor < numSuccessors ; ++ iSuccessor )
+                {   // For each successor of this node...
+                    const TaskGraph::NodeId & successor = node.mSuccessors[ iSuccessor ] ;
+                    if( 1 == mNumPredecessorsPending[ successor ].fetch_and_decrement() )
+                    {   // This was the last unfinished predecessor of that successor, so it can start.
+                        feeder.add( successor ) ;
+                    }
+                }
+            }
+            TaskGraphNodeRunner( const VECTOR< TaskGraph::Node > & nodes , tbb::atomic< unsigned > * numPredecessorsPending )
+                : mNodes( nodes )
+                , mNumPredecessorsPending( numPredecessorsPending )
+            {}
+        private:
+            TaskGraphNodeRunner & operator=( const TaskGraphNodeRunner & ) ; // Disallow assignment
+
+            FloatingPointState  mFloatingPointState ;   ///< Floating-point settings of the thread that runs the graph.
+    } ;
+
+
+    /// Function object to run parallel_do over the roots of a task graph, to run inside a task_arena.
+    class TaskGraphRootsRunner
+    {
+        public:
+            TaskGraphRootsRunner( const VECTOR< TaskGraph::NodeId > & roots , const TaskGraphNodeRunner & runNode ) : mRoots( roots ) , mRunNode( runNode ) {}
+            void operator()() const { tbb::parallel_do( mRoots.Begin() , mRoots.End() , mRunNode ) ; }
+        private:
+            TaskGraphRootsRunner & operator=( const TaskGraphRootsRunner & ) ; // Disallow assignment
+            const VECTOR< TaskGraph::NodeId > & mRoots      ;
+            const TaskGraphNodeRunner &         mRunNode    ;
+    } ;
+#endif
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Return unsigned value of the given environment variable, or the given default if it is not set.
+*/
+static unsigned GetEnvironmentUnsigned( const char * name , unsigned defaultValue )
+{
+    const char * strValue = getenv( name ) ;
+    if( strValue != 0 )
+    {   // Environment contains a value.
+        return unsigned( atoi( strValue ) ) ;
+    }
+    return defaultValue ;
+}
+
+
+
+
+/** Return settings that the environment requests.
+
+    FLUID_NUM_THREADS sets mNumThreads,
+    FLUID_FIRST_CORE sets mFirstCore, and
+    FLUID_PIN_THREADS (nonzero) sets mPinThreads.
+    Variables not in the environment leave the default.
+*/
+Settings SettingsFromEnvironment()
+{
+    Settings settings ;
+    settings.mNumThreads = GetEnvironmentUnsigned( "FLUID_NUM_THREADS" , settings.mNumThreads ) ;
+    settings.mFirstCore  = GetEnvironmentUnsigned( "FLUID_FIRST_CORE"  , settings.mFirstCore ) ;
+    settings.mPinThreads = GetEnvironmentUnsigned( "FLUID_PIN_THREADS" , settings.mPinThreads ? 1 : 0 ) != 0 ;
+    return settings ;
+}
+
+
+
+
+/** Return number of threads parallel work uses, including the calling thread.
+
+    If no Executor exists, this returns the number of processors.
+*/
+unsigned GetNumThreads()
+{
+    if( Executor::GetCurrent() )
+    {
+        return Executor::GetCurrent()->GetNumThreads() ;
+    }
+#if USE_TBB
+    const unsigned numberOfProcessors = GetNumberOfProcessors() ;
+    return numberOfProcessors > 0 ? numberOfProcessors : 1 ;
+#else
+    return 1 ;
+#endif
+}
+
+
+
+
+/** Return whether parallel work this thread starts runs serially, because a SerialScope exists on this thread.
+*/
+bool IsSerial()
+{
+    return sSerialScopeDepth > 0 ;
+}
+
+
+
+
+SerialScope::SerialScope()
+{
+    ++ sSerialScopeDepth ;
+}
+
+
+
+
+SerialScope::~SerialScope()
+{
+    ASSERT( sSerialScopeDepth > 0 ) ;
+    -- sSerialScopeDepth ;
+}
+
+
+
+
+#if USE_TBB && PERF_MEASURE_LOAD_BALANCE
+
+/** Start measuring load balance of a parallel loop.
+*/
+LoadBalanceMeter::LoadBalanceMeter()
+{
+    memset( mThreadTallies , 0 , sizeof( mThreadTallies ) ) ;
+    mBeginTicks = ReadTicks() ;
+}
+
+
+
+
+/** Finish measuring load balance of a parallel loop, and add a summary to the PerfBlock tally of the calling thread.
+*/
+LoadBalanceMeter::~LoadBalanceMeter()
+{
+    const long long endTicks = ReadTicks() ;
+
+    PerfLoadBalanceStats stats ;
+    long long busyTicks = 0 ;
+    for( unsigned iThread = 0 ; iThread < MAX_NUM_THREADS ; ++ iThread )
+    {   // For each thread tally...
+        const ThreadTally & tally = mThreadTallies[ iThread ] ;
+        busyTicks                   += tally.mBusyTicks ;
+        stats.mNumChunks            += double( tally.mNumChunks ) ;
+        stats.mMaxBusyPerThreadTicks = Max2( stats.mMaxBusyPerThreadTicks , double( tally.mBusyTicks     ) ) ;
+        stats.mMaxChunkTicks         = Max2( stats.mMaxChunkTicks         , double( tally.mMaxChunkTicks ) ) ;
+    }
+    if( 0.0 == stats.mNumChunks )
+    {   // Loop ran no chunks, so there is nothing to report.
+        return ;
+    }
+    stats.mNumLoops                 = 1 ;
+    stats.mWallTicks                = double( endTicks - mBeginTicks ) ;
+    stats.mBusyTicks                = double( busyTicks ) ;
+    stats.mMeanBusyPerThreadTicks   = double( busyTicks ) / double( GetNumThreads() ) ;
+    PerfBlock::AccumulateLoadBalanceThisThread( stats ) ;
+}
+
+
+
+
+/** Record that the current thread ran a chunk of this loop between the given times.
+*/
+void LoadBalanceMeter::RecordChunk( long long beginTicks , long long endTicks )
+{
+    if( 0 == sLoadBalanceThreadIndex )
+    {   // This thread has not recorded any chunks yet, so give it a tally slot.
+        sLoadBalanceThreadIndex = sNumLoadBalanceThreads.fetch_and_increment() % MAX_NUM_THREADS + 1 ;
+    }
+    ThreadTally &   tally       = mThreadTallies[ sLoadBalanceThreadIndex - 1 ] ;
+    const long long chunkTicks  = endTicks - beginTicks ;
+    tally.mBusyTicks    += chunkTicks ;
+    tally.mMaxChunkTicks = Max2( tally.mMaxChunkTicks , chunkTicks ) ;
+    ++ tally.mNumChunks ;
+}
+
+
+
+
+/** Return current time, in the same ticks PerfBlock uses.
+*/
+/* static */ long long LoadBalanceMeter::ReadTicks()
+{
+    LARGE_INTEGER ticks ;
+    QueryPerformanceCounter( & ticks ) ;
+    return ticks.QuadPart ;
+}
+
+#endif
+
+
+
+
+/** Add a node to this graph.
+
+    \param task    Work to do at this node.  It must outlive calls to Run.
+
+    \return Identifier of the new node, to pass to AddEdge.
+*/
+TaskGraph::NodeId TaskGraph::AddNode( Task & task )
+{
+    const NodeId nodeId = NodeId( mNodes.Size() ) ;
+    mNodes.PushBack( Node() ) ;
+    mNodes.Back().mTask             = & task ;
+    mNodes.Back().mNumPredecessors  = 0 ;
+    return nodeId ;
+}
+
+
+
+
+/** Make the given successor node wait for the given predecessor node to finish.
+*/
+void TaskGraph::AddEdge( NodeId predecessor , NodeId successor )
+{
+    ASSERT( predecessor < successor ) ;   // Predecessors must be added before successors, so running nodes in order respects dependencies.
+    ASSERT( successor < mNodes.Size() ) ;
+    mNodes[ predecessor ].mSuccessors.PushBack( successor ) ;
+    ++ mNodes[ successor ].mNumPredecessors ;
+}
+
+
+
+
+/** Run every task in this graph, each after all its predecessors, and return after all finish.
+*/
+void TaskGraph::Run()
+{
+    const size_t numNodes = mNodes.Size() ;
+#if USE_TBB
+    if( IsSerial() )
+    {   // Caller runs other work concurrently, so run tasks in the order added, on this thread.
+        for( size_t iNode = 0 ; iNode < numNodes ; ++ iNode )
+        {   // For each node, in the order added, which respects dependencies...
+            mNodes[ iNode ].mTask->Run() ;
+        }
+        return ;
+    }
+
+    tbb::atomic< unsigned > *   numPredecessorsPending = new tbb::atomic< unsigned >[ numNodes ] ;
+    VECTOR< NodeId >            roots ;
+    for( size_t iNode = 0 ; iNode < numNodes ; ++ iNode )
+    {   // For each node...
+        numPredecessorsPending[ iNode ] = mNodes[ iNode ].mNumPredecessors ;
+        if( 0 == mNodes[ iNode ].mNumPredecessors )
+        {   // Node can start immediately.
+            roots.PushBack( NodeId( iNode ) ) ;
+        }
+    }
+
+    const TaskGraphNodeRunner   runNode( mNodes , numPredecessorsPending ) ;
+    const TaskGraphRootsRunner  runRoots( roots , runNode ) ;
+#   if USE_ONETBB
+    if( Executor::GetCurrent() )
+    {
+        Executor::GetCurrent()->GetArena().execute( runRoots ) ;
+    }
+    else
+#   endif
+    {
+        runRoots() ;
+    }
+
+    delete [] numPredecessorsPending ;
+#else
+    for( size_t iNode = 0 ; iNode < numNodes ; ++ iNode )
+    {   // For each node, in the order added, which respects dependencies...
+        mNodes[ iNode ].mTask->Run() ;
+    }
+#endif
+}
+
+
+
+
+#if USE_TBB
+
+#if USE_ONETBB
+ThreadPinner::ThreadPinner( tbb::task_arena & arena , unsigned firstCore )
+    : tbb::task_scheduler_observer( arena )
+#else
+ThreadPinner::ThreadPinner( unsigned firstCore )
+    : tbb::task_scheduler_observer()
+#endif
+    , mFirstCore( firstCore )
+    , mNumCores( GetNumberOfProcessors() )
+{
+    mNumThreadsPinned = 0 ;
+    observe( true ) ;
+}
+
+
+
+
+ThreadPinner::~ThreadPinner()
+{
+    observe( false ) ;
+}
+
+
+
+
+/** Pin the thread entering the scheduler to the next available processor core.
+
+    Threads get consecutive cores starting at mFirstCore, wrapping around if
+    there are more threads than cores.
+
+    \note Only Windows builds pin threads.  Elsewhere, this does nothing.
+*/
+void ThreadPinner::on_scheduler_entry( bool /* isWorker */ )
+{
+    const unsigned threadIndex  = mNumThreadsPinned.fetch_and_increment() ;
+    const unsigned numCores     = mNumCores > 0 ? mNumCores : 1 ;
+    const unsigned core         = ( mFirstCore + threadIndex ) % numCores ;
+#if defined( WIN32 )
+    if( core < sizeof( DWORD_PTR ) * 8 )
+    {   // Core fits in affinity mask.
+        SetThreadAffinityMask( GetCurrentThread() , DWORD_PTR( 1 ) << core ) ;
+    }
+#else
+    (void) core ;
+#endif
+}
+
+#endif
+
+
+
+
+/** Split items into contiguous chunks of roughly equal total cost.
+
+    \param costs       Estimated cost of each item.  Must be non-negative.  Need only be proportional to actual cost.
+
+    \param numItems    Number of items.
+
+    \param numChunks   Number of chunks to make.  This makes fewer if there are fewer items,
+                        or if individual items cost more than a chunk should.
+*/
+void CostPartition::Assign( const float * costs , size_t numItems , size_t numChunks )
+{
+    mChunkBegins.Clear() ;
+    mChunkBegins.PushBack( 0 ) ;
+    if( 0 == numItems )
+    {   // No items, so no chunks.
+        return ;
+    }
+
+    numChunks = Clamp( numChunks , size_t( 1 ) , numItems ) ;
+    mChunkBegins.Reserve( numChunks + 1 ) ;
+
+    double totalCost = 0.0 ;
+    for( size_t iItem = 0 ; iItem < numItems ; ++ iItem )
+    {   // For each item...
+        ASSERT( costs[ iItem ] >= 0.0f ) ;
+        totalCost += costs[ iItem ] ;
+    }
+
+    if( totalCost <= 0.0 )
+    {   // Items cost nothing, so split them evenly.
+        for( size_t iChunk = 1 ; iChunk < numChunks ; ++ iChunk )
+        {   // For each chunk after the first...
+            mChunkBegins.PushBack( iChunk * numItems / numChunks ) ;
+        }
+        mChunkBegins.PushBack( numItems ) ;
+        return ;
+    }
+
+    // Close each chunk once the cumulative cost reaches its share of the total.
+    const double    costPerChunk    = totalCost / double( numChunks ) ;
+    double          cumulativeCost  = 0.0 ;
+    double          chunkEndCost    = costPerChunk ;
+    for( size_t iItem = 0 ; iItem + 1 < numItems ; ++ iItem )
+    {   // For each item except the last, which always ends the last chunk...
+        cumulativeCost += costs[ iItem ] ;
+        if( cumulativeCost >= chunkEndCost )
+        {   // This item fills its chunk.
+            mChunkBegins.PushBack( iItem + 1 ) ;
+            while( chunkEndCost <= cumulativeCost )
+            {   // Skip shares this item consumed, so costly items do not make empty chunks.
+                chunkEndCost += costPerChunk ;
+            }
+        }
+    }
+    mChunkBegins.PushBack( numItems ) ;
+}
+
+
+
+
+/** Construct executor that obeys the given settings.
+*/
+Executor::Executor( const Settings & settings )
+#if USE_TBB && ! USE_ONETBB
+    : mTaskSchedulerInit( tbb::task_scheduler_init::deferred )
+#endif
+{
+    Initialize( settings ) ;
+}
+
+
+
+
+/** Construct executor that obeys settings from the environment.
+
+    \see SettingsFromEnvironment.
+*/
+Executor::Executor()
+#if USE_TBB && ! USE_ONETBB
+    : mTaskSchedulerInit( tbb::task_scheduler_init::deferred )
+#endif
+{
+    Initialize( SettingsFromEnvironment() ) ;
+}
+
+
+
+
+Executor::~Executor()
+{
+    ASSERT( this == sCurrent ) ;
+#if USE_TBB
+    delete mThreadPinner ;
+#   if USE_ONETBB
+    delete mGlobalControl ;
+#   endif
+#endif
+    sCurrent = NULLPTR ;
+}
+
+
+
+
+/** Start threads according to the given settings and make this the current executor.
+*/
+void Executor::Initialize( const Settings & settings )
+{
+    ASSERT( NULLPTR == sCurrent ) ;   // Only one Executor should exist at a time.
+
+#if USE_TBB
+    const unsigned numberOfProcessors = GetNumberOfProcessors() ;
+    if( settings.mNumThreads > 0 )
+    {   // Settings request a specific number of threads.
+        mNumThreads = settings.mNumThreads ;
+    }
+    else
+    {   // Use one thread per processor.
+        mNumThreads = numberOfProcessors > 0 ? numberOfProcessors : 1 ;
+    }
+
+#   if USE_ONETBB
+    mArena.initialize( int( mNumThreads ) ) ;
+    mGlobalControl = new tbb::global_control( tbb::global_control::max_allowed_parallelism , mNumThreads ) ;
+    mThreadPinner  = settings.mPinThreads ? new ThreadPinner( mArena , settings.mFirstCore ) : NULLPTR ;
+#   else
+    mTaskSchedulerInit.initialize( int( mNumThreads ) ) ;
+    mThreadPinner  = settings.mPinThreads ? new ThreadPinner( settings.mFirstCore ) : NULLPTR ;
+#   endif
+#else
+    (void) settings ;
+    mNumThreads = 1 ;
+#endif
+
+    sCurrent = this ;
+}
+
+} ;
@@ -0,0 +1,1241 @@
+/** \file parallelExecution.h
+
+    \brief Thin layer over Threading Building Blocks to control worker threads and run parallel loops
+
+    Simulation code calls Parallel::For, Parallel::Reduce and Parallel::Invoke
+    instead of calling TBB directly.  That confines differences between
+    classic TBB and oneTBB to this file, lets an application choose how many
+    threads to use and which processor cores they run on, and gives loops a
+    range type that exists even when USE_TBB is 0.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARALLEL_EXECUTION_H
+#define PARALLEL_EXECUTION_H
+
+#include "Core/useTbb.h"
+
+#include "Core/Containers/vector.h"
+#include "Core/Math/math.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/Performance/perfLoadBalance.h"
+#include "Core/Utility/macros.h"
+
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+
+/** Whether parallel reductions yield bit-identical results regardless of number of threads.
+
+    Floating-point addition is not associative, so the result of a reduction
+    depends on how its range splits and in what order partial results join.
+    Normally TBB decides both according to thread timing, and callers choose
+    grain sizes according to number of processors, so results vary from run
+    to run and machine to machine.
+
+    When this is enabled, Parallel::Reduce splits its range into a fixed
+    number of chunks, PARALLEL_DETERMINISTIC_NUM_CHUNKS, which depends only on
+    the size of the range, and joins chunk results in index order, and
+    Parallel::GetReductionGrainSize returns a grain size that also depends
+    only on the size of the problem.  That lets you validate an optimized,
+    multi-threaded build against a reference run, instead of disabling TBB.
+
+    Reductions that do not sum floats (e.g. bounding boxes) and loops without
+    reductions are deterministic either way.  Builds with USE_TBB disabled
+    are deterministic too, but their results differ from multi-threaded
+    builds, since a serial loop sums in a single chunk.
+*/
+#define PARALLEL_DETERMINISTIC 0
+
+/// Number of chunks into which deterministic reductions split their range.  Should exceed number of processors, so threads balance load.
+#define PARALLEL_DETERMINISTIC_NUM_CHUNKS 64
+
+/** Number of chunks per thread into which GetGrainSize and CostPartition split loops.
+
+    One chunk per thread leaves every other thread idle while the slowest
+    chunk finishes, and vorton distributions are rarely uniform, so chunks
+    rarely cost the same.  Several chunks per thread let TBB steal work to
+    balance load, at the cost of a little scheduling overhead per chunk.
+*/
+#define PARALLEL_CHUNKS_PER_THREAD 8
+
+// Types --------------------------------------------------------------
+
+namespace Parallel
+{
+#if USE_TBB
+    typedef tbb::blocked_range< size_t >    Range   ;   ///< Half-open range of loop indices passed to loop bodies.
+    typedef tbb::blocked_range3d< size_t >  Range3d ;   ///< Half-open box of loop indices passed to loop bodies.
+#else
+    /** Half-open range of loop indices, with the subset of the tbb::blocked_range interface loop bodies use.
+    */
+    class Range
+    {
+        public:
+            Range( size_t begin , size_t end , size_t /* grainSize */ = 1 ) : mBegin( begin ) , mEnd( end ) {}
+            size_t  begin() const   { return mBegin ; }
+            size_t  end() const     { return mEnd ; }
+            size_t  size() const    { return mEnd - mBegin ; }
+            bool    empty() const   { return mEnd <= mBegin ; }
+        private:
+            size_t  mBegin  ;   ///< First index in range.
+            size_t  mEnd    ;   ///< One past last index in range.
+    } ;
+
+    /** Half-open box of loop indices, with the subset of the tbb::blocked_range3d interface loop bodies use.
+    */
+    class Range3d
+    {
+        public:
+            Range3d( size_t pageBegin , size_t pageEnd , size_t rowBegin , size_t rowEnd , size_t colBegin , size_t colEnd )
+                : mPages( pageBegin , pageEnd ) , mRows( rowBegin , rowEnd ) , mCols( colBegin , colEnd ) {}
+            const Range &   pages() const   { return mPages ; }
+            const Range &   rows() const    { return mRows ; }
+            const Range &   cols() const    { return mCols ; }
+        private:
+            Range   mPages  ;   ///< Outermost (e.g. z) index range.
+            Range   mRows   ;   ///< Middle (e.g. y) index range.
+            Range   mCols   ;   ///< Innermost (e.g. x) index range.
+    } ;
+#endif
+
+
+    /** How to run parallel work.
+    */
+    struct Settings
+    {
+        Settings()
+            : mNumThreads( 0 )
+            , mFirstCore( 0 )
+            , mPinThreads( false )
+        {}
+
+        unsigned    mNumThreads ;   ///< Maximum number of threads, including the calling thread.  Zero means one per processor.
+        unsigned    mFirstCore  ;   ///< Index of first processor core to use, when mPinThreads is true.
+        bool        mPinThreads ;   ///< Whether to pin each thread to its own processor core, consecutively from mFirstCore.
+    } ;
+
+
+#if USE_TBB
+    /** Observer that pins each thread that joins the scheduler to its own processor core.
+    */
+    class ThreadPinner : public tbb::task_scheduler_observer
+    {
+        public:
+        #if USE_ONETBB
+            ThreadPinner( tbb::task_arena & arena , unsigned firstCore ) ;
+        #else
+            explicit ThreadPinner( unsigned firstCore ) ;
+        #endif
+            virtual ~ThreadPinner() ;
+
+            virtual void on_scheduler_entry( bool isWorker ) ;
+
+        private:
+            unsigned                mFirstCore          ;   ///< Index of first processor core to use.
+            unsigned                mNumCores           ;   ///< Number of processor cores available.
+            tbb::atomic< unsigned > mNumThreadsPinned   ;   ///< Number of threads pinned so far, used to assign cores.
+    } ;
+#endif
+
+
+    /** Record of which thread ran which part of a loop, so the next run of that loop can assign each part to the same thread.
+
+        Loops that revisit the same data each time step (e.g. gridpoints of a
+        grid whose shape rarely changes) run faster when each chunk runs on
+        the thread whose cache already holds its data.  Keep one of these per
+        loop, persistent across runs, and pass it to Parallel::For or
+        Parallel::ForWeighted.
+
+        With classic TBB and oneTBB this wraps tbb::affinity_partitioner.
+        That is not copyable, so copying one of these yields a new, empty
+        record, which only costs the next run its cache affinity.  When
+        USE_TBB is 0, this is empty.
+    */
+    class AffinityPartitioner
+    {
+        public:
+            AffinityPartitioner() {}
+            AffinityPartitioner( const AffinityPartitioner & ) {}                               // Copy starts with empty record.
+            AffinityPartitioner & operator=( const AffinityPartitioner & ) { return * this ; }  // Assignment retains record.
+
+        #if USE_TBB
+            /// Return record TBB uses.
+            tbb::affinity_partitioner & GetTbbPartitioner() { return mPartitioner ; }
+
+        private:
+            tbb::affinity_partitioner   mPartitioner    ;   ///< Which thread ran which part of the most recent run.
+        #endif
+    } ;
+
+
+    /** Split of a range of items into contiguous chunks of roughly equal total cost.
+
+        Splitting a loop into chunks with equal numbers of items balances load
+        poorly when items cost unequal amounts, for example z slices of a grid
+        that vortons occupy unevenly.  Assign splits so each chunk has
+        roughly equal total cost, given an estimate of the cost of each item.
+        Estimates need only be proportional to actual costs.
+    */
+    class CostPartition
+    {
+        public:
+            void    Assign( const float * costs , size_t numItems , size_t numChunks ) ;
+
+            /// Return number of chunks, which can be fewer than requested if there are few items.
+            size_t  GetNumChunks() const                { return mChunkBegins.Empty() ? 0 : mChunkBegins.Size() - 1 ; }
+
+            /// Return index of first item in the given chunk.  Index GetNumChunks yields one past the last item.
+            size_t  GetChunkBegin( size_t iChunk ) const { return mChunkBegins[ iChunk ] ; }
+
+        private:
+            VECTOR< size_t >    mChunkBegins    ;   ///< Index of first item in each chunk, followed by number of items.
+    } ;
+
+
+    /// Function object to run body over each of a contiguous set of chunks of a CostPartition, for Parallel::ForWeighted.
+    template< class BodyT > class ForChunks
+    {
+        public:
+            ForChunks( const CostPartition & partition , const BodyT & body ) : mPartition( partition ) , mBody( body ) {}
+            void operator()( const Range & r ) const
+            {
+                for( size_t iChunk = r.begin() ; iChunk < r.end() ; ++ iChunk )
+                {   // For each chunk in this subrange...
+                    const size_t chunkBegin = mPartition.GetChunkBegin( iChunk ) ;
+                    const size_t chunkEnd   = mPartition.GetChunkBegin( iChunk + 1 ) ;
+                    mBody( Range( chunkBegin , chunkEnd , Max2( chunkEnd - chunkBegin , size_t( 1 ) ) ) ) ;
+                }
+            }
+        private:
+            ForChunks & operator=( const ForChunks & ) ; // Disallow assignment
+            const CostPartition &   mPartition  ;   ///< Split of items into chunks.
+            const BodyT &           mBody       ;   ///< Loop body to run over items of each chunk.
+    } ;
+
+
+    /** Scope within which parallel work that the constructing thread starts runs serially, on that thread.
+
+        While one of these exists, Parallel::For, For3d, ForTiles, Reduce,
+        Invoke and TaskGraph::Run, on the thread that constructed it, call
+        their bodies directly instead of spawning tasks.  Other threads are
+        unaffected.  That lets a caller run many small, independent jobs
+        concurrently, one per thread, without each job paying to schedule
+        parallel loops too small to amortize that cost.
+
+        Scopes nest.  Construct and destroy each on the same thread.
+    */
+    class SerialScope
+    {
+        public:
+            SerialScope() ;
+            ~SerialScope() ;
+
+        private:
+            SerialScope( const SerialScope & ) ;                // Disallow copy
+            SerialScope & operator=( const SerialScope & ) ;    // Disallow assignment
+    } ;
+
+
+    /** Unit of work that a TaskGraph runs.
+    */
+    class Task
+    {
+        public:
+            virtual ~Task() {}
+            virtual void Run() = 0 ;
+    } ;
+
+
+    /** Set of tasks with dependencies, run so each task starts only after all its predecessors finish.
+
+        Tasks that have no path between them can run concurrently.  That lets
+        idle threads pick up independent work instead of waiting at a barrier
+        after each stage.
+
+        Each predecessor must be added before its successors.  When USE_TBB is 0,
+        or inside a SerialScope, tasks run in the order they were added.
+    */
+    class TaskGraph
+    {
+        public:
+            typedef unsigned NodeId ;
+
+            NodeId  AddNode( Task & task ) ;
+            void    AddEdge( NodeId predecessor , NodeId successor ) ;
+            void    Run() ;
+
+            /// Node in a task graph.
+            struct Node
+            {
+                Task *              mTask               ;   ///< Work to do at this node.
+                VECTOR< NodeId >    mSuccessors         ;   ///< Nodes that cannot start until this one finishes.
+                unsigned            mNumPredecessors    ;   ///< Number of nodes that must finish before this one starts.
+            } ;
+
+        private:
+            VECTOR< Node >  mNodes  ;   ///< Nodes in this graph, in the order they were added.
+    } ;
+
+
+    /** Scoped owner of the threads that run parallel work.
+
+        Construct one (e.g. as a member of the application object) before running
+        parallel work, and destroy it afterward.  While it exists, Parallel::For,
+        Parallel::Reduce and Parallel::Invoke obey its Settings.
+
+        With classic TBB this wraps tbb::task_scheduler_init.  With oneTBB this
+        wraps a tbb::task_arena, plus a tbb::global_control so that code that
+        still calls TBB directly also obeys the thread count.
+
+        Only one Executor should exist at a time.
+    */
+    class Executor
+    {
+        public:
+            explicit Executor( const Settings & settings ) ;
+            Executor() ;
+            ~Executor() ;
+
+            /// Return number of threads this executor uses, including the calling thread.
+            unsigned GetNumThreads() const { return mNumThreads ; }
+
+            /// Return the executor that currently exists, or NULL if there is none.
+            static Executor * GetCurrent() { return sCurrent ; }
+
+        #if USE_ONETBB
+            /// Return arena in which this executor runs parallel work.
+            tbb::task_arena & GetArena() { return mArena ; }
+        #endif
+
+        private:
+            Executor( const Executor & ) ;              // Disallow copy
+            Executor & operator=( const Executor & ) ;  // Disallow assignment
+
+            void Initialize( const Settings & settings ) ;
+
+            unsigned                    mNumThreads         ;   ///< Number of threads this executor uses, including the calling thread.
+        #if USE_TBB
+        #   if USE_ONETBB
+            tbb::task_arena             mArena              ;   ///< Arena in which parallel work runs.
+            tbb::global_control *       mGlobalControl      ;   ///< Limit on parallelism of work that runs outside mArena.
+        #   else
+            tbb::task_scheduler_init    mTaskSchedulerInit  ;   ///< Classic TBB scheduler.
+        #   endif
+            ThreadPinner *              mThreadPinner       ;   ///< Observer that pins threads to cores, or NULL if not pinning.
+        #endif
+
+            static Executor *           sCurrent            ;   ///< Executor that currently exists, or NULL.
+    } ;
+
+
+#if USE_ONETBB
+    /// Function object to run parallel_for inside a task_arena, since this code cannot use lambdas.
+    template< class BodyT > class ForInArena
+    {
+        public:
+            ForInArena( const Range & range , const BodyT & body ) : mRange( range ) , mBody( body ) {}
+            void operator()() const { tbb::parallel_for( mRange , mBody ) ; }
+        private:
+            ForInArena & operator=( const ForInArena & ) ; // Disallow assignment
+            const Range &   mRange  ;
+            const BodyT &   mBody   ;
+    } ;
+
+    /// Function object to run parallel_for with an affinity partitioner inside a task_arena, since this code cannot use lambdas.
+    template< class BodyT > class ForWithAffinityInArena
+    {
+        public:
+            ForWithAffinityInArena( const Range & range , const BodyT & body , tbb::affinity_partitioner & partitioner ) : mRange( range ) , mBody( body ) , mPartitioner( partitioner ) {}
+            void operator()() const { tbb::parallel_for( mRange , mBody , mPartitioner ) ; }
+        private:
+            ForWithAffinityInArena & operator=( const ForWithAffinityInArena & ) ; // Disallow assignment
+            const Range &                   mRange          ;
+            const BodyT &                   mBody           ;
+            tbb::affinity_partitioner &     mPartitioner    ;
+    } ;
+
+    /// Function object to run parallel_for over a box inside a task_arena, since this code cannot use lambdas.
+    template< class BodyT > class For3dInArena
+    {
+        public:
+            For3dInArena( const Range3d & range , const BodyT & body ) : mRange( range ) , mBody( body ) {}
+            void operator()() const { tbb::parallel_for( mRange , mBody ) ; }
+        private:
+            For3dInArena & operator=( const For3dInArena & ) ; // Disallow assignment
+            const Range3d & mRange  ;
+            const BodyT &   mBody   ;
+    } ;
+
+    /// Function object to run parallel_reduce inside a task_arena, since this code cannot use lambdas.
+    template< class BodyT > class ReduceInArena
+    {
+        public:
+            ReduceInArena( const Range & range , BodyT & body ) : mRange( range ) , mBody( body ) {}
+            void operator()() const { tbb::parallel_reduce( mRange , mBody ) ; }
+        private:
+            ReduceInArena & operator=( const ReduceInArena & ) ; // Disallow assignment
+            const Range &   mRange  ;
+            BodyT &         mBody   ;
+    } ;
+
+    /// Function object to run parallel_invoke inside a task_arena, since this code cannot use lambdas.
+    template< class Func0T , class Func1T > class InvokeInArena
+    {
+        public:
+            InvokeInArena( const Func0T & func0 , const Func1T & func1 ) : mFunc0( func0 ) , mFunc1( func1 ) {}
+            void operator()() const { tbb::parallel_invoke( mFunc0 , mFunc1 ) ; }
+        private:
+            InvokeInArena & operator=( const InvokeInArena & ) ; // Disallow assignment
+            const Func0T &  mFunc0  ;
+            const Func1T &  mFunc1  ;
+    } ;
+#endif
+
+
+#if USE_TBB && PERF_MEASURE_LOAD_BALANCE
+    /** Tally of chunks one parallel loop ran on each thread, which summarizes itself into the calling thread's PerfBlock upon destruction.
+
+        \see PERF_MEASURE_LOAD_BALANCE
+    */
+    class LoadBalanceMeter
+    {
+        public:
+            LoadBalanceMeter() ;
+            ~LoadBalanceMeter() ;
+
+            void                RecordChunk( long long beginTicks , long long endTicks ) ;
+            static long long    ReadTicks() ;
+
+        private:
+            LoadBalanceMeter( const LoadBalanceMeter & ) ;              // Disallow copy
+            LoadBalanceMeter & operator=( const LoadBalanceMeter & ) ;  // Disallow assignment
+
+            static const unsigned MAX_NUM_THREADS = 64 ;    ///< Number of threads this distinguishes.  Threads beyond this share tallies, so their durations merge.
+
+            /// Tally of chunks that one thread ran, padded to its own cache line so threads do not contend.
+            struct ThreadTally
+            {
+                long long   mBusyTicks      ;   ///< Sum of durations of chunks this thread ran.
+                long long   mMaxChunkTicks  ;   ///< Duration of longest chunk this thread ran.
+                unsigned    mNumChunks      ;   ///< Number of chunks this thread ran.
+                char        mPadding[ 64 - 2 * sizeof( long long ) - sizeof( unsigned ) ] ;
+            } ;
+
+            ThreadTally         mThreadTallies[ MAX_NUM_THREADS ] ; ///< Tally of chunks each thread ran.
+            long long           mBeginTicks                     ;   ///< Time when loop began.
+    } ;
+
+
+    /// Function object to time each chunk of a loop body, for Parallel::For and For3d.
+    template< class BodyT > class MeasuredBody
+    {
+        public:
+            MeasuredBody( const BodyT & body , LoadBalanceMeter & meter ) : mBody( body ) , mMeter( meter ) {}
+            template< class RangeT > void operator()( const RangeT & r ) const
+            {
+                const long long beginTicks = LoadBalanceMeter::ReadTicks() ;
+                mBody( r ) ;
+                mMeter.RecordChunk( beginTicks , LoadBalanceMeter::ReadTicks() ) ;
+            }
+        private:
+            MeasuredBody & operator=( const MeasuredBody & ) ; // Disallow assignment
+            const BodyT &       mBody   ;   ///< Loop body to time.
+            LoadBalanceMeter &  mMeter  ;   ///< Tally into which to record chunk durations.
+    } ;
+#endif
+
+
+#if USE_TBB && PARALLEL_DETERMINISTIC
+    /// Function object to run each of a fixed set of reduction chunks into its own body, for Parallel::Reduce.
+    template< class BodyT > class ReduceChunks
+    {
+        public:
+            ReduceChunks( BodyT * const * chunkBodies , size_t begin , size_t end , size_t chunkSize )
+                : mChunkBodies( chunkBodies ) , mBegin( begin ) , mEnd( end ) , mChunkSize( chunkSize ) {}
+            void operator()( const Range & r ) const
+            {
+                for( size_t iChunk = r.begin() ; iChunk < r.end() ; ++ iChunk )
+                {   // For each chunk in this subrange...
+                    const size_t chunkBegin = mBegin + iChunk * mChunkSize ;
+                    ( * mChunkBodies[ iChunk ] )( Range( chunkBegin , Min2( chunkBegin + mChunkSize , mEnd ) ) ) ;
+                }
+            }
+        private:
+            ReduceChunks & operator=( const ReduceChunks & ) ; // Disallow assignment
+            BodyT * const * mChunkBodies    ;   ///< Body into which each chunk reduces.
+            const size_t    mBegin          ;   ///< First index of whole range.
+            const size_t    mEnd            ;   ///< One past last index of whole range.
+            const size_t    mChunkSize      ;   ///< Number of indices per chunk, except possibly the last.
+    } ;
+#endif
+
+
+    /** Floating-point control word and MMX control status register of the thread that constructed this.
+
+        Worker threads start with their own floating-point settings, so
+        unless loop bodies impose those of the thread that started the loop,
+        results (e.g. rounding, and whether denormals flush to zero) depend
+        on which thread ran which subrange.  When USE_TBB is 0, loops run on
+        the calling thread, so this is empty.
+    */
+    class FloatingPointState
+    {
+        public:
+        #if USE_TBB
+            FloatingPointState()
+                : mFloatingPointControlWord( GetFloatingPointControlWord() )
+                , mMmxControlStatusRegister( GetMmxControlStatusRegister() )
+            {}
+
+            /// Impose these settings on the calling thread.
+            void Apply() const
+            {
+                SetFloatingPointControlWord( mFloatingPointControlWord ) ;
+                SetMmxControlStatusRegister( mMmxControlStatusRegister ) ;
+            }
+
+        private:
+            WORD        mFloatingPointControlWord   ;   ///< x87 control word of constructing thread.
+            unsigned    mMmxControlStatusRegister   ;   ///< MXCSR of constructing thread.
+        #else
+            void Apply() const {}
+        #endif
+    } ;
+
+
+    /// Placeholder for unused arguments of FunctionBody, MethodBody and ReduceBody.
+    struct NoArg {} ;
+
+    /// Type T, in a context from which function templates cannot deduce it, so only other parameters determine it.
+    template< class T > struct NonDeduced { typedef T Type ; } ;
+
+
+    /** Loop body that calls a function with bound arguments, then the bounds of each subrange, for Parallel::For.
+
+        This saves each loop defining its own function object class.  Make
+        these with Parallel::Function.  Argument types match the parameters
+        of the function, so reference parameters bind to the caller's
+        objects, which must outlive the loop.
+
+        Loops over ranges other than Range, e.g. Range3d from ForTiles or
+        CellBox from ForEachCellBlockByColor, pass the range whole, in place
+        of its bounds.
+    */
+    template< class FunctionT , class Arg1T = NoArg , class Arg2T = NoArg , class Arg3T = NoArg , class Arg4T = NoArg > class FunctionBody
+    {
+        public:
+            explicit FunctionBody( FunctionT function ) : mFunction( function ) {}
+            FunctionBody( FunctionT function , Arg1T arg1 ) : mFunction( function ) , mArg1( arg1 ) {}
+            FunctionBody( FunctionT function , Arg1T arg1 , Arg2T arg2 ) : mFunction( function ) , mArg1( arg1 ) , mArg2( arg2 ) {}
+            FunctionBody( FunctionT function , Arg1T arg1 , Arg2T arg2 , Arg3T arg3 ) : mFunction( function ) , mArg1( arg1 ) , mArg2( arg2 ) , mArg3( arg3 ) {}
+            FunctionBody( FunctionT function , Arg1T arg1 , Arg2T arg2 , Arg3T arg3 , Arg4T arg4 ) : mFunction( function ) , mArg1( arg1 ) , mArg2( arg2 ) , mArg3( arg3 ) , mArg4( arg4 ) {}
+
+            void operator()( const Range & r ) const
+            {
+                mFloatingPointState.Apply() ;
+                Call( mFunction , r.begin() , r.end() ) ;
+            }
+
+            template< class RangeT > void operator()( const RangeT & r ) const
+            {
+                mFloatingPointState.Apply() ;
+                Call( mFunction , r ) ;
+            }
+
+        private:
+            FunctionBody & operator=( const FunctionBody & ) ; // Disallow assignment
+
+            void Call( void (*function)( size_t , size_t ) , size_t begin , size_t end ) const                                                 { function( begin , end ) ; }
+            void Call( void (*function)( Arg1T , size_t , size_t ) , size_t begin , size_t end ) const                                         { function( mArg1 , begin , end ) ; }
+            void Call( void (*function)( Arg1T , Arg2T , size_t , size_t ) , size_t begin , size_t end ) const                                 { function( mArg1 , mArg2 , begin , end ) ; }
+            void Call( void (*function)( Arg1T , Arg2T , Arg3T , size_t , size_t ) , size_t begin , size_t end ) const                         { function( mArg1 , mArg2 , mArg3 , begin , end ) ; }
+            void Call( void (*function)( Arg1T , Arg2T , Arg3T , Arg4T , size_t , size_t ) , size_t begin , size_t end ) const                 { function( mArg1 , mArg2 , mArg3 , mArg4 , begin , end ) ; }
+            template< class RangeT > void Call( void (*function)( const RangeT & ) , const RangeT & r ) const                                  { function( r ) ; }
+            template< class RangeT > void Call( void (*function)( Arg1T , const RangeT & ) , const RangeT & r ) const                          { function( mArg1 , r ) ; }
+            template< class RangeT > void Call( void (*function)( Arg1T , Arg2T , const RangeT & ) , const RangeT & r ) const                  { function( mArg1 , mArg2 , r ) ; }
+            template< class RangeT > void Call( void (*function)( Arg1T , Arg2T , Arg3T , const RangeT & ) , const RangeT & r ) const          { function( mArg1 , mArg2 , mArg3 , r ) ; }
+            template< class RangeT > void Call( void (*function)( Arg1T , Arg2T , Arg3T , Arg4T , const RangeT & ) , const RangeT & r ) const  { function( mArg1 , mArg2 , mArg3 , mArg4 , r ) ; }
+
+            FunctionT           mFunction           ;   ///< Function to call with each subrange.
+            Arg1T               mArg1               ;   ///< First argument to pass to mFunction, unless NoArg.
+            Arg2T               mArg2               ;   ///< Second argument to pass to mFunction, unless NoArg.
+            Arg3T               mArg3               ;   ///< Third argument to pass to mFunction, unless NoArg.
+            Arg4T               mArg4               ;   ///< Fourth argument to pass to mFunction, unless NoArg.
+            FloatingPointState  mFloatingPointState ;   ///< Floating-point settings of thread that started loop.
+    } ;
+
+
+    /** Loop body that calls a method of an object with bound arguments, then the bounds of each subrange, for Parallel::For.
+
+        Like FunctionBody, for methods.  Make these with Parallel::Method.
+    */
+    template< class ObjectT , class MethodT , class Arg1T = NoArg , class Arg2T = NoArg , class Arg3T = NoArg , class Arg4T = NoArg > class MethodBody
+    {
+        public:
+            MethodBody( ObjectT * object , MethodT method ) : mObject( object ) , mMethod( method ) {}
+            MethodBody( ObjectT * object , MethodT method , Arg1T arg1 ) : mObject( object ) , mMethod( method ) , mArg1( arg1 ) {}
+            MethodBody( ObjectT * object , MethodT method , Arg1T arg1 , Arg2T arg2 ) : mObject( object ) , mMethod( method ) , mArg1( arg1 ) , mArg2( arg2 ) {}
+            MethodBody( ObjectT * object , MethodT method , Arg1T arg1 , Arg2T arg2 , Arg3T arg3 ) : mObject( object ) , mMethod( method ) , mArg1( arg1 ) , mArg2( arg2 ) , mArg3( arg3 ) {}
+            MethodBody( ObjectT * object , MethodT method , Arg1T arg1 , Arg2T arg2 , Arg3T arg3 , Arg4T arg4 ) : mObject( object ) , mMethod( method ) , mArg1( arg1 ) , mArg2( arg2 ) , mArg3( arg3 ) , mArg4( arg4 ) {}
+
+            void operator()( const Range & r ) const
+            {
+                mFloatingPointState.Apply() ;
+                Call( mMethod , r.begin() , r.end() ) ;
+            }
+
+            template< class RangeT > void operator()( const RangeT & r ) const
+            {
+                mFloatingPointState.Apply() ;
+                Call( mMethod , r ) ;
+            }
+
+        private:
+            MethodBody & operator=( const MethodBody & ) ; // Disallow assignment
+
+            template< class ClassT > void Call( void (ClassT::*method)( size_t , size_t ) , size_t begin , size_t end ) const                                             { ( mObject->*method )( begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , size_t , size_t ) , size_t begin , size_t end ) const                                     { ( mObject->*method )( mArg1 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , Arg2T , size_t , size_t ) , size_t begin , size_t end ) const                             { ( mObject->*method )( mArg1 , mArg2 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , size_t , size_t ) , size_t begin , size_t end ) const                     { ( mObject->*method )( mArg1 , mArg2 , mArg3 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , Arg4T , size_t , size_t ) , size_t begin , size_t end ) const             { ( mObject->*method )( mArg1 , mArg2 , mArg3 , mArg4 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( size_t , size_t ) const , size_t begin , size_t end ) const                                       { ( mObject->*method )( begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , size_t , size_t ) const , size_t begin , size_t end ) const                               { ( mObject->*method )( mArg1 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , Arg2T , size_t , size_t ) const , size_t begin , size_t end ) const                       { ( mObject->*method )( mArg1 , mArg2 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , size_t , size_t ) const , size_t begin , size_t end ) const               { ( mObject->*method )( mArg1 , mArg2 , mArg3 , begin , end ) ; }
+            template< class ClassT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , Arg4T , size_t , size_t ) const , size_t begin , size_t end ) const       { ( mObject->*method )( mArg1 , mArg2 , mArg3 , mArg4 , begin , end ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( const RangeT & ) , const RangeT & r ) const                                        { ( mObject->*method )( r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , const RangeT & ) , const RangeT & r ) const                                { ( mObject->*method )( mArg1 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , Arg2T , const RangeT & ) , const RangeT & r ) const                        { ( mObject->*method )( mArg1 , mArg2 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , const RangeT & ) , const RangeT & r ) const                { ( mObject->*method )( mArg1 , mArg2 , mArg3 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , Arg4T , const RangeT & ) , const RangeT & r ) const        { ( mObject->*method )( mArg1 , mArg2 , mArg3 , mArg4 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( const RangeT & ) const , const RangeT & r ) const                                  { ( mObject->*method )( r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , const RangeT & ) const , const RangeT & r ) const                          { ( mObject->*method )( mArg1 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , Arg2T , const RangeT & ) const , const RangeT & r ) const                  { ( mObject->*method )( mArg1 , mArg2 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , const RangeT & ) const , const RangeT & r ) const          { ( mObject->*method )( mArg1 , mArg2 , mArg3 , r ) ; }
+            template< class ClassT , class RangeT > void Call( void (ClassT::*method)( Arg1T , Arg2T , Arg3T , Arg4T , const RangeT & ) const , const RangeT & r ) const  { ( mObject->*method )( mArg1 , mArg2 , mArg3 , mArg4 , r ) ; }
+
+            ObjectT *           mObject             ;   ///< Object whose method to call.
+            MethodT             mMethod             ;   ///< Method to call with each subrange.
+            Arg1T               mArg1               ;   ///< First argument to pass to mMethod, unless NoArg.
+            Arg2T               mArg2               ;   ///< Second argument to pass to mMethod, unless NoArg.
+            Arg3T               mArg3               ;   ///< Third argument to pass to mMethod, unless NoArg.
+            Arg4T               mArg4               ;   ///< Fourth argument to pass to mMethod, unless NoArg.
+            FloatingPointState  mFloatingPointState ;   ///< Floating-point settings of thread that started loop.
+    } ;
+
+
+    /// Join policy for ReduceBody that merges results with their Merge method, e.g. for tallies.
+    struct MergeResults
+    {
+        template< class ResultT > static void Join( ResultT & result , const ResultT & other ) { result.Merge( other ) ; }
+    } ;
+
+    /// Join policy for ReduceBody that adds results, e.g. for sums.
+    struct AddResults
+    {
+        template< class ResultT > static void Join( ResultT & result , const ResultT & other ) { result += other ; }
+    } ;
+
+    /// Join policy for ReduceBody that keeps the larger result.
+    struct MaxResults
+    {
+        template< class ResultT > static void Join( ResultT & result , const ResultT & other ) { result = Max2( result , other ) ; }
+    } ;
+
+
+    /** Reduction body that calls a function with bound arguments, the bounds of each subrange, and a result to accumulate into, for Parallel::Reduce.
+
+        Make these with Parallel::Reduction.  The body made by Reduction
+        accumulates directly into the caller's result.  Each split starts
+        with a copy of an identity result, i.e. the result of reducing an
+        empty range, and JoinT::Join combines split results.
+    */
+    template< class JoinT , class ResultT , class FunctionT , class Arg1T = NoArg , class Arg2T = NoArg , class Arg3T = NoArg , class Arg4T = NoArg > class ReduceBody
+    {
+        public:
+            ReduceBody( ResultT & result , const ResultT & identity , FunctionT function ) : mResult( & result ) , mIdentity( identity ) , mLocal( identity ) , mFunction( function ) {}
+            ReduceBody( ResultT & result , const ResultT & identity , FunctionT function , Arg1T arg1 ) : mResult( & result ) , mIdentity( identity ) , mLocal( identity ) , mFunction( function ) , mArg1( arg1 ) {}
+            ReduceBody( ResultT & result , const ResultT & identity , FunctionT function , Arg1T arg1 , Arg2T arg2 ) : mResult( & result ) , mIdentity( identity ) , mLocal( identity ) , mFunction( function ) , mArg1( arg1 ) , mArg2( arg2 ) {}
+            ReduceBody( ResultT & result , const ResultT & identity , FunctionT function , Arg1T arg1 , Arg2T arg2 , Arg3T arg3 ) : mResult( & result ) , mIdentity( identity ) , mLocal( identity ) , mFunction( function ) , mArg1( arg1 ) , mArg2( arg2 ) , mArg3( arg3 ) {}
+            ReduceBody( ResultT & result , const ResultT & identity , FunctionT function , Arg1T arg1 , Arg2T arg2 , Arg3T arg3 , Arg4T arg4 ) : mResult( & result ) , mIdentity( identity ) , mLocal( identity ) , mFunction( function ) , mArg1( arg1 ) , mArg2( arg2 ) , mArg3( arg3 ) , mArg4( arg4 ) {}
+
+            /// Copy constructor.  A copy of a split accumulates into its own result, not that of the original.
+            ReduceBody( const ReduceBody & that )
+                : mResult( that.mResult == & that.mLocal ? & mLocal : that.mResult )
+                , mIdentity( that.mIdentity ) , mLocal( that.mLocal ) , mFunction( that.mFunction )
+                , mArg1( that.mArg1 ) , mArg2( that.mArg2 ) , mArg3( that.mArg3 ) , mArg4( that.mArg4 )
+                , mFloatingPointState( that.mFloatingPointState )
+            {}
+
+        #if USE_TBB
+            /// Splitting constructor used by parallel_reduce.  Each split starts with the identity result.
+            ReduceBody( ReduceBody & that , tbb::split )
+                : mResult( & mLocal )
+                , mIdentity( that.mIdentity ) , mLocal( that.mIdentity ) , mFunction( that.mFunction )
+                , mArg1( that.mArg1 ) , mArg2( that.mArg2 ) , mArg3( that.mArg3 ) , mArg4( that.mArg4 )
+                , mFloatingPointState( that.mFloatingPointState )
+            {}
+        #endif
+
+            /// Join the result of another split, which reduced a subrange after those this reduced.
+            void join( const ReduceBody & other )
+            {
+                JoinT::Join( * mResult , * other.mResult ) ;
+            }
+
+            void operator()( const Range & r )
+            {
+                mFloatingPointState.Apply() ;
+                Call( mFunction , r.begin() , r.end() ) ;
+            }
+
+        private:
+            ReduceBody & operator=( const ReduceBody & ) ; // Disallow assignment
+
+            void Call( void (*function)( size_t , size_t , ResultT & ) , size_t begin , size_t end )                                  { function( begin , end , * mResult ) ; }
+            void Call( void (*function)( Arg1T , size_t , size_t , ResultT & ) , size_t begin , size_t end )                          { function( mArg1 , begin , end , * mResult ) ; }
+            void Call( void (*function)( Arg1T , Arg2T , size_t , size_t , ResultT & ) , size_t begin , size_t end )                  { function( mArg1 , mArg2 , begin , end , * mResult ) ; }
+            void Call( void (*function)( Arg1T , Arg2T , Arg3T , size_t , size_t , ResultT & ) , size_t begin , size_t end )          { function( mArg1 , mArg2 , mArg3 , begin , end , * mResult ) ; }
+            void Call( void (*function)( Arg1T , Arg2T , Arg3T , Arg4T , size_t , size_t , ResultT & ) , size_t begin , size_t end )  { function( mArg1 , mArg2 , mArg3 , mArg4 , begin , end , * mResult ) ; }
+
+            ResultT *           mResult             ;   ///< Result into which this accumulates: the caller's for the original body, else mLocal.
+            const ResultT       mIdentity           ;   ///< Result of reducing an empty range, with which splits start.
+            ResultT             mLocal              ;   ///< Result of this split, unless this is the original body.
+            FunctionT           mFunction           ;   ///< Function to call with each subrange.
+            Arg1T               mArg1               ;   ///< First argument to pass to mFunction, unless NoArg.
+            Arg2T               mArg2               ;   ///< Second argument to pass to mFunction, unless NoArg.
+            Arg3T               mArg3               ;   ///< Third argument to pass to mFunction, unless NoArg.
+            Arg4T               mArg4               ;   ///< Fourth argument to pass to mFunction, unless NoArg.
+            FloatingPointState  mFloatingPointState ;   ///< Floating-point settings of thread that started loop.
+    } ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+    extern Settings SettingsFromEnvironment() ;
+    extern unsigned GetNumThreads() ;
+    extern bool     IsSerial() ;
+
+
+    /** Return grain size with which to split numItems among threads, for reductions that split their own range, e.g. by recursive Invoke.
+
+        Normally this gives each processor one grain.  When PARALLEL_DETERMINISTIC
+        is enabled, this depends only on numItems, so the reduction splits the
+        same way for any number of threads.
+    */
+    inline size_t GetReductionGrainSize( size_t numItems )
+    {
+    #if PARALLEL_DETERMINISTIC
+        return Max2( size_t( 1 ) , ( numItems + PARALLEL_DETERMINISTIC_NUM_CHUNKS - 1 ) / PARALLEL_DETERMINISTIC_NUM_CHUNKS ) ;
+    #else
+        return Max2( size_t( 1 ) , numItems / Max2( gNumberOfProcessors , 1u ) ) ;
+    #endif
+    }
+
+
+    /** Return grain size with which to split numItems among threads, for loops whose items cost about the same.
+
+        This yields PARALLEL_CHUNKS_PER_THREAD chunks per thread, so threads
+        that finish early can steal work from threads that finish late.
+        For loops whose items cost unequal amounts, use CostPartition and
+        ForWeighted instead.
+    */
+    inline size_t GetGrainSize( size_t numItems )
+    {
+        return Max2( size_t( 1 ) , numItems / ( PARALLEL_CHUNKS_PER_THREAD * Max2( gNumberOfProcessors , 1u ) ) ) ;
+    }
+
+
+    /** Run body over [begin,end), split into subranges of roughly grainSize indices, concurrently if possible.
+
+        \param body - Function object with operator()( const Parallel::Range & ) const.
+    */
+    template< class BodyT > void For( size_t begin , size_t end , size_t grainSize , const BodyT & body )
+    {
+    #if USE_TBB
+        if( IsSerial() )
+        {
+            body( Range( begin , end , Max2( grainSize , size_t( 1 ) ) ) ) ;
+            return ;
+        }
+    #   if PERF_MEASURE_LOAD_BALANCE
+        LoadBalanceMeter                meter ;     // Measure how evenly chunks spread across threads.  See PERF_MEASURE_LOAD_BALANCE.
+        typedef MeasuredBody< BodyT >   LoopBodyT ;
+        const LoopBodyT                 loopBody( body , meter ) ;
+    #   else
+        typedef BodyT                   LoopBodyT ;
+        const BodyT &                   loopBody = body ;
+    #   endif
+    #endif
+    #if USE_ONETBB
+        const Range range( begin , end , grainSize ) ;
+        if( Executor::GetCurrent() )
+        {
+            Executor::GetCurrent()->GetArena().execute( ForInArena< LoopBodyT >( range , loopBody ) ) ;
+        }
+        else
+        {
+            tbb::parallel_for( range , loopBody ) ;
+        }
+    #elif USE_TBB
+        tbb::parallel_for( Range( begin , end , grainSize ) , loopBody ) ;
+    #else
+        (void) grainSize ;
+        body( Range( begin , end ) ) ;
+    #endif
+    }
+
+
+    /** Run body over [begin,end), split into subranges of roughly grainSize indices, concurrently if possible, assigning subranges to the threads that ran them last time.
+
+        \param body - Function object with operator()( const Parallel::Range & ) const.
+
+        \param partitioner - Record of which thread ran which subrange the last
+            time this loop ran.  Pass the same one each time the same loop
+            runs over the same range, and a different one for each loop.
+    */
+    template< class BodyT > void For( size_t begin , size_t end , size_t grainSize , const BodyT & body , AffinityPartitioner & partitioner )
+    {
+    #if USE_TBB
+        if( IsSerial() )
+        {
+            body( Range( begin , end , Max2( grainSize , size_t( 1 ) ) ) ) ;
+            return ;
+        }
+    #   if PERF_MEASURE_LOAD_BALANCE
+        LoadBalanceMeter                meter ;     // Measure how evenly chunks spread across threads.  See PERF_MEASURE_LOAD_BALANCE.
+        typedef MeasuredBody< BodyT >   LoopBodyT ;
+        const LoopBodyT                 loopBody( body , meter ) ;
+    #   else
+        typedef BodyT                   LoopBodyT ;
+        const BodyT &                   loopBody = body ;
+    #   endif
+    #endif
+    #if USE_ONETBB
+        const Range range( begin , end , grainSize ) ;
+        if( Executor::GetCurrent() )
+        {
+            Executor::GetCurrent()->GetArena().execute( ForWithAffinityInArena< LoopBodyT >( range , loopBody , partitioner.GetTbbPartitioner() ) ) ;
+        }
+        else
+        {
+            tbb::parallel_for( range , loopBody , partitioner.GetTbbPartitioner() ) ;
+        }
+    #elif USE_TBB
+        tbb::parallel_for( Range( begin , end , grainSize ) , loopBody , partitioner.GetTbbPartitioner() ) ;
+    #else
+        (void) grainSize ;
+        (void) partitioner ;
+        body( Range( begin , end ) ) ;
+    #endif
+    }
+
+
+    /** Run body over the items of the given partition, one chunk at a time, concurrently if possible.
+
+        \param partition - Split of items into chunks of roughly equal cost.  See CostPartition.
+
+        \param body - Function object with operator()( const Parallel::Range & ) const.
+
+        \param partitioner - Record of which thread ran which chunk last time.  See AffinityPartitioner.
+    */
+    template< class BodyT > void ForWeighted( const CostPartition & partition , const BodyT & body , AffinityPartitioner & partitioner )
+    {
+        For( 0 , partition.GetNumChunks() , 1 , ForChunks< BodyT >( partition , body ) , partitioner ) ;
+    }
+
+
+    /** Run body over the given box of indices, split into sub-boxes, concurrently if possible.
+
+        \param body - Function object with operator()( const Parallel::Range3d & ) const.
+    */
+    template< class BodyT > void For3d( const Range3d & range , const BodyT & body )
+    {
+    #if USE_TBB
+        if( IsSerial() )
+        {
+            body( range ) ;
+            return ;
+        }
+    #   if PERF_MEASURE_LOAD_BALANCE
+        LoadBalanceMeter                meter ;     // Measure how evenly chunks spread across threads.  See PERF_MEASURE_LOAD_BALANCE.
+        typedef MeasuredBody< BodyT >   LoopBodyT ;
+        const LoopBodyT                 loopBody( body , meter ) ;
+    #   else
+        typedef BodyT                   LoopBodyT ;
+        const BodyT &                   loopBody = body ;
+    #   endif
+    #endif
+    #if USE_ONETBB
+        if( Executor::GetCurrent() )
+        {
+            Executor::GetCurrent()->GetArena().execute( For3dInArena< LoopBodyT >( range , loopBody ) ) ;
+        }
+        else
+        {
+            tbb::parallel_for( range , loopBody ) ;
+        }
+    #elif USE_TBB
+        tbb::parallel_for( range , loopBody ) ;
+    #else
+        body( range ) ;
+    #endif
+    }
+
+
+    /** Run body over the given box of indices, one tile at a time, concurrently if possible.
+
+        \param begin, end - Index of first, and one past index of last, element along each axis, x first.
+
+        \param tileShape - Largest number of elements along each axis, x first, that body visits at once.
+
+        \param body - Function object with operator()( const Parallel::Range3d & ) const.
+
+        Unlike For3d, this splits the box into tiles even when USE_TBB is 0,
+        or inside a SerialScope, so loop bodies get the same cache reuse
+        whether or not they run concurrently.
+    */
+    template< class BodyT > void ForTiles( const size_t begin[ 3 ] , const size_t end[ 3 ] , const size_t tileShape[ 3 ] , const BodyT & body )
+    {
+        ASSERT( ( tileShape[ 0 ] > 0 ) && ( tileShape[ 1 ] > 0 ) && ( tileShape[ 2 ] > 0 ) ) ;
+        if( ( end[ 0 ] <= begin[ 0 ] ) || ( end[ 1 ] <= begin[ 1 ] ) || ( end[ 2 ] <= begin[ 2 ] ) )
+        {   // Box is empty, e.g. interior of a grid only 2 points wide.
+            return ;
+        }
+    #if USE_TBB
+        if( ! IsSerial() )
+        {   // Let TBB split box into tiles and run them concurrently.
+            For3d( Range3d( begin[ 2 ] , end[ 2 ] , tileShape[ 2 ] , begin[ 1 ] , end[ 1 ] , tileShape[ 1 ] , begin[ 0 ] , end[ 0 ] , tileShape[ 0 ] ) , body ) ;
+            return ;
+        }
+    #endif
+        for( size_t izTile = begin[ 2 ] ; izTile < end[ 2 ] ; izTile += tileShape[ 2 ] )
+        for( size_t iyTile = begin[ 1 ] ; iyTile < end[ 1 ] ; iyTile += tileShape[ 1 ] )
+        for( size_t ixTile = begin[ 0 ] ; ixTile < end[ 0 ] ; ixTile += tileShape[ 0 ] )
+        {   // For each tile...
+            body( Range3d(  izTile , Min2( izTile + tileShape[ 2 ] , end[ 2 ] )
+                         ,  iyTile , Min2( iyTile + tileShape[ 1 ] , end[ 1 ] )
+                         ,  ixTile , Min2( ixTile + tileShape[ 0 ] , end[ 0 ] ) ) ) ;
+        }
+    }
+
+
+    /** Run body over [begin,end), split into subranges, concurrently if possible, then join results into body.
+
+        \param body - Function object with operator()( const Parallel::Range & ),
+            a splitting constructor and join, as tbb::parallel_reduce requires.
+
+        \note The order in which results join depends on thread timing, so
+            floating-point results can vary from run to run, unless
+            PARALLEL_DETERMINISTIC is enabled, in which case this ignores
+            grainSize, splits the range into fixed chunks, reduces each chunk
+            into its own body, then joins those bodies in index order.  That
+            holds inside a SerialScope too, where chunks run one at a time.
+    */
+    template< class BodyT > void Reduce( size_t begin , size_t end , size_t grainSize , BodyT & body )
+    {
+    #if USE_TBB && PARALLEL_DETERMINISTIC
+        (void) grainSize ;
+        if( end <= begin )
+        {   // Range is empty, so there is nothing to reduce.
+            return ;
+        }
+        const size_t        chunkSize   = GetReductionGrainSize( end - begin ) ;
+        const size_t        numChunks   = ( end - begin + chunkSize - 1 ) / chunkSize ;
+        VECTOR< BodyT * >   chunkBodies( numChunks ) ;
+        chunkBodies[ 0 ] = & body ;
+        for( size_t iChunk = 1 ; iChunk < numChunks ; ++ iChunk )
+        {   // For each chunk after the first, make a body with an empty result.
+            chunkBodies[ iChunk ] = NEW BodyT( body , tbb::split() ) ;
+        }
+        For( 0 , numChunks , 1 , ReduceChunks< BodyT >( & chunkBodies[ 0 ] , begin , end , chunkSize ) ) ;
+        for( size_t iChunk = 1 ; iChunk < numChunks ; ++ iChunk )
+        {   // For each chunk after the first, in order...
+            body.join( * chunkBodies[ iChunk ] ) ;
+            delete chunkBodies[ iChunk ] ;
+        }
+    #elif USE_ONETBB
+        const Range range( begin , end , grainSize ) ;
+        if( IsSerial() )
+        {
+            body( range ) ;
+        }
+        else if( Executor::GetCurrent() )
+        {
+            Executor::GetCurrent()->GetArena().execute( ReduceInArena< BodyT >( range , body ) ) ;
+        }
+        else
+        {
+            tbb::parallel_reduce( range , body ) ;
+        }
+    #elif USE_TBB
+        if( IsSerial() )
+        {
+            body( Range( begin , end , grainSize ) ) ;
+        }
+        else
+        {
+            tbb::parallel_reduce( Range( begin , end , grainSize ) , body ) ;
+        }
+    #else
+        (void) grainSize ;
+        body( Range( begin , end ) ) ;
+    #endif
+    }
+
+
+    /** Run a copy of body over [begin,end), for reduction bodies, such as those Reduction makes, that accumulate into a result elsewhere.
+    */
+    template< class BodyT > void Reduce( size_t begin , size_t end , size_t grainSize , const BodyT & body )
+    {
+        BodyT reduction( body ) ;
+        Reduce( begin , end , grainSize , reduction ) ;
+    }
+
+
+    /** Run two function objects, concurrently if possible, and return after both finish.
+    */
+    template< class Func0T , class Func1T > void Invoke( const Func0T & func0 , const Func1T & func1 )
+    {
+    #if USE_TBB
+        if( IsSerial() )
+        {
+            func0() ;
+            func1() ;
+            return ;
+        }
+    #endif
+    #if USE_ONETBB
+        if( Executor::GetCurrent() )
+        {
+            Executor::GetCurrent()->GetArena().execute( InvokeInArena< Func0T , Func1T >( func0 , func1 ) ) ;
+        }
+        else
+        {
+            tbb::parallel_invoke( func0 , func1 ) ;
+        }
+    #elif USE_TBB
+        tbb::parallel_invoke( func0 , func1 ) ;
+    #else
+        func0() ;
+        func1() ;
+    #endif
+    }
+
+
+    /** Return loop body, for Parallel::For, that calls the given function with the given arguments, then the bounds of each subrange.
+
+        For example, where Slice has signature void Slice( Grid & , float , size_t begin , size_t end ),
+        Parallel::For( 0 , n , grainSize , Parallel::Function( Slice , grid , timeStep ) )
+        calls Slice( grid , timeStep , begin , end ) with subranges of [0,n).
+        For loops over other ranges, e.g. ForTiles, the function instead takes
+        the range whole, e.g. void Slice( Grid & , float , const Range3d & ).
+
+        Parameter types of the function determine argument types, so reference
+        parameters bind to the caller's objects.
+
+        \see FunctionBody.
+    */
+    inline FunctionBody< void (*)( size_t , size_t ) > Function( void (*function)( size_t , size_t ) )
+    {
+        return FunctionBody< void (*)( size_t , size_t ) >( function ) ;
+    }
+
+    template< class P1 > inline FunctionBody< void (*)( P1 , size_t , size_t ) , P1 > Function( void (*function)( P1 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return FunctionBody< void (*)( P1 , size_t , size_t ) , P1 >( function , arg1 ) ;
+    }
+
+    template< class P1 , class P2 > inline FunctionBody< void (*)( P1 , P2 , size_t , size_t ) , P1 , P2 > Function( void (*function)( P1 , P2 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return FunctionBody< void (*)( P1 , P2 , size_t , size_t ) , P1 , P2 >( function , arg1 , arg2 ) ;
+    }
+
+    template< class P1 , class P2 , class P3 > inline FunctionBody< void (*)( P1 , P2 , P3 , size_t , size_t ) , P1 , P2 , P3 > Function( void (*function)( P1 , P2 , P3 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return FunctionBody< void (*)( P1 , P2 , P3 , size_t , size_t ) , P1 , P2 , P3 >( function , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class P1 , class P2 , class P3 , class P4 > inline FunctionBody< void (*)( P1 , P2 , P3 , P4 , size_t , size_t ) , P1 , P2 , P3 , P4 > Function( void (*function)( P1 , P2 , P3 , P4 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return FunctionBody< void (*)( P1 , P2 , P3 , P4 , size_t , size_t ) , P1 , P2 , P3 , P4 >( function , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+
+    template< class RangeT > inline FunctionBody< void (*)( const RangeT & ) > Function( void (*function)( const RangeT & ) )
+    {
+        return FunctionBody< void (*)( const RangeT & ) >( function ) ;
+    }
+
+    template< class P1 , class RangeT > inline FunctionBody< void (*)( P1 , const RangeT & ) , P1 > Function( void (*function)( P1 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return FunctionBody< void (*)( P1 , const RangeT & ) , P1 >( function , arg1 ) ;
+    }
+
+    template< class P1 , class P2 , class RangeT > inline FunctionBody< void (*)( P1 , P2 , const RangeT & ) , P1 , P2 > Function( void (*function)( P1 , P2 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return FunctionBody< void (*)( P1 , P2 , const RangeT & ) , P1 , P2 >( function , arg1 , arg2 ) ;
+    }
+
+    template< class P1 , class P2 , class P3 , class RangeT > inline FunctionBody< void (*)( P1 , P2 , P3 , const RangeT & ) , P1 , P2 , P3 > Function( void (*function)( P1 , P2 , P3 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return FunctionBody< void (*)( P1 , P2 , P3 , const RangeT & ) , P1 , P2 , P3 >( function , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class P1 , class P2 , class P3 , class P4 , class RangeT > inline FunctionBody< void (*)( P1 , P2 , P3 , P4 , const RangeT & ) , P1 , P2 , P3 , P4 > Function( void (*function)( P1 , P2 , P3 , P4 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return FunctionBody< void (*)( P1 , P2 , P3 , P4 , const RangeT & ) , P1 , P2 , P3 , P4 >( function , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+
+
+    /** Return loop body, for Parallel::For, that calls the given method of the given object with the given arguments, then the bounds of each subrange.
+
+        For example, Parallel::For( 0 , n , grainSize , Parallel::Method( this , & Sim::UpdateSlice , timeStep ) )
+        calls this->UpdateSlice( timeStep , begin , end ) with subranges of [0,n).
+
+        \see MethodBody, Function.
+    */
+    template< class ClassT > inline MethodBody< ClassT , void (ClassT::*)( size_t , size_t ) > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( size_t , size_t ) )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( size_t , size_t ) >( object , method ) ;
+    }
+
+    template< class ClassT , class P1 > inline MethodBody< ClassT , void (ClassT::*)( P1 , size_t , size_t ) , P1 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , size_t , size_t ) , P1 >( object , method , arg1 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 > inline MethodBody< ClassT , void (ClassT::*)( P1 , P2 , size_t , size_t ) , P1 , P2 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , P2 , size_t , size_t ) , P1 , P2 >( object , method , arg1 , arg2 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 > inline MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , size_t , size_t ) , P1 , P2 , P3 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , size_t , size_t ) , P1 , P2 , P3 >( object , method , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 , class P4 > inline MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , size_t , size_t ) , P1 , P2 , P3 , P4 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , P4 , size_t , size_t ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , size_t , size_t ) , P1 , P2 , P3 , P4 >( object , method , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+
+    template< class ClassT > inline MethodBody< const ClassT , void (ClassT::*)( size_t , size_t ) const > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( size_t , size_t ) const )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( size_t , size_t ) const >( object , method ) ;
+    }
+
+    template< class ClassT , class P1 > inline MethodBody< const ClassT , void (ClassT::*)( P1 , size_t , size_t ) const , P1 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , size_t , size_t ) const , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , size_t , size_t ) const , P1 >( object , method , arg1 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 > inline MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , size_t , size_t ) const , P1 , P2 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , size_t , size_t ) const , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , size_t , size_t ) const , P1 , P2 >( object , method , arg1 , arg2 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 > inline MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , size_t , size_t ) const , P1 , P2 , P3 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , size_t , size_t ) const , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , size_t , size_t ) const , P1 , P2 , P3 >( object , method , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 , class P4 > inline MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , size_t , size_t ) const , P1 , P2 , P3 , P4 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , P4 , size_t , size_t ) const , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , size_t , size_t ) const , P1 , P2 , P3 , P4 >( object , method , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+
+    template< class ClassT , class RangeT > inline MethodBody< ClassT , void (ClassT::*)( const RangeT & ) > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( const RangeT & ) )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( const RangeT & ) >( object , method ) ;
+    }
+
+    template< class ClassT , class P1 , class RangeT > inline MethodBody< ClassT , void (ClassT::*)( P1 , const RangeT & ) , P1 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , const RangeT & ) , P1 >( object , method , arg1 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class RangeT > inline MethodBody< ClassT , void (ClassT::*)( P1 , P2 , const RangeT & ) , P1 , P2 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , P2 , const RangeT & ) , P1 , P2 >( object , method , arg1 , arg2 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 , class RangeT > inline MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , const RangeT & ) , P1 , P2 , P3 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , const RangeT & ) , P1 , P2 , P3 >( object , method , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 , class P4 , class RangeT > inline MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , const RangeT & ) , P1 , P2 , P3 , P4 > Method( typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , P4 , const RangeT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return MethodBody< ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , const RangeT & ) , P1 , P2 , P3 , P4 >( object , method , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+
+    template< class ClassT , class RangeT > inline MethodBody< const ClassT , void (ClassT::*)( const RangeT & ) const > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( const RangeT & ) const )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( const RangeT & ) const >( object , method ) ;
+    }
+
+    template< class ClassT , class P1 , class RangeT > inline MethodBody< const ClassT , void (ClassT::*)( P1 , const RangeT & ) const , P1 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , const RangeT & ) const , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , const RangeT & ) const , P1 >( object , method , arg1 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class RangeT > inline MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , const RangeT & ) const , P1 , P2 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , const RangeT & ) const , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , const RangeT & ) const , P1 , P2 >( object , method , arg1 , arg2 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 , class RangeT > inline MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , const RangeT & ) const , P1 , P2 , P3 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , const RangeT & ) const , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , const RangeT & ) const , P1 , P2 , P3 >( object , method , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class ClassT , class P1 , class P2 , class P3 , class P4 , class RangeT > inline MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , const RangeT & ) const , P1 , P2 , P3 , P4 > Method( const typename NonDeduced< ClassT >::Type * object , void (ClassT::*method)( P1 , P2 , P3 , P4 , const RangeT & ) const , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return MethodBody< const ClassT , void (ClassT::*)( P1 , P2 , P3 , P4 , const RangeT & ) const , P1 , P2 , P3 , P4 >( object , method , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+
+
+    /** Return reduction body, for Parallel::Reduce, that calls the given function with the given arguments, the bounds of each subrange, and a result to accumulate into.
+
+        For example, where Slice has signature void Slice( const Grid & , size_t begin , size_t end , Vec3 & sum ),
+        Parallel::Reduce( 0 , n , grainSize , Parallel::Reduction< Parallel::AddResults >( sum , Vec3( 0.0f , 0.0f , 0.0f ) , Slice , grid ) )
+        adds to sum the sums of all subranges of [0,n).
+
+        \param JoinT - Policy with which to combine results of splits: MergeResults, AddResults or MaxResults.
+
+        \param result - (in/out) Result into which to accumulate.
+
+        \param identity - Result of reducing an empty range, with which each split starts.
+
+        \see ReduceBody.
+    */
+    template< class JoinT , class ResultT > inline ReduceBody< JoinT , ResultT , void (*)( size_t , size_t , ResultT & ) > Reduction( ResultT & result , const typename NonDeduced< ResultT >::Type & identity , void (*function)( size_t , size_t , ResultT & ) )
+    {
+        return ReduceBody< JoinT , ResultT , void (*)( size_t , size_t , ResultT & ) >( result , identity , function ) ;
+    }
+
+    template< class JoinT , class ResultT , class P1 > inline ReduceBody< JoinT , ResultT , void (*)( P1 , size_t , size_t , ResultT & ) , P1 > Reduction( ResultT & result , const typename NonDeduced< ResultT >::Type & identity , void (*function)( P1 , size_t , size_t , ResultT & ) , typename NonDeduced< P1 >::Type arg1 )
+    {
+        return ReduceBody< JoinT , ResultT , void (*)( P1 , size_t , size_t , ResultT & ) , P1 >( result , identity , function , arg1 ) ;
+    }
+
+    template< class JoinT , class ResultT , class P1 , class P2 > inline ReduceBody< JoinT , ResultT , void (*)( P1 , P2 , size_t , size_t , ResultT & ) , P1 , P2 > Reduction( ResultT & result , const typename NonDeduced< ResultT >::Type & identity , void (*function)( P1 , P2 , size_t , size_t , ResultT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 )
+    {
+        return ReduceBody< JoinT , ResultT , void (*)( P1 , P2 , size_t , size_t , ResultT & ) , P1 , P2 >( result , identity , function , arg1 , arg2 ) ;
+    }
+
+    template< class JoinT , class ResultT , class P1 , class P2 , class P3 > inline ReduceBody< JoinT , ResultT , void (*)( P1 , P2 , P3 , size_t , size_t , ResultT & ) , P1 , P2 , P3 > Reduction( ResultT & result , const typename NonDeduced< ResultT >::Type & identity , void (*function)( P1 , P2 , P3 , size_t , size_t , ResultT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 )
+    {
+        return ReduceBody< JoinT , ResultT , void (*)( P1 , P2 , P3 , size_t , size_t , ResultT & ) , P1 , P2 , P3 >( result , identity , function , arg1 , arg2 , arg3 ) ;
+    }
+
+    template< class JoinT , class ResultT , class P1 , class P2 , class P3 , class P4 > inline ReduceBody< JoinT , ResultT , void (*)( P1 , P2 , P3 , P4 , size_t , size_t , ResultT & ) , P1 , P2 , P3 , P4 > Reduction( ResultT & result , const typename NonDeduced< ResultT >::Type & identity , void (*function)( P1 , P2 , P3 , P4 , size_t , size_t , ResultT & ) , typename NonDeduced< P1 >::Type arg1 , typename NonDeduced< P2 >::Type arg2 , typename NonDeduced< P3 >::Type arg3 , typename NonDeduced< P4 >::Type arg4 )
+    {
+        return ReduceBody< JoinT , ResultT , void (*)( P1 , P2 , P3 , P4 , size_t , size_t , ResultT & ) , P1 , P2 , P3 , P4 >( result , identity , function , arg1 , arg2 , arg3 , arg4 ) ;
+    }
+} ;
+
+#endif
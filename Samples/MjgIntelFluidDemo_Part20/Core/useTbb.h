@@ -41,6 +41,7 @@
 
 */
 
+// To rule out non-determinism from multi-threading without disabling TBB, enable PARALLEL_DETERMINISTIC in parallelExecution.h.
 //#if defined( USE_TBB )  // DO NOT SUBMIT.  Disabled temporarily to rule out whether non-determinism from multi-threading is the cause of an issue.
 //#   undef USE_TBB       // DO NOT SUBMIT
 //#   define USE_TBB 0    // DO NOT SUBMIT
@@ -55,23 +56,88 @@
 //#undef USE_TBB
 //#define USE_TBB 0
 
+/** Whether to build against oneTBB (2021 and later) instead of classic TBB.
+
+    oneTBB removed task_scheduler_init, parallel_do and tbb::atomic.
+    When this is enabled, this header supplies the subset of parallel_do and
+    tbb::atomic this code uses, built from oneTBB and C++11 facilities, and
+    Parallel::Executor (see parallelExecution.h) replaces task_scheduler_init.
+*/
+#if ! defined( USE_ONETBB )
+#   define USE_ONETBB 0
+#endif
+
 #if USE_TBB
 #   pragma warning( disable: 4511 ) // TBB has issues: Copy constructor could not be generated
 #   pragma warning( disable: 4512 ) // TBB has issues: Assignment operator could not be generated
-#   if defined( _DEBUG )
-#       pragma comment(lib, "tbb_debug.lib")
-#   else
-#       pragma comment(lib, "tbb.lib")
+#   if ! USE_ONETBB // oneTBB headers link their own library.
+#       if defined( _DEBUG )
+#           pragma comment(lib, "tbb_debug.lib")
+#       else
+#           pragma comment(lib, "tbb.lib")
+#       endif
 #   endif
 
-#   include "tbb/task_scheduler_init.h"
+#   if USE_ONETBB
+#       include "tbb/task_arena.h"
+#       include "tbb/global_control.h"
+#       include "tbb/parallel_for_each.h"
+#       include <atomic>
+#   else
+#       include "tbb/task_scheduler_init.h"
+#       include "tbb/parallel_do.h"
+#       include "tbb/atomic.h"
+#   endif
+#   include "tbb/task_scheduler_observer.h"
 #   include "tbb/parallel_for.h"
-#   include "tbb/parallel_do.h"
 #   include "tbb/parallel_reduce.h"
 #   include "tbb/parallel_invoke.h"
 #   include "tbb/blocked_range.h"
+#   include "tbb/blocked_range3d.h"
 #   include "tbb/tick_count.h"
-#   include "tbb/atomic.h"
+
+#   if USE_ONETBB
+    namespace tbb
+    {
+        /** Subset of the classic tbb::atomic interface, built on std::atomic.
+
+            Like classic tbb::atomic, this is POD-sized.  As with std::atomic
+            before C++20, fetch_and_add and the increment operators work only
+            for integral T; Math::Float_FetchAndAdd adds floats instead.
+        */
+        template< typename T > class atomic
+        {
+            public:
+                operator T() const                          { return mValue.load() ; }
+                atomic & operator=( T value )               { mValue.store( value ) ; return * this ; }
+                T fetch_and_store( T value )                { return mValue.exchange( value ) ; }
+                T fetch_and_add( T increment )              { return mValue.fetch_add( increment ) ; }
+                T fetch_and_increment()                     { return mValue.fetch_add( 1 ) ; }
+                T fetch_and_decrement()                     { return mValue.fetch_sub( 1 ) ; }
+                T operator++()                              { return mValue.fetch_add( 1 ) + 1 ; }
+                T operator--()                              { return mValue.fetch_sub( 1 ) - 1 ; }
+
+                /// Store value if current value equals comparand.  Return value prior to this call.
+                T compare_and_swap( T value , T comparand )
+                {
+                    mValue.compare_exchange_strong( comparand , value ) ; // On failure, this assigns the current value to comparand.
+                    return comparand ;
+                }
+
+            private:
+                std::atomic< T > mValue ;
+        } ;
+
+        /// Classic name for the oneTBB work-item feeder.
+        template< typename ItemT > using parallel_do_feeder = feeder< ItemT > ;
+
+        /// Classic name for oneTBB parallel_for_each, which subsumes parallel_do.
+        template< typename IteratorT , typename BodyT > void parallel_do( IteratorT first , IteratorT last , const BodyT & body )
+        {
+            parallel_for_each( first , last , body ) ;
+        }
+    } ;
+#   endif
 
     typedef tbb::atomic< bool > TbbAtomicBool ;
 
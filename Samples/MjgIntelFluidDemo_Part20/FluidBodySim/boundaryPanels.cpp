@@ -0,0 +1,661 @@
+/** \file boundaryPanels.cpp
+
+    \brief Boundary element (panel) solver for no-through and no-slip conditions at body surfaces.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "boundaryPanels.h"
+
+#include "Impulsion/physicalObject.h"
+
+#include "Collision/sphereShape.h"
+#include "Collision/convexPolytope.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+#include <float.h>
+#include <math.h>
+
+// Private variables --------------------------------------------------------------
+
+static const float sOneOverFourPi   = 1.0f / FourPi ;
+static const float sGoldenAngle     = PI * ( 3.0f - 2.2360679775f ) ;   // Pi * ( 3 - sqrt(5) ), angle between successive points of a Fibonacci sphere.
+static const float sTinyPivot       = 1.0e-12f ;                        // Pivots smaller than this indicate the dense system is singular.
+
+// Private functions --------------------------------------------------------------
+
+/** Return velocity the source sheet on the given panel induces at the given position.
+
+    This treats the panel as a point source, smoothed over a core whose
+    radius is half the panel width, so control points near, or on, the panel
+    see a bounded velocity.
+*/
+static inline Vec3 SourcePanelVelocity( const BoundaryPanels::Panel & panel , const Vec3 & position )
+{
+    const Vec3  displacement    = position - panel.mPosition ;
+    const float coreRadius2     = 0.25f * panel.mArea ;
+    const float oneOverDist     = 1.0f / sqrtf( displacement.Mag2() + coreRadius2 ) ;
+    const float oneOverDist3    = oneOverDist * oneOverDist * oneOverDist ;
+    return displacement * ( panel.mSourceStrength * panel.mArea * sOneOverFourPi * oneOverDist3 ) ;
+}
+
+
+
+
+/** Clip a convex polygon by a plane, keeping the part behind the plane.
+
+    \param polygon  (in/out) Vertices of polygon, in order around its perimeter.
+
+    \param scratch  Storage reused across calls.
+*/
+static void ClipPolygonByPlane( VECTOR< Vec3 > & polygon , VECTOR< Vec3 > & scratch , const Math::Plane & plane )
+{
+    scratch.Clear() ;
+    const size_t numVertices = polygon.Size() ;
+    for( size_t iVertex = 0 ; iVertex < numVertices ; ++ iVertex )
+    {   // For each edge of polygon...
+        const Vec3 &    vertex      = polygon[ iVertex ] ;
+        const Vec3 &    vertexNext  = polygon[ ( iVertex + 1 ) % numVertices ] ;
+        const float     dist        = plane.Distance( vertex ) ;
+        const float     distNext    = plane.Distance( vertexNext ) ;
+        if( dist <= 0.0f )
+        {   // Vertex lies behind plane.
+            scratch.PushBack( vertex ) ;
+        }
+        if( ( dist < 0.0f && distNext > 0.0f ) || ( dist > 0.0f && distNext < 0.0f ) )
+        {   // Edge crosses plane.
+            const float tween = dist / ( dist - distNext ) ;
+            scratch.PushBack( vertex + ( vertexNext - vertex ) * tween ) ;
+        }
+    }
+    polygon.swap( scratch ) ;
+}
+
+
+
+
+/** Add velocity that panel source sheets induce to a subset of vortons.
+
+    \param itStart     Index of first vorton to process.
+
+    \param itEnd       One past index of last vorton to process.
+*/
+static void ApplySourceVelocityToVortons_Slice( VECTOR< Vorton > & vortons , const BoundaryPanels & boundaryPanels , size_t itStart , size_t itEnd )
+{
+    for( size_t iVorton = itStart ; iVorton < itEnd ; ++ iVorton )
+    {   // For each vorton in this slice...
+        Vorton & rVorton = vortons[ iVorton ] ;
+        boundaryPanels.AccumulateVelocity( rVorton.mVelocity , rVorton.mPosition ) ;
+    }
+}
+
+
+
+
+/** Add velocity that panel source sheets induce to a subset of gridpoints.
+
+    \param izStart     Index of first z-slice of gridpoints to process.
+
+    \param izEnd       One past index of last z-slice of gridpoints to process.
+*/
+static void ApplySourceVelocityToGrid_Slice( UniformGrid< Vec3 > & velocityGrid , const BoundaryPanels & boundaryPanels , size_t izStart , size_t izEnd )
+{
+    const Vec3 &    minCorner   = velocityGrid.GetMinCorner() ;
+    const Vec3 &    spacing     = velocityGrid.GetCellSpacing() ;
+    const size_t    numX        = velocityGrid.GetNumPoints( 0 ) ;
+    const size_t    numY        = velocityGrid.GetNumPoints( 1 ) ;
+    const size_t    numXY       = numX * numY ;
+    for( size_t iz = izStart ; iz < izEnd ; ++ iz )
+    for( size_t iy = 0 ; iy < numY ; ++ iy )
+    for( size_t ix = 0 ; ix < numX ; ++ ix )
+    {   // For each gridpoint in this slice...
+        const Vec3 position( minCorner.x + float( ix ) * spacing.x , minCorner.y + float( iy ) * spacing.y , minCorner.z + float( iz ) * spacing.z ) ;
+        boundaryPanels.AccumulateVelocity( velocityGrid[ ix + numX * iy + numXY * iz ] , position ) ;
+    }
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Construct a boundary panel solver with no panels.
+*/
+BoundaryPanels::BoundaryPanels()
+    : mPanelsPerBody( 128 )
+    , mSheddingFraction( 0.5f )
+    , mMaxNormalVelocityResidual( 0.0f )
+{
+}
+
+
+
+
+/** Cover a sphere with panels of equal area.
+
+    \param localPanels  (out) Panels, relative to sphere center.
+
+    \param numPanels    Number of panels to place.
+
+    This places control points along a Fibonacci spiral, which spaces them
+    almost evenly, so each point stands for an equal share of the surface.
+*/
+/* static */ void BoundaryPanels::TessellateSphere( VECTOR< LocalPanel > & localPanels , float radius , unsigned numPanels )
+{
+    ASSERT( numPanels > 0 ) ;
+    localPanels.Clear() ;
+    localPanels.Reserve( numPanels ) ;
+    const float areaPerPanel = FourPi * radius * radius / float( numPanels ) ;
+    for( unsigned iPanel = 0 ; iPanel < numPanels ; ++ iPanel )
+    {   // For each panel...
+        const float z           = 1.0f - ( 2.0f * float( iPanel ) + 1.0f ) / float( numPanels ) ;
+        const float rho         = sqrtf( Max2( 1.0f - z * z , 0.0f ) ) ;
+        const float azimuth     = sGoldenAngle * float( iPanel ) ;
+        LocalPanel  panel       ;
+        panel.mNormal           = Vec3( rho * cosf( azimuth ) , rho * sinf( azimuth ) , z ) ;
+        panel.mPosition         = panel.mNormal * radius ;
+        panel.mArea             = areaPerPanel ;
+        localPanels.PushBack( panel ) ;
+    }
+}
+
+
+
+
+/** Cover a convex polytope with triangular panels.
+
+    \param localPanels  (out) Panels, in polytope space.
+
+    \param numPanels    Approximate number of panels to place.
+
+    ConvexPolytope stores only planes, so this recovers each face by clipping
+    a large square in its plane by all other planes.  Then it splits each
+    face into a fan of triangles, and subdivides each triangle into similar
+    triangles so that panels have roughly equal area.
+*/
+/* static */ void BoundaryPanels::TessellatePolytope( VECTOR< LocalPanel > & localPanels , const Collision::ConvexPolytope & polytope , unsigned numPanels )
+{
+    ASSERT( numPanels > 0 ) ;
+    localPanels.Clear() ;
+
+    const size_t    numPlanes   = polytope.GetNumPlanes() ;
+    const float     halfWidth   = 2.0f * polytope.GetBoundingSphereRadius() ;
+    VECTOR< VECTOR< Vec3 > >    faces( numPlanes ) ;
+    VECTOR< Vec3 >              scratch ;
+    float                       totalArea   = 0.0f ;
+
+    for( size_t iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
+    {   // For each face...
+        const Math::Plane & plane   = polytope.GetPlane( iPlane ) ;
+        const Vec3 &        normal  = plane.GetNormal() ;
+        // Make a square, in the plane, larger than the face.
+        const Vec3          axis    = ( fabsf( normal.x ) < 0.5f ) ? Vec3( 1.0f , 0.0f , 0.0f ) : Vec3( 0.0f , 1.0f , 0.0f ) ;
+        const Vec3          tangent = ( normal ^ axis ).GetDir() * halfWidth ;
+        const Vec3          binorm  = normal ^ tangent ;
+        const Vec3          center  = normal * plane.GetD() ;
+        VECTOR< Vec3 > &    face    = faces[ iPlane ] ;
+        face.PushBack( center - tangent - binorm ) ;
+        face.PushBack( center + tangent - binorm ) ;
+        face.PushBack( center + tangent + binorm ) ;
+        face.PushBack( center - tangent + binorm ) ;
+        for( size_t iOther = 0 ; ( iOther < numPlanes ) && ( face.Size() >= 3 ) ; ++ iOther )
+        {   // For each other plane...
+            if( iOther != iPlane )
+            {
+                ClipPolygonByPlane( face , scratch , polytope.GetPlane( iOther ) ) ;
+            }
+        }
+        for( size_t iVertex = 2 ; iVertex < face.Size() ; ++ iVertex )
+        {   // For each triangle in a fan around the first vertex...
+            totalArea += 0.5f * ( ( face[ iVertex - 1 ] - face[ 0 ] ) ^ ( face[ iVertex ] - face[ 0 ] ) ).Magnitude() ;
+        }
+    }
+
+    if( totalArea <= 0.0f )
+    {   // Polytope is degenerate.
+        return ;
+    }
+    const float targetArea = totalArea / float( numPanels ) ;
+
+    for( size_t iPlane = 0 ; iPlane < numPlanes ; ++ iPlane )
+    {   // For each face...
+        const VECTOR< Vec3 > &  face        = faces[ iPlane ] ;
+        const size_t            numVertices = face.Size() ;
+        if( numVertices < 3 )
+        {   // Plane does not bound polytope.
+            continue ;
+        }
+        Vec3 centroid( 0.0f , 0.0f , 0.0f ) ;
+        for( size_t iVertex = 0 ; iVertex < numVertices ; ++ iVertex )
+        {
+            centroid += face[ iVertex ] ;
+        }
+        centroid = centroid / float( numVertices ) ;
+
+        LocalPanel panel ;
+        panel.mNormal = polytope.GetPlane( iPlane ).GetNormal() ;
+        for( size_t iVertex = 0 ; iVertex < numVertices ; ++ iVertex )
+        {   // For each triangle in a fan around the face centroid...
+            const Vec3 &    a           = centroid ;
+            const Vec3      ab          = face[ iVertex ] - a ;
+            const Vec3      ac          = face[ ( iVertex + 1 ) % numVertices ] - a ;
+            const float     area        = 0.5f * ( ab ^ ac ).Magnitude() ;
+            if( area <= 0.0f )
+            {   // Triangle is degenerate.
+                continue ;
+            }
+            // Split triangle into numSplits^2 similar triangles.
+            const unsigned  numSplits   = Max2( 1u , unsigned( sqrtf( area / targetArea ) + 0.5f ) ) ;
+            const float     oneOverN    = 1.0f / float( numSplits ) ;
+            panel.mArea = area * oneOverN * oneOverN ;
+            for( unsigned i = 0 ; i < numSplits ; ++ i )
+            for( unsigned j = 0 ; i + j < numSplits ; ++ j )
+            {   // For each sub-triangle pointing the same way as the triangle...
+                panel.mPosition = a + ab * ( ( float( i ) + 1.0f / 3.0f ) * oneOverN ) + ac * ( ( float( j ) + 1.0f / 3.0f ) * oneOverN ) ;
+                localPanels.PushBack( panel ) ;
+                if( i + j + 1 < numSplits )
+                {   // Sub-triangle pointing the opposite way fits beside it.
+                    panel.mPosition = a + ab * ( ( float( i ) + 2.0f / 3.0f ) * oneOverN ) + ac * ( ( float( j ) + 2.0f / 3.0f ) * oneOverN ) ;
+                    localPanels.PushBack( panel ) ;
+                }
+            }
+        }
+    }
+}
+
+
+
+
+/** Place panels on bodies, in world space, and compute body surface velocity at each.
+
+    This tessellates each body shape once, and caches the result in body
+    space, then each call transforms those panels by current body pose.
+*/
+void BoundaryPanels::PlacePanels( const VECTOR< Impulsion::PhysicalObject * > & physicalObjects )
+{
+    PERF_BLOCK( BoundaryPanels__PlacePanels ) ;
+
+    const size_t    numPhysObjs     = physicalObjects.Size() ;
+    size_t          numSolidBodies  = 0 ;
+    for( size_t iPhysObj = 0 ; iPhysObj < numPhysObjs ; ++ iPhysObj )
+    {   // For each body...
+        if( ! physicalObjects[ iPhysObj ]->GetCollisionShape()->IsHole() )
+        {
+            ++ numSolidBodies ;
+        }
+    }
+    const unsigned panelsPerBody = numSolidBodies ? Min2( mPanelsPerBody , unsigned( sMaxPanels / numSolidBodies ) ) : mPanelsPerBody ;
+
+    mBodyPanels.Resize( numPhysObjs ) ;
+    mPanels.Clear() ;
+
+    for( size_t iPhysObj = 0 ; iPhysObj < numPhysObjs ; ++ iPhysObj )
+    {   // For each body...
+        const Impulsion::PhysicalObject &   physObj         = * physicalObjects[ iPhysObj ] ;
+        const Collision::ShapeBase *        collisionShape  = physObj.GetCollisionShape() ;
+        BodyPanels &                        bodyPanels      = mBodyPanels[ iPhysObj ] ;
+
+        if( collisionShape->IsHole() || ( 0 == panelsPerBody ) )
+        {   // Body is a container, which FluidBodySim handles per vorton.
+            bodyPanels.mLocalPanels.Clear() ;
+            continue ;
+        }
+
+        if( ( bodyPanels.mShape != collisionShape ) || ( bodyPanels.mPanelsPerBody != panelsPerBody ) )
+        {   // Panels do not yet cover this shape.
+            bodyPanels.mShape           = collisionShape ;
+            bodyPanels.mPanelsPerBody   = panelsPerBody ;
+            if( collisionShape->GetShapeType() == Collision::SphereShape::sShapeType )
+            {
+                TessellateSphere( bodyPanels.mLocalPanels , collisionShape->GetBoundingSphereRadius() , panelsPerBody ) ;
+            }
+            else
+            {
+                TessellatePolytope( bodyPanels.mLocalPanels , * static_cast< const Collision::ConvexPolytope * >( collisionShape ) , panelsPerBody ) ;
+            }
+        }
+
+        const Impulsion::RigidBody *    rigidBody   = physObj.GetBody() ;
+        const Mat33 &                   orientation = rigidBody->GetOrientation() ;
+        const size_t                    numLocal    = bodyPanels.mLocalPanels.Size() ;
+        for( size_t iLocal = 0 ; iLocal < numLocal ; ++ iLocal )
+        {   // For each panel on this body...
+            const LocalPanel &  localPanel      = bodyPanels.mLocalPanels[ iLocal ] ;
+            const Vec3          positionRel     = orientation.Transform( localPanel.mPosition ) ;
+            Panel               panel           ;
+            panel.mPosition         = rigidBody->GetPosition() + positionRel ;
+            panel.mNormal           = orientation.Transform( localPanel.mNormal ) ;
+            panel.mArea             = localPanel.mArea ;
+            panel.mBodyVelocity     = rigidBody->GetVelocity() + ( rigidBody->GetAngularVelocity() ^ positionRel ) ;
+            panel.mOnsetVelocity    = Vec3( 0.0f , 0.0f , 0.0f ) ;
+            panel.mSourceStrength   = 0.0f ;
+            panel.mSheetStrength    = Vec3( 0.0f , 0.0f , 0.0f ) ;
+            panel.mIdxPhysObj       = unsigned( iPhysObj ) ;
+            mPanels.PushBack( panel ) ;
+        }
+    }
+}
+
+
+
+
+/** Sample fluid velocity, excluding that due to panels, just outside each control point.
+*/
+void BoundaryPanels::SampleOnsetVelocity( const UniformGrid< Vec3 > & velocityGrid )
+{
+    PERF_BLOCK( BoundaryPanels__SampleOnsetVelocity ) ;
+
+    if( velocityGrid.Empty() )
+    {   // No velocity.
+        return ;
+    }
+
+    // Sample half a cell out from the surface, where the grid represents fluid rather than body interior.
+    const Vec3 &    spacing     = velocityGrid.GetCellSpacing() ;
+    const float     offset      = 0.5f * Min2( spacing.x , Min2( spacing.y , spacing.z ) ) ;
+    const size_t    numPanels   = mPanels.Size() ;
+    for( size_t iPanel = 0 ; iPanel < numPanels ; ++ iPanel )
+    {   // For each panel...
+        Panel &     panel       = mPanels[ iPanel ] ;
+        const Vec3  samplePoint = panel.mPosition + panel.mNormal * offset ;
+        if( velocityGrid.Encompasses( samplePoint ) )
+        {
+            velocityGrid.Interpolate( panel.mOnsetVelocity , samplePoint ) ;
+        }
+    }
+}
+
+
+
+
+/** Solve for source sheet strengths such that velocity through each panel, relative to its body, vanishes.
+
+    The dense system is
+
+        sum_j A_ij sigma_j = ( u_body_i - u_onset_i ) . n_i
+
+    where A_ij is the normal velocity, at control point i, that a unit source
+    sheet on panel j induces.  A flat source sheet induces half its strength
+    as normal velocity on each side, so A_ii = 1/2.  That makes the system
+    diagonally dominant for reasonable panels, so Gaussian elimination with
+    partial pivoting suffices.
+*/
+void BoundaryPanels::SolveSourceStrengths()
+{
+    PERF_BLOCK( BoundaryPanels__SolveSourceStrengths ) ;
+
+    const size_t numPanels = mPanels.Size() ;
+    mInfluence.Resize( numPanels * numPanels ) ;
+    mRhs.Resize( numPanels ) ;
+
+    for( size_t i = 0 ; i < numPanels ; ++ i )
+    {   // For each control point...
+        const Panel &   panelI  = mPanels[ i ] ;
+        float *         row     = & mInfluence[ i * numPanels ] ;
+        for( size_t j = 0 ; j < numPanels ; ++ j )
+        {   // For each panel...
+            if( i == j )
+            {
+                row[ j ] = 0.5f ;
+            }
+            else
+            {
+                Panel unitPanel = mPanels[ j ] ;
+                unitPanel.mSourceStrength = 1.0f ;
+                row[ j ] = SourcePanelVelocity( unitPanel , panelI.mPosition ) * panelI.mNormal ;
+            }
+        }
+        mRhs[ i ] = ( panelI.mBodyVelocity - panelI.mOnsetVelocity ) * panelI.mNormal ;
+    }
+
+    // Forward elimination, with partial pivoting.
+    for( size_t k = 0 ; k < numPanels ; ++ k )
+    {   // For each pivot column...
+        size_t  iPivot      = k ;
+        float   pivotMag    = fabsf( mInfluence[ k * numPanels + k ] ) ;
+        for( size_t i = k + 1 ; i < numPanels ; ++ i )
+        {   // For each row below pivot...
+            const float mag = fabsf( mInfluence[ i * numPanels + k ] ) ;
+            if( mag > pivotMag )
+            {
+                pivotMag    = mag ;
+                iPivot      = i ;
+            }
+        }
+        if( pivotMag < sTinyPivot )
+        {   // Column is singular.  Leave its unknown at zero, below.
+            continue ;
+        }
+        if( iPivot != k )
+        {   // Swap rows so the largest element becomes the pivot.
+            for( size_t j = k ; j < numPanels ; ++ j )
+            {
+                const float temp = mInfluence[ k * numPanels + j ] ;
+                mInfluence[ k * numPanels + j ]         = mInfluence[ iPivot * numPanels + j ] ;
+                mInfluence[ iPivot * numPanels + j ]    = temp ;
+            }
+            const float temp = mRhs[ k ] ;
+            mRhs[ k ]       = mRhs[ iPivot ] ;
+            mRhs[ iPivot ]  = temp ;
+        }
+        const float     oneOverPivot    = 1.0f / mInfluence[ k * numPanels + k ] ;
+        const float *   rowK            = & mInfluence[ k * numPanels ] ;
+        for( size_t i = k + 1 ; i < numPanels ; ++ i )
+        {   // For each row below pivot...
+            float *     rowI    = & mInfluence[ i * numPanels ] ;
+            const float factor  = rowI[ k ] * oneOverPivot ;
+            if( 0.0f == factor )
+            {
+                continue ;
+            }
+            for( size_t j = k ; j < numPanels ; ++ j )
+            {
+                rowI[ j ] -= factor * rowK[ j ] ;
+            }
+            mRhs[ i ] -= factor * mRhs[ k ] ;
+        }
+    }
+
+    // Back substitution.
+    for( size_t k = numPanels ; k-- > 0 ; )
+    {   // For each row, from last to first...
+        const float *   rowK    = & mInfluence[ k * numPanels ] ;
+        float           sum     = mRhs[ k ] ;
+        for( size_t j = k + 1 ; j < numPanels ; ++ j )
+        {
+            sum -= rowK[ j ] * mRhs[ j ] ;
+        }
+        mRhs[ k ] = ( fabsf( rowK[ k ] ) < sTinyPivot ) ? 0.0f : sum / rowK[ k ] ;
+    }
+
+    for( size_t iPanel = 0 ; iPanel < numPanels ; ++ iPanel )
+    {
+        mPanels[ iPanel ].mSourceStrength = mRhs[ iPanel ] ;
+        ASSERT( ! IsNan( mPanels[ iPanel ].mSourceStrength ) && ! IsInf( mPanels[ iPanel ].mSourceStrength ) ) ;
+    }
+}
+
+
+
+
+/** Add velocity that panel source sheets induce at the given position.
+*/
+void BoundaryPanels::AccumulateVelocity( Vec3 & velocity , const Vec3 & position ) const
+{
+    const size_t numPanels = mPanels.Size() ;
+    for( size_t iPanel = 0 ; iPanel < numPanels ; ++ iPanel )
+    {   // For each panel...
+        velocity += SourcePanelVelocity( mPanels[ iPanel ] , position ) ;
+    }
+}
+
+
+
+
+/** Add velocity that panel source sheets induce to vortons and to the velocity grid.
+*/
+void BoundaryPanels::ApplySourceVelocity( VECTOR< Vorton > & vortons , UniformGrid< Vec3 > & velocityGrid )
+{
+    PERF_BLOCK( BoundaryPanels__ApplySourceVelocity ) ;
+
+    const size_t numVortons = vortons.Size() ;
+    const size_t numZ       = velocityGrid.Empty() ? 0 : velocityGrid.GetNumPoints( 2 ) ;
+    Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Function( ApplySourceVelocityToVortons_Slice , vortons , * this ) ) ;
+    Parallel::For( 0 , numZ , 1 , Parallel::Function( ApplySourceVelocityToGrid_Slice , velocityGrid , * this ) ) ;
+}
+
+
+
+
+/** Compute vortex sheet strength on each panel, from slip that remains after applying sources.
+
+    A vortex sheet of strength gamma makes velocity jump by gamma ^ n across
+    it.  Fluid just outside moves at u_fluid and the wall at u_body, so the
+    sheet that accounts for that jump has strength n ^ ( u_fluid - u_body ),
+    which is tangent to the panel.
+*/
+void BoundaryPanels::ComputeSheetStrengths()
+{
+    PERF_BLOCK( BoundaryPanels__ComputeSheetStrengths ) ;
+
+    mMaxNormalVelocityResidual = 0.0f ;
+    const size_t numPanels = mPanels.Size() ;
+    for( size_t i = 0 ; i < numPanels ; ++ i )
+    {   // For each panel...
+        Panel & panel = mPanels[ i ] ;
+        Vec3 fluidVelocity = panel.mOnsetVelocity + 0.5f * panel.mSourceStrength * panel.mNormal ;
+        for( size_t j = 0 ; j < numPanels ; ++ j )
+        {   // For each other panel...
+            if( j != i )
+            {
+                fluidVelocity += SourcePanelVelocity( mPanels[ j ] , panel.mPosition ) ;
+            }
+        }
+        const Vec3  slip        = fluidVelocity - panel.mBodyVelocity ;
+        const float slipNormal  = slip * panel.mNormal ;
+        mMaxNormalVelocityResidual = Max2( mMaxNormalVelocityResidual , fabsf( slipNormal ) ) ;
+        panel.mSheetStrength    = panel.mNormal ^ ( slip - slipNormal * panel.mNormal ) ;
+    }
+}
+
+
+
+
+/** Shed vortex sheets into vortons near each panel, and apply the reaction torque to bodies.
+
+    Each panel sheds circulation mSheddingFraction * gamma * area, split among
+    vortons within a boundary layer about two vorton radii thick, weighted
+    toward those nearest the panel.  Panels with no vortons nearby keep their
+    slip until vortons arrive.
+*/
+void BoundaryPanels::ShedVorticity( VECTOR< Vorton > & vortons , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects )
+{
+    PERF_BLOCK( BoundaryPanels__ShedVorticity ) ;
+
+    const VECTOR< Particle > & particles = reinterpret_cast< const VECTOR< Particle > & >( vortons ) ;
+    const float minReach = FluidBodyBroadphase::ComputeMinReach( physicalObjects , 0.0f ) ;
+    if( ( minReach >= FLT_MAX ) || vortons.Empty() )
+    {   // No solid bodies, or no vortons.
+        return ;
+    }
+    mBroadphase.Partition( particles , minReach ) ;
+    const float boundaryThickness = 2.0f * mBroadphase.GetMaxParticleRadius() ;
+
+    const size_t numPanels = mPanels.Size() ;
+    size_t iPanelBegin = 0 ;
+    while( iPanelBegin < numPanels )
+    {   // For each body with panels...
+        const unsigned  idxPhysObj  = mPanels[ iPanelBegin ].mIdxPhysObj ;
+        size_t          iPanelEnd   = iPanelBegin ;
+        while( ( iPanelEnd < numPanels ) && ( mPanels[ iPanelEnd ].mIdxPhysObj == idxPhysObj ) )
+        {
+            ++ iPanelEnd ;
+        }
+
+        Impulsion::PhysicalObject & physObj = * physicalObjects[ idxPhysObj ] ;
+        const float reach = physObj.GetCollisionShape()->GetBoundingSphereRadius() + boundaryThickness ;
+        mBroadphase.GatherCandidates( mCandidateIndices , particles , physObj.GetBody()->GetPosition() , reach ) ;
+        const size_t numCandidates = mCandidateIndices.Size() ;
+
+        Vec3 angularImpulseOnBody( 0.0f , 0.0f , 0.0f ) ;
+        for( size_t iPanel = iPanelBegin ; iPanel < iPanelEnd ; ++ iPanel )
+        {   // For each panel on this body...
+            const Panel &   panel           = mPanels[ iPanel ] ;
+            const float     influenceRadius = boundaryThickness + 0.5f * sqrtf( panel.mArea ) ;
+
+            // Sum weights of vortons in the boundary layer of this panel.
+            float weightSum = 0.0f ;
+            for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+            {   // For each vorton near this body...
+                const Vorton &  rVorton     = vortons[ mCandidateIndices[ iCandidate ] ] ;
+                const Vec3      fromPanel   = rVorton.mPosition - panel.mPosition ;
+                const float     dist        = fromPanel.Magnitude() ;
+                if( ( dist < influenceRadius ) && ( fromPanel * panel.mNormal > - rVorton.GetRadius() ) )
+                {   // Vorton lies in boundary layer of panel, on fluid side.
+                    const float proximity = 1.0f - dist / influenceRadius ;
+                    weightSum += proximity * proximity ;
+                }
+            }
+            if( weightSum <= 0.0f )
+            {   // No vortons near this panel.
+                continue ;
+            }
+
+            // Distribute circulation among those vortons.
+            const Vec3 circulationPerWeight = panel.mSheetStrength * ( mSheddingFraction * panel.mArea / weightSum ) ;
+            for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+            {   // For each vorton near this body...
+                Vorton &        rVorton     = vortons[ mCandidateIndices[ iCandidate ] ] ;
+                const Vec3      fromPanel   = rVorton.mPosition - panel.mPosition ;
+                const float     dist        = fromPanel.Magnitude() ;
+                if( ( dist < influenceRadius ) && ( fromPanel * panel.mNormal > - rVorton.GetRadius() ) )
+                {   // Vorton lies in boundary layer of panel, on fluid side.
+                    const float proximity           = 1.0f - dist / influenceRadius ;
+                    const Vec3  vorticityChange     = circulationPerWeight * ( proximity * proximity / rVorton.GetVolume() ) ;
+                    rVorton.SetVorticity( rVorton.GetVorticity() + vorticityChange ) ;
+                    // Transfer opposite angular momentum to body, treating vorton as a spinning sphere, as FluidBodySim::CollideVortonsSlice does.
+                    const float vortRadius          = rVorton.GetRadius() ;
+                    const float momentOfInertia     = 0.4f * rVorton.GetMass() * vortRadius * vortRadius ;
+                    angularImpulseOnBody           -= 0.5f * vorticityChange * momentOfInertia ;
+                }
+            }
+        }
+        ASSERT( ! IsNan( angularImpulseOnBody ) && ! IsInf( angularImpulseOnBody ) ) ;
+        physObj.GetBody()->ApplyImpulsiveTorque( angularImpulseOnBody ) ;
+
+        iPanelBegin = iPanelEnd ;
+    }
+}
+
+
+
+
+/** Impose no-through and no-slip conditions at body surfaces, using panels.
+
+    \param vortons      Vortons, whose velocity VortonSim already computed this step.  This adds velocity due to panel sources, and vorticity shed from panel vortex sheets.
+
+    \param velocityGrid Velocity grid VortonSim populated this step.  This adds velocity due to panel sources, so particles that sample the grid see it.
+
+    \param physicalObjects  Bodies.  This applies reaction torque to them.
+
+    Call after computing velocity from vorticity, and before advecting particles.
+*/
+void BoundaryPanels::Update( VECTOR< Vorton > & vortons , UniformGrid< Vec3 > & velocityGrid , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects )
+{
+    PERF_BLOCK( BoundaryPanels__Update ) ;
+
+    PlacePanels( physicalObjects ) ;
+    if( mPanels.Empty() )
+    {   // No solid bodies.
+        mMaxNormalVelocityResidual = 0.0f ;
+        return ;
+    }
+
+    SampleOnsetVelocity( velocityGrid ) ;
+    SolveSourceStrengths() ;
+    ApplySourceVelocity( vortons , velocityGrid ) ;
+    ComputeSheetStrengths() ;
+    ShedVorticity( vortons , physicalObjects ) ;
+}
@@ -0,0 +1,151 @@
+/** \file boundaryPanels.h
+
+    \brief Boundary element (panel) solver for no-through and no-slip conditions at body surfaces.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef BOUNDARY_PANELS_H
+#define BOUNDARY_PANELS_H
+
+#include "fluidBodyBroadphase.h"
+
+#include "VortonFluid/vorton.h"
+
+#include "Core/Containers/vector.h"
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+// Macros --------------------------------------------------------------
+
+/** Whether fluid-body interaction imposes boundary conditions using BoundaryPanels.
+
+    Otherwise, FluidBodySim::CollideVortonsSlice imposes them by assigning
+    vorticity, by penalty, to each vorton that hits a body.
+
+    Disabled by default:  Each update solves a dense system, serially, in
+    O(panels^3) time, up to sMaxPanels panels, and that cost has not yet been
+    measured against the penalty method it replaces.
+*/
+#if ! defined( ENABLE_BOUNDARY_PANELS )
+    #define ENABLE_BOUNDARY_PANELS 0
+#endif
+
+// Types --------------------------------------------------------------
+
+namespace Impulsion
+{
+    class PhysicalObject ;
+}
+
+namespace Collision
+{
+    class ConvexPolytope ;
+}
+
+/** Boundary element (panel) solver for no-through and no-slip conditions at body surfaces.
+
+    Assigning vorticity to each vorton that hits a body only corrects slip
+    where vortons happen to be, so flow passes through body walls between
+    vortons unless many vortons crowd each body.  Instead, this covers each
+    body surface with panels, which are patches of a sphere or triangles
+    subdividing faces of a ConvexPolytope, and each step:
+
+        -   Solves a small dense system for the strength of a source sheet on
+            each panel, so that velocity normal to each panel, at its control
+            point, matches that of the body.  That imposes no-through flow
+            everywhere on the surface, regardless of where vortons lie.
+            Update adds velocity those sources induce to vortons and to the
+            velocity grid.
+
+        -   Computes the strength of a vortex sheet on each panel, from the
+            slip that remains between fluid and body, and sheds that sheet into
+            vortons near the panel, as vorticity flux.  That imposes no-slip,
+            and applies the reaction torque to the body.
+
+    This handles bodies that are not holes.  Holes (containers) keep the
+    per-vorton treatment in FluidBodySim.
+
+    The dense system costs O(panels^3), so mPanelsPerBody, times the number
+    of bodies, should stay within a few hundred.
+*/
+class BoundaryPanels
+{
+    public:
+        /// Most panels Update places, across all bodies.
+        static const unsigned sMaxPanels = 512 ;
+
+        /// Surface element on which a source sheet and a vortex sheet have uniform strength.
+        struct Panel
+        {
+            Vec3        mPosition           ;   ///< Control point, at centroid of panel, in world space.
+            Vec3        mNormal             ;   ///< Unit normal, pointing into fluid.
+            float       mArea               ;   ///< Area of panel.
+            Vec3        mBodyVelocity       ;   ///< Velocity of body surface at control point, including that due to rotation.
+            Vec3        mOnsetVelocity      ;   ///< Fluid velocity at control point, excluding that due to panels.
+            float       mSourceStrength     ;   ///< Volume flux, per area, that the source sheet emits.
+            Vec3        mSheetStrength      ;   ///< Circulation, per length, of vortex sheet.  Tangent to panel.
+            unsigned    mIdxPhysObj         ;   ///< Index of body, in the array given to Update, that owns this panel.
+        } ;
+
+        BoundaryPanels() ;
+
+        /// Set number of panels with which to cover each body.  Update places fewer if necessary to stay within sMaxPanels.
+        void    SetPanelsPerBody( unsigned panelsPerBody )              { mPanelsPerBody = panelsPerBody ; }
+
+        /// Set fraction, in [0,1], of vortex sheet strength to shed into vortons each update.  Lower values relax slip over several updates.
+        void    SetSheddingFraction( float sheddingFraction )           { mSheddingFraction = sheddingFraction ; }
+
+        void    Update( VECTOR< Vorton > & vortons , UniformGrid< Vec3 > & velocityGrid , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects ) ;
+
+        void    AccumulateVelocity( Vec3 & velocity , const Vec3 & position ) const ;
+
+        /// Return panels as of the most recent Update.
+        const VECTOR< Panel > & GetPanels() const                       { return mPanels ; }
+
+        /// Return largest magnitude, across panels, of velocity through the surface, relative to the body, after the most recent Update.  Indicates how well the dense solve converged.
+        float   GetMaxNormalVelocityResidual() const                    { return mMaxNormalVelocityResidual ; }
+
+    private:
+        /// Panel in space local to its body.
+        struct LocalPanel
+        {
+            Vec3        mPosition           ;   ///< Control point, relative to body center, in body space.
+            Vec3        mNormal             ;   ///< Unit normal, pointing out of body, in body space.
+            float       mArea               ;   ///< Area of panel.
+        } ;
+
+        /// Panels covering one body, cached so Update tessellates each shape only once.
+        struct BodyPanels
+        {
+            const void *            mShape          ;   ///< Address of the collision shape these panels cover.
+            unsigned                mPanelsPerBody  ;   ///< Number of panels requested when tessellating.
+            VECTOR< LocalPanel >    mLocalPanels    ;   ///< Panels in body space.
+        } ;
+
+        static void TessellateSphere( VECTOR< LocalPanel > & localPanels , float radius , unsigned numPanels ) ;
+        static void TessellatePolytope( VECTOR< LocalPanel > & localPanels , const Collision::ConvexPolytope & polytope , unsigned numPanels ) ;
+
+        void    PlacePanels( const VECTOR< Impulsion::PhysicalObject * > & physicalObjects ) ;
+        void    SampleOnsetVelocity( const UniformGrid< Vec3 > & velocityGrid ) ;
+        void    SolveSourceStrengths() ;
+        void    ApplySourceVelocity( VECTOR< Vorton > & vortons , UniformGrid< Vec3 > & velocityGrid ) ;
+        void    ComputeSheetStrengths() ;
+        void    ShedVorticity( VECTOR< Vorton > & vortons , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects ) ;
+
+        VECTOR< BodyPanels >    mBodyPanels                 ;   ///< Panels covering each body, in body space, indexed like the array of bodies given to Update.
+        VECTOR< Panel >         mPanels                     ;   ///< Panels covering all bodies, in world space.
+        VECTOR< float >         mInfluence                  ;   ///< Scratch for the dense system:  Row-major matrix of normal velocity each panel induces at each control point.
+        VECTOR< float >         mRhs                        ;   ///< Scratch for the dense system:  Normal velocity each panel must induce, then its source strength.
+        FluidBodyBroadphase     mBroadphase                 ;   ///< Spatial partition of vortons, to find those near each body.
+        VECTOR< unsigned >      mCandidateIndices           ;   ///< Scratch:  Indices of vortons near the current body.
+        unsigned                mPanelsPerBody              ;   ///< Number of panels with which to cover each body.
+        float                   mSheddingFraction           ;   ///< Fraction of vortex sheet strength to shed into vortons each update.
+        float                   mMaxNormalVelocityResidual  ;   ///< Largest velocity through the surface, relative to the body, after the most recent Update.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
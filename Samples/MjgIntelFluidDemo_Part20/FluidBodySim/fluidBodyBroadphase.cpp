@@ -0,0 +1,185 @@
+/** \file fluidBodyBroadphase.cpp
+
+    \brief Broad phase collision detection between fluid particles and rigid bodies.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "fluidBodyBroadphase.h"
+
+#include "Impulsion/physicalObject.h"
+
+#include "Particles/Operation/pclOpFindBoundingBox.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include <float.h>
+
+// Private variables --------------------------------------------------------------
+
+static const float sFatten = 1.0f + 1.0e-4f ;  // Err toward including particles, since callers repeat their own exact test.
+
+// Private functions --------------------------------------------------------------
+
+/** Return index, along one axis, of the cell containing the given coordinate, clamped to the grid.
+
+    \param coordRel - Coordinate relative to the grid minimal corner, times number of cells per unit length.
+
+    \param numPoints - Number of gridpoints along the axis.
+
+    Unlike UniformGridGeometry::IndicesOfPosition, this accepts coordinates outside the grid.
+*/
+static size_t ClampedCellIndex( float coordRel , size_t numPoints )
+{
+    if( ! ( coordRel > 0.0f ) )
+    {   // Coordinate lies below grid, or grid has zero extent along this axis.
+        return 0 ;
+    }
+    const float maxIndex = float( numPoints - 1 ) ;
+    if( coordRel >= maxIndex )
+    {   // Coordinate lies above grid.
+        return numPoints - 1 ;
+    }
+    return size_t( coordRel ) ;
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Return whether this broad phase can cull particles for the given body.
+
+    Holes collide with particles outside their bounding sphere, so they can
+    not use a test that keeps only particles inside it.
+*/
+/* static */ bool FluidBodyBroadphase::IsCullable( const Impulsion::PhysicalObject & physObj )
+{
+    return ! physObj.GetCollisionShape()->IsHole() ;
+}
+
+
+
+
+/** Return the smallest reach, i.e. padded bounding sphere radius, among bodies this can cull particles for.
+
+    \param physicalObjects - Rigid bodies.
+
+    \param padding - Distance to add to each bounding sphere radius.
+
+    \return Smallest reach, or FLT_MAX if no bodies are cullable.
+
+    Callers use the result as the minimum cell spacing, so each cullable body
+    overlaps few cells, yet the partition has no more cells than it needs.
+*/
+/* static */ float FluidBodyBroadphase::ComputeMinReach( const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , float padding )
+{
+    float minReach = FLT_MAX ;
+    const size_t numPhysObjs = physicalObjects.Size() ;
+    for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+    {   // For each body...
+        const Impulsion::PhysicalObject & physObj = * physicalObjects[ idxPhysObj ] ;
+        if( IsCullable( physObj ) )
+        {
+            minReach = Min2( minReach , physObj.GetCollisionShape()->GetBoundingSphereRadius() + padding ) ;
+        }
+    }
+    return minReach ;
+}
+
+
+
+
+/** Partition the given particles into cells no smaller than the given spacing.
+
+    \param particles - Particles to partition.  GatherCandidates must receive these same particles, unmoved.
+
+    \param minCellSpacing - Minimum size of each cell.  See ComputeMinReach.
+*/
+void FluidBodyBroadphase::Partition( const VECTOR< Particle > & particles , float minCellSpacing )
+{
+    PERF_BLOCK( FluidBodyBroadphase__Partition ) ;
+
+    const size_t numParticles = particles.Size() ;
+    if( 0 == numParticles )
+    {
+        mPclIndicesGrid.Clear() ;
+        mMaxParticleRadius = 0.0f ;
+        return ;
+    }
+
+    Vec3 minCorner( FLT_MAX , FLT_MAX , FLT_MAX ) ;
+    Vec3 maxCorner( - minCorner ) ;
+    PclOpFindBoundingBox::FindBoundingBox( particles , minCorner , maxCorner ) ;
+
+    mMaxParticleRadius = 0.0f ;
+    for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+    {   // For each particle...
+        mMaxParticleRadius = Max2( mMaxParticleRadius , particles[ iPcl ].GetRadius() ) ;
+    }
+
+    // Ask for about one particle per cell; Partition coarsens that to minCellSpacing.
+    UniformGridGeometry gridTemplate ;
+    gridTemplate.DefineShape( numParticles , minCorner , maxCorner , false ) ;
+
+    mPclIndicesGrid.Partition( particles , gridTemplate , minCellSpacing ) ;
+}
+
+
+
+
+/** Gather indices of particles whose centers lie within the given sphere.
+
+    \param candidateIndices - (out) Indices of particles within the sphere, sorted by cell.
+
+    \param particles - Particles most recently given to Partition.
+
+    \param center - Center of sphere, typically the center of a body.
+
+    \param reach - Radius of sphere, typically the body bounding sphere radius
+        padded by the largest distance at which a particle can interact with the body.
+
+    This visits only the cells that overlap the axis-aligned box around the sphere.
+*/
+void FluidBodyBroadphase::GatherCandidates( VECTOR< unsigned > & candidateIndices , const VECTOR< Particle > & particles , const Vec3 & center , float reach ) const
+{
+    candidateIndices.Clear() ;
+
+    if( mPclIndicesGrid.Empty() )
+    {   // No particles.
+        return ;
+    }
+
+    const Vec3 &    minCorner       = mPclIndicesGrid.GetMinCorner() ;
+    const Vec3 &    cellsPerExtent  = mPclIndicesGrid.GetCellsPerExtent() ;
+    const Vec3      reachVec( reach , reach , reach ) ;
+    const Vec3      lo( center - reachVec - minCorner ) ;
+    const Vec3      hi( center + reachVec - minCorner ) ;
+    const size_t    idxBegin[3] = { ClampedCellIndex( lo.x * cellsPerExtent.x , mPclIndicesGrid.GetNumPoints( 0 ) )
+                                  , ClampedCellIndex( lo.y * cellsPerExtent.y , mPclIndicesGrid.GetNumPoints( 1 ) )
+                                  , ClampedCellIndex( lo.z * cellsPerExtent.z , mPclIndicesGrid.GetNumPoints( 2 ) ) } ;
+    const size_t    idxLast[3]  = { ClampedCellIndex( hi.x * cellsPerExtent.x , mPclIndicesGrid.GetNumPoints( 0 ) )
+                                  , ClampedCellIndex( hi.y * cellsPerExtent.y , mPclIndicesGrid.GetNumPoints( 1 ) )
+                                  , ClampedCellIndex( hi.z * cellsPerExtent.z , mPclIndicesGrid.GetNumPoints( 2 ) ) } ;
+    const float     reach2      = Pow2( reach * sFatten ) ;
+
+    size_t idx[3] ;
+    for( idx[2] = idxBegin[2] ; idx[2] <= idxLast[2] ; ++ idx[2] )
+    {   // For each cell along z overlapping the sphere...
+        for( idx[1] = idxBegin[1] ; idx[1] <= idxLast[1] ; ++ idx[1] )
+        {   // For each cell along y overlapping the sphere...
+            for( idx[0] = idxBegin[0] ; idx[0] <= idxLast[0] ; ++ idx[0] )
+            {   // For each cell along x overlapping the sphere...
+                const CellList::Cell cell = mPclIndicesGrid[ idx ] ;
+                const size_t numInCell = cell.Size() ;
+                for( size_t iInCell = 0 ; iInCell < numInCell ; ++ iInCell )
+                {   // For each particle in this cell...
+                    const unsigned & rPclIdx = cell[ iInCell ] ;
+                    if( ( particles[ rPclIdx ].mPosition - center ).Mag2() < reach2 )
+                    {   // Particle lies within sphere.
+                        candidateIndices.PushBack( rPclIdx ) ;
+                    }
+                }
+            }
+        }
+    }
+}
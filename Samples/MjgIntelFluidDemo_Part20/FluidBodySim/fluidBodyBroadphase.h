@@ -0,0 +1,71 @@
+/** \file fluidBodyBroadphase.h
+
+    \brief Broad phase collision detection between fluid particles and rigid bodies.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef FLUID_BODY_BROADPHASE_H
+#define FLUID_BODY_BROADPHASE_H
+
+#include "Core/Containers/vector.h"
+
+#include "Core/SpatialPartition/cellList.h"
+
+#include "Particles/particle.h"
+
+// Macros --------------------------------------------------------------
+
+/** Whether FluidBodySim culls particles per body using FluidBodyBroadphase.
+
+    Otherwise, FluidBodySim tests every particle against every body.
+*/
+#define USE_FLUID_BODY_BROADPHASE 1
+
+// Types --------------------------------------------------------------
+
+namespace Impulsion
+{
+    class PhysicalObject ;
+}
+
+/** Broad phase collision detection between fluid particles and rigid bodies.
+
+    Routines that test each body against each particle cost O(bodies * particles),
+    even though each body typically touches only a small region of the fluid.
+    Instead, this partitions particle indices into a CellList, then, per body,
+    gathers only the particles inside the body's (padded) bounding sphere, by
+    visiting only the cells that overlap that sphere.
+
+    Bodies that are holes (i.e. containers, whose interior holds the fluid)
+    collide with particles outside their bounding sphere, so this cannot cull
+    particles for them.  Callers must test all particles against holes.
+*/
+class FluidBodyBroadphase
+{
+    public:
+        FluidBodyBroadphase()
+            : mMaxParticleRadius( 0.0f )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        static bool  IsCullable( const Impulsion::PhysicalObject & physObj ) ;
+        static float ComputeMinReach( const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , float padding ) ;
+
+        void Partition( const VECTOR< Particle > & particles , float minCellSpacing ) ;
+        void GatherCandidates( VECTOR< unsigned > & candidateIndices , const VECTOR< Particle > & particles , const Vec3 & center , float reach ) const ;
+
+        /// Return radius of largest particle given to most recent call to Partition.
+        const float & GetMaxParticleRadius() const { return mMaxParticleRadius ; }
+
+    private:
+        CellList    mPclIndicesGrid     ;   ///< Spatial partition of particle indices.
+        float       mMaxParticleRadius  ;   ///< Radius of largest particle.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,237 @@
+/** \file fluidBodyMask.cpp
+
+    \brief Rasterization of rigid body shapes onto a uniform grid.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "fluidBodyMask.h"
+
+#include "Impulsion/physicalObject.h"
+
+#include "Collision/sphereShape.h"
+#include "Collision/convexPolytope.h"
+
+#include "Core/Performance/perfBlock.h"
+
+// Private functions --------------------------------------------------------------
+
+/** Return index, along one axis, of the gridpoint at or below the given coordinate, clamped to the grid.
+
+    \param coordRel - Coordinate relative to the grid minimal corner, times number of cells per unit length.
+
+    \param numPoints - Number of gridpoints along the axis.
+
+    \see ClampedCellIndex in fluidBodyBroadphase.cpp.
+*/
+static size_t ClampedGridIndex( float coordRel , size_t numPoints )
+{
+    if( ! ( coordRel > 0.0f ) )
+    {   // Coordinate lies below grid, or grid has zero extent along this axis.
+        return 0 ;
+    }
+    const float maxIndex = float( numPoints - 1 ) ;
+    if( coordRel >= maxIndex )
+    {   // Coordinate lies above grid.
+        return numPoints - 1 ;
+    }
+    return size_t( coordRel ) ;
+}
+
+
+
+
+/** Compute signed distance between the given point and the walls of the given body.
+
+    \param proximity - (out) Signed distance, negative inside the body.
+
+    \return Whether the point lies within the padded bounding sphere of the
+        body, and so whether this computed proximity.  If not, the point is
+        farther than padding from the body.
+*/
+static bool ComputeProximityToBody( float & proximity , const Impulsion::PhysicalObject & physObj , const Vec3 & position , float padding )
+{
+    const Vec3 &                    physObjPosition = physObj.GetBody()->GetPosition() ;
+    const Collision::ShapeBase *    collisionShape  = physObj.GetCollisionShape() ;
+    const float &                   boundingRadius  = collisionShape->GetBoundingSphereRadius() ;
+    const float                     distToCenter    = ( position - physObjPosition ).Magnitude() ;
+
+    if( collisionShape->IsHole() )
+    {
+        if( distToCenter <= Max2( boundingRadius - padding , 0.0f ) )
+        {   // Point lies deep inside the hole, far from its walls.
+            return false ;
+        }
+    }
+    else if( distToCenter >= boundingRadius + padding )
+    {   // Point lies outside padded bounding sphere.
+        return false ;
+    }
+
+    if( collisionShape->GetShapeType() == Collision::SphereShape::sShapeType )
+    {   // Rigid body is a sphere.
+        proximity = collisionShape->IsHole() ? ( boundingRadius - distToCenter ) : ( distToCenter - boundingRadius ) ;
+        return true ;
+    }
+    else if( collisionShape->GetShapeType() == Collision::ConvexPolytope::sShapeType )
+    {   // Rigid body is a polytope.
+        const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope * >( collisionShape ) ;
+        const Mat33 &                       physObjOrientation  = physObj.GetBody()->GetOrientation() ;
+        unsigned                            idxPlane ;
+        proximity = convexPolytope->ContactDistance( position , physObjPosition , physObjOrientation , idxPlane ) ;
+        return true ;
+    }
+
+    // Other shapes have no walls this can detect.
+    return false ;
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Rasterize the given bodies onto a grid with the given shape.
+
+    \param gridGeometry - Shape of grid whose gridpoints to mark.  Callers
+        index GetProximity with offsets into grids of this same shape.
+
+    \param physicalObjects - Rigid bodies to rasterize.
+
+    \param padding - Distance beyond body walls within which to mark gridpoints.
+*/
+void FluidBodyMask::Rasterize( const UniformGridGeometry & gridGeometry , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , float padding )
+{
+    PERF_BLOCK( FluidBodyMask__Rasterize ) ;
+
+    mProximities.CopyShape( gridGeometry ) ;
+    mProximities.Init( padding ) ;
+    mPadding = padding ;
+
+    mMaskedOffsets.Clear() ;
+    mInteriorOffsets.Clear() ;
+    mInteriorBegin.Clear() ;
+    mPlacements.Clear() ;
+
+    const size_t numPhysObjs = physicalObjects.Size() ;
+    mPlacements.Resize( numPhysObjs ) ;
+    mInteriorBegin.Reserve( numPhysObjs + 1 ) ;
+    for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+    {   // For each body...
+        const Impulsion::PhysicalObject & physObj = * physicalObjects[ idxPhysObj ] ;
+        BodyPlacement & placement = mPlacements[ idxPhysObj ] ;
+        placement.mPhysicalObject   = & physObj ;
+        placement.mPosition         = physObj.GetBody()->GetPosition() ;
+        placement.mOrientation      = physObj.GetBody()->GetOrientation() ;
+
+        mInteriorBegin.PushBack( unsigned( mInteriorOffsets.Size() ) ) ;
+        RasterizeBody( physObj , padding ) ;
+    }
+    mInteriorBegin.PushBack( unsigned( mInteriorOffsets.Size() ) ) ;
+}
+
+
+
+
+/** Return whether the most recent Rasterize used the given grid shape and bodies, placed as they are now, and at least the given padding.
+*/
+bool FluidBodyMask::IsCurrent( const UniformGridGeometry & gridGeometry , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , float padding ) const
+{
+    if(     ( padding > mPadding )
+        ||  ( physicalObjects.Size() != mPlacements.Size() )
+        ||  ( 0 == mProximities.Size() )
+        ||  ! mProximities.ShapeMatches( gridGeometry ) )
+    {
+        return false ;
+    }
+
+    const size_t numPhysObjs = physicalObjects.Size() ;
+    for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+    {   // For each body...
+        const Impulsion::PhysicalObject &   physObj     = * physicalObjects[ idxPhysObj ] ;
+        const BodyPlacement &               placement   = mPlacements[ idxPhysObj ] ;
+        if(     ( placement.mPhysicalObject != & physObj )
+            ||  ( placement.mPosition       != physObj.GetBody()->GetPosition() )
+            ||  ( placement.mOrientation    != physObj.GetBody()->GetOrientation() ) )
+        {   // Body differs or moved since Rasterize.
+            return false ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Mark gridpoints within padding of the given body.
+
+    This visits only gridpoints inside the axis-aligned box around the padded
+    bounding sphere of the body, unless the body is a hole.
+*/
+void FluidBodyMask::RasterizeBody( const Impulsion::PhysicalObject & physObj , float padding )
+{
+    if( 0 == mProximities.Size() )
+    {   // Grid has no gridpoints.
+        return ;
+    }
+
+    const size_t    numPoints[3]    = { mProximities.GetNumPoints( 0 ) , mProximities.GetNumPoints( 1 ) , mProximities.GetNumPoints( 2 ) } ;
+    size_t          idxBegin[3]     = { 0 , 0 , 0 } ;
+    size_t          idxLast[3]      = { numPoints[0] - 1 , numPoints[1] - 1 , numPoints[2] - 1 } ;
+
+    if( ! physObj.GetCollisionShape()->IsHole() )
+    {   // Body covers only gridpoints near its bounding sphere.
+        const Vec3 &    center          = physObj.GetBody()->GetPosition() ;
+        const float     reach           = physObj.GetCollisionShape()->GetBoundingSphereRadius() + padding ;
+        const Vec3 &    minCorner       = mProximities.GetMinCorner() ;
+        const Vec3 &    cellsPerExtent  = mProximities.GetCellsPerExtent() ;
+        const Vec3      reachVec( reach , reach , reach ) ;
+        const Vec3      lo( center - reachVec - minCorner ) ;
+        const Vec3      hi( center + reachVec - minCorner ) ;
+        if(     ( hi.x < 0.0f ) || ( hi.y < 0.0f ) || ( hi.z < 0.0f )
+            ||  ( lo.x * cellsPerExtent.x > float( numPoints[0] - 1 ) )
+            ||  ( lo.y * cellsPerExtent.y > float( numPoints[1] - 1 ) )
+            ||  ( lo.z * cellsPerExtent.z > float( numPoints[2] - 1 ) ) )
+        {   // Body lies entirely outside grid.
+            return ;
+        }
+        idxBegin[0] = ClampedGridIndex( lo.x * cellsPerExtent.x , numPoints[0] ) ;
+        idxBegin[1] = ClampedGridIndex( lo.y * cellsPerExtent.y , numPoints[1] ) ;
+        idxBegin[2] = ClampedGridIndex( lo.z * cellsPerExtent.z , numPoints[2] ) ;
+        idxLast[0]  = ClampedGridIndex( hi.x * cellsPerExtent.x , numPoints[0] ) + 1 ;
+        idxLast[1]  = ClampedGridIndex( hi.y * cellsPerExtent.y , numPoints[1] ) + 1 ;
+        idxLast[2]  = ClampedGridIndex( hi.z * cellsPerExtent.z , numPoints[2] ) + 1 ;
+        idxLast[0]  = Min2( idxLast[0] , numPoints[0] - 1 ) ;
+        idxLast[1]  = Min2( idxLast[1] , numPoints[1] - 1 ) ;
+        idxLast[2]  = Min2( idxLast[2] , numPoints[2] - 1 ) ;
+    }
+
+    unsigned idx[3] ;
+    for( idx[2] = unsigned( idxBegin[2] ) ; idx[2] <= idxLast[2] ; ++ idx[2] )
+    {   // For each gridpoint along z near the body...
+        for( idx[1] = unsigned( idxBegin[1] ) ; idx[1] <= idxLast[1] ; ++ idx[1] )
+        {   // For each gridpoint along y near the body...
+            for( idx[0] = unsigned( idxBegin[0] ) ; idx[0] <= idxLast[0] ; ++ idx[0] )
+            {   // For each gridpoint along x near the body...
+                const Vec3  gridPointPosition   = mProximities.PositionFromIndices( idx ) ;
+                float       proximity ;
+                if( ! ComputeProximityToBody( proximity , physObj , gridPointPosition , padding ) || ( proximity >= padding ) )
+                {   // Gridpoint is not near this body.
+                    continue ;
+                }
+
+                const unsigned  offset      = unsigned( mProximities.OffsetFromIndices( idx[0] , idx[1] , idx[2] ) ) ;
+                float &         rProximity  = mProximities[ offset ] ;
+                if( rProximity >= padding )
+                {   // First body near this gridpoint.
+                    mMaskedOffsets.PushBack( offset ) ;
+                }
+                rProximity = Min2( rProximity , proximity ) ;
+
+                if( proximity < 0.0f )
+                {   // Gridpoint is inside this body.
+                    mInteriorOffsets.PushBack( offset ) ;
+                }
+            }
+        }
+    }
+}
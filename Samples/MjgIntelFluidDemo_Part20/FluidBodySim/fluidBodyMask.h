@@ -0,0 +1,108 @@
+/** \file fluidBodyMask.h
+
+    \brief Rasterization of rigid body shapes onto a uniform grid.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef FLUID_BODY_MASK_H
+#define FLUID_BODY_MASK_H
+
+#include "Core/Containers/vector.h"
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+#include "Core/Math/mat33.h"
+
+#include "Core/Utility/macros.h"
+
+// Macros --------------------------------------------------------------
+
+/** Whether FluidBodySim routines that visit gridpoints near bodies use a FluidBodyMask.
+
+    Otherwise, those routines test every gridpoint against every body.
+*/
+#define USE_FLUID_BODY_MASK 1
+
+// Types --------------------------------------------------------------
+
+namespace Impulsion
+{
+    class PhysicalObject ;
+}
+
+/** Rasterization of rigid body shapes onto a uniform grid.
+
+    Routines that test each gridpoint against each body cost
+    O(gridpoints * bodies), even though each body typically covers only a
+    small region of the grid.  Instead, this visits, per body, only the
+    gridpoints inside the body's padded bounding box, and records the signed
+    distance to the nearest body wall at each.  Callers then visit only the
+    gridpoints this marked, so they cost O(gridpoints + body voxels).
+
+    Since this truncates signed distance to the padding, the grid also serves
+    as a narrow-band distance field, which callers can interpolate.
+
+    Bodies that are holes (i.e. containers, whose interior holds the fluid)
+    cover gridpoints outside their bounding sphere, so this visits every
+    gridpoint for them.
+*/
+class FluidBodyMask
+{
+    public:
+        FluidBodyMask()
+            : mPadding( 0.0f )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        void Rasterize( const UniformGridGeometry & gridGeometry , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , float padding ) ;
+        bool IsCurrent( const UniformGridGeometry & gridGeometry , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , float padding ) const ;
+
+        /// Return distance beyond body walls within which this marked gridpoints.
+        const float &               GetPadding() const                      { return mPadding ; }
+
+        /// Return signed distance, negative inside, between the given gridpoint and the nearest body wall, or GetPadding if that exceeds GetPadding.
+        const float &               GetProximity( size_t offset ) const     { return mProximities[ offset ] ; }
+
+        /** Interpolate signed distance to the nearest body wall at the given position, which must lie inside the grid.
+
+            Results are accurate where the whole grid cell containing the position lies within GetPadding of walls.
+            Farther away, results lie between the distance to walls and GetPadding.
+        */
+        void                        InterpolateProximity( float & proximity , const Vec3 & position ) const { mProximities.Interpolate( proximity , position ) ; }
+
+        /// Return offsets of gridpoints whose proximity is less than GetPadding, each once.
+        const VECTOR< unsigned > &  GetMaskedOffsets() const                { return mMaskedOffsets ; }
+
+        /// Return number of gridpoints inside the given body.
+        size_t                      GetNumInteriorPoints( size_t idxPhysObj ) const { return mInteriorBegin[ idxPhysObj + 1 ] - mInteriorBegin[ idxPhysObj ] ; }
+
+        /// Return offsets of gridpoints inside the given body.  There are GetNumInteriorPoints of them.
+        const unsigned *            GetInteriorOffsets( size_t idxPhysObj ) const   { return mInteriorOffsets.Empty() ? NULLPTR : & mInteriorOffsets[ mInteriorBegin[ idxPhysObj ] ] ; }
+
+    private:
+        /** Placement of a body when this rasterized it.
+        */
+        struct BodyPlacement
+        {
+            const Impulsion::PhysicalObject *   mPhysicalObject ;   ///< Body this rasterized.
+            Vec3                                mPosition       ;   ///< Position of body.
+            Mat33                               mOrientation    ;   ///< Orientation of body.
+        } ;
+
+        void RasterizeBody( const Impulsion::PhysicalObject & physObj , float padding ) ;
+
+        UniformGrid< float >        mProximities        ;   ///< Signed distance between each gridpoint and nearest body wall, truncated to padding.
+        VECTOR< unsigned >          mMaskedOffsets      ;   ///< Offsets of gridpoints within padding of any body.
+        VECTOR< unsigned >          mInteriorOffsets    ;   ///< Offsets of gridpoints inside each body, sorted by body.
+        VECTOR< unsigned >          mInteriorBegin      ;   ///< Per body, index into mInteriorOffsets of its first interior gridpoint, then one past the last.
+        VECTOR< BodyPlacement >     mPlacements         ;   ///< Placement of each body when this rasterized it.
+        float                       mPadding            ;   ///< Distance beyond body walls within which this marked gridpoints.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -16,6 +16,10 @@
 
 #include "fluidBodySim.h"
 
+#include "fluidBodyBroadphase.h"
+#include "fluidBodyMask.h"
+#include "boundaryPanels.h"
+
 #include "Sim/Vorton/vorticityDistribution.h"
 
 #include "Impulsion/physicalObject.h"
@@ -23,8 +27,12 @@
 #include "Collision/sphereShape.h"
 #include "Collision/convexPolytope.h"
 
+#include "Particles/particleLifecycle.h"
+#include "Particles/Operation/pclOpFindBoundingBox.h"
+
 #include "Core/Performance/perfBlock.h"
 
+#include "Core/parallelExecution.h"
 
 #include <xmmintrin.h>  // SSE intrinsics
 
@@ -56,235 +64,18 @@ unsigned FluidBodySim::GetNumTracerBodyHits()
 
 #endif
 
+#if USE_FLUID_BODY_MASK
+static FluidBodyMask sBodyMask ; // Bodies rasterized onto grid most recently given to GetBodyMask.
+#endif
 
+#if COMPUTE_PARTICLE_PROXIMITY_TO_WALLS && COMPUTE_PARTICLE_PROXIMITY_FROM_DISTANCE_FIELD
+static FluidBodyMask sWallDistanceField ; // Distance to body walls, baked by ComputeParticleProximityToWalls.  Kept between calls to reuse its memory.
 
-#if USE_TBB
-    /** Function object to collide vortons (vortex particles) with rigid bodies.
-    */
-    class FluidBodySim_CollideVortons_TBB
-    {
-        private:
-            VECTOR< Particle > &                mVortons                    ;   ///< Dynamic array of vortons.
-            const Impulsion::PhysicalObject &   mPhysicalObject             ;   ///< Reference to PhysicalObject colliding with vortons.
-            float                               mAmbientFluidDensity        ;   ///< Fluid density in the absence of particles.
-            float                               mFluidSpecificHeatCapacity  ;   ///< Amount fluid temperature changes put unit heat, per unit mass.
-
-            size_t                              mBegin                      ;   ///< Loop start for use with parallel_reduce.
-            size_t                              mEnd                        ;   ///< Loop end for use with parallel_reduce.
-            size_t                              mGrainSize                  ;   ///< Target number of elements to process per thread.
-
-            WORD                                mMasterThreadFloatingPointControlWord   ;   ///< FPCW from spawning thread.
-            unsigned                            mMasterThreadMmxControlStatusRegister   ;   ///< MXCSR from spawning thread.
-
-        public:
-            /// Constructor to use with parallel_invoke, which is deterministic.
-            FluidBodySim_CollideVortons_TBB( VECTOR< Particle > & rVortons , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , size_t begin , size_t end , size_t grainSize )
-                : mVortons( rVortons )
-                , mAmbientFluidDensity( ambientFluidDensity )
-                , mFluidSpecificHeatCapacity( fluidSpecificHeatCapacity )
-                , mPhysicalObject( physObj )
-                , mBegin( begin )
-                , mEnd( end )
-                , mGrainSize( grainSize )
-                , mLinearImpulseOnBody( 0.0f , 0.0f , 0.0f )
-                , mAngularImpulseOnBody( 0.0f , 0.0f , 0.0f )
-                , mHeatToBody( 0.0f )
-                , mSumPclTemperature( 0.0f )
-                , mNumPclsCollided( 0 )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-
-            /// Constructor to use with parallel_reduce, which is non-deterministic.
-            FluidBodySim_CollideVortons_TBB( VECTOR< Particle > & rVortons , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj )
-                : mVortons( rVortons )
-                , mAmbientFluidDensity( ambientFluidDensity )
-                , mFluidSpecificHeatCapacity( fluidSpecificHeatCapacity )
-                , mPhysicalObject( physObj )
-                , mBegin( 0 )       // Not used with parallel_reduce
-                , mEnd( 0 )         // Not used with parallel_reduce
-                , mGrainSize( 0 )   // Not used with parallel_reduce
-                , mLinearImpulseOnBody( 0.0f , 0.0f , 0.0f )
-                , mAngularImpulseOnBody( 0.0f , 0.0f , 0.0f )
-                , mHeatToBody( 0.0f )
-                , mSumPclTemperature( 0.0f )
-                , mNumPclsCollided( 0 )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-
-            /// Splitting copy constructor used by TBB parallel_reduce, which is non-deterministic.
-            FluidBodySim_CollideVortons_TBB( FluidBodySim_CollideVortons_TBB & that , tbb::split )
-                : mVortons( that.mVortons )
-                , mPhysicalObject( that.mPhysicalObject )
-                , mAmbientFluidDensity( that.mAmbientFluidDensity )
-                , mFluidSpecificHeatCapacity( that.mFluidSpecificHeatCapacity )
-                , mMasterThreadFloatingPointControlWord( that.mMasterThreadFloatingPointControlWord )
-                , mMasterThreadMmxControlStatusRegister( that.mMasterThreadMmxControlStatusRegister )
-                , mBegin( 0 )       // Not used with parallel_reduce
-                , mEnd( 0 )         // Not used with parallel_reduce
-                , mGrainSize( 0 )   // Not used with parallel_reduce
-                , mLinearImpulseOnBody( that.mLinearImpulseOnBody )
-                , mAngularImpulseOnBody( that.mAngularImpulseOnBody )
-                , mHeatToBody( that.mHeatToBody )
-                , mSumPclTemperature( that.mSumPclTemperature )
-                , mNumPclsCollided( that.mNumPclsCollided )
-            {
-            }
-
-            /// Invocation operator for use with parallel_invoke, which is deterministic.
-            void operator() () const
-            {   // Compute collisions for a subset of tracers.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                FluidBodySim::CollideVortonsReduce(
-                      mVortons
-                    , mAmbientFluidDensity
-                    , mFluidSpecificHeatCapacity
-                    , mPhysicalObject
-                    , mLinearImpulseOnBody
-                    , mAngularImpulseOnBody
-                    , mHeatToBody
-                    , mSumPclTemperature
-                    , mNumPclsCollided
-                    , mBegin , mEnd , mGrainSize ) ;
-            }
-
-            /// Invocation operator called by parallel_reduce, which is non-deterministic.
-            void operator() ( const tbb::blocked_range<size_t> & r )
-            {   // Compute collisions for a subset of tracers.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                FluidBodySim::CollideVortonsSlice(
-                      mVortons
-                    , mAmbientFluidDensity
-                    , mFluidSpecificHeatCapacity
-                    , mPhysicalObject
-                    , mLinearImpulseOnBody
-                    , mAngularImpulseOnBody
-                    , mHeatToBody
-                    , mSumPclTemperature
-                    , mNumPclsCollided
-                    , r.begin()
-                    , r.end() ) ;
-            }
-
-            /// Join the results of two threads spaned by parallel_reduce, which is non-deterministic.
-            void join( const FluidBodySim_CollideVortons_TBB & other )
-            {   // Reduce the results of 2 threads
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mLinearImpulseOnBody    += other.mLinearImpulseOnBody   ;
-                mAngularImpulseOnBody   += other.mAngularImpulseOnBody  ;
-                mHeatToBody             += other.mHeatToBody            ;
-                mSumPclTemperature      += other.mSumPclTemperature     ;
-                mNumPclsCollided        += other.mNumPclsCollided       ;
-            }
-
-            // Per-thread storage / outputs to caller:
-            mutable Vec3    mLinearImpulseOnBody    ;   ///< Linear impulse applied by vortons to rigid body.
-            mutable Vec3    mAngularImpulseOnBody   ;   ///< Angular impulse applied by vortons to rigid body.
-            mutable float   mHeatToBody             ;   ///< Heat applied by vortons to rigid body.
-            mutable float   mSumPclTemperature      ;   ///< Average temperature of particles contacting rigid body.
-            mutable size_t  mNumPclsCollided        ;   ///< Number of particles that collided with rigid body.
-    } ;
-
-
-
-
-    /** Function object to collide passive tracer particles with rigid bodies.
-    */
-    class FluidBodySim_CollideTracers_TBB
-    {
-            VECTOR< Particle > &                mTracers                ;   ///< Dynamic array of tracers
-            const Impulsion::PhysicalObject &   mPhysicalObject         ;   ///< Reference to PhysicalObject colliding with tracers
-
-            size_t                              mBegin      ;   ///< Loop start for use with parallel_reduce.
-            size_t                              mEnd        ;   ///< Loop end for use with parallel_reduce.
-            size_t                              mGrainSize  ;   ///< Target number of elements to process per thread.
-
-            WORD                                mMasterThreadFloatingPointControlWord   ;   ///< FPCW from spawning thread.
-            unsigned                            mMasterThreadMmxControlStatusRegister   ;   ///< MXCSR from spawning thread.
-
-        public:
-            /// Constructor to use with parallel_invoke.
-            FluidBodySim_CollideTracers_TBB( VECTOR< Particle > & rTracers , const Impulsion::PhysicalObject & physObj , size_t begin , size_t end , size_t grainSize )
-                : mTracers( rTracers )
-                , mPhysicalObject( physObj )
-                , mBegin( begin )
-                , mEnd( end )
-                , mGrainSize( grainSize )
-                , mLinearImpulseOnBody( 0.0f , 0.0f , 0.0f )
-                , mAngularImpulseOnBody( 0.0f , 0.0f , 0.0f )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-
-            /// Constructor to use with parallel_reduce, which is non-deterministic.
-            FluidBodySim_CollideTracers_TBB( VECTOR< Particle > & rTracers , const Impulsion::PhysicalObject & physObj )
-                : mTracers( rTracers )
-                , mPhysicalObject( physObj )
-                , mBegin( 0 )       // Not used with parallel_reduce
-                , mEnd( 0 )         // Not used with parallel_reduce
-                , mGrainSize( 0 )   // Not used with parallel_reduce
-                , mLinearImpulseOnBody( 0.0f , 0.0f , 0.0f )
-                , mAngularImpulseOnBody( 0.0f , 0.0f , 0.0f )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-
-            /// Splitting copy constructor used by TBB parallel_reduce, which is non-deterministic.
-            FluidBodySim_CollideTracers_TBB( FluidBodySim_CollideTracers_TBB & that , tbb::split )
-                : mTracers( that.mTracers )
-                , mPhysicalObject( that.mPhysicalObject )
-                , mBegin( 0 )       // Not used with parallel_reduce
-                , mEnd( 0 )         // Not used with parallel_reduce
-                , mGrainSize( 0 )   // Not used with parallel_reduce
-                , mMasterThreadFloatingPointControlWord( that.mMasterThreadFloatingPointControlWord )
-                , mMasterThreadMmxControlStatusRegister( that.mMasterThreadMmxControlStatusRegister )
-                , mLinearImpulseOnBody( that.mLinearImpulseOnBody )
-                , mAngularImpulseOnBody( that.mAngularImpulseOnBody )
-            {
-            }
-
-            /// Invocation operator for use with parallel_invoke.
-            void operator() () const
-            {   // Compute collisions for a subset of tracers.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                FluidBodySim::CollideTracersReduce( mTracers , mPhysicalObject , mLinearImpulseOnBody , mAngularImpulseOnBody , mBegin , mEnd , mGrainSize ) ;
-            }
-
-            /// Invocation operator called by parallel_reduce, which is non-deterministic.
-            void operator() ( const tbb::blocked_range<size_t> & r )
-            {   // Compute collisions for a subset of tracers.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                FluidBodySim::CollideTracersSlice( mTracers , mPhysicalObject , mLinearImpulseOnBody , mAngularImpulseOnBody , r.begin() , r.end() ) ;
-            }
-
-            /// Join the results of two threads spaned by parallel_reduce, which is non-deterministic.
-            void join( const FluidBodySim_CollideTracers_TBB & other )
-            {   // Reduce the results of 2 threads
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mLinearImpulseOnBody  += other.mLinearImpulseOnBody  ;
-                mAngularImpulseOnBody += other.mAngularImpulseOnBody ;
-            }
-
-            // Thread-local storage:
-            mutable Vec3    mLinearImpulseOnBody    ;   ///< Linear impulse applied by tracers to rigid body.
-            mutable Vec3    mAngularImpulseOnBody   ;   ///< Angular impulse applied by tracers to rigid body.
-    } ;
+static const float sWallDistanceFieldSpacingFraction = 0.5f ; // Minimum cell spacing of sWallDistanceField, relative to maxProximity.
 #endif
 
 
 
-
 /** Select boundary condition handling scheme.
 
     The vorticity reassigned to this vortex should be such that
@@ -346,6 +137,91 @@ unsigned FluidBodySim::GetNumTracerBodyHits()
 
 
 
+/** Whether to query polytope contacts for batches of particles at a time.
+
+    ConvexPolytope::ContactDistanceMany and CollisionDistanceMany test
+    several particles at once against each face, in SIMD lanes, which
+    runs faster than testing one particle at a time against every face.
+    Disable this to compare against the single-particle queries.
+*/
+#define USE_BATCH_POLYTOPE_COLLISION 1
+
+/// Number of particles per batch of polytope contact queries, which bounds stack usage.
+static const size_t sPolytopeCollisionBatchSize = 64 ;
+
+
+
+
+/** Return whether the center of the given particle lies inside the given rigid body.
+
+    This only detects particles inside spheres and convex polytopes.
+    Particles inside bodies with other shapes are not embedded.
+*/
+static bool IsEmbeddedInPhysicalObject( const Particle & rParticle , const Impulsion::PhysicalObject & physObj )
+{
+    const Vec3 &    physObjPosition = physObj.GetBody()->GetPosition() ;
+    const Vec3      vSphereToTracer = rParticle.mPosition - physObjPosition ;   // vector from sphere center to tracer
+    const float     fSphereToTracer = vSphereToTracer.Magnitude() ;
+    if( fSphereToTracer < physObj.GetCollisionShape()->GetBoundingSphereRadius() /* Note the lack of rParticle.mSize in this expression. */ )
+    {   // Particle is inside bounding sphere of rigid body.
+        if( physObj.GetCollisionShape()->GetShapeType() == Collision::SphereShape::sShapeType )
+        {   // Rigid body is a sphere, and particle is inside it.
+            return true ;
+        }
+        else if( physObj.GetCollisionShape()->GetShapeType() == Collision::ConvexPolytope::sShapeType )
+        {   // Rigid body is a polytope.
+            // Test for collision.
+            const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope *  >( physObj.GetCollisionShape() ) ;
+            const Mat33 &                       physObjOrientation  = physObj.GetBody()->GetOrientation() ;
+            size_t                              idxPlane ;
+            const float                         contactDistance     = convexPolytope->ContactDistance( rParticle.mPosition , physObjPosition , physObjOrientation , idxPlane ) ;
+            if( contactDistance < rParticle.GetRadius() )
+            {   // Tracer is in contact rigid body.
+                return true ;
+            }
+        }
+    }
+    return false ;
+}
+
+
+
+
+#if ! USE_FLUID_BODY_BROADPHASE
+
+/** Predicate for Particles::KillIf that kills particles whose centers lie inside any of the given rigid bodies.
+*/
+class IsEmbeddedInAnyPhysicalObject
+{
+    public:
+        IsEmbeddedInAnyPhysicalObject( const VECTOR< Impulsion::PhysicalObject * > & physicalObjects )
+            : mPhysicalObjects( physicalObjects )
+        {}
+
+        bool operator()( const Particle & rParticle ) const
+        {
+            const size_t numPhysObjs = mPhysicalObjects.Size() ;
+            for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+            {   // For each rigid body in the simulation...
+                if( IsEmbeddedInPhysicalObject( rParticle , * mPhysicalObjects[ idxPhysObj ] ) )
+                {
+                    return true ;
+                }
+            }
+            return false ;
+        }
+
+    private:
+        IsEmbeddedInAnyPhysicalObject & operator=( const IsEmbeddedInAnyPhysicalObject & ) ;   // Disallow assignment
+
+        const VECTOR< Impulsion::PhysicalObject * > & mPhysicalObjects ;   ///< Rigid bodies inside which to kill particles.
+} ;
+
+#endif
+
+
+
+
 /** Remove particles within rigid bodies.
 
     This routine should only be called initially, to remove
@@ -364,56 +240,48 @@ unsigned FluidBodySim::GetNumTracerBodyHits()
 */
 void FluidBodySim::RemoveEmbeddedParticles( VECTOR< Particle > & particles , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects )
 {
-    if( particles.Empty() )
+    PERF_BLOCK( FluidBodySim__RemoveEmbeddedParticles ) ;
+
+    if( particles.Empty() || physicalObjects.Empty() )
     {   // No particles to remove.
-        return ; // Quit before accessing particles[0] below.
+        return ;
+    }
+
+    Particles::CompactionScratch scratch ;
+#if USE_FLUID_BODY_BROADPHASE
+    // Mark embedded particles, visiting only those near each body, then remove them all at once.
+    const float         minReach        = FluidBodyBroadphase::ComputeMinReach( physicalObjects , 0.0f ) ;
+    FluidBodyBroadphase broadphase      ;
+    VECTOR< unsigned >  candidateIndices ;
+    if( minReach < FLT_MAX )
+    {   // Some bodies are cullable.
+        broadphase.Partition( particles , minReach ) ;
     }
 
     const size_t numPhysObjs = physicalObjects.Size() ;
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
-    {   // For each sphere in the simulation...
-        Impulsion::PhysicalObject & physObj         = * physicalObjects[ idxPhysObj ] ;
-        const Vec3 &                physObjPosition = physObj.GetBody()->GetPosition() ;
-
-        Particle * pParticles = & particles[ 0 ] ;
-        for( size_t iParticle = 0 ; iParticle < particles.Size() ; )
-        {   // For each passive tracer particle in the simulation...
-            Particle & rParticle = pParticles[ iParticle ] ;
-            const Vec3  vSphereToTracer = rParticle.mPosition - physObjPosition ;   // vector from sphere center to tracer
-            const float fSphereToTracer = vSphereToTracer.Magnitude() ;
-            if( fSphereToTracer < physObj.GetCollisionShape()->GetBoundingSphereRadius() /* Note the lack of rParticle.mSize in this expression. */ )
-            {   // Particle is inside bounding sphere of rigid body.
-                if( physObj.GetCollisionShape()->GetShapeType() == Collision::SphereShape::sShapeType )
-                {   // Rigid body is a sphere, and particle is inside it.
-                    // Delete particle.
-                    Particles::Kill( particles , iParticle ) ;
-                }
-                else if( physObj.GetCollisionShape()->GetShapeType() == Collision::ConvexPolytope::sShapeType )
-                {   // Rigid body is a polytope.
-                    // Test for collision.
-                    const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope *  >( physObj.GetCollisionShape() ) ;
-                    const Vec3 &                        physObjPosition     = physObj.GetBody()->GetPosition() ;
-                    const Mat33 &                       physObjOrientation  = physObj.GetBody()->GetOrientation() ;
-                    size_t                              idxPlane ;
-                    const float                         contactDistance     = convexPolytope->ContactDistance( rParticle.mPosition , physObjPosition , physObjOrientation , idxPlane ) ;
-
-                    if( contactDistance < rParticle.GetRadius() )
-                    {   // Tracer is in contact rigid body.
-                        // Delete particle.
-                        Particles::Kill( particles , iParticle ) ;
-                    }
-                    else
-                    {   // Tracer is NOT in contact with rigid body.
-                        ++ iParticle ; // Did not delete particle so skip past it.
-                    }
-                }
-            }
-            else
-            {   // Did not delete particle so skip past it.
-                ++ iParticle ;
+    {   // For each rigid body in the simulation...
+        const Impulsion::PhysicalObject & physObj = * physicalObjects[ idxPhysObj ] ;
+        const bool      cull            = FluidBodyBroadphase::IsCullable( physObj ) ;
+        if( cull )
+        {   // Visit only particles inside bounding sphere of this body.
+            broadphase.GatherCandidates( candidateIndices , particles , physObj.GetBody()->GetPosition() , physObj.GetCollisionShape()->GetBoundingSphereRadius() ) ;
+        }
+        const size_t    numCandidates   = cull ? candidateIndices.Size() : particles.Size() ;
+        for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+        {   // For each particle possibly inside this body...
+            const size_t iPcl = cull ? candidateIndices[ iCandidate ] : iCandidate ;
+            if( particles[ iPcl ].IsAlive() && IsEmbeddedInPhysicalObject( particles[ iPcl ] , physObj ) )
+            {
+                Particles::MarkForKill( particles , iPcl ) ;
             }
         }
     }
+
+    Particles::KillIf( particles , Particles::IsMarkedDead() , scratch ) ;
+#else
+    Particles::KillIf( particles , IsEmbeddedInAnyPhysicalObject( physicalObjects ) , scratch ) ;
+#endif
 }
 
 
@@ -448,6 +316,10 @@ static int NumOutsideBounds( const Vec3 & pos )
     "Partially truncated" here means that only positive values are clipped.
     This routine imposes no limit for how negative each proximity can be,
     but (for performance reasons) positive values are limited to just above maxProximity.
+
+    With COMPUTE_PARTICLE_PROXIMITY_FROM_DISTANCE_FIELD, proximity to a
+    sphere is the distance to its surface, and proximities are trilinear
+    interpolations from a grid, so they vary smoothly but smear corners.
 */
 /* static */ void FluidBodySim::ComputeParticleProximityToWalls( VECTOR< float > & proximities , const VECTOR< Particle > & particles , const VECTOR< Impulsion::PhysicalObject * > & physObjs , const float maxProximity )
 {
@@ -458,6 +330,49 @@ static int NumOutsideBounds( const Vec3 & pos )
     proximities.Clear() ;
     proximities.Resize( numPcls , maxProximity * ( 1.0f + FLT_EPSILON ) ) ;
 
+#if COMPUTE_PARTICLE_PROXIMITY_FROM_DISTANCE_FIELD
+    if( ( 0 == numPcls ) || physObjs.Empty() )
+    {   // No particles, or no walls.
+        return ;
+    }
+
+    // Bake distance to walls onto a grid spanning the particles, then interpolate it at each particle.
+    // That costs O(particles + gridpoints near bodies), instead of testing each particle near each body against its shape.
+    Vec3 minCorner( FLT_MAX , FLT_MAX , FLT_MAX ) ;
+    Vec3 maxCorner( - minCorner ) ;
+    PclOpFindBoundingBox::FindBoundingBox( particles , minCorner , maxCorner ) ;
+
+    // Pad grid by a cell, so every particle lies strictly inside it.
+    const float         minCellSpacing  = sWallDistanceFieldSpacingFraction * maxProximity ;
+    const Vec3          gridPadding( minCellSpacing , minCellSpacing , minCellSpacing ) ;
+    UniformGridGeometry gridTemplate ;
+    gridTemplate.DefineShape( numPcls , minCorner - gridPadding , maxCorner + gridPadding , false ) ;   // About one gridpoint per particle...
+    UniformGridGeometry gridGeometry ;
+    gridGeometry.FitShape( gridTemplate , minCellSpacing ) ;                                            // ...but no finer than needed.
+
+    // Extend band of baked distances by a cell diagonal, so interpolating
+    // within maxProximity of walls only blends gridpoints inside the band.
+    const float         band            = maxProximity + gridGeometry.GetCellSpacing().Magnitude() ;
+    sWallDistanceField.Rasterize( gridGeometry , physObjs , band ) ;
+
+    const float         farProximity    = maxProximity * ( 1.0f + FLT_EPSILON ) ;
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {   // For each particle...
+        float proximity ;
+        sWallDistanceField.InterpolateProximity( proximity , particles[ iPcl ].mPosition ) ;
+        proximities[ iPcl ] = Min2( proximity , farProximity ) ;
+    }
+#else
+    VECTOR< unsigned >  candidateIndices ;
+#if USE_FLUID_BODY_BROADPHASE
+    const float         minReach        = FluidBodyBroadphase::ComputeMinReach( physObjs , maxProximity ) ;
+    FluidBodyBroadphase broadphase      ;
+    if( minReach < FLT_MAX )
+    {   // Some bodies are cullable.
+        broadphase.Partition( particles , minReach ) ;
+    }
+#endif
+
     const size_t numPhysObjs = physObjs.Size() ;
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
     {   // For each body...
@@ -467,8 +382,21 @@ static int NumOutsideBounds( const Vec3 & pos )
         const float &                   boundingRadius  = collisionShape->GetBoundingSphereRadius() ;
         const Impulsion::RigidBody *    rigidBody       = physObj.GetBody() ;
 
-        for( unsigned iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    #if USE_FLUID_BODY_BROADPHASE
+        const bool                      cull            = FluidBodyBroadphase::IsCullable( physObj ) ;
+        if( cull )
+        {   // Visit only particles inside padded bounding sphere of this body.
+            broadphase.GatherCandidates( candidateIndices , particles , physObjPosition , boundingRadius + maxProximity ) ;
+        }
+        const size_t                    numCandidates   = cull ? candidateIndices.Size() : numPcls ;
+    #else
+        const bool                      cull            = false ;
+        const size_t                    numCandidates   = numPcls ;
+    #endif
+
+        for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
         {   // For each particle...
+            const size_t iPcl = cull ? candidateIndices[ iCandidate ] : iCandidate ;
             const Vec3 & pclPos = particles[ iPcl ].mPosition ;
             // Compute particle proximity to bodies.
             float & proximity = proximities[ iPcl ] ;
@@ -511,6 +439,32 @@ static int NumOutsideBounds( const Vec3 & pos )
             }
         }
     }
+#endif
+}
+
+#endif
+
+
+
+
+#if USE_FLUID_BODY_MASK
+
+/** Return the given bodies rasterized onto a grid of the given shape.
+
+    This rasterizes only when the grid shape or body placements changed
+    since the previous call, so routines that visit gridpoints near bodies
+    share one rasterization per frame.  Padding only grows, so that callers
+    with different padding do not make each other rasterize again.
+
+    \note This is not thread-safe.  Call it only from the thread that updates the simulation.
+*/
+static const FluidBodyMask & GetBodyMask( const UniformGridGeometry & gridGeometry , const VECTOR< Impulsion::PhysicalObject * > & physObjs , const float padding )
+{
+    if( ! sBodyMask.IsCurrent( gridGeometry , physObjs , padding ) )
+    {   // Bodies moved, or grid changed, since previous rasterization.
+        sBodyMask.Rasterize( gridGeometry , physObjs , Max2( padding , sBodyMask.GetPadding() ) ) ;
+    }
+    return sBodyMask ;
 }
 
 #endif
@@ -526,6 +480,20 @@ void FluidBodySim::PoisonDensity( UniformGrid< float > & densityGrid , VECTOR< I
 {
     PERF_BLOCK( FluidBodySim__PoisonDensity_BoundaryWalls ) ;
 
+#if USE_FLUID_BODY_MASK
+    // Visit only gridpoints near bodies.
+    const FluidBodyMask &       bodyMask        = GetBodyMask( densityGrid , physObjs , testRadius ) ;
+    const VECTOR< unsigned > &  maskedOffsets   = bodyMask.GetMaskedOffsets() ;
+    const size_t                numMasked       = maskedOffsets.Size() ;
+    for( size_t iMasked = 0 ; iMasked < numMasked ; ++ iMasked )
+    {   // For each gridpoint near any body...
+        const unsigned & offset = maskedOffsets[ iMasked ] ;
+        if( bodyMask.GetProximity( offset ) < testRadius )
+        {   // Gridpoint is near or inside rigid body.
+            densityGrid[ offset ] = sInvalidDensity ;
+        }
+    }
+#else
     const size_t numPhysObjs = physObjs.Size() ;
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
     {   // For each body in the simulation...
@@ -583,6 +551,7 @@ void FluidBodySim::PoisonDensity( UniformGrid< float > & densityGrid , VECTOR< I
             }
         }
     }
+#endif
 }
 
 #endif
@@ -592,81 +561,112 @@ void FluidBodySim::PoisonDensity( UniformGrid< float > & densityGrid , VECTOR< I
 
 #if POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS
 
-/** Remove component of density gradient parallel to surface normals, where gridpoints are embedded inside walls.
+/** Remove component of density gradient parallel to surface normals, at the given point, if it is embedded inside walls.
+
+    \param densGrad    (in/out) Density gradient at position.
+
+    \param position    Location of density gradient.
+
+    \see PoisonDensityGradient, which applies this at every gridpoint.
 */
-void FluidBodySim::PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , VECTOR< Impulsion::PhysicalObject * > & physObjs , const float testRadius )
+void FluidBodySim::PoisonDensityGradientAtPoint( Vec3 & densGrad , const Vec3 & position , const VECTOR< Impulsion::PhysicalObject * > & physObjs , const float testRadius )
 {
-    PERF_BLOCK( FluidBodySim__PoisonDensityGradient_BoundaryWalls ) ;
-
     const Vec3 zero( 0.0f , 0.0f , 0.0f ) ;
 
     const size_t numPhysObjs = physObjs.Size() ;
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
     {   // For each body...
-        Impulsion::PhysicalObject &     physObj         = * physObjs[ idxPhysObj ] ;
-        const Vec3 &                    physObjPosition = physObj.GetBody()->GetPosition() ;
-        const Collision::ShapeBase *    collisionShape  = physObj.GetCollisionShape() ;
-        const float &                   boundingRadius  = collisionShape->GetBoundingSphereRadius() ;
-        const Impulsion::RigidBody *    rigidBody       = physObj.GetBody() ;
+        const Impulsion::PhysicalObject &   physObj         = * physObjs[ idxPhysObj ] ;
+        const Vec3 &                        physObjPosition = physObj.GetBody()->GetPosition() ;
+        const Collision::ShapeBase *        collisionShape  = physObj.GetCollisionShape() ;
+        const float &                       boundingRadius  = collisionShape->GetBoundingSphereRadius() ;
+        const Impulsion::RigidBody *        rigidBody       = physObj.GetBody() ;
 
-        const unsigned densityGradientGridCapacity = densityGradientGrid.GetGridCapacity() ;
-        for( unsigned offset = 0 ; offset < densityGradientGridCapacity ; ++ offset )
-        {   // For each point in grid...
-            Vec3 gridPointPosition ;
-            densityGradientGrid.PositionFromOffset( gridPointPosition , offset ) ;
-            // Test whether gridpoint is near or inside rigid body.
-            // If so, set gradient to zero there.
-            Vec3 & densGrad = densityGradientGrid[ offset ] ;
+        // Test whether point is near or inside rigid body.
+        // If so, set gradient to zero there.
+        const Vec3  vSphereToGridPoint = position - physObjPosition ;   // vector from sphere center to point
+        const float fSphereToGridPoint = vSphereToGridPoint.Magnitude() ;
 
-            const Vec3  vSphereToGridPoint = gridPointPosition - physObjPosition ;   // vector from sphere center to gridpoint
-            const float fSphereToGridPoint = vSphereToGridPoint.Magnitude() ;
+        bool        broadPhaseCollision ;
 
-            bool        broadPhaseCollision ;
+        if( collisionShape->IsHole() )
+        {
+            const float combinedRadii  = Max2( boundingRadius - testRadius , 0.0f ) ;
+            broadPhaseCollision = fSphereToGridPoint > combinedRadii ;
+        }
+        else
+        {
+            const float combinedRadii  = boundingRadius + testRadius ;
+            broadPhaseCollision = fSphereToGridPoint < combinedRadii ;
+        }
 
-            if( collisionShape->IsHole() )
-            {
-                const float combinedRadii  = Max2( boundingRadius - testRadius , 0.0f ) ;
-                broadPhaseCollision = fSphereToGridPoint > combinedRadii ;
-            }
-            else
-            {
-                const float combinedRadii  = boundingRadius + testRadius ;
-                broadPhaseCollision = fSphereToGridPoint < combinedRadii ;
+        if( broadPhaseCollision )
+        {   // Point is inside padded bounding sphere of rigid body.
+            Vec3    contactNormal   ;
+            if( physObj.GetCollisionShape()->GetShapeType() == Collision::SphereShape::sShapeType )
+            {   // Rigid body is a sphere, and point is near or inside it.
+                densGrad = zero ;
+                contactNormal       = vSphereToGridPoint.GetDir() ;
+                const float densGradAlongNormalMag  = densGrad * contactNormal ;
+                const Vec3  densGradAlongNormal     = densGradAlongNormalMag * contactNormal ;
+                densGrad -= densGradAlongNormal ;
             }
+            else if( physObj.GetCollisionShape()->GetShapeType() == Collision::ConvexPolytope::sShapeType )
+            {   // Rigid body is a polytope.
+                // Test for collision with padded collision volume.
+                const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope * >( collisionShape ) ;
+                const Mat33 &                       physObjOrientation  = rigidBody->GetOrientation() ;
+                unsigned                            idxPlane ;
+                const float                         contactDistance     = convexPolytope->ContactDistance( position , physObjPosition , physObjOrientation , idxPlane ) ;
 
-            if( broadPhaseCollision )
-            {   // Gridpoint is inside padded bounding sphere of rigid body.
-                Vec3    contactNormal   ;
-                if( physObj.GetCollisionShape()->GetShapeType() == Collision::SphereShape::sShapeType )
-                {   // Rigid body is a sphere, and gridpoint is near or inside it.
-                    densGrad = zero ;
-                    contactNormal       = vSphereToGridPoint.GetDir() ;
+                if( contactDistance < testRadius )
+                {   // Point is in contact with padded region of rigid body.
+                    // Zero out any gradients along contact normal.
+                    const Vec3  vContactPtWorld         = convexPolytope->ContactPoint( position , physObjOrientation , idxPlane , contactDistance , contactNormal ) ;
                     const float densGradAlongNormalMag  = densGrad * contactNormal ;
                     const Vec3  densGradAlongNormal     = densGradAlongNormalMag * contactNormal ;
                     densGrad -= densGradAlongNormal ;
                 }
-                else if( physObj.GetCollisionShape()->GetShapeType() == Collision::ConvexPolytope::sShapeType )
-                {   // Rigid body is a polytope.
-                    // Test for collision with padded collision volume.
-                    const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope * >( collisionShape ) ;
-                    const Mat33 &                       physObjOrientation  = rigidBody->GetOrientation() ;
-                    unsigned                            idxPlane ;
-                    const float                         contactDistance     = convexPolytope->ContactDistance( gridPointPosition , physObjPosition , physObjOrientation , idxPlane ) ;
-
-                    if( contactDistance < testRadius )
-                    {   // Gridpoint is in contact with padded region of rigid body.
-                        // Zero out any gradients along contact normal.
-                        const Vec3  vContactPtWorld         = convexPolytope->ContactPoint( gridPointPosition , physObjOrientation , idxPlane , contactDistance , contactNormal ) ;
-                        const float densGradAlongNormalMag  = densGrad * contactNormal ;
-                        const Vec3  densGradAlongNormal     = densGradAlongNormalMag * contactNormal ;
-                        densGrad -= densGradAlongNormal ;
-                    }
-                }
             }
         }
     }
 }
 
+
+
+
+/** Remove component of density gradient parallel to surface normals, where gridpoints are embedded inside walls.
+*/
+void FluidBodySim::PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , VECTOR< Impulsion::PhysicalObject * > & physObjs , const float testRadius )
+{
+    PERF_BLOCK( FluidBodySim__PoisonDensityGradient_BoundaryWalls ) ;
+
+#if USE_FLUID_BODY_MASK
+    // Visit only gridpoints near bodies.
+    const FluidBodyMask &       bodyMask        = GetBodyMask( densityGradientGrid , physObjs , testRadius ) ;
+    const VECTOR< unsigned > &  maskedOffsets   = bodyMask.GetMaskedOffsets() ;
+    const size_t                numMasked       = maskedOffsets.Size() ;
+    for( size_t iMasked = 0 ; iMasked < numMasked ; ++ iMasked )
+    {   // For each gridpoint near any body...
+        const unsigned & offset = maskedOffsets[ iMasked ] ;
+        if( bodyMask.GetProximity( offset ) < testRadius )
+        {   // Gridpoint is near or inside rigid body.
+            Vec3 gridPointPosition ;
+            densityGradientGrid.PositionFromOffset( gridPointPosition , offset ) ;
+            PoisonDensityGradientAtPoint( densityGradientGrid[ offset ] , gridPointPosition , physObjs , testRadius ) ;
+        }
+    }
+#else
+    const unsigned densityGradientGridCapacity = densityGradientGrid.GetGridCapacity() ;
+    for( unsigned offset = 0 ; offset < densityGradientGridCapacity ; ++ offset )
+    {   // For each point in grid...
+        Vec3 gridPointPosition ;
+        densityGradientGrid.PositionFromOffset( gridPointPosition , offset ) ;
+        PoisonDensityGradientAtPoint( densityGradientGrid[ offset ] , gridPointPosition , physObjs , testRadius ) ;
+    }
+#endif
+}
+
 #endif
 
 
@@ -682,6 +682,20 @@ void FluidBodySim::PoisonPressure( UniformGrid< float > & pressureGrid , VECTOR<
 {
     PERF_BLOCK( FluidBodySim__PoisonPressure_BoundaryWalls ) ;
 
+#if USE_FLUID_BODY_MASK
+    // Visit only gridpoints near bodies.
+    const FluidBodyMask &       bodyMask        = GetBodyMask( pressureGrid , physObjs , testRadius ) ;
+    const VECTOR< unsigned > &  maskedOffsets   = bodyMask.GetMaskedOffsets() ;
+    const size_t                numMasked       = maskedOffsets.Size() ;
+    for( size_t iMasked = 0 ; iMasked < numMasked ; ++ iMasked )
+    {   // For each gridpoint near any body...
+        const unsigned & offset = maskedOffsets[ iMasked ] ;
+        if( bodyMask.GetProximity( offset ) < testRadius )
+        {   // Gridpoint is near or inside rigid body.
+            pressureGrid[ offset ] = 0.0f ;
+        }
+    }
+#else
     const size_t numPhysObjs = physObjs.Size() ;
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
     {   // For each body...
@@ -739,6 +753,7 @@ void FluidBodySim::PoisonPressure( UniformGrid< float > & pressureGrid , VECTOR<
             }
         }
     }
+#endif
 }
 
 #endif
@@ -754,9 +769,11 @@ void FluidBodySim::PoisonPressure( UniformGrid< float > & pressureGrid , VECTOR<
     \param iPclEnd - one past ending index of vortex particle to process.
         iPclStart must be less than or equal to the total number of vortex particles.
 
+    \param tally - (in/out) Impulse and heat to apply to body, to which this adds those of the given vortons.
+
     \see SolveBoundaryConditions
 */
-void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody , float & rHeatToBody , float & rSumPclTemperature , size_t & rNumPclsCollided , size_t iPclStart , size_t iPclEnd )
+void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , size_t iPclStart , size_t iPclEnd , VortonCollisionTally & tally )
 {
     const Collision::ShapeBase *    collisionShape  = physObj.GetCollisionShape() ;
     const Impulsion::RigidBody *    rigidBody       = physObj.GetBody() ;
@@ -767,17 +784,23 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
     static const float              fatten          = 1.0f + FLT_EPSILON ;  // Compensate for truncation/roundoff errors in broad phase collision detection.
     static const float              nudge           = 1.0f + 1.0e-4f ;      // Compensate for truncation/roundoff errors in collision response.
 
-    rLinearImpulseOnBody    = Vec3( 0.0f , 0.0f , 0.0f ) ;
-    rAngularImpulseOnBody   = Vec3( 0.0f , 0.0f , 0.0f ) ;
-    rHeatToBody             = 0.0f ;
-    rSumPclTemperature      = 0.0f ;
-    rNumPclsCollided        = 0 ;
+    Vec3 &                          rLinearImpulseOnBody    = tally.mLinearImpulseOnBody    ;
+    Vec3 &                          rAngularImpulseOnBody   = tally.mAngularImpulseOnBody   ;
+    float &                         rHeatToBody             = tally.mHeatToBody             ;
+    float &                         rSumPclTemperature      = tally.mSumPclTemperature      ;
+    size_t &                        rNumPclsCollided        = tally.mNumPclsCollided        ;
 
     const float oneOverFluidSpecificHeatCapacity = 1.0f / fluidSpecificHeatCapacity ;
 
     size_t vortonIncrement  = 1 ;   // Controls whether to repeat processing same particle.
     size_t repeatCount      = 0 ;   // Number of iterations spent on same particle.
 
+#if USE_BATCH_POLYTOPE_COLLISION
+    Collision::ConvexPolytope::ContactS batchContacts[ sPolytopeCollisionBatchSize ] ;  // Contacts for particles in [iBatchBegin,iBatchEnd).
+    size_t                              iBatchBegin = iPclStart ;
+    size_t                              iBatchEnd   = iPclStart ;
+#endif
+
 #if COUNT_NUM_OUTSIDE_BOUNDS
     DEBUG_ONLY( sPclRad = particles[ 0 ].GetRadius() * ( 1.0f - 1.0e-3f ) ) ;
 #endif
@@ -853,7 +876,26 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
                 const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope * >( collisionShape ) ;
                 const Mat33 &                       physObjOrientation  = rigidBody->GetOrientation() ;
                 unsigned                            idxPlane ;
-                contactDistance = convexPolytope->ContactDistance( rVorton.mPosition , physObjPosition , physObjOrientation , idxPlane ) ;
+            #if USE_BATCH_POLYTOPE_COLLISION
+                if( 0 == repeatCount )
+                {   // Vorton has not moved since the batch query, so use its result.
+                    if( uVorton >= iBatchEnd )
+                    {   // Vorton lies beyond current batch.
+                        // Query a batch starting at this vorton.  Vortons up to this one
+                        // move during collision response but later ones do not, so results stay valid.
+                        iBatchBegin = uVorton ;
+                        iBatchEnd   = Min2( uVorton + sPolytopeCollisionBatchSize , iPclEnd ) ;
+                        convexPolytope->ContactDistanceMany( & particles[ iBatchBegin ].mPosition , sizeof( Particle ) , iBatchEnd - iBatchBegin , physObjPosition , physObjOrientation , batchContacts ) ;
+                    }
+                    const Collision::ConvexPolytope::ContactS & contact = batchContacts[ uVorton - iBatchBegin ] ;
+                    contactDistance = contact.mDistance ;
+                    idxPlane        = contact.mIdxPlane ;
+                }
+                else
+            #endif
+                {   // Query this vorton alone, since hole collision might have moved it since the batch query.
+                    contactDistance = convexPolytope->ContactDistance( rVorton.mPosition , physObjPosition , physObjOrientation , idxPlane ) ;
+                }
 
                 if( contactDistance < fBoundaryThickness )
                 {   // Vorton is within boundary layer of rigid body.
@@ -1079,8 +1121,9 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
 //#error Those particles which are accelerated downward near walls in principle should have a vorticity but it's not the case.
 //#error WARNING I'm too tired to make sense while writing this. Suspect!
 
+            // BoundaryPanels imposes no-slip on solid bodies, so only holes assign vorticity by penalty.
             static bool bApplyTorqueOnVorton = true ;
-            if( bApplyTorqueOnVorton )
+            if( bApplyTorqueOnVorton && ( collisionShape->IsHole() || ! ENABLE_BOUNDARY_PANELS ) )
             {
                 // Velocity there should end up zero after repeatedly bouncing pcl.
                 if( repeatCount >= 1 )
@@ -1230,61 +1273,6 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
 
 
 
-#if USE_TBB
-/** Collide body with vortex fluid particles using a deterministic, multi-threaded, recursive algorithm.
-
-    \param particles    Vortex particles whose vorticity and position to change
-                        in order to satisfy boundary conditions.
-
-    \param ambientFluidDensity  Fluid density in the absence of fluid particles.
-
-    \param fluidSpecificHeatCapacity Heat per mass fluid can store.
-
-    \param physObj Physical object with which to collide fluid.
-
-    \param rLinearImpulseOnBody (out) Linear impulse to apply to body.
-
-    \param rAngularImpulseOnBody (out) Angular impulse to apply to body.
-
-    \param rHeatOnBody (out) Heat transfer to body.
-
-    \param iPclStart Starting index of particle to process.
-        iPclStart must be less than the total number of particles.
-
-    \param iPclEnd One past ending index of particle to process.
-        iPclStart must be less than or equal to the total number of particles.
-
-    \param grainSize Number of particles to process per thread.
-
-*/
-/* static */ void FluidBodySim::CollideVortonsReduce( VECTOR< Particle > & particles , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody , float & rHeatOnBody , float & rSumPclTemperature , size_t & rNumPclsCollided , size_t iPclStart , size_t iPclEnd , size_t grainSize )
-{
-    const size_t indexSpan = iPclEnd - iPclStart ;
-    if( indexSpan <= grainSize )
-    {   // Sub-problem fits into a single serial chunk.
-        CollideVortonsSlice( particles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj , rLinearImpulseOnBody , rAngularImpulseOnBody , rHeatOnBody , rSumPclTemperature , rNumPclsCollided , iPclStart , iPclEnd ) ;
-    }
-    else
-    {   // Problem remains large enough to split into pieces.
-        size_t  iPclMiddle = iPclStart + indexSpan / 2 ;
-        // Create one functor for each sub-problem.
-        FluidBodySim_CollideVortons_TBB cv1( particles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj , iPclStart  , iPclMiddle , grainSize ) ;
-        FluidBodySim_CollideVortons_TBB cv2( particles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj , iPclMiddle , iPclEnd    , grainSize ) ;
-        // Invoke both sub-problems, each on a separate thread.
-        tbb::parallel_invoke( cv1 , cv2 ) ;
-        // Combine results from each thread.
-        rLinearImpulseOnBody    = cv1.mLinearImpulseOnBody  + cv2.mLinearImpulseOnBody  ;
-        rAngularImpulseOnBody   = cv1.mAngularImpulseOnBody + cv2.mAngularImpulseOnBody ;
-        rHeatOnBody             = cv1.mHeatToBody           + cv2.mHeatToBody           ;
-        rSumPclTemperature      = cv1.mSumPclTemperature    + cv2.mSumPclTemperature    ;
-        rNumPclsCollided        = cv1.mNumPclsCollided      + cv2.mNumPclsCollided      ;
-    }
-}
-#endif
-
-
-
-
 /** Collide tracer particles with rigid bodies.
 
     \param rSphere - reference to a spherical rigid body
@@ -1295,9 +1283,11 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
     \param iPclEnd - one past ending index of tracer particle to process.
         iPclStart must be less than or equal to the total number of tracer particles.
 
+    \param tally - (in/out) Impulse to apply to body, to which this adds that of the given tracers.
+
     \see SolveBoundaryConditions
 */
-/* static */ void FluidBodySim::CollideTracersSlice( VECTOR< Particle > & particles , const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody , const size_t iPclStart , const size_t iPclEnd )
+/* static */ void FluidBodySim::CollideTracersSlice( VECTOR< Particle > & particles , const Impulsion::PhysicalObject & physObj , const size_t iPclStart , const size_t iPclEnd , TracerCollisionTally & tally )
 {
     Vec3                            linearImpulseOnBody ( 0.0f , 0.0f , 0.0f ) ; // Linear  impulse particles apply to rigid body.
     Vec3                            angularImpulseOnBody( 0.0f , 0.0f , 0.0f ) ; // Angular impulse particles apply to rigid body.
@@ -1313,8 +1303,6 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
 
 	if( particles.empty() )
 	{
-		rLinearImpulseOnBody  = linearImpulseOnBody  ;
-		rAngularImpulseOnBody = angularImpulseOnBody ;
 		return ;
 	}
 
@@ -1323,6 +1311,12 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
 
     Particle * pTracers = & particles[ 0 ] ;
 
+#if USE_BATCH_POLYTOPE_COLLISION
+    Collision::ConvexPolytope::ContactS batchContacts[ sPolytopeCollisionBatchSize ] ;  // Contacts for tracers in [iBatchBegin,iBatchEnd).
+    size_t                              iBatchBegin = iPclStart ;
+    size_t                              iBatchEnd   = iPclStart ;
+#endif
+
 #if COUNT_NUM_OUTSIDE_BOUNDS
     DEBUG_ONLY( sPclRad = pTracers[ 0 ].GetRadius() * ( 1.0f - 1.0e-3f ) ) ;
 #endif
@@ -1385,7 +1379,27 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
                 const Collision::ConvexPolytope *   convexPolytope      = static_cast< const Collision::ConvexPolytope *  >( collisionShape ) ;
                 const Mat33 &                       physObjOrientation  = rigidBody->GetOrientation() ;
                 unsigned                            idxPlane ;
-                const float                         contactDistance     = convexPolytope->CollisionDistance( rTracer.mPosition , rTracer.mVelocity , physObjPosition , physObjOrientation , physObjVelocity , idxPlane ) ;
+                float                               contactDistance     ;
+            #if USE_BATCH_POLYTOPE_COLLISION
+                if( 0 == repeatCount )
+                {   // Tracer has not moved since the batch query, so use its result.
+                    if( uTracer >= iBatchEnd )
+                    {   // Tracer lies beyond current batch.
+                        // Query a batch starting at this tracer.  Tracers up to this one
+                        // move during collision response but later ones do not, so results stay valid.
+                        iBatchBegin = uTracer ;
+                        iBatchEnd   = Min2( uTracer + sPolytopeCollisionBatchSize , iPclEnd ) ;
+                        convexPolytope->CollisionDistanceMany( & pTracers[ iBatchBegin ].mPosition , & pTracers[ iBatchBegin ].mVelocity , sizeof( Particle ) , iBatchEnd - iBatchBegin , physObjPosition , physObjOrientation , physObjVelocity , batchContacts ) ;
+                    }
+                    const Collision::ConvexPolytope::ContactS & contact = batchContacts[ uTracer - iBatchBegin ] ;
+                    contactDistance = contact.mDistance ;
+                    idxPlane        = contact.mIdxPlane ;
+                }
+                else
+            #endif
+                {   // Query this tracer alone, since hole collision might have moved it since the batch query.
+                    contactDistance = convexPolytope->CollisionDistance( rTracer.mPosition , rTracer.mVelocity , physObjPosition , physObjOrientation , physObjVelocity , idxPlane ) ;
+                }
 
                 if( contactDistance < rTracer.GetRadius() )
                 {   // Tracer contacts rigid body.
@@ -1466,39 +1480,9 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
             rTracer.mVelocity = vVelNew ;   // If same tracer is involved in another contact before advection, this will conserve momentum.
         }
     }
-    rLinearImpulseOnBody  = linearImpulseOnBody  ;
-    rAngularImpulseOnBody = angularImpulseOnBody ;
-}
-
-
-
-
-#if USE_TBB
-/** Collide body with fluid particles using a deterministic, multi-threaded, recursive algorithm.
-
-    \return Impulse to apply to body.
-*/
-/* static */ void FluidBodySim::CollideTracersReduce( VECTOR< Particle > & particles , const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody , const size_t iPclStart , const size_t iPclEnd , const size_t grainSize )
-{
-    const size_t indexSpan = iPclEnd - iPclStart ;
-    if( indexSpan <= grainSize )
-    {   // Sub-problem fits into a single serial chunk.
-        CollideTracersSlice( particles , physObj , rLinearImpulseOnBody , rAngularImpulseOnBody , iPclStart , iPclEnd ) ;
-    }
-    else
-    {   // Problem remains large enough to split into pieces.
-        size_t iPclMiddle = iPclStart + indexSpan / 2 ;
-        // Create one functor for each sub-problem.
-        FluidBodySim_CollideTracers_TBB ct1( particles , physObj , iPclStart  , iPclMiddle , grainSize ) ;
-        FluidBodySim_CollideTracers_TBB ct2( particles , physObj , iPclMiddle , iPclEnd    , grainSize ) ;
-        // Invoke both sub-problems, each on a separate thread.
-        tbb::parallel_invoke( ct1 , ct2 ) ;
-        // Combine results from each thread: the total impulse due to the particles processed by each thread.
-        rLinearImpulseOnBody  = ct1.mLinearImpulseOnBody  + ct2.mLinearImpulseOnBody  ;
-        rAngularImpulseOnBody = ct1.mAngularImpulseOnBody + ct2.mAngularImpulseOnBody ;
-    }
+    tally.mLinearImpulseOnBody  += linearImpulseOnBody  ;
+    tally.mAngularImpulseOnBody += angularImpulseOnBody ;
 }
-#endif
 
 
 
@@ -1524,9 +1508,34 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
     static const size_t numQueryPositions        = 5 ;
     static const float  oneOverNumQueryPositions = 1.0f / float( numQueryPositions ) ;
 
+#if USE_FLUID_BODY_MASK
+    const FluidBodyMask & bodyMask = GetBodyMask( densityGrid , physicalObjects , 0.0f ) ;
+#endif
+
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
     {   // For each body in the simulation...
         Impulsion::PhysicalObject &  physObj = * physicalObjects[ idxPhysObj ] ;
+
+    #if USE_FLUID_BODY_MASK
+        const size_t numInteriorPoints = bodyMask.GetNumInteriorPoints( idxPhysObj ) ;
+        if( ! physObj.GetCollisionShape()->IsHole() && ( numInteriorPoints >= numQueryPositions ) )
+        {   // Body covers enough gridpoints to average fluid density over its interior.
+            const unsigned * interiorOffsets = bodyMask.GetInteriorOffsets( idxPhysObj ) ;
+            float densitySum = 0.0f ;
+            for( size_t iInterior = 0 ; iInterior < numInteriorPoints ; ++ iInterior )
+            {   // For each gridpoint inside body...
+                densitySum += densityGrid[ interiorOffsets[ iInterior ] ] ;
+            }
+            const float densityAverage  = densitySum / float( numInteriorPoints ) ;
+            const float massDisplaced   = densityAverage * physObj.GetVolume() ;
+            const float bodyMass        = physObj.GetBody()->GetMass() ;
+            const Vec3  netForce        = gravityAcceleration * ( bodyMass - massDisplaced ) ;
+            physObj.GetBody()->ApplyBodyForce( netForce ) ;
+            continue ;
+        }
+        // Otherwise body is too small to cover enough gridpoints, so sample fluid density at a few places instead.
+    #endif
+
         // Compute profile of fluid density around body
         float densityAtQueryPoint               ; // Fluid density at query points.
         float densitySum                = 0.0f  ; // Average fluid density at query points.
@@ -1572,6 +1581,44 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
 
 
 
+#if USE_FLUID_BODY_BROADPHASE
+
+/** Copy the particles at the given indices into a contiguous array.
+
+    \see ScatterParticles
+*/
+static void GatherParticles( VECTOR< Particle > & candidates , const VECTOR< Particle > & particles , const VECTOR< unsigned > & candidateIndices )
+{
+    const size_t numCandidates = candidateIndices.Size() ;
+    candidates.Resize( numCandidates ) ;
+    for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+    {   // For each candidate...
+        candidates[ iCandidate ] = particles[ candidateIndices[ iCandidate ] ] ;
+    }
+}
+
+
+
+
+/** Copy particles from a contiguous array back to the indices they came from.
+
+    \see GatherParticles
+*/
+static void ScatterParticles( VECTOR< Particle > & particles , const VECTOR< Particle > & candidates , const VECTOR< unsigned > & candidateIndices )
+{
+    const size_t numCandidates = candidateIndices.Size() ;
+    ASSERT( candidates.Size() == numCandidates ) ;
+    for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+    {   // For each candidate...
+        particles[ candidateIndices[ iCandidate ] ] = candidates[ iCandidate ] ;
+    }
+}
+
+#endif
+
+
+
+
 /** Collide particles with rigid bodies.
 
     \param particles Dynamic array of particles.
@@ -1660,7 +1707,22 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
 #endif
 
     const size_t    numPhysObjs     = physicalObjects.Size() ;
-    const size_t    numParticles    = particles.Size() ;
+
+    VECTOR< unsigned >  candidateIndices    ;   // Indices of particles near the current body.
+    VECTOR< Particle >  candidates          ;   // Copies of particles near the current body.
+#if USE_FLUID_BODY_BROADPHASE
+    // Partition particles once, up front.  Collision response moves particles
+    // only to just outside the body they hit, so that partition remains
+    // adequate for the remaining bodies.  GatherCandidates tests current
+    // positions, so the worst case is that a particle pushed out of one body,
+    // across cells, into another, escapes the latter until the next step.
+    const float         minReach            = FluidBodyBroadphase::ComputeMinReach( physicalObjects , 0.0f ) ;
+    FluidBodyBroadphase broadphase          ;
+    if( minReach < FLT_MAX )
+    {   // Some bodies are cullable.
+        broadphase.Partition( particles , minReach ) ;
+    }
+#endif
 
     for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
     {   // For each body in the simulation...
@@ -1668,32 +1730,40 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
         Vec3 vLinearImpulseOnBody  ; // Linear  impulse applied by particles to rigid body.
         Vec3 vAngularImpulseOnBody ; // Angular impulse applied by particles to rigid body.
 
+    #if USE_FLUID_BODY_BROADPHASE
+        const bool cull = FluidBodyBroadphase::IsCullable( physObj ) ;
+        if( cull )
+        {   // Collide only particles near this body.
+            // Pad bounding sphere by at least the boundary thickness CollideVortonsSlice uses (1.5 radii) and the radius CollideTracersSlice uses.
+            const float reach = physObj.GetCollisionShape()->GetBoundingSphereRadius() + 2.0f * broadphase.GetMaxParticleRadius() ;
+            broadphase.GatherCandidates( candidateIndices , particles , physObj.GetBody()->GetPosition() , reach ) ;
+            if( candidateIndices.Empty() )
+            {   // No particles near this body.
+                continue ;
+            }
+            // Copy candidates into a contiguous array, so the collision routines can process them like any other particles.
+            GatherParticles( candidates , particles , candidateIndices ) ;
+        }
+    #else
+        const bool cull = false ;
+    #endif
+        VECTOR< Particle > &    bodyParticles       = cull ? candidates : particles ;  // Particles to collide with this body.
+        const size_t            numParticles        = bodyParticles.Size() ;
+
         if( bRespectAngularVelocity )
         {   // Treat particles as vortons.
             PERF_BLOCK( FluidBodySim__SolveBoundaryConditions_Vortons ) ;
 
-            float  heatToBody        = 0.0f ;
-            float  sumPclTemperature = 0.0f ;
-            size_t numPclsCollided   = 0 ;
-
-#   if USE_TBB
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize = Max2( size_t( 1 ) , numParticles / gNumberOfProcessors ) ;
-            // Compute tracer-body collisions using multiple threads.
-#       if 1
-            CollideVortonsReduce( particles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj , vLinearImpulseOnBody , vAngularImpulseOnBody , heatToBody , sumPclTemperature , numPclsCollided , 0 , numParticles , grainSize ) ;
-#       else // For comparison.  This is not deterministic (but works otherwise).
-            FluidBodySim_CollideVortons_TBB cv( particles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj ) ;
-            parallel_reduce( tbb::blocked_range<size_t>( 0 , numParticles , grainSize ) , cv ) ;
-            vLinearImpulseOnBody    = cv.mLinearImpulseOnBody   ;
-            vAngularImpulseOnBody   = cv.mAngularImpulseOnBody  ;
-            heatToBody              = cv.mHeatToBody            ;
-            sumPclTemperature       = cv.mSumPclTemperature     ;
-            numPclsCollided         = cv.numPclsCollided        ;
-#       endif
-#   else
-            CollideVortonsSlice( particles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj , vLinearImpulseOnBody , vAngularImpulseOnBody , heatToBody , sumPclTemperature , numPclsCollided , 0 , numParticles ) ;
-#   endif
+            // Estimate grain size based on size of problem and, unless PARALLEL_DETERMINISTIC, number of processors.
+            const size_t grainSize = Parallel::GetReductionGrainSize( numParticles ) ;
+            // Compute vorton-body collisions using multiple threads.
+            VortonCollisionTally tally ;
+            Parallel::Reduce( 0 , numParticles , grainSize , Parallel::Reduction< Parallel::MergeResults >( tally , VortonCollisionTally() , CollideVortonsSlice , bodyParticles , ambientFluidDensity , fluidSpecificHeatCapacity , physObj ) ) ;
+            vLinearImpulseOnBody  = tally.mLinearImpulseOnBody  ;
+            vAngularImpulseOnBody = tally.mAngularImpulseOnBody ;
+            const float  heatToBody        = tally.mHeatToBody        ;
+            const float  sumPclTemperature = tally.mSumPclTemperature ;
+            const size_t numPclsCollided   = tally.mNumPclsCollided   ;
 
             // Skip applying linear impulse because it is redundant with doing so for tracers, and tracers yield finer spatial resolution.
             //physObj.GetBody()->ApplyImpulse( vLinearImpulseOnBody ) ; // Apply linear impulse from vortons to rigid body
@@ -1717,18 +1787,24 @@ void FluidBodySim::CollideVortonsSlice( VECTOR< Particle > & particles , float a
         {   // Treat particles as non-rotating
             PERF_BLOCK( FluidBodySim__SolveBoundaryConditions_Tracers ) ;
 
-#       if USE_TBB
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize = Max2( size_t( 1 ) , numParticles / gNumberOfProcessors ) ;
+            // Estimate grain size based on size of problem and, unless PARALLEL_DETERMINISTIC, number of processors.
+            const size_t grainSize = Parallel::GetReductionGrainSize( numParticles ) ;
             // Compute tracer-body collisions using multiple threads.
-            CollideTracersReduce( particles , physObj , vLinearImpulseOnBody , vAngularImpulseOnBody , 0 , numParticles , grainSize ) ;
-#       else
-            CollideTracersSlice( particles , physObj , vLinearImpulseOnBody , vAngularImpulseOnBody , 0 , numParticles ) ;
-#       endif
+            TracerCollisionTally tally ;
+            Parallel::Reduce( 0 , numParticles , grainSize , Parallel::Reduction< Parallel::MergeResults >( tally , TracerCollisionTally() , CollideTracersSlice , bodyParticles , physObj ) ) ;
+            vLinearImpulseOnBody  = tally.mLinearImpulseOnBody  ;
+            vAngularImpulseOnBody = tally.mAngularImpulseOnBody ;
 
             physObj.GetBody()->ApplyImpulse( vLinearImpulseOnBody ) ; // Apply linear impulse from tracers to rigid body.
             physObj.GetBody()->ApplyImpulsiveTorque( vAngularImpulseOnBody ) ; // Apply angular impulse from tracers to rigid body.
         }
+
+    #if USE_FLUID_BODY_BROADPHASE
+        if( cull )
+        {   // Copy collided candidates back to their original slots.
+            ScatterParticles( particles , candidates , candidateIndices ) ;
+        }
+    #endif
     }
 
 #   if defined( _DEBUG )
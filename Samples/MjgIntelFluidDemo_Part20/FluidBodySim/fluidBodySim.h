@@ -27,6 +27,12 @@
 
 #define COMPUTE_PARTICLE_PROXIMITY_TO_WALLS 1
 
+/** Whether ComputeParticleProximityToWalls interpolates proximity from a distance field baked onto a grid.
+
+    Otherwise, it tests each particle near each body against the body shape.
+*/
+#define COMPUTE_PARTICLE_PROXIMITY_FROM_DISTANCE_FIELD 1
+
 // Types --------------------------------------------------------------
 
 namespace Impulsion
@@ -56,6 +62,7 @@ class FluidBodySim
 
     #if POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS
         static void PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , VECTOR< Impulsion::PhysicalObject * > & physicalObjects , const float testRadius ) ;
+        static void PoisonDensityGradientAtPoint( Vec3 & densityGradient , const Vec3 & position , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , const float testRadius ) ;
     #endif
 
     #if COMPUTE_PRESSURE_GRADIENT
@@ -71,15 +78,46 @@ class FluidBodySim
         FluidBodySim( const FluidBodySim & ) ;             // Disallow copy construction
         FluidBodySim & operator=( const FluidBodySim & ) ; // Disallow assignment
 
-        static void CollideVortonsSlice ( VECTOR< Particle > & particles , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody , float & rHeatToBody , float & rSumPclTemperature , size_t & rNumPclsCollided , size_t iPclStart , size_t iPclEnd ) ;
-        static void CollideVortonsReduce( VECTOR< Particle > & particles , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody , float & rHeatToBody , float & rSumPclTemperature , size_t & rNumPclsCollided , size_t iPclStart , size_t iPclEnd , size_t grainSize ) ;
-        static void CollideTracersSlice ( VECTOR< Particle > & particles ,                                                               const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody ,                                                                                size_t iPclStart , size_t iPclEnd ) ;
-        static void CollideTracersReduce( VECTOR< Particle > & particles ,                                                               const Impulsion::PhysicalObject & physObj , Vec3 & rLinearImpulseOnBody , Vec3 & rAngularImpulseOnBody ,                                                                                size_t iPclStart , size_t iPclEnd , size_t grainSize ) ;
-
-    #if USE_TBB
-        friend class FluidBodySim_CollideVortons_TBB ;
-        friend class FluidBodySim_CollideTracers_TBB ;
-    #endif
+        /// Impulse and heat that vortons apply to a rigid body, accumulated by CollideVortonsSlice.
+        struct VortonCollisionTally
+        {
+            VortonCollisionTally() : mLinearImpulseOnBody( 0.0f , 0.0f , 0.0f ) , mAngularImpulseOnBody( 0.0f , 0.0f , 0.0f ) , mHeatToBody( 0.0f ) , mSumPclTemperature( 0.0f ) , mNumPclsCollided( 0 ) {}
+
+            /// Include another tally, e.g. from another thread, in this tally.
+            void Merge( const VortonCollisionTally & that )
+            {
+                mLinearImpulseOnBody    += that.mLinearImpulseOnBody    ;
+                mAngularImpulseOnBody   += that.mAngularImpulseOnBody   ;
+                mHeatToBody             += that.mHeatToBody             ;
+                mSumPclTemperature      += that.mSumPclTemperature      ;
+                mNumPclsCollided        += that.mNumPclsCollided        ;
+            }
+
+            Vec3    mLinearImpulseOnBody    ;   ///< Linear impulse applied by vortons to rigid body.
+            Vec3    mAngularImpulseOnBody   ;   ///< Angular impulse applied by vortons to rigid body.
+            float   mHeatToBody             ;   ///< Heat applied by vortons to rigid body.
+            float   mSumPclTemperature      ;   ///< Sum of temperatures of particles that collided with rigid body.
+            size_t  mNumPclsCollided        ;   ///< Number of particles that collided with rigid body.
+        } ;
+
+        /// Impulse that tracers apply to a rigid body, accumulated by CollideTracersSlice.
+        struct TracerCollisionTally
+        {
+            TracerCollisionTally() : mLinearImpulseOnBody( 0.0f , 0.0f , 0.0f ) , mAngularImpulseOnBody( 0.0f , 0.0f , 0.0f ) {}
+
+            /// Include another tally, e.g. from another thread, in this tally.
+            void Merge( const TracerCollisionTally & that )
+            {
+                mLinearImpulseOnBody    += that.mLinearImpulseOnBody    ;
+                mAngularImpulseOnBody   += that.mAngularImpulseOnBody   ;
+            }
+
+            Vec3    mLinearImpulseOnBody    ;   ///< Linear impulse applied by tracers to rigid body.
+            Vec3    mAngularImpulseOnBody   ;   ///< Angular impulse applied by tracers to rigid body.
+        } ;
+
+        static void CollideVortonsSlice( VECTOR< Particle > & particles , float ambientFluidDensity , float fluidSpecificHeatCapacity , const Impulsion::PhysicalObject & physObj , size_t iPclStart , size_t iPclEnd , VortonCollisionTally & tally ) ;
+        static void CollideTracersSlice( VECTOR< Particle > & particles , const Impulsion::PhysicalObject & physObj , size_t iPclStart , size_t iPclEnd , TracerCollisionTally & tally ) ;
 } ;
 
 // Public variables --------------------------------------------------------------
@@ -13,12 +13,13 @@
 
 #include "fluidBodySim.h"
 
+#include "Core/parallelExecution.h"
+
 
 /* static */ void FluidBodySim::UnitTest( void )
 {
-#if USE_TBB
-    tbb::task_scheduler_init tbb_init ;
-#endif
+    // Use whichever Parallel::Executor the application owns (e.g. InteSiVis::mParallelExecutor), since only one may exist.
+    // Without one, Parallel::For and Reduce still run, on a default number of threads.
 
     static const float viscosity = 0.01f ;
     static const float density   = 1.0f ;
@@ -0,0 +1,30 @@
+/** \file pclOpBoundaryPanels.cpp
+
+    \brief Particle operation to impose boundary conditions at body surfaces, on vortons, using panels.
+
+    \author Written and copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "FluidBodySim/pclOpBoundaryPanels.h"
+
+#include "Core/Performance/perfBlock.h"
+
+
+
+
+void PclOpBoundaryPanels::Operate(  VECTOR< Particle > & particles , float /*timeStep*/ , unsigned /*uFrame*/ )
+{
+    PERF_BLOCK( PclOpBoundaryPanels__Operate ) ;
+
+    ASSERT( mVelocityGrid != 0 ) ;
+    ASSERT( mPhysicalObjects != 0 ) ;
+
+    mBoundaryPanels.Update( reinterpret_cast< VECTOR< Vorton > & >( particles ) , * mVelocityGrid , * mPhysicalObjects ) ;
+
+    if( mVelocityGridSnapshot && ! mBoundaryPanels.GetPanels().Empty() )
+    {   // Republish velocity grid, which VortonSim published before panels added to it.  Copying costs one pass over the grid, less than evaluating panels again.
+        * mVelocityGridSnapshot = * mVelocityGrid ;
+    }
+}
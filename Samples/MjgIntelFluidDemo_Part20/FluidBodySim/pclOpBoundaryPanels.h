@@ -0,0 +1,45 @@
+/** \file pclOpBoundaryPanels.h
+
+    \brief Particle operation to impose boundary conditions at body surfaces, on vortons, using panels.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef PARTICLE_OPERATION_BOUNDARY_PANELS_H
+#define PARTICLE_OPERATION_BOUNDARY_PANELS_H
+
+#include "Particles/Operation/particleOperation.h"
+
+#include "FluidBodySim/boundaryPanels.h"
+
+
+
+
+/** Particle operation to impose boundary conditions at body surfaces, on vortons, using panels.
+
+    This must run after PclOpVortonSim computes velocity, and before
+    anything advects vortons or tracers, since it adds to velocity.
+    PclOpVortonSim publishes its velocity grid before this runs, so this
+    publishes it again, to include velocity due to panels.
+*/
+class PclOpBoundaryPanels : public IParticleOperation
+{
+    public:
+        PclOpBoundaryPanels()
+            : mVelocityGrid( 0 )
+            , mVelocityGridSnapshot( 0 )
+            , mPhysicalObjects( 0 )
+        {}
+
+        VIRTUAL_CONSTRUCTORS( PclOpBoundaryPanels ) ;
+
+        void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+
+        BoundaryPanels                          mBoundaryPanels     ;   ///< Panel solver.
+        UniformGrid< Vec3 > *                   mVelocityGrid           ;   ///< Velocity grid VortonSim populates.
+        UniformGrid< Vec3 > *                   mVelocityGridSnapshot   ;   ///< Copy of mVelocityGrid that VortonSim publishes for tracers.  This republishes it after adding velocity due to panels.  May be NULL.
+        VECTOR< Impulsion::PhysicalObject * > * mPhysicalObjects        ;   ///< Dynamic array of addresses of physical objects.
+} ;
+
+#endif
@@ -82,7 +82,7 @@ class PclOpFluidBodyInteraction : public IParticleOperation
         const UniformGrid< float > *            mDensityGrid                ;   ///< Grid of fluid density values.
 
     #if REDUCE_CONVERGENCE
-        const UniformGrid< VECTOR< unsigned > > * mVortonIndicesGrid        ;
+        const CellList *                        mVortonIndicesGrid          ;   ///< Spatial partition of vorton indices.
     #endif
 
         float                                   mAmbientFluidDensity        ;   ///< Fluid density in the absence of fluid particles
@@ -0,0 +1,415 @@
+/** \file fluidEngine.cpp
+
+    \brief Fluid simulation without rendering, windows or input, for running as a service or benchmark.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "fluidEngine.h"
+
+#include "Sim/Vorton/vorticityDistribution.h"
+
+#include "Particles/Operation/pclOpEmit.h"
+#include "Particles/Operation/pclOpKillAge.h"
+#include "Particles/Operation/pclOpWind.h"
+#include "Particles/Operation/pclOpAssignScalarFromGrid.h"
+#include "Particles/particleGroup.h"
+#include "Particles/particleSystem.h"
+
+#include "VortonFluid/pclOpVortonSim.h"
+
+#include "FluidBodySim/pclOpFluidBodyInteraction.h"
+
+#include "Core/Performance/perfBlock.h"
+#include "Core/Performance/timer.h"
+#include "Core/Math/math.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+FluidEngine::FluidEngine()
+    : mFluidParticleSystem( NULLPTR )
+    , mFrame( 0 )
+    , mTimeNow( 0.0 )
+    , mCompletedState( 0 )
+    , mPendingTimeStep( 0.0f )
+    , mIsStepping( false )
+#if FLUID_ENGINE_ASYNC
+    , mStepThread( NULL )
+    , mStepRequested( NULL )
+    , mStepCompleted( NULL )
+    , mStepThreadQuit( false )
+    , mCallerFloatingPointControlWord( 0 )
+    , mCallerMmxControlStatusRegister( 0 )
+#endif
+{
+    memset( & mVortonPclGrpInfo , 0 , sizeof( mVortonPclGrpInfo ) ) ;
+    memset( & mTracerPclGrpInfo , 0 , sizeof( mTracerPclGrpInfo ) ) ;
+}
+
+
+
+
+FluidEngine::~FluidEngine()
+{
+    if( mIsStepping )
+    {   // Worker thread still runs a step, which touches the simulation Destroy deletes.
+        EndStep() ;
+    }
+#if FLUID_ENGINE_ASYNC
+    StopStepThread() ;
+#endif
+    Destroy() ;
+}
+
+
+
+
+/** Set up a new simulation, discarding any previous one.
+
+    This follows what InteSiVis::InitialConditions does for scenarios
+    without rigid bodies: fill the vorticity distribution with vortons,
+    then seed tracers throughout the grid those vortons span.
+*/
+void FluidEngine::Create( const FluidEngineParameters & parameters )
+{
+    PERF_BLOCK( FluidEngine__Create ) ;
+
+    ASSERT( ! mIsStepping ) ;   // Must call EndStep first.
+
+    Destroy() ;
+
+    mFrame      = 0   ;
+    mTimeNow    = 0.0 ;
+
+    mFluidParticleSystem = CreateFluidParticleSystem( mVortonPclGrpInfo , mTracerPclGrpInfo , parameters.mViscosity , parameters.mAmbientFluidDensity , parameters.mFluidSpecificHeatCapacity , mPhysicalObjects ) ;
+    mPclSysMgr.PushBack( mFluidParticleSystem ) ;
+
+    VortonSim &         vortonSim   = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    VECTOR< Vorton > &  vortons     = * vortonSim.GetVortons() ;
+
+    // Disable killing and emission, and assign tracer density from vorton density, as InteSiVis::InitialConditions does by default.
+    mVortonPclGrpInfo.mPclOpKillAge->mAgeMax    = INT_MAX ;
+    mTracerPclGrpInfo.mPclOpKillAge->mAgeMax    = INT_MAX ;
+    mVortonPclGrpInfo.mPclOpEmit->mEmitRate     = 0.0f ;
+    mTracerPclGrpInfo.mPclOpEmit->mEmitRate     = 0.0f ;
+    mVortonPclGrpInfo.mPclOpWind->mWind         = Vec3( 0.0f , 0.0f , 0.0f ) ;
+    * mTracerPclGrpInfo.mPclOpWind              = * mVortonPclGrpInfo.mPclOpWind ;
+    mTracerPclGrpInfo.mPclOpAssignDensityFromGrid->mScalarGrid = & vortonSim.GetDensityGrid() ;
+
+    vortonSim.SetFluidSimulationTechnique( parameters.mFluidSimulationTechnique ) ;
+    vortonSim.SetPopulateSdfFromDensity( false ) ;
+
+    srand( 1 ) ;    // Seed pseudo-random number generator to make results repeatable.
+
+    if( parameters.mVorticityDistribution )
+    {
+        AssignVortons( vortons , parameters.mVorticityMagnitude , parameters.mNumVortonsMax , * parameters.mVorticityDistribution ) ;
+    }
+    else
+    {   // Use default distribution.
+        AssignVortons( vortons , parameters.mVorticityMagnitude , parameters.mNumVortonsMax , JetRing( 1.0f , 1.0f , Vec3( 1.0f , 0.0f , 0.0f ) ) ) ;
+    }
+
+    if( ! vortons.Empty() )
+    {   // Seed tracers throughout the region vortons occupy.
+        vortonSim.Initialize( false ) ;
+        PclOpEmit::Emit( mTracerPclGrpInfo.mParticleGroup->GetParticles() , vortonSim.GetGrid() , parameters.mNumTracersPerCellCubeRoot , NULLPTR ) ;
+
+        if( VortonSim::FLUID_SIM_SMOOTHED_PARTICLE_HYDRODYNAMICS == parameters.mFluidSimulationTechnique )
+        {   // Using SPH but not tracking a surface using tracers, so populate signed distance from density.
+            vortonSim.SetPopulateSdfFromDensity( true ) ;
+        }
+    }
+
+    // Give GetCompletedState the initial conditions, so callers have something to read during the first step.
+    CaptureState( mStates[ mCompletedState ] ) ;
+}
+
+
+
+
+/** Advance the simulation by the given virtual duration.
+
+    \param timeStep     Virtual duration to simulate.  Must be positive.
+
+    Afterward, the quality governor adjusts settings for the next step,
+    based on how long this one took, and how much memory it used.
+    See GetQualityGovernor and GetMemoryBudget.
+*/
+void FluidEngine::Step( float timeStep )
+{
+    PERF_BLOCK( FluidEngine__Step ) ;
+
+    ASSERT( mFluidParticleSystem ) ;    // Must call Create first.
+    ASSERT( timeStep > 0.0f ) ;
+
+    Timer stepTimer ;
+
+    PrepareFluidParticleSystemUpdate( mVortonPclGrpInfo ) ;
+
+    mPclSysMgr.Update( timeStep , mFrame ) ;
+
+    const float stepDuration = stepTimer.GetElapsedTimeSeconds() ;
+
+    ReportFluidMemoryUsage( mMemoryBudget , mVortonPclGrpInfo , mTracerPclGrpInfo ) ;
+
+    mQualityGovernor.Update( mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim , * mTracerPclGrpInfo.mPclOpEmit , stepDuration , mMemoryBudget ) ;
+
+    // Lower quality shrinks particle populations, but not memory particle arrays retain, so release that.
+    if( mMemoryBudget.IsOverCap( MemoryBudget::SUBSYSTEM_VORTONS ) )
+    {
+        mVortonPclGrpInfo.mParticleGroup->TrimMemory() ;
+    }
+    if( mMemoryBudget.IsOverCap( MemoryBudget::SUBSYSTEM_TRACERS ) )
+    {
+        mTracerPclGrpInfo.mParticleGroup->TrimMemory() ;
+    }
+
+    ++ mFrame ;
+    mTimeNow += timeStep ;
+}
+
+
+
+
+/** Start advancing the simulation by the given virtual duration, without waiting for it to finish.
+
+    \param timeStep     Virtual duration to simulate.  Must be positive.
+
+    The step runs on a worker thread, which, afterward, copies particles and
+    grids into the state buffer GetCompletedState does not return.  Until
+    EndStep, callers may read GetCompletedState, which still holds the
+    previous step, and poll IsComplete, but must not call anything else.
+*/
+void FluidEngine::BeginStep( float timeStep )
+{
+    PERF_BLOCK( FluidEngine__BeginStep ) ;
+
+    ASSERT( mFluidParticleSystem ) ;    // Must call Create first.
+    ASSERT( ! mIsStepping ) ;           // Must call EndStep first.
+    ASSERT( timeStep > 0.0f ) ;
+
+    mPendingTimeStep    = timeStep ;
+    mIsStepping         = true ;
+
+#if FLUID_ENGINE_ASYNC
+    if( NULL == mStepThread )
+    {   // First asynchronous step.
+        StartStepThread() ;
+    }
+    ResetEvent( mStepCompleted ) ;
+    SetEvent( mStepRequested ) ;
+#else
+    Step( mPendingTimeStep ) ;
+    CaptureState( mStates[ 1 - mCompletedState ] ) ;
+#endif
+}
+
+
+
+
+/** Return whether the step BeginStep started has finished, so EndStep would not wait.
+
+    This never waits.  It returns true when no step is in progress.
+*/
+bool FluidEngine::IsComplete() const
+{
+    if( ! mIsStepping )
+    {
+        return true ;
+    }
+#if FLUID_ENGINE_ASYNC
+    return WAIT_OBJECT_0 == WaitForSingleObject( mStepCompleted , 0 ) ;
+#else
+    return true ;
+#endif
+}
+
+
+
+
+/** Wait for the step BeginStep started to finish, then make its state what GetCompletedState returns.
+
+    Afterward, GetParticles and GetGrids also reflect that step.
+*/
+void FluidEngine::EndStep()
+{
+    PERF_BLOCK( FluidEngine__EndStep ) ;
+
+    ASSERT( mIsStepping ) ;     // Must call BeginStep first.
+
+#if FLUID_ENGINE_ASYNC
+    WaitForSingleObject( mStepCompleted , INFINITE ) ;
+#endif
+    mCompletedState = 1 - mCompletedState ;
+    mIsStepping     = false ;
+}
+
+
+
+
+/** Return particles of the given kind, as of the most recent step.
+*/
+const VECTOR< Particle > & FluidEngine::GetParticles( ParticleKindE kind ) const
+{
+    ASSERT( mFluidParticleSystem ) ;    // Must call Create first.
+    ASSERT( kind < NUM_PARTICLE_KINDS ) ;
+    const ParticleGroup * particleGroup = ( PARTICLES_VORTONS == kind ) ? mVortonPclGrpInfo.mParticleGroup : mTracerPclGrpInfo.mParticleGroup ;
+    return particleGroup->GetParticles() ;
+}
+
+
+
+
+/** Return grids the simulation populated, as of the most recent step.
+
+    Grids only diagnostics use, like density gradient, get computed on
+    demand, here, so steps whose grids nobody requests skip that work.
+*/
+FluidEngine::Grids FluidEngine::GetGrids() const
+{
+    ASSERT( mFluidParticleSystem ) ;    // Must call Create first.
+    VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    Grids grids ;
+    grids.mVelocity         = & vortonSim.GetVelocityGrid()         ;
+    grids.mDensity          = & vortonSim.GetDensityGrid()          ;
+    grids.mDensityGradient  = & vortonSim.GetDensityGradientGrid()  ;
+    grids.mSignedDistance   = & vortonSim.GetSignedDistanceGrid()   ;
+    return grids ;
+}
+
+
+
+
+/** Copy particles and grids, as of the most recent step, into the given state.
+
+    \note Assigning to arrays that already hold a previous state reuses their
+            storage, so once particle counts settle, this only copies.
+*/
+void FluidEngine::CaptureState( State & state ) const
+{
+    PERF_BLOCK( FluidEngine__CaptureState ) ;
+
+    const VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    state.mParticles[ PARTICLES_VORTONS ]   = mVortonPclGrpInfo.mParticleGroup->GetParticles() ;
+    state.mParticles[ PARTICLES_TRACERS ]   = mTracerPclGrpInfo.mParticleGroup->GetParticles() ;
+    state.mVelocity                         = vortonSim.GetVelocityGrid() ;
+    state.mDensity                          = vortonSim.GetDensityGrid() ;
+    state.mFrame                            = mFrame ;
+    state.mTimeNow                          = mTimeNow ;
+}
+
+
+
+
+#if FLUID_ENGINE_ASYNC
+/** Start worker thread that runs steps BeginStep requests.
+*/
+void FluidEngine::StartStepThread()
+{
+    PERF_BLOCK( FluidEngine__StartStepThread ) ;
+
+    ASSERT( NULL == mStepThread ) ;
+
+    // Simulation code expects the floating point modes the calling thread set up.
+    mCallerFloatingPointControlWord = GetFloatingPointControlWord() ;
+    mCallerMmxControlStatusRegister = GetMmxControlStatusRegister() ;
+
+    mStepThreadQuit = false ;
+    mStepRequested  = CreateEvent( NULL , FALSE , FALSE , NULL ) ;
+    mStepCompleted  = CreateEvent( NULL , TRUE  , FALSE , NULL ) ;
+    mStepThread     = CreateThread( NULL , 0 , StepThreadMain , this , 0 , NULL ) ;
+    ASSERT( mStepRequested && mStepCompleted && mStepThread ) ;
+}
+
+
+
+
+/** Stop worker thread that runs steps, if it exists.
+
+    This must not get called while a step runs.
+*/
+void FluidEngine::StopStepThread()
+{
+    PERF_BLOCK( FluidEngine__StopStepThread ) ;
+
+    ASSERT( ! mIsStepping ) ;
+
+    if( mStepThread )
+    {   // Worker thread exists.
+        mStepThreadQuit = true ;
+        SetEvent( mStepRequested ) ;
+        WaitForSingleObject( mStepThread , INFINITE ) ;
+        CloseHandle( mStepThread ) ;
+        CloseHandle( mStepRequested ) ;
+        CloseHandle( mStepCompleted ) ;
+        mStepThread     = NULL ;
+        mStepRequested  = NULL ;
+        mStepCompleted  = NULL ;
+    }
+}
+
+
+
+
+/** Run steps on request, copying state after each.
+
+    \param context  Address of the FluidEngine instance.
+*/
+/* static */ DWORD WINAPI FluidEngine::StepThreadMain( LPVOID context )
+{
+    FluidEngine * engine = reinterpret_cast< FluidEngine * >( context ) ;
+
+    SetFloatingPointControlWord( engine->mCallerFloatingPointControlWord ) ;
+    SetMmxControlStatusRegister( engine->mCallerMmxControlStatusRegister ) ;
+
+    for( ;; )
+    {   // For each step...
+        WaitForSingleObject( engine->mStepRequested , INFINITE ) ;
+        if( engine->mStepThreadQuit )
+        {   // Owner wants this thread to exit.
+            break ;
+        }
+
+        engine->Step( engine->mPendingTimeStep ) ;
+        engine->CaptureState( engine->mStates[ 1 - engine->mCompletedState ] ) ;
+
+        SetEvent( engine->mStepCompleted ) ;
+    }
+
+    return 0 ;
+}
+#endif
+
+
+
+
+/** Delete the simulation Create set up, if any.
+*/
+void FluidEngine::Destroy()
+{
+    if( NULLPTR == mFluidParticleSystem )
+    {
+        return ;
+    }
+
+    // ParticleSystem::Clear does not delete groups, but CreateFluidParticleSystem allocated them, so delete them here.
+    VECTOR< ParticleGroup * > particleGroups( mFluidParticleSystem->Begin() , mFluidParticleSystem->End() ) ;
+    mPclSysMgr.Clear() ;
+    for( size_t iGroup = 0 ; iGroup < particleGroups.Size() ; ++ iGroup )
+    {   // For each particle group...
+        delete particleGroups[ iGroup ] ;
+    }
+    delete mFluidParticleSystem ;
+    mFluidParticleSystem = NULLPTR ;
+
+    memset( & mVortonPclGrpInfo , 0 , sizeof( mVortonPclGrpInfo ) ) ;
+    memset( & mTracerPclGrpInfo , 0 , sizeof( mTracerPclGrpInfo ) ) ;
+}
@@ -0,0 +1,215 @@
+/** \file fluidEngine.h
+
+    \brief Fluid simulation without rendering, windows or input, for running as a service or benchmark.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef FLUID_ENGINE_H
+#define FLUID_ENGINE_H
+
+#include "particleSystemConfiguration.h"
+#include "qualityGovernor.h"
+
+#include "Particles/particleSystemManager.h"
+#include "Particles/particle.h"
+
+#include "VortonFluid/pclOpVortonSim.h"
+
+#include "Core/Containers/vector.h"
+#include "Core/Performance/memoryBudget.h"
+
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
+class IVorticityDistribution ;
+class ParticleSystem ;
+
+// Macros --------------------------------------------------------------
+
+/** Whether FluidEngine::BeginStep runs steps on a worker thread.
+
+    Without Win32 threads, BeginStep runs the step before returning, so
+    callers written against BeginStep and EndStep still work, only without
+    overlap.
+*/
+#if defined( WIN32 )
+#   define FLUID_ENGINE_ASYNC 1
+#else
+#   define FLUID_ENGINE_ASYNC 0
+#endif
+
+// Types --------------------------------------------------------------
+
+/** Parameters of a fluid simulation that FluidEngine::Create sets up.
+
+    Defaults match the "jet" vortex ring InteSiVis runs first.
+*/
+struct FluidEngineParameters
+{
+    FluidEngineParameters()
+        : mViscosity( 0.01f )
+        , mAmbientFluidDensity( 1.0f )
+        , mFluidSpecificHeatCapacity( 10.0f )
+        , mFluidSimulationTechnique( VortonSim::FLUID_SIM_VORTEX_PARTICLE_METHOD )
+        , mVorticityDistribution( NULLPTR )
+        , mVorticityMagnitude( 20.0f )
+        , mNumVortonsMax( 16 * 16 * 16 )
+        , mNumTracersPerCellCubeRoot( 3 )
+    {}
+
+    float                                   mViscosity                  ;   ///< Kinematic viscosity of fluid.
+    float                                   mAmbientFluidDensity        ;   ///< Density of fluid where vortons do not change it.
+    float                                   mFluidSpecificHeatCapacity  ;   ///< Heat capacity of fluid per unit mass.
+    VortonSim::FluidSimulationTechniqueE    mFluidSimulationTechnique   ;   ///< Whether to simulate using vortex particle method, SPH, or a hybrid.
+    const IVorticityDistribution *          mVorticityDistribution      ;   ///< Initial distribution of vorticity, or NULL for a jet vortex ring.  Only Create reads this.
+    float                                   mVorticityMagnitude         ;   ///< Scale of initial vorticity.
+    unsigned                                mNumVortonsMax              ;   ///< Approximate number of vortons that initially fill the distribution.
+    unsigned                                mNumTracersPerCellCubeRoot  ;   ///< Cube root of number of tracers to emit per grid cell, initially.
+} ;
+
+
+
+
+/** Fluid simulation without rendering, windows or input, for running as a service or benchmark.
+
+    This owns the same particle systems InteSiVis simulates, built by
+    CreateFluidParticleSystem, and steps them without any render or
+    window state, so it links without OpenGL or GLUT.
+
+    Typical use:
+
+        FluidEngine engine ;
+        engine.Create( FluidEngineParameters() ) ;
+        for( unsigned frame = 0 ; frame < numFrames ; ++ frame )
+        {
+            engine.Step( 1.0f / 30.0f ) ;
+            Consume( engine.GetParticles( FluidEngine::PARTICLES_TRACERS ) , engine.GetGrids() ) ;
+        }
+
+    A host engine that cannot afford to wait for a step can instead start
+    it at the beginning of its frame, render the previous step meanwhile,
+    and collect it later:
+
+        engine.BeginStep( 1.0f / 30.0f ) ;
+        Render( engine.GetCompletedState() ) ;  // Previous step, unchanged while this one runs.
+        ...
+        engine.EndStep() ;                      // Or poll IsComplete, to avoid waiting.
+
+    BeginStep runs Step on a worker thread, then copies particles and grids
+    into whichever of two State buffers callers do not read.  EndStep waits
+    for that, then swaps buffers.  Between BeginStep and EndStep, callers
+    must only read GetCompletedState, and must not call other methods, which
+    touch live simulation state the worker thread modifies.
+*/
+class FluidEngine
+{
+    public:
+        /// Kinds of particles the simulation has.
+        enum ParticleKindE
+        {
+            PARTICLES_VORTONS   ,   ///< Vortex particles, which carry vorticity and density, and determine flow.
+            PARTICLES_TRACERS   ,   ///< Passive particles, which follow flow, and that visualizations usually draw.
+            NUM_PARTICLE_KINDS
+        } ;
+
+        /// Grids the simulation populates each step.  Pointers remain valid until the next Create.
+        struct Grids
+        {
+            const UniformGrid< Vec3 > *     mVelocity           ;   ///< Velocity, as of the most recent step.
+            const UniformGrid< float > *    mDensity            ;   ///< Fluid density, populated from vortons.  Empty when simulating with SPH.
+            const UniformGrid< Vec3 > *     mDensityGradient    ;   ///< Gradient of fluid density.
+            const UniformGrid< float > *    mSignedDistance     ;   ///< Signed distance from fluid surface.  Empty unless the simulation tracks a surface.
+        } ;
+
+        /// Copy of simulation state as of a step that BeginStep ran, which callers can read while the next step runs.
+        struct State
+        {
+            State()
+                : mFrame( 0 )
+                , mTimeNow( 0.0 )
+            {}
+
+            VECTOR< Particle >      mParticles[ NUM_PARTICLE_KINDS ]    ;   ///< Particles of each kind.
+            UniformGrid< Vec3 >     mVelocity                           ;   ///< Velocity grid.
+            UniformGrid< float >    mDensity                            ;   ///< Fluid density grid.  Empty when simulating with SPH.
+            unsigned                mFrame                              ;   ///< Number of steps since Create.
+            double                  mTimeNow                            ;   ///< Virtual time since Create.
+        } ;
+
+        FluidEngine() ;
+        ~FluidEngine() ;
+
+        void    Create( const FluidEngineParameters & parameters ) ;
+        void    Step( float timeStep ) ;
+
+        void    BeginStep( float timeStep ) ;
+        bool    IsComplete() const ;
+        void    EndStep() ;
+
+        /// Return whether a step BeginStep started awaits EndStep.
+        bool    IsStepping() const  { return mIsStepping ; }
+
+        /// Return state as of the step EndStep most recently collected.  Contents stay unchanged until the next EndStep.
+        const State & GetCompletedState() const { return mStates[ mCompletedState ] ; }
+
+        const VECTOR< Particle > &  GetParticles( ParticleKindE kind ) const ;
+        Grids                       GetGrids() const ;
+
+        /// Return number of steps since Create.
+        unsigned    GetFrame() const    { return mFrame ; }
+
+        /// Return virtual time since Create.
+        double      GetTimeNow() const  { return mTimeNow ; }
+
+        /// Return vorton simulation, for callers that need settings or diagnostics this interface omits.
+        VortonSim & GetVortonSim()      { return mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ; }
+
+        /// Return controller that adapts quality to frame time.  Assign its targets to enable it.  Settings persist across Create.
+        QualityGovernor & GetQualityGovernor()  { return mQualityGovernor ; }
+
+        /// Return memory each subsystem used as of the most recent step.  Assign its caps to make the quality governor respect them.  Caps persist across Create.
+              MemoryBudget & GetMemoryBudget()          { return mMemoryBudget ; }
+        const MemoryBudget & GetMemoryBudget() const    { return mMemoryBudget ; }
+
+    private:
+        FluidEngine( const FluidEngine & ) ;                // Disallow copy
+        FluidEngine & operator=( const FluidEngine & ) ;    // Disallow assignment
+
+        void    Destroy() ;
+        void    CaptureState( State & state ) const ;
+    #if FLUID_ENGINE_ASYNC
+        void    StartStepThread() ;
+        void    StopStepThread() ;
+        static DWORD WINAPI StepThreadMain( LPVOID context ) ;
+    #endif
+
+        ParticleSystemManager                   mPclSysMgr              ;   ///< Manager that updates the fluid particle system.
+        ParticleSystem *                        mFluidParticleSystem    ;   ///< Vortons and tracers, and operations on them.  NULL until Create.
+        FluidVortonPclGrpInfo                   mVortonPclGrpInfo       ;   ///< Vorton particle group and its operations.
+        FluidTracerPclGrpInfo                   mTracerPclGrpInfo       ;   ///< Tracer particle group and its operations.
+        VECTOR< Impulsion::PhysicalObject * >   mPhysicalObjects        ;   ///< Rigid bodies fluid interacts with.  None, for now, but fluid-body operations require a list.
+        QualityGovernor                         mQualityGovernor        ;   ///< Adapts quality to keep step duration near a budget.
+        MemoryBudget                            mMemoryBudget           ;   ///< Memory each subsystem uses, and optional caps the quality governor respects.
+        unsigned                                mFrame                  ;   ///< Number of steps since Create.
+        double                                  mTimeNow                ;   ///< Virtual time since Create.
+        State                                   mStates[ 2 ]            ;   ///< Double buffer of copied state.  Callers read mStates[ mCompletedState ] while BeginStep fills the other.
+        unsigned                                mCompletedState         ;   ///< Index, into mStates, of state EndStep most recently collected.
+        float                                   mPendingTimeStep        ;   ///< Virtual duration of step BeginStep started.
+        bool                                    mIsStepping             ;   ///< Whether a step BeginStep started awaits EndStep.
+    #if FLUID_ENGINE_ASYNC
+        HANDLE                                  mStepThread             ;   ///< Worker thread that runs steps BeginStep starts, or NULL until the first BeginStep.
+        HANDLE                                  mStepRequested          ;   ///< Event that tells worker thread to run a step.
+        HANDLE                                  mStepCompleted          ;   ///< Manual-reset event the worker thread sets when a step and its state copy finish.
+        volatile bool                           mStepThreadQuit         ;   ///< Whether worker thread should exit instead of running a step.
+        WORD                                    mCallerFloatingPointControlWord ;   ///< Floating point control word for worker thread to adopt.
+        unsigned                                mCallerMmxControlStatusRegister ;   ///< MXCSR for worker thread to adopt.
+    #endif
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -10,29 +10,35 @@
 #include "Particles/Operation/pclOpFindBoundingBox.h"
 #include "Particles/Operation/pclOpWind.h"
 #include "Particles/Operation/pclOpAdvect.h"
+#include "Particles/Operation/pclOpSubgridTurbulence.h"
+#include "Particles/Operation/pclOpInterpolateVelocityGrid.h"
 #include "Particles/Operation/pclOpEvolve.h"
 #include "Particles/Operation/pclOpAssignScalarFromGrid.h"
 #include "Particles/Operation/pclOpPopulateVelocityGrid.h"
 #include "Particles/Operation/pclOpEmit.h"
 #include "Particles/Operation/pclOpKillAge.h"
+#include "Particles/Operation/pclOpSortMorton.h"
 #include "Particles/particleGroup.h"
 #include "Particles/particleSystemManager.h"
+#include "Particles/particleAttributeView.h"
 
 #include "VortonFluid/pclOpVortonSim.h"
 
 #include "FluidBodySim/fluidBodySim.h"
 #include "FluidBodySim/pclOpFluidBodyInteraction.h"
+#include "FluidBodySim/pclOpBoundaryPanels.h"
 
 #include <Core/Performance/perfBlock.h>
+#include <Core/Performance/memoryBudget.h>
 
 static const Vec3 sGravityDirection( 0.0f , 0.0f , -1.0f ) ; ///< Direction of acceleration due to gravity
 static const Vec3 sGravityAcceleration( 10.0f * sGravityDirection ) ; ///< Acceleration due to gravity
 
-static const size_t tracerOffsetToDensity       = offsetof( Particle , mDensity         ) ;
+static const size_t tracerOffsetToDensity       = Particles::GetAttributeOffset( PARTICLE_ATTRIBUTE_DENSITY        ) ;
 #if ENABLE_FIRE
-static const size_t tracerOffsetToFuelFraction  = offsetof( Particle , mFuelFraction    ) ;
-static const size_t tracerOffsetToFlameFraction = offsetof( Particle , mFlameFraction   ) ;
-static const size_t tracerOffsetToSmokeFraction = offsetof( Particle , mSmokeFraction   ) ;
+static const size_t tracerOffsetToFuelFraction  = Particles::GetAttributeOffset( PARTICLE_ATTRIBUTE_FUEL_FRACTION  ) ;
+static const size_t tracerOffsetToFlameFraction = Particles::GetAttributeOffset( PARTICLE_ATTRIBUTE_FLAME_FRACTION ) ;
+static const size_t tracerOffsetToSmokeFraction = Particles::GetAttributeOffset( PARTICLE_ATTRIBUTE_SMOKE_FRACTION ) ;
 #endif
 
 
@@ -46,7 +52,8 @@ static ParticleGroup * CreateVortonParticleGroup( FluidVortonPclGrpInfo & vorton
 
     vortonPclGrpInfo.mParticleGroup = new ParticleGroup() ;
 
-    static const int    killAgeMax  = 90    ;
+    static const int        killAgeMax          = 90    ;
+    static const unsigned   sortMortonPeriod    = 16    ;
 
     vortonPclGrpInfo.mPclOpKillAge          = new PclOpKillAge() ;
     vortonPclGrpInfo.mPclOpKillAge->mAgeMax = killAgeMax ;
@@ -72,6 +79,16 @@ static ParticleGroup * CreateVortonParticleGroup( FluidVortonPclGrpInfo & vorton
     vortonPclGrpInfo.mPclOpEmit->mEmitRate                  = 0.0f ; // Set by InitialConditions
     vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpEmit ) ;
 
+    // Sort vortons after emitting and before VortonSim, so VortonSim and
+    // everything after it visit vortons in spatially coherent order.
+    // CreateFluidParticleSystem binds mCellList to the VortonSim partition.
+    // Ordering vortons by cell of that partition lets it store their indices
+    // in 16 bits, which halves index traffic in neighbor loops.
+    vortonPclGrpInfo.mPclOpSortMorton = new PclOpSortMorton() ;
+    vortonPclGrpInfo.mPclOpSortMorton->mSortPeriod = sortMortonPeriod ;
+    vortonPclGrpInfo.mPclOpSortMorton->mSortByCell = true ;
+    vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpSortMorton ) ;
+
     // PclOpVortonSim must run after finding bounding box for tracers
     // because VortonSim populates the velocity grid, which relies on
     // the grid dimensions being set from the bounding box.
@@ -88,6 +105,21 @@ static ParticleGroup * CreateVortonParticleGroup( FluidVortonPclGrpInfo & vorton
 
     vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpVortonSim ) ;
 
+#if ENABLE_BOUNDARY_PANELS
+    // BoundaryPanels runs after VortonSim, because it solves for panel
+    // strengths from the velocity grid VortonSim populates, then adds velocity
+    // due to panels to vortons and to that grid.  VortonSim already published
+    // its grid, so BoundaryPanels republishes it, and tracers, which sample
+    // the published snapshot, advect with velocity due to panels too.
+    vortonPclGrpInfo.mPclOpBoundaryPanels = new PclOpBoundaryPanels() ;
+    vortonPclGrpInfo.mPclOpBoundaryPanels->mVelocityGrid            = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
+    vortonPclGrpInfo.mPclOpBoundaryPanels->mVelocityGridSnapshot    = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGridSnapshot() ;
+    vortonPclGrpInfo.mPclOpBoundaryPanels->mPhysicalObjects         = & physicalObjects ;
+    vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpBoundaryPanels ) ;
+#else
+    vortonPclGrpInfo.mPclOpBoundaryPanels = 0 ;
+#endif
+
     // Wind runs after assign-velocity-from-field, because that overwrites
     // velocity, and Wind adds to that velocity.
     vortonPclGrpInfo.mPclOpWind = new PclOpWind() ;
@@ -97,7 +129,10 @@ static ParticleGroup * CreateVortonParticleGroup( FluidVortonPclGrpInfo & vorton
     vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpWind ) ;
 
     // Evolve runs after all operations that set velocity.
+    // Vortons faster than one grid cell per step evolve in substeps, re-sampling the velocity grid.
     vortonPclGrpInfo.mPclOpEvolve = new PclOpEvolve() ;
+    vortonPclGrpInfo.mPclOpEvolve->mVelocityGrid    = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
+    vortonPclGrpInfo.mPclOpEvolve->mMaxCflNumber    = 1.0f ;
     vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpEvolve ) ;
 
     // Fluid-Body interaction must occur after evolve, because evolve will move
@@ -136,7 +171,7 @@ static ParticleGroup * CreateVortonParticleGroup( FluidVortonPclGrpInfo & vorton
     //      This could be mitigated by solving velocity only at vortons (not on the grid) during the Update phase.  But then for VPM it would lose information. See above.
     //  (2) It leads to the velocity grid having different domain than the density and other grids.  By itself this does not seem to cause any problems; it's just surprising.
     vortonPclGrpInfo.mPclOpPopulateVelocityGrid = new PclOpPopulateVelocityGrid() ;
-    vortonPclGrpInfo.mPclOpPopulateVelocityGrid->mVelocityGrid = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
+    vortonPclGrpInfo.mPclOpPopulateVelocityGrid->mVelocityGrid = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGridSnapshot() ;
     vortonPclGrpInfo.mPclOpPopulateVelocityGrid->mBoundingBox  = const_cast< Vec3 * >( & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetMinCorner() ) ;
     vortonPclGrpInfo.mParticleGroup->PushBack( vortonPclGrpInfo.mPclOpPopulateVelocityGrid ) ;
 #else
@@ -191,12 +226,29 @@ static ParticleGroup * CreateTracerParticleGroup( FluidTracerPclGrpInfo & tracer
     }
 #endif
 
+    {   // Tracers update before vortons, so the latest snapshot is the most recent vorton result, and tracers blend toward it over the vorton update period.
+        tracerPclGrpInfo.mPclOpInterpolateVelocityGrid = new PclOpInterpolateVelocityGrid() ;
+        tracerPclGrpInfo.mPclOpInterpolateVelocityGrid->mEarlierGrid    = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetPreviousVelocityGridSnapshot() ;
+        tracerPclGrpInfo.mPclOpInterpolateVelocityGrid->mLaterGrid      = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGridSnapshot() ;
+        tracerPclGrpInfo.mPclOpInterpolateVelocityGrid->mSourceGroup    = vortonPclGrpInfo.mParticleGroup ;
+        tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpInterpolateVelocityGrid ) ;
+    }
+    const UniformGrid< Vec3 > & tracerVelocityGrid = tracerPclGrpInfo.mPclOpInterpolateVelocityGrid->GetInterpolatedGrid() ;
+
     {
         tracerPclGrpInfo.mPclOpAssignVelocityFromField = new PclOpAssignVelocityFromField() ;
-        tracerPclGrpInfo.mPclOpAssignVelocityFromField->mVelocityGrid    =  & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
+        // Tracers read velocity interpolated from snapshots VortonSim::Update publishes, not the grid it writes.
+        tracerPclGrpInfo.mPclOpAssignVelocityFromField->mVelocityGrid    =  & tracerVelocityGrid ;
         tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpAssignVelocityFromField ) ;
     }
 
+    {
+        tracerPclGrpInfo.mPclOpSubgridTurbulence = new PclOpSubgridTurbulence() ;
+        // Derive vorticity from the same grid tracers get velocity from.  mAmplitude defaults to zero, which disables turbulence.
+        tracerPclGrpInfo.mPclOpSubgridTurbulence->mVelocityGrid  =  & tracerVelocityGrid ;
+        tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpSubgridTurbulence ) ;
+    }
+
     {
         tracerPclGrpInfo.mPclOpWind = new PclOpWind() ;
         * tracerPclGrpInfo.mPclOpWind = * vortonPclGrpInfo.mPclOpWind ;
@@ -206,6 +258,10 @@ static ParticleGroup * CreateTracerParticleGroup( FluidTracerPclGrpInfo & tracer
 #if 1 // TESTING initial surface tracer placement. DO NOT SUBMIT DISABLED. See comments below.
     {
         tracerPclGrpInfo.mPclOpEvolve = new PclOpEvolve() ;
+        tracerPclGrpInfo.mPclOpEvolve->mVelocityGrid    = & tracerVelocityGrid ;
+        tracerPclGrpInfo.mPclOpEvolve->mMaxCflNumber    = vortonPclGrpInfo.mPclOpEvolve->mMaxCflNumber ;
+        // Tracers get most of their velocity from the grid, so sampling it mid-step keeps them on streamlines, rather than spiralling out of vortices.
+        tracerPclGrpInfo.mPclOpEvolve->mIntegrator      = PclOpEvolve::INTEGRATOR_MIDPOINT ;
         tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpEvolve ) ;
     }
 #endif
@@ -238,15 +294,14 @@ static ParticleGroup * CreateTracerParticleGroup( FluidTracerPclGrpInfo & tracer
         tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpEmit ) ;
     }
 
-    // Finding bounding box must occur late in this group, and before
-    // VortonSim in the other group (because VortonSim uses the bounding
-    // box to create a grid of appropriate size to capture all relevant
-    // terms of the vorticity equation). Safest to run FindBoundingBox last.
-    //#error TODO: Use the bounding box values found here, instead of recomputing that, in PclOpSeedSurfaceTracers::Replace
+    // Sort tracers after emitting, so later operations, and later frames, visit
+    // tracers in spatially coherent order.  No persistent data refers
+    // to tracers by index, so this needs no mCellList.
     {
-        tracerPclGrpInfo.mPclOpFindBoundingBox = 0 ;
-        tracerPclGrpInfo.mPclOpFindBoundingBox = new PclOpFindBoundingBox() ;
-        tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpFindBoundingBox ) ;
+        static const unsigned sortMortonPeriod = 16 ;
+        tracerPclGrpInfo.mPclOpSortMorton = new PclOpSortMorton() ;
+        tracerPclGrpInfo.mPclOpSortMorton->mSortPeriod = sortMortonPeriod ;
+        tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpSortMorton ) ;
     }
 
     // Reassign surface tracers to reside within a specified band about the fluid surface.
@@ -257,10 +312,23 @@ static ParticleGroup * CreateTracerParticleGroup( FluidTracerPclGrpInfo & tracer
         tracerPclGrpInfo.mPclOpSeedSurfaceTracers->mBandWidth           = - FLT_MAX ;
         tracerPclGrpInfo.mPclOpSeedSurfaceTracers->mAmbientDensity      = ambientFluidDensity ;
         tracerPclGrpInfo.mPclOpSeedSurfaceTracers->mSignedDistanceGrid  = NULLPTR ; // & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetSignedDistanceGrid() ; // InitialConditions sets this explicitly.
-        tracerPclGrpInfo.mPclOpSeedSurfaceTracers->mReferenceGrid       = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
+        tracerPclGrpInfo.mPclOpSeedSurfaceTracers->mReferenceGrid       = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGridSnapshot() ;
         tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpSeedSurfaceTracers ) ;
     }
 
+    // Finding bounding box must occur late in this group, and before
+    // VortonSim in the other group (because VortonSim uses the bounding
+    // box to create a grid of appropriate size to capture all relevant
+    // terms of the vorticity equation). Safest to run FindBoundingBox last.
+    // Running last also means no later operation moves tracers out of the
+    // chunk bounds it finds, so the renderer can use them to cull tracers.
+    //#error TODO: Use the bounding box values found here, instead of recomputing that, in PclOpSeedSurfaceTracers::Replace
+    {
+        tracerPclGrpInfo.mPclOpFindBoundingBox = 0 ;
+        tracerPclGrpInfo.mPclOpFindBoundingBox = new PclOpFindBoundingBox() ;
+        tracerPclGrpInfo.mParticleGroup->PushBack( tracerPclGrpInfo.mPclOpFindBoundingBox ) ;
+    }
+
     return tracerPclGrpInfo.mParticleGroup ;
 }
 
@@ -283,6 +351,9 @@ ParticleSystem * CreateFluidParticleSystem( FluidVortonPclGrpInfo & vortonPclGrp
     fluidParticleSystem->PushBack( tracerPclGrpInfo.mParticleGroup ) ;
     fluidParticleSystem->PushBack( vortonPclGrpInfo.mParticleGroup ) ;
 
+    // Tracer operations point directly to grids VortonSim writes, so groups must update in order, even without the indirect assignments below.
+    fluidParticleSystem->AddGroupDependency( tracerPclGrpInfo.mParticleGroup , vortonPclGrpInfo.mParticleGroup ) ;
+
     if( tracerPclGrpInfo.mPclOpFindBoundingBox )
     {
         // Patch vortex particle system to reference results from PclOpFindBoundingBox.
@@ -295,12 +366,82 @@ ParticleSystem * CreateFluidParticleSystem( FluidVortonPclGrpInfo & vortonPclGrp
             ,   IndirectAddress( tracerPclGrpInfo.mPclOpFindBoundingBox , & tracerPclGrpInfo.mPclOpFindBoundingBox->GetMaxCorner() ) ) ;
     }
 
+    // Patch vorton sort operation to remap indices held by the VortonSim spatial partition.
+    // This uses an indirect assignment so that clones of this system bind to their own VortonSim.
+    fluidParticleSystem->AddIndirectAddressAssignment(
+            IndirectAddress( vortonPclGrpInfo.mPclOpSortMorton , & vortonPclGrpInfo.mPclOpSortMorton->mCellList                     )
+        ,   IndirectAddress( vortonPclGrpInfo.mPclOpVortonSim  , & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVortonCellList() ) ) ;
+
     return fluidParticleSystem ;
 }
 
 
 
 
+/** Prepare fluid particle operations for the next update, according to the fluid simulation technique.
+
+    Call this before each update of the particle system CreateFluidParticleSystem created.
+*/
+void PrepareFluidParticleSystemUpdate( FluidVortonPclGrpInfo & vortonPclGrpInfo )
+{
+    #if USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
+    if(     ( VortonSim::FLUID_SIM_SMOOTHED_PARTICLE_HYDRODYNAMICS == vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
+        ||  ( VortonSim::FLUID_SIM_VPM_SPH_HYBRID                  == vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
+        //||  ( VortonSim::FLUID_SIM_VORTEX_PARTICLE_METHOD          == vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
+        )
+    {
+        // Set up particle operation to re-populate velocity grid from SPH particles, to take into account SPH particle velocity after satisfying boundary conditions.
+        // This is meant to keep tracers from heading where they should not.
+        // In principle this should also occur for VPM, but it's only implemented for SPH, because of the problems created by not assigning densities, which the comments below describe.
+        ASSERT( vortonPclGrpInfo.mPclOpPopulateVelocityGrid ) ;
+        // This writes the snapshot that tracers read, since it runs after VortonSim::Update publishes that.
+        vortonPclGrpInfo.mPclOpPopulateVelocityGrid->mVelocityGrid = & vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGridSnapshot() ;
+
+        // In SPH mode, the density grid isn't updated, so has invalid bounds, which would make AssignScalarFromGrid fail.
+        // Clear density grids to avoid that problem.
+        // Note that in this mode, because density grid is not populated, tracers do not get their densities updated from vortons.
+        // That has 2 effects: linear impulses are different, and rendering is different.
+        const_cast< UniformGrid< float > & >( vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetDensityGrid() ) .Clear() ;
+
+    #if ENABLE_FIRE
+        const_cast< UniformGrid< float > & >( vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFuelGrid() ).Clear() ;
+        const_cast< UniformGrid< float > & >( vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFlameGrid() ).Clear() ;
+        const_cast< UniformGrid< float > & >( vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetSmokeGrid() ).Clear() ;
+    #endif
+    }
+    else
+    #endif
+    {
+        ASSERT( VortonSim::FLUID_SIM_VORTEX_PARTICLE_METHOD == vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() ) ;
+        if( vortonPclGrpInfo.mPclOpPopulateVelocityGrid )
+        {
+            vortonPclGrpInfo.mPclOpPopulateVelocityGrid->mVelocityGrid = 0 ;
+        }
+    }
+}
+
+
+
+
+/** Report memory the fluid particle system CreateFluidParticleSystem created occupies, and sample render memory.
+
+    \param memoryBudget    (in/out) Budget into which to report usage of every MemoryBudget subsystem.
+
+    Call this once per frame, after updating the particle system.
+*/
+void ReportFluidMemoryUsage( MemoryBudget & memoryBudget , const FluidVortonPclGrpInfo & vortonPclGrpInfo , const FluidTracerPclGrpInfo & tracerPclGrpInfo )
+{
+    PERF_BLOCK( ReportFluidMemoryUsage ) ;
+
+    vortonPclGrpInfo.mPclOpVortonSim->mVortonSim.ReportMemoryUsage( memoryBudget ) ;
+    memoryBudget.SetUsage( MemoryBudget::SUBSYSTEM_VORTONS , vortonPclGrpInfo.mParticleGroup->GetMemoryUsage() ) ;
+    memoryBudget.SetUsage( MemoryBudget::SUBSYSTEM_TRACERS , tracerPclGrpInfo.mParticleGroup->GetMemoryUsage() ) ;
+    memoryBudget.SampleTrackedUsage() ;
+}
+
+
+
+
 ParticleSystem * CreateNonFluidParticleSystem( size_t i )
 {
     PERF_BLOCK( CreateNonFluidParticleSystem ) ;
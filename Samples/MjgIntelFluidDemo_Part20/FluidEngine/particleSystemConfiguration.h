@@ -5,6 +5,9 @@
     These structs and routines stand proxy for defining particle systems using some definitions from a configuration file.
 
 */
+#ifndef PARTICLE_SYSTEM_CONFIGURATION_H
+#define PARTICLE_SYSTEM_CONFIGURATION_H
+
 #include "Core/Containers/vector.h"
 
 class PclOpEmit ;
@@ -12,14 +15,19 @@ class PclOpSeedSurfaceTracers ;
 class PclOpFindBoundingBox ;
 class PclOpVortonSim ;
 class PclOpFluidBodyInteraction ;
+class PclOpBoundaryPanels ;
 class PclOpPopulateVelocityGrid ;
 class PclOpAssignScalarFromGrid ;
 class PclOpAssignVelocityFromField ;
+class PclOpSubgridTurbulence ;
+class PclOpInterpolateVelocityGrid ;
 class PclOpEvolve ;
 class PclOpWind ;
 class PclOpKillAge ;
+class PclOpSortMorton ;
 class ParticleGroup ;
 class ParticleSystem ;
+class MemoryBudget ;
 
 namespace Impulsion
 {
@@ -30,7 +38,9 @@ struct FluidVortonPclGrpInfo
 {
     ParticleGroup               *   mParticleGroup                  ;   ///< Particle group for vortons.
     PclOpEmit                   *   mPclOpEmit                      ;   ///< Emit vortons.
+    PclOpSortMorton             *   mPclOpSortMorton                ;   ///< Periodically sort vortons along a Morton curve, for memory locality.
     PclOpVortonSim              *   mPclOpVortonSim                 ;   ///< Update velocity grid due to vorton-based fluid simulation.
+    PclOpBoundaryPanels         *   mPclOpBoundaryPanels            ;   ///< Impose no-through and no-slip at body surfaces using panels, or 0 if ENABLE_BOUNDARY_PANELS is off.
     PclOpFluidBodyInteraction   *   mPclOpFluidBodInte              ;   ///< Interact vortons with rigid bodies.
     PclOpPopulateVelocityGrid   *   mPclOpPopulateVelocityGrid      ;   ///< Populate velocity grid from particles.
     PclOpEvolve                 *   mPclOpEvolve                    ;   ///< Update particle position & orientation from velocities.
@@ -42,6 +52,8 @@ struct FluidTracerPclGrpInfo
 {
     ParticleGroup               *   mParticleGroup                  ;   ///< Particle group for tracers.
     PclOpEmit                   *   mPclOpEmit                      ;   ///< Emit passive tracer particles.
+    PclOpInterpolateVelocityGrid*   mPclOpInterpolateVelocityGrid   ;   ///< Interpolate velocity between vorton updates, so tracers move smoothly when vortons update less often than tracers.
+    PclOpSortMorton             *   mPclOpSortMorton                ;   ///< Periodically sort tracers along a Morton curve, for memory locality.
 // For testing only:
 PclOpSeedSurfaceTracers     *   mPclOpSeedSurfaceTracers        ;   ///< Seed tracer particles at fluid surface.
     PclOpFindBoundingBox        *   mPclOpFindBoundingBox           ;   ///< Find bounding box containing all tracers.
@@ -51,10 +63,15 @@ PclOpSeedSurfaceTracers     *   mPclOpSeedSurfaceTracers        ;   ///< Seed tr
     PclOpAssignScalarFromGrid   *   mPclOpAssignFlameFromGrid       ;   ///< Assign flame to tracers from grid populated from vortons.
     PclOpAssignScalarFromGrid   *   mPclOpAssignSmokeFromGrid       ;   ///< Assign smoke to tracers from grid populated from vortons.
     PclOpAssignVelocityFromField*   mPclOpAssignVelocityFromField   ;   ///< Advect tracers according to velocity field.
+    PclOpSubgridTurbulence      *   mPclOpSubgridTurbulence         ;   ///< Add procedural turbulence finer than velocity field resolves.
     PclOpWind                   *   mPclOpWind                      ;   ///< Apply wind to tracers.
     PclOpEvolve                 *   mPclOpEvolve                    ;   ///< Update particle position & orientation.
     PclOpKillAge                *   mPclOpKillAge                   ;   ///< Kill old passive tracer particles.
 } ;
 
 extern ParticleSystem * CreateFluidParticleSystem( FluidVortonPclGrpInfo & vortonPclGrpInfo , FluidTracerPclGrpInfo & tracerPclGrpInfo , const float viscosity , const float ambientFluidDensity , const float fluidSpecificHeatCapacity , VECTOR< Impulsion::PhysicalObject * > & physicalObjects ) ;
+extern void PrepareFluidParticleSystemUpdate( FluidVortonPclGrpInfo & vortonPclGrpInfo ) ;
+extern void ReportFluidMemoryUsage( MemoryBudget & memoryBudget , const FluidVortonPclGrpInfo & vortonPclGrpInfo , const FluidTracerPclGrpInfo & tracerPclGrpInfo ) ;
 extern ParticleSystem * CreateNonFluidParticleSystem( size_t i ) ;
+
+#endif
@@ -0,0 +1,257 @@
+/** \file qualityGovernor.cpp
+
+    \brief Feedback controller that adapts simulation quality to keep frame time near a budget.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "qualityGovernor.h"
+
+#include "Particles/Operation/pclOpEmit.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include <string.h>
+
+// Private functions --------------------------------------------------------------
+
+/** Return value part way between the given values.
+
+    \param atZero   Value when fraction is zero.
+
+    \param atOne    Value when fraction is one.
+
+    \param fraction How far from atZero toward atOne.
+*/
+static inline float Interpolate( float atZero , float atOne , float fraction )
+{
+    return atZero + fraction * ( atOne - atZero ) ;
+}
+
+
+
+
+/** Fold ratios of memory usage to cap, of the given subsystems, into a load.
+
+    \param load     (in/out) Largest ratio so far.
+
+    \return Whether any of the given subsystems has a cap.
+*/
+static bool AccumulateMemoryLoad( float & load , const MemoryBudget & memoryBudget , const MemoryBudget::SubsystemE * subsystems , size_t numSubsystems )
+{
+    bool hasCap = false ;
+    for( size_t index = 0 ; index < numSubsystems ; ++ index )
+    {
+        if( memoryBudget.HasCap( subsystems[ index ] ) )
+        {
+            load    = Max2( load , memoryBudget.GetLoad( subsystems[ index ] ) ) ;
+            hasCap  = true ;
+        }
+    }
+    return hasCap ;
+}
+
+
+
+
+/** Move quality one step toward bringing smoothed load back within the hysteresis band around one.
+
+    \param quality              (in/out) Quality level, in [0,1].
+
+    \param numFramesSinceChange (in/out) Number of updates since quality last changed.
+
+    \return Whether quality changed.
+*/
+static bool StepQuality( float & quality , unsigned & numFramesSinceChange , float smoothedLoad , float hysteresis , float qualityStep , unsigned numSettleFrames )
+{
+    ++ numFramesSinceChange ;
+    if( numFramesSinceChange < numSettleFrames )
+    {   // Previous change has not had time to show in timings yet.
+        return false ;
+    }
+
+    float newQuality = quality ;
+    if( smoothedLoad > 1.0f + hysteresis )
+    {   // Over budget.
+        newQuality = Max2( quality - qualityStep , 0.0f ) ;
+    }
+    else if( smoothedLoad < 1.0f - hysteresis )
+    {   // Well under budget.
+        newQuality = Min2( quality + qualityStep , 1.0f ) ;
+    }
+
+    if( newQuality == quality )
+    {   // Within band, or already at a limit.
+        return false ;
+    }
+    quality                 = newQuality ;
+    numFramesSinceChange    = 0 ;
+    return true ;
+}
+
+// Public functions --------------------------------------------------------------
+
+QualityGovernor::QualityGovernor()
+    : mStepTargetMs( 0.0f )
+    , mHysteresis( 0.15f )
+    , mSmoothing( 0.2f )
+    , mQualityStep( 0.125f )
+    , mNumSettleFrames( 8 )
+    , mMinGridPointsPerVorton( 0.25f )
+    , mMaxGridPointsPerVorton( 1.0f )
+    , mMinOpeningAngle( 0.5f )
+    , mMaxOpeningAngle( 2.0f )
+    , mMinPoissonIterations( 2 )
+    , mMaxPoissonIterations( 8 )
+    , mVortonBudget( 0 )
+    , mMinVortonBudgetFraction( 0.25f )
+    , mTracerEmitRate( 0.0f )
+    , mMinTracerEmitRateFraction( 0.25f )
+    , mSimulationQuality( 1.0f )
+    , mTracerQuality( 1.0f )
+    , mSmoothedSimulationLoad( 1.0f )
+    , mSmoothedTracerLoad( 1.0f )
+    , mNumFramesSinceSimulationChange( 0 )
+    , mNumFramesSinceTracerChange( 0 )
+    , mNumVortonsAtFullQuality( 0 )
+{
+    memset( mStageTargetMs , 0 , sizeof( mStageTargetMs ) ) ;
+}
+
+
+
+
+/** Compare durations of the most recent step with targets, and adjust settings accordingly.
+
+    \param vortonSim        Simulation whose stage durations to read, and whose settings to adjust.
+
+    \param tracerEmitter    Emitter whose rate to adjust.
+
+    \param stepDuration     Wall-clock seconds the whole step took.
+
+    \param memoryBudget     Memory usage and caps, as of the most recent step.
+
+    Call this once per step, after updating the simulation and reporting
+    its memory usage.  Settings changed here take effect in the next step.
+*/
+void QualityGovernor::Update( VortonSim & vortonSim , PclOpEmit & tracerEmitter , float stepDuration , const MemoryBudget & memoryBudget )
+{
+    PERF_BLOCK( QualityGovernor__Update ) ;
+
+    static const MemoryBudget::SubsystemE simulationSubsystems[] =
+    {
+        MemoryBudget::SUBSYSTEM_GRIDS , MemoryBudget::SUBSYSTEM_MULTIGRIDS , MemoryBudget::SUBSYSTEM_INFLUENCE_TREE , MemoryBudget::SUBSYSTEM_VORTON_PARTITION , MemoryBudget::SUBSYSTEM_VORTONS
+    } ;
+    static const MemoryBudget::SubsystemE tracerSubsystems[] =
+    {
+        MemoryBudget::SUBSYSTEM_TRACERS , MemoryBudget::SUBSYSTEM_RENDER_BUFFERS , MemoryBudget::SUBSYSTEM_RENDER_TEXTURES
+    } ;
+
+    float   simulationLoad          = 0.0f ;
+    bool    hasSimulationTarget     = false ;
+    for( unsigned iStage = 0 ; iStage < VortonSim::NUM_UPDATE_STAGES ; ++ iStage )
+    {   // For each stage of VortonSim::Update...
+        if( mStageTargetMs[ iStage ] > 0.0f )
+        {   // Stage has a target.
+            const float durationMs = 1000.0f * vortonSim.GetUpdateStageDuration( VortonSim::UpdateStageE( iStage ) ) ;
+            simulationLoad      = Max2( simulationLoad , durationMs / mStageTargetMs[ iStage ] ) ;
+            hasSimulationTarget = true ;
+        }
+    }
+    float simulationMemoryLoad = 0.0f ;
+    if( AccumulateMemoryLoad( simulationMemoryLoad , memoryBudget , simulationSubsystems , sizeof( simulationSubsystems ) / sizeof( simulationSubsystems[ 0 ] ) ) )
+    {
+        simulationLoad      = Max2( simulationLoad , simulationMemoryLoad ) ;
+        hasSimulationTarget = true ;
+    }
+
+    if( hasSimulationTarget )
+    {
+        mSmoothedSimulationLoad = Interpolate( mSmoothedSimulationLoad , simulationLoad , mSmoothing ) ;
+        if( StepQuality( mSimulationQuality , mNumFramesSinceSimulationChange , mSmoothedSimulationLoad , mHysteresis , mQualityStep , mNumSettleFrames ) )
+        {
+            ApplySimulationQuality( vortonSim ) ;
+        }
+        if( simulationMemoryLoad > 1.0f )
+        {   // Simulation memory exceeds its cap.  Grids only grow, so release what previous, finer grids needed, so usage can follow quality down.
+            vortonSim.TrimMemory() ;
+        }
+    }
+
+    float   tracerLoad          = 0.0f ;
+    bool    hasTracerTarget     = AccumulateMemoryLoad( tracerLoad , memoryBudget , tracerSubsystems , sizeof( tracerSubsystems ) / sizeof( tracerSubsystems[ 0 ] ) ) ;
+    if( mStepTargetMs > 0.0f )
+    {
+        tracerLoad      = Max2( tracerLoad , 1000.0f * stepDuration / mStepTargetMs ) ;
+        hasTracerTarget = true ;
+    }
+
+    if( hasTracerTarget )
+    {
+        mSmoothedTracerLoad = Interpolate( mSmoothedTracerLoad , tracerLoad , mSmoothing ) ;
+        if( StepQuality( mTracerQuality , mNumFramesSinceTracerChange , mSmoothedTracerLoad , mHysteresis , mQualityStep , mNumSettleFrames ) )
+        {
+            ApplyTracerQuality( tracerEmitter ) ;
+        }
+    }
+}
+
+
+
+
+/** Assign simulation settings corresponding to mSimulationQuality.
+*/
+void QualityGovernor::ApplySimulationQuality( VortonSim & vortonSim )
+{
+    const float quality = mSimulationQuality ;
+
+    vortonSim.SetGridPointsPerVorton( Interpolate( mMinGridPointsPerVorton , mMaxGridPointsPerVorton , quality ) ) ;
+
+    VortonSim::TreeOpeningCriterion criterion = vortonSim.GetTreeOpeningCriterion() ;
+    criterion.mOpeningAngle = Interpolate( mMaxOpeningAngle , mMinOpeningAngle , quality ) ;
+    vortonSim.SetTreeOpeningCriterion( criterion ) ;
+
+#if ENABLE_VORTON_LOD
+    const size_t numVortons = vortonSim.GetVortons() ? vortonSim.GetVortons()->Size() : 0 ;
+#endif
+    if( quality >= 1.0f )
+    {   // Full quality.
+        vortonSim.SetMaxPoissonIterations( 0 ) ;
+    #if ENABLE_VORTON_LOD
+        vortonSim.SetVortonBudget( mVortonBudget ) ;
+    #endif
+        mNumVortonsAtFullQuality = 0 ;
+        return ;
+    }
+
+    vortonSim.SetMaxPoissonIterations( unsigned( Interpolate( float( mMinPoissonIterations ) , float( mMaxPoissonIterations ) , quality ) + 0.5f ) ) ;
+
+#if ENABLE_VORTON_LOD
+    if( ( 0 == mVortonBudget ) && ( 0 == mNumVortonsAtFullQuality ) )
+    {   // Quality just dropped below full, and full quality has no budget, so budget relative to vortons present now.
+        mNumVortonsAtFullQuality = numVortons ;
+    }
+    const size_t fullBudget = ( mVortonBudget > 0 ) ? mVortonBudget : mNumVortonsAtFullQuality ;
+    if( fullBudget > 0 )
+    {
+        const float budgetFraction = Interpolate( mMinVortonBudgetFraction , 1.0f , quality ) ;
+        vortonSim.SetVortonBudget( Max2( size_t( float( fullBudget ) * budgetFraction ) , size_t( 1 ) ) ) ;
+    }
+#endif
+}
+
+
+
+
+/** Assign tracer settings corresponding to mTracerQuality.
+*/
+void QualityGovernor::ApplyTracerQuality( PclOpEmit & tracerEmitter )
+{
+    if( mTracerEmitRate <= 0.0f )
+    {   // Caller did not specify a full-quality rate, so leave emitter alone.
+        return ;
+    }
+    tracerEmitter.mEmitRate = mTracerEmitRate * Interpolate( mMinTracerEmitRateFraction , 1.0f , mTracerQuality ) ;
+}
@@ -0,0 +1,97 @@
+/** \file qualityGovernor.h
+
+    \brief Feedback controller that adapts simulation quality to keep frame time near a budget.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include "VortonFluid/vortonSim.h"
+#include "Core/Performance/memoryBudget.h"
+
+class PclOpEmit ;
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Feedback controller that adapts simulation quality to keep frame time near a budget.
+
+    When hosts vary in load, fixed settings make latency vary.  This
+    measures how long each update took, compares that with targets, and
+    adjusts settings so latency stays steady while quality varies.
+
+    Two quality levels, each in [0,1], drive the settings:
+
+    - Simulation quality follows the largest ratio, across stages of
+      VortonSim::Update, of duration to that stage's target in
+      mStageTargetMs.  It sets grid resolution (grid points per vorton),
+      treecode opening angle, Poisson iteration count and vorton budget.
+
+    - Tracer quality follows the ratio of whole step duration to
+      mStepTargetMs.  It sets the tracer emission rate.
+
+    Memory caps in MemoryBudget count as more ratios:  Usage over cap of
+    grids, multigrids, influence tree, vorton partition and vortons joins
+    the simulation ratios, and that of tracers and render resources joins
+    the tracer ratio.  Grids retain memory for reuse, so while simulation
+    memory exceeds its cap, Update also has VortonSim release what coarser
+    grids no longer need.
+
+    To prevent oscillation, each level responds to a smoothed ratio, holds
+    steady while that ratio lies within mHysteresis of one, and changes by
+    at most mQualityStep every mNumSettleFrames, which gives the previous
+    change (for example a new grid resolution) time to show in the timings.
+
+    All targets default to zero, which leaves every setting alone.
+*/
+class QualityGovernor
+{
+    public:
+        QualityGovernor() ;
+
+        void    Update( VortonSim & vortonSim , PclOpEmit & tracerEmitter , float stepDuration , const MemoryBudget & memoryBudget ) ;
+
+        /// Return current simulation quality, from 0 (cheapest) to 1 (full).
+        float   GetSimulationQuality() const    { return mSimulationQuality ; }
+
+        /// Return current tracer quality, from 0 (cheapest) to 1 (full).
+        float   GetTracerQuality() const        { return mTracerQuality ; }
+
+        float       mStageTargetMs[ VortonSim::NUM_UPDATE_STAGES ] ;    ///< Target wall-clock milliseconds for each stage of VortonSim::Update.  Zero leaves a stage unconstrained.
+        float       mStepTargetMs               ;   ///< Target wall-clock milliseconds for each whole step.  Zero leaves tracer emission alone.
+        float       mHysteresis                 ;   ///< Fraction of target by which smoothed duration must miss it before quality changes.
+        float       mSmoothing                  ;   ///< Weight of each new measurement in the smoothed duration ratio, in (0,1].
+        float       mQualityStep                ;   ///< Amount by which quality changes at a time.
+        unsigned    mNumSettleFrames            ;   ///< Minimum number of updates between quality changes.
+
+        float       mMinGridPointsPerVorton     ;   ///< Grid points per vorton at lowest simulation quality.
+        float       mMaxGridPointsPerVorton     ;   ///< Grid points per vorton at full simulation quality.
+        float       mMinOpeningAngle            ;   ///< Treecode opening angle at full simulation quality.  Smaller is more accurate.
+        float       mMaxOpeningAngle            ;   ///< Treecode opening angle at lowest simulation quality.
+        unsigned    mMinPoissonIterations       ;   ///< Poisson iterations at lowest simulation quality.  Full quality lets the solver choose.
+        unsigned    mMaxPoissonIterations       ;   ///< Poisson iterations just below full simulation quality.
+        size_t      mVortonBudget               ;   ///< Vorton budget at full simulation quality.  Zero means unlimited, and lower quality budgets a fraction of vortons present when quality first dropped.
+        float       mMinVortonBudgetFraction    ;   ///< Fraction of full vorton budget at lowest simulation quality.
+        float       mTracerEmitRate             ;   ///< Tracer emission rate at full tracer quality.
+        float       mMinTracerEmitRateFraction  ;   ///< Fraction of mTracerEmitRate at lowest tracer quality.
+
+    private:
+        void    ApplySimulationQuality( VortonSim & vortonSim ) ;
+        void    ApplyTracerQuality( PclOpEmit & tracerEmitter ) ;
+
+        float       mSimulationQuality          ;   ///< Current simulation quality, in [0,1].
+        float       mTracerQuality              ;   ///< Current tracer quality, in [0,1].
+        float       mSmoothedSimulationLoad     ;   ///< Smoothed largest ratio of stage duration to target, or of memory usage to cap.
+        float       mSmoothedTracerLoad         ;   ///< Smoothed largest ratio of step duration to target, or of memory usage to cap.
+        unsigned    mNumFramesSinceSimulationChange ;   ///< Number of updates since simulation quality last changed.
+        unsigned    mNumFramesSinceTracerChange ;   ///< Number of updates since tracer quality last changed.
+        size_t      mNumVortonsAtFullQuality    ;   ///< Number of vortons when simulation quality dropped below full, when mVortonBudget is zero.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
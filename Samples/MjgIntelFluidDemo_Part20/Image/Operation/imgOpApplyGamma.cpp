@@ -8,11 +8,10 @@
 */
 
 #include "Image/Operation/imgOpApplyGamma.h"
+#include "Image/Operation/imgOpLookUpTable.h"
 
 #include "Core/Performance/perfBlock.h"
 
-#include <math.h>
-
 #if defined( WIN32 )
 #   include <windows.h>
 #endif
@@ -21,6 +20,8 @@ namespace PeGaSys
 {
 
     /** Apply "gamma" brightness correction to the given image data.
+
+        Output depends only on input value, so this computes each of the 256 possible results once, then looks them up.
     */
     Image & ImgOpApplyGamma::ApplyGamma( Image & image , float gamma )
     {
@@ -28,20 +29,7 @@ namespace PeGaSys
 
         ASSERT( image.GetNumChannels() >= 3 ) ; // Current implementation only supports images with at least 3 channels. TODO: FIXME.
 
-        const unsigned xStride = image.GetXStride() ;
-        const unsigned yStride = image.GetYStride() ;
-        for( unsigned iy = 0 ; iy < image.GetHeight() ; ++ iy )
-        {
-            for( unsigned ix = 0 ; ix < image.GetWidth() ; ++ ix )
-            {
-                const unsigned  offset  = xStride * ix + yStride * iy ;
-                image[ offset + 0 ] = PixelInt( powf( PixelFloat( image[ offset + 0 ] ) , gamma ) ) ;
-                image[ offset + 1 ] = PixelInt( powf( PixelFloat( image[ offset + 1 ] ) , gamma ) ) ;
-                image[ offset + 2 ] = PixelInt( powf( PixelFloat( image[ offset + 2 ] ) , gamma ) );
-            }
-        }
-
-        return image ;
+        return ImgOpLookUpTable::LookUp( image , ImgOpLookUpTable().ComposeGamma( gamma ) ) ;
     }
 
 } ;
\ No newline at end of file
@@ -9,16 +9,12 @@
 
 #pragma optimize( "" , on ) // This operation is ludicrously slow so optimize it even in non-opt builds.
 
-// This operation is ludicrously slow so optionally disable asserts inside inner loops.
-#if 0 && _DEBUG
-#   define INNER_LOOP_ASSERT( cond ) ASSERT( cond )
-#else
-#   define INNER_LOOP_ASSERT( cond )
-#endif
-
 #include "Image/Operation/imgOpBlur.h"
 
 #include "Core/Performance/perfBlock.h"
+#include "Core/parallelExecution.h"
+
+#include <math.h>
 
 #if defined( WIN32 )
 #   include <windows.h>
@@ -27,176 +23,236 @@
 namespace PeGaSys
 {
 
-    /** Blur the given image pixel in the interior of an image.
-    */
-    static inline unsigned char blurInterior3x3( int ix , int iy , int ic , const unsigned char * img , int nx , int ny , int nc )
-    {
-        const unsigned ixOff =   ix       * nc + ic ;
-        const unsigned ixm1  = ( ix - 1 ) * nc + ic ;
-        const unsigned ixp1  = ( ix + 1 ) * nc + ic ;
-        const unsigned nl    = nx * nc ;         // y stride, the number of bytes between vertically adjacent pixels. TODO: FIXME: pass this in as a parameter because for cropped images, yStride might not be nx*nc.
-        const unsigned iyOff =   iy       * nl ;
-        const unsigned iym1  = ( iy - 1 ) * nl ;
-        const unsigned iyp1  = ( iy + 1 ) * nl ;
-
-        INNER_LOOP_ASSERT( ( ix > 0 ) && ( ix < ( nx - 1 ) ) && ( iy > 0 ) && ( iy < ( ny - 1 ) ) ) ;
-        UNUSED_PARAM( ny ) ; // Avoid compiler warning in builds where INNER_LOOP_ASSERT is defined as a do-nothing operation.
-
-        unsigned iOut   =
-              img[ ixm1  + iym1  ]
-            + img[ ixOff + iym1  ]
-            + img[ ixp1  + iym1  ]
-            + img[ ixm1  + iyOff ]
-            + img[ ixOff + iyOff ]
-            + img[ ixp1  + iyOff ]
-            + img[ ixm1  + iyp1  ]
-            + img[ ixOff + iyp1  ]
-            + img[ ixp1  + iyp1  ] ;
-
-            const unsigned      average = iOut / 9 ;
-            INNER_LOOP_ASSERT( average <= 255 ) ;
-            const unsigned char result  = static_cast< unsigned char >( average ) ;
-            return result ;
-    }
+    /// Number of leading channels that blurring affects.  Others (i.e. alpha) pass through unchanged.
+    static const unsigned sNumBlurredChannels = 3 ;
+
+
+
+
+    /** Blur a line of pixels with a box filter, using a sliding window, so the cost per pixel does not depend on radius.
+
+        \param src          Address of first source pixel.
 
+        \param dst          Address of first destination pixel.  Must not overlap src.
 
+        \param numPixels    Number of pixels in line.
 
+        \param pixelStride  Number of bytes between adjacent pixels in line.
 
-    /** Blur the given image pixel, which could be at an edge (including corners).
+        \param numChannels  Number of channels per pixel.
+
+        \param radius       Number of pixels on each side of a pixel that its window includes.
+
+        Windows that would extend beyond the line include only pixels inside it,
+        so pixels near the ends average fewer pixels, instead of darkening.
     */
-    static inline unsigned char blurEdge3x3( int ix , int iy , int ic , const unsigned char * img , int nx , int ny , int nc )
+    static void BoxBlurLine( const unsigned char * src , unsigned char * dst , unsigned numPixels , unsigned pixelStride , unsigned numChannels , unsigned radius )
     {
-        const unsigned ixOff = ix * nc + ic ;
-        const unsigned nl    = nx * nc ;         // y stride, the number of bytes between vertically adjacent pixels. TODO: FIXME: pass this in as a parameter because for cropped images, yStride might not be nx*nc.
-        const unsigned iyOff = iy * nl ;
-        const unsigned iym1  = ( iy - 1 ) * nl ;
-        const unsigned iyp1  = ( iy + 1 ) * nl ;
-
-        unsigned iCounter = 1 ;
-        unsigned iOut     = img[ ixOff + iyOff ] ;
+        unsigned sums[ sNumBlurredChannels ] = { 0 , 0 , 0 } ;
 
-        if( ix > 0 )
+        // Prime window with pixels [0,radius].
+        const unsigned lastInFirstWindow = Min2( radius , numPixels - 1 ) ;
+        for( unsigned i = 0 ; i <= lastInFirstWindow ; ++ i )
         {
-            const unsigned ixm1 = ( ix - 1 ) * nc + ic ;
-            iOut += img[ ixm1 + iyOff ] ; iCounter ++ ;
-            if( iy > 0 )
-            {
-                iOut += img[ ixm1 + iym1  ] ; iCounter ++ ;
+            const unsigned char * pixel = src + i * pixelStride ;
+            sums[ 0 ] += pixel[ 0 ] ;
+            sums[ 1 ] += pixel[ 1 ] ;
+            sums[ 2 ] += pixel[ 2 ] ;
+        }
+        unsigned count = lastInFirstWindow + 1 ;
+
+        for( unsigned i = 0 ; i < numPixels ; ++ i )
+        {   // For each pixel in line...
+            const unsigned char *   pixelIn     = src + i * pixelStride ;
+            unsigned char *         pixelOut    = dst + i * pixelStride ;
+            const unsigned          halfCount   = count / 2 ;   // Round to nearest, so repeated passes do not darken.
+            pixelOut[ 0 ] = static_cast< unsigned char >( ( sums[ 0 ] + halfCount ) / count ) ;
+            pixelOut[ 1 ] = static_cast< unsigned char >( ( sums[ 1 ] + halfCount ) / count ) ;
+            pixelOut[ 2 ] = static_cast< unsigned char >( ( sums[ 2 ] + halfCount ) / count ) ;
+            for( unsigned ic = sNumBlurredChannels ; ic < numChannels ; ++ ic )
+            {   // For each channel not blurred...
+                pixelOut[ ic ] = pixelIn[ ic ] ;
             }
-            if( iy < ( ny - 1 ) )
-            {
-                iOut += img[ ixm1 + iyp1  ] ; iCounter ++ ;
+
+            // Slide window.
+            if( i + radius + 1 < numPixels )
+            {   // Window gains a pixel on its leading side.
+                const unsigned char * pixel = src + ( i + radius + 1 ) * pixelStride ;
+                sums[ 0 ] += pixel[ 0 ] ;
+                sums[ 1 ] += pixel[ 1 ] ;
+                sums[ 2 ] += pixel[ 2 ] ;
+                ++ count ;
             }
-        }
-        if( ix < ( nx - 1 ) )
-        {
-            const unsigned ixp1 = ( ix + 1 ) * nc + ic ;
-            iOut += img[ ixp1 + iyOff ] ; iCounter ++ ;
-            if( iy > 0 )
-            {
-                iOut += img[ ixp1 + iym1  ] ; iCounter ++ ;
+            if( i >= radius )
+            {   // Window loses a pixel on its trailing side.
+                const unsigned char * pixel = src + ( i - radius ) * pixelStride ;
+                sums[ 0 ] -= pixel[ 0 ] ;
+                sums[ 1 ] -= pixel[ 1 ] ;
+                sums[ 2 ] -= pixel[ 2 ] ;
+                -- count ;
             }
-            if( iy < ( ny - 1 ) )
+        }
+    }
+
+
+
+
+    /** Function object to box-blur a range of lines, for Parallel::For.
+
+        Each line reads only source and writes only its own destination pixels, so lines can run concurrently.
+    */
+    class ImgOpBlur_BoxBlurLines
+    {
+        public:
+            ImgOpBlur_BoxBlurLines( const unsigned char * src , unsigned char * dst , unsigned lineStride , unsigned numPixels , unsigned pixelStride , unsigned numChannels , unsigned radius )
+                : mSrc( src ) , mDst( dst ) , mLineStride( lineStride ) , mNumPixels( numPixels ) , mPixelStride( pixelStride ) , mNumChannels( numChannels ) , mRadius( radius )
+            {}
+
+            void operator()( const Parallel::Range & r ) const
             {
-                iOut += img[ ixp1 + iyp1  ] ; iCounter ++ ;
+                for( size_t iLine = r.begin() ; iLine < r.end() ; ++ iLine )
+                {   // For each line in this subrange...
+                    BoxBlurLine( mSrc + iLine * mLineStride , mDst + iLine * mLineStride , mNumPixels , mPixelStride , mNumChannels , mRadius ) ;
+                }
             }
-        }
-        if( iy > 0 )
-        {
-            iOut += img[ ixOff + iym1 ] ; iCounter ++ ;
-        }
-        if( iy < ( ny - 1 ) )
-        {
-            iOut += img[ ixOff + iyp1 ] ; iCounter ++ ;
-        }
-        const unsigned      average = iOut / iCounter ;
-        const unsigned char result  = static_cast< unsigned char >( Min2( average , 255U ) ) ;
-        return result ;
+
+        private:
+            ImgOpBlur_BoxBlurLines & operator=( const ImgOpBlur_BoxBlurLines & ) ; // Disallow assignment
+
+            const unsigned char *   mSrc            ;   ///< Address of first pixel of first source line.
+            unsigned char *         mDst            ;   ///< Address of first pixel of first destination line.
+            const unsigned          mLineStride     ;   ///< Number of bytes between first pixels of adjacent lines.
+            const unsigned          mNumPixels      ;   ///< Number of pixels per line.
+            const unsigned          mPixelStride    ;   ///< Number of bytes between adjacent pixels in a line.
+            const unsigned          mNumChannels    ;   ///< Number of channels per pixel.
+            const unsigned          mRadius         ;   ///< Half-width of box filter, in pixels.
+    } ;
+
+
+
+
+    /** Blur the given image with one separable box filter pass.
+
+        \param image        Image to blur.
+
+        \param workspace    Image with the same shape as image, to hold the horizontally blurred intermediate.
+
+        \param radius       Half-width of box filter, in pixels.
+    */
+    static void BoxBlurPass( Image & image , Image & workspace , unsigned radius )
+    {
+        unsigned char * const   imgData     = image.GetImageData() ;
+        unsigned char * const   workData    = workspace.GetImageData() ;
+        const unsigned          xStride     = image.GetXStride() ;
+        const unsigned          yStride     = image.GetYStride() ;
+        const unsigned          width       = image.GetWidth() ;
+        const unsigned          height      = image.GetHeight() ;
+        const unsigned          numChannels = image.GetNumChannels() ;
+
+        // Blur each row, from image into workspace.
+        Parallel::For( 0 , height , Max2( size_t( 1 ) , size_t( height / gNumberOfProcessors ) ) , ImgOpBlur_BoxBlurLines( imgData , workData , yStride , width , xStride , numChannels , radius ) ) ;
+
+        // Blur each column, from workspace back into image.
+        Parallel::For( 0 , width , Max2( size_t( 1 ) , size_t( width / gNumberOfProcessors ) ) , ImgOpBlur_BoxBlurLines( workData , imgData , xStride , height , yStride , numChannels , radius ) ) ;
     }
 
 
 
 
-    /** Blur the given image.
+    /** Blur the given image with a box filter, repeatedly.
 
-        \todo TODO: FIXME: Replace numSmoothingPasses with a blur kernel size.
+        \param radius       Half-width of box filter, in pixels.  Each output pixel averages (2*radius+1)^2 input pixels.
+
+        \param numPasses    Number of times to apply the filter.
+
+        Each pass filters rows then columns with a sliding window, so costs
+        a constant amount per pixel regardless of radius, and runs rows (then
+        columns) concurrently.  Only RGB channels blur; alpha passes through.
     */
-    Image & ImgOpBlur::Blur( Image & image , unsigned numSmoothingPasses )
+    Image & ImgOpBlur::BoxBlur( Image & image , unsigned radius , unsigned numPasses )
     {
-        PERF_BLOCK( ImgOpBlur__Blur ) ;
+        PERF_BLOCK( ImgOpBlur__BoxBlur ) ;
 
         ASSERT( 1 == image.GetNumPages() ) ;
+        ASSERT( image.GetNumChannels() >= sNumBlurredChannels ) ; // TODO: FIXME: Current implementation assumes image has at least 3 channels.
 
-        ASSERT( image.GetNumChannels() >= 3 ) ; // TODO: FIXME: Current implementation assumes image has at least 3 channels.
+        if( ( 0 == radius ) || ( 0 == numPasses ) || ( 0 == image.GetWidth() ) || ( 0 == image.GetHeight() ) )
+        {   // Nothing to blur.
+            return image ;
+        }
 
-        unsigned char * imgData = image.GetImageData() ;
+        // Horizontal blur writes here then vertical blur reads from here,
+        // because each formula would otherwise mix blurred and non-blurred pixels.
+        Image workspace ;
+        workspace.CopyShape( image ) ;
 
-        // Create a temp space to write blurred pixels.
-        // This routine reads from the source image and writes to the temp space.
-        // This is because the blur formula would otherwise mix blurred and non-blurred pixels.
-        Image workspace( image ) ;
+        for( unsigned iPass = 0 ; iPass < numPasses ; ++ iPass )
+        {   // For each pass...
+            BoxBlurPass( image , workspace , radius ) ;
+        }
 
-        const unsigned xStride      = image.GetXStride() ;
-        const unsigned yStride      = image.GetYStride() ;
-        const unsigned width        = image.GetWidth() ;
-        const unsigned widthMinus1  = image.GetWidth() - 1 ;
-        const unsigned height       = image.GetHeight() ;
-        const unsigned heightMinus1 = image.GetHeight() - 1 ;
-        const unsigned numChannels  = image.GetNumChannels() ;
+        return image ;
+    }
 
-        DEBUG_ONLY( const size_t offsetLimit = yStride * height  ; (void) offsetLimit ) ;
 
-        for( unsigned iSmooth = 0 ; iSmooth < numSmoothingPasses ; ++ iSmooth )
-        {   // For each smoothing pass...
 
-            // Blur interior.
-            for( unsigned iy = 1 ; iy < heightMinus1 ; ++ iy )
-            {
-                for( unsigned ix = 1 ; ix < widthMinus1 ; ++ ix )
-                {
-                    const unsigned  offset  = xStride * ix + yStride * iy ;
-                    INNER_LOOP_ASSERT( offset + 2 < offsetLimit ) ;   // Paranoid sanity check; make sure pixel is inside image.
-                    workspace[ offset + 0 ] = blurInterior3x3( ix , iy , 0 , imgData , width , height , numChannels ) ;
-                    workspace[ offset + 1 ] = blurInterior3x3( ix , iy , 1 , imgData , width , height , numChannels ) ;
-                    workspace[ offset + 2 ] = blurInterior3x3( ix , iy , 2 , imgData , width , height , numChannels ) ;
-                    // Note the lack of smoothing in the 4th channel.  See TODO above.
-                }
-            }
 
-            // Blur adjacent pixels with current one, checking to make sure adjacent pixels are inside image bounds.
-#           define BLUR_EDGE_PIXEL( IX , IY )                                                                       \
-            {                                                                                                       \
-                const unsigned offset = xStride * (IX) + yStride * (IY) ;                                           \
-                INNER_LOOP_ASSERT( offset + 2 < offsetLimit ) ;                                                     \
-                workspace[ offset + 0 ] = blurEdge3x3( (IX) , (IY) , 0 , imgData , width , height , numChannels ) ; \
-                workspace[ offset + 1 ] = blurEdge3x3( (IX) , (IY) , 1 , imgData , width , height , numChannels ) ; \
-                workspace[ offset + 2 ] = blurEdge3x3( (IX) , (IY) , 2 , imgData , width , height , numChannels ) ; \
-            }
+    /** Blur the given image with an approximately Gaussian filter.
 
-            // Blur edges except corners.
-            for( unsigned ix = 1 ; ix < widthMinus1 ; ++ ix )
-            {   // Blur top and bottom edges except corners.
-                BLUR_EDGE_PIXEL( ix , 0            ) ;
-                BLUR_EDGE_PIXEL( ix , heightMinus1 ) ;
-            }
-            for( unsigned iy = 1 ; iy < heightMinus1 ; ++ iy )
-            {   // Blur left and right edges except corners.
-                BLUR_EDGE_PIXEL( 0           , iy ) ;
-                BLUR_EDGE_PIXEL( widthMinus1 , iy ) ;
-            }
+        \param standardDeviation    Standard deviation of Gaussian, in pixels.
 
-            // Blur corners.
-            BLUR_EDGE_PIXEL( 0            , 0            ) ;
-            BLUR_EDGE_PIXEL( widthMinus1  , 0            ) ;
-            BLUR_EDGE_PIXEL( 0            , heightMinus1 ) ;
-            BLUR_EDGE_PIXEL( widthMinus1  , heightMinus1 ) ;
+        This applies 3 box filters whose widths are chosen so that their
+        combined variance matches that of the Gaussian, so the cost per pixel
+        does not depend on standardDeviation.
 
-            // Transfer blurred image from temp workspace to texture.
-            // TODO: FIXME: Avoid this copy or at least avoid doing it once per blur pass.  E.g. could swap workspace and original buffers every other pass rather than copy, then copy on last pass from workspace to original.
-            image.CopyImageData( workspace ) ;
-        }
+        \see Wells, "Efficient synthesis of Gaussian filters by cascaded uniform filters", IEEE PAMI 1986.
+    */
+    Image & ImgOpBlur::GaussianBlur( Image & image , float standardDeviation )
+    {
+        PERF_BLOCK( ImgOpBlur__GaussianBlur ) ;
+
+        static const unsigned sNumBoxes = 3 ;
+        const float variance = standardDeviation * standardDeviation ;
+
+        // A box of odd width w has variance (w^2-1)/12, so n boxes of width wIdeal would match.
+        // Widths must be odd integers, so use some boxes of the odd width just below wIdeal and the rest of the next odd width.
+        const float     wIdeal      = sqrtf( 12.0f * variance / float( sNumBoxes ) + 1.0f ) ;
+        int             widthLower  = int( wIdeal ) ;
+        if( 0 == ( widthLower % 2 ) ) -- widthLower ;
+        widthLower = Max2( widthLower , 1 ) ;
+        const int       widthUpper  = widthLower + 2 ;
+        const float     numLowerF   = ( 12.0f * variance - float( sNumBoxes * widthLower * widthLower ) - float( 4 * sNumBoxes * widthLower ) - float( 3 * sNumBoxes ) ) / float( - 4 * widthLower - 4 ) ;
+        const unsigned  numLower    = unsigned( Clamp( floorf( numLowerF + 0.5f ) , 0.0f , float( sNumBoxes ) ) ) ;
+
+        BoxBlur( image , unsigned( widthLower - 1 ) / 2 , numLower ) ;
+        BoxBlur( image , unsigned( widthUpper - 1 ) / 2 , sNumBoxes - numLower ) ;
 
         return image ;
     }
 
-}
\ No newline at end of file
+
+
+
+    /** Blur the given image as much as the given number of 3x3 box filter passes would.
+
+        \param numSmoothingPasses   Number of 3x3 box filter passes to emulate.
+
+        A few passes apply the 3x3 box filter directly.  More passes would
+        approach a Gaussian with the same variance (2/3 pixel^2 per pass), so
+        this applies that instead, which costs the same regardless of numSmoothingPasses.
+
+        \todo TODO: FIXME: Replace numSmoothingPasses with a blur kernel size.
+    */
+    Image & ImgOpBlur::Blur( Image & image , unsigned numSmoothingPasses )
+    {
+        PERF_BLOCK( ImgOpBlur__Blur ) ;
+
+        static const unsigned sMaxDirectPasses = 3 ; // GaussianBlur costs 3 box passes, so fewer passes than that are cheaper to apply directly.
+        if( numSmoothingPasses <= sMaxDirectPasses )
+        {
+            return BoxBlur( image , 1 , numSmoothingPasses ) ;
+        }
+        return GaussianBlur( image , sqrtf( float( numSmoothingPasses ) * 2.0f / 3.0f ) ) ;
+    }
+
+}
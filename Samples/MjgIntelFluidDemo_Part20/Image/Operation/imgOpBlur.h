@@ -31,6 +31,8 @@ namespace PeGaSys
             }
 
             static Image & Blur( Image & image , unsigned numSmoothingPasses ) ;
+            static Image & BoxBlur( Image & image , unsigned radius , unsigned numPasses = 1 ) ;
+            static Image & GaussianBlur( Image & image , float standardDeviation ) ;
 
             virtual Image & operator()( Image & image )
             {
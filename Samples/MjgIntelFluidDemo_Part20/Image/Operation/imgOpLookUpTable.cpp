@@ -0,0 +1,129 @@
+/** \file imgOpLookUpTable.cpp
+
+    \brief Operation to remap each channel of an image through a look-up table.
+
+    \author Copyright 2012-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "Image/Operation/imgOpLookUpTable.h"
+
+#include "Core/Performance/perfBlock.h"
+#include "Core/parallelExecution.h"
+
+#include <math.h>
+
+#if defined( WIN32 )
+#   include <windows.h>
+#endif
+
+namespace PeGaSys
+{
+
+    /** Function object to look up a range of rows of an image, for Parallel::For.
+    */
+    class ImgOpLookUpTable_Rows
+    {
+        public:
+            ImgOpLookUpTable_Rows( Image & image , const ImgOpLookUpTable & table )
+                : mImage( image ) , mTable( table )
+            {}
+
+            void operator()( const Parallel::Range & r ) const
+            {
+                unsigned char * const   imgData     = mImage.GetImageData() ;
+                const unsigned          xStride     = mImage.GetXStride() ;
+                const unsigned          yStride     = mImage.GetYStride() ;
+                const unsigned          width       = mImage.GetWidth() ;
+                const unsigned          numChannels = Min2( mImage.GetNumChannels() , ImgOpLookUpTable::sMaxNumChannels ) ;
+                for( size_t iy = r.begin() ; iy < r.end() ; ++ iy )
+                {   // For each row in this subrange...
+                    unsigned char * row = imgData + iy * yStride ;
+                    for( unsigned ic = 0 ; ic < numChannels ; ++ ic )
+                    {   // For each channel...
+                        // Visit one channel at a time so the inner loop uses one 256-byte table, which stays in L1 cache.
+                        const unsigned char * table = mTable.GetTable( ic ) ;
+                        for( unsigned ix = 0 ; ix < width ; ++ ix )
+                        {   // For each pixel in row...
+                            unsigned char & value = row[ ix * xStride + ic ] ;
+                            value = table[ value ] ;
+                        }
+                    }
+                }
+            }
+
+        private:
+            ImgOpLookUpTable_Rows & operator=( const ImgOpLookUpTable_Rows & ) ; // Disallow assignment
+
+            Image &                     mImage  ;   ///< Image to remap.
+            const ImgOpLookUpTable &    mTable  ;   ///< Tables through which to remap image.
+    } ;
+
+
+
+
+    /** Construct identity look-up table, which leaves images unchanged.
+    */
+    ImgOpLookUpTable::ImgOpLookUpTable()
+    {
+        for( unsigned ic = 0 ; ic < sMaxNumChannels ; ++ ic )
+        {   // For each channel...
+            for( unsigned value = 0 ; value < 256 ; ++ value )
+            {   // For each possible channel value...
+                mTables[ ic ][ value ] = static_cast< unsigned char >( value ) ;
+            }
+        }
+    }
+
+
+
+
+    /** Follow this table with "gamma" brightness correction of RGB channels, like ImgOpApplyGamma.
+    */
+    ImgOpLookUpTable & ImgOpLookUpTable::ComposeGamma( float gamma )
+    {
+        for( unsigned ic = 0 ; ic < 3 ; ++ ic )
+        {   // For each color channel...
+            for( unsigned value = 0 ; value < 256 ; ++ value )
+            {   // For each possible channel value...
+                mTables[ ic ][ value ] = PixelInt( powf( PixelFloat( mTables[ ic ][ value ] ) , gamma ) ) ;
+            }
+        }
+        return * this ;
+    }
+
+
+
+
+    /** Follow this table with a tint of all 4 channels, like ImgOpTint.
+    */
+    ImgOpLookUpTable & ImgOpLookUpTable::ComposeTint( const Vec4 & color )
+    {
+        const float factors[ sMaxNumChannels ] = { color.x , color.y , color.z , color.w } ;
+        for( unsigned ic = 0 ; ic < sMaxNumChannels ; ++ ic )
+        {   // For each channel...
+            for( unsigned value = 0 ; value < 256 ; ++ value )
+            {   // For each possible channel value...
+                mTables[ ic ][ value ] = PixelInt( PixelFloat( mTables[ ic ][ value ] ) * factors[ ic ] ) ;
+            }
+        }
+        return * this ;
+    }
+
+
+
+
+    /** Remap each channel of the given image through the given table, with rows running concurrently.
+    */
+    Image & ImgOpLookUpTable::LookUp( Image & image , const ImgOpLookUpTable & table )
+    {
+        PERF_BLOCK( ImgOpLookUpTable__LookUp ) ;
+
+        const unsigned height = image.GetHeight() ;
+        Parallel::For( 0 , height , Max2( size_t( 1 ) , size_t( height / gNumberOfProcessors ) ) , ImgOpLookUpTable_Rows( image , table ) ) ;
+
+        return image ;
+    }
+
+} ;
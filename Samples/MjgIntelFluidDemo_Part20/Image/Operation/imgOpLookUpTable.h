@@ -0,0 +1,61 @@
+/** \file imgOpLookUpTable.h
+
+    \brief Operation to remap each channel of an image through a look-up table.
+
+    \author Copyright 2012-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef PEGASYS_IMG_OP_LOOK_UP_TABLE_H
+#define PEGASYS_IMG_OP_LOOK_UP_TABLE_H
+
+#include "Core/Math/Vec4.h"
+#include "../image.h"
+#include "iImageOperation.h"
+
+namespace PeGaSys
+{
+
+    /** Operation to remap each channel of an image through a look-up table.
+
+        Any operation whose output channel value depends only on the input
+        value of that channel (such as gamma correction and tinting) is a
+        table of 256 entries per channel.  Composing such operations into one
+        table, then applying that, visits each pixel once instead of once per
+        operation, and replaces per-pixel arithmetic (such as powf) with a
+        load.  The results are identical to applying each operation in turn.
+    */
+    class ImgOpLookUpTable : public IImageOperation
+    {
+        public:
+            static const unsigned sMaxNumChannels = 4 ;     ///< Number of channels this has tables for.  Channels beyond these pass through unchanged.
+
+            ImgOpLookUpTable() ;
+
+            ImgOpLookUpTable &  ComposeGamma( float gamma ) ;
+            ImgOpLookUpTable &  ComposeTint( const Vec4 & color ) ;
+
+            static Image &      LookUp( Image & image , const ImgOpLookUpTable & table ) ;
+
+            virtual Image & operator()( Image & image )
+            {
+                return LookUp( image , * this ) ;
+            }
+
+            /// Return table for the given channel.
+            const unsigned char * GetTable( unsigned channelIndex ) const
+            {
+                ASSERT( channelIndex < sMaxNumChannels ) ;
+                return mTables[ channelIndex ] ;
+            }
+
+        private:
+            unsigned char   mTables[ sMaxNumChannels ][ 256 ]   ;   ///< Output value for each input value, for each channel.
+    } ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+} ;
+
+#endif
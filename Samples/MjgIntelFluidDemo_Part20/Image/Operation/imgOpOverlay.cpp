@@ -14,23 +14,141 @@
 #include "Core/Math/vec4.h"
 
 #include "ImgOpOverlay.h"
+#include "imgOpLookUpTable.h"
+
+#include "Core/Performance/perfBlock.h"
+#include "Core/parallelExecution.h"
+#include "Core/Containers/vector.h"
+
+/// Whether to use SSE2 intrinsics to blend 4 pixels at a time.  Otherwise, blend one channel at a time.
+#if defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) ) || defined( __SSE2__ )
+    #define IMG_OP_OVERLAY_USE_SSE2 1
+#else
+    #define IMG_OP_OVERLAY_USE_SSE2 0
+#endif
+
+#if IMG_OP_OVERLAY_USE_SSE2
+    #include <emmintrin.h>  // SSE2 intrinsics
+#endif
 
 namespace PeGaSys
 {
 
-    /** Composite a foreground image over a background image.
+    /** Return background channel value blended with foreground channel value, with given foreground opacity.
 
-        \param dstImage Image to populate. Can be either "this" or backgroundImage (or neither).
+        This returns round( ( background * ( 255 - opacity ) + foreground * opacity ) / 255 ),
+        computed in integers, exactly as the SSE2 path does, so both paths yield identical images.
+    */
+    static inline unsigned char BlendChannel( unsigned background , unsigned foreground , unsigned opacity )
+    {
+        const unsigned weightedSumPlusHalf = background * ( 255 - opacity ) + foreground * opacity + 128 ;
+        return static_cast< unsigned char >( ( weightedSumPlusHalf + ( weightedSumPlusHalf >> 8 ) ) >> 8 ) ; // Exact division by 255 for this range.
+    }
 
-        \param foregroundImage  Front image.
 
-        \param backgroundImage  Image behind the front image.
 
-        All images must have the same dimensions.
 
-        Applies an alpha blend.
+    /** Alpha-blend a row of 4-channel foreground pixels over background pixels.
+
+        \param dst          Destination pixels.  Can be the same as foreground or background.
+
+        \param foreground   Foreground pixels, whose channel 3 is opacity.
+
+        \param background   Background pixels.
+
+        \param numPixels    Number of pixels in row.
     */
-    Image & ImgOpOverlay::Overlay( Image & dstImage , const Image & foregroundImage , const Image & backgroundImage )
+    static void OverlayRow( unsigned char * dst , const unsigned char * foreground , const unsigned char * background , unsigned numPixels )
+    {
+        unsigned ix = 0 ;
+    #if IMG_OP_OVERLAY_USE_SSE2
+        // Blend 4 pixels (16 channels) per iteration, in 16-bit lanes.
+        // Products fit, since background * ( 255 - opacity ) + foreground * opacity <= 255 * 255.
+        const __m128i   zero        = _mm_setzero_si128() ;
+        const __m128i   v255        = _mm_set1_epi16( 255 ) ;
+        const __m128i   v128        = _mm_set1_epi16( 128 ) ;
+        for( ; ix + 4 <= numPixels ; ix += 4 )
+        {   // For each group of 4 pixels...
+            const __m128i fg        = _mm_loadu_si128( reinterpret_cast< const __m128i * >( foreground + 4 * ix ) ) ;
+            const __m128i bg        = _mm_loadu_si128( reinterpret_cast< const __m128i * >( background + 4 * ix ) ) ;
+            __m128i       halves[ 2 ] ;
+            for( int iHalf = 0 ; iHalf < 2 ; ++ iHalf )
+            {   // For each pair of pixels...
+                const __m128i fg16      = iHalf ? _mm_unpackhi_epi8( fg , zero ) : _mm_unpacklo_epi8( fg , zero ) ;
+                const __m128i bg16      = iHalf ? _mm_unpackhi_epi8( bg , zero ) : _mm_unpacklo_epi8( bg , zero ) ;
+                const __m128i opacity   = _mm_shufflehi_epi16( _mm_shufflelo_epi16( fg16 , _MM_SHUFFLE( 3 , 3 , 3 , 3 ) ) , _MM_SHUFFLE( 3 , 3 , 3 , 3 ) ) ; // Broadcast each pixel's alpha to its 4 lanes.
+                const __m128i sum       = _mm_add_epi16( _mm_add_epi16( _mm_mullo_epi16( bg16 , _mm_sub_epi16( v255 , opacity ) ) , _mm_mullo_epi16( fg16 , opacity ) ) , v128 ) ;
+                halves[ iHalf ]         = _mm_srli_epi16( _mm_add_epi16( sum , _mm_srli_epi16( sum , 8 ) ) , 8 ) ;
+            }
+            _mm_storeu_si128( reinterpret_cast< __m128i * >( dst + 4 * ix ) , _mm_packus_epi16( halves[ 0 ] , halves[ 1 ] ) ) ;
+        }
+    #endif
+        for( ; ix < numPixels ; ++ ix )
+        {   // For each remaining pixel...
+            const unsigned      offset  = 4 * ix ;
+            const unsigned char opacity = foreground[ offset + 3 ] ;
+            dst[ offset + 0 ] = BlendChannel( background[ offset + 0 ] , foreground[ offset + 0 ] , opacity ) ;
+            dst[ offset + 1 ] = BlendChannel( background[ offset + 1 ] , foreground[ offset + 1 ] , opacity ) ;
+            dst[ offset + 2 ] = BlendChannel( background[ offset + 2 ] , foreground[ offset + 2 ] , opacity ) ;
+            dst[ offset + 3 ] = BlendChannel( background[ offset + 3 ] , foreground[ offset + 3 ] , opacity ) ;
+        }
+    }
+
+
+
+
+    /** Function object to overlay a range of rows, for Parallel::For.
+    */
+    class ImgOpOverlay_Rows
+    {
+        public:
+            ImgOpOverlay_Rows( Image & dstImage , const Image & foregroundImage , const Image & backgroundImage , const ImgOpLookUpTable * foregroundTable )
+                : mDstImage( dstImage ) , mForegroundImage( foregroundImage ) , mBackgroundImage( backgroundImage ) , mForegroundTable( foregroundTable )
+            {}
+
+            void operator()( const Parallel::Range & r ) const
+            {
+                const unsigned          width   = mDstImage.GetWidth() ;
+                const unsigned          yStride = mDstImage.GetYStride() ;
+                VECTOR< unsigned char > tableRow ;
+                if( mForegroundTable )
+                {   // Foreground goes through a table before blending.
+                    tableRow.Resize( 4 * width ) ;
+                }
+                for( size_t iy = r.begin() ; iy < r.end() ; ++ iy )
+                {   // For each row in this subrange...
+                    const unsigned char * foregroundRow = mForegroundImage.GetImageData() + iy * yStride ;
+                    if( mForegroundTable )
+                    {   // Remap foreground row into temporary row, rather than into a whole intermediate image.
+                        for( unsigned ic = 0 ; ic < 4 ; ++ ic )
+                        {   // For each channel...
+                            const unsigned char * table = mForegroundTable->GetTable( ic ) ;
+                            for( unsigned ix = 0 ; ix < width ; ++ ix )
+                            {
+                                tableRow[ 4 * ix + ic ] = table[ foregroundRow[ 4 * ix + ic ] ] ;
+                            }
+                        }
+                        foregroundRow = & tableRow[ 0 ] ;
+                    }
+                    OverlayRow( mDstImage.GetImageData() + iy * yStride , foregroundRow , mBackgroundImage.GetImageData() + iy * yStride , width ) ;
+                }
+            }
+
+        private:
+            ImgOpOverlay_Rows & operator=( const ImgOpOverlay_Rows & ) ; // Disallow assignment
+
+            Image &                     mDstImage           ;   ///< Image to populate.
+            const Image &               mForegroundImage    ;   ///< Front image.
+            const Image &               mBackgroundImage    ;   ///< Image behind the front image.
+            const ImgOpLookUpTable *    mForegroundTable    ;   ///< Table through which to remap foreground before blending, or NULL to use it as is.
+    } ;
+
+
+
+
+    /** Composite a foreground image, optionally remapped through a table, over a background image, with rows running concurrently.
+    */
+    static Image & OverlayRemapped( Image & dstImage , const Image & foregroundImage , const Image & backgroundImage , const ImgOpLookUpTable * foregroundTable )
     {
         ASSERT( dstImage.GetWidth()              == backgroundImage.GetWidth()  ) ;
         ASSERT( dstImage.GetHeight()             == backgroundImage.GetHeight() ) ;
@@ -39,30 +157,51 @@ namespace PeGaSys
         ASSERT( foregroundImage.GetHeight()      == backgroundImage.GetHeight() ) ;
         ASSERT( foregroundImage.GetNumChannels() == backgroundImage.GetNumChannels() ) ;
         ASSERT( 4 == dstImage.GetNumChannels() ) ; // TODO: FIXME: Current implementation assumes image has 4 channels.
+        ASSERT( ( dstImage.GetYStride() == foregroundImage.GetYStride() ) && ( dstImage.GetYStride() == backgroundImage.GetYStride() ) ) ;
+        ASSERT( 4 == dstImage.GetXStride() ) ; // Rows must be contiguous pixels.
 
-        const unsigned xStride = dstImage.GetXStride() ;
-        const unsigned yStride = dstImage.GetYStride() ;
-
-        for( unsigned iy = 0 ; iy < dstImage.GetHeight() ; ++ iy )
-        {
-            for( unsigned ix = 0 ; ix < dstImage.GetWidth() ; ++ ix )
-            {
-                const unsigned  offset                 = xStride * ix + yStride * iy ;
-                float           overlayOpacity         = PixelFloat( foregroundImage[ offset + 3 ] ) ;
-                float           oneMinusOverlayOpacity = 1.0f - overlayOpacity ;
-                ASSERT( ( overlayOpacity >= 0.0f ) && ( overlayOpacity <= 1.0f ) ) ;
-                ASSERT( ( oneMinusOverlayOpacity >= 0.0f ) && ( oneMinusOverlayOpacity <= 1.0f ) ) ;
-                dstImage[ offset + 0 ] = PixelInt( PixelFloat( backgroundImage[ offset + 0 ] ) * oneMinusOverlayOpacity + PixelFloat( foregroundImage[ offset + 0 ] ) * overlayOpacity ) ;
-                dstImage[ offset + 1 ] = PixelInt( PixelFloat( backgroundImage[ offset + 1 ] ) * oneMinusOverlayOpacity + PixelFloat( foregroundImage[ offset + 1 ] ) * overlayOpacity ) ;
-                dstImage[ offset + 2 ] = PixelInt( PixelFloat( backgroundImage[ offset + 2 ] ) * oneMinusOverlayOpacity + PixelFloat( foregroundImage[ offset + 2 ] ) * overlayOpacity ) ;
-                dstImage[ offset + 3 ] = PixelInt( PixelFloat( backgroundImage[ offset + 3 ] ) * oneMinusOverlayOpacity + PixelFloat( foregroundImage[ offset + 3 ] ) * overlayOpacity ) ;
-
-                //printf("%i %i %i %i , " , destinationImage[ offset + 0 ] , destinationImage[ offset + 1 ] , destinationImage[ offset + 2 ] , destinationImage[ offset + 3 ] ) ;
-            }
-            //printf("\n") ;
-        }
+        const unsigned height = dstImage.GetHeight() ;
+        Parallel::For( 0 , height , Max2( size_t( 1 ) , size_t( height / gNumberOfProcessors ) ) , ImgOpOverlay_Rows( dstImage , foregroundImage , backgroundImage , foregroundTable ) ) ;
 
         return dstImage ;
     }
 
-} ;
\ No newline at end of file
+
+
+
+    /** Composite a foreground image over a background image.
+
+        \param dstImage Image to populate. Can be either "this" or backgroundImage (or neither).
+
+        \param foregroundImage  Front image.
+
+        \param backgroundImage  Image behind the front image.
+
+        All images must have the same dimensions.
+
+        Applies an alpha blend.
+    */
+    Image & ImgOpOverlay::Overlay( Image & dstImage , const Image & foregroundImage , const Image & backgroundImage )
+    {
+        PERF_BLOCK( ImgOpOverlay__Overlay ) ;
+
+        return OverlayRemapped( dstImage , foregroundImage , backgroundImage , NULLPTR ) ;
+    }
+
+
+
+
+    /** Composite a tinted foreground image over a background image, without modifying the foreground.
+
+        This yields the same result as ImgOpTint::Tint on foregroundImage followed by Overlay,
+        but visits each pixel once, and leaves foregroundImage intact.
+    */
+    Image & ImgOpOverlay::OverlayTinted( Image & dstImage , const Image & foregroundImage , const Vec4 & tint , const Image & backgroundImage )
+    {
+        PERF_BLOCK( ImgOpOverlay__OverlayTinted ) ;
+
+        const ImgOpLookUpTable tintTable = ImgOpLookUpTable().ComposeTint( tint ) ;
+        return OverlayRemapped( dstImage , foregroundImage , backgroundImage , & tintTable ) ;
+    }
+
+} ;
@@ -9,6 +9,7 @@
 #ifndef PEGASYS_IMG_OP_OVERLAY_H
 #define PEGASYS_IMG_OP_OVERLAY_H
 
+#include "Core/Math/Vec4.h"
 #include "../image.h"
 #include "iImageOperation.h"
 
@@ -33,6 +34,7 @@ namespace PeGaSys
             }
 
             static Image & Overlay( Image & image , const Image & foregroundImage , const Image & backgroundImage ) ;
+            static Image & OverlayTinted( Image & image , const Image & foregroundImage , const Vec4 & tint , const Image & backgroundImage ) ;
 
             virtual Image & operator()( Image & image )
             {
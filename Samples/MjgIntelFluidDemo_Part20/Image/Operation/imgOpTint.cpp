@@ -8,6 +8,7 @@
 */
 
 #include "Image/Operation/imgOpTint.h"
+#include "Image/Operation/imgOpLookUpTable.h"
 
 #include "Core/Performance/perfBlock.h"
 
@@ -19,6 +20,8 @@ namespace PeGaSys
 {
 
     /** Apply a tint to the given image.
+
+        Output depends only on input value, so this computes each of the 256 possible results per channel once, then looks them up.
     */
     Image & ImgOpTint::Tint( Image & image , const Vec4 & color )
     {
@@ -26,20 +29,6 @@ namespace PeGaSys
 
         ASSERT( 4 == image.GetNumChannels() ) ; // TODO: FIXME: Current implementation assumes image has 4 channels.
 
-        const unsigned xStride = image.GetXStride() ;
-        const unsigned yStride = image.GetYStride() ;
-        for( unsigned iy = 0 ; iy < image.GetHeight() ; ++ iy )
-        {
-            for( unsigned ix = 0 ; ix < image.GetWidth() ; ++ ix )
-            {
-                const unsigned  offset  = xStride * ix + yStride * iy ;
-                image[ offset + 0 ] = PixelInt( PixelFloat( image[ offset + 0 ] ) * color.x ) ;
-                image[ offset + 1 ] = PixelInt( PixelFloat( image[ offset + 1 ] ) * color.y ) ;
-                image[ offset + 2 ] = PixelInt( PixelFloat( image[ offset + 2 ] ) * color.z ) ;
-                image[ offset + 3 ] = PixelInt( PixelFloat( image[ offset + 3 ] ) * color.w ) ;
-            }
-        }
-
-        return image ;
+        return ImgOpLookUpTable::LookUp( image , ImgOpLookUpTable().ComposeTint( color ) ) ;
     }
 } ;
@@ -0,0 +1,778 @@
+/** \file compressedImage.cpp
+
+    \brief Block-compressed image, with MIP levels, ready to upload into a compressed texture.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "Image/compressedImage.h"
+
+#include "Image/image.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace PeGaSys
+{
+
+    static const unsigned   sBlockSize          = 4 ;   ///< Width and height, in pixels, of each compressed block.
+    static const unsigned   sPixelsPerBlock     = sBlockSize * sBlockSize ;
+    static const unsigned   sBc7Mode6Weights[ 16 ] = { 0 , 4 , 9 , 13 , 17 , 21 , 26 , 30 , 34 , 38 , 43 , 47 , 51 , 55 , 60 , 64 } ; ///< Interpolation weights, out of 64, for BC7 4-bit indices.
+
+// Private functions --------------------------------------------------------------
+
+    /** Write the given value, least significant bit first, into the given block, starting at the given bit.
+    */
+    static void PutBits( unsigned char * block , unsigned & bitPosition , unsigned value , unsigned numBits )
+    {
+        for( unsigned bit = 0 ; bit < numBits ; ++ bit , ++ bitPosition )
+        {
+            if( ( value >> bit ) & 1 )
+            {
+                block[ bitPosition >> 3 ] |= static_cast< unsigned char >( 1 << ( bitPosition & 7 ) ) ;
+            }
+        }
+    }
+
+
+
+
+    /** Read a value, least significant bit first, from the given block, starting at the given bit.
+    */
+    static unsigned GetBits( const unsigned char * block , unsigned & bitPosition , unsigned numBits )
+    {
+        unsigned value = 0 ;
+        for( unsigned bit = 0 ; bit < numBits ; ++ bit , ++ bitPosition )
+        {
+            value |= ( ( block[ bitPosition >> 3 ] >> ( bitPosition & 7 ) ) & 1u ) << bit ;
+        }
+        return value ;
+    }
+
+
+
+
+    /** Copy the RGBA pixels of the given block of the given surface, replicating edge pixels where the block overhangs the surface.
+    */
+    static void LoadBlock( const unsigned char * surface , unsigned width , unsigned height , unsigned xBlock , unsigned yBlock , unsigned char pixels[ sPixelsPerBlock ][ 4 ] )
+    {
+        for( unsigned iy = 0 ; iy < sBlockSize ; ++ iy )
+        {
+            const unsigned y = Min2( yBlock * sBlockSize + iy , height - 1 ) ;
+            for( unsigned ix = 0 ; ix < sBlockSize ; ++ ix )
+            {
+                const unsigned x = Min2( xBlock * sBlockSize + ix , width - 1 ) ;
+                memcpy( pixels[ iy * sBlockSize + ix ] , surface + ( static_cast< size_t >( y ) * width + x ) * 4 , 4 ) ;
+            }
+        }
+    }
+
+
+
+
+    /** Copy the given RGBA pixels into the given block of the given surface, omitting pixels where the block overhangs the surface.
+    */
+    static void StoreBlock( const unsigned char pixels[ sPixelsPerBlock ][ 4 ] , unsigned width , unsigned height , unsigned xBlock , unsigned yBlock , unsigned char * surface )
+    {
+        for( unsigned iy = 0 ; iy < sBlockSize ; ++ iy )
+        {
+            const unsigned y = yBlock * sBlockSize + iy ;
+            for( unsigned ix = 0 ; ix < sBlockSize ; ++ ix )
+            {
+                const unsigned x = xBlock * sBlockSize + ix ;
+                if( ( x < width ) && ( y < height ) )
+                {
+                    memcpy( surface + ( static_cast< size_t >( y ) * width + x ) * 4 , pixels[ iy * sBlockSize + ix ] , 4 ) ;
+                }
+            }
+        }
+    }
+
+
+
+
+    /** Encode the given channel of the given pixels as a BC4 block.
+
+        This uses the mode with 6 interpolated values between the extremes of
+        the block, and picks, for each pixel, whichever of the 8 values lies
+        nearest.
+    */
+    static void EncodeBlockBc4( const unsigned char pixels[ sPixelsPerBlock ][ 4 ] , unsigned channel , unsigned char * block )
+    {
+        unsigned char lo = 255 ;
+        unsigned char hi = 0 ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {
+            lo = Min2( lo , pixels[ i ][ channel ] ) ;
+            hi = Max2( hi , pixels[ i ][ channel ] ) ;
+        }
+
+        memset( block , 0 , 8 ) ;
+        block[ 0 ] = hi ;
+        block[ 1 ] = lo ;
+        if( hi == lo )
+        {   // Block is uniform.  Every index is 0, which means hi.
+            return ;
+        }
+
+        int palette[ 8 ] ;
+        palette[ 0 ] = hi ;
+        palette[ 1 ] = lo ;
+        for( int i = 2 ; i < 8 ; ++ i )
+        {
+            palette[ i ] = ( ( 8 - i ) * hi + ( i - 1 ) * lo + 3 ) / 7 ;
+        }
+
+        unsigned bitPosition = 16 ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {   // For each pixel...
+            unsigned    bestIndex   = 0 ;
+            int         bestError   = 256 ;
+            for( unsigned index = 0 ; index < 8 ; ++ index )
+            {
+                const int error = abs( palette[ index ] - pixels[ i ][ channel ] ) ;
+                if( error < bestError )
+                {
+                    bestError = error ;
+                    bestIndex = index ;
+                }
+            }
+            PutBits( block , bitPosition , bestIndex , 3 ) ;
+        }
+    }
+
+
+
+
+    /** Decode the given BC4 block into one channel per pixel.
+    */
+    static void DecodeBlockBc4( const unsigned char * block , unsigned char values[ sPixelsPerBlock ] )
+    {
+        const int r0 = block[ 0 ] ;
+        const int r1 = block[ 1 ] ;
+        int palette[ 8 ] ;
+        palette[ 0 ] = r0 ;
+        palette[ 1 ] = r1 ;
+        if( r0 > r1 )
+        {   // Block uses 6 interpolated values.
+            for( int i = 2 ; i < 8 ; ++ i )
+            {
+                palette[ i ] = ( ( 8 - i ) * r0 + ( i - 1 ) * r1 + 3 ) / 7 ;
+            }
+        }
+        else
+        {   // Block uses 4 interpolated values, plus 0 and 255.
+            for( int i = 2 ; i < 6 ; ++ i )
+            {
+                palette[ i ] = ( ( 6 - i ) * r0 + ( i - 1 ) * r1 + 2 ) / 5 ;
+            }
+            palette[ 6 ] = 0 ;
+            palette[ 7 ] = 255 ;
+        }
+
+        unsigned bitPosition = 16 ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {
+            values[ i ] = static_cast< unsigned char >( palette[ GetBits( block , bitPosition , 3 ) ] ) ;
+        }
+    }
+
+
+
+
+    /** Quantize the given endpoint to 7 bits per channel plus a shared lowest bit, whichever shared bit reproduces it more closely.
+    */
+    static void QuantizeBc7Mode6Endpoint( const float endpoint[ 4 ] , unsigned quantized[ 4 ] , unsigned & pBit )
+    {
+        float bestError = -1.0f ;
+        for( unsigned p = 0 ; p < 2 ; ++ p )
+        {   // For each value of shared bit...
+            unsigned    candidate[ 4 ] ;
+            float       error = 0.0f ;
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                const int q = Clamp( static_cast< int >( floorf( ( endpoint[ c ] - float( p ) ) * 0.5f + 0.5f ) ) , 0 , 127 ) ;
+                candidate[ c ] = static_cast< unsigned >( q ) ;
+                const float difference = float( ( q << 1 ) | p ) - endpoint[ c ] ;
+                error += difference * difference ;
+            }
+            if( ( bestError < 0.0f ) || ( error < bestError ) )
+            {
+                bestError = error ;
+                pBit = p ;
+                memcpy( quantized , candidate , sizeof( candidate ) ) ;
+            }
+        }
+    }
+
+
+
+
+    /** Encode the given pixels as a BC7 mode 6 block.
+
+        Endpoints lie at the extremes of the projections of the pixels onto
+        their principal axis (found by power iteration on their covariance),
+        so colors that vary together use the whole index range.  Each pixel
+        then picks whichever of the 16 interpolated colors lies nearest.
+    */
+    static void EncodeBlockBc7Mode6( const unsigned char pixels[ sPixelsPerBlock ][ 4 ] , unsigned char * block )
+    {
+        float mean[ 4 ] = { 0.0f , 0.0f , 0.0f , 0.0f } ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                mean[ c ] += pixels[ i ][ c ] ;
+            }
+        }
+        for( unsigned c = 0 ; c < 4 ; ++ c )
+        {
+            mean[ c ] /= float( sPixelsPerBlock ) ;
+        }
+
+        float covariance[ 4 ][ 4 ] ;
+        memset( covariance , 0 , sizeof( covariance ) ) ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {
+            float deviation[ 4 ] ;
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                deviation[ c ] = pixels[ i ][ c ] - mean[ c ] ;
+            }
+            for( unsigned row = 0 ; row < 4 ; ++ row )
+            {
+                for( unsigned col = 0 ; col < 4 ; ++ col )
+                {
+                    covariance[ row ][ col ] += deviation[ row ] * deviation[ col ] ;
+                }
+            }
+        }
+
+        float axis[ 4 ] = { 1.0f , 1.0f , 1.0f , 1.0f } ;
+        for( unsigned iteration = 0 ; iteration < 8 ; ++ iteration )
+        {   // Power iteration converges toward the eigenvector with the largest eigenvalue.
+            float next[ 4 ] = { 0.0f , 0.0f , 0.0f , 0.0f } ;
+            for( unsigned row = 0 ; row < 4 ; ++ row )
+            {
+                for( unsigned col = 0 ; col < 4 ; ++ col )
+                {
+                    next[ row ] += covariance[ row ][ col ] * axis[ col ] ;
+                }
+            }
+            const float length = sqrtf( next[ 0 ] * next[ 0 ] + next[ 1 ] * next[ 1 ] + next[ 2 ] * next[ 2 ] + next[ 3 ] * next[ 3 ] ) ;
+            if( length < 1.0e-6f )
+            {   // Pixels do not vary, or vary perpendicular to the current guess.
+                break ;
+            }
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                axis[ c ] = next[ c ] / length ;
+            }
+        }
+
+        float tMin = 0.0f ;
+        float tMax = 0.0f ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {
+            float t = 0.0f ;
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                t += ( pixels[ i ][ c ] - mean[ c ] ) * axis[ c ] ;
+            }
+            tMin = Min2( tMin , t ) ;
+            tMax = Max2( tMax , t ) ;
+        }
+
+        float       endpoints[ 2 ][ 4 ] ;
+        unsigned    quantized[ 2 ][ 4 ] ;
+        unsigned    pBits[ 2 ] ;
+        for( unsigned c = 0 ; c < 4 ; ++ c )
+        {
+            endpoints[ 0 ][ c ] = Clamp( mean[ c ] + tMin * axis[ c ] , 0.0f , 255.0f ) ;
+            endpoints[ 1 ][ c ] = Clamp( mean[ c ] + tMax * axis[ c ] , 0.0f , 255.0f ) ;
+        }
+        QuantizeBc7Mode6Endpoint( endpoints[ 0 ] , quantized[ 0 ] , pBits[ 0 ] ) ;
+        QuantizeBc7Mode6Endpoint( endpoints[ 1 ] , quantized[ 1 ] , pBits[ 1 ] ) ;
+
+        int palette[ 16 ][ 4 ] ;
+        for( unsigned c = 0 ; c < 4 ; ++ c )
+        {
+            const int e0 = static_cast< int >( ( quantized[ 0 ][ c ] << 1 ) | pBits[ 0 ] ) ;
+            const int e1 = static_cast< int >( ( quantized[ 1 ][ c ] << 1 ) | pBits[ 1 ] ) ;
+            for( unsigned index = 0 ; index < 16 ; ++ index )
+            {
+                const int w = static_cast< int >( sBc7Mode6Weights[ index ] ) ;
+                palette[ index ][ c ] = ( ( 64 - w ) * e0 + w * e1 + 32 ) >> 6 ;
+            }
+        }
+
+        unsigned indices[ sPixelsPerBlock ] ;
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {   // For each pixel...
+            unsigned    bestIndex   = 0 ;
+            int         bestError   = -1 ;
+            for( unsigned index = 0 ; index < 16 ; ++ index )
+            {
+                int error = 0 ;
+                for( unsigned c = 0 ; c < 4 ; ++ c )
+                {
+                    const int difference = palette[ index ][ c ] - pixels[ i ][ c ] ;
+                    error += difference * difference ;
+                }
+                if( ( bestError < 0 ) || ( error < bestError ) )
+                {
+                    bestError = error ;
+                    bestIndex = index ;
+                }
+            }
+            indices[ i ] = bestIndex ;
+        }
+
+        if( indices[ 0 ] & 8 )
+        {   // Format omits the most significant bit of the first index, which must therefore be 0.  Swap endpoints, which reverses every index.
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                const unsigned temp = quantized[ 0 ][ c ] ; quantized[ 0 ][ c ] = quantized[ 1 ][ c ] ; quantized[ 1 ][ c ] = temp ;
+            }
+            const unsigned temp = pBits[ 0 ] ; pBits[ 0 ] = pBits[ 1 ] ; pBits[ 1 ] = temp ;
+            for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+            {
+                indices[ i ] = 15 - indices[ i ] ;
+            }
+        }
+
+        memset( block , 0 , 16 ) ;
+        unsigned bitPosition = 0 ;
+        PutBits( block , bitPosition , 1u << 6 , 7 ) ;  // Mode 6: six 0 bits then a 1 bit.
+        for( unsigned c = 0 ; c < 4 ; ++ c )
+        {   // Endpoints, per channel: R0 R1 G0 G1 B0 B1 A0 A1.
+            PutBits( block , bitPosition , quantized[ 0 ][ c ] , 7 ) ;
+            PutBits( block , bitPosition , quantized[ 1 ][ c ] , 7 ) ;
+        }
+        PutBits( block , bitPosition , pBits[ 0 ] , 1 ) ;
+        PutBits( block , bitPosition , pBits[ 1 ] , 1 ) ;
+        PutBits( block , bitPosition , indices[ 0 ] , 3 ) ;
+        for( unsigned i = 1 ; i < sPixelsPerBlock ; ++ i )
+        {
+            PutBits( block , bitPosition , indices[ i ] , 4 ) ;
+        }
+        ASSERT( 128 == bitPosition ) ;
+    }
+
+
+
+
+    /** Decode the given BC7 block, which must use mode 6, as EncodeBlockBc7Mode6 writes.
+    */
+    static void DecodeBlockBc7Mode6( const unsigned char * block , unsigned char pixels[ sPixelsPerBlock ][ 4 ] )
+    {
+        unsigned bitPosition = 0 ;
+        const unsigned modeBits = GetBits( block , bitPosition , 7 ) ;
+        if( modeBits != ( 1u << 6 ) )
+        {   // Block uses another mode, which only other encoders write.
+            FAIL() ;
+            memset( pixels , 0 , sPixelsPerBlock * 4 ) ;
+            return ;
+        }
+
+        unsigned endpoints[ 2 ][ 4 ] ;
+        for( unsigned c = 0 ; c < 4 ; ++ c )
+        {
+            endpoints[ 0 ][ c ] = GetBits( block , bitPosition , 7 ) ;
+            endpoints[ 1 ][ c ] = GetBits( block , bitPosition , 7 ) ;
+        }
+        const unsigned pBit0 = GetBits( block , bitPosition , 1 ) ;
+        const unsigned pBit1 = GetBits( block , bitPosition , 1 ) ;
+        for( unsigned c = 0 ; c < 4 ; ++ c )
+        {
+            endpoints[ 0 ][ c ] = ( endpoints[ 0 ][ c ] << 1 ) | pBit0 ;
+            endpoints[ 1 ][ c ] = ( endpoints[ 1 ][ c ] << 1 ) | pBit1 ;
+        }
+
+        for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+        {
+            const unsigned index    = GetBits( block , bitPosition , ( 0 == i ) ? 3 : 4 ) ;
+            const unsigned w        = sBc7Mode6Weights[ index ] ;
+            for( unsigned c = 0 ; c < 4 ; ++ c )
+            {
+                pixels[ i ][ c ] = static_cast< unsigned char >( ( ( 64 - w ) * endpoints[ 0 ][ c ] + w * endpoints[ 1 ][ c ] + 32 ) >> 6 ) ;
+            }
+        }
+    }
+
+
+
+
+    /** Encode the given RGBA surface into blocks of the given format.
+
+        \param channel  For BC4, which channel to encode.
+    */
+    static void EncodeSurface( const unsigned char * surface , unsigned width , unsigned height , CompressedImage::FormatE format , unsigned channel , unsigned char * blocks )
+    {
+        PERF_BLOCK( CompressedImage__EncodeSurface ) ;
+
+        const unsigned  numBlocksX      = ( width  + sBlockSize - 1 ) / sBlockSize ;
+        const unsigned  numBlocksY      = ( height + sBlockSize - 1 ) / sBlockSize ;
+        const size_t    bytesPerBlock   = CompressedImage::GetBytesPerBlock( format ) ;
+        for( unsigned yBlock = 0 ; yBlock < numBlocksY ; ++ yBlock )
+        {
+            for( unsigned xBlock = 0 ; xBlock < numBlocksX ; ++ xBlock )
+            {   // For each block...
+                unsigned char pixels[ sPixelsPerBlock ][ 4 ] ;
+                LoadBlock( surface , width , height , xBlock , yBlock , pixels ) ;
+                if( CompressedImage::FORMAT_BC4 == format )
+                {
+                    EncodeBlockBc4( pixels , channel , blocks ) ;
+                }
+                else
+                {
+                    EncodeBlockBc7Mode6( pixels , blocks ) ;
+                }
+                blocks += bytesPerBlock ;
+            }
+        }
+    }
+
+
+
+
+    /** Decode the given blocks into an RGBA surface, expanding BC4 channels according to the given swizzle.
+    */
+    static void DecodeSurface( const unsigned char * blocks , unsigned width , unsigned height , CompressedImage::FormatE format , CompressedImage::SwizzleE swizzle , unsigned char * surface )
+    {
+        PERF_BLOCK( CompressedImage__DecodeSurface ) ;
+
+        const unsigned  numBlocksX      = ( width  + sBlockSize - 1 ) / sBlockSize ;
+        const unsigned  numBlocksY      = ( height + sBlockSize - 1 ) / sBlockSize ;
+        const size_t    bytesPerBlock   = CompressedImage::GetBytesPerBlock( format ) ;
+        for( unsigned yBlock = 0 ; yBlock < numBlocksY ; ++ yBlock )
+        {
+            for( unsigned xBlock = 0 ; xBlock < numBlocksX ; ++ xBlock )
+            {   // For each block...
+                unsigned char pixels[ sPixelsPerBlock ][ 4 ] ;
+                if( CompressedImage::FORMAT_BC4 == format )
+                {
+                    unsigned char values[ sPixelsPerBlock ] ;
+                    DecodeBlockBc4( blocks , values ) ;
+                    for( unsigned i = 0 ; i < sPixelsPerBlock ; ++ i )
+                    {
+                        const unsigned char v = values[ i ] ;
+                        switch( swizzle )
+                        {
+                        case CompressedImage::SWIZZLE_RRR1: pixels[ i ][ 0 ] = pixels[ i ][ 1 ] = pixels[ i ][ 2 ] = v   ; pixels[ i ][ 3 ] = 255 ; break ;
+                        case CompressedImage::SWIZZLE_111R: pixels[ i ][ 0 ] = pixels[ i ][ 1 ] = pixels[ i ][ 2 ] = 255 ; pixels[ i ][ 3 ] = v   ; break ;
+                        default                           : pixels[ i ][ 0 ] = pixels[ i ][ 1 ] = pixels[ i ][ 2 ] = v   ; pixels[ i ][ 3 ] = v   ; break ;
+                        }
+                    }
+                }
+                else
+                {
+                    DecodeBlockBc7Mode6( blocks , pixels ) ;
+                }
+                StoreBlock( pixels , width , height , xBlock , yBlock , surface ) ;
+                blocks += bytesPerBlock ;
+            }
+        }
+    }
+
+
+
+
+    /** Average each 2x2 square of pixels of the given RGBA surface into one pixel of a surface half its size.
+
+        Odd sizes replicate the last row or column.  Sizes do not shrink below 1.
+    */
+    static void Downsample( const unsigned char * src , unsigned srcWidth , unsigned srcHeight , unsigned char * dst )
+    {
+        const unsigned dstWidth     = Max2( srcWidth  / 2 , 1u ) ;
+        const unsigned dstHeight    = Max2( srcHeight / 2 , 1u ) ;
+        for( unsigned y = 0 ; y < dstHeight ; ++ y )
+        {
+            const size_t row0 = static_cast< size_t >( Min2( 2 * y     , srcHeight - 1 ) ) * srcWidth ;
+            const size_t row1 = static_cast< size_t >( Min2( 2 * y + 1 , srcHeight - 1 ) ) * srcWidth ;
+            for( unsigned x = 0 ; x < dstWidth ; ++ x )
+            {
+                const unsigned col0 = Min2( 2 * x     , srcWidth - 1 ) ;
+                const unsigned col1 = Min2( 2 * x + 1 , srcWidth - 1 ) ;
+                for( unsigned c = 0 ; c < 4 ; ++ c )
+                {
+                    const unsigned sum  =   src[ ( row0 + col0 ) * 4 + c ] + src[ ( row0 + col1 ) * 4 + c ]
+                                        +   src[ ( row1 + col0 ) * 4 + c ] + src[ ( row1 + col1 ) * 4 + c ] ;
+                    dst[ ( static_cast< size_t >( y ) * dstWidth + x ) * 4 + c ] = static_cast< unsigned char >( ( sum + 2 ) / 4 ) ;
+                }
+            }
+        }
+    }
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+    /** Construct an empty compressed image.
+    */
+    CompressedImage::CompressedImage()
+        : mFormat( FORMAT_NONE )
+        , mSwizzle( SWIZZLE_RGBA )
+        , mWidth( 0 )
+        , mHeight( 0 )
+        , mNumPages( 0 )
+        , mNumMipLevels( 0 )
+        , mLayered( false )
+    {
+    }
+
+
+
+
+    /** Discard image, leaving this empty.
+    */
+    void CompressedImage::Clear()
+    {
+        mData.clear() ;
+        mFormat         = FORMAT_NONE ;
+        mSwizzle        = SWIZZLE_RGBA ;
+        mWidth          = 0 ;
+        mHeight         = 0 ;
+        mNumPages       = 0 ;
+        mNumMipLevels   = 0 ;
+        mLayered        = false ;
+    }
+
+
+
+
+    /** Return number of bytes each 4x4 block of the given format occupies.
+    */
+    /* static */ size_t CompressedImage::GetBytesPerBlock( FormatE format )
+    {
+        switch( format )
+        {
+        case FORMAT_BC4: return 8  ;
+        case FORMAT_BC7: return 16 ;
+        default        : FAIL() ; return 0 ;
+        }
+    }
+
+
+
+
+    /** Return number of bytes of blocks that cover a surface of the given size.
+    */
+    /* static */ size_t CompressedImage::GetSurfaceSizeInBytes( FormatE format , unsigned width , unsigned height )
+    {
+        const size_t numBlocksX = ( width  + sBlockSize - 1 ) / sBlockSize ;
+        const size_t numBlocksY = ( height + sBlockSize - 1 ) / sBlockSize ;
+        return numBlocksX * numBlocksY * GetBytesPerBlock( format ) ;
+    }
+
+
+
+
+    /** Return number of bytes of blocks in the given MIP level, all pages, of an image of the given shape.
+    */
+    /* static */ size_t CompressedImage::LevelSizeInBytes( FormatE format , unsigned width , unsigned height , unsigned numPages , bool layered , unsigned mipLevel )
+    {
+        const unsigned levelWidth   = Max2( width  >> mipLevel , 1u ) ;
+        const unsigned levelHeight  = Max2( height >> mipLevel , 1u ) ;
+        if( layered )
+        {   // Each page has its own surface.
+            return GetSurfaceSizeInBytes( format , levelWidth , levelHeight ) * numPages ;
+        }
+        // Pages share one surface.
+        return GetSurfaceSizeInBytes( format , levelWidth , levelHeight * numPages ) ;
+    }
+
+
+
+
+    /** Return number of bytes of blocks in all MIP levels of an image of the given shape.
+    */
+    /* static */ size_t CompressedImage::ComputeSizeInBytes( FormatE format , unsigned width , unsigned height , unsigned numPages , unsigned numMipLevels , bool layered )
+    {
+        size_t sizeInBytes = 0 ;
+        for( unsigned mipLevel = 0 ; mipLevel < numMipLevels ; ++ mipLevel )
+        {
+            sizeInBytes += LevelSizeInBytes( format , width , height , numPages , layered , mipLevel ) ;
+        }
+        return sizeInBytes ;
+    }
+
+
+
+
+    /** Return number of MIP levels an image of the given shape has, down to 1x1.
+
+        When multiple pages share a surface, each level must be exactly half
+        the height of the one before it, for the stacked surface to form a
+        valid MIP chain, so levels stop once page height becomes odd.
+    */
+    /* static */ unsigned CompressedImage::CountMipLevels( unsigned width , unsigned height , unsigned numPages , bool layered )
+    {
+        const bool  stacked         = ( numPages > 1 ) && ! layered ;
+        unsigned    numMipLevels    = 1 ;
+        while( ( ( width > 1 ) || ( height > 1 ) ) && ( ! stacked || ( 0 == ( height & 1 ) ) ) )
+        {
+            width   = Max2( width  / 2 , 1u ) ;
+            height  = Max2( height / 2 , 1u ) ;
+            ++ numMipLevels ;
+        }
+        return numMipLevels ;
+    }
+
+
+
+
+    /** Assign shape and allocate (uninitialized) blocks for it, for example to load a compressed image from a file.
+    */
+    void CompressedImage::SetShape( FormatE format , SwizzleE swizzle , unsigned width , unsigned height , unsigned numPages , unsigned numMipLevels , bool layered )
+    {
+        ASSERT( format != FORMAT_NONE ) ;
+        ASSERT( ( width > 0 ) && ( height > 0 ) && ( numPages > 0 ) && ( numMipLevels > 0 ) ) ;
+        mFormat         = format ;
+        mSwizzle        = swizzle ;
+        mWidth          = width ;
+        mHeight         = height ;
+        mNumPages       = numPages ;
+        mNumMipLevels   = numMipLevels ;
+        mLayered        = layered ;
+        mData.Resize( ComputeSizeInBytes( format , width , height , numPages , numMipLevels , layered ) ) ;
+    }
+
+
+
+
+    /** Return address of blocks of the given MIP level.
+    */
+    const unsigned char * CompressedImage::GetLevelData( unsigned mipLevel ) const
+    {
+        ASSERT( mipLevel < mNumMipLevels ) ;
+        return GetData() + ComputeSizeInBytes( mFormat , mWidth , mHeight , mNumPages , mipLevel , mLayered ) ;
+    }
+
+
+
+
+    /** Generate MIP levels of the given RGBA image, then compress all of them.
+
+        \param image    Image to compress.  Must have 4 channels and contiguous data, as images that own their data do.
+
+        \param layered  Whether to lay out pages for a texture array.  Otherwise, pages get stacked, for a 2D texture.
+
+        This examines every pixel to choose a format: BC4 if one channel
+        suffices to reproduce the image, otherwise BC7.
+    */
+    void CompressedImage::Compress( const Image & image , bool layered )
+    {
+        PERF_BLOCK( CompressedImage__Compress ) ;
+
+        ASSERT( 4 == image.GetNumChannels() ) ; // For now, only support RGBA images
+        ASSERT( image.GetXStride() == image.GetNumChannels() ) ;
+        ASSERT( image.GetYStride() == image.GetXStride() * image.GetWidth() ) ;
+        ASSERT( image.GetPageStride() == image.GetYStride() * image.GetHeight() ) ;
+
+        const unsigned  width       = image.GetWidth() ;
+        const unsigned  height      = image.GetHeight() ;
+        const unsigned  numPages    = image.GetNumPages() ;
+        const size_t    numPixels   = static_cast< size_t >( width ) * height * numPages ;
+        const unsigned char * pixels = image.GetImageData() ;
+
+        bool allEqual   = true ;    // Whether every pixel has R=G=B=A.
+        bool grayOpaque = true ;    // Whether every pixel has R=G=B and A=255.
+        bool whiteAlpha = true ;    // Whether every pixel has R=G=B=255.
+        for( size_t i = 0 ; ( i < numPixels ) && ( allEqual || grayOpaque || whiteAlpha ) ; ++ i )
+        {   // For each pixel, until every single-channel format is ruled out...
+            const unsigned char * rgba = pixels + i * 4 ;
+            const bool gray = ( rgba[ 0 ] == rgba[ 1 ] ) && ( rgba[ 1 ] == rgba[ 2 ] ) ;
+            allEqual    = allEqual   && gray && ( rgba[ 3 ] == rgba[ 0 ] ) ;
+            grayOpaque  = grayOpaque && gray && ( 255 == rgba[ 3 ] ) ;
+            whiteAlpha  = whiteAlpha && gray && ( 255 == rgba[ 0 ] ) ;
+        }
+
+        FormatE     format  = FORMAT_BC4 ;
+        SwizzleE    swizzle = SWIZZLE_RRRR ;
+        unsigned    channel = 0 ;
+        if( allEqual )          { swizzle = SWIZZLE_RRRR ; }
+        else if( grayOpaque )   { swizzle = SWIZZLE_RRR1 ; }
+        else if( whiteAlpha )   { swizzle = SWIZZLE_111R ; channel = 3 ; }
+        else                    { format  = FORMAT_BC7 ; swizzle = SWIZZLE_RGBA ; }
+
+        SetShape( format , swizzle , width , height , numPages , CountMipLevels( width , height , numPages , layered ) , layered ) ;
+
+        VECTOR< unsigned char > level( pixels , pixels + numPixels * 4 ) ;
+        VECTOR< unsigned char > nextLevel ;
+        unsigned char * blocks = GetData() ;
+        for( unsigned mipLevel = 0 ; mipLevel < mNumMipLevels ; ++ mipLevel )
+        {   // For each MIP level...
+            const unsigned  levelWidth  = GetLevelWidth( mipLevel ) ;
+            const unsigned  levelHeight = GetLevelHeight( mipLevel ) ;
+            const size_t    pageSize    = static_cast< size_t >( levelWidth ) * levelHeight * 4 ;
+            if( layered )
+            {   // Encode each page as its own surface.
+                for( unsigned page = 0 ; page < numPages ; ++ page )
+                {
+                    EncodeSurface( & level[ page * pageSize ] , levelWidth , levelHeight , format , channel , blocks ) ;
+                    blocks += GetSurfaceSizeInBytes( format , levelWidth , levelHeight ) ;
+                }
+            }
+            else
+            {   // Pages lie contiguously, so they already form one surface, with pages stacked.
+                EncodeSurface( & level[ 0 ] , levelWidth , levelHeight * numPages , format , channel , blocks ) ;
+                blocks += GetSurfaceSizeInBytes( format , levelWidth , levelHeight * numPages ) ;
+            }
+
+            if( mipLevel + 1 < mNumMipLevels )
+            {   // Make next level, each page separately.
+                const unsigned  nextWidth       = GetLevelWidth( mipLevel + 1 ) ;
+                const unsigned  nextHeight      = GetLevelHeight( mipLevel + 1 ) ;
+                const size_t    nextPageSize    = static_cast< size_t >( nextWidth ) * nextHeight * 4 ;
+                nextLevel.Resize( nextPageSize * numPages ) ;
+                for( unsigned page = 0 ; page < numPages ; ++ page )
+                {
+                    Downsample( & level[ page * pageSize ] , levelWidth , levelHeight , & nextLevel[ page * nextPageSize ] ) ;
+                }
+                level.swap( nextLevel ) ;
+            }
+        }
+        ASSERT( blocks == GetData() + GetSizeInBytes() ) ;
+    }
+
+
+
+
+    /** Decompress the finest MIP level into the given RGBA image.
+
+        \param image    (out) Image to populate.  Must not yet have data, as for a default-constructed Image.
+
+        This serves drivers that cannot sample the compressed format.
+    */
+    void CompressedImage::Decompress( Image & image ) const
+    {
+        PERF_BLOCK( CompressedImage__Decompress ) ;
+
+        ASSERT( ! IsEmpty() ) ;
+        ASSERT( NULLPTR == image.GetImageData() ) ;
+
+        image.SetSize( mWidth , mHeight , 4 , mNumPages ) ;
+        if( mLayered )
+        {   // Each page has its own surface.
+            const unsigned char *   blocks      = GetLevelData( 0 ) ;
+            const size_t            pageSize    = static_cast< size_t >( mWidth ) * mHeight * 4 ;
+            for( unsigned page = 0 ; page < mNumPages ; ++ page )
+            {
+                DecodeSurface( blocks , mWidth , mHeight , mFormat , mSwizzle , image.GetImageData() + page * pageSize ) ;
+                blocks += GetSurfaceSizeInBytes( mFormat , mWidth , mHeight ) ;
+            }
+        }
+        else
+        {   // Pages share one surface, which has the same layout as the image.
+            DecodeSurface( GetLevelData( 0 ) , mWidth , mHeight * mNumPages , mFormat , mSwizzle , image.GetImageData() ) ;
+        }
+    }
+
+} ;
@@ -0,0 +1,138 @@
+/** \file compressedImage.h
+
+    \brief Block-compressed image, with MIP levels, ready to upload into a compressed texture.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef PEGASYS_COMPRESSED_IMAGE_H
+#define PEGASYS_COMPRESSED_IMAGE_H
+
+#include "Core/Containers/vector.h"
+#include "Core/Utility/macros.h"
+
+#include <stddef.h>
+
+namespace PeGaSys
+{
+    class Image ;
+
+    /** Block-compressed image, with MIP levels, ready to upload into a compressed texture.
+
+        Compress chooses a format from image contents:
+
+        -   BC4 stores one channel in 8 bytes per 4x4 block, i.e. half a
+            byte per pixel, an eighth of RGBA8.  Compress uses it for images
+            whose channels all carry the same information, such as gray
+            images, or white images with varying alpha, and records (as the
+            swizzle) how to expand the one channel into RGBA.
+
+        -   BC7 stores RGBA in 16 bytes per block, i.e. one byte per pixel, a
+            quarter of RGBA8.  Compress uses it for everything else.  The
+            encoder only uses BC7 mode 6 (one subset, 7-bit RGBA endpoints
+            plus a shared bit, 4-bit indices), which suits the smooth,
+            low-frequency images procedural textures have, and encodes
+            quickly enough to run on the texture upload worker thread.
+
+        GPUs sample both formats directly, so a texture takes 4 to 8 times
+        less memory and bandwidth, which matters most where particles
+        overdraw each other heavily, as smoke does.
+
+        Since GPUs cannot generate MIP levels for compressed textures,
+        Compress generates them (each page separately, so pages do not bleed
+        into each other) then compresses each level.
+
+        Multi-page images can lay out their pages in two ways:
+
+        -   Stacked, where each MIP level is a single surface with pages one
+            above another, for a 2D texture that shaders address by page
+            through texture coordinates, as the pages of particle textures
+            are.
+
+        -   Layered, where each MIP level holds one surface per page, for a
+            texture array.
+    */
+    class CompressedImage
+    {
+        public:
+            /// Block compression format.
+            enum FormatE
+            {
+                FORMAT_BC4  ,   ///< One channel, 8 bytes per 4x4 block.
+                FORMAT_BC7  ,   ///< RGBA, 16 bytes per 4x4 block.
+                FORMAT_NONE     ///< No image.
+            } ;
+
+            /// How to expand the channels stored into the RGBA that sampling returns.
+            enum SwizzleE
+            {
+                SWIZZLE_RGBA    ,   ///< Channels as stored.
+                SWIZZLE_RRRR    ,   ///< Single channel replicated into all four, for images whose channels are all equal.
+                SWIZZLE_RRR1    ,   ///< Single channel replicated into color, with opaque alpha, for gray opaque images.
+                SWIZZLE_111R        ///< White, with single channel as alpha, for white images with varying alpha.
+            } ;
+
+            CompressedImage() ;
+
+            void    Compress( const Image & image , bool layered ) ;
+            void    Decompress( Image & image ) const ;
+            void    Clear() ;
+
+            void    SetShape( FormatE format , SwizzleE swizzle , unsigned width , unsigned height , unsigned numPages , unsigned numMipLevels , bool layered ) ;
+
+            /// Return whether this holds no image.
+            bool                IsEmpty() const         { return FORMAT_NONE == mFormat ; }
+
+            const FormatE &     GetFormat() const       { return mFormat ; }
+            const SwizzleE &    GetSwizzle() const      { return mSwizzle ; }
+            const unsigned &    GetWidth() const        { return mWidth ; }
+            const unsigned &    GetHeight() const       { return mHeight ; }   // Height of each page.
+            const unsigned &    GetNumPages() const     { return mNumPages ; }
+            const unsigned &    GetNumMipLevels() const { return mNumMipLevels ; }
+            const bool &        IsLayered() const       { return mLayered ; }
+
+            /// Return width, in pixels, of the given MIP level.
+            unsigned            GetLevelWidth( unsigned mipLevel ) const  { return Max2( mWidth  >> mipLevel , 1u ) ; }
+
+            /// Return height, in pixels, of each page of the given MIP level.
+            unsigned            GetLevelHeight( unsigned mipLevel ) const { return Max2( mHeight >> mipLevel , 1u ) ; }
+
+            /// Return number of bytes of blocks in the given MIP level, all pages.
+            size_t              GetLevelSizeInBytes( unsigned mipLevel ) const { return LevelSizeInBytes( mFormat , mWidth , mHeight , mNumPages , mLayered , mipLevel ) ; }
+
+            const unsigned char *   GetLevelData( unsigned mipLevel ) const ;
+
+            /// Return number of bytes of blocks in all MIP levels.
+            size_t                  GetSizeInBytes() const  { return mData.Size() ; }
+                  unsigned char *   GetData()               { return mData.Empty() ? NULLPTR : & mData[ 0 ] ; }
+            const unsigned char *   GetData() const         { return mData.Empty() ? NULLPTR : & mData[ 0 ] ; }
+
+            static size_t   GetBytesPerBlock( FormatE format ) ;
+            static unsigned CountMipLevels( unsigned width , unsigned height , unsigned numPages , bool layered ) ;
+            static size_t   ComputeSizeInBytes( FormatE format , unsigned width , unsigned height , unsigned numPages , unsigned numMipLevels , bool layered ) ;
+
+        private:
+            static size_t   GetSurfaceSizeInBytes( FormatE format , unsigned width , unsigned height ) ;
+            static size_t   LevelSizeInBytes( FormatE format , unsigned width , unsigned height , unsigned numPages , bool layered , unsigned mipLevel ) ;
+
+            VECTOR< unsigned char > mData           ;   ///< Blocks of all MIP levels, finest first.
+            FormatE                 mFormat         ;   ///< Block compression format.
+            SwizzleE                mSwizzle        ;   ///< How to expand stored channels into RGBA.
+            unsigned                mWidth          ;   ///< Width, in pixels, of finest MIP level.
+            unsigned                mHeight         ;   ///< Height, in pixels, of each page of finest MIP level.
+            unsigned                mNumPages       ;   ///< Number of pages.
+            unsigned                mNumMipLevels   ;   ///< Number of MIP levels.
+            bool                    mLayered        ;   ///< Whether each MIP level holds one surface per page, rather than one surface with pages stacked.
+    } ;
+
+// Public variables --------------------------------------------------------------
+
+    /// Version of what CompressedImage::Compress does.  Incremented whenever encoding changes, so cached compressed images from older builds become stale.
+    static const unsigned CompressedImage_sVersion = 1 ;
+
+// Public functions --------------------------------------------------------------
+
+} ;
+
+#endif
@@ -0,0 +1,357 @@
+/** \file imageCache.cpp
+
+    \brief On-disk cache of generated images, laid out so loading can map the file instead of parsing it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
+#include "Image/imageCache.h"
+
+#include "Image/image.h"
+#include "Image/compressedImage.h"
+
+#include "Core/Containers/vector.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace PeGaSys
+{
+
+    /** Return whether the given header describes an image that matches the given key and fits in a file of the given size.
+    */
+    static bool ValidateHeader( const ImageCacheHeader & header , unsigned long long key , unsigned long long fileSize )
+    {
+        return  ( header.mMagic     == ImageCacheHeader::sMagic   )
+            &&  ( header.mVersion   == ImageCacheHeader::sVersion )
+            &&  ( header.mKey       == key )
+            &&  ( header.mDataSize  >  0 )
+            &&  ( header.mDataSize  == static_cast< unsigned long long >( header.mWidth ) * header.mHeight * header.mNumChannels * header.mNumPages )
+            &&  ( sizeof( header ) + header.mDataSize <= fileSize ) ;
+    }
+
+
+
+
+    /** Copy image the given header describes, and the data that follows it, into the given image, which must not yet have data.
+    */
+    static void CopyFromHeader( const ImageCacheHeader & header , Image & image )
+    {
+        image.SetSize( header.mWidth , header.mHeight , header.mNumChannels , header.mNumPages ) ;
+        memcpy( image.GetImageData() , & header + 1 , static_cast< size_t >( header.mDataSize ) ) ;
+    }
+
+
+
+
+    /** Return whether the given header describes a compressed image that matches the given key and fits in a file of the given size.
+    */
+    static bool ValidateCompressedHeader( const CompressedImageCacheHeader & header , unsigned long long key , unsigned long long fileSize )
+    {
+        if(     ( header.mMagic     != CompressedImageCacheHeader::sMagic   )
+            ||  ( header.mVersion   != CompressedImageCacheHeader::sVersion )
+            ||  ( header.mKey       != key )
+            ||  ( header.mFormat    >= CompressedImage::FORMAT_NONE )
+            ||  ( header.mSwizzle   >  CompressedImage::SWIZZLE_111R )
+            ||  ( 0 == header.mWidth ) || ( 0 == header.mHeight ) || ( 0 == header.mNumPages ) || ( 0 == header.mNumMipLevels ) )
+        {
+            return false ;
+        }
+        const bool layered = header.mLayered != 0 ;
+        if( header.mNumMipLevels > CompressedImage::CountMipLevels( header.mWidth , header.mHeight , header.mNumPages , layered ) )
+        {
+            return false ;
+        }
+        const CompressedImage::FormatE format = static_cast< CompressedImage::FormatE >( header.mFormat ) ;
+        return  ( header.mDataSize == CompressedImage::ComputeSizeInBytes( format , header.mWidth , header.mHeight , header.mNumPages , header.mNumMipLevels , layered ) )
+            &&  ( sizeof( header ) + header.mDataSize <= fileSize ) ;
+    }
+
+
+
+
+    /// Callback that ReadCacheFile calls with the entire contents of a cache file, which returns whether it accepted them.
+    typedef bool ( * ConsumeCacheFileT )( const void * contents , unsigned long long fileSize , unsigned long long key , void * destination ) ;
+
+
+
+
+    /** Pass the entire contents of the given cache file to the given callback.
+
+        \return Whether the file exists, has at least a header, and the callback accepted its contents.
+
+        On Windows this maps the file, so the only copy is from the file cache
+        into the destination, and reading happens only as the copy touches pages.
+    */
+    static bool ReadCacheFile( const char * filename , size_t headerSize , ConsumeCacheFileT consume , unsigned long long key , void * destination )
+    {
+        bool loaded = false ;
+
+    #if defined( WIN32 )
+        HANDLE file = CreateFileA( filename , GENERIC_READ , FILE_SHARE_READ , NULL , OPEN_EXISTING , FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN , NULL ) ;
+        if( INVALID_HANDLE_VALUE == file )
+        {
+            return false ;
+        }
+        LARGE_INTEGER fileSize ;
+        if( GetFileSizeEx( file , & fileSize ) && ( fileSize.QuadPart >= LONGLONG( headerSize ) ) )
+        {   // File is big enough to have a header.
+            HANDLE fileMapping = CreateFileMappingA( file , NULL , PAGE_READONLY , 0 , 0 , NULL ) ;
+            if( fileMapping )
+            {
+                const void * contents = MapViewOfFile( fileMapping , FILE_MAP_READ , 0 , 0 , 0 ) ;
+                if( contents )
+                {
+                    loaded = consume( contents , static_cast< unsigned long long >( fileSize.QuadPart ) , key , destination ) ;
+                    UnmapViewOfFile( contents ) ;
+                }
+                CloseHandle( fileMapping ) ;
+            }
+        }
+        CloseHandle( file ) ;
+    #else
+        FILE * fp = fopen( filename , "rb" ) ;
+        if( NULL == fp )
+        {
+            return false ;
+        }
+        fseek( fp , 0 , SEEK_END ) ;
+        const long fileSize = ftell( fp ) ;
+        fseek( fp , 0 , SEEK_SET ) ;
+        if( ( fileSize > 0 ) && ( static_cast< size_t >( fileSize ) >= headerSize ) )
+        {   // File is big enough to have a header.
+            VECTOR< unsigned char > contents( static_cast< size_t >( fileSize ) ) ;
+            if( fread( & contents[ 0 ] , 1 , contents.Size() , fp ) == contents.Size() )
+            {
+                loaded = consume( & contents[ 0 ] , static_cast< unsigned long long >( fileSize ) , key , destination ) ;
+            }
+        }
+        fclose( fp ) ;
+    #endif
+
+        return loaded ;
+    }
+
+
+
+
+    /** Write the given header followed by the given data to the given cache file.
+
+        \return Whether writing succeeded.
+
+        This writes to a temporary file then renames it, so a crash or a
+        concurrently starting instance never sees a partially written file.
+    */
+    static bool WriteCacheFile( const char * filename , const void * header , size_t headerSize , const void * data , size_t dataSize )
+    {
+        char tempFilename[ 1024 ] ;
+        if( strlen( filename ) + 5 > sizeof( tempFilename ) )
+        {   // Filename is too long to append suffix.
+            return false ;
+        }
+        strcpy( tempFilename , filename ) ;
+        strcat( tempFilename , ".tmp" ) ;
+
+        FILE * fp = fopen( tempFilename , "wb" ) ;
+        if( NULL == fp )
+        {
+            return false ;
+        }
+        bool ok =       ( fwrite( header , headerSize , 1 , fp ) == 1 )
+                    &&  ( fwrite( data , 1 , dataSize , fp ) == dataSize ) ;
+        ok = ( 0 == fclose( fp ) ) && ok ;
+
+    #if defined( WIN32 )
+        ok = ok && MoveFileExA( tempFilename , filename , MOVEFILE_REPLACE_EXISTING ) ;
+    #else
+        ok = ok && ( 0 == rename( tempFilename , filename ) ) ;
+    #endif
+        if( ! ok )
+        {
+            remove( tempFilename ) ;
+        }
+        return ok ;
+    }
+
+
+
+
+    /** Copy the image a cache file holds into the given Image, if the file header matches the given key.
+    */
+    static bool ConsumeImage( const void * contents , unsigned long long fileSize , unsigned long long key , void * destination )
+    {
+        const ImageCacheHeader & header = * reinterpret_cast< const ImageCacheHeader * >( contents ) ;
+        if( ! ValidateHeader( header , key , fileSize ) )
+        {
+            return false ;
+        }
+        CopyFromHeader( header , * reinterpret_cast< Image * >( destination ) ) ;
+        return true ;
+    }
+
+
+
+
+    /** Copy the compressed image a cache file holds into the given CompressedImage, if the file header matches the given key.
+    */
+    static bool ConsumeCompressedImage( const void * contents , unsigned long long fileSize , unsigned long long key , void * destination )
+    {
+        const CompressedImageCacheHeader & header = * reinterpret_cast< const CompressedImageCacheHeader * >( contents ) ;
+        if( ! ValidateCompressedHeader( header , key , fileSize ) )
+        {
+            return false ;
+        }
+        CompressedImage & compressedImage = * reinterpret_cast< CompressedImage * >( destination ) ;
+        compressedImage.SetShape( static_cast< CompressedImage::FormatE >( header.mFormat ) , static_cast< CompressedImage::SwizzleE >( header.mSwizzle )
+                                , header.mWidth , header.mHeight , header.mNumPages , header.mNumMipLevels , header.mLayered != 0 ) ;
+        memcpy( compressedImage.GetData() , & header + 1 , static_cast< size_t >( header.mDataSize ) ) ;
+        return true ;
+    }
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+    /** Return hash of the given bytes, continuing from the given hash.
+
+        This uses 64-bit FNV-1a, which is cheap and well-distributed enough to
+        tell apart the handful of keys an application uses.  Chain calls to
+        hash several values: Pass the result of one call as hash to the next.
+    */
+    unsigned long long ImageCache_Hash( const void * data , size_t numBytes , unsigned long long hash )
+    {
+        static const unsigned long long sFnvPrime = 1099511628211ULL ;
+
+        const unsigned char * bytes = reinterpret_cast< const unsigned char * >( data ) ;
+        for( size_t i = 0 ; i < numBytes ; ++ i )
+        {
+            hash = ( hash ^ bytes[ i ] ) * sFnvPrime ;
+        }
+        return hash ;
+    }
+
+
+
+
+    /** Return hash of the given nul-terminated string, continuing from the given hash.
+    */
+    unsigned long long ImageCache_HashString( const char * string , unsigned long long hash )
+    {
+        return ImageCache_Hash( string , strlen( string ) , hash ) ;
+    }
+
+
+
+
+    /** Load the image the given cache file holds, if it has the given key.
+
+        \param filename Name of cache file.
+
+        \param key      Hash of what generated the image, which must match the one the file holds.
+
+        \param image    (out) Loaded image, if this succeeds.  Untouched otherwise.  Must not yet have data, as for a default-constructed Image.
+
+        \return Whether the file exists, is intact, and has the given key.
+    */
+    bool ImageCache_Load( const char * filename , unsigned long long key , Image & image )
+    {
+        PERF_BLOCK( ImageCache_Load ) ;
+
+        ASSERT( NULLPTR == image.GetImageData() ) ;
+
+        return ReadCacheFile( filename , sizeof( ImageCacheHeader ) , ConsumeImage , key , & image ) ;
+    }
+
+
+
+
+    /** Write the given image, and the given key, to the given cache file.
+
+        \return Whether writing succeeded.
+    */
+    bool ImageCache_Save( const char * filename , unsigned long long key , const Image & image )
+    {
+        PERF_BLOCK( ImageCache_Save ) ;
+
+        ASSERT( image.GetXStride() == image.GetNumChannels() ) ;                    // Image data must be contiguous,
+        ASSERT( image.GetYStride() == image.GetXStride() * image.GetWidth() ) ;     // as it is for images that own their data,
+        ASSERT( image.GetPageStride() == image.GetYStride() * image.GetHeight() ) ; // not shallow-copy regions.
+
+        ImageCacheHeader header ;
+        memset( & header , 0 , sizeof( header ) ) ;
+        header.mMagic       = ImageCacheHeader::sMagic ;
+        header.mVersion     = ImageCacheHeader::sVersion ;
+        header.mKey         = key ;
+        header.mWidth       = image.GetWidth() ;
+        header.mHeight      = image.GetHeight() ;
+        header.mNumChannels = image.GetNumChannels() ;
+        header.mNumPages    = image.GetNumPages() ;
+        header.mDataSize    = static_cast< unsigned long long >( image.GetPageStride() ) * image.GetNumPages() ;
+
+        return WriteCacheFile( filename , & header , sizeof( header ) , image.GetImageData() , static_cast< size_t >( header.mDataSize ) ) ;
+    }
+
+
+
+
+    /** Load the compressed image the given cache file holds, if it has the given key.
+
+        \param filename         Name of cache file.
+
+        \param key              Hash of what generated the image, and how it got compressed, which must match the one the file holds.
+
+        \param compressedImage  (out) Loaded compressed image, if this succeeds.  Untouched otherwise.  Must be empty.
+
+        \return Whether the file exists, is intact, and has the given key.
+
+        Loading a compressed image skips both generating and compressing it,
+        and reads a quarter to an eighth as many bytes as an uncompressed one.
+    */
+    bool ImageCache_LoadCompressed( const char * filename , unsigned long long key , CompressedImage & compressedImage )
+    {
+        PERF_BLOCK( ImageCache_LoadCompressed ) ;
+
+        ASSERT( compressedImage.IsEmpty() ) ;
+
+        return ReadCacheFile( filename , sizeof( CompressedImageCacheHeader ) , ConsumeCompressedImage , key , & compressedImage ) ;
+    }
+
+
+
+
+    /** Write the given compressed image, and the given key, to the given cache file.
+
+        \return Whether writing succeeded.
+    */
+    bool ImageCache_SaveCompressed( const char * filename , unsigned long long key , const CompressedImage & compressedImage )
+    {
+        PERF_BLOCK( ImageCache_SaveCompressed ) ;
+
+        ASSERT( ! compressedImage.IsEmpty() ) ;
+
+        CompressedImageCacheHeader header ;
+        memset( & header , 0 , sizeof( header ) ) ;
+        header.mMagic           = CompressedImageCacheHeader::sMagic ;
+        header.mVersion         = CompressedImageCacheHeader::sVersion ;
+        header.mKey             = key ;
+        header.mFormat          = compressedImage.GetFormat() ;
+        header.mSwizzle         = compressedImage.GetSwizzle() ;
+        header.mWidth           = compressedImage.GetWidth() ;
+        header.mHeight          = compressedImage.GetHeight() ;
+        header.mNumPages        = compressedImage.GetNumPages() ;
+        header.mNumMipLevels    = compressedImage.GetNumMipLevels() ;
+        header.mLayered         = compressedImage.IsLayered() ? 1 : 0 ;
+        header.mDataSize        = compressedImage.GetSizeInBytes() ;
+
+        return WriteCacheFile( filename , & header , sizeof( header ) , compressedImage.GetData() , compressedImage.GetSizeInBytes() ) ;
+    }
+
+} ;
@@ -0,0 +1,88 @@
+/** \file imageCache.h
+
+    \brief On-disk cache of generated images, laid out so loading can map the file instead of parsing it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef PEGASYS_IMAGE_CACHE_H
+#define PEGASYS_IMAGE_CACHE_H
+
+#include <stddef.h>
+
+namespace PeGaSys
+{
+    class Image ;
+    class CompressedImage ;
+
+    /** Header at the start of an image cache file.
+
+        Raw image data, all pages, follows the header immediately, in the
+        same layout Image uses in memory, so loading is one copy from the
+        mapped file, with no decoding.
+
+        mKey identifies the sequence of operations (and their parameters)
+        that generated the image.  Loading refuses files whose key differs
+        from the one the caller expects, so changing how an image gets made
+        makes its cache file stale, rather than wrong.
+    */
+    struct ImageCacheHeader
+    {
+        static const unsigned sMagic    = 0x4349474d ;  ///< "MGIC" in little-endian byte order.
+        static const unsigned sVersion  = 1 ;           ///< Increment this whenever the file layout changes.
+
+        unsigned            mMagic          ;   ///< Identifies file as an image cache.  Must equal sMagic.
+        unsigned            mVersion        ;   ///< Version of file layout.  Must equal sVersion.
+        unsigned long long  mKey            ;   ///< Hash of what generated the image.
+        unsigned            mWidth          ;   ///< Image width, in pixels.
+        unsigned            mHeight         ;   ///< Image height, in pixels, of each page.
+        unsigned            mNumChannels    ;   ///< Number of channels, one byte each.
+        unsigned            mNumPages       ;   ///< Number of pages.
+        unsigned long long  mDataSize       ;   ///< Number of bytes of image data following this header.
+    } ;
+
+
+
+
+    /** Header at the start of a compressed image cache file.
+
+        Compressed blocks, all MIP levels, finest first, follow the header
+        immediately, in the same layout CompressedImage uses in memory, so
+        the texture can upload straight from what loading copies.
+    */
+    struct CompressedImageCacheHeader
+    {
+        static const unsigned sMagic    = 0x4342474d ;  ///< "MGBC" in little-endian byte order.
+        static const unsigned sVersion  = 1 ;           ///< Increment this whenever the file layout changes.
+
+        unsigned            mMagic          ;   ///< Identifies file as a compressed image cache.  Must equal sMagic.
+        unsigned            mVersion        ;   ///< Version of file layout.  Must equal sVersion.
+        unsigned long long  mKey            ;   ///< Hash of what generated the image, and how it got compressed.
+        unsigned            mFormat         ;   ///< CompressedImage::FormatE.
+        unsigned            mSwizzle        ;   ///< CompressedImage::SwizzleE.
+        unsigned            mWidth          ;   ///< Width, in pixels, of finest MIP level.
+        unsigned            mHeight         ;   ///< Height, in pixels, of each page of finest MIP level.
+        unsigned            mNumPages       ;   ///< Number of pages.
+        unsigned            mNumMipLevels   ;   ///< Number of MIP levels.
+        unsigned            mLayered        ;   ///< 1 if each MIP level holds one surface per page, 0 if pages are stacked.
+        unsigned            mPadding        ;   ///< Unused.  Keeps mDataSize aligned identically for every compiler.
+        unsigned long long  mDataSize       ;   ///< Number of bytes of compressed blocks following this header.
+    } ;
+
+// Public variables --------------------------------------------------------------
+
+    static const unsigned long long ImageCache_sHashSeed = 14695981039346656037ULL ; ///< Initial value for ImageCache_Hash.
+
+// Public functions --------------------------------------------------------------
+
+    extern unsigned long long   ImageCache_Hash( const void * data , size_t numBytes , unsigned long long hash = ImageCache_sHashSeed ) ;
+    extern unsigned long long   ImageCache_HashString( const char * string , unsigned long long hash = ImageCache_sHashSeed ) ;
+    extern bool                 ImageCache_Load( const char * filename , unsigned long long key , Image & image ) ;
+    extern bool                 ImageCache_Save( const char * filename , unsigned long long key , const Image & image ) ;
+    extern bool                 ImageCache_LoadCompressed( const char * filename , unsigned long long key , CompressedImage & compressedImage ) ;
+    extern bool                 ImageCache_SaveCompressed( const char * filename , unsigned long long key , const CompressedImage & compressedImage ) ;
+
+} ;
+
+#endif
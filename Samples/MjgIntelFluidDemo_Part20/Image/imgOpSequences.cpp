@@ -9,15 +9,14 @@
 
 #include "Image/imgOpSequences.h"
 
-#include "Image/Operation/imgOpApplyGamma.h"
 #include "Image/Operation/imgOpBlur.h"
 #include "Image/Operation/imgOpDrawBox.h"
 #include "Image/Operation/imgOpDrawCircle.h"
 #include "Image/Operation/imgOpMakeNoise.h"
 #include "Image/Operation/imgOpOverlay.h"
 #include "Image/Operation/imgOpLinearGradient.h"
+#include "Image/Operation/imgOpLookUpTable.h"
 #include "Image/Operation/imgOpRadialGradient.h"
-#include "Image/Operation/imgOpTint.h"
 
 #include "Core/Performance/PerfBlock.h"
 
@@ -32,8 +31,7 @@ namespace PeGaSys
         const unsigned  numSmoothingPasses  = noise.GetHeight() / 16 ;
         ImgOpMakeNoise::MakeNoise( noise ) ;
         ImgOpBlur::Blur( noise , numSmoothingPasses ) ;
-        ImgOpApplyGamma::ApplyGamma( noise , gamma ) ;
-        ImgOpTint::Tint( noise , tint ) ;
+        ImgOpLookUpTable::LookUp( noise , ImgOpLookUpTable().ComposeGamma( gamma ).ComposeTint( tint ) ) ; // Same as ApplyGamma then Tint, in one pass.
     }
 
 
@@ -47,8 +45,7 @@ namespace PeGaSys
         const unsigned  numSmoothingPasses  = noise.GetHeight() / 16 ;
         ImgOpMakeNoise::MakeNoise( noise ) ;
         ImgOpBlur::Blur( noise , numSmoothingPasses ) ;
-        ImgOpApplyGamma::ApplyGamma( noise , gamma ) ;
-        ImgOpTint::Tint( noise , tint ) ;
+        ImgOpLookUpTable::LookUp( noise , ImgOpLookUpTable().ComposeGamma( gamma ).ComposeTint( tint ) ) ; // Same as ApplyGamma then Tint, in one pass.
         ImgOpLinearGradient::Gradient( noise , Vec2( 0.0f , 1.0f ) , Vec4( 0.1f , 0.1f , 0.1f , 1.0f ) , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) ) ;
     }
 
@@ -70,16 +67,14 @@ namespace PeGaSys
             static const float thickness = 2.1f ;
             ImgOpDrawCircle::DrawCircle( ring , radius , thickness ) ;
             const Vec4 limnTint( tint.x * 0.0f , tint.y * 0.0f , tint.z * 0.0f , tint.w ) ;
-            ImgOpTint::Tint( ring , limnTint ) ;
-            ImgOpOverlay::Overlay( noiseBall , ring , noiseBall ) ;
+            ImgOpOverlay::OverlayTinted( noiseBall , ring , limnTint , noiseBall ) ;
         }
 
         const unsigned  numSmoothingPasses  = noiseBall.GetHeight() / 2 ;
 
         ImgOpBlur::Blur( noiseBall , numSmoothingPasses ) ;
         ImgOpRadialGradient::RadialGradient( noiseBall , /* power */ 1.0f , /* max */ 1.0f , /* alpha component index */ 3 ) ;
-        ImgOpApplyGamma::ApplyGamma( noiseBall , gamma ) ;
-        ImgOpTint::Tint( noiseBall , tint ) ;
+        ImgOpLookUpTable::LookUp( noiseBall , ImgOpLookUpTable().ComposeGamma( gamma ).ComposeTint( tint ) ) ;
     }
 
 
@@ -96,8 +91,7 @@ namespace PeGaSys
             Image frame ;
             frame.CopyShape( noiseBall ) ;
             ImgOpDrawBox::DrawBox( frame , 16 ) ;
-            ImgOpTint::Tint( frame , Vec4( 1.0f , 1.0f , 1.0f , 0.25f ) ) ;
-            ImgOpOverlay::Overlay( noiseBall , frame , noiseBall ) ;
+            ImgOpOverlay::OverlayTinted( noiseBall , frame , Vec4( 1.0f , 1.0f , 1.0f , 0.25f ) , noiseBall ) ;
         }
 
         {   // Inscribe a ring inside the texture.
@@ -106,8 +100,7 @@ namespace PeGaSys
             ring.CopyShape( noiseBall ) ;
             ImgOpDrawCircle::DrawCircle( ring , /* radius */ float( ring.GetWidth() / 2 - 4 ) , /* thickness */ 2.1f ) ;
             ImgOpBlur::Blur( ring , /* num smoothing passes */ 2 ) ;
-            ImgOpTint::Tint( ring , Vec4( 1.0f , 1.0f , 1.0f , 0.5f ) ) ;
-            ImgOpOverlay::Overlay( noiseBall , ring , noiseBall ) ;
+            ImgOpOverlay::OverlayTinted( noiseBall , ring , Vec4( 1.0f , 1.0f , 1.0f , 0.5f ) , noiseBall ) ;
         }
 
         {   // Draw a faint dot at the center of the texture.
@@ -115,8 +108,7 @@ namespace PeGaSys
             dot.CopyShape( noiseBall ) ;
             ImgOpDrawCircle::DrawCircle( dot , /* radius */ 2 , /* thickness */ 2.1f ) ;
             ImgOpBlur::Blur( dot , /* num smoothing passes */ 2 ) ;
-            ImgOpTint::Tint( dot , Vec4( 1.0f , 1.0f , 1.0f , 0.25f ) ) ;
-            ImgOpOverlay::Overlay( noiseBall , dot , noiseBall ) ;
+            ImgOpOverlay::OverlayTinted( noiseBall , dot , Vec4( 1.0f , 1.0f , 1.0f , 0.25f ) , noiseBall ) ;
         }
     }
 
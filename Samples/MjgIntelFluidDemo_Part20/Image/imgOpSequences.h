@@ -15,6 +15,9 @@ namespace PeGaSys
 {
     class Image ;
 
+    /// Version of the images these sequences make.  Increment this whenever any sequence, or operation it uses, changes its output, so images cached from older versions become stale.
+    static const unsigned ImgOpSeq_sVersion = 1 ;
+
     void ImgOpSeq_Noise( Image & noise , float gamma , const Vec4 & tint ) ;
     void ImgOpSeq_GradientNoise( Image & noise , float gamma , const Vec4 & tint ) ;
     void ImgOpSeq_NoiseBall( Image & noiseBall , float gamma , const Vec4 & tint ) ;
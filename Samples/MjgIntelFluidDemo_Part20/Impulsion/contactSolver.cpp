@@ -0,0 +1,415 @@
+/** \file contactSolver.cpp
+
+    \brief Collision detection and response between rigid bodies, with contacts cached across steps.
+
+    \author Copyright 2012 MJG; All rights reserved.
+*/
+
+#include "contactSolver.h"
+
+#include "physicalObject.h"
+
+#include "Collision/sphereShape.h"
+#include "Collision/convexPolytope.h"
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/parallelExecution.h>
+
+#include <algorithm>
+
+#include <float.h>
+
+namespace Impulsion
+{
+
+    // Types -----------------------------------------------------------------------
+    // Private variables -----------------------------------------------------------
+
+    /// Smallest cosine of angle between contact normals, on consecutive steps, for which the previous impulse still applies.
+    static const float sMinNormalCoherence          = 0.9f ;
+
+    /// Penetration depth tolerated without correction, so resting contacts do not jitter.
+    static const float sPenetrationSlop             = 1.0e-3f ;
+
+    /// Fraction of penetration, beyond the slop, to remove per step.
+    static const float sPenetrationRecovery         = 0.2f ;
+
+    /// Approach speed below which contacts do not bounce, so resting contacts come to rest.
+    static const float sRestitutionSpeedThreshold   = 1.0e-2f ;
+
+    // Public variables ------------------------------------------------------------
+    // Private functions -----------------------------------------------------------
+
+    /** Return root of the tree containing the given body, in a union-find forest.
+
+        This halves the path as it goes, so later queries visit fewer nodes.
+    */
+    static unsigned FindIslandRoot( VECTOR< unsigned > & roots , unsigned idx )
+    {
+        while( roots[ idx ] != idx )
+        {   // Body is not the root of its tree.
+            roots[ idx ] = roots[ roots[ idx ] ] ;
+            idx = roots[ idx ] ;
+        }
+        return idx ;
+    }
+
+    /** Return speed, along the contact normal, at which body B moves away from body A at the contact point.
+
+        Negative values mean the bodies approach each other.
+    */
+    static float RelativeNormalSpeed( const RigidBody & bodyA , const RigidBody & bodyB , const Vec3 & contactPosition , const Vec3 & contactNormal )
+    {
+        const Vec3 rA           = contactPosition - bodyA.GetPosition() ;
+        const Vec3 rB           = contactPosition - bodyB.GetPosition() ;
+        const Vec3 velocityA    = bodyA.GetVelocity() + ( bodyA.GetAngularVelocity() ^ rA ) ;
+        const Vec3 velocityB    = bodyB.GetVelocity() + ( bodyB.GetAngularVelocity() ^ rB ) ;
+        return ( velocityB - velocityA ) * contactNormal ;
+    }
+
+
+
+
+    /** Apply equal and opposite impulses to the given bodies at the contact point, pushing body B along the contact normal.
+    */
+    static void ApplyContactImpulse( RigidBody & bodyA , RigidBody & bodyB , const Vec3 & contactPosition , const Vec3 & contactNormal , float impulseMagnitude )
+    {
+        const Vec3 impulse = contactNormal * impulseMagnitude ;
+        bodyA.ApplyImpulseAt( - impulse , contactPosition ) ;
+        bodyB.ApplyImpulseAt(   impulse , contactPosition ) ;
+    }
+
+    // Public functions ------------------------------------------------------------
+
+    /** Discard cached contacts and broad phase order, e.g. because the set of bodies changed.
+    */
+    void ContactSolver::Clear()
+    {
+        mBroadphase.Clear() ;
+        mPhysicalObjects.Clear() ;
+        mContacts.Clear() ;
+        mContactsPrevious.Clear() ;
+    }
+
+
+
+
+    /** Detect contacts between the given bodies and apply impulses to resolve them.
+
+        \param physicalObjects  Bodies to collide with each other.  When these
+                                differ from those given to the previous call,
+                                this discards cached contacts.
+
+        \param timeStep         Duration of the upcoming step.  Call this before
+                                integrating bodies over that step, so the
+                                integration uses the resolved velocities.
+    */
+    void ContactSolver::Solve( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep )
+    {
+        PERF_BLOCK( ContactSolver__Solve ) ;
+
+        if( physicalObjects != mPhysicalObjects )
+        {   // Caller changed bodies, so cached contacts and order refer to other bodies.
+            Clear() ;
+            mPhysicalObjects = physicalObjects ;
+        }
+
+        // Gather bounding spheres of bodies that participate.
+        mBounds.Clear() ;
+        mIdxPhysObjs.Clear() ;
+        const size_t numPhysObjs = physicalObjects.Size() ;
+        for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+        {   // For each body in the simulation...
+            const PhysicalObject &          physObj = * physicalObjects[ idxPhysObj ] ;
+            const Collision::ShapeBase *    shape   = physObj.GetCollisionShape() ;
+            if( ! shape->IsHole() && ( shape->GetBoundingSphereRadius() >= 0.0f ) )
+            {   // Body is solid and has a bounding sphere.
+                mBounds.PushBack( Collision::Sphere( physObj.GetBody()->GetPosition() , shape->GetBoundingSphereRadius() ) ) ;
+                mIdxPhysObjs.PushBack( idxPhysObj ) ;
+            }
+        }
+
+        mBroadphase.Update( mBounds ) ;
+
+        // Find contacts, and carry over impulses from contacts between the same pair on the previous step.
+        // Since mIdxPhysObjs increases monotonically, both lists are sorted by physical object indices, so one pass merges them.
+        std::swap( mContacts , mContactsPrevious ) ;
+        mContacts.Clear() ;
+        const VECTOR< Collision::SweepAndPrune::Pair > &    pairs           = mBroadphase.GetPairs() ;
+        const size_t                                        numPairs        = pairs.Size() ;
+        const size_t                                        numPrevious     = mContactsPrevious.Size() ;
+        size_t                                              idxPrevious     = 0 ;
+        for( unsigned idxPair = 0 ; idxPair < numPairs ; ++ idxPair )
+        {   // For each pair whose bounding spheres overlap...
+            Contact contact ;
+            contact.mIdxA = mIdxPhysObjs[ pairs[ idxPair ].mIdxA ] ;
+            contact.mIdxB = mIdxPhysObjs[ pairs[ idxPair ].mIdxB ] ;
+            if( ! FindContact( contact , * physicalObjects[ contact.mIdxA ] , * physicalObjects[ contact.mIdxB ] ) )
+            {   // Bodies do not touch.
+                continue ;
+            }
+            const Collision::SweepAndPrune::Pair pair( contact.mIdxA , contact.mIdxB ) ;
+            while( ( idxPrevious < numPrevious ) && ( Collision::SweepAndPrune::Pair( mContactsPrevious[ idxPrevious ].mIdxA , mContactsPrevious[ idxPrevious ].mIdxB ) < pair ) )
+            {   // Previous contact belongs to a pair that no longer touches.
+                ++ idxPrevious ;
+            }
+            if(     ( idxPrevious < numPrevious )
+                &&  ( Collision::SweepAndPrune::Pair( mContactsPrevious[ idxPrevious ].mIdxA , mContactsPrevious[ idxPrevious ].mIdxB ) == pair )
+                &&  ( mContactsPrevious[ idxPrevious ].mNormal * contact.mNormal >= sMinNormalCoherence ) )
+            {   // Same pair touched on previous step, in about the same direction.  Reuse its impulse.
+                contact.mNormalImpulse = mContactsPrevious[ idxPrevious ].mNormalImpulse ;
+            }
+            mContacts.PushBack( contact ) ;
+        }
+
+        FindIslands( numPhysObjs ) ;
+
+        const size_t numIslands = mIslands.Size() ;
+        Parallel::For( 0 , numIslands , 1 , Parallel::Method( this , & ContactSolver::SolveIslandsSlice , physicalObjects , timeStep ) ) ;
+    }
+
+
+
+
+    /** Solve contacts of the given range of islands.
+
+        \param idxIslandBegin   Index of first island to solve.
+
+        \param idxIslandEnd     One past index of last island to solve.
+
+        Islands share no bodies, so separate threads can solve separate ranges concurrently.
+    */
+    void ContactSolver::SolveIslandsSlice( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep , size_t idxIslandBegin , size_t idxIslandEnd )
+    {
+        for( size_t idxIsland = idxIslandBegin ; idxIsland < idxIslandEnd ; ++ idxIsland )
+        {   // For each island in this slice...
+            const Island & island = mIslands[ idxIsland ] ;
+            PrepareContacts( physicalObjects , timeStep , island ) ;
+            WarmStart( physicalObjects , island ) ;
+            ApplyImpulses( physicalObjects , island ) ;
+        }
+    }
+
+
+
+
+    /** Compute contact between the given bodies, if they touch.
+
+        \param contact  (in) Indices of bodies.  (out) Normal, position and penetration, plus zero impulse.
+
+        \return Whether the bodies touch.
+
+        Supports spheres against spheres and spheres against convex polytopes.
+    */
+    bool ContactSolver::FindContact( Contact & contact , const PhysicalObject & physObjA , const PhysicalObject & physObjB ) const
+    {
+        const Collision::ShapeBase *    shapeA      = physObjA.GetCollisionShape() ;
+        const Collision::ShapeBase *    shapeB      = physObjB.GetCollisionShape() ;
+        const RigidBody &               bodyA       = * physObjA.GetBody() ;
+        const RigidBody &               bodyB       = * physObjB.GetBody() ;
+        const bool                      isSphereA   = shapeA->GetShapeType() == Collision::SphereShape::sShapeType ;
+        const bool                      isSphereB   = shapeB->GetShapeType() == Collision::SphereShape::sShapeType ;
+
+        contact.mNormalImpulse  = 0.0f ;
+        contact.mNormalMass     = 0.0f ;
+        contact.mTargetSpeed    = 0.0f ;
+        contact.mIdxIsland      = 0 ;
+
+        if( isSphereA && isSphereB )
+        {   // Sphere touches sphere.
+            const Vec3  separation  = bodyB.GetPosition() - bodyA.GetPosition() ;
+            const float distance    = separation.Magnitude() ;
+            const float radiusA     = shapeA->GetBoundingSphereRadius() ;
+            const float radiusB     = shapeB->GetBoundingSphereRadius() ;
+            contact.mPenetration    = radiusA + radiusB - distance ;
+            if( contact.mPenetration <= 0.0f )
+            {   // Spheres do not touch.
+                return false ;
+            }
+            contact.mNormal         = ( distance > FLT_EPSILON ) ? ( separation / distance ) : Vec3( 0.0f , 0.0f , 1.0f ) ;
+            contact.mPosition       = bodyA.GetPosition() + contact.mNormal * ( radiusA - 0.5f * contact.mPenetration ) ;
+            return true ;
+        }
+        else if(    ( isSphereA && ( shapeB->GetShapeType() == Collision::ConvexPolytope::sShapeType ) )
+                ||  ( isSphereB && ( shapeA->GetShapeType() == Collision::ConvexPolytope::sShapeType ) ) )
+        {   // Sphere touches polytope.
+            const RigidBody &                   sphereBody      = isSphereA ? bodyA : bodyB ;
+            const RigidBody &                   polytopeBody    = isSphereA ? bodyB : bodyA ;
+            const float                         sphereRadius    = ( isSphereA ? shapeA : shapeB )->GetBoundingSphereRadius() ;
+            const Collision::ConvexPolytope &   polytope        = * static_cast< const Collision::ConvexPolytope * >( isSphereA ? shapeB : shapeA ) ;
+            unsigned                            idxPlane        = 0 ;
+            const float distance = polytope.ContactDistanceSphere( sphereBody.GetPosition() , sphereRadius , polytopeBody.GetPosition() , polytopeBody.GetOrientation() , idxPlane ) ;
+            if( distance >= 0.0f )
+            {   // Sphere lies outside polytope.
+                return false ;
+            }
+            Vec3 outwardNormal ;   // Direction from polytope toward sphere.
+            polytope.ContactPoint( sphereBody.GetPosition() , polytopeBody.GetOrientation() , idxPlane , distance , outwardNormal ) ;
+            contact.mPenetration    = - distance ;
+            contact.mNormal         = isSphereA ? - outwardNormal : outwardNormal ;
+            // Place contact midway between the deepest point of the sphere and the face it penetrates.
+            contact.mPosition       = sphereBody.GetPosition() - outwardNormal * ( sphereRadius + 0.5f * distance ) ;
+            return true ;
+        }
+
+        // Collision provides no query for this pair of shapes, e.g. polytope against polytope.
+        return false ;
+    }
+
+
+
+
+    /** Group contacts into islands, i.e. connected components of the contact graph.
+
+        \param numPhysObjs  Number of bodies, touching or not.
+
+        Bodies that touch nothing belong to no island; they need no contact solve.
+    */
+    void ContactSolver::FindIslands( size_t numPhysObjs )
+    {
+        mIslands.Clear() ;
+        mIslandContacts.Clear() ;
+
+        const size_t numContacts = mContacts.Size() ;
+        if( 0 == numContacts )
+        {   // Nothing touches.
+            return ;
+        }
+
+        // Join bodies connected by each contact.
+        mIslandRoots.Resize( numPhysObjs ) ;
+        for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+        {   // For each body...
+            mIslandRoots[ idxPhysObj ] = idxPhysObj ;
+        }
+        for( unsigned idxContact = 0 ; idxContact < numContacts ; ++ idxContact )
+        {   // For each contact...
+            const unsigned rootA = FindIslandRoot( mIslandRoots , mContacts[ idxContact ].mIdxA ) ;
+            const unsigned rootB = FindIslandRoot( mIslandRoots , mContacts[ idxContact ].mIdxB ) ;
+            mIslandRoots[ Max2( rootA , rootB ) ] = Min2( rootA , rootB ) ;
+        }
+
+        // Count contacts per island.
+        static const unsigned sNoIsland = ~0U ;
+        VECTOR< unsigned > & islandOfRoot = mIslandOfRoot ;
+        islandOfRoot.Clear() ;
+        islandOfRoot.Resize( numPhysObjs , sNoIsland ) ;
+        for( unsigned idxContact = 0 ; idxContact < numContacts ; ++ idxContact )
+        {   // For each contact...
+            const unsigned root = FindIslandRoot( mIslandRoots , mContacts[ idxContact ].mIdxA ) ;
+            if( sNoIsland == islandOfRoot[ root ] )
+            {   // First contact in this island.
+                islandOfRoot[ root ] = static_cast< unsigned >( mIslands.Size() ) ;
+                Island island ;
+                island.mBegin = island.mEnd = 0 ;
+                mIslands.PushBack( island ) ;
+            }
+            ++ mIslands[ islandOfRoot[ root ] ].mEnd ;
+        }
+
+        // Convert counts to ranges.
+        const size_t numIslands = mIslands.Size() ;
+        unsigned offset = 0 ;
+        for( unsigned idxIsland = 0 ; idxIsland < numIslands ; ++ idxIsland )
+        {   // For each island...
+            Island & rIsland = mIslands[ idxIsland ] ;
+            const unsigned count = rIsland.mEnd ;
+            rIsland.mBegin = rIsland.mEnd = offset ;
+            offset += count ;
+        }
+
+        // Replace each body root with its island index, then scatter contacts into their island ranges.
+        for( unsigned idxContact = 0 ; idxContact < numContacts ; ++ idxContact )
+        {   // For each contact...
+            Contact & rContact = mContacts[ idxContact ] ;
+            rContact.mIdxIsland = islandOfRoot[ FindIslandRoot( mIslandRoots , rContact.mIdxA ) ] ;
+        }
+        mIslandContacts.Resize( numContacts ) ;
+        for( unsigned idxContact = 0 ; idxContact < numContacts ; ++ idxContact )
+        {   // For each contact...
+            Island & rIsland = mIslands[ mContacts[ idxContact ].mIdxIsland ] ;
+            mIslandContacts[ rIsland.mEnd ] = idxContact ;
+            ++ rIsland.mEnd ;
+        }
+    }
+
+
+
+
+    /** Compute, for each contact, the effective mass along its normal and the separation speed to attain.
+
+        This uses velocities before warm-starting, so restitution responds to
+        the actual approach speed.
+    */
+    void ContactSolver::PrepareContacts( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep , const Island & island )
+    {
+        const float oneOverTimeStep = ( timeStep > 0.0f ) ? ( 1.0f / timeStep ) : 0.0f ;
+        for( unsigned idxInIsland = island.mBegin ; idxInIsland < island.mEnd ; ++ idxInIsland )
+        {   // For each contact in this island...
+            Contact &                   rContact    = mContacts[ mIslandContacts[ idxInIsland ] ] ;
+            const PhysicalObject &      physObjA    = * physicalObjects[ rContact.mIdxA ] ;
+            const PhysicalObject &      physObjB    = * physicalObjects[ rContact.mIdxB ] ;
+            const RigidBody &           bodyA       = * physObjA.GetBody() ;
+            const RigidBody &           bodyB       = * physObjB.GetBody() ;
+            const Vec3 &                normal      = rContact.mNormal ;
+            const Vec3                  rA          = rContact.mPosition - bodyA.GetPosition() ;
+            const Vec3                  rB          = rContact.mPosition - bodyB.GetPosition() ;
+            const Vec3                  angularA    = ( bodyA.GetInverseInertiaTensor() * ( rA ^ normal ) ) ^ rA ;
+            const Vec3                  angularB    = ( bodyB.GetInverseInertiaTensor() * ( rB ^ normal ) ) ^ rB ;
+            const float                 normalMass  = bodyA.GetReciprocalMass() + bodyB.GetReciprocalMass() + ( angularA + angularB ) * normal ;
+            rContact.mNormalMass = ( normalMass > 0.0f ) ? ( 1.0f / normalMass ) : 0.0f ;
+
+            const float approachSpeed   = RelativeNormalSpeed( bodyA , bodyB , rContact.mPosition , normal ) ;
+            const float restitution     = Min2( physObjA.GetFrictionProperties().mRestitution , physObjB.GetFrictionProperties().mRestitution ) ;
+            const float bounceSpeed     = ( approachSpeed < - sRestitutionSpeedThreshold ) ? ( - restitution * approachSpeed ) : 0.0f ;
+            const float recoverySpeed   = sPenetrationRecovery * Max2( rContact.mPenetration - sPenetrationSlop , 0.0f ) * oneOverTimeStep ;
+            rContact.mTargetSpeed = Max2( bounceSpeed , recoverySpeed ) ;
+        }
+    }
+
+
+
+
+    /** Apply, to each contact, the impulse it accumulated on the previous step.
+    */
+    void ContactSolver::WarmStart( const VECTOR< PhysicalObject * > & physicalObjects , const Island & island )
+    {
+        for( unsigned idxInIsland = island.mBegin ; idxInIsland < island.mEnd ; ++ idxInIsland )
+        {   // For each contact in this island...
+            const Contact & contact = mContacts[ mIslandContacts[ idxInIsland ] ] ;
+            if( contact.mNormalImpulse > 0.0f )
+            {   // Contact persisted from previous step.
+                ApplyContactImpulse( * physicalObjects[ contact.mIdxA ]->GetBody() , * physicalObjects[ contact.mIdxB ]->GetBody() , contact.mPosition , contact.mNormal , contact.mNormalImpulse ) ;
+            }
+        }
+    }
+
+
+
+
+    /** Iteratively apply impulses to each contact until bodies separate at their target speeds.
+
+        Each contact accumulates its total impulse, and that total never goes
+        negative, so later iterations can undo excess impulse from earlier ones
+        (including from warm-starting) without ever pulling bodies together.
+    */
+    void ContactSolver::ApplyImpulses( const VECTOR< PhysicalObject * > & physicalObjects , const Island & island )
+    {
+        for( unsigned iter = 0 ; iter < mNumIterations ; ++ iter )
+        {   // For each iteration...
+            for( unsigned idxInIsland = island.mBegin ; idxInIsland < island.mEnd ; ++ idxInIsland )
+            {   // For each contact in this island...
+                Contact &       rContact        = mContacts[ mIslandContacts[ idxInIsland ] ] ;
+                RigidBody &     bodyA           = * physicalObjects[ rContact.mIdxA ]->GetBody() ;
+                RigidBody &     bodyB           = * physicalObjects[ rContact.mIdxB ]->GetBody() ;
+                const float     separationSpeed = RelativeNormalSpeed( bodyA , bodyB , rContact.mPosition , rContact.mNormal ) ;
+                const float     impulseChange   = ( rContact.mTargetSpeed - separationSpeed ) * rContact.mNormalMass ;
+                const float     impulseBefore   = rContact.mNormalImpulse ;
+                rContact.mNormalImpulse = Max2( impulseBefore + impulseChange , 0.0f ) ;
+                ApplyContactImpulse( bodyA , bodyB , rContact.mPosition , rContact.mNormal , rContact.mNormalImpulse - impulseBefore ) ;
+            }
+        }
+    }
+
+
+} ;
@@ -0,0 +1,130 @@
+/** \file contactSolver.h
+
+    \brief Collision detection and response between rigid bodies, with contacts cached across steps.
+
+    \author Copyright 2012 MJG; All rights reserved.
+*/
+#ifndef IMPULSION_CONTACT_SOLVER_H
+#define IMPULSION_CONTACT_SOLVER_H
+
+#include "Core/Math/vec3.h"
+
+#include "Core/Containers/vector.h"
+
+#include "Collision/sweepAndPrune.h"
+
+namespace Impulsion
+{
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether the simulation resolves contacts between rigid bodies, using ContactSolver.
+
+    Otherwise, bodies interact only with fluid, and pass through each other.
+*/
+#define USE_RIGID_BODY_CONTACTS 1
+
+// Types -----------------------------------------------------------------------
+
+class PhysicalObject ;
+
+/** Collision detection and response between rigid bodies, with contacts cached across steps.
+
+    Each step, this finds pairs of bodies whose bounding spheres overlap, using
+    a sweep-and-prune broad phase, computes a contact for each pair that
+    actually touches, then applies impulses to each contact, iteratively, until
+    the bodies no longer approach each other.
+
+    Contacts between the same pair of bodies tend to persist over many steps,
+    and the impulse each needs changes little from one step to the next.  So
+    this caches, per pair, the total impulse applied during the previous step,
+    then applies that impulse before iterating ("warm-starting").  That way,
+    stacked and resting bodies converge in a few iterations, instead of
+    rebuilding their impulses from zero every step.
+
+    Contacts only couple the bodies they touch, so this partitions bodies into
+    islands, i.e. connected components of the graph whose nodes are bodies and
+    whose edges are contacts, then solves islands concurrently.  Islands share
+    no bodies, so solving them in any order, on any thread, yields the same
+    result as solving them serially.
+
+    Bodies that are holes (i.e. containers) do not participate, and neither do
+    pairs of convex polytopes, since Collision does not yet provide a query
+    between polytopes.
+*/
+class ContactSolver
+{
+    public:
+        ContactSolver()
+            : mNumIterations( 4 )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        void Clear() ;
+        void Solve( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep ) ;
+
+        /// Set number of times to visit each contact per step.  More iterations converge better, but cost more.
+        void SetNumIterations( unsigned numIterations ) { mNumIterations = numIterations ; }
+        const unsigned & GetNumIterations() const { return mNumIterations ; }
+
+        /// Return number of contacts found by most recent Solve.
+        size_t GetNumContacts() const { return mContacts.Size() ; }
+
+        /// Return total normal impulse applied to the given contact during most recent Solve.
+        const float & GetContactImpulse( size_t idxContact ) const { return mContacts[ idxContact ].mNormalImpulse ; }
+
+        /// Return number of islands found by most recent Solve.
+        size_t GetNumIslands() const { return mIslands.Size() ; }
+
+        void SolveIslandsSlice( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep , size_t idxIslandBegin , size_t idxIslandEnd ) ;
+
+    private:
+        /** Point where two bodies touch, along with quantities the solver reuses across iterations and steps.
+        */
+        struct Contact
+        {
+            unsigned    mIdxA               ;   ///< Index, into physicalObjects, of first body.  Less than mIdxB.
+            unsigned    mIdxB               ;   ///< Index, into physicalObjects, of second body.
+            Vec3        mNormal             ;   ///< Direction, in world space, from first body toward second.
+            Vec3        mPosition           ;   ///< Contact point in world space.
+            float       mPenetration        ;   ///< Depth of overlap between bodies.  Positive means overlapping.
+            float       mNormalImpulse      ;   ///< Total impulse applied along mNormal.  Never negative.  Persists across steps.
+            float       mNormalMass         ;   ///< Reciprocal of effective mass along mNormal.
+            float       mTargetSpeed        ;   ///< Separation speed solver tries to attain, from restitution and penetration recovery.
+            unsigned    mIdxIsland          ;   ///< Index of island this contact belongs to.
+        } ;
+
+        /** Range, within mIslandContacts, of contacts whose bodies form one island.
+        */
+        struct Island
+        {
+            unsigned    mBegin  ;   ///< Index, into mIslandContacts, of first contact in this island.
+            unsigned    mEnd    ;   ///< One past index, into mIslandContacts, of last contact in this island.
+        } ;
+
+        bool FindContact( Contact & contact , const PhysicalObject & physObjA , const PhysicalObject & physObjB ) const ;
+        void FindIslands( size_t numPhysObjs ) ;
+        void PrepareContacts( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep , const Island & island ) ;
+        void WarmStart( const VECTOR< PhysicalObject * > & physicalObjects , const Island & island ) ;
+        void ApplyImpulses( const VECTOR< PhysicalObject * > & physicalObjects , const Island & island ) ;
+
+        Collision::SweepAndPrune    mBroadphase         ;   ///< Finds pairs of bodies whose bounding spheres overlap.  Sorted order persists across steps.
+        VECTOR< PhysicalObject * >  mPhysicalObjects    ;   ///< Bodies given to most recent Solve, to detect when the caller changes them.
+        VECTOR< Collision::Sphere > mBounds             ;   ///< Scratch space: Bounding spheres of participating bodies.
+        VECTOR< unsigned >          mIdxPhysObjs        ;   ///< Scratch space: Index, into physicalObjects, of body associated with each element of mBounds.
+        VECTOR< Contact >           mContacts           ;   ///< Contacts found during most recent Solve, sorted by pair.  Source of warm-start impulses.
+        VECTOR< Contact >           mContactsPrevious   ;   ///< Scratch space: Contacts from previous step, while merging with new contacts.
+        VECTOR< unsigned >          mIslandRoots        ;   ///< Scratch space: Union-find forest over bodies, used to find islands.
+        VECTOR< unsigned >          mIslandOfRoot       ;   ///< Scratch space: Index of island whose union-find root is each body.
+        VECTOR< unsigned >          mIslandContacts     ;   ///< Indices, into mContacts, grouped by island.
+        VECTOR< Island >            mIslands            ;   ///< Islands of touching bodies, found by most recent Solve.
+        unsigned                    mNumIterations      ;   ///< Number of times to visit each contact per step.
+} ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+} ;
+
+#endif
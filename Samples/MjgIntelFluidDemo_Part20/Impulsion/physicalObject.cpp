@@ -8,6 +8,7 @@
 #include "physicalObject.h"
 
 #include <Core/Performance/perfBlock.h>
+#include <Core/parallelExecution.h>
 
 namespace Impulsion
 {
@@ -20,6 +21,24 @@ namespace Impulsion
 
 
     // Private functions -----------------------------------------------------------
+
+    /** Integrate the given range of rigid bodies associated with physical objects.
+
+        Each body integrates independently, so separate threads can integrate separate ranges concurrently.
+    */
+    static void UpdateBodiesSlice( const VECTOR< PhysicalObject * > & physicalObjects , float timeStep , size_t idxBegin , size_t idxEnd )
+    {
+        for( size_t idxPhysObj = idxBegin ; idxPhysObj < idxEnd ; ++ idxPhysObj )
+        {   // For each body in this slice...
+            RigidBody & rBody = * physicalObjects[ idxPhysObj ]->GetBody() ;
+            // Update body physical state
+            rBody.Update( timeStep ) ;
+        }
+    }
+
+
+
+
     // Public functions ------------------------------------------------------------
 
     void PhysicalObject::SetCollisionShape( Collision::ShapeBase * collisionShape )
@@ -40,12 +59,11 @@ namespace Impulsion
 
         const size_t numPhysObjs = physicalObjects.Size() ;
 
-        for( unsigned idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
-        {   // For each body in the simulation...
-            RigidBody & rBody = * physicalObjects[ idxPhysObj ]->GetBody() ;
-            // Update body physical state
-            rBody.Update( timeStep ) ;
-        }
+        // Estimate grain size based on size of problem and number of processors.
+        // Integrating one body costs little, so do not split into pieces smaller than sMinBodiesPerTask.
+        static const size_t sMinBodiesPerTask = 16 ;
+        const size_t grainSize = Max2( sMinBodiesPerTask , numPhysObjs / gNumberOfProcessors ) ;
+        Parallel::For( 0 , numPhysObjs , grainSize , Parallel::Function( UpdateBodiesSlice , physicalObjects , timeStep ) ) ;
     }
 
 
@@ -47,6 +47,7 @@ namespace Impulsion
             void SetMassAndInertiaTensor( float mass , const Mat33 & inertiaTensor ) ;
 
             void SetInverseInertiaTensor( const Mat33 & inverseInertiaTensor ) { mInvInertiaTensor = inverseInertiaTensor ; }
+            const Mat33 & GetInverseInertiaTensor() const { return mInvInertiaTensor ; }
 
             float GetReciprocalMass() const { return mReciprocalMass ; }
             float GetMass() const { return 1.0f / mReciprocalMass ; }
@@ -0,0 +1,188 @@
+/** \file fluidKernels.cpp
+
+    \brief Select, at startup, which per-pair fluid kernels the processor supports.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "fluidKernels.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+    #include <intrin.h>
+    #define FLUID_KERNELS_X86_MSVC 1
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+    #define FLUID_KERNELS_X86_GCC 1
+#endif
+
+// Private types --------------------------------------------------------------
+
+/// Instruction sets, from least to most capable, for which ISPC compiles fluidKernels.ispc.
+enum FluidKernelTargetE
+{
+    FLUID_KERNEL_TARGET_NONE    ,   ///< Processor lacks every compiled target, so callers use C++ kernels.
+    FLUID_KERNEL_TARGET_SSE4    ,
+    FLUID_KERNEL_TARGET_AVX2    ,
+    FLUID_KERNEL_TARGET_AVX512  ,
+    FLUID_KERNEL_TARGET_NEON
+} ;
+
+// Private variables --------------------------------------------------------------
+
+#if USE_ISPC_KERNELS
+static const FluidKernelTable sIspcKernelTable =
+{
+    FluidKernels_AccumulateVortonVelocity   ,
+    FluidKernels_ComputePseExchangeFractions,
+    FluidKernels_EvaluateSphKernelPairs     ,
+    FluidKernels_AccumulatePushDisplacement
+} ;
+#endif
+
+static bool sEnabled = true ;
+
+// Private functions --------------------------------------------------------------
+
+#if FLUID_KERNELS_X86_MSVC
+/** Return whether the operating system saves the register state that the given XCR0 mask indicates.
+*/
+static bool OsSavesRegisters( int cpuInfo1Ecx , unsigned __int64 xcr0Mask )
+{
+    const int osxsave = 1 << 27 ;
+    if( ! ( cpuInfo1Ecx & osxsave ) )
+    {   // Operating system does not expose XGETBV.
+        return false ;
+    }
+    return ( _xgetbv( 0 ) & xcr0Mask ) == xcr0Mask ;
+}
+#endif
+
+
+
+
+/** Return most capable instruction set, among those ISPC compiled, that this processor supports.
+
+    ISPC picks among compiled x86 targets itself, each time an exported
+    function runs.  This only decides whether any target runs at all, and
+    reports which one, for diagnostics.
+*/
+static FluidKernelTargetE DetectTarget()
+{
+#if FLUID_KERNELS_X86_MSVC
+    int cpuInfo[ 4 ] ;  // eax, ebx, ecx, edx
+    __cpuid( cpuInfo , 0 ) ;
+    const int maxLeaf = cpuInfo[ 0 ] ;
+    __cpuid( cpuInfo , 1 ) ;
+    const int leaf1Ecx = cpuInfo[ 2 ] ;
+    if( ! ( leaf1Ecx & ( 1 << 19 ) ) )
+    {   // Lacks SSE4.1, the least capable target.
+        return FLUID_KERNEL_TARGET_NONE ;
+    }
+    if( ( maxLeaf < 7 ) || ! ( leaf1Ecx & ( 1 << 28 ) ) || ! OsSavesRegisters( leaf1Ecx , 0x6 ) )
+    {   // Lacks AVX, or operating system does not save YMM registers.
+        return FLUID_KERNEL_TARGET_SSE4 ;
+    }
+    __cpuidex( cpuInfo , 7 , 0 ) ;
+    const int leaf7Ebx = cpuInfo[ 1 ] ;
+    if( ! ( leaf7Ebx & ( 1 << 5 ) ) )
+    {   // Lacks AVX2.
+        return FLUID_KERNEL_TARGET_SSE4 ;
+    }
+    // AVX512F, DQ, CD, BW and VL, as ISPC's avx512skx target requires.
+    const int avx512SkxMask = ( 1 << 16 ) | ( 1 << 17 ) | ( 1 << 28 ) | ( 1 << 30 ) | ( 1 << 31 ) ;
+    if( ( ( leaf7Ebx & avx512SkxMask ) == avx512SkxMask ) && OsSavesRegisters( leaf1Ecx , 0xe6 ) )
+    {
+        return FLUID_KERNEL_TARGET_AVX512 ;
+    }
+    return FLUID_KERNEL_TARGET_AVX2 ;
+#elif FLUID_KERNELS_X86_GCC
+    __builtin_cpu_init() ;
+    if( ! __builtin_cpu_supports( "sse4.1" ) )
+    {
+        return FLUID_KERNEL_TARGET_NONE ;
+    }
+    if(     __builtin_cpu_supports( "avx512f"  ) && __builtin_cpu_supports( "avx512dq" ) && __builtin_cpu_supports( "avx512cd" )
+        &&  __builtin_cpu_supports( "avx512bw" ) && __builtin_cpu_supports( "avx512vl" ) )
+    {
+        return FLUID_KERNEL_TARGET_AVX512 ;
+    }
+    if( __builtin_cpu_supports( "avx2" ) )
+    {
+        return FLUID_KERNEL_TARGET_AVX2 ;
+    }
+    return FLUID_KERNEL_TARGET_SSE4 ;
+#elif defined( __aarch64__ ) || defined( _M_ARM64 )
+    // Every AArch64 processor has NEON.
+    return FLUID_KERNEL_TARGET_NEON ;
+#else
+    return FLUID_KERNEL_TARGET_NONE ;
+#endif
+}
+
+
+
+
+/** Return most capable supported instruction set, detecting it on first call.
+*/
+static FluidKernelTargetE GetTarget()
+{
+    static const FluidKernelTargetE sTarget = DetectTarget() ;
+    return sTarget ;
+}
+
+// Public functions --------------------------------------------------------------
+
+namespace FluidKernels
+{
+
+/** Return table of ISPC kernels, or NULL if they are unavailable or disabled, in which case callers use their C++ kernels.
+
+    Returns NULL when built without USE_ISPC_KERNELS, and when the processor
+    supports none of the compiled targets.
+*/
+const FluidKernelTable * GetTable()
+{
+#if USE_ISPC_KERNELS
+    if( sEnabled && ( GetTarget() != FLUID_KERNEL_TARGET_NONE ) )
+    {
+        return & sIspcKernelTable ;
+    }
+#endif
+    return NULL ;
+}
+
+
+
+
+/** Set whether GetTable returns ISPC kernels when available, for example to compare them against C++ kernels.
+
+    Call this before creating simulations, since they select kernels once, when constructed.
+*/
+void SetEnabled( bool enabled )
+{
+    sEnabled = enabled ;
+}
+
+
+
+
+/** Return name of instruction set the ISPC kernels use, for diagnostics.
+*/
+const char * GetTargetName()
+{
+    if( NULL == GetTable() )
+    {
+        return "none" ;
+    }
+    switch( GetTarget() )
+    {
+        case FLUID_KERNEL_TARGET_SSE4   : return "sse4"     ;
+        case FLUID_KERNEL_TARGET_AVX2   : return "avx2"     ;
+        case FLUID_KERNEL_TARGET_AVX512 : return "avx512"   ;
+        case FLUID_KERNEL_TARGET_NEON   : return "neon"     ;
+        default                         : return "none"     ;
+    }
+}
+
+} ;
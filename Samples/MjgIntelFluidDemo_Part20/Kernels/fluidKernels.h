@@ -0,0 +1,137 @@
+/** \file fluidKernels.h
+
+    \brief Optional library of per-pair fluid kernels, compiled by ISPC for several instruction sets.
+
+    \see fluidKernels.ispc
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef FLUID_KERNELS_H
+#define FLUID_KERNELS_H
+
+#include <stddef.h>
+
+#include "Core/Utility/macros.h"
+
+// Macros --------------------------------------------------------------
+
+/** Whether to call kernels that ISPC compiles from fluidKernels.ispc.
+
+    Building with this enabled requires ispc (http://ispc.github.io) on the
+    path, and fluidKernels.ispc included in the build of VortonFluid, which
+    excludes it by default.  Its
+    custom build step compiles for SSE4, AVX2 and AVX-512 in one object
+    library, whose exported functions pick among those at run time.  On ARM,
+    compile with --target=neon-i32x4 instead, since NEON is always present.
+*/
+#if ! defined( USE_ISPC_KERNELS )
+    #define USE_ISPC_KERNELS 0
+#endif
+
+// Types --------------------------------------------------------------
+
+#if USE_ISPC_KERNELS
+/*  Functions that fluidKernels.ispc exports, using the C calling convention.
+
+    Each takes particle positions and sizes as separate components with a
+    stride, in floats, between consecutive particles, so callers can pass
+    either structure-of-arrays (stride 1) or arrays of Particle (stride
+    sizeof(Particle)/sizeof(float)) without copying.  Offsets index with
+    32-bit integers, so arrays must span fewer than 2^31 floats.
+*/
+extern "C"
+{
+    void FluidKernels_AccumulateVortonVelocity( float velocities[] , const float positions[] , int vec3Stride
+                                              , const unsigned queries[] , int numQueries
+                                              , const float px[] , const float py[] , const float pz[]
+                                              , const float wx[] , const float wy[] , const float wz[]
+                                              , const float size[] , int numSources
+                                              , float spreadingRangeFactor , float spreadingCirculationFactor ) ;
+
+    void FluidKernels_ComputePseExchangeFractions( const float px[] , const float py[] , const float pz[] , const float size[] , int stride
+                                                 , const unsigned idxHere[] , const unsigned idxThere[] , int numPairs
+                                                 , float diffusivityTimeStep , float fractions[] ) ;
+
+    void FluidKernels_EvaluateSphKernelPairs( const float px[] , const float py[] , const float pz[] , int stride
+                                            , const unsigned idxA[] , const unsigned idxB[] , int numPairs
+                                            , float oneOverInfluenceRadius2 , float hardCoreRadius
+                                            , float q[] , float oneOverR[] ) ;
+
+    float FluidKernels_AccumulatePushDisplacement( const float px[] , const float py[] , const float pz[] , const float size[] , int stride
+                                                 , unsigned idxHere , const unsigned idxThere[] , int numThere
+                                                 , float gain , float displacement[ 3 ] ) ;
+}
+#endif
+
+/** Table of kernels that FluidKernels::GetTable selects at startup.
+
+    \see fluidKernels.ispc for what each kernel computes.
+*/
+struct FluidKernelTable
+{
+    /// Accumulate velocity that sources induce at each query.  Vectorizes across queries, so query indices must be distinct.  See VORTON_ACCUMULATE_VELOCITY_private.
+    void    ( * mAccumulateVortonVelocity )( float velocities[] , const float positions[] , int vec3Stride
+                                           , const unsigned queries[] , int numQueries
+                                           , const float px[] , const float py[] , const float pz[]
+                                           , const float wx[] , const float wy[] , const float wz[]
+                                           , const float size[] , int numSources
+                                           , float spreadingRangeFactor , float spreadingCirculationFactor ) ;
+
+    /// Compute fraction of strength each pair exchanges, for particle strength exchange.  See VortonSim_ExchangeVorticityPSE_Pair.
+    void    ( * mComputePseExchangeFractions )( const float px[] , const float py[] , const float pz[] , const float size[] , int stride
+                                              , const unsigned idxHere[] , const unsigned idxThere[] , int numPairs
+                                              , float diffusivityTimeStep , float fractions[] ) ;
+
+    /// Compute SPH smoothing kernel q = 1 - r/h, and h/r, for each pair.  Assigns q=0 outside the influence radius and q=-1 inside the hard core.  See SphKernelTable::EvaluateDirect.
+    void    ( * mEvaluateSphKernelPairs )( const float px[] , const float py[] , const float pz[] , int stride
+                                         , const unsigned idxA[] , const unsigned idxB[] , int numPairs
+                                         , float oneOverInfluenceRadius2 , float hardCoreRadius
+                                         , float q[] , float oneOverR[] ) ;
+
+    /// Accumulate displacement that pushes one particle away from overlapping neighbors, and return the largest overlap.  See ComputePushDisplacement.
+    float   ( * mAccumulatePushDisplacement )( const float px[] , const float py[] , const float pz[] , const float size[] , int stride
+                                             , unsigned idxHere , const unsigned idxThere[] , int numThere
+                                             , float gain , float displacement[ 3 ] ) ;
+} ;
+
+
+
+
+/** Fixed-capacity buffer of index pairs, which pair functions fill, then flush through a kernel all at once.
+*/
+struct FluidKernelPairBatch
+{
+    static const unsigned CAPACITY = 256 ;
+
+    FluidKernelPairBatch() : mCount( 0 ) {}
+
+    /// Add a pair, and return whether the batch became full.
+    bool Add( size_t idxHere , size_t idxThere )
+    {
+        ASSERT( mCount < CAPACITY ) ;
+        mHere [ mCount ] = unsigned( idxHere  ) ;
+        mThere[ mCount ] = unsigned( idxThere ) ;
+        ++ mCount ;
+        return CAPACITY == mCount ;
+    }
+
+    unsigned    mHere   [ CAPACITY ]    ;   ///< Index of first particle in each pair.
+    unsigned    mThere  [ CAPACITY ]    ;   ///< Index of second particle in each pair.
+    float       mResultA[ CAPACITY ]    ;   ///< First value the kernel computed for each pair.
+    float       mResultB[ CAPACITY ]    ;   ///< Second value the kernel computed for each pair, for kernels that compute 2.
+    unsigned    mCount                  ;   ///< Number of pairs in batch.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+namespace FluidKernels
+{
+    extern const FluidKernelTable * GetTable() ;
+    extern void                     SetEnabled( bool enabled ) ;
+    extern const char *             GetTargetName() ;
+} ;
+
+#endif
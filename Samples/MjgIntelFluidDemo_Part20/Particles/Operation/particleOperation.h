@@ -10,23 +10,64 @@
 #define PARTICLE_OPERATION_H
 
 #include "../particle.h"
+#include "../particleAttributeView.h"
+
+#include "Core/Memory/newWrapper.h"
+#include "Core/Memory/poolAllocator.h"
 
 // Macros --------------------------------------------------------------
 
 #define VIRTUAL_CONSTRUCTORS( ClassT )                                      \
     /** Virtual constructor: Create another instance of this class. */      \
-    virtual IParticleOperation * Create() { return new ClassT() ; }         \
+    virtual IParticleOperation * Create() { return NEW ClassT() ; }         \
     /** Virtual copy constructor: Clone this object. */                     \
-    virtual IParticleOperation * Clone() { return new ClassT( * this ) ; }
+    virtual IParticleOperation * Clone() { return NEW ClassT( * this ) ; }
+
+/** Number of particles per chunk that a fused pass runs all its operations on, before moving to the next chunk.
 
+    A chunk should fit in cache, so that each operation after the first
+    finds particles still in cache.
+
+    \see IParticleOperation::IsFusable
+*/
+#define PARTICLE_OPERATION_FUSED_CHUNK_SIZE 4096
 
 // Types --------------------------------------------------------------
 
+/** Axis-aligned bounding boxes of consecutive chunks of particles.
+
+    Chunk i contains particles [i*PARTICLE_OPERATION_FUSED_CHUNK_SIZE,(i+1)*PARTICLE_OPERATION_FUSED_CHUNK_SIZE).
+    Renderers use these to skip chunks of particles outside the view.
+*/
+struct ParticleChunkBounds
+{
+    ParticleChunkBounds() : mNumParticles( 0 ) {}
+
+    /// Return number of chunks it takes to hold the given number of particles.
+    static size_t NumChunks( size_t numParticles ) { return ( numParticles + PARTICLE_OPERATION_FUSED_CHUNK_SIZE - 1 ) / PARTICLE_OPERATION_FUSED_CHUNK_SIZE ; }
+
+    /// Return whether these bounds describe exactly the given number of particles.
+    bool Describes( size_t numParticles ) const { return ( mNumParticles == numParticles ) && ( mMinCorners.Size() == NumChunks( numParticles ) ) ; }
+
+    VECTOR< Vec3 >  mMinCorners     ;   ///< Minimal corner of bounding box of each chunk.
+    VECTOR< Vec3 >  mMaxCorners     ;   ///< Maximal corner of bounding box of each chunk.
+    VECTOR< float > mMaxSizes       ;   ///< Largest particle size in each chunk, so callers can enlarge boxes to contain whole particles, not just their centers.
+    size_t          mNumParticles   ;   ///< Number of particles when bounds were found.
+} ;
+
+
+
+
 /** Particle operation abstract base class.
+
+    Operations come from pools (see POOLED_ALLOCATION), since particle
+    systems create them in bulk, and copying a particle system clones them all.
 */
 class IParticleOperation
 {
     public:
+        POOLED_ALLOCATION
+
         /// Construct a particle operation.
         IParticleOperation() {}
 
@@ -41,6 +82,60 @@ class IParticleOperation
 
         /// Perform an operation on the given set of particles over a given duration.
         virtual void Operate( VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) = 0 ;
+
+        /** Return whether this operation acts on each particle independently of all others.
+
+            ParticleGroup runs consecutive fusable operations together, chunk
+            by chunk, in a single pass over particles, instead of streaming
+            all particles through cache once per operation.  Operations that
+            need global state (e.g. bounding boxes), or that add or remove
+            particles, must not claim to be fusable.
+
+            \see OperateOnRange, ParticleGroup::Update
+        */
+        virtual bool IsFusable() const { return false ; }
+
+        /** Prepare for a fused pass over the given particles.
+
+            ParticleGroup calls this once, from one thread, before calling OperateOnRange for each chunk.
+            Operations that reduce over particles (e.g. to find a bounding box) can allocate per-chunk results here.
+        */
+        virtual void BeginFusedPass( const VECTOR< Particle > & /* particles */ , float /* timeStep */ , unsigned /* uFrame */ ) {}
+
+        /** Perform this operation on particles in [iPclBegin,iPclEnd).
+
+            ParticleGroup only calls this when IsFusable returns true, possibly
+            concurrently, on disjoint ranges, from multiple threads.
+            Each range is one chunk, so iPclBegin is a multiple of
+            PARTICLE_OPERATION_FUSED_CHUNK_SIZE.
+        */
+        virtual void OperateOnRange( VECTOR< Particle > & /* particles */ , float /* timeStep */ , unsigned /* uFrame */ , size_t /* iPclBegin */ , size_t /* iPclEnd */ )
+        {
+            FAIL() ; // Operations that claim to be fusable must override this.
+        }
+
+        /** Finish a fused pass, after OperateOnRange has run on every chunk.
+
+            ParticleGroup calls this once, from one thread.
+            Operations that reduce over particles can combine per-chunk results here.
+        */
+        virtual void EndFusedPass() {}
+
+        /** Return bounding boxes of chunks of particles, as of when this operation last ran, or NULL if this operation does not find them.
+
+            \see ParticleGroup::GetChunkBounds
+        */
+        virtual const ParticleChunkBounds * GetChunkBounds() const { return NULLPTR ; }
+
+        /** Return set of particle attributes this operation reads or writes.
+
+            Operations that do not override this claim every attribute.
+            Attributes outside ParticleAttributeE, such as birth time, are not
+            part of any set.
+
+            \see ParticleGroup::GetAttributesUsed
+        */
+        virtual ParticleAttributeMask GetAttributesUsed() const { return PARTICLE_ATTRIBUTE_MASK_ALL ; }
 } ;
 
 // Public variables --------------------------------------------------------------
@@ -36,48 +36,46 @@
 
     \param itEnd One past index of last particle to update.
 
-    \see    Changex87FloatingPointToTruncate, Interpolate_AssumesFpcwSetToTruncate,
-            IndicesOfPosition_AssumesFpcwSetToTruncate, StoreFloatAsInt.
+    \see UniformGrid::InterpolateMany.
 */
 static void AssignParticleVelocityFromField_Slice( VECTOR< Particle > & particles , const UniformGrid< Vec3 > * velocityGrid , float gain , size_t itStart , size_t itEnd )
 {
     ASSERT( itEnd <= particles.Size() ) ;
     ASSERT( velocityGrid && ! velocityGrid->HasZeroExtent() ) ;
 
-    // Change floating-point control word to "truncate" for float-to-int conversion.
-    // The default is "round to nearest", which is not what C++ normally does.
-    // The compiler would normally emit a fldcw instruction per float-to-int operation,
-    // which causes a pipeline flush and is insanely expensive.
-    // This routine therefore uses a special version of Interpolate
-    // which assumes the FPCW is set to "truncate" and uses inline assembly
-    // to bypass the compiler emitting fldcw instructions.
-    // See StoreFloatAsInt.
-    const WORD OldCtrlWord = Changex87FloatingPointToTruncate() ;
-
-    if( 1.0f == gain )
-    {   // Gain is exactly 1 so ignore old velocity and use velocity from grid entirely.
-        for( size_t offset = itStart ; offset < itEnd ; ++ offset )
-        {   // For each particle in this slice...
-            Particle & pcl = particles[ offset ] ;
-            Vec3 velocityFromGrid ;
-            velocityGrid->Interpolate_AssumesFpcwSetToTruncate( velocityFromGrid , pcl.mPosition ) ;
-            pcl.mVelocity = velocityFromGrid ;
+    // Interpolate velocity for batches of particles at a time, so InterpolateMany
+    // can compute indices and weights for several particles at once.
+    // InterpolateMany does not depend on the floating-point control word,
+    // so this routine does not need to change it.
+    static const size_t batchSize = 64 ;
+    Vec3                positions[ batchSize ] ;
+    Vec3                velocitiesFromGrid[ batchSize ] ;
+
+    for( size_t batchBegin = itStart ; batchBegin < itEnd ; batchBegin += batchSize )
+    {   // For each batch of particles in this slice...
+        const size_t numInBatch = Min2( batchSize , itEnd - batchBegin ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each particle in batch...
+            positions[ iInBatch ] = particles[ batchBegin + iInBatch ].mPosition ;
         }
-    }
-    else
-    {
-        for( size_t offset = itStart ; offset < itEnd ; ++ offset )
-        {   // For each particle in this slice...
-            Particle & pcl = particles[ offset ] ;
-            Vec3 velocity ;
-            velocityGrid->Interpolate_AssumesFpcwSetToTruncate( velocity , pcl.mPosition ) ;
-            Vec3 velocityDelta = velocity - pcl.mVelocity ;
-            pcl.mVelocity += gain * velocityDelta ;
+        velocityGrid->InterpolateMany( positions , velocitiesFromGrid , numInBatch ) ;
+        if( 1.0f == gain )
+        {   // Gain is exactly 1 so ignore old velocity and use velocity from grid entirely.
+            for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+            {   // For each particle in batch...
+                particles[ batchBegin + iInBatch ].mVelocity = velocitiesFromGrid[ iInBatch ] ;
+            }
+        }
+        else
+        {
+            for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+            {   // For each particle in batch...
+                Particle & pcl = particles[ batchBegin + iInBatch ] ;
+                Vec3 velocityDelta = velocitiesFromGrid[ iInBatch ] - pcl.mVelocity ;
+                pcl.mVelocity += gain * velocityDelta ;
+            }
         }
     }
-
-    // Restore FPCW.  See comment above.
-    SetFloatingPointControlWord( OldCtrlWord ) ;
 }
 
 
@@ -165,6 +163,17 @@ void PclOpAssignVelocityFromField::Operate( VECTOR< Particle > & particles , flo
 
 
 
+void PclOpAssignVelocityFromField::OperateOnRange( VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    if( mVelocityGrid && ! mVelocityGrid->HasZeroExtent() )
+    {
+        AssignParticleVelocityFromField_Slice( particles , mVelocityGrid , mGridWeight , iPclBegin , iPclEnd ) ;
+    }
+}
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -291,3 +300,11 @@ void PclOpAccelerate::Operate( VECTOR< Particle > & particles , float timeStep ,
 {
     AccelerateParticles( particles , mAcceleration , timeStep ) ;
 }
+
+
+
+
+void PclOpAccelerate::OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    AccelerateParticles_Slice( particles , mAcceleration , timeStep , iPclBegin , iPclEnd ) ;
+}
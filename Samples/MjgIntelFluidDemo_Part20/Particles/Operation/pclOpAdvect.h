@@ -27,6 +27,10 @@ class PclOpAssignVelocityFromField : public IParticleOperation
         
         void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
 
+        bool IsFusable() const { return true ; }
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY ) ; }
+
         const UniformGrid< Vec3  > *    mVelocityGrid   ;   ///< Grid of velocity values.
         float                           mGridWeight     ;   ///< Amount of velocity from grid to assign to particles, each frame.
 } ;
@@ -65,6 +69,10 @@ class PclOpAccelerate : public IParticleOperation
         
         void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
 
+        bool IsFusable() const { return true ; }
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY ) ; }
+
         Vec3    mAcceleration ; ///< Uniform acceleration to apply to particles
 } ;
 
@@ -39,17 +39,29 @@
             could leave the velocity grid boundaries, and this routine needs to interpolate
             within those boundaries.
 
-    \see PopulateDensityAndMassFractionGrids, GenerateBaroclinicVorticity
+    \see PopulateDensityAndMassFractionGrids, GenerateBaroclinicVorticity, UniformGrid::InterpolateMany
 */
 static void AssignScalarFromGridSlice( VECTOR< Particle > & particles , size_t memberOffsetInBytes , const UniformGrid< float > & scalarGrid , size_t iPclStart , size_t iPclEnd )
 {
-    for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
-    {   // For each particle in this slice...
-        Particle &  rParticle = particles[ iPcl ] ;
-        float value ;
-        scalarGrid.Interpolate( value , rParticle.mPosition ) ;
-        *(float*)(((char*)&rParticle) + memberOffsetInBytes) = value ;
-        ASSERT( rParticle.mDensity > 0.0f ) ;
+    // Interpolate for batches of particles at a time.  See AssignParticleVelocityFromField_Slice.
+    static const size_t batchSize = 64 ;
+    Vec3                positions[ batchSize ] ;
+    float               values[ batchSize ] ;
+
+    for( size_t batchBegin = iPclStart ; batchBegin < iPclEnd ; batchBegin += batchSize )
+    {   // For each batch of particles in this slice...
+        const size_t numInBatch = Min2( batchSize , iPclEnd - batchBegin ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each particle in batch...
+            positions[ iInBatch ] = particles[ batchBegin + iInBatch ].mPosition ;
+        }
+        scalarGrid.InterpolateMany( positions , values , numInBatch ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each particle in batch...
+            Particle &  rParticle = particles[ batchBegin + iInBatch ] ;
+            *(float*)(((char*)&rParticle) + memberOffsetInBytes) = values[ iInBatch ] ;
+            ASSERT( rParticle.mDensity > 0.0f ) ;
+        }
     }
 }
 #endif
@@ -189,3 +201,22 @@ void PclOpAssignScalarFromGrid::Operate(  VECTOR< Particle > & particles , float
         DivideByNumParticlesPerCell( particles , ugParticleCount ) ;
     }
 }
+
+
+
+
+void PclOpAssignScalarFromGrid::OperateOnRange( VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    ASSERT( ! mDivideByParticleCount ) ;
+
+#if ENABLE_FLUID_BODY_SIMULATION
+    if( ( 0 == mScalarGrid ) || ( mScalarGrid->HasZeroExtent() ) )
+    {   // Scalar grid is empty.  Probably first iteration.
+        return ; // Nothing to do.
+    }
+
+    AssignScalarFromGridSlice( particles , mMemberOffsetInBytes , * mScalarGrid , iPclBegin , iPclEnd ) ;
+#else
+    (void) particles , iPclBegin , iPclEnd ;
+#endif
+}
@@ -26,6 +26,11 @@ class PclOpAssignScalarFromGrid : public IParticleOperation
 
         void Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ ) ;
 
+        /// Dividing by particle count needs counts over all particles, so only assignment without division can fuse.
+        bool IsFusable() const { return ! mDivideByParticleCount ; }
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBitAtOffset( mMemberOffsetInBytes ) ; }
+
         size_t                          mMemberOffsetInBytes    ;   ///< Offset, in bytes, from start of particle, to scalar member to assign.
         const UniformGrid< float > *    mScalarGrid             ;   ///< Grid of density values
         bool                            mDivideByParticleCount  ;   ///< Whether to divide by number of particles per grid cell.
@@ -11,10 +11,17 @@
 #include "Particles/Operation/pclOpEmit.h"
 
 #include "Particles/particle.h"
+#include "Particles/particleLifecycle.h"
 
 #include "Core/Performance/perfBlock.h"
+#include "Core/Math/counterRng.h"
+#include "Core/Math/math.h"
 
 #include <Core/SpatialPartition/uniformGridMath.h>
+#include <Core/SpatialPartition/uniformGridScatter.h>
+
+#include "Core/useTbb.h"
+#include "Core/parallelExecution.h"
 
 #include <stdlib.h>
 #include <limits>
@@ -23,6 +30,99 @@
 
 static const float  sOneMinusEpsilon        = 1.0f - FLT_EPSILON ;
 
+/* static */ unsigned PclOpEmit::sNumConstructed = 0 ;
+
+
+
+
+/** Describe the view against which to measure how much of the screen emitter regions cover.
+
+    \param eye         Position of camera.
+
+    \param target      Position camera looks at.
+
+    \param fieldOfViewVertDegrees  Vertical field of view, in degrees.
+
+    \param aspectRatio Ratio of viewport width to height.
+*/
+void EmissionLod::SetView( const Vec3 & eye , const Vec3 & target , float fieldOfViewVertDegrees , float aspectRatio )
+{
+    mEye            = eye ;
+    mForward        = ( target - eye ).GetDir() ;
+    mTanHalfFovVert = tanf( 0.5f * fieldOfViewVertDegrees * DEG2RAD ) ;
+    mAspectRatio    = aspectRatio ;
+    mEnabled        = ( mTanHalfFovVert > 0.0f ) && ( mAspectRatio > 0.0f ) ;
+}
+
+
+
+
+/** Return fraction of full emission appropriate for a region of the given center and radius.
+
+    \return Ratio of the fraction of screen area the region covers to
+            mFullDetailScreenFraction, clamped to [mMinFraction,1].
+            Regions outside the view get mMinFraction, rather than nothing,
+            so they still add some mass when the view turns toward them.
+            Regions that contain the eye get full detail.
+
+    This approximates the view frustum by the cone that circumscribes it, and
+    the projection of the region by a disc, which suffice to choose detail.
+*/
+float EmissionLod::ComputeFraction( const Vec3 & center , float radius ) const
+{
+    if( ! mEnabled )
+    {   // No view.
+        return 1.0f ;
+    }
+
+    const Vec3  toCenter    = center - mEye ;
+    const float depth       = toCenter * mForward ;
+    const float lateral     = ( toCenter - depth * mForward ).Magnitude() ;
+
+    // Test region against cone that circumscribes view frustum.
+    const float tanHalfFovDiag  = mTanHalfFovVert * sqrtf( 1.0f + mAspectRatio * mAspectRatio ) ;
+    const float cosHalfFovDiag  = 1.0f / sqrtf( 1.0f + tanHalfFovDiag * tanHalfFovDiag ) ;
+    const float sinHalfFovDiag  = tanHalfFovDiag * cosHalfFovDiag ;
+    if( lateral * cosHalfFovDiag - depth * sinHalfFovDiag > radius )
+    {   // Region lies entirely outside view.
+        return mMinFraction ;
+    }
+
+    if( depth <= radius )
+    {   // Eye lies inside or beside region, which therefore fills much of the view.
+        return 1.0f ;
+    }
+
+    // Radius of projected disc, in units of half viewport height.  Viewport spans 2 by 2*aspect of those units.
+    const float projectedRadius = radius / ( depth * mTanHalfFovVert ) ;
+    const float screenFraction  = PI * projectedRadius * projectedRadius / ( 4.0f * mAspectRatio ) ;
+    return Clamp( screenFraction / mFullDetailScreenFraction , mMinFraction , 1.0f ) ;
+}
+
+
+
+
+/** Density deviation sources for UniformGridScatter, one per particle.
+*/
+class DensityDeviationSources
+{
+    public:
+        DensityDeviationSources( const VECTOR< Particle > & particles , float ambientFluidDensity )
+            : mParticles( particles )
+            , mAmbientFluidDensity( ambientFluidDensity )
+        {}
+
+        size_t          GetNumSources() const                               { return mParticles.Size() ; }
+        const Vec3 &    GetPosition( size_t iSource ) const                 { return mParticles[ iSource ].mPosition ; }
+        void            GetValues( size_t iSource , float values[] ) const  { values[ 0 ] = mParticles[ iSource ].mDensity - mAmbientFluidDensity ; }
+
+    private:
+        DensityDeviationSources & operator=( const DensityDeviationSources & ) ; // Disallow assignment.
+
+        const VECTOR< Particle > &  mParticles              ;   ///< Particles whose density deviation to accumulate
+        const float                 mAmbientFluidDensity    ;   ///< Density of fluid in the absence of particles
+} ;
+
 
 
 
@@ -42,17 +142,21 @@ void PopulateDensityDeviationGridFromParticles( const VECTOR< Particle > & parti
     // Here we only want to know whether a given cell has deviant density,
     // to get the overall shape of the density distribution.
     // This density deviation grid will NOT have the same total mass as the particles; it lacks the volume-correction factor.
+    const DensityDeviationSources   sources( particles , ambientFluidDensity ) ;
+    UniformGrid< float > *          grids[] = { & densityDeviationGrid } ;
+    ScatterIntoGrids( grids , 1 , sources ) ;
+
+#if defined( _DEBUG )
     const size_t numParticles= particles.Size() ;
     for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
     {   // For each particle...
         const Particle  &   rPcl        = particles[ iPcl ] ;
         const Vec3      &   rPosition   = rPcl.mPosition   ;
         ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
-        DEBUG_ONLY( const unsigned  uOffset = densityDeviationGrid.OffsetOfPosition( rPosition ) ) ;
+        const unsigned      uOffset     = densityDeviationGrid.OffsetOfPosition( rPosition ) ;
         ASSERT( uOffset < densityDeviationGrid.GetGridCapacity() ) ;
-        const float densityDeviation = rPcl.mDensity - ambientFluidDensity ;
-        densityDeviationGrid.Accumulate( rPosition , densityDeviation ) ;
     }
+#endif
 }
 
 
@@ -116,6 +220,10 @@ void PclOpEmit::Emit( VECTOR< Particle > & particles , const UniformGridGeometry
     // and must not place particles outside grid, even by a tiny amount.
     const Vec3  jitterMagnitude         = 1.9999f * sOneMinusEpsilon * vShift ;
 
+    // Key jitter by cell and subdomain, so the same grid yields the same tracers.
+    const CounterRng    jitterRng ;
+    const unsigned      numSubdomains   = nt[0] * nt[1] * nt[2] ;
+
     for( idx[2] = begin[2] ; idx[2] < end[2] ; ++ idx[2] )
     for( idx[1] = begin[1] ; idx[1] < end[1] ; ++ idx[1] )
     for( idx[0] = begin[0] ; idx[0] < end[0] ; ++ idx[0] )
@@ -149,7 +257,9 @@ void PclOpEmit::Emit( VECTOR< Particle > & particles , const UniformGridGeometry
                                             float( it[1] ) / float( nt[1] ) * vSpacing.y ,
                                             float( it[2] ) / float( nt[2] ) * vSpacing.z ) ;
 
-                const Vec3 jitter = RandomSpread( jitterMagnitude ) ;
+                const unsigned  cellOffset  = idx[0] + uniformGrid.GetNumPoints( 0 ) * ( idx[1] + uniformGrid.GetNumPoints( 1 ) * idx[2] ) ;
+                const unsigned  subdomain   = it[0] + nt[0] * ( it[1] + nt[1] * it[2] ) ;
+                const Vec3      jitter      = jitterRng.Spread( jitterMagnitude , cellOffset * numSubdomains + subdomain , 0 ) ;
                 pcl.mPosition   = vPosMinCorner + vDisplacement + vShift + jitter ;
                 if( vortons )
                 {   // Vortons were passed in so assign density based on
@@ -177,35 +287,122 @@ void PclOpEmit::Emit( VECTOR< Particle > & particles , const UniformGridGeometry
 
 
 
+/** Perturb a subset of newly emitted particles.
+
+    \param particles   Dynamic array of particles, whose last particles are new.
+
+    \param iFirstNew   Index of first new particle.
+
+    \param uFrame      Current frame, which becomes birth time of new particles.
+
+    \param sizeScale   Factor by which to scale size of new particles, after perturbing it.  See EmissionLod.
+
+    \param itStart     Index of first particle to perturb.
+
+    \param itEnd       One past index of last particle to perturb.
+
+    Random numbers depend only on the emitter, frame, and index of each
+    particle among those new this frame, so results do not depend on how
+    threads divide the range.
+*/
+void PclOpEmit::PerturbNewParticles_Slice( VECTOR< Particle > & particles , size_t iFirstNew , unsigned uFrame , float sizeScale , size_t itStart , size_t itEnd ) const
+{
+    ASSERT( itEnd <= particles.Size() ) ;
+
+    const Particle &    spread  = mSpread ;
+    const CounterRng    rng( mRandomSeed ) ;   // Generator keyed by emitter.
+
+    // Generate random numbers for a batch of particles at a time, so CounterRng
+    // computes them for several particles at once, in SIMD lanes.
+    // Each draw yields 4 numbers per particle.
+    static const size_t batchSize   = 64 ;
+#if ENABLE_FIRE
+    static const unsigned numDraws  = 5 ;
+#else
+    static const unsigned numDraws  = 4 ;
+#endif
+    float               unit[ numDraws ][ 4 * batchSize ] ;
+
+    for( size_t batchBegin = itStart ; batchBegin < itEnd ; batchBegin += batchSize )
+    {   // For each batch of particles in this slice...
+        const size_t    numInBatch  = Min2( batchSize , itEnd - batchBegin ) ;
+        const unsigned  iNewBegin   = unsigned( batchBegin - iFirstNew ) ;
+        for( unsigned draw = 0 ; draw < numDraws ; ++ draw )
+        {   // For each draw of 4 numbers per particle...
+            rng.UniformBatch( unit[ draw ] , numInBatch , iNewBegin , uFrame , draw ) ;
+        }
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each new particle in batch...
+            Particle &      rParticleNew    = particles[ batchBegin + iInBatch ] ;
+            const float *   u0              = & unit[ 0 ][ 4 * iInBatch ] ;
+            const float *   u1              = & unit[ 1 ][ 4 * iInBatch ] ;
+            const float *   u2              = & unit[ 2 ][ 4 * iInBatch ] ;
+            const float *   u3              = & unit[ 3 ][ 4 * iInBatch ] ;
+            rParticleNew.mPosition          += Vec3( spread.mPosition.x         * ( u0[ 0 ] - 0.5f ) , spread.mPosition.y          * ( u0[ 1 ] - 0.5f ) , spread.mPosition.z          * ( u0[ 2 ] - 0.5f ) ) ;
+            rParticleNew.mVelocity          += Vec3( spread.mVelocity.x         * ( u1[ 0 ] - 0.5f ) , spread.mVelocity.y          * ( u1[ 1 ] - 0.5f ) , spread.mVelocity.z          * ( u1[ 2 ] - 0.5f ) ) ;
+            rParticleNew.mOrientation       += Vec3( spread.mOrientation.x      * ( u2[ 0 ] - 0.5f ) , spread.mOrientation.y       * ( u2[ 1 ] - 0.5f ) , spread.mOrientation.z       * ( u2[ 2 ] - 0.5f ) ) ;
+            rParticleNew.mAngularVelocity   += Vec3( spread.mAngularVelocity.x  * ( u3[ 0 ] - 0.5f ) , spread.mAngularVelocity.y   * ( u3[ 1 ] - 0.5f ) , spread.mAngularVelocity.z   * ( u3[ 2 ] - 0.5f ) ) ;
+            rParticleNew.mDensity           += spread.mDensity  * ( u0[ 3 ] - 0.5f ) ;
+        #if ENABLE_FIRE
+            const float *   u4              = & unit[ 4 ][ 4 * iInBatch ] ;
+            rParticleNew.mFuelFraction      += spread.mFuelFraction     * ( u4[ 0 ] - 0.5f ) ;
+            rParticleNew.mFlameFraction     += spread.mFlameFraction    * ( u4[ 1 ] - 0.5f ) ;
+            rParticleNew.mSmokeFraction     += spread.mSmokeFraction    * ( u4[ 2 ] - 0.5f ) ;
+        #endif
+            rParticleNew.mSize              += spread.mSize     * ( u1[ 3 ] - 0.5f ) ;
+            rParticleNew.mSize              *= sizeScale ;
+            rParticleNew.mBirthTime          = uFrame ;
+            ASSERT( rParticleNew.mDensity >= 0.0f ) ;
+        }
+    }
+}
+
+
+
+
+/** Return fraction of mEmitRate to emit, based on how much of the screen the emitter region covers.
+
+    The emitter region centers on mTemplate.mPosition, and spans mSpread.mPosition,
+    enlarged by the size of particles.
+*/
+float PclOpEmit::GetEmissionLodFraction() const
+{
+    const float regionRadius = 0.5f * ( mSpread.mPosition.Magnitude() + mTemplate.mSize + mSpread.mSize ) ;
+    return mLod.ComputeFraction( mTemplate.mPosition , regionRadius ) ;
+}
+
+
+
+
 void PclOpEmit::Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame )
 {
     PERF_BLOCK( PclOpEmit__Operate ) ;
 
-    const float fNumToEmit = timeStep * mEmitRate + mRemainder ;
+    // Emit fewer, larger particles from regions that cover little of the screen.  Total volume, hence mass and dye, stays the same.
+    const float lodFraction = GetEmissionLodFraction() ;
+    const float sizeScale   = ( lodFraction < 1.0f ) ? EmissionLod::SizeScaleFromFraction( lodFraction ) : 1.0f ;
+
+    const float fNumToEmit = timeStep * mEmitRate * lodFraction + mRemainder ;
     const int   iNumToEmit = int( fNumToEmit ) ;
 
     // Remember fractional particles for future emission.
     mRemainder = fNumToEmit - float( iNumToEmit ) ;
     ASSERT( ( timeStep < 0.0f ) || ( mRemainder >= 0.0f ) ) ;
 
-    for( int iPcl = 0 ; iPcl < iNumToEmit ; ++ iPcl )
-    {   // For each new particle to emit...
-        particles.PushBack( mTemplate ) ;
-        Particle & rParticleNew = particles.Back() ;
-        rParticleNew.mPosition          += RandomSpread( mSpread.mPosition          ) ;
-        rParticleNew.mVelocity          += RandomSpread( mSpread.mVelocity          ) ;
-        rParticleNew.mOrientation       += RandomSpread( mSpread.mOrientation       ) ;
-        rParticleNew.mAngularVelocity   += RandomSpread( mSpread.mAngularVelocity   ) ;
-        rParticleNew.mDensity           += RandomSpread( mSpread.mDensity           ) ;
-    #if ENABLE_FIRE
-        rParticleNew.mFuelFraction      += RandomSpread( mSpread.mFuelFraction      ) ;
-        rParticleNew.mFlameFraction     += RandomSpread( mSpread.mFlameFraction     ) ;
-        rParticleNew.mSmokeFraction     += RandomSpread( mSpread.mSmokeFraction     ) ;
-    #endif
-        rParticleNew.mSize              += RandomSpread( mSpread.mSize              ) ;
-        rParticleNew.mBirthTime          = uFrame ;
-        ASSERT( rParticleNew.mDensity >= 0.0f ) ;
+    if( iNumToEmit <= 0 )
+    {
+        return ;
     }
+
+    // Append all new particles at once, then perturb each.
+    // CounterRng keys each perturbation by particle and frame, so the perturbation loop can run in parallel, and yields the same particles regardless of thread count.
+    // When growing, reserve room for emission over several frames, sized from the emission rate, not just the current population.
+    const size_t        reserveHint     = size_t( iNumToEmit ) * PCL_OP_EMIT_RESERVE_FRAMES ;
+    const size_t        iFirstNew       = Particles::EmitBulk( particles , iNumToEmit , mTemplate , reserveHint ) ;
+    const size_t        numParticles    = particles.Size() ;
+    // Most emitters emit a few particles per frame, which do not merit threads, so use a large grain.
+    static const size_t grainSize = 256 ;
+    Parallel::For( iFirstNew , numParticles , grainSize , Parallel::Method( this , & PclOpEmit::PerturbNewParticles_Slice , particles , iFirstNew , uFrame , sizeScale ) ) ;
 }
 
 
@@ -319,6 +516,7 @@ void PclOpEmit::Operate(  VECTOR< Particle > & particles , float timeStep , unsi
 #include <stdlib.h>
 
 #include "Core/useTbb.h"
+#include "Core/parallelExecution.h"
 
 
 
@@ -857,11 +1055,18 @@ void ComputeImmediateSDFFromDensity_Nearest( UniformGrid< float > & signedDistan
 
 
 /** Assign sdfHere when its absolute value exceeds the absolute value of the candidate based on its neighbor.
+
+    \param bandWidth    Largest magnitude to assign.  Candidates farther from the surface saturate at this magnitude,
+                        keeping their sign.  FLT_MAX means no limit.
 */
-static inline void UpdateSdfFromNeighbor_Nearest( float & sdfHere , const float sdfNeighbor , const float cellSpacing )
+static inline void UpdateSdfFromNeighbor_Nearest( float & sdfHere , const float sdfNeighbor , const float cellSpacing , const float bandWidth )
 {
     const float delta = FCopySign( cellSpacing , sdfNeighbor ) ;
-    const float candidateSdf = sdfNeighbor + delta ;
+    float candidateSdf = sdfNeighbor + delta ;
+    if( ( fabsf( candidateSdf ) > bandWidth ) && ( sdfNeighbor != FLT_MAX ) )
+    {   // Candidate lies outside narrow band.  Saturate it, so sign still propagates.
+        candidateSdf = FCopySign( bandWidth , sdfNeighbor ) ;
+    }
     if( fabsf( candidateSdf ) < fabsf( sdfHere ) )
     {
         sdfHere = candidateSdf ;
@@ -896,6 +1101,85 @@ void ComputeGridBeginEnd( int begin[ 3 ] , int end[ 3 ] , const UniformGrid< flo
 
 
 
+/** Update SDF at one gridpoint from its backward neighbors, i.e. its neighbors opposite the sweep direction.
+
+    \param idx          Indices of gridpoint to update.
+
+    \param inc          Sweep direction along each axis.  +1 means forward, -1 means backward.
+
+    \param gridBegin    Indices of first gridpoint visited along sweep direction.  See ComputeGridBeginEnd.
+
+    \param bandWidth    See UpdateSdfFromNeighbor_Nearest.
+*/
+static inline void UpdateSdfFromBackwardNeighbors_Nearest( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid , const int idx[ 3 ] , const int inc[ 3 ] , const int gridBegin[ 3 ] , const size_t numX , const size_t numXY , const float bandWidth )
+{
+    // Obtain density values at this gridpoint and its BACKWARD neighbors.
+    const size_t    offsetX0Y0Z0    = signedDistanceGrid.OffsetFromIndices( idx ) ;
+
+    const int &     sdfFrozen       = sdfPinnedGrid[ offsetX0Y0Z0 ] ;
+    float &         sdfHere         = signedDistanceGrid[ offsetX0Y0Z0 ] ;
+
+    if( sdfFrozen )
+    {   // Current SDF value is "frozen" meaning it cannot change.
+        ASSERT( sdfHere != FLT_MAX ) ; // If it is frozen then it must have been assigned.
+        return ;
+    }
+
+    const size_t    offsetX1Y0Z0    = offsetX0Y0Z0 - inc[0] ;
+    const size_t    offsetX0Y1Z0    = offsetX0Y0Z0 - inc[1] * numX ;
+    const size_t    offsetX0Y0Z1    = offsetX0Y0Z0 - inc[2] * numXY ;
+
+    // Only access neighbors within the domain.
+    const float     sdfX            = ( idx[0] != gridBegin[0] ) ? signedDistanceGrid[ offsetX1Y0Z0 ] : FLT_MAX ;
+    const float     sdfY            = ( idx[1] != gridBegin[1] ) ? signedDistanceGrid[ offsetX0Y1Z0 ] : FLT_MAX ;
+    const float     sdfZ            = ( idx[2] != gridBegin[2] ) ? signedDistanceGrid[ offsetX0Y0Z1 ] : FLT_MAX ;
+
+    ASSERT( ! IsNan( sdfHere ) ) ;
+    ASSERT( ! IsNan( sdfX    ) ) ;
+    ASSERT( ! IsNan( sdfY    ) ) ;
+    ASSERT( ! IsNan( sdfZ    ) ) ;
+
+    const float     aSdfX           = fabsf( sdfX ) ;
+    const float     aSdfY           = fabsf( sdfY ) ;
+    const float     aSdfZ           = fabsf( sdfZ ) ;
+
+    // Consider SDF of each neighbor.
+    // Identify the neighbor with the smallest |SDF| (absolute value of SDF).
+    // Assign current SDF to that of the minimal neighbor plus the commensurate grid spacing, with the appropriate sign.
+    // NOTE: This is not the best estimate.  A better estimate would solve the Eikonal equation and take into account other neighbors and the gradient.
+    if( aSdfX <= aSdfY )
+    {   // Y is NOT the smallest neighbor.
+        if( aSdfX <= aSdfZ )
+        {   // X is the smallest neighbor.
+            UpdateSdfFromNeighbor_Nearest( sdfHere , sdfX , signedDistanceGrid.GetCellSpacing().x , bandWidth ) ;
+        }
+        else
+        {   // Z is the smallest neighbor.
+            ASSERT( ( aSdfZ < aSdfX ) && ( aSdfZ < aSdfY ) ) ;
+            UpdateSdfFromNeighbor_Nearest( sdfHere , sdfZ , signedDistanceGrid.GetCellSpacing().z , bandWidth ) ;
+        }
+    }
+    else
+    {   // X is NOT the smallest neighbor.
+        ASSERT( aSdfY < aSdfX ) ;
+        if( aSdfY <= aSdfZ )
+        {   // Y is the smallest neighbor.
+            UpdateSdfFromNeighbor_Nearest( sdfHere , sdfY , signedDistanceGrid.GetCellSpacing().y , bandWidth ) ;
+        }
+        else
+        {   // Z is the smallest neighbor.
+            ASSERT( ( aSdfZ < aSdfX ) && ( aSdfZ < aSdfY ) ) ;
+            UpdateSdfFromNeighbor_Nearest( sdfHere , sdfZ , signedDistanceGrid.GetCellSpacing().z , bandWidth ) ;
+        }
+    }
+
+    // If any neighbor has an assigned SDF then the current value must have been assigned.
+    ASSERT( ! ( ( sdfX != FLT_MAX ) || ( sdfY != FLT_MAX ) || ( sdfZ != FLT_MAX ) ) || ( sdfHere != FLT_MAX ) ) ;
+}
+
+
+
+
 /** For a single block, compute remaining SDF, given a grid with some populated SDF values.
 */
 void ComputeRemainingSDFFromImmediateSDF_Nearest_Block( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid , const int voxelsPerBlock[ 3 ] , const int inc[ 3 ] , const Block & block )
@@ -915,8 +1199,6 @@ void ComputeRemainingSDFFromImmediateSDF_Nearest_Block( UniformGrid< float > & s
     // Extract begin, end indices from block.
     block.SetRanges( blockBegin , blockEnd , voxelsPerBlock , numGridPoints , inc ) ;
 
-    DEBUG_ONLY( bool previousSdfHadValue = false ) ; // Diagnosing algorithm
-
 #if 0 && defined( _DEBUG )
     DebugLock() ;
     DebugPrintf( "ComputeRemainingSDFFromImmediateSDF_Nearest_Block: {%2i,%2i,%2i} - {%2i,%2i,%2i}\n", blockBegin[0] , blockBegin[1] , blockBegin[2] , blockEnd[0] , blockEnd[1] , blockEnd[2] ) ;
@@ -927,73 +1209,7 @@ void ComputeRemainingSDFFromImmediateSDF_Nearest_Block( UniformGrid< float > & s
     for( idx[1] = blockBegin[1] ; idx[1] != blockEnd[1] ; idx[1] += inc[1] )
     for( idx[0] = blockBegin[0] ; idx[0] != blockEnd[0] ; idx[0] += inc[0] )
     {   // For each grid point in block...
-
-        // Obtain density values at this gridpoint and its BACKWARD neighbors.
-        const size_t    offsetX0Y0Z0    = signedDistanceGrid.OffsetFromIndices( idx ) ;
-        const size_t    offsetX1Y0Z0    = offsetX0Y0Z0 - inc[0] ;
-        const size_t    offsetX0Y1Z0    = offsetX0Y0Z0 - inc[1] * numX ;
-        const size_t    offsetX0Y0Z1    = offsetX0Y0Z0 - inc[2] * numXY ;
-
-        float &         sdfHere         = signedDistanceGrid[ offsetX0Y0Z0 ] ;
-
-        // Only access neighbors within the domain.
-        const float     sdfX            = ( idx[0] != gridBegin[0] ) ? signedDistanceGrid[ offsetX1Y0Z0 ] : FLT_MAX ;
-        const float     sdfY            = ( idx[1] != gridBegin[1] ) ? signedDistanceGrid[ offsetX0Y1Z0 ] : FLT_MAX ;
-        const float     sdfZ            = ( idx[2] != gridBegin[2] ) ? signedDistanceGrid[ offsetX0Y0Z1 ] : FLT_MAX ;
-
-        ASSERT( ! IsNan( sdfHere ) ) ;
-        ASSERT( ! IsNan( sdfX    ) ) ;
-        ASSERT( ! IsNan( sdfY    ) ) ;
-        ASSERT( ! IsNan( sdfZ    ) ) ;
-
-        float           aSdfX           = fabsf( sdfX ) ;
-        float           aSdfY           = fabsf( sdfY ) ;
-        float           aSdfZ           = fabsf( sdfZ ) ;
-
-        const int &     sdfFrozen       = sdfPinnedGrid[ offsetX0Y0Z0 ] ;
-
-        if( sdfFrozen )
-        {   // Current SDF value is "frozen" meaning it cannot change.
-            ASSERT( sdfHere != FLT_MAX ) ; // If it is frozen then it must have been assigned.
-            DEBUG_ONLY( previousSdfHadValue = false ) ;
-            continue ;
-        }
-
-        // Consider SDF of each neighbor.
-        // Identify the neighbor with the smallest |SDF| (absolute value of SDF).
-        // Assign current SDF to that of the minimal neighbor plus the commensurate grid spacing, with the appropriate sign.
-        // NOTE: This is not the best estimate.  A better estimate would solve the Eikonal equation and take into account other neighbors and the gradient.
-        if( aSdfX <= aSdfY )
-        {   // Y is NOT the smallest neighbor.
-            if( aSdfX <= aSdfZ )
-            {   // X is the smallest neighbor.
-                UpdateSdfFromNeighbor_Nearest( sdfHere , sdfX , signedDistanceGrid.GetCellSpacing().x ) ;
-            }
-            else
-            {   // Z is the smallest neighbor.
-                ASSERT( ( aSdfZ < aSdfX ) && ( aSdfZ < aSdfY ) ) ;
-                UpdateSdfFromNeighbor_Nearest( sdfHere , sdfZ , signedDistanceGrid.GetCellSpacing().z ) ;
-            }
-        }
-        else
-        {   // X is NOT the smallest neighbor.
-            ASSERT( aSdfY < aSdfX ) ;
-            if( aSdfY <= aSdfZ )
-            {   // Y is the smallest neighbor.
-                UpdateSdfFromNeighbor_Nearest( sdfHere , sdfY , signedDistanceGrid.GetCellSpacing().y ) ;
-            }
-            else
-            {   // Z is the smallest neighbor.
-                ASSERT( ( aSdfZ < aSdfX ) && ( aSdfZ < aSdfY ) ) ;
-                UpdateSdfFromNeighbor_Nearest( sdfHere , sdfZ , signedDistanceGrid.GetCellSpacing().z ) ;
-            }
-        }
-
-        // If any neighbor has an assigned SDF then the current value must have been assigned.
-        ASSERT( ! ( ( sdfX != FLT_MAX ) || ( sdfY != FLT_MAX ) || ( sdfZ != FLT_MAX ) ) || ( sdfHere != FLT_MAX ) ) ;
-
-        ASSERT( ! previousSdfHadValue || ( sdfHere != FLT_MAX ) ) ;
-        DEBUG_ONLY( previousSdfHadValue = ( ( sdfHere != FLT_MAX ) && ( idx[0]+inc[0] != blockEnd[0] ) ) ) ;
+        UpdateSdfFromBackwardNeighbors_Nearest( signedDistanceGrid , sdfPinnedGrid , idx , inc , gridBegin , numX , numXY , FLT_MAX ) ;
     }
 }
 
@@ -1035,17 +1251,150 @@ void ComputeRemainingSDFFromImmediateSDF_Nearest_Serial( UniformGrid< float > &
 
 
 
-void ComputeRemainingSDFFromImmediateSDF_Nearest( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid )
+/** Whether ComputeRemainingSDFFromImmediateSDF_Nearest sweeps diagonal hyperplanes concurrently.
+
+    Otherwise, with TBB, it sweeps blocks along a wavefront using tbb::parallel_do,
+    and, without TBB, it sweeps the whole grid serially.
+
+    For a sweep in direction inc, each gridpoint depends only on its backward
+    neighbors along each axis.  Those all lie on the "previous" diagonal
+    hyperplane, i.e. the plane where the sum of (sweep-relative) indices is one less.
+    So all gridpoints on a hyperplane can update concurrently, and visiting
+    hyperplanes in order yields exactly the same result as the serial sweep.
+    Each hyperplane is a simple data-parallel loop, with no dependency
+    tracking, so it suits Parallel::For (and GPU compute) better than the
+    block wavefront.
+*/
+#define SDF_SWEEP_HYPERPLANES 1
+
+
+
+
+/** Diagonal hyperplane that ComputeRemainingSDFFromImmediateSDF_Nearest_HyperplaneSlice updates.
+*/
+struct SdfHyperplane
+{
+    const int * mInc        ;   ///< Sweep direction along each axis.
+    float       mBandWidth  ;   ///< Largest SDF magnitude to assign.  See UpdateSdfFromNeighbor_Nearest.
+    int         mLevel      ;   ///< Index of hyperplane: Sum of sweep-relative gridpoint indices.
+} ;
+
+
+
+
+/** Update SDF at the gridpoints on a range of rows within one diagonal hyperplane.
+
+    \param hyperplane   Sweep direction, band width and index of hyperplane.
+
+    \param zRelBegin    First sweep-relative z index to process.
+
+    \param zRelEnd      One past last sweep-relative z index to process.
+
+    Each row (i.e. each sweep-relative z index) is independent of the others
+    on the same hyperplane, so separate threads can process separate ranges
+    concurrently.
+*/
+static void ComputeRemainingSDFFromImmediateSDF_Nearest_HyperplaneSlice( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid , const SdfHyperplane & hyperplane , size_t zRelBegin , size_t zRelEnd )
+{
+    const int *     inc                 = hyperplane.mInc ;
+    const float     bandWidth           = hyperplane.mBandWidth ;
+    const int       level               = hyperplane.mLevel ;
+    const int       numGridPoints[ 3 ]  = { signedDistanceGrid.GetNumPoints( 0 ) , signedDistanceGrid.GetNumPoints( 1 ) , signedDistanceGrid.GetNumPoints( 2 ) } ;
+    const size_t    numX                = signedDistanceGrid.GetNumPoints( 0 ) ;
+    const size_t    numXY               = numX * signedDistanceGrid.GetNumPoints( 1 ) ;
+
+    int gridBegin[3] ;
+    int gridEnd[3] ;
+    ComputeGridBeginEnd( gridBegin , gridEnd , signedDistanceGrid , inc ) ;
+
+    int idx[3] ;
+    for( int zRel = int( zRelBegin ) ; zRel < int( zRelEnd ) ; ++ zRel )
+    {   // For each row on this hyperplane, in this slice...
+        const int yRelBegin = Max2( 0 , level - zRel - ( numGridPoints[ 0 ] - 1 ) ) ;
+        const int yRelEnd   = Min2( numGridPoints[ 1 ] - 1 , level - zRel ) + 1 ;
+        idx[2] = ( inc[2] > 0 ) ? zRel : ( numGridPoints[ 2 ] - 1 - zRel ) ;
+        for( int yRel = yRelBegin ; yRel < yRelEnd ; ++ yRel )
+        {   // For each gridpoint in this row on this hyperplane...
+            const int xRel = level - zRel - yRel ;
+            ASSERT( ( xRel >= 0 ) && ( xRel < numGridPoints[ 0 ] ) ) ;
+            idx[1] = ( inc[1] > 0 ) ? yRel : ( numGridPoints[ 1 ] - 1 - yRel ) ;
+            idx[0] = ( inc[0] > 0 ) ? xRel : ( numGridPoints[ 0 ] - 1 - xRel ) ;
+            UpdateSdfFromBackwardNeighbors_Nearest( signedDistanceGrid , sdfPinnedGrid , idx , inc , gridBegin , numX , numXY , bandWidth ) ;
+        }
+    }
+}
+
+
+
+
+/** Compute remaining SDF by sweeping diagonal hyperplanes in order, and gridpoints within each hyperplane concurrently.
+
+    \param bandWidth    See UpdateSdfFromNeighbor_Nearest.
+
+    This yields the same result as ComputeRemainingSDFFromImmediateSDF_Nearest_Serial.  See SDF_SWEEP_HYPERPLANES.
+*/
+static void ComputeRemainingSDFFromImmediateSDF_Nearest_Hyperplanes( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid , const float bandWidth )
+{
+    const int numGridPoints[ 3 ] = { signedDistanceGrid.GetNumPoints( 0 ) , signedDistanceGrid.GetNumPoints( 1 ) , signedDistanceGrid.GetNumPoints( 2 ) } ;
+    const int numLevels = numGridPoints[ 0 ] + numGridPoints[ 1 ] + numGridPoints[ 2 ] - 2 ;
+#if USE_TBB
+    // Hyperplanes near the corners of the grid have few gridpoints, not worth splitting across threads.
+    static const int sMinGridPointsPerTask = 1024 ;
+#endif
+
+    static const int numPasses = 2 ;
+    for( int pass = 0 ; pass < numPasses ; ++ pass )
+    {   // For each pass...
+        // Even-numbered passes sweep forward, odd-numbered passes sweep backward, like ComputeRemainingSDFFromImmediateSDF_Nearest_Serial.
+        const int dir = ( ( pass & 1 ) != 0 ) ? -1 : 1 ;
+        const int inc[3] = { dir , dir , dir } ;
+
+        for( int level = 0 ; level < numLevels ; ++ level )
+        {   // For each hyperplane, in sweep order...
+            const int zRelBegin = Max2( 0 , level - ( numGridPoints[ 0 ] - 1 ) - ( numGridPoints[ 1 ] - 1 ) ) ;
+            const int zRelEnd   = Min2( numGridPoints[ 2 ] - 1 , level ) + 1 ;
+            const SdfHyperplane hyperplane = { inc , bandWidth , level } ;
+        #if USE_TBB
+            const int numRows   = zRelEnd - zRelBegin ;
+            if( numRows * Min2( numGridPoints[ 1 ] , level + 1 ) >= sMinGridPointsPerTask )
+            {   // Hyperplane has enough gridpoints to split across threads.
+                Parallel::For( zRelBegin , zRelEnd , Parallel::GetGrainSize( numRows ) , Parallel::Function( ComputeRemainingSDFFromImmediateSDF_Nearest_HyperplaneSlice , signedDistanceGrid , sdfPinnedGrid , hyperplane ) ) ;
+            }
+            else
+        #endif
+            {   // Process hyperplane serially.
+                ComputeRemainingSDFFromImmediateSDF_Nearest_HyperplaneSlice( signedDistanceGrid , sdfPinnedGrid , hyperplane , zRelBegin , zRelEnd ) ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Compute SDF for gridpoints not pinned, by propagating values from those pinned.
+
+    \param bandWidth    Largest SDF magnitude to assign.  Gridpoints farther from the surface
+                        get this magnitude, with the sign of the side they lie on, so callers that
+                        only care about a narrow band around the surface get bounded values.
+                        FLT_MAX (the default) means assign actual propagated distances everywhere.
+*/
+void ComputeRemainingSDFFromImmediateSDF_Nearest( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid , float bandWidth )
 {
     PERF_BLOCK( ComputeRemainingSDFFromImmediateSDF_Nearest ) ;
 
     ASSERT( signedDistanceGrid.ShapeMatches( sdfPinnedGrid ) ) ;
     ASSERT( signedDistanceGrid.Size() == sdfPinnedGrid.Size() ) ;
+    ASSERT( bandWidth > 0.0f ) ;
 
-#if USE_TBB
+#if SDF_SWEEP_HYPERPLANES
+    ComputeRemainingSDFFromImmediateSDF_Nearest_Hyperplanes( signedDistanceGrid , sdfPinnedGrid , bandWidth ) ;
+#elif USE_TBB
     ComputeRemainingSDFFromImmediateSDF_Nearest_TBB::Driver( signedDistanceGrid , sdfPinnedGrid ) ;
+    (void) bandWidth ;
 #else
     ComputeRemainingSDFFromImmediateSDF_Nearest_Serial( signedDistanceGrid , sdfPinnedGrid ) ;
+    (void) bandWidth ;
 #endif
 
 #define DIAGNOSE_FULL_SDF 1
@@ -1144,8 +1493,16 @@ void CheckContribution( const UniformGrid< float > & contributionGrid )
 
     \param particles    Dynamic array of particles whose signed distance information to
                         accumulate into signedDistanceGrid.
+
+    \param sdfPinnedGrid (scratch)     Grid of whether each signed distance value came directly from particles.
+
+    \param ugParticleContribution (scratch)   Grid of amount of particle contribution to each gridpoint.
+
+    Callers own the scratch grids, and reuse them across calls, so their memory persists.
 */
 void PopulateSignedDistanceGridFromSurfaceTracerParticles( UniformGrid< float > & signedDistanceGrid
+                                                          , UniformGrid< int > & sdfPinnedGrid
+                                                          , UniformGrid< float > & ugParticleContribution
                                                           , const UniformGridGeometry & referenceGridGeometry
                                                           , const VECTOR< Particle > & particles
                                                           , const float ambientDensity
@@ -1173,12 +1530,11 @@ void PopulateSignedDistanceGridFromSurfaceTracerParticles( UniformGrid< float >
         signedDistanceGrid.Init( 0.0f ) ; // Reserve memory for SDF grid and initialize all values to FLT_MAX.
     }
 
-    UniformGrid< int > sdfPinnedGrid ;
     sdfPinnedGrid.CopyShape( signedDistanceGrid ) ; // Match shape of sdf grid.
     sdfPinnedGrid.Init( 0 ) ;                       // Initialize all values to false.
 
     // Amount of contribution to each grid point.
-    UniformGrid< float > ugParticleContribution( static_cast< UniformGridGeometry >( signedDistanceGrid ) ) ;
+    ugParticleContribution.CopyShape( signedDistanceGrid ) ;
     ugParticleContribution.Init( 0.0f ) ;
 
     // Populate signed distance grid.
@@ -1252,7 +1608,9 @@ void PopulateSignedDistanceGridFromSurfaceTracerParticles( UniformGrid< float >
     // Procedure above computes SDF on grid only where there surface tracer particles.
     // The rest of the grid has yet to be assigned SDF values.
     // Populate the rest of the domain with SDF values, propagated from those values already assigned (and pinned).
-    ComputeRemainingSDFFromImmediateSDF_Nearest( signedDistanceGrid , sdfPinnedGrid ) ;
+    // Consumers only care about the region near the surface, so saturate values outside a narrow band.
+    const Vec3 & cellSpacing = signedDistanceGrid.GetCellSpacing() ;
+    ComputeRemainingSDFFromImmediateSDF_Nearest( signedDistanceGrid , sdfPinnedGrid , SDF_NARROW_BAND_NUM_CELLS * MAX3( cellSpacing.x , cellSpacing.y , cellSpacing.z ) ) ;
 }
 
 
@@ -1262,47 +1620,29 @@ void PopulateSignedDistanceGridFromSurfaceTracerParticles( UniformGrid< float >
 
     \param particles    (out) Dynamic array of tracer particles to populate.
 
-NOTE: These parameter comments are stale.  Do not trust them.
+    \param tracerCountMultiplier    Number of candidate tracers along each axis within each cell, at full detail.
 
-    \param densityDeviationGrid  Density deviation from ambient, used to indicate region within which to emit tracer particles.
+    \param signedDistanceGrid       Signed distance from the surface.
 
-    \param densityDeviationAtSurface Fluid density deviation at the interface surface between two fluids.
+    \param regionNearSurface        Width of band, on each side of the surface, within which to place tracers.
 
-NOTE: These comments are stale.  Do not trust them.
+    \param ambientDensity           Density of fluid in the absence of particles.  Tracer density, relative to this, indicates the sign of distance.
 
-    The idea:
-        Use density from vortons to populate a densityDeviation grid.
-        Use densityDeviation grid to populate seed tracer particles:
-            For each gridpoint, compute densityScaled = densityDeviationFromGrid / densityDeviationScale.
-                This routine assumes vortons have a non-zero density, hence the deviation will be non-zero.
-                Furthermore, this routine assumes all vortons have the same density, and that vortons do not overlap much.
-                So, in regions where there are no vortons, densityDeviation=0.
-                And, in regions where there are plenty of vortons (little or no space unoccupied by vortons), densityDeviation~=max or densityDeviation~=min.
-                So, only in regions well within (min,0) or (0,max) are near fluid interfaces.
-                This is an indicator function.
-                We want to ignore cells which are exactly zero and whose neighbors are all zeros.
-                Likewise we want to ignore cells whose values are all below min*buffer or above max*buffer, where buffer is a small number in (0,1) (perhaps 0.1) -- experiment to find best choice), and whose neighbors all likewise satisfy the same criteria.
-                Make a sweep to mark all such cells as "truncated", perhaps by setting their values to ZERO, -FLT_MAX, or FLT_MAX (respectively), or just use NaN or FLT_MAX everywhere.
-                It might be useful/necessary to reassigning any zero-values to -FLT_EPSILON or FLT_EPSILON to differentiate between those and ignored ZERO values if ZERO==0.0f.
-                Call the result of this the truncated indicator function.
-                It will be useful to have a truncated signed distance function, where distance would be measured in grid-spacing units, i.e. it would indicate the distance in gridcells.
-                For a given point (e.g. gridpoint) that would be its distance to the closest zero-crossing.
-                Computing that exactly might be expensive (or it might not -- not sure yet).
-
-
-        (After start-up, advect tracers as per usual.)
-
-        Options:
-            Could re-init each frame using vortons, advect tracers, render level set.  Then will remain locked to vorton density.
-            Could re-seed outlier tracers but keep others as the level set.  Also remains locked to vortons.
-            Could subsequently use that as the level set, even though it will depart from vorton density.
+    \param lodFraction  Fraction of full tracer count to place, e.g. from EmissionLod::ComputeFraction.
+                        This lowers the number of tracers along each axis by the cube root of this, but not below 1.
 
+    Each tracer size is twice its distance from the surface, so unlike
+    PclOpEmit, level of detail here does not enlarge tracers.  Fewer tracers
+    still yield the same signed distance field, since
+    PopulateSignedDistanceGridFromSurfaceTracerParticles averages tracers in
+    each cell; it only pins fewer cells.
 */
 void PclOpSeedSurfaceTracers::Emit( VECTOR< Particle > & particles
                                    , const int tracerCountMultiplier
                                    , const UniformGrid< float > & signedDistanceGrid
                                    , float regionNearSurface
-                                   , const float ambientDensity )
+                                   , const float ambientDensity
+                                   , float lodFraction )
 {
     PERF_BLOCK( PclOpSeedSurfaceTracers__Emit ) ;
 
@@ -1318,19 +1658,18 @@ void PclOpSeedSurfaceTracers::Emit( VECTOR< Particle > & particles
 
     particles.Clear() ;
 
+    ASSERT( tracerCountMultiplier >= 1 ) ;
+    const unsigned  multiplier      = Max2( 1u , unsigned( float( tracerCountMultiplier ) * powf( Clamp( lodFraction , 0.0f , 1.0f ) , 1.0f / 3.0f ) + 0.5f ) ) ;
+
     const Vec3      vSpacing        = signedDistanceGrid.GetCellSpacing() ;
     const unsigned  begin[3]        = { 0,0,0 } ;
     const unsigned  end[3]          = { signedDistanceGrid.GetNumCells(0) , signedDistanceGrid.GetNumCells(1) , signedDistanceGrid.GetNumCells(2) } ;
     unsigned        idx[3]          ;
 
-    const unsigned  nt[3]           = { tracerCountMultiplier , tracerCountMultiplier , tracerCountMultiplier } ;
+    const unsigned  nt[3]           = { multiplier , multiplier , multiplier } ;
 
     // Shift each particle to center the distribution within each cell.
-    const Vec3  vShift                  = 0.5f * vSpacing / float( tracerCountMultiplier ) ;
-
-    // Jitter should distribute particles within their little subdomains,
-    // and must not place particles outside grid, even by a tiny amount.
-    const Vec3  jitterMagnitude         = 1.9999f * sOneMinusEpsilon * vShift ;
+    const Vec3  vShift              = 0.5f * vSpacing / float( multiplier ) ;
 
     Particle particlePrototype ;
     particlePrototype.mVelocity	        = Vec3( 0.0f , 0.0f , 0.0f ) ;
@@ -1338,26 +1677,21 @@ void PclOpSeedSurfaceTracers::Emit( VECTOR< Particle > & particles
     particlePrototype.mAngularVelocity	= Vec3( 0.0f , 0.0f , 0.0f ) ;
     particlePrototype.mDensity          = FLT_EPSILON ;
 #if ENABLE_FIRE
-    particlePrototype.mFuelFraction       = 0.0f ;
-    particlePrototype.mFlameFraction      = 0.0f ;
-    particlePrototype.mSmokeFraction      = 1.0f ;
+    particlePrototype.mFuelFraction     = 0.0f ;
+    particlePrototype.mFlameFraction    = 0.0f ;
+    particlePrototype.mSmokeFraction    = 1.0f ;
 #endif
     particlePrototype.mSize		        = 0.0f ; // Set below to signed distance from surface
     particlePrototype.mBirthTime        = 0 ;
 
     // Density values assigned to surface tracers outside and inside surfaces.
-    //
     // This is used as a proxy for the sign of the distance, since elsewhere the particle system
     // does not like negative particle sizes.
-    //
-    // As an alternative to this, the particle system could change to accommodate signed particle
-    // sizes, in which case tracer particle density value would not matter, e.g. could be set to
-    // 0 or 1, and this routine would no longer need ambientDensity passed in.
     const float densityOutside = 0.5f * ambientDensity ;
     const float densityInside  = 2.0f * ambientDensity ;
 
     // Size of region containing outermost band of surface tracers:
-    const float emergencyExteriorSdf = MAX3( vSpacing.x , vSpacing.y , vSpacing.z ) / float( tracerCountMultiplier ) ;
+    const float emergencyExteriorSdf = MAX3( vSpacing.x , vSpacing.y , vSpacing.z ) / float( multiplier ) ;
 
     for( idx[2] = begin[2] ; idx[2] < end[2] ; ++ idx[2] )
     for( idx[1] = begin[1] ; idx[1] < end[1] ; ++ idx[1] )
@@ -1365,50 +1699,41 @@ void PclOpSeedSurfaceTracers::Emit( VECTOR< Particle > & particles
     {   // For each grid cell...
         Vec3 vPosMinCorner ;
         signedDistanceGrid.PositionFromIndices( vPosMinCorner , idx ) ;
-        //const unsigned  offset    = densityDeviationGrid.OffsetFromIndices( idx ) ;
-        //const float sdfGridpoint = signedDistanceGrid.Get( idx[0] , idx[1] , idx[2] ) ;
 
-        //if( fabsf( sdfGridpoint ) < ( regionNearSurface + emergencyExteriorSdf ) )
-        {   // distance from here to surface is within range such that we want to place tracers here...
-            unsigned it[3] ;
-            for( it[2] = 0 ; it[2] < nt[2] ; ++ it[2] )
-            for( it[1] = 0 ; it[1] < nt[1] ; ++ it[1] )
-            for( it[0] = 0 ; it[0] < nt[0] ; ++ it[0] )
-            {   // For each subdomain within each grid cell...
-                const Vec3 vDisplacement(   float( it[0] ) / float( nt[0] ) * vSpacing.x ,
-                                            float( it[1] ) / float( nt[1] ) * vSpacing.y ,
-                                            float( it[2] ) / float( nt[2] ) * vSpacing.z ) ;
-
-                const Vec3 jitter = RandomSpread( jitterMagnitude ) ;
-                particlePrototype.mPosition   = vPosMinCorner + vDisplacement + vShift /* + jitter */ ;
-                // Assign tracer particle size based on signed distance to surface
-                float sdfHere ;
-                signedDistanceGrid.Interpolate( sdfHere , particlePrototype.mPosition ) ;
-                if( fabsf( sdfHere ) < regionNearSurface )
-                {
-                    if(     sdfHere <= emergencyExteriorSdf
-                        &&  (       (       ( 0 == it[0] && 0 == idx[0] )
-                                        ||  ( 0 == it[1] && 0 == idx[1] )
-                                        ||  ( 0 == it[2] && 0 == idx[2] )
-                                    )
-                                ||  (       ( nt[0] == it[0]+1 && end[0] == idx[0]+1 )
-                                        ||  ( nt[1] == it[1]+1 && end[1] == idx[1]+1 )
-                                        ||  ( nt[2] == it[2]+1 && end[2] == idx[2]+1 )
-                                    )
-                            )
+        unsigned it[3] ;
+        for( it[2] = 0 ; it[2] < nt[2] ; ++ it[2] )
+        for( it[1] = 0 ; it[1] < nt[1] ; ++ it[1] )
+        for( it[0] = 0 ; it[0] < nt[0] ; ++ it[0] )
+        {   // For each subdomain within each grid cell...
+            const Vec3 vDisplacement(   float( it[0] ) / float( nt[0] ) * vSpacing.x ,
+                                        float( it[1] ) / float( nt[1] ) * vSpacing.y ,
+                                        float( it[2] ) / float( nt[2] ) * vSpacing.z ) ;
+
+            particlePrototype.mPosition = vPosMinCorner + vDisplacement + vShift ;
+
+            // Assign tracer particle size based on signed distance to surface
+            float sdfHere ;
+            signedDistanceGrid.Interpolate( sdfHere , particlePrototype.mPosition ) ;
+            if( fabsf( sdfHere ) < regionNearSurface )
+            {
+                if(     sdfHere <= emergencyExteriorSdf
+                    &&  (       (       ( 0 == it[0] && 0 == idx[0] )
+                                    ||  ( 0 == it[1] && 0 == idx[1] )
+                                    ||  ( 0 == it[2] && 0 == idx[2] )
+                                )
+                            ||  (       ( nt[0] == it[0]+1 && end[0] == idx[0]+1 )
+                                    ||  ( nt[1] == it[1]+1 && end[1] == idx[1]+1 )
+                                    ||  ( nt[2] == it[2]+1 && end[2] == idx[2]+1 )
+                                )
                         )
-                    {   // "interior" particle on outer boundary.
-                        // Boundary particles must be exterior particles.
-                        sdfHere = emergencyExteriorSdf ;
-                    }
-                    particlePrototype.mSize	= 2.0f * fabsf( sdfHere ) ; // Set size to signed distance from surface
-//if( sdfHere < 0.0f )
-//{
-//particlePrototype.mSize = 0.0f ;
-//}
-                    particlePrototype.mDensity = ( sdfHere >= 0.0f ) ? densityOutside : densityInside ;
-                    particles.PushBack( particlePrototype ) ;
+                    )
+                {   // "interior" particle on outer boundary.
+                    // Boundary particles must be exterior particles.
+                    sdfHere = emergencyExteriorSdf ;
                 }
+                particlePrototype.mSize     = 2.0f * fabsf( sdfHere ) ; // Set size to signed distance from surface
+                particlePrototype.mDensity  = ( sdfHere >= 0.0f ) ? densityOutside : densityInside ;
+                particles.PushBack( particlePrototype ) ;
             }
         }
     }
@@ -1417,16 +1742,61 @@ void PclOpSeedSurfaceTracers::Emit( VECTOR< Particle > & particles
 
 
 
-/** Place particles within a narrow band near a surface described implicitly by a signed distance field.
+/** Position, in units of cell size relative to the cell minimal corner, where Replace places each new tracer within a cell.
+
+    The first is the cell center, just as Replace placed its only tracer per
+    cell before it supported more.  The rest are centers of octants, in an
+    order that spreads successive tracers apart.
+*/
+static const Vec3 sTracerPositionsWithinCell[] =
+{
+    Vec3( 0.50f , 0.50f , 0.50f ) ,
+    Vec3( 0.25f , 0.25f , 0.25f ) ,
+    Vec3( 0.75f , 0.75f , 0.75f ) ,
+    Vec3( 0.75f , 0.25f , 0.25f ) ,
+    Vec3( 0.25f , 0.75f , 0.75f ) ,
+    Vec3( 0.25f , 0.75f , 0.25f ) ,
+    Vec3( 0.75f , 0.25f , 0.75f ) ,
+    Vec3( 0.25f , 0.25f , 0.75f ) ,
+    Vec3( 0.75f , 0.75f , 0.25f ) ,
+} ;
+static const unsigned sNumTracerPositionsWithinCell = sizeof( sTracerPositionsWithinCell ) / sizeof( sTracerPositionsWithinCell[ 0 ] ) ;
+
+
+
+
+/** Maintain tracer particles within a narrow band near a surface described implicitly by a signed distance field.
 
     \param particles    (in/out) Dynamic array of tracer particles to reassign.
 
+    \param sdfPinnedGrid, particleContributionGrid  Scratch grids, which the caller keeps across calls so their memory persists.
+
+    \param scratch      Storage for partitioning tracers and recycling their slots, which the caller keeps across calls so its memory persists.
+
+    \param targetTracersPerCell     Number of tracers to keep in each cell near the surface.
+
+    This only adds or removes tracers where coverage departs from the target:
+    It removes tracers too far from the surface, and tracers in excess of the
+    target in any cell, and it adds tracers to cells near the surface that
+    have fewer than the target.  Cells that already meet the target remain
+    untouched, so tracers advect undisturbed.
+
+    So the number of tracers stays proportional to surface area (times band
+    width), rather than growing as the simulation runs, and so does the cost
+    of populating the SDF from tracers.
+
+    New tracers reuse slots of removed tracers, so the tracer array grows
+    only when the surface does, and compaction runs only when it shrinks.
 */
 void PclOpSeedSurfaceTracers::Replace( VECTOR< Particle > & particles
                                         , UniformGrid< float > & signedDistanceGrid
+                                        , UniformGrid< int > & sdfPinnedGrid
+                                        , UniformGrid< float > & particleContributionGrid
+                                        , ReplaceScratch & scratch
                                         , const UniformGridGeometry & referenceGridGeometry
                                         , float regionNearSurface
-                                        , const float ambientDensity )
+                                        , const float ambientDensity
+                                        , unsigned targetTracersPerCell )
 {
     PERF_BLOCK( PclOpSeedSurfaceTracers__Replace ) ;
 
@@ -1436,33 +1806,32 @@ void PclOpSeedSurfaceTracers::Replace( VECTOR< Particle > & particles
     }
 
     // Populate SDF grid from surface tracers.
-    PopulateSignedDistanceGridFromSurfaceTracerParticles( signedDistanceGrid , referenceGridGeometry , particles , ambientDensity , 0 ) ;
+    PopulateSignedDistanceGridFromSurfaceTracerParticles( signedDistanceGrid , sdfPinnedGrid , particleContributionGrid , referenceGridGeometry , particles , ambientDensity , 0 ) ;
 
     if( sBandWidthAutomatic == regionNearSurface )
     {
         regionNearSurface = 3.0f * signedDistanceGrid.GetCellSpacing().Magnitude() ;
     }
 
+    ASSERT( targetTracersPerCell >= 1 ) ;
+    targetTracersPerCell = Min2( targetTracersPerCell , sNumTracerPositionsWithinCell ) ;
+
 #if 1 // temporarily disable tracer re-seeding to diagnose PopulateSignedDistanceGridFromSurfaceTracerParticles
 
-    // Create spatial partition.  Populate with particles.
-    UniformGrid< VECTOR< unsigned > > particlePartition ;
+    // Populate spatial partition with particles.
+    CellList & particlePartition = scratch.mParticlePartition ;
     particlePartition.CopyShape( signedDistanceGrid ) ;
     Particles::PartitionParticles( particles , particlePartition , 0.0f ) ;
 
+    scratch.mTracersToEmit.Clear() ;
+    scratch.mVacantSlots.Clear() ;
+
     const Vec3      vSpacing            = signedDistanceGrid.GetCellSpacing() ;
     const float     gridCellDiagonal    = vSpacing.Magnitude() ;
     const unsigned  begin[3]            = { 0,0,0 } ;
     const unsigned  end[3]              = { signedDistanceGrid.GetNumCells(0) , signedDistanceGrid.GetNumCells(1) , signedDistanceGrid.GetNumCells(2) } ;
     unsigned        idx[3]              ;
 
-    // Shift each particle to center the distribution within each cell.
-    const Vec3      vShift              = 0.5f * vSpacing ;
-
-    // Jitter should distribute particles within their little subdomains,
-    // and must not place particles outside grid, even by a tiny amount.
-    const Vec3  jitterMagnitude         = 1.9999f * sOneMinusEpsilon * vShift ;
-
     Particle particlePrototype ;
     particlePrototype.mVelocity	        = Vec3( 0.0f , 0.0f , 0.0f ) ;
     particlePrototype.mOrientation	    = Vec3( 0.0f , 0.0f , 0.0f ) ;
@@ -1481,98 +1850,106 @@ void PclOpSeedSurfaceTracers::Replace( VECTOR< Particle > & particles
 
     const float emergencyExteriorSdf = MAX3( vSpacing.x , vSpacing.y , vSpacing.z ) ;
 
-    static const int maxNumPclsPerCell = 2 ;
-
     for( idx[2] = begin[2] ; idx[2] < end[2] ; ++ idx[2] )
     for( idx[1] = begin[1] ; idx[1] < end[1] ; ++ idx[1] )
     for( idx[0] = begin[0] ; idx[0] < end[0] ; ++ idx[0] )
     {   // For each grid cell...
 
-        const VECTOR< unsigned > & indicesOfParticlesInCell = particlePartition[ idx ] ;
+        const CellList::Cell indicesOfParticlesInCell = particlePartition[ idx ] ;
 
-        if( indicesOfParticlesInCell.Empty() )
-        {   // Cell has no particles.
+        unsigned numPclsSurvivingInThisCell = 0 ;
+        for( unsigned pclOffset = 0 ; pclOffset < indicesOfParticlesInCell.Size() ; ++ pclOffset )
+        {   // For each particle in current grid cell...
+            const unsigned & pclIdx = indicesOfParticlesInCell[ pclOffset ] ;
+            const Particle & rPcl = particles[ pclIdx ] ;
 
-            Vec3 vPosMinCorner ;
-            signedDistanceGrid.PositionFromIndices( vPosMinCorner , idx ) ;
-            //const size_t  offset    = signedDistanceGrid.OffsetFromIndices( idx ) ;
-            const float sdfGridpoint = signedDistanceGrid.Get( idx[0] , idx[1] , idx[2] ) ;
+            // Interpolate SDF at particle position to get SDF value from grid.
+            float sdfFromGridHere ;
+            signedDistanceGrid.Interpolate( sdfFromGridHere , rPcl.mPosition ) ;
 
-            if( fabsf( sdfGridpoint ) < ( regionNearSurface + gridCellDiagonal + emergencyExteriorSdf ) )
-            {   // distance from here to surface is within range such that we want to place tracer here...
+            if(     ( fabsf( sdfFromGridHere ) > regionNearSurface )    // Grid SDF at particle is too large.
+                ||  ( numPclsSurvivingInThisCell >= targetTracersPerCell ) )  // This cell already has enough particles.
+            {   // Remove particle.  Remember its slot so a new particle can reuse it.
+                Particles::MarkForKill( particles , pclIdx ) ;
+                scratch.mVacantSlots.PushBack( pclIdx ) ;
+            }
+            else
+            {
+                //If particle SDF departs too far from grid SDF (e.g. if they have opposite sign and if their magnitude differs by a lot)
+                //    reassign particle values (radius, density).
+                ++ numPclsSurvivingInThisCell ;
+            }
+        }
 
-                // Emit particle
+        if( numPclsSurvivingInThisCell >= targetTracersPerCell )
+        {   // Cell has enough particles.
+            continue ;
+        }
 
-                particlePrototype.mPosition   = vPosMinCorner + vShift ;
+        const float sdfGridpoint = signedDistanceGrid.Get( idx[0] , idx[1] , idx[2] ) ;
+        if( fabsf( sdfGridpoint ) >= ( regionNearSurface + gridCellDiagonal + emergencyExteriorSdf ) )
+        {   // Cell is too far from surface to want tracers.
+            continue ;
+        }
 
-                // Interpolate SDF at particle position to get SDF value from grid.
-                float sdfFromGridAtPclCandidatePosition ;
-                signedDistanceGrid.Interpolate( sdfFromGridAtPclCandidatePosition , particlePrototype.mPosition ) ;
+        Vec3 vPosMinCorner ;
+        signedDistanceGrid.PositionFromIndices( vPosMinCorner , idx ) ;
 
-                // Assign tracer particle size based on signed distance to surface
-                if( fabsf( sdfFromGridAtPclCandidatePosition ) < regionNearSurface )
-                {
-                    if(     sdfFromGridAtPclCandidatePosition <= emergencyExteriorSdf
-                        &&  (       (       ( 0 == idx[0] )
-                                        ||  ( 0 == idx[1] )
-                                        ||  ( 0 == idx[2] )
-                                    )
-                                ||  (       ( end[0] == idx[0]+1 )
-                                        ||  ( end[1] == idx[1]+1 )
-                                        ||  ( end[2] == idx[2]+1 )
-                                    )
-                            )
-                        )
-                    {   // "interior" particle on outer boundary.
-                        // Boundary particles must be exterior particles.
-                        sdfFromGridAtPclCandidatePosition = emergencyExteriorSdf ;
-                    }
-                    particlePrototype.mSize	= 2.0f * fabsf( sdfFromGridAtPclCandidatePosition ) ; // Set size to signed distance from surface
-//if( sdfHere < 0.0f )
-//{
-//particlePrototype.mSize = 0.0f ;
-//}
-                    particlePrototype.mDensity = ( sdfFromGridAtPclCandidatePosition >= 0.0f ) ? densityOutside : densityInside ;
-                    particles.PushBack( particlePrototype ) ;
-                }
-            }
+        for( unsigned iPosition = 0 ; ( iPosition < sNumTracerPositionsWithinCell ) && ( numPclsSurvivingInThisCell < targetTracersPerCell ) ; ++ iPosition )
+        {   // For each candidate position within cell, until cell has enough particles...
+            const Vec3 & fraction = sTracerPositionsWithinCell[ iPosition ] ;
+            particlePrototype.mPosition = vPosMinCorner + Vec3( fraction.x * vSpacing.x , fraction.y * vSpacing.y , fraction.z * vSpacing.z ) ;
 
-        }
-        else
-        {
-            int numPclsSurvivingInThisCell = 0 ;
-            for( unsigned pclOffset = 0 ; pclOffset < indicesOfParticlesInCell.Size() ; ++ pclOffset )
-            {   // For each particle in current grid cell...
-                const unsigned & pclIdx = indicesOfParticlesInCell[ pclOffset ] ;
-                const Particle & rPcl = particles[ pclIdx ] ;
-
-                // Interpolate SDF at particle position to get SDF value from grid.
-                float sdfFromGridHere ;
-                signedDistanceGrid.Interpolate( sdfFromGridHere , rPcl.mPosition ) ;
-
-                if( fabsf( sdfFromGridHere ) > regionNearSurface )
-                {   // Grid SDF at particle is too large.
-                    // Kill particle.
-                    Particles::MarkForKill( particles , pclIdx ) ;
-                }
-                else if( ( pclOffset > 0 ) && ( numPclsSurvivingInThisCell > maxNumPclsPerCell ) )
-                {   // This cell has too many particles.
-                    Particles::MarkForKill( particles , pclIdx ) ;
-                }
-                else
-                {
-                    //const float sdfSignFromPcl = rPcl.mDensity < ambientDensity ? 0.5f : -0.5f ; // higher density means inside
-                    //float sdfFromPcl = sdfSignFromPcl * rPcl.mSize ;
-                    //If particle SDF departs too far from grid SDF (e.g. if they have opposite sign and if their magnitude differs by a lot)
-                    //    reassign particle values (radius, density).
-                    ++ numPclsSurvivingInThisCell ;
+            // Interpolate SDF at particle position to get SDF value from grid.
+            float sdfFromGridAtPclCandidatePosition ;
+            signedDistanceGrid.Interpolate( sdfFromGridAtPclCandidatePosition , particlePrototype.mPosition ) ;
+
+            // Assign tracer particle size based on signed distance to surface
+            if( fabsf( sdfFromGridAtPclCandidatePosition ) < regionNearSurface )
+            {
+                if(     sdfFromGridAtPclCandidatePosition <= emergencyExteriorSdf
+                    &&  (       (       ( 0 == idx[0] )
+                                    ||  ( 0 == idx[1] )
+                                    ||  ( 0 == idx[2] )
+                                )
+                            ||  (       ( end[0] == idx[0]+1 )
+                                    ||  ( end[1] == idx[1]+1 )
+                                    ||  ( end[2] == idx[2]+1 )
+                                )
+                        )
+                    )
+                {   // "interior" particle on outer boundary.
+                    // Boundary particles must be exterior particles.
+                    sdfFromGridAtPclCandidatePosition = emergencyExteriorSdf ;
                 }
+                particlePrototype.mSize	= 2.0f * fabsf( sdfFromGridAtPclCandidatePosition ) ; // Set size to signed distance from surface
+                particlePrototype.mDensity = ( sdfFromGridAtPclCandidatePosition >= 0.0f ) ? densityOutside : densityInside ;
+                scratch.mTracersToEmit.PushBack( particlePrototype ) ;
+                ++ numPclsSurvivingInThisCell ;
             }
         }
     }
 
-    // Kill particles marked above.
-    Particles::KillParticlesMarkedForDeath( particles ) ;
+    // Put new particles into vacant slots first, then append any that remain.
+    const size_t numVacantSlots = scratch.mVacantSlots.Size() ;
+    const size_t numToEmit      = scratch.mTracersToEmit.Size() ;
+    const size_t numReused      = Min2( numVacantSlots , numToEmit ) ;
+    for( size_t iEmit = 0 ; iEmit < numReused ; ++ iEmit )
+    {   // For each new particle that fits in a vacant slot...
+        particles[ scratch.mVacantSlots[ iEmit ] ] = scratch.mTracersToEmit[ iEmit ] ;
+    }
+    if( numToEmit > numReused )
+    {   // Ran out of vacant slots.  Append remaining new particles.
+        const size_t iFirstNew = Particles::EmitBulk( particles , numToEmit - numReused , particlePrototype ) ;
+        for( size_t iEmit = numReused ; iEmit < numToEmit ; ++ iEmit )
+        {   // For each new particle that did not fit in a vacant slot...
+            particles[ iFirstNew + iEmit - numReused ] = scratch.mTracersToEmit[ iEmit ] ;
+        }
+    }
+    else if( numVacantSlots > numReused )
+    {   // Some slots remain vacant.  Kill particles still marked above.
+        Particles::KillIf( particles , Particles::IsMarkedDead() , scratch.mCompaction ) ;
+    }
 
 #endif
 }
@@ -1580,6 +1957,21 @@ void PclOpSeedSurfaceTracers::Replace( VECTOR< Particle > & particles
 
 
 
+/** Return fraction of full tracer count to keep, based on how much of the screen the signed distance grid covers.
+*/
+float PclOpSeedSurfaceTracers::GetEmissionLodFraction() const
+{
+    if( ( NULLPTR == mSignedDistanceGrid ) || mSignedDistanceGrid->Empty() )
+    {   // No surface.
+        return 1.0f ;
+    }
+    const Vec3 halfExtent = 0.5f * mSignedDistanceGrid->GetExtent() ;
+    return mLod.ComputeFraction( mSignedDistanceGrid->GetMinCorner() + halfExtent , halfExtent.Magnitude() ) ;
+}
+
+
+
+
 void PclOpSeedSurfaceTracers::Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame )
 {
     (void) timeStep , uFrame ; 
@@ -1587,12 +1979,18 @@ void PclOpSeedSurfaceTracers::Operate(  VECTOR< Particle > & particles , float t
     PERF_BLOCK( PclOpSeedSurfaceTracers__Operate ) ;
 
 #if 0
-    PclOpSeedSurfaceTracers::Emit( particles , 5 , * mSignedDistanceGrid , mBandWidth , mAmbientDensity ) ;
+    PclOpSeedSurfaceTracers::Emit( particles , 5 , * mSignedDistanceGrid , mBandWidth , mAmbientDensity , GetEmissionLodFraction() ) ;
 #else
+    // Keep fewer tracers per cell when the surface covers little of the screen.
+    const unsigned targetTracersPerCell = Max2( 1u , unsigned( float( mTargetTracersPerCell ) * GetEmissionLodFraction() + 0.5f ) ) ;
     PclOpSeedSurfaceTracers::Replace( particles
                                    , const_cast< UniformGrid< float > & >( * mSignedDistanceGrid )
+                                   , mSdfPinnedGrid
+                                   , mParticleContributionGrid
+                                   , mReplaceScratch
                                    , * mReferenceGrid
                                    , mBandWidth
-                                   , mAmbientDensity ) ;
+                                   , mAmbientDensity
+                                   , targetTracersPerCell ) ;
 #endif
 }
@@ -11,6 +11,61 @@
 
 #include "particleOperation.h"
 
+/** Number of frames of emission PclOpEmit reserves room for, whenever it must grow its particle array.
+
+    \see Particles::EmitBulk
+*/
+#define PCL_OP_EMIT_RESERVE_FRAMES 32
+
+/** Level of detail of emission, based on how much of the screen an emitter region covers.
+
+    Emitters whose region appears small, or lies off screen, emit fewer but
+    larger particles.  Particle mass is density times volume, so scaling
+    particle size by the cube root of the reciprocal of the emission fraction
+    keeps the mass, and dye, that an emitter adds per second the same.  Only
+    the sampling of that mass coarsens.
+
+    The application calls SetView each frame with its camera, so this module
+    does not depend on Render.  Until then, or after Disable, every region
+    gets full detail.
+*/
+class EmissionLod
+{
+    public:
+        EmissionLod()
+            : mFullDetailScreenFraction( 0.05f )
+            , mMinFraction( 0.125f )
+            , mEye( 0.0f , 0.0f , 0.0f )
+            , mForward( 0.0f , 0.0f , -1.0f )
+            , mTanHalfFovVert( 1.0f )
+            , mAspectRatio( 1.0f )
+            , mEnabled( false )
+        {}
+
+        void    SetView( const Vec3 & eye , const Vec3 & target , float fieldOfViewVertDegrees , float aspectRatio ) ;
+
+        /// Make every region get full detail, until the next SetView.
+        void    Disable()                                   { mEnabled = false ; }
+
+        /// Return whether SetView has supplied a view since construction or the most recent Disable.
+        bool    IsEnabled() const                           { return mEnabled ; }
+
+        float   ComputeFraction( const Vec3 & center , float radius ) const ;
+
+        /// Return factor by which to scale size of particles emitted with the given emission fraction, so their total volume, hence mass, stays the same.
+        static float SizeScaleFromFraction( float fraction ) { return powf( fraction , - 1.0f / 3.0f ) ; }
+
+        float   mFullDetailScreenFraction   ;   ///< Fraction of screen area a region must cover to get full detail.
+        float   mMinFraction                ;   ///< Smallest fraction of full emission, used for regions that appear tiny or lie off screen.
+
+    private:
+        Vec3    mEye                        ;   ///< Position of camera.
+        Vec3    mForward                    ;   ///< Unit direction camera looks.
+        float   mTanHalfFovVert             ;   ///< Tangent of half the vertical field of view.
+        float   mAspectRatio                ;   ///< Ratio of viewport width to height.
+        bool    mEnabled                    ;   ///< Whether SetView supplied a view.
+} ;
+
 /** Operation to emit particles.
 */
 class PclOpEmit : public IParticleOperation
@@ -19,18 +74,28 @@ class PclOpEmit : public IParticleOperation
         PclOpEmit()
             : mEmitRate( 60.0f )
             , mRemainder( 0.0f )
+            , mRandomSeed( sNumConstructed ++ )
         {}
 
         VIRTUAL_CONSTRUCTORS( PclOpEmit ) ;
 
         void Operate( VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
 
+        float GetEmissionLodFraction() const ;
+
         static void Emit( VECTOR< Particle > & particles , const UniformGridGeometry & uniformGrid , unsigned multiplier , const VECTOR< Particle > * vortons ) ;
 
         Particle    mTemplate   ;   ///< Default values for new particle
         Particle    mSpread     ;   ///< Range of values for new particle
         float       mEmitRate   ;   ///< Particles per second to emit
         float       mRemainder  ;   ///< Fractional particles remaining.
+        unsigned    mRandomSeed ;   ///< Key for CounterRng that perturbs new particles, distinct per emitter so emitters do not perturb in lockstep.
+        EmissionLod mLod        ;   ///< Level of detail of emission, based on how much of the screen the emitter region covers.
+
+    private:
+        void PerturbNewParticles_Slice( VECTOR< Particle > & particles , size_t iFirstNew , unsigned uFrame , float sizeScale , size_t itStart , size_t itEnd ) const ;
+
+        static unsigned sNumConstructed ;   ///< Number of emitters constructed so far, used to assign mRandomSeed.
 } ;
 
 #endif
@@ -65,6 +130,9 @@ class PclOpEmit : public IParticleOperation
 #define PARTICLE_OPERATION_RESAMPLE_SURFACE_H
 
 #include "Core/SpatialPartition/uniformGrid.h"
+#include "Core/SpatialPartition/cellList.h"
+
+#include "Particles/particleLifecycle.h"
 
 #include "particleOperation.h"
 
@@ -76,8 +144,19 @@ class PclOpSeedSurfaceTracers : public IParticleOperation
 
         static const float sBandWidthAutomatic ;
 
+        /** Storage Replace reuses across calls, so steady-state tracer maintenance makes no heap calls.
+        */
+        struct ReplaceScratch
+        {
+            CellList                        mParticlePartition  ;   ///< Spatial partition of tracers.
+            VECTOR< Particle >              mTracersToEmit      ;   ///< Tracers to add, before they move into the tracer array.
+            VECTOR< size_t >                mVacantSlots        ;   ///< Indices of removed tracers, whose slots new tracers reuse.
+            Particles::CompactionScratch    mCompaction         ;   ///< Storage for removing tracers whose slots remain vacant.
+        } ;
+
         PclOpSeedSurfaceTracers()
             : mBandWidth( sBandWidthAutomatic )
+            , mTargetTracersPerCell( 2 )
             , mAmbientDensity( - FLT_MAX )
             , mSignedDistanceGrid( NULLPTR )
             , mReferenceGrid( NULLPTR )
@@ -87,19 +166,35 @@ class PclOpSeedSurfaceTracers : public IParticleOperation
 
         void Operate( VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
 
-        static void Emit( VECTOR< Particle > & particles , const int tracerCountMultiplier , const UniformGrid< float > & densityDeviationGrid , float regionNearSurface , const float ambientDensity ) ;
-        static void Replace( VECTOR< Particle > & particles , UniformGrid< float > & signedDistanceGrid , const UniformGridGeometry & referenceGrid , float regionNearSurface , const float ambientDensity ) ;
+        float GetEmissionLodFraction() const ;
+
+        static void Emit( VECTOR< Particle > & particles , const int tracerCountMultiplier , const UniformGrid< float > & signedDistanceGrid , float regionNearSurface , const float ambientDensity , float lodFraction = 1.0f ) ;
+        static void Replace( VECTOR< Particle > & particles , UniformGrid< float > & signedDistanceGrid , UniformGrid< int > & sdfPinnedGrid , UniformGrid< float > & particleContributionGrid , ReplaceScratch & scratch , const UniformGridGeometry & referenceGrid , float regionNearSurface , const float ambientDensity , unsigned targetTracersPerCell ) ;
 
         Particle                        mTemplate           ;   ///< Default values for new particle
         Particle                        mSpread             ;   ///< Range of values for new particle
         float                           mBandWidth          ;   ///< Width of band
+        unsigned                        mTargetTracersPerCell   ;   ///< Number of tracers Replace keeps in each cell near the surface.
         float                           mAmbientDensity     ;   ///< Density of fluid in the absence of particles.
         const UniformGrid< float > *    mSignedDistanceGrid ;   ///< Signed distance field
         const UniformGridGeometry *     mReferenceGrid      ;   ///< Grid geometry to use for basis for SDF grid.
+        UniformGrid< int >              mSdfPinnedGrid              ;   ///< Scratch for Replace.  Kept across steps so it reuses its memory.
+        UniformGrid< float >            mParticleContributionGrid   ;   ///< Scratch for Replace.  Kept across steps so it reuses its memory.
+        ReplaceScratch                  mReplaceScratch             ;   ///< Scratch for Replace.  Kept across steps so it reuses its memory.
+        EmissionLod                     mLod                        ;   ///< Level of detail of tracer seeding, based on how much of the screen the signed distance grid covers.
 } ;
 
+/** Width, in grid cells, of the band around the surface within which SDF values are exact.
+
+    Beyond this band, ComputeRemainingSDFFromImmediateSDF_Nearest saturates
+    values to the band width, with the correct sign.  PclOpSeedSurfaceTracers::Replace
+    examines gridpoints up to roughly 3 cell diagonals plus one more cell diagonal
+    plus one cell from the surface, so this must exceed that.
+*/
+#define SDF_NARROW_BAND_NUM_CELLS 10.0f
+
 extern void ComputeImmediateSDFFromDensity_Nearest( UniformGrid< float > & signedDistanceGrid , UniformGrid< int > & sdfPinnedGrid , const UniformGrid< float > & densityDeviationGrid , float densityOutside ) ;
-extern void ComputeRemainingSDFFromImmediateSDF_Nearest( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid ) ;
+extern void ComputeRemainingSDFFromImmediateSDF_Nearest( UniformGrid< float > & signedDistanceGrid , const UniformGrid< int > & sdfPinnedGrid , float bandWidth = FLT_MAX ) ;
 extern void ComputeSDF_Sphere( UniformGrid< float > & signedDistanceGrid ) ;
 
 #endif
@@ -13,6 +13,8 @@
 
 #include "Core/SpatialPartition/uniformGridMath.h"
 
+#include "Core/parallelExecution.h"
+
 #include "Particles/particle.h"
 
 #include "Particles/Operation/pclOpEvolve.h"
@@ -20,12 +22,95 @@
 
 
 
+/** Return difference between particle velocity and grid velocity at particle, or zero if particle lies outside grid.
+
+    This difference comes from sources other than the grid (e.g. wind), so
+    it stays constant during a step, while grid velocity gets re-sampled.
+*/
+static inline Vec3 VelocityOffset_AssumesFpcwSetToTruncate( const UniformGrid< Vec3 > & velocityGrid , const Particle & pcl )
+{
+    if( velocityGrid.Encompasses( pcl.mPosition ) )
+    {   // Particle lies inside grid.
+        Vec3 velocityFromGrid ;
+        velocityGrid.Interpolate_AssumesFpcwSetToTruncate( velocityFromGrid , pcl.mPosition ) ;
+        return pcl.mVelocity - velocityFromGrid ;
+    }
+    return Vec3( 0.0f , 0.0f , 0.0f ) ;
+}
+
+
+
+
+/** Return velocity sampled from grid at the given position, plus the given offset, or the given fallback if position lies outside grid.
+*/
+static inline Vec3 SampleVelocity_AssumesFpcwSetToTruncate( const UniformGrid< Vec3 > & velocityGrid , const Vec3 & position , const Vec3 & velocityOffset , const Vec3 & fallback )
+{
+    if( velocityGrid.Encompasses( position ) )
+    {   // Position lies inside grid.
+        Vec3 velocity ;
+        velocityGrid.Interpolate_AssumesFpcwSetToTruncate( velocity , position ) ;
+        return velocity + velocityOffset ;
+    }
+    return fallback ;
+}
+
+
+
+
+/** Return position after one (sub)step using the given integrator.
+
+    \param position        Position at start of step.
+
+    \param velocity        Velocity at start of step, i.e. the first Runge-Kutta stage.
+
+    \param velocityOffset  Velocity to add to each sample from grid.  See VelocityOffset_AssumesFpcwSetToTruncate.
+
+    \param duration        Duration of step.
+
+    \param velocityGrid    Grid from which to sample velocity at intermediate stages.  Only forward Euler allows NULL.
+
+    \param integrator      Scheme by which to advance position.
+
+    Stages whose position lies outside the grid reuse the velocity of the
+    previous stage, so particles leaving the grid degrade gracefully to
+    forward Euler.
+
+    \see PclOpEvolve::IntegratorE.
+*/
+static inline Vec3 StepPosition_AssumesFpcwSetToTruncate( const Vec3 & position , const Vec3 & velocity , const Vec3 & velocityOffset , float duration , const UniformGrid< Vec3 > * velocityGrid , PclOpEvolve::IntegratorE integrator )
+{
+    switch( integrator )
+    {
+        case PclOpEvolve::INTEGRATOR_MIDPOINT:
+        {
+            const Vec3 midVelocity = SampleVelocity_AssumesFpcwSetToTruncate( * velocityGrid , position + velocity * ( 0.5f * duration ) , velocityOffset , velocity ) ;
+            return position + midVelocity * duration ;
+        }
+        case PclOpEvolve::INTEGRATOR_HEUN3:
+        {
+            const Vec3 velocity2 = SampleVelocity_AssumesFpcwSetToTruncate( * velocityGrid , position + velocity  * ( duration / 3.0f ) , velocityOffset , velocity ) ;
+            const Vec3 velocity3 = SampleVelocity_AssumesFpcwSetToTruncate( * velocityGrid , position + velocity2 * ( duration * ( 2.0f / 3.0f ) ) , velocityOffset , velocity2 ) ;
+            return position + ( velocity + 3.0f * velocity3 ) * ( 0.25f * duration ) ;
+        }
+        default:
+            ASSERT( PclOpEvolve::INTEGRATOR_EULER == integrator ) ;
+            return position + velocity * duration ;
+    }
+}
+
+
+
+
 /** Evolve (subset of) given particles.
 
     \param particles - dynamic array of particles to evolve
 
     \param timeStep     Amount of virtual time by which to advance simulation.
 
+    \param velocityGrid     Grid from which higher-order integrators sample velocity.  Only forward Euler allows NULL.
+
+    \param integrator       Scheme by which to advance positions.
+
     \param itStart - index of first particle to evolve
 
     \param itEnd - index of last particle to evolve
@@ -33,25 +118,42 @@
     \see    Changex87FloatingPointToTruncate, Interpolate_AssumesFpcwSetToTruncate,
             IndicesOfPosition_AssumesFpcwSetToTruncate, StoreFloatAsInt.
 */
-static void EvolveParticlesSlice( VECTOR< Particle > & particles , const float & timeStep , size_t itStart , size_t itEnd )
+static void EvolveParticlesSlice( VECTOR< Particle > & particles , const float & timeStep , const UniformGrid< Vec3 > * velocityGrid , PclOpEvolve::IntegratorE integrator , size_t itStart , size_t itEnd )
 {
-    PERF_BLOCK( EvolveParticlesSlice ) ; // Note, as of 2016jan, PerfBlock does not fully support ephemeral worker threads, so this block will only show up in tallies for the main thread.  PerfBlocks for worker threads will not get tallied.
+    PERF_BLOCK_INNER( EvolveParticlesSlice ) ; // Note, as of 2016jan, PerfBlock does not fully support ephemeral worker threads, so this block will only show up in tallies for the main thread.  PerfBlocks for worker threads will not get tallied.
 
     ASSERT( itEnd <= particles.Size() ) ;
 
-    //static bool evolve = true ;
-    //if( evolve )
-    {
+    if( PclOpEvolve::INTEGRATOR_EULER == integrator )
+    {   // Forward Euler needs only particle velocity.
         for( size_t offset = itStart ; offset < itEnd ; ++ offset )
         {   // For each particle in this slice...
             Particle & pcl = particles[ offset ] ;
             pcl.mPosition += pcl.mVelocity * timeStep ;
             //pcl.mOrientation += pcl.mAngularVelocity * timeStep ;
-        #if ENABLE_PARTICLE_POSITION_HISTORY
-            pcl.RecordPositionHistory() ;
-        #endif
         }
+        return ;
     }
+
+    ASSERT( velocityGrid && ! velocityGrid->HasZeroExtent() ) ;
+
+#if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
+    // Change floating-point control word to "truncate" for float-to-int conversion.
+    // See StoreFloatAsInt.
+    const WORD OldCtrlWord = Changex87FloatingPointToTruncate() ;
+#endif
+
+    for( size_t offset = itStart ; offset < itEnd ; ++ offset )
+    {   // For each particle in this slice...
+        Particle &  pcl             = particles[ offset ] ;
+        const Vec3  velocityOffset  = VelocityOffset_AssumesFpcwSetToTruncate( * velocityGrid , pcl ) ;
+        pcl.mPosition = StepPosition_AssumesFpcwSetToTruncate( pcl.mPosition , pcl.mVelocity , velocityOffset , timeStep , velocityGrid , integrator ) ;
+    }
+
+#if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
+    // Restore FPCW.  See comment above.
+    SetFloatingPointControlWord( OldCtrlWord ) ;
+#endif
 }
 
 
@@ -62,18 +164,22 @@ static void EvolveParticlesSlice( VECTOR< Particle > & particles , const float &
 */
 class Particles_Evolve_TBB
 {
-        VECTOR< Particle >  &   mParticles    ;   ///< Array of particles to evolve
-        const float         &   mTimeStep     ;   ///< Duration of this time step
+        VECTOR< Particle >          &   mParticles      ;   ///< Array of particles to evolve
+        const float                 &   mTimeStep       ;   ///< Duration of this time step
+        const UniformGrid< Vec3 >   *   mVelocityGrid   ;   ///< Grid from which higher-order integrators sample velocity
+        PclOpEvolve::IntegratorE        mIntegrator     ;   ///< Scheme by which to advance positions
     public:
-        void operator() ( const tbb::blocked_range<size_t> & r ) const
+        void operator() ( const Parallel::Range & r ) const
         {   // Evolve subset of particles.
             SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
             SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-            EvolveParticlesSlice( mParticles , mTimeStep , r.begin() , r.end() ) ;
+            EvolveParticlesSlice( mParticles , mTimeStep , mVelocityGrid , mIntegrator , r.begin() , r.end() ) ;
         }
-        Particles_Evolve_TBB( VECTOR< Particle > & particles , const float & timeStep )
+        Particles_Evolve_TBB( VECTOR< Particle > & particles , const float & timeStep , const UniformGrid< Vec3 > * velocityGrid , PclOpEvolve::IntegratorE integrator )
             : mParticles( particles )
             , mTimeStep( timeStep )
+            , mVelocityGrid( velocityGrid )
+            , mIntegrator( integrator )
         {
             mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
             mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
@@ -87,18 +193,172 @@ class Particles_Evolve_TBB
 
 
 
+/** Parameters that every slice of EvolveWithSubsteps shares.
+*/
+struct SubstepSchedule
+{
+    const UniformGrid< Vec3 > * mVelocityGrid       ;   ///< Grid from which to sample velocity.
+    float                       mTimeStep           ;   ///< Amount of virtual time by which to advance simulation.
+    float                       mMaxDistancePerStep ;   ///< Farthest a particle can move in one (sub)step.
+    unsigned                    mMaxSubstepLevel    ;   ///< Largest substep level to assign.
+    PclOpEvolve::IntegratorE    mIntegrator         ;   ///< Scheme by which to advance positions within each (sub)step.
+} ;
+
+
+
+
+/** Assign substep levels to (subset of) given particles, and evolve those that need no substeps.
+
+    The substep level of a particle is the base-2 logarithm of the number of
+    substeps it takes, so that it moves at most maxDistancePerStep per
+    substep.  Particles at level 0 take a single step here.  Others evolve
+    later, in SubstepParticlesSlice.
+
+    \param particles - dynamic array of particles to evolve
+
+    \param schedule             Time step, substep limits, velocity grid and integrator.
+
+    \param substepLevels        Substep level of each particle, assigned by this routine.
+
+    \param itStart - index of first particle to evolve
+
+    \param itEnd - index of last particle to evolve
+
+*/
+static void EvolveSlowParticlesSlice( VECTOR< Particle > & particles , const SubstepSchedule & schedule , unsigned char * substepLevels , size_t itStart , size_t itEnd )
+{
+    PERF_BLOCK_INNER( EvolveSlowParticlesSlice ) ;
+
+    const UniformGrid< Vec3 > *     velocityGrid        = schedule.mVelocityGrid ;
+    const float                     timeStep            = schedule.mTimeStep ;
+    const float                     maxDistancePerStep  = schedule.mMaxDistancePerStep ;
+    const unsigned                  maxSubstepLevel     = schedule.mMaxSubstepLevel ;
+    const PclOpEvolve::IntegratorE  integrator          = schedule.mIntegrator ;
+
+    ASSERT( itEnd <= particles.Size() ) ;
+    ASSERT( maxDistancePerStep > 0.0f ) ;
+    ASSERT( velocityGrid && ! velocityGrid->HasZeroExtent() ) ;
+
+#if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
+    // Change floating-point control word to "truncate" for float-to-int conversion.
+    // See StoreFloatAsInt.
+    const WORD OldCtrlWord = Changex87FloatingPointToTruncate() ;
+#endif
+
+    for( size_t offset = itStart ; offset < itEnd ; ++ offset )
+    {   // For each particle in this slice...
+        Particle &  pcl             = particles[ offset ] ;
+        const float distance        = pcl.mVelocity.Magnitude() * timeStep ;
+        unsigned    substepLevel    = 0 ;
+        while( ( distance > maxDistancePerStep * float( 1 << substepLevel ) ) && ( substepLevel < maxSubstepLevel ) )
+        {   // Particle would move too far per substep at this level.
+            ++ substepLevel ;
+        }
+        substepLevels[ offset ] = static_cast< unsigned char >( substepLevel ) ;
+        if( 0 == substepLevel )
+        {   // Particle is slow enough to take a single step.
+            const Vec3 velocityOffset = ( PclOpEvolve::INTEGRATOR_EULER == integrator ) ? Vec3( 0.0f , 0.0f , 0.0f ) : VelocityOffset_AssumesFpcwSetToTruncate( * velocityGrid , pcl ) ;
+            pcl.mPosition = StepPosition_AssumesFpcwSetToTruncate( pcl.mPosition , pcl.mVelocity , velocityOffset , timeStep , velocityGrid , integrator ) ;
+        }
+    }
+
+#if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
+    // Restore FPCW.  See comment above.
+    SetFloatingPointControlWord( OldCtrlWord ) ;
+#endif
+}
+
+
+
+
+/** Evolve (subset of) given particles, indexed indirectly, in several substeps each.
+
+    Each substep re-samples velocity from the given grid at the particle's
+    current position.  Velocity from sources other than the grid (e.g. wind)
+    does not change during a step, so this retains the difference between
+    particle velocity and grid velocity at the start of the step, and adds
+    it to velocity sampled at each substep.
+
+    The grid is the one computed for this frame, so substeps reuse the
+    velocity solved at gridpoints instead of solving the influence tree
+    again.  Particles that leave the grid keep the velocity of their last
+    substep inside it.
+
+    Each substep advances with the given integrator, starting from velocity
+    re-sampled at the start of that substep.
+
+    \param particles - dynamic array of particles to evolve
+
+    \param schedule     Time step, velocity grid and integrator.
+
+    \param numSubsteps  Number of substeps to take.
+
+    \param indices      Indices, into particles, of particles to evolve.
+
+    \param itStart - index, into indices, of first particle to evolve
+
+    \param itEnd - index, into indices, of last particle to evolve
+
+    \see    Changex87FloatingPointToTruncate, Interpolate_AssumesFpcwSetToTruncate,
+            IndicesOfPosition_AssumesFpcwSetToTruncate, StoreFloatAsInt.
+*/
+static void SubstepParticlesSlice( VECTOR< Particle > & particles , const SubstepSchedule & schedule , unsigned numSubsteps , const VECTOR< size_t > & indices , size_t itStart , size_t itEnd )
+{
+    PERF_BLOCK_INNER( SubstepParticlesSlice ) ;
+
+    const UniformGrid< Vec3 > *     velocityGrid    = schedule.mVelocityGrid ;
+    const float                     timeStep        = schedule.mTimeStep ;
+    const PclOpEvolve::IntegratorE  integrator      = schedule.mIntegrator ;
+
+    ASSERT( itEnd <= indices.Size() ) ;
+    ASSERT( velocityGrid && ! velocityGrid->HasZeroExtent() ) ;
+    ASSERT( numSubsteps > 1 ) ;
+
+#if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
+    // Change floating-point control word to "truncate" for float-to-int conversion.
+    // See StoreFloatAsInt.
+    const WORD OldCtrlWord = Changex87FloatingPointToTruncate() ;
+#endif
+
+    const float substep = timeStep / float( numSubsteps ) ;
+
+    for( size_t iIndex = itStart ; iIndex < itEnd ; ++ iIndex )
+    {   // For each particle in this slice...
+        Particle &  pcl             = particles[ indices[ iIndex ] ] ;
+        Vec3        velocity        = pcl.mVelocity ;
+        const Vec3  velocityOffset  = VelocityOffset_AssumesFpcwSetToTruncate( * velocityGrid , pcl ) ;
+        pcl.mPosition = StepPosition_AssumesFpcwSetToTruncate( pcl.mPosition , velocity , velocityOffset , substep , velocityGrid , integrator ) ;
+        for( unsigned iSubstep = 1 ; iSubstep < numSubsteps ; ++ iSubstep )
+        {   // For each remaining substep...
+            // Re-sample velocity if particle is inside grid.
+            velocity = SampleVelocity_AssumesFpcwSetToTruncate( * velocityGrid , pcl.mPosition , velocityOffset , velocity ) ;
+            pcl.mPosition = StepPosition_AssumesFpcwSetToTruncate( pcl.mPosition , velocity , velocityOffset , substep , velocityGrid , integrator ) ;
+        }
+    }
+
+#if UNIFORM_GRID_TRUNCATE_NEEDS_FPCW
+    // Restore FPCW.  See comment above.
+    SetFloatingPointControlWord( OldCtrlWord ) ;
+#endif
+}
+
+
+
+
 /** Evolve particle states.
 
     \param particles    Dynamic array of particles to evolve.
 
     \param timeStep     Amount of virtual time by which to advance simulation.
 
-    \param uFrame       Frame counter.
+    \param velocityGrid Grid from which higher-order integrators sample velocity.  Only forward Euler allows NULL.
+
+    \param integrator   Scheme by which to advance positions.
 
     \see ComputeVelocityFromVorticity, EvolveParticlesSlice.
 
 */
-static void Evolve( VECTOR< Particle > & particles , const float & timeStep )
+static void Evolve( VECTOR< Particle > & particles , const float & timeStep , const UniformGrid< Vec3 > * velocityGrid , PclOpEvolve::IntegratorE integrator )
 {
     const size_t numParticles = particles.Size() ;
 
@@ -106,18 +366,132 @@ static void Evolve( VECTOR< Particle > & particles , const float & timeStep )
     // Estimate grain size based on size of problem and number of processors.
     const size_t grainSize =  Max2( size_t( 1 ) , numParticles / gNumberOfProcessors ) ;
     // Evolve particles using multiple threads.
-    parallel_for( tbb::blocked_range<size_t>( 0 , numParticles , grainSize ) , Particles_Evolve_TBB( particles , timeStep ) ) ;
+    Parallel::For( 0 , numParticles , grainSize , Particles_Evolve_TBB( particles , timeStep , velocityGrid , integrator ) ) ;
 #else
-    EvolveParticlesSlice( particles , timeStep , 0 , numParticles ) ;
+    EvolveParticlesSlice( particles , timeStep , velocityGrid , integrator , 0 , numParticles ) ;
 #endif
 }
 
 
 
 
+/** Evolve particle states, with substeps for particles that would otherwise move too far per step.
+
+    Particles are binned by substep level, where level L means 2^L
+    substeps.  Each level then evolves in parallel over its own bin, so
+    threads working on one level have uniform work per particle.
+
+    \param particles    Dynamic array of particles to evolve.
+
+    \param timeStep     Amount of virtual time by which to advance simulation.
+
+    \param velocityGrid     Uniform grid of velocity values.
+
+    \param maxCflNumber     Most grid cells a particle can cross per substep.
+
+    \param maxSubstepLevel  Base-2 logarithm of most substeps per time step.
+
+    \param integrator       Scheme by which to advance positions within each (sub)step.
+
+    \see EvolveSlowParticlesSlice, SubstepParticlesSlice.
+*/
+static void EvolveWithSubsteps( VECTOR< Particle > & particles , const float & timeStep , const UniformGrid< Vec3 > * velocityGrid , float maxCflNumber , unsigned maxSubstepLevel , PclOpEvolve::IntegratorE integrator )
+{
+    const size_t    numParticles        = particles.Size() ;
+    const Vec3 &    cellSpacing         = velocityGrid->GetCellSpacing() ;
+    const float     minCellSpacing      = Min2( cellSpacing.x , Min2( cellSpacing.y , cellSpacing.z ) ) ;
+    const float     maxDistancePerStep  = maxCflNumber * minCellSpacing ;
+
+    VECTOR< unsigned char > substepLevels ;
+    substepLevels.Resize( numParticles ) ;
+
+    const SubstepSchedule schedule = { velocityGrid , timeStep , maxDistancePerStep , maxSubstepLevel , integrator } ;
+
+    {
+        PERF_BLOCK( PclOpEvolve__EvolveSlow ) ;
+        // Assign substep levels and evolve slow particles using multiple threads.
+        Parallel::For( 0 , numParticles , Parallel::GetGrainSize( numParticles ) , Parallel::Function( EvolveSlowParticlesSlice , particles , schedule , substepLevels.Data() ) ) ;
+    }
+
+    // Bin fast particles by substep level.
+    VECTOR< size_t > particlesAtLevel[ PclOpEvolve::MAX_SUBSTEP_LEVEL + 1 ] ;
+    {
+        PERF_BLOCK( PclOpEvolve__BinFast ) ;
+        for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+        {   // For each particle...
+            const unsigned substepLevel = substepLevels[ iPcl ] ;
+            if( substepLevel > 0 )
+            {   // Particle needs substeps.
+                particlesAtLevel[ substepLevel ].PushBack( iPcl ) ;
+            }
+        }
+    }
+
+    for( unsigned substepLevel = 1 ; substepLevel <= maxSubstepLevel ; ++ substepLevel )
+    {   // For each substep level...
+        const VECTOR< size_t > &    indices         = particlesAtLevel[ substepLevel ] ;
+        const size_t                numAtLevel      = indices.Size() ;
+        const unsigned              numSubsteps     = 1 << substepLevel ;
+        if( 0 == numAtLevel )
+        {   // No particles at this level.
+            continue ;
+        }
+        PERF_BLOCK( PclOpEvolve__Substep ) ;
+        // Evolve fast particles using multiple threads.
+        Parallel::For( 0 , numAtLevel , Parallel::GetGrainSize( numAtLevel ) , Parallel::Function( SubstepParticlesSlice , particles , schedule , numSubsteps , indices ) ) ;
+    }
+}
+
+
+
+
 void PclOpEvolve::Operate(  VECTOR< Particle > & particles , float timeStep , unsigned /* uFrame */ )
 {
     PERF_BLOCK( PclOpEvolve__Operate ) ;
 
-    Evolve( particles , timeStep ) ;
+    if( UsesSubsteps() )
+    {   // Substeps are enabled and a velocity grid is available to re-sample.
+        ASSERT( mMaxSubstepLevel <= MAX_SUBSTEP_LEVEL ) ;
+        const unsigned maxSubstepLevel = mMaxSubstepLevel < MAX_SUBSTEP_LEVEL ? mMaxSubstepLevel : unsigned( MAX_SUBSTEP_LEVEL ) ;
+        EvolveWithSubsteps( particles , timeStep , mVelocityGrid , mMaxCflNumber , maxSubstepLevel , GetEffectiveIntegrator() ) ;
+    }
+    else
+    {
+        Evolve( particles , timeStep , mVelocityGrid , GetEffectiveIntegrator() ) ;
+    }
+
+#if ENABLE_PARTICLE_POSITION_HISTORY
+    mPositionHistory.Record( particles ) ;
+#endif
 }
+
+
+
+
+void PclOpEvolve::OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    ASSERT( ! UsesSubsteps() ) ;
+    EvolveParticlesSlice( particles , timeStep , mVelocityGrid , GetEffectiveIntegrator() , iPclBegin , iPclEnd ) ;
+}
+
+
+
+
+#if ENABLE_PARTICLE_POSITION_HISTORY
+void PclOpEvolve::BeginFusedPass( const VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ )
+{
+    mFusedParticles = & particles ;
+}
+
+
+
+
+/** Record positions of sampled particles, after every chunk has moved.
+*/
+void PclOpEvolve::EndFusedPass()
+{
+    ASSERT( mFusedParticles != NULLPTR ) ;
+    mPositionHistory.Record( * mFusedParticles ) ;
+    mFusedParticles = NULLPTR ;
+}
+#endif
@@ -11,19 +11,91 @@
 
 #include "particleOperation.h"
 
+#if ENABLE_PARTICLE_POSITION_HISTORY
+#   include "Particles/particlePositionHistory.h"
+#endif
+
 /** Operation to evolve particle states -- position from velocity, orientation from angular velocity.
 
-    \see EvolveParticlesSlice
+    When mVelocityGrid is set and mMaxCflNumber is positive, particles that
+    would move farther than mMaxCflNumber grid cells in one step instead
+    evolve in several substeps, re-sampling velocity from mVelocityGrid at
+    each substep.  That lets the global time step grow without fast
+    particles skipping across flow features, while slow particles still
+    take a single step.
+
+    When mVelocityGrid is set, mIntegrator can select a Runge-Kutta scheme,
+    which samples mVelocityGrid at intermediate positions within each
+    (sub)step.  Velocity from sources other than the grid (e.g. wind) stays
+    constant across stages, as it does across substeps.  Forward Euler makes
+    particles spiral out of vortices unless steps are small; higher-order
+    schemes keep them on closed streamlines at larger steps, at the cost
+    of one (midpoint) or two (Heun) grid samples per particle per step.
+
+    \see EvolveParticlesSlice, SubstepParticlesSlice, StepPosition
 */
 class PclOpEvolve : public IParticleOperation
 {
     public:
+        /// Scheme by which to advance positions from velocity.
+        enum IntegratorE
+        {
+            INTEGRATOR_EULER    ,   ///< Forward Euler: first order, using only particle velocity.
+            INTEGRATOR_MIDPOINT ,   ///< Explicit midpoint: second-order Runge-Kutta, sampling velocity grid halfway through each step.
+            INTEGRATOR_HEUN3    ,   ///< Heun's third-order Runge-Kutta, sampling velocity grid at one third and two thirds of each step.
+            NUM_INTEGRATORS
+        } ;
+
         PclOpEvolve()
+            : mVelocityGrid( 0 )
+            , mMaxCflNumber( 0.0f )
+            , mMaxSubstepLevel( 3 )
+            , mIntegrator( INTEGRATOR_EULER )
+        #if ENABLE_PARTICLE_POSITION_HISTORY
+            , mFusedParticles( NULLPTR )
+        #endif
         {}
 
         VIRTUAL_CONSTRUCTORS( PclOpEvolve ) ;
         
         void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned /* uFrame */ ) ;
+
+        bool IsFusable() const { return ! UsesSubsteps() ; }
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY ) ; }
+    #if ENABLE_PARTICLE_POSITION_HISTORY
+        void BeginFusedPass( const VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+        void EndFusedPass() ;
+
+        /// Return history of positions of a sampled subset of particles, recorded after each evolution.
+              ParticlePositionHistory & GetPositionHistory()        { return mPositionHistory ; }
+        const ParticlePositionHistory & GetPositionHistory() const  { return mPositionHistory ; }
+    #endif
+
+        static const unsigned MAX_SUBSTEP_LEVEL = 6 ;   ///< Largest value mMaxSubstepLevel can have.
+
+        const UniformGrid< Vec3  > *    mVelocityGrid       ;   ///< Grid of velocity values to re-sample during substeps and Runge-Kutta stages, or NULL to disable both.
+        float                           mMaxCflNumber       ;   ///< Most grid cells a particle can cross per substep.  Zero disables substeps.
+        unsigned                        mMaxSubstepLevel    ;   ///< Base-2 logarithm of most substeps per time step, at most MAX_SUBSTEP_LEVEL.
+        IntegratorE                     mIntegrator         ;   ///< Scheme by which to advance positions.  Schemes other than INTEGRATOR_EULER need mVelocityGrid.
+
+    private:
+        /// Return whether substeps are enabled and a velocity grid is available to re-sample.  Substeps bin particles globally, so they cannot fuse.
+        bool UsesSubsteps() const
+        {
+            return mVelocityGrid && ! mVelocityGrid->HasZeroExtent() && ( mMaxCflNumber > 0.0f ) && ( mMaxSubstepLevel > 0 ) ;
+        }
+
+        /// Return integrator to use this step, which falls back to forward Euler when no velocity grid is available to sample.
+        IntegratorE GetEffectiveIntegrator() const
+        {
+            return ( mVelocityGrid && ! mVelocityGrid->HasZeroExtent() ) ? mIntegrator : INTEGRATOR_EULER ;
+        }
+
+    #if ENABLE_PARTICLE_POSITION_HISTORY
+        ParticlePositionHistory         mPositionHistory    ;   ///< Recent positions of a sampled subset of particles, for rendering pathlines.
+        const VECTOR< Particle > *      mFusedParticles     ;   ///< Particles of fused pass in progress, whose positions EndFusedPass records.
+    #endif
 } ;
 
-#endif
\ No newline at end of file
+#endif
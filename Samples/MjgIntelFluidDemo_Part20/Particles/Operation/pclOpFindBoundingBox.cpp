@@ -11,6 +11,8 @@
 
 #include "Core/Performance/perfBlock.h"
 
+#include "Core/parallelExecution.h"
+
 #include "Core/SpatialPartition/uniformGridMath.h"
 
 #include "Particles/particle.h"
@@ -18,8 +20,102 @@
 #include "Particles/Operation/pclOpFindBoundingBox.h"
 
 
+// Macros --------------------------------------------------------------
+
+/// Whether to use SSE intrinsics to find bounding boxes.  Otherwise, use scalar Min2 and Max2 per axis.
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __SSE__ )
+    #define PCL_OP_FIND_BOUNDING_BOX_USE_SSE 1
+#else
+    #define PCL_OP_FIND_BOUNDING_BOX_USE_SSE 0
+#endif
+
+#if PCL_OP_FIND_BOUNDING_BOX_USE_SSE
+    #include <xmmintrin.h>  // SSE intrinsics
+#endif
+
+// Private variables --------------------------------------------------------------
+
 static const float  sOneMinusEpsilon        = 1.0f - FLT_EPSILON ;
 
+// Private functions --------------------------------------------------------------
+
+/** Update axis-aligned bounding box to include (subset of) given particles.
+
+    \param particles    Dynamic array of particles.
+
+    \param itStart      Index of first particle to include.
+
+    \param itEnd        One past index of last particle to include.
+
+    \param minCorner    (in/out) Minimal corner of bounding box found so far.
+
+    \param maxCorner    (in/out) Maximal corner of bounding box found so far.
+
+    With SSE, each particle position occupies one register, so updating both
+    corners takes one min and one max instruction, instead of 6 scalar
+    comparisons.  Loading a position as 4 floats also loads the first
+    component of mVelocity, which follows mPosition in Particle.  That lane
+    is ignored.
+*/
+static void FindBoundingBoxSlice( const VECTOR< Particle > & particles , size_t itStart , size_t itEnd , Vec3 & minCorner , Vec3 & maxCorner )
+{
+    ASSERT( itEnd <= particles.Size() ) ;
+    if( itStart >= itEnd )
+    {
+        return ;
+    }
+
+    const Particle * pParticles = & particles[ 0 ] ;
+#if PCL_OP_FIND_BOUNDING_BOX_USE_SSE
+    __m128 vMin = _mm_setr_ps( minCorner.x , minCorner.y , minCorner.z , 0.0f ) ;
+    __m128 vMax = _mm_setr_ps( maxCorner.x , maxCorner.y , maxCorner.z , 0.0f ) ;
+    for( size_t iPcl = itStart ; iPcl < itEnd ; ++ iPcl )
+    {   // For each particle in this slice...
+        ASSERT( ! IsInf( pParticles[ iPcl ].mPosition ) ) ;
+        const __m128 vPoint = _mm_loadu_ps( & pParticles[ iPcl ].mPosition.x ) ;
+        vMin = _mm_min_ps( vMin , vPoint ) ;
+        vMax = _mm_max_ps( vMax , vPoint ) ;
+    }
+    float corner[ 4 ] ;
+    _mm_storeu_ps( corner , vMin ) ;
+    minCorner = Vec3( corner[ 0 ] , corner[ 1 ] , corner[ 2 ] ) ;
+    _mm_storeu_ps( corner , vMax ) ;
+    maxCorner = Vec3( corner[ 0 ] , corner[ 1 ] , corner[ 2 ] ) ;
+#else
+    Vec3 vMinCorner( minCorner ) ;
+    Vec3 vMaxCorner( maxCorner ) ;
+    for( size_t iPcl = itStart ; iPcl < itEnd ; ++ iPcl )
+    {   // For each particle in this slice...
+        const Vec3 & vPoint = pParticles[ iPcl ].mPosition ;
+        ASSERT( ! IsInf( vPoint ) ) ;
+        // Update corners of axis-aligned bounding box.
+        vMinCorner.x = Min2( vMinCorner.x , vPoint.x ) ;
+        vMinCorner.y = Min2( vMinCorner.y , vPoint.y ) ;
+        vMinCorner.z = Min2( vMinCorner.z , vPoint.z ) ;
+        vMaxCorner.x = Max2( vMaxCorner.x , vPoint.x ) ;
+        vMaxCorner.y = Max2( vMaxCorner.y , vPoint.y ) ;
+        vMaxCorner.z = Max2( vMaxCorner.z , vPoint.z ) ;
+    }
+    minCorner = vMinCorner ;
+    maxCorner = vMaxCorner ;
+#endif
+}
+
+
+
+
+/** Update axis-aligned bounding box to include another box.
+*/
+static void UnionBoundingBox( Vec3 & minCorner , Vec3 & maxCorner , const Vec3 & otherMinCorner , const Vec3 & otherMaxCorner )
+{
+    minCorner.x = Min2( minCorner.x , otherMinCorner.x ) ;
+    minCorner.y = Min2( minCorner.y , otherMinCorner.y ) ;
+    minCorner.z = Min2( minCorner.z , otherMinCorner.z ) ;
+    maxCorner.x = Max2( maxCorner.x , otherMaxCorner.x ) ;
+    maxCorner.y = Max2( maxCorner.y , otherMaxCorner.y ) ;
+    maxCorner.z = Max2( maxCorner.z , otherMaxCorner.z ) ;
+}
+
 
 
 
@@ -56,46 +152,27 @@ static const float  sOneMinusEpsilon        = 1.0f - FLT_EPSILON ;
             {   // Find bounding box for subset of particles
                 SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
                 SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                const Particle * pParticles = & mParticles[0] ;
-                for( size_t iPcl = r.begin() ; iPcl < r.end() ; ++ iPcl )
-                {   // For each particle in this array...
-                    const Particle & rPcl = pParticles[ iPcl ] ;
-                    // Find corners of axis-aligned bounding box.
-                    UpdateBoundingBox( rPcl.mPosition ) ;
-                }
+                FindBoundingBoxSlice( mParticles , r.begin() , r.end() , mMin , mMax ) ;
             }
 
             void join( const Particles_FindBoundingBox_TBB & other )
             {   // Reduce the results of 2 threads
                 SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
                 SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                UpdateBoundingBox( other.mMin ) ;
-                UpdateBoundingBox( other.mMax ) ;
+                UnionBoundingBox( mMin , mMax , other.mMin , other.mMax ) ;
             }
 
             Vec3                mMin        ; ///< Bounding box minimum corner for vortons visited by this thread
             Vec3                mMax        ; ///< Bounding box maximum corner for vortons visited by this thread
 
         private:
-            void UpdateBoundingBox( const Vec3 & vPoint )
-            {
-                mMin.x = Min2( mMin.x , vPoint.x ) ; // Note: TODO: Perhaps SSE/VMX have a SIMD/vector form of this operation.
-                mMin.y = Min2( mMin.y , vPoint.y ) ;
-                mMin.z = Min2( mMin.z , vPoint.z ) ;
-                mMax.x = Max2( mMax.x , vPoint.x ) ;
-                mMax.y = Max2( mMax.y , vPoint.y ) ;
-                mMax.z = Max2( mMax.z , vPoint.z ) ;
-            }
-
             const VECTOR< Particle > & mParticles     ; ///< Array of particles
             WORD        mMasterThreadFloatingPointControlWord   ;
             unsigned    mMasterThreadMmxControlStatusRegister   ;
     } ;
 #endif
 
-
-
-
+// Public functions --------------------------------------------------------------
 
 /** Find axis-aligned bounding box for a subset of all particles in this simulation.
 */
@@ -116,23 +193,7 @@ void PclOpFindBoundingBox::FindBoundingBox( const VECTOR< Particle > & particles
     }
     #else   // Serial version.
     {
-        Vec3 vMinCorner( minCorner ) ;
-        Vec3 vMaxCorner( maxCorner ) ;
-        for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
-        {   // For each particle in the given array...
-            const Particle & rPcl   = particles[ iPcl ] ;
-            const Vec3     & vPoint = rPcl.mPosition ;
-            ASSERT( ! IsInf( rPcl.mPosition ) ) ;
-            // Update corners of axis-aligned bounding box.
-            vMinCorner.x = Min2( vMinCorner.x , vPoint.x ) ; // Note: TODO: Perhaps SSE/VMX have a SIMD/vector form of this operation.
-            vMinCorner.y = Min2( vMinCorner.y , vPoint.y ) ;
-            vMinCorner.z = Min2( vMinCorner.z , vPoint.z ) ;
-            vMaxCorner.x = Max2( vMaxCorner.x , vPoint.x ) ;
-            vMaxCorner.y = Max2( vMaxCorner.y , vPoint.y ) ;
-            vMaxCorner.z = Max2( vMaxCorner.z , vPoint.z ) ;
-        }
-        minCorner = vMinCorner ;
-        maxCorner = vMaxCorner ;
+        FindBoundingBoxSlice( particles , 0 , numParticles , minCorner , maxCorner ) ;
     }
     #endif
 }
@@ -140,9 +201,89 @@ void PclOpFindBoundingBox::FindBoundingBox( const VECTOR< Particle > & particles
 
 
 
-void PclOpFindBoundingBox::Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ )
+/** Find bounding box of all particles, and of each chunk of particles.
+
+    This runs the same per-chunk code a fused pass would, so chunk bounds are
+    available whether or not this operation fuses with its neighbors.
+*/
+void PclOpFindBoundingBox::Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame )
+{
+    PERF_BLOCK( PclOpFindBoundingBox__Operate ) ;
+
+    BeginFusedPass( particles , timeStep , uFrame ) ;
+
+    const size_t numChunks = mChunkBounds.mMinCorners.Size() ;
+    Parallel::For( 0 , numChunks , 1 , Parallel::Method( this , & PclOpFindBoundingBox::OperateOnChunks , particles ) ) ;
+
+    EndFusedPass() ;
+}
+
+
+
+
+/** Prepare to find the bounding box during a fused pass, one chunk of particles at a time.
+
+    Each chunk records its own bounding box, so chunks need no synchronization,
+    and EndFusedPass combines them in a fixed order.
+*/
+void PclOpFindBoundingBox::BeginFusedPass( const VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ )
+{
+    const size_t numChunks = ParticleChunkBounds::NumChunks( particles.Size() ) ;
+    mChunkBounds.mMinCorners.Resize( numChunks ) ;
+    mChunkBounds.mMaxCorners.Resize( numChunks ) ;
+    mChunkBounds.mMaxSizes.Resize( numChunks ) ;
+    mChunkBounds.mNumParticles = particles.Size() ;
+}
+
+
+
+
+void PclOpFindBoundingBox::OperateOnRange( VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    ASSERT( 0 == iPclBegin % PARTICLE_OPERATION_FUSED_CHUNK_SIZE ) ;
+    const size_t    iChunk          = iPclBegin / PARTICLE_OPERATION_FUSED_CHUNK_SIZE ;
+    Vec3 &          rChunkMinCorner = mChunkBounds.mMinCorners[ iChunk ] ;
+    Vec3 &          rChunkMaxCorner = mChunkBounds.mMaxCorners[ iChunk ] ;
+    rChunkMinCorner = Vec3( FLT_MAX , FLT_MAX , FLT_MAX ) ;
+    rChunkMaxCorner = - rChunkMinCorner ;
+    FindBoundingBoxSlice( particles , iPclBegin , iPclEnd , rChunkMinCorner , rChunkMaxCorner ) ;
+
+    // Chunk positions are still in cache, so finding the largest size costs little.
+    float maxSize = 0.0f ;
+    for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+    {   // For each particle in this chunk...
+        maxSize = Max2( maxSize , particles[ iPcl ].mSize ) ;
+    }
+    mChunkBounds.mMaxSizes[ iChunk ] = maxSize ;
+}
+
+
+
+
+/** Find bounding boxes of a range of chunks of particles, as a fused pass would.
+*/
+void PclOpFindBoundingBox::OperateOnChunks( VECTOR< Particle > & particles , size_t iChunkBegin , size_t iChunkEnd )
+{
+    const size_t numParticles = particles.Size() ;
+    for( size_t iChunk = iChunkBegin ; iChunk < iChunkEnd ; ++ iChunk )
+    {   // For each chunk in this range...
+        const size_t iPclBegin = iChunk * PARTICLE_OPERATION_FUSED_CHUNK_SIZE ;
+        OperateOnRange( particles , 0.0f , 0 , iPclBegin , Min2( iPclBegin + PARTICLE_OPERATION_FUSED_CHUNK_SIZE , numParticles ) ) ;
+    }
+}
+
+
+
+
+/** Combine bounding boxes that each chunk found during a fused pass.
+*/
+void PclOpFindBoundingBox::EndFusedPass()
 {
     mMinCorner = Vec3 ( FLT_MAX , FLT_MAX , FLT_MAX );
     mMaxCorner = - mMinCorner ;
-    FindBoundingBox( particles , mMinCorner , mMaxCorner ) ;
+    const size_t numChunks = mChunkBounds.mMinCorners.Size() ;
+    for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+    {   // For each chunk...
+        UnionBoundingBox( mMinCorner , mMaxCorner , mChunkBounds.mMinCorners[ iChunk ] , mChunkBounds.mMaxCorners[ iChunk ] ) ;
+    }
 }
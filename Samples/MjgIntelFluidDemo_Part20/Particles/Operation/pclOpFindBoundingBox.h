@@ -12,6 +12,13 @@
 #include "particleOperation.h"
 
 /** Operation to find the bounding box of a dynamic array of particles.
+
+    When this directly follows other fusable operations, such as PclOpEvolve,
+    ParticleGroup finds the bounding box in the same pass over particles that
+    moves them.
+
+    Either way, this also finds the bounding box of each chunk of particles,
+    which renderers use to cull chunks outside the view.
 */
 class PclOpFindBoundingBox : public IParticleOperation
 {
@@ -25,17 +32,29 @@ class PclOpFindBoundingBox : public IParticleOperation
 
         void Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ ) ;
 
+        bool IsFusable() const { return true ; }
+        void BeginFusedPass( const VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        void EndFusedPass() ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBit( PARTICLE_ATTRIBUTE_SIZE ) ; }
+
         /// Return the minimal corner of axis-aligned bounding box that contains all particles.
         const Vec3 & GetMinCorner( void ) const { return mMinCorner ; }
 
         /// Return the maximal corner of axis-aligned bounding box that contains all particles.
         const Vec3 & GetMaxCorner( void ) const { return mMaxCorner ; }
 
+        /// Return bounding boxes of chunks of particles, as of when this operation last ran.
+        const ParticleChunkBounds * GetChunkBounds() const { return & mChunkBounds ; }
+
         static void FindBoundingBox( const VECTOR< Particle > & particles , Vec3 & minCorner , Vec3 & maxCorner ) ;
 
     private:
-        Vec3    mMinCorner ;    ///< Minimal corner of axis-aligned bounding box containing all particles.
-        Vec3    mMaxCorner ;    ///< Maximal corner of axis-aligned bounding box containing all particles.
+        void OperateOnChunks( VECTOR< Particle > & particles , size_t iChunkBegin , size_t iChunkEnd ) ;
+
+        Vec3                mMinCorner      ;   ///< Minimal corner of axis-aligned bounding box containing all particles.
+        Vec3                mMaxCorner      ;   ///< Maximal corner of axis-aligned bounding box containing all particles.
+        ParticleChunkBounds mChunkBounds    ;   ///< Bounding box of each chunk of particles.
 } ;
 
 #endif
\ No newline at end of file
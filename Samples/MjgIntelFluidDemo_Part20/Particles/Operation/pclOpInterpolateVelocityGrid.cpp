@@ -0,0 +1,85 @@
+/** \file pclOpInterpolateVelocityGrid.cpp
+
+    \brief Operation to interpolate, in time, between two velocity grids.
+
+    \see http://www.mijagourlay.com/
+
+    \author Written and copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Particles/Operation/pclOpInterpolateVelocityGrid.h"
+
+#include "Particles/particleGroup.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+
+
+
+/** Blend a subset of gridpoints of two velocity grids.
+
+    \param result       (output) Grid into which to write blended values.  Must have the same shape as the inputs.
+
+    \param earlier      Grid of velocity values at earlier time.
+
+    \param later        Grid of velocity values at later time.
+
+    \param fraction     Weight of later grid.  Earlier grid gets 1 minus this.
+
+    \param itStart      Offset of first gridpoint to blend.
+
+    \param itEnd        One past offset of last gridpoint to blend.
+*/
+static void InterpolateVelocityGrid_Slice( UniformGrid< Vec3 > & result , const UniformGrid< Vec3 > & earlier , const UniformGrid< Vec3 > & later , float fraction , size_t itStart , size_t itEnd )
+{
+    ASSERT( itEnd <= result.Size() ) ;
+
+    const Vec3 *    pEarlier    = earlier.Data() ;
+    const Vec3 *    pLater      = later.Data() ;
+    Vec3 *          pResult     = result.Data() ;
+    for( size_t offset = itStart ; offset < itEnd ; ++ offset )
+    {   // For each gridpoint in this slice...
+        pResult[ offset ] = pEarlier[ offset ] + fraction * ( pLater[ offset ] - pEarlier[ offset ] ) ;
+    }
+}
+
+
+
+
+/** Interpolate velocity grid to the current frame.
+
+    When the earlier grid does not exist yet, or has a different shape than
+    the later grid (e.g. because the domain grew), this uses the later grid
+    as-is, which is what consumers would have read without interpolation.
+*/
+void PclOpInterpolateVelocityGrid::Operate( VECTOR< Particle > & /* particles */ , float /* timeStep */ , unsigned /* uFrame */ )
+{
+    PERF_BLOCK( PclOpInterpolateVelocityGrid__Operate ) ;
+
+    ASSERT( mLaterGrid != NULLPTR ) ;
+    ASSERT( mSourceGroup != NULLPTR ) ;
+
+    const float fraction = mSourceGroup->GetUpdatePeriodFraction() ;
+    const bool  canBlend =      ( fraction < 1.0f )
+                            &&  mEarlierGrid && ! mEarlierGrid->HasZeroExtent()
+                            &&  mEarlierGrid->ShapeMatches( * mLaterGrid )
+                            &&  ( mEarlierGrid->Size() == mLaterGrid->Size() ) ;
+    if( ! canBlend )
+    {   // Later grid is current, or only grid available.
+        // Once the grid size settles, copying reuses storage, so this costs one pass over the grid.
+        mInterpolatedGrid = * mLaterGrid ;
+        return ;
+    }
+
+    if( ! mInterpolatedGrid.ShapeMatches( * mLaterGrid ) || ( mInterpolatedGrid.Size() != mLaterGrid->Size() ) )
+    {   // Result has a different shape than inputs, so reshape it.  Blending overwrites every gridpoint, so contents do not matter.
+        mInterpolatedGrid.CopyShape( * mLaterGrid ) ;
+        mInterpolatedGrid.Init() ;
+    }
+    const size_t numPoints = mInterpolatedGrid.Size() ;
+
+    // Blend grids using multiple threads.
+    Parallel::For( 0 , numPoints , Parallel::GetGrainSize( numPoints ) , Parallel::Function( InterpolateVelocityGrid_Slice , mInterpolatedGrid , * mEarlierGrid , * mLaterGrid , fraction ) ) ;
+}
@@ -0,0 +1,66 @@
+/** \file pclOpInterpolateVelocityGrid.h
+
+    \brief Operation to interpolate, in time, between two velocity grids.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_OPERATION_INTERPOLATE_VELOCITY_GRID_H
+#define PARTICLE_OPERATION_INTERPOLATE_VELOCITY_GRID_H
+
+#include "particleOperation.h"
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+class ParticleGroup ;
+
+/** Operation to interpolate, in time, between two velocity grids that another particle group produces.
+
+    This lets a cheap group (e.g. tracers) update every frame while the
+    group that computes velocity (e.g. vortons) updates less often.  Each
+    frame, this blends the earlier and later grids according to how much
+    of mSourceGroup's update period has elapsed, and stores the result in
+    GetInterpolatedGrid, which other operations in this group read instead
+    of the later grid.
+
+    This must run in a group that updates before mSourceGroup in each
+    frame, so the later grid is the most recent result of mSourceGroup,
+    and the earlier grid is the one before that.  The fraction therefore
+    reaches 1 on frames when mSourceGroup updates, and then the result
+    equals the later grid.
+
+    This does not touch particles.  It costs one pass over the grid per
+    frame, which replaces, for every frame but one in each period, the much
+    larger cost of updating mSourceGroup.
+
+    \see ParticleGroup::SetUpdatePeriod, ParticleGroup::GetUpdatePeriodFraction
+*/
+class PclOpInterpolateVelocityGrid : public IParticleOperation
+{
+    public:
+        PclOpInterpolateVelocityGrid()
+            : mEarlierGrid( NULLPTR )
+            , mLaterGrid( NULLPTR )
+            , mSourceGroup( NULLPTR )
+        {}
+
+        VIRTUAL_CONSTRUCTORS( PclOpInterpolateVelocityGrid ) ;
+
+        void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+
+        /// This only reads grids, not particles.
+        ParticleAttributeMask GetAttributesUsed() const { return PARTICLE_ATTRIBUTE_MASK_NONE ; }
+
+        /// Return grid of velocity interpolated to the current frame.
+        const UniformGrid< Vec3 > & GetInterpolatedGrid() const { return mInterpolatedGrid ; }
+
+        const UniformGrid< Vec3 > * mEarlierGrid    ;   ///< Velocity grid as of earlier update of mSourceGroup.
+        const UniformGrid< Vec3 > * mLaterGrid      ;   ///< Velocity grid as of most recent update of mSourceGroup.
+        const ParticleGroup *       mSourceGroup    ;   ///< Group whose updates produce both grids, and whose update period determines interpolation fraction.
+
+    private:
+        UniformGrid< Vec3 >         mInterpolatedGrid   ;   ///< Velocity interpolated to current frame.
+} ;
+
+#endif
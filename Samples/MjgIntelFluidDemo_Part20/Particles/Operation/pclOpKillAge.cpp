@@ -14,34 +14,40 @@
 #include "Core/SpatialPartition/uniformGridMath.h"
 
 #include "Particles/particle.h"
+#include "Particles/particleLifecycle.h"
 
 #include "Particles/Operation/pclOpKillAge.h"
 
 
 
 
-void PclOpKillAge::Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned uFrame )
+/** Predicate for Particles::KillIf that kills particles older than a given age.
+*/
+class IsOlderThan
 {
-    PERF_BLOCK( PclOpKillAge__Operate ) ;
+    public:
+        IsOlderThan( unsigned uFrame , int ageMax )
+            : mFrame( uFrame )
+            , mAgeMax( ageMax )
+        {}
 
-	if( particles.Empty() )
-	{
-		return ;
-	}
-    const Particle * pPcls = & particles.operator[]( 0 ) ; // Modern STL supports vector.data() but not older versions like MSVS7.
-    for( size_t iPcl = 0 ;
-        iPcl < particles.Size() ; // Note: Size cannot be cached because loop body changes size.
-        /* DO NOT ++ iPcl */ )      // Note: conditional increment below.
-    {   // For each particle in the given array...
-        const Particle & rPcl = pPcls[ iPcl ] ;
-        const int age = uFrame - rPcl.mBirthTime ;
-        if( age > mAgeMax )
+        bool operator()( const Particle & rPcl ) const
         {
-            Particles::Kill( particles , iPcl ) ;
+            const int age = mFrame - rPcl.mBirthTime ;
+            return age > mAgeMax ;
         }
-        else
-        {
-            ++ iPcl ;
-        }
-    }
+
+    private:
+        unsigned    mFrame  ;   ///< Current frame.
+        int         mAgeMax ;   ///< Maximum age of particles to spare.
+} ;
+
+
+
+
+void PclOpKillAge::Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned uFrame )
+{
+    PERF_BLOCK( PclOpKillAge__Operate ) ;
+
+    Particles::KillIf( particles , IsOlderThan( uFrame , mAgeMax ) , mCompactionScratch ) ;
 }
@@ -11,6 +11,8 @@
 
 #include "particleOperation.h"
 
+#include "Particles/particleLifecycle.h"
+
 /** Operation to kill particles based on their age.
 */
 class PclOpKillAge : public IParticleOperation
@@ -24,7 +26,13 @@ class PclOpKillAge : public IParticleOperation
 
         void Operate( VECTOR< Particle > & particles , float /* timeStep */ , unsigned uFrame ) ;
 
-        int mAgeMax                 ;   ///< Maximum age of particles
+        /// Killing only reads birth time, which is not an enumerated attribute.
+        ParticleAttributeMask GetAttributesUsed() const { return PARTICLE_ATTRIBUTE_MASK_NONE ; }
+
+        int                             mAgeMax             ;   ///< Maximum age of particles
+
+    private:
+        Particles::CompactionScratch    mCompactionScratch  ;   ///< Storage reused across calls to Operate, to avoid allocating each frame.
 } ;
 
 #endif
\ No newline at end of file
@@ -25,6 +25,7 @@ class PclOpPopulateVelocityGrid : public IParticleOperation
         VIRTUAL_CONSTRUCTORS( PclOpPopulateVelocityGrid ) ;
 
         void Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ ) ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY ) ; }
 
         UniformGrid< Vec3 > *   mVelocityGrid       ;   ///< Grid of velocity values
         Vec3 *                  mBoundingBox        ;   ///< Bounding box.
@@ -0,0 +1,139 @@
+/** \file pclOpSortMorton.cpp
+
+    \brief Operation to sort particles along a Morton (Z-order) curve, to improve memory locality.
+
+    \see http://www.mijagourlay.com/
+
+    \author Written and copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/Math/morton.h"
+
+#include "Core/SpatialPartition/cellList.h"
+
+#include "Particles/particle.h"
+
+#include "Particles/Operation/pclOpFindBoundingBox.h"
+
+#include "Particles/Operation/pclOpSortMorton.h"
+
+
+static const float sMortonMaxCoord = float( MORTON_MAX_COORD ) ;   ///< Largest quantized coordinate.
+
+
+
+
+/** Return Morton code of the given position, relative to the given bounding box.
+
+    \param vPosition - Position whose code to compute.
+
+    \param vMin - Minimal corner of bounding box containing all positions.
+
+    \param vScale - Number of quantization steps per unit length, along each axis.
+*/
+static inline unsigned MortonCode( const Vec3 & vPosition , const Vec3 & vMin , const Vec3 & vScale )
+{
+    const unsigned ix = unsigned( Clamp( ( vPosition.x - vMin.x ) * vScale.x , 0.0f , sMortonMaxCoord ) ) ;
+    const unsigned iy = unsigned( Clamp( ( vPosition.y - vMin.y ) * vScale.y , 0.0f , sMortonMaxCoord ) ) ;
+    const unsigned iz = unsigned( Clamp( ( vPosition.z - vMin.z ) * vScale.z , 0.0f , sMortonMaxCoord ) ) ;
+    return MortonEncode( ix , iy , iz ) ;
+}
+
+
+
+
+/** Compute new index of each particle, ordering them along a Morton curve through their bounding box.
+
+    This runs in O(N log N) time and uses O(N) scratch space, which persists
+    across calls to avoid reallocating.
+*/
+void PclOpSortMorton::OrderAlongMortonCurve( const VECTOR< Particle > & particles )
+{
+    const size_t numParticles = particles.Size() ;
+
+    Vec3 vMin(   FLT_MAX ,   FLT_MAX ,   FLT_MAX ) ;
+    Vec3 vMax( - FLT_MAX , - FLT_MAX , - FLT_MAX ) ;
+    PclOpFindBoundingBox::FindBoundingBox( particles , vMin , vMax ) ;
+    const Vec3 vExtent = vMax - vMin ;
+    // Avoid dividing by zero when all particles share a coordinate.
+    const Vec3 vScale( sMortonMaxCoord / Max2( vExtent.x , FLT_MIN ) , sMortonMaxCoord / Max2( vExtent.y , FLT_MIN ) , sMortonMaxCoord / Max2( vExtent.z , FLT_MIN ) ) ;
+
+    mKeys.Resize( numParticles ) ;
+    for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+    {   // For each particle...
+        mKeys[ iPcl ].mCode  = MortonCode( particles[ iPcl ].mPosition , vMin , vScale ) ;
+        mKeys[ iPcl ].mIndex = unsigned( iPcl ) ;
+    }
+
+    // Stable sort keeps particles sharing a code in their existing order, so repeated sorts leave settled particles in place.
+    std::stable_sort( mKeys.Begin() , mKeys.End() ) ;
+
+    for( size_t iNew = 0 ; iNew < numParticles ; ++ iNew )
+    {   // For each particle, in sorted order...
+        mNewIndexOfOld[ mKeys[ iNew ].mIndex ] = unsigned( iNew ) ;
+    }
+}
+
+
+
+
+/** Reorder the given particles to improve memory locality.
+
+    When mSortByCell is set and mCellList partitions exactly these particles,
+    this orders particles like their indices in mCellList, so afterwards each
+    index equals its slot there.  That costs O(N), needs no sort, and lets
+    CellList encode indices in 16 bits, relative to their cell; see
+    CellList::IsCompact.  Otherwise this orders particles along a Morton curve.
+*/
+void PclOpSortMorton::Sort( VECTOR< Particle > & particles )
+{
+    PERF_BLOCK( PclOpSortMorton__Sort ) ;
+
+    const size_t numParticles = particles.Size() ;
+
+    mNewIndexOfOld.Resize( numParticles ) ;
+    if( mSortByCell && mCellList && ( mCellList->GetNumItems() == numParticles ) )
+    {   // Spatial partition describes these particles, so adopt its order.
+        for( size_t iOld = 0 ; iOld < numParticles ; ++ iOld )
+        {   // For each particle...
+            mNewIndexOfOld[ iOld ] = mCellList->GetSlotOfItem( iOld ) ;
+        }
+    }
+    else
+    {
+        OrderAlongMortonCurve( particles ) ;
+    }
+
+    mSorted.Resize( numParticles ) ;
+    for( size_t iOld = 0 ; iOld < numParticles ; ++ iOld )
+    {   // For each particle, in old order...
+        mSorted[ mNewIndexOfOld[ iOld ] ] = particles[ iOld ] ;
+    }
+    std::swap( particles , mSorted ) ;
+
+    if( mCellList )
+    {   // Caller requested remapping a spatial partition of particle indices.
+        mCellList->Permute( mNewIndexOfOld ) ;
+    }
+}
+
+
+
+
+void PclOpSortMorton::Operate( VECTOR< Particle > & particles , float /* timeStep */ , unsigned uFrame )
+{
+    PERF_BLOCK( PclOpSortMorton__Operate ) ;
+
+    if( ( 0 == mSortPeriod ) || ( uFrame % mSortPeriod != 0 ) || ( particles.Size() < 2 ) )
+    {   // Sorting disabled, not due this frame or trivial.
+        return ;
+    }
+
+    Sort( particles ) ;
+}
@@ -0,0 +1,69 @@
+/** \file pclOpSortMorton.h
+
+    \brief Operation to sort particles along a Morton (Z-order) curve, to improve memory locality.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_OPERATION_SORT_MORTON_H
+#define PARTICLE_OPERATION_SORT_MORTON_H
+
+#include "particleOperation.h"
+
+class CellList ;
+
+/** Operation to sort particles along a Morton (Z-order) curve, to improve memory locality.
+
+    Routines that visit particles by spatial neighborhood (spatial partitions,
+    grid population, particle-particle interactions) access memory more
+    coherently when particles near each other in space also reside near each
+    other in memory.  Emission and killing scramble that order over time, so
+    this operation periodically restores it.
+
+    Sorting changes particle indices, so any persistent data referring to
+    particles by index must be remapped.  mCellList provides that for a
+    spatial partition of particle indices.
+
+    Alternatively, mSortByCell orders particles by cell of that partition,
+    which lets it store indices relative to their cell, in 16 bits.
+*/
+class PclOpSortMorton : public IParticleOperation
+{
+    public:
+        PclOpSortMorton()
+            : mSortPeriod( 0 )
+            , mCellList( NULLPTR )
+            , mSortByCell( false )
+        {}
+
+        VIRTUAL_CONSTRUCTORS( PclOpSortMorton ) ;
+
+        void Operate( VECTOR< Particle > & particles , float /* timeStep */ , unsigned uFrame ) ;
+
+        /// Sorting moves whole particles, but only reads their positions.
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) ; }
+
+        unsigned    mSortPeriod ;   ///< Number of frames between sorts.  Zero disables sorting.
+        CellList *  mCellList   ;   ///< Optional spatial partition of indices into particles, remapped after each sort.  May be NULL.
+        bool        mSortByCell ;   ///< Whether to order particles like their indices in mCellList, when that partitions exactly these particles, instead of along a Morton curve.
+
+    private:
+        /// Morton code of a particle, and the index of that particle.
+        struct MortonKey
+        {
+            unsigned    mCode   ;   ///< Morton code of particle position.
+            unsigned    mIndex  ;   ///< Index of particle, prior to sorting.
+
+            bool operator<( const MortonKey & that ) const { return mCode < that.mCode ; }
+        } ;
+
+        void OrderAlongMortonCurve( const VECTOR< Particle > & particles ) ;
+        void Sort( VECTOR< Particle > & particles ) ;
+
+        VECTOR< MortonKey > mKeys           ;   ///< Morton code and index of each particle.  Scratch space reused across sorts.
+        VECTOR< Particle >  mSorted         ;   ///< Particles in sorted order.  Scratch space reused across sorts.
+        VECTOR< unsigned >  mNewIndexOfOld  ;   ///< New index of each particle, indexed by its old index.  Scratch space reused across sorts.
+} ;
+
+#endif
@@ -0,0 +1,324 @@
+/** \file pclOpSubgridTurbulence.cpp
+
+    \brief Operation to add procedural subgrid turbulence to particle velocity.
+
+    \see http://www.mijagourlay.com/
+
+    \author Written and copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Particles/Operation/pclOpSubgridTurbulence.h"
+
+#include "Particles/particle.h"
+
+#include "Core/SpatialPartition/uniformGridMath.h"
+
+#include "Core/Math/vec3x4.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Private variables --------------------------------------------------------------
+
+static const unsigned   sNoiseLog2Size      = 5 ;                           ///< Base-2 logarithm of number of noise texture cells along each axis.
+static const unsigned   sNoiseSize          = 1 << sNoiseLog2Size ;         ///< Number of noise texture cells along each axis.  Power of 2, so lookups wrap with a mask.
+static const unsigned   sNoiseMask          = sNoiseSize - 1 ;              ///< Mask that wraps noise texture indices.
+static const unsigned   sNoiseNumSmoothings = 2 ;                           ///< Number of smoothing passes applied to random potential, to remove features smaller than a few noise cells.
+
+// Private functions --------------------------------------------------------------
+
+/** Return index into noise texture of the given cell, wrapping indices so the texture tiles.
+*/
+static inline size_t NoiseOffset( unsigned ix , unsigned iy , unsigned iz )
+{
+    return ( ix & sNoiseMask ) + ( ( ( iy & sNoiseMask ) + ( ( iz & sNoiseMask ) << sNoiseLog2Size ) ) << sNoiseLog2Size ) ;
+}
+
+
+
+
+/** Return a pseudo-random value in [-1,1] determined by the given integer.
+
+    This hashes its input, rather than calling rand, so the noise texture
+    does not depend on, or disturb, the sequence other code draws from rand.
+*/
+static float HashToSignedUnit( unsigned value )
+{
+    value ^= value >> 16 ;
+    value *= 0x7feb352dU ;
+    value ^= value >> 15 ;
+    value *= 0x846ca68bU ;
+    value ^= value >> 16 ;
+    return float( double( value ) / 4294967295.0 * 2.0 - 1.0 ) ;
+}
+
+
+
+
+/** Compute tiling, divergence-free noise texture.
+
+    \param noise    (output) sNoiseSize^3 velocity values, with unit root-mean-square magnitude.
+
+    This assigns a random vector potential to each cell, smooths it with a
+    periodic [1 2 1]/4 filter along each axis, then takes its curl with
+    periodic central differences.  Central-difference divergence of a
+    central-difference curl vanishes exactly, and smoothing limits features
+    to a few noise cells, so trilinear interpolation of the result stays
+    nearly divergence-free.
+*/
+static void ComputeCurlNoise( VECTOR< Vec3 > & noise )
+{
+    PERF_BLOCK( ComputeCurlNoise ) ;
+
+    const size_t    numCells    = size_t( sNoiseSize ) * sNoiseSize * sNoiseSize ;
+    VECTOR< Vec3 >  potential( numCells ) ;
+    VECTOR< Vec3 >  smoothed( numCells ) ;
+    for( size_t offset = 0 ; offset < numCells ; ++ offset )
+    {   // For each noise cell, assign random potential.
+        const unsigned seed = unsigned( offset ) * 3 ;
+        potential[ offset ] = Vec3( HashToSignedUnit( seed ) , HashToSignedUnit( seed + 1 ) , HashToSignedUnit( seed + 2 ) ) ;
+    }
+
+    for( unsigned iPass = 0 ; iPass < sNoiseNumSmoothings ; ++ iPass )
+    {   // For each smoothing pass...
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {   // For each axis, smooth potential along that axis.
+            const unsigned step[ 3 ] = { axis == 0 , axis == 1 , axis == 2 } ;
+            for( unsigned iz = 0 ; iz < sNoiseSize ; ++ iz )
+            for( unsigned iy = 0 ; iy < sNoiseSize ; ++ iy )
+            for( unsigned ix = 0 ; ix < sNoiseSize ; ++ ix )
+            {   // For each noise cell...
+                const Vec3 & prev = potential[ NoiseOffset( ix - step[ 0 ] , iy - step[ 1 ] , iz - step[ 2 ] ) ] ;
+                const Vec3 & here = potential[ NoiseOffset( ix , iy , iz ) ] ;
+                const Vec3 & next = potential[ NoiseOffset( ix + step[ 0 ] , iy + step[ 1 ] , iz + step[ 2 ] ) ] ;
+                smoothed[ NoiseOffset( ix , iy , iz ) ] = 0.25f * ( prev + next ) + 0.5f * here ;
+            }
+            potential.swap( smoothed ) ;
+        }
+    }
+
+    noise.Resize( numCells ) ;
+    double sumMag2 = 0.0 ;
+    for( unsigned iz = 0 ; iz < sNoiseSize ; ++ iz )
+    for( unsigned iy = 0 ; iy < sNoiseSize ; ++ iy )
+    for( unsigned ix = 0 ; ix < sNoiseSize ; ++ ix )
+    {   // For each noise cell, compute curl of potential.
+        const Vec3 & px0 = potential[ NoiseOffset( ix - 1 , iy , iz ) ] ;
+        const Vec3 & px1 = potential[ NoiseOffset( ix + 1 , iy , iz ) ] ;
+        const Vec3 & py0 = potential[ NoiseOffset( ix , iy - 1 , iz ) ] ;
+        const Vec3 & py1 = potential[ NoiseOffset( ix , iy + 1 , iz ) ] ;
+        const Vec3 & pz0 = potential[ NoiseOffset( ix , iy , iz - 1 ) ] ;
+        const Vec3 & pz1 = potential[ NoiseOffset( ix , iy , iz + 1 ) ] ;
+        Vec3 & rCurl = noise[ NoiseOffset( ix , iy , iz ) ] ;
+        rCurl = 0.5f * Vec3( ( py1.z - py0.z ) - ( pz1.y - pz0.y )
+                           , ( pz1.x - pz0.x ) - ( px1.z - px0.z )
+                           , ( px1.y - px0.y ) - ( py1.x - py0.x ) ) ;
+        sumMag2 += rCurl.Mag2() ;
+    }
+
+    ASSERT( sumMag2 > 0.0 ) ;
+    const float oneOverRms = float( 1.0 / sqrt( sumMag2 / double( numCells ) ) ) ;
+    for( size_t offset = 0 ; offset < numCells ; ++ offset )
+    {   // For each noise cell, normalize so noise has unit root-mean-square magnitude.
+        noise[ offset ] *= oneOverRms ;
+    }
+}
+
+
+
+
+/** Return tiling, divergence-free noise texture, computing it on first call.
+
+    First call must come from one thread.  Operate and BeginFusedPass call this
+    before any parallel work, so slices only read the finished texture.
+*/
+static const Vec3 * GetCurlNoise()
+{
+    static VECTOR< Vec3 > sCurlNoise ;
+    if( sCurlNoise.Empty() )
+    {   // Noise texture does not exist yet.
+        ComputeCurlNoise( sCurlNoise ) ;
+    }
+    return & sCurlNoise[ 0 ] ;
+}
+
+
+
+
+/** Add subgrid turbulence to velocity of a subset of given particles.
+
+    \param particles            Dynamic array of particles whose velocity to update.
+
+    \param vorticityGrid        Uniform grid of vorticity values.
+
+    \param noise                Tiling noise texture, from GetCurlNoise.
+
+    \param noiseCellsPerLength  Number of noise texture cells per unit length.
+
+    \param noiseOffset          Displacement of noise texture, in noise cells.
+
+    \param axisMask             Components by which to multiply added velocity.
+
+    \param velocityPerVorticity Subgrid speed per unit vorticity magnitude, per unit noise.
+
+    \param itStart              Index of first particle to update.
+
+    \param itEnd                One past index of last particle to update.
+
+    This interpolates vorticity for batches of particles with
+    UniformGrid::InterpolateMany, then looks up noise for Float4::WIDTH
+    particles at a time:  Lanes gather their 8 texture corners, then blend
+    them trilinearly, and scale them by vorticity magnitude, together.
+*/
+static void AddSubgridTurbulence_Slice( VECTOR< Particle > & particles , const UniformGrid< Vec3 > & vorticityGrid , const Vec3 * noise , float noiseCellsPerLength , const Vec3 & noiseOffset , const Vec3 & axisMask , float velocityPerVorticity , size_t itStart , size_t itEnd )
+{
+    ASSERT( itEnd <= particles.Size() ) ;
+    ASSERT( ! vorticityGrid.HasZeroExtent() ) ;
+    ASSERT( noise != NULLPTR ) ;
+
+    static const size_t batchSize = 64 ;    // Multiple of Float4::WIDTH.
+    Vec3                positions[ batchSize ] ;
+    Vec3                vorticities[ batchSize ] ;
+    const Float4        velocityPerVorticity4( velocityPerVorticity ) ;
+    const Vec3x4        axisMask4( axisMask ) ;
+
+    for( size_t batchBegin = itStart ; batchBegin < itEnd ; batchBegin += batchSize )
+    {   // For each batch of particles in this slice...
+        const size_t numInBatch     = Min2( batchSize , itEnd - batchBegin ) ;
+        const size_t numInBatch4    = ( numInBatch + Float4::WIDTH - 1 ) & ~ size_t( Float4::WIDTH - 1 ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each particle in batch...
+            positions[ iInBatch ] = particles[ batchBegin + iInBatch ].mPosition ;
+        }
+        vorticityGrid.InterpolateMany( positions , vorticities , numInBatch ) ;
+        for( size_t iInBatch = numInBatch ; iInBatch < numInBatch4 ; ++ iInBatch )
+        {   // For each unused lane in last group, fill with values that look up safely, and whose results get discarded.
+            positions[ iInBatch ]   = positions[ 0 ] ;
+            vorticities[ iInBatch ] = Vec3( 0.0f , 0.0f , 0.0f ) ;
+        }
+
+        for( size_t groupBegin = 0 ; groupBegin < numInBatch4 ; groupBegin += Float4::WIDTH )
+        {   // For each group of Float4::WIDTH particles in batch...
+            Vec3    corners[ 8 ][ Float4::WIDTH ] ;
+            float   tween[ 3 ][ Float4::WIDTH ] ;
+            for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+            {   // For each lane, gather noise texture values at corners of cell containing particle.
+                const Vec3  coords      = positions[ groupBegin + iLane ] * noiseCellsPerLength + noiseOffset ;
+                const Vec3  floors      ( floorf( coords.x ) , floorf( coords.y ) , floorf( coords.z ) ) ;
+                // Cast through int, so negative coordinates wrap like positive ones.
+                const unsigned ix = unsigned( int( floors.x ) ) , iy = unsigned( int( floors.y ) ) , iz = unsigned( int( floors.z ) ) ;
+                tween[ 0 ][ iLane ] = coords.x - floors.x ;
+                tween[ 1 ][ iLane ] = coords.y - floors.y ;
+                tween[ 2 ][ iLane ] = coords.z - floors.z ;
+                for( unsigned iCorner = 0 ; iCorner < 8 ; ++ iCorner )
+                {   // For each corner of cell...
+                    corners[ iCorner ][ iLane ] = noise[ NoiseOffset( ix + ( iCorner & 1 ) , iy + ( ( iCorner >> 1 ) & 1 ) , iz + ( iCorner >> 2 ) ) ] ;
+                }
+            }
+
+            const Float4 tx = Float4::Load( tween[ 0 ] ) ;
+            const Float4 ty = Float4::Load( tween[ 1 ] ) ;
+            const Float4 tz = Float4::Load( tween[ 2 ] ) ;
+            Vec3x4 alongX[ 4 ] ;
+            for( unsigned iEdge = 0 ; iEdge < 4 ; ++ iEdge )
+            {   // For each cell edge along x, interpolate along x.
+                const Vec3x4 lo = Vec3x4::LoadTranspose( corners[ 2 * iEdge     ] ) ;
+                const Vec3x4 hi = Vec3x4::LoadTranspose( corners[ 2 * iEdge + 1 ] ) ;
+                alongX[ iEdge ] = lo + ( hi - lo ) * tx ;
+            }
+            const Vec3x4 alongY0    = alongX[ 0 ] + ( alongX[ 1 ] - alongX[ 0 ] ) * ty ;
+            const Vec3x4 alongY1    = alongX[ 2 ] + ( alongX[ 3 ] - alongX[ 2 ] ) * ty ;
+            const Vec3x4 noiseValue = alongY0 + ( alongY1 - alongY0 ) * tz ;
+
+            const Float4 gain       = Vec3x4::LoadTranspose( & vorticities[ groupBegin ] ).Magnitude() * velocityPerVorticity4 ;
+            const Vec3x4 noiseGain  = noiseValue * gain ;
+            const Vec3x4 turbulence ( noiseGain.x * axisMask4.x , noiseGain.y * axisMask4.y , noiseGain.z * axisMask4.z ) ;
+            Vec3 deltaVelocities[ Float4::WIDTH ] ;
+            turbulence.StoreTranspose( deltaVelocities ) ;
+
+            const size_t numInGroup = Min2( size_t( Float4::WIDTH ) , numInBatch - groupBegin ) ;
+            for( size_t iLane = 0 ; iLane < numInGroup ; ++ iLane )
+            {   // For each particle in group...
+                particles[ batchBegin + groupBegin + iLane ].mVelocity += deltaVelocities[ iLane ] ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Compute vorticity from velocity grid, and noise parameters for this time.
+
+    \param timeStep     Duration of each frame.
+
+    \param uFrame       Frame counter, which, with timeStep, determines how far noise has scrolled.
+*/
+void PclOpSubgridTurbulence::PrepareVorticity( float timeStep , unsigned uFrame )
+{
+    PERF_BLOCK( PclOpSubgridTurbulence__PrepareVorticity ) ;
+
+    ASSERT( IsEnabled() ) ;
+
+    mVorticityGrid.CopyShape( * mVelocityGrid ) ;
+    mVorticityGrid.Init() ;
+    ComputeCurl( mVorticityGrid , * mVelocityGrid ) ;
+
+    const Vec3 &    spacing         = mVelocityGrid->GetCellSpacing() ;
+    const float     gridCellSize    = Max2( spacing.x , Max2( spacing.y , spacing.z ) ) ;
+    const float     noiseCellSize   = gridCellSize / mNoiseCellsPerGridCell ;
+    mNoiseCellsPerLength    = 1.0f / noiseCellSize ;
+    mVelocityPerVorticity   = mAmplitude * noiseCellSize ;
+    mAxisMask               = Vec3( spacing.x > FLT_EPSILON ? 1.0f : 0.0f , spacing.y > FLT_EPSILON ? 1.0f : 0.0f , spacing.z > FLT_EPSILON ? 1.0f : 0.0f ) ;
+
+    // Scroll diagonally, and wrap, so that offset stays small enough to retain precision.
+    const float scroll = fmodf( float( uFrame ) * timeStep * mNoiseEvolutionSpeed , float( sNoiseSize ) ) ;
+    mNoiseOffset = Vec3( scroll , 0.618034f * scroll , 0.381966f * scroll ) ;
+}
+
+
+
+
+void PclOpSubgridTurbulence::Operate( VECTOR< Particle > & particles , float timeStep , unsigned uFrame )
+{
+    if( ! IsEnabled() )
+    {   // Nothing to do.
+        return ;
+    }
+
+    PERF_BLOCK( PclOpSubgridTurbulence__Operate ) ;
+
+    BeginFusedPass( particles , timeStep , uFrame ) ;
+
+    // Add subgrid turbulence using multiple threads.
+    const size_t numParticles = particles.Size() ;
+    Parallel::For( 0 , numParticles , Parallel::GetGrainSize( numParticles ) , Parallel::Method( this , & PclOpSubgridTurbulence::OperateOnRange , particles , timeStep , uFrame ) ) ;
+}
+
+
+
+
+void PclOpSubgridTurbulence::BeginFusedPass( const VECTOR< Particle > & /* particles */ , float timeStep , unsigned uFrame )
+{
+    if( IsEnabled() )
+    {   // Prepare shared data once, before chunks run concurrently.
+        PrepareVorticity( timeStep , uFrame ) ;
+        GetCurlNoise() ;
+    }
+}
+
+
+
+
+void PclOpSubgridTurbulence::OperateOnRange( VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    if( IsEnabled() )
+    {
+        AddSubgridTurbulence_Slice( particles , mVorticityGrid , GetCurlNoise() , mNoiseCellsPerLength , mNoiseOffset , mAxisMask , mVelocityPerVorticity , iPclBegin , iPclEnd ) ;
+    }
+}
@@ -0,0 +1,77 @@
+/** \file pclOpSubgridTurbulence.h
+
+    \brief Operation to add procedural subgrid turbulence to particle velocity.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_OPERATION_SUBGRID_TURBULENCE_H
+#define PARTICLE_OPERATION_SUBGRID_TURBULENCE_H
+
+#include "particleOperation.h"
+
+#include "Core/SpatialPartition/uniformGrid.h"
+
+/** Operation to add procedural subgrid turbulence to particle velocity.
+
+    Operations like PclOpAssignVelocityFromField give particles only the
+    velocity a grid resolves, so fine detail in passive tracers needs many
+    vortons.  This adds divergence-free curl noise, looked up from a
+    precomputed tiling 3D texture, with amplitude proportional to the local
+    vorticity magnitude derived from mVelocityGrid.  Swirling regions thereby
+    gain eddies smaller than a grid cell, and calm regions stay calm.
+
+    The added velocity is mAmplitude times vorticity magnitude times noise
+    feature size times unit-RMS noise, so mAmplitude is dimensionless.
+    Scaling noise by a spatially varying amplitude introduces divergence
+    proportional to the amplitude gradient, which stays small when vorticity
+    varies slowly across a noise cell.
+
+    Place this after the operation that assigns velocity from the grid,
+    and before PclOpEvolve.  Substeps in PclOpEvolve retain the offset
+    this adds, as they do for wind.
+
+    When the velocity grid has no extent along an axis (e.g. a 2D
+    simulation), this adds no velocity along that axis.
+
+    mAmplitude defaults to zero, which disables this operation.
+
+    \see AddSubgridTurbulence_Slice
+*/
+class PclOpSubgridTurbulence : public IParticleOperation
+{
+    public:
+        PclOpSubgridTurbulence()
+            : mVelocityGrid( 0 )
+            , mAmplitude( 0.0f )
+            , mNoiseCellsPerGridCell( 2.0f )
+            , mNoiseEvolutionSpeed( 1.0f )
+        {}
+
+        VIRTUAL_CONSTRUCTORS( PclOpSubgridTurbulence ) ;
+
+        void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+
+        bool IsFusable() const { return true ; }
+        void BeginFusedPass( const VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        ParticleAttributeMask GetAttributesUsed() const { return Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY ) ; }
+
+        const UniformGrid< Vec3  > *    mVelocityGrid           ;   ///< Grid of resolved velocity values, from which to derive vorticity.
+        float                           mAmplitude              ;   ///< Ratio of subgrid speed to vorticity magnitude times noise feature size.  Zero disables this operation.
+        float                           mNoiseCellsPerGridCell  ;   ///< Number of noise texture cells per velocity grid cell.  Larger values make finer eddies.
+        float                           mNoiseEvolutionSpeed    ;   ///< Speed, in noise texture cells per unit time, at which noise scrolls through space, so eddies change over time.
+
+    private:
+        bool IsEnabled() const { return ( mAmplitude != 0.0f ) && mVelocityGrid && ! mVelocityGrid->HasZeroExtent() ; }
+        void PrepareVorticity( float timeStep , unsigned uFrame ) ;
+
+        UniformGrid< Vec3 >             mVorticityGrid          ;   ///< Curl of mVelocityGrid, as of the most recent call to Operate or BeginFusedPass.
+        Vec3                            mNoiseOffset            ;   ///< Displacement of noise texture, in noise cells, as of the most recent call to Operate or BeginFusedPass.
+        Vec3                            mAxisMask               ;   ///< One along axes where mVelocityGrid has extent, zero elsewhere.
+        float                           mNoiseCellsPerLength    ;   ///< Number of noise texture cells per unit length.
+        float                           mVelocityPerVorticity   ;   ///< Subgrid speed per unit vorticity magnitude, per unit noise.
+} ;
+
+#endif
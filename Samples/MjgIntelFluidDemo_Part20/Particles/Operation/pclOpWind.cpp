@@ -4,7 +4,7 @@
 
     \see http://www.mijagourlay.com/
 
-    \author Written and copyright 2009-2014 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+    \author Written and copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
 */
 
 #include "Particles/Operation/pclOpWind.h"
@@ -13,31 +13,163 @@
 
 #include "Core/Performance/perfBlock.h"
 
+#include "Core/parallelExecution.h"
+
+#include <math.h>
 #include <stdlib.h>
 
+// Private functions --------------------------------------------------------------
+
+/** Return given coordinate wrapped into [minimum,minimum+extent).
 
-void PclOpWind::Operate(  VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ )
+    \param extent   Size of range.  When zero, this returns minimum.
+*/
+static inline float WrapIntoRange( float value , float minimum , float extent )
 {
-    PERF_BLOCK( PclOpWind__Operate ) ;
+    if( extent <= 0.0f )
+    {   // Range has no extent along this axis.
+        return minimum ;
+    }
+    const float relative    = value - minimum ;
+    const float wrapped     = relative - extent * floorf( relative / extent ) ;
+    // Roundoff can put wrapped at extent, which lies outside the last cell, so pull it inside.
+    return minimum + Clamp( wrapped , 0.0f , extent * ( 1.0f - 1.0e-5f ) ) ;
+}
+
+
+
+
+/** Assign wind to velocity of a subset of given particles.
+
+    \param particles    Dynamic array of particles whose velocity to update.
+
+    \param wind         Wind velocity, uniform across space.
+
+    \param srcWeight    Fraction of original velocity to keep.
+
+    \param windWeight   Fraction of wind velocity to assign.
+
+    \param windField    Optional grid of wind velocity to add to wind, or NULL.
+
+    \param fieldOffset  Displacement of windField, wrapped into its extent.
+
+    \param itStart      Index of first particle to update.
+
+    \param itEnd        One past index of last particle to update.
+
+    With a wind field, this wraps positions of a batch of particles into the
+    field, then samples it with UniformGrid::InterpolateMany, which computes
+    cell indices and weights for several positions at a time using SIMD.
+*/
+static void ApplyWind_Slice( VECTOR< Particle > & particles , const Vec3 & wind , float srcWeight , float windWeight , const UniformGrid< Vec3 > * windField , const Vec3 & fieldOffset , size_t itStart , size_t itEnd )
+{
+    ASSERT( itEnd <= particles.Size() ) ;
+
+    Particle *      pPcls       = & particles[ 0 ] ;
+    const Vec3      windTerm    = windWeight * wind ;
+
+    if( ! windField )
+    {   // Wind is uniform.
+        for( size_t iPcl = itStart ; iPcl < itEnd ; ++ iPcl )
+        {   // For each particle in the given range...
+            Particle & rPcl = pPcls[ iPcl ] ;
+            ASSERT( ! IsInf( rPcl.mPosition ) ) ;
+            // Update particle velocity.
+            rPcl.mVelocity = windTerm + srcWeight * rPcl.mVelocity ;
+        }
+        return ;
+    }
+
+    static const size_t batchSize = 64 ;
+    Vec3                positions[ batchSize ] ;
+    Vec3                gusts[ batchSize ] ;
+    const Vec3 &        fieldMin    = windField->GetMinCorner() ;
+    const Vec3 &        fieldExtent = windField->GetExtent() ;
+
+    for( size_t batchBegin = itStart ; batchBegin < itEnd ; batchBegin += batchSize )
+    {   // For each batch of particles in this slice...
+        const size_t numInBatch = Min2( batchSize , itEnd - batchBegin ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each particle in batch, find where it samples the tiling field.
+            const Vec3 & position = pPcls[ batchBegin + iInBatch ].mPosition ;
+            ASSERT( ! IsInf( position ) ) ;
+            positions[ iInBatch ] = Vec3( WrapIntoRange( position.x - fieldOffset.x , fieldMin.x , fieldExtent.x )
+                                        , WrapIntoRange( position.y - fieldOffset.y , fieldMin.y , fieldExtent.y )
+                                        , WrapIntoRange( position.z - fieldOffset.z , fieldMin.z , fieldExtent.z ) ) ;
+        }
+        windField->InterpolateMany( positions , gusts , numInBatch ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each particle in batch, update velocity.
+            Particle & rPcl = pPcls[ batchBegin + iInBatch ] ;
+            rPcl.mVelocity = windTerm + windWeight * gusts[ iInBatch ] + srcWeight * rPcl.mVelocity ;
+        }
+    }
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Compute how far the wind field has scrolled by this time.
 
+    \param timeStep     Duration of each frame.
+
+    \param uFrame       Frame counter, which, with timeStep, determines elapsed time.
+*/
+void PclOpWind::PrepareWindField( float timeStep , unsigned uFrame )
+{
+    ASSERT( HasWindField() ) ;
+
+    // Wrap offset into field extent, so it stays small enough to retain precision.
+    const Vec3 &    extent          = mWindField->GetExtent() ;
+    const Vec3      displacement    = mWindFieldScrollVelocity * ( float( uFrame ) * timeStep ) ;
+    mWindFieldOffset = Vec3( ( extent.x > 0.0f ) ? fmodf( displacement.x , extent.x ) : 0.0f
+                           , ( extent.y > 0.0f ) ? fmodf( displacement.y , extent.y ) : 0.0f
+                           , ( extent.z > 0.0f ) ? fmodf( displacement.z , extent.z ) : 0.0f ) ;
+}
+
+
+
+
+void PclOpWind::Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame )
+{
     if( ( 0.0f == mWindWeight ) && ( 1.0f == mSrcWeight ) )
     {   // Weights imply doing nothing.
         return ;
     }
 
-	if( particles.Empty() )
-	{
-		return ;
-	}
+    PERF_BLOCK( PclOpWind__Operate ) ;
+
+    BeginFusedPass( particles , timeStep , uFrame ) ;
 
+    // Assign wind using multiple threads.
     const size_t numParticles = particles.Size() ;
-    Particle * pPcls = & particles[ 0 ] ;
-    const Vec3 windTerm = mWindWeight * mWind ;
-    for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
-    {   // For each particle in the given array...
-        Particle & rPcl = pPcls[ iPcl ] ;
-        ASSERT( ! IsInf( rPcl.mPosition ) ) ;
-        // Update particle velocity.
-        rPcl.mVelocity = windTerm + mSrcWeight * rPcl.mVelocity ;
+    Parallel::For( 0 , numParticles , Parallel::GetGrainSize( numParticles ) , Parallel::Method( this , & PclOpWind::OperateOnRange , particles , timeStep , uFrame ) ) ;
+}
+
+
+
+
+void PclOpWind::BeginFusedPass( const VECTOR< Particle > & /* particles */ , float timeStep , unsigned uFrame )
+{
+    if( HasWindField() )
+    {   // Prepare shared data once, before chunks run concurrently.
+        PrepareWindField( timeStep , uFrame ) ;
+    }
+}
+
+
+
+
+void PclOpWind::OperateOnRange( VECTOR< Particle > & particles , float /* timeStep */ , unsigned /* uFrame */ , size_t iPclBegin , size_t iPclEnd )
+{
+    if( ( 0.0f == mWindWeight ) && ( 1.0f == mSrcWeight ) )
+    {   // Weights imply doing nothing.
+        return ;
     }
-}
\ No newline at end of file
+
+    if( iPclBegin >= iPclEnd )
+    {
+        return ;
+    }
+
+    ApplyWind_Slice( particles , mWind , mSrcWeight , mWindWeight , HasWindField() ? mWindField : NULLPTR , mWindFieldOffset , iPclBegin , iPclEnd ) ;
+}
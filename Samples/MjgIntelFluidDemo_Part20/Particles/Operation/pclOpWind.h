@@ -4,14 +4,30 @@
 
     \see http://www.mijagourlay.com/
 
-    \author Copyright 2009-2014 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
 */
 #ifndef PARTICLE_OPERATION_WIND_H
 #define PARTICLE_OPERATION_WIND_H
 
 #include "particleOperation.h"
 
+#include "Core/SpatialPartition/uniformGrid.h"
+
 /** Particle operation to push particles along a direction up to a maximum speed.
+
+    Wind velocity is mWind, plus, when mWindField is set, a value
+    interpolated from that grid.  That lets ambient motion, such as gusts,
+    vary in space and time without emitting vortons to induce it, so it
+    costs one grid lookup per particle instead of a simulation.
+
+    The wind field tiles space:  Each particle samples the field at its
+    position, minus mWindFieldScrollVelocity times elapsed time, wrapped
+    into the field's extent.  Scrolling therefore carries gusts past
+    particles.  For seamless tiling, gridpoints on opposite faces of the
+    field should have equal values.
+
+    The caller owns and precomputes mWindField, for example from procedural
+    noise or a recorded simulation, and must keep it alive while this uses it.
 */
 class PclOpWind : public IParticleOperation
 {
@@ -20,15 +36,35 @@ class PclOpWind : public IParticleOperation
             : mWind( 1.0f , 0.0f , 0.0f )
             , mSrcWeight( 0.875f )
             , mWindWeight( 0.125f )
+            , mWindField( NULLPTR )
+            , mWindFieldScrollVelocity( 0.0f , 0.0f , 0.0f )
+            , mWindFieldOffset( 0.0f , 0.0f , 0.0f )
         {}
 
         VIRTUAL_CONSTRUCTORS( PclOpWind ) ;
 
         void Operate(  VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
 
-        Vec3    mWind       ;   ///< Wind velocity
-        float   mSrcWeight  ;   ///< Fraction of original velocity to keep
-        float   mWindWeight ;   ///< Fraction of wind velocity to assign
+        bool IsFusable() const { return true ; }
+        void BeginFusedPass( const VECTOR< Particle > & particles , float timeStep , unsigned uFrame ) ;
+        void OperateOnRange( VECTOR< Particle > & particles , float timeStep , unsigned uFrame , size_t iPclBegin , size_t iPclEnd ) ;
+        ParticleAttributeMask GetAttributesUsed() const
+        {
+            return HasWindField()   ? Particles::AttributeBit( PARTICLE_ATTRIBUTE_POSITION ) | Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY )
+                                    : Particles::AttributeBit( PARTICLE_ATTRIBUTE_VELOCITY ) ;
+        }
+
+        Vec3                            mWind                   ;   ///< Wind velocity, uniform across space.
+        float                           mSrcWeight              ;   ///< Fraction of original velocity to keep
+        float                           mWindWeight             ;   ///< Fraction of wind velocity to assign
+        const UniformGrid< Vec3 > *     mWindField              ;   ///< Optional grid of wind velocity to add to mWind, which tiles space.  NULL means wind is uniform.
+        Vec3                            mWindFieldScrollVelocity;   ///< Velocity at which mWindField moves through space.
+
+    private:
+        bool HasWindField() const { return mWindField && ! mWindField->HasZeroExtent() ; }
+        void PrepareWindField( float timeStep , unsigned uFrame ) ;
+
+        Vec3                            mWindFieldOffset        ;   ///< Displacement of mWindField, wrapped into its extent, as of the most recent call to Operate or BeginFusedPass.
 } ;
 
-#endif
\ No newline at end of file
+#endif
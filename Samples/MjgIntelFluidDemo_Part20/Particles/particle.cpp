@@ -8,6 +8,7 @@
 */
 
 #include "Particles/particle.h"
+#include "Particles/particleLifecycle.h"
 
 #include "Core/SpatialPartition/uniformGridMath.h"
 
@@ -96,7 +97,8 @@ void PclHistoryRecord( size_t offset , const Particle & pcl )
 
     In order to make parallelizing this easier, some routines that want to
     kill particles instead simply "mark them for death" so that this routine
-    can sweep through and reorder the particles array.
+    can sweep through and compact the particles array.  Compaction runs in
+    parallel and preserves the order of survivors; see Particles::KillIf.
 
     \see MarkDead, IsAlive.
 */
@@ -104,20 +106,8 @@ void Particles::KillParticlesMarkedForDeath( VECTOR< Particle > & particles )
 {
     PERF_BLOCK( Particles__KillParticlesMarkedForDeath ) ;
 
-    size_t numParticles = particles.Size() ;
-    for( size_t iPcl = 0 ; iPcl < numParticles ; /* Loop body increments iPcl. */ )
-    {
-        const Particle & pcl = particles[ iPcl ] ;
-        if( ! pcl.IsAlive() )
-        {   // Particle was marked for death.
-            Particles::Kill( particles , iPcl ) ;
-            -- numParticles ;
-        }
-        else
-        {   // Particle remains alive.
-            ++ iPcl ;
-        }
-    }
+    CompactionScratch scratch ;
+    KillIf( particles , IsMarkedDead() , scratch ) ;
 }
 
 
@@ -320,7 +310,7 @@ void Particles::ComputeDensityStats( const VECTOR< Particle > & particles , floa
 
 #if defined( _DEBUG )
 
-void CheckSpatialPartition( const VECTOR< Particle > & itemArray , const UniformGrid< VECTOR< unsigned > > & itemGrid )
+void CheckSpatialPartition( const VECTOR< Particle > & itemArray , const CellList & itemGrid )
 {
     FILE * fp = fopen( "sp.dat" , "w" ) ;
 
@@ -331,7 +321,7 @@ void CheckSpatialPartition( const VECTOR< Particle > & itemArray , const Uniform
     for( unsigned iy = 0 ; iy < itemGrid.GetNumCells( 1 ) ; ++ iy )
     for( unsigned ix = 0 ; ix < itemGrid.GetNumCells( 0 ) ; ++ ix )
     {   // For each grid cell...
-        const VECTOR< unsigned > & cell = itemGrid.Get( ix , iy , iz ) ;
+        const CellList::Cell cell = itemGrid.Get( ix , iy , iz ) ;
         const size_t numInCell = cell.Size() ;
         numInGrid += numInCell ;
 
@@ -388,11 +378,12 @@ void CheckSpatialPartition( const VECTOR< Particle > & itemArray , const Uniform
 
     \param particles Particles to partition.
 
-    \param particleIndices (in/out) Uniform grid of particle indices.  Assign each cell
-        to contain a vector of the indices of particles that reside inside that cell.
+    \param particleIndices (in/out) Cell list of particle indices.  Assign each cell
+        to contain the indices of particles that reside inside that cell.
         The index values refer to elements in particles.
-        This routine assumes the grid geometry has been defined, but this routine
-        will clear any incoming contents.
+        This routine assumes the grid geometry has been defined.  If the incoming
+        contents came from partitioning the same number of particles into the same
+        layout, this routine updates them incrementally.  See CellList::Partition.
 
 */
 void Particles::PartitionParticles(
@@ -401,32 +392,28 @@ void Particles::PartitionParticles(
 #if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
                                         SpatialPartition & particleGrid
 #else
-                                        UniformGrid< VECTOR< unsigned > > & particleIndices
+                                        CellList & particleIndices
 #endif
                                     , float minCellSpacing )
 {
     PERF_BLOCK( Particles__PartitionParticles ) ;
 
+#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
     const size_t numParticles = particles.Size() ;
 
-#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
     particleGrid.Init( numVortons , mGridTemplate ) ;               // Initialize spatial partition.
-#else
-    // Do not call Clear here; that also erases geometry.
-    particleIndices.FitShape( particleIndices , minCellSpacing ) ;  // Possibly modify grid to accommodate minCellSpacing
-    particleIndices.Init() ;                                        // Reserve memory for grid and initialize all values to empty.
-#endif
 
     for( unsigned offset = 0 ; offset < numParticles; ++ offset )
     {   // For each particle...
         const Particle &    rParticle = particles[ offset ] ;
         // Insert the particle's offset into the spatial partition.
-#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
         particleGrid.PushBack( offset , rVorton.mPosition ) ;
+    }
 #else
-        particleIndices[ rParticle.mPosition ].PushBack( offset ) ;
+    // Do not call Clear here; that also erases geometry.
+    // Possibly modify grid to accommodate minCellSpacing, then assign each particle to its cell.
+    particleIndices.Partition( particles , particleIndices , minCellSpacing ) ;
 #endif
-    }
 
 #if defined( _DEBUG )
     CheckSpatialPartition( particles , particleIndices ) ;
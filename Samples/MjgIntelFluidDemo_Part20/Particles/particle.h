@@ -16,6 +16,7 @@
 #include "Core/Math/vec3.h"
 
 #include "Core/SpatialPartition/uniformGrid.h"
+#include "Core/SpatialPartition/cellList.h"
 
 // Macros --------------------------------------------------------------
 
@@ -25,8 +26,10 @@
 
 /** Whether to record a recent history of particle positions in a ring buffer, for rendering pathlines.
 
-    This consumes a lot of memory and CPU time.
+    History lives outside Particle, for a sampled subset of particles.
     It is meant for diagnosis, not for release.
+
+    \see ParticlePositionHistory
 */
 #define ENABLE_PARTICLE_POSITION_HISTORY 0
 
@@ -89,6 +92,7 @@ class Particle
             , mDensity( 1.0f )
             , mSize( 0.0f )
             , mBirthTime( 0 )
+            , mId( 0 )
         #if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
             , mHitBoundary( false )
             , mHitNormal( 0.0f , 0.0f , 0.0f )
@@ -110,9 +114,6 @@ class Particle
             , mNumSibVortonsIncorporated( 0 )
             #endif
         #endif
-        #if ENABLE_PARTICLE_POSITION_HISTORY
-            , mPositionHistoryIndex( 0 )
-        #endif
         #if ENABLE_PARTICLE_JERK_RECORD
             , mVelocityPrev( 0.0f , 0.0f , 0.0f )
             , mAcceleration( 0.0f , 0.0f , 0.0f )
@@ -123,13 +124,6 @@ class Particle
             , mDisplacement( 0.0f , 0.0f , 0.0f )
         #endif
         {
-        #if ENABLE_PARTICLE_POSITION_HISTORY
-            mPositionHistory[ mPositionHistoryIndex ] = mPosition ;
-            for( size_t iHistory = 1 ; iHistory < NUM_HISTORICAL_POSITIONS ; ++ iHistory )
-            {
-                mPositionHistory[ iHistory ] = Vec3( Particle::sNaN , Particle::sNaN , Particle::sNaN ) ;
-            }
-        #endif
         }
 
 
@@ -149,6 +143,7 @@ class Particle
             , mDensity( 1.0f )
             , mSize( size )
             , mBirthTime( 0 )
+            , mId( 0 )
         #if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
             , mHitBoundary( false )
             , mHitNormal( 0.0f , 0.0f , 0.0f )
@@ -170,9 +165,6 @@ class Particle
             , mNumSibVortonsIncorporated( 0 )
             #endif
         #endif
-        #if ENABLE_PARTICLE_POSITION_HISTORY
-            , mPositionHistoryIndex( 0 )
-        #endif
         #if ENABLE_PARTICLE_JERK_RECORD
             , mVelocityPrev( sNaN , sNaN , sNaN )
             , mAcceleration( sNaN , sNaN , sNaN )
@@ -183,13 +175,6 @@ class Particle
             , mDisplacement( sNaN , sNaN , sNaN )
         #endif
         {
-        #if ENABLE_PARTICLE_POSITION_HISTORY
-            mPositionHistory[ mPositionHistoryIndex ] = mPosition ;
-            for( size_t iHistory = 1 ; iHistory < NUM_HISTORICAL_POSITIONS ; ++ iHistory )
-            {
-                mPositionHistory[ iHistory ] = Vec3( Particle::sNaN , Particle::sNaN , Particle::sNaN ) ;
-            }
-        #endif
         }
 
 
@@ -368,42 +353,6 @@ class Particle
         }
 
 
-    #if ENABLE_PARTICLE_POSITION_HISTORY
-        static size_t NextHistoryIndex( size_t positionHistoryIndex )
-        {
-            static const size_t lastHistoricalIndex = NUM_HISTORICAL_POSITIONS - 1 ;
-            return positionHistoryIndex >= lastHistoricalIndex ? 0 : positionHistoryIndex + 1 ;
-        }
-
-        size_t HistoryNext() const
-        {
-            static const size_t lastHistoricalIndex = NUM_HISTORICAL_POSITIONS - 1 ;
-            return NextHistoryIndex( mPositionHistoryIndex ) ;
-        }
-
-        /// Return index of first (oldest) element in position history.
-        size_t HistoryBegin() const
-        {
-            return mPositionHistoryIndex ;
-        }
-
-        /// Return index of last (newest) element in position history.
-        size_t HistoryEnd() const
-        {
-            static const size_t lastHistoricalIndex = NUM_HISTORICAL_POSITIONS - 1 ;
-            return 0 == mPositionHistoryIndex ? lastHistoricalIndex : mPositionHistoryIndex - 1 ;
-        }
-
-        void RecordPositionHistory()
-        {
-            ASSERT( mPositionHistoryIndex < NUM_HISTORICAL_POSITIONS ) ;
-            // Record current position in history.
-            mPositionHistory[ mPositionHistoryIndex ] = mPosition ;
-            // Increment ring buffer index.
-            mPositionHistoryIndex = HistoryNext() ;
-        }
-    #endif
-
     #if ENABLE_PARTICLE_JERK_RECORD
         /** Update diagnostic quantities used to measure jerk.
 
@@ -429,6 +378,7 @@ class Particle
         float	    mDensity            ;   ///< Either density or mass per particle, depending.  For fire simulations, this is the exhaust (smoke) density.
         float	    mSize		        ;   ///< Diameter of the region of influence of a particle.
         int         mBirthTime          ;   ///< Birth time of particle, in "ticks"
+        unsigned    mId                 ;   ///< Stable identifier of particle, which moves with it between slots.  Zero until a ParticleIdMap assigns one.  See ParticleIdMap.
 
     #if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
         bool        mHitBoundary        ;   ///< Whether this particle hit a boundary this frame.
@@ -464,11 +414,6 @@ class Particle
     #endif
 #endif
 
-    #if ENABLE_PARTICLE_POSITION_HISTORY
-        static const size_t NUM_HISTORICAL_POSITIONS = 32 ;
-        Vec3    mPositionHistory[ NUM_HISTORICAL_POSITIONS ]    ;   ///< Ring buffer of recent history of positions of this particle.
-        size_t  mPositionHistoryIndex                           ;   ///< Index into mPositionHistory of next position to record.
-    #endif
     #if ENABLE_PARTICLE_JERK_RECORD
         Vec3    mVelocityPrev       ;   ///< Particle velocity from previous update.
         Vec3    mAcceleration       ;   ///< Particle acceleration for current state.
@@ -486,11 +431,18 @@ class Particle
 namespace Particles
 {
     /** Kill the particle at the given index, replacing it with the last particle in the given dynamic array.
+
+        This never reallocates, but reorders particles, so callers that kill
+        many particles at once should use KillIf instead.
     */
     inline void Kill( VECTOR< Particle > & particles , size_t iParticle )
     {
         ASSERT( iParticle < particles.Size() ) ;
-        particles[ iParticle ] = particles[ particles.Size() - 1 ] ;
+        const size_t iLast = particles.Size() - 1 ;
+        if( iParticle != iLast )
+        {   // Killed particle is not last, so fill its slot with last.
+            particles[ iParticle ] = particles[ iLast ] ;
+        }
         particles.PopBack() ;
     }
 
@@ -563,7 +515,7 @@ namespace Particles
 #if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
                             SpatialPartition & particleGrid
 #else
-                            UniformGrid< VECTOR< unsigned > > & particleIndices
+                            CellList & particleIndices
 #endif
                         , float minCellSpacing ) ;
 
@@ -0,0 +1,236 @@
+/** \file particleAttributeView.h
+
+    \brief Descriptions of where particle attributes live in memory, and typed views of them.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_ATTRIBUTE_VIEW_H
+#define PARTICLE_ATTRIBUTE_VIEW_H
+
+#include <stddef.h>
+
+#include "Core/Containers/vector.h"
+#include "Core/Utility/macros.h"
+
+#include "Particles/particle.h"
+
+// Types --------------------------------------------------------------
+
+/** Identity of each attribute a particle has.
+*/
+enum ParticleAttributeE
+{
+    PARTICLE_ATTRIBUTE_POSITION         ,   ///< Vec3 Particle::mPosition
+    PARTICLE_ATTRIBUTE_VELOCITY         ,   ///< Vec3 Particle::mVelocity
+    PARTICLE_ATTRIBUTE_ORIENTATION      ,   ///< Vec3 Particle::mOrientation
+    PARTICLE_ATTRIBUTE_ANGULAR_VELOCITY ,   ///< Vec3 Particle::mAngularVelocity
+    PARTICLE_ATTRIBUTE_DENSITY          ,   ///< float Particle::mDensity
+    PARTICLE_ATTRIBUTE_SIZE             ,   ///< float Particle::mSize
+#if ENABLE_FIRE
+    PARTICLE_ATTRIBUTE_FUEL_FRACTION    ,   ///< float Particle::mFuelFraction
+    PARTICLE_ATTRIBUTE_FLAME_FRACTION   ,   ///< float Particle::mFlameFraction
+    PARTICLE_ATTRIBUTE_SMOKE_FRACTION   ,   ///< float Particle::mSmokeFraction
+#endif
+    NUM_PARTICLE_ATTRIBUTES
+} ;
+
+
+/** Set of particle attributes, with bit ( 1u << attribute ) set for each ParticleAttributeE in the set.
+
+    Particle operations declare which attributes they read or write, so
+    their group can tell which attributes its particles need.
+
+    \see IParticleOperation::GetAttributesUsed, ParticleGroup::GetAttributesUsed
+*/
+typedef unsigned ParticleAttributeMask ;
+
+static const ParticleAttributeMask PARTICLE_ATTRIBUTE_MASK_NONE = 0u ;
+static const ParticleAttributeMask PARTICLE_ATTRIBUTE_MASK_ALL  = ( 1u << NUM_PARTICLE_ATTRIBUTES ) - 1u ;
+
+
+
+
+/** Description of where one attribute of every particle lives in memory, independent of its C++ type.
+
+    Attribute of particle i lives at mBase + i * mStrideInBytes, and has
+    mNumComponents floats.  For contiguous Particle objects (array of
+    structures), mStrideInBytes is sizeof(Particle); for a structure of
+    arrays, it would be the size of the attribute.  Either way, clients such
+    as vertex buffer fillers, and GPU uploads that take a pointer, stride and
+    component count (e.g. glVertexAttribPointer), can read attributes
+    directly from simulation memory, without first copying them.
+*/
+struct ParticleAttributeStream
+{
+    ParticleAttributeStream()
+        : mBase( NULLPTR )
+        , mStrideInBytes( 0 )
+        , mNumComponents( 0 )
+        , mCount( 0 )
+    {}
+
+    ParticleAttributeStream( const char * base , size_t strideInBytes , size_t numComponents , size_t count )
+        : mBase( base )
+        , mStrideInBytes( strideInBytes )
+        , mNumComponents( numComponents )
+        , mCount( count )
+    {}
+
+    /// Return offset, in bytes, of this attribute relative to the given address, e.g. the start of a buffer that holds particles.
+    size_t GetOffsetInBytesFrom( const void * address ) const
+    {
+        ASSERT( mBase >= static_cast< const char * >( address ) ) ;
+        return mBase - static_cast< const char * >( address ) ;
+    }
+
+    const char *    mBase           ;   ///< Address of attribute of first particle.  NULL when there are no particles.
+    size_t          mStrideInBytes  ;   ///< Number of bytes between attributes of adjacent particles.
+    size_t          mNumComponents  ;   ///< Number of float components in attribute: 1 for scalars, 3 for Vec3.
+    size_t          mCount          ;   ///< Number of particles.
+} ;
+
+
+
+
+/** Typed, strided view of one attribute of a contiguous sequence of particles.
+
+    This does not own or copy the attribute; it refers to simulation memory,
+    so it remains valid only until the particles it views get reallocated,
+    e.g. by adding or removing particles.
+
+    \tparam AttributeT  Type of attribute, e.g. Vec3 or float.  Use a const type to view const particles.
+*/
+template< typename AttributeT > class ParticleAttributeView
+{
+    public:
+        ParticleAttributeView()
+            : mBase( NULLPTR )
+            , mStrideInBytes( 0 )
+            , mCount( 0 )
+        {}
+
+        ParticleAttributeView( const ParticleAttributeStream & stream )
+            : mBase( stream.mBase )
+            , mStrideInBytes( stream.mStrideInBytes )
+            , mCount( stream.mCount )
+        {
+            ASSERT( stream.mNumComponents * sizeof( float ) == sizeof( AttributeT ) ) ;
+        }
+
+        /// Return attribute of particle with the given index.
+        AttributeT & operator[]( size_t iPcl ) const
+        {
+            ASSERT( iPcl < mCount ) ;
+            return * reinterpret_cast< AttributeT * >( const_cast< char * >( mBase + iPcl * mStrideInBytes ) ) ;
+        }
+
+        /// Return number of particles this view spans.
+        const size_t &  Size() const            { return mCount ; }
+
+        /// Return number of bytes between attributes of adjacent particles.
+        const size_t &  GetStrideInBytes() const { return mStrideInBytes ; }
+
+    private:
+        const char *    mBase           ;   ///< Address of attribute of first particle.
+        size_t          mStrideInBytes  ;   ///< Number of bytes between attributes of adjacent particles.
+        size_t          mCount          ;   ///< Number of particles.
+} ;
+
+// Public functions --------------------------------------------------------------
+
+namespace Particles
+{
+    /** Return set containing only the given attribute.
+    */
+    inline ParticleAttributeMask AttributeBit( ParticleAttributeE attribute )
+    {
+        ASSERT( attribute < NUM_PARTICLE_ATTRIBUTES ) ;
+        return 1u << attribute ;
+    }
+
+
+    /** Return offset, in bytes, from start of a Particle to the given attribute.
+
+        This is the only place that should apply offsetof to Particle members.
+    */
+    inline size_t GetAttributeOffset( ParticleAttributeE attribute )
+    {
+        switch( attribute )
+        {
+        case PARTICLE_ATTRIBUTE_POSITION        : return offsetof( Particle , mPosition        ) ;
+        case PARTICLE_ATTRIBUTE_VELOCITY        : return offsetof( Particle , mVelocity        ) ;
+        case PARTICLE_ATTRIBUTE_ORIENTATION     : return offsetof( Particle , mOrientation     ) ;
+        case PARTICLE_ATTRIBUTE_ANGULAR_VELOCITY: return offsetof( Particle , mAngularVelocity ) ;
+        case PARTICLE_ATTRIBUTE_DENSITY         : return offsetof( Particle , mDensity         ) ;
+        case PARTICLE_ATTRIBUTE_SIZE            : return offsetof( Particle , mSize            ) ;
+    #if ENABLE_FIRE
+        case PARTICLE_ATTRIBUTE_FUEL_FRACTION   : return offsetof( Particle , mFuelFraction    ) ;
+        case PARTICLE_ATTRIBUTE_FLAME_FRACTION  : return offsetof( Particle , mFlameFraction   ) ;
+        case PARTICLE_ATTRIBUTE_SMOKE_FRACTION  : return offsetof( Particle , mSmokeFraction   ) ;
+    #endif
+        default: FAIL() ; return 0 ;
+        }
+    }
+
+
+    /** Return set containing the attribute at the given offset, in bytes, from start of a Particle, or PARTICLE_ATTRIBUTE_MASK_ALL if no attribute starts there.
+
+        This lets operations that refer to a member by offset declare which attribute they use.
+    */
+    inline ParticleAttributeMask AttributeBitAtOffset( size_t offsetInBytes )
+    {
+        for( unsigned attribute = 0 ; attribute < NUM_PARTICLE_ATTRIBUTES ; ++ attribute )
+        {   // For each particle attribute...
+            if( GetAttributeOffset( ParticleAttributeE( attribute ) ) == offsetInBytes )
+            {   // Found attribute at given offset.
+                return AttributeBit( ParticleAttributeE( attribute ) ) ;
+            }
+        }
+        return PARTICLE_ATTRIBUTE_MASK_ALL ;    // Member is not an enumerated attribute, so conservatively claim all.
+    }
+
+
+    /** Return number of float components in the given attribute.
+    */
+    inline size_t GetAttributeNumComponents( ParticleAttributeE attribute )
+    {
+        switch( attribute )
+        {
+        case PARTICLE_ATTRIBUTE_POSITION        :
+        case PARTICLE_ATTRIBUTE_VELOCITY        :
+        case PARTICLE_ATTRIBUTE_ORIENTATION     :
+        case PARTICLE_ATTRIBUTE_ANGULAR_VELOCITY:
+            return 3 ;
+        default:
+            ASSERT( attribute < NUM_PARTICLE_ATTRIBUTES ) ;
+            return 1 ;
+        }
+    }
+
+
+    /** Return description of where the given attribute of each of the given particles lives.
+    */
+    inline ParticleAttributeStream GetAttributeStream( const VECTOR< Particle > & particles , ParticleAttributeE attribute )
+    {
+        if( particles.Empty() )
+        {
+            return ParticleAttributeStream( NULLPTR , sizeof( Particle ) , GetAttributeNumComponents( attribute ) , 0 ) ;
+        }
+        const char * particleBytes = reinterpret_cast< const char * >( & particles[ 0 ] ) ;
+        return ParticleAttributeStream( particleBytes + GetAttributeOffset( attribute ) , sizeof( Particle ) , GetAttributeNumComponents( attribute ) , particles.Size() ) ;
+    }
+
+
+    /** Return view of the given attribute of the given particles.
+
+        \tparam AttributeT  Type of attribute, which must match the attribute: Vec3 or float, usually const.
+    */
+    template< typename AttributeT > ParticleAttributeView< AttributeT > GetAttributeView( const VECTOR< Particle > & particles , ParticleAttributeE attribute )
+    {
+        return ParticleAttributeView< AttributeT >( GetAttributeStream( particles , attribute ) ) ;
+    }
+}
+
+#endif
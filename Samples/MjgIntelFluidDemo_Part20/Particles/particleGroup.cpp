@@ -11,8 +11,75 @@
 
 #include <Core/Performance/perfBlock.h>
 
+#include <Core/parallelExecution.h>
+
+#include <Core/Memory/largePages.h>
+
 // Macros ----------------------------------------------------------------------
+
+/** Whether ParticleGroup::Update runs consecutive fusable operations in a single pass over particles.
+
+    \see IParticleOperation::IsFusable
+*/
+#define PARTICLE_GROUP_FUSE_OPERATIONS 1
+
 // Types -----------------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+#if PARTICLE_GROUP_FUSE_OPERATIONS
+
+/** Run a sequence of fusable particle operations on (subset of) particles, chunk by chunk.
+
+    \param iOpBegin     Index of first operation to run.
+
+    \param iOpEnd       One past index of last operation to run.
+
+    \param chunkBegin   Index of first chunk to operate on.
+
+    \param chunkEnd     One past index of last chunk to operate on.
+*/
+void ParticleGroup::OperateFusedSlice( size_t iOpBegin , size_t iOpEnd , float timeStep , unsigned uFrame , size_t chunkBegin , size_t chunkEnd )
+{
+    const size_t numParticles = mParticles.Size() ;
+    for( size_t iChunk = chunkBegin ; iChunk < chunkEnd ; ++ iChunk )
+    {   // For each chunk in this slice...
+        const size_t iPclBegin  = iChunk * PARTICLE_OPERATION_FUSED_CHUNK_SIZE ;
+        const size_t iPclEnd    = Min2( iPclBegin + PARTICLE_OPERATION_FUSED_CHUNK_SIZE , numParticles ) ;
+        for( size_t iOp = iOpBegin ; iOp < iOpEnd ; ++ iOp )
+        {   // For each operation in the fused sequence...
+            mParticleOps[ iOp ]->OperateOnRange( mParticles , timeStep , uFrame , iPclBegin , iPclEnd ) ;
+        }
+    }
+}
+
+
+
+
+/** Run a sequence of fusable particle operations on all particles, in one pass over memory.
+*/
+void ParticleGroup::OperateFused( size_t iOpBegin , size_t iOpEnd , float timeStep , unsigned uFrame )
+{
+    PERF_BLOCK( ParticleGroup__OperateFused ) ;
+
+    const size_t numParticles   = mParticles.Size() ;
+    const size_t numChunks      = ( numParticles + PARTICLE_OPERATION_FUSED_CHUNK_SIZE - 1 ) / PARTICLE_OPERATION_FUSED_CHUNK_SIZE ;
+
+    for( size_t iOp = iOpBegin ; iOp < iOpEnd ; ++ iOp )
+    {   // For each operation in the fused sequence...
+        mParticleOps[ iOp ]->BeginFusedPass( mParticles , timeStep , uFrame ) ;
+    }
+
+    Parallel::For( 0 , numChunks , 1 , Parallel::Method( this , & ParticleGroup::OperateFusedSlice , iOpBegin , iOpEnd , timeStep , uFrame ) ) ;
+
+    for( size_t iOp = iOpBegin ; iOp < iOpEnd ; ++ iOp )
+    {   // For each operation in the fused sequence...
+        mParticleOps[ iOp ]->EndFusedPass() ;
+    }
+}
+
+#endif
+
+// Public functions ------------------------------------------------------------
 
 ParticleGroup::~ParticleGroup()
 {
@@ -23,6 +90,9 @@ ParticleGroup::~ParticleGroup()
 
 
 ParticleGroup::ParticleGroup( const ParticleGroup & that )
+    : mUpdatePeriod( 1 )
+    , mNumFramesPending( 0 )
+    , mTimePending( 0.0f )
 {
     this->operator=( that ) ;
 }
@@ -36,6 +106,9 @@ ParticleGroup & ParticleGroup::operator=( const ParticleGroup & that )
     {   // Not self-copy.
         Clear() ;   // Delete all previous items in this object.
         mParticles = that.mParticles ;
+    #if PARTICLE_GROUP_STABLE_IDS
+        mIdMap = that.mIdMap ;
+    #endif
         for( ConstIterator pclOpIter = that.mParticleOps.Begin() ; pclOpIter != that.mParticleOps.End() ; ++ pclOpIter )
         {   // For each particle operation in the original group...
             IParticleOperation * pclOpOrig = * pclOpIter ;
@@ -44,6 +117,9 @@ ParticleGroup & ParticleGroup::operator=( const ParticleGroup & that )
             // Remember the duplicate.
             mParticleOps.PushBack( pclOpDupe ) ;
         }
+        mUpdatePeriod       = that.mUpdatePeriod ;
+        mNumFramesPending   = that.mNumFramesPending ;
+        mTimePending        = that.mTimePending ;
     }
     return * this ;
 }
@@ -54,6 +130,9 @@ ParticleGroup & ParticleGroup::operator=( const ParticleGroup & that )
 void ParticleGroup::Clear()
 {
     mParticles.Clear() ;
+#if PARTICLE_GROUP_STABLE_IDS
+    mIdMap.Clear() ;
+#endif
     while( ! mParticleOps.Empty() )
     {
         IParticleOperation * pOp = mParticleOps.Back() ;
@@ -65,20 +144,98 @@ void ParticleGroup::Clear()
 
 
 
+/** Set number of frames per update of this group.
+
+    \param numFramesPerUpdate  Number of calls to Update per run of particle
+                                operations.  Must be positive.  1 runs
+                                operations every frame.
+
+    Changing the period keeps time accumulated since operations last ran,
+    so the next run still spans every frame since then.
+*/
+void ParticleGroup::SetUpdatePeriod( unsigned numFramesPerUpdate )
+{
+    ASSERT( numFramesPerUpdate > 0 ) ;
+    mUpdatePeriod       = numFramesPerUpdate ;
+    mNumFramesPending   = Min2( mNumFramesPending , numFramesPerUpdate - 1 ) ;
+}
+
+
+
+
 /** Perform all particle operations in this group.
-    \see IParticleOperation
+
+    When PARTICLE_GROUP_FUSE_OPERATIONS is set, consecutive operations that
+    act on each particle independently run together, chunk by chunk, so each
+    chunk of particles streams through cache once for all of them.  Other
+    operations act as barriers between such fused sequences.
+
+    When the update period exceeds 1, this runs operations only on every
+    GetUpdatePeriod'th call, passing them the sum of time steps since they
+    last ran.
+
+    Particles live in an ordinary VECTOR, whose allocator other code
+    depends on, so rather than allocate them from large pages, this advises
+    the operating system to back them with large pages.
+
+    Afterwards, when PARTICLE_GROUP_STABLE_IDS is set, GetIdMap reports
+    the slot of each particle and which particles arrived or departed.
+
+    \see IParticleOperation, IParticleOperation::IsFusable, SetUpdatePeriod, AdviseLargePages, GetIdMap
 */
 void ParticleGroup::Update( float timeStep , unsigned uFrame )
 {
+    mTimePending += timeStep ;
+    ++ mNumFramesPending ;
+    if( mNumFramesPending < mUpdatePeriod )
+    {   // Not time to run operations yet.
+        return ;
+    }
+    timeStep            = mTimePending ;
+    mTimePending        = 0.0f ;
+    mNumFramesPending   = 0 ;
+
     PERF_BLOCK( ParticleGroup__Update ) ;
 
     const size_t numOps = mParticleOps.Size() ;
 
+#if PARTICLE_GROUP_FUSE_OPERATIONS
+    for( size_t iOp = 0 ; iOp < numOps ; /* Loop body increments iOp. */ )
+    {   // Run operations in order.
+        size_t iOpEnd = iOp ;
+        while( ( iOpEnd < numOps ) && mParticleOps[ iOpEnd ]->IsFusable() )
+        {   // Operation at iOpEnd can fuse with preceding ones.
+            ++ iOpEnd ;
+        }
+
+        if( iOpEnd - iOp >= 2 )
+        {   // Found a sequence of fusable operations.  Run them together.
+            OperateFused( iOp , iOpEnd , timeStep , uFrame ) ;
+            iOp = iOpEnd ;
+        }
+        else
+        {   // Operation is a barrier, or has no fusable neighbor.  Run it alone.
+            mParticleOps[ iOp ]->Operate( mParticles , timeStep , uFrame ) ;
+            ++ iOp ;
+        }
+    }
+#else
     for( size_t iOp = 0 ; iOp < numOps ; ++ iOp )
     {   // Run operations in order.
         IParticleOperation * pOp = mParticleOps[ iOp ] ;
         pOp->Operate( mParticles , timeStep , uFrame ) ;
     }
+#endif
+
+#if PARTICLE_GROUP_STABLE_IDS
+    // Operations kill, emit and reorder particles, so identify arrivals and record where every particle ended up.
+    mIdMap.Sync( mParticles ) ;
+#endif
+
+    if( ! mParticles.Empty() )
+    {   // Operations (e.g. emitters) can reallocate particles, so ask again for large pages, which cuts TLB misses of operations that gather or scatter by particle.
+        AdviseLargePages( mParticles.Data() , mParticles.Capacity() * sizeof( Particle ) ) ;
+    }
 }
 
 
@@ -101,6 +258,51 @@ size_t  ParticleGroup::IndexOfOperation( IParticleOperation * const pclOpAddress
 
 
 
+/** Return bounding boxes of chunks of particles in this group, or NULL if they are not known.
+
+    Only the last operation in this group can provide chunk bounds, since a
+    later operation could move particles out of them.  Bounds must also
+    describe the current number of particles, since code outside Update
+    (e.g. removing particles embedded in bodies) can change the population.
+*/
+const ParticleChunkBounds * ParticleGroup::GetChunkBounds() const
+{
+    if( mParticleOps.Empty() )
+    {   // Group has no operations, so nothing found bounds.
+        return NULLPTR ;
+    }
+    const ParticleChunkBounds * chunkBounds = mParticleOps.Back()->GetChunkBounds() ;
+    if( ( NULLPTR == chunkBounds ) || ! chunkBounds->Describes( mParticles.Size() ) )
+    {
+        return NULLPTR ;
+    }
+    return chunkBounds ;
+}
+
+
+
+
+/** Return set of particle attributes that some operation in this group reads or writes.
+
+    Attributes outside this set are never touched by this group, so
+    consumers of its particles, such as exporters, can skip them.
+
+    \see IParticleOperation::GetAttributesUsed
+*/
+ParticleAttributeMask ParticleGroup::GetAttributesUsed() const
+{
+    ParticleAttributeMask attributesUsed = PARTICLE_ATTRIBUTE_MASK_NONE ;
+    const size_t numOps = mParticleOps.Size() ;
+    for( size_t iOp = 0 ; iOp < numOps ; ++ iOp )
+    {   // For each particle operation...
+        attributesUsed |= mParticleOps[ iOp ]->GetAttributesUsed() ;
+    }
+    return attributesUsed ;
+}
+
+
+
+
 #include <Particles/Operation/pclOpFindBoundingBox.h>
 #include <Particles/Operation/pclOpWind.h>
 #include <Particles/Operation/pclOpAdvect.h>
@@ -10,11 +10,29 @@
 #define PARTICLE_GROUP_H
 
 #include "Operation/particleOperation.h"
+#include "particleIdMap.h"
+
+#include <algorithm>
 
 // Macros ----------------------------------------------------------------------
+
+/** Whether ParticleGroup::Update gives each particle a stable identifier, and maps identifiers to slots.
+
+    \see ParticleIdMap, ParticleGroup::GetIdMap
+*/
+#define PARTICLE_GROUP_STABLE_IDS 1
+
 // Types -----------------------------------------------------------------------
 
 /** Group of particles and operations to perform on them.
+
+    A group can update less often than its particle system does, by setting
+    an update period greater than 1.  It then runs its operations once every
+    that many frames, with a time step spanning all of them, so that
+    expensive groups (e.g. vortons) can run at a lower rate than cheap
+    ones (e.g. tracers) that need to move smoothly every frame.
+
+    \see SetUpdatePeriod, GetUpdatePeriodFraction
 */
 class ParticleGroup
 {
@@ -23,11 +41,52 @@ class ParticleGroup
         typedef PclOpContainer::Iterator        Iterator ;
         typedef PclOpContainer::ConstIterator   ConstIterator ;
 
-        ParticleGroup() {}
+        ParticleGroup()
+            : mUpdatePeriod( 1 )
+            , mNumFramesPending( 0 )
+            , mTimePending( 0.0f )
+        {}
         ~ParticleGroup() ;
         ParticleGroup( const ParticleGroup & that ) ;
         ParticleGroup & operator=( const ParticleGroup & that ) ;
 
+        /// Exchange contents of this group with another, without copying particles or cloning operations.
+        void Swap( ParticleGroup & that )
+        {
+            mParticles.swap( that.mParticles ) ;
+            mParticleOps.swap( that.mParticleOps ) ;
+        #if PARTICLE_GROUP_STABLE_IDS
+            mIdMap.Swap( that.mIdMap ) ;
+        #endif
+            std::swap( mUpdatePeriod , that.mUpdatePeriod ) ;
+            std::swap( mNumFramesPending , that.mNumFramesPending ) ;
+            std::swap( mTimePending , that.mTimePending ) ;
+        }
+
+    #if defined( HAVE_RVALUE_REFS )
+
+        // Move support
+
+        ParticleGroup( ParticleGroup && that )
+            : mUpdatePeriod( 1 )
+            , mNumFramesPending( 0 )
+            , mTimePending( 0.0f )
+        {
+            Swap( that ) ;
+        }
+
+        ParticleGroup & operator=( ParticleGroup && that )
+        {
+            if( this != & that )
+            {   // Not self-move.
+                Clear() ;
+                Swap( that ) ;
+            }
+            return * this ;
+        }
+
+    #endif
+
         /// Add given ParticleOperation to the end of the current list of them.
         void PushBack( IParticleOperation * pclOp )
         {
@@ -36,6 +95,29 @@ class ParticleGroup
 
         size_t GetNumParticles() const { return mParticles.Size() ; }
 
+        /// Return number of bytes the particles of this group occupy, including memory retained for reuse.  See MemoryBudget.
+        size_t GetMemoryUsage() const
+        {
+            size_t numBytes = mParticles.Capacity() * sizeof( Particle ) ;
+        #if PARTICLE_GROUP_STABLE_IDS
+            numBytes += mIdMap.GetMemoryUsage() ;
+        #endif
+            return numBytes ;
+        }
+
+        /** Release memory the particle array retains for reuse beyond a quarter more than its population.
+
+            Killing particles does not shrink the array, so without this, usage reflects the largest population the group ever had.
+        */
+        void TrimMemory()
+        {
+            const size_t numParticles = mParticles.Size() ;
+            if( mParticles.Capacity() > numParticles + numParticles / 4 )
+            {   // Array retains more than headroom.  Copy particles into an array with exactly enough capacity.
+                VECTOR< Particle >( mParticles ).swap( mParticles ) ;
+            }
+        }
+
         bool HasParticles() const { return ! mParticles.Empty() ; }
 
         bool HasOperations() const { return mParticleOps.Empty() ; }
@@ -46,18 +128,50 @@ class ParticleGroup
         void Clear() ;
         void Update( float timeStep , unsigned uFrame ) ;
 
+        void SetUpdatePeriod( unsigned numFramesPerUpdate ) ;
+
+        /// Return number of frames per update of this group.
+        unsigned GetUpdatePeriod() const { return mUpdatePeriod ; }
+
+        /** Return fraction of this group's update period that will have elapsed when this group finishes its Update call for the current frame.
+
+            This is meant for groups that update before this one in the same
+            frame, and that interpolate between results of this group's two
+            most recent updates.  It is 1 on frames when this group will run
+            its operations, and 1/GetUpdatePeriod on frames just after.
+        */
+        float GetUpdatePeriodFraction() const { return float( mNumFramesPending + 1 ) / float( mUpdatePeriod ) ; }
+
               VECTOR< Particle > & GetParticles()       { return mParticles ; }
         const VECTOR< Particle > & GetParticles() const { return mParticles ; }
 
+    #if PARTICLE_GROUP_STABLE_IDS
+        /// Return map from particle identifier to slot, as of the end of the most recent Update that ran operations.
+        const ParticleIdMap & GetIdMap() const { return mIdMap ; }
+    #endif
+
         IParticleOperation * GetOperation( size_t pclOpIdx ) const { return mParticleOps[ pclOpIdx ] ; }
 
         size_t  IndexOfOperation( IParticleOperation * pclOpAddress ) const ;
 
+        const ParticleChunkBounds * GetChunkBounds() const ;
+
+        ParticleAttributeMask GetAttributesUsed() const ;
+
         static const size_t INVALID_INDEX = static_cast< size_t >( -1 ) ;
 
     private:
+        void OperateFused( size_t iOpBegin , size_t iOpEnd , float timeStep , unsigned uFrame ) ;
+        void OperateFusedSlice( size_t iOpBegin , size_t iOpEnd , float timeStep , unsigned uFrame , size_t chunkBegin , size_t chunkEnd ) ;
+
         VECTOR< Particle >              mParticles      ;   ///< Dynamic array of particles which this group owns and on which all ParticleOperations in this group act.
         VECTOR< IParticleOperation * >  mParticleOps    ;   ///< Dynamic array of particle operations which operate on the particles that this group owns.
+    #if PARTICLE_GROUP_STABLE_IDS
+        ParticleIdMap                   mIdMap          ;   ///< Stable identifiers of mParticles, and their slots.
+    #endif
+        unsigned                        mUpdatePeriod       ;   ///< Number of frames per run of particle operations.
+        unsigned                        mNumFramesPending   ;   ///< Number of frames since operations last ran.
+        float                           mTimePending        ;   ///< Virtual time accumulated since operations last ran, which the next run advances by.
 } ;
 
 // Public variables ------------------------------------------------------------
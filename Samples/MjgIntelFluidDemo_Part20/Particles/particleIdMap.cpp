@@ -0,0 +1,125 @@
+/** \file particleIdMap.cpp
+
+    \brief Stable identities of particles, and map from identity to slot in a particle array.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "particleIdMap.h"
+
+#include "Core/Performance/perfBlock.h"
+
+// Public functions --------------------------------------------------------------
+
+/** Construct a map that has identified no particles.
+*/
+ParticleIdMap::ParticleIdMap()
+    : mSyncStamp( 0 )
+{
+}
+
+
+
+
+/** Forget every identifier, so the next Sync treats every particle as newly arrived.
+*/
+void ParticleIdMap::Clear()
+{
+    mSlotOfId.Clear() ;
+    mSyncOfId.Clear() ;
+    mFreeIds.Clear() ;
+    mBorn.Clear() ;
+    mDied.Clear() ;
+    mUnidentified.Clear() ;
+    mSyncStamp = 0 ;
+}
+
+
+
+
+/** Return an identifier for a particle that lacks one, reusing one of a dead particle if possible.
+*/
+unsigned ParticleIdMap::AllocateId()
+{
+    if( ! mFreeIds.Empty() )
+    {   // Reuse identifier of a particle that died at least one Sync ago.
+        const unsigned id = mFreeIds.Back() ;
+        mFreeIds.PopBack() ;
+        return id ;
+    }
+
+    if( mSlotOfId.Empty() )
+    {   // Reserve INVALID_ID, so no particle gets it.
+        mSlotOfId.PushBack( 0 ) ;
+        mSyncOfId.PushBack( 0 ) ;
+    }
+    const unsigned id = static_cast< unsigned >( mSlotOfId.Size() ) ;
+    mSlotOfId.PushBack( 0 ) ;
+    mSyncOfId.PushBack( 0 ) ;
+    return id ;
+}
+
+
+
+
+/** Identify every particle in the given array, and record its slot.
+
+    \param particles    (in/out) Particles to identify.  This assigns mId of those that lack one.
+
+    Call this once per frame, after whatever kills, emits or reorders
+    particles, and before consumers call GetSlot, GetBorn or GetDied.
+    Slots remain valid until something next moves particles.
+*/
+void ParticleIdMap::Sync( VECTOR< Particle > & particles )
+{
+    PERF_BLOCK( ParticleIdMap__Sync ) ;
+
+    // Identifiers reported dead last Sync have now been seen dead by every consumer, so they can name new particles.
+    for( size_t iDied = 0 ; iDied < mDied.Size() ; ++ iDied )
+    {
+        mFreeIds.PushBack( mDied[ iDied ] ) ;
+    }
+    mBorn.Clear() ;
+    mDied.Clear() ;
+    mUnidentified.Clear() ;
+
+    const unsigned previousStamp = mSyncStamp ;
+    ++ mSyncStamp ;
+
+    const size_t numParticles = particles.Size() ;
+    for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+    {   // For each particle...
+        const unsigned id = particles[ iPcl ].mId ;
+        if(     ( id != INVALID_ID ) && ( id < mSlotOfId.Size() )
+            &&  ( previousStamp != 0 ) && ( mSyncOfId[ id ] == previousStamp ) )
+        {   // Particle had this identifier at the previous Sync, and no earlier slot claimed it this Sync.
+            mSyncOfId[ id ] = mSyncStamp ;
+            mSlotOfId[ id ] = static_cast< unsigned >( iPcl ) ;
+        }
+        else
+        {   // Particle is new, a copy of another, or has an identifier this map did not assign.
+            mUnidentified.PushBack( iPcl ) ;
+        }
+    }
+
+    const unsigned idCapacity = static_cast< unsigned >( mSlotOfId.Size() ) ;
+    for( unsigned id = 1 ; id < idCapacity ; ++ id )
+    {   // For each identifier...
+        if( ( previousStamp != 0 ) && ( mSyncOfId[ id ] == previousStamp ) )
+        {   // Identifier lived at previous Sync, but no particle has it now.
+            mDied.PushBack( id ) ;
+        }
+    }
+
+    for( size_t iUnidentified = 0 ; iUnidentified < mUnidentified.Size() ; ++ iUnidentified )
+    {   // For each particle that needs an identifier...
+        const size_t    iPcl    = mUnidentified[ iUnidentified ] ;
+        const unsigned  id      = AllocateId() ;
+        particles[ iPcl ].mId   = id ;
+        mSyncOfId[ id ]         = mSyncStamp ;
+        mSlotOfId[ id ]         = static_cast< unsigned >( iPcl ) ;
+        mBorn.PushBack( id ) ;
+    }
+}
@@ -0,0 +1,103 @@
+/** \file particleIdMap.h
+
+    \brief Stable identities of particles, and map from identity to slot in a particle array.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_ID_MAP_H
+#define PARTICLE_ID_MAP_H
+
+#include "Core/Containers/vector.h"
+
+#include <algorithm>
+
+#include "Particles/particle.h"
+
+// Types --------------------------------------------------------------
+
+/** Stable identities of particles, and map from identity to slot in a particle array.
+
+    Particles::Kill, KillIf and sorting move particles between slots, so a
+    slot index does not identify a particle from one frame to the next.
+    Each Particle therefore carries an identifier, mId, which travels with it
+    when it moves.  Sync assigns identifiers to particles that lack one (e.g.
+    newly emitted), records the slot of every identifier, and lists which
+    identifiers appeared and disappeared since the previous Sync.  Consumers
+    that keep per-particle state across frames (e.g. sort order, LOD
+    decisions, network or export deltas) key that state by identifier, then
+    use GetSlot to find the particle, and GetBorn and GetDied to update
+    incrementally instead of rebuilding.
+
+    Identifiers stay small and dense, so the map is a plain array rather than
+    a hash table.  Sync recycles identifiers of dead particles, but only one
+    Sync after reporting them in GetDied, so consumers always see a death
+    before its identifier names another particle.
+
+    A particle copied from another (e.g. a prototype with an identifier)
+    shares its identifier; Sync keeps it for the first slot that has it and
+    assigns a fresh one to the others.  Identifiers this map never assigned,
+    e.g. from a checkpoint, also get fresh ones.
+*/
+class ParticleIdMap
+{
+    public:
+        static const unsigned   INVALID_ID      = 0 ;               ///< Identifier of a particle that no ParticleIdMap has identified.
+        static const size_t     INVALID_SLOT    = ~ size_t( 0 ) ;   ///< Slot GetSlot returns for an identifier of no live particle.
+
+        ParticleIdMap() ;
+
+        void    Sync( VECTOR< Particle > & particles ) ;
+        void    Clear() ;
+
+        /// Exchange contents of this map with another, without copying.
+        void    Swap( ParticleIdMap & that )
+        {
+            mSlotOfId.swap( that.mSlotOfId ) ;
+            mSyncOfId.swap( that.mSyncOfId ) ;
+            mFreeIds.swap( that.mFreeIds ) ;
+            mBorn.swap( that.mBorn ) ;
+            mDied.swap( that.mDied ) ;
+            mUnidentified.swap( that.mUnidentified ) ;
+            std::swap( mSyncStamp , that.mSyncStamp ) ;
+        }
+
+        /// Return slot of particle with given identifier as of the most recent Sync, or INVALID_SLOT if no such particle lived then.
+        size_t  GetSlot( unsigned id ) const
+        {
+            return ( ( id < mSlotOfId.Size() ) && ( mSyncOfId[ id ] == mSyncStamp ) && ( id != INVALID_ID ) ) ? mSlotOfId[ id ] : INVALID_SLOT ;
+        }
+
+        /// Return identifiers that the most recent Sync assigned, i.e. of particles that arrived since the Sync before.
+        const VECTOR< unsigned > &  GetBorn() const     { return mBorn ; }
+
+        /// Return identifiers of particles that lived at the Sync before the most recent one, but not at the most recent one.
+        const VECTOR< unsigned > &  GetDied() const     { return mDied ; }
+
+        /// Return one more than the largest identifier assigned so far, to size arrays indexed by identifier.
+        size_t  GetIdCapacity() const                   { return mSlotOfId.Size() ; }
+
+        /// Return number of bytes this map occupies, including scratch retained for reuse.  See MemoryBudget.
+        size_t  GetMemoryUsage() const
+        {
+            return  ( mSlotOfId.Capacity() + mSyncOfId.Capacity() + mFreeIds.Capacity() + mBorn.Capacity() + mDied.Capacity() ) * sizeof( unsigned )
+                +   mUnidentified.Capacity() * sizeof( size_t ) ;
+        }
+
+    private:
+        unsigned    AllocateId() ;
+
+        VECTOR< unsigned >  mSlotOfId     ;   ///< Per identifier, slot of its particle as of the Sync in mSyncOfId.
+        VECTOR< unsigned >  mSyncOfId     ;   ///< Per identifier, stamp of the most recent Sync at which some particle had it.
+        VECTOR< unsigned >  mFreeIds      ;   ///< Identifiers of particles that died before the previous Sync, available to reassign.
+        VECTOR< unsigned >  mBorn         ;   ///< Identifiers the most recent Sync assigned.
+        VECTOR< unsigned >  mDied         ;   ///< Identifiers the most recent Sync found missing.
+        VECTOR< size_t >    mUnidentified ;   ///< Scratch: slots of particles that need a fresh identifier, during Sync.
+        unsigned            mSyncStamp    ;   ///< Number of calls to Sync since construction or Clear.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
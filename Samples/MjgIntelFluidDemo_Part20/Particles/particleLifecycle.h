@@ -0,0 +1,201 @@
+/** \file particleLifecycle.h
+
+    \brief Batched particle death and birth: parallel stream compaction and bulk emission.
+
+    Particles::Kill removes one particle by moving the last particle into its
+    slot, so killing many particles that way runs serially and reorders the
+    survivors unpredictably.  Instead, Particles::KillIf evaluates a predicate
+    for every particle in parallel, prefix-sums survivor counts per chunk, then
+    copies survivors in parallel into their final slots, preserving their order.
+    Particles::EmitBulk appends many particles at once, into slots it reserves
+    with headroom, so emitters do not grow the array one particle at a time.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_LIFECYCLE_H
+#define PARTICLE_LIFECYCLE_H
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+#include "Particles/particle.h"
+
+// Macros --------------------------------------------------------------
+
+/** Number of particles per chunk that KillIf processes as a unit.
+
+    Each chunk gets one survivor count, so this trades prefix-sum length
+    against parallel slack.  Chunks are fixed, not derived from the number of
+    threads, so results do not depend on the thread count.
+*/
+#define PARTICLE_LIFECYCLE_CHUNK_SIZE 4096
+
+/** Percentage of extra capacity EmitBulk reserves when it must grow a particle array.
+
+    Emitters add particles every frame, so growing to the exact size would
+    reallocate again next frame.
+*/
+#define PARTICLE_LIFECYCLE_EMIT_HEADROOM_PERCENT 25
+
+// Types --------------------------------------------------------------
+
+namespace Particles
+{
+    /** Storage that KillIf reuses across calls, so steady-state compaction makes no heap calls.
+
+        Keep one of these with each particle array that KillIf compacts,
+        e.g. as a member of the particle operation that kills particles.
+    */
+    struct CompactionScratch
+    {
+        VECTOR< Particle >      mSurvivors          ;   ///< Survivors, copied here, then swapped with the particle array.  Afterwards, this holds the previous array, retaining its capacity.
+        VECTOR< unsigned char > mKeep               ;   ///< Per particle, whether it survives.  Lets the copy pass avoid re-evaluating the predicate.
+        VECTOR< size_t >        mChunkFirstSurvivor ;   ///< Per chunk, the number of survivors in it, then (after prefix sum) the index of its first survivor.
+    } ;
+
+
+
+
+    /** Evaluate whether each particle in a range of chunks survives, and count survivors per chunk.
+    */
+    template< class PredicateT > void KillIf_MarkChunks( const VECTOR< Particle > & particles , const PredicateT & shouldKill , CompactionScratch & scratch , size_t iChunkBegin , size_t iChunkEnd )
+    {
+        const size_t numParticles = particles.Size() ;
+        for( size_t iChunk = iChunkBegin ; iChunk < iChunkEnd ; ++ iChunk )
+        {   // For each chunk in the given range...
+            const size_t iPclBegin  = iChunk * PARTICLE_LIFECYCLE_CHUNK_SIZE ;
+            const size_t iPclEnd    = Min2( iPclBegin + PARTICLE_LIFECYCLE_CHUNK_SIZE , numParticles ) ;
+            size_t       numKeep    = 0 ;
+            for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+            {   // For each particle in this chunk...
+                const bool keep = ! shouldKill( particles[ iPcl ] ) ;
+                scratch.mKeep[ iPcl ] = keep ? 1 : 0 ;
+                numKeep += keep ? 1 : 0 ;
+            }
+            scratch.mChunkFirstSurvivor[ iChunk ] = numKeep ;
+        }
+    }
+
+
+
+
+    /** Copy survivors in a range of chunks to their final slots.
+    */
+    inline void KillIf_CopyChunks( const VECTOR< Particle > & particles , CompactionScratch & scratch , size_t iChunkBegin , size_t iChunkEnd )
+    {
+        const size_t numParticles = particles.Size() ;
+        for( size_t iChunk = iChunkBegin ; iChunk < iChunkEnd ; ++ iChunk )
+        {   // For each chunk in the given range...
+            const size_t iPclBegin  = iChunk * PARTICLE_LIFECYCLE_CHUNK_SIZE ;
+            const size_t iPclEnd    = Min2( iPclBegin + PARTICLE_LIFECYCLE_CHUNK_SIZE , numParticles ) ;
+            size_t       iSurvivor  = scratch.mChunkFirstSurvivor[ iChunk ] ;
+            for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+            {   // For each particle in this chunk...
+                if( scratch.mKeep[ iPcl ] )
+                {
+                    scratch.mSurvivors[ iSurvivor ] = particles[ iPcl ] ;
+                    ++ iSurvivor ;
+                }
+            }
+        }
+    }
+
+// Public functions --------------------------------------------------------------
+
+    /** Kill every particle for which the given predicate returns true, preserving the order of survivors.
+
+        \param particles    (in/out) Particles to filter.
+
+        \param shouldKill   Function object with bool operator()( const Particle & ) const.
+                            KillIf calls it exactly once per particle, concurrently from multiple threads.
+
+        \param scratch      Storage to reuse across calls.  See CompactionScratch.
+
+        \return Number of particles killed.
+
+        Unlike repeated Particles::Kill, survivors keep their relative order, so
+        results do not depend on which particles die first, nor on how many
+        threads run.
+    */
+    template< class PredicateT > size_t KillIf( VECTOR< Particle > & particles , const PredicateT & shouldKill , CompactionScratch & scratch )
+    {
+        PERF_BLOCK( Particles__KillIf ) ;
+
+        const size_t numParticles = particles.Size() ;
+        if( 0 == numParticles )
+        {
+            return 0 ;
+        }
+        const size_t numChunks = ( numParticles + PARTICLE_LIFECYCLE_CHUNK_SIZE - 1 ) / PARTICLE_LIFECYCLE_CHUNK_SIZE ;
+
+        scratch.mKeep.Resize( numParticles ) ;
+        scratch.mChunkFirstSurvivor.Resize( numChunks ) ;
+
+        // Evaluate predicate and count survivors per chunk.
+        Parallel::For( 0 , numChunks , 1 , Parallel::Function( KillIf_MarkChunks< PredicateT > , particles , shouldKill , scratch ) ) ;
+
+        // Prefix-sum survivor counts to find where each chunk writes.
+        size_t numSurvivors = 0 ;
+        for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+        {   // For each chunk...
+            const size_t numSurvivorsInChunk = scratch.mChunkFirstSurvivor[ iChunk ] ;
+            scratch.mChunkFirstSurvivor[ iChunk ] = numSurvivors ;
+            numSurvivors += numSurvivorsInChunk ;
+        }
+
+        if( numSurvivors == numParticles )
+        {   // Nothing died, so nothing moves.
+            return 0 ;
+        }
+
+        // Copy survivors into their final slots, then adopt those as the particle array.
+        scratch.mSurvivors.Resize( numSurvivors ) ;
+        Parallel::For( 0 , numChunks , 1 , Parallel::Function( KillIf_CopyChunks , particles , scratch ) ) ;
+        particles.swap( scratch.mSurvivors ) ;
+
+        return numParticles - numSurvivors ;
+    }
+
+
+
+
+    /** Append the given number of copies of a prototype particle, and return the index of the first.
+
+        Callers then fill in slots [returned index, particles.Size()) directly,
+        instead of calling PushBack once per particle.
+
+        When the array lacks capacity, this reserves extra, so emission on
+        subsequent frames does not reallocate.
+
+        \param minHeadroom  Minimum number of slots to reserve beyond those
+                            this call fills, when it must grow the array.
+                            Emitters that know their rate pass what they
+                            expect to emit over the next several frames, so
+                            a small array growing at a steady rate does not
+                            reallocate every few frames.
+    */
+    inline size_t EmitBulk( VECTOR< Particle > & particles , size_t numToEmit , const Particle & prototype , size_t minHeadroom = 0 )
+    {
+        const size_t iFirstNew      = particles.Size() ;
+        const size_t numParticles   = iFirstNew + numToEmit ;
+        if( numParticles > particles.Capacity() )
+        {   // Need more room.
+            const size_t headroom = Max2( minHeadroom , numParticles * PARTICLE_LIFECYCLE_EMIT_HEADROOM_PERCENT / 100 ) ;
+            particles.Reserve( numParticles + headroom ) ;
+        }
+        particles.Resize( numParticles , prototype ) ;
+        return iFirstNew ;
+    }
+
+
+    /// Predicate for KillIf that kills particles marked dead.  See MarkForKill.
+    struct IsMarkedDead
+    {
+        bool operator()( const Particle & pcl ) const { return ! pcl.IsAlive() ; }
+    } ;
+}
+
+#endif
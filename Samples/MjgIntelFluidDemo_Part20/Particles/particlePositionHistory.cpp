@@ -0,0 +1,117 @@
+/** \file particlePositionHistory.cpp
+
+    \brief Ring buffer of recent positions of a sampled subset of particles, for rendering pathlines.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Particles/particlePositionHistory.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include <limits.h>
+
+// Private variables --------------------------------------------------------------
+
+static const int sUnknownBirthTime = INT_MIN ;  ///< Birth time of samples not yet associated with a particle.
+
+// Public functions --------------------------------------------------------------
+
+/** Set number of particle slots per sample, and forget all history, since samples would track different particles.
+
+    \param samplePeriod     Record history of every samplePeriod'th particle.  Must be positive.  1 records every particle.
+*/
+void ParticlePositionHistory::SetSamplePeriod( size_t samplePeriod )
+{
+    ASSERT( samplePeriod > 0 ) ;
+    mSamplePeriod = samplePeriod ;
+    Clear() ;
+}
+
+
+
+
+/** Forget all history.
+*/
+void ParticlePositionHistory::Clear()
+{
+    mNumSamples         = 0 ;
+    mNextHistoryIndex   = 0 ;
+    mPositions.Clear() ;
+    mBirthTimes.Clear() ;
+}
+
+
+
+
+/** Record current position of each sampled particle.
+
+    \param particles    Particles whose slots this samples.  The number of
+                        particles can change between calls; samples for new
+                        slots start with empty history, and samples for
+                        vanished slots get discarded.
+*/
+void ParticlePositionHistory::Record( const VECTOR< Particle > & particles )
+{
+    PERF_BLOCK( ParticlePositionHistory__Record ) ;
+
+    const size_t numSamples = ( particles.Size() + mSamplePeriod - 1 ) / mSamplePeriod ;
+    if( numSamples != mNumSamples )
+    {   // Population changed enough to change number of samples.
+        ResizeSamples( numSamples ) ;
+    }
+
+    Vec3 * row = mPositions.Empty() ? NULLPTR : & mPositions[ mNextHistoryIndex * mNumSamples ] ;
+    for( size_t iSample = 0 ; iSample < mNumSamples ; ++ iSample )
+    {   // For each sample...
+        const Particle & pcl = particles[ GetParticleIndex( iSample ) ] ;
+        if( pcl.mBirthTime != mBirthTimes[ iSample ] )
+        {   // Slot holds a different particle than it did last time.
+            RestartSample( iSample ) ;
+            mBirthTimes[ iSample ] = pcl.mBirthTime ;
+        }
+        row[ iSample ] = pcl.mPosition ;
+    }
+
+    mNextHistoryIndex = NextHistoryIndex( mNextHistoryIndex ) ;
+}
+
+
+
+
+/** Change number of samples, retaining history of samples that remain.
+*/
+void ParticlePositionHistory::ResizeSamples( size_t numSamples )
+{
+    const Vec3      nan( Particle::sNaN , Particle::sNaN , Particle::sNaN ) ;
+    const size_t    numRetained = Min2( numSamples , mNumSamples ) ;
+
+    VECTOR< Vec3 > positions( NUM_HISTORICAL_POSITIONS * numSamples , nan ) ;
+    for( size_t iHistory = 0 ; iHistory < NUM_HISTORICAL_POSITIONS ; ++ iHistory )
+    {   // For each historical row...
+        for( size_t iSample = 0 ; iSample < numRetained ; ++ iSample )
+        {   // For each sample that remains...
+            positions[ iHistory * numSamples + iSample ] = mPositions[ iHistory * mNumSamples + iSample ] ;
+        }
+    }
+    mPositions.swap( positions ) ;
+
+    mBirthTimes.Resize( numSamples , sUnknownBirthTime ) ;
+    mNumSamples = numSamples ;
+}
+
+
+
+
+/** Forget history of the given sample.
+*/
+void ParticlePositionHistory::RestartSample( size_t iSample )
+{
+    const Vec3 nan( Particle::sNaN , Particle::sNaN , Particle::sNaN ) ;
+    for( size_t iHistory = 0 ; iHistory < NUM_HISTORICAL_POSITIONS ; ++ iHistory )
+    {   // For each historical row...
+        mPositions[ iHistory * mNumSamples + iSample ] = nan ;
+    }
+}
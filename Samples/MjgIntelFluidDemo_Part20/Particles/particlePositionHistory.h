@@ -0,0 +1,95 @@
+/** \file particlePositionHistory.h
+
+    \brief Ring buffer of recent positions of a sampled subset of particles, for rendering pathlines.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef PARTICLE_POSITION_HISTORY_H
+#define PARTICLE_POSITION_HISTORY_H
+
+#include "Core/Containers/vector.h"
+#include "Core/Math/vec3.h"
+
+#include "Particles/particle.h"
+
+// Types --------------------------------------------------------------
+
+/** Ring buffer of recent positions of a sampled subset of particles, for rendering pathlines.
+
+    This records the history of every GetSamplePeriod'th particle slot,
+    rather than of every particle, and keeps it outside Particle, so
+    enabling pathlines neither bloats the particle record nor costs time
+    proportional to the number of particles.
+
+    All samples record together, once per Record call, so they share one
+    ring buffer index.  Positions are laid out as a structure of arrays:
+    each historical step occupies a contiguous row of GetNumSamples
+    positions, so Record writes one contiguous row, and renderers can
+    read rows directly.
+
+    Samples track particle slots, not particle identities, so when a slot
+    comes to hold a different particle (e.g. after killing or sorting), its
+    pathline would jump.  Record detects that from a change in birth time,
+    and restarts the history of that sample.  Particles with equal birth
+    times can still trade slots undetected, which merely draws one short
+    spurious segment.
+*/
+class ParticlePositionHistory
+{
+    public:
+        static const size_t NUM_HISTORICAL_POSITIONS = 32 ;     ///< Number of positions each sample remembers.
+
+        ParticlePositionHistory()
+            : mSamplePeriod( 16 )
+            , mNumSamples( 0 )
+            , mNextHistoryIndex( 0 )
+        {}
+
+        void    SetSamplePeriod( size_t samplePeriod ) ;
+
+        /// Return number of particle slots per sample.
+        size_t  GetSamplePeriod() const { return mSamplePeriod ; }
+
+        /// Return number of particles whose history this records.
+        size_t  GetNumSamples() const   { return mNumSamples ; }
+
+        /// Return index of particle that the given sample tracks.
+        size_t  GetParticleIndex( size_t iSample ) const { return iSample * mSamplePeriod ; }
+
+        /// Return index, into ring buffer, of the given history index's successor.
+        static size_t NextHistoryIndex( size_t iHistory )
+        {
+            return iHistory >= NUM_HISTORICAL_POSITIONS - 1 ? 0 : iHistory + 1 ;
+        }
+
+        /// Return index of first (oldest) element in position history.
+        size_t  HistoryBegin() const    { return mNextHistoryIndex ; }
+
+        /// Return index of last (newest) element in position history.
+        size_t  HistoryEnd() const      { return 0 == mNextHistoryIndex ? NUM_HISTORICAL_POSITIONS - 1 : mNextHistoryIndex - 1 ; }
+
+        /// Return position of the given sample at the given historical index, which has NaN components if the sample has no position there yet.
+        const Vec3 & GetPosition( size_t iHistory , size_t iSample ) const
+        {
+            ASSERT( iHistory < NUM_HISTORICAL_POSITIONS ) ;
+            ASSERT( iSample < mNumSamples ) ;
+            return mPositions[ iHistory * mNumSamples + iSample ] ;
+        }
+
+        void    Record( const VECTOR< Particle > & particles ) ;
+        void    Clear() ;
+
+    private:
+        void    ResizeSamples( size_t numSamples ) ;
+        void    RestartSample( size_t iSample ) ;
+
+        size_t          mSamplePeriod       ;   ///< Number of particle slots per sample.  Sample i tracks particle i * mSamplePeriod.
+        size_t          mNumSamples         ;   ///< Number of particles whose history this records.
+        size_t          mNextHistoryIndex   ;   ///< Index into ring buffer of next position to record.
+        VECTOR< Vec3 >  mPositions          ;   ///< NUM_HISTORICAL_POSITIONS rows of mNumSamples positions each.
+        VECTOR< int >   mBirthTimes         ;   ///< Birth time of particle each sample tracks, to detect when its slot holds a different particle.
+} ;
+
+#endif
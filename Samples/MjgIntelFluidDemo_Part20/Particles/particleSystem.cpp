@@ -10,10 +10,31 @@
 #include "particleSystem.h"
 
 #include <Core/Performance/perfBlock.h>
+#include <Core/parallelExecution.h>
 
 // Macros --------------------------------------------------------------
 // Types --------------------------------------------------------------
 
+/** Task graph node that updates one particle group.
+*/
+class ParticleSystem_UpdateGroup_Task : public Parallel::Task
+{
+        ParticleGroup * mParticleGroup  ;   ///< Group to update.
+        float           mTimeStep       ;   ///< Duration of update.
+        unsigned        mFrame          ;   ///< Frame counter.
+    public:
+        virtual void Run()
+        {
+            mParticleGroup->Update( mTimeStep , mFrame ) ;
+        }
+        ParticleSystem_UpdateGroup_Task( ParticleGroup * particleGroup , float timeStep , unsigned uFrame )
+            : mParticleGroup( particleGroup )
+            , mTimeStep( timeStep )
+            , mFrame( uFrame )
+        {
+        }
+} ;
+
 ParticleSystem::~ParticleSystem()
 {
     Clear() ;
@@ -35,6 +56,7 @@ ParticleSystem & ParticleSystem::operator=( const ParticleSystem & that )
     if( this != & that )
     {   // Not self-copy.
         Clear() ;   // Delete all previous items in this object.
+        mGroupDependencies = that.mGroupDependencies ; // Groups get duplicated in order, so indices still apply.
         for( ConstIterator pclGrpIter = that.mParticleGroups.Begin() ; pclGrpIter != that.mParticleGroups.End() ; ++ pclGrpIter )
         {   // For each particle group in the original system...
             ParticleGroup * pclGrpOrig = * pclGrpIter ;
@@ -60,12 +82,18 @@ void ParticleSystem::Clear()
         particleGroup->Clear() ;
         mParticleGroups.PopBack() ;
     }
+    mAssignments.Clear() ;          // Assignments bind addresses in groups just removed.
+    mGroupDependencies.Clear() ;
 }
 
 
 
 
 /** Process all particle groups in this system.
+
+    Each group updates after every group it depends on, and groups with no
+    dependency path between them update concurrently.  See class comment.
+
     \see ParticleGroup
 */
 void ParticleSystem::Update( float timeStep , unsigned uFrame )
@@ -73,11 +101,47 @@ void ParticleSystem::Update( float timeStep , unsigned uFrame )
     PERF_BLOCK( ParticleSystem__Update ) ;
 
     const size_t numParticleGroups = mParticleGroups.Size() ;
+    if( numParticleGroups < 2 )
+    {   // Nothing could run concurrently, so skip building a graph.
+        for( size_t iPclGrp = 0 ; iPclGrp < numParticleGroups ; ++ iPclGrp )
+        {   // Run through groups in order.
+            ParticleGroup * particleGroup = mParticleGroups[ iPclGrp ] ;
+            particleGroup->Update( timeStep , uFrame ) ;
+        }
+        return ;
+    }
+
+    VECTOR< ParticleSystem_UpdateGroup_Task > tasks ;
+    tasks.Reserve( numParticleGroups ) ;    // Graph refers to tasks by address, so they must not move.
+    Parallel::TaskGraph groupGraph ;
     for( size_t iPclGrp = 0 ; iPclGrp < numParticleGroups ; ++ iPclGrp )
-    {   // Run through groups in order.
-        ParticleGroup * particleGroup = mParticleGroups[ iPclGrp ] ;
-        particleGroup->Update( timeStep , uFrame ) ;
+    {   // For each group, add a node, in order, so node ids match group indices.
+        tasks.PushBack( ParticleSystem_UpdateGroup_Task( mParticleGroups[ iPclGrp ] , timeStep , uFrame ) ) ;
+        groupGraph.AddNode( tasks.Back() ) ;
+    }
+    const size_t numDependencies = mGroupDependencies.Size() ;
+    for( size_t iDependency = 0 ; iDependency < numDependencies ; ++ iDependency )
+    {   // For each dependency between groups...
+        const GroupDependency & dependency = mGroupDependencies[ iDependency ] ;
+        groupGraph.AddEdge( Parallel::TaskGraph::NodeId( dependency.mPredecessorIndex ) , Parallel::TaskGraph::NodeId( dependency.mSuccessorIndex ) ) ;
     }
+    groupGraph.Run() ;
+}
+
+
+
+
+/** Return total number of particles in all groups of this system.
+*/
+size_t ParticleSystem::GetNumParticles() const
+{
+    size_t numParticles = 0 ;
+    const size_t numParticleGroups = mParticleGroups.Size() ;
+    for( size_t iPclGrp = 0 ; iPclGrp < numParticleGroups ; ++ iPclGrp )
+    {   // For each group in this system...
+        numParticles += mParticleGroups[ iPclGrp ]->GetNumParticles() ;
+    }
+    return numParticles ;
 }
 
 
@@ -109,6 +173,7 @@ void ParticleSystem::AddIndirectPodAssignment( const IndirectAddress & dst , con
     IndirectPodAssignment ipa( dst , src , sizeInBytes ) ;
     ipa.Assign() ;
     mAssignments.PushBack( ipa ) ;
+    AddAssignmentDependency( ipa ) ;
 }
 
 
@@ -121,15 +186,72 @@ void ParticleSystem::AddIndirectAddressAssignment( const IndirectAddress & dst ,
     IndirectPodAssignment iaa( dst , src ) ;
     iaa.Assign() ;
     mAssignments.PushBack( iaa ) ;
+    AddAssignmentDependency( iaa ) ;
+}
 
-#if _DEBUG
+
+
+
+/** Require the given groups, both already in this system, to update in the order they were added.
+
+    Use this when groups share data other than through indirect assignments,
+    for example when an operation in one group holds a pointer, assigned
+    directly, to data that an operation in the other group writes.
+    Otherwise Update might run them concurrently.
+*/
+void ParticleSystem::AddGroupDependency( ParticleGroup * predecessor , ParticleGroup * successor )
+{
+    const size_t predecessorIndex = FindIndexOfGroup( predecessor ) ;
+    const size_t successorIndex   = FindIndexOfGroup( successor   ) ;
+    ASSERT( predecessorIndex < successorIndex ) ;   // Predecessor must precede successor, so running groups in order respects dependencies.
+    ASSERT( successorIndex < mParticleGroups.Size() ) ;
+    AddGroupDependency( predecessorIndex , successorIndex ) ;
+}
+
+
+
+
+/** Require the groups at the given indices to update in the order they were added, unless they are the same group.
+*/
+void ParticleSystem::AddGroupDependency( size_t groupIndexA , size_t groupIndexB )
+{
+    if( groupIndexA == groupIndexB )
+    {   // Operations within a group already run in order.
+        return ;
+    }
+    GroupDependency dependency ;
+    dependency.mPredecessorIndex    = Min2( groupIndexA , groupIndexB ) ;
+    dependency.mSuccessorIndex      = Max2( groupIndexA , groupIndexB ) ;
+    const size_t numDependencies = mGroupDependencies.Size() ;
+    for( size_t iDependency = 0 ; iDependency < numDependencies ; ++ iDependency )
+    {   // For each existing dependency...
+        if(     ( mGroupDependencies[ iDependency ].mPredecessorIndex == dependency.mPredecessorIndex )
+            &&  ( mGroupDependencies[ iDependency ].mSuccessorIndex   == dependency.mSuccessorIndex   ) )
+        {   // Already have this dependency.
+            return ;
+        }
+    }
+    mGroupDependencies.PushBack( dependency ) ;
+}
+
+
+
+
+/** Make the groups that the given assignment binds update in order.
+
+    An assignment lets one group read data that another group writes, so
+    those groups must not update concurrently.  The group added first
+    updates first, as it would without concurrency.
+*/
+void ParticleSystem::AddAssignmentDependency( const IndirectPodAssignment & assignment )
+{
+    ReferenceIndex refIdxDst ;
+    ReferenceIndex refIdxSrc ;
+    if(     FindReferent( refIdxDst , assignment.GetDstBinding().GetBaseAddress() )
+        &&  FindReferent( refIdxSrc , assignment.GetSrcBinding().GetBaseAddress() ) )
     {
-        IndirectPodAssignment & ipa = mAssignments.Back() ;
-        ReferenceIndex refIdxDummy ;
-        FindReferent( refIdxDummy , ipa.GetDstBinding().GetBaseAddress() ) ;
-        FindReferent( refIdxDummy , ipa.GetSrcBinding().GetBaseAddress() ) ;
+        AddGroupDependency( refIdxDst.mGroupIndex , refIdxSrc.mGroupIndex ) ;
     }
-#endif
 }
 
 
@@ -132,6 +132,12 @@ class IndirectPodAssignment
     contains multiple ParticleOperations and a Particle array.
 
     The ParticleSystemManager manages multiple ParticleSystems.
+
+    Update runs groups that do not depend on each other concurrently.  A
+    group depends on an earlier group when an indirect assignment binds data
+    in one to data in the other, or when AddGroupDependency says so.  Groups
+    that share data some other way, for example through pointers assigned
+    directly, must declare that with AddGroupDependency.
 */
 class ParticleSystem
 {
@@ -145,6 +151,39 @@ class ParticleSystem
         ParticleSystem( const ParticleSystem & that ) ;
         ParticleSystem & operator=( const ParticleSystem & that ) ;
 
+        /** Exchange contents of this system with another, without duplicating groups.
+
+            Indirect assignments refer to groups by address, and groups live
+            on the heap, so bindings remain valid after a swap.
+        */
+        void Swap( ParticleSystem & that )
+        {
+            mParticleGroups.swap( that.mParticleGroups ) ;
+            mAssignments.swap( that.mAssignments ) ;
+            mGroupDependencies.swap( that.mGroupDependencies ) ;
+        }
+
+    #if defined( HAVE_RVALUE_REFS )
+
+        // Move support
+
+        ParticleSystem( ParticleSystem && that )
+        {
+            Swap( that ) ;
+        }
+
+        ParticleSystem & operator=( ParticleSystem && that )
+        {
+            if( this != & that )
+            {   // Not self-move.
+                Clear() ;
+                Swap( that ) ;
+            }
+            return * this ;
+        }
+
+    #endif
+
         /// Add given ParticleGroup to the end of the current list of them.
         void PushBack( ParticleGroup * pclGrp )
         {
@@ -161,6 +200,7 @@ class ParticleSystem
         const ParticleGroup * GetGroup( size_t groupIndex ) const   { return mParticleGroups[ groupIndex ] ; }
 
         size_t GetNumGroups() const { return mParticleGroups.Size() ; }
+        size_t GetNumParticles() const ;
         size_t FindIndexOfGroup( ParticleGroup * soughtGroup ) ;
 
         void Clear() ;
@@ -169,6 +209,8 @@ class ParticleSystem
         void AddIndirectPodAssignment( const IndirectAddress & dst , const IndirectAddress & src , size_t sizeInBytes ) ;
         void AddIndirectAddressAssignment( const IndirectAddress & dst , const IndirectAddress & src ) ;
 
+        void AddGroupDependency( ParticleGroup * predecessor , ParticleGroup * successor ) ;
+
     private:
         struct ReferenceIndex
         {
@@ -176,17 +218,28 @@ class ParticleSystem
             size_t  mOperationIndex ;
         } ;
 
+        /// Requirement that one group finish updating before another starts.
+        struct GroupDependency
+        {
+            size_t  mPredecessorIndex   ;   ///< Index of group that updates first.
+            size_t  mSuccessorIndex     ;   ///< Index of group that updates after predecessor.
+        } ;
+
         static const size_t INDEX_PARENT = static_cast< size_t >( -1 ) /* Really ~0 but size depends on architecture. */ ;
 
         bool    FindReferent( ReferenceIndex & refIdx , void * referentAddress ) const ;
         void *  Dereference( const ReferenceIndex & refIdx ) const ;
 
         void    CopyAssignments( const ParticleSystem & that ) ;
+        void    AddGroupDependency( size_t groupIndexA , size_t groupIndexB ) ;
+        void    AddAssignmentDependency( const IndirectPodAssignment & assignment ) ;
 
         typedef VECTOR< IndirectPodAssignment > AssignmentContainer ;
+        typedef VECTOR< GroupDependency >       DependencyContainer ;
 
-        PclGrpContainer     mParticleGroups ;   ///< Dynamic array of ParticleGroup objects that this ParticleSystem owns.
-        AssignmentContainer mAssignments    ;   ///< Data value assignments to perform.
+        PclGrpContainer     mParticleGroups     ;   ///< Dynamic array of ParticleGroup objects that this ParticleSystem owns.
+        AssignmentContainer mAssignments        ;   ///< Data value assignments to perform.
+        DependencyContainer mGroupDependencies  ;   ///< Pairs of groups that must update in order.  Groups with no path between them update concurrently.
 } ;
 
 // Public variables --------------------------------------------------------------
@@ -11,10 +11,43 @@
 #include "particleSystemManager.h"
 
 #include <Core/Performance/perfBlock.h>
+#include <Core/Math/math.h>
+#include <Core/parallelExecution.h>
 
 // Macros --------------------------------------------------------------
 // Types --------------------------------------------------------------
 
+/** Function object to update small particle systems concurrently, one system per thread.
+*/
+class ParticleSystemManager_UpdateSmallSystems
+{
+        ParticleSystemManager::PclSysContainer &    mSystems    ;   ///< Small systems to update.
+        float                                       mTimeStep   ;   ///< Duration of update.
+        unsigned                                    mFrame      ;   ///< Frame counter.
+    public:
+        void operator() ( const Parallel::Range & r ) const
+        {   // Update a subset of systems.
+            SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
+            SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
+            Parallel::SerialScope serialScope ; // Each system is too small to benefit from parallel loops of its own.
+            for( size_t iSystem = r.begin() ; iSystem < r.end() ; ++ iSystem )
+            {   // For each system in this subset...
+                mSystems[ iSystem ]->Update( mTimeStep , mFrame ) ;
+            }
+        }
+        ParticleSystemManager_UpdateSmallSystems( ParticleSystemManager::PclSysContainer & systems , float timeStep , unsigned uFrame )
+            : mSystems( systems )
+            , mTimeStep( timeStep )
+            , mFrame( uFrame )
+        {
+            mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
+            mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
+        }
+    private:
+        WORD        mMasterThreadFloatingPointControlWord   ;
+        unsigned    mMasterThreadMmxControlStatusRegister   ;
+} ;
+
 ParticleSystemManager::~ParticleSystemManager()
 {
     Clear() ;
@@ -24,6 +57,7 @@ ParticleSystemManager::~ParticleSystemManager()
 
 
 ParticleSystemManager::ParticleSystemManager( const ParticleSystemManager & that )
+    : mSmallSystemNumParticlesMax( that.mSmallSystemNumParticlesMax )
 {
     this->operator=( that ) ;
 }
@@ -36,6 +70,7 @@ ParticleSystemManager & ParticleSystemManager::operator=( const ParticleSystemMa
     if( this != & that )
     {   // Not self-copy.
         Clear() ;   // Delete all previous items in this object.
+        mSmallSystemNumParticlesMax = that.mSmallSystemNumParticlesMax ;
         for( ConstIterator pclSysIter = that.mParticleSystems.Begin() ; pclSysIter != that.mParticleSystems.End() ; ++ pclSysIter )
         {   // For each particle system in the original manager...
             ParticleSystem * pclSysOrig = * pclSysIter ;
@@ -65,14 +100,43 @@ void ParticleSystemManager::Clear()
 
 
 /** Process all particle systems this manager owns.
+
+    Small systems update concurrently with each other, before large systems,
+    which update one at a time, in order.  See class comment.
+
     \see ParticleSystem
 */
 void ParticleSystemManager::Update( float timeStep , unsigned uFrame )
 {
     PERF_BLOCK( ParticleSystemManager__Update ) ;
 
+    // Classify systems by size before updating any, since updating changes their sizes.
+    mSmallSystems.Clear() ;
+    mLargeSystems.Clear() ;
     for( Iterator pclSysIter = mParticleSystems.Begin() ; pclSysIter != mParticleSystems.End() ; ++ pclSysIter )
-    {
+    {   // For each particle system...
+        ParticleSystem * pclSys = * pclSysIter ;
+        if( pclSys->GetNumParticles() <= mSmallSystemNumParticlesMax )
+        {
+            mSmallSystems.PushBack( pclSys ) ;
+        }
+        else
+        {
+            mLargeSystems.PushBack( pclSys ) ;
+        }
+    }
+
+    if( mSmallSystems.Size() > 1 )
+    {   // Multiple small systems, so update them concurrently.
+        Parallel::For( 0 , mSmallSystems.Size() , 1 , ParticleSystemManager_UpdateSmallSystems( mSmallSystems , timeStep , uFrame ) ) ;
+    }
+    else if( ! mSmallSystems.Empty() )
+    {   // Lone small system has nothing to batch with, so let it use all threads.
+        mSmallSystems[ 0 ]->Update( timeStep , uFrame ) ;
+    }
+
+    for( Iterator pclSysIter = mLargeSystems.Begin() ; pclSysIter != mLargeSystems.End() ; ++ pclSysIter )
+    {   // For each large system...
         ParticleSystem * pclSys = * pclSysIter ;
         pclSys->Update( timeStep , uFrame ) ;
     }
@@ -21,6 +21,14 @@ class ParticleSystem ;
 /** Container for multiple particle systems.
 
     A ParticleSystemManager contains multiple ParticleSystems.
+
+    Update batches small systems: when several systems each have no more
+    particles than GetSmallSystemNumParticlesMax, it updates them
+    concurrently, one system per thread, each inside a Parallel::SerialScope,
+    so their loops do not each pay to schedule parallel work too small to
+    amortize that.  Then it updates each larger system in turn, with all
+    threads.  Systems share no state, so each keeps its own results and
+    statistics either way.
 */
 class ParticleSystemManager
 {
@@ -29,7 +37,10 @@ class ParticleSystemManager
         typedef PclSysContainer::Iterator      Iterator ;
         typedef PclSysContainer::ConstIterator ConstIterator ;
 
-        ParticleSystemManager() {}
+        /// Default largest number of particles a system can have, for Update to batch it with other small systems.
+        static const size_t sDefaultSmallSystemNumParticlesMax = 2048 ;
+
+        ParticleSystemManager() : mSmallSystemNumParticlesMax( sDefaultSmallSystemNumParticlesMax ) {}
         ~ParticleSystemManager() ;
         ParticleSystemManager( const ParticleSystemManager & that ) ;
         ParticleSystemManager & operator=( const ParticleSystemManager & that ) ;
@@ -46,8 +57,15 @@ class ParticleSystemManager
         void Clear() ;
         void Update( float timeStep , unsigned uFrame ) ;
 
+        /// Set largest number of particles a system can have, for Update to batch it with other small systems.  Zero disables batching.
+        void    SetSmallSystemNumParticlesMax( size_t numParticlesMax ) { mSmallSystemNumParticlesMax = numParticlesMax ; }
+        size_t  GetSmallSystemNumParticlesMax() const                   { return mSmallSystemNumParticlesMax ; }
+
     private:
-        PclSysContainer mParticleSystems ;    ///< Dynamic array of ParticleSystem objects that this manager owns.
+        PclSysContainer mParticleSystems            ;   ///< Dynamic array of ParticleSystem objects that this manager owns.
+        size_t          mSmallSystemNumParticlesMax ;   ///< Largest number of particles a system can have, for Update to batch it with other small systems.
+        PclSysContainer mSmallSystems               ;   ///< Systems Update batches.  Member, rather than local, to reuse memory.
+        PclSysContainer mLargeSystems               ;   ///< Systems Update updates one at a time.  Member, rather than local, to reuse memory.
 } ;
 
 // Public variables --------------------------------------------------------------
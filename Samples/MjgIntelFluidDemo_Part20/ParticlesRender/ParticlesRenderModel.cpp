@@ -11,10 +11,14 @@
 #include <Particles/particleSystemManager.h>
 
 #include <Render/Device/api.h>
+#include <Render/Device/gpuTimer.h>
 
 #include <Render/Resource/mesh.h>
+#include <Render/Resource/pass.h>
 #include <Render/Resource/renderState.h>
+#include <Render/Resource/technique.h>
 
+#include <Render/Scene/camera.h>
 #include <Render/Scene/iSceneManager.h>
 #include <Render/Scene/modelData.h>
 #include <Render/Scene/light.h>
@@ -23,6 +27,8 @@
 #include <Render/Platform/OpenGL/OpenGL_vertexBuffer.h>
 #include <Render/Platform/DirectX9/D3D9_vertexBuffer.h>
 
+#include <Core/Math/math.h>
+#include <Core/Memory/streamingStore.h>
 #include <Core/Utility/macros.h>
 #include <Core/Memory/newWrapper.h>
 #include <Core/File/debugPrint.h>
@@ -30,20 +36,26 @@
 #include <d3d9.h>
 #include <d3d9types.h>
 
+#include <algorithm>
+
 // Types -----------------------------------------------------------------------
 
 typedef PeGaSys::Render::OpenGL_VertexBuffer::VertexFormatPositionColor4Texture2 VertexFormatPos3Col4Tex2 ;
+typedef PeGaSys::Render::OpenGL_VertexBuffer::VertexFormatBillboardInstance      VertexFormatBillboard    ;
 
 #if USE_TBB
 
-/** Function object to fill a vertex buffer, using Threading Building Blocks.
+/** Function object to fill vertex buffers of every mesh of every particle group, using Threading Building Blocks.
+
+    The range spans particles of all fill jobs, laid end to end, so a single
+    parallel_for fills every vertex buffer, and small groups share the
+    threads that large groups leave idle.
 */
 class ParticleRenderer_FillVertexBuffer_TBB
 {
-    //QdParticleRenderer * mParticleRenderer ;    ///< Address of QdParticleRenderer object
-    PeGaSys::ParticlesRender::ParticlesRenderModel::IVertexBufferFiller * mVbFiller ;
-    unsigned char       * mVertBytes        ;
-    const ParticleGroup * mParticleGroup    ;
+    const PeGaSys::ParticlesRender::ParticlesRenderModel::VertexFillJobS * mJobs ;   ///< Address of first fill job.
+    const size_t        * mJobStarts        ;   ///< Index, in range, of first particle of each job, followed by total number of particles.
+    size_t                mNumJobs          ;   ///< Number of fill jobs.
     const double        & mTimeNow          ;
     const Mat44         & mViewMatrix       ;
 public:
@@ -51,17 +63,25 @@ public:
     {
         SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
         SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-        (*mVbFiller)( mVertBytes , mParticleGroup , mTimeNow , mViewMatrix , range.begin() , range.end() ) ;
+        // Find job containing first particle of range.
+        size_t iJob = std::upper_bound( mJobStarts , mJobStarts + mNumJobs , range.begin() ) - mJobStarts - 1 ;
+        for( size_t iBegin = range.begin() ; ( iBegin < range.end() ) && ( iJob < mNumJobs ) ; ++ iJob )
+        {   // For each job that overlaps range...
+            const PeGaSys::ParticlesRender::ParticlesRenderModel::VertexFillJobS & job = mJobs[ iJob ] ;
+            const size_t iEnd = Min2( range.end() , mJobStarts[ iJob + 1 ] ) ;
+            (*job.mFiller)( job.mVertBytes , job.mGroup , job.mPclOrder , job.mOpacityScales , mTimeNow , mViewMatrix , iBegin - mJobStarts[ iJob ] , iEnd - mJobStarts[ iJob ] ) ;
+            iBegin = iEnd ;
+        }
     }
 
-    ParticleRenderer_FillVertexBuffer_TBB( PeGaSys::ParticlesRender::ParticlesRenderModel::IVertexBufferFiller * vbFiller
-        , unsigned char * vertBytes
-        , const ParticleGroup * particleGroup
+    ParticleRenderer_FillVertexBuffer_TBB( const PeGaSys::ParticlesRender::ParticlesRenderModel::VertexFillJobS * jobs
+        , const size_t * jobStarts
+        , size_t numJobs
         , const double  & timeNow
         , const Mat44   & viewMatrix )
-        : mVbFiller( vbFiller )
-        , mVertBytes( vertBytes )
-        , mParticleGroup( particleGroup )
+        : mJobs( jobs )
+        , mJobStarts( jobStarts )
+        , mNumJobs( numJobs )
         , mTimeNow( timeNow )
         , mViewMatrix( viewMatrix )
     {
@@ -76,18 +96,6 @@ private:
 #endif
 
 // Private variables -----------------------------------------------------------
-
-static const size_t sPclStride                  = sizeof( Particle )                      ;
-static const size_t sPclOffsetToAngVel          = offsetof( Particle , mAngularVelocity ) ;
-static const size_t sPclOffsetToSize            = offsetof( Particle , mSize            ) ;
-
-static const size_t sPclOffsetToDensity         = offsetof( Particle , mDensity         ) ;
-#if ENABLE_FIRE
-static const size_t sPclOffsetToFuelFraction    = offsetof( Particle , mFuelFraction    ) ;
-static const size_t sPclOffsetToSmokeFraction   = offsetof( Particle , mSmokeFraction   ) ;
-static const size_t sPclOffsetToFlameFraction   = offsetof( Particle , mFlameFraction   ) ;
-#endif
-
 // Public variables ------------------------------------------------------------
 
 namespace PeGaSys
@@ -114,6 +122,32 @@ namespace PeGaSys
         }
 
 
+        /** Return number of vertex buffer elements each particle uses: 1 instance for BILLBOARD_INSTANCE, otherwise 4 quadrilateral vertices.
+        */
+        static inline size_t NumVerticesPerParticle( const VertexBufferBase * vertBuf )
+        {
+            return ( VertexDeclaration::BILLBOARD_INSTANCE == vertBuf->GetVertexDeclaration().GetVertexFormat() ) ? 1 : 4 ;
+        }
+
+
+#if PARTICLES_RENDER_STREAM_VERTICES
+        /** Assign one vertex of a quadrilateral, in a staging record that StreamingStore_Copy later copies into a vertex buffer.
+        */
+        static inline void AssignVertex( VertexFormatPos3Col4Tex2 & vertex , float ts , float tt , unsigned char colorMod , unsigned char alphaMod , const Vec3 & position )
+        {
+            vertex.ts       = ts ;
+            vertex.tt       = tt ;
+            vertex.crgba[0] = colorMod ;
+            vertex.crgba[1] = colorMod ;
+            vertex.crgba[2] = colorMod ;
+            vertex.crgba[3] = alphaMod ;
+            vertex.px       = position.x ;
+            vertex.py       = position.y ;
+            vertex.pz       = position.z ;
+        }
+#endif
+
+
 #       define INDEX(     type , address , offsetInBytes )             reinterpret_cast< type >( reinterpret_cast< char * >( address ) + offsetInBytes )
 
 #       define INCREMENT( type , pointer , strideInBytes ) ( pointer = reinterpret_cast< type >( reinterpret_cast< char * >( pointer ) + strideInBytes ) )
@@ -124,6 +158,10 @@ namespace PeGaSys
 
         /** Assign vertices for particles.
 
+            \param pclOrder     Index of particle to put in each place in vertex buffer, or NULL to use the order of particles in group.
+
+            \param opacityScales    Factor by which to scale opacity (or, for additive particles, brightness) of particle in each place, or NULL for 1.
+
             \param timeNow      Current virtual time.
 
             \param viewMatrix   Matrix describing camera transformation.
@@ -136,6 +174,8 @@ namespace PeGaSys
         void ParticlesRenderModel::VertexBufferFillerGeneric::operator()(
               unsigned char * vertexBytes
             , const ParticleGroup * particleGroup
+            , const unsigned * pclOrder
+            , const float * opacityScales
             , const double & timeNow
             , const struct Mat44 & viewMatrix
             , size_t iPclStart
@@ -152,9 +192,12 @@ namespace PeGaSys
                 return ;
             }
 
-            const VECTOR< Particle > &  particleVector  = particleGroup->GetParticles() ;
-            const Particle *            particleData    = particleVector.Empty() ? NULLPTR : & particleVector[ 0 ] ;
-            const char *                particleBytes   = reinterpret_cast< const char * >( particleData ) ;
+            // Read particle attributes directly from simulation memory.
+            const VECTOR< Particle > &                  particleVector  = particleGroup->GetParticles() ;
+            const ParticleAttributeView< const Vec3 >   positions       = Particles::GetAttributeView< const Vec3  >( particleVector , PARTICLE_ATTRIBUTE_POSITION         ) ;
+            const ParticleAttributeView< const Vec3 >   angVels         = Particles::GetAttributeView< const Vec3  >( particleVector , PARTICLE_ATTRIBUTE_ANGULAR_VELOCITY ) ;
+            const ParticleAttributeView< const float >  sizes           = Particles::GetAttributeView< const float >( particleVector , PARTICLE_ATTRIBUTE_SIZE             ) ;
+            const ParticleAttributeView< const float >  densityInfos    = Particles::GetAttributeView< const float >( particleVector , mDensityInfoAttribute               ) ;
 
             static const unsigned       numVerticesPerParticle = 4 ;
 
@@ -171,32 +214,24 @@ namespace PeGaSys
             const float v0Light         = mUseDensityForTextureCoordinate ? texCoordForPage0of2( 0.01f ) : 0.0f ;
             const float v1Light         = mUseDensityForTextureCoordinate ? texCoordForPage0of2( 0.99f ) : 1.0f ;
 
+        #if PARTICLES_RENDER_STREAM_VERTICES
+            // Stream whole quadrilaterals if vertices have the usual layout, and the vertex buffer is aligned.
+            const bool  streamQuads     = ! mFillBillboardInstances && HasPos3FCol4BTex2FLayout() && StreamingStore_IsAligned( vertexBytes ) ;
+        #endif
+
             // Fill single vertex buffer with "plain" particles without normals
 
             for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
             {   // For each particle in this slice...
-#           if SORT_PARTICLES
-                const char *    pPos            = particleBytes + mIndices[ iPcl ].mPcl * mPclStride ;
-#           else
-                const char *    pPos            = particleBytes + iPcl * mPclStride ;
-#           endif
-                const Vec3  &   pclPos          = * ( (Vec3*) pPos ) ;
-                const char *    pSize           = pPos + mOffsetToSize ;
-                const char *    pAngVel         = pPos + mOffsetToAngVel ;
-                const char *    pDensityInfo    = pPos + mOffsetToDensityInfo ;
-                const Vec3  &   pclAngVel       = * ( (Vec3*) pAngVel ) ;
+                const size_t    iPclSrc         = pclOrder ? pclOrder[ iPcl ] : iPcl ;
+                const Vec3  &   pclPos          = positions[ iPclSrc ] ;
+                const Vec3  &   pclAngVel       = angVels[ iPclSrc ] ;
                 const float     pclAngle        = ( pclAngVel * static_cast< float >( timeNow ) ).Magnitude() ;
-                const float     sinAngle        = sin( pclAngle ) ;
-                const float     cosAngle        = cos( pclAngle ) ;
-                const float     rHalfSize       = mScale* * ( (float*) pSize ) * 0.5f ;
-                Vec3            pclRight        = (   viewRight * cosAngle + viewUp * sinAngle ) * rHalfSize ;
-                Vec3            pclUp           = ( - viewRight * sinAngle + viewUp * cosAngle ) * rHalfSize ;
-                const float     rDensityInfo    = * ( (float*) pDensityInfo ) ;
+                const float     rHalfSize       = mScale * sizes[ iPclSrc ] * 0.5f ;
+                const float     rDensityInfo    = densityInfos[ iPclSrc ] ;
 
                 ASSERT( ! IsNan( pclPos       ) ) ;
                 ASSERT( ! IsNan( pclAngVel    ) ) ;
-                ASSERT( ! IsNan( pclRight     ) ) ;
-                ASSERT( ! IsNan( pclUp        ) ) ;
                 ASSERT( ! IsNan( rDensityInfo ) ) ;
 
                 // Assign positions and texture coordinates for each vertex of the quadrilateral.
@@ -209,16 +244,55 @@ namespace PeGaSys
                 unsigned char alphaMod = 255 ;
 
                 const float massFraction = mUseDensityForTextureCoordinate ? fabsf( rDensityInfo - 1.0f ) : fabsf( rDensityInfo ) ;
+                const float visibility   = opacityScales ? mDensityVisibility * opacityScales[ iPcl ] : mDensityVisibility ;
                 if( BLEND_MODE_ADDITIVE == mBlendMode )
                 {   // These are luminous particles.  Vary brightness (not opacity).
-                    colorMod = (unsigned char) Min2( 255.0f , massFraction * mDensityVisibility ) ;
+                    colorMod = (unsigned char) Min2( 255.0f , massFraction * visibility ) ;
                 }
                 else
                 {   // These are translucent particles.  Vary opacity (not color).
                     ASSERT( BLEND_MODE_ALPHA == mBlendMode ) ;
-                    alphaMod = (unsigned char) Clamp( massFraction * mDensityVisibility , 0.0f , 255.0f ) ;
+                    alphaMod = (unsigned char) Clamp( massFraction * visibility , 0.0f , 255.0f ) ;
                 }
 
+                if( mFillBillboardInstances )
+                {   // Write one instance; the vertex shader computes corners of the quadrilateral.
+                    VertexFormatBillboard * vInst = INDEX( VertexFormatBillboard * , vertexBytes , iPcl * mVertStride ) ;
+                    vInst->px       = pclPos.x ;
+                    vInst->py       = pclPos.y ;
+                    vInst->pz       = pclPos.z ;
+                    vInst->halfSize = Render::HalfFromFloat( rHalfSize ) ;
+                    vInst->angle    = Render::HalfFromFloat( fmodf( pclAngle , TWO_PI ) ) ;  // Wrap angle, which grows with time, so half precision suffices.
+                    vInst->crgba[0] = colorMod ;
+                    vInst->crgba[1] = colorMod ;
+                    vInst->crgba[2] = colorMod ;
+                    vInst->crgba[3] = alphaMod ;
+                    vInst->tv0      = (unsigned short) ( v0 * 65535.0f + 0.5f ) ;
+                    vInst->tv1      = (unsigned short) ( v1 * 65535.0f + 0.5f ) ;
+                    continue ;
+                }
+
+                const float     sinAngle        = sin( pclAngle ) ;
+                const float     cosAngle        = cos( pclAngle ) ;
+                Vec3            pclRight        = (   viewRight * cosAngle + viewUp * sinAngle ) * rHalfSize ;
+                Vec3            pclUp           = ( - viewRight * sinAngle + viewUp * cosAngle ) * rHalfSize ;
+
+                ASSERT( ! IsNan( pclRight     ) ) ;
+                ASSERT( ! IsNan( pclUp        ) ) ;
+
+            #if PARTICLES_RENDER_STREAM_VERTICES
+                if( streamQuads )
+                {   // Assemble quadrilateral in cache, then stream it into vertex buffer.
+                    VertexFormatPos3Col4Tex2 quad[ numVerticesPerParticle ] ;
+                    AssignVertex( quad[ 0 ] , 1.0f , v0 , colorMod , alphaMod , pclPos + pclRight + pclUp ) ;
+                    AssignVertex( quad[ 1 ] , 0.0f , v0 , colorMod , alphaMod , pclPos - pclRight + pclUp ) ;
+                    AssignVertex( quad[ 2 ] , 0.0f , v1 , colorMod , alphaMod , pclPos - pclRight - pclUp ) ;
+                    AssignVertex( quad[ 3 ] , 1.0f , v1 , colorMod , alphaMod , pclPos + pclRight - pclUp ) ;
+                    StreamingStore_Copy( vertexBytes + iPcl * sizeof( quad ) , quad , sizeof( quad ) ) ;
+                    continue ;
+                }
+            #endif
+
                 const size_t idxVert = iPcl * numVerticesPerParticle ;
                 const size_t offsetVert = idxVert * mVertStride ;
 
@@ -290,6 +364,13 @@ namespace PeGaSys
                 vPos->y   = ( pclPos.y + pclRight.y - pclUp.y ) ;
                 vPos->z   = ( pclPos.z + pclRight.z - pclUp.z ) ;
             }
+
+        #if PARTICLES_RENDER_STREAM_VERTICES
+            if( streamQuads )
+            {   // Make streamed vertices visible to the render thread, which unmaps the vertex buffer once every slice finishes.
+                StreamingStore_Fence() ;
+            }
+        #endif
         }
 
 
@@ -297,7 +378,7 @@ namespace PeGaSys
 
         void ParticlesRenderModel::VertexBufferFillerGeneric::SetPos3FCol4BTex2F()
         {
-            mOffsetToDensityInfo               = offsetof( Particle , mDensity ) ;
+            mDensityInfoAttribute              = PARTICLE_ATTRIBUTE_DENSITY ;
             mVertStride                        = sizeof  ( VertexFormatPos3Col4Tex2 ) ;
             mVertPositionOffset                = offsetof( VertexFormatPos3Col4Tex2 , px       ) ;
             mVertTextureCoordOffset            = offsetof( VertexFormatPos3Col4Tex2 , ts       ) ;
@@ -309,6 +390,44 @@ namespace PeGaSys
             mDensityVisibility                 = FLT_MAX ;
             mBlendMode                         = PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric::BLEND_MODE_ALPHA ;
             mScale                             = 1.0f ;
+            mFillBillboardInstances            = false ;
+        }
+
+
+
+
+        /** Configure this filler to write one VertexFormatBillboardInstance per particle, for a BILLBOARD_INSTANCE vertex buffer.
+
+            The vertex shader in OpenGL_VertexBuffer expands each instance into
+            the same quadrilateral SetPos3FCol4BTex2F would have written.
+        */
+        void ParticlesRenderModel::VertexBufferFillerGeneric::SetBillboardInstance()
+        {
+            SetPos3FCol4BTex2F() ;
+            mVertStride                        = sizeof  ( VertexFormatBillboard ) ;
+            mVertPositionOffset                = offsetof( VertexFormatBillboard , px       ) ;
+            mVertTextureCoordOffset            = offsetof( VertexFormatBillboard , tv0      ) ;
+            mVertRedOffset                     = offsetof( VertexFormatBillboard , crgba[0] ) ;
+            mVertGrnOffset                     = offsetof( VertexFormatBillboard , crgba[1] ) ;
+            mVertBluOffset                     = offsetof( VertexFormatBillboard , crgba[2] ) ;
+            mVertAlpOffset                     = offsetof( VertexFormatBillboard , crgba[3] ) ;
+            mFillBillboardInstances            = true ;
+        }
+
+
+
+
+        /** Return whether this filler writes vertices with the layout SetPos3FCol4BTex2F assigns.
+        */
+        bool ParticlesRenderModel::VertexBufferFillerGeneric::HasPos3FCol4BTex2FLayout() const
+        {
+            return      ( sizeof  ( VertexFormatPos3Col4Tex2 )              == mVertStride             )
+                    &&  ( offsetof( VertexFormatPos3Col4Tex2 , px       )   == mVertPositionOffset     )
+                    &&  ( offsetof( VertexFormatPos3Col4Tex2 , ts       )   == mVertTextureCoordOffset )
+                    &&  ( offsetof( VertexFormatPos3Col4Tex2 , crgba[0] )   == mVertRedOffset          )
+                    &&  ( offsetof( VertexFormatPos3Col4Tex2 , crgba[1] )   == mVertGrnOffset          )
+                    &&  ( offsetof( VertexFormatPos3Col4Tex2 , crgba[2] )   == mVertBluOffset          )
+                    &&  ( offsetof( VertexFormatPos3Col4Tex2 , crgba[3] )   == mVertAlpOffset          ) ;
         }
 
 
@@ -320,6 +439,10 @@ namespace PeGaSys
             : ModelNode( sceneManager )
             , mParticleSystem( NULLPTR )
             , mVertexBufferFillerContainers( NULLPTR )
+            , mUseOrderIndependentTransparency( true )
+            , mIsOrderIndependentTransparencySupported( true )
+            , mResolutionDivisor( 1 )
+            , mMinProjectedSize( 1.0f )
         {
         }
 
@@ -351,7 +474,30 @@ namespace PeGaSys
             CreateAndFillVertexBufferPerGroup( currentVirtualTimeInSeconds ) ;
 
             // Render particles geometry.
-            GetModelData()->Render( renderApi ) ;
+            {
+                RENDER_GPU_PASS( renderApi->GetGpuTimer() , ParticlesRender ) ;
+                // If API refuses reduced resolution, render at full resolution.
+                const bool reducedResolution = ( mResolutionDivisor > 1 ) && renderApi->BeginReducedResolution( mResolutionDivisor ) ;
+                if( mUseOrderIndependentTransparency && mIsOrderIndependentTransparencySupported && HasActivePasses( /* orderIndependent */ true ) )
+                {   // Some passes accumulate in any order, which needs setup before and compositing after.
+                    RenderPasses( renderApi , /* orderIndependent */ false ) ;
+                    mIsOrderIndependentTransparencySupported = renderApi->BeginOrderIndependentTransparency() ;
+                    // If API refused, order-independent passes blend as ordinary alpha passes, and later frames sort them.
+                    RenderPasses( renderApi , /* orderIndependent */ true ) ;
+                    if( mIsOrderIndependentTransparencySupported )
+                    {
+                        renderApi->EndOrderIndependentTransparency() ;
+                    }
+                }
+                else
+                {
+                    GetModelData()->Render( renderApi ) ;
+                }
+                if( reducedResolution )
+                {
+                    renderApi->EndReducedResolution() ;
+                }
+            }
 
             // TODO: Render diagnostic text at this location (0,0,0)
 
@@ -361,6 +507,70 @@ namespace PeGaSys
 
 
 
+        /** Return whether any mesh has an active pass whose blend state is, or is not, order-independent.
+        */
+        bool ParticlesRenderModel::HasActivePasses( bool orderIndependent )
+        {
+            const size_t numMeshes = GetModelData()->GetNumMeshes() ;
+            for( size_t meshIndex = 0 ; meshIndex < numMeshes ; ++ meshIndex )
+            {   // For each mesh in this model...
+                const Technique * technique = GetModelData()->GetMesh( meshIndex )->GetTechnique() ;
+                if( technique )
+                {   // Mesh has a render technique.
+                    const Technique::PassContainer &    passes  = technique->GetPasses() ;
+                    const Technique::PassConstIterator  endPass = passes.End() ;
+                    for( Technique::PassConstIterator iPass = passes.Begin() ; iPass != endPass ; ++ iPass )
+                    {   // For each pass in this technique...
+                        const Pass * pass = * iPass ;
+                        if( pass->IsActive() && ( pass->GetRenderState().mBlendState.mOrderIndependent == orderIndependent ) )
+                        {
+                            return true ;
+                        }
+                    }
+                }
+            }
+            return false ;
+        }
+
+
+
+
+        /** Render active passes of each mesh whose blend state is, or is not, order-independent.
+
+            This resembles ModelData::Render, but lets Render draw order-independent
+            passes between ApiBase::BeginOrderIndependentTransparency and
+            EndOrderIndependentTransparency, and other passes outside.
+        */
+        void ParticlesRenderModel::RenderPasses( ApiBase * renderApi , bool orderIndependent )
+        {
+            PERF_BLOCK( ParticlesRenderModel__RenderPasses ) ;
+
+            const size_t numMeshes = GetModelData()->GetNumMeshes() ;
+            for( size_t meshIndex = 0 ; meshIndex < numMeshes ; ++ meshIndex )
+            {   // For each mesh in this model...
+                MeshBase *          mesh        = GetModelData()->GetMesh( meshIndex ) ;
+                const Technique *   technique   = mesh->GetTechnique() ;
+                ASSERT( technique ) ;
+                if( technique )
+                {   // Mesh has a render technique.
+                    const Technique::PassContainer &    passes  = technique->GetPasses() ;
+                    const Technique::PassConstIterator  endPass = passes.End() ;
+                    for( Technique::PassConstIterator iPass = passes.Begin() ; iPass != endPass ; ++ iPass )
+                    {   // For each pass in this technique...
+                        const Pass * pass = * iPass ;
+                        if( pass->IsActive() && ( pass->GetRenderState().mBlendState.mOrderIndependent == orderIndependent ) )
+                        {
+                            pass->Apply( renderApi ) ;
+                            mesh->Render() ;
+                        }
+                    }
+                }
+            }
+        }
+
+
+
+
         /** Count total number of vertex buffer fillers associated with this particle system.
 
             The particle system can have multiple particle groups.
@@ -501,8 +711,6 @@ namespace PeGaSys
             ASSERT( mParticleSystem != NULLPTR ) ;  // Must have called AssociateWithParticleSystem beforehand
             ASSERT( GetModelData() != NULLPTR ) ;  // Must have called InitializeResources beforehand
 
-            static const size_t numVerticesPerParticle = 4 ; // A quad has 4 vertices.
-
             size_t groupIndex = 0 ;
             for( ParticleSystem::Iterator iter = mParticleSystem->Begin() ; iter != mParticleSystem->End() ; ++ iter , ++ groupIndex )
             {   // For each group in the particle system associated with this model...
@@ -510,7 +718,6 @@ namespace PeGaSys
                 ParticleGroup *     group           = * iter ;
                 ASSERT( mParticleSystem->GetGroup( groupIndex ) == group ) ;
                 const size_t        numParticles    = group->GetNumParticles() ;
-                const size_t        numVertices     = numParticles * numVerticesPerParticle ;
 
                 for( size_t meshIndexWithinGroup = 0 ; meshIndexWithinGroup < GetNumVertBufFillersPerGroup( groupIndex ) ; ++ meshIndexWithinGroup )
                 {   // For each mesh associated with this group...
@@ -518,9 +725,11 @@ namespace PeGaSys
                     VertexBufferBase *  vertBuf         = mesh->GetVertexBuffer() ;
                     ASSERT( vertBuf ) ; // Caller must have created vertex buffer (even if empty) to declare vertex format.
                     const size_t        vertBufCapacity = vertBuf->GetCapacity() ;
+                    const size_t        numVertices     = numParticles * NumVerticesPerParticle( vertBuf ) ;
 
                     if( numVertices > vertBufCapacity )
                     {   // Vertex buffer cannot accommodate all particles in group.
+                        vertBuf->SetUsage( VertexBufferBase::USAGE_STREAM ) ; // FillVertexBufferPerGroup refills every frame.
                         vertBuf->ChangeCapacityAndReallocate( numVertices ) ;
                     }
                 }
@@ -530,30 +739,405 @@ namespace PeGaSys
 
 
 
-        void ParticlesRenderModel::AssignIndicesAndSortParticles( const Vec3 & viewForward , size_t numParticles )
+        /** Return whether the given group has an active pass whose appearance depends on the order of particles.
+
+            Additive passes commute, and order-independent passes accumulate in any
+            order when the API supports that, so neither needs sorting.
+        */
+        bool ParticlesRenderModel::GroupNeedsSort( size_t groupIndex )
+        {
+            ASSERT( mVertexBufferFillerContainers != NULLPTR ) ; // Must have called AssociateWithParticleSystem beforehand.
+
+            const bool                                  accumulates = mUseOrderIndependentTransparency && mIsOrderIndependentTransparencySupported ;
+            const PclGrpVertexBufferFillerContainer &   vbFillers   = (*mVertexBufferFillerContainers)[ groupIndex ] ;
+            for( size_t meshIndexWithinGroup = 0 ; meshIndexWithinGroup < vbFillers.Size() ; ++ meshIndexWithinGroup )
+            {   // For each vertex buffer filler associated with this group...
+                if( ! vbFillers[ meshIndexWithinGroup ]->mIsActive )
+                {   // Filler writes no vertices, so its mesh renders nothing.
+                    continue ;
+                }
+                const Technique * technique = GetMesh( groupIndex , meshIndexWithinGroup )->GetTechnique() ;
+                if( NULLPTR == technique )
+                {   // Mesh renders nothing.
+                    continue ;
+                }
+                const Technique::PassContainer &    passes  = technique->GetPasses() ;
+                const Technique::PassConstIterator  endPass = passes.End() ;
+                for( Technique::PassConstIterator iPass = passes.Begin() ; iPass != endPass ; ++ iPass )
+                {   // For each pass in this technique...
+                    const Pass *        pass        = * iPass ;
+                    const BlendStateS & blendState  = pass->GetRenderState().mBlendState ;
+                    if(     pass->IsActive()
+                        &&  blendState.mBlendEnabled
+                        &&  ( blendState.mBlendDstColor != BlendStateS::BLEND_FACTOR_ONE )
+                        &&  ! ( blendState.mOrderIndependent && accumulates ) )
+                    {   // Pass blends in an order-dependent way.
+                        return true ;
+                    }
+                }
+            }
+            return false ;
+        }
+
+
+
+
+        /** Sort particles in the given group back-to-front, for FillVertexBufferPerGroup to use.
+
+            \param viewForward  World-space direction of view +z axis, which points from the scene toward the camera.
+
+            \param groupIndex   Index of particle group whose particles to sort.
+        */
+        void ParticlesRenderModel::AssignIndicesAndSortParticles( const Vec3 & viewForward , size_t groupIndex )
         {
             ASSERT( mParticleSystem != NULLPTR ) ;  // Must have called AssociateWithParticleSystem beforehand
             ASSERT( GetModelData() != NULLPTR ) ;  // Must have called InitializeResources beforehand
-            (void) viewForward , numParticles ;
+#       if PARTICLES_RENDER_SORT_PARTICLES
+            const VECTOR< Particle > &  particles       = mParticleSystem->GetGroup( groupIndex )->GetParticles() ;
+            const char *                particleBytes   = particles.Empty() ? NULLPTR : reinterpret_cast< const char * >( & particles[ 0 ].mPosition ) ;
+            mDepthSorters.Resize( mParticleSystem->GetNumGroups() ) ;
+#           if PARTICLE_GROUP_STABLE_IDS
+            // Particles move between slots from frame to frame, so translate the previous order by identity, letting the sort start from nearly sorted.
+            // Slots are those of the group's most recent update; if particles changed since, the start order is merely worse, never invalid.
+            const ParticleIdMap &   idMap       = mParticleSystem->GetGroup( groupIndex )->GetIdMap() ;
+            mSortedIds.Resize( mParticleSystem->GetNumGroups() ) ;
+            VECTOR< unsigned > &    sortedIds   = mSortedIds[ groupIndex ] ;
+            if( ! sortedIds.Empty() )
+            {   // Previous sort recorded identifiers.
+                for( size_t place = 0 ; place < sortedIds.Size() ; ++ place )
+                {   // For each place in the previous order...
+                    const size_t slot = idMap.GetSlot( sortedIds[ place ] ) ;
+                    sortedIds[ place ] = ( ParticleIdMap::INVALID_SLOT == slot ) ? ~ 0u : static_cast< unsigned >( slot ) ;
+                }
+                mDepthSorters[ groupIndex ].SetPreviousOrder( sortedIds.Data() , sortedIds.Size() , particles.Size() ) ;
+            }
+#           endif
+            mDepthSorters[ groupIndex ].Sort( particleBytes , sizeof( Particle ) , particles.Size() , viewForward ) ;
+#           if PARTICLE_GROUP_STABLE_IDS
+            sortedIds.Resize( particles.Size() ) ;
+            for( size_t place = 0 ; place < particles.Size() ; ++ place )
+            {   // For each place in the new order, remember which particle is there.
+                sortedIds[ place ] = particles[ mDepthSorters[ groupIndex ][ place ] ].mId ;
+            }
+#           endif
+#       else
+            (void) viewForward , groupIndex ;
+#       endif
         }
 
 
 
 
+        /** Return how far, per unit particle size, vertices that active fillers of the given group write can lie from their particle, or a negative value if unknown.
+        */
+        float ParticlesRenderModel::GetReachPerSize( size_t groupIndex ) const
+        {
+            ASSERT( mVertexBufferFillerContainers != NULLPTR ) ; // Must have called AssociateWithParticleSystem beforehand.
+
+            const PclGrpVertexBufferFillerContainer & vbFillers = (*mVertexBufferFillerContainers)[ groupIndex ] ;
+            float reachPerSize = 0.0f ;
+            for( size_t meshIndexWithinGroup = 0 ; meshIndexWithinGroup < vbFillers.Size() ; ++ meshIndexWithinGroup )
+            {   // For each vertex buffer filler associated with this group...
+                const IVertexBufferFiller * vbFiller = vbFillers[ meshIndexWithinGroup ] ;
+                if( vbFiller->mIsActive )
+                {   // Filler will write vertices.
+                    const float fillerReachPerSize = vbFiller->GetReachPerSize() ;
+                    if( fillerReachPerSize < 0.0f )
+                    {   // Filler could write vertices anywhere.
+                        return fillerReachPerSize ;
+                    }
+                    reachPerSize = Max2( reachPerSize , fillerReachPerSize ) ;
+                }
+            }
+            return reachPerSize ;
+        }
+
+
+
+
+        /** Update local bounds of this model to contain all particles, using chunk bounds that particle operations found.
+
+            If any group with particles lacks chunk bounds, its particles could be anywhere.
+        */
+        /* virtual */ void ParticlesRenderModel::UpdateLocalBounds()
+        {
+            PERF_BLOCK( ParticlesRenderModel__UpdateLocalBounds ) ;
+
+            if( ( NULLPTR == mParticleSystem ) || ( NULLPTR == mVertexBufferFillerContainers ) )
+            {   // Model is not yet associated with particles.
+                SetLocalBounds( BOUNDS_INFINITE ) ;
+                return ;
+            }
+
+            Vec3 minCorner( FLT_MAX , FLT_MAX , FLT_MAX ) ;
+            Vec3 maxCorner( - minCorner ) ;
+            bool hasParticles   = false ;
+            const size_t numGroups = mParticleSystem->GetNumGroups() ;
+            for( size_t groupIndex = 0 ; groupIndex < numGroups ; ++ groupIndex )
+            {   // For each group in the particle system associated with this model...
+                const ParticleGroup * group = mParticleSystem->GetGroup( groupIndex ) ;
+                if( ! group->HasParticles() )
+                {   // Group renders nothing.
+                    continue ;
+                }
+                const ParticleChunkBounds * chunkBounds     = group->GetChunkBounds() ;
+                const float                 reachPerSize    = GetReachPerSize( groupIndex ) ;
+                if( ( NULLPTR == chunkBounds ) || ( reachPerSize < 0.0f ) )
+                {   // Extent of particles in this group is unknown.
+                    SetLocalBounds( BOUNDS_INFINITE ) ;
+                    return ;
+                }
+                const size_t numChunks = chunkBounds->mMinCorners.Size() ;
+                for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+                {   // For each chunk of particles in this group...
+                    const float reach = reachPerSize * chunkBounds->mMaxSizes[ iChunk ] ;
+                    minCorner.x = Min2( minCorner.x , chunkBounds->mMinCorners[ iChunk ].x - reach ) ;
+                    minCorner.y = Min2( minCorner.y , chunkBounds->mMinCorners[ iChunk ].y - reach ) ;
+                    minCorner.z = Min2( minCorner.z , chunkBounds->mMinCorners[ iChunk ].z - reach ) ;
+                    maxCorner.x = Max2( maxCorner.x , chunkBounds->mMaxCorners[ iChunk ].x + reach ) ;
+                    maxCorner.y = Max2( maxCorner.y , chunkBounds->mMaxCorners[ iChunk ].y + reach ) ;
+                    maxCorner.z = Max2( maxCorner.z , chunkBounds->mMaxCorners[ iChunk ].z + reach ) ;
+                }
+                hasParticles = true ;
+            }
+
+            if( hasParticles )
+            {
+                SetLocalBoundingBox( minCorner , maxCorner ) ;
+            }
+            else
+            {
+                SetLocalBounds( BOUNDS_EMPTY ) ;
+            }
+        }
+
+
+
+
+#   if PARTICLES_RENDER_CULL_CHUNKS
+        /** Find which particles of the given group lie in chunks that could be visible to the given camera.
+
+            \param pclOrder (in/out) Index of particle to put in each place in vertex buffer, or NULL to use the order of particles in group.
+                If this culls any chunks, it changes pclOrder to this group's mVisibleParticleOrder, which keeps the relative order of remaining particles.
+
+            \return Number of particles to fill.
+        */
+        size_t ParticlesRenderModel::CullChunks( size_t groupIndex , const Render::Camera & camera , const unsigned * & pclOrder )
+        {
+            PERF_BLOCK( ParticlesRenderModel__CullChunks ) ;
+
+            const ParticleGroup *       group           = mParticleSystem->GetGroup( groupIndex ) ;
+            const size_t                numParticles    = group->GetNumParticles() ;
+            const ParticleChunkBounds * chunkBounds     = group->GetChunkBounds() ;
+            const float                 reachPerSize    = GetReachPerSize( groupIndex ) ;
+            if( ( NULLPTR == chunkBounds ) || ( reachPerSize < 0.0f ) )
+            {   // Extent of particles is unknown, so fill them all.
+                return numParticles ;
+            }
+
+            const size_t numChunks = chunkBounds->mMinCorners.Size() ;
+            mChunkVisibility.Resize( numChunks ) ;
+            size_t numVisibleChunks = 0 ;
+            for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+            {   // For each chunk of particles in this group...
+                const float reach = reachPerSize * chunkBounds->mMaxSizes[ iChunk ] ;
+                const Vec3  vReach( reach , reach , reach ) ;
+                Vec3        worldMinCorner ;
+                Vec3        worldMaxCorner ;
+                TransformBoundingBox( GetLocalToWorld() , chunkBounds->mMinCorners[ iChunk ] - vReach , chunkBounds->mMaxCorners[ iChunk ] + vReach , worldMinCorner , worldMaxCorner ) ;
+                const bool  isVisible = camera.IsBoxInFrustum( worldMinCorner , worldMaxCorner ) ;
+                mChunkVisibility[ iChunk ] = isVisible ;
+                numVisibleChunks += isVisible ? 1 : 0 ;
+            }
+
+            if( numVisibleChunks == numChunks )
+            {   // Every chunk could be visible, so fill all particles, in the original order.
+                return numParticles ;
+            }
+
+            VECTOR< unsigned > & visibleParticleOrder = mVisibleParticleOrder[ groupIndex ] ;
+            visibleParticleOrder.Clear() ;
+            if( pclOrder != NULLPTR )
+            {   // Particles have a sorted order.  Keep it, minus culled particles.
+                for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+                {   // For each particle in sorted order...
+                    if( mChunkVisibility[ pclOrder[ iPcl ] / PARTICLE_OPERATION_FUSED_CHUNK_SIZE ] )
+                    {   // Particle is in a chunk that could be visible.
+                        visibleParticleOrder.PushBack( pclOrder[ iPcl ] ) ;
+                    }
+                }
+            }
+            else
+            {   // Particles have group order.  Append each visible chunk.
+                for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+                {   // For each chunk of particles in this group...
+                    if( mChunkVisibility[ iChunk ] )
+                    {   // Chunk could be visible.
+                        const size_t iPclBegin  = iChunk * PARTICLE_OPERATION_FUSED_CHUNK_SIZE ;
+                        const size_t iPclEnd    = Min2( iPclBegin + PARTICLE_OPERATION_FUSED_CHUNK_SIZE , numParticles ) ;
+                        for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+                        {   // For each particle in this chunk...
+                            visibleParticleOrder.PushBack( static_cast< unsigned >( iPcl ) ) ;
+                        }
+                    }
+                }
+            }
+
+            pclOrder = visibleParticleOrder.Empty() ? NULLPTR : & visibleParticleOrder[ 0 ] ;
+            return visibleParticleOrder.Size() ;
+        }
+#   endif
+
+
+
+
+#   if PARTICLES_RENDER_LEVEL_OF_DETAIL
+        /** Thin out particles of the given group whose projected width falls below mMinProjectedSize.
+
+            Each such particle survives with probability equal to the ratio of
+            its projected area to that of a particle mMinProjectedSize wide, but
+            no less than sMinKeepProbability, so scaled opacity stays within
+            what vertex colors can represent.  Survivors scale opacity by the
+            reciprocal of that probability, so expected coverage stays the same.
+            Whether a particle survives depends on a hash of its index, not on a
+            random number, so the same particles survive from frame to frame, and
+            thinning does not flicker.
+
+            Projected width uses depth along the view direction, so this
+            thins particles near frustum edges as much as near its center.
+
+            \param numPclsToFill    Number of places in pclOrder (or particles in group, if pclOrder is NULL) to consider.
+
+            \param pclOrder (in/out) Index of particle to put in each place in vertex buffer, or NULL to use the order of particles in group.
+                If this drops any particles, it changes pclOrder to this group's mDetailParticleOrder, which keeps the relative order of survivors.
+
+            \param opacityScales (out) Factor by which to scale opacity of particle in each place, or NULL if this dropped nothing.
+
+            \return Number of particles to fill.
+        */
+        size_t ParticlesRenderModel::SelectLevelOfDetail( size_t groupIndex , const Render::Camera & camera , size_t numPclsToFill , const unsigned * & pclOrder , const float * & opacityScales )
+        {
+            PERF_BLOCK( ParticlesRenderModel__SelectLevelOfDetail ) ;
+
+            static const float sMinKeepProbability = 1.0f / 16.0f ;
+
+            opacityScales = NULLPTR ;
+
+            const float reachPerSize = GetReachPerSize( groupIndex ) ;
+            if( ( mMinProjectedSize <= 0.0f ) || ( reachPerSize < 0.0f ) || ( 0 == numPclsToFill ) )
+            {   // Thinning is disabled, or extent of particles is unknown.
+                return numPclsToFill ;
+            }
+
+            // Express depth along view direction as a plane in local space, so each particle costs one dot product.
+            const Mat44 &   localToWorld    = GetLocalToWorld() ;
+            Vec3            viewDirection   = camera.GetLookAt() - camera.GetEye() ;
+            viewDirection.Normalize() ;
+            const Vec3      depthPerLocal( localToWorld.m[0][0] * viewDirection.x + localToWorld.m[0][1] * viewDirection.y + localToWorld.m[0][2] * viewDirection.z
+                                         , localToWorld.m[1][0] * viewDirection.x + localToWorld.m[1][1] * viewDirection.y + localToWorld.m[1][2] * viewDirection.z
+                                         , localToWorld.m[2][0] * viewDirection.x + localToWorld.m[2][1] * viewDirection.y + localToWorld.m[2][2] * viewDirection.z ) ;
+            const Vec3      localOrigin( localToWorld.m[3][0] , localToWorld.m[3][1] , localToWorld.m[3][2] ) ;
+            const float     depthOffset     = ( localOrigin - camera.GetEye() ) * viewDirection ;
+            const float     worldPerLocal   = Vec3( localToWorld.m[0][0] , localToWorld.m[0][1] , localToWorld.m[0][2] ).Magnitude() ;
+
+            // Quadrilateral width per unit size is its diagonal reach times sqrt(2).
+            const float     tanHalfFovVert  = tanf( 0.5f * camera.GetFieldOfViewVert() * 3.14159265f / 180.0f ) ;
+            const float     pixelsPerSizeAtUnitDepth = reachPerSize * 1.41421356f * worldPerLocal * camera.GetViewportHeight() / ( 2.0f * tanHalfFovVert ) ;
+            const float     minDepth        = camera.GetNearClipDist() ;
+
+            const ParticleGroup *                       group       = mParticleSystem->GetGroup( groupIndex ) ;
+            const VECTOR< Particle > &                  particles   = group->GetParticles() ;
+            const ParticleAttributeView< const Vec3 >   positions   = Particles::GetAttributeView< const Vec3  >( particles , PARTICLE_ATTRIBUTE_POSITION ) ;
+            const ParticleAttributeView< const float >  sizes       = Particles::GetAttributeView< const float >( particles , PARTICLE_ATTRIBUTE_SIZE     ) ;
+
+            VECTOR< unsigned > &    detailParticleOrder = mDetailParticleOrder[ groupIndex ] ;
+            VECTOR< float > &       detailOpacityScales = mDetailOpacityScales[ groupIndex ] ;
+            detailParticleOrder.Clear() ;
+            detailOpacityScales.Clear() ;
+            bool droppedAny = false ;
+            for( size_t iPlace = 0 ; iPlace < numPclsToFill ; ++ iPlace )
+            {   // For each particle to fill...
+                const unsigned  iPcl            = pclOrder ? pclOrder[ iPlace ] : static_cast< unsigned >( iPlace ) ;
+                const float     depth           = Max2( positions[ iPcl ] * depthPerLocal + depthOffset , minDepth ) ;
+                const float     projectedSize   = sizes[ iPcl ] * pixelsPerSizeAtUnitDepth / depth ;
+                float           opacityScale    = 1.0f ;
+                if( projectedSize < mMinProjectedSize )
+                {   // Particle is smaller than threshold, so keep it with probability proportional to its projected area.
+                    const float     fraction        = projectedSize / mMinProjectedSize ;
+                    const float     keepProbability = Max2( fraction * fraction , sMinKeepProbability ) ;
+                    const unsigned  hash            = iPcl * 2654435761u ;  // Knuth multiplicative hash, to decorrelate neighboring indices.
+                    const float     uniform         = float( hash >> 8 ) * ( 1.0f / 16777216.0f ) ;
+                    if( uniform >= keepProbability )
+                    {   // Drop particle.
+                        droppedAny = true ;
+                        continue ;
+                    }
+                    opacityScale = 1.0f / keepProbability ;
+                }
+                detailParticleOrder.PushBack( iPcl ) ;
+                detailOpacityScales.PushBack( opacityScale ) ;
+            }
+
+            if( ! droppedAny )
+            {   // Every particle survived, so keep the original order, without scaling.
+                return numPclsToFill ;
+            }
+
+            pclOrder        = detailParticleOrder.Empty() ? NULLPTR : & detailParticleOrder[ 0 ] ;
+            opacityScales   = detailOpacityScales.Empty() ? NULLPTR : & detailOpacityScales[ 0 ] ;
+            return detailParticleOrder.Size() ;
+        }
+#   endif
+
+
+
+
+        /** Fill vertex buffers of every mesh of every particle group.
+
+            This first locks every vertex buffer and gathers one fill job per
+            active vertex buffer filler, then fills them all in one parallel
+            dispatch (see FillVertexBuffers), then unlocks them.  Dispatching
+            once per frame, instead of once per mesh, pays fork-join overhead
+            once, and balances load across groups of disparate sizes.
+        */
         void ParticlesRenderModel::FillVertexBufferPerGroup( const double & timeNow , const struct Mat44 & viewMatrix )
         {
             ASSERT( mParticleSystem != NULLPTR ) ;  // Must have called AssociateWithParticleSystem beforehand
             ASSERT( GetModelData() != NULLPTR ) ;  // Must have called InitializeResources beforehand
 
             const size_t numGroups = mParticleSystem->GetNumGroups() ;
-            static const nvpp      = 4 ;
+#       if PARTICLES_RENDER_CULL_CHUNKS
+            const Camera * camera = GetSceneManager()->GetCurrentCamera() ;
+            mVisibleParticleOrder.Resize( numGroups ) ;
+#       endif
+#       if PARTICLES_RENDER_LEVEL_OF_DETAIL
+            mDetailParticleOrder.Resize( numGroups ) ;
+            mDetailOpacityScales.Resize( numGroups ) ;
+#       endif
+
+            mFillJobs.Clear() ;
 
             for( size_t groupIndex = 0 ; groupIndex < numGroups ; ++ groupIndex )
             {   // For each group in the particle system associated with this model...
                 ParticleGroup *     group           = mParticleSystem->GetGroup( groupIndex ) ;
                 const size_t        numParticles    = group->GetNumParticles() ;
-
-                const size_t        numVertices     = nvpp * numParticles ;
+#           if PARTICLES_RENDER_SORT_PARTICLES
+                const unsigned *    pclOrder        = ( groupIndex < mDepthSorters.Size() ) ? mDepthSorters[ groupIndex ].GetOrder() : NULLPTR ;
+#           else
+                const unsigned *    pclOrder        = NULLPTR ;
+#           endif
+#           if PARTICLES_RENDER_CULL_CHUNKS
+                size_t              numPclsToFill   = camera ? CullChunks( groupIndex , * camera , pclOrder ) : numParticles ;
+#           else
+                size_t              numPclsToFill   = numParticles ;
+#           endif
+                const float *       opacityScales   = NULLPTR ;
+#           if PARTICLES_RENDER_LEVEL_OF_DETAIL
+                if( camera )
+                {
+                    numPclsToFill = SelectLevelOfDetail( groupIndex , * camera , numPclsToFill , pclOrder , opacityScales ) ;
+                }
+#           endif
 
                 for( size_t meshIndexWithinGroup = 0 ; meshIndexWithinGroup < GetNumVertBufFillersPerGroup( groupIndex ) ; ++ meshIndexWithinGroup )
                 {   // For each mesh associated with this particle group...
@@ -561,14 +1145,15 @@ namespace PeGaSys
                     ASSERT( mesh != NULLPTR ) ;
                     VertexBufferBase *  vertBuf         = mesh->GetVertexBuffer() ;
                     ASSERT( vertBuf != NULLPTR ) ;
+                    const size_t        numVertices     = numParticles * NumVerticesPerParticle( vertBuf ) ;
+                    const size_t        numVertsToFill  = numPclsToFill * NumVerticesPerParticle( vertBuf ) ;
 
                     unsigned char *     vertBytes       = reinterpret_cast< unsigned char * >( vertBuf->LockVertexData() ) ;   // Obtain lock on vertex buffer's data
                     ASSERT( ( 0 == numParticles ) || ( vertBytes != NULLPTR ) ) ;
 
                     {
                         DEBUG_ONLY( const size_t    vertBufCapacity = vertBuf->GetCapacity() ) ;
-                        DEBUG_ONLY( const size_t    maxVertIdx      = nvpp * numParticles ) ;
-                        ASSERT( vertBufCapacity >= maxVertIdx ) ;
+                        ASSERT( vertBufCapacity >= numVertices ) ;
                     }
 
                     // TODO: Instead of rendering quads, provide a separate index buffer full of triangles.  D3D does not support quads anyway (except on Xbox360).
@@ -576,40 +1161,80 @@ namespace PeGaSys
 
                     if( vertBytes != NULLPTR  )
                     {   // This group has a vertex buffer, implying it has particles and lock was acquired.
-                        const ParticleGroup * particleGroup = mParticleSystem->GetGroup( groupIndex ) ;
-                        ASSERT( VertexDeclaration::POSITION_COLOR_TEXTURE == mesh->GetVertexBuffer()->GetVertexDeclaration().GetVertexFormat() ) ;
+                        ASSERT(     ( VertexDeclaration::POSITION_COLOR_TEXTURE == mesh->GetVertexBuffer()->GetVertexDeclaration().GetVertexFormat() )
+                                ||  ( VertexDeclaration::BILLBOARD_INSTANCE     == mesh->GetVertexBuffer()->GetVertexDeclaration().GetVertexFormat() ) ) ;
                         ASSERT( mVertexBufferFillerContainers != NULLPTR ) ;
-
-                        {   // Caller provided callbacks to fill vertex buffer from particle groups.
-                            ASSERT( mVertexBufferFillerContainers->Size() == numGroups ) ;
-                            PclGrpVertexBufferFillerContainer & vbfContainerPerGroup = (*mVertexBufferFillerContainers)[ groupIndex ] ;
-
-                            IVertexBufferFiller * vbFiller = vbfContainerPerGroup[ meshIndexWithinGroup ] ;
-                            ASSERT( vbFiller ) ;
-                            // Invoke callback to fill vertex buffer from particles in this group.
-                            if( vbFiller->mIsActive )
-                            {   // Current VB filler is active so fill the VB!
-
-#                           if USE_TBB
-                                // Estimate grain size based on size of problem and number of processors.
-                                const size_t grainSize =  Max2( size_t( 1 ) , numParticles / gNumberOfProcessors ) ;
-                                // Fill vertex buffer using threading building blocks
-                                parallel_for( tbb::blocked_range<size_t>( 0 , numParticles , grainSize ) , ParticleRenderer_FillVertexBuffer_TBB( vbFiller , vertBytes , particleGroup , timeNow , viewMatrix ) ) ;
-#                           else
-                                (*vbFiller)( vertBytes , particleGroup , timeNow , viewMatrix , 0 , numParticles ) ;
-#                           endif
-
-                                vertBuf->SetPopulation( numVertices ) ;
-                            }
-                            else
-                            {   // Current VB filler is not active so (effectively) empty the VB.
-                                vertBuf->SetPopulation( 0 ) ;
-                            }
+                        ASSERT( mVertexBufferFillerContainers->Size() == numGroups ) ;
+                        PclGrpVertexBufferFillerContainer & vbfContainerPerGroup = (*mVertexBufferFillerContainers)[ groupIndex ] ;
+
+                        IVertexBufferFiller * vbFiller = vbfContainerPerGroup[ meshIndexWithinGroup ] ;
+                        ASSERT( vbFiller ) ;
+                        if( vbFiller->mIsActive && ( numPclsToFill > 0 ) )
+                        {   // Current VB filler is active so queue a job to fill the VB, and keep it locked until then.
+                            VertexFillJobS job ;
+                            job.mFiller         = vbFiller ;
+                            job.mVertexBuffer   = vertBuf ;
+                            job.mVertBytes      = vertBytes ;
+                            job.mGroup          = group ;
+                            job.mPclOrder       = pclOrder ;
+                            job.mOpacityScales  = opacityScales ;
+                            job.mNumPcls        = numPclsToFill ;
+                            mFillJobs.PushBack( job ) ;
+                            vertBuf->SetPopulation( numVertsToFill ) ;
+                        }
+                        else
+                        {   // Current VB filler is not active so (effectively) empty the VB.
+                            vertBuf->SetPopulation( 0 ) ;
+                            vertBuf->UnlockVertexData() ;
                         }
-                        vertBuf->UnlockVertexData() ;
                     }
                 }
             }
+
+            FillVertexBuffers( timeNow , viewMatrix ) ;
+
+            for( size_t iJob = 0 ; iJob < mFillJobs.Size() ; ++ iJob )
+            {   // For each vertex buffer just filled...
+                mFillJobs[ iJob ].mVertexBuffer->UnlockVertexData() ;
+            }
+        }
+
+
+
+
+        /** Run every fill job that FillVertexBufferPerGroup gathered, in a single parallel dispatch.
+        */
+        void ParticlesRenderModel::FillVertexBuffers( const double & timeNow , const struct Mat44 & viewMatrix )
+        {
+            PERF_BLOCK( ParticlesRenderModel__FillVertexBuffers ) ;
+
+            const size_t numJobs = mFillJobs.Size() ;
+            if( 0 == numJobs )
+            {   // Nothing to fill.
+                return ;
+            }
+
+#       if USE_TBB
+            // Lay particles of all jobs end to end, so one range spans them all.
+            mFillJobStarts.Resize( numJobs + 1 ) ;
+            mFillJobStarts[ 0 ] = 0 ;
+            for( size_t iJob = 0 ; iJob < numJobs ; ++ iJob )
+            {   // For each fill job...
+                mFillJobStarts[ iJob + 1 ] = mFillJobStarts[ iJob ] + mFillJobs[ iJob ].mNumPcls ;
+            }
+            const size_t numPclsToFill = mFillJobStarts[ numJobs ] ;
+
+            // Estimate grain size based on size of problem and number of processors.
+            const size_t grainSize =  Max2( size_t( 1 ) , numPclsToFill / gNumberOfProcessors ) ;
+            // Fill vertex buffers using threading building blocks
+            parallel_for( tbb::blocked_range<size_t>( 0 , numPclsToFill , grainSize ) , ParticleRenderer_FillVertexBuffer_TBB( & mFillJobs[ 0 ] , & mFillJobStarts[ 0 ] , numJobs , timeNow , viewMatrix ) ) ;
+#       else
+            for( size_t iJob = 0 ; iJob < numJobs ; ++ iJob )
+            {   // For each fill job...
+                const VertexFillJobS & job = mFillJobs[ iJob ] ;
+                (*job.mFiller)( job.mVertBytes , job.mGroup , job.mPclOrder , job.mOpacityScales , timeNow , viewMatrix , 0 , job.mNumPcls ) ;
+            }
+#       endif
         }
 
 
@@ -627,16 +1252,29 @@ namespace PeGaSys
             renderApi->GetRenderState( renderState ) ;
             Mat44 & viewMatrix = renderState.mTransforms.mViewMatrix ;
 
-#           if SORT_PARTICLES
+#           if PARTICLES_RENDER_SORT_PARTICLES
             {
-                // Extract world space direction vectors associated with view (used to compute camera-facing coordinates).
-                // Note that these vectors are the unit vectors of the inverse of the view matrix.
-                // They are the world-space unit vectors of the view transformation.
-                Vec3 viewRight  ( viewMatrix.m[0][0] , viewMatrix.m[1][0] , viewMatrix.m[2][0] ) ;
-                Vec3 viewUp     ( viewMatrix.m[0][1] , viewMatrix.m[1][1] , viewMatrix.m[2][1] ) ;
+                // Extract world space direction of view +z axis, which points from the scene toward the camera.
+                // Note that this is a unit vector of the inverse of the view matrix.
                 Vec3 viewForward( viewMatrix.m[0][2] , viewMatrix.m[1][2] , viewMatrix.m[2][2] ) ;
 
-                AssignIndicesAndSortParticles( viewForward , numParticles ) ;
+                for( size_t groupIndex = 0 ; groupIndex < mParticleSystem->GetNumGroups() ; ++ groupIndex )
+                {   // For each group in the particle system associated with this model...
+                    if( GroupNeedsSort( groupIndex ) )
+                    {
+                        AssignIndicesAndSortParticles( viewForward , groupIndex ) ;
+                    }
+                    else if( groupIndex < mDepthSorters.Size() )
+                    {   // Group does not need sorting.  Fill in the order of particles in group.
+                        mDepthSorters[ groupIndex ].Clear() ;
+#                   if PARTICLE_GROUP_STABLE_IDS
+                        if( groupIndex < mSortedIds.Size() )
+                        {
+                            mSortedIds[ groupIndex ].Clear() ;
+                        }
+#                   endif
+                    }
+                }
             }
 #           endif
 
@@ -11,12 +11,14 @@
 #include "Core/Containers/IntrusivePtr.h"
 
 #include "Core/Containers/vector.h"
+#include "Core/Utility/depthSorter.h"
 
 
 #include "Render/Scene/model.h"
 #include "Render/Scene/modelData.h"
 
 #include "Particles/particleSystem.h"
+#include "Particles/particleAttributeView.h"
 
 // Macros ----------------------------------------------------------------------
 
@@ -24,6 +26,53 @@
 #   define PRIVATE private
 #endif
 
+
+/** Whether to sort particles in each group back-to-front before filling vertex buffers.
+
+    Translucent particles blend correctly only when sorted, unless their passes
+    use order-independent transparency (see BlendState::SetOrderIndependentAlpha)
+    or additive blending.  DepthSorter sorts using a parallel radix sort, which
+    costs much less than sorting with comparisons, but still visits every
+    particle each frame, so this sorts only groups with active passes that
+    need it.  Sorting is therefore a quality option for APIs that lack
+    order-independent transparency, or for when
+    ParticlesRenderModel::SetUseOrderIndependentTransparency turns it off.
+*/
+#define PARTICLES_RENDER_SORT_PARTICLES 0
+
+/** Whether to skip filling vertices for chunks of particles outside the view frustum.
+
+    Groups whose last operation finds per-chunk bounding boxes (e.g.
+    PclOpFindBoundingBox) let the renderer test each chunk against the
+    frustum, and fill vertices only for particles in chunks that could be
+    visible.  Other groups fill all particles.
+*/
+#define PARTICLES_RENDER_CULL_CHUNKS 1
+
+/** Whether to thin out particles whose projected size falls below a pixel or so, before filling vertex buffers.
+
+    Far from the camera, tracers shrink below a pixel, yet each still costs
+    vertices and blending.  This keeps each such particle with probability
+    proportional to its projected area, and scales opacity (or, for additive
+    particles, brightness) of survivors by the reciprocal, so expected
+    coverage stays the same.  Vertex count then follows screen coverage
+    instead of particle count.  See ParticlesRenderModel::SetMinProjectedSize.
+*/
+#define PARTICLES_RENDER_LEVEL_OF_DETAIL 1
+
+/** Whether to write particle vertices with non-temporal (streaming) stores.
+
+    The CPU never reads back vertices it writes into vertex buffers, yet
+    ordinary stores read each destination line into cache first, and leave
+    it there, evicting particle data the simulation threads need next.
+    Four VertexFormatPositionColor4Texture2 vertices span 96 bytes, a whole
+    number of 16-byte streaming stores, so fillers assemble each
+    quadrilateral in cache, then stream it into the vertex buffer.  Fillers
+    fall back to ordinary stores for other layouts, and for vertex buffers
+    that are not aligned to 16 bytes.  See StreamingStore_Copy.
+*/
+#define PARTICLES_RENDER_STREAM_VERTICES 1
+
 // Types -----------------------------------------------------------------------
 
 class ParticleRenderer_FillVertexBuffer_TBB ;
@@ -33,8 +82,10 @@ namespace PeGaSys
     namespace Render
     {
         // Forward declarations
-        class MeshBase  ;
-        class Light     ;
+        class MeshBase          ;
+        class VertexBufferBase  ;
+        class Light             ;
+        class Camera            ;
     }
 
     namespace ParticlesRender
@@ -53,8 +104,19 @@ namespace PeGaSys
                     IVertexBufferFiller() : mIsActive( true ) {}
 
                     /** Operation to fill vertex buffer from particles in group.
+
+                        \param pclOrder        Index of particle to put in each place in vertex buffer, or NULL to use the order of particles in group.
+
+                        \param opacityScales   Factor by which to scale opacity (or, for luminous particles, brightness) of particle in each place, or NULL for 1.
+                    */
+                    virtual void operator()( unsigned char * vertexBytes , const ParticleGroup * particleGroup , const unsigned * pclOrder , const float * opacityScales , const double & timeNow , const struct Mat44 & viewMatrix , size_t iPclStart , size_t iPclEnd ) = 0 ;
+
+                    /** Return how far, per unit particle size, vertices this filler writes can lie from their particle position, or a negative value if unknown.
+
+                        ParticlesRenderModel uses this to enlarge particle bounding boxes for culling.
+                        Fillers that return a negative value disable culling for their group.
                     */
-                    virtual void operator()( unsigned char * vertexBytes , const ParticleGroup * particleGroup , const double & timeNow , const struct Mat44 & viewMatrix , size_t iPclStart , size_t iPclEnd ) = 0 ;
+                    virtual float GetReachPerSize() const { return -1.0f ; }
 
                     bool mIsActive ; /// Whether this filler is currently active, i.e. whether it should fill a vertex buffer.  If inactive, the associated render pass probably also ought to be inactive.
             } ;
@@ -70,10 +132,7 @@ namespace PeGaSys
                     } ;
 
                     VertexBufferFillerGeneric()
-                        : mPclStride( sizeof( Particle ) )
-                        , mOffsetToAngVel     ( offsetof( Particle , mAngularVelocity ) )
-                        , mOffsetToSize       ( offsetof( Particle , mSize            ) )
-                        , mOffsetToDensityInfo( offsetof( Particle , mDensity         ) )
+                        : mDensityInfoAttribute( PARTICLE_ATTRIBUTE_DENSITY )
 
                         , mVertStride( 0 )
                         , mVertPositionOffset( ~size_t(0) )
@@ -87,18 +146,21 @@ namespace PeGaSys
                         , mBlendMode( BLEND_MODE_ALPHA )
                         , mDensityVisibility( 1.0f )
                         , mScale( 1.0f )
+                        , mFillBillboardInstances( false )
                     {}
 
                     /** Operation to fill vertex buffer from particles in group.
                     */
-                    virtual void operator()( unsigned char * vertexBytes , const ParticleGroup * particleGroup , const double & timeNow , const struct Mat44 & viewMatrix , size_t iPclStart , size_t iPclEnd ) ;
+                    virtual void operator()( unsigned char * vertexBytes , const ParticleGroup * particleGroup , const unsigned * pclOrder , const float * opacityScales , const double & timeNow , const struct Mat44 & viewMatrix , size_t iPclStart , size_t iPclEnd ) ;
+
+                    /// Return how far, per unit particle size, quadrilateral corners lie from particle position: half the scaled size, along the diagonal.
+                    virtual float GetReachPerSize() const { return 0.5f * mScale * 1.41421356f ; }
 
                     void SetPos3FCol4BTex2F() ;
+                    void SetBillboardInstance() ;
+                    bool HasPos3FCol4BTex2FLayout() const ;
 
-                    size_t      mPclStride                      ;   /// Number of bytes between each particle in particle data.
-                    size_t      mOffsetToAngVel                 ;   /// Number of bytes to angular velocity.
-                    size_t      mOffsetToSize                   ;   /// Number of bytes to particle size.
-                    size_t      mOffsetToDensityInfo            ;   /// Number of bytes to density info (either density or mass fraction)
+                    ParticleAttributeE  mDensityInfoAttribute   ;   /// Particle attribute to use as density info (either density or mass fraction)
 
                     size_t      mVertStride                     ;   /// Number of bytes between adjacent vertex positions
                     size_t      mVertPositionOffset             ;   /// Number of bytes between adjacent vertex positions
@@ -112,6 +174,7 @@ namespace PeGaSys
                     BlendModeE  mBlendMode                      ;
                     float       mDensityVisibility              ;
                     float       mScale                          ;
+                    bool        mFillBillboardInstances         ;   /// Whether to write one VertexFormatBillboardInstance per particle instead of 4 quadrilateral vertices.
             } ;
 
             static const unsigned sTypeId = 'PcRM' ; ///< Type identifier for a ParticlesRenderModel scene node
@@ -137,25 +200,110 @@ namespace PeGaSys
 
             Render::MeshBase * GetMesh( size_t groupIndex , size_t meshIndexWithinGroup ) ;
 
+            /** Set whether passes with order-independent blend state accumulate without sorting, if the render API supports that.
+
+                When false, or when the API lacks support, those passes blend as
+                ordinary alpha passes, which need sorting to look right.
+            */
+            void SetUseOrderIndependentTransparency( bool useOrderIndependentTransparency ) { mUseOrderIndependentTransparency = useOrderIndependentTransparency ; }
+
+            /// Return whether passes with order-independent blend state accumulate without sorting.  See SetUseOrderIndependentTransparency.
+            bool GetUseOrderIndependentTransparency() const { return mUseOrderIndependentTransparency ; }
+
+            /** Set ratio of window resolution to resolution at which particles render, along each axis.
+
+                1 (or 0) renders at full resolution.  2 (half) or 4 (quarter) shade 4 or
+                16 times fewer pixels, then upsample onto the window, respecting
+                depth edges, if the render API supports that.  Smoke and flame
+                billboards are fill-rate bound and mostly low-frequency, so they
+                tolerate that well.
+            */
+            void SetResolutionDivisor( unsigned resolutionDivisor ) { mResolutionDivisor = resolutionDivisor ; }
+
+            /// Return ratio of window resolution to resolution at which particles render.  See SetResolutionDivisor.
+            unsigned GetResolutionDivisor() const { return mResolutionDivisor ; }
+
+            /** Set projected width, in pixels, below which particles thin out, or 0 to fill every particle.
+
+                See PARTICLES_RENDER_LEVEL_OF_DETAIL.
+            */
+            void SetMinProjectedSize( float minProjectedSize ) { mMinProjectedSize = minProjectedSize ; }
+
+            /// Return projected width, in pixels, below which particles thin out.  See SetMinProjectedSize.
+            float GetMinProjectedSize() const { return mMinProjectedSize ; }
+
+        protected:
+            virtual void UpdateLocalBounds() ;
+
         private:
             ParticlesRenderModel( const ParticlesRenderModel & ) ; // Disallow copy construction
             ParticlesRenderModel & operator=( const ParticlesRenderModel & ) ; // Disallow assignment
 
+            /// Work to fill one vertex buffer from one particle group, gathered so every buffer fills in one parallel dispatch.
+            struct VertexFillJobS
+            {
+                IVertexBufferFiller *       mFiller         ;   /// Callback that fills vertex buffer.
+                Render::VertexBufferBase *  mVertexBuffer   ;   /// Vertex buffer to fill, locked until job runs.
+                unsigned char *             mVertBytes      ;   /// Locked vertex data of mVertexBuffer.
+                const ParticleGroup *       mGroup          ;   /// Particle group to fill from.
+                const unsigned *            mPclOrder       ;   /// Index of particle to put in each place in vertex buffer, or NULL to use the order of particles in group.
+                const float *               mOpacityScales  ;   /// Factor by which to scale opacity of particle in each place, or NULL for none.
+                size_t                      mNumPcls        ;   /// Number of particles to fill.
+            } ;
+
             void InitializeResources() ;
 
             size_t GetInternalMeshIndex( size_t groupIndex , size_t meshIndexWithinGroup ) const ;
 
             void CreateVertexBuffersPerGroup() ;
-            void AssignIndicesAndSortParticles( const Vec3 & viewForward , size_t numParticles ) ;
+            bool GroupNeedsSort( size_t groupIndex ) ;
+            void AssignIndicesAndSortParticles( const Vec3 & viewForward , size_t groupIndex ) ;
+
+            float GetReachPerSize( size_t groupIndex ) const ;
+#       if PARTICLES_RENDER_CULL_CHUNKS
+            size_t CullChunks( size_t groupIndex , const Render::Camera & camera , const unsigned * & pclOrder ) ;
+#       endif
+#       if PARTICLES_RENDER_LEVEL_OF_DETAIL
+            size_t SelectLevelOfDetail( size_t groupIndex , const Render::Camera & camera , size_t numPclsToFill , const unsigned * & pclOrder , const float * & opacityScales ) ;
+#       endif
 
             void FillVertexBufferPerGroup( const double & timeNow , const struct Mat44 & viewMatrix ) ;
+            void FillVertexBuffers( const double & timeNow , const struct Mat44 & viewMatrix ) ;
 
             void CreateAndFillVertexBufferPerGroup( const double & timeNow ) ;
 
+            bool HasActivePasses( bool orderIndependent ) ;
+            void RenderPasses( Render::ApiBase * renderApi , bool orderIndependent ) ;
+
             ParticleSystem *    mParticleSystem                 ;   /// Particle system associated with this object.
 
+            bool    mUseOrderIndependentTransparency        ;   /// Whether passes with order-independent blend state accumulate without sorting, if the render API supports that.
+            bool    mIsOrderIndependentTransparencySupported ;  /// Whether the render API accepted the most recent request to accumulate order-independent passes.  Assumed true until it refuses.
+            unsigned mResolutionDivisor                     ;   /// Ratio of window resolution to resolution at which particles render.  See SetResolutionDivisor.
+            float   mMinProjectedSize                       ;   /// Projected width, in pixels, below which particles thin out.  See SetMinProjectedSize.
+
             PclSysVertexBufferFillerContainers * mVertexBufferFillerContainers ; // Jagged multidimensional array of vertex buffer fillers
 
+#       if PARTICLES_RENDER_SORT_PARTICLES
+            VECTOR< DepthSorter >   mDepthSorters   ;   /// Back-to-front order of particles, one per particle group.
+#           if PARTICLE_GROUP_STABLE_IDS
+            VECTOR< VECTOR< unsigned > > mSortedIds ;   /// Identifiers of particles in the order the most recent sort left, one per particle group.  Lets sorting resume across kills and reordering.
+#           endif
+#       endif
+
+#       if PARTICLES_RENDER_CULL_CHUNKS
+            VECTOR< unsigned char > mChunkVisibility        ;   /// Scratch space: Whether each chunk of the group being filled could be visible.
+            VECTOR< VECTOR< unsigned > > mVisibleParticleOrder ; /// Scratch space, one per particle group: Indices of particles in chunks that could be visible.
+#       endif
+
+#       if PARTICLES_RENDER_LEVEL_OF_DETAIL
+            VECTOR< VECTOR< unsigned > > mDetailParticleOrder ;  /// Scratch space, one per particle group: Indices of particles that survive thinning.
+            VECTOR< VECTOR< float > >    mDetailOpacityScales ;  /// Scratch space, one per particle group: Opacity scale of each particle in mDetailParticleOrder.
+#       endif
+
+            VECTOR< VertexFillJobS > mFillJobs      ;   /// Scratch space: Vertex buffers to fill this frame, gathered by FillVertexBufferPerGroup.
+            VECTOR< size_t >        mFillJobStarts  ;   /// Scratch space: Offset of first particle of each fill job, within particles of all jobs laid end to end.
+
 #       if USE_TBB
             friend class ParticleRenderer_FillVertexBuffer_TBB ;
 #       endif
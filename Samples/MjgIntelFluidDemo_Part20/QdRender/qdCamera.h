@@ -54,6 +54,22 @@ class QdCamera
         }
 
 
+        /** Get world-space directions of the view axes, which are the rows of the rotation part of the view matrix that SetCamera loads.
+
+            \param right    Direction of view-space +X.
+            \param up       Direction of view-space +Y.
+            \param forward  Direction of view-space +Z, which points from target toward eye, since OpenGL views look along -Z.
+
+            Unlike reading back GL_MODELVIEW_MATRIX, this works without a render context.
+        */
+        void            GetViewAxes( Vec3 & right , Vec3 & up , Vec3 & forward ) const
+        {
+            forward = ( mEye - mTarget ).GetDir() ;
+            right   = ( mUp ^ forward ).GetDir() ;
+            up      = forward ^ right ;
+        }
+
+
         /** Set camera position in spherical coordinates, relative to target. */
         void SetOrbit( float azimuth , float elevation , float radius )
         {
@@ -22,6 +22,8 @@
 
 #include "Core/Math/mat4.h"
 
+#include "Core/Memory/streamingStore.h"
+
 #include "Core/Performance/perfBlock.h"
 
 #include "qdParticleMaterial.h"
@@ -273,10 +275,6 @@ QdParticleRenderer::QdParticleRenderer( const char * pParticleData , size_t stri
     , mVertexBuffer( 0 )
     , mVertexBufferCapacity( 0 )
     , mMaterial( material )
-#if SORT_PARTICLES
-    , mIndices( 0 )
-    , mIndicesCapacity( 0 )
-#endif
 #if USE_SEPARATE_VBOS
     , mVertexBufferGrew( true )
 #endif
@@ -308,15 +306,6 @@ QdParticleRenderer::~QdParticleRenderer()
 
     mVertexBuffer           = 0 ;
     mVertexBufferCapacity   = 0 ;
-
-#if SORT_PARTICLES
-    if( mIndices != 0 )
-    {
-        free( mIndices ) ;
-        mIndices = 0 ;
-        mIndicesCapacity = 0 ;
-    }
-#endif
 }
 
 
@@ -471,30 +460,6 @@ void QdParticleRenderer::CreateVertexBuffer( double timeNow , unsigned & vertexF
 
 
 
-#if SORT_PARTICLES
-static int CompareParticles( const void * p0 , const void * p1 )
-{
-    QdParticleRenderer::ParticleIndex * pi0 = (QdParticleRenderer::ParticleIndex *) p0 ;
-    QdParticleRenderer::ParticleIndex * pi1 = (QdParticleRenderer::ParticleIndex *) p1 ;
-    //return pi0->mDepth - pi1->mDepth ;
-    if ( pi0->mDepth > pi1->mDepth )
-    {
-        return 1 ;
-    }
-    else if ( pi0->mDepth < pi1->mDepth )
-    {
-        return -1 ;
-    }
-    else
-    {
-        return 0 ;
-    }
-}
-#endif
-
-
-
-
 #if SORT_PARTICLES
 /** Assign indices used to access particle data and sort them by depth.
 
@@ -508,31 +473,7 @@ void QdParticleRenderer::AssignIndicesAndSortParticles( const Vec3 & viewForward
 {
     PERF_BLOCK( ParticleRenderer__AssignIndicesAndSortParticles ) ;
 
-    if( numParticles > mIndicesCapacity )
-    {   // Need to allocate more space for particle index map
-        if( mIndices != 0 )
-        {   // Index map already exists so delete it first
-            free( mIndices ) ;
-        }
-        mIndices    = (ParticleIndex *) malloc( sizeof( ParticleIndex ) * numParticles ) ;
-        mIndicesCapacity = numParticles ;
-    }
-
-    for( unsigned iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
-    {   // For each particle...
-        const char *    pPos    = mParticleData + iPcl * mStride ;
-        const Vec3   &  pclPos  = * ( (Vec3*) pPos) ;
-        // Assign particle index map values.
-        // Later these will be sorted and therefore by proxy so will the particles
-        mIndices[ iPcl ].mPcl   = iPcl ;
-        mIndices[ iPcl ].mDepth = pclPos * viewForward ;
-    }
-
-    static bool bSort = true ;
-    if( bSort )
-    {
-        qsort( mIndices , numParticles , sizeof( ParticleIndex ) , CompareParticles ) ;
-    }
+    mDepthSorter.Sort( mParticleData , mStride , numParticles , viewForward ) ;
 }
 #endif
 
@@ -575,9 +516,12 @@ void QdParticleRenderer::FillVertexBufferSlice_Oriented( const double & timeNow
 
     // Fill vertex buffer with oriented particles.
     VertexFormatPositionNormalTexture * pVertices = ( VertexFormatPositionNormalTexture * ) mVertexBuffer ;
+#if USE_STREAMING_STORES
+    const bool streamQuads = StreamingStore_IsAligned( pVertices ) ;    // Each quadrilateral spans 128 bytes, so stays aligned if the buffer is.
+#endif
     for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
     {   // For each particle in this slice...
-        const char *    pPos        = mParticleData + mIndices[ iPcl ].mPcl * mStride ;
+        const char *    pPos        = mParticleData + mDepthSorter[ iPcl ] * mStride ;
         const char *    pAngVel     = pPos + mOffsetToAngVel ;
         const char *    pSize       = pPos + mOffsetToSize ;
         const Vec3  &   pclPos      = * ( (Vec3*) pPos ) ;
@@ -593,46 +537,61 @@ void QdParticleRenderer::FillVertexBufferSlice_Oriented( const double & timeNow
         //const float &   rDensityInfo    = * ( (float*) pDensityInfo ) ;
 
         // Assign positions and texture coordinates for each vertex of the quadrilateral.
-        pVertices[ iPcl*nvpp   ].tu = 1.0f ;
-        pVertices[ iPcl*nvpp   ].tv = v0Heavy ;
-        pVertices[ iPcl*nvpp   ].nx = ( pclRight.x + pclUp.x ) + fraction * viewForward.x ;
-        pVertices[ iPcl*nvpp   ].ny = ( pclRight.y + pclUp.y ) + fraction * viewForward.y ;
-        pVertices[ iPcl*nvpp   ].nz = ( pclRight.z + pclUp.z ) + fraction * viewForward.z ;
-        ((Vec3*) (&pVertices[ iPcl*nvpp   ].nx))->NormalizeFast() ;
-        pVertices[ iPcl*nvpp   ].px = ( pclPos.x + pclRight.x + pclUp.x ) ;
-        pVertices[ iPcl*nvpp   ].py = ( pclPos.y + pclRight.y + pclUp.y ) ;
-        pVertices[ iPcl*nvpp   ].pz = ( pclPos.z + pclRight.z + pclUp.z ) ;
-
-        pVertices[ iPcl*nvpp+1 ].tu = 0.0f ;
-        pVertices[ iPcl*nvpp+1 ].tv = v0Heavy ;
-        pVertices[ iPcl*nvpp+1 ].nx = ( - pclRight.x + pclUp.x ) + fraction * viewForward.x ;
-        pVertices[ iPcl*nvpp+1 ].ny = ( - pclRight.y + pclUp.y ) + fraction * viewForward.y ;
-        pVertices[ iPcl*nvpp+1 ].nz = ( - pclRight.z + pclUp.z ) + fraction * viewForward.z ;
-        ((Vec3*) (&pVertices[ iPcl*nvpp+1 ].nx))->NormalizeFast() ;
-        pVertices[ iPcl*nvpp+1 ].px = ( pclPos.x - pclRight.x + pclUp.x ) ;
-        pVertices[ iPcl*nvpp+1 ].py = ( pclPos.y - pclRight.y + pclUp.y ) ;
-        pVertices[ iPcl*nvpp+1 ].pz = ( pclPos.z - pclRight.z + pclUp.z ) ;
-
-        pVertices[ iPcl*nvpp+2 ].tu = 0.0f ;
-        pVertices[ iPcl*nvpp+2 ].tv = v1Heavy ;
-        pVertices[ iPcl*nvpp+2 ].nx = ( - pclRight.x - pclUp.x ) + fraction * viewForward.x ;
-        pVertices[ iPcl*nvpp+2 ].ny = ( - pclRight.y - pclUp.y ) + fraction * viewForward.y ;
-        pVertices[ iPcl*nvpp+2 ].nz = ( - pclRight.z - pclUp.z ) + fraction * viewForward.z ;
-        ((Vec3*) (&pVertices[ iPcl*nvpp+2 ].nx))->NormalizeFast() ;
-        pVertices[ iPcl*nvpp+2 ].px = ( pclPos.x - pclRight.x - pclUp.x ) ;
-        pVertices[ iPcl*nvpp+2 ].py = ( pclPos.y - pclRight.y - pclUp.y ) ;
-        pVertices[ iPcl*nvpp+2 ].pz = ( pclPos.z - pclRight.z - pclUp.z ) ;
-
-        pVertices[ iPcl*nvpp+3 ].tu = 1.0f ;
-        pVertices[ iPcl*nvpp+3 ].tv = v1Heavy ;
-        pVertices[ iPcl*nvpp+3 ].nx = ( pclRight.x - pclUp.x ) + fraction * viewForward.x ;
-        pVertices[ iPcl*nvpp+3 ].ny = ( pclRight.y - pclUp.y ) + fraction * viewForward.y ;
-        pVertices[ iPcl*nvpp+3 ].nz = ( pclRight.z - pclUp.z ) + fraction * viewForward.z ;
-        ((Vec3*) (&pVertices[ iPcl*nvpp+3 ].nx))->NormalizeFast() ;
-        pVertices[ iPcl*nvpp+3 ].px = ( pclPos.x + pclRight.x - pclUp.x ) ;
-        pVertices[ iPcl*nvpp+3 ].py = ( pclPos.y + pclRight.y - pclUp.y ) ;
-        pVertices[ iPcl*nvpp+3 ].pz = ( pclPos.z + pclRight.z - pclUp.z ) ;
+    #if USE_STREAMING_STORES
+        VertexFormatPositionNormalTexture   staging[ nvpp ] ;  // Quadrilateral to stream into buffer.
+        VertexFormatPositionNormalTexture * pQuad = streamQuads ? staging : & pVertices[ iPcl*nvpp ] ;
+    #else
+        VertexFormatPositionNormalTexture * pQuad = & pVertices[ iPcl*nvpp ] ;
+    #endif
+        pQuad[ 0 ].tu = 1.0f ;
+        pQuad[ 0 ].tv = v0Heavy ;
+        pQuad[ 0 ].nx = ( pclRight.x + pclUp.x ) + fraction * viewForward.x ;
+        pQuad[ 0 ].ny = ( pclRight.y + pclUp.y ) + fraction * viewForward.y ;
+        pQuad[ 0 ].nz = ( pclRight.z + pclUp.z ) + fraction * viewForward.z ;
+        ((Vec3*) (&pQuad[ 0 ].nx))->NormalizeFast() ;
+        pQuad[ 0 ].px = ( pclPos.x + pclRight.x + pclUp.x ) ;
+        pQuad[ 0 ].py = ( pclPos.y + pclRight.y + pclUp.y ) ;
+        pQuad[ 0 ].pz = ( pclPos.z + pclRight.z + pclUp.z ) ;
+
+        pQuad[ 1 ].tu = 0.0f ;
+        pQuad[ 1 ].tv = v0Heavy ;
+        pQuad[ 1 ].nx = ( - pclRight.x + pclUp.x ) + fraction * viewForward.x ;
+        pQuad[ 1 ].ny = ( - pclRight.y + pclUp.y ) + fraction * viewForward.y ;
+        pQuad[ 1 ].nz = ( - pclRight.z + pclUp.z ) + fraction * viewForward.z ;
+        ((Vec3*) (&pQuad[ 1 ].nx))->NormalizeFast() ;
+        pQuad[ 1 ].px = ( pclPos.x - pclRight.x + pclUp.x ) ;
+        pQuad[ 1 ].py = ( pclPos.y - pclRight.y + pclUp.y ) ;
+        pQuad[ 1 ].pz = ( pclPos.z - pclRight.z + pclUp.z ) ;
+
+        pQuad[ 2 ].tu = 0.0f ;
+        pQuad[ 2 ].tv = v1Heavy ;
+        pQuad[ 2 ].nx = ( - pclRight.x - pclUp.x ) + fraction * viewForward.x ;
+        pQuad[ 2 ].ny = ( - pclRight.y - pclUp.y ) + fraction * viewForward.y ;
+        pQuad[ 2 ].nz = ( - pclRight.z - pclUp.z ) + fraction * viewForward.z ;
+        ((Vec3*) (&pQuad[ 2 ].nx))->NormalizeFast() ;
+        pQuad[ 2 ].px = ( pclPos.x - pclRight.x - pclUp.x ) ;
+        pQuad[ 2 ].py = ( pclPos.y - pclRight.y - pclUp.y ) ;
+        pQuad[ 2 ].pz = ( pclPos.z - pclRight.z - pclUp.z ) ;
+
+        pQuad[ 3 ].tu = 1.0f ;
+        pQuad[ 3 ].tv = v1Heavy ;
+        pQuad[ 3 ].nx = ( pclRight.x - pclUp.x ) + fraction * viewForward.x ;
+        pQuad[ 3 ].ny = ( pclRight.y - pclUp.y ) + fraction * viewForward.y ;
+        pQuad[ 3 ].nz = ( pclRight.z - pclUp.z ) + fraction * viewForward.z ;
+        ((Vec3*) (&pQuad[ 3 ].nx))->NormalizeFast() ;
+        pQuad[ 3 ].px = ( pclPos.x + pclRight.x - pclUp.x ) ;
+        pQuad[ 3 ].py = ( pclPos.y + pclRight.y - pclUp.y ) ;
+        pQuad[ 3 ].pz = ( pclPos.z + pclRight.z - pclUp.z ) ;
+    #if USE_STREAMING_STORES
+        if( streamQuads )
+        {   // Stream quadrilateral, assembled in cache, into buffer.
+            StreamingStore_Copy( & pVertices[ iPcl*nvpp ] , staging , sizeof( staging ) ) ;
+        }
+    #endif
     }
+#if USE_STREAMING_STORES
+    StreamingStore_Fence() ;    // Make streamed vertices visible to the thread that unmaps the buffer.
+#endif
 }
 #endif
 
@@ -680,10 +639,13 @@ void QdParticleRenderer::FillVertexBufferSlice_SeparateVBOs( const double & time
     // times, and it's too much memory to fit in cache.
     {   // Assign texture coordinates.
         VertexFormatTex2 * pVertTC  = ( VertexFormatTex2 * ) mTexCoordBuffer ;
+    #if USE_STREAMING_STORES
+        const bool streamTexCoords = StreamingStore_IsAligned( pVertTC ) ;  // Each quadrilateral spans 32 bytes, so stays aligned if the buffer is.
+    #endif
         for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
         {   // For each particle in this slice...
 #       if SORT_PARTICLES
-            const char *    pPos            = mParticleData + mIndices[ iPcl ].mPcl * mStride ;
+            const char *    pPos            = mParticleData + mDepthSorter[ iPcl ] * mStride ;
 #       else
             const char *    pPos            = mParticleData + iPcl * mStride ;
 #       endif
@@ -710,21 +672,36 @@ void QdParticleRenderer::FillVertexBufferSlice_SeparateVBOs( const double & time
             // tex coord buffers each time a particle died or was emitted,
             // which would defeat the purpose of using separate buffers.
 
-            pVertTC[ iPcl*nvpp   ].tu = 1.0f ;
-            pVertTC[ iPcl*nvpp   ].tv = v0 ;
-
-            pVertTC[ iPcl*nvpp+1 ].tu = 0.0f ;
-            pVertTC[ iPcl*nvpp+1 ].tv = v0 ;
-
-            pVertTC[ iPcl*nvpp+2 ].tu = 0.0f ;
-            pVertTC[ iPcl*nvpp+2 ].tv = v1 ;
-
-            pVertTC[ iPcl*nvpp+3 ].tu = 1.0f ;
-            pVertTC[ iPcl*nvpp+3 ].tv = v1 ;
+        #if USE_STREAMING_STORES
+            VertexFormatTex2   staging[ nvpp ] ;  // Quadrilateral to stream into buffer.
+            VertexFormatTex2 * pQuad = streamTexCoords ? staging : & pVertTC[ iPcl*nvpp ] ;
+        #else
+            VertexFormatTex2 * pQuad = & pVertTC[ iPcl*nvpp ] ;
+        #endif
+            pQuad[ 0 ].tu = 1.0f ;
+            pQuad[ 0 ].tv = v0 ;
+
+            pQuad[ 1 ].tu = 0.0f ;
+            pQuad[ 1 ].tv = v0 ;
+
+            pQuad[ 2 ].tu = 0.0f ;
+            pQuad[ 2 ].tv = v1 ;
+
+            pQuad[ 3 ].tu = 1.0f ;
+            pQuad[ 3 ].tv = v1 ;
+        #if USE_STREAMING_STORES
+            if( streamTexCoords )
+            {   // Stream quadrilateral, assembled in cache, into buffer.
+                StreamingStore_Copy( & pVertTC[ iPcl*nvpp ] , staging , sizeof( staging ) ) ;
+            }
+        #endif
         }
     }
 
     VertexFormatPos3Col4 * pVertColPos = ( VertexFormatPos3Col4 * ) mVertexBuffer  ;
+#if USE_STREAMING_STORES
+    const bool streamQuads = StreamingStore_IsAligned( pVertColPos ) ;  // Each quadrilateral spans 64 bytes, so stays aligned if the buffer is.
+#endif
     for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
     {   // For each particle in this slice...
         // Obtain information about particle position, size and orientation.
@@ -757,38 +734,53 @@ void QdParticleRenderer::FillVertexBufferSlice_SeparateVBOs( const double & time
         }
 
         // Assign positions for each vertex of the quadrilateral.
-        pVertColPos[ iPcl*nvpp   ].col[0] = colorMod ;
-        pVertColPos[ iPcl*nvpp   ].col[1] = colorMod ;
-        pVertColPos[ iPcl*nvpp   ].col[2] = colorMod ;
-        pVertColPos[ iPcl*nvpp   ].col[3] = alphaMod ;
-        pVertColPos[ iPcl*nvpp   ].px     = ( pclPos.x + pclRight.x + pclUp.x ) ;
-        pVertColPos[ iPcl*nvpp   ].py     = ( pclPos.y + pclRight.y + pclUp.y ) ;
-        pVertColPos[ iPcl*nvpp   ].pz     = ( pclPos.z + pclRight.z + pclUp.z ) ;
-
-        pVertColPos[ iPcl*nvpp+1 ].col[0] = colorMod ;
-        pVertColPos[ iPcl*nvpp+1 ].col[1] = colorMod ;
-        pVertColPos[ iPcl*nvpp+1 ].col[2] = colorMod ;
-        pVertColPos[ iPcl*nvpp+1 ].col[3] = alphaMod ;
-        pVertColPos[ iPcl*nvpp+1 ].px     = ( pclPos.x - pclRight.x + pclUp.x ) ;
-        pVertColPos[ iPcl*nvpp+1 ].py     = ( pclPos.y - pclRight.y + pclUp.y ) ;
-        pVertColPos[ iPcl*nvpp+1 ].pz     = ( pclPos.z - pclRight.z + pclUp.z ) ;
-
-        pVertColPos[ iPcl*nvpp+2 ].col[0] = colorMod ;
-        pVertColPos[ iPcl*nvpp+2 ].col[1] = colorMod ;
-        pVertColPos[ iPcl*nvpp+2 ].col[2] = colorMod ;
-        pVertColPos[ iPcl*nvpp+2 ].col[3] = alphaMod ;
-        pVertColPos[ iPcl*nvpp+2 ].px     = ( pclPos.x - pclRight.x - pclUp.x ) ;
-        pVertColPos[ iPcl*nvpp+2 ].py     = ( pclPos.y - pclRight.y - pclUp.y ) ;
-        pVertColPos[ iPcl*nvpp+2 ].pz     = ( pclPos.z - pclRight.z - pclUp.z ) ;
-
-        pVertColPos[ iPcl*nvpp+3 ].col[0] = colorMod ;
-        pVertColPos[ iPcl*nvpp+3 ].col[1] = colorMod ;
-        pVertColPos[ iPcl*nvpp+3 ].col[2] = colorMod ;
-        pVertColPos[ iPcl*nvpp+3 ].col[3] = alphaMod ;
-        pVertColPos[ iPcl*nvpp+3 ].px     = ( pclPos.x + pclRight.x - pclUp.x ) ;
-        pVertColPos[ iPcl*nvpp+3 ].py     = ( pclPos.y + pclRight.y - pclUp.y ) ;
-        pVertColPos[ iPcl*nvpp+3 ].pz     = ( pclPos.z + pclRight.z - pclUp.z ) ;
+    #if USE_STREAMING_STORES
+        VertexFormatPos3Col4   staging[ nvpp ] ;  // Quadrilateral to stream into buffer.
+        VertexFormatPos3Col4 * pQuad = streamQuads ? staging : & pVertColPos[ iPcl*nvpp ] ;
+    #else
+        VertexFormatPos3Col4 * pQuad = & pVertColPos[ iPcl*nvpp ] ;
+    #endif
+        pQuad[ 0 ].col[0] = colorMod ;
+        pQuad[ 0 ].col[1] = colorMod ;
+        pQuad[ 0 ].col[2] = colorMod ;
+        pQuad[ 0 ].col[3] = alphaMod ;
+        pQuad[ 0 ].px     = ( pclPos.x + pclRight.x + pclUp.x ) ;
+        pQuad[ 0 ].py     = ( pclPos.y + pclRight.y + pclUp.y ) ;
+        pQuad[ 0 ].pz     = ( pclPos.z + pclRight.z + pclUp.z ) ;
+
+        pQuad[ 1 ].col[0] = colorMod ;
+        pQuad[ 1 ].col[1] = colorMod ;
+        pQuad[ 1 ].col[2] = colorMod ;
+        pQuad[ 1 ].col[3] = alphaMod ;
+        pQuad[ 1 ].px     = ( pclPos.x - pclRight.x + pclUp.x ) ;
+        pQuad[ 1 ].py     = ( pclPos.y - pclRight.y + pclUp.y ) ;
+        pQuad[ 1 ].pz     = ( pclPos.z - pclRight.z + pclUp.z ) ;
+
+        pQuad[ 2 ].col[0] = colorMod ;
+        pQuad[ 2 ].col[1] = colorMod ;
+        pQuad[ 2 ].col[2] = colorMod ;
+        pQuad[ 2 ].col[3] = alphaMod ;
+        pQuad[ 2 ].px     = ( pclPos.x - pclRight.x - pclUp.x ) ;
+        pQuad[ 2 ].py     = ( pclPos.y - pclRight.y - pclUp.y ) ;
+        pQuad[ 2 ].pz     = ( pclPos.z - pclRight.z - pclUp.z ) ;
+
+        pQuad[ 3 ].col[0] = colorMod ;
+        pQuad[ 3 ].col[1] = colorMod ;
+        pQuad[ 3 ].col[2] = colorMod ;
+        pQuad[ 3 ].col[3] = alphaMod ;
+        pQuad[ 3 ].px     = ( pclPos.x + pclRight.x - pclUp.x ) ;
+        pQuad[ 3 ].py     = ( pclPos.y + pclRight.y - pclUp.y ) ;
+        pQuad[ 3 ].pz     = ( pclPos.z + pclRight.z - pclUp.z ) ;
+    #if USE_STREAMING_STORES
+        if( streamQuads )
+        {   // Stream quadrilateral, assembled in cache, into buffer.
+            StreamingStore_Copy( & pVertColPos[ iPcl*nvpp ] , staging , sizeof( staging ) ) ;
+        }
+    #endif
     }
+#if USE_STREAMING_STORES
+    StreamingStore_Fence() ;    // Make streamed vertices visible to the thread that unmaps the buffers.
+#endif
 }
 #endif
 
@@ -839,10 +831,13 @@ void QdParticleRenderer::FillVertexBufferSlice( const double & timeNow , const M
 #   endif
     {   // Fill single vertex buffer with "plain" particles without normals
         VertexFormatPos3Col4Tex2 * pVertices = ( VertexFormatPos3Col4Tex2 * ) mVertexBuffer ;
+    #if USE_STREAMING_STORES
+        const bool streamQuads = StreamingStore_IsAligned( pVertices ) ;    // Each quadrilateral spans 96 bytes, so stays aligned if the buffer is.
+    #endif
         for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
         {   // For each particle in this slice...
 #       if SORT_PARTICLES
-            const char *    pPos            = mParticleData + mIndices[ iPcl ].mPcl * mStride ;
+            const char *    pPos            = mParticleData + mDepthSorter[ iPcl ] * mStride ;
 #       else
             const char *    pPos            = mParticleData + iPcl * mStride ;
 #       endif
@@ -884,46 +879,61 @@ const float     rHalfSize       = 0.05f ; (void) pSize ;
                 alphaMod = Clamp( massFraction * mMaterial.GetDensityVisibility() , 0.0f , 255.0f ) ;
             }
 
-            pVertices[ iPcl*nvpp   ].tu     = 1.0f ;
-            pVertices[ iPcl*nvpp   ].tv     = v0 ;
-            pVertices[ iPcl*nvpp   ].col[0] = colorMod ;
-            pVertices[ iPcl*nvpp   ].col[1] = colorMod ;
-            pVertices[ iPcl*nvpp   ].col[2] = colorMod ;
-            pVertices[ iPcl*nvpp   ].col[3] = alphaMod ;
-            pVertices[ iPcl*nvpp   ].px     = ( pclPos.x + pclRight.x + pclUp.x ) ;
-            pVertices[ iPcl*nvpp   ].py     = ( pclPos.y + pclRight.y + pclUp.y ) ;
-            pVertices[ iPcl*nvpp   ].pz     = ( pclPos.z + pclRight.z + pclUp.z ) ;
-
-            pVertices[ iPcl*nvpp+1 ].tu     = 0.0f ;
-            pVertices[ iPcl*nvpp+1 ].tv     = v0 ;
-            pVertices[ iPcl*nvpp+1 ].col[0] = colorMod ;
-            pVertices[ iPcl*nvpp+1 ].col[1] = colorMod ;
-            pVertices[ iPcl*nvpp+1 ].col[2] = colorMod ;
-            pVertices[ iPcl*nvpp+1 ].col[3] = alphaMod ;
-            pVertices[ iPcl*nvpp+1 ].px     = ( pclPos.x - pclRight.x + pclUp.x ) ;
-            pVertices[ iPcl*nvpp+1 ].py     = ( pclPos.y - pclRight.y + pclUp.y ) ;
-            pVertices[ iPcl*nvpp+1 ].pz     = ( pclPos.z - pclRight.z + pclUp.z ) ;
-
-            pVertices[ iPcl*nvpp+2 ].tu     = 0.0f ;
-            pVertices[ iPcl*nvpp+2 ].tv     = v1 ;
-            pVertices[ iPcl*nvpp+2 ].col[0] = colorMod ;
-            pVertices[ iPcl*nvpp+2 ].col[1] = colorMod ;
-            pVertices[ iPcl*nvpp+2 ].col[2] = colorMod ;
-            pVertices[ iPcl*nvpp+2 ].col[3] = alphaMod ;
-            pVertices[ iPcl*nvpp+2 ].px     = ( pclPos.x - pclRight.x - pclUp.x ) ;
-            pVertices[ iPcl*nvpp+2 ].py     = ( pclPos.y - pclRight.y - pclUp.y ) ;
-            pVertices[ iPcl*nvpp+2 ].pz     = ( pclPos.z - pclRight.z - pclUp.z ) ;
-
-            pVertices[ iPcl*nvpp+3 ].tu     = 1.0f ;
-            pVertices[ iPcl*nvpp+3 ].tv     = v1 ;
-            pVertices[ iPcl*nvpp+3 ].col[0] = colorMod ;
-            pVertices[ iPcl*nvpp+3 ].col[1] = colorMod ;
-            pVertices[ iPcl*nvpp+3 ].col[2] = colorMod ;
-            pVertices[ iPcl*nvpp+3 ].col[3] = alphaMod ;
-            pVertices[ iPcl*nvpp+3 ].px     = ( pclPos.x + pclRight.x - pclUp.x ) ;
-            pVertices[ iPcl*nvpp+3 ].py     = ( pclPos.y + pclRight.y - pclUp.y ) ;
-            pVertices[ iPcl*nvpp+3 ].pz     = ( pclPos.z + pclRight.z - pclUp.z ) ;
+        #if USE_STREAMING_STORES
+            VertexFormatPos3Col4Tex2   staging[ nvpp ] ;  // Quadrilateral to stream into buffer.
+            VertexFormatPos3Col4Tex2 * pQuad = streamQuads ? staging : & pVertices[ iPcl*nvpp ] ;
+        #else
+            VertexFormatPos3Col4Tex2 * pQuad = & pVertices[ iPcl*nvpp ] ;
+        #endif
+            pQuad[ 0 ].tu     = 1.0f ;
+            pQuad[ 0 ].tv     = v0 ;
+            pQuad[ 0 ].col[0] = colorMod ;
+            pQuad[ 0 ].col[1] = colorMod ;
+            pQuad[ 0 ].col[2] = colorMod ;
+            pQuad[ 0 ].col[3] = alphaMod ;
+            pQuad[ 0 ].px     = ( pclPos.x + pclRight.x + pclUp.x ) ;
+            pQuad[ 0 ].py     = ( pclPos.y + pclRight.y + pclUp.y ) ;
+            pQuad[ 0 ].pz     = ( pclPos.z + pclRight.z + pclUp.z ) ;
+
+            pQuad[ 1 ].tu     = 0.0f ;
+            pQuad[ 1 ].tv     = v0 ;
+            pQuad[ 1 ].col[0] = colorMod ;
+            pQuad[ 1 ].col[1] = colorMod ;
+            pQuad[ 1 ].col[2] = colorMod ;
+            pQuad[ 1 ].col[3] = alphaMod ;
+            pQuad[ 1 ].px     = ( pclPos.x - pclRight.x + pclUp.x ) ;
+            pQuad[ 1 ].py     = ( pclPos.y - pclRight.y + pclUp.y ) ;
+            pQuad[ 1 ].pz     = ( pclPos.z - pclRight.z + pclUp.z ) ;
+
+            pQuad[ 2 ].tu     = 0.0f ;
+            pQuad[ 2 ].tv     = v1 ;
+            pQuad[ 2 ].col[0] = colorMod ;
+            pQuad[ 2 ].col[1] = colorMod ;
+            pQuad[ 2 ].col[2] = colorMod ;
+            pQuad[ 2 ].col[3] = alphaMod ;
+            pQuad[ 2 ].px     = ( pclPos.x - pclRight.x - pclUp.x ) ;
+            pQuad[ 2 ].py     = ( pclPos.y - pclRight.y - pclUp.y ) ;
+            pQuad[ 2 ].pz     = ( pclPos.z - pclRight.z - pclUp.z ) ;
+
+            pQuad[ 3 ].tu     = 1.0f ;
+            pQuad[ 3 ].tv     = v1 ;
+            pQuad[ 3 ].col[0] = colorMod ;
+            pQuad[ 3 ].col[1] = colorMod ;
+            pQuad[ 3 ].col[2] = colorMod ;
+            pQuad[ 3 ].col[3] = alphaMod ;
+            pQuad[ 3 ].px     = ( pclPos.x + pclRight.x - pclUp.x ) ;
+            pQuad[ 3 ].py     = ( pclPos.y + pclRight.y - pclUp.y ) ;
+            pQuad[ 3 ].pz     = ( pclPos.z + pclRight.z - pclUp.z ) ;
+        #if USE_STREAMING_STORES
+            if( streamQuads )
+            {   // Stream quadrilateral, assembled in cache, into buffer.
+                StreamingStore_Copy( & pVertices[ iPcl*nvpp ] , staging , sizeof( staging ) ) ;
+            }
+        #endif
         }
+    #if USE_STREAMING_STORES
+        StreamingStore_Fence() ;    // Make streamed vertices visible to the thread that unmaps the buffer.
+    #endif
     }
 #endif
 }
@@ -958,7 +968,7 @@ void QdParticleRenderer::CreateAndFillVertexBuffer( double timeNow , unsigned &
 
     // Fill vertex buffer with geometric primitives (quadrilaterals)
     {
-        PERF_BLOCK( ParticleRenderer__CreateAndFillVertexBuffer_FillVertexBufferSlice ) ;
+        PERF_BLOCK_INNER( ParticleRenderer__CreateAndFillVertexBuffer_FillVertexBufferSlice ) ;
 
 #   if USE_TBB
         // Estimate grain size based on size of problem and number of processors.
@@ -18,6 +18,8 @@
 
 #include "Core/useTbb.h"
 
+#include "Core/Utility/depthSorter.h"
+
 struct Mat44 ;  // Forward declaration
 
 
@@ -38,6 +40,7 @@ struct Mat44 ;  // Forward declaration
     Translucent objects must be sorted for opacity blending math to work properly.
     Sorting, however, takes up a lot of time so we usually
     tolerate the visual artifacts of them not being sorted.
+    When enabled, DepthSorter sorts using a parallel radix sort.
 */
 #if USE_ORIENTED_LIT_PARTICLES  // oriented particles code assumes SORT_PARTICLES, not because this is technically required but just because it's what I happened to implement.
 #   define SORT_PARTICLES 1
@@ -67,6 +70,16 @@ struct Mat44 ;  // Forward declaration
 #   define USE_SEPARATE_VBOS 0
 #endif
 
+/** Enable non-temporal (streaming) stores into vertex buffers.
+
+    The CPU never reads back vertices, yet ordinary stores read each destination
+    line into cache, and leave it there, evicting particle data simulation threads need.
+    Vertex formats here make each quadrilateral span a whole number of 16-byte
+    streaming stores, so fill routines assemble each quadrilateral in cache, then
+    stream it into the vertex buffer, if the buffer is aligned.  See StreamingStore_Copy.
+*/
+#define USE_STREAMING_STORES 1
+
 class QdParticleMaterial ; // Forward declaration.
 
 /** Class to render particles.
@@ -74,13 +87,6 @@ class QdParticleMaterial ; // Forward declaration.
 class QdParticleRenderer
 {
     public:
-        /// Utility structure to sort particles by depth.
-        struct ParticleIndex
-        {
-            int     mPcl    ;   ///< index into particle arrays
-            float   mDepth  ;   ///< distance along view forward direction
-        } ;
-
         QdParticleRenderer( const char * pParticleData , size_t stride , size_t offsetToAngVel , size_t offsetToSize , size_t offsetToDensityInfo , QdParticleMaterial & material ) ;
         ~QdParticleRenderer() ;
 
@@ -108,8 +114,7 @@ class QdParticleRenderer
         QdParticleMaterial &        mMaterial                   ;   ///< Material used to render particles.
 
 #   if SORT_PARTICLES
-        ParticleIndex       *       mIndices                    ;   ///< buffer used to sort particles
-        size_t                      mIndicesCapacity            ;   ///< number of elements in mIndices
+        DepthSorter                 mDepthSorter                ;   ///< Order in which to render particles, back to front.
 #   endif
 
 #   if USE_SEPARATE_VBOS
@@ -5,6 +5,10 @@
     \author Copyright 2008-2014 MJG; All rights reserved.
 */
 
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,10 +23,76 @@
 #include "WavefrontObj.h"
 
 // Types --------------------------------------------------------------
+
+/*! \brief Header at the start of a binary cache of a parsed Wavefront OBJ file.
+
+    Arrays of positions, normals and texture coordinates (each Vec4) and
+    indices (each int) follow the header, in that order, in the layout
+    the GPU reads, so loading needs no parsing.
+*/
+struct WavefrontObjCacheHeader
+{
+    static const unsigned sMagic    = 0x4a424f4d ;  ///< "MOBJ" in little-endian byte order.
+    static const unsigned sVersion  = 1 ;           ///< Increment this whenever the file layout changes.
+
+    unsigned            mMagic          ;   ///< Identifies file as an OBJ cache.  Must equal sMagic.
+    unsigned            mVersion        ;   ///< Version of file layout.  Must equal sVersion.
+    unsigned long long  mSourceSize     ;   ///< Size, in bytes, of OBJ file when cached.
+    unsigned long long  mSourceModTime  ;   ///< Modification time of OBJ file when cached.
+    unsigned            mNumPositions   ;   ///< Number of vertex positions.
+    unsigned            mNumNormals     ;   ///< Number of vertex normals.
+    unsigned            mNumTexCoords   ;   ///< Number of vertex texture coordinates.
+    unsigned            mNumIndices     ;   ///< Number of indices, 3 per triangle.
+    unsigned            mHasTexCoords   ;   ///< Whether geometry has texture coordinates.
+    unsigned            mHasNormals     ;   ///< Whether geometry has normals.
+
+    /// Return number of bytes of arrays following this header.
+    unsigned long long GetDataSize() const
+    {
+        return ( static_cast< unsigned long long >( mNumPositions ) + mNumNormals + mNumTexCoords ) * sizeof( Vec4 )
+            +    static_cast< unsigned long long >( mNumIndices ) * sizeof( int ) ;
+    }
+} ;
+
 // Private variables --------------------------------------------------------------
 // Public variables --------------------------------------------------------------
+
+const char * const WavefrontObjFile::sCacheSuffix = ".cache" ;
+
 // Private functions --------------------------------------------------------------
 
+
+
+
+/*! \brief Replace contents of the given container with the given array.
+*/
+template< typename ElementT > static const ElementT * CopyArray( Fiea::Vector< ElementT > & container , const ElementT * source , unsigned numElements )
+{
+    container.Clear() ;
+    container.Reserve( numElements ) ;
+    for( unsigned i = 0 ; i < numElements ; ++ i )
+    {
+        container.PushBack( source[ i ] ) ;
+    }
+    return source + numElements ;
+}
+
+
+
+
+/*! \brief Write the given container to the given file.
+
+    \return Whether writing succeeded.
+*/
+template< typename ElementT > static bool WriteArray( FILE * fp , const Fiea::Vector< ElementT > & container )
+{
+    return ( 0 == container.Size() ) || ( fwrite( & container.Front() , sizeof( ElementT ) , container.Size() , fp ) == container.Size() ) ;
+}
+
+
+
+
+
 void WavefrontObjFile::ParseLine( const char * buffer , size_t bufferSize )
 {
     ASSERT( buffer != 0 ) ;
@@ -370,6 +440,150 @@ void WavefrontObjFile::FillSimpleVertexContainers( void )
 
 
 
+/*! \brief Load vertex and index arrays from the given binary cache, if it describes the OBJ file with the given size and modification time.
+
+    \return Whether the cache existed, was intact and up to date.  Upon failure, this leaves geometry as it was.
+
+    On Windows this maps the cache, so the only copy is from the file cache
+    into the vertex arrays, and reading happens only as the copy touches pages.
+*/
+bool WavefrontObjFile::LoadFromCache( const char * strCacheFilename , unsigned long long sourceSize , unsigned long long sourceModTime )
+{
+    bool loaded = false ;
+
+#if defined( WIN32 )
+    HANDLE file = CreateFileA( strCacheFilename , GENERIC_READ , FILE_SHARE_READ , NULL , OPEN_EXISTING , FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN , NULL ) ;
+    if( INVALID_HANDLE_VALUE == file )
+    {
+        return false ;
+    }
+    LARGE_INTEGER fileSize ;
+    if( GetFileSizeEx( file , & fileSize ) && ( fileSize.QuadPart >= LONGLONG( sizeof( WavefrontObjCacheHeader ) ) ) )
+    {   // File is big enough to have a header.
+        HANDLE fileMapping = CreateFileMappingA( file , NULL , PAGE_READONLY , 0 , 0 , NULL ) ;
+        if( fileMapping )
+        {
+            const WavefrontObjCacheHeader * header = reinterpret_cast< const WavefrontObjCacheHeader * >( MapViewOfFile( fileMapping , FILE_MAP_READ , 0 , 0 , 0 ) ) ;
+            if( header )
+            {
+                if(     ( header->mMagic            == WavefrontObjCacheHeader::sMagic   )
+                    &&  ( header->mVersion          == WavefrontObjCacheHeader::sVersion )
+                    &&  ( header->mSourceSize       == sourceSize    )
+                    &&  ( header->mSourceModTime    == sourceModTime )
+                    &&  ( sizeof( * header ) + header->GetDataSize() <= static_cast< unsigned long long >( fileSize.QuadPart ) ) )
+                {   // Cache is intact and describes the OBJ file as it is now.
+                    const Vec4 * vec4s = reinterpret_cast< const Vec4 * >( header + 1 ) ;
+                    vec4s = CopyArray( mVertexPositions , vec4s , header->mNumPositions ) ;
+                    vec4s = CopyArray( mVertexNormals   , vec4s , header->mNumNormals   ) ;
+                    vec4s = CopyArray( mVertexTexCoords , vec4s , header->mNumTexCoords ) ;
+                    CopyArray( mIndices , reinterpret_cast< const int * >( vec4s ) , header->mNumIndices ) ;
+                    mHasTexCoords   = header->mHasTexCoords != 0 ;
+                    mHasNormals     = header->mHasNormals   != 0 ;
+                    loaded = true ;
+                }
+                UnmapViewOfFile( header ) ;
+            }
+            CloseHandle( fileMapping ) ;
+        }
+    }
+    CloseHandle( file ) ;
+#else
+    FILE * fp = fopen( strCacheFilename , "rb" ) ;
+    if( NULL == fp )
+    {
+        return false ;
+    }
+    fseek( fp , 0 , SEEK_END ) ;
+    const unsigned long long fileSize = static_cast< unsigned long long >( ftell( fp ) ) ;
+    fseek( fp , 0 , SEEK_SET ) ;
+    WavefrontObjCacheHeader header ;
+    if(     ( fread( & header , sizeof( header ) , 1 , fp ) == 1 )
+        &&  ( header.mMagic         == WavefrontObjCacheHeader::sMagic   )
+        &&  ( header.mVersion       == WavefrontObjCacheHeader::sVersion )
+        &&  ( header.mSourceSize    == sourceSize    )
+        &&  ( header.mSourceModTime == sourceModTime )
+        &&  ( sizeof( header ) + header.GetDataSize() <= fileSize ) )
+    {   // Cache is intact and describes the OBJ file as it is now.
+        char * data = reinterpret_cast< char * >( malloc( static_cast< size_t >( header.GetDataSize() ) + 1 ) ) ;
+        if( data && ( fread( data , 1 , static_cast< size_t >( header.GetDataSize() ) , fp ) == header.GetDataSize() ) )
+        {
+            const Vec4 * vec4s = reinterpret_cast< const Vec4 * >( data ) ;
+            vec4s = CopyArray( mVertexPositions , vec4s , header.mNumPositions ) ;
+            vec4s = CopyArray( mVertexNormals   , vec4s , header.mNumNormals   ) ;
+            vec4s = CopyArray( mVertexTexCoords , vec4s , header.mNumTexCoords ) ;
+            CopyArray( mIndices , reinterpret_cast< const int * >( vec4s ) , header.mNumIndices ) ;
+            mHasTexCoords   = header.mHasTexCoords != 0 ;
+            mHasNormals     = header.mHasNormals   != 0 ;
+            loaded = true ;
+        }
+        free( data ) ;
+    }
+    fclose( fp ) ;
+#endif
+
+    return loaded ;
+}
+
+
+
+
+/*! \brief Write vertex and index arrays to the given binary cache, tagged with the size and modification time of the OBJ file they came from.
+
+    \return Whether writing succeeded.
+
+    This writes to a temporary file then renames it, so a crash or a
+    concurrently starting instance never sees a partially written cache.
+*/
+bool WavefrontObjFile::SaveToCache( const char * strCacheFilename , unsigned long long sourceSize , unsigned long long sourceModTime ) const
+{
+    WavefrontObjCacheHeader header ;
+    memset( & header , 0 , sizeof( header ) ) ;
+    header.mMagic           = WavefrontObjCacheHeader::sMagic ;
+    header.mVersion         = WavefrontObjCacheHeader::sVersion ;
+    header.mSourceSize      = sourceSize ;
+    header.mSourceModTime   = sourceModTime ;
+    header.mNumPositions    = mVertexPositions.Size() ;
+    header.mNumNormals      = mVertexNormals.Size() ;
+    header.mNumTexCoords    = mVertexTexCoords.Size() ;
+    header.mNumIndices      = mIndices.Size() ;
+    header.mHasTexCoords    = mHasTexCoords ;
+    header.mHasNormals      = mHasNormals ;
+
+    char strTempFilename[ 1024 ] ;
+    if( strlen( strCacheFilename ) + 5 > sizeof( strTempFilename ) )
+    {   // Filename is too long to append suffix.
+        return false ;
+    }
+    strcpy( strTempFilename , strCacheFilename ) ;
+    strcat( strTempFilename , ".tmp" ) ;
+
+    FILE * fp = fopen( strTempFilename , "wb" ) ;
+    if( NULL == fp )
+    {
+        return false ;
+    }
+    bool ok =       ( fwrite( & header , sizeof( header ) , 1 , fp ) == 1 )
+                &&  WriteArray( fp , mVertexPositions )
+                &&  WriteArray( fp , mVertexNormals   )
+                &&  WriteArray( fp , mVertexTexCoords )
+                &&  WriteArray( fp , mIndices         ) ;
+    ok = ( 0 == fclose( fp ) ) && ok ;
+
+#if defined( WIN32 )
+    ok = ok && MoveFileExA( strTempFilename , strCacheFilename , MOVEFILE_REPLACE_EXISTING ) ;
+#else
+    ok = ok && ( 0 == rename( strTempFilename , strCacheFilename ) ) ;
+#endif
+    if( ! ok )
+    {
+        remove( strTempFilename ) ;
+    }
+    return ok ;
+}
+
+
+
+
 void WavefrontObjFile::LoadFromFile( const char * strFilename )
 {
     const char * strPathChosen ;
@@ -380,6 +594,25 @@ void WavefrontObjFile::LoadFromFile( const char * strFilename )
         int i ;
         i = errno ;
         ASSERT( 0 ) ;   // Check the value of errno to see what specific error occurred.
+        return ;
+    }
+
+    // Identify the OBJ file by size and modification time, so a stale cache, or one of another file, is never used.
+    char strCacheFilename[ 1024 ] ;
+    struct stat sourceStat ;
+    const bool canCache =       ( 0 == fstat( fileno( pFile ) , & sourceStat ) )
+                            &&  ( strlen( strPathChosen ) + strlen( sCacheSuffix ) < sizeof( strCacheFilename ) ) ;
+    const unsigned long long sourceSize     = canCache ? static_cast< unsigned long long >( sourceStat.st_size  ) : 0 ;
+    const unsigned long long sourceModTime  = canCache ? static_cast< unsigned long long >( sourceStat.st_mtime ) : 0 ;
+    if( canCache )
+    {
+        strcpy( strCacheFilename , strPathChosen ) ;
+        strcat( strCacheFilename , sCacheSuffix ) ;
+        if( LoadFromCache( strCacheFilename , sourceSize , sourceModTime ) )
+        {   // Cache is up to date, so skip parsing.
+            fclose( pFile ) ;
+            return ;
+        }
     }
 
     #if 0
@@ -427,4 +660,9 @@ void WavefrontObjFile::LoadFromFile( const char * strFilename )
         ReconstructFaces() ;
         FillSimpleVertexContainers() ;
     }
+
+    if( canCache )
+    {   // Save parsed geometry, so the next load can skip parsing.
+        SaveToCache( strCacheFilename , sourceSize , sourceModTime ) ;
+    }
 }
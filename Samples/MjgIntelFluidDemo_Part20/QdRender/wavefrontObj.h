@@ -29,8 +29,18 @@ class WavefrontObjFile
             mFaces.Clear()              ;
         }
 
+        /*! \brief Read geometry from the given Wavefront OBJ file, or from its binary side-car cache if that is up to date.
+
+            Parsing text takes seconds for large meshes, so after parsing, this
+            writes the final vertex and index arrays to a file next to the
+            OBJ file, with sCacheSuffix appended to its name.  Later loads
+            map that file and copy the arrays out, as long as the OBJ file
+            has the same size and modification time it had when cached.
+        */
         void LoadFromFile( const char * strFilename ) ;
 
+        static const char * const sCacheSuffix ;   ///< Suffix appended to name of OBJ file to form name of its binary cache.
+
         /*! \brief Set a group name to include when extracting vertex information.
             
             A Wavefront OBJ file can contain multiple groups.
@@ -294,6 +304,8 @@ class WavefrontObjFile
 
         void ReconstructFaces( void ) ;
         void FillSimpleVertexContainers( void ) ;
+        bool LoadFromCache( const char * strCacheFilename , unsigned long long sourceSize , unsigned long long sourceModTime ) ;
+        bool SaveToCache( const char * strCacheFilename , unsigned long long sourceSize , unsigned long long sourceModTime ) const ;
 
         static const int            sNumGroupsMax = 32 ;
         const char *                mGroups[ sNumGroupsMax ]        ;   ///< addresses of names of groups to read
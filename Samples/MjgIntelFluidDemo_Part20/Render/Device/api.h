@@ -24,6 +24,7 @@ namespace PeGaSys
         class IndexBufferBase   ;
         class MeshBase          ;
         class TextureBase       ;
+        class GpuTimerBase      ;
         class ModelNode         ;
         class ModelData         ;
         struct RenderStateS     ;
@@ -49,9 +50,13 @@ namespace PeGaSys
             virtual void        SetCamera( const Camera & xView ) = 0 ;
             virtual void        SetLights( const ModelNode & lightReceiver ) = 0 ;
             virtual void        SetLocalToWorld( const Mat44 & localToWorld ) = 0 ;
+            virtual void        ResetLocalToWorld() = 0 ;
 
             virtual void        RenderSimpleText( const char * text , const Vec3 & position , bool useScreenSpace ) = 0 ;
 
+            /// Draw text that RenderSimpleText deferred, if this API defers it, e.g. to draw every line with one call.
+            virtual void        FlushSimpleText()                               {}
+
             virtual void        ApplyRenderState( const RenderStateS & renderState ) = 0 ;
             virtual void        GetRenderState( RenderStateS & renderState ) = 0 ;
             virtual void        DisableTexturing() = 0 ;
@@ -61,6 +66,58 @@ namespace PeGaSys
             virtual void                DeleteIndexBuffer( IndexBufferBase * indexBuffer ) = 0 ;
             virtual MeshBase *          NewMesh( ModelData * owningModelData ) = 0 ;
             virtual TextureBase *       NewTexture() = 0 ;
+
+            /// Return address of timer that measures GPU render passes for this API, which the API owns and might not support.
+            virtual GpuTimerBase *      GetGpuTimer() = 0 ;
+
+            /** Start accumulating passes whose blend state is order-independent, or return false if this API cannot.
+
+                Between this and EndOrderIndependentTransparency, passes with
+                BlendStateS::mOrderIndependent render into offscreen targets that
+                accumulate their colors and transmittances, so draw order does
+                not matter, and they depth test against what the current target
+                already has.  Only such passes may render in between.
+                When this returns false, they blend as ordinary alpha passes.
+            */
+            virtual bool        BeginOrderIndependentTransparency()             { return false ; }
+
+            /// Composite passes accumulated since BeginOrderIndependentTransparency onto the current target.
+            virtual void        EndOrderIndependentTransparency()               { FAIL() ; }
+
+            /** Start rendering into an offscreen target with resolution reduced by the given divisor, or return false if this API cannot.
+
+                Between this and EndReducedResolution, passes render into a
+                target whose width and height are the current viewport's
+                divided by divisor, which depth tests against what the current
+                target already has.  That costs divisor squared fewer pixels,
+                which suits fill-rate-bound, low-frequency geometry such as
+                particle billboards.  Order-independent transparency can nest
+                inside.  When this returns false, passes render as usual.
+            */
+            virtual bool        BeginReducedResolution( unsigned divisor )      { (void) divisor ; return false ; }
+
+            /// Upsample what rendered since BeginReducedResolution onto the current target, respecting its depth edges.
+            virtual void        EndReducedResolution()                          { FAIL() ; }
+
+            /** Return number of command recorders that can record draw calls concurrently, on different threads, or 0 if this API only renders from the thread that owns it.
+
+                Between BeginCommandRecording and EndCommandRecording on a thread, calls
+                that thread makes to this API (and to meshes and textures it created)
+                record commands into the given recorder instead of rendering.
+                SubmitCommandRecordings then renders what those recorders recorded,
+                in recorder order.  Each recorder starts with default render state,
+                so recordings must set the camera, lights and render state they use.
+            */
+            virtual unsigned    GetNumCommandRecorders() const                  { return 0 ; }
+
+            /// Start recording, on the calling thread, into the given command recorder.  See GetNumCommandRecorders.
+            virtual void        BeginCommandRecording( unsigned /* iRecorder */ ) { FAIL() ; }
+
+            /// Stop recording, on the calling thread, into the given command recorder.  See GetNumCommandRecorders.
+            virtual void        EndCommandRecording( unsigned /* iRecorder */ )   { FAIL() ; }
+
+            /// Render commands recorded into recorders [0,numRecorders), in order, then discard them.  Call from the thread that owns this API.
+            virtual void        SubmitCommandRecordings( unsigned /* numRecorders */ ) { FAIL() ; }
         } ;
 
         // Public variables ------------------------------------------------------------
@@ -108,9 +108,13 @@ namespace PeGaSys {
             for( size_t line = 0 ; line < mNumLinesPopulated ; ++ line )
             {   // For each line of text in this overlay...
                 float yPos = verticalSpacing * (float) ( line + 1 ) ;
-                // Render line by calling api->RenderSimpleText
+                // Queue line by calling api->RenderSimpleText
                 mRenderApi->RenderSimpleText( mTextLines[ line ] , Vec3( 0.0f , yPos , 0.0f ) , /* use screen space */ true ) ;
             }
+            if( mNumLinesPopulated > 0 )
+            {   // Draw every queued line at once.
+                mRenderApi->FlushSimpleText() ;
+            }
             // TODO (maybe): Restore previous projection. -- if above routine removes screen-space parameter
         }
 
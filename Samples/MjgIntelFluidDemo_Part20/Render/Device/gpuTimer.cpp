@@ -0,0 +1,240 @@
+/** \file gpuTimer.cpp
+
+    \brief Base class for measuring durations of GPU render passes with timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Device/gpuTimer.h"
+
+#include <Core/Performance/perfGpu.h>
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct GPU timer.
+
+            This does not create queries; the first BeginFrame does, since that requires a current render context.
+        */
+        GpuTimerBase::GpuTimerBase()
+            : mCurrentFrame( 0 )
+            , mNumPending( 0 )
+            , mPassDepth( 0 )
+            , mUseQueries( -1 )
+            , mIsFrameOpen( false )
+        {
+            PERF_BLOCK( GpuTimerBase__GpuTimerBase ) ;
+
+            for( size_t iFrame = 0 ; iFrame < sNumFramesInFlight ; ++ iFrame )
+            {
+                Frame & frame = mFrames[ iFrame ] ;
+                frame.mNumPasses    = 0 ;
+                frame.mNumQueries   = 0 ;
+                frame.mCpuBeginTime = 0 ;
+            }
+        }
+
+
+
+
+        /** Destruct GPU timer, discarding frames not yet resolved.
+
+            Derived classes delete their queries.
+        */
+        GpuTimerBase::~GpuTimerBase()
+        {
+            PERF_BLOCK( GpuTimerBase__dtor ) ;
+        }
+
+
+
+
+        /** Resolve frames whose query results have become available, then start measuring a new frame.
+
+            If every frame in the ring still awaits results, because the GPU
+            lags more than sNumFramesInFlight frames behind, this frame goes
+            unmeasured, rather than wait for the GPU.
+        */
+        void GpuTimerBase::BeginFrame()
+        {
+            PERF_BLOCK( GpuTimerBase__BeginFrame ) ;
+
+            ASSERT( ! mIsFrameOpen ) ;  // Each BeginFrame must have a matching EndFrame.
+
+            if( mUseQueries < 0 )
+            {   // First frame.  Determine whether API supports timestamp queries.
+                mUseQueries = CreateQueries() ? 1 : 0 ;
+            }
+            if( ! mUseQueries )
+            {
+                return ;
+            }
+
+            ResolveCompletedFrames() ;
+
+            if( mNumPending >= sNumFramesInFlight )
+            {   // GPU has not yet executed queries of any frame in ring.
+                return ;
+            }
+
+            Frame & frame = mFrames[ mCurrentFrame ] ;
+            frame.mNumPasses    = 0 ;
+            frame.mNumQueries   = 1 ;
+
+            BeginFrameQueries( mCurrentFrame ) ;
+
+            LARGE_INTEGER cpuTime ;
+            QueryPerformanceCounter( & cpuTime ) ;
+            IssueTimestamp( mCurrentFrame , 0 ) ;
+            frame.mCpuBeginTime = cpuTime.QuadPart ;
+
+            mPassDepth   = 0 ;
+            mIsFrameOpen = true ;
+        }
+
+
+
+
+        /** Stop measuring the current frame.
+
+            Call this after issuing the last command of the frame, before swapping buffers.
+        */
+        void GpuTimerBase::EndFrame()
+        {
+            PERF_BLOCK( GpuTimerBase__EndFrame ) ;
+
+            if( ! mIsFrameOpen )
+            {   // BeginFrame did not start measuring this frame.
+                return ;
+            }
+
+            ASSERT( 0 == mPassDepth ) ; // Each BeginPass must have a matching EndPass within the same frame.
+
+            EndFrameQueries( mCurrentFrame ) ;
+
+            mCurrentFrame = ( mCurrentFrame + 1 ) % sNumFramesInFlight ;
+            ++ mNumPending ;
+            mIsFrameOpen = false ;
+        }
+
+
+
+
+        /** Issue a timestamp query that marks the start of a pass.
+
+            \param label    Name of pass.  Must persist for the process lifetime, as string literals do.
+
+            Passes can nest, in which case the GPU lane shows both, since their durations overlap.
+        */
+        void GpuTimerBase::BeginPass( const char * label )
+        {
+            if( ! mIsFrameOpen )
+            {
+                return ;
+            }
+
+            ASSERT( mPassDepth < sMaxPassDepth ) ;
+            if( mPassDepth >= sMaxPassDepth )
+            {
+                return ;
+            }
+
+            Frame & frame = mFrames[ mCurrentFrame ] ;
+            if( frame.mNumPasses >= sMaxPassesPerFrame )
+            {   // No room to measure another pass this frame.
+                mOpenPasses[ mPassDepth ++ ] = sMaxPassesPerFrame ;
+                return ;
+            }
+
+            Pass & pass = frame.mPasses[ frame.mNumPasses ] ;
+            pass.mLabel         = label ;
+            pass.mBeginQuery    = frame.mNumQueries ++ ;
+            pass.mEndQuery      = pass.mBeginQuery ;
+            IssueTimestamp( mCurrentFrame , pass.mBeginQuery ) ;
+            mOpenPasses[ mPassDepth ++ ] = frame.mNumPasses ++ ;
+        }
+
+
+
+
+        /** Issue a timestamp query that marks the end of the innermost pass begun but not yet ended.
+        */
+        void GpuTimerBase::EndPass()
+        {
+            if( ! mIsFrameOpen || ( 0 == mPassDepth ) )
+            {
+                return ;
+            }
+
+            const size_t iPass = mOpenPasses[ -- mPassDepth ] ;
+            if( iPass >= sMaxPassesPerFrame )
+            {   // BeginPass did not measure this pass.
+                return ;
+            }
+
+            Frame & frame = mFrames[ mCurrentFrame ] ;
+            Pass &  pass  = frame.mPasses[ iPass ] ;
+            pass.mEndQuery = frame.mNumQueries ++ ;
+            IssueTimestamp( mCurrentFrame , pass.mEndQuery ) ;
+        }
+
+
+
+
+        /** Record passes of frames, oldest first, whose query results are available.
+
+            This stops at the first frame whose results are not yet available,
+            so passes reach PerfGpuLane in the order the GPU executed them.
+        */
+        void GpuTimerBase::ResolveCompletedFrames()
+        {
+            PERF_BLOCK( GpuTimerBase__ResolveCompletedFrames ) ;
+
+            LARGE_INTEGER cpuTicksPerSecond ;
+            QueryPerformanceFrequency( & cpuTicksPerSecond ) ;
+
+            while( mNumPending > 0 )
+            {   // For each frame awaiting results, oldest first...
+                const size_t    iFrame  = ( mCurrentFrame + sNumFramesInFlight - mNumPending ) % sNumFramesInFlight ;
+                const Frame &   frame   = mFrames[ iFrame ] ;
+
+                ULONGLONG       timestamps[ sNumQueriesPerFrame ] ;
+                ULONGLONG       gpuTicksPerSecond = 0 ;
+                const ResultE   result  = ReadResults( iFrame , frame.mNumQueries , timestamps , gpuTicksPerSecond ) ;
+                if( RESULT_NOT_READY == result )
+                {   // GPU has not yet executed queries of this frame, hence of any later frame.
+                    break ;
+                }
+
+                -- mNumPending ;
+
+                if( ( RESULT_DISJOINT == result ) || ( 0 == gpuTicksPerSecond ) )
+                {   // Timestamps of this frame are meaningless, so discard them.
+                    continue ;
+                }
+
+                const double cpuTicksPerGpuTick = double( cpuTicksPerSecond.QuadPart ) / double( gpuTicksPerSecond ) ;
+                for( size_t iPass = 0 ; iPass < frame.mNumPasses ; ++ iPass )
+                {   // For each pass in frame...
+                    const Pass & pass = frame.mPasses[ iPass ] ;
+                    if( pass.mEndQuery == pass.mBeginQuery )
+                    {   // Pass never ended, so it has no duration.
+                        continue ;
+                    }
+                    const LONGLONG beginTime = frame.mCpuBeginTime + LONGLONG( double( timestamps[ pass.mBeginQuery ] - timestamps[ 0 ] ) * cpuTicksPerGpuTick ) ;
+                    const LONGLONG endTime   = frame.mCpuBeginTime + LONGLONG( double( timestamps[ pass.mEndQuery   ] - timestamps[ 0 ] ) * cpuTicksPerGpuTick ) ;
+                    PerfGpuLane::RecordPass( pass.mLabel , beginTime , endTime ) ;
+                }
+            }
+        }
+
+    } ;
+} ;
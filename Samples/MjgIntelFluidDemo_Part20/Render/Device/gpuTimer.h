@@ -0,0 +1,197 @@
+/** \file gpuTimer.h
+
+    \brief Base class for measuring durations of GPU render passes with timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_GPU_TIMER_H
+#define PEGASYS_RENDER_GPU_TIMER_H
+
+#include "Core/Performance/perfBlock.h" // For PROFILE, LONGLONG, ULONGLONG
+#include "Core/Utility/macros.h"       // For UNUSED_PARAM
+
+// Macros ----------------------------------------------------------------------
+
+#if PROFILE
+    /** Measure how long the GPU spends on commands issued within the enclosing lexical scope.
+
+        \param gpuTimer Address of GpuTimerBase with which to measure, or NULL to measure nothing.
+
+        \param label    Name of pass, as a C-style identifier, like PERF_BLOCK takes.
+    */
+    #define RENDER_GPU_PASS( gpuTimer , label ) ::PeGaSys::Render::ScopedGpuPass gpuPass_ ## label( gpuTimer , # label )
+#else
+    #define RENDER_GPU_PASS( gpuTimer , label )
+#endif
+
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Base class for measuring durations of GPU render passes with timestamp queries.
+
+            CPU profiling only shows render cost indirectly, as time the CPU
+            spends blocked in buffer swaps or maps.  This brackets each pass
+            with timestamp queries, which the GPU fills in once it executes
+            them.  Reading a query result before then would stall the CPU until
+            the GPU catches up, so this keeps a ring of frames of queries in
+            flight, and BeginFrame reads results of older frames only once the
+            API reports them available.
+
+            Resolved passes go to PerfGpuLane, which tallies them alongside
+            PerfBlock statistics and forwards them to PerfTrace.
+
+            Each frame's timestamps become CPU ticks by aligning the timestamp
+            that BeginFrame issues with the CPU time when BeginFrame ran.  So
+            pass durations are exact, and pass start times in traces are as
+            early as they could be; the GPU actually starts each frame at least
+            that late, by however many commands it had queued.
+
+            Usage, on the render thread:
+
+            \verbatim
+                gpuTimer->BeginFrame() ;
+                {
+                    RENDER_GPU_PASS( gpuTimer , Opaque ) ;
+                    // ...issue render commands...
+                }
+                gpuTimer->EndFrame() ;
+                SwapBuffers() ;
+            \endverbatim
+
+            Derived classes implement the API-specific queries.  If the API or
+            driver lacks timestamp queries, CreateQueries returns false and
+            this measures nothing, so callers need not check.
+        */
+        class GpuTimerBase
+        {
+            public:
+                /// Number of frames whose queries can be in flight, i.e. how many frames results lag behind their passes.
+                static const size_t sNumFramesInFlight  = 4 ;
+
+                /// Maximum number of passes to measure per frame.  Further passes go unmeasured.
+                static const size_t sMaxPassesPerFrame  = 32 ;
+
+                /// Maximum depth of nested passes.
+                static const size_t sMaxPassDepth       = 8 ;
+
+                GpuTimerBase() ;
+                virtual ~GpuTimerBase() ;
+
+                void    BeginFrame() ;
+                void    EndFrame() ;
+                void    BeginPass( const char * label ) ;
+                void    EndPass() ;
+
+            protected:
+                /// Number of timestamp queries per frame: one for the start of the frame, and two per pass.
+                static const size_t sNumQueriesPerFrame = 1 + 2 * sMaxPassesPerFrame ;
+
+                /// Outcome of reading results of queries of one frame.
+                enum ResultE
+                {
+                    RESULT_NOT_READY    ,   ///< GPU has not yet executed every query of the frame.
+                    RESULT_DISJOINT     ,   ///< GPU executed every query, but its clock changed during the frame, so results are meaningless.
+                    RESULT_READY            ///< Results are valid.
+                } ;
+
+                /** Create sNumFramesInFlight frames of sNumQueriesPerFrame timestamp queries each.
+
+                    \return Whether the API supports timestamp queries.  If not, this timer measures nothing.
+                */
+                virtual bool    CreateQueries() = 0 ;
+
+                /// Issue any API-specific queries needed at the start of the given frame.
+                virtual void    BeginFrameQueries( size_t iFrame ) { UNUSED_PARAM( iFrame ) ; }
+
+                /// Issue any API-specific queries needed at the end of the given frame.
+                virtual void    EndFrameQueries( size_t iFrame ) { UNUSED_PARAM( iFrame ) ; }
+
+                /// Issue the given timestamp query of the given frame, after all previously issued commands.
+                virtual void    IssueTimestamp( size_t iFrame , size_t iQuery ) = 0 ;
+
+                /** Read results of the first numQueries timestamp queries of the given frame, without waiting for the GPU.
+
+                    \param timestamps           Array of numQueries elements to receive GPU timestamps.
+
+                    \param gpuTicksPerSecond    Frequency of GPU timestamps, in ticks per second.
+                */
+                virtual ResultE ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond ) = 0 ;
+
+            private:
+                /** Label and queries of one pass.
+                */
+                struct Pass
+                {
+                    const char *    mLabel          ;   ///< Name of pass.  Must persist for the process lifetime, as string literals do.
+                    size_t          mBeginQuery     ;   ///< Index of timestamp query issued when pass began.
+                    size_t          mEndQuery       ;   ///< Index of timestamp query issued when pass ended.
+                } ;
+
+                /** Passes measured during one frame, whose query results might not yet be available.
+                */
+                struct Frame
+                {
+                    Pass            mPasses[ sMaxPassesPerFrame ]   ;   ///< Passes issued during frame.
+                    size_t          mNumPasses                      ;   ///< Number of populated elements of mPasses.
+                    size_t          mNumQueries                     ;   ///< Number of timestamp queries issued during frame.
+                    LONGLONG        mCpuBeginTime                   ;   ///< CPU time (in ticks) when BeginFrame issued timestamp query 0.
+                } ;
+
+                GpuTimerBase( const GpuTimerBase & ) ;              // Disallow copy
+                GpuTimerBase & operator=( const GpuTimerBase & ) ;  // Disallow assignment
+
+                void    ResolveCompletedFrames() ;
+
+                Frame       mFrames[ sNumFramesInFlight ]   ;   ///< Ring of frames of queries.
+                size_t      mCurrentFrame                   ;   ///< Index into mFrames of frame being issued.
+                size_t      mNumPending                     ;   ///< Number of frames issued but not yet resolved.  The oldest is at ( mCurrentFrame - mNumPending ) mod sNumFramesInFlight.
+                size_t      mOpenPasses[ sMaxPassDepth ]    ;   ///< Indices into current frame's mPasses of passes begun but not yet ended, innermost last.  sMaxPassesPerFrame marks an unmeasured pass.
+                size_t      mPassDepth                      ;   ///< Number of populated elements of mOpenPasses.
+                int         mUseQueries                     ;   ///< Whether API supports timestamp queries: 1 for yes, 0 for no, -1 for not yet queried.
+                bool        mIsFrameOpen                    ;   ///< Whether BeginFrame has been called without a matching EndFrame.
+        } ;
+
+
+
+
+        /** Measure one GPU pass for the lifetime of this object.
+
+            \see RENDER_GPU_PASS
+        */
+        class ScopedGpuPass
+        {
+            public:
+                ScopedGpuPass( GpuTimerBase * gpuTimer , const char * label )
+                    : mGpuTimer( gpuTimer )
+                {
+                    if( mGpuTimer )
+                    {
+                        mGpuTimer->BeginPass( label ) ;
+                    }
+                }
+
+                ~ScopedGpuPass()
+                {
+                    if( mGpuTimer )
+                    {
+                        mGpuTimer->EndPass() ;
+                    }
+                }
+
+            private:
+                ScopedGpuPass( const ScopedGpuPass & ) ;              // Disallow copy
+                ScopedGpuPass & operator=( const ScopedGpuPass & ) ;  // Disallow assignment
+
+                GpuTimerBase *  mGpuTimer   ;   ///< Non-owned address of timer that measures this pass, or NULL.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
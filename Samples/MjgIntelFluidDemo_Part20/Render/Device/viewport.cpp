@@ -74,6 +74,7 @@ namespace PeGaSys {
 
             const float viewportAspectRatio = GetRelWidth() * float( mTarget->GetWidth() ) / ( GetRelHeight() * float( mTarget->GetHeight() ) ) ;
             mCamera->SetAspectRatio( viewportAspectRatio ) ;
+            mCamera->SetViewportHeight( GetRelHeight() * float( mTarget->GetHeight() ) ) ;
 
             // Render scene.
             mCamera->RenderScene( currentVirtualTimeInSeconds ) ;
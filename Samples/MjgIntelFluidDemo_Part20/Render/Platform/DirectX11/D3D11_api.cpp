@@ -0,0 +1,423 @@
+/** \file D3D11_api.cpp
+
+    \brief Wrapper for routines specific to D3D11 render system API
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/debugPrint.h"
+#include "Core/Math/math.h"
+#include "Core/parallelExecution.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <math.h>
+
+#include <windows.h>
+
+#include <d3d11.h>
+
+#include "Render/Scene/camera.h"
+#include "Render/Scene/model.h"
+#include "Render/Device/target.h"
+#include "Render/Platform/DirectX11/D3D11_window.h"
+#include "Render/Platform/DirectX11/D3D11_api.h"
+#include "Render/Platform/DirectX11/D3D11_vertexBuffer.h"
+#include "Render/Platform/DirectX11/D3D11_indexBuffer.h"
+#include "Render/Platform/DirectX11/D3D11_mesh.h"
+#include "Render/Platform/DirectX11/D3D11_texture.h"
+
+extern ID3D11Device *           g_d3d11Device           ; // Direct3D rendering device
+extern ID3D11DeviceContext *    g_d3d11ImmediateContext ; // Direct3D immediate device context
+extern ID3D11RenderTargetView * g_d3d11RenderTargetView ; // View of back buffer
+extern ID3D11DepthStencilView * g_d3d11DepthStencilView ; // View of depth buffer
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct wrapper for routines specific to D3D11 render system API.
+
+            This creates no contexts; the first SetViewport does, since that requires a device.
+        */
+        D3D11_Api::D3D11_Api()
+            : mNumCommandRecorders( 0 )
+        {
+            for( unsigned iRecorder = 0 ; iRecorder < sMaxCommandRecorders ; ++ iRecorder )
+            {
+                mCommandRecorders[ iRecorder ].mCommandList = NULLPTR ;
+            }
+            D3D11_VIEWPORT viewport = { 0.0f , 0.0f , 1.0f , 1.0f , 0.0f , 1.0f } ;
+            mViewport = viewport ;
+
+            D3D11_RenderStateCache::SetImmediate( & mRenderStateCache ) ;
+        }
+
+
+
+
+        /** Destruct wrapper for routines specific to D3D11 render system API.
+        */
+        D3D11_Api::~D3D11_Api()
+        {
+            ReleaseCommandRecorders() ;
+            mTextBatch.Release() ;
+            mRenderStateCache.Release() ;
+            D3D11_RenderStateCache::SetImmediate( NULLPTR ) ;
+        }
+
+
+
+
+        /** Create a deferred context for each command recorder, up to one per worker thread.
+
+            \return Whether this created at least one command recorder.
+        */
+        bool D3D11_Api::CreateCommandRecorders()
+        {
+            ASSERT( 0 == mNumCommandRecorders ) ;
+            ASSERT( g_d3d11Device != NULLPTR ) ;
+
+            const unsigned numCommandRecorders = Min2( unsigned( sMaxCommandRecorders ) , static_cast< unsigned >( Parallel::GetNumThreads() ) ) ;
+            for( unsigned iRecorder = 0 ; iRecorder < numCommandRecorders ; ++ iRecorder )
+            {   // For each command recorder...
+                ID3D11DeviceContext * deferredContext = NULLPTR ;
+                if( FAILED( g_d3d11Device->CreateDeferredContext( 0 , & deferredContext ) ) )
+                {   // Driver could not create another deferred context, so make do with those it created.
+                    break ;
+                }
+                mCommandRecorders[ iRecorder ].mRenderStateCache.SetContext( deferredContext ) ;
+                ++ mNumCommandRecorders ;
+            }
+            return mNumCommandRecorders > 0 ;
+        }
+
+
+
+
+        /** Release command lists and deferred contexts of every command recorder.
+        */
+        void D3D11_Api::ReleaseCommandRecorders()
+        {
+            for( unsigned iRecorder = 0 ; iRecorder < mNumCommandRecorders ; ++ iRecorder )
+            {
+                CommandRecorder & recorder = mCommandRecorders[ iRecorder ] ;
+                if( recorder.mCommandList )
+                {
+                    recorder.mCommandList->Release() ;
+                    recorder.mCommandList = NULLPTR ;
+                }
+                recorder.mRenderStateCache.Release() ;
+            }
+            mNumCommandRecorders = 0 ;
+        }
+
+
+
+
+        /** Bind back buffer and depth buffer, and the most recent viewport, to the given context.
+        */
+        void D3D11_Api::BindRenderTargets( ID3D11DeviceContext * context )
+        {
+            context->OMSetRenderTargets( 1 , & g_d3d11RenderTargetView , g_d3d11DepthStencilView ) ;
+            context->RSSetViewports( 1 , & mViewport ) ;
+        }
+
+
+
+
+        /* virtual */ Window * D3D11_Api::NewWindow( Render::System * renderSystem )
+        {
+            Render::Window * window = NEW Render::D3D11_Window( renderSystem ) ;
+            return window ;
+        }
+
+
+
+
+        /** Set viewport on the immediate context, and clear it to its clear color, far depth and zero stencil.
+
+            Windows are the only render targets, and each renders into the
+            swap chain back buffer, whose views BindRenderTargets binds.
+        */
+        /* virtual */ void D3D11_Api::SetViewport( const Viewport & viewport )
+        {
+            if( NULLPTR == mRenderStateCache.GetContext() )
+            {   // First viewport since the window created the device.
+                g_d3d11ImmediateContext->AddRef() ; // Cache takes over this reference.
+                mRenderStateCache.SetContext( g_d3d11ImmediateContext ) ;
+                CreateCommandRecorders() ;
+            }
+
+            mViewport.TopLeftX  = floorf( viewport.GetRelLeft()   * float( viewport.GetTarget()->GetWidth()  ) ) ;
+            mViewport.TopLeftY  = floorf( viewport.GetRelTop()    * float( viewport.GetTarget()->GetHeight() ) ) ;
+            mViewport.Width     = floorf( viewport.GetRelWidth()  * float( viewport.GetTarget()->GetWidth()  ) ) ;
+            mViewport.Height    = floorf( viewport.GetRelHeight() * float( viewport.GetTarget()->GetHeight() ) ) ;
+            mViewport.MinDepth  = 0.0f ;
+            mViewport.MaxDepth  = 1.0f ;
+            BindRenderTargets( g_d3d11ImmediateContext ) ;
+
+            {
+                const Vec4 & clearColor = viewport.GetClearColor() ;
+                ASSERT( clearColor.w != 0.0f ) ; // Clear would have no effect if transparent.
+                const bool coversTarget =   ( 0.0f == mViewport.TopLeftX ) && ( 0.0f == mViewport.TopLeftY )
+                                        &&  ( float( viewport.GetTarget()->GetWidth()  ) == mViewport.Width  )
+                                        &&  ( float( viewport.GetTarget()->GetHeight() ) == mViewport.Height ) ;
+                if( coversTarget )
+                {   // Viewport covers the whole target, so clearing views has the same effect as D3D9 Clear, but faster.
+                    const FLOAT clearColorRgba[ 4 ] = { clearColor.x , clearColor.y , clearColor.z , clearColor.w } ;
+                    g_d3d11ImmediateContext->ClearRenderTargetView( g_d3d11RenderTargetView , clearColorRgba ) ;
+                    g_d3d11ImmediateContext->ClearDepthStencilView( g_d3d11DepthStencilView , D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL , 1.0f , 0 ) ;
+                }
+                else
+                {   // Clearing views would clear other viewports too, so fill only this one, like D3D9 Clear.
+                    mRenderStateCache.ClearViewport( clearColor ) ;
+                }
+            }
+        }
+
+
+
+
+        /** Set view and projection transforms, on the context of the calling thread.
+
+            These match those D3D9_Api::SetCamera makes with D3DXMatrixLookAtRH and D3DXMatrixPerspectiveFovRH.
+        */
+        /* virtual */ void D3D11_Api::SetCamera( const Camera & camera )
+        {
+            Mat44 viewMatrix ;
+            viewMatrix.SetView( camera.GetEye4() , camera.GetLookAt() , camera.GetUpApproximate() ) ;
+
+            const float yScale  = 1.0f / tanf( 0.5f * camera.GetFieldOfViewVert() * DEG2RAD ) ;
+            const float xScale  = yScale / camera.GetAspectRatio() ;
+            const float zNear   = camera.GetNearClipDist() ;
+            const float zFar    = camera.GetFarClipDist() ;
+            const Mat44 projectionMatrix(   xScale  , 0.0f      , 0.0f                              ,  0.0f
+                                        ,   0.0f    , yScale    , 0.0f                              ,  0.0f
+                                        ,   0.0f    , 0.0f      , zFar / ( zNear - zFar )           , -1.0f
+                                        ,   0.0f    , 0.0f      , zNear * zFar / ( zNear - zFar )   ,  0.0f ) ;
+
+            D3D11_RenderStateCache::GetCurrent().SetViewAndProjection( viewMatrix , projectionMatrix ) ;
+        }
+
+
+
+
+        /** Set the render state to use the light cached for the given receiver.
+
+            \note   Unlike Direct3D 9, models without normals ignore lights, rather than render black.
+        */
+        /* virtual */ void D3D11_Api::SetLights( const ModelNode & lightReceiver )
+        {
+            D3D11_RenderStateCache::GetCurrent().SetLights( lightReceiver ) ;
+        }
+
+
+
+
+        /* virtual */ void D3D11_Api::SetLocalToWorld( const Mat44 & localToWorld )
+        {
+            D3D11_RenderStateCache::GetCurrent().SetLocalToWorld( localToWorld ) ;
+        }
+
+
+
+
+        /** Restore world transform to identity.  Shaders keep world and view transforms separate, so the view transform is unaffected.
+        */
+        /* virtual */ void D3D11_Api::ResetLocalToWorld()
+        {
+            SetLocalToWorld( Mat4_xIdentity ) ;
+        }
+
+
+
+
+        /** Queue simple text for on-screen diagnostic messages, which FlushSimpleText draws.
+
+            Call this only on the thread that owns this API, since FlushSimpleText draws with the immediate context.
+        */
+        /* virtual */ void  D3D11_Api::RenderSimpleText( const char * text , const Vec3 & position , bool useScreenSpace )
+        {
+            PERF_BLOCK( D3D11_Api__RenderSimpleText ) ;
+
+            mTextBatch.AddText( position , useScreenSpace , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) , text , mViewport , mRenderStateCache ) ;
+        }
+
+
+
+
+        /** Draw all text queued by RenderSimpleText since the previous call, with a single draw call.
+        */
+        /* virtual */ void  D3D11_Api::FlushSimpleText()
+        {
+            PERF_BLOCK( D3D11_Api__FlushSimpleText ) ;
+
+            mTextBatch.Flush( mRenderStateCache ) ;
+        }
+
+
+
+
+        /* virtual */ VertexBufferBase *  D3D11_Api::NewVertexBuffer()
+        {
+            VertexBufferBase * vertexBuffer = NEW D3D11_VertexBuffer ;
+            return vertexBuffer ;
+        }
+
+
+
+
+        /* virtual */ IndexBufferBase *  D3D11_Api::NewIndexBuffer()
+        {
+            IndexBufferBase * indexBuffer = NEW D3D11_IndexBuffer ;
+            return indexBuffer ;
+        }
+
+
+
+
+        /* virtual */ void D3D11_Api::DeleteIndexBuffer( IndexBufferBase * indexBuffer )
+        {
+            delete indexBuffer ;
+        }
+
+
+
+
+        /* virtual */ MeshBase *  D3D11_Api::NewMesh( ModelData * owningModelData )
+        {
+            MeshBase * mesh = NEW D3D11_Mesh( owningModelData )  ;
+            return mesh ;
+        }
+
+
+
+
+        /* virtual */ TextureBase *  D3D11_Api::NewTexture()
+        {
+            TextureBase * texture = NEW D3D11_Texture ;
+            return texture ;
+        }
+
+
+
+
+        /* virtual */ void D3D11_Api::ApplyRenderState( const RenderStateS & renderState )
+        {
+            D3D11_RenderStateCache::GetCurrent().Apply( renderState ) ;
+        }
+
+
+
+
+        /* virtual */ void D3D11_Api::GetRenderState( RenderStateS & renderState )
+        {
+            D3D11_RenderStateCache::GetRenderState( renderState ) ;
+        }
+
+
+
+
+        /* virtual */ void D3D11_Api::DisableTexturing()
+        {
+            D3D11_RenderStateCache::GetCurrent().DisableTexturing() ;
+        }
+
+
+
+
+        /** Return number of deferred contexts that can record draw calls concurrently.
+
+            This is 0 until the first SetViewport creates them.
+        */
+        /* virtual */ unsigned D3D11_Api::GetNumCommandRecorders() const
+        {
+            return mNumCommandRecorders ;
+        }
+
+
+
+
+        /** Start recording, on the calling thread, into the deferred context of the given command recorder.
+
+            Deferred contexts start each command list with default state, so this
+            binds render targets and viewport, and forgets cached state.
+        */
+        /* virtual */ void D3D11_Api::BeginCommandRecording( unsigned iRecorder )
+        {
+            ASSERT( iRecorder < mNumCommandRecorders ) ;
+            CommandRecorder & recorder = mCommandRecorders[ iRecorder ] ;
+            ASSERT( NULLPTR == recorder.mCommandList ) ; // Previous recording was not submitted.
+
+            recorder.mRenderStateCache.Invalidate() ;
+            D3D11_RenderStateCache::SetCurrent( & recorder.mRenderStateCache ) ;
+            BindRenderTargets( recorder.mRenderStateCache.GetContext() ) ;
+        }
+
+
+
+
+        /** Stop recording, on the calling thread, and keep the recorded commands for SubmitCommandRecordings.
+        */
+        /* virtual */ void D3D11_Api::EndCommandRecording( unsigned iRecorder )
+        {
+            ASSERT( iRecorder < mNumCommandRecorders ) ;
+            CommandRecorder & recorder = mCommandRecorders[ iRecorder ] ;
+            ASSERT( & D3D11_RenderStateCache::GetCurrent() == & recorder.mRenderStateCache ) ;
+
+            HROK( recorder.mRenderStateCache.GetContext()->FinishCommandList( FALSE , & recorder.mCommandList ) ) ;
+            D3D11_RenderStateCache::SetCurrent( NULLPTR ) ;
+        }
+
+
+
+
+        /** Execute command lists of recorders [0,numRecorders), in order, on the immediate context.
+
+            Executing a command list resets immediate context state, so this then
+            rebinds render targets and viewport, and forgets cached state.
+        */
+        /* virtual */ void D3D11_Api::SubmitCommandRecordings( unsigned numRecorders )
+        {
+            ASSERT( numRecorders <= mNumCommandRecorders ) ;
+
+            for( unsigned iRecorder = 0 ; iRecorder < numRecorders ; ++ iRecorder )
+            {   // For each recorder, in order...
+                CommandRecorder & recorder = mCommandRecorders[ iRecorder ] ;
+                ASSERT( recorder.mCommandList != NULLPTR ) ;
+                g_d3d11ImmediateContext->ExecuteCommandList( recorder.mCommandList , FALSE ) ;
+                recorder.mCommandList->Release() ;
+                recorder.mCommandList = NULLPTR ;
+            }
+
+            BindRenderTargets( g_d3d11ImmediateContext ) ;
+            mRenderStateCache.Invalidate() ;
+        }
+
+
+
+
+#if defined( _DEBUG )
+
+        void D3D11_Api_UnitTest()
+        {
+            DebugPrintf( "D3D11_Api::UnitTest ----------------------------------------------\n" ) ;
+
+            {
+                D3D11_Api renderApi ;
+                ASSERT( 0 == renderApi.GetNumCommandRecorders() ) ;
+            }
+
+            DebugPrintf( "D3D11_Api::UnitTest: THE END ----------------------------------------------\n" ) ;
+        }
+#   endif
+
+    } ;
+} ;
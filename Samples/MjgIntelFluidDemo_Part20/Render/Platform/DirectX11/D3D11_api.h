@@ -0,0 +1,114 @@
+/** \file D3D11_api.h
+
+    \brief Wrapper for routines specific to D3D11 render system API
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_API_H
+#define PEGASYS_RENDER_D3D11_API_H
+
+#include "Render/Device/viewport.h"
+#include "Render/Device/api.h"
+
+#include "Render/Platform/DirectX11/D3D11_renderState.h"
+#include "Render/Platform/DirectX11/D3D11_gpuTimer.h"
+#include "Render/Platform/DirectX11/D3D11_textBatch.h"
+
+// Macros ----------------------------------------------------------------------
+
+#if defined( _DEBUG )
+#   define RENDER_CHECK_ERROR( sitch ) ::PeGaSys::Render::D3D11_Api::CheckError( # sitch )
+#   define HROK( hrExpr ) if( FAILED( hrExpr ) ) { FAIL() ; }
+#else
+#   define RENDER_CHECK_ERROR( sitch ) false
+#   define HROK( hrExpr ) { ( hrExpr ) ; }
+#endif
+
+// Types -----------------------------------------------------------------------
+
+struct ID3D11CommandList ;
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        // Forward declaration
+        class Light ;
+
+        /** Wrapper for routines specific to D3D11 render system API.
+
+            Unlike D3D9_Api, this can record draw calls on multiple threads.  Each
+            command recorder owns a deferred context and a render state cache.
+            Between BeginCommandRecording and EndCommandRecording, calls the
+            recording thread makes (including those that meshes and textures make
+            through D3D11_RenderStateCache::GetCurrent) go to its recorder.
+            Otherwise they go to the immediate context, which only the thread that
+            owns this API may use.
+        */
+        class D3D11_Api : public ApiBase
+        {
+        public:
+            static const unsigned sType = 'RAdb' ; ///< Type identifier for this class
+
+            /// Maximum number of command recorders, i.e. deferred contexts.
+            static const unsigned sMaxCommandRecorders = 16 ;
+
+            D3D11_Api() ;
+            virtual ~D3D11_Api() ;
+
+            virtual Window *    NewWindow( class Render::System * renderSystem ) ;
+            virtual void        SetViewport( const Viewport & viewport ) ;
+            virtual void        SetCamera( const Camera & camera ) ;
+            virtual void        SetLights( const ModelNode & lightReceiver ) ;
+            virtual void        SetLocalToWorld( const Mat44 & localToWorld ) ;
+            virtual void        ResetLocalToWorld() ;
+
+            virtual void        RenderSimpleText( const char * text , const Vec3 & position , bool useScreenSpace ) ;
+            virtual void        FlushSimpleText() ;
+
+            virtual VertexBufferBase *  NewVertexBuffer() ;
+            virtual IndexBufferBase  *  NewIndexBuffer() ;
+            virtual void                DeleteIndexBuffer( IndexBufferBase * indexBuffer ) ;
+            virtual MeshBase *          NewMesh( ModelData * owningModelData ) ;
+            virtual TextureBase *       NewTexture() ;
+            virtual GpuTimerBase *      GetGpuTimer() { return & mGpuTimer ; }
+
+            virtual void ApplyRenderState( const RenderStateS & renderState ) ;
+            virtual void GetRenderState( RenderStateS & renderState ) ;
+            virtual void DisableTexturing() ;
+
+            virtual unsigned    GetNumCommandRecorders() const ;
+            virtual void        BeginCommandRecording( unsigned iRecorder ) ;
+            virtual void        EndCommandRecording( unsigned iRecorder ) ;
+            virtual void        SubmitCommandRecordings( unsigned numRecorders ) ;
+
+            static bool CheckError( const char * /*situation*/ ) { return false ; }
+
+        private:
+            /** Deferred context, and the state that calls on it accumulate, for recording draw calls on one thread.
+            */
+            struct CommandRecorder
+            {
+                D3D11_RenderStateCache  mRenderStateCache   ;   ///< Render state of deferred context, which owns that context.
+                ID3D11CommandList *     mCommandList        ;   ///< Commands recorded since the last submit, or NULL if none.
+            } ;
+
+            bool    CreateCommandRecorders() ;
+            void    ReleaseCommandRecorders() ;
+            void    BindRenderTargets( ID3D11DeviceContext * context ) ;
+
+            D3D11_RenderStateCache  mRenderStateCache   ;   ///< Render state of immediate context.
+            D3D11_GpuTimer          mGpuTimer           ;   ///< Timer that measures durations of GPU render passes.
+            D3D11_TextBatch         mTextBatch          ;   ///< Text that RenderSimpleText queued, which FlushSimpleText draws.
+            CommandRecorder         mCommandRecorders[ sMaxCommandRecorders ] ; ///< Deferred contexts for recording draw calls in parallel.
+            unsigned                mNumCommandRecorders;   ///< Number of elements of mCommandRecorders that have a deferred context.
+            D3D11_VIEWPORT          mViewport           ;   ///< Viewport that SetViewport most recently set, which each recording also sets.
+        } ;
+
+        // Public variables ------------------------------------------------------------
+        // Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -0,0 +1,179 @@
+/** \file D3D11_gpuTimer.cpp
+
+    \brief Measure durations of GPU render passes with Direct3D version 11 timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <d3d11.h>
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+
+#include "Render/Platform/DirectX11/D3D11_gpuTimer.h"
+
+#include <string.h>
+
+extern ID3D11Device *           g_d3d11Device           ; // Direct3D rendering device
+extern ID3D11DeviceContext *    g_d3d11ImmediateContext ; // Direct3D immediate device context
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct Direct3D GPU timer.
+
+            This does not create queries; the first BeginFrame does, since that requires a device.
+        */
+        D3D11_GpuTimer::D3D11_GpuTimer()
+        {
+            PERF_BLOCK( D3D11_GpuTimer__D3D11_GpuTimer ) ;
+
+            memset( mTimestamps , 0 , sizeof( mTimestamps ) ) ;
+            memset( mDisjoint   , 0 , sizeof( mDisjoint   ) ) ;
+        }
+
+
+
+
+        /** Destruct Direct3D GPU timer.
+        */
+        D3D11_GpuTimer::~D3D11_GpuTimer()
+        {
+            PERF_BLOCK( D3D11_GpuTimer__dtor ) ;
+
+            ReleaseQueries() ;
+        }
+
+
+
+
+        /** Release every query this timer created.
+        */
+        void D3D11_GpuTimer::ReleaseQueries()
+        {
+            for( size_t iFrame = 0 ; iFrame < sNumFramesInFlight ; ++ iFrame )
+            {
+                for( size_t iQuery = 0 ; iQuery < sNumQueriesPerFrame ; ++ iQuery )
+                {
+                    if( mTimestamps[ iFrame ][ iQuery ] )
+                    {
+                        mTimestamps[ iFrame ][ iQuery ]->Release() ;
+                        mTimestamps[ iFrame ][ iQuery ] = NULLPTR ;
+                    }
+                }
+                if( mDisjoint[ iFrame ] )
+                {
+                    mDisjoint[ iFrame ]->Release() ;
+                    mDisjoint[ iFrame ] = NULLPTR ;
+                }
+            }
+        }
+
+
+
+
+        /** Create timestamp and disjoint queries.
+
+            Every Direct3D 11 device supports these, but the device might not exist yet.
+
+            \return Whether this uses timestamp queries.
+        */
+        /* virtual */ bool D3D11_GpuTimer::CreateQueries()
+        {
+            PERF_BLOCK( D3D11_GpuTimer__CreateQueries ) ;
+
+            if( NULL == g_d3d11Device )
+            {
+                return false ;
+            }
+
+            D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP          , 0 } ;
+            D3D11_QUERY_DESC disjointDesc  = { D3D11_QUERY_TIMESTAMP_DISJOINT , 0 } ;
+            for( size_t iFrame = 0 ; iFrame < sNumFramesInFlight ; ++ iFrame )
+            {
+                for( size_t iQuery = 0 ; iQuery < sNumQueriesPerFrame ; ++ iQuery )
+                {
+                    HROK( g_d3d11Device->CreateQuery( & timestampDesc , & mTimestamps[ iFrame ][ iQuery ] ) ) ;
+                }
+                HROK( g_d3d11Device->CreateQuery( & disjointDesc , & mDisjoint[ iFrame ] ) ) ;
+            }
+            return true ;
+        }
+
+
+
+
+        /** Start detecting whether the GPU clock changes during the given frame.
+        */
+        /* virtual */ void D3D11_GpuTimer::BeginFrameQueries( size_t iFrame )
+        {
+            ASSERT( iFrame < sNumFramesInFlight ) ;
+            g_d3d11ImmediateContext->Begin( mDisjoint[ iFrame ] ) ;
+        }
+
+
+
+
+        /** Stop detecting whether the GPU clock changes, for the given frame.
+        */
+        /* virtual */ void D3D11_GpuTimer::EndFrameQueries( size_t iFrame )
+        {
+            ASSERT( iFrame < sNumFramesInFlight ) ;
+            g_d3d11ImmediateContext->End( mDisjoint[ iFrame ] ) ;
+        }
+
+
+
+
+        /** Record GPU time into the given query once the GPU has executed all previously issued commands.
+        */
+        /* virtual */ void D3D11_GpuTimer::IssueTimestamp( size_t iFrame , size_t iQuery )
+        {
+            ASSERT( ( iFrame < sNumFramesInFlight ) && ( iQuery < sNumQueriesPerFrame ) ) ;
+            g_d3d11ImmediateContext->End( mTimestamps[ iFrame ][ iQuery ] ) ;
+        }
+
+
+
+
+        /** Read timestamps of the given frame, if the GPU has executed all of its queries.
+
+            GetData with D3D11_ASYNC_GETDATA_DONOTFLUSH returns S_FALSE, rather than wait, while a result is pending.
+            The disjoint query ends the frame, so once it completes, the others have too.
+        */
+        /* virtual */ GpuTimerBase::ResultE D3D11_GpuTimer::ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond )
+        {
+            PERF_BLOCK( D3D11_GpuTimer__ReadResults ) ;
+
+            ASSERT( ( iFrame < sNumFramesInFlight ) && ( numQueries > 0 ) && ( numQueries <= sNumQueriesPerFrame ) ) ;
+
+            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint ;
+            if( g_d3d11ImmediateContext->GetData( mDisjoint[ iFrame ] , & disjoint , sizeof( disjoint ) , D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+            {
+                return RESULT_NOT_READY ;
+            }
+
+            for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+            {
+                UINT64 timestamp = 0 ;
+                if( g_d3d11ImmediateContext->GetData( mTimestamps[ iFrame ][ iQuery ] , & timestamp , sizeof( timestamp ) , D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+                {
+                    return RESULT_NOT_READY ;
+                }
+                timestamps[ iQuery ] = timestamp ;
+            }
+
+            gpuTicksPerSecond = disjoint.Frequency ;
+            return disjoint.Disjoint ? RESULT_DISJOINT : RESULT_READY ;
+        }
+
+    } ;
+} ;
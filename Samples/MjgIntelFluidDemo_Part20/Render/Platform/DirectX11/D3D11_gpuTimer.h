@@ -0,0 +1,54 @@
+/** \file D3D11_gpuTimer.h
+
+    \brief Measure durations of GPU render passes with Direct3D version 11 timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_GPU_TIMER_H
+#define PEGASYS_RENDER_D3D11_GPU_TIMER_H
+
+#include "Render/Device/gpuTimer.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+struct ID3D11Query ;
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Measure durations of GPU render passes with Direct3D version 11 timestamp queries.
+
+            Each frame brackets its timestamps with a D3D11_QUERY_TIMESTAMP_DISJOINT
+            query, whose result also reports timestamp frequency.  Queries go to
+            the immediate context, so passes that record command lists on other
+            threads are timed when those lists execute, by SubmitCommandRecordings.
+        */
+        class D3D11_GpuTimer : public GpuTimerBase
+        {
+            public:
+                D3D11_GpuTimer() ;
+                virtual ~D3D11_GpuTimer() ;
+
+            protected:
+                virtual bool    CreateQueries() ;
+                virtual void    BeginFrameQueries( size_t iFrame ) ;
+                virtual void    EndFrameQueries( size_t iFrame ) ;
+                virtual void    IssueTimestamp( size_t iFrame , size_t iQuery ) ;
+                virtual ResultE ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond ) ;
+
+            private:
+                void    ReleaseQueries() ;
+
+                ID3D11Query *   mTimestamps[ sNumFramesInFlight ][ sNumQueriesPerFrame ] ;  ///< Timestamp queries, or NULL if not yet created.
+                ID3D11Query *   mDisjoint[ sNumFramesInFlight ]                         ;   ///< Query whose result says whether the GPU clock changed during the frame, and timestamp frequency.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -0,0 +1,148 @@
+/** \file D3D11_IndexBuffer.cpp
+
+    \brief Index buffer for Direct3D version 11
+
+    \author Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/debugPrint.h"
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+
+#include "Render/Platform/DirectX11/D3D11_IndexBuffer.h"
+
+extern ID3D11Device *           g_d3d11Device           ; // Direct3D rendering device
+extern ID3D11DeviceContext *    g_d3d11ImmediateContext ; // Direct3D immediate device context
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+/** Construct index buffer for Direct3D version 11.
+*/
+D3D11_IndexBuffer::D3D11_IndexBuffer()
+    : IndexBufferBase( sTypeId )
+    , mInternalIndexBuffer( NULLPTR )
+    , mShadowIndexData( NULLPTR )
+{
+    ASSERT( GetTypeId() == D3D11_IndexBuffer::sTypeId ) ;
+}
+
+
+
+
+/** Destruct index buffer for Direct3D version 11.
+*/
+D3D11_IndexBuffer::~D3D11_IndexBuffer()
+{
+    Clear() ;
+}
+
+
+
+
+/** Allocate indices.
+*/
+/* virtual */ void D3D11_IndexBuffer::Allocate( size_t numIndices , IndexTypeE indexType )
+{
+    ASSERT( NULLPTR == mInternalIndexBuffer ) ;
+    ASSERT( 0 == mNumIndices ) ;
+    ASSERT( numIndices > 0 ) ;
+    ASSERT( ( INDEX_TYPE_16 == indexType ) || ( INDEX_TYPE_32 == indexType ) ) ;
+
+    const size_t    indexSize = ( INDEX_TYPE_16 == indexType ) ? sizeof( WORD ) : sizeof( int ) ;
+
+    mNumIndices = numIndices ;
+    mIndexType  = indexType ;
+    SetCapacity( numIndices ) ;
+
+    const UINT   indexBufferSize = static_cast< UINT >( numIndices * indexSize ) ;
+
+    D3D11_BUFFER_DESC bufferDesc ;
+    ZeroMemory( & bufferDesc , sizeof( bufferDesc ) ) ;
+    bufferDesc.ByteWidth    = indexBufferSize ;
+    bufferDesc.Usage        = D3D11_USAGE_DEFAULT ;
+    bufferDesc.BindFlags    = D3D11_BIND_INDEX_BUFFER ;
+
+    if( FAILED( g_d3d11Device->CreateBuffer( & bufferDesc , NULL , & mInternalIndexBuffer ) ) )
+    {   // creation failed
+        FAIL() ; // crash will happen below
+    }
+
+    mShadowIndexData = NEW unsigned char[ indexBufferSize ] ;
+}
+
+
+
+
+void D3D11_IndexBuffer::Clear()
+{
+    if( mInternalIndexBuffer )
+    {
+        mInternalIndexBuffer->Release() ;
+        mInternalIndexBuffer = NULLPTR ;
+    }
+    delete [] mShadowIndexData ;
+    mShadowIndexData = NULLPTR ;
+    mNumIndices = 0 ;
+    SetCapacity( 0 ) ;
+}
+
+
+
+
+/* virtual */ WORD *  D3D11_IndexBuffer::GetIndicesWord()
+{
+    ASSERT( GetIndexType() == INDEX_TYPE_16 ) ;
+    ASSERT( mShadowIndexData != NULLPTR ) ;
+    return reinterpret_cast< WORD * >( mShadowIndexData ) ;
+}
+
+
+
+
+/* virtual */ int *   D3D11_IndexBuffer::GetIndicesInt()
+{
+    ASSERT( GetIndexType() == INDEX_TYPE_32 ) ;
+    ASSERT( mShadowIndexData != NULLPTR ) ;
+    return reinterpret_cast< int * >( mShadowIndexData ) ;
+}
+
+
+
+
+/* virtual */ void D3D11_IndexBuffer::Unlock()
+{
+    ASSERT( mInternalIndexBuffer != NULLPTR ) ;
+    g_d3d11ImmediateContext->UpdateSubresource( mInternalIndexBuffer , 0 , NULL , mShadowIndexData , 0 , 0 ) ;
+}
+
+
+
+
+    } ;
+} ;
+
+
+#if defined( _DEBUG )
+
+void PeGaSys_Render_D3D11_IndexBuffer_UnitTest( void )
+{
+    DebugPrintf( "D3D11_IndexBuffer::UnitTest ----------------------------------------------\n" ) ;
+
+    {
+        PeGaSys::Render::D3D11_IndexBuffer d3D11_IndexBuffer ;
+        d3D11_IndexBuffer.Allocate( 1 , PeGaSys::Render::IndexBufferBase::INDEX_TYPE_32 ) ;
+        d3D11_IndexBuffer.Clear() ;
+    }
+
+    DebugPrintf( "D3D11_IndexBuffer::UnitTest: THE END ----------------------------------------------\n" ) ;
+}
+#endif
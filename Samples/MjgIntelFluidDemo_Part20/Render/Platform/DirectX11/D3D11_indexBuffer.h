@@ -0,0 +1,56 @@
+/** \file D3D11_IndexBuffer.h
+
+    \brief Index buffer for Direct3D version 11
+
+    \author Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_INDEX_BUFFER_H
+#define PEGASYS_RENDER_D3D11_INDEX_BUFFER_H
+
+#include <d3d11.h>
+
+#include "Render/Resource/indexBuffer.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Index buffer for Direct3D version 11.
+
+            Indices live in GPU memory, so GetIndices* return a CPU-side copy,
+            which Unlock uploads, on the immediate context.
+        */
+        class D3D11_IndexBuffer : public IndexBufferBase
+        {
+            public:
+                static const unsigned sTypeId = 'ibdb' ;
+
+                D3D11_IndexBuffer() ;
+                virtual ~D3D11_IndexBuffer() ;
+
+                virtual void    Allocate( size_t numIndices , IndexTypeE indexType ) ;
+                virtual WORD *  GetIndicesWord() ;
+                virtual int *   GetIndicesInt() ;
+                virtual void    Unlock() ;
+                virtual void    Clear() ;
+
+            private:
+                friend class D3D11_Mesh ; // Grant access to GetInternalBuffer.
+
+                // Only D3D11_Mesh should access GetInternalBuffer.
+                ID3D11Buffer * GetInternalBuffer() const { return mInternalIndexBuffer ; }
+
+                ID3D11Buffer *  mInternalIndexBuffer    ;   ///< Internal D3D index buffer object
+                unsigned char * mShadowIndexData        ;   ///< CPU-side copy of indices that GetIndices* return.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
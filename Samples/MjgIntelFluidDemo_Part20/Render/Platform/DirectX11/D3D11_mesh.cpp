@@ -0,0 +1,210 @@
+/** \file D3D11_Mesh.cpp
+
+    \brief Geometry mesh for Direct3D version 11
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/debugPrint.h"
+
+#include "Render/Platform/DirectX11/D3D11_VertexBuffer.h"
+#include "Render/Platform/DirectX11/D3D11_IndexBuffer.h"
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+
+#include "Render/Platform/DirectX11/D3D11_Mesh.h"
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/** Index buffer that splits each quadrilateral, of up to D3D11_Mesh::sMaxQuadsPerDraw, into two triangles.
+
+    Direct3D 11 has no quadrilateral primitive.  All meshes share this
+    buffer, which never changes after CreateQuadIndexBuffer, so command
+    recorders on any thread can bind it.
+*/
+static ID3D11Buffer * sQuadIndexBuffer = NULLPTR ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+/** Construct geometry mesh for Direct3D version 11.
+*/
+D3D11_Mesh::D3D11_Mesh( ModelData * owningModelData )
+    : MeshBase( owningModelData )
+{
+}
+
+
+
+
+/** Destruct geometry mesh for Direct3D version 11.
+*/
+D3D11_Mesh::~D3D11_Mesh()
+{
+}
+
+
+
+
+/** Create index buffer that meshes use to render quadrilaterals as pairs of triangles.
+
+    Call once, after creating the device and before rendering.
+*/
+/* static */ bool D3D11_Mesh::CreateQuadIndexBuffer( ID3D11Device * device )
+{
+    ASSERT( NULLPTR == sQuadIndexBuffer ) ;
+
+    static const size_t numIndices = sMaxQuadsPerDraw * 6 ;
+    IndexBufferBase::WORD * indices = NEW IndexBufferBase::WORD[ numIndices ] ;
+    for( unsigned iQuad = 0 ; iQuad < sMaxQuadsPerDraw ; ++ iQuad )
+    {   // For each quadrilateral, make triangles (0,1,2) and (0,2,3) , which preserve winding.
+        const IndexBufferBase::WORD firstVertex = static_cast< IndexBufferBase::WORD >( iQuad * 4 ) ;
+        indices[ iQuad * 6 + 0 ] = firstVertex + 0 ;
+        indices[ iQuad * 6 + 1 ] = firstVertex + 1 ;
+        indices[ iQuad * 6 + 2 ] = firstVertex + 2 ;
+        indices[ iQuad * 6 + 3 ] = firstVertex + 0 ;
+        indices[ iQuad * 6 + 4 ] = firstVertex + 2 ;
+        indices[ iQuad * 6 + 5 ] = firstVertex + 3 ;
+    }
+
+    D3D11_BUFFER_DESC bufferDesc ;
+    ZeroMemory( & bufferDesc , sizeof( bufferDesc ) ) ;
+    bufferDesc.ByteWidth    = static_cast< UINT >( numIndices * sizeof( IndexBufferBase::WORD ) ) ;
+    bufferDesc.Usage        = D3D11_USAGE_IMMUTABLE ;
+    bufferDesc.BindFlags    = D3D11_BIND_INDEX_BUFFER ;
+
+    D3D11_SUBRESOURCE_DATA initialData ;
+    ZeroMemory( & initialData , sizeof( initialData ) ) ;
+    initialData.pSysMem = indices ;
+
+    const bool succeeded = SUCCEEDED( device->CreateBuffer( & bufferDesc , & initialData , & sQuadIndexBuffer ) ) ;
+    ASSERT( succeeded ) ;
+
+    delete [] indices ;
+
+    return succeeded ;
+}
+
+
+
+
+/** Release index buffer that CreateQuadIndexBuffer created.
+*/
+/* static */ void D3D11_Mesh::ReleaseQuadIndexBuffer()
+{
+    if( sQuadIndexBuffer )
+    {
+        sQuadIndexBuffer->Release() ;
+        sQuadIndexBuffer = NULLPTR ;
+    }
+}
+
+
+
+
+void D3D11_Mesh::Render()
+{
+    D3D11_VertexBuffer * vertexBuffer    = static_cast< D3D11_VertexBuffer * >( GetVertexBuffer() ) ;
+    ASSERT( vertexBuffer != NULLPTR ) ;
+    ASSERT( vertexBuffer->GetTypeId() == D3D11_VertexBuffer::sTypeId ) ;
+
+    if( vertexBuffer->GetInternalBuffer() == NULLPTR )
+    {   // Vertex data has not yet been allocated; nothing to render yet.  This can happen for particle systems before particles are emitted, since the VB is allocated on demand.
+        return ;
+    }
+
+    D3D11_RenderStateCache &    renderStateCache    = D3D11_RenderStateCache::GetCurrent() ;
+    ID3D11DeviceContext *       context             = renderStateCache.GetContext() ;
+
+    const VertexDeclaration::VertexFormatE vertexFormat = vertexBuffer->GetVertexDeclaration().GetVertexFormat() ;
+    if( VertexDeclaration::POSITION_NORMAL_PACKED == vertexFormat )
+    {   // Vertex positions are quantized against a box.  Vertex shader maps them back into model space.
+        renderStateCache.SetPositionDequantization( vertexBuffer->GetPositionOffset() , vertexBuffer->GetPositionScale() ) ;
+    }
+
+    // Bind shaders (lighting, texturing, etc.) appropriate for this vertex buffer.
+    renderStateCache.PrepareToDraw( vertexBuffer->GetVertexDeclaration() ) ;
+
+    // Inform renderer of the location of vertex data.
+    ID3D11Buffer *  internalVertexBuffer    = vertexBuffer->GetInternalBuffer() ;
+    const UINT      vertexSize              = static_cast< UINT >( vertexBuffer->GetVertexSizeInBytes() ) ;
+    const UINT      vertexOffset            = 0 ;
+    context->IASetVertexBuffers( 0 , 1 , & internalVertexBuffer , & vertexSize , & vertexOffset ) ;
+
+    const D3D11_IndexBuffer * indexBuffer = static_cast< const D3D11_IndexBuffer * >( GetIndexBuffer() ) ;
+
+    if( VertexDeclaration::BILLBOARD_INSTANCE == vertexFormat )
+    {   // Vertex buffer has one element per quadrilateral.  Vertex shader expands each into 4 vertices.
+        ASSERT( NULL == indexBuffer ) ;
+        ASSERT( PRIMITIVE_QUADS == GetPrimitiveType() ) ;
+        context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP ) ;
+        context->DrawInstanced( 4 , static_cast< UINT >( vertexBuffer->GetPopulation() ) , 0 , 0 ) ;
+        return ;
+    }
+
+    D3D11_PRIMITIVE_TOPOLOGY primitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED ; // Initialize to an invalid value to catch missed cases below.
+
+    switch( GetPrimitiveType() )
+    {
+    case PRIMITIVE_POINTS           : primitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST        ; break ;
+    case PRIMITIVE_LINES            : primitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_LINELIST         ; break ;
+    case PRIMITIVE_TRIANGLES        : primitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST     ; break ;
+    case PRIMITIVE_TRIANGLE_STRIP   : primitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP    ; break ;
+    case PRIMITIVE_QUADS            : primitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST     ; break ; // Using sQuadIndexBuffer.
+    default: FAIL() ; break ;
+    }
+    context->IASetPrimitiveTopology( primitiveTopology ) ;
+
+    if( indexBuffer != NULL )
+    {   // Index buffer exists.
+        ASSERT( indexBuffer->GetTypeId() == D3D11_IndexBuffer::sTypeId ) ;
+        ASSERT( indexBuffer->GetInternalBuffer() != 0 ) ;
+        ASSERT( GetPrimitiveType() != PRIMITIVE_QUADS ) ; // Like D3D9_Mesh, indexed quads are not supported.
+
+        const DXGI_FORMAT indexFormat = ( IndexBufferBase::INDEX_TYPE_16 == indexBuffer->GetIndexType() ) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT ;
+        context->IASetIndexBuffer( indexBuffer->GetInternalBuffer() , indexFormat , 0 ) ;
+        context->DrawIndexed( static_cast< UINT >( indexBuffer->GetNumIndices() ) , 0 , 0 ) ;
+    }
+    else if( PRIMITIVE_QUADS == GetPrimitiveType() )
+    {   // Render quadrilaterals as pairs of triangles, in batches small enough for 16-bit indices.
+        ASSERT( sQuadIndexBuffer != NULLPTR ) ;
+        const size_t numQuads = vertexBuffer->GetPopulation() / 4 ;
+        ASSERT( vertexBuffer->GetPopulation() == numQuads * 4 ) ;
+        context->IASetIndexBuffer( sQuadIndexBuffer , DXGI_FORMAT_R16_UINT , 0 ) ;
+        for( size_t firstQuad = 0 ; firstQuad < numQuads ; firstQuad += sMaxQuadsPerDraw )
+        {
+            const size_t numQuadsInDraw = Min2( numQuads - firstQuad , static_cast< size_t >( sMaxQuadsPerDraw ) ) ;
+            context->DrawIndexed( static_cast< UINT >( numQuadsInDraw * 6 ) , 0 , static_cast< INT >( firstQuad * 4 ) ) ;
+        }
+    }
+    else
+    {   // no index buffer; render vertex buffer directly
+        context->Draw( static_cast< UINT >( vertexBuffer->GetPopulation() ) , 0 ) ;
+    }
+}
+
+
+
+    } ;
+} ;
+
+
+#if defined( _DEBUG )
+
+void PeGaSys_Render_D3D11_Mesh_UnitTest( void )
+{
+    DebugPrintf( "D3D11_Mesh::UnitTest ----------------------------------------------\n" ) ;
+
+    {
+        PeGaSys::Render::D3D11_Mesh d3d11_mesh( NULLPTR ) ;
+    }
+
+    DebugPrintf( "D3D11_Mesh::UnitTest: THE END ----------------------------------------------\n" ) ;
+}
+#endif
@@ -0,0 +1,52 @@
+/** \file D3D11_Mesh.h
+
+    \brief Geometry mesh for Direct3D version 11
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_MESH_H
+#define PEGASYS_RENDER_D3D11_MESH_H
+
+#include "Render/Resource/mesh.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+struct ID3D11Device ;
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        class ModelData ;
+
+        /** Geometry mesh for Direct3D version 11.
+
+            Render issues commands on the context of the calling thread's command
+            recorder, if it records, else on the immediate context.  See
+            D3D11_RenderStateCache::GetCurrent.
+        */
+        class D3D11_Mesh : public MeshBase
+        {
+            public:
+                D3D11_Mesh( ModelData * owningModelData ) ;
+                virtual ~D3D11_Mesh() ;
+
+                virtual void Render() ;
+
+                static bool CreateQuadIndexBuffer( ID3D11Device * device ) ;
+                static void ReleaseQuadIndexBuffer() ;
+
+                /// Maximum number of quadrilaterals each draw call renders, limited by the range of 16-bit indices.
+                static const unsigned sMaxQuadsPerDraw = 16384 ;
+
+            private:
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
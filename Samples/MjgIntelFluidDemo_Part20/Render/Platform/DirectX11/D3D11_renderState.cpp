@@ -0,0 +1,1101 @@
+/** \file D3D11_renderState.cpp
+
+    \brief Wrapper for routines specific to D3D11 render system API
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/File/debugPrint.h"
+
+#include <windows.h>
+
+#include <d3d11.h>
+#include <d3dcompiler.h>
+
+#pragma comment( lib , "d3dcompiler.lib" )
+
+#include <string.h>
+
+#include "Render/Scene/light.h"
+#include "Render/Scene/model.h"
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+#include "Render/Platform/DirectX11/D3D11_vertexBuffer.h"
+
+#include "Render/Platform/DirectX11/D3D11_renderState.h"
+
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/** Source of shaders that emulate the subset of the fixed-function pipeline that D3D9_RenderStateCache uses.
+
+    CreateShaders compiles VertexMain once per vertex format, defining HAS_NORMAL,
+    HAS_COLOR and HAS_TEXCOORD according to which elements the format has, and
+    PixelMain once per PixelShaderE, defining SAMPLE_TEXTURE as 0 (untextured),
+    1 (modulate) or 2 (replace).  ClearVertexMain and ClearPixelMain fill the
+    viewport, for ClearViewport.
+
+    For POSITION_NORMAL_PACKED, VertexMain also defines PACKED_POSITION_NORMAL,
+    and maps quantized positions back into model space using gPositionOffset
+    and gPositionScale.  BILLBOARD_INSTANCE uses BillboardVertexMain instead,
+    which, like the shader in OpenGL_VertexBuffer, expands each instance into
+    a camera-facing quadrilateral of 4 vertices, drawn as a triangle strip.
+
+    Lighting happens per vertex, in world space, like Direct3D 9 with
+    D3DRS_LOCALVIEWER disabled, including its spotlight cone and falloff.  Per-vertex colors, when present, replace
+    material diffuse and ambient colors, like D3DMCS_COLOR1.  Layout of
+    Constants must match D3D11_RenderStateCache::ShaderConstantsS.
+*/
+static const char sShaderSource[] =
+    "cbuffer Constants : register( b0 )                                                         \n"
+    "{                                                                                          \n"
+    "    row_major float4x4 gLocalToWorld ;                                                     \n"
+    "    row_major float4x4 gView ;                                                             \n"
+    "    row_major float4x4 gProjection ;                                                       \n"
+    "    float4 gMaterialDiffuse ;                                                              \n"
+    "    float4 gMaterialAmbient ;                                                              \n"
+    "    float4 gMaterialEmissive ;                                                             \n"
+    "    float4 gAmbientLight ;                                                                 \n"
+    "    float4 gLightPositions[ 8 ] ;                                                          \n"
+    "    float4 gLightDiffuse[ 8 ] ;                                                            \n"
+    "    float4 gLightAttenuation[ 8 ] ;                                                        \n"
+    "    float4 gLightSpotDirection[ 8 ] ;                                                      \n"
+    "    float4 gLightSpotCone[ 8 ] ;                                                           \n"
+    "    float4 gPositionOffset ;                                                               \n"
+    "    float4 gPositionScale ;                                                                \n"
+    "    float4 gClearColor ;                                                                   \n"
+    "    float4 gFlags ; // numDirectLights , alphaFunc (or -1) , alphaRef , lightingEnabled     \n"
+    "} ;                                                                                        \n"
+    "                                                                                           \n"
+    "Texture2D      gTexture : register( t0 ) ;                                                 \n"
+    "SamplerState   gSampler : register( s0 ) ;                                                 \n"
+    "                                                                                           \n"
+    "struct VertexIn                                                                            \n"
+    "{                                                                                          \n"
+    "#if PACKED_POSITION_NORMAL                                                                 \n"
+    "    int4   position : POSITION ;                                                           \n"
+    "    float4 normal   : NORMAL ;                                                             \n"
+    "#else                                                                                      \n"
+    "    float3 position : POSITION ;                                                           \n"
+    "#if HAS_NORMAL                                                                             \n"
+    "    float3 normal   : NORMAL ;                                                             \n"
+    "#endif                                                                                     \n"
+    "#endif                                                                                     \n"
+    "#if HAS_COLOR                                                                              \n"
+    "    float4 color    : COLOR ;                                                              \n"
+    "#endif                                                                                     \n"
+    "#if HAS_TEXCOORD                                                                           \n"
+    "    float2 texCoord : TEXCOORD ;                                                           \n"
+    "#endif                                                                                     \n"
+    "} ;                                                                                        \n"
+    "                                                                                           \n"
+    "struct VertexOut                                                                           \n"
+    "{                                                                                          \n"
+    "    float4 position : SV_Position ;                                                        \n"
+    "    float4 color    : COLOR ;                                                              \n"
+    "    float2 texCoord : TEXCOORD ;                                                           \n"
+    "} ;                                                                                        \n"
+    "                                                                                           \n"
+    "struct BillboardIn                                                                         \n"
+    "{                                                                                          \n"
+    "    float3 center           : POSITION ;                                                   \n"
+    "    float2 halfSizeAndAngle : SIZE_ANGLE ;                                                 \n"
+    "    float4 color            : COLOR ;                                                      \n"
+    "    float2 texCoordV        : TEXCOORD ;                                                   \n"
+    "    uint   vertexId         : SV_VertexID ;                                                \n"
+    "} ;                                                                                        \n"
+    "                                                                                           \n"
+    "VertexOut VertexMain( VertexIn vin )                                                       \n"
+    "{                                                                                          \n"
+    "    VertexOut vout ;                                                                       \n"
+    "#if PACKED_POSITION_NORMAL                                                                 \n"
+    "    // Dequantize position.  PackNormal scaled normal by gPositionScale, so undo that.     \n"
+    "    // Normal components are signed 10-bit integers, but the input layout reads unsigned.  \n"
+    "    const float3 position   = gPositionOffset.xyz + gPositionScale.xyz * float3( vin.position.xyz ) ; \n"
+    "    const float3 normalBits = round( vin.normal.xyz * 1023.0 ) ;                           \n"
+    "    const float3 vertNormal = max( ( normalBits - 1024.0 * ( normalBits >= 512.0 ) ) / 511.0 , -1.0 ) / gPositionScale.xyz ; \n"
+    "#else                                                                                      \n"
+    "    const float3 position   = vin.position ;                                               \n"
+    "#if HAS_NORMAL                                                                             \n"
+    "    const float3 vertNormal = vin.normal ;                                                 \n"
+    "#endif                                                                                     \n"
+    "#endif                                                                                     \n"
+    "    const float4 worldPosition = mul( float4( position , 1.0 ) , gLocalToWorld ) ;         \n"
+    "    vout.position = mul( mul( worldPosition , gView ) , gProjection ) ;                    \n"
+    "#if HAS_COLOR                                                                              \n"
+    "    const float4 diffuse = vin.color ;                                                     \n"
+    "    const float4 ambient = vin.color ;                                                     \n"
+    "#else                                                                                      \n"
+    "    const float4 diffuse = gMaterialDiffuse ;                                              \n"
+    "    const float4 ambient = gMaterialAmbient ;                                              \n"
+    "#endif                                                                                     \n"
+    "    vout.color = diffuse ;                                                                 \n"
+    "#if HAS_NORMAL                                                                             \n"
+    "    if( gFlags.w != 0.0 )                                                                  \n"
+    "    {   // Lighting is enabled.                                                            \n"
+    "        const float3 normal = normalize( mul( vertNormal , (float3x3) gLocalToWorld ) ) ;  \n"
+    "        float3 lit = gMaterialEmissive.rgb + ambient.rgb * gAmbientLight.rgb ;             \n"
+    "        for( int iLight = 0 ; iLight < (int) gFlags.x ; ++ iLight )                        \n"
+    "        {                                                                                  \n"
+    "            float3 toLight     = - gLightPositions[ iLight ].xyz ;                         \n"
+    "            float  attenuation = 1.0 ;                                                     \n"
+    "            if( gLightPositions[ iLight ].w != 0.0 )                                       \n"
+    "            {   // Light has a position.                                                   \n"
+    "                toLight = gLightPositions[ iLight ].xyz - worldPosition.xyz ;              \n"
+    "                const float  dist = length( toLight ) ;                                    \n"
+    "                const float4 atten = gLightAttenuation[ iLight ] ;                         \n"
+    "                attenuation = ( dist <= atten.w ) ? 1.0 / max( atten.x + dist * ( atten.y + dist * atten.z ) , 1.0e-6 ) : 0.0 ; \n"
+    "                const float4 cone = gLightSpotCone[ iLight ] ;                                 \n"
+    "                if( cone.y >= -1.0 )                                                           \n"
+    "                {   // Light is a spotlight.  Fade between inner and outer cones.              \n"
+    "                    const float cosAngle = dot( - toLight / max( dist , 1.0e-6 ) , gLightSpotDirection[ iLight ].xyz ) ; \n"
+    "                    const float spot     = saturate( ( cosAngle - cone.y ) / max( cone.x - cone.y , 1.0e-6 ) ) ; \n"
+    "                    attenuation *= ( spot > 0.0 ) ? pow( spot , gLightSpotDirection[ iLight ].w ) : 0.0 ; \n"
+    "                }                                                                          \n"
+    "            }                                                                              \n"
+    "            lit += diffuse.rgb * gLightDiffuse[ iLight ].rgb * attenuation * saturate( dot( normal , normalize( toLight ) ) ) ; \n"
+    "        }                                                                                  \n"
+    "        vout.color = float4( saturate( lit ) , diffuse.a ) ;                               \n"
+    "    }                                                                                      \n"
+    "#endif                                                                                     \n"
+    "#if HAS_TEXCOORD                                                                           \n"
+    "    vout.texCoord = vin.texCoord ;                                                         \n"
+    "#else                                                                                      \n"
+    "    vout.texCoord = float2( 0.0 , 0.0 ) ;                                                  \n"
+    "#endif                                                                                     \n"
+    "    return vout ;                                                                          \n"
+    "}                                                                                          \n"
+    "                                                                                           \n"
+    "VertexOut BillboardVertexMain( BillboardIn bin )                                           \n"
+    "{                                                                                          \n"
+    "    // Corners in triangle strip order, with the same winding as quadrilaterals that      \n"
+    "    // VertexBufferFillerGeneric writes.  View right and up directions, in model space,    \n"
+    "    // are columns of the local-to-view transform.                                         \n"
+    "    static const float2 corners[ 4 ] = { float2( 1.0 , 1.0 ) , float2( -1.0 , 1.0 ) , float2( 1.0 , -1.0 ) , float2( -1.0 , -1.0 ) } ; \n"
+    "    const float2   corner      = corners[ bin.vertexId ] ;                                 \n"
+    "    const float4x4 localToView = mul( gLocalToWorld , gView ) ;                            \n"
+    "    const float3   viewRight   = float3( localToView._11 , localToView._21 , localToView._31 ) ; \n"
+    "    const float3   viewUp      = float3( localToView._12 , localToView._22 , localToView._32 ) ; \n"
+    "    float sinAngle , cosAngle ;                                                            \n"
+    "    sincos( bin.halfSizeAndAngle.y , sinAngle , cosAngle ) ;                               \n"
+    "    const float3 pclRight = (   viewRight * cosAngle + viewUp * sinAngle ) * bin.halfSizeAndAngle.x ; \n"
+    "    const float3 pclUp    = ( - viewRight * sinAngle + viewUp * cosAngle ) * bin.halfSizeAndAngle.x ; \n"
+    "    const float3 position = bin.center + pclRight * corner.x + pclUp * corner.y ;         \n"
+    "    VertexOut vout ;                                                                       \n"
+    "    vout.position = mul( mul( float4( position , 1.0 ) , localToView ) , gProjection ) ;   \n"
+    "    vout.color    = bin.color ;                                                            \n"
+    "    vout.texCoord = float2( 0.5 + 0.5 * corner.x , ( corner.y > 0.0 ) ? bin.texCoordV.x : bin.texCoordV.y ) ; \n"
+    "    return vout ;                                                                          \n"
+    "}                                                                                          \n"
+    "                                                                                           \n"
+    "float4 PixelMain( VertexOut pin ) : SV_Target                                              \n"
+    "{                                                                                          \n"
+    "    float4 color = pin.color ;                                                             \n"
+    "#if SAMPLE_TEXTURE == 1                                                                    \n"
+    "    color *= gTexture.Sample( gSampler , pin.texCoord ) ;                                  \n"
+    "#elif SAMPLE_TEXTURE == 2                                                                  \n"
+    "    color  = gTexture.Sample( gSampler , pin.texCoord ) ;                                  \n"
+    "#endif                                                                                     \n"
+    "    // Alpha test.  Values of gFlags.y match CompareFuncE.                                 \n"
+    "    if(     ( gFlags.y == 0.0 )                                                            \n"
+    "        ||  ( ( gFlags.y == 1.0 ) && ! ( color.a <  gFlags.z ) )                           \n"
+    "        ||  ( ( gFlags.y == 2.0 ) && ! ( color.a >= gFlags.z ) ) )                         \n"
+    "    {                                                                                      \n"
+    "        discard ;                                                                          \n"
+    "    }                                                                                      \n"
+    "    return color ;                                                                         \n"
+    "}                                                                                          \n"
+    "                                                                                           \n"
+    "float4 ClearVertexMain( uint vertexId : SV_VertexID ) : SV_Position                        \n"
+    "{   // One triangle that covers the viewport, at the far plane.                            \n"
+    "    const float2 corner = float2( ( vertexId << 1 ) & 2 , vertexId & 2 ) ;                 \n"
+    "    return float4( corner * 2.0 - 1.0 , 1.0 , 1.0 ) ;                                      \n"
+    "}                                                                                          \n"
+    "                                                                                           \n"
+    "float4 ClearPixelMain() : SV_Target                                                        \n"
+    "{                                                                                          \n"
+    "    return gClearColor ;                                                                   \n"
+    "}                                                                                          \n"
+    ;
+
+static ID3D11VertexShader * sVertexShaders[ PeGaSys::Render::VertexDeclaration::NUM_FORMATS ] ;    ///< Per vertex format, shader that transforms and lights vertices, or NULL if format is unsupported.
+static ID3D11InputLayout *  sInputLayouts[ PeGaSys::Render::VertexDeclaration::NUM_FORMATS ]  ;    ///< Per vertex format, layout that feeds vertices to sVertexShaders.
+static ID3D11PixelShader *  sPixelShaders[ PeGaSys::Render::D3D11_RenderStateCache::NUM_PIXEL_SHADERS ] ; ///< Pixel shaders, per PixelShaderE.
+static ID3D11VertexShader * sClearVertexShader = NULLPTR ;                                          ///< Vertex shader that covers the viewport, for ClearViewport.
+static ID3D11PixelShader *  sClearPixelShader  = NULLPTR ;                                          ///< Pixel shader that writes the clear color, for ClearViewport.
+
+static PeGaSys::Render::D3D11_RenderStateCache *                    sImmediateStateCache = NULLPTR ;   ///< State cache of immediate context.
+static __declspec( thread ) PeGaSys::Render::D3D11_RenderStateCache * sCurrentStateCache = NULLPTR ;   ///< State cache of command recorder this thread records into, or NULL if not recording.
+
+// Public variables ------------------------------------------------------------
+
+extern ID3D11Device * g_d3d11Device ; // Direct3D rendering device
+
+namespace PeGaSys {
+    namespace Render {
+
+// Private functions -----------------------------------------------------------
+
+static D3D11_BLEND blendFactor( BlendStateS::BlendFactorE blendFactor )
+{
+    switch( blendFactor )
+    {
+    case BlendState::BLEND_FACTOR_ZERO          : return D3D11_BLEND_ZERO           ; break ;
+    case BlendState::BLEND_FACTOR_ONE           : return D3D11_BLEND_ONE            ; break ; // Default / additive
+    case BlendState::BLEND_FACTOR_SRC_ALPHA     : return D3D11_BLEND_SRC_ALPHA      ; break ; // Typical alpha blending
+    case BlendState::BLEND_FACTOR_SRC_COLOR     : return D3D11_BLEND_SRC_COLOR      ; break ;
+    case BlendState::BLEND_FACTOR_INV_SRC_ALPHA : return D3D11_BLEND_INV_SRC_ALPHA  ; break ;
+    case BlendState::BLEND_FACTOR_INV_SRC_COLOR : return D3D11_BLEND_INV_SRC_COLOR  ; break ;
+    case BlendState::BLEND_FACTOR_DST_ALPHA     : return D3D11_BLEND_DEST_ALPHA     ; break ;
+    case BlendState::BLEND_FACTOR_DST_COLOR     : return D3D11_BLEND_DEST_COLOR     ; break ;
+    case BlendState::BLEND_FACTOR_INV_DST_ALPHA : return D3D11_BLEND_INV_DEST_ALPHA ; break ;
+    case BlendState::BLEND_FACTOR_INV_DST_COLOR : return D3D11_BLEND_INV_DEST_COLOR ; break ;
+    default: FAIL() ; break ;
+    }
+    return D3D11_BLEND_ONE ;
+}
+
+
+
+
+static D3D11_BLEND_OP blendOperation( BlendStateS::BlendOpE blendOp )
+{
+    switch( blendOp )
+    {
+    case BlendState::BLEND_OP_ADD       : return D3D11_BLEND_OP_ADD         ; break ;
+    case BlendState::BLEND_OP_SUBTRACT  : return D3D11_BLEND_OP_SUBTRACT    ; break ;
+    case BlendState::BLEND_OP_MIN       : return D3D11_BLEND_OP_MIN         ; break ;
+    case BlendState::BLEND_OP_MAX       : return D3D11_BLEND_OP_MAX         ; break ;
+    default: FAIL() ; break ;
+    }
+    return D3D11_BLEND_OP_ADD ;
+}
+
+
+
+
+static D3D11_COMPARISON_FUNC compareFunction( CompareFuncE compareFunc )
+{
+    switch( compareFunc )
+    {
+    case CMP_FUNC_NEVER         : return D3D11_COMPARISON_NEVER         ; break ;
+    case CMP_FUNC_LESS          : return D3D11_COMPARISON_LESS          ; break ;
+    case CMP_FUNC_GREATER_EQUAL : return D3D11_COMPARISON_GREATER_EQUAL ; break ;
+    case CMP_FUNC_ALWAYS        : return D3D11_COMPARISON_ALWAYS        ; break ;
+    default: FAIL() ; break ;
+    }
+    return D3D11_COMPARISON_ALWAYS ;
+}
+
+
+
+
+static D3D11_FILTER samplerFilter( const SamplerStateS & samplerState )
+{
+    const bool minLinear = ( SamplerState::FILTER_NEAREST != samplerState.mMinFilter ) ;
+    const bool magLinear = ( SamplerState::FILTER_NEAREST != samplerState.mMagFilter ) ;
+    const bool mipLinear = ( SamplerState::FILTER_LINEAR  == samplerState.mMipFilter ) ;
+    static const D3D11_FILTER filters[ 2 ][ 2 ][ 2 ] =
+    {   //  [ minLinear ][ magLinear ][ mipLinear ]
+        { { D3D11_FILTER_MIN_MAG_MIP_POINT          , D3D11_FILTER_MIN_MAG_POINT_MIP_LINEAR         } , { D3D11_FILTER_MIN_POINT_MAG_LINEAR_MIP_POINT   , D3D11_FILTER_MIN_POINT_MAG_MIP_LINEAR   } } ,
+        { { D3D11_FILTER_MIN_LINEAR_MAG_MIP_POINT   , D3D11_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR  } , { D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT         , D3D11_FILTER_MIN_MAG_MIP_LINEAR         } } ,
+    } ;
+    return filters[ minLinear ][ magLinear ][ mipLinear ] ;
+}
+
+
+
+
+static D3D11_TEXTURE_ADDRESS_MODE samplerAddress( SamplerStateS::AddressE address )
+{
+    switch( address )
+    {
+    case SamplerState::ADDRESS_CLAMP    : return D3D11_TEXTURE_ADDRESS_CLAMP    ; break ;
+    case SamplerState::ADDRESS_REPEAT   : return D3D11_TEXTURE_ADDRESS_WRAP     ; break ;
+    default: FAIL() ; break ;
+    }
+    return D3D11_TEXTURE_ADDRESS_CLAMP ;
+}
+
+
+
+
+/** Compile the given entry point of sShaderSource with the given macros.
+
+    \return Compiled shader bytecode, which caller must release, or NULL if compilation failed.
+*/
+static ID3DBlob * CompileShader( const char * entryPoint , const char * target , const D3D_SHADER_MACRO * macros )
+{
+    ID3DBlob * byteCode = NULLPTR ;
+    ID3DBlob * errors   = NULLPTR ;
+    const HRESULT hr = D3DCompile( sShaderSource , sizeof( sShaderSource ) - 1 , "D3D11_renderState" , macros , NULL , entryPoint , target , D3DCOMPILE_OPTIMIZATION_LEVEL3 , 0 , & byteCode , & errors ) ;
+    if( errors )
+    {
+        DebugPrintf( "D3D11_RenderStateCache: %s: %s\n" , entryPoint , static_cast< const char * >( errors->GetBufferPointer() ) ) ;
+        errors->Release() ;
+    }
+    if( FAILED( hr ) )
+    {
+        FAIL() ;
+        return NULLPTR ;
+    }
+    return byteCode ;
+}
+
+
+
+
+template< typename ObjectT > static void ReleaseStateObjects( VECTOR< ObjectT > & stateObjects )
+{
+    for( size_t idx = 0 ; idx < stateObjects.Size() ; ++ idx )
+    {
+        stateObjects[ idx ].mObject->Release() ;
+    }
+    stateObjects.Clear() ;
+}
+
+// Public functions ------------------------------------------------------------
+
+
+/** Construct render state of a Direct3D 11 device context.
+
+    This has no context until SetContext.
+*/
+D3D11_RenderStateCache::D3D11_RenderStateCache()
+    : mContext( NULLPTR )
+    , mConstantBuffer( NULLPTR )
+    , mClearDepthStencilState( NULLPTR )
+    , mIsCurrentStateValid( false )
+    , mShaderConstantsChanged( true )
+    , mTextureEnabled( false )
+    , mTextureReplacesColor( false )
+    , mBoundVertexFormat( VertexDeclaration::VERTEX_FORMAT_NONE )
+    , mBoundPixelShader( PIXEL_SHADER_UNTEXTURED )
+{
+    memset( & mShaderConstants , 0 , sizeof( mShaderConstants ) ) ;
+    mShaderConstants.mLocalToWorld  = Mat4_xIdentity ;
+    mShaderConstants.mView          = Mat4_xIdentity ;
+    mShaderConstants.mProjection    = Mat4_xIdentity ;
+    mShaderConstants.mFlags         = Vec4( 0.0f , -1.0f , 0.0f , 0.0f ) ;
+}
+
+
+
+
+/** Destruct render state of a Direct3D 11 device context.
+*/
+D3D11_RenderStateCache::~D3D11_RenderStateCache()
+{
+    Release() ;
+}
+
+
+
+
+/** Assign device context whose state this cache tracks, and create the constant buffer that shaders read.
+
+    This takes over the caller's reference to the context.
+*/
+void D3D11_RenderStateCache::SetContext( ID3D11DeviceContext * context )
+{
+    ASSERT( NULLPTR == mContext ) ;
+    ASSERT( context != NULLPTR ) ;
+
+    mContext = context ;
+
+    D3D11_BUFFER_DESC bufferDesc ;
+    ZeroMemory( & bufferDesc , sizeof( bufferDesc ) ) ;
+    bufferDesc.ByteWidth        = sizeof( ShaderConstantsS ) ;
+    bufferDesc.Usage            = D3D11_USAGE_DYNAMIC ;
+    bufferDesc.BindFlags        = D3D11_BIND_CONSTANT_BUFFER ;
+    bufferDesc.CPUAccessFlags   = D3D11_CPU_ACCESS_WRITE ;
+    HROK( g_d3d11Device->CreateBuffer( & bufferDesc , NULL , & mConstantBuffer ) ) ;
+
+    Invalidate() ;
+}
+
+
+
+
+/** Release every Direct3D object this cache owns, including its context.
+*/
+void D3D11_RenderStateCache::Release()
+{
+    ReleaseStateObjects( mBlendStates   ) ;
+    ReleaseStateObjects( mDepthStates   ) ;
+    ReleaseStateObjects( mRasterStates  ) ;
+    ReleaseStateObjects( mSamplerStates ) ;
+
+    if( mConstantBuffer )
+    {
+        mConstantBuffer->Release() ;
+        mConstantBuffer = NULLPTR ;
+    }
+    if( mClearDepthStencilState )
+    {
+        mClearDepthStencilState->Release() ;
+        mClearDepthStencilState = NULLPTR ;
+    }
+    if( mContext )
+    {
+        mContext->Release() ;
+        mContext = NULLPTR ;
+    }
+}
+
+
+
+
+/** Forget cached state, so the next Apply, PrepareToDraw and BindTexture set everything.
+
+    Call this after something else changed state of the context, e.g. after a
+    command list executes on the immediate context, which resets its state,
+    including bound textures.
+*/
+void D3D11_RenderStateCache::Invalidate()
+{
+    mIsCurrentStateValid    = false ;
+    mShaderConstantsChanged = true ;
+    mTextureEnabled         = false ;
+    mBoundVertexFormat      = VertexDeclaration::VERTEX_FORMAT_NONE ;
+}
+
+
+
+
+/** Return blend state object for the given state, creating it the first time this cache encounters that state.
+*/
+ID3D11BlendState * D3D11_RenderStateCache::FindOrCreateBlendState( const BlendStateS & blendState )
+{
+    for( size_t idx = 0 ; idx < mBlendStates.Size() ; ++ idx )
+    {
+        if( mBlendStates[ idx ].mState == blendState )
+        {
+            return mBlendStates[ idx ].mObject ;
+        }
+    }
+
+    D3D11_BLEND_DESC blendDesc ;
+    ZeroMemory( & blendDesc , sizeof( blendDesc ) ) ;
+    D3D11_RENDER_TARGET_BLEND_DESC & target = blendDesc.RenderTarget[ 0 ] ;
+    target.BlendEnable              = blendState.mBlendEnabled ? TRUE : FALSE ;
+    target.SrcBlend                 = blendFactor( blendState.mBlendSrcColor ) ;
+    target.DestBlend                = blendFactor( blendState.mBlendDstColor ) ;
+    target.BlendOp                  = blendOperation( blendState.mBlendOpColor ) ;
+    target.SrcBlendAlpha            = blendFactor( blendState.mBlendSrcAlpha ) ;
+    target.DestBlendAlpha           = blendFactor( blendState.mBlendDstAlpha ) ;
+    target.BlendOpAlpha             = blendOperation( blendState.mBlendOpAlpha ) ;
+    target.RenderTargetWriteMask    = D3D11_COLOR_WRITE_ENABLE_ALL ;
+
+    BlendStateObjectS stateObject ;
+    stateObject.mState  = blendState ;
+    stateObject.mObject = NULLPTR ;
+    HROK( g_d3d11Device->CreateBlendState( & blendDesc , & stateObject.mObject ) ) ;
+    mBlendStates.PushBack( stateObject ) ;
+    return stateObject.mObject ;
+}
+
+
+
+
+/** Return depth-stencil state object for the given state, creating it the first time this cache encounters that state.
+
+    StencilStateS only says whether to enable the stencil test, so an enabled
+    test uses the Direct3D defaults that D3D9 render states also start with:
+    pass always, keep stencil values, and full read and write masks.
+*/
+ID3D11DepthStencilState * D3D11_RenderStateCache::FindOrCreateDepthState( const DepthStencilStateS & depthStencilState )
+{
+    for( size_t idx = 0 ; idx < mDepthStates.Size() ; ++ idx )
+    {
+        if( mDepthStates[ idx ].mState == depthStencilState )
+        {
+            return mDepthStates[ idx ].mObject ;
+        }
+    }
+
+    const DepthStateS &     depthState      = depthStencilState.mDepthState ;
+    const StencilStateS &   stencilState    = depthStencilState.mStencilState ;
+
+    D3D11_DEPTH_STENCIL_DESC depthDesc ;
+    ZeroMemory( & depthDesc , sizeof( depthDesc ) ) ;
+    depthDesc.DepthEnable       = ( CMP_FUNC_ALWAYS != depthState.mDepthFunc ) || depthState.mDepthWriteEnabled ;
+    depthDesc.DepthWriteMask    = depthState.mDepthWriteEnabled ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO ;
+    depthDesc.DepthFunc         = compareFunction( depthState.mDepthFunc ) ;
+    depthDesc.StencilEnable     = stencilState.mStencilEnabled ? TRUE : FALSE ;
+    depthDesc.StencilReadMask   = D3D11_DEFAULT_STENCIL_READ_MASK ;
+    depthDesc.StencilWriteMask  = D3D11_DEFAULT_STENCIL_WRITE_MASK ;
+    const D3D11_DEPTH_STENCILOP_DESC stencilOps = { D3D11_STENCIL_OP_KEEP , D3D11_STENCIL_OP_KEEP , D3D11_STENCIL_OP_KEEP , D3D11_COMPARISON_ALWAYS } ;
+    depthDesc.FrontFace         = stencilOps ;
+    depthDesc.BackFace          = stencilOps ;
+
+    DepthStateObjectS stateObject ;
+    stateObject.mState  = depthStencilState ;
+    stateObject.mObject = NULLPTR ;
+    HROK( g_d3d11Device->CreateDepthStencilState( & depthDesc , & stateObject.mObject ) ) ;
+    mDepthStates.PushBack( stateObject ) ;
+    return stateObject.mObject ;
+}
+
+
+
+
+/** Return rasterizer state object for the given state, creating it the first time this cache encounters that state.
+
+    Direct3D 11 has no point fill mode, so FILL_MODE_POINT draws wireframe.
+*/
+ID3D11RasterizerState * D3D11_RenderStateCache::FindOrCreateRasterState( const RasterizerStateS & rasterizerState )
+{
+    for( size_t idx = 0 ; idx < mRasterStates.Size() ; ++ idx )
+    {
+        if( mRasterStates[ idx ].mState == rasterizerState )
+        {
+            return mRasterStates[ idx ].mObject ;
+        }
+    }
+
+    const RasterStateS & rasterState = rasterizerState.mRasterState ;
+
+    D3D11_RASTERIZER_DESC rasterDesc ;
+    ZeroMemory( & rasterDesc , sizeof( rasterDesc ) ) ;
+    rasterDesc.FillMode = ( RasterState::FILL_MODE_SOLID == rasterState.mFillMode ) ? D3D11_FILL_SOLID : D3D11_FILL_WIREFRAME ;
+    switch( rasterState.mCullMode )
+    {
+    case RasterState::CULL_MODE_NONE : rasterDesc.CullMode = D3D11_CULL_NONE  ; break ;
+    case RasterState::CULL_MODE_FRONT: rasterDesc.CullMode = D3D11_CULL_FRONT ; break ;
+    case RasterState::CULL_MODE_BACK : rasterDesc.CullMode = D3D11_CULL_BACK  ; break ;
+    default: FAIL() ; break ;
+    }
+    rasterDesc.FrontCounterClockwise    = TRUE ;    // Front faces are wound CCW, as in RasterStateS.
+    rasterDesc.DepthBias                = rasterizerState.mDepthBias ;
+    rasterDesc.DepthClipEnable          = rasterizerState.mDepthClip ? TRUE : FALSE ;
+    rasterDesc.MultisampleEnable        = rasterState.mMultiSampleEnabled ? TRUE : FALSE ;
+    rasterDesc.AntialiasedLineEnable    = rasterState.mSmoothLines ? TRUE : FALSE ;
+
+    RasterStateObjectS stateObject ;
+    stateObject.mState  = rasterizerState ;
+    stateObject.mObject = NULLPTR ;
+    HROK( g_d3d11Device->CreateRasterizerState( & rasterDesc , & stateObject.mObject ) ) ;
+    mRasterStates.PushBack( stateObject ) ;
+    return stateObject.mObject ;
+}
+
+
+
+
+/** Return sampler state object for the given state, creating it the first time this cache encounters that state.
+*/
+ID3D11SamplerState * D3D11_RenderStateCache::FindOrCreateSamplerState( const SamplerStateS & samplerState )
+{
+    for( size_t idx = 0 ; idx < mSamplerStates.Size() ; ++ idx )
+    {   // SamplerStateS has only enumerated members, so no padding, so memcmp suffices.
+        if( ! memcmp( & mSamplerStates[ idx ].mState , & samplerState , sizeof( SamplerStateS ) ) )
+        {
+            return mSamplerStates[ idx ].mObject ;
+        }
+    }
+
+    D3D11_SAMPLER_DESC samplerDesc ;
+    ZeroMemory( & samplerDesc , sizeof( samplerDesc ) ) ;
+    samplerDesc.Filter          = samplerFilter( samplerState ) ;
+    samplerDesc.AddressU        = samplerAddress( samplerState.mAddressU ) ;
+    samplerDesc.AddressV        = samplerAddress( samplerState.mAddressV ) ;
+    samplerDesc.AddressW        = samplerAddress( samplerState.mAddressW ) ;
+    samplerDesc.MaxAnisotropy   = 1 ;
+    samplerDesc.ComparisonFunc  = D3D11_COMPARISON_NEVER ;
+    samplerDesc.MaxLOD          = ( SamplerState::FILTER_NO_MIPMAP == samplerState.mMipFilter ) ? 0.0f : D3D11_FLOAT32_MAX ;
+
+    SamplerStateObjectS stateObject ;
+    stateObject.mState  = samplerState ;
+    stateObject.mObject = NULLPTR ;
+    HROK( g_d3d11Device->CreateSamplerState( & samplerDesc , & stateObject.mObject ) ) ;
+    mSamplerStates.PushBack( stateObject ) ;
+    return stateObject.mObject ;
+}
+
+
+
+
+/** Apply render state, changing only the parts that differ from the state most recently applied.
+*/
+void D3D11_RenderStateCache::Apply( const RenderStateS & renderState )
+{
+    RENDER_CHECK_ERROR( D3D11_RenderStateCache_Apply_before ) ;
+
+    ASSERT( mContext != NULLPTR ) ;
+
+    const bool applyAll = ! mIsCurrentStateValid ;
+
+    if( applyAll || ! ( mCurrentState.mBlendState == renderState.mBlendState ) )
+    {
+        static const FLOAT blendFactors[ 4 ] = { 1.0f , 1.0f , 1.0f , 1.0f } ;
+        mContext->OMSetBlendState( FindOrCreateBlendState( renderState.mBlendState ) , blendFactors , 0xffffffff ) ;
+        mCurrentState.mBlendState = renderState.mBlendState ;
+    }
+
+    if( applyAll || ! ( mCurrentState.mDepthState == renderState.mDepthState ) || ! ( mCurrentState.mStencilState == renderState.mStencilState ) )
+    {
+        DepthStencilStateS depthStencilState ;
+        depthStencilState.mDepthState   = renderState.mDepthState ;
+        depthStencilState.mStencilState = renderState.mStencilState ;
+        mContext->OMSetDepthStencilState( FindOrCreateDepthState( depthStencilState ) , 0 ) ;
+    }
+
+    if(     applyAll || ! ( mCurrentState.mRasterState == renderState.mRasterState )
+        ||  ( mCurrentState.mDepthState.mDepthBias != renderState.mDepthState.mDepthBias ) || ( mCurrentState.mDepthState.mDepthClip != renderState.mDepthState.mDepthClip ) )
+    {   // Direct3D 11 applies depth bias and clipping when rasterizing.
+        RasterizerStateS rasterizerState ;
+        rasterizerState.mRasterState    = renderState.mRasterState ;
+        rasterizerState.mDepthBias      = renderState.mDepthState.mDepthBias ;
+        rasterizerState.mDepthClip      = renderState.mDepthState.mDepthClip ;
+        mContext->RSSetState( FindOrCreateRasterState( rasterizerState ) ) ;
+        mCurrentState.mRasterState = renderState.mRasterState ;
+    }
+    mCurrentState.mDepthState   = renderState.mDepthState   ;
+    mCurrentState.mStencilState = renderState.mStencilState ;
+
+    if( applyAll || ! ( mCurrentState.mAlphaState == renderState.mAlphaState ) )
+    {   // Pixel shader performs alpha test.
+        const AlphaStateS & alphaState = renderState.mAlphaState ;
+        mShaderConstants.mFlags.y = alphaState.mAlphaTest ? float( alphaState.mAlphaFunc ) : -1.0f ;
+        mShaderConstants.mFlags.z = alphaState.mAlphaRef ;
+        mShaderConstantsChanged = true ;
+        mCurrentState.mAlphaState = renderState.mAlphaState ;
+    }
+
+    if( applyAll || ! ( mCurrentState.mMaterialProperties == renderState.mMaterialProperties ) )
+    {   // Vertex shader uses material colors.
+        const MaterialPropertiesS & materialProperties = renderState.mMaterialProperties ;
+        mShaderConstants.mMaterialDiffuse   = materialProperties.mDiffuseColor ;
+        mShaderConstants.mMaterialAmbient   = materialProperties.mAmbientColor ;
+        mShaderConstants.mMaterialEmissive  = materialProperties.mEmissiveColor ;
+        mShaderConstantsChanged = true ;
+        mCurrentState.mMaterialProperties = renderState.mMaterialProperties ;
+    }
+
+    // Shaders interpolate colors smoothly; flat shading would need a nointerpolation variant.
+    mCurrentState.mShadeMode    = renderState.mShadeMode    ;
+    mCurrentState.mShader       = renderState.mShader       ;
+
+    mIsCurrentStateValid = true ;
+
+    RENDER_CHECK_ERROR( D3D11_RenderStateCache_Apply_after ) ;
+}
+
+
+
+
+/** Set transforms from world space to view space, and from view space to clip space.
+*/
+void D3D11_RenderStateCache::SetViewAndProjection( const Mat44 & view , const Mat44 & projection )
+{
+    mShaderConstants.mView          = view ;
+    mShaderConstants.mProjection    = projection ;
+    mCurrentState.mTransforms.mViewMatrix = view ;
+    mShaderConstantsChanged = true ;
+}
+
+
+
+
+/** Set transform from model space to world space, for subsequent draws.
+*/
+void D3D11_RenderStateCache::SetLocalToWorld( const Mat44 & localToWorld )
+{
+    mShaderConstants.mLocalToWorld = localToWorld ;
+    mShaderConstantsChanged = true ;
+}
+
+
+
+
+/** Set box against which POSITION_NORMAL_PACKED positions were quantized, for subsequent draws.
+
+    \param positionOffset  World-space position that quantized position 0 represents.  See VertexBufferBase::GetPositionOffset.
+
+    \param positionScale   Distance, along each axis, between adjacent quantized positions.  See VertexBufferBase::GetPositionScale.
+*/
+void D3D11_RenderStateCache::SetPositionDequantization( const float positionOffset[ 3 ] , const float positionScale[ 3 ] )
+{
+    const Vec4 offset( positionOffset[ 0 ] , positionOffset[ 1 ] , positionOffset[ 2 ] , 0.0f ) ;
+    const Vec4 scale ( positionScale [ 0 ] , positionScale [ 1 ] , positionScale [ 2 ] , 1.0f ) ;
+    if( memcmp( & offset , & mShaderConstants.mPositionOffset , sizeof( offset ) ) || memcmp( & scale , & mShaderConstants.mPositionScale , sizeof( scale ) ) )
+    {   // Box differs from that of previous packed draw, e.g. another isosurface chunk.
+        mShaderConstants.mPositionOffset    = offset ;
+        mShaderConstants.mPositionScale     = scale ;
+        mShaderConstantsChanged = true ;
+    }
+}
+
+
+
+
+/** Set lights cached for the given receiver, for subsequent draws of vertices that have normals.
+
+    Like D3D9_Api::SetLights, light positions and directions are in world space.
+*/
+void D3D11_RenderStateCache::SetLights( const ModelNode & lightReceiver )
+{
+    static const float globalAmbient = 50.0f / 255.0f ; // Same as D3DRS_AMBIENT in D3D9_Api::SetLights.
+
+    const unsigned numLights = Min2( lightReceiver.GetNumLights() , sMaxLights ) ;
+    Vec4 ambientLight( globalAmbient , globalAmbient , globalAmbient , 1.0f ) ;
+    unsigned numDirectLights = 0 ;
+    for( unsigned idx = 0 ; idx < numLights ; ++ idx )
+    {   // For each light in the given model's cache...
+        const Light & light = * lightReceiver.GetLight( idx ) ;
+        ambientLight += light.GetAmbientColor() ;
+        if( Light::AMBIENT == light.GetLightType() )
+        {   // Light has no position or direction; it only contributes ambient.
+            continue ;
+        }
+        const bool hasPosition = ( light.GetLightType() != Light::DIRECTIONAL ) ;
+        const Vec3 & where = hasPosition ? light.GetPosition() : light.GetDirection() ;
+        mShaderConstants.mLightPositions[ numDirectLights ]     = Vec4( where.x , where.y , where.z , hasPosition ? 1.0f : 0.0f ) ;
+        mShaderConstants.mLightDiffuse[ numDirectLights ]       = light.GetDiffuseColor() ;
+        mShaderConstants.mLightAttenuation[ numDirectLights ]   = Vec4( light.GetConstAttenuation() , light.GetLinearAttenuation() , light.GetQuadracticAttenuation() , light.GetRange() ) ;
+        if( Light::SPOT == light.GetLightType() )
+        {   // Like D3DLIGHT9 Theta and Phi, inner and outer angles span the whole cone.
+            const Vec3 & direction = light.GetDirection() ;
+            const float  magnitude = direction.Magnitude() ;
+            const Vec3   spotDir   = ( magnitude > 0.0f ) ? direction / magnitude : Vec3( 0.0f , 0.0f , -1.0f ) ;
+            mShaderConstants.mLightSpotDirection[ numDirectLights ] = Vec4( spotDir , light.GetSpotFalloff() ) ;
+            mShaderConstants.mLightSpotCone[ numDirectLights ]      = Vec4( cosf( 0.5f * light.GetSpotInnerAngle() * DEG2RAD ) , cosf( 0.5f * light.GetSpotOuterAngle() * DEG2RAD ) , 0.0f , 0.0f ) ;
+        }
+        else
+        {
+            mShaderConstants.mLightSpotDirection[ numDirectLights ] = Vec4( 0.0f , 0.0f , 0.0f , 0.0f ) ;
+            mShaderConstants.mLightSpotCone[ numDirectLights ]      = Vec4( 1.0f , -2.0f , 0.0f , 0.0f ) ;
+        }
+        ++ numDirectLights ;
+    }
+    mShaderConstants.mAmbientLight  = ambientLight ;
+    mShaderConstants.mFlags.x       = float( numDirectLights ) ;
+    // Lighting stays disabled for models without lights, as in D3D9_Api::SetLights.
+    mShaderConstants.mFlags.w       = ( numLights > 0 ) ? 1.0f : 0.0f ;
+    mShaderConstantsChanged = true ;
+}
+
+
+
+
+/** Bind the given texture, with the given sampler state, to the first texture stage.
+*/
+void D3D11_RenderStateCache::BindTexture( ID3D11ShaderResourceView * shaderResourceView , const SamplerStateS & samplerState )
+{
+    ASSERT( mContext != NULLPTR ) ;
+
+    ID3D11SamplerState * sampler = FindOrCreateSamplerState( samplerState ) ;
+    mContext->PSSetShaderResources( 0 , 1 , & shaderResourceView ) ;
+    mContext->PSSetSamplers( 0 , 1 , & sampler ) ;
+    mTextureEnabled         = ( shaderResourceView != NULLPTR ) ;
+    mTextureReplacesColor   = ( SamplerState::COMBO_OP_REPLACE == samplerState.mCombineOperation ) ;
+}
+
+
+
+
+/** Stop sampling textures, for subsequent draws.
+*/
+void D3D11_RenderStateCache::DisableTexturing()
+{
+    mTextureEnabled = false ;
+}
+
+
+
+
+/** Bind shaders and input layout for vertices with the given format, and upload shader constants if they changed.
+
+    Call this immediately before each draw.
+*/
+void D3D11_RenderStateCache::PrepareToDraw( const VertexDeclaration & vertexDeclaration )
+{
+    ASSERT( mContext != NULLPTR ) ;
+
+    const VertexDeclaration::VertexFormatE vertexFormat = vertexDeclaration.GetVertexFormat() ;
+    ASSERT( sVertexShaders[ vertexFormat ] != NULLPTR ) ; // Vertex format is unsupported, or CreateShaders has not run.
+
+    if( vertexFormat != mBoundVertexFormat )
+    {   // Vertex format differs from that of previous draw.
+        mContext->IASetInputLayout( sInputLayouts[ vertexFormat ] ) ;
+        mContext->VSSetShader( sVertexShaders[ vertexFormat ] , NULL , 0 ) ;
+        mContext->VSSetConstantBuffers( 0 , 1 , & mConstantBuffer ) ;
+        mContext->PSSetConstantBuffers( 0 , 1 , & mConstantBuffer ) ;
+    }
+
+    // Like D3D9_Mesh::ModifyRenderState, sample texture only for vertices that have texture coordinates.
+    const bool      sampleTexture   = mTextureEnabled && vertexDeclaration.HasTextureCoordinates() ;
+    const unsigned  pixelShader     = sampleTexture ? ( mTextureReplacesColor ? PIXEL_SHADER_REPLACE : PIXEL_SHADER_MODULATE ) : PIXEL_SHADER_UNTEXTURED ;
+    if( ( vertexFormat != mBoundVertexFormat ) || ( pixelShader != mBoundPixelShader ) )
+    {
+        mContext->PSSetShader( sPixelShaders[ pixelShader ] , NULL , 0 ) ;
+        mBoundPixelShader = pixelShader ;
+    }
+    mBoundVertexFormat = vertexFormat ;
+
+    if( mShaderConstantsChanged )
+    {   // Some constant changed since previous draw.
+        D3D11_MAPPED_SUBRESOURCE mappedConstants ;
+        HROK( mContext->Map( mConstantBuffer , 0 , D3D11_MAP_WRITE_DISCARD , 0 , & mappedConstants ) ) ;
+        memcpy( mappedConstants.pData , & mShaderConstants , sizeof( mShaderConstants ) ) ;
+        mContext->Unmap( mConstantBuffer , 0 ) ;
+        mShaderConstantsChanged = false ;
+    }
+}
+
+
+
+
+/** Fill the bound viewport with the given color, far depth and zero stencil.
+
+    Unlike ClearRenderTargetView and ClearDepthStencilView, which clear whole
+    views, this affects only the viewport, like D3D9 Clear.  It draws one
+    triangle with its own shaders and state objects, so afterward it forgets
+    cached state, and the next Apply and PrepareToDraw set everything.
+*/
+void D3D11_RenderStateCache::ClearViewport( const Vec4 & clearColor )
+{
+    ASSERT( mContext != NULLPTR ) ;
+    ASSERT( sClearVertexShader && sClearPixelShader ) ; // CreateShaders has not run.
+
+    if( NULLPTR == mClearDepthStencilState )
+    {   // First clear.  Create state that overwrites depth and stencil unconditionally.
+        D3D11_DEPTH_STENCIL_DESC depthDesc ;
+        ZeroMemory( & depthDesc , sizeof( depthDesc ) ) ;
+        depthDesc.DepthEnable       = TRUE ;
+        depthDesc.DepthWriteMask    = D3D11_DEPTH_WRITE_MASK_ALL ;
+        depthDesc.DepthFunc         = D3D11_COMPARISON_ALWAYS ;
+        depthDesc.StencilEnable     = TRUE ;
+        depthDesc.StencilReadMask   = D3D11_DEFAULT_STENCIL_READ_MASK ;
+        depthDesc.StencilWriteMask  = D3D11_DEFAULT_STENCIL_WRITE_MASK ;
+        const D3D11_DEPTH_STENCILOP_DESC stencilOps = { D3D11_STENCIL_OP_REPLACE , D3D11_STENCIL_OP_REPLACE , D3D11_STENCIL_OP_REPLACE , D3D11_COMPARISON_ALWAYS } ;
+        depthDesc.FrontFace         = stencilOps ;
+        depthDesc.BackFace          = stencilOps ;
+        HROK( g_d3d11Device->CreateDepthStencilState( & depthDesc , & mClearDepthStencilState ) ) ;
+    }
+
+    RasterizerStateS rasterizerState ;
+    rasterizerState.mRasterState            = RasterState() ;
+    rasterizerState.mRasterState.mCullMode  = RasterState::CULL_MODE_NONE ;
+    rasterizerState.mDepthBias              = 0 ;
+    rasterizerState.mDepthClip              = true ;
+
+    static const FLOAT blendFactors[ 4 ] = { 1.0f , 1.0f , 1.0f , 1.0f } ;
+    mContext->OMSetBlendState( FindOrCreateBlendState( BlendState() ) , blendFactors , 0xffffffff ) ;
+    mContext->OMSetDepthStencilState( mClearDepthStencilState , 0 ) ;
+    mContext->RSSetState( FindOrCreateRasterState( rasterizerState ) ) ;
+
+    mShaderConstants.mClearColor = clearColor ;
+    D3D11_MAPPED_SUBRESOURCE mappedConstants ;
+    HROK( mContext->Map( mConstantBuffer , 0 , D3D11_MAP_WRITE_DISCARD , 0 , & mappedConstants ) ) ;
+    memcpy( mappedConstants.pData , & mShaderConstants , sizeof( mShaderConstants ) ) ;
+    mContext->Unmap( mConstantBuffer , 0 ) ;
+
+    mContext->IASetInputLayout( NULL ) ;
+    mContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ) ;
+    mContext->VSSetShader( sClearVertexShader , NULL , 0 ) ;
+    mContext->PSSetShader( sClearPixelShader , NULL , 0 ) ;
+    mContext->PSSetConstantBuffers( 0 , 1 , & mConstantBuffer ) ;
+    mContext->Draw( 3 , 0 ) ;
+
+    Invalidate() ;
+}
+
+
+
+
+/** Return render state cache of the command recorder the calling thread records into, or of the immediate context if the thread is not recording.
+
+    Meshes and textures use this to find the context on which to issue commands.
+*/
+/* static */ D3D11_RenderStateCache & D3D11_RenderStateCache::GetCurrent()
+{
+    if( sCurrentStateCache )
+    {   // This thread records into a command recorder.
+        return * sCurrentStateCache ;
+    }
+    ASSERT( sImmediateStateCache != NULLPTR ) ;
+    return * sImmediateStateCache ;
+}
+
+
+
+
+/** Make calls on the calling thread go to the given recorder's state cache, or to immediate context if NULL.
+*/
+/* static */ void D3D11_RenderStateCache::SetCurrent( D3D11_RenderStateCache * recorderStateCache )
+{
+    sCurrentStateCache = recorderStateCache ;
+}
+
+
+
+
+/** Assign state cache of immediate context, which GetCurrent returns on threads that do not record.
+*/
+/* static */ void D3D11_RenderStateCache::SetImmediate( D3D11_RenderStateCache * immediateStateCache )
+{
+    sImmediateStateCache = immediateStateCache ;
+}
+
+
+
+
+/** Compile shaders and create input layouts for each supported vertex format.
+
+    Call once, after creating the device and before rendering.
+
+    \return Whether all shaders compiled.
+*/
+/* static */ bool D3D11_RenderStateCache::CreateShaders( ID3D11Device * device )
+{
+    ASSERT( device != NULLPTR ) ;
+
+    bool succeeded = true ;
+
+    for( int vertexFormat = VertexDeclaration::POSITION ; vertexFormat < VertexDeclaration::NUM_FORMATS ; ++ vertexFormat )
+    {   // For each vertex format...
+        const VertexDeclaration vertexDeclaration( static_cast< VertexDeclaration::VertexFormatE >( vertexFormat ) ) ;
+        D3D11_INPUT_ELEMENT_DESC inputElements[ D3D11_VertexBuffer::sMaxInputElements ] ;
+        const UINT numInputElements = D3D11_VertexBuffer::GetInputElements( vertexDeclaration.GetVertexFormat() , inputElements ) ;
+        if( 0 == numInputElements )
+        {   // Format has no Direct3D 11 layout, e.g. GENERIC.
+            continue ;
+        }
+
+        const bool isBillboardInstance = ( VertexDeclaration::BILLBOARD_INSTANCE == vertexFormat ) ;
+        const D3D_SHADER_MACRO macros[] =
+        {
+            { "HAS_NORMAL"              , vertexDeclaration.HasNormals()            ? "1" : "0" } ,
+            { "HAS_COLOR"               , vertexDeclaration.HasColors()             ? "1" : "0" } ,
+            { "HAS_TEXCOORD"            , vertexDeclaration.HasTextureCoordinates() ? "1" : "0" } ,
+            { "PACKED_POSITION_NORMAL"  , ( VertexDeclaration::POSITION_NORMAL_PACKED == vertexFormat ) ? "1" : "0" } ,
+            { NULL , NULL }
+        } ;
+        ID3DBlob * byteCode = CompileShader( isBillboardInstance ? "BillboardVertexMain" : "VertexMain" , "vs_4_0" , macros ) ;
+        if( NULLPTR == byteCode )
+        {
+            succeeded = false ;
+            continue ;
+        }
+        HROK( device->CreateVertexShader( byteCode->GetBufferPointer() , byteCode->GetBufferSize() , NULL , & sVertexShaders[ vertexFormat ] ) ) ;
+        HROK( device->CreateInputLayout( inputElements , numInputElements , byteCode->GetBufferPointer() , byteCode->GetBufferSize() , & sInputLayouts[ vertexFormat ] ) ) ;
+        byteCode->Release() ;
+    }
+
+    static const char * sampleTextureValues[ NUM_PIXEL_SHADERS ] = { "0" , "1" , "2" } ;
+    for( int pixelShader = 0 ; pixelShader < NUM_PIXEL_SHADERS ; ++ pixelShader )
+    {   // For each pixel shader variant...
+        const D3D_SHADER_MACRO macros[] =
+        {
+            { "SAMPLE_TEXTURE" , sampleTextureValues[ pixelShader ] } ,
+            { NULL , NULL }
+        } ;
+        ID3DBlob * byteCode = CompileShader( "PixelMain" , "ps_4_0" , macros ) ;
+        if( NULLPTR == byteCode )
+        {
+            succeeded = false ;
+            continue ;
+        }
+        HROK( device->CreatePixelShader( byteCode->GetBufferPointer() , byteCode->GetBufferSize() , NULL , & sPixelShaders[ pixelShader ] ) ) ;
+        byteCode->Release() ;
+    }
+
+    {   // Shaders for ClearViewport.
+        const D3D_SHADER_MACRO macros[] = { { NULL , NULL } } ;
+        ID3DBlob * vertexByteCode   = CompileShader( "ClearVertexMain" , "vs_4_0" , macros ) ;
+        ID3DBlob * pixelByteCode    = CompileShader( "ClearPixelMain"  , "ps_4_0" , macros ) ;
+        if( vertexByteCode && pixelByteCode )
+        {
+            HROK( device->CreateVertexShader( vertexByteCode->GetBufferPointer() , vertexByteCode->GetBufferSize() , NULL , & sClearVertexShader ) ) ;
+            HROK( device->CreatePixelShader ( pixelByteCode->GetBufferPointer()  , pixelByteCode->GetBufferSize()  , NULL , & sClearPixelShader  ) ) ;
+        }
+        else
+        {
+            succeeded = false ;
+        }
+        if( vertexByteCode ) vertexByteCode->Release() ;
+        if( pixelByteCode  ) pixelByteCode->Release() ;
+    }
+
+    return succeeded ;
+}
+
+
+
+
+/** Release shaders and input layouts that CreateShaders created.
+*/
+/* static */ void D3D11_RenderStateCache::ReleaseShaders()
+{
+    for( int vertexFormat = 0 ; vertexFormat < VertexDeclaration::NUM_FORMATS ; ++ vertexFormat )
+    {
+        if( sVertexShaders[ vertexFormat ] )
+        {
+            sVertexShaders[ vertexFormat ]->Release() ;
+            sVertexShaders[ vertexFormat ] = NULLPTR ;
+        }
+        if( sInputLayouts[ vertexFormat ] )
+        {
+            sInputLayouts[ vertexFormat ]->Release() ;
+            sInputLayouts[ vertexFormat ] = NULLPTR ;
+        }
+    }
+    for( int pixelShader = 0 ; pixelShader < NUM_PIXEL_SHADERS ; ++ pixelShader )
+    {
+        if( sPixelShaders[ pixelShader ] )
+        {
+            sPixelShaders[ pixelShader ]->Release() ;
+            sPixelShaders[ pixelShader ] = NULLPTR ;
+        }
+    }
+    if( sClearVertexShader )
+    {
+        sClearVertexShader->Release() ;
+        sClearVertexShader = NULLPTR ;
+    }
+    if( sClearPixelShader )
+    {
+        sClearPixelShader->Release() ;
+        sClearPixelShader = NULLPTR ;
+    }
+}
+
+
+
+
+/** Get render state.
+
+    Direct3D 11 state objects would have to be queried and decoded, so, like D3D9_RenderStateCache, this does not.
+*/
+/* static */ void D3D11_RenderStateCache::GetRenderState( RenderStateS & /*renderState*/ )
+{
+    RENDER_CHECK_ERROR( D3D11_RenderStateCache_Get_before ) ;
+    RENDER_CHECK_ERROR( D3D11_RenderStateCache_Get_after ) ;
+}
+
+
+
+
+    } ;
+} ;
+
+
+
+
+#if defined( _DEBUG )
+
+void D3D11_RenderState_UnitTest()
+{
+    DebugPrintf( "D3D11_RenderStateCache::UnitTest ----------------------------------------------\n" ) ;
+
+    {
+        PeGaSys::Render::D3D11_RenderStateCache renderState ;
+    }
+
+    DebugPrintf( "D3D11_RenderStateCache::UnitTest: THE END ----------------------------------------------\n" ) ;
+}
+#endif
@@ -0,0 +1,194 @@
+/** \file D3D11_renderState.h
+
+    \brief Wrapper for routines specific to D3D11 render system API
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_RENDER_STATE_H
+#define PEGASYS_RENDER_D3D11_RENDER_STATE_H
+
+#include <d3d11.h>
+
+#include "Core/Containers/vector.h"
+#include "Core/Math/mat4.h"
+
+#include "Render/Resource/renderState.h"
+#include "Render/Resource/textureSampler.h"
+#include "Render/Resource/vertexBuffer.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        class ModelNode ;
+
+        /** Render state of one Direct3D 11 device context.
+
+            Direct3D 11 has no fixed-function pipeline, so this emulates the parts
+            of it that D3D9_RenderStateCache uses: world, view and projection
+            transforms, per-vertex lighting (including spotlights), material
+            colors, one texture stage, and alpha test.  Vertex and pixel
+            shaders, compiled once per vertex format (see CreateShaders), read
+            those from a constant buffer, which
+            PrepareToDraw updates only when something changed since the last draw.
+
+            Immutable state objects (blend, depth-stencil, rasterizer and sampler)
+            come from per-cache lists, so setting a state seen before costs a
+            linear search instead of a call to the device.  Each cache belongs to
+            one context, and each context to one thread at a time, so caches need
+            no locks.
+        */
+        class D3D11_RenderStateCache
+        {
+            public:
+                static const unsigned sType = 'RAdb' ; ///< Type identifier for this class
+
+                D3D11_RenderStateCache() ;
+                ~D3D11_RenderStateCache() ;
+
+                void SetContext( ID3D11DeviceContext * context ) ;
+                void Release() ;
+
+                /// Return device context whose state this cache tracks, or NULL if none.
+                ID3D11DeviceContext * GetContext() const { return mContext ; }
+
+                void Apply( const RenderStateS & renderState ) ;
+                void Invalidate() ;
+
+                const RenderStateS & GetRenderStateCache() const { return mCurrentState ; }
+
+                void SetViewAndProjection( const Mat44 & view , const Mat44 & projection ) ;
+                void SetLocalToWorld( const Mat44 & localToWorld ) ;
+                void SetLights( const ModelNode & lightReceiver ) ;
+                void SetPositionDequantization( const float positionOffset[ 3 ] , const float positionScale[ 3 ] ) ;
+                void BindTexture( ID3D11ShaderResourceView * shaderResourceView , const SamplerStateS & samplerState ) ;
+                void DisableTexturing() ;
+
+                void PrepareToDraw( const VertexDeclaration & vertexDeclaration ) ;
+                void ClearViewport( const Vec4 & clearColor ) ;
+
+                /// Return transform from model space to world space, that SetLocalToWorld most recently set.
+                const Mat44 & GetLocalToWorld() const   { return mShaderConstants.mLocalToWorld ; }
+
+                /// Return transform from world space to view space, that SetViewAndProjection most recently set.
+                const Mat44 & GetView() const           { return mShaderConstants.mView ; }
+
+                /// Return transform from view space to clip space, that SetViewAndProjection most recently set.
+                const Mat44 & GetProjection() const     { return mShaderConstants.mProjection ; }
+
+                static D3D11_RenderStateCache & GetCurrent() ;
+                static void SetCurrent( D3D11_RenderStateCache * recorderStateCache ) ;
+                static void SetImmediate( D3D11_RenderStateCache * immediateStateCache ) ;
+
+                static bool CreateShaders( ID3D11Device * device ) ;
+                static void ReleaseShaders() ;
+
+                static void GetRenderState( RenderStateS & renderState ) ;
+
+                /// Maximum number of lights that shaders evaluate per vertex.
+                static const unsigned sMaxLights = 8 ;
+
+                /// Pixel shader variants, which differ in how they combine texture color with vertex color.
+                enum PixelShaderE
+                {
+                    PIXEL_SHADER_UNTEXTURED ,   ///< Use vertex color.
+                    PIXEL_SHADER_MODULATE   ,   ///< Multiply vertex color by texture color.
+                    PIXEL_SHADER_REPLACE    ,   ///< Use texture color.
+                    NUM_PIXEL_SHADERS
+                } ;
+
+            private:
+                /** Shader constants, laid out to match the Constants cbuffer in the shader source.
+                */
+                struct ShaderConstantsS
+                {
+                    Mat44   mLocalToWorld                   ;   ///< Transform from model space to world space.
+                    Mat44   mView                           ;   ///< Transform from world space to view space.
+                    Mat44   mProjection                     ;   ///< Transform from view space to clip space.
+                    Vec4    mMaterialDiffuse                ;   ///< Diffuse color, used when vertices lack colors.
+                    Vec4    mMaterialAmbient                ;   ///< Ambient color, used when vertices lack colors.
+                    Vec4    mMaterialEmissive               ;   ///< Emissive color.
+                    Vec4    mAmbientLight                   ;   ///< Ambient light, summed over lights, plus global ambient.
+                    Vec4    mLightPositions[ sMaxLights ]   ;   ///< Per light, world-space position (w=1) or direction light travels (w=0).
+                    Vec4    mLightDiffuse[ sMaxLights ]     ;   ///< Per light, diffuse color.
+                    Vec4    mLightAttenuation[ sMaxLights ] ;   ///< Per light, constant, linear and quadratic attenuation, and range.
+                    Vec4    mLightSpotDirection[ sMaxLights ];  ///< Per light, world-space direction of spotlight cone, and falloff exponent.
+                    Vec4    mLightSpotCone[ sMaxLights ]    ;   ///< Per light, cosines of half the inner and outer cone angles, or -2 for lights other than spotlights.
+                    Vec4    mPositionOffset                 ;   ///< World-space position that quantized position 0 represents.  Only POSITION_NORMAL_PACKED uses this.
+                    Vec4    mPositionScale                  ;   ///< Distance, along each axis, between adjacent quantized positions.  Only POSITION_NORMAL_PACKED uses this.
+                    Vec4    mClearColor                     ;   ///< Color with which ClearViewport fills the viewport.
+                    Vec4    mFlags                          ;   ///< Number of lights with position or direction, alpha test function (or -1 if disabled), alpha test reference, whether lighting is enabled.
+                } ;
+
+                /** Immutable state object, together with the state it represents.
+                */
+                template< typename StateT , typename ObjectT > struct StateObjectS
+                {
+                    StateT      mState  ;   ///< State that mObject represents.
+                    ObjectT *   mObject ;   ///< Direct3D state object.
+                } ;
+
+                /** Depth and stencil state, which Direct3D 11 combines into one state object.
+                */
+                struct DepthStencilStateS
+                {
+                    DepthStateS     mDepthState     ;   ///< Depth test and write.  Depth bias and clip belong to RasterizerStateS.
+                    StencilStateS   mStencilState   ;   ///< Stencil test.
+
+                    bool operator==( const DepthStencilStateS & that ) const
+                    {
+                        return ( mDepthState.mDepthFunc == that.mDepthState.mDepthFunc ) && ( mDepthState.mDepthWriteEnabled == that.mDepthState.mDepthWriteEnabled ) && ( mStencilState == that.mStencilState ) ;
+                    }
+                } ;
+
+                /** Rasterizer state, including the parts of DepthStateS that Direct3D 11 applies when rasterizing.
+                */
+                struct RasterizerStateS
+                {
+                    RasterStateS    mRasterState    ;   ///< Fill, cull, multisample and line smoothing.
+                    int             mDepthBias      ;   ///< Depth value added to each pixel.
+                    bool            mDepthClip      ;   ///< Whether to clip against near and far planes.
+
+                    bool operator==( const RasterizerStateS & that ) const
+                    {
+                        return ( mRasterState == that.mRasterState ) && ( mDepthBias == that.mDepthBias ) && ( mDepthClip == that.mDepthClip ) ;
+                    }
+                } ;
+
+                typedef StateObjectS< BlendStateS , ID3D11BlendState >                  BlendStateObjectS   ;
+                typedef StateObjectS< DepthStencilStateS , ID3D11DepthStencilState >    DepthStateObjectS   ;
+                typedef StateObjectS< RasterizerStateS , ID3D11RasterizerState >        RasterStateObjectS  ;
+                typedef StateObjectS< SamplerStateS , ID3D11SamplerState >              SamplerStateObjectS ;
+
+                ID3D11BlendState *          FindOrCreateBlendState( const BlendStateS & blendState ) ;
+                ID3D11DepthStencilState *   FindOrCreateDepthState( const DepthStencilStateS & depthStencilState ) ;
+                ID3D11RasterizerState *     FindOrCreateRasterState( const RasterizerStateS & rasterizerState ) ;
+                ID3D11SamplerState *        FindOrCreateSamplerState( const SamplerStateS & samplerState ) ;
+
+                ID3D11DeviceContext *           mContext                ;   ///< Device context whose state this tracks.
+                ID3D11Buffer *                  mConstantBuffer         ;   ///< Buffer that holds mShaderConstants for shaders.
+                ID3D11DepthStencilState *       mClearDepthStencilState ;   ///< State with which ClearViewport writes far depth and zero stencil to every pixel, or NULL until the first ClearViewport.
+                RenderStateS                    mCurrentState           ;   ///< Cache of current render state.  Used to avoid unnecessary state change calls into underlying API.
+                bool                            mIsCurrentStateValid    ;   ///< Whether mCurrentState reflects the state of mContext.  False until the first Apply, and after Invalidate.
+                ShaderConstantsS                mShaderConstants        ;   ///< Shader constants that the next draw uses.
+                bool                            mShaderConstantsChanged ;   ///< Whether mShaderConstants changed since PrepareToDraw last uploaded them.
+                bool                            mTextureEnabled         ;   ///< Whether a texture is bound, which vertices with texture coordinates sample.
+                bool                            mTextureReplacesColor   ;   ///< Whether texture color replaces vertex color (SamplerState::COMBO_OP_REPLACE), rather than modulating it.
+                VertexDeclaration::VertexFormatE mBoundVertexFormat     ;   ///< Vertex format whose shaders and input layout are bound, or VERTEX_FORMAT_NONE.
+                unsigned                        mBoundPixelShader       ;   ///< Which pixel shader is bound: one of PixelShaderE.
+                VECTOR< BlendStateObjectS >     mBlendStates            ;   ///< Blend state objects this cache created.
+                VECTOR< DepthStateObjectS >     mDepthStates            ;   ///< Depth-stencil state objects this cache created.
+                VECTOR< RasterStateObjectS >    mRasterStates           ;   ///< Rasterizer state objects this cache created.
+                VECTOR< SamplerStateObjectS >   mSamplerStates          ;   ///< Sampler state objects this cache created.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
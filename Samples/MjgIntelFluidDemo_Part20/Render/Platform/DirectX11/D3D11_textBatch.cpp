@@ -0,0 +1,472 @@
+/** \file D3D11_textBatch.cpp
+
+    \brief Batch of bitmap-font text drawn as textured quadrilaterals from a font atlas, with one draw call.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <windows.h>
+
+#include <d3d11.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+#include "Render/Platform/DirectX11/D3D11_renderState.h"
+
+#include "Render/Platform/DirectX11/D3D11_textBatch.h"
+
+extern ID3D11Device * g_d3d11Device ; // Direct3D rendering device
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/// Height, in pixels, of the atlas font, comparable to GLUT_BITMAP_HELVETICA_10 that OpenGL_Api uses.
+static const int sFontHeight = 11 ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct text batch.
+
+            This does not touch Direct3D; the first Flush does, since that requires a device.
+        */
+        D3D11_TextBatch::D3D11_TextBatch()
+            : mVertexBuffer( NULLPTR )
+            , mVertexCapacity( 0 )
+            , mAtlasView( NULLPTR )
+            , mIsSupported( -1 )
+        {
+            memset( mAdvances , 0 , sizeof( mAdvances ) ) ;
+        }
+
+
+
+
+        /** Destruct text batch.
+        */
+        D3D11_TextBatch::~D3D11_TextBatch()
+        {
+            Release() ;
+        }
+
+
+
+
+        /** Release Direct3D objects, e.g. before the device goes away.  The next Flush recreates them.
+        */
+        void D3D11_TextBatch::Release()
+        {
+            if( mVertexBuffer )
+            {
+                mVertexBuffer->Release() ;
+                mVertexBuffer = NULLPTR ;
+            }
+            mVertexCapacity = 0 ;
+            if( mAtlasView )
+            {
+                mAtlasView->Release() ;
+                mAtlasView = NULLPTR ;
+            }
+            mIsSupported = -1 ;
+        }
+
+
+
+
+        /** Queue text to draw during the next Flush.
+
+            \param position         Pen position of first glyph.  When useScreenSpace, this is
+                                    in pixels from the upper left of the viewport, as with
+                                    D3D11_Api::RenderSimpleText.  Otherwise, this is in
+                                    model space of the transforms renderStateCache has.
+
+            \param useScreenSpace   Whether position is in screen space, so text appears in front of everything.
+
+            \param color            Color of text, including opacity.
+
+            \param text             Text to draw.  This copies it, so it need not outlive this call.
+
+            \param viewport         Current viewport.
+
+            \param renderStateCache Render state whose transforms project world-space positions.
+        */
+        void D3D11_TextBatch::AddText( const Vec3 & position , bool useScreenSpace , const Vec4 & color , const char * text , const D3D11_VIEWPORT & viewport , const D3D11_RenderStateCache & renderStateCache )
+        {
+            PERF_BLOCK( D3D11_TextBatch__AddText ) ;
+
+            if( ( viewport.Width <= 0.0f ) || ( viewport.Height <= 0.0f ) )
+            {   // Zero-size viewport, e.g. because window is minimized.
+                return ;
+            }
+
+            QueuedString queuedString ;
+            if( useScreenSpace )
+            {   // Position is in pixels from upper left of viewport.
+                queuedString.mViewportPosition = Vec3( position.x , position.y , 0.0f ) ;
+            }
+            else
+            {   // Position is in model space.  Project it the way the vertex shader would.
+                const Vec4 worldPosition    = renderStateCache.GetLocalToWorld() * Vec4( position , 1.0f ) ;
+                const Vec4 clipPosition     = renderStateCache.GetProjection() * ( renderStateCache.GetView() * worldPosition ) ;
+                if( clipPosition.w <= 0.0f )
+                {   // Position lies behind the eye.
+                    return ;
+                }
+                const Vec3 ndc = Vec3( clipPosition.x , clipPosition.y , clipPosition.z ) / clipPosition.w ;
+                if(     ( ndc.z < 0.0f ) || ( ndc.z > 1.0f )
+                    ||  ( ndc.x < -1.0f ) || ( ndc.x > 1.0f )
+                    ||  ( ndc.y < -1.0f ) || ( ndc.y > 1.0f ) )
+                {   // Position lies outside view volume, where OpenGL_TextBatch would draw nothing.
+                    return ;
+                }
+                queuedString.mViewportPosition = Vec3( ( ndc.x + 1.0f ) * 0.5f * viewport.Width , ( 1.0f - ndc.y ) * 0.5f * viewport.Height , ndc.z ) ;
+            }
+            queuedString.mViewportWidth     = viewport.Width ;
+            queuedString.mViewportHeight    = viewport.Height ;
+            queuedString.mColor             = color ;
+            queuedString.mFirstChar         = mCharacters.Size() ;
+            queuedString.mNumChars          = strlen( text ) ;
+            queuedString.mUseScreenSpace    = useScreenSpace ;
+            mCharacters.insert( mCharacters.End() , text , text + queuedString.mNumChars ) ;
+            mStrings.PushBack( queuedString ) ;
+        }
+
+
+
+
+        /** Draw all text queued since the previous Flush, with the given render state cache, then empty the queue.
+
+            This leaves transforms as it found them, but changes other render
+            state, which the cache tracks, so the next Apply restores it.
+        */
+        void D3D11_TextBatch::Flush( D3D11_RenderStateCache & renderStateCache )
+        {
+            PERF_BLOCK( D3D11_TextBatch__Flush ) ;
+
+            if( mStrings.Empty() )
+            {   // Nothing to draw.
+                return ;
+            }
+
+            if( mIsSupported < 0 )
+            {   // First call.
+                mIsSupported = BuildAtlas() ? 1 : 0 ;
+            }
+
+            size_t numGlyphs = 0 ;
+            for( size_t iString = 0 ; iString < mStrings.Size() ; ++ iString )
+            {   // For each queued string...
+                numGlyphs += mStrings[ iString ].mNumChars ;
+            }
+            const size_t numVertices = 6 * numGlyphs ;  // Direct3D 11 has no quadrilaterals, so each glyph takes 2 triangles.
+
+            if( mIsSupported && ReserveVertices( numVertices ) )
+            {
+                ID3D11DeviceContext * context = renderStateCache.GetContext() ;
+                D3D11_MAPPED_SUBRESOURCE mappedVertices ;
+                HROK( context->Map( mVertexBuffer , 0 , D3D11_MAP_WRITE_DISCARD , 0 , & mappedVertices ) ) ;
+                // Screen-space glyphs go first, then world-space glyphs, so each draws with one call.
+                Vertex *        vertices        = static_cast< Vertex * >( mappedVertices.pData ) ;
+                const size_t    numScreenVerts  = FillQuads( vertices                  , true  ) ;
+                const size_t    numWorldVerts   = FillQuads( vertices + numScreenVerts , false ) ;
+                context->Unmap( mVertexBuffer , 0 ) ;
+
+                DrawQuads( renderStateCache , numScreenVerts , numWorldVerts , false ) ;
+                DrawQuads( renderStateCache , 0 , numScreenVerts , true ) ;
+            }
+
+            mStrings.Clear() ;
+            mCharacters.Clear() ;
+        }
+
+
+
+
+        /** Create atlas texture, and draw glyphs of every printable character into it.
+
+            \return Whether this could create the atlas.
+        */
+        bool D3D11_TextBatch::BuildAtlas()
+        {
+            PERF_BLOCK( D3D11_TextBatch__BuildAtlas ) ;
+
+            ASSERT( NULLPTR == mAtlasView ) ;
+
+            HDC deviceContext = CreateCompatibleDC( NULL ) ;
+            if( NULL == deviceContext )
+            {
+                return false ;
+            }
+
+            BITMAPINFO bitmapInfo ;
+            ZeroMemory( & bitmapInfo , sizeof( bitmapInfo ) ) ;
+            bitmapInfo.bmiHeader.biSize         = sizeof( bitmapInfo.bmiHeader ) ;
+            bitmapInfo.bmiHeader.biWidth        =   ATLAS_WIDTH  ;
+            bitmapInfo.bmiHeader.biHeight       = - ATLAS_HEIGHT ;  // Negative height makes rows go top-down, as in Direct3D textures.
+            bitmapInfo.bmiHeader.biPlanes       = 1 ;
+            bitmapInfo.bmiHeader.biBitCount     = 32 ;
+            bitmapInfo.bmiHeader.biCompression  = BI_RGB ;
+            void *  bitmapTexels    = NULLPTR ;
+            HBITMAP bitmap          = CreateDIBSection( deviceContext , & bitmapInfo , DIB_RGB_COLORS , & bitmapTexels , NULL , 0 ) ;
+            HFONT   font            = CreateFontA( - sFontHeight , 0 , 0 , 0 , FW_NORMAL , FALSE , FALSE , FALSE , ANSI_CHARSET , OUT_DEFAULT_PRECIS , CLIP_DEFAULT_PRECIS
+                                                 , NONANTIALIASED_QUALITY , DEFAULT_PITCH | FF_SWISS , "Arial" ) ;
+            bool    succeeded       = ( bitmap != NULL ) && ( font != NULL ) ;
+
+            if( succeeded )
+            {   // Draw each glyph, white on black, at the pen position of its cell.
+                HGDIOBJ previousBitmap  = SelectObject( deviceContext , bitmap ) ;
+                HGDIOBJ previousFont    = SelectObject( deviceContext , font ) ;
+                memset( bitmapTexels , 0 , ATLAS_WIDTH * ATLAS_HEIGHT * 4 ) ;
+                SetTextColor( deviceContext , RGB( 255 , 255 , 255 ) ) ;
+                SetBkMode( deviceContext , TRANSPARENT ) ;
+                SetTextAlign( deviceContext , TA_LEFT | TA_BASELINE ) ;
+                for( int iChar = 0 ; iChar < NUM_CHARACTERS ; ++ iChar )
+                {   // For each printable character...
+                    const char  character   = static_cast< char >( FIRST_CHARACTER + iChar ) ;
+                    const int   cellX       = ( iChar % CELLS_PER_ROW ) * CELL_WIDTH ;
+                    const int   cellY       = ( iChar / CELLS_PER_ROW ) * CELL_HEIGHT ;
+                    TextOutA( deviceContext , cellX + CELL_ORIGIN_X , cellY + CELL_ORIGIN_Y , & character , 1 ) ;
+                    INT advance = 0 ;
+                    GetCharWidth32A( deviceContext , character , character , & advance ) ;
+                    mAdvances[ iChar ] = static_cast< unsigned char >( Min2( advance , 255 ) ) ;
+                }
+                GdiFlush() ;
+                SelectObject( deviceContext , previousFont ) ;
+                SelectObject( deviceContext , previousBitmap ) ;
+
+                // Texels are white, with glyph coverage in alpha, so glyph color comes entirely from vertex color.
+                VECTOR< unsigned char > atlasTexels( ATLAS_WIDTH * ATLAS_HEIGHT * 4 ) ;
+                const unsigned char * glyphTexels = static_cast< const unsigned char * >( bitmapTexels ) ;
+                for( size_t iTexel = 0 ; iTexel < size_t( ATLAS_WIDTH * ATLAS_HEIGHT ) ; ++ iTexel )
+                {
+                    atlasTexels[ iTexel * 4 + 0 ] = 255 ;
+                    atlasTexels[ iTexel * 4 + 1 ] = 255 ;
+                    atlasTexels[ iTexel * 4 + 2 ] = 255 ;
+                    atlasTexels[ iTexel * 4 + 3 ] = glyphTexels[ iTexel * 4 ] ? 255 : 0 ;
+                }
+
+                D3D11_TEXTURE2D_DESC textureDesc ;
+                ZeroMemory( & textureDesc , sizeof( textureDesc ) ) ;
+                textureDesc.Width               = ATLAS_WIDTH ;
+                textureDesc.Height              = ATLAS_HEIGHT ;
+                textureDesc.MipLevels           = 1 ;
+                textureDesc.ArraySize           = 1 ;
+                textureDesc.Format              = DXGI_FORMAT_R8G8B8A8_UNORM ;
+                textureDesc.SampleDesc.Count    = 1 ;
+                textureDesc.Usage               = D3D11_USAGE_IMMUTABLE ;
+                textureDesc.BindFlags           = D3D11_BIND_SHADER_RESOURCE ;
+                D3D11_SUBRESOURCE_DATA initialData ;
+                ZeroMemory( & initialData , sizeof( initialData ) ) ;
+                initialData.pSysMem     = & atlasTexels[ 0 ] ;
+                initialData.SysMemPitch = ATLAS_WIDTH * 4 ;
+                ID3D11Texture2D * texture = NULLPTR ;
+                succeeded = SUCCEEDED( g_d3d11Device->CreateTexture2D( & textureDesc , & initialData , & texture ) )
+                        &&  SUCCEEDED( g_d3d11Device->CreateShaderResourceView( texture , NULL , & mAtlasView ) ) ;
+                if( texture )
+                {   // View holds its own reference.
+                    texture->Release() ;
+                }
+            }
+
+            if( font   ) DeleteObject( font ) ;
+            if( bitmap ) DeleteObject( bitmap ) ;
+            DeleteDC( deviceContext ) ;
+
+            return succeeded ;
+        }
+
+
+
+
+        /** Make sure the vertex buffer holds at least the given number of vertices.
+
+            \return Whether the vertex buffer has room.
+        */
+        bool D3D11_TextBatch::ReserveVertices( size_t numVertices )
+        {
+            if( numVertices <= mVertexCapacity )
+            {   // Vertex buffer is already big enough.
+                return true ;
+            }
+
+            // Grow at least by double, so text whose length varies seldom reallocates.
+            const size_t newCapacity = Max2( numVertices , 2 * mVertexCapacity ) ;
+            if( mVertexBuffer )
+            {
+                mVertexBuffer->Release() ;
+                mVertexBuffer   = NULLPTR ;
+                mVertexCapacity = 0 ;
+            }
+
+            D3D11_BUFFER_DESC bufferDesc ;
+            ZeroMemory( & bufferDesc , sizeof( bufferDesc ) ) ;
+            bufferDesc.ByteWidth        = static_cast< UINT >( newCapacity * sizeof( Vertex ) ) ;
+            bufferDesc.Usage            = D3D11_USAGE_DYNAMIC ;   // Text changes every frame.
+            bufferDesc.BindFlags        = D3D11_BIND_VERTEX_BUFFER ;
+            bufferDesc.CPUAccessFlags   = D3D11_CPU_ACCESS_WRITE ;
+            if( FAILED( g_d3d11Device->CreateBuffer( & bufferDesc , NULL , & mVertexBuffer ) ) )
+            {
+                mVertexBuffer = NULLPTR ;
+                return false ;
+            }
+            mVertexCapacity = newCapacity ;
+            return true ;
+        }
+
+
+
+
+        /** Write triangles for glyphs of queued strings in the given space.
+
+            \param vertices         Address of vertices to write, which must have room for 6 per queued character.
+
+            \param useScreenSpace   Whether to write glyphs of screen-space strings, or of world-space strings.
+
+            \return Number of vertices written.
+
+            Vertex positions are in clip space, so they draw with identity
+            transforms.  Characters the atlas lacks advance the pen like a space.
+        */
+        size_t D3D11_TextBatch::FillQuads( Vertex * vertices , bool useScreenSpace ) const
+        {
+            PERF_BLOCK( D3D11_TextBatch__FillQuads ) ;
+
+            static const float  texelWidth  = 1.0f / float( ATLAS_WIDTH  ) ;
+            static const float  texelHeight = 1.0f / float( ATLAS_HEIGHT ) ;
+
+            size_t numVertices = 0 ;
+            for( size_t iString = 0 ; iString < mStrings.Size() ; ++ iString )
+            {   // For each queued string...
+                const QueuedString & queuedString = mStrings[ iString ] ;
+                if( queuedString.mUseScreenSpace != useScreenSpace )
+                {   // String belongs to the other draw call.
+                    continue ;
+                }
+
+                unsigned char rgba[ 4 ] ;
+                for( unsigned component = 0 ; component < 4 ; ++ component )
+                {
+                    rgba[ component ] = static_cast< unsigned char >( Clamp( queuedString.mColor[ component ] , 0.0f , 1.0f ) * 255.0f + 0.5f ) ;
+                }
+
+                // Glyphs start at whole pixels, so texels map to pixels one to one.
+                const float     pixelToClipX    =   2.0f / queuedString.mViewportWidth  ;
+                const float     pixelToClipY    = - 2.0f / queuedString.mViewportHeight ;
+                float           penX            = floorf( queuedString.mViewportPosition.x ) ;
+                const float     penY            = floorf( queuedString.mViewportPosition.y ) ;
+                const float     depth           = queuedString.mViewportPosition.z ;
+                const float     y0              = ( penY - float( CELL_ORIGIN_Y ) ) * pixelToClipY + 1.0f ;
+                const float     y1              = y0 + float( CELL_HEIGHT ) * pixelToClipY ;
+                for( size_t iChar = 0 ; iChar < queuedString.mNumChars ; ++ iChar )
+                {   // For each character in this string...
+                    const int glyph = static_cast< unsigned char >( mCharacters[ queuedString.mFirstChar + iChar ] ) - FIRST_CHARACTER ;
+                    if( ( glyph <= 0 ) || ( glyph >= NUM_CHARACTERS ) )
+                    {   // Character is a space, which has no quadrilateral, or lies outside atlas.
+                        penX += float( mAdvances[ 0 ] ) ;
+                        continue ;
+                    }
+
+                    const int       cellX   = ( glyph % CELLS_PER_ROW ) * CELL_WIDTH ;
+                    const int       cellY   = ( glyph / CELLS_PER_ROW ) * CELL_HEIGHT ;
+                    const float     s0      = float( cellX ) * texelWidth ;
+                    const float     s1      = float( cellX + CELL_WIDTH ) * texelWidth ;
+                    const float     t0      = float( cellY ) * texelHeight ;
+                    const float     t1      = float( cellY + CELL_HEIGHT ) * texelHeight ;
+                    const float     x0      = ( penX - float( CELL_ORIGIN_X ) ) * pixelToClipX - 1.0f ;
+                    const float     x1      = x0 + float( CELL_WIDTH ) * pixelToClipX ;
+
+                    // Two triangles, both wound like the quadrilateral corners OpenGL_TextBatch writes.
+                    const float corners[ 6 ][ 4 ] = { { x0 , y0 , s0 , t0 } , { x1 , y0 , s1 , t0 } , { x1 , y1 , s1 , t1 }
+                                                    , { x0 , y0 , s0 , t0 } , { x1 , y1 , s1 , t1 } , { x0 , y1 , s0 , t1 } } ;
+                    for( unsigned iCorner = 0 ; iCorner < 6 ; ++ iCorner )
+                    {   // For each corner of this glyph's triangles...
+                        Vertex & vertex = vertices[ numVertices ++ ] ;
+                        vertex.px = corners[ iCorner ][ 0 ] ;
+                        vertex.py = corners[ iCorner ][ 1 ] ;
+                        vertex.pz = depth ;
+                        memcpy( vertex.crgba , rgba , sizeof( rgba ) ) ;
+                        vertex.ts = corners[ iCorner ][ 2 ] ;
+                        vertex.tt = corners[ iCorner ][ 3 ] ;
+                    }
+
+                    penX += float( mAdvances[ glyph ] ) ;
+                }
+            }
+            return numVertices ;
+        }
+
+
+
+
+        /** Draw a range of glyph triangles from the vertex buffer with one call, textured by the atlas.
+
+            \param renderStateCache Render state cache of the context to draw with.
+
+            \param firstVertex      Index of first vertex to draw.
+
+            \param numVertices      Number of vertices to draw.
+
+            \param useScreenSpace   Whether glyphs lie in screen space, so they draw without depth testing.
+        */
+        void D3D11_TextBatch::DrawQuads( D3D11_RenderStateCache & renderStateCache , size_t firstVertex , size_t numVertices , bool useScreenSpace )
+        {
+            PERF_BLOCK( D3D11_TextBatch__DrawQuads ) ;
+
+            if( 0 == numVertices )
+            {   // Nothing to draw.
+                return ;
+            }
+
+            // Alpha testing keeps transparent texels out of depth.  Text never writes depth.
+            RenderStateS renderState ;
+            renderState.mBlendState.SetAlpha() ;
+            renderState.mDepthState.mDepthFunc          = useScreenSpace ? CMP_FUNC_ALWAYS : CMP_FUNC_LESS ;
+            renderState.mDepthState.mDepthWriteEnabled  = false ;
+            renderState.mAlphaState.mAlphaTest          = true ;
+            renderState.mAlphaState.mAlphaFunc          = CMP_FUNC_GREATER_EQUAL ;
+            renderState.mAlphaState.mAlphaRef           = 0.5f ;
+            renderState.mRasterState.mCullMode          = RasterStateS::CULL_MODE_NONE ;
+            renderState.mShadeMode                      = SHADE_MODE_SMOOTH ;
+            renderStateCache.Apply( renderState ) ;
+
+            // Vertices are already in clip space.
+            const Mat44 localToWorld    = renderStateCache.GetLocalToWorld() ;
+            const Mat44 view            = renderStateCache.GetView() ;
+            const Mat44 projection      = renderStateCache.GetProjection() ;
+            renderStateCache.SetLocalToWorld( Mat4_xIdentity ) ;
+            renderStateCache.SetViewAndProjection( Mat4_xIdentity , Mat4_xIdentity ) ;
+
+            SamplerState samplerState ;
+            samplerState.mMinFilter = SamplerState::FILTER_NEAREST ;
+            samplerState.mMagFilter = SamplerState::FILTER_NEAREST ;
+            samplerState.mMipFilter = SamplerState::FILTER_NO_MIPMAP ;
+            renderStateCache.BindTexture( mAtlasView , samplerState ) ;
+
+            renderStateCache.PrepareToDraw( VertexDeclaration( VertexDeclaration::POSITION_COLOR_TEXTURE ) ) ;
+
+            ID3D11DeviceContext *   context         = renderStateCache.GetContext() ;
+            const UINT              vertexSize      = sizeof( Vertex ) ;
+            const UINT              vertexOffset    = 0 ;
+            context->IASetVertexBuffers( 0 , 1 , & mVertexBuffer , & vertexSize , & vertexOffset ) ;
+            context->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ) ;
+            context->Draw( static_cast< UINT >( numVertices ) , static_cast< UINT >( firstVertex ) ) ;
+
+            renderStateCache.DisableTexturing() ;
+            renderStateCache.SetLocalToWorld( localToWorld ) ;
+            renderStateCache.SetViewAndProjection( view , projection ) ;
+        }
+
+
+
+
+    } ;
+} ;
@@ -0,0 +1,105 @@
+/** \file D3D11_textBatch.h
+
+    \brief Batch of bitmap-font text drawn as textured quadrilaterals from a font atlas, with one draw call.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_TEXT_BATCH_H
+#define PEGASYS_RENDER_D3D11_TEXT_BATCH_H
+
+#include <d3d11.h>
+
+#include "Render/Platform/DirectX11/D3D11_vertexBuffer.h"
+
+#include "Core/Containers/vector.h"
+#include "Core/Math/vec4.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        class D3D11_RenderStateCache ;
+
+        /** Batch of bitmap-font text drawn as textured quadrilaterals from a font atlas, with one draw call.
+
+            Like OpenGL_TextBatch: AddText queues text, and Flush builds a
+            quadrilateral per glyph into one dynamic vertex buffer, then draws
+            screen-space text with one call and world-space text with another.
+            Glyphs come from an atlas texture that Flush builds, the first
+            time, by drawing each printable character with GDI, without
+            anti-aliasing.  Quadrilaterals align with pixels and the atlas
+            uses nearest filtering, so glyphs look as GDI draws them.
+
+            AddText projects world-space positions using the transforms and
+            viewport current when it runs, so text need not be flushed before
+            those change.  World-space text depth tests against the scene;
+            screen-space text appears in front of everything.
+
+            Call methods only on the thread that owns the API, since Flush
+            draws with the immediate context.
+        */
+        class D3D11_TextBatch
+        {
+            public:
+                D3D11_TextBatch() ;
+                ~D3D11_TextBatch() ;
+
+                void    AddText( const Vec3 & position , bool useScreenSpace , const Vec4 & color , const char * text , const D3D11_VIEWPORT & viewport , const D3D11_RenderStateCache & renderStateCache ) ;
+                void    Flush( D3D11_RenderStateCache & renderStateCache ) ;
+                void    Release() ;
+
+                /// Return whether this has text that Flush has not yet drawn.
+                bool    IsEmpty() const { return mStrings.Empty() ; }
+
+            private:
+                typedef D3D11_VertexBuffer::VertexFormatPositionColorTexture Vertex ;
+
+                static const int    FIRST_CHARACTER = 32    ;   ///< First character the atlas holds (space).
+                static const int    NUM_CHARACTERS  = 95    ;   ///< Number of consecutive characters the atlas holds, through '~'.
+                static const int    CELL_WIDTH      = 16    ;   ///< Width, in texels, of atlas cell holding one glyph.
+                static const int    CELL_HEIGHT     = 20    ;   ///< Height, in texels, of atlas cell holding one glyph.
+                static const int    CELL_ORIGIN_X   = 2     ;   ///< Texels between left side of cell and pen position of its glyph.
+                static const int    CELL_ORIGIN_Y   = 15    ;   ///< Texels between top of cell and baseline of its glyph, which leaves room for descenders below.
+                static const int    CELLS_PER_ROW   = 16    ;   ///< Number of atlas cells along each row.
+                static const int    ATLAS_WIDTH     = CELLS_PER_ROW * CELL_WIDTH ;  ///< Width, in texels, of atlas.
+                static const int    ATLAS_HEIGHT    = ( ( NUM_CHARACTERS + CELLS_PER_ROW - 1 ) / CELLS_PER_ROW ) * CELL_HEIGHT ; ///< Height, in texels, of atlas.
+
+                /// Text that AddText queued, with its position in viewport coordinates.
+                struct QueuedString
+                {
+                    Vec3            mViewportPosition   ;   ///< Viewport x and y, in pixels, from upper left, and depth, of pen position for first glyph.
+                    float           mViewportWidth      ;   ///< Width, in pixels, of viewport current when AddText queued this.
+                    float           mViewportHeight     ;   ///< Height, in pixels, of viewport current when AddText queued this.
+                    Vec4            mColor              ;   ///< Color of text.
+                    size_t          mFirstChar          ;   ///< Offset into mCharacters of first character of text.
+                    size_t          mNumChars           ;   ///< Number of characters of text.
+                    bool            mUseScreenSpace     ;   ///< Whether text lies in screen space, i.e. appears in front of everything.
+                } ;
+
+                D3D11_TextBatch( const D3D11_TextBatch & ) ;              // Disallow copy
+                D3D11_TextBatch & operator=( const D3D11_TextBatch & ) ;  // Disallow assignment
+
+                bool    BuildAtlas() ;
+                bool    ReserveVertices( size_t numVertices ) ;
+                size_t  FillQuads( Vertex * vertices , bool useScreenSpace ) const ;
+                void    DrawQuads( D3D11_RenderStateCache & renderStateCache , size_t firstVertex , size_t numVertices , bool useScreenSpace ) ;
+
+                ID3D11Buffer *              mVertexBuffer       ;   ///< Dynamic vertex buffer that holds quadrilaterals of glyphs from the most recent Flush.
+                size_t                      mVertexCapacity     ;   ///< Number of vertices mVertexBuffer can hold.
+                VECTOR< QueuedString >      mStrings            ;   ///< Text queued since the most recent Flush.
+                VECTOR< char >              mCharacters         ;   ///< Characters of every queued string, consecutively.
+                ID3D11ShaderResourceView *  mAtlasView          ;   ///< View of texture holding glyphs, white with coverage in alpha.
+                unsigned char               mAdvances[ NUM_CHARACTERS ] ; ///< Distance, in pixels, the pen moves after each glyph.
+                int                         mIsSupported        ;   ///< Whether this could build the atlas: 1 for yes, 0 for no, -1 for not yet attempted.
+        } ;
+
+        // Public variables ------------------------------------------------------------
+        // Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -0,0 +1,239 @@
+/** \file D3D11_texture.cpp
+
+    \brief Texture for Direct3D version 11
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/debugPrint.h"
+
+#include <d3d11.h>
+
+#include "Image/image.h"
+
+#include "Render/Resource/textureSampler.h"
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+
+#include "Render/Platform/DirectX11/D3D11_texture.h"
+
+extern ID3D11Device *           g_d3d11Device           ; // Direct3D rendering device
+extern ID3D11DeviceContext *    g_d3d11ImmediateContext ; // Direct3D immediate device context
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+/** Construct texture for Direct3D version 11.
+*/
+D3D11_Texture::D3D11_Texture()
+    : TextureBase()
+    , mTexture( NULLPTR )
+    , mShaderResourceView( NULLPTR )
+{
+}
+
+
+
+
+/** Destruct texture for Direct3D version 11.
+*/
+D3D11_Texture::~D3D11_Texture()
+{
+    if( mShaderResourceView )
+    {
+        mShaderResourceView->Release() ;
+    }
+    if( mTexture )
+    {
+        mTexture->Release() ;
+    }
+}
+
+
+
+
+/* virtual */ void D3D11_Texture::Bind( ApiBase * /*renderApi*/ , const SamplerStateS & samplerState )
+{
+    D3D11_RenderStateCache::GetCurrent().BindTexture( mShaderResourceView , samplerState ) ;
+}
+
+
+
+
+void D3D11_Texture::Create2DTextureFromImage( const Image * image )
+{
+    ASSERT( image != NULL ) ;
+
+    // Make sure image is sane.
+    ASSERT( image->GetWidth() > 0 ) ;
+    ASSERT( image->GetHeight() > 0 ) ;
+    ASSERT( image->GetNumChannels() > 0 ) ;
+    ASSERT( image->GetNumPages() > 0 ) ;
+    ASSERT( image->GetImageData() != 0 ) ;
+
+    ASSERT( image->GetNumChannels() == 4 ) ; // For now, only support RGBA images
+    ASSERT( image->GetNumPages() == 1 ) ; // For now, only support single-page images
+
+    ASSERT( ( GetWidth() == static_cast< int >( image->GetWidth() ) ) || ( GetWidth() == 0 ) ) ;
+    ASSERT( ( GetHeight() == static_cast< int >( image->GetHeight() ) ) || ( GetHeight() == 0 ) ) ;
+    ASSERT( ( GetNumPlanes() == 1 ) || ( GetNumPlanes() == 0 ) ) ;
+    ASSERT( ( GetShape() == TEX_SHAPE_2D ) || ( GetShape() == TEX_SHAPE_UNDEFINED ) ) ;
+
+    ASSERT( ( GetFormat() == TEX_FORMAT_A8R8G8B8 ) || ( GetFormat() == TEX_FORMAT_UNDEFINED ) ) ; // For now, only support RGBA textures
+    ASSERT( GetUsageFlags() == TEX_USAGE_DEFAULT ) ; // For now, only support default usage.
+
+    // Make sure this material does not already have a texture,
+    // otherwise the existing texture will "leak" video memory.
+    ASSERT( 0 == mTexture ) ;
+
+    // Gather texels into rows, in RGBA order, as DXGI_FORMAT_R8G8B8A8_UNORM expects.
+    const unsigned  width       = image->GetWidth() ;
+    const unsigned  height      = image->GetHeight() ;
+    const unsigned  rowPitch    = width * 4 ;
+    unsigned char * texels      = NEW unsigned char[ rowPitch * height ] ;
+    for( unsigned iy = 0 ; iy < height ; ++ iy )
+    {   // For each row in the image...
+        unsigned char * pData = texels + rowPitch * iy ;
+        for( unsigned ix = 0 ; ix < width ; ++ ix )
+        {   // For each column in the image...
+            unsigned offset = ix * image->GetXStride() + image->GetYStride() * iy ;
+            // Assign color components for current texel from corresponding image pixel.
+            pData[ ix * 4 + 0 ] = (*image)[ offset + 0 ] ;
+            pData[ ix * 4 + 1 ] = (*image)[ offset + 1 ] ;
+            pData[ ix * 4 + 2 ] = (*image)[ offset + 2 ] ;
+            pData[ ix * 4 + 3 ] = (*image)[ offset + 3 ] ;
+        }
+    }
+
+    D3D11_TEXTURE2D_DESC textureDesc ;
+    ZeroMemory( & textureDesc , sizeof( textureDesc ) ) ;
+    textureDesc.Width               = width ;
+    textureDesc.Height              = height ;
+    textureDesc.MipLevels           = 1 ;
+    textureDesc.ArraySize           = 1 ;
+    textureDesc.Format              = DXGI_FORMAT_R8G8B8A8_UNORM ;
+    textureDesc.SampleDesc.Count    = 1 ;
+    textureDesc.Usage               = D3D11_USAGE_DEFAULT ;
+    textureDesc.BindFlags           = D3D11_BIND_SHADER_RESOURCE ;
+
+    D3D11_SUBRESOURCE_DATA initialData ;
+    ZeroMemory( & initialData , sizeof( initialData ) ) ;
+    initialData.pSysMem     = texels ;
+    initialData.SysMemPitch = rowPitch ;
+
+    HROK( g_d3d11Device->CreateTexture2D( & textureDesc , & initialData , & mTexture ) ) ;
+    HROK( g_d3d11Device->CreateShaderResourceView( mTexture , NULL , & mShaderResourceView ) ) ;
+
+    delete [] texels ;
+
+    SetNumMipLevels( textureDesc.MipLevels ) ;
+}
+
+
+
+
+
+/* virtual */ void D3D11_Texture::CreateFromImages( const Image * images , size_t numImages )
+{
+    if( 1 == numImages )
+    {   // Source is a single image.
+        // A single image can only be used to make 1D or 2D textures.
+        if( ( GetShape() == TEX_SHAPE_2D ) || ( GetShape() == TEX_SHAPE_UNDEFINED ) )
+        {   // Texture shape is either explicitly 2D or not yet defined.
+            Create2DTextureFromImage( images ) ;
+        }
+        else
+        {   // Texture shape is explicitly defined as something either incompatable or not yet implemented.
+            FAIL() ;
+        }
+    }
+    else
+    {   // Multiple source images.
+        FAIL() ; // Not yet supported.
+    }
+}
+
+
+
+
+/** Copy the top MIP level of this texture into the given image.
+
+    \param image    (out) Image to populate.  If it has no data, this sizes it to
+                    match this texture; otherwise its shape must already match.
+
+    This texture lives in GPU memory, so this copies it into a staging
+    texture, on the immediate context, and reads that.
+*/
+/* virtual */ void D3D11_Texture::CopyToImage( Image & image )
+{
+    ASSERT( mTexture != NULLPTR ) ;
+
+    D3D11_TEXTURE2D_DESC textureDesc ;
+    mTexture->GetDesc( & textureDesc ) ;
+    ASSERT( DXGI_FORMAT_R8G8B8A8_UNORM == textureDesc.Format ) ; // For now, only support RGBA textures
+
+    if( NULLPTR == image.GetImageData() )
+    {   // Image has no data yet, so give it the shape of this texture.
+        image.SetSize( textureDesc.Width , textureDesc.Height , 4 , 1 ) ;
+    }
+    ASSERT( image.GetWidth()  == textureDesc.Width ) ;
+    ASSERT( image.GetHeight() == textureDesc.Height ) ;
+    ASSERT( image.GetNumChannels() == 4 ) ; // For now, only support RGBA images
+
+    D3D11_TEXTURE2D_DESC stagingDesc = textureDesc ;
+    stagingDesc.MipLevels       = 1 ;
+    stagingDesc.Usage           = D3D11_USAGE_STAGING ;
+    stagingDesc.BindFlags       = 0 ;
+    stagingDesc.CPUAccessFlags  = D3D11_CPU_ACCESS_READ ;
+    stagingDesc.MiscFlags       = 0 ;
+    ID3D11Texture2D * stagingTexture = NULLPTR ;
+    HROK( g_d3d11Device->CreateTexture2D( & stagingDesc , NULL , & stagingTexture ) ) ;
+    g_d3d11ImmediateContext->CopySubresourceRegion( stagingTexture , 0 , 0 , 0 , 0 , mTexture , 0 , NULL ) ;
+
+    D3D11_MAPPED_SUBRESOURCE mappedTexels ;
+    HROK( g_d3d11ImmediateContext->Map( stagingTexture , 0 , D3D11_MAP_READ , 0 , & mappedTexels ) ) ;
+    for( unsigned iy = 0 ; iy < image.GetHeight() ; ++ iy )
+    {   // For each row in the image...
+        const BYTE * pData = static_cast< const BYTE * >( mappedTexels.pData ) + mappedTexels.RowPitch * iy ;
+        for( unsigned ix = 0 ; ix < image.GetWidth() ; ++ ix )
+        {   // For each column in the image...
+            unsigned offset = ix * image.GetXStride() + image.GetYStride() * iy ;
+            // Assign color components for current pixel from corresponding texel, which is in RGBA order.
+            image[ offset + 0 ] = pData[ ix * 4 + 0 ] ;
+            image[ offset + 1 ] = pData[ ix * 4 + 1 ] ;
+            image[ offset + 2 ] = pData[ ix * 4 + 2 ] ;
+            image[ offset + 3 ] = pData[ ix * 4 + 3 ] ;
+        }
+    }
+    g_d3d11ImmediateContext->Unmap( stagingTexture , 0 ) ;
+    stagingTexture->Release() ;
+}
+
+
+
+
+    } ;
+} ;
+
+
+#if defined( _DEBUG )
+
+void PeGaSys_Render_D3D11_Texture_UnitTest()
+{
+    DebugPrintf( "D3D11_Texture::UnitTest ----------------------------------------------\n" ) ;
+
+    {
+        PeGaSys::Render::D3D11_Texture d3d11_texture ;
+    }
+
+    DebugPrintf( "D3D11_Texture::UnitTest: THE END ----------------------------------------------\n" ) ;
+}
+#endif
@@ -0,0 +1,50 @@
+/** \file D3D11_texture.h
+
+    \brief Texture for Direct3D version 11
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_TEXTURE_H
+#define PEGASYS_RENDER_D3D11_TEXTURE_H
+
+#include "Render/Resource/texture.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+struct ID3D11Texture2D ;
+struct ID3D11ShaderResourceView ;
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Texture for Direct3D version 11.
+
+            Bind binds to the context of the calling thread's command recorder,
+            if it records, else to the immediate context.
+        */
+        class D3D11_Texture : public TextureBase
+        {
+            public:
+                D3D11_Texture() ;
+                virtual ~D3D11_Texture() ;
+
+                virtual void Bind( ApiBase * renderApi , const SamplerStateS & samplerState ) ;
+                virtual void CreateFromImages( const Image * images , size_t numImages ) ;
+                virtual void CopyToImage( Image & image ) ;
+
+            private:
+                void Create2DTextureFromImage( const Image * image ) ;
+
+                ID3D11Texture2D *           mTexture            ;   ///< Texture object
+                ID3D11ShaderResourceView *  mShaderResourceView ;   ///< View through which shaders sample mTexture.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -0,0 +1,524 @@
+/** \file D3D11_VertexBuffer.cpp
+
+    \brief Vertex buffer for Direct3D version 11
+
+    \author Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/debugPrint.h"
+
+#include <float.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+
+#include "Render/Platform/DirectX11/D3D11_VertexBuffer.h"
+
+extern ID3D11Device *           g_d3d11Device           ; // Direct3D rendering device
+extern ID3D11DeviceContext *    g_d3d11ImmediateContext ; // Direct3D immediate device context
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+/** Construct vertex buffer for Direct3D version 11.
+*/
+D3D11_VertexBuffer::D3D11_VertexBuffer()
+    : VertexBufferBase()
+    , mInternalVertexBuffer( NULLPTR )
+    , mShadowVertexData( NULLPTR )
+    , mOffsetPx( 0 )
+    , mOffsetTu( 0 )
+    , mOffsetCr( 0 )
+    , mOffsetNx( 0 )
+{
+    mTypeId = sTypeId ;
+}
+
+
+
+
+/** Destruct vertex buffer for Direct3D version 11.
+*/
+D3D11_VertexBuffer::~D3D11_VertexBuffer()
+{
+    Deallocate() ;
+}
+
+
+
+
+/** Swap all members between that and this.
+*/
+void D3D11_VertexBuffer::Swap( D3D11_VertexBuffer & that )
+{
+    D3D11_VertexBuffer temp ;
+    memcpy( & temp ,   this , sizeof( that ) ) ;
+    memcpy(   this , & that , sizeof( that ) ) ;
+    memcpy( & that , & temp , sizeof( that ) ) ;
+}
+
+
+
+
+/** Get address of vertex data that this buffer object manages, for the CPU to write.
+
+    For streaming buffers, this discards previous contents, so callers must write every vertex they render.
+*/
+void * D3D11_VertexBuffer::LockVertexData()
+{
+    if( mShadowVertexData )
+    {   // Static buffer; caller writes into CPU-side copy.
+        return mShadowVertexData ;
+    }
+    if( mInternalVertexBuffer )
+    {   // Streaming buffer; caller writes into a fresh region the driver provides.
+        D3D11_MAPPED_SUBRESOURCE mappedVertices ;
+        HROK( g_d3d11ImmediateContext->Map( mInternalVertexBuffer , 0 , D3D11_MAP_WRITE_DISCARD , 0 , & mappedVertices ) ) ;
+        return mappedVertices.pData ;
+    }
+    return NULLPTR ;
+}
+
+
+
+
+/** Release CPU's hold on vertex data to allow GPU to access it.
+*/
+void D3D11_VertexBuffer::UnlockVertexData()
+{
+    ASSERT( mInternalVertexBuffer ) ;
+    if( mShadowVertexData )
+    {   // Static buffer; upload CPU-side copy.
+        g_d3d11ImmediateContext->UpdateSubresource( mInternalVertexBuffer , 0 , NULL , mShadowVertexData , 0 , 0 ) ;
+    }
+    else
+    {
+        g_d3d11ImmediateContext->Unmap( mInternalVertexBuffer , 0 ) ;
+    }
+}
+
+
+
+
+/** Get address of vertex element with the given semantic.
+*/
+void * D3D11_VertexBuffer::GetElementStart( void * vertexData , PeGaSys::Render::VertexDeclaration::VertexElement::SemanticE semantic , size_t which )
+{
+    unsigned char * vertexDataBytes = static_cast< unsigned char * >( vertexData ) ;
+    ASSERT( 0 == which ) ; // Multiple elements with the same semantic not yet supported.
+    NON_DEBUG_ONLY( UNUSED_PARAM( which ) ) ;
+
+    switch( semantic )
+    {
+    case VertexDeclaration::VertexElement::POSITION     : return vertexDataBytes + mOffsetPx ; break ;
+    case VertexDeclaration::VertexElement::NORMAL       : ASSERT( GetVertexDeclaration().HasNormals() ) ;            return vertexDataBytes + mOffsetNx ; break ;
+    case VertexDeclaration::VertexElement::COLOR_AMBIENT: ASSERT( GetVertexDeclaration().HasColors() ) ;             return vertexDataBytes + mOffsetCr ; break ;
+    case VertexDeclaration::VertexElement::TEXTURE_0    : ASSERT( GetVertexDeclaration().HasTextureCoordinates() ) ; return vertexDataBytes + mOffsetTu ; break ;
+    }
+    FAIL() ; // Unsupported semantic.
+    return NULLPTR ;
+}
+
+
+
+
+/** Allocate memory for vertex buffer.
+
+    \return true if succeeded, false otherwise
+*/
+bool D3D11_VertexBuffer::Allocate( size_t numVertices )
+{
+    ASSERT( NULLPTR == GetGenericVertexData() ) ;   // Not allowed to allocate over a generic vertex buffer.
+    ASSERT( NULLPTR == mInternalVertexBuffer ) ;    // Not allowed to allocate over existing D3D vertex buffer.
+    ASSERT( numVertices != 0 ) ;
+    ASSERT( GetPopulation() == 0 ) ;
+    ASSERT( GetVertexSizeInBytes() != 0 ) ;
+
+    const bool  streams     = ( USAGE_STREAM == GetUsage() ) ;
+    const UINT  numBytes    = static_cast< UINT >( GetVertexSizeInBytes() * numVertices ) ;
+
+    D3D11_BUFFER_DESC bufferDesc ;
+    ZeroMemory( & bufferDesc , sizeof( bufferDesc ) ) ;
+    bufferDesc.ByteWidth        = numBytes ;
+    bufferDesc.Usage            = streams ? D3D11_USAGE_DYNAMIC    : D3D11_USAGE_DEFAULT ;
+    bufferDesc.CPUAccessFlags   = streams ? D3D11_CPU_ACCESS_WRITE : 0 ;
+    bufferDesc.BindFlags        = D3D11_BIND_VERTEX_BUFFER ;
+
+    if( SUCCEEDED( g_d3d11Device->CreateBuffer( & bufferDesc , NULL , & mInternalVertexBuffer ) ) )
+    {   // Allocation succeeded.
+        if( ! streams )
+        {
+            mShadowVertexData = NEW unsigned char[ numBytes ] ;
+        }
+        SetCapacity( numVertices ) ;
+        return true ; // Inform caller allocation succeeded.
+    }
+    FAIL() ;
+    return false ; // Inform caller allocation failed.
+}
+
+
+
+
+/** Deallocate vertex buffer allocated by Allocate.
+*/
+void D3D11_VertexBuffer::Deallocate()
+{
+    if( mInternalVertexBuffer )
+    {   // This object allocated vertex data via a vertex buffer which it also allocated.
+        ASSERT( NULLPTR == GetGenericVertexData() ) ; // VB can't have both D3D and generic data.
+
+        mInternalVertexBuffer->Release() ;
+        mInternalVertexBuffer = NULLPTR ;
+    }
+
+    delete [] mShadowVertexData ;
+    mShadowVertexData = NULLPTR ;
+
+    SetPopulation( 0 ) ;
+    SetCapacity( 0 ) ;
+}
+
+
+
+
+/** Set vertex buffer format.
+*/
+void D3D11_VertexBuffer::DeclareVertexFormat( const VertexDeclaration & vertexDeclaration )
+{
+    ASSERT( GetVertexDeclaration().mVertexFormat == VertexDeclaration::VERTEX_FORMAT_NONE ) ;
+    ASSERT( GetVertexSizeInBytes() == 0 ) ;
+
+    // Establish format of vertex buffer, based on vertex declaration.
+    const VertexDeclaration::VertexFormatE & tgtVertFmt = vertexDeclaration.mVertexFormat ;
+    size_t vertexSize = 0 ;
+    mOffsetPx = 0 ; // All formats start with position.
+    switch( tgtVertFmt )
+    {
+        case VertexDeclaration::VERTEX_FORMAT_NONE:
+            FAIL() ;
+        break ;
+
+        case VertexDeclaration::POSITION:
+            vertexSize = sizeof( VertexFormatPosition ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_NORMAL:
+            vertexSize = sizeof( VertexFormatPositionNormal ) ;
+            mOffsetNx  = offsetof( VertexFormatPositionNormal , nx ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_COLOR:
+            vertexSize = sizeof( VertexFormatPositionColor ) ;
+            mOffsetCr  = offsetof( VertexFormatPositionColor , crgba ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_TEXTURE:
+            vertexSize = sizeof( VertexFormatPositionTexture ) ;
+            mOffsetTu  = offsetof( VertexFormatPositionTexture , ts ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_NORMAL_COLOR:
+            vertexSize = sizeof( VertexFormatPositionNormalColor ) ;
+            mOffsetNx  = offsetof( VertexFormatPositionNormalColor , nx ) ;
+            mOffsetCr  = offsetof( VertexFormatPositionNormalColor , crgba ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_NORMAL_TEXTURE:
+            vertexSize = sizeof( VertexFormatPositionNormalTexture ) ;
+            mOffsetNx  = offsetof( VertexFormatPositionNormalTexture , nx ) ;
+            mOffsetTu  = offsetof( VertexFormatPositionNormalTexture , ts ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_COLOR_TEXTURE:
+            vertexSize = sizeof( VertexFormatPositionColorTexture ) ;
+            mOffsetCr  = offsetof( VertexFormatPositionColorTexture , crgba ) ;
+            mOffsetTu  = offsetof( VertexFormatPositionColorTexture , ts ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_NORMAL_COLOR_TEXTURE  :
+            vertexSize = sizeof( VertexFormatPositionNormalColorTexture ) ;
+            mOffsetNx  = offsetof( VertexFormatPositionNormalColorTexture , nx ) ;
+            mOffsetCr  = offsetof( VertexFormatPositionNormalColorTexture , crgba ) ;
+            mOffsetTu  = offsetof( VertexFormatPositionNormalColorTexture , ts ) ;
+        break ;
+
+        case VertexDeclaration::BILLBOARD_INSTANCE: // Unusual: each element is an instance, not a vertex.
+            vertexSize = sizeof( VertexFormatBillboardInstance ) ;
+            mOffsetCr  = offsetof( VertexFormatBillboardInstance , crgba ) ;
+            mOffsetTu  = offsetof( VertexFormatBillboardInstance , tv0 ) ;
+        break ;
+
+        case VertexDeclaration::POSITION_NORMAL_PACKED:
+            vertexSize = sizeof( VertexFormatPositionNormalPacked ) ;
+            mOffsetNx  = offsetof( VertexFormatPositionNormalPacked , normal ) ;
+        break ;
+
+        case VertexDeclaration::GENERIC  :
+            vertexSize = sizeof( GenericVertex ) ;
+        break ;
+
+        case VertexDeclaration::NUM_FORMATS:
+            FAIL() ;
+        break ;
+
+        default:
+            FAIL() ;
+        break ;
+    }
+
+    SetVertexSize( vertexSize ) ;
+    SetVertexDeclaration( vertexDeclaration ) ;
+}
+
+
+
+
+/** Format and allocate vertex buffer.
+
+    \return true if succeeded, false otherwise
+*/
+bool D3D11_VertexBuffer::CreateVertexBuffer( const VertexDeclaration & vertexDeclaration , size_t numVertices )
+{
+    DeclareVertexFormat( vertexDeclaration ) ;
+    return Allocate( numVertices ) ;
+}
+
+
+
+
+/** Describe, to Direct3D, layout of vertices with the given format.
+
+    \param inputElements    Array into which to write element descriptions.
+
+    \return Number of elements written, or 0 if the format has no Direct3D 11 layout.
+
+    BILLBOARD_INSTANCE elements are per-instance data, which the vertex shader
+    expands into 4 vertices using SV_VertexID, so its layout has no per-vertex data.
+*/
+/* static */ UINT D3D11_VertexBuffer::GetInputElements( VertexDeclaration::VertexFormatE vertexFormat , D3D11_INPUT_ELEMENT_DESC inputElements[ sMaxInputElements ] )
+{
+    static const D3D11_INPUT_ELEMENT_DESC position = { "POSITION" , 0 , DXGI_FORMAT_R32G32B32_FLOAT , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA , 0 } ;
+    static const D3D11_INPUT_ELEMENT_DESC normal   = { "NORMAL"   , 0 , DXGI_FORMAT_R32G32B32_FLOAT , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA , 0 } ;
+    static const D3D11_INPUT_ELEMENT_DESC color    = { "COLOR"    , 0 , DXGI_FORMAT_R8G8B8A8_UNORM  , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA , 0 } ;
+    static const D3D11_INPUT_ELEMENT_DESC texCoord = { "TEXCOORD" , 0 , DXGI_FORMAT_R32G32_FLOAT    , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA , 0 } ;
+
+    static const D3D11_INPUT_ELEMENT_DESC billboardInstance[] =
+    {   // Same order as VertexFormatBillboardInstance.
+        { "POSITION"    , 0 , DXGI_FORMAT_R32G32B32_FLOAT   , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_INSTANCE_DATA , 1 } ,
+        { "SIZE_ANGLE"  , 0 , DXGI_FORMAT_R16G16_FLOAT      , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_INSTANCE_DATA , 1 } ,
+        { "COLOR"       , 0 , DXGI_FORMAT_R8G8B8A8_UNORM    , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_INSTANCE_DATA , 1 } ,
+        { "TEXCOORD"    , 0 , DXGI_FORMAT_R16G16_UNORM      , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_INSTANCE_DATA , 1 } ,
+    } ;
+    static const D3D11_INPUT_ELEMENT_DESC positionNormalPacked[] =
+    {   // Same order as VertexFormatPositionNormalPacked.  Direct3D 11 has no signed normalized 10:10:10:2 format, so the shader sign-extends normal components.
+        { "POSITION"    , 0 , DXGI_FORMAT_R16G16B16A16_SINT , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA , 0 } ,
+        { "NORMAL"      , 0 , DXGI_FORMAT_R10G10B10A2_UNORM , 0 , D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA , 0 } ,
+    } ;
+
+    if( VertexDeclaration::BILLBOARD_INSTANCE == vertexFormat )
+    {
+        memcpy( inputElements , billboardInstance , sizeof( billboardInstance ) ) ;
+        return sizeof( billboardInstance ) / sizeof( billboardInstance[ 0 ] ) ;
+    }
+    if( VertexDeclaration::POSITION_NORMAL_PACKED == vertexFormat )
+    {
+        memcpy( inputElements , positionNormalPacked , sizeof( positionNormalPacked ) ) ;
+        return sizeof( positionNormalPacked ) / sizeof( positionNormalPacked[ 0 ] ) ;
+    }
+
+    if(     ( vertexFormat < VertexDeclaration::POSITION )
+        ||  ( vertexFormat > VertexDeclaration::POSITION_NORMAL_COLOR_TEXTURE ) )
+    {   // Format is not one of the position-based formats this class supports.
+        return 0 ;
+    }
+
+    // Elements appear in the same order as in VertexFormat* structures: position, normal, color, texture coordinates.
+    const VertexDeclaration vertexDeclaration( vertexFormat ) ;
+    UINT numInputElements = 0 ;
+    inputElements[ numInputElements ++ ] = position ;
+    if( vertexDeclaration.HasNormals() )
+    {
+        inputElements[ numInputElements ++ ] = normal ;
+    }
+    if( vertexDeclaration.HasColors() )
+    {
+        inputElements[ numInputElements ++ ] = color ;
+    }
+    if( vertexDeclaration.HasTextureCoordinates() )
+    {
+        inputElements[ numInputElements ++ ] = texCoord ;
+    }
+    ASSERT( numInputElements <= sMaxInputElements ) ;
+    return numInputElements ;
+}
+
+
+
+
+static inline unsigned char ColorByteFromFloat( float fColor0to1 )
+{
+    static const float almost256 = 256.0f * ( 1.0f - FLT_EPSILON ) ;
+    unsigned int iColor0to255 = static_cast< unsigned int >( fColor0to1 * almost256 ) ;
+    ASSERT( ( iColor0to255 >= 0 ) && ( iColor0to255 <= 255 ) ) ;
+    return static_cast< unsigned char >( iColor0to255 ) ;
+}
+
+
+
+
+/** Copy vertices from that (which must be generic) to this.
+*/
+void    D3D11_VertexBuffer::CopyVerticesFromGenericToPlatformSpecific( const D3D11_VertexBuffer & genericVertexBuffer )
+{
+    ASSERT( NULLPTR == GetGenericVertexData() ) ; // VB can't have both D3D and generic data.
+    ASSERT( GetVertexDeclaration().mVertexFormat != VertexDeclaration::VERTEX_FORMAT_NONE ) ;
+    ASSERT( GetCapacity() >= genericVertexBuffer.GetPopulation() ) ;
+    ASSERT( GetVertexSizeInBytes() > 0 ) ;
+    ASSERT( genericVertexBuffer.GetGenericVertexData() != NULLPTR ) ; // incoming VB must be generic.
+    ASSERT( genericVertexBuffer.GetVertexDeclaration().mVertexFormat == VertexDeclaration::GENERIC ) ;
+    ASSERT( genericVertexBuffer.GetVertexSizeInBytes() > 0 ) ;
+
+    void *                  dstVertexData   = LockVertexData() ;
+
+    ASSERT( dstVertexData != NULLPTR ) ;  // Make sure we obtained lock.
+
+    const size_t            numVerts        = genericVertexBuffer.GetPopulation() ;
+    const GenericVertex *   src             = genericVertexBuffer.GetGenericVertexData() ;
+    const VertexDeclaration & vertexDeclaration = GetVertexDeclaration() ;
+    unsigned char *         dst             = static_cast< unsigned char * >( dstVertexData ) ;
+    const size_t            vertexSize      = GetVertexSizeInBytes() ;
+
+    if( VertexDeclaration::BILLBOARD_INSTANCE == vertexDeclaration.GetVertexFormat() )
+    {
+        FAIL() ; // Generic vertices do not describe instances.
+        UnlockVertexData() ;
+        return ;
+    }
+
+    if( VertexDeclaration::POSITION_NORMAL_PACKED == vertexDeclaration.GetVertexFormat() )
+    {   // Quantize against the box that bounds generic positions.
+        float minCorner[ 3 ] = {   FLT_MAX ,   FLT_MAX ,   FLT_MAX } ;
+        float maxCorner[ 3 ] = { - FLT_MAX , - FLT_MAX , - FLT_MAX } ;
+        for( size_t idx = 0 ; idx < numVerts ; ++ idx )
+        {
+            const float * position = & src[ idx ].px ;
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {
+                minCorner[ axis ] = Min2( minCorner[ axis ] , position[ axis ] ) ;
+                maxCorner[ axis ] = Max2( maxCorner[ axis ] , position[ axis ] ) ;
+            }
+        }
+        SetPositionBounds( minCorner , maxCorner ) ;
+
+        VertexFormatPositionNormalPacked * packed = static_cast< VertexFormatPositionNormalPacked * >( dstVertexData ) ;
+        for( size_t idx = 0 ; idx < numVerts ; ++ idx )
+        {
+            QuantizePosition( & packed[ idx ].px , & src[ idx ].px ) ;
+            packed[ idx ].pad    = 0 ;
+            packed[ idx ].normal = PackNormal( & src[ idx ].nx ) ;
+        }
+        SetPopulation( numVerts ) ;
+        UnlockVertexData() ;
+        return ;
+    }
+
+    // Every other format is a subset of position, normal, color and texture coordinates, at offsets DeclareVertexFormat assigned.
+    for( size_t idx = 0 ; idx < numVerts ; ++ idx )
+    {
+        unsigned char * vertex = dst + idx * vertexSize ;
+
+        float * position = reinterpret_cast< float * >( vertex + mOffsetPx ) ;
+        position[ 0 ] = src[ idx ].px ;
+        position[ 1 ] = src[ idx ].py ;
+        position[ 2 ] = src[ idx ].pz ;
+
+        if( vertexDeclaration.HasNormals() )
+        {
+            float * normal = reinterpret_cast< float * >( vertex + mOffsetNx ) ;
+            normal[ 0 ] = src[ idx ].nx ;
+            normal[ 1 ] = src[ idx ].ny ;
+            normal[ 2 ] = src[ idx ].nz ;
+        }
+
+        if( vertexDeclaration.HasColors() )
+        {
+            unsigned char * color = vertex + mOffsetCr ;
+            color[ 0 ] = ColorByteFromFloat( src[ idx ].cr ) ;
+            color[ 1 ] = ColorByteFromFloat( src[ idx ].cg ) ;
+            color[ 2 ] = ColorByteFromFloat( src[ idx ].cb ) ;
+            color[ 3 ] = ColorByteFromFloat( src[ idx ].ca ) ;
+        }
+
+        if( vertexDeclaration.HasTextureCoordinates() )
+        {
+            float * texCoord = reinterpret_cast< float * >( vertex + mOffsetTu ) ;
+            texCoord[ 0 ] = src[ idx ].ts ;
+            texCoord[ 1 ] = src[ idx ].tt ;
+        }
+    }
+
+    SetPopulation( numVerts ) ;
+
+    UnlockVertexData() ;
+}
+
+
+
+
+/* virtual */ void D3D11_VertexBuffer::TranslateFromGeneric( const VertexDeclaration & targetVertexDeclaration )
+{
+    ASSERT( GetGenericVertexData() != NULLPTR ) ; // Incoming VB must be generic.
+    ASSERT( GetVertexDeclaration().mVertexFormat == VertexDeclaration::GENERIC ) ;
+    ASSERT( GetPopulation() > 0 ) ;
+    ASSERT( GetVertexSizeInBytes() > 0 ) ;
+
+    // Save off original data because members of this will get overwritten.
+    D3D11_VertexBuffer genericSource ;
+    genericSource.Swap( * this ) ;
+    SetUsage( genericSource.GetUsage() ) ;
+
+    if( CreateVertexBuffer( targetVertexDeclaration , genericSource.GetPopulation() ) )
+    {   // Successfully allocated new vertex buffer.
+        CopyVerticesFromGenericToPlatformSpecific( genericSource ) ;
+    }
+    else
+    {
+        FAIL() ;
+    }
+
+    // On scope close, genericSource will be destructed and its resources released.
+}
+
+
+
+
+
+
+    } ;
+} ;
+
+
+#if defined( _DEBUG )
+
+void PeGaSys_Render_D3D11_VertexBuffer_UnitTest( void )
+{
+    DebugPrintf( "D3D11_VertexBuffer::UnitTest ----------------------------------------------\n" ) ;
+
+    {
+        PeGaSys::Render::D3D11_VertexBuffer d3D11_VertexBuffer ;
+        d3D11_VertexBuffer.Clear() ;
+    }
+
+    DebugPrintf( "D3D11_VertexBuffer::UnitTest: THE END ----------------------------------------------\n" ) ;
+}
+#endif
@@ -0,0 +1,174 @@
+/** \file D3D11_VertexBuffer.h
+
+    \brief Vertex buffer for Direct3D version 11
+
+    \author Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_VERTEX_BUFFER_H
+#define PEGASYS_RENDER_D3D11_VERTEX_BUFFER_H
+
+#include <d3d11.h>
+
+#include "Render/Resource/vertexBuffer.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Vertex buffer for Direct3D version 11.
+
+            Vertex layouts match those of D3D9_VertexBuffer, except colors are
+            stored as bytes in RGBA order (DXGI_FORMAT_R8G8B8A8_UNORM).
+            BILLBOARD_INSTANCE and POSITION_NORMAL_PACKED match those of
+            OpenGL_VertexBuffer; D3D11_RenderStateCache expands the former and
+            dequantizes the latter in vertex shaders.
+
+            Buffers with USAGE_STREAM are dynamic, and LockVertexData maps them
+            with D3D11_MAP_WRITE_DISCARD, so the driver renames them instead of
+            waiting for the GPU.  Other buffers live in GPU memory, so
+            LockVertexData returns a CPU-side copy, which UnlockVertexData uploads.
+            Either way, lock and unlock only on the thread that owns the API,
+            since they use the immediate context.
+        */
+        class D3D11_VertexBuffer : public VertexBufferBase
+        {
+            public:
+
+                struct VertexFormatPosition
+                {   // Custom vertex format for position
+                    float px, py, pz ;  // untransformed (world-space) position
+                } ;
+
+                ////////////////////////////////////////////////////////
+                // Position plus one other component
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatPositionNormal
+                {   // Custom vertex format for position+normal
+                    float px, py, pz ;  // untransformed (world-space) position
+                    float nx, ny, nz ;  // surface normal unit vector
+                } ;
+
+                struct VertexFormatPositionColor
+                {   // Custom vertex format for position+color
+                    float           px, py, pz  ;   // untransformed (world-space) position
+                    unsigned char   crgba[4]    ;   // color in RGBA form packed into 4 unsigned bytes
+                } ;
+
+                struct VertexFormatPositionTexture
+                {   // Custom vertex format for position+texCoord
+                    float px, py, pz ;  // untransformed (world-space) position
+                    float ts, tt ;      // 2D texture coordinates
+                } ;
+
+                ////////////////////////////////////////////////////////
+                // Position plus two other components
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatPositionNormalColor
+                {   // Custom vertex format for position+normal+color
+                    float           px, py, pz  ;   // untransformed (world-space) position
+                    float           nx, ny, nz  ;   // surface normal unit vector
+                    unsigned char   crgba[4]    ;   // color in RGBA form packed into 4 unsigned bytes
+                } ;
+
+                struct VertexFormatPositionNormalTexture
+                {   // Custom vertex format for position+normal+texCoord
+                    float px, py, pz ;  // untransformed (world-space) position
+                    float nx, ny, nz ;  // surface normal unit vector
+                    float ts, tt ;      // 2D texture coordinates
+                } ;
+
+                struct VertexFormatPositionColorTexture
+                {   // Custom vertex format for position+color+texCoord
+                    float           px, py, pz  ;   // untransformed (world-space) position
+                    unsigned char   crgba[4]    ;   // color in RGBA form packed into 4 unsigned bytes
+                    float           ts, tt      ;   // 2D texture coordinates
+                } ;
+
+                ////////////////////////////////////////////////////////
+                // Position plus three other components
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatPositionNormalColorTexture
+                {   // Custom vertex format for position+normal+color+texCoord
+                    float           px, py, pz  ;   // untransformed (world-space) position
+                    float           nx, ny, nz  ;   // surface normal unit vector
+                    unsigned char   crgba[4]    ;   // color in RGBA form packed into 4 unsigned bytes
+                    float           ts, tt      ;   // 2D texture coordinates
+                } ;
+
+                ////////////////////////////////////////////////////////
+                // Instances, expanded into vertices by a vertex shader
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatBillboardInstance
+                {   // Custom instance format for a camera-facing quadrilateral.  Same layout as OpenGL_VertexBuffer::VertexFormatBillboardInstance, which ParticlesRenderModel fills.
+                    float           px, py, pz  ;   // untransformed (world-space) position of center
+                    unsigned short  halfSize    ;   // distance from center to edge, as a half float (see HalfFromFloat)
+                    unsigned short  angle       ;   // rotation, in radians within [0,2pi), about the view axis, as a half float
+                    unsigned char   crgba[4]    ;   // color in RGBA form
+                    unsigned short  tv0, tv1    ;   // texture coordinate (v) of top and bottom edges, normalized to [0,65535]
+                } ;
+
+                ////////////////////////////////////////////////////////
+                // Packed formats
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatPositionNormalPacked
+                {   // Custom vertex format for position+normal.  12 bytes, versus 24 for VertexFormatPositionNormal.
+                    short           px, py, pz  ;   // position quantized against the box VertexBufferBase::SetPositionBounds sets
+                    short           pad         ;   // unused; keeps normal aligned, and lets position use DXGI_FORMAT_R16G16B16A16_SINT
+                    unsigned        normal      ;   // surface normal packed into 10:10:10:2 (see PackNormal_10_10_10_2)
+                } ;
+
+                static const unsigned sTypeId = 'vbdb' ;
+
+                /// Maximum number of input elements (position, normal, color, texture coordinates) in any vertex format.
+                static const unsigned sMaxInputElements = 4 ;
+
+                D3D11_VertexBuffer() ;
+                virtual ~D3D11_VertexBuffer() ;
+
+                virtual void TranslateFromGeneric( const VertexDeclaration & targetVertexDeclaration ) ;
+                virtual void Clear() {}
+
+                static UINT GetInputElements( VertexDeclaration::VertexFormatE vertexFormat , D3D11_INPUT_ELEMENT_DESC inputElements[ sMaxInputElements ] ) ;
+
+            private:
+                virtual bool Allocate( size_t numVertices ) ;
+                virtual void Deallocate() ;
+                virtual void DeclareVertexFormat( const VertexDeclaration & vertexDeclaration ) ;
+
+                virtual void * LockVertexData() ;
+                virtual void UnlockVertexData() ;
+                virtual void * GetElementStart( void * vertexData , VertexDeclaration::VertexElement::SemanticE semantic , size_t which ) ;
+
+                void    Swap( D3D11_VertexBuffer & that ) ;
+                bool    CreateVertexBuffer( const VertexDeclaration & vertexDeclaration , size_t numVertices ) ;
+                void    CopyVerticesFromGenericToPlatformSpecific( const D3D11_VertexBuffer & genericVertexBuffer ) ;
+
+                friend class D3D11_Mesh ; // Grant access to GetInternalBuffer.
+
+                // Only D3D11_Mesh should access GetInternalBuffer.
+                ID3D11Buffer * GetInternalBuffer() const { return mInternalVertexBuffer ; }
+
+                ID3D11Buffer *  mInternalVertexBuffer   ;   ///< Internal D3D vertex buffer object
+                unsigned char * mShadowVertexData       ;   ///< CPU-side copy of vertices that LockVertexData returns for static buffers, or NULL for streaming buffers.
+
+                size_t  mOffsetPx                   ;   ///< Offset, relative to start of vertex, of position
+                size_t  mOffsetTu                   ;   ///< Offset, relative to start of vertex, of texture coordinate
+                size_t  mOffsetCr                   ;   ///< Offset, relative to start of vertex, of color
+                size_t  mOffsetNx                   ;   ///< Offset, relative to start of vertex, of normal
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -0,0 +1,365 @@
+/** \file D3D11_window.cpp
+
+    \brief Window render target for Direct3D 11
+
+    \author Written and Copyright 2010-2016 Michael Jason Gourlay; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Memory/newWrapper.h"
+#include "Core/File/debugPrint.h"
+
+#include <stdio.h>
+
+#include <windows.h>
+#include <d3d11.h>
+
+#pragma comment( lib , "d3d11.lib" )
+
+#include "Render/Platform/DirectX11/D3D11_api.h" // for HROK
+#include "Render/Platform/DirectX11/D3D11_mesh.h"
+#include "Render/Platform/DirectX11/D3D11_renderState.h"
+
+#include "Render/Platform/DirectX11/D3D11_window.h"
+
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+
+ID3D11Device *              g_d3d11Device           = NULL ;    // Direct3D rendering device.  Thread-safe, so any thread can create resources.
+ID3D11DeviceContext *       g_d3d11ImmediateContext = NULL ;    // Context that executes commands.  Only the thread that owns D3D11_Api may use it.
+IDXGISwapChain *            g_dxgiSwapChain         = NULL ;    // Swap chain that presents the back buffer to the window.
+ID3D11RenderTargetView *    g_d3d11RenderTargetView = NULL ;    // View of back buffer, which every context renders into.
+ID3D11DepthStencilView *    g_d3d11DepthStencilView = NULL ;    // View of depth buffer, which every context renders with.
+
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct D3D window render target.
+        */
+        D3D11_Window::D3D11_Window( class Render::System * renderSystem )
+            : Window( renderSystem )
+            , mWindowHandle( NULL )
+        {
+        }
+
+
+
+
+        /** Destruct D3D window render target.
+        */
+        D3D11_Window::~D3D11_Window()
+        {
+            if( mWindowHandle )
+            {
+                DestroyWindow( mWindowHandle ) ;
+            }
+        }
+
+
+
+
+        //-----------------------------------------------------------------------------
+        // Desc: Creates views of the back buffer and of a depth buffer of the given size
+        //-----------------------------------------------------------------------------
+        static void CreateRenderTargetViews( UINT width , UINT height )
+        {
+            ASSERT( ( NULL == g_d3d11RenderTargetView ) && ( NULL == g_d3d11DepthStencilView ) ) ;
+
+            // Create a view of the back buffer, for rendering into it.
+            ID3D11Texture2D * backBuffer = NULL ;
+            HROK( g_dxgiSwapChain->GetBuffer( 0 , __uuidof( ID3D11Texture2D ) , reinterpret_cast< void ** >( & backBuffer ) ) ) ;
+            HROK( g_d3d11Device->CreateRenderTargetView( backBuffer , NULL , & g_d3d11RenderTargetView ) ) ;
+            backBuffer->Release() ;
+
+            // Create depth buffer and a view of it.
+            D3D11_TEXTURE2D_DESC depthDesc ;
+            ZeroMemory( & depthDesc , sizeof( depthDesc ) ) ;
+            depthDesc.Width             = width ;
+            depthDesc.Height            = height ;
+            depthDesc.MipLevels         = 1 ;
+            depthDesc.ArraySize         = 1 ;
+            depthDesc.Format            = DXGI_FORMAT_D24_UNORM_S8_UINT ;
+            depthDesc.SampleDesc.Count  = 1 ;
+            depthDesc.Usage             = D3D11_USAGE_DEFAULT ;
+            depthDesc.BindFlags         = D3D11_BIND_DEPTH_STENCIL ;
+            ID3D11Texture2D * depthBuffer = NULL ;
+            HROK( g_d3d11Device->CreateTexture2D( & depthDesc , NULL , & depthBuffer ) ) ;
+            HROK( g_d3d11Device->CreateDepthStencilView( depthBuffer , NULL , & g_d3d11DepthStencilView ) ) ;
+            depthBuffer->Release() ;
+        }
+
+
+
+
+        //-----------------------------------------------------------------------------
+        // Desc: Releases views that CreateRenderTargetViews created
+        //-----------------------------------------------------------------------------
+        static void ReleaseRenderTargetViews()
+        {
+            if( g_d3d11DepthStencilView != NULL )
+            {
+                g_d3d11DepthStencilView->Release() ;
+                g_d3d11DepthStencilView = NULL ;
+            }
+
+            if( g_d3d11RenderTargetView != NULL )
+            {
+                g_d3d11RenderTargetView->Release() ;
+                g_d3d11RenderTargetView = NULL ;
+            }
+        }
+
+
+
+
+        //-----------------------------------------------------------------------------
+        // Desc: Initializes Direct3D
+        //-----------------------------------------------------------------------------
+        static HRESULT InitD3D( HWND hWnd , UINT width , UINT height )
+        {
+            DXGI_SWAP_CHAIN_DESC swapChainDesc ;
+            ZeroMemory( & swapChainDesc , sizeof( swapChainDesc ) ) ;
+            swapChainDesc.BufferCount           = 1 ;
+            swapChainDesc.BufferDesc.Width      = width ;
+            swapChainDesc.BufferDesc.Height     = height ;
+            swapChainDesc.BufferDesc.Format     = DXGI_FORMAT_R8G8B8A8_UNORM ;
+            swapChainDesc.BufferUsage           = DXGI_USAGE_RENDER_TARGET_OUTPUT ;
+            swapChainDesc.OutputWindow          = hWnd ;
+            swapChainDesc.SampleDesc.Count      = 1 ;
+            swapChainDesc.Windowed              = TRUE ;
+            swapChainDesc.SwapEffect            = DXGI_SWAP_EFFECT_DISCARD ;
+
+            UINT createFlags = 0 ;
+#       if defined( _DEBUG )
+            createFlags |= D3D11_CREATE_DEVICE_DEBUG ;
+#       endif
+
+            // Do not pass D3D11_CREATE_DEVICE_SINGLETHREADED, since command recorders create and use deferred contexts on other threads.
+            const D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_0 , D3D_FEATURE_LEVEL_10_1 , D3D_FEATURE_LEVEL_10_0 } ;
+            HRESULT hResult = D3D11CreateDeviceAndSwapChain( NULL
+                , D3D_DRIVER_TYPE_HARDWARE
+                , NULL
+                , createFlags
+                , featureLevels
+                , sizeof( featureLevels ) / sizeof( featureLevels[ 0 ] )
+                , D3D11_SDK_VERSION
+                , & swapChainDesc
+                , & g_dxgiSwapChain
+                , & g_d3d11Device
+                , NULL
+                , & g_d3d11ImmediateContext ) ;
+            if( FAILED( hResult ) )
+            {
+                return E_FAIL;
+            }
+
+            CreateRenderTargetViews( width , height ) ;
+
+            // Create shaders that emulate fixed-function rendering, and geometry for rendering quadrilaterals.
+            if(     ! D3D11_RenderStateCache::CreateShaders( g_d3d11Device )
+                ||  ! D3D11_Mesh::CreateQuadIndexBuffer( g_d3d11Device ) )
+            {
+                return E_FAIL;
+            }
+
+            return S_OK;
+        }
+
+
+
+
+        //-----------------------------------------------------------------------------
+        // Desc: Releases all previously initialized objects
+        //-----------------------------------------------------------------------------
+        static VOID Cleanup()
+        {
+            D3D11_Mesh::ReleaseQuadIndexBuffer() ;
+            D3D11_RenderStateCache::ReleaseShaders() ;
+
+            ReleaseRenderTargetViews() ;
+
+            if( g_dxgiSwapChain != NULL )
+                g_dxgiSwapChain->Release() ;
+
+            if( g_d3d11ImmediateContext != NULL )
+                g_d3d11ImmediateContext->Release() ;
+
+            if( g_d3d11Device != NULL )
+                g_d3d11Device->Release() ;
+        }
+
+
+
+
+        //-----------------------------------------------------------------------------
+        // Desc: Presents the scene
+        //-----------------------------------------------------------------------------
+        static VOID Render()
+        {
+            if( NULL == g_dxgiSwapChain )
+                return;
+
+            // Present the backbuffer contents to the display, waiting for vsync.
+            HROK( g_dxgiSwapChain->Present( 1 , 0 ) ) ;
+        }
+
+
+
+
+        //-----------------------------------------------------------------------------
+        // Desc: The window's message handler
+        //-----------------------------------------------------------------------------
+        static LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
+        {
+            switch( msg )
+            {
+            case WM_DESTROY:
+                Cleanup();
+                PostQuitMessage( 0 );
+                return 0;
+
+            case WM_PAINT:
+                Render();
+                ValidateRect( hWnd, NULL );
+                return 0;
+
+            case WM_SIZE:
+                if( ( g_dxgiSwapChain != NULL ) && ( wParam != SIZE_MINIMIZED ) && ( LOWORD( lParam ) > 0 ) && ( HIWORD( lParam ) > 0 ) )
+                {   // Resize back buffer and depth buffer to match client area.
+                    // Unlike D3D9 Reset, this does not require releasing other resources, only views of the back buffer,
+                    // which must not remain bound.  D3D11_Api::SetViewport binds the new views before the next render.
+                    g_d3d11ImmediateContext->OMSetRenderTargets( 0 , NULL , NULL ) ;
+                    ReleaseRenderTargetViews() ;
+                    HROK( g_dxgiSwapChain->ResizeBuffers( 0 , LOWORD( lParam ) , HIWORD( lParam ) , DXGI_FORMAT_UNKNOWN , 0 ) ) ;
+                    CreateRenderTargetViews( LOWORD( lParam ) , HIWORD( lParam ) ) ;
+                }
+                break;
+
+            }
+
+            return DefWindowProc( hWnd, msg, wParam, lParam );
+        }
+
+
+
+
+        void D3D11_Window::Create()
+        {
+            // Register the window class
+            WNDCLASSEX wc =
+            {
+                sizeof( WNDCLASSEX ), CS_CLASSDC, MsgProc, 0L, 0L,
+                    GetModuleHandle( NULL ), NULL, NULL, NULL, NULL,
+                    L"PeGaSys", NULL
+            };
+            RegisterClassEx( &wc );
+
+            // Create the window.
+            // Note that this window has borders, so the "client area" that corresponds to the render surface will have a different position and size.
+            mWindowHandle = CreateWindow( L"PeGaSys"
+                , L"PeGaSys"
+                , WS_OVERLAPPEDWINDOW
+                , GetLeft()
+                , GetTop()
+                , GetWidth()
+                , GetHeight()
+                , NULL, NULL, wc.hInstance, NULL );
+
+            if( SUCCEEDED( InitD3D( mWindowHandle , GetState( WIDTH ) , GetState( HEIGHT ) ) ) )
+            {
+                // Show the window
+                ShowWindow( mWindowHandle, SW_SHOWDEFAULT );
+                UpdateWindow( mWindowHandle );
+
+                // Clear the backbuffer to a blue color
+                static const FLOAT blue[ 4 ] = { 0.0f , 0.0f , 1.0f , 1.0f } ;
+                g_d3d11ImmediateContext->ClearRenderTargetView( g_d3d11RenderTargetView , blue ) ;
+                HROK( g_dxgiSwapChain->Present( 0 , 0 ) ) ;
+
+                // Update this window object to reflect "client" (renderable surface) geometry.
+                SetTop( GetState( POSITION_X ) ) ;
+                SetLeft( GetState( POSITION_Y ) ) ;
+                SetWidth( GetState( WIDTH ) ) ;
+                SetHeight( GetState( HEIGHT ) ) ;
+            }
+        }
+
+
+
+
+        void D3D11_Window::Change()
+        {
+        }
+
+
+
+
+        /* virtual */ void D3D11_Window::SetWindow()
+        {
+        }
+
+
+
+
+        /** Obtain state information about this window.
+        */
+        int D3D11_Window::GetState( StateE state )
+        {
+            WINDOWINFO windowInfo ;
+            DEBUG_ONLY( BOOL gwiOk = ) GetWindowInfo( mWindowHandle , & windowInfo ) ;
+            ASSERT( gwiOk ) ;
+
+            switch( state )
+            {
+            case POSITION_X : return windowInfo.rcClient.top                                ; break ;
+            case POSITION_Y : return windowInfo.rcClient.left                               ; break ;
+            case WIDTH      : return windowInfo.rcClient.right  - windowInfo.rcClient.left  ; break ;
+            case HEIGHT     : return windowInfo.rcClient.bottom - windowInfo.rcClient.top   ; break ;
+            }
+
+            FAIL() ;    // state has invalid value.
+            return -1 ; // Return invalid value.
+        }
+
+
+
+
+    } ;
+} ;
+
+
+
+#if defined( _DEBUG )
+
+
+
+
+void PeGaSys::Render::D3D11_Window::UnitTest( void )
+{
+    DebugPrintf( "D3D11_Window::UnitTest ----------------------------------------------\n" ) ;
+
+    {
+        D3D11_Window window( 0 ) ;
+
+        window.GetTypeId() ;
+        window.SetWidth( 640 ) ;
+        window.SetHeight( 480 ) ;
+        window.SetDepth( true ) ;
+        window.SetName( "MyWindow_D3D11" ) ;
+        window.SetFullScreen( false ) ;
+        window.SetLeft( 20 ) ;
+        window.SetTop( 20 ) ;
+
+        window.Create() ;
+        window.Change() ;
+        window.RenderViewports( 0.0 ) ;
+    }
+
+    DebugPrintf( "D3D11_Window::UnitTest: THE END ----------------------------------------------\n" ) ;
+}
+#endif
@@ -0,0 +1,61 @@
+/** \file D3D11_window.h
+
+    \brief Window render target for Direct3D 11
+
+    \author Written and Copyright 2010-2016 Michael Jason Gourlay; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D11_WINDOW_H
+#define PEGASYS_RENDER_D3D11_WINDOW_H
+
+#include "Render/Device/window.h"
+
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Window render target for Direct3D 11.
+
+            Create creates the device, its immediate context and a swap chain,
+            with a render target view of the back buffer and a depth-stencil
+            view, which D3D11_Api binds on every context it renders with.
+        */
+        class D3D11_Window : public Window
+        {
+        public:
+            static const unsigned sType = 'DBWN' ; ///< Type identifier for this class
+
+            enum Parameters
+            {
+                pHinst  = 'hins'    ,
+                NUM_PARAMETERS
+            } ;
+
+            D3D11_Window( class Render::System * renderSystem ) ;
+            virtual ~D3D11_Window() ;
+
+            virtual void    Create() ;
+            virtual void    Change() ;
+            virtual int     GetState( StateE state ) ;
+
+#       if defined( _DEBUG )
+            static void UnitTest() ;
+#       endif
+
+        private:
+            virtual /* implements */ void SetWindow() ;
+
+            HWND                mWindowHandle   ;   /// Handle to the window.
+
+        } ;
+
+        // Public variables ------------------------------------------------------------
+        // Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -368,6 +368,16 @@ namespace PeGaSys {
 
 
 
+        /** Restore world transform to identity.  Direct3D keeps world and view transforms separate, so the view transform is unaffected.
+        */
+        /* virtual */ void D3D9_Api::ResetLocalToWorld()
+        {
+            SetLocalToWorld( Mat4_xIdentity ) ;
+        }
+
+
+
+
         /** Render simple text for on-screen diagnostic messages.
         */
         /* virtual */ void  D3D9_Api::RenderSimpleText( const char * /*text*/ , const Vec3 & /*position*/ , bool /*useScreenSpace*/ )
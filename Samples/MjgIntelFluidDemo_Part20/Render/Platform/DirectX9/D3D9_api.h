@@ -11,6 +11,7 @@
 #include "Render/Device/api.h"
 
 #include "Render/Platform/DirectX9/D3D9_RenderState.h"
+#include "Render/Platform/DirectX9/D3D9_gpuTimer.h"
 
 // Macros ----------------------------------------------------------------------
 
@@ -46,6 +47,7 @@ namespace PeGaSys
             virtual void        SetCamera( const Camera & camera ) ;
             virtual void        SetLights( const ModelNode & lightReceiver ) ;
             virtual void        SetLocalToWorld( const Mat44 & localToWorld ) ;
+            virtual void        ResetLocalToWorld() ;
 
             virtual void        RenderSimpleText( const char * text , const Vec3 & position , bool useScreenSpace ) ;
 
@@ -54,6 +56,7 @@ namespace PeGaSys
             virtual void                DeleteIndexBuffer( IndexBufferBase * indexBuffer ) ;
             virtual MeshBase *          NewMesh( ModelData * owningModelData ) ;
             virtual TextureBase *       NewTexture() ;
+            virtual GpuTimerBase *      GetGpuTimer() { return & mGpuTimer ; }
 
             virtual void ApplyRenderState( const RenderStateS & renderState ) ;
             virtual void GetRenderState( RenderStateS & renderState ) ;
@@ -65,6 +68,7 @@ namespace PeGaSys
             void    SetLight( unsigned idx , const Light & light ) ;
 
             D3D9_RenderStateCache   mRenderStateCache   ;   ///< Cache of render state.
+            D3D9_GpuTimer           mGpuTimer           ;   ///< Timer that measures durations of GPU render passes.
         } ;
 
         // Public variables ------------------------------------------------------------
@@ -0,0 +1,191 @@
+/** \file D3D9_gpuTimer.cpp
+
+    \brief Measure durations of GPU render passes with Direct3D version 9 timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Core/Utility/macros.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <d3d9.h>
+
+#include "Render/Platform/DirectX9/D3D9_api.h" // for HROK
+
+#include "Render/Platform/DirectX9/D3D9_gpuTimer.h"
+
+#include <string.h>
+
+extern LPDIRECT3DDEVICE9 g_pd3dDevice ; // Direct3D rendering device
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct Direct3D GPU timer.
+
+            This does not create queries; the first BeginFrame does, since that requires a device.
+        */
+        D3D9_GpuTimer::D3D9_GpuTimer()
+        {
+            PERF_BLOCK( D3D9_GpuTimer__D3D9_GpuTimer ) ;
+
+            memset( mTimestamps , 0 , sizeof( mTimestamps ) ) ;
+            memset( mDisjoint   , 0 , sizeof( mDisjoint   ) ) ;
+            memset( mFrequency  , 0 , sizeof( mFrequency  ) ) ;
+        }
+
+
+
+
+        /** Destruct Direct3D GPU timer.
+        */
+        D3D9_GpuTimer::~D3D9_GpuTimer()
+        {
+            PERF_BLOCK( D3D9_GpuTimer__dtor ) ;
+
+            ReleaseQueries() ;
+        }
+
+
+
+
+        /** Release every query this timer created.
+        */
+        void D3D9_GpuTimer::ReleaseQueries()
+        {
+            for( size_t iFrame = 0 ; iFrame < sNumFramesInFlight ; ++ iFrame )
+            {
+                for( size_t iQuery = 0 ; iQuery < sNumQueriesPerFrame ; ++ iQuery )
+                {
+                    if( mTimestamps[ iFrame ][ iQuery ] )
+                    {
+                        mTimestamps[ iFrame ][ iQuery ]->Release() ;
+                        mTimestamps[ iFrame ][ iQuery ] = NULLPTR ;
+                    }
+                }
+                if( mDisjoint[ iFrame ] )
+                {
+                    mDisjoint[ iFrame ]->Release() ;
+                    mDisjoint[ iFrame ] = NULLPTR ;
+                }
+                if( mFrequency[ iFrame ] )
+                {
+                    mFrequency[ iFrame ]->Release() ;
+                    mFrequency[ iFrame ] = NULLPTR ;
+                }
+            }
+        }
+
+
+
+
+        /** Create timestamp, disjoint and frequency queries, if the device supports them.
+
+            \return Whether this uses timestamp queries.
+        */
+        /* virtual */ bool D3D9_GpuTimer::CreateQueries()
+        {
+            PERF_BLOCK( D3D9_GpuTimer__CreateQueries ) ;
+
+            if(     ( NULL == g_pd3dDevice )
+                ||  FAILED( g_pd3dDevice->CreateQuery( D3DQUERYTYPE_TIMESTAMP           , NULL ) )
+                ||  FAILED( g_pd3dDevice->CreateQuery( D3DQUERYTYPE_TIMESTAMPDISJOINT   , NULL ) )
+                ||  FAILED( g_pd3dDevice->CreateQuery( D3DQUERYTYPE_TIMESTAMPFREQ       , NULL ) ) )
+            {   // Device does not support timestamp queries.  (Passing NULL only checks support.)
+                return false ;
+            }
+
+            for( size_t iFrame = 0 ; iFrame < sNumFramesInFlight ; ++ iFrame )
+            {
+                for( size_t iQuery = 0 ; iQuery < sNumQueriesPerFrame ; ++ iQuery )
+                {
+                    HROK( g_pd3dDevice->CreateQuery( D3DQUERYTYPE_TIMESTAMP , & mTimestamps[ iFrame ][ iQuery ] ) ) ;
+                }
+                HROK( g_pd3dDevice->CreateQuery( D3DQUERYTYPE_TIMESTAMPDISJOINT , & mDisjoint[ iFrame ]  ) ) ;
+                HROK( g_pd3dDevice->CreateQuery( D3DQUERYTYPE_TIMESTAMPFREQ     , & mFrequency[ iFrame ] ) ) ;
+            }
+            return true ;
+        }
+
+
+
+
+        /** Start detecting whether the GPU clock changes during the given frame.
+        */
+        /* virtual */ void D3D9_GpuTimer::BeginFrameQueries( size_t iFrame )
+        {
+            ASSERT( iFrame < sNumFramesInFlight ) ;
+            HROK( mDisjoint[ iFrame ]->Issue( D3DISSUE_BEGIN ) ) ;
+        }
+
+
+
+
+        /** Stop detecting whether the GPU clock changes, and record timestamp frequency, for the given frame.
+        */
+        /* virtual */ void D3D9_GpuTimer::EndFrameQueries( size_t iFrame )
+        {
+            ASSERT( iFrame < sNumFramesInFlight ) ;
+            HROK( mFrequency[ iFrame ]->Issue( D3DISSUE_END ) ) ;
+            HROK( mDisjoint[ iFrame ]->Issue( D3DISSUE_END ) ) ;
+        }
+
+
+
+
+        /** Record GPU time into the given query once the GPU has executed all previously issued commands.
+        */
+        /* virtual */ void D3D9_GpuTimer::IssueTimestamp( size_t iFrame , size_t iQuery )
+        {
+            ASSERT( ( iFrame < sNumFramesInFlight ) && ( iQuery < sNumQueriesPerFrame ) ) ;
+            HROK( mTimestamps[ iFrame ][ iQuery ]->Issue( D3DISSUE_END ) ) ;
+        }
+
+
+
+
+        /** Read timestamps of the given frame, if the GPU has executed all of its queries.
+
+            GetData without D3DGETDATA_FLUSH returns S_FALSE, rather than wait, while a result is pending.
+            The disjoint query ends the frame, so once it completes, the others have too.
+        */
+        /* virtual */ GpuTimerBase::ResultE D3D9_GpuTimer::ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond )
+        {
+            PERF_BLOCK( D3D9_GpuTimer__ReadResults ) ;
+
+            ASSERT( ( iFrame < sNumFramesInFlight ) && ( numQueries > 0 ) && ( numQueries <= sNumQueriesPerFrame ) ) ;
+
+            BOOL isDisjoint = FALSE ;
+            if( mDisjoint[ iFrame ]->GetData( & isDisjoint , sizeof( isDisjoint ) , 0 ) != S_OK )
+            {
+                return RESULT_NOT_READY ;
+            }
+
+            UINT64 frequency = 0 ;
+            if( mFrequency[ iFrame ]->GetData( & frequency , sizeof( frequency ) , 0 ) != S_OK )
+            {
+                return RESULT_NOT_READY ;
+            }
+
+            for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+            {
+                UINT64 timestamp = 0 ;
+                if( mTimestamps[ iFrame ][ iQuery ]->GetData( & timestamp , sizeof( timestamp ) , 0 ) != S_OK )
+                {
+                    return RESULT_NOT_READY ;
+                }
+                timestamps[ iQuery ] = timestamp ;
+            }
+
+            gpuTicksPerSecond = frequency ;
+            return isDisjoint ? RESULT_DISJOINT : RESULT_READY ;
+        }
+
+    } ;
+} ;
@@ -0,0 +1,56 @@
+/** \file D3D9_gpuTimer.h
+
+    \brief Measure durations of GPU render passes with Direct3D version 9 timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_D3D9_GPU_TIMER_H
+#define PEGASYS_RENDER_D3D9_GPU_TIMER_H
+
+#include "Render/Device/gpuTimer.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+struct IDirect3DQuery9 ;
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Measure durations of GPU render passes with Direct3D version 9 timestamp queries.
+
+            Each frame brackets its timestamps with a D3DQUERYTYPE_TIMESTAMPDISJOINT
+            query, since timestamps are meaningless if the GPU clock changed
+            frequency in between, and ends with a D3DQUERYTYPE_TIMESTAMPFREQ
+            query, which reports their frequency.  If the device does not
+            support these query types, this measures nothing.
+        */
+        class D3D9_GpuTimer : public GpuTimerBase
+        {
+            public:
+                D3D9_GpuTimer() ;
+                virtual ~D3D9_GpuTimer() ;
+
+            protected:
+                virtual bool    CreateQueries() ;
+                virtual void    BeginFrameQueries( size_t iFrame ) ;
+                virtual void    EndFrameQueries( size_t iFrame ) ;
+                virtual void    IssueTimestamp( size_t iFrame , size_t iQuery ) ;
+                virtual ResultE ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond ) ;
+
+            private:
+                void    ReleaseQueries() ;
+
+                IDirect3DQuery9 *   mTimestamps[ sNumFramesInFlight ][ sNumQueriesPerFrame ] ;  ///< Timestamp queries, or NULL if not yet created.
+                IDirect3DQuery9 *   mDisjoint[ sNumFramesInFlight ]                         ;   ///< Query whose result says whether the GPU clock changed during the frame.
+                IDirect3DQuery9 *   mFrequency[ sNumFramesInFlight ]                        ;   ///< Query whose result is the frequency of timestamps during the frame.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
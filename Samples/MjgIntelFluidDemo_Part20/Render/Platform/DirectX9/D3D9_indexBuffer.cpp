@@ -60,6 +60,7 @@ D3D9_IndexBuffer::~D3D9_IndexBuffer()
 
     mNumIndices = numIndices ;
     mIndexType = indexType ;
+    SetCapacity( numIndices ) ;
 
     const UINT   indexBufferSize = static_cast< UINT >( numIndices * indexSize ) ;
 
@@ -86,6 +87,8 @@ void D3D9_IndexBuffer::Clear()
         mInternalIndexBuffer->Release() ;
         mInternalIndexBuffer = NULLPTR ;
     }
+    mNumIndices = 0 ;
+    SetCapacity( 0 ) ;
 }
 
 
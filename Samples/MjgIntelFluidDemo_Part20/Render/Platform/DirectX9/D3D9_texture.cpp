@@ -247,8 +247,46 @@ void D3D9_Texture::Create2DTextureFromImage( const Image * image )
 
 
 
-/* virtual */ void D3D9_Texture::CopyToImage( Image & /*image*/ )
+/** Copy the top MIP level of this texture into the given image.
+
+    \param image    (out) Image to populate.  If it has no data, this sizes it to
+                    match this texture; otherwise its shape must already match.
+
+    This texture is dynamic (see Create2DTextureFromImage), so locking it
+    for reading works without an intermediate system-memory copy.
+*/
+/* virtual */ void D3D9_Texture::CopyToImage( Image & image )
 {
+    ASSERT( mTexture != 0 ) ;
+
+    D3DSURFACE_DESC surfaceDesc ;
+    HROK( mTexture->GetLevelDesc( 0 , & surfaceDesc ) ) ;
+    ASSERT( D3DFMT_A8R8G8B8 == surfaceDesc.Format ) ; // For now, only support RGBA textures
+
+    if( NULLPTR == image.GetImageData() )
+    {   // Image has no data yet, so give it the shape of this texture.
+        image.SetSize( surfaceDesc.Width , surfaceDesc.Height , 4 , 1 ) ;
+    }
+    ASSERT( image.GetWidth()  == surfaceDesc.Width ) ;
+    ASSERT( image.GetHeight() == surfaceDesc.Height ) ;
+    ASSERT( image.GetNumChannels() == 4 ) ; // For now, only support RGBA images
+
+    D3DLOCKED_RECT lockedRectangle ;
+    HROK( mTexture->LockRect( 0 , & lockedRectangle , NULL , D3DLOCK_READONLY ) ) ;
+    for( unsigned iy = 0 ; iy < image.GetHeight() ; ++ iy )
+    {   // For each row in the image...
+        const BYTE * pData = static_cast< const BYTE * >( lockedRectangle.pBits ) + lockedRectangle.Pitch * iy ;
+        for( unsigned ix = 0 ; ix < image.GetWidth() ; ++ ix )
+        {   // For each column in the image...
+            unsigned offset = ix * image.GetXStride() + image.GetYStride() * iy ;
+            // Assign color components for current pixel from corresponding texel, which is in BGRA order.
+            image[ offset + 0 ] = pData[ ix * 4 + 2 ] ;
+            image[ offset + 1 ] = pData[ ix * 4 + 1 ] ;
+            image[ offset + 2 ] = pData[ ix * 4 + 0 ] ;
+            image[ offset + 3 ] = pData[ ix * 4 + 3 ] ;
+        }
+    }
+    HROK( mTexture->UnlockRect( 0 ) ) ;
 }
 
 
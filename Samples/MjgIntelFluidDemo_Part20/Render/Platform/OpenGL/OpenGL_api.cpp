@@ -47,171 +47,6 @@ namespace PeGaSys {
             }
         }
 
-
-
-
-        /// Set the projection matrix to orthographic, for rendering text.
-        static void setOrthographicProjection()
-        {
-            PERF_BLOCK( setOrthographicProjection ) ;
-
-            RENDER_CHECK_ERROR( setOrthographicProjection ) ;
-
-            // TODO: Store matrix mode
-
-            // switch to projection mode
-            glMatrixMode( GL_PROJECTION ) ;
-
-            // save previous matrix which contains the settings for the perspective projection
-            glPushMatrix() ;
-
-            // reset matrix
-            glLoadIdentity() ;
-
-            int viewportXYWH[4] ;
-            glGetIntegerv( GL_VIEWPORT , viewportXYWH ) ;
-
-            if( ( 0 == viewportXYWH[ 2 ] ) || ( 0 == viewportXYWH[ 3 ] ) )
-            {   // Zero-size viewport.
-                // Render window is probably minimized, which is okay, but calling gluOrtho2D would result in an invalid value.
-            }
-            else
-            {   // Viewport is probably valid.
-                // set a 2D orthographic projection
-                gluOrtho2D( 0 , viewportXYWH[ 2 ] , viewportXYWH[ 3 ] , 0 ) ;
-            }
-
-            // switch back to modelview mode
-            glMatrixMode( GL_MODELVIEW ) ;
-
-            glPushMatrix();
-
-            glLoadIdentity();
-
-            // TODO: Restore matrix mode
-
-            RENDER_CHECK_ERROR( setOrthographicProjection ) ;
-        }
-
-
-
-
-        /// Set the projection matrix to projection, for rendering 3D objects.
-        static void restorePerspectiveProjection()
-        {
-            PERF_BLOCK( restorePerspectiveProjection ) ;
-
-            RENDER_CHECK_ERROR( restorePerspectiveProjection ) ;
-
-            // TODO: Store matrix mode
-
-            glMatrixMode(GL_PROJECTION);
-            // restore previous projection matrix
-            glPopMatrix();
-
-            // get back to modelview mode
-            glMatrixMode(GL_MODELVIEW);
-            glPopMatrix() ;
-
-            // TODO: Restore matrix mode
-
-            RENDER_CHECK_ERROR( restorePerspectiveProjection ) ;
-        }
-
-
-
-
-        /// Render the given string using the given font.
-        static void oglRenderBitmapString( void * font , const char * string )
-        {
-            PERF_BLOCK( ogleRenderBitmapString_2 ) ;
-
-            for( const char * c = string ; *c != '\0' ; c ++ )
-            {
-                RENDER_CHECK_ERROR( oglRenderBitmapString_2_pre ) ;
-
-                glutBitmapCharacter( font , *c ) ;
-
-                RENDER_CHECK_ERROR( oglRenderBitmapString_2_post ) ;
-            }
-        }
-
-
-
-
-        static void oglRenderBitmapString( const Vec3 & pos , bool useScreenSpace , void * font , const Vec4 & color , const char * string  )
-        {
-            PERF_BLOCK( ogleRenderBitmapString_5 ) ;
-
-            RENDER_CHECK_ERROR( oglRenderBitmapString_5_pre ) ;
-
-            if( useScreenSpace )
-            {
-                setOrthographicProjection() ;
-            }
-
-            glPushAttrib( GL_DEPTH_BUFFER_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT ) ; // Should include GL_ENABLE_BIT or GL_ALL_ATTRIB_BITS but for some reason that *sometimes* makes things disappear, like vortex lines.
-
-            glDisable( GL_LIGHTING ) ;
-            glDisable( GL_TEXTURE_2D ) ;
-            glEnable( GL_BLEND ) ;
-            glBlendFunc( GL_SRC_ALPHA , GL_ONE_MINUS_SRC_ALPHA ) ;  // Typical alpha blending
-
-            if( useScreenSpace )
-            {   // Only when drawing in screen space...
-                glDisable( GL_DEPTH_TEST ) ;    // Disable depth test so text appears as if in front of everything already drawn.
-            }
-
-            glColor4fv( reinterpret_cast< const GLfloat * >( & color ) ) ;
-
-            //int viewportXYWH[4] ;
-            //glGetIntegerv( GL_VIEWPORT , viewportXYWH ) ;
-
-            glRasterPos3f( pos.x , pos.y , pos.z ) ;
-            oglRenderBitmapString( font , string ) ;
-
-            glPopAttrib() ;
-
-            if( useScreenSpace )
-            {
-                restorePerspectiveProjection() ;
-            }
-
-            RENDER_CHECK_ERROR( oglRenderBitmapString_5_post ) ;
-        }
-
-
-
-
-        /// Render the given string at the given screen-space position using the given font.
-        static void oglRenderString( const Vec3 & pos , bool useScreenSpace , void * font , const char * format , ... )
-        {
-            PERF_BLOCK( oglRenderString ) ;
-
-            char stringBuffer[ 512 ] ;
-            va_list args ;
-            va_start( args , format ) ;
-            _vsnprintf( stringBuffer , sizeof( stringBuffer ) , format , args ) ;
-            va_end( args ) ;
-            oglRenderBitmapString( pos , useScreenSpace , font , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) , stringBuffer ) ;
-        }
-
-
-
-
-        /// Render the given string at the given world-space position using the given font.
-        static void oglRenderStringWorld( const Vec3 & pos , void * font , const Vec4 & color , const char * format , ... )
-        {
-            PERF_BLOCK( oglRenderStringWorld ) ;
-
-            char stringBuffer[ 512 ] ;
-            va_list args ;
-            va_start( args , format ) ;
-            vsprintf( stringBuffer , format , args ) ;
-            va_end( args ) ;
-            oglRenderBitmapString( pos , false , font , color , stringBuffer ) ;
-        }
-
         // Public functions ------------------------------------------------------------
 
         /* static */ void OpenGL_Api::GetProcAddresses()
@@ -396,6 +231,9 @@ namespace PeGaSys {
 
             glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT ) ;
 
+            // Depth mask changed above, and code outside the render system might have changed other state since the previous viewport.
+            mRenderStateCache.Invalidate() ;
+
             RENDER_CHECK_ERROR( SetViewport ) ;
         }
 
@@ -536,6 +374,10 @@ namespace PeGaSys {
 
             \note   If the model does not have normals, setting lights will cause that
                     model to render as black.            
+
+            When the driver supports shader lighting, this only records which
+            lights reach the model, and OpenGL_Lighting uploads whichever
+            lights changed.  Otherwise this sets fixed-function lights.
         */
         /* virtual */ void OpenGL_Api::SetLights( const ModelNode & lightReceiver )
         {
@@ -543,6 +385,11 @@ namespace PeGaSys {
 
             const unsigned numLights = lightReceiver.GetNumLights() ;
             ASSERT( numLights < GL_MAX_LIGHTS ) ;
+            if( mLighting.SetLights( mRenderStateCache.mCurrentState.mTransforms.mViewMatrix , lightReceiver ) )
+            {   // Shader lighting handles these lights.
+                return ;
+            }
+
             if( numLights > 0 )
             {   // Model has at least one light.
                 glEnable( GL_LIGHTING ) ;
@@ -581,7 +428,24 @@ namespace PeGaSys {
 
 
 
-        /** Render simple text for on-screen diagnostic messages.
+        /** Restore ModelView matrix to the view transform that the most recent SetCamera assigned.
+
+            This undoes SetLocalToWorld without recomputing the view transform,
+            so callers can place many models for a single camera.
+        */
+        /* virtual */ void OpenGL_Api::ResetLocalToWorld()
+        {
+            PERF_BLOCK( OpenGL_Api__ResetLocalToWorld ) ;
+
+            glLoadMatrixf( (GLfloat*) & mRenderStateCache.mCurrentState.mTransforms.mViewMatrix ) ;
+
+            RENDER_CHECK_ERROR( ResetLocalToWorld ) ;
+        }
+
+
+
+
+        /** Queue simple text for on-screen diagnostic messages, which FlushSimpleText draws.
 
             \param  position    Position in whatever coordinate space of the current render state matrices.
         */
@@ -589,7 +453,22 @@ namespace PeGaSys {
         {
             PERF_BLOCK( OpenGL_Api__RenderSimpleText ) ;
 
-            oglRenderString( position , useScreenSpace , GLUT_BITMAP_HELVETICA_10 , text ) ;
+            mTextBatch.AddText( position , useScreenSpace , GLUT_BITMAP_HELVETICA_10 , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) , text ) ;
+        }
+
+
+
+
+        /** Draw all text queued by RenderSimpleText since the previous call, with a single draw call.
+        */
+        /* virtual */ void  OpenGL_Api::FlushSimpleText()
+        {
+            PERF_BLOCK( OpenGL_Api__FlushSimpleText ) ;
+
+            mTextBatch.Flush() ;
+
+            // Text batch binds its own texture and vertex buffer, which the render state cache does not know about.
+            mRenderStateCache.Invalidate() ;
         }
 
 
@@ -681,6 +560,66 @@ namespace PeGaSys {
 
 
 
+        /** Redirect passes with order-independent blend state into accumulation targets.
+
+            \see OpenGL_OrderIndependentTransparency.
+        */
+        /* virtual */ bool OpenGL_Api::BeginOrderIndependentTransparency()
+        {
+            PERF_BLOCK( OpenGL_Api__BeginOrderIndependentTransparency ) ;
+
+            if( ! mOrderIndependentTransparency.Begin() )
+            {   // Driver lacks what order-independent transparency needs.
+                return false ;
+            }
+            mRenderStateCache.SetOrderIndependentAccumulation( true ) ;
+            return true ;
+        }
+
+
+
+
+        /* virtual */ void OpenGL_Api::EndOrderIndependentTransparency()
+        {
+            PERF_BLOCK( OpenGL_Api__EndOrderIndependentTransparency ) ;
+
+            mRenderStateCache.SetOrderIndependentAccumulation( false ) ;
+            mOrderIndependentTransparency.End() ;
+        }
+
+
+
+
+        /** Redirect passes into a target with reduced resolution.
+
+            \see OpenGL_ReducedResolution.
+        */
+        /* virtual */ bool OpenGL_Api::BeginReducedResolution( unsigned divisor )
+        {
+            PERF_BLOCK( OpenGL_Api__BeginReducedResolution ) ;
+
+            if( ! mReducedResolution.Begin( divisor ) )
+            {   // Driver lacks what reduced-resolution rendering needs.
+                return false ;
+            }
+            mRenderStateCache.SetPremultipliedTarget( true ) ;
+            return true ;
+        }
+
+
+
+
+        /* virtual */ void OpenGL_Api::EndReducedResolution()
+        {
+            PERF_BLOCK( OpenGL_Api__EndReducedResolution ) ;
+
+            mRenderStateCache.SetPremultipliedTarget( false ) ;
+            mReducedResolution.End() ;
+        }
+
+
+
+
 
 
 
@@ -11,6 +11,11 @@
 #include "Render/Device/api.h"
 
 #include "Render/Platform/OpenGL/OpenGL_RenderState.h"
+#include "Render/Platform/OpenGL/OpenGL_gpuTimer.h"
+#include "Render/Platform/OpenGL/OpenGL_lighting.h"
+#include "Render/Platform/OpenGL/OpenGL_orderIndependentTransparency.h"
+#include "Render/Platform/OpenGL/OpenGL_reducedResolution.h"
+#include "Render/Platform/OpenGL/OpenGL_textBatch.h"
 
 // Macros ----------------------------------------------------------------------
 
@@ -45,19 +50,28 @@ namespace PeGaSys
             virtual void        SetCamera( const Camera & camera ) ;
             virtual void        SetLights( const ModelNode & lightReceiver ) ;
             virtual void        SetLocalToWorld( const Mat44 & localToWorld ) ;
+            virtual void        ResetLocalToWorld() ;
 
             virtual void        RenderSimpleText( const char * text , const Vec3 & position , bool useScreenSpace ) ;
+            virtual void        FlushSimpleText() ;
 
             virtual VertexBufferBase *  NewVertexBuffer() ;
             virtual IndexBufferBase  *  NewIndexBuffer() ;
             virtual void                DeleteIndexBuffer( IndexBufferBase * indexBuffer ) ;
             virtual MeshBase *          NewMesh( ModelData * owningModelData ) ;
             virtual TextureBase *       NewTexture() ;
+            virtual GpuTimerBase *      GetGpuTimer() { return & mGpuTimer ; }
 
             virtual void ApplyRenderState( const RenderStateS & renderState ) ;
             virtual void GetRenderState( RenderStateS & renderState ) ;
             virtual void DisableTexturing() ;
 
+            virtual bool BeginOrderIndependentTransparency() ;
+            virtual void EndOrderIndependentTransparency() ;
+
+            virtual bool BeginReducedResolution( unsigned divisor ) ;
+            virtual void EndReducedResolution() ;
+
             static void GetProcAddresses() ;
             static bool CheckError( const char * situation ) ;
 
@@ -65,6 +79,11 @@ namespace PeGaSys
             void    SetLight( unsigned idx , const Light & light ) ;
 
             OpenGL_RenderStateCache mRenderStateCache   ;   ///< Cache of render state.
+            OpenGL_GpuTimer         mGpuTimer           ;   ///< Timer that measures durations of GPU render passes.
+            OpenGL_Lighting         mLighting           ;   ///< Shader-based lighting, whose lights and materials reside in uniform buffers.
+            OpenGL_OrderIndependentTransparency mOrderIndependentTransparency ; ///< Targets that accumulate order-independent passes.
+            OpenGL_ReducedResolution            mReducedResolution            ; ///< Target that renders passes at reduced resolution, then upsamples them.
+            OpenGL_TextBatch                    mTextBatch                    ; ///< Text that RenderSimpleText queued, which FlushSimpleText draws.
         } ;
 
         // Public variables ------------------------------------------------------------
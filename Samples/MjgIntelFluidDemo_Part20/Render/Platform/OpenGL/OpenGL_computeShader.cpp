@@ -0,0 +1,331 @@
+/** \file OpenGL_computeShader.cpp
+
+    \brief Compute shader program and shader storage buffer for OpenGL
+
+    \author Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_computeShader.h"
+
+#include "Render/Platform/OpenGL/OpenGL_Api.h"
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+#include <Core/File/debugPrint.h>
+
+// Types -----------------------------------------------------------------------
+// Macros ----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct compute shader program for OpenGL.
+        */
+        OpenGL_ComputeShader::OpenGL_ComputeShader()
+            : mProgramName( 0 )
+        {
+        }
+
+
+
+
+        /** Destruct compute shader program for OpenGL.
+        */
+        OpenGL_ComputeShader::~OpenGL_ComputeShader()
+        {
+            Deallocate() ;
+        }
+
+
+
+
+        /** Return whether the OpenGL driver provides everything compute shaders need.
+        */
+        /* static */ bool OpenGL_ComputeShader::IsSupported()
+        {
+            return      glCreateShader && glShaderSource && glCompileShader && glGetShaderiv && glGetShaderInfoLog && glDeleteShader
+                    &&  glCreateProgram && glAttachShader && glLinkProgram && glGetProgramiv && glGetProgramInfoLog && glDeleteProgram
+                    &&  glUseProgram && glGetUniformLocation && glUniform1ui && glUniform3ui && glUniform1f && glUniform3f && glUniform4f
+                    &&  glGenBuffers && glBindBuffer && glBufferData && glDeleteBuffers
+                    &&  glBindBufferBase && glBufferSubData && glGetBufferSubData && glDispatchCompute && glMemoryBarrier ;
+        }
+
+
+
+
+        /** Compile and link a compute shader program from GLSL source.
+
+            \param source       GLSL source code of compute shader, including its #version directive.
+
+            \param shaderType   Stage of shader: GL_COMPUTE_SHADER, or GL_VERTEX_SHADER or GL_FRAGMENT_SHADER for a program whose other stages use the fixed-function pipeline.
+
+            \return Whether compiling and linking succeeded.  Upon failure, debug builds print the info log.
+        */
+        bool OpenGL_ComputeShader::Compile( const char * source , GLenum shaderType )
+        {
+            PERF_BLOCK( OpenGL_ComputeShader__Compile ) ;
+
+            ASSERT( ( shaderType != GL_COMPUTE_SHADER ) || IsSupported() ) ;
+            ASSERT( glCreateShader && glCreateProgram ) ;
+
+            Deallocate() ;
+
+            const GLuint shaderName = glCreateShader( shaderType ) ;
+            glShaderSource( shaderName , 1 , & source , NULL ) ;
+            glCompileShader( shaderName ) ;
+
+#       if defined( _DEBUG )
+            char    infoLog[ 4096 ] ;
+#       endif
+            GLint   status = GL_FALSE ;
+            glGetShaderiv( shaderName , GL_COMPILE_STATUS , & status ) ;
+            if( GL_FALSE == status )
+            {
+#           if defined( _DEBUG )
+                glGetShaderInfoLog( shaderName , sizeof( infoLog ) , NULL , infoLog ) ;
+                DebugPrintf( "OpenGL_ComputeShader::Compile: compile failed:\n%s\n" , infoLog ) ;
+#           endif
+                glDeleteShader( shaderName ) ;
+                return false ;
+            }
+
+            mProgramName = glCreateProgram() ;
+            glAttachShader( mProgramName , shaderName ) ;
+            glLinkProgram( mProgramName ) ;
+            glDeleteShader( shaderName ) ; // Program keeps the shader until the program gets deleted.
+
+            glGetProgramiv( mProgramName , GL_LINK_STATUS , & status ) ;
+            if( GL_FALSE == status )
+            {
+#           if defined( _DEBUG )
+                glGetProgramInfoLog( mProgramName , sizeof( infoLog ) , NULL , infoLog ) ;
+                DebugPrintf( "OpenGL_ComputeShader::Compile: link failed:\n%s\n" , infoLog ) ;
+#           endif
+                Deallocate() ;
+                return false ;
+            }
+
+            return ! RENDER_CHECK_ERROR( OpenGL_ComputeShader_Compile ) ;
+        }
+
+
+
+
+        /** Delete the OpenGL program object, if any.
+        */
+        void OpenGL_ComputeShader::Deallocate()
+        {
+            if( mProgramName )
+            {
+                glDeleteProgram( mProgramName ) ;
+                mProgramName = 0 ;
+            }
+        }
+
+
+
+
+        /** Make this the current program, so subsequent uniform assignments and dispatches use it.
+        */
+        void OpenGL_ComputeShader::Use() const
+        {
+            ASSERT( IsValid() ) ;
+            glUseProgram( mProgramName ) ;
+        }
+
+
+
+
+        /** Return location of the given uniform variable, or -1 if the program has no active uniform by that name.
+        */
+        GLint OpenGL_ComputeShader::GetUniformLocation( const char * uniformName ) const
+        {
+            ASSERT( IsValid() ) ;
+            return glGetUniformLocation( mProgramName , uniformName ) ;
+        }
+
+
+
+
+        /** Launch the given number of work groups of the current program, then make its shader storage writes visible to later commands.
+
+            \param barrierBits Which kinds of later commands must see the writes, for example
+                                GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT to draw vertices this program wrote.
+
+            \note This assumes the caller already called Use.
+        */
+        void OpenGL_ComputeShader::Dispatch( GLuint numGroupsX , GLuint numGroupsY , GLuint numGroupsZ , GLbitfield barrierBits ) const
+        {
+            PERF_BLOCK( OpenGL_ComputeShader__Dispatch ) ;
+
+            ASSERT( IsValid() ) ;
+            glDispatchCompute( numGroupsX , numGroupsY , numGroupsZ ) ;
+            glMemoryBarrier( barrierBits ) ;
+            RENDER_CHECK_ERROR( OpenGL_ComputeShader_Dispatch ) ;
+        }
+
+
+
+
+        /** Launch work groups of the current program, reading how many from a buffer, then make its shader storage writes visible to later commands.
+
+            \param indirectBufferName   Identifier of buffer holding 3 GLuint values: number of work groups along x, y and z.
+                                        An earlier dispatch can write those, so the CPU never needs to read them.
+
+            \param offsetInBytes        Location of those values within that buffer.  Must be a multiple of 4.
+
+            \param barrierBits          \see Dispatch.
+
+            \note This assumes the caller already called Use.  This requires glDispatchComputeIndirect, which OpenGL 4.3 provides along with compute shaders.
+        */
+        void OpenGL_ComputeShader::DispatchIndirect( GLuint indirectBufferName , size_t offsetInBytes , GLbitfield barrierBits ) const
+        {
+            PERF_BLOCK( OpenGL_ComputeShader__DispatchIndirect ) ;
+
+            ASSERT( IsValid() ) ;
+            ASSERT( glDispatchComputeIndirect ) ;
+            ASSERT( 0 == ( offsetInBytes % sizeof( GLuint ) ) ) ;
+            glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER , indirectBufferName ) ;
+            glDispatchComputeIndirect( static_cast< GLintptr >( offsetInBytes ) ) ;
+            glBindBuffer( GL_DISPATCH_INDIRECT_BUFFER , 0 ) ;
+            glMemoryBarrier( barrierBits ) ;
+            RENDER_CHECK_ERROR( OpenGL_ComputeShader_DispatchIndirect ) ;
+        }
+
+
+
+
+        /** Construct shader storage buffer object for OpenGL.
+        */
+        OpenGL_ShaderStorageBuffer::OpenGL_ShaderStorageBuffer()
+            : mBufferName( 0 )
+            , mCapacity( 0 )
+        {
+        }
+
+
+
+
+        /** Destruct shader storage buffer object for OpenGL.
+        */
+        OpenGL_ShaderStorageBuffer::~OpenGL_ShaderStorageBuffer()
+        {
+            Deallocate() ;
+        }
+
+
+
+
+        /** Ensure this buffer can hold at least the given number of bytes.
+
+            This reallocates only when growing, and then discards previous contents.
+        */
+        void OpenGL_ShaderStorageBuffer::Allocate( size_t numBytes )
+        {
+            PERF_BLOCK( OpenGL_ShaderStorageBuffer__Allocate ) ;
+
+            if( 0 == mBufferName )
+            {
+                glGenBuffers( 1 , & mBufferName ) ;
+            }
+            if( numBytes > mCapacity )
+            {   // Grow with slack, so slowly growing contents do not reallocate every time.
+                mCapacity = numBytes + numBytes / 4 ;
+                glBindBuffer( GL_SHADER_STORAGE_BUFFER , mBufferName ) ;
+                glBufferData( GL_SHADER_STORAGE_BUFFER , mCapacity , NULL , GL_DYNAMIC_COPY ) ;
+                glBindBuffer( GL_SHADER_STORAGE_BUFFER , 0 ) ;
+                RENDER_CHECK_ERROR( OpenGL_ShaderStorageBuffer_Allocate ) ;
+            }
+        }
+
+
+
+
+        /** Copy the given data from CPU memory into the start of this buffer, growing it if necessary.
+        */
+        void OpenGL_ShaderStorageBuffer::Upload( const void * data , size_t numBytes )
+        {
+            PERF_BLOCK( OpenGL_ShaderStorageBuffer__Upload ) ;
+
+            Allocate( numBytes ) ;
+            if( numBytes > 0 )
+            {
+                glBindBuffer( GL_SHADER_STORAGE_BUFFER , mBufferName ) ;
+                glBufferSubData( GL_SHADER_STORAGE_BUFFER , 0 , numBytes , data ) ;
+                glBindBuffer( GL_SHADER_STORAGE_BUFFER , 0 ) ;
+                RENDER_CHECK_ERROR( OpenGL_ShaderStorageBuffer_Upload ) ;
+            }
+        }
+
+
+
+
+        /** Copy the given data from CPU memory into part of this buffer, keeping the rest of its contents.
+
+            Unlike Upload, this never grows the buffer, since growing discards contents.
+        */
+        void OpenGL_ShaderStorageBuffer::UploadSubRange( const void * data , size_t numBytes , size_t offsetInBytes )
+        {
+            PERF_BLOCK( OpenGL_ShaderStorageBuffer__UploadSubRange ) ;
+
+            ASSERT( offsetInBytes + numBytes <= mCapacity ) ;
+            if( numBytes > 0 )
+            {
+                glBindBuffer( GL_SHADER_STORAGE_BUFFER , mBufferName ) ;
+                glBufferSubData( GL_SHADER_STORAGE_BUFFER , offsetInBytes , numBytes , data ) ;
+                glBindBuffer( GL_SHADER_STORAGE_BUFFER , 0 ) ;
+                RENDER_CHECK_ERROR( OpenGL_ShaderStorageBuffer_UploadSubRange ) ;
+            }
+        }
+
+
+
+
+        /** Copy the given number of bytes from the start of this buffer into CPU memory.
+
+            \note This waits for commands that write this buffer to finish.
+        */
+        void OpenGL_ShaderStorageBuffer::Download( void * data , size_t numBytes ) const
+        {
+            PERF_BLOCK( OpenGL_ShaderStorageBuffer__Download ) ;
+
+            ASSERT( numBytes <= mCapacity ) ;
+            glBindBuffer( GL_SHADER_STORAGE_BUFFER , mBufferName ) ;
+            glGetBufferSubData( GL_SHADER_STORAGE_BUFFER , 0 , numBytes , data ) ;
+            glBindBuffer( GL_SHADER_STORAGE_BUFFER , 0 ) ;
+            RENDER_CHECK_ERROR( OpenGL_ShaderStorageBuffer_Download ) ;
+        }
+
+
+
+
+        /** Bind this buffer to the given shader storage block binding point.
+        */
+        void OpenGL_ShaderStorageBuffer::BindBase( GLuint bindingIndex ) const
+        {
+            ASSERT( mBufferName ) ;
+            glBindBufferBase( GL_SHADER_STORAGE_BUFFER , bindingIndex , mBufferName ) ;
+        }
+
+
+
+
+        /** Delete the OpenGL buffer object, if any.
+        */
+        void OpenGL_ShaderStorageBuffer::Deallocate()
+        {
+            if( mBufferName )
+            {
+                glDeleteBuffers( 1 , & mBufferName ) ;
+                mBufferName = 0 ;
+            }
+            mCapacity = 0 ;
+        }
+
+    } ;
+} ;
@@ -0,0 +1,108 @@
+/** \file OpenGL_computeShader.h
+
+    \brief Compute shader program and shader storage buffer for OpenGL
+
+    \author Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_COMPUTE_SHADER_H
+#define PEGASYS_RENDER_OPENGL_COMPUTE_SHADER_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+
+#include <stddef.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Compute shader program for OpenGL.
+
+            Compute shaders require OpenGL 4.3 (or ARB_compute_shader).
+            Call IsSupported after OpenGL_Extensions::GetProcAddresses to find
+            out whether the driver provides them.
+
+            Every method requires that the OpenGL context that created this
+            object be current on the calling thread.
+
+            Compile can also build a program with only a vertex shader, or
+            only a fragment shader, whose other stages use the fixed-function
+            pipeline.  Dispatch does not apply to such programs.
+        */
+        class OpenGL_ComputeShader
+        {
+            public:
+                OpenGL_ComputeShader() ;
+                ~OpenGL_ComputeShader() ;
+
+                static bool IsSupported() ;
+
+                bool    Compile( const char * source , GLenum shaderType = GL_COMPUTE_SHADER ) ;
+                void    Deallocate() ;
+
+                /// Return whether Compile succeeded.
+                bool    IsValid() const { return mProgramName != 0 ; }
+
+                void    Use() const ;
+                GLint   GetUniformLocation( const char * uniformName ) const ;
+                void    Dispatch( GLuint numGroupsX , GLuint numGroupsY , GLuint numGroupsZ , GLbitfield barrierBits = GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT ) const ;
+                void    DispatchIndirect( GLuint indirectBufferName , size_t offsetInBytes , GLbitfield barrierBits = GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT ) const ;
+
+            private:
+                OpenGL_ComputeShader( const OpenGL_ComputeShader & ) ;              // Disallow copy
+                OpenGL_ComputeShader & operator=( const OpenGL_ComputeShader & ) ;  // Disallow assignment
+
+                GLuint  mProgramName    ;   ///< Identifier of OpenGL program object, or 0 if there is none.
+        } ;
+
+
+
+
+        /** Shader storage buffer object for OpenGL.
+
+            Compute shaders read and write these.  Contents stay resident in GPU
+            memory between dispatches, so only data that changes needs to cross
+            the bus.
+        */
+        class OpenGL_ShaderStorageBuffer
+        {
+            public:
+                OpenGL_ShaderStorageBuffer() ;
+                ~OpenGL_ShaderStorageBuffer() ;
+
+                void    Allocate( size_t numBytes ) ;
+                void    Upload( const void * data , size_t numBytes ) ;
+                void    UploadSubRange( const void * data , size_t numBytes , size_t offsetInBytes ) ;
+                void    Download( void * data , size_t numBytes ) const ;
+                void    BindBase( GLuint bindingIndex ) const ;
+                void    Deallocate() ;
+
+                /// Get identifier (name) of OpenGL buffer object, or 0 if there is none.  Renderers can bind this to read buffer contents without a CPU round trip.
+                const GLuint &  GetBufferName() const   { return mBufferName ; }
+
+                /// Return number of bytes this buffer can hold without reallocating.
+                const size_t &  GetCapacity() const     { return mCapacity ; }
+
+            private:
+                OpenGL_ShaderStorageBuffer( const OpenGL_ShaderStorageBuffer & ) ;              // Disallow copy
+                OpenGL_ShaderStorageBuffer & operator=( const OpenGL_ShaderStorageBuffer & ) ;  // Disallow assignment
+
+                GLuint  mBufferName ;   ///< Identifier of OpenGL buffer object, or 0 if there is none.
+                size_t  mCapacity   ;   ///< Number of bytes allocated for buffer object.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
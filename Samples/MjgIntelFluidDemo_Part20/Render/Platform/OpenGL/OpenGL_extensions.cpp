@@ -56,6 +56,15 @@ PFNGLFRAMEBUFFERTEXTUREEXTPROC                  glFramebufferTextureEXT
 
 PFNGLDRAWBUFFERSPROC                            glDrawBuffersEXT                         = 0 ;
 
+PFNGLBLITFRAMEBUFFEREXTPROC                     glBlitFramebufferEXT                     = 0 ;
+
+// Per-draw-buffer blending (OpenGL 4.0), used by order-independent transparency
+PFNGLBLENDFUNCIARBPROC          glBlendFunci            = 0 ;   ///< Set blend factors of one draw buffer
+PFNGLBLENDFUNCSEPARATEIARBPROC  glBlendFuncSeparatei    = 0 ;   ///< Set separate color and alpha blend factors of one draw buffer
+
+// Separate color and alpha blending (OpenGL 1.4), used by offscreen targets that later composite with premultiplied alpha
+PFNGLBLENDFUNCSEPARATEPROC      glBlendFuncSeparate     = 0 ;   ///< Set separate color and alpha blend factors of all draw buffers
+
 // VBO Extension Function Pointers
 PFNGLGENBUFFERSARBPROC       glGenBuffers    = 0 ;   ///< VBO Name Generation Procedure
 PFNGLMAPBUFFERARBPROC        glMapBuffer     = 0 ;   ///< VBO Map Buffer procedure
@@ -64,6 +73,74 @@ PFNGLBINDBUFFERARBPROC       glBindBuffer    = 0 ;   ///< VBO Bind Procedure
 PFNGLBUFFERDATAARBPROC       glBufferData    = 0 ;   ///< VBO Data Loading Procedure
 PFNGLDELETEBUFFERSARBPROC    glDeleteBuffers = 0 ;   ///< VBO Deletion Procedure
 
+// Shader objects, used by compute shaders
+PFNGLCREATESHADERPROC        glCreateShader         = 0 ;
+PFNGLSHADERSOURCEPROC        glShaderSource         = 0 ;
+PFNGLCOMPILESHADERPROC       glCompileShader        = 0 ;
+PFNGLGETSHADERIVPROC         glGetShaderiv          = 0 ;
+PFNGLGETSHADERINFOLOGPROC    glGetShaderInfoLog     = 0 ;
+PFNGLDELETESHADERPROC        glDeleteShader         = 0 ;
+PFNGLCREATEPROGRAMPROC       glCreateProgram        = 0 ;
+PFNGLATTACHSHADERPROC        glAttachShader         = 0 ;
+PFNGLLINKPROGRAMPROC         glLinkProgram          = 0 ;
+PFNGLGETPROGRAMIVPROC        glGetProgramiv         = 0 ;
+PFNGLGETPROGRAMINFOLOGPROC   glGetProgramInfoLog    = 0 ;
+PFNGLDELETEPROGRAMPROC       glDeleteProgram        = 0 ;
+PFNGLUSEPROGRAMPROC          glUseProgram           = 0 ;
+PFNGLGETUNIFORMLOCATIONPROC  glGetUniformLocation   = 0 ;
+PFNGLUNIFORM1UIPROC          glUniform1ui           = 0 ;
+PFNGLUNIFORM3UIPROC          glUniform3ui           = 0 ;
+PFNGLUNIFORM1FPROC           glUniform1f            = 0 ;
+PFNGLUNIFORM3FPROC           glUniform3f            = 0 ;
+PFNGLUNIFORM4FPROC           glUniform4f            = 0 ;
+PFNGLUNIFORM1IPROC           glUniform1i            = 0 ;
+
+// Generic vertex attributes and instanced drawing (OpenGL 3.3), used by vertex shaders
+PFNGLVERTEXATTRIBPOINTERPROC        glVertexAttribPointer       = 0 ;   ///< Specify layout and location of a generic vertex attribute array
+PFNGLENABLEVERTEXATTRIBARRAYPROC    glEnableVertexAttribArray   = 0 ;   ///< Enable a generic vertex attribute array
+PFNGLDISABLEVERTEXATTRIBARRAYPROC   glDisableVertexAttribArray  = 0 ;   ///< Disable a generic vertex attribute array
+PFNGLVERTEXATTRIBDIVISORPROC        glVertexAttribDivisor       = 0 ;   ///< Advance a generic vertex attribute once per instance instead of once per vertex
+PFNGLDRAWARRAYSINSTANCEDARBPROC     glDrawArraysInstanced       = 0 ;   ///< Draw multiple instances of a range of vertices
+
+// Vertex array objects (OpenGL 3.0), used by vertex buffers to record their layout once
+PFNGLGENVERTEXARRAYSPROC     glGenVertexArrays      = 0 ;   ///< Create vertex array objects
+PFNGLBINDVERTEXARRAYPROC     glBindVertexArray      = 0 ;   ///< Select vertex array object that subsequent array pointers and draws use
+PFNGLDELETEVERTEXARRAYSPROC  glDeleteVertexArrays   = 0 ;   ///< Delete vertex array objects
+
+// 3D textures and multiple texture units (OpenGL 1.2 and 1.3), used by volume rendering
+PFNGLTEXIMAGE3DPROC          glTexImage3D           = 0 ;   ///< Allocate and fill a 3D texture
+PFNGLTEXSUBIMAGE3DPROC       glTexSubImage3D        = 0 ;   ///< Replace contents of part of a 3D texture
+PFNGLACTIVETEXTUREPROC       glActiveTexture        = 0 ;   ///< Select which texture unit subsequent texture commands affect
+
+// Compressed textures (OpenGL 1.3), used by block-compressed procedural textures
+PFNGLCOMPRESSEDTEXIMAGE2DPROC   glCompressedTexImage2D  = 0 ;   ///< Allocate and fill one MIP level of a compressed 2D texture
+PFNGLCOMPRESSEDTEXIMAGE3DPROC   glCompressedTexImage3D  = 0 ;   ///< Allocate and fill one MIP level of a compressed texture array or volume texture
+
+// Shader storage buffer objects and compute dispatch (OpenGL 4.3)
+PFNGLBINDBUFFERBASEPROC      glBindBufferBase       = 0 ;   ///< Bind buffer to indexed binding point, such as a shader storage block
+PFNGLBUFFERSUBDATAPROC       glBufferSubData        = 0 ;   ///< Copy data into part of a buffer
+PFNGLGETBUFFERSUBDATAPROC    glGetBufferSubData     = 0 ;   ///< Copy data from part of a buffer
+PFNGLDISPATCHCOMPUTEPROC     glDispatchCompute      = 0 ;   ///< Launch compute shader work groups
+PFNGLMEMORYBARRIERPROC       glMemoryBarrier        = 0 ;   ///< Order memory accesses between shader invocations and later commands
+PFNGLDISPATCHCOMPUTEINDIRECTPROC glDispatchComputeIndirect = 0 ;   ///< Launch compute shader work groups, reading how many from a buffer the GPU wrote
+
+// Indirect drawing (OpenGL 4.0), used to draw geometry whose size only the GPU knows
+PFNGLDRAWARRAYSINDIRECTPROC  glDrawArraysIndirect   = 0 ;   ///< Draw a range of vertices, reading which range from a buffer the GPU wrote
+
+// Persistently mapped buffers and fences (OpenGL 4.4)
+PFNGLBUFFERSTORAGEPROC       glBufferStorage        = 0 ;   ///< Allocate immutable buffer storage, which can stay mapped while the GPU uses it
+PFNGLMAPBUFFERRANGEPROC      glMapBufferRange       = 0 ;   ///< Map part of a buffer into CPU address space
+PFNGLFENCESYNCPROC           glFenceSync            = 0 ;   ///< Insert a fence that signals once preceding commands complete
+PFNGLCLIENTWAITSYNCPROC      glClientWaitSync       = 0 ;   ///< Wait on the CPU for a fence to signal
+PFNGLDELETESYNCPROC          glDeleteSync           = 0 ;   ///< Delete a fence
+
+// Occlusion queries (OpenGL 1.5) and timer queries (OpenGL 3.3), used by GPU timers
+PFNGLGENQUERIESPROC          glGenQueries           = 0 ;   ///< Create query objects
+PFNGLDELETEQUERIESPROC       glDeleteQueries        = 0 ;   ///< Delete query objects
+PFNGLGETQUERYOBJECTIVPROC    glGetQueryObjectiv     = 0 ;   ///< Get state of a query, such as whether its result is available
+PFNGLQUERYCOUNTERPROC        glQueryCounter         = 0 ;   ///< Record GPU time into a query once preceding commands complete
+PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v  = 0 ;   ///< Get 64-bit result of a query, such as a timestamp
+
 namespace PeGaSys {
     namespace Render {
         namespace OpenGL_Extensions {
@@ -120,6 +197,8 @@ namespace PeGaSys {
 
                 glDrawBuffersEXT                         = (PFNGLDRAWBUFFERSPROC                           ) wglGetProcAddress( "glDrawBuffers"                             ) ;
 
+                glBlitFramebufferEXT                     = (PFNGLBLITFRAMEBUFFEREXTPROC                    ) wglGetProcAddress( "glBlitFramebufferEXT"                      ) ;
+
                 glGenBuffers                             = (PFNGLGENBUFFERSARBPROC                      ) wglGetProcAddress( "glGenBuffers"                              ) ;
                 OpenGL_Api::CheckError( "GetProcAddresses_misc" ) ;
 
@@ -132,6 +211,80 @@ namespace PeGaSys {
                     glDeleteBuffers = (PFNGLDELETEBUFFERSARBPROC) wglGetProcAddress( "glDeleteBuffers" );
                     OpenGL_Api::CheckError( "GetProcAddresses_glGenBuffers" ) ;
                 }
+
+                glCreateShader          = (PFNGLCREATESHADERPROC      ) wglGetProcAddress( "glCreateShader"       ) ;
+                glShaderSource          = (PFNGLSHADERSOURCEPROC      ) wglGetProcAddress( "glShaderSource"       ) ;
+                glCompileShader         = (PFNGLCOMPILESHADERPROC     ) wglGetProcAddress( "glCompileShader"      ) ;
+                glGetShaderiv           = (PFNGLGETSHADERIVPROC       ) wglGetProcAddress( "glGetShaderiv"        ) ;
+                glGetShaderInfoLog      = (PFNGLGETSHADERINFOLOGPROC  ) wglGetProcAddress( "glGetShaderInfoLog"   ) ;
+                glDeleteShader          = (PFNGLDELETESHADERPROC      ) wglGetProcAddress( "glDeleteShader"       ) ;
+                glCreateProgram         = (PFNGLCREATEPROGRAMPROC     ) wglGetProcAddress( "glCreateProgram"      ) ;
+                glAttachShader          = (PFNGLATTACHSHADERPROC      ) wglGetProcAddress( "glAttachShader"       ) ;
+                glLinkProgram           = (PFNGLLINKPROGRAMPROC       ) wglGetProcAddress( "glLinkProgram"        ) ;
+                glGetProgramiv          = (PFNGLGETPROGRAMIVPROC      ) wglGetProcAddress( "glGetProgramiv"       ) ;
+                glGetProgramInfoLog     = (PFNGLGETPROGRAMINFOLOGPROC ) wglGetProcAddress( "glGetProgramInfoLog"  ) ;
+                glDeleteProgram         = (PFNGLDELETEPROGRAMPROC     ) wglGetProcAddress( "glDeleteProgram"      ) ;
+                glUseProgram            = (PFNGLUSEPROGRAMPROC        ) wglGetProcAddress( "glUseProgram"         ) ;
+                glGetUniformLocation    = (PFNGLGETUNIFORMLOCATIONPROC) wglGetProcAddress( "glGetUniformLocation" ) ;
+                glUniform1ui            = (PFNGLUNIFORM1UIPROC        ) wglGetProcAddress( "glUniform1ui"         ) ;
+                glUniform3ui            = (PFNGLUNIFORM3UIPROC        ) wglGetProcAddress( "glUniform3ui"         ) ;
+                glUniform1f             = (PFNGLUNIFORM1FPROC         ) wglGetProcAddress( "glUniform1f"          ) ;
+                glUniform3f             = (PFNGLUNIFORM3FPROC         ) wglGetProcAddress( "glUniform3f"          ) ;
+                glUniform4f             = (PFNGLUNIFORM4FPROC         ) wglGetProcAddress( "glUniform4f"          ) ;
+                glUniform1i             = (PFNGLUNIFORM1IPROC         ) wglGetProcAddress( "glUniform1i"          ) ;
+
+                glVertexAttribPointer       = (PFNGLVERTEXATTRIBPOINTERPROC     ) wglGetProcAddress( "glVertexAttribPointer"      ) ;
+                glEnableVertexAttribArray   = (PFNGLENABLEVERTEXATTRIBARRAYPROC ) wglGetProcAddress( "glEnableVertexAttribArray"  ) ;
+                glDisableVertexAttribArray  = (PFNGLDISABLEVERTEXATTRIBARRAYPROC) wglGetProcAddress( "glDisableVertexAttribArray" ) ;
+                glVertexAttribDivisor       = (PFNGLVERTEXATTRIBDIVISORPROC     ) wglGetProcAddress( "glVertexAttribDivisor"      ) ;  // Null unless driver supports OpenGL 3.3 or ARB_instanced_arrays.
+                glDrawArraysInstanced       = (PFNGLDRAWARRAYSINSTANCEDARBPROC  ) wglGetProcAddress( "glDrawArraysInstanced"      ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_instancing" ) ;
+
+                glGenVertexArrays       = (PFNGLGENVERTEXARRAYSPROC   ) wglGetProcAddress( "glGenVertexArrays"    ) ;  // Null unless driver supports OpenGL 3.0 or ARB_vertex_array_object.
+                glBindVertexArray       = (PFNGLBINDVERTEXARRAYPROC   ) wglGetProcAddress( "glBindVertexArray"    ) ;
+                glDeleteVertexArrays    = (PFNGLDELETEVERTEXARRAYSPROC) wglGetProcAddress( "glDeleteVertexArrays" ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_vertexArrayObject" ) ;
+
+                glTexImage3D            = (PFNGLTEXIMAGE3DPROC        ) wglGetProcAddress( "glTexImage3D"         ) ;
+                glTexSubImage3D         = (PFNGLTEXSUBIMAGE3DPROC     ) wglGetProcAddress( "glTexSubImage3D"      ) ;
+                glActiveTexture         = (PFNGLACTIVETEXTUREPROC     ) wglGetProcAddress( "glActiveTexture"      ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_texture3D" ) ;
+
+                glCompressedTexImage2D  = (PFNGLCOMPRESSEDTEXIMAGE2DPROC) wglGetProcAddress( "glCompressedTexImage2D" ) ;
+                glCompressedTexImage3D  = (PFNGLCOMPRESSEDTEXIMAGE3DPROC) wglGetProcAddress( "glCompressedTexImage3D" ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_textureCompression" ) ;
+
+                glBindBufferBase        = (PFNGLBINDBUFFERBASEPROC    ) wglGetProcAddress( "glBindBufferBase"     ) ;
+                glBufferSubData         = (PFNGLBUFFERSUBDATAPROC     ) wglGetProcAddress( "glBufferSubData"      ) ;
+                glGetBufferSubData      = (PFNGLGETBUFFERSUBDATAPROC  ) wglGetProcAddress( "glGetBufferSubData"   ) ;
+                glDispatchCompute       = (PFNGLDISPATCHCOMPUTEPROC   ) wglGetProcAddress( "glDispatchCompute"    ) ;  // Null unless driver supports OpenGL 4.3 or ARB_compute_shader.
+                glMemoryBarrier         = (PFNGLMEMORYBARRIERPROC     ) wglGetProcAddress( "glMemoryBarrier"      ) ;
+                glDispatchComputeIndirect = (PFNGLDISPATCHCOMPUTEINDIRECTPROC) wglGetProcAddress( "glDispatchComputeIndirect" ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_compute" ) ;
+
+                glDrawArraysIndirect    = (PFNGLDRAWARRAYSINDIRECTPROC) wglGetProcAddress( "glDrawArraysIndirect" ) ;  // Null unless driver supports OpenGL 4.0 or ARB_draw_indirect.
+                OpenGL_Api::CheckError( "GetProcAddresses_drawIndirect" ) ;
+
+                glBufferStorage         = (PFNGLBUFFERSTORAGEPROC     ) wglGetProcAddress( "glBufferStorage"      ) ;  // Null unless driver supports OpenGL 4.4 or ARB_buffer_storage.
+                glMapBufferRange        = (PFNGLMAPBUFFERRANGEPROC    ) wglGetProcAddress( "glMapBufferRange"     ) ;
+                glFenceSync             = (PFNGLFENCESYNCPROC         ) wglGetProcAddress( "glFenceSync"          ) ;
+                glClientWaitSync        = (PFNGLCLIENTWAITSYNCPROC    ) wglGetProcAddress( "glClientWaitSync"     ) ;
+                glDeleteSync            = (PFNGLDELETESYNCPROC        ) wglGetProcAddress( "glDeleteSync"         ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_bufferStorage" ) ;
+
+                glGenQueries            = (PFNGLGENQUERIESPROC        ) wglGetProcAddress( "glGenQueries"         ) ;
+                glDeleteQueries         = (PFNGLDELETEQUERIESPROC     ) wglGetProcAddress( "glDeleteQueries"      ) ;
+                glGetQueryObjectiv      = (PFNGLGETQUERYOBJECTIVPROC  ) wglGetProcAddress( "glGetQueryObjectiv"   ) ;
+                glQueryCounter          = (PFNGLQUERYCOUNTERPROC      ) wglGetProcAddress( "glQueryCounter"       ) ;  // Null unless driver supports OpenGL 3.3 or ARB_timer_query.
+                glGetQueryObjectui64v   = (PFNGLGETQUERYOBJECTUI64VPROC) wglGetProcAddress( "glGetQueryObjectui64v" ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_timerQuery" ) ;
+
+                glBlendFunci            = (PFNGLBLENDFUNCIARBPROC        ) wglGetProcAddress( "glBlendFunci"         ) ;  // Null unless driver supports OpenGL 4.0 or ARB_draw_buffers_blend.
+                glBlendFuncSeparatei    = (PFNGLBLENDFUNCSEPARATEIARBPROC) wglGetProcAddress( "glBlendFuncSeparatei" ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_drawBuffersBlend" ) ;
+
+                glBlendFuncSeparate     = (PFNGLBLENDFUNCSEPARATEPROC ) wglGetProcAddress( "glBlendFuncSeparate"  ) ;
+                OpenGL_Api::CheckError( "GetProcAddresses_blendFuncSeparate" ) ;
             }
 
 
@@ -42,6 +42,91 @@
 
 #endif
 
+#ifndef GL_VERSION_4_3
+
+    #define GL_COMPUTE_SHADER                             0x91B9
+    #define GL_SHADER_STORAGE_BUFFER                      0x90D2
+    #define GL_SHADER_STORAGE_BARRIER_BIT                 0x00002000
+    #define GL_BUFFER_UPDATE_BARRIER_BIT                  0x00000200
+    #define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT            0x00000001
+    #define GL_COMMAND_BARRIER_BIT                        0x00000040
+    #define GL_DISPATCH_INDIRECT_BUFFER                   0x90EE
+
+    typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC) (GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+    typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEINDIRECTPROC) (GLintptr indirect);
+    typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC) (GLbitfield barriers);
+
+#endif
+
+#ifndef GL_ARB_draw_indirect
+
+    #define GL_DRAW_INDIRECT_BUFFER                       0x8F3F
+
+    typedef void (APIENTRYP PFNGLDRAWARRAYSINDIRECTPROC) (GLenum mode, const void *indirect);
+
+#endif
+
+#ifndef GL_ARB_sync
+
+    #define GL_SYNC_GPU_COMMANDS_COMPLETE                 0x9117
+    #define GL_ALREADY_SIGNALED                           0x911A
+    #define GL_TIMEOUT_EXPIRED                            0x911B
+    #define GL_CONDITION_SATISFIED                        0x911C
+    #define GL_WAIT_FAILED                                0x911D
+    #define GL_SYNC_FLUSH_COMMANDS_BIT                    0x00000001
+
+    typedef struct __GLsync * GLsync ;
+    typedef GLuint64EXT GLuint64 ;
+
+    typedef GLsync (APIENTRYP PFNGLFENCESYNCPROC) (GLenum condition, GLbitfield flags);
+    typedef GLenum (APIENTRYP PFNGLCLIENTWAITSYNCPROC) (GLsync sync, GLbitfield flags, GLuint64 timeout);
+    typedef void (APIENTRYP PFNGLDELETESYNCPROC) (GLsync sync);
+
+#endif
+
+#ifndef GL_ARB_timer_query
+
+    #define GL_TIMESTAMP                                  0x8E28
+
+    typedef void (APIENTRYP PFNGLQUERYCOUNTERPROC) (GLuint id, GLenum target);
+    typedef void (APIENTRYP PFNGLGETQUERYOBJECTUI64VPROC) (GLuint id, GLenum pname, GLuint64 *params);
+
+#endif
+
+#ifndef GL_ARB_buffer_storage
+
+    #define GL_MAP_PERSISTENT_BIT                         0x0040
+    #define GL_MAP_COHERENT_BIT                           0x0080
+
+    typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+#endif
+
+#ifndef GL_ARB_uniform_buffer_object
+
+    #define GL_UNIFORM_BUFFER                             0x8A11
+
+#endif
+
+#ifndef GL_ARB_texture_compression_bptc
+
+    #define GL_COMPRESSED_RGBA_BPTC_UNORM                 0x8E8C
+
+#endif
+
+#ifndef GL_ARB_texture_swizzle
+
+    #define GL_TEXTURE_SWIZZLE_RGBA                       0x8E46
+
+#endif
+
+#ifndef GL_ARB_draw_buffers_blend
+
+    typedef void (APIENTRYP PFNGLBLENDFUNCIARBPROC) (GLuint buf, GLenum src, GLenum dst);
+    typedef void (APIENTRYP PFNGLBLENDFUNCSEPARATEIARBPROC) (GLuint buf, GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha);
+
+#endif
+
 typedef void (APIENTRYP PFNGLDEBUGMESSAGECONTROLARBPROC) (unsigned int source, unsigned int type, unsigned int severity, int count, const unsigned int* ids, bool enabled);
 typedef void (APIENTRYP PFNGLDEBUGMESSAGEINSERTARBPROC) (unsigned int source, unsigned int type,  unsigned int id, unsigned int severity, int length, const char* buf);
 typedef void (APIENTRY *GLDEBUGPROCARB)(unsigned int source, unsigned int type, unsigned int id,  unsigned int severity, int length, const char* message, void* userParam);
@@ -90,6 +175,15 @@ extern PFNGLFRAMEBUFFERTEXTUREEXTPROC                   glFramebufferTextureEXT
 
 extern PFNGLDRAWBUFFERSPROC                             glDrawBuffersEXT                         ;
 
+extern PFNGLBLITFRAMEBUFFEREXTPROC                      glBlitFramebufferEXT                     ; // Copy a rectangle of pixels between framebuffers, such as depth into an offscreen framebuffer
+
+// Per-draw-buffer blending (OpenGL 4.0), used by order-independent transparency
+extern PFNGLBLENDFUNCIARBPROC                           glBlendFunci                            ;   ///< Set blend factors of one draw buffer
+extern PFNGLBLENDFUNCSEPARATEIARBPROC                   glBlendFuncSeparatei                    ;   ///< Set separate color and alpha blend factors of one draw buffer
+
+// Separate color and alpha blending (OpenGL 1.4), used by offscreen targets that later composite with premultiplied alpha
+extern PFNGLBLENDFUNCSEPARATEPROC                       glBlendFuncSeparate                     ;   ///< Set separate color and alpha blend factors of all draw buffers
+
 // VBO Extension Function Pointers
 extern PFNGLGENBUFFERSARBPROC                           glGenBuffers                            ;   ///< VBO Name Generation Procedure
 extern PFNGLMAPBUFFERARBPROC                            glMapBuffer                             ;   ///< VBO Map Buffer procedure
@@ -98,4 +192,72 @@ extern PFNGLBINDBUFFERARBPROC                           glBindBuffer
 extern PFNGLBUFFERDATAARBPROC                           glBufferData                            ;   ///< VBO Data Loading Procedure
 extern PFNGLDELETEBUFFERSARBPROC                        glDeleteBuffers                         ;   ///< VBO Deletion Procedure
 
+// Shader objects, used by compute shaders
+extern PFNGLCREATESHADERPROC                            glCreateShader                          ;
+extern PFNGLSHADERSOURCEPROC                            glShaderSource                          ;
+extern PFNGLCOMPILESHADERPROC                           glCompileShader                         ;
+extern PFNGLGETSHADERIVPROC                             glGetShaderiv                           ;
+extern PFNGLGETSHADERINFOLOGPROC                        glGetShaderInfoLog                      ;
+extern PFNGLDELETESHADERPROC                            glDeleteShader                          ;
+extern PFNGLCREATEPROGRAMPROC                           glCreateProgram                         ;
+extern PFNGLATTACHSHADERPROC                            glAttachShader                          ;
+extern PFNGLLINKPROGRAMPROC                             glLinkProgram                           ;
+extern PFNGLGETPROGRAMIVPROC                            glGetProgramiv                          ;
+extern PFNGLGETPROGRAMINFOLOGPROC                       glGetProgramInfoLog                     ;
+extern PFNGLDELETEPROGRAMPROC                           glDeleteProgram                         ;
+extern PFNGLUSEPROGRAMPROC                              glUseProgram                            ;
+extern PFNGLGETUNIFORMLOCATIONPROC                      glGetUniformLocation                    ;
+extern PFNGLUNIFORM1UIPROC                              glUniform1ui                            ;
+extern PFNGLUNIFORM3UIPROC                              glUniform3ui                            ;
+extern PFNGLUNIFORM1FPROC                               glUniform1f                             ;
+extern PFNGLUNIFORM3FPROC                               glUniform3f                             ;
+extern PFNGLUNIFORM4FPROC                               glUniform4f                             ;
+extern PFNGLUNIFORM1IPROC                               glUniform1i                             ;   ///< Assign integer uniform, such as which texture unit a sampler reads
+
+// Generic vertex attributes and instanced drawing (OpenGL 3.3), used by vertex shaders
+extern PFNGLVERTEXATTRIBPOINTERPROC                     glVertexAttribPointer                   ;   ///< Specify layout and location of a generic vertex attribute array
+extern PFNGLENABLEVERTEXATTRIBARRAYPROC                 glEnableVertexAttribArray               ;   ///< Enable a generic vertex attribute array
+extern PFNGLDISABLEVERTEXATTRIBARRAYPROC                glDisableVertexAttribArray              ;   ///< Disable a generic vertex attribute array
+extern PFNGLVERTEXATTRIBDIVISORPROC                     glVertexAttribDivisor                   ;   ///< Advance a generic vertex attribute once per instance instead of once per vertex
+extern PFNGLDRAWARRAYSINSTANCEDARBPROC                  glDrawArraysInstanced                   ;   ///< Draw multiple instances of a range of vertices
+
+// Vertex array objects (OpenGL 3.0), used by vertex buffers to record their layout once
+extern PFNGLGENVERTEXARRAYSPROC                         glGenVertexArrays                       ;   ///< Create vertex array objects
+extern PFNGLBINDVERTEXARRAYPROC                         glBindVertexArray                       ;   ///< Select vertex array object that subsequent array pointers and draws use
+extern PFNGLDELETEVERTEXARRAYSPROC                      glDeleteVertexArrays                    ;   ///< Delete vertex array objects
+
+// 3D textures and multiple texture units (OpenGL 1.2 and 1.3), used by volume rendering
+extern PFNGLTEXIMAGE3DPROC                              glTexImage3D                            ;   ///< Allocate and fill a 3D texture
+extern PFNGLTEXSUBIMAGE3DPROC                           glTexSubImage3D                         ;   ///< Replace contents of part of a 3D texture
+extern PFNGLACTIVETEXTUREPROC                           glActiveTexture                         ;   ///< Select which texture unit subsequent texture commands affect
+
+// Compressed textures (OpenGL 1.3), used by block-compressed procedural textures
+extern PFNGLCOMPRESSEDTEXIMAGE2DPROC                    glCompressedTexImage2D                  ;   ///< Allocate and fill one MIP level of a compressed 2D texture
+extern PFNGLCOMPRESSEDTEXIMAGE3DPROC                    glCompressedTexImage3D                  ;   ///< Allocate and fill one MIP level of a compressed texture array or volume texture
+
+// Shader storage buffer objects and compute dispatch (OpenGL 4.3)
+extern PFNGLBINDBUFFERBASEPROC                          glBindBufferBase                        ;   ///< Bind buffer to indexed binding point, such as a shader storage block
+extern PFNGLBUFFERSUBDATAPROC                           glBufferSubData                         ;   ///< Copy data into part of a buffer
+extern PFNGLGETBUFFERSUBDATAPROC                        glGetBufferSubData                      ;   ///< Copy data from part of a buffer
+extern PFNGLDISPATCHCOMPUTEPROC                         glDispatchCompute                       ;   ///< Launch compute shader work groups
+extern PFNGLMEMORYBARRIERPROC                           glMemoryBarrier                         ;   ///< Order memory accesses between shader invocations and later commands
+extern PFNGLDISPATCHCOMPUTEINDIRECTPROC                 glDispatchComputeIndirect               ;   ///< Launch compute shader work groups, reading how many from a buffer the GPU wrote
+
+// Indirect drawing (OpenGL 4.0), used to draw geometry whose size only the GPU knows
+extern PFNGLDRAWARRAYSINDIRECTPROC                      glDrawArraysIndirect                    ;   ///< Draw a range of vertices, reading which range from a buffer the GPU wrote
+
+// Persistently mapped buffers and fences (OpenGL 4.4)
+extern PFNGLBUFFERSTORAGEPROC                           glBufferStorage                         ;   ///< Allocate immutable buffer storage, which can stay mapped while the GPU uses it
+extern PFNGLMAPBUFFERRANGEPROC                          glMapBufferRange                        ;   ///< Map part of a buffer into CPU address space
+extern PFNGLFENCESYNCPROC                               glFenceSync                             ;   ///< Insert a fence that signals once preceding commands complete
+extern PFNGLCLIENTWAITSYNCPROC                          glClientWaitSync                        ;   ///< Wait on the CPU for a fence to signal
+extern PFNGLDELETESYNCPROC                              glDeleteSync                            ;   ///< Delete a fence
+
+// Occlusion queries (OpenGL 1.5) and timer queries (OpenGL 3.3), used by GPU timers
+extern PFNGLGENQUERIESPROC                              glGenQueries                            ;   ///< Create query objects
+extern PFNGLDELETEQUERIESPROC                           glDeleteQueries                         ;   ///< Delete query objects
+extern PFNGLGETQUERYOBJECTIVPROC                        glGetQueryObjectiv                      ;   ///< Get state of a query, such as whether its result is available
+extern PFNGLQUERYCOUNTERPROC                            glQueryCounter                          ;   ///< Record GPU time into a query once preceding commands complete
+extern PFNGLGETQUERYOBJECTUI64VPROC                     glGetQueryObjectui64v                   ;   ///< Get 64-bit result of a query, such as a timestamp
+
 #endif
@@ -0,0 +1,257 @@
+/** \file OpenGL_frameReadback.cpp
+
+    \brief Ring of pixel buffer objects that read back rendered frames without stalling the GPU.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_frameReadback.h"
+
+#include "Render/Platform/OpenGL/OpenGL_api.h" // For RENDER_CHECK_ERROR
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+#include "glExt.h"
+
+#include <string.h>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct frame readback ring.
+
+            This does not create pixel buffers; the first Request does, since that requires a current OpenGL context.
+        */
+        OpenGL_FrameReadback::OpenGL_FrameReadback()
+            : mNextRequest( 0 )
+            , mNumPending( 0 )
+            , mUsePixelBuffers( -1 )
+        {
+            PERF_BLOCK( OpenGL_FrameReadback__OpenGL_FrameReadback ) ;
+
+            for( size_t iSlot = 0 ; iSlot < sNumBuffers ; ++ iSlot )
+            {
+                Slot & slot = mSlots[ iSlot ] ;
+                slot.mBufferName    = 0 ;
+                slot.mCapacity      = 0 ;
+                slot.mFence         = 0 ;
+                slot.mWidth         = 0 ;
+                slot.mHeight        = 0 ;
+                slot.mFrameIndex    = 0 ;
+            }
+        }
+
+
+
+
+        /** Destruct frame readback ring, discarding frames not yet collected.
+
+            The OpenGL context that the first Request used must still be current.
+        */
+        OpenGL_FrameReadback::~OpenGL_FrameReadback()
+        {
+            PERF_BLOCK( OpenGL_FrameReadback__dtor ) ;
+
+            for( size_t iSlot = 0 ; iSlot < sNumBuffers ; ++ iSlot )
+            {
+                Slot & slot = mSlots[ iSlot ] ;
+                if( slot.mFence )
+                {
+                    glDeleteSync( slot.mFence ) ;
+                }
+                if( slot.mBufferName )
+                {
+                    glDeleteBuffers( 1 , & slot.mBufferName ) ;
+                }
+            }
+        }
+
+
+
+
+        /** Create pixel buffers, if the driver supports them and fences.
+
+            \return Whether this uses pixel buffers.
+        */
+        bool OpenGL_FrameReadback::InitializeBuffers()
+        {
+            if( mUsePixelBuffers < 0 )
+            {   // First call.  Query driver.
+                mUsePixelBuffers =      glGenBuffers && glBindBuffer && glBufferData && glMapBuffer && glUnmapBuffer && glDeleteBuffers
+                                    &&  glFenceSync && glClientWaitSync && glDeleteSync
+                                    &&  OpenGL_Extensions::IsExtensionSupported( "GL_ARB_pixel_buffer_object" ) ;
+                if( mUsePixelBuffers )
+                {
+                    for( size_t iSlot = 0 ; iSlot < sNumBuffers ; ++ iSlot )
+                    {
+                        glGenBuffers( 1 , & mSlots[ iSlot ].mBufferName ) ;
+                    }
+                }
+            }
+            return mUsePixelBuffers != 0 ;
+        }
+
+
+
+
+        /** Start reading back the given region of the frame buffer.
+
+            \param x, y             Lower-left corner of region, in pixels.
+
+            \param width, height    Size of region, in pixels.
+
+            \param frameIndex       Value for Collect to return along with this frame, so caller can tell frames apart.
+
+            \return Whether the ring had room for this frame.  If not, the caller should Collect first.
+
+            Frames arrive in OpenGL row order: the first row is the bottom of the region.
+        */
+        bool OpenGL_FrameReadback::Request( int x , int y , int width , int height , unsigned frameIndex )
+        {
+            PERF_BLOCK( OpenGL_FrameReadback__Request ) ;
+
+            ASSERT( ( width > 0 ) && ( height > 0 ) ) ;
+
+            if( mNumPending >= sNumBuffers )
+            {   // Every slot holds a frame not yet collected.
+                return false ;
+            }
+
+            Slot & slot = mSlots[ mNextRequest ] ;
+            slot.mWidth         = width ;
+            slot.mHeight        = height ;
+            slot.mFrameIndex    = frameIndex ;
+
+            glPixelStorei( GL_PACK_ALIGNMENT , 1 ) ;  // pixel data rows not padded
+
+            if( InitializeBuffers() )
+            {   // Copy asynchronously into pixel buffer.
+                const size_t sizeInBytes = static_cast< size_t >( width ) * height * 4 ;
+                glBindBuffer( GL_PIXEL_PACK_BUFFER , slot.mBufferName ) ;
+                if( slot.mCapacity != sizeInBytes )
+                {   // Frame size changed (or this is the first use), so reallocate buffer.
+                    glBufferData( GL_PIXEL_PACK_BUFFER , sizeInBytes , NULLPTR , GL_STREAM_READ ) ;
+                    slot.mCapacity = sizeInBytes ;
+                }
+                glReadPixels( x , y , width , height , GL_RGBA , GL_UNSIGNED_BYTE , /* offset into pixel buffer */ NULLPTR ) ;
+                glBindBuffer( GL_PIXEL_PACK_BUFFER , 0 ) ;
+                ASSERT( 0 == slot.mFence ) ;
+                slot.mFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE , 0 ) ;
+            }
+            else
+            {   // Copy synchronously.
+                if( ( slot.mSyncImage.GetWidth() != unsigned( width ) ) || ( slot.mSyncImage.GetHeight() != unsigned( height ) ) )
+                {
+                    Image frameShape( width , height , 4 , 1 ) ;
+                    slot.mSyncImage.CopyShape( frameShape ) ;
+                }
+                glReadPixels( x , y , width , height , GL_RGBA , GL_UNSIGNED_BYTE , slot.mSyncImage.GetImageData() ) ;
+            }
+
+            mNextRequest = ( mNextRequest + 1 ) % sNumBuffers ;
+            ++ mNumPending ;
+
+            RENDER_CHECK_ERROR( OpenGL_FrameReadback__Request ) ;
+            return true ;
+        }
+
+
+
+
+        /** Return whether the GPU has finished reading back into the given slot.
+
+            \param wait Whether to wait for the GPU, if it has not finished.
+        */
+        bool OpenGL_FrameReadback::IsSlotReady( Slot & slot , bool wait )
+        {
+            if( 0 == slot.mFence )
+            {   // Slot was read synchronously.
+                return true ;
+            }
+
+            static const GLuint64 timeoutNanoseconds = 1000000 ; // 1 millisecond
+            GLenum waitResult = glClientWaitSync( slot.mFence , GL_SYNC_FLUSH_COMMANDS_BIT , 0 ) ;
+            while( wait && ( GL_TIMEOUT_EXPIRED == waitResult ) )
+            {   // GPU has not yet finished, and caller wants to wait.
+                waitResult = glClientWaitSync( slot.mFence , GL_SYNC_FLUSH_COMMANDS_BIT , timeoutNanoseconds ) ;
+            }
+            if( GL_TIMEOUT_EXPIRED == waitResult )
+            {   // GPU has not yet finished.
+                return false ;
+            }
+            ASSERT( GL_WAIT_FAILED != waitResult ) ;
+            glDeleteSync( slot.mFence ) ;
+            slot.mFence = 0 ;
+            return true ;
+        }
+
+
+
+
+        /** Obtain the oldest requested frame, if the GPU has finished reading it back.
+
+            \param image        (out) Frame, as a 4-channel RGBA image in OpenGL row order.
+                                This reshapes it if its shape differs from that of the frame.
+
+            \param frameIndex   (out) Value passed to Request for this frame.
+
+            \param wait         Whether to wait for the GPU if it has not finished.  Use this to flush the ring.
+
+            \return Whether this obtained a frame.
+        */
+        bool OpenGL_FrameReadback::Collect( Image & image , unsigned & frameIndex , bool wait )
+        {
+            PERF_BLOCK( OpenGL_FrameReadback__Collect ) ;
+
+            if( 0 == mNumPending )
+            {   // No frames in flight.
+                return false ;
+            }
+
+            const size_t    oldest  = ( mNextRequest + sNumBuffers - mNumPending ) % sNumBuffers ;
+            Slot &          slot    = mSlots[ oldest ] ;
+            if( ! IsSlotReady( slot , wait ) )
+            {
+                return false ;
+            }
+
+            if( ( image.GetWidth() != unsigned( slot.mWidth ) ) || ( image.GetHeight() != unsigned( slot.mHeight ) ) || ( image.GetNumChannels() != 4 ) || ( image.GetNumPages() != 1 ) )
+            {   // Image has a different shape than frame.
+                Image frameShape( slot.mWidth , slot.mHeight , 4 , 1 ) ;
+                image.CopyShape( frameShape ) ;
+            }
+
+            const size_t sizeInBytes = static_cast< size_t >( slot.mWidth ) * slot.mHeight * 4 ;
+            if( slot.mBufferName )
+            {   // Frame is in pixel buffer.
+                glBindBuffer( GL_PIXEL_PACK_BUFFER , slot.mBufferName ) ;
+                const void * pixels = glMapBuffer( GL_PIXEL_PACK_BUFFER , GL_READ_ONLY ) ;
+                ASSERT( pixels ) ;
+                if( pixels )
+                {
+                    memcpy( image.GetImageData() , pixels , sizeInBytes ) ;
+                    glUnmapBuffer( GL_PIXEL_PACK_BUFFER ) ;
+                }
+                glBindBuffer( GL_PIXEL_PACK_BUFFER , 0 ) ;
+            }
+            else
+            {   // Frame was read synchronously.
+                memcpy( image.GetImageData() , slot.mSyncImage.GetImageData() , sizeInBytes ) ;
+            }
+
+            frameIndex = slot.mFrameIndex ;
+            -- mNumPending ;
+
+            RENDER_CHECK_ERROR( OpenGL_FrameReadback__Collect ) ;
+            return true ;
+        }
+
+    } ;
+} ;
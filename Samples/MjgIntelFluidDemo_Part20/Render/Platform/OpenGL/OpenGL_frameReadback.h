@@ -0,0 +1,94 @@
+/** \file OpenGL_frameReadback.h
+
+    \brief Ring of pixel buffer objects that read back rendered frames without stalling the GPU.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_FRAME_READBACK_H
+#define PEGASYS_RENDER_OPENGL_FRAME_READBACK_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+
+#include <Image/image.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Ring of pixel buffer objects that read back rendered frames without stalling the GPU.
+
+            glReadPixels into client memory waits for the GPU to finish
+            rendering, then copies, before returning, so capturing every
+            frame that way serializes the CPU and GPU.  Instead, Request
+            starts an asynchronous copy of the frame buffer into the next
+            pixel buffer object in a ring, and fences it.  Collect later
+            returns the oldest frame whose fence has signaled, so by the time
+            the CPU maps a buffer, the GPU has long since filled it.
+
+            A frame therefore arrives a few calls after its Request.  Call
+            Request after rendering each frame you want, before swapping
+            buffers, and Collect at any time after that; pass completed
+            images to a background writer, so encoding also stays off the
+            render thread.
+
+            Without pixel buffer objects or fences, Request reads pixels
+            synchronously, and Collect returns them on the next call, so
+            callers behave the same either way.
+        */
+        class OpenGL_FrameReadback
+        {
+            public:
+                /// Number of pixel buffers in ring: how many frames can be in flight between Request and Collect.
+                static const size_t sNumBuffers = 3 ;
+
+                OpenGL_FrameReadback() ;
+                ~OpenGL_FrameReadback() ;
+
+                bool    Request( int x , int y , int width , int height , unsigned frameIndex ) ;
+                bool    Collect( Image & image , unsigned & frameIndex , bool wait = false ) ;
+
+                /// Return number of frames requested but not yet collected.
+                size_t  GetNumPending() const { return mNumPending ; }
+
+            private:
+                /** Pixel buffer that receives one frame.
+                */
+                struct Slot
+                {
+                    GLuint      mBufferName     ;   ///< Pixel buffer object identifier, or 0 if not using pixel buffer objects.
+                    size_t      mCapacity       ;   ///< Number of bytes pixel buffer can hold.
+                    GLsync      mFence          ;   ///< Fence that signals once glReadPixels into this buffer completes, or NULL.
+                    int         mWidth          ;   ///< Width, in pixels, of frame this holds.
+                    int         mHeight         ;   ///< Height, in pixels, of frame this holds.
+                    unsigned    mFrameIndex     ;   ///< Caller-supplied index of frame this holds.
+                    Image       mSyncImage      ;   ///< Frame read synchronously, when not using pixel buffer objects.
+                } ;
+
+                OpenGL_FrameReadback( const OpenGL_FrameReadback & ) ;              // Disallow copy
+                OpenGL_FrameReadback & operator=( const OpenGL_FrameReadback & ) ;  // Disallow assignment
+
+                bool    InitializeBuffers() ;
+                bool    IsSlotReady( Slot & slot , bool wait ) ;
+
+                Slot    mSlots[ sNumBuffers ]   ;   ///< Ring of pixel buffers.
+                size_t  mNextRequest            ;   ///< Index of slot that the next Request fills.
+                size_t  mNumPending             ;   ///< Number of slots holding frames not yet collected.  The oldest is at ( mNextRequest - mNumPending ) mod sNumBuffers.
+                int     mUsePixelBuffers        ;   ///< Whether driver supports pixel buffers and fences: 1 for yes, 0 for no, -1 for not yet queried.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -0,0 +1,118 @@
+/** \file OpenGL_gpuTimer.cpp
+
+    \brief Measure durations of GPU render passes with OpenGL timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_gpuTimer.h"
+
+#include "Render/Platform/OpenGL/OpenGL_extensions.h"
+#include "Render/Platform/OpenGL/OpenGL_api.h" // For RENDER_CHECK_ERROR
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+#include <string.h>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct OpenGL GPU timer.
+
+            This does not create queries; the first BeginFrame does, since that requires a current OpenGL context.
+        */
+        OpenGL_GpuTimer::OpenGL_GpuTimer()
+        {
+            PERF_BLOCK( OpenGL_GpuTimer__OpenGL_GpuTimer ) ;
+
+            memset( mQueryNames , 0 , sizeof( mQueryNames ) ) ;
+        }
+
+
+
+
+        /** Destruct OpenGL GPU timer.
+
+            The OpenGL context that the first BeginFrame used must still be current.
+        */
+        OpenGL_GpuTimer::~OpenGL_GpuTimer()
+        {
+            PERF_BLOCK( OpenGL_GpuTimer__dtor ) ;
+
+            if( mQueryNames[ 0 ][ 0 ] )
+            {
+                glDeleteQueries( GLsizei( sNumFramesInFlight * sNumQueriesPerFrame ) , & mQueryNames[ 0 ][ 0 ] ) ;
+            }
+        }
+
+
+
+
+        /** Create timestamp queries, if the driver supports them.
+
+            \return Whether this uses timestamp queries.
+        */
+        /* virtual */ bool OpenGL_GpuTimer::CreateQueries()
+        {
+            PERF_BLOCK( OpenGL_GpuTimer__CreateQueries ) ;
+
+            const bool hasTimerQueries = glGenQueries && glDeleteQueries && glGetQueryObjectiv && glQueryCounter && glGetQueryObjectui64v ;
+            if( hasTimerQueries )
+            {
+                glGenQueries( GLsizei( sNumFramesInFlight * sNumQueriesPerFrame ) , & mQueryNames[ 0 ][ 0 ] ) ;
+                RENDER_CHECK_ERROR( OpenGL_GpuTimer_CreateQueries ) ;
+            }
+            return hasTimerQueries ;
+        }
+
+
+
+
+        /** Record GPU time into the given query once the GPU has executed all previously issued commands.
+        */
+        /* virtual */ void OpenGL_GpuTimer::IssueTimestamp( size_t iFrame , size_t iQuery )
+        {
+            ASSERT( ( iFrame < sNumFramesInFlight ) && ( iQuery < sNumQueriesPerFrame ) ) ;
+            glQueryCounter( mQueryNames[ iFrame ][ iQuery ] , GL_TIMESTAMP ) ;
+        }
+
+
+
+
+        /** Read timestamps of the given frame, if the GPU has executed all of its queries.
+
+            Queries complete in the order issued, so this only polls the last.
+        */
+        /* virtual */ GpuTimerBase::ResultE OpenGL_GpuTimer::ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond )
+        {
+            PERF_BLOCK( OpenGL_GpuTimer__ReadResults ) ;
+
+            ASSERT( ( iFrame < sNumFramesInFlight ) && ( numQueries > 0 ) && ( numQueries <= sNumQueriesPerFrame ) ) ;
+
+            GLint isAvailable = 0 ;
+            glGetQueryObjectiv( mQueryNames[ iFrame ][ numQueries - 1 ] , GL_QUERY_RESULT_AVAILABLE , & isAvailable ) ;
+            if( ! isAvailable )
+            {
+                return RESULT_NOT_READY ;
+            }
+
+            for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+            {
+                GLuint64 timestamp = 0 ;
+                glGetQueryObjectui64v( mQueryNames[ iFrame ][ iQuery ] , GL_QUERY_RESULT , & timestamp ) ;
+                timestamps[ iQuery ] = timestamp ;
+            }
+            gpuTicksPerSecond = 1000000000 ; // OpenGL timestamps are in nanoseconds.
+            RENDER_CHECK_ERROR( OpenGL_GpuTimer_ReadResults ) ;
+            return RESULT_READY ;
+        }
+
+    } ;
+} ;
@@ -0,0 +1,53 @@
+/** \file OpenGL_gpuTimer.h
+
+    \brief Measure durations of GPU render passes with OpenGL timestamp queries.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_GPU_TIMER_H
+#define PEGASYS_RENDER_OPENGL_GPU_TIMER_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Device/gpuTimer.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Measure durations of GPU render passes with OpenGL timestamp queries.
+
+            This uses glQueryCounter with GL_TIMESTAMP, from OpenGL 3.3 or
+            ARB_timer_query, and polls GL_QUERY_RESULT_AVAILABLE so reading
+            results never stalls.  Timestamps are in nanoseconds.  Without
+            timer queries, this measures nothing.
+        */
+        class OpenGL_GpuTimer : public GpuTimerBase
+        {
+            public:
+                OpenGL_GpuTimer() ;
+                virtual ~OpenGL_GpuTimer() ;
+
+            protected:
+                virtual bool    CreateQueries() ;
+                virtual void    IssueTimestamp( size_t iFrame , size_t iQuery ) ;
+                virtual ResultE ReadResults( size_t iFrame , size_t numQueries , ULONGLONG * timestamps , ULONGLONG & gpuTicksPerSecond ) ;
+
+            private:
+                GLuint  mQueryNames[ sNumFramesInFlight ][ sNumQueriesPerFrame ] ;  ///< Timestamp query object identifiers, or 0 if not yet created.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
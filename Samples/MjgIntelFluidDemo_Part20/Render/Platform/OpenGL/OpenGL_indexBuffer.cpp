@@ -60,6 +60,7 @@ namespace PeGaSys {
 
             mNumIndices = numIndices ;
             mIndexType = indexType ;
+            SetCapacity( numIndices ) ;
 
             if( INDEX_TYPE_16 == indexType )
             {
@@ -83,8 +84,18 @@ namespace PeGaSys {
         {
             PERF_BLOCK( OpenGL_IndexBuffer__Clear ) ;
 
-            delete GetIndicesWord() ;
-            mIndexData = NULLPTR ;
+            // Delete through the type Allocate used.  (GetIndicesWord would assert for 32-bit indices.)
+            if( INDEX_TYPE_16 == mIndexType )
+            {
+                delete [] static_cast< WORD * >( mIndexData ) ;
+            }
+            else
+            {
+                delete [] static_cast< int * >( mIndexData ) ;
+            }
+            mIndexData  = NULLPTR ;
+            mNumIndices = 0 ;
+            SetCapacity( 0 ) ;
         }
 
 
@@ -0,0 +1,505 @@
+/** \file OpenGL_lighting.cpp
+
+    \brief Shader-based lighting for OpenGL, whose lights and materials reside in uniform buffers.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_lighting.h"
+
+#include "Render/Platform/OpenGL/OpenGL_api.h" // For RENDER_CHECK_ERROR
+#include "Render/Platform/OpenGL/OpenGL_extensions.h"
+#include "Render/Resource/renderState.h"
+#include "Render/Scene/model.h"
+#include "Render/Scene/light.h"
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+#include <Core/Math/math.h>
+
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/** GLSL source of vertex shader that lights vertices using lights and materials from uniform buffers.
+
+    This follows the fixed-function lighting equations for one-sided lighting
+    with a non-local viewer, and with GL_COLOR_MATERIAL taking ambient and
+    diffuse reflectance from vertex color, which is how OpenGL_RenderStateCache
+    configures fixed-function lighting.
+
+    Sizes of the light and material tables here must match
+    OpenGL_Lighting::MAX_NUM_LIGHTS and OpenGL_Lighting::MAX_NUM_MATERIALS,
+    and layouts of the blocks must match LightBlockS and MaterialEntryS.
+*/
+static const char sLightingVertexShaderSource[] =
+    "#version 420 compatibility\n"
+    "\n"
+    "struct LightS\n"
+    "{\n"
+    "    vec4   position ;          // World-space position (w=1), or world-space direction toward light (w=0).\n"
+    "    vec4   spotDirection ;     // World-space direction of spotlight cone (xyz) and spotlight exponent (w).\n"
+    "    vec4   ambient ;\n"
+    "    vec4   diffuse ;\n"
+    "    vec4   specular ;\n"
+    "    vec4   attenuation ;       // Constant, linear and quadratic attenuation, and cosine of spotlight cutoff, less than -1 for non-spotlights.\n"
+    "} ;\n"
+    "\n"
+    "struct MaterialS\n"
+    "{\n"
+    "    vec4   specular ;          // Specular reflectance (rgb) and specular exponent (w).\n"
+    "    vec4   emission ;\n"
+    "} ;\n"
+    "\n"
+    "layout( std140 , binding = 0 ) uniform LightBlock\n"
+    "{\n"
+    "    mat4       uViewMatrix ;   // Transform from world space to view space.\n"
+    "    LightS     uLights[ 32 ] ;\n"
+    "} ;\n"
+    "\n"
+    "layout( std140 , binding = 1 ) uniform MaterialBlock\n"
+    "{\n"
+    "    MaterialS  uMaterials[ 256 ] ;\n"
+    "} ;\n"
+    "\n"
+    "uniform uint   uLightMask ;        // Bit per entry in uLights, set for lights that reach this model.\n"
+    "uniform int    uMaterialIndex ;    // Entry in uMaterials that this model has.\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    vec4       positionView    = gl_ModelViewMatrix * gl_Vertex ;\n"
+    "    vec3       vertex          = positionView.xyz / positionView.w ;\n"
+    "    vec3       normal          = normalize( gl_NormalMatrix * gl_Normal ) ;\n"
+    "    MaterialS  material        = uMaterials[ uMaterialIndex ] ;\n"
+    "    vec3       color           = material.emission.rgb + gl_Color.rgb * gl_LightModel.ambient.rgb ;\n"
+    "    uint       remaining       = uLightMask ;\n"
+    "    while( remaining != 0u )\n"
+    "    {   // For each light that reaches this model...\n"
+    "        int    idx             = findLSB( remaining ) ;\n"
+    "        remaining &= remaining - 1u ;\n"
+    "        vec4   lightView       = uViewMatrix * uLights[ idx ].position ;\n"
+    "        vec3   toLight ;\n"
+    "        float  attenuation     = 1.0 ;\n"
+    "        if( uLights[ idx ].position.w != 0.0 )\n"
+    "        {   // Light has a position.\n"
+    "            toLight = lightView.xyz - vertex ;\n"
+    "            float distance = length( toLight ) ;\n"
+    "            toLight /= distance ;\n"
+    "            vec4 coefficients = uLights[ idx ].attenuation ;\n"
+    "            attenuation = 1.0 / ( coefficients.x + distance * ( coefficients.y + distance * coefficients.z ) ) ;\n"
+    "            if( coefficients.w >= -1.0 )\n"
+    "            {   // Light is a spotlight.\n"
+    "                vec3   spotDirection   = normalize( mat3( uViewMatrix ) * uLights[ idx ].spotDirection.xyz ) ;\n"
+    "                float  cosAngle        = dot( - toLight , spotDirection ) ;\n"
+    "                attenuation *= ( cosAngle >= coefficients.w ) ? pow( max( cosAngle , 0.0 ) , uLights[ idx ].spotDirection.w ) : 0.0 ;\n"
+    "            }\n"
+    "        }\n"
+    "        else\n"
+    "        {   // Light is directional.\n"
+    "            toLight = normalize( lightView.xyz ) ;\n"
+    "        }\n"
+    "        float  nDotL   = max( dot( normal , toLight ) , 0.0 ) ;\n"
+    "        vec3   lit     = ( uLights[ idx ].ambient.rgb + nDotL * uLights[ idx ].diffuse.rgb ) * gl_Color.rgb ;\n"
+    "        if( nDotL > 0.0 )\n"
+    "        {   // Surface faces light, so it has a highlight.\n"
+    "            vec3 halfway = normalize( toLight + vec3( 0.0 , 0.0 , 1.0 ) ) ;\n"
+    "            lit += pow( max( dot( normal , halfway ) , 1.0e-20 ) , material.specular.w ) * uLights[ idx ].specular.rgb * material.specular.rgb ;\n"
+    "        }\n"
+    "        color += attenuation * lit ;\n"
+    "    }\n"
+    "    gl_FrontColor      = vec4( clamp( color , 0.0 , 1.0 ) , gl_Color.a ) ;\n"
+    "    gl_BackColor       = gl_FrontColor ;\n"
+    "    gl_TexCoord[ 0 ]   = gl_TextureMatrix[ 0 ] * gl_MultiTexCoord0 ;\n"
+    "    gl_Position        = ftransform() ;\n"
+    "}\n"
+    ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        OpenGL_Lighting * OpenGL_Lighting::sCurrent = NULLPTR ;
+
+
+
+
+        /** Construct shader-based lighting.
+
+            This does not touch OpenGL; the first SetLights does, since that requires a current OpenGL context.
+        */
+        OpenGL_Lighting::OpenGL_Lighting()
+            : mLightBufferName( 0 )
+            , mMaterialBufferName( 0 )
+            , mLightMaskLocation( -1 )
+            , mMaterialIndexLocation( -1 )
+            , mLightDirtyBegin( 0 )
+            , mLightDirtyEnd( sizeof( LightBlockS ) )
+            , mNumLightSlots( 0 )
+            , mNumMaterials( 0 )
+            , mNumMaterialsUploaded( 0 )
+            , mLightMask( 0 )
+            , mMaterialIndex( 0 )
+            , mLightMaskUploaded( ~ GLuint( 0 ) )
+            , mMaterialIndexUploaded( -1 )
+            , mIsSupported( -1 )
+            , mIsProgramBound( false )
+        {
+            PERF_BLOCK( OpenGL_Lighting__OpenGL_Lighting ) ;
+
+            memset( & mLightBlock , 0 , sizeof( mLightBlock ) ) ;
+            memset( mLightOfSlot  , 0 , sizeof( mLightOfSlot ) ) ;
+            memset( mMaterials    , 0 , sizeof( mMaterials ) ) ;
+
+            sCurrent = this ;
+        }
+
+
+
+
+        /** Destruct shader-based lighting.
+
+            The OpenGL context that the first SetLights used must still be current.
+        */
+        OpenGL_Lighting::~OpenGL_Lighting()
+        {
+            PERF_BLOCK( OpenGL_Lighting__dtor ) ;
+
+            ASSERT( ! mIsProgramBound ) ;
+            Deallocate() ;
+
+            if( this == sCurrent )
+            {
+                sCurrent = NULLPTR ;
+            }
+        }
+
+
+
+
+        /** Compile lighting shader and create uniform buffers.
+
+            \return Whether the OpenGL driver supports everything this needs, and the shader compiled.
+        */
+        bool OpenGL_Lighting::Initialize()
+        {
+            PERF_BLOCK( OpenGL_Lighting__Initialize ) ;
+
+            ASSERT( sizeof( Mat44 ) == 16 * sizeof( float ) ) ;
+            ASSERT( sizeof( LightEntryS ) == 6 * sizeof( Vec4 ) ) ;
+            ASSERT( sizeof( MaterialEntryS ) == 2 * sizeof( Vec4 ) ) ;
+
+            if(     ! OpenGL_ComputeShader::IsSupported()
+                ||  ! glGenBuffers || ! glBindBuffer || ! glBufferData || ! glBufferSubData || ! glBindBufferBase || ! glDeleteBuffers
+                ||  ! glUniform1ui || ! glUniform1i )
+            {   // Driver lacks shaders or uniform buffers.
+                return false ;
+            }
+
+            if( ! mProgram.Compile( sLightingVertexShaderSource , GL_VERTEX_SHADER ) )
+            {   // Driver lacks GLSL 4.20, which explicit block bindings require.
+                return false ;
+            }
+
+            mLightMaskLocation      = mProgram.GetUniformLocation( "uLightMask" ) ;
+            mMaterialIndexLocation  = mProgram.GetUniformLocation( "uMaterialIndex" ) ;
+
+            glGenBuffers( 1 , & mLightBufferName ) ;
+            glBindBuffer( GL_UNIFORM_BUFFER , mLightBufferName ) ;
+            glBufferData( GL_UNIFORM_BUFFER , sizeof( mLightBlock ) , & mLightBlock , GL_DYNAMIC_DRAW ) ;
+
+            glGenBuffers( 1 , & mMaterialBufferName ) ;
+            glBindBuffer( GL_UNIFORM_BUFFER , mMaterialBufferName ) ;
+            glBufferData( GL_UNIFORM_BUFFER , sizeof( mMaterials ) , mMaterials , GL_DYNAMIC_DRAW ) ;
+
+            glBindBuffer( GL_UNIFORM_BUFFER , 0 ) ;
+
+            // Nothing else uses uniform buffer binding points, so these bindings persist.
+            glBindBufferBase( GL_UNIFORM_BUFFER , 0 , mLightBufferName    ) ;
+            glBindBufferBase( GL_UNIFORM_BUFFER , 1 , mMaterialBufferName ) ;
+
+            // Buffers now hold everything recorded so far, including materials that SetMaterial recorded before this.
+            mLightDirtyBegin        = mLightDirtyEnd = 0 ;
+            mNumMaterialsUploaded   = mNumMaterials ;
+
+            if( RENDER_CHECK_ERROR( OpenGL_Lighting__Initialize ) )
+            {
+                Deallocate() ;
+                return false ;
+            }
+
+            return true ;
+        }
+
+
+
+
+        /** Release uniform buffers and shader.
+        */
+        void OpenGL_Lighting::Deallocate()
+        {
+            PERF_BLOCK( OpenGL_Lighting__Deallocate ) ;
+
+            if( mLightBufferName != 0 )
+            {
+                glDeleteBuffers( 1 , & mLightBufferName ) ;
+                mLightBufferName = 0 ;
+            }
+            if( mMaterialBufferName != 0 )
+            {
+                glDeleteBuffers( 1 , & mMaterialBufferName ) ;
+                mMaterialBufferName = 0 ;
+            }
+            mProgram.Deallocate() ;
+        }
+
+
+
+
+        /** Widen range of light block that the next PrepareToDraw uploads, to include the given range.
+        */
+        void OpenGL_Lighting::MarkLightBlockDirty( size_t begin , size_t end )
+        {
+            if( mLightDirtyBegin == mLightDirtyEnd )
+            {   // Nothing was dirty.
+                mLightDirtyBegin = begin ;
+                mLightDirtyEnd   = end   ;
+            }
+            else
+            {
+                mLightDirtyBegin = Min2( mLightDirtyBegin , begin ) ;
+                mLightDirtyEnd   = Max2( mLightDirtyEnd   , end   ) ;
+            }
+        }
+
+
+
+
+        /** Return light table entry that the given light occupies, assigning one if it has none.
+
+            Caller must ensure the table has room for the given light.
+        */
+        unsigned OpenGL_Lighting::FindOrAssignLightSlot( const Light * light )
+        {
+            PERF_BLOCK( OpenGL_Lighting__FindOrAssignLightSlot ) ;
+
+            for( unsigned slot = 0 ; slot < mNumLightSlots ; ++ slot )
+            {   // For each light table entry in use...
+                if( light == mLightOfSlot[ slot ] )
+                {
+                    return slot ;
+                }
+            }
+
+            ASSERT( mNumLightSlots < MAX_NUM_LIGHTS ) ;
+            const unsigned slot = mNumLightSlots ++ ;
+            mLightOfSlot[ slot ] = light ;
+            return slot ;
+        }
+
+
+
+
+        /** Record lights that reach the given model, and the view transform that maps them into view space.
+
+            \param viewMatrix       Transform from world space to view space, as SetCamera assigned.
+
+            \param lightReceiver    Model whose light cache to use.
+
+            \return Whether shader lighting handles these lights.  If not, caller should set fixed-function lights.
+
+            Each light gets repacked and compared against its table entry, so
+            only lights that changed since the previous frame reach the GPU.
+        */
+        bool OpenGL_Lighting::SetLights( const Mat44 & viewMatrix , const ModelNode & lightReceiver )
+        {
+            PERF_BLOCK( OpenGL_Lighting__SetLights ) ;
+
+#       if OPENGL_LIGHTING_SHADER
+            if( mIsSupported < 0 )
+            {   // First use.  Find out whether driver supports shader lighting.
+                mIsSupported = Initialize() ? 1 : 0 ;
+            }
+#       else
+            mIsSupported = 0 ;
+#       endif
+
+            if( ! IsActive() )
+            {
+                return false ;
+            }
+
+            if( memcmp( & mLightBlock.mViewMatrix , & viewMatrix , sizeof( viewMatrix ) ) != 0 )
+            {   // Camera moved.
+                mLightBlock.mViewMatrix = viewMatrix ;
+                MarkLightBlockDirty( offsetof( LightBlockS , mViewMatrix ) , offsetof( LightBlockS , mViewMatrix ) + sizeof( Mat44 ) ) ;
+            }
+
+            const unsigned numLights = lightReceiver.GetNumLights() ;
+            ASSERT( numLights <= MAX_NUM_LIGHTS ) ;
+            if( mNumLightSlots + numLights > MAX_NUM_LIGHTS )
+            {   // Table might not have room for lights of this model.  Start over.
+                // That only evicts lights of models already drawn, and uniform buffer updates do not affect draws issued before them.
+                memset( mLightOfSlot , 0 , sizeof( mLightOfSlot ) ) ;
+                mNumLightSlots = 0 ;
+            }
+
+            mLightMask = 0 ;
+            for( unsigned idx = 0 ; idx < numLights ; ++ idx )
+            {   // For each light in the given model's cache...
+                const Light &   light   = * lightReceiver.GetLight( idx ) ;
+                const unsigned  slot    = FindOrAssignLightSlot( & light ) ;
+
+                LightEntryS entry ;
+                if( Light::DIRECTIONAL == light.GetLightType() )
+                {   // Directional light has no position, and table stores direction toward the light, as OpenGL does.
+                    ASSERT( 0.0f == light.GetDir4().w ) ;
+                    entry.mPosition         = - light.GetDir4() ;
+                    entry.mSpotDirection    = Vec4( 0.0f , 0.0f , 0.0f , 0.0f ) ;
+                    entry.mAttenuation      = Vec4( 1.0f , 0.0f , 0.0f , -2.0f ) ;
+                }
+                else
+                {   // Light is not so-called "directional" (but could still be a spotlight, which has direction).
+                    ASSERT( 1.0f == light.GetPos4().w ) ;
+                    ASSERT( ( light.GetSpotOuterAngle() == 180.0f ) || ( ( light.GetSpotOuterAngle() >= 0.0f ) && ( light.GetSpotOuterAngle() <= 90.0f ) ) ) ;
+                    const float cosCutoff   = ( light.GetSpotOuterAngle() >= 180.0f ) ? -2.0f : cosf( light.GetSpotOuterAngle() * PI / 180.0f ) ;
+                    entry.mPosition         = light.GetPos4() ;
+                    entry.mSpotDirection    = Vec4( light.GetDirection() , light.GetSpotFalloff() ) ;
+                    entry.mAttenuation      = Vec4( light.GetConstAttenuation() , light.GetLinearAttenuation() , light.GetQuadracticAttenuation() , cosCutoff ) ;
+                }
+                entry.mAmbientColor     = light.GetAmbientColor() ;
+                entry.mDiffuseColor     = light.GetDiffuseColor() ;
+                entry.mSpecularColor    = light.GetSpecularColor() ;
+
+                if( memcmp( & mLightBlock.mLights[ slot ] , & entry , sizeof( entry ) ) != 0 )
+                {   // Light changed since it last reached the table.
+                    mLightBlock.mLights[ slot ] = entry ;
+                    const size_t begin = offsetof( LightBlockS , mLights ) + slot * sizeof( LightEntryS ) ;
+                    MarkLightBlockDirty( begin , begin + sizeof( LightEntryS ) ) ;
+                }
+
+                mLightMask |= 1u << slot ;
+            }
+
+            return true ;
+        }
+
+
+
+
+        /** Record material that subsequent draws have.
+
+            \return Whether shader lighting handles this material.  If not, or if it is not yet known, caller should set fixed-function material.
+
+            OpenGL_RenderStateCache only calls this when material properties
+            change, and most scenes have few distinct materials, so a linear
+            search suffices to find an existing entry.
+        */
+        bool OpenGL_Lighting::SetMaterial( const MaterialPropertiesS & materialProperties )
+        {
+            PERF_BLOCK( OpenGL_Lighting__SetMaterial ) ;
+
+            MaterialEntryS entry ;
+            entry.mSpecularColor    = Vec4( materialProperties.mSpecularColor.x , materialProperties.mSpecularColor.y , materialProperties.mSpecularColor.z , Clamp( materialProperties.mSpecularPower , 0.0f , 128.0f ) ) ;
+            entry.mEmissiveColor    = materialProperties.mEmissiveColor ;
+
+            for( unsigned idx = 0 ; idx < mNumMaterials ; ++ idx )
+            {   // For each material table entry in use...
+                if( 0 == memcmp( & mMaterials[ idx ] , & entry , sizeof( entry ) ) )
+                {
+                    mMaterialIndex = static_cast< GLint >( idx ) ;
+                    return IsActive() ;
+                }
+            }
+
+            if( mNumMaterials >= MAX_NUM_MATERIALS )
+            {   // Table is full.  Start over.  As with lights, this only affects draws not yet issued.
+                mNumMaterials           = 0 ;
+                mNumMaterialsUploaded   = 0 ;
+            }
+
+            mMaterials[ mNumMaterials ] = entry ;
+            mMaterialIndex = static_cast< GLint >( mNumMaterials ) ;
+            ++ mNumMaterials ;
+
+            return IsActive() ;
+        }
+
+
+
+
+        /** Bind lighting program for the following draw, and upload whatever changed since the previous draw.
+
+            \param hasNormals   Whether vertices of the following draw have normals.  Vertices without normals do not get lit.
+
+            \return Whether this bound the program, in which case caller must call FinishDraw after drawing.
+
+            Call this after binding vertex data, since binding some vertex formats binds their own program.
+        */
+        bool OpenGL_Lighting::PrepareToDraw( bool hasNormals )
+        {
+            PERF_BLOCK( OpenGL_Lighting__PrepareToDraw ) ;
+
+            ASSERT( ! mIsProgramBound ) ;
+
+            if( ! hasNormals || ! IsActive() )
+            {
+                return false ;
+            }
+
+            if( mLightDirtyEnd > mLightDirtyBegin )
+            {   // Some lights, or the view matrix, changed.
+                glBindBuffer( GL_UNIFORM_BUFFER , mLightBufferName ) ;
+                glBufferSubData( GL_UNIFORM_BUFFER , mLightDirtyBegin , mLightDirtyEnd - mLightDirtyBegin , reinterpret_cast< const char * >( & mLightBlock ) + mLightDirtyBegin ) ;
+                mLightDirtyBegin = mLightDirtyEnd = 0 ;
+            }
+
+            if( mNumMaterials > mNumMaterialsUploaded )
+            {   // Material table gained entries.  Existing entries never change, so only upload new ones.
+                glBindBuffer( GL_UNIFORM_BUFFER , mMaterialBufferName ) ;
+                glBufferSubData( GL_UNIFORM_BUFFER , mNumMaterialsUploaded * sizeof( MaterialEntryS ) , ( mNumMaterials - mNumMaterialsUploaded ) * sizeof( MaterialEntryS ) , & mMaterials[ mNumMaterialsUploaded ] ) ;
+                mNumMaterialsUploaded = mNumMaterials ;
+            }
+
+            mProgram.Use() ;
+            mIsProgramBound = true ;
+
+            if( mLightMask != mLightMaskUploaded )
+            {
+                glUniform1ui( mLightMaskLocation , mLightMask ) ;
+                mLightMaskUploaded = mLightMask ;
+            }
+            if( mMaterialIndex != mMaterialIndexUploaded )
+            {
+                glUniform1i( mMaterialIndexLocation , mMaterialIndex ) ;
+                mMaterialIndexUploaded = mMaterialIndex ;
+            }
+
+            RENDER_CHECK_ERROR( OpenGL_Lighting__PrepareToDraw ) ;
+
+            return true ;
+        }
+
+
+
+
+        /** Unbind lighting program, if PrepareToDraw bound it, so later fixed-function draws do not use it.
+        */
+        void OpenGL_Lighting::FinishDraw()
+        {
+            PERF_BLOCK( OpenGL_Lighting__FinishDraw ) ;
+
+            if( mIsProgramBound )
+            {
+                glUseProgram( 0 ) ;
+                mIsProgramBound = false ;
+            }
+        }
+
+    } ;
+} ;
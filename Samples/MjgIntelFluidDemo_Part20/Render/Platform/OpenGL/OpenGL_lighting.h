@@ -0,0 +1,153 @@
+/** \file OpenGL_lighting.h
+
+    \brief Shader-based lighting for OpenGL, whose lights and materials reside in uniform buffers.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_LIGHTING_H
+#define PEGASYS_RENDER_OPENGL_LIGHTING_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Platform/OpenGL/OpenGL_computeShader.h"
+
+#include "Core/Math/mat4.h"
+#include "Core/Math/vec4.h"
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether OpenGL_Api lights models with a vertex shader that reads lights and materials from uniform buffers.
+
+    Otherwise, or when the driver lacks what that shader needs, OpenGL_Api
+    uses fixed-function lighting, setting each light with glLight and each
+    material with glMaterial.
+*/
+#if ! defined( OPENGL_LIGHTING_SHADER )
+#   define OPENGL_LIGHTING_SHADER 1
+#endif
+
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        // Forward declaration
+        class Light ;
+        class ModelNode ;
+        struct MaterialPropertiesS ;
+
+        /** Shader-based lighting for OpenGL, whose lights and materials reside in uniform buffers.
+
+            Fixed-function lighting requires about a dozen glLight calls per
+            light, per model, every frame, plus several glMaterial calls per
+            material change, even when nothing about the light or material
+            changed.  Instead, this keeps a table of every light any model
+            uses, and a table of every material, each in a uniform buffer.
+            A light or material only crosses the bus when its contents change,
+            and the view matrix only when the camera moves.  Each draw then
+            sets only two uniforms: a mask of which lights in the table reach
+            the model, and the index of the material.
+
+            Lights reside in the table in world space, and the shader
+            transforms them into view space, so moving the camera does not
+            change any light.
+
+            The shader replaces only vertex processing, and follows the
+            fixed-function lighting equations, including GL_COLOR_MATERIAL
+            taking ambient and diffuse reflectance from vertex color, so
+            fragment processing, such as texturing and blending, stays
+            fixed-function.
+
+            Every method requires that the OpenGL context that OpenGL_Api
+            uses be current on the calling thread.
+        */
+        class OpenGL_Lighting
+        {
+            public:
+                static const unsigned MAX_NUM_LIGHTS    = 32    ;   ///< Capacity of light table.  Light mask has one bit per entry.
+                static const unsigned MAX_NUM_MATERIALS = 256   ;   ///< Capacity of material table.
+
+                OpenGL_Lighting() ;
+                ~OpenGL_Lighting() ;
+
+                bool    SetLights( const Mat44 & viewMatrix , const ModelNode & lightReceiver ) ;
+                bool    SetMaterial( const MaterialPropertiesS & materialProperties ) ;
+
+                bool    PrepareToDraw( bool hasNormals ) ;
+                void    FinishDraw() ;
+
+                /// Return whether shader lighting replaces fixed-function lighting, which is only known after the first SetLights.
+                bool    IsActive() const { return 1 == mIsSupported ; }
+
+                /// Return lighting that the most recently constructed OpenGL_Api uses.
+                static OpenGL_Lighting * GetCurrent() { return sCurrent ; }
+
+            private:
+                /// Light, as it resides in the light uniform buffer, laid out according to std140 rules.
+                struct LightEntryS
+                {
+                    Vec4    mPosition       ;   ///< World-space position (w=1), or world-space direction toward light (w=0).
+                    Vec4    mSpotDirection  ;   ///< World-space direction of spotlight cone (xyz) and spotlight exponent (w).
+                    Vec4    mAmbientColor   ;   ///< Ambient color of light.
+                    Vec4    mDiffuseColor   ;   ///< Diffuse color of light.
+                    Vec4    mSpecularColor  ;   ///< Specular color of light.
+                    Vec4    mAttenuation    ;   ///< Constant (x), linear (y) and quadratic (z) attenuation, and cosine of spotlight cutoff (w), which is less than -1 for lights that are not spotlights.
+                } ;
+
+                /// Contents of the light uniform buffer.
+                struct LightBlockS
+                {
+                    Mat44       mViewMatrix                 ;   ///< Transform from world space to view space.
+                    LightEntryS mLights[ MAX_NUM_LIGHTS ]   ;   ///< Table of lights.
+                } ;
+
+                /// Material, as it resides in the material uniform buffer, laid out according to std140 rules.
+                struct MaterialEntryS
+                {
+                    Vec4    mSpecularColor  ;   ///< Specular reflectance (rgb) and specular exponent (w).
+                    Vec4    mEmissiveColor  ;   ///< Emitted color.
+                } ;
+
+                OpenGL_Lighting( const OpenGL_Lighting & ) ;              // Disallow copy
+                OpenGL_Lighting & operator=( const OpenGL_Lighting & ) ;  // Disallow assignment
+
+                bool        Initialize() ;
+                void        Deallocate() ;
+                unsigned    FindOrAssignLightSlot( const Light * light ) ;
+                void        MarkLightBlockDirty( size_t begin , size_t end ) ;
+
+                static OpenGL_Lighting * sCurrent ;   ///< Lighting that the most recently constructed OpenGL_Api uses.
+
+                LightBlockS             mLightBlock                         ;   ///< Copy of light uniform buffer contents.
+                const Light *           mLightOfSlot[ MAX_NUM_LIGHTS ]      ;   ///< Per light table entry, light that occupies it, or NULLPTR if none does.
+                MaterialEntryS          mMaterials[ MAX_NUM_MATERIALS ]     ;   ///< Copy of material uniform buffer contents.
+                OpenGL_ComputeShader    mProgram                            ;   ///< Vertex-only program that lights vertices.
+                GLuint                  mLightBufferName                    ;   ///< Identifier of uniform buffer holding mLightBlock.
+                GLuint                  mMaterialBufferName                 ;   ///< Identifier of uniform buffer holding mMaterials.
+                GLint                   mLightMaskLocation                  ;   ///< Location of uniform that selects which lights reach vertices.
+                GLint                   mMaterialIndexLocation              ;   ///< Location of uniform that selects which material vertices have.
+                size_t                  mLightDirtyBegin                    ;   ///< Offset, in bytes, of first byte of mLightBlock that changed since the most recent upload.
+                size_t                  mLightDirtyEnd                      ;   ///< Offset, in bytes, past last byte of mLightBlock that changed since the most recent upload.
+                unsigned                mNumLightSlots                      ;   ///< Number of light table entries in use.
+                unsigned                mNumMaterials                       ;   ///< Number of material table entries in use.
+                unsigned                mNumMaterialsUploaded               ;   ///< Number of material table entries the material uniform buffer has.
+                GLuint                  mLightMask                          ;   ///< Bit per light table entry, set for lights that reach the model that SetLights most recently set.
+                GLint                   mMaterialIndex                      ;   ///< Material table entry that SetMaterial most recently set.
+                GLuint                  mLightMaskUploaded                  ;   ///< Value of light mask uniform that the program has.
+                GLint                   mMaterialIndexUploaded              ;   ///< Value of material index uniform that the program has.
+                int                     mIsSupported                        ;   ///< Whether driver supports everything this needs: 1 for yes, 0 for no, -1 for not yet queried.
+                bool                    mIsProgramBound                     ;   ///< Whether PrepareToDraw bound the program, which FinishDraw unbinds.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -11,6 +11,7 @@
 
 #include "Render/Platform/OpenGL/OpenGL_api.h" // For GL_CHECK_ERROR
 #include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+#include "Render/Platform/OpenGL/OpenGL_lighting.h"
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -114,6 +115,24 @@ namespace PeGaSys {
             // Inform renderer of the vertex format and location of vertex data.
             vertexBuffer->BindVertexData() ;
 
+            // Light vertices with shader, if available.  This comes after binding vertex data, since some vertex formats bind their own program.
+            OpenGL_Lighting * lighting = OpenGL_Lighting::GetCurrent() ;
+            if( lighting )
+            {
+                lighting->PrepareToDraw( vertexBuffer->GetVertexDeclaration().HasNormals() ) ;
+            }
+
+            const bool dequantizePositions = ( VertexDeclaration::POSITION_NORMAL_PACKED == vertexBuffer->GetVertexDeclaration().GetVertexFormat() ) ;
+            if( dequantizePositions )
+            {   // Vertex positions are quantized against a box.  Map them back into world space.
+                const float * positionOffset = vertexBuffer->GetPositionOffset() ;
+                const float * positionScale  = vertexBuffer->GetPositionScale() ;
+                glMatrixMode( GL_MODELVIEW ) ;
+                glPushMatrix() ;
+                glTranslatef( positionOffset[ 0 ] , positionOffset[ 1 ] , positionOffset[ 2 ] ) ;
+                glScalef( positionScale[ 0 ] , positionScale[ 1 ] , positionScale[ 2 ] ) ;
+            }
+
             typedef const OpenGL_IndexBuffer::INDEX_BUFFER_POINTER_TYPE ibPtr ;
 
             const OpenGL_IndexBuffer *  indexBuffer = static_cast< const OpenGL_IndexBuffer * >( GetIndexBuffer() ) ;
@@ -122,7 +141,17 @@ namespace PeGaSys {
 
             GLenum primitiveType = 0 ; // Initialize to an invalid value to catch missed cases below.
 
-            if( indexBuffer != NULL )
+            if( VertexDeclaration::BILLBOARD_INSTANCE == vertexBuffer->GetVertexDeclaration().GetVertexFormat() )
+            {   // Vertex buffer has one element per quadrilateral.  Vertex shader expands each into 4 vertices.
+                ASSERT( NULL == indexBuffer ) ;
+                ASSERT( PRIMITIVE_QUADS == GetPrimitiveType() ) ;
+                const GLsizei numInstances = static_cast< GLsizei >( vertexBuffer->GetPopulation() ) ;
+
+                glDrawArraysInstanced( GL_TRIANGLE_FAN , 0 , 4 , numInstances ) ;
+
+                RENDER_CHECK_ERROR( OpenGL_Mesh_Render_DrawArraysInstanced ) ;
+            }
+            else if( indexBuffer != NULL )
             {   // Index buffer exists.
                 RENDER_CHECK_ERROR( OpenGL_Mesh_Render_IB ) ;
 
@@ -213,6 +242,19 @@ namespace PeGaSys {
                 RENDER_CHECK_ERROR( OpenGL_Mesh_Render_DrawArrays ) ;
             }
 
+            if( dequantizePositions )
+            {
+                glMatrixMode( GL_MODELVIEW ) ;
+                glPopMatrix() ;
+            }
+
+            if( lighting )
+            {
+                lighting->FinishDraw() ;
+            }
+
+            vertexBuffer->UnbindVertexData() ;
+
             RENDER_CHECK_ERROR( OpenGL_Mesh_Render_exit ) ;
         }
 
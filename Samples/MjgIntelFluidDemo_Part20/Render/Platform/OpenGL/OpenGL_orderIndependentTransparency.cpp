@@ -0,0 +1,343 @@
+/** \file OpenGL_orderIndependentTransparency.cpp
+
+    \brief Offscreen targets that accumulate translucent fragments in any order, then composite them.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_orderIndependentTransparency.h"
+
+#include "Render/Platform/OpenGL/OpenGL_api.h" // For RENDER_CHECK_ERROR
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+#include "glExt.h"
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/** GLSL source of fragment shader that composites accumulated translucent fragments.
+
+    This runs on a quadrilateral that covers the viewport.  Targets line up
+    with the framebuffer they composite onto, so each fragment reads the
+    texel at its own window coordinates.
+*/
+static const char sCompositeSource[] =
+    "#version 400 compatibility\n"
+    "\n"
+    "uniform sampler2D  uAccumulation ;     // Sum of premultiplied colors (rgb) and of coverages (a).\n"
+    "uniform sampler2D  uRevealage ;        // Product of transmittances (r).\n"
+    "\n"
+    "layout( location = 0 ) out vec4 oColor ;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    ivec2 texel     = ivec2( gl_FragCoord.xy ) ;\n"
+    "    float revealage = texelFetch( uRevealage , texel , 0 ).r ;\n"
+    "    if( revealage >= 1.0 )\n"
+    "    {   // No translucent fragment covered this pixel.\n"
+    "        discard ;\n"
+    "    }\n"
+    "    vec4  accum     = texelFetch( uAccumulation , texel , 0 ) ;\n"
+    "    vec3  average   = accum.rgb / max( accum.a , 1.0e-5 ) ;\n"
+    "    oColor = vec4( average , 1.0 - revealage ) ;\n"
+    "}\n"
+    ;
+
+/// Draw buffers that translucent fragments write to: accumulation, then revealage.
+static const GLenum sDrawBuffers[ 2 ] = { GL_COLOR_ATTACHMENT0_EXT , GL_COLOR_ATTACHMENT1_EXT } ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct order-independent transparency targets.
+
+            This does not touch OpenGL; the first Begin does, since that requires a current OpenGL context.
+        */
+        OpenGL_OrderIndependentTransparency::OpenGL_OrderIndependentTransparency()
+            : mFramebufferName( 0 )
+            , mPreviousFramebufferName( 0 )
+            , mAccumulationTextureName( 0 )
+            , mRevealageTextureName( 0 )
+            , mDepthRenderbufferName( 0 )
+            , mWidth( 0 )
+            , mHeight( 0 )
+            , mIsSupported( -1 )
+            , mIsActive( false )
+        {
+            PERF_BLOCK( OpenGL_OrderIndependentTransparency__OpenGL_OrderIndependentTransparency ) ;
+        }
+
+
+
+
+        /** Destruct order-independent transparency targets.
+
+            The OpenGL context that the first Begin used must still be current.
+        */
+        OpenGL_OrderIndependentTransparency::~OpenGL_OrderIndependentTransparency()
+        {
+            PERF_BLOCK( OpenGL_OrderIndependentTransparency__dtor ) ;
+
+            ASSERT( ! mIsActive ) ;
+            Deallocate() ;
+        }
+
+
+
+
+        /** Compile composite shader and create framebuffer object, textures and renderbuffer.
+
+            \return Whether the OpenGL driver supports everything this needs, and the shader compiled.
+        */
+        bool OpenGL_OrderIndependentTransparency::Initialize()
+        {
+            PERF_BLOCK( OpenGL_OrderIndependentTransparency__Initialize ) ;
+
+            if(     ! glGenFramebuffersEXT || ! glBindFramebufferEXT || ! glFramebufferTexture2DEXT || ! glFramebufferRenderbufferEXT || ! glCheckFramebufferStatusEXT
+                ||  ! glGenRenderbuffersEXT || ! glBindRenderbufferEXT || ! glRenderbufferStorageEXT || ! glBlitFramebufferEXT || ! glDrawBuffersEXT
+                ||  ! glBlendFunci || ! glBlendFuncSeparatei || ! glBlendFuncSeparate || ! glActiveTexture || ! glUniform1i
+                ||  ! glCreateShader || ! glCreateProgram || ! glGetUniformLocation )
+            {   // Driver lacks framebuffer objects, per-draw-buffer blending or shaders.
+                return false ;
+            }
+
+            if( ! mCompositeShader.Compile( sCompositeSource , GL_FRAGMENT_SHADER ) )
+            {
+                return false ;
+            }
+
+            glGenFramebuffersEXT( 1 , & mFramebufferName ) ;
+            glGenRenderbuffersEXT( 1 , & mDepthRenderbufferName ) ;
+
+            GLuint * textureNames[] = { & mAccumulationTextureName , & mRevealageTextureName } ;
+            for( unsigned iTex = 0 ; iTex < sizeof( textureNames ) / sizeof( textureNames[ 0 ] ) ; ++ iTex )
+            {
+                glGenTextures( 1 , textureNames[ iTex ] ) ;
+                glBindTexture( GL_TEXTURE_2D , * textureNames[ iTex ] ) ;
+                glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , GL_NEAREST ) ; // Without mipmaps, the default filter would leave texture incomplete.
+                glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , GL_NEAREST ) ;
+            }
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            return ! RENDER_CHECK_ERROR( OpenGL_OrderIndependentTransparency_Initialize ) ;
+        }
+
+
+
+
+        /** Allocate targets with the given size and attach them to the framebuffer object.
+
+            \return Whether the framebuffer object is complete, i.e. whether the driver can render into it.
+        */
+        bool OpenGL_OrderIndependentTransparency::Resize( GLsizei width , GLsizei height )
+        {
+            PERF_BLOCK( OpenGL_OrderIndependentTransparency__Resize ) ;
+
+            glBindTexture( GL_TEXTURE_2D , mAccumulationTextureName ) ;
+            glTexImage2D( GL_TEXTURE_2D , 0 , GL_RGBA16F_ARB , width , height , 0 , GL_RGBA , GL_FLOAT , NULL ) ;
+            glBindTexture( GL_TEXTURE_2D , mRevealageTextureName ) ;
+            glTexImage2D( GL_TEXTURE_2D , 0 , GL_R16F , width , height , 0 , GL_RED , GL_FLOAT , NULL ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            // Match format of typical window depth buffers, which glBlitFramebuffer requires.
+            glBindRenderbufferEXT( GL_RENDERBUFFER_EXT , mDepthRenderbufferName ) ;
+            glRenderbufferStorageEXT( GL_RENDERBUFFER_EXT , GL_DEPTH24_STENCIL8_EXT , width , height ) ;
+            glBindRenderbufferEXT( GL_RENDERBUFFER_EXT , 0 ) ;
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mFramebufferName ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_COLOR_ATTACHMENT0_EXT , GL_TEXTURE_2D , mAccumulationTextureName , 0 ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_COLOR_ATTACHMENT1_EXT , GL_TEXTURE_2D , mRevealageTextureName , 0 ) ;
+            glFramebufferRenderbufferEXT( GL_FRAMEBUFFER_EXT , GL_DEPTH_ATTACHMENT_EXT , GL_RENDERBUFFER_EXT , mDepthRenderbufferName ) ;
+            glFramebufferRenderbufferEXT( GL_FRAMEBUFFER_EXT , GL_STENCIL_ATTACHMENT_EXT , GL_RENDERBUFFER_EXT , mDepthRenderbufferName ) ;
+            const GLenum status = glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT ) ;
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , 0 ) ;
+
+            mWidth  = width  ;
+            mHeight = height ;
+
+            return ( GL_FRAMEBUFFER_COMPLETE_EXT == status ) && ! RENDER_CHECK_ERROR( OpenGL_OrderIndependentTransparency_Resize ) ;
+        }
+
+
+
+
+        /** Delete composite shader, framebuffer object, textures and renderbuffer, if any.
+        */
+        void OpenGL_OrderIndependentTransparency::Deallocate()
+        {
+            mCompositeShader.Deallocate() ;
+            if( mFramebufferName )
+            {
+                glDeleteFramebuffersEXT( 1 , & mFramebufferName ) ;
+                mFramebufferName = 0 ;
+            }
+            if( mDepthRenderbufferName )
+            {
+                glDeleteRenderbuffersEXT( 1 , & mDepthRenderbufferName ) ;
+                mDepthRenderbufferName = 0 ;
+            }
+            GLuint * textureNames[] = { & mAccumulationTextureName , & mRevealageTextureName } ;
+            for( unsigned iTex = 0 ; iTex < sizeof( textureNames ) / sizeof( textureNames[ 0 ] ) ; ++ iTex )
+            {
+                if( * textureNames[ iTex ] )
+                {
+                    glDeleteTextures( 1 , textureNames[ iTex ] ) ;
+                    * textureNames[ iTex ] = 0 ;
+                }
+            }
+            mWidth  = 0 ;
+            mHeight = 0 ;
+        }
+
+
+
+
+        /** Bind and clear accumulation and revealage targets, so translucent fragments accumulate into them.
+
+            \return Whether targets are bound.  If not, translucent fragments should blend onto the bound framebuffer as usual.
+
+            Targets cover the bound framebuffer up to the far corner of the
+            current viewport, so the viewport stays the same.  Begin copies
+            that viewport's depth from the bound framebuffer, so translucent
+            fragments depth-test against opaque geometry already drawn.
+
+            \note   The caller must also make order-independent blend states
+                    accumulate.  See OpenGL_RenderStateCache::SetOrderIndependentAccumulation.
+        */
+        bool OpenGL_OrderIndependentTransparency::Begin()
+        {
+            PERF_BLOCK( OpenGL_OrderIndependentTransparency__Begin ) ;
+
+            ASSERT( ! mIsActive ) ;
+
+            if( mIsSupported < 0 )
+            {   // First call.
+                mIsSupported = Initialize() ? 1 : 0 ;
+            }
+            if( ! mIsSupported )
+            {
+                return false ;
+            }
+
+            GLint viewport[ 4 ] ;
+            glGetIntegerv( GL_VIEWPORT , viewport ) ;
+            const GLint x0 = viewport[ 0 ] ;
+            const GLint y0 = viewport[ 1 ] ;
+            const GLint x1 = viewport[ 0 ] + viewport[ 2 ] ;
+            const GLint y1 = viewport[ 1 ] + viewport[ 3 ] ;
+            if( ( x1 != mWidth ) || ( y1 != mHeight ) )
+            {   // Window changed size, so reallocate targets.
+                if( ! Resize( x1 , y1 ) )
+                {   // Driver cannot render into these targets, so stop trying.
+                    Deallocate() ;
+                    mIsSupported = 0 ;
+                    return false ;
+                }
+            }
+
+            glGetIntegerv( GL_FRAMEBUFFER_BINDING_EXT , & mPreviousFramebufferName ) ;
+
+            {   // Copy depth of opaque geometry already drawn.
+                PERF_BLOCK( OpenGL_OrderIndependentTransparency__Begin_CopyDepth ) ;
+                glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT , mPreviousFramebufferName ) ;
+                glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT , mFramebufferName ) ;
+                glBlitFramebufferEXT( x0 , y0 , x1 , y1 , x0 , y0 , x1 , y1 , GL_DEPTH_BUFFER_BIT , GL_NEAREST ) ;
+            }
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mFramebufferName ) ;
+
+            {   // Clear accumulation to zero and revealage to one, i.e. nothing covers any pixel.
+                GLfloat clearColor[ 4 ] ;
+                glGetFloatv( GL_COLOR_CLEAR_VALUE , clearColor ) ;
+                glDrawBuffersEXT( 1 , & sDrawBuffers[ 0 ] ) ;
+                glClearColor( 0.0f , 0.0f , 0.0f , 0.0f ) ;
+                glClear( GL_COLOR_BUFFER_BIT ) ;
+                glDrawBuffersEXT( 1 , & sDrawBuffers[ 1 ] ) ;
+                glClearColor( 1.0f , 1.0f , 1.0f , 1.0f ) ;
+                glClear( GL_COLOR_BUFFER_BIT ) ;
+                glClearColor( clearColor[ 0 ] , clearColor[ 1 ] , clearColor[ 2 ] , clearColor[ 3 ] ) ;
+            }
+
+            glDrawBuffersEXT( 2 , sDrawBuffers ) ;
+
+            mIsActive = true ;
+
+            return ! RENDER_CHECK_ERROR( OpenGL_OrderIndependentTransparency_Begin ) ;
+        }
+
+
+
+
+        /** Unbind accumulation and revealage targets, and composite what they accumulated onto the framebuffer bound when Begin ran.
+
+            This leaves render state as it found it, except that afterward no texture or program is bound.
+        */
+        void OpenGL_OrderIndependentTransparency::End()
+        {
+            PERF_BLOCK( OpenGL_OrderIndependentTransparency__End ) ;
+
+            ASSERT( mIsActive ) ;
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mPreviousFramebufferName ) ;
+            mIsActive = false ;
+
+            glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_TRANSFORM_BIT ) ;
+
+            glActiveTexture( GL_TEXTURE1 ) ;
+            glBindTexture( GL_TEXTURE_2D , mRevealageTextureName ) ;
+            glActiveTexture( GL_TEXTURE0 ) ;
+            glBindTexture( GL_TEXTURE_2D , mAccumulationTextureName ) ;
+
+            glDisable( GL_LIGHTING ) ;
+            glDisable( GL_ALPHA_TEST ) ;
+            glDisable( GL_CULL_FACE ) ;
+            glDisable( GL_DEPTH_TEST ) ;    // Begin already depth-tested translucent fragments.
+            glDepthMask( GL_FALSE ) ;
+            glEnable( GL_BLEND ) ;
+            // Blend alpha as coverage, in case destination is itself an offscreen target that composites later.
+            glBlendFuncSeparate( GL_SRC_ALPHA , GL_ONE_MINUS_SRC_ALPHA , GL_ONE , GL_ONE_MINUS_SRC_ALPHA ) ;
+
+            mCompositeShader.Use() ;
+            glUniform1i( mCompositeShader.GetUniformLocation( "uAccumulation" ) , 0 ) ;
+            glUniform1i( mCompositeShader.GetUniformLocation( "uRevealage"    ) , 1 ) ;
+
+            {   // Draw quadrilateral that covers the viewport.
+                PERF_BLOCK( OpenGL_OrderIndependentTransparency__End_Composite ) ;
+                glMatrixMode( GL_PROJECTION ) ;
+                glPushMatrix() ;
+                glLoadIdentity() ;
+                glMatrixMode( GL_MODELVIEW ) ;
+                glPushMatrix() ;
+                glLoadIdentity() ;
+
+                glBegin( GL_QUADS ) ;
+                glVertex2f( -1.0f , -1.0f ) ;
+                glVertex2f(  1.0f , -1.0f ) ;
+                glVertex2f(  1.0f ,  1.0f ) ;
+                glVertex2f( -1.0f ,  1.0f ) ;
+                glEnd() ;
+
+                glPopMatrix() ;
+                glMatrixMode( GL_PROJECTION ) ;
+                glPopMatrix() ;
+            }
+
+            glUseProgram( 0 ) ;
+
+            glActiveTexture( GL_TEXTURE1 ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+            glActiveTexture( GL_TEXTURE0 ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            glPopAttrib() ;
+            RENDER_CHECK_ERROR( OpenGL_OrderIndependentTransparency_End ) ;
+        }
+
+    } ;
+} ;
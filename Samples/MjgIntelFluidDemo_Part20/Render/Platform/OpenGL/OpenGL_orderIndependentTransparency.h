@@ -0,0 +1,93 @@
+/** \file OpenGL_orderIndependentTransparency.h
+
+    \brief Offscreen targets that accumulate translucent fragments in any order, then composite them.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_ORDER_INDEPENDENT_TRANSPARENCY_H
+#define PEGASYS_RENDER_OPENGL_ORDER_INDEPENDENT_TRANSPARENCY_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+#include "Render/Platform/OpenGL/OpenGL_computeShader.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Offscreen targets that accumulate translucent fragments in any order, then composite them.
+
+            This implements weighted blended order-independent transparency
+            (McGuire and Bavoil 2013), with a uniform weight.  Between Begin
+            and End, each translucent fragment adds its premultiplied color and
+            its coverage into an accumulation target, and multiplies its
+            transmittance into a revealage target.  Sums and products commute,
+            so draw order does not matter, and translucent geometry needs no
+            sort.  End then draws the average color of all fragments over each
+            pixel, with opacity one minus the product of their transmittances.
+
+            The result matches sorted blending exactly where fragments over a
+            pixel have similar colors, as smoke and dye particles do, and
+            approximates it elsewhere.  Particle materials use fixed-function
+            fragment processing, which cannot compute a per-fragment weight, so
+            nearer fragments get no more weight than farther ones.
+
+            Begin copies depth of what the bound framebuffer (usually the
+            window) already has, so translucent fragments behind opaque
+            geometry do not accumulate, and End composites onto that
+            framebuffer.
+
+            This requires framebuffer objects, floating-point textures, and
+            per-draw-buffer blending (OpenGL 4.0 or ARB_draw_buffers_blend),
+            and a fragment shader to composite.  Without those, Begin returns
+            false.  Every method other than the constructor requires that the
+            OpenGL context that created this object be current on the calling
+            thread.
+        */
+        class OpenGL_OrderIndependentTransparency
+        {
+            public:
+                OpenGL_OrderIndependentTransparency() ;
+                ~OpenGL_OrderIndependentTransparency() ;
+
+                bool    Begin() ;
+                void    End() ;
+
+                /// Return whether Begin succeeded more recently than End ran.
+                bool    IsActive() const { return mIsActive ; }
+
+            private:
+                OpenGL_OrderIndependentTransparency( const OpenGL_OrderIndependentTransparency & ) ;              // Disallow copy
+                OpenGL_OrderIndependentTransparency & operator=( const OpenGL_OrderIndependentTransparency & ) ;  // Disallow assignment
+
+                bool    Initialize() ;
+                bool    Resize( GLsizei width , GLsizei height ) ;
+                void    Deallocate() ;
+
+                OpenGL_ComputeShader    mCompositeShader            ;   ///< Fragment-only program that composites accumulated fragments onto the window.
+                GLuint                  mFramebufferName            ;   ///< Identifier of framebuffer object whose draw buffers are the accumulation and revealage targets.
+                GLint                   mPreviousFramebufferName    ;   ///< Identifier of framebuffer bound when Begin ran, which End composites onto.
+                GLuint                  mAccumulationTextureName    ;   ///< Identifier of texture holding sum of premultiplied colors (rgb) and of coverages (a), in half precision.
+                GLuint                  mRevealageTextureName       ;   ///< Identifier of texture holding product of transmittances (r), in half precision.
+                GLuint                  mDepthRenderbufferName      ;   ///< Identifier of renderbuffer holding copy of window depth.
+                GLsizei                 mWidth                      ;   ///< Width, in pixels, of targets.
+                GLsizei                 mHeight                     ;   ///< Height, in pixels, of targets.
+                int                     mIsSupported                ;   ///< Whether driver supports everything this needs: 1 for yes, 0 for no, -1 for not yet queried.
+                bool                    mIsActive                   ;   ///< Whether targets are bound, between Begin and End.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
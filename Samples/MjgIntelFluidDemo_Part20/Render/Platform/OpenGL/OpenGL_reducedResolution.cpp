@@ -0,0 +1,405 @@
+/** \file OpenGL_reducedResolution.cpp
+
+    \brief Offscreen target, smaller than the window, that composites onto the window with depth-aware upsampling.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_reducedResolution.h"
+
+#include "Render/Platform/OpenGL/OpenGL_api.h" // For RENDER_CHECK_ERROR
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+#include "glExt.h"
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/** GLSL source of fragment shader that upsamples the reduced target onto the window.
+
+    This runs on a quadrilateral that covers the viewport.  Each fragment maps
+    its window coordinates into reduced texel space, then averages the four
+    nearest reduced texels, weighing each by bilinear proximity divided by how
+    much its depth differs from the depth of this fragment's own pixel.
+    Depths come straight from depth buffers, i.e. nonlinear in distance, which
+    suffices to tell which texels lie on the same surface as this pixel.
+*/
+static const char sCompositeSource[] =
+    "#version 130\n"
+    "\n"
+    "uniform sampler2D  uColor ;            // Premultiplied color (rgb) and coverage (a), at reduced resolution.\n"
+    "uniform sampler2D  uDepth ;            // Depth of opaque geometry, at reduced resolution.\n"
+    "uniform sampler2D  uFullDepth ;        // Depth of opaque geometry, at full resolution.\n"
+    "uniform vec4       uFullToReduced ;    // Scale (xy) and offset (zw) from window coordinates to reduced texel coordinates.\n"
+    "\n"
+    "const float sDepthTolerance = 1.0e-4 ; // Depth difference below which texels count as the same surface.\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    float  depth       = texelFetch( uFullDepth , ivec2( gl_FragCoord.xy ) , 0 ).r ;\n"
+    "    vec2   reduced     = gl_FragCoord.xy * uFullToReduced.xy + uFullToReduced.zw - 0.5 ;\n"
+    "    ivec2  corner      = ivec2( floor( reduced ) ) ;\n"
+    "    vec2   fraction    = reduced - vec2( corner ) ;\n"
+    "    ivec2  maxTexel    = textureSize( uColor , 0 ) - 1 ;\n"
+    "    vec4   sum         = vec4( 0.0 ) ;\n"
+    "    float  weightSum   = 0.0 ;\n"
+    "    for( int j = 0 ; j < 2 ; ++ j )\n"
+    "    {\n"
+    "        for( int i = 0 ; i < 2 ; ++ i )\n"
+    "        {   // For each of the four nearest reduced texels...\n"
+    "            ivec2  texel       = clamp( corner + ivec2( i , j ) , ivec2( 0 ) , maxTexel ) ;\n"
+    "            float  proximity   = ( ( i == 0 ) ? 1.0 - fraction.x : fraction.x ) * ( ( j == 0 ) ? 1.0 - fraction.y : fraction.y ) ;\n"
+    "            float  difference  = abs( texelFetch( uDepth , texel , 0 ).r - depth ) ;\n"
+    "            float  weight      = proximity / ( difference + sDepthTolerance ) ;\n"
+    "            sum       += weight * texelFetch( uColor , texel , 0 ) ;\n"
+    "            weightSum += weight ;\n"
+    "        }\n"
+    "    }\n"
+    "    vec4 color = sum / max( weightSum , 1.0e-20 ) ;\n"
+    "    if( color.a <= 0.0 && dot( color.rgb , vec3( 1.0 ) ) <= 0.0 )\n"
+    "    {   // Nothing rendered near this pixel.\n"
+    "        discard ;\n"
+    "    }\n"
+    "    gl_FragColor = color ;\n"
+    "}\n"
+    ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct reduced-resolution target.
+
+            This does not touch OpenGL; the first Begin does, since that requires a current OpenGL context.
+        */
+        OpenGL_ReducedResolution::OpenGL_ReducedResolution()
+            : mFramebufferName( 0 )
+            , mColorTextureName( 0 )
+            , mDepthTextureName( 0 )
+            , mFullDepthFramebufferName( 0 )
+            , mFullDepthTextureName( 0 )
+            , mPreviousFramebufferName( 0 )
+            , mFullWidth( 0 )
+            , mFullHeight( 0 )
+            , mDivisor( 1 )
+            , mIsSupported( -1 )
+            , mIsActive( false )
+        {
+            PERF_BLOCK( OpenGL_ReducedResolution__OpenGL_ReducedResolution ) ;
+
+            mViewport[ 0 ] = mViewport[ 1 ] = mViewport[ 2 ] = mViewport[ 3 ] = 0 ;
+        }
+
+
+
+
+        /** Destruct reduced-resolution target.
+
+            The OpenGL context that the first Begin used must still be current.
+        */
+        OpenGL_ReducedResolution::~OpenGL_ReducedResolution()
+        {
+            PERF_BLOCK( OpenGL_ReducedResolution__dtor ) ;
+
+            ASSERT( ! mIsActive ) ;
+            Deallocate() ;
+        }
+
+
+
+
+        /** Compile composite shader and create framebuffer objects and textures.
+
+            \return Whether the OpenGL driver supports everything this needs, and the shader compiled.
+        */
+        bool OpenGL_ReducedResolution::Initialize()
+        {
+            PERF_BLOCK( OpenGL_ReducedResolution__Initialize ) ;
+
+            if(     ! glGenFramebuffersEXT || ! glBindFramebufferEXT || ! glFramebufferTexture2DEXT || ! glCheckFramebufferStatusEXT || ! glBlitFramebufferEXT
+                ||  ! glBlendFuncSeparate || ! glActiveTexture || ! glUniform1i || ! glUniform4f
+                ||  ! glCreateShader || ! glCreateProgram || ! glGetUniformLocation )
+            {   // Driver lacks framebuffer objects, separate alpha blending or shaders.
+                return false ;
+            }
+
+            if( ! mCompositeShader.Compile( sCompositeSource , GL_FRAGMENT_SHADER ) )
+            {
+                return false ;
+            }
+
+            glGenFramebuffersEXT( 1 , & mFramebufferName ) ;
+            glGenFramebuffersEXT( 1 , & mFullDepthFramebufferName ) ;
+
+            GLuint * textureNames[] = { & mColorTextureName , & mDepthTextureName , & mFullDepthTextureName } ;
+            for( unsigned iTex = 0 ; iTex < sizeof( textureNames ) / sizeof( textureNames[ 0 ] ) ; ++ iTex )
+            {
+                glGenTextures( 1 , textureNames[ iTex ] ) ;
+                glBindTexture( GL_TEXTURE_2D , * textureNames[ iTex ] ) ;
+                glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , GL_NEAREST ) ; // Without mipmaps, the default filter would leave texture incomplete.
+                glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , GL_NEAREST ) ;
+            }
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            return ! RENDER_CHECK_ERROR( OpenGL_ReducedResolution_Initialize ) ;
+        }
+
+
+
+
+        /** Allocate textures with the given sizes and attach them to framebuffer objects.
+
+            \param fullWidth    Width, in pixels, of window region to cover.
+
+            \param fullHeight   Height, in pixels, of window region to cover.
+
+            \param divisor      Ratio of full resolution to reduced resolution, along each axis.
+
+            \return Whether both framebuffer objects are complete, i.e. whether the driver can render into them.
+        */
+        bool OpenGL_ReducedResolution::Resize( GLsizei fullWidth , GLsizei fullHeight , unsigned divisor )
+        {
+            PERF_BLOCK( OpenGL_ReducedResolution__Resize ) ;
+
+            const GLsizei d             = static_cast< GLsizei >( divisor ) ;
+            const GLsizei reducedWidth  = ( fullWidth  + d - 1 ) / d ;
+            const GLsizei reducedHeight = ( fullHeight + d - 1 ) / d ;
+
+            // Depth textures match format of typical window depth buffers, which glBlitFramebuffer requires.
+            glBindTexture( GL_TEXTURE_2D , mColorTextureName ) ;
+            glTexImage2D( GL_TEXTURE_2D , 0 , GL_RGBA8 , reducedWidth , reducedHeight , 0 , GL_RGBA , GL_UNSIGNED_BYTE , NULL ) ;
+            glBindTexture( GL_TEXTURE_2D , mDepthTextureName ) ;
+            glTexImage2D( GL_TEXTURE_2D , 0 , GL_DEPTH24_STENCIL8_EXT , reducedWidth , reducedHeight , 0 , GL_DEPTH_STENCIL_EXT , GL_UNSIGNED_INT_24_8_EXT , NULL ) ;
+            glBindTexture( GL_TEXTURE_2D , mFullDepthTextureName ) ;
+            glTexImage2D( GL_TEXTURE_2D , 0 , GL_DEPTH24_STENCIL8_EXT , fullWidth , fullHeight , 0 , GL_DEPTH_STENCIL_EXT , GL_UNSIGNED_INT_24_8_EXT , NULL ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mFramebufferName ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_COLOR_ATTACHMENT0_EXT , GL_TEXTURE_2D , mColorTextureName , 0 ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_DEPTH_ATTACHMENT_EXT   , GL_TEXTURE_2D , mDepthTextureName , 0 ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_STENCIL_ATTACHMENT_EXT , GL_TEXTURE_2D , mDepthTextureName , 0 ) ;
+            const GLenum status = glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT ) ;
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mFullDepthFramebufferName ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_DEPTH_ATTACHMENT_EXT   , GL_TEXTURE_2D , mFullDepthTextureName , 0 ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_STENCIL_ATTACHMENT_EXT , GL_TEXTURE_2D , mFullDepthTextureName , 0 ) ;
+            glDrawBuffer( GL_NONE ) ;   // Framebuffer has no color, only depth to copy into.
+            glReadBuffer( GL_NONE ) ;
+            const GLenum fullDepthStatus = glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT ) ;
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , 0 ) ;
+
+            mFullWidth  = fullWidth  ;
+            mFullHeight = fullHeight ;
+            mDivisor    = divisor    ;
+
+            return ( GL_FRAMEBUFFER_COMPLETE_EXT == status ) && ( GL_FRAMEBUFFER_COMPLETE_EXT == fullDepthStatus ) && ! RENDER_CHECK_ERROR( OpenGL_ReducedResolution_Resize ) ;
+        }
+
+
+
+
+        /** Delete composite shader, framebuffer objects and textures, if any.
+        */
+        void OpenGL_ReducedResolution::Deallocate()
+        {
+            mCompositeShader.Deallocate() ;
+            GLuint * framebufferNames[] = { & mFramebufferName , & mFullDepthFramebufferName } ;
+            for( unsigned iFb = 0 ; iFb < sizeof( framebufferNames ) / sizeof( framebufferNames[ 0 ] ) ; ++ iFb )
+            {
+                if( * framebufferNames[ iFb ] )
+                {
+                    glDeleteFramebuffersEXT( 1 , framebufferNames[ iFb ] ) ;
+                    * framebufferNames[ iFb ] = 0 ;
+                }
+            }
+            GLuint * textureNames[] = { & mColorTextureName , & mDepthTextureName , & mFullDepthTextureName } ;
+            for( unsigned iTex = 0 ; iTex < sizeof( textureNames ) / sizeof( textureNames[ 0 ] ) ; ++ iTex )
+            {
+                if( * textureNames[ iTex ] )
+                {
+                    glDeleteTextures( 1 , textureNames[ iTex ] ) ;
+                    * textureNames[ iTex ] = 0 ;
+                }
+            }
+            mFullWidth  = 0 ;
+            mFullHeight = 0 ;
+        }
+
+
+
+
+        /** Bind and clear reduced target, so subsequent geometry renders into it.
+
+            \param divisor  Ratio of full resolution to reduced resolution, along each axis, e.g. 2 for half or 4 for quarter resolution.
+
+            \return Whether reduced target is bound.  If not, geometry should render onto the window as usual.
+
+            Begin copies depth of the current viewport from the bound framebuffer
+            (usually the window), both at full resolution, for End to compare,
+            and reduced, so geometry depth-tests against opaque geometry already
+            drawn.  Begin then reduces the viewport to match, so transforms need
+            not change.
+
+            \note   The caller must also make blending keep coverage in target alpha.
+                    See OpenGL_RenderStateCache::SetPremultipliedTarget.
+        */
+        bool OpenGL_ReducedResolution::Begin( unsigned divisor )
+        {
+            PERF_BLOCK( OpenGL_ReducedResolution__Begin ) ;
+
+            ASSERT( ! mIsActive ) ;
+            ASSERT( divisor > 1 ) ;
+
+            if( mIsSupported < 0 )
+            {   // First call.
+                mIsSupported = Initialize() ? 1 : 0 ;
+            }
+            if( ! mIsSupported )
+            {
+                return false ;
+            }
+
+            glGetIntegerv( GL_VIEWPORT , mViewport ) ;
+            const GLint x0 = mViewport[ 0 ] ;
+            const GLint y0 = mViewport[ 1 ] ;
+            const GLint x1 = mViewport[ 0 ] + mViewport[ 2 ] ;
+            const GLint y1 = mViewport[ 1 ] + mViewport[ 3 ] ;
+            if( ( x1 != mFullWidth ) || ( y1 != mFullHeight ) || ( divisor != mDivisor ) )
+            {   // Window changed size, or caller changed divisor, so reallocate targets.
+                if( ! Resize( x1 , y1 , divisor ) )
+                {   // Driver cannot render into these targets, so stop trying.
+                    Deallocate() ;
+                    mIsSupported = 0 ;
+                    return false ;
+                }
+            }
+
+            // Reduced viewport covers at least every texel that full viewport touches.
+            const GLint d           = static_cast< GLint >( divisor ) ;
+            const GLint reducedX0   = x0 / d ;
+            const GLint reducedY0   = y0 / d ;
+            const GLint reducedX1   = ( x1 + d - 1 ) / d ;
+            const GLint reducedY1   = ( y1 + d - 1 ) / d ;
+
+            glGetIntegerv( GL_FRAMEBUFFER_BINDING_EXT , & mPreviousFramebufferName ) ;
+
+            {   // Copy depth of opaque geometry already drawn, at full and at reduced resolution.
+                PERF_BLOCK( OpenGL_ReducedResolution__Begin_CopyDepth ) ;
+                glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT , mPreviousFramebufferName ) ;
+                glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT , mFullDepthFramebufferName ) ;
+                glBlitFramebufferEXT( x0 , y0 , x1 , y1 , x0 , y0 , x1 , y1 , GL_DEPTH_BUFFER_BIT , GL_NEAREST ) ;
+                glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT , mFramebufferName ) ;
+                glBlitFramebufferEXT( x0 , y0 , x1 , y1 , reducedX0 , reducedY0 , reducedX1 , reducedY1 , GL_DEPTH_BUFFER_BIT , GL_NEAREST ) ; // Depth blits require nearest filtering.
+            }
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mFramebufferName ) ;
+            glViewport( reducedX0 , reducedY0 , reducedX1 - reducedX0 , reducedY1 - reducedY0 ) ;
+
+            {   // Clear color to transparent, i.e. nothing covers any pixel.
+                GLfloat clearColor[ 4 ] ;
+                glGetFloatv( GL_COLOR_CLEAR_VALUE , clearColor ) ;
+                glClearColor( 0.0f , 0.0f , 0.0f , 0.0f ) ;
+                glClear( GL_COLOR_BUFFER_BIT ) ;
+                glClearColor( clearColor[ 0 ] , clearColor[ 1 ] , clearColor[ 2 ] , clearColor[ 3 ] ) ;
+            }
+
+            mIsActive = true ;
+
+            return ! RENDER_CHECK_ERROR( OpenGL_ReducedResolution_Begin ) ;
+        }
+
+
+
+
+        /** Unbind reduced target, restore viewport, and upsample what it holds onto the framebuffer bound when Begin ran.
+
+            This leaves render state as it found it, except that afterward no texture or program is bound.
+        */
+        void OpenGL_ReducedResolution::End()
+        {
+            PERF_BLOCK( OpenGL_ReducedResolution__End ) ;
+
+            ASSERT( mIsActive ) ;
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , mPreviousFramebufferName ) ;
+            glViewport( mViewport[ 0 ] , mViewport[ 1 ] , mViewport[ 2 ] , mViewport[ 3 ] ) ;
+            mIsActive = false ;
+
+            glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_TRANSFORM_BIT ) ;
+
+            glActiveTexture( GL_TEXTURE2 ) ;
+            glBindTexture( GL_TEXTURE_2D , mFullDepthTextureName ) ;
+            glActiveTexture( GL_TEXTURE1 ) ;
+            glBindTexture( GL_TEXTURE_2D , mDepthTextureName ) ;
+            glActiveTexture( GL_TEXTURE0 ) ;
+            glBindTexture( GL_TEXTURE_2D , mColorTextureName ) ;
+
+            glDisable( GL_LIGHTING ) ;
+            glDisable( GL_ALPHA_TEST ) ;
+            glDisable( GL_CULL_FACE ) ;
+            glDisable( GL_DEPTH_TEST ) ;    // Begin already depth-tested against reduced depth, and upsampling respects full depth.
+            glDepthMask( GL_FALSE ) ;
+            glEnable( GL_BLEND ) ;
+            // Reduced target holds premultiplied color.  Blend alpha as coverage, in case destination composites later too.
+            glBlendFuncSeparate( GL_ONE , GL_ONE_MINUS_SRC_ALPHA , GL_ONE , GL_ONE_MINUS_SRC_ALPHA ) ;
+
+            // Map viewport in window coordinates onto reduced viewport in reduced texel coordinates.
+            const GLint     x0          = mViewport[ 0 ] ;
+            const GLint     y0          = mViewport[ 1 ] ;
+            const GLint     x1          = mViewport[ 0 ] + mViewport[ 2 ] ;
+            const GLint     y1          = mViewport[ 1 ] + mViewport[ 3 ] ;
+            const GLint     d           = static_cast< GLint >( mDivisor ) ;
+            const GLint     reducedX0   = x0 / d ;
+            const GLint     reducedY0   = y0 / d ;
+            const GLint     reducedX1   = ( x1 + d - 1 ) / d ;
+            const GLint     reducedY1   = ( y1 + d - 1 ) / d ;
+            const GLfloat   scaleX      = GLfloat( reducedX1 - reducedX0 ) / GLfloat( Max2( x1 - x0 , 1 ) ) ;
+            const GLfloat   scaleY      = GLfloat( reducedY1 - reducedY0 ) / GLfloat( Max2( y1 - y0 , 1 ) ) ;
+
+            mCompositeShader.Use() ;
+            glUniform1i( mCompositeShader.GetUniformLocation( "uColor"     ) , 0 ) ;
+            glUniform1i( mCompositeShader.GetUniformLocation( "uDepth"     ) , 1 ) ;
+            glUniform1i( mCompositeShader.GetUniformLocation( "uFullDepth" ) , 2 ) ;
+            glUniform4f( mCompositeShader.GetUniformLocation( "uFullToReduced" ) , scaleX , scaleY , GLfloat( reducedX0 ) - GLfloat( x0 ) * scaleX , GLfloat( reducedY0 ) - GLfloat( y0 ) * scaleY ) ;
+
+            {   // Draw quadrilateral that covers the viewport.
+                PERF_BLOCK( OpenGL_ReducedResolution__End_Composite ) ;
+                glMatrixMode( GL_PROJECTION ) ;
+                glPushMatrix() ;
+                glLoadIdentity() ;
+                glMatrixMode( GL_MODELVIEW ) ;
+                glPushMatrix() ;
+                glLoadIdentity() ;
+
+                glBegin( GL_QUADS ) ;
+                glVertex2f( -1.0f , -1.0f ) ;
+                glVertex2f(  1.0f , -1.0f ) ;
+                glVertex2f(  1.0f ,  1.0f ) ;
+                glVertex2f( -1.0f ,  1.0f ) ;
+                glEnd() ;
+
+                glPopMatrix() ;
+                glMatrixMode( GL_PROJECTION ) ;
+                glPopMatrix() ;
+            }
+
+            glUseProgram( 0 ) ;
+
+            glActiveTexture( GL_TEXTURE2 ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+            glActiveTexture( GL_TEXTURE1 ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+            glActiveTexture( GL_TEXTURE0 ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            glPopAttrib() ;
+            RENDER_CHECK_ERROR( OpenGL_ReducedResolution_End ) ;
+        }
+
+    } ;
+} ;
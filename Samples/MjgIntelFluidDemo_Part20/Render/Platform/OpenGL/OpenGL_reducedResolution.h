@@ -0,0 +1,91 @@
+/** \file OpenGL_reducedResolution.h
+
+    \brief Offscreen target, smaller than the window, that composites onto the window with depth-aware upsampling.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_REDUCED_RESOLUTION_H
+#define PEGASYS_RENDER_OPENGL_REDUCED_RESOLUTION_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+#include "Render/Platform/OpenGL/OpenGL_computeShader.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Offscreen target, smaller than the window, that composites onto the window with depth-aware upsampling.
+
+            Between Begin and End, geometry renders into a color target whose
+            width and height are the window's divided by some divisor, so
+            fill-rate-bound geometry such as particle billboards shades up to
+            divisor squared fewer pixels.  Begin copies window depth, reduced,
+            into that target, so geometry depth-tests against opaque geometry
+            already drawn.  Color starts transparent, and alpha accumulates
+            coverage (see OpenGL_RenderStateCache::SetPremultipliedTarget).
+
+            End composites that target onto the window with premultiplied
+            alpha.  Each window pixel takes a bilateral average of the nearest
+            four reduced texels: each texel weighs by how near it lies, as with
+            bilinear filtering, and by how similar its depth is to that pixel's
+            depth.  That keeps translucent geometry from bleeding across edges
+            of opaque geometry in front of or behind it, where plain bilinear
+            upsampling would leave halos.
+
+            This requires framebuffer objects, depth textures, separate alpha
+            blending, and a fragment shader to composite.  Without those,
+            Begin returns false.  Every method other than the constructor
+            requires that the OpenGL context that created this object be
+            current on the calling thread.
+        */
+        class OpenGL_ReducedResolution
+        {
+            public:
+                OpenGL_ReducedResolution() ;
+                ~OpenGL_ReducedResolution() ;
+
+                bool    Begin( unsigned divisor ) ;
+                void    End() ;
+
+                /// Return whether Begin succeeded more recently than End ran.
+                bool    IsActive() const { return mIsActive ; }
+
+            private:
+                OpenGL_ReducedResolution( const OpenGL_ReducedResolution & ) ;              // Disallow copy
+                OpenGL_ReducedResolution & operator=( const OpenGL_ReducedResolution & ) ;  // Disallow assignment
+
+                bool    Initialize() ;
+                bool    Resize( GLsizei fullWidth , GLsizei fullHeight , unsigned divisor ) ;
+                void    Deallocate() ;
+
+                OpenGL_ComputeShader    mCompositeShader            ;   ///< Fragment-only program that upsamples reduced target onto the window.
+                GLuint                  mFramebufferName            ;   ///< Identifier of framebuffer object that renders into reduced color and depth textures.
+                GLuint                  mColorTextureName           ;   ///< Identifier of texture holding premultiplied color (rgb) and coverage (a), at reduced resolution.
+                GLuint                  mDepthTextureName           ;   ///< Identifier of texture holding copy of window depth, at reduced resolution.
+                GLuint                  mFullDepthFramebufferName   ;   ///< Identifier of framebuffer object whose depth is mFullDepthTextureName.
+                GLuint                  mFullDepthTextureName       ;   ///< Identifier of texture holding copy of window depth, at full resolution, which End compares with reduced depths.
+                GLint                   mPreviousFramebufferName    ;   ///< Identifier of framebuffer bound when Begin ran, which End composites onto.
+                GLsizei                 mFullWidth                  ;   ///< Width, in pixels, of window region that targets cover.
+                GLsizei                 mFullHeight                 ;   ///< Height, in pixels, of window region that targets cover.
+                unsigned                mDivisor                    ;   ///< Ratio of full resolution to reduced resolution, along each axis.
+                GLint                   mViewport[ 4 ]              ;   ///< Window viewport when Begin ran, which End restores.
+                int                     mIsSupported                ;   ///< Whether driver supports everything this needs: 1 for yes, 0 for no, -1 for not yet queried.
+                bool                    mIsActive                   ;   ///< Whether reduced target is bound, between Begin and End.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
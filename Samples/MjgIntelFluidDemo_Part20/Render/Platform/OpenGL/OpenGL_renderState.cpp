@@ -8,6 +8,8 @@
 #include "Render/Platform/OpenGL/OpenGL_renderState.h"
 
 #include "Render/Platform/OpenGL/OpenGL_api.h" // for RENDER_CHECK_ERROR
+#include "Render/Platform/OpenGL/OpenGL_extensions.h"
+#include "Render/Platform/OpenGL/OpenGL_lighting.h"
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -30,10 +32,27 @@ namespace PeGaSys {
         // Public variables ------------------------------------------------------------
         // Private functions -----------------------------------------------------------
 
-        static void BlendState_Apply( const BlendStateS & blendState )
+        /** Apply blend state.
+
+            \param accumulateOrderIndependent  Whether order-independent transparency targets are bound.
+                If so, blend states with mOrderIndependent accumulate into them instead of blending.
+
+            \param premultipliedTarget  Whether bound target started transparent and will later composite with premultiplied alpha.
+                If so, alpha accumulates coverage: translucent fragments cover some of what lies behind, and additive fragments cover nothing.
+        */
+        static void BlendState_Apply( const BlendStateS & blendState , bool accumulateOrderIndependent , bool premultipliedTarget )
         {
             PERF_BLOCK( Render__BlendState_Apply ) ;
 
+            if( blendState.mOrderIndependent && accumulateOrderIndependent )
+            {   // Sum premultiplied color and coverage into draw buffer 0, and multiply transmittance into draw buffer 1.
+                glEnable( GL_BLEND ) ;
+                glBlendFuncSeparatei( 0 , GL_SRC_ALPHA , GL_ONE , GL_ONE , GL_ONE ) ;
+                glBlendFunci( 1 , GL_ZERO , GL_ONE_MINUS_SRC_ALPHA ) ;
+                RENDER_CHECK_ERROR( BlendState_Apply_OrderIndependent ) ;
+                return ;
+            }
+
             if( blendState.mBlendEnabled )
             {
                 glEnable( GL_BLEND ) ;
@@ -67,7 +86,25 @@ namespace PeGaSys {
             default: FAIL() ; break ;
             }
 
-            glBlendFunc( srcFactor , dstFactor ) ;
+            if( premultipliedTarget && blendState.mBlendEnabled && glBlendFuncSeparate )
+            {   // Target alpha must hold coverage, for compositing later.
+                if( GL_ONE_MINUS_SRC_ALPHA == dstFactor )
+                {   // Fragment covers what lies behind it, in proportion to its opacity.
+                    glBlendFuncSeparate( srcFactor , dstFactor , GL_ONE , GL_ONE_MINUS_SRC_ALPHA ) ;
+                }
+                else if( GL_ONE == dstFactor )
+                {   // Additive fragment adds light but covers nothing.
+                    glBlendFuncSeparate( srcFactor , dstFactor , GL_ZERO , GL_ONE ) ;
+                }
+                else
+                {
+                    glBlendFunc( srcFactor , dstFactor ) ;
+                }
+            }
+            else
+            {
+                glBlendFunc( srcFactor , dstFactor ) ;
+            }
 
             // TODO: FIXME: Support other blend modes.
             ASSERT( blendState.mBlendSrcColor == blendState.mBlendSrcAlpha ) ;
@@ -233,10 +270,13 @@ namespace PeGaSys {
             glEnable( GL_COLOR_MATERIAL ) ;
             //glDisable( GL_COLOR_MATERIAL ) ;
 
-            // Set material color.
-            // If vertices have a color, they will override this.
-            // This is only meaningful when the vertex format lacks color.
-            glColor4fv( (float*) & materialProperties.mDiffuseColor  ) ;
+            OpenGL_Lighting * lighting = OpenGL_Lighting::GetCurrent() ;
+            if( lighting && lighting->SetMaterial( materialProperties ) )
+            {   // Shader lighting reads material from its table, so fixed-function material does not matter.
+                return ;
+            }
+
+            // OpenGL_RenderStateCache::Apply sets current color (glColor) even when material properties did not change.
             glMaterialfv( GL_FRONT , GL_AMBIENT   , (float*) & materialProperties.mAmbientColor  ) ;
             glMaterialfv( GL_FRONT , GL_DIFFUSE   , (float*) & materialProperties.mDiffuseColor  ) ;
             glMaterialfv( GL_FRONT , GL_SPECULAR  , (float*) & materialProperties.mSpecularColor ) ;
@@ -266,6 +306,9 @@ namespace PeGaSys {
         /** Construct wrapper for routines specific to OpenGL render system API.
         */
         OpenGL_RenderStateCache::OpenGL_RenderStateCache()
+            : mIsCurrentStateValid( false )
+            , mAccumulateOrderIndependent( false )
+            , mPremultipliedTarget( false )
         {
             PERF_BLOCK( OpenGL_RenderStateCache__OpenGL_RenderStateCache ) ;
         }
@@ -284,6 +327,9 @@ namespace PeGaSys {
 
 
         /** Apply render state.
+
+            This only sets those parts of the given state that differ from what
+            the previous Apply set, unless Invalidate was called since then.
         */
         void OpenGL_RenderStateCache::Apply( const RenderStateS & renderState )
         {
@@ -291,40 +337,56 @@ namespace PeGaSys {
 
             RENDER_CHECK_ERROR( OpenGL_RenderStateCache_Apply_before ) ;
 
-            // TODO: FIXME: If render state has already been set, do not set it again.
             // TODO: FIXME: In debug mode, verify the underlying state matches the material.
 
-            //if( ! memcmp( & mCurrentState.mBlendState , & renderState.mBlendState , sizeof( mCurrentState.mBlendState ) ) )
+            const bool applyAll = ! mIsCurrentStateValid ;
+
+            if( applyAll || ! ( mCurrentState.mBlendState == renderState.mBlendState ) )
             {
-                BlendState_Apply( renderState.mBlendState ) ;
+                BlendState_Apply( renderState.mBlendState , mAccumulateOrderIndependent , mPremultipliedTarget ) ;
+                mCurrentState.mBlendState = renderState.mBlendState ;
             }
 
-            //if( ! memcmp( & mCurrentState.mDepthState , & renderState.mDepthState , sizeof( mCurrentState.mDepthState ) ) )
+            if( applyAll || ! ( mCurrentState.mDepthState == renderState.mDepthState ) )
             {
                 DepthState_Apply( renderState.mDepthState ) ;
+                mCurrentState.mDepthState = renderState.mDepthState ;
             }
 
-            //if( ! memcmp( & mCurrentState.mAlphaState , & renderState.mAlphaState , sizeof( mCurrentState.mAlphaState ) ) )
+            if( applyAll || ! ( mCurrentState.mAlphaState == renderState.mAlphaState ) )
             {
                 AlphaState_Apply( renderState.mAlphaState ) ;
+                mCurrentState.mAlphaState = renderState.mAlphaState ;
             }
 
-            //if( ! memcmp( & mCurrentState.mRasterState , & renderState.mRasterState , sizeof( mCurrentState.mRasterState ) ) )
+            if( applyAll || ! ( mCurrentState.mRasterState == renderState.mRasterState ) )
             {
                 RasterState_Apply( renderState.mRasterState ) ;
+                mCurrentState.mRasterState = renderState.mRasterState ;
             }
 
-            //if( ! memcmp( & mCurrentState.mShadeMode , & renderState.mShadeMode , sizeof( mCurrentState.mShadeMode ) ) )
+            if( applyAll || ( mCurrentState.mShadeMode != renderState.mShadeMode ) )
             {
                 ShadeMode_Apply( renderState.mShadeMode ) ;
+                mCurrentState.mShadeMode = renderState.mShadeMode ;
             }
 
-            //if( ! memcmp( & mCurrentState.mMaterialProperties , & renderState.mMaterialProperties , sizeof( mCurrentState.mMaterialProperties ) ) )
+            if( applyAll || ! ( mCurrentState.mMaterialProperties == renderState.mMaterialProperties ) )
             {
                 MaterialProperties_Apply( renderState.mMaterialProperties ) ;
+                mCurrentState.mMaterialProperties = renderState.mMaterialProperties ;
             }
 
-            mCurrentState = renderState ;
+            // Set material color, which applies to vertices that lack color.
+            // Drawing vertices that have colors leaves the current color undefined, so set it regardless of whether material properties changed.
+            glColor4fv( (const float*) & renderState.mMaterialProperties.mDiffuseColor ) ;
+
+            // Stencil state and shader are not yet applied but are recorded, to keep GetRenderStateCache consistent with what callers asked for.
+            // Transforms are not part of render state that Apply sets; OpenGL_Api maintains mCurrentState.mTransforms.
+            mCurrentState.mStencilState = renderState.mStencilState ;
+            mCurrentState.mShader       = renderState.mShader       ;
+
+            mIsCurrentStateValid = true ;
 
             RENDER_CHECK_ERROR( OpenGL_RenderStateCache_Apply_after ) ;
         }
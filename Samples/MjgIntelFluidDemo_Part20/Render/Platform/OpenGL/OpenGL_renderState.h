@@ -28,6 +28,27 @@ namespace PeGaSys
 
                 void Apply( const RenderStateS & renderState  ) ;
 
+                /** Forget what render state the underlying API has, so the next Apply sets all of it.
+
+                    Call this after code that changes blend, depth, alpha-test, raster,
+                    shade or material state without going through Apply.
+                */
+                void Invalidate() { mIsCurrentStateValid = false ; }
+
+                /** Set whether order-independent transparency targets are bound, so order-independent blend states accumulate into them.
+
+                    That changes what blend state means, so the next Apply sets all of it.
+                */
+                void SetOrderIndependentAccumulation( bool accumulate ) { mAccumulateOrderIndependent = accumulate ; Invalidate() ; }
+
+                /** Set whether the bound target started transparent and will later composite onto another with premultiplied alpha.
+
+                    If so, blending keeps coverage in target alpha, instead of
+                    blending alpha with color factors.  That changes what blend
+                    state means, so the next Apply sets all of it.
+                */
+                void SetPremultipliedTarget( bool premultiplied ) { mPremultipliedTarget = premultiplied ; Invalidate() ; }
+
                 const RenderStateS & GetRenderStateCache() const { return mCurrentState ; }
 
                 static void GetRenderState( RenderStateS & renderState ) ;
@@ -35,7 +56,10 @@ namespace PeGaSys
             private:
                 friend class OpenGL_Api ; // Allow OpenGL_Api to set mCurrentState.
 
-                RenderStateS mCurrentState   ;   ///< Cache of current render state.  Used to avoid unnecessary state change calls into underlying API.
+                RenderStateS mCurrentState          ;   ///< Cache of current render state.  Used to avoid unnecessary state change calls into underlying API.
+                bool         mIsCurrentStateValid   ;   ///< Whether mCurrentState matches the underlying API, apart from mTransforms, which OpenGL_Api maintains.
+                bool         mAccumulateOrderIndependent ;  ///< Whether order-independent transparency targets are bound.  See SetOrderIndependentAccumulation.
+                bool         mPremultipliedTarget   ;   ///< Whether bound target keeps coverage in alpha, to composite later.  See SetPremultipliedTarget.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -0,0 +1,534 @@
+/** \file OpenGL_textBatch.cpp
+
+    \brief Batch of bitmap-font text drawn as textured quadrilaterals from a font atlas, with one draw call.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Platform/OpenGL/OpenGL_textBatch.h"
+
+#include "Render/Platform/OpenGL/OpenGL_api.h" // For RENDER_CHECK_ERROR
+#include "Render/Platform/OpenGL/OpenGL_extensions.h"
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+#include <GL/glu.h>
+#include <GL/glut.h>
+
+#include "glExt.h"
+
+#include <math.h>
+#include <string.h>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+
+/** GLUT bitmap fonts the atlas holds, in the order of their rows in it.
+
+    Each must have glyphs no wider than CELL_WIDTH - CELL_ORIGIN_X, no taller
+    than CELL_HEIGHT - CELL_ORIGIN_Y and with descent no deeper than CELL_ORIGIN_Y.
+*/
+static void * const sAtlasFonts[] =
+{
+    GLUT_BITMAP_8_BY_13         ,
+    GLUT_BITMAP_9_BY_15         ,
+    GLUT_BITMAP_HELVETICA_10    ,
+    GLUT_BITMAP_HELVETICA_12    ,
+} ;
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Set matrices so vertex x and y are window coordinates, in pixels, from lower left of window, and z is window depth.
+
+    \param viewport Current viewport, as x, y, width and height.
+*/
+static void PushWindowProjection( const GLint viewport[ 4 ] )
+{
+    glMatrixMode( GL_PROJECTION ) ;
+    glPushMatrix() ;
+    glLoadIdentity() ;
+    // Near plane at z=0 and far plane at z=-1 map eye z directly to window depth, in [0,1].
+    glOrtho( viewport[ 0 ] , viewport[ 0 ] + viewport[ 2 ] , viewport[ 1 ] , viewport[ 1 ] + viewport[ 3 ] , 0.0 , -1.0 ) ;
+    glMatrixMode( GL_MODELVIEW ) ;
+    glPushMatrix() ;
+    glLoadIdentity() ;
+}
+
+
+
+
+/// Restore matrices that PushWindowProjection replaced.
+static void PopWindowProjection()
+{
+    glMatrixMode( GL_PROJECTION ) ;
+    glPopMatrix() ;
+    glMatrixMode( GL_MODELVIEW ) ;
+    glPopMatrix() ;
+}
+
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct text batch.
+
+            This declares the vertex format but does not otherwise touch OpenGL;
+            the first Flush does, since that requires a current OpenGL context.
+        */
+        OpenGL_TextBatch::OpenGL_TextBatch()
+            : mAtlasTextureName( 0 )
+            , mIsSupported( -1 )
+        {
+            PERF_BLOCK( OpenGL_TextBatch__OpenGL_TextBatch ) ;
+
+            ASSERT( sizeof( sAtlasFonts ) / sizeof( sAtlasFonts[ 0 ] ) == MAX_FONTS ) ;
+            ASSERT( MAX_FONTS * ROWS_PER_FONT * CELL_HEIGHT <= ATLAS_HEIGHT ) ;
+
+            memset( mAdvances , 0 , sizeof( mAdvances ) ) ;
+
+            VertexBufferBase & vertexBuffer = mVertexBuffer ;
+            vertexBuffer.DeclareVertexFormat( VertexDeclaration( VertexDeclaration::POSITION_COLOR_TEXTURE ) ) ;
+            vertexBuffer.SetUsage( VertexBufferBase::USAGE_STREAM ) ;  // Text changes every frame.
+        }
+
+
+
+
+        /** Destruct text batch.
+
+            If Flush ever ran, the OpenGL context it used must still be current.
+        */
+        OpenGL_TextBatch::~OpenGL_TextBatch()
+        {
+            PERF_BLOCK( OpenGL_TextBatch__dtor ) ;
+
+            if( mAtlasTextureName != 0 )
+            {
+                glDeleteTextures( 1 , & mAtlasTextureName ) ;
+            }
+        }
+
+
+
+
+        /** Queue text to draw during the next Flush.
+
+            \param position         Pen position of first glyph.  When useScreenSpace, this is
+                                    in pixels from the upper left of the viewport, as with
+                                    OpenGL_Api::RenderSimpleText.  Otherwise, this is in
+                                    whatever coordinate space the current matrices transform from.
+
+            \param useScreenSpace   Whether position is in screen space, so text appears in front of everything.
+
+            \param font             GLUT bitmap font, such as GLUT_BITMAP_HELVETICA_10.
+
+            \param color            Color of text, including opacity.
+
+            \param text             Text to draw.  This copies it, so it need not outlive this call.
+        */
+        void OpenGL_TextBatch::AddText( const Vec3 & position , bool useScreenSpace , void * font , const Vec4 & color , const char * text )
+        {
+            PERF_BLOCK( OpenGL_TextBatch__AddText ) ;
+
+            GLint viewport[ 4 ] ;
+            glGetIntegerv( GL_VIEWPORT , viewport ) ;
+
+            QueuedString queuedString ;
+            if( useScreenSpace )
+            {   // Position is in pixels from upper left of viewport.
+                queuedString.mWindowPosition = Vec3( float( viewport[ 0 ] ) + position.x , float( viewport[ 1 ] + viewport[ 3 ] ) - position.y , 0.0f ) ;
+            }
+            else
+            {   // Position is in model space of current matrices.  Project it the way glRasterPos would.
+                GLdouble modelView[ 16 ] ;
+                GLdouble projection[ 16 ] ;
+                glGetDoublev( GL_MODELVIEW_MATRIX  , modelView  ) ;
+                glGetDoublev( GL_PROJECTION_MATRIX , projection ) ;
+                GLdouble windowX , windowY , windowZ ;
+                if( ! gluProject( position.x , position.y , position.z , modelView , projection , viewport , & windowX , & windowY , & windowZ ) )
+                {   // Projection failed, e.g. because position lies in the plane of the eye.
+                    return ;
+                }
+                if(     ( windowZ < 0.0 ) || ( windowZ > 1.0 )
+                    ||  ( windowX < viewport[ 0 ] ) || ( windowX > viewport[ 0 ] + viewport[ 2 ] )
+                    ||  ( windowY < viewport[ 1 ] ) || ( windowY > viewport[ 1 ] + viewport[ 3 ] ) )
+                {   // Position lies outside view volume, where glRasterPos would make raster position invalid and draw nothing.
+                    return ;
+                }
+                queuedString.mWindowPosition = Vec3( float( windowX ) , float( windowY ) , float( windowZ ) ) ;
+            }
+            queuedString.mColor             = color ;
+            queuedString.mFont              = font ;
+            queuedString.mFirstChar         = mCharacters.Size() ;
+            queuedString.mNumChars          = strlen( text ) ;
+            queuedString.mUseScreenSpace    = useScreenSpace ;
+            mCharacters.insert( mCharacters.End() , text , text + queuedString.mNumChars ) ;
+            mStrings.PushBack( queuedString ) ;
+        }
+
+
+
+
+        /** Draw all text queued since the previous Flush, then empty the queue.
+
+            This leaves render state as it found it, except that afterward no
+            texture or vertex buffer is bound.
+        */
+        void OpenGL_TextBatch::Flush()
+        {
+            PERF_BLOCK( OpenGL_TextBatch__Flush ) ;
+
+            if( mStrings.Empty() )
+            {   // Nothing to draw.
+                return ;
+            }
+
+            if( mIsSupported < 0 )
+            {   // First call.
+                mIsSupported = BuildAtlas() ? 1 : 0 ;
+            }
+
+            if( ! mIsSupported )
+            {   // Driver cannot build atlas, so draw every glyph as a bitmap.
+                DrawBitmaps( /* only unsupported fonts */ false ) ;
+            }
+            else
+            {
+                size_t numGlyphs = 0 ;
+                for( size_t iString = 0 ; iString < mStrings.Size() ; ++ iString )
+                {   // For each queued string...
+                    numGlyphs += mStrings[ iString ].mNumChars ;
+                }
+                const size_t numVertices = 4 * numGlyphs ;
+
+                VertexBufferBase & vertexBuffer = mVertexBuffer ;
+                vertexBuffer.SetPopulation( 0 ) ;
+                if( numVertices > vertexBuffer.GetCapacity() )
+                {   // Vertex buffer is too small.  Grow it at least by double, so text whose length varies seldom reallocates.
+                    if( 0 == vertexBuffer.GetCapacity() )
+                    {
+                        vertexBuffer.Allocate( numVertices ) ;
+                    }
+                    else
+                    {
+                        vertexBuffer.ChangeCapacityAndReallocate( Max2( numVertices , 2 * vertexBuffer.GetCapacity() ) ) ;
+                    }
+                }
+                vertexBuffer.SetPopulation( numVertices ) ;
+
+                // Screen-space glyphs go first, then world-space glyphs, so each draws with one call.
+                Vertex *        vertices        = static_cast< Vertex * >( vertexBuffer.LockVertexData() ) ;
+                const size_t    numScreenVerts  = FillQuads( vertices                  , true  ) ;
+                const size_t    numWorldVerts   = FillQuads( vertices + numScreenVerts , false ) ;
+                vertexBuffer.UnlockVertexData() ;
+
+                DrawQuads( numScreenVerts , numWorldVerts , false ) ;
+                DrawQuads( 0 , numScreenVerts , true ) ;
+
+                DrawBitmaps( /* only unsupported fonts */ true ) ;
+            }
+
+            mStrings.Clear() ;
+            mCharacters.Clear() ;
+
+            RENDER_CHECK_ERROR( OpenGL_TextBatch_Flush ) ;
+        }
+
+
+
+
+        /** Create atlas texture and draw glyphs of every font in sAtlasFonts into it.
+
+            \return Whether the driver supports framebuffer objects and could render into the atlas.
+        */
+        bool OpenGL_TextBatch::BuildAtlas()
+        {
+            PERF_BLOCK( OpenGL_TextBatch__BuildAtlas ) ;
+
+            if( ! glGenFramebuffersEXT || ! glBindFramebufferEXT || ! glFramebufferTexture2DEXT || ! glCheckFramebufferStatusEXT || ! glDeleteFramebuffersEXT )
+            {   // Driver lacks framebuffer objects.
+                return false ;
+            }
+
+            glGenTextures( 1 , & mAtlasTextureName ) ;
+            glBindTexture( GL_TEXTURE_2D , mAtlasTextureName ) ;
+            glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , GL_NEAREST ) ; // Glyphs map to pixels one to one, and without mipmaps, the default filter would leave texture incomplete.
+            glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , GL_NEAREST ) ;
+            glTexImage2D( GL_TEXTURE_2D , 0 , GL_RGBA8 , ATLAS_WIDTH , ATLAS_HEIGHT , 0 , GL_RGBA , GL_UNSIGNED_BYTE , NULL ) ;
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+            GLint previousFramebufferName = 0 ;
+            glGetIntegerv( GL_FRAMEBUFFER_BINDING_EXT , & previousFramebufferName ) ;
+
+            GLuint framebufferName = 0 ;
+            glGenFramebuffersEXT( 1 , & framebufferName ) ;
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , framebufferName ) ;
+            glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT , GL_COLOR_ATTACHMENT0_EXT , GL_TEXTURE_2D , mAtlasTextureName , 0 ) ;
+            const bool isComplete = GL_FRAMEBUFFER_COMPLETE_EXT == glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT ) ;
+
+            if( isComplete )
+            {   // Draw each glyph at the pen position of its cell.
+                glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_VIEWPORT_BIT | GL_CURRENT_BIT ) ;
+                glDisable( GL_DEPTH_TEST ) ;
+                glDisable( GL_LIGHTING ) ;
+                glDisable( GL_TEXTURE_2D ) ;
+                glDisable( GL_BLEND ) ;
+                glDisable( GL_ALPHA_TEST ) ;
+                glDisable( GL_FOG ) ;
+
+                const GLint atlasViewport[ 4 ] = { 0 , 0 , ATLAS_WIDTH , ATLAS_HEIGHT } ;
+                glViewport( 0 , 0 , ATLAS_WIDTH , ATLAS_HEIGHT ) ;
+                PushWindowProjection( atlasViewport ) ;
+
+                // Texels outside glyphs are white but transparent, so glyph color comes entirely from vertex color.
+                glClearColor( 1.0f , 1.0f , 1.0f , 0.0f ) ;
+                glClear( GL_COLOR_BUFFER_BIT ) ;
+                glColor4f( 1.0f , 1.0f , 1.0f , 1.0f ) ;
+
+                for( int iFont = 0 ; iFont < MAX_FONTS ; ++ iFont )
+                {   // For each font...
+                    for( int iChar = 0 ; iChar < NUM_CHARACTERS ; ++ iChar )
+                    {   // For each printable character...
+                        const int cellX = ( iChar % CELLS_PER_ROW ) * CELL_WIDTH ;
+                        const int cellY = ( iFont * ROWS_PER_FONT + iChar / CELLS_PER_ROW ) * CELL_HEIGHT ;
+                        glRasterPos2i( cellX + CELL_ORIGIN_X , cellY + CELL_ORIGIN_Y ) ;
+                        glutBitmapCharacter( sAtlasFonts[ iFont ] , FIRST_CHARACTER + iChar ) ;
+                        mAdvances[ iFont ][ iChar ] = static_cast< unsigned char >( glutBitmapWidth( sAtlasFonts[ iFont ] , FIRST_CHARACTER + iChar ) ) ;
+                    }
+                }
+
+                PopWindowProjection() ;
+                glPopAttrib() ;
+            }
+
+            glBindFramebufferEXT( GL_FRAMEBUFFER_EXT , previousFramebufferName ) ;
+            glDeleteFramebuffersEXT( 1 , & framebufferName ) ;
+
+            if( ! isComplete || RENDER_CHECK_ERROR( OpenGL_TextBatch_BuildAtlas ) )
+            {   // Driver cannot render into atlas.
+                glDeleteTextures( 1 , & mAtlasTextureName ) ;
+                mAtlasTextureName = 0 ;
+                return false ;
+            }
+            return true ;
+        }
+
+
+
+
+        /** Return index of the given font in sAtlasFonts, or -1 if the atlas lacks it.
+        */
+        int OpenGL_TextBatch::GetFontIndex( void * font ) const
+        {
+            for( int iFont = 0 ; iFont < MAX_FONTS ; ++ iFont )
+            {
+                if( sAtlasFonts[ iFont ] == font )
+                {
+                    return iFont ;
+                }
+            }
+            return -1 ;
+        }
+
+
+
+
+        /** Write quadrilaterals for glyphs of queued strings in the given space, whose fonts the atlas holds.
+
+            \param vertices         Address of vertices to write, which must have room for 4 per queued character.
+
+            \param useScreenSpace   Whether to write glyphs of screen-space strings, or of world-space strings.
+
+            \return Number of vertices written.
+
+            Characters the atlas lacks advance the pen like a space.
+        */
+        size_t OpenGL_TextBatch::FillQuads( Vertex * vertices , bool useScreenSpace ) const
+        {
+            PERF_BLOCK( OpenGL_TextBatch__FillQuads ) ;
+
+            static const float  texelWidth  = 1.0f / float( ATLAS_WIDTH  ) ;
+            static const float  texelHeight = 1.0f / float( ATLAS_HEIGHT ) ;
+
+            size_t numVertices = 0 ;
+            for( size_t iString = 0 ; iString < mStrings.Size() ; ++ iString )
+            {   // For each queued string...
+                const QueuedString &    queuedString    = mStrings[ iString ] ;
+                const int               iFont           = GetFontIndex( queuedString.mFont ) ;
+                if( ( queuedString.mUseScreenSpace != useScreenSpace ) || ( iFont < 0 ) )
+                {   // String belongs to the other draw call, or DrawBitmaps draws it.
+                    continue ;
+                }
+
+                unsigned char rgba[ 4 ] ;
+                for( unsigned component = 0 ; component < 4 ; ++ component )
+                {
+                    rgba[ component ] = static_cast< unsigned char >( Clamp( queuedString.mColor[ component ] , 0.0f , 1.0f ) * 255.0f + 0.5f ) ;
+                }
+
+                // Glyph bitmaps start at whole pixels, as glBitmap would place them.
+                float           penX    = floorf( queuedString.mWindowPosition.x ) ;
+                const float     penY    = floorf( queuedString.mWindowPosition.y ) ;
+                const float     depth   = queuedString.mWindowPosition.z ;
+                const float     y0      = penY - float( CELL_ORIGIN_Y ) ;
+                const float     y1      = y0 + float( CELL_HEIGHT ) ;
+                for( size_t iChar = 0 ; iChar < queuedString.mNumChars ; ++ iChar )
+                {   // For each character in this string...
+                    const int glyph = static_cast< unsigned char >( mCharacters[ queuedString.mFirstChar + iChar ] ) - FIRST_CHARACTER ;
+                    if( ( glyph <= 0 ) || ( glyph >= NUM_CHARACTERS ) )
+                    {   // Character is a space, which has no quadrilateral, or lies outside atlas.
+                        penX += float( mAdvances[ iFont ][ 0 ] ) ;
+                        continue ;
+                    }
+
+                    const int       cellX   = ( glyph % CELLS_PER_ROW ) * CELL_WIDTH ;
+                    const int       cellY   = ( iFont * ROWS_PER_FONT + glyph / CELLS_PER_ROW ) * CELL_HEIGHT ;
+                    const float     s0      = float( cellX ) * texelWidth ;
+                    const float     s1      = float( cellX + CELL_WIDTH ) * texelWidth ;
+                    const float     t0      = float( cellY ) * texelHeight ;
+                    const float     t1      = float( cellY + CELL_HEIGHT ) * texelHeight ;
+                    const float     x0      = penX - float( CELL_ORIGIN_X ) ;
+                    const float     x1      = x0 + float( CELL_WIDTH ) ;
+
+                    const float corners[ 4 ][ 4 ] = { { x0 , y0 , s0 , t0 } , { x1 , y0 , s1 , t0 } , { x1 , y1 , s1 , t1 } , { x0 , y1 , s0 , t1 } } ;
+                    for( unsigned iCorner = 0 ; iCorner < 4 ; ++ iCorner )
+                    {   // For each corner of this glyph quadrilateral...
+                        Vertex & vertex = vertices[ numVertices ++ ] ;
+                        vertex.ts = corners[ iCorner ][ 2 ] ;
+                        vertex.tt = corners[ iCorner ][ 3 ] ;
+                        memcpy( vertex.crgba , rgba , sizeof( rgba ) ) ;
+                        vertex.px = corners[ iCorner ][ 0 ] ;
+                        vertex.py = corners[ iCorner ][ 1 ] ;
+                        vertex.pz = depth ;
+                    }
+
+                    penX += float( mAdvances[ iFont ][ glyph ] ) ;
+                }
+            }
+            return numVertices ;
+        }
+
+
+
+
+        /** Draw a range of glyph quadrilaterals from the vertex buffer with one call, textured by the atlas.
+
+            \param firstVertex      Index of first vertex to draw.
+
+            \param numVertices      Number of vertices to draw.
+
+            \param useScreenSpace   Whether glyphs lie in screen space, so they draw without depth testing.
+        */
+        void OpenGL_TextBatch::DrawQuads( size_t firstVertex , size_t numVertices , bool useScreenSpace )
+        {
+            PERF_BLOCK( OpenGL_TextBatch__DrawQuads ) ;
+
+            if( 0 == numVertices )
+            {   // Nothing to draw.
+                return ;
+            }
+
+            GLint viewport[ 4 ] ;
+            glGetIntegerv( GL_VIEWPORT , viewport ) ;
+            if( ( 0 == viewport[ 2 ] ) || ( 0 == viewport[ 3 ] ) )
+            {   // Zero-size viewport, e.g. because window is minimized.
+                return ;
+            }
+
+            // As with bitmaps, text keeps the current depth function and mask.  Alpha testing keeps transparent texels out of depth.
+            glPushAttrib( GL_DEPTH_BUFFER_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT ) ;
+            glDisable( GL_LIGHTING ) ;
+            glEnable( GL_BLEND ) ;
+            glBlendFunc( GL_SRC_ALPHA , GL_ONE_MINUS_SRC_ALPHA ) ;  // Typical alpha blending
+            glEnable( GL_ALPHA_TEST ) ;
+            glAlphaFunc( GL_GREATER , 0.0f ) ;
+            if( useScreenSpace )
+            {   // Only when drawing in screen space...
+                glDisable( GL_DEPTH_TEST ) ;    // Disable depth test so text appears as if in front of everything already drawn.
+            }
+            glEnable( GL_TEXTURE_2D ) ;
+            glBindTexture( GL_TEXTURE_2D , mAtlasTextureName ) ;
+            glTexEnvi( GL_TEXTURE_ENV , GL_TEXTURE_ENV_MODE , GL_MODULATE ) ;
+
+            PushWindowProjection( viewport ) ;
+
+            mVertexBuffer.BindVertexData() ;
+            glDrawArrays( GL_QUADS , static_cast< GLint >( firstVertex ) , static_cast< GLsizei >( numVertices ) ) ;
+            mVertexBuffer.UnbindVertexData() ;
+
+            // Restore state that immediate-mode drawing expects.
+            glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
+            glDisableClientState( GL_COLOR_ARRAY ) ;
+            glDisableClientState( GL_VERTEX_ARRAY ) ;
+            if( glBindBuffer )
+            {   // Display supports vertex buffer objects.  Unbind this one, so client-side vertex arrays drawn later do not read from it.
+                glBindBuffer( GL_ARRAY_BUFFER , 0 ) ;
+            }
+
+            PopWindowProjection() ;
+
+            glBindTexture( GL_TEXTURE_2D , 0 ) ;
+            glPopAttrib() ;
+
+            RENDER_CHECK_ERROR( OpenGL_TextBatch_DrawQuads ) ;
+        }
+
+
+
+
+        /** Draw queued strings one glyph at a time, as glutBitmapCharacter does.
+
+            \param onlyUnsupportedFonts Whether to draw only strings whose fonts the atlas lacks.
+        */
+        void OpenGL_TextBatch::DrawBitmaps( bool onlyUnsupportedFonts ) const
+        {
+            PERF_BLOCK( OpenGL_TextBatch__DrawBitmaps ) ;
+
+            GLint viewport[ 4 ] ;
+            glGetIntegerv( GL_VIEWPORT , viewport ) ;
+            if( ( 0 == viewport[ 2 ] ) || ( 0 == viewport[ 3 ] ) )
+            {   // Zero-size viewport, e.g. because window is minimized.
+                return ;
+            }
+
+            PushWindowProjection( viewport ) ;
+            for( size_t iString = 0 ; iString < mStrings.Size() ; ++ iString )
+            {   // For each queued string...
+                const QueuedString & queuedString = mStrings[ iString ] ;
+                if( onlyUnsupportedFonts && ( GetFontIndex( queuedString.mFont ) >= 0 ) )
+                {   // DrawQuads already drew this string.
+                    continue ;
+                }
+
+                glPushAttrib( GL_DEPTH_BUFFER_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT ) ;
+                glDisable( GL_LIGHTING ) ;
+                glDisable( GL_TEXTURE_2D ) ;
+                glEnable( GL_BLEND ) ;
+                glBlendFunc( GL_SRC_ALPHA , GL_ONE_MINUS_SRC_ALPHA ) ;  // Typical alpha blending
+                if( queuedString.mUseScreenSpace )
+                {   // Only when drawing in screen space...
+                    glDisable( GL_DEPTH_TEST ) ;    // Disable depth test so text appears as if in front of everything already drawn.
+                }
+
+                glColor4fv( reinterpret_cast< const GLfloat * >( & queuedString.mColor ) ) ;
+                glRasterPos3f( queuedString.mWindowPosition.x , queuedString.mWindowPosition.y , queuedString.mWindowPosition.z ) ;
+                for( size_t iChar = 0 ; iChar < queuedString.mNumChars ; ++ iChar )
+                {
+                    glutBitmapCharacter( queuedString.mFont , mCharacters[ queuedString.mFirstChar + iChar ] ) ;
+                }
+
+                glPopAttrib() ;
+            }
+            PopWindowProjection() ;
+
+            RENDER_CHECK_ERROR( OpenGL_TextBatch_DrawBitmaps ) ;
+        }
+
+
+
+
+    } ;
+} ;
@@ -0,0 +1,115 @@
+/** \file OpenGL_textBatch.h
+
+    \brief Batch of bitmap-font text drawn as textured quadrilaterals from a font atlas, with one draw call.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_OPENGL_TEXT_BATCH_H
+#define PEGASYS_RENDER_OPENGL_TEXT_BATCH_H
+
+#if defined( WIN32 )
+#   include <windows.h> // for WINGDIAPI, APIENTRY, CALLBACK, used by gl.h.
+#endif
+
+#include <GL/gl.h>
+
+#include "Render/Platform/OpenGL/OpenGL_vertexBuffer.h"
+
+#include "Core/Containers/vector.h"
+#include "Core/Math/vec4.h"
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Batch of bitmap-font text drawn as textured quadrilaterals from a font atlas, with one draw call.
+
+            Drawing text with glutBitmapCharacter costs a driver call (and a
+            pixel transfer) per glyph, so a screen full of diagnostic text
+            costs milliseconds.
+
+            Instead, AddText queues text, and Flush builds a quadrilateral per
+            glyph into one streaming vertex buffer, then draws screen-space
+            text with one call and world-space text with another.  Glyphs
+            come from an atlas texture that Flush builds, the first time,
+            by drawing each printable character of each supported GLUT
+            bitmap font into a framebuffer object.  Quadrilaterals align
+            with pixels and the atlas uses nearest filtering, so text looks
+            the same as glutBitmapCharacter would draw it.
+
+            AddText projects world-space positions using the matrices and
+            viewport current when it runs, so text need not be flushed before
+            those change.  World-space text depth tests against the scene,
+            as bitmaps would; screen-space text appears in front of everything.
+
+            Without framebuffer objects, or for fonts the atlas lacks, Flush
+            falls back to glutBitmapCharacter.
+
+            Every method other than the constructor requires that the OpenGL
+            context be current on the calling thread.
+        */
+        class OpenGL_TextBatch
+        {
+            public:
+                OpenGL_TextBatch() ;
+                ~OpenGL_TextBatch() ;
+
+                void    AddText( const Vec3 & position , bool useScreenSpace , void * font , const Vec4 & color , const char * text ) ;
+                void    Flush() ;
+
+                /// Return whether this has text that Flush has not yet drawn.
+                bool    IsEmpty() const { return mStrings.Empty() ; }
+
+            private:
+                typedef OpenGL_VertexBuffer::VertexFormatPositionColor4Texture2 Vertex ;
+
+                static const int    FIRST_CHARACTER = 32    ;   ///< First character the atlas holds (space).
+                static const int    NUM_CHARACTERS  = 95    ;   ///< Number of consecutive characters the atlas holds, through '~'.
+                static const int    CELL_WIDTH      = 16    ;   ///< Width, in texels, of atlas cell holding one glyph.
+                static const int    CELL_HEIGHT     = 20    ;   ///< Height, in texels, of atlas cell holding one glyph.
+                static const int    CELL_ORIGIN_X   = 2     ;   ///< Texels between left side of cell and pen position of its glyph.
+                static const int    CELL_ORIGIN_Y   = 5     ;   ///< Texels between bottom of cell and baseline of its glyph, which leaves room for descenders.
+                static const int    CELLS_PER_ROW   = 16    ;   ///< Number of atlas cells along each row.
+                static const int    ROWS_PER_FONT   = ( NUM_CHARACTERS + CELLS_PER_ROW - 1 ) / CELLS_PER_ROW ; ///< Number of atlas rows each font occupies.
+                static const int    MAX_FONTS       = 4     ;   ///< Number of fonts the atlas holds.
+                static const int    ATLAS_WIDTH     = CELLS_PER_ROW * CELL_WIDTH ;  ///< Width, in texels, of atlas.
+                static const int    ATLAS_HEIGHT    = 512   ;   ///< Height, in texels, of atlas, which must span MAX_FONTS * ROWS_PER_FONT rows of cells.
+
+                /// Text that AddText queued, with its position in window coordinates.
+                struct QueuedString
+                {
+                    Vec3            mWindowPosition ;   ///< Window x and y, in pixels, from lower left, and depth, of pen position for first glyph.
+                    Vec4            mColor          ;   ///< Color of text.
+                    void *          mFont           ;   ///< GLUT bitmap font to draw text with.
+                    size_t          mFirstChar      ;   ///< Offset into mCharacters of first character of text.
+                    size_t          mNumChars       ;   ///< Number of characters of text.
+                    bool            mUseScreenSpace ;   ///< Whether text lies in screen space, i.e. appears in front of everything.
+                } ;
+
+                OpenGL_TextBatch( const OpenGL_TextBatch & ) ;              // Disallow copy
+                OpenGL_TextBatch & operator=( const OpenGL_TextBatch & ) ;  // Disallow assignment
+
+                bool    BuildAtlas() ;
+                int     GetFontIndex( void * font ) const ;
+                size_t  FillQuads( Vertex * vertices , bool useScreenSpace ) const ;
+                void    DrawQuads( size_t firstVertex , size_t numVertices , bool useScreenSpace ) ;
+                void    DrawBitmaps( bool onlyUnsupportedFonts ) const ;
+
+                OpenGL_VertexBuffer     mVertexBuffer       ;   ///< Streaming vertex buffer that holds quadrilaterals of glyphs from the most recent Flush.
+                VECTOR< QueuedString >  mStrings            ;   ///< Text queued since the most recent Flush.
+                VECTOR< char >          mCharacters         ;   ///< Characters of every queued string, consecutively.
+                GLuint                  mAtlasTextureName   ;   ///< Identifier of texture holding glyphs of every supported font, white with coverage in alpha.
+                unsigned char           mAdvances[ MAX_FONTS ][ NUM_CHARACTERS ] ; ///< Distance, in pixels, the pen moves after each glyph of each font.
+                int                     mIsSupported        ;   ///< Whether driver supports everything the atlas needs: 1 for yes, 0 for no, -1 for not yet queried.
+        } ;
+
+        // Public variables ------------------------------------------------------------
+        // Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
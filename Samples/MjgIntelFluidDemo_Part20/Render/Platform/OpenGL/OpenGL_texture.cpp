@@ -10,8 +10,10 @@
 #include "Render/Resource/textureSampler.h"
 
 #include "Render/Platform/OpenGL/OpenGL_api.h" // For GL_CHECK_ERROR
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
 
 #include <Image/image.h>
+#include <Image/compressedImage.h>
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -92,29 +94,29 @@ namespace PeGaSys {
 
 
 
-        static void SamplerState_Apply( const SamplerStateS & samplerState )
+        static void SamplerState_Apply( GLenum target , const SamplerStateS & samplerState )
         {   // TODO: FIXME: This belongs in TextureSampler.
             PERF_BLOCK( Render__SamplerState_Apply ) ;
 
             RENDER_CHECK_ERROR( SamplerState_Apply_before ) ;
             {
                 GLenum minFilter = SamplerState_FilterEnum( samplerState.mMinFilter , samplerState.mMipFilter ) ;
-                glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , minFilter ) ;
+                glTexParameteri( target , GL_TEXTURE_MIN_FILTER , minFilter ) ;
             }
             RENDER_CHECK_ERROR( SamplerState_Apply_min ) ;
             {
                 GLenum magFilter = SamplerState_FilterEnum( samplerState.mMagFilter , SamplerState::FILTER_NO_MIPMAP ) ;
-                glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , magFilter ) ;
+                glTexParameteri( target , GL_TEXTURE_MAG_FILTER , magFilter ) ;
             }
             RENDER_CHECK_ERROR( SamplerState_Apply_mag ) ;
             {
                 GLenum addressU = SamplerState_AddressEnum( samplerState.mAddressU ) ;
-                glTexParameteri( GL_TEXTURE_2D  , GL_TEXTURE_WRAP_S , addressU ) ;
+                glTexParameteri( target , GL_TEXTURE_WRAP_S , addressU ) ;
             }
             RENDER_CHECK_ERROR( SamplerState_Apply_addrU ) ;
             {
                 GLenum addressV = SamplerState_AddressEnum( samplerState.mAddressV ) ;
-                glTexParameteri( GL_TEXTURE_2D  , GL_TEXTURE_WRAP_T , addressV ) ;
+                glTexParameteri( target , GL_TEXTURE_WRAP_T , addressV ) ;
             }
             RENDER_CHECK_ERROR( SamplerState_Apply_addrV ) ;
             {
@@ -133,6 +135,104 @@ namespace PeGaSys {
 
 
 
+        /** Return whether the OpenGL driver can upload textures from pixel buffer objects and generate their MIP maps.
+
+            The first call queries extensions, so call this only while an OpenGL context is current.
+        */
+        static bool IsPixelBufferUploadSupported()
+        {
+            static int sIsSupported = -1 ; // Unknown.
+            if( sIsSupported < 0 )
+            {   // First call.  Query driver.
+                sIsSupported =      glGenBuffers && glBindBuffer && glBufferData && glDeleteBuffers && glGenerateMipmapEXT
+                                &&  OpenGL_Extensions::IsExtensionSupported( "GL_ARB_pixel_buffer_object" ) ;
+            }
+            return sIsSupported != 0 ;
+        }
+
+
+
+
+        /** Return whether the OpenGL driver supports the given extension, querying it only on the first call.
+
+            \param isSupported  Per-extension memo of the answer: 1 for yes, 0 for no, -1 for not yet queried.
+        */
+        static bool IsExtensionSupportedOnce( int & isSupported , char * extension )
+        {
+            if( isSupported < 0 )
+            {   // First call.  Query driver.
+                isSupported = OpenGL_Extensions::IsExtensionSupported( extension ) ? 1 : 0 ;
+            }
+            return isSupported != 0 ;
+        }
+
+
+
+
+        /** Return whether the OpenGL driver supports texture arrays, and generating their MIP maps.
+
+            The first call queries extensions, so call this only while an OpenGL context is current.
+        */
+        static bool IsTextureArraySupported()
+        {
+            static int sIsSupported = -1 ; // Unknown.
+            return glTexImage3D && glGenerateMipmapEXT && IsExtensionSupportedOnce( sIsSupported , "GL_EXT_texture_array" ) ;
+        }
+
+
+
+
+        /** Return whether the OpenGL driver can sample textures of the given compressed format, expanded with the given swizzle.
+
+            The first call queries extensions, so call this only while an OpenGL context is current.
+        */
+        static bool IsCompressedFormatSupported( CompressedImage::FormatE format , CompressedImage::SwizzleE swizzle )
+        {
+            static int sIsRgtcSupported     = -1 ; // Unknown.
+            static int sIsBptcSupported     = -1 ; // Unknown.
+            static int sIsSwizzleSupported  = -1 ; // Unknown.
+
+            if( ! glCompressedTexImage2D || ! glCompressedTexImage3D )
+            {
+                return false ;
+            }
+            if(     ( CompressedImage::SWIZZLE_RGBA != swizzle )
+                &&  ! IsExtensionSupportedOnce( sIsSwizzleSupported , "GL_ARB_texture_swizzle" ) )
+            {   // Without swizzle, single-channel textures would sample as red only.
+                return false ;
+            }
+            switch( format )
+            {
+            case CompressedImage::FORMAT_BC4: return IsExtensionSupportedOnce( sIsRgtcSupported , "GL_ARB_texture_compression_rgtc" ) ;
+            case CompressedImage::FORMAT_BC7: return IsExtensionSupportedOnce( sIsBptcSupported , "GL_ARB_texture_compression_bptc" ) ;
+            default: FAIL() ; break ;
+            }
+            return false ;
+        }
+
+
+
+
+        /** Return which OpenGL texture target textures of the given shape bind to.
+        */
+        static GLenum TextureTarget( TextureBase::ShapeE shape )
+        {
+            return ( TextureBase::TEX_SHAPE_ARRAY == shape ) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D ;
+        }
+
+
+
+
+        /** Return whether the given number is a positive power of two.
+        */
+        static bool IsPowerOfTwo( unsigned n )
+        {
+            return ( n > 0 ) && ( 0 == ( n & ( n - 1 ) ) ) ;
+        }
+
+
+
+
         /** Construct texture for OpenGL.
         */
         OpenGL_Texture::OpenGL_Texture()
@@ -159,12 +259,16 @@ namespace PeGaSys {
         {
             PERF_BLOCK( OpenGL_Texture__Bind ) ;
 
-            // Enable texturing.
-            glEnable( GL_TEXTURE_2D ) ;
-            //glDisable( GL_TEXTURE_2D ) ; // When rendering points, disable textures
-            glBindTexture( GL_TEXTURE_2D , mTextureName ) ;
+            const GLenum target = TextureTarget( GetShape() ) ;
 
-            SamplerState_Apply( samplerState ) ;
+            if( GL_TEXTURE_2D == target )
+            {   // Enable texturing.  Fixed-function texturing cannot sample texture arrays, so only shaders sample those, and need no enable.
+                glEnable( GL_TEXTURE_2D ) ;
+                //glDisable( GL_TEXTURE_2D ) ; // When rendering points, disable textures
+            }
+            glBindTexture( target , mTextureName ) ;
+
+            SamplerState_Apply( target , samplerState ) ;
 
             RENDER_CHECK_ERROR( OpenGL_Texture__Bind ) ;
         }
@@ -210,30 +314,50 @@ namespace PeGaSys {
             glBindTexture( GL_TEXTURE_2D , mTextureName ) ;
             glPixelStorei( GL_UNPACK_ALIGNMENT , 1 ) ;  // texel data rows not padded
 
-            // Generate MIP maps for all texture pages.
-#if 0
-            glGenerateMipmapEXT( GL_TEXTURE_2D ) ;
-#elif 1
-            const int gluError = gluBuild2DMipmaps( GL_TEXTURE_2D
-                , /* internal format */ GL_RGBA
-                , image->GetWidth()
-                , image->GetHeight() * image->GetNumPages() // In lieu of actual texture arrays, assume pages are layed out vertically.
-                , GL_RGBA
-                , GL_UNSIGNED_BYTE
-                , & (*image)[ 0 ] ) ;
-            ASSERT( 0 == gluError ) ; NON_DEBUG_ONLY( UNUSED_PARAM( gluError ) ) ;
-#endif
+            const unsigned width    = image->GetWidth() ;
+            const unsigned height   = image->GetHeight() * image->GetNumPages() ; // In lieu of actual texture arrays, assume pages are layed out vertically.
+
+            if( IsPixelBufferUploadSupported() && IsPowerOfTwo( width ) && IsPowerOfTwo( height ) )
+            {   // Upload through a pixel buffer object.
+                // glBufferData copies texels into driver memory, then glTexImage2D sources them from there,
+                // so the transfer into the texture proceeds asynchronously instead of stalling this thread,
+                // and the GPU, not GLU on the CPU, generates MIP maps.
+                // gluBuild2DMipmaps would also rescale other sizes to powers of two; this path does not, so it only takes those.
+                const size_t sizeInBytes = static_cast< size_t >( width ) * height * image->GetNumChannels() ;
+                GLuint pixelBufferName = 0 ;
+                glGenBuffers( 1 , & pixelBufferName ) ;
+                glBindBuffer( GL_PIXEL_UNPACK_BUFFER , pixelBufferName ) ;
+                glBufferData( GL_PIXEL_UNPACK_BUFFER , sizeInBytes , image->GetImageData() , GL_STREAM_DRAW ) ;
+                glTexImage2D( GL_TEXTURE_2D , 0 , /* internal format */ GL_RGBA , width , height , 0 , GL_RGBA , GL_UNSIGNED_BYTE , /* offset into pixel buffer */ NULLPTR ) ;
+                glBindBuffer( GL_PIXEL_UNPACK_BUFFER , 0 ) ;
+                glDeleteBuffers( 1 , & pixelBufferName ) ; // Driver keeps buffer contents until the transfer finishes.
+
+                // Generate MIP maps for all texture pages.
+                glGenerateMipmapEXT( GL_TEXTURE_2D ) ;
+            }
+            else
+            {   // Upload from client memory.
+                // Generate MIP maps for all texture pages.
+                const int gluError = gluBuild2DMipmaps( GL_TEXTURE_2D
+                    , /* internal format */ GL_RGBA
+                    , width
+                    , height
+                    , GL_RGBA
+                    , GL_UNSIGNED_BYTE
+                    , & (*image)[ 0 ] ) ;
+                ASSERT( 0 == gluError ) ; NON_DEBUG_ONLY( UNUSED_PARAM( gluError ) ) ;
+            }
 
             {
-                int width    = image->GetWidth() ;
-                int height   = image->GetHeight() ;
-                int mipLevel = 0 ;
+                int levelWidth  = image->GetWidth() ;
+                int levelHeight = image->GetHeight() ;
+                int mipLevel    = 0 ;
                 do
                 {
-                    glGetTexLevelParameteriv( GL_TEXTURE_2D , mipLevel , GL_TEXTURE_WIDTH  , & width ) ;
-                    glGetTexLevelParameteriv( GL_TEXTURE_2D , mipLevel , GL_TEXTURE_HEIGHT , & height ) ;
+                    glGetTexLevelParameteriv( GL_TEXTURE_2D , mipLevel , GL_TEXTURE_WIDTH  , & levelWidth ) ;
+                    glGetTexLevelParameteriv( GL_TEXTURE_2D , mipLevel , GL_TEXTURE_HEIGHT , & levelHeight ) ;
                     ++ mipLevel ;
-                } while( width * height > 1 ) ;
+                } while( levelWidth * levelHeight > 1 ) ;
                 const int numMipLevels = mipLevel ;
                 SetNumMipLevels( numMipLevels ) ;
             }
@@ -245,6 +369,71 @@ namespace PeGaSys {
 
 
 
+        /** Create a texture array with one layer per page of the given image.
+
+            Unlike the vertically stacked pages Create2DTextureFromImage makes,
+            layers do not bleed into each other when filtering, and each
+            layer has a complete MIP chain regardless of page count.
+        */
+        void OpenGL_Texture::Create2DArrayTextureFromImage( const Image * image )
+        {
+            PERF_BLOCK( OpenGL_Texture__Create2DArrayTextureFromImage ) ;
+
+            ASSERT( image != NULL ) ;
+
+            // Make sure image is sane.
+            ASSERT( image->GetWidth() > 0 ) ;
+            ASSERT( image->GetHeight() > 0 ) ;
+            ASSERT( image->GetNumPages() > 0 ) ;
+            ASSERT( image->GetImageData() != 0 ) ;
+
+            ASSERT( image->GetNumChannels() == 4 ) ; // For now, only support RGBA images
+            ASSERT( image->GetPageStride() == image->GetYStride() * image->GetHeight() ) ; // Pages must be contiguous, to upload as layers.
+
+            ASSERT( GetShape() == TEX_SHAPE_ARRAY ) ;
+            ASSERT( ( GetNumPlanes() == static_cast< int >( image->GetNumPages() ) ) || ( GetNumPlanes() == 0 ) ) ;
+            ASSERT( ( GetFormat() == TEX_FORMAT_A8R8G8B8 ) || ( GetFormat() == TEX_FORMAT_UNDEFINED ) ) ; // For now, only support RGBA textures
+            ASSERT( GetUsageFlags() == TEX_USAGE_DEFAULT ) ; // For now, only support default usage.
+
+            // Make sure this material does not already have a texture,
+            // otherwise the existing texture will "leak" video memory.
+            ASSERT( INVALID_TEXTURE_NAME == mTextureName ) ;
+
+            if( ! IsTextureArraySupported() )
+            {   // Driver cannot make texture arrays.
+                DebugPrintf( "OpenGL_Texture::Create2DArrayTextureFromImage: driver does not support texture arrays\n" ) ;
+                FAIL() ;
+                return ;
+            }
+
+            glGenTextures( 1 , & mTextureName ) ;   // Generate a unique "name" for this texture.
+            ASSERT( mTextureName != INVALID_TEXTURE_NAME ) ;
+
+            glBindTexture( GL_TEXTURE_2D_ARRAY , mTextureName ) ;
+            glPixelStorei( GL_UNPACK_ALIGNMENT , 1 ) ;  // texel data rows not padded
+
+            glTexImage3D( GL_TEXTURE_2D_ARRAY , 0 , /* internal format */ GL_RGBA , image->GetWidth() , image->GetHeight() , image->GetNumPages() , 0 , GL_RGBA , GL_UNSIGNED_BYTE , image->GetImageData() ) ;
+            glGenerateMipmapEXT( GL_TEXTURE_2D_ARRAY ) ;
+
+            {
+                unsigned levelWidth     = image->GetWidth() ;
+                unsigned levelHeight    = image->GetHeight() ;
+                int      numMipLevels   = 1 ;
+                while( levelWidth * levelHeight > 1 )
+                {
+                    levelWidth  = Max2( levelWidth  / 2 , 1u ) ;
+                    levelHeight = Max2( levelHeight / 2 , 1u ) ;
+                    ++ numMipLevels ;
+                }
+                SetNumMipLevels( numMipLevels ) ;
+            }
+
+            RENDER_CHECK_ERROR( OpenGL_Texture__Create2DArrayTextureFromImage ) ;
+        }
+
+
+
+
 
         /* virtual */ void OpenGL_Texture::CreateFromImages( const Image * images , size_t numImages )
         {
@@ -257,6 +446,10 @@ namespace PeGaSys {
                 {   // Texture shape is either explicitly 2D or not yet defined.
                     Create2DTextureFromImage( images ) ;
                 }
+                else if( GetShape() == TEX_SHAPE_ARRAY )
+                {   // Texture is an array, with one layer per image page.
+                    Create2DArrayTextureFromImage( images ) ;
+                }
                 else
                 {   // Texture shape is explicitly defined as something either incompatable or not yet implemented.
                     FAIL() ;
@@ -274,10 +467,132 @@ namespace PeGaSys {
 
 
 
-        /* virtual */ void OpenGL_Texture::CopyToImage( Image & /*image*/ )
+        /** Create texture from the given block-compressed image, including all its MIP levels.
+
+            \return Whether this created the texture, which requires that the driver
+                    support the compressed format, and that the image layout
+                    (stacked or layered) match the texture shape (2D or array).
+
+            The driver copies compressed blocks into the texture as is, so this
+            spends no CPU time decoding, transfers a quarter to an eighth as
+            many bytes as uploading RGBA, and needs no MIP generation.
+        */
+        /* virtual */ bool OpenGL_Texture::CreateFromCompressedImage( const CompressedImage & compressedImage )
+        {
+            PERF_BLOCK( OpenGL_Texture__CreateFromCompressedImage ) ;
+
+            ASSERT( ! compressedImage.IsEmpty() ) ;
+            ASSERT( GetUsageFlags() == TEX_USAGE_DEFAULT ) ; // For now, only support default usage.
+            ASSERT( INVALID_TEXTURE_NAME == mTextureName ) ;
+
+            const bool layered = compressedImage.IsLayered() ;
+            if( layered != ( GetShape() == TEX_SHAPE_ARRAY ) )
+            {   // Image layout does not match texture shape.
+                FAIL() ;
+                return false ;
+            }
+            if(     ! IsCompressedFormatSupported( compressedImage.GetFormat() , compressedImage.GetSwizzle() )
+                ||  ( layered && ! IsTextureArraySupported() ) )
+            {   // Driver cannot sample this image as is.
+                return false ;
+            }
+
+            const GLenum target         = TextureTarget( GetShape() ) ;
+            const GLenum internalFormat = ( CompressedImage::FORMAT_BC4 == compressedImage.GetFormat() ) ? GL_COMPRESSED_RED_RGTC1 : GL_COMPRESSED_RGBA_BPTC_UNORM ;
+            const GLsizei numPages      = compressedImage.GetNumPages() ;
+
+            if( ! layered )
+            {
+                glDisable( GL_TEXTURE_CUBE_MAP ) ;
+                glEnable( GL_TEXTURE_2D ) ;
+            }
+            glGenTextures( 1 , & mTextureName ) ;   // Generate a unique "name" for this texture.
+            ASSERT( mTextureName != INVALID_TEXTURE_NAME ) ;
+            glBindTexture( target , mTextureName ) ;
+
+            for( unsigned mipLevel = 0 ; mipLevel < compressedImage.GetNumMipLevels() ; ++ mipLevel )
+            {   // For each MIP level...
+                const GLsizei levelWidth    = compressedImage.GetLevelWidth( mipLevel ) ;
+                const GLsizei levelHeight   = compressedImage.GetLevelHeight( mipLevel ) ;
+                const GLsizei sizeInBytes   = static_cast< GLsizei >( compressedImage.GetLevelSizeInBytes( mipLevel ) ) ;
+                if( layered )
+                {
+                    glCompressedTexImage3D( target , mipLevel , internalFormat , levelWidth , levelHeight , numPages , 0 , sizeInBytes , compressedImage.GetLevelData( mipLevel ) ) ;
+                }
+                else
+                {   // Pages are stacked vertically, as Create2DTextureFromImage lays them out.
+                    glCompressedTexImage2D( target , mipLevel , internalFormat , levelWidth , levelHeight * numPages , 0 , sizeInBytes , compressedImage.GetLevelData( mipLevel ) ) ;
+                }
+            }
+
+            // Stacked pages can have fewer MIP levels than a full chain, so tell OpenGL which levels exist, lest it deem the texture incomplete.
+            glTexParameteri( target , GL_TEXTURE_BASE_LEVEL , 0 ) ;
+            glTexParameteri( target , GL_TEXTURE_MAX_LEVEL  , compressedImage.GetNumMipLevels() - 1 ) ;
+
+            if( compressedImage.GetSwizzle() != CompressedImage::SWIZZLE_RGBA )
+            {   // Expand single stored channel into RGBA.
+                static const GLint sSwizzles[][ 4 ] =
+                {
+                    { GL_RED , GL_GREEN , GL_BLUE   , GL_ALPHA  } , // SWIZZLE_RGBA
+                    { GL_RED , GL_RED   , GL_RED    , GL_RED    } , // SWIZZLE_RRRR
+                    { GL_RED , GL_RED   , GL_RED    , GL_ONE    } , // SWIZZLE_RRR1
+                    { GL_ONE , GL_ONE   , GL_ONE    , GL_RED    } , // SWIZZLE_111R
+                } ;
+                glTexParameteriv( target , GL_TEXTURE_SWIZZLE_RGBA , sSwizzles[ compressedImage.GetSwizzle() ] ) ;
+            }
+
+            SetFormat( ( CompressedImage::FORMAT_BC4 == compressedImage.GetFormat() ) ? TEX_FORMAT_BC4 : TEX_FORMAT_BC7 ) ;
+            SetNumMipLevels( compressedImage.GetNumMipLevels() ) ;
+
+            RENDER_CHECK_ERROR( OpenGL_Texture__CreateFromCompressedImage ) ;
+
+            return true ;
+        }
+
+
+
+
+
+        /** Copy the top MIP level of this texture into the given image.
+
+            \param image    (out) Image to populate.  If it has no data, this sizes it to
+                            match this texture; otherwise its shape must already match.
+
+            This waits for the GPU to finish writing the texture, so avoid it
+            where frame rate matters.  To read back rendered frames without
+            stalling, use OpenGL_FrameReadback.
+        */
+        /* virtual */ void OpenGL_Texture::CopyToImage( Image & image )
         {
             PERF_BLOCK( OpenGL_Texture__CopyToImage ) ;
 
+            ASSERT( mTextureName != INVALID_TEXTURE_NAME ) ;
+
+            const GLenum target = TextureTarget( GetShape() ) ;
+
+            glBindTexture( target , mTextureName ) ;
+
+            GLint width     = 0 ;
+            GLint height    = 0 ;
+            GLint numLayers = 1 ;
+            glGetTexLevelParameteriv( target , 0 , GL_TEXTURE_WIDTH  , & width  ) ;
+            glGetTexLevelParameteriv( target , 0 , GL_TEXTURE_HEIGHT , & height ) ;
+            if( GL_TEXTURE_2D_ARRAY == target )
+            {
+                glGetTexLevelParameteriv( target , 0 , GL_TEXTURE_DEPTH , & numLayers ) ;
+            }
+
+            if( NULLPTR == image.GetImageData() )
+            {   // Image has no data yet, so give it the shape of this texture.
+                image.SetSize( width , height , 4 , numLayers ) ;
+            }
+            ASSERT( static_cast< GLint >( image.GetWidth() ) == width ) ;
+            ASSERT( static_cast< GLint >( image.GetHeight() * image.GetNumPages() ) == height * numLayers ) ; // See Create2DTextureFromImage regarding pages.
+            ASSERT( 4 == image.GetNumChannels() ) ; // For now, only support RGBA images
+
+            glPixelStorei( GL_PACK_ALIGNMENT , 1 ) ;  // texel data rows not padded
+            glGetTexImage( target , 0 , GL_RGBA , GL_UNSIGNED_BYTE , image.GetImageData() ) ; // Decompresses compressed textures.
+
             RENDER_CHECK_ERROR( OpenGL_Texture__CopyToImage ) ;
         }
 
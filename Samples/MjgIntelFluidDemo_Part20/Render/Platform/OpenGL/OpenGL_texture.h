@@ -33,9 +33,11 @@ namespace PeGaSys
                 virtual void Bind( ApiBase * renderApi , const SamplerStateS & samplerState ) ;
                 virtual void CreateFromImages( const Image * images , size_t numImages ) ;
                 virtual void CopyToImage( Image & image ) ;
+                virtual bool CreateFromCompressedImage( const CompressedImage & compressedImage ) ;
 
             private:
                 void Create2DTextureFromImage( const Image * image ) ;
+                void Create2DArrayTextureFromImage( const Image * image ) ;
 
                 GLuint mTextureName    ;   ///< OpenGL texture identifier
         } ;
@@ -9,6 +9,7 @@
 
 #include "Render/Platform/OpenGL/OpenGL_Api.h"
 #include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+#include "Render/Platform/OpenGL/OpenGL_computeShader.h"
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -36,9 +37,156 @@ typedef unsigned char * VERTEX_BUFFER_POINTER_TYPE  ;
 #   define CHECK_BINDING()
 #endif
 
+#ifndef GL_INT_2_10_10_10_REV
+#   define GL_INT_2_10_10_10_REV 0x8D9F    // From GL_ARB_vertex_type_2_10_10_10_rev, which glext.h predates.
+#endif
+
+/// Generic vertex attribute indices for BILLBOARD_INSTANCE, matching layout qualifiers in sBillboardInstanceVertexShaderSource.
+enum BillboardInstanceAttributeE
+{
+    BILLBOARD_ATTRIB_CENTER                 ,
+    BILLBOARD_ATTRIB_HALF_SIZE_AND_ANGLE    ,
+    BILLBOARD_ATTRIB_COLOR                  ,
+    BILLBOARD_ATTRIB_TEXCOORD_V             ,
+    NUM_BILLBOARD_ATTRIBS
+} ;
+
 // Private variables -----------------------------------------------------------
+
+typedef PeGaSys::Render::VertexDeclaration::VertexElement   VertexElement ;
+typedef PeGaSys::Render::OpenGL_VertexBuffer                OpenGL_VertexBuffer ;
+
+/// Layout of POSITION_NORMAL_PACKED vertices.
+static const VertexElement sPositionNormalPackedElements[] =
+{
+    { VertexElement::POSITION   , VertexElement::SHORT3         , offsetof( OpenGL_VertexBuffer::VertexFormatPositionNormalPacked , px     ) , sizeof( OpenGL_VertexBuffer::VertexFormatPositionNormalPacked ) } ,
+    { VertexElement::NORMAL     , VertexElement::INT_2_10_10_10 , offsetof( OpenGL_VertexBuffer::VertexFormatPositionNormalPacked , normal ) , sizeof( OpenGL_VertexBuffer::VertexFormatPositionNormalPacked ) } ,
+} ;
+
+/** Vertex shader that expands one BILLBOARD_INSTANCE element into a camera-facing quadrilateral.
+
+    Draw 4 vertices per instance, as a triangle fan.  Each vertex picks its
+    corner from gl_VertexID, in the same order VertexBufferFillerGeneric
+    writes quadrilateral vertices, and offsets it from the center along the
+    rotated view right and up directions, which are rows of the modelview
+    matrix.  Fragment processing remains fixed-function, so existing
+    materials, textures and blending apply unchanged.
+*/
+static const char sBillboardInstanceVertexShaderSource[] =
+    "#version 330 compatibility\n"
+    "layout( location = 0 ) in vec3  aCenter ;\n"
+    "layout( location = 1 ) in vec2  aHalfSizeAndAngle ;\n"
+    "layout( location = 2 ) in vec4  aColor ;\n"
+    "layout( location = 3 ) in vec2  aTexCoordV ;\n"
+    "void main()\n"
+    "{\n"
+    "    const vec2 corners[ 4 ] = vec2[ 4 ]( vec2( 1.0 , 1.0 ) , vec2( -1.0 , 1.0 ) , vec2( -1.0 , -1.0 ) , vec2( 1.0 , -1.0 ) ) ;\n"
+    "    vec2  corner    = corners[ gl_VertexID ] ;\n"
+    "    vec3  viewRight = vec3( gl_ModelViewMatrix[0][0] , gl_ModelViewMatrix[1][0] , gl_ModelViewMatrix[2][0] ) ;\n"
+    "    vec3  viewUp    = vec3( gl_ModelViewMatrix[0][1] , gl_ModelViewMatrix[1][1] , gl_ModelViewMatrix[2][1] ) ;\n"
+    "    float sinAngle  = sin( aHalfSizeAndAngle.y ) ;\n"
+    "    float cosAngle  = cos( aHalfSizeAndAngle.y ) ;\n"
+    "    vec3  pclRight  = (   viewRight * cosAngle + viewUp * sinAngle ) * aHalfSizeAndAngle.x ;\n"
+    "    vec3  pclUp     = ( - viewRight * sinAngle + viewUp * cosAngle ) * aHalfSizeAndAngle.x ;\n"
+    "    vec3  position  = aCenter + pclRight * corner.x + pclUp * corner.y ;\n"
+    "    gl_Position     = gl_ModelViewProjectionMatrix * vec4( position , 1.0 ) ;\n"
+    "    gl_FrontColor   = aColor ;\n"
+    "    gl_TexCoord[0]  = vec4( 0.5 + 0.5 * corner.x , ( corner.y > 0.0 ) ? aTexCoordV.x : aTexCoordV.y , 0.0 , 1.0 ) ;\n"
+    "}\n" ;
+
 // Public variables ------------------------------------------------------------
 // Private functions -----------------------------------------------------------
+
+/** Return program that expands billboard instances, compiling it upon first use.
+
+    Returns an invalid program if compiling failed, e.g. if the driver lacks GLSL 3.30.
+*/
+static PeGaSys::Render::OpenGL_ComputeShader & GetBillboardInstanceProgram()
+{
+    static PeGaSys::Render::OpenGL_ComputeShader    sProgram ;
+    static bool                                     sTriedToCompile = false ;
+    if( ! sTriedToCompile )
+    {
+        sTriedToCompile = true ;
+        sProgram.Compile( sBillboardInstanceVertexShaderSource , GL_VERTEX_SHADER ) ;
+    }
+    return sProgram ;
+}
+
+
+
+
+/** Obtain the OpenGL type, number of components and whether to normalize, for the given vertex element data type.
+*/
+static void GetElementDataType( VertexElement::DataTypeE dataType , GLenum & type , GLint & numComponents , GLboolean & normalized )
+{
+    normalized = GL_FALSE ;
+    switch( dataType )
+    {
+    case VertexElement::FLOAT           : type = GL_FLOAT           ; numComponents = 1 ;                       break ;
+    case VertexElement::FLOAT2          : type = GL_FLOAT           ; numComponents = 2 ;                       break ;
+    case VertexElement::FLOAT3          : type = GL_FLOAT           ; numComponents = 3 ;                       break ;
+    case VertexElement::FLOAT4          : type = GL_FLOAT           ; numComponents = 4 ;                       break ;
+    case VertexElement::SHORT3          : type = GL_SHORT           ; numComponents = 3 ;                       break ;
+    case VertexElement::HALF2           : type = GL_HALF_FLOAT      ; numComponents = 2 ;                       break ;
+    case VertexElement::UBYTE4_NORM     : type = GL_UNSIGNED_BYTE   ; numComponents = 4 ; normalized = GL_TRUE ; break ;
+    case VertexElement::USHORT2_NORM    : type = GL_UNSIGNED_SHORT  ; numComponents = 2 ; normalized = GL_TRUE ; break ;
+    case VertexElement::INT_2_10_10_10  : type = GL_INT_2_10_10_10_REV ; numComponents = 4 ; normalized = GL_TRUE ; break ;
+    default:
+        FAIL() ;
+        type          = GL_FLOAT ;
+        numComponents = 0 ;
+        break ;
+    }
+}
+
+
+
+
+/** Set fixed-function array pointers and enables for the given vertex elements.
+
+    \param elements     Table describing layout of each vertex.
+
+    \param numElements  Number of elements in table.
+
+    \param vertices     Address of first vertex: offset into bound buffer object, or client memory.
+
+    Fixed-function arrays always normalize normals and colors of integer
+    type, and never normalize positions or texture coordinates, so
+    normalized in GetElementDataType only informs generic attributes.
+*/
+static void BindVertexElements( const VertexElement * elements , size_t numElements , const GLubyte * vertices )
+{
+    bool hasPosition    = false ;
+    bool hasNormal      = false ;
+    bool hasColor       = false ;
+    bool hasTexCoord    = false ;
+
+    for( size_t iElement = 0 ; iElement < numElements ; ++ iElement )
+    {   // For each element in vertex layout...
+        const VertexElement &   element         = elements[ iElement ] ;
+        const GLsizei           stride          = static_cast< GLsizei >( element.mStride ) ;
+        const GLubyte *         elementStart    = vertices + element.mOffset ;
+        GLenum                  type ;
+        GLint                   numComponents ;
+        GLboolean               normalized ;
+        GetElementDataType( element.mDataType , type , numComponents , normalized ) ;
+        switch( element.mSemantic )
+        {
+        case VertexElement::POSITION        : glVertexPointer  ( numComponents , type , stride , elementStart ) ; hasPosition = true ; break ;
+        case VertexElement::NORMAL          : glNormalPointer  (                 type , stride , elementStart ) ; hasNormal   = true ; break ;
+        case VertexElement::COLOR_AMBIENT   : glColorPointer   ( numComponents , type , stride , elementStart ) ; hasColor    = true ; break ;
+        case VertexElement::TEXTURE_0       : glTexCoordPointer( numComponents , type , stride , elementStart ) ; hasTexCoord = true ; break ;
+        default: FAIL() ; break ;
+        }
+    }
+
+    if( hasPosition ) glEnableClientState( GL_VERTEX_ARRAY )        ; else glDisableClientState( GL_VERTEX_ARRAY ) ;
+    if( hasNormal   ) glEnableClientState( GL_NORMAL_ARRAY )        ; else glDisableClientState( GL_NORMAL_ARRAY ) ;
+    if( hasColor    ) glEnableClientState( GL_COLOR_ARRAY )         ; else glDisableClientState( GL_COLOR_ARRAY ) ;
+    if( hasTexCoord ) glEnableClientState( GL_TEXTURE_COORD_ARRAY ) ; else glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
+}
+
 // Public functions ------------------------------------------------------------
 
 namespace PeGaSys {
@@ -52,6 +200,10 @@ namespace PeGaSys {
             , mVboName( 0 )
             , mOglVertexArrayData( NULLPTR )
 
+            , mPersistentData( NULLPTR )
+            , mStreamingRegionSize( 0 )
+            , mStreamingRegionIndex( 0 )
+
             , mOffsetPx( 0 )
             , mOffsetTu( 0 )
             , mOffsetCr( 0 )
@@ -70,6 +222,12 @@ namespace PeGaSys {
             PERF_BLOCK( OpenGL_VertexBuffer__OpenGL_VertexBuffer ) ;
 
             mTypeId = sTypeId ;
+
+            for( size_t regionIndex = 0 ; regionIndex < sNumStreamingRegions ; ++ regionIndex )
+            {
+                mStreamingFences[ regionIndex ] = 0 ;
+                mVaoNames[ regionIndex ]        = 0 ;
+            }
         }
 
 
@@ -125,7 +283,18 @@ namespace PeGaSys {
         {
             PERF_BLOCK( OpenGL_VertexBuffer__LockVertexData ) ;
 
-            if( mVboName != 0 )
+            if( mPersistentData != NULLPTR )
+            {   // Using persistently mapped streaming regions.  Advance to the next region, which the GPU read sNumStreamingRegions-1 locks ago.
+                // Fence commands issued so far, which include every draw that read the region filled most recently.
+                ASSERT( 0 == mStreamingFences[ mStreamingRegionIndex ] ) ;
+                mStreamingFences[ mStreamingRegionIndex ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE , 0 ) ;
+                mStreamingRegionIndex = ( mStreamingRegionIndex + 1 ) % sNumStreamingRegions ;
+                WaitForStreamingRegion( mStreamingRegionIndex ) ;
+                VERTEX_BUFFER_POINTER_TYPE pVertexData = mPersistentData + mStreamingRegionIndex * mStreamingRegionSize ;
+                ASSERT( IsAligned( pVertexData , 64 ) ) ; // Check whether region is cache-aligned.  Allocate rounds region size up so that it should be, if the mapping is.
+                return pVertexData ;
+            }
+            else if( mVboName != 0 )
             {   // Using Vertex Buffer Objects.  Give CPU access to GPU data (and deny GPU access).
                 // Inform renderer of the vertex format and location of vertex data.
                 BindVertexData() ;
@@ -156,7 +325,10 @@ namespace PeGaSys {
 
             ASSERT( NULLPTR == GetGenericVertexData() ) ; // Mutually exclusive with generic VB.
 
-            if( mVboName != 0 )
+            if( mPersistentData != NULLPTR )
+            {   // Using persistently mapped streaming regions.  Coherent mapping makes CPU writes visible to the GPU without unmapping, so do nothing.
+            }
+            else if( mVboName != 0 )
             {   // Using Vertex Buffer Objects.  Presumably, CPU holds a lock on the vertex data.
                 ASSERT( NULLPTR == mOglVertexArrayData ) ; // Mutually exclusive with VBO.
                 // Release lock held by CPU (if it indeed held it, e.g. from when it was filling the vertex buffer).
@@ -174,6 +346,34 @@ namespace PeGaSys {
 
 
 
+        /** Wait until the GPU finishes reading the given streaming region, so the CPU can overwrite it.
+        */
+        void OpenGL_VertexBuffer::WaitForStreamingRegion( size_t regionIndex )
+        {
+            PERF_BLOCK( OpenGL_VertexBuffer__WaitForStreamingRegion ) ;
+
+            GLsync & fence = mStreamingFences[ regionIndex ] ;
+            if( fence != 0 )
+            {   // GPU might still read this region.
+                static const GLuint64 timeoutNanoseconds = 1000000 ; // 1 millisecond
+                GLenum waitResult = glClientWaitSync( fence , GL_SYNC_FLUSH_COMMANDS_BIT , 0 ) ;
+                while( ( GL_ALREADY_SIGNALED != waitResult ) && ( GL_CONDITION_SATISFIED != waitResult ) )
+                {   // GPU has not yet finished commands that read this region.
+                    if( GL_WAIT_FAILED == waitResult )
+                    {
+                        FAIL() ;
+                        break ;
+                    }
+                    waitResult = glClientWaitSync( fence , GL_SYNC_FLUSH_COMMANDS_BIT , timeoutNanoseconds ) ;
+                }
+                glDeleteSync( fence ) ;
+                fence = 0 ;
+            }
+        }
+
+
+
+
         bool OpenGL_VertexBuffer::HasElementWithSemantic( PeGaSys::Render::VertexDeclaration::VertexElement::SemanticE semantic )
         {
             PERF_BLOCK( OpenGL_VertexBuffer__HasElementWithSemantic ) ;
@@ -255,8 +455,25 @@ namespace PeGaSys {
                 CHECK_BINDING() ;
 
                 const size_t uVboSize = GetVertexSizeInBytes() * numVertices ;
-                glBufferData( GL_ARRAY_BUFFER , uVboSize , NULL , GL_STREAM_DRAW ) ;
-                RENDER_CHECK_ERROR( OpenGL_VertexBuffer__Allocate_glBufferData ) ;
+#           if USE_PERSISTENT_MAPPED_VERTEX_BUFFERS
+                if( ( USAGE_STREAM == GetUsage() ) && glBufferStorage && glMapBufferRange && glFenceSync && glClientWaitSync && glDeleteSync )
+                {   // Contents change every frame.  Allocate immutable storage for a ring of regions, and map it for the lifetime of this buffer.
+                    static const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT ;
+                    mStreamingRegionSize    = ( uVboSize + 63 ) & ~ size_t( 63 ) ; // Round up to keep each region cache-aligned.
+                    mStreamingRegionIndex   = 0 ;
+                    const size_t totalSize  = mStreamingRegionSize * sNumStreamingRegions ;
+                    glBufferStorage( GL_ARRAY_BUFFER , totalSize , NULL , flags ) ;
+                    RENDER_CHECK_ERROR( OpenGL_VertexBuffer__Allocate_glBufferStorage ) ;
+                    mPersistentData = (VERTEX_BUFFER_POINTER_TYPE) glMapBufferRange( GL_ARRAY_BUFFER , 0 , totalSize , flags ) ;
+                    RENDER_CHECK_ERROR( OpenGL_VertexBuffer__Allocate_glMapBufferRange ) ;
+                    ASSERT( mPersistentData != NULLPTR ) ;
+                }
+                else
+#           endif
+                {
+                    glBufferData( GL_ARRAY_BUFFER , uVboSize , NULL , GL_STREAM_DRAW ) ;
+                    RENDER_CHECK_ERROR( OpenGL_VertexBuffer__Allocate_glBufferData ) ;
+                }
 
                 glBindBuffer( GL_ARRAY_BUFFER , mVboName ) ;
                 RENDER_CHECK_ERROR( OpenGL_VertexBuffer_Allocate_glBindBuffer_2 ) ;
@@ -298,6 +515,32 @@ namespace PeGaSys {
             if( glDeleteBuffers && ( mVboName != 0 ) )
             {   // Used new-style vertex buffer objects.
                 ASSERT( NULLPTR == mOglVertexArrayData ) ;
+#           if USE_VERTEX_ARRAY_OBJECTS
+                for( size_t regionIndex = 0 ; regionIndex < sNumStreamingRegions ; ++ regionIndex )
+                {   // Delete vertex array objects that recorded layouts referring to this buffer object.
+                    if( mVaoNames[ regionIndex ] != 0 )
+                    {
+                        glDeleteVertexArrays( 1 , & mVaoNames[ regionIndex ] ) ;
+                        mVaoNames[ regionIndex ] = 0 ;
+                    }
+                }
+#           endif
+                if( mPersistentData != NULLPTR )
+                {   // Used persistently mapped streaming regions.  Release fences and mapping.
+                    for( size_t regionIndex = 0 ; regionIndex < sNumStreamingRegions ; ++ regionIndex )
+                    {
+                        if( mStreamingFences[ regionIndex ] != 0 )
+                        {
+                            glDeleteSync( mStreamingFences[ regionIndex ] ) ;
+                            mStreamingFences[ regionIndex ] = 0 ;
+                        }
+                    }
+                    glBindBuffer( GL_ARRAY_BUFFER , mVboName ) ;
+                    glUnmapBuffer( GL_ARRAY_BUFFER ) ;
+                    mPersistentData         = NULLPTR ;
+                    mStreamingRegionSize    = 0 ;
+                    mStreamingRegionIndex   = 0 ;
+                }
                 // Tell OpenGL to delete vertex buffer object allocated in "GPU domain"
                 glDeleteBuffers( 1 , & mVboName ) ;
                 mVboName = 0 ;
@@ -449,6 +692,32 @@ namespace PeGaSys {
                 mTexCoordType           = GL_FLOAT ;
                 break ;
 
+            case VertexDeclaration::BILLBOARD_INSTANCE             : // Unusual: each element is an instance, not a vertex.
+                vertexSize    = sizeof( VertexFormatBillboardInstance ) ;
+                mVertexFormat = sVertexFormatFlags_BillboardInstance ;
+
+                mOffsetPx                   = (GLubyte*) offsetof( VertexFormatBillboardInstance , px    ) ;
+                mOffsetCr                   = (GLubyte*) offsetof( VertexFormatBillboardInstance , crgba ) ;
+                mOffsetTu                   = (GLubyte*) offsetof( VertexFormatBillboardInstance , tv0   ) ;
+
+                mNumColorComponentsPertVert = 4 ;
+                mNumTexCoordsPerVert        = 2 ;
+
+                mColorType                  = GL_UNSIGNED_BYTE ;
+                mTexCoordType               = GL_UNSIGNED_SHORT ;   // Only vertex format with integer texture coordinates.
+                break ;
+
+            case VertexDeclaration::POSITION_NORMAL_PACKED         : // Unusual: layout comes from a table of vertex elements.
+                vertexSize    = sizeof( VertexFormatPositionNormalPacked ) ;
+                mVertexFormat = sVertexFormatFlags_PositionNormalPacked ;
+
+                mOffsetPx                   = (GLubyte*) offsetof( VertexFormatPositionNormalPacked , px     ) ;
+                mOffsetNx                   = (GLubyte*) offsetof( VertexFormatPositionNormalPacked , normal ) ;
+
+                mPosType                    = GL_SHORT ;
+                mNormalType                 = GL_INT_2_10_10_10_REV ;
+                break ;
+
             case VertexDeclaration::GENERIC  :
                 vertexSize    = sizeof( GenericVertex ) ;
                 mVertexFormat = 0 ;
@@ -683,6 +952,35 @@ namespace PeGaSys {
                 }
                 break ;
 
+            case VertexDeclaration::BILLBOARD_INSTANCE             :
+                FAIL() ; // Generic vertices do not describe instances.
+                break ;
+
+            case VertexDeclaration::POSITION_NORMAL_PACKED         :
+                {   // Quantize against the box that bounds generic positions.
+                    float minCorner[ 3 ] = {   FLT_MAX ,   FLT_MAX ,   FLT_MAX } ;
+                    float maxCorner[ 3 ] = { - FLT_MAX , - FLT_MAX , - FLT_MAX } ;
+                    for( size_t idx = 0 ; idx < numVerts ; ++ idx )
+                    {
+                        const float * position = & src[ idx ].px ;
+                        for( int axis = 0 ; axis < 3 ; ++ axis )
+                        {
+                            minCorner[ axis ] = Min2( minCorner[ axis ] , position[ axis ] ) ;
+                            maxCorner[ axis ] = Max2( maxCorner[ axis ] , position[ axis ] ) ;
+                        }
+                    }
+                    SetPositionBounds( minCorner , maxCorner ) ;
+
+                    VertexFormatPositionNormalPacked * dst = static_cast< VertexFormatPositionNormalPacked * >( dstVertexData ) ;
+                    for( size_t idx = 0 ; idx < numVerts ; ++ idx )
+                    {
+                        QuantizePosition( & dst[ idx ].px , & src[ idx ].px ) ;
+                        dst[ idx ].pad    = 0 ;
+                        dst[ idx ].normal = PackNormal( & src[ idx ].nx ) ;
+                    }
+                }
+                break ;
+
             case VertexDeclaration::NUM_FORMATS:
                 FAIL() ;
                 break ;
@@ -743,14 +1041,45 @@ namespace PeGaSys {
             if( GetVboName() != 0 )
             {   // Mesh uses Vertex Buffer Objects
 
+                // Streaming buffers draw from the region most recently filled.
+                const size_t    regionIndex     = ( mPersistentData != NULLPTR ) ? mStreamingRegionIndex : 0 ;
+
+#           if USE_VERTEX_ARRAY_OBJECTS
+                if( IsVertexArrayObjectSupported() )
+                {   // Vertex array object records the pointers and enables below.
+                    GLuint & vaoName = mVaoNames[ regionIndex ] ;
+                    if( vaoName != 0 )
+                    {   // Already recorded the layout of this region, so only bind it.
+                        glBindVertexArray( vaoName ) ;
+                        if( sVertexFormatFlags_BillboardInstance == mVertexFormat )
+                        {   // Current program is not part of vertex array state.
+                            GetBillboardInstanceProgram().Use() ;
+                        }
+                        RENDER_CHECK_ERROR( OpenGL_VertexBuffer__BindVertexData_VAO ) ;
+                        return ;
+                    }
+                    // First time binding this region.  Record its layout into a new vertex array object.
+                    glGenVertexArrays( 1 , & vaoName ) ;
+                    glBindVertexArray( vaoName ) ;
+                    RENDER_CHECK_ERROR( OpenGL_VertexBuffer__BindVertexData_glGenVertexArrays ) ;
+                }
+#           endif
+
                 // Tell OpenGL which buffer is bound, i.e. to which buffer the following operations pertain to.
                 glBindBuffer( GL_ARRAY_BUFFER , mVboName ) ;
                 CHECK_BINDING() ;
 
+                // Offsets of vertex elements, relative to start of buffer object.
+                const size_t    regionOffset    = regionIndex * mStreamingRegionSize ;
+                const GLubyte * offsetPx        = mOffsetPx + regionOffset ;
+                const GLubyte * offsetTu        = mOffsetTu + regionOffset ;
+                const GLubyte * offsetCr        = mOffsetCr + regionOffset ;
+                const GLubyte * offsetNx        = mOffsetNx + regionOffset ;
+
                 switch( GetVertexFormat() )
                 {
                 case sVertexFormatFlags_Position:
-                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType , vertexSize , mOffsetPx ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glDisableClientState( GL_NORMAL_ARRAY ) ;
@@ -758,8 +1087,8 @@ namespace PeGaSys {
                     glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
                 case sVertexFormatFlags_PositionNormal:
-                    glNormalPointer  (                        mNormalType , vertexSize , mOffsetNx ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType    , vertexSize , mOffsetPx ) ;
+                    glNormalPointer  (                        mNormalType , vertexSize , offsetNx ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType    , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glEnableClientState( GL_NORMAL_ARRAY ) ;
@@ -767,8 +1096,8 @@ namespace PeGaSys {
                     glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
                 case sVertexFormatFlags_PositionColor:
-                    glColorPointer   ( mNumColorComponentsPertVert , mColorType , vertexSize , mOffsetCr ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType   , vertexSize , mOffsetPx ) ;
+                    glColorPointer   ( mNumColorComponentsPertVert , mColorType , vertexSize , offsetCr ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType   , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glDisableClientState( GL_NORMAL_ARRAY ) ;
@@ -776,8 +1105,8 @@ namespace PeGaSys {
                     glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
                 case sVertexFormatFlags_PositionTexture:
-                    glTexCoordPointer( mNumTexCoordsPerVert , mTexCoordType , vertexSize , mOffsetTu ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType      , vertexSize , mOffsetPx ) ;
+                    glTexCoordPointer( mNumTexCoordsPerVert , mTexCoordType , vertexSize , offsetTu ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType      , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glDisableClientState( GL_NORMAL_ARRAY ) ;
@@ -785,9 +1114,9 @@ namespace PeGaSys {
                     glEnableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
                 case sVertexFormatFlags_PositionNormalColor:
-                    glNormalPointer  (                               mNormalType , vertexSize , mOffsetNx ) ;
-                    glColorPointer   ( mNumColorComponentsPertVert , mColorType  , vertexSize , mOffsetCr ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType    , vertexSize , mOffsetPx ) ;
+                    glNormalPointer  (                               mNormalType , vertexSize , offsetNx ) ;
+                    glColorPointer   ( mNumColorComponentsPertVert , mColorType  , vertexSize , offsetCr ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType    , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glEnableClientState( GL_NORMAL_ARRAY ) ;
@@ -795,9 +1124,9 @@ namespace PeGaSys {
                     glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
                 case sVertexFormatFlags_PositionNormalTexture:
-                    glNormalPointer  (                        mNormalType   , vertexSize , mOffsetNx ) ;
-                    glTexCoordPointer( mNumTexCoordsPerVert , mTexCoordType , vertexSize , mOffsetTu ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType      , vertexSize , mOffsetPx ) ;
+                    glNormalPointer  (                        mNormalType   , vertexSize , offsetNx ) ;
+                    glTexCoordPointer( mNumTexCoordsPerVert , mTexCoordType , vertexSize , offsetTu ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert , mPosType      , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glEnableClientState( GL_NORMAL_ARRAY ) ;
@@ -806,9 +1135,9 @@ namespace PeGaSys {
                     break ;
 #if 0
                 case sVertexFormatFlags_PositionColor3Texture2:
-                    glColorPointer   ( mNumColorComponentsPertVert , mColorType    , vertexSize , mOffsetCr ) ;
-                    glTexCoordPointer( mNumTexCoordsPerVert        , mTexCoordType , vertexSize , mOffsetTu ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType      , vertexSize , mOffsetPx ) ;
+                    glColorPointer   ( mNumColorComponentsPertVert , mColorType    , vertexSize , offsetCr ) ;
+                    glTexCoordPointer( mNumTexCoordsPerVert        , mTexCoordType , vertexSize , offsetTu ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType      , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glDisableClientState( GL_NORMAL_ARRAY ) ;
@@ -817,9 +1146,9 @@ namespace PeGaSys {
                     break ;
 #endif
                 case sVertexFormatFlags_PositionColor4Texture2:
-                    glColorPointer   ( mNumColorComponentsPertVert , mColorType    , vertexSize , mOffsetCr ) ;
-                    glTexCoordPointer( mNumTexCoordsPerVert        , mTexCoordType , vertexSize , mOffsetTu ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType      , vertexSize , mOffsetPx ) ;
+                    glColorPointer   ( mNumColorComponentsPertVert , mColorType    , vertexSize , offsetCr ) ;
+                    glTexCoordPointer( mNumTexCoordsPerVert        , mTexCoordType , vertexSize , offsetTu ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType      , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glDisableClientState( GL_NORMAL_ARRAY ) ;
@@ -827,21 +1156,63 @@ namespace PeGaSys {
                     glEnableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
                 case sVertexFormatFlags_PositionNormalColorTexture:
-                    glNormalPointer  (                               mNormalType   , vertexSize , mOffsetNx ) ;
-                    glColorPointer   ( mNumColorComponentsPertVert , mColorType    , vertexSize , mOffsetCr ) ;
-                    glTexCoordPointer( mNumTexCoordsPerVert        , mTexCoordType , vertexSize , mOffsetTu ) ;
-                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType      , vertexSize , mOffsetPx ) ;
+                    glNormalPointer  (                               mNormalType   , vertexSize , offsetNx ) ;
+                    glColorPointer   ( mNumColorComponentsPertVert , mColorType    , vertexSize , offsetCr ) ;
+                    glTexCoordPointer( mNumTexCoordsPerVert        , mTexCoordType , vertexSize , offsetTu ) ;
+                    glVertexPointer  ( mNumPosCoordsPerVert        , mPosType      , vertexSize , offsetPx ) ;
 
                     glEnableClientState( GL_VERTEX_ARRAY ) ;
                     glEnableClientState( GL_NORMAL_ARRAY ) ;
                     glEnableClientState( GL_COLOR_ARRAY ) ;
                     glEnableClientState( GL_TEXTURE_COORD_ARRAY ) ;
                     break ;
+                case sVertexFormatFlags_BillboardInstance:
+                    {   // Each element feeds all 4 vertices of one instance, which the vertex shader expands.
+                        ASSERT( IsBillboardInstanceSupported() ) ;
+                        GetBillboardInstanceProgram().Use() ;
+
+                        glDisableClientState( GL_VERTEX_ARRAY ) ;
+                        glDisableClientState( GL_NORMAL_ARRAY ) ;
+                        glDisableClientState( GL_COLOR_ARRAY ) ;
+                        glDisableClientState( GL_TEXTURE_COORD_ARRAY ) ;
+
+                        const GLubyte * offsetHalfSize = offsetPx + offsetof( VertexFormatBillboardInstance , halfSize ) - offsetof( VertexFormatBillboardInstance , px ) ;
+                        glVertexAttribPointer( BILLBOARD_ATTRIB_CENTER               , 3                           , GL_FLOAT      , GL_FALSE , vertexSize , offsetPx       ) ;
+                        glVertexAttribPointer( BILLBOARD_ATTRIB_HALF_SIZE_AND_ANGLE  , 2                           , GL_HALF_FLOAT , GL_FALSE , vertexSize , offsetHalfSize ) ;
+                        glVertexAttribPointer( BILLBOARD_ATTRIB_COLOR                , mNumColorComponentsPertVert , mColorType    , GL_TRUE  , vertexSize , offsetCr       ) ;
+                        glVertexAttribPointer( BILLBOARD_ATTRIB_TEXCOORD_V           , mNumTexCoordsPerVert        , mTexCoordType , GL_TRUE  , vertexSize , offsetTu       ) ;
+                        for( GLuint attribIndex = 0 ; attribIndex < NUM_BILLBOARD_ATTRIBS ; ++ attribIndex )
+                        {
+                            glEnableVertexAttribArray( attribIndex ) ;
+                            glVertexAttribDivisor( attribIndex , 1 ) ;
+                        }
+                    }
+                    break ;
+                case sVertexFormatFlags_PositionNormalPacked:
+                    {   // Packed types have no interleaved array format, so a table describes each element.
+                        const VertexElement *   elements ;
+                        size_t                  numElements ;
+                        GetPackedElements( elements , numElements ) ;
+                        BindVertexElements( elements , numElements , reinterpret_cast< const GLubyte * >( regionOffset ) ) ;
+                    }
+                    break ;
                 default:
                     FAIL() ;
                     break ;
                 }
             }
+            else if( sVertexFormatFlags_BillboardInstance == mVertexFormat )
+            {   // Instanced attributes require a vertex buffer object, so this format has no glInterleavedArrays equivalent.
+                FAIL() ;
+            }
+            else if( sVertexFormatFlags_PositionNormalPacked == mVertexFormat )
+            {   // Old-style vertex array with packed types.
+                const VertexElement *   elements ;
+                size_t                  numElements ;
+                GetPackedElements( elements , numElements ) ;
+                BindVertexElements( elements , numElements , static_cast< CONST_VERTEX_BUFFER_POINTER_TYPE >( LockVertexData() ) ) ;
+                RENDER_CHECK_ERROR( OpenGL_VertexBuffer__BindVertexData_packed ) ;
+            }
             else
             {
                 OpenGL_VertexBuffer::CONST_VERTEX_BUFFER_POINTER_TYPE    vertexData      = static_cast< OpenGL_VertexBuffer::CONST_VERTEX_BUFFER_POINTER_TYPE >( LockVertexData() ) ;
@@ -852,6 +1223,115 @@ namespace PeGaSys {
             RENDER_CHECK_ERROR( OpenGL_VertexBuffer__BindVertexData_exit ) ;
         }
 
+
+
+
+        /** Undo OpenGL state that BindVertexData set but other vertex buffers do not reset.
+
+            Only BILLBOARD_INSTANCE uses such state:  A program and instanced
+            generic vertex attributes, which would otherwise override the
+            fixed-function pipeline for subsequent draws.
+
+            If BindVertexData bound a vertex array object, this restores the
+            default one instead, which leaves the recorded layout intact and
+            keeps later pointer calls (e.g. by old-style vertex arrays) from
+            modifying it.
+        */
+        void OpenGL_VertexBuffer::UnbindVertexData()
+        {
+#       if USE_VERTEX_ARRAY_OBJECTS
+            if( ( mVboName != 0 ) && IsVertexArrayObjectSupported() )
+            {   // Instanced attributes belong to the vertex array object, so only the program needs resetting.
+                glBindVertexArray( 0 ) ;
+                if( sVertexFormatFlags_BillboardInstance == mVertexFormat )
+                {
+                    glUseProgram( 0 ) ;
+                }
+                RENDER_CHECK_ERROR( OpenGL_VertexBuffer__UnbindVertexData_VAO ) ;
+                return ;
+            }
+#       endif
+
+            if( sVertexFormatFlags_BillboardInstance == mVertexFormat )
+            {
+                for( GLuint attribIndex = 0 ; attribIndex < NUM_BILLBOARD_ATTRIBS ; ++ attribIndex )
+                {
+                    glVertexAttribDivisor( attribIndex , 0 ) ;
+                    glDisableVertexAttribArray( attribIndex ) ;
+                }
+                glUseProgram( 0 ) ;
+                RENDER_CHECK_ERROR( OpenGL_VertexBuffer__UnbindVertexData ) ;
+            }
+        }
+
+
+
+
+        /** Return whether the OpenGL driver can render BILLBOARD_INSTANCE vertex buffers.
+
+            That requires vertex buffer objects, instanced drawing and GLSL 3.30 (i.e. OpenGL 3.3).
+            The first call compiles the vertex shader, so call this only while an OpenGL context is current.
+        */
+        /* static */ bool OpenGL_VertexBuffer::IsBillboardInstanceSupported()
+        {
+            if(     ! glGenBuffers || ! glVertexAttribPointer || ! glEnableVertexAttribArray || ! glDisableVertexAttribArray
+                ||  ! glVertexAttribDivisor || ! glDrawArraysInstanced || ! glCreateShader || ! glUseProgram )
+            {
+                return false ;
+            }
+            return GetBillboardInstanceProgram().IsValid() ;
+        }
+
+
+
+
+        /** Return whether the OpenGL driver can render POSITION_NORMAL_PACKED vertex buffers.
+
+            That requires normals packed into 10:10:10:2 (GL_ARB_vertex_type_2_10_10_10_rev, part of OpenGL 3.3).
+            Call this only while an OpenGL context is current.
+        */
+        /* static */ bool OpenGL_VertexBuffer::IsPositionNormalPackedSupported()
+        {
+            static int sIsSupported = -1 ;
+            if( sIsSupported < 0 )
+            {   // Query driver once.
+                sIsSupported = OpenGL_Extensions::IsExtensionSupported( "GL_ARB_vertex_type_2_10_10_10_rev" ) ? 1 : 0 ;
+            }
+            return sIsSupported != 0 ;
+        }
+
+
+
+
+        /** Obtain table that describes layout of each vertex, for formats that use packed types.
+        */
+        void OpenGL_VertexBuffer::GetPackedElements( const VertexDeclaration::VertexElement * & elements , size_t & numElements ) const
+        {
+            switch( GetVertexDeclaration().GetVertexFormat() )
+            {
+            case VertexDeclaration::POSITION_NORMAL_PACKED:
+                elements    = sPositionNormalPackedElements ;
+                numElements = sizeof( sPositionNormalPackedElements ) / sizeof( sPositionNormalPackedElements[ 0 ] ) ;
+                break ;
+
+            default:
+                FAIL() ;
+                elements    = NULLPTR ;
+                numElements = 0 ;
+                break ;
+            }
+        }
+
+
+
+
+        /** Return whether the OpenGL driver supports vertex array objects, which BindVertexData uses to record vertex buffer object layouts.
+        */
+        /* static */ bool OpenGL_VertexBuffer::IsVertexArrayObjectSupported()
+        {
+            return glGenVertexArrays && glBindVertexArray && glDeleteVertexArrays ;
+        }
+
     } ;
 } ;
 
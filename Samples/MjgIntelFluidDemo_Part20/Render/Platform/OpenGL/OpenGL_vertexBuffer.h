@@ -15,6 +15,8 @@
 
 #include <GL/gl.h>
 
+#include "Render/Platform/OpenGL/OpenGL_Extensions.h"
+
 // Macros ----------------------------------------------------------------------
 
 /** Enable use of Vertex Buffer Objects, an OpenGL extension.
@@ -26,6 +28,36 @@
 */
 #define USE_VERTEX_BUFFER_OBJECT 1
 
+/** Keep streaming vertex buffers persistently mapped, as a ring of regions guarded by fences.
+
+    Vertex buffers with USAGE_STREAM get refilled every frame.  Mapping and
+    unmapping them each frame makes the driver synchronize with the GPU.
+    Instead, with this enabled, such buffers allocate immutable storage for
+    sNumStreamingRegions copies of their vertices (GL_ARB_buffer_storage),
+    map it once, and fill a different region each frame.  Before filling a
+    region, LockVertexData waits on a fence inserted after the GPU last read
+    that region, which rarely blocks because that happened frames ago.
+    Filling (e.g. PeGaSys::ParticlesRender::ParticlesRenderModel, using
+    multiple threads) then writes directly into GPU-visible memory.
+
+    Support for buffer storage is detected at runtime.  Without it, streaming
+    vertex buffers use the same map/unmap path as other vertex buffers.
+*/
+#define USE_PERSISTENT_MAPPED_VERTEX_BUFFERS 1
+
+/** Record the layout of each vertex buffer object in a vertex array object, the first time BindVertexData runs.
+
+    Without this, every draw issues a pointer call per vertex element and
+    an enable or disable per client array, even though a given vertex
+    buffer always uses the same layout.  With this, BindVertexData records
+    those in a vertex array object (GL_ARB_vertex_array_object) once per
+    buffer (and per streaming region), then later binds only that object.
+
+    Support for vertex array objects is detected at runtime.  Without it,
+    and for old-style vertex arrays, BindVertexData sets pointers every time.
+*/
+#define USE_VERTEX_ARRAY_OBJECTS 1
+
 // Types -----------------------------------------------------------------------
 
 namespace PeGaSys
@@ -125,6 +157,32 @@ static const unsigned sVertexFormatFlags_PositionColor3Texture2 = GL_T2F_C3F_V3F
                 } ;
                 static const unsigned sVertexFormatFlags_PositionNormalColorTexture = GL_T4F_C4F_N3F_V4F ;
 
+                ////////////////////////////////////////////////////////
+                // Per-instance formats, expanded into vertices by a vertex shader
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatBillboardInstance
+                {   // Custom instance format for a camera-facing quadrilateral.  24 bytes, versus 96 for 4 VertexFormatPositionColor4Texture2 vertices.
+                    float           px, py, pz  ;   // untransformed (world-space) position of center
+                    unsigned short  halfSize    ;   // distance from center to edge, as a half float (see HalfFromFloat)
+                    unsigned short  angle       ;   // rotation, in radians within [0,2pi), about the view axis, as a half float
+                    unsigned char   crgba[4]    ;   // color in RGBA form
+                    unsigned short  tv0, tv1    ;   // texture coordinate (v) of top and bottom edges, normalized to [0,65535]
+                } ;
+                static const unsigned sVertexFormatFlags_BillboardInstance = 'bbin' ; // Not an OpenGL interleaved array format.
+
+                ////////////////////////////////////////////////////////
+                // Packed formats, described by tables of VertexDeclaration::VertexElement
+                ////////////////////////////////////////////////////////
+
+                struct VertexFormatPositionNormalPacked
+                {   // Custom vertex format for position+normal.  12 bytes, versus 24 for VertexFormatPositionNormal.
+                    short           px, py, pz  ;   // position quantized against the box VertexBufferBase::SetPositionBounds sets
+                    short           pad         ;   // unused; keeps normal aligned
+                    unsigned        normal      ;   // surface normal packed into 10:10:10:2 (see PackNormal_10_10_10_2)
+                } ;
+                static const unsigned sVertexFormatFlags_PositionNormalPacked = 'pnpk' ; // Not an OpenGL interleaved array format.
+
             public:
                 static const unsigned sTypeId = 'vbog' ;
 
@@ -136,6 +194,11 @@ static const unsigned sVertexFormatFlags_PositionColor3Texture2 = GL_T2F_C3F_V3F
 
                 /// Tell OpenGL where the vertex data is, that future operations will use.
                 void BindVertexData() ;
+                void UnbindVertexData() ;
+
+                static bool IsBillboardInstanceSupported() ;
+                static bool IsPositionNormalPackedSupported() ;
+                static bool IsVertexArrayObjectSupported() ;
 
             private:
                 virtual bool Allocate( size_t numVertices ) ;
@@ -152,17 +215,28 @@ static const unsigned sVertexFormatFlags_PositionColor3Texture2 = GL_T2F_C3F_V3F
                 /// Get identifier (name) of OpenGL Vertex Buffer Object, or 0 if there is none.
                 const GLuint        GetVboName() const      { return mVboName ; }
 
+                /// Number of regions in a persistently mapped streaming vertex buffer: one for the CPU to fill, others for the GPU to read from previous frames.
+                static const size_t sNumStreamingRegions = 3 ;
+
             private:
                 void    CheckBinding() ;
+                void    WaitForStreamingRegion( size_t regionIndex ) ;
                 void    Swap( OpenGL_VertexBuffer & that ) ;
                 bool    CreateVertexBuffer( const VertexDeclaration & vertexDeclaration , size_t numVertices ) ;
                 void    CopyVerticesFromGenericToPlatformSpecific( const OpenGL_VertexBuffer & genericVertexBuffer ) ;
                 bool    HasElementWithSemantic( PeGaSys::Render::VertexDeclaration::VertexElement::SemanticE semantic ) ;
+                void    GetPackedElements( const VertexDeclaration::VertexElement * & elements , size_t & numElements ) const ;
 
                 unsigned    mVertexFormat               ;   ///< One of the OpenGL intrinsically supported vertex formats
                 GLuint      mVboName                    ;   ///< Identifer for OpenGL vertex buffer object.  Mutually exclusive with mOglVertexArrayData.
                 VERTEX_BUFFER_POINTER_TYPE mOglVertexArrayData  ;   /// Old-style OpenGL vertex array. Mutually exclusive with mVboName.
 
+                VERTEX_BUFFER_POINTER_TYPE mPersistentData      ;   ///< Address of persistently mapped storage for all streaming regions, or NULL if this buffer does not stream.
+                size_t      mStreamingRegionSize        ;   ///< Number of bytes between starts of adjacent streaming regions.
+                size_t      mStreamingRegionIndex       ;   ///< Region that LockVertexData most recently returned, which BindVertexData uses.
+                GLsync      mStreamingFences[ sNumStreamingRegions ] ;  ///< Per streaming region, fence that signals once the GPU finishes reading it, or NULL.
+                GLuint      mVaoNames[ sNumStreamingRegions ] ;         ///< Per streaming region (only the first, if this buffer does not stream), vertex array object recording its layout, or 0 if not yet recorded.
+
                 GLubyte *   mOffsetPx                   ;   ///< Offset, relative to start of vertex, of position
                 GLubyte *   mOffsetTu                   ;   ///< Offset, relative to start of vertex, of texture coordinate
                 GLubyte *   mOffsetCr                   ;   ///< Offset, relative to start of vertex, of color
@@ -0,0 +1,146 @@
+/** \file deferredReleaseQueue.cpp
+
+    \brief Queue that defers deleting render resources until the render thread can.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Resource/deferredReleaseQueue.h"
+
+#include <Core/Containers/slist.h>
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+#include <Core/useTbb.h>
+
+#if defined( WIN32 )
+#   include <windows.h>
+#endif
+
+#if USE_TBB
+#   include "tbb/concurrent_queue.h"
+#endif
+
+// Types -----------------------------------------------------------------------
+
+/** Object awaiting deletion on the render thread.
+*/
+struct ReleasedEntry
+{
+    void *                                                  mObject ;   ///< Address of object to delete.
+    PeGaSys::Render::DeferredReleaseQueue::DeleteFunctionT  mDelete ;   ///< Function that deletes mObject, which knows its type.
+} ;
+
+#if USE_TBB
+    typedef tbb::concurrent_queue< ReleasedEntry >  ReleasedContainer ;
+#else   // Without TBB, only one thread releases resources.
+    typedef SLIST< ReleasedEntry >                  ReleasedContainer ;
+#endif
+
+// Private variables -----------------------------------------------------------
+
+#if defined( WIN32 )
+static DWORD sRenderThreadId = 0 ;  ///< Identifier of render thread, or zero until SetRenderThread.
+#endif
+
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+/** Return objects awaiting deletion on the render thread, oldest first.
+
+    This is a function-local static, so the queue exists before any resource
+    that static initialization creates could release into it.
+*/
+static ReleasedContainer & GetReleased()
+{
+    static ReleasedContainer sReleased ;
+    return sReleased ;
+}
+
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+
+
+
+        /** Record the calling thread as the one that owns the render context.
+        */
+        void DeferredReleaseQueue::SetRenderThread()
+        {
+        #if defined( WIN32 )
+            sRenderThreadId = GetCurrentThreadId() ;
+        #endif
+        }
+
+
+
+
+        /** Return whether the calling thread can delete render resources.
+        */
+        bool DeferredReleaseQueue::IsRenderThread()
+        {
+        #if defined( WIN32 )
+            return ( 0 == sRenderThreadId ) || ( GetCurrentThreadId() == sRenderThreadId ) ;
+        #else   // No way to tell threads apart, so assume only one renders.
+            return true ;
+        #endif
+        }
+
+
+
+
+        /** Delete objects other threads released since the previous call.
+
+            Only the render thread may call this, typically once per frame.
+
+            \return Number of objects this deleted.
+        */
+        size_t DeferredReleaseQueue::DeleteReleased()
+        {
+            PERF_BLOCK( DeferredReleaseQueue__DeleteReleased ) ;
+
+            ASSERT( IsRenderThread() ) ;
+
+            ReleasedContainer & released    = GetReleased() ;
+            size_t              numDeleted  = 0 ;
+        #if USE_TBB
+            ReleasedEntry entry ;
+            while( released.try_pop( entry ) )
+            {   // For each released object...
+                entry.mDelete( entry.mObject ) ;
+                ++ numDeleted ;
+            }
+        #else
+            while( ! released.Empty() )
+            {   // For each released object...
+                const ReleasedEntry entry = released.Front() ;
+                released.PopFront() ;
+                entry.mDelete( entry.mObject ) ;
+                ++ numDeleted ;
+            }
+        #endif
+            return numDeleted ;
+        }
+
+
+
+
+        /** Queue the given object for deletion by the render thread.
+        */
+        void DeferredReleaseQueue::Enqueue( void * object , DeleteFunctionT deleteFunction )
+        {
+            PERF_BLOCK( DeferredReleaseQueue__Enqueue ) ;
+
+            ReleasedEntry entry ;
+            entry.mObject = object ;
+            entry.mDelete = deleteFunction ;
+        #if USE_TBB
+            GetReleased().push( entry ) ;
+        #else
+            GetReleased().PushBack( entry ) ;
+        #endif
+        }
+
+    } ;
+} ;
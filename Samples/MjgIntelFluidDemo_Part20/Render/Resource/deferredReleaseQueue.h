@@ -0,0 +1,72 @@
+/** \file deferredReleaseQueue.h
+
+    \brief Queue that defers deleting render resources until the render thread can.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_DEFERRED_RELEASE_QUEUE_H
+#define PEGASYS_RENDER_DEFERRED_RELEASE_QUEUE_H
+
+#include <stddef.h>
+
+// Macros ----------------------------------------------------------------------
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Queue that defers deleting render resources until the render thread can.
+
+            Render resources such as textures and meshes own objects of the
+            underlying render API, which typically only the thread that owns
+            the render context can free.  Once resources use atomic reference
+            counts, any thread can release the last reference, so instead of
+            deleting the resource directly, the release calls Delete, which
+            deletes it immediately on the render thread, and otherwise queues
+            it until the render thread calls DeleteReleased.
+
+            Until some thread calls SetRenderThread, every thread counts as
+            the render thread, so programs that render on one thread, or not
+            at all, delete immediately, as before.
+        */
+        class DeferredReleaseQueue
+        {
+            public:
+                /// Function that deletes an object of the type it was instantiated for.
+                typedef void ( * DeleteFunctionT )( void * object ) ;
+
+                static void     SetRenderThread() ;
+                static bool     IsRenderThread() ;
+
+                /// Delete the given object now if this is the render thread, otherwise when the render thread next calls DeleteReleased.
+                template< class ObjectT > static void Delete( ObjectT * object )
+                {
+                    if( IsRenderThread() )
+                    {
+                        delete object ;
+                    }
+                    else
+                    {
+                        Enqueue( object , & DeleteObject< ObjectT > ) ;
+                    }
+                }
+
+                static size_t   DeleteReleased() ;
+
+            private:
+                template< class ObjectT > static void DeleteObject( void * object )
+                {
+                    delete static_cast< ObjectT * >( object ) ;
+                }
+
+                static void     Enqueue( void * object , DeleteFunctionT deleteFunction ) ;
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -8,6 +8,7 @@
 #include "Render/Resource/indexBuffer.h"
 
 #include <Core/Performance/perfBlock.h>
+#include <Core/Performance/memoryBudget.h>
 #include <Core/Utility/macros.h>
 #include <Core/Memory/newWrapper.h>
 #include <Core/File/debugPrint.h>
@@ -26,7 +27,9 @@ namespace PeGaSys {
         IndexBufferBase::IndexBufferBase( TypeId typeId )
             : mTypeId( typeId )
             , mNumIndices( 0 )
+            , mCapacity( 0 )
             , mIndexType( INDEX_TYPE_NONE )
+            , mTrackedBytes( 0 )
         {
             PERF_BLOCK( IndexBufferBase__IndexBufferBase ) ;
         }
@@ -39,6 +42,43 @@ namespace PeGaSys {
         IndexBufferBase::~IndexBufferBase()
         {
             PERF_BLOCK( IndexBufferBase__dtor ) ;
+
+            // Derived class should have cleared its buffer, but in case not, stop counting it.
+            MemoryBudget::Track( MemoryBudget::SUBSYSTEM_RENDER_BUFFERS , - ptrdiff_t( mTrackedBytes ) ) ;
+        }
+
+
+
+
+        /** Set number of elements this index buffer represents, which rendering uses.
+
+            This lets a buffer allocated with spare capacity render fewer indices than it holds.
+        */
+        void IndexBufferBase::SetNumIndices( size_t numIndices )
+        {
+            PERF_BLOCK( IndexBufferBase__SetNumIndices ) ;
+
+            ASSERT( numIndices <= GetCapacity() ) ;
+            mNumIndices = numIndices ;
+        }
+
+
+
+
+        /** Set number of indices this buffer can hold, and report its memory to MemoryBudget.
+
+            Platform-specific Allocate must assign mIndexType first, and Clear must set capacity to zero.
+        */
+        void IndexBufferBase::SetCapacity( size_t capacity )
+        {
+            PERF_BLOCK( IndexBufferBase__SetCapacity ) ;
+
+            mCapacity = capacity ;
+
+            const size_t indexSize      = ( INDEX_TYPE_16 == mIndexType ) ? sizeof( WORD ) : sizeof( int ) ;
+            const size_t numBytes       = capacity * indexSize ;
+            MemoryBudget::Track( MemoryBudget::SUBSYSTEM_RENDER_BUFFERS , ptrdiff_t( numBytes ) - ptrdiff_t( mTrackedBytes ) ) ;
+            mTrackedBytes = numBytes ;
         }
 
 
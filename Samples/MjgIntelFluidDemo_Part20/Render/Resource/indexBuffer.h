@@ -53,6 +53,11 @@ namespace PeGaSys
                 /// Return number of elements this index buffer represents.
                 const size_t &  GetNumIndices() const { return mNumIndices ; }
 
+                /// Return number of elements this index buffer can hold.
+                const size_t &  GetCapacity() const { return mCapacity ; }
+
+                void SetNumIndices( size_t numIndices ) ;
+
                 /// Platform-specific routine to allocate index buffer.
                 virtual void Allocate( size_t numIndices , IndexTypeE indexType ) = 0 ;
 
@@ -60,13 +65,17 @@ namespace PeGaSys
                 virtual void Clear() = 0 ;
 
             protected:
+                void SetCapacity( size_t capacity ) ;
+
                 static const unsigned sTypeId = 'IXBF' ;    ///< Type identifier for index buffer
 
                 IndexTypeE  mIndexType      ;   ///< Type of index data
                 size_t      mNumIndices     ;   ///< Number of indices, i.e. number of elements in index buffer.
+                size_t      mCapacity       ;   ///< Number of indices this buffer can hold.
 
             private:
                 TypeId      mTypeId         ;   ///< Type identifier
+                size_t      mTrackedBytes   ;   ///< Number of bytes this buffer reported to MemoryBudget.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -20,10 +20,8 @@
 #include <Core/Memory/newWrapper.h>
 #include <Core/File/debugPrint.h>
 #include <Core/Math/vec3.h>
-
-#if USE_TBB
-static TbbAtomicBool sDebugPrintfLock ;
-#endif
+#include <Core/Containers/vector.h>
+#include <Core/parallelExecution.h>
 
 namespace PeGaSys {
     namespace Render {
@@ -140,10 +138,7 @@ namespace PeGaSys {
                     // NOTE: fetch_and_add returns the *original* value, and increments the variable.
                     mIndexOfCurrentBlock = mVertexCounter->fetch_and_add( NUM_VERTICES_PER_BLOCK ) ;
 #if 0 && defined( _DEBUG )
-{
-TBB_SCOPED_SPIN_LOCK( sDebugPrintfLock ) ;
 DebugPrintf( "%i,%i,0,BLOCK\n" , GetCurrentThreadId() , mIndexOfCurrentBlock ) ;
-}
 #endif
                     mNumVertsAllocedInCurrentBlock = 0 ;
                     if( mIndexOfCurrentBlock + NUM_VERTICES_PER_BLOCK >= mTotalCapacityInVertices )
@@ -159,10 +154,7 @@ DebugPrintf( "%i,%i,0,BLOCK\n" , GetCurrentThreadId() , mIndexOfCurrentBlock ) ;
                 size_t triangleIndex = vertexIndex / NUM_VERTICES_PER_TRIANGLE ;
                 ASSERT( triangleIndex * NUM_VERTICES_PER_TRIANGLE == vertexIndex ) ;
 #if 0 && defined( _DEBUG )
-{
-TBB_SCOPED_SPIN_LOCK( sDebugPrintfLock ) ;
 DebugPrintf( "%i,%i,%i,t\n" , GetCurrentThreadId() , mIndexOfCurrentBlock , vertexIndex ) ;
-}
 #endif
                 return triangleIndex ;
             }
@@ -191,10 +183,7 @@ DebugPrintf( "%i,%i,%i,t\n" , GetCurrentThreadId() , mIndexOfCurrentBlock , vert
             {
 
 #if 0 && defined( _DEBUG )
-{
-TBB_SCOPED_SPIN_LOCK( sDebugPrintfLock ) ;
 DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThreadId() , mIndexOfCurrentBlock ) ;
-}
 #endif
 
                 unsigned char * positionsAsBytes = reinterpret_cast< unsigned char * >( positionsStart ) ;
@@ -899,6 +888,550 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
 
 
 
+#if MARCHING_CUBES_WELD_VERTICES
+        /** Slab of grid cells that one task extracts, and where its vertices and triangles go in the output buffers.
+
+            Each slab owns the vertices on grid edges that start on its layers of
+            grid points, i.e. layers zBegin through zEnd-1.  The last slab also
+            owns the topmost layer.  Cells in the top layer of a slab also use
+            vertices the next slab owns.  Their indices follow from the same
+            deterministic numbering, so no slab waits for another.
+        */
+        struct IsoSurfaceSlab
+        {
+            size_t  zBegin          ;   ///< First layer of cells in this slab.
+            size_t  zEnd            ;   ///< One past last layer of cells in this slab.
+            size_t  numVertices     ;   ///< Number of vertices this slab owns.
+            size_t  numTriangles    ;   ///< Number of triangles cells in this slab generate.
+            size_t  firstVertex     ;   ///< Index of first vertex this slab owns.
+            size_t  firstTriangle   ;   ///< Index of first triangle cells in this slab generate.
+        } ;
+
+
+
+
+        /// Number of cells along each edge of a brick, the unit in which extraction skips empty space.
+        static const size_t sIsoSurfaceBrickSize = 8 ;
+
+
+
+
+        /** Coarse grid over bricks of cells, flagging which bricks the isosurface can cross.
+
+            A cell generates triangles only if some of its corner values lie
+            below the iso level and others do not, so a brick whose minimum
+            value is not below the iso level, or whose maximum is, generates
+            nothing.  Likewise no edge of its cells crosses the isosurface.
+            Extraction consults these flags to skip such bricks whole, so the
+            expensive per-cell work scales with the area of the isosurface
+            rather than the volume of the grid.
+
+            \see MARCHING_CUBES_SKIP_EMPTY_BRICKS.
+        */
+        struct IsoSurfaceBricks
+        {
+            size_t                      number[ 3 ] ;   ///< Number of bricks along each direction.
+            VECTOR< unsigned char >     active      ;   ///< Whether the isosurface can cross each brick, i.e. min < isoLevel <= max over its grid points.
+
+            /// Return flags of the row of bricks containing the given row of cells.
+            const unsigned char * ActiveRow( size_t iyCell , size_t izCell ) const
+            {
+                const size_t by = iyCell / sIsoSurfaceBrickSize ;
+                const size_t bz = izCell / sIsoSurfaceBrickSize ;
+                ASSERT( ( by < number[ 1 ] ) && ( bz < number[ 2 ] ) ) ;
+                return & active[ ( bz * number[ 1 ] + by ) * number[ 0 ] ] ;
+            }
+        } ;
+
+
+
+
+        /** Corner offsets and axis of each cell edge, in the order edgeTable and triTable number them.
+
+            For edge e, the edge starts at cell corner ( sCellEdges[e][0] , sCellEdges[e][1] , sCellEdges[e][2] )
+            relative to cell corner 0, and runs along axis sCellEdges[e][3].
+            \see PolygoniseCellWithNormal for the edge numbering diagram.
+        */
+        static const unsigned char sCellEdges[ 12 ][ 4 ] =
+        {
+            { 0 , 0 , 0 , 0 } , { 1 , 0 , 0 , 1 } , { 0 , 1 , 0 , 0 } , { 0 , 0 , 0 , 1 } ,
+            { 0 , 0 , 1 , 0 } , { 1 , 0 , 1 , 1 } , { 0 , 1 , 1 , 0 } , { 0 , 0 , 1 , 1 } ,
+            { 0 , 0 , 0 , 2 } , { 1 , 0 , 0 , 2 } , { 1 , 1 , 0 , 2 } , { 0 , 1 , 0 , 2 } ,
+        } ;
+
+
+
+
+        /** Return gradient of grid values at the given grid point, in world units.
+
+            This uses central differences inside the grid and one-sided differences on its boundary,
+            and assumes grid directions are mutually orthogonal.
+        */
+        static Vec3 GridGradientAtPoint( const GridWrapper * valGrid , const size_t indices[ 3 ] )
+        {
+            const char *    gridValuesBytes = reinterpret_cast< const char * >( valGrid->values ) ;
+            const size_t    offset          = indices[ 0 ] * valGrid->strides[ 0 ] + indices[ 1 ] * valGrid->strides[ 1 ] + indices[ 2 ] * valGrid->strides[ 2 ] ;
+            const char *    pointBytes      = & gridValuesBytes[ offset ] ;
+            Vec3            gradient( 0.0f , 0.0f , 0.0f ) ;
+
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each grid direction...
+                const bool      hasMinus        = ( indices[ axis ] > 0 ) || valGrid->hasPointBefore[ axis ] ;
+                const bool      hasPlus         = ( indices[ axis ] + 1 < valGrid->number[ axis ] ) || valGrid->hasPointAfter[ axis ] ;
+                const char *    minusBytes      = hasMinus ? pointBytes - valGrid->strides[ axis ] : pointBytes ;
+                const char *    plusBytes       = hasPlus  ? pointBytes + valGrid->strides[ axis ] : pointBytes ;
+                const float     numSpans        = float( int( hasMinus ) + int( hasPlus ) ) ;
+                const float     valueMinus      = * reinterpret_cast< const float * >( minusBytes ) ;
+                const float     valuePlus       = * reinterpret_cast< const float * >( plusBytes  ) ;
+                const float     derivPerIndex   = ( valuePlus - valueMinus ) / numSpans ;
+                const Vec3 &    direction       = valGrid->directions[ axis ] ;
+                gradient += direction * ( derivPerIndex / direction.Mag2() ) ;
+            }
+            return gradient ;
+        }
+
+
+
+
+        /** Return gradient of grid values at the given grid point, pointing outward, from the gradient grid if the value grid has one with a usable value there.
+
+            A gradient grid can hold zero where simulation poisoned it (e.g. near walls),
+            so this falls back to differences of values wherever that grid gives no direction.
+        */
+        static Vec3 OutwardGradientAtPoint( const GridWrapper * valGrid , const size_t indices[ 3 ] )
+        {
+            const GridWrapper * gradGrid = valGrid->gradients ;
+            if( gradGrid )
+            {   // Caller supplied gradients, so use them instead of differencing values.
+                const char *    gradGridValuesBytes = reinterpret_cast< const char * >( gradGrid->values ) ;
+                const size_t    offset              = indices[ 0 ] * gradGrid->strides[ 0 ] + indices[ 1 ] * gradGrid->strides[ 1 ] + indices[ 2 ] * gradGrid->strides[ 2 ] ;
+                const Vec3 &    gradient            = * reinterpret_cast< const Vec3 * >( & gradGridValuesBytes[ offset ] ) ;
+                if( gradient.Mag2() > FLT_MIN )
+                {
+                    return valGrid->gradientsPointInward ? - gradient : gradient ;
+                }
+            }
+            return GridGradientAtPoint( valGrid , indices ) ;
+        }
+
+
+
+
+        /** Number, and optionally emit, vertices where the isosurface crosses edges that start on one layer of grid points.
+
+            \param edgeVertexIndices    Array of 3 indices per grid point in a layer, one per edge along +X, +Y and +Z.
+                                        This assigns entries for crossed edges only.  NULL to only count.
+
+            \param nextVertexIndex      Index to give the first vertex this numbers.  On return, one past the last.
+
+            \param vertexBufferWrapper  Vertex buffer to write positions and normals into, or NULL to only number vertices.
+
+            \param bricks               Flags of bricks the isosurface can cross.  No edge of cells in other bricks crosses it, so this skips them.
+
+            The numbering order depends only on grid values, so two slabs
+            numbering the same layer from the same starting index agree.
+        */
+        static void NumberIsoSurfaceVerticesInLayer( unsigned * edgeVertexIndices , size_t & nextVertexIndex , float isoLevel , const GridWrapper * valGrid , const IsoSurfaceBricks & bricks , size_t iz , VertexBufferWrapper * vertexBufferWrapper )
+        {
+            const char *    gridValuesBytes = reinterpret_cast< const char * >( valGrid->values ) ;
+            char *          positionsBytes  = vertexBufferWrapper ? reinterpret_cast< char * >( vertexBufferWrapper->positions ) : NULLPTR ;
+            char *          normalsBytes    = vertexBufferWrapper ? reinterpret_cast< char * >( vertexBufferWrapper->normals   ) : NULLPTR ;
+            const size_t    offsetZ         = iz * valGrid->strides[ 2 ] ;
+            const float     fz              = float( iz ) ;
+            const size_t    izCell          = Min2( iz , valGrid->number[ 2 ] - 2 ) ;    // Layer of cells that contains every edge starting on this layer of points.
+
+            for( size_t iy = 0 ; iy < valGrid->number[ 1 ] ; ++ iy )
+            {   // For each row of grid points in this layer...
+                const size_t offsetYZ   = iy * valGrid->strides[ 1 ] + offsetZ ;
+                const float  fy         = float( iy ) ;
+                const unsigned char * activeBricks = bricks.ActiveRow( Min2( iy , valGrid->number[ 1 ] - 2 ) , izCell ) ;
+                for( size_t bx = 0 ; bx < bricks.number[ 0 ] ; ++ bx )
+                {   // For each brick along this row...
+                    if( ! activeBricks[ bx ] )
+                    {   // Isosurface crosses no edge of cells in this brick.
+                        continue ;
+                    }
+                    // Points on the far side of the last brick start no edge along X, but can start edges along Y and Z.
+                    const size_t ixBegin    = bx * sIsoSurfaceBrickSize ;
+                    const size_t ixEnd      = ( bx + 1 == bricks.number[ 0 ] ) ? valGrid->number[ 0 ] : ixBegin + sIsoSurfaceBrickSize ;
+                    for( size_t ix = ixBegin ; ix < ixEnd ; ++ ix )
+                    {   // For each grid point in this row...
+                        const size_t    indices[ 3 ]    = { ix , iy , iz } ;
+                        const size_t    offsetXYZ       = ix * valGrid->strides[ 0 ] + offsetYZ ;
+                        const float     value           = * reinterpret_cast< const float * >( & gridValuesBytes[ offsetXYZ ] ) ;
+                        const bool      inside          = value < isoLevel ;
+                        for( int axis = 0 ; axis < 3 ; ++ axis )
+                        {   // For each edge that starts at this grid point...
+                            if( indices[ axis ] + 1 >= valGrid->number[ axis ] )
+                            {   // Edge would leave grid.
+                                continue ;
+                            }
+                            const float valueNext = * reinterpret_cast< const float * >( & gridValuesBytes[ offsetXYZ + valGrid->strides[ axis ] ] ) ;
+                            if( ( valueNext < isoLevel ) == inside )
+                            {   // Isosurface does not cross this edge.
+                                continue ;
+                            }
+
+                            const size_t vertexIndex = nextVertexIndex ++ ;
+
+                            if( edgeVertexIndices )
+                            {
+                                edgeVertexIndices[ ( iy * valGrid->number[ 0 ] + ix ) * 3 + axis ] = static_cast< unsigned >( vertexIndex ) ;
+                            }
+
+                            if( vertexBufferWrapper )
+                            {   // Emit vertex.
+                                ASSERT( vertexIndex < vertexBufferWrapper->capacity ) ;
+                                size_t indicesNext[ 3 ] = { ix , iy , iz } ;
+                                ++ indicesNext[ axis ] ;
+                                const Vec3  gridPtPos       = float( ix ) * valGrid->directions[ 0 ] + fy * valGrid->directions[ 1 ] + fz * valGrid->directions[ 2 ] + valGrid->minPos ;
+                                const Vec3  gradient        = OutwardGradientAtPoint( valGrid , indices ) ;
+                                const Vec3  gradientNext    = OutwardGradientAtPoint( valGrid , indicesNext ) ;
+                                Vec3        normal ;
+                                const Vec3  position        = InterpolateVertexPositionAndNormal( isoLevel , gridPtPos , gridPtPos + valGrid->directions[ axis ] , value , valueNext , normal , gradient , gradientNext ) ;
+                                const size_t offsetInBytes  = vertexIndex * vertexBufferWrapper->stride ;
+                                // Values increase outward (e.g. signed distance) so the gradient points away from the interior.
+                                const Vec3   normalDir      = normal.GetDir() ;
+                                if( vertexBufferWrapper->packer )
+                                {   // Vertex buffer holds quantized positions and packed normals.
+                                    vertexBufferWrapper->packer->QuantizePosition( reinterpret_cast< short * >( & positionsBytes[ offsetInBytes ] ) , & position.x ) ;
+                                    * reinterpret_cast< unsigned * >( & normalsBytes[ offsetInBytes ] ) = vertexBufferWrapper->packer->PackNormal( & normalDir.x ) ;
+                                }
+                                else
+                                {
+                                    * reinterpret_cast< Vec3 * >( & positionsBytes[ offsetInBytes ] ) = position ;
+                                    * reinterpret_cast< Vec3 * >( & normalsBytes  [ offsetInBytes ] ) = normalDir ;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+
+
+
+        /** Return index into triTable, of configuration of grid values at corners of the given cell.
+        */
+        static int CubeIndexOfCell( float isoLevel , const GridWrapper * valGrid , size_t offsetXYZ )
+        {
+            const char *    gridValuesBytes = reinterpret_cast< const char * >( valGrid->values ) ;
+            const size_t &  sx              = valGrid->strides[ 0 ] ;
+            const size_t &  sy              = valGrid->strides[ 1 ] ;
+            const size_t &  sz              = valGrid->strides[ 2 ] ;
+
+#           define GRID_VALUES( offset ) ( * reinterpret_cast< const float * >( & gridValuesBytes[ offset ] ) )
+            int cubeIndex = 0 ;
+            if( GRID_VALUES( offsetXYZ                ) < isoLevel ) cubeIndex |=   1 ;
+            if( GRID_VALUES( offsetXYZ + sx           ) < isoLevel ) cubeIndex |=   2 ;
+            if( GRID_VALUES( offsetXYZ + sx + sy      ) < isoLevel ) cubeIndex |=   4 ;
+            if( GRID_VALUES( offsetXYZ      + sy      ) < isoLevel ) cubeIndex |=   8 ;
+            if( GRID_VALUES( offsetXYZ           + sz ) < isoLevel ) cubeIndex |=  16 ;
+            if( GRID_VALUES( offsetXYZ + sx      + sz ) < isoLevel ) cubeIndex |=  32 ;
+            if( GRID_VALUES( offsetXYZ + sx + sy + sz ) < isoLevel ) cubeIndex |=  64 ;
+            if( GRID_VALUES( offsetXYZ      + sy + sz ) < isoLevel ) cubeIndex |= 128 ;
+#           undef GRID_VALUES
+            return cubeIndex ;
+        }
+
+
+
+
+        /** Return number of triangles a cell with the given configuration generates.
+        */
+        static size_t NumTrianglesOfCubeIndex( int cubeIndex )
+        {
+            size_t numTriangles = 0 ;
+            while( triTable[ cubeIndex ][ numTriangles * 3 ] != -1 )
+            {
+                ++ numTriangles ;
+            }
+            return numTriangles ;
+        }
+
+
+
+
+        /** Flag which bricks the isosurface can cross, for bricks in the given range of brick layers.
+
+            Each brick spans its cells' grid points, so adjacent bricks share a
+            layer of points.  That lets each brick decide alone whether any of
+            its cells or their edges can cross the iso level.
+        */
+        static void FlagIsoSurfaceBricks( IsoSurfaceBricks & bricks , float isoLevel , const GridWrapper * valGrid , size_t bzBegin , size_t bzEnd )
+        {
+            const char *    gridValuesBytes = reinterpret_cast< const char * >( valGrid->values ) ;
+            size_t          pointLast[ 3 ] ;    // Index of last grid point, along each direction.
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {
+                pointLast[ axis ] = valGrid->number[ axis ] - 1 ;
+            }
+
+            for( size_t bz = bzBegin ; bz < bzEnd ; ++ bz )
+            {   // For each layer of bricks in this range...
+                const size_t izBegin    = bz * sIsoSurfaceBrickSize ;
+                const size_t izEnd      = Min2( izBegin + sIsoSurfaceBrickSize , pointLast[ 2 ] ) ;
+                for( size_t by = 0 ; by < bricks.number[ 1 ] ; ++ by )
+                {
+                    const size_t iyBegin    = by * sIsoSurfaceBrickSize ;
+                    const size_t iyEnd      = Min2( iyBegin + sIsoSurfaceBrickSize , pointLast[ 1 ] ) ;
+                    for( size_t bx = 0 ; bx < bricks.number[ 0 ] ; ++ bx )
+                    {   // For each brick in this row...
+                        const size_t ixBegin    = bx * sIsoSurfaceBrickSize ;
+                        const size_t ixEnd      = Min2( ixBegin + sIsoSurfaceBrickSize , pointLast[ 0 ] ) ;
+                        bool anyInside  = false ;
+                        bool anyOutside = false ;
+                        for( size_t iz = izBegin ; ( iz <= izEnd ) && ! ( anyInside && anyOutside ) ; ++ iz )
+                        {   // For each layer of grid points in this brick, until it is known to straddle the iso level...
+                            for( size_t iy = iyBegin ; iy <= iyEnd ; ++ iy )
+                            {
+                                const size_t offsetYZ = iy * valGrid->strides[ 1 ] + iz * valGrid->strides[ 2 ] ;
+                                for( size_t ix = ixBegin ; ix <= ixEnd ; ++ ix )
+                                {   // For each grid point in this row of the brick...
+                                    const float value = * reinterpret_cast< const float * >( & gridValuesBytes[ ix * valGrid->strides[ 0 ] + offsetYZ ] ) ;
+                                    if( value < isoLevel )  anyInside  = true ;
+                                    else                    anyOutside = true ;
+                                }
+                            }
+                        }
+                        bricks.active[ ( bz * bricks.number[ 1 ] + by ) * bricks.number[ 0 ] + bx ] = ( anyInside && anyOutside ) ? 1 : 0 ;
+                    }
+                }
+            }
+        }
+
+
+
+
+        /** Count vertices a slab owns and triangles its cells generate.
+        */
+        static void CountIsoSurfaceSlab( IsoSurfaceSlab & slab , float isoLevel , const GridWrapper * valGrid , const IsoSurfaceBricks & bricks )
+        {
+            PERF_BLOCK( CountIsoSurfaceSlab ) ;
+
+            const size_t numZMinus1 = valGrid->number[ 2 ] - 1 ;
+            const size_t zOwnedEnd  = ( slab.zEnd == numZMinus1 ) ? numZMinus1 + 1 : slab.zEnd ;   // Last slab also owns topmost layer of grid points.
+
+            slab.numVertices = 0 ;
+            for( size_t iz = slab.zBegin ; iz < zOwnedEnd ; ++ iz )
+            {   // For each layer of grid points this slab owns...
+                NumberIsoSurfaceVerticesInLayer( NULLPTR , slab.numVertices , isoLevel , valGrid , bricks , iz , NULLPTR ) ;
+            }
+
+            slab.numTriangles = 0 ;
+            for( size_t iz = slab.zBegin ; iz < slab.zEnd ; ++ iz )
+            {   // For each layer of cells in this slab...
+                const size_t offsetZ = iz * valGrid->strides[ 2 ] ;
+                for( size_t iy = 0 ; iy < valGrid->number[ 1 ] - 1 ; ++ iy )
+                {
+                    const size_t offsetYZ = iy * valGrid->strides[ 1 ] + offsetZ ;
+                    const unsigned char * activeBricks = bricks.ActiveRow( iy , iz ) ;
+                    for( size_t bx = 0 ; bx < bricks.number[ 0 ] ; ++ bx )
+                    {   // For each brick along this row of cells...
+                        if( ! activeBricks[ bx ] )
+                        {   // No cell in this brick generates triangles.
+                            continue ;
+                        }
+                        const size_t ixEnd = Min2( ( bx + 1 ) * sIsoSurfaceBrickSize , valGrid->number[ 0 ] - 1 ) ;
+                        for( size_t ix = bx * sIsoSurfaceBrickSize ; ix < ixEnd ; ++ ix )
+                        {   // For each cell in this brick row...
+                            const int cubeIndex = CubeIndexOfCell( isoLevel , valGrid , ix * valGrid->strides[ 0 ] + offsetYZ ) ;
+                            slab.numTriangles += NumTrianglesOfCubeIndex( cubeIndex ) ;
+                        }
+                    }
+                }
+            }
+        }
+
+
+
+
+        /** Emit vertices a slab owns, and indices of triangles its cells generate.
+
+            \param indices  Index buffer data, 3 per triangle, for all slabs.
+
+            This keeps a cache of edge vertex indices for the 2 layers of grid
+            points that bound the current layer of cells, so each vertex gets
+            computed once, by the slab that owns it, and shared by every
+            triangle that uses it.
+        */
+        static void EmitIsoSurfaceSlab( const IsoSurfaceSlab & slab , VertexBufferWrapper * vertexBufferWrapper , int * indices , float isoLevel , const GridWrapper * valGrid , const IsoSurfaceBricks & bricks )
+        {
+            PERF_BLOCK( EmitIsoSurfaceSlab ) ;
+
+            const size_t        numZMinus1          = valGrid->number[ 2 ] - 1 ;
+            const size_t        numIndicesPerLayer  = 3 * valGrid->number[ 0 ] * valGrid->number[ 1 ] ;
+            VECTOR< unsigned >  edgeVertexIndicesLower( numIndicesPerLayer ) ;
+            VECTOR< unsigned >  edgeVertexIndicesUpper( numIndicesPerLayer ) ;
+            size_t              nextVertexIndex     = slab.firstVertex ;
+            size_t              triangleIndex       = slab.firstTriangle ;
+
+            NumberIsoSurfaceVerticesInLayer( & edgeVertexIndicesLower[ 0 ] , nextVertexIndex , isoLevel , valGrid , bricks , slab.zBegin , vertexBufferWrapper ) ;
+
+            for( size_t iz = slab.zBegin ; iz < slab.zEnd ; ++ iz )
+            {   // For each layer of cells in this slab...
+                // Number vertices on upper layer of grid points.  This slab owns that layer unless it is the first layer of the next slab.
+                const bool ownsUpperLayer = ( iz + 1 < slab.zEnd ) || ( iz + 1 == numZMinus1 ) ;
+                ASSERT( ownsUpperLayer || ( nextVertexIndex == slab.firstVertex + slab.numVertices ) ) ;
+                NumberIsoSurfaceVerticesInLayer( & edgeVertexIndicesUpper[ 0 ] , nextVertexIndex , isoLevel , valGrid , bricks , iz + 1 , ownsUpperLayer ? vertexBufferWrapper : NULLPTR ) ;
+                const unsigned * edgeVertexIndicesOfLayer[ 2 ] = { & edgeVertexIndicesLower[ 0 ] , & edgeVertexIndicesUpper[ 0 ] } ;
+
+                const size_t offsetZ = iz * valGrid->strides[ 2 ] ;
+                for( size_t iy = 0 ; iy < valGrid->number[ 1 ] - 1 ; ++ iy )
+                {
+                    const size_t offsetYZ = iy * valGrid->strides[ 1 ] + offsetZ ;
+                    const unsigned char * activeBricks = bricks.ActiveRow( iy , iz ) ;
+                    for( size_t bx = 0 ; bx < bricks.number[ 0 ] ; ++ bx )
+                    {   // For each brick along this row of cells...
+                        if( ! activeBricks[ bx ] )
+                        {   // No cell in this brick generates triangles.
+                            continue ;
+                        }
+                        const size_t ixEnd = Min2( ( bx + 1 ) * sIsoSurfaceBrickSize , valGrid->number[ 0 ] - 1 ) ;
+                        for( size_t ix = bx * sIsoSurfaceBrickSize ; ix < ixEnd ; ++ ix )
+                        {   // For each cell in this brick row...
+                            const int cubeIndex = CubeIndexOfCell( isoLevel , valGrid , ix * valGrid->strides[ 0 ] + offsetYZ ) ;
+                            for( int i = 0 ; triTable[ cubeIndex ][ i ] != -1 ; i += 3 )
+                            {   // For each triangle in this cell...
+                                // Use same winding as PolygoniseCellWithNormal.
+                                const int triangleEdges[ 3 ] = { triTable[ cubeIndex ][ i + 1 ] , triTable[ cubeIndex ][ i + 0 ] , triTable[ cubeIndex ][ i + 2 ] } ;
+                                for( int iVertex = 0 ; iVertex < 3 ; ++ iVertex )
+                                {   // For each vertex of this triangle...
+                                    const unsigned char * cellEdge = sCellEdges[ triangleEdges[ iVertex ] ] ;
+                                    const size_t idxInLayer = ( ( iy + cellEdge[ 1 ] ) * valGrid->number[ 0 ] + ix + cellEdge[ 0 ] ) * 3 + cellEdge[ 3 ] ;
+                                    indices[ triangleIndex * 3 + iVertex ] = static_cast< int >( edgeVertexIndicesOfLayer[ cellEdge[ 2 ] ][ idxInLayer ] ) ;
+                                }
+                                ++ triangleIndex ;
+                            }
+                        }
+                    }
+                }
+
+                std::swap( edgeVertexIndicesLower , edgeVertexIndicesUpper ) ;
+            }
+
+            ASSERT( triangleIndex == slab.firstTriangle + slab.numTriangles ) ;
+        }
+
+
+
+
+        /** Grid of values, iso level and brick flags that every slab of one extraction shares.
+        */
+        struct IsoSurfaceExtraction
+        {
+            const GridWrapper *         valGrid     ;   ///< Grid of values to extract the isosurface from.
+            float                       isoLevel    ;   ///< Value the isosurface passes through.
+            const IsoSurfaceBricks *    bricks      ;   ///< Flags of bricks of cells the isosurface can cross.
+        } ;
+
+
+
+
+        /** Count vertices and triangles in the given range of slabs.
+        */
+        static void CountIsoSurfaceSlabs( VECTOR< IsoSurfaceSlab > & slabs , const IsoSurfaceExtraction & extraction , size_t iSlabBegin , size_t iSlabEnd )
+        {
+            for( size_t iSlab = iSlabBegin ; iSlab < iSlabEnd ; ++ iSlab )
+            {   // For each slab in this range...
+                CountIsoSurfaceSlab( slabs[ iSlab ] , extraction.isoLevel , extraction.valGrid , * extraction.bricks ) ;
+            }
+        }
+
+
+
+
+        /** Emit vertices and triangle indices for the given range of slabs.
+        */
+        static void EmitIsoSurfaceSlabs( const VECTOR< IsoSurfaceSlab > & slabs , VertexBufferWrapper * vertexBufferWrapper , int * indices , const IsoSurfaceExtraction & extraction , size_t iSlabBegin , size_t iSlabEnd )
+        {
+            for( size_t iSlab = iSlabBegin ; iSlab < iSlabEnd ; ++ iSlab )
+            {   // For each slab in this range...
+                EmitIsoSurfaceSlab( slabs[ iSlab ] , vertexBufferWrapper , indices , extraction.isoLevel , extraction.valGrid , * extraction.bricks ) ;
+            }
+        }
+
+
+
+
+        /** Partition grid cells into slabs along z, count vertices and triangles in each, and assign each slab its place in the output buffers.
+
+            \param slabs    (out) Slabs covering the grid.
+
+            \param numVertices  (out) Total number of vertices.
+
+            \param numTriangles (out) Total number of triangles.
+
+            \param bricks   (out) Flags of bricks of cells the isosurface can cross.
+        */
+        static void CountIsoSurfaceIndexed( VECTOR< IsoSurfaceSlab > & slabs , size_t & numVertices , size_t & numTriangles , IsoSurfaceBricks & bricks , float isoLevel , const GridWrapper * valGrid )
+        {
+            PERF_BLOCK( CountIsoSurfaceIndexed ) ;
+
+            const size_t numZMinus1 = valGrid->number[ 2 ] - 1 ;
+
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each direction...
+                bricks.number[ axis ] = ( valGrid->number[ axis ] - 1 + sIsoSurfaceBrickSize - 1 ) / sIsoSurfaceBrickSize ;
+            }
+#       if MARCHING_CUBES_SKIP_EMPTY_BRICKS
+            bricks.active.Resize( bricks.number[ 0 ] * bricks.number[ 1 ] * bricks.number[ 2 ] ) ;
+            Parallel::For( 0 , bricks.number[ 2 ] , 1 , Parallel::Function( FlagIsoSurfaceBricks , bricks , isoLevel , valGrid ) ) ;
+#       else
+            bricks.active.Resize( bricks.number[ 0 ] * bricks.number[ 1 ] * bricks.number[ 2 ] , 1 ) ;   // Visit every cell.
+#       endif
+
+#       if USE_TBB
+            // Use a few slabs per processor, for load balance.  Each slab costs one extra layer of vertex numbering.
+            const size_t numSlabsMax = 4 * gNumberOfProcessors ;
+#       else
+            const size_t numSlabsMax = 1 ;
+#       endif
+            const size_t numSlabs       = Max2( size_t( 1 ) , Min2( numSlabsMax , numZMinus1 ) ) ;
+            const size_t layersPerSlab  = ( numZMinus1 + numSlabs - 1 ) / numSlabs ;
+
+            slabs.Clear() ;
+            for( size_t zBegin = 0 ; zBegin < numZMinus1 ; zBegin += layersPerSlab )
+            {   // For each slab...
+                IsoSurfaceSlab slab ;
+                slab.zBegin = zBegin ;
+                slab.zEnd   = Min2( zBegin + layersPerSlab , numZMinus1 ) ;
+                slabs.PushBack( slab ) ;
+            }
+
+            const IsoSurfaceExtraction extraction = { valGrid , isoLevel , & bricks } ;
+            Parallel::For( 0 , slabs.Size() , 1 , Parallel::Function( CountIsoSurfaceSlabs , slabs , extraction ) ) ;
+
+            // Prefix-sum counts to find where each slab writes.
+            numVertices  = 0 ;
+            numTriangles = 0 ;
+            for( size_t iSlab = 0 ; iSlab < slabs.Size() ; ++ iSlab )
+            {   // For each slab...
+                slabs[ iSlab ].firstVertex   = numVertices ;
+                slabs[ iSlab ].firstTriangle = numTriangles ;
+                numVertices  += slabs[ iSlab ].numVertices ;
+                numTriangles += slabs[ iSlab ].numTriangles ;
+            }
+        }
+
+
+
+
+        /** Emit vertices and triangle indices for all slabs CountIsoSurfaceIndexed assigned.
+        */
+        static void EmitIsoSurfaceIndexed( const VECTOR< IsoSurfaceSlab > & slabs , const IsoSurfaceBricks & bricks , VertexBufferWrapper * vertexBufferWrapper , int * indices , float isoLevel , const GridWrapper * valGrid )
+        {
+            PERF_BLOCK( EmitIsoSurfaceIndexed ) ;
+
+            const IsoSurfaceExtraction extraction = { valGrid , isoLevel , & bricks } ;
+            Parallel::For( 0 , slabs.Size() , 1 , Parallel::Function( EmitIsoSurfaceSlabs , slabs , vertexBufferWrapper , indices , extraction ) ) ;
+        }
+#endif
+
+
+
+
         /** Initialize a GridWrapper object.
         */
         void GridWrapper_Init( GridWrapper * grid )
@@ -1072,6 +1605,7 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
             vertBufWrapper.capacity = mesh->GetVertexBuffer()->GetCapacity() ;
             vertBufWrapper.count = 0 ;
             vertBufWrapper.stride = mesh->GetVertexBuffer()->GetVertexSizeInBytes() ;
+            vertBufWrapper.packer = NULLPTR ;   // Only welded extraction supports packed formats.
             void * vertexData = meshVertBuf->LockVertexData() ;
             vertBufWrapper.positions = static_cast< float * >( meshVertBuf->GetElementStart( vertexData , PeGaSys::Render::VertexDeclaration::VertexElement::POSITION , 0 ) ) ;
             vertBufWrapper.normals = static_cast< float * >( meshVertBuf->GetElementStart( vertexData , PeGaSys::Render::VertexDeclaration::VertexElement::NORMAL , 0 ) ) ;
@@ -1093,6 +1627,99 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
 
 
 
+#if MARCHING_CUBES_WELD_VERTICES
+        /** Update the mesh of an intrisic isosurface extracted from the given wrapped grid, with welded vertices and an index buffer.
+
+            This counts vertices and triangles first, so it can size both
+            buffers to fit, then emits geometry directly into them.  Buffers
+            grow with some slack, and only when they lack capacity.
+
+            \see Mesh_MakeFromVolume.
+        */
+        static void Mesh_UpdateFromVolumeIndexed( MeshBase * mesh , ApiBase * renderApi , float isoLevel , const GridWrapper * valGrid , VertexDeclaration::VertexFormatE vertFmt )
+        {
+            PERF_BLOCK( Mesh_UpdateFromVolumeIndexed ) ;
+
+            VECTOR< IsoSurfaceSlab >    slabs           ;
+            IsoSurfaceBricks            bricks          ;
+            size_t                      numVertices     = 0 ;
+            size_t                      numTriangles    = 0 ;
+            CountIsoSurfaceIndexed( slabs , numVertices , numTriangles , bricks , isoLevel , valGrid ) ;
+
+            VertexBufferBase *  meshVertBuf     = mesh->GetVertexBuffer() ;
+            const size_t        vertexCapacity  = numVertices + numVertices / 4 + 1 ;
+            if( meshVertBuf->GetCapacity() == 0 )
+            {   // Space in vertex buffer was not allocated; this is probably a new VB.
+                VertexDeclaration  vertexDeclaration( vertFmt ) ;
+                meshVertBuf->DeclareVertexFormat( vertexDeclaration ) ;
+                meshVertBuf->Allocate( vertexCapacity ) ;
+            }
+            else if( meshVertBuf->GetCapacity() < numVertices )
+            {   // Space in vertex buffer was previously allocated but has insufficient capacity.
+                ASSERT( meshVertBuf->GetVertexDeclaration().GetVertexFormat() == vertFmt ) ;
+                meshVertBuf->ChangeCapacityAndReallocate( vertexCapacity ) ;
+            }
+
+            const size_t        numIndices  = 3 * numTriangles ;
+            IndexBufferBase *   indexBuffer = mesh->GetIndexBuffer() ;
+            if( ( 0 == numIndices ) || ( indexBuffer && ( indexBuffer->GetCapacity() < numIndices ) ) )
+            {   // Isosurface is empty, so render nothing through the vertex buffer, or index buffer is too small.
+                mesh->DeleteIndexBuffer( renderApi ) ;
+                indexBuffer = NULLPTR ;
+            }
+            if( ( numIndices > 0 ) && ( NULLPTR == indexBuffer ) )
+            {   // Mesh needs a new index buffer.
+                indexBuffer = mesh->NewIndexBuffer( renderApi ) ;
+                indexBuffer->Allocate( numIndices + numIndices / 4 , IndexBufferBase::INDEX_TYPE_32 ) ;
+            }
+
+            const bool isPacked = ( VertexDeclaration::POSITION_NORMAL_PACKED == vertFmt ) ;
+            if( isPacked )
+            {   // Quantize positions against the box the grid spans, which contains the isosurface.
+                float minCorner[ 3 ] = { valGrid->minPos.x , valGrid->minPos.y , valGrid->minPos.z } ;
+                float maxCorner[ 3 ] = { valGrid->minPos.x , valGrid->minPos.y , valGrid->minPos.z } ;
+                for( int axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each grid direction...
+                    const Vec3 span = valGrid->directions[ axis ] * float( valGrid->number[ axis ] - 1 ) ;
+                    for( int component = 0 ; component < 3 ; ++ component )
+                    {   // Directions could point either way along any axis, so extend whichever side each component reaches.
+                        const float delta = ( & span.x )[ component ] ;
+                        if( delta < 0.0f ) minCorner[ component ] += delta ;
+                        else               maxCorner[ component ] += delta ;
+                    }
+                }
+                meshVertBuf->SetPositionBounds( minCorner , maxCorner ) ;
+            }
+
+            VertexBufferWrapper vertBufWrapper ;
+            vertBufWrapper.capacity = meshVertBuf->GetCapacity() ;
+            vertBufWrapper.count    = numVertices ;
+            vertBufWrapper.stride   = meshVertBuf->GetVertexSizeInBytes() ;
+            vertBufWrapper.packer   = isPacked ? meshVertBuf : NULLPTR ;
+            void * vertexData = meshVertBuf->LockVertexData() ;
+            vertBufWrapper.positions = static_cast< float * >( meshVertBuf->GetElementStart( vertexData , PeGaSys::Render::VertexDeclaration::VertexElement::POSITION , 0 ) ) ;
+            vertBufWrapper.normals   = static_cast< float * >( meshVertBuf->GetElementStart( vertexData , PeGaSys::Render::VertexDeclaration::VertexElement::NORMAL , 0 ) ) ;
+            ASSERT( vertBufWrapper.positions != vertBufWrapper.normals ) ; // Positions should not be at same address as normals.
+
+            int * indices = indexBuffer ? indexBuffer->GetIndicesInt() : NULLPTR ;
+
+            EmitIsoSurfaceIndexed( slabs , bricks , & vertBufWrapper , indices , isoLevel , valGrid ) ;
+
+            if( indexBuffer )
+            {
+                indexBuffer->SetNumIndices( numIndices ) ;
+                indexBuffer->Unlock() ;
+            }
+
+            meshVertBuf->SetPopulation( numVertices ) ;
+
+            meshVertBuf->UnlockVertexData() ;
+        }
+#endif
+
+
+
+
         /** Make a mesh of an intrisic isosurface extracted from the given wrapped grid.
 
             This mesh should be from a Model.
@@ -1112,8 +1739,14 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
             PERF_BLOCK( Mesh_MakeFromVolume ) ;
 
             ASSERT( renderApi ) ;
+#if ! MARCHING_CUBES_WELD_VERTICES
             ASSERT( NULLPTR == mesh->GetIndexBuffer() ) ;
+#endif
+#if MARCHING_CUBES_WELD_VERTICES
+            ASSERT( ( VertexDeclaration::POSITION_NORMAL == vertFmt ) || ( VertexDeclaration::POSITION_NORMAL_PACKED == vertFmt ) ); // Other formats not yet supported.  If they were, it would likely be up to the caller to populate them.
+#else
             ASSERT( /*( VertexDeclaration::POSITION == vertFmt ) ||*/ ( VertexDeclaration::POSITION_NORMAL == vertFmt ) ); // Other formats not yet supported.  If they were, it would likely be up to the caller to populate them.
+#endif
 
             ASSERT( valGrid->number[ 0 ] > 1 ) ;    // Grid must have at least 2 points (i.e. 1 cell) in each direction.
             ASSERT( valGrid->number[ 1 ] > 1 ) ;
@@ -1125,6 +1758,10 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
 
             VertexBufferBase * meshVertBuf = ( NULLPTR == mesh->GetVertexBuffer() ) ? mesh->NewVertexBuffer( renderApi ) : mesh->GetVertexBuffer() ;
 
+#if MARCHING_CUBES_WELD_VERTICES
+            (void) numGridCells ;
+            Mesh_UpdateFromVolumeIndexed( mesh , renderApi , isoLevel , valGrid , vertFmt ) ;
+#else
             if( meshVertBuf->GetCapacity() == 0 )
             {   // Space in vertex buffer was not allocated; this is probably a new VB.
                 VertexDeclaration  vertexDeclaration( vertFmt ) ;
@@ -1138,6 +1775,7 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
             }
 
             /* DEBUG_ONLY( ResultCodeE resultCode = ) */ Mesh_UpdateFromVolume( mesh , isoLevel , valGrid ) ;
+#endif
 
             //if( RESULT_OKAY != resultCode ) DEBUG_BREAK() ; // Should resize vertex buffer.
         }
@@ -1162,6 +1800,7 @@ DebugPrintf( "%i,%i,FillBlockRemainderWithDegenerateTriangles\n" , GetCurrentThr
             GridWrapper gradGrid ;
             GridWrapper_Init( & gradGrid ) ;
             GridWrapper_MakeSphere( & sdfGrid , & gradGrid , gridDim , radius ) ;
+            sdfGrid.gradients = & gradGrid ;
             Mesh_MakeFromVolume( mesh , renderApi , /* isoLevel */ radius , & sdfGrid , vertFmt ) ;
             GridWrapper_Free( & gradGrid ) ;
             GridWrapper_Free( & sdfGrid ) ;
@@ -14,6 +14,27 @@
 #include <Core/Math/vec3.h>
 
 // Macros ----------------------------------------------------------------------
+
+/** Whether Mesh_MakeFromVolume welds vertices that adjacent cells share, and renders triangles through an index buffer.
+
+    Welding emits each edge vertex once instead of once per triangle that uses
+    it, which cuts vertex count to roughly a third, and needs no degenerate
+    triangles to pad per-thread blocks.  That costs a counting pass over the
+    grid before the pass that emits geometry.  Welded vertices get normals from
+    the grid gradient, so the surface shades smoothly instead of per facet.
+*/
+#define MARCHING_CUBES_WELD_VERTICES 1
+
+/** Whether Mesh_MakeFromVolume skips bricks of cells that the isosurface cannot cross.
+
+    Before extracting, one pass over grid points flags each brick of 8^3
+    cells whose values straddle the iso level.  Counting and emitting then
+    visit only cells in flagged bricks, so their cost scales with the area
+    of the isosurface instead of the volume of the grid.  Output is
+    identical either way.  Applies only when MARCHING_CUBES_WELD_VERTICES.
+*/
+#define MARCHING_CUBES_SKIP_EMPTY_BRICKS 1
+
 // Types -----------------------------------------------------------------------
 
 namespace PeGaSys
@@ -58,6 +79,7 @@ namespace PeGaSys
             TbbAtomicSizeT  count       ;   /// Number of vertices written into vertices array.
             size_t          capacity    ;   /// Maximum number of vertices that can fit into vertices array.
             size_t          stride      ;   /// Number of bytes between adjacent vertices.
+            const VertexBufferBase * packer ;   /// If not NULL, vertex buffer (with POSITION_NORMAL_PACKED) that quantizes positions and packs normals.  Otherwise positions and normals are float triples.
         } ;
 
 
@@ -70,6 +92,10 @@ namespace PeGaSys
             size_t  strides[3]      ;   /// Delta, in bytes, per index, between adjacent points in the grid. offset = ix * strides[0] + iy * strides[1] + iz * strides[2]
             Vec3    minPos          ;   /// Location of first grid point, i.e. values[0]
             Vec3    directions[ 3 ] ;   /// Direction vectors corresponding to each index: position = ix * directions[0] + iy * directions[1] + iz * directions[2] + minPos
+            bool    hasPointBefore[ 3 ] ;   /// Whether a readable grid point precedes the first point along each direction, e.g. when this wraps part of a larger grid.  Gradients use it, so adjacent parts shade seamlessly.
+            bool    hasPointAfter[ 3 ]  ;   /// Whether a readable grid point follows the last point along each direction.
+            const GridWrapper * gradients   ;   /// If not NULL, grid of Vec3 gradients of values, at the same points, from which vertex normals come instead of from differences of values.  Its strides can differ.
+            bool    gradientsPointInward    ;   /// Whether gradients point toward the interior, i.e. where values fall below the isolevel, e.g. when they are density gradients for a signed distance grid.
         } ;
 
 
@@ -80,11 +106,20 @@ namespace PeGaSys
         } ;
 
         // Public variables ------------------------------------------------------------
+
+        /// Cell edges each triangle crosses, for each configuration of cell corners inside the isosurface, as 3 edges per triangle, terminated by -1.  GPU isosurface extraction uploads this.
+        extern int triTable[ 256 ][ 16 ] ;
+
         // Public functions ------------------------------------------------------------
 
         extern void Mesh_MakeFromVolume( MeshBase * mesh , ApiBase * renderApi , float isoLevel , const GridWrapper * valGrid , VertexDeclaration::VertexFormatE vertFmt ) ;
         extern void Mesh_MakeSphere( MeshBase * mesh , ApiBase * renderApi , size_t gridDim , float radius , VertexDeclaration::VertexFormatE vertFmt ) ;
 
+        extern ResultCodeE ExtractIsoLevel( VertexBufferWrapper * vertexBufferWrapper , float isoLevel , const GridWrapper * valGrid ) ;
+        extern void GridWrapper_Init( GridWrapper * grid ) ;
+        extern void GridWrapper_Free( GridWrapper * grid ) ;
+        extern void GridWrapper_MakeSphere( GridWrapper * sdfGrid , GridWrapper * gradGrid , size_t gridDim , float radius ) ;
+
     } ;
 
 } ;
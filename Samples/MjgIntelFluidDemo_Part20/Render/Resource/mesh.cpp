@@ -10,6 +10,7 @@
 #include "Render/Resource/material.h"
 #include "Render/Resource/vertexBuffer.h"
 #include "Render/Resource/indexBuffer.h"
+#include "Render/Resource/deferredReleaseQueue.h"
 
 #include "Render/Device/api.h"
 
@@ -51,6 +52,9 @@ namespace PeGaSys {
             , mVertexBuffer( NULLPTR )
             , mIndexBuffer( NULLPTR )
             , mPrimitiveType( PRIMITIVE_NONE )
+            , mMinCorner( 0.0f , 0.0f , 0.0f )
+            , mMaxCorner( 0.0f , 0.0f , 0.0f )
+            , mHasBoundingBox( false )
         {
             PERF_BLOCK( MeshBase__MeshBase ) ;
         }
@@ -79,7 +83,8 @@ namespace PeGaSys {
 
             if( _ReleaseReference() )
             {   // That was the last reference to this object.
-                delete this ;
+                // Any thread can release it, but only the render thread can free its render API objects.
+                DeferredReleaseQueue::Delete( this ) ;
             }
         }
 
@@ -104,6 +109,42 @@ namespace PeGaSys {
 
 
 
+        /** Create a new index buffer for this mesh.
+        */
+        IndexBufferBase * MeshBase::NewIndexBuffer( ApiBase * renderApi )
+        {
+            PERF_BLOCK( MeshBase__NewIndexBuffer ) ;
+
+            ASSERT( renderApi ) ;
+            ASSERT( 0 == mIndexBuffer ) ;
+
+            mIndexBuffer = renderApi->NewIndexBuffer() ;
+
+            return mIndexBuffer ;
+        }
+
+
+
+
+        /** Delete index buffer of this mesh, if it has one, so this mesh renders its vertex buffer directly.
+        */
+        void MeshBase::DeleteIndexBuffer( ApiBase * renderApi )
+        {
+            PERF_BLOCK( MeshBase__DeleteIndexBuffer ) ;
+
+            ASSERT( renderApi ) ;
+
+            if( mIndexBuffer )
+            {
+                mIndexBuffer->Clear() ;
+                renderApi->DeleteIndexBuffer( mIndexBuffer ) ;
+                mIndexBuffer = NULLPTR ;
+            }
+        }
+
+
+
+
         void MeshBase::SetPrimitiveType( PrimitiveE primitiveType )
         {
             PERF_BLOCK( MeshBase__SetPrimitiveType ) ;
@@ -266,6 +307,8 @@ namespace PeGaSys {
                 mIndexBuffer = NULLPTR ;
             }
             mVertexBuffer->TranslateFromGeneric( VertexDeclaration( vertexFormat ) ) ;
+
+            SetBoundingBox( Vec3( 0.0f , 0.0f , 0.0f ) , dimensions ) ;
         }
 
 
@@ -370,6 +413,8 @@ namespace PeGaSys {
 
             mVertexBuffer->TranslateFromGeneric( VertexDeclaration( vertexFormat ) ) ;
 
+            SetBoundingBox( Vec3( - radius , - radius , - radius ) , Vec3( radius , radius , radius ) ) ;
+
             // Create and populate index buffer (triangles).
             const int   numTriangles    = (height-2)*(width-1)*2;
 
@@ -8,6 +8,9 @@
 #define PEGASYS_RENDER_MESH_H
 
 #include "Core/Containers/intrusivePtr.h"
+#include "Core/Memory/poolAllocator.h"
+
+#include "Core/Math/vec3.h"
 
 #include "Render/Resource/vertexBuffer.h"
 #include "Render/Resource/technique.h"
@@ -15,8 +18,6 @@
 // Macros ----------------------------------------------------------------------
 // Types -----------------------------------------------------------------------
 
-struct Vec3 ;
-
 namespace PeGaSys
 {
 
@@ -44,9 +45,11 @@ namespace PeGaSys
 
         /** Geometry mesh base class.
         */
-        class MeshBase : public RefCountedMixin
+        class MeshBase : public AtomicRefCountedMixin
         {
             public:
+                POOLED_ALLOCATION   // Render resources come from pools, so resetting a scene reuses their memory.
+
                 MeshBase( ModelData * owningModelData ) ;
                 virtual ~MeshBase() ;
 
@@ -68,6 +71,8 @@ namespace PeGaSys
                 PrimitiveE GetPrimitiveType() const { return mPrimitiveType ; }
 
                 VertexBufferBase * NewVertexBuffer( ApiBase * renderApi ) ;
+                IndexBufferBase *  NewIndexBuffer( ApiBase * renderApi ) ;
+                void               DeleteIndexBuffer( ApiBase * renderApi ) ;
 
                 /// Return address of buffer for vertices that define this mesh.
                 VertexBufferBase *      GetVertexBuffer()       { return mVertexBuffer ; }
@@ -80,6 +85,18 @@ namespace PeGaSys
                 void MakeBox( ApiBase * renderApi , const Vec3 & dimensions , VertexDeclaration::VertexFormatE vertexFormat , PrimitiveE primitiveType = PRIMITIVE_TRIANGLES , bool useIndices = false ) ;
                 void MakeSphere( ApiBase * renderApi , float radius , int numLatitudinalSegment , int numLongitudinalSegments , VertexDeclaration::VertexFormatE vertexFormat ) ;
 
+                /// Set local-space axis-aligned box that contains all vertices of this mesh.
+                void SetBoundingBox( const Vec3 & minCorner , const Vec3 & maxCorner ) { mMinCorner = minCorner ; mMaxCorner = maxCorner ; mHasBoundingBox = true ; }
+
+                /// Return whether this mesh knows a box that contains all its vertices.  Meshes whose vertices come from elsewhere might not.
+                bool HasBoundingBox() const         { return mHasBoundingBox ; }
+
+                /// Return minimal corner of local-space box that contains all vertices of this mesh.
+                const Vec3 & GetMinCorner() const   { ASSERT( mHasBoundingBox ) ; return mMinCorner ; }
+
+                /// Return maximal corner of local-space box that contains all vertices of this mesh.
+                const Vec3 & GetMaxCorner() const   { ASSERT( mHasBoundingBox ) ; return mMaxCorner ; }
+
             private:
                 typedef IntrusivePtr< Technique > TechniquePtr ;
 
@@ -88,6 +105,9 @@ namespace PeGaSys
                 VertexBufferBase    *   mVertexBuffer       ;   ///< Vertex data.
                 IndexBufferBase     *   mIndexBuffer        ;   ///< Index data.
                 PrimitiveE              mPrimitiveType      ;   ///< Type of primitive shape this mesh uses.
+                Vec3                    mMinCorner          ;   ///< Minimal corner of local-space box containing all vertices, when mHasBoundingBox.
+                Vec3                    mMaxCorner          ;   ///< Maximal corner of local-space box containing all vertices, when mHasBoundingBox.
+                bool                    mHasBoundingBox     ;   ///< Whether mMinCorner and mMaxCorner contain all vertices.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -14,6 +14,8 @@
 #include <Core/Memory/newWrapper.h>
 #include <Core/File/debugPrint.h>
 
+#include <string.h>
+
 // Types -----------------------------------------------------------------------
 // Private variables -----------------------------------------------------------
 // Public variables ------------------------------------------------------------
@@ -68,6 +70,65 @@ namespace PeGaSys {
 
 
 
+        /** Return whether applying this pass would have the same effect as applying the given one.
+
+            Passes are equivalent when their render states are equivalent and they bind
+            the same textures with the same sampler settings.  The caller can then skip
+            applying one pass after applying the other.
+        */
+        bool Pass::IsEquivalentTo( const Pass & that ) const
+        {
+            PERF_BLOCK( Pass__IsEquivalentTo ) ;
+
+            if( this == & that )
+            {   // Every pass is equivalent to itself.
+                return true ;
+            }
+
+            if(     ( mTextureStages.Size() != that.mTextureStages.Size() )
+                ||  ! GetRenderState().IsEquivalentTo( that.GetRenderState() ) )
+            {
+                return false ;
+            }
+
+            for( size_t unit = 0 ; unit < mTextureStages.Size() ; ++ unit )
+            {   // For each texture unit...
+                const TextureStage & stage      = mTextureStages[ unit ] ;
+                const TextureStage & thatStage  = that.mTextureStages[ unit ] ;
+                // SamplerStateS has only enumerated members, so no padding, so memcmp suffices.
+                if(     ( stage.mTexture.Get() != thatStage.mTexture.Get() )
+                    ||  memcmp( & stage.mSamplerState , & thatStage.mSamplerState , sizeof( SamplerStateS ) ) )
+                {
+                    return false ;
+                }
+            }
+
+            return true ;
+        }
+
+
+
+
+        /** Return whether the image rendered with this pass depends on the order in which meshes render.
+
+            Drawing with blending, without writing depth, or with any depth test other
+            than less-than composes with what was drawn before, so a renderer must not
+            reorder draws that use this pass relative to other draws.  Otherwise, the
+            depth test resolves visibility regardless of draw order.
+        */
+        bool Pass::IsOrderDependent() const
+        {
+            PERF_BLOCK( Pass__IsOrderDependent ) ;
+
+            const RenderStateS & renderState = GetRenderState() ;
+            return  renderState.mBlendState.mBlendEnabled
+                ||  ! renderState.mDepthState.mDepthWriteEnabled
+                ||  ( CMP_FUNC_LESS != renderState.mDepthState.mDepthFunc ) ;
+        }
+
+
+
+
         /** Add an empty TextureStage to this pass, for caller to populate.
         */
         void Pass::AddTextureStage()
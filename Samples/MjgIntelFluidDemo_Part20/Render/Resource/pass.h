@@ -33,6 +33,9 @@ namespace PeGaSys
 
                 void Apply( ApiBase * renderApi ) const ;
 
+                bool IsEquivalentTo( const Pass & that ) const ;
+                bool IsOrderDependent() const ;
+
                       RenderState & GetRenderState()       { return mRenderState ; }
                 const RenderState & GetRenderState() const { return mRenderState ; }
 
@@ -52,6 +52,15 @@ namespace PeGaSys
             BlendFactorE    mBlendSrcAlpha  ;   ///< Blend factor for source term.  Default is one.
             BlendFactorE    mBlendDstAlpha  ;   ///< Blend factor for destination term.  Default is zero
             BlendOpE        mBlendOpAlpha   ;   ///< Blend operation to perform to combine src and dst terms.  Default is add.
+            bool            mOrderIndependent ; ///< Whether, between ApiBase::BeginOrderIndependentTransparency and EndOrderIndependentTransparency, to accumulate instead of blend, so draw order does not matter.  Otherwise the factors above apply.  Default is false.
+
+            /// Return whether this blend state has the same effect as the given one.
+            bool operator==( const BlendStateS & that ) const
+            {
+                return ( mBlendEnabled  == that.mBlendEnabled  ) && ( mBlendSrcColor == that.mBlendSrcColor ) && ( mBlendDstColor == that.mBlendDstColor )
+                    && ( mBlendOpColor  == that.mBlendOpColor  ) && ( mBlendSrcAlpha == that.mBlendSrcAlpha ) && ( mBlendDstAlpha == that.mBlendDstAlpha )
+                    && ( mBlendOpAlpha  == that.mBlendOpAlpha  ) && ( mOrderIndependent == that.mOrderIndependent ) ;
+            }
         } ;
 
         class BlendState : public BlendStateS
@@ -66,6 +75,7 @@ namespace PeGaSys
                 mBlendSrcAlpha = BLEND_FACTOR_ONE   ;
                 mBlendDstAlpha = BLEND_FACTOR_ZERO  ;
                 mBlendOpAlpha  = BLEND_OP_ADD       ;
+                mOrderIndependent = false           ;
             }
 
             operator BlendStateS & ()
@@ -82,6 +92,7 @@ namespace PeGaSys
                 mBlendSrcAlpha = BLEND_FACTOR_ONE   ;
                 mBlendDstAlpha = BLEND_FACTOR_ZERO  ;
                 mBlendOpAlpha  = BLEND_OP_ADD       ;
+                mOrderIndependent = false           ;
             }
 
             void SetAlpha()
@@ -93,6 +104,7 @@ namespace PeGaSys
                 mBlendSrcAlpha = BLEND_FACTOR_SRC_ALPHA     ;
                 mBlendDstAlpha = BLEND_FACTOR_INV_SRC_ALPHA ;
                 mBlendOpAlpha  = BLEND_OP_ADD               ;
+                mOrderIndependent = false                   ;
             }
 
             void SetAdditive()
@@ -104,6 +116,19 @@ namespace PeGaSys
                 mBlendSrcAlpha = BLEND_FACTOR_SRC_ALPHA ;
                 mBlendDstAlpha = BLEND_FACTOR_ONE       ;
                 mBlendOpAlpha  = BLEND_OP_ADD           ;
+                mOrderIndependent = false               ;
+            }
+
+            /** Blend like SetAlpha, except that between ApiBase::BeginOrderIndependentTransparency
+                and EndOrderIndependentTransparency, draw order does not matter.
+
+                That lets translucent particles skip sorting.  APIs that do not
+                support order-independent transparency blend as SetAlpha does.
+            */
+            void SetOrderIndependentAlpha()
+            {
+                SetAlpha() ;
+                mOrderIndependent = true ;
             }
 
         } ;
@@ -122,6 +147,12 @@ namespace PeGaSys
             bool            mDepthWriteEnabled  ;   ///< Whether to write to the depth buffer. Default is true.
             int             mDepthBias          ;   ///< Depth value added to each pixel. Default is 0.
             bool            mDepthClip          ;   ///< Whether to enable depth-clipping. Default is true.
+
+            /// Return whether this depth state has the same effect as the given one.
+            bool operator==( const DepthStateS & that ) const
+            {
+                return ( mDepthFunc == that.mDepthFunc ) && ( mDepthWriteEnabled == that.mDepthWriteEnabled ) && ( mDepthBias == that.mDepthBias ) && ( mDepthClip == that.mDepthClip ) ;
+            }
         } ;
 
         class DepthState : public DepthStateS
@@ -140,6 +171,12 @@ namespace PeGaSys
         {
             bool    mStencilEnabled ;   ///< Whether to perform stencil testing. Default is false.
             // TODO: FIXME: add other stencil state parameters.
+
+            /// Return whether this stencil state has the same effect as the given one.
+            bool operator==( const StencilStateS & that ) const
+            {
+                return mStencilEnabled == that.mStencilEnabled ;
+            }
         } ;
 
         class StencilState : public StencilStateS
@@ -156,6 +193,12 @@ namespace PeGaSys
             bool            mAlphaTest  ;   ///< Whether to enable alpha-test.  Default is false.
             CompareFuncE    mAlphaFunc  ;   ///< Test to use to accept or reject pixel, based on its alpha value.  Default is GREATEREQUAL.
             float           mAlphaRef   ;   ///< Value to use for the current/source alpha during alpha-test comparisons.  Default is 0.
+
+            /// Return whether this alpha-test state has the same effect as the given one.
+            bool operator==( const AlphaStateS & that ) const
+            {
+                return ( mAlphaTest == that.mAlphaTest ) && ( mAlphaFunc == that.mAlphaFunc ) && ( mAlphaRef == that.mAlphaRef ) ;
+            }
         } ;
 
         class AlphaState : public AlphaStateS
@@ -189,6 +232,12 @@ namespace PeGaSys
             CullModeE       mCullMode           ;   ///< Which faces, if any, to cull.  Default is CULL_MODE_BACK.
             bool            mMultiSampleEnabled ;   ///< Whether to enable multi-sample anti-aliasing.  Default is false.
             bool            mSmoothLines        ;   ///< Whether to use smooth-line rendering.  Default is false.
+
+            /// Return whether this raster state has the same effect as the given one.
+            bool operator==( const RasterStateS & that ) const
+            {
+                return ( mFillMode == that.mFillMode ) && ( mCullMode == that.mCullMode ) && ( mMultiSampleEnabled == that.mMultiSampleEnabled ) && ( mSmoothLines == that.mSmoothLines ) ;
+            }
         } ;
 
         class RasterState : public RasterStateS
@@ -215,6 +264,12 @@ namespace PeGaSys
         {
             void * mDummy ;
             // TODO: FIXME: Add shader info.  Maybe this will end up being abstract.
+
+            /// Return whether this shader is the same as the given one.
+            bool operator==( const ShaderS & that ) const
+            {
+                return mDummy == that.mDummy ;
+            }
         } ;
 
 
@@ -234,6 +289,13 @@ namespace PeGaSys
             Vec4    mSpecularColor  ;
             Vec4    mEmissiveColor  ;
             float   mSpecularPower  ;
+
+            /// Return whether these material properties are the same as the given ones.
+            bool operator==( const MaterialPropertiesS & that ) const
+            {
+                return ( mDiffuseColor  == that.mDiffuseColor  ) && ( mAmbientColor  == that.mAmbientColor  ) && ( mSpecularColor == that.mSpecularColor )
+                    && ( mEmissiveColor == that.mEmissiveColor ) && ( mSpecularPower == that.mSpecularPower ) ;
+            }
         } ;
 
         class MaterialProperties : public MaterialPropertiesS
@@ -277,6 +339,18 @@ namespace PeGaSys
             Shader              mShader             ;
             MaterialProperties  mMaterialProperties ;
             Transforms          mTransforms         ;
+
+            /** Return whether applying this render state would have the same effect as applying the given one.
+
+                This ignores mTransforms, which ApiBase::ApplyRenderState does not apply.
+                Comparing member by member, rather than with memcmp, disregards padding.
+            */
+            bool IsEquivalentTo( const RenderStateS & that ) const
+            {
+                return ( mBlendState   == that.mBlendState   ) && ( mDepthState  == that.mDepthState  ) && ( mStencilState == that.mStencilState )
+                    && ( mAlphaState   == that.mAlphaState   ) && ( mRasterState == that.mRasterState ) && ( mShadeMode    == that.mShadeMode    )
+                    && ( mShader       == that.mShader       ) && ( mMaterialProperties == that.mMaterialProperties ) ;
+            }
         } ;
 
 
@@ -7,7 +7,10 @@
 
 #include "Render/Resource/texture.h"
 
+#include "Render/Resource/deferredReleaseQueue.h"
+
 #include <Core/Performance/perfBlock.h>
+#include <Core/Performance/memoryBudget.h>
 #include <Core/Utility/macros.h>
 #include <Core/Memory/newWrapper.h>
 #include <Core/File/debugPrint.h>
@@ -31,6 +34,7 @@ namespace PeGaSys {
             , mFormat( TEX_FORMAT_UNDEFINED )
             , mUsageFlags( TEX_USAGE_DEFAULT )
             , mShape( TEX_SHAPE_UNDEFINED )
+            , mTrackedBytes( 0 )
         {
             PERF_BLOCK( TextureBase__TextureBase ) ;
         }
@@ -48,6 +52,7 @@ namespace PeGaSys {
             , mFormat( TEX_FORMAT_UNDEFINED )
             , mUsageFlags( TEX_USAGE_DEFAULT )
             , mShape( TEX_SHAPE_UNDEFINED )
+            , mTrackedBytes( 0 )
         {
             PERF_BLOCK( TextureBase__TextureBase ) ;
 
@@ -68,6 +73,8 @@ namespace PeGaSys {
         TextureBase::~TextureBase()
         {
             PERF_BLOCK( TextureBase__dtor ) ;
+
+            MemoryBudget::Track( MemoryBudget::SUBSYSTEM_RENDER_TEXTURES , - ptrdiff_t( mTrackedBytes ) ) ;
         }
 
 
@@ -82,7 +89,8 @@ namespace PeGaSys {
 
             if( _ReleaseReference() )
             {   // That was the last reference to this object.
-                delete this ;
+                // Any thread can release it, but only the render thread can free its render API objects.
+                DeferredReleaseQueue::Delete( this ) ;
             }
         }
 
@@ -96,6 +104,7 @@ namespace PeGaSys {
             ASSERT( 0 == mWidth ) ; // Not allowed to change after assigned
             ASSERT( width > 0 ) ;
             mWidth = width ;
+            TrackMemory() ;
         }
 
 
@@ -109,6 +118,7 @@ namespace PeGaSys {
             ASSERT( height > 0 ) ;
             ASSERT( ( TEX_SHAPE_1D != GetShape() ) || ( 1 == height ) ) ; // If 1D texture, height must be 1.
             mHeight = height ;
+            TrackMemory() ;
         }
 
 
@@ -118,13 +128,14 @@ namespace PeGaSys {
         {
             PERF_BLOCK( TextureBase__SetNumPlanes ) ;
 
-            UNUSED_PARAM( numPlanes ) ; // Avoid "unreferenced formal parameter" in non-DEBUG builds.
             ASSERT( 0 == mNumPlanes ) ; // Not allowed to change after assigned
             ASSERT( numPlanes > 0 ) ;
             ASSERT(     ( 1 == numPlanes )
                 ||  ( TEX_SHAPE_UNDEFINED == GetShape() )
                 ||  ( TEX_SHAPE_ARRAY     == GetShape() )
                 ||  ( TEX_SHAPE_3D        == GetShape() ) ) ;
+            mNumPlanes = numPlanes ;
+            TrackMemory() ;
         }
 
 
@@ -137,6 +148,7 @@ namespace PeGaSys {
             ASSERT( 0 == mNumMipLevels ) ; // Not allowed to change after assigned
             ASSERT( numMipLevels > 0 ) ;
             mNumMipLevels = numMipLevels ;
+            TrackMemory() ;
         }
 
 
@@ -149,6 +161,7 @@ namespace PeGaSys {
             ASSERT( TEX_FORMAT_UNDEFINED == mFormat ) ; // Not allowed to change after assigned.
             ASSERT( format != TEX_FORMAT_UNDEFINED ) ;
             mFormat = format ;
+            TrackMemory() ;
         }
 
 
@@ -169,14 +182,76 @@ namespace PeGaSys {
         {
             PERF_BLOCK( TextureBase__SetShape ) ;
 
-            NON_DEBUG_ONLY( UNUSED_PARAM( shape ) ) ; // Avoid "unreferenced formal parameter" in non-DEBUG builds.
-
             ASSERT( TEX_SHAPE_UNDEFINED == mShape ) ; // Not allowed to change after assigned.
             ASSERT( shape != TEX_SHAPE_UNDEFINED ) ;
             ASSERT( ( shape != TEX_SHAPE_1D      ) || ( ( 0 == GetHeight()    ) || ( 1 == GetHeight()    ) ) )      ; // If 1D texture, either height must be unassigned or 1.
             ASSERT( ( shape != TEX_SHAPE_2D      ) || ( ( 0 == GetNumPlanes() ) || ( 1 == GetNumPlanes() ) ) )      ; // If 2D texture, either depth must be unassigned or 1.
             ASSERT( ( shape != TEX_SHAPE_CUBEMAP ) || ( ( 0 == GetNumPlanes() ) || ( 1 == GetNumPlanes() ) ) )      ; // If cubemap texture, either depth must be unassigned or 1.
             ASSERT( ( shape != TEX_SHAPE_CUBEMAP ) || ( ( 0 == GetWidth() )     || ( GetWidth() == GetHeight() ) ) ) ; // If cubemap texture, width must equal height (square faces).
+            mShape = shape ;
+            TrackMemory() ;
+        }
+
+
+
+
+        /** Return approximate number of bytes this texture occupies, including all MIP levels.
+
+            Drivers can pad and align texture memory, so this underestimates
+            what the device allocates, but tracks how it scales with size.
+            Returns zero until width, height, format and number of planes are assigned.
+        */
+        size_t TextureBase::GetMemoryUsage() const
+        {
+            size_t bitsPerTexel = 0 ;
+            switch( mFormat )
+            {
+            case TEX_FORMAT_R8G8B8  : bitsPerTexel = 24 ; break ;
+            case TEX_FORMAT_A8R8G8B8: bitsPerTexel = 32 ; break ;
+            case TEX_FORMAT_D16     : bitsPerTexel = 16 ; break ;
+            case TEX_FORMAT_D32     : bitsPerTexel = 32 ; break ;
+            case TEX_FORMAT_D24S8   : bitsPerTexel = 32 ; break ;
+            case TEX_FORMAT_BC4     : bitsPerTexel =  4 ; break ;
+            case TEX_FORMAT_BC7     : bitsPerTexel =  8 ; break ;
+            default                 : return 0 ;
+            }
+            if( ( 0 == mWidth ) || ( 0 == mHeight ) || ( 0 == mNumPlanes ) )
+            {   // Texture not fully described yet.
+                return 0 ;
+            }
+
+            const size_t    numFaces        = ( TEX_SHAPE_CUBEMAP == mShape ) ? 6 : 1 ;
+            const bool      planesShrink    = ( TEX_SHAPE_3D == mShape ) ;  // Volume MIP levels halve depth too; array layers do not.
+            const int       numMipLevels    = Max2( mNumMipLevels , 1 ) ;
+            size_t          width           = size_t( mWidth ) ;
+            size_t          height          = size_t( mHeight ) ;
+            size_t          numPlanes       = size_t( mNumPlanes ) ;
+            size_t          numTexels       = 0 ;
+            for( int level = 0 ; level < numMipLevels ; ++ level )
+            {   // For each MIP level...
+                numTexels += width * height * numPlanes ;
+                width   = Max2( width  / 2 , size_t( 1 ) ) ;
+                height  = Max2( height / 2 , size_t( 1 ) ) ;
+                if( planesShrink )
+                {
+                    numPlanes = Max2( numPlanes / 2 , size_t( 1 ) ) ;
+                }
+            }
+            return numFaces * numTexels * bitsPerTexel / 8 ;
+        }
+
+
+
+
+        /** Report change in memory this texture occupies to MemoryBudget.
+
+            Properties get assigned one at a time, so this runs after each.
+        */
+        void TextureBase::TrackMemory()
+        {
+            const size_t numBytes = GetMemoryUsage() ;
+            MemoryBudget::Track( MemoryBudget::SUBSYSTEM_RENDER_TEXTURES , ptrdiff_t( numBytes ) - ptrdiff_t( mTrackedBytes ) ) ;
+            mTrackedBytes = numBytes ;
         }
 
 
@@ -8,6 +8,7 @@
 #define PEGASYS_RENDER_TEXTURE_H
 
 #include "Core/Containers/intrusivePtr.h"
+#include "Core/Memory/poolAllocator.h"
 
 // Macros ----------------------------------------------------------------------
 // Types -----------------------------------------------------------------------
@@ -16,6 +17,7 @@ namespace PeGaSys
 {
     // Forward declaration.
     class Image ;
+    class CompressedImage ;
 
     namespace Render
     {
@@ -25,9 +27,11 @@ namespace PeGaSys
 
         /** Texture base class.
         */
-        class TextureBase : public RefCountedMixin
+        class TextureBase : public AtomicRefCountedMixin
         {
             public:
+                POOLED_ALLOCATION   // Render resources come from pools, so resetting a scene reuses their memory.
+
                 /** Format of texture data.
                 */
                 enum FormatE
@@ -37,6 +41,8 @@ namespace PeGaSys
                     TEX_FORMAT_D16      ,
                     TEX_FORMAT_D32      ,
                     TEX_FORMAT_D24S8    ,
+                    TEX_FORMAT_BC4      ,   ///< One channel, block-compressed, half a byte per texel.
+                    TEX_FORMAT_BC7      ,   ///< RGBA, block-compressed, one byte per texel.
                     TEX_FORMAT_UNDEFINED    ///< Texture format not assigned yet.
                 } ;
 
@@ -90,10 +96,20 @@ namespace PeGaSys
                 const UsageFlagsE & GetUsageFlags() const   { return mUsageFlags ; }
                 const ShapeE &      GetShape() const        { return mShape ; }
 
+                size_t              GetMemoryUsage() const ;
+
                 virtual void Bind( ApiBase * renderApi , const SamplerStateS & samplerState ) = 0 ;
                 virtual void CreateFromImages( const Image * images , size_t numImages ) = 0 ;
                 virtual void CopyToImage( Image & image ) = 0 ;
 
+                /** Create texture from the given block-compressed image, including all its MIP levels.
+
+                    \return Whether this created the texture.  If not, for example because the
+                            platform lacks the compressed format, the texture remains empty,
+                            and the caller should decompress the image and call CreateFromImages.
+                */
+                virtual bool CreateFromCompressedImage( const CompressedImage & /*compressedImage*/ ) { return false ; }
+
             protected:
                 int         mWidth          ;   ///< Texture width, in pixels.
                 int         mHeight         ;   ///< Texture height, in pixels.
@@ -102,6 +118,11 @@ namespace PeGaSys
                 FormatE     mFormat         ;   ///< Format of texture data.
                 UsageFlagsE mUsageFlags     ;   ///< Memory usage of texture data.
                 ShapeE      mShape          ;   ///< Topological configuration of texture.
+
+            private:
+                void        TrackMemory() ;
+
+                size_t      mTrackedBytes   ;   ///< Number of bytes this texture reported to MemoryBudget.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -0,0 +1,302 @@
+/** \file textureUploadQueue.cpp
+
+    \brief Queue that generates texture images on a worker thread and uploads them on the render thread.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Resource/textureUploadQueue.h"
+
+#include <Image/imageCache.h>
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+#include <Core/Memory/newWrapper.h>
+#include <Core/File/debugPrint.h>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct texture upload queue.
+
+            This does not start the worker thread; the first Enqueue does.
+        */
+        TextureUploadQueue::TextureUploadQueue()
+            :
+        #if TEXTURE_UPLOAD_QUEUE_ASYNC
+              mWorkerThread( NULL ) ,
+        #endif
+              mNumPending( 0 )
+        {
+            PERF_BLOCK( TextureUploadQueue__TextureUploadQueue ) ;
+        }
+
+
+
+
+        /** Destruct texture upload queue.
+
+            This stops the worker thread and discards images not yet uploaded,
+            without uploading them, since the render device might already be gone.
+        */
+        TextureUploadQueue::~TextureUploadQueue()
+        {
+            PERF_BLOCK( TextureUploadQueue__dtor ) ;
+
+        #if TEXTURE_UPLOAD_QUEUE_ASYNC
+            if( mWorkerThread )
+            {   // Worker thread is running.
+                mRequests.push( NULLPTR ) ; // Tell worker thread to exit once it finishes the jobs ahead of this.
+                WaitForSingleObject( mWorkerThread , INFINITE ) ;
+                CloseHandle( mWorkerThread ) ;
+                mWorkerThread = NULL ;
+            }
+        #endif
+
+            Job * job = NULLPTR ;
+            while( TryPopCompleted( job ) )
+            {   // For each job not yet uploaded...
+                delete job ;
+            }
+        }
+
+
+
+
+        /** Request that the given texture get the image the given function generates.
+
+            \param texture      Texture to upload into.  This queue holds a reference to it until the upload.
+
+            \param makeImage    Function that generates the image.  Runs on the worker thread, so must be thread-safe.
+
+            \param cacheFilename    Name of file that caches the image, or NULL to always generate it.
+                                    Must outlive the job, so is typically a string literal.
+
+            \param cacheKey     Hash of what makeImage does, including its parameters, which the cache file must match.
+                                Change this whenever makeImage would generate a different image.
+
+            \param compress     Whether to block-compress the image, which suits images that
+                                tolerate slight loss, like the soft gradients of particle textures.
+                                If the texture shape is TEX_SHAPE_ARRAY, pages become layers.
+
+            This returns without waiting for the image.  See UploadCompleted.
+        */
+        void TextureUploadQueue::Enqueue( TextureBase * texture , MakeImageFunctionT makeImage , const char * cacheFilename , unsigned long long cacheKey , bool compress )
+        {
+            PERF_BLOCK( TextureUploadQueue__Enqueue ) ;
+
+            ASSERT( texture && makeImage ) ;
+
+            Job * job = NEW Job ;
+            job->mTexture       = texture ;
+            job->mMakeImage     = makeImage ;
+            job->mCacheFilename = cacheFilename ;
+            job->mCacheKey      = cacheKey ;
+            job->mCompress      = compress ;
+            job->mLayered       = ( TextureBase::TEX_SHAPE_ARRAY == texture->GetShape() ) ;
+            if( compress )
+            {   // Compressed cache files must also match how compression works, and which layout it uses.
+                job->mCacheKey = ImageCache_Hash( & CompressedImage_sVersion , sizeof( CompressedImage_sVersion ) , job->mCacheKey ) ;
+                job->mCacheKey = ImageCache_Hash( & job->mLayered , sizeof( job->mLayered ) , job->mCacheKey ) ;
+            }
+            ++ mNumPending ;
+
+        #if TEXTURE_UPLOAD_QUEUE_ASYNC
+            if( NULL == mWorkerThread )
+            {   // This is the first request.
+                mWorkerThread = CreateThread( NULL , 0 , WorkerThreadMain , this , 0 , NULL ) ;
+                ASSERT( mWorkerThread ) ;
+            }
+            mRequests.push( job ) ;
+        #else
+            MakeImage( * job ) ;
+            mCompleted.PushBack( job ) ;
+        #endif
+        }
+
+
+
+
+        /** Upload images that the worker thread has generated, oldest first.
+
+            \param maxUploads   Maximum number of textures to upload, to bound the time this takes.
+
+            \return Number of textures this uploaded.
+
+            Call this from the render thread, with the render device current, once per frame.
+        */
+        size_t TextureUploadQueue::UploadCompleted( size_t maxUploads )
+        {
+            PERF_BLOCK( TextureUploadQueue__UploadCompleted ) ;
+
+            size_t numUploads = 0 ;
+            Job * job = NULLPTR ;
+            while( ( numUploads < maxUploads ) && TryPopCompleted( job ) )
+            {   // For each job ready to upload, within budget...
+                Upload( * job ) ;
+                delete job ;
+                -- mNumPending ;
+                ++ numUploads ;
+            }
+            return numUploads ;
+        }
+
+
+
+
+        /** Wait for the worker thread to generate every pending image, then upload them all.
+
+            Call this from the render thread, with the render device current,
+            when textures must be complete, for example before capturing a frame.
+        */
+        void TextureUploadQueue::Finish()
+        {
+            PERF_BLOCK( TextureUploadQueue__Finish ) ;
+
+            while( mNumPending > 0 )
+            {   // For each job not yet uploaded...
+                Job * job = NULLPTR ;
+            #if TEXTURE_UPLOAD_QUEUE_ASYNC
+                mCompleted.pop( job ) ; // Wait for worker thread.
+            #else
+                const bool popped = TryPopCompleted( job ) ;
+                ASSERT( popped ) ; NON_DEBUG_ONLY( UNUSED_PARAM( popped ) ) ;
+            #endif
+                Upload( * job ) ;
+                delete job ;
+                -- mNumPending ;
+            }
+        }
+
+
+
+
+        /** Remove the oldest job whose image is ready, if any.
+
+            \return Whether there was such a job.
+        */
+        bool TextureUploadQueue::TryPopCompleted( Job * & job )
+        {
+        #if TEXTURE_UPLOAD_QUEUE_ASYNC
+            return mCompleted.try_pop( job ) ;
+        #else
+            if( mCompleted.Empty() )
+            {
+                return false ;
+            }
+            job = mCompleted.Front() ;
+            mCompleted.PopFront() ;
+            return true ;
+        #endif
+        }
+
+
+
+
+        /** Populate the image of the given job, from its cache file if that is valid, else by generating it.
+
+            Loading a cached image takes about as long as copying it, whereas
+            generating one runs a sequence of image operations, so this
+            makes startup after the first launch much faster.
+        */
+        /* static */ void TextureUploadQueue::MakeImage( Job & job )
+        {
+            PERF_BLOCK( TextureUploadQueue__MakeImage ) ;
+
+            if( job.mCompress )
+            {   // Job wants a compressed image.
+                if( job.mCacheFilename && ImageCache_LoadCompressed( job.mCacheFilename , job.mCacheKey , job.mCompressedImage ) )
+                {   // Cache had compressed image.
+                    return ;
+                }
+
+                job.mMakeImage( job.mImage ) ;
+                job.mCompressedImage.Compress( job.mImage , job.mLayered ) ;
+
+                if( job.mCacheFilename && ! ImageCache_SaveCompressed( job.mCacheFilename , job.mCacheKey , job.mCompressedImage ) )
+                {   // Failed to save cache.  Not fatal; the next launch will generate the image again.
+                    DEBUG_ONLY( DebugPrintf( "TextureUploadQueue::MakeImage: failed to write cache file %s\n" , job.mCacheFilename ) ) ;
+                }
+                return ;
+            }
+
+            if( job.mCacheFilename && ImageCache_Load( job.mCacheFilename , job.mCacheKey , job.mImage ) )
+            {   // Cache had image.
+                return ;
+            }
+
+            job.mMakeImage( job.mImage ) ;
+
+            if( job.mCacheFilename && ! ImageCache_Save( job.mCacheFilename , job.mCacheKey , job.mImage ) )
+            {   // Failed to save cache.  Not fatal; the next launch will generate the image again.
+                DEBUG_ONLY( DebugPrintf( "TextureUploadQueue::MakeImage: failed to write cache file %s\n" , job.mCacheFilename ) ) ;
+            }
+        }
+
+
+
+
+        /** Upload the image of the given job into its texture.
+
+            This prefers the compressed image, if the job has one and the
+            texture can take it, and otherwise uploads the uncompressed image,
+            decompressing it first if only the compressed image came from cache.
+        */
+        /* static */ void TextureUploadQueue::Upload( Job & job )
+        {
+            PERF_BLOCK( TextureUploadQueue__Upload ) ;
+
+            if( ! job.mCompressedImage.IsEmpty() )
+            {   // Job has compressed image.
+                if( job.mTexture->CreateFromCompressedImage( job.mCompressedImage ) )
+                {   // Texture took compressed image.
+                    return ;
+                }
+                if( NULLPTR == job.mImage.GetImageData() )
+                {   // Compressed image came from cache, so uncompressed image does not exist.
+                    job.mCompressedImage.Decompress( job.mImage ) ;
+                }
+            }
+            job.mTexture->CreateFromImages( & job.mImage , 1 ) ;
+        }
+
+
+
+
+    #if TEXTURE_UPLOAD_QUEUE_ASYNC
+
+        /** Generate images as requests arrive, until the destructor says to exit.
+
+            \param context  Address of the TextureUploadQueue instance.
+
+            This only generates images; uploading requires the render device, so happens on the render thread.
+        */
+        /* static */ DWORD WINAPI TextureUploadQueue::WorkerThreadMain( LPVOID context )
+        {
+            TextureUploadQueue * queue = reinterpret_cast< TextureUploadQueue * >( context ) ;
+
+            for( ;; )
+            {   // For each request...
+                Job * job = NULLPTR ;
+                queue->mRequests.pop( job ) ;
+                if( NULLPTR == job )
+                {   // Destructor wants this thread to exit.
+                    break ;
+                }
+                MakeImage( * job ) ;
+                queue->mCompleted.push( job ) ;
+            }
+
+            return 0 ;
+        }
+
+    #endif
+
+    } ;
+} ;
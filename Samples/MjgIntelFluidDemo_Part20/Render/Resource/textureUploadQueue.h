@@ -0,0 +1,128 @@
+/** \file textureUploadQueue.h
+
+    \brief Queue that generates texture images on a worker thread and uploads them on the render thread.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_TEXTURE_UPLOAD_QUEUE_H
+#define PEGASYS_RENDER_TEXTURE_UPLOAD_QUEUE_H
+
+#include "Render/Resource/texture.h"
+
+#include <Image/image.h>
+#include <Image/compressedImage.h>
+
+#include "Core/Containers/intrusivePtr.h"
+#include "Core/Containers/slist.h"
+#include "Core/useTbb.h"
+
+#if defined( WIN32 )
+#   include <windows.h>
+#endif
+
+#if USE_TBB
+#   include "tbb/concurrent_queue.h"
+#endif
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether TextureUploadQueue generates images on a worker thread.
+
+    Otherwise, Enqueue generates each image synchronously, but uploading
+    still waits for UploadCompleted, so callers behave the same either way.
+*/
+#if USE_TBB && defined( WIN32 )
+#   define TEXTURE_UPLOAD_QUEUE_ASYNC 1
+#else
+#   define TEXTURE_UPLOAD_QUEUE_ASYNC 0
+#endif
+
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        /** Queue that generates texture images on a worker thread and uploads them on the render thread.
+
+            Procedural textures take far longer to generate than to upload.
+            Enqueue hands the generation to a worker thread and returns
+            immediately, so the caller (and the simulation warming up
+            alongside it) does not wait.  The render thread calls
+            UploadCompleted once per frame, which uploads images the worker
+            finished, a few per frame, so no frame hitches on a burst of
+            uploads.  Until its upload, a texture has no image, so passes
+            that use it render untextured.
+
+            Image generators must be thread-safe: They run on the worker
+            thread, concurrently with everything else.
+
+            Given a cache file name, the worker first tries to load the
+            image from that file, and only runs the generator if the file is
+            missing or its key differs, then saves what it generated, so
+            later launches skip generation.  See ImageCache_Load.
+
+            Given compress, the worker also block-compresses the image (see
+            CompressedImage) and caches the compressed result instead, so
+            later launches skip compression too, and the render thread
+            uploads compressed blocks.  Platforms that cannot sample the
+            compressed format get the decompressed image instead.
+        */
+        class TextureUploadQueue
+        {
+            public:
+                /// Function that generates an image for a texture.
+                typedef void ( * MakeImageFunctionT )( Image & image ) ;
+
+                TextureUploadQueue() ;
+                ~TextureUploadQueue() ;
+
+                void    Enqueue( TextureBase * texture , MakeImageFunctionT makeImage , const char * cacheFilename = NULLPTR , unsigned long long cacheKey = 0 , bool compress = false ) ;
+                size_t  UploadCompleted( size_t maxUploads ) ;
+                void    Finish() ;
+
+                /// Return number of textures enqueued but not yet uploaded.
+                size_t  GetNumPending() const { return mNumPending ; }
+
+            private:
+                /** Request to generate an image then upload it into a texture.
+                */
+                struct Job
+                {
+                    IntrusivePtr< TextureBase > mTexture        ;   ///< Texture to upload into.  Holding a reference keeps it alive until the upload.
+                    MakeImageFunctionT          mMakeImage      ;   ///< Function that generates image.
+                    const char *                mCacheFilename  ;   ///< Name of file that caches image, or NULL to always generate it.  Must outlive job.
+                    unsigned long long          mCacheKey       ;   ///< Hash of what mMakeImage does, which cache file must match.
+                    bool                        mCompress       ;   ///< Whether to block-compress the image before upload.
+                    bool                        mLayered        ;   ///< Whether to lay out compressed pages for a texture array.  Captured on the render thread, so the worker need not query the texture.
+                    Image                       mImage          ;   ///< Image that mMakeImage generated, or that cache file held.  Empty if mCompressedImage came from cache.
+                    CompressedImage             mCompressedImage;   ///< Block-compressed mImage, if mCompress.
+                } ;
+
+                TextureUploadQueue( const TextureUploadQueue & ) ;              // Disallow copy
+                TextureUploadQueue & operator=( const TextureUploadQueue & ) ;  // Disallow assignment
+
+                bool    TryPopCompleted( Job * & job ) ;
+                static void MakeImage( Job & job ) ;
+                static void Upload( Job & job ) ;
+            #if TEXTURE_UPLOAD_QUEUE_ASYNC
+                static DWORD WINAPI WorkerThreadMain( LPVOID context ) ;
+            #endif
+
+            #if TEXTURE_UPLOAD_QUEUE_ASYNC
+                tbb::concurrent_bounded_queue< Job * >  mRequests       ;   ///< Jobs awaiting the worker thread, oldest first.  NULL tells the thread to exit.
+                tbb::concurrent_bounded_queue< Job * >  mCompleted      ;   ///< Jobs whose image the worker generated, awaiting upload, oldest first.
+                HANDLE                                  mWorkerThread   ;   ///< Thread that generates images, or NULL until the first Enqueue.
+            #else
+                SLIST< Job * >                          mCompleted      ;   ///< Jobs whose image Enqueue generated, awaiting upload, oldest first.
+            #endif
+                size_t                                  mNumPending     ;   ///< Number of jobs enqueued but not yet uploaded.  Only the render thread accesses this.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
@@ -8,13 +8,19 @@
 #include "Render/Resource/vertexBuffer.h"
 
 #include <Core/Performance/perfBlock.h>
+#include <Core/Performance/memoryBudget.h>
 #include <Core/Utility/macros.h>
 #include <Core/Memory/newWrapper.h>
 #include <Core/File/debugPrint.h>
 
+#include <float.h>
+
 // Types -----------------------------------------------------------------------
 // Private variables -----------------------------------------------------------
 // Public variables ------------------------------------------------------------
+
+const float PeGaSys::Render::VertexBufferBase::sMaxQuantizedPosition = 32767.0f ;
+
 // Private functions -----------------------------------------------------------
 // Public functions ------------------------------------------------------------
 
@@ -30,8 +36,16 @@ namespace PeGaSys {
             , mVertexSize( 0 )
             , mPopulation( 0 )
             , mCapacity( 0 )
+            , mUsage( USAGE_STATIC )
+            , mTrackedBytes( 0 )
         {
             PERF_BLOCK( VertexBufferBase__VertexBufferBase ) ;
+
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {   // Default to quantizing positions in [-1,1].
+                mPositionOffset[ axis ] = 0.0f ;
+                mPositionScale[ axis ]  = 1.0f / sMaxQuantizedPosition ;
+            }
         }
 
 
@@ -44,6 +58,9 @@ namespace PeGaSys {
             PERF_BLOCK( VertexBufferBase__dtor ) ;
 
             delete mGenericVertexData ;
+
+            // Derived class should have deallocated its buffer, but in case not, stop counting it.
+            MemoryBudget::Track( MemoryBudget::SUBSYSTEM_RENDER_BUFFERS , - ptrdiff_t( mTrackedBytes ) ) ;
         }
 
 
@@ -94,6 +111,43 @@ namespace PeGaSys {
 
 
 
+        /** Set how often the contents of this buffer change.
+
+            Platforms consult this when allocating, so call this before Allocate or ChangeCapacityAndReallocate.
+        */
+        void    VertexBufferBase::SetUsage( UsageE usage )
+        {
+            PERF_BLOCK( VertexBufferBase__SetUsage ) ;
+
+            ASSERT( ( usage == mUsage ) || ( 0 == GetCapacity() ) ) ; // Changing usage after allocating has no effect until the next allocation.
+            mUsage = usage ;
+        }
+
+
+
+
+        /** Set box that quantized positions span, for formats such as POSITION_NORMAL_PACKED.
+
+            Fill vertices only after setting this, and keep the box unchanged
+            while the GPU might still read vertices filled before, since
+            rendering dequantizes using the box current at the time.
+        */
+        void    VertexBufferBase::SetPositionBounds( const float minCorner[ 3 ] , const float maxCorner[ 3 ] )
+        {
+            PERF_BLOCK( VertexBufferBase__SetPositionBounds ) ;
+
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis...
+                ASSERT( maxCorner[ axis ] >= minCorner[ axis ] ) ;
+                const float halfExtent  = 0.5f * ( maxCorner[ axis ] - minCorner[ axis ] ) ;
+                mPositionOffset[ axis ] = 0.5f * ( maxCorner[ axis ] + minCorner[ axis ] ) ;
+                mPositionScale[ axis ]  = Max2( halfExtent , FLT_MIN ) / sMaxQuantizedPosition ;
+            }
+        }
+
+
+
+
         /// Set object that declares format for vertices in this buffer.
         void    VertexBufferBase::SetVertexDeclaration( const VertexDeclaration & vertexDeclaration )
         {
@@ -113,6 +167,7 @@ namespace PeGaSys {
 
             ASSERT( ( 0 == mVertexSize ) || ( 0 == vertexSize ) ) ;    // Not allowed to change vertex size; it is determined by vertex declaration anyway.
             mVertexSize = vertexSize ;
+            TrackMemory() ;
         }
 
 
@@ -137,6 +192,21 @@ namespace PeGaSys {
 
             ASSERT( ( 0 == mCapacity ) || ( 0 == capacity ) ) ;  // Not allowed to change capacity without reallocating vertex buffer.
             mCapacity = capacity ;
+            TrackMemory() ;
+        }
+
+
+
+
+        /** Report change in memory this buffer occupies to MemoryBudget.
+
+            Platforms set capacity and vertex size in either order, so this runs after each.
+        */
+        void    VertexBufferBase::TrackMemory()
+        {
+            const size_t numBytes = mCapacity * mVertexSize ;
+            MemoryBudget::Track( MemoryBudget::SUBSYSTEM_RENDER_BUFFERS , ptrdiff_t( numBytes ) - ptrdiff_t( mTrackedBytes ) ) ;
+            mTrackedBytes = numBytes ;
         }
 
 
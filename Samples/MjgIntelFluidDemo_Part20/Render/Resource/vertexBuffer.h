@@ -7,6 +7,8 @@
 #ifndef PEGASYS_RENDER_VERTEX_BUFFER_BASE_H
 #define PEGASYS_RENDER_VERTEX_BUFFER_BASE_H
 
+#include <math.h>
+
 // Macros ----------------------------------------------------------------------
 // Types -----------------------------------------------------------------------
 
@@ -33,7 +35,9 @@ namespace PeGaSys
 
                 The combination of offset and stride allows interleaved or contiguous data.
 
-                \todo   Make use of this class.
+                \todo   Make use of this class for every format.  So far only
+                        packed formats such as POSITION_NORMAL_PACKED describe
+                        their layout with a table of these.
             */
             class VertexElement
             {
@@ -64,12 +68,17 @@ namespace PeGaSys
                     FLOAT2          ,
                     FLOAT3          ,
                     FLOAT4          ,
+                    SHORT3          ,   ///< 3 signed 16-bit integers, not normalized, e.g. position quantized against a bounding box.
+                    HALF2           ,   ///< 2 16-bit floating-point values.
+                    UBYTE4_NORM     ,   ///< 4 unsigned bytes normalized to [0,1], e.g. color.
+                    USHORT2_NORM    ,   ///< 2 unsigned 16-bit integers normalized to [0,1], e.g. texture coordinates.
+                    INT_2_10_10_10  ,   ///< 3 signed 10-bit components normalized to [-1,1], and one 2-bit component, packed into 32 bits starting from the least significant bit, e.g. normal.
                     NUM_DATA_TYPES
                 } ;
 
                 SemanticE   mSemantic   ;   /// Semantic (meaning/purpose) for this vertex element.
                 DataTypeE   mDataType   ;   /// Primitive type of data used by this vertex element.
-                size_t      mOffset     ;   /// Offset, in bytes, from start of vertex buffer to first of this kind of element.
+                size_t      mOffset     ;   /// Offset, in bytes, from start of vertex (or vertex buffer, for contiguous data) to first of this kind of element.
                 size_t      mStride     ;   /// Number of bytes between elements of this type.
             } ;
 
@@ -100,6 +109,10 @@ namespace PeGaSys
 
                 POSITION_NORMAL_COLOR_TEXTURE   ,
 
+                BILLBOARD_INSTANCE              ,   ///< One element per camera-facing quadrilateral (center, size, angle, color, texture range), which the platform expands into 4 vertices on the GPU.
+
+                POSITION_NORMAL_PACKED          ,   ///< Position quantized to 16 bits per axis within the box VertexBufferBase::SetPositionBounds sets, and normal packed into 10:10:10:2.  12 bytes per vertex, versus 24 for POSITION_NORMAL.
+
                 GENERIC                         ,
 
                 NUM_FORMATS
@@ -140,6 +153,7 @@ namespace PeGaSys
                 case POSITION_NORMAL_COLOR:
                 case POSITION_NORMAL_TEXTURE:
                 case POSITION_NORMAL_COLOR_TEXTURE:
+                case POSITION_NORMAL_PACKED:
                     return true ;
                 }
                 return false ;
@@ -155,6 +169,7 @@ namespace PeGaSys
                 case POSITION_NORMAL_COLOR:
                 case POSITION_COLOR_TEXTURE:
                 case POSITION_NORMAL_COLOR_TEXTURE:
+                case BILLBOARD_INSTANCE:
                     return true ;
                 }
                 return false ;
@@ -170,6 +185,7 @@ namespace PeGaSys
                 case POSITION_NORMAL_TEXTURE:
                 case POSITION_COLOR_TEXTURE:
                 case POSITION_NORMAL_COLOR_TEXTURE:
+                case BILLBOARD_INSTANCE:
                     return true ;
                 }
                 return false ;
@@ -259,6 +275,48 @@ namespace PeGaSys
         } ;
 
 
+        /** Return the given unit vector packed into signed normalized 10:10:10:2 (VertexElement::INT_2_10_10_10), with x in the least significant bits.
+        */
+        static inline unsigned PackNormal_10_10_10_2( float x , float y , float z )
+        {
+            const float components[ 3 ] = { x , y , z } ;
+            unsigned packed = 0 ;
+            for( int axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis...
+                float c = components[ axis ] * 511.0f ;
+                c = ( c < -511.0f ) ? -511.0f : ( ( c > 511.0f ) ? 511.0f : c ) ;
+                const int ic = static_cast< int >( ( c >= 0.0f ) ? ( c + 0.5f ) : ( c - 0.5f ) ) ;
+                packed |= ( static_cast< unsigned >( ic ) & 0x3ff ) << ( 10 * axis ) ;
+            }
+            return packed ;
+        }
+
+
+        /** Return the given value as a 16-bit floating-point number (VertexElement::HALF2).
+
+            This rounds to nearest, flushes values too small for a normalized
+            half to zero, and saturates values too large to infinity.
+        */
+        static inline unsigned short HalfFromFloat( float value )
+        {
+            union { float f ; unsigned u ; } bits ;
+            bits.f = value ;
+            const unsigned  sign        = ( bits.u >> 16 ) & 0x8000 ;
+            const int       exponent    = static_cast< int >( ( bits.u >> 23 ) & 0xff ) - 127 + 15 ;
+            const unsigned  mantissa    = bits.u & 0x007fffff ;
+            if( exponent <= 0 )
+            {   // Too small to represent as a normalized half.
+                return static_cast< unsigned short >( sign ) ;
+            }
+            if( exponent >= 31 )
+            {   // Too large to represent, or not a number.
+                return static_cast< unsigned short >( sign | 0x7c00 ) ;
+            }
+            // Rounding can carry into the exponent, which correctly yields the next power of 2.
+            return static_cast< unsigned short >( sign | ( ( static_cast< unsigned >( exponent ) << 10 ) + ( ( mantissa + 0x1000 ) >> 13 ) ) ) ;
+        }
+
+
         /** Vertex buffer base class.
 
             Each rendering platform specializes this class.
@@ -266,6 +324,16 @@ namespace PeGaSys
         class VertexBufferBase
         {
         public:
+            /** How often the contents of a vertex buffer change.
+
+                Platforms can use this to choose how to store vertex data.
+            */
+            enum UsageE
+            {
+                USAGE_STATIC    ,   ///< Contents get filled once (or rarely) and rendered many times.
+                USAGE_STREAM    ,   ///< Contents get refilled every frame, e.g. particles.
+            } ;
+
             VertexBufferBase() ;
             virtual ~VertexBufferBase() ;
 
@@ -317,6 +385,56 @@ namespace PeGaSys
             const size_t &  GetCapacity() const
             { return mCapacity ; }
 
+            void SetUsage( UsageE usage ) ;
+
+            /// Return how often the contents of this buffer change.
+            const UsageE &  GetUsage() const
+            { return mUsage ; }
+
+            void SetPositionBounds( const float minCorner[ 3 ] , const float maxCorner[ 3 ] ) ;
+
+            /// Return center of box that quantized positions span, which position 0 represents.
+            const float *   GetPositionOffset() const
+            { return mPositionOffset ; }
+
+            /// Return world-space distance, along each axis, between adjacent quantized positions.
+            const float *   GetPositionScale() const
+            { return mPositionScale ; }
+
+            /** Quantize the given world-space position against the box SetPositionBounds set.
+
+                Positions outside that box clamp to its faces.
+            */
+            void QuantizePosition( short quantized[ 3 ] , const float position[ 3 ] ) const
+            {
+                for( int axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis...
+                    float q = ( position[ axis ] - mPositionOffset[ axis ] ) / mPositionScale[ axis ] ;
+                    q = ( q < - sMaxQuantizedPosition ) ? - sMaxQuantizedPosition : ( ( q > sMaxQuantizedPosition ) ? sMaxQuantizedPosition : q ) ;
+                    quantized[ axis ] = static_cast< short >( ( q >= 0.0f ) ? ( q + 0.5f ) : ( q - 0.5f ) ) ;
+                }
+            }
+
+            /** Return the given world-space unit normal packed into 10:10:10:2, for vertices whose positions QuantizePosition quantized.
+
+                Rendering dequantizes positions by scaling the modelview matrix,
+                which transforms normals by the inverse scale.  So this scales
+                the normal first, then renormalizes, such that after OpenGL
+                normalizes the transformed normal, it points the right way
+                even if the box has different extents along each axis.
+            */
+            unsigned PackNormal( const float normal[ 3 ] ) const
+            {
+                const float sx      = normal[ 0 ] * mPositionScale[ 0 ] ;
+                const float sy      = normal[ 1 ] * mPositionScale[ 1 ] ;
+                const float sz      = normal[ 2 ] * mPositionScale[ 2 ] ;
+                const float mag2    = sx * sx + sy * sy + sz * sz ;
+                const float invMag  = ( mag2 > 0.0f ) ? 1.0f / sqrtf( mag2 ) : 0.0f ;
+                return PackNormal_10_10_10_2( sx * invMag , sy * invMag , sz * invMag ) ;
+            }
+
+            static const float sMaxQuantizedPosition ;  ///< Magnitude of quantized position at faces of the box SetPositionBounds sets.
+
         protected:
             /// Platform-specific routine to deallocate vertex buffer.
             virtual void Deallocate() = 0 ;
@@ -333,11 +451,17 @@ namespace PeGaSys
             unsigned            mTypeId             ;   ///< Type identifier, for run-time type checking
 
         private:
+            void    TrackMemory() ;
+
             GenericVertex   *   mGenericVertexData  ;   ///< Address of generic vertex data.  Mutually exclusive with any platform-specific vertex data.
             VertexDeclaration   mVertexDeclaration  ;   ///< Declaration of vertex format
             size_t              mVertexSize         ;   ///< Size, in bytes, of a single vertex -- Stride between elements in mVertexData.
             size_t              mPopulation         ;   ///< Number of vertices in buffer (i.e. actual population).
             size_t              mCapacity           ;   ///< Number of vertices this buffer can hold.
+            UsageE              mUsage              ;   ///< How often the contents of this buffer change.
+            size_t              mTrackedBytes       ;   ///< Number of bytes this buffer reported to MemoryBudget.
+            float               mPositionOffset[ 3 ];   ///< Center of box that quantized positions span.  Only POSITION_NORMAL_PACKED uses this.
+            float               mPositionScale[ 3 ] ;   ///< Distance, along each axis, between adjacent quantized positions.  Only POSITION_NORMAL_PACKED uses this.
         } ;
 
         // Public variables ------------------------------------------------------------
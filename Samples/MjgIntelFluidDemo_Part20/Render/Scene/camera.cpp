@@ -17,6 +17,32 @@
 // Private variables -----------------------------------------------------------
 // Public variables ------------------------------------------------------------
 // Private functions -----------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Return plane with the given normal that contains the given point, in the form (n,d) such that n*p+d=0 for points p on the plane.
+        */
+        static Vec4 PlaneThroughPoint( const Vec3 & normal , const Vec3 & point )
+        {
+            return Vec4( normal , - ( normal * point ) ) ;
+        }
+
+
+
+
+        /** Return plane with the given (not necessarily unit) normal that contains the given point, with unit normal.
+        */
+        static Vec4 PlaneThroughPointNormalized( const Vec3 & normal , const Vec3 & point )
+        {
+            Vec3 unitNormal( normal ) ;
+            unitNormal.Normalize() ;
+            return PlaneThroughPoint( unitNormal , point ) ;
+        }
+
+    } ;
+} ;
+
 // Public functions ------------------------------------------------------------
 
 namespace PeGaSys {
@@ -33,6 +59,7 @@ namespace PeGaSys {
 
             , mFieldOfViewVert( 90.0f )
             , mAspectRatio( 1.33f )
+            , mViewportHeight( 480.0f )
             , mNearClipDist( 1.0f )
             , mFarClipDist( 1000.0f )
             //, mProjection( Mat4_xIdentity )
@@ -42,14 +69,14 @@ namespace PeGaSys {
             // Move camera away from default look-at point.
             SetPosition( Vec4( 2.0f , 0.0f , 0.0f , 1.0f ) ) ;
 
-            // TODO: Implement culling frustum.
-            //for( size_t idx = 0 ; idx < NUM_FRUSTUM_PLANES ; ++ idx )
-            //{
-            //    mFrustum[ idx ].x =
-            //    mFrustum[ idx ].y =
-            //    mFrustum[ idx ].z =
-            //    mFrustum[ idx ].w = 0.0f ;
-            //}
+            // Degenerate planes contain everything, so until UpdateFrustum runs, nothing gets culled.
+            for( size_t idx = 0 ; idx < NUM_FRUSTUM_PLANES ; ++ idx )
+            {
+                mFrustum[ idx ].x =
+                mFrustum[ idx ].y =
+                mFrustum[ idx ].z =
+                mFrustum[ idx ].w = 0.0f ;
+            }
         }
 
 
@@ -136,6 +163,68 @@ namespace PeGaSys {
 
 
 
+        /** Compute planes of the view frustum from current view and projection parameters.
+
+            Camera::RenderScene calls this, so visitors can cull scene nodes
+            with IsBoxInFrustum.  This follows the same conventions that
+            render APIs use to set the view and projection, i.e. look from eye
+            toward look-at with approximate up direction, with a vertical field
+            of view and aspect ratio of width to height.
+        */
+        void Camera::UpdateFrustum()
+        {
+            PERF_BLOCK( Camera__UpdateFrustum ) ;
+
+            const Vec3 &    eye     = GetEye() ;
+            Vec3            forward = GetLookAt() - eye ;
+            forward.Normalize() ;
+            Vec3            right   = forward ^ GetUpApproximate() ;
+            right.Normalize() ;
+            const Vec3      up      = right ^ forward ;
+
+            const float tanHalfFovVert = tanf( 0.5f * mFieldOfViewVert * DEG2RAD ) ;
+            const float tanHalfFovHorz = tanHalfFovVert * mAspectRatio ;
+
+            mFrustum[ FRUSTUM_PLANE_NEAR    ] = PlaneThroughPoint(   forward , eye + forward * mNearClipDist ) ;
+            mFrustum[ FRUSTUM_PLANE_FAR     ] = PlaneThroughPoint( - forward , eye + forward * mFarClipDist  ) ;
+
+            // Side planes contain the eye.  Each normal points inward, perpendicular to the edge of the field of view it bounds.
+            mFrustum[ FRUSTUM_PLANE_LEFT    ] = PlaneThroughPointNormalized(   right + forward * tanHalfFovHorz , eye ) ;
+            mFrustum[ FRUSTUM_PLANE_RIGHT   ] = PlaneThroughPointNormalized( - right + forward * tanHalfFovHorz , eye ) ;
+            mFrustum[ FRUSTUM_PLANE_BOTTOM  ] = PlaneThroughPointNormalized(   up    + forward * tanHalfFovVert , eye ) ;
+            mFrustum[ FRUSTUM_PLANE_TOP     ] = PlaneThroughPointNormalized( - up    + forward * tanHalfFovVert , eye ) ;
+        }
+
+
+
+
+        /** Return whether the given world-space axis-aligned box could intersect the view frustum.
+
+            This tests, for each plane, the box corner farthest along the plane normal.
+            If that corner lies outside any plane, the whole box does.  This
+            can report a box near a frustum edge as inside when it is not,
+            which costs only a draw call, but never reports a visible box as
+            outside.
+        */
+        bool Camera::IsBoxInFrustum( const Vec3 & minCorner , const Vec3 & maxCorner ) const
+        {
+            for( size_t idx = 0 ; idx < NUM_FRUSTUM_PLANES ; ++ idx )
+            {   // For each frustum plane...
+                const Vec4 & plane = mFrustum[ idx ] ;
+                const Vec3   farthestCorner(    ( plane.x >= 0.0f ) ? maxCorner.x : minCorner.x
+                                            ,   ( plane.y >= 0.0f ) ? maxCorner.y : minCorner.y
+                                            ,   ( plane.z >= 0.0f ) ? maxCorner.z : minCorner.z ) ;
+                if( plane.x * farthestCorner.x + plane.y * farthestCorner.y + plane.z * farthestCorner.z + plane.w < 0.0f )
+                {   // Box lies entirely outside this plane.
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+
+
+
         /** Render a camera.
 
             Normally, rendering a camera does nothing, but for diagnosing a scene it
@@ -161,6 +250,7 @@ namespace PeGaSys {
         {
             PERF_BLOCK( Camera__RenderScene ) ;
 
+            UpdateFrustum() ;
             GetSceneManager()->RenderScene( * this , currentVirtualTimeInSeconds ) ;
         }
 
@@ -62,6 +62,12 @@ namespace PeGaSys
                 /// Return Ratio of width to height.
                 const float &   GetAspectRatio() const              { return mAspectRatio ; }
 
+                /// Set height, in pixels, of viewport this camera renders into.  Like SetAspectRatio, the Viewport sets this just prior to calling RenderScene.
+                void            SetViewportHeight( float viewportHeight ) { mViewportHeight = viewportHeight ; }
+
+                /// Return height, in pixels, of viewport this camera renders into, which lets renderers estimate how many pixels geometry covers.
+                const float &   GetViewportHeight() const           { return mViewportHeight ; }
+
                 /// Return World-space distance to near clip plane.
                 const float &   GetNearClipDist() const             { return mNearClipDist ; }
 
@@ -78,9 +84,23 @@ namespace PeGaSys
                 /// Set camera position in spherical coordinates, relative to target.
                 void SetOrbit( float azimuth , float elevation , float radius ) ;
 
+                void            UpdateFrustum() ;
+                bool            IsBoxInFrustum( const Vec3 & minCorner , const Vec3 & maxCorner ) const ;
+
             private:
                 static const size_t NUM_FRUSTUM_PLANES = 6 ;
 
+                /// Indices into mFrustum.
+                enum FrustumPlaneE
+                {
+                    FRUSTUM_PLANE_NEAR      ,
+                    FRUSTUM_PLANE_FAR       ,
+                    FRUSTUM_PLANE_LEFT      ,
+                    FRUSTUM_PLANE_RIGHT     ,
+                    FRUSTUM_PLANE_BOTTOM    ,
+                    FRUSTUM_PLANE_TOP       ,
+                } ;
+
                 // View transformation parameters
                 Vec4                mLookAt                         ;   ///< World-space position at which this camera looks
                 Vec4                mUpApproximate                  ;   ///< World-space approximate direction toward which this camera top points
@@ -89,11 +109,12 @@ namespace PeGaSys
                 // Projection transformation parameters
                 float               mFieldOfViewVert                ;   ///< Field of view angle (in degrees) along vertical direction
                 float               mAspectRatio                    ;   ///< Aspect ratio (height to width)
+                float               mViewportHeight                 ;   ///< Height, in pixels, of viewport this camera renders into
                 float               mNearClipDist                   ;   ///< World-space distance to near clip plane
                 float               mFarClipDist                    ;   ///< World-space distance to far clip plane
                 //Mat44                mProjection                     ;   ///< Projection matrix cache
 
-                //Vec4                mFrustum[ NUM_FRUSTUM_PLANES ]  ;   ///< Culling frustum planes. TODO: Implement culling frustum.
+                Vec4                mFrustum[ NUM_FRUSTUM_PLANES ]  ;   ///< Culling frustum planes, each (n,d) with world-space inward normal n, so points p inside satisfy n*p+d>=0.  Assigned by UpdateFrustum.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -8,6 +8,7 @@
 #include "Render/Scene/model.h"
 
 #include "Render/Device/api.h"
+#include "Render/Device/gpuTimer.h"
 #include "Render/Resource/mesh.h"
 #include "Render/Scene/iSceneManager.h"
 #include "Render/Scene/modelData.h"
@@ -32,6 +33,7 @@ namespace PeGaSys {
         ModelNode::ModelNode( ISceneManager * sceneManager )
             : SceneNodeBase( sceneManager , sTypeId )
             , mNumLights( 0 )
+            , mGpuPassLabel( NULLPTR )
         {
             PERF_BLOCK( ModelNode__ModelNode ) ;
 
@@ -69,7 +71,12 @@ namespace PeGaSys {
 
             renderApi->SetLocalToWorld( GetLocalToWorld() ) ;
 
-            mModelData->Render( renderApi ) ;
+            {
+            #if PROFILE
+                ScopedGpuPass gpuPass( mGpuPassLabel ? renderApi->GetGpuTimer() : NULLPTR , mGpuPassLabel ) ;
+            #endif
+                mModelData->Render( renderApi ) ;
+            }
 
             // TODO: Render diagnostic text at this location (0,0,0)
 
@@ -79,6 +86,63 @@ namespace PeGaSys {
 
 
 
+        /** Add draw items for this model to the given queue, instead of rendering immediately.
+
+            Unlike Render, this does not render children, so callers should only use
+            this for models without children.
+        */
+        void ModelNode::EnqueueDrawItems( RenderQueue & renderQueue )
+        {
+            PERF_BLOCK( ModelNode__EnqueueDrawItems ) ;
+
+            ASSERT( ! HasChildren() ) ;
+
+            SetLocalToWorld() ;
+
+            mModelData->EnqueueDrawItems( renderQueue , this ) ;
+        }
+
+
+
+
+        /** Update local bounds of this model to contain the bounding boxes of all its meshes.
+
+            If any mesh lacks a bounding box, this model could render anywhere.
+        */
+        /* virtual */ void ModelNode::UpdateLocalBounds()
+        {
+            PERF_BLOCK( ModelNode__UpdateLocalBounds ) ;
+
+            const size_t numMeshes = mModelData ? mModelData->GetNumMeshes() : 0 ;
+            if( 0 == numMeshes )
+            {   // Model has nothing to render.
+                SetLocalBounds( BOUNDS_EMPTY ) ;
+                return ;
+            }
+
+            Vec3 minCorner( FLT_MAX , FLT_MAX , FLT_MAX ) ;
+            Vec3 maxCorner( - minCorner ) ;
+            for( size_t meshIndex = 0 ; meshIndex < numMeshes ; ++ meshIndex )
+            {   // For each mesh in this model...
+                const MeshBase * mesh = mModelData->GetMesh( meshIndex ) ;
+                if( ! mesh->HasBoundingBox() )
+                {   // Mesh could have vertices anywhere.
+                    SetLocalBounds( BOUNDS_INFINITE ) ;
+                    return ;
+                }
+                minCorner.x = Min2( minCorner.x , mesh->GetMinCorner().x ) ;
+                minCorner.y = Min2( minCorner.y , mesh->GetMinCorner().y ) ;
+                minCorner.z = Min2( minCorner.z , mesh->GetMinCorner().z ) ;
+                maxCorner.x = Max2( maxCorner.x , mesh->GetMaxCorner().x ) ;
+                maxCorner.y = Max2( maxCorner.y , mesh->GetMaxCorner().y ) ;
+                maxCorner.z = Max2( maxCorner.z , mesh->GetMaxCorner().z ) ;
+            }
+            SetLocalBoundingBox( minCorner , maxCorner ) ;
+        }
+
+
+
+
         /** Assign a ModelData object to this ModelNode.  This implies the ModelData object is shared across ModelNodes.
 
             \seealso NewModelNode
@@ -25,8 +25,9 @@ namespace PeGaSys
     namespace Render
     {
         // Forward declarations
-        class MeshBase  ;
-        class Light     ;
+        class MeshBase      ;
+        class Light         ;
+        class RenderQueue   ;
 
         /** Scene node representing a model.
 
@@ -44,6 +45,8 @@ namespace PeGaSys
 
                 virtual void Render() ;
 
+                void         EnqueueDrawItems( RenderQueue & renderQueue ) ;
+
                 ModelData *         NewModelData() ;
 
                 void                SetModelData( ModelData * modelData ) ;
@@ -67,12 +70,28 @@ namespace PeGaSys
                     return mLightsCache[ idx ] ;
                 }
 
+                /** Set name of GPU pass in which to render this model, or NULL to render it along with other models.
+
+                    \param gpuPassLabel    Name of pass.  Must persist for the process lifetime, as string literals do.
+
+                    A labeled model renders in a pass of its own, which GpuTimerBase measures separately,
+                    at the cost of not sorting its draw items together with those of other models.
+                */
+                void                SetGpuPassLabel( const char * gpuPassLabel ) { mGpuPassLabel = gpuPassLabel ; }
+
+                /// Return name of GPU pass in which to render this model, or NULL if it has none.
+                const char *        GetGpuPassLabel() const { return mGpuPassLabel ; }
+
+            protected:
+                virtual void        UpdateLocalBounds() ;
+
             PRIVATE:
                 typedef IntrusivePtr< ModelData > ModelDataPtr ;    ///< Smart pointer to reference-counted ModelData object.
 
                 ModelDataPtr    mModelData                               ;  ///< Sharable model data such as meshes.
                 const Light *   mLightsCache[ MAX_NUM_LIGHTS_PER_MODEL ] ;  ///< Cache of lights that apply to this model
                 unsigned        mNumLights                               ;  ///< Number of lights in mLightsCache.
+                const char *    mGpuPassLabel                            ;  ///< Name of GPU pass in which to render this model, or NULL.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -15,6 +15,7 @@
 #include "Render/Resource/mesh.h"
 
 #include "Render/Scene/iSceneManager.h"
+#include "Render/Scene/renderQueue.h"
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -97,6 +98,43 @@ namespace PeGaSys {
 
 
 
+        /** Add a draw item to the given queue for each active pass of each mesh in this model.
+
+            \param modelNode    Model that places these meshes in the world.
+
+            This is the deferred counterpart of Render.
+        */
+        void ModelData::EnqueueDrawItems( RenderQueue & renderQueue , const ModelNode * modelNode )
+        {
+            PERF_BLOCK( ModelData__EnqueueDrawItems ) ;
+
+            for( MeshIteratorT iter = mMeshes.Begin() ;
+                iter != mMeshes.End() ;
+                ++ iter )
+            {   // For each mesh in this model...
+                const MeshBasePtr & mesh = * iter ;
+                const Technique * technique = mesh->GetTechnique() ;
+                ASSERT( technique ) ;
+                if( technique )
+                {   // Mesh has a render technique.
+                    const Technique::PassContainer &    passes      = technique->GetPasses() ;
+                    ASSERT( ! passes.Empty() ) ;
+                    const Technique::PassConstIterator  endPass     = passes.End() ;
+                    for( Technique::PassConstIterator iPass = passes.Begin() ; iPass != endPass ; ++ iPass )
+                    {   // For each pass in this technique...
+                        const Pass * pass = * iPass ;
+                        if( pass->IsActive() )
+                        {
+                            renderQueue.Add( modelNode , mesh.Get() , pass ) ;
+                        }
+                    }
+                }
+            }
+        }
+
+
+
+
         /** Reserve entries for the given number of meshes.
         */
         void ModelData::ReserveMeshes( size_t /*numMeshes*/ )
@@ -10,6 +10,7 @@
 
 #include <Core/Containers/slist.h>
 #include <Core/Containers/intrusivePtr.h>
+#include <Core/Memory/poolAllocator.h>
 
 #include "Render/Scene/modelData.h"
 
@@ -26,8 +27,10 @@ namespace PeGaSys
     namespace Render
     {
         // Forward declarations.
-        class ApiBase  ;
-        class MeshBase ;
+        class ApiBase       ;
+        class MeshBase      ;
+        class ModelNode     ;
+        class RenderQueue   ;
 
         /** Sharable data for a model.
 
@@ -41,6 +44,8 @@ namespace PeGaSys
         class ModelData : public RefCountedMixin
         {
             public:
+                POOLED_ALLOCATION   // Render resources come from pools, so resetting a scene reuses their memory.
+
                 typedef IntrusivePtr< MeshBase >    MeshBasePtr     ;
                 typedef SLIST< MeshBasePtr >        MeshContainerT  ;
                 typedef MeshContainerT::Iterator    MeshIteratorT   ;
@@ -52,6 +57,7 @@ namespace PeGaSys
                 size_t      GetNumMeshes() const ;
                 MeshBase *  GetMesh( size_t index ) ;
                 void        Render( ApiBase * renderApi ) ;
+                void        EnqueueDrawItems( RenderQueue & renderQueue , const ModelNode * modelNode ) ;
 
                 void ReleaseReference() ; // Used by IntrusivePtr (indirectly, through global ReleaseReference)
 
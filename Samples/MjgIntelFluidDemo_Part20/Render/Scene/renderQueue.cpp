@@ -0,0 +1,299 @@
+/** \file renderQueue.cpp
+
+    \brief Queue of draw items, sorted to reduce render state changes.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+
+#include "Render/Scene/renderQueue.h"
+
+#include "Render/Device/api.h"
+#include "Render/Resource/mesh.h"
+#include "Render/Resource/pass.h"
+#include "Render/Scene/model.h"
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+#include <Core/Memory/newWrapper.h>
+#include <Core/File/debugPrint.h>
+#include <Core/Math/math.h>
+#include <Core/parallelExecution.h>
+
+#include <algorithm>
+
+// Types -----------------------------------------------------------------------
+// Private variables -----------------------------------------------------------
+// Public variables ------------------------------------------------------------
+// Private functions -----------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Return whether the given models use the same lights, so that setting lights for one also sets them for the other.
+        */
+        static bool HaveSameLights( const ModelNode & modelA , const ModelNode & modelB )
+        {
+            if( modelA.GetNumLights() != modelB.GetNumLights() )
+            {
+                return false ;
+            }
+            for( unsigned idx = 0 ; idx < modelA.GetNumLights() ; ++ idx )
+            {   // For each light cached for the models...
+                if( modelA.GetLight( idx ) != modelB.GetLight( idx ) )
+                {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+    } ;
+} ;
+
+
+
+
+// Public functions ------------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Construct queue of draw items.
+        */
+        RenderQueue::RenderQueue()
+        {
+            PERF_BLOCK( RenderQueue__RenderQueue ) ;
+        }
+
+
+
+
+        /** Destruct queue of draw items.
+        */
+        RenderQueue::~RenderQueue()
+        {
+            PERF_BLOCK( RenderQueue__dtor ) ;
+        }
+
+
+
+
+        /** Add a draw item to this queue.
+
+            \param modelNode    Model that places the mesh in the world.  Caller must have already assigned its local-to-world transform.
+
+            \param mesh         Geometry to draw.
+
+            \param pass         Render state and textures with which to draw mesh.
+
+            Objects must remain valid until the next call to Flush.
+        */
+        void RenderQueue::Add( const ModelNode * modelNode , MeshBase * mesh , const Pass * pass )
+        {
+            PERF_BLOCK( RenderQueue__Add ) ;
+
+            ASSERT( modelNode && mesh && pass ) ;
+
+            DrawItem drawItem ;
+            drawItem.mModelNode         = modelNode ;
+            drawItem.mMesh              = mesh ;
+            drawItem.mPass              = pass ;
+            drawItem.mStateIndex        = StateIndex( pass ) ;
+            drawItem.mOrderDependent    = pass->IsOrderDependent() ;
+            mDrawItems.PushBack( drawItem ) ;
+        }
+
+
+
+
+        /** Return index into mDistinctPasses of the first pass equivalent to the given one, adding it if there is none.
+
+            The number of distinct passes in a scene is typically small compared to the number of draw items,
+            so a linear search suffices.
+        */
+        unsigned RenderQueue::StateIndex( const Pass * pass )
+        {
+            PERF_BLOCK( RenderQueue__StateIndex ) ;
+
+            const size_t numDistinctPasses = mDistinctPasses.Size() ;
+            for( size_t idx = 0 ; idx < numDistinctPasses ; ++ idx )
+            {   // For each distinct pass encountered so far...
+                if( pass->IsEquivalentTo( * mDistinctPasses[ idx ] ) )
+                {   // Found equivalent pass.
+                    return static_cast< unsigned >( idx ) ;
+                }
+            }
+            mDistinctPasses.PushBack( pass ) ;
+            return static_cast< unsigned >( numDistinctPasses ) ;
+        }
+
+
+
+
+        /** Render a draw item, changing only the state that differs from that of the previous one.
+
+            \param previousDrawItem Draw item rendered immediately before this one, or NULL if this is the first since setting the camera.
+        */
+        void RenderQueue::RenderDrawItem( ApiBase * renderApi , const DrawItem & drawItem , const DrawItem * previousDrawItem )
+        {
+            PERF_BLOCK( RenderQueue__RenderDrawItem ) ;
+
+            const ModelNode & modelNode = * drawItem.mModelNode ;
+
+            if( ( NULLPTR == previousDrawItem ) || ( previousDrawItem->mModelNode != & modelNode ) )
+            {   // This item has a different model than the previous one.
+                renderApi->ResetLocalToWorld() ;
+
+                if( ( NULLPTR == previousDrawItem ) || ! HaveSameLights( * previousDrawItem->mModelNode , modelNode ) )
+                {   // This model has different lights than the previous model.
+                    // In OpenGL, lights are transformed by current MODELVIEW matrix but light node is in world space so must set lights while MODELVIEW has only the view transform.
+                    renderApi->SetLights( modelNode ) ;
+                }
+
+                renderApi->SetLocalToWorld( modelNode.GetLocalToWorld() ) ;
+            }
+
+            if( ( NULLPTR == previousDrawItem ) || ! drawItem.mPass->IsEquivalentTo( * previousDrawItem->mPass ) )
+            {   // This item has a different pass than the previous one.
+                drawItem.mPass->Apply( renderApi ) ;
+            }
+
+            drawItem.mMesh->Render() ;
+        }
+
+
+
+
+        /** Render consecutive draw items, skipping state changes that would repeat the previous ones.
+
+            The first item sets all of its state, so this can render any contiguous subset of a sorted queue.
+        */
+        /* static */ void RenderQueue::RenderDrawItems( ApiBase * renderApi , const DrawItem * drawItems , size_t numDrawItems )
+        {
+            PERF_BLOCK( RenderQueue__RenderDrawItems ) ;
+
+            const DrawItem * previousDrawItem = NULLPTR ;
+            for( size_t idx = 0 ; idx < numDrawItems ; ++ idx )
+            {   // For each draw item...
+                const DrawItem & drawItem = drawItems[ idx ] ;
+                RenderDrawItem( renderApi , drawItem , previousDrawItem ) ;
+                previousDrawItem = & drawItem ;
+            }
+        }
+
+
+
+
+#if RENDER_QUEUE_PARALLEL_RECORDING
+        /** Record draw items in the given number of consecutive chunks, on worker threads, then submit them in order.
+
+            Each chunk starts without a previous draw item, so it sets the camera, lights,
+            transform and pass of its first item, which costs a few redundant state changes
+            per chunk compared to rendering serially.
+        */
+        void RenderQueue::RecordInParallel( ApiBase * renderApi , const Camera & camera , unsigned numChunks ) const
+        {
+            PERF_BLOCK( RenderQueue__RecordInParallel ) ;
+
+            ASSERT( ( numChunks > 1 ) && ( numChunks <= renderApi->GetNumCommandRecorders() ) ) ;
+
+            Parallel::For( 0 , numChunks , 1 , Parallel::Method( this , & RenderQueue::RecordChunks , renderApi , camera , numChunks ) ) ;
+
+            renderApi->SubmitCommandRecordings( numChunks ) ;
+        }
+
+
+
+
+        /** Record the given range of chunks of draw items, each into its own command recorder.
+
+            \param numChunks    Number of chunks into which RecordInParallel split all draw items.
+        */
+        void RenderQueue::RecordChunks( ApiBase * renderApi , const Camera & camera , unsigned numChunks , size_t iChunkBegin , size_t iChunkEnd ) const
+        {
+            const size_t numDrawItems = mDrawItems.Size() ;
+            for( size_t iChunk = iChunkBegin ; iChunk < iChunkEnd ; ++ iChunk )
+            {   // For each chunk in this range...
+                const size_t itemBegin = iChunk         * numDrawItems / numChunks ;
+                const size_t itemEnd   = ( iChunk + 1 ) * numDrawItems / numChunks ;
+                renderApi->BeginCommandRecording( static_cast< unsigned >( iChunk ) ) ;
+                renderApi->SetCamera( camera ) ;  // Each recorder starts with default state.
+                RenderDrawItems( renderApi , & mDrawItems[ itemBegin ] , itemEnd - itemBegin ) ;
+                renderApi->EndCommandRecording( static_cast< unsigned >( iChunk ) ) ;
+            }
+        }
+#endif
+
+
+
+
+        /** Render and remove every draw item in this queue.
+
+            This sorts each run of order-independent draw items by state, then renders
+            all draw items, skipping state changes that would repeat the previous ones.
+            If the render API has command recorders and the queue is large enough, this
+            records chunks of the queue on worker threads instead, then submits them.
+        */
+        void RenderQueue::Flush( ApiBase * renderApi , const Camera & camera )
+        {
+            PERF_BLOCK( RenderQueue__Flush ) ;
+
+            if( mDrawItems.Empty() )
+            {
+                return ;
+            }
+
+            {   // Sort each run of order-independent draw items.
+                PERF_BLOCK( RenderQueue__Flush_Sort ) ;
+
+                VECTOR< DrawItem >::iterator runBegin = mDrawItems.Begin() ;
+                for( VECTOR< DrawItem >::iterator iter = mDrawItems.Begin() ; iter != mDrawItems.End() ; ++ iter )
+                {   // For each draw item...
+                    if( iter->mOrderDependent )
+                    {   // Draw item must stay in place, so it ends a run.
+                        // Stable sort keeps scene order among equivalent passes, so rendering is deterministic.
+                        std::stable_sort( runBegin , iter ) ;
+                        runBegin = iter + 1 ;
+                    }
+                }
+                std::stable_sort( runBegin , mDrawItems.End() ) ;
+            }
+
+        #if RENDER_QUEUE_PARALLEL_RECORDING
+            const size_t numChunksWorthwhile = Min2( mDrawItems.Size() / sMinDrawItemsPerChunk , size_t( Parallel::GetNumThreads() ) ) ;
+            const unsigned numChunks = static_cast< unsigned >( Min2( numChunksWorthwhile , size_t( renderApi->GetNumCommandRecorders() ) ) ) ;
+            if( numChunks > 1 )
+            {   // API can record on multiple threads, and queue has enough draw items to make that worthwhile.
+                RecordInParallel( renderApi , camera , numChunks ) ;
+            }
+            else
+        #endif
+            {
+                renderApi->SetCamera( camera ) ;
+                RenderDrawItems( renderApi , & mDrawItems[ 0 ] , mDrawItems.Size() ) ;
+            }
+
+            mDrawItems.Clear() ;
+            mDistinctPasses.Clear() ;
+        }
+
+
+
+
+#if defined( _DEBUG )
+
+        void PeGaSys_Render_RenderQueue_UnitTest( void )
+        {
+            DebugPrintf( "RenderQueue::UnitTest ----------------------------------------------\n" ) ;
+
+            {
+                RenderQueue renderQueue ;
+                ASSERT( renderQueue.Empty() ) ;
+            }
+
+            DebugPrintf( "RenderQueue::UnitTest: THE END ----------------------------------------------\n" ) ;
+        }
+#endif
+
+    } ;
+} ;
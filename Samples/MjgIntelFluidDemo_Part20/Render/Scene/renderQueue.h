@@ -0,0 +1,110 @@
+/** \file renderQueue.h
+
+    \brief Queue of draw items, sorted to reduce render state changes.
+
+    \author Written and Copyright 2010-2016 MJG; All rights reserved.
+*/
+#ifndef PEGASYS_RENDER_RENDER_QUEUE_H
+#define PEGASYS_RENDER_RENDER_QUEUE_H
+
+#include "Core/Containers/vector.h"
+
+// Macros ----------------------------------------------------------------------
+
+/** Whether RenderQueue::Flush records draw items on multiple threads, when the render API supports that.
+
+    Flush splits the sorted queue into consecutive chunks, records each chunk
+    into its own command recorder (see ApiBase::GetNumCommandRecorders) on a
+    worker thread, then submits the recordings, in order, from the calling
+    thread.  That moves the CPU cost of applying passes, setting lights and
+    transforms and issuing draw calls off the render thread.
+
+    APIs without command recorders (e.g. OpenGL) render the queue serially either way.
+*/
+#define RENDER_QUEUE_PARALLEL_RECORDING 1
+
+// Types -----------------------------------------------------------------------
+
+namespace PeGaSys
+{
+    namespace Render
+    {
+        // Forward declarations
+        class ApiBase   ;
+        class Camera    ;
+        class MeshBase  ;
+        class ModelNode ;
+        class Pass      ;
+
+        /** Queue of draw items, sorted to reduce render state changes.
+
+            Each draw item is a <model, mesh, pass> tuple.  Instead of rendering
+            each model as a scene visitor reaches it, the scene manager adds the
+            draw items of each model to this queue, then flushes the queue.
+
+            Flush sorts draw items so that items whose passes are equivalent
+            (see Pass::IsEquivalentTo) render consecutively, then renders them,
+            applying a pass only when it differs from the previous one, setting
+            lights only when they differ from those of the previous model, and
+            setting the camera once for the whole queue.  Consecutive items that
+            share a pass therefore render as a batch of draw calls without
+            intervening state changes.
+
+            Draw items whose passes are order-dependent (see Pass::IsOrderDependent)
+            keep their position in the queue; Flush only reorders items between them.
+
+            When the render API has command recorders, Flush records consecutive
+            chunks of the sorted queue on worker threads, then submits them in
+            order.  See RENDER_QUEUE_PARALLEL_RECORDING.
+        */
+        class RenderQueue
+        {
+            public:
+                RenderQueue() ;
+                ~RenderQueue() ;
+
+                void Add( const ModelNode * modelNode , MeshBase * mesh , const Pass * pass ) ;
+                void Flush( ApiBase * renderApi , const Camera & camera ) ;
+
+                /// Return whether this queue has no draw items.
+                bool Empty() const { return mDrawItems.Empty() ; }
+
+            private:
+                /** Draw item: a mesh to render with a pass, placed by a model.
+                */
+                struct DrawItem
+                {
+                    const ModelNode *   mModelNode      ;   ///< Model that places mesh in world.  Provides local-to-world transform and lights.
+                    MeshBase *          mMesh           ;   ///< Geometry to draw.
+                    const Pass *        mPass           ;   ///< Render state and textures with which to draw mesh.
+                    unsigned            mStateIndex     ;   ///< Index into mDistinctPasses of first pass equivalent to mPass.  Sort key.
+                    bool                mOrderDependent ;   ///< Whether mPass is order-dependent, so this item must not move relative to others.
+
+                    /// Order draw items by state, so that equivalent passes render consecutively.
+                    bool operator<( const DrawItem & that ) const { return mStateIndex < that.mStateIndex ; }
+                } ;
+
+                /// Minimum number of draw items per chunk, below which recording in parallel costs more than it saves.
+                static const size_t sMinDrawItemsPerChunk = 32 ;
+
+                unsigned    StateIndex( const Pass * pass ) ;
+                void        RecordInParallel( ApiBase * renderApi , const Camera & camera , unsigned numChunks ) const ;
+                void        RecordChunks( ApiBase * renderApi , const Camera & camera , unsigned numChunks , size_t iChunkBegin , size_t iChunkEnd ) const ;
+
+                static void RenderDrawItem( ApiBase * renderApi , const DrawItem & drawItem , const DrawItem * previousDrawItem ) ;
+                static void RenderDrawItems( ApiBase * renderApi , const DrawItem * drawItems , size_t numDrawItems ) ;
+
+                RenderQueue( const RenderQueue & ) ;                // Disallow copy
+                RenderQueue & operator=( const RenderQueue & ) ;    // Disallow assignment
+
+                VECTOR< DrawItem >      mDrawItems      ;   ///< Draw items to render, in scene order until Flush sorts them.
+                VECTOR< const Pass * >  mDistinctPasses ;   ///< One representative of each set of equivalent passes in mDrawItems.
+        } ;
+
+// Public variables ------------------------------------------------------------
+// Public functions ------------------------------------------------------------
+
+    } ;
+} ;
+
+#endif
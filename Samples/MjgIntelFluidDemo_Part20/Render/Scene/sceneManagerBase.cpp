@@ -7,9 +7,11 @@
 
 #include "Render/Scene/sceneManagerBase.h"
 
+#include "Render/Scene/camera.h"
 #include "Render/Scene/light.h"
 #include "Render/Scene/model.h"
 #include "Render/Device/api.h"
+#include "Render/Device/gpuTimer.h"
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -139,27 +141,133 @@ namespace PeGaSys {
         class RenderSceneVisitor : public ISceneNode::IVisitor
         {
         public:
+            explicit RenderSceneVisitor( const Camera & camera )
+                : mCamera( camera )
+            {
+            }
+
             void operator()( ISceneNode & sceneNode )
             {
                 PERF_BLOCK( RenderSceneVisitor__invoke ) ;
 
-                sceneNode.Render() ;
+                if( static_cast< SceneNodeBase & >( sceneNode ).IsVisibleTo( mCamera ) )
+                {   // Node could be visible.
+                    sceneNode.Render() ;
+                }
             }
+
+        private:
+            RenderSceneVisitor & operator=( const RenderSceneVisitor & ) ; ///< Disallow assignment.
+
+            const Camera &  mCamera ;   ///< Camera against whose frustum to cull nodes.
         } ;
 
 
 
 
+#if RENDER_SORT_DRAW_ITEMS
+        /** Render and remove every draw item in the given queue, measuring it as one GPU pass.
+        */
+        static void FlushRenderQueue( RenderQueue & renderQueue , ApiBase * renderApi , const Camera & camera )
+        {
+            if( renderQueue.Empty() )
+            {   // Omit empty pass.
+                return ;
+            }
+            RENDER_GPU_PASS( renderApi->GetGpuTimer() , RenderQueue ) ;
+            renderQueue.Flush( renderApi , camera ) ;
+        }
+
+
+
+
+        /** Functor to add draw items of each model to a render queue.
+
+            Models without children go into the queue.  Other nodes, such as particle
+            systems, render themselves as usual, so this first flushes the queue to
+            render models visited before them, preserving scene order between them.
+
+            Models with a GPU pass label also render immediately, in a queue of
+            their own, so GpuTimerBase measures them separately.
+        */
+        class RenderQueueVisitor : public ISceneNode::IVisitor
+        {
+        public:
+            RenderQueueVisitor( RenderQueue & renderQueue , ApiBase * renderApi , const Camera & camera )
+                : mRenderQueue( renderQueue )
+                , mRenderApi( renderApi )
+                , mCamera( camera )
+            {
+                PERF_BLOCK( RenderQueueVisitor__RenderQueueVisitor ) ;
+            }
+
+            void operator()( ISceneNode & sceneNode )
+            {
+                PERF_BLOCK( RenderQueueVisitor__invoke ) ;
+
+                SceneNodeBase & snb = static_cast< SceneNodeBase & >( sceneNode ) ;
+                if( ! snb.IsVisibleTo( mCamera ) )
+                {   // Node and its descendants lie outside view frustum.
+                    return ;
+                }
+                if( ( snb.GetTypeId() == ModelNode::sTypeId ) && ! snb.HasChildren() )
+                {   // This node is a model without children, so its draw items can be reordered.
+                    ModelNode & mn = static_cast< ModelNode & >( snb ) ;
+                    if( mn.GetGpuPassLabel() )
+                    {   // Model renders in a GPU pass of its own.
+                        FlushRenderQueue( mRenderQueue , mRenderApi , mCamera ) ;
+                    #if PROFILE
+                        ScopedGpuPass gpuPass( mRenderApi->GetGpuTimer() , mn.GetGpuPassLabel() ) ;
+                    #endif
+                        mn.EnqueueDrawItems( mRenderQueue ) ;
+                        mRenderQueue.Flush( mRenderApi , mCamera ) ;
+                    }
+                    else
+                    {
+                        mn.EnqueueDrawItems( mRenderQueue ) ;
+                    }
+                }
+                else
+                {   // This node renders itself.
+                    FlushRenderQueue( mRenderQueue , mRenderApi , mCamera ) ;
+                    sceneNode.Render() ;
+                }
+            }
+
+        private:
+            RenderQueueVisitor & operator=( const RenderQueueVisitor & ) ; ///< Disallow assignment.
+
+            RenderQueue &   mRenderQueue    ;   ///< Queue to which to add draw items.
+            ApiBase *       mRenderApi      ;   ///< Low-level render system device with which to flush queue.
+            const Camera &  mCamera         ;   ///< Camera with which to flush queue.
+        } ;
+#endif
+
+
+
+
         /** Render a scene with the given camera.
+
+            The GPU timer of the render API measures the whole scene as one pass,
+            and within it, each flush of the render queue, each model with a GPU
+            pass label, and any pass that self-rendering nodes measure.
         */
         void SceneManagerBase::RenderScene( const Camera & camera , const double & currentVirtualTimeInSeconds )
         {
             PERF_BLOCK( SceneManagerBase__RenderScene ) ;
+            RENDER_GPU_PASS( mApi ? mApi->GetGpuTimer() : NULLPTR , RenderScene ) ;  // Unit test renders without an API.
 
             mCurrentCamera = & camera ;
             CompileLights() ;
-            RenderSceneVisitor renderSceneVisitor ;
+            mRootSceneNode.UpdateWorldBounds() ;
+#if RENDER_SORT_DRAW_ITEMS
+            RenderQueueVisitor renderQueueVisitor( mRenderQueue , mApi , camera ) ;
+            mRootSceneNode.Visit( & renderQueueVisitor ) ;
+            FlushRenderQueue( mRenderQueue , mApi , camera ) ;
+#else
+            RenderSceneVisitor renderSceneVisitor( camera ) ;
             mRootSceneNode.Visit( & renderSceneVisitor ) ;
+#endif
             mCurrentCamera = NULL ;
             mCurrentVirtualTimeInSeconds = currentVirtualTimeInSeconds ;
         }
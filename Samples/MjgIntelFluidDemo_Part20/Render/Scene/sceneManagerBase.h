@@ -10,10 +10,18 @@
 #include "Core/Containers/vector.h"
 
 #include "Render/Scene/sceneNodeBase.h"
+#include "Render/Scene/renderQueue.h"
 
 #include "Render/Scene/iSceneManager.h"
 
 // Macros ----------------------------------------------------------------------
+
+/** Whether RenderScene queues draw items of models and sorts them, to reduce render state changes.
+
+    Otherwise, RenderScene renders each node as it visits it, setting camera, lights
+    and render state for every mesh.
+*/
+#define RENDER_SORT_DRAW_ITEMS 1
 // Types -----------------------------------------------------------------------
 
 namespace PeGaSys
@@ -68,6 +76,9 @@ namespace PeGaSys
                 ApiBase *       mApi                            ;   ///< Non-owned address of low-level render system device
                 const Camera  * mCurrentCamera                  ;   ///< Address of camera currently being used to render scene.
                 double          mCurrentVirtualTimeInSeconds    ;   ///< Current virtual time in seconds.
+            #if RENDER_SORT_DRAW_ITEMS
+                RenderQueue     mRenderQueue                    ;   ///< Draw items of models to render, reused each frame to avoid reallocating.
+            #endif
         } ;
 
 // Public variables ------------------------------------------------------------
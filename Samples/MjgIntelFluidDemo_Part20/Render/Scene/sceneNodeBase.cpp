@@ -6,6 +6,8 @@
 */
 
 #include "Render/Scene/sceneNodeBase.h"
+#include "Render/Scene/camera.h"
+#include "Render/Scene/iSceneManager.h"
 
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
@@ -16,6 +18,25 @@
 // Private variables -----------------------------------------------------------
 // Public variables ------------------------------------------------------------
 // Private functions -----------------------------------------------------------
+
+namespace PeGaSys {
+    namespace Render {
+
+        /** Update world-space box to include another box.
+        */
+        static void UnionBoundingBox( Vec3 & minCorner , Vec3 & maxCorner , const Vec3 & otherMinCorner , const Vec3 & otherMaxCorner )
+        {
+            minCorner.x = Min2( minCorner.x , otherMinCorner.x ) ;
+            minCorner.y = Min2( minCorner.y , otherMinCorner.y ) ;
+            minCorner.z = Min2( minCorner.z , otherMinCorner.z ) ;
+            maxCorner.x = Max2( maxCorner.x , otherMaxCorner.x ) ;
+            maxCorner.y = Max2( maxCorner.y , otherMaxCorner.y ) ;
+            maxCorner.z = Max2( maxCorner.z , otherMaxCorner.z ) ;
+        }
+
+    } ;
+} ;
+
 // Public functions ------------------------------------------------------------
 
 namespace PeGaSys {
@@ -44,6 +65,12 @@ namespace PeGaSys {
 #       error Invalid render orientation representation
 #   endif
             , mScale( 1.0f , 1.0f , 1.0f , 0.0f )
+            , mLocalMinCorner( 0.0f , 0.0f , 0.0f )
+            , mLocalMaxCorner( 0.0f , 0.0f , 0.0f )
+            , mWorldMinCorner( 0.0f , 0.0f , 0.0f )
+            , mWorldMaxCorner( 0.0f , 0.0f , 0.0f )
+            , mLocalBounds( BOUNDS_INFINITE )
+            , mWorldBounds( BOUNDS_INFINITE )
         {
             PERF_BLOCK( SceneNodeBase__SceneNodeBase ) ;
         }
@@ -77,18 +104,116 @@ namespace PeGaSys {
 
 
 
-        /** Render children of this node.
+        /** Render children of this node, skipping those outside the view frustum of the current camera.
         */
         void SceneNodeBase::RenderChildren()
         {
             PERF_BLOCK( SceneNodeBase__RenderChildren ) ;
 
             ASSERT( static_cast< SceneNodeBase * >( this )->GetTypeId() != sTypeId ) ; // Derived class must reassign type id.
+            const Camera * camera = mSceneManager ? mSceneManager->GetCurrentCamera() : NULLPTR ;
             for( SceneNodeIteratorT iter = mSceneNodes.Begin() ; iter != mSceneNodes.End() ; ++ iter )
             {
                 ISceneNode * & sceneNode = * iter ;
                 ASSERT( static_cast< SceneNodeBase * >( sceneNode )->GetTypeId() != sTypeId ) ; // Derived class must reassign type id.
-                sceneNode->Render() ;
+                if( ( NULLPTR == camera ) || static_cast< SceneNodeBase * >( sceneNode )->IsVisibleTo( * camera ) )
+                {   // Child could be visible.
+                    sceneNode->Render() ;
+                }
+            }
+        }
+
+
+
+
+        /** Set local-space box within which this node itself renders, not including its children.
+        */
+        void SceneNodeBase::SetLocalBoundingBox( const Vec3 & minCorner , const Vec3 & maxCorner )
+        {
+            ASSERT( minCorner <= maxCorner ) ;
+            mLocalMinCorner = minCorner ;
+            mLocalMaxCorner = maxCorner ;
+            mLocalBounds    = BOUNDS_BOX ;
+        }
+
+
+
+
+        /** Update world-space bounds of this node and its descendants.
+
+            This updates the local-to-world transform of this node and each
+            descendant, then combines the world-space bounds of each of them,
+            so a node outside the view frustum implies its whole subtree is.
+        */
+        void SceneNodeBase::UpdateWorldBounds()
+        {
+            PERF_BLOCK( SceneNodeBase__UpdateWorldBounds ) ;
+
+            UpdateLocalBounds() ;
+            SetLocalToWorld() ;
+
+            mWorldBounds = mLocalBounds ;
+            if( BOUNDS_BOX == mLocalBounds )
+            {
+                TransformBoundingBox( mLocalToWorld , mLocalMinCorner , mLocalMaxCorner , mWorldMinCorner , mWorldMaxCorner ) ;
+            }
+
+            for( SceneNodeIteratorT iter = mSceneNodes.Begin() ; iter != mSceneNodes.End() ; ++ iter )
+            {   // For each child...
+                SceneNodeBase * child = static_cast< SceneNodeBase * >( * iter ) ;
+                child->UpdateWorldBounds() ;
+                if( ( BOUNDS_INFINITE == mWorldBounds ) || ( BOUNDS_EMPTY == child->mWorldBounds ) )
+                {   // Child cannot enlarge bounds.
+                }
+                else if( ( BOUNDS_INFINITE == child->mWorldBounds ) || ( BOUNDS_EMPTY == mWorldBounds ) )
+                {   // Child bounds replace bounds so far.
+                    mWorldBounds    = child->mWorldBounds ;
+                    mWorldMinCorner = child->mWorldMinCorner ;
+                    mWorldMaxCorner = child->mWorldMaxCorner ;
+                }
+                else
+                {   // Both have boxes.
+                    UnionBoundingBox( mWorldMinCorner , mWorldMaxCorner , child->mWorldMinCorner , child->mWorldMaxCorner ) ;
+                }
+            }
+        }
+
+
+
+
+        /** Find axis-aligned box that contains the given box after transforming it.
+
+            This transforms the center of the box, and sums the magnitudes of
+            the transformed half-extents along each axis, which costs less than
+            transforming all 8 corners and gives the same result.
+        */
+        /* static */ void SceneNodeBase::TransformBoundingBox( const Mat44 & transform , const Vec3 & minCorner , const Vec3 & maxCorner , Vec3 & transformedMinCorner , Vec3 & transformedMaxCorner )
+        {
+            const Vec3 center       = 0.5f * ( minCorner + maxCorner ) ;
+            const Vec3 halfExtent   = 0.5f * ( maxCorner - minCorner ) ;
+            const Vec4 newCenter    = transform * Vec4( center , 1.0f ) ;
+            const Vec3 newCenter3( newCenter.x , newCenter.y , newCenter.z ) ;
+            const Vec3 newHalfExtent(   fabsf( transform.m[ 0 ][ 0 ] ) * halfExtent.x + fabsf( transform.m[ 1 ][ 0 ] ) * halfExtent.y + fabsf( transform.m[ 2 ][ 0 ] ) * halfExtent.z
+                                    ,   fabsf( transform.m[ 0 ][ 1 ] ) * halfExtent.x + fabsf( transform.m[ 1 ][ 1 ] ) * halfExtent.y + fabsf( transform.m[ 2 ][ 1 ] ) * halfExtent.z
+                                    ,   fabsf( transform.m[ 0 ][ 2 ] ) * halfExtent.x + fabsf( transform.m[ 1 ][ 2 ] ) * halfExtent.y + fabsf( transform.m[ 2 ][ 2 ] ) * halfExtent.z ) ;
+            transformedMinCorner = newCenter3 - newHalfExtent ;
+            transformedMaxCorner = newCenter3 + newHalfExtent ;
+        }
+
+
+
+
+        /** Return whether this node or any of its descendants could be visible to the given camera.
+
+            Uses world bounds from the most recent call to UpdateWorldBounds.
+        */
+        bool SceneNodeBase::IsVisibleTo( const Camera & camera ) const
+        {
+            switch( mWorldBounds )
+            {
+            case BOUNDS_EMPTY   : return false ;
+            case BOUNDS_BOX     : return camera.IsBoxInFrustum( mWorldMinCorner , mWorldMaxCorner ) ;
+            default             : return true ;
             }
         }
 
@@ -8,6 +8,7 @@
 #define SCENE_NODE_BASE_H
 
 #include "Core/Containers/slist.h"
+#include "Core/Memory/poolAllocator.h"
 
 #include "Core/Math/vec3.h"
 #include "Core/Math/vec4.h"
@@ -37,6 +38,7 @@ namespace PeGaSys
         typedef unsigned TypeId ;   ///< Type identifier, used for simple runtime type information.
 
         class ISceneManager ;
+        class Camera        ;
 
         /** Base class for a scene node.
 
@@ -47,13 +49,28 @@ namespace PeGaSys
             Games can specialize SceneNodeBase to add custom scene nodes,
             such as particle systems and other visual effects, nodes to use for
             visualization and posable character models.
+
+            Each node has bounds of what it renders itself, in local coordinates,
+            and world-space bounds of what it and its descendants render, which
+            UpdateWorldBounds assigns.  Rendering skips a node, and therefore its
+            whole subtree, when its world bounds lie outside the view frustum.
         */
         class SceneNodeBase : public ISceneNode
         {
             public:
+                POOLED_ALLOCATION   // Scene nodes come from pools, so resetting a scene reuses their memory.
+
                 typedef SLIST< ISceneNode * >           SceneNodeContainerT ;
                 typedef SceneNodeContainerT::Iterator   SceneNodeIteratorT  ;
 
+                /// Kinds of region within which a scene node renders.
+                enum BoundsE
+                {
+                    BOUNDS_EMPTY    ,   ///< Renders nothing.
+                    BOUNDS_BOX      ,   ///< Renders only within an axis-aligned box.
+                    BOUNDS_INFINITE ,   ///< Could render anywhere, so culling must never reject it.
+                } ;
+
                 static const TypeId sTypeId = 'SNOD' ;
 
                 SceneNodeBase( ISceneManager * sceneManager , TypeId typeId ) ;
@@ -80,6 +97,9 @@ namespace PeGaSys
 
                 void RenderChildren() ;
 
+                /// Return whether this node has any children.
+                bool HasChildren() const { return ! mSceneNodes.Empty() ; }
+
                 /// Set world-space position that applies to this scene node as a translation.
                 void SetPosition( const Vec3 & position )           { mPosition.x = position.x ; mPosition.y = position.y ; mPosition.z = position.z ; mPosition.w = 1.0f ; }
 
@@ -117,10 +137,36 @@ namespace PeGaSys
                 /// Return scale that applies to this scene node.
                 const Mat44 & GetLocalToWorld() const       { return mLocalToWorld ; }
 
+                void SetLocalBoundingBox( const Vec3 & minCorner , const Vec3 & maxCorner ) ;
+
+                /// Set whether this node itself renders nothing, or could render anywhere.  Use SetLocalBoundingBox for other cases.
+                void SetLocalBounds( BoundsE bounds )       { ASSERT( bounds != BOUNDS_BOX ) ; mLocalBounds = bounds ; }
+
+                void UpdateWorldBounds() ;
+
+                /// Return kind of region within which this node and its descendants render, as of the last call to UpdateWorldBounds.
+                BoundsE GetWorldBounds() const              { return mWorldBounds ; }
+
+                /// Return minimal corner of world-space box within which this node and its descendants render.  Only meaningful when GetWorldBounds returns BOUNDS_BOX.
+                const Vec3 & GetWorldMinCorner() const      { return mWorldMinCorner ; }
+
+                /// Return maximal corner of world-space box within which this node and its descendants render.  Only meaningful when GetWorldBounds returns BOUNDS_BOX.
+                const Vec3 & GetWorldMaxCorner() const      { return mWorldMaxCorner ; }
+
+                bool IsVisibleTo( const Camera & camera ) const ;
+
+                static void TransformBoundingBox( const Mat44 & transform , const Vec3 & minCorner , const Vec3 & maxCorner , Vec3 & transformedMinCorner , Vec3 & transformedMaxCorner ) ;
+
             protected:
                 /// Return SceneManager that manages this scene node.
                 ISceneManager * GetSceneManager() const { return mSceneManager ; }
 
+                /** Update bounds of what this node itself renders, before UpdateWorldBounds uses them.
+
+                    Nodes whose contents change (e.g. particle systems) can override this.
+                */
+                virtual void UpdateLocalBounds() {}
+
             PRIVATE:
                 TypeId              mTypeId         ;   ///< Type identifier for this object
 
@@ -141,6 +187,13 @@ namespace PeGaSys
 
                 Mat44               mLocalToWorld   ;   ///< Local-to-world transform to place this node into world coordinates.  Assigned from mPosition, mOrientation and mScale.
 
+                Vec3                mLocalMinCorner ;   ///< Minimal corner of local-space box within which this node renders, when mLocalBounds is BOUNDS_BOX.
+                Vec3                mLocalMaxCorner ;   ///< Maximal corner of local-space box within which this node renders, when mLocalBounds is BOUNDS_BOX.
+                Vec3                mWorldMinCorner ;   ///< Minimal corner of world-space box within which this node and its descendants render, when mWorldBounds is BOUNDS_BOX.
+                Vec3                mWorldMaxCorner ;   ///< Maximal corner of world-space box within which this node and its descendants render, when mWorldBounds is BOUNDS_BOX.
+                BoundsE             mLocalBounds    ;   ///< Kind of region within which this node renders.
+                BoundsE             mWorldBounds    ;   ///< Kind of region within which this node and its descendants render.  Assigned by UpdateWorldBounds.
+
             private:
                 SceneNodeBase() ; // Disallow default construction.
         } ;
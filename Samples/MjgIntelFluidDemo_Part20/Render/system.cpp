@@ -7,6 +7,8 @@
 
 #include "Render/system.h"
 
+#include "Render/Resource/deferredReleaseQueue.h"
+
 #include <Core/Performance/perfBlock.h>
 #include <Core/Utility/macros.h>
 #include <Core/Memory/newWrapper.h>
@@ -14,6 +16,9 @@
 
 // Types -----------------------------------------------------------------------
 // Private variables -----------------------------------------------------------
+
+static const size_t sMaxTextureUploadsPerUpdate = 2 ;   ///< Maximum number of queued textures UpdateTargets uploads, so a burst of uploads spreads across frames.
+
 // Public variables ------------------------------------------------------------
 // Private functions -----------------------------------------------------------
 // Public functions ------------------------------------------------------------
@@ -24,11 +29,16 @@ namespace PeGaSys {
         /** Construct render system.
 
             \param  renderApi   Address of platform-dependent API object that this object takes ownership of.
+
+            \note   The thread that constructs this becomes the render thread, which DeferredReleaseQueue
+                    lets delete render resources.  It should be the thread that calls UpdateTargets.
         */
         System::System( ApiBase * renderApi )
             : mApi( renderApi )
         {
             PERF_BLOCK( Render__System__System ) ;
+
+            DeferredReleaseQueue::SetRenderThread() ;
         }
 
 
@@ -46,6 +56,7 @@ namespace PeGaSys {
                 delete target ;                         // Delete the object.
                 mTargets.PopFront() ;                   // Remove its address from the list.
             }
+            DeferredReleaseQueue::DeleteReleased() ; // Free resources other threads released, while the render device still exists.
             delete mApi ;
         }
 
@@ -56,11 +67,22 @@ namespace PeGaSys {
 
             Each Target has Viewports, which this routine renders by calling
             RenderViewports.
+
+            Before that, this deletes render resources whose last reference
+            other threads released, and uploads a few textures whose images the
+            TextureUploadQueue finished generating since the previous update.
         */
         void System::UpdateTargets( const double & currentVirtualTimeInSeconds )
         {
             PERF_BLOCK( Render__System__UpdateTargets ) ;
 
+            DeferredReleaseQueue::DeleteReleased() ;
+
+            if( mApi )
+            {   // Render device exists, so can upload textures.
+                mTextureUploadQueue.UploadCompleted( sMaxTextureUploadsPerUpdate ) ;
+            }
+
             for( TargetIterator iter = mTargets.Begin() ; iter != mTargets.End() ; ++ iter )
             {   // For each render target...
                 Target * const & target = * iter ;
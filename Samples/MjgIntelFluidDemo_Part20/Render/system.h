@@ -11,6 +11,7 @@
 
 #include "Render/Device/target.h"
 #include "Render/Device/api.h"
+#include "Render/Resource/textureUploadQueue.h"
 
 // Macros ----------------------------------------------------------------------
 // Types -----------------------------------------------------------------------
@@ -30,6 +31,9 @@ namespace PeGaSys
                 /// Return address of Render API object.
                 ApiBase * GetApi() { return mApi ; }
 
+                /// Return queue through which to create textures without waiting for their images.
+                TextureUploadQueue & GetTextureUploadQueue() { return mTextureUploadQueue ; }
+
                 /** Add a Render Target such as a window or texture.
                     \param target   Render Target
                 */
@@ -46,6 +50,7 @@ namespace PeGaSys
                 typedef TargetContainer::ConstIterator  TargetConstIterator ;
                 TargetContainer                         mTargets            ;   /// Render targets
                 ApiBase *                               mApi                ;   /// Address of low-level render system device, which this object owns.
+                TextureUploadQueue                      mTextureUploadQueue ;   /// Textures whose images are being generated, awaiting upload.
         } ;
 
 // Public variables ------------------------------------------------------------
@@ -11,6 +11,7 @@
 #include <Image/Operation/imgOpMakeNoise.h>
 #include <Image/Operation/imgOpBlur.h>
 #include <Image/imgOpSequences.h>
+#include <Image/imageCache.h>
 
 #include <ParticlesRender/particlesRenderModel.h>
 
@@ -45,15 +46,180 @@
 
 typedef PeGaSys::Render::OpenGL_VertexBuffer::VertexFormatPositionColor4Texture2 VertexFormatPos3Col4Tex2 ;
 
+// Macros ----------------------------------------------------------------------
+
+/** Draw particles as GPU-instanced billboards instead of CPU-built quadrilaterals.
+
+    With this enabled, particle vertex buffers hold one 24-byte
+    VertexFormatBillboardInstance per particle, which a vertex shader expands
+    into a camera-facing quadrilateral, instead of four 24-byte vertices.
+    That reduces the data the CPU writes and the bus carries each frame.
+
+    This requires OpenGL 3.3.
+*/
+#define USE_INSTANCED_PARTICLE_BILLBOARDS 0
+
+/** Store fluid isosurface vertices with quantized positions and packed normals, where the driver supports that.
+
+    With this enabled, the isosurface uses POSITION_NORMAL_PACKED, 12 bytes
+    per vertex instead of 24, which halves the data marching cubes writes
+    and the GPU reads each time the isosurface changes.  Positions quantize
+    against the box the grid spans, so their precision is 1/65535 of its
+    extent, far finer than grid cells.
+*/
+#define USE_PACKED_ISOSURFACE_VERTICES 1
+
+/** Re-extract only chunks of the fluid isosurface whose grid values changed.
+
+    With this enabled, the isosurface consists of one mesh per chunk of
+    sIsosurfaceChunkSize^3 grid cells.  Each update compares grid values with
+    those each chunk last extracted, and re-extracts only chunks where some
+    value changed by more than a tolerance, so when most of the field stays
+    still, such as a pool with a local splash, most vertex buffers stay
+    untouched.  Changing the grid layout (its corner, spacing or number of
+    points) re-extracts every chunk.
+*/
+#define USE_CHUNKED_ISOSURFACE 1
+
+/** Extract the fluid isosurface from a coarser grid when the camera is far enough that the difference would not show.
+
+    With this enabled, UpdateFluidIsosurface estimates how many pixels a grid
+    cell spans where the grid lies nearest the camera.  When a cell coarsened
+    by a factor of 2^L would still span no more than sIsosurfaceLodPixelError
+    pixels, it extracts from NestedGrid layer L, which it down-samples from
+    the given grid by point sampling, so coarse values remain distances.
+    Each level has 1/8 as many cells, so far views extract and draw a small
+    fraction of the triangles.  A level must beat the threshold by
+    sIsosurfaceLodHysteresis before coarsening to it, so the level does not
+    flicker while the camera hovers near a threshold.
+*/
+#define USE_ISOSURFACE_LOD 1
+
+/** Cache procedural texture images on disk, so launches after the first load them instead of generating them.
+
+    Cache files go in the working directory, named TextureCache_*.pgimg.
+    Deleting them is always safe; the next launch regenerates them.
+*/
+#define USE_TEXTURE_CACHE 1
+
+/** Block-compress procedural texture images (BC4 or BC7, see CompressedImage) before upload, caching the compressed result.
+
+    Smoke and flame particles overdraw each other heavily, so the bandwidth
+    of sampling their textures dominates fill cost, and compressed textures
+    take 4 to 8 times less.  Drivers that lack the compressed formats get the
+    decompressed image instead.
+*/
+#define USE_COMPRESSED_TEXTURES 1
+
 // Private variables -----------------------------------------------------------
+
+/// Number of grid cells along each edge of a fluid isosurface chunk.  See USE_CHUNKED_ISOSURFACE.
+static const size_t sIsosurfaceChunkSize = 16 ;
+
+/// Largest change, as a fraction of grid cell spacing, that a grid value can undergo without making isosurface chunks that read it stale.
+static const float sIsosurfaceChangeTolerance = 0.01f ;
+
+/// Largest number of pixels a grid cell of a coarse isosurface level can span on screen.  See USE_ISOSURFACE_LOD.
+static const float sIsosurfaceLodPixelError = 2.0f ;
+
+/// Factor by which a coarser isosurface level must undercut sIsosurfaceLodPixelError before switching to it.
+static const float sIsosurfaceLodHysteresis = 1.5f ;
+
+/// Coarsest isosurface level, where each level halves resolution of the one before it.
+static const size_t sIsosurfaceLodMax = 3 ;
+
+/// Fewest grid cells, along any axis, a coarse isosurface level can have.
+static const unsigned sIsosurfaceLodMinCells = 4 ;
+
+/// Version of the parameters Make*Image functions use.  Increment this whenever any of them changes, so images cached by older builds become stale.
+static const unsigned sTextureCacheVersion = 1 ;
 // Public variables ------------------------------------------------------------
 // Private functions -----------------------------------------------------------
+
+/// Return vertex format that fluid isosurface meshes use.
+static PeGaSys::Render::VertexDeclaration::VertexFormatE GetIsosurfaceVertexFormat()
+{
+    using namespace PeGaSys::Render ;
+#if USE_PACKED_ISOSURFACE_VERTICES
+    if( OpenGL_VertexBuffer::IsPositionNormalPackedSupported() )
+    {
+        return VertexDeclaration::POSITION_NORMAL_PACKED ;
+    }
+#endif
+    return VertexDeclaration::POSITION_NORMAL ;
+}
+
+
+
+
+/** Enqueue generation and upload of the given texture, using the cache file with the given name.
+
+    \param cacheFilename    Name of file that caches the image makeImage generates.  Must be a string literal, since the queue holds it.
+
+    The cache key combines cacheFilename with the versions of the image operation
+    sequences and of the Make*Image parameters, so changing either makes the
+    cached image stale.
+
+    See USE_COMPRESSED_TEXTURES.
+*/
+static void EnqueueCachedTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureBase * texture , PeGaSys::Render::TextureUploadQueue::MakeImageFunctionT makeImage , const char * cacheFilename )
+{
+#if USE_TEXTURE_CACHE
+    unsigned long long key = PeGaSys::ImageCache_HashString( cacheFilename ) ;
+    key = PeGaSys::ImageCache_Hash( & PeGaSys::ImgOpSeq_sVersion , sizeof( PeGaSys::ImgOpSeq_sVersion ) , key ) ;
+    key = PeGaSys::ImageCache_Hash( & sTextureCacheVersion , sizeof( sTextureCacheVersion ) , key ) ;
+    renderSystem->GetTextureUploadQueue().Enqueue( texture , makeImage , cacheFilename , key , USE_COMPRESSED_TEXTURES != 0 ) ;
+#else
+    renderSystem->GetTextureUploadQueue().Enqueue( texture , makeImage , NULLPTR , 0 , USE_COMPRESSED_TEXTURES != 0 ) ;
+#endif
+}
+
+
+
+
+/// Set given Vertex Buffer filler to write the vertex layout that FluidScene::AddFluidParticleSystemModel declares.
+static void VertexBufferFiller_SetLayout( PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric & vbFiller )
+{
+#if USE_INSTANCED_PARTICLE_BILLBOARDS
+    vbFiller.SetBillboardInstance() ;
+#else
+    vbFiller.SetPos3FCol4BTex2F() ;
+#endif
+}
+
+
+
+
+/// Make the noise image that demo shape models share.  Runs on the texture upload queue worker thread.
+static void MakeShapeImage( PeGaSys::Image & image )
+{
+    PERF_BLOCK( MakeShapeImage ) ;
+
+    image.SetSize( 128 , 128 , 4 , 1 ) ;
+    PeGaSys::ImgOpSeq_Noise( image , 0.9f , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) ) ;
+}
+
+
+
+
+/// Make the gradient noise image for the sky model.  Runs on the texture upload queue worker thread.
+static void MakeSkyImage( PeGaSys::Image & image )
+{
+    PERF_BLOCK( MakeSkyImage ) ;
+
+    const unsigned width = 128 , height = 128 , numChannels = 4 , numPages = 1 ;
+    image.SetSize( width , height , numChannels , numPages ) ;
+    const Vec4 blankColor( 1.0f , 1.0f , 1.0f , 1.0f ) ;
+    const float gamma = 0.2f ;
+    PeGaSys::ImgOpSeq_GradientNoise( image , gamma , blankColor ) ;
+}
+
 // Public functions ------------------------------------------------------------
 
 /// Routine to set given Vertex Buffer filler to state suitable for Diagnostic or Dye rendering.
 void VertexBufferFiller_SetDiagnosticOrDye( PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric & vbFiller )
 {
-    vbFiller.SetPos3FCol4BTex2F() ;
+    VertexBufferFiller_SetLayout( vbFiller ) ;
     vbFiller.mUseDensityForTextureCoordinate    = true ;
     vbFiller.mDensityVisibility                 = FLT_MAX ;
 }
@@ -63,8 +229,8 @@ void VertexBufferFiller_SetDiagnosticOrDye( PeGaSys::ParticlesRender::ParticlesR
 
 void VertexBufferFiller_SetFuel( PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric & vbFiller )
 {
-    vbFiller.SetPos3FCol4BTex2F() ;
-    vbFiller.mOffsetToDensityInfo               = offsetof( Particle , mFuelFraction ) ;
+    VertexBufferFiller_SetLayout( vbFiller ) ;
+    vbFiller.mDensityInfoAttribute              = PARTICLE_ATTRIBUTE_FUEL_FRACTION ;
     vbFiller.mDensityVisibility                 = 254.8f * 100.0f ;
     vbFiller.mScale                             = 2.0987f ;
 }
@@ -74,8 +240,8 @@ void VertexBufferFiller_SetFuel( PeGaSys::ParticlesRender::ParticlesRenderModel:
 
 void VertexBufferFiller_SetSmoke( PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric & vbFiller )
 {
-    vbFiller.SetPos3FCol4BTex2F() ;
-    vbFiller.mOffsetToDensityInfo               = offsetof( Particle , mSmokeFraction ) ;
+    VertexBufferFiller_SetLayout( vbFiller ) ;
+    vbFiller.mDensityInfoAttribute              = PARTICLE_ATTRIBUTE_SMOKE_FRACTION ;
     vbFiller.mDensityVisibility                 = 100.0f ;
     vbFiller.mScale                             = 4.0123f ;
 }
@@ -85,8 +251,8 @@ void VertexBufferFiller_SetSmoke( PeGaSys::ParticlesRender::ParticlesRenderModel
 
 void VertexBufferFiller_SetFlame( PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric & vbFiller )
 {
-    vbFiller.SetPos3FCol4BTex2F() ;
-    vbFiller.mOffsetToDensityInfo               = offsetof( Particle , mFlameFraction ) ;
+    VertexBufferFiller_SetLayout( vbFiller ) ;
+    vbFiller.mDensityInfoAttribute              = PARTICLE_ATTRIBUTE_FLAME_FRACTION ;
     vbFiller.mDensityVisibility                 = 254.9f * 100.0f ;
     vbFiller.mBlendMode                         = PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric::BLEND_MODE_ADDITIVE ;
     vbFiller.mScale                             = 4.0f ;
@@ -97,7 +263,7 @@ void VertexBufferFiller_SetFlame( PeGaSys::ParticlesRender::ParticlesRenderModel
 
 void VertexBufferFiller_SetVorton( PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric & vbFiller )
 {
-    vbFiller.SetPos3FCol4BTex2F() ;
+    VertexBufferFiller_SetLayout( vbFiller ) ;
     vbFiller.mUseDensityForTextureCoordinate    = true ;
 }
 
@@ -132,11 +298,16 @@ FluidScene::FluidScene( PeGaSys::Render::System * renderSystem
 
     , mDiagnosticVortonPass      ( NULLPTR )
     , mDiagnosticSimpleVortonPass( NULLPTR )
+
+    , mIsosurfaceMinCorner( 0.0f , 0.0f , 0.0f )
+    , mIsosurfaceCellSpacing( 0.0f , 0.0f , 0.0f )
+    , mIsosurfaceLod( 0 )
 {
     PERF_BLOCK( FluidScene__FluidScene ) ;
 
     memset( mLights     , 0 , sizeof( mLights     ) ) ;
     memset( mLightAnims , 0 , sizeof( mLightAnims ) ) ;
+    memset( mIsosurfaceNumPoints , 0 , sizeof( mIsosurfaceNumPoints ) ) ;
 
     using namespace PeGaSys::Render ;
 
@@ -339,25 +510,216 @@ PeGaSys::Render::Light *     FluidScene::GetLight( size_t index )
 
 
 
-/** Regenerate isosurface from fluid grid.
+/** Return whether the given grid has the same layout as the grid from which isosurface chunks were last extracted.
+*/
+bool FluidScene::IsIsosurfaceLayoutUnchanged( const UniformGrid< float > & gridOfValues ) const
+{
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        if( gridOfValues.GetNumPoints( axis ) != mIsosurfaceNumPoints[ axis ] )
+        {
+            return false ;
+        }
+    }
+    return  ( gridOfValues.GetMinCorner()   == mIsosurfaceMinCorner   )
+        &&  ( gridOfValues.GetCellSpacing() == mIsosurfaceCellSpacing ) ;
+}
+
+
+
+
+/** Return whether any grid value that the given isosurface chunk reads changed by more than the given tolerance since that chunk was last extracted.
+
+    A chunk reads the grid points at the corners of its cells, plus one more
+    layer on each side, which gradients (and therefore normals) use.
+*/
+bool FluidScene::IsIsosurfaceChunkStale( const UniformGrid< float > & gridOfValues , const size_t chunkIndices[ 3 ] , float tolerance ) const
+{
+    size_t begin[ 3 ] ;
+    size_t end[ 3 ] ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        const size_t firstCell = chunkIndices[ axis ] * sIsosurfaceChunkSize ;
+        begin[ axis ] = ( firstCell > 0 ) ? firstCell - 1 : 0 ;
+        end  [ axis ] = Min2( firstCell + sIsosurfaceChunkSize + 2 , size_t( gridOfValues.GetNumPoints( axis ) ) ) ;
+    }
+
+    const float *   values      = gridOfValues.Data() ;
+    const float *   extracted   = mIsosurfaceExtractedValues.Data() ;
+    const size_t    numX        = gridOfValues.GetNumPoints( 0 ) ;
+    const size_t    numXY       = numX * gridOfValues.GetNumPoints( 1 ) ;
+    for( size_t iz = begin[ 2 ] ; iz < end[ 2 ] ; ++ iz )
+    {
+        for( size_t iy = begin[ 1 ] ; iy < end[ 1 ] ; ++ iy )
+        {
+            const size_t offsetYZ = iy * numX + iz * numXY ;
+            for( size_t ix = begin[ 0 ] ; ix < end[ 0 ] ; ++ ix )
+            {
+                const size_t offset = ix + offsetYZ ;
+                if( fabsf( values[ offset ] - extracted[ offset ] ) > tolerance )
+                {   // This value changed enough to affect geometry or normals.
+                    return true ;
+                }
+            }
+        }
+    }
+    return false ;
+}
+
+
+
+
+/** Return mesh for the given isosurface chunk, adding meshes to the isosurface model as needed.
+*/
+PeGaSys::Render::MeshBase * FluidScene::GetIsosurfaceChunkMesh( size_t chunkIndex )
+{
+    using namespace PeGaSys::Render ;
+
+    ModelData * modelData = GetFluidIsosurfaceModel()->GetModelData() ;
+    while( mIsosurfaceChunkMeshes.Size() <= chunkIndex )
+    {   // Cache of chunk meshes lacks this chunk.
+        const size_t index = mIsosurfaceChunkMeshes.Size() ;
+        if( index < modelData->GetNumMeshes() )
+        {   // Model already has this mesh, e.g. the placeholder AddFluidIsosurfaceModel made.
+            mIsosurfaceChunkMeshes.PushBack( modelData->GetMesh( index ) ) ;
+        }
+        else
+        {   // Add a mesh that renders like the first.
+            MeshBase * mesh = modelData->NewMesh( mRenderSystem->GetApi() ) ;
+            mesh->SetTechnique( mIsosurfaceChunkMeshes[ 0 ]->GetTechnique() ) ;
+            mIsosurfaceChunkMeshes.PushBack( mesh ) ;
+        }
+    }
+    return mIsosurfaceChunkMeshes[ chunkIndex ] ;
+}
+
+
+
+
+/** Return which level of detail to extract the fluid isosurface at, given the grid it comes from and the camera.
+
+    Level 0 means the given grid, and each level after that halves its resolution.
+    See USE_ISOSURFACE_LOD.
+*/
+size_t FluidScene::ChooseIsosurfaceLod( const UniformGridGeometry & gridOfValues )
+{
+    PERF_BLOCK( FluidScene__ChooseIsosurfaceLod ) ;
+
+    if( ( NULLPTR == mCamera ) || ( mCamera->GetViewportHeight() <= 0.0f ) )
+    {   // Camera has not rendered yet, so the size of the surface on screen is unknown.
+        mIsosurfaceLod = 0 ;
+        return mIsosurfaceLod ;
+    }
+
+    // Find distance from eye to nearest point in the box the grid spans.
+    const Vec3 &    eye         = mCamera->GetEye() ;
+    const Vec3 &    minCorner   = gridOfValues.GetMinCorner() ;
+    const Vec3      maxCorner   = gridOfValues.GetMaxCorner() ;
+    const Vec3      nearest( Clamp( eye.x , minCorner.x , maxCorner.x )
+                           , Clamp( eye.y , minCorner.y , maxCorner.y )
+                           , Clamp( eye.z , minCorner.z , maxCorner.z ) ) ;
+    const float     distance    = Max2( ( nearest - eye ).Magnitude() , mCamera->GetNearClipDist() ) ;
+
+    const float     tanHalfFovVert      = tanf( 0.5f * mCamera->GetFieldOfViewVert() * DEG2RAD ) ;
+    const Vec3 &    spacing             = gridOfValues.GetCellSpacing() ;
+    const float     pixelsPerCell       = Max2( spacing.x , Max2( spacing.y , spacing.z ) ) * mCamera->GetViewportHeight() / ( 2.0f * tanHalfFovVert * distance ) ;
+
+    size_t lod = 0 ;
+    while( lod < sIsosurfaceLodMax )
+    {   // Coarsen while cells of the next level would span few enough pixels.
+        const size_t    nextLod         = lod + 1 ;
+        const float     threshold       = ( nextLod <= mIsosurfaceLod ) ? sIsosurfaceLodPixelError : ( sIsosurfaceLodPixelError / sIsosurfaceLodHysteresis ) ;
+        const float     pixelsPerCoarseCell = pixelsPerCell * float( 1 << nextLod ) ;
+        if( pixelsPerCoarseCell > threshold )
+        {   // Next level would look noticeably coarser.
+            break ;
+        }
+        bool hasEnoughCells = true ;
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {   // For each axis...
+            hasEnoughCells = hasEnoughCells && ( ( gridOfValues.GetNumCells( axis ) >> nextLod ) >= sIsosurfaceLodMinCells ) ;
+        }
+        if( ! hasEnoughCells )
+        {   // Next level would be too coarse to resemble the surface at all.
+            break ;
+        }
+        lod = nextLod ;
+    }
+    mIsosurfaceLod = lod ;
+    return mIsosurfaceLod ;
+}
+
+
+
+
+/** Regenerate isosurface from fluid grid, at a level of detail suited to how large it appears on screen.
+
+    \param gridOfValues         Grid of values, such as signed distance, whose zero isosurface to extract.
+
+    \param gradientGrid         Optional grid of gradients of gridOfValues, or of a quantity that varies
+                                oppositely (see gradientPointsInward), which vertex normals interpolate instead
+                                of differencing gridOfValues.  This only applies when it has the same shape as
+                                gridOfValues, for example when it is the density gradient grid VortonSim
+                                already computed.  NULL to difference values.
+
+    \param gradientPointsInward Whether gradientGrid points toward the fluid interior, as a density gradient does.
 
     \note   This could also be done with a NativeCallback if/when using PeGaSys::Entity.
+
+    \see USE_ISOSURFACE_LOD
 */
-void FluidScene::UpdateFluidIsosurface( const UniformGrid< float > & gridOfValues )
+void FluidScene::UpdateFluidIsosurface( const UniformGrid< float > & gridOfValues , const UniformGrid< Vec3 > * gradientGrid , bool gradientPointsInward )
 {
     PERF_BLOCK( FluidScene__UpdateFluidIsosurface ) ;
 
+#if USE_ISOSURFACE_LOD
+    const size_t lod = ChooseIsosurfaceLod( gridOfValues ) ;
+    if( lod > 0 )
+    {   // Surface appears small enough to extract from a coarser grid.
+        PERF_BLOCK( FluidScene__UpdateFluidIsosurface_DownSample ) ;
+        // Layer 0 of the nested grid is already decimated, so it never duplicates the given grid.
+        UniformGridGeometry halfResolution ;
+        halfResolution.Decimate( gridOfValues , 2 ) ;
+        mIsosurfaceLodGrids.Initialize( halfResolution ) ;
+        mIsosurfaceLodGrids[ 0 ].DownSample( gridOfValues , UniformGridGeometry::FASTER_LESS_ACCURATE ) ;
+        for( unsigned layer = 1 ; layer < lod ; ++ layer )
+        {   // For each coarser layer up to the chosen level...
+            mIsosurfaceLodGrids.DownSampleInto( layer , UniformGridGeometry::FASTER_LESS_ACCURATE ) ;
+        }
+        // The gradient grid does not match the coarse shape, so normals come from coarse values.
+        ExtractFluidIsosurface( mIsosurfaceLodGrids[ lod - 1 ] , NULLPTR , false ) ;
+        return ;
+    }
+#endif
+
+    ExtractFluidIsosurface( gridOfValues , gradientGrid , gradientPointsInward ) ;
+}
+
+
+
+
+/** Extract isosurface from the given grid into the fluid isosurface model.
+
+    With USE_CHUNKED_ISOSURFACE, this re-extracts only chunks whose grid
+    values changed, and leaves vertex and index buffers of other chunks
+    untouched.
+
+    \see UpdateFluidIsosurface for parameters.
+*/
+void FluidScene::ExtractFluidIsosurface( const UniformGrid< float > & gridOfValues , const UniformGrid< Vec3 > * gradientGrid , bool gradientPointsInward )
+{
+    PERF_BLOCK( FluidScene__ExtractFluidIsosurface ) ;
+
     using namespace PeGaSys::Render ;
 
-    const VertexDeclaration::VertexFormatE vertFmt = VertexDeclaration::POSITION_NORMAL ;
+    const VertexDeclaration::VertexFormatE vertFmt = GetIsosurfaceVertexFormat() ;
 
-    MeshBase *  mesh        = GetFluidIsosurfaceModel()->GetModelData()->GetMesh( 0 ) ;
     ApiBase *   renderApi   = mRenderSystem->GetApi() ;
 
-    static const size_t numSegments = 32 ;
-
 #if 0 // WORK IN PROGRESS: Generate sphere mesh, vertices and normals.
     // Regenerate sphere grid using different radius, then refill mesh.
+    MeshBase *  mesh        = GetFluidIsosurfaceModel()->GetModelData()->GetMesh( 0 ) ;
+    static const size_t numSegments = 32 ;
 static float fakeTimer = 0.0f ;
 fakeTimer += 0.1f ;
     Mesh_MakeSphere( mesh , renderApi , numSegments , /* radius */ 0.05f * ( cos( fakeTimer ) + 2.0f ) , vertFmt ) ;
@@ -366,6 +728,7 @@ fakeTimer += 0.1f ;
 
 #else // WORK IN PROGRESS: This fluid surface generation is temporarily disabled while testing normals-from-gradient in Mesh_MakeSphere.
     GridWrapper gridWrapper ;
+    GridWrapper_Init( & gridWrapper ) ;
     gridWrapper.values = const_cast< float * >( gridOfValues.Data() ) ;
     gridWrapper.number[ 0 ] = gridOfValues.GetNumPoints( 0 ) ;
     gridWrapper.number[ 1 ] = gridOfValues.GetNumPoints( 1 ) ;
@@ -378,8 +741,162 @@ fakeTimer += 0.1f ;
     gridWrapper.directions[ 1 ] = Vec3( 0.0f , gridOfValues.GetCellSpacing().y , 0.0f ) ;
     gridWrapper.directions[ 2 ] = Vec3( 0.0f , 0.0f , gridOfValues.GetCellSpacing().z ) ;
 
+    GridWrapper gradientWrapper ;
+    GridWrapper_Init( & gradientWrapper ) ;
+    if(     gradientGrid && ! gradientGrid->Empty()
+        &&  gradientGrid->ShapeMatches( gridOfValues ) )
+    {   // Gradients lie at the same points as values, so vertex normals can read them directly.
+        gradientWrapper = gridWrapper ;
+        gradientWrapper.values      = const_cast< float * >( & gradientGrid->Data()->x ) ;
+        gradientWrapper.strides[ 0 ] = sizeof( Vec3 ) ;
+        gradientWrapper.strides[ 1 ] = sizeof( Vec3 ) * gradientGrid->GetNumPoints( 0 ) ;
+        gradientWrapper.strides[ 2 ] = sizeof( Vec3 ) * gradientGrid->GetNumPoints( 0 ) * gradientGrid->GetNumPoints( 1 ) ;
+        gridWrapper.gradients               = & gradientWrapper ;
+        gridWrapper.gradientsPointInward    = gradientPointsInward ;
+    }
+
+#if USE_CHUNKED_ISOSURFACE
+    size_t numChunks[ 3 ] ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        const size_t numCells = gridOfValues.GetNumPoints( axis ) - 1 ;
+        numChunks[ axis ] = ( numCells + sIsosurfaceChunkSize - 1 ) / sIsosurfaceChunkSize ;
+    }
+    const size_t    numChunksTotal  = numChunks[ 0 ] * numChunks[ 1 ] * numChunks[ 2 ] ;
+    const size_t    numPointsTotal  = gridOfValues.GetGridCapacity() ;
+    const bool      layoutChanged   = ! IsIsosurfaceLayoutUnchanged( gridOfValues ) ;
+    const Vec3 &    spacing         = gridOfValues.GetCellSpacing() ;
+    const float     tolerance       = sIsosurfaceChangeTolerance * Min2( spacing.x , Min2( spacing.y , spacing.z ) ) ;
+
+    if( layoutChanged )
+    {   // Every chunk is stale.  Empty meshes of chunks the new layout lacks.
+        for( size_t chunkIndex = numChunksTotal ; chunkIndex < mIsosurfaceChunkMeshes.Size() ; ++ chunkIndex )
+        {
+            MeshBase * mesh = mIsosurfaceChunkMeshes[ chunkIndex ] ;
+            mesh->DeleteIndexBuffer( renderApi ) ;
+            if( mesh->GetVertexBuffer() != NULLPTR )
+            {
+                mesh->GetVertexBuffer()->SetPopulation( 0 ) ;
+            }
+        }
+    }
+
+    // Find stale chunks before extracting any, since adjacent chunks share grid points.
+    VECTOR< unsigned char > isStale( numChunksTotal , 0 ) ;
+    size_t                  numStale = 0 ;
+    {
+        PERF_BLOCK( FluidScene__UpdateFluidIsosurface_FindStaleChunks ) ;
+        size_t chunkIndices[ 3 ] ;
+        size_t chunkIndex = 0 ;
+        for( chunkIndices[ 2 ] = 0 ; chunkIndices[ 2 ] < numChunks[ 2 ] ; ++ chunkIndices[ 2 ] )
+        for( chunkIndices[ 1 ] = 0 ; chunkIndices[ 1 ] < numChunks[ 1 ] ; ++ chunkIndices[ 1 ] )
+        for( chunkIndices[ 0 ] = 0 ; chunkIndices[ 0 ] < numChunks[ 0 ] ; ++ chunkIndices[ 0 ] , ++ chunkIndex )
+        {   // For each chunk...
+            if( layoutChanged || IsIsosurfaceChunkStale( gridOfValues , chunkIndices , tolerance ) )
+            {
+                isStale[ chunkIndex ] = 1 ;
+                ++ numStale ;
+            }
+        }
+    }
+
+    if( 0 == numStale )
+    {   // Every chunk mesh still represents the grid within tolerance.
+        return ;
+    }
+
+    {   // Re-extract stale chunks.
+        PERF_BLOCK( FluidScene__UpdateFluidIsosurface_ExtractChunks ) ;
+        size_t chunkIndices[ 3 ] ;
+        size_t chunkIndex = 0 ;
+        for( chunkIndices[ 2 ] = 0 ; chunkIndices[ 2 ] < numChunks[ 2 ] ; ++ chunkIndices[ 2 ] )
+        for( chunkIndices[ 1 ] = 0 ; chunkIndices[ 1 ] < numChunks[ 1 ] ; ++ chunkIndices[ 1 ] )
+        for( chunkIndices[ 0 ] = 0 ; chunkIndices[ 0 ] < numChunks[ 0 ] ; ++ chunkIndices[ 0 ] , ++ chunkIndex )
+        {   // For each chunk...
+            if( ! isStale[ chunkIndex ] )
+            {
+                continue ;
+            }
+
+            // Wrap the part of the grid this chunk spans.  It shares strides and directions with the whole grid.
+            GridWrapper chunkGrid           = gridWrapper ;
+            GridWrapper chunkGradients      = gradientWrapper ;
+            size_t      offset              = 0 ;
+            size_t      gradientOffset      = 0 ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis...
+                const size_t numCells   = gridWrapper.number[ axis ] - 1 ;
+                const size_t firstCell  = chunkIndices[ axis ] * sIsosurfaceChunkSize ;
+                const size_t endCell    = Min2( firstCell + sIsosurfaceChunkSize , numCells ) ;
+                chunkGrid.number[ axis ]            = endCell - firstCell + 1 ;
+                chunkGrid.hasPointBefore[ axis ]    = firstCell > 0 ;
+                chunkGrid.hasPointAfter[ axis ]     = endCell < numCells ;
+                chunkGrid.minPos                   += gridWrapper.directions[ axis ] * float( firstCell ) ;
+                offset                             += firstCell * gridWrapper.strides[ axis ] ;
+                gradientOffset                     += firstCell * gradientWrapper.strides[ axis ] ;
+            }
+            chunkGrid.values = reinterpret_cast< float * >( reinterpret_cast< char * >( gridWrapper.values ) + offset ) ;
+            if( gridWrapper.gradients )
+            {   // Gradients span the same part of their grid.
+                chunkGradients.values   = reinterpret_cast< float * >( reinterpret_cast< char * >( gradientWrapper.values ) + gradientOffset ) ;
+                chunkGrid.gradients     = & chunkGradients ;
+            }
+
+            Mesh_MakeFromVolume( GetIsosurfaceChunkMesh( chunkIndex ) , renderApi , 0.0f , & chunkGrid , vertFmt ) ;
+        }
+    }
+
+    {   // Remember values that chunk meshes now represent.
+        PERF_BLOCK( FluidScene__UpdateFluidIsosurface_RememberValues ) ;
+        if( layoutChanged )
+        {   // Every chunk was re-extracted.
+            mIsosurfaceExtractedValues.Resize( numPointsTotal ) ;
+            memcpy( mIsosurfaceExtractedValues.Data() , gridOfValues.Data() , numPointsTotal * sizeof( float ) ) ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {
+                mIsosurfaceNumPoints[ axis ] = gridOfValues.GetNumPoints( axis ) ;
+            }
+            mIsosurfaceMinCorner    = gridOfValues.GetMinCorner() ;
+            mIsosurfaceCellSpacing  = spacing ;
+        }
+        else
+        {   // Update only points that no chunk still represents with older values, so changes below tolerance cannot accumulate unnoticed.
+            const size_t numX = gridOfValues.GetNumPoints( 0 ) ;
+            const size_t numY = gridOfValues.GetNumPoints( 1 ) ;
+            const size_t numZ = gridOfValues.GetNumPoints( 2 ) ;
+            for( size_t iz = 0 ; iz < numZ ; ++ iz )
+            for( size_t iy = 0 ; iy < numY ; ++ iy )
+            for( size_t ix = 0 ; ix < numX ; ++ ix )
+            {   // For each grid point...
+                // Chunks that read a point lie within one chunk of the chunk containing it.  See IsIsosurfaceChunkStale.
+                const size_t    indices[ 3 ]    = { ix , iy , iz } ;
+                size_t          chunkLo[ 3 ] ;
+                size_t          chunkHi[ 3 ] ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {
+                    chunkLo[ axis ] = ( indices[ axis ] >= 2 ) ? ( indices[ axis ] - 2 ) / sIsosurfaceChunkSize : 0 ;
+                    chunkHi[ axis ] = Min2( ( indices[ axis ] + 1 ) / sIsosurfaceChunkSize , numChunks[ axis ] - 1 ) ;
+                }
+                bool allReadersExtracted = true ;
+                for( size_t cz = chunkLo[ 2 ] ; allReadersExtracted && ( cz <= chunkHi[ 2 ] ) ; ++ cz )
+                for( size_t cy = chunkLo[ 1 ] ; allReadersExtracted && ( cy <= chunkHi[ 1 ] ) ; ++ cy )
+                for( size_t cx = chunkLo[ 0 ] ; allReadersExtracted && ( cx <= chunkHi[ 0 ] ) ; ++ cx )
+                {   // For each chunk that could read this point...
+                    allReadersExtracted = isStale[ cx + numChunks[ 0 ] * ( cy + numChunks[ 1 ] * cz ) ] != 0 ;
+                }
+                if( allReadersExtracted )
+                {
+                    const size_t offset = ix + numX * ( iy + numY * iz ) ;
+                    mIsosurfaceExtractedValues[ offset ] = gridOfValues.Data()[ offset ] ;
+                }
+            }
+        }
+    }
+#else
+    MeshBase *  mesh        = GetFluidIsosurfaceModel()->GetModelData()->GetMesh( 0 ) ;
     Mesh_MakeFromVolume( mesh , renderApi , 0.0f , & gridWrapper , vertFmt ) ;
 #endif
+#endif
 }
 
 
@@ -575,6 +1092,10 @@ void FluidScene::UpdateTracerRenderingStyle()
         mDiagnosticTracerPass->SetActive( true ) ;
         mTracerDiagDyeFuelVertBufFiller.mIsActive = true ;
         break ;
+    case TRACER_RENDER_VOLUME_FIRE:
+    case TRACER_RENDER_VOLUME_DYE :
+        // Application renders grids instead of tracers, so leave all tracer passes inactive.
+        break ;
     }
 }
 
@@ -652,13 +1173,15 @@ FluidScene::TracerRenderingE FluidScene::CycleTracerRenderingStyle()
 {
     switch( mTracerRendering )
     {
-    case TRACER_RENDER_NONE      : SetTracerRenderingStyle( TRACER_RENDER_FUEL       ) ; break ;
-    case TRACER_RENDER_FUEL      : SetTracerRenderingStyle( TRACER_RENDER_FLAME      ) ; break ;
-    case TRACER_RENDER_FLAME     : SetTracerRenderingStyle( TRACER_RENDER_SMOKE      ) ; break ;
-    case TRACER_RENDER_SMOKE     : SetTracerRenderingStyle( TRACER_RENDER_FIRE       ) ; break ;
-    case TRACER_RENDER_FIRE      : SetTracerRenderingStyle( TRACER_RENDER_DYE        ) ; break ;
-    case TRACER_RENDER_DYE       : SetTracerRenderingStyle( TRACER_RENDER_DIAGNOSTIC ) ; break ;
-    case TRACER_RENDER_DIAGNOSTIC: SetTracerRenderingStyle( TRACER_RENDER_NONE       ) ; break ;
+    case TRACER_RENDER_NONE       : SetTracerRenderingStyle( TRACER_RENDER_FUEL        ) ; break ;
+    case TRACER_RENDER_FUEL       : SetTracerRenderingStyle( TRACER_RENDER_FLAME       ) ; break ;
+    case TRACER_RENDER_FLAME      : SetTracerRenderingStyle( TRACER_RENDER_SMOKE       ) ; break ;
+    case TRACER_RENDER_SMOKE      : SetTracerRenderingStyle( TRACER_RENDER_FIRE        ) ; break ;
+    case TRACER_RENDER_FIRE       : SetTracerRenderingStyle( TRACER_RENDER_DYE         ) ; break ;
+    case TRACER_RENDER_DYE        : SetTracerRenderingStyle( TRACER_RENDER_DIAGNOSTIC  ) ; break ;
+    case TRACER_RENDER_DIAGNOSTIC : SetTracerRenderingStyle( TRACER_RENDER_VOLUME_FIRE ) ; break ;
+    case TRACER_RENDER_VOLUME_FIRE: SetTracerRenderingStyle( TRACER_RENDER_VOLUME_DYE  ) ; break ;
+    case TRACER_RENDER_VOLUME_DYE : SetTracerRenderingStyle( TRACER_RENDER_NONE        ) ; break ;
     }
     return mTracerRendering ;
 }
@@ -695,6 +1218,8 @@ const char * FluidScene::GetTracerRenderingString() const
         CASE_STRING_FROM_TOKEN( TRACER_RENDER_FIRE       ) ;
         CASE_STRING_FROM_TOKEN( TRACER_RENDER_DYE        ) ;
         CASE_STRING_FROM_TOKEN( TRACER_RENDER_DIAGNOSTIC ) ;
+        CASE_STRING_FROM_TOKEN( TRACER_RENDER_VOLUME_FIRE ) ;
+        CASE_STRING_FROM_TOKEN( TRACER_RENDER_VOLUME_DYE ) ;
     }
     return "(invalid TracerRenderingE)" ;
 }
@@ -726,7 +1251,7 @@ PeGaSys::Render::ModelNode * FluidScene::AddFluidIsosurfaceModel()
 
     using namespace PeGaSys::Render ;
 
-    const VertexDeclaration::VertexFormatE vertFmt = VertexDeclaration::POSITION_NORMAL ;
+    const VertexDeclaration::VertexFormatE vertFmt = GetIsosurfaceVertexFormat() ;
 
     ModelNode * model       = FluidScene::AddDemoModel( Vec3( 0.0f , 0.0f , 0.0f ) , vertFmt , /* isHole */ false ) ;
     MeshBase *  mesh        = model->GetModelData()->GetMesh( 0 ) ;
@@ -738,6 +1263,8 @@ PeGaSys::Render::ModelNode * FluidScene::AddFluidIsosurfaceModel()
     // Placeholder geometry: zero-size sphere.
     Mesh_MakeSphere( mesh , renderApi , numSegments , /* radius */ 0.0f  , vertFmt ) ;
 
+    model->SetGpuPassLabel( "FluidIsosurface" ) ;  // Measure isosurface draw separately from rigid bodies.
+
     return model ;
 }
 
@@ -779,12 +1306,12 @@ PeGaSys::Render::ModelNode * FluidScene::AddDemoModel( const Vec3 & position , c
         {   // Requested vertex format includes texture coordinates, so create a texture.
             shapePass->AddTextureStage() ;
             TextureStage &  shapeTextureStage = shapePass->GetTextureStage( 0 ) ;
-            shapeTextureStage.mTexture = mRenderSystem->GetApi()->NewTexture() ;
-            {
-                Image image( 128 , 128 , 4 , 1 ) ;
-                ImgOpSeq_Noise( image , 0.9f , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) ) ;
-                shapeTextureStage.mTexture->CreateFromImages( & image , 1 ) ;
+            if( NULLPTR == mShapeTexture.Get() )
+            {   // Shape texture does not exist yet.  Create it once, then share it across shapes.
+                mShapeTexture = mRenderSystem->GetApi()->NewTexture() ;
+                EnqueueCachedTexture( mRenderSystem , mShapeTexture.Get() , MakeShapeImage , "TextureCache_Shape.pgimg" ) ;
             }
+            shapeTextureStage.mTexture = mShapeTexture ;
             shapeTextureStage.mSamplerState.mAddressU = SamplerState::ADDRESS_REPEAT ;
             shapeTextureStage.mSamplerState.mAddressV = SamplerState::ADDRESS_CLAMP  ;
 
@@ -803,7 +1330,7 @@ PeGaSys::Render::ModelNode * FluidScene::AddDemoModel( const Vec3 & position , c
             //    shapePass->GetRenderState().mMaterialProperties.mDiffuseColor = Vec4( 0.8f , 0.4f , 0.8f , 1.0f ) ;
             //}
         }
-        else if( VertexDeclaration::POSITION_NORMAL == vertexFormat )
+        else if( ( VertexDeclaration::POSITION_NORMAL == vertexFormat ) || ( VertexDeclaration::POSITION_NORMAL_PACKED == vertexFormat ) )
         {   // Vertices have positions and normals.
             // Hack: Assume this material is for fluid isosurface and set material to green shiny tranlucent.
             shapePass->GetRenderState().mRasterState.mCullMode = RasterStateS::CULL_MODE_NONE ; // Allow drawing from inside model
@@ -860,14 +1387,7 @@ PeGaSys::Render::ModelNode * FluidScene::AddSkyModel()
             shapePass->AddTextureStage() ;
             TextureStage &  shapeTextureStage = shapePass->GetTextureStage( 0 ) ;
             shapeTextureStage.mTexture = mRenderSystem->GetApi()->NewTexture() ;
-            {
-                const unsigned width = 128 , height = 128 , numChannels = 4 , numPages = 1 ;
-                Image image( width , height , numChannels , numPages ) ;
-                const Vec4 blankColor( 1.0f , 1.0f , 1.0f , 1.0f ) ;
-                const float gamma = 0.2f ; 
-                ImgOpSeq_GradientNoise( image , gamma , blankColor ) ;
-                shapeTextureStage.mTexture->CreateFromImages( & image , 1 ) ;
-            }
+            EnqueueCachedTexture( mRenderSystem , shapeTextureStage.mTexture.Get() , MakeSkyImage , "TextureCache_Sky.pgimg" ) ;
             shapeTextureStage.mSamplerState.mAddressU = SamplerState::ADDRESS_REPEAT ;
             shapeTextureStage.mSamplerState.mAddressV = SamplerState::ADDRESS_CLAMP ;
             shapePass->GetRenderState().mMaterialProperties.mAmbientColor = Vec4( 0.5f , 0.5f , 0.5f , 1.0f ) ;
@@ -916,92 +1436,71 @@ void MakeSimpleNoiseTexture( PeGaSys::Render::TextureStage::TexturePtr texture ,
 
 
 
-void MakeDiagnosticVortonTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeDiagnosticVortonTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeDiagnosticVortonTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeDiagnosticVortonImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeDiagnosticVortonImage , "TextureCache_DiagnosticVorton.pgimg" ) ;
 }
 
 
 
 
-void MakeDiagnosticSimpleVortonTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeDiagnosticSimpleVortonTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeDiagnosticSimpleVortonTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeDiagnosticSimpleVortonImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeDiagnosticSimpleVortonImage , "TextureCache_DiagnosticSimpleVorton.pgimg" ) ;
 }
 
 
 
 
-void MakeDyeTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeDyeTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeDyeTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeDyeImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeDyeImage , "TextureCache_Dye.pgimg" ) ;
 }
 
 
 
 
-void MakeDiagnosticTracerTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeDiagnosticTracerTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeDiagnosticTracerTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeDiagnosticTracerImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeDiagnosticTracerImage , "TextureCache_DiagnosticTracer.pgimg" ) ;
 }
 
 
 
 
-void MakeSmokeTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeSmokeTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeSmokeTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeSmokeImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeSmokeImage , "TextureCache_Smoke.pgimg" ) ;
 }
 
 
 
 
-void MakeFlameTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeFlameTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeFlameTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeFlameImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeFlameImage , "TextureCache_Flame.pgimg" ) ;
 }
 
 
 
 
-void MakeFuelTexture( PeGaSys::Render::TextureStage::TexturePtr texture )
+void MakeFuelTexture( PeGaSys::Render::System * renderSystem , PeGaSys::Render::TextureStage::TexturePtr texture )
 {
     PERF_BLOCK( MakeFuelTexture ) ;
 
-    PeGaSys::Image noiseBall ;
-    MakeFuelImage( noiseBall ) ;
-
-    texture->CreateFromImages( & noiseBall , 1 ) ;
+    EnqueueCachedTexture( renderSystem , texture.Get() , MakeFuelImage , "TextureCache_Fuel.pgimg" ) ;
 }
 
 
@@ -1019,7 +1518,7 @@ PeGaSys::Render::Pass * MakeDiagnosticTracerPass( PeGaSys::Render::System * rend
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeDiagnosticTracerTexture( textureStage.mTexture ) ;
+    MakeDiagnosticTracerTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
     pass->GetRenderState().mBlendState.SetAlpha() ;
@@ -1037,10 +1536,10 @@ PeGaSys::Render::Pass * MakeDyePass( PeGaSys::Render::System * renderSystem , Pe
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeDyeTexture( textureStage.mTexture ) ;
+    MakeDyeTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
-    pass->GetRenderState().mBlendState.SetAlpha() ;
+    pass->GetRenderState().mBlendState.SetOrderIndependentAlpha() ; // Accumulate in any order, so particles need no sort.
 
     return pass ;
 }
@@ -1055,10 +1554,10 @@ PeGaSys::Render::Pass * MakeFuelPass( PeGaSys::Render::System * renderSystem , P
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeFuelTexture( textureStage.mTexture ) ;
+    MakeFuelTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
-    pass->GetRenderState().mBlendState.SetAlpha() ;
+    pass->GetRenderState().mBlendState.SetOrderIndependentAlpha() ; // Accumulate in any order, so particles need no sort.
 
     return pass ;
 }
@@ -1073,10 +1572,10 @@ PeGaSys::Render::Pass * MakeSmokePass( PeGaSys::Render::System * renderSystem ,
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeSmokeTexture( textureStage.mTexture ) ;
+    MakeSmokeTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
-    pass->GetRenderState().mBlendState.SetAlpha() ;
+    pass->GetRenderState().mBlendState.SetOrderIndependentAlpha() ; // Accumulate in any order, so particles need no sort.
 
     return pass ;
 }
@@ -1091,10 +1590,10 @@ PeGaSys::Render::Pass * MakeFlamePass( PeGaSys::Render::System * renderSystem ,
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeFlameTexture( textureStage.mTexture ) ;
+    MakeFlameTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
-    pass->GetRenderState().mBlendState.SetAdditive() ; // NOTE: ADDITIVE (not ALPHA)
+    pass->GetRenderState().mBlendState.SetAdditive() ; // NOTE: ADDITIVE (not ALPHA), which commutes, so needs neither sorting nor order-independent transparency.
 
     return pass ;
 }
@@ -1109,7 +1608,7 @@ PeGaSys::Render::Pass * MakeDiagnosticVortonPass( PeGaSys::Render::System * rend
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeDiagnosticVortonTexture( textureStage.mTexture ) ;
+    MakeDiagnosticVortonTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
     pass->GetRenderState().mBlendState.SetAlpha() ;
@@ -1127,7 +1626,7 @@ PeGaSys::Render::Pass * MakeDiagnosticSimpleVortonPass( PeGaSys::Render::System
     pass->AddTextureStage() ;
     PeGaSys::Render::TextureStage &  textureStage = pass->GetTextureStage( 0 ) ;
     textureStage.mTexture = renderSystem->GetApi()->NewTexture() ;
-    MakeDiagnosticSimpleVortonTexture( textureStage.mTexture ) ;
+    MakeDiagnosticSimpleVortonTexture( renderSystem , textureStage.mTexture ) ;
 
     pass->GetRenderState().mDepthState.mDepthWriteEnabled = false ;
     pass->GetRenderState().mBlendState.SetAlpha() ;
@@ -1158,7 +1657,12 @@ PeGaSys::Render::ModelNode * FluidScene::AddFluidParticleSystemModel( ParticleSy
 
     ParticlesRender::ParticlesRenderModel * pclRenderModel   = NULLPTR ;
 
+#if USE_INSTANCED_PARTICLE_BILLBOARDS
+    ASSERT( OpenGL_VertexBuffer::IsBillboardInstanceSupported() ) ;
+    VertexDeclaration  vertexDeclaration( VertexDeclaration::BILLBOARD_INSTANCE ) ;
+#else
     VertexDeclaration  vertexDeclaration( VertexDeclaration::POSITION_COLOR_TEXTURE ) ;
+#endif
 
     if( mRenderSystem && mRenderSystem->GetApi() )
     {
@@ -1308,6 +1812,13 @@ void FluidScene::Clear()
     mFluidIsosurfaceModel       = NULLPTR ;
     mFluidParticleSystemModel   = NULLPTR ;
 
+    // Isosurface chunk meshes went with the isosurface model.
+    mIsosurfaceChunkMeshes.Clear() ;
+    mIsosurfaceExtractedValues.Clear() ;
+    memset( mIsosurfaceNumPoints , 0 , sizeof( mIsosurfaceNumPoints ) ) ;
+
+    mShapeTexture.Reset() ;
+
     // Remove viewports from target; The viewpors in this target referenced camera node, which was just erased above.
     mWindow->Clear() ;
 }
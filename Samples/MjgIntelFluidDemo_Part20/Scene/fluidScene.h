@@ -12,9 +12,11 @@
 #include <Particles/particleSystemManager.h>
 
 #include <Render/Resource/vertexBuffer.h>
+#include <Render/Resource/textureSampler.h>
 
 #include <Image/image.h>
 
+#include <Core/SpatialPartition/nestedGrid.h>
 #include <Core/SpatialPartition/uniformGrid.h>
 
 #include <Core/Math/vec3.h>
@@ -34,6 +36,7 @@ namespace PeGaSys
         class Camera ;
         class Light ;
         class ModelNode ;
+        class MeshBase ;
         class Pass ;
     }
 
@@ -83,6 +86,8 @@ public:
         TRACER_RENDER_FIRE          ,   ///< Render fuel, flame and smoke.
         TRACER_RENDER_DYE           ,   ///< Render only density as a two-color dye.
         TRACER_RENDER_DIAGNOSTIC    ,   ///< Render only density as a two-color dye.
+        TRACER_RENDER_VOLUME_FIRE   ,   ///< Do not render tracer particles; instead, the application ray-marches flame and smoke grids.
+        TRACER_RENDER_VOLUME_DYE    ,   ///< Do not render tracer particles; instead, the application ray-marches the density grid as a two-color dye.
         TRACER_RENDER_MAX           ,   ///< Special value indicating one past last legal value
     } ;
     struct SpectralComponent
@@ -121,6 +126,7 @@ public:
     void SetTracerRenderingStyle( TracerRenderingE tracerRenderingStyle ) ;
     void SetVortonRenderingStyle( VortonRenderingE vortonRenderingStyle ) ;
 
+    TracerRenderingE    GetTracerRenderingStyle() const { return mTracerRendering ; }
     VortonRenderingE    GetVortonRenderingStyle() const { return mVortonRendering ; }
     TracerRenderingE    CycleTracerRenderingStyle() ;
     VortonRenderingE    CycleVortonRenderingStyle() ;
@@ -129,7 +135,7 @@ public:
 
     PeGaSys::Render::ModelNode * GetFluidIsosurfaceModel() { return mFluidIsosurfaceModel ; }
 
-    void UpdateFluidIsosurface( const UniformGrid< float > & gridOfValues ) ;
+    void UpdateFluidIsosurface( const UniformGrid< float > & gridOfValues , const UniformGrid< Vec3 > * gradientGrid = NULLPTR , bool gradientPointsInward = false ) ;
 
     void Clear() ;
 
@@ -157,6 +163,12 @@ private:
     void UpdateTracerRenderingStyle() ;
     void UpdateVortonRenderingStyle() ;
 
+    bool IsIsosurfaceLayoutUnchanged( const UniformGrid< float > & gridOfValues ) const ;
+    bool IsIsosurfaceChunkStale( const UniformGrid< float > & gridOfValues , const size_t chunkIndices[ 3 ] , float tolerance ) const ;
+    PeGaSys::Render::MeshBase * GetIsosurfaceChunkMesh( size_t chunkIndex ) ;
+    size_t ChooseIsosurfaceLod( const UniformGridGeometry & gridOfValues ) ;
+    void ExtractFluidIsosurface( const UniformGrid< float > & gridOfValues , const UniformGrid< Vec3 > * gradientGrid , bool gradientPointsInward ) ;
+
     PeGaSys::Render::System *           mRenderSystem               ;   /// Shallow pointer
     PeGaSys::Render::SceneManagerBase * mSceneManager               ;   /// Shallow pointer
     PeGaSys::Render::Window *           mWindow                     ;   /// Shallow pointer
@@ -177,6 +189,8 @@ private:
     PeGaSys::Render::Pass *             mDiagnosticVortonPass       ;
     PeGaSys::Render::Pass *             mDiagnosticSimpleVortonPass ;
 
+    PeGaSys::Render::TextureStage::TexturePtr   mShapeTexture   ;   ///< Noise texture shared by all demo shape models, so their passes can be equivalent and render as a batch.
+
     //PeGaSys::Render::ModelNode *        mModels[ NUM_MODELS ]       ;   /// Not used
 
     PeGaSys::Render::Light *            mLights[ NUM_LIGHTS ]       ;
@@ -194,6 +208,17 @@ private:
     PeGaSys::ParticlesRender::ParticlesRenderModel::VertexBufferFillerGeneric   mVortonVertBufFiller            ;
 
     PeGaSys::ParticlesRender::ParticlesRenderModel::PclSysVertexBufferFillerContainers  mPclSysVertBufFillerContainers ;
+
+    // Change tracking for fluid isosurface, which consists of one mesh per chunk of grid cells:
+    VECTOR< PeGaSys::Render::MeshBase * >   mIsosurfaceChunkMeshes      ;   ///< Shallow pointers to mesh of each chunk, which mFluidIsosurfaceModel owns.
+    VECTOR< float >                         mIsosurfaceExtractedValues  ;   ///< Grid values that chunk meshes currently represent, per grid point.
+    size_t                                  mIsosurfaceNumPoints[ 3 ]   ;   ///< Number of grid points, along each direction, that mIsosurfaceExtractedValues spans.
+    Vec3                                    mIsosurfaceMinCorner        ;   ///< Location of first grid point that mIsosurfaceExtractedValues spans.
+    Vec3                                    mIsosurfaceCellSpacing      ;   ///< Distance between adjacent grid points that mIsosurfaceExtractedValues spans.
+
+    // Level of detail for fluid isosurface:
+    NestedGrid< float >                     mIsosurfaceLodGrids         ;   ///< Coarser copies of the grid the isosurface comes from, where layer L holds level L+1.
+    size_t                                  mIsosurfaceLod              ;   ///< Level of detail the isosurface last used, where 0 is full resolution.
 } ;
 
 #endif
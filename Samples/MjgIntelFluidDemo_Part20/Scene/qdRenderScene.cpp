@@ -7,6 +7,8 @@
 
 #include "inteSiVis.h"
 
+#include "Particles/Operation/pclOpEvolve.h"
+
 #include "Core/Performance/perfBlock.h"
 
 
@@ -143,7 +145,7 @@ void InteSiVis::QdRenderParticleDiagnostics()
         ||  ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_ALL       )  )
     {   // Vorton Pathline rendering is enabled.
 #if ENABLE_PARTICLE_POSITION_HISTORY
-        QdRenderDiagnosticPathlines( reinterpret_cast< VECTOR< Particle > & >( * mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVortons() ) ) ;
+        QdRenderDiagnosticPathlines( mVortonPclGrpInfo.mPclOpEvolve->GetPositionHistory() ) ;
 #endif
     }
 }
@@ -19,6 +19,8 @@
 #include "Core/Math/vec3.h"
 #include "Core/SpatialPartition/uniformGrid.h"
 #include "Core/Performance/perfBlock.h"
+#include "Core/Math/math.h"
+#include "Core/parallelExecution.h"
 
 
 
@@ -31,6 +33,112 @@ const float sNegligibleVorticityThreshold = sqrtf( sNegligibleEnstrophyThreshold
 
 
 
+/** Regular lattice of candidate vorton positions, and what each vorton at them gets.
+*/
+struct VortonLattice
+{
+    const IVorticityDistribution *  mVorticityDistribution  ;   ///< Distribution from which to assign vorticity and density.
+    Vec3                            mMinCorner              ;   ///< Position of minimal corner of lattice, in local coordinates.
+    Vec3                            mCellSize               ;   ///< Size of each lattice cell.
+    Vec3                            mCenter                 ;   ///< Center of vorticity distribution.
+    Vec3                            mTranslation            ;   ///< Local-to-world offset applied to each vorton.
+    size_t                          mNumCells[3]            ;   ///< Number of lattice cells along each axis.
+    float                           mVorticityScale         ;   ///< Factor by which to multiply vorticity the distribution assigns.
+    float                           mVortonRadius           ;   ///< Radius of each vorton.
+    float                           mJitter                 ;   ///< Fraction of a cell by which each vorton can move from its cell center.
+} ;
+
+
+
+
+/** Return pseudo-random value in [0,1) that depends only on the given integers.
+
+    Unlike rand, this has no state, so threads can call it in any order
+    and still get results that do not depend on scheduling.
+*/
+static float HashToUnitInterval( size_t ix , size_t iy , size_t iz , unsigned salt )
+{
+    unsigned hash = unsigned( ix ) * 73856093u ^ unsigned( iy ) * 19349663u ^ unsigned( iz ) * 83492791u ^ salt * 2654435761u ;
+    // Mix bits (Wang hash) so nearby cells get unrelated values.
+    hash = ( hash ^ 61u ) ^ ( hash >> 16 ) ;
+    hash *= 9u ;
+    hash ^= hash >> 4 ;
+    hash *= 0x27d4eb2du ;
+    hash ^= hash >> 15 ;
+    return float( hash >> 8 ) * ( 1.0f / 16777216.0f ) ;
+}
+
+
+
+
+/** Evaluate vorticity distribution at (a subset of) lattice cells.
+
+    \param lattice      Lattice of candidate vorton positions.
+
+    \param candidates   (out) Vorton for each lattice cell, indexed x-fastest.
+
+    \param significant  (out) Whether each candidate has significant vorticity, so should become a vorton.
+
+    \param iRowStart    Index of first row of cells to evaluate.  Rows run along x; row index is iy + numCells[1] * iz.
+
+    \param iRowEnd      Index past last row of cells to evaluate.
+
+    Each cell gets a single candidate placed at its center, or, with nonzero
+    jitter, at a pseudo-random offset from it.  That stratified placement
+    keeps every pair of vortons at least ( 1 - jitter ) cells apart, so
+    vortons avoid both clumps and the aliasing a perfect lattice causes.
+*/
+static void AssignVortonsSlice( const VortonLattice & lattice , Vorton * candidates , unsigned char * significant , size_t iRowStart , size_t iRowEnd )
+{
+    const size_t numCellsX = lattice.mNumCells[ 0 ] ;
+    const size_t numCellsY = lattice.mNumCells[ 1 ] ;
+    static const float offset = 0.5f ;  // Visit center of each cell.
+    for( size_t iRow = iRowStart ; iRow < iRowEnd ; ++ iRow )
+    {   // For each row of cells in this subset...
+        const size_t iy = iRow % numCellsY ;
+        const size_t iz = iRow / numCellsY ;
+        for( size_t ix = 0 ; ix < numCellsX ; ++ ix )
+        {   // For each cell in this row...
+            Vec3 positionInCell( offset , offset , offset ) ;
+            if( lattice.mJitter > 0.0f )
+            {   // Displace position within its cell.
+                positionInCell.x += lattice.mJitter * ( HashToUnitInterval( ix , iy , iz , 0 ) - 0.5f ) ;
+                positionInCell.y += lattice.mJitter * ( HashToUnitInterval( ix , iy , iz , 1 ) - 0.5f ) ;
+                positionInCell.z += lattice.mJitter * ( HashToUnitInterval( ix , iy , iz , 2 ) - 0.5f ) ;
+            }
+            const Vec3 positionLocal(   ( float( ix ) + positionInCell.x ) * lattice.mCellSize.x + lattice.mMinCorner.x
+                                    ,   ( float( iy ) + positionInCell.y ) * lattice.mCellSize.y + lattice.mMinCorner.y
+                                    ,   ( float( iz ) + positionInCell.z ) * lattice.mCellSize.z + lattice.mMinCorner.z ) ;
+            Vec3 vorticity ;
+            float density ;
+            lattice.mVorticityDistribution->AssignVorton( vorticity , density , positionLocal , lattice.mCenter ) ;
+            ASSERT( density > 0.0f ) ;
+            const size_t    offsetXYZ       = ix + numCellsX * iRow ;
+            const Vec3      positionGlobal  = positionLocal + lattice.mTranslation ;
+            Vorton &        vorton          = candidates[ offsetXYZ ] ;
+            vorton = Vorton( positionGlobal , vorticity * lattice.mVorticityScale , lattice.mVortonRadius ) ;
+            significant[ offsetXYZ ] = vorticity.Mag2() > sNegligibleEnstrophyThreshold ;
+            if( significant[ offsetXYZ ] )
+            {   // Vorticity is significantly non-zero.
+                vorton.mDensity     = density ;
+                ASSERT( density > 0.0f ) ;
+            #if ENABLE_FIRE
+                vorton.mFuelFraction  = 0.0f ;
+                vorton.mFlameFraction = 0.0f ;
+                vorton.mSmokeFraction = 0.0f ;
+            #endif
+                //if( density < 0.0f )
+                //{ // HACK: set size to negative so renderer colors this vorton as "light" instead of "heavy"
+                //    vorton.mSize *= -1.0f ;
+                //}
+            }
+        }
+    }
+}
+
+
+
+
 /** Addend 2 place-holder vortons at the corners of a bounding box.
 
     \param vortons (out) Array of vortex particles.
@@ -86,8 +194,17 @@ void AddCornerVortons( VECTOR<Vorton> & vortons , const Vec3 & vMin , const Vec3
                     be centered about its local origin.  Think of
                     "translation" as a local-to-world translation.
 
+    \param jitter - fraction of a cell by which each vorton can move from
+                    the center of its cell, in [0,1].  Zero places vortons
+                    on a regular lattice.  Nonzero values give stratified,
+                    blue-noise placement; see AssignVortonsSlice.
+
+    This evaluates the distribution at lattice cells in parallel, then
+    appends vortons in lattice order, so results do not depend on the
+    number of threads.
+
 */
-void AssignVortons( VECTOR<Vorton> & vortons , float fMagnitude , unsigned numVortonsMax , const IVorticityDistribution & vorticityDistribution , Vec3 translation )
+void AssignVortons( VECTOR<Vorton> & vortons , float fMagnitude , unsigned numVortonsMax , const IVorticityDistribution & vorticityDistribution , Vec3 translation , float jitter )
 {
     PERF_BLOCK( AssignVortons ) ;
 
@@ -145,41 +262,40 @@ void AssignVortons( VECTOR<Vorton> & vortons , float fMagnitude , unsigned numVo
     AddCornerVortons( vortons , vMin , vMin + vDimensions , vortonRadius ) ;
 #endif
 
-    Vec3        positionLocal            = Vec3( 0.0f , 0.0f , 0.0f ) ;  // vorton positionLocal
-    unsigned    index[3]            ;   // index of each positionLocal visited
-    static const float offset = 0.5f ;  // Visit center of each cell.
-    // Iterate through each point in a uniform grid.
-    for( index[2] = 0 ; index[2] < numCells[2] ; ++ index[2] )
-    {   // For each z-coordinate...
-        positionLocal.z = ( float( index[2] ) + offset ) * gridCellSize.z + vMin.z ;
-        for( index[1] = 0 ; index[1] < numCells[1] ; ++ index[1] )
-        {   // For each y-coordinate...
-            positionLocal.y = ( float( index[1] ) + offset ) * gridCellSize.y + vMin.y ;
-            for( index[0] = 0 ; index[0] < numCells[0] ; ++ index[0] )
-            {   // For each x-coordinate...
-                positionLocal.x = ( float( index[0] ) + offset ) * gridCellSize.x + vMin.x ;
-                Vec3 vorticity ;
-                float density ;
-                vorticityDistribution.AssignVorton( vorticity , density , positionLocal , vCenter ) ;
-                ASSERT( density > 0.0f ) ;
-                const Vec3 positionGlobal = positionLocal + translation ;
-                Vorton vorton( positionGlobal , vorticity * fMagnitude * volRatio , vortonRadius ) ;
-                if( vorticity.Mag2() > sNegligibleEnstrophyThreshold )
-                {   // Vorticity is significantly non-zero.
-                    vorton.mDensity     = density ;
-                    ASSERT( density > 0.0f ) ;
-                #if ENABLE_FIRE
-                    vorton.mFuelFraction  = 0.0f ;
-                    vorton.mFlameFraction = 0.0f ;
-                    vorton.mSmokeFraction = 0.0f ;
-                #endif
-                    //if( density < 0.0f )
-                    //{ // HACK: set size to negative so renderer colors this vorton as "light" instead of "heavy"
-                    //    vorton.mSize *= -1.0f ;
-                    //}
-                    vortons.PushBack( vorton ) ;
-                }
-            }
+    ASSERT( ( jitter >= 0.0f ) && ( jitter <= 1.0f ) ) ;
+
+    VortonLattice lattice ;
+    lattice.mVorticityDistribution  = & vorticityDistribution ;
+    lattice.mMinCorner              = vMin ;
+    lattice.mCellSize               = gridCellSize ;
+    lattice.mCenter                 = vCenter ;
+    lattice.mTranslation            = translation ;
+    lattice.mNumCells[ 0 ]          = numCells[ 0 ] ;
+    lattice.mNumCells[ 1 ]          = numCells[ 1 ] ;
+    lattice.mNumCells[ 2 ]          = numCells[ 2 ] ;
+    lattice.mVorticityScale         = fMagnitude * volRatio ;
+    lattice.mVortonRadius           = vortonRadius ;
+    lattice.mJitter                 = jitter ;
+
+    // Evaluate every cell into its own slot, so threads need not coordinate.
+    const size_t                numRows         = numCells[ 1 ] * numCells[ 2 ] ;
+    const size_t                numCandidates   = numCells[ 0 ] * numRows ;
+    VECTOR< Vorton >            candidates( numCandidates ) ;
+    VECTOR< unsigned char >     significant( numCandidates ) ;  // Not VECTOR< bool >, whose elements share bytes, so threads writing adjacent elements would race.
+    Parallel::For( 0 , numRows , Parallel::GetGrainSize( numRows ) , Parallel::Function( AssignVortonsSlice , lattice , & candidates[ 0 ] , & significant[ 0 ] ) ) ;
+
+    // Keep candidates that have significant vorticity, in lattice order.
+    size_t numSignificant = 0 ;
+    for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+    {   // For each candidate...
+        numSignificant += significant[ iCandidate ] ;
+    }
+    vortons.Reserve( vortons.Size() + numSignificant ) ;
+    for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+    {   // For each candidate...
+        if( significant[ iCandidate ] )
+        {
+            vortons.PushBack( candidates[ iCandidate ] ) ;
         }
     }
 }
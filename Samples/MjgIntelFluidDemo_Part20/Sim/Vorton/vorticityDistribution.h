@@ -32,6 +32,7 @@
 #include <math.h>
 
 #include "Core/Math/vec3.h"
+#include "Core/Math/counterRng.h"
 #include "Core/wrapperMacros.h"
 #include "VortonFluid/vorton.h"
 
@@ -342,7 +343,7 @@ class DensityBall : public IVorticityDistribution
 
             if( rho < mRadius )
             {   // Probe position is inside ball.
-                vorticity = RandomSpread( Vec3( 0.001f , 0.001f , 0.001f ) ) ;  // Enough vorticity to emit a vorton, not enough to influence motion
+                vorticity = CounterRng().SpreadAt( Vec3( 0.001f , 0.001f , 0.001f ) , position ) ;  // Enough vorticity to emit a vorton, not enough to influence motion
                 // density = mDensity * ( mRadius - rho ) ;
                 density = mDensity ;
             }
@@ -392,7 +393,7 @@ class DensityGradientBall : public IVorticityDistribution
 
             if( rho < mRadius )
             {   // Probe position is inside ball.
-                vorticity = RandomSpread( Vec3( 0.001f , 0.001f , 0.001f ) ) ;  // Enough vorticity to emit a vorton, not enough to influence motion
+                vorticity = CounterRng().SpreadAt( Vec3( 0.001f , 0.001f , 0.001f ) , position ) ;  // Enough vorticity to emit a vorton, not enough to influence motion
                 // density = mDensity * ( mRadius - rho ) ;
                 density = mDensityGradient * ( mRadius - rho ) ;
             }
@@ -439,7 +440,7 @@ class DensityBox : public IVorticityDistribution
 
             if( inside )
             {   // Probe position is inside box.
-                vorticity = RandomSpread( Vec3( 0.001f , 0.001f , 0.001f ) ) ;  // Enough vorticity to emit a vorton, not enough to influence motion
+                vorticity = CounterRng().SpreadAt( Vec3( 0.001f , 0.001f , 0.001f ) , position ) ;  // Enough vorticity to emit a vorton, not enough to influence motion
                 density   = mDensity ;
             }
             else
@@ -548,9 +549,9 @@ class VortexNoise : public IVorticityDistribution
         }
 
         /// Assign vorton properties consistent with this distribution.
-        virtual void AssignVorton( Vec3 & vorticity , float & density , const Vec3 & /* position */ , const Vec3 & /* vCenter */ ) const
-        {
-            vorticity = RandomSpread( mAmplitude ) ;
+        virtual void AssignVorton( Vec3 & vorticity , float & density , const Vec3 & position , const Vec3 & /* vCenter */ ) const
+        {   // AssignVortons calls this from multiple threads, so key noise by position instead of using a serial generator.
+            vorticity = CounterRng().SpreadAt( mAmplitude , position ) ;
             density   = 1.0f + FLT_EPSILON ; // Slightly positive so that thermal diffusion doesn't cause a sudden global jump.
         }
 
@@ -564,6 +565,6 @@ class VortexNoise : public IVorticityDistribution
 // Public functions --------------------------------------------------------------
 
 extern void AddCornerVortons( VECTOR<Vorton> & vortons , const Vec3 & vMin , const Vec3 & vMax ) ;
-extern void AssignVortons( VECTOR<Vorton> & vortons , float fMagnitude , unsigned numVortonsMax , const IVorticityDistribution & vorticityDistribution , Vec3 translation = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+extern void AssignVortons( VECTOR<Vorton> & vortons , float fMagnitude , unsigned numVortonsMax , const IVorticityDistribution & vorticityDistribution , Vec3 translation = Vec3( 0.0f , 0.0f , 0.0f ) , float jitter = 0.0f ) ;
 
 #endif
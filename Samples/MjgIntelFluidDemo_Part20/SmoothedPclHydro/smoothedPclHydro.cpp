@@ -19,23 +19,82 @@
 #include <algorithm>
 
 #include "Core/Math/Vec2.h"
+#include "Core/Math/counterRng.h"
 
-#include "Core/useTbb.h"
+#include "Core/parallelExecution.h"
 
 #include "Core/Performance/perfBlock.h"
 
+#include "Core/Memory/frameArena.h"
+
 #include "Core/SpatialPartition/uniformGridMath.h"
 
 #include "Particles/Operation/pclOpFindBoundingBox.h"
 
 #include "VortonFluid/vortonSim.h"
 
+#include "sphNeighborList.h"
+#include "sphDensityConstraints.h"
+#include "sphKernelTable.h"
+
 #include "FluidBodySim/fluidBodySim.h"  // Included for experimental poisoning feature.
 
+#include "Kernels/fluidKernels.h"
+
 
 // Whether to use the normalized form of SPH smoothing kernel when computing number density.
 #define USE_NORMALIZED_SPH_FORM_FOR_NUMBER_DENSITY 0
 
+/** Whether to enforce incompressibility using position-based density constraints, instead of pressure from an equation of state.
+
+    Explicit equation-of-state pressure needs small time steps to remain
+    stable.  Density constraints (see SolveSphDensityConstraints) remain
+    stable at time steps several times larger, at the cost of a few solver
+    iterations per step.  This requires USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH.
+*/
+#define USE_SPH_DENSITY_CONSTRAINTS 0
+
+
+/// Per-particle accelerations, which only live during one Update, so they come from the frame arena instead of the global heap.
+typedef VECTOR< Vec3 , FrameArenaAllocator< Vec3 > > AccelerationArray ;
+
+/// Per-pair smoothing function gradients, cached by one pass over neighbor pairs for a later pass to reuse.  See ComputeSphDensityAndMassDensityGradient_Grid.
+typedef VECTOR< Vec3 , FrameArenaAllocator< Vec3 > > GradientKernelArray ;
+
+/// Per-particle scalars that only live during one pass.
+typedef VECTOR< float , FrameArenaAllocator< float > > ParticleScalarArray ;
+
+/// Passes of ComputeSphDensityAndMassDensityGradient_Grid.
+enum SphDensityAndGradientPassE
+{
+    SPH_PASS_DENSITY_AND_GRADIENT_KERNEL    ,   ///< Accumulate densities, and cache gradient of smoothing function for each pair.
+    SPH_PASS_MASS_DENSITY_GRADIENT              ///< Accumulate mass density gradients from cached smoothing function gradients.
+} ;
+
+/// Arrays that both passes of ComputeSphDensityAndMassDensityGradient_Grid read or write.
+struct SphDensityAndGradientArrays
+{
+    VECTOR< SphFluidDensities > &   mFluidDensitiesAtPcls   ; ///< Array of particle densities.  Elements map one-to-one with mParticles.
+    VECTOR< Vec3 > &                mMassDensityGradients   ; ///< Array of mass density gradients.  Elements map one-to-one with mParticles.
+    GradientKernelArray &           mGradientKernels        ; ///< Array of smoothing function gradients.  Elements map one-to-one with neighbor pairs.
+    const ParticleScalarArray &     mExcessMassDensities    ; ///< Array of particle mass densities in excess of ambient.  Elements map one-to-one with mParticles.
+    const VECTOR< Vorton > &        mParticles              ; ///< Array of particles whose densities to calculate.
+    const VECTOR< float > &         mProximities            ; ///< Array of particle-to-wall partially truncated signed distances.
+    const SphNeighborList &         mNeighborList           ; ///< Candidate neighbor pairs.
+    const float                     mAmbientDensity         ; ///< Density of fluid in the absence of fluid particles.
+} ;
+
+/// Arrays that ComputeSphMassDensityGradient_Grid reads or writes.
+struct SphMassDensityGradientArrays
+{
+    VECTOR< Vec3 > &                        mMassDensityGradients   ; ///< Array of mass density gradients.  Elements map one-to-one with mParticles.
+    const VECTOR< SphFluidDensities > &     mFluidDensitiesAtPcls   ; ///< Array of particle densities.  Elements map one-to-one with mParticles.
+    const VECTOR< Vorton > &                mParticles              ; ///< Array of particles whose mass density gradients to calculate.
+    const VECTOR< float > &                 mProximities            ; ///< Array of particle-to-wall partially truncated signed distances.
+    const SphNeighborList &                 mNeighborList           ; ///< Candidate neighbor pairs.
+    const float                             mAmbientDensity         ; ///< Density of fluid in the absence of fluid particles.
+} ;
+
 
 /** SPH fluid parameters.
 
@@ -125,203 +184,90 @@ static const float sClosestPackedSphereDensity  = PI / sSqrt18 ;    // Average d
 static const float sHardCoreRadius               = 0.001f ;
 static const float sHardCoreRadius2              = Pow2( sHardCoreRadius ) ;
 static const Vec3  sTinyJiggle( sHardCoreRadius , sHardCoreRadius , sHardCoreRadius ) ;
-
-#if USE_TBB && USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
-
-    static void ComputeSphDensityAtParticles_Grid_Slice( VECTOR< SphFluidDensities > & fluidDensitiesAtPcls , const VECTOR< Vorton > & particles , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , size_t izStart , size_t izEnd , VortonSim::PhaseE phase ) ;
-
-    /** Function object to compute particle number density using Threading Building Blocks.
-    */
-    class SphSim_ComputeSphNumberDensityAtParticles_TBB
-    {
-            VECTOR< SphFluidDensities > &               mFluidDensitiesAtPcls   ; ///< Array of particle density.  Elements map one-to-one with mParticles.
-            const VECTOR< Vorton > &                    mParticles              ; ///< Array of particles whose number density to accumulate.
-            const UniformGrid< VECTOR< unsigned > > &   mPclIndicesGrid         ; ///< Reference to uniform grid of particle indices
-            VortonSim::PhaseE                           mPhase                  ; ///< Processing phase: whether to run on odd, even or both values for z slice.
-
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute number density for subset of domain.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                ComputeSphDensityAtParticles_Grid_Slice( mFluidDensitiesAtPcls , mParticles , mPclIndicesGrid , r.begin() , r.end() , mPhase ) ;
-            }
-
-            SphSim_ComputeSphNumberDensityAtParticles_TBB(
-                  VECTOR< SphFluidDensities > &             fluidDensitiesAtPcls
-                , const VECTOR< Vorton > &                  particles
-                , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                , VortonSim::PhaseE                         phase
-                )
-                : mFluidDensitiesAtPcls( fluidDensitiesAtPcls )
-                , mParticles( particles )
-                , mPclIndicesGrid( pclIndicesGrid )
-                , mPhase( phase )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+static const CounterRng sTinyJiggleRng ;
 
 
 
 
-    static void ComputeSphPressureGradientAcceleration_Grid_Slice( VECTOR< Vec3 > & accelerations
-        , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
-        , const VECTOR< Vorton > & particles
-        , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-        , size_t izStart
-        , size_t izEnd
-        , VortonSim::PhaseE phase ) ;
+/** Return random separation to impose between particles A and B, when they are too close.
 
-    /** Function object to compute pressure gradient acceleration using Threading Building Blocks.
-    */
-    class SphSim_ComputeSphPressureGradientAcceleration_TBB
+    This keys the jiggle by the pair, not by a serial generator, so threads can
+    call it in any order.  Swapping A and B negates the result, as it negates
+    their separation, so both particles of a pair see consistent jiggles.
+*/
+static inline Vec3 TinyJiggle( size_t idxA , size_t idxB )
+{
+    if( idxA < idxB )
     {
-            VECTOR< Vec3 > &                            mAccelerations          ; ///< Array of particle accelerations.  Elements map one-to-one with mParticles.
-            const VECTOR< SphFluidDensities > &         mFluidDensitiesAtPcls   ; ///< Array of particle number density.  Elements map one-to-one with mParticles.
-            const VECTOR< Vorton > &                    mParticles              ; ///< Array of particles whose accelerations to calculate.
-            const UniformGrid< VECTOR< unsigned > > &   mPclIndicesGrid         ; ///< Reference to uniform grid of particle indices
-            VortonSim::PhaseE                           mPhase                  ; ///< Processing phase: whether to run on odd, even or both values for z slice.
-
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute particle acceleration due to pressure gradients for subset of domain.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                ComputeSphPressureGradientAcceleration_Grid_Slice( mAccelerations , mFluidDensitiesAtPcls , mParticles , mPclIndicesGrid , r.begin() , r.end() , mPhase ) ;
-            }
-
-            SphSim_ComputeSphPressureGradientAcceleration_TBB(
-                  VECTOR< Vec3 > &                          accelerations
-                , const VECTOR< SphFluidDensities > &       fluidDensitiesAtPcls
-                , const VECTOR< Vorton > &                  particles
-                , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                , VortonSim::PhaseE                         phase
-                )
-                : mAccelerations( accelerations )
-                , mFluidDensitiesAtPcls( fluidDensitiesAtPcls )
-                , mParticles( particles )
-                , mPclIndicesGrid( pclIndicesGrid )
-                , mPhase( phase )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
-
-
-
+        return sTinyJiggleRng.Spread( sTinyJiggle , unsigned( idxA ) , unsigned( idxB ) ) ;
+    }
+    return - sTinyJiggleRng.Spread( sTinyJiggle , unsigned( idxB ) , unsigned( idxA ) ) ;
+}
 
 
-    static void ComputeSphMassDensityGradient_Grid_Slice( VECTOR< Vec3 > & massDensityGradients
-        , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
-        , const VECTOR< Vorton > & particles
-        , const VECTOR< float > & proximities
-        , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-        , const float ambientDensity
-        , size_t izStart
-        , size_t izEnd
-        , VortonSim::PhaseE phase ) ;
+/** Pair function object which buffers pairs for an SPH accumulator, and evaluates their smoothing kernel a batch at a time using ISPC kernels.
 
-    /** Function object to compute mass density gradient using Threading Building Blocks.
-    */
-    class SphSim_ComputeSphMassDensityGradient_TBB
-    {
-            VECTOR< Vec3 > &                            mMassDensityGradients   ; ///< Array of mass density gradients.  Elements map one-to-one with mParticles.
-            const VECTOR< SphFluidDensities > &         mFluidDensitiesAtPcls   ; ///< Array of particle densities.  Elements map one-to-one with mParticles.
-            const VECTOR< Vorton > &                    mParticles              ; ///< Array of particles whose accelerations to calculate.
-            const VECTOR< float > &                     mProximities            ; ///< Array of particle-to-wall partially truncated signed distances.
-            const UniformGrid< VECTOR< unsigned > > &   mPclIndicesGrid         ; ///< Reference to uniform grid of particle indices
-            const float                                 mAmbientDensity         ; ///< Density of fluid in the absence of fluid particles
-            VortonSim::PhaseE                           mPhase                  ; ///< Processing phase: whether to run on odd, even or both values for z slice.
-
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute particle acceleration due to pressure gradients for subset of domain.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                ComputeSphMassDensityGradient_Grid_Slice( mMassDensityGradients , mFluidDensitiesAtPcls , mParticles , mProximities , mPclIndicesGrid , mAmbientDensity , r.begin() , r.end() , mPhase ) ;
-            }
+    Pairs inside the hard core go to the accumulator's own operator(), which
+    separates them.  Pairs beyond the influence radius go nowhere.  Others go
+    to the accumulator's AccumulateKernel.  Accumulation stays serial, since
+    pairs in a batch can share particles.  Callers must call Flush after the last pair.
+*/
+template< class AccumulatorT > class SphPairBatch
+{
+    public:
+        SphPairBatch( AccumulatorT & accumulator , const FluidKernelTable & ispcKernels , const VECTOR< Vorton > & particles , float influenceRadius , float hardCoreRadius )
+            : mAccumulator( accumulator )
+            , mIspcKernels( ispcKernels )
+            , mParticles( particles )
+            , mInvInflRad2( 1.0f / ( influenceRadius * influenceRadius ) )
+            , mHardCoreRadius( hardCoreRadius )
+        {}
 
-            SphSim_ComputeSphMassDensityGradient_TBB(
-                  VECTOR< Vec3 > &                          massDensityGradients
-                , const VECTOR< SphFluidDensities > &       fluidDensitiesAtPcls
-                , const VECTOR< Vorton > &                  particles
-                , const VECTOR< float > &                   proximities
-                , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                , const float                               ambientDensity
-                , VortonSim::PhaseE                         phase
-                )
-                : mMassDensityGradients( massDensityGradients )
-                , mFluidDensitiesAtPcls( fluidDensitiesAtPcls )
-                , mParticles( particles )
-                , mProximities( proximities )
-                , mPclIndicesGrid( pclIndicesGrid )
-                , mAmbientDensity( ambientDensity )
-                , mPhase( phase )
+        void operator()( size_t idxA , size_t idxB )
+        {
+            if( mBatch.Add( idxA , idxB ) )
             {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
-
-
-
-
-
-#if USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
-
-    static void DiffuseAndDissipateVelocitySph_Grid_Slice( VECTOR< Vorton > & particles , const float timeStep , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , size_t izStart , size_t izEnd , VortonSim::PhaseE phase ) ;
-
-    /** Function object to diffuse and dissipate particle velocity using Threading Building Blocks.
-    */
-    class SphSim_DiffuseAndDissipateVelocity_TBB
-    {
-            VECTOR< Vorton > &                          mParticles      ; ///< Array of particles whose velocity to diffuse and dissipate.
-            const float                                 mTimeStep       ; ///< Amount of time by which to advance simulation.
-            const UniformGrid< VECTOR< unsigned > > &   mPclIndicesGrid ; ///< Reference to uniform grid of particle indices.
-            VortonSim::PhaseE                           mPhase          ; ///< Processing phase: whether to run on odd, even or both values for z slice.
-
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute particle velocity diffusion and dissipation for subset of domain.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                DiffuseAndDissipateVelocitySph_Grid_Slice( mParticles , mTimeStep , mPclIndicesGrid , r.begin() , r.end() , mPhase ) ;
+                Flush() ;
             }
+        }
 
-            SphSim_DiffuseAndDissipateVelocity_TBB(
-                  VECTOR< Vorton > &                        particles
-                , const float                               timeStep
-                , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                , VortonSim::PhaseE                         phase
-                )
-                : mParticles( particles )
-                , mTimeStep( timeStep )
-                , mPclIndicesGrid( pclIndicesGrid )
-                , mPhase( phase )
+        /** Accumulate all pairs buffered since the previous Flush.
+        */
+        void Flush()
+        {
+            if( 0 == mBatch.mCount )
             {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
+                return ;
             }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
-
-#endif // USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
+            const Vorton & rPcl0 = mParticles[ 0 ] ;
+            mIspcKernels.mEvaluateSphKernelPairs( & rPcl0.mPosition.x , & rPcl0.mPosition.y , & rPcl0.mPosition.z , int( sizeof( Vorton ) / sizeof( float ) )
+                                                , mBatch.mHere , mBatch.mThere , int( mBatch.mCount ) , mInvInflRad2 , mHardCoreRadius
+                                                , mBatch.mResultA , mBatch.mResultB ) ;
+            for( unsigned iPair = 0 ; iPair < mBatch.mCount ; ++ iPair )
+            {   // For each pair in batch...
+                const float q = mBatch.mResultA[ iPair ] ;
+                if( q < 0.0f )
+                {   // Particles lie inside hard core.
+                    mAccumulator( mBatch.mHere[ iPair ] , mBatch.mThere[ iPair ] ) ;
+                }
+                else if( q > 0.0f )
+                {   // Particles lie within influence radius.
+                    mAccumulator.AccumulateKernel( mBatch.mHere[ iPair ] , mBatch.mThere[ iPair ] , q , mBatch.mResultB[ iPair ] ) ;
+                }
+            }
+            mBatch.mCount = 0 ;
+        }
 
-#endif // USE_TBB && USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
+    private:
+        SphPairBatch & operator=( const SphPairBatch & ) ; // Prevent assignment
+
+        AccumulatorT &              mAccumulator    ; ///< Accumulator to which to pass evaluated pairs.
+        const FluidKernelTable &    mIspcKernels    ; ///< Kernels with which to evaluate smoothing function.
+        const VECTOR< Vorton > &    mParticles      ; ///< Fluid particles.
+        const float                 mInvInflRad2    ; ///< Reciprocal of square of influence radius.
+        const float                 mHardCoreRadius ; ///< Separation within which pairs go to the accumulator's operator().  Zero to disable.
+        FluidKernelPairBatch        mBatch          ; ///< Pairs awaiting Flush.
+} ;
 
 
 
@@ -350,6 +296,7 @@ class DensityAccumulator
             , mParticles( particles )
             , mInfluenceRadius( influenceRadius )
             , mInflRad2( influenceRadius * influenceRadius )
+            , mInvInflRad2( 1.0f / mInflRad2 )
             , mNormFactor( 15.0f / ( PI * mInflRad2 * mInfluenceRadius ) )
         {
             ASSERT( mPclDensities.Size() == mParticles.Size() ) ;
@@ -358,46 +305,70 @@ class DensityAccumulator
         void operator()( size_t idxA , size_t idxB )
         {
             const Vec3  sep     = mParticles[ idxA ].mPosition - mParticles[ idxB ].mPosition ;
-            const float dist2   = sep.Mag2() ;
+            AccumulatePair( idxA , idxB , sep.Mag2() ) ;
+        }
+
+        /** Accumulate density between two particles whose squared separation the caller already computed.
+        */
+        void AccumulatePair( size_t idxA , size_t idxB , float dist2 )
+        {
             if( dist2 < mInflRad2 )
             {   // Particles are close enough to contribute density to each other.
-                const float dist = fsqrtf( dist2 ) ;
-                const float q    = 1.0f - dist / mInfluenceRadius ;
-                const float q2   = Pow2( q ) ;
-                const float q3   = q2 * q  ;
-                const float q4   = q2 * q2 ;
-                ASSERT( ( 0.0f <= q ) && ( q <= 1.0f ) ) ;
+                SphKernelTable::Sample kernel ;
+                gSphKernelTable.Evaluate( kernel , dist2 * mInvInflRad2 ) ;
+                ASSERT( ( 0.0f <= kernel.mQ ) && ( kernel.mQ <= 1.0f ) ) ;
+                AccumulatePowers( idxA , idxB , kernel.mQ3 , kernel.mQ4 ) ;
+            }
+        }
+
+        /** Accumulate density between two particles whose smoothing kernel the caller already evaluated.
+
+            \param q    1 - r / h, where r is separation and h is influence radius.  Must lie in (0,1].
+
+            \see SphPairBatch
+        */
+        void AccumulateKernel( size_t idxA , size_t idxB , float q , float /* oneOverR */ )
+        {
+            ASSERT( ( 0.0f < q ) && ( q <= 1.0f ) ) ;
+            const float q2 = q * q ;
+            AccumulatePowers( idxA , idxB , q2 * q , q2 * q2 ) ;
+        }
+
+    private:
+        /** Accumulate density between two particles, given powers of their smoothing kernel.
+        */
+        void AccumulatePowers( size_t idxA , size_t idxB , float q3 , float q4 )
+        {
 #if USE_NORMALIZED_SPH_FORM_FOR_NUMBER_DENSITY
-                mPclDensities[ idxA ].mNumberDensity      += q3 * mNormFactor * mParticles[ idxB ].GetVolume() ;
-                mPclDensities[ idxA ].mNearNumberDensity  += q4 * mNormFactor * mParticles[ idxB ].GetVolume() ;
-                mPclDensities[ idxA ].mMassDensity        += q3 * mNormFactor * mParticles[ idxB ].GetMass() ;
+            mPclDensities[ idxA ].mNumberDensity      += q3 * mNormFactor * mParticles[ idxB ].GetVolume() ;
+            mPclDensities[ idxA ].mNearNumberDensity  += q4 * mNormFactor * mParticles[ idxB ].GetVolume() ;
+            mPclDensities[ idxA ].mMassDensity        += q3 * mNormFactor * mParticles[ idxB ].GetMass() ;
 
-                mPclDensities[ idxB ].mNumberDensity      += q3 * mNormFactor * mParticles[ idxA ].GetVolume() ;
-                mPclDensities[ idxB ].mNearNumberDensity  += q4 * mNormFactor * mParticles[ idxB ].GetVolume() ;
-                mPclDensities[ idxB ].mMassDensity        += q3 * mNormFactor * mParticles[ idxA ].GetMass() ;
+            mPclDensities[ idxB ].mNumberDensity      += q3 * mNormFactor * mParticles[ idxA ].GetVolume() ;
+            mPclDensities[ idxB ].mNearNumberDensity  += q4 * mNormFactor * mParticles[ idxB ].GetVolume() ;
+            mPclDensities[ idxB ].mMassDensity        += q3 * mNormFactor * mParticles[ idxA ].GetMass() ;
 #else           // Non-normalized SPH kernel for number density
-                // NOTE: mNumberDensity is not the actual number density, since it is not normalized.
-                //      To compute actual number density, it would need to be multiplied by mNormFactor * mParticles[ idxB ].GetVolume().
-                //      Note that the fact that this is not actual number density has implications when
-                //      computing other quantities using SPH formalism, namely that mNormFactor gets omitted from density derivative calculations.
-                mPclDensities[ idxA ].mNumberDensity      += q3 ;
-                mPclDensities[ idxA ].mNearNumberDensity  += q4 ;
-                mPclDensities[ idxA ].mMassDensity        += q3 * mNormFactor * mParticles[ idxB ].GetMass() ;
-
-                mPclDensities[ idxB ].mNumberDensity      += q3 ;
-                mPclDensities[ idxB ].mNearNumberDensity  += q4 ;
-                mPclDensities[ idxB ].mMassDensity        += q3 * mNormFactor * mParticles[ idxA ].GetMass() ;
+            // NOTE: mNumberDensity is not the actual number density, since it is not normalized.
+            //      To compute actual number density, it would need to be multiplied by mNormFactor * mParticles[ idxB ].GetVolume().
+            //      Note that the fact that this is not actual number density has implications when
+            //      computing other quantities using SPH formalism, namely that mNormFactor gets omitted from density derivative calculations.
+            mPclDensities[ idxA ].mNumberDensity      += q3 ;
+            mPclDensities[ idxA ].mNearNumberDensity  += q4 ;
+            mPclDensities[ idxA ].mMassDensity        += q3 * mNormFactor * mParticles[ idxB ].GetMass() ;
+
+            mPclDensities[ idxB ].mNumberDensity      += q3 ;
+            mPclDensities[ idxB ].mNearNumberDensity  += q4 ;
+            mPclDensities[ idxB ].mMassDensity        += q3 * mNormFactor * mParticles[ idxA ].GetMass() ;
 #endif
-            }
         }
 
-    private:
         DensityAccumulator & operator=( const DensityAccumulator & ) ; // Prevent assignment
 
         VECTOR< SphFluidDensities > &   mPclDensities       ; ///< Fluid particle density at each particle.
         const VECTOR< Vorton > &        mParticles          ; ///< Fluid particles.
         const float                     mInfluenceRadius    ; ///< Range of influence each particle has on others.
         const float                     mInflRad2           ; ///< Square of mInfluenceRadius.
+        const float                     mInvInflRad2        ; ///< Reciprocal of mInflRad2.
         const float                     mNormFactor         ; ///< Normalization factor
 } ;
 
@@ -408,9 +379,9 @@ class DensityAccumulator
 
 /** Compute fluid particle number density at each SPH particle using a uniform grid spatial partition, for a subset of the domain.
 */
-static void ComputeSphDensityAtParticles_Grid_Slice( VECTOR< SphFluidDensities > & fluidDensitiesAtPcls , const VECTOR< Vorton > & particles , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , size_t izStart , size_t izEnd , VortonSim::PhaseE phase )
+static void ComputeSphDensityAtParticles_Grid_Slice( VECTOR< SphFluidDensities > & fluidDensitiesAtPcls , const VECTOR< Vorton > & particles , const SphNeighborList & neighborList , const CellBox & box )
 {
-    PERF_BLOCK( VortonSim__ComputeSphDensityAtParticles_Grid_Slice ) ;
+    PERF_BLOCK_INNER( VortonSim__ComputeSphDensityAtParticles_Grid_Slice ) ;
 
     if( 0 == particles.Size() )
     {
@@ -418,103 +389,28 @@ static void ComputeSphDensityAtParticles_Grid_Slice( VECTOR< SphFluidDensities >
     }
 
     ASSERT( fluidDensitiesAtPcls.Size() == particles.Size() ) ;
-    ASSERT( ! pclIndicesGrid.Empty() ) ; // Spatial partition must be populated.
+    ASSERT( ! neighborList.IsEmpty() ) ; // Neighbor list must be populated.
 
     const float pclRad          = particles[ 0 ].GetRadius() ;
     const float influenceRadius = influenceRadiusScale * pclRad ;
 
-    // Make sure grid cell spans maximum possible neighbor distance, otherwise search below will not find all neighbors.
-    ASSERT( influenceRadius <= MIN3( pclIndicesGrid.GetCellSpacing().x , pclIndicesGrid.GetCellSpacing().y , pclIndicesGrid.GetCellSpacing().z ) ) ;
+    // Make sure neighbor list spans maximum possible neighbor distance, otherwise it omits some neighbors.
+    ASSERT( influenceRadius <= neighborList.GetInfluenceRadius() ) ;
 
     DensityAccumulator accumulateDensity( fluidDensitiesAtPcls , particles , influenceRadius ) ;
 
-    const int &     nx      = pclIndicesGrid.GetNumPoints( 0 ) ;
-    const size_t    nxm1    = nx - 1 ;
-    const int &     ny      = pclIndicesGrid.GetNumPoints( 1 ) ;
-    const size_t    nym1    = ny - 1 ;
-    const int       nxy     = nx * ny ;
-
-    // Set up increment and offset for alternating odd-even access.
-    const size_t   zInc     =   VortonSim::PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t   flipper  = ( VortonSim::PHASE_ODD  == phase ) ? 1 : 0 ;
-    const size_t   izShift  = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
-
-    DEBUG_ONLY( const size_t & nz      = pclIndicesGrid.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t   nzm1    = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
-
-    // Note that the cell-neighborhood loop visits only half the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const int neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-        , -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-        ,  1 + nx       // + , + , 0 ( 4)
-        , -1 - nx + nxy // - , - , + ( 5)
-        ,    - nx + nxy // 0 , - , + ( 6)
-        ,  1 - nx + nxy // + , - , + ( 7)
-        , -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-        ,  1      + nxy // + , 0 , + (10)
-        , -1 + nx + nxy // - , 0 , + (11)
-        ,      nx + nxy // 0 , + , + (12)
-        ,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
-
-    const size_t gridCapacity = pclIndicesGrid.GetGridCapacity() ;
-
-    size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
-    {   // For all grid cells along z...
-        const size_t offsetZ0 =   idx[2]       * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
-        {   // For all grid cells along y...
-            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
-            {   // For all grid cells along x...
-                const size_t offsetX0Y0Z0 = idx[0] + offsetY0Z0 ;
-
-                const size_t numInCurrentCell = pclIndicesGrid[ offsetX0Y0Z0 ].Size() ;
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
-                {   // For each particle in this gridcell...
-                    const unsigned & rVortIdxHere = pclIndicesGrid[ offsetX0Y0Z0 ][ ivHere ] ;
-
-                    ASSERT( pclRad == particles[ rVortIdxHere ].GetRadius() ) ; // This implementation assumes all SPH particles have same radius.
-
-                    // Aggregate density between particles that share a cell.
-                    // Notice that the loop only visits particles with indices
-                    // following the "here" particle.  That is because each
-                    // visitation symmetrically modifies both particles in the
-                    // pair.  If "here" and "there" is visited, then "there"
-                    // and "here" should not also be visited, because it
-                    // would be redundant.
-                    for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
-                    {   // For each OTHER particle within this same cell...
-                        const unsigned & rVortIdxThere = pclIndicesGrid[ offsetX0Y0Z0 ][ ivThere ] ;
-                        accumulateDensity( rVortIdxHere , rVortIdxThere ) ;
-                    }
-
-                    // Aggregate density between particles in adjacent cells.
-                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                    {   // For each cell in neighborhood...
-                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of adjacent cell
-                        if( cellOffset >= gridCapacity ) break ; // Would-be neighbor is out-of-bounds.
-                        const VECTOR< unsigned > & cell = pclIndicesGrid[ cellOffset ] ;
-                        for( unsigned ivThere = 0 ; ivThere < cell.Size() ; ++ ivThere )
-                        {   // For each particle in the visited cell...
-                            const unsigned & rVortIdxThere = cell[ ivThere ] ;
-                            accumulateDensity( rVortIdxHere , rVortIdxThere ) ;
-                        }
-                    }
-                }
-            }
-        }
+    // Aggregate density between each pair of candidate neighbors.
+    // Each pair appears once, since each visitation symmetrically modifies both particles in the pair.
+    const FluidKernelTable * ispcKernels = FluidKernels::GetTable() ;
+    if( ispcKernels != NULL )
+    {   // Density has no hard core, since coincident particles contribute fully to each other.
+        SphPairBatch< DensityAccumulator > batchDensity( accumulateDensity , * ispcKernels , particles , influenceRadius , 0.0f ) ;
+        neighborList.ForEachPairInBox( box , batchDensity ) ;
+        batchDensity.Flush() ;
+    }
+    else
+    {
+        neighborList.ForEachPairInBox( box , accumulateDensity ) ;
     }
 }
 
@@ -557,7 +453,7 @@ static void InitializeDensitySelfInfluence(     VECTOR< SphFluidDensities > & fl
 */
 void ComputeSphDensityAtParticles_Grid( VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
                                       , const VECTOR< Vorton > & particles
-                                      , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid )
+                                      , const SphNeighborList & neighborList )
 {
 #if ENABLE_FLUID_BODY_SIMULATION
     PERF_BLOCK( ComputeSphDensityAtParticles_Grid ) ;
@@ -566,20 +462,14 @@ void ComputeSphDensityAtParticles_Grid( VECTOR< SphFluidDensities > & fluidDensi
     fluidDensitiesAtPcls.resize( particles.Size() , SphFluidDensities( 1.0f , 1.0f , 0.0f ) ) ;
     InitializeDensitySelfInfluence( fluidDensitiesAtPcls , particles ) ;
 
-    const unsigned & nz     = pclIndicesGrid.GetNumPoints( 2 ) ;
-    const unsigned   nzm1   = nz - 1 ;
+    const size_t * numCells = neighborList.GetNumCells() ;
 
     #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
         // Compute particle number density using threading building blocks.
-        // Alternate between even and odd z-slices to avoid multiple threads accessing the same particles simultaneously.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , 
-            SphSim_ComputeSphNumberDensityAtParticles_TBB( fluidDensitiesAtPcls , particles , pclIndicesGrid , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) ,
-            SphSim_ComputeSphNumberDensityAtParticles_TBB( fluidDensitiesAtPcls , particles , pclIndicesGrid , VortonSim::PHASE_ODD  ) ) ;
+        // Visit blocks of cells in 8 colors, so that no two threads access the same particles simultaneously.
+        ForEachCellBlockByColor( numCells , Parallel::Function( ComputeSphDensityAtParticles_Grid_Slice , fluidDensitiesAtPcls , particles , neighborList ) ) ;
     #else
-        ComputeSphDensityAtParticles_Grid_Slice( fluidDensitiesAtPcls , particles , pclIndicesGrid , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
+        ComputeSphDensityAtParticles_Grid_Slice( fluidDensitiesAtPcls , particles , neighborList , CellBox( numCells ) ) ;
     #endif
 #endif
 }
@@ -646,7 +536,7 @@ class PressureGradientAccumulator
                                             to each others' densities.
         */
         PressureGradientAccumulator( 
-                    VECTOR< Vec3 > &                    accelerations
+                    AccelerationArray &                 accelerations
                 ,   const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
                 ,   const VECTOR< Vorton > &            particles
                 ,   const float                         influenceRadius
@@ -657,6 +547,7 @@ class PressureGradientAccumulator
             , mInfluenceRadius( influenceRadius )
             , mInflRad2( influenceRadius * influenceRadius )
             , mInvInflRad( 1.0f / influenceRadius )
+            , mInvInflRad2( 1.0f / mInflRad2 )
             , mTargetNumberDensity( targetNumberDensity )
             , mWaveSpeed2( stiffness )
             , mWaveSpeed2Near( nearToFar * stiffness )
@@ -679,51 +570,74 @@ class PressureGradientAccumulator
                 ||  ( fabsf( sep.z ) < sHardCoreRadius ) )
             {   // Particles too close. Pressure gradient would be zero.
                 // Impose a random separation.
-                sep    += RandomSpread( sTinyJiggle ) ;
+                sep    += TinyJiggle( idxA , idxB ) ;
                 dist2   = sep.Mag2() ;
             }
 
             if( dist2 < mInflRad2 )
             {   // Particles are close enough to apply pressure on each other.
-                const float dist    = fsqrtf( dist2 ) ;
-                const float q       = 1.0f - dist / mInfluenceRadius ;
-                const float q2      = Pow2( q ) ;
-
-                ASSERT( ( 0.0f <= q ) && ( q <= 1.0f ) ) ;
-
-                const Vec3      dir         = sep / ( dist + FLT_EPSILON ) ;
-
-                const float &   numDensA    = mPclDensities[ idxA ].mNumberDensity ;
-                const float &   numDensB    = mPclDensities[ idxB ].mNumberDensity ;
-
-                {   // Compute acceleration due to pressure gradient.
-                    const float q3          = q2 * q  ;
-                    const float & nearDensA = mPclDensities[ idxA ].mNearNumberDensity ;
-                    const float & nearDensB = mPclDensities[ idxB ].mNearNumberDensity ;
-                    //const float presA       = numDensA - targetNumberDensity ;
-                    //const float presB       = numDensB - targetNumberDensity ;
-                    const float pressure    = mWaveSpeed2     * ( numDensA + numDensB - 2.0f * mTargetNumberDensity ) ;
-                    const float pressNear   = mWaveSpeed2Near * ( nearDensA + nearDensB ) ;
-                    const float dReg        = pressure  * q2 ;
-                    const float dNear       = pressNear * q3 ;
-                    const Vec3  accel       = ( dReg + dNear ) * dir ;
-                    mAccelerations[ idxA ] += accel ;
-                    mAccelerations[ idxB ] -= accel ;
-                    ASSERT( ! IsNan( mAccelerations[ idxA ] ) && ! IsInf( mAccelerations[ idxA ] ) ) ;
-                    ASSERT( ! IsNan( mAccelerations[ idxB ] ) && ! IsInf( mAccelerations[ idxB ] ) ) ;
-                }
+                SphKernelTable::Sample kernel ;
+                gSphKernelTable.Evaluate( kernel , dist2 * mInvInflRad2 ) ;
+                const float q2      = kernel.mQ2 ;
+
+                ASSERT( ( 0.0f <= kernel.mQ ) && ( kernel.mQ <= 1.0f ) ) ;
+
+                const Vec3      dir         = sep * ( kernel.mInvR * mInvInflRad ) ;
+                AccumulateDirection( idxA , idxB , dir , q2 , kernel.mQ3 ) ;
             }
         }
 
+        /** Accumulate pressure gradient between two particles whose smoothing kernel the caller already evaluated, outside the hard core.
+
+            \param q        1 - r / h, where r is separation and h is influence radius.  Must lie in (0,1].
+
+            \param oneOverR h / r.
+
+            \see SphPairBatch
+        */
+        void AccumulateKernel( size_t idxA , size_t idxB , float q , float oneOverR )
+        {
+            ASSERT( ( 0.0f < q ) && ( q <= 1.0f ) ) ;
+            const Vec3  sep     = mParticles[ idxA ].mPosition - mParticles[ idxB ].mPosition ;
+            const Vec3  dir     = sep * ( oneOverR * mInvInflRad ) ;
+            const float q2      = q * q ;
+            AccumulateDirection( idxA , idxB , dir , q2 , q2 * q ) ;
+        }
+
     private:
+        /** Accumulate pressure gradient between two particles, given the direction between them and powers of their smoothing kernel.
+        */
+        void AccumulateDirection( size_t idxA , size_t idxB , const Vec3 & dir , float q2 , float q3 )
+        {
+            const float &   numDensA    = mPclDensities[ idxA ].mNumberDensity ;
+            const float &   numDensB    = mPclDensities[ idxB ].mNumberDensity ;
+
+            {   // Compute acceleration due to pressure gradient.
+                const float & nearDensA = mPclDensities[ idxA ].mNearNumberDensity ;
+                const float & nearDensB = mPclDensities[ idxB ].mNearNumberDensity ;
+                //const float presA       = numDensA - targetNumberDensity ;
+                //const float presB       = numDensB - targetNumberDensity ;
+                const float pressure    = mWaveSpeed2     * ( numDensA + numDensB - 2.0f * mTargetNumberDensity ) ;
+                const float pressNear   = mWaveSpeed2Near * ( nearDensA + nearDensB ) ;
+                const float dReg        = pressure  * q2 ;
+                const float dNear       = pressNear * q3 ;
+                const Vec3  accel       = ( dReg + dNear ) * dir ;
+                mAccelerations[ idxA ] += accel ;
+                mAccelerations[ idxB ] -= accel ;
+                ASSERT( ! IsNan( mAccelerations[ idxA ] ) && ! IsInf( mAccelerations[ idxA ] ) ) ;
+                ASSERT( ! IsNan( mAccelerations[ idxB ] ) && ! IsInf( mAccelerations[ idxB ] ) ) ;
+            }
+        }
+
         PressureGradientAccumulator & operator=( const PressureGradientAccumulator & ) ; // Prevent assignment
 
-        VECTOR< Vec3 > &                    mAccelerations      ; ///< Change in velocity, per unit time, for each particle.
+        AccelerationArray &                 mAccelerations      ; ///< Change in velocity, per unit time, for each particle.
         const VECTOR< SphFluidDensities > & mPclDensities       ; ///< Fluid particle density at each particle.
         const VECTOR< Vorton > &            mParticles          ; ///< Fluid particles.
         const float                         mInfluenceRadius    ; ///< Range of influence each particle has on others.
         const float                         mInflRad2           ; ///< Square of mInfluenceRadius.
         const float                         mInvInflRad         ; ///< Reciprocal of mInfluenceRadius.
+        const float                         mInvInflRad2        ; ///< Reciprocal of mInflRad2.
         const float                         mNormFactor         ; ///< Normalization factor
         const float                         mTargetNumberDensity; ///< Target fluid particle number density.  Tuned for equilibrium test cases.
         const float                         mWaveSpeed2         ; ///< Long-range  pressure stiffness.  Tuned for compromise between stickiness and stability.
@@ -766,6 +680,7 @@ class MassDensityGradientAccumulator
             , mAmbientDensity( ambientDensity )
             , mInflRad2( influenceRadius * influenceRadius )
             , mInvInflRad( 1.0f / influenceRadius )
+            , mInvInflRad2( 1.0f / mInflRad2 )
             , mNormFactor( 15.0f / ( PI * mInflRad2 * mInfluenceRadius ) )
 
 //, influenceSum( 0.0f )
@@ -782,108 +697,159 @@ class MassDensityGradientAccumulator
         }
 
         void operator()( size_t idxA , size_t idxB )
+        {
+            Vec3 gradKernel ;
+            if( EvaluateGradientKernel( idxA , idxB , gradKernel ) )
+            {   // Particles are close enough to contribute density gradient to each other.
+                AccumulateGradient( idxA , idxB , GetExcessMassDensity( idxA ) , GetExcessMassDensity( idxB ) , gradKernel ) ;
+            }
+        }
+
+
+        /** Compute the gradient of the smoothing function between two particles, which depends only on their positions.
+
+            \param gradKernel (out) Gradient of smoothing function, with respect to the position of particle A.
+
+            \return Whether particles are close enough to contribute density gradient to each other.  If not, gradKernel is zero.
+        */
+        bool EvaluateGradientKernel( size_t idxA , size_t idxB , Vec3 & gradKernel )
         {
             Vec3  sep     = mParticles[ idxA ].mPosition - mParticles[ idxB ].mPosition ;
             float dist2   = sep.Mag2() ;
+            return EvaluateGradientKernel( idxA , idxB , sep , dist2 , gradKernel ) ;
+        }
+
 
+        /** Compute the gradient of the smoothing function between two particles whose separation the caller already computed.
+
+            \see EvaluateGradientKernel
+        */
+        bool EvaluateGradientKernel( size_t idxA , size_t idxB , Vec3 sep , float dist2 , Vec3 & gradKernel )
+        {
+#if ! USE_NORMALIZED_SPH_FORM_FOR_NUMBER_DENSITY
+            UNUSED_PARAM( idxA ) ;
+#endif
             if(     ( dist2 < sHardCoreRadius2 )
                 ||  ( fabsf( sep.x ) < sHardCoreRadius )
                 ||  ( fabsf( sep.y ) < sHardCoreRadius )
                 ||  ( fabsf( sep.z ) < sHardCoreRadius ) )
             {   // Particles too close. Pressure gradient would be zero.
                 // Impose a random separation.
-                sep    += RandomSpread( sTinyJiggle ) ;
+                sep    += TinyJiggle( idxA , idxB ) ;
                 dist2   = sep.Mag2() ;
             }
 
-            if( dist2 < mInflRad2 )
-            {   // Particles are close enough to contribute density gradient to each other.
-                const float dist    = fsqrtf( dist2 ) ;
-                const float q       = 1.0f - dist / mInfluenceRadius ;
-                const float q2      = Pow2( q ) ;
+            if( dist2 >= mInflRad2 )
+            {   // Particles are too far apart to contribute density gradient to each other.
+                gradKernel = Vec3( 0.0f , 0.0f , 0.0f ) ;
+                return false ;
+            }
 
-                ASSERT( ( 0.0f <= q ) && ( q <= 1.0f ) ) ;
+            SphKernelTable::Sample kernel ;
+            gSphKernelTable.Evaluate( kernel , dist2 * mInvInflRad2 ) ;
+            const float q2      = kernel.mQ2 ;
 
-                const Vec3      dir         = sep / ( dist + FLT_EPSILON ) ;
+            ASSERT( ( 0.0f <= kernel.mQ ) && ( kernel.mQ <= 1.0f ) ) ;
 
-                const float &   numDensA    = mPclDensities[ idxA ].mNumberDensity ;
-                const float &   numDensB    = mPclDensities[ idxB ].mNumberDensity ;
+            const Vec3      dir         = sep * ( kernel.mInvR * mInvInflRad ) ;
 
-                {   // Compute mass density gradient.
-                    // Form of smoothGrad here depends on form of smoothing function used to accumulate mass density.
-                    // This formula is based on the "spikey" q3 formula.
-                    // This omits mNormFactor because mNumberDensity also omits it and it is in the denominator, so they cancel.
+            // Form of smoothGrad here depends on form of smoothing function used to accumulate mass density.
+            // This formula is based on the "spikey" q3 formula.
+            // This omits mNormFactor because mNumberDensity also omits it and it is in the denominator, so they cancel.
 #if USE_NORMALIZED_SPH_FORM_FOR_NUMBER_DENSITY
-                    const float smoothGrad  = -3.0f * q2 * mInvInflRad * mNormFactor * mParticles[ idxA ].GetVolume() ;
+            const float smoothGrad  = -3.0f * q2 * mInvInflRad * mNormFactor * mParticles[ idxA ].GetVolume() ;
 #else
-                    const float smoothGrad  = -3.0f * q2 * mInvInflRad ;
+            const float smoothGrad  = -3.0f * q2 * mInvInflRad ;
 #endif
+            gradKernel = smoothGrad * dir ;
+            return true ;
+        }
+
 
 // Use per-particle mass density instead of SPH mass density.
 #define USE_PER_PARTICLE_MASS_DENSITY 1
 
-                    // Take into account ambient density by subtracting it from massDensX below.
-                    // Note that when using the "difference" gradient formula, that cancels out.
+        /** Return mass density of the given particle in excess of ambient density, as AccumulateGradient takes it.
+        */
+        float GetExcessMassDensity( size_t idx ) const
+        {
+            // Take into account ambient density by subtracting it from massDensX below.
+            // Note that when using the "difference" gradient formula, that cancels out.
 #if USE_PER_PARTICLE_MASS_DENSITY
-                    // Using this, difference gradient is zero at boundaries
-                    // between fluid and empty space.
-                    const float massDensA = mParticles[ idxA ].mDensity - mAmbientDensity ;
-                    const float massDensB = mParticles[ idxB ].mDensity - mAmbientDensity ;
+            // Using this, difference gradient is zero at boundaries
+            // between fluid and empty space.
+            return mParticles[ idx ].mDensity - mAmbientDensity ;
 #else   // Use SPH particle mass density
-                    const float massDensA = mPclDensities[ idxA ].mMassDensity - mAmbientDensity ;
-                    const float massDensB = mPclDensities[ idxB ].mMassDensity - mAmbientDensity ;
+            return mPclDensities[ idx ].mMassDensity - mAmbientDensity ;
 #endif
+        }
 
-                    // Canonical SPH gradient formula.  Simple, but has issues
-                    // that other forms solve.
-                    const float densGradA_can = massDensB * smoothGrad / numDensB ;
-                    const float densGradB_can = massDensA * smoothGrad / numDensA ;
-
-                    // This form is symmetric, meaning the contribution due to
-                    // each other particle is the opposite as the reverse.
-                    const float common_sym      = smoothGrad * (  massDensA / ( numDensA * numDensA )
-                                                               +  massDensB / ( numDensB * numDensB ) ) ;
-                    const float densGradA_sym   =   common_sym * numDensA ;
-                    const float densGradB_sym   =   common_sym * numDensB ;
-                    (void) densGradA_sym , densGradB_sym ; // Unused currently, but useful for debugging, and might use later.
-
-                    // Difference (Monaghan 2005, section 2.2, Phi=1)
-                    // This form has some gradient at boundaries between fluid
-                    // and empty space, due to the fact that the SPH mass
-                    // density varies there, due to its spatial smoothing.
-                    // It also yields results comparable with the above formulae
-                    // in regions far from fluid-empty edges.
-                    const float common_dif      = ( massDensB - massDensA ) * smoothGrad ;
-                    const float densGradA_dif   =   common_dif / numDensA ;
-                    const float densGradB_dif   = - common_dif / numDensB ;
-
-                    // Use difference formula at body boundaries, symmetric formula elsewhere.
-
-                    if( mProximities[ idxA ] >= mInfluenceRadius )
-                    {   // Far from wall.
-                        mMassDensityGradients[ idxA ] += densGradA_can * dir ;
-                    }
-                    else
-                    {   // Near or in wall.
-                        mMassDensityGradients[ idxA ] += densGradA_dif * dir ;
-                    }
 
-                    if( mProximities[ idxB ] >= mInfluenceRadius )
-                    {   // Far from wall.
-                        mMassDensityGradients[ idxB ] -= densGradB_can * dir ;
-                    }
-                    else
-                    {   // Near or in wall.
-                        mMassDensityGradients[ idxB ] -= densGradB_dif * dir ;
-                    }
+        /** Accumulate mass density gradient between two particles, given the gradient of the smoothing function between them.
+
+            This reads number densities, which must be complete, proximities
+            and the given excess mass densities, but not particles, so it can
+            reuse gradKernel from an earlier pass over the same pairs.
+
+            \param massDensA, massDensB Mass densities of particles in excess of ambient.  See GetExcessMassDensity.
+
+            \param gradKernel           Gradient of smoothing function.  See EvaluateGradientKernel.
+        */
+        void AccumulateGradient( size_t idxA , size_t idxB , const float massDensA , const float massDensB , const Vec3 & gradKernel )
+        {
+            const float &   numDensA    = mPclDensities[ idxA ].mNumberDensity ;
+            const float &   numDensB    = mPclDensities[ idxB ].mNumberDensity ;
+
+            // Compute mass density gradient.
+            // gradKernel already includes smoothGrad, so coefficients below omit it.
+
+            // Canonical SPH gradient formula.  Simple, but has issues
+            // that other forms solve.
+            const float densGradA_can = massDensB / numDensB ;
+            const float densGradB_can = massDensA / numDensA ;
+
+            // This form is symmetric, meaning the contribution due to
+            // each other particle is the opposite as the reverse.
+            const float common_sym      =  massDensA / ( numDensA * numDensA )
+                                        +  massDensB / ( numDensB * numDensB ) ;
+            const float densGradA_sym   =   common_sym * numDensA ;
+            const float densGradB_sym   =   common_sym * numDensB ;
+            (void) densGradA_sym , densGradB_sym ; // Unused currently, but useful for debugging, and might use later.
+
+            // Difference (Monaghan 2005, section 2.2, Phi=1)
+            // This form has some gradient at boundaries between fluid
+            // and empty space, due to the fact that the SPH mass
+            // density varies there, due to its spatial smoothing.
+            // It also yields results comparable with the above formulae
+            // in regions far from fluid-empty edges.
+            const float common_dif      = massDensB - massDensA ;
+            const float densGradA_dif   =   common_dif / numDensA ;
+            const float densGradB_dif   = - common_dif / numDensB ;
+
+            // Use difference formula at body boundaries, symmetric formula elsewhere.
+
+            if( mProximities[ idxA ] >= mInfluenceRadius )
+            {   // Far from wall.
+                mMassDensityGradients[ idxA ] += densGradA_can * gradKernel ;
+            }
+            else
+            {   // Near or in wall.
+                mMassDensityGradients[ idxA ] += densGradA_dif * gradKernel ;
+            }
+
+            if( mProximities[ idxB ] >= mInfluenceRadius )
+            {   // Far from wall.
+                mMassDensityGradients[ idxB ] -= densGradB_can * gradKernel ;
+            }
+            else
+            {   // Near or in wall.
+                mMassDensityGradients[ idxB ] -= densGradB_dif * gradKernel ;
+            }
 
 //#error Some density gradients are huge and I don't know why.
 //#error TODO: Set a breakpoint in here for large density gradients and track that down.
 //#error NOTE: I already tried detecting and responding to particles "in isolation".  That didn't help. See below.
 //#error The case where this is noticeable: vertical column of water on side of tank. Alt-F2 or something close to that.
-
-                }
-            }
         }
 
     private:
@@ -897,6 +863,7 @@ class MassDensityGradientAccumulator
         const float                         mAmbientDensity         ; ///< Density of fluid in the absence of fluid particles.
         const float                         mInflRad2               ; ///< Square of mInfluenceRadius.
         const float                         mInvInflRad             ; ///< Reciprocal of mInfluenceRadius.
+        const float                         mInvInflRad2            ; ///< Reciprocal of mInflRad2.
         const float                         mNormFactor             ; ///< Normalization factor
 
     //public:
@@ -917,13 +884,11 @@ class MassDensityGradientAccumulator
 
 /** Compute fluid particle acceleration due to pressure gradient at each SPH particle using a uniform grid spatial partition, for a subset of the domain.
 */
-static void ComputeSphPressureGradientAcceleration_Grid_Slice( VECTOR< Vec3 > & accelerations
+static void ComputeSphPressureGradientAcceleration_Grid_Slice( AccelerationArray & accelerations
                                                              , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
                                                              , const VECTOR< Vorton > & particles
-                                                             , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                                                             , size_t izStart
-                                                             , size_t izEnd
-                                                             , VortonSim::PhaseE phase )
+                                                             , const SphNeighborList & neighborList
+                                                             , const CellBox & box )
 {
     if( 0 == particles.Size() )
     {
@@ -932,105 +897,26 @@ static void ComputeSphPressureGradientAcceleration_Grid_Slice( VECTOR< Vec3 > &
 
     ASSERT( accelerations.Size()    == particles.Size() ) ;
 
-    ASSERT( ! pclIndicesGrid.Empty() ) ; // Spatial partition must be populated.
+    ASSERT( ! neighborList.IsEmpty() ) ; // Neighbor list must be populated.
 
     const float pclRad          = particles[ 0 ].GetRadius() ;
     const float influenceRadius = influenceRadiusScale * pclRad ;
 
-    ASSERT( influenceRadius <= MIN3( pclIndicesGrid.GetCellSpacing().x , pclIndicesGrid.GetCellSpacing().y , pclIndicesGrid.GetCellSpacing().z ) ) ;
+    ASSERT( influenceRadius <= neighborList.GetInfluenceRadius() ) ;
 
     PressureGradientAccumulator accumulatePressureGradient( accelerations , fluidDensitiesAtPcls , particles , influenceRadius ) ;
 
-    const int &     nx      = pclIndicesGrid.GetNumPoints( 0 ) ;
-    const size_t    nxm1    = nx - 1 ;
-    const int &     ny      = pclIndicesGrid.GetNumPoints( 1 ) ;
-    const size_t    nym1    = ny - 1 ;
-    const int       nxy     = nx * ny ;
-
-    // Set up increment and offset for alternating odd-even access.
-    const size_t   zInc     =   VortonSim::PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t   flipper  = ( VortonSim::PHASE_ODD  == phase ) ? 1 : 0 ;
-    const size_t   izShift  = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
-
-    DEBUG_ONLY( const size_t & nz      = pclIndicesGrid.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t   nzm1    = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
-
-    // Note that the cell-neighborhood loop visits only half the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const int neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-        , -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-        ,  1 + nx       // + , + , 0 ( 4)
-        , -1 - nx + nxy // - , - , + ( 5)
-        ,    - nx + nxy // 0 , - , + ( 6)
-        ,  1 - nx + nxy // + , - , + ( 7)
-        , -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-        ,  1      + nxy // + , 0 , + (10)
-        , -1 + nx + nxy // - , 0 , + (11)
-        ,      nx + nxy // 0 , + , + (12)
-        ,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
-
-    const size_t gridCapacity = pclIndicesGrid.GetGridCapacity() ;
-
-    size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
-    {   // For all grid cells along z...
-        const size_t offsetZ0 = idx[2] * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
-        {   // For all grid cells along y...
-            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
-            {   // For all grid cells along x...
-                const size_t                offsetX0Y0Z0       = idx[0] + offsetY0Z0 ;
-                const VECTOR< unsigned > &  currentCell        = pclIndicesGrid[ offsetX0Y0Z0 ] ;
-                const size_t                numInCurrentCell   = currentCell.Size() ;
-
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
-                {   // For each particle in this gridcell...
-                    const unsigned & rVortIdxHere = currentCell[ ivHere ] ;
-
-                    ASSERT( pclRad == particles[ rVortIdxHere ].GetRadius() ) ; // This implementation assumes all SPH particles have same radius.
-
-                    // Aggregate accelerations between particles that share a cell.
-                    // Notice that the loop only visits particles with indices
-                    // following the "here" particle.  That is because each
-                    // visitation symmetrically modifies both particles in the
-                    // pair.  If "here" and "there" is visited, then "there"
-                    // and "here" should not also be visited, because it
-                    // would be redundant.
-                    for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
-                    {   // For each OTHER particle within this same cell...
-                        const unsigned & rVortIdxThere = currentCell[ ivThere ] ;
-                        accumulatePressureGradient( rVortIdxHere , rVortIdxThere ) ;
-                    }
-
-                    // Aggregate accelerations between particles in neighboring cells.
-                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                    {   // For each cell in neighborhood...
-                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of neighbor cell
-                        if( cellOffset >= gridCapacity ) break ; // Would-be neighbor is out-of-bounds.
-
-                        const VECTOR< unsigned > &  neighborCell        = pclIndicesGrid[ cellOffset ] ;
-                        const size_t                numInNeighborCell   = neighborCell.Size() ;
-                        for( unsigned ivThere = 0 ; ivThere < numInNeighborCell ; ++ ivThere )
-                        {   // For each particle in neighbor cell...
-                            const unsigned & rVortIdxThere = neighborCell[ ivThere ] ;
-                            accumulatePressureGradient( rVortIdxHere , rVortIdxThere ) ;
-                        }
-                    }
-                }
-            }
-        }
+    // Aggregate accelerations between each pair of candidate neighbors.
+    const FluidKernelTable * ispcKernels = FluidKernels::GetTable() ;
+    if( ispcKernels != NULL )
+    {
+        SphPairBatch< PressureGradientAccumulator > batchPressureGradient( accumulatePressureGradient , * ispcKernels , particles , influenceRadius , sHardCoreRadius ) ;
+        neighborList.ForEachPairInBox( box , batchPressureGradient ) ;
+        batchPressureGradient.Flush() ;
+    }
+    else
+    {
+        neighborList.ForEachPairInBox( box , accumulatePressureGradient ) ;
     }
 }
 
@@ -1039,16 +925,15 @@ static void ComputeSphPressureGradientAcceleration_Grid_Slice( VECTOR< Vec3 > &
 
 /** Compute fluid mass density gradient at each SPH particle using a uniform grid spatial partition, for a subset of the domain.
 */
-static void ComputeSphMassDensityGradient_Grid_Slice( VECTOR< Vec3 > & massDensityGradients
-                                                    , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
-                                                    , const VECTOR< Vorton > & particles
-                                                    , const VECTOR< float > & proximities
-                                                    , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                                                    , const float ambientDensity
-                                                    , size_t izStart
-                                                    , size_t izEnd
-                                                    , VortonSim::PhaseE phase )
+static void ComputeSphMassDensityGradient_Grid_Slice( const SphMassDensityGradientArrays & arrays , const CellBox & box )
 {
+    VECTOR< Vec3 > &                    massDensityGradients    = arrays.mMassDensityGradients ;
+    const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls    = arrays.mFluidDensitiesAtPcls ;
+    const VECTOR< Vorton > &            particles               = arrays.mParticles ;
+    const VECTOR< float > &             proximities             = arrays.mProximities ;
+    const SphNeighborList &             neighborList            = arrays.mNeighborList ;
+    const float                         ambientDensity          = arrays.mAmbientDensity ;
+
     if( 0 == particles.Size() )
     {
         return ;
@@ -1056,106 +941,17 @@ static void ComputeSphMassDensityGradient_Grid_Slice( VECTOR< Vec3 > & massDensi
 
     ASSERT( massDensityGradients.Size() == particles.Size() ) ;
 
-    ASSERT( ! pclIndicesGrid.Empty() ) ; // Spatial partition must be populated.
+    ASSERT( ! neighborList.IsEmpty() ) ; // Neighbor list must be populated.
 
     const float pclRad          = particles[ 0 ].GetRadius() ;
     const float influenceRadius = influenceRadiusScale * pclRad ;
 
-    ASSERT( influenceRadius <= MIN3( pclIndicesGrid.GetCellSpacing().x , pclIndicesGrid.GetCellSpacing().y , pclIndicesGrid.GetCellSpacing().z ) ) ;
+    ASSERT( influenceRadius <= neighborList.GetInfluenceRadius() ) ;
 
     MassDensityGradientAccumulator accumulateMassDensityGradient( massDensityGradients , fluidDensitiesAtPcls , particles , proximities , influenceRadius , ambientDensity ) ;
 
-    const int &     nx      = pclIndicesGrid.GetNumPoints( 0 ) ;
-    const size_t    nxm1    = nx - 1 ;
-    const int &     ny      = pclIndicesGrid.GetNumPoints( 1 ) ;
-    const size_t    nym1    = ny - 1 ;
-    const int       nxy     = nx * ny ;
-
-    // Set up increment and offset for alternating odd-even access.
-    const size_t   zInc     =   VortonSim::PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t   flipper  = ( VortonSim::PHASE_ODD  == phase ) ? 1 : 0 ;
-    const size_t   izShift  = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
-
-    DEBUG_ONLY( const size_t & nz      = pclIndicesGrid.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t   nzm1    = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
-
-    // Note that the cell-neighborhood loop visits only half the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const int neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-        , -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-        ,  1 + nx       // + , + , 0 ( 4)
-        , -1 - nx + nxy // - , - , + ( 5)
-        ,    - nx + nxy // 0 , - , + ( 6)
-        ,  1 - nx + nxy // + , - , + ( 7)
-        , -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-        ,  1      + nxy // + , 0 , + (10)
-        , -1 + nx + nxy // - , 0 , + (11)
-        ,      nx + nxy // 0 , + , + (12)
-        ,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
-
-    const size_t gridCapacity = pclIndicesGrid.GetGridCapacity() ;
-
-    size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
-    {   // For all grid cells along z...
-        const size_t offsetZ0 = idx[2] * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
-        {   // For all grid cells along y...
-            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
-            {   // For all grid cells along x...
-                const size_t                offsetX0Y0Z0       = idx[0] + offsetY0Z0 ;
-                const VECTOR< unsigned > &  currentCell        = pclIndicesGrid[ offsetX0Y0Z0 ] ;
-                const size_t                numInCurrentCell   = currentCell.Size() ;
-
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
-                {   // For each particle in this gridcell...
-                    const unsigned & rVortIdxHere = currentCell[ ivHere ] ;
-
-                    ASSERT( pclRad == particles[ rVortIdxHere ].GetRadius() ) ; // This implementation assumes all SPH particles have same radius.
-
-                    // Aggregate mass density gradient between particles that share a cell.
-                    // Notice that the loop only visits particles with indices
-                    // following the "here" particle.  That is because each
-                    // visitation symmetrically modifies both particles in the
-                    // pair.  If "here" and "there" is visited, then "there"
-                    // and "here" should not also be visited, because it
-                    // would be redundant.
-                    for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
-                    {   // For each OTHER particle within this same cell...
-                        const unsigned & rVortIdxThere = currentCell[ ivThere ] ;
-                        accumulateMassDensityGradient( rVortIdxHere , rVortIdxThere ) ;
-                    }
-
-                    // Aggregate mass density gradient between particles in neighboring cells.
-                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                    {   // For each cell in neighborhood...
-                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of neighbor cell
-                        if( cellOffset >= gridCapacity ) break ; // Would-be neighbor is out-of-bounds.
-
-                        const VECTOR< unsigned > &  neighborCell        = pclIndicesGrid[ cellOffset ] ;
-                        const size_t                numInNeighborCell   = neighborCell.Size() ;
-                        for( unsigned ivThere = 0 ; ivThere < numInNeighborCell ; ++ ivThere )
-                        {   // For each particle in neighbor cell...
-                            const unsigned & rVortIdxThere = neighborCell[ ivThere ] ;
-                            accumulateMassDensityGradient( rVortIdxHere , rVortIdxThere ) ;
-                        }
-                    }
-                }
-            }
-        }
-    }
+    // Aggregate mass density gradient between each pair of candidate neighbors.
+    neighborList.ForEachPairInBox( box , accumulateMassDensityGradient ) ;
 }
 
 
@@ -1213,10 +1009,10 @@ static void SelectivelyZeroDensityGradient( VECTOR< Vec3 > & densityGradients
     This is an O(N*k) operation where N is the number of particles and k is the
     average number of particles in the neighborhood of one of the N particles.
 */
-void ComputeSphPressureGradientAcceleration_Grid( VECTOR< Vec3 > & accelerations
+void ComputeSphPressureGradientAcceleration_Grid( AccelerationArray & accelerations
                                                 , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
                                                 , const VECTOR< Vorton > & particles
-                                                , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
+                                                , const SphNeighborList & neighborList
                                                 )
 {
 #if ENABLE_FLUID_BODY_SIMULATION
@@ -1225,20 +1021,14 @@ void ComputeSphPressureGradientAcceleration_Grid( VECTOR< Vec3 > & accelerations
     accelerations.Clear() ;
     accelerations.Resize( particles.Size() , Vec3( 0.0f , 0.0f , 0.0f ) ) ;
 
-    const unsigned & nz     = pclIndicesGrid.GetNumPoints( 2 ) ;
-    const unsigned   nzm1   = nz - 1 ;
+    const size_t * numCells = neighborList.GetNumCells() ;
 
     #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
         // Compute particle number density using threading building blocks.
-        // Alternate between even and odd z-slices to avoid multiple threads accessing the same particles simultaneously.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , 
-            SphSim_ComputeSphPressureGradientAcceleration_TBB( accelerations , fluidDensitiesAtPcls , particles , pclIndicesGrid , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) ,
-            SphSim_ComputeSphPressureGradientAcceleration_TBB( accelerations , fluidDensitiesAtPcls , particles , pclIndicesGrid , VortonSim::PHASE_ODD  ) ) ;
+        // Visit blocks of cells in 8 colors, so that no two threads access the same particles simultaneously.
+        ForEachCellBlockByColor( numCells , Parallel::Function( ComputeSphPressureGradientAcceleration_Grid_Slice , accelerations , fluidDensitiesAtPcls , particles , neighborList ) ) ;
     #else
-        ComputeSphPressureGradientAcceleration_Grid_Slice( accelerations , fluidDensitiesAtPcls , particles , pclIndicesGrid , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
+        ComputeSphPressureGradientAcceleration_Grid_Slice( accelerations , fluidDensitiesAtPcls , particles , neighborList , CellBox( numCells ) ) ;
     #endif
 #endif
 }
@@ -1255,7 +1045,7 @@ void ComputeSphMassDensityGradient_Grid( VECTOR< Vec3 > &
                                         , const VECTOR< SphFluidDensities > &       fluidDensitiesAtPcls
                                         , const VECTOR< Vorton > &                  particles
                                         , const VECTOR< float > &                   proximities
-                                        , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
+                                        , const SphNeighborList & neighborList
                                         , const float                               ambientDensity
                                         )
 {
@@ -1265,20 +1055,15 @@ void ComputeSphMassDensityGradient_Grid( VECTOR< Vec3 > &
     massDensityGradients.clear() ;
     massDensityGradients.resize( particles.Size() , Vec3( 0.0f , 0.0f , 0.0f ) ) ;
 
-    const unsigned & nz     = pclIndicesGrid.GetNumPoints( 2 ) ;
-    const unsigned   nzm1   = nz - 1 ;
+    const size_t * numCells = neighborList.GetNumCells() ;
+    const SphMassDensityGradientArrays arrays = { massDensityGradients , fluidDensitiesAtPcls , particles , proximities , neighborList , ambientDensity } ;
 
     #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
         // Compute particle number density using threading building blocks.
-        // Alternate between even and odd z-slices to avoid multiple threads accessing the same particles simultaneously.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , 
-            SphSim_ComputeSphMassDensityGradient_TBB( massDensityGradients , fluidDensitiesAtPcls , particles , proximities , pclIndicesGrid , ambientDensity , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) ,
-            SphSim_ComputeSphMassDensityGradient_TBB( massDensityGradients , fluidDensitiesAtPcls , particles , proximities , pclIndicesGrid , ambientDensity , VortonSim::PHASE_ODD  ) ) ;
+        // Visit blocks of cells in 8 colors, so that no two threads access the same particles simultaneously.
+        ForEachCellBlockByColor( numCells , Parallel::Function( ComputeSphMassDensityGradient_Grid_Slice , arrays ) ) ;
     #else
-        ComputeSphMassDensityGradient_Grid_Slice( massDensityGradients , fluidDensitiesAtPcls , particles , proximities , pclIndicesGrid , ambientDensity , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
+        ComputeSphMassDensityGradient_Grid_Slice( arrays , CellBox( numCells ) ) ;
     #endif
 
 //#error Experimental: Zero density gradients where their estimate is unreliable, to facilitate shutting off baroclinic vorticity generation there, to let linear acceleration operate there instead.
@@ -1294,13 +1079,271 @@ void ComputeSphMassDensityGradient_Grid( VECTOR< Vec3 > &
 
 
 
+/** Functor to accumulate density, and cache the gradient of the smoothing function, for each pair of smoothed particles.
+
+    Both depend only on the separation between particles, so computing them
+    together loads each pair of particles once.
+*/
+class DensityAndGradientKernelAccumulator
+{
+    public:
+        DensityAndGradientKernelAccumulator( DensityAccumulator & accumulateDensity , MassDensityGradientAccumulator & accumulateMassDensityGradient , const VECTOR< Vorton > & particles , GradientKernelArray & gradientKernels )
+            : mAccumulateDensity( accumulateDensity )
+            , mAccumulateMassDensityGradient( accumulateMassDensityGradient )
+            , mParticles( particles )
+            , mGradientKernels( gradientKernels )
+        {
+        }
+
+        void operator()( size_t idxA , size_t idxB , size_t idxPair )
+        {
+            const Vec3  sep     = mParticles[ idxA ].mPosition - mParticles[ idxB ].mPosition ;
+            const float dist2   = sep.Mag2() ;
+            mAccumulateDensity.AccumulatePair( idxA , idxB , dist2 ) ;
+            mAccumulateMassDensityGradient.EvaluateGradientKernel( idxA , idxB , sep , dist2 , mGradientKernels[ idxPair ] ) ;
+        }
+
+    private:
+        DensityAndGradientKernelAccumulator & operator=( const DensityAndGradientKernelAccumulator & ) ; // Prevent assignment
+
+        DensityAccumulator &                mAccumulateDensity              ; ///< Accumulates density of each pair.
+        MassDensityGradientAccumulator &    mAccumulateMassDensityGradient  ; ///< Evaluates gradient of smoothing function of each pair.
+        const VECTOR< Vorton > &            mParticles                      ; ///< Fluid particles.
+        GradientKernelArray &               mGradientKernels                ; ///< Gradient of smoothing function of each neighbor pair.
+} ;
+
+
+
+
+/** Functor to accumulate mass density gradient for each pair of smoothed particles, from cached smoothing function gradients.
+*/
+class CachedMassDensityGradientAccumulator
+{
+    public:
+        CachedMassDensityGradientAccumulator( MassDensityGradientAccumulator & accumulateMassDensityGradient , const GradientKernelArray & gradientKernels , const ParticleScalarArray & excessMassDensities )
+            : mAccumulateMassDensityGradient( accumulateMassDensityGradient )
+            , mGradientKernels( gradientKernels )
+            , mExcessMassDensities( excessMassDensities )
+        {
+        }
+
+        void operator()( size_t idxA , size_t idxB , size_t idxPair )
+        {
+            const Vec3 & gradKernel = mGradientKernels[ idxPair ] ;
+            if( ( gradKernel.x != 0.0f ) || ( gradKernel.y != 0.0f ) || ( gradKernel.z != 0.0f ) )
+            {   // Particles were close enough to contribute density gradient to each other.
+                mAccumulateMassDensityGradient.AccumulateGradient( idxA , idxB , mExcessMassDensities[ idxA ] , mExcessMassDensities[ idxB ] , gradKernel ) ;
+            }
+        }
+
+    private:
+        CachedMassDensityGradientAccumulator & operator=( const CachedMassDensityGradientAccumulator & ) ; // Prevent assignment
+
+        MassDensityGradientAccumulator &    mAccumulateMassDensityGradient  ; ///< Accumulates mass density gradient of each pair.
+        const GradientKernelArray &         mGradientKernels                ; ///< Gradient of smoothing function of each neighbor pair.
+        const ParticleScalarArray &         mExcessMassDensities            ; ///< Mass density of each particle in excess of ambient.
+} ;
+
+
+
+
+/** Run one pass of computing density and mass density gradient at each SPH particle using a uniform grid spatial partition, for a subset of the domain.
+
+    \see ComputeSphDensityAndMassDensityGradient_Grid
+*/
+static void ComputeSphDensityAndMassDensityGradient_Grid_Slice( SphDensityAndGradientPassE pass , const SphDensityAndGradientArrays & arrays , const CellBox & box )
+{
+    VECTOR< SphFluidDensities > &   fluidDensitiesAtPcls    = arrays.mFluidDensitiesAtPcls ;
+    VECTOR< Vec3 > &                massDensityGradients    = arrays.mMassDensityGradients ;
+    GradientKernelArray &           gradientKernels         = arrays.mGradientKernels ;
+    const ParticleScalarArray &     excessMassDensities     = arrays.mExcessMassDensities ;
+    const VECTOR< Vorton > &        particles               = arrays.mParticles ;
+    const VECTOR< float > &         proximities             = arrays.mProximities ;
+    const SphNeighborList &         neighborList            = arrays.mNeighborList ;
+    const float                     ambientDensity          = arrays.mAmbientDensity ;
+
+    PERF_BLOCK_INNER( VortonSim__ComputeSphDensityAndMassDensityGradient_Grid_Slice ) ;
+
+    if( 0 == particles.Size() )
+    {
+        return ;
+    }
+
+    ASSERT( fluidDensitiesAtPcls.Size() == particles.Size() ) ;
+    ASSERT( massDensityGradients.Size() == particles.Size() ) ;
+    ASSERT( gradientKernels.Size() == neighborList.GetNumPairs() ) ;
+    ASSERT( ! neighborList.IsEmpty() ) ; // Neighbor list must be populated.
+
+    const float pclRad          = particles[ 0 ].GetRadius() ;
+    const float influenceRadius = influenceRadiusScale * pclRad ;
+
+    ASSERT( influenceRadius <= neighborList.GetInfluenceRadius() ) ;
+
+    MassDensityGradientAccumulator accumulateMassDensityGradient( massDensityGradients , fluidDensitiesAtPcls , particles , proximities , influenceRadius , ambientDensity ) ;
+
+    if( SPH_PASS_DENSITY_AND_GRADIENT_KERNEL == pass )
+    {
+        DensityAccumulator                  accumulateDensity( fluidDensitiesAtPcls , particles , influenceRadius ) ;
+        DensityAndGradientKernelAccumulator accumulateDensityAndGradientKernel( accumulateDensity , accumulateMassDensityGradient , particles , gradientKernels ) ;
+        neighborList.ForEachIndexedPairInBox( box , accumulateDensityAndGradientKernel ) ;
+    }
+    else
+    {
+        ASSERT( SPH_PASS_MASS_DENSITY_GRADIENT == pass ) ;
+        ASSERT( excessMassDensities.Size() == particles.Size() ) ;
+        CachedMassDensityGradientAccumulator accumulateCachedMassDensityGradient( accumulateMassDensityGradient , gradientKernels , excessMassDensities ) ;
+        neighborList.ForEachIndexedPairInBox( box , accumulateCachedMassDensityGradient ) ;
+    }
+}
+
+
+
+
+/** Run one pass of ComputeSphDensityAndMassDensityGradient_Grid over the whole domain.
+*/
+static void RunSphDensityAndMassDensityGradientPass( SphDensityAndGradientPassE pass , const SphDensityAndGradientArrays & arrays )
+{
+    const size_t * numCells = arrays.mNeighborList.GetNumCells() ;
+
+    // Visit blocks of cells in 8 colors, so that no two threads access the same particles simultaneously.
+    ForEachCellBlockByColor( numCells , Parallel::Function( ComputeSphDensityAndMassDensityGradient_Grid_Slice , pass , arrays ) ) ;
+}
+
+
+
+
+/** Compute fluid particle density and mass density gradient at each SPH particle using a uniform grid spatial partition.
+
+    This has the same results as ComputeSphDensityAtParticles_Grid followed
+    by ComputeSphMassDensityGradient_Grid, but loads particle positions for
+    each neighbor pair once instead of twice.
+
+    The mass density gradient formula divides by number densities of both
+    particles in each pair, so it cannot accumulate until every number
+    density is complete.  So the first pass accumulates densities and caches
+    the gradient of the smoothing function for each pair, which depends only
+    on their separation.  The second pass combines those with densities,
+    without revisiting particles.
+
+    \param proximities  Partially truncated signed distance between each particle and the nearest wall.
+                        Since this only reads proximities in the second pass,
+                        the caller must compute them before calling this.
+
+    This is an O(N*k) operation where N is the number of particles and k is the
+    average number of particles in the neighborhood of one of the N particles.
+*/
+void ComputeSphDensityAndMassDensityGradient_Grid( VECTOR< SphFluidDensities > &    fluidDensitiesAtPcls
+                                                 , VECTOR< Vec3 > &                 massDensityGradients
+                                                 , const VECTOR< Vorton > &         particles
+                                                 , const VECTOR< float > &          proximities
+                                                 , const SphNeighborList &          neighborList
+                                                 , const float                      ambientDensity
+                                                 )
+{
+#if ENABLE_FLUID_BODY_SIMULATION
+    PERF_BLOCK( ComputeSphDensityAndMassDensityGradient_Grid ) ;
+
+    const size_t numPcls = particles.Size() ;
+
+    fluidDensitiesAtPcls.clear() ;
+    fluidDensitiesAtPcls.resize( numPcls , SphFluidDensities( 1.0f , 1.0f , 0.0f ) ) ;
+    massDensityGradients.clear() ;
+    massDensityGradients.resize( numPcls , Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+
+    if( 0 == numPcls )
+    {
+        return ;
+    }
+
+    InitializeDensitySelfInfluence( fluidDensitiesAtPcls , particles ) ;
+
+    GradientKernelArray gradientKernels ;
+    gradientKernels.Resize( neighborList.GetNumPairs() ) ;
+
+    ParticleScalarArray excessMassDensities ;
+
+    const SphDensityAndGradientArrays arrays = { fluidDensitiesAtPcls , massDensityGradients , gradientKernels , excessMassDensities , particles , proximities , neighborList , ambientDensity } ;
+
+    RunSphDensityAndMassDensityGradientPass( SPH_PASS_DENSITY_AND_GRADIENT_KERNEL , arrays ) ;
+
+    {   // Gather mass density of each particle into a compact array, so the next pass does not load whole particles.
+        const float pclRad          = particles[ 0 ].GetRadius() ;
+        const float influenceRadius = influenceRadiusScale * pclRad ;
+        const MassDensityGradientAccumulator accumulateMassDensityGradient( massDensityGradients , fluidDensitiesAtPcls , particles , proximities , influenceRadius , ambientDensity ) ;
+        excessMassDensities.Resize( numPcls ) ;
+        for( size_t idx = 0 ; idx < numPcls ; ++ idx )
+        {
+            excessMassDensities[ idx ] = accumulateMassDensityGradient.GetExcessMassDensity( idx ) ;
+        }
+    }
+
+    RunSphDensityAndMassDensityGradientPass( SPH_PASS_MASS_DENSITY_GRADIENT , arrays ) ;
+
+    {
+        const float pclRad          = particles[ 0 ].GetRadius() ;
+        const float influenceRadius = influenceRadiusScale * pclRad ;
+        SelectivelyZeroDensityGradient( massDensityGradients , fluidDensitiesAtPcls , proximities , influenceRadius ) ;
+    }
+#endif
+}
+
+
+
+
+/** Make mSphNeighborList hold candidate neighbor pairs of vortons, for the given influence radius.
+
+    \param timeStep         Amount of time by which to advance simulation.
+
+    \param uFrame           Frame counter, used to generate diagnostic files.
+
+    \param influenceRadius  Range within which SPH passes look for neighbors.
+
+    This partitions vortons and rebuilds the list only when some vorton has
+    moved more than half the Verlet skin since the last rebuild, or the
+    number of vortons or the influence radius changed.  Otherwise, SPH passes
+    reuse the existing list, and this skips partitioning entirely.
+
+    When USE_SPATIAL_HASH_FOR_SPH_NEIGHBORS is enabled, this finds neighbors
+    using a spatial hash with cells just wide enough to hold every candidate,
+    so outlying vortons, which stretch mGridTemplate, do not make every
+    vorton test more candidates.  mGridTemplate then only schedules SPH
+    passes.  Otherwise this partitions vortons into mSphVortonIndicesGrid,
+    which persists across rebuilds, so it reuses its memory, and moves only
+    the vortons that changed cells since the previous rebuild.
+*/
+void VortonSim::UpdateSphNeighborList( float timeStep , unsigned uFrame , float influenceRadius )
+{
+    PERF_BLOCK( VortonSim__UpdateSphNeighborList ) ;
+
+    if( ! mSphNeighborList.NeedsRebuild( * mVortons , influenceRadius ) )
+    {   // Vortons have not moved enough to invalidate neighbor list.
+        return ;
+    }
+
+#if USE_SPATIAL_HASH_FOR_SPH_NEIGHBORS
+    (void) timeStep ;
+    (void) uFrame ;
+    const float minCellSpacing = SphNeighborList::GetMinCellSpacing( influenceRadius ) ;
+    mSphVortonHash.Partition( * mVortons , minCellSpacing ) ;
+    UniformGridGeometry scheduleGrid ;
+    scheduleGrid.FitShape( mGridTemplate , minCellSpacing ) ;
+    mSphNeighborList.Build( * mVortons , mSphVortonHash , scheduleGrid , influenceRadius ) ;
+#else
+    PartitionVortons( timeStep , uFrame , mSphVortonIndicesGrid , SphNeighborList::GetMinCellSpacing( influenceRadius ) ) ;
+    mSphNeighborList.Build( * mVortons , mSphVortonIndicesGrid , influenceRadius ) ;
+#endif
+}
+
+
+
+
 #else
 
 /** Compute fluid particle acceleration due to pressure gradient at each SPH particle using direct summation.
 
     This is an O(N^2) operation where N is the number of particles.
 */
-void ComputeSphPressureGradientForce_Direct( VECTOR< Vec3 > & accelerations
+void ComputeSphPressureGradientForce_Direct( AccelerationArray & accelerations
                                             , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
                                             , const VECTOR< Vorton > & particles )
 {
@@ -1339,7 +1382,7 @@ void ComputeSphPressureGradientForce_Direct( VECTOR< Vec3 > & accelerations
 
 /** Apply a uniform body force (gravity/buoyancy) on each particle.
 */
-static void ApplyBodyForce( VECTOR< Vorton > & particles , const VECTOR< Vec3 > & accelerations , float ambientDensity , float timeStep , size_t idxPclStart , size_t idxPclEnd )
+static void ApplyBodyForce( VECTOR< Vorton > & particles , const AccelerationArray & accelerations , float ambientDensity , float timeStep , size_t idxPclStart , size_t idxPclEnd )
 {
     PERF_BLOCK( ApplyBodyForce ) ;
 
@@ -1390,6 +1433,8 @@ class VelocityDiffuser
             : mParticles( particles )
             , mInfluenceRadius( influenceRadius )
             , mInflRad2( influenceRadius * influenceRadius )
+            , mInvInflRad( 1.0f / influenceRadius )
+            , mInvInflRad2( 1.0f / mInflRad2 )
             , mTimeStep( timeStep )
             , mTangentialViscosityGain( 0.0f )
             , mRadialViscosityGain( radialViscosity * timeStep )
@@ -1409,14 +1454,15 @@ class VelocityDiffuser
             const float dist2   = sep.Mag2() ;
             if( dist2 < mInflRad2 )
             {   // Particles are near enough to exchange velocity.
-                const float     dist    = fsqrtf( dist2 ) ;
-                const Vec3      sepDir  = sep / dist ;
+                SphKernelTable::Sample kernel ;
+                gSphKernelTable.Evaluate( kernel , dist2 * mInvInflRad2 ) ;
+                const Vec3      sepDir  = sep * ( kernel.mInvR * mInvInflRad ) ;
                 Vec3 &          velB    = mParticles[ idxB ].mVelocity ;
                 const Vec3      velDiff = velA - velB ;
                 const float     velSep  = velDiff * sepDir ;
                 if( velSep < 0.0f )
                 {   // Particles are approaching.
-                    const float infl    = 1.0f - dist / mInfluenceRadius ;
+                    const float infl    = kernel.mQ ;
 #if 0
                     const float viscImp = infl * ( velSep * mTangentialViscosityGain + velSep * velSep * mRadialViscosityGain ) ;
                     const Vec3  imp     = sepDir * viscImp ;
@@ -1447,6 +1493,8 @@ class VelocityDiffuser
         VECTOR< Vorton > &  mParticles              ; ///< Fluid particles.
         const float         mInfluenceRadius        ; ///< Range of influence each particle has on others.
         const float         mInflRad2               ; ///< Square of mInfluenceRadius.
+        const float         mInvInflRad             ; ///< Reciprocal of mInfluenceRadius.
+        const float         mInvInflRad2            ; ///< Reciprocal of mInflRad2.
         const float         mTimeStep               ; ///< Amount of virtual time by which to advance simulation.
         const float         mTangentialViscosityGain; ///< Controls portion of tangential velocity to keep.
         const float         mRadialViscosityGain    ; ///< Controls portion of radial velocity to keep.
@@ -1455,11 +1503,59 @@ class VelocityDiffuser
 
 
 
+/** Functor to dissipate velocity of, and apply speed limit to, a smoothed particle.
+*/
+class VelocityDissipator
+{
+    public:
+        /** Construct a functor to dissipate velocity of, and apply speed limit to, a smoothed particle.
+        */
+        VelocityDissipator(
+                    VECTOR< Vorton > &  particles
+                ,   const float         viscousGain
+                ,   const float         speedLimit2
+            )
+            : mParticles( particles )
+            , mViscousGain( viscousGain )
+            , mSpeedLimit2( speedLimit2 )
+        {
+        }
+
+        void operator()( size_t idx )
+        {
+            // Dissipate velocity.
+            Vec3 & vel = mParticles[ idx ].mVelocity ;
+            vel *= mViscousGain ;
+
+            // Apply speed limit.
+            const float velMag2 =  vel.Mag2() ;
+            if( velMag2 > mSpeedLimit2 )
+            {   // Particle is going too fast.
+                const float reduction = fsqrtf( mSpeedLimit2 / velMag2 ) ;
+                vel *= reduction ;
+            }
+
+            ASSERT( ! IsNan( vel ) && ! IsInf( vel ) ) ;
+            ASSERT( ! IsInf( vel.Mag2() ) ) ;
+            ASSERT( vel.Mag2() < 1e8f ) ;
+        }
+
+    private:
+        VelocityDissipator & operator=( const VelocityDissipator & ) ; // Prevent assignment
+
+        VECTOR< Vorton > &  mParticles              ; ///< Fluid particles.
+        const float         mViscousGain            ; ///< Portion of velocity to keep.
+        const float         mSpeedLimit2            ; ///< Square of maximum speed.
+} ;
+
+
+
+
 #if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
 
 /** Compute fluid particle velocity diffusion and dissipation at each SPH particle using a uniform grid spatial partition, for a subset of the domain.
 */
-static void DiffuseAndDissipateVelocitySph_Grid_Slice( VECTOR< Vorton > & particles , const float timeStep , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , size_t izStart , size_t izEnd , VortonSim::PhaseE phase )
+static void DiffuseAndDissipateVelocitySph_Grid_Slice( VECTOR< Vorton > & particles , const float timeStep , const SphNeighborList & neighborList , const CellBox & box )
 {
     const size_t numPcls = particles.size() ;
     if( 0 == numPcls )
@@ -1467,121 +1563,23 @@ static void DiffuseAndDissipateVelocitySph_Grid_Slice( VECTOR< Vorton > & partic
         return ;
     }
 
-    ASSERT( ! pclIndicesGrid.Empty() ) ; // Spatial partition must be populated.
+    ASSERT( ! neighborList.IsEmpty() ) ; // Neighbor list must be populated.
 
     const float     pclRad          = particles[ 0 ].GetRadius() ;
     const float     inflRad         = 3.0f * pclRad ;
 
-    ASSERT( inflRad <= MIN3( pclIndicesGrid.GetCellSpacing().x , pclIndicesGrid.GetCellSpacing().y , pclIndicesGrid.GetCellSpacing().z ) ) ;
+    ASSERT( inflRad <= neighborList.GetInfluenceRadius() ) ;
 
     static float    radialViscosity = 30.0f ;
     static float    viscousGain     = 0.9999f ;
     const  float    speedLimit2     = 2.0f * stiffness ;
     static float    speedLimit      = sqrt( stiffness ) ;
 
-    VelocityDiffuser diffuseVelocity( particles , inflRad , timeStep , radialViscosity ) ;
-
-    const int &     nx      = pclIndicesGrid.GetNumPoints( 0 ) ;
-    const size_t    nxm1    = nx - 1 ;
-    const int &     ny      = pclIndicesGrid.GetNumPoints( 1 ) ;
-    const size_t    nym1    = ny - 1 ;
-    const int       nxy     = nx * ny ;
-
-    // Set up increment and offset for alternating odd-even access.
-    const size_t   zInc     =   VortonSim::PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t   flipper  = ( VortonSim::PHASE_ODD  == phase ) ? 1 : 0 ;
-    const size_t   izShift  = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
-
-    DEBUG_ONLY( const size_t & nz      = pclIndicesGrid.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t   nzm1    = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
-
-    // Note that the cell-neighborhood loop visits only half the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const int neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-        , -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-        ,  1 + nx       // + , + , 0 ( 4)
-        , -1 - nx + nxy // - , - , + ( 5)
-        ,    - nx + nxy // 0 , - , + ( 6)
-        ,  1 - nx + nxy // + , - , + ( 7)
-        , -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-        ,  1      + nxy // + , 0 , + (10)
-        , -1 + nx + nxy // - , 0 , + (11)
-        ,      nx + nxy // 0 , + , + (12)
-        ,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
-
-    const size_t gridCapacity = pclIndicesGrid.GetGridCapacity() ;
-
-    size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
-    {   // For all grid cells along z...
-        const size_t offsetZ0 = idx[2] * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
-        {   // For all grid cells along y...
-            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
-            {   // For all grid cells along x...
-                const size_t offsetX0Y0Z0 = idx[0] + offsetY0Z0 ;
-                const size_t numInCurrentCell = pclIndicesGrid[ offsetX0Y0Z0 ].Size() ;
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
-                {   // For each vorton in this gridcell...
-                    const unsigned &    rVortIdxHere    = pclIndicesGrid[ offsetX0Y0Z0 ][ ivHere ] ;
-
-                    // Aggregate density between particles that share a cell.
-                    // Notice that the loop only visits vortons with indices
-                    // following the "here" particle.  That is because each
-                    // visitation symmetrically modifies both vortons in the
-                    // pair.  If "here" and "there" is visited, then "there"
-                    // and "here" should not also be visited, because it
-                    // would be redundant.
-                    for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
-                    {   // For each OTHER particle within this same cell...
-                        const unsigned &    rVortIdxThere   = pclIndicesGrid[ offsetX0Y0Z0 ][ ivThere ] ;
-                        diffuseVelocity( rVortIdxHere , rVortIdxThere ) ;
-                    }
-
-                    // Aggregate density between particles in adjacent cells.
-                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                    {   // For each cell in neighborhood...
-                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of adjacent cell
-                        if( cellOffset >= gridCapacity ) break ; // Would-be neighbor is out-of-bounds.
-                        const VECTOR< unsigned > & cell = pclIndicesGrid[ cellOffset ] ;
-                        for( unsigned ivThere = 0 ; ivThere < cell.Size() ; ++ ivThere )
-                        {   // For each vorton in the visited cell...
-                            const unsigned &    rVortIdxThere   = cell[ ivThere ] ;
-                            diffuseVelocity( rVortIdxHere , rVortIdxThere ) ;
-                        }
-                    }
-
-                    // Dissipate velocity.
-                    Vec3 & vel = particles[ rVortIdxHere ].mVelocity ;
-                    vel *= viscousGain ;
+    VelocityDiffuser    diffuseVelocity( particles , inflRad , timeStep , radialViscosity ) ;
+    VelocityDissipator  dissipateVelocity( particles , viscousGain , speedLimit2 ) ;
 
-                    // Apply speed limit.
-                    const float velMag2 =  vel.Mag2() ;
-                    if( velMag2 > speedLimit2 )
-                    {   // Particle is going too fast.
-                        const float reduction = fsqrtf( speedLimit2 / velMag2 ) ;
-                        vel *= reduction ;
-                    }
-
-                    ASSERT( ! IsNan( vel ) && ! IsInf( vel ) ) ;
-                    ASSERT( ! IsInf( vel.Mag2() ) ) ;
-                    ASSERT( vel.Mag2() < 1e8f ) ;
-                }
-            }
-        }
-    }
+    // Exchange velocity between each pair of candidate neighbors, then dissipate velocity of each "here" particle.
+    neighborList.ForEachPairInBox( box , diffuseVelocity , dissipateVelocity ) ;
 }
 
 
@@ -1592,25 +1590,19 @@ static void DiffuseAndDissipateVelocitySph_Grid_Slice( VECTOR< Vorton > & partic
     This is an O(N*k) operation where N is the number of particles and k is the
     average number of particles in the neighborhood of one of the N particles.
 */
-static void DiffuseAndDissipateVelocitySph_Grid( VECTOR< Vorton > & particles , const float timeStep , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid )
+static void DiffuseAndDissipateVelocitySph_Grid( VECTOR< Vorton > & particles , const float timeStep , const SphNeighborList & neighborList )
 {
 #if ENABLE_FLUID_BODY_SIMULATION
     PERF_BLOCK( DiffuseAndDissipateVelocitySph_Grid ) ;
 
-    const unsigned & nz     = pclIndicesGrid.GetNumPoints( 2 ) ;
-    const unsigned   nzm1   = nz - 1 ;
+    const size_t * numCells = neighborList.GetNumCells() ;
 
     #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
         // Compute particle number density using threading building blocks.
-        // Alternate between even and odd z-slices to avoid multiple threads accessing the same particles simultaneously.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , 
-            SphSim_DiffuseAndDissipateVelocity_TBB( particles , timeStep , pclIndicesGrid , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) ,
-            SphSim_DiffuseAndDissipateVelocity_TBB( particles , timeStep , pclIndicesGrid , VortonSim::PHASE_ODD  ) ) ;
+        // Visit blocks of cells in 8 colors, so that no two threads access the same particles simultaneously.
+        ForEachCellBlockByColor( numCells , Parallel::Function( DiffuseAndDissipateVelocitySph_Grid_Slice , particles , timeStep , neighborList ) ) ;
     #else
-        DiffuseAndDissipateVelocitySph_Grid_Slice( particles , timeStep , pclIndicesGrid , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
+        DiffuseAndDissipateVelocitySph_Grid_Slice( particles , timeStep , neighborList , CellBox( numCells ) ) ;
     #endif
 #endif
 }
@@ -1693,34 +1685,40 @@ void VortonSim::UpdateSmoothedParticleHydrodynamics( float timeStep , unsigned u
         return ;
     }
 
-    VECTOR< Vec3 >              accelerationOfPcls ;
+    AccelerationArray           accelerationOfPcls ;
 
 #if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
     const float pclRad  = ( * mVortons )[ 0 ].GetRadius() ;
     const float inflRad = influenceRadiusScale * pclRad ;   // Make grid cell big enough to include all possible neighbors.
 
-    UniformGrid< VECTOR< unsigned > >   vortonIndicesGrid  ;   ///< Spatial partition of indices into mVortons.
-    PartitionVortons( timeStep , uFrame , vortonIndicesGrid , inflRad ) ;
+    UpdateSphNeighborList( timeStep , uFrame , inflRad ) ;
 #endif
 
     UNUSED_PARAM( uFrame ) ;
 
 #if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
-    ComputeSphDensityAtParticles_Grid( mFluidDensitiesAtPcls , * mVortons , vortonIndicesGrid ) ;
+    ComputeSphDensityAtParticles_Grid( mFluidDensitiesAtPcls , * mVortons , mSphNeighborList ) ;
 #else
     ComputeSphDensityAtParticles_Direct( mFluidDensitiesAtPcls , * mVortons ) ;
 #endif
 
-#if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
-    ComputeSphPressureGradientAcceleration_Grid( accelerationOfPcls , mFluidDensitiesAtPcls , * mVortons , vortonIndicesGrid ) ;
+#if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH && USE_SPH_DENSITY_CONSTRAINTS
+    // Density constraints replace pressure, so only body forces accelerate particles before solving constraints.
+    accelerationOfPcls.Resize( mVortons->Size() , Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+#elif USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
+    ComputeSphPressureGradientAcceleration_Grid( accelerationOfPcls , mFluidDensitiesAtPcls , * mVortons , mSphNeighborList ) ;
 #else
     ComputeSphPressureGradientForce_Direct( accelerationOfPcls , mFluidDensitiesAtPcls , * mVortons ) ;
 #endif
 
     ApplyBodyForce( * mVortons , accelerationOfPcls , mAmbientDensity , timeStep , 0 , mVortons->Size() ) ;
 
+#if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH && USE_SPH_DENSITY_CONSTRAINTS
+    SolveSphDensityConstraints( * mVortons , mSphNeighborList , inflRad , targetNumberDensity , timeStep ) ;
+#endif
+
 #if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
-    DiffuseAndDissipateVelocitySph_Grid( * mVortons , timeStep , vortonIndicesGrid ) ;
+    DiffuseAndDissipateVelocitySph_Grid( * mVortons , timeStep , mSphNeighborList ) ;
 #else
     DiffuseAndDissipateVelocitySph_Direct( * mVortons , timeStep ) ;
 #endif
@@ -1785,7 +1783,7 @@ void ComputePressureGradient( UniformGridGeometry gridTemplate , UniformGrid< Ve
 
     \see ComputeDensityGradientFromVortons
 */
-void ComputeDensityGradientFromVortons_Slice( VECTOR< Vec3 > & densityGradients , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , const VECTOR< Vorton > & vortons , size_t izStart , size_t izEnd )
+void ComputeDensityGradientFromVortons_Slice( VECTOR< Vec3 > & densityGradients , const CellList & pclIndicesGrid , const VECTOR< Vorton > & vortons , size_t izStart , size_t izEnd )
 {
     if( pclIndicesGrid.Empty() )
     {   // No vortons.
@@ -1808,71 +1806,77 @@ void ComputeDensityGradientFromVortons_Slice( VECTOR< Vec3 > & densityGradients
     size_t idx[3] ;
     for( idx[2] = izStart ; idx[2] < izEnd ; ++ idx[2] )
     for( idx[1] = 0       ; idx[1] < ny    ; ++ idx[1] )
-    for( idx[0] = 0       ; idx[0] < nx    ; ++ idx[0] )
-    {   // For all gridpoints...
-        const size_t offsetHere = pclIndicesGrid.OffsetFromIndices( idx ) ;
-        const size_t numVortonsHere = pclIndicesGrid[ offsetHere ].Size() ;
-        for( unsigned ivHere = 0 ; ivHere < numVortonsHere ; ++ ivHere )
-        {   // For each vorton in here gridcell...
-            const unsigned  vortIdxHere     = pclIndicesGrid[ offsetHere ][ ivHere ] ;
-            const Vorton &  vortonHere      = vortons[ vortIdxHere ] ;
-            const Vec3 &    posHere         = vortonHere.mPosition ;
-            const float &   densHere        = vortonHere.mDensity ;
-            float           weightSum       = 0.0f ;
-
-            Vec3 & rDensGrad = densityGradients[ vortIdxHere ] ;
-            rDensGrad = Vec3( 0.0f , 0.0f , 0.0f ) ;
-
-            DEBUG_ONLY( elementsAssigned[ vortIdxHere ] = true ) ;
-
-            size_t jdx[3] ;
-            for( jdx[2] = idx[2] - 1 ; jdx[2] < idx[2] + 1 ; ++ jdx[2] )
-            for( jdx[1] = idx[1] - 1 ; jdx[1] < idx[1] + 1 ; ++ jdx[1] )
-            for( jdx[0] = idx[0] - 1 ; jdx[0] < idx[0] + 1 ; ++ jdx[0] )
-            {   // For each cell at or adjacent to that containing current vorton...
-                if( ( jdx[0] < nx ) && ( jdx[1] < ny ) && ( jdx[2] < nz ) )
-                {
-                    const size_t offsetThere        = pclIndicesGrid.OffsetFromIndices( jdx ) ;
-                    const size_t numVortonsThere    = pclIndicesGrid[ offsetThere ].Size() ;
-                    for( unsigned ivThere = 0 ; ivThere < numVortonsThere ; ++ ivThere )
-                    {   // For each vorton in there gridcell...
-                        const unsigned  vortIdxThere    = pclIndicesGrid[ offsetThere ][ ivThere ] ;
-                        if( vortIdxHere != vortIdxThere )
-                        {   // Here and There vortices differ.
-                            // NOTE: This routine uses too naive a formulation
-                            //      for spatial gradient.  The failure is most
-                            //      obvious in a couple of cases: (1) If all
-                            //      neighboring vortons have the same density,
-                            //      then the density gradient will be zero,
-                            //      even for overlapping particles where the
-                            //      density would be higher in that region.
-                            //      (2) If vortons are on the boundary of a
-                            //      region/blob then this formula does not
-                            //      compute any derivatives in that direction,
-                            //      which in many cases would be the direction
-                            //      with the most important contribution to the
-                            //      gradient.
-                            const Vorton &  vortonThere     = vortons[ vortIdxThere ] ;
-                            const Vec3 &    posThere        = vortonThere.mPosition ;
-                            const Vec3      separation      = posHere - posThere ;
-                            const float     sepLen2         = separation.Mag2() ;
-                            const float &   densThere       = vortonHere.mDensity ;
-                            const float     densDiff        = densHere - densThere ;
-                            const float     weight          = 1.0f / sepLen2 ;  // There are many choices for weight.  This one is singular and non-compact.  Probably worst possible choice.  But it's cheap.
-                            const Vec3      densGradTerm    = densDiff * separation / sepLen2 ;
-                            rDensGrad += densGradTerm * weight ;
-                            ASSERT( ! IsNan( rDensGrad ) && ! IsInf( rDensGrad ) ) ;
-                            weightSum += weight ;
+    {   // For all rows of gridpoints...
+        idx[0] = 0 ;
+        const size_t rowBegin = pclIndicesGrid.OffsetFromIndices( idx ) ;
+        const size_t rowEnd   = rowBegin + nx ;
+        for( size_t offsetHere = pclIndicesGrid.FindOccupiedCell( rowBegin , rowEnd ) ; offsetHere < rowEnd ; offsetHere = pclIndicesGrid.FindOccupiedCell( offsetHere + 1 , rowEnd ) )
+        {   // For each occupied gridpoint in row...
+            idx[0] = offsetHere - rowBegin ;
+            const size_t numVortonsHere = pclIndicesGrid[ offsetHere ].Size() ;
+            for( unsigned ivHere = 0 ; ivHere < numVortonsHere ; ++ ivHere )
+            {   // For each vorton in here gridcell...
+                const unsigned  vortIdxHere     = pclIndicesGrid[ offsetHere ][ ivHere ] ;
+                const Vorton &  vortonHere      = vortons[ vortIdxHere ] ;
+                const Vec3 &    posHere         = vortonHere.mPosition ;
+                const float &   densHere        = vortonHere.mDensity ;
+                float           weightSum       = 0.0f ;
+
+                Vec3 & rDensGrad = densityGradients[ vortIdxHere ] ;
+                rDensGrad = Vec3( 0.0f , 0.0f , 0.0f ) ;
+
+                DEBUG_ONLY( elementsAssigned[ vortIdxHere ] = true ) ;
+
+                size_t jdx[3] ;
+                for( jdx[2] = idx[2] - 1 ; jdx[2] < idx[2] + 1 ; ++ jdx[2] )
+                for( jdx[1] = idx[1] - 1 ; jdx[1] < idx[1] + 1 ; ++ jdx[1] )
+                for( jdx[0] = idx[0] - 1 ; jdx[0] < idx[0] + 1 ; ++ jdx[0] )
+                {   // For each cell at or adjacent to that containing current vorton...
+                    if( ( jdx[0] < nx ) && ( jdx[1] < ny ) && ( jdx[2] < nz ) )
+                    {
+                        const size_t offsetThere        = pclIndicesGrid.OffsetFromIndices( jdx ) ;
+                        if( ! pclIndicesGrid.IsOccupied( offsetThere ) ) continue ;
+                        const size_t numVortonsThere    = pclIndicesGrid[ offsetThere ].Size() ;
+                        for( unsigned ivThere = 0 ; ivThere < numVortonsThere ; ++ ivThere )
+                        {   // For each vorton in there gridcell...
+                            const unsigned  vortIdxThere    = pclIndicesGrid[ offsetThere ][ ivThere ] ;
+                            if( vortIdxHere != vortIdxThere )
+                            {   // Here and There vortices differ.
+                                // NOTE: This routine uses too naive a formulation
+                                //      for spatial gradient.  The failure is most
+                                //      obvious in a couple of cases: (1) If all
+                                //      neighboring vortons have the same density,
+                                //      then the density gradient will be zero,
+                                //      even for overlapping particles where the
+                                //      density would be higher in that region.
+                                //      (2) If vortons are on the boundary of a
+                                //      region/blob then this formula does not
+                                //      compute any derivatives in that direction,
+                                //      which in many cases would be the direction
+                                //      with the most important contribution to the
+                                //      gradient.
+                                const Vorton &  vortonThere     = vortons[ vortIdxThere ] ;
+                                const Vec3 &    posThere        = vortonThere.mPosition ;
+                                const Vec3      separation      = posHere - posThere ;
+                                const float     sepLen2         = separation.Mag2() ;
+                                const float &   densThere       = vortonHere.mDensity ;
+                                const float     densDiff        = densHere - densThere ;
+                                const float     weight          = 1.0f / sepLen2 ;  // There are many choices for weight.  This one is singular and non-compact.  Probably worst possible choice.  But it's cheap.
+                                const Vec3      densGradTerm    = densDiff * separation / sepLen2 ;
+                                rDensGrad += densGradTerm * weight ;
+                                ASSERT( ! IsNan( rDensGrad ) && ! IsInf( rDensGrad ) ) ;
+                                weightSum += weight ;
+                            }
                         }
                     }
                 }
+                ASSERT( weightSum >= 0.0f ) ;
+                if( weightSum > 0.0f )
+                {
+                    rDensGrad /= weightSum ;
+                }
+                ASSERT( ! IsNan( rDensGrad ) && ! IsInf( rDensGrad ) ) ;
             }
-            ASSERT( weightSum >= 0.0f ) ;
-            if( weightSum > 0.0f )
-            {
-                rDensGrad /= weightSum ;
-            }
-            ASSERT( ! IsNan( rDensGrad ) && ! IsInf( rDensGrad ) ) ;
         }
     }
 
@@ -1893,7 +1897,7 @@ void ComputeDensityGradientFromVortons_Slice( VECTOR< Vec3 > & densityGradients
     \see ComputeDensityGradientFromVortons_Slice
 
 */
-void ComputeDensityGradientFromVortons( VECTOR< Vec3 > & densityGradient , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , const VECTOR< Vorton > & vortons )
+void ComputeDensityGradientFromVortons( VECTOR< Vec3 > & densityGradient , const CellList & pclIndicesGrid , const VECTOR< Vorton > & vortons )
 {
     PERF_BLOCK( ComputeDensityGradientFromVortons ) ;
 
@@ -1903,7 +1907,7 @@ void ComputeDensityGradientFromVortons( VECTOR< Vec3 > & densityGradient , const
         // Estimate grain size based on size of problem and number of processors.
         const size_t grainSize =  Max2( 1 , nz / gNumberOfProcessors ) ;
         // Compute ... using threading building blocks.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nz , grainSize ) , VortonSim_ComputeDensityGradientFromParticles_TBB( densityGradient , pclIndicesGrid , vortons ) ) ;
+        Parallel::For( 0 , nz , grainSize , VortonSim_ComputeDensityGradientFromParticles_TBB( densityGradient , pclIndicesGrid , vortons ) ) ;
     #else
         ComputeDensityGradientFromVortons_Slice( densityGradient , pclIndicesGrid , vortons , 0 , nz ) ;
     #endif
@@ -1925,19 +1929,27 @@ void ComputeDensityGradientFromVortons( VECTOR< Vec3 > & densityGradient , const
 
 #if REDUCE_CONVERGENCE
 
-/** Push particles apart.
+/// Per-vorton displacements, which only live during one call to ReduceDivergence.
+typedef VECTOR< Vec3 , FrameArenaAllocator< Vec3 > > DisplacementArray ;
+
+
+
 
-    \param  displacementMax Maximum amount of unacceptable particle overlap encountered.
+/** Return how far to push the first given particle, away from the second, so they overlap less.
+
+    \param  overlapMax  (in/out) Maximum amount of unacceptable particle overlap encountered.
+
+    The second particle gets pushed the opposite way when its own turn comes.
 
     \see ReduceDivergence, ReduceDivergence_Direct.
 */
-static inline void PushParticles( Vorton & rVortonHere , Vorton & rVortonThere , float & displacementMax )
+static inline Vec3 ComputePushDisplacement( const Vorton & vortonHere , const Vorton & vortonThere , float & overlapMax )
 {
-    ASSERT( rVortonHere.IsAlive() ) ;
-    ASSERT( rVortonThere.IsAlive() ) ;
-    const Vec3      separation      = rVortonHere.mPosition - rVortonThere.mPosition ;
+    ASSERT( vortonHere.IsAlive() ) ;
+    ASSERT( vortonThere.IsAlive() ) ;
+    const Vec3      separation      = vortonHere.mPosition - vortonThere.mPosition ;
     const float     dist2           = separation.Mag2() ;
-    const float     radiusSum       = ( rVortonHere.mSize + rVortonThere.mSize ) * 0.5f ; // 1/2 because size=2*radius
+    const float     radiusSum       = ( vortonHere.mSize + vortonThere.mSize ) * 0.5f ; // 1/2 because size=2*radius
     // Note, this should allow for spheres to be closer, such that average
     // density in grid could equal average density of particles.  Highest
     // density of packed spheres has 12 adjacent with average density
@@ -1956,141 +1968,99 @@ static inline void PushParticles( Vorton & rVortonHere , Vorton & rVortonThere ,
         const float displacementHalf    = 0.5f * fsqrtf( displacement2 ) ;
         const Vec3  displacementDir     = separation.GetDir() ;
         static const float gain = 0.125f ;
-        const Vec3  displacementEach    = gain * displacementHalf * displacementDir ;
-
-        rVortonHere.mPosition  += displacementEach ;
-        rVortonThere.mPosition -= displacementEach ;
-        displacementMax = Max2( displacementHalf , displacementMax ) ;
-
-    #if ENABLE_DISPLACEMENT_TRACKING
-       rVortonHere.mDisplacement  += displacementEach ; // Track vorton displacement to transfer it to tracers.
-       rVortonThere.mDisplacement += displacementEach ; // Track vorton displacement to transfer it to tracers.
-    #endif
+        overlapMax = Max2( displacementHalf , overlapMax ) ;
+        return gain * displacementHalf * displacementDir ;
     }
-    displacementMax = Max2( 0.0f , displacementMax ) ;
+    return Vec3( 0.0f , 0.0f , 0.0f ) ;
 }
 
 
 
 
-/** Push apart particles that are too close, visiting pairs of particles that are near each other.
+/** Compute how far to push each particle in a range of z layers of cells, away from particles too close to it.
 
-    \note   This invalidates pclIndicesGrid in the sense that this routine
-            pushes particles around and potentially out of the grid cell in
-            which they started.  This routine uses pclIndicesGrid to partition
-            particles and to find neighbors, and even when they get pushed
-            around, the neighbor relationships likely remain the same, so in
-            that sense, the invalidity of pclIndicesGrid is not crucial;
-            memory will not be accessed out-of-bounds due to how particles
-            are pushed out of their grid cells.
-            Due to this property, it is possible that this routine could find
-            zero displacementMax even though some particles are too close to
-            each other. ReduceDivergence_Direct does not have this problem since
-            it indiscriminately visits every particle pair, including pairs
-            which are very far apart.
+    \param  overlapMax  (in/out) Maximum amount of unacceptable particle overlap encountered.
 
-    \see PushParticles, ReduceDivergence, ReduceDivergence_Direct.
-*/
-static void ReduceDivergence_Grid_Slice( VECTOR< Vorton > * vortons , float & displacementMax , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , size_t izStart , size_t izEnd , VortonSim::PhaseE phase )
-{
-    if( pclIndicesGrid.Empty() )
-    {   // No vortons.
-        return ;
-    }
+    This only reads particles and only writes the displacement of each
+    particle it visits, so layers can run concurrently without coloring
+    cells, and results do not depend on the order in which they run.
 
-    // Exchange vorticity with nearest neighbors
+    \note   Use the same pclIndicesGrid for every iteration of ReduceDivergence.
+            Pushing particles can move them out of the cells in which they
+            started, but neighbor relationships likely remain the same, so
+            the cells still serve to find neighbors.  Due to this property, it
+            is possible that this routine could find zero overlapMax even
+            though some particles are too close to each other.
+            ReduceDivergence_Direct does not have this problem since it
+            indiscriminately visits every particle pair, including pairs which
+            are very far apart.
 
-    const int &     nx      = pclIndicesGrid.GetNumPoints( 0 ) ;
-    const size_t    nxm1    = nx - 1 ;
-    const int &     ny      = pclIndicesGrid.GetNumPoints( 1 ) ;
-    const size_t    nym1    = ny - 1 ;
-    const int       nxy     = nx * ny ;
+    Given ISPC kernels, this gathers indices of each particle's neighbors,
+    then pushes it away from all of them in one kernel call.
 
-    // Set up increment and offset for alternating odd-even access.
-    const size_t   zInc     =   VortonSim::PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t   flipper  = ( VortonSim::PHASE_ODD  == phase ) ? 1 : 0 ;
-    const size_t   izShift  = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
+    \see ComputePushDisplacement, ReduceDivergence, ReduceDivergence_Direct.
+*/
+static void ReduceDivergence_Gather_Slice( const VECTOR< Vorton > & vortons , DisplacementArray & displacements , const CellList & pclIndicesGrid , size_t izBegin , size_t izEnd , float & overlapMax )
+{
+    static const float gain = 0.125f ; // Same as in ComputePushDisplacement.
 
-    DEBUG_ONLY( const size_t & nz      = pclIndicesGrid.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t   nzm1    = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
-
-    // Note that the cell-neighborhood loop visits only half the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const int neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-      //, -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-        ,  1 + nx       // + , + , 0 ( 4)
-      //, -1 - nx + nxy // - , - , + ( 5)
-      //,    - nx + nxy // 0 , - , + ( 6)
-      //,  1 - nx + nxy // + , - , + ( 7)
-      //, -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-        ,  1      + nxy // + , 0 , + (10)
-      //, -1 + nx + nxy // - , 0 , + (11)
-        ,      nx + nxy // 0 , + , + (12)
-        ,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
-
-    const size_t gridCapacity = pclIndicesGrid.GetGridCapacity() ;
-
-    displacementMax = - FLT_MAX ;
+    const size_t    nx          = pclIndicesGrid.GetNumPoints( 0 ) ;
+    const size_t    nxy         = nx * pclIndicesGrid.GetNumPoints( 1 ) ;
+    const size_t    numCells[3] = { pclIndicesGrid.GetNumCells( 0 ) , pclIndicesGrid.GetNumCells( 1 ) , pclIndicesGrid.GetNumCells( 2 ) } ;
+    const FluidKernelTable * ispcKernels = FluidKernels::GetTable() ;
+    VECTOR< unsigned >  neighbors ; // Indices of neighbors of the vorton being pushed, when using ispcKernels.
 
     size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
+    for( idx[2] = izBegin ; idx[2] < izEnd ; ++ idx[2] )
     {   // For all grid cells along z...
-        const size_t offsetZ0 =   idx[2]       * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
+        for( idx[1] = 0 ; idx[1] < numCells[1] ; ++ idx[1] )
         {   // For all grid cells along y...
-            const size_t offsetY0Z0 =   idx[1]       * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
+            for( idx[0] = 0 ; idx[0] < numCells[0] ; ++ idx[0] )
             {   // For all grid cells along x...
-                const size_t offsetX0Y0Z0 = idx[0]     + offsetY0Z0 ;
-                const size_t numInCurrentCell = pclIndicesGrid[ offsetX0Y0Z0 ].Size() ;
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
+                const CellList::Cell    cellHere    = pclIndicesGrid[ idx ] ;
+                size_t                  idxBegin[3] ;
+                size_t                  idxEnd[3]   ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // Neighborhood spans adjacent cells, clipped to the grid.
+                    idxBegin[ axis ] = ( idx[ axis ] > 0 ) ? idx[ axis ] - 1 : 0 ;
+                    idxEnd  [ axis ] = Min2( idx[ axis ] + 2 , numCells[ axis ] ) ;
+                }
+                for( size_t ivHere = 0 ; ivHere < cellHere.Size() ; ++ ivHere )
                 {   // For each vorton in this gridcell...
-                    const unsigned &    rVortIdxHere    = pclIndicesGrid[ offsetX0Y0Z0 ][ ivHere ] ;
-                    Vorton &            rVortonHere     = (*vortons)[ rVortIdxHere ] ;
-                    ASSERT( rVortonHere.IsAlive() ) ;
-
-                    // Push particles that share a cell.
-                    // Notice that the loop only visits vortons with indices
-                    // following the "here" particle.  That is because each
-                    // visitation symmetrically modifies both vortons in the
-                    // pair.  If "here" and "there" is visited, then "there" and
-                    // "here" should not also be visited, because it would be
-                    // redundant.
-                    for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
-                    {   // For each OTHER particle within this same cell...
-                        const unsigned &    rVortIdxThere   = pclIndicesGrid[ offsetX0Y0Z0 ][ ivThere ] ;
-                        Vorton &            rVortonThere    = (*vortons)[ rVortIdxThere ] ;
-                        PushParticles( rVortonHere , rVortonThere , displacementMax ) ;
-                    }
-
-                    // Push particles in adjacent cells.
-                    // Note that each of the following sections visits only
-                    // cells in the positive direction.  That is because each
-                    // visitation is symmetric so there is no need to visit
-                    // particles in cells in the negative direction.
-                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                    {   // For each cell in neighborhood...
-                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of adjacent cell
-                        if( cellOffset >= gridCapacity ) break ; // Would-be neighbor is out-of-bounds.
-                        const VECTOR< unsigned > & cell = pclIndicesGrid[ cellOffset ] ;
-                        for( unsigned ivThere = 0 ; ivThere < cell.Size() ; ++ ivThere )
+                    const unsigned  iVortonHere     = cellHere[ ivHere ] ;
+                    const Vorton &  vortonHere      = vortons[ iVortonHere ] ;
+                    Vec3            displacement( 0.0f , 0.0f , 0.0f ) ;
+                    size_t          idxThere[3] ;
+                    for( idxThere[2] = idxBegin[2] ; idxThere[2] < idxEnd[2] ; ++ idxThere[2] )
+                    for( idxThere[1] = idxBegin[1] ; idxThere[1] < idxEnd[1] ; ++ idxThere[1] )
+                    for( idxThere[0] = idxBegin[0] ; idxThere[0] < idxEnd[0] ; ++ idxThere[0] )
+                    {   // For each cell in neighborhood, including this one...
+                        const CellList::Cell cellThere = pclIndicesGrid[ idxThere[0] + nx * idxThere[1] + nxy * idxThere[2] ] ;
+                        for( size_t ivThere = 0 ; ivThere < cellThere.Size() ; ++ ivThere )
                         {   // For each vorton in the visited cell...
-                            const unsigned &    rVortIdxThere   = cell[ ivThere ] ;
-                            Vorton &            rVortonThere    = (*vortons)[ rVortIdxThere ] ;
-                            PushParticles( rVortonHere , rVortonThere , displacementMax ) ;
+                            const unsigned iVortonThere = cellThere[ ivThere ] ;
+                            if( iVortonThere != iVortonHere )
+                            {   // Vorton is not the one being pushed.
+                                if( ispcKernels != NULL )
+                                {   // Defer to kernel, below.
+                                    neighbors.PushBack( iVortonThere ) ;
+                                }
+                                else
+                                {
+                                    displacement += ComputePushDisplacement( vortonHere , vortons[ iVortonThere ] , overlapMax ) ;
+                                }
+                            }
                         }
                     }
+                    if( ! neighbors.Empty() )
+                    {   // Push vorton away from all its neighbors at once.
+                        const Vorton & rVorton0 = vortons[ 0 ] ;
+                        const float overlapHere = ispcKernels->mAccumulatePushDisplacement( & rVorton0.mPosition.x , & rVorton0.mPosition.y , & rVorton0.mPosition.z , & rVorton0.mSize , int( sizeof( Vorton ) / sizeof( float ) )
+                                                                                          , iVortonHere , & neighbors[ 0 ] , int( neighbors.Size() ) , gain , & displacement.x ) ;
+                        overlapMax = Max2( overlapHere , overlapMax ) ;
+                        neighbors.Clear() ;
+                    }
+                    displacements[ iVortonHere ] = displacement ;
                 }
             }
         }
@@ -2100,6 +2070,22 @@ static void ReduceDivergence_Grid_Slice( VECTOR< Vorton > * vortons , float & di
 
 
 
+/** Move each particle in the given range by its displacement.
+*/
+static void ReduceDivergence_Apply_Slice( VECTOR< Vorton > & vortons , const DisplacementArray & displacements , size_t iPclBegin , size_t iPclEnd )
+{
+    for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+    {   // For each vorton in range...
+        vortons[ iPcl ].mPosition += displacements[ iPcl ] ;
+    #if ENABLE_DISPLACEMENT_TRACKING
+        vortons[ iPcl ].mDisplacement += displacements[ iPcl ] ; // Track vorton displacement to transfer it to tracers.
+    #endif
+    }
+}
+
+
+
+
 #if 0
 
 /** Push apart particles that are too close, visiting every pair of particles.
@@ -2108,18 +2094,20 @@ static float ReduceDivergence_Direct( VECTOR< Vorton > * vortons )
 {
     PERF_BLOCK( ReduceDivergence_Direct ) ;
 
-    float displacementMax = - FLT_MAX ;
+    float overlapMax = 0.0f ;
     const size_t numParticles = vortons->Size() ;
     for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
     {   // For each particle...
         Vorton & vortonHere = (*vortons)[ iPcl ] ;
         for( size_t ivThere = iPcl + 1 ; ivThere < numParticles ; ++ ivThere )
         {   // For each other particle...
-            Vorton & vortonThere = (*vortons)[ ivThere ] ;
-            PushParticles( vortonHere , vortonThere , displacementMax ) ;
+            Vorton &    vortonThere     = (*vortons)[ ivThere ] ;
+            const Vec3  displacement    = ComputePushDisplacement( vortonHere , vortonThere , overlapMax ) ;
+            vortonHere.mPosition  += displacement ;
+            vortonThere.mPosition -= displacement ;
         }
     }
-    return displacementMax ;
+    return overlapMax ;
 }
 
 #endif
@@ -2127,43 +2115,59 @@ static float ReduceDivergence_Direct( VECTOR< Vorton > * vortons )
 
 
 
-/** Push apart particles that are too close.
+/** Push apart particles that are too close, iterating until they hardly overlap.
+
+    Each iteration is a Jacobi step: it computes how far to push every
+    particle, from positions as of the previous iteration, then moves them
+    all.  Both stages run in parallel, and the first also finds the worst
+    overlap, by parallel reduction.  Iterations stop once the worst overlap
+    drops below a tolerance, so well-separated particles cost one pass
+    (which moves nothing), while packed particles converge instead of
+    drifting a little each frame.
 
-    \note   This invalidates mesh bounding box and pclIndicesGrid. 
+    \return Worst overlap that the final iteration found, or zero if there are no particles.
+
+    \note   This invalidates mesh bounding box and pclIndicesGrid.
 */
-float VortonSim::ReduceDivergence( VECTOR< Vorton > * vortons , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid )
+float VortonSim::ReduceDivergence( VECTOR< Vorton > * vortons , const CellList & pclIndicesGrid )
 {
 #if ENABLE_FLUID_BODY_SIMULATION
 
     PERF_BLOCK( VortonSim__ReduceDivergence ) ;
 
-    float displacementMax = FLT_MAX ;
-
-    const unsigned & nz   = pclIndicesGrid.GetNumPoints( 2 ) ;
-    const unsigned   nzm1 = nz - 1 ;
+    if( pclIndicesGrid.Empty() || vortons->Empty() )
+    {   // No vortons.
+        return 0.0f ;
+    }
 
     static const float displacementThreshold = FLT_EPSILON ;
-    static const int   maxNumIters           = 256 ;
+    static const int   maxNumIters           = 16 ;
+
+    const size_t        numVortons  = vortons->Size() ;
+    const size_t        numLayers   = pclIndicesGrid.GetNumCells( 2 ) ;
+    DisplacementArray   displacements ;
+    displacements.Resize( numVortons , Vec3( 0.0f , 0.0f , 0.0f ) ) ;  // Vortons outside every cell stay put.
+
+    float overlapMax = 0.0f ;
+    for( int iter = 0 ; iter < maxNumIters ; ++ iter )
+    {   // Relax vorton positions.
+        overlapMax = 0.0f ;
+        Parallel::Reduce( 0 , numLayers , Parallel::GetReductionGrainSize( numLayers ) , Parallel::Reduction< Parallel::MaxResults >( overlapMax , 0.0f , ReduceDivergence_Gather_Slice , * vortons , displacements , pclIndicesGrid ) ) ;
+
+        if( overlapMax < displacementThreshold )
+        {   // Worst overlap was small enough to ignore.
+            break ;
+        }
 
-    {
-    #if USE_TBB && 0 // TBB version not implemented.
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
-        // Compute vorticity diffusion using threading building blocks.
-        // Alternate between even and odd z-slices to avoid multiple threads accessing the same vortons simultaneously.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , VortonSim_ReduceDivergence_TBB( this , pclIndicesGrid , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , VortonSim_ReduceDivergence_TBB( this , pclIndicesGrid , VortonSim::PHASE_ODD  ) ) ;
-    #else
-        ReduceDivergence_Grid_Slice( vortons , displacementMax , pclIndicesGrid , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
-    #endif
+        Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Function( ReduceDivergence_Apply_Slice , * vortons , displacements ) ) ;
     }
 
-    //if( 0.0f == displacementMax )
+    //if( 0.0f == overlapMax )
     //{   // Approximate routine yielded zero displacement.
     //    return ReduceDivergence_Direct( vortons ) ;
     //}
 
-    return displacementMax ;
+    return overlapMax ;
 
 #endif
 }
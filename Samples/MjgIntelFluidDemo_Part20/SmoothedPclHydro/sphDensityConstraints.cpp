@@ -0,0 +1,278 @@
+/** \file sphDensityConstraints.cpp
+
+    \brief Position-based density constraint solver for smoothed particle hydrodynamics.
+
+    Explicit SPH computes pressure from an equation of state, then integrates
+    the resulting acceleration, so stiff fluids need small time steps.  This
+    instead treats incompressibility as one constraint per particle,
+    C_i = n_i / n_0 - 1, where n_i is the number density at particle i and n_0
+    is the target number density, and solves those constraints by iteratively
+    moving predicted particle positions, as in "Position Based Fluids" by
+    Macklin and Muller (2013).  Position corrections stay bounded regardless
+    of time step, so the solver remains stable at much larger time steps.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+#include "Core/Memory/frameArena.h"
+
+#include "sphNeighborList.h"
+
+#include "sphDensityConstraints.h"
+#include "sphKernelTable.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Per-particle state of the density constraint solver.
+*/
+struct SphConstraintParticle
+{
+    Vec3    mPredictedPosition      ;   ///< Position the particle would reach at the end of this step.
+    Vec3    mConstraintGradient     ;   ///< Gradient of this particle's constraint with respect to its own position.
+    Vec3    mPositionCorrection     ;   ///< Change to mPredictedPosition accumulated during the current iteration.
+    float   mNumberDensity          ;   ///< Number density at mPredictedPosition, in units of the non-normalized kernel.
+    float   mSumGradientNeighbors2  ;   ///< Sum, over neighbors, of squared gradient of this particle's constraint with respect to each neighbor's position.
+    float   mLambda                 ;   ///< Scale factor of this particle's position correction.
+} ;
+
+/// Per-particle solver state, which only lives during one step, so it comes from the frame arena instead of the global heap.
+typedef VECTOR< SphConstraintParticle , FrameArenaAllocator< SphConstraintParticle > > SphConstraintParticleArray ;
+
+/// Stages of the solver which visit pairs of particles.
+enum SphConstraintPairStageE
+{
+    SPH_CONSTRAINT_PAIR_STAGE_DENSITY       ,   ///< Accumulate number density and constraint gradients.
+    SPH_CONSTRAINT_PAIR_STAGE_CORRECTION        ///< Accumulate position corrections.
+} ;
+
+/// Stages of the solver which visit each particle.
+enum SphConstraintParticleStageE
+{
+    SPH_CONSTRAINT_PARTICLE_STAGE_LAMBDA    ,   ///< Compute constraint and its scale factor, and reset position correction.
+    SPH_CONSTRAINT_PARTICLE_STAGE_APPLY         ///< Apply position correction, and reset density accumulators for the next iteration.
+} ;
+
+// Private variables --------------------------------------------------------------
+
+static unsigned     sDensityConstraintIterations    = 4         ;   ///< Number of times per step to solve all density constraints.  More iterations reduce compression.
+static float        sDensityConstraintRelaxation    = 1.0f      ;   ///< Regularization in the denominator of each constraint scale factor, in units of the inverse square of influence radius.  Larger values soften the constraint.
+static const float  sHardCoreRadius2                = 1.0e-12f  ;   ///< Square of distance below which pairs exert no gradient, to avoid dividing by zero.
+
+// Public variables --------------------------------------------------------------
+// Private functions --------------------------------------------------------------
+
+/** Functor to accumulate density constraint terms between two smoothed particles.
+
+    The kernel matches that of DensityAccumulator in smoothedPclHydro.cpp,
+    i.e. W = q^3 where q = 1 - distance / influenceRadius, so the target
+    number density tuned for explicit SPH applies here too.
+*/
+class SphConstraintPairAccumulator
+{
+    public:
+        SphConstraintPairAccumulator( SphConstraintParticleArray & constraintPcls , float influenceRadius , float targetNumberDensity , SphConstraintPairStageE stage )
+            : mConstraintPcls( constraintPcls )
+            , mInfluenceRadius( influenceRadius )
+            , mInflRad2( influenceRadius * influenceRadius )
+            , mInvInflRad2( 1.0f / mInflRad2 )
+            , mGradientScale( 3.0f / ( influenceRadius * targetNumberDensity ) )
+            , mStage( stage )
+        {
+        }
+
+        void operator()( size_t idxA , size_t idxB )
+        {
+            SphConstraintParticle & pclA    = mConstraintPcls[ idxA ] ;
+            SphConstraintParticle & pclB    = mConstraintPcls[ idxB ] ;
+            const Vec3              sep     = pclA.mPredictedPosition - pclB.mPredictedPosition ;
+            const float             dist2   = sep.Mag2() ;
+            if( dist2 >= mInflRad2 )
+            {   // Particles are too far apart to influence each other.
+                return ;
+            }
+
+            SphKernelTable::Sample kernel ;
+            gSphKernelTable.Evaluate( kernel , dist2 * mInvInflRad2 ) ;
+            ASSERT( ( 0.0f <= kernel.mQ ) && ( kernel.mQ <= 1.0f ) ) ;
+
+            // Gradient, with respect to position of A, of A's constraint due to B.
+            // By symmetry it is also the negated gradient of B's constraint with respect to the position of B.
+            const Vec3  gradA   = ( dist2 > sHardCoreRadius2 ) ? sep * ( - mGradientScale * kernel.mQ2 * kernel.mInvR / mInfluenceRadius ) : Vec3( 0.0f , 0.0f , 0.0f ) ;
+
+            if( SPH_CONSTRAINT_PAIR_STAGE_DENSITY == mStage )
+            {
+                const float q3      = kernel.mQ3 ;
+                const float grad2   = gradA.Mag2() ;
+                pclA.mNumberDensity         += q3 ;
+                pclB.mNumberDensity         += q3 ;
+                pclA.mConstraintGradient    += gradA ;
+                pclB.mConstraintGradient    -= gradA ;
+                pclA.mSumGradientNeighbors2 += grad2 ;
+                pclB.mSumGradientNeighbors2 += grad2 ;
+            }
+            else
+            {   // Push particles apart in proportion to how much both their constraints are violated.
+                const Vec3 correction = gradA * ( pclA.mLambda + pclB.mLambda ) ;
+                pclA.mPositionCorrection    += correction ;
+                pclB.mPositionCorrection    -= correction ;
+            }
+        }
+
+    private:
+        SphConstraintPairAccumulator & operator=( const SphConstraintPairAccumulator & ) ; // Prevent assignment
+
+        SphConstraintParticleArray &    mConstraintPcls     ;   ///< Per-particle solver state.
+        const float                     mInfluenceRadius    ;   ///< Range of influence each particle has on others.
+        const float                     mInflRad2           ;   ///< Square of mInfluenceRadius.
+        const float                     mInvInflRad2        ;   ///< Reciprocal of mInflRad2.
+        const float                     mGradientScale      ;   ///< Magnitude of kernel gradient at zero distance, divided by target number density.
+        const SphConstraintPairStageE   mStage              ;   ///< Which terms to accumulate.
+} ;
+
+
+
+
+/** Run the given stage of the solver for pairs of particles in a subset of the domain.
+*/
+static void SolveSphDensityConstraints_Pairs_Slice( const SphConstraintPairAccumulator & accumulator , const SphNeighborList & neighborList , const CellBox & box )
+{
+    SphConstraintPairAccumulator accumulate( accumulator ) ; // ForEachPairInBox takes a mutable pair function.
+    neighborList.ForEachPairInBox( box , accumulate ) ;
+}
+
+
+
+
+/** Run the given stage of the solver for a range of particles.
+*/
+static void SolveSphDensityConstraints_Particles_Slice( SphConstraintParticleArray & constraintPcls , float influenceRadius , float targetNumberDensity , SphConstraintParticleStageE stage , size_t iPclBegin , size_t iPclEnd )
+{
+    if( SPH_CONSTRAINT_PARTICLE_STAGE_LAMBDA == stage )
+    {
+        const float relaxation = sDensityConstraintRelaxation / ( influenceRadius * influenceRadius ) ;
+        for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+        {   // For each particle in range...
+            SphConstraintParticle & pcl = constraintPcls[ iPcl ] ;
+            // Only resist compression, so particles near free surfaces do not clump.
+            const float constraint  = Max2( pcl.mNumberDensity / targetNumberDensity - 1.0f , 0.0f ) ;
+            pcl.mLambda             = - constraint / ( pcl.mConstraintGradient.Mag2() + pcl.mSumGradientNeighbors2 + relaxation ) ;
+            pcl.mPositionCorrection = Vec3( 0.0f , 0.0f , 0.0f ) ;
+        }
+    }
+    else
+    {
+        for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+        {   // For each particle in range...
+            SphConstraintParticle & pcl = constraintPcls[ iPcl ] ;
+            pcl.mPredictedPosition      += pcl.mPositionCorrection ;
+            pcl.mNumberDensity          = 1.0f ;    // Self influence.
+            pcl.mConstraintGradient     = Vec3( 0.0f , 0.0f , 0.0f ) ;
+            pcl.mSumGradientNeighbors2  = 0.0f ;
+        }
+    }
+}
+
+
+
+
+/** Run the given pair stage of the solver for all pairs.
+*/
+static void RunPairStage( SphConstraintParticleArray & constraintPcls , const SphNeighborList & neighborList , float influenceRadius , float targetNumberDensity , SphConstraintPairStageE stage )
+{
+    const SphConstraintPairAccumulator accumulator( constraintPcls , influenceRadius , targetNumberDensity , stage ) ;
+    // Visit blocks of cells in 8 colors, so that no two threads access the same particles simultaneously.
+    ForEachCellBlockByColor( neighborList.GetNumCells() , Parallel::Function( SolveSphDensityConstraints_Pairs_Slice , accumulator , neighborList ) ) ;
+}
+
+
+
+
+/** Run the given per-particle stage of the solver for all particles.
+*/
+static void RunParticleStage( SphConstraintParticleArray & constraintPcls , float influenceRadius , float targetNumberDensity , SphConstraintParticleStageE stage )
+{
+    const size_t numPcls = constraintPcls.Size() ;
+    Parallel::For( 0 , numPcls , Parallel::GetGrainSize( numPcls ) , Parallel::Function( SolveSphDensityConstraints_Particles_Slice , constraintPcls , influenceRadius , targetNumberDensity , stage ) ) ;
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Change particle velocities so that advecting particles by them keeps fluid incompressible.
+
+    \param particles            (in/out) Fluid particles.  Velocities must
+                                already include body forces for this step.
+                                On return, velocities include the effect of
+                                the density constraints.
+
+    \param neighborList         Candidate neighbor pairs of particles.
+                                Pairs come from current positions, and the
+                                solver keeps them fixed while it moves
+                                predicted positions, as is usual for
+                                position-based fluids.
+
+    \param influenceRadius      Cutoff range of smoothing function.
+
+    \param targetNumberDensity  Number density (using the same non-normalized
+                                kernel as DensityAccumulator) at which fluid
+                                is at rest.
+
+    \param timeStep             Amount of time by which to advance simulation.
+
+    This predicts where each particle would move, iteratively moves those
+    predicted positions to satisfy density constraints (Jacobi-style, so
+    iterations parallelize), then sets each velocity to reach its corrected
+    position in one time step.  The Evolve particle operation then advects
+    particles to those positions, as usual.
+*/
+void SolveSphDensityConstraints( VECTOR< Vorton > & particles , const SphNeighborList & neighborList , float influenceRadius , float targetNumberDensity , float timeStep )
+{
+    PERF_BLOCK( SolveSphDensityConstraints ) ;
+
+    const size_t numPcls = particles.Size() ;
+    if( ( 0 == numPcls ) || ( timeStep <= 0.0f ) )
+    {
+        return ;
+    }
+
+    ASSERT( ! neighborList.IsEmpty() ) ; // Neighbor list must be populated.
+    ASSERT( influenceRadius <= neighborList.GetInfluenceRadius() ) ;
+    ASSERT( targetNumberDensity > 0.0f ) ;
+
+    // Predict positions.
+    SphConstraintParticleArray constraintPcls ;
+    constraintPcls.Resize( numPcls ) ;
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {   // For each particle...
+        SphConstraintParticle & pcl = constraintPcls[ iPcl ] ;
+        pcl.mPredictedPosition      = particles[ iPcl ].mPosition + particles[ iPcl ].mVelocity * timeStep ;
+        pcl.mConstraintGradient     = Vec3( 0.0f , 0.0f , 0.0f ) ;
+        pcl.mPositionCorrection     = Vec3( 0.0f , 0.0f , 0.0f ) ;
+        pcl.mNumberDensity          = 1.0f ;    // Self influence.
+        pcl.mSumGradientNeighbors2  = 0.0f ;
+        pcl.mLambda                 = 0.0f ;
+    }
+
+    for( unsigned iter = 0 ; iter < sDensityConstraintIterations ; ++ iter )
+    {   // For each solver iteration...
+        RunPairStage( constraintPcls , neighborList , influenceRadius , targetNumberDensity , SPH_CONSTRAINT_PAIR_STAGE_DENSITY ) ;
+        RunParticleStage( constraintPcls , influenceRadius , targetNumberDensity , SPH_CONSTRAINT_PARTICLE_STAGE_LAMBDA ) ;
+        RunPairStage( constraintPcls , neighborList , influenceRadius , targetNumberDensity , SPH_CONSTRAINT_PAIR_STAGE_CORRECTION ) ;
+        RunParticleStage( constraintPcls , influenceRadius , targetNumberDensity , SPH_CONSTRAINT_PARTICLE_STAGE_APPLY ) ;
+    }
+
+    // Set velocity to reach corrected position in one step.
+    const float oneOverTimeStep = 1.0f / timeStep ;
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {   // For each particle...
+        Vorton & rPcl = particles[ iPcl ] ;
+        rPcl.mVelocity = ( constraintPcls[ iPcl ].mPredictedPosition - rPcl.mPosition ) * oneOverTimeStep ;
+        ASSERT( ! IsNan( rPcl.mVelocity ) && ! IsInf( rPcl.mVelocity ) ) ;
+    }
+}
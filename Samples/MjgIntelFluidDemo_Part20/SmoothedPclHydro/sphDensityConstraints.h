@@ -0,0 +1,26 @@
+/** \file sphDensityConstraints.h
+
+    \brief Position-based density constraint solver for smoothed particle hydrodynamics.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef SPH_DENSITY_CONSTRAINTS_H
+#define SPH_DENSITY_CONSTRAINTS_H
+
+#include "Core/Containers/vector.h"
+
+#include "VortonFluid/vorton.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+class SphNeighborList ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+extern void SolveSphDensityConstraints( VECTOR< Vorton > & particles , const SphNeighborList & neighborList , float influenceRadius , float targetNumberDensity , float timeStep ) ;
+
+#endif
@@ -0,0 +1,108 @@
+/** \file sphKernelTable.h
+
+    \brief Tabulated smoothing kernels for smoothed particle hydrodynamics.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef SPH_KERNEL_TABLE_H
+#define SPH_KERNEL_TABLE_H
+
+#include "Core/Math/math.h"
+#include "Core/Utility/macros.h"
+
+// Macros --------------------------------------------------------------
+
+/** Whether to look up SPH kernels in a table instead of evaluating them directly.
+
+    Tables avoid the square root each particle pair otherwise needs, at
+    the cost of interpolation error below about 1e-4.
+    Set to 0 to compare results against direct evaluation.
+*/
+#define USE_SPH_KERNEL_TABLE 1
+
+/** Number of intervals in SPH kernel table.
+
+    Interpolation error falls as the square of this.  Each interval costs
+    one Sample, so 1024 intervals take about 20KB, which fits in L1 cache
+    on most machines along with the particles that use it.
+*/
+#define SPH_KERNEL_TABLE_SIZE 1024
+
+// Types --------------------------------------------------------------
+
+/** Tabulated smoothing kernels for smoothed particle hydrodynamics.
+
+    Every SPH pass in this project uses powers of q = 1 - r / h, where r is
+    the distance between particles and h is the influence radius, and
+    gradient passes also divide by r to get the direction between them.
+    This table holds all of those, indexed by normalized squared distance
+    s = r^2 / h^2, so callers need only the squared distance they already
+    compute to reject distant pairs.
+
+    Linear interpolation in s is accurate except very close to s=0, where
+    q and 1/r vary too rapidly in s.  Pairs that close are rare, because
+    pressure pushes them apart, so Evaluate computes them directly.
+*/
+class SphKernelTable
+{
+    public:
+        /// Kernel values at one normalized squared distance.
+        struct Sample
+        {
+            float   mQ      ;   ///< 1 - r / h.
+            float   mQ2     ;   ///< q^2, used by pressure and density gradients.
+            float   mQ3     ;   ///< q^3, used by number density and near pressure.
+            float   mQ4     ;   ///< q^4, used by near number density.
+            float   mInvR   ;   ///< h / r, to convert separation to direction.
+        } ;
+
+        SphKernelTable() ;
+
+        /** Assign kernel values at the given normalized squared distance.
+
+            \param sample               (out) Kernel values.
+
+            \param normalizedDistance2  Squared distance between particles divided by squared influence radius.  Must be in [0,1].
+        */
+        void Evaluate( Sample & sample , float normalizedDistance2 ) const
+        {
+            ASSERT( ( normalizedDistance2 >= 0.0f ) && ( normalizedDistance2 <= 1.0f ) ) ;
+        #if USE_SPH_KERNEL_TABLE
+            if( normalizedDistance2 < sTableStart )
+            {   // Too close for interpolation to be accurate.
+                EvaluateDirect( sample , normalizedDistance2 ) ;
+                return ;
+            }
+            const float     index       = ( normalizedDistance2 - sTableStart ) * sOneOverTableSpacing ;
+            const size_t    indexLower  = Min2( size_t( index ) , size_t( SPH_KERNEL_TABLE_SIZE - 1 ) ) ;
+            const float     tween       = index - float( indexLower ) ;
+            const Sample &  lower       = mSamples[ indexLower     ] ;
+            const Sample &  upper       = mSamples[ indexLower + 1 ] ;
+            sample.mQ       = lower.mQ    + tween * ( upper.mQ    - lower.mQ    ) ;
+            sample.mQ2      = lower.mQ2   + tween * ( upper.mQ2   - lower.mQ2   ) ;
+            sample.mQ3      = lower.mQ3   + tween * ( upper.mQ3   - lower.mQ3   ) ;
+            sample.mQ4      = lower.mQ4   + tween * ( upper.mQ4   - lower.mQ4   ) ;
+            sample.mInvR    = lower.mInvR + tween * ( upper.mInvR - lower.mInvR ) ;
+        #else
+            EvaluateDirect( sample , normalizedDistance2 ) ;
+        #endif
+        }
+
+        static void EvaluateDirect( Sample & sample , float normalizedDistance2 ) ;
+
+    private:
+        static const float  sTableStart             ;   ///< Smallest normalized squared distance the table covers.
+        static const float  sOneOverTableSpacing    ;   ///< Reciprocal of normalized squared distance between samples.
+
+        Sample  mSamples[ SPH_KERNEL_TABLE_SIZE + 1 ]   ;   ///< Kernel values at evenly spaced normalized squared distances from sTableStart to 1.
+} ;
+
+// Public variables --------------------------------------------------------------
+
+extern const SphKernelTable gSphKernelTable ;   ///< Kernel table that every SPH pass shares.
+
+// Public functions --------------------------------------------------------------
+
+#endif
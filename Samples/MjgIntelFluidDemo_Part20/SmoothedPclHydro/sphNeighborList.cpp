@@ -0,0 +1,485 @@
+/** \file sphNeighborList.cpp
+
+    \brief Cached lists of candidate neighbor pairs for smoothed particle hydrodynamics, with a Verlet skin.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+#include "sphNeighborList.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+// Private variables --------------------------------------------------------------
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+/** Discard all pairs, so the next NeedsRebuild returns true.
+*/
+void SphNeighborList::Clear()
+{
+    mInfluenceRadius = 0.0f ;
+    mSkin            = 0.0f ;
+    mCellHereBegin.Clear() ;
+    mHere.Clear() ;
+    mHereThereBegin.Clear() ;
+    mThere.Clear() ;
+    mReferencePositions.Clear() ;
+}
+
+
+
+
+/** Return whether the candidate pairs might omit some pair of particles within the given influence radius.
+
+    \param particles - Particles whose pairs to check.  Elements must
+        correspond one-to-one with those passed to the most recent Build.
+
+    \param influenceRadius - Range within which passes look for neighbors.
+
+    This holds when the number of particles or the influence radius changed,
+    or when any particle moved more than half the skin since Build.  Two
+    particles that each moved less than that are still within the influence
+    radius plus the skin of each other if they are within the influence
+    radius now.
+
+    This compares positions by index, so reordering particles (for example,
+    sorting them for locality) also triggers a rebuild.
+*/
+bool SphNeighborList::NeedsRebuild( const VECTOR< Vorton > & particles , float influenceRadius ) const
+{
+    PERF_BLOCK( SphNeighborList__NeedsRebuild ) ;
+
+    if(     IsEmpty()
+        ||  ( particles.Size() != mReferencePositions.Size() )
+        ||  ( influenceRadius  != mInfluenceRadius )
+        ||  ( mSkin <= 0.0f ) )
+    {   // List is absent or stale.
+        return true ;
+    }
+
+    const float     halfSkin2   = Pow2( 0.5f * mSkin ) ;
+    const size_t    numPcls     = particles.Size() ;
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {   // For each particle...
+        const Vec3 displacement = particles[ iPcl ].mPosition - mReferencePositions[ iPcl ] ;
+        if( displacement.Mag2() > halfSkin2 )
+        {   // Particle moved far enough that it could have a new neighbor that the list lacks.
+            return true ;
+        }
+    }
+    return false ;
+}
+
+
+
+
+/** Record candidate neighbors of each particle, within the given influence radius plus a skin.
+
+    \param particles - Particles whose neighbors to find.
+
+    \param pclIndicesGrid - Spatial partition of indices into particles.
+        Each cell must be at least GetMinCellSpacing( influenceRadius ) wide.
+
+    \param influenceRadius - Range within which passes look for neighbors.
+
+    This visits the same half neighborhood of each cell, in the same order,
+    as SPH passes that walk a CellList directly, so each pair appears once,
+    and passes visit pairs in the same order either way.
+*/
+void SphNeighborList::Build( const VECTOR< Vorton > & particles , const CellList & pclIndicesGrid , float influenceRadius )
+{
+    PERF_BLOCK( SphNeighborList__Build ) ;
+
+    ASSERT( ! pclIndicesGrid.Empty() ) ; // Spatial partition must be populated.
+
+    const Vec3 &    cellSpacing     = pclIndicesGrid.GetCellSpacing() ;
+    const float     minCellSpacing  = MIN3( cellSpacing.x , cellSpacing.y , cellSpacing.z ) ;
+
+    // Make sure grid cell spans maximum possible neighbor distance, otherwise search below will not find all neighbors.
+    ASSERT( influenceRadius <= minCellSpacing ) ;
+
+    mInfluenceRadius    = influenceRadius ;
+    mSkin               = Min2( influenceRadius * SPH_NEIGHBOR_LIST_SKIN_FRACTION , minCellSpacing - influenceRadius ) ;
+
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {
+        mNumPoints[ axis ]  = pclIndicesGrid.GetNumPoints( axis ) ;
+        mNumCells[ axis ]   = pclIndicesGrid.GetNumCells( axis ) ;
+    }
+
+    const size_t numPcls        = particles.Size() ;
+    const size_t gridCapacity   = pclIndicesGrid.GetGridCapacity() ;
+
+    // Lay out "here" particles by cell.  Only cells that SPH passes visit have "here" particles.
+    mCellHereBegin.Resize( gridCapacity + 1 ) ;
+    mHere.Clear() ;
+    mHere.Reserve( numPcls ) ;
+    const size_t nx     = mNumPoints[ 0 ] ;
+    const size_t nxy    = mNumPoints[ 0 ] * mNumPoints[ 1 ] ;
+    for( size_t cellOffset = 0 ; cellOffset < gridCapacity ; ++ cellOffset )
+    {   // For each cell...
+        mCellHereBegin[ cellOffset ] = unsigned( mHere.Size() ) ;
+        const size_t ix = cellOffset % nx ;
+        const size_t iy = ( cellOffset / nx ) % mNumPoints[ 1 ] ;
+        const size_t iz = cellOffset / nxy ;
+        if( ( ix < mNumCells[ 0 ] ) && ( iy < mNumCells[ 1 ] ) && ( iz < mNumCells[ 2 ] ) )
+        {   // Cell is inside the domain SPH passes visit.
+            const CellList::Cell cell = pclIndicesGrid[ cellOffset ] ;
+            for( unsigned ivHere = 0 ; ivHere < cell.Size() ; ++ ivHere )
+            {   // For each particle in this cell...
+                mHere.PushBack( cell[ ivHere ] ) ;
+            }
+        }
+    }
+    mCellHereBegin[ gridCapacity ] = unsigned( mHere.Size() ) ;
+
+    // Count candidate neighbors of each "here" particle.
+    mHereThereBegin.Resize( mHere.Size() + 1 ) ;
+    RunBuildStage( particles , pclIndicesGrid , BUILD_STAGE_COUNT ) ;
+
+    ConvertCountsToOffsets() ;
+
+    // Record candidate neighbors.
+    RunBuildStage( particles , pclIndicesGrid , BUILD_STAGE_FILL ) ;
+
+    RecordReferencePositions( particles ) ;
+}
+
+
+
+
+/** Record candidate neighbors of each particle, within the given influence radius plus a skin, found using a spatial hash.
+
+    \param particles - Particles whose neighbors to find.
+
+    \param pclIndicesHash - Spatial partition of indices into particles.
+        Its cells must be at least GetMinCellSpacing( influenceRadius ) wide.
+
+    \param scheduleGrid - Geometry of cells that ForEachPairInBox visits.
+        Cells should be at least GetMinCellSpacing( influenceRadius ) wide,
+        unless the grid has only 2 cells along that axis, as
+        UniformGridGeometry::FitShape provides.
+        Particles outside this grid belong to its nearest cell.
+
+    \param influenceRadius - Range within which passes look for neighbors.
+
+    Unlike a CellList, the spatial hash does not span a bounding box, so
+    cells have the same size however far apart particles stray, and the
+    number of candidates each particle tests does not depend on outliers.
+
+    Candidate neighbors of each particle here lie within one cell of it, so
+    they also lie in the same or an adjacent cell of scheduleGrid, which is
+    what ForEachCellBlockByColor requires to schedule passes concurrently.
+    Since scheduleGrid only schedules passes, a coarse one costs nothing but
+    parallelism.
+*/
+void SphNeighborList::Build( const VECTOR< Vorton > & particles , const SpatialHash & pclIndicesHash , const UniformGridGeometry & scheduleGrid , float influenceRadius )
+{
+    PERF_BLOCK( SphNeighborList__BuildFromHash ) ;
+
+    ASSERT( ! pclIndicesHash.Empty() ) ; // Spatial partition must be populated.
+    ASSERT( pclIndicesHash.GetNumItems() == particles.Size() ) ;
+
+    const float cellSize = pclIndicesHash.GetCellSize() ;
+
+    // Make sure cell spans maximum possible neighbor distance, otherwise search below will not find all neighbors.
+    ASSERT( influenceRadius <= cellSize ) ;
+
+    mInfluenceRadius    = influenceRadius ;
+    mSkin               = Min2( influenceRadius * SPH_NEIGHBOR_LIST_SKIN_FRACTION , cellSize - influenceRadius ) ;
+
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {
+        mNumPoints[ axis ]  = scheduleGrid.GetNumPoints( axis ) ;
+        mNumCells[ axis ]   = scheduleGrid.GetNumCells( axis ) ;
+    }
+
+    const size_t    numPcls         = particles.Size() ;
+    const size_t    gridCapacity    = scheduleGrid.GetGridCapacity() ;
+    const Vec3 &    minCorner       = scheduleGrid.GetMinCorner() ;
+    const Vec3 &    cellsPerExtent  = scheduleGrid.GetCellsPerExtent() ;
+    const int       maxIndex[ 3 ]   = { int( mNumCells[ 0 ] ) - 1 , int( mNumCells[ 1 ] ) - 1 , int( mNumCells[ 2 ] ) - 1 } ;
+
+    // Lay out "here" particles by schedule cell, using a counting sort.
+    // Counts go into mCellHereBegin offset by one, so the prefix sum leaves each cell its begin offset.
+    mCellHereBegin.Clear() ;
+    mCellHereBegin.Resize( gridCapacity + 1 , 0 ) ;
+    mHereThereBegin.Resize( numPcls ) ; // Temporarily holds schedule cell of each particle.
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {   // For each particle, find its schedule cell, clamped into the grid.
+        const Vec3  posRel  = particles[ iPcl ].mPosition - minCorner ;
+        const int   ix      = Clamp( int( floorf( posRel.x * cellsPerExtent.x ) ) , 0 , maxIndex[ 0 ] ) ;
+        const int   iy      = Clamp( int( floorf( posRel.y * cellsPerExtent.y ) ) , 0 , maxIndex[ 1 ] ) ;
+        const int   iz      = Clamp( int( floorf( posRel.z * cellsPerExtent.z ) ) , 0 , maxIndex[ 2 ] ) ;
+        const unsigned cellOffset = unsigned( scheduleGrid.OffsetFromIndices( ix , iy , iz ) ) ;
+        mHereThereBegin[ iPcl ] = cellOffset ;
+        ++ mCellHereBegin[ cellOffset + 1 ] ;
+    }
+    for( size_t cellOffset = 0 ; cellOffset < gridCapacity ; ++ cellOffset )
+    {   // Accumulate counts into offsets.
+        mCellHereBegin[ cellOffset + 1 ] += mCellHereBegin[ cellOffset ] ;
+    }
+    ASSERT( mCellHereBegin[ gridCapacity ] == numPcls ) ;
+    mHere.Resize( numPcls ) ;
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {   // For each particle, in order, so particles within each cell ascend.
+        // Use begin offset of each cell as its insertion cursor, then shift offsets back below.
+        mHere[ mCellHereBegin[ mHereThereBegin[ iPcl ] ] ++ ] = unsigned( iPcl ) ;
+    }
+    for( size_t cellOffset = gridCapacity ; cellOffset > 0 ; -- cellOffset )
+    {   // Each cursor now holds the begin offset of the next cell, so shift them back.
+        mCellHereBegin[ cellOffset ] = mCellHereBegin[ cellOffset - 1 ] ;
+    }
+    mCellHereBegin[ 0 ] = 0 ;
+
+    // Count candidate neighbors of each "here" particle.
+    mHereThereBegin.Resize( numPcls + 1 ) ;
+    RunBuildFromHashStage( particles , pclIndicesHash , BUILD_STAGE_COUNT ) ;
+
+    ConvertCountsToOffsets() ;
+
+    // Record candidate neighbors.
+    RunBuildFromHashStage( particles , pclIndicesHash , BUILD_STAGE_FILL ) ;
+
+    RecordReferencePositions( particles ) ;
+}
+
+
+
+
+/** Convert counts of candidate neighbors, which the count stage of Build stores in mHereThereBegin, to offsets, and allocate mThere to hold them.
+*/
+void SphNeighborList::ConvertCountsToOffsets()
+{
+    // Exclusive prefix sum.
+    const size_t numHere = mHere.Size() ;
+    unsigned numPairs = 0 ;
+    for( size_t iHere = 0 ; iHere < numHere ; ++ iHere )
+    {
+        const unsigned numThere = mHereThereBegin[ iHere ] ;
+        mHereThereBegin[ iHere ] = numPairs ;
+        numPairs += numThere ;
+    }
+    mHereThereBegin[ numHere ] = numPairs ;
+
+    mThere.Resize( numPairs ) ;
+}
+
+
+
+
+/** Remember where particles were, to detect when they have moved too far.
+*/
+void SphNeighborList::RecordReferencePositions( const VECTOR< Vorton > & particles )
+{
+    const size_t numPcls = particles.Size() ;
+    mReferencePositions.Resize( numPcls ) ;
+    for( size_t iPcl = 0 ; iPcl < numPcls ; ++ iPcl )
+    {
+        mReferencePositions[ iPcl ] = particles[ iPcl ].mPosition ;
+    }
+}
+
+
+
+
+/** Run the given stage of Build for every layer of cells.
+*/
+void SphNeighborList::RunBuildStage( const VECTOR< Vorton > & particles , const CellList & pclIndicesGrid , BuildStageE stage )
+{
+    Parallel::For( 0 , mNumCells[ 2 ] , 1 , Parallel::Method( this , & SphNeighborList::BuildLayers , particles , pclIndicesGrid , stage ) ) ;
+}
+
+
+
+
+/** Run the given stage of Build, from a spatial hash, for every "here" particle.
+*/
+void SphNeighborList::RunBuildFromHashStage( const VECTOR< Vorton > & particles , const SpatialHash & pclIndicesHash , BuildStageE stage )
+{
+    const size_t numHere = mHere.Size() ;
+    Parallel::For( 0 , numHere , Parallel::GetGrainSize( numHere ) , Parallel::Method( this , & SphNeighborList::BuildFromHashRange , particles , pclIndicesHash , stage ) ) ;
+}
+
+
+
+
+/** Run the given stage of Build, from a spatial hash, for the given range of "here" particles.
+
+    Each pair appears once:  A particle pairs with particles with greater
+    indices in its own cell, and with every particle in the 13 adjacent cells
+    whose coordinates follow its own, z most significant.
+
+    Each "here" particle only writes its own elements of mHereThereBegin
+    and mThere, so ranges need no synchronization.
+*/
+void SphNeighborList::BuildFromHashRange( const VECTOR< Vorton > & particles , const SpatialHash & pclIndicesHash , BuildStageE stage , size_t iHereBegin , size_t iHereEnd )
+{
+    const float candidateRadius = mInfluenceRadius + mSkin ;
+    const float candidateRad2   = Pow2( candidateRadius ) ;
+
+    static const int neighborCellOffsets[][ 3 ] =
+    {   // Offsets to neighboring cells whose coordinates follow this one:
+          {  1 ,  0 ,  0 } , { -1 ,  1 ,  0 } , {  0 ,  1 ,  0 } , {  1 ,  1 ,  0 }
+        , { -1 , -1 ,  1 } , {  0 , -1 ,  1 } , {  1 , -1 ,  1 }
+        , { -1 ,  0 ,  1 } , {  0 ,  0 ,  1 } , {  1 ,  0 ,  1 }
+        , { -1 ,  1 ,  1 } , {  0 ,  1 ,  1 } , {  1 ,  1 ,  1 }
+    } ;
+    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
+
+    for( size_t iHere = iHereBegin ; iHere < iHereEnd ; ++ iHere )
+    {   // For each "here" particle in range...
+        const unsigned &    rPclIdxHere = mHere[ iHere ] ;
+        const Vec3 &        posHere     = particles[ rPclIdxHere ].mPosition ;
+        const int *         cellIdxHere = pclIndicesHash.GetIndicesOfItem( rPclIdxHere ) ;
+        unsigned            iThere      = ( BUILD_STAGE_FILL == stage ) ? mHereThereBegin[ iHere ] : 0 ;
+
+        // Gather particles that share a cell, and follow the "here" particle within it.
+        const SpatialHash::Cell currentCell = pclIndicesHash.GetCellOfItem( rPclIdxHere ) ;
+        for( unsigned ivThere = 0 ; ivThere < currentCell.Size() ; ++ ivThere )
+        {   // For each OTHER particle within this same cell...
+            const unsigned & rPclIdxThere = currentCell[ ivThere ] ;
+            if(     ( rPclIdxThere > rPclIdxHere )
+                &&  ( ( posHere - particles[ rPclIdxThere ].mPosition ).Mag2() < candidateRad2 ) )
+            {   // Particles are close enough to become neighbors before the list goes stale.
+                if( BUILD_STAGE_FILL == stage ) mThere[ iThere ] = rPclIdxThere ;
+                ++ iThere ;
+            }
+        }
+
+        // Gather particles in neighboring cells.
+        for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
+        {   // For each cell in half neighborhood...
+            const SpatialHash::Cell neighborCell = pclIndicesHash.Get(  cellIdxHere[ 0 ] + neighborCellOffsets[ idxNeighborCell ][ 0 ]
+                                                                     ,  cellIdxHere[ 1 ] + neighborCellOffsets[ idxNeighborCell ][ 1 ]
+                                                                     ,  cellIdxHere[ 2 ] + neighborCellOffsets[ idxNeighborCell ][ 2 ] ) ;
+            for( unsigned ivThere = 0 ; ivThere < neighborCell.Size() ; ++ ivThere )
+            {   // For each particle in neighbor cell...
+                const unsigned & rPclIdxThere = neighborCell[ ivThere ] ;
+                if( ( posHere - particles[ rPclIdxThere ].mPosition ).Mag2() < candidateRad2 )
+                {   // Particles are close enough to become neighbors before the list goes stale.
+                    if( BUILD_STAGE_FILL == stage ) mThere[ iThere ] = rPclIdxThere ;
+                    ++ iThere ;
+                }
+            }
+        }
+
+        if( BUILD_STAGE_COUNT == stage )
+        {   // Store count.  Build converts counts to offsets.
+            mHereThereBegin[ iHere ] = iThere ;
+        }
+        else
+        {
+            ASSERT( iThere == mHereThereBegin[ iHere + 1 ] ) ;
+        }
+    }
+}
+
+
+
+
+/** Run the given stage of Build for the given range of z-layers of cells.
+
+    Each "here" particle belongs to exactly one layer, and each layer only
+    writes elements of mHereThereBegin and mThere that belong to its own
+    "here" particles, so layers need no synchronization.
+*/
+void SphNeighborList::BuildLayers( const VECTOR< Vorton > & particles , const CellList & pclIndicesGrid , BuildStageE stage , size_t izBegin , size_t izEnd )
+{
+    const int       nx              = int( mNumPoints[ 0 ] ) ;
+    const int       nxy             = int( mNumPoints[ 0 ] * mNumPoints[ 1 ] ) ;
+    const float     candidateRadius = mInfluenceRadius + mSkin ;
+    const float     candidateRad2   = Pow2( candidateRadius ) ;
+
+    // Note that the cell-neighborhood loop visits only half the neighboring
+    // cells. That is because each particle visitation is symmetric so there is
+    // no need to visit all neighboring cells.
+    const int neighborCellOffsets[] =
+    {   // Offsets to neighboring cells whose indices exceed this one:
+           1            // + , 0 , 0 ( 1)
+        , -1 + nx       // - , + , 0 ( 2)
+        ,    + nx       // 0 , + , 0 ( 3)
+        ,  1 + nx       // + , + , 0 ( 4)
+        , -1 - nx + nxy // - , - , + ( 5)
+        ,    - nx + nxy // 0 , - , + ( 6)
+        ,  1 - nx + nxy // + , - , + ( 7)
+        , -1      + nxy // - , 0 , + ( 8)
+        ,         + nxy // 0 , 0 , + ( 9)
+        ,  1      + nxy // + , 0 , + (10)
+        , -1 + nx + nxy // - , 0 , + (11)
+        ,      nx + nxy // 0 , + , + (12)
+        ,  1 + nx + nxy // + , + , + (13)
+    } ;
+    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
+
+    const size_t gridCapacity = pclIndicesGrid.GetGridCapacity() ;
+
+    for( size_t iz = izBegin ; iz < izEnd ; ++ iz )
+    {   // For all grid cells along z...
+        const size_t offsetZ0 = iz * nxy ;
+        for( size_t iy = 0 ; iy < mNumCells[ 1 ] ; ++ iy )
+        {   // For all grid cells along y...
+            const size_t offsetY0Z0 = iy * nx + offsetZ0 ;
+            const size_t rowEnd     = mNumCells[ 0 ] + offsetY0Z0 ;
+            for( size_t offsetX0Y0Z0 = pclIndicesGrid.FindOccupiedCell( offsetY0Z0 , rowEnd ) ; offsetX0Y0Z0 < rowEnd ; offsetX0Y0Z0 = pclIndicesGrid.FindOccupiedCell( offsetX0Y0Z0 + 1 , rowEnd ) )
+            {   // For each occupied grid cell along x.  Empty cells have no "here" particles, hence nothing to build.
+                const CellList::Cell    currentCell         = pclIndicesGrid[ offsetX0Y0Z0 ] ;
+                const size_t            numInCurrentCell    = currentCell.Size() ;
+                const unsigned          iHereBegin          = mCellHereBegin[ offsetX0Y0Z0 ] ;
+                ASSERT( iHereBegin + numInCurrentCell == mCellHereBegin[ offsetX0Y0Z0 + 1 ] ) ;
+
+                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
+                {   // For each particle in this gridcell...
+                    const unsigned &    rPclIdxHere = currentCell[ ivHere ] ;
+                    const Vec3 &        posHere     = particles[ rPclIdxHere ].mPosition ;
+                    const size_t        iHere       = iHereBegin + ivHere ;
+                    unsigned            iThere      = ( BUILD_STAGE_FILL == stage ) ? mHereThereBegin[ iHere ] : 0 ;
+
+                    // Gather particles that share a cell, and follow the "here" particle within it.
+                    for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
+                    {   // For each OTHER particle within this same cell...
+                        const unsigned & rPclIdxThere = currentCell[ ivThere ] ;
+                        if( ( posHere - particles[ rPclIdxThere ].mPosition ).Mag2() < candidateRad2 )
+                        {   // Particles are close enough to become neighbors before the list goes stale.
+                            if( BUILD_STAGE_FILL == stage ) mThere[ iThere ] = rPclIdxThere ;
+                            ++ iThere ;
+                        }
+                    }
+
+                    // Gather particles in neighboring cells.
+                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
+                    {   // For each cell in neighborhood...
+                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of neighbor cell
+                        if( cellOffset >= gridCapacity ) break ; // Would-be neighbor is out-of-bounds.
+                        if( ! pclIndicesGrid.IsOccupied( cellOffset ) ) continue ;
+                        const CellList::Cell neighborCell = pclIndicesGrid[ cellOffset ] ;
+                        for( unsigned ivThere = 0 ; ivThere < neighborCell.Size() ; ++ ivThere )
+                        {   // For each particle in neighbor cell...
+                            const unsigned & rPclIdxThere = neighborCell[ ivThere ] ;
+                            if( ( posHere - particles[ rPclIdxThere ].mPosition ).Mag2() < candidateRad2 )
+                            {   // Particles are close enough to become neighbors before the list goes stale.
+                                if( BUILD_STAGE_FILL == stage ) mThere[ iThere ] = rPclIdxThere ;
+                                ++ iThere ;
+                            }
+                        }
+                    }
+
+                    if( BUILD_STAGE_COUNT == stage )
+                    {   // Store count.  Build converts counts to offsets.
+                        mHereThereBegin[ iHere ] = iThere ;
+                    }
+                    else
+                    {
+                        ASSERT( iThere == mHereThereBegin[ iHere + 1 ] ) ;
+                    }
+                }
+            }
+        }
+    }
+}
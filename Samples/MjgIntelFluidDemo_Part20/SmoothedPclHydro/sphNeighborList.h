@@ -0,0 +1,223 @@
+/** \file sphNeighborList.h
+
+    \brief Cached lists of candidate neighbor pairs for smoothed particle hydrodynamics, with a Verlet skin.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef SPH_NEIGHBOR_LIST_H
+#define SPH_NEIGHBOR_LIST_H
+
+#include "Core/Containers/vector.h"
+
+#include "Core/SpatialPartition/cellList.h"
+#include "Core/SpatialPartition/spatialHash.h"
+#include "Core/SpatialPartition/cellBlockColoring.h"
+
+#include "VortonFluid/vorton.h"
+
+// Macros --------------------------------------------------------------
+
+/** Width of the Verlet skin, as a fraction of the SPH influence radius.
+
+    A SphNeighborList keeps every pair of particles closer than the
+    influence radius plus the skin, so it stays valid until some particle
+    moves farther than half the skin.  A wider skin means fewer rebuilds, but
+    more candidate pairs to reject in each pass that uses the list.
+*/
+#define SPH_NEIGHBOR_LIST_SKIN_FRACTION 0.2f
+
+// Types --------------------------------------------------------------
+
+/** Cached lists of candidate neighbor pairs for smoothed particle hydrodynamics.
+
+    Each SPH pass (number density, pressure gradient, mass density gradient,
+    velocity diffusion) visits the same pairs of particles.  Walking a
+    CellList finds those pairs by visiting the "half neighborhood" of each
+    cell, and testing every particle there, in every pass.  Instead, this
+    records, once, for each "here" particle, the "there" particles which that
+    walk would visit and which lie within the influence radius plus a skin.
+
+    As long as no particle has moved more than half the skin since the list
+    was built, every pair within the influence radius is still in the list, so
+    passes reuse the list and skip partitioning entirely.  Passes must still
+    test distance against the influence radius, since the list includes pairs
+    farther apart.
+
+    The list retains the cell layout it was built with, and visits pairs by
+    cell box, so ForEachCellBlockByColor can schedule it in parallel exactly
+    as it schedules a CellList:  Each pair belongs to the cells its particles
+    occupied when the list was built, which remain neighbors regardless of
+    where the particles have since moved.
+
+    Build can find candidate pairs either by walking a CellList, or by
+    looking up a SpatialHash, whose cells have a fixed size regardless of how
+    far apart particles stray.  Either way, the list lays out "here"
+    particles in the cells of a dense grid, only to schedule passes.
+*/
+class SphNeighborList
+{
+        /// Stages of Build.  Each stage runs once per z-layer of cells; layers of the same stage run concurrently.
+        enum BuildStageE
+        {
+            BUILD_STAGE_COUNT   ,   ///< Count candidate neighbors of each "here" particle in the layer.
+            BUILD_STAGE_FILL        ///< Record candidate neighbors of each "here" particle in the layer.
+        } ;
+
+    public:
+        SphNeighborList()
+            : mInfluenceRadius( 0.0f )
+            , mSkin( 0.0f )
+        {
+            mNumPoints[ 0 ] = mNumPoints[ 1 ] = mNumPoints[ 2 ] = 0 ;
+            mNumCells[ 0 ]  = mNumCells[ 1 ]  = mNumCells[ 2 ]  = 0 ;
+        }
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        void Clear() ;
+
+        /// Return minimum cell spacing a CellList or SpatialHash passed to Build must have, for the given influence radius.
+        static float GetMinCellSpacing( float influenceRadius ) { return influenceRadius * ( 1.0f + SPH_NEIGHBOR_LIST_SKIN_FRACTION ) ; }
+
+        bool NeedsRebuild( const VECTOR< Vorton > & particles , float influenceRadius ) const ;
+        void Build( const VECTOR< Vorton > & particles , const CellList & pclIndicesGrid , float influenceRadius ) ;
+        void Build( const VECTOR< Vorton > & particles , const SpatialHash & pclIndicesHash , const UniformGridGeometry & scheduleGrid , float influenceRadius ) ;
+
+        /// Return whether this has no pairs, i.e. has not been built since construction or Clear.
+        bool            IsEmpty() const             { return mHereThereBegin.Empty() ; }
+
+        /// Return influence radius this was built for.  Passes may use any radius up to this.
+        const float &   GetInfluenceRadius() const  { return mInfluenceRadius ; }
+
+        /// Return number of cells along each axis, to pass to ForEachCellBlockByColor.
+        const size_t *  GetNumCells() const         { return mNumCells ; }
+
+        /// Return number of candidate pairs.
+        size_t          GetNumPairs() const         { return mThere.Size() ; }
+
+
+        /** Visit each candidate pair whose "here" particle occupied the given box of cells when this was built.
+
+            \param box - Box of cells to visit.  See ForEachCellBlockByColor.
+
+            \param pairFunc - Function object with operator()( size_t idxHere , size_t idxThere ).
+        */
+        template< class PairFuncT > void ForEachPairInBox( const CellBox & box , PairFuncT & pairFunc ) const
+        {
+            NoFinish noFinish ;
+            ForEachPairInBox( box , pairFunc , noFinish ) ;
+        }
+
+
+        /** Visit each candidate pair whose "here" particle occupied the given box of cells, then finish each "here" particle.
+
+            \param box - Box of cells to visit.  See ForEachCellBlockByColor.
+
+            \param pairFunc - Function object with operator()( size_t idxHere , size_t idxThere ).
+
+            \param finishFunc - Function object with operator()( size_t idxHere ),
+                which this calls once for each "here" particle, after visiting all its pairs.
+        */
+        template< class PairFuncT , class FinishFuncT > void ForEachPairInBox( const CellBox & box , PairFuncT & pairFunc , FinishFuncT & finishFunc ) const
+        {
+            IgnorePairIndex< PairFuncT > indexedPairFunc( pairFunc ) ;
+            ForEachIndexedPairInBox( box , indexedPairFunc , finishFunc ) ;
+        }
+
+
+        /** Visit each candidate pair whose "here" particle occupied the given box of cells, along with the index of that pair.
+
+            Pair indices lie in [0,GetNumPairs()) and stay the same until the
+            next Build, so a pass can cache values per pair, for a later pass
+            over the same pairs to reuse instead of loading particles again.
+
+            \param box - Box of cells to visit.  See ForEachCellBlockByColor.
+
+            \param pairFunc - Function object with operator()( size_t idxHere , size_t idxThere , size_t idxPair ).
+        */
+        template< class IndexedPairFuncT > void ForEachIndexedPairInBox( const CellBox & box , IndexedPairFuncT & pairFunc ) const
+        {
+            NoFinish noFinish ;
+            ForEachIndexedPairInBox( box , pairFunc , noFinish ) ;
+        }
+
+
+        /** Visit each candidate pair whose "here" particle occupied the given box of cells, along with the index of that pair, then finish each "here" particle.
+
+            \see ForEachIndexedPairInBox, ForEachPairInBox
+        */
+        template< class IndexedPairFuncT , class FinishFuncT > void ForEachIndexedPairInBox( const CellBox & box , IndexedPairFuncT & pairFunc , FinishFuncT & finishFunc ) const
+        {
+            ASSERT( box.mEnd[0] <= mNumCells[0] ) ;
+            ASSERT( box.mEnd[1] <= mNumCells[1] ) ;
+            ASSERT( box.mEnd[2] <= mNumCells[2] ) ;
+
+            const size_t nx     = mNumPoints[ 0 ] ;
+            const size_t nxy    = mNumPoints[ 0 ] * mNumPoints[ 1 ] ;
+
+            size_t idx[3] ;
+            for( idx[2] = box.mBegin[2] ; idx[2] < box.mEnd[2] ; ++ idx[2] )
+            {   // For all grid cells along z...
+                const size_t offsetZ0 = idx[2] * nxy ;
+                for( idx[1] = box.mBegin[1] ; idx[1] < box.mEnd[1] ; ++ idx[1] )
+                {   // For all grid cells along y...
+                    const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
+                    // Cells along x are contiguous, so their "here" particles are too.
+                    const unsigned iHereBegin   = mCellHereBegin[ box.mBegin[0] + offsetY0Z0 ] ;
+                    const unsigned iHereEnd     = mCellHereBegin[ box.mEnd[0]   + offsetY0Z0 ] ;
+                    for( unsigned iHere = iHereBegin ; iHere < iHereEnd ; ++ iHere )
+                    {   // For each "here" particle in this row of cells...
+                        const unsigned & rPclIdxHere = mHere[ iHere ] ;
+                        const unsigned   iThereEnd   = mHereThereBegin[ iHere + 1 ] ;
+                        for( unsigned iThere = mHereThereBegin[ iHere ] ; iThere < iThereEnd ; ++ iThere )
+                        {   // For each candidate neighbor of the "here" particle...
+                            pairFunc( rPclIdxHere , mThere[ iThere ] , iThere ) ;
+                        }
+                        finishFunc( rPclIdxHere ) ;
+                    }
+                }
+            }
+        }
+
+    private:
+        /// Function object for ForEachPairInBox that does nothing to finish each "here" particle.
+        struct NoFinish
+        {
+            void operator()( size_t /* idxHere */ ) const {}
+        } ;
+
+        /// Function object for ForEachIndexedPairInBox that forwards each pair to a function object that does not take pair indices.
+        template< class PairFuncT > class IgnorePairIndex
+        {
+            public:
+                explicit IgnorePairIndex( PairFuncT & pairFunc ) : mPairFunc( pairFunc ) {}
+                void operator()( size_t idxHere , size_t idxThere , size_t /* idxPair */ ) { mPairFunc( idxHere , idxThere ) ; }
+            private:
+                IgnorePairIndex & operator=( const IgnorePairIndex & ) ;    // Disallow assignment
+                PairFuncT & mPairFunc ; ///< Function object to forward each pair to.
+        } ;
+
+        void BuildLayers( const VECTOR< Vorton > & particles , const CellList & pclIndicesGrid , BuildStageE stage , size_t izBegin , size_t izEnd ) ;
+        void RunBuildStage( const VECTOR< Vorton > & particles , const CellList & pclIndicesGrid , BuildStageE stage ) ;
+        void BuildFromHashRange( const VECTOR< Vorton > & particles , const SpatialHash & pclIndicesHash , BuildStageE stage , size_t iHereBegin , size_t iHereEnd ) ;
+        void RunBuildFromHashStage( const VECTOR< Vorton > & particles , const SpatialHash & pclIndicesHash , BuildStageE stage ) ;
+        void ConvertCountsToOffsets() ;
+        void RecordReferencePositions( const VECTOR< Vorton > & particles ) ;
+
+        float               mInfluenceRadius    ;   ///< Influence radius this was built for.
+        float               mSkin               ;   ///< Distance beyond mInfluenceRadius within which pairs were kept.
+        size_t              mNumPoints[ 3 ]     ;   ///< Number of gridpoints along each axis of the CellList, or schedule grid, this was built from.
+        size_t              mNumCells[ 3 ]      ;   ///< Number of cells along each axis of the CellList, or schedule grid, this was built from.
+        VECTOR< unsigned >  mCellHereBegin      ;   ///< Per cell offset, plus one, the index into mHere of the first "here" particle in that cell.
+        VECTOR< unsigned >  mHere               ;   ///< Indices of "here" particles, sorted by cell.
+        VECTOR< unsigned >  mHereThereBegin     ;   ///< Per element of mHere, plus one, the index into mThere of its first candidate neighbor.
+        VECTOR< unsigned >  mThere              ;   ///< Indices of candidate neighbors of each "here" particle.
+        VECTOR< Vec3 >      mReferencePositions ;   ///< Position of each particle when this was built.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,41 @@
+/** \file arrheniusRateTable.cpp
+
+    \brief Tabulated temperature dependence of the Arrhenius combustion rate.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "arrheniusRateTable.h"
+
+#include <float.h>
+#include <math.h>
+
+// Private variables --------------------------------------------------------------
+
+/*  Vortons hotter than about 16 times the activation temperature are rare,
+    and there the rate is within 6% of its limit, 1, so covering 0 to 16
+    keeps interpolation error near 1e-4 for 1024 intervals, the largest
+    second derivative being near normalized temperature 0.2.
+*/
+const float ArrheniusRateTable::sTableEnd               = 16.0f ;
+const float ArrheniusRateTable::sOneOverTableSpacing    = float( ARRHENIUS_RATE_TABLE_SIZE ) / ArrheniusRateTable::sTableEnd ;
+
+// Public variables --------------------------------------------------------------
+
+const ArrheniusRateTable gArrheniusRateTable ;
+
+// Public functions --------------------------------------------------------------
+
+/** Construct Arrhenius rate table by evaluating the rate at each sample.
+*/
+ArrheniusRateTable::ArrheniusRateTable()
+{
+    const double tableSpacing = double( sTableEnd ) / double( ARRHENIUS_RATE_TABLE_SIZE ) ;
+    mRates[ 0 ] = 0.0f ;
+    for( size_t iSample = 1 ; iSample <= ARRHENIUS_RATE_TABLE_SIZE ; ++ iSample )
+    {   // For each sample after the first...
+        mRates[ iSample ] = float( exp( -1.0 / ( double( iSample ) * tableSpacing ) ) ) ;
+    }
+}
@@ -0,0 +1,80 @@
+/** \file arrheniusRateTable.h
+
+    \brief Tabulated temperature dependence of the Arrhenius combustion rate.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef ARRHENIUS_RATE_TABLE_H
+#define ARRHENIUS_RATE_TABLE_H
+
+#include "Core/Math/math.h"
+#include "Core/Utility/macros.h"
+
+#include <float.h>
+
+// Macros --------------------------------------------------------------
+
+/** Number of intervals in Arrhenius rate table.
+
+    Each interval costs one float, so 1024 intervals take 4KB.
+*/
+#define ARRHENIUS_RATE_TABLE_SIZE 1024
+
+// Types --------------------------------------------------------------
+
+/** Tabulated temperature dependence of the Arrhenius combustion rate, exp( - activationTemperature / temperature ).
+
+    That depends only on the ratio of temperature to activation temperature,
+    so one table, indexed by that ratio, serves every activation temperature.
+
+    The function and all its derivatives vanish at zero, and it approaches 1
+    slowly for large ratios, so linear interpolation is accurate to about
+    1e-4 over the tabulated range.  Ratios beyond that are rare, so
+    Evaluate computes them directly.
+*/
+class ArrheniusRateTable
+{
+    public:
+        ArrheniusRateTable() ;
+
+        /** Return exp( -1 / normalizedTemperature ).
+
+            \param normalizedTemperature    Temperature divided by activation temperature.  Must be non-negative.
+        */
+        float Evaluate( float normalizedTemperature ) const
+        {
+            ASSERT( normalizedTemperature >= 0.0f ) ;
+            if( normalizedTemperature >= sTableEnd )
+            {   // Beyond table.
+                return EvaluateDirect( normalizedTemperature ) ;
+            }
+            const float     index       = normalizedTemperature * sOneOverTableSpacing ;
+            const size_t    indexLower  = Min2( size_t( index ) , size_t( ARRHENIUS_RATE_TABLE_SIZE - 1 ) ) ;
+            const float     tween       = index - float( indexLower ) ;
+            const float     lower       = mRates[ indexLower     ] ;
+            const float     upper       = mRates[ indexLower + 1 ] ;
+            return lower + tween * ( upper - lower ) ;
+        }
+
+        /// Return exp( -1 / normalizedTemperature ) without using a table.
+        static float EvaluateDirect( float normalizedTemperature )
+        {
+            return ImpreciseExpF( -1.0f / Max2( normalizedTemperature , FLT_MIN ) ) ;
+        }
+
+    private:
+        static const float  sTableEnd               ;   ///< Largest normalized temperature the table covers.
+        static const float  sOneOverTableSpacing    ;   ///< Reciprocal of normalized temperature between samples.
+
+        float   mRates[ ARRHENIUS_RATE_TABLE_SIZE + 1 ] ;   ///< Rates at evenly spaced normalized temperatures from 0 to sTableEnd.
+} ;
+
+// Public variables --------------------------------------------------------------
+
+extern const ArrheniusRateTable gArrheniusRateTable ;   ///< Arrhenius rate table that every combustion pass shares.
+
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,306 @@
+/** \file gridDye.cpp
+
+    \brief Dye concentration carried on a uniform grid, advected semi-Lagrangian through a velocity grid.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "gridDye.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include "Core/parallelExecution.h"
+
+#include <float.h>
+
+
+
+
+/** Return given position moved, if necessary, to lie strictly inside given grid.
+
+    Interpolate requires positions strictly inside the grid, so this nudges
+    positions on or beyond the boundary slightly inward.
+*/
+static Vec3 ClampInside( const UniformGridGeometry & grid , const Vec3 & position )
+{
+    static const float  nudge       = 1.0f - 4.0f * FLT_EPSILON ;
+    const Vec3          extent      = grid.GetExtent() * nudge ;
+    const Vec3          minCorner   = grid.GetMinCorner() + ( grid.GetExtent() - extent ) * 0.5f ;
+    const Vec3          maxCorner   = minCorner + extent ;
+    return Vec3( Clamp( position.x , minCorner.x , maxCorner.x )
+               , Clamp( position.y , minCorner.y , maxCorner.y )
+               , Clamp( position.z , minCorner.z , maxCorner.z ) ) ;
+}
+
+
+
+
+/** Return velocity at given position, or zero outside the velocity grid.
+*/
+static Vec3 SampleVelocity( const UniformGrid< Vec3 > & velocityGrid , const Vec3 & position )
+{
+    if( velocityGrid.Empty() || ! velocityGrid.Encompasses( position ) )
+    {   // Position lies outside velocity grid, where fluid is treated as still.
+        return Vec3( 0.0f , 0.0f , 0.0f ) ;
+    }
+    Vec3 velocity ;
+    velocityGrid.Interpolate( velocity , ClampInside( velocityGrid , position ) ) ;
+    return velocity ;
+}
+
+
+
+
+/** Return position of the fluid parcel that arrives at given position after given time.
+
+    Uses second-order Runge-Kutta (midpoint), so trajectories curve with the
+    flow instead of overshooting it.  Pass a negative timeStep to trace forward.
+*/
+static Vec3 TraceBackward( const UniformGrid< Vec3 > & velocityGrid , const Vec3 & position , float timeStep )
+{
+    const Vec3 midpoint = position - 0.5f * timeStep * SampleVelocity( velocityGrid , position ) ;
+    return position - timeStep * SampleVelocity( velocityGrid , midpoint ) ;
+}
+
+
+
+
+/** Return concentration interpolated at given position, and the range of the values it interpolated between.
+*/
+static float SampleConcentration( const UniformGrid< float > & grid , const Vec3 & position , float & valMin , float & valMax )
+{
+    const Vec3  inside = ClampInside( grid , position ) ;
+    unsigned    indices[4] ;
+    grid.IndicesOfPosition( indices , inside ) ;
+    const size_t    numX        = grid.GetNumPoints( 0 ) ;
+    const size_t    numXY       = numX * grid.GetNumPoints( 1 ) ;
+    const size_t    offset000   = grid.OffsetFromIndices( indices[ 0 ] , indices[ 1 ] , indices[ 2 ] ) ;
+    const float     corners[ 8 ] =
+    {
+        grid[ offset000                    ] , grid[ offset000                    + 1 ] ,
+        grid[ offset000 + numX             ] , grid[ offset000 + numX             + 1 ] ,
+        grid[ offset000 + numXY            ] , grid[ offset000 + numXY            + 1 ] ,
+        grid[ offset000 + numXY + numX     ] , grid[ offset000 + numXY + numX     + 1 ] ,
+    } ;
+    valMin = valMax = corners[ 0 ] ;
+    for( unsigned iCorner = 1 ; iCorner < 8 ; ++ iCorner )
+    {
+        valMin = Min2( valMin , corners[ iCorner ] ) ;
+        valMax = Max2( valMax , corners[ iCorner ] ) ;
+    }
+    float concentration ;
+    grid.Interpolate( concentration , inside ) ;
+    return concentration ;
+}
+
+
+
+
+/** Return concentration interpolated at given position.
+*/
+static float SampleConcentration( const UniformGrid< float > & grid , const Vec3 & position )
+{
+    float concentration ;
+    grid.Interpolate( concentration , ClampInside( grid , position ) ) ;
+    return concentration ;
+}
+
+
+
+
+/** Construct dye with no grid.  Call DefineShape before adding dye.
+*/
+GridDye::GridDye()
+    : mDecayRate( 0.0f )
+    , mUseMacCormack( true )
+{
+}
+
+
+
+
+/** Define shape of dye grid and empty it of dye.
+
+    \param numCells     Approximate number of grid cells.
+    \param minCorner    Minimal corner of region dye can occupy.
+    \param maxCorner    Maximal corner of region dye can occupy.
+*/
+void GridDye::DefineShape( size_t numCells , const Vec3 & minCorner , const Vec3 & maxCorner )
+{
+    PERF_BLOCK( GridDye__DefineShape ) ;
+
+    mConcentration.DefineShape( numCells , minCorner , maxCorner , false ) ;
+    mConcentration.Init( 0.0f ) ;
+    mAdvected.Clear() ;
+    mReversed.Clear() ;
+}
+
+
+
+
+/** Remove dye grid and sources.  Afterwards IsActive returns false.
+*/
+void GridDye::Clear()
+{
+    mConcentration.Clear() ;
+    mAdvected.Clear() ;
+    mReversed.Clear() ;
+    mSources.Clear() ;
+}
+
+
+
+
+/** Add given amount of dye to each gridpoint within given sphere, tapering to zero at its surface.
+*/
+void GridDye::Deposit( const Vec3 & center , float radius , float amount )
+{
+    if( ! IsActive() || ( radius <= 0.0f ) )
+    {   // No grid to hold dye, or no region to deposit it in.
+        return ;
+    }
+
+    const Vec3  radii( radius , radius , radius ) ;
+    unsigned    idxMin[4] ;
+    unsigned    idxMax[4] ;
+    mConcentration.IndicesOfPosition( idxMin , ClampInside( mConcentration , center - radii ) ) ;
+    mConcentration.IndicesOfPosition( idxMax , ClampInside( mConcentration , center + radii ) ) ;
+
+    const float reciprocalRadius2 = 1.0f / Pow2( radius ) ;
+    for( unsigned iz = idxMin[ 2 ] ; iz <= idxMax[ 2 ] + 1 ; ++ iz )
+    {   // For each z slice overlapping the sphere...
+        for( unsigned iy = idxMin[ 1 ] ; iy <= idxMax[ 1 ] + 1 ; ++ iy )
+        {   // For each row in that slice...
+            for( unsigned ix = idxMin[ 0 ] ; ix <= idxMax[ 0 ] + 1 ; ++ ix )
+            {   // For each gridpoint in that row...
+                const unsigned  indices[3] = { ix , iy , iz } ;
+                Vec3            position ;
+                mConcentration.PositionFromIndices( position , indices ) ;
+                const float falloff = 1.0f - ( position - center ).Mag2() * reciprocalRadius2 ;
+                if( falloff > 0.0f )
+                {   // Gridpoint lies inside sphere.
+                    mConcentration.Get( ix , iy , iz ) += amount * falloff ;
+                }
+            }
+        }
+    }
+}
+
+
+
+
+/** Add a region that adds dye during each Advect, at the given rate.
+
+    \param center   Center of spherical region.
+    \param radius   Radius of spherical region.
+    \param rate     Concentration added at center per unit time, tapering to zero at its surface.
+*/
+void GridDye::AddSource( const Vec3 & center , float radius , float rate )
+{
+    Source source ;
+    source.mCenter  = center ;
+    source.mRadius  = radius ;
+    source.mRate    = rate   ;
+    mSources.PushBack( source ) ;
+}
+
+
+
+
+/** Run one stage of Advect for a subset of z slices.
+
+    Stages write to disjoint gridpoints per slice, so slices can run concurrently.
+*/
+void GridDye::AdvectSlice( StageE stage , const UniformGrid< Vec3 > & velocityGrid , float timeStep , size_t izBegin , size_t izEnd )
+{
+    const Vec3 &    minCorner   = mConcentration.GetMinCorner() ;
+    const Vec3 &    spacing     = mConcentration.GetCellSpacing() ;
+    const size_t    numX        = mConcentration.GetNumPoints( 0 ) ;
+    const size_t    numY        = mConcentration.GetNumPoints( 1 ) ;
+
+    for( size_t iz = izBegin ; iz < izEnd ; ++ iz )
+    {   // For each z slice in range...
+        for( size_t iy = 0 ; iy < numY ; ++ iy )
+        {   // For each row in that slice...
+            for( size_t ix = 0 ; ix < numX ; ++ ix )
+            {   // For each gridpoint in that row...
+                const size_t    offset      = mConcentration.OffsetFromIndices( ix , iy , iz ) ;
+                const Vec3      position    = minCorner + Vec3( float( ix ) * spacing.x , float( iy ) * spacing.y , float( iz ) * spacing.z ) ;
+                switch( stage )
+                {
+                    case STAGE_FORWARD:
+                        mAdvected[ offset ] = SampleConcentration( mConcentration , TraceBackward( velocityGrid , position , timeStep ) ) ;
+                    break ;
+
+                    case STAGE_REVERSE:
+                        mReversed[ offset ] = SampleConcentration( mAdvected , TraceBackward( velocityGrid , position , - timeStep ) ) ;
+                    break ;
+
+                    case STAGE_CORRECT:
+                    {   // Correct forward result by half its round-trip error, limited to the values it interpolated.
+                        float valMin , valMax ;
+                        SampleConcentration( mConcentration , TraceBackward( velocityGrid , position , timeStep ) , valMin , valMax ) ;
+                        const float corrected = mAdvected[ offset ] + 0.5f * ( mConcentration[ offset ] - mReversed[ offset ] ) ;
+                        mReversed[ offset ] = Clamp( corrected , valMin , valMax ) ;
+                    }
+                    break ;
+                }
+            }
+        }
+    }
+}
+
+
+
+
+/** Add dye from sources, then advect dye through given velocity grid for given duration.
+
+    \param velocityGrid     Velocity of fluid.  Dye outside this grid stays put.
+    \param timeStep         Duration over which to advect dye.
+*/
+void GridDye::Advect( const UniformGrid< Vec3 > & velocityGrid , float timeStep )
+{
+    PERF_BLOCK( GridDye__Advect ) ;
+
+    if( ! IsActive() )
+    {   // No grid holds dye.
+        return ;
+    }
+
+    for( size_t iSource = 0 ; iSource < mSources.Size() ; ++ iSource )
+    {   // For each source, add the dye it emits over this step.
+        const Source & source = mSources[ iSource ] ;
+        Deposit( source.mCenter , source.mRadius , source.mRate * timeStep ) ;
+    }
+
+    const size_t numZ = mConcentration.GetNumPoints( 2 ) ;
+
+    mAdvected.CopyShape( mConcentration ) ;
+    mAdvected.Init() ;
+    Parallel::For( 0 , numZ , 1 , Parallel::Method( this , & GridDye::AdvectSlice , STAGE_FORWARD , velocityGrid , timeStep ) ) ;
+
+    if( mUseMacCormack )
+    {   // Correct smearing by advecting back and comparing with original.
+        mReversed.CopyShape( mConcentration ) ;
+        mReversed.Init() ;
+        Parallel::For( 0 , numZ , 1 , Parallel::Method( this , & GridDye::AdvectSlice , STAGE_REVERSE , velocityGrid , timeStep ) ) ;
+        Parallel::For( 0 , numZ , 1 , Parallel::Method( this , & GridDye::AdvectSlice , STAGE_CORRECT , velocityGrid , timeStep ) ) ;
+        mConcentration.Swap( mReversed ) ;
+    }
+    else
+    {
+        mConcentration.Swap( mAdvected ) ;
+    }
+
+    if( mDecayRate > 0.0f )
+    {   // Thin dye out.
+        const float retained = Max2( 0.0f , 1.0f - mDecayRate * timeStep ) ;
+        const size_t numPoints = mConcentration.GetGridCapacity() ;
+        for( size_t offset = 0 ; offset < numPoints ; ++ offset )
+        {
+            mConcentration[ offset ] *= retained ;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/** \file gridDye.h
+
+    \brief Dye concentration carried on a uniform grid, advected semi-Lagrangian through a velocity grid.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef GRID_DYE_H
+#define GRID_DYE_H
+
+#include "Core/SpatialPartition/uniformGrid.h"
+#include "Core/Containers/vector.h"
+
+// Types --------------------------------------------------------------
+
+/** Dye concentration carried on a uniform grid, as a cheap alternative to tracers for dense smoke.
+
+    Carrying dense dye with tracers takes many tracers per cell.  This instead
+    stores dye concentration at gridpoints of a grid with a fixed shape, and
+    each Advect moves it semi-Lagrangian: each gridpoint traces backward
+    through the velocity field and reads concentration there.  So the cost
+    per step depends on the number of gridpoints, not on how much dye there
+    is, and tracers can be reserved for sparse wisps.
+
+    Plain semi-Lagrangian advection smears dye, because each step
+    interpolates.  With MacCormack enabled, each step also advects the result
+    backward, and corrects by half the difference between that and the
+    original, which cancels most of the smearing for about three times the cost.
+    Corrected values are clamped to the range of values semi-Lagrangian
+    advection read, so the correction cannot create new extrema.
+
+    The grid shape stays fixed, rather than following the velocity grid, so
+    dye outside the velocity grid stays put instead of vanishing when the
+    velocity grid moves.
+*/
+class GridDye
+{
+    public:
+        GridDye() ;
+
+        void    DefineShape( size_t numCells , const Vec3 & minCorner , const Vec3 & maxCorner ) ;
+        void    Clear() ;
+        void    Deposit( const Vec3 & center , float radius , float amount ) ;
+        void    AddSource( const Vec3 & center , float radius , float rate ) ;
+        void    Advect( const UniformGrid< Vec3 > & velocityGrid , float timeStep ) ;
+
+        /// Remove all sources that AddSource added.
+        void    ClearSources()                                  { mSources.Clear() ; }
+
+        /// Set whether Advect uses MacCormack correction, which reduces smearing for about three times the cost.
+        void    SetMacCormack( bool useMacCormack )             { mUseMacCormack = useMacCormack ; }
+        bool    GetMacCormack() const                           { return mUseMacCormack ; }
+
+        /// Set fraction of dye that vanishes per unit time, so smoke thins out.  Zero keeps dye forever.
+        void    SetDecayRate( float decayRate )                 { mDecayRate = decayRate ; }
+        float   GetDecayRate() const                            { return mDecayRate ; }
+
+        /// Return grid of dye concentration at each gridpoint.  Empty until DefineShape.
+        const UniformGrid< float > &    GetConcentrationGrid() const    { return mConcentration ; }
+
+        /// Return whether this has a grid, i.e. whether DefineShape has run since construction or Clear.
+        bool    IsActive() const                                { return ! mConcentration.Empty() ; }
+
+    private:
+        /// Stage of Advect, each of which runs concurrently over z slices.
+        enum StageE
+        {
+            STAGE_FORWARD   ,   ///< Advect mConcentration forward into mAdvected.
+            STAGE_REVERSE   ,   ///< Advect mAdvected backward into mReversed.
+            STAGE_CORRECT       ///< Correct mAdvected by mConcentration minus mReversed, into mReversed.
+        } ;
+
+        /// Region that adds dye at a steady rate.  See AddSource.
+        struct Source
+        {
+            Vec3    mCenter ;   ///< Center of spherical region.
+            float   mRadius ;   ///< Radius of spherical region.
+            float   mRate   ;   ///< Concentration added at center per unit time.
+        } ;
+
+        void    AdvectSlice( StageE stage , const UniformGrid< Vec3 > & velocityGrid , float timeStep , size_t izBegin , size_t izEnd ) ;
+
+        UniformGrid< float >    mConcentration  ;   ///< Dye concentration at each gridpoint.
+        UniformGrid< float >    mAdvected       ;   ///< Scratch: mConcentration advected forward.
+        UniformGrid< float >    mReversed       ;   ///< Scratch: mAdvected advected backward, then corrected result.
+        VECTOR< Source >        mSources        ;   ///< Regions that add dye each Advect.
+        float                   mDecayRate      ;   ///< Fraction of dye that vanishes per unit time.
+        bool                    mUseMacCormack  ;   ///< Whether Advect uses MacCormack correction.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,178 @@
+/** \file linearInfluenceTree.cpp
+
+    \brief Compact copy of the vorton influence tree, with nodes in one array, children contiguous and in Morton order.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "linearInfluenceTree.h"
+
+#include "Core/Performance/perfBlock.h"
+
+#include <algorithm>
+
+// Types --------------------------------------------------------------
+
+/// Offset of a child cell within its cluster, and its Morton code, for sorting children.
+struct ClusterChild
+{
+    unsigned        mMortonCode     ;   ///< Bits of increments along x, y and z, interleaved.
+    unsigned char   mIncrement[ 3 ] ;   ///< Indices of child cell relative to minimal cell of cluster.
+
+    bool operator<( const ClusterChild & that ) const { return mMortonCode < that.mMortonCode ; }
+} ;
+
+// Private functions --------------------------------------------------------------
+
+/** List the cells of a cluster with the given dimensions, in Morton order.
+*/
+static void SortClusterChildren( VECTOR< ClusterChild > & children , const unsigned clusterDims[ 3 ] )
+{
+    children.Clear() ;
+    for( unsigned iz = 0 ; iz < clusterDims[ 2 ] ; ++ iz )
+    for( unsigned iy = 0 ; iy < clusterDims[ 1 ] ; ++ iy )
+    for( unsigned ix = 0 ; ix < clusterDims[ 0 ] ; ++ ix )
+    {   // For each cell in cluster...
+        ClusterChild child ;
+        child.mMortonCode       = MortonEncode( ix , iy , iz ) ;
+        child.mIncrement[ 0 ]   = static_cast< unsigned char >( ix ) ;
+        child.mIncrement[ 1 ]   = static_cast< unsigned char >( iy ) ;
+        child.mIncrement[ 2 ]   = static_cast< unsigned char >( iz ) ;
+        children.PushBack( child ) ;
+    }
+    std::sort( children.Begin() , children.End() ) ;
+}
+
+
+
+
+/** Make a node from the given supervorton, whose cell has the given Morton key, and which has no children yet.
+*/
+static LinearInfluenceTree::Node MakeNode( const Vorton & supervorton , unsigned cellKey )
+{
+    LinearInfluenceTree::Node node ;
+    node.mPosition          = supervorton.mPosition ;
+    node.mSize              = supervorton.mSize ;
+    node.mAngularVelocity   = supervorton.mAngularVelocity ;
+    node.mFirstChild        = 0 ;
+    node.mCellKeyAndNumChildren = cellKey ;
+#if defined( _DEBUG )
+    node.mNumVortonsIncorporated = supervorton.mNumVortonsIncorporated ;
+#endif
+    return node ;
+}
+
+// Public functions --------------------------------------------------------------
+
+/** Copy the given influence tree into this compact layout.
+
+    \param influenceTree - Tree that CreateInfluenceTree populated.
+
+    \return Whether this could represent the tree.  If not, this becomes
+        empty, and callers should traverse influenceTree itself.  That
+        happens when the tree has fewer than 2 layers, some layer above the
+        leaf layer has more than MAX_KEYED_POINTS_PER_AXIS points along an
+        axis, or some cluster has more than MAX_CHILDREN cells.
+
+    Like treecode queries, this starts from cell (0,0,0) of the top layer,
+    and visits each cluster of child cells under each node.  Child cells
+    whose supervorton has zero size hold no vortons (see
+    RecordInfluenceTreeOccupancy), so they get no node.
+*/
+bool LinearInfluenceTree::Build( const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( LinearInfluenceTree__Build ) ;
+
+    Clear() ;
+
+    const size_t numLayers = influenceTree.GetDepth() ;
+    if( numLayers < 2 )
+    {   // Treecode queries use direct summation instead.
+        return false ;
+    }
+
+    mMinCorners.Resize( numLayers ) ;
+    mCellSpacings.Resize( numLayers ) ;
+    for( size_t iLayer = 0 ; iLayer < numLayers ; ++ iLayer )
+    {   // For each layer...
+        const UniformGrid< Vorton > & layer = influenceTree[ iLayer ] ;
+        for( unsigned axis = 0 ; ( iLayer > 0 ) && ( axis < 3 ) ; ++ axis )
+        {   // For each axis of a layer whose nodes record their cell indices...
+            if( layer.GetNumPoints( axis ) > MAX_KEYED_POINTS_PER_AXIS )
+            {   // Indices would not fit into Node keys.
+                Clear() ;
+                return false ;
+            }
+        }
+        mMinCorners[ iLayer ]   = layer.GetMinCorner() ;
+        mCellSpacings[ iLayer ] = layer.GetCellSpacing() ;
+    }
+
+    mNodes.PushBack( MakeNode( influenceTree[ numLayers - 1 ][ 0 ] , MortonEncode( 0 , 0 , 0 ) ) ) ;
+
+    VECTOR< ClusterChild > clusterChildren ;
+    size_t iParentBegin = 0 ;
+    size_t iParentEnd   = 1 ;
+    for( size_t iParentLayer = numLayers - 1 ; iParentLayer > 0 ; -- iParentLayer )
+    {   // For each parent layer, from the top...
+        const UniformGrid< Vorton > &   childLayer  = influenceTree[ iParentLayer - 1 ] ;
+        const unsigned *                clusterDims = influenceTree.GetDecimations( iParentLayer ) ;
+        if( clusterDims[ 0 ] * clusterDims[ 1 ] * clusterDims[ 2 ] > MAX_CHILDREN )
+        {   // Queries could not list which children to open.
+            Clear() ;
+            return false ;
+        }
+        SortClusterChildren( clusterChildren , clusterDims ) ;
+        const size_t numClusterChildren = clusterChildren.Size() ;
+        const bool   childrenAreLeaves  = ( 1 == iParentLayer ) ;
+
+        for( size_t iParent = iParentBegin ; iParent < iParentEnd ; ++ iParent )
+        {   // For each node in parent layer...
+            unsigned parentIndices[ 3 ] ;
+            mNodes[ iParent ].GetCellIndices( parentIndices ) ;
+            unsigned clusterMinIndices[ 3 ] ;
+            NestedGrid< Vorton >::GetChildClusterMinCornerIndex( clusterMinIndices , clusterDims , parentIndices ) ;
+
+            const unsigned  iFirstChild = unsigned( mNodes.Size() ) ;
+            unsigned        numChildren = 0 ;
+            for( size_t iClusterChild = 0 ; iClusterChild < numClusterChildren ; ++ iClusterChild )
+            {   // For each cell in cluster, in Morton order...
+                const ClusterChild &    clusterChild    = clusterChildren[ iClusterChild ] ;
+                const unsigned          idxChild[ 3 ]   = { clusterMinIndices[ 0 ] + clusterChild.mIncrement[ 0 ]
+                                                          , clusterMinIndices[ 1 ] + clusterChild.mIncrement[ 1 ]
+                                                          , clusterMinIndices[ 2 ] + clusterChild.mIncrement[ 2 ] } ;
+                if(     ( idxChild[ 0 ] >= childLayer.GetNumPoints( 0 ) )
+                    ||  ( idxChild[ 1 ] >= childLayer.GetNumPoints( 1 ) )
+                    ||  ( idxChild[ 2 ] >= childLayer.GetNumPoints( 2 ) ) )
+                {   // Cluster overhangs child layer.
+                    continue ;
+                }
+                const unsigned  offsetChild     = unsigned( childLayer.OffsetFromIndices( idxChild[ 0 ] , idxChild[ 1 ] , idxChild[ 2 ] ) ) ;
+                const Vorton &  rVortonChild    = childLayer[ offsetChild ] ;
+                if( 0.0f == rVortonChild.mSize )
+                {   // Cell holds no vortons, so contributes nothing.
+                    continue ;
+                }
+                // Queries never read indices of leaf cells, and those could exceed what keys hold.
+                Node node = MakeNode( rVortonChild , childrenAreLeaves ? 0 : MortonEncode( idxChild[ 0 ] , idxChild[ 1 ] , idxChild[ 2 ] ) ) ;
+                if( childrenAreLeaves )
+                {   // Record offset of leaf cell, so queries can find its vortons.
+                    node.mFirstChild = offsetChild ;
+                }
+                mNodes.PushBack( node ) ;
+                ++ numChildren ;
+            }
+            // PushBack can reallocate mNodes, so index parent afresh.
+            mNodes[ iParent ].mFirstChild               = iFirstChild ;
+            mNodes[ iParent ].mCellKeyAndNumChildren   |= numChildren << CELL_KEY_BITS ;
+        }
+
+        iParentBegin    = iParentEnd ;
+        iParentEnd      = mNodes.Size() ;
+    }
+
+    mSource = & influenceTree ;
+    return true ;
+}
@@ -0,0 +1,132 @@
+/** \file linearInfluenceTree.h
+
+    \brief Compact copy of the vorton influence tree, with nodes in one array, children contiguous and in Morton order.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef LINEAR_INFLUENCE_TREE_H
+#define LINEAR_INFLUENCE_TREE_H
+
+#include <xmmintrin.h>  // For _mm_prefetch
+
+#include "Core/SpatialPartition/nestedGrid.h"
+#include "Core/Containers/vector.h"
+#include "Core/Math/morton.h"
+#include "Core/Math/vec3.h"
+
+#include "vorton.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Compact copy of the vorton influence tree, with nodes in one array, children contiguous and in Morton order.
+
+    NestedGrid< Vorton > stores each layer of the influence tree as its own
+    UniformGrid of whole Vorton records, most of whose members treecode
+    queries never read, including cells that hold no vortons.  A query that
+    descends the tree jumps between those separate allocations at each
+    level, and reads a cache line or two per supervorton.
+
+    This holds the same tree as one array of slim nodes, each holding only
+    what treecode queries read:  position, angular velocity and size of its
+    supervorton, Morton key of its cell, and where its children start.  Nodes
+    lie in breadth-first order from the root, so the children of each node
+    are contiguous, and siblings lie in Morton order of their cells, so
+    siblings near each other in space lie near each other in memory.  Only
+    cells that contain vortons get nodes, since the rest contribute nothing.
+
+    Each node packs the indices of its cell, as a 24-bit Morton key, and
+    its number of children, into one 32-bit word, half what 16-bit indices
+    and a 16-bit count would occupy.  Only nodes above the leaf layer
+    need indices, so only those layers must fit MAX_KEYED_POINTS_PER_AXIS.
+
+    Build copies the tree after CreateInfluenceTree changes it, in time
+    linear in the number of occupied cells.
+*/
+class LinearInfluenceTree
+{
+    public:
+        static const unsigned MAX_CHILDREN              = 64    ;   ///< Largest number of child cells per cluster Build supports.  Queries keep a list of children to open on the stack.
+        static const unsigned MAX_KEYED_POINTS_PER_AXIS = 256   ;   ///< Largest number of points along each axis, in layers above the leaf layer, whose cell indices fit into Node keys.
+        static const unsigned CELL_KEY_BITS             = 24    ;   ///< Number of low bits of Node::mCellKeyAndNumChildren that hold the Morton key of its cell.
+
+        /// Slim copy of one occupied cell of the influence tree, and its supervorton.
+        struct Node
+        {
+            Vec3            mPosition           ;   ///< Center of vorticity of supervorton.
+            float           mSize               ;   ///< Diameter of supervorton.  See Particle::mSize.
+            Vec3            mAngularVelocity    ;   ///< Angular velocity of supervorton.  See Particle::mAngularVelocity.
+            unsigned        mFirstChild         ;   ///< Index of first child node.  For nodes of the leaf layer, offset of the cell in that layer instead, which also indexes the vorton cell list.
+            unsigned        mCellKeyAndNumChildren ;    ///< Morton key of indices of cell within its layer in the low CELL_KEY_BITS bits, and number of occupied children in the rest.  Leaf nodes have key 0.
+        #if defined( _DEBUG )
+            unsigned        mNumVortonsIncorporated ;   ///< Number of vortons supervorton represents.  See Particle::mNumVortonsIncorporated.
+        #endif
+
+            /// Return number of occupied children, which lie contiguously starting at mFirstChild.
+            unsigned GetNumChildren() const { return mCellKeyAndNumChildren >> CELL_KEY_BITS ; }
+
+            /// Obtain indices of cell within its layer.  Only meaningful for nodes above the leaf layer.
+            void GetCellIndices( unsigned indices[ 3 ] ) const { MortonDecode( indices , mCellKeyAndNumChildren & ( ( 1 << CELL_KEY_BITS ) - 1 ) ) ; }
+        } ;
+
+        LinearInfluenceTree()
+            : mSource( NULLPTR )
+        {}
+
+        // Use compiler-generated destructor, copy constructor and assignment operator.
+
+        bool Build( const NestedGrid< Vorton > & influenceTree ) ;
+
+        /// Discard all nodes.
+        void Clear()
+        {
+            mNodes.Clear() ;
+            mMinCorners.Clear() ;
+            mCellSpacings.Clear() ;
+            mSource = NULLPTR ;
+        }
+
+        /// Return whether the most recent Build succeeded, for the given tree.
+        bool IsBuiltFrom( const NestedGrid< Vorton > & influenceTree ) const { return ( & influenceTree == mSource ) && ! mNodes.Empty() ; }
+
+        /// Return node with the given index.  Node 0 is the root, i.e. cell (0,0,0) of the top layer.
+        const Node &    operator[]( size_t iNode ) const    { return mNodes[ iNode ] ; }
+
+        /// Return minimal corner of the given layer.
+        const Vec3 &    GetMinCorner( size_t iLayer ) const     { return mMinCorners[ iLayer ] ; }
+
+        /// Return distance between cell faces in the given layer.
+        const Vec3 &    GetCellSpacing( size_t iLayer ) const   { return mCellSpacings[ iLayer ] ; }
+
+        /// Return number of layers, including the leaf layer.
+        size_t          GetDepth() const                        { return mMinCorners.Size() ; }
+
+        /** Ask the processor to start fetching the children of the given node into cache.
+
+            Queries call this when they decide to open a node, then finish
+            summing its siblings before descending, so fetching the next
+            level overlaps with computing this one.
+        */
+        void PrefetchChildren( const Node & node ) const
+        {
+            const char * begin  = reinterpret_cast< const char * >( & mNodes[ 0 ] + node.mFirstChild ) ;
+            const char * end    = begin + node.GetNumChildren() * sizeof( Node ) ;
+            for( const char * line = begin ; line < end ; line += 64 )
+            {   // For each cache line spanned by children...
+                _mm_prefetch( line , _MM_HINT_T0 ) ;
+            }
+        }
+
+    private:
+        VECTOR< Node >                  mNodes          ;   ///< Occupied cells of every layer, breadth-first from the root, so children of each node are contiguous.  Siblings lie in Morton order.
+        VECTOR< Vec3 >                  mMinCorners     ;   ///< Minimal corner of each layer, indexed as in NestedGrid.
+        VECTOR< Vec3 >                  mCellSpacings   ;   ///< Cell spacing of each layer, indexed as in NestedGrid.
+        const NestedGrid< Vorton > *    mSource         ;   ///< Tree that the most recent successful Build copied, or NULL.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -20,17 +20,19 @@
 
 
 
-/** \note   This routine cannot successfully duplicate mMinCorner or
-            mMaxCorner, since they are references to externally owned
-            objects.
+/** \note   This routine cannot successfully duplicate mMinCorner,
+            mMaxCorner, mDomain or mNest, since they are references to externally
+            owned objects.
             Completely cloning this object relies upon an external
-            entity appropriately assigning mMinCorner and mMaxCorner.
+            entity appropriately assigning mMinCorner, mMaxCorner, mDomain and mNest.
 */
 PclOpVortonSim & PclOpVortonSim::operator=( const PclOpVortonSim & that )
 {
     mVortonSim = that.mVortonSim ;
     mMinCorner = 0 ;
     mMaxCorner = 0 ;
+    mDomain    = 0 ;
+    mNest      = 0 ;
 
     return * this ;
 }
@@ -55,6 +57,29 @@ void PclOpVortonSim::Operate(  VECTOR< Particle > & particles , float timeStep ,
     //ASSERT( ( mVortonSim.GetVortons() == 0 ) || ( & particles == reinterpret_cast< VECTOR< Particle > * >( mVortonSim.GetVortons() ) ) ) ;
     mVortonSim.SetVortons( reinterpret_cast< VECTOR< Vorton > * >( & particles ) ) ;
 
+    ASSERT( ! ( mDomain && mNest ) ) ; // Nesting inside a domain decomposition is not supported.
+
+    if( mDomain )
+    {   // Other processes simulate other parts of the fluid.
+        // Trade vortons with them, so this process has its own, plus the neighbors and far-field influence of theirs.
+        mDomain->BeginUpdate( * mVortonSim.GetVortons() ) ;
+        if( particles.Empty() )
+        {   // This process owns no part of the fluid, and received nothing.
+            return ;
+        }
+    }
+
+    if( mNest )
+    {   // A finer simulation owns vortons near its focus.
+        // Replace those with supervortons, so this simulation sees their influence at its own resolution.
+        mNest->BeginUpdate( mVortonSim , timeStep , uFrame ) ;
+        if( particles.Empty() )
+        {   // Fine simulation owns all vortons, and they aggregated to nothing.
+            mNest->EndUpdate( mVortonSim ) ;
+            return ;
+        }
+    }
+
     mVortonSim.FindBoundingBox() ;
 
     if( mMinCorner && mMaxCorner )
@@ -68,4 +93,14 @@ void PclOpVortonSim::Operate(  VECTOR< Particle > & particles , float timeStep ,
     }
 
     mVortonSim.Update( timeStep , uFrame ) ;
+
+    if( mDomain )
+    {   // Discard vortons other processes own, before advection moves them.
+        mDomain->EndUpdate( * mVortonSim.GetVortons() ) ;
+    }
+
+    if( mNest )
+    {   // Discard supervortons and return fine vortons, before advection moves them.
+        mNest->EndUpdate( mVortonSim ) ;
+    }
 }
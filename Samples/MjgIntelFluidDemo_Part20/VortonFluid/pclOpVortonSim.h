@@ -31,6 +31,8 @@
 #define PCL_OP_VORTON_SIM_H
 
 #include "vortonSim.h"
+#include "vortonDomain.h"
+#include "vortonNest.h"
 #include "Particles/particleSystem.h"
 
 // Macros --------------------------------------------------------------
@@ -49,12 +51,16 @@ class PclOpVortonSim : public IParticleOperation
         PclOpVortonSim()
             : mMinCorner( 0 )
             , mMaxCorner( 0 )
+            , mDomain( 0 )
+            , mNest( 0 )
         {
         }
 
         PclOpVortonSim( const PclOpVortonSim & that )
             : mMinCorner( 0 )
             , mMaxCorner( 0 )
+            , mDomain( 0 )
+            , mNest( 0 )
         {
             this->operator=( that ) ;
         }
@@ -68,6 +74,8 @@ class PclOpVortonSim : public IParticleOperation
         VortonSim       mVortonSim      ;   ///< Vorton fluid simulator
         const Vec3 *    mMinCorner      ;   ///< Minimal corner to generate velocity grid
         const Vec3 *    mMaxCorner      ;   ///< Maximal corner to generate velocity grid
+        VortonDomain *  mDomain         ;   ///< Decomposition into slabs simulated by separate processes, or NULL if this process simulates the whole fluid.
+        VortonNest *    mNest           ;   ///< Finer simulation nested around a focus, or NULL to simulate the whole fluid at one resolution.
 } ;
 
 // Public variables --------------------------------------------------------------
@@ -0,0 +1,138 @@
+/** \file velocitySum.h
+
+    \brief Accumulators that sum velocity contributions to a chosen precision.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef VELOCITY_SUM_H
+#define VELOCITY_SUM_H
+
+#include "Core/Math/vec3.h"
+
+// Macros --------------------------------------------------------------
+
+#define VELOCITY_SUM_FLOAT          'VSFL'  ///< Accumulate in float.  Fastest.
+#define VELOCITY_SUM_COMPENSATED    'VSKA'  ///< Accumulate in float, with Kahan-Babuska compensation.  Nearly as accurate as double, without converting each addend.
+#define VELOCITY_SUM_DOUBLE         'VSDB'  ///< Accumulate in double.
+
+/** How VortonSim sums velocity contributions from groups of vortons.
+
+    Each contribution comes from float math, and contributions within a
+    small group (a chunk of vortons in direct summation, or the clusters
+    of one treecode level) sum in float.  This chooses how those group
+    sums combine, which is where rounding error otherwise grows with the
+    number of vortons and with the range of their magnitudes.
+
+    ComputeVelocity_Direct, ComputeVelocity_Tree and ComputeVelocity_LinearTree use this.  Grouped
+    treecode queries (VORTON_SIM_GROUP_TREE_QUERIES) accumulate straight
+    into float velocities that every level of traversal shares, so still
+    sum in float; disable those to use this with the treecode.
+
+    \see VortonVelocitySum.
+*/
+#define VELOCITY_SUM VELOCITY_SUM_FLOAT
+
+// Types --------------------------------------------------------------
+
+/** Sum of velocity contributions, accumulated in float.
+*/
+class VelocitySumFloat
+{
+    public:
+        VelocitySumFloat() : mSum( 0.0f , 0.0f , 0.0f ) {}
+
+        void Add( const Vec3 & addend ) { mSum += addend ; }
+
+        Vec3 GetSum() const { return mSum ; }
+
+    private:
+        Vec3    mSum    ;   ///< Running sum.
+} ;
+
+
+
+
+/** Sum of velocity contributions, accumulated in float with compensation for rounding error.
+
+    This uses the Kahan-Babuska (Neumaier) variant of compensated summation,
+    which remains accurate even when an addend exceeds the running sum.
+    It relies on the compiler preserving the order of floating-point
+    operations, as /fp:precise (the default) does but /fp:fast does not.
+*/
+class VelocitySumCompensated
+{
+    public:
+        VelocitySumCompensated() : mSum( 0.0f , 0.0f , 0.0f ) , mCompensation( 0.0f , 0.0f , 0.0f ) {}
+
+        void Add( const Vec3 & addend )
+        {
+            AddComponent( mSum.x , mCompensation.x , addend.x ) ;
+            AddComponent( mSum.y , mCompensation.y , addend.y ) ;
+            AddComponent( mSum.z , mCompensation.z , addend.z ) ;
+        }
+
+        Vec3 GetSum() const { return mSum + mCompensation ; }
+
+    private:
+        static void AddComponent( float & sum , float & compensation , float addend )
+        {
+            const float total = sum + addend ;
+            if( fabsf( sum ) >= fabsf( addend ) )
+            {   // Low-order bits of addend got lost.
+                compensation += ( sum - total ) + addend ;
+            }
+            else
+            {   // Low-order bits of sum got lost.
+                compensation += ( addend - total ) + sum ;
+            }
+            sum = total ;
+        }
+
+        Vec3    mSum            ;   ///< Running sum, rounded.
+        Vec3    mCompensation   ;   ///< Accumulated rounding error of mSum.
+} ;
+
+
+
+
+/** Sum of velocity contributions, accumulated in double.
+*/
+class VelocitySumDouble
+{
+    public:
+        VelocitySumDouble() : mX( 0.0 ) , mY( 0.0 ) , mZ( 0.0 ) {}
+
+        void Add( const Vec3 & addend )
+        {
+            mX += double( addend.x ) ;
+            mY += double( addend.y ) ;
+            mZ += double( addend.z ) ;
+        }
+
+        Vec3 GetSum() const { return Vec3( float( mX ) , float( mY ) , float( mZ ) ) ; }
+
+    private:
+        double  mX  ;   ///< Running sum of x-components.
+        double  mY  ;   ///< Running sum of y-components.
+        double  mZ  ;   ///< Running sum of z-components.
+} ;
+
+
+
+
+#if VELOCITY_SUM == VELOCITY_SUM_FLOAT
+    typedef VelocitySumFloat        VortonVelocitySum ; ///< Velocity accumulator VortonSim uses.  See VELOCITY_SUM.
+#elif VELOCITY_SUM == VELOCITY_SUM_COMPENSATED
+    typedef VelocitySumCompensated  VortonVelocitySum ; ///< Velocity accumulator VortonSim uses.  See VELOCITY_SUM.
+#elif VELOCITY_SUM == VELOCITY_SUM_DOUBLE
+    typedef VelocitySumDouble       VortonVelocitySum ; ///< Velocity accumulator VortonSim uses.  See VELOCITY_SUM.
+#else
+    #error Velocity sum is invalid or undefined.  Assign VELOCITY_SUM in velocitySum.h or change this code.
+#endif
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
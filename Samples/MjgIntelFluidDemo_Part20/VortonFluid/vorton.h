@@ -40,12 +40,14 @@
 #define VELOCITY_TECHNIQUE_TREE                 'VTTC'  ///< Faster O(N log N), moderately accurate treecode
 #define VELOCITY_TECHNIQUE_MONOPOLES            'VTMP'  ///< Even faster O(N log N), less accurate monopole
 #define VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL 'VTPG'  ///< Differential approach: Use a finite-difference Poisson solver.  O(N) when USE_MULTI_GRID is enabled, O(N^3/2) otherwise.
+#define VELOCITY_TECHNIQUE_FMM                  'VTFM'  ///< O(N) fast multipole method: supervorton multipoles, first-order local expansions.  Accuracy comparable to treecode.
 
 /// Which technique to use to compute velocity from vorticity.
 //#define VELOCITY_TECHNIQUE  VELOCITY_TECHNIQUE_DIRECT
 //#define VELOCITY_TECHNIQUE  VELOCITY_TECHNIQUE_TREE
 #define VELOCITY_TECHNIQUE  VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL
 //#define VELOCITY_TECHNIQUE  VELOCITY_TECHNIQUE_MONOPOLES // No longer supported
+//#define VELOCITY_TECHNIQUE  VELOCITY_TECHNIQUE_FMM
 
 /** Variations on integral techniques for computing velocity from vorticity.
 
@@ -68,7 +70,7 @@
     #define USE_PARTICLE_IN_CELL        0
 #endif
 
-#if ( ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) )
+#if ( ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM ) )
     #define COMPUTE_VELOCITY_AT_VORTONS 0
 
     #if COMPUTE_VELOCITY_AT_VORTONS
@@ -178,12 +180,50 @@ static const float  TwoThirds   = 2.0f / 3.0f   ;
     vVelocity +=  velocityContribution * mSpreadingCirculationFactor ;                                              \
 }
 
+/** Compute velocity, and its gradient, due to a vorton, at a query point.
+
+    This accumulates the same velocity as VORTON_ACCUMULATE_VELOCITY_private,
+    and also accumulates into mVelocityGradient (a Mat33) the exact gradient of
+    that velocity field, with respect to query position.  Row j of the gradient
+    is the derivative of velocity along axis j, as StretchAndTiltVortons expects.
+
+    The velocity is s (w ^ r) where w is angular velocity, r is the
+    displacement from vorton to query point, and s is a function of |r|.  So
+    the derivative along axis j is s (w ^ e_j) + (w ^ r) ds/dr_j.  Inside the
+    core, s is constant.  Outside, s is proportional to |r|^-3, so
+    ds/dr_j = -3 s r_j / |r|^2.
+
+    \see VORTON_ACCUMULATE_VELOCITY_private for parameters.
+*/
+#define VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT_private( vVelocity , mVelocityGradient , vPosQuery , mPosition , mAngularVelocity , mSize , mSpreadingRangeFactor , mSpreadingCirculationFactor ) \
+{                                                                                                                   \
+    const Vec3          vOtherToSelf    = vPosQuery - mPosition ;                                                   \
+    const float         radius          = mSize * 0.5f * mSpreadingRangeFactor ;                                    \
+    const float         radius2         = radius * radius ;                                                         \
+    const float         dist2           = vOtherToSelf.Mag2() ;                                                     \
+    const bool          insideCore      = dist2 < radius2 ;                                                         \
+    const float         distLaw         = insideCore                                                                \
+                                        ?   /*  Inside vortex core */ ( 1.0f / ( radius2 * radius ) )               \
+                                        :   /* Outside vortex core */ ( finvsqrtf( dist2 ) / dist2 ) ;              \
+    const float         strength        = TwoThirds * radius2 * radius * distLaw * mSpreadingCirculationFactor ;    \
+    const Vec3          velocityContribution = strength * ( mAngularVelocity ^ vOtherToSelf ) ;                     \
+    const Vec3          velocityTimesSlope   = velocityContribution * ( insideCore ? 0.0f : ( -3.0f / dist2 ) ) ;   \
+    const Vec3 &        angVel          = mAngularVelocity ;                                                        \
+    vVelocity += velocityContribution ;                                                                             \
+    mVelocityGradient.x += strength * Vec3(   0.0f    ,  angVel.z , -angVel.y ) + velocityTimesSlope * vOtherToSelf.x ; \
+    mVelocityGradient.y += strength * Vec3( -angVel.z ,   0.0f    ,  angVel.x ) + velocityTimesSlope * vOtherToSelf.y ; \
+    mVelocityGradient.z += strength * Vec3(  angVel.y , -angVel.x ,   0.0f    ) + velocityTimesSlope * vOtherToSelf.z ; \
+}
+
 /// Wrapper for VORTON_ACCUMULATE_VECTOR_POTENTIAL_private.
 #define VORTON_ACCUMULATE_VECTOR_POTENTIAL( vVecPot , vPosQuery , vorton ) VORTON_ACCUMULATE_VECTOR_POTENTIAL_private( vVecPot , vPosQuery , vorton.mPosition , vorton.mAngularVelocity , vorton.mSize , mSpreadingRangeFactor , mSpreadingCirculationFactor )
 
 /// Wrapper for VORTON_ACCUMULATE_VELOCITY_private.
 #define VORTON_ACCUMULATE_VELOCITY(       vVelocity , vPosQuery , vorton ) VORTON_ACCUMULATE_VELOCITY_private(       vVelocity , vPosQuery , vorton.mPosition , vorton.mAngularVelocity , vorton.mSize , mSpreadingRangeFactor , mSpreadingCirculationFactor )
 
+/// Wrapper for VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT_private.
+#define VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT( vVelocity , velocityGradient , vPosQuery , vorton ) VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT_private( vVelocity , velocityGradient , vPosQuery , vorton.mPosition , vorton.mAngularVelocity , vorton.mSize , mSpreadingRangeFactor , mSpreadingCirculationFactor )
+
 
 // Types --------------------------------------------------------------
 
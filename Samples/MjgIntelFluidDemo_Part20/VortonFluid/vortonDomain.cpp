@@ -0,0 +1,548 @@
+/** \file vortonDomain.cpp
+
+    \brief Decomposition of a vorton simulation into slabs, each simulated by a separate process.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "vortonDomain.h"
+
+#include "Core/Performance/perfBlock.h"
+#include "Core/Utility/macros.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+// Private functions --------------------------------------------------------------
+
+/** Return the component of the given vector along the given axis.
+*/
+static inline float AxisComponent( const Vec3 & v , unsigned axis )
+{
+    ASSERT( axis < 3 ) ;
+    return ( 0 == axis ) ? v.x : ( ( 1 == axis ) ? v.y : v.z ) ;
+}
+
+
+
+
+/** Append the bytes of the given object to the given message.
+*/
+template< typename T > static void AppendToMessage( VECTOR< char > & message , const T & object )
+{
+    const size_t offset = message.Size() ;
+    message.Resize( offset + sizeof( T ) ) ;
+    memcpy( & message[ offset ] , & object , sizeof( T ) ) ;
+}
+
+
+
+
+/** Read an object from the given message, at the given offset, and advance the offset past it.
+*/
+template< typename T > static void ReadFromMessage( T & object , const VECTOR< char > & message , size_t & offset )
+{
+    ASSERT( offset + sizeof( T ) <= message.Size() ) ;
+    memcpy( & object , & message[ offset ] , sizeof( T ) ) ;
+    offset += sizeof( T ) ;
+}
+
+
+
+
+/** Append the vortons in the given message, starting at the given offset, to the given array.
+
+    \return Number of vortons appended.
+*/
+static size_t AppendVortonsFromMessage( VECTOR< Vorton > & vortons , const VECTOR< char > & message , size_t offset , size_t numVortons )
+{
+    ASSERT( offset + numVortons * sizeof( Vorton ) <= message.Size() ) ;
+    const size_t numVortonsBefore = vortons.Size() ;
+    vortons.Resize( numVortonsBefore + numVortons ) ;
+    if( numVortons > 0 )
+    {
+        memcpy( & vortons[ numVortonsBefore ] , & message[ offset ] , numVortons * sizeof( Vorton ) ) ;
+    }
+    return numVortons ;
+}
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+/** Construct a domain decomposition that communicates through the given transport.
+
+    \param transport    Means of exchanging messages with other ranks.  Must outlive this object.
+
+    Call Initialize before use.
+*/
+VortonDomain::VortonDomain( IVortonDomainTransport & transport )
+    : mTransport( transport )
+    , mAxis( 0 )
+    , mGhostMargin( 0.0f )
+    , mNumSupervortonCellsPerAxis( 8 )
+    , mImbalanceTolerance( 1.1f )
+    , mNumOwnedVortons( 0 )
+    , mNumGhostVortons( 0 )
+    , mNumSupervortons( 0 )
+    , mNumRebalances( 0 )
+{
+}
+
+
+
+
+/** Divide the given domain into one slab per rank, of equal thickness.
+
+    \param domainGeometry   Region all ranks together simulate.  Every rank must pass the same value.
+
+    \param ghostMargin      Distance from a slab within which vortons get copied into it as ghosts.
+                            Must be at least the largest neighborhood radius
+                            particle strength exchange and SPH use, that is,
+                            a few vorton diameters.
+
+    \param numSupervortonCellsPerAxis   Number of coarse cells, along each axis, into which
+                            vortons farther than ghostMargin from a slab aggregate
+                            before going to that slab.  More cells cost
+                            more bandwidth but represent remote vorticity
+                            more accurately.
+*/
+void VortonDomain::Initialize( const UniformGridGeometry & domainGeometry , float ghostMargin , unsigned numSupervortonCellsPerAxis )
+{
+    PERF_BLOCK( VortonDomain__Initialize ) ;
+
+    ASSERT( ghostMargin >= 0.0f ) ;
+    ASSERT( numSupervortonCellsPerAxis >= 1 ) ;
+
+    mDomainGeometry             = domainGeometry ;
+    mGhostMargin                = ghostMargin ;
+    mNumSupervortonCellsPerAxis = numSupervortonCellsPerAxis ;
+    mNumRebalances              = 0 ;
+
+    // Divide along the longest axis, which keeps slabs thickest relative to the ghost margin.
+    const Vec3 & extent = mDomainGeometry.GetExtent() ;
+    mAxis = 0 ;
+    if( extent.y > AxisComponent( extent , mAxis ) ) mAxis = 1 ;
+    if( extent.z > AxisComponent( extent , mAxis ) ) mAxis = 2 ;
+
+    const unsigned  numRanks    = mTransport.GetNumRanks() ;
+    const float     axisMin     = AxisComponent( mDomainGeometry.GetMinCorner() , mAxis ) ;
+    const float     axisExtent  = AxisComponent( extent , mAxis ) ;
+    mSlabBoundaries.Resize( numRanks + 1 ) ;
+    for( unsigned iRank = 0 ; iRank <= numRanks ; ++ iRank )
+    {   // For each slab boundary...
+        mSlabBoundaries[ iRank ] = axisMin + axisExtent * float( iRank ) / float( numRanks ) ;
+    }
+    // Outermost slabs extend to infinity, so every vorton has an owner.
+    mSlabBoundaries[ 0 ]        = - FLT_MAX ;
+    mSlabBoundaries[ numRanks ] =   FLT_MAX ;
+
+    mOutgoing.Resize( numRanks ) ;
+    mIncoming.Resize( numRanks ) ;
+}
+
+
+
+
+/** Return index of rank whose slab contains the given position.
+*/
+unsigned VortonDomain::GetOwnerRank( const Vec3 & position ) const
+{
+    const unsigned  numRanks        = mTransport.GetNumRanks() ;
+    const float     coordinate      = AxisComponent( position , mAxis ) ;
+    // Interior boundaries, mSlabBoundaries[1..numRanks-1], are sorted, so the owner is the number of them at or below coordinate.
+    const float *   interiorBegin   = & mSlabBoundaries[ 0 ] + 1 ;
+    const float *   interiorEnd     = & mSlabBoundaries[ 0 ] + numRanks ;
+    return static_cast< unsigned >( std::upper_bound( interiorBegin , interiorEnd , coordinate ) - interiorBegin ) ;
+}
+
+
+
+
+/** Return whether this rank owns the given position.
+*/
+bool VortonDomain::IsOwned( const Vec3 & position ) const
+{
+    return GetOwnerRank( position ) == mTransport.GetRank() ;
+}
+
+
+
+
+/** Return whether the given position lies within the ghost margin of the slab of the given rank.
+*/
+bool VortonDomain::IsGhostFor( const Vec3 & position , unsigned rank ) const
+{
+    const float coordinate = AxisComponent( position , mAxis ) ;
+    return ( coordinate >= mSlabBoundaries[ rank     ] - mGhostMargin )
+        && ( coordinate <  mSlabBoundaries[ rank + 1 ] + mGhostMargin ) ;
+}
+
+
+
+
+/** Return index of histogram bin, along the decomposition axis, that contains the given position.
+*/
+size_t VortonDomain::HistogramBin( const Vec3 & position ) const
+{
+    const float axisMin     = AxisComponent( mDomainGeometry.GetMinCorner() , mAxis ) ;
+    const float axisExtent  = AxisComponent( mDomainGeometry.GetExtent() , mAxis ) ;
+    const float binFloat    = ( AxisComponent( position , mAxis ) - axisMin ) * float( sNumHistogramBins ) / Max2( axisExtent , FLT_MIN ) ;
+    // Vortons outside the domain count toward the outermost bins.
+    return static_cast< size_t >( Clamp( binFloat , 0.0f , float( sNumHistogramBins - 1 ) ) ) ;
+}
+
+
+
+
+/** Exchange vortons with other ranks, so this rank has what VortonSim::Update needs.
+
+    \param vortons  (in/out) On input, vortons this rank owned after the previous
+                    update, which advection has since moved.  On output, vortons
+                    this rank now owns, followed by ghosts and supervortons
+                    from other ranks.
+
+    Every rank must call this, once per update.
+*/
+void VortonDomain::BeginUpdate( VECTOR< Vorton > & vortons )
+{
+    PERF_BLOCK( VortonDomain__BeginUpdate ) ;
+
+    ASSERT( mSlabBoundaries.Size() == mTransport.GetNumRanks() + 1 ) ; // Initialize must precede this.
+
+    mNumGhostVortons = 0 ;
+    mNumSupervortons = 0 ;
+
+    if( mTransport.GetNumRanks() > 1 )
+    {   // Other ranks exist.
+        Rebalance( vortons ) ;
+        Migrate( vortons ) ;
+        mNumOwnedVortons = vortons.Size() ;
+        ExchangeGhostsAndSupervortons( vortons ) ;
+    }
+    else
+    {   // This rank owns everything, so has nothing to exchange.
+        mNumOwnedVortons = vortons.Size() ;
+    }
+}
+
+
+
+
+/** Discard vortons outside the slab of this rank.
+
+    \param vortons  (in/out) Vortons after VortonSim::Update.  On output, only those this rank owns.
+
+    This discards the ghosts and supervortons BeginUpdate received,
+    since their owners update them, and any vorton the update created
+    outside this slab, since the rank that owns that region creates its own.
+
+    Call this after VortonSim::Update and before advection,
+    since ghosts remain outside this slab only until then.
+*/
+void VortonDomain::EndUpdate( VECTOR< Vorton > & vortons )
+{
+    PERF_BLOCK( VortonDomain__EndUpdate ) ;
+
+    if( mTransport.GetNumRanks() <= 1 )
+    {   // This rank owns everything.
+        return ;
+    }
+
+    const size_t numVortons = vortons.Size() ;
+    size_t numKept = 0 ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton...
+        if( IsOwned( vortons[ iVorton ].mPosition ) )
+        {   // This rank owns vorton, so keep it.
+            if( numKept != iVorton )
+            {
+                vortons[ numKept ] = vortons[ iVorton ] ;
+            }
+            ++ numKept ;
+        }
+    }
+    vortons.Resize( numKept ) ;
+}
+
+
+
+
+/** Move slab boundaries, if vorton counts have grown too uneven, so each slab has about the same number of vortons.
+
+    Each rank sends every other rank its count, and a histogram of its
+    vortons along the decomposition axis.  Since every rank receives the
+    same information, each computes the same boundaries.
+*/
+void VortonDomain::Rebalance( const VECTOR< Vorton > & vortons )
+{
+    PERF_BLOCK( VortonDomain__Rebalance ) ;
+
+    const unsigned numRanks = mTransport.GetNumRanks() ;
+
+    // Histogram this rank's vortons.
+    unsigned histogram[ sNumHistogramBins ] ;
+    memset( histogram , 0 , sizeof( histogram ) ) ;
+    const size_t numVortons = vortons.Size() ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton this rank has...
+        ++ histogram[ HistogramBin( vortons[ iVorton ].mPosition ) ] ;
+    }
+
+    // Send histogram to every rank, including this one.
+    VECTOR< char > message ;
+    message.Reserve( sizeof( histogram ) ) ;
+    AppendToMessage( message , histogram ) ;
+    for( unsigned iRank = 0 ; iRank < numRanks ; ++ iRank )
+    {
+        mOutgoing[ iRank ] = message ;
+    }
+    mTransport.AllToAll( mOutgoing , mIncoming ) ;
+
+    // Sum histograms from all ranks, and count vortons in each slab under current boundaries.
+    double  globalHistogram[ sNumHistogramBins ] ;
+    memset( globalHistogram , 0 , sizeof( globalHistogram ) ) ;
+    VECTOR< double > slabCounts ;
+    slabCounts.Resize( numRanks , 0.0 ) ;
+    double total = 0.0 ;
+    for( unsigned iRank = 0 ; iRank < numRanks ; ++ iRank )
+    {   // For each rank that sent a histogram...
+        unsigned    remoteHistogram[ sNumHistogramBins ] ;
+        size_t      offset = 0 ;
+        ReadFromMessage( remoteHistogram , mIncoming[ iRank ] , offset ) ;
+        for( size_t iBin = 0 ; iBin < sNumHistogramBins ; ++ iBin )
+        {
+            globalHistogram[ iBin ] += double( remoteHistogram[ iBin ] ) ;
+            // Each rank held only vortons it owned before advection, which moves them little, so attribute each to its sender.
+            slabCounts[ iRank ] += double( remoteHistogram[ iBin ] ) ;
+        }
+        total += slabCounts[ iRank ] ;
+    }
+
+    const double mean       = total / double( numRanks ) ;
+    const double maxCount   = * std::max_element( slabCounts.Begin() , slabCounts.End() ) ;
+    if( ( total <= 0.0 ) || ( maxCount <= mean * double( mImbalanceTolerance ) ) )
+    {   // Slabs are balanced enough.
+        return ;
+    }
+
+    // Place each interior boundary at the bin edge where the cumulative count reaches its share.
+    const float axisMin     = AxisComponent( mDomainGeometry.GetMinCorner() , mAxis ) ;
+    const float axisExtent  = AxisComponent( mDomainGeometry.GetExtent() , mAxis ) ;
+    const float binWidth    = axisExtent / float( sNumHistogramBins ) ;
+    double      cumulative  = 0.0 ;
+    size_t      iBin        = 0 ;
+    for( unsigned iBoundary = 1 ; iBoundary < numRanks ; ++ iBoundary )
+    {   // For each interior boundary...
+        const double target = total * double( iBoundary ) / double( numRanks ) ;
+        while( ( iBin < sNumHistogramBins ) && ( cumulative + globalHistogram[ iBin ] <= target ) )
+        {   // Bin fits below this boundary.
+            cumulative += globalHistogram[ iBin ] ;
+            ++ iBin ;
+        }
+        mSlabBoundaries[ iBoundary ] = axisMin + binWidth * float( iBin ) ;
+    }
+
+    ++ mNumRebalances ;
+}
+
+
+
+
+/** Send vortons outside the slab of this rank to the ranks that own them, and receive vortons this rank now owns.
+*/
+void VortonDomain::Migrate( VECTOR< Vorton > & vortons )
+{
+    PERF_BLOCK( VortonDomain__Migrate ) ;
+
+    const unsigned numRanks = mTransport.GetNumRanks() ;
+    const unsigned thisRank = mTransport.GetRank() ;
+
+    for( unsigned iRank = 0 ; iRank < numRanks ; ++ iRank )
+    {
+        mOutgoing[ iRank ].Clear() ;
+    }
+
+    const size_t numVortons = vortons.Size() ;
+    size_t numKept = 0 ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton this rank had...
+        const Vorton &  vorton  = vortons[ iVorton ] ;
+        const unsigned  owner   = GetOwnerRank( vorton.mPosition ) ;
+        if( owner == thisRank )
+        {   // Vorton stays.
+            if( numKept != iVorton )
+            {
+                vortons[ numKept ] = vorton ;
+            }
+            ++ numKept ;
+        }
+        else
+        {   // Vorton moved into another slab.
+            AppendToMessage( mOutgoing[ owner ] , vorton ) ;
+        }
+    }
+    vortons.Resize( numKept ) ;
+
+    mTransport.AllToAll( mOutgoing , mIncoming ) ;
+
+    for( unsigned iRank = 0 ; iRank < numRanks ; ++ iRank )
+    {   // For each rank that sent vortons...
+        const VECTOR< char > & message = mIncoming[ iRank ] ;
+        ASSERT( 0 == message.Size() % sizeof( Vorton ) ) ;
+        AppendVortonsFromMessage( vortons , message , 0 , message.Size() / sizeof( Vorton ) ) ;
+    }
+}
+
+
+
+
+/** Send each other rank ghosts and supervortons from this rank, and append those other ranks send.
+
+    \param vortons  (in/out) On input, vortons this rank owns.  On output,
+                    those followed by ghosts and supervortons from other ranks.
+
+    Each message holds the number of ghosts, then the ghosts, then the supervortons.
+*/
+void VortonDomain::ExchangeGhostsAndSupervortons( VECTOR< Vorton > & vortons )
+{
+    PERF_BLOCK( VortonDomain__ExchangeGhostsAndSupervortons ) ;
+
+    const unsigned  numRanks    = mTransport.GetNumRanks() ;
+    const unsigned  thisRank    = mTransport.GetRank() ;
+    const size_t    numVortons  = vortons.Size() ;
+
+    for( unsigned iRank = 0 ; iRank < numRanks ; ++ iRank )
+    {   // For each rank...
+        VECTOR< char > & message = mOutgoing[ iRank ] ;
+        message.Clear() ;
+        if( iRank == thisRank )
+        {   // This rank already has its own vortons.
+            continue ;
+        }
+
+        size_t numGhosts = 0 ;
+        AppendToMessage( message , numGhosts ) ;    // Placeholder, overwritten below.
+        for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+        {   // For each vorton this rank owns...
+            if( IsGhostFor( vortons[ iVorton ].mPosition , iRank ) )
+            {   // Vorton is near enough to slab of iRank to be among neighbors there.
+                AppendToMessage( message , vortons[ iVorton ] ) ;
+                ++ numGhosts ;
+            }
+        }
+        memcpy( & message[ 0 ] , & numGhosts , sizeof( numGhosts ) ) ;
+
+        AggregateSupervortons( message , vortons , iRank ) ;
+    }
+
+    mTransport.AllToAll( mOutgoing , mIncoming ) ;
+
+    for( unsigned iRank = 0 ; iRank < numRanks ; ++ iRank )
+    {   // For each rank that sent a message...
+        const VECTOR< char > & message = mIncoming[ iRank ] ;
+        if( ( iRank == thisRank ) || message.Empty() )
+        {
+            continue ;
+        }
+        size_t offset    = 0 ;
+        size_t numGhosts = 0 ;
+        ReadFromMessage( numGhosts , message , offset ) ;
+        mNumGhostVortons += AppendVortonsFromMessage( vortons , message , offset , numGhosts ) ;
+        offset += numGhosts * sizeof( Vorton ) ;
+        ASSERT( 0 == ( message.Size() - offset ) % sizeof( Vorton ) ) ;
+        mNumSupervortons += AppendVortonsFromMessage( vortons , message , offset , ( message.Size() - offset ) / sizeof( Vorton ) ) ;
+    }
+}
+
+
+
+
+/** Aggregate vortons not already sent as ghosts to the given rank into supervortons, and append those to the given message.
+
+    \param message  (in/out) Message to the given rank.
+
+    \param vortons  Vortons this rank owns.
+
+    \param rank     Rank to receive supervortons.
+
+    This aggregates the same way VortonSim::AggregateClusters does:
+    Supervorton position is the vorticity-magnitude-weighted average of the
+    positions of its vortons, and its vorticity is the sum of theirs,
+    so it has the same far-field influence.
+
+    Coarse cells span the bounding box of this rank's vortons,
+    so a supervorton stays near the vortons it represents.
+*/
+void VortonDomain::AggregateSupervortons( VECTOR< char > & message , const VECTOR< Vorton > & vortons , unsigned rank )
+{
+    PERF_BLOCK( VortonDomain__AggregateSupervortons ) ;
+
+    const size_t numVortons = vortons.Size() ;
+    if( 0 == numVortons )
+    {
+        return ;
+    }
+
+    Vec3 minCorner( vortons[ 0 ].mPosition ) ;
+    Vec3 maxCorner( vortons[ 0 ].mPosition ) ;
+    for( size_t iVorton = 1 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton this rank owns...
+        const Vec3 & position = vortons[ iVorton ].mPosition ;
+        minCorner.x = Min2( minCorner.x , position.x ) ;
+        minCorner.y = Min2( minCorner.y , position.y ) ;
+        minCorner.z = Min2( minCorner.z , position.z ) ;
+        maxCorner.x = Max2( maxCorner.x , position.x ) ;
+        maxCorner.y = Max2( maxCorner.y , position.y ) ;
+        maxCorner.z = Max2( maxCorner.z , position.z ) ;
+    }
+
+    const unsigned  numCellsPerAxis = mNumSupervortonCellsPerAxis ;
+    const Vec3      extent          = maxCorner - minCorner ;
+    const Vec3      cellsPerLength  ( float( numCellsPerAxis ) / Max2( extent.x , FLT_MIN ) ,
+                                      float( numCellsPerAxis ) / Max2( extent.y , FLT_MIN ) ,
+                                      float( numCellsPerAxis ) / Max2( extent.z , FLT_MIN ) ) ;
+    const float     maxCellIndex    = float( numCellsPerAxis - 1 ) ;
+
+    VECTOR< Vorton >    supervortons ;
+    VECTOR< float >     vortNormSums ;
+    supervortons.Resize( numCellsPerAxis * numCellsPerAxis * numCellsPerAxis ) ;
+    vortNormSums.Resize( supervortons.Size() , 0.0f ) ;
+
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton this rank owns...
+        const Vorton & vorton = vortons[ iVorton ] ;
+        if( IsGhostFor( vorton.mPosition , rank ) )
+        {   // Rank already has this vorton, as a ghost.
+            continue ;
+        }
+        const Vec3      offset  = vorton.mPosition - minCorner ;
+        const unsigned  ix      = static_cast< unsigned >( Clamp( offset.x * cellsPerLength.x , 0.0f , maxCellIndex ) ) ;
+        const unsigned  iy      = static_cast< unsigned >( Clamp( offset.y * cellsPerLength.y , 0.0f , maxCellIndex ) ) ;
+        const unsigned  iz      = static_cast< unsigned >( Clamp( offset.z * cellsPerLength.z , 0.0f , maxCellIndex ) ) ;
+        const size_t    iCell   = ix + numCellsPerAxis * ( iy + numCellsPerAxis * iz ) ;
+
+        Vorton &        supervorton = supervortons[ iCell ] ;
+        const float     vortMag     = vorton.GetVorticity().Magnitude() ;
+        supervorton.mPosition           += vorton.mPosition * vortMag ;
+        supervorton.mAngularVelocity    += vorton.mAngularVelocity ;
+        supervorton.mSize                = vorton.mSize ;
+        supervorton.mDensity             = vorton.mDensity ;
+        vortNormSums[ iCell ]           += vortMag ;
+    }
+
+    const size_t numCells = supervortons.Size() ;
+    for( size_t iCell = 0 ; iCell < numCells ; ++ iCell )
+    {   // For each coarse cell...
+        if( vortNormSums[ iCell ] > FLT_MIN )
+        {   // Cell has vorticity, so its supervorton influences other slabs.
+            Vorton & supervorton = supervortons[ iCell ] ;
+            supervorton.mPosition /= vortNormSums[ iCell ] ;
+            AppendToMessage( message , supervorton ) ;
+        }
+    }
+}
@@ -0,0 +1,172 @@
+/** \file vortonDomain.h
+
+    \brief Decomposition of a vorton simulation into slabs, each simulated by a separate process.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef VORTON_DOMAIN_H
+#define VORTON_DOMAIN_H
+
+#include "Core/wrapperMacros.h"
+#include "Core/Containers/vector.h"
+#include "Core/SpatialPartition/uniformGrid.h"
+#include "vorton.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Interface to a means of exchanging messages between the processes ("ranks") that simulate subdomains.
+
+    VortonDomain decides what to send, and serializes vortons into bytes;
+    a transport only moves those bytes.  A transport for a cluster would
+    wrap MPI_Alltoall (for sizes) and MPI_Alltoallv (for contents); a
+    transport for one process returns each message to its sender.
+
+    \see VortonDomainLocalTransport
+*/
+class IVortonDomainTransport
+{
+    public:
+        virtual ~IVortonDomainTransport() {}
+
+        /// Return index of this process, in [0,GetNumRanks()).
+        virtual unsigned GetRank() const = 0 ;
+
+        /// Return number of processes, each simulating one subdomain.
+        virtual unsigned GetNumRanks() const = 0 ;
+
+        /** Send one message to every rank, and receive one message from every rank.
+
+            \param outgoing Message to send to each rank, indexed by rank.  Must have GetNumRanks() entries, any of which can be empty.
+
+            \param incoming (out) Message received from each rank, indexed by rank.
+
+            This is collective: every rank must call it, the same number of times, in the same order.
+        */
+        virtual void AllToAll( const VECTOR< VECTOR< char > > & outgoing , VECTOR< VECTOR< char > > & incoming ) = 0 ;
+} ;
+
+
+
+
+/** Transport for a simulation that runs as one process, which owns the whole domain.
+
+    This lets code that uses VortonDomain run unchanged without a cluster.
+*/
+class VortonDomainLocalTransport : public IVortonDomainTransport
+{
+    public:
+        virtual unsigned GetRank() const      { return 0 ; }
+        virtual unsigned GetNumRanks() const  { return 1 ; }
+
+        virtual void AllToAll( const VECTOR< VECTOR< char > > & outgoing , VECTOR< VECTOR< char > > & incoming )
+        {
+            incoming = outgoing ;
+        }
+} ;
+
+
+
+
+/** Decomposition of a vorton simulation into slabs, each simulated by a separate process.
+
+    Each rank owns the vortons inside one slab of the domain, along its
+    longest axis.  Around each VortonSim::Update, BeginUpdate and EndUpdate
+    exchange what each rank needs from the others:
+
+        -   Vortons that left a slab migrate to the rank that owns their new position.
+
+        -   Vortons within the ghost margin of a neighboring slab get copied
+            there, as "ghosts", so particle strength exchange and SPH see
+            complete neighborhoods.  The margin must be at least the largest
+            neighborhood radius those use.
+
+        -   Every other vorton contributes to supervortons, one per coarse
+            cell, aggregated the same way VortonSim::AggregateClusters
+            aggregates clusters.  Remote ranks receive only these, so each
+            rank sees the whole fluid in its influence tree, but exchanges
+            messages whose size depends on the coarse grid, not the number
+            of vortons.
+
+    When vorton counts across slabs grow uneven, BeginUpdate moves slab
+    boundaries so each rank owns about the same number of vortons.
+
+    EndUpdate discards every vorton outside this rank's slab, which
+    includes ghosts and supervortons, since their owners update them.
+
+    Typical use, on every rank:
+
+        VortonDomain domain( transport ) ;
+        domain.Initialize( domainGeometry , ghostMargin ) ;
+        pclOpVortonSim.mDomain = & domain ;   // PclOpVortonSim::Operate calls BeginUpdate and EndUpdate.
+*/
+class VortonDomain
+{
+    public:
+        /// Number of bins along the decomposition axis into which Rebalance sorts vortons to find slab boundaries.
+        static const size_t sNumHistogramBins = 256 ;
+
+        explicit VortonDomain( IVortonDomainTransport & transport ) ;
+
+        void    Initialize( const UniformGridGeometry & domainGeometry , float ghostMargin , unsigned numSupervortonCellsPerAxis = 8 ) ;
+
+        void    BeginUpdate( VECTOR< Vorton > & vortons ) ;
+        void    EndUpdate( VECTOR< Vorton > & vortons ) ;
+
+        /// Set how uneven vorton counts can get before Rebalance moves slab boundaries: the ratio of the largest count to the mean.
+        void    SetImbalanceTolerance( float imbalanceTolerance ) { mImbalanceTolerance = imbalanceTolerance ; }
+
+        /// Return index of axis along which slabs divide the domain.
+        unsigned    GetAxis() const                             { return mAxis ; }
+
+        /// Return coordinate, along GetAxis, where the slab of the given rank begins.  Slab of rank r spans [GetSlabBegin(r),GetSlabBegin(r+1)).
+        float       GetSlabBegin( unsigned rank ) const         { return mSlabBoundaries[ rank ] ; }
+
+        unsigned    GetOwnerRank( const Vec3 & position ) const ;
+
+        /// Return number of vortons this rank owned after the most recent BeginUpdate.
+        size_t      GetNumOwnedVortons() const                  { return mNumOwnedVortons ; }
+
+        /// Return number of ghost vortons other ranks sent during the most recent BeginUpdate.
+        size_t      GetNumGhostVortons() const                  { return mNumGhostVortons ; }
+
+        /// Return number of supervortons other ranks sent during the most recent BeginUpdate.
+        size_t      GetNumSupervortons() const                  { return mNumSupervortons ; }
+
+        /// Return number of times Rebalance moved slab boundaries since Initialize.
+        size_t      GetNumRebalances() const                    { return mNumRebalances ; }
+
+    private:
+        VortonDomain( const VortonDomain & ) ;              // Disallow copy
+        VortonDomain & operator=( const VortonDomain & ) ;  // Disallow assignment
+
+        bool    IsOwned( const Vec3 & position ) const ;
+        bool    IsGhostFor( const Vec3 & position , unsigned rank ) const ;
+        size_t  HistogramBin( const Vec3 & position ) const ;
+
+        void    Rebalance( const VECTOR< Vorton > & vortons ) ;
+        void    Migrate( VECTOR< Vorton > & vortons ) ;
+        void    ExchangeGhostsAndSupervortons( VECTOR< Vorton > & vortons ) ;
+        void    AggregateSupervortons( VECTOR< char > & message , const VECTOR< Vorton > & vortons , unsigned rank ) ;
+
+        IVortonDomainTransport &    mTransport                  ;   ///< Means of exchanging messages with other ranks.
+        UniformGridGeometry         mDomainGeometry             ;   ///< Region all ranks together simulate.  Vortons outside it belong to the nearest slab.
+        unsigned                    mAxis                       ;   ///< Index of axis along which slabs divide the domain.  This is the longest axis of mDomainGeometry.
+        VECTOR< float >             mSlabBoundaries             ;   ///< Coordinate along mAxis where each slab begins, plus one past the last.  The first and last are infinite.
+        float                       mGhostMargin                ;   ///< Distance from a slab within which vortons get copied into it as ghosts.
+        unsigned                    mNumSupervortonCellsPerAxis ;   ///< Number of coarse cells, along each axis of a slab, into which vortons aggregate into supervortons.
+        float                       mImbalanceTolerance         ;   ///< Ratio of largest to mean vorton count beyond which Rebalance moves slab boundaries.
+        size_t                      mNumOwnedVortons            ;   ///< Number of vortons this rank owned after the most recent BeginUpdate.
+        size_t                      mNumGhostVortons            ;   ///< Number of ghost vortons received during the most recent BeginUpdate.
+        size_t                      mNumSupervortons            ;   ///< Number of supervortons received during the most recent BeginUpdate.
+        size_t                      mNumRebalances              ;   ///< Number of times Rebalance moved slab boundaries since Initialize.
+        VECTOR< VECTOR< char > >    mOutgoing                   ;   ///< Message to each rank.  Member, rather than local, so messages reuse memory.
+        VECTOR< VECTOR< char > >    mIncoming                   ;   ///< Message from each rank.  Member, rather than local, so messages reuse memory.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
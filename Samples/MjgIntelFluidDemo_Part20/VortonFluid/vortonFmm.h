@@ -0,0 +1,123 @@
+/** \file vortonFmm.h
+
+    \brief Local expansions and translation operators for the fast multipole velocity technique.
+
+    \see VELOCITY_TECHNIQUE_FMM, VortonSim::ComputeFmmLocalExpansions
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef VORTON_FMM_H
+#define VORTON_FMM_H
+
+#include "Core/Math/vec3.h"
+#include "Core/Math/mat33.h"
+
+#include "vorton.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** First-order local expansion of velocity about the center of a grid cell.
+
+    The expansion holds velocity at the center and the Jacobian of velocity
+    there, so velocity anywhere inside the cell is approximately
+
+        v(x) = mVelocity + mJacobian . ( x - center )
+
+    mJacobian follows the convention of UniformGrid::ComputeJacobian:
+    mJacobian.x is the derivative of velocity with respect to x, and likewise
+    for y and z.
+*/
+struct VortonFmmLocalExpansion
+{
+    VortonFmmLocalExpansion()
+        : mVelocity( 0.0f , 0.0f , 0.0f )
+        , mJacobian( Vec3( 0.0f , 0.0f , 0.0f ) , Vec3( 0.0f , 0.0f , 0.0f ) , Vec3( 0.0f , 0.0f , 0.0f ) )
+    {}
+
+    /** Evaluate this expansion at the given displacement from its center.
+    */
+    Vec3 Evaluate( const Vec3 & vDisplacement ) const
+    {
+        return mVelocity + mJacobian.x * vDisplacement.x + mJacobian.y * vDisplacement.y + mJacobian.z * vDisplacement.z ;
+    }
+
+    /** Translate a parent expansion into this one, i.e. the L2L operator.
+
+        \param parent - expansion of the parent cell.
+
+        \param vDisplacement - center of this cell minus center of the parent cell.
+
+        A first-order expansion has constant Jacobian, so only velocity changes.
+    */
+    void AssignFromParent( const VortonFmmLocalExpansion & parent , const Vec3 & vDisplacement )
+    {
+        mVelocity = parent.Evaluate( vDisplacement ) ;
+        mJacobian = parent.mJacobian ;
+    }
+
+    Vec3    mVelocity   ;   ///< Velocity at the expansion center.
+    Mat33   mJacobian   ;   ///< Spatial derivatives of velocity at the expansion center.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+/** Accumulate velocity and its Jacobian, induced at a query point by a (super)vorton, into a local expansion, i.e. the M2L operator.
+
+    The (super)vorton is the monopole of the multipole expansion of its cell.
+    The velocity part is identical to VORTON_ACCUMULATE_VELOCITY_private.
+    Derivatives follow from differentiating that same regularized law:
+    Outside the core, v = k w ^ r / |r|^3, so
+        dv/dx_j = k ( w ^ e_j / |r|^3 - 3 ( w ^ r ) r_j / |r|^5 ).
+    Inside the core, v = k w ^ r / R^3, so dv/dx_j = k w ^ e_j / R^3.
+
+    \param local - (in/out) expansion into which to accumulate.
+
+    \param vPosQuery - expansion center.
+
+    \param position - position of (super)vorton.
+
+    \param angularVelocity - angular velocity of (super)vorton.
+
+    \param size - diameter of (super)vorton.
+
+    \param spreadingRangeFactor - see VORTON_ACCUMULATE_VELOCITY_private.
+
+    \param spreadingCirculationFactor - see VORTON_ACCUMULATE_VELOCITY_private.
+*/
+inline void VortonAccumulateLocalExpansion( VortonFmmLocalExpansion & local , const Vec3 & vPosQuery , const Vec3 & position , const Vec3 & angularVelocity , float size , float spreadingRangeFactor , float spreadingCirculationFactor )
+{
+    const Vec3      vOtherToSelf    = vPosQuery - position ;
+    const float     radius          = size * 0.5f * spreadingRangeFactor ;
+    const float     radius2         = radius * radius ;
+    const float     dist2           = vOtherToSelf.Mag2() ;
+    const float     strength        = TwoThirds * radius2 * radius * spreadingCirculationFactor ;
+    const Vec3 &    w               = angularVelocity ;
+    // w ^ e_j for each axis j, used by both laws.
+    const Vec3      wCrossEx( 0.0f , w.z , - w.y ) ;
+    const Vec3      wCrossEy( - w.z , 0.0f , w.x ) ;
+    const Vec3      wCrossEz( w.y , - w.x , 0.0f ) ;
+    if( dist2 < radius2 )
+    {   // Inside vortex core; linear law.
+        const float distLaw = strength / ( radius2 * radius ) ;
+        local.mVelocity   += ( w ^ vOtherToSelf ) * distLaw ;
+        local.mJacobian.x += wCrossEx * distLaw ;
+        local.mJacobian.y += wCrossEy * distLaw ;
+        local.mJacobian.z += wCrossEz * distLaw ;
+    }
+    else
+    {   // Outside vortex core; inverse-square law.
+        const float distLaw         = strength * finvsqrtf( dist2 ) / dist2 ;
+        const float gradLaw         = - 3.0f * distLaw / dist2 ;
+        const Vec3  velocityShape   = w ^ vOtherToSelf ;
+        local.mVelocity   += velocityShape * distLaw ;
+        local.mJacobian.x += wCrossEx * distLaw + velocityShape * ( gradLaw * vOtherToSelf.x ) ;
+        local.mJacobian.y += wCrossEy * distLaw + velocityShape * ( gradLaw * vOtherToSelf.y ) ;
+        local.mJacobian.z += wCrossEz * distLaw + velocityShape * ( gradLaw * vOtherToSelf.z ) ;
+    }
+}
+
+#endif
@@ -0,0 +1,416 @@
+/** \file vortonNest.cpp
+
+    \brief Finer vorton simulation nested inside a coarser one, around a moving focus.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+
+#include "vortonNest.h"
+
+#include "Core/Performance/perfBlock.h"
+#include "Core/Utility/macros.h"
+
+#include <float.h>
+
+// Private functions --------------------------------------------------------------
+
+/** Return whether any cell spacing of the given grid is smaller than that of another.
+*/
+static inline bool IsFinerThan( const UniformGridGeometry & grid , const UniformGridGeometry & other )
+{
+    const Vec3 & spacing        = grid.GetCellSpacing() ;
+    const Vec3 & otherSpacing   = other.GetCellSpacing() ;
+    return ( spacing.x < otherSpacing.x ) || ( spacing.y < otherSpacing.y ) || ( spacing.z < otherSpacing.z ) ;
+}
+
+
+
+
+/** Return the given position, moved to lie just inside the given grid, so interpolation stays within bounds.
+*/
+static inline Vec3 ClampInside( const Vec3 & position , const UniformGridGeometry & grid )
+{
+    static const float sInsideFraction = 0.9999f ;  // Positions on the maximal faces would otherwise index a cell past the last.
+    const Vec3 & minCorner  = grid.GetMinCorner() ;
+    const Vec3 & extent     = grid.GetExtent() ;
+    return Vec3( minCorner.x + Clamp( position.x - minCorner.x , 0.0f , extent.x * sInsideFraction )
+               , minCorner.y + Clamp( position.y - minCorner.y , 0.0f , extent.y * sInsideFraction )
+               , minCorner.z + Clamp( position.z - minCorner.z , 0.0f , extent.z * sInsideFraction ) ) ;
+}
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+/** Construct a nest that has no focus, hence leaves the coarse simulation alone.
+
+    Call Initialize and SetFocus before use.
+*/
+VortonNest::VortonNest()
+    : mFocus( 0 )
+    , mFineExtent( 0.0f , 0.0f , 0.0f )
+    , mFineMinCorner( 0.0f , 0.0f , 0.0f )
+    , mFineMaxCorner( 0.0f , 0.0f , 0.0f )
+    , mNumCoarseVortons( 0 )
+    , mActive( false )
+{
+}
+
+
+
+
+/** Set up the fine simulation to match the given coarse simulation, but at finer resolution.
+
+    \param coarseSim    Simulation of the whole domain.  The fine simulation
+                        copies its parameters (viscosity, buoyancy, etc.).
+                        This disables remeshing and vorton level of detail in
+                        coarseSim, since those would blend supervortons into
+                        its vortons.
+
+    \param fineExtent   Extent of the box, centered on the focus, that the fine simulation covers.
+
+    \param refinement   Ratio of gridpoints per vorton in the fine simulation
+                        to that in the coarse.  Each cell spacing shrinks by
+                        about the cube root of this.
+*/
+void VortonNest::Initialize( VortonSim & coarseSim , const Vec3 & fineExtent , float refinement )
+{
+    PERF_BLOCK( VortonNest__Initialize ) ;
+
+    ASSERT( refinement >= 1.0f ) ;
+    ASSERT( ( fineExtent.x > 0.0f ) && ( fineExtent.y > 0.0f ) && ( fineExtent.z > 0.0f ) ) ;
+
+    mFineSim = coarseSim ;
+    mFineSim.SetVortons( & mFineVortons ) ;
+    mFineSim.SetGridPointsPerVorton( coarseSim.GetGridPointsPerVorton() * refinement ) ;
+    mFineExtent = fineExtent ;
+
+#if ENABLE_VORTON_REMESHING
+    coarseSim.SetRemeshPeriod( 0 ) ;
+#endif
+#if ENABLE_VORTON_LOD
+    coarseSim.SetVortonBudget( 0 ) ;
+#endif
+
+    mFineVortons.Clear() ;
+    mSupervortons.Clear() ;
+    mExternalVelocity.Clear() ;
+    mActive = false ;
+}
+
+
+
+
+/** Update the fine simulation, and replace its vortons with supervortons in the coarse simulation.
+
+    \param coarseSim    Simulation of the whole domain.  Its vortons must be
+                        those the previous EndUpdate left, which advection has
+                        since moved.  On output, its vortons exclude those inside
+                        the fine box, and end with supervortons that represent those.
+
+    \param timeStep     Change in virtual time since last update.
+
+    \param uFrame       Frame counter.
+
+    Call this before VortonSim::Update of the coarse simulation.
+*/
+void VortonNest::BeginUpdate( VortonSim & coarseSim , float timeStep , unsigned uFrame )
+{
+    PERF_BLOCK( VortonNest__BeginUpdate ) ;
+
+    ASSERT( ! mActive ) ;   // Previous BeginUpdate must have had its EndUpdate.
+
+    mFineVortons.Clear() ;
+    mSupervortons.Clear() ;
+
+    if( 0 == mFocus )
+    {   // No focus, so coarse simulation covers everything.
+        return ;
+    }
+
+    VECTOR< Vorton > & vortons = * coarseSim.GetVortons() ;
+
+    PlaceFineBox() ;
+    ExtractFineVortons( vortons ) ;
+    mNumCoarseVortons = vortons.Size() ;
+    mActive = true ;
+
+    if( mFineVortons.Empty() )
+    {   // Fine box contains no vortons, so has nothing to simulate.
+        return ;
+    }
+
+    UpdateFineSim( timeStep , uFrame ) ;
+
+    // Coarse grid for this update does not exist yet, so match supervortons to the previous one, which usually has the same spacing.
+    AppendSupervortons( vortons , coarseSim.GetGrid() ) ;
+}
+
+
+
+
+/** Discard supervortons, apply coarse velocity to fine vortons, and return them to the coarse simulation.
+
+    \param coarseSim    Simulation of the whole domain, after VortonSim::Update.
+                        On output, its vortons include those of the fine
+                        simulation, at the end, and its vorton partition is empty.
+
+    Call this after VortonSim::Update of the coarse simulation, and before advection.
+*/
+void VortonNest::EndUpdate( VortonSim & coarseSim )
+{
+    PERF_BLOCK( VortonNest__EndUpdate ) ;
+
+    if( ! mActive )
+    {   // BeginUpdate left coarse simulation alone.
+        return ;
+    }
+    mActive = false ;
+
+    VECTOR< Vorton > & vortons = * coarseSim.GetVortons() ;
+    ASSERT( vortons.Size() == mNumCoarseVortons + mSupervortons.Size() ) ; // Coarse update must not add or remove vortons.
+
+    if( ! mFineVortons.Empty() )
+    {
+        ComputeExternalVelocity( coarseSim ) ;
+        ApplyExternalVelocityToFineVortons() ;
+    }
+
+    // Discard supervortons, and return fine vortons.
+    vortons.Resize( mNumCoarseVortons ) ;
+    vortons.Reserve( mNumCoarseVortons + mFineVortons.Size() ) ;
+    for( size_t iFine = 0 ; iFine < mFineVortons.Size() ; ++ iFine )
+    {
+        vortons.PushBack( mFineVortons[ iFine ] ) ;
+    }
+
+    // Partition indexed coarse vortons and supervortons, so its indices no longer match vortons.
+    // Clearing it makes consumers such as ReduceDivergence skip it, and makes the next coarse update rebuild it.
+    coarseSim.GetVortonCellList().Clear() ;
+}
+
+
+
+
+/** Compute velocity at the given position, using the fine simulation where the fine box contains it.
+
+    \param velocity     (out) Velocity at position, if this returns true.
+
+    \param position     Position at which to evaluate velocity.
+
+    \return Whether the fine box contains position and the most recent update simulated fine vortons.
+            When this returns false, use the coarse simulation instead.
+*/
+bool VortonNest::InterpolateVelocity( Vec3 & velocity , const Vec3 & position ) const
+{
+    if( mFineVortons.Empty() || ! Contains( position ) || ! mFineSim.GetVelocityGrid().Encompasses( position ) )
+    {
+        return false ;
+    }
+    mFineSim.InterpolateVelocity( velocity , position ) ;
+    Vec3 externalVelocity ;
+    InterpolateExternalVelocity( externalVelocity , position ) ;
+    velocity += externalVelocity ;
+    return true ;
+}
+
+// Private functions --------------------------------------------------------------
+
+
+
+
+/** Center the fine box on the focus.
+*/
+void VortonNest::PlaceFineBox()
+{
+    ASSERT( mFocus ) ;
+    const Vec3 halfExtent = 0.5f * mFineExtent ;
+    mFineMinCorner = * mFocus - halfExtent ;
+    mFineMaxCorner = * mFocus + halfExtent ;
+}
+
+
+
+
+/** Move vortons inside the fine box from the given array to the fine simulation.
+
+    Remaining vortons keep their order.
+*/
+void VortonNest::ExtractFineVortons( VECTOR< Vorton > & vortons )
+{
+    PERF_BLOCK( VortonNest__ExtractFineVortons ) ;
+
+    const size_t numVortons = vortons.Size() ;
+    size_t numKept = 0 ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton...
+        const Vorton & vorton = vortons[ iVorton ] ;
+        if( Contains( vorton.mPosition ) )
+        {   // Fine box contains vorton, so fine simulation owns it.
+            mFineVortons.PushBack( vorton ) ;
+        }
+        else
+        {   // Coarse simulation owns vorton.
+            if( numKept != iVorton )
+            {
+                vortons[ numKept ] = vorton ;
+            }
+            ++ numKept ;
+        }
+    }
+    vortons.Resize( numKept ) ;
+}
+
+
+
+
+/** Update the fine simulation, with a grid spanning the whole fine box.
+*/
+void VortonNest::UpdateFineSim( float timeStep , unsigned uFrame )
+{
+    PERF_BLOCK( VortonNest__UpdateFineSim ) ;
+
+    ASSERT( mFineSim.GetVortons() == & mFineVortons ) ;
+    mFineSim.FindBoundingBox() ;
+    mFineSim.UpdateBoundingBox( mFineMinCorner , mFineMaxCorner , true ) ;
+    mFineSim.Update( timeStep , uFrame ) ;
+}
+
+
+
+
+/** Append supervortons that represent fine vortons at the resolution of the coarse simulation.
+
+    \param vortons      (in/out) Vortons of the coarse simulation.
+
+    \param coarseGrid   Grid of the coarse simulation, whose cell spacing supervortons should match.
+
+    The fine simulation already aggregated its vortons into clusters, layer
+    by layer, using VortonSim::AggregateClusters.  This takes the finest
+    layer whose cells are at least as large as coarse cells; each occupied
+    cell of that layer becomes one supervorton.
+*/
+void VortonNest::AppendSupervortons( VECTOR< Vorton > & vortons , const UniformGridGeometry & coarseGrid )
+{
+    PERF_BLOCK( VortonNest__AppendSupervortons ) ;
+
+    const NestedGrid< Vorton > & influenceTree = mFineSim.GetInfluenceTree() ;
+    const size_t numLayers = influenceTree.GetDepth() ;
+    if( 0 == numLayers )
+    {   // Fine simulation built no tree.
+        return ;
+    }
+
+    size_t iLayer = numLayers - 1 ;
+    if( ! coarseGrid.HasZeroExtent() )
+    {   // Coarse grid exists, so find finest layer with cells at least as large.
+        iLayer = 0 ;
+        while( ( iLayer + 1 < numLayers ) && IsFinerThan( influenceTree[ iLayer ] , coarseGrid ) )
+        {
+            ++ iLayer ;
+        }
+    }
+
+    const UniformGrid< Vorton > &   layer           = influenceTree[ iLayer ] ;
+    const float                     ambientDensity  = mFineSim.GetAmbientDensity() ;
+    const size_t                    numCells        = layer.Size() ;
+    for( size_t offset = 0 ; offset < numCells ; ++ offset )
+    {   // For each cluster in layer...
+        const Vorton & cluster = layer[ offset ] ;
+        if( ( cluster.mSize > 0.0f ) && ( cluster.mAngularVelocity.Mag2() > FLT_MIN ) )
+        {   // Cluster has vorticity, so influences the coarse simulation.
+            Vorton supervorton( cluster ) ;
+            supervorton.mVelocity   = Vec3( 0.0f , 0.0f , 0.0f ) ;
+            // Clusters do not aggregate density, so make supervortons neutrally buoyant, lest they generate spurious baroclinic vorticity.
+            supervorton.mDensity    = ambientDensity ;
+            mSupervortons.PushBack( supervorton ) ;
+        }
+    }
+
+    vortons.Reserve( vortons.Size() + mSupervortons.Size() ) ;
+    for( size_t iSuper = 0 ; iSuper < mSupervortons.Size() ; ++ iSuper )
+    {
+        vortons.PushBack( mSupervortons[ iSuper ] ) ;
+    }
+}
+
+
+
+
+/** Evaluate, on a small grid spanning the fine box, velocity the coarse simulation induces there, excluding that of supervortons.
+
+    Coarse velocity includes the influence of supervortons, which represent
+    fine vortons, but the fine simulation already accounts for fine vortons
+    at full detail, so this subtracts the velocity supervortons induce.
+    What remains is the influence of vortons outside the fine box, which
+    is smooth across it, so a few cells per axis suffice.
+*/
+void VortonNest::ComputeExternalVelocity( const VortonSim & coarseSim )
+{
+    PERF_BLOCK( VortonNest__ComputeExternalVelocity ) ;
+
+    const unsigned numPoints[ 3 ] = { sNumExternalVelocityCellsPerAxis + 1 , sNumExternalVelocityCellsPerAxis + 1 , sNumExternalVelocityCellsPerAxis + 1 } ;
+    mExternalVelocity.DefineShapeFromPoints( mFineMinCorner , mFineMaxCorner - mFineMinCorner , numPoints ) ;
+    mExternalVelocity.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+
+    const UniformGrid< Vec3 > & coarseVelocityGrid  = coarseSim.GetVelocityGrid() ;
+    const size_t                numSupervortons     = mSupervortons.Size() ;
+
+    for( unsigned iz = 0 ; iz < numPoints[ 2 ] ; ++ iz )
+    for( unsigned iy = 0 ; iy < numPoints[ 1 ] ; ++ iy )
+    for( unsigned ix = 0 ; ix < numPoints[ 0 ] ; ++ ix )
+    {   // For each gridpoint spanning the fine box...
+        const Vec3 position = mExternalVelocity.PositionFromIndices( ix , iy , iz ) ;
+        if( coarseVelocityGrid.HasZeroExtent() || ! coarseVelocityGrid.Encompasses( position ) )
+        {   // Coarse simulation has no velocity here.
+            continue ;
+        }
+        Vec3 coarseVelocity ;
+        coarseSim.InterpolateVelocity( coarseVelocity , ClampInside( position , coarseVelocityGrid ) ) ;
+
+        Vec3 supervortonVelocity( 0.0f , 0.0f , 0.0f ) ;
+        for( size_t iSuper = 0 ; iSuper < numSupervortons ; ++ iSuper )
+        {   // For each supervorton...
+            mSupervortons[ iSuper ].AccumulateVelocity( supervortonVelocity , position ) ;
+        }
+
+        mExternalVelocity[ mExternalVelocity.OffsetFromIndices( ix , iy , iz ) ] = coarseVelocity - supervortonVelocity ;
+    }
+}
+
+
+
+
+/** Add external velocity to each fine vortons, which the fine update assigned only self-induced velocity.
+*/
+void VortonNest::ApplyExternalVelocityToFineVortons()
+{
+    PERF_BLOCK( VortonNest__ApplyExternalVelocityToFineVortons ) ;
+
+    const size_t numFine = mFineVortons.Size() ;
+    for( size_t iFine = 0 ; iFine < numFine ; ++ iFine )
+    {   // For each fine vorton...
+        Vorton & vorton = mFineVortons[ iFine ] ;
+        Vec3 externalVelocity ;
+        InterpolateExternalVelocity( externalVelocity , vorton.mPosition ) ;
+        vorton.mVelocity += externalVelocity ;
+    }
+}
+
+
+
+
+/** Interpolate external velocity at the given position, which should lie in the fine box.
+*/
+void VortonNest::InterpolateExternalVelocity( Vec3 & velocity , const Vec3 & position ) const
+{
+    if( mExternalVelocity.Empty() )
+    {   // Most recent update computed no external velocity.
+        velocity = Vec3( 0.0f , 0.0f , 0.0f ) ;
+        return ;
+    }
+    mExternalVelocity.Interpolate( velocity , ClampInside( position , mExternalVelocity ) ) ;
+}
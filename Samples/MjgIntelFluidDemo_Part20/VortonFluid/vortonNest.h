@@ -0,0 +1,139 @@
+/** \file vortonNest.h
+
+    \brief Finer vorton simulation nested inside a coarser one, around a moving focus.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef VORTON_NEST_H
+#define VORTON_NEST_H
+
+#include "Core/wrapperMacros.h"
+#include "Core/Containers/vector.h"
+#include "Core/SpatialPartition/uniformGrid.h"
+#include "vortonSim.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Finer vorton simulation nested inside a coarser one, around a moving focus.
+
+    Grid resolution of a VortonSim is uniform across its domain.  A nest
+    adds a second, finer VortonSim over a box around a focus, such as the
+    camera eye or a PhysicalObject, so the fluid has detail where the viewer
+    looks without paying for it everywhere.
+
+    The simulations couple both ways.  Around each coarse VortonSim::Update,
+    BeginUpdate and EndUpdate do this:
+
+        -   BeginUpdate moves vortons inside the fine box out of the coarse
+            array, and updates the fine simulation with only those.
+
+        -   The fine simulation built its influence tree using
+            VortonSim::AggregateClusters, so the layer of that tree whose
+            cells best match coarse cells already holds supervortons that
+            represent fine vortons at coarse resolution.  BeginUpdate appends
+            those to the coarse array, so the coarse update sees the influence
+            of fine vortons without their detail.
+
+        -   EndUpdate discards those supervortons, then evaluates the
+            velocity the coarse simulation induces inside the fine box, minus
+            that of the supervortons, since the fine simulation already
+            accounts for those at full detail.  That external velocity is
+            smooth at the scale of coarse cells, so EndUpdate evaluates it on a
+            small grid spanning the fine box, and adds it to fine vortons by
+            interpolation.  InterpolateVelocity likewise adds it to velocity
+            from the fine velocity grid.
+
+        -   EndUpdate returns fine vortons to the end of the coarse array, so
+            particle operations that follow, such as PclOpEvolve and
+            PclOpFluidBodyInteraction, act on all vortons.  That invalidates
+            indices in the coarse vorton partition, so EndUpdate clears it.
+
+    Remeshing and vorton level of detail replace vortons, which would blend
+    supervortons into the vortons of the coarse simulation, so Initialize
+    disables those in the coarse simulation.  The fine simulation can use them.
+
+    Typical use:
+
+        VortonNest nest ;
+        nest.Initialize( pclOpVortonSim.mVortonSim , fineExtent , 8.0f ) ;
+        nest.SetFocus( & camera.GetEye() ) ;    // ...or & physicalObject->GetBody()->GetPosition()
+        pclOpVortonSim.mNest = & nest ;         // PclOpVortonSim::Operate calls BeginUpdate and EndUpdate.
+*/
+class VortonNest
+{
+    public:
+        /// Number of cells, along each axis of the fine box, of the grid on which EndUpdate evaluates coarse velocity.
+        static const unsigned sNumExternalVelocityCellsPerAxis = 8 ;
+
+        VortonNest() ;
+
+        void    Initialize( VortonSim & coarseSim , const Vec3 & fineExtent , float refinement ) ;
+
+        /// Set position, such as the camera eye or the position of a rigid body, around which to center the fine box.  Must outlive its use.  NULL disables nesting.
+        void    SetFocus( const Vec3 * focus )                          { mFocus = focus ; }
+
+        /// Set extent of the box, centered on the focus, that the fine simulation covers.
+        void    SetFineExtent( const Vec3 & fineExtent )                { mFineExtent = fineExtent ; }
+
+        void    BeginUpdate( VortonSim & coarseSim , float timeStep , unsigned uFrame ) ;
+        void    EndUpdate( VortonSim & coarseSim ) ;
+
+        bool    InterpolateVelocity( Vec3 & velocity , const Vec3 & position ) const ;
+
+        /// Return whether the fine box contains the given position.
+        bool    Contains( const Vec3 & position ) const
+        {
+            return  ( position.x >= mFineMinCorner.x ) && ( position.x < mFineMaxCorner.x )
+                &&  ( position.y >= mFineMinCorner.y ) && ( position.y < mFineMaxCorner.y )
+                &&  ( position.z >= mFineMinCorner.z ) && ( position.z < mFineMaxCorner.z ) ;
+        }
+
+              VortonSim &           GetFineSim()                        { return mFineSim ; }
+        const VortonSim &           GetFineSim() const                  { return mFineSim ; }
+
+        /// Return minimal corner of the fine box as of the most recent BeginUpdate.
+        const Vec3 &                GetFineMinCorner() const            { return mFineMinCorner ; }
+
+        /// Return maximal corner of the fine box as of the most recent BeginUpdate.
+        const Vec3 &                GetFineMaxCorner() const            { return mFineMaxCorner ; }
+
+        /// Return number of vortons the fine simulation updated during the most recent BeginUpdate.
+        size_t                      GetNumFineVortons() const           { return mFineVortons.Size() ; }
+
+        /// Return number of supervortons that represented fine vortons in the most recent coarse update.
+        size_t                      GetNumSupervortons() const          { return mSupervortons.Size() ; }
+
+        /// Return velocity the coarse simulation induced inside the fine box during the most recent update, excluding that of supervortons.
+        const UniformGrid< Vec3 > & GetExternalVelocityGrid() const     { return mExternalVelocity ; }
+
+    private:
+        VortonNest( const VortonNest & ) ;              // Disallow copy
+        VortonNest & operator=( const VortonNest & ) ;  // Disallow assignment
+
+        void    PlaceFineBox() ;
+        void    ExtractFineVortons( VECTOR< Vorton > & vortons ) ;
+        void    UpdateFineSim( float timeStep , unsigned uFrame ) ;
+        void    AppendSupervortons( VECTOR< Vorton > & vortons , const UniformGridGeometry & coarseGrid ) ;
+        void    ComputeExternalVelocity( const VortonSim & coarseSim ) ;
+        void    ApplyExternalVelocityToFineVortons() ;
+        void    InterpolateExternalVelocity( Vec3 & velocity , const Vec3 & position ) const ;
+
+        VortonSim               mFineSim            ;   ///< Simulation of vortons inside the fine box.
+        const Vec3 *            mFocus              ;   ///< Position around which to center the fine box, or NULL to disable nesting.
+        Vec3                    mFineExtent         ;   ///< Extent of the fine box.
+        Vec3                    mFineMinCorner      ;   ///< Minimal corner of the fine box, as of the most recent BeginUpdate.
+        Vec3                    mFineMaxCorner      ;   ///< Maximal corner of the fine box, as of the most recent BeginUpdate.
+        VECTOR< Vorton >        mFineVortons        ;   ///< Vortons inside the fine box, from BeginUpdate until EndUpdate returns them to the coarse array.
+        VECTOR< Vorton >        mSupervortons       ;   ///< Supervortons that represent fine vortons in the coarse update.
+        size_t                  mNumCoarseVortons   ;   ///< Number of vortons the coarse array had, before BeginUpdate appended supervortons.
+        UniformGrid< Vec3 >     mExternalVelocity   ;   ///< Velocity the coarse simulation induces inside the fine box, excluding that of supervortons.
+        bool                    mActive             ;   ///< Whether the current update is nested, i.e. BeginUpdate extracted fine vortons.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
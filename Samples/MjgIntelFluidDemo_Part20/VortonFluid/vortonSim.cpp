@@ -16,39 +16,46 @@
 */
 
 #include "vortonSim.h"
-
-#include "vortonClusterAux.h"
+#include "arrheniusRateTable.h"
 
 #include "Particles/Operation/pclOpFindBoundingBox.h"
 #include "Particles/Operation/pclOpPopulateVelocityGrid.h"
 #include "Particles/Operation/pclOpEmit.h"
 
 #include "Core/SpatialPartition/uniformGridMath.h"
+#include "Core/SpatialPartition/uniformGridScatter.h"
 
 #include "Core/Performance/perfBlock.h"
+#include "Core/Performance/timer.h"
+
+#include "Core/Memory/frameArena.h"
 
-#include "Core/useTbb.h"
+#include "Core/parallelExecution.h"
 
 #include <limits>
 #include <algorithm>
 #include <stdlib.h>
+#include <string.h>
 
 
 
 
 #if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
 // Routines defined in smoothedPclHydro.cpp.
-void ComputeSphDensityAtParticles_Grid( VECTOR< SphFluidDensities > & fluidDensitiesAtPcls , const VECTOR< Vorton > & particles , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid ) ;
-void ComputeSphMassDensityGradient_Grid( VECTOR< Vec3 > & massDensityGradients
-                                        , const VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
-                                        , const VECTOR< Vorton > & particles
-                                        , const VECTOR< float > & proximities
-                                        , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid
-                                        , const float ambientDensity ) ;
+void ComputeSphDensityAndMassDensityGradient_Grid( VECTOR< SphFluidDensities > & fluidDensitiesAtPcls
+                                                 , VECTOR< Vec3 > & massDensityGradients
+                                                 , const VECTOR< Vorton > & particles
+                                                 , const VECTOR< float > & proximities
+                                                 , const SphNeighborList & neighborList
+                                                 , const float ambientDensity ) ;
 #endif
 
 #include "FluidBodySim/fluidBodySim.h"  // Included for experimental poisoning feature.
 
+#if ENABLE_VORTON_LOD || VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+#include "Impulsion/physicalObject.h"
+#endif
+
 
 
 
@@ -61,224 +68,122 @@ void ComputeSphMassDensityGradient_Grid( VECTOR< Vec3 > & massDensityGradients
 
 
 
-const float sInvalidDensity = UNIFORM_GRID_INVALID_VALUE ;
+/** Techniques for evaluating exponentials in CombustAndSetMassFractions.
+*/
+#define COMBUSTION_EXP_TECHNIQUE_EXACT      'CXEX'  ///< Library expf: Slowest, most accurate.
+#define COMBUSTION_EXP_TECHNIQUE_IMPRECISE  'CXIM'  ///< ImpreciseExpF: Relative error below 1e-5.
+#define COMBUSTION_EXP_TECHNIQUE_TABLE      'CXTB'  ///< Arrhenius rate from gArrheniusRateTable, smoke rate from ImpreciseExpF: Fastest, error near 1e-4.
 
-static const unsigned INVALID_INDEX = ~0UL ;
+/// Which technique CombustAndSetMassFractions uses to evaluate exponentials.
+//#define COMBUSTION_EXP_TECHNIQUE COMBUSTION_EXP_TECHNIQUE_EXACT
+//#define COMBUSTION_EXP_TECHNIQUE COMBUSTION_EXP_TECHNIQUE_IMPRECISE
+#define COMBUSTION_EXP_TECHNIQUE COMBUSTION_EXP_TECHNIQUE_TABLE
 
 
 
 
-#if USE_TBB
-    /** Function object to compute vector potential at gridpoints using Threading Building Blocks.
-    */
-    class VortonSim_ComputeVectorPotentialAtGridpoints_TBB
-    {
-            VortonSim *                                 mVortonSim          ;    ///< Address of VortonSim object
-            bool                                        mBoundariesOnly     ;
-            const UniformGrid< VECTOR< unsigned > > &   mVortonIndicesGrid  ;
-            const NestedGrid< Vorton > &                mInfluenceTree      ;
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of vector potential grid.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mVortonSim->ComputeVectorPotentialAtGridpoints_Slice( r.begin() , r.end() , mBoundariesOnly , mVortonIndicesGrid , mInfluenceTree ) ;
-            }
-            VortonSim_ComputeVectorPotentialAtGridpoints_TBB( VortonSim * pVortonSim , bool boundariesOnly , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
-                : mVortonSim( pVortonSim )
-                , mBoundariesOnly( boundariesOnly )
-                , mVortonIndicesGrid( vortonIndicesGrid )
-                , mInfluenceTree( influenceTree )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+/** Whether StretchAndTiltVortons computes the velocity Jacobian at each vorton directly from the velocity grid.
 
+    Otherwise it computes the velocity Jacobian at every gridpoint, into a
+    UniformGrid< Mat33 >, then interpolates that at each vorton.
 
-    /** Function object to compute velocity at gridpoints using Threading Building Blocks.
-    */
-    class VortonSim_ComputeVelocityAtGridpoints_TBB
-    {
-            VortonSim *                                 mVortonSim          ;    ///< Address of VortonSim object
-            const UniformGrid< VECTOR< unsigned > > &   mVortonIndicesGrid  ;
-            const NestedGrid< Vorton > &                mInfluenceTree      ;
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of velocity grid.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mVortonSim->ComputeVelocityAtGridpoints_Slice( r.begin() , r.end() , mVortonIndicesGrid , mInfluenceTree ) ;
-            }
-            VortonSim_ComputeVelocityAtGridpoints_TBB( VortonSim * pVortonSim , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
-                : mVortonSim( pVortonSim )
-                , mVortonIndicesGrid( vortonIndicesGrid )
-                , mInfluenceTree( influenceTree )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+    Row a of the interpolated Jacobian is the trilinear blend of centered
+    differences along axis a at the 8 gridpoints around the vorton.  That
+    equals the centered difference, along a, of velocity interpolated at
+    points one cell on either side of the vorton.  So sampling velocity at
+    those 6 points yields the same Jacobian (except near the domain boundary,
+    where the displaced points get clamped), without a Jacobian grid, which
+    costs 36 bytes per gridpoint to write then read.
+*/
+#define STRETCH_TILT_WITHOUT_JACOBIAN_GRID 1
 
 
-    /** Function object to compute velocity at vortons using Threading Building Blocks.
-    */
-    class VortonSim_ComputeVelocityAtVortons_TBB
-    {
-            VortonSim *                                 mVortonSim          ;    ///< Address of VortonSim object
-            const UniformGrid< VECTOR< unsigned > > &   mVortonIndicesGrid  ;
-            const NestedGrid< Vorton > &                mInfluenceTree      ;
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of velocity grid.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mVortonSim->ComputeVelocityAtVortons_Slice( r.begin() , r.end() , mVortonIndicesGrid , mInfluenceTree ) ;
-            }
-            VortonSim_ComputeVelocityAtVortons_TBB( VortonSim * pVortonSim , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
-                : mVortonSim( pVortonSim )
-                , mVortonIndicesGrid( vortonIndicesGrid )
-                , mInfluenceTree( influenceTree )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
 
 
-    /** Function object to compute fluid buoyancy using Threading Building Blocks.
-    */
-    class VortonSim_GenerateBaroclinicVorticity_TBB
-    {
-            float                   mTimeStep                   ;   /// Duration since last time step.
-            VortonSim *             mVortonSim                  ;   /// Address of VortonSim object
-            const VECTOR< Vec3 > *  mDensityGradientsPerVorton  ;   /// Density gradients per vortex particle.  Only used for COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH and COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS.
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of velocity grid.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-#           if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
-                mVortonSim->GenerateBaroclinicVorticitySlice( mTimeStep , mDensityGradientsPerVorton , r.begin() , r.end() ) ;
-#           else
-                mVortonSim->GenerateBaroclinicVorticitySlice( mTimeStep , r.begin() , r.end() ) ;
-#           endif
-            }
-            VortonSim_GenerateBaroclinicVorticity_TBB( float timeStep , VortonSim * pVortonSim , const VECTOR< Vec3 > * densityGradientsPerVorton )
-                : mTimeStep( timeStep )
-                , mVortonSim( pVortonSim )
-                , mDensityGradientsPerVorton( densityGradientsPerVorton )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+/** Whether grid-based GenerateBaroclinicVorticity computes the density gradient at each vorton directly from the density grid.
 
+    Otherwise it computes the density gradient at every gridpoint, into
+    mDensityGradientGrid, poisons that grid, then interpolates that at each vorton.
 
-    /** Function object to compute vorticity diffusion using Threading Building Blocks.
-    */
-    class VortonSim_DiffuseVorticityPSE_TBB
-    {
-            float                               mTimeStep       ;   ///< Duration since last time step.
-            VortonSim *                         mVortonSim      ;   ///< Address of VortonSim object
-            UniformGrid< VECTOR< unsigned > > & mUgVortonIndices;   ///< Reference to uniform grid of vorton indices
-            VortonSim::PhaseE                   mPhase          ;   ///< Processing phase: whether to run on odd, even or both values for z slice.
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of vorticity diffusion.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mVortonSim->DiffuseAndDissipateVorticityPSESlice( mTimeStep , mUgVortonIndices , r.begin() , r.end() , mPhase ) ;
-            }
-            VortonSim_DiffuseVorticityPSE_TBB( float timeStep , VortonSim * pVortonSim , UniformGrid< VECTOR< unsigned > > & ugVortonIndices , VortonSim::PhaseE phase )
-                : mTimeStep( timeStep )
-                , mVortonSim( pVortonSim )
-                , mUgVortonIndices( ugVortonIndices )
-                , mPhase( phase )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+    This uses the same identity as STRETCH_TILT_WITHOUT_JACOBIAN_GRID: The
+    interpolated centered-difference gradient equals the centered difference
+    of density interpolated one cell on either side of the vorton.  So the
+    gradient, wall poisoning and baroclinic torque happen in one parallel
+    pass over vortons, without writing then reading a Vec3 per gridpoint.
+    Poisoning applies at vortons instead of at gridpoints.
 
+    This has no effect when computing the gradient with vortons, i.e. with
+    COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH or
+    COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS.
+*/
+#define BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID 1
 
-    /** Function object to compute heat diffusion using Threading Building Blocks.
-    */
-    class VortonSim_DiffuseHeatPSE_TBB
-    {
-            float                                       mTimeStep       ;   ///< Duration since last time step.
-            VortonSim *                                 mVortonSim      ;   ///< Address of VortonSim object
-            const UniformGrid< VECTOR< unsigned > > &   mUgVortonIndices;   ///< Reference to uniform grid of vorton indices
-            VortonSim::PhaseE                           mPhase          ;   ///< Processing phase.
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Compute subset of heat diffusion.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                mVortonSim->DiffuseAndDissipateHeatPSESlice( mTimeStep , mUgVortonIndices , r.begin() , r.end() , mPhase ) ;
-            }
-            VortonSim_DiffuseHeatPSE_TBB( float timeStep , VortonSim * pVortonSim , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices , VortonSim::PhaseE phase )
-                : mTimeStep( timeStep )
-                , mVortonSim( pVortonSim )
-                , mUgVortonIndices( ugVortonIndices )
-                , mPhase( phase )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+#if BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID && ( POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS || POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS )
+    #error BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID requires poisoning that applies at each point independently.
+#endif
 
 
-#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
-    static void PoisonDensityGradientSlice( UniformGrid< Vec3 > & densityGradientGrid , const VECTOR< Vorton > & particles , size_t iPclStart , size_t iPclEnd ) ;
 
 
-    /** Function object to poison density gradient using Threading Building Blocks.
-    */
-    class VortonSim_PoisonDensityGradient_TBB
-    {
-            UniformGrid< Vec3 > &       mDensityGradientGrid;   ///< Reference to uniform grid of density gradient.
-            const VECTOR< Vorton > &    mVortons            ;   ///< Dynamic array of vortex particles.
-        public:
-            void operator() ( const tbb::blocked_range<size_t> & r ) const
-            {   // Poison a subset of density gradient.
-                SetFloatingPointControlWord( mMasterThreadFloatingPointControlWord ) ;
-                SetMmxControlStatusRegister( mMasterThreadMmxControlStatusRegister ) ;
-                PoisonDensityGradientSlice( mDensityGradientGrid , mVortons , r.begin() , r.end() ) ;
-            }
-            VortonSim_PoisonDensityGradient_TBB( UniformGrid< Vec3 > & densityGradientGrid , const VECTOR< Vorton > & vortons )
-                : mDensityGradientGrid( densityGradientGrid )
-                , mVortons( vortons )
-            {
-                mMasterThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
-                mMasterThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
-            }
-        private:
-            WORD        mMasterThreadFloatingPointControlWord   ;
-            unsigned    mMasterThreadMmxControlStatusRegister   ;
-    } ;
+const float sInvalidDensity = UNIFORM_GRID_INVALID_VALUE ;
+
+static const unsigned INVALID_INDEX = ~0UL ;
+
+#if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+/// Number of velocity grid cells along each edge of a block of the velocity activity mask.
+static const unsigned sVelocityGridBlockSize = 4 ;
+#endif
+
+#if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+/// Number of velocity grid cells along each edge of a block that RefineVelocityGrid considers for a patch.
+static const unsigned sVelocityPatchBlockSize = 4 ;
 #endif
 
+/// Technique for obtaining velocity from vorticity that VortonSim uses until told otherwise, based on VELOCITY_TECHNIQUE.
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_DIRECT
+static const VortonSim::VelocityFromVorticityTechniqueE sDefaultVelFromVortTechnique = VortonSim::VELOCITY_FROM_VORTICITY_DIRECT ;
+#elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL
+static const VortonSim::VelocityFromVorticityTechniqueE sDefaultVelFromVortTechnique = VortonSim::VELOCITY_FROM_VORTICITY_POISSON ;
+#else
+static const VortonSim::VelocityFromVorticityTechniqueE sDefaultVelFromVortTechnique = VortonSim::VELOCITY_FROM_VORTICITY_TREE ;
 #endif
 
+/// Return whether the given technique for obtaining velocity from vorticity solves a Poisson equation, and therefore needs the vorticity grid.
+static inline bool UsesVorticityGrid( VortonSim::VelocityFromVorticityTechniqueE technique )
+{
+    return ( VortonSim::VELOCITY_FROM_VORTICITY_POISSON == technique ) || ( VortonSim::VELOCITY_FROM_VORTICITY_P3M == technique ) ;
+}
+
+/** Largest number of vorton-gridpoint interactions for which VELOCITY_FROM_VORTICITY_AUTO tries direct summation.
+
+    Direct summation costs one interaction per vorton per gridpoint.  Beyond
+    this many (for example 4096 vortons on a 32x32x32 grid), it cannot
+    compete with the other techniques, and one trial frame would stall.
+*/
+static const double sAutoTuneMaxDirectInteractions = double( 1 << 27 ) ;
+
+/// Number of gridpoints at which VELOCITY_FROM_VORTICITY_AUTO compares each candidate against direct summation.
+static const size_t sAutoTuneNumErrorSamples = 64 ;
+
+/** Core radius of each vorton as the Poisson mesh represents it, in units of the cube root of velocity grid cell volume.
+
+    PopulateVorticityGridFromVortons spreads each vorton trilinearly across
+    the 8 gridpoints around it, and the Poisson solve and ComputeCurl use
+    finite differences across neighboring gridpoints, so the mesh blurs
+    each vorton across a blob about this wide.  VELOCITY_FROM_VORTICITY_P3M
+    replaces the velocity of that blob with the velocity of the actual
+    vorton, within this radius.  Larger values correct more of the mesh
+    error but cost more direct interactions, which grow as the cube of
+    this.
+*/
+static const float sNearFieldMeshCoreScale = 1.5f ;
+
+/// Number of interpolated boundary gridpoints at which ComputeBoundaryVectorPotential_Interpolated measures error.
+static const size_t sBoundaryInterpolationNumErrorSamples = 32 ;
+
+/// Largest spacing, in gridpoints, between boundary gridpoints ComputeBoundaryVectorPotential_Interpolated evaluates.
+static const unsigned sBoundaryInterpolationMaxStride = 16 ;
+
 
 
 
@@ -372,9 +277,23 @@ float VortonSim::Integrals::ComputeMaxRelativeDifference( const Integrals & that
 /** Construct a vorton simulation
 */
 VortonSim::VortonSim( float viscosity , float ambientFluidDensity )
-    : mSpreadingRangeFactor( 1.0f )
+#if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+    : mFarFieldTolerance( 0.05f )
+    , mPoissonSolver( POISSON_SOLVER_MULTI_GRID )
+#else
+    : mPoissonSolver( POISSON_SOLVER_MULTI_GRID )
+#endif
+    , mMaxPoissonIterations( 0 )
+    , mBoundaryInterpolationTolerance( 0.0f )
+    , mBoundaryInterpolationStride( 4 )
+    , mBoundaryInterpolationError( 0.0f )
+    , mSpreadingRangeFactor( 1.0f )
     , mSpreadingCirculationFactor( 1.0f / Pow3( mSpreadingRangeFactor ) )
     , mPopulateSdfFromDensity( false )
+    , mDensityGridStamp( 0 )
+    , mDensityGradientGridStamp( 0 )
+    , mSignedDistanceGridStamp( 0 )
+    , mGridPointsPerVorton( 1.0f )
     , mMinCorner( FLT_MAX , FLT_MAX , FLT_MAX )
     , mMaxCorner( - mMinCorner )
     , mMinCornerEternal( FLT_MAX , FLT_MAX , FLT_MAX )
@@ -393,9 +312,43 @@ VortonSim::VortonSim( float viscosity , float ambientFluidDensity )
 #else
     , mFluidSimTechnique( FLUID_SIM_VORTEX_PARTICLE_METHOD )
 #endif
-    //, mVelFromVortTechnique( VELOCITY_FROM_VORTICITY_TREE )
+    , mBiotSavartKernel( FluidKernels::GetTable() != NULL ? BIOT_SAVART_KERNEL_ISPC : BIOT_SAVART_KERNEL_SIMD )
+    , mNumTreecodeErrorSamples( 0 )
+    , mVelocityGridError( 0.0f )
+    , mVelocityEvaluator( 0 )
+    , mVelFromVortTechnique( sDefaultVelFromVortTechnique )
+    , mVelFromVortTechniqueInEffect( sDefaultVelFromVortTechnique )
+    , mVelocityErrorTarget( 0.05f )
     , mTallyDiagnosticIntegrals( false )
     , mInvestigationTerm( INVESTIGATE_ALL )
+#if ENABLE_VORTON_LOD
+    , mVortonBudget( 0 )
+    , mVelocityStageDurationTarget( 0.0f )
+    , mLodFocus( 0.0f , 0.0f , 0.0f )
+    , mLodDetailRadius( 0.0f )
+    , mNumVortonsMerged( 0 )
+#endif
+#if ENABLE_VORTON_REMESHING
+    , mRemeshPeriod( 0 )
+    , mNumUpdatesSinceRemesh( 0 )
+    , mRemeshVorticityThreshold( 0.01f )
+#endif
+#if ENABLE_VORTON_SIM_SLEEP
+    , mSleepVorticityThreshold( 0.0f )
+    , mSleepSpeedThreshold( 0.0f )
+    , mNumQuiescentUpdatesBeforeSleep( 30 )
+    , mNumQuiescentUpdates( 0 )
+    , mNumVortonsAsleep( 0 )
+    , mIsAsleep( false )
+#endif
+#if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+    , mMaxVelocityPatches( 64 )
+    , mVelocityPatchRefinement( 2 )
+    , mVelocityPatchVorticityFraction( 0.5f )
+#endif
+#if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+    , mGridDiffusionThreshold( 0.25f )
+#endif
 
     , mVortons( 0 )
 
@@ -416,6 +369,8 @@ VortonSim::VortonSim( float viscosity , float ambientFluidDensity )
 {
     PERF_BLOCK( VortonSim__VortonSim ) ;
 
+    memset( mUpdateStageDurations , 0 , sizeof( mUpdateStageDurations ) ) ;
+
 #if defined( _DEBUG ) && 0
     void OutputVelocityProfile( float ) ;
     OutputVelocityProfile( 0.5f ) ;
@@ -429,7 +384,7 @@ VortonSim::VortonSim( float viscosity , float ambientFluidDensity )
 
 
 #if PRESERVE_VORTON_COUNT
-/// Compare two vortons by the magnitude of their vorticity, for use with std::sort.
+/// Compare two vortons by the magnitude of their vorticity, for use with std::nth_element.
 static bool VortonComparisonPredicate( const Vorton & v1 , const Vorton & v2 )
 {
     return v1.GetVorticity().Mag2() > v2.GetVorticity().Mag2() ;
@@ -510,8 +465,9 @@ FAIL() ; // This routine has untested changes: mVortonRadius is no longer used.
 #if PRESERVE_VORTON_COUNT
     if( mVortons->size() > numVortonsOrig )
     {   // New vorton arrangement has too many vortons.
-        // Sort vortons by their magnitude.
-        std::sort( mVortons->begin() , mVortons->end() , VortonComparisonPredicate ) ;
+        // Partition vortons so the numVortonsOrig strongest come first, in no particular order.
+        // That is all this needs, and std::nth_element takes O(N) time on average, whereas std::sort takes O(N log N).
+        std::nth_element( mVortons->begin() , mVortons->begin() + numVortonsOrig , mVortons->end() , VortonComparisonPredicate ) ;
 
     #if 1
         // Tally total circulation from vortons about to be omitted.
@@ -539,13 +495,6 @@ FAIL() ; // This routine has untested changes: mVortonRadius is no longer used.
     #endif
 
         // Keep the first N.
-        // Note that std::sort is O(N log N).
-        // To reduce time complexity, we could instead compute the mean & stddev of mVortons
-        // and omit vortons below threshold (an O(N) operation).
-        // The threshold could be computed as a factor * stddev, where factor could drift
-        // from frame to frame using a control algorithm like MIAD.
-        // Repeat (k times) until num vortons is what it was before, an O(k N) algorithm
-        // where k would be, on average, ~1.
         VECTOR< Vorton >::iterator nth = mVortons->begin() + numVortonsOrig ;
         mVortons->erase( nth , mVortons->end() ) ;
     }
@@ -556,6 +505,220 @@ FAIL() ; // This routine has untested changes: mVortonRadius is no longer used.
 
 
 
+/** Raw sums from which to compute statistics of one scalar property of vortons.
+
+    Each thread tallies its own subset of vortons, then partial tallies
+    combine into a total, as parallel_reduce requires.
+*/
+struct VortonPropertyTally
+{
+    VortonPropertyTally() : mSum( 0.0f ) , mSum2( 0.0f ) , mMin( FLT_MAX ) , mMax( -FLT_MAX ) , mCount( 0 ) {}
+
+    /// Include the given sample in this tally.
+    void Accumulate( float value )
+    {
+        mSum  += value ;
+        mSum2 += value * value ;
+        mMin   = Min2( mMin , value ) ;
+        mMax   = Max2( mMax , value ) ;
+        ++ mCount ;
+    }
+
+    /// Include another tally, e.g. from another thread, in this tally.
+    void Merge( const VortonPropertyTally & that )
+    {
+        mSum   += that.mSum ;
+        mSum2  += that.mSum2 ;
+        mMin    = Min2( mMin , that.mMin ) ;
+        mMax    = Max2( mMax , that.mMax ) ;
+        mCount += that.mCount ;
+    }
+
+    /// Compute statistics from this tally.
+    void Cook( VortonSim::StatsFloat & stats ) const
+    {
+        if( mCount != 0 )
+        {   // Samples were tallied.
+            stats.mMean         = mSum  / float( mCount ) ;
+            const float mean2   = mSum2 / float( mCount ) ;
+            stats.mStdDev       = fsqrtf( Max2( mean2 - Pow2( stats.mMean ) , 0.0f ) ) ; // Roundoff can make variance slightly negative.
+            stats.mMin          = mMin ;
+            stats.mMax          = mMax ;
+        }
+        else
+        {
+            stats.mMean = stats.mStdDev = stats.mMin = stats.mMax = 0.0f ;
+        }
+    }
+
+    float   mSum    ;   ///< Sum of samples.
+    float   mSum2   ;   ///< Sum of squared samples.
+    float   mMin    ;   ///< Smallest sample.
+    float   mMax    ;   ///< Largest sample.
+    size_t  mCount  ;   ///< Number of samples.
+} ;
+
+
+
+
+/** Raw sums from which to compute VortonSim::VortonStatistics, in a single pass over vortons.
+*/
+struct VortonStatisticsTally
+{
+    explicit VortonStatisticsTally( bool integralsOnly )
+        : mIntegralsOnly( integralsOnly )
+        , mVorticityWeightedPosition( 0.0f , 0.0f , 0.0f )
+        , mVelocityWeightedPosition( 0.0f , 0.0f , 0.0f )
+        , mCirculation( 0.0f , 0.0f , 0.0f )
+        , mLinearImpulseFromVorticity( 0.0f , 0.0f , 0.0f )
+        , mAngularImpulse( 0.0f , 0.0f , 0.0f )
+    {}
+
+    /// Include another tally, e.g. from another thread, in this tally.
+    void Merge( const VortonStatisticsTally & that )
+    {
+        mVorticity.Merge( that.mVorticity ) ;
+        mVelocity.Merge( that.mVelocity ) ;
+        mTemperature.Merge( that.mTemperature ) ;
+        mDensity.Merge( that.mDensity ) ;
+        mDensitySph.Merge( that.mDensitySph ) ;
+        mNumberDensitySph.Merge( that.mNumberDensitySph ) ;
+        mDensityGradient.Merge( that.mDensityGradient ) ;
+        mProximity.Merge( that.mProximity ) ;
+        mVorticityWeightedPosition  += that.mVorticityWeightedPosition ;
+        mVelocityWeightedPosition   += that.mVelocityWeightedPosition ;
+        mCirculation                += that.mCirculation ;
+        mLinearImpulseFromVorticity += that.mLinearImpulseFromVorticity ;
+        mAngularImpulse             += that.mAngularImpulse ;
+    }
+
+    bool                mIntegralsOnly              ;   ///< Whether to tally only integrals, as TallyDiagnosticIntegrals needs, and skip property statistics.
+    VortonPropertyTally mVorticity                  ;   ///< Tally of vorticity magnitude.
+    VortonPropertyTally mVelocity                   ;   ///< Tally of velocity magnitude.
+    VortonPropertyTally mTemperature                ;   ///< Tally of temperature.
+    VortonPropertyTally mDensity                    ;   ///< Tally of density.
+    VortonPropertyTally mDensitySph                 ;   ///< Tally of SPH mass density.
+    VortonPropertyTally mNumberDensitySph           ;   ///< Tally of SPH number density.
+    VortonPropertyTally mDensityGradient            ;   ///< Tally of SPH density gradient magnitude.
+    VortonPropertyTally mProximity                  ;   ///< Tally of proximity to body walls.
+    Vec3                mVorticityWeightedPosition  ;   ///< Sum of vorton positions weighted by vorticity magnitude.
+    Vec3                mVelocityWeightedPosition   ;   ///< Sum of vorton positions weighted by velocity magnitude.
+    Vec3                mCirculation                ;   ///< Sum of vorticity times radius cubed.
+    Vec3                mLinearImpulseFromVorticity ;   ///< Sum of position cross vorticity times radius cubed.
+    Vec3                mAngularImpulse             ;   ///< Sum of squared position times vorticity times radius cubed.
+} ;
+
+
+
+
+/** Tally statistics of a subset of vortons and their per-vorton SPH and proximity properties.
+
+    \param vortons          Vortons whose properties to tally.
+
+    \param fluidDensities   SPH densities at each vorton.  Can be shorter than vortons, or empty.
+
+    \param densityGradients SPH density gradient at each vorton.  Can be shorter than vortons, or empty.
+
+    \param proximities      Proximity of each vorton to body walls.  Can be shorter than vortons, or empty.
+
+    \param iBegin   Index of first element to tally.
+
+    \param iEnd     Index one past last element to tally.  Can exceed number of vortons, if some other array is longer.
+
+    \param tally    (in/out) Tally to accumulate into.
+
+    One pass reads each vorton once for every property, which costs about as
+    much as the cheapest of the separate Gather...Stats passes it replaces.
+*/
+static void TallyVortonStatisticsSlice( const VECTOR< Vorton > & vortons , const VECTOR< SphFluidDensities > & fluidDensities , const VECTOR< Vec3 > & densityGradients , const VECTOR< float > & proximities , size_t iBegin , size_t iEnd , VortonStatisticsTally & tally )
+{
+    const size_t numVortons         = vortons.Size() ;
+    const size_t iEndVortons        = Min2( iEnd , numVortons ) ;
+    for( size_t iVorton = iBegin ; iVorton < iEndVortons ; ++ iVorton )
+    {   // For each vorton in this slice...
+        const Vorton &  rVorton     = vortons[ iVorton ] ;
+        const Vec3      vorticity   = rVorton.GetVorticity() ;
+        const float     radiusCubed = Pow3( rVorton.GetRadius() ) ;
+        tally.mCirculation                  += vorticity * radiusCubed ;
+        tally.mLinearImpulseFromVorticity   += rVorton.mPosition ^ vorticity * radiusCubed ;
+        tally.mAngularImpulse               += POW2( rVorton.mPosition ) * vorticity * radiusCubed ;
+        if( ! tally.mIntegralsOnly )
+        {   // Caller wants property statistics.
+            const float vortMag = vorticity.Magnitude() ;
+            const float velMag  = rVorton.mVelocity.Magnitude() ;
+            tally.mVorticity.Accumulate( vortMag ) ;
+            tally.mVelocity.Accumulate( velMag ) ;
+            tally.mTemperature.Accumulate( rVorton.GetTemperature( 1.0f ) ) ;
+            tally.mDensity.Accumulate( rVorton.GetDensity() ) ;
+            tally.mVorticityWeightedPosition    += vortMag * rVorton.mPosition ;
+            tally.mVelocityWeightedPosition     += velMag  * rVorton.mPosition ;
+        }
+    }
+
+    if( tally.mIntegralsOnly )
+    {   // Caller wants only integrals.
+        return ;
+    }
+
+    const size_t iEndDensities = Min2( iEnd , fluidDensities.Size() ) ;
+    for( size_t iPcl = iBegin ; iPcl < iEndDensities ; ++ iPcl )
+    {   // For each SPH density sample in this slice...
+        tally.mDensitySph.Accumulate( fluidDensities[ iPcl ].mMassDensity ) ;
+        tally.mNumberDensitySph.Accumulate( fluidDensities[ iPcl ].mNumberDensity ) ;
+    }
+    const size_t iEndGradients = Min2( iEnd , densityGradients.Size() ) ;
+    for( size_t iPcl = iBegin ; iPcl < iEndGradients ; ++ iPcl )
+    {   // For each SPH density gradient sample in this slice...
+        tally.mDensityGradient.Accumulate( densityGradients[ iPcl ].Magnitude() ) ;
+    }
+    const size_t iEndProximities = Min2( iEnd , proximities.Size() ) ;
+    for( size_t iPcl = iBegin ; iPcl < iEndProximities ; ++ iPcl )
+    {   // For each proximity sample in this slice...
+        tally.mProximity.Accumulate( proximities[ iPcl ] ) ;
+    }
+}
+
+
+
+
+/** Sum velocities at gridpoints of the given slice of a velocity grid.
+
+    \param velocityGrid Grid of velocity.
+
+    \param izBegin  Index of first z layer to sum.
+
+    \param izEnd    Index one past last z layer to sum.
+
+    \param sum      (in/out) Sum to accumulate into.
+*/
+static void SumVelocityGridSlice( const UniformGrid< Vec3 > & velocityGrid , size_t izBegin , size_t izEnd , Vec3 & sum )
+{
+    const size_t    numXY       = velocityGrid.GetNumPoints( 0 ) * velocityGrid.GetNumPoints( 1 ) ;
+    const size_t    offsetEnd   = izEnd * numXY ;
+    for( size_t offset = izBegin * numXY ; offset < offsetEnd ; ++ offset )
+    {   // For each gridpoint in this slice...
+        sum += velocityGrid[ offset ] ;
+    }
+}
+
+
+
+
+/** Tally statistics of all vortons, using multiple threads when available.
+
+    \param tally    (in/out) Tally to accumulate into.  Its mIntegralsOnly selects what to tally.
+*/
+static void TallyVortonStatistics( const VECTOR< Vorton > & vortons , const VECTOR< SphFluidDensities > & fluidDensities , const VECTOR< Vec3 > & densityGradients , const VECTOR< float > & proximities , VortonStatisticsTally & tally )
+{
+    const size_t numElements = tally.mIntegralsOnly ? vortons.Size() : Max2( Max2( vortons.Size() , fluidDensities.Size() ) , Max2( densityGradients.Size() , proximities.Size() ) ) ;
+    // Estimate grain size based on size of problem and, unless PARALLEL_DETERMINISTIC, number of processors.
+    const size_t grainSize = Parallel::GetReductionGrainSize( numElements ) ;
+    Parallel::Reduce( 0 , numElements , grainSize , Parallel::Reduction< Parallel::MergeResults >( tally , VortonStatisticsTally( tally.mIntegralsOnly ) , TallyVortonStatisticsSlice , vortons , fluidDensities , densityGradients , proximities ) ) ;
+}
+
+
+
+
 /** Assign vortons from a uniform grid of vorticity.
 
     \param linearImpulse - Volume integral of velocity.
@@ -566,28 +729,12 @@ void VortonSim::TallyLinearImpulseFromVelocity( Vec3 & linearImpulse ) const
 {
     PERF_BLOCK( VortonSim__TallyLinearImpulseFromVelocity ) ;
 
-    // Zero accumulator.
+    const UniformGrid< Vec3 > & ug      = GetVelocityGrid() ;
+    const size_t                numZ    = ug.GetNumPoints( 2 ) ;
+    // Estimate grain size based on size of problem and, unless PARALLEL_DETERMINISTIC, number of processors.
+    const size_t grainSize = Parallel::GetReductionGrainSize( numZ ) ;
     linearImpulse = Vec3( 0.0f , 0.0f , 0.0f ) ;
-
-    const UniformGridGeometry & ug  = GetVelocityGrid() ;
-    const unsigned  numPoints[3]    = { ug.GetNumPoints(0) , ug.GetNumPoints(1) , ug.GetNumPoints(2) } ;
-    const unsigned  numXY           = numPoints[0] * numPoints[1] ;
-
-    unsigned idx[3] ;
-    for( idx[2] = 0 ; idx[2] < numPoints[2] ; ++ idx[2] )
-    {
-        const unsigned offsetZ = idx[2] * numXY ;
-        for( idx[1] = 0 ; idx[1] < numPoints[1] ; ++ idx[1] )
-        {
-            const unsigned offsetYZ = idx[1] * numPoints[0] + offsetZ ;
-            for( idx[0] = 0 ; idx[0] < numPoints[0] ; ++ idx[0] )
-            {
-                const unsigned offsetXYZ = idx[0] + offsetYZ ;
-                const Vec3 & velocity = GetVelocityGrid()[ offsetXYZ ] ;
-                linearImpulse += velocity ;
-            }
-        }
-    }
+    Parallel::Reduce( 0 , numZ , grainSize , Parallel::Reduction< Parallel::AddResults >( linearImpulse , Vec3( 0.0f , 0.0f , 0.0f ) , SumVelocityGridSlice , ug ) ) ;
     // Apply various factors.
     // GetVolume : The tally code above should multiply velocity by the cell volume.
     // Since cell volume is uniform, we simply apply it here.
@@ -629,28 +776,18 @@ void    VortonSim::TallyDiagnosticIntegrals( Vec3 & vCirculation , Vec3 & vLinea
 
 #if defined( _DEBUG )
     const float vortonRadius = (*mVortons)[ 0 ].GetRadius() ;
+    for( size_t iVorton = 0 ; iVorton < mVortons->Size() ; ++ iVorton )
+    {
+        ASSERT( vortonRadius == (*mVortons)[ iVorton ].GetRadius() ) ; // This is assumed elsewhere. Might as well check it here.
+    }
 #endif
 
-    // Zero accumulators.
-    vCirculation
-        = vLinearImpulseFromVorticity
-        = vLinearImpulseFromVelocity
-        = vAngularImpulse
-        = Vec3( 0.0f , 0.0f , 0.0f ) ;
+    VortonStatisticsTally tally( /* integralsOnly */ true ) ;
+    TallyVortonStatistics( * mVortons , mFluidDensitiesAtPcls , mDensityGradientsAtPcls , mVortonBodyProximities , tally ) ;
+    vCirculation                = tally.mCirculation ;
+    vLinearImpulseFromVorticity = tally.mLinearImpulseFromVorticity ;
+    vAngularImpulse             = tally.mAngularImpulse ;
 
-    const size_t numVortons = mVortons->Size() ;
-    for( unsigned iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
-    {   // For each vorton in this simulation...
-        Vorton &        rVorton     = (*mVortons)[ iVorton ] ;
-        const float     radiusCubed = Pow3( rVorton.GetRadius() ) ;
-        ASSERT( vortonRadius == rVorton.GetRadius() ) ; // This is assumed elsewhere. Might as well check it here.
-        // Accumulate total circulation.
-        vCirculation    += rVorton.GetVorticity() * radiusCubed ;
-        // Accumulate total linear impulse.
-        vLinearImpulseFromVorticity  += rVorton.mPosition ^ rVorton.GetVorticity() * radiusCubed ;
-        // Accumulate total angular impulse.
-        vAngularImpulse  += POW2( rVorton.mPosition ) * rVorton.GetVorticity() * radiusCubed ;
-    }
     // Apply various factors.
     // (4 pi / 3) : The tally code above applies r^3 but should be volume.  For sphere, V=4*pi*r^3/3
     // 0.5 and -0.5 are from the derivations of impulse.  See textbooks.
@@ -888,6 +1025,142 @@ void VortonSim::GatherProximityStats( float & min , float & max , float & mean ,
 
 
 
+/** Compute statistics of every vorton property, and diagnostic integrals, at once.
+
+    \param stats   (out) Statistics.
+
+    This makes one pass over vortons, using multiple threads when available,
+    so costs about as much as one of the Gather...Stats routines, each of which
+    makes its own serial pass.  Use this when displaying many statistics.
+*/
+void VortonSim::GatherStatistics( VortonStatistics & stats ) const
+{
+    PERF_BLOCK( VortonSim__GatherStatistics ) ;
+
+    VortonStatisticsTally tally( /* integralsOnly */ false ) ;
+    TallyVortonStatistics( * mVortons , mFluidDensitiesAtPcls , mDensityGradientsAtPcls , mVortonBodyProximities , tally ) ;
+
+    tally.mVorticity.Cook( stats.mVorticity ) ;
+    tally.mVelocity.Cook( stats.mVelocity ) ;
+    tally.mTemperature.Cook( stats.mTemperature ) ;
+    tally.mDensity.Cook( stats.mDensity ) ;
+    tally.mDensitySph.Cook( stats.mDensitySph ) ;
+    tally.mNumberDensitySph.Cook( stats.mNumberDensitySph ) ;
+    tally.mDensityGradient.Cook( stats.mDensityGradient ) ;
+    tally.mProximity.Cook( stats.mProximity ) ;
+    stats.mCenterOfVorticity    = tally.mVorticityWeightedPosition / Max2( tally.mVorticity.mSum , FLT_MIN ) ;
+    stats.mCenterOfVelocity     = tally.mVelocityWeightedPosition  / Max2( tally.mVelocity.mSum  , FLT_MIN ) ;
+
+    // Apply the same factors TallyDiagnosticIntegrals applies.
+    stats.mIntegrals.mTotalCirculation              = tally.mCirculation ;
+    stats.mIntegrals.mLinearImpulseFromVorticity    = tally.mLinearImpulseFromVorticity *  FourPiOver6 ;
+    stats.mIntegrals.mAngularImpulse                = tally.mAngularImpulse             * -FourPiOver6 ;
+    TallyLinearImpulseFromVelocity( stats.mIntegrals.mLinearImpulseFromVelocity ) ;
+
+    FindValueStats( mSignedDistanceGrid , stats.mSignedDistance.mMin , stats.mSignedDistance.mMax , stats.mSignedDistance.mMean , stats.mSignedDistance.mStdDev ) ;
+}
+
+
+
+
+/** Report memory that grids, trees and partitions of this simulation occupy.
+
+    \param memoryBudget    (in/out) Budget into which to report usage of
+                            MemoryBudget::SUBSYSTEM_GRIDS, SUBSYSTEM_MULTIGRIDS,
+                            SUBSYSTEM_INFLUENCE_TREE and SUBSYSTEM_VORTON_PARTITION.
+
+    Vortons belong to a particle group, so ParticleGroup::GetMemoryUsage
+    reports them instead.
+
+    This only sums capacities, so is cheap enough to call every frame.
+    Grid memory grows as the bounding box does, and grids retain memory for
+    reuse, so usage reflects the largest domain recent updates needed.
+*/
+void VortonSim::ReportMemoryUsage( MemoryBudget & memoryBudget ) const
+{
+    size_t gridBytes =  mVelGrid.GetMemoryUsage()
+                    +   mVelGridSnapshot.GetMemoryUsage()
+                    +   mVelGridPreviousSnapshot.GetMemoryUsage()
+                    +   mDensityGrid.GetMemoryUsage()
+                    +   mDensityGradientGrid.GetMemoryUsage()
+                    +   mSignedDistanceGrid.GetMemoryUsage()
+                    +   mSdfPinnedGrid.GetMemoryUsage() ;
+#if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+    gridBytes += mVelGridPatches.GetMemoryUsage() ;
+#endif
+#if VORTON_SIM_WARM_START_POISSON
+    gridBytes += mVectorPotentialPrevious.GetMemoryUsage() ;
+#endif
+#if ENABLE_FIRE
+    gridBytes += mFuelFractionGrid.GetMemoryUsage() + mFlameFractionGrid.GetMemoryUsage() + mSmokeFractionGrid.GetMemoryUsage() ;
+#endif
+#if COMPUTE_PRESSURE_GRADIENT
+    gridBytes += mPressureGradientGrid.GetMemoryUsage() ;
+#endif
+    memoryBudget.SetUsage( MemoryBudget::SUBSYSTEM_GRIDS , gridBytes ) ;
+
+    size_t multiGridBytes = mVectorPotentialMultiGrid.GetMemoryUsage() + mNegativeVorticityMultiGrid.GetMemoryUsage() + mPoissonMultiGridScratch.GetMemoryUsage() ;
+#if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+    for( int quantity = 0 ; quantity < NUM_GRID_DIFFUSION_QUANTITIES ; ++ quantity )
+    {
+        multiGridBytes += mGridDiffusionFields[ quantity ].GetMemoryUsage() + mGridDiffusionSources[ quantity ].GetMemoryUsage() + mGridDiffusionScratch[ quantity ].GetMemoryUsage() ;
+    }
+#endif
+    memoryBudget.SetUsage( MemoryBudget::SUBSYSTEM_MULTIGRIDS , multiGridBytes ) ;
+
+    size_t treeBytes = mInfluenceTree.GetMemoryUsage() + mVortonClusterAuxGrid.GetMemoryUsage() ;
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+    treeBytes += mFmmLocalExpansions.GetMemoryUsage() ;
+#endif
+    memoryBudget.SetUsage( MemoryBudget::SUBSYSTEM_INFLUENCE_TREE , treeBytes ) ;
+
+    size_t partitionBytes = mVortonIndicesGrid.GetMemoryUsage() ;
+#if ( COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS ) && ! USE_SPATIAL_HASH_FOR_SPH_NEIGHBORS
+    partitionBytes += mSphVortonIndicesGrid.GetMemoryUsage() ;
+#endif
+    memoryBudget.SetUsage( MemoryBudget::SUBSYSTEM_VORTON_PARTITION , partitionBytes ) ;
+}
+
+
+
+
+/** Release memory that grids and trees of this simulation retain for reuse beyond what their current shapes need.
+
+    Grids only grow, so after quality drops to a coarser grid, or the
+    domain shrinks, they keep memory the finer grids needed.  Call this
+    when a subsystem exceeds its memory cap, so usage follows quality.
+
+    This copies each grid that retains excess memory, so costs about as
+    much as one step of grid work when it trims, and little otherwise.
+*/
+void VortonSim::TrimMemory()
+{
+    PERF_BLOCK( VortonSim__TrimMemory ) ;
+
+    mVelGrid.TrimMemory() ;
+    mVelGridSnapshot.TrimMemory() ;
+    mVelGridPreviousSnapshot.TrimMemory() ;
+    mDensityGrid.TrimMemory() ;
+    mDensityGradientGrid.TrimMemory() ;
+    mSignedDistanceGrid.TrimMemory() ;
+    mSdfPinnedGrid.TrimMemory() ;
+#if VORTON_SIM_WARM_START_POISSON
+    mVectorPotentialPrevious.TrimMemory() ;
+#endif
+    mVectorPotentialMultiGrid.TrimMemory() ;
+    mPoissonMultiGridScratch.TrimMemory() ;
+    mNegativeVorticityMultiGrid.TrimMemory() ;
+    mInfluenceTree.TrimMemory() ;
+    mVortonClusterAuxGrid.TrimMemory() ;
+    mVortonIndicesGrid.TrimMemory() ;
+#if ( COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS ) && ! USE_SPATIAL_HASH_FOR_SPH_NEIGHBORS
+    mSphVortonIndicesGrid.TrimMemory() ;
+#endif
+}
+
+
+
+
 #if 0 && defined( _DEBUG )
 static void TestBiotSavart()
 {
@@ -935,7 +1208,7 @@ void VortonSim::Initialize( bool systemTracksFluidSurfaceUsingSdf )
     PERF_BLOCK( VortonSim__Initialize ) ;
 
 #if USE_TBB
-    gNumberOfProcessors = GetNumberOfProcessors() ;
+    gNumberOfProcessors = Parallel::GetNumThreads() ; // Grain sizes divide work among the threads the executor actually uses.
     #if PROFILE
         printf( "# CPU's: %u.  Built " __DATE__ " " __TIME__ "\n" , gNumberOfProcessors ) ;
     #endif
@@ -972,7 +1245,7 @@ void VortonSim::Initialize( bool systemTracksFluidSurfaceUsingSdf )
         const Vec3 nudge( margin * Vec3( 1.0f , 1.0f , 1.0f ) ) ;
         mMinCorner -= nudge ;
         mMaxCorner += nudge ;
-        mGridTemplate.DefineShape( mVortons->Size() , mMinCorner , mMaxCorner , true ) ;
+        mGridTemplate.DefineShape( Max2( size_t( float( mVortons->Size() ) * mGridPointsPerVorton ) , size_t( 1 ) ) , mMinCorner , mMaxCorner , true ) ;
     }
 
     // Compute initial density grid.
@@ -984,6 +1257,7 @@ void VortonSim::Initialize( bool systemTracksFluidSurfaceUsingSdf )
         // Compute initial signed distance field.
         // This low-res version is only used to initialize tracers and then subsequently not assigned from vortons.
         PopulateSignedDistanceGridFromDensityGrid( mSignedDistanceGrid , mDensityGrid , 0 ) ;
+        mSignedDistanceGridStamp = mDensityGridStamp ;
     }
 
 #if 0 && defined( _DEBUG )
@@ -1086,7 +1360,7 @@ void VortonSim::UpdateBoundingBox( const Vec3 & minCorner , const Vec3 & maxCorn
             mMaxCornerEternal.y = Max2( mMaxCorner.y , mMaxCornerEternal.y ) ;
             mMaxCornerEternal.z = Max2( mMaxCorner.z , mMaxCornerEternal.z ) ;
 
-            mGridTemplate.DefineShape( mVortons->Size() , mMinCorner , mMaxCorner , true ) ;
+            mGridTemplate.DefineShape( Max2( size_t( float( mVortons->Size() ) * mGridPointsPerVorton ) , size_t( 1 ) ) , mMinCorner , mMaxCorner , true ) ;
         }
         else
         {   // No vortons; define empty, zero-size grid.
@@ -1145,16 +1419,49 @@ Vec3 VortonSim::ComputeVelocity_Direct( const Vec3 & vPosition )
 {
     PERF_BLOCK( VortonSim__ComputeVelocity_Direct ) ;
 
-    const size_t    numVortons          = mVortons->Size() ;
-    Vec3            velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;
+    // Sum contributions in float within each chunk of vortons, then combine chunk sums using VortonVelocitySum.
+    static const size_t sChunkSize = 64 ;
 
-    for( unsigned iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
-    {   // For each vorton...
-        const Vorton &  rVorton = (*mVortons)[ iVorton ] ;
-        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVorton ) ;
+    const size_t        numVortons          = mVortons->Size() ;
+    VortonVelocitySum   velocitySum ;
+
+#if USE_VORTON_SOA
+    ASSERT( mVortonSoa.Size() == numVortons ) ; // ComputeVelocityFromVorticity_Integral must have gathered vortons.
+    if( BIOT_SAVART_KERNEL_SCALAR != mBiotSavartKernel )
+    {
+        for( size_t iChunkStart = 0 ; iChunkStart < numVortons ; iChunkStart += sChunkSize )
+        {   // For each chunk of vortons...
+            const size_t    numInChunk      = Min2( sChunkSize , numVortons - iChunkStart ) ;
+            Vec3            chunkVelocity   ( 0.0f , 0.0f , 0.0f ) ;
+            VortonAccumulateVelocity_SimdArray( chunkVelocity , vPosition
+                                              , mVortonSoa.mPositionX.Data()  + iChunkStart , mVortonSoa.mPositionY.Data()  + iChunkStart , mVortonSoa.mPositionZ.Data()  + iChunkStart
+                                              , mVortonSoa.mVorticityX.Data() + iChunkStart , mVortonSoa.mVorticityY.Data() + iChunkStart , mVortonSoa.mVorticityZ.Data() + iChunkStart
+                                              , mVortonSoa.mSize.Data() + iChunkStart , numInChunk
+                                              , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+            velocitySum.Add( chunkVelocity ) ;
+        }
+        return velocitySum.GetSum() ;
+    }
+#endif
+    for( size_t iChunkStart = 0 ; iChunkStart < numVortons ; iChunkStart += sChunkSize )
+    {   // For each chunk of vortons...
+        const size_t    iChunkEnd       = Min2( iChunkStart + sChunkSize , numVortons ) ;
+        Vec3            chunkVelocity   ( 0.0f , 0.0f , 0.0f ) ;
+        for( size_t iVorton = iChunkStart ; iVorton < iChunkEnd ; ++ iVorton )
+        {   // For each vorton in this chunk...
+        #if USE_VORTON_SOA
+            const Vec3 vortonPosition( mVortonSoa.GetPosition( iVorton ) ) ;
+            const Vec3 vortonAngVel( mVortonSoa.GetAngularVelocity( iVorton ) ) ;
+            VORTON_ACCUMULATE_VELOCITY_private( chunkVelocity , vPosition , vortonPosition , vortonAngVel , mVortonSoa.mSize[ iVorton ] , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+        #else
+            const Vorton &  rVorton = (*mVortons)[ iVorton ] ;
+            VORTON_ACCUMULATE_VELOCITY( chunkVelocity , vPosition , rVorton ) ;
+        #endif
+        }
+        velocitySum.Add( chunkVelocity ) ;
     }
 
-    return velocityAccumulator ;
+    return velocitySum.GetSum() ;
 }
 
 
@@ -1195,12 +1502,13 @@ void VortonSim::MakeBaseVortonGrid( NestedGrid< Vorton > & influenceTree )
 
     const size_t numVortons = mVortons->Size() ;
 
-    UniformGrid< VortonClusterAux > ugAux( influenceTree[0] ) ; // Temporary auxilliary information used during aggregation.
+    UniformGrid< VortonClusterAux > & ugAux = mVortonClusterAuxGrid ; // Temporary auxilliary information used during aggregation.
+    ugAux.CopyShape( influenceTree[0] ) ;
     ugAux.Init() ;
 
     DEBUG_ONLY( unsigned    numVortonsIncorporated = 0 ) ;
 
-#if ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_DIRECT )
+#if ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_DIRECT ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM )
     UniformGrid<Vorton> & baseGrid = influenceTree[0] ;
 #else
     #error Velocity technique is invalid or undefined.  Assign VELOCITY_TECHNIQUE in vorton.h or change this code.
@@ -1571,26 +1879,222 @@ void VortonSim::AggregateClusters( unsigned uParentLayer , NestedGrid< Vorton >
 
 
 
-/** Create nested grid vorticity influence tree.
+#if VORTON_SIM_REFIT_INFLUENCE_TREE
 
-    Each layer of this tree represents a simplified, aggregated version of
-    all of the information in its "child" layer, where each
-    "child" has higher resolution than its "parent".
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
+    #error VORTON_SIM_REFIT_INFLUENCE_TREE does not maintain sibling information that VELOCITY_TECHNIQUE_MONOPOLES requires.
+#endif
 
-    \see MakeBaseVortonGrid, AggregateClusters
+/** Record which cells of each layer of the given influence tree contain vortons.
 
-    Derivation:
+    A cell contains vortons if and only if its size is nonzero, since
+    MakeBaseVortonGrid and AggregateClusters assign size only to those cells.
 
-    Using conservation properties, I_0 = I_0' , I_1 = I_1' , I_2 = I_2'
+    \see RefitInfluenceTree
 
-    I_0 : wx d = w1x d1 + w2x d2
-        : wy d = w1y d1 + w2y d2
-        : wz d = w1z d1 + w2z d2
+*/
+void VortonSim::RecordInfluenceTreeOccupancy( const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__RecordInfluenceTreeOccupancy ) ;
 
-        These 3 are not linearly independent:
-    I_1 : ( y wz - z wy ) d = ( y1 wz1 - z1 wy1 ) d1 + ( y2 wz2 - z2 wy2 ) d2
-        : ( z wx - x wz ) d = ( z1 wx1 - x1 wz1 ) d1 + ( z2 wx2 - x2 wz2 ) d2
-        : ( x wy - y wx ) d = ( x1 wy1 - y1 wx1 ) d1 + ( x2 wy2 - y2 wx2 ) d2
+    const size_t numLayers = influenceTree.GetDepth() ;
+    mInfluenceTreeOccupiedCells.Resize( numLayers ) ;
+    for( size_t iLayer = 0 ; iLayer < numLayers ; ++ iLayer )
+    {
+        const UniformGrid< Vorton > &   layer       = influenceTree[ iLayer ] ;
+        VECTOR< unsigned > &            occupied    = mInfluenceTreeOccupiedCells[ iLayer ] ;
+        const unsigned                  numCells    = layer.GetGridCapacity() ;
+        occupied.Clear() ;
+        for( unsigned offset = 0 ; offset < numCells ; ++ offset )
+        {
+            if( layer[ offset ].mSize != 0.0f )
+            {
+                occupied.PushBack( offset ) ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Update influence tree from its contents during the previous update.
+
+    This computes the same result as MakeBaseVortonGrid followed by
+    AggregateClusters on each layer, but visits only cells that contain
+    vortons now or did during the previous update.
+
+    First this empties cells that mInfluenceTreeOccupiedCells says contained
+    vortons.  That leaves every cell empty.  Then it aggregates vortons into
+    leaf cells, noting each cell the first time a vorton lands in it.  Then, for
+    each parent layer, it aggregates only those parents whose cluster contains an
+    occupied child, noting those parents likewise.
+
+    \note This assumes the influence tree has the same layout as during the
+            previous update, and that mInfluenceTreeOccupiedCells describes it.
+            See NestedGrid::Refit.
+
+    \see CreateInfluenceTree, RecordInfluenceTreeOccupancy
+
+*/
+void VortonSim::RefitInfluenceTree( NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__RefitInfluenceTree ) ;
+
+    const size_t                        numLayers   = influenceTree.GetDepth() ;
+    const size_t                        numVortons  = mVortons->Size() ;
+    UniformGrid< VortonClusterAux > &   ugAux       = mVortonClusterAuxGrid ;
+    ASSERT( mInfluenceTreeOccupiedCells.Size() == numLayers ) ;
+    ASSERT( ugAux.GetGridCapacity() == influenceTree[ 0 ].GetGridCapacity() ) ;
+    ugAux.CopyShape( influenceTree[ 0 ] ) ;
+
+    for( size_t iLayer = 0 ; iLayer < numLayers ; ++ iLayer )
+    {   // Empty cells that contained vortons.  All other cells are already empty.
+        UniformGrid< Vorton > & layer       = influenceTree[ iLayer ] ;
+        VECTOR< unsigned > &    occupied    = mInfluenceTreeOccupiedCells[ iLayer ] ;
+        const size_t            numOccupied = occupied.Size() ;
+        for( size_t iOccupied = 0 ; iOccupied < numOccupied ; ++ iOccupied )
+        {
+            layer[ occupied[ iOccupied ] ] = Vorton() ;
+            if( 0 == iLayer )
+            {
+                ugAux[ occupied[ iOccupied ] ] = VortonClusterAux() ;
+            }
+        }
+        occupied.Clear() ;
+    }
+
+    {   // Aggregate vortons into leaf layer.  (See analogous code in MakeBaseVortonGrid.)
+        PERF_BLOCK( VortonSim__RefitInfluenceTree_Leaves ) ;
+
+        UniformGrid< Vorton > & baseGrid        = influenceTree[ 0 ] ;
+        VECTOR< unsigned > &    occupiedLeaves  = mInfluenceTreeOccupiedCells[ 0 ] ;
+        for( unsigned uVorton = 0 ; uVorton < numVortons ; ++ uVorton )
+        {   // For each vorton in this simulation...
+            const Vorton &      rVorton     = (*mVortons)[ uVorton ] ;
+            ASSERT( ! IsNan( rVorton.mPosition ) && ! IsInf( rVorton.mPosition ) ) ;
+            const unsigned      uOffset     = baseGrid.OffsetOfPosition( rVorton.mPosition ) ;
+            ASSERT( uOffset < baseGrid.GetGridCapacity() ) ;
+            Vorton &            rVortonCell = baseGrid[ uOffset ] ;
+            const float         vortMag     = rVorton.GetVorticity().Magnitude() ;
+
+            if( 0.0f == rVortonCell.mSize )
+            {   // This is the first vorton in this cell.
+                occupiedLeaves.PushBack( uOffset ) ;
+            }
+            rVortonCell.mPosition        += rVorton.mPosition * vortMag ;
+            rVortonCell.mAngularVelocity += rVorton.mAngularVelocity ;
+            rVortonCell.mSize             = rVorton.mSize ;
+            DEBUG_ONLY( ++ rVortonCell.mNumVortonsIncorporated ) ;
+            DEBUG_ONLY( rVortonCell.mTotalCirculation = rVortonCell.GetVorticity() * Pow3( rVortonCell.GetRadius() ) ) ;
+            ugAux[ uOffset ].mVortNormSum += vortMag ;
+        }
+
+        const size_t numOccupiedLeaves = occupiedLeaves.Size() ;
+        for( size_t iOccupied = 0 ; iOccupied < numOccupiedLeaves ; ++ iOccupied )
+        {   // Normalize weighted position sum to obtain center-of-vorticity.
+            const unsigned              offset      = occupiedLeaves[ iOccupied ] ;
+            const VortonClusterAux &    rVortonAux  = ugAux[ offset ] ;
+            if( rVortonAux.mVortNormSum != FLT_MIN )
+            {
+                baseGrid[ offset ].mPosition /= rVortonAux.mVortNormSum ;
+            }
+        }
+    }
+
+    {   // Aggregate clusters into parent layers.  (See analogous code in AggregateClusters.)
+        PERF_BLOCK( VortonSim__RefitInfluenceTree_AggregateClusters ) ;
+
+        for( unsigned uParentLayer = 1 ; uParentLayer < numLayers ; ++ uParentLayer )
+        {   // For each parent layer in the influence tree...
+            UniformGrid< Vorton > &     rParentLayer        = influenceTree[ uParentLayer     ] ;
+            UniformGrid< Vorton > &     rChildLayer         = influenceTree[ uParentLayer - 1 ] ;
+            const VECTOR< unsigned > &  occupiedChildren    = mInfluenceTreeOccupiedCells[ uParentLayer - 1 ] ;
+            VECTOR< unsigned > &        occupiedParents     = mInfluenceTreeOccupiedCells[ uParentLayer ] ;
+            const unsigned * const      pClusterDims        = influenceTree.GetDecimations( uParentLayer ) ;
+            const unsigned              numCells[3]         = { rParentLayer.GetNumCells( 0 ) , rParentLayer.GetNumCells( 1 ) , rParentLayer.GetNumCells( 2 ) } ;
+            const unsigned &            numXchild           = rChildLayer.GetNumPoints( 0 ) ;
+            const unsigned              numXYchild          = numXchild * rChildLayer.GetNumPoints( 1 ) ;
+            const size_t                numOccupiedChildren = occupiedChildren.Size() ;
+
+            for( size_t iOccupied = 0 ; iOccupied < numOccupiedChildren ; ++ iOccupied )
+            {   // For each occupied cell in the child layer...
+                unsigned idxChild[3] ;
+                rChildLayer.IndicesFromOffset( idxChild , occupiedChildren[ iOccupied ] ) ;
+                unsigned idxParent[3] = { idxChild[0] / pClusterDims[0] , idxChild[1] / pClusterDims[1] , idxChild[2] / pClusterDims[2] } ;
+                if( ( idxParent[0] >= numCells[0] ) || ( idxParent[1] >= numCells[1] ) || ( idxParent[2] >= numCells[2] ) )
+                {   // AggregateClusters does not visit this parent either.
+                    continue ;
+                }
+                const unsigned  offsetParent    = static_cast< unsigned >( rParentLayer.OffsetFromIndices( idxParent[0] , idxParent[1] , idxParent[2] ) ) ;
+                Vorton &        rVortonParent   = rParentLayer[ offsetParent ] ;
+                if( rVortonParent.mSize != 0.0f )
+                {   // A sibling of this child already caused this parent to aggregate its cluster.
+                    continue ;
+                }
+                occupiedParents.PushBack( offsetParent ) ;
+
+                VortonClusterAux vortAux ;
+                unsigned clusterMinIndices[ 3 ] ;
+                influenceTree.GetChildClusterMinCornerIndex( clusterMinIndices , pClusterDims , idxParent ) ;
+                unsigned increment[3] ;
+                for( increment[2] = 0 ; increment[2] < pClusterDims[2] ; ++ increment[2] )
+                {
+                    const unsigned offsetZ = ( clusterMinIndices[2] + increment[2] ) * numXYchild ;
+                    for( increment[1] = 0 ; increment[1] < pClusterDims[1] ; ++ increment[1] )
+                    {
+                        const unsigned offsetYZ = ( clusterMinIndices[1] + increment[1] ) * numXchild + offsetZ ;
+                        for( increment[0] = 0 ; increment[0] < pClusterDims[0] ; ++ increment[0] )
+                        {   // For each cell of child layer in this grid cluster...
+                            const unsigned  offsetXYZ       = ( clusterMinIndices[0] + increment[0] ) + offsetYZ ;
+                            const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
+                            const float     vortMag         = rVortonChild.GetVorticity().Magnitude() ;
+
+                            rVortonParent.mPosition        += rVortonChild.mPosition * vortMag ;
+                            rVortonParent.mAngularVelocity += rVortonChild.mAngularVelocity ;
+                            DEBUG_ONLY( rVortonParent.mNumVortonsIncorporated += rVortonChild.mNumVortonsIncorporated ) ;
+                            vortAux.mVortNormSum           += vortMag ;
+                            if( rVortonChild.mSize != 0.0f )
+                            {   // Child vorton exists
+                                rVortonParent.mSize = rVortonChild.mSize ;
+                            }
+                        }
+                    }
+                }
+                DEBUG_ONLY( rVortonParent.mTotalCirculation = rVortonParent.GetVorticity() * Pow3( rVortonParent.GetRadius() ) ) ;
+
+                // Normalize weighted position sum to obtain center-of-vorticity.
+                rVortonParent.mPosition /= vortAux.mVortNormSum ;
+            }
+        }
+    }
+}
+
+#endif
+
+
+
+
+/** Create nested grid vorticity influence tree.
+
+    Each layer of this tree represents a simplified, aggregated version of
+    all of the information in its "child" layer, where each
+    "child" has higher resolution than its "parent".
+
+    \see MakeBaseVortonGrid, AggregateClusters
+
+    Derivation:
+
+    Using conservation properties, I_0 = I_0' , I_1 = I_1' , I_2 = I_2'
+
+    I_0 : wx d = w1x d1 + w2x d2
+        : wy d = w1y d1 + w2y d2
+        : wz d = w1z d1 + w2z d2
+
+        These 3 are not linearly independent:
+    I_1 : ( y wz - z wy ) d = ( y1 wz1 - z1 wy1 ) d1 + ( y2 wz2 - z2 wy2 ) d2
+        : ( z wx - x wz ) d = ( z1 wx1 - x1 wz1 ) d1 + ( z2 wx2 - x2 wz2 ) d2
+        : ( x wy - y wx ) d = ( x1 wy1 - y1 wx1 ) d1 + ( x2 wy2 - y2 wx2 ) d2
 
     I_2 : ( x^2 + y^2 + z^2 ) wx d = (x1^2 + y1^2 + z1^2 ) wx1 d1 + ( x2^2 + y2^2 + z2^2 ) wx2 d2
         : ( x^2 + y^2 + z^2 ) wy d = (x1^2 + y1^2 + z1^2 ) wy1 d1 + ( x2^2 + y2^2 + z2^2 ) wy2 d2
@@ -1609,7 +2113,20 @@ void VortonSim::CreateInfluenceTree( NestedGrid< Vorton > & influenceTree )
     ASSERT( ! mVortons->Empty() ) ;
 
     // Create skeletal nested grid for influence tree.
+#if VORTON_SIM_REFIT_INFLUENCE_TREE
+    if( influenceTree.Refit( mGridTemplate ) )
+    {   // Tree kept its layout and contents from the previous update.
+        if( mInfluenceTreeOccupiedCells.Size() == influenceTree.GetDepth() )
+        {   // Occupancy describes those contents, so update only cells whose contents changed.
+            RefitInfluenceTree( influenceTree ) ;
+            return ;
+        }
+        influenceTree.Initialize( mGridTemplate ) ;
+    }
+    // Otherwise Refit already called Initialize.
+#else
     influenceTree.Initialize( mGridTemplate ) ; // Create skeleton of influence tree.
+#endif
 
     MakeBaseVortonGrid( influenceTree ) ;
 
@@ -1621,6 +2138,10 @@ void VortonSim::CreateInfluenceTree( NestedGrid< Vorton > & influenceTree )
             AggregateClusters( uParentLayer , influenceTree ) ;
         }
     }
+
+#if VORTON_SIM_REFIT_INFLUENCE_TREE
+    RecordInfluenceTreeOccupancy( influenceTree ) ;
+#endif
 }
 
 
@@ -1633,6 +2154,78 @@ DEBUG_ONLY( static Vec3     sCirculationEncounteredInTree( 0.0f , 0.0f , 0.0f )
 
 
 
+/** Return whether the given position lies inside the given cell, enlarged by the given margin.
+
+    Treecodes always open clusters that pass this test.
+*/
+static inline bool IsInsideCellWithMargin( const Vec3 & vPosition , const Vec3 & vCellMinCorner , const Vec3 & vCellMaxCorner , const Vec3 & margin )
+{
+    return  ( vPosition.x >= vCellMinCorner.x - margin.x )
+        &&  ( vPosition.y >= vCellMinCorner.y - margin.y )
+        &&  ( vPosition.z >= vCellMinCorner.z - margin.z )
+        &&  ( vPosition.x <  vCellMaxCorner.x + margin.x )
+        &&  ( vPosition.y <  vCellMaxCorner.y + margin.y )
+        &&  ( vPosition.z <  vCellMaxCorner.z + margin.z ) ;
+}
+
+
+
+
+/** Return whether a treecode query should open the given child cluster, rather than treat it as one supervorton.
+
+    \param vPosition - point whose velocity or vector potential to evaluate
+
+    \param vCellMinCorner - minimal corner of child cell
+
+    \param vCellMaxCorner - maximal corner of child cell
+
+    \param margin - amount by which to enlarge child cell for the containment test
+
+    \param rSupervorton - supervorton that represents the child cluster.  SupervortonT
+        can be Vorton or LinearInfluenceTree::Node; this reads only mPosition,
+        mAngularVelocity and mSize.
+
+    \param criterion - rules that open clusters beyond those that contain vPosition
+
+    The error estimate treats the supervorton as a monopole at the center of
+    vorticity of its cluster, so its truncation error, relative to its
+    contribution, scales as the square of cluster size over distance.
+
+    \see VortonSim::TreeOpeningCriterion
+*/
+template< class SupervortonT > static inline bool ShouldOpenCluster( const Vec3 & vPosition , const Vec3 & vCellMinCorner , const Vec3 & vCellMaxCorner , const Vec3 & margin
+                                    , const SupervortonT & rSupervorton , const VortonSim::TreeOpeningCriterion & criterion )
+{
+    if( IsInsideCellWithMargin( vPosition , vCellMinCorner , vCellMaxCorner , margin ) )
+    {   // Query lies inside cluster, where its supervorton approximates it poorly.
+        return true ;
+    }
+    if( ( FLT_MAX == criterion.mOpeningAngle ) && ( FLT_MAX == criterion.mErrorTolerance ) )
+    {   // Only the containment test applies.
+        return false ;
+    }
+    const float angVelMag2 = rSupervorton.mAngularVelocity.Mag2() ;
+    if( 0.0f == angVelMag2 )
+    {   // Cluster has no vorticity, so opening it would gain nothing.
+        return false ;
+    }
+    const float clusterSize2    = ( vCellMaxCorner - vCellMinCorner ).Mag2() ;
+    const float dist2           = ( vPosition - rSupervorton.mPosition ).Mag2() ;
+    if( ( criterion.mOpeningAngle < FLT_MAX ) && ( clusterSize2 > criterion.mOpeningAngle * criterion.mOpeningAngle * dist2 ) )
+    {   // Cluster subtends too large an angle, as seen from query.
+        return true ;
+    }
+    if( criterion.mErrorTolerance < FLT_MAX )
+    {   // Supervorton contributes about (2/3) radius^3 |angVel| / dist^2 to velocity, with error about that times (size/dist)^2.
+        const float errorEstimateTimesDist4 = TwoThirds * Pow3( 0.5f * rSupervorton.mSize ) * sqrtf( angVelMag2 ) * clusterSize2 ;
+        return errorEstimateTimesDist4 > criterion.mErrorTolerance * dist2 * dist2 ;
+    }
+    return false ;
+}
+
+
+
+
 /** Compute vector potential at a given point in space, due to influence of vortons, using a treecode.
 
     \param vPosition - point in space whose vector potential to evaluate
@@ -1647,7 +2240,7 @@ DEBUG_ONLY( static Vec3     sCirculationEncounteredInTree( 0.0f , 0.0f , 0.0f )
             The outermost caller should pass in influenceTree.GetDepth().
 
 */
-Vec3 VortonSim::ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsigned indices[3] , size_t iLayer , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+Vec3 VortonSim::ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsigned indices[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
 {
     PERF_BLOCK( VortonSim__ComputeVectorPotential_Tree ) ;
 
@@ -1704,16 +2297,10 @@ Vec3 VortonSim::ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsi
                 idxChild[0] = clusterMinIndices[0] + increment[0] ;
                 vCellMinCorner.x = vGridMinCorner.x + float( idxChild[0]     ) * vSpacing.x ;
                 vCellMaxCorner.x = vGridMinCorner.x + float( idxChild[0] + 1 ) * vSpacing.x ;
-                if(
-                        ( iLayer > 1 )
-                    &&  ( vPosition.x >= vCellMinCorner.x - margin.x )
-                    &&  ( vPosition.y >= vCellMinCorner.y - margin.y )
-                    &&  ( vPosition.z >= vCellMinCorner.z - margin.z )
-                    &&  ( vPosition.x <  vCellMaxCorner.x + margin.x )
-                    &&  ( vPosition.y <  vCellMaxCorner.y + margin.y )
-                    &&  ( vPosition.z <  vCellMaxCorner.z + margin.z )
-                  )
-                {   // Test position is inside childCell and currentLayer > 0...
+                const unsigned  offsetXYZ       = idxChild[0] + offsetYZ ;
+                const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
+                if( ( iLayer > 1 ) && ShouldOpenCluster( vPosition , vCellMinCorner , vCellMaxCorner , margin , rVortonChild , mTreeOpeningCriterion ) )
+                {   // Test position is inside childCell (or criterion deems childCell too near) and currentLayer > 0...
                     // Recurse child layer.
                     vecPotAccumulator += ComputeVectorPotential_Tree( vPosition , idxChild , iLayer - 1 , vortonIndicesGrid , influenceTree ) ;
                 }
@@ -1721,9 +2308,6 @@ Vec3 VortonSim::ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsi
                 {   // Test position is outside childCell, or reached leaf node.
                     //    Compute velocity induced by cell at corner point x.
                     //    Accumulate influence, storing in velocityAccumulator.
-                    const unsigned  offsetXYZ       = idxChild[0] + offsetYZ ;
-                    const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
-
                 #if USE_ORIGINAL_VORTONS_IN_BASE_LAYER
                     if( 1 == iLayer )
                     {   // Reached base layer.
@@ -1784,7 +2368,7 @@ Vec3 VortonSim::ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsi
             The outermost caller should pass in influenceTree.GetDepth().
 
 */
-Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned indices[3] , size_t iLayer , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned indices[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
 {
     PERF_BLOCK( VortonSim__ComputeVelocity_Tree ) ;
 
@@ -1799,7 +2383,8 @@ Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned in
     unsigned                increment[3]            ;
     const unsigned &        numXchild               = rChildLayer.GetNumPoints( 0 ) ;
     const unsigned          numXYchild              = numXchild * rChildLayer.GetNumPoints( 1 ) ;
-    Vec3                    velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;
+    Vec3                    velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;   // Sum of contributions from clusters this level treats as single sources.
+    VortonVelocitySum       velocitySum             ;   // Sum of contributions from child subtrees, plus velocityAccumulator.
 
     ASSERT( ! mVortons->empty() ) ;
 
@@ -1821,6 +2406,10 @@ Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned in
     // When domain is 2D in XY plane, min.z==max.z so vPos.z test below would fail unless margin.z!=0.
     const Vec3          margin          = marginFactor * vSpacing + ( 0.0f == vSpacing.z ? Vec3(0,0,FLT_MIN) : Vec3(0,0,0) );
 
+    // Far-field (super)vortons visited at this level accumulate into a batch that the SIMD kernel evaluates.
+    const bool          useSimdKernel   = ( BIOT_SAVART_KERNEL_SCALAR != mBiotSavartKernel ) ;
+    VortonSourceBatch   sourceBatch( mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+
     // For each cell of child layer in this grid cluster...
     for( increment[2] = 0 ; increment[2] < pClusterDims[2] ; ++ increment[2] )
     {
@@ -1841,26 +2430,17 @@ Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned in
                 idxChild[0] = clusterMinIndices[0] + increment[0] ;
                 vCellMinCorner.x = vGridMinCorner.x + float( idxChild[0]     ) * vSpacing.x ;
                 vCellMaxCorner.x = vGridMinCorner.x + float( idxChild[0] + 1 ) * vSpacing.x ;
-                if(
-                        ( iLayer > 1 )
-                    &&  ( vPosition.x >= vCellMinCorner.x - margin.x )
-                    &&  ( vPosition.y >= vCellMinCorner.y - margin.y )
-                    &&  ( vPosition.z >= vCellMinCorner.z - margin.z )
-                    &&  ( vPosition.x <  vCellMaxCorner.x + margin.x )
-                    &&  ( vPosition.y <  vCellMaxCorner.y + margin.y )
-                    &&  ( vPosition.z <  vCellMaxCorner.z + margin.z )
-                  )
-                {   // Test position is inside childCell and currentLayer > 0...
+                const unsigned  offsetXYZ       = idxChild[0] + offsetYZ ;
+                const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
+                if( ( iLayer > 1 ) && ShouldOpenCluster( vPosition , vCellMinCorner , vCellMaxCorner , margin , rVortonChild , mTreeOpeningCriterion ) )
+                {   // Test position is inside childCell (or criterion deems childCell too near) and currentLayer > 0...
                     // Recurse child layer.
-                    velocityAccumulator += ComputeVelocity_Tree( vPosition , idxChild , iLayer - 1 , vortonIndicesGrid , influenceTree ) ;
+                    velocitySum.Add( ComputeVelocity_Tree( vPosition , idxChild , iLayer - 1 , vortonIndicesGrid , influenceTree ) ) ;
                 }
                 else
                 {   // Test position is outside childCell, or reached leaf node.
                     //    Compute velocity induced by cell at corner point x.
                     //    Accumulate influence, storing in velocityAccumulator.
-                    const unsigned  offsetXYZ       = idxChild[0] + offsetYZ ;
-                    const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
-
                 #if USE_ORIGINAL_VORTONS_IN_BASE_LAYER
                     if( 1 == iLayer )
                     {   // Reached base layer.
@@ -1873,7 +2453,14 @@ Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned in
                             const unsigned &    rVortIdxHere    = vortonIndicesGrid[ offsetXYZ ][ ivHere ] ;
                             Vorton &            rVortonHere     = (*mVortons)[ rVortIdxHere ] ;
                             ASSERT( ( rVortonHere.GetVorticity().Magnitude() < 1.e-8f ) || ( rVortonHere.GetRadius() == vortonRadius ) ) ;
-                            VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVortonHere ) ;
+                            if( useSimdKernel )
+                            {
+                                sourceBatch.Add( velocityAccumulator , vPosition , rVortonHere.mPosition , rVortonHere.mAngularVelocity , rVortonHere.mSize ) ;
+                            }
+                            else
+                            {
+                                VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVortonHere ) ;
+                            }
                             DEBUG_ONLY( vorticityEncounteredInCell += rVortonHere.GetVorticity() ) ;
                         }
                         ASSERT( numVortonsInCell == rVortonChild.mNumVortonsIncorporated ) ;
@@ -1889,7 +2476,14 @@ Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned in
                         // not a base layer, i.e. this layer is an "aggregation" layer of supervortons, ...or...
                         // this is tbe base layer and USE_ORIGINAL_VORTONS_IN_BASE_LAYER is disabled.
                         ASSERT( ( rVortonChild.GetVorticity().Magnitude() < 1.e-8f ) || ( rVortonChild.GetRadius() == vortonRadius ) ) ;
-                        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVortonChild ) ;
+                        if( useSimdKernel )
+                        {
+                            sourceBatch.Add( velocityAccumulator , vPosition , rVortonChild.mPosition , rVortonChild.mAngularVelocity , rVortonChild.mSize ) ;
+                        }
+                        else
+                        {
+                            VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVortonChild ) ;
+                        }
                         DEBUG_ONLY( sNumVortonsEncounteredInTree += rVortonChild.mNumVortonsIncorporated ) ;
                         DEBUG_ONLY( sVorticityEncounteredInTree += rVortonChild.GetVorticity() ) ;
                         DEBUG_ONLY( const Vec3 vCellCirculation( rVortonChild.GetVorticity() * Pow3( rVortonChild.GetRadius() ) ) ) ;
@@ -1901,557 +2495,1010 @@ Vec3 VortonSim::ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned in
         }
     }
 
-    return velocityAccumulator ;
-}
+    sourceBatch.Flush( velocityAccumulator , vPosition ) ;
+    velocitySum.Add( velocityAccumulator ) ;
 
+    return velocitySum.GetSum() ;
+}
 
 
 
-#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
-/** Compute velocity at a given point in space, due to influence of vortons.
 
-    \param indices - indices of grid cell of position whose velocity to evaluate
+#if VORTON_SIM_USE_LINEAR_INFLUENCE_TREE
+/** Compute velocity at a given point in space, due to influence of vortons, using a treecode over mLinearInfluenceTree.
 
     \param vPosition - point in space whose velocity to evaluate
 
+    \param iParentNode - index, into mLinearInfluenceTree, of node whose children to visit
+
+    \param iLayer - which layer iParentNode lies in
+
     \return velocity at vPosition, due to influence of vortons
 
-    \note This is a recursive algorithm with time complexity O(log(N)). 
-              The outermost caller should pass in influenceTree.GetDepth().
+    This visits the same clusters, in the same way, as ComputeVelocity_Tree,
+    except that it skips cells without vortons, and visits siblings in
+    Morton order.  It sums every sibling it does not open before it
+    descends into any it does open, and prefetches the children of each
+    node it opens as soon as it decides to, so those arrive while it sums
+    the rest.
+
+    \note The outermost caller should pass in node 0 and mLinearInfluenceTree.GetDepth() - 1.
 
+    \see ComputeVelocity_Tree, LinearInfluenceTree
 */
-Vec3 VortonSim::ComputeVelocity_Monopoles( const unsigned indices[3] , const Vec3 & vPosition , const NestedGrid< Vorton > & influenceTree )
+Vec3 VortonSim::ComputeVelocity_LinearTree( const Vec3 & vPosition , size_t iParentNode , size_t iLayer , const CellList & vortonIndicesGrid )
 {
-    PERF_BLOCK( VortonSim__ComputeVelocity_Monopoles ) ;
+    PERF_BLOCK( VortonSim__ComputeVelocity_LinearTree ) ;
 
-    Vec3        velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;
-    unsigned    indicesVisited[4] = { indices[0] , indices[1] , indices[2] , 0 } ;
+    ASSERT( iLayer > 0 ) ; // Child has index iLayer-1 so iLayer better be positive. Otherwise caller should use ComputeVelocity_Direct.
+    typedef LinearInfluenceTree::Node Node ;
+    const Node &            rParent                 = mLinearInfluenceTree[ iParentNode ] ;
+    const unsigned          numChildren             = rParent.GetNumChildren() ;
+    const Node *            children                = & mLinearInfluenceTree[ 0 ] + rParent.mFirstChild ;
+
+    const Vec3 &            vGridMinCorner          = mLinearInfluenceTree.GetMinCorner( iLayer - 1 ) ;
+    const Vec3 &            vSpacing                = mLinearInfluenceTree.GetCellSpacing( iLayer - 1 ) ;
+    Vec3                    velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;   // Sum of contributions from clusters this level treats as single sources.
+    VortonVelocitySum       velocitySum             ;   // Sum of contributions from child subtrees, plus velocityAccumulator.
+    unsigned                childrenToOpen[ LinearInfluenceTree::MAX_CHILDREN ] ;   // Children to descend into, after summing the rest.
+    unsigned                numChildrenToOpen       = 0 ;
 
-#if defined( _DEBUG )
-    {
-        unsigned    indicesTest[4] ;    // indices within base layer of query position
-        influenceTree[ 0 ].IndicesOfPosition( indicesTest , vPosition ) ;
-    }
+    ASSERT( ! mVortons->empty() ) ;
+    ASSERT( numChildren <= LinearInfluenceTree::MAX_CHILDREN ) ;
+
+#if AVOID_CENTERS || USE_ORIGINAL_VORTONS_IN_BASE_LAYER || defined( _DEBUG )
+    const float             vortonRadius = (*mVortons)[ 0 ].GetRadius() ;
+    (void) vortonRadius ;
 #endif
 
-    DEBUG_ONLY( unsigned    numVortonsEncountered = 0 ) ;
-    DEBUG_ONLY( Vec3        vVorticityEncountered( 0.0f , 0.0f , 0.0f ) ) ;
-    DEBUG_ONLY( Vec3        vCirculationEncountered( 0.0f , 0.0f , 0.0f ) ) ;
+    // Match margin of ComputeVelocity_Tree, so both open the same clusters.
+#if AVOID_CENTERS
+    static const float  marginFactor    = 2.0f * vortonRadius ;
+#else
+    static const float  marginFactor    = 0.0001f ;
+#endif
+    const Vec3          margin          = marginFactor * vSpacing + ( 0.0f == vSpacing.z ? Vec3(0,0,FLT_MIN) : Vec3(0,0,0) );
 
-    const float vortonRadius = (*mVortons)[ 0 ].GetRadius() ;
+    const bool          useSimdKernel   = ( BIOT_SAVART_KERNEL_SCALAR != mBiotSavartKernel ) ;
+    VortonSourceBatch   sourceBatch( mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+
+    for( unsigned iChild = 0 ; iChild < numChildren ; ++ iChild )
+    {   // For each occupied child cell of parent...
+        const Node &    rChild          = children[ iChild ] ;
+        bool            openChild       = false ;
+        if( iLayer > 1 )
+        {   // Child is not a leaf, so its key holds indices of its cell.
+            unsigned idxChild[ 3 ] ;
+            rChild.GetCellIndices( idxChild ) ;
+            const Vec3  vCellMinCorner( vGridMinCorner.x + float( idxChild[ 0 ] ) * vSpacing.x
+                                      , vGridMinCorner.y + float( idxChild[ 1 ] ) * vSpacing.y
+                                      , vGridMinCorner.z + float( idxChild[ 2 ] ) * vSpacing.z ) ;
+            const Vec3  vCellMaxCorner  = vCellMinCorner + vSpacing ;
+            openChild = ShouldOpenCluster( vPosition , vCellMinCorner , vCellMaxCorner , margin , rChild , mTreeOpeningCriterion ) ;
+        }
+        if( openChild )
+        {   // Test position is inside childCell (or criterion deems childCell too near) and currentLayer > 0...
+            // Descend after summing siblings, and start fetching grandchildren now.
+            mLinearInfluenceTree.PrefetchChildren( rChild ) ;
+            childrenToOpen[ numChildrenToOpen ++ ] = iChild ;
+        }
+        else
+        {   // Test position is outside childCell, or reached leaf node.
+        #if USE_ORIGINAL_VORTONS_IN_BASE_LAYER
+            if( 1 == iLayer )
+            {   // Reached base layer.  Use direct summation of original vortons in this cell.  Leaf nodes record offset of their cell in mFirstChild.
+                const unsigned & offsetXYZ          = rChild.mFirstChild ;
+                const unsigned   numVortonsInCell   = vortonIndicesGrid[ offsetXYZ ].Size() ;
+                for( unsigned ivHere = 0 ; ivHere < numVortonsInCell ; ++ ivHere )
+                {   // For each vorton in this gridcell...
+                    const unsigned &    rVortIdxHere    = vortonIndicesGrid[ offsetXYZ ][ ivHere ] ;
+                    Vorton &            rVortonHere     = (*mVortons)[ rVortIdxHere ] ;
+                    ASSERT( ( rVortonHere.GetVorticity().Magnitude() < 1.e-8f ) || ( rVortonHere.GetRadius() == vortonRadius ) ) ;
+                    if( useSimdKernel )
+                    {
+                        sourceBatch.Add( velocityAccumulator , vPosition , rVortonHere.mPosition , rVortonHere.mAngularVelocity , rVortonHere.mSize ) ;
+                    }
+                    else
+                    {
+                        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVortonHere ) ;
+                    }
+                    DEBUG_ONLY( sCirculationEncounteredInTree += rVortonHere.GetVorticity() * Pow3( rVortonHere.GetRadius() ) ) ;
+                }
+                ASSERT( numVortonsInCell == rChild.mNumVortonsIncorporated ) ;
+                DEBUG_ONLY( sNumVortonsEncounteredInTree += numVortonsInCell ) ;
+            }
+            else
+        #endif
+            {   // Current layer is an aggregation layer of supervortons, or USE_ORIGINAL_VORTONS_IN_BASE_LAYER is disabled.
+                if( useSimdKernel )
+                {
+                    sourceBatch.Add( velocityAccumulator , vPosition , rChild.mPosition , rChild.mAngularVelocity , rChild.mSize ) ;
+                }
+                else
+                {
+                    VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rChild ) ;
+                }
+                DEBUG_ONLY( sNumVortonsEncounteredInTree += rChild.mNumVortonsIncorporated ) ;
+                DEBUG_ONLY( sCirculationEncounteredInTree += rChild.mAngularVelocity * ( 2.0f * Pow3( 0.5f * rChild.mSize ) ) ) ;   // Vorticity times radius cubed, as for Vorton.
+            }
+        }
+    }
 
-    // Special case: Compute velocity due to vortons in same gridcell as query point.
-    {
-        UniformGrid< Vorton > & rLayer  = influenceTree[ 0 ] ;
+    sourceBatch.Flush( velocityAccumulator , vPosition ) ;
+    velocitySum.Add( velocityAccumulator ) ;
 
-        // The outermost layer of the grid contains no vortices.
-        // Any queries that walk along that outer layer see no influence.
-        // Make sure all queries start with indices that lie strictly within the region that contains influence data.
-        indicesVisited[ 0 ] = Min2( indicesVisited[ 0 ] , rLayer.GetNumCells( 0 ) - 1 ) ;
-        indicesVisited[ 1 ] = Min2( indicesVisited[ 1 ] , rLayer.GetNumCells( 1 ) - 1 ) ;
-        indicesVisited[ 2 ] = Min2( indicesVisited[ 2 ] , rLayer.GetNumCells( 2 ) - 1 ) ;
+    for( unsigned iOpen = 0 ; iOpen < numChildrenToOpen ; ++ iOpen )
+    {   // For each child cluster to open, recurse child layer.
+        velocitySum.Add( ComputeVelocity_LinearTree( vPosition , rParent.mFirstChild + childrenToOpen[ iOpen ] , iLayer - 1 , vortonIndicesGrid ) ) ;
+    }
 
-        const unsigned          offset  = rLayer.OffsetFromIndices( indicesVisited ) ;
-        const Vorton          & rVorton = rLayer[ offset ] ;
+    return velocitySum.GetSum() ;
+}
+#endif
 
-        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVorton ) ;
-ASSERT( FAbs( velocityAccumulator.x ) < 100.0f ) ; // DO NOT SUBMIT. heuristic, not always correct
 
-        DEBUG_ONLY( numVortonsEncountered   += rVorton.mNumVortonsIncorporated ) ;
-ASSERT( ( 0.0f == rVorton.GetRadius() ) || ( rVorton.GetRadius() == vortonRadius ) ) ; // This will probably end up changing.
-        DEBUG_ONLY( const Vec3 vCellCirculation = rVorton.GetVorticity() * Pow3( rVorton.GetRadius() ) ) ;
-        ASSERT( vCellCirculation.Resembles( rVorton.mTotalCirculation ) ) ;
-        DEBUG_ONLY( vVorticityEncountered += rVorton.GetVorticity() ) ;
-        DEBUG_ONLY( vCirculationEncountered += rVorton.mTotalCirculation ) ;
-    }
 
-    float clusterRadius = 1.0f * vortonRadius ;    // Experimental: estimate cluster radius based on level in influence tree.
 
+/** Compute velocity at a given point in space, due to influence of vortons, using a treecode, starting from the root of the given influence tree.
+
+    This traverses mLinearInfluenceTree when it holds a copy of influenceTree,
+    and influenceTree itself otherwise.
+
+    \see ComputeVelocity_Tree, ComputeVelocity_LinearTree
+*/
+Vec3 VortonSim::ComputeVelocity_TreeRoot( const Vec3 & vPosition , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
     const size_t numLayers = influenceTree.GetDepth() ;
-    for( size_t uLayer = 0 /* base */ ; uLayer < numLayers - 1 ; ++ uLayer )
-    {   // For each layer in influence tree...
-        UniformGrid< Vorton > & rLayer  = influenceTree[ uLayer ] ;
+#if VORTON_SIM_USE_LINEAR_INFLUENCE_TREE
+    if( mLinearInfluenceTree.IsBuiltFrom( influenceTree ) )
+    {
+        return ComputeVelocity_LinearTree( vPosition , 0 , numLayers - 1 , vortonIndicesGrid ) ;
+    }
+#endif
+    static const unsigned zeros[3] = { 0 , 0 , 0 } ; // Starter indices for recursive algorithm
+    return ComputeVelocity_Tree( vPosition , zeros , numLayers - 1 , vortonIndicesGrid , influenceTree ) ;
+}
 
-        // The outermost layer of the grid contains no vortices.
-        // Any queries that walk along that outer layer see no influence.
-        // Make sure all queries start with indices that lie strictly within the region that contains influence data.
-        indicesVisited[ 0 ] = Min2( indicesVisited[ 0 ] , rLayer.GetNumCells( 0 ) - 1 ) ;
-        indicesVisited[ 1 ] = Min2( indicesVisited[ 1 ] , rLayer.GetNumCells( 1 ) - 1 ) ;
-        indicesVisited[ 2 ] = Min2( indicesVisited[ 2 ] , rLayer.GetNumCells( 2 ) - 1 ) ;
 
-        const unsigned  offset  = rLayer.OffsetFromIndices( indicesVisited ) ;
-        Vorton          vorton = rLayer[ offset ] ;
-        // With this technique, we want to calculate the velocity due to siblings of this vorton
-        // (not due to this vorton itself).
-        vorton.mPosition  = vorton.mPositionSiblings ;
-        ASSERT( ! IsNan( vorton.mPosition ) && ! IsInf( vorton.mPosition ) ) ;
 
-        vorton.SetVorticity( vorton.mVorticitySiblings ) ;
 
-ASSERT( ( 0.0f == vorton.GetRadius() ) || ( vorton.GetRadius() == vortonRadius ) ) ; // This will probably end up changing.
-        //vorton.SetRadius( vorton.mRadiusSiblings ) ;
+#if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+/** Compute velocity, and its gradient, at a given point in space, due to influence of vortons, using a treecode.
 
-// Experimental: Estimate cluster radius based on level in influence tree, and adjust vorticity accordingly (to preserve total circulation)
-vorton.SetRadius( clusterRadius ) ;
-const float vorticityReduction = vortonRadius / clusterRadius ;
-ASSERT( vorticityReduction <= 1.0f ) ;
-vorton.SetVorticity( vorton.mVorticitySiblings * Pow3( vorticityReduction ) ) ;
+    \param velocityGradient - (in/out) variable in which to accumulate velocity gradient.  Row j is the derivative of velocity along axis j.
 
-        // Compute velocity induced by this supervorton.
-        // Accumulate influence, storing in velocityAccumulator.
-        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , vorton ) ;
-        ASSERT( ! IsInf( velocityAccumulator ) ) ;
-ASSERT( FAbs( velocityAccumulator.x ) < 1000.0f ) ; // DO NOT SUBMIT. heuristic, not always correct
+    This traverses the tree exactly as ComputeVelocity_Tree does, and returns
+    the same velocity, except that it always uses the scalar kernel, which
+    can round differently than the SIMD kernel.  Each interaction also
+    accumulates the exact gradient of the velocity of that (super)vorton.
 
-        DEBUG_ONLY( numVortonsEncountered   += vorton.mNumSibVortonsIncorporated ) ;
-        DEBUG_ONLY( vVorticityEncountered   += vorton.GetVorticity() ) ;
-        ASSERT( ( vorton.GetVorticity().Mag3() < 1.0e-8f ) || ( vorton.mSize > 0.0f ) ) ;
-        DEBUG_ONLY( vCirculationEncountered += vorton.GetVorticity() * Pow3( vorton.GetRadius() ) ) ;
+    \see ComputeVelocity_Tree, VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT_private.
+*/
+Vec3 VortonSim::ComputeVelocityAndGradient_Tree( Mat33 & velocityGradient , const Vec3 & vPosition , const unsigned indices[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__ComputeVelocityAndGradient_Tree ) ;
 
-        // Compute indices into parent layer
-        influenceTree.GetParentIndices( indicesVisited , indicesVisited , uLayer + 1 ) ;
-        #if 0 && defined( _DEBUG )
+    ASSERT( iLayer > 0 ) ; // Child has index iLayer-1 so iLayer better be positive.
+    const UniformGrid< Vorton > &   rChildLayer             = influenceTree[ iLayer - 1 ] ;
+    unsigned                        clusterMinIndices[3] ;
+    const unsigned *                pClusterDims            = influenceTree.GetDecimations( iLayer ) ;
+    influenceTree.GetChildClusterMinCornerIndex( clusterMinIndices , pClusterDims , indices ) ;
+
+    const Vec3 &            vGridMinCorner          = rChildLayer.GetMinCorner() ;
+    const Vec3              vSpacing                = rChildLayer.GetCellSpacing() ;
+    unsigned                increment[3]            ;
+    const unsigned &        numXchild               = rChildLayer.GetNumPoints( 0 ) ;
+    const unsigned          numXYchild              = numXchild * rChildLayer.GetNumPoints( 1 ) ;
+    Vec3                    velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;   // Sum of contributions from clusters this level treats as single sources.
+    VortonVelocitySum       velocitySum             ;   // Sum of contributions from child subtrees, plus velocityAccumulator.
+
+    // Match margin of ComputeVelocity_Tree, so both open the same clusters.
+#if AVOID_CENTERS
+    const float         marginFactor    = 2.0f * (*mVortons)[ 0 ].GetRadius() ;
+#else
+    static const float  marginFactor    = 0.0001f ;
+#endif
+    const Vec3          margin          = marginFactor * vSpacing + ( 0.0f == vSpacing.z ? Vec3(0,0,FLT_MIN) : Vec3(0,0,0) );
+
+    for( increment[2] = 0 ; increment[2] < pClusterDims[2] ; ++ increment[2] )
+    {   // For each cell of child layer in this grid cluster...
+        unsigned idxChild[3] ;
+        idxChild[2] = clusterMinIndices[2] + increment[2] ;
+        Vec3 vCellMinCorner , vCellMaxCorner ;
+        vCellMinCorner.z = vGridMinCorner.z + float( idxChild[2]     ) * vSpacing.z ;
+        vCellMaxCorner.z = vGridMinCorner.z + float( idxChild[2] + 1 ) * vSpacing.z ;
+        const unsigned offsetZ = idxChild[2] * numXYchild ;
+        for( increment[1] = 0 ; increment[1] < pClusterDims[1] ; ++ increment[1] )
         {
-            unsigned indicesParentTest[4] ;
-            influenceTree[ uLayer + 1 ].IndicesOfPosition( indicesParentTest , vPosition ) ;
-            ASSERT( indicesParentTest[0] == indicesVisited[0] ) ;
-            ASSERT( indicesParentTest[1] == indicesVisited[1] ) ;
-            ASSERT( indicesParentTest[2] == indicesVisited[2] ) ;
+            idxChild[1] = clusterMinIndices[1] + increment[1] ;
+            vCellMinCorner.y = vGridMinCorner.y + float( idxChild[1]     ) * vSpacing.y ;
+            vCellMaxCorner.y = vGridMinCorner.y + float( idxChild[1] + 1 ) * vSpacing.y ;
+            const unsigned offsetYZ = idxChild[1] * numXchild + offsetZ ;
+            for( increment[0] = 0 ; increment[0] < pClusterDims[0] ; ++ increment[0] )
+            {
+                idxChild[0] = clusterMinIndices[0] + increment[0] ;
+                vCellMinCorner.x = vGridMinCorner.x + float( idxChild[0]     ) * vSpacing.x ;
+                vCellMaxCorner.x = vGridMinCorner.x + float( idxChild[0] + 1 ) * vSpacing.x ;
+                const unsigned  offsetXYZ       = idxChild[0] + offsetYZ ;
+                const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
+                if( ( iLayer > 1 ) && ShouldOpenCluster( vPosition , vCellMinCorner , vCellMaxCorner , margin , rVortonChild , mTreeOpeningCriterion ) )
+                {   // Criterion deems child cell too near, so recurse child layer.
+                    velocitySum.Add( ComputeVelocityAndGradient_Tree( velocityGradient , vPosition , idxChild , iLayer - 1 , vortonIndicesGrid , influenceTree ) ) ;
+                }
+            #if USE_ORIGINAL_VORTONS_IN_BASE_LAYER
+                else if( 1 == iLayer )
+                {   // Reached base layer, so use original vortons instead of supervorton.
+                    const CellList::Cell cell = vortonIndicesGrid[ offsetXYZ ] ;
+                    for( unsigned ivHere = 0 ; ivHere < cell.Size() ; ++ ivHere )
+                    {   // For each vorton in this gridcell...
+                        const Vorton & rVortonHere = (*mVortons)[ cell[ ivHere ] ] ;
+                        VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT( velocityAccumulator , velocityGradient , vPosition , rVortonHere ) ;
+                    }
+                }
+            #endif
+                else
+                {   // Treat child cell as a single source.
+                    VORTON_ACCUMULATE_VELOCITY_AND_GRADIENT( velocityAccumulator , velocityGradient , vPosition , rVortonChild ) ;
+                }
+            }
         }
-        #endif
-    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
-        ASSERT( ( vorton.mIndicesOfParent[0] == 0x7fffffff ) || ( vorton.mIndicesOfParent[0] == indicesVisited[0] ) ) ;
-        ASSERT( ( vorton.mIndicesOfParent[1] == 0x7fffffff ) || ( vorton.mIndicesOfParent[1] == indicesVisited[1] ) ) ;
-        ASSERT( ( vorton.mIndicesOfParent[2] == 0x7fffffff ) || ( vorton.mIndicesOfParent[2] == indicesVisited[2] ) ) ;
-    #endif
-
-        clusterRadius *= 1.4142135623730950488016887242097f ; // Experimental: Estimate cluster radius based on level in influence tree
     }
 
-    ASSERT( mVortons->Size() == numVortonsEncountered ) ;
-    ASSERT( vCirculationEncountered.Resembles( mTotalCirculation ) ) ;
-    //DEBUG_ONLY( printf( "nv[%3i,%3i,%3i]= %u\n" , indices[0] , indices[1], indices[2] , numVortonsEncountered ) ) ;
+    velocitySum.Add( velocityAccumulator ) ;
 
-    return velocityAccumulator ;
+    return velocitySum.GetSum() ;
 }
 #endif
 
 
 
 
-/** Compute vector potential due to vortons, for a subset of points in a uniform grid.
-
-    \param izStart  Starting value for z index
-
-    \param izEnd    One past ending value for z index
+/** Return root-mean-square error of the velocity grid, relative to direct summation, at a sample of gridpoints.
 
-    \param boundariesOnly   Compute vector potential only on domain boundaries.
-                            If false, compute throughout domain interior.
+    \param numSamples   Number of gridpoints, spread evenly through the velocity grid, at which to compare.
 
-    \note This routine assumes CreateInfluenceTree has already executed,
-            and that the vector potential grid has been allocated.
+    This measures whatever technique populated the velocity grid, including
+    any interpolation, so it costs O(numSamples*N) regardless of technique.
 
+    \note Call this after computing velocity, before vortons move.
 */
-void VortonSim::ComputeVectorPotentialAtGridpoints_Slice( size_t izStart , size_t izEnd , bool boundariesOnly , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+float VortonSim::MeasureVelocityGridError( size_t numSamples )
 {
-#if VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE
-    const size_t            numLayers               = influenceTree.GetDepth() ;
-#endif
+    PERF_BLOCK( VortonSim__MeasureVelocityGridError ) ;
 
-    UniformGrid< Vec3 > &   vectorPotentialGrid     = mVectorPotentialMultiGrid[ 0 ] ;
+    if( mVortons->Empty() )
+    {
+        return 0.0f ;
+    }
 
-    const Vec3 &            vMinCorner              = mVelGrid.GetMinCorner() ;
-    static const float      nudge                   = 1.0f - 2.0f * FLT_EPSILON ;   // Slightly shrink coordinate spacing to avoid roundoff from exceeding domain (and from having a conditional branch per iteration).
-    const Vec3              vSpacing                = mVelGrid.GetCellSpacing() * nudge ;
-    const unsigned          dims[3]                 =   { mVelGrid.GetNumPoints( 0 )
-                                                        , mVelGrid.GetNumPoints( 1 )
-                                                        , mVelGrid.GetNumPoints( 2 ) } ;
-    const unsigned          numXY                   = dims[0] * dims[1] ;
-    unsigned                idx[ 3 ] ;
-    const unsigned          incrementXForInterior   = boundariesOnly ? ( dims[0] - 1 ) : 1 ;
+#if USE_VORTON_SOA
+    // ComputeVelocity_Direct reads the SoA copy, which only integral velocity techniques otherwise gather.
+    mVortonSoa.Gather( * mVortons ) ;
+#endif
 
-    // Compute fluid flow vector potential at each boundary gridpoint, due to all vortons.
-    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
-    {   // For subset of z index values...
-        Vec3 vPosition ;
-        vPosition.z = vMinCorner.z + float( idx[2] ) * vSpacing.z ;                 // Compute z-coordinate of world-space position of current gridpoint.
-        const unsigned  offsetZ     = idx[2] * numXY ;                              // Precompute z contribution to offset into grid.
-        const bool      topOrBottom = ( 0 == idx[2] ) || ( dims[2]-1 == idx[2] ) ;  // Whether current gridpoint is on top (+Z) or bottom (-Z) plane
-        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
-        {   // For every gridpoint along the y-axis...
-            vPosition.y = vMinCorner.y + float( idx[1] ) * vSpacing.y ;                                 // Compute y-coordinate of world-space position of current gridpoint.
-            const unsigned  offsetYZ    = idx[1] * dims[0] + offsetZ ;                                  // Precompute y contribution to the offset into grid.
-            const bool      frontOrBack = ( 0 == idx[1] ) || ( dims[1]-1 == idx[1] ) ;                  // Whether current gridpoint is on front (+Y) or back (-Y) plane
-            const unsigned  incX        = ( topOrBottom || frontOrBack ) ? 1 : incrementXForInterior ;  // For points other than top|bottom|front|back, skip interior gridpoints.
-            for( idx[0] = 0 ; idx[0] < dims[0] ; idx[0] += incX )
-            {   // For every gridpoint along the x-axis...
-                vPosition.x = vMinCorner.x + float( idx[0] ) * vSpacing.x ; // Compute x-coordinate of world-space position of current gridpoint.
-                const unsigned offsetXYZ = idx[0] + offsetYZ ;              // Compute offset into grid for current point
+    const unsigned  numGridpoints   = mVelGrid.GetGridCapacity() ;
+    numSamples = Min2( numSamples , size_t( numGridpoints ) ) ;
+    double          errorMag2Sum    = 0.0 ;
+    double          speed2Sum       = 0.0 ;
+    for( size_t iSample = 0 ; iSample < numSamples ; ++ iSample )
+    {   // For each sample...
+        const unsigned  offset  = unsigned( double( iSample ) * double( numGridpoints ) / double( numSamples ) ) ;
+        unsigned        indices[3] ;
+        mVelGrid.IndicesFromOffset( indices , offset ) ;
+        const Vec3      vPosition       = mVelGrid.PositionFromIndices( indices ) ;
+        const Vec3      velocityDirect  = ComputeVelocity_Direct( vPosition ) ;
+        errorMag2Sum += ( mVelGrid[ offset ] - velocityDirect ).Mag2() ;
+        speed2Sum    += velocityDirect.Mag2() ;
+    }
 
-#               if VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_DIRECT
+    return ( speed2Sum > 0.0 ) ? float( sqrt( errorMag2Sum / speed2Sum ) ) : 0.0f ;
+}
 
-                    UNUSED_PARAM( influenceTree ) ;
-                    UNUSED_PARAM( vortonIndicesGrid ) ;
 
-                    vectorPotentialGrid[ offsetXYZ ] = ComputeVectorPotential_Direct( vPosition ) ;
 
-#               elif VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE
 
-#                   if ! USE_TBB
-#                       define CHECK_BULK_VORTICITY_SELF_CONSISTENCY()                                                                              \
-                        {                                                                                                                           \
-                            ASSERT( mVortons->Size() == sNumVortonsEncounteredInTree ) ;                                                            \
-                            ASSERT( sCirculationEncounteredInTree.Resembles( mDiagnosticIntegrals.mAfterAdvect.mTotalCirculation , 1.0e-3f ) ) ;    \
-                        }
-#                   else
-#                       define CHECK_BULK_VORTICITY_SELF_CONSISTENCY() ;
-#                   endif
+/** Compare treecode velocity against direct summation, at a sample of gridpoints, and record the error in mTreecodeErrorStats.
 
-                    if( 0 == ( idx[0] & 1 ) )
-                    {   // Even x indices.  Compute value.
-                        DEBUG_ONLY( sNumVortonsEncounteredInTree  = 0 ) ;
-                        DEBUG_ONLY( sVorticityEncounteredInTree   = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-                        DEBUG_ONLY( sCirculationEncounteredInTree = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-                        static const unsigned zeros[3] = { 0 , 0 , 0 } ; /* Starter indices for recursive algorithm */
-                        if( numLayers > 1 )
-                        {
-                            vectorPotentialGrid[ offsetXYZ ] = ComputeVectorPotential_Tree( vPosition , zeros , numLayers - 1 , vortonIndicesGrid , influenceTree ) ;
-                            CHECK_BULK_VORTICITY_SELF_CONSISTENCY() ;
-                        }
-                        else
-                        {
-                            vectorPotentialGrid[ offsetXYZ ] = ComputeVectorPotential_Direct( vPosition ) ;
-                        }
-                    }
-                    else
-                    {   // Odd x indices. Copy value from preceding grid point.
-                        vectorPotentialGrid[ offsetXYZ ] = vectorPotentialGrid[ offsetXYZ - 1 ] ;
-                    }
+    This evaluates velocity at GetNumTreecodeErrorSamples gridpoints of the
+    velocity grid, spread evenly through it, using both ComputeVelocity_Tree,
+    with the current TreeOpeningCriterion, and ComputeVelocity_Direct.  So
+    it costs O(numSamples*N), and benchmarks should enable it sparingly.
 
-#               else
-#                   error Vector potential technique is invalid or undefined.  Assign VECTOR_POTENTIAL_TECHNIQUE in vorton.h or change this code.
-#               endif
 
-            }
-        }
-    }
-}
+    \note Call this after computing velocity, while vortons still match influenceTree.
+*/
+void VortonSim::MeasureTreecodeError( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__MeasureTreecodeError ) ;
 
+    mTreecodeErrorStats = TreecodeErrorStatistics() ;
 
+    const size_t numLayers = influenceTree.GetDepth() ;
+    if( mVortons->Empty() || ( numLayers < 2 ) )
+    {   // No tree to measure.  Treecode callers would use direct summation.
+        return ;
+    }
 
+#if USE_VORTON_SOA
+    // ComputeVelocity_Direct reads the SoA copy, which only integral velocity techniques otherwise gather.
+    mVortonSoa.Gather( * mVortons ) ;
+#endif
 
-/** Compute vector potential due to vortons, for every point in a uniform grid, using an integral technique (direct summation, treecode or multipole method).
+    const unsigned  numGridpoints   = mVelGrid.GetGridCapacity() ;
+    const size_t    numSamples      = Min2( mNumTreecodeErrorSamples , size_t( numGridpoints ) ) ;
+    double          errorMag2Sum    = 0.0 ;
+    double          speed2Sum       = 0.0 ;
+    float           errorMag2Max    = 0.0f ;
+    float           speed2Max       = 0.0f ;
+    for( size_t iSample = 0 ; iSample < numSamples ; ++ iSample )
+    {   // For each sample...
+        const unsigned  offset  = unsigned( double( iSample ) * double( numGridpoints ) / double( numSamples ) ) ;
+        unsigned        indices[3] ;
+        mVelGrid.IndicesFromOffset( indices , offset ) ;
+        const Vec3      vPosition       = mVelGrid.PositionFromIndices( indices ) ;
+        const Vec3      velocityTree    = ComputeVelocity_TreeRoot( vPosition , vortonIndicesGrid , influenceTree ) ;
+        const Vec3      velocityDirect  = ComputeVelocity_Direct( vPosition ) ;
+        const float     errorMag2       = ( velocityTree - velocityDirect ).Mag2() ;
+        const float     speed2          = velocityDirect.Mag2() ;
+        errorMag2Sum += errorMag2 ;
+        speed2Sum    += speed2 ;
+        errorMag2Max = Max2( errorMag2Max , errorMag2 ) ;
+        speed2Max    = Max2( speed2Max , speed2 ) ;
+    }
 
-    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons in a vicinity.
+    mTreecodeErrorStats.mNumSamples = numSamples ;
+    if( speed2Sum > 0.0 )
+    {
+        mTreecodeErrorStats.mRmsRelativeError = float( sqrt( errorMag2Sum / speed2Sum ) ) ;
+    }
+    if( speed2Max > 0.0f )
+    {
+        mTreecodeErrorStats.mMaxRelativeError = sqrtf( errorMag2Max / speed2Max ) ;
+    }
+}
 
-    \param influenceTree        Nested grid of vortons and "super-vortons", used to compute velocity-from-vorticity using treecode.
 
-    \see CreateInfluenceTree
 
-    \note This routine assumes CreateInfluenceTree has already executed.
 
-*/
-void VortonSim::ComputeVectorPotentialFromVorticity_Integral( bool boundariesOnly , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
-{
-    PERF_BLOCK( VortonSim__ComputeVectorPotentialFromVorticity_Integral ) ;
+#if VORTON_SIM_GROUP_TREE_QUERIES
+/** Compute velocity at a group of points in space, due to influence of vortons, using a treecode traversal the points share.
 
-    ASSERT( ! mVortons->empty() ) ;
+    \param velocities - (in/out) velocity accumulators, indexed by elements of queries.
 
-    #if ENABLE_AUTO_MOLLIFICATION
-    {
-        // Smooth velocity induced by vorton, in its vicinity, so that its
-        // length scale corresponds approximately to what the grid can resolve.
-        // When too large, fluid motion lacks detail.
-        // When too small, fluid motion jerks when vortons pass near query points.
-        // Auto-mollification should be used only with integral techniques,
-        // and usually only with VELOCITY_TECHNIQUE_TREE.
-        // See comments where ENABLE_AUTO_MOLLIFICATION is defined.
-        static const float  OneThird                 = 1.0f / 3.0f ;
-        // Tune lengthScale based on comparing jerk statistics for the technique that uses this (TREE)
-        // with DIRECT using COMPUTE_VELOCITY_AT_VORTONS (which is about as accurate as a vorton method can get).
-        static const float  lengthScale              = 1.0f ;
-        const float         characteristicGridLength = lengthScale * powf( mVelGrid.GetCellVolume() , OneThird ) ;
-        ASSERT( ! mVortons->empty() ) ;
-        const float         vortonRadius = (*mVortons)[ 0 ].GetRadius() ;
-        mSpreadingRangeFactor       = Max2( characteristicGridLength / vortonRadius , 1.0f ) ;
-        mSpreadingCirculationFactor = 1.0f / Pow3( mSpreadingRangeFactor ) ;
-    }
-    #endif
+    \param positions - points whose velocity to evaluate, indexed by elements of queries.
 
-//#if COMPUTE_VELOCITY_AT_VORTONS
-//    const size_t numVortons = mVortons->size() ;
-//    // Compute velocity at vortons.
-//    // This is only useful for diagnosing integral solvers.  Otherwise, compute velocity on the grid.
-//    #if USE_TBB
-//        // Estimate grain size based on size of problem and number of processors.
-//        const size_t grainSize =  Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
-//        // Compute velocity at vortons using multiple threads.
-//        parallel_for( tbb::blocked_range<size_t>( 0 , numVortons , grainSize ) , VortonSim_ComputeVelocityAtVortons_TBB( this , vortonIndicesGrid , influenceTree ) ) ;
-//    #else
-//        ComputeVectorPotentialAtVortons_Slice( 0 , numVortons , vortonIndicesGrid , influenceTree ) ;
-//    #endif
-//    // Transfer velocity from vortons to grid.
-//    PopulateVectorPotentialGrid( mVelGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) ) ;
-//#else   // Compute velocity at gridpoints.
-    const unsigned numZ = mVelGrid.GetNumPoints( 2 ) ;
-#   if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
-        // Compute velocity at gridpoints using multiple threads.
-        parallel_for( tbb::blocked_range<size_t>( 0 , numZ , grainSize ) , VortonSim_ComputeVectorPotentialAtGridpoints_TBB( this , boundariesOnly , vortonIndicesGrid , influenceTree ) ) ;
-#   else
-        ComputeVectorPotentialAtGridpoints_Slice( 0 , numZ , boundariesOnly , vortonIndicesGrid , influenceTree ) ;
-#   endif
-//#endif
-}
+    \param queries - indices, into velocities and positions, of the points in this group.
 
+    \param numQueries - number of elements in queries.
 
+    \param subsetScratch - space for scratchStride indices per remaining layer, into which
+        this writes the subset of queries that open each child cluster.
 
+    \param scratchStride - number of indices reserved per layer in subsetScratch.
+        Must be at least the number of queries in the outermost group.
 
-/** Compute velocity due to vortons, for a subset of points in a uniform grid.
+    \param indices - indices of cell to visit in the given layer
 
-    \param izStart - starting value for z index
+    \param iLayer - which layer to process
 
-    \param izEnd - one past ending value for z index
+    This visits the same clusters, and evaluates the same interactions, as
+    calling ComputeVelocity_Tree for each query separately.  But the group
+    decides together whether to open each child cluster.  When no query lies
+    inside a child, every query treats it as one source, which this gathers
+    once, into a batch that every query then evaluates.  When some queries lie
+    inside, only those descend into it, as a smaller group.
 
-    \see CreateInfluenceTree, ComputeVelocityFromVorticity
+    \note This is a recursive algorithm.  The outermost caller should pass in
+            influenceTree.GetDepth()-1, and zeros for indices.
 
-    \note This routine assumes CreateInfluenceTree has already executed,
-            and that the velocity grid has been allocated.
+    \see ComputeVelocity_Tree
 
 */
-void VortonSim::ComputeVelocityAtGridpoints_Slice( size_t izStart , size_t izEnd , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+void VortonSim::ComputeVelocity_TreeGroup( Vec3 velocities[] , const Vec3 positions[] , const unsigned queries[] , size_t numQueries , unsigned subsetScratch[] , size_t scratchStride
+                                         , const unsigned indices[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
 {
-#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE
-    const size_t        numLayers   = influenceTree.GetDepth() ;
+    PERF_BLOCK( VortonSim__ComputeVelocity_TreeGroup ) ;
+
+    ASSERT( iLayer > 0 ) ; // Child has index iLayer-1 so iLayer better be positive.
+    ASSERT( numQueries > 0 ) ;
+    const UniformGrid< Vorton > &   rChildLayer             = influenceTree[ iLayer - 1 ] ;
+    unsigned                        clusterMinIndices[3] ;
+    const unsigned *                pClusterDims            = influenceTree.GetDecimations( iLayer ) ;
+    influenceTree.GetChildClusterMinCornerIndex( clusterMinIndices , pClusterDims , indices ) ;
+
+    const Vec3 &            vGridMinCorner          = rChildLayer.GetMinCorner() ;
+    const Vec3              vSpacing                = rChildLayer.GetCellSpacing() ;
+    unsigned                increment[3]            ;
+    const unsigned &        numXchild               = rChildLayer.GetNumPoints( 0 ) ;
+    const unsigned          numXYchild              = numXchild * rChildLayer.GetNumPoints( 1 ) ;
+
+    // Use the same margin and opening criterion as ComputeVelocity_Tree, so both open the same clusters.
+#if AVOID_CENTERS
+    const float             vortonRadius    = (*mVortons)[ 0 ].GetRadius() ;
+    static const float      marginFactor    = 2.0f * vortonRadius ;
+#else
+    static const float      marginFactor    = 0.0001f ;
 #endif
-    const Vec3 &        vMinCorner  = mVelGrid.GetMinCorner() ;
-    static const float  nudge       = 1.0f - 2.0f * FLT_EPSILON ;
-    const Vec3          vSpacing    = mVelGrid.GetCellSpacing() * nudge ;
-    const unsigned      dims[3]     =   { mVelGrid.GetNumPoints( 0 )
-                                        , mVelGrid.GetNumPoints( 1 )
-                                        , mVelGrid.GetNumPoints( 2 ) } ;
-    const unsigned      numXY       = dims[0] * dims[1] ;
-    unsigned            idx[ 3 ] ;
-    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
-    {   // For subset of z index values...
-        Vec3 vPosition ;
-        // Compute the z-coordinate of the world-space position of this gridpoint.
-        vPosition.z = vMinCorner.z + float( idx[2] ) * vSpacing.z ;
-        // Precompute the z contribution to the offset into the velocity grid.
-        const unsigned offsetZ = idx[2] * numXY ;
-        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
-        {   // For every gridpoint along the y-axis...
-            // Compute the y-coordinate of the world-space position of this gridpoint.
-            vPosition.y = vMinCorner.y + float( idx[1] ) * vSpacing.y ;
-            // Precompute the y contribution to the offset into the velocity grid.
-            const unsigned offsetYZ = idx[1] * dims[0] + offsetZ ;
-            for( idx[0] = 0 ; idx[0] < dims[0] ; ++ idx[0] )
-            {   // For every gridpoint along the x-axis...
-                // Compute the x-coordinate of the world-space position of this gridpoint.
-                vPosition.x = vMinCorner.x + float( idx[0] ) * vSpacing.x ;
-                // Compute the offset into the velocity grid.
-                const unsigned offsetXYZ = idx[0] + offsetYZ ;
+    const Vec3              margin          = marginFactor * vSpacing + ( 0.0f == vSpacing.z ? Vec3(0,0,FLT_MIN) : Vec3(0,0,0) );
 
-                // Compute the fluid flow velocity at this gridpoint, due to all vortons.
-            #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_DIRECT
-                mVelGrid[ offsetXYZ ] = ComputeVelocity_Direct( vPosition ) ;
-                (void) influenceTree , vortonIndicesGrid ; // Avoid "unreferenced formal parameter" compiler warning.
-            #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE
-                DEBUG_ONLY( sNumVortonsEncounteredInTree  = 0 ) ;
-                DEBUG_ONLY( sVorticityEncounteredInTree   = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-                DEBUG_ONLY( sCirculationEncounteredInTree = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-                static const unsigned zeros[3] = { 0 , 0 , 0 } ; // Starter indices for recursive algorithm
-                if( numLayers > 1 )
-                {
-                    mVelGrid[ offsetXYZ ] = ComputeVelocity_Tree( vPosition , zeros , numLayers - 1  , vortonIndicesGrid , influenceTree ) ;
-                #if ! USE_TBB
-                    ASSERT( mVortons->Size() == sNumVortonsEncounteredInTree ) ;
-                    ASSERT( sCirculationEncounteredInTree.Resembles( mDiagnosticIntegrals.mAfterAdvect.mTotalCirculation , 1.0e-3f ) ) ;
-                #endif
+    const bool              useSimdKernel   = ( BIOT_SAVART_KERNEL_SCALAR != mBiotSavartKernel ) ;
+    const FluidKernelTable *ispcKernels     = ( BIOT_SAVART_KERNEL_ISPC == mBiotSavartKernel ) ? FluidKernels::GetTable() : NULL ;
+    VortonSourceGroupBatch  sharedSources( mSpreadingRangeFactor , mSpreadingCirculationFactor , useSimdKernel , ispcKernels , velocities , positions , queries , numQueries ) ;
+
+    // For each cell of child layer in this grid cluster...
+    for( increment[2] = 0 ; increment[2] < pClusterDims[2] ; ++ increment[2] )
+    {
+        unsigned idxChild[3] ;
+        idxChild[2] = clusterMinIndices[2] + increment[2] ;
+        Vec3 vCellMinCorner , vCellMaxCorner ;
+        vCellMinCorner.z = vGridMinCorner.z + float( idxChild[2]     ) * vSpacing.z ;
+        vCellMaxCorner.z = vGridMinCorner.z + float( idxChild[2] + 1 ) * vSpacing.z ;
+        const unsigned offsetZ = idxChild[2] * numXYchild ;
+        for( increment[1] = 0 ; increment[1] < pClusterDims[1] ; ++ increment[1] )
+        {
+            idxChild[1] = clusterMinIndices[1] + increment[1] ;
+            vCellMinCorner.y = vGridMinCorner.y + float( idxChild[1]     ) * vSpacing.y ;
+            vCellMaxCorner.y = vGridMinCorner.y + float( idxChild[1] + 1 ) * vSpacing.y ;
+            const unsigned offsetYZ = idxChild[1] * numXchild + offsetZ ;
+            for( increment[0] = 0 ; increment[0] < pClusterDims[0] ; ++ increment[0] )
+            {
+                idxChild[0] = clusterMinIndices[0] + increment[0] ;
+                vCellMinCorner.x = vGridMinCorner.x + float( idxChild[0]     ) * vSpacing.x ;
+                vCellMaxCorner.x = vGridMinCorner.x + float( idxChild[0] + 1 ) * vSpacing.x ;
+                const unsigned  offsetXYZ       = idxChild[0] + offsetYZ ;
+                const Vorton &  rVortonChild    = rChildLayer[ offsetXYZ ] ;
+
+                size_t numInside = 0 ;
+                if( iLayer > 1 )
+                {   // Child layer is not the leaf layer, so queries inside (or too near) child cell descend into it.
+                    for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+                    {
+                        if( ShouldOpenCluster( positions[ queries[ iQuery ] ] , vCellMinCorner , vCellMaxCorner , margin , rVortonChild , mTreeOpeningCriterion ) )
+                        {
+                            subsetScratch[ numInside ++ ] = queries[ iQuery ] ;
+                        }
+                    }
                 }
-                else
-                {
-                    mVelGrid[ offsetXYZ ] = ComputeVelocity_Direct( vPosition ) ;
+
+                if( numInside > 0 )
+                {   // Some queries lie inside child cell.  Recurse child layer with those.
+                    ComputeVelocity_TreeGroup( velocities , positions , subsetScratch , numInside , subsetScratch + scratchStride , scratchStride , idxChild , iLayer - 1 , vortonIndicesGrid , influenceTree ) ;
+                    if( numInside < numQueries )
+                    {   // Group straddles child cell boundary.  Queries outside it treat it as one source, individually.
+                        for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+                        {
+                            const unsigned & idxQuery = queries[ iQuery ] ;
+                            if( ! ShouldOpenCluster( positions[ idxQuery ] , vCellMinCorner , vCellMaxCorner , margin , rVortonChild , mTreeOpeningCriterion ) )
+                            {
+                                VORTON_ACCUMULATE_VELOCITY( velocities[ idxQuery ] , positions[ idxQuery ] , rVortonChild ) ;
+                            }
+                        }
+                    }
+                }
+            #if USE_ORIGINAL_VORTONS_IN_BASE_LAYER
+                else if( 1 == iLayer )
+                {   // Reached base layer.  Every query uses the original vortons in this cell.
+                    const CellList::Cell    cell                = vortonIndicesGrid[ offsetXYZ ] ;
+                    const size_t            numVortonsInCell    = cell.Size() ;
+                    for( size_t ivHere = 0 ; ivHere < numVortonsInCell ; ++ ivHere )
+                    {   // For each vorton in this gridcell...
+                        const Vorton & rVortonHere = (*mVortons)[ cell[ ivHere ] ] ;
+                        sharedSources.Add( rVortonHere.mPosition , rVortonHere.mAngularVelocity , rVortonHere.mSize ) ;
+                    }
                 }
-            #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
-                mVelGrid[ offsetXYZ ] = ComputeVelocity_Monopoles( idx , vPosition ) ;
-                ASSERT( ! IsInf( mVelGrid[ offsetXYZ ] ) ) ;
-            #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL
-                FAIL() ; // Differential solvers do not use this routine.
-                (void) offsetXYZ ;
-                (void) influenceTree , vortonIndicesGrid ; // Avoid "unreferenced formal parameter" compiler warning.
-            #else
-                #error Velocity technique is invalid or undefined.  Assign VELOCITY_TECHNIQUE in vorton.h or change this code.
             #endif
+                else
+                {   // No query lies inside child cell, or reached leaf node.  Every query uses its (super)vorton.
+                    sharedSources.Add( rVortonChild.mPosition , rVortonChild.mAngularVelocity , rVortonChild.mSize ) ;
+                }
             }
         }
     }
-#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
-    DEBUG_ONLY( printf( "\n" ) ) ;
-#endif
-}
 
+    sharedSources.Flush() ;
 
+    (void) vortonIndicesGrid ; // Avoid "unreferenced formal parameter" warning when USE_ORIGINAL_VORTONS_IN_BASE_LAYER is disabled.
+}
+#endif
 
 
-/** Compute velocity due to vortons, at vorton locations, for a subset of vortons.
 
-    \param iPclStart - starting value for vorton index
 
-    \param iPclEnd - one past ending value for vorton index
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
+/** Compute velocity at a given point in space, due to influence of vortons.
 
-    \see ComputeVelocityFromVorticity, ComputeVelocityAtGridpoints_Slice
+    \param indices - indices of grid cell of position whose velocity to evaluate
 
-    \note This routine is an alternative to ComputeVelocityAtGridpoints_Slice,
-            which computes velocity at gridpoints
-            (which are at grid cell corners).
+    \param vPosition - point in space whose velocity to evaluate
 
-    \note This routine assumes CreateInfluenceTree has already executed.
+    \return velocity at vPosition, due to influence of vortons
+
+    \note This is a recursive algorithm with time complexity O(log(N)). 
+              The outermost caller should pass in influenceTree.GetDepth().
 
 */
-void VortonSim::ComputeVelocityAtVortons_Slice( unsigned iPclStart , unsigned iPclEnd , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+Vec3 VortonSim::ComputeVelocity_Monopoles( const unsigned indices[3] , const Vec3 & vPosition , const NestedGrid< Vorton > & influenceTree )
 {
-#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE
-    const size_t        numLayers   = influenceTree.GetDepth() ;
-#endif
-    for( unsigned iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
-    {   // For subset of vortex particle index values...
-        Vorton & vorton = (*mVortons)[ iPcl ] ;
-        Vec3 & vPosition = vorton.mPosition ;
-        Vec3 & vVelocity = vorton.mVelocity ;
-        // Compute the fluid flow velocity at this gridpoint, due to all vortons.
-    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_DIRECT
-        vVelocity = ComputeVelocity_Direct( vPosition ) ;
-        #if ENABLE_PARTICLE_HISTORY
-            PclHistoryRecord( iPcl , vorton ) ; // For diagnosing determinism.
-        #endif
-        (void) influenceTree , vortonIndicesGrid ; // Avoid "unreferenced formal parameter" compiler warning.
-    #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE
-        DEBUG_ONLY( sNumVortonsEncounteredInTree  = 0 ) ;
-        DEBUG_ONLY( sVorticityEncounteredInTree   = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-        DEBUG_ONLY( sCirculationEncounteredInTree = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-        static const unsigned zeros[3] = { 0 , 0 , 0 } ; // Starter indices for recursive algorithm
-        vVelocity = ComputeVelocity_Tree( vPosition , zeros , numLayers - 1  , vortonIndicesGrid , influenceTree ) ;
-        #if ! USE_TBB
-            ASSERT( mVortons->Size() == sNumVortonsEncounteredInTree ) ;
-            ASSERT( sCirculationEncounteredInTree.Resembles( mDiagnosticIntegrals.mAfterAdvect.mTotalCirculation ) ) ;
-        #endif
-    #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
-        FAIL() ;  // Monopole method does not use this routine.
-        (void) vPosition , vVelocity ; // Avoid "local variable is initialized but not referenced" warning.
-    #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL
-        FAIL() ; // Differential solvers do not use this routine.
-        (void) vPosition , vVelocity ; // Avoid "local variable is initialized but not referenced" warning.
-        (void) influenceTree , vortonIndicesGrid  ; // Avoid "unreferenced formal parameter" warning.
-    #else
-        #error Velocity technique is invalid or undefined.  Assign VELOCITY_TECHNIQUE in vorton.h or change this code.
-    #endif
+    PERF_BLOCK( VortonSim__ComputeVelocity_Monopoles ) ;
+
+    Vec3        velocityAccumulator( 0.0f , 0.0f , 0.0f ) ;
+    unsigned    indicesVisited[4] = { indices[0] , indices[1] , indices[2] , 0 } ;
+
+#if defined( _DEBUG )
+    {
+        unsigned    indicesTest[4] ;    // indices within base layer of query position
+        influenceTree[ 0 ].IndicesOfPosition( indicesTest , vPosition ) ;
     }
-#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
-    DEBUG_ONLY( printf( "\n" ) ) ;
 #endif
-}
 
+    DEBUG_ONLY( unsigned    numVortonsEncountered = 0 ) ;
+    DEBUG_ONLY( Vec3        vVorticityEncountered( 0.0f , 0.0f , 0.0f ) ) ;
+    DEBUG_ONLY( Vec3        vCirculationEncountered( 0.0f , 0.0f , 0.0f ) ) ;
 
+    const float vortonRadius = (*mVortons)[ 0 ].GetRadius() ;
 
+    // Special case: Compute velocity due to vortons in same gridcell as query point.
+    {
+        UniformGrid< Vorton > & rLayer  = influenceTree[ 0 ] ;
 
-/** Populate a UniformGrid with vorticity values from vortons.
+        // The outermost layer of the grid contains no vortices.
+        // Any queries that walk along that outer layer see no influence.
+        // Make sure all queries start with indices that lie strictly within the region that contains influence data.
+        indicesVisited[ 0 ] = Min2( indicesVisited[ 0 ] , rLayer.GetNumCells( 0 ) - 1 ) ;
+        indicesVisited[ 1 ] = Min2( indicesVisited[ 1 ] , rLayer.GetNumCells( 1 ) - 1 ) ;
+        indicesVisited[ 2 ] = Min2( indicesVisited[ 2 ] , rLayer.GetNumCells( 2 ) - 1 ) ;
 
-    \param vorticityGrid    (out) Reference to grid representing spatial distribution of vorticity.
+        const unsigned          offset  = rLayer.OffsetFromIndices( indicesVisited ) ;
+        const Vorton          & rVorton = rLayer[ offset ] ;
 
-    \param scale    Scale by which to multiply vorticity values.
-                    Normally scale should be either 1.0f or -1.0f.
+        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVorton ) ;
+ASSERT( FAbs( velocityAccumulator.x ) < 100.0f ) ; // DO NOT SUBMIT. heuristic, not always correct
 
-    \note   The Poisson equation we want to solve has the form
-        \verbatim
-                Laplacian vectorPotential = - vorticity
-        \endverbatim
-            in which case scale should be -1.0f.
-*/
-void VortonSim::PopulateVorticityGridFromVortons( UniformGrid< Vec3 > & vorticityGrid , float scale )
-{
-    PERF_BLOCK( VortonSim__PopulateVorticityGridFromVortons ) ;
+        DEBUG_ONLY( numVortonsEncountered   += rVorton.mNumVortonsIncorporated ) ;
+ASSERT( ( 0.0f == rVorton.GetRadius() ) || ( rVorton.GetRadius() == vortonRadius ) ) ; // This will probably end up changing.
+        DEBUG_ONLY( const Vec3 vCellCirculation = rVorton.GetVorticity() * Pow3( rVorton.GetRadius() ) ) ;
+        ASSERT( vCellCirculation.Resembles( rVorton.mTotalCirculation ) ) ;
+        DEBUG_ONLY( vVorticityEncountered += rVorton.GetVorticity() ) ;
+        DEBUG_ONLY( vCirculationEncountered += rVorton.mTotalCirculation ) ;
+    }
 
-    vorticityGrid.Clear() ;                            // Clear any stale vorticity information
-    vorticityGrid.CopyShape( mGridTemplate ) ;         // Use same shape as base vorticity grid. (Note: could differ if you want.)
-    vorticityGrid.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ; // Reserve memory for velocity grid and initialize all values to zero.
+    float clusterRadius = 1.0f * vortonRadius ;    // Experimental: estimate cluster radius based on level in influence tree.
 
-    if( mVortons->Empty() )
-    {
-        return ;
-    }
+    const size_t numLayers = influenceTree.GetDepth() ;
+    for( size_t uLayer = 0 /* base */ ; uLayer < numLayers - 1 ; ++ uLayer )
+    {   // For each layer in influence tree...
+        UniformGrid< Vorton > & rLayer  = influenceTree[ uLayer ] ;
 
-    DEBUG_ONLY( Vec3 vCirculationVortons( 0.0f , 0.0f , 0.0f ) ) ;
-    DEBUG_ONLY( Vec3 vCirculationToGrid( 0.0f , 0.0f , 0.0f ) ) ;
+        // The outermost layer of the grid contains no vortices.
+        // Any queries that walk along that outer layer see no influence.
+        // Make sure all queries start with indices that lie strictly within the region that contains influence data.
+        indicesVisited[ 0 ] = Min2( indicesVisited[ 0 ] , rLayer.GetNumCells( 0 ) - 1 ) ;
+        indicesVisited[ 1 ] = Min2( indicesVisited[ 1 ] , rLayer.GetNumCells( 1 ) - 1 ) ;
+        indicesVisited[ 2 ] = Min2( indicesVisited[ 2 ] , rLayer.GetNumCells( 2 ) - 1 ) ;
 
-    // In order for the Poisson and Tree/Monopole velocity-from-vorticity 
-    // techniques to produce consistent results, this formula for the volume of
-    // a vorton must match that implicitly used in VORTON_ACCUMULATE_VELOCITY_private.
-    ASSERT( ! mVortons->empty() ) ;
-    const float vortonRadius        = (*mVortons)[ 0 ].GetRadius() ;
-    const float cellVolume          = vorticityGrid.GetCellVolume() ;
-    const float vortonVolume        = FourPiOver3 * Pow3( vortonRadius ) ;
-    // The grid resulting from this operation must preserve the
-    // same total circulation that the vortons have, so multiply
-    // by the ratio of the vorton volume to gridcell volume.
-    const float volumeCorrection    = scale * vortonVolume / cellVolume ;
+        const unsigned  offset  = rLayer.OffsetFromIndices( indicesVisited ) ;
+        Vorton          vorton = rLayer[ offset ] ;
+        // With this technique, we want to calculate the velocity due to siblings of this vorton
+        // (not due to this vorton itself).
+        vorton.mPosition  = vorton.mPositionSiblings ;
+        ASSERT( ! IsNan( vorton.mPosition ) && ! IsInf( vorton.mPosition ) ) ;
 
-    // Make sure vorton radius has not changed.  This simulation code assumes vorton radius is both uniform and constant.
-    ASSERT( mVortons->empty() || Math::Resembles( vortonVolume , (*mVortons)[ 0 ].GetVolume() ) ) ;
+        vorton.SetVorticity( vorton.mVorticitySiblings ) ;
 
-    // Populate vorticity grid.
-    const size_t numVortons = mVortons->Size() ;
-    for( size_t uVorton = 0 ; uVorton < numVortons ; ++ uVorton )
-    {   // For each vorton in this simulation...
-        const Vorton     &  rVorton     = (*mVortons)[ uVorton ] ;
-        const Vec3       &  rPosition   = rVorton.mPosition   ;
-        ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
-        DEBUG_ONLY( const unsigned      uOffset     = vorticityGrid.OffsetOfPosition( rPosition ) ) ;
-        ASSERT( uOffset < vorticityGrid.GetGridCapacity() ) ;
+ASSERT( ( 0.0f == vorton.GetRadius() ) || ( vorton.GetRadius() == vortonRadius ) ) ; // This will probably end up changing.
+        //vorton.SetRadius( vorton.mRadiusSiblings ) ;
 
-        // Note that the use of a uniform volumeCorrection here
-        // assumes that all vortons have the same volume.
-        Vec3 vCirculationCorrectedVorticity = rVorton.GetVorticity() * volumeCorrection ;
-        vorticityGrid.Accumulate( rPosition , vCirculationCorrectedVorticity ) ;
+// Experimental: Estimate cluster radius based on level in influence tree, and adjust vorticity accordingly (to preserve total circulation)
+vorton.SetRadius( clusterRadius ) ;
+const float vorticityReduction = vortonRadius / clusterRadius ;
+ASSERT( vorticityReduction <= 1.0f ) ;
+vorton.SetVorticity( vorton.mVorticitySiblings * Pow3( vorticityReduction ) ) ;
 
-        DEBUG_ONLY( vCirculationToGrid  += vCirculationCorrectedVorticity * cellVolume ) ;
-        DEBUG_ONLY( vCirculationVortons += rVorton.GetVorticity() * vortonVolume ) ;
+        // Compute velocity induced by this supervorton.
+        // Accumulate influence, storing in velocityAccumulator.
+        VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , vorton ) ;
+        ASSERT( ! IsInf( velocityAccumulator ) ) ;
+ASSERT( FAbs( velocityAccumulator.x ) < 1000.0f ) ; // DO NOT SUBMIT. heuristic, not always correct
 
-        // Make sure vorton radius is uniform and constant.
-        ASSERT( Math::Resembles( vortonVolume , rVorton.GetVolume() ) ) ;
-    }
+        DEBUG_ONLY( numVortonsEncountered   += vorton.mNumSibVortonsIncorporated ) ;
+        DEBUG_ONLY( vVorticityEncountered   += vorton.GetVorticity() ) ;
+        ASSERT( ( vorton.GetVorticity().Mag3() < 1.0e-8f ) || ( vorton.mSize > 0.0f ) ) ;
+        DEBUG_ONLY( vCirculationEncountered += vorton.GetVorticity() * Pow3( vorton.GetRadius() ) ) ;
 
-#if defined( _DEBUG )
-    {
-        Vec3 vCirculationGrid( 0.0f , 0.0f , 0.0f ) ;
-        for( unsigned offset = 0 ; offset < vorticityGrid.GetGridCapacity() ; ++ offset )
-        {   // For each cell in vorticity grid...
-            vCirculationGrid += vorticityGrid[ offset ] * cellVolume ;
+        // Compute indices into parent layer
+        influenceTree.GetParentIndices( indicesVisited , indicesVisited , uLayer + 1 ) ;
+        #if 0 && defined( _DEBUG )
+        {
+            unsigned indicesParentTest[4] ;
+            influenceTree[ uLayer + 1 ].IndicesOfPosition( indicesParentTest , vPosition ) ;
+            ASSERT( indicesParentTest[0] == indicesVisited[0] ) ;
+            ASSERT( indicesParentTest[1] == indicesVisited[1] ) ;
+            ASSERT( indicesParentTest[2] == indicesVisited[2] ) ;
         }
-// DO NOT SUBMIT commented out
-        //ASSERT( vCirculationVortons.Resembles( scale * vCirculationGrid , 0.01f ) ) ;
+        #endif
+    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
+        ASSERT( ( vorton.mIndicesOfParent[0] == 0x7fffffff ) || ( vorton.mIndicesOfParent[0] == indicesVisited[0] ) ) ;
+        ASSERT( ( vorton.mIndicesOfParent[1] == 0x7fffffff ) || ( vorton.mIndicesOfParent[1] == indicesVisited[1] ) ) ;
+        ASSERT( ( vorton.mIndicesOfParent[2] == 0x7fffffff ) || ( vorton.mIndicesOfParent[2] == indicesVisited[2] ) ) ;
+    #endif
+
+        clusterRadius *= 1.4142135623730950488016887242097f ; // Experimental: Estimate cluster radius based on level in influence tree
     }
-#endif
+
+    ASSERT( mVortons->Size() == numVortonsEncountered ) ;
+    ASSERT( vCirculationEncountered.Resembles( mTotalCirculation ) ) ;
+    //DEBUG_ONLY( printf( "nv[%3i,%3i,%3i]= %u\n" , indices[0] , indices[1], indices[2] , numVortonsEncountered ) ) ;
+
+    return velocityAccumulator ;
 }
+#endif
 
 
 
 
-/** Compute velocity due to vortons, for every point in a uniform grid, using an integral technique (direct summation, treecode or multipole method).
+/** Return whether the given index along one axis lies on the coarse lattice with the given stride.
 
-    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons in a vicinity.
+    The coarse lattice has every stride'th index, and always the last, so it spans the whole axis.
+*/
+static inline bool IsCoarseIndex( unsigned index , unsigned numPoints , unsigned stride )
+{
+    return ( 0 == ( index % stride ) ) || ( numPoints - 1 == index ) ;
+}
 
-    \param influenceTree        Nested grid of vortons and "super-vortons", used to compute velocity-from-vorticity using treecode.
 
-    \see CreateInfluenceTree
 
-    \note This routine assumes CreateInfluenceTree has already executed.
 
+/** Partition boundary gridpoints into those on the coarse lattice with the given stride, and the rest.
+
+    \param nodeOffsets          (out) Offsets of boundary gridpoints whose indices all lie on the coarse lattice.
+
+    \param interpolatedOffsets  (out) Offsets of other boundary gridpoints.
 */
-void VortonSim::ComputeVelocityFromVorticity_Integral( const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+static void GatherBoundaryGridpoints( VECTOR< unsigned > & nodeOffsets , VECTOR< unsigned > & interpolatedOffsets , const UniformGridGeometry & grid , unsigned stride )
 {
-    PERF_BLOCK( VortonSim__ComputeVelocityFromVorticity_Integral ) ;
+    const unsigned  dims[3] = { grid.GetNumPoints( 0 ) , grid.GetNumPoints( 1 ) , grid.GetNumPoints( 2 ) } ;
+    nodeOffsets.Clear() ;
+    interpolatedOffsets.Clear() ;
+
+    unsigned idx[ 3 ] ;
+    for( idx[2] = 0 ; idx[2] < dims[2] ; ++ idx[2] )
+    {   // For each z index...
+        const bool topOrBottom = ( 0 == idx[2] ) || ( dims[2]-1 == idx[2] ) ;
+        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
+        {   // For each y index...
+            const bool      frontOrBack = ( 0 == idx[1] ) || ( dims[1]-1 == idx[1] ) ;
+            const unsigned  incX        = ( topOrBottom || frontOrBack ) ? 1 : Max2( dims[0] - 1 , 1U ) ;
+            for( idx[0] = 0 ; idx[0] < dims[0] ; idx[0] += incX )
+            {   // For each boundary gridpoint along the x-axis...
+                const unsigned offset = idx[0] + dims[0] * ( idx[1] + dims[1] * idx[2] ) ;
+                if(     IsCoarseIndex( idx[0] , dims[0] , stride )
+                    &&  IsCoarseIndex( idx[1] , dims[1] , stride )
+                    &&  IsCoarseIndex( idx[2] , dims[2] , stride ) )
+                {
+                    nodeOffsets.PushBack( offset ) ;
+                }
+                else
+                {
+                    interpolatedOffsets.PushBack( offset ) ;
+                }
+            }
+        }
+    }
+}
+
+
+
+
+/** Interpolate vector potential at a boundary gridpoint from coarse lattice nodes on one face that contains it.
+
+    \param vectorPotentialGrid  Grid whose coarse boundary nodes have values.
+
+    \param indices  Indices of boundary gridpoint.
+
+    \param stride   Spacing of coarse lattice.
+
+    \return Bilinear interpolation, across the face, of the 4 surrounding nodes.
+            Gridpoints on an edge get the same value from either face, since both interpolate linearly along the edge.
+*/
+static Vec3 InterpolateBoundaryVectorPotential( const UniformGrid< Vec3 > & vectorPotentialGrid , const unsigned indices[3] , unsigned stride )
+{
+    const unsigned  dims[3] = { vectorPotentialGrid.GetNumPoints( 0 ) , vectorPotentialGrid.GetNumPoints( 1 ) , vectorPotentialGrid.GetNumPoints( 2 ) } ;
+    unsigned        lo[3] , hi[3] ;
+    float           tween[3] ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis, find bracketing coarse indices.
+        lo[ axis ]      = ( indices[ axis ] / stride ) * stride ;
+        hi[ axis ]      = Min2( lo[ axis ] + stride , dims[ axis ] - 1 ) ;
+        tween[ axis ]   = ( hi[ axis ] > lo[ axis ] ) ? float( indices[ axis ] - lo[ axis ] ) / float( hi[ axis ] - lo[ axis ] ) : 0.0f ;
+    }
+
+    // Pin the axis of a face containing this gridpoint, so interpolation uses only nodes on that face.
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {
+        if( ( 0 == indices[ axis ] ) || ( dims[ axis ] - 1 == indices[ axis ] ) )
+        {
+            lo[ axis ] = hi[ axis ] = indices[ axis ] ;
+            tween[ axis ] = 0.0f ;
+            break ;
+        }
+    }
+
+    Vec3 result( 0.0f , 0.0f , 0.0f ) ;
+    for( unsigned corner = 0 ; corner < 8 ; ++ corner )
+    {   // For each corner of bracketing cell (which has zero extent along the face axis)...
+        float       weight = 1.0f ;
+        unsigned    cornerIndices[3] ;
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {
+            const bool upper = 0 != ( corner & ( 1 << axis ) ) ;
+            cornerIndices[ axis ] = upper ? hi[ axis ] : lo[ axis ] ;
+            weight *= upper ? tween[ axis ] : 1.0f - tween[ axis ] ;
+        }
+        if( weight != 0.0f )
+        {
+            result += vectorPotentialGrid[ cornerIndices[0] + dims[0] * ( cornerIndices[1] + dims[1] * cornerIndices[2] ) ] * weight ;
+        }
+    }
+    return result ;
+}
+
+
+
+
+/** Compute vector potential at a given point in space, due to vortons, using the compile-time vector potential technique.
+*/
+Vec3 VortonSim::ComputeVectorPotentialAtPosition( const Vec3 & vPosition , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+#if VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_DIRECT
+    UNUSED_PARAM( influenceTree ) ;
+    UNUSED_PARAM( vortonIndicesGrid ) ;
+    return ComputeVectorPotential_Direct( vPosition ) ;
+#elif VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE
+    const size_t numLayers = influenceTree.GetDepth() ;
+    if( numLayers > 1 )
+    {
+        static const unsigned zeros[3] = { 0 , 0 , 0 } ; /* Starter indices for recursive algorithm */
+        return ComputeVectorPotential_Tree( vPosition , zeros , numLayers - 1 , vortonIndicesGrid , influenceTree ) ;
+    }
+    return ComputeVectorPotential_Direct( vPosition ) ;
+#else
+#   error Vector potential technique is invalid or undefined.  Assign VECTOR_POTENTIAL_TECHNIQUE in vorton.h or change this code.
+#endif
+}
+
+
+
+
+/** Compute vector potential due to vortons, for a subset of points in a uniform grid.
+
+    \param izStart  Starting value for z index
+
+    \param izEnd    One past ending value for z index
+
+    \param boundariesOnly   Compute vector potential only on domain boundaries.
+                            If false, compute throughout domain interior.
+
+    \note This routine assumes CreateInfluenceTree has already executed,
+            and that the vector potential grid has been allocated.
+
+*/
+void VortonSim::ComputeVectorPotentialAtGridpoints_Slice( bool boundariesOnly , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t izStart , size_t izEnd )
+{
+#if VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE
+    const size_t            numLayers               = influenceTree.GetDepth() ;
+#endif
+
+    UniformGrid< Vec3 > &   vectorPotentialGrid     = mVectorPotentialMultiGrid[ 0 ] ;
+
+    const Vec3 &            vMinCorner              = mVelGrid.GetMinCorner() ;
+    static const float      nudge                   = 1.0f - 2.0f * FLT_EPSILON ;   // Slightly shrink coordinate spacing to avoid roundoff from exceeding domain (and from having a conditional branch per iteration).
+    const Vec3              vSpacing                = mVelGrid.GetCellSpacing() * nudge ;
+    const unsigned          dims[3]                 =   { mVelGrid.GetNumPoints( 0 )
+                                                        , mVelGrid.GetNumPoints( 1 )
+                                                        , mVelGrid.GetNumPoints( 2 ) } ;
+    const unsigned          numXY                   = dims[0] * dims[1] ;
+    unsigned                idx[ 3 ] ;
+    const unsigned          incrementXForInterior   = boundariesOnly ? ( dims[0] - 1 ) : 1 ;
+
+    // Compute fluid flow vector potential at each boundary gridpoint, due to all vortons.
+    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
+    {   // For subset of z index values...
+        Vec3 vPosition ;
+        vPosition.z = vMinCorner.z + float( idx[2] ) * vSpacing.z ;                 // Compute z-coordinate of world-space position of current gridpoint.
+        const unsigned  offsetZ     = idx[2] * numXY ;                              // Precompute z contribution to offset into grid.
+        const bool      topOrBottom = ( 0 == idx[2] ) || ( dims[2]-1 == idx[2] ) ;  // Whether current gridpoint is on top (+Z) or bottom (-Z) plane
+        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
+        {   // For every gridpoint along the y-axis...
+            vPosition.y = vMinCorner.y + float( idx[1] ) * vSpacing.y ;                                 // Compute y-coordinate of world-space position of current gridpoint.
+            const unsigned  offsetYZ    = idx[1] * dims[0] + offsetZ ;                                  // Precompute y contribution to the offset into grid.
+            const bool      frontOrBack = ( 0 == idx[1] ) || ( dims[1]-1 == idx[1] ) ;                  // Whether current gridpoint is on front (+Y) or back (-Y) plane
+            const unsigned  incX        = ( topOrBottom || frontOrBack ) ? 1 : incrementXForInterior ;  // For points other than top|bottom|front|back, skip interior gridpoints.
+            for( idx[0] = 0 ; idx[0] < dims[0] ; idx[0] += incX )
+            {   // For every gridpoint along the x-axis...
+                vPosition.x = vMinCorner.x + float( idx[0] ) * vSpacing.x ; // Compute x-coordinate of world-space position of current gridpoint.
+                const unsigned offsetXYZ = idx[0] + offsetYZ ;              // Compute offset into grid for current point
+
+#               if VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_DIRECT
+
+                    UNUSED_PARAM( influenceTree ) ;
+                    UNUSED_PARAM( vortonIndicesGrid ) ;
+
+                    vectorPotentialGrid[ offsetXYZ ] = ComputeVectorPotential_Direct( vPosition ) ;
+
+#               elif VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE
+
+#                   if ! USE_TBB
+#                       define CHECK_BULK_VORTICITY_SELF_CONSISTENCY()                                                                              \
+                        {                                                                                                                           \
+                            ASSERT( mVortons->Size() == sNumVortonsEncounteredInTree ) ;                                                            \
+                            ASSERT( sCirculationEncounteredInTree.Resembles( mDiagnosticIntegrals.mAfterAdvect.mTotalCirculation , 1.0e-3f ) ) ;    \
+                        }
+#                   else
+#                       define CHECK_BULK_VORTICITY_SELF_CONSISTENCY() ;
+#                   endif
+
+                    if( 0 == ( idx[0] & 1 ) )
+                    {   // Even x indices.  Compute value.
+                        DEBUG_ONLY( sNumVortonsEncounteredInTree  = 0 ) ;
+                        DEBUG_ONLY( sVorticityEncounteredInTree   = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+                        DEBUG_ONLY( sCirculationEncounteredInTree = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+                        static const unsigned zeros[3] = { 0 , 0 , 0 } ; /* Starter indices for recursive algorithm */
+                        if( numLayers > 1 )
+                        {
+                            vectorPotentialGrid[ offsetXYZ ] = ComputeVectorPotential_Tree( vPosition , zeros , numLayers - 1 , vortonIndicesGrid , influenceTree ) ;
+                            CHECK_BULK_VORTICITY_SELF_CONSISTENCY() ;
+                        }
+                        else
+                        {
+                            vectorPotentialGrid[ offsetXYZ ] = ComputeVectorPotential_Direct( vPosition ) ;
+                        }
+                    }
+                    else
+                    {   // Odd x indices. Copy value from preceding grid point.
+                        vectorPotentialGrid[ offsetXYZ ] = vectorPotentialGrid[ offsetXYZ - 1 ] ;
+                    }
+
+#               else
+#                   error Vector potential technique is invalid or undefined.  Assign VECTOR_POTENTIAL_TECHNIQUE in vorton.h or change this code.
+#               endif
+
+            }
+        }
+    }
+}
+
+
+
+
+/** Compute vector potential due to vortons, for a subset of coarse boundary gridpoints.
+
+    \param iNodeBegin   Index, into mBoundaryNodeOffsets, of first gridpoint to compute.
+
+    \param iNodeEnd     One past index of last gridpoint to compute.
+*/
+void VortonSim::ComputeVectorPotentialAtBoundaryNodes_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iNodeBegin , size_t iNodeEnd )
+{
+    UniformGrid< Vec3 > &   vectorPotentialGrid     = mVectorPotentialMultiGrid[ 0 ] ;
+    const Vec3 &            vMinCorner              = mVelGrid.GetMinCorner() ;
+    static const float      nudge                   = 1.0f - 2.0f * FLT_EPSILON ;   // Match ComputeVectorPotentialAtGridpoints_Slice.
+    const Vec3              vSpacing                = mVelGrid.GetCellSpacing() * nudge ;
+
+    for( size_t iNode = iNodeBegin ; iNode < iNodeEnd ; ++ iNode )
+    {   // For each boundary node in this slice...
+        const unsigned  offset = mBoundaryNodeOffsets[ iNode ] ;
+        unsigned        indices[3] ;
+        mVelGrid.IndicesFromOffset( indices , offset ) ;
+        const Vec3      vPosition( vMinCorner.x + float( indices[0] ) * vSpacing.x
+                                 , vMinCorner.y + float( indices[1] ) * vSpacing.y
+                                 , vMinCorner.z + float( indices[2] ) * vSpacing.z ) ;
+        vectorPotentialGrid[ offset ] = ComputeVectorPotentialAtPosition( vPosition , vortonIndicesGrid , influenceTree ) ;
+    }
+}
+
+
+
+
+/** Compute vector potential due to vortons on domain boundaries, evaluating a coarse lattice and interpolating the rest.
+
+    Vector potential varies smoothly on domain boundaries, which lie away
+    from most vorticity, so bilinear interpolation across each face, from
+    every mBoundaryInterpolationStride'th gridpoint, suffices for most of
+    them.  That reduces the number of integral evaluations by about the
+    square of the stride.
+
+    To bound error, this compares interpolated values against integral
+    evaluations at a few sample gridpoints, and if their error, relative
+    to the largest boundary value, exceeds mBoundaryInterpolationTolerance,
+    halves the stride and repeats.  When error falls well below the
+    tolerance, the next update tries double the stride.  Interpolation error
+    varies roughly as the square of the stride, so that usually keeps the
+    stride steady.
+*/
+void VortonSim::ComputeBoundaryVectorPotential_Interpolated( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__ComputeBoundaryVectorPotential_Interpolated ) ;
+
+    UniformGrid< Vec3 > &   vectorPotentialGrid     = mVectorPotentialMultiGrid[ 0 ] ;
+    const Vec3 &            vMinCorner              = mVelGrid.GetMinCorner() ;
+    static const float      nudge                   = 1.0f - 2.0f * FLT_EPSILON ;   // Match ComputeVectorPotentialAtGridpoints_Slice.
+    const Vec3              vSpacing                = mVelGrid.GetCellSpacing() * nudge ;
+
+    mBoundaryInterpolationStride = Max2( mBoundaryInterpolationStride , 1U ) ;
+    for( ;; )
+    {   // Until interpolation meets tolerance...
+        GatherBoundaryGridpoints( mBoundaryNodeOffsets , mBoundaryInterpolatedOffsets , mVelGrid , mBoundaryInterpolationStride ) ;
+
+        // Evaluate coarse lattice.
+        const size_t numNodes = mBoundaryNodeOffsets.Size() ;
+        Parallel::For( 0 , numNodes , Parallel::GetGrainSize( numNodes ) , Parallel::Method( this , & VortonSim::ComputeVectorPotentialAtBoundaryNodes_Slice , vortonIndicesGrid , influenceTree ) ) ;
+
+        float nodeMag2Max = 0.0f ;
+        for( size_t iNode = 0 ; iNode < numNodes ; ++ iNode )
+        {   // For each boundary node...
+            nodeMag2Max = Max2( nodeMag2Max , vectorPotentialGrid[ mBoundaryNodeOffsets[ iNode ] ].Mag2() ) ;
+        }
+
+        // Interpolate the rest.
+        const size_t numInterpolated = mBoundaryInterpolatedOffsets.Size() ;
+        for( size_t iInterp = 0 ; iInterp < numInterpolated ; ++ iInterp )
+        {   // For each boundary gridpoint not on coarse lattice...
+            const unsigned  offset = mBoundaryInterpolatedOffsets[ iInterp ] ;
+            unsigned        indices[3] ;
+            mVelGrid.IndicesFromOffset( indices , offset ) ;
+            vectorPotentialGrid[ offset ] = InterpolateBoundaryVectorPotential( vectorPotentialGrid , indices , mBoundaryInterpolationStride ) ;
+        }
+
+        // Measure interpolation error at samples spread evenly through interpolated gridpoints.
+        const size_t    numSamples  = Min2( sBoundaryInterpolationNumErrorSamples , numInterpolated ) ;
+        float           errorMag2Max = 0.0f ;
+        for( size_t iSample = 0 ; iSample < numSamples ; ++ iSample )
+        {   // For each sample...
+            const unsigned  offset = mBoundaryInterpolatedOffsets[ ( 2 * iSample + 1 ) * numInterpolated / ( 2 * numSamples ) ] ;
+            unsigned        indices[3] ;
+            mVelGrid.IndicesFromOffset( indices , offset ) ;
+            const Vec3      vPosition( vMinCorner.x + float( indices[0] ) * vSpacing.x
+                                     , vMinCorner.y + float( indices[1] ) * vSpacing.y
+                                     , vMinCorner.z + float( indices[2] ) * vSpacing.z ) ;
+            const Vec3      evaluated = ComputeVectorPotentialAtPosition( vPosition , vortonIndicesGrid , influenceTree ) ;
+            errorMag2Max = Max2( errorMag2Max , ( vectorPotentialGrid[ offset ] - evaluated ).Mag2() ) ;
+            vectorPotentialGrid[ offset ] = evaluated ; // Might as well use the better value.
+        }
+        mBoundaryInterpolationError = ( nodeMag2Max > 0.0f ) ? sqrtf( errorMag2Max / nodeMag2Max ) : 0.0f ;
+
+        if( ( mBoundaryInterpolationError <= mBoundaryInterpolationTolerance ) || ( 1 == mBoundaryInterpolationStride ) )
+        {   // Met tolerance, or evaluated every boundary gridpoint.
+            break ;
+        }
+        mBoundaryInterpolationStride /= 2 ;
+    }
+
+    if( ( mBoundaryInterpolationError * 8.0f < mBoundaryInterpolationTolerance ) && ( mBoundaryInterpolationStride < sBoundaryInterpolationMaxStride ) )
+    {   // Error has ample margin.  Next update, try a coarser lattice.
+        mBoundaryInterpolationStride *= 2 ;
+    }
+}
+
+
+
+
+/** Compute vector potential due to vortons, for every point in a uniform grid, using an integral technique (direct summation, treecode or multipole method).
+
+    \param boundariesOnly       Compute vector potential only on domain boundaries.
+                                If mBoundaryInterpolationTolerance is positive, this interpolates most of them.
+                                See ComputeBoundaryVectorPotential_Interpolated.
+
+    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons in a vicinity.
+
+    \param influenceTree        Nested grid of vortons and "super-vortons", used to compute velocity-from-vorticity using treecode.
+
+    \see CreateInfluenceTree
+
+    \note This routine assumes CreateInfluenceTree has already executed.
+
+*/
+void VortonSim::ComputeVectorPotentialFromVorticity_Integral( bool boundariesOnly , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__ComputeVectorPotentialFromVorticity_Integral ) ;
 
     ASSERT( ! mVortons->empty() ) ;
 
@@ -2476,344 +3523,3734 @@ void VortonSim::ComputeVelocityFromVorticity_Integral( const UniformGrid< VECTOR
     }
     #endif
 
-#if COMPUTE_VELOCITY_AT_VORTONS
-    const size_t numVortons = mVortons->size() ;
-    // Compute velocity at vortons.
-    // This is only useful for diagnosing integral solvers.  Otherwise, compute velocity on the grid.
-    #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
-        // Compute velocity at vortons using multiple threads.
-        parallel_for( tbb::blocked_range<size_t>( 0 , numVortons , grainSize ) , VortonSim_ComputeVelocityAtVortons_TBB( this , vortonIndicesGrid , influenceTree ) ) ;
-    #else
-        ComputeVelocityAtVortons_Slice( 0 , numVortons , vortonIndicesGrid , influenceTree ) ;
-    #endif
-    // Transfer velocity from vortons to grid.
-    PopulateVelocityGrid( mVelGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) ) ;
-#else   // Compute velocity at gridpoints.
+//#if COMPUTE_VELOCITY_AT_VORTONS
+//    const size_t numVortons = mVortons->size() ;
+//    // Compute velocity at vortons.
+//    // This is only useful for diagnosing integral solvers.  Otherwise, compute velocity on the grid.
+//    #if USE_TBB
+//        // Estimate grain size based on size of problem and number of processors.
+//        const size_t grainSize =  Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
+//        // Compute velocity at vortons using multiple threads.
+//        Parallel::For( 0 , numVortons , grainSize , Parallel::Method( this , & VortonSim::ComputeVelocityAtVortons_Slice , vortonIndicesGrid , influenceTree ) ) ;
+//    #else
+//        ComputeVectorPotentialAtVortons_Slice( 0 , numVortons , vortonIndicesGrid , influenceTree ) ;
+//    #endif
+//    // Transfer velocity from vortons to grid.
+//    PopulateVectorPotentialGrid( mVelGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) ) ;
+//#else   // Compute velocity at gridpoints.
+    if( boundariesOnly && ( mBoundaryInterpolationTolerance > 0.0f ) )
+    {
+        ComputeBoundaryVectorPotential_Interpolated( vortonIndicesGrid , influenceTree ) ;
+        return ;
+    }
+
     const unsigned numZ = mVelGrid.GetNumPoints( 2 ) ;
-    #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , numZ / gNumberOfProcessors ) ;
-        // Compute velocity at gridpoints using multiple threads.
-        parallel_for( tbb::blocked_range<size_t>( 0 , numZ , grainSize ) , VortonSim_ComputeVelocityAtGridpoints_TBB( this , vortonIndicesGrid , influenceTree ) ) ;
+#   if USE_TBB
+        if( boundariesOnly )
+        {   // Only boundary slices cost much, so weighting by vortons would not help; split evenly.
+            Parallel::For( 0 , numZ , Parallel::GetGrainSize( numZ ) , Parallel::Method( this , & VortonSim::ComputeVectorPotentialAtGridpoints_Slice , boundariesOnly , vortonIndicesGrid , influenceTree ) ) ;
+        }
+        else
+        {   // Split slices by estimated cost, and compute vector potential at gridpoints using multiple threads.
+            PartitionVelocityGridSlices( vortonIndicesGrid ) ;
+            Parallel::ForWeighted( mVelocityGridSlicePartition , Parallel::Method( this , & VortonSim::ComputeVectorPotentialAtGridpoints_Slice , boundariesOnly , vortonIndicesGrid , influenceTree ) , mAffinityPartitioners[ PARALLEL_LOOP_VECTOR_POTENTIAL_AT_GRIDPOINTS ] ) ;
+        }
+#   else
+        ComputeVectorPotentialAtGridpoints_Slice( boundariesOnly , vortonIndicesGrid , influenceTree , 0 , numZ ) ;
+#   endif
+//#endif
+}
+
+
+
+
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+/** Compute fast multipole local expansions for a subset of cells in one layer.
+
+    \param iLayer - index of influence tree layer whose cells to process.
+                    Must be positive and less than the root layer index.
+
+    \param influenceTree - Nested grid of vortons and supervortons, whose
+                    supervortons serve as monopole multipole expansions.
+
+    \param izStart - starting value for z index of cells
+
+    \param izEnd - one past ending value for z index of cells
+
+    This performs the L2L (translate parent local expansion into child) and
+    M2L (translate multipoles into local expansion) operations for each cell
+    of the given layer.  The interaction list of a cell consists of the
+    children of its parent's neighbors which are not themselves neighbors
+    of the cell.  Sources farther away are already in the parent expansion;
+    sources nearer are handled by the next finer layer.
+
+    \note This routine assumes local expansions of the parent layer already have their final values.
+
+    \see ComputeFmmLocalExpansions, ComputeVelocity_Fmm
+
+*/
+void VortonSim::ComputeFmmLocalExpansionsSlice( size_t iLayer , const NestedGrid< Vorton > & influenceTree , size_t izStart , size_t izEnd )
+{
+    PERF_BLOCK_INNER( VortonSim__ComputeFmmLocalExpansionsSlice ) ;
+
+    ASSERT( iLayer > 0 ) ;
+    ASSERT( iLayer + 1 < influenceTree.GetDepth() ) ;
+
+    const UniformGrid< Vorton > &                   rSourceLayer    = influenceTree[ iLayer ] ;
+    UniformGrid< VortonFmmLocalExpansion > &        rLocalLayer     = mFmmLocalExpansions[ iLayer - 1 ] ;
+    const UniformGrid< VortonFmmLocalExpansion > &  rParentLayer    = mFmmLocalExpansions[ iLayer ] ;
+    const unsigned * const                          pClusterDims    = influenceTree.GetDecimations( iLayer + 1 ) ;
+    const unsigned          numCells[3]         = { rLocalLayer.GetNumCells( 0 ) , rLocalLayer.GetNumCells( 1 ) , rLocalLayer.GetNumCells( 2 ) } ;
+    const unsigned          numParentCells[3]   = { rParentLayer.GetNumCells( 0 ) , rParentLayer.GetNumCells( 1 ) , rParentLayer.GetNumCells( 2 ) } ;
+    const unsigned          numX                = rLocalLayer.GetNumPoints( 0 ) ;
+    const unsigned          numXY               = numX * rLocalLayer.GetNumPoints( 1 ) ;
+    const unsigned          numXParent          = rParentLayer.GetNumPoints( 0 ) ;
+    const unsigned          numXYParent         = numXParent * rParentLayer.GetNumPoints( 1 ) ;
+    const Vec3              vCenterOffset       = rLocalLayer.GetMinCorner() + 0.5f * rLocalLayer.GetCellSpacing() ;
+    const Vec3              vParentCenterOffset = rParentLayer.GetMinCorner() + 0.5f * rParentLayer.GetCellSpacing() ;
+    const Vec3 &            vSpacing            = rLocalLayer.GetCellSpacing() ;
+    const Vec3 &            vParentSpacing      = rParentLayer.GetCellSpacing() ;
+
+    unsigned idx[3] ;
+    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
+    {
+        for( idx[1] = 0 ; idx[1] < numCells[1] ; ++ idx[1] )
+        {
+            for( idx[0] = 0 ; idx[0] < numCells[0] ; ++ idx[0] )
+            {   // For each cell in this layer...
+                unsigned idxParent[3] ;
+                unsigned sourceBegin[3] ;
+                unsigned sourceEnd[3] ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // Find parent cell and range of cells under parent's neighbors.
+                    idxParent[ axis ] = Min2( idx[ axis ] / pClusterDims[ axis ] , numParentCells[ axis ] - 1 ) ;
+                    const unsigned neighborBegin = ( idxParent[ axis ] > 0 ) ? idxParent[ axis ] - 1 : 0 ;
+                    const unsigned neighborEnd   = Min2( idxParent[ axis ] + 2 , numParentCells[ axis ] ) ;
+                    sourceBegin[ axis ] = neighborBegin * pClusterDims[ axis ] ;
+                    sourceEnd  [ axis ] = Min2( neighborEnd * pClusterDims[ axis ] , numCells[ axis ] ) ;
+                }
+
+                const Vec3 vCenter( vCenterOffset.x + float( idx[0] ) * vSpacing.x
+                                  , vCenterOffset.y + float( idx[1] ) * vSpacing.y
+                                  , vCenterOffset.z + float( idx[2] ) * vSpacing.z ) ;
+                const Vec3 vParentCenter( vParentCenterOffset.x + float( idxParent[0] ) * vParentSpacing.x
+                                        , vParentCenterOffset.y + float( idxParent[1] ) * vParentSpacing.y
+                                        , vParentCenterOffset.z + float( idxParent[2] ) * vParentSpacing.z ) ;
+
+                // L2L: Inherit influence of sources far from parent.
+                VortonFmmLocalExpansion & rLocal = rLocalLayer[ idx[0] + idx[1] * numX + idx[2] * numXY ] ;
+                rLocal.AssignFromParent( rParentLayer[ idxParent[0] + idxParent[1] * numXParent + idxParent[2] * numXYParent ] , vCenter - vParentCenter ) ;
+
+                // M2L: Accumulate influence of interaction list.
+                unsigned idxSource[3] ;
+                for( idxSource[2] = sourceBegin[2] ; idxSource[2] < sourceEnd[2] ; ++ idxSource[2] )
+                {
+                    const bool farZ = ( idxSource[2] + 1 < idx[2] ) || ( idxSource[2] > idx[2] + 1 ) ;
+                    for( idxSource[1] = sourceBegin[1] ; idxSource[1] < sourceEnd[1] ; ++ idxSource[1] )
+                    {
+                        const bool farYZ = farZ || ( idxSource[1] + 1 < idx[1] ) || ( idxSource[1] > idx[1] + 1 ) ;
+                        for( idxSource[0] = sourceBegin[0] ; idxSource[0] < sourceEnd[0] ; ++ idxSource[0] )
+                        {
+                            const bool farXYZ = farYZ || ( idxSource[0] + 1 < idx[0] ) || ( idxSource[0] > idx[0] + 1 ) ;
+                            if( ! farXYZ )
+                            {   // Source cell is adjacent to this cell.  Next finer layer handles it.
+                                continue ;
+                            }
+                            const Vorton & rSupervorton = rSourceLayer[ idxSource[0] + idxSource[1] * numX + idxSource[2] * numXY ] ;
+                            if( rSupervorton.mSize != 0.0f )
+                            {   // Source cell contains vorticity.
+                                VortonAccumulateLocalExpansion( rLocal , vCenter , rSupervorton.mPosition , rSupervorton.mAngularVelocity , rSupervorton.mSize , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+
+
+/** Compute fast multipole local expansions for every layer of the influence tree except its leaves.
+
+    \param influenceTree - Nested grid of vortons and supervortons.
+
+    AggregateClusters already performed the upward pass (P2M and M2M),
+    with each supervorton acting as the monopole expansion of its cell.
+    This routine performs the downward pass, from root to leaves.
+    Each layer depends on its parent, so layers run in sequence,
+    but cells within a layer are independent, so they run in parallel.
+
+    The leaf layer needs no stored expansion: ComputeVelocity_Fmm
+    evaluates leaf interactions directly at each gridpoint, using leaf
+    supervortons for its interaction list and member vortons for its near field.
+
+    \note This routine assumes CreateInfluenceTree has already executed.
+
+*/
+void VortonSim::ComputeFmmLocalExpansions( const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__ComputeFmmLocalExpansions ) ;
+
+    const size_t numLayers = influenceTree.GetDepth() ;
+    if( numLayers < 2 )
+    {   // Tree has only leaves, which ComputeVelocityAtGridpoints_Slice evaluates using direct summation.
+        mFmmLocalExpansions.Clear() ;
+        return ;
+    }
+
+    // Local expansion layer i corresponds to influence tree layer i+1.
+    // Initialize assigns zero to all expansions, which is correct for the root.
+    mFmmLocalExpansions.Initialize( influenceTree[ 1 ] ) ;
+    ASSERT( mFmmLocalExpansions.GetDepth() == numLayers - 1 ) ;
+
+    for( size_t iLayer = numLayers - 2 ; iLayer > 0 ; -- iLayer )
+    {   // For each non-root, non-leaf layer, from coarse to fine...
+        const unsigned numZ = mFmmLocalExpansions[ iLayer - 1 ].GetNumCells( 2 ) ;
+        Parallel::For( 0 , numZ , Parallel::GetGrainSize( numZ ) , Parallel::Method( this , & VortonSim::ComputeFmmLocalExpansionsSlice , iLayer , influenceTree ) ) ;
+    }
+}
+
+
+
+
+/** Compute velocity at a given gridpoint, due to influence of vortons, using the fast multipole method.
+
+    \param vPosition - point in space whose velocity to evaluate
+
+    \param indices - indices of gridpoint at vPosition
+
+    \param vortonIndicesGrid - Spatial partition of vortons, with the same shape as the leaf layer of influenceTree.
+
+    \param influenceTree - Nested grid of vortons and supervortons.
+
+    \return velocity at vPosition, due to influence of vortons
+
+    Leaf cells adjacent to the leaf cell of this gridpoint form its near
+    field, where a supervorton poorly represents the vortons it aggregates,
+    so this sums the vortons in those cells individually.  Other leaf cells
+    under the parent's neighbors form the leaf interaction list, which this
+    sums as supervortons.
+
+    \note This routine assumes ComputeFmmLocalExpansions has already executed.
+
+    \note This routine has time complexity O(1) per gridpoint, hence O(N) overall.
+
+*/
+Vec3 VortonSim::ComputeVelocity_Fmm( const Vec3 & vPosition , const unsigned indices[3] , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    ASSERT( influenceTree.GetDepth() > 1 ) ;
+    ASSERT( vortonIndicesGrid.ShapeMatches( influenceTree[ 0 ] ) ) ;
+
+    const UniformGrid< Vorton > &                   rLeafLayer      = influenceTree[ 0 ] ;
+    const UniformGrid< VortonFmmLocalExpansion > &  rParentLayer    = mFmmLocalExpansions[ 0 ] ;
+    const unsigned * const                          pClusterDims    = influenceTree.GetDecimations( 1 ) ;
+    const unsigned          numXLeaf    = rLeafLayer.GetNumPoints( 0 ) ;
+    const unsigned          numXYLeaf   = numXLeaf * rLeafLayer.GetNumPoints( 1 ) ;
+    const unsigned          numXParent  = rParentLayer.GetNumPoints( 0 ) ;
+    const unsigned          numXYParent = numXParent * rParentLayer.GetNumPoints( 1 ) ;
+
+    unsigned idxLeaf[3] ;
+    unsigned idxParent[3] ;
+    unsigned sourceBegin[3] ;
+    unsigned sourceEnd[3] ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // Find leaf cell whose minimal corner is this gridpoint, its parent, and range of leaf cells under parent's neighbors.
+        const unsigned numLeafCells     = rLeafLayer.GetNumCells( axis ) ;
+        const unsigned numParentCells   = rParentLayer.GetNumCells( axis ) ;
+        idxLeaf[ axis ]   = Min2( indices[ axis ] , numLeafCells - 1 ) ;
+        idxParent[ axis ] = Min2( idxLeaf[ axis ] / pClusterDims[ axis ] , numParentCells - 1 ) ;
+        const unsigned neighborBegin    = ( idxParent[ axis ] > 0 ) ? idxParent[ axis ] - 1 : 0 ;
+        const unsigned neighborEnd      = Min2( idxParent[ axis ] + 2 , numParentCells ) ;
+        sourceBegin[ axis ] = neighborBegin * pClusterDims[ axis ] ;
+        sourceEnd  [ axis ] = Min2( neighborEnd * pClusterDims[ axis ] , numLeafCells ) ;
+    }
+
+    // Evaluate local expansion of parent, which accounts for all sources outside parent's neighbors.
+    const Vec3 vParentCenter = rParentLayer.GetMinCorner() + 0.5f * rParentLayer.GetCellSpacing()
+                             + Vec3( float( idxParent[0] ) * rParentLayer.GetCellSpacing().x
+                                   , float( idxParent[1] ) * rParentLayer.GetCellSpacing().y
+                                   , float( idxParent[2] ) * rParentLayer.GetCellSpacing().z ) ;
+    Vec3 velocityAccumulator = rParentLayer[ idxParent[0] + idxParent[1] * numXParent + idxParent[2] * numXYParent ].Evaluate( vPosition - vParentCenter ) ;
+
+    // Directly sum leaf cells under parent's neighbors:
+    // supervortons for the leaf interaction list, and member vortons for the near field.
+    const bool          useSimdKernel   = ( BIOT_SAVART_KERNEL_SCALAR != mBiotSavartKernel ) ;
+    VortonSourceBatch   sourceBatch( mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+    unsigned idxSource[3] ;
+    for( idxSource[2] = sourceBegin[2] ; idxSource[2] < sourceEnd[2] ; ++ idxSource[2] )
+    {
+        const bool farZ = ( idxSource[2] + 1 < idxLeaf[2] ) || ( idxSource[2] > idxLeaf[2] + 1 ) ;
+        for( idxSource[1] = sourceBegin[1] ; idxSource[1] < sourceEnd[1] ; ++ idxSource[1] )
+        {
+            const bool      farYZ       = farZ || ( idxSource[1] + 1 < idxLeaf[1] ) || ( idxSource[1] > idxLeaf[1] + 1 ) ;
+            const unsigned  offsetYZ    = idxSource[1] * numXLeaf + idxSource[2] * numXYLeaf ;
+            for( idxSource[0] = sourceBegin[0] ; idxSource[0] < sourceEnd[0] ; ++ idxSource[0] )
+            {
+                const unsigned  offsetXYZ       = idxSource[0] + offsetYZ ;
+                const Vorton &  rSupervorton    = rLeafLayer[ offsetXYZ ] ;
+                if( rSupervorton.mSize == 0.0f )
+                {   // Cell is empty.
+                    continue ;
+                }
+                const bool farXYZ = farYZ || ( idxSource[0] + 1 < idxLeaf[0] ) || ( idxSource[0] > idxLeaf[0] + 1 ) ;
+                if( ! farXYZ )
+                {   // Source cell is adjacent to leaf cell of this gridpoint, so sum its vortons individually.
+                    const CellList::Cell cell = vortonIndicesGrid[ offsetXYZ ] ;
+                    for( unsigned ivHere = 0 ; ivHere < cell.Size() ; ++ ivHere )
+                    {   // For each vorton in this cell...
+                        const Vorton & rVorton = (*mVortons)[ cell[ ivHere ] ] ;
+                        if( useSimdKernel )
+                        {
+                            sourceBatch.Add( velocityAccumulator , vPosition , rVorton.mPosition , rVorton.mAngularVelocity , rVorton.mSize ) ;
+                        }
+                        else
+                        {
+                            VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rVorton ) ;
+                        }
+                    }
+                    continue ;
+                }
+                if( useSimdKernel )
+                {
+                    sourceBatch.Add( velocityAccumulator , vPosition , rSupervorton.mPosition , rSupervorton.mAngularVelocity , rSupervorton.mSize ) ;
+                }
+                else
+                {
+                    VORTON_ACCUMULATE_VELOCITY( velocityAccumulator , vPosition , rSupervorton ) ;
+                }
+            }
+        }
+    }
+    sourceBatch.Flush( velocityAccumulator , vPosition ) ;
+
+    return velocityAccumulator ;
+}
+#endif
+
+
+
+
+/** Compute velocity due to vortons, for a subset of points in a uniform grid.
+
+    \param izStart - starting value for z index
+
+    \param izEnd - one past ending value for z index
+
+    \see CreateInfluenceTree, ComputeVelocityFromVorticity
+
+    \note This routine assumes CreateInfluenceTree has already executed,
+            and that the velocity grid has been allocated.
+
+*/
+void VortonSim::ComputeVelocityAtGridpoints_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t izStart , size_t izEnd )
+{
+    ASSERT( ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) || ( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect ) ) ; // Differential solvers do not use this routine.
+    const bool          useDirect   = ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) ;
+    const size_t        numLayers   = influenceTree.GetDepth() ;
+    const Vec3 &        vMinCorner  = mVelGrid.GetMinCorner() ;
+    static const float  nudge       = 1.0f - 2.0f * FLT_EPSILON ;
+    const Vec3          vSpacing    = mVelGrid.GetCellSpacing() * nudge ;
+    const unsigned      dims[3]     =   { mVelGrid.GetNumPoints( 0 )
+                                        , mVelGrid.GetNumPoints( 1 )
+                                        , mVelGrid.GetNumPoints( 2 ) } ;
+    const unsigned      numXY       = dims[0] * dims[1] ;
+    unsigned            idx[ 3 ] ;
+    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
+    {   // For subset of z index values...
+        Vec3 vPosition ;
+        // Compute the z-coordinate of the world-space position of this gridpoint.
+        vPosition.z = vMinCorner.z + float( idx[2] ) * vSpacing.z ;
+        // Precompute the z contribution to the offset into the velocity grid.
+        const unsigned offsetZ = idx[2] * numXY ;
+        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
+        {   // For every gridpoint along the y-axis...
+            // Compute the y-coordinate of the world-space position of this gridpoint.
+            vPosition.y = vMinCorner.y + float( idx[1] ) * vSpacing.y ;
+            // Precompute the y contribution to the offset into the velocity grid.
+            const unsigned offsetYZ = idx[1] * dims[0] + offsetZ ;
+            for( idx[0] = 0 ; idx[0] < dims[0] ; ++ idx[0] )
+            {   // For every gridpoint along the x-axis...
+                // Compute the x-coordinate of the world-space position of this gridpoint.
+                vPosition.x = vMinCorner.x + float( idx[0] ) * vSpacing.x ;
+                // Compute the offset into the velocity grid.
+                const unsigned offsetXYZ = idx[0] + offsetYZ ;
+
+            #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+                if( ! IsVelocityGridpointExact( idx ) )
+                {   // Gridpoint lies far from vortons, so InterpolateInactiveVelocityGridBlocks_Slice will assign its velocity.
+                    continue ;
+                }
+            #endif
+
+                // Compute the fluid flow velocity at this gridpoint, due to all vortons.
+                if( useDirect )
+                {
+                    mVelGrid[ offsetXYZ ] = ComputeVelocity_Direct( vPosition ) ;
+                    continue ;
+                }
+            #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
+                mVelGrid[ offsetXYZ ] = ComputeVelocity_Monopoles( idx , vPosition ) ;
+                ASSERT( ! IsInf( mVelGrid[ offsetXYZ ] ) ) ;
+                (void) numLayers ;
+            #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+                if( numLayers > 1 )
+                {
+                    mVelGrid[ offsetXYZ ] = ComputeVelocity_Fmm( vPosition , idx , vortonIndicesGrid , influenceTree ) ;
+                }
+                else
+                {
+                    mVelGrid[ offsetXYZ ] = ComputeVelocity_Direct( vPosition ) ;
+                }
+            #else   // Treecode, which builds that pick DIRECT or POISSON_GAUSS_SEIDEL as VELOCITY_TECHNIQUE can also select at run time.
+                DEBUG_ONLY( sNumVortonsEncounteredInTree  = 0 ) ;
+                DEBUG_ONLY( sVorticityEncounteredInTree   = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+                DEBUG_ONLY( sCirculationEncounteredInTree = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+                if( numLayers > 1 )
+                {
+                    mVelGrid[ offsetXYZ ] = ComputeVelocity_TreeRoot( vPosition , vortonIndicesGrid , influenceTree ) ;
+                #if ! USE_TBB
+                    ASSERT( mVortons->Size() == sNumVortonsEncounteredInTree ) ;
+                    ASSERT( sCirculationEncounteredInTree.Resembles( mDiagnosticIntegrals.mAfterAdvect.mTotalCirculation , 1.0e-3f ) ) ;
+                #endif
+                }
+                else
+                {
+                    mVelGrid[ offsetXYZ ] = ComputeVelocity_Direct( vPosition ) ;
+                }
+            #endif
+            }
+        }
+    }
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
+    DEBUG_ONLY( printf( "\n" ) ) ;
+#endif
+}
+
+
+
+
+#if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+/** Mark which blocks of the velocity grid lie near enough to vortons to need exact velocity at every gridpoint.
+
+    This splits the velocity grid into blocks of sVelocityGridBlockSize
+    cells along each edge.  Blocks that contain vortons, or lie within a
+    margin of them, are active.  ComputeVelocityAtGridpoints_Slice
+    evaluates velocity exactly at every gridpoint of active blocks, but only
+    at the corners of inactive blocks, and
+    InterpolateInactiveVelocityGridBlocks_Slice fills in the rest.
+
+    With ENABLE_VORTON_SIM_SLEEP, cells whose vortons all have vorticity
+    below the sleep threshold are asleep, and activate no blocks, since the
+    velocity they induce nearby is as weak as their vorticity.
+
+    The margin comes from a far-field error bound:  Velocity due to a vortex
+    at distance r falls off as 1/r^2, so its second derivative is about
+    6|v|/r^2.  Trilinear interpolation across a block of edge length L has
+    error at most L^2/8 times that, i.e. a relative error of about
+    0.75 (L/r)^2.  So blocks farther than L sqrt(0.75/mFarFieldTolerance)
+    from every vorton have relative error within mFarFieldTolerance.
+
+    \param vortonIndicesGrid    Spatial partition of vortons, whose nonempty cells determine where vortons are.
+
+    \note This routine assumes the velocity grid has been allocated.
+
+*/
+void VortonSim::FindActiveVelocityGridBlocks( const CellList & vortonIndicesGrid )
+{
+    PERF_BLOCK( VortonSim__FindActiveVelocityGridBlocks ) ;
+
+    size_t numBlocks = 1 ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis, find number of blocks that span velocity grid cells.
+        const unsigned numCells = mVelGrid.GetNumPoints( axis ) - 1 ;
+        mNumVelGridBlocks[ axis ] = Max2( 1U , ( numCells + sVelocityGridBlockSize - 1 ) / sVelocityGridBlockSize ) ;
+        numBlocks *= mNumVelGridBlocks[ axis ] ;
+    }
+
+    if( ( mFarFieldTolerance <= 0.0f ) || vortonIndicesGrid.Empty() )
+    {   // Interpolation is disabled, or vorton locations are unknown, so compute velocity exactly everywhere.
+        mVelGridBlockIsActive.Clear() ;
+        mVelGridBlockIsActive.Resize( numBlocks , 1 ) ;
+        return ;
+    }
+
+    mVelGridBlockIsActive.Clear() ;
+    mVelGridBlockIsActive.Resize( numBlocks , 0 ) ;
+
+    const float *   velMinCorner        = reinterpret_cast< const float * >( & mVelGrid.GetMinCorner() ) ;
+    const float *   velCellsPerExtent   = reinterpret_cast< const float * >( & mVelGrid.GetCellsPerExtent() ) ;
+    const Vec3 &    vortonCellSpacing   = vortonIndicesGrid.GetCellSpacing() ;
+    const unsigned  numXBlocks          = mNumVelGridBlocks[ 0 ] ;
+    const unsigned  numXYBlocks         = numXBlocks * mNumVelGridBlocks[ 1 ] ;
+
+#if ENABLE_VORTON_SIM_SLEEP
+    const float     sleepAngVelMag2     = Pow2( 0.5f * mSleepVorticityThreshold ) ;    // Vorticity is twice angular velocity.
+#endif
+
+    // Mark blocks that overlap nonempty vorton cells.
+    const unsigned numVortonCells = vortonIndicesGrid.GetGridCapacity() ;
+    for( unsigned offset = 0 ; offset < numVortonCells ; ++ offset )
+    {   // For each cell in vorton partition...
+        if( 0 == vortonIndicesGrid.GetNumItemsInCell( offset ) )
+        {   // Cell has no vortons.
+            continue ;
+        }
+    #if ENABLE_VORTON_SIM_SLEEP
+        if( sleepAngVelMag2 > 0.0f )
+        {   // Sleeping is enabled, so find whether any vorton in this cell is awake.
+            const CellList::Cell    cell        = vortonIndicesGrid[ offset ] ;
+            bool                    isAwake     = false ;
+            for( size_t iCellItem = 0 ; ( iCellItem < cell.Size() ) && ! isAwake ; ++ iCellItem )
+            {   // For each vorton in this cell, until finding one that is awake...
+                isAwake = ( * mVortons )[ cell[ iCellItem ] ].mAngularVelocity.Mag2() > sleepAngVelMag2 ;
+            }
+            if( ! isAwake )
+            {   // Cell is asleep.
+                continue ;
+            }
+        }
+    #endif
+        unsigned idxCell[ 3 ] ;
+        vortonIndicesGrid.IndicesFromOffset( idxCell , offset ) ;
+        Vec3 cellMinCorner ;
+        vortonIndicesGrid.PositionFromIndices( cellMinCorner , idxCell ) ;
+        const Vec3      cellMaxCorner   = cellMinCorner + vortonCellSpacing ;
+        const float *   cellMin         = reinterpret_cast< const float * >( & cellMinCorner ) ;
+        const float *   cellMax         = reinterpret_cast< const float * >( & cellMaxCorner ) ;
+
+        unsigned blockBegin[ 3 ] , blockEnd[ 3 ] ;
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {   // For each axis, find range of blocks that cell overlaps.
+            const float     gridIdxMin  = ( cellMin[ axis ] - velMinCorner[ axis ] ) * velCellsPerExtent[ axis ] ;
+            const float     gridIdxMax  = ( cellMax[ axis ] - velMinCorner[ axis ] ) * velCellsPerExtent[ axis ] ;
+            const float     lastBlock   = float( mNumVelGridBlocks[ axis ] - 1 ) ;
+            blockBegin[ axis ] = unsigned( Clamp( floorf( gridIdxMin / float( sVelocityGridBlockSize ) ) , 0.0f , lastBlock ) ) ;
+            blockEnd  [ axis ] = unsigned( Clamp( floorf( gridIdxMax / float( sVelocityGridBlockSize ) ) , 0.0f , lastBlock ) ) + 1 ;
+        }
+        for( unsigned iz = blockBegin[ 2 ] ; iz < blockEnd[ 2 ] ; ++ iz )
+        for( unsigned iy = blockBegin[ 1 ] ; iy < blockEnd[ 1 ] ; ++ iy )
+        for( unsigned ix = blockBegin[ 0 ] ; ix < blockEnd[ 0 ] ; ++ ix )
+        {   // For each block that cell overlaps...
+            mVelGridBlockIsActive[ ix + iy * numXBlocks + iz * numXYBlocks ] = 1 ;
+        }
+    }
+
+    // Dilate active blocks by the margin the far-field error bound requires.
+    // Blocks whose indices differ by d along some axis lie at least (d-1) block edges apart.
+    const Vec3 &    velCellSpacing      = mVelGrid.GetCellSpacing() ;
+    const float     minSpacing          = MIN3( velCellSpacing.x , velCellSpacing.y , velCellSpacing.z ) ;
+    const float     maxSpacing          = MAX3( velCellSpacing.x , velCellSpacing.y , velCellSpacing.z ) ;
+    const float     marginInBlocks      = ( maxSpacing / minSpacing ) * sqrtf( 0.75f / mFarFieldTolerance ) ;
+    const unsigned  margin              = unsigned( ceilf( marginInBlocks ) ) ;
+    const unsigned  strides[ 3 ]        = { 1 , numXBlocks , numXYBlocks } ;
+    VECTOR< unsigned char , FrameArenaAllocator< unsigned char > > isActiveBeforeDilation ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // Dilate along each axis separately, which dilates by a box overall.
+        isActiveBeforeDilation.assign( mVelGridBlockIsActive.Begin() , mVelGridBlockIsActive.End() ) ;
+        const unsigned numAlongAxis = mNumVelGridBlocks[ axis ] ;
+        for( size_t offset = 0 ; offset < numBlocks ; ++ offset )
+        {   // For each block...
+            if( ! isActiveBeforeDilation[ offset ] )
+            {   // Block was inactive, so it does not spread activity.
+                continue ;
+            }
+            const unsigned idxAlongAxis = unsigned( offset / strides[ axis ] ) % numAlongAxis ;
+            const unsigned neighborBegin = idxAlongAxis > margin ? idxAlongAxis - margin : 0 ;
+            const unsigned neighborEnd   = Min2( idxAlongAxis + margin + 1 , numAlongAxis ) ;
+            const size_t   rowOffset     = offset - size_t( idxAlongAxis ) * strides[ axis ] ;
+            for( unsigned iNeighbor = neighborBegin ; iNeighbor < neighborEnd ; ++ iNeighbor )
+            {   // For each block within margin along this axis...
+                mVelGridBlockIsActive[ rowOffset + size_t( iNeighbor ) * strides[ axis ] ] = 1 ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Return whether ComputeVelocityAtGridpoints_Slice should compute velocity exactly at the given gridpoint.
+
+    That is the case for gridpoints of any active block, and for corners of
+    every block, which inactive blocks interpolate between.
+
+    \param indices - Indices of gridpoint in velocity grid.
+
+    \see FindActiveVelocityGridBlocks.
+*/
+inline bool VortonSim::IsVelocityGridpointExact( const unsigned indices[3] ) const
+{
+    unsigned    blockBegin[ 3 ] ;
+    unsigned    blockLast[ 3 ] ;
+    bool        isCorner = true ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis, find range of blocks that share this gridpoint.
+        const unsigned  idx         = indices[ axis ] ;
+        const bool      onBoundary  = ( 0 == idx % sVelocityGridBlockSize ) || ( idx + 1 == mVelGrid.GetNumPoints( axis ) ) ;
+        blockLast [ axis ] = Min2( idx / sVelocityGridBlockSize , mNumVelGridBlocks[ axis ] - 1 ) ;
+        blockBegin[ axis ] = ( ( 0 == idx % sVelocityGridBlockSize ) && ( idx > 0 ) ) ? idx / sVelocityGridBlockSize - 1 : blockLast[ axis ] ;
+        isCorner = isCorner && onBoundary ;
+    }
+    if( isCorner )
+    {   // Gridpoint is a corner of a block.
+        return true ;
+    }
+    const unsigned numXBlocks   = mNumVelGridBlocks[ 0 ] ;
+    const unsigned numXYBlocks  = numXBlocks * mNumVelGridBlocks[ 1 ] ;
+    for( unsigned iz = blockBegin[ 2 ] ; iz <= blockLast[ 2 ] ; ++ iz )
+    for( unsigned iy = blockBegin[ 1 ] ; iy <= blockLast[ 1 ] ; ++ iy )
+    for( unsigned ix = blockBegin[ 0 ] ; ix <= blockLast[ 0 ] ; ++ ix )
+    {   // For each block that shares this gridpoint...
+        if( mVelGridBlockIsActive[ ix + iy * numXBlocks + iz * numXYBlocks ] )
+        {   // Block is active.
+            return true ;
+        }
+    }
+    return false ;
+}
+
+
+
+
+/** Assign velocity at gridpoints that lie only in inactive blocks, by interpolating between block corners, for a subset of a uniform grid.
+
+    Gridpoints on faces shared by inactive blocks get the same value from
+    either block, since trilinear interpolation restricted to a face depends
+    only on the corners of that face.
+
+    \param izStart - starting value for z index
+
+    \param izEnd - one past ending value for z index
+
+    \note This routine assumes ComputeVelocityAtGridpoints_Slice has already
+            executed for every z index, since interpolation reads block
+            corners in other z slices.
+
+    \see FindActiveVelocityGridBlocks, IsVelocityGridpointExact.
+*/
+void VortonSim::InterpolateInactiveVelocityGridBlocks_Slice( size_t izStart , size_t izEnd )
+{
+    const unsigned      dims[3]     =   { mVelGrid.GetNumPoints( 0 )
+                                        , mVelGrid.GetNumPoints( 1 )
+                                        , mVelGrid.GetNumPoints( 2 ) } ;
+    const unsigned      numXY       = dims[0] * dims[1] ;
+    unsigned            idx[ 3 ] ;
+    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
+    {   // For subset of z index values...
+        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
+        {   // For every gridpoint along the y-axis...
+            for( idx[0] = 0 ; idx[0] < dims[0] ; ++ idx[0] )
+            {   // For every gridpoint along the x-axis...
+                if( IsVelocityGridpointExact( idx ) )
+                {   // ComputeVelocityAtGridpoints_Slice already computed velocity at this gridpoint.
+                    continue ;
+                }
+                unsigned    cornerBegin[ 3 ] ;
+                unsigned    cornerEnd[ 3 ] ;
+                float       tweens[ 3 ] ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis, find corners of block containing this gridpoint, and location between them.
+                    const unsigned block = Min2( idx[ axis ] / sVelocityGridBlockSize , mNumVelGridBlocks[ axis ] - 1 ) ;
+                    cornerBegin[ axis ] = block * sVelocityGridBlockSize ;
+                    cornerEnd  [ axis ] = Min2( cornerBegin[ axis ] + sVelocityGridBlockSize , dims[ axis ] - 1 ) ;
+                    tweens[ axis ]      = ( cornerEnd[ axis ] > cornerBegin[ axis ] )
+                                        ? float( idx[ axis ] - cornerBegin[ axis ] ) / float( cornerEnd[ axis ] - cornerBegin[ axis ] )
+                                        : 0.0f ;
+                }
+                const Vec3      tween( tweens[ 0 ] , tweens[ 1 ] , tweens[ 2 ] ) ;
+                const Vec3      oneMinusTween   = Vec3( 1.0f , 1.0f , 1.0f ) - tween ;
+                const unsigned  offsetX0Y0Z0    = cornerBegin[0] + cornerBegin[1] * dims[0] + cornerBegin[2] * numXY ;
+                const unsigned  spanX           = cornerEnd[0] - cornerBegin[0] ;
+                const unsigned  spanY           = ( cornerEnd[1] - cornerBegin[1] ) * dims[0] ;
+                const unsigned  spanZ           = ( cornerEnd[2] - cornerBegin[2] ) * numXY ;
+                mVelGrid[ idx[0] + idx[1] * dims[0] + idx[2] * numXY ] =
+                              ( ( oneMinusTween.x * mVelGrid[ offsetX0Y0Z0                         ]
+                                +         tween.x * mVelGrid[ offsetX0Y0Z0 + spanX                 ] ) * oneMinusTween.y
+                              + ( oneMinusTween.x * mVelGrid[ offsetX0Y0Z0         + spanY         ]
+                                +         tween.x * mVelGrid[ offsetX0Y0Z0 + spanX + spanY         ] ) * tween.y        ) * oneMinusTween.z
+                            + ( ( oneMinusTween.x * mVelGrid[ offsetX0Y0Z0                 + spanZ ]
+                                +         tween.x * mVelGrid[ offsetX0Y0Z0 + spanX         + spanZ ] ) * oneMinusTween.y
+                              + ( oneMinusTween.x * mVelGrid[ offsetX0Y0Z0         + spanY + spanZ ]
+                                +         tween.x * mVelGrid[ offsetX0Y0Z0 + spanX + spanY + spanZ ] ) * tween.y        ) * tween.z ;
+            }
+        }
+    }
+}
+#endif
+
+
+
+
+
+#if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+/** Add finer patches to the velocity grid near bodies and strong vorticity, and compute velocity on them.
+
+    This splits the velocity grid into blocks of sVelocityPatchBlockSize
+    cells along each edge.  Blocks within one block edge of the surface of
+    the bounding sphere of a body that is not a hole qualify for a patch, as
+    do blocks containing a vorton whose vorticity exceeds
+    mVelocityPatchVorticityFraction of that of the strongest vorton.  When
+    more than mMaxVelocityPatches blocks qualify, blocks near bodies take
+    precedence, then blocks with stronger vorticity.
+
+    Each patch has mVelocityPatchRefinement patch cells per velocity grid
+    cell.  Its boundary takes velocity interpolated from the velocity grid,
+    so patches agree with the grid and with each other where they meet.
+    ComputeVelocityAtPatches_Slice computes velocity at interior gridpoints
+    the same way ComputeVelocityAtGridpoints_Slice does for the grid.
+
+    \note Vortons keep the mollification that ENABLE_AUTO_MOLLIFICATION
+            chose for the velocity grid, so patches resolve flow features
+            down to the vorton core size rather than the patch spacing.
+
+    \note This routine assumes mVelGrid has velocity at every gridpoint,
+            and that mVelGridPatches has the shape of mVelGrid.
+
+*/
+void VortonSim::RefineVelocityGrid( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__RefineVelocityGrid ) ;
+
+    ASSERT( mVelGridPatches.Empty() ) ;
+    if( 0 == mMaxVelocityPatches )
+    {   // Refinement is disabled.
+        return ;
+    }
+
+    unsigned    numBlocks[ 3 ] ;
+    size_t      numBlocksTotal = 1 ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis, find number of blocks that span velocity grid cells.
+        const unsigned numCells = mVelGrid.GetNumCells( axis ) ;
+        numBlocks[ axis ] = Max2( 1U , ( numCells + sVelocityPatchBlockSize - 1 ) / sVelocityPatchBlockSize ) ;
+        numBlocksTotal *= numBlocks[ axis ] ;
+    }
+    const unsigned  numXBlocks      = numBlocks[ 0 ] ;
+    const unsigned  numXYBlocks     = numXBlocks * numBlocks[ 1 ] ;
+    const Vec3 &    velMinCorner    = mVelGrid.GetMinCorner() ;
+    const Vec3 &    velCellSpacing  = mVelGrid.GetCellSpacing() ;
+    const Vec3      blockSpacing    = velCellSpacing * float( sVelocityPatchBlockSize ) ;
+    const Vec3      blocksPerExtent = Vec3( 1.0f / blockSpacing.x , 1.0f / blockSpacing.y , 1.0f / blockSpacing.z ) ;
+
+    // Priority of each block for refinement:  Squared angular velocity of its strongest vorton, or FLT_MAX for blocks near bodies.
+    VECTOR< float , FrameArenaAllocator< float > > blockPriorities ;
+    blockPriorities.Resize( numBlocksTotal , 0.0f ) ;
+
+    float           angVelMag2Max   = 0.0f ;
+    const size_t    numVortons      = mVortons->Size() ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton, tally strongest vorticity in its block.
+        const Vorton &  rVorton     = ( * mVortons )[ iVorton ] ;
+        const Vec3      posInBlocks = rVorton.mPosition - velMinCorner ;
+        const unsigned  ix          = unsigned( Clamp( posInBlocks.x * blocksPerExtent.x , 0.0f , float( numBlocks[ 0 ] - 1 ) ) ) ;
+        const unsigned  iy          = unsigned( Clamp( posInBlocks.y * blocksPerExtent.y , 0.0f , float( numBlocks[ 1 ] - 1 ) ) ) ;
+        const unsigned  iz          = unsigned( Clamp( posInBlocks.z * blocksPerExtent.z , 0.0f , float( numBlocks[ 2 ] - 1 ) ) ) ;
+        const float     angVelMag2  = rVorton.mAngularVelocity.Mag2() ;
+        float &         priority    = blockPriorities[ ix + iy * numXBlocks + iz * numXYBlocks ] ;
+        priority        = Max2( priority , angVelMag2 ) ;
+        angVelMag2Max   = Max2( angVelMag2Max , angVelMag2 ) ;
+    }
+
+    // Blocks whose strongest vorton is weaker than this do not qualify, unless near a body.
+    const float angVelMag2Min = Max2( Pow2( mVelocityPatchVorticityFraction ) * angVelMag2Max , FLT_MIN ) ;
+
+#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS || POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS || POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS || COMPUTE_PRESSURE_GRADIENT
+    if( mPhysicalObjects )
+    {
+        const float     margin      = MAX3( blockSpacing.x , blockSpacing.y , blockSpacing.z ) ;
+        const size_t    numPhysObjs = mPhysicalObjects->Size() ;
+        for( size_t idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+        {   // For each body...
+            const Impulsion::PhysicalObject &   physObj = * (*mPhysicalObjects)[ idxPhysObj ] ;
+            const Collision::ShapeBase *        shape   = physObj.GetCollisionShape() ;
+            if( shape->IsHole() || ( shape->GetBoundingSphereRadius() < 0.0f ) )
+            {   // Flow does not pass around this body.
+                continue ;
+            }
+            const Vec3 &    center          = physObj.GetBody()->GetPosition() ;
+            const float     radiusInner     = shape->GetBoundingSphereRadius() ;
+            const float     radiusOuter     = radiusInner + margin ;
+            const Vec3      minInBlocks     = ( center - Vec3( radiusOuter , radiusOuter , radiusOuter ) - velMinCorner ) ;
+            const Vec3      maxInBlocks     = ( center + Vec3( radiusOuter , radiusOuter , radiusOuter ) - velMinCorner ) ;
+            const float *   minRel          = reinterpret_cast< const float * >( & minInBlocks ) ;
+            const float *   maxRel          = reinterpret_cast< const float * >( & maxInBlocks ) ;
+            const float *   perExtent       = reinterpret_cast< const float * >( & blocksPerExtent ) ;
+            unsigned        blockBegin[ 3 ] , blockEnd[ 3 ] ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis, find range of blocks that the bounding box of the expanded sphere overlaps.
+                const float lastBlock = float( numBlocks[ axis ] - 1 ) ;
+                blockBegin[ axis ] = unsigned( Clamp( floorf( minRel[ axis ] * perExtent[ axis ] ) , 0.0f , lastBlock ) ) ;
+                blockEnd  [ axis ] = unsigned( Clamp( floorf( maxRel[ axis ] * perExtent[ axis ] ) , 0.0f , lastBlock ) ) + 1 ;
+            }
+            for( unsigned iz = blockBegin[ 2 ] ; iz < blockEnd[ 2 ] ; ++ iz )
+            for( unsigned iy = blockBegin[ 1 ] ; iy < blockEnd[ 1 ] ; ++ iy )
+            for( unsigned ix = blockBegin[ 0 ] ; ix < blockEnd[ 0 ] ; ++ ix )
+            {   // For each block the bounding box overlaps...
+                const Vec3  blockMin    = velMinCorner + Vec3( float( ix ) * blockSpacing.x , float( iy ) * blockSpacing.y , float( iz ) * blockSpacing.z ) ;
+                const Vec3  blockMax    = blockMin + blockSpacing ;
+                // Find nearest and farthest points of block from sphere center.
+                const Vec3  nearest     = Vec3( Clamp( center.x , blockMin.x , blockMax.x ) , Clamp( center.y , blockMin.y , blockMax.y ) , Clamp( center.z , blockMin.z , blockMax.z ) ) ;
+                const Vec3  farthest    = Vec3( ( center.x - blockMin.x > blockMax.x - center.x ) ? blockMin.x : blockMax.x
+                                              , ( center.y - blockMin.y > blockMax.y - center.y ) ? blockMin.y : blockMax.y
+                                              , ( center.z - blockMin.z > blockMax.z - center.z ) ? blockMin.z : blockMax.z ) ;
+                if(     ( ( nearest  - center ).Mag2() <= Pow2( radiusOuter ) )
+                    &&  ( ( farthest - center ).Mag2() >= Pow2( radiusInner ) ) )
+                {   // Block overlaps the shell around the body, rather than lying far away or entirely inside it.
+                    blockPriorities[ ix + iy * numXBlocks + iz * numXYBlocks ] = FLT_MAX ;
+                }
+            }
+        }
+    }
+#endif
+
+    // Gather qualifying blocks, with negated priority, so ascending order puts the highest priority first.
+    typedef std::pair< float , unsigned > PriorityAndBlock ;
+    VECTOR< PriorityAndBlock , FrameArenaAllocator< PriorityAndBlock > > candidates ;
+    for( unsigned offset = 0 ; offset < numBlocksTotal ; ++ offset )
+    {   // For each block...
+        if( blockPriorities[ offset ] >= angVelMag2Min )
+        {   // Block qualifies for refinement.
+            candidates.PushBack( PriorityAndBlock( - blockPriorities[ offset ] , offset ) ) ;
+        }
+    }
+    if( candidates.Size() > mMaxVelocityPatches )
+    {   // Too many blocks qualify, so keep those with highest priority.
+        std::nth_element( candidates.Begin() , candidates.Begin() + mMaxVelocityPatches , candidates.End() ) ;
+        candidates.Resize( mMaxVelocityPatches ) ;
+    }
+    if( candidates.Empty() )
+    {   // No block needs refinement.
+        return ;
+    }
+
+    const size_t numCandidates = candidates.Size() ;
+    for( size_t iCandidate = 0 ; iCandidate < numCandidates ; ++ iCandidate )
+    {   // For each block to refine, add a patch that spans it.
+        const unsigned  offset          = candidates[ iCandidate ].second ;
+        const unsigned  block[ 3 ]      = { offset % numXBlocks , ( offset / numXBlocks ) % numBlocks[ 1 ] , offset / numXYBlocks } ;
+        const unsigned  cellBegin[ 3 ]  = { block[ 0 ] * sVelocityPatchBlockSize , block[ 1 ] * sVelocityPatchBlockSize , block[ 2 ] * sVelocityPatchBlockSize } ;
+        const unsigned  cellEnd[ 3 ]    = { cellBegin[ 0 ] + sVelocityPatchBlockSize , cellBegin[ 1 ] + sVelocityPatchBlockSize , cellBegin[ 2 ] + sVelocityPatchBlockSize } ;
+        mVelGridPatches.AddPatch( cellBegin , cellEnd , mVelocityPatchRefinement ) ;
+    }
+
+    // Patches cost about the same, so split evenly.
+    const size_t numPatches = mVelGridPatches.GetNumPatches() ;
+    Parallel::For( 0 , numPatches , 1 , Parallel::Method( this , & VortonSim::ComputeVelocityAtPatches_Slice , vortonIndicesGrid , influenceTree ) ) ;
+}
+
+
+
+
+/** Compute velocity on a subset of patches of the velocity grid.
+
+    Boundary gridpoints get velocity interpolated from the velocity grid;
+    interior gridpoints get velocity due to vortons.
+
+    \param iPatchBegin - index of first patch
+
+    \param iPatchEnd - one past index of last patch
+
+    \see RefineVelocityGrid, ComputeVelocityAtGridpoints_Slice.
+*/
+void VortonSim::ComputeVelocityAtPatches_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iPatchBegin , size_t iPatchEnd )
+{
+    ASSERT( ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) || ( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect ) ) ; // Differential solvers do not use this routine.
+    const bool useDirect = ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) || ( influenceTree.GetDepth() <= 1 ) ;
+    for( size_t iPatch = iPatchBegin ; iPatch < iPatchEnd ; ++ iPatch )
+    {   // For each patch in this slice...
+        UniformGrid< Vec3 > &   patch   = mVelGridPatches.GetPatch( iPatch ) ;
+        patch.Init() ;
+        mVelGridPatches.FillBoundaryFromCoarse( iPatch , mVelGrid ) ;
+
+        const unsigned          dims[3] = { patch.GetNumPoints( 0 ) , patch.GetNumPoints( 1 ) , patch.GetNumPoints( 2 ) } ;
+        unsigned                idx[ 3 ] ;
+        for( idx[2] = 1 ; idx[2] + 1 < dims[2] ; ++ idx[2] )
+        {   // For each interior z index...
+            for( idx[1] = 1 ; idx[1] + 1 < dims[1] ; ++ idx[1] )
+            {   // For each interior y index...
+                for( idx[0] = 1 ; idx[0] + 1 < dims[0] ; ++ idx[0] )
+                {   // For each interior gridpoint along x...
+                    Vec3 vPosition ;
+                    patch.PositionFromIndices( vPosition , idx ) ;
+                    patch[ patch.OffsetFromIndices( idx[0] , idx[1] , idx[2] ) ] = useDirect
+                        ? ComputeVelocity_Direct( vPosition )
+                        : ComputeVelocity_TreeRoot( vPosition , vortonIndicesGrid , influenceTree ) ;
+                }
+            }
+        }
+    }
+}
+
+
+
+
+/** Assign velocity to a subset of vortons that lie inside patches of the velocity grid, from the finest patch containing each.
+
+    \param iPclBegin - index of first vorton
+
+    \param iPclEnd - one past index of last vorton
+
+    \see AssignVortonVelocityFromPatches.
+*/
+void VortonSim::AssignVortonVelocityFromPatches_Slice( size_t iPclBegin , size_t iPclEnd )
+{
+    for( size_t iPcl = iPclBegin ; iPcl < iPclEnd ; ++ iPcl )
+    {   // For each vorton in this slice...
+        Vorton & rVorton = ( * mVortons )[ iPcl ] ;
+        if( mVelGridPatches.FindPatch( rVorton.mPosition ) )
+        {   // Vorton lies in a patch, which has finer velocity than the grid.
+            mVelGridPatches.Interpolate( rVorton.mVelocity , rVorton.mPosition , mVelGrid ) ;
+        }
+    }
+}
+
+
+
+
+/** Assign velocity to vortons that lie inside patches of the velocity grid, from the finest patch containing each.
+
+    Vortons elsewhere keep the velocity they got from the velocity grid.
+
+    \see RefineVelocityGrid.
+*/
+void VortonSim::AssignVortonVelocityFromPatches()
+{
+    PERF_BLOCK( VortonSim__AssignVortonVelocityFromPatches ) ;
+
+    const size_t numVortons = mVortons->Size() ;
+    Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::AssignVortonVelocityFromPatches_Slice ) ) ;
+}
+#endif
+
+
+
+
+/** Compute velocity due to vortons, at vorton locations, for a subset of vortons.
+
+    \param iPclStart - starting value for vorton index
+
+    \param iPclEnd - one past ending value for vorton index
+
+    \see ComputeVelocityFromVorticity, ComputeVelocityAtGridpoints_Slice
+
+    \note This routine is an alternative to ComputeVelocityAtGridpoints_Slice,
+            which computes velocity at gridpoints
+            (which are at grid cell corners).
+
+    \note This routine assumes CreateInfluenceTree has already executed.
+
+*/
+void VortonSim::ComputeVelocityAtVortons_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iPclStart , size_t iPclEnd )
+{
+    ASSERT( ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) || ( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect ) ) ; // Differential solvers do not use this routine.
+    const bool          useDirect   = ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) ;
+#if ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_MONOPOLES ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_FMM )
+    const size_t        numLayers   = influenceTree.GetDepth() ;
+#endif
+    for( unsigned iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
+    {   // For subset of vortex particle index values...
+        Vorton & vorton = (*mVortons)[ iPcl ] ;
+    #if USE_VORTON_SOA
+        const Vec3 vPosition = mVortonSoa.GetPosition( iPcl ) ;
+    #else
+        Vec3 & vPosition = vorton.mPosition ;
+    #endif
+        Vec3 & vVelocity = vorton.mVelocity ;
+        // Compute the fluid flow velocity at this gridpoint, due to all vortons.
+        if( useDirect )
+        {
+            vVelocity = ComputeVelocity_Direct( vPosition ) ;
+        #if ENABLE_PARTICLE_HISTORY
+            PclHistoryRecord( iPcl , vorton ) ; // For diagnosing determinism.
+        #endif
+            continue ;
+        }
+    #if ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM )
+        FAIL() ;  // Monopole and multipole methods do not use this routine.
+        (void) vPosition , vVelocity ; // Avoid "local variable is initialized but not referenced" warning.
+        (void) influenceTree , vortonIndicesGrid  ; // Avoid "unreferenced formal parameter" warning.
+    #else   // Treecode.
+        DEBUG_ONLY( sNumVortonsEncounteredInTree  = 0 ) ;
+        DEBUG_ONLY( sVorticityEncounteredInTree   = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+        DEBUG_ONLY( sCirculationEncounteredInTree = Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+        #if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+        static const unsigned zeros[3] = { 0 , 0 , 0 } ; // Starter indices for recursive algorithm
+        ASSERT( mVelocityGradientsAtVortons.Size() == mVortons->Size() ) ;
+        Mat33 & velocityGradient = mVelocityGradientsAtVortons[ iPcl ] ;
+        velocityGradient = Mat33( Vec3( 0.0f , 0.0f , 0.0f ) , Vec3( 0.0f , 0.0f , 0.0f ) , Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+        vVelocity = ComputeVelocityAndGradient_Tree( velocityGradient , vPosition , zeros , numLayers - 1  , vortonIndicesGrid , influenceTree ) ;
+        #else
+        vVelocity = ComputeVelocity_TreeRoot( vPosition , vortonIndicesGrid , influenceTree ) ;
+        #endif
+        #if ! USE_TBB
+            ASSERT( mVortons->Size() == sNumVortonsEncounteredInTree ) ;
+            ASSERT( sCirculationEncounteredInTree.Resembles( mDiagnosticIntegrals.mAfterAdvect.mTotalCirculation ) ) ;
+        #endif
+    #endif
+    }
+#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES
+    DEBUG_ONLY( printf( "\n" ) ) ;
+#endif
+}
+
+
+
+
+#if VORTON_SIM_GROUP_TREE_QUERIES
+/** Compute velocity due to vortons, at vorton locations, for the vortons in a subset of cells.
+
+    \param iCellStart - starting value for offset of cell in vortonIndicesGrid
+
+    \param iCellEnd - one past ending value for offset of cell in vortonIndicesGrid
+
+    This produces the same result as ComputeVelocityAtVortons_Slice with
+    VELOCITY_TECHNIQUE_TREE, except for the order of summation, but the
+    vortons in each cell traverse the influence tree together.
+
+    \see ComputeVelocity_TreeGroup
+
+    \note This routine assumes CreateInfluenceTree and PartitionVortons have already executed.
+
+*/
+void VortonSim::ComputeVelocityAtVortonGroups_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iCellStart , size_t iCellEnd )
+{
+    PERF_BLOCK_INNER( VortonSim__ComputeVelocityAtVortonGroups_Slice ) ;
+
+    const size_t        numLayers   = influenceTree.GetDepth() ;
+    static const unsigned zeros[3]  = { 0 , 0 , 0 } ; // Starter indices for recursive algorithm
+    VECTOR< Vec3 >      positions   ;
+    VECTOR< Vec3 >      velocities  ;
+    VECTOR< unsigned >  queries     ;   // Outermost group, followed by space for the subset that opens each layer.
+
+    for( size_t iCell = iCellStart ; iCell < iCellEnd ; ++ iCell )
+    {   // For each cell in subset...
+        const CellList::Cell    cell        = vortonIndicesGrid[ iCell ] ;
+        const size_t            numInCell   = cell.Size() ;
+        if( 0 == numInCell )
+        {
+            continue ;
+        }
+
+        positions.Resize( numInCell ) ;
+        velocities.Resize( numInCell ) ;
+        queries.Resize( numInCell * numLayers ) ;
+        for( size_t iQuery = 0 ; iQuery < numInCell ; ++ iQuery )
+        {   // For each vorton in this cell...
+        #if USE_VORTON_SOA
+            positions[ iQuery ] = mVortonSoa.GetPosition( cell[ iQuery ] ) ;
+        #else
+            positions[ iQuery ] = (*mVortons)[ cell[ iQuery ] ].mPosition ;
+        #endif
+            velocities[ iQuery ] = Vec3( 0.0f , 0.0f , 0.0f ) ;
+            queries[ iQuery ] = static_cast< unsigned >( iQuery ) ;
+        }
+
+        ComputeVelocity_TreeGroup( & velocities[ 0 ] , & positions[ 0 ] , & queries[ 0 ] , numInCell , & queries[ numInCell ] , numInCell , zeros , numLayers - 1 , vortonIndicesGrid , influenceTree ) ;
+
+        for( size_t iQuery = 0 ; iQuery < numInCell ; ++ iQuery )
+        {
+            (*mVortons)[ cell[ iQuery ] ].mVelocity = velocities[ iQuery ] ;
+        }
+    }
+}
+#endif
+
+
+
+
+/** Vorticity sources for UniformGridScatter, one per vorton.
+*/
+class VortonSim_VorticitySources
+{
+    public:
+        VortonSim_VorticitySources( const VECTOR< Vorton > & vortons , float volumeCorrection )
+            : mVortons( vortons )
+            , mVolumeCorrection( volumeCorrection )
+        {}
+
+        size_t          GetNumSources() const                                   { return mVortons.Size() ; }
+        const Vec3 &    GetPosition( size_t iSource ) const                     { return mVortons[ iSource ].mPosition ; }
+        void            GetValues( size_t iSource , Vec3 values[] ) const       { values[ 0 ] = mVortons[ iSource ].GetVorticity() * mVolumeCorrection ; }
+
+    private:
+        VortonSim_VorticitySources & operator=( const VortonSim_VorticitySources & ) ; // Disallow assignment.
+
+        const VECTOR< Vorton > &    mVortons            ;   ///< Vortons whose vorticity to accumulate
+        const float                 mVolumeCorrection   ;   ///< Ratio of vorton volume to grid cell volume, times scale
+} ;
+
+
+
+
+/** Populate a UniformGrid with vorticity values from vortons.
+
+    \param vorticityGrid    (out) Reference to grid representing spatial distribution of vorticity.
+
+    \param scale    Scale by which to multiply vorticity values.
+                    Normally scale should be either 1.0f or -1.0f.
+
+    \note   The Poisson equation we want to solve has the form
+        \verbatim
+                Laplacian vectorPotential = - vorticity
+        \endverbatim
+            in which case scale should be -1.0f.
+*/
+void VortonSim::PopulateVorticityGridFromVortons( UniformGrid< Vec3 > & vorticityGrid , float scale )
+{
+    PERF_BLOCK( VortonSim__PopulateVorticityGridFromVortons ) ;
+
+    vorticityGrid.Clear() ;                            // Clear any stale vorticity information
+    vorticityGrid.CopyShape( mGridTemplate ) ;         // Use same shape as base vorticity grid. (Note: could differ if you want.)
+    vorticityGrid.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ; // Reserve memory for velocity grid and initialize all values to zero.
+
+    if( mVortons->Empty() )
+    {
+        return ;
+    }
+
+    DEBUG_ONLY( Vec3 vCirculationVortons( 0.0f , 0.0f , 0.0f ) ) ;
+    DEBUG_ONLY( Vec3 vCirculationToGrid( 0.0f , 0.0f , 0.0f ) ) ;
+
+    // In order for the Poisson and Tree/Monopole velocity-from-vorticity 
+    // techniques to produce consistent results, this formula for the volume of
+    // a vorton must match that implicitly used in VORTON_ACCUMULATE_VELOCITY_private.
+    ASSERT( ! mVortons->empty() ) ;
+    const float vortonRadius        = (*mVortons)[ 0 ].GetRadius() ;
+    const float cellVolume          = vorticityGrid.GetCellVolume() ;
+    const float vortonVolume        = FourPiOver3 * Pow3( vortonRadius ) ;
+    // The grid resulting from this operation must preserve the
+    // same total circulation that the vortons have, so multiply
+    // by the ratio of the vorton volume to gridcell volume.
+    const float volumeCorrection    = scale * vortonVolume / cellVolume ;
+
+    // Make sure vorton radius has not changed.  This simulation code assumes vorton radius is both uniform and constant.
+    ASSERT( mVortons->empty() || Math::Resembles( vortonVolume , (*mVortons)[ 0 ].GetVolume() ) ) ;
+
+    // Populate vorticity grid.
+    // Note that the use of a uniform volumeCorrection here
+    // assumes that all vortons have the same volume.
+    const VortonSim_VorticitySources    sources( * mVortons , volumeCorrection ) ;
+    UniformGrid< Vec3 > *               grids[] = { & vorticityGrid } ;
+    ScatterIntoGrids( grids , 1 , sources ) ;
+
+#if defined( _DEBUG )
+    const size_t numVortons = mVortons->Size() ;
+    for( size_t uVorton = 0 ; uVorton < numVortons ; ++ uVorton )
+    {   // For each vorton in this simulation...
+        const Vorton     &  rVorton     = (*mVortons)[ uVorton ] ;
+        const Vec3       &  rPosition   = rVorton.mPosition   ;
+        ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
+        const unsigned      uOffset     = vorticityGrid.OffsetOfPosition( rPosition ) ;
+        ASSERT( uOffset < vorticityGrid.GetGridCapacity() ) ;
+
+        vCirculationToGrid  += rVorton.GetVorticity() * volumeCorrection * cellVolume ;
+        vCirculationVortons += rVorton.GetVorticity() * vortonVolume ;
+
+        // Make sure vorton radius is uniform and constant.
+        ASSERT( Math::Resembles( vortonVolume , rVorton.GetVolume() ) ) ;
+    }
+
+    {
+        Vec3 vCirculationGrid( 0.0f , 0.0f , 0.0f ) ;
+        for( unsigned offset = 0 ; offset < vorticityGrid.GetGridCapacity() ; ++ offset )
+        {   // For each cell in vorticity grid...
+            vCirculationGrid += vorticityGrid[ offset ] * cellVolume ;
+        }
+// DO NOT SUBMIT commented out
+        //ASSERT( vCirculationVortons.Resembles( scale * vCirculationGrid , 0.01f ) ) ;
+    }
+#endif
+}
+
+
+
+
+/** Split z slices of velocity grid into chunks of roughly equal cost, for parallel loops over gridpoints.
+
+    Computing velocity (or vector potential) at a gridpoint costs more near
+    vortons, where treecode queries open more clusters and where the
+    activity mask computes exact velocity instead of interpolating it.  This
+    estimates the cost of each slice as a baseline, for visiting its
+    gridpoints, plus a term proportional to the number of vortons in the slab
+    of cells, in vortonIndicesGrid, that contains that slice.
+
+    \param vortonIndicesGrid    Spatial partition of vortons.
+*/
+void VortonSim::PartitionVelocityGridSlices( const CellList & vortonIndicesGrid )
+{
+    const unsigned  numZ        = mVelGrid.GetNumPoints( 2 ) ;
+    const size_t    numVortons  = vortonIndicesGrid.Empty() ? 0 : vortonIndicesGrid.GetNumItemsInCells( 0 , vortonIndicesGrid.GetGridCapacity() ) ;
+    mParallelCosts.Resize( numZ ) ;
+    if( 0 == numVortons )
+    {   // No vortons to weight slices, so all slices cost the same.
+        for( unsigned iz = 0 ; iz < numZ ; ++ iz )
+        {   // For each z slice of velocity grid...
+            mParallelCosts[ iz ] = 1.0f ;
+        }
+    }
+    else
+    {
+        const unsigned  numSlabs        = vortonIndicesGrid.GetNumPoints( 2 ) ;
+        const size_t    numCellsPerSlab = size_t( vortonIndicesGrid.GetNumPoints( 0 ) ) * size_t( vortonIndicesGrid.GetNumPoints( 1 ) ) ;
+        const float     vortonCostScale = float( numSlabs ) / float( numVortons ) ; // Vortons in a slab with an average number cost one baseline.
+        for( unsigned iz = 0 ; iz < numZ ; ++ iz )
+        {   // For each z slice of velocity grid...
+            const float     z                   = mVelGrid.GetMinCorner().z + float( iz ) * mVelGrid.GetCellSpacing().z ;
+            const int       izSlabUnclamped     = int( ( z - vortonIndicesGrid.GetMinCorner().z ) * vortonIndicesGrid.GetCellsPerExtent().z ) ;
+            const size_t    izSlab              = size_t( Clamp( izSlabUnclamped , 0 , int( numSlabs ) - 1 ) ) ;
+            const size_t    numVortonsInSlab    = vortonIndicesGrid.GetNumItemsInCells( izSlab * numCellsPerSlab , ( izSlab + 1 ) * numCellsPerSlab ) ;
+            mParallelCosts[ iz ] = 1.0f + float( numVortonsInSlab ) * vortonCostScale ;
+        }
+    }
+    mVelocityGridSlicePartition.Assign( mParallelCosts.Empty() ? NULLPTR : & mParallelCosts[ 0 ] , numZ , PARALLEL_CHUNKS_PER_THREAD * gNumberOfProcessors ) ;
+}
+
+
+
+
+#if VORTON_SIM_GROUP_TREE_QUERIES
+/** Split cells of the given cell list into chunks of roughly equal cost, for ComputeVelocityAtVortonGroups_Slice.
+
+    Most cells are empty and cost almost nothing, while a few hold many
+    vortons, so splitting cells into chunks of equal count would give some
+    threads nearly all the work.
+
+    \param vortonIndicesGrid    Spatial partition of vortons.
+*/
+void VortonSim::PartitionVortonGroups( const CellList & vortonIndicesGrid )
+{
+    static const float  sEmptyCellCost  = 0.0625f ; // Cost of visiting a cell, relative to computing velocity at one vorton.
+    const size_t        numCells        = vortonIndicesGrid.GetGridCapacity() ;
+    mParallelCosts.Resize( numCells ) ;
+    for( size_t offset = 0 ; offset < numCells ; ++ offset )
+    {   // For each cell...
+        mParallelCosts[ offset ] = sEmptyCellCost + float( vortonIndicesGrid.GetNumItemsInCell( offset ) ) ;
+    }
+    mVortonGroupPartition.Assign( mParallelCosts.Empty() ? NULLPTR : & mParallelCosts[ 0 ] , numCells , PARALLEL_CHUNKS_PER_THREAD * gNumberOfProcessors ) ;
+}
+#endif
+
+
+
+
+/** Compute velocity due to vortons, for every point in a uniform grid, using an integral technique (direct summation, treecode or multipole method).
+
+    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons in a vicinity.
+
+    \param influenceTree        Nested grid of vortons and "super-vortons", used to compute velocity-from-vorticity using treecode.
+
+    \see CreateInfluenceTree
+
+    \note This routine assumes CreateInfluenceTree has already executed.
+
+*/
+void VortonSim::ComputeVelocityFromVorticity_Integral( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__ComputeVelocityFromVorticity_Integral ) ;
+
+    ASSERT( ! mVortons->empty() ) ;
+
+#if USE_VORTON_SOA
+    // Direct summation and velocity-at-vortons read vorton positions from the SoA copy.
+    mVortonSoa.Gather( * mVortons ) ;
+#endif
+
+    #if ENABLE_AUTO_MOLLIFICATION
+    {
+        // Smooth velocity induced by vorton, in its vicinity, so that its
+        // length scale corresponds approximately to what the grid can resolve.
+        // When too large, fluid motion lacks detail.
+        // When too small, fluid motion jerks when vortons pass near query points.
+        // Auto-mollification should be used only with integral techniques,
+        // and usually only with VELOCITY_TECHNIQUE_TREE.
+        // See comments where ENABLE_AUTO_MOLLIFICATION is defined.
+        static const float  OneThird                 = 1.0f / 3.0f ;
+        // Tune lengthScale based on comparing jerk statistics for the technique that uses this (TREE)
+        // with DIRECT using COMPUTE_VELOCITY_AT_VORTONS (which is about as accurate as a vorton method can get).
+        static const float  lengthScale              = 1.0f ;
+        const float         characteristicGridLength = lengthScale * powf( mVelGrid.GetCellVolume() , OneThird ) ;
+        ASSERT( ! mVortons->empty() ) ;
+        const float         vortonRadius = (*mVortons)[ 0 ].GetRadius() ;
+        mSpreadingRangeFactor       = Max2( characteristicGridLength / vortonRadius , 1.0f ) ;
+        mSpreadingCirculationFactor = 1.0f / Pow3( mSpreadingRangeFactor ) ;
+    }
+    #endif
+
+#if COMPUTE_VELOCITY_AT_VORTONS
+    // Compute velocity at vortons.
+    // This is only useful for diagnosing integral solvers.  Otherwise, compute velocity on the grid.
+    #if VORTON_SIM_GROUP_TREE_QUERIES_AT_VORTONS
+    // Vortons in each cell of the cell list traverse the influence tree together.
+    const size_t numWorkItems = vortonIndicesGrid.GetGridCapacity() ;
+    #else
+    const size_t numWorkItems = mVortons->size() ;
+    #endif
+    #if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+    if( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect )
+    {   // Treecode traversal also computes velocity gradient, for StretchAndTiltVortons.
+        mVelocityGradientsAtVortons.Resize( mVortons->Size() ) ;
+    }
+    #endif
+    #if USE_TBB && VORTON_SIM_GROUP_TREE_QUERIES_AT_VORTONS
+        // Split cells by number of vortons they contain, and compute velocity at vortons using multiple threads.
+        PartitionVortonGroups( vortonIndicesGrid ) ;
+        Parallel::ForWeighted( mVortonGroupPartition , Parallel::Method( this , & VortonSim::ComputeVelocityAtVortonGroups_Slice , vortonIndicesGrid , influenceTree ) , mAffinityPartitioners[ PARALLEL_LOOP_VELOCITY_AT_VORTONS ] ) ;
+    #elif USE_TBB
+        // Compute velocity at vortons using multiple threads.
+        Parallel::For( 0 , numWorkItems , Parallel::GetGrainSize( numWorkItems ) , Parallel::Method( this , & VortonSim::ComputeVelocityAtVortons_Slice , vortonIndicesGrid , influenceTree ) , mAffinityPartitioners[ PARALLEL_LOOP_VELOCITY_AT_VORTONS ] ) ;
+    #elif VORTON_SIM_GROUP_TREE_QUERIES_AT_VORTONS
+        ComputeVelocityAtVortonGroups_Slice( vortonIndicesGrid , influenceTree , 0 , numWorkItems ) ;
+    #else
+        ComputeVelocityAtVortons_Slice( vortonIndicesGrid , influenceTree , 0 , numWorkItems ) ;
+    #endif
+    // Transfer velocity from vortons to grid.
+    PopulateVelocityGrid( mVelGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) ) ;
+#else   // Compute velocity at gridpoints.
+    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE
+    if( ( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect ) && mVelocityEvaluator && mVelocityEvaluator->ComputeVelocityAtGridpoints( mVelGrid , * mVortons , influenceTree , mSpreadingRangeFactor , mSpreadingCirculationFactor ) )
+    {   // Alternative evaluator (for example on a GPU) computed exact velocity at every gridpoint, so skip the CPU evaluation below.
+        return ;
+    }
+    #endif
+    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+    if( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect )
+    {
+        ComputeFmmLocalExpansions( influenceTree ) ;
+    }
+    #endif
+    #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+    FindActiveVelocityGridBlocks( vortonIndicesGrid ) ;
+    #endif
+    const unsigned numZ = mVelGrid.GetNumPoints( 2 ) ;
+    #if USE_TBB
+        // Split slices by estimated cost, and compute velocity at gridpoints using multiple threads.
+        PartitionVelocityGridSlices( vortonIndicesGrid ) ;
+        Parallel::ForWeighted( mVelocityGridSlicePartition , Parallel::Method( this , & VortonSim::ComputeVelocityAtGridpoints_Slice , vortonIndicesGrid , influenceTree ) , mAffinityPartitioners[ PARALLEL_LOOP_VELOCITY_AT_GRIDPOINTS ] ) ;
+        #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+        // Interpolate velocity far from vortons, from exact values computed above, using multiple threads.
+        // Interpolation costs about the same in every slice, so split evenly.
+        Parallel::For( 0 , numZ , Parallel::GetGrainSize( numZ ) , Parallel::Method( this , & VortonSim::InterpolateInactiveVelocityGridBlocks_Slice ) , mAffinityPartitioners[ PARALLEL_LOOP_INTERPOLATE_INACTIVE_VELOCITY ] ) ;
+        #endif
+    #else
+        ComputeVelocityAtGridpoints_Slice( vortonIndicesGrid , influenceTree , 0 , numZ ) ;
+        #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+        InterpolateInactiveVelocityGridBlocks_Slice( 0 , numZ ) ;
+        #endif
+    #endif
+    #if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+    // Refine velocity near bodies and strong vorticity, now that the grid has velocity from which patch boundaries interpolate.
+    RefineVelocityGrid( vortonIndicesGrid , influenceTree ) ;
+    #endif
+#endif
+}
+
+
+
+
+/** Compute vector potential due to vorticity, for every point in a uniform grid, by solving a vector Poisson partial differential equation.
+
+    \param vectorPotentialMultiGrid  (out) Nested grid of vector potential values, computed from vorticityGrid.
+
+    \param vorticityGrid        (in) Uniform grid of vorticity values, used to compute velocity-from-vorticity using Poisson solver.
+
+    \param warmStart            Whether vectorPotentialMultiGrid layer 0 already holds an initial guess for the iterative solver.
+                                Otherwise this starts from zero.
+
+    \todo   This routine calls SolveVectorPoisson which (depending on compiler settings inside that routine) uses "natural" boundary
+            conditions.  Instead, what we want to use "radiation" or "open" boundary conditions, where the boundary has "no influence",
+            that is, we want this solver to yield results consistent with using direct summation (or the other integral approaches).
+            To accomplish that, this routine could first use an integral technique (e.g. direct summation, treecode or multipole)
+            to compute vector potential at the boundaries, then use SolveVectorPoisson with "essential" boundary
+            conditions to populate the domain interior.  Incidentally that approach would also allow the domain to be closer
+            to the interior, rather than inflating the domain, as is done now to diminish the problematic influence of the boundary.
+*/
+void VortonSim::ComputeVectorPotential( NestedGrid< Vec3 > & vectorPotentialMultiGrid , NestedGrid< Vec3 > & negativeVorticityMultiGrid , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , bool warmStart )
+{
+    PERF_BLOCK( VortonSim__ComputeVectorPotential ) ;
+
+    ASSERT( ! mVortons->empty() ) ;
+
+    static const BoundaryConditionE boundaryCondition = BC_DIRICHLET ;
+
+    if( ! warmStart )
+    {   // No initial guess, so start from zero.  Otherwise keep guess in interior; boundary values get replaced below.
+        vectorPotentialMultiGrid[0].Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+    }
+
+    // Assign vector potential on domain boundary points.
+    // Note: For Part 19, assign vector potential everywhere in domain, not just on boundaries.
+    //       For Part 20, assign only on domain boundaries.
+    static const sBoundariesOnly = true ;
+    if( mPoissonSolver != POISSON_SOLVER_SPECTRAL_FREE_SPACE )
+    {   // Free-space Green's function accounts for vorticity everywhere, so needs no boundary values.
+        ComputeVectorPotentialFromVorticity_Integral( sBoundariesOnly , vortonIndicesGrid , influenceTree ) ;
+    }
+
+    if( POISSON_SOLVER_SPECTRAL_FREE_SPACE == mPoissonSolver )
+    {
+        mSpectralPoissonSolver.Solve( vectorPotentialMultiGrid[0] , negativeVorticityMultiGrid[ 0 ] , BC_FREE_SPACE ) ;
+    }
+    else if( POISSON_SOLVER_SPECTRAL == mPoissonSolver )
+    {   // Solve interior directly, in a fixed number of transform passes.
+        mSpectralPoissonSolver.Solve( vectorPotentialMultiGrid[0] , negativeVorticityMultiGrid[ 0 ] , boundaryCondition ) ;
+    }
+    else
+    {
+#   if VORTON_SIM_USE_MULTI_GRID
+
+        // Solve using multigrid cycles, each of which reduces the residual by a factor roughly independent of grid resolution.
+        // This leaves coarser layers of vectorPotentialMultiGrid and negativeVorticityMultiGrid intact, and uses mPoissonMultiGridScratch instead.
+        static const float      residualTolerance   = 1.0e-3f ; // Stop when residual falls below this fraction of its initial value.
+        const size_t            maxCycles           = ( mMaxPoissonIterations > 0 ) ? mMaxPoissonIterations : 8 ; // Stop after this many cycles regardless of residual.
+        static const unsigned   cycleIndex          = 1 ;       // 1 for V-cycle, 2 for W-cycle.
+        SolveVectorPoissonMultiGrid( vectorPotentialMultiGrid , negativeVorticityMultiGrid , mPoissonMultiGridScratch , boundaryCondition , residualTolerance , maxCycles , cycleIndex , warmStart , mPoissonResidualStats ) ;
+
+#   else
+
+#       pragma warning(push)
+#       pragma warning(disable: 4127) // conditional expression is constant
+        if( sBoundariesOnly )
+#       pragma warning(pop)
+        {
+            SolveVectorPoisson( vectorPotentialMultiGrid[0] , negativeVorticityMultiGrid[ 0 ] , /* numSteps; 0 means auto-choose */ mMaxPoissonIterations , boundaryCondition , mPoissonResidualStats ) ;
+        }
+        else
+        {
+            // For Part 19: Temporarily disable solving Poisson, to demonstrate using integral approach technique.
+            //              Notice call to ComputeVectorPotentialFromVorticity_Integral above.
+            UNUSED_PARAM( negativeVorticityMultiGrid ) ; // For Part 19, avoid unreferenced formal parameter compiler warning.  For Part 20, disable this line.
+        }
+
+#       if 0 // Test data flow / repeatability
+        {
+            UniformGrid< Vec3 > vectorPotentialDummy( mGridTemplate ) ;
+            vectorPotentialDummy.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+        ComputeVectorPotentialFromVorticity_Integral( sBoundariesOnly , vortonIndicesGrid , influenceTree ) ; // Note: This clobbers mVectorPotentialMultiGrid, which is likely the reason the assert below fails
+            SolveVectorPoisson( vectorPotentialDummy , negativeVorticityMultiGrid[0] , 0 , boundaryCondition , mPoissonResidualStats ) ;
+            ASSERT( vectorPotentialDummy == vectorPotentialMultiGrid[0] ) ;
+        }
+#       endif
+#   endif
+    }
+
+    if( mPoissonSolver != POISSON_SOLVER_MULTI_GRID )
+    {   // Spectral solvers are exact, to within roundoff, so have no residual.
+        mPoissonResidualStats.mMean = mPoissonResidualStats.mStdDev = mPoissonResidualStats.mMin = mPoissonResidualStats.mMax = 0.0f ;
+    }
+
+    mPoissonResidualStats_AcrossTime.mMean = ( mPoissonResidualStats.mMean + mPoissonResidualStats_AcrossTime.mMean ) * 0.5f ; // Incorrect aggregate of mean
+    mPoissonResidualStats_AcrossTime.mStdDev = ( mPoissonResidualStats.mStdDev + mPoissonResidualStats_AcrossTime.mStdDev ) * 0.5f ; // Incorrect aggregate of stdDev
+    mPoissonResidualStats_AcrossTime.mMin = Min2( mPoissonResidualStats.mMin , mPoissonResidualStats_AcrossTime.mMin ) ;
+    mPoissonResidualStats_AcrossTime.mMax = Max2( mPoissonResidualStats.mMax , mPoissonResidualStats_AcrossTime.mMax ) ;
+}
+
+
+
+
+/** Compute velocity due to vorticity, for every point in a uniform grid, by solving a vector Poisson partial differential equation.
+
+    \param vorticityGrid        Uniform grid of vorticity values, used to compute velocity-from-vorticity using Poisson solver.
+
+    \todo   This routine calls SolveVectorPoisson which (depending on compiler settings inside that routine) uses "natural" boundary
+            conditions.  Instead, what we want to use "radiation" or "open" boundary conditions, where the boundary has "no influence",
+            that is, we want this solver to yield results consistent with using direct summation (or the other integral approaches).
+            To accomplish that, this routine could first use an integral technique (e.g. direct summation, treecode or multipole)
+            to compute velocity (or the vector potential) at the boundaries, then use SolveVectorPoisson with "essential" boundary
+            conditions to populate the domain interior.  Incidentally that approach would also allow the domain to be closer
+            to the interior, rather than inflating the domain, as is done now to diminish the problematic influence of the boundary.
+*/
+void VortonSim::ComputeVelocityFromVorticity_Differential( NestedGrid< Vec3 > & negativeVorticityMultiGrid , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+{
+    PERF_BLOCK( VortonSim__ComputeVelocityFromVorticity_Differential ) ;
+
+    ASSERT( ! mVortons->empty() ) ;
+
+#if VORTON_SIM_WARM_START_POISSON
+    // Iterative solvers converge sooner from the previous solution, since vorticity changes little between updates.
+    // Spectral solvers do not use an initial guess.
+    const bool  iterative       = ( mPoissonSolver != POISSON_SOLVER_SPECTRAL ) && ( mPoissonSolver != POISSON_SOLVER_SPECTRAL_FREE_SPACE ) ;
+    const bool  havePrevious    =   ! mVectorPotentialMultiGrid.Empty()
+                                &&  ! mVectorPotentialMultiGrid[ 0 ].Empty()
+                                &&  ( mVectorPotentialMultiGrid[ 0 ].GetNumCells( 0 ) > 0 )
+                                &&  ( mVectorPotentialMultiGrid[ 0 ].GetNumCells( 1 ) > 0 )
+                                &&  ( mVectorPotentialMultiGrid[ 0 ].GetNumCells( 2 ) > 0 ) ;
+    const bool  warmStart       = iterative && havePrevious ;
+    if( ! warmStart )
+    {
+        mVectorPotentialMultiGrid.Initialize( mGridTemplate ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want.)
+    }
+    else if( ! mVectorPotentialMultiGrid[ 0 ].ShapeMatches( mGridTemplate ) )
+    {   // Grid moved or changed resolution, so interpolate previous solution into new geometry.
+        mVectorPotentialPrevious = mVectorPotentialMultiGrid[ 0 ] ;
+        mVectorPotentialMultiGrid.Initialize( mGridTemplate ) ;
+        mVectorPotentialMultiGrid[ 0 ].Resample( mVectorPotentialPrevious ) ;
+    }
+    // Otherwise grid did not change, so previous solution already lies where it should.  The solver reinitializes coarser layers itself.
+#else
+    mVectorPotentialMultiGrid.Initialize( mGridTemplate ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want.)
+    const bool  warmStart       = false ;
+#endif
+
+    ComputeVectorPotential( mVectorPotentialMultiGrid , negativeVorticityMultiGrid , vortonIndicesGrid , influenceTree , warmStart ) ;
+
+    UniformGrid< Vec3 > &   vectorPotentialGrid = mVectorPotentialMultiGrid[ 0 ] ;
+
+    ASSERT( mVelGrid.ShapeMatches( vectorPotentialGrid ) ) ;
+    ComputeCurl( mVelGrid , vectorPotentialGrid ) ;
+}
+
+
+
+
+/** Correct mesh velocity near vortons by direct summation, for a subset of points in a uniform grid.
+
+    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons near each gridpoint.
+
+    \param meshCoreRadius       Core radius of each vorton as the Poisson mesh represents it.  See sNearFieldMeshCoreScale.
+
+    \param izStart              Starting value for z index.
+
+    \param izEnd                One past ending value for z index.
+
+    For each vorton near each gridpoint, this adds the velocity due to the
+    vorton, minus the velocity due to the same vorton with its core
+    widened to meshCoreRadius, which approximates what the Poisson solver
+    already contributed.  Both use the same regularized kernel, which obeys
+    the inverse-square law outside the core, so their difference vanishes
+    beyond the larger of the two core radii.  That radius is the cutoff, so
+    only vortons in nearby cells of vortonIndicesGrid contribute.
+
+    \note This routine assumes the velocity grid holds the velocity obtained from the Poisson solver.
+
+*/
+void VortonSim::AddNearFieldVelocity_Slice( const CellList & vortonIndicesGrid , float meshCoreRadius , size_t izStart , size_t izEnd )
+{
+    const VECTOR< Vorton > &    vortons         = * mVortons ;
+    // Vortons usually share one size, as ENABLE_AUTO_MOLLIFICATION also assumes, so the first vorton's core sets the cutoff for all.
+    const float                 cutoff          = Max2( meshCoreRadius , vortons[ 0 ].GetRadius() * mSpreadingRangeFactor ) ;
+    const float                 cutoff2         = cutoff * cutoff ;
+    const float *               cellListMin     = reinterpret_cast< const float * >( & vortonIndicesGrid.GetMinCorner() ) ;
+    const float *               cellsPerExtent  = reinterpret_cast< const float * >( & vortonIndicesGrid.GetCellsPerExtent() ) ;
+    int                         numCells[ 3 ]   ;
+    int                         reach[ 3 ]      ;   // Number of vorton cells, along each axis, within cutoff of any point in a cell.
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        numCells[ axis ]    = int( vortonIndicesGrid.GetNumPoints( axis ) ) ;
+        reach[ axis ]       = int( ceilf( cutoff * cellsPerExtent[ axis ] ) ) ;
+    }
+
+    const Vec3 &        vMinCorner  = mVelGrid.GetMinCorner() ;
+    static const float  nudge       = 1.0f - 2.0f * FLT_EPSILON ;   // Match ComputeVelocityAtGridpoints_Slice.
+    const Vec3          vSpacing    = mVelGrid.GetCellSpacing() * nudge ;
+    const unsigned      dims[3]     =   { mVelGrid.GetNumPoints( 0 )
+                                        , mVelGrid.GetNumPoints( 1 )
+                                        , mVelGrid.GetNumPoints( 2 ) } ;
+    const unsigned      numXY       = dims[0] * dims[1] ;
+    unsigned            idx[ 3 ] ;
+    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
+    {   // For subset of z index values...
+        Vec3 vPosition ;
+        vPosition.z = vMinCorner.z + float( idx[2] ) * vSpacing.z ;
+        const unsigned offsetZ = idx[2] * numXY ;
+        for( idx[1] = 0 ; idx[1] < dims[1] ; ++ idx[1] )
+        {   // For every gridpoint along the y-axis...
+            vPosition.y = vMinCorner.y + float( idx[1] ) * vSpacing.y ;
+            const unsigned offsetYZ = idx[1] * dims[0] + offsetZ ;
+            for( idx[0] = 0 ; idx[0] < dims[0] ; ++ idx[0] )
+            {   // For every gridpoint along the x-axis...
+                vPosition.x = vMinCorner.x + float( idx[0] ) * vSpacing.x ;
+                const unsigned  offsetXYZ   = idx[0] + offsetYZ ;
+                const float *   position    = reinterpret_cast< const float * >( & vPosition ) ;
+
+                // Find range of vorton cells within cutoff of this gridpoint.
+                // Velocity grid can extend beyond vorton partition, so clamp, and let the distance test below reject vortons that clamping brings in.
+                int cellBegin[ 3 ] , cellEnd[ 3 ] ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis...
+                    const int idxCell = int( floorf( ( position[ axis ] - cellListMin[ axis ] ) * cellsPerExtent[ axis ] ) ) ;
+                    cellBegin[ axis ]   = Max2( idxCell - reach[ axis ] , 0 ) ;
+                    cellEnd[ axis ]     = Min2( idxCell + reach[ axis ] + 1 , numCells[ axis ] ) ;
+                }
+
+                Vec3 velocityExact  ( 0.0f , 0.0f , 0.0f ) ;
+                Vec3 velocityMesh   ( 0.0f , 0.0f , 0.0f ) ;
+                for( int iz = cellBegin[ 2 ] ; iz < cellEnd[ 2 ] ; ++ iz )
+                for( int iy = cellBegin[ 1 ] ; iy < cellEnd[ 1 ] ; ++ iy )
+                for( int ix = cellBegin[ 0 ] ; ix < cellEnd[ 0 ] ; ++ ix )
+                {   // For each vorton cell within cutoff...
+                    const CellList::Cell    cell                = vortonIndicesGrid.Get( ix , iy , iz ) ;
+                    const size_t            numVortonsInCell    = cell.Size() ;
+                    for( size_t ivHere = 0 ; ivHere < numVortonsInCell ; ++ ivHere )
+                    {   // For each vorton in this cell...
+                        const Vorton & rVorton = vortons[ cell[ ivHere ] ] ;
+                        if( ( vPosition - rVorton.mPosition ).Mag2() >= cutoff2 )
+                        {   // Vorton lies beyond cutoff, where the mesh already represents it accurately.
+                            continue ;
+                        }
+                        const float meshRangeFactor = meshCoreRadius / rVorton.GetRadius() ;
+                        VORTON_ACCUMULATE_VELOCITY( velocityExact , vPosition , rVorton ) ;
+                        VORTON_ACCUMULATE_VELOCITY_private( velocityMesh , vPosition , rVorton.mPosition , rVorton.mAngularVelocity , rVorton.mSize , meshRangeFactor , 1.0f / Pow3( meshRangeFactor ) ) ;
+                    }
+                }
+                mVelGrid[ offsetXYZ ] += velocityExact - velocityMesh ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Correct mesh velocity near vortons by direct summation, for every point in the velocity grid.
+
+    This is the particle-particle half of VELOCITY_FROM_VORTICITY_P3M;
+    ComputeVelocityFromVorticity_Differential supplies the particle-mesh
+    half.  Each gridpoint interacts only with vortons within a few cells, so
+    for a given vorton density, cost grows linearly with the number of
+    gridpoints.
+
+    \param vortonIndicesGrid    Spatial partition of the current vortons.
+
+    \see sNearFieldMeshCoreScale
+
+    \note This routine assumes the velocity grid holds the velocity obtained from the Poisson solver.
+*/
+void VortonSim::AddNearFieldVelocity( const CellList & vortonIndicesGrid )
+{
+    PERF_BLOCK( VortonSim__AddNearFieldVelocity ) ;
+
+    ASSERT( ! mVortons->Empty() ) ;
+
+#if USE_PARTICLE_IN_CELL
+    // vortonIndicesGrid partitions the original vortons, not the ghost vortons
+    // that currently occupy mVortons, so it cannot locate them.  Use mesh velocity alone.
+    UNUSED_PARAM( vortonIndicesGrid ) ;
+#else
+    if( vortonIndicesGrid.Empty() )
+    {   // Vortons have not been partitioned, so nearby vortons are unknown.  Use mesh velocity alone.
+        return ;
+    }
+
+    static const float  OneThird        = 1.0f / 3.0f ;
+    const float         meshCoreRadius  = sNearFieldMeshCoreScale * powf( mVelGrid.GetCellVolume() , OneThird ) ;
+    #if USE_TBB
+        // Split slices by number of nearby vortons, and correct velocity at gridpoints using multiple threads.
+        PartitionVelocityGridSlices( vortonIndicesGrid ) ;
+        Parallel::ForWeighted( mVelocityGridSlicePartition , Parallel::Method( this , & VortonSim::AddNearFieldVelocity_Slice , vortonIndicesGrid , meshCoreRadius ) , mAffinityPartitioners[ PARALLEL_LOOP_NEAR_FIELD_VELOCITY ] ) ;
+    #else
+        AddNearFieldVelocity_Slice( vortonIndicesGrid , meshCoreRadius , 0 , mVelGrid.GetNumPoints( 2 ) ) ;
+    #endif
+#endif
+}
+
+
+
+
+/** Compute velocity due to vortons, for every point in a uniform grid.
+
+    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons in a vicinity.
+                                This is mutually exclusive with vorticityGrid.
+
+    \param influenceTree        Nested grid of vortons and "super-vortons", used to compute velocity-from-vorticity using treecode.
+                                This is mutually exclusive with vorticityGrid.
+
+    \param vorticityGrid        Uniform grid of vorticity values, used to compute velocity-from-vorticity using Poisson solver.
+                                This is mutually exclusive with influenceTree.
+
+    This uses the technique SelectVelocityFromVorticityTechnique put in effect.
+
+    \see CreateInfluenceTree
+
+    \note This routine assumes CreateInfluenceTree has already executed.
+*/
+void VortonSim::ComputeVelocityFromVorticity( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , NestedGrid< Vec3 > & negativeVorticityMultiGrid )
+{
+    PERF_BLOCK( VortonSim__ComputeVelocityFromVorticity ) ;
+
+    mVelGrid.Clear() ;                      // Clear any stale velocity information
+#if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+    mVelocityGradientsAtVortons.Clear() ;   // Only the treecode refills this, so other techniques must not leave stale gradients.
+#endif
+    mVelGrid.CopyShape( mGridTemplate ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want.)
+    mVelGrid.Init() ;                       // Reserve memory for velocity grid.
+#if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+    mVelGridPatches.Reset( mVelGrid ) ;     // Remove stale patches.  Only integral techniques add new ones.
+#endif
+
+    if( mVortons->empty() )
+    {   // No vortons; no velocity.
+        return ;
+    }
+
+    if( UsesVorticityGrid( mVelFromVortTechniqueInEffect ) )
+    {
+        ComputeVelocityFromVorticity_Differential( negativeVorticityMultiGrid , vortonIndicesGrid , influenceTree ) ;
+        if( VELOCITY_FROM_VORTICITY_P3M == mVelFromVortTechniqueInEffect )
+        {   // Mesh blurs velocity near vortons, so replace that part by direct summation over nearby vortons.
+            AddNearFieldVelocity( vortonIndicesGrid ) ;
+        }
+    }
+    else
+    {
+        ComputeVelocityFromVorticity_Integral( vortonIndicesGrid , influenceTree ) ;
+    }
+}
+
+
+
+
+/** Return name of given technique for obtaining velocity from vorticity, for reports.
+*/
+/* static */ const char * VortonSim::GetVelocityFromVorticityTechniqueName( VelocityFromVorticityTechniqueE technique )
+{
+    static const char * sNames[ VELOCITY_FROM_VORTICITY_NUM ] = { "direct" , "tree" , "poisson" , "p3m" , "auto" } ;
+    ASSERT( technique < VELOCITY_FROM_VORTICITY_NUM ) ;
+    return sNames[ technique ] ;
+}
+
+
+
+
+VortonSim::VelocityTechniqueTuner::VelocityTechniqueTuner()
+{
+    Begin( 0 , 0 ) ;
+}
+
+
+
+
+/** Forget previous trials and start tuning for a problem of the given size.
+*/
+void VortonSim::VelocityTechniqueTuner::Begin( size_t numVortons , size_t numGridpoints )
+{
+    mNumVortons             = numVortons ;
+    mNumGridpoints          = numGridpoints ;
+    mCandidate              = 0 ;
+    mNumFramesOnCandidate   = 0 ;
+    for( unsigned iCandidate = 0 ; iCandidate < VELOCITY_FROM_VORTICITY_AUTO ; ++ iCandidate )
+    {   // For each candidate technique...
+        mSeconds[ iCandidate ] = FLT_MAX ;
+        mErrors[ iCandidate ]  = 0.0f ;
+    }
+    mChoice                 = VELOCITY_FROM_VORTICITY_AUTO ;    // Not yet chosen.
+}
+
+
+
+
+/** Return whether the problem has changed size enough since tuning began that a different technique could win.
+*/
+bool VortonSim::VelocityTechniqueTuner::IsStale( size_t numVortons , size_t numGridpoints ) const
+{
+    if( 0 == mNumVortons )
+    {   // Tuning has not begun.
+        return true ;
+    }
+    return  ( numVortons    > mNumVortons       * sRetuneRatio ) || ( numVortons    * sRetuneRatio < mNumVortons    )
+        ||  ( numGridpoints > mNumGridpoints    * sRetuneRatio ) || ( numGridpoints * sRetuneRatio < mNumGridpoints ) ;
+}
+
+
+
+
+/** Decide which technique to use to obtain velocity from vorticity, for the current update.
+
+    When the requested technique is VELOCITY_FROM_VORTICITY_AUTO, this
+    cycles through the candidates for sFramesPerCandidate frames each, during
+    which RecordVelocityFromVorticityTrial times them and measures their
+    error.  Then it uses the fastest candidate whose error meets
+    mVelocityErrorTarget, or the most accurate if none does, until the
+    number of vortons or gridpoints changes enough to warrant tuning again.
+
+    Direct summation tends to win for a few thousand vortons or fewer, the
+    Poisson solver for many vortons on large grids, and the treecode between.
+    The hybrid Poisson solver with near-field correction (P3M) tends to win
+    when vortons cluster too tightly for the Poisson solver alone to meet
+    the error target.
+
+    \note Call this before building the update stage graph, since which stages run depends on the technique.
+*/
+void VortonSim::SelectVelocityFromVorticityTechnique()
+{
+    if( VELOCITY_FROM_VORTICITY_AUTO != mVelFromVortTechnique )
+    {
+        mVelFromVortTechniqueInEffect = mVelFromVortTechnique ;
+        return ;
+    }
+
+    VelocityTechniqueTuner &    tuner           = mVelocityTechniqueTuner ;
+    const size_t                numVortons      = mVortons->Size() ;
+    const size_t                numGridpoints   = mGridTemplate.GetGridCapacity() ;
+    if( tuner.IsStale( numVortons , numGridpoints ) )
+    {
+        tuner.Begin( numVortons , numGridpoints ) ;
+    }
+
+    while(      ( VELOCITY_FROM_VORTICITY_DIRECT == tuner.mCandidate )
+            &&  ( double( numVortons ) * double( numGridpoints ) > sAutoTuneMaxDirectInteractions ) )
+    {   // Direct summation would take too long to be worth trying.
+        ++ tuner.mCandidate ;
+    }
+
+    if( tuner.mCandidate < VELOCITY_FROM_VORTICITY_AUTO )
+    {   // Still tuning.
+        mVelFromVortTechniqueInEffect = VelocityFromVorticityTechniqueE( tuner.mCandidate ) ;
+        return ;
+    }
+
+    if( VELOCITY_FROM_VORTICITY_AUTO == tuner.mChoice )
+    {   // Trials just finished.  Choose fastest candidate that meets the error target, or failing that, the most accurate.
+        unsigned fastest        = VELOCITY_FROM_VORTICITY_AUTO ;
+        unsigned mostAccurate   = VELOCITY_FROM_VORTICITY_AUTO ;
+        for( unsigned iCandidate = 0 ; iCandidate < VELOCITY_FROM_VORTICITY_AUTO ; ++ iCandidate )
+        {   // For each candidate technique...
+            if( FLT_MAX == tuner.mSeconds[ iCandidate ] )
+            {   // Candidate did not run.
+                continue ;
+            }
+            if( ( VELOCITY_FROM_VORTICITY_AUTO == mostAccurate ) || ( tuner.mErrors[ iCandidate ] < tuner.mErrors[ mostAccurate ] ) )
+            {
+                mostAccurate = iCandidate ;
+            }
+            if(     ( tuner.mErrors[ iCandidate ] <= mVelocityErrorTarget )
+                &&  ( ( VELOCITY_FROM_VORTICITY_AUTO == fastest ) || ( tuner.mSeconds[ iCandidate ] < tuner.mSeconds[ fastest ] ) ) )
+            {
+                fastest = iCandidate ;
+            }
+        }
+        ASSERT( mostAccurate < VELOCITY_FROM_VORTICITY_AUTO ) ; // Treecode and Poisson candidates always run.
+        tuner.mChoice = VelocityFromVorticityTechniqueE( ( fastest < VELOCITY_FROM_VORTICITY_AUTO ) ? fastest : mostAccurate ) ;
+    }
+
+    mVelFromVortTechniqueInEffect = tuner.mChoice ;
+}
+
+
+
+
+/** Record how long the technique in effect took to compute velocity, and how accurate it was, while tuning.
+
+    \param seconds  Wall-clock duration of ComputeVelocityFromVorticity.
+
+    \param error    Root-mean-square velocity error relative to direct summation.  See MeasureVelocityGridError.
+
+    \see SelectVelocityFromVorticityTechnique
+*/
+void VortonSim::RecordVelocityFromVorticityTrial( float seconds , float error )
+{
+    VelocityTechniqueTuner & tuner = mVelocityTechniqueTuner ;
+    ASSERT( VELOCITY_FROM_VORTICITY_AUTO == mVelFromVortTechnique ) ;
+    ASSERT( tuner.mCandidate == unsigned( mVelFromVortTechniqueInEffect ) ) ;
+
+    float cost = seconds ;
+    if( UsesVorticityGrid( mVelFromVortTechniqueInEffect ) )
+    {   // Only techniques that solve a Poisson equation need the vorticity grid, so charge them for populating that.
+        cost += mUpdateStageDurations[ UPDATE_STAGE_VORTICITY_GRID ] ;
+    }
+
+    // Keep the shortest duration, since the first frame can include one-time costs such as allocating grids.
+    tuner.mSeconds[ tuner.mCandidate ] = Min2( tuner.mSeconds[ tuner.mCandidate ] , cost ) ;
+    tuner.mErrors[ tuner.mCandidate ]  = Max2( tuner.mErrors[ tuner.mCandidate ] , error ) ;
+
+    ++ tuner.mNumFramesOnCandidate ;
+    if( tuner.mNumFramesOnCandidate >= VelocityTechniqueTuner::sFramesPerCandidate )
+    {   // Done with this candidate.
+        ++ tuner.mCandidate ;
+        tuner.mNumFramesOnCandidate = 0 ;
+    }
+}
+
+
+
+
+#if defined( _DEBUG )
+
+static void TrackVorticityAndKineticEnergyChange(
+      const VECTOR< Vorton > & vortons
+    , const Vec3 & totalVorticityBefore
+    , const float totalKineticEnergyBefore
+    , float totalVorticityChangeMagMax
+    , float totalVorticityChangeMagRelMax
+    , float totalKineticEnergyChangeMax
+    , float totalKineticEnergyChangeRelMax )
+{
+    const Vec3   totalVorticityAfter            = Vorton::ComputeTotalVorticity( vortons ) ;
+    const Vec3   totalVorticityChange           = totalVorticityAfter - totalVorticityBefore ;
+    const float  totalVorticityChangeMag        = totalVorticityChange.Magnitude() ;
+    const float  totalVorticityChangeMagRel     = totalVorticityChangeMag / totalVorticityBefore.Magnitude() ;
+    if( totalVorticityChangeMag > totalVorticityChangeMagMax )
+    {
+        totalVorticityChangeMagMax = totalVorticityChangeMag ;
+    }
+    if( totalVorticityChangeMagRel > totalVorticityChangeMagRelMax )
+    {
+        totalVorticityChangeMagRelMax = totalVorticityChangeMagRel ;
+    }
+
+    const float  totalKineticEnergyAfter        = Vorton::ComputeTotalKineticEnergy( vortons ) ;
+    const float  totalKineticEnergyChange       = totalKineticEnergyAfter - totalKineticEnergyBefore ;
+    const float  totalKineticEnergyChangeRel    = totalKineticEnergyChange / totalKineticEnergyBefore ;
+    if( fabsf( totalKineticEnergyChange ) > fabsf( totalKineticEnergyChangeMax ) )
+    {
+        totalKineticEnergyChangeMax = totalKineticEnergyChange ;
+    }
+    if( fabsf( totalKineticEnergyChangeRel ) > fabsf( totalKineticEnergyChangeRelMax ) )
+    {
+        totalKineticEnergyChangeRelMax = totalKineticEnergyChangeRel ;
+    }
+}
+
+#endif
+
+
+
+/** Stretch and tilt vortons using velocity field.
+
+    \param timeStep     Amount of time by which to advance simulation.
+
+    \param uFrame       Frame counter, used to generate diagnostic files.
+
+    \see GenerateBaroclinicVorticity, DiffuseAndDissipateVorticityPSE
+
+    \see J. T. Beale, A convergent three-dimensional vortex method with
+            grid-free stretching, Math. Comp. 46 (1986), 401-24, April.
+
+    \note This routine assumes CreateInfluenceTree has already executed.
+
+    \note This routine should run before advecting vortons, otherwise the vortons
+            could leave the velocity grid boundaries.
+
+*/
+void VortonSim::StretchAndTiltVortons( const float & timeStep , const unsigned & uFrame )
+{
+#if ENABLE_FLUID_BODY_SIMULATION
+
+    PERF_BLOCK( VortonSim__StretchAndTiltVortons ) ;
+
+    if(     ( 0.0f == mVelGrid.GetExtent().x )
+        ||  ( 0.0f == mVelGrid.GetExtent().y )
+        ||  ( 0.0f == mVelGrid.GetExtent().z ) )
+    {   // Domain is 2D, so stretching & tilting does not occur.
+        return ;
+    }
+
+    const size_t numVortons = mVortons->Size() ;
+
+#if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+    // When velocity-from-vorticity used the treecode, it also computed the velocity gradient at each vorton, so the velocity grid need not be differentiated.
+    const bool useTreeVelocityGradients = ( mVelocityGradientsAtVortons.Size() == numVortons ) ;
+#else
+    static const bool useTreeVelocityGradients = false ;
+#endif
+
+#if ! STRETCH_TILT_WITHOUT_JACOBIAN_GRID
+    // Compute all gradients of all components of velocity.
+    UniformGrid< Mat33 > velocityJacobianGrid( mVelGrid ) ;
+    if( ! useTreeVelocityGradients )
+    {
+        velocityJacobianGrid.Init() ;
+        ComputeJacobian( velocityJacobianGrid , mVelGrid ) ;
+    }
+#endif
+
+#if defined( _DEBUG )
+    if( mOutputDiagnostics )
+    {   // Compute curl from velocity, as a test.  This should approximately match the vorticity in mInfluenceTree[0].
+        UniformGrid< Vec3 > curl( /* Copy geometry only, not contents */ (UniformGridGeometry&) mVelGrid ) ;
+        curl.Init() ;
+        ComputeCurl( curl , mVelGrid ) ;
+        curl.GenerateBrickOfBytes( "curl" , uFrame ) ;
+        #if TEST_RESAMPLE_VORTONS && USE_GIVEN_VORT_GRID
+            vortonSim.AssignVortonsFromVorticity( curl ) ;
+        #endif
+    }
+    const Vec3  totalVorticityBefore     = Vorton::ComputeTotalVorticity( * mVortons ) ;
+    const float totalKineticEnergyBefore = Vorton::ComputeTotalKineticEnergy( * mVortons ) ;
+#endif
+    (void) uFrame ; // Avoid "unreferenced formal parameter" warning.
+
+#if VORTON_SIM_GATHER_STATS
+    mVorticityTermsStats.Reset( mVorticityTermsStats.mStretchTilt ) ;
+#endif
+
+#if USE_VORTON_SOA
+    mVortonSoa.Gather( * mVortons ) ;
+#endif
+
+    // Interpolate velocity Jacobian for batches of vortons at a time,
+    // so InterpolateMany can compute indices and weights for several vortons at once.
+    static const size_t batchSize = 64 ;
+    Vec3                positions[ batchSize ] ;
+    Mat33               velocityJacobians[ batchSize ] ;
+#if STRETCH_TILT_WITHOUT_JACOBIAN_GRID
+    // Sample velocity one cell on either side of each vorton, along each axis.
+    static const size_t numSamplesPerVorton = 6 ;
+    Vec3                samplePositions[ batchSize * numSamplesPerVorton ] ;
+    Vec3                sampleVelocities[ batchSize * numSamplesPerVorton ] ;
+    const Vec3          cellSpacing     = mVelGrid.GetCellSpacing() ;
+    const Vec3          displacements[ 3 ] = { Vec3( cellSpacing.x , 0.0f , 0.0f ) , Vec3( 0.0f , cellSpacing.y , 0.0f ) , Vec3( 0.0f , 0.0f , cellSpacing.z ) } ;
+    // Keep samples strictly inside the grid, so interpolation never indexes past the last cell.
+    const Vec3          sampleMin       = mVelGrid.GetMinCorner() ;
+    const Vec3          sampleMax       = mVelGrid.GetMaxCorner() - cellSpacing * 1.0e-3f ;
+#endif
+
+    for( size_t batchBegin = 0 ; batchBegin < numVortons ; batchBegin += batchSize )
+    {   // For each batch of vortons...
+        const size_t numInBatch = Min2( batchSize , numVortons - batchBegin ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each vorton in batch...
+        #if USE_VORTON_SOA
+            positions[ iInBatch ] = mVortonSoa.GetPosition( batchBegin + iInBatch ) ;
+        #else
+            positions[ iInBatch ] = (*mVortons)[ batchBegin + iInBatch ].mPosition ;
+        #endif
+        }
+        if( useTreeVelocityGradients )
+        {   // Use velocity gradient that velocity-from-vorticity computed at each vorton.
+        #if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+            for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+            {   // For each vorton in batch...
+                velocityJacobians[ iInBatch ] = mVelocityGradientsAtVortons[ batchBegin + iInBatch ] ;
+            }
+        #endif
+        }
+        else
+        {   // Differentiate velocity grid.
+        #if STRETCH_TILT_WITHOUT_JACOBIAN_GRID
+            for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+            {   // For each vorton in batch...
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis, sample behind then ahead of vorton.
+                    Vec3 & rBehind = samplePositions[ iInBatch * numSamplesPerVorton + 2 * axis     ] ;
+                    Vec3 & rAhead  = samplePositions[ iInBatch * numSamplesPerVorton + 2 * axis + 1 ] ;
+                    rBehind = positions[ iInBatch ] - displacements[ axis ] ;
+                    rAhead  = positions[ iInBatch ] + displacements[ axis ] ;
+                    rBehind = Vec3( Clamp( rBehind.x , sampleMin.x , sampleMax.x ) , Clamp( rBehind.y , sampleMin.y , sampleMax.y ) , Clamp( rBehind.z , sampleMin.z , sampleMax.z ) ) ;
+                    rAhead  = Vec3( Clamp( rAhead.x  , sampleMin.x , sampleMax.x ) , Clamp( rAhead.y  , sampleMin.y , sampleMax.y ) , Clamp( rAhead.z  , sampleMin.z , sampleMax.z ) ) ;
+                }
+            }
+            mVelGrid.InterpolateMany( samplePositions , sampleVelocities , numInBatch * numSamplesPerVorton ) ;
+            for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+            {   // For each vorton in batch...
+                const Vec3 * samplePosition = & samplePositions [ iInBatch * numSamplesPerVorton ] ;
+                const Vec3 * sampleVelocity = & sampleVelocities[ iInBatch * numSamplesPerVorton ] ;
+                // Divide by actual separation, which is less than 2 cells when clamping moved a sample, so derivatives become one-sided there.
+                velocityJacobians[ iInBatch ] = Mat33( ( sampleVelocity[ 1 ] - sampleVelocity[ 0 ] ) / ( samplePosition[ 1 ].x - samplePosition[ 0 ].x )
+                                                     , ( sampleVelocity[ 3 ] - sampleVelocity[ 2 ] ) / ( samplePosition[ 3 ].y - samplePosition[ 2 ].y )
+                                                     , ( sampleVelocity[ 5 ] - sampleVelocity[ 4 ] ) / ( samplePosition[ 5 ].z - samplePosition[ 4 ].z ) ) ;
+            }
+        #else
+            velocityJacobianGrid.InterpolateMany( positions , velocityJacobians , numInBatch ) ;
+        #endif
+        }
+
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each vorton in batch...
+            const size_t    offset      = batchBegin + iInBatch ;
+        #if USE_VORTON_SOA
+            Vec3            angVel      = mVortonSoa.GetAngularVelocity( offset ) ;
+        #else
+            Vec3 &          angVel      = (*mVortons)[ offset ].mAngularVelocity ;
+        #endif
+            const Mat33 &   velJac      = velocityJacobians[ iInBatch ] ;
+            // Compute stretching & tilting:
+        #if 1
+            const Vec3  stretchTilt = angVel * velJac ;    // ...using transpose formulation.
+        #else
+            const Vec3  stretchTilt = velJac * angVel ;    // ...using "classical" formulation.
+        #endif
+        #if VORTON_SIM_GATHER_STATS
+            mVorticityTermsStats.mStretchTilt.Accumulate( stretchTilt.Magnitude() ) ;
+        #endif
+            angVel += 0.5f * stretchTilt * timeStep ;
+        #if USE_VORTON_SOA
+            mVortonSoa.SetAngularVelocity( offset , angVel ) ;
+        #endif
+        }
+    }
+
+#if USE_VORTON_SOA
+    mVortonSoa.ScatterAngularVelocity( * mVortons ) ;
+#endif
+
+#if VORTON_SIM_GATHER_STATS
+    mVorticityTermsStats.mStretchTilt.ConvertAccumulatedSamplesToStats( numVortons ) ;
+#endif
+
+#if defined( _DEBUG )
+    {   // In principle, stretching and tilting should not change bulk vorticity or kinetic energy.
+        static float totalVorticityChangeMagMax     = 0.0f ;
+        static float totalVorticityChangeMagRelMax  = 0.0f ;
+        static float totalKineticEnergyChangeMax    = 0.0f ;
+        static float totalKineticEnergyChangeRelMax = 0.0f ;
+        TrackVorticityAndKineticEnergyChange( * mVortons , totalVorticityBefore , totalKineticEnergyBefore , totalVorticityChangeMagMax , totalVorticityChangeMagRelMax , totalKineticEnergyChangeMax , totalKineticEnergyChangeRelMax ) ;
+    }
+#endif
+
+#endif
+}
+
+
+
+
+/** Populate a UniformGrid with velocity values from vortons.
+
+    \param velocityGrid (out) Grid into which to transfer velocity values.
+
+    \param particles    Dynamic array of particles whose velocity information to
+                        accumulate into velocityGrid.
+
+*/
+void VortonSim::PopulateVelocityGrid( UniformGrid< Vec3 > & velocityGrid , const VECTOR< Particle > & particles )
+{
+    PERF_BLOCK( VortonSim__PopulateVelocityGrid ) ;
+
+    velocityGrid.Clear() ;                              // Clear any stale density information.
+    velocityGrid.CopyShape( mGridTemplate ) ;           // Use same shape as base vorticity grid. (Note: could differ if you want.)
+    Particles::PopulateVelocityGrid( velocityGrid , particles ) ;
+}
+
+
+
+
+#if defined( _DEBUG )
+
+static const float tolerance = 0.001f ;
+
+/** Diagnose density grid.
+
+    This routine can be called per particle, to isolate problems populating the
+    density grid.
+*/
+static void VerifyDensityGrid( const UniformGrid< float > & densityGrid , const UniformGrid< float > ugParticleContribution , float volumeCorrection , float massSumVortons )
+{
+    PERF_BLOCK( VortonSim__VerifyDensityGrid ) ;
+
+#if VERIFY_NEUTRALLY_BUOYANT_DENSITY    // For diagnosing density grid population. Works only for neutrally buoyant configurations.
+    for( unsigned offset = 0 ; offset < densityGrid.GetGridCapacity() ; ++ offset )
+    {   // For each point in grid...
+        const float pclsContrib = ugParticleContribution[ offset ] ;
+
+        if( pclsContrib != 0.0f )
+        {
+            const float densFromGrid = densityGrid[ offset ] ;
+            const float densOfPcls   = densFromGrid / pclsContrib ;
+            if( ! Math::Resembles( densOfPcls , volumeCorrection , tolerance ) )
+            {   // Density has an unexpected value.
+                int i ; i = 0 ; ++ i ;  // Set breakpoint here.
+            }
+        }
+
+        const float clampedVolCorrectedPclsContrib  = Min2( pclsContrib * volumeCorrection , 1.0f ) ;
+        const float ambientDensityContrib           = 1.0f - clampedVolCorrectedPclsContrib  ;
+        const float totalContribution               = clampedVolCorrectedPclsContrib + ambientDensityContrib ;
+
+        if( ! Math::Resembles( totalContribution , 1.0f , tolerance ) )
+        {   // Corrected contribution tally is not exactly full.
+            // That could legitimately happen if particles "over" contribute,
+            // that is, if ambient does not contribute.  That probably means
+            // multiple particles contributed to a single gridpoint.
+            if( ambientDensityContrib > 0.0f )
+            {   // Clamping did not kick in so ambient did contribute.
+                // Corrected contribution tally has an unexpected value.
+                int i ; i = 0 ; ++ i ;  // Set breakpoint here.
+            }
+        }
+    }
+#else
+    UNUSED_PARAM( volumeCorrection ) ;
+#endif
+
+    {   // Verify mass is the same for particles and grid.
+        const float densityGridSum  = densityGrid.Sum() * densityGrid.GetCellVolume() ;
+        const float massSumGrid     = densityGridSum ;
+        ASSERT( Math::Resembles( massSumVortons , massSumGrid ) ) ;
+    }
+}
+#endif
+
+
+
+
+/** Density, contribution and mass fraction sources for UniformGridScatter, one per particle.
+
+    Values go to, in order: density, particle contribution and, when ENABLE_FIRE, fuel, flame and smoke fractions.
+*/
+class VortonSim_DensitySources
+{
+    public:
+        VortonSim_DensitySources( const VECTOR< Particle > & particles , float volumeRatio )
+            : mParticles( particles )
+            , mVolumeRatio( volumeRatio )
+        {}
+
+        size_t          GetNumSources() const                           { return mParticles.Size() ; }
+        const Vec3 &    GetPosition( size_t iSource ) const             { return mParticles[ iSource ].mPosition ; }
+
+        void GetValues( size_t iSource , float values[] ) const
+        {
+            const Particle & rParticle = mParticles[ iSource ] ;
+            values[ 0 ] = rParticle.mDensity * mVolumeRatio ;
+            // Tally particle contribution to each gridpoint.
+            // Note that technically 1.0 here should be volume-corrected, but we
+            // assume volume correction is uniform and apply it later.
+            values[ 1 ] = 1.0f ;
+        #if ENABLE_FIRE
+            // Since fractions should average (not add), need to divide by contribution later.
+            values[ 2 ] = rParticle.mFuelFraction  ;
+            values[ 3 ] = rParticle.mFlameFraction ;
+            values[ 4 ] = rParticle.mSmokeFraction ;
+        #endif
+        }
+
+    private:
+        VortonSim_DensitySources & operator=( const VortonSim_DensitySources & ) ; // Disallow assignment.
+
+        const VECTOR< Particle > &  mParticles      ;   ///< Particles whose density and mass fractions to accumulate
+        const float                 mVolumeRatio    ;   ///< Ratio of particle volume to grid cell volume
+} ;
+
+
+
+
+/** Populate a UniformGrid with density and mass fraction values from vortons.
+
+    \param densityGrid (out)    Grid into which to transfer density values.
+
+    \param particles    Dynamic array of particles whose density information to
+                        accumulate into densityGrid.
+*/
+void VortonSim::PopulateDensityAndMassFractionGrids( UniformGrid< float > & densityGrid , const VECTOR< Particle > & particles , const unsigned uFrame )
+{
+    PERF_BLOCK( VortonSim__PopulateDensityAndMassFractionGrids ) ;
+
+    if( & densityGrid == & mDensityGrid )
+    {   // Grids derived from the density grid become stale.
+        ++ mDensityGridStamp ;
+    }
+
+    densityGrid.Clear() ;                       // Clear any stale density information.
+    densityGrid.Expand( mGridTemplate , 1 ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want; just change expansion factor from 1 to whatever, though ideally a power of 2.)
+    densityGrid.Init( 0.0f )                ;   // Reserve memory for density grid and initialize all values to zero.
+
+    const UniformGridGeometry & gridGeometry = static_cast< UniformGridGeometry >( densityGrid ) ;
+
+#if ENABLE_FIRE
+    mFuelFractionGrid.Clear() ;
+    mFuelFractionGrid.CopyShape( gridGeometry ) ;
+    mFuelFractionGrid.Init( 0.0f ) ;
+
+    mFlameFractionGrid.Clear() ;
+    mFlameFractionGrid.CopyShape( gridGeometry ) ;
+    mFlameFractionGrid.Init( 0.0f ) ;
+
+    mSmokeFractionGrid.Clear() ;
+    mSmokeFractionGrid.CopyShape( gridGeometry ) ;
+    mSmokeFractionGrid.Init( 0.0f ) ;
+#endif
+
+    DEBUG_ONLY( float massSumVortons = 0.0f ) ;
+
+    // The grid resulting from this operation must preserve the same total mass 
+    // that the particles represent, so multiply by the ratio of the particle 
+    // volume to gridcell volume.
+    // Assume vortons all have same volume.  If they do not, the formula inside
+    // the loop becomes more complicated.
+    const float oneOverCellVolume   = 1.0f / densityGrid.GetCellVolume() ;
+    const float vortonVolume        = particles[ 0 ].GetVolume() ;
+    const float volumeRatio         = vortonVolume * oneOverCellVolume ;
+
+    // Amount of contribution to each grid point.
+    UniformGrid< float > ugParticleContribution( gridGeometry ) ;
+    ugParticleContribution.Init( 0.0f ) ;
+
+    // Populate density and mass-fraction grids.
+#if ENABLE_FIRE
+    UniformGrid< float > * grids[] = { & densityGrid , & ugParticleContribution , & mFuelFractionGrid , & mFlameFractionGrid , & mSmokeFractionGrid } ;
+#else
+    UniformGrid< float > * grids[] = { & densityGrid , & ugParticleContribution } ;
+#endif
+    const VortonSim_DensitySources sources( particles , volumeRatio ) ;
+    ScatterIntoGrids( grids , sizeof( grids ) / sizeof( grids[ 0 ] ) , sources ) ;
+
+#if defined( _DEBUG )
+    const size_t numParticles = particles.Size() ;
+    for( size_t uParticle = 0 ; uParticle < numParticles ; ++ uParticle )
+    {   // For each particle in the array...
+        const Particle  &   rParticle   = particles[ uParticle ] ;
+        const Vec3      &   rPosition   = rParticle.mPosition   ;
+        ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
+
+        const unsigned      uOffset     = densityGrid.OffsetOfPosition( rPosition ) ;
+        ASSERT( uOffset < densityGrid.GetGridCapacity() ) ;
+
+        ASSERT( rParticle.mDensity > 0.0f ) ;
+        ASSERT( fabsf( rParticle.GetVolume() - vortonVolume ) < FLT_EPSILON ) ; // Assuming vorton volume is uniform.  Otherwise formula changes.
+
+        massSumVortons += rParticle.GetMass() ;
+
+    #if ENABLE_FIRE
+        const float totalFraction = rParticle.mFuelFraction + rParticle.mFlameFraction + rParticle.mSmokeFraction ;
+        ASSERT( ( 0.0f == totalFraction ) || Math::Resembles( totalFraction , 1.0f ) ) ;
+    #endif
+    }
+#endif
+
+    DEBUG_ONLY( VerifyDensityGrid( densityGrid , ugParticleContribution , volumeRatio , massSumVortons ) ) ;
+
+    // Apply per-gridpoint corrections.
+    const unsigned densityGridCapacity = densityGrid.GetGridCapacity() ;
+    for( unsigned offset = 0 ; offset < densityGridCapacity ; ++ offset )
+    {   // For each point in grid...
+
+        // Add ambient density contribution.
+        // Fluid pervades the region even in the absence of particles.
+        // Particles provide information (like density) where they reside
+        // but when absent, there is still fluid.  Multiple particles can
+        // contribute to each grid cell.  Particles contribute to each gridpoint
+        // inversely proportational to their distance to it. Whether N particles
+        // each contribute 1/N of their mass, or a single particle contributes
+        // all of its mass, the result is the same.  That makes it possible for
+        // N particles to have the cummulative contribution to a particular gridpoint equal or exceed 1.0.  In
+        // that case, ambient contributes nothing.  If particle contribution
+        // is zero at a gridpoint then that gridpoint has only ambient density.
+        // If the contribution is in (0,1) then ambient contributes a complementary amount.
+        //
+        // Details:
+        //    Each particle i contributes phi_i fraction of its rho_i density.
+        //    Each gridpoint then has a tuple < SUM_i rho_i phi_i , SUM_i phi_i >.
+        //    Ambient contributes PHI_0 = max( 1 - SUM_i phi_i , 0 )
+        //    so the density rho at a gridpoint is
+        //        rho = SUM_i rho_i phi_i + PHI_0 * rho_0.
+        const float pclsContrib             = ugParticleContribution[ offset ] * volumeRatio ; // Technically volumeRatio should be in ugParticleContribution already. This assumes it is uniform.
+        const float clampedPclsContrib      = Min2( pclsContrib , 1.0f ) ;
+        const float ambientDensityContrib   = 1.0f - clampedPclsContrib ;
+
+        densityGrid[ offset ] += ambientDensityContrib * mAmbientDensity ;
+
+    #if VERIFY_NEUTRALLY_BUOYANT_DENSITY    // For diagnosing density grid population. Works only for neutrally buoyant configurations
+        if( ! Math::Resembles( densityGrid[ offset ] , 1.0f , tolerance ) )
+        {   // Corrected density does not match ambient.
+            // That could legitimately happen if particles "over" contribute,
+            // that is, if ambient does not contribute.  That probably means
+            // multiple particles contributed to a single gridpoint.
+            const float ddg = densityGrid[ offset ] ; (void) ddg ;
+            if( ambientDensityContrib > 0.0f )
+            {   // Clamping did not kick in so ambient did contribute.
+                // Corrected density has an unexpected value.
+                int i ; i = 0 ; ++ i ;  // Set breakpoint here.
+            }
+        }
+    #endif
+
+    #if ENABLE_FIRE
+        // Turn mass-fraction sums into averages.
+        // This assumes "1" was accumulated instead of volumeRatio.
+        // Technically volumeRatio should have been accumulated for contribution,
+        // and particle number would have to be tallied separately.
+        // But here we exploit the fact that vorton volume is uniform.
+        if( ugParticleContribution[ offset ] > 0.0f )
+        {
+            const float oneOverContribution = 1.0f / ugParticleContribution[ offset ] ;
+            mFuelFractionGrid [ offset ] *= oneOverContribution ;
+            mFlameFractionGrid[ offset ] *= oneOverContribution ;
+            mSmokeFractionGrid[ offset ] *= oneOverContribution ;
+            DEBUG_ONLY( const float totalFraction = mFuelFractionGrid[ offset ] + mFlameFractionGrid[ offset ] + mSmokeFractionGrid[ offset ] ) ;
+            DEBUG_ONLY( (void) totalFraction ) ;
+        }
+    #endif
+    }
+
+    ASSERT( ! densityGrid.HasZeroExtent() ) ;
+
+    #if defined( _DEBUG ) || VORTON_SIM_OUTPUT_DENSITY
+    if( mOutputDiagnostics )
+    {   // Output density for visualization.
+        mDensityGrid.GenerateBrickOfBytes( "density" , uFrame ) ;
+    }
+    #else
+        UNUSED_PARAM( uFrame ) ;
+    #endif
+}
+
+
+
+
+#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
+
+static void PoisonDensityGradientSlice( UniformGrid< Vec3 > & densityGradientGrid , const VECTOR< Vorton > & particles , size_t iPclStart , size_t iPclEnd )
+{
+    // Poison density gradient grid based on vortons in contact with container boundaries.
+    const Vec3 zero( 0.0f , 0.0f , 0.0f ) ;
+    for( size_t iParticle = iPclStart ; iParticle < iPclEnd ; ++ iParticle )
+    {   // For each particle in the array...
+        const Particle  &   rParticle   = particles[ iParticle ] ;
+        if( rParticle.mHitBoundary )
+        {   // This particle hit a boundary.
+            const Vec3      &   rPosition   = rParticle.mPosition   ;
+            ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
+            // Zero out any gradients along contact normal.
+            // Remove normal component at each surrounding gridpoint.
+        #if USE_TBB && 0
+            densityGradientGrid.RemoveComponent_ThreadSafe( rPosition , rParticle.mHitNormal ) ;
+        #else
+            densityGradientGrid.RemoveComponent( rPosition , rParticle.mHitNormal ) ;
+        #endif
+        }
+    }
+}
+
+
+
+
+/** Remove component of density gradient parallel to surface normals, where vortons contacted with container boundaries.
+
+    This uses hit info from previous frame, and the latency leaves spurious
+    torque especially notable on the first frame.
+
+    Resetting the whole grid cell means particles near, but not at, boundaries
+    do not get the torque they need to flatten surface.
+
+*/
+static void PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , const VECTOR< Vorton > & particles )
+{
+    PERF_BLOCK( PoisonDensityGradient_VortonHits ) ;
+
+    const size_t numVortons = particles.Size() ;
+
+#if USE_TBB && 0 // Thread-safe multi-threaded version runs slower than serial version, so this is disabled.
+    // Estimate grain size based on size of problem and number of processors.
+    const size_t grainSize =  Max2( 1 , numVortons / gNumberOfProcessors ) ;
+    // Compute velocity at gridpoints using multiple threads.
+    Parallel::For( 0 , numVortons , grainSize , Parallel::Function( PoisonDensityGradientSlice , densityGradientGrid , particles ) ) ;
+#else
+    PoisonDensityGradientSlice( densityGradientGrid , particles , 0 , numVortons ) ;
+#endif
+}
+
+#endif
+
+
+
+
+#if POISON_DENSITY_GRADIENT_BASED_ON_RIGID_SPHERE_GEOMETRY
+/** Remove spurious density gradients that could arise due to geometric arrangement of vortons.
+
+    Any gradient due to the arrangement of packed hard spheres is a spurious artifact of geometry.
+    Closest packing leads to an average density of pi/sqrt(18)~=0.74048.
+    Farthest packing leads to an average density of 4pi/24~=0.52350.
+    Their ratio is 1/sqrt(2)~=0.70711.  So a variation smaller than (1-1/sqrt(2))~=0.29289
+    is unreliable.  Note that applying this ratio requires knowing the density
+    at each point where this is applied.  So the algorithm would need density as well as its gradient.
+*/
+static void PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , UniformGrid< float > & densityGrid )
+{
+    PERF_BLOCK( PoisonDensityGradient_SphereGeometry ) ;
+
+    const Vec3 zero( 0.0f , 0.0f , 0.0f ) ;
+    const unsigned densityGradientGridCapacity = densityGradientGrid.GetGridCapacity() ;
+    for( unsigned offset = 0 ; offset < densityGradientGridCapacity ; ++ offset )
+    {   // For each point in grid...
+        Vec3 gridPointPosition ;
+        densityGradientGrid.PositionFromOffset( gridPointPosition , offset ) ;
+        // Test whether grid point is inside rigid body.
+        // If so, set gradient to zero there.
+        Vec3 &          densGrad        = densityGradientGrid[ offset ] ;
+        const float     densGradMag2    = densGrad.Mag2() ;
+        const float &   density         = densityGrid[ offset ] ;
+        const float     densGrad2Thresh = 0.29289f * density ;
+
+        if( densGradMag2 < densGrad2Thresh )
+        {
+            densGrad = zero ;
+        }
+    }
+}
+#endif
+
+
+
+
+#if ENABLE_FIRE
+/** Return exponential of each lane of the given argument, using COMBUSTION_EXP_TECHNIQUE.
+
+    Float4 has no exponential, so this evaluates each lane separately.
+*/
+static inline Float4 CombustionExp( const Float4 & arg )
+{
+    float lanes[ Float4::WIDTH ] ;
+    arg.Store( lanes ) ;
+    for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+    {   // For each lane...
+    #if COMBUSTION_EXP_TECHNIQUE == COMBUSTION_EXP_TECHNIQUE_EXACT
+        lanes[ iLane ] = expf( lanes[ iLane ] ) ;
+    #else
+        lanes[ iLane ] = ImpreciseExpF( lanes[ iLane ] ) ;
+    #endif
+    }
+    return Float4::Load( lanes ) ;
+}
+
+
+
+
+/** Return temperature dependence of combustion rate, for each lane.
+
+    \param temperature              Temperature of each of Float4::WIDTH vortons, in absolute degrees.
+
+    \param combustionTemperature    Activation temperature for combustion reaction.
+*/
+static inline Float4 CombustionTemperatureDependence( const Float4 & temperature , float combustionTemperature )
+{
+#if ! USE_ARRHENIUS
+    return Float4::Select( Float4( combustionTemperature ).LessThan( temperature ) , Float4( 1.0f ) , Float4( 0.0f ) ) ;
+#elif COMBUSTION_EXP_TECHNIQUE == COMBUSTION_EXP_TECHNIQUE_TABLE
+    float lanes[ Float4::WIDTH ] ;
+    ( temperature * Float4( 1.0f / combustionTemperature ) ).Store( lanes ) ;
+    for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+    {   // For each lane...
+        lanes[ iLane ] = gArrheniusRateTable.Evaluate( lanes[ iLane ] ) ;
+    }
+    return Float4::Load( lanes ) ;
+#else
+    return CombustionExp( - Float4( combustionTemperature ) / temperature ) ;
+#endif
+}
+#endif
+
+
+
+
+/** Process combustion for a subset of vortons, and assign mass fractions.
+
+    \param timeStep     Amount of time by which to advance simulation.
+
+    \param iPclStart    Index of first vorton to process.
+
+    \param iPclEnd      One past index of last vorton to process.
+
+    This processes Float4::WIDTH vortons at a time, and selects the outcome of
+    each conditional (whether a vorton is on fire, whether it has fuel) with a
+    mask rather than a branch, so all lanes execute the same instructions.
+    The last group pads unused lanes with inert values (no fuel, no flame).
+
+    \see CombustAndSetMassFractions
+*/
+void VortonSim::CombustAndSetMassFractionsSlice( float timeStep , size_t iPclStart , size_t iPclEnd )
+{
+#if ENABLE_FIRE
+
+    PERF_BLOCK_INNER( VortonSim__CombustAndSetMassFractionsSlice ) ;
+
+    const Float4    zero                        ( 0.0f ) ;
+    const Float4    ambientDensityTemperature   ( mAmbientDensity * Particle_sAmbientTemperature ) ;
+    const Float4    oneOverSmokeTemperature     ( 1.0f / mSmokeTemperature ) ;
+    const Float4    smokeChangePerFlame         ( mSmokeRateFactor * timeStep ) ;
+    const Float4    flameChangePerFuel          ( mCombustionRateFactor * timeStep ) ;
+    const Float4    temperatureChangePerMass    ( mSpecificFreeEnergy * mSpecificHeatCapacity ) ;
+
+    VECTOR< Vorton > & vortons = * mVortons ;
+
+    for( size_t iPclGroup = iPclStart ; iPclGroup < iPclEnd ; iPclGroup += Float4::WIDTH )
+    {   // For each group of vortons in this slice...
+        const unsigned numInGroup = unsigned( Min2( size_t( Float4::WIDTH ) , iPclEnd - iPclGroup ) ) ;
+
+        float fuelLanes[ Float4::WIDTH ] , flameLanes[ Float4::WIDTH ] , densityLanes[ Float4::WIDTH ] ;
+        for( unsigned iLane = 0 ; iLane < Float4::WIDTH ; ++ iLane )
+        {   // For each lane, gather vorton or pad.
+            if( iLane < numInGroup )
+            {
+                const Vorton & rVorton = vortons[ iPclGroup + iLane ] ;
+                ASSERT( ! IsNan( rVorton.mFuelFraction  ) && ! IsInf( rVorton.mFuelFraction  ) ) ;
+                ASSERT( ! IsNan( rVorton.mFlameFraction ) && ! IsInf( rVorton.mFlameFraction ) ) ;
+                fuelLanes[ iLane ]      = rVorton.mFuelFraction ;
+                flameLanes[ iLane ]     = rVorton.mFlameFraction ;
+                densityLanes[ iLane ]   = rVorton.GetDensity() ;
+            }
+            else
+            {
+                fuelLanes[ iLane ]      = 0.0f ;
+                flameLanes[ iLane ]     = 0.0f ;
+                densityLanes[ iLane ]   = mAmbientDensity ;
+            }
+        }
+
+        Float4          fuel        = Float4::Load( fuelLanes ) ;
+        Float4          flame       = Float4::Load( flameLanes ) ;
+        Float4          density     = Float4::Load( densityLanes ) ;
+        const Float4    temperature = ambientDensityTemperature / density ;  // See Particle::GetTemperature.
+
+        {   // Convert flame to smoke, in vortons on fire.
+        #if 0 // Stam & Fiume (1995) -- Akin to an inverse Arrhenius reaction rate.
+            const Float4 temperatureDependence  = CombustionExp( - temperature * oneOverSmokeTemperature ) ;
+        #elif 1 // MJG "gradual step" function (Gaussian)
+            const Float4 arg1                   = temperature * oneOverSmokeTemperature ;
+            const Float4 temperatureDependence  = CombustionExp( - arg1 * arg1 ) ;
+        #else // Step function
+            const Float4 temperatureDependence  = Float4::Select( temperature.LessThan( Float4( mSmokeTemperature ) ) , Float4( 1.0f ) , zero ) ;
+        #endif
+            const Float4 flameToSmokeChange     = smokeChangePerFlame * temperatureDependence * flame ;
+            // Decrease amount of flame.  This automatically increases the amount of smoke,
+            // since (smokeFraction) is defined as 1-mFlameFraction-mFuelFraction.
+            // Note that flame-to-smoke conversion happens first.  This
+            // allows for flames to appear for at least a frame even if the burn
+            // rate is extremely high.  If the order of operations was
+            // fuel-to-flame and flame-to-smoke, then fuel could turn to smoke
+            // in a single frame without flame ever getting a change to render.
+            flame = Float4::Select( zero.LessThan( flame ) , flame - flameToSmokeChange , flame ) ;
+        }
+
+        {   // Convert fuel to flame, and release heat, in vortons with fuel.
+            const Float4 hasFuel                = zero.LessThan( fuel ) ;
+            const Float4 temperatureDependence  = CombustionTemperatureDependence( temperature , mCombustionTemperature ) ;
+            const Float4 fuelToFlameChange      = flameChangePerFuel * temperatureDependence * fuel ;
+            // Decrease amount of fuel and increase amount of flame.
+            fuel  = Float4::Select( hasFuel , fuel  - fuelToFlameChange , fuel  ) ;
+            flame = Float4::Select( hasFuel , flame + fuelToFlameChange , flame ) ;
+
+            // Change temperature due to heat released by combusting fuel.  See Particle::SetTemperature.
+            const Float4 temperatureChange      = temperatureChangePerMass * fuelToFlameChange * density ;
+            density = Float4::Select( hasFuel , ambientDensityTemperature / ( temperature + temperatureChange ) , density ) ;
+        }
+
+        fuel.Store( fuelLanes ) ;
+        flame.Store( flameLanes ) ;
+        density.Store( densityLanes ) ;
+        for( unsigned iLane = 0 ; iLane < numInGroup ; ++ iLane )
+        {   // For each vorton in group, scatter results.
+            Vorton & rVorton = vortons[ iPclGroup + iLane ] ;
+            rVorton.mFuelFraction   = fuelLanes[ iLane ] ;
+            rVorton.mFlameFraction  = flameLanes[ iLane ] ;
+            rVorton.SetDensity( densityLanes[ iLane ] ) ;
+
+            // For simplicity, assign the balance of the species fraction to smoke.
+            // In principle, smoke should only result from combustion, but here
+            // we just make everything in the fluid that isn't fuel or flame, smoke.
+            rVorton.mSmokeFraction  = 1.0f - ( rVorton.mFuelFraction + rVorton.mFlameFraction ) ;
+
+            ASSERT( rVorton.mFuelFraction  >= 0.0f ) ; // Paranoid sanity check.
+            ASSERT( rVorton.mFuelFraction  <= 1.0f ) ; // Paranoid sanity check.
+            ASSERT( rVorton.mFlameFraction >= 0.0f ) ; // Paranoid sanity check.
+            ASSERT( rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
+            ASSERT( rVorton.mSmokeFraction >= 0.0f ) ; // Paranoid sanity check.
+            ASSERT( rVorton.mSmokeFraction <= 1.0f ) ; // Paranoid sanity check.
+        }
+    }
+
+#else
+    UNUSED_PARAM( timeStep ) ;
+    UNUSED_PARAM( iPclStart ) ;
+    UNUSED_PARAM( iPclEnd ) ;
+#endif
+}
+
+
+
+
+/** Process combustion for all vortons, and assign mass fractions.
+
+    \param timeStep     Amount of time by which to advance simulation.
+
+    \note This routine should run before diffusing heat, since both change
+            vorton density (i.e. temperature).
+
+*/
+void VortonSim::CombustAndSetMassFractions( float timeStep )
+{
+#if ENABLE_FIRE
+
+    PERF_BLOCK( VortonSim__CombustAndSetMassFractions ) ;
+
+    const size_t numVortons = mVortons->Size() ;
+
+    // Estimate grain size based on size of problem and number of processors.
+    const size_t grainSize =  Max2( size_t( Float4::WIDTH ) , Parallel::GetGrainSize( numVortons ) ) ;
+    Parallel::For( 0 , numVortons , grainSize , Parallel::Method( this , & VortonSim::CombustAndSetMassFractionsSlice , timeStep ) , mAffinityPartitioners[ PARALLEL_LOOP_COMBUSTION ] ) ;
+
+#else
+    UNUSED_PARAM( timeStep ) ;
+#endif
+}
+
+
+
+
+/** Populate signed distance grid from density grid.
+
+    \param signedDistanceGrid   Grid of signed distance values, where negative means inside,
+                                positive means outside and 0 means at the surface of a fluid.
+
+    \param densityGrid          Grid of fluid density values.
+*/
+void VortonSim::PopulateSignedDistanceGridFromDensityGrid( UniformGrid< float > & signedDistanceGrid , const UniformGrid< float > & densityGrid , const unsigned uFrame )
+{
+    PERF_BLOCK( VortonSim__PopulateSignedDistanceGridFromParticleDensity ) ;
+
+    signedDistanceGrid.Clear() ;
+    signedDistanceGrid.CopyShape( mDensityGrid ) ;
+    signedDistanceGrid.Init( FLT_MAX ) ; // Reserve memory for SDF grid and initialize all values to FLT_MAX.
+
+    {
+        UniformGrid< int > & sdfPinnedGrid = mSdfPinnedGrid ;
+        sdfPinnedGrid.Clear() ;
+        sdfPinnedGrid.CopyShape( densityGrid ) ;
+        sdfPinnedGrid.Init( 0 ) ; // Reserve memory for grid and initialize all values to false.
+        ComputeImmediateSDFFromDensity_Nearest( signedDistanceGrid , sdfPinnedGrid , densityGrid , mAmbientDensity ) ;
+        const Vec3 & cellSpacing = signedDistanceGrid.GetCellSpacing() ;
+        ComputeRemainingSDFFromImmediateSDF_Nearest( signedDistanceGrid , sdfPinnedGrid , SDF_NARROW_BAND_NUM_CELLS * MAX3( cellSpacing.x , cellSpacing.y , cellSpacing.z ) ) ;
+//ComputeSDF_Sphere( signedDistanceGrid ) ; // DO NOT SUBMIT. Diagnosing surface tracer placment
+    }
+
+#   if defined( _DEBUG ) || VORTON_SIM_OUTPUT_SDF
+    if( mOutputDiagnostics )
+    {   // Output density for visualization.
+        signedDistanceGrid.GenerateBrickOfBytes( "sdf" , uFrame ) ;
+    }
+#   else
+        UNUSED_PARAM( uFrame ) ;
+#   endif
+}
+
+
+
+
+/** Compute density gradient grid from density grid, unless it is already up to date.
+
+    Only diagnostics and visualization read the density gradient grid,
+    unless the baroclinic term uses it, in which case GenerateBaroclinicVorticity
+    computes it and marks it current.  Otherwise this computes it on demand,
+    so runs that never request it skip the work.
+
+    \see GetDensityGradientGrid.
+*/
+void VortonSim::UpdateDensityGradientGrid()
+{
+    if( mDensityGradientGridStamp == mDensityGridStamp )
+    {   // Density has not changed since gradient was last computed.
+        return ;
+    }
+
+    PERF_BLOCK( VortonSim__UpdateDensityGradientGrid ) ;
+
+    mDensityGradientGridStamp = mDensityGridStamp ;
+    mDensityGradientGrid.Clear() ;
+    if( mDensityGrid.Empty() )
+    {   // No density from which to compute gradient.
+        return ;
+    }
+    mDensityGradientGrid.CopyShape( mDensityGrid ) ;
+    mDensityGradientGrid.Init() ;
+#if POISON_DENSITY_BASED_ON_VORTONS_HITTING_WALLS || POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
+    ComputeGradientConditionally( mDensityGradientGrid , mDensityGrid ) ;
+#else
+    ComputeGradient( mDensityGradientGrid , mDensityGrid ) ;
+#endif
+}
+
+
+
+
+/** Populate signed distance grid from density grid, if the simulation populates SDF from density and the grid is not already up to date.
+
+    SDF from density is only for visualization, so this populates it on
+    demand, so runs that never request it skip the work.
+
+    \see GetSignedDistanceGrid, SetPopulateSdfFromDensity.
+*/
+void VortonSim::UpdateSignedDistanceGrid()
+{
+    if( ! mPopulateSdfFromDensity || ( mSignedDistanceGridStamp == mDensityGridStamp ) )
+    {   // SDF is not derived from density, or density has not changed since SDF was last populated.
+        return ;
+    }
+
+    mSignedDistanceGridStamp = mDensityGridStamp ;
+    PopulateSignedDistanceGridFromDensityGrid( mSignedDistanceGrid , mDensityGrid , 0 ) ;
+}
+
+
+
+
+#if ! ( COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS )
+/** Compute density gradient at each of a contiguous range of vortons, directly from the density grid.
+
+    \param densityGradients (out) Array of numVortons density gradients.
+
+    \param iVortonBegin     Index of first vorton.
+
+    \param numVortons       Number of vortons.
+
+    \see BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID, which explains the technique.
+
+    \note This routine assumes PopulateDensityAndMassFractionGrids has
+            already executed, specifically the density grid is populated.
+*/
+void VortonSim::ComputeDensityGradientsAtVortons( Vec3 * densityGradients , size_t iVortonBegin , size_t numVortons ) const
+{
+    static const size_t batchSize           = 64 ;
+    static const size_t numSamplesPerVorton = 6 ;   // Sample density one cell on either side of each vorton, along each axis.
+    Vec3                samplePositions[ batchSize * numSamplesPerVorton ] ;
+    float               sampleDensities[ batchSize * numSamplesPerVorton ] ;
+    const Vec3          cellSpacing         = mDensityGrid.GetCellSpacing() ;
+    const Vec3          displacements[ 3 ]  = { Vec3( cellSpacing.x , 0.0f , 0.0f ) , Vec3( 0.0f , cellSpacing.y , 0.0f ) , Vec3( 0.0f , 0.0f , cellSpacing.z ) } ;
+    // Avoid divide-by-zero when z size is effectively 0 (for 2D domains), like ComputeGradient.
+    const bool          hasExtent[ 3 ]      = { cellSpacing.x > FLT_EPSILON , cellSpacing.y > FLT_EPSILON , cellSpacing.z > FLT_EPSILON } ;
+    // Keep samples strictly inside the grid, so interpolation never indexes past the last cell.
+    const Vec3          sampleMin           = mDensityGrid.GetMinCorner() ;
+    const Vec3          sampleMax           = mDensityGrid.GetMaxCorner() - cellSpacing * 1.0e-3f ;
+
+    for( size_t batchBegin = 0 ; batchBegin < numVortons ; batchBegin += batchSize )
+    {   // For each batch of vortons...
+        const size_t numInBatch = Min2( batchSize , numVortons - batchBegin ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each vorton in batch...
+            const Vec3 & position = (*mVortons)[ iVortonBegin + batchBegin + iInBatch ].mPosition ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {   // For each axis, sample behind then ahead of vorton.
+                Vec3 & rBehind = samplePositions[ iInBatch * numSamplesPerVorton + 2 * axis     ] ;
+                Vec3 & rAhead  = samplePositions[ iInBatch * numSamplesPerVorton + 2 * axis + 1 ] ;
+                rBehind = position - displacements[ axis ] ;
+                rAhead  = position + displacements[ axis ] ;
+                rBehind = Vec3( Clamp( rBehind.x , sampleMin.x , sampleMax.x ) , Clamp( rBehind.y , sampleMin.y , sampleMax.y ) , Clamp( rBehind.z , sampleMin.z , sampleMax.z ) ) ;
+                rAhead  = Vec3( Clamp( rAhead.x  , sampleMin.x , sampleMax.x ) , Clamp( rAhead.y  , sampleMin.y , sampleMax.y ) , Clamp( rAhead.z  , sampleMin.z , sampleMax.z ) ) ;
+            }
+        }
+        mDensityGrid.InterpolateMany( samplePositions , sampleDensities , numInBatch * numSamplesPerVorton ) ;
+        for( size_t iInBatch = 0 ; iInBatch < numInBatch ; ++ iInBatch )
+        {   // For each vorton in batch...
+            const Vec3 *    samplePosition  = & samplePositions[ iInBatch * numSamplesPerVorton ] ;
+            const float *   sampleDensity   = & sampleDensities[ iInBatch * numSamplesPerVorton ] ;
+            Vec3 &          densityGradient = densityGradients[ batchBegin + iInBatch ] ;
+            // Divide by actual separation, which is less than 2 cells when clamping moved a sample, so derivatives become one-sided there.
+            densityGradient.x = hasExtent[ 0 ] ? ( sampleDensity[ 1 ] - sampleDensity[ 0 ] ) / ( samplePosition[ 1 ].x - samplePosition[ 0 ].x ) : 0.0f ;
+            densityGradient.y = hasExtent[ 1 ] ? ( sampleDensity[ 3 ] - sampleDensity[ 2 ] ) / ( samplePosition[ 3 ].y - samplePosition[ 2 ].y ) : 0.0f ;
+            densityGradient.z = hasExtent[ 2 ] ? ( sampleDensity[ 5 ] - sampleDensity[ 4 ] ) / ( samplePosition[ 5 ].z - samplePosition[ 4 ].z ) : 0.0f ;
+
+        #if POISON_DENSITY_GRADIENT_BASED_ON_RIGID_SPHERE_GEOMETRY
+            {   // Remove spurious gradient due to geometric arrangement of vortons.  See PoisonDensityGradient.
+                const float density = 0.5f * ( sampleDensity[ 0 ] + sampleDensity[ 1 ] ) ;
+                if( densityGradient.Mag2() < 0.29289f * density )
+                {
+                    densityGradient = Vec3( 0.0f , 0.0f , 0.0f ) ;
+                }
+            }
+        #endif
+
+        #if POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS
+            if( mPhysicalObjects )
+            {
+                const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
+                FluidBodySim::PoisonDensityGradientAtPoint( densityGradient , (*mVortons)[ iVortonBegin + batchBegin + iInBatch ].mPosition , * mPhysicalObjects , vortonRadius ) ;
+            }
+        #endif
+        }
+    }
+}
+#endif
+
+
+
+
+/** Compute baroclinic generation of vorticity due to buoyancy.
+
+    \param timeStep     Amount of time by which to advance simulation.
+
+    \param iPclStart    Index of first particle to process.
+
+    \param iPclEnd      One past index of last particle to process.
+
+    \see DiffuseAndDissipateVorticityPSE, StretchAndTiltVortons
+
+    \note This routine assumes CreateInfluenceTree has already executed,
+            specifically that the velocity grid shape has already been calculated.
+
+    \note This routine assumes PopulateDensityAndMassFractionGrids has
+            already executed, specifically the mass fraction grid is populated.
+
+    \note This routine should run before advecting vortons, otherwise the vortons
+            could leave the velocity grid boundaries, and this routine needs to
+            interpolate within those boundaries.
+
+*/
+void VortonSim::GenerateBaroclinicVorticitySlice( float timeStep
+#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
+                                                 , const VECTOR< Vec3 > * densityGradients
+#endif
+
+                                                 , size_t iPclStart , size_t iPclEnd )
+{
+    PERF_BLOCK_INNER( VortonSim__GenerateBaroclinicVorticitySlice ) ;
+
+    const float oneOverDensity = 1.0f / GetAmbientDensity() ;
+
+#if ! ( COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS ) && BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID
+    static const size_t batchSize = 64 ;
+    Vec3                densityGradientBatch[ batchSize ] ;
+#endif
+
+    for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
+    {   // For each particle in this slice...
+        Vorton &    rVorton         = (*mVortons)[ iPcl ] ;
+
+        // Technically the baroclinic term should have density in the
+        // denominator, but it's relatively expensive to calculate the local
+        // value, plus the Boussinesq approximation assumes density variations
+        // are small compared to the ambient.  So instead, we use the ambient
+        // density in the denominator, which yields the correct units and gets
+        // results in the right ballpark.
+        // This is yet another example of where, for visual effects,
+        // we take drastic liberties in the name of speed over accuracy.
+
+        //float       density ;
+        //mDensityGrid.Interpolate( density , rVorton.mPosition ) ;
+        //ASSERT( density > 0.0f ) ;
+
+    #if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
+        const Vec3 & densityGradient = (*densityGradients)[ iPcl ] ;
+        ASSERT( ! IsNan( densityGradient ) && ! IsInf( densityGradient ) ) ;
+    #elif BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID
+        const size_t iInBatch = ( iPcl - iPclStart ) % batchSize ;
+        if( 0 == iInBatch )
+        {   // Starting a new batch, so compute density gradient at every vorton in it.
+            ComputeDensityGradientsAtVortons( densityGradientBatch , iPcl , Min2( batchSize , iPclEnd - iPcl ) ) ;
+        }
+        const Vec3 & densityGradient = densityGradientBatch[ iInBatch ] ;
+    #elif POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
+        Vec3    densityGradient( 0.0f , 0.0f , 0.0f ) ;
+        mDensityGradientGrid.InterpolateConditionally( densityGradient , rVorton.mPosition ) ;
+    #else   // Use density gradient computed on grid.
+        Vec3    densityGradient ;
+        mDensityGradientGrid.Interpolate( densityGradient , rVorton.mPosition ) ;
+    #endif
+
+        if( ! IsNan( densityGradient ) && ! IsInf( densityGradient ) )
+        {
+
+        #if COMPUTE_PRESSURE_GRADIENT
+            #error Do not use this branch.  It was a half-baked idea that did not work out.
+            Vec3        pressureGradient ;
+            mPressureGradientGrid.Interpolate( pressureGradient , rVorton.mPosition ) ;
+            ASSERT( ! IsNan( pressureGradient ) && ! IsInf( pressureGradient ) ) ;
+            pressureGradient += mGravAccel ;
+        #else
+            const Vec3  pressureGradient = mGravAccel ;
+        #endif
+
+            const Vec3  baroclinicGeneration = densityGradient ^ pressureGradient * oneOverDensity ;
+            // The formula for the line below is meant to update vorticity,
+            // but since particles store vorticity as angular velocity, the formula has an extra factor of 0.5.
+            ASSERT( ! IsNan( baroclinicGeneration ) && ! IsInf( baroclinicGeneration ) ) ;
+            ASSERT( ! IsNan( rVorton.mAngularVelocity ) && ! IsInf( rVorton.mAngularVelocity ) ) ;
+            rVorton.mAngularVelocity += 0.5f * baroclinicGeneration * timeStep ;
+
+        #if VORTON_SIM_GATHER_STATS
+            mVorticityTermsStats.mBaroclinic.Accumulate( baroclinicGeneration.Magnitude() ) ; // Note: This is not thread safe.
+        #endif
+        }
+    }
+}
+
+
+
+
+/** Compute baroclinic generation of vorticity due to buoyancy.
+
+    \param timeStep     Amount of time by which to advance simulation.
+
+    \param uFrame       Frame counter, used to generate diagnostic files.
+
+    \see DiffuseAndDissipateVorticityPSE, StretchAndTiltVortons
+
+    \note This routine assumes CreateInfluenceTree has already executed,
+            specifically that the velocity grid has already been calculated.
+
+    \note This routine assumes PopulateDensityAndMassFractionGrids has
+            already executed, specifically the mass fraction grid is populated.
+
+    \note This routine should run before advecting vortons, otherwise the vortons
+            could leave the velocity grid boundaries.
+
+*/
+void VortonSim::GenerateBaroclinicVorticity( const float timeStep , const unsigned uFrame
+#if COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS || COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
+                                            , const CellList & ugVortonIndices
+#endif
+                                            )
+{
+    PERF_BLOCK( VortonSim__GenerateBaroclinicVorticity ) ;
+
+    UNUSED_PARAM( uFrame ) ; // Avoid "unreferenced formal parameter" warning.
+
+    if( IsBuoyancyNegligible() )
+    {   // Domain is 2D and has no significant component along the gravity direction,
+        // so baroclinic generation cannot occur in this Boussinesq approximation.
+        return ;
+    }
+
+#if VORTON_SIM_GATHER_STATS
+    mVorticityTermsStats.Reset( mVorticityTermsStats.mBaroclinic ) ;
+#endif
+
+#if COMPUTE_PRESSURE_GRADIENT
+    if( mPhysicalObjects )
+    {
+        const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
+        ComputePressureGradient( mGridTemplate , mPressureGradientGrid , * mPhysicalObjects , vortonRadius ) ;
+    }
+#endif
+
+    // Populate density grid.
+    //
+    // Passing mVortons to PopulateDensityAndMassFractionGrids assumes Particle and Vorton layout are identical.
+    // This is a weird, fragile use of inheritance but I desperately want to avoid virtual calls, while for
+    // pedagogic purposes I want to distinguish between a regular tracer particle and a vortex particle, and
+    // still treat arrays of those things uniformly, for economy of code.
+
+    ASSERT( sizeof( Particle ) == sizeof( Vorton ) ) ;
+    PopulateDensityAndMassFractionGrids( mDensityGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , uFrame ) ;
+
+    const size_t    numVortons      = mVortons->Size() ;
+
+    // Compute density gradient.
+
+#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
+    {
+        // Compute density gradient using SPH, then use that to compute baroclinic term.
+        // This uses an SPH scheme that computes gradients at the boundaries differently depending on whether particles touch a wall or just particle-free zones.
+        // Note that for this purpose it would be better to have a smaller inflRad.  1 is probably too small.  2 to 3.5 might be okay.  4 is probably too big.
+
+    #if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
+        extern float influenceRadiusScale ; // Defined in smoothedPclHydro.cpp
+        const float pclRad  = ( * mVortons )[ 0 ].GetRadius() ;
+        const float inflRad = influenceRadiusScale * pclRad ;   // Make grid cell big enough to include all possible neighbors.
+
+        UpdateSphNeighborList( timeStep , uFrame , inflRad ) ;
+    #endif
+
+        (void) ugVortonIndices ; // SPH and VPM have different requirements on the spatial partition.  Might be okay to use SPH requirement for both, though that would be slower.
+
+        // Proximities depend only on positions, so compute them first, letting density and its gradient share one neighbor traversal.
+        FluidBodySim::ComputeParticleProximityToWalls( mVortonBodyProximities , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , * mPhysicalObjects , inflRad ) ;
+        ComputeSphDensityAndMassDensityGradient_Grid( mFluidDensitiesAtPcls , mDensityGradientsAtPcls , * mVortons , mVortonBodyProximities , mSphNeighborList , mAmbientDensity ) ;
+
+    #if ENABLE_FLUID_BODY_SIMULATION
+        #if USE_TBB
+            // Compute baroclinic generation of vorticity using threading building blocks
+            Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::GenerateBaroclinicVorticitySlice , timeStep , & mDensityGradientsAtPcls ) , mAffinityPartitioners[ PARALLEL_LOOP_BAROCLINIC ] ) ;
+        #else
+            GenerateBaroclinicVorticitySlice( timeStep , & mDensityGradientsAtPcls , 0 , numVortons ) ;
+        #endif
+    #endif
+    }
+#elif COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS // Older experiment -- did not work out.
+    {
+        VECTOR< Vec3 > densityGradients ; // One density gradient per vorton.
+        ComputeDensityGradientFromVortons( densityGradients , ugVortonIndices , * mVortons ) ;
+
+    #if ENABLE_FLUID_BODY_SIMULATION
+        #if USE_TBB
+            // Compute baroclinic generation of vorticity using threading building blocks
+            Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::GenerateBaroclinicVorticitySlice , timeStep , & densityGradients ) , mAffinityPartitioners[ PARALLEL_LOOP_BAROCLINIC ] ) ;
+        #else
+            GenerateBaroclinicVorticitySlice( timeStep , & densityGradients , 0 , numVortons ) ;
+        #endif
+    #endif
+    }
+#else // Transfer density from vortons to grid and compute density gradient from grid.
+    #if POISON_DENSITY_BASED_ON_VORTONS_HITTING_WALLS
+        PoisonDensity( mDensityGrid , * mVortons ) ;
+    #endif
+
+    #if POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
+        if( mPhysicalObjects )
+        {
+            const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
+            FluidBodySim::PoisonDensity( mDensityGrid , * mPhysicalObjects , vortonRadius ) ;
+        }
+    #endif
+
+    #if BAROCLINIC_WITHOUT_DENSITY_GRADIENT_GRID
+        // GenerateBaroclinicVorticitySlice computes density gradient, and poisons it, at each vorton.
+        // Only GetDensityGradientGrid computes the grid, on demand.
+    #else
+        mDensityGradientGrid.Clear() ;                      // Clear any stale density gradient information
+        mDensityGradientGrid.CopyShape( mGridTemplate ) ;   // Use same shape as base velocity grid. (Note: could differ if you want.)
+        mDensityGradientGrid.Init() ;                       // Reserve memory for density gradient grid.
+    #if POISON_DENSITY_BASED_ON_VORTONS_HITTING_WALLS || POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
+        // Compute density gradient using conditional difference.
+        ComputeGradientConditionally( mDensityGradientGrid , mDensityGrid ) ;
+    #else
+        // Compute density gradient using centered difference in interior and forward/backward difference on boundaries.
+        ComputeGradient( mDensityGradientGrid , mDensityGrid ) ;
+    #endif
+
+    #if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
+        PoisonDensityGradient( mDensityGradientGrid , * mVortons ) ;
+    #endif
+
+    #if POISON_DENSITY_GRADIENT_BASED_ON_RIGID_SPHERE_GEOMETRY
+        PoisonDensityGradient( mDensityGradientGrid , mDensityGrid , mAmbientDensity ) ;
+    #endif
+
+    #if POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS
+        if( mPhysicalObjects )
+        {
+            const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
+            FluidBodySim::PoisonDensityGradient( mDensityGradientGrid , * mPhysicalObjects , vortonRadius ) ;
+        }
+    #endif
+        mDensityGradientGridStamp = mDensityGridStamp ; // Baroclinic term needed the grid anyway, so GetDensityGradientGrid can return it as-is.
+    #endif
+
+    #if ENABLE_FLUID_BODY_SIMULATION
+        #if USE_TBB
+            // Compute baroclinic generation of vorticity using threading building blocks
+            Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::GenerateBaroclinicVorticitySlice , timeStep ) , mAffinityPartitioners[ PARALLEL_LOOP_BAROCLINIC ] ) ;
+        #else
+            GenerateBaroclinicVorticitySlice( timeStep , 0 , numVortons ) ;
+        #endif
+    #endif
+
+#endif
+
+
+#if VORTON_SIM_GATHER_STATS
+    mVorticityTermsStats.mBaroclinic.ConvertAccumulatedSamplesToStats( numVortons ) ;
+#endif
+}
+
+
+
+
+/** Spatially partition vortons.
+
+    This routine partitions space into cells using the same grid geometry as the
+    "base vorton" grid, possibly modified to respect the given minCellSpacing.  Each
+    vorton gets assigned to the cell that contains it.
+
+    \param timeStep     Amount of time by which to advance simulation.
+
+    \param uFrame       Frame counter, used to generate diagnostic files.
+
+    \param ugVortonIndices - Cell list of vorton indices.  Assign each cell
+        to contain the indices of vortons that reside inside that cell.
+        The index values refer to elements in mVortons.
+        Vortons usually move less than one cell per time step, so when the
+        layout and number of vortons match the previous call, this moves only
+        the indices of vortons that crossed a cell boundary.
+        See CellList::Partition.
+
+    \see StretchAndTiltVortons, GenerateBaroclinicVorticity
+
+    \note This routine assumes mGridTemplate has already been established for this frame.
+
+*/
+void VortonSim::PartitionVortons( const float & /* timeStep */ , const unsigned & /* uFrame */ ,
+#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
+                                 SpatialPartition & vortonGrid
+#else
+                                 CellList & ugVortonIndices
+#endif
+                                 , float minCellSpacing )
+{
+#if ENABLE_FLUID_BODY_SIMULATION
+
+    PERF_BLOCK( VortonSim__PartitionVortons ) ;
+
+#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
+    //vortonGrid.Init( numVortons , mGridTemplate ) ;                 // Initialize spatial partition.
+    Particles::PartitionParticles( reinterpret_cast< const VECTOR< Particle > & >( *mVortons ) , vortonGrid , minCellSpacing ) ;
+#else
+    // Use same shape as base vorticity grid.  Do not Clear ugVortonIndices; Partition reuses its contents.
+    ugVortonIndices.Partition( * mVortons , mGridTemplate , minCellSpacing ) ;
+#endif
+
+#endif
+}
+
+
+
+
+#if ENABLE_MERGING_VORTONS
+/** Exchange vorticity or merge vortons.
+
+    \return true if both particles were kept, false if the "there" particle merged into the "here" particle.
+
+    \note The cell list is read-only, so merging does not remove the "there"
+            particle from its cell.  Instead, Merge marks it dead and later
+            visits skip it.
+*/
+inline bool VortonSim::ExchangeVorticityOrMergeVortons( const unsigned & rVortIdxHere , Vorton & rVortonHere , Vec3 & rAngVelHere , const unsigned & ivThere , const CellList::Cell & cell , const float & timeStep )
+{
+    ASSERT( rVortonHere.IsAlive() ) ;
+    const unsigned &    rVortIdxThere   = cell[ ivThere ] ;
+    Vorton &            rVortonThere    = (*mVortons)[ rVortIdxThere ] ;
+    const float         diffusionRange  = 4.0f * rVortonHere.mSize ;
+    const float         diffusionRange2 = POW2( diffusionRange ) ;
+    if( ! rVortonThere.IsAlive() )
+    {   // Particle already merged into another.
+        return false ;
+    }
+    {   // Particle is alive.
+        const Vec3      separation      = rVortonHere.mPosition - rVortonThere.mPosition ;
+        const float     dist2           = separation.Mag2() ;
+
+        const float     radiusSum       = ( rVortonHere.mSize + rVortonThere.mSize ) * 0.5f ; // 1/2 because size=2*radius
+        const float     radiusSum2      = Pow2( radiusSum ) ;
+        static float    mergeThreshold  = 0.25f ; // A value of 0.25 means the center of 1 vorton is just barely inside the core of another.
+        if( dist2 < radiusSum2 * mergeThreshold )
+        {   // Vortices are close enough to merge.
+            Particles::Merge( reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , rVortIdxHere , rVortIdxThere , mAmbientDensity ) ;
+            return false ;   // Tell caller a particle was deleted.
+        }
+        else
+        {   // Vortices are far enough to remain separate.
+            const float distLaw         = exp( - dist2 / diffusionRange2 ) ;
+            Vec3 &      rAngVelThere    = rVortonThere.mAngularVelocity ;
+            const Vec3  vortDiff        = rAngVelHere - rAngVelThere ;
+            const float exchangeFraction= Clamp( 2.0f * mViscosity * timeStep * distLaw , -0.5f , 0.5f ) ;    // Fraction of vorticity to exchange between particles.
+            ASSERT( fabsf( exchangeFraction ) < 0.5f ) ; // If this triggers, Clamp above triggered.
+            const Vec3  exchange        = exchangeFraction * vortDiff ;    // Amount of vorticity to exchange between particles.
+            ASSERT( ! IsNan( rAngVelHere  ) && ! IsInf( rAngVelHere ) ) ;
+            ASSERT( ! IsNan( rAngVelThere ) && ! IsInf( rAngVelThere ) ) ;
+            rAngVelHere  -= exchange ;   // Make "here" vorticity a little closer to "there".
+            rAngVelThere += exchange ;   // Make "there" vorticity a little closer to "here".
+            ASSERT( ! IsNan( rAngVelHere  ) && ! IsInf( rAngVelHere ) ) ;
+            ASSERT( ! IsNan( rAngVelThere ) && ! IsInf( rAngVelThere ) ) ;
+
+        #if VORTON_SIM_GATHER_STATS
+            mVorticityTermsStats.mViscousDiffusion.Accumulate( exchange.Magnitude() ) ; // Note: This is not thread safe.
+        #endif
+
+            return true ;  // Tell caller particles were kept.
+        }
+    }
+}
+
+
+
+
+/** Diffuse vorticity using a particle strength exchange (PSE) method, merging vortons that come too close, for a block of cells.
+
+    Merging modifies vortons in place, so unlike DiffuseAndDissipateVorticityPSESlice,
+    this exchanges vorticity in place, and concurrent blocks must not be adjacent.
+
+    \see DiffuseAndDissipateVorticityPSE, ForEachCellBlockByColor
+*/
+void VortonSim::DiffuseAndMergeVorticityPSESlice( const float & timeStep , const CellList & vortonCellList , const CellBox & box )
+{
+    if( vortonCellList.Empty() )
+    {   // No vortons.
+        return ;
+    }
+
+    ASSERT( mViscosity * timeStep <= 1.0f ) ; // ...otherwise dissipation will cause vorticity to flip direction.
+
+    const float viscousVorticityDissipationFactor = mViscosity * timeStep ;
+
+    // Exchange vorticity with nearest neighbors
+
+    const size_t   & nx     = vortonCellList.GetNumPoints( 0 ) ;
+    const size_t   & ny     = vortonCellList.GetNumPoints( 1 ) ;
+    const size_t     nxy    = nx * ny ;
+
+    // Note that the cell-neighborhood loop visits only half the neighboring
+    // cells. That is because each particle visitation is symmetric so there is
+    // no need to visit all neighboring cells.
+    const size_t neighborCellOffsets[] =
+    {   // Offsets to neighboring cells whose indices exceed this one:
+           1            // + , 0 , 0 ( 1)
+        , -1 + nx       // - , + , 0 ( 2)
+        ,    + nx       // 0 , + , 0 ( 3)
+        ,  1 + nx       // + , + , 0 ( 4)
+        , -1 - nx + nxy // - , - , + ( 5)
+        ,    - nx + nxy // 0 , - , + ( 6)
+        ,  1 - nx + nxy // + , - , + ( 7)
+        , -1      + nxy // - , 0 , + ( 8)
+        ,         + nxy // 0 , 0 , + ( 9)
+        ,  1      + nxy // + , 0 , + (10)
+        , -1 + nx + nxy // - , + , + (11)
+        ,      nx + nxy // 0 , + , + (12)
+        ,  1 + nx + nxy // + , + , + (13)
+    } ;
+    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
+
+    size_t idx[3] ;
+    for( idx[2] = box.mBegin[2] ; idx[2] < box.mEnd[2] ; ++ idx[2] )
+    {   // For all grid cells along z...
+        const size_t offsetZ0 = idx[2] * nxy ;
+        for( idx[1] = box.mBegin[1] ; idx[1] < box.mEnd[1] ; ++ idx[1] )
+        {   // For all grid cells along y...
+            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
+            const size_t rowBegin   = box.mBegin[0] + offsetY0Z0 ;
+            const size_t rowEnd     = box.mEnd[0]   + offsetY0Z0 ;
+            for( size_t offsetX0Y0Z0 = vortonCellList.FindOccupiedCell( rowBegin , rowEnd ) ; offsetX0Y0Z0 < rowEnd ; offsetX0Y0Z0 = vortonCellList.FindOccupiedCell( offsetX0Y0Z0 + 1 , rowEnd ) )
+            {   // For each occupied grid cell along x...
+                const size_t numInCurrentCell = vortonCellList[ offsetX0Y0Z0 ].Size() ;
+                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
+                {   // For each vorton in this gridcell...
+                    const unsigned &    rVortIdxHere    = vortonCellList[ offsetX0Y0Z0 ][ ivHere ] ;
+                    Vorton &            rVortonHere     = (*mVortons)[ rVortIdxHere ] ;
+                    // Note: This algorithm assumes calls to ExchangeVorticityOrMergeVortons never
+                    // delete rVortonHere.
+                    if( rVortonHere.IsAlive() )
+                    {
+                        Vec3 &              rAngVelHere     = rVortonHere.mAngularVelocity ;
+
+                        // Diffuse vorticity with other vortons in same cell.
+                        // Merged vortons remain in their cells but are dead, so these loops visit every slot.
+                        const CellList::Cell cellHere = vortonCellList[ offsetX0Y0Z0 ] ;
+                        for( unsigned ivThere = ivHere + 1 ; ivThere < numInCurrentCell ; ++ ivThere )
+                        {   // For each OTHER vorton within this same cell...
+                            ExchangeVorticityOrMergeVortons( rVortIdxHere , rVortonHere , rAngVelHere , ivThere , cellHere , timeStep ) ;
+                        }
+
+                        // Diffuse vorticity with other vortons in adjacent cells.
+                        for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
+                        {   // For each cell in neighborhood...
+                            const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of adjacent cell
+                            if( ! vortonCellList.IsOccupied( cellOffset ) ) continue ;
+                            const CellList::Cell cell = vortonCellList[ cellOffset ] ;
+                            for( unsigned ivThere = 0 ; ivThere < cell.Size() ; ++ ivThere )
+                            {   // For each vorton in the visited cell...
+                                ExchangeVorticityOrMergeVortons( rVortIdxHere , rVortonHere , rAngVelHere , ivThere , cell , timeStep ) ;
+                            }
+                        }
+
+                        // Dissipate vorticity.  See notes in DiffuseAndDissipateVorticityPSESlice.
+                        rAngVelHere  -= viscousVorticityDissipationFactor * rAngVelHere ;   // Reduce vorticity here.
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
+
+
+
+
+/** Return number of chunks of cells, each with its own deltas, into which to split particle strength exchange.
+
+    Each chunk has a delta per vorton that its pairs can touch, i.e. those in
+    its own rows plus about one layer of cells beyond, so more chunks cost
+    more memory and more time to sum deltas, but too few leave threads idle.  This uses one
+    chunk per processor, or, when PARALLEL_DETERMINISTIC is enabled, a fixed
+    number, so that results do not depend on the number of threads.
+*/
+/* static */ size_t VortonSim::GetNumPseChunks( const CellList & vortonCellList )
+{
+#if USE_TBB
+    #if PARALLEL_DETERMINISTIC
+    static const size_t maxChunks = 8 ;
     #else
-        ComputeVelocityAtGridpoints_Slice( 0 , numZ , vortonIndicesGrid , influenceTree ) ;
+    const size_t        maxChunks = gNumberOfProcessors ;
     #endif
+    const size_t        numRows   = vortonCellList.GetNumCells( 1 ) * vortonCellList.GetNumCells( 2 ) ;
+    return Clamp( numRows , size_t( 1 ) , maxChunks ) ;
+#else
+    (void) vortonCellList ;
+    return 1 ;
 #endif
 }
 
 
 
 
-/** Compute vector potential due to vorticity, for every point in a uniform grid, by solving a vector Poisson partial differential equation.
+/** Compute range of slots, i.e. of vortons in order of cells, that pairs in each chunk of particle strength exchange can touch.
 
-    \param vectorPotentialMultiGrid  (out) Nested grid of vector potential values, computed from vorticityGrid.
+    Chunk i spans rows of cells [i*numRows/numChunks,(i+1)*numRows/numChunks),
+    and its pairs reach only cells from its first cell through the half
+    neighborhood of its last cell, so its deltas need only cover vortons in
+    those cells, which CellList stores contiguously.  Ranges of adjacent
+    chunks overlap by about one layer of cells.
 
-    \param vorticityGrid        (in) Uniform grid of vorticity values, used to compute velocity-from-vorticity using Poisson solver.
+    \param chunkSlots - (out) Range of slots for each chunk, and offset of its deltas.
 
-    \todo   This routine calls SolveVectorPoisson which (depending on compiler settings inside that routine) uses "natural" boundary
-            conditions.  Instead, what we want to use "radiation" or "open" boundary conditions, where the boundary has "no influence",
-            that is, we want this solver to yield results consistent with using direct summation (or the other integral approaches).
-            To accomplish that, this routine could first use an integral technique (e.g. direct summation, treecode or multipole)
-            to compute vector potential at the boundaries, then use SolveVectorPoisson with "essential" boundary
-            conditions to populate the domain interior.  Incidentally that approach would also allow the domain to be closer
-            to the interior, rather than inflating the domain, as is done now to diminish the problematic influence of the boundary.
+    \return Total number of deltas all chunks need.
+
+    \see GetNumPseChunks, PseRowBox, CellList::ForEachPairInHalfNeighborhood
 */
-void VortonSim::ComputeVectorPotential( NestedGrid< Vec3 > & vectorPotentialMultiGrid , NestedGrid< Vec3 > & negativeVorticityMultiGrid , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
+/* static */ size_t VortonSim::ComputePseChunkSlots( VECTOR< PseChunkSlots > & chunkSlots , const CellList & vortonCellList , size_t numChunks )
 {
-    PERF_BLOCK( VortonSim__ComputeVectorPotential ) ;
+    const size_t numCellsX  = vortonCellList.GetNumCells( 0 ) ;
+    const size_t numCellsY  = vortonCellList.GetNumCells( 1 ) ;
+    const size_t numRows    = numCellsY * vortonCellList.GetNumCells( 2 ) ;
+    const size_t nx         = vortonCellList.GetNumPoints( 0 ) ;
+    const size_t nxy        = nx * vortonCellList.GetNumPoints( 1 ) ;
+    const size_t numCells   = vortonCellList.GetGridCapacity() ;
+    ASSERT( ( numChunks > 0 ) && ( numChunks <= numRows ) ) ;
+
+    chunkSlots.Resize( numChunks ) ;
+    size_t numDeltas = 0 ;
+    for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+    {   // For each chunk of rows of cells...
+        const size_t iRowBegin      = iChunk * numRows / numChunks ;
+        const size_t iRowLast       = ( iChunk + 1 ) * numRows / numChunks - 1 ;
+        const size_t cellBegin      = ( iRowBegin % numCellsY ) * nx + ( iRowBegin / numCellsY ) * nxy ;
+        const size_t cellLast       = ( iRowLast  % numCellsY ) * nx + ( iRowLast  / numCellsY ) * nxy + numCellsX - 1 ;
+        // Farthest cell in half neighborhood lies at offset 1 + nx + nxy.
+        const size_t cellEnd        = Min2( cellLast + 1 + nx + nxy + 1 , numCells ) ;
+        PseChunkSlots & rChunkSlots = chunkSlots[ iChunk ] ;
+        rChunkSlots.mSlotBegin      = vortonCellList.GetNumItemsInCells( 0 , cellBegin ) ;
+        rChunkSlots.mSlotEnd        = vortonCellList.GetNumItemsInCells( 0 , cellEnd   ) ;
+        rChunkSlots.mDeltaBegin     = numDeltas ;
+        numDeltas += rChunkSlots.mSlotEnd - rChunkSlots.mSlotBegin ;
+    }
+    return numDeltas ;
+}
 
-    ASSERT( ! mVortons->empty() ) ;
 
-    static const BoundaryConditionE boundaryCondition = BC_DIRICHLET ;
 
-    vectorPotentialMultiGrid[0].Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
 
-    // Assign vector potential on domain boundary points.
-    // Note: For Part 19, assign vector potential everywhere in domain, not just on boundaries.
-    //       For Part 20, assign only on domain boundaries.
-    static const sBoundariesOnly = true ;
-    ComputeVectorPotentialFromVorticity_Integral( sBoundariesOnly , vortonIndicesGrid , influenceTree ) ;
+/** Return box of cells that spans the given row of cells, where rows are numbered y fastest, then z.
+*/
+static CellBox PseRowBox( const CellList & vortonCellList , size_t iRow )
+{
+    const size_t numCellsY = vortonCellList.GetNumCells( 1 ) ;
+    CellBox box ;
+    box.mBegin[ 0 ] = 0 ;
+    box.mEnd  [ 0 ] = vortonCellList.GetNumCells( 0 ) ;
+    box.mBegin[ 1 ] = iRow % numCellsY ;
+    box.mEnd  [ 1 ] = box.mBegin[ 1 ] + 1 ;
+    box.mBegin[ 2 ] = iRow / numCellsY ;
+    box.mEnd  [ 2 ] = box.mBegin[ 2 ] + 1 ;
+    return box ;
+}
+
 
-#   if VORTON_SIM_USE_MULTI_GRID
 
-        static const size_t numSolverSteps = 16 ; // Tuned by comparing residuals using numSolverSteps versus numStepsAuto computed inside SolveVectorPoisson.
 
-        // Initialize finest grid with first pass of solution, to propagate boundary conditions inward from boundary.
-        SolveVectorPoisson( vectorPotentialMultiGrid[ 0 ] , negativeVorticityMultiGrid[ 0 ] , numSolverSteps , boundaryCondition , mPoissonResidualStats ) ;
+/** Pair function object for CellList::ForEachPairInHalfNeighborhood, which accumulates vorticity that 2 vortons exchange.
 
-        unsigned maxValidDepth = 0 ;
+    This reads vorticity as of the start of the step, and writes only to the
+    deltas of its own chunk, so chunks can run concurrently and in any order.
+    Each pair adds equal and opposite amounts to the deltas of its 2 vortons,
+    so the exchange conserves total vorticity, whatever the number of chunks.
 
-        // Fine-to-coarse stage of V-cycle: downsample from fine to coarse, running some iterations of the Poisson solver for each downsampled grid.
-        for( unsigned iLayer = 1 ; iLayer < negativeVorticityMultiGrid.GetDepth() ; ++ iLayer )
+    Given ISPC kernels, this buffers pairs, and computes their exchange
+    fractions a batch at a time.  Callers must then call Flush after the last pair.
+*/
+class VortonSim_ExchangeVorticityPSE_Pair
+{
+    public:
+    #if USE_VORTON_SOA
+        VortonSim_ExchangeVorticityPSE_Pair( const VortonSoa & vortons , float viscosityTimeStep , const CellList & vortonCellList , Vec3 * deltas , size_t slotBegin , size_t numDeltas , const FluidKernelTable * ispcKernels )
+    #else
+        VortonSim_ExchangeVorticityPSE_Pair( const VECTOR< Vorton > & vortons , float viscosityTimeStep , const CellList & vortonCellList , Vec3 * deltas , size_t slotBegin , size_t numDeltas , const FluidKernelTable * ispcKernels )
+    #endif
+            : mVortons( vortons )
+            , mViscosityTimeStep( viscosityTimeStep )
+            , mVortonCellList( vortonCellList )
+            , mDeltas( deltas )
+            , mSlotBegin( slotBegin )
+            , mNumDeltas( numDeltas )
+            , mIspcKernels( ispcKernels )
+        {}
+
+        void operator()( unsigned idxHere , unsigned idxThere )
         {
-            const unsigned minDim = MIN3( negativeVorticityMultiGrid[ iLayer ].GetNumPoints( 0 ) , negativeVorticityMultiGrid[ iLayer ].GetNumPoints( 1 ) , negativeVorticityMultiGrid[ iLayer ].GetNumPoints( 2 ) ) ;
-            if( minDim > 2 )
-            {
-                negativeVorticityMultiGrid.DownSampleInto( iLayer , UniformGridGeometry::FASTER_LESS_ACCURATE ) ;
-                vectorPotentialMultiGrid.DownSampleInto( iLayer , UniformGridGeometry::FASTER_LESS_ACCURATE ) ;
-                SolveVectorPoisson( vectorPotentialMultiGrid[ iLayer ] , negativeVorticityMultiGrid[ iLayer ] , numSolverSteps , boundaryCondition , mPoissonResidualStats ) ;
+        #if USE_VORTON_SOA
+            if( ! mVortons.IsAlive( idxHere ) || ! mVortons.IsAlive( idxThere ) )
+            {   // One of the vortons died earlier this step.
+                return ;
             }
-            else
-            {
-                maxValidDepth = iLayer - 1 ;
-                break ;
+        #else
+            if( ! mVortons[ idxHere ].IsAlive() || ! mVortons[ idxThere ].IsAlive() )
+            {   // One of the vortons died earlier this step.
+                return ;
             }
+        #endif
+            if( mIspcKernels != NULL )
+            {   // Defer pair to Flush.
+                if( mBatch.Add( idxHere , idxThere ) )
+                {
+                    Flush() ;
+                }
+                return ;
+            }
+        #if USE_VORTON_SOA
+            const float dx                  = mVortons.mPositionX[ idxHere ] - mVortons.mPositionX[ idxThere ] ;
+            const float dy                  = mVortons.mPositionY[ idxHere ] - mVortons.mPositionY[ idxThere ] ;
+            const float dz                  = mVortons.mPositionZ[ idxHere ] - mVortons.mPositionZ[ idxThere ] ;
+            const float dist2               = dx * dx + dy * dy + dz * dz ;
+            const float diffusionRange2     = POW2( 4.0f * mVortons.mSize[ idxHere ] ) ;
+        #else
+            const Vorton & rVortonHere      = mVortons[ idxHere  ] ;
+            const Vorton & rVortonThere     = mVortons[ idxThere ] ;
+            const float dist2               = ( rVortonHere.mPosition - rVortonThere.mPosition ).Mag2() ;
+            const float diffusionRange2     = POW2( 4.0f * rVortonHere.mSize ) ;
+        #endif
+            const float distLaw             = exp( - dist2 / diffusionRange2 ) ;
+            const float exchangeFraction    = Clamp( 2.0f * mViscosityTimeStep * distLaw , -0.5f , 0.5f ) ;    // Fraction of vorticity to exchange between particles.
+            Exchange( idxHere , idxThere , exchangeFraction ) ;
         }
 
-        // Coarse-to-fine stage of V-cycle: Upsample from coarse to fine, running some iterations of the Poisson solver for each upsampled grid.
-        for( unsigned iLayer = maxValidDepth ; iLayer >= 1 ; -- iLayer )
+        /** Exchange vorticity between all pairs buffered since the previous Flush.
+        */
+        void Flush()
         {
-            // Retain boundary values as they were computed initially (above) in finer grids.
-            vectorPotentialMultiGrid.UpSampleFrom( iLayer , UniformGridGeometry::INTERIOR_ONLY ) ;
-            SolveVectorPoisson( vectorPotentialMultiGrid[ iLayer - 1 ] , negativeVorticityMultiGrid[ iLayer - 1 ] , numSolverSteps , boundaryCondition , mPoissonResidualStats ) ;
+            if( 0 == mBatch.mCount )
+            {
+                return ;
+            }
+        #if USE_VORTON_SOA
+            mIspcKernels->mComputePseExchangeFractions( mVortons.mPositionX.Data() , mVortons.mPositionY.Data() , mVortons.mPositionZ.Data() , mVortons.mSize.Data() , 1
+                                                      , mBatch.mHere , mBatch.mThere , int( mBatch.mCount ) , mViscosityTimeStep , mBatch.mResultA ) ;
+        #else
+            const Vorton & rVorton0 = mVortons[ 0 ] ;
+            mIspcKernels->mComputePseExchangeFractions( & rVorton0.mPosition.x , & rVorton0.mPosition.y , & rVorton0.mPosition.z , & rVorton0.mSize , int( sizeof( Vorton ) / sizeof( float ) )
+                                                      , mBatch.mHere , mBatch.mThere , int( mBatch.mCount ) , mViscosityTimeStep , mBatch.mResultA ) ;
+        #endif
+            // Apply exchanges serially, since pairs in a batch can share vortons.
+            for( unsigned iPair = 0 ; iPair < mBatch.mCount ; ++ iPair )
+            {   // For each pair in batch...
+                Exchange( mBatch.mHere[ iPair ] , mBatch.mThere[ iPair ] , mBatch.mResultA[ iPair ] ) ;
+            }
+            mBatch.mCount = 0 ;
         }
 
-        // Omit calling ComputeVectorPotentialFromVorticity_Integral again; it redundantly recomputes boundary values which were computed above.
-        //ComputeVectorPotentialFromVorticity_Integral( sBoundariesOnly , vortonIndicesGrid , influenceTree ) ; // Assign vector potential on boundary points.  This would be redundant with call above.
-        //SolveVectorPoisson( vectorPotentialMultiGrid[ 0 ] , mNegativeVorticityMultiGrid[ 0 ] , numSolverSteps , boundaryCondition , mPoissonResidualStats ) ;
-
-#   else
-
-#       pragma warning(push)
-#       pragma warning(disable: 4127) // conditional expression is constant
-        if( sBoundariesOnly )
-#       pragma warning(pop)
-        {
-            SolveVectorPoisson( vectorPotentialMultiGrid[0] , negativeVorticityMultiGrid[ 0 ] , /* numSteps; 0 means auto-choose */ 0 , boundaryCondition , mPoissonResidualStats ) ;
-        }
-        else
-        {
-            // For Part 19: Temporarily disable solving Poisson, to demonstrate using integral approach technique.
-            //              Notice call to ComputeVectorPotentialFromVorticity_Integral above.
-            UNUSED_PARAM( negativeVorticityMultiGrid ) ; // For Part 19, avoid unreferenced formal parameter compiler warning.  For Part 20, disable this line.
-        }
+    private:
+        VortonSim_ExchangeVorticityPSE_Pair & operator=( const VortonSim_ExchangeVorticityPSE_Pair & ) ;    // Disallow assignment
 
-#       if 0 // Test data flow / repeatability
+        /** Exchange the given fraction of the difference in vorticity between 2 vortons.
+        */
+        void Exchange( unsigned idxHere , unsigned idxThere , float exchangeFraction ) const
         {
-            UniformGrid< Vec3 > vectorPotentialDummy( mGridTemplate ) ;
-            vectorPotentialDummy.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
-        ComputeVectorPotentialFromVorticity_Integral( sBoundariesOnly , vortonIndicesGrid , influenceTree ) ; // Note: This clobbers mVectorPotentialMultiGrid, which is likely the reason the assert below fails
-            SolveVectorPoisson( vectorPotentialDummy , negativeVorticityMultiGrid[0] , 0 , boundaryCondition , mPoissonResidualStats ) ;
-            ASSERT( vectorPotentialDummy == vectorPotentialMultiGrid[0] ) ;
+            ASSERT( fabsf( exchangeFraction ) < 0.5f ) ; // If this triggers, Clamp in the exchange fraction triggered.
+        #if USE_VORTON_SOA
+            const Vec3  vortDiff            = mVortons.GetAngularVelocity( idxHere ) - mVortons.GetAngularVelocity( idxThere ) ;
+        #else
+            const Vec3  vortDiff            = mVortons[ idxHere ].mAngularVelocity - mVortons[ idxThere ].mAngularVelocity ;
+        #endif
+            const Vec3  exchange            = exchangeFraction * vortDiff ;    // Amount of vorticity to exchange between particles.
+            const size_t iDeltaHere         = mVortonCellList.GetSlotOfItem( idxHere  ) - mSlotBegin ;
+            const size_t iDeltaThere        = mVortonCellList.GetSlotOfItem( idxThere ) - mSlotBegin ;
+            ASSERT( ( iDeltaHere < mNumDeltas ) && ( iDeltaThere < mNumDeltas ) ) ;  // Otherwise ComputePseChunkSlots missed a neighbor cell.
+            mDeltas[ iDeltaHere  ] -= exchange ;   // Make "here" vorticity a little closer to "there".
+            mDeltas[ iDeltaThere ] += exchange ;   // Make "there" vorticity a little closer to "here".
         }
-#       endif
-#   endif
-
-    mPoissonResidualStats_AcrossTime.mMean = ( mPoissonResidualStats.mMean + mPoissonResidualStats_AcrossTime.mMean ) * 0.5f ; // Incorrect aggregate of mean
-    mPoissonResidualStats_AcrossTime.mStdDev = ( mPoissonResidualStats.mStdDev + mPoissonResidualStats_AcrossTime.mStdDev ) * 0.5f ; // Incorrect aggregate of stdDev
-    mPoissonResidualStats_AcrossTime.mMin = Min2( mPoissonResidualStats.mMin , mPoissonResidualStats_AcrossTime.mMin ) ;
-    mPoissonResidualStats_AcrossTime.mMax = Max2( mPoissonResidualStats.mMax , mPoissonResidualStats_AcrossTime.mMax ) ;
-}
-
-
-
-
-/** Compute velocity due to vorticity, for every point in a uniform grid, by solving a vector Poisson partial differential equation.
-
-    \param vorticityGrid        Uniform grid of vorticity values, used to compute velocity-from-vorticity using Poisson solver.
-
-    \todo   This routine calls SolveVectorPoisson which (depending on compiler settings inside that routine) uses "natural" boundary
-            conditions.  Instead, what we want to use "radiation" or "open" boundary conditions, where the boundary has "no influence",
-            that is, we want this solver to yield results consistent with using direct summation (or the other integral approaches).
-            To accomplish that, this routine could first use an integral technique (e.g. direct summation, treecode or multipole)
-            to compute velocity (or the vector potential) at the boundaries, then use SolveVectorPoisson with "essential" boundary
-            conditions to populate the domain interior.  Incidentally that approach would also allow the domain to be closer
-            to the interior, rather than inflating the domain, as is done now to diminish the problematic influence of the boundary.
-*/
-void VortonSim::ComputeVelocityFromVorticity_Differential( NestedGrid< Vec3 > & negativeVorticityMultiGrid , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree )
-{
-    PERF_BLOCK( VortonSim__ComputeVelocityFromVorticity_Differential ) ;
-
-    ASSERT( ! mVortons->empty() ) ;
-
-    mVectorPotentialMultiGrid.Initialize( mGridTemplate ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want.)
-
-    ComputeVectorPotential( mVectorPotentialMultiGrid , negativeVorticityMultiGrid , vortonIndicesGrid , influenceTree ) ;
-
-    UniformGrid< Vec3 > &   vectorPotentialGrid = mVectorPotentialMultiGrid[ 0 ] ;
-
-    UniformGrid< Mat33 > jacobianGrid( mVelGrid ) ;
-
-    jacobianGrid.Init() ;
-    // TODO: It would be expedient here to have a routine to compute curl directly from vectorPotential, skipping Jacobian.
-    ComputeJacobian( jacobianGrid , vectorPotentialGrid ) ;
-
-    ComputeCurlFromJacobian( mVelGrid , jacobianGrid ) ;
-}
 
+    #if USE_VORTON_SOA
+        const VortonSoa &           mVortons            ;   ///< Vortons whose vorticity to exchange, as of the start of the step.
+    #else
+        const VECTOR< Vorton > &    mVortons            ;   ///< Vortons whose vorticity to exchange, as of the start of the step.
+    #endif
+        float                       mViscosityTimeStep  ;   ///< Product of viscosity and time step.
+        const CellList &            mVortonCellList     ;   ///< Spatial partition of vortons, which gives the slot of each vorton.
+        Vec3 *                      mDeltas             ;   ///< Per slot that pairs in this chunk can touch, vorticity those pairs exchanged.
+        size_t                      mSlotBegin          ;   ///< Slot of vorton whose delta mDeltas[0] holds.
+        size_t                      mNumDeltas          ;   ///< Number of elements in mDeltas.
+        const FluidKernelTable *    mIspcKernels        ;   ///< ISPC kernels with which to compute exchange fractions, or NULL to compute each pair in C++.
+        FluidKernelPairBatch        mBatch              ;   ///< Pairs awaiting Flush, when using mIspcKernels.
+} ;
 
 
 
-/** Compute velocity due to vortons, for every point in a uniform grid.
 
-    \param vortonIndicesGrid    Spatial partition of vortons, for fast lookup of vortons in a vicinity.
-                                This is mutually exclusive with vorticityGrid.
+/** Run the given stage of vorticity diffusion using a particle strength exchange (PSE) method.
 
-    \param influenceTree        Nested grid of vortons and "super-vortons", used to compute velocity-from-vorticity using treecode.
-                                This is mutually exclusive with vorticityGrid.
+    \param stage - Which stage to run.  See PseStageE.
 
-    \param vorticityGrid        Uniform grid of vorticity values, used to compute velocity-from-vorticity using Poisson solver.
-                                This is mutually exclusive with influenceTree.
+    \param itemBegin, itemEnd - Range of chunks, for PSE_STAGE_EXCHANGE, or of
+        vortons, for PSE_STAGE_APPLY.
 
-    \see CreateInfluenceTree
+    \param numChunks - Number of chunks of rows of cells, each with its own
+        deltas.  See GetNumPseChunks and ComputePseChunkSlots.
 
-    \note This routine assumes CreateInfluenceTree has already executed.
+    \see DiffuseAndDissipateVorticityPSE
 */
-void VortonSim::ComputeVelocityFromVorticity( const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , NestedGrid< Vec3 > & negativeVorticityMultiGrid )
+void VortonSim::DiffuseAndDissipateVorticityPSESlice( PseStageE stage , const float & timeStep , const CellList & vortonCellList , size_t numChunks , size_t itemBegin , size_t itemEnd )
 {
-    PERF_BLOCK( VortonSim__ComputeVelocityFromVorticity ) ;
-
-    mVelGrid.Clear() ;                      // Clear any stale velocity information
-    mVelGrid.CopyShape( mGridTemplate ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want.)
-    mVelGrid.Init() ;                       // Reserve memory for velocity grid.
+    ASSERT( mViscosity * timeStep <= 1.0f ) ; // ...otherwise dissipation will cause vorticity to flip direction.
 
-    if( mVortons->empty() )
-    {   // No vortons; no velocity.
-        return ;
+    if( PSE_STAGE_EXCHANGE == stage )
+    {   // Exchange vorticity with nearest neighbors, into deltas of each chunk.
+        const size_t numRows = vortonCellList.GetNumCells( 1 ) * vortonCellList.GetNumCells( 2 ) ;
+        for( size_t iChunk = itemBegin ; iChunk < itemEnd ; ++ iChunk )
+        {   // For each chunk of rows of cells...
+            const PseChunkSlots &   chunkSlots  = mPseVorticityChunkSlots[ iChunk ] ;
+            const size_t            numDeltas   = chunkSlots.mSlotEnd - chunkSlots.mSlotBegin ;
+            Vec3 *                  deltas      = mPseVorticityDeltas.Data() + chunkSlots.mDeltaBegin ;
+            memset( deltas , 0 , numDeltas * sizeof( Vec3 ) ) ;
+        #if USE_VORTON_SOA
+            VortonSim_ExchangeVorticityPSE_Pair exchangePair( mVortonSoa , mViscosity * timeStep , vortonCellList , deltas , chunkSlots.mSlotBegin , numDeltas , FluidKernels::GetTable() ) ;
+        #else
+            VortonSim_ExchangeVorticityPSE_Pair exchangePair( * mVortons , mViscosity * timeStep , vortonCellList , deltas , chunkSlots.mSlotBegin , numDeltas , FluidKernels::GetTable() ) ;
+        #endif
+            const size_t iRowEnd = ( iChunk + 1 ) * numRows / numChunks ;
+            for( size_t iRow = iChunk * numRows / numChunks ; iRow < iRowEnd ; ++ iRow )
+            {   // For each row of cells in chunk...
+                vortonCellList.ForEachPairInHalfNeighborhood( PseRowBox( vortonCellList , iRow ) , exchangePair ) ;
+            }
+            exchangePair.Flush() ;
+        }
     }
+    else
+    {   // Add deltas from chunks that touched each vorton, then dissipate.
+        ASSERT( PSE_STAGE_APPLY == stage ) ;
+        const float viscousVorticityDissipationFactor = mViscosity * timeStep ;
+        for( size_t iVorton = itemBegin ; iVorton < itemEnd ; ++ iVorton )
+        {   // For each vorton...
+            const size_t slot = vortonCellList.GetSlotOfItem( iVorton ) ;
+            Vec3 delta( 0.0f , 0.0f , 0.0f ) ;
+            for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+            {   // Sum chunks in order, so results do not depend on which thread ran which chunk.
+                const PseChunkSlots & chunkSlots = mPseVorticityChunkSlots[ iChunk ] ;
+                if( ( slot >= chunkSlots.mSlotBegin ) && ( slot < chunkSlots.mSlotEnd ) )
+                {   // Pairs in this chunk could have touched this vorton.
+                    delta += mPseVorticityDeltas[ chunkSlots.mDeltaBegin + slot - chunkSlots.mSlotBegin ] ;
+                }
+            }
+        #if USE_VORTON_SOA
+            Vec3 angVel = mVortonSoa.GetAngularVelocity( iVorton ) + delta ;
+        #else
+            Vec3 & angVel = (*mVortons)[ iVorton ].mAngularVelocity ;
+            angVel += delta ;
+        #endif
+            ASSERT( ! IsNan( angVel ) && ! IsInf( angVel ) ) ;
+
+            // Dissipate vorticity.  See notes in header comment for DiffuseAndDissipateVorticityPSE,
+            // related to dissipation at Kolmogorov scales.  Technically, that should
+            // get converted into heat, but the amounts are usually negligible.
+            // This also simulates diffusing vorticity into regions of fluid that
+            // have no vortons.  A more accurate approach would involve creating vortons
+            // in those regions, so that vorticity could be tracked better, but that would
+            // dramatically slow the simulation, yielding results qualitatively similar to
+            // what this formula does.
+            // Dead vortons have zero deltas, and their vorticity no longer matters.
+            angVel -= viscousVorticityDissipationFactor * angVel ;   // Reduce vorticity here.
+        #if USE_VORTON_SOA
+            mVortonSoa.SetAngularVelocity( iVorton , angVel ) ;
+        #endif
 
-#if ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_DIRECT ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES )
-    ComputeVelocityFromVorticity_Integral( vortonIndicesGrid , influenceTree ) ;
-    UNUSED_PARAM( negativeVorticityMultiGrid ) ; // Avoid "unused formal parameter" compiler warning.
-#elif ( ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL ) )
-    ComputeVelocityFromVorticity_Differential( negativeVorticityMultiGrid , vortonIndicesGrid , influenceTree ) ;
-#else
-    #error Velocity technique is invalid or undefined.  Assign VELOCITY_TECHNIQUE in vorton.h or change this code.
-#endif
+        #if VORTON_SIM_GATHER_STATS
+            mVorticityTermsStats.mViscousDiffusion.Accumulate( delta.Magnitude() ) ; // Note: This is not thread safe.
+        #endif
+        }
+    }
 }
 
 
 
 
-#if defined( _DEBUG )
+/** Diffuse vorticity using a particle strength exchange (PSE) method.
 
-static void TrackVorticityAndKineticEnergyChange(
-      const VECTOR< Vorton > & vortons
-    , const Vec3 & totalVorticityBefore
-    , const float totalKineticEnergyBefore
-    , float totalVorticityChangeMagMax
-    , float totalVorticityChangeMagRelMax
-    , float totalKineticEnergyChangeMax
-    , float totalKineticEnergyChangeRelMax )
-{
-    const Vec3   totalVorticityAfter            = Vorton::ComputeTotalVorticity( vortons ) ;
-    const Vec3   totalVorticityChange           = totalVorticityAfter - totalVorticityBefore ;
-    const float  totalVorticityChangeMag        = totalVorticityChange.Magnitude() ;
-    const float  totalVorticityChangeMagRel     = totalVorticityChangeMag / totalVorticityBefore.Magnitude() ;
-    if( totalVorticityChangeMag > totalVorticityChangeMagMax )
-    {
-        totalVorticityChangeMagMax = totalVorticityChangeMag ;
-    }
-    if( totalVorticityChangeMagRel > totalVorticityChangeMagRelMax )
-    {
-        totalVorticityChangeMagRelMax = totalVorticityChangeMagRel ;
-    }
+    Each vorton exchanges some of its vorticity with its neighbors in its own
+    and adjacent cells.
 
-    const float  totalKineticEnergyAfter        = Vorton::ComputeTotalKineticEnergy( vortons ) ;
-    const float  totalKineticEnergyChange       = totalKineticEnergyAfter - totalKineticEnergyBefore ;
-    const float  totalKineticEnergyChangeRel    = totalKineticEnergyChange / totalKineticEnergyBefore ;
-    if( fabsf( totalKineticEnergyChange ) > fabsf( totalKineticEnergyChangeMax ) )
-    {
-        totalKineticEnergyChangeMax = totalKineticEnergyChange ;
-    }
-    if( fabsf( totalKineticEnergyChangeRel ) > fabsf( totalKineticEnergyChangeRelMax ) )
-    {
-        totalKineticEnergyChangeRelMax = totalKineticEnergyChangeRel ;
-    }
-}
+    This routine makes some simplifying assumptions to speed execution:
 
-#endif
+        -   Only vortons within a certain region of each other exchange
+            vorticity.
+
+        -   This simulation reduces the vorticity of each vorton, alleging that
+            this vorticity is dissipated analogously to how energy dissipates at
+            Kolmogorov microscales.  This treatment is not realistic but it
+            retains qualitative characteristics that we want, e.g. that the flow
+            dissipates at a rate related to viscosity. Dissipation in real flows
+            is a more complicated phenomenon.
 
+    Theoretically, if an adjacent cell contains no vortons then this simulation
+    should generate vorticity within that cell, e.g. by creating a new vorton in
+    the adjacent cell.  But this diffusion implementation does not create new
+    vortons.
 
+    This visits each pair of vortons in the same or adjacent cells once, via
+    CellList::ForEachPairInHalfNeighborhood, and runs in 2 stages:
+    PSE_STAGE_EXCHANGE splits rows of cells into chunks that run concurrently,
+    each accumulating equal and opposite exchanges into its own deltas, from
+    vorticity as of the start of the step.  Each chunk has deltas only for
+    vortons its pairs can touch; see ComputePseChunkSlots.  Then
+    PSE_STAGE_APPLY adds the deltas of those chunks to each vorton.  So, unlike exchanging in place,
+    which needs ForEachCellBlockByColor to run 8 colors of blocks one after
+    another, every pair runs concurrently, results do not depend on the order
+    in which pairs run, and diffusion conserves total vorticity whatever the
+    number of threads.
 
-/** Stretch and tilt vortons using velocity field.
+    \see    Degond & Mas-Gallic (1989): The weighted particle method for
+            convection-diffusion equations, part 1: the case of anisotropic viscosity.
+            Math. Comput., v. 53, n. 188, pp. 485-507, October.
 
     \param timeStep     Amount of time by which to advance simulation.
 
     \param uFrame       Frame counter, used to generate diagnostic files.
 
-    \see GenerateBaroclinicVorticity, DiffuseAndDissipateVorticityPSE
+    \param vortonCellList - Spatial partition of vorton indices.  \see PartitionVortons.
 
-    \see J. T. Beale, A convergent three-dimensional vortex method with
-            grid-free stretching, Math. Comp. 46 (1986), 401-24, April.
+    \see StretchAndTiltVortons, GenerateBaroclinicVorticity, DiffuseAndDissipateHeatPSE
 
-    \note This routine assumes CreateInfluenceTree has already executed.
+    \note When using USE_VORTON_SOA, the caller must gather mVortonSoa from
+            mVortons before calling this routine.  That lets this routine run
+            concurrently with DiffuseAndDissipateHeatPSE, which modifies mVortons.
 
-    \note This routine should run before advecting vortons, otherwise the vortons
-            could leave the velocity grid boundaries.
+    \note When using ENABLE_MERGING_VORTONS, merging modifies vortons in place,
+            so this instead exchanges vorticity in place too, using
+            DiffuseAndMergeVorticityPSESlice.
 
 */
-void VortonSim::StretchAndTiltVortons( const float & timeStep , const unsigned & uFrame )
+void VortonSim::DiffuseAndDissipateVorticityPSE( const float & timeStep , const unsigned & /* uFrame */ , const CellList & vortonCellList )
 {
 #if ENABLE_FLUID_BODY_SIMULATION
+    PERF_BLOCK( VortonSim__DiffuseAndDissipateVorticityPSE ) ;
 
-    PERF_BLOCK( VortonSim__StretchAndTiltVortons ) ;
-
-    if(     ( 0.0f == mVelGrid.GetExtent().x )
-        ||  ( 0.0f == mVelGrid.GetExtent().y )
-        ||  ( 0.0f == mVelGrid.GetExtent().z ) )
-    {   // Domain is 2D, so stretching & tilting does not occur.
+    if( vortonCellList.Empty() )
+    {   // No vortons.
         return ;
     }
 
-    // Compute all gradients of all components of velocity.
-    UniformGrid< Mat33 > velocityJacobianGrid( mVelGrid ) ;
-    velocityJacobianGrid.Init() ;
-    ComputeJacobian( velocityJacobianGrid , mVelGrid ) ;
-
 #if defined( _DEBUG )
-    if( mOutputDiagnostics )
-    {   // Compute curl from velocity, as a test.  This should approximately match the vorticity in mInfluenceTree[0].
-        UniformGrid< Vec3 > curl( /* Copy geometry only, not contents */ (UniformGridGeometry&) mVelGrid ) ;
-        curl.Init() ;
-        ComputeCurlFromJacobian( curl , velocityJacobianGrid ) ;
-        curl.GenerateBrickOfBytes( "curl" , uFrame ) ;
-        #if TEST_RESAMPLE_VORTONS && USE_GIVEN_VORT_GRID
-            vortonSim.AssignVortonsFromVorticity( curl ) ;
-        #endif
-    }
-    const Vec3  totalVorticityBefore     = Vorton::ComputeTotalVorticity( * mVortons ) ;
+    const Vec3  totalVorticityBefore     = Vorton::ComputeTotalVorticity( * mVortons ) ; // TODO: Note that TallyDiagnosticIntegrals effectively gathers this info.  Consolidate?
     const float totalKineticEnergyBefore = Vorton::ComputeTotalKineticEnergy( * mVortons ) ;
 #endif
-    (void) uFrame ; // Avoid "unreferenced formal parameter" warning.
 
 #if VORTON_SIM_GATHER_STATS
-    mVorticityTermsStats.Reset( mVorticityTermsStats.mStretchTilt ) ;
+    mVorticityTermsStats.Reset( mVorticityTermsStats.mViscousDiffusion ) ;
 #endif
 
-    const size_t numVortons = mVortons->Size() ;
+    // Exchange vorticity with nearest neighbors
 
-    for( unsigned offset = 0 ; offset < numVortons ; ++ offset )
-    {   // For each vorton...
-        Vorton &    rVorton     = (*mVortons)[ offset ] ;
-        Mat33       velJac      ;
-        velocityJacobianGrid.Interpolate( velJac , rVorton.mPosition ) ;
-        // Compute stretching & tilting:
-    #if 1
-        const Vec3  stretchTilt = rVorton.mAngularVelocity * velJac ;    // ...using transpose formulation.
-    #else
-        const Vec3  stretchTilt = velJac * rVorton.mAngularVelocity ;    // ...using "classical" formulation.
-    #endif
-    #if VORTON_SIM_GATHER_STATS
-        mVorticityTermsStats.mStretchTilt.Accumulate( stretchTilt.Magnitude() ) ;
-    #endif
-        rVorton.mAngularVelocity += 0.5f * stretchTilt * timeStep ;
-    }
+#if ENABLE_MERGING_VORTONS
+    const size_t numCells[ 3 ] = { vortonCellList.GetNumCells( 0 ) , vortonCellList.GetNumCells( 1 ) , vortonCellList.GetNumCells( 2 ) } ;
+    // Visit blocks of cells in 8 colors, so that no two threads access the same vortons simultaneously.
+    ForEachCellBlockByColor( numCells , Parallel::Method( this , & VortonSim::DiffuseAndMergeVorticityPSESlice , timeStep , vortonCellList ) ) ;
+#else
+#   if USE_VORTON_SOA
+    ASSERT( mVortonSoa.Size() == mVortons->Size() ) ; // Caller must have gathered vortons.  See RunUpdateStage.
+#   endif
 
-#if VORTON_SIM_GATHER_STATS
-    mVorticityTermsStats.mStretchTilt.ConvertAccumulatedSamplesToStats( numVortons ) ;
+    const size_t numVortons = mVortons->Size() ;
+    ASSERT( vortonCellList.GetNumItems() == numVortons ) ;
+    const size_t numChunks  = GetNumPseChunks( vortonCellList ) ;
+    mPseVorticityDeltas.Resize( ComputePseChunkSlots( mPseVorticityChunkSlots , vortonCellList , numChunks ) ) ;
+
+#   if USE_TBB
+        Parallel::For( 0 , numChunks  , 1 , Parallel::Method( this , & VortonSim::DiffuseAndDissipateVorticityPSESlice , PSE_STAGE_EXCHANGE , timeStep , vortonCellList , numChunks ) ) ;
+        Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::DiffuseAndDissipateVorticityPSESlice , PSE_STAGE_APPLY , timeStep , vortonCellList , numChunks ) ) ;
+#   else
+        DiffuseAndDissipateVorticityPSESlice( PSE_STAGE_EXCHANGE , timeStep , vortonCellList , numChunks , 0 , numChunks  ) ;
+        DiffuseAndDissipateVorticityPSESlice( PSE_STAGE_APPLY    , timeStep , vortonCellList , numChunks , 0 , numVortons ) ;
+#   endif
+
+#   if USE_VORTON_SOA
+    mVortonSoa.ScatterAngularVelocity( * mVortons ) ;
+#   endif
 #endif
 
-#if defined( _DEBUG )
-    {   // In principle, stretching and tilting should not change bulk vorticity or kinetic energy.
+#   if defined( _DEBUG )
+    {   // In principle, diffusion should not change bulk vorticity or kinetic energy. But note that 
         static float totalVorticityChangeMagMax     = 0.0f ;
         static float totalVorticityChangeMagRelMax  = 0.0f ;
         static float totalKineticEnergyChangeMax    = 0.0f ;
         static float totalKineticEnergyChangeRelMax = 0.0f ;
         TrackVorticityAndKineticEnergyChange( * mVortons , totalVorticityBefore , totalKineticEnergyBefore , totalVorticityChangeMagMax , totalVorticityChangeMagRelMax , totalKineticEnergyChangeMax , totalKineticEnergyChangeRelMax ) ;
     }
+#   endif
+
+#if VORTON_SIM_GATHER_STATS
+    mVorticityTermsStats.mViscousDiffusion.ConvertAccumulatedSamplesToStats( mVortons->Size() ) ;
 #endif
 
 #endif
@@ -2822,1276 +7259,1374 @@ void VortonSim::StretchAndTiltVortons( const float & timeStep , const unsigned &
 
 
 
-/** Populate a UniformGrid with velocity values from vortons.
+/** Pair function object for CellList::ForEachPairInHalfNeighborhood, which accumulates heat that 2 vortons exchange.
 
-    \param velocityGrid (out) Grid into which to transfer velocity values.
+    This uses the particle strength exchange method to evolve temperature, T,
+    according to the heat diffusion equation:
 
-    \param particles    Dynamic array of particles whose velocity information to
-                        accumulate into velocityGrid.
+        DT/Dt = kappa laplacian T
 
-*/
-void VortonSim::PopulateVelocityGrid( UniformGrid< Vec3 > & velocityGrid , const VECTOR< Particle > & particles )
-{
-    PERF_BLOCK( VortonSim__PopulateVelocityGrid ) ;
+    where D/Dt represents the convective derivative (where t is time),
+    kappa represents thermal diffusivity of the fluid and "laplacian"
+    is the laplacian differential operator (del^2, a.k.a. nabla^2).
 
-    velocityGrid.Clear() ;                              // Clear any stale density information.
-    velocityGrid.CopyShape( mGridTemplate ) ;           // Use same shape as base vorticity grid. (Note: could differ if you want.)
-    Particles::PopulateVelocityGrid( velocityGrid , particles ) ;
-}
+    Like VortonSim_ExchangeVorticityPSE_Pair, this reads density as of the
+    start of the step, and writes equal and opposite amounts to the deltas of
+    its own chunk.
 
+    \note   Under the Boussinesq approximation,
 
+                    density = ambientDensity * ( 1 - thermalExpansionCoefficient * ( temperature - ambientTemperature ) )
+                --> temperature = density / ( ambientDensity * ( 1 - thermalExpansionCoefficient ) ) + ambientTemperature
 
+            If the thermalExpansionCoefficient is constant with respect to density then
+            density and temperature are linearly related (but with opposite sign).
 
-#if defined( _DEBUG )
+            For an ideal gas, thermalExpansionCoefficient=1/temperature so the above formula becomes
 
-static const float tolerance = 0.001f ;
+                density = ambientDensity * ambientTemperature / temperature
+                --> temperature = ambientTemperature * ambientDensity / density
 
-/** Diagnose density grid.
+            In this case, density and temperature are inversely proportional.
 
-    This routine can be called per particle, to isolate problems populating the
-    density grid.
+            Either way, as temperature increases, density decreases.
 */
-static void VerifyDensityGrid( const UniformGrid< float > & densityGrid , const UniformGrid< float > ugParticleContribution , float volumeCorrection , float massSumVortons )
+class VortonSim_ExchangeHeatPSE_Pair
 {
-    PERF_BLOCK( VortonSim__VerifyDensityGrid ) ;
-
-#if VERIFY_NEUTRALLY_BUOYANT_DENSITY    // For diagnosing density grid population. Works only for neutrally buoyant configurations.
-    for( unsigned offset = 0 ; offset < densityGrid.GetGridCapacity() ; ++ offset )
-    {   // For each point in grid...
-        const float pclsContrib = ugParticleContribution[ offset ] ;
-
-        if( pclsContrib != 0.0f )
+    public:
+        VortonSim_ExchangeHeatPSE_Pair( const VECTOR< Vorton > & vortons , float diffusivityTimeStep , const CellList & vortonCellList , float * deltas , size_t slotBegin , size_t numDeltas , const FluidKernelTable * ispcKernels )
+            : mVortons( vortons )
+            , mDiffusivityTimeStep( diffusivityTimeStep )
+            , mVortonCellList( vortonCellList )
+            , mDeltas( deltas )
+            , mSlotBegin( slotBegin )
+            , mNumDeltas( numDeltas )
+            , mIspcKernels( ispcKernels )
+        {}
+
+        void operator()( unsigned idxHere , unsigned idxThere )
         {
-            const float densFromGrid = densityGrid[ offset ] ;
-            const float densOfPcls   = densFromGrid / pclsContrib ;
-            if( ! Math::Resembles( densOfPcls , volumeCorrection , tolerance ) )
-            {   // Density has an unexpected value.
-                int i ; i = 0 ; ++ i ;  // Set breakpoint here.
+            const Vorton &  rVortonHere     = mVortons[ idxHere  ] ;
+            const Vorton &  rVortonThere    = mVortons[ idxThere ] ;
+            ASSERT( rVortonHere.IsAlive() && rVortonThere.IsAlive() ) ;
+            if( mIspcKernels != NULL )
+            {   // Defer pair to Flush.
+                if( mBatch.Add( idxHere , idxThere ) )
+                {
+                    Flush() ;
+                }
+                return ;
             }
+            const float     diffusionRange2 = POW2( 4.0f * rVortonHere.mSize ) ;
+            const float     dist2           = ( rVortonHere.mPosition - rVortonThere.mPosition ).Mag2() ;
+            const float     distLaw         = exp( - dist2 / diffusionRange2 ) ;
+            const float     exchangeRatio   = Clamp( 2.0f * mDiffusivityTimeStep * distLaw , -0.5f , 0.5f ) ; // Portion of heat to exchange between particles.
+            Exchange( idxHere , idxThere , exchangeRatio ) ;
         }
 
-        const float clampedVolCorrectedPclsContrib  = Min2( pclsContrib * volumeCorrection , 1.0f ) ;
-        const float ambientDensityContrib           = 1.0f - clampedVolCorrectedPclsContrib  ;
-        const float totalContribution               = clampedVolCorrectedPclsContrib + ambientDensityContrib ;
-
-        if( ! Math::Resembles( totalContribution , 1.0f , tolerance ) )
-        {   // Corrected contribution tally is not exactly full.
-            // That could legitimately happen if particles "over" contribute,
-            // that is, if ambient does not contribute.  That probably means
-            // multiple particles contributed to a single gridpoint.
-            if( ambientDensityContrib > 0.0f )
-            {   // Clamping did not kick in so ambient did contribute.
-                // Corrected contribution tally has an unexpected value.
-                int i ; i = 0 ; ++ i ;  // Set breakpoint here.
+        /** Exchange heat between all pairs buffered since the previous Flush.
+        */
+        void Flush()
+        {
+            if( 0 == mBatch.mCount )
+            {
+                return ;
+            }
+            const Vorton & rVorton0 = mVortons[ 0 ] ;
+            mIspcKernels->mComputePseExchangeFractions( & rVorton0.mPosition.x , & rVorton0.mPosition.y , & rVorton0.mPosition.z , & rVorton0.mSize , int( sizeof( Vorton ) / sizeof( float ) )
+                                                      , mBatch.mHere , mBatch.mThere , int( mBatch.mCount ) , mDiffusivityTimeStep , mBatch.mResultA ) ;
+            // Apply exchanges serially, since pairs in a batch can share vortons.
+            for( unsigned iPair = 0 ; iPair < mBatch.mCount ; ++ iPair )
+            {   // For each pair in batch...
+                Exchange( mBatch.mHere[ iPair ] , mBatch.mThere[ iPair ] , mBatch.mResultA[ iPair ] ) ;
             }
+            mBatch.mCount = 0 ;
         }
-    }
-#else
-    UNUSED_PARAM( volumeCorrection ) ;
-#endif
 
-    {   // Verify mass is the same for particles and grid.
-        const float densityGridSum  = densityGrid.Sum() * densityGrid.GetCellVolume() ;
-        const float massSumGrid     = densityGridSum ;
-        ASSERT( Math::Resembles( massSumVortons , massSumGrid ) ) ;
-    }
-}
-#endif
+    private:
+        VortonSim_ExchangeHeatPSE_Pair & operator=( const VortonSim_ExchangeHeatPSE_Pair & ) ;  // Disallow assignment
 
+        /** Exchange the given portion of the difference in heat between 2 vortons.
+        */
+        void Exchange( unsigned idxHere , unsigned idxThere , float exchangeRatio ) const
+        {
+            const float     exchange        = exchangeRatio * ( mVortons[ idxHere ].mDensity - mVortons[ idxThere ].mDensity ) ; // Amount of heat to exchange between particles.
+            const size_t    iDeltaHere      = mVortonCellList.GetSlotOfItem( idxHere  ) - mSlotBegin ;
+            const size_t    iDeltaThere     = mVortonCellList.GetSlotOfItem( idxThere ) - mSlotBegin ;
+            ASSERT( ( iDeltaHere < mNumDeltas ) && ( iDeltaThere < mNumDeltas ) ) ;  // Otherwise ComputePseChunkSlots missed a neighbor cell.
+            mDeltas[ iDeltaHere  ] -= exchange ;   // Make "here"  temperature a little closer to "there".
+            mDeltas[ iDeltaThere ] += exchange ;   // Make "there" temperature a little closer to "here".
+        }
 
+        const VECTOR< Vorton > &    mVortons                ;   ///< Vortons whose heat to exchange, as of the start of the step.
+        float                       mDiffusivityTimeStep    ;   ///< Product of thermal diffusivity and time step.
+        const CellList &            mVortonCellList         ;   ///< Spatial partition of vortons, which gives the slot of each vorton.
+        float *                     mDeltas                 ;   ///< Per slot that pairs in this chunk can touch, density those pairs exchanged.
+        size_t                      mSlotBegin              ;   ///< Slot of vorton whose delta mDeltas[0] holds.
+        size_t                      mNumDeltas              ;   ///< Number of elements in mDeltas.
+        const FluidKernelTable *    mIspcKernels            ;   ///< ISPC kernels with which to compute exchange fractions, or NULL to compute each pair in C++.
+        FluidKernelPairBatch        mBatch                  ;   ///< Pairs awaiting Flush, when using mIspcKernels.
+} ;
 
 
-/** Populate a UniformGrid with density and mass fraction values from vortons.
 
-    \param densityGrid (out)    Grid into which to transfer density values.
 
-    \param particles    Dynamic array of particles whose density information to
-                        accumulate into densityGrid.
+/** Run the given stage of heat diffusion using a particle strength exchange (PSE) method.
+
+    \see DiffuseAndDissipateVorticityPSESlice, DiffuseAndDissipateHeatPSE, PartitionVortons
 */
-void VortonSim::PopulateDensityAndMassFractionGrids( UniformGrid< float > & densityGrid , const VECTOR< Particle > & particles , const unsigned uFrame )
+void VortonSim::DiffuseAndDissipateHeatPSESlice( PseStageE stage , const float & timeStep , const CellList & vortonCellList , size_t numChunks , size_t itemBegin , size_t itemEnd )
 {
-    PERF_BLOCK( VortonSim__PopulateDensityAndMassFractionGrids ) ;
-
-    densityGrid.Clear() ;                       // Clear any stale density information.
-    densityGrid.Expand( mGridTemplate , 1 ) ;   // Use same shape as base vorticity grid. (Note: could differ if you want; just change expansion factor from 1 to whatever, though ideally a power of 2.)
-    densityGrid.Init( 0.0f )                ;   // Reserve memory for density grid and initialize all values to zero.
-
-    const UniformGridGeometry & gridGeometry = static_cast< UniformGridGeometry >( densityGrid ) ;
-
-#if ENABLE_FIRE
-    mFuelFractionGrid.Clear() ;
-    mFuelFractionGrid.CopyShape( gridGeometry ) ;
-    mFuelFractionGrid.Init( 0.0f ) ;
-
-    mFlameFractionGrid.Clear() ;
-    mFlameFractionGrid.CopyShape( gridGeometry ) ;
-    mFlameFractionGrid.Init( 0.0f ) ;
-
-    mSmokeFractionGrid.Clear() ;
-    mSmokeFractionGrid.CopyShape( gridGeometry ) ;
-    mSmokeFractionGrid.Init( 0.0f ) ;
-#endif
-
-    DEBUG_ONLY( float massSumVortons = 0.0f ) ;
-
-    // The grid resulting from this operation must preserve the same total mass 
-    // that the particles represent, so multiply by the ratio of the particle 
-    // volume to gridcell volume.
-    // Assume vortons all have same volume.  If they do not, the formula inside
-    // the loop becomes more complicated.
-    const float oneOverCellVolume   = 1.0f / densityGrid.GetCellVolume() ;
-    const float vortonVolume        = particles[ 0 ].GetVolume() ;
-    const float volumeRatio         = vortonVolume * oneOverCellVolume ;
-
-    // Amount of contribution to each grid point.
-    UniformGrid< float > ugParticleContribution( gridGeometry ) ;
-    ugParticleContribution.Init( 0.0f ) ;
-
-    // Populate density and mass-fraction grids.
-    const size_t numParticles = particles.Size() ;
-    for( size_t uParticle = 0 ; uParticle < numParticles ; ++ uParticle )
-    {   // For each particle in the array...
-        const Particle  &   rParticle   = particles[ uParticle ] ;
-        const Vec3      &   rPosition   = rParticle.mPosition   ;
-        ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
-
-        DEBUG_ONLY( const unsigned      uOffset     = densityGrid.OffsetOfPosition( rPosition ) ) ;
-        ASSERT( uOffset < densityGrid.GetGridCapacity() ) ;
-
-        ASSERT( rParticle.mDensity > 0.0f ) ;
-        ASSERT( fabsf( rParticle.GetVolume() - vortonVolume ) < FLT_EPSILON ) ; // Assuming vorton volume is uniform.  Otherwise formula changes.
-        const float volumeCorrectedDensity = rParticle.mDensity * volumeRatio ;
-
-        densityGrid.Accumulate( rPosition , volumeCorrectedDensity ) ;
-
-        DEBUG_ONLY( massSumVortons += rParticle.GetMass() ) ;
-
-        // Tally particle contribution to each gridpoint.
-        // Note that technically 1.0 here should be volume-corrected, but we
-        // assume volume correction is uniform and apply it later.
-        ugParticleContribution.Accumulate( rPosition , 1.0f ) ;
-
-    #if ENABLE_FIRE
-        // Since fractions should average (not add), need to divide by contribution later.
-        DEBUG_ONLY( const float totalFraction = rParticle.mFuelFraction + rParticle.mFlameFraction + rParticle.mSmokeFraction ) ;
-        mFuelFractionGrid.Accumulate ( rPosition , rParticle.mFuelFraction  ) ;
-        mFlameFractionGrid.Accumulate( rPosition , rParticle.mFlameFraction ) ;
-        mSmokeFractionGrid.Accumulate( rPosition , rParticle.mSmokeFraction ) ;
-        ASSERT( ( 0.0f == totalFraction ) || Math::Resembles( totalFraction , 1.0f ) ) ;
-    #endif
-    }
-
-    DEBUG_ONLY( VerifyDensityGrid( densityGrid , ugParticleContribution , volumeRatio , massSumVortons ) ) ;
-
-    // Apply per-gridpoint corrections.
-    const unsigned densityGridCapacity = densityGrid.GetGridCapacity() ;
-    for( unsigned offset = 0 ; offset < densityGridCapacity ; ++ offset )
-    {   // For each point in grid...
-
-        // Add ambient density contribution.
-        // Fluid pervades the region even in the absence of particles.
-        // Particles provide information (like density) where they reside
-        // but when absent, there is still fluid.  Multiple particles can
-        // contribute to each grid cell.  Particles contribute to each gridpoint
-        // inversely proportational to their distance to it. Whether N particles
-        // each contribute 1/N of their mass, or a single particle contributes
-        // all of its mass, the result is the same.  That makes it possible for
-        // N particles to have the cummulative contribution to a particular gridpoint equal or exceed 1.0.  In
-        // that case, ambient contributes nothing.  If particle contribution
-        // is zero at a gridpoint then that gridpoint has only ambient density.
-        // If the contribution is in (0,1) then ambient contributes a complementary amount.
-        //
-        // Details:
-        //    Each particle i contributes phi_i fraction of its rho_i density.
-        //    Each gridpoint then has a tuple < SUM_i rho_i phi_i , SUM_i phi_i >.
-        //    Ambient contributes PHI_0 = max( 1 - SUM_i phi_i , 0 )
-        //    so the density rho at a gridpoint is
-        //        rho = SUM_i rho_i phi_i + PHI_0 * rho_0.
-        const float pclsContrib             = ugParticleContribution[ offset ] * volumeRatio ; // Technically volumeRatio should be in ugParticleContribution already. This assumes it is uniform.
-        const float clampedPclsContrib      = Min2( pclsContrib , 1.0f ) ;
-        const float ambientDensityContrib   = 1.0f - clampedPclsContrib ;
-
-        densityGrid[ offset ] += ambientDensityContrib * mAmbientDensity ;
+    ASSERT( mThermalDiffusivity * timeStep <= 1.0f ) ; // ...otherwise dissipation will cause temperature to flip sign.
 
-    #if VERIFY_NEUTRALLY_BUOYANT_DENSITY    // For diagnosing density grid population. Works only for neutrally buoyant configurations
-        if( ! Math::Resembles( densityGrid[ offset ] , 1.0f , tolerance ) )
-        {   // Corrected density does not match ambient.
-            // That could legitimately happen if particles "over" contribute,
-            // that is, if ambient does not contribute.  That probably means
-            // multiple particles contributed to a single gridpoint.
-            const float ddg = densityGrid[ offset ] ; (void) ddg ;
-            if( ambientDensityContrib > 0.0f )
-            {   // Clamping did not kick in so ambient did contribute.
-                // Corrected density has an unexpected value.
-                int i ; i = 0 ; ++ i ;  // Set breakpoint here.
+    if( PSE_STAGE_EXCHANGE == stage )
+    {   // Exchange heat with nearest neighbors, into deltas of each chunk.
+        const size_t numRows = vortonCellList.GetNumCells( 1 ) * vortonCellList.GetNumCells( 2 ) ;
+        for( size_t iChunk = itemBegin ; iChunk < itemEnd ; ++ iChunk )
+        {   // For each chunk of rows of cells...
+            const PseChunkSlots &   chunkSlots  = mPseDensityChunkSlots[ iChunk ] ;
+            const size_t            numDeltas   = chunkSlots.mSlotEnd - chunkSlots.mSlotBegin ;
+            float *                 deltas      = mPseDensityDeltas.Data() + chunkSlots.mDeltaBegin ;
+            memset( deltas , 0 , numDeltas * sizeof( float ) ) ;
+            VortonSim_ExchangeHeatPSE_Pair exchangePair( * mVortons , mThermalDiffusivity * timeStep , vortonCellList , deltas , chunkSlots.mSlotBegin , numDeltas , FluidKernels::GetTable() ) ;
+            const size_t iRowEnd = ( iChunk + 1 ) * numRows / numChunks ;
+            for( size_t iRow = iChunk * numRows / numChunks ; iRow < iRowEnd ; ++ iRow )
+            {   // For each row of cells in chunk...
+                vortonCellList.ForEachPairInHalfNeighborhood( PseRowBox( vortonCellList , iRow ) , exchangePair ) ;
             }
+            exchangePair.Flush() ;
         }
-    #endif
-
-    #if ENABLE_FIRE
-        // Turn mass-fraction sums into averages.
-        // This assumes "1" was accumulated instead of volumeRatio.
-        // Technically volumeRatio should have been accumulated for contribution,
-        // and particle number would have to be tallied separately.
-        // But here we exploit the fact that vorton volume is uniform.
-        if( ugParticleContribution[ offset ] > 0.0f )
-        {
-            const float oneOverContribution = 1.0f / ugParticleContribution[ offset ] ;
-            mFuelFractionGrid [ offset ] *= oneOverContribution ;
-            mFlameFractionGrid[ offset ] *= oneOverContribution ;
-            mSmokeFractionGrid[ offset ] *= oneOverContribution ;
-            DEBUG_ONLY( const float totalFraction = mFuelFractionGrid[ offset ] + mFlameFractionGrid[ offset ] + mSmokeFractionGrid[ offset ] ) ;
-            DEBUG_ONLY( (void) totalFraction ) ;
+    }
+    else
+    {   // Add deltas from chunks that touched each vorton, then dissipate.
+        ASSERT( PSE_STAGE_APPLY == stage ) ;
+        const float thermalDissipationGain = Clamp( mThermalDiffusivity * timeStep , -0.5f , 0.5f ) ;
+        for( size_t iVorton = itemBegin ; iVorton < itemEnd ; ++ iVorton )
+        {   // For each vorton...
+            const size_t slot = vortonCellList.GetSlotOfItem( iVorton ) ;
+            float delta = 0.0f ;
+            for( size_t iChunk = 0 ; iChunk < numChunks ; ++ iChunk )
+            {   // Sum chunks in order, so results do not depend on which thread ran which chunk.
+                const PseChunkSlots & chunkSlots = mPseDensityChunkSlots[ iChunk ] ;
+                if( ( slot >= chunkSlots.mSlotBegin ) && ( slot < chunkSlots.mSlotEnd ) )
+                {   // Pairs in this chunk could have touched this vorton.
+                    delta += mPseDensityDeltas[ chunkSlots.mDeltaBegin + slot - chunkSlots.mSlotBegin ] ;
+                }
+            }
+            Vorton & rVorton      = (*mVortons)[ iVorton ] ;
+            float &  rDensity     = rVorton.mDensity ;
+            rDensity += delta ;
+
+            // "Dissipate" heat.
+            // This roughly simulates diffusing heat into regions of fluid that have no explicit particles.
+            // The proper solution to this would involve either radiating heat into and out of the environment,
+            // and/or adding fluid particles to regions that lack them, but that would consume computational resources,
+            // and yield qualitatively very similar results.  Remember, this is for a video game eye candy, not
+            // science and engineering.
+            const float densityDelta = mAmbientDensity - rDensity ; // density departure from ambient
+            rDensity += thermalDissipationGain * densityDelta ;     // Reduce temperature departure from ambient, of this vorton.
+            ASSERT( rVorton.GetMass() >= 0.0f ) ;
         }
-    #endif
     }
+}
 
-    ASSERT( ! densityGrid.HasZeroExtent() ) ;
 
-    #if defined( _DEBUG ) || VORTON_SIM_OUTPUT_DENSITY
-    if( mOutputDiagnostics )
-    {   // Output density for visualization.
-        mDensityGrid.GenerateBrickOfBytes( "density" , uFrame ) ;
-    }
-    #else
-        UNUSED_PARAM( uFrame ) ;
-    #endif
-}
 
 
+/** Diffuse heat using a particle strength exchange (PSE) method.
 
+    This visits pairs and runs in stages the same way DiffuseAndDissipateVorticityPSE does.
 
-#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
+    \see DiffuseAndDissipateVorticityPSE
 
-static void PoisonDensityGradientSlice( UniformGrid< Vec3 > & densityGradientGrid , const VECTOR< Vorton > & particles , size_t iPclStart , size_t iPclEnd )
+*/
+void VortonSim::DiffuseAndDissipateHeatPSE( const float & timeStep , const unsigned & /* uFrame */ , const CellList & vortonCellList )
 {
-    // Poison density gradient grid based on vortons in contact with container boundaries.
-    const Vec3 zero( 0.0f , 0.0f , 0.0f ) ;
-    for( size_t iParticle = iPclStart ; iParticle < iPclEnd ; ++ iParticle )
-    {   // For each particle in the array...
-        const Particle  &   rParticle   = particles[ iParticle ] ;
-        if( rParticle.mHitBoundary )
-        {   // This particle hit a boundary.
-            const Vec3      &   rPosition   = rParticle.mPosition   ;
-            ASSERT( ! IsNan( rPosition ) && ! IsInf( rPosition ) ) ;
-            // Zero out any gradients along contact normal.
-            // Remove normal component at each surrounding gridpoint.
-        #if USE_TBB && 0
-            densityGradientGrid.RemoveComponent_ThreadSafe( rPosition , rParticle.mHitNormal ) ;
-        #else
-            densityGradientGrid.RemoveComponent( rPosition , rParticle.mHitNormal ) ;
-        #endif
-        }
+#if ENABLE_FLUID_BODY_SIMULATION
+
+    PERF_BLOCK( VortonSim__DiffuseAndDissipateHeatPSE ) ;
+
+    if( vortonCellList.Empty() )
+    {   // No vortons.
+        return ;
     }
-}
 
+    // Exchange heat with nearest neighbors
 
+    const size_t numVortons = mVortons->Size() ;
+    ASSERT( vortonCellList.GetNumItems() == numVortons ) ;
+    const size_t numChunks  = GetNumPseChunks( vortonCellList ) ;
+    mPseDensityDeltas.Resize( ComputePseChunkSlots( mPseDensityChunkSlots , vortonCellList , numChunks ) ) ;
 
+    #if USE_TBB
+        Parallel::For( 0 , numChunks  , 1 , Parallel::Method( this , & VortonSim::DiffuseAndDissipateHeatPSESlice , PSE_STAGE_EXCHANGE , timeStep , vortonCellList , numChunks ) ) ;
+        Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::DiffuseAndDissipateHeatPSESlice , PSE_STAGE_APPLY , timeStep , vortonCellList , numChunks ) ) ;
+    #else
+        DiffuseAndDissipateHeatPSESlice( PSE_STAGE_EXCHANGE , timeStep , vortonCellList , numChunks , 0 , numChunks  ) ;
+        DiffuseAndDissipateHeatPSESlice( PSE_STAGE_APPLY    , timeStep , vortonCellList , numChunks , 0 , numVortons ) ;
+    #endif
+#endif
+}
 
-/** Remove component of density gradient parallel to surface normals, where vortons contacted with container boundaries.
 
-    This uses hit info from previous frame, and the latency leaves spurious
-    torque especially notable on the first frame.
 
-    Resetting the whole grid cell means particles near, but not at, boundaries
-    do not get the torque they need to flatten surface.
 
+#if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+
+/** Heat sources for UniformGridScatter, one per vorton.
+
+    Each vorton contributes its density departure from ambient, so that
+    gridpoints without vortons count as ambient fluid.
 */
-static void PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , const VECTOR< Vorton > & particles )
+class VortonSim_HeatSources
 {
-    PERF_BLOCK( PoisonDensityGradient_VortonHits ) ;
+    public:
+        VortonSim_HeatSources( const VECTOR< Vorton > & vortons , float ambientDensity , float volumeCorrection )
+            : mVortons( vortons )
+            , mAmbientDensity( ambientDensity )
+            , mVolumeCorrection( volumeCorrection )
+        {}
 
-    const size_t numVortons = particles.Size() ;
+        size_t          GetNumSources() const                                   { return mVortons.Size() ; }
+        const Vec3 &    GetPosition( size_t iSource ) const                     { return mVortons[ iSource ].mPosition ; }
+        void            GetValues( size_t iSource , Vec3 values[] ) const       { values[ 0 ] = Vec3( ( mVortons[ iSource ].mDensity - mAmbientDensity ) * mVolumeCorrection , 0.0f , 0.0f ) ; }
 
-#if USE_TBB && 0 // Thread-safe multi-threaded version runs slower than serial version, so this is disabled.
-    // Estimate grain size based on size of problem and number of processors.
-    const size_t grainSize =  Max2( 1 , numVortons / gNumberOfProcessors ) ;
-    // Compute velocity at gridpoints using multiple threads.
-    parallel_for( tbb::blocked_range<size_t>( 0 , numVortons , grainSize ) , VortonSim_PoisonDensityGradient_TBB( densityGradientGrid , particles ) ) ;
-#else
-    PoisonDensityGradientSlice( densityGradientGrid , particles , 0 , numVortons ) ;
-#endif
-}
+    private:
+        VortonSim_HeatSources & operator=( const VortonSim_HeatSources & ) ; // Disallow assignment.
 
-#endif
+        const VECTOR< Vorton > &    mVortons            ;   ///< Vortons whose density to accumulate
+        const float                 mAmbientDensity     ;   ///< Density of fluid without vortons
+        const float                 mVolumeCorrection   ;   ///< Ratio of vorton volume to grid cell volume
+} ;
 
 
 
 
-#if POISON_DENSITY_GRADIENT_BASED_ON_RIGID_SPHERE_GEOMETRY
-/** Remove spurious density gradients that could arise due to geometric arrangement of vortons.
+/** Return whether diffusion with the given diffusivity should take an implicit step on the grid, instead of using particle strength exchange.
 
-    Any gradient due to the arrangement of packed hard spheres is a spurious artifact of geometry.
-    Closest packing leads to an average density of pi/sqrt(18)~=0.74048.
-    Farthest packing leads to an average density of 4pi/24~=0.52350.
-    Their ratio is 1/sqrt(2)~=0.70711.  So a variation smaller than (1-1/sqrt(2))~=0.29289
-    is unreliable.  Note that applying this ratio requires knowing the density
-    at each point where this is applied.  So the algorithm would need density as well as its gradient.
-*/
-static void PoisonDensityGradient( UniformGrid< Vec3 > & densityGradientGrid , UniformGrid< float > & densityGrid )
-{
-    PERF_BLOCK( PoisonDensityGradient_SphereGeometry ) ;
+    \param diffusivity  Viscosity or thermal diffusivity.
 
-    const Vec3 zero( 0.0f , 0.0f , 0.0f ) ;
-    const unsigned densityGradientGridCapacity = densityGradientGrid.GetGridCapacity() ;
-    for( unsigned offset = 0 ; offset < densityGradientGridCapacity ; ++ offset )
-    {   // For each point in grid...
-        Vec3 gridPointPosition ;
-        densityGradientGrid.PositionFromOffset( gridPointPosition , offset ) ;
-        // Test whether grid point is inside rigid body.
-        // If so, set gradient to zero there.
-        Vec3 &          densGrad        = densityGradientGrid[ offset ] ;
-        const float     densGradMag2    = densGrad.Mag2() ;
-        const float &   density         = densityGrid[ offset ] ;
-        const float     densGrad2Thresh = 0.29289f * density ;
+    \param timeStep     Amount of time by which to advance simulation.
 
-        if( densGradMag2 < densGrad2Thresh )
-        {
-            densGrad = zero ;
-        }
+    \see SetGridDiffusionThreshold.
+*/
+bool VortonSim::IsGridDiffusionPreferred( float diffusivity , float timeStep ) const
+{
+    const Vec3 &    spacing         = mGridTemplate.GetCellSpacing() ;
+    // Avoid spacing of zero along z, for 2D domains.
+    const float     spacingMin      = ( spacing.z > FLT_EPSILON ) ? MIN3( spacing.x , spacing.y , spacing.z ) : Min2( spacing.x , spacing.y ) ;
+    if( spacingMin <= FLT_EPSILON )
+    {   // Grid has no extent yet.
+        return false ;
     }
+    const float     diffusionNumber = diffusivity * timeStep / Pow2( spacingMin ) ;
+    return diffusionNumber > mGridDiffusionThreshold ;
 }
-#endif
 
 
 
 
-/** Process combustion for a vorton, and assign mass fractions.
-
-    \param timeStep     Amount of time by which to advance simulation.
+/** Add change that DiffuseOnGrid made to the given quantity, to a subset of vortons.
 
-    \param rVorton Reference to vorton to process.
+    \param quantity     Which vorton property to change.
 
-    \note This routine assumes PopulateDensityAndMassFractionGrids has
-            already executed, specifically the mass fraction grid is populated.
+    \param iVortonStart - index of first vorton to change
 
-    \note This routine should run before advecting vortons, otherwise the vortons
-            could leave the velocity grid boundaries, and this routine needs to interpolate
-            within those boundaries.
+    \param iVortonEnd - one past index of last vorton to change
 
+    \see DiffuseOnGrid.
 */
-inline void VortonSim::CombustAndSetMassFractions( float timeStep , Vorton & rVorton )
+void VortonSim::ApplyGridDiffusion_Slice( GridDiffusionQuantityE quantity , size_t iVortonStart , size_t iVortonEnd )
 {
-#if ENABLE_FIRE
+    const UniformGrid< Vec3 > & change = mGridDiffusionFields[ quantity ][ 0 ] ;
+
+    for( size_t iVorton = iVortonStart ; iVorton < iVortonEnd ; ++ iVorton )
+    {   // For each vorton in this slice...
+        Vorton &    rVorton = (*mVortons)[ iVorton ] ;
+        Vec3        delta ;
+        change.Interpolate( delta , rVorton.mPosition ) ;
+        ASSERT( ! IsNan( delta ) && ! IsInf( delta ) ) ;
+        if( GRID_DIFFUSION_VORTICITY == quantity )
+        {
+            rVorton.mAngularVelocity += 0.5f * delta ; // Grid holds vorticity, which is twice angular velocity.
+        }
+        else
+        {
+            rVorton.mDensity += delta.x ;
+        }
+    }
+}
 
-    //PERF_BLOCK( VortonSim__CombustAndSetMassFractions ) ;
-
-    const float vortonTemperature = rVorton.GetTemperature( mAmbientDensity ) ;
-    ASSERT( ! IsNan( vortonTemperature ) && ! IsInf( vortonTemperature ) ) ;
-
-    ASSERT( ! IsNan( rVorton.mFlameFraction ) && ! IsInf( rVorton.mFlameFraction ) ) ;
-    if( rVorton.mFlameFraction > 0.0f )
-    {   // This particle is on fire.
-        ASSERT( rVorton.mFuelFraction  >= 0.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFuelFraction  <= 1.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFlameFraction >= 0.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFuelFraction + rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
-    #if 0 // Stam & Fiume (1995) -- Akin to an inverse Arrhenius reaction rate.
-        const float temperatureDependence   = exp( - vortonTemperature / mSmokeTemperature ) ;
-    #elif 1 // MJG "gradual step" function (Gaussian)
-        const float arg1 = vortonTemperature / mSmokeTemperature ;
-        const float arg2 = arg1 * arg1 ;
-        const float temperatureDependence   = exp( - arg2 ) ;
-    #else // Step function
-        const float temperatureDependence   = vortonTemperature < mSmokeTemperature ? 1.0f : 0.0f ;
-    #endif
-        const float smokeRate               = mSmokeRateFactor * temperatureDependence * rVorton.mFlameFraction ;
-        const float flameToSmokeChange      = smokeRate * timeStep ;
-        // Decrease amount of flame.  This automatically increases the amount of smoke,
-        // since (smokeFraction) is defined as 1-mFlameFraction-mFuelFraction.
-        // Note that flame-to-smoke conversion happens first.  This
-        // allows for flames to appear for at least a frame even if the burn
-        // rate is extremely high.  If the order of operations was
-        // fuel-to-flame and flame-to-smoke, then fuel could turn to smoke
-        // in a single frame without flame ever getting a change to render.
-        rVorton.mFlameFraction -= flameToSmokeChange ;
-
-        ASSERT( rVorton.mFuelFraction  >= 0.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFuelFraction  <= 1.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFlameFraction >= 0.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFuelFraction + rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
-    }
-
-    ASSERT( ! IsNan( rVorton.mFuelFraction ) && ! IsInf( rVorton.mFuelFraction ) ) ;
-    if( rVorton.mFuelFraction > 0.0f )
-    {   // This particle has some fuel.
-    #if USE_ARRHENIUS
-        const float temperatureDependence   = exp( - mCombustionTemperature / vortonTemperature ) ;
-    #else
-        const float temperatureDependence   = vortonTemperature > mCombustionTemperature ? 1.0f : 0.0f ;
-    #endif
-        const float combustionRate  = mCombustionRateFactor * temperatureDependence * rVorton.mFuelFraction ;
-        const float fuelToFlameChange = combustionRate * timeStep ;
-        // Decrease amount of fuel and increase amount of flame.
-        rVorton.mFuelFraction  -= fuelToFlameChange ;
-        rVorton.mFlameFraction += fuelToFlameChange ;
-        ASSERT( rVorton.mFuelFraction  >= 0.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFuelFraction  <= 1.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFlameFraction >= 0.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
-        ASSERT( rVorton.mFuelFraction + rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
 
-        // Change temperature due to heat released by combusting fuel:
-        const float temperatureChange = mSpecificFreeEnergy * fuelToFlameChange * rVorton.GetDensity() * mSpecificHeatCapacity ;
-        rVorton.SetTemperature( mAmbientDensity , vortonTemperature + temperatureChange ) ;
-    }
 
-    // For simplicity, assign the balance of the species fraction to smoke.
-    // In principle, smoke should only result from combustion, but here
-    // we just make everything in the fluid that isn't fuel or flame, smoke.
-    rVorton.mSmokeFraction = 1.0f - ( rVorton.mFuelFraction + rVorton.mFlameFraction ) ;
 
-    ASSERT( rVorton.mFuelFraction  >= 0.0f ) ; // Paranoid sanity check.
-    ASSERT( rVorton.mFuelFraction  <= 1.0f ) ; // Paranoid sanity check.
-    ASSERT( rVorton.mFlameFraction >= 0.0f ) ; // Paranoid sanity check.
-    ASSERT( rVorton.mFlameFraction <= 1.0f ) ; // Paranoid sanity check.
-    ASSERT( rVorton.mSmokeFraction >= 0.0f ) ; // Paranoid sanity check.
-    ASSERT( rVorton.mSmokeFraction <= 1.0f ) ; // Paranoid sanity check.
+/** Diffuse vorticity or heat by taking an implicit step on the grid.
 
-#endif
-}
+    This splats the quantity from vortons onto a grid, solves
+        ( 1 - diffusivity timeStep D ) diffused = original
+    for the diffused field, where D is the Laplacian, then interpolates the change,
+    diffused - original, back onto vortons.  Transferring only the change means
+    that splatting and interpolating do not otherwise smooth vorton properties.
 
+    Particle strength exchange (see DiffuseAndDissipateVorticityPSE) costs more
+    and grows less accurate as diffusivity grows, because each step only
+    exchanges between neighboring vortons.  In contrast, this implicit step is
+    stable for any diffusivity, and the multigrid solver reduces the residual
+    by a factor per cycle that does not depend on diffusivity.  The higher
+    the diffusivity, the more diagonally dominant the equation, so if anything,
+    it converges faster.
 
+    Diffusion into gridpoints without vortons removes that portion from vortons,
+    so unlike particle strength exchange, this does not also dissipate.
 
+    \param quantity     Which vorton property to diffuse.
 
-/** Populate signed distance grid from density grid.
+    \param timeStep     Amount of time by which to advance simulation.
 
-    \param signedDistanceGrid   Grid of signed distance values, where negative means inside,
-                                positive means outside and 0 means at the surface of a fluid.
+    \note Each quantity has its own grids, and changes a different member of each
+            vorton, so heat and vorticity can diffuse concurrently.
 
-    \param densityGrid          Grid of fluid density values.
+    \see IsGridDiffusionPreferred, SolveVectorScreenedPoissonMultiGrid.
 */
-void VortonSim::PopulateSignedDistanceGridFromDensityGrid( UniformGrid< float > & signedDistanceGrid , const UniformGrid< float > & densityGrid , const unsigned uFrame )
+void VortonSim::DiffuseOnGrid( GridDiffusionQuantityE quantity , float timeStep )
 {
-    PERF_BLOCK( VortonSim__PopulateSignedDistanceGridFromParticleDensity ) ;
+    PERF_BLOCK( VortonSim__DiffuseOnGrid ) ;
 
-    signedDistanceGrid.Clear() ;
-    signedDistanceGrid.CopyShape( mDensityGrid ) ;
-    signedDistanceGrid.Init( FLT_MAX ) ; // Reserve memory for SDF grid and initialize all values to FLT_MAX.
+    if( mVortons->Empty() )
+    {   // No vortons.
+        return ;
+    }
+
+    NestedGrid< Vec3 > &    field       = mGridDiffusionFields[ quantity ] ;
+    NestedGrid< Vec3 > &    sources     = mGridDiffusionSources[ quantity ] ;
+    const float             diffusivity = ( GRID_DIFFUSION_VORTICITY == quantity ) ? mViscosity : mThermalDiffusivity ;
+    ASSERT( diffusivity * timeStep > 0.0f ) ;
 
+    // Splat quantity from vortons onto grid.
+    field.Initialize( mGridTemplate ) ;
+    if( GRID_DIFFUSION_VORTICITY == quantity )
     {
-        UniformGrid< int > sdfPinnedGrid ;
-        sdfPinnedGrid.Clear() ;
-        sdfPinnedGrid.CopyShape( densityGrid ) ;
-        sdfPinnedGrid.Init( 0 ) ; // Reserve memory for grid and initialize all values to false.
-        ComputeImmediateSDFFromDensity_Nearest( signedDistanceGrid , sdfPinnedGrid , densityGrid , mAmbientDensity ) ;
-        ComputeRemainingSDFFromImmediateSDF_Nearest( signedDistanceGrid , sdfPinnedGrid ) ;
-//ComputeSDF_Sphere( signedDistanceGrid ) ; // DO NOT SUBMIT. Diagnosing surface tracer placment
+        PopulateVorticityGridFromVortons( field[ 0 ] , 1.0f ) ;
+    }
+    else
+    {
+        field[ 0 ].Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;
+        // Preserve total heat, as PopulateVorticityGridFromVortons preserves total circulation.
+        const float                 volumeCorrection    = (*mVortons)[ 0 ].GetVolume() / field[ 0 ].GetCellVolume() ;
+        const VortonSim_HeatSources heatSources( * mVortons , mAmbientDensity , volumeCorrection ) ;
+        UniformGrid< Vec3 > *       grids[]             = { & field[ 0 ] } ;
+        ScatterIntoGrids( grids , 1 , heatSources ) ;
     }
 
-#   if defined( _DEBUG ) || VORTON_SIM_OUTPUT_SDF
-    if( mOutputDiagnostics )
-    {   // Output density for visualization.
-        signedDistanceGrid.GenerateBrickOfBytes( "sdf" , uFrame ) ;
+    // The implicit step is the screened Poisson equation
+    //     D diffused - screening diffused = - screening original
+    // with screening = 1 / ( diffusivity timeStep ).
+    const float     diffusivityTimeStep = diffusivity * timeStep ;
+    const float     screening           = 1.0f / diffusivityTimeStep ;
+    const size_t    numPoints           = field[ 0 ].GetGridCapacity() ;
+    sources.Initialize( mGridTemplate ) ;
+    for( size_t offset = 0 ; offset < numPoints ; ++ offset )
+    {   // For each gridpoint...
+        sources[ 0 ][ offset ] = - screening * field[ 0 ][ offset ] ;
     }
-#   else
-        UNUSED_PARAM( uFrame ) ;
-#   endif
+
+    // The original field is a good initial guess, so solve starting from it.
+    // Neumann boundary conditions let nothing diffuse through the domain boundary.
+    static const float      residualTolerance   = 1.0e-3f ; // Stop when residual falls below this fraction of that of a zero guess.
+    static const size_t     maxCycles           = 8 ;       // Stop after this many cycles regardless of residual.
+    static const unsigned   cycleIndex          = 1 ;       // 1 for V-cycle, 2 for W-cycle.
+    Stats_Float             residualStats ;
+    SolveVectorScreenedPoissonMultiGrid( field , sources , screening , mGridDiffusionScratch[ quantity ] , BC_NEUMANN , residualTolerance , maxCycles , cycleIndex , /* warmStart */ true , residualStats ) ;
+
+    // Replace diffused field with its change.  Layer 0 of sources still holds - screening original.
+    for( size_t offset = 0 ; offset < numPoints ; ++ offset )
+    {   // For each gridpoint...
+        field[ 0 ][ offset ] += diffusivityTimeStep * sources[ 0 ][ offset ] ;
+    }
+
+    // Interpolate change back onto vortons.
+    const size_t numVortons = mVortons->Size() ;
+    Parallel::For( 0 , numVortons , Parallel::GetGrainSize( numVortons ) , Parallel::Method( this , & VortonSim::ApplyGridDiffusion_Slice , quantity ) ) ;
 }
+#endif
 
 
 
 
-/** Compute baroclinic generation of vorticity due to buoyancy.
+/** Task graph node that runs one stage of VortonSim::UpdateVortexParticleMethod.
+*/
+class VortonSim_UpdateStage_Task : public Parallel::Task
+{
+        VortonSim *                 mVortonSim          ;   ///< Address of VortonSim object
+        VortonSim::UpdateStageE     mStage              ;   ///< Which stage to run.
+        float                       mTimeStep           ;   ///< Amount of virtual time by which to advance simulation.
+        unsigned                    mFrame              ;   ///< Frame counter, used to generate diagnostic files.
+        NestedGrid< Vorton > &      mInfluenceTree      ;   ///< Influence tree shared by stages.
+        VECTOR< Vorton > *          mOriginalVortons    ;   ///< Vortons that PIC ghost vortons replaced, or NULL when not using PIC.
+    public:
+        virtual void Run()
+        {
+            Timer timer ;
+            mVortonSim->RunUpdateStage( mStage , mTimeStep , mFrame , mInfluenceTree , mOriginalVortons ) ;
+            mVortonSim->mUpdateStageDurations[ mStage ] = timer.GetElapsedTimeSeconds() ;   // Each stage runs once per update, so concurrent stages write different elements.
+        }
+        VortonSim_UpdateStage_Task( VortonSim * pVortonSim , VortonSim::UpdateStageE stage , float timeStep , unsigned uFrame , NestedGrid< Vorton > & influenceTree , VECTOR< Vorton > * originalVortons )
+            : mVortonSim( pVortonSim )
+            , mStage( stage )
+            , mTimeStep( timeStep )
+            , mFrame( uFrame )
+            , mInfluenceTree( influenceTree )
+            , mOriginalVortons( originalVortons )
+        {
+        }
+    private:
+        VortonSim_UpdateStage_Task & operator=( const VortonSim_UpdateStage_Task & ) ; // Disallow assignment
+} ;
 
-    \param timeStep     Amount of time by which to advance simulation.
 
-    \param iPclStart    Index of first particle to process.
 
-    \param iPclEnd      One past index of last particle to process.
 
-    \see DiffuseAndDissipateVorticityPSE, StretchAndTiltVortons
+/** Return short name of the given update stage, for reports.
+*/
+/* static */ const char * VortonSim::GetUpdateStageName( UpdateStageE stage )
+{
+    switch( stage )
+    {
+    case UPDATE_STAGE_INFLUENCE_TREE    : return "InfluenceTree"     ;
+    case UPDATE_STAGE_VORTICITY_GRID    : return "VorticityGrid"     ;
+    case UPDATE_STAGE_PARTITION         : return "Partition"         ;
+    case UPDATE_STAGE_VELOCITY          : return "Velocity"          ;
+    case UPDATE_STAGE_STRETCH           : return "Stretch"           ;
+    case UPDATE_STAGE_BAROCLINIC        : return "Baroclinic"        ;
+    case UPDATE_STAGE_COMBUSTION        : return "Combustion"        ;
+    case UPDATE_STAGE_HEAT              : return "Heat"              ;
+    case UPDATE_STAGE_VISCOUS_DIFFUSION : return "ViscousDiffusion"  ;
+    default: FAIL() ; return "Unknown" ;
+    }
+}
 
-    \note This routine assumes CreateInfluenceTree has already executed,
-            specifically that the velocity grid shape has already been calculated.
 
-    \note This routine assumes PopulateDensityAndMassFractionGrids has
-            already executed, specifically the mass fraction grid is populated.
 
-    \note This routine should run before advecting vortons, otherwise the vortons
-            could leave the velocity grid boundaries, and this routine needs to
-            interpolate within those boundaries.
 
-*/
-void VortonSim::GenerateBaroclinicVorticitySlice( float timeStep
-#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
-                                                 , const VECTOR< Vec3 > * densityGradients
-#endif
+/** Run one stage of UpdateVortexParticleMethod.
 
-                                                 , size_t iPclStart , size_t iPclEnd )
-{
-    PERF_BLOCK( VortonSim__GenerateBaroclinicVorticitySlice ) ;
+    \param stage            Which stage to run.
 
-    const float oneOverDensity = 1.0f / GetAmbientDensity() ;
+    \param timeStep         Amount of virtual time by which to advance simulation.
 
-    for( size_t iPcl = iPclStart ; iPcl < iPclEnd ; ++ iPcl )
-    {   // For each particle in this slice...
-        Vorton &    rVorton         = (*mVortons)[ iPcl ] ;
+    \param uFrame           Frame counter, used to generate diagnostic files.
 
-        // Technically the baroclinic term should have density in the
-        // denominator, but it's relatively expensive to calculate the local
-        // value, plus the Boussinesq approximation assumes density variations
-        // are small compared to the ambient.  So instead, we use the ambient
-        // density in the denominator, which yields the correct units and gets
-        // results in the right ballpark.
-        // This is yet another example of where, for visual effects,
-        // we take drastic liberties in the name of speed over accuracy.
+    \param influenceTree    Influence tree that UPDATE_STAGE_INFLUENCE_TREE creates and UPDATE_STAGE_VELOCITY uses.
 
-        //float       density ;
-        //mDensityGrid.Interpolate( density , rVorton.mPosition ) ;
-        //ASSERT( density > 0.0f ) ;
+    \param originalVortons  When using PIC, vortons that ghost vortons replaced, which UPDATE_STAGE_VELOCITY restores.
+                            Otherwise NULL.
 
-    #if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
-        const Vec3 & densityGradient = (*densityGradients)[ iPcl ] ;
-        ASSERT( ! IsNan( densityGradient ) && ! IsInf( densityGradient ) ) ;
-    #elif POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
-        Vec3    densityGradient( 0.0f , 0.0f , 0.0f ) ;
-        mDensityGradientGrid.InterpolateConditionally( densityGradient , rVorton.mPosition ) ;
-    #else   // Use density gradient computed on grid.
-        Vec3    densityGradient ;
-        mDensityGradientGrid.Interpolate( densityGradient , rVorton.mPosition ) ;
+    Each stage that changes vortons also tallies the diagnostic integrals that follow it.
+
+    \see UpdateVortexParticleMethod
+*/
+void VortonSim::RunUpdateStage( UpdateStageE stage , float timeStep , unsigned uFrame , NestedGrid< Vorton > & influenceTree , VECTOR< Vorton > * originalVortons )
+{
+    switch( stage )
+    {
+    case UPDATE_STAGE_INFLUENCE_TREE:
+        CreateInfluenceTree( influenceTree ) ;
+    #if VORTON_SIM_USE_LINEAR_INFLUENCE_TREE
+        mLinearInfluenceTree.Build( influenceTree ) ;   // Failure leaves it empty, so queries traverse influenceTree.
     #endif
+        break ;
 
-        if( ! IsNan( densityGradient ) && ! IsInf( densityGradient ) )
-        {
+    case UPDATE_STAGE_VORTICITY_GRID:
+        mNegativeVorticityMultiGrid.Initialize( mGridTemplate ) ;
+        PopulateVorticityGridFromVortons( mNegativeVorticityMultiGrid[ 0 ] , -1.0f ) ;
+        break ;
 
-        #if COMPUTE_PRESSURE_GRADIENT
-            #error Do not use this branch.  It was a half-baked idea that did not work out.
-            Vec3        pressureGradient ;
-            mPressureGradientGrid.Interpolate( pressureGradient , rVorton.mPosition ) ;
-            ASSERT( ! IsNan( pressureGradient ) && ! IsInf( pressureGradient ) ) ;
-            pressureGradient += mGravAccel ;
-        #else
-            const Vec3  pressureGradient = mGravAccel ;
-        #endif
+    case UPDATE_STAGE_PARTITION:
+        PartitionVortons( timeStep , uFrame , mVortonIndicesGrid ) ;
+        break ;
 
-            const Vec3  baroclinicGeneration = densityGradient ^ pressureGradient * oneOverDensity ;
-            // The formula for the line below is meant to update vorticity,
-            // but since particles store vorticity as angular velocity, the formula has an extra factor of 0.5.
-            ASSERT( ! IsNan( baroclinicGeneration ) && ! IsInf( baroclinicGeneration ) ) ;
-            ASSERT( ! IsNan( rVorton.mAngularVelocity ) && ! IsInf( rVorton.mAngularVelocity ) ) ;
-            rVorton.mAngularVelocity += 0.5f * baroclinicGeneration * timeStep ;
+    case UPDATE_STAGE_VELOCITY:
+        // Use vorticity to compute velocity.
+        {
+            Timer velocityTimer ;
+            ComputeVelocityFromVorticity( mVortonIndicesGrid , influenceTree , mNegativeVorticityMultiGrid ) ;
+            if( ( VELOCITY_FROM_VORTICITY_AUTO == mVelFromVortTechnique ) && ( mVelocityTechniqueTuner.mCandidate < VELOCITY_FROM_VORTICITY_AUTO ) )
+            {   // Tuning technique, so record how this candidate fared.
+                const float seconds = velocityTimer.GetElapsedTimeSeconds() ;
+                const float error   = ( VELOCITY_FROM_VORTICITY_DIRECT == mVelFromVortTechniqueInEffect ) ? 0.0f : MeasureVelocityGridError( sAutoTuneNumErrorSamples ) ;
+                RecordVelocityFromVorticityTrial( seconds , error ) ;
+            }
+        }
 
-        #if VORTON_SIM_GATHER_STATS
-            mVorticityTermsStats.mBaroclinic.Accumulate( baroclinicGeneration.Magnitude() ) ; // Note: This is not thread safe.
-        #endif
+        if( mNumTreecodeErrorSamples > 0 )
+        {   // Measure treecode and velocity grid error while vortons still match influence tree and velocity grid.
+            MeasureTreecodeError( mVortonIndicesGrid , influenceTree ) ;
+            mVelocityGridError = MeasureVelocityGridError( mNumTreecodeErrorSamples ) ;
+        }
+        else
+        {
+            mTreecodeErrorStats = TreecodeErrorStatistics() ;
+            mVelocityGridError  = 0.0f ;
         }
 
-        CombustAndSetMassFractions( timeStep , rVorton ) ;
-    }
-}
+        #if defined( _DEBUG )
+        if( mOutputDiagnostics )
+        {
+            mVelGrid.GenerateBrickOfBytes( "vel" , uFrame ) ;
+        }
+        #endif
 
+    #if USE_PARTICLE_IN_CELL
+        // Restore original vortons after computing velocity grid, but before any other operations on vortons.
+        mVortons->swap( * originalVortons ) ;
 
+        // Vorton partition must be for the original vortons, not for PIC ghost vortons.
+        // When NOT using PIC, UPDATE_STAGE_PARTITION partitions vortons instead.
+        PartitionVortons( timeStep , uFrame , mVortonIndicesGrid ) ;
+    #else
+        (void) originalVortons ;
+    #endif
 
+        ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterVelGrid ) ;
 
-/** Compute baroclinic generation of vorticity due to buoyancy.
+        mVorticityTermsStats.Reset() ;
+        break ;
 
-    \param timeStep     Amount of time by which to advance simulation.
+    case UPDATE_STAGE_STRETCH:
+        if( ( FLUID_SIM_VORTEX_PARTICLE_METHOD == mFluidSimTechnique )      // Disable stretching for VPM-SPH hybrid, because it causes numerical instability.
+            &&  (   ( INVESTIGATE_ALL                == mInvestigationTerm )
+                ||  ( INVESTIGATE_STRETCHING_TILTING == mInvestigationTerm )
+                )
+            )
+        {
+            StretchAndTiltVortons( timeStep , uFrame ) ;
+        }
 
-    \param uFrame       Frame counter, used to generate diagnostic files.
+        ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterStretch ) ;
+        break ;
 
-    \see DiffuseAndDissipateVorticityPSE, StretchAndTiltVortons
+    case UPDATE_STAGE_BAROCLINIC:
+        if( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_BAROCLINIC == mInvestigationTerm ) )
+        {
+            GenerateBaroclinicVorticity( timeStep , uFrame
+        #if COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS || COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
+                                        , mVortonIndicesGrid
+        #endif
+                                        ) ;
+        }
 
-    \note This routine assumes CreateInfluenceTree has already executed,
-            specifically that the velocity grid has already been calculated.
+        ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterBaroclinic ) ;
 
-    \note This routine assumes PopulateDensityAndMassFractionGrids has
-            already executed, specifically the mass fraction grid is populated.
+    #if USE_VORTON_SOA && ! ENABLE_MERGING_VORTONS
+        // Gather vortons for viscous diffusion here, because heat diffusion,
+        // which can run concurrently with viscous diffusion, modifies vortons.
+        mVortonSoa.Gather( * mVortons ) ;
+    #endif
+        break ;
 
-    \note This routine should run before advecting vortons, otherwise the vortons
-            could leave the velocity grid boundaries.
+    case UPDATE_STAGE_COMBUSTION:
+        // Heat released by combustion matters mainly through buoyancy, so
+        // combustion runs under the same conditions as baroclinic generation.
+        if( ( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_BAROCLINIC == mInvestigationTerm ) )
+            && ! IsBuoyancyNegligible() )
+        {
+            CombustAndSetMassFractions( timeStep ) ;
+        }
+        break ;
 
-*/
-void VortonSim::GenerateBaroclinicVorticity( const float timeStep , const unsigned uFrame
-#if COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS || COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
-                                            , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices
-#endif
-                                            )
-{
-    PERF_BLOCK( VortonSim__GenerateBaroclinicVorticity ) ;
+    case UPDATE_STAGE_HEAT:
+        if( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_THERMAL_DIFFUSION == mInvestigationTerm ) )
+        {
+        #if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+            if( IsGridDiffusionPreferred( mThermalDiffusivity , timeStep ) )
+            {   // Diffusion is strong enough that particle strength exchange would overshoot.
+                DiffuseOnGrid( GRID_DIFFUSION_HEAT , timeStep ) ;
+            }
+            else
+        #endif
+            {
+                DiffuseAndDissipateHeatPSE( timeStep , uFrame , mVortonIndicesGrid ) ;
+            }
+        }
 
-    UNUSED_PARAM( uFrame ) ; // Avoid "unreferenced formal parameter" warning.
+        ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterHeat ) ;
+        break ;
 
-    if( fabsf( mGravAccel * mVelGrid.GetExtent() ) < FLT_EPSILON )
-    {   // Domain is 2D and has no significant component along the gravity direction,
-        // so baroclinic generation cannot occur in this Boussinesq approximation.
-        return ;
-    }
+    case UPDATE_STAGE_VISCOUS_DIFFUSION:
+        if( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_VISCOUS_DIFFUSION == mInvestigationTerm ) )
+        {
+        #if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+            if( IsGridDiffusionPreferred( mViscosity , timeStep ) )
+            {   // Diffusion is strong enough that particle strength exchange would overshoot.
+                DiffuseOnGrid( GRID_DIFFUSION_VORTICITY , timeStep ) ;
+            }
+            else
+        #endif
+            {
+                DiffuseAndDissipateVorticityPSE( timeStep , uFrame , mVortonIndicesGrid ) ;
+            }
+        }
 
-#if VORTON_SIM_GATHER_STATS
-    mVorticityTermsStats.Reset( mVorticityTermsStats.mBaroclinic ) ;
-#endif
+        ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterDiffuse ) ;
+        break ;
 
-#if COMPUTE_PRESSURE_GRADIENT
-    if( mPhysicalObjects )
-    {
-        const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
-        ComputePressureGradient( mGridTemplate , mPressureGradientGrid , * mPhysicalObjects , vortonRadius ) ;
+    default:
+        FAIL() ;
+        break ;
     }
-#endif
+}
 
-    // Populate density grid.
-    //
-    // Passing mVortons to PopulateDensityAndMassFractionGrids assumes Particle and Vorton layout are identical.
-    // This is a weird, fragile use of inheritance but I desperately want to avoid virtual calls, while for
-    // pedagogic purposes I want to distinguish between a regular tracer particle and a vortex particle, and
-    // still treat arrays of those things uniformly, for economy of code.
 
-    ASSERT( sizeof( Particle ) == sizeof( Vorton ) ) ;
-    PopulateDensityAndMassFractionGrids( mDensityGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , uFrame ) ;
 
-    const size_t    numVortons      = mVortons->Size() ;
 
-    // Compute density gradient.
+#if ENABLE_VORTON_LOD
 
-#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
-    {
-        // Compute density gradient using SPH, then use that to compute baroclinic term.
-        // This uses an SPH scheme that computes gradients at the boundaries differently depending on whether particles touch a wall or just particle-free zones.
-        // Note that for this purpose it would be better to have a smaller inflRad.  1 is probably too small.  2 to 3.5 might be okay.  4 is probably too big.
+/// Fraction of budget below which ApplyVortonLevelOfDetail splits merged vortons.  Less than 1 so splitting does not immediately provoke merging.
+static const float sVortonLodSplitFraction = 0.75f ;
 
-    #if USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH
-        extern float influenceRadiusScale ; // Defined in smoothedPclHydro.cpp
-        const float pclRad  = ( * mVortons )[ 0 ].GetRadius() ;
-        const float inflRad = influenceRadiusScale * pclRad ;   // Make grid cell big enough to include all possible neighbors.
 
-        UniformGrid< VECTOR< unsigned > >   vortonIndicesGridSph  ;   ///< Spatial partition of indices into mVortons.
-        PartitionVortons( timeStep , uFrame , vortonIndicesGridSph , inflRad ) ;
-    #endif
 
-        (void) ugVortonIndices ; // SPH and VPM have different requirements on the spatial partition.  Might be okay to use SPH requirement for both, though that would be slower.
 
-        ComputeSphDensityAtParticles_Grid( mFluidDensitiesAtPcls , * mVortons , vortonIndicesGridSph ) ;
-        FluidBodySim::ComputeParticleProximityToWalls( mVortonBodyProximities , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , * mPhysicalObjects , inflRad ) ;
-        ComputeSphMassDensityGradient_Grid( mDensityGradientsAtPcls , mFluidDensitiesAtPcls , * mVortons , mVortonBodyProximities , vortonIndicesGridSph , mAmbientDensity ) ;
+/** Vorton eligible for merging or splitting, along with its priority.
+*/
+struct VortonLodCandidate
+{
+    size_t      mCell       ;   ///< Index of merge cell containing vorton.  Only vortons in the same cell merge.
+    float       mKey        ;   ///< Priority.  Candidates with lower keys merge or split first.
+    unsigned    mIdxVorton  ;   ///< Index, into mVortons, of vorton.
 
-    #if ENABLE_FLUID_BODY_SIMULATION
-        #if USE_TBB
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize =  Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
-            // Compute baroclinic generation of vorticity using threading building blocks
-            parallel_for( tbb::blocked_range<size_t>( 0 , numVortons , grainSize ) , VortonSim_GenerateBaroclinicVorticity_TBB( timeStep , this , & mDensityGradientsAtPcls ) ) ;
-        #else
-            GenerateBaroclinicVorticitySlice( timeStep , & mDensityGradientsAtPcls , 0 , numVortons ) ;
-        #endif
-    #endif
-    }
-#elif COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS // Older experiment -- did not work out.
+    bool operator<( const VortonLodCandidate & that ) const
     {
-        VECTOR< Vec3 > densityGradients ; // One density gradient per vorton.
-        ComputeDensityGradientFromVortons( densityGradients , ugVortonIndices , * mVortons ) ;
-
-    #if ENABLE_FLUID_BODY_SIMULATION
-        #if USE_TBB
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize =  Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
-            // Compute baroclinic generation of vorticity using threading building blocks
-            parallel_for( tbb::blocked_range<size_t>( 0 , numVortons , grainSize ) , VortonSim_GenerateBaroclinicVorticity_TBB( timeStep , this , densityGradients ) ) ;
-        #else
-            GenerateBaroclinicVorticitySlice( timeStep , & densityGradients , 0 , numVortons ) ;
-        #endif
-    #endif
+        return ( mCell < that.mCell ) || ( ( mCell == that.mCell ) && ( mKey < that.mKey ) ) ;
     }
-#else // Transfer density from vortons to grid and compute density gradient from grid.
-    #if POISON_DENSITY_BASED_ON_VORTONS_HITTING_WALLS
-        PoisonDensity( mDensityGrid , * mVortons ) ;
-    #endif
+} ;
 
-    #if POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
-        if( mPhysicalObjects )
-        {
-            const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
-            FluidBodySim::PoisonDensity( mDensityGrid , * mPhysicalObjects , vortonRadius ) ;
-        }
-    #endif
 
-        mDensityGradientGrid.Clear() ;                      // Clear any stale density gradient information
-        mDensityGradientGrid.CopyShape( mGridTemplate ) ;   // Use same shape as base velocity grid. (Note: could differ if you want.)
-        mDensityGradientGrid.Init() ;                       // Reserve memory for density gradient grid.
-    #if POISON_DENSITY_BASED_ON_VORTONS_HITTING_WALLS || POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS
-        // Compute density gradient using conditional difference.
-        ComputeGradientConditionally( mDensityGradientGrid , mDensityGrid ) ;
-    #else
-        // Compute density gradient using centered difference in interior and forward/backward difference on boundaries.
-        ComputeGradient( mDensityGradientGrid , mDensityGrid ) ;
-    #endif
 
-    #if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
-        PoisonDensityGradient( mDensityGradientGrid , * mVortons ) ;
-    #endif
 
-    #if POISON_DENSITY_GRADIENT_BASED_ON_RIGID_SPHERE_GEOMETRY
-        PoisonDensityGradient( mDensityGradientGrid , mDensityGrid , mAmbientDensity ) ;
-    #endif
+/** Pair of vortons to merge, along with the priority of merging them.
+*/
+struct VortonLodPair
+{
+    float       mKey        ;   ///< Priority.  Pairs with lower keys merge first.
+    unsigned    mIdxKeep    ;   ///< Index, into mVortons, of vorton that subsumes the other.
+    unsigned    mIdxGone    ;   ///< Index, into mVortons, of vorton that gets killed.
 
-    #if POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS
-        if( mPhysicalObjects )
-        {
-            const float vortonRadius = (*mVortons)[ 0 ].GetRadius() * 1.2f ;
-            FluidBodySim::PoisonDensityGradient( mDensityGradientGrid , * mPhysicalObjects , vortonRadius ) ;
-        }
-    #endif
+    bool operator<( const VortonLodPair & that ) const
+    {
+        return mKey < that.mKey ;
+    }
+} ;
 
-    #if ENABLE_FLUID_BODY_SIMULATION
-        #if USE_TBB
-            // Estimate grain size based on size of problem and number of processors.
-            const size_t grainSize =  Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
-            // Compute baroclinic generation of vorticity using threading building blocks
-            parallel_for( tbb::blocked_range<size_t>( 0 , numVortons , grainSize ) , VortonSim_GenerateBaroclinicVorticity_TBB( timeStep , this , NULL_PTR ) ) ;
-        #else
-            GenerateBaroclinicVorticitySlice( timeStep , 0 , numVortons ) ;
-        #endif
-    #endif
 
-#endif
 
 
-#if VORTON_SIM_GATHER_STATS
-    mVorticityTermsStats.mBaroclinic.ConvertAccumulatedSamplesToStats( numVortons ) ;
-#endif
-}
+/** Merge one vorton into another, preserving circulation and, where possible, linear impulse.
 
+    This uses the rule AggregateClusters uses to form clusters: vorticity adds,
+    and position is the average weighted by vorticity magnitude.  Both vortons
+    have the same volume, so adding vorticity conserves circulation.
 
+    Linear impulse is proportional to position^vorticity.  A single vorton can
+    match only the part of the pair's impulse perpendicular to the total
+    vorticity, and only from a line parallel to that vorticity.  This moves the
+    merged vorton to the point on that line nearest the weighted average, unless
+    that point lies farther from the average than the vortons lie from each other.
 
+    \note Like Particles::Merge, this leaves radius unchanged, since code
+            elsewhere assumes all vortons have the same radius.
 
-/** Spatially partition vortons.
+*/
+static void MergeVortonInto( Vorton & vortonKeep , const Vorton & vortonGone )
+{
+    const Vec3  vortKeep    = vortonKeep.GetVorticity() ;
+    const Vec3  vortGone    = vortonGone.GetVorticity() ;
+    const float magKeep     = vortKeep.Magnitude() ;
+    const float magGone     = vortGone.Magnitude() ;
+    const float magSum      = magKeep + magGone ;
+    const Vec3  vortSum     = vortKeep + vortGone ;
+    const float vortSumMag2 = vortSum.Mag2() ;
+
+    Vec3 position = ( magSum > 0.0f ) ? ( vortonKeep.mPosition * magKeep + vortonGone.mPosition * magGone ) / magSum
+                                      : ( vortonKeep.mPosition + vortonGone.mPosition ) * 0.5f ;
+
+    if( vortSumMag2 > FLT_EPSILON * magSum * magSum )
+    {   // Vorticities do not nearly cancel, so impulse-matching line is well defined.
+        const Vec3  impulse         = ( vortonKeep.mPosition ^ vortKeep ) + ( vortonGone.mPosition ^ vortGone ) ;
+        const Vec3  posOnLine       = ( vortSum ^ impulse ) / vortSumMag2 ;    // Point nearest origin where position^vortSum matches perpendicular part of impulse.
+        const Vec3  posNearest      = posOnLine + vortSum * ( ( ( position - posOnLine ) * vortSum ) / vortSumMag2 ) ;
+        const float separation2     = ( vortonKeep.mPosition - vortonGone.mPosition ).Mag2() ;
+        if( ( posNearest - position ).Mag2() <= separation2 )
+        {
+            position = posNearest ;
+        }
+    }
 
-    This routine partitions space into cells using the same grid geometry as the
-    "base vorton" grid, possibly modified to respect the given minCellSpacing.  Each
-    vorton gets assigned to the cell that contains it.
+    vortonKeep.mPosition    = position ;
+    vortonKeep.mVelocity    = ( vortonKeep.mVelocity + vortonGone.mVelocity ) * 0.5f ;
+    vortonKeep.mDensity     = ( vortonKeep.mDensity + vortonGone.mDensity ) * 0.5f ;
+    vortonKeep.mBirthTime   = Min2( vortonKeep.mBirthTime , vortonGone.mBirthTime ) ;
+    vortonKeep.SetVorticity( vortSum ) ;
+#if ENABLE_FIRE
+    vortonKeep.mFuelFraction    = ( vortonKeep.mFuelFraction  + vortonGone.mFuelFraction  ) * 0.5f ;
+    vortonKeep.mFlameFraction   = ( vortonKeep.mFlameFraction + vortonGone.mFlameFraction ) * 0.5f ;
+    vortonKeep.mSmokeFraction   = ( vortonKeep.mSmokeFraction + vortonGone.mSmokeFraction ) * 0.5f ;
+#endif
+#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
+    vortonKeep.mHitNormal   = vortonKeep.mHitBoundary ? vortonKeep.mHitNormal : vortonGone.mHitNormal ;
+    vortonKeep.mHitBoundary = vortonKeep.mHitBoundary || vortonGone.mHitBoundary ;
+#endif
 
-    \param timeStep     Amount of time by which to advance simulation.
+    ASSERT( ! IsNan( vortonKeep.mPosition        ) && ! IsInf( vortonKeep.mPosition        ) ) ;
+    ASSERT( ! IsNan( vortonKeep.mAngularVelocity ) && ! IsInf( vortonKeep.mAngularVelocity ) ) ;
+}
 
-    \param uFrame       Frame counter, used to generate diagnostic files.
 
-    \param ugVortonIndices - Uniform grid of vorton indices.  Assign each cell
-        to contain a vector of the indices of vortons that reside inside that cell.
-        The index values refer to elements in mVortons.
 
-    \see StretchAndTiltVortons, GenerateBaroclinicVorticity
 
-    \note This routine assumes mGridTemplate has already been established for this frame.
+/** Return distance from the given position to the nearest place that needs vorton detail.
+
+    Places that need detail include mLodFocus, when mLodDetailRadius is
+    positive, and the bounding sphere of each body that is not a hole.
+
+    \return Distance to nearest place that needs detail, or -1 when there is no such place.
 
 */
-void VortonSim::PartitionVortons( const float & /* timeStep */ , const unsigned & /* uFrame */ ,
-#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
-                                 SpatialPartition & vortonGrid
-#else
-                                 UniformGrid< VECTOR< unsigned > > & ugVortonIndices
-#endif
-                                 , float minCellSpacing )
+float VortonSim::ComputeLodDistance( const Vec3 & position ) const
 {
-#if ENABLE_FLUID_BODY_SIMULATION
+    float distMin = -1.0f ;
 
-    PERF_BLOCK( VortonSim__PartitionVortons ) ;
+    if( mLodDetailRadius > 0.0f )
+    {
+        distMin = ( position - mLodFocus ).Magnitude() ;
+    }
 
-#if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
-    //vortonGrid.Init( numVortons , mGridTemplate ) ;                 // Initialize spatial partition.
-#else
-    ugVortonIndices.Clear() ;                                       // Clear any stale index information.
-    ugVortonIndices.FitShape( mGridTemplate , minCellSpacing ) ;    // Use same shape as base vorticity grid.
-    //ugVortonIndices.Init() ;                                        // Reserve memory for grid and initialize all values to empty.
+#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS || POISON_DENSITY_BASED_ON_GRIDPOINTS_INSIDE_WALLS || POISON_DENSITY_GRADIENT_BASED_ON_GRIDPOINTS_INSIDE_WALLS || COMPUTE_PRESSURE_GRADIENT
+    if( mPhysicalObjects )
+    {
+        const size_t numPhysObjs = mPhysicalObjects->Size() ;
+        for( size_t idxPhysObj = 0 ; idxPhysObj < numPhysObjs ; ++ idxPhysObj )
+        {
+            const Impulsion::PhysicalObject &   physObj = * (*mPhysicalObjects)[ idxPhysObj ] ;
+            const Collision::ShapeBase *        shape   = physObj.GetCollisionShape() ;
+            if( ! shape->IsHole() && ( shape->GetBoundingSphereRadius() >= 0.0f ) )
+            {
+                const float distToBody = Max2( 0.0f , ( position - physObj.GetBody()->GetPosition() ).Magnitude() - shape->GetBoundingSphereRadius() ) ;
+                distMin = ( distMin < 0.0f ) ? distToBody : Min2( distMin , distToBody ) ;
+            }
+        }
+    }
 #endif
 
-    Particles::PartitionParticles( reinterpret_cast< const VECTOR< Particle > & >( *mVortons ) ,
-#   if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
-                            vortonGrid
-#   else
-                            ugVortonIndices
-#   endif
-                        , minCellSpacing ) ;
-
-#endif
+    return distMin ;
 }
 
 
 
 
-/** Exchange vorticity or merge vortons.
+/** Merge pairs of nearby vortons, preferring weak vortons far from places that need detail.
+
+    \param numToMerge   Desired number of merges.  Each merge removes one vorton.
+                        This merges each vorton at most once per call, so it
+                        can merge fewer, and takes subsequent calls to catch up.
+
+    This sorts vortons into cells about two vorton diameters wide, and pairs
+    the lowest-priority vortons within each cell.  Then it merges the pairs
+    with lowest priority overall.  Priority is vorticity magnitude, attenuated
+    by distance from places that need detail.  Vortons within mLodDetailRadius
+    of such places never merge.
+
+    \see MergeVortonInto, ComputeLodDistance
 
-    \return true if particle was kept, false if deleted
 */
-inline bool VortonSim::ExchangeVorticityOrMergeVortons( const unsigned & rVortIdxHere , Vorton & rVortonHere , Vec3 & rAngVelHere , const unsigned & ivThere , VECTOR< unsigned > & cell , const float & timeStep )
+void VortonSim::MergeVortonsOverBudget( size_t numToMerge )
 {
-#if ! ENABLE_MERGING_VORTONS
-    (void) rVortIdxHere , rVortonHere ; // Avoid "unreferenced formal parameter" warning.
-#endif
+    PERF_BLOCK( VortonSim__MergeVortonsOverBudget ) ;
 
-    ASSERT( rVortonHere.IsAlive() ) ;
-    const unsigned &    rVortIdxThere   = cell[ ivThere ] ;
-    Vorton &            rVortonThere    = (*mVortons)[ rVortIdxThere ] ;
-    const float         diffusionRange  = 4.0f * rVortonHere.mSize ;
-    const float         diffusionRange2 = POW2( diffusionRange ) ;
-    //if( rVortonThere.IsAlive() )
-    {   // Particle is alive.
-        const Vec3      separation      = rVortonHere.mPosition - rVortonThere.mPosition ;
-        const float     dist2           = separation.Mag2() ;
+    VECTOR< Vorton > &  vortons     = * mVortons ;
+    const size_t        numVortons  = vortons.Size() ;
+    const float         cellSize    = 2.0f * vortons[ 0 ].mSize ;
 
-    #if ENABLE_MERGING_VORTONS
-        const float     radiusSum       = ( rVortonHere.mSize + rVortonThere.mSize ) * 0.5f ; // 1/2 because size=2*radius
-        const float     radiusSum2      = Pow2( radiusSum ) ;
-        static float    mergeThreshold  = 0.25f ; // A value of 0.25 means the center of 1 vorton is just barely inside the core of another.
-        if( dist2 < radiusSum2 * mergeThreshold )
-        {   // Vortices are close enough to merge.
-            Particles::Merge( reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , rVortIdxHere , rVortIdxThere , mAmbientDensity ) ;
-            // Remove particle from cell.
-            ASSERT( ivThere < cell.Size() ) ;
-            cell[ ivThere ] = cell[ cell.Size() - 1 ] ;
-            cell.PopBack() ;
-            return false ;   // Tell caller a particle was deleted.
-        }
-        else
-    #endif
-        {   // Vortices are far enough to remain separate.
-            const float distLaw         = exp( - dist2 / diffusionRange2 ) ;
-            Vec3 &      rAngVelThere    = rVortonThere.mAngularVelocity ;
-            const Vec3  vortDiff        = rAngVelHere - rAngVelThere ;
-            const float exchangeFraction= Clamp( 2.0f * mViscosity * timeStep * distLaw , -0.5f , 0.5f ) ;    // Fraction of vorticity to exchange between particles.
-            ASSERT( fabsf( exchangeFraction ) < 0.5f ) ; // If this triggers, Clamp above triggered.
-            const Vec3  exchange        = exchangeFraction * vortDiff ;    // Amount of vorticity to exchange between particles.
-            ASSERT( ! IsNan( rAngVelHere  ) && ! IsInf( rAngVelHere ) ) ;
-            ASSERT( ! IsNan( rAngVelThere ) && ! IsInf( rAngVelThere ) ) ;
-            rAngVelHere  -= exchange ;   // Make "here" vorticity a little closer to "there".
-            rAngVelThere += exchange ;   // Make "there" vorticity a little closer to "here".
-            ASSERT( ! IsNan( rAngVelHere  ) && ! IsInf( rAngVelHere ) ) ;
-            ASSERT( ! IsNan( rAngVelThere ) && ! IsInf( rAngVelThere ) ) ;
+    Vec3 minCorner( vortons[ 0 ].mPosition ) ;
+    Vec3 maxCorner( vortons[ 0 ].mPosition ) ;
+    for( size_t iVorton = 1 ; iVorton < numVortons ; ++ iVorton )
+    {
+        const Vec3 & position = vortons[ iVorton ].mPosition ;
+        minCorner.x = Min2( minCorner.x , position.x ) ;   maxCorner.x = Max2( maxCorner.x , position.x ) ;
+        minCorner.y = Min2( minCorner.y , position.y ) ;   maxCorner.y = Max2( maxCorner.y , position.y ) ;
+        minCorner.z = Min2( minCorner.z , position.z ) ;   maxCorner.z = Max2( maxCorner.z , position.z ) ;
+    }
+    const size_t numCellsX  = size_t( ( maxCorner.x - minCorner.x ) / cellSize ) + 1 ;
+    const size_t numCellsXY = size_t( ( maxCorner.y - minCorner.y ) / cellSize ) * numCellsX + numCellsX ;
 
-        #if VORTON_SIM_GATHER_STATS
-            mVorticityTermsStats.mViscousDiffusion.Accumulate( exchange.Magnitude() ) ; // Note: This is not thread safe.
-        #endif
+    VECTOR< VortonLodCandidate > candidates ;
+    candidates.Reserve( numVortons ) ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {
+        const Vorton &  vorton  = vortons[ iVorton ] ;
+        const float     dist    = ComputeLodDistance( vorton.mPosition ) ;
+        if( ( dist >= 0.0f ) && ( dist < mLodDetailRadius ) )
+        {   // Vorton is near a place that needs detail.
+            continue ;
+        }
+        const float         vortMag     = vorton.GetVorticity().Magnitude() ;
+        const Vec3          posRel      = ( vorton.mPosition - minCorner ) / cellSize ;
+        VortonLodCandidate  candidate ;
+        candidate.mCell         = size_t( posRel.x ) + size_t( posRel.y ) * numCellsX + size_t( posRel.z ) * numCellsXY ;
+        candidate.mKey          = ( dist < 0.0f ) ? vortMag : vortMag / ( 1.0f + dist / cellSize ) ;
+        candidate.mIdxVorton    = static_cast< unsigned >( iVorton ) ;
+        candidates.PushBack( candidate ) ;
+    }
+    std::sort( candidates.begin() , candidates.end() ) ;
 
-            return true ;  // Tell caller particles were kept.
+    VECTOR< VortonLodPair > pairs ;
+    pairs.Reserve( candidates.Size() / 2 ) ;
+    for( size_t iCandidate = 0 ; iCandidate + 1 < candidates.Size() ; )
+    {
+        const VortonLodCandidate & candA = candidates[ iCandidate     ] ;
+        const VortonLodCandidate & candB = candidates[ iCandidate + 1 ] ;
+        if( candA.mCell == candB.mCell )
+        {   // Pair the two lowest-priority unpaired vortons in this cell.
+            VortonLodPair pair ;
+            pair.mKey       = candA.mKey + candB.mKey ;
+            pair.mIdxKeep   = candB.mIdxVorton ;
+            pair.mIdxGone   = candA.mIdxVorton ;
+            pairs.PushBack( pair ) ;
+            iCandidate += 2 ;
+        }
+        else
+        {   // candA is the only unpaired vorton left in its cell.
+            ++ iCandidate ;
         }
     }
-    //return true ;  // Tell caller particles were kept.
+
+    const size_t numMerges = Min2( numToMerge , pairs.Size() ) ;
+    std::partial_sort( pairs.begin() , pairs.begin() + numMerges , pairs.end() ) ;
+    for( size_t iPair = 0 ; iPair < numMerges ; ++ iPair )
+    {
+        MergeVortonInto( vortons[ pairs[ iPair ].mIdxKeep ] , vortons[ pairs[ iPair ].mIdxGone ] ) ;
+        vortons[ pairs[ iPair ].mIdxGone ].MarkDead() ;
+    }
+    Particles::KillParticlesMarkedForDeath( reinterpret_cast< VECTOR< Particle > & >( vortons ) ) ;
+
+    mNumVortonsMerged += numMerges ;
 }
 
 
 
 
-/** Diffuse vorticity using a particle strength exchange (PSE) method, for a slice of the domain.
+/** Split vortons in two, preferring vortons nearest places that need detail.
+
+    \param numToSplit   Number of vortons to split.  Each split adds one vorton.
+
+    Each half gets half the vorticity, and the halves straddle the original
+    position, offset perpendicular to vorticity.  That conserves circulation and
+    linear impulse exactly.
+
+    \see ComputeLodDistance
 
-    \see DiffuseAndDissipateVorticityPSE
 */
-void VortonSim::DiffuseAndDissipateVorticityPSESlice( const float & timeStep , UniformGrid< VECTOR< unsigned > > & ugVortonIndices , size_t izStart , size_t izEnd , PhaseE phase )
+void VortonSim::SplitVortonsUnderBudget( size_t numToSplit )
 {
-    if( ugVortonIndices.Empty() )
-    {   // No vortons.
-        return ;
+    PERF_BLOCK( VortonSim__SplitVortonsUnderBudget ) ;
+
+    VECTOR< Vorton > &  vortons     = * mVortons ;
+    const size_t        numVortons  = vortons.Size() ;
+
+    VECTOR< VortonLodCandidate > candidates ;
+    candidates.Reserve( numVortons ) ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {
+        const Vorton &  vorton  = vortons[ iVorton ] ;
+        const float     vortMag = vorton.GetVorticity().Magnitude() ;
+        if( vortMag > 0.0f )
+        {   // Splitting a vorton without vorticity would gain nothing.
+            const float         dist        = ComputeLodDistance( vorton.mPosition ) ;
+            VortonLodCandidate  candidate ;
+            candidate.mCell         = 0 ;
+            candidate.mKey          = ( dist < 0.0f ) ? - vortMag : dist ;
+            candidate.mIdxVorton    = static_cast< unsigned >( iVorton ) ;
+            candidates.PushBack( candidate ) ;
+        }
     }
 
-    ASSERT( mViscosity * timeStep <= 1.0f ) ; // ...otherwise dissipation will cause vorticity to flip direction.
+    const size_t numSplits = Min2( numToSplit , candidates.Size() ) ;
+    std::partial_sort( candidates.begin() , candidates.begin() + numSplits , candidates.end() ) ;
+    vortons.Reserve( numVortons + numSplits ) ;
+    for( size_t iCandidate = 0 ; iCandidate < numSplits ; ++ iCandidate )
+    {
+        Vorton &    vorton  = vortons[ candidates[ iCandidate ].mIdxVorton ] ;
+        const Vec3  vort    = vorton.GetVorticity() ;
+        const Vec3  axis    = ( ( fabsf( vort.x ) <= fabsf( vort.y ) ) && ( fabsf( vort.x ) <= fabsf( vort.z ) ) ) ? Vec3( 1.0f , 0.0f , 0.0f )
+                            : ( ( fabsf( vort.y ) <= fabsf( vort.z ) ) ? Vec3( 0.0f , 1.0f , 0.0f ) : Vec3( 0.0f , 0.0f , 1.0f ) ) ;
+        const Vec3  offset  = ( vort ^ axis ).GetDir() * ( 0.25f * vorton.mSize ) ;
+
+        vorton.SetVorticity( vort * 0.5f ) ;
+        Vorton sibling( vorton ) ;
+        vorton.mPosition  += offset ;
+        sibling.mPosition -= offset ;
+        vortons.PushBack( sibling ) ;
+    }
 
-    const float viscousVorticityDissipationFactor = mViscosity * timeStep ;
+    mNumVortonsMerged -= Min2( mNumVortonsMerged , numSplits ) ;
+}
 
-    // Exchange vorticity with nearest neighbors
 
-    const size_t   & nx     = ugVortonIndices.GetNumPoints( 0 ) ;
-    const size_t     nxm1   = nx - 1 ;
-    const size_t   & ny     = ugVortonIndices.GetNumPoints( 1 ) ;
-    const size_t     nym1   = ny - 1 ;
-    const size_t     nxy    = nx * ny ;
 
-    // Set up increment and offset for alternating odd-even access.
-    const size_t    zInc    =  PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t    flipper = ( PHASE_ODD == phase ) ? 1 : 0 ;
-    const size_t    izShift = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
 
-    DEBUG_ONLY( const size_t   & nz     = ugVortonIndices.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t     nzm1   = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
+/** Merge or split vortons to keep their number under budget.
 
-    // Note that the cell-neighborhood loop visits only some of the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const size_t neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-      //, -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-        ,  1 + nx       // + , + , 0 ( 4)
-      //, -1 - nx + nxy // - , - , + ( 5)
-      //,    - nx + nxy // 0 , - , + ( 6)
-      //,  1 - nx + nxy // + , - , + ( 7)
-      //, -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-        ,  1      + nxy // + , 0 , + (10)
-      //, -1 + nx + nxy // - , 0 , + (11)
-        ,      nx + nxy // 0 , + , + (12)
-        ,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
+    The budget is mVortonBudget or, when mVelocityStageDurationTarget is
+    positive, the number of vortons the velocity stage could have processed in
+    that duration, given how long it took during the previous update, whichever
+    is less.
 
-    size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
-    {   // For all grid cells along z...
-        const size_t offsetZ0 = idx[2] * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
-        {   // For all grid cells along y...
-            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
-            {   // For all grid cells along x...
-                const size_t offsetX0Y0Z0 = idx[0]     + offsetY0Z0 ;
-                const size_t numInCurrentCell = ugVortonIndices[ offsetX0Y0Z0 ].Size() ;
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
-                {   // For each vorton in this gridcell...
-                    const unsigned &    rVortIdxHere    = ugVortonIndices[ offsetX0Y0Z0 ][ ivHere ] ;
-                    Vorton &            rVortonHere     = (*mVortons)[ rVortIdxHere ] ;
-                    // Note: This algorithm assumes calls to ExchangeVorticityOrMergeVortons never
-                    // delete rVortonHere.
-                    if( rVortonHere.IsAlive() )
-                    {
-                        Vec3 &              rAngVelHere     = rVortonHere.mAngularVelocity ;
+    When the number of vortons exceeds the budget, this merges the excess.  When
+    the number falls well under the budget, this splits vortons it previously
+    merged, so detail returns near mLodFocus and bodies.
 
-                        // Diffuse vorticity with other vortons in same cell.
-                        // Notice that the loop only visits vortons with indices
-                        // following the "here" vorton.  That is because each
-                        // visitation symmetrically modifies both vortons in the
-                        // pair.  If "here" and "there" is visited, then "there" and
-                        // "here" should not also be visited, because it would be
-                        // redundant.
-                        for( unsigned ivThere = ivHere + 1 ; ivThere < ugVortonIndices[ offsetX0Y0Z0 ].Size() ; /* Conditionally increment in body. */ )
-                        {   // For each OTHER vorton within this same cell...
-                            if( ExchangeVorticityOrMergeVortons( rVortIdxHere , rVortonHere , rAngVelHere , ivThere , ugVortonIndices[ offsetX0Y0Z0 ] , timeStep ) )
-                            {   // Both particles remain.
-                                ++ ivThere ;
-                            }
-                        }
+    \note This reads mUpdateStageDurations from the previous update, so the
+            caller must call this before resetting those durations.
 
-                        // Diffuse vorticity with other vortons in adjacent cells.
-                        for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                        {   // For each cell in neighborhood...
-                            const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of adjacent cell
-                            VECTOR< unsigned > & cell = ugVortonIndices[ cellOffset ] ;
-                            for( unsigned ivThere = 0 ; ivThere < cell.Size() ; /* Conditionally increment in body. */ )
-                            {   // For each vorton in the visited cell...
-                                if( ExchangeVorticityOrMergeVortons( rVortIdxHere , rVortonHere , rAngVelHere , ivThere , cell , timeStep ) )
-                                {   // Both particles remain.
-                                    ++ ivThere ;
-                                }
-                            }
-                        }
+    \see MergeVortonsOverBudget, SplitVortonsUnderBudget
 
-                        // Dissipate vorticity.  See notes in header comment for DiffuseAndDissipateVorticityPSE,
-                        // related to dissipation at Kolmogorov scales.  Technically, that should
-                        // get converted into heat, but the amounts are usually negligible.
-                        // This also simulates diffusing vorticity into regions of fluid that
-                        // have no vortons.  A more accurate approach would involve creating vortons
-                        // in those regions, so that vorticity could be tracked better, but that would
-                        // dramatically slow the simulation, yielding results qualitatively similar to
-                        // what this formula does.
-                        rAngVelHere  -= viscousVorticityDissipationFactor * rAngVelHere ;   // Reduce vorticity here.
-                    }
-                }
-            }
-        }
+*/
+void VortonSim::ApplyVortonLevelOfDetail()
+{
+    PERF_BLOCK( VortonSim__ApplyVortonLevelOfDetail ) ;
+
+    if( mVortons->Empty() )
+    {
+        return ;
     }
-}
 
+    const size_t    numVortons          = mVortons->Size() ;
+    const float &   velocityDuration    = mUpdateStageDurations[ UPDATE_STAGE_VELOCITY ] ;
+    size_t          budget              = mVortonBudget ;
+    if( ( mVelocityStageDurationTarget > 0.0f ) && ( velocityDuration > 0.0f ) )
+    {   // Velocity-from-vorticity cost grows roughly in proportion to the number of vortons.
+        const size_t budgetFromDuration = Max2( size_t( float( numVortons ) * mVelocityStageDurationTarget / velocityDuration ) , size_t( 1 ) ) ;
+        budget = ( 0 == budget ) ? budgetFromDuration : Min2( budget , budgetFromDuration ) ;
+    }
 
+    if( 0 == budget )
+    {   // Budget is unlimited.
+        return ;
+    }
 
+    const size_t numVortonsLowWater = size_t( float( budget ) * sVortonLodSplitFraction ) ;
+    if( numVortons > budget )
+    {
+        MergeVortonsOverBudget( numVortons - budget ) ;
+    }
+    else if( ( numVortons < numVortonsLowWater ) && ( mNumVortonsMerged > 0 ) )
+    {
+        SplitVortonsUnderBudget( Min2( mNumVortonsMerged , numVortonsLowWater - numVortons ) ) ;
+    }
+}
 
-/** Diffuse vorticity using a particle strength exchange (PSE) method.
+#endif
 
-    Each vorton exchanges some of its vorticity with its neighbors in its own
-    and adjacent cells.
 
-    This routine makes some simplifying assumptions to speed execution:
 
-        -   Only vortons within a certain region of each other exchange
-            vorticity.
 
-        -   This simulation reduces the vorticity of each vorton, alleging that
-            this vorticity is dissipated analogously to how energy dissipates at
-            Kolmogorov microscales.  This treatment is not realistic but it
-            retains qualitative characteristics that we want, e.g. that the flow
-            dissipates at a rate related to viscosity. Dissipation in real flows
-            is a more complicated phenomenon.
+#if ENABLE_VORTON_REMESHING
 
-    Theoretically, if an adjacent cell contains no vortons then this simulation
-    should generate vorticity within that cell, e.g. by creating a new vorton in
-    the adjacent cell.  But this diffusion implementation does not create new
-    vortons.
+/** Ratio of remeshing lattice spacing to vorton radius.
 
-    \see    Degond & Mas-Gallic (1989): The weighted particle method for
-            convection-diffusion equations, part 1: the case of anisotropic viscosity.
-            Math. Comput., v. 53, n. 188, pp. 485-507, October.
+    This matches how AssignVorticity seeds vortons: Their radius is 32^(-1/6)
+    times lattice spacing, so each vorton has the volume of a closest-packed
+    sphere, and remeshed vortons overlap their neighbors as much as seeded
+    vortons do.
+*/
+static const float sRemeshSpacingPerVortonRadius = 1.7817974f ; // 32^(1/6)
 
-    \param timeStep     Amount of time by which to advance simulation.
+/// Largest number of lattice points per vorton for which RemeshVortons proceeds.  Beyond that, vortons are too scattered for a lattice spanning them all to be worthwhile.
+static const size_t sRemeshMaxLatticePointsPerVorton = 512 ;
 
-    \param uFrame       Frame counter, used to generate diagnostic files.
 
-    \param ugVortonIndices - UniformGrid of Vorton indices.  \see ParititionVortons.
 
-    \see StretchAndTiltVortons, GenerateBaroclinicVorticity, DiffuseAndDissipateHeatPSE
 
+/** Return weight of M4' interpolation kernel at the given displacement, in units of lattice spacing.
+
+    M4' (Monaghan 1985) spans 2 lattice spacings on each side, interpolates
+    (i.e. has weight 1 at zero and 0 at other lattice points), and reproduces
+    polynomials up to degree 2, so remeshing with it conserves circulation
+    and linear and angular impulse.  Its weight is negative for displacements
+    between 1 and 2.
 */
-void VortonSim::DiffuseAndDissipateVorticityPSE( const float & timeStep , const unsigned & /* uFrame */ , UniformGrid< VECTOR< unsigned > > & ugVortonIndices )
+static inline float M4PrimeWeight( float displacement )
 {
-#if ENABLE_FLUID_BODY_SIMULATION
-    PERF_BLOCK( VortonSim__DiffuseAndDissipateVorticityPSE ) ;
+    const float x = fabsf( displacement ) ;
+    if( x < 1.0f )
+    {
+        return 1.0f - 2.5f * x * x + 1.5f * x * x * x ;
+    }
+    else if( x < 2.0f )
+    {
+        return 0.5f * Pow2( 2.0f - x ) * ( 1.0f - x ) ;
+    }
+    return 0.0f ;
+}
 
-#if defined( _DEBUG )
-    const Vec3  totalVorticityBefore     = Vorton::ComputeTotalVorticity( * mVortons ) ; // TODO: Note that TallyDiagnosticIntegrals effectively gathers this info.  Consolidate?
-    const float totalKineticEnergyBefore = Vorton::ComputeTotalKineticEnergy( * mVortons ) ;
-#endif
 
-#if VORTON_SIM_GATHER_STATS
-    mVorticityTermsStats.Reset( mVorticityTermsStats.mViscousDiffusion ) ;
-#endif
 
-    // Exchange vorticity with nearest neighbors
 
-    const unsigned & nz     = ugVortonIndices.GetNumPoints( 2 ) ;
-    const unsigned   nzm1   = nz - 1 ;
+/** Remesh vortons onto a subset of z slices of lattice points.
 
-#   if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
-        // Compute vorticity diffusion using threading building blocks.
-        // Alternate between even and odd z-slices to avoid multiple threads accessing the same vortons simultaneously.
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , VortonSim_DiffuseVorticityPSE_TBB( timeStep , this , ugVortonIndices , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , VortonSim_DiffuseVorticityPSE_TBB( timeStep , this , ugVortonIndices , VortonSim::PHASE_ODD  ) ) ;
-#   else
-        DiffuseAndDissipateVorticityPSESlice( timeStep , ugVortonIndices , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
-#   endif
+    \param lattice              Lattice onto which to remesh.
 
-#   if defined( _DEBUG )
-    {   // In principle, diffusion should not change bulk vorticity or kinetic energy. But note that 
-        static float totalVorticityChangeMagMax     = 0.0f ;
-        static float totalVorticityChangeMagRelMax  = 0.0f ;
-        static float totalKineticEnergyChangeMax    = 0.0f ;
-        static float totalKineticEnergyChangeRelMax = 0.0f ;
-        TrackVorticityAndKineticEnergyChange( * mVortons , totalVorticityBefore , totalKineticEnergyBefore , totalVorticityChangeMagMax , totalVorticityChangeMagRelMax , totalKineticEnergyChangeMax , totalKineticEnergyChangeRelMax ) ;
-    }
-#   endif
+    \param vortonIndicesGrid    Spatial partition of vortons, whose cells are at least one lattice spacing wide.
 
-#if VORTON_SIM_GATHER_STATS
-    mVorticityTermsStats.mViscousDiffusion.ConvertAccumulatedSamplesToStats( mVortons->Size() ) ;
-#endif
+    \param izStart              Index, relative to the minimal lattice slice, of first slice to populate.
 
-#endif
-}
+    \param izEnd                One past index of last slice to populate.
 
+    Each lattice point gathers from vortons within the kernel support, so
+    slices can run concurrently.  Each slice writes its vortons into its own
+    element of mRemeshedVortonSlices.
 
+    Angular velocity accumulates with M4' weights, which conserves
+    circulation.  Intensive properties (density, mass fractions and velocity)
+    become weighted averages using only positive weights, since negative
+    weights could push an average outside the range of the vortons that
+    contribute, e.g. make density negative.  Birth time becomes that of the
+    oldest contributing vorton, as when vortons merge.
+*/
+void VortonSim::RemeshVortons_Slice( const RemeshLattice & lattice , const CellList & vortonIndicesGrid , size_t izStart , size_t izEnd )
+{
+    const VECTOR< Vorton > &    vortons         = * mVortons ;
+    const float                 oneOverSpacing  = 1.0f / lattice.mSpacing ;
+    const float *               flatPosition    = reinterpret_cast< const float * >( & lattice.mFlatPosition ) ;
+    const float *               cellListMin     = reinterpret_cast< const float * >( & vortonIndicesGrid.GetMinCorner() ) ;
+    const float *               cellsPerExtent  = reinterpret_cast< const float * >( & vortonIndicesGrid.GetCellsPerExtent() ) ;
+    int                         numCells[ 3 ]   ;
+    int                         reach[ 3 ]      ;   // Number of vorton cells, along each axis, within kernel support of any point in a cell.
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        numCells[ axis ]    = int( vortonIndicesGrid.GetNumPoints( axis ) ) ;
+        reach[ axis ]       = int( ceilf( 2.0f * lattice.mSpacing * cellsPerExtent[ axis ] ) ) ;
+    }
 
+    unsigned idx[ 3 ] ;
+    for( idx[2] = static_cast< unsigned >( izStart ) ; idx[2] < izEnd ; ++ idx[2] )
+    {   // For subset of lattice slices...
+        VECTOR< Vorton > & sliceVortons = mRemeshedVortonSlices[ idx[2] ] ;
+        sliceVortons.Clear() ;
+        for( idx[1] = 0 ; idx[1] < lattice.mNumPoints[ 1 ] ; ++ idx[1] )
+        {   // For every lattice point along the y-axis...
+            for( idx[0] = 0 ; idx[0] < lattice.mNumPoints[ 0 ] ; ++ idx[0] )
+            {   // For every lattice point along the x-axis...
+                float   position[ 3 ] ;
+                int     cellBegin[ 3 ] , cellEnd[ 3 ] ;
+                for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                {   // For each axis, find position of lattice point, and range of vorton cells within kernel support of it.
+                    if( lattice.mFlat[ axis ] )
+                    {   // Every vorton lies at the same coordinate along this axis.
+                        position[ axis ]    = flatPosition[ axis ] ;
+                        cellBegin[ axis ]   = 0 ;
+                        cellEnd[ axis ]     = numCells[ axis ] ;
+                    }
+                    else
+                    {   // Lattice can extend beyond vorton partition, so clamp, and let kernel weights reject vortons that clamping brings in.
+                        position[ axis ]    = float( lattice.mMinIndices[ axis ] + int( idx[ axis ] ) ) * lattice.mSpacing ;
+                        const int idxCell   = int( floorf( ( position[ axis ] - cellListMin[ axis ] ) * cellsPerExtent[ axis ] ) ) ;
+                        cellBegin[ axis ]   = Max2( idxCell - reach[ axis ] , 0 ) ;
+                        cellEnd[ axis ]     = Min2( idxCell + reach[ axis ] + 1 , numCells[ axis ] ) ;
+                    }
+                }
 
-/** Exchange heat between 2 vortons.
+                Vec3    angVel          ( 0.0f , 0.0f , 0.0f ) ;
+                Vec3    velocitySum     ( 0.0f , 0.0f , 0.0f ) ;
+                float   weightSum       = 0.0f ;
+                float   densitySum      = 0.0f ;
+            #if ENABLE_FIRE
+                float   fuelSum         = 0.0f ;
+                float   flameSum        = 0.0f ;
+                float   smokeSum        = 0.0f ;
+            #endif
+                int     birthTime       = std::numeric_limits< int >::max() ;
+                for( int iz = cellBegin[ 2 ] ; iz < cellEnd[ 2 ] ; ++ iz )
+                for( int iy = cellBegin[ 1 ] ; iy < cellEnd[ 1 ] ; ++ iy )
+                for( int ix = cellBegin[ 0 ] ; ix < cellEnd[ 0 ] ; ++ ix )
+                {   // For each vorton cell within kernel support...
+                    const CellList::Cell    cell                = vortonIndicesGrid.Get( ix , iy , iz ) ;
+                    const size_t            numVortonsInCell    = cell.Size() ;
+                    for( size_t ivHere = 0 ; ivHere < numVortonsInCell ; ++ ivHere )
+                    {   // For each vorton in this cell...
+                        const Vorton &  rVorton         = vortons[ cell[ ivHere ] ] ;
+                        const float *   vortonPosition  = reinterpret_cast< const float * >( & rVorton.mPosition ) ;
+                        float           weight          = 1.0f ;
+                        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+                        {   // For each axis that has extent, apply 1D kernel weight.
+                            if( ! lattice.mFlat[ axis ] )
+                            {
+                                weight *= M4PrimeWeight( ( vortonPosition[ axis ] - position[ axis ] ) * oneOverSpacing ) ;
+                            }
+                        }
+                        angVel += rVorton.mAngularVelocity * weight ;
+                        if( weight > 0.0f )
+                        {   // Vorton contributes to intensive properties.
+                            const float massWeight = weight * rVorton.mDensity ;
+                            weightSum   += weight ;
+                            densitySum  += massWeight ;
+                            velocitySum += rVorton.mVelocity * weight ;
+                        #if ENABLE_FIRE
+                            fuelSum     += massWeight * rVorton.mFuelFraction ;
+                            flameSum    += massWeight * rVorton.mFlameFraction ;
+                            smokeSum    += massWeight * rVorton.mSmokeFraction ;
+                        #endif
+                            birthTime   = Min2( birthTime , rVorton.mBirthTime ) ;
+                        }
+                    }
+                }
 
-    \param rVortIdxHere Index within mVortons of vorton at "here" location.
+                if( ( weightSum <= 0.0f ) || ( angVel.Mag2() < lattice.mMinAngVelMag2 ) )
+                {   // Lattice point has negligible vorticity.
+                    continue ;
+                }
 
-    \param rVortonHere  Reference to mVortons[ rVortIdxHere ]
+                Vorton vorton ;
+                vorton.mPosition        = Vec3( position[ 0 ] , position[ 1 ] , position[ 2 ] ) ;
+                vorton.mAngularVelocity = angVel ;
+                vorton.mVelocity        = velocitySum / weightSum ;
+                vorton.mDensity         = densitySum / weightSum ;
+                vorton.mBirthTime       = birthTime ;
+                vorton.SetRadius( lattice.mVortonRadius ) ;
+            #if ENABLE_FIRE
+                const float oneOverMass = 1.0f / densitySum ;
+                vorton.mFuelFraction    = fuelSum  * oneOverMass ;
+                vorton.mFlameFraction   = flameSum * oneOverMass ;
+                vorton.mSmokeFraction   = smokeSum * oneOverMass ;
+            #endif
+                sliceVortons.PushBack( vorton ) ;
+            }
+        }
+    }
+}
 
-    \param rDensityHere Reference to mVortons[ rVortIdxHere ].mDensity
 
-    \param ivThere      Index within mVortons of vorton at "there" location.
 
-    \param cell         Reference to cell containing "here" vorton.
 
-    \param timeStep     Amount of virtual time by which to advance simulation.
+/** Redistribute vortons onto a regular lattice.
 
-    This routine uses the particle strength exchange method to evolve temperature, T,
-    according to the heat diffusion equation:
+    This replaces all vortons with vortons at lattice points within kernel
+    support of the original vortons, except lattice points whose vorticity
+    falls below mRemeshVorticityThreshold times that of the strongest
+    original vorton.  Lattice points lie at integer multiples of the lattice
+    spacing, so successive remeshes use the same lattice, and vortons that
+    barely moved since the previous remesh return to the same points.
 
-        DT/Dt = kappa laplacian T
+    Along any axis where all vortons share one coordinate (e.g. in a 2D
+    simulation), the lattice has a single point, at that coordinate.
 
-    where D/Dt represents the convective derivative (where t is time),
-    kappa represents thermal diffusivity of the fluid and "laplacian"
-    is the laplacian differential operator (del^2, a.k.a. nabla^2).
+    This leaves vortons unchanged when none has vorticity, when remeshing
+    would leave no vortons, or when vortons are too scattered for a lattice
+    spanning them all to be worthwhile.
 
-    \note   Under the Boussinesq approximation,
+    \see ENABLE_VORTON_REMESHING, RemeshVortons_Slice.
 
-                    density = ambientDensity * ( 1 - thermalExpansionCoefficient * ( temperature - ambientTemperature ) )
-                --> temperature = density / ( ambientDensity * ( 1 - thermalExpansionCoefficient ) ) + ambientTemperature
+    \note This replaces vortons, so it invalidates indices into mVortons,
+            including those in mVortonIndicesGrid.  Call it before any
+            operation that partitions vortons for the current update.
+*/
+void VortonSim::RemeshVortons()
+{
+    PERF_BLOCK( VortonSim__RemeshVortons ) ;
 
-            If the thermalExpansionCoefficient is constant with respect to density then
-            density and temperature are linearly related (but with opposite sign).
+    VECTOR< Vorton > &  vortons     = * mVortons ;
+    const size_t        numVortons  = vortons.Size() ;
+    if( 0 == numVortons )
+    {   // No vortons to remesh.
+        return ;
+    }
 
-            For an ideal gas, thermalExpansionCoefficient=1/temperature so the above formula becomes
+    // Find extent of vortons, and strongest vorticity.
+    Vec3    minCorner( vortons[ 0 ].mPosition ) ;
+    Vec3    maxCorner( vortons[ 0 ].mPosition ) ;
+    float   maxAngVelMag2 = 0.0f ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton...
+        const Vec3 & position = vortons[ iVorton ].mPosition ;
+        minCorner.x = Min2( minCorner.x , position.x ) ;   maxCorner.x = Max2( maxCorner.x , position.x ) ;
+        minCorner.y = Min2( minCorner.y , position.y ) ;   maxCorner.y = Max2( maxCorner.y , position.y ) ;
+        minCorner.z = Min2( minCorner.z , position.z ) ;   maxCorner.z = Max2( maxCorner.z , position.z ) ;
+        maxAngVelMag2 = Max2( maxAngVelMag2 , vortons[ iVorton ].mAngularVelocity.Mag2() ) ;
+    }
+    if( 0.0f == maxAngVelMag2 )
+    {   // Vortons have no vorticity, so every lattice point would be negligible.
+        return ;
+    }
 
-                density = ambientDensity * ambientTemperature / temperature
-                --> temperature = ambientTemperature * ambientDensity / density
+    RemeshLattice lattice ;
+    lattice.mVortonRadius   = vortons[ 0 ].GetRadius() ;   // Code elsewhere assumes all vortons have the same radius.
+    lattice.mSpacing        = lattice.mVortonRadius * sRemeshSpacingPerVortonRadius ;
+    lattice.mMinAngVelMag2  = maxAngVelMag2 * Pow2( mRemeshVorticityThreshold ) ;
+    lattice.mFlatPosition   = minCorner ;
+    const float *   minCoords           = reinterpret_cast< const float * >( & minCorner ) ;
+    const float *   maxCoords           = reinterpret_cast< const float * >( & maxCorner ) ;
+    double          numLatticePoints    = 1.0 ; // Double, since lattices spanning scattered vortons can have more points than size_t can count.
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis, find range of lattice points within kernel support of any vorton.
+        lattice.mFlat[ axis ] = ( minCoords[ axis ] == maxCoords[ axis ] ) ;
+        if( lattice.mFlat[ axis ] )
+        {
+            lattice.mMinIndices[ axis ] = 0 ;
+            lattice.mNumPoints[ axis ]  = 1 ;
+        }
+        else
+        {   // Lattice point i gets weight from vortons within 2 lattice spacings of i times spacing.
+            const double    idxMin  = floor( double( minCoords[ axis ] ) / double( lattice.mSpacing ) ) - 1.0 ;
+            const double    idxMax  = floor( double( maxCoords[ axis ] ) / double( lattice.mSpacing ) ) + 2.0 ;
+            numLatticePoints *= idxMax - idxMin + 1.0 ;
+            if( numLatticePoints > double( sRemeshMaxLatticePointsPerVorton ) * double( numVortons ) )
+            {   // Vortons are too scattered for a lattice spanning them all to be worthwhile.
+                return ;
+            }
+            lattice.mMinIndices[ axis ] = int( idxMin ) ;
+            lattice.mNumPoints[ axis ]  = unsigned( idxMax - idxMin + 1.0 ) ;
+        }
+    }
 
-            In this case, density and temperature are inversely proportional.
+    // Partition vortons into cells at least one lattice spacing wide, so each lattice point visits few cells.
+    // The partition stage of this update repartitions the remeshed vortons.
+    mVortonIndicesGrid.Partition( vortons , mGridTemplate , lattice.mSpacing ) ;
 
-            Either way, as temperature increases, density decreases.
-*/
-inline void VortonSim::ExchangeHeat( const unsigned & /* rVortIdxHere */ , Vorton & rVortonHere , float & rDensityHere , const unsigned & ivThere , const VECTOR< unsigned > & cell , const float & timeStep )
-{
-    const unsigned &    rVortIdxThere   = cell[ ivThere ] ;
-    Vorton &            rVortonThere    = (*mVortons)[ rVortIdxThere ] ;
-    const float         diffusionRange  = 4.0f * rVortonHere.mSize ;
-    const float         diffusionRange2 = POW2( diffusionRange ) ;
-    ASSERT( rVortonThere.IsAlive() ) ;
-    //if( rVortonThere.IsAlive() )
-    {   // Particle is alive.
-        const Vec3  separation          = rVortonHere.mPosition - rVortonThere.mPosition ;
-        const float dist2               = separation.Mag2() ;
-        const float distLaw             = exp( - dist2 / diffusionRange2 ) ;
-        const float exchangeRatio       = Clamp( 2.0f * mThermalDiffusivity * timeStep * distLaw , -0.5f , 0.5f ) ; // Portion of heat to exchange between particles.
-        float &     rDensityThere       = rVortonThere.mDensity ;
-        const float densityDiff         = rDensityHere - rDensityThere ;
-        const float exchange            = exchangeRatio * densityDiff ; // Amount of heat to exchange between particles.
-        rDensityHere  -=   exchange ;   // Make "here"  temperature a little closer to "there".
-        rDensityThere +=   exchange ;   // Make "there" temperature a little closer to "here".
-        ASSERT( rVortonHere .GetMass() >= 0.0f ) ;
-        ASSERT( rVortonThere.GetMass() >= 0.0f ) ;
+    const size_t numSlices = lattice.mNumPoints[ 2 ] ;
+    mRemeshedVortonSlices.Resize( numSlices ) ;
+    // Compute remeshed vortons using multiple threads.
+    Parallel::For( 0 , numSlices , Parallel::GetGrainSize( numSlices ) , Parallel::Method( this , & VortonSim::RemeshVortons_Slice , lattice , mVortonIndicesGrid ) ) ;
+
+    size_t numRemeshed = 0 ;
+    for( size_t iSlice = 0 ; iSlice < numSlices ; ++ iSlice )
+    {   // For each lattice slice...
+        numRemeshed += mRemeshedVortonSlices[ iSlice ].Size() ;
     }
+    if( 0 == numRemeshed )
+    {   // Every lattice point was negligible.  Keep original vortons rather than lose all vorticity.
+        return ;
+    }
+
+    // Replace original vortons with remeshed vortons, in slice order, so the result does not depend on thread timing.
+    vortons.Clear() ;
+    vortons.Reserve( numRemeshed ) ;
+    for( size_t iSlice = 0 ; iSlice < numSlices ; ++ iSlice )
+    {   // For each lattice slice...
+        const VECTOR< Vorton > & sliceVortons = mRemeshedVortonSlices[ iSlice ] ;
+        for( size_t iVorton = 0 ; iVorton < sliceVortons.Size() ; ++ iVorton )
+        {   // For each vorton remeshed into this slice...
+            vortons.PushBack( sliceVortons[ iVorton ] ) ;
+        }
+    }
+
+#if ENABLE_VORTON_LOD
+    mNumVortonsMerged = 0 ; // Remeshing redistributed merged vortons, so no merge remains for splitting to undo.
+#endif
 }
 
+#endif
 
 
 
-/** Diffuse heat using a particle strength exchange (PSE) method, for a slice of the domain
 
-    \see DiffuseAndDissipateVorticityPSE, DiffuseAndDissipateHeatPSE, PartitionVortons
-*/
-void VortonSim::DiffuseAndDissipateHeatPSESlice( const float & timeStep , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices , size_t izStart , size_t izEnd , PhaseE phase )
-{
-    if( ugVortonIndices.Empty() )
-    {   // No vortons.
-        return ;
-    }
+#if ENABLE_VORTON_SIM_SLEEP
 
-    ASSERT( mThermalDiffusivity * timeStep <= 1.0f ) ; // ...otherwise dissipation will cause temperature to flip sign.
+/** Decide whether the simulation is asleep, and therefore whether this update should skip simulating.
 
-    const float thermalDissipationGain = Clamp( mThermalDiffusivity * timeStep , -0.5f , 0.5f ) ;
+    The simulation falls asleep once every vorton has had vorticity and
+    speed no greater than the sleep thresholds for
+    mNumQuiescentUpdatesBeforeSleep consecutive updates.
 
-    // Exchange heat with nearest neighbors
+    While asleep, vortons hold still and keep their vorticity, so any
+    vorton exceeding a threshold means something else stirred the fluid, for
+    example a body colliding with it, or wind.  That, or a change in the
+    number of vortons, for example due to emission, wakes the simulation.
 
-    const size_t   & nx     = ugVortonIndices.GetNumPoints( 0 ) ;
-    const size_t     nxm1   = nx - 1 ;
-    const size_t   & ny     = ugVortonIndices.GetNumPoints( 1 ) ;
-    const size_t     nym1   = ny - 1 ;
-    const size_t     nxy    = nx * ny ;
+    \return Whether the simulation is asleep, in which case Update should skip simulating.
 
-    // Set up increment and offset for alternating odd-even access.
-    const size_t    zInc    =  PHASE_BOTH == phase   ? 1 : 2 ;  ///< Amount by which to increment z index.
-    const size_t    flipper = ( PHASE_ODD == phase ) ? 1 : 0 ;
-    const size_t    izShift = ( izStart & 1 ) ^ flipper ; // Flip lowest bit on odd phase.
+    \see ENABLE_VORTON_SIM_SLEEP, SetSleepThresholds, Wake.
+*/
+bool VortonSim::UpdateSleepState()
+{
+    if( mSleepVorticityThreshold <= 0.0f )
+    {   // Sleeping is disabled.
+        Wake() ;
+        return false ;
+    }
 
-    DEBUG_ONLY( const size_t   & nz     = ugVortonIndices.GetNumPoints( 2 ) ) ;
-    DEBUG_ONLY( const size_t     nzm1   = nz - 1 ) ;
-    ASSERT( nz   > 0  ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( nzm1 < nz ) ; // If nz is zero then unsigned nzm1 will be larger.
-    ASSERT( izStart <  izEnd ) ;
-    ASSERT( izEnd   <= nzm1  ) ;
+    PERF_BLOCK( VortonSim__UpdateSleepState ) ;
 
-    // Note that the cell-neighborhood loop visits only some of the neighboring
-    // cells. That is because each particle visitation is symmetric so there is
-    // no need to visit all neighboring cells.
-    const size_t neighborCellOffsets[] =
-    {   // Offsets to neighboring cells whose indices exceed this one:
-           1            // + , 0 , 0 ( 1)
-      //, -1 + nx       // - , + , 0 ( 2)
-        ,    + nx       // 0 , + , 0 ( 3)
-      //,  1 + nx       // + , + , 0 ( 4)
-      //, -1 - nx + nxy // - , - , + ( 5)
-      //,    - nx + nxy // 0 , - , + ( 6)
-      //,  1 - nx + nxy // + , - , + ( 7)
-      //, -1      + nxy // - , 0 , + ( 8)
-        ,         + nxy // 0 , 0 , + ( 9)
-      //,  1      + nxy // + , 0 , + (10)
-      //, -1 + nx + nxy // - , 0 , + (11)
-      //,      nx + nxy // 0 , + , + (12)
-      //,  1 + nx + nxy // + , + , + (13)
-    } ;
-    static const size_t numNeighborCells = sizeof( neighborCellOffsets ) / sizeof( neighborCellOffsets[ 0 ] ) ;
+    if( mIsAsleep && ( mVortons->Size() != mNumVortonsAsleep ) )
+    {   // Vortons were emitted or removed since falling asleep.
+        Wake() ;
+        return false ;
+    }
 
-    size_t idx[3] ;
-    for( idx[2] = izStart + izShift ; idx[2] < izEnd ; idx[2] += zInc )
-    {   // For all grid cells along z...
-        const size_t offsetZ0 = idx[2] * nxy ;
-        for( idx[1] = 0 ; idx[1] < nym1 ; ++ idx[1] )
-        {   // For all grid cells along y...
-            const size_t offsetY0Z0 = idx[1] * nx + offsetZ0 ;
-            for( idx[0] = 0 ; idx[0] < nxm1 ; ++ idx[0] )
-            {   // For all grid cells along x...
-                const size_t offsetX0Y0Z0 = idx[0]     + offsetY0Z0 ;
-                const size_t numInCurrentCell = ugVortonIndices[ offsetX0Y0Z0 ].Size() ;
-                for( unsigned ivHere = 0 ; ivHere < numInCurrentCell ; ++ ivHere )
-                {   // For each vorton in this gridcell...
-                    const unsigned &    rVortIdxHere    = ugVortonIndices[ offsetX0Y0Z0 ][ ivHere ] ;
-                    Vorton &            rVortonHere     = (*mVortons)[ rVortIdxHere ] ;
-                    ASSERT( rVortonHere.IsAlive() ) ;
-                    float &             rDensityHere    = rVortonHere.mDensity ;
-                    ASSERT( rVortonHere.mDensity > 0.0f ) ;
-
-                    // Diffuse heat with other vortons in this same cell.
-                    // Notice that the loop only visits vortons with indices
-                    // following the "here" vorton.  That is because each
-                    // visitation symmetrically modifies both vortons in the
-                    // pair.  If "here" and "there" is visited, then "there" and
-                    // "here" should not also be visited, because it would be
-                    // redundant.
-                    for( unsigned ivThere = ivHere + 1 ; ivThere < ugVortonIndices[ offsetX0Y0Z0 ].Size() ; ++ ivThere )
-                    {   // For each OTHER vorton within this same cell...
-                        ExchangeHeat( rVortIdxHere , rVortonHere , rDensityHere , ivThere , ugVortonIndices[ offsetX0Y0Z0 ] , timeStep ) ;
-                    }
+    bool isQuiescent = true ;
+    if( ! mVortons->Empty() )
+    {   // Find strongest vorticity and speed.
+        float   vortMin , vortMax , vortMean , vortStdDev ;
+        Vec3    centerOfVorticity ;
+        GatherVorticityStats( vortMin , vortMax , vortMean , vortStdDev , centerOfVorticity ) ;
+        float   speedMin , speedMax , speedMean , speedStdDev ;
+        Vec3    centerOfVelocity ;
+        Particles::ComputeVelocityStats( reinterpret_cast< const VECTOR< Particle > & >( * mVortons ) , speedMin , speedMax , speedMean , speedStdDev , centerOfVelocity ) ;
+        isQuiescent = ( vortMax <= mSleepVorticityThreshold ) && ( speedMax <= mSleepSpeedThreshold ) ;
+    }
 
-                    // Diffuse heat with other vortons in adjacent cells.
-                    for( size_t idxNeighborCell = 0 ; idxNeighborCell < numNeighborCells ; ++ idxNeighborCell )
-                    {   // For each cell in neighborhood...
-                        const size_t cellOffset = offsetX0Y0Z0 + neighborCellOffsets[ idxNeighborCell ] ; // offset of adjacent cell
-                        const VECTOR< unsigned > & cell = ugVortonIndices[ cellOffset ] ;
-                        for( unsigned ivThere = 0 ; ivThere < cell.Size() ; ++ ivThere )
-                        {   // For each vorton in the visited cell...
-                            ExchangeHeat( rVortIdxHere , rVortonHere , rDensityHere , ivThere , cell , timeStep ) ;
-                        }
-                    }
+    if( ! isQuiescent )
+    {   // Fluid is in motion.
+        Wake() ;
+        return false ;
+    }
 
-                    // "Dissipate" heat.
-                    // This roughly simulates diffusing heat into regions of fluid that have no explicit particles.
-                    // The proper solution to this would involve either radiating heat into and out of the environment,
-                    // and/or adding fluid particles to regions that lack them, but that would consume computational resources,
-                    // and yield qualitatively very similar results.  Remember, this is for a video game eye candy, not
-                    // science and engineering.
-                    {
-                        const float densityDelta = mAmbientDensity - rDensityHere ; // density departure from ambient
-                        rDensityHere  += thermalDissipationGain * densityDelta ;   // Reduce temperature departure from ambient, of this vorton.
-                        ASSERT( rVortonHere.GetMass() >= 0.0f ) ;
-                    }
-                }
-            }
-        }
+    if( mIsAsleep )
+    {   // Fluid remains settled.
+        return true ;
     }
-}
 
+    ++ mNumQuiescentUpdates ;
+    if( mNumQuiescentUpdates >= mNumQuiescentUpdatesBeforeSleep )
+    {   // Fluid has stayed settled long enough to stop simulating it.
+        FallAsleep() ;
+        return true ;
+    }
+    return false ;
+}
 
 
 
-/** Diffuse heat using a particle strength exchange (PSE) method.
 
-    \see DiffuseAndDissipateVorticityPSE
+/** Stop the fluid, so it stays put while the simulation sleeps.
 
+    This zeroes the velocity of vortons, so operations like PclOpEvolve
+    leave them in place, and zeroes the velocity grid and both of its
+    snapshots, so passive tracers stop too.  Update then skips publishing
+    snapshots until the simulation wakes.
 */
-void VortonSim::DiffuseAndDissipateHeatPSE( const float & timeStep , const unsigned & /* uFrame */ , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices )
+void VortonSim::FallAsleep()
 {
-#if ENABLE_FLUID_BODY_SIMULATION
+    PERF_BLOCK( VortonSim__FallAsleep ) ;
 
-    PERF_BLOCK( VortonSim__DiffuseAndDissipateHeatPSE ) ;
+    const Vec3      zero( 0.0f , 0.0f , 0.0f ) ;
+    const size_t    numVortons = mVortons->Size() ;
+    for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+    {   // For each vorton...
+        ( * mVortons )[ iVorton ].mVelocity = zero ;
+    }
 
-    // Exchange heat with nearest neighbors
+    if( ! mVelGrid.Empty() )
+    {
+        mVelGrid.Init( zero ) ;
+    }
+    mVelGridSnapshot            = mVelGrid ;
+    mVelGridPreviousSnapshot    = mVelGrid ;
 
-    const unsigned & nz     = ugVortonIndices.GetNumPoints( 2 ) ;
-    const unsigned   nzm1   = nz - 1 ;
+    mIsAsleep           = true ;
+    mNumVortonsAsleep   = numVortons ;
+}
 
-    #if USE_TBB
-        // Estimate grain size based on size of problem and number of processors.
-        const size_t grainSize =  Max2( size_t( 1 ) , nzm1 / gNumberOfProcessors ) ;
-        // Compute heat diffusion using threading building blocks
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , VortonSim_DiffuseHeatPSE_TBB( timeStep , this , ugVortonIndices , VortonSim::PHASE_EVEN ) ) ;
-        parallel_for( tbb::blocked_range<size_t>( 0 , nzm1 , grainSize ) , VortonSim_DiffuseHeatPSE_TBB( timeStep , this , ugVortonIndices , VortonSim::PHASE_ODD  ) ) ;
-    #else
-        DiffuseAndDissipateHeatPSESlice( timeStep , ugVortonIndices , 0 , nzm1 , VortonSim::PHASE_BOTH ) ;
-    #endif
 #endif
-}
 
 
 
@@ -4120,6 +8655,12 @@ void VortonSim::UpdateVortexParticleMethod( float timeStep , unsigned uFrame )
 
     ASSERT( ( FLUID_SIM_VORTEX_PARTICLE_METHOD == mFluidSimTechnique ) || ( FLUID_SIM_VPM_SPH_HYBRID == mFluidSimTechnique ) ) ;
 
+#if ENABLE_VORTON_LOD
+    ApplyVortonLevelOfDetail() ;    // Reads stage durations from the previous update, so must precede resetting them.
+#endif
+
+    memset( mUpdateStageDurations , 0 , sizeof( mUpdateStageDurations ) ) ; // Stages this update skips report zero.
+
     if( mVortons->Empty() )
     {
         return ;
@@ -4142,6 +8683,18 @@ void VortonSim::UpdateVortexParticleMethod( float timeStep , unsigned uFrame )
     #endif
     }
 
+#if ENABLE_VORTON_REMESHING
+    if( mRemeshPeriod > 0 )
+    {
+        ++ mNumUpdatesSinceRemesh ;
+        if( mNumUpdatesSinceRemesh >= mRemeshPeriod )
+        {   // Vortons have had time to become disordered, so redistribute them onto a regular lattice.
+            RemeshVortons() ;
+            mNumUpdatesSinceRemesh = 0 ;
+        }
+    }
+#endif
+
 #if USE_PARTICLE_IN_CELL
     //#if ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL )
     //    #error USE_PARTICLE_IN_CELL cannot work with VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL.
@@ -4155,104 +8708,119 @@ void VortonSim::UpdateVortexParticleMethod( float timeStep , unsigned uFrame )
 
     ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterRegrid ) ;
 
-    NestedGrid< Vorton > influenceTree ;
+    NestedGrid< Vorton > & influenceTree = mInfluenceTree ; // Member, rather than local, so its layers reuse memory from previous steps.
 
-//#error TODO: Use mVelFromVortTechnique to change VELOCITY_TECHNIQUE to a runtime decision.
-
-#if ( ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) || ( VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE ) )
-    CreateInfluenceTree( influenceTree ) ;
+    SelectVelocityFromVorticityTechnique() ;
+    const bool usePoisson   = UsesVorticityGrid( mVelFromVortTechniqueInEffect ) ;
+#if ( ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES ) || ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM ) || ( VECTOR_POTENTIAL_TECHNIQUE == VECTOR_POTENTIAL_TECHNIQUE_TREE ) )
+    const bool useTree      = true ;    // Treecode computes velocity, or Poisson boundary values, or both.
+#else
+    const bool useTree      = ( VELOCITY_FROM_VORTICITY_TREE == mVelFromVortTechniqueInEffect ) || ( mNumTreecodeErrorSamples > 0 ) ;
 #endif
 
-#if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL
-    mNegativeVorticityMultiGrid.Initialize( mGridTemplate ) ;
-    PopulateVorticityGridFromVortons( mNegativeVorticityMultiGrid[ 0 ] , -1.0f ) ;
+#if ( ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_TREE ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_MONOPOLES ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_DIRECT ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_FMM ) )
+#   error Velocity technique is invalid or undefined.  Assign VELOCITY_TECHNIQUE in vorton.h or change this code.
 #endif
 
-#if ( ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_TREE ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_MONOPOLES ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_DIRECT ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL ) )
-#   error Velocity technique is invalid or undefined.  Assign VELOCITY_TECHNIQUE in vorton.h or change this code.
+#if USE_PARTICLE_IN_CELL
+    VECTOR< Vorton > * const    pOriginalVortons    = & originalVortons ;
+#else
+    VECTOR< Vorton > * const    pOriginalVortons    = NULLPTR ;
 #endif
 
+    // Express the remaining stages as a dependency graph, so stages that do
+    // not depend on each other can run concurrently instead of each waiting
+    // for the previous stage to finish.
+    typedef Parallel::TaskGraph::NodeId NodeId ;
+    Parallel::TaskGraph         stageGraph ;
+
+    VortonSim_UpdateStage_Task  influenceTreeTask   ( this , UPDATE_STAGE_INFLUENCE_TREE    , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  vorticityGridTask   ( this , UPDATE_STAGE_VORTICITY_GRID    , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  partitionTask       ( this , UPDATE_STAGE_PARTITION         , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  velocityTask        ( this , UPDATE_STAGE_VELOCITY          , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  stretchTask         ( this , UPDATE_STAGE_STRETCH           , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  baroclinicTask      ( this , UPDATE_STAGE_BAROCLINIC        , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  combustionTask      ( this , UPDATE_STAGE_COMBUSTION        , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  heatTask            ( this , UPDATE_STAGE_HEAT              , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+    VortonSim_UpdateStage_Task  viscousDiffusionTask( this , UPDATE_STAGE_VISCOUS_DIFFUSION , timeStep , uFrame , influenceTree , pOriginalVortons ) ;
+
+    // Influence tree, vorticity grid and vorton partition each read only
+    // vortons and each write a different structure, so they can run concurrently.
+    const NodeId influenceTreeNode      = useTree       ? stageGraph.AddNode( influenceTreeTask ) : 0 ;
+    const NodeId vorticityGridNode      = usePoisson    ? stageGraph.AddNode( vorticityGridTask ) : 0 ;
 #if ! USE_PARTICLE_IN_CELL
     // When NOT using PIC, vortons can be partitioned any time before
     // they advect (which happens outside this Update), and one
     // velocity-from-vorticity technique (namely USE_ORIGINAL_VORTONS_IN_BASE_LAYER)
     // uses the vorton partition.
-    // When using PIC, ComputeVelocityFromVorticity uses the ghost vortons
-    // generated in the call to AssignVortonsFromVorticity (above),
-    // so partitioning those vortons here would be useless for PSE below.
-    PartitionVortons( timeStep , uFrame , mVortonIndicesGrid ) ;
-#endif
-
-    // Use vorticity to compute velocity.
-    ComputeVelocityFromVorticity( mVortonIndicesGrid , influenceTree , mNegativeVorticityMultiGrid ) ;
-
-    #if defined( _DEBUG )
-    if( mOutputDiagnostics )
-    {
-        mVelGrid.GenerateBrickOfBytes( "vel" , uFrame ) ;
-    }
-    #endif
-
-#if USE_PARTICLE_IN_CELL
-    // Restore original vortons after computing velocity grid, but before any other operations on vortons.
-    mVortons->swap( originalVortons ) ;
-
-    // Vorton partition must be for the original vortons, not for PIC ghost vortons.
-    // See other comments above.
-    PartitionVortons( timeStep , uFrame , mVortonIndicesGrid ) ;
+    // When using PIC, the velocity stage partitions the original vortons after
+    // restoring them.  See RunUpdateStage.
+    const NodeId partitionNode          = stageGraph.AddNode( partitionTask ) ;
 #endif
 
-    ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterVelGrid ) ;
-
-    mVorticityTermsStats.Reset() ;
-
-    if( ( FLUID_SIM_VORTEX_PARTICLE_METHOD == mFluidSimTechnique )      // Disable stretching for VPM-SPH hybrid, because it causes numerical instability.
-        &&  (   ( INVESTIGATE_ALL                == mInvestigationTerm )
-            ||  ( INVESTIGATE_STRETCHING_TILTING == mInvestigationTerm )
-            )
-        )
-    {
-        StretchAndTiltVortons( timeStep , uFrame ) ;
-    }
-
-    ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterStretch ) ;
-
-    if( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_BAROCLINIC == mInvestigationTerm ) )
+    const NodeId velocityNode           = stageGraph.AddNode( velocityTask ) ;
+    if( useTree )
     {
-        GenerateBaroclinicVorticity( timeStep , uFrame
-    #if COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS || COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH
-                                    , mVortonIndicesGrid
-    #endif
-                                    ) ;
+        stageGraph.AddEdge( influenceTreeNode , velocityNode ) ;
     }
-
-    ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterBaroclinic ) ;
-
-    if( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_THERMAL_DIFFUSION == mInvestigationTerm ) )
+    if( usePoisson )
     {
-        DiffuseAndDissipateHeatPSE( timeStep , uFrame , mVortonIndicesGrid ) ;
+        stageGraph.AddEdge( vorticityGridNode , velocityNode ) ;
     }
+#if ! USE_PARTICLE_IN_CELL
+    stageGraph.AddEdge( partitionNode , velocityNode ) ;
+#endif
 
-    ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterHeat ) ;
-
-    if( ( INVESTIGATE_ALL == mInvestigationTerm ) || ( INVESTIGATE_VISCOUS_DIFFUSION == mInvestigationTerm ) )
+    // Stretching and baroclinic generation both modify vorticity, and
+    // baroclinic generation reads density, which heat diffusion modifies,
+    // so these run in their original order.
+    const NodeId stretchNode            = stageGraph.AddNode( stretchTask ) ;
+    stageGraph.AddEdge( velocityNode , stretchNode ) ;
+    const NodeId baroclinicNode         = stageGraph.AddNode( baroclinicTask ) ;
+    stageGraph.AddEdge( stretchNode , baroclinicNode ) ;
+
+    // Combustion and heat diffusion modify only density and mass fractions,
+    // and viscous diffusion modifies only vorticity, so they can run
+    // concurrently, except when tallying diagnostic integrals between them or
+    // when merging vortons (which modifies both).  Combustion and heat
+    // diffusion both modify density, so they run in order.
+    const NodeId combustionNode         = stageGraph.AddNode( combustionTask ) ;
+    stageGraph.AddEdge( baroclinicNode , combustionNode ) ;
+    const NodeId heatNode               = stageGraph.AddNode( heatTask ) ;
+    stageGraph.AddEdge( combustionNode , heatNode ) ;
+    const NodeId viscousDiffusionNode   = stageGraph.AddNode( viscousDiffusionTask ) ;
+    stageGraph.AddEdge( baroclinicNode , viscousDiffusionNode ) ;
+#if ENABLE_MERGING_VORTONS
+    const bool serializeDiffusion = true ;
+#else
+    const bool serializeDiffusion = mTallyDiagnosticIntegrals ;
+#endif
+    if( serializeDiffusion )
     {
-        DiffuseAndDissipateVorticityPSE( timeStep , uFrame , mVortonIndicesGrid ) ;
+        stageGraph.AddEdge( heatNode , viscousDiffusionNode ) ;
     }
 
-    ConditionallyTallyDiagnosticIntegrals( mDiagnosticIntegrals.mAfterDiffuse ) ;
+    stageGraph.Run() ;
 
-#if 0
+#if ENABLE_MERGING_VORTONS
     // Kill particles merged during DiffuseAndDissipateVorticityPSE.
     // NOTE: TODO: FIXME: Perhaps this should move into block with DiffuseAndDissipateVorticityPSE.
     Particles::KillParticlesMarkedForDeath( reinterpret_cast< VECTOR< Particle > & >( * mVortons ) ) ;
 #endif
 
-#if ! COMPUTE_VELOCITY_AT_VORTONS
-    // Update vorton velocity from field.
-    extern void AssignVelocityFromField( VECTOR< Particle > & particles , const UniformGrid< Vec3 > * velocityGrid , const float gain ) ;
-    AssignVelocityFromField( reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , & mVelGrid , 1.0f ) ;
+#if COMPUTE_VELOCITY_AT_VORTONS
+    if( usePoisson )    // Only the Poisson solver computes velocity on the grid but not at vortons.
 #endif
+    {   // Update vorton velocity from field.
+        extern void AssignVelocityFromField( VECTOR< Particle > & particles , const UniformGrid< Vec3 > * velocityGrid , const float gain ) ;
+        AssignVelocityFromField( reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , & mVelGrid , 1.0f ) ;
+    #if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+        if( ! mVelGridPatches.Empty() )
+        {   // Vortons inside patches read the finer velocity there.
+            AssignVortonVelocityFromPatches() ;
+        }
+    #endif
+    }
 }
 
 
@@ -4275,11 +8843,26 @@ void VortonSim::UpdateVortexParticleMethod( float timeStep , unsigned uFrame )
     to the fluid simulation.  It also facilitates using the same velocity field
     to advect passive tracer particles.
 
+    When done, this copies the velocity grid to a snapshot, which tracers
+    and rendering read, so they see a stable field while the next Update
+    overwrites the velocity grid.  See GetVelocityGridSnapshot.
+
+    While the simulation is asleep, this only checks whether to wake up.
+    See UpdateSleepState.
+
 */
 void VortonSim::Update( float timeStep , unsigned uFrame )
 {
     PERF_BLOCK( VortonSim__Update ) ;
 
+#if ENABLE_VORTON_SIM_SLEEP
+    if( UpdateSleepState() )
+    {   // Fluid has settled and its velocity is zero, so simulating would change nothing.  FallAsleep already published zero velocity.
+        memset( mUpdateStageDurations , 0 , sizeof( mUpdateStageDurations ) ) ;
+        return ;
+    }
+#endif
+
 #if USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
     if( FLUID_SIM_SMOOTHED_PARTICLE_HYDRODYNAMICS == mFluidSimTechnique )
     {   // Use smoothed particle hydrodynamics.
@@ -4292,8 +8875,8 @@ void VortonSim::Update( float timeStep , unsigned uFrame )
             // In that sense, it is superfluous or optional, but it does facilitate some data visualization.
             PopulateDensityAndMassFractionGrids( mDensityGrid , reinterpret_cast< VECTOR< Particle > & >( * mVortons ) , 0 ) ;
 
-            // Populate SDF from density grid, for visualization.  This is in contrast to tracking SDF from tracer particles.
-            PopulateSignedDistanceGridFromDensityGrid( mSignedDistanceGrid , mDensityGrid , 0 ) ;
+            // SDF from density grid is only for visualization, in contrast to tracking SDF from tracer particles,
+            // so GetSignedDistanceGrid populates it on demand.
         }
 
     }
@@ -4341,6 +8924,24 @@ void VortonSim::Update( float timeStep , unsigned uFrame )
         ASSERT( FLUID_SIM_VORTEX_PARTICLE_METHOD == mFluidSimTechnique ) ;
         UpdateVortexParticleMethod( timeStep , uFrame ) ;
     }
+
+    {   // Publish velocity grid, so consumers outside this simulation read a field that the next Update does not overwrite.
+        // Retain the previous snapshot, by swapping rather than copying, so consumers can interpolate between updates.
+        // Once the grid size settles, copying reuses the storage of the snapshot before that, so this costs one pass over the grid.
+        PERF_BLOCK( VortonSim__Update_PublishVelocityGrid ) ;
+        mVelGridPreviousSnapshot.Swap( mVelGridSnapshot ) ;
+        mVelGridSnapshot = mVelGrid ;
+    }
+
+#if VORTON_SIM_GRID_DYE
+    if( mGridDye.IsActive() )
+    {   // Carry grid dye along with the fluid.
+        mGridDye.Advect( mVelGrid , timeStep ) ;
+    }
+#endif
+
+    // Temporaries this step allocated from per-thread arenas are gone now, so reclaim them all at once.
+    FrameArena::ResetAllThreads() ;
 }
 
 
@@ -4355,9 +8956,31 @@ void VortonSim::Clear()
     mVortons->Clear() ;
     mNegativeVorticityMultiGrid.Clear() ;
     mVectorPotentialMultiGrid.Clear() ;
+    mPoissonMultiGridScratch.Clear() ;
     mVelGrid.Clear() ;
+    mVelGridSnapshot.Clear() ;
+    mVelGridPreviousSnapshot.Clear() ;
+#if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+    mVelGridPatches.Clear() ;
+#endif
+#if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+    for( unsigned iQuantity = 0 ; iQuantity < NUM_GRID_DIFFUSION_QUANTITIES ; ++ iQuantity )
+    {
+        mGridDiffusionFields[ iQuantity ].Clear() ;
+        mGridDiffusionSources[ iQuantity ].Clear() ;
+        mGridDiffusionScratch[ iQuantity ].Clear() ;
+    }
+#endif
+#if VORTON_SIM_GRID_DYE
+    mGridDye.Clear() ;
+#endif
     mDensityGrid.Clear() ;
+#if ENABLE_VORTON_SIM_SLEEP
+    Wake() ;
+#endif
     mDensityGradientGrid.Clear() ;
+    mDensityGradientGridStamp   = mDensityGridStamp ;   // Cleared grids match the cleared density grid.
+    mSignedDistanceGridStamp    = mDensityGridStamp ;
 
 #if ENABLE_FIRE
     mFuelFractionGrid.Clear() ;
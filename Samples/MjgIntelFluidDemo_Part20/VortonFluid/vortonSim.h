@@ -16,19 +16,45 @@
 #ifndef VORTON_SIM_H
 #define VORTON_SIM_H
 
+#include <float.h>
 #include <math.h>
 
 #include "Core/useTbb.h"
+#include "Core/parallelExecution.h"
+
+#include "Core/Math/mat33.h"
 
 #include "Core/SpatialPartition/nestedGrid.h"
+#include "Core/SpatialPartition/patchedGrid.h"
+#include "Core/SpatialPartition/cellList.h"
+#include "Core/SpatialPartition/cellBlockColoring.h"
+#include "Core/SpatialPartition/spectralPoissonSolver.h"
+#include "Core/Performance/memoryBudget.h"
+#include "SmoothedPclHydro/sphNeighborList.h"
 #include "vorton.h"
+#include "vortonSoa.h"
+#include "vortonSimd.h"
+#include "velocitySum.h"
+#include "vortonFmm.h"
+#include "vortonClusterAux.h"
+#include "linearInfluenceTree.h"
+#include "gridDye.h"
 
 // Macros --------------------------------------------------------------
 
-#if ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL )
 /// Whether to use Multi-Grid technique for Poisson solver when solving for vector potential from vorticity.
-#   define VORTON_SIM_USE_MULTI_GRID 1
-#endif
+#define VORTON_SIM_USE_MULTI_GRID 1
+
+/** Whether the iterative Poisson solver starts from the previous update's vector potential instead of zero.
+
+    Vorticity changes little between updates, so the previous solution is
+    close to the new one.  When the grid moved or changed resolution,
+    ComputeVelocityFromVorticity_Differential resamples the previous
+    solution into the new geometry first.
+
+    \see SolveVectorPoissonMultiGrid, UniformGrid::Resample.
+*/
+#define VORTON_SIM_WARM_START_POISSON 1
 
 /// Whether to enable code to output density diagnostic data volumes each frame.
 #define VORTON_SIM_OUTPUT_DENSITY 0
@@ -43,6 +69,173 @@
     #define VORTON_SIM_GATHER_STATS 1
 #endif
 
+/** Whether to run bandwidth-limited inner loops on a structure-of-arrays copy of vortons.
+
+    \see VortonSoa.
+*/
+#define USE_VORTON_SOA 1
+
+/** Whether integral velocity-from-vorticity evaluates velocity exactly only in blocks of the velocity grid near vortons.
+
+    Blocks far from every vorton get velocity by interpolating between exact
+    values at block corners.
+
+    \see FindActiveVelocityGridBlocks.
+*/
+#define VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK 1
+
+/** Whether integral velocity-from-vorticity also computes velocity on finer patches of the velocity grid near bodies and strong vorticity.
+
+    Resolving the thin layer of flow around a body would otherwise take
+    refining the whole velocity grid, with memory growing as the cube of
+    resolution.  Patches refine only where needed, and vortons inside them
+    read velocity from the finest patch that contains them.
+
+    \see RefineVelocityGrid, PatchedGrid.
+*/
+#define VORTON_SIM_VELOCITY_PATCHES 1
+
+/// Whether velocity-from-vorticity can refine the velocity grid with patches.  See VORTON_SIM_VELOCITY_PATCHES.
+#define VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT ( VORTON_SIM_VELOCITY_PATCHES && ! COMPUTE_VELOCITY_AT_VORTONS && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_MONOPOLES ) && ( VELOCITY_TECHNIQUE != VELOCITY_TECHNIQUE_FMM ) )
+
+/** Whether viscous and thermal diffusion take an implicit step on the grid, instead of particle strength exchange, when diffusivity is high.
+
+    Particle strength exchange is explicit, so vortons only exchange with
+    neighbors, and once diffusivity times time step rivals the square of
+    their spacing, exchange overshoots.  An implicit step is stable for any
+    diffusivity, and the multigrid solver takes a number of cycles that does
+    not depend on diffusivity.
+
+    \see DiffuseOnGrid, SetGridDiffusionThreshold, SolveVectorScreenedPoissonMultiGrid.
+*/
+#define VORTON_SIM_IMPLICIT_GRID_DIFFUSION 1
+
+/// Whether diffusion can run on the grid.  Merging vortons rides on particle strength exchange, so precludes it.  See VORTON_SIM_IMPLICIT_GRID_DIFFUSION.
+#define VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT ( VORTON_SIM_IMPLICIT_GRID_DIFFUSION && ! ENABLE_MERGING_VORTONS )
+
+/** Whether the simulation carries dye on a grid, advected semi-Lagrangian through the velocity grid.
+
+    Dense smoke takes many tracers per cell; grid dye costs the same per step
+    no matter how much dye there is.  Dye stays inactive, and costs nothing,
+    until something calls GetGridDye().DefineShape.
+
+    \see GridDye.
+*/
+#define VORTON_SIM_GRID_DYE 1
+
+/** Whether computing velocity at vortons with the treecode traverses the influence tree once per group of nearby vortons.
+
+    Otherwise each vorton traverses the tree separately, from the root.
+    Vortons in the same cell of the vorton cell list mostly make the same
+    decisions about which clusters to open, so sharing the traversal shares
+    those decisions and reads each cluster once per group.
+
+    \see ComputeVelocity_TreeGroup.
+*/
+#define VORTON_SIM_GROUP_TREE_QUERIES 1
+
+/** Whether computing velocity at vortons with the treecode also computes the velocity gradient at each vorton, in the same traversal, for StretchAndTiltVortons.
+
+    The velocity field of each (super)vorton has a closed-form gradient, so
+    accumulating it alongside velocity costs a few more operations per
+    interaction.  Then StretchAndTiltVortons needs neither a velocity
+    Jacobian grid nor finite differences of velocity sampled from the grid,
+    and its stretching term has the accuracy of the treecode rather than that
+    of the grid.
+
+    This only has an effect with COMPUTE_VELOCITY_AT_VORTONS and
+    VELOCITY_TECHNIQUE_TREE, and only in updates that use
+    VELOCITY_FROM_VORTICITY_TREE; otherwise StretchAndTiltVortons
+    differentiates the velocity grid as usual.  Each vorton traverses the
+    tree separately, with the scalar Biot-Savart kernel, since
+    ComputeVelocity_TreeGroup and the SIMD kernel do not accumulate gradients.
+*/
+#define VORTON_SIM_TREE_VELOCITY_GRADIENT 1
+
+/// Whether velocity-from-vorticity computes velocity gradient at vortons.  See VORTON_SIM_TREE_VELOCITY_GRADIENT.
+#define VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT ( VORTON_SIM_TREE_VELOCITY_GRADIENT && COMPUTE_VELOCITY_AT_VORTONS && ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) )
+
+/// Whether computing velocity at vortons traverses the influence tree once per group of vortons.  See VORTON_SIM_GROUP_TREE_QUERIES.
+#define VORTON_SIM_GROUP_TREE_QUERIES_AT_VORTONS ( VORTON_SIM_GROUP_TREE_QUERIES && ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_TREE ) && ! VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT )
+
+/** Whether CreateInfluenceTree updates the influence tree from the previous update instead of rebuilding it.
+
+    When the grid keeps the same number of points along each axis, only cells
+    that contain vortons now, or did during the previous update, and their
+    ancestors, get recomputed.  The rest stay empty, so the cost scales with
+    the number of occupied cells rather than the size of the grid.
+
+    \see RefitInfluenceTree.
+*/
+#define VORTON_SIM_REFIT_INFLUENCE_TREE 1
+
+/** Whether treecode queries that each traverse the tree separately read a compact copy of the influence tree.
+
+    After UPDATE_STAGE_INFLUENCE_TREE, VortonSim copies the tree into a
+    LinearInfluenceTree, whose slim nodes lie in one array with children
+    contiguous, and ComputeVelocity_LinearTree traverses that, prefetching
+    the children of each cluster it opens while it sums that cluster's
+    siblings.  Results match ComputeVelocity_Tree up to rounding.
+
+    Grouped queries, vector potential and velocity gradient traversals still
+    read the NestedGrid.
+
+    \see LinearInfluenceTree, ComputeVelocity_LinearTree.
+*/
+#define VORTON_SIM_USE_LINEAR_INFLUENCE_TREE 1
+
+/** Whether to merge and split vortons to keep their number under a budget.
+
+    When the number of vortons exceeds the budget, pairs of weak vortons far
+    from the detail focus and from bodies merge into one.  When the number later
+    falls well under the budget, vortons near the focus or near bodies split
+    apart again.
+
+    \see ApplyVortonLevelOfDetail.
+*/
+#define ENABLE_VORTON_LOD 1
+
+/** Whether to periodically redistribute vortons onto a regular lattice.
+
+    As vortons advect, they cluster in some places and spread apart in
+    others, and stretching strings them out along filaments.  Exchanging
+    vorticity and merging only act locally, so the distribution stays
+    irregular, which needs more vortons for the same accuracy, and leaves
+    cells of the vorton partition and influence tree unevenly occupied.
+
+    Remeshing interpolates the vorticity of all vortons onto the points of a
+    lattice whose spacing matches that of initially seeded vortons, using the
+    M4' kernel, which conserves circulation and linear and angular impulse.
+    Then one vorton replaces each lattice point, except lattice points whose
+    vorticity is negligible.  So the number of vortons stays proportional to
+    the volume that vorticity occupies.
+
+    \see RemeshVortons, SetRemeshPeriod.
+*/
+#define ENABLE_VORTON_REMESHING 1
+
+/** Whether VortonSim stops simulating fluid that has settled.
+
+    When an effect settles, for example when viscosity has damped the
+    vorticity of dissipating smoke, Update would otherwise still run every
+    stage, each frame, to compute negligible motion.
+
+    When every vorton has stayed below the sleep thresholds for vorticity and
+    speed for several consecutive updates, the simulation falls asleep:  It
+    zeroes velocity, and Update then only checks whether to wake up, which
+    costs one pass over vortons.  It wakes when the number of vortons changes
+    (for example due to emission), when a vorton exceeds a threshold again
+    (for example due to contact with a body), or when told to.
+
+    Separately, while awake, cells of the vorton partition whose vortons all
+    have vorticity below the threshold sleep individually:  They do not make
+    nearby blocks of the velocity grid active, so velocity there gets
+    interpolated, as far from vortons.  See FindActiveVelocityGridBlocks.
+
+    \see SetSleepThresholds, UpdateSleepState.
+*/
+#define ENABLE_VORTON_SIM_SLEEP 1
+
 /// Use a linked list for spatial partition.  TODO: FIXME: Finish this implementation.
 #define USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION 0
 
@@ -60,6 +253,10 @@
 /// Alternative is to use direct, slower, simpler O(N^2) algorithm.
 #define USE_UNIFORM_GRID_SPATIAL_PARTITION_FOR_SPH 1
 
+/// Whether to find SPH neighbors using a SpatialHash, whose cells have a fixed size regardless of the vorton bounding box.
+/// Alternative is to use a CellList fit to mGridTemplate, whose cells grow when outlying vortons stretch the bounding box.
+#define USE_SPATIAL_HASH_FOR_SPH_NEIGHBORS 1
+
 /// Disallow SPH with REDUCE_CONVERGENCE.  SPH should reduce divergence without that crutch.
 #if USE_SMOOTHED_PARTICLE_HYDRODYNAMICS && REDUCE_CONVERGENCE
     #error REDUCE_CONVERGENCE should not be enabled for SPH.
@@ -92,6 +289,40 @@ struct SphFluidDensities
 
 
 
+/** Interface to an alternative evaluator of velocity due to vortons, for example one that runs on a GPU.
+
+    VortonSim builds the influence tree and decides when to compute velocity;
+    an evaluator only performs the summation.  When an evaluator cannot do
+    that (for example because the graphics driver lacks a required feature),
+    it returns false and VortonSim uses its own CPU routines instead.
+
+    \see VortonSim::SetVelocityEvaluator
+*/
+class IVortonVelocityEvaluator
+{
+    public:
+        virtual ~IVortonVelocityEvaluator() {}
+
+        /** Compute velocity due to vortons at every gridpoint of velocityGrid, using the same law as VORTON_ACCUMULATE_VELOCITY.
+
+            \param velocityGrid                (in/out) Grid whose gridpoints are the query points, and to which to write velocity.
+
+            \param vortons                     Vortons, which evaluators should sum directly when influenceTree has fewer than 2 layers.
+
+            \param influenceTree               Nested grid of vortons and supervortons, which evaluators should traverse as VortonSim::ComputeVelocity_Tree does.
+
+            \param spreadingRangeFactor        Factor by which to scale vorton core radius.  See ENABLE_AUTO_MOLLIFICATION.
+
+            \param spreadingCirculationFactor  Factor by which to scale vorton circulation.  See ENABLE_AUTO_MOLLIFICATION.
+
+            \return Whether velocityGrid now holds velocity.
+        */
+        virtual bool ComputeVelocityAtGridpoints( UniformGrid< Vec3 > & velocityGrid , const VECTOR< Vorton > & vortons , const NestedGrid< Vorton > & influenceTree , float spreadingRangeFactor , float spreadingCirculationFactor ) = 0 ;
+} ;
+
+
+
+
 #if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
 
 /** Spatial partition of an array of items.
@@ -148,15 +379,89 @@ class VortonSim
             FLUID_SIM_NUM                                   ///<
         } ;
 
-        /** Technique for obtaining velocity from vorticity.
+        /** Kernel used to evaluate the Biot-Savart law in integral velocity-from-vorticity techniques.
+        */
+        enum BiotSavartKernelE
+        {
+            BIOT_SAVART_KERNEL_SCALAR   ,   ///< Evaluate one source vorton at a time, using VORTON_ACCUMULATE_VELOCITY.
+            BIOT_SAVART_KERNEL_SIMD     ,   ///< Evaluate VORTON_SIMD_WIDTH source vortons at a time, using VortonAccumulateVelocity_Simd.
+            BIOT_SAVART_KERNEL_ISPC     ,   ///< Evaluate shared sources at a group of queries using FluidKernels, vectorized across queries at the widest width the processor supports.  Single queries use VortonAccumulateVelocity_Simd.
+            BIOT_SAVART_KERNEL_NUM          ///<
+        } ;
+
+        /** Solver the Poisson velocity-from-vorticity technique uses to obtain vector potential from vorticity.
+        */
+        enum PoissonSolverE
+        {
+            POISSON_SOLVER_MULTI_GRID           ,   ///< Iterate Gauss-Seidel multigrid cycles, with boundary values from an integral technique.
+            POISSON_SOLVER_SPECTRAL             ,   ///< Solve directly using sine transforms, with boundary values from an integral technique.
+            POISSON_SOLVER_SPECTRAL_FREE_SPACE  ,   ///< Solve directly by convolving with free-space Green's function, without computing boundary values.
+            POISSON_SOLVER_NUM                      ///<
+        } ;
+
+        /** Rule by which treecode queries decide whether to open a cluster, rather than treat it as one supervorton.
+
+            Queries always open clusters that contain them.  Each criterion
+            below additionally opens clusters it deems too close or too
+            influential, trading speed for accuracy.  Defaults disable both,
+            which reproduces the original cell-adjacency rule.
+
+            ComputeVelocity_Tree, ComputeVelocity_TreeGroup and ComputeVectorPotential_Tree all use this.
+        */
+        struct TreeOpeningCriterion
+        {
+            TreeOpeningCriterion()
+                : mOpeningAngle( FLT_MAX )
+                , mErrorTolerance( FLT_MAX )
+            {}
+
+            float   mOpeningAngle   ;   ///< Barnes-Hut theta: open clusters whose diagonal exceeds this times their distance from the query.  Smaller is more accurate and slower.  FLT_MAX disables.
+            float   mErrorTolerance ;   ///< Open clusters whose estimated contribution to velocity error at the query exceeds this, so each query refines until it meets this tolerance per cluster.  FLT_MAX disables.
+        } ;
+
+
+        /** Error of treecode velocity relative to direct summation, at a sample of gridpoints.
+
+            \see SetNumTreecodeErrorSamples.
+        */
+        struct TreecodeErrorStatistics
+        {
+            TreecodeErrorStatistics()
+                : mRmsRelativeError( 0.0f )
+                , mMaxRelativeError( 0.0f )
+                , mNumSamples( 0 )
+            {}
+
+            float   mRmsRelativeError   ;   ///< Root-mean-square of velocity error, divided by root-mean-square of velocity.
+            float   mMaxRelativeError   ;   ///< Maximum magnitude of velocity error, divided by maximum speed.
+            size_t  mNumSamples         ;   ///< Number of gridpoints sampled, or zero if the most recent update measured none.
+        } ;
+
+
+        /** Technique for obtaining velocity from vorticity, chosen at run time.
+
+            VELOCITY_TECHNIQUE in vorton.h picks the initial value.  It also
+            still governs variations that only some techniques support, such
+            as COMPUTE_VELOCITY_AT_VORTONS, and, when it picks MONOPOLES or FMM,
+            which hierarchical technique VELOCITY_FROM_VORTICITY_TREE means.
+
+            VELOCITY_FROM_VORTICITY_P3M uses the Poisson solver for the far
+            field, where the mesh represents vortons well, then corrects
+            velocity near each vorton, where the mesh blurs it, by direct
+            summation over vortons in neighboring cells of the vorton
+            partition.  Its cost stays linear in the number of vortons, like
+            the Poisson solver, but its error near vortons resembles direct
+            summation.  See AddNearFieldVelocity.
         */
-        //enum VelocityFromVorticityTechnique
-        //{
-        //    VELOCITY_FROM_VORTICITY_DIRECT  ,   ///< Direct summation
-        //    VELOCITY_FROM_VORTICITY_TREE    ,   ///< Tree-code summation
-        //    VELOCITY_FROM_VORTICITY_POISSON ,   ///< Solve Poisson equation
-        //    VELOCITY_FROM_VORTICITY_NUM         
-        //} ;
+        enum VelocityFromVorticityTechniqueE
+        {
+            VELOCITY_FROM_VORTICITY_DIRECT  ,   ///< Direct summation.  Fastest for few vortons.
+            VELOCITY_FROM_VORTICITY_TREE    ,   ///< Tree-code summation.
+            VELOCITY_FROM_VORTICITY_POISSON ,   ///< Solve Poisson equation.  Fastest for many vortons on a large grid.
+            VELOCITY_FROM_VORTICITY_P3M     ,   ///< Solve Poisson equation for far field, then correct near field by direct summation over neighboring cells (particle-particle/particle-mesh).
+            VELOCITY_FROM_VORTICITY_AUTO    ,   ///< Time each of the above during the first frames, then use the fastest that meets the velocity error target.
+            VELOCITY_FROM_VORTICITY_NUM
+        } ;
 
 
         /** Integrals that should be constant for a fluid.
@@ -253,6 +558,29 @@ class VortonSim
         } ;
 
 
+        /** Statistics of vorton properties, and integrals of vorticity, which GatherStatistics computes in one pass.
+
+            Each property has the same statistics its Gather...Stats routine computes.
+            Properties with no samples (for example SPH densities, when the simulation
+            does not use SPH) have zero statistics.
+        */
+        struct VortonStatistics
+        {
+            StatsFloat  mVorticity          ;   ///< Magnitude of vorticity.
+            StatsFloat  mVelocity           ;   ///< Magnitude of velocity.
+            StatsFloat  mTemperature        ;   ///< Temperature.
+            StatsFloat  mDensity            ;   ///< Density.
+            StatsFloat  mDensitySph         ;   ///< Mass density computed by SPH.
+            StatsFloat  mNumberDensitySph   ;   ///< Number density computed by SPH.
+            StatsFloat  mDensityGradient    ;   ///< Magnitude of density gradient computed by SPH.
+            StatsFloat  mProximity          ;   ///< Proximity of vortons to body walls.
+            StatsFloat  mSignedDistance     ;   ///< Signed distance, at gridpoints of the SDF grid.
+            Vec3        mCenterOfVorticity  ;   ///< Average vorton position, weighted by vorticity magnitude.
+            Vec3        mCenterOfVelocity   ;   ///< Average vorton position, weighted by velocity magnitude.
+            Integrals   mIntegrals          ;   ///< Integrals of vorticity and velocity, same as TallyDiagnosticIntegrals computes.
+        } ;
+
+
         enum InvestigationTermE
         {
             INVESTIGATE_ALL                 ,
@@ -264,15 +592,19 @@ class VortonSim
         } ;
 
 
-        /** Which phase to run an algorithm that requires interleaving.
-
-            \see GaussSeidelPortion
-        */
-        enum PhaseE
+        /// Stages of UpdateVortexParticleMethod, each of which runs as a node in a task graph.
+        enum UpdateStageE
         {
-            PHASE_ODD   ,   ///< Run on odd z slice index values.
-            PHASE_EVEN  ,   ///< Run on even z slice index values.
-            PHASE_BOTH  ,   ///< Run on all z slice index values.
+            UPDATE_STAGE_INFLUENCE_TREE     ,   ///< Create influence tree used by treecode velocity-from-vorticity.
+            UPDATE_STAGE_VORTICITY_GRID     ,   ///< Populate vorticity grid used by Poisson velocity-from-vorticity.
+            UPDATE_STAGE_PARTITION          ,   ///< Partition vortons into a cell list.
+            UPDATE_STAGE_VELOCITY           ,   ///< Compute velocity from vorticity.
+            UPDATE_STAGE_STRETCH            ,   ///< Stretch and tilt vortons.
+            UPDATE_STAGE_BAROCLINIC         ,   ///< Generate baroclinic vorticity.
+            UPDATE_STAGE_COMBUSTION         ,   ///< Convert fuel to flame to smoke, releasing heat.
+            UPDATE_STAGE_HEAT               ,   ///< Diffuse and dissipate heat.
+            UPDATE_STAGE_VISCOUS_DIFFUSION  ,   ///< Diffuse and dissipate vorticity.
+            NUM_UPDATE_STAGES
         } ;
 
 
@@ -290,6 +622,7 @@ class VortonSim
                 // mVortons gets set before operating on it.  In fact, mVortons should
                 // not be a member; should be passed in to routines that operate on it.
                 mVortons = 0 ;
+                mVelocityEvaluator = 0 ;
             }
             return * this ;
         }
@@ -307,6 +640,9 @@ class VortonSim
         void                                GatherDensityGradientStats( float & min , float & max , float & mean , float & stddev ) const ;
         void                                GatherSignedDistanceStats( float & min , float & max , float & mean , float & stddev ) const ;
         void                                GatherProximityStats( float & min , float & max , float & mean , float & stddev ) const ;
+        void                                GatherStatistics( VortonStatistics & stats ) const ;
+        void                                ReportMemoryUsage( MemoryBudget & memoryBudget ) const ;
+        void                                TrimMemory() ;
 
         /// Return reference to integrals used to diagnose fluid simulation accuracy.
         const DiagnosticIntegrals &         GetDiagnosticIntegrals() const                          { return mDiagnosticIntegrals ; }
@@ -314,7 +650,29 @@ class VortonSim
         /// Return reference to statistics of vorticity equation terms.
         const VorticityTermsStatistics &    GetVorticityTermsStatistics() const                     { return mVorticityTermsStats ; }
 
-        /// Return reference to statistics of Poisson residuals.
+        /// Select solver the Poisson velocity-from-vorticity technique uses.
+        void                                SetPoissonSolver( PoissonSolverE poissonSolver )        { mPoissonSolver = poissonSolver ; }
+        const PoissonSolverE &              GetPoissonSolver() const                                { return mPoissonSolver ; }
+
+        /// Set largest number of iterations (multigrid cycles, or relaxation sweeps) the iterative Poisson solver applies per update.  Zero lets the solver choose.
+        void                                SetMaxPoissonIterations( unsigned maxIterations )       { mMaxPoissonIterations = maxIterations ; }
+        const unsigned &                    GetMaxPoissonIterations() const                         { return mMaxPoissonIterations ; }
+
+        /** Set largest error, relative to the largest boundary value, of vector potential that Poisson techniques interpolate on domain boundaries.
+
+            When positive, the integral pass that assigns boundary values evaluates
+            only a coarse lattice of boundary gridpoints, and interpolates the rest.
+            Each update measures the interpolation error, and refines the lattice
+            until it meets this bound.  Zero evaluates every boundary gridpoint.
+        */
+        void                                SetBoundaryInterpolationTolerance( float tolerance )    { mBoundaryInterpolationTolerance = tolerance ; }
+        const float &                       GetBoundaryInterpolationTolerance() const               { return mBoundaryInterpolationTolerance ; }
+
+        /// Return spacing, in gridpoints, between boundary gridpoints the most recent update evaluated, and the relative error it measured of the rest.
+        const unsigned &                    GetBoundaryInterpolationStride() const                  { return mBoundaryInterpolationStride ; }
+        const float &                       GetBoundaryInterpolationError() const                   { return mBoundaryInterpolationError ; }
+
+        /// Return reference to statistics of Poisson residuals.  Spectral solvers report zero.
         const Stats_Float &                 GetPoissonResidualStats() const                         { return mPoissonResidualStats ; }
         const Stats_Float &                 GetPoissonResidualStats_AcrossTime() const              { return mPoissonResidualStats_AcrossTime ; }
 
@@ -325,6 +683,107 @@ class VortonSim
         void                                SetFluidSimulationTechnique( FluidSimulationTechniqueE fluidSimTechnique ) { mFluidSimTechnique = fluidSimTechnique ; }
         const FluidSimulationTechniqueE &   GetFluidSimulationTechnique() const                     { return mFluidSimTechnique ; }
 
+        /// Select which kernel evaluates the Biot-Savart law.  Only integral velocity-from-vorticity techniques use this.
+        void                                SetBiotSavartKernel( BiotSavartKernelE biotSavartKernel ) { mBiotSavartKernel = biotSavartKernel ; }
+        const BiotSavartKernelE &           GetBiotSavartKernel() const                             { return mBiotSavartKernel ; }
+
+        /// Select technique for obtaining velocity from vorticity, or VELOCITY_FROM_VORTICITY_AUTO to let the simulation choose.
+        void                                SetVelocityFromVorticityTechnique( VelocityFromVorticityTechniqueE technique ) { mVelFromVortTechnique = technique ; }
+        const VelocityFromVorticityTechniqueE & GetVelocityFromVorticityTechnique() const           { return mVelFromVortTechnique ; }
+
+        /// Return technique the most recent update used, which differs from GetVelocityFromVorticityTechnique when that is VELOCITY_FROM_VORTICITY_AUTO.
+        const VelocityFromVorticityTechniqueE & GetVelocityFromVorticityTechniqueInEffect() const   { return mVelFromVortTechniqueInEffect ; }
+
+        /// Set root-mean-square velocity error, relative to direct summation, that VELOCITY_FROM_VORTICITY_AUTO must meet.
+        void                                SetVelocityErrorTarget( float velocityErrorTarget )     { mVelocityErrorTarget = velocityErrorTarget ; }
+        const float &                       GetVelocityErrorTarget() const                          { return mVelocityErrorTarget ; }
+
+        static const char *                 GetVelocityFromVorticityTechniqueName( VelocityFromVorticityTechniqueE technique ) ;
+
+        /// Set rule by which treecodes decide whether to open clusters, to trade speed for accuracy.
+        void                                SetTreeOpeningCriterion( const TreeOpeningCriterion & criterion ) { mTreeOpeningCriterion = criterion ; }
+        const TreeOpeningCriterion &        GetTreeOpeningCriterion() const                         { return mTreeOpeningCriterion ; }
+
+        /// Set number of gridpoints at which each update compares treecode velocity, and the velocity grid, against direct summation.  Zero disables.  See GetTreecodeErrorStatistics and GetVelocityGridError.
+        void                                SetNumTreecodeErrorSamples( size_t numSamples )         { mNumTreecodeErrorSamples = numSamples ; }
+        const size_t &                      GetNumTreecodeErrorSamples() const                      { return mNumTreecodeErrorSamples ; }
+
+        /// Return error of treecode velocity that the most recent update measured.
+        const TreecodeErrorStatistics &     GetTreecodeErrorStatistics() const                      { return mTreecodeErrorStats ; }
+
+        /// Return root-mean-square error of the velocity grid, relative to direct summation, that the most recent update measured, whatever technique populated it.  Zero when not measured.
+        const float &                       GetVelocityGridError() const                            { return mVelocityGridError ; }
+    #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+        void                                SetFarFieldTolerance( float farFieldTolerance )         { mFarFieldTolerance = farFieldTolerance ; }
+        const float &                       GetFarFieldTolerance() const                            { return mFarFieldTolerance ; }
+    #endif
+    #if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+        /// Set maximum number of finer patches RefineVelocityGrid adds to the velocity grid.  Zero disables refinement.
+        void                                SetMaxVelocityPatches( unsigned maxPatches )            { mMaxVelocityPatches = maxPatches ; }
+        const unsigned &                    GetMaxVelocityPatches() const                           { return mMaxVelocityPatches ; }
+
+        /// Set number of patch cells along each edge of a velocity grid cell.  Must be at least 2.
+        void                                SetVelocityPatchRefinement( unsigned refinement )       { ASSERT( refinement >= 2 ) ; mVelocityPatchRefinement = refinement ; }
+        const unsigned &                    GetVelocityPatchRefinement() const                      { return mVelocityPatchRefinement ; }
+
+        /// Set vorticity, as a fraction of that of the strongest vorton, above which vortons make their block of the velocity grid get a patch.
+        void                                SetVelocityPatchVorticityFraction( float fraction )     { mVelocityPatchVorticityFraction = fraction ; }
+        const float &                       GetVelocityPatchVorticityFraction() const               { return mVelocityPatchVorticityFraction ; }
+
+        /// Return finer patches of the velocity grid, which the most recent update computed.
+        const PatchedGrid< Vec3 > &         GetVelocityPatches() const                              { return mVelGridPatches ; }
+
+        /// Interpolate velocity at the given position from the finest patch that contains it, or otherwise from the velocity grid.
+        void                                InterpolateVelocity( Vec3 & velocity , const Vec3 & position ) const { mVelGridPatches.Interpolate( velocity , position , mVelGrid ) ; }
+    #endif
+
+        /// Set evaluator that computes velocity at gridpoints in place of the CPU treecode, or 0 to use the CPU.  This does not take ownership.
+        void                                SetVelocityEvaluator( IVortonVelocityEvaluator * velocityEvaluator ) { mVelocityEvaluator = velocityEvaluator ; }
+        IVortonVelocityEvaluator *          GetVelocityEvaluator() const                            { return mVelocityEvaluator ; }
+
+    #if ENABLE_VORTON_LOD
+        /// Set maximum number of vortons, above which ApplyVortonLevelOfDetail merges vortons.  Zero means unlimited.
+        void                                SetVortonBudget( size_t vortonBudget )                  { mVortonBudget = vortonBudget ; }
+        const size_t &                      GetVortonBudget() const                                 { return mVortonBudget ; }
+
+        /// Set wall-clock seconds the velocity stage should take per update.  Longer durations shrink the budget.  Zero disables.
+        void                                SetVelocityStageDurationTarget( float durationTarget )  { mVelocityStageDurationTarget = durationTarget ; }
+        const float &                       GetVelocityStageDurationTarget() const                  { return mVelocityStageDurationTarget ; }
+
+        /// Set point, such as the camera eye, within lodDetailRadius of which vortons never merge.  Zero radius disables the focus.
+        void                                SetLodFocus( const Vec3 & lodFocus , float lodDetailRadius ) { mLodFocus = lodFocus ; mLodDetailRadius = lodDetailRadius ; }
+
+        /// Return number of merges ApplyVortonLevelOfDetail has not yet undone by splitting.
+        const size_t &                      GetNumVortonsMerged() const                             { return mNumVortonsMerged ; }
+    #endif
+
+    #if ENABLE_VORTON_REMESHING
+        /// Set number of updates between redistributing vortons onto a regular lattice.  Zero disables.  See RemeshVortons.
+        void                                SetRemeshPeriod( unsigned remeshPeriod )                { mRemeshPeriod = remeshPeriod ; }
+        const unsigned &                    GetRemeshPeriod() const                                 { return mRemeshPeriod ; }
+
+        /// Set vorticity, as a fraction of that of the strongest vorton, below which remeshing discards lattice points.
+        void                                SetRemeshVorticityThreshold( float threshold )          { mRemeshVorticityThreshold = threshold ; }
+        const float &                       GetRemeshVorticityThreshold() const                     { return mRemeshVorticityThreshold ; }
+    #endif
+
+    #if ENABLE_VORTON_SIM_SLEEP
+        /// Set vorticity and speed below which vortons count as quiescent.  Zero vorticity threshold disables sleeping.  See UpdateSleepState.
+        void                                SetSleepThresholds( float vorticity , float speed )     { mSleepVorticityThreshold = vorticity ; mSleepSpeedThreshold = speed ; }
+        const float &                       GetSleepVorticityThreshold() const                      { return mSleepVorticityThreshold ; }
+        const float &                       GetSleepSpeedThreshold() const                          { return mSleepSpeedThreshold ; }
+
+        /// Set number of consecutive quiescent updates after which the simulation falls asleep.
+        void                                SetNumQuiescentUpdatesBeforeSleep( unsigned numUpdates ) { mNumQuiescentUpdatesBeforeSleep = numUpdates ; }
+        const unsigned &                    GetNumQuiescentUpdatesBeforeSleep() const               { return mNumQuiescentUpdatesBeforeSleep ; }
+
+        /// Return whether the most recent Update skipped simulating because the fluid had settled.
+        bool                                IsAsleep() const                                        { return mIsAsleep ; }
+
+        /// Make the next Update simulate, for example when a body moves into settled fluid.
+        void                                Wake()                                                  { mIsAsleep = false ; mNumQuiescentUpdates = 0 ; }
+    #endif
+
         /// Set address of dynamic array used to store vortons.
         void                                SetVortons( VECTOR< Vorton > * vortons )                { mVortons = vortons ; }
               VECTOR< Vorton >  *           GetVortons()                                            { return mVortons ; }
@@ -334,6 +793,14 @@ class VortonSim
         const UniformGrid< Vec3 > &         GetVelocityGrid() const                                 { return mVelGrid ; }
               UniformGrid< Vec3 > &         GetVelocityGrid()                                       { return mVelGrid ; }
 
+        /// Return copy of velocity grid from the end of the most recent Update.
+        /// Consumers outside this simulation (tracers, rendering) read this, so they see a stable field while the next Update overwrites mVelGrid.
+        const UniformGrid< Vec3 > &         GetVelocityGridSnapshot() const                         { return mVelGridSnapshot ; }
+              UniformGrid< Vec3 > &         GetVelocityGridSnapshot()                               { return mVelGridSnapshot ; }
+
+        /// Return velocity grid snapshot that Update published before the most recent one, so consumers can interpolate between the two.  Empty until Update has run twice.
+        const UniformGrid< Vec3 > &         GetPreviousVelocityGridSnapshot() const                 { return mVelGridPreviousSnapshot ; }
+
         /// Return nested grid representing spatial distribution of vorticity.
         const NestedGrid< Vec3 > &          GetNegativeVorticityMultiGrid() const                   { return mNegativeVorticityMultiGrid ; }
               NestedGrid< Vec3 > &          GetNegativeVorticityMultiGrid()                         { return mNegativeVorticityMultiGrid ; }
@@ -352,6 +819,19 @@ class VortonSim
         void                                SetThermalDiffusivity( float thermalDiffusivity )       { mThermalDiffusivity = thermalDiffusivity ; }
         const float &                       GetThermalDiffusivity() const                           { return mThermalDiffusivity ; }
 
+    #if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+        /// Set diffusion number, diffusivity times time step over square of grid spacing, above which diffusion takes an implicit step on the grid.
+        /// Below it, diffusion uses particle strength exchange.  FLT_MAX disables grid diffusion.
+        void                                SetGridDiffusionThreshold( float diffusionNumber )      { mGridDiffusionThreshold = diffusionNumber ; }
+        const float &                       GetGridDiffusionThreshold() const                       { return mGridDiffusionThreshold ; }
+    #endif
+
+    #if VORTON_SIM_GRID_DYE
+        /// Return dye that Update advects through the velocity grid.  Call DefineShape on it to activate it.
+        const GridDye &                     GetGridDye() const                                      { return mGridDye ; }
+              GridDye &                     GetGridDye()                                            { return mGridDye ; }
+    #endif
+
         /// Set specific heat capacity for fluid simulation.
         /// This controls the amount of heat required to change the temperature of a unit of fluid.
         void                                SetSpecificHeatCapacity( float specificHeatCapacity )   { mSpecificHeatCapacity = specificHeatCapacity ; }
@@ -365,10 +845,18 @@ class VortonSim
         /// Return reference to density grid.
         /// This represents the spatial distribution of fluid density.
         const UniformGrid< float > &        GetDensityGrid() const                                  { return mDensityGrid ; }
+              UniformGrid< float > &        GetDensityGrid()                                        { return mDensityGrid ; }
+
+        /// Return grid representing density gradient, first computing it from the density grid if that changed since the gradient was last computed.
+        /// The simulation itself only computes this grid when its baroclinic term needs it, so otherwise only callers of this pay for it.
+        const UniformGrid< Vec3 > &         GetDensityGradientGrid()                                { UpdateDensityGradientGrid() ; return mDensityGradientGrid ; }
 
-        /// Return grid representing density gradient.
+        /// Return grid representing density gradient as last computed, which can be stale or empty.  See the non-const overload.
         const UniformGrid< Vec3 > &         GetDensityGradientGrid() const                          { return mDensityGradientGrid ; }
 
+        /// Return whether density gradient grid is up to date with density grid, so GetDensityGradientGrid would return it without computing it.
+        bool                                IsDensityGradientGridCurrent() const                    { return ( mDensityGradientGridStamp == mDensityGridStamp ) && ! mDensityGradientGrid.Empty() ; }
+
 #if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
         const VECTOR< SphFluidDensities > & GetFluidDensitiesAtPcls() const                         { return mFluidDensitiesAtPcls ; }
         const VECTOR< Vec3 > &              GetDensityGradientsAtPcls() const                       { return mDensityGradientsAtPcls ; }
@@ -382,11 +870,21 @@ class VortonSim
 
         /// Return reference to signed distance function grid.
         /// This represents the distance to the nearest surface.
+        /// When populating SDF from density, this first brings the grid up to date with the density grid.  See SetPopulateSdfFromDensity.
+        const UniformGrid< float > &        GetSignedDistanceGrid()                                 { UpdateSignedDistanceGrid() ; return mSignedDistanceGrid ; }
+
+        /// Return signed distance function grid as last computed, which can be stale.  See the non-const overload.
         const UniformGrid< float > &        GetSignedDistanceGrid() const                           { return mSignedDistanceGrid ; }
 
+        /// Return reference to spatial partition of vorton indices, e.g. so operations that reorder vortons can keep it consistent.
+              CellList &                    GetVortonCellList()                                     { return mVortonIndicesGrid ; }
+
+        /// Return tree of vorton clusters that the most recent update aggregated, with the leaf layer at index 0.  See AggregateClusters.
+        const NestedGrid< Vorton > &        GetInfluenceTree() const                                { return mInfluenceTree ; }
+
 #if REDUCE_CONVERGENCE
-        const UniformGrid< VECTOR< unsigned > > & GetVortonIndicesGrid() const { return mVortonIndicesGrid ; }
-        static float ReduceDivergence( VECTOR< Vorton > * vortons , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices ) ;
+        const CellList & GetVortonIndicesGrid() const { return mVortonIndicesGrid ; }
+        static float ReduceDivergence( VECTOR< Vorton > * vortons , const CellList & ugVortonIndices ) ;
 #endif
 
         /// Set the uniform gravitational acceleration.
@@ -404,6 +902,10 @@ class VortonSim
         /// \see GetVelocityGrid, GetDensityGrid, GetFuelGrid, GetFlameGrid, GetSmokeGrid.
         const UniformGridGeometry & GetGrid()                                               { return mGridTemplate ; }
 
+        /// Set number of grid points per vorton, which determines resolution of grids the next bounding box update defines.
+        void                        SetGridPointsPerVorton( float gridPointsPerVorton )     { ASSERT( gridPointsPerVorton > 0.0f ) ; mGridPointsPerVorton = gridPointsPerVorton ; }
+        const float &               GetGridPointsPerVorton() const                          { return mGridPointsPerVorton ; }
+
         /// Get coordinate for minimal (lower left bottom) corner of grids used in this simulation.
         const Vec3 &                GetMinCorner() const                                    { return mMinCorner ; }
 
@@ -421,6 +923,10 @@ class VortonSim
 
         InvestigationTermE &        GetInvestigationTerm()                                  { return mInvestigationTerm ; }
 
+        /// Return wall-clock seconds the given stage took during the most recent update, or zero if it did not run.  Stages can run concurrently, so durations can overlap.
+        float                       GetUpdateStageDuration( UpdateStageE stage ) const      { return mUpdateStageDurations[ stage ] ; }
+        static const char *         GetUpdateStageName( UpdateStageE stage ) ;
+
     #if ENABLE_FIRE
         /// Set temperature above which fuel starts to become flame.
         void                        SetCombustionTemperature( float combustionTemperature ) { mCombustionTemperature = combustionTemperature ; }
@@ -456,6 +962,42 @@ class VortonSim
     #endif
 
     private:
+        /// Parallel loops that run every update, each of which keeps its own record of which thread ran which chunk.  See mAffinityPartitioners.
+        enum ParallelLoopE
+        {
+            PARALLEL_LOOP_VECTOR_POTENTIAL_AT_GRIDPOINTS    ,   ///< ComputeVectorPotentialAtGridpoints_Slice over all z slices.
+            PARALLEL_LOOP_VELOCITY_AT_GRIDPOINTS            ,   ///< ComputeVelocityAtGridpoints_Slice.
+            PARALLEL_LOOP_INTERPOLATE_INACTIVE_VELOCITY     ,   ///< InterpolateInactiveVelocityGridBlocks_Slice.
+            PARALLEL_LOOP_NEAR_FIELD_VELOCITY               ,   ///< AddNearFieldVelocity_Slice.
+            PARALLEL_LOOP_VELOCITY_AT_VORTONS               ,   ///< ComputeVelocityAtVortons_Slice or ComputeVelocityAtVortonGroups_Slice.
+            PARALLEL_LOOP_COMBUSTION                        ,   ///< CombustAndSetMassFractionsSlice.
+            PARALLEL_LOOP_BAROCLINIC                        ,   ///< GenerateBaroclinicVorticitySlice.
+            NUM_PARALLEL_LOOPS
+        } ;
+
+        /// Stages of particle strength exchange.  Each stage runs concurrently over its items, and stages run in order.  See DiffuseAndDissipateVorticityPSE.
+        enum PseStageE
+        {
+            PSE_STAGE_EXCHANGE  ,   ///< For each chunk of rows of cells, accumulate exchanges between pairs whose "here" vorton lies in the chunk, into the deltas of that chunk.
+            PSE_STAGE_APPLY         ///< For each vorton, add its deltas from the chunks whose pairs touch it, then dissipate.
+        } ;
+
+        /// Range of vortons, in order of cells, that pairs in one chunk of particle strength exchange can touch.  See ComputePseChunkSlots.
+        struct PseChunkSlots
+        {
+            size_t  mSlotBegin  ;   ///< First slot, i.e. offset into vorton indices sorted by cell, that pairs in this chunk can touch.  See CellList::GetSlotOfItem.
+            size_t  mSlotEnd    ;   ///< One past the last slot that pairs in this chunk can touch.
+            size_t  mDeltaBegin ;   ///< Offset into deltas of the delta for mSlotBegin.
+        } ;
+
+        /// Vorton property that diffusion on the grid changes.  See DiffuseOnGrid.
+        enum GridDiffusionQuantityE
+        {
+            GRID_DIFFUSION_VORTICITY        ,   ///< Vorticity, which diffuses with viscosity.
+            GRID_DIFFUSION_HEAT             ,   ///< Density departure from ambient, which diffuses with thermal diffusivity.
+            NUM_GRID_DIFFUSION_QUANTITIES
+        } ;
+
         void        AssignVortonsFromVorticity( UniformGrid< Vec3 > & vortGrid ) ;
         void        TallyLinearImpulseFromVelocity( Vec3 & linearImpulse ) const ;
         void        TallyDiagnosticIntegrals( Vec3 & vCirculation , Vec3 & vLinearImpulseFromVorticity , Vec3 & vLinearImpulseFromVelocity , Vec3 & vAngularImpulse ) const ;
@@ -465,24 +1007,102 @@ class VortonSim
         void        MakeBaseVortonGrid( NestedGrid< Vorton > & influenceTree ) ;
         void        AggregateClusters( unsigned uParentLayer , NestedGrid< Vorton > & influenceTree ) ;
         void        CreateInfluenceTree( NestedGrid< Vorton > & influenceTree ) ;
+    #if VORTON_SIM_REFIT_INFLUENCE_TREE
+        void        RecordInfluenceTreeOccupancy( const NestedGrid< Vorton > & influenceTree ) ;
+        void        RefitInfluenceTree( NestedGrid< Vorton > & influenceTree ) ;
+    #endif
+
+    #if ENABLE_VORTON_LOD
+        void        ApplyVortonLevelOfDetail() ;
+        float       ComputeLodDistance( const Vec3 & position ) const ;
+        void        MergeVortonsOverBudget( size_t numToMerge ) ;
+        void        SplitVortonsUnderBudget( size_t numToSplit ) ;
+    #endif
+
+    #if ENABLE_VORTON_REMESHING
+        /// Lattice onto which RemeshVortons redistributes vortons.
+        struct RemeshLattice
+        {
+            int         mMinIndices[ 3 ]    ;   ///< Indices of minimal lattice point.  The lattice point with indices i lies at i times mSpacing.
+            unsigned    mNumPoints[ 3 ]     ;   ///< Number of lattice points along each axis.
+            bool        mFlat[ 3 ]          ;   ///< Whether all vortons share one coordinate along each axis, in which case the lattice has one point along that axis, at that coordinate.
+            Vec3        mFlatPosition       ;   ///< Coordinate along each flat axis.
+            float       mSpacing            ;   ///< Distance between adjacent lattice points.
+            float       mVortonRadius       ;   ///< Radius of each vorton.
+            float       mMinAngVelMag2      ;   ///< Squared angular velocity below which to discard a lattice point.
+        } ;
+
+        void        RemeshVortons_Slice( const RemeshLattice & lattice , const CellList & vortonIndicesGrid , size_t izStart , size_t izEnd ) ;
+        void        RemeshVortons() ;
+    #endif
+
+    #if ENABLE_VORTON_SIM_SLEEP
+        bool        UpdateSleepState() ;
+        void        FallAsleep() ;
+    #endif
 
         Vec3        ComputeVectorPotential_Direct( const Vec3 & vPosition ) ;
-        Vec3        ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsigned idxParent[3] , size_t iLayer , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
-        void        ComputeVectorPotentialAtGridpoints_Slice( size_t izStart , size_t izEnd , bool boundariesOnly , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
-        void        ComputeVectorPotentialFromVorticity_Integral( bool boundariesOnly , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        Vec3        ComputeVectorPotential_Tree( const Vec3 & vPosition , const unsigned idxParent[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        Vec3        ComputeVectorPotentialAtPosition( const Vec3 & vPosition , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        void        ComputeVectorPotentialAtGridpoints_Slice( bool boundariesOnly , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t izStart , size_t izEnd ) ;
+        void        ComputeVectorPotentialAtBoundaryNodes_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iNodeBegin , size_t iNodeEnd ) ;
+        void        ComputeBoundaryVectorPotential_Interpolated( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        void        ComputeVectorPotentialFromVorticity_Integral( bool boundariesOnly , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
 
         Vec3        ComputeVelocity_Direct( const Vec3 & vPosition ) ;
-        Vec3        ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned idxParent[3] , size_t iLayer , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        float       MeasureVelocityGridError( size_t numSamples ) ;
+        void        MeasureTreecodeError( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        Vec3        ComputeVelocity_Tree( const Vec3 & vPosition , const unsigned idxParent[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+    #if VORTON_SIM_USE_LINEAR_INFLUENCE_TREE
+        Vec3        ComputeVelocity_LinearTree( const Vec3 & vPosition , size_t iParentNode , size_t iLayer , const CellList & vortonIndicesGrid ) ;
+    #endif
+        Vec3        ComputeVelocity_TreeRoot( const Vec3 & vPosition , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+    #if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+        Vec3        ComputeVelocityAndGradient_Tree( Mat33 & velocityGradient , const Vec3 & vPosition , const unsigned idxParent[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+    #endif
+    #if VORTON_SIM_GROUP_TREE_QUERIES
+        void        ComputeVelocity_TreeGroup( Vec3 velocities[] , const Vec3 positions[] , const unsigned queries[] , size_t numQueries , unsigned subsetScratch[] , size_t scratchStride
+                                             , const unsigned idxParent[3] , size_t iLayer , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+    #endif
         Vec3        ComputeVelocity_Monopoles( const unsigned indices[3] , const Vec3 & vPosition , const NestedGrid< Vorton > & influenceTree ) ;
-        void        ComputeVelocityAtGridpoints_Slice( size_t izStart , size_t izEnd , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
-        void        ComputeVelocityAtVortons_Slice( size_t iPclStart , size_t iPclEnd , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
-        void        ComputeVelocityFromVorticity_Integral( const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+        void        ComputeFmmLocalExpansionsSlice( size_t iLayer , const NestedGrid< Vorton > & influenceTree , size_t izStart , size_t izEnd ) ;
+        void        ComputeFmmLocalExpansions( const NestedGrid< Vorton > & influenceTree ) ;
+        Vec3        ComputeVelocity_Fmm( const Vec3 & vPosition , const unsigned indices[3] , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+    #endif
+        void        ComputeVelocityAtGridpoints_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t izStart , size_t izEnd ) ;
+    #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+        void        FindActiveVelocityGridBlocks( const CellList & vortonIndicesGrid ) ;
+        inline bool IsVelocityGridpointExact( const unsigned indices[3] ) const ;
+        void        InterpolateInactiveVelocityGridBlocks_Slice( size_t izStart , size_t izEnd ) ;
+    #endif
+    #if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+        void        RefineVelocityGrid( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        void        ComputeVelocityAtPatches_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iPatchBegin , size_t iPatchEnd ) ;
+        void        AssignVortonVelocityFromPatches_Slice( size_t iPclBegin , size_t iPclEnd ) ;
+        void        AssignVortonVelocityFromPatches() ;
+    #endif
+        void        ComputeVelocityAtVortons_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iPclStart , size_t iPclEnd ) ;
+    #if VORTON_SIM_GROUP_TREE_QUERIES
+        void        ComputeVelocityAtVortonGroups_Slice( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , size_t iCellStart , size_t iCellEnd ) ;
+    #endif
+        void        ComputeVelocityFromVorticity_Integral( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        void        PartitionVelocityGridSlices( const CellList & vortonIndicesGrid ) ;
+    #if VORTON_SIM_GROUP_TREE_QUERIES
+        void        PartitionVortonGroups( const CellList & vortonIndicesGrid ) ;
+    #endif
 
         // Differential-based velocity-from-vorticity routines
-        void        ComputeVectorPotential( NestedGrid< Vec3 > & vectorPotentialMultiGrid , NestedGrid< Vec3 > & negativeVorticityMultiGrid , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
-        void        ComputeVelocityFromVorticity_Differential( NestedGrid< Vec3 > & negativeVorticityMultiGrid , const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
+        void        ComputeVectorPotential( NestedGrid< Vec3 > & vectorPotentialMultiGrid , NestedGrid< Vec3 > & negativeVorticityMultiGrid , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , bool warmStart ) ;
+        void        ComputeVelocityFromVorticity_Differential( NestedGrid< Vec3 > & negativeVorticityMultiGrid , const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree ) ;
 
-        void        ComputeVelocityFromVorticity( const UniformGrid< VECTOR< unsigned > > & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , NestedGrid< Vec3 > & negativeVorticityMultiGrid ) ;
+        // Hybrid (particle-particle/particle-mesh) velocity-from-vorticity routines
+        void        AddNearFieldVelocity_Slice( const CellList & vortonIndicesGrid , float meshCoreRadius , size_t izStart , size_t izEnd ) ;
+        void        AddNearFieldVelocity( const CellList & vortonIndicesGrid ) ;
+
+        void        ComputeVelocityFromVorticity( const CellList & vortonIndicesGrid , const NestedGrid< Vorton > & influenceTree , NestedGrid< Vec3 > & negativeVorticityMultiGrid ) ;
+        void        SelectVelocityFromVorticityTechnique() ;
+        void        RecordVelocityFromVorticityTrial( float seconds , float error ) ;
 
         void        PopulateVorticityGridFromVortons( UniformGrid< Vec3 > & vorticityGrid , float scale ) ;
 
@@ -491,13 +1111,20 @@ class VortonSim
         void        PopulateVelocityGrid( UniformGrid< Vec3 > & velocityGrid , const VECTOR< Particle > & particles ) ;
         void        PopulateDensityAndMassFractionGrids( UniformGrid< float > & densityGrid , const VECTOR< Particle > & particles , const unsigned uFrame ) ;
         void        PopulateSignedDistanceGridFromDensityGrid( UniformGrid< float > & signedDistanceGrid , const UniformGrid< float > & densityGrid , const unsigned uFrame) ;
+        void        UpdateDensityGradientGrid() ;
+        void        UpdateSignedDistanceGrid() ;
+
+        void        CombustAndSetMassFractionsSlice( float timeStep , size_t iPclStart , size_t iPclEnd ) ;
+        void        CombustAndSetMassFractions( float timeStep ) ;
 
-        inline void CombustAndSetMassFractions( float timeStep , Vorton & rVorton ) ;
+        /// Return whether domain is 2D and has no significant component along the gravity direction, so buoyancy cannot act.
+        bool        IsBuoyancyNegligible() const { return fabsf( mGravAccel * mVelGrid.GetExtent() ) < FLT_EPSILON ; }
 
 #if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
         void        GenerateBaroclinicVorticitySlice( float timeStep , const VECTOR< Vec3 > * densityGradients , size_t izStart , size_t izEnd ) ;
-        void        GenerateBaroclinicVorticity( const float timeStep , const unsigned uFrame , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices ) ;
+        void        GenerateBaroclinicVorticity( const float timeStep , const unsigned uFrame , const CellList & ugVortonIndices ) ;
 #else
+        void        ComputeDensityGradientsAtVortons( Vec3 * densityGradients , size_t iVortonBegin , size_t numVortons ) const ;
         void        GenerateBaroclinicVorticitySlice( float timeStep , size_t izStart , size_t izEnd ) ;
         void        GenerateBaroclinicVorticity( const float timeStep , const unsigned uFrame ) ;
 #endif
@@ -506,30 +1133,66 @@ class VortonSim
 #if USE_UNIFORM_GRID_LINKED_LIST_SPATIAL_PARTITION
                                  SpatialPartition & vortonGrid
 #else
-                                 UniformGrid< VECTOR< unsigned > > & ugVortonIndices
+                                 CellList & ugVortonIndices
 #endif
                                  , float minCellSpacing = 0.0f ) ;
+#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
+        void        UpdateSphNeighborList( float timeStep , unsigned uFrame , float influenceRadius ) ;
+#endif
 
 
-        inline bool ExchangeVorticityOrMergeVortons( const unsigned & rVortIdxHere , Vorton & rVortonHere , Vec3 & rAngVelHere , const unsigned & ivThere , VECTOR< unsigned > & cell , const float & timeStep ) ;
+#if ENABLE_MERGING_VORTONS
+        inline bool ExchangeVorticityOrMergeVortons( const unsigned & rVortIdxHere , Vorton & rVortonHere , Vec3 & rAngVelHere , const unsigned & ivThere , const CellList::Cell & cell , const float & timeStep ) ;
+        void        DiffuseAndMergeVorticityPSESlice( const float & timeStep , const CellList & vortonCellList , const CellBox & box ) ;
+#endif
         void        DiffuseVorticityGlobally( const float & timeStep , const unsigned & uFrame ) ;
-        void        DiffuseAndDissipateVorticityPSESlice( const float & timeStep , UniformGrid< VECTOR< unsigned > > & ugVortRef , size_t izStart , size_t izEnd , PhaseE phase ) ;
-        void        DiffuseAndDissipateVorticityPSE( const float & timeStep , const unsigned & uFrame , UniformGrid< VECTOR< unsigned > > & ugVortonIndices ) ;
+        static size_t GetNumPseChunks( const CellList & vortonCellList ) ;
+        static size_t ComputePseChunkSlots( VECTOR< PseChunkSlots > & chunkSlots , const CellList & vortonCellList , size_t numChunks ) ;
+        void        DiffuseAndDissipateVorticityPSESlice( PseStageE stage , const float & timeStep , const CellList & vortonCellList , size_t numChunks , size_t itemBegin , size_t itemEnd ) ;
+        void        DiffuseAndDissipateVorticityPSE( const float & timeStep , const unsigned & uFrame , const CellList & vortonCellList ) ;
 
+        void        RunUpdateStage( UpdateStageE stage , float timeStep , unsigned uFrame , NestedGrid< Vorton > & influenceTree , VECTOR< Vorton > * originalVortons ) ;
         void        UpdateVortexParticleMethod( float timeStep , unsigned uFrame ) ;
 #if USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
         void        UpdateSmoothedParticleHydrodynamics( float timeStep , unsigned uFrame ) ;
 #endif
 
-        inline void ExchangeHeat( const unsigned & rVortIdxHere , Vorton & rVortonHere , float & rDensityHere , const unsigned & ivThere , const VECTOR< unsigned > & cell , const float & timeStep ) ;
-        void        DiffuseAndDissipateHeatPSESlice( const float & timeStep , const UniformGrid< VECTOR< unsigned > > & ugVortRef , size_t izStart , size_t izEnd , PhaseE phase ) ;
-        void        DiffuseAndDissipateHeatPSE( const float & timeStep , const unsigned & uFrame , const UniformGrid< VECTOR< unsigned > > & ugVortonIndices ) ;
+        void        DiffuseAndDissipateHeatPSESlice( PseStageE stage , const float & timeStep , const CellList & vortonCellList , size_t numChunks , size_t itemBegin , size_t itemEnd ) ;
+        void        DiffuseAndDissipateHeatPSE( const float & timeStep , const unsigned & uFrame , const CellList & vortonCellList ) ;
+
+    #if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+        bool        IsGridDiffusionPreferred( float diffusivity , float timeStep ) const ;
+        void        ApplyGridDiffusion_Slice( GridDiffusionQuantityE quantity , size_t iVortonStart , size_t iVortonEnd ) ;
+        void        DiffuseOnGrid( GridDiffusionQuantityE quantity , float timeStep ) ;
+    #endif
 
         UniformGrid< Vec3 >             mVelGrid                    ;   ///< Uniform grid of velocity values
+        UniformGrid< Vec3 >             mVelGridSnapshot            ;   ///< Copy of mVelGrid that Update publishes when done, for consumers outside this simulation.  See GetVelocityGridSnapshot.
+        UniformGrid< Vec3 >             mVelGridPreviousSnapshot    ;   ///< mVelGridSnapshot as of the previous Update.  See GetPreviousVelocityGridSnapshot.
+    #if VORTON_SIM_USE_VELOCITY_ACTIVITY_MASK
+        float                           mFarFieldTolerance          ;   ///< Relative error allowed in velocity interpolated across blocks far from vortons.  Zero disables interpolation.
+        unsigned                        mNumVelGridBlocks[ 3 ]      ;   ///< Number of blocks of mVelGrid along each axis.
+        VECTOR< unsigned char >         mVelGridBlockIsActive       ;   ///< Whether each block of mVelGrid lies near enough to vortons to need exact velocity at every gridpoint.
+    #endif
+    #if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+        PatchedGrid< Vec3 >             mVelGridPatches             ;   ///< Finer patches of mVelGrid near bodies and strong vorticity.  See RefineVelocityGrid.
+    #endif
 
         NestedGrid< Vec3 >              mVectorPotentialMultiGrid   ;   ///< Nested grid of vector potential values.  Only used for Poisson solver technique that use vector potential.
+        VectorPoissonMultiGridScratch   mPoissonMultiGridScratch    ;   ///< Scratch grids for the multigrid Poisson solver, kept across updates so they reuse their memory.
+    #if VORTON_SIM_WARM_START_POISSON
+        UniformGrid< Vec3 >             mVectorPotentialPrevious    ;   ///< Copy of previous vector potential, from which to resample an initial guess when the grid changed shape.  Kept across updates so it reuses its memory.
+    #endif
+        PoissonSolverE                  mPoissonSolver              ;   ///< Which solver obtains vector potential from vorticity.
+        SpectralPoissonSolver           mSpectralPoissonSolver      ;   ///< Working arrays and transform plans for spectral Poisson solvers, kept across updates.
+        unsigned                        mMaxPoissonIterations       ;   ///< Largest number of iterations of the iterative Poisson solver.  Zero lets the solver choose.
+        float                           mBoundaryInterpolationTolerance ;   ///< Largest relative error of interpolated boundary vector potential.  Zero disables interpolation.
+        unsigned                        mBoundaryInterpolationStride    ;   ///< Spacing, in gridpoints, between boundary gridpoints evaluated directly.  Adapts each update.
+        float                           mBoundaryInterpolationError     ;   ///< Relative error of interpolated boundary vector potential, as of the most recent update.
+        VECTOR< unsigned >              mBoundaryNodeOffsets            ;   ///< Offsets of boundary gridpoints evaluated directly.
+        VECTOR< unsigned >              mBoundaryInterpolatedOffsets    ;   ///< Offsets of boundary gridpoints interpolated from nodes.
 
-        UniformGrid< VECTOR< unsigned > >   mVortonIndicesGrid  ;   ///< Spatial partition of indices into mVortons. Cached for external use.
+        CellList                            mVortonIndicesGrid  ;   ///< Spatial partition of indices into mVortons, updated incrementally across frames. Cached for external use.
 
         /** Effectively scale vorton radius and preserve total circulation.
 
@@ -545,6 +1208,9 @@ class VortonSim
         UniformGrid< float >            mDensityGrid                ;   ///< Uniform grid of density.
         UniformGrid< float >            mSignedDistanceGrid         ;   ///< Uniform grid of signed distance values, for tracking fluid surfaces.
         bool                            mPopulateSdfFromDensity     ;   ///< Whether to populate SDF grid from density grid each timestep.  Useful when using SPH simulation technique and simulation is not tracking SDF from tracers.
+        unsigned                        mDensityGridStamp           ;   ///< Number of times mDensityGrid has been populated.  Grids derived from it record this to tell whether they are stale.
+        unsigned                        mDensityGradientGridStamp   ;   ///< Value of mDensityGridStamp when mDensityGradientGrid was last computed.
+        unsigned                        mSignedDistanceGridStamp    ;   ///< Value of mDensityGridStamp when mSignedDistanceGrid was last populated from density.
 
     #if ENABLE_FIRE
         UniformGrid< float >            mFuelFractionGrid           ;   ///< Uniform grid of fuel fraction values.
@@ -553,6 +1219,7 @@ class VortonSim
     #endif
 
         UniformGridGeometry             mGridTemplate               ;   ///< Geometry of grid used to contain velocity, vorticity, etc.
+        float                           mGridPointsPerVorton        ;   ///< Number of points of mGridTemplate per vorton.
         Vec3                            mMinCorner                  ;   ///< Minimal corner of axis-aligned bounding box
         Vec3                            mMaxCorner                  ;   ///< Maximal corner of axis-aligned bounding box
         Vec3                            mMinCornerEternal           ;   ///< Minimal corner of axis-aligned bounding box, across all time
@@ -567,7 +1234,40 @@ class VortonSim
         Vec3                            mGravAccel                  ;   ///< Acceleration due to gravity
 
         FluidSimulationTechniqueE       mFluidSimTechnique          ;   ///< Fluid simulation technique.
-        //VelocityFromVorticityTechnique  mVelFromVortTechnique       ;   ///< Which technique to obtain velocity from vorticity.
+        BiotSavartKernelE               mBiotSavartKernel           ;   ///< Which kernel evaluates the Biot-Savart law.
+        TreeOpeningCriterion            mTreeOpeningCriterion       ;   ///< Rule by which treecodes decide whether to open clusters.
+        size_t                          mNumTreecodeErrorSamples    ;   ///< Number of gridpoints at which to measure treecode error each update.  Zero disables.
+        TreecodeErrorStatistics         mTreecodeErrorStats         ;   ///< Treecode error that the most recent update measured.
+        float                           mVelocityGridError          ;   ///< Root-mean-square error of the velocity grid, relative to direct summation, that the most recent update measured.
+        IVortonVelocityEvaluator *      mVelocityEvaluator          ;   ///< Optional evaluator of velocity at gridpoints, such as one running on a GPU.  Not owned.
+        VelocityFromVorticityTechniqueE mVelFromVortTechnique       ;   ///< Which technique to obtain velocity from vorticity, possibly VELOCITY_FROM_VORTICITY_AUTO.
+        VelocityFromVorticityTechniqueE mVelFromVortTechniqueInEffect ; ///< Which technique the current update uses.  Never VELOCITY_FROM_VORTICITY_AUTO.
+        float                           mVelocityErrorTarget        ;   ///< Relative velocity error VELOCITY_FROM_VORTICITY_AUTO must meet.
+
+        /** State of VELOCITY_FROM_VORTICITY_AUTO, which tries each candidate technique for a few frames, then keeps the best.
+
+            Candidates are the techniques that precede VELOCITY_FROM_VORTICITY_AUTO.
+            Tuning restarts when the number of vortons or gridpoints changes by more than a factor of sRetuneRatio.
+        */
+        struct VelocityTechniqueTuner
+        {
+            static const unsigned sFramesPerCandidate   = 2 ;   ///< Frames to time each candidate.  Tuning keeps the fastest, so the first frame can include warm-up costs.
+            static const unsigned sRetuneRatio          = 2 ;   ///< Factor by which problem size must change to restart tuning.
+
+            VelocityTechniqueTuner() ;
+
+            void                            Begin( size_t numVortons , size_t numGridpoints ) ;
+            bool                            IsStale( size_t numVortons , size_t numGridpoints ) const ;
+
+            size_t                          mNumVortons                                 ;   ///< Number of vortons when tuning began.  Zero means tuning has not begun.
+            size_t                          mNumGridpoints                              ;   ///< Number of velocity gridpoints when tuning began.
+            unsigned                        mCandidate                                  ;   ///< Candidate the current trial frame uses, or VELOCITY_FROM_VORTICITY_AUTO once tuning is done.
+            unsigned                        mNumFramesOnCandidate                       ;   ///< Number of trial frames candidate has run so far.
+            float                           mSeconds[ VELOCITY_FROM_VORTICITY_AUTO ]    ;   ///< Shortest duration each candidate took, or FLT_MAX if it did not run.
+            float                           mErrors[ VELOCITY_FROM_VORTICITY_AUTO ]     ;   ///< Largest relative velocity error each candidate had.
+            VelocityFromVorticityTechniqueE mChoice                                     ;   ///< Candidate tuning chose.
+        } ;
+        VelocityTechniqueTuner          mVelocityTechniqueTuner     ;   ///< State of VELOCITY_FROM_VORTICITY_AUTO.
 
         bool                            mTallyDiagnosticIntegrals   ;   ///< Whether to tally integrals
         DiagnosticIntegrals             mDiagnosticIntegrals        ;   ///< Integrals that should be invariant.
@@ -577,19 +1277,95 @@ class VortonSim
 
         Stats_Float                     mPoissonResidualStats       ;   ///< Statistics on residuals from SolveVectorPoisson
         Stats_Float                     mPoissonResidualStats_AcrossTime ;   ///< Statistics on residuals from SolveVectorPoisson aggregated across time steps
+        float                           mUpdateStageDurations[ NUM_UPDATE_STAGES ] ;    ///< Wall-clock seconds each stage of the most recent update took.  See GetUpdateStageDuration.
+        Parallel::AffinityPartitioner   mAffinityPartitioners[ NUM_PARALLEL_LOOPS ] ;   ///< Which thread ran which chunk of each parallel loop last update, so chunks revisit warm caches.
+        Parallel::CostPartition         mVelocityGridSlicePartition ;   ///< Split of velocity grid z slices into chunks of roughly equal cost.  See PartitionVelocityGridSlices.
+    #if VORTON_SIM_GROUP_TREE_QUERIES
+        Parallel::CostPartition         mVortonGroupPartition       ;   ///< Split of cell list cells into chunks of roughly equal cost.  See PartitionVortonGroups.
+    #endif
+        VECTOR< float >                 mParallelCosts              ;   ///< Scratch for estimated cost of each item of a parallel loop.  Kept across steps so it reuses its memory.
+
+    #if ENABLE_VORTON_LOD
+        size_t                          mVortonBudget               ;   ///< Maximum number of vortons.  Zero means unlimited.
+        float                           mVelocityStageDurationTarget;   ///< Wall-clock seconds velocity stage should take.  Zero means only mVortonBudget applies.
+        Vec3                            mLodFocus                   ;   ///< Point near which vortons retain detail, such as the camera eye.
+        float                           mLodDetailRadius            ;   ///< Distance from mLodFocus, and from bodies, within which vortons never merge.
+        size_t                          mNumVortonsMerged           ;   ///< Number of merges not yet undone by splitting.  Limits how many vortons split.
+    #endif
+
+    #if ENABLE_VORTON_REMESHING
+        unsigned                        mRemeshPeriod               ;   ///< Number of updates between remeshing vortons.  Zero disables.
+        unsigned                        mNumUpdatesSinceRemesh      ;   ///< Number of updates since vortons last got remeshed.
+        float                           mRemeshVorticityThreshold   ;   ///< Vorticity, as a fraction of that of the strongest vorton, below which remeshing discards lattice points.
+        VECTOR< VECTOR< Vorton > >      mRemeshedVortonSlices       ;   ///< Vortons that each z slice of the remeshing lattice produced.  Kept across steps so it reuses its memory.
+    #endif
+
+    #if ENABLE_VORTON_SIM_SLEEP
+        float                           mSleepVorticityThreshold    ;   ///< Vorticity magnitude below which vortons count as quiescent.  Zero disables sleeping.
+        float                           mSleepSpeedThreshold        ;   ///< Speed below which vortons count as quiescent.
+        unsigned                        mNumQuiescentUpdatesBeforeSleep ;   ///< Number of consecutive quiescent updates after which the simulation falls asleep.
+        unsigned                        mNumQuiescentUpdates        ;   ///< Number of consecutive updates during which all vortons have been quiescent.
+        size_t                          mNumVortonsAsleep           ;   ///< Number of vortons when the simulation fell asleep.  A different number wakes it.
+        bool                            mIsAsleep                   ;   ///< Whether the simulation has fallen asleep.
+    #endif
+
+    #if VORTON_SIM_VELOCITY_PATCHES_IN_EFFECT
+        unsigned                        mMaxVelocityPatches         ;   ///< Maximum number of patches RefineVelocityGrid adds.  Zero disables refinement.
+        unsigned                        mVelocityPatchRefinement    ;   ///< Number of patch cells along each edge of a cell of mVelGrid.
+        float                           mVelocityPatchVorticityFraction ;   ///< Vorticity, as a fraction of the strongest, above which a vorton makes its block get a patch.
+    #endif
+
+    #if VORTON_SIM_IMPLICIT_GRID_DIFFUSION_IN_EFFECT
+        float                           mGridDiffusionThreshold     ;   ///< Diffusion number above which diffusion takes an implicit step on the grid.  See SetGridDiffusionThreshold.
+        NestedGrid< Vec3 >              mGridDiffusionFields[ NUM_GRID_DIFFUSION_QUANTITIES ]   ;   ///< Per quantity, field that DiffuseOnGrid diffuses, then its change.  Separate, so heat and vorticity can diffuse concurrently.
+        NestedGrid< Vec3 >              mGridDiffusionSources[ NUM_GRID_DIFFUSION_QUANTITIES ]  ;   ///< Per quantity, right-hand side of the implicit diffusion equation.
+        VectorPoissonMultiGridScratch   mGridDiffusionScratch[ NUM_GRID_DIFFUSION_QUANTITIES ]  ;   ///< Per quantity, scratch grids for the multigrid solver of the implicit diffusion equation.
+    #endif
+
+    #if VORTON_SIM_GRID_DYE
+        GridDye                         mGridDye                    ;   ///< Dye carried on a grid and advected through mVelGrid.  See GetGridDye.
+    #endif
 
     // Probably none of these exdented members should be members;
     // all should be ephemeral, existing only during an update.
     // In the case of mVortons, probably passed in from outside.
     // As members, they get copied during assignment, which is worse than useless.
     VECTOR< Vorton > *                  mVortons                    ;   ///< Dynamic array of tiny vortex elements
+    #if USE_VORTON_SOA
+    VortonSoa                           mVortonSoa                  ;   ///< Structure-of-arrays copy of hot members of mVortons, used inside bandwidth-limited loops.
+    #endif
+    VECTOR< Vec3 >                      mPseVorticityDeltas         ;   ///< Per chunk of cells, then per slot in mPseVorticityChunkSlots, vorticity that PSE pairs in that chunk exchanged.  See DiffuseAndDissipateVorticityPSE.
+    VECTOR< PseChunkSlots >             mPseVorticityChunkSlots     ;   ///< Per chunk of cells, range of slots that mPseVorticityDeltas holds for that chunk.
+    VECTOR< float >                     mPseDensityDeltas           ;   ///< Per chunk of cells, then per slot in mPseDensityChunkSlots, density that PSE pairs in that chunk exchanged.  See DiffuseAndDissipateHeatPSE.
+    VECTOR< PseChunkSlots >             mPseDensityChunkSlots       ;   ///< Per chunk of cells, range of slots that mPseDensityDeltas holds for that chunk.  Separate from mPseVorticityChunkSlots since heat and vorticity diffuse concurrently.
+    #if VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+    NestedGrid< VortonFmmLocalExpansion > mFmmLocalExpansions       ;   ///< Local expansions of velocity.  Layer i corresponds to layer i+1 of the influence tree.
+    #endif
     NestedGrid< Vec3 >                  mNegativeVorticityMultiGrid         ;   ///< Multi-resolution grid populated with vorticity from vortons
+    NestedGrid< Vorton >                mInfluenceTree              ;   ///< Tree of vorton clusters that UpdateVortexParticleMethod rebuilds each step.  Kept across steps so its layers reuse their memory.
+    #if VORTON_SIM_USE_LINEAR_INFLUENCE_TREE
+    LinearInfluenceTree                 mLinearInfluenceTree        ;   ///< Compact copy of mInfluenceTree that ComputeVelocity_LinearTree traverses.  Rebuilt with mInfluenceTree.
+    #endif
+    #if VORTON_SIM_REFIT_INFLUENCE_TREE
+    VECTOR< VECTOR< unsigned > >        mInfluenceTreeOccupiedCells ;   ///< For each layer of mInfluenceTree, offsets of cells that contain vortons.  See RefitInfluenceTree.
+    #endif
+    UniformGrid< VortonClusterAux >     mVortonClusterAuxGrid       ;   ///< Scratch for MakeBaseVortonGrid.  Kept across steps so it reuses its memory.
+    UniformGrid< int >                  mSdfPinnedGrid              ;   ///< Scratch for PopulateSignedDistanceGridFromDensityGrid.  Kept across steps so it reuses its memory.
     UniformGrid< Vec3 >                 mDensityGradientGrid        ;   ///< Uniform grid of density gradient values
     VECTOR< float >                     mVortonBodyProximities      ;   ///< Proximities (partially truncated signed distance) of vortons to body walls.
+    #if VORTON_SIM_TREE_VELOCITY_GRADIENT_IN_EFFECT
+    VECTOR< Mat33 >                     mVelocityGradientsAtVortons ;   ///< Velocity gradient at each vorton, from the treecode, or empty if this update did not compute it.  See VORTON_SIM_TREE_VELOCITY_GRADIENT.
+    #endif
 
     #if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
         VECTOR< SphFluidDensities >     mFluidDensitiesAtPcls   ;
         VECTOR< Vec3 >                  mDensityGradientsAtPcls ;
+        SphNeighborList                 mSphNeighborList        ;   ///< Candidate neighbor pairs of vortons, reused across steps until vortons move too far.  See UpdateSphNeighborList.
+    #if USE_SPATIAL_HASH_FOR_SPH_NEIGHBORS
+        SpatialHash                     mSphVortonHash          ;   ///< Spatial partition of indices into mVortons, with cells of fixed size, that UpdateSphNeighborList rebuilds mSphNeighborList from.
+    #else
+        CellList                        mSphVortonIndicesGrid   ;   ///< Spatial partition of indices into mVortons, with cells sized for SPH, that UpdateSphNeighborList rebuilds mSphNeighborList from.  Kept across steps so Partition reuses its memory and moves only vortons that changed cells.
+    #endif
     #endif
 
     #if COMPUTE_PRESSURE_GRADIENT
@@ -612,21 +1388,14 @@ class VortonSim
         bool                            mOutputDiagnostics      ;   ///< Whether to output diagnostic info
     #endif
 
-    #if USE_TBB
-        friend class VortonSim_ComputeVectorPotentialAtGridpoints_TBB   ; ///< Multi-threading helper class for computing vector potential at gridpoints.
-        friend class VortonSim_ComputeVelocityAtGridpoints_TBB          ; ///< Multi-threading helper class for computing velocity at gridpoints.
-        friend class VortonSim_ComputeVelocityAtVortons_TBB             ; ///< Multi-threading helper class for computing velocity at vortons.
-        friend class VortonSim_GenerateBaroclinicVorticity_TBB          ; ///< Multi-threading helper class for computing fluid buoyancy.
-        friend class VortonSim_DiffuseVorticityPSE_TBB                  ; ///< Multi-threading helper class for computing vorticity diffusion.
-        friend class VortonSim_DiffuseHeatPSE_TBB                       ; ///< Multi-threading helper class for computing heat diffusion.
-    #endif
+        friend class VortonSim_UpdateStage_Task                         ; ///< Task graph node that runs one stage of UpdateVortexParticleMethod.
 } ;
 
 // Public variables --------------------------------------------------------------
 // Public functions --------------------------------------------------------------
 
 #if COMPUTE_DENSITY_GRADIENT_AT_AND_WITH_VORTONS
-    extern void ComputeDensityGradientFromVortons( VECTOR< Vec3 > & densityGradient , const UniformGrid< VECTOR< unsigned > > & pclIndicesGrid , const VECTOR< Vorton > & vortons ) ;
+    extern void ComputeDensityGradientFromVortons( VECTOR< Vec3 > & densityGradient , const CellList & pclIndicesGrid , const VECTOR< Vorton > & vortons ) ;
 #endif
 
 #endif
@@ -0,0 +1,282 @@
+/** \file vortonSimd.h
+
+    \brief Biot-Savart velocity kernel that evaluates several vortons at a time.
+
+    \see VORTON_ACCUMULATE_VELOCITY_private, which is the scalar equivalent.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef VORTON_SIMD_H
+#define VORTON_SIMD_H
+
+#include "Core/Math/vec3x4.h"
+
+#include "vorton.h"
+
+#include "Kernels/fluidKernels.h"
+
+// Macros --------------------------------------------------------------
+
+/// Number of source vortons each kernel invocation evaluates.
+static const unsigned VORTON_SIMD_WIDTH = Float4::WIDTH ;
+
+// Types --------------------------------------------------------------
+
+/** Small structure-of-arrays buffer of source vortons (or supervortons) awaiting evaluation by the SIMD kernel.
+
+    Callers Add sources as they encounter them (for example while traversing
+    the influence tree) and the batch flushes itself through the SIMD kernel
+    whenever it fills.  Callers must call Flush once after the last Add.
+*/
+class VortonSourceBatch
+{
+    public:
+        static const unsigned CAPACITY = 2 * VORTON_SIMD_WIDTH ;
+
+        VortonSourceBatch( float spreadingRangeFactor , float spreadingCirculationFactor )
+            : mSpreadingRangeFactor( spreadingRangeFactor )
+            , mSpreadingCirculationFactor( spreadingCirculationFactor )
+            , mCount( 0 )
+        {}
+
+        inline void Add( Vec3 & vVelocity , const Vec3 & vPosQuery , const Vec3 & position , const Vec3 & angularVelocity , float size ) ;
+        inline void Flush( Vec3 & vVelocity , const Vec3 & vPosQuery ) ;
+
+    private:
+        VortonSourceBatch & operator=( const VortonSourceBatch & ) ; // Disallow assignment.
+
+        float           mPx[ CAPACITY ] ;   ///< x-components of source positions.
+        float           mPy[ CAPACITY ] ;   ///< y-components of source positions.
+        float           mPz[ CAPACITY ] ;   ///< z-components of source positions.
+        float           mWx[ CAPACITY ] ;   ///< x-components of source angular velocities.
+        float           mWy[ CAPACITY ] ;   ///< y-components of source angular velocities.
+        float           mWz[ CAPACITY ] ;   ///< z-components of source angular velocities.
+        float           mSize[ CAPACITY ] ; ///< Source diameters.
+        const float     mSpreadingRangeFactor       ;
+        const float     mSpreadingCirculationFactor ;
+        unsigned        mCount ;            ///< Number of sources currently in batch.
+} ;
+
+
+
+
+/** Small structure-of-arrays buffer of source vortons whose influence accumulates into each of a group of query points.
+
+    This resembles VortonSourceBatch, except that each flush accumulates
+    velocity at every query in the group, so a traversal that treats several
+    queries alike gathers each source once, and every query then reads the
+    same contiguous sources.  Callers must call Flush once after the last Add.
+*/
+class VortonSourceGroupBatch
+{
+    public:
+        static const unsigned CAPACITY = VortonSourceBatch::CAPACITY ;
+
+        VortonSourceGroupBatch( float spreadingRangeFactor , float spreadingCirculationFactor , bool useSimdKernel , const FluidKernelTable * ispcKernels
+                              , Vec3 * velocities , const Vec3 * positions , const unsigned * queries , size_t numQueries )
+            : mSpreadingRangeFactor( spreadingRangeFactor )
+            , mSpreadingCirculationFactor( spreadingCirculationFactor )
+            , mUseSimdKernel( useSimdKernel )
+            , mIspcKernels( ispcKernels )
+            , mVelocities( velocities )
+            , mPositions( positions )
+            , mQueries( queries )
+            , mNumQueries( numQueries )
+            , mCount( 0 )
+        {}
+
+        inline void Add( const Vec3 & position , const Vec3 & angularVelocity , float size ) ;
+        inline void Flush() ;
+
+    private:
+        VortonSourceGroupBatch & operator=( const VortonSourceGroupBatch & ) ; // Disallow assignment.
+
+        float               mPx[ CAPACITY ] ;   ///< x-components of source positions.
+        float               mPy[ CAPACITY ] ;   ///< y-components of source positions.
+        float               mPz[ CAPACITY ] ;   ///< z-components of source positions.
+        float               mWx[ CAPACITY ] ;   ///< x-components of source angular velocities.
+        float               mWy[ CAPACITY ] ;   ///< y-components of source angular velocities.
+        float               mWz[ CAPACITY ] ;   ///< z-components of source angular velocities.
+        float               mSize[ CAPACITY ] ; ///< Source diameters.
+        const float         mSpreadingRangeFactor       ;
+        const float         mSpreadingCirculationFactor ;
+        const bool          mUseSimdKernel  ;   ///< Whether to evaluate sources with the SIMD kernel, otherwise with the scalar kernel.
+        const FluidKernelTable * const mIspcKernels ;   ///< ISPC kernels, which take precedence over mUseSimdKernel, or NULL to use C++ kernels.
+        Vec3 * const        mVelocities     ;   ///< Velocity accumulators, indexed by elements of mQueries.
+        const Vec3 * const  mPositions      ;   ///< Query positions, indexed by elements of mQueries.
+        const unsigned *    mQueries        ;   ///< Indices, into mVelocities and mPositions, of queries in group.
+        const size_t        mNumQueries     ;   ///< Number of queries in group.
+        unsigned            mCount          ;   ///< Number of sources currently in batch.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+/** Accumulate velocity induced at vPosQuery by VORTON_SIMD_WIDTH source vortons.
+
+    \param vVelocity    (in/out) Velocity accumulator.
+
+    \param vPosQuery    Position at which to compute velocity.
+
+    \param px,py,pz     Arrays of VORTON_SIMD_WIDTH source position components.
+
+    \param wx,wy,wz     Arrays of VORTON_SIMD_WIDTH source angular velocity components.
+
+    \param size         Array of VORTON_SIMD_WIDTH source diameters.
+
+    This computes the same formula as VORTON_ACCUMULATE_VELOCITY_private
+    except that it selects the inside-core versus outside-core distance law
+    with a mask (a "blend") rather than a branch, so all lanes execute
+    the same instructions.  The arrays need not be aligned.
+*/
+inline void VortonAccumulateVelocity_Simd( Vec3 & vVelocity , const Vec3 & vPosQuery
+                                         , const float * px , const float * py , const float * pz
+                                         , const float * wx , const float * wy , const float * wz
+                                         , const float * size
+                                         , float spreadingRangeFactor , float spreadingCirculationFactor )
+{
+    const Float4    radius      = Float4::Load( size ) * Float4( 0.5f * spreadingRangeFactor ) ;
+    const Float4    radius2     = radius * radius ;
+    const Float4    radius3     = radius2 * radius ;
+    const Vec3x4    vOtherToSelf= Vec3x4( vPosQuery ) - Vec3x4::Load( px , py , pz ) ;
+    const Float4    dist2       = vOtherToSelf.Mag2() ;
+    // Outside vortex core: 1/dist^3.
+    const Float4    rsqrt       = dist2.InvSqrt() ;
+    const Float4    lawOutside  = rsqrt * rsqrt * rsqrt ;
+    // Inside vortex core: 1/radius^3.
+    const Float4    lawInside   = Float4( 1.0f ) / radius3 ;
+    // Blend instead of branch.  Masked-out lanes can hold inf; selection discards them.
+    const Float4    distLaw     = Float4::Select( dist2.LessThan( radius2 ) , lawInside , lawOutside ) ;
+    const Float4    coefficient = radius3 * distLaw * Float4( TwoThirds * spreadingCirculationFactor ) ;
+    const Vec3x4    angVel      = Vec3x4::Load( wx , wy , wz ) ;
+    vVelocity += ( ( angVel ^ vOtherToSelf ) * coefficient ).HorizontalSum() ;
+}
+
+
+
+
+/** Accumulate velocity induced at vPosQuery by an arbitrary number of source vortons stored as a structure of arrays.
+
+    Sources beyond the last full group of VORTON_SIMD_WIDTH use the scalar kernel.
+*/
+inline void VortonAccumulateVelocity_SimdArray( Vec3 & vVelocity , const Vec3 & vPosQuery
+                                              , const float * px , const float * py , const float * pz
+                                              , const float * wx , const float * wy , const float * wz
+                                              , const float * size , size_t numSources
+                                              , float spreadingRangeFactor , float spreadingCirculationFactor )
+{
+    const size_t numGroups  = numSources / VORTON_SIMD_WIDTH ;
+    const size_t numInGroups= numGroups * VORTON_SIMD_WIDTH ;
+    for( size_t iSource = 0 ; iSource < numInGroups ; iSource += VORTON_SIMD_WIDTH )
+    {   // For each group of sources...
+        VortonAccumulateVelocity_Simd( vVelocity , vPosQuery
+                                     , px + iSource , py + iSource , pz + iSource
+                                     , wx + iSource , wy + iSource , wz + iSource
+                                     , size + iSource
+                                     , spreadingRangeFactor , spreadingCirculationFactor ) ;
+    }
+    for( size_t iSource = numInGroups ; iSource < numSources ; ++ iSource )
+    {   // For each remaining source...
+        const Vec3 position( px[ iSource ] , py[ iSource ] , pz[ iSource ] ) ;
+        const Vec3 angVel( wx[ iSource ] , wy[ iSource ] , wz[ iSource ] ) ;
+        VORTON_ACCUMULATE_VELOCITY_private( vVelocity , vPosQuery , position , angVel , size[ iSource ] , spreadingRangeFactor , spreadingCirculationFactor ) ;
+    }
+}
+
+
+
+
+/** Add a source to the batch, flushing the batch into vVelocity if it becomes full.
+*/
+inline void VortonSourceBatch::Add( Vec3 & vVelocity , const Vec3 & vPosQuery , const Vec3 & position , const Vec3 & angularVelocity , float size )
+{
+    ASSERT( mCount < CAPACITY ) ;
+    mPx[ mCount ]   = position.x ;
+    mPy[ mCount ]   = position.y ;
+    mPz[ mCount ]   = position.z ;
+    mWx[ mCount ]   = angularVelocity.x ;
+    mWy[ mCount ]   = angularVelocity.y ;
+    mWz[ mCount ]   = angularVelocity.z ;
+    mSize[ mCount ] = size ;
+    ++ mCount ;
+    if( CAPACITY == mCount )
+    {
+        Flush( vVelocity , vPosQuery ) ;
+    }
+}
+
+
+
+
+/** Accumulate velocity due to all sources in batch, then empty the batch.
+*/
+inline void VortonSourceBatch::Flush( Vec3 & vVelocity , const Vec3 & vPosQuery )
+{
+    VortonAccumulateVelocity_SimdArray( vVelocity , vPosQuery , mPx , mPy , mPz , mWx , mWy , mWz , mSize , mCount , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+    mCount = 0 ;
+}
+
+
+
+
+/** Add a source to the batch, flushing the batch into every query if it becomes full.
+*/
+inline void VortonSourceGroupBatch::Add( const Vec3 & position , const Vec3 & angularVelocity , float size )
+{
+    ASSERT( mCount < CAPACITY ) ;
+    mPx[ mCount ]   = position.x ;
+    mPy[ mCount ]   = position.y ;
+    mPz[ mCount ]   = position.z ;
+    mWx[ mCount ]   = angularVelocity.x ;
+    mWy[ mCount ]   = angularVelocity.y ;
+    mWz[ mCount ]   = angularVelocity.z ;
+    mSize[ mCount ] = size ;
+    ++ mCount ;
+    if( CAPACITY == mCount )
+    {
+        Flush() ;
+    }
+}
+
+
+
+
+/** Accumulate velocity due to all sources in batch at every query in group, then empty the batch.
+*/
+inline void VortonSourceGroupBatch::Flush()
+{
+    if( mIspcKernels != NULL )
+    {   // Evaluate all queries in one call, vectorized across queries.
+        ASSERT( sizeof( Vec3 ) % sizeof( float ) == 0 ) ;
+        mIspcKernels->mAccumulateVortonVelocity( reinterpret_cast< float * >( mVelocities ) , reinterpret_cast< const float * >( mPositions ) , int( sizeof( Vec3 ) / sizeof( float ) )
+                                               , mQueries , int( mNumQueries )
+                                               , mPx , mPy , mPz , mWx , mWy , mWz , mSize , int( mCount )
+                                               , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+        mCount = 0 ;
+        return ;
+    }
+    for( size_t iQuery = 0 ; iQuery < mNumQueries ; ++ iQuery )
+    {   // For each query in group...
+        const unsigned &    idxQuery    = mQueries[ iQuery ] ;
+        Vec3 &              vVelocity   = mVelocities[ idxQuery ] ;
+        const Vec3 &        vPosQuery   = mPositions[ idxQuery ] ;
+        if( mUseSimdKernel )
+        {
+            VortonAccumulateVelocity_SimdArray( vVelocity , vPosQuery , mPx , mPy , mPz , mWx , mWy , mWz , mSize , mCount , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+        }
+        else
+        {
+            for( unsigned iSource = 0 ; iSource < mCount ; ++ iSource )
+            {   // For each source in batch...
+                const Vec3 position( mPx[ iSource ] , mPy[ iSource ] , mPz[ iSource ] ) ;
+                const Vec3 angVel( mWx[ iSource ] , mWy[ iSource ] , mWz[ iSource ] ) ;
+                VORTON_ACCUMULATE_VELOCITY_private( vVelocity , vPosQuery , position , angVel , mSize[ iSource ] , mSpreadingRangeFactor , mSpreadingCirculationFactor ) ;
+            }
+        }
+    }
+    mCount = 0 ;
+}
+
+#endif
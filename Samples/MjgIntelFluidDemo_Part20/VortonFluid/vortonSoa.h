@@ -0,0 +1,201 @@
+/** \file vortonSoa.h
+
+    \brief Structure-of-arrays representation of vortons, for bandwidth-limited inner loops.
+
+    \see http://www.mijagourlay.com/
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+*/
+#ifndef VORTON_SOA_H
+#define VORTON_SOA_H
+
+#include <string.h>
+
+#include "Core/Containers/vector.h"
+
+#include "vorton.h"
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Dynamic array of floats whose first element lies on a 16-byte boundary.
+
+    This over-allocates a VECTOR< float > and offsets into it, so that it
+    needs no platform-specific aligned allocator.
+*/
+class AlignedFloatArray
+{
+    public:
+        AlignedFloatArray() : mData( 0 ) , mSize( 0 ) {}
+
+        // Use compiler-generated destructor.
+
+        /** Copy an aligned array.  The copy must recompute its own aligned base pointer.
+        */
+        AlignedFloatArray( const AlignedFloatArray & that )
+            : mData( 0 )
+            , mSize( 0 )
+        {
+            Resize( that.mSize ) ;
+            memcpy( mData , that.mData , mSize * sizeof( float ) ) ;
+        }
+
+        AlignedFloatArray & operator=( const AlignedFloatArray & that )
+        {
+            if( this != & that )
+            {
+                Resize( that.mSize ) ;
+                memcpy( mData , that.mData , mSize * sizeof( float ) ) ;
+            }
+            return * this ;
+        }
+
+        /** Change number of elements in this array.
+
+            \note Existing contents are not preserved.
+        */
+        void Resize( size_t numElements )
+        {
+            mStorage.Resize( numElements + ALIGNMENT_IN_FLOATS ) ;
+            const size_t address = reinterpret_cast< size_t >( & mStorage[ 0 ] ) ;
+            mData = reinterpret_cast< float * >( ( address + ALIGNMENT_IN_BYTES - 1 ) & ~ size_t( ALIGNMENT_IN_BYTES - 1 ) ) ;
+            mSize = numElements ;
+        }
+
+        size_t          Size() const                        { return mSize ; }
+        float *         Data()                              { return mData ; }
+        const float *   Data() const                        { return mData ; }
+        float &         operator[]( size_t index )          { ASSERT( index < mSize ) ; return mData[ index ] ; }
+        const float &   operator[]( size_t index ) const    { ASSERT( index < mSize ) ; return mData[ index ] ; }
+
+    private:
+        static const size_t ALIGNMENT_IN_BYTES  = 16 ;
+        static const size_t ALIGNMENT_IN_FLOATS = ALIGNMENT_IN_BYTES / sizeof( float ) ;
+
+        VECTOR< float > mStorage    ;   ///< Underlying storage, over-allocated to allow alignment.
+        float *         mData       ;   ///< Address of first aligned element within mStorage.
+        size_t          mSize       ;   ///< Number of usable elements.
+} ;
+
+
+
+
+/** Structure-of-arrays copy of the members of a VECTOR< Vorton > that the
+    hottest VortonSim loops access.
+
+    A Vorton derives from Particle, which carries many members (orientation,
+    birth time, fire fractions, diagnostics) that routines such as velocity
+    evaluation, particle strength exchange and stretching never touch.
+    Iterating over an array of those fat records wastes most of each cache
+    line loaded.  This container holds only position, vorticity, size and
+    density, each in its own contiguous, aligned array.
+
+    Usage is gather-compute-scatter: Gather copies from the AoS vortons,
+    the routine reads and modifies the SoA arrays, then Scatter* copies
+    modified members back so that Particle-based operations see the results.
+*/
+class VortonSoa
+{
+    public:
+        VortonSoa() : mNumVortons( 0 ) {}
+
+        /** Copy hot members from the given vortons into this structure-of-arrays.
+        */
+        void Gather( const VECTOR< Vorton > & vortons )
+        {
+            const size_t numVortons = vortons.Size() ;
+            if( numVortons != mNumVortons )
+            {
+                mPositionX.Resize( numVortons ) ;
+                mPositionY.Resize( numVortons ) ;
+                mPositionZ.Resize( numVortons ) ;
+                mVorticityX.Resize( numVortons ) ;
+                mVorticityY.Resize( numVortons ) ;
+                mVorticityZ.Resize( numVortons ) ;
+                mSize.Resize( numVortons ) ;
+                mDensity.Resize( numVortons ) ;
+                mIsAlive.Resize( numVortons ) ;
+                mNumVortons = numVortons ;
+            }
+            for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+            {   // For each vorton...
+                const Vorton & rVorton = vortons[ iVorton ] ;
+                mPositionX [ iVorton ] = rVorton.mPosition.x ;
+                mPositionY [ iVorton ] = rVorton.mPosition.y ;
+                mPositionZ [ iVorton ] = rVorton.mPosition.z ;
+                // Store angular velocity, not vorticity, since that is what PSE and stretching modify.
+                mVorticityX[ iVorton ] = rVorton.mAngularVelocity.x ;
+                mVorticityY[ iVorton ] = rVorton.mAngularVelocity.y ;
+                mVorticityZ[ iVorton ] = rVorton.mAngularVelocity.z ;
+                mSize      [ iVorton ] = rVorton.mSize ;
+                mDensity   [ iVorton ] = rVorton.mDensity ;
+                mIsAlive   [ iVorton ] = rVorton.IsAlive() ? 1 : 0 ;
+            }
+        }
+
+
+        /** Copy angular velocity from this structure-of-arrays back into the given vortons.
+        */
+        void ScatterAngularVelocity( VECTOR< Vorton > & vortons ) const
+        {
+            ASSERT( vortons.Size() == mNumVortons ) ;
+            for( size_t iVorton = 0 ; iVorton < mNumVortons ; ++ iVorton )
+            {   // For each vorton...
+                Vorton & rVorton = vortons[ iVorton ] ;
+                rVorton.mAngularVelocity.x = mVorticityX[ iVorton ] ;
+                rVorton.mAngularVelocity.y = mVorticityY[ iVorton ] ;
+                rVorton.mAngularVelocity.z = mVorticityZ[ iVorton ] ;
+            }
+        }
+
+
+        /** Copy density from this structure-of-arrays back into the given vortons.
+        */
+        void ScatterDensity( VECTOR< Vorton > & vortons ) const
+        {
+            ASSERT( vortons.Size() == mNumVortons ) ;
+            for( size_t iVorton = 0 ; iVorton < mNumVortons ; ++ iVorton )
+            {   // For each vorton...
+                vortons[ iVorton ].mDensity = mDensity[ iVorton ] ;
+            }
+        }
+
+
+        size_t  Size() const                                { return mNumVortons ; }
+        bool    IsAlive( size_t iVorton ) const             { return mIsAlive[ iVorton ] != 0.0f ; }
+
+        Vec3    GetPosition( size_t iVorton ) const
+        {
+            return Vec3( mPositionX[ iVorton ] , mPositionY[ iVorton ] , mPositionZ[ iVorton ] ) ;
+        }
+
+        Vec3    GetAngularVelocity( size_t iVorton ) const
+        {
+            return Vec3( mVorticityX[ iVorton ] , mVorticityY[ iVorton ] , mVorticityZ[ iVorton ] ) ;
+        }
+
+        void    SetAngularVelocity( size_t iVorton , const Vec3 & angVel )
+        {
+            mVorticityX[ iVorton ] = angVel.x ;
+            mVorticityY[ iVorton ] = angVel.y ;
+            mVorticityZ[ iVorton ] = angVel.z ;
+        }
+
+        AlignedFloatArray   mPositionX  ;   ///< x-components of vorton positions.
+        AlignedFloatArray   mPositionY  ;   ///< y-components of vorton positions.
+        AlignedFloatArray   mPositionZ  ;   ///< z-components of vorton positions.
+        AlignedFloatArray   mVorticityX ;   ///< x-components of vorton angular velocities.
+        AlignedFloatArray   mVorticityY ;   ///< y-components of vorton angular velocities.
+        AlignedFloatArray   mVorticityZ ;   ///< z-components of vorton angular velocities.
+        AlignedFloatArray   mSize       ;   ///< Vorton diameters.
+        AlignedFloatArray   mDensity    ;   ///< Vorton densities.
+        AlignedFloatArray   mIsAlive    ;   ///< 1 where vorton is alive, 0 where it has been marked dead.
+
+    private:
+        size_t              mNumVortons ;   ///< Number of vortons most recently gathered.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,630 @@
+/** \file benchmark.cpp
+
+    \brief Headless benchmark that runs stock scenarios for a fixed number of frames and reports timings.
+
+    Run "VorteGrid -benchmark" to simulate each stock scenario without a
+    window, at each of several thread counts, then report per-stage timings,
+    throughput and speed-up as CSV, one row per scenario and thread count.
+    Options:
+
+        -frames N           Simulate N frames per scenario.
+        -scenarios a,b,...  Run the given initial conditions (see InteSiVis::InitialConditions).
+        -threads a,b,...    Run with the given thread counts.  The first is the basis for speed-up.
+        -theta a,b,...      Run with the given treecode opening angles.  "off" disables the angle test.
+        -tolerance e        Open treecode clusters whose estimated velocity error exceeds e.
+        -techniques a,b,... Run with the given velocity-from-vorticity techniques (direct, tree, poisson, p3m, auto), or "all".
+        -errorsamples N     Compare treecode against direct summation at N gridpoints, in the final frame.
+        -out filename       Write CSV to the given file instead of stdout.
+        -perfout filename   Save per-frame statistics of each PerfBlock, per run, as a baseline.
+        -perfbaseline file  Compare per-frame PerfBlock statistics against a baseline that -perfout saved.
+        -perfreport file    Write that comparison to the given file instead of stderr.
+        -regression f       Count blocks that slow by more than fraction f (default 0.05) as regressions.
+        -replay filename    Run the scenario of the given input recording, and replay its input.
+
+    Each scenario seeds the pseudo-random number generator identically and
+    uses a fixed time step, so runs are repeatable and comparable across builds.
+
+    With -replay, the benchmark reproduces an interactive session that
+    INTE_SI_VIS_RECORD_INPUT recorded: it applies each recorded key and
+    mouse event after the same number of steps as in the session, so
+    profiling options examine exactly what happened then.  Display settings
+    that persist across scenarios, such as diagnostic text, start from their
+    defaults rather than from what they were when recording began.
+
+    Each row also reports treecode velocity error, relative to direct
+    summation, so sweeping -theta charts each scenario's error against time,
+    from which to pick its opening criterion.
+
+    Earlier parts of this series each hard-wired one technique to obtain
+    velocity from vorticity:  direct summation, then a treecode, then a
+    Poisson solver with multigrid.  VortonSim still implements each of those,
+    selectable at run time, so "-scenarios 0,1 -techniques all" compares
+    them on the same vortex ring and jet, and each row reports the error of
+    the velocity grid relative to direct summation, whichever technique
+    populated it.  Rows of one technique across builds then serve as a
+    baseline against which to catch regressions.
+
+    With -perfbaseline, the benchmark also serves as a performance gate:
+    it reports, per block and run, how mean duration per frame changed and
+    whether that change exceeds frame-to-frame noise, then exits with code
+    2 if any block regressed.  See PerfBaseline::Compare.  The PerfBlock
+    options require a PROFILE build.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "benchmark.h"
+
+#include "inteSiVis.h"
+
+#include "inputRecording.h"
+
+#include "Core/parallelExecution.h"
+#include "Core/Performance/perfBaseline.h"
+#include "Core/Performance/perfBlock.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+/// Scenarios to run by default: vortex ring, jet, large flame and sloshing box of fluid.
+static const unsigned sDefaultScenarios[] = { 0 , 1 , 18 , 28 } ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+BenchmarkScenarioResult::BenchmarkScenarioResult()
+    : mScenario( 0 )
+    , mNumThreads( 0 )
+    , mNumFrames( 0 )
+    , mSecondsTotal( 0.0 )
+    , mSecondsParticleSystems( 0.0 )
+    , mSecondsRigidBodies( 0.0 )
+    , mNumVortonsSum( 0.0 )
+    , mNumTracersSum( 0.0 )
+    , mVelocityTechnique( VortonSim::VELOCITY_FROM_VORTICITY_NUM )
+    , mVelocityGridError( -1.0f )
+{
+    memset( mSecondsUpdateStages , 0 , sizeof( mSecondsUpdateStages ) ) ;
+}
+
+
+
+
+/** Construct settings for the default benchmark.
+
+    By default, thread counts double from 1 up to the number of processors.
+*/
+BenchmarkSettings::BenchmarkSettings()
+    : mNumFrames( sDefaultNumFrames )
+    , mScenarios( sDefaultScenarios , sDefaultScenarios + sizeof( sDefaultScenarios ) / sizeof( sDefaultScenarios[ 0 ] ) )
+    , mTreeErrorTolerance( FLT_MAX )
+    , mNumErrorSamples( sDefaultNumErrorSamples )
+    , mOutputFilename( NULLPTR )
+    , mPerfOutFilename( NULLPTR )
+    , mPerfBaseFilename( NULLPTR )
+    , mPerfReportFilename( NULLPTR )
+    , mRegressionLimit( 0.05 )
+    , mReplayFilename( NULLPTR )
+{
+    mTreeOpeningAngles.PushBack( FLT_MAX ) ;   // By default, use only the original cell-adjacency rule.
+
+    const unsigned numProcessors = Parallel::GetNumThreads() ;
+    for( unsigned numThreads = 1 ; numThreads < numProcessors ; numThreads *= 2 )
+    {   // For each power of 2 less than the number of processors...
+        mThreadCounts.PushBack( numThreads ) ;
+    }
+    mThreadCounts.PushBack( numProcessors ) ;
+}
+
+
+
+
+/** Parse a comma-separated list of unsigned integers.
+
+    \return Whether the list contained at least one value.
+*/
+static bool ParseUnsignedList( VECTOR< unsigned > & values , const char * strList )
+{
+    values.Clear() ;
+    const char * cursor = strList ;
+    while( * cursor != '\0' )
+    {   // For each value in the list...
+        char * end = NULLPTR ;
+        const unsigned long value = strtoul( cursor , & end , 10 ) ;
+        if( end == cursor )
+        {   // Not a number.
+            return false ;
+        }
+        values.PushBack( unsigned( value ) ) ;
+        cursor = ( ',' == * end ) ? end + 1 : end ;
+    }
+    return ! values.Empty() ;
+}
+
+
+
+
+/** Parse a comma-separated list of treecode opening angles, where "off" means FLT_MAX.
+
+    \return Whether the list contained at least one value.
+*/
+static bool ParseOpeningAngleList( VECTOR< float > & values , const char * strList )
+{
+    values.Clear() ;
+    const char * cursor = strList ;
+    while( * cursor != '\0' )
+    {   // For each value in the list...
+        char * end = NULLPTR ;
+        float value = FLT_MAX ;
+        if( 0 == strncmp( cursor , "off" , 3 ) )
+        {
+            end = const_cast< char * >( cursor + 3 ) ;
+        }
+        else
+        {
+            value = float( strtod( cursor , & end ) ) ;
+            if( ( end == cursor ) || ( value <= 0.0f ) )
+            {   // Not a positive number.
+                return false ;
+            }
+        }
+        values.PushBack( value ) ;
+        cursor = ( ',' == * end ) ? end + 1 : end ;
+    }
+    return ! values.Empty() ;
+}
+
+
+
+
+/** Parse a comma-separated list of velocity-from-vorticity technique names, where "all" means every fixed technique.
+
+    \return Whether the list contained at least one value, and only known names.
+
+    \see VortonSim::GetVelocityFromVorticityTechniqueName
+*/
+static bool ParseVelocityTechniqueList( VECTOR< unsigned > & values , const char * strList )
+{
+    values.Clear() ;
+    if( 0 == strcmp( strList , "all" ) )
+    {   // Every technique except auto, which picks among the others.
+        for( unsigned technique = 0 ; technique < VortonSim::VELOCITY_FROM_VORTICITY_AUTO ; ++ technique )
+        {
+            values.PushBack( technique ) ;
+        }
+        return true ;
+    }
+    const char * cursor = strList ;
+    while( * cursor != '\0' )
+    {   // For each name in the list...
+        const char *    end         = strchr( cursor , ',' ) ;
+        const size_t    nameLength  = end ? size_t( end - cursor ) : strlen( cursor ) ;
+        unsigned        technique   = 0 ;
+        while( ( technique < VortonSim::VELOCITY_FROM_VORTICITY_NUM )
+            && ! (  ( strlen( VortonSim::GetVelocityFromVorticityTechniqueName( VortonSim::VelocityFromVorticityTechniqueE( technique ) ) ) == nameLength )
+                 && ( 0 == strncmp( cursor , VortonSim::GetVelocityFromVorticityTechniqueName( VortonSim::VelocityFromVorticityTechniqueE( technique ) ) , nameLength ) ) ) )
+        {   // Name does not match this technique, so try the next.
+            ++ technique ;
+        }
+        if( technique >= VortonSim::VELOCITY_FROM_VORTICITY_NUM )
+        {   // Unknown name.
+            return false ;
+        }
+        values.PushBack( technique ) ;
+        cursor = end ? end + 1 : cursor + nameLength ;
+    }
+    return ! values.Empty() ;
+}
+
+
+
+
+/** Amend settings from command-line options.
+
+    \return Whether all options made sense.  Otherwise this prints what did not.
+*/
+bool BenchmarkSettings::ParseCommandLine( int argc , char ** argv )
+{
+    for( int iArg = 1 ; iArg < argc ; ++ iArg )
+    {   // For each command-line argument...
+        const char * arg        = argv[ iArg ] ;
+        const char * nextArg    = ( iArg + 1 < argc ) ? argv[ iArg + 1 ] : NULLPTR ;
+        if( 0 == strcmp( arg , "-benchmark" ) )
+        {   // Benchmark_IsRequested already handled this.
+            continue ;
+        }
+        if( NULLPTR == nextArg )
+        {   // All other options take a value.
+            fprintf( stderr , "Benchmark: option %s lacks a value\n" , arg ) ;
+            return false ;
+        }
+        ++ iArg ;
+        if( 0 == strcmp( arg , "-frames" ) )
+        {
+            mNumFrames = unsigned( strtoul( nextArg , NULLPTR , 10 ) ) ;
+            if( 0 == mNumFrames )
+            {
+                fprintf( stderr , "Benchmark: invalid number of frames %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-scenarios" ) )
+        {
+            if( ! ParseUnsignedList( mScenarios , nextArg ) )
+            {
+                fprintf( stderr , "Benchmark: invalid scenario list %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-threads" ) )
+        {
+            if( ! ParseUnsignedList( mThreadCounts , nextArg ) )
+            {
+                fprintf( stderr , "Benchmark: invalid thread count list %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-theta" ) )
+        {
+            if( ! ParseOpeningAngleList( mTreeOpeningAngles , nextArg ) )
+            {
+                fprintf( stderr , "Benchmark: invalid opening angle list %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-techniques" ) )
+        {
+            if( ! ParseVelocityTechniqueList( mVelocityTechniques , nextArg ) )
+            {
+                fprintf( stderr , "Benchmark: invalid technique list %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-tolerance" ) )
+        {
+            mTreeErrorTolerance = float( strtod( nextArg , NULLPTR ) ) ;
+            if( mTreeErrorTolerance <= 0.0f )
+            {
+                fprintf( stderr , "Benchmark: invalid error tolerance %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-errorsamples" ) )
+        {
+            mNumErrorSamples = unsigned( strtoul( nextArg , NULLPTR , 10 ) ) ;
+        }
+        else if( 0 == strcmp( arg , "-out" ) )
+        {
+            mOutputFilename = nextArg ;
+        }
+        else if( 0 == strcmp( arg , "-perfout" ) )
+        {
+            mPerfOutFilename = nextArg ;
+        }
+        else if( 0 == strcmp( arg , "-perfbaseline" ) )
+        {
+            mPerfBaseFilename = nextArg ;
+        }
+        else if( 0 == strcmp( arg , "-perfreport" ) )
+        {
+            mPerfReportFilename = nextArg ;
+        }
+        else if( 0 == strcmp( arg , "-regression" ) )
+        {
+            mRegressionLimit = strtod( nextArg , NULLPTR ) ;
+            if( mRegressionLimit < 0.0 )
+            {
+                fprintf( stderr , "Benchmark: invalid regression threshold %s\n" , nextArg ) ;
+                return false ;
+            }
+        }
+        else if( 0 == strcmp( arg , "-replay" ) )
+        {
+            mReplayFilename = nextArg ;
+        }
+        else
+        {
+            fprintf( stderr , "Benchmark: unknown option %s\n" , arg ) ;
+            return false ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Return whether the command line asks to run the benchmark instead of the interactive application.
+*/
+bool Benchmark_IsRequested( int argc , char ** argv )
+{
+    for( int iArg = 1 ; iArg < argc ; ++ iArg )
+    {   // For each command-line argument...
+        if( 0 == strcmp( argv[ iArg ] , "-benchmark" ) )
+        {
+            return true ;
+        }
+    }
+    return false ;
+}
+
+
+
+
+/** Write column names of the benchmark report.
+*/
+static void WriteCsvHeader( FILE * fp )
+{
+    fprintf( fp , "scenario,threads,technique,theta,tolerance,frames,seconds,secondsPerFrame,vortonsPerFrame,tracersPerFrame,particlesPerSecond,speedUp,efficiency,treeErrorRms,treeErrorMax,velocityErrorRms,ParticleSystems,RigidBodies" ) ;
+    for( unsigned iStage = 0 ; iStage < VortonSim::NUM_UPDATE_STAGES ; ++ iStage )
+    {   // For each VortonSim update stage...
+        fprintf( fp , ",%s" , VortonSim::GetUpdateStageName( VortonSim::UpdateStageE( iStage ) ) ) ;
+    }
+    for( unsigned iCounter = 0 ; iCounter < PerfCounters::GetNumCounters() ; ++ iCounter )
+    {   // For each hardware counter...
+        fprintf( fp , ",ParticleSystems %s" , PerfCounters::GetCounterName( iCounter ) ) ;
+    }
+    const int iInstructions = PerfCounters::GetInstructionsCounterIndex() ;
+    for( unsigned iCounter = 0 ; ( iInstructions >= 0 ) && ( iCounter < PerfCounters::GetNumCounters() ) ; ++ iCounter )
+    {   // For each hardware counter other than instructions...
+        if( int( iCounter ) != iInstructions )
+        {
+            fprintf( fp , ",ParticleSystems %s PerKiloInstruction" , PerfCounters::GetCounterName( iCounter ) ) ;
+        }
+    }
+    fprintf( fp , "\n" ) ;
+}
+
+
+
+
+/** Write one value and its trailing comma, or just the comma if the value is absent.
+*/
+static void WriteCsvOptionalValue( FILE * fp , bool present , double value )
+{
+    if( present )
+    {
+        fprintf( fp , "%g" , value ) ;
+    }
+    fprintf( fp , "," ) ;
+}
+
+
+
+
+/** Write one row of the benchmark report.
+
+    \param result   Result to report.
+
+    \param basis    Result of the same scenario, technique and opening criterion with the first thread count, or NULL if result is that.
+
+    Technique column names the technique that obtained velocity from vorticity in the final frame.
+    Theta and tolerance columns are empty when disabled.
+    Tree error columns are empty when the final frame measured no error.
+    Velocity error column, which applies to every technique, is empty when the final frame measured no error.
+    Stage columns hold average wall-clock seconds per frame.
+    Hardware counter columns, if any, hold average counts per frame.  See PERF_COUNTERS_BACKEND.
+*/
+static void WriteCsvRow( FILE * fp , const BenchmarkScenarioResult & result , const BenchmarkScenarioResult * basis )
+{
+    const double oneOverNumFrames   = 1.0 / double( result.mNumFrames ) ;
+    const double particlesPerSecond = ( result.mSecondsTotal > 0.0 ) ? ( result.mNumVortonsSum + result.mNumTracersSum ) / result.mSecondsTotal : 0.0 ;
+    const double speedUp            = ( basis && ( result.mSecondsTotal > 0.0 ) ) ? basis->mSecondsTotal / result.mSecondsTotal : 1.0 ;
+    const double threadRatio        = basis ? double( result.mNumThreads ) / double( basis->mNumThreads ) : 1.0 ;
+    fprintf( fp , "%u,%u,%s," , result.mScenario , result.mNumThreads , VortonSim::GetVelocityFromVorticityTechniqueName( result.mVelocityTechnique ) ) ;
+    WriteCsvOptionalValue( fp , result.mTreeOpeningCriterion.mOpeningAngle < FLT_MAX , result.mTreeOpeningCriterion.mOpeningAngle ) ;
+    WriteCsvOptionalValue( fp , result.mTreeOpeningCriterion.mErrorTolerance < FLT_MAX , result.mTreeOpeningCriterion.mErrorTolerance ) ;
+    fprintf( fp , "%u,%g,%g,%g,%g,%g,%g,%g,"
+        , result.mNumFrames
+        , result.mSecondsTotal
+        , result.mSecondsTotal * oneOverNumFrames
+        , result.mNumVortonsSum * oneOverNumFrames
+        , result.mNumTracersSum * oneOverNumFrames
+        , particlesPerSecond
+        , speedUp
+        , speedUp / threadRatio
+        ) ;
+    const bool measuredError = ( result.mTreecodeError.mNumSamples > 0 ) ;
+    WriteCsvOptionalValue( fp , measuredError , result.mTreecodeError.mRmsRelativeError ) ;
+    WriteCsvOptionalValue( fp , measuredError , result.mTreecodeError.mMaxRelativeError ) ;
+    WriteCsvOptionalValue( fp , result.mVelocityGridError >= 0.0f , result.mVelocityGridError ) ;
+    fprintf( fp , "%g,%g"
+        , result.mSecondsParticleSystems * oneOverNumFrames
+        , result.mSecondsRigidBodies * oneOverNumFrames
+        ) ;
+    for( unsigned iStage = 0 ; iStage < VortonSim::NUM_UPDATE_STAGES ; ++ iStage )
+    {   // For each VortonSim update stage...
+        fprintf( fp , ",%g" , result.mSecondsUpdateStages[ iStage ] * oneOverNumFrames ) ;
+    }
+    for( unsigned iCounter = 0 ; iCounter < PerfCounters::GetNumCounters() ; ++ iCounter )
+    {   // For each hardware counter...
+        fprintf( fp , ",%g" , double( result.mCountersParticleSystems.mCounts[ iCounter ] ) * oneOverNumFrames ) ;
+    }
+    const int iInstructions = PerfCounters::GetInstructionsCounterIndex() ;
+    for( unsigned iCounter = 0 ; ( iInstructions >= 0 ) && ( iCounter < PerfCounters::GetNumCounters() ) ; ++ iCounter )
+    {   // For each hardware counter other than instructions, report rate, e.g. TLB misses per thousand instructions.
+        if( int( iCounter ) != iInstructions )
+        {
+            const double numInstructions = double( result.mCountersParticleSystems.mCounts[ iInstructions ] ) ;
+            fprintf( fp , ",%g" , ( numInstructions > 0.0 ) ? 1000.0 * double( result.mCountersParticleSystems.mCounts[ iCounter ] ) / numInstructions : 0.0 ) ;
+        }
+    }
+    fprintf( fp , "\n" ) ;
+    fflush( fp ) ;  // Keep partial results if a later scenario crashes.
+}
+
+
+
+
+/** Compare per-frame PerfBlock statistics against a baseline, and report differences.
+
+    \return Process exit code: zero if no block regressed, 1 if comparing failed, or 2 if some block regressed.
+*/
+static int ComparePerfBaseline( const BenchmarkSettings & settings , const PerfBaseline & perfSamples )
+{
+    PerfBaseline baseline ;
+    if( ! baseline.Load( settings.mPerfBaseFilename ) )
+    {
+        fprintf( stderr , "Benchmark: could not read baseline %s\n" , settings.mPerfBaseFilename ) ;
+        return 1 ;
+    }
+
+    FILE * report = stderr ;
+    if( settings.mPerfReportFilename )
+    {
+        report = fopen( settings.mPerfReportFilename , "w" ) ;
+        if( NULLPTR == report )
+        {
+            fprintf( stderr , "Benchmark: could not create %s\n" , settings.mPerfReportFilename ) ;
+            return 1 ;
+        }
+    }
+    const unsigned numRegressions = perfSamples.Compare( baseline , settings.mRegressionLimit , report ) ;
+    if( report != stderr )
+    {
+        fclose( report ) ;
+    }
+
+    fprintf( stderr , "Benchmark: %u blocks regressed by more than %g%% relative to %s\n" , numRegressions , 100.0 * settings.mRegressionLimit , settings.mPerfBaseFilename ) ;
+    return ( numRegressions > 0 ) ? 2 : 0 ;
+}
+
+
+
+
+/** Run the benchmark that the command line describes.
+
+    \return Process exit code: zero upon success, or 2 if a block regressed relative to the baseline.  See ComparePerfBaseline.
+*/
+int Benchmark_Main( int argc , char ** argv )
+{
+    PERF_BLOCK( Benchmark_Main ) ;
+
+    BenchmarkSettings settings ;
+    if( ! settings.ParseCommandLine( argc , argv ) )
+    {
+        fprintf( stderr , "usage: %s -benchmark [-frames N] [-scenarios a,b,...] [-threads a,b,...] [-theta a,b,...] [-tolerance e] [-techniques a,b,...] [-errorsamples N] [-out filename]"
+                          " [-perfout filename] [-perfbaseline filename] [-perfreport filename] [-regression f] [-replay filename]\n" , argv[ 0 ] ) ;
+        return 1 ;
+    }
+
+    InputRecording inputReplay ;
+    if( settings.mReplayFilename )
+    {   // Replay runs only the scenario that was recorded.
+        if( ! inputReplay.Load( settings.mReplayFilename ) || ( inputReplay.GetScenario() < 0 ) )
+        {
+            fprintf( stderr , "Benchmark: could not read input recording %s\n" , settings.mReplayFilename ) ;
+            return 1 ;
+        }
+        settings.mScenarios.Clear() ;
+        settings.mScenarios.PushBack( unsigned( inputReplay.GetScenario() ) ) ;
+    }
+
+    const bool samplePerfBlocks = ( settings.mPerfOutFilename != NULLPTR ) || ( settings.mPerfBaseFilename != NULLPTR ) ;
+#if PROFILE
+    if( samplePerfBlocks )
+    {   // Blocks only record durations while profiling.
+        PERF_BLOCK_ENABLE_PROFILING( PROFILE_FOREVER ) ;
+    }
+#else
+    if( samplePerfBlocks )
+    {
+        fprintf( stderr , "Benchmark: -perfout and -perfbaseline require a PROFILE build\n" ) ;
+        return 1 ;
+    }
+#endif
+    PerfBaseline perfSamples ;
+
+    FILE * fp = stdout ;
+    if( settings.mOutputFilename )
+    {
+        fp = fopen( settings.mOutputFilename , "w" ) ;
+        if( NULLPTR == fp )
+        {
+            fprintf( stderr , "Benchmark: could not create %s\n" , settings.mOutputFilename ) ;
+            return 1 ;
+        }
+    }
+
+    WriteCsvHeader( fp ) ;
+
+    // With no techniques listed, run each scenario once, with whatever technique the simulation defaults to.
+    const VortonSim::VelocityFromVorticityTechniqueE    defaultTechnique    = VortonSim::VELOCITY_FROM_VORTICITY_NUM ;
+    const size_t                        numScenarios    = settings.mScenarios.Size() ;
+    const size_t                        numAngles       = settings.mTreeOpeningAngles.Size() ;
+    const size_t                        numTechniques   = Max2( settings.mVelocityTechniques.Size() , size_t( 1 ) ) ;
+    VECTOR< BenchmarkScenarioResult >   basisResults( numScenarios * numAngles * numTechniques ) ;   // Result of each scenario, opening angle and technique with the first thread count.
+    for( size_t iThreadCount = 0 ; iThreadCount < settings.mThreadCounts.Size() ; ++ iThreadCount )
+    {   // For each thread count...
+        Parallel::Settings parallelSettings = Parallel::SettingsFromEnvironment() ;
+        parallelSettings.mNumThreads = settings.mThreadCounts[ iThreadCount ] ;
+
+        // Only one application (and Executor) can exist at a time, so each thread count gets its own, in its own scope.
+        InteSiVis inteSiVis( NULLPTR , parallelSettings ) ;
+
+        for( size_t iTechnique = 0 ; iTechnique < numTechniques ; ++ iTechnique )
+        {   // For each velocity-from-vorticity technique...
+            const VortonSim::VelocityFromVorticityTechniqueE technique = settings.mVelocityTechniques.Empty() ? defaultTechnique : VortonSim::VelocityFromVorticityTechniqueE( settings.mVelocityTechniques[ iTechnique ] ) ;
+            for( size_t iAngle = 0 ; iAngle < numAngles ; ++ iAngle )
+            {   // For each treecode opening angle...
+                VortonSim::TreeOpeningCriterion treeOpeningCriterion ;
+                treeOpeningCriterion.mOpeningAngle      = settings.mTreeOpeningAngles[ iAngle ] ;
+                treeOpeningCriterion.mErrorTolerance    = settings.mTreeErrorTolerance ;
+                for( size_t iScenario = 0 ; iScenario < numScenarios ; ++ iScenario )
+                {   // For each scenario...
+                    char context[ 96 ] ;    // Key for PerfBlock statistics of this run.  See PerfBaseline::SetContext.
+                    if( treeOpeningCriterion.mOpeningAngle < FLT_MAX )
+                    {
+                        sprintf( context , "scenario%u_threads%u_theta%g" , settings.mScenarios[ iScenario ] , settings.mThreadCounts[ iThreadCount ] , treeOpeningCriterion.mOpeningAngle ) ;
+                    }
+                    else
+                    {
+                        sprintf( context , "scenario%u_threads%u_thetaOff" , settings.mScenarios[ iScenario ] , settings.mThreadCounts[ iThreadCount ] ) ;
+                    }
+                    if( technique != defaultTechnique )
+                    {   // Distinguish techniques, while keeping keys of default runs the same as baselines saved before techniques were selectable.
+                        sprintf( context + strlen( context ) , "_%s" , VortonSim::GetVelocityFromVorticityTechniqueName( technique ) ) ;
+                    }
+                    perfSamples.SetContext( context ) ;
+
+                    BenchmarkScenarioResult result ;
+                    inteSiVis.RunBenchmarkScenario( settings.mScenarios[ iScenario ] , settings.mNumFrames , treeOpeningCriterion , technique , settings.mNumErrorSamples , result , samplePerfBlocks ? & perfSamples : NULLPTR , settings.mReplayFilename ? & inputReplay : NULLPTR ) ;
+                    BenchmarkScenarioResult & basis = basisResults[ ( iTechnique * numAngles + iAngle ) * numScenarios + iScenario ] ;
+                    if( 0 == iThreadCount )
+                    {   // This is the basis for speed-up.
+                        basis = result ;
+                        WriteCsvRow( fp , result , NULLPTR ) ;
+                    }
+                    else
+                    {
+                        WriteCsvRow( fp , result , & basis ) ;
+                    }
+                }
+            }
+        }
+    }
+
+    if( fp != stdout )
+    {
+        fclose( fp ) ;
+    }
+
+    if( settings.mPerfOutFilename && ! perfSamples.Save( settings.mPerfOutFilename ) )
+    {
+        fprintf( stderr , "Benchmark: could not write %s\n" , settings.mPerfOutFilename ) ;
+        return 1 ;
+    }
+    if( settings.mPerfBaseFilename )
+    {
+        return ComparePerfBaseline( settings , perfSamples ) ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,77 @@
+/** \file benchmark.h
+
+    \brief Headless benchmark that runs stock scenarios for a fixed number of frames and reports timings.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Core/Containers/vector.h>
+#include <Core/Performance/perfCounters.h>
+
+#include <VortonFluid/vortonSim.h>
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Timings and particle counts from running one scenario with one thread count.
+*/
+struct BenchmarkScenarioResult
+{
+    BenchmarkScenarioResult() ;
+
+    unsigned    mScenario                                           ;   ///< Which initial conditions ran.  See InteSiVis::InitialConditions.
+    unsigned    mNumThreads                                         ;   ///< Number of threads parallel work used, including the main thread.
+    unsigned    mNumFrames                                          ;   ///< Number of frames simulated.
+    double      mSecondsTotal                                       ;   ///< Wall-clock seconds all frames took.
+    double      mSecondsParticleSystems                             ;   ///< Wall-clock seconds spent updating particle systems, which includes VortonSim.
+    double      mSecondsRigidBodies                                 ;   ///< Wall-clock seconds spent updating rigid bodies.
+    double      mSecondsUpdateStages[ VortonSim::NUM_UPDATE_STAGES ];   ///< Wall-clock seconds each VortonSim update stage took, summed across frames.
+    double      mNumVortonsSum                                      ;   ///< Number of vortons, summed across frames.
+    double      mNumTracersSum                                      ;   ///< Number of tracers, summed across frames.
+    PerfCounterValues mCountersParticleSystems                      ;   ///< Hardware counter increments across all threads while updating particle systems.  See PERF_COUNTERS_BACKEND.
+    VortonSim::TreeOpeningCriterion     mTreeOpeningCriterion       ;   ///< Rule by which treecodes opened clusters.
+    VortonSim::TreecodeErrorStatistics  mTreecodeError              ;   ///< Error of treecode velocity relative to direct summation, measured during the final frame.
+    VortonSim::VelocityFromVorticityTechniqueE mVelocityTechnique   ;   ///< Technique that obtained velocity from vorticity.
+    float                               mVelocityGridError          ;   ///< Root-mean-square error of the velocity grid, whichever technique populated it, relative to direct summation, measured during the final frame.  Negative when not measured.
+} ;
+
+
+
+
+/** What a benchmark run should do.
+*/
+struct BenchmarkSettings
+{
+    BenchmarkSettings() ;
+
+    bool ParseCommandLine( int argc , char ** argv ) ;
+
+    static const unsigned sDefaultNumFrames         = 300 ; ///< Number of frames to simulate per scenario, unless the command line says otherwise.
+    static const unsigned sDefaultNumErrorSamples   = 256 ; ///< Number of gridpoints at which to measure treecode error, unless the command line says otherwise.
+
+    unsigned            mNumFrames          ;   ///< Number of frames to simulate per scenario.
+    VECTOR< unsigned >  mScenarios          ;   ///< Which initial conditions to run.
+    VECTOR< unsigned >  mThreadCounts       ;   ///< Thread counts to run each scenario with, to obtain scaling curves.  The first is the basis for speed-up.
+    VECTOR< float >     mTreeOpeningAngles  ;   ///< Barnes-Hut opening angles to run each scenario with, to chart error against time.  See VortonSim::TreeOpeningCriterion.
+    VECTOR< unsigned >  mVelocityTechniques ;   ///< Velocity-from-vorticity techniques to run each scenario with, to compare them.  Empty means the default technique only.  See VortonSim::VelocityFromVorticityTechniqueE.
+    float               mTreeErrorTolerance ;   ///< Per-cluster velocity error tolerance every run uses.  See VortonSim::TreeOpeningCriterion.
+    unsigned            mNumErrorSamples    ;   ///< Number of gridpoints at which to compare treecode against direct summation, during the final frame.  Zero disables.
+    const char *        mOutputFilename     ;   ///< File to write CSV report into, or NULL for stdout.
+    const char *        mPerfOutFilename    ;   ///< File to save per-frame PerfBlock statistics into, as a baseline for later runs, or NULL for none.  See PerfBaseline.
+    const char *        mPerfBaseFilename   ;   ///< File of PerfBlock statistics from an earlier run to compare against, or NULL for none.
+    const char *        mPerfReportFilename ;   ///< File to write the comparison against mPerfBaseFilename into, or NULL for stderr.
+    double              mRegressionLimit    ;   ///< Fraction by which a block must slow, relative to the baseline, to count as a regression.
+    const char *        mReplayFilename     ;   ///< Input recording to replay while simulating, which replaces mScenarios with its scenario, or NULL for none.  See InputRecording.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+extern bool Benchmark_IsRequested( int argc , char ** argv ) ;
+extern int  Benchmark_Main( int argc , char ** argv ) ;
+
+#endif
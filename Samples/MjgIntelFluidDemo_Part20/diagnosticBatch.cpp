@@ -0,0 +1,128 @@
+/** \file diagnosticBatch.cpp
+
+    \brief Batch of colored lines and points for diagnostic overlays, drawn from a streaming vertex buffer.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "diagnosticBatch.h"
+
+#include <Render/Platform/OpenGL/OpenGL_Api.h>
+#include <Render/Platform/OpenGL/OpenGL_extensions.h>
+
+#include <Core/Performance/perfBlock.h>
+
+// Public functions --------------------------------------------------------------
+
+/** Construct a diagnostic batch.
+
+    This declares the vertex format but allocates nothing, so it does not need an OpenGL context.
+*/
+DiagnosticBatch::DiagnosticBatch()
+{
+    PERF_BLOCK( DiagnosticBatch__DiagnosticBatch ) ;
+
+    PeGaSys::Render::VertexBufferBase & vertexBuffer = mVertexBuffer ;
+    vertexBuffer.DeclareVertexFormat( PeGaSys::Render::VertexDeclaration( PeGaSys::Render::VertexDeclaration::POSITION_COLOR ) ) ;
+    vertexBuffer.SetUsage( PeGaSys::Render::VertexBufferBase::USAGE_STREAM ) ;  // Overlays refill their batch every frame.
+}
+
+
+
+
+/** Obtain vertices to fill, replacing the contents of this batch.
+
+    \param numVertices  Number of vertices to fill.  Caller must assign every one of them, before calling Unlock.
+
+    \return Address of first of numVertices vertices, or NULL if numVertices is zero.
+
+    This grows the vertex buffer as needed, at least doubling its capacity,
+    so that overlays whose size changes from frame to frame seldom reallocate.
+*/
+DiagnosticBatch::Vertex * DiagnosticBatch::Lock( size_t numVertices )
+{
+    PERF_BLOCK( DiagnosticBatch__Lock ) ;
+
+    PeGaSys::Render::VertexBufferBase & vertexBuffer = mVertexBuffer ;
+
+    vertexBuffer.SetPopulation( 0 ) ;
+
+    if( 0 == numVertices )
+    {   // Nothing to fill.
+        return NULLPTR ;
+    }
+
+    if( numVertices > vertexBuffer.GetCapacity() )
+    {   // Vertex buffer is too small.
+        if( 0 == vertexBuffer.GetCapacity() )
+        {
+            vertexBuffer.Allocate( numVertices ) ;
+        }
+        else
+        {
+            vertexBuffer.ChangeCapacityAndReallocate( Max2( numVertices , 2 * vertexBuffer.GetCapacity() ) ) ;
+        }
+    }
+
+    vertexBuffer.SetPopulation( numVertices ) ;
+
+    return static_cast< Vertex * >( vertexBuffer.LockVertexData() ) ;
+}
+
+
+
+
+/** Release vertices obtained from Lock, so the GPU can read them.
+*/
+void DiagnosticBatch::Unlock()
+{
+    PERF_BLOCK( DiagnosticBatch__Unlock ) ;
+
+    PeGaSys::Render::VertexBufferBase & vertexBuffer = mVertexBuffer ;
+    if( vertexBuffer.GetPopulation() > 0 )
+    {   // Lock obtained vertices.
+        vertexBuffer.UnlockVertexData() ;
+    }
+}
+
+
+
+
+/** Draw a range of vertices from this batch, as the given type of primitive, with a single draw call.
+
+    \param primitiveType    OpenGL primitive type, e.g. GL_LINES or GL_POINTS.
+
+    \param firstVertex      Index of first vertex to draw.
+
+    \param numVertices      Number of vertices to draw.
+
+    Caller sets all other render state, such as material, line width and point size.
+    Vertex color overrides the current color.
+*/
+void DiagnosticBatch::Draw( GLenum primitiveType , size_t firstVertex , size_t numVertices )
+{
+    PERF_BLOCK( DiagnosticBatch__Draw ) ;
+
+    if( 0 == numVertices )
+    {   // Nothing to draw.
+        return ;
+    }
+
+    ASSERT( firstVertex + numVertices <= mVertexBuffer.GetPopulation() ) ;
+
+    mVertexBuffer.BindVertexData() ;
+    glDrawArrays( primitiveType , static_cast< GLint >( firstVertex ) , static_cast< GLsizei >( numVertices ) ) ;
+    mVertexBuffer.UnbindVertexData() ;
+
+    // Restore state that other (immediate-mode) diagnostics expect.
+    glDisableClientState( GL_COLOR_ARRAY ) ;
+    glDisableClientState( GL_VERTEX_ARRAY ) ;
+    if( glBindBuffer )
+    {   // Display supports vertex buffer objects.  Unbind this one, so client-side vertex arrays drawn later do not read from it.
+        glBindBuffer( GL_ARRAY_BUFFER , 0 ) ;
+    }
+
+    RENDER_CHECK_ERROR( DiagnosticBatch__Draw ) ;
+}
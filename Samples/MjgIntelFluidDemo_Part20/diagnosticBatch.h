@@ -0,0 +1,74 @@
+/** \file diagnosticBatch.h
+
+    \brief Batch of colored lines and points for diagnostic overlays, drawn from a streaming vertex buffer.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef DIAGNOSTIC_BATCH_H
+#define DIAGNOSTIC_BATCH_H
+
+#include <Render/Platform/OpenGL/OpenGL_vertexBuffer.h>
+
+#include <Core/Math/vec4.h>
+#include <Core/Math/math.h>
+
+// Types --------------------------------------------------------------
+
+/** Batch of colored lines and points for diagnostic overlays, drawn from a streaming vertex buffer.
+
+    Drawing diagnostics in immediate mode (glBegin, glVertex, glEnd per
+    primitive) costs a driver call per vertex and a draw call per primitive,
+    which, for grids and vortons of realistic size, dominates frame time.
+
+    Instead, an overlay locks as many vertices as it could need, fills them
+    (from multiple threads, since each element writes only its own
+    vertices), unlocks them, then draws each primitive type with one call.
+
+    To omit an element without compacting the batch, fill its vertices with
+    zero opacity.  QdMaterial enables alpha testing, which discards those.
+
+    Every method other than the constructor requires that the OpenGL context
+    be current on the calling thread.
+*/
+class DiagnosticBatch
+{
+    public:
+        typedef PeGaSys::Render::OpenGL_VertexBuffer::VertexFormatPositionColor Vertex ;
+
+        DiagnosticBatch() ;
+
+        Vertex *        Lock( size_t numVertices ) ;
+        void            Unlock() ;
+        void            Draw( GLenum primitiveType , size_t firstVertex , size_t numVertices ) ;
+
+        /// Assign position and color of a vertex.  Color components outside [0,1] saturate.
+        static void     SetVertex( Vertex & vertex , const Vec3 & position , const Vec4 & color )
+        {
+            vertex.color_rgba[ 0 ] = static_cast< unsigned char >( Clamp( color.x , 0.0f , 1.0f ) * 255.0f + 0.5f ) ;
+            vertex.color_rgba[ 1 ] = static_cast< unsigned char >( Clamp( color.y , 0.0f , 1.0f ) * 255.0f + 0.5f ) ;
+            vertex.color_rgba[ 2 ] = static_cast< unsigned char >( Clamp( color.z , 0.0f , 1.0f ) * 255.0f + 0.5f ) ;
+            vertex.color_rgba[ 3 ] = static_cast< unsigned char >( Clamp( color.w , 0.0f , 1.0f ) * 255.0f + 0.5f ) ;
+            vertex.px = position.x ;
+            vertex.py = position.y ;
+            vertex.pz = position.z ;
+        }
+
+        /// Assign position of a vertex and make it fully transparent, so alpha testing discards it.
+        static void     SetHiddenVertex( Vertex & vertex , const Vec3 & position )
+        {
+            SetVertex( vertex , position , Vec4( 0.0f , 0.0f , 0.0f , 0.0f ) ) ;
+        }
+
+    private:
+        DiagnosticBatch( const DiagnosticBatch & ) ;              // Disallow copy
+        DiagnosticBatch & operator=( const DiagnosticBatch & ) ;  // Disallow assignment
+
+        PeGaSys::Render::OpenGL_VertexBuffer    mVertexBuffer   ;   ///< Streaming vertex buffer that holds lines and points of the most recent Lock.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
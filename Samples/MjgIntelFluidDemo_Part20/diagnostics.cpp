@@ -14,6 +14,8 @@
 
 #include "Core/Performance/perfBlock.h"
 
+#include "Particles/particlePositionHistory.h"
+
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
@@ -171,132 +173,7 @@ void ResampleNestedGridLayer( int direction )
 
 
 
-/// Set the projection matrix to orthographic, for rendering text.
-void setOrthographicProjection()
-{
-    CheckGlError() ;
-
-    // TODO: Store matrix mode
-
-    // switch to projection mode
-    glMatrixMode( GL_PROJECTION ) ;
-
-    // save previous matrix which contains the settings for the perspective projection
-    glPushMatrix() ;
-
-    // reset matrix
-    glLoadIdentity() ;
-
-    int viewportXYWH[4] ;
-    glGetIntegerv( GL_VIEWPORT , viewportXYWH ) ;
-
-    if( ( 0 == viewportXYWH[ 2 ] ) || ( 0 == viewportXYWH[ 3 ] ) )
-    {   // Zero-size viewport.
-        // Render window is probably minimized, which is okay, but calling gluOrtho2D would result in an invalid value.
-    }
-    else
-    {   // Viewport is probably valid.
-        // set a 2D orthographic projection
-        gluOrtho2D( 0 , viewportXYWH[ 2 ] , viewportXYWH[ 3 ] , 0 ) ;
-    }
-
-    // switch back to modelview mode
-    glMatrixMode( GL_MODELVIEW ) ;
-
-    glPushMatrix();
-
-    glLoadIdentity();
-
-    // TODO: Restore matrix mode
-
-    CheckGlError() ;
-}
-
-
-
-
-/// Set the projection matrix to projection, for rendering 3D objects.
-void restorePerspectiveProjection()
-{
-    CheckGlError() ;
-
-    // TODO: Store matrix mode
-
-    glMatrixMode(GL_PROJECTION);
-    // restore previous projection matrix
-    glPopMatrix();
-
-    // get back to modelview mode
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix() ;
-
-    // TODO: Restore matrix mode
-
-    CheckGlError() ;
-}
-
-
-
-
-/// Render the given string using the given font.
-static void oglRenderBitmapString( void * font , const char * string )
-{
-    for( const char * c = string ; *c != '\0' ; c ++ )
-    {
-        CheckGlError() ;
-
-        glutBitmapCharacter( font , *c ) ;
-
-        CheckGlError() ;
-    }
-}
-
-
-
-
-static void oglRenderBitmapString( const Vec3 & pos , void * font , const Vec4 & color , const char * string , bool useScreenSpace )
-{
-    CheckGlError() ;
-
-    if( useScreenSpace )
-    {
-        setOrthographicProjection() ;
-    }
-
-    glPushAttrib( GL_DEPTH_BUFFER_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT ) ; // Should include GL_ENABLE_BIT or GL_ALL_ATTRIB_BITS but for some reason that *sometimes* makes things disappear, like vortex lines.
-
-    glDisable( GL_LIGHTING ) ;
-    glDisable( GL_TEXTURE_2D ) ;
-    glEnable( GL_BLEND ) ;
-    glBlendFunc( GL_SRC_ALPHA , GL_ONE_MINUS_SRC_ALPHA ) ;  // Typical alpha blending
-
-    if( useScreenSpace )
-    {   // Only when drawing in screen space...
-        glDisable( GL_DEPTH_TEST ) ;    // Disable depth test so text appears as if in front of everything already drawn.
-    }
-
-    glColor4fv( reinterpret_cast< const GLfloat * >( & color ) ) ;
-
-    //int viewportXYWH[4] ;
-    //glGetIntegerv( GL_VIEWPORT , viewportXYWH ) ;
-
-    glRasterPos3f( pos.x , pos.y , pos.z ) ;
-    oglRenderBitmapString( font , string ) ;
-
-    glPopAttrib() ;
-
-    if( useScreenSpace )
-    {
-        restorePerspectiveProjection() ;
-    }
-
-    CheckGlError() ;
-}
-
-
-
-
-/// Render the given string at the given screen-space position using the given font.
+/// Render the given string at the given screen-space position using the given font, when InteSiVis flushes its diagnostic text batch.
 void oglRenderString( const Vec3 & pos , void * font , const char * format , ... )
 {
     char stringBuffer[ 512 ] ;
@@ -304,13 +181,13 @@ void oglRenderString( const Vec3 & pos , void * font , const char * format , ...
     va_start( args , format ) ;
     _vsnprintf( stringBuffer , sizeof( stringBuffer ) , format , args ) ;
     va_end( args ) ;
-    oglRenderBitmapString( pos , font , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) , stringBuffer , true ) ;
+    InteSiVis::GetInstance()->GetDiagnosticTextBatch().AddText( pos , /* use screen space */ true , font , Vec4( 1.0f , 1.0f , 1.0f , 1.0f ) , stringBuffer ) ;
 }
 
 
 
 
-/// Render the given string at the given world-space position using the given font.
+/// Render the given string at the given world-space position using the given font, when InteSiVis flushes its diagnostic text batch.
 void oglRenderStringWorld( const Vec3 & pos , void * font , const Vec4 & color , const char * format , ... )
 {
     char stringBuffer[ 512 ] ;
@@ -318,7 +195,7 @@ void oglRenderStringWorld( const Vec3 & pos , void * font , const Vec4 & color ,
     va_start( args , format ) ;
     vsprintf( stringBuffer , format , args ) ;
     va_end( args ) ;
-    oglRenderBitmapString( pos , font , color , stringBuffer , false ) ;
+    InteSiVis::GetInstance()->GetDiagnosticTextBatch().AddText( pos , /* use screen space */ false , font , color , stringBuffer ) ;
 }
 
 
@@ -404,149 +281,235 @@ static inline Vec4 GetColorForGridPoint( const float val0to1 , const Vec3 gridpo
 
 
 
-static inline void SetColorForGridPoint( const float val0to1 , const Vec3 gridpointPosition )
+/// Return value of a scalar, for choosing the color of a gridpoint.
+static inline float GridValueForColor( const float & value )
 {
-    Vec4 color = GetColorForGridPoint( val0to1 , gridpointPosition ) ;
-    glColor4f( color.x , color.y , color.z , color.w ) ;
+    return value ;
 }
 
 
 
 
-static inline void SetVertexForGridPoint( const float val0to1 , const Vec3 gridpointPosition )
+/// Return magnitude of a vector, for choosing the color of a gridpoint.
+static inline float GridValueForColor( const Vec3 & value )
 {
-    SetColorForGridPoint( val0to1 , gridpointPosition ) ;
-    glVertex3f( gridpointPosition.x , gridpointPosition.y , gridpointPosition.z ) ;
+    return value.Magnitude() ;
 }
 
 
 
 
-static inline void SetVertexForGridPoint_Scalar( const UniformGrid< float > & grid , const unsigned ix , const unsigned iy , const unsigned iz , float valMin , float oneOverValueRange )
-{
-    const float &   value               = grid.Get( ix , iy , iz ) ;
-    const float     val0to1             = ( value - valMin ) * oneOverValueRange ;
-    const Vec3      gridpointPosition   = grid.PositionFromIndices( ix , iy , iz ) ;
+/** Return color for a gridpoint, given its value.
+
+    \param value            Value at gridpoint.
+
+    \param position         Location of gridpoint.
+
+    \param valMin           Value (or magnitude) that maps to the start of the color ramp.
 
-    SetVertexForGridPoint( val0to1 , gridpointPosition ) ;
+    \param oneOverValRange  Reciprocal of the range of values that spans the color ramp.
+*/
+template< typename ItemT > static inline Vec4 GetColorForGridValue( const ItemT & value , const Vec3 & position , float valMin , float oneOverValRange )
+{
+    const float val0to1 = ( GridValueForColor( value ) - valMin ) * oneOverValRange ;
+    return GetColorForGridPoint( val0to1 , position ) ;
 }
 
 
 
 
-/** Draw a single edge of a grid cell, using color appropriate to the given grid values.
+/** Assign vertices of a single edge of a grid cell, from a gridpoint to its neighbor, using colors appropriate to their values.
 
-    \param grid             Grid of scalar values whose values to render.
+    \param edgeVerts        Address of the 2 vertices of the edge.
 
-    \param ix0, iy0, iz0    Indices of the first gridpoint.
+    \param grid             Grid whose values to render.
 
-    \param ix1, iy1, iz1    Indices of the second gridpoint.
+    \param hasNeighbor      Whether the neighbor lies inside the grid.  If not, both vertices are hidden.
 
-    \param magMin           Minimum magnitude across all values in the grid.
+    \param position         Location of gridpoint.
 
-    \param oneOverMagRange  Reciprocal of (magMax-magMin) where magMax is the maximum magnitude across all values in the grid.
+    \param color            Color of gridpoint.
 
-    \param gridDecorations  Render mode for grid decorations.
+    \param neighborOffset   Offset of neighbor into grid.  Ignored unless hasNeighbor.
 
-    \see DrawGridCells_VectorMagnitude
+    \param neighborPosition Location of neighbor.
 
+    \param valMin           Value (or magnitude) that maps to the start of the color ramp.
+
+    \param oneOverValRange  Reciprocal of the range of values that spans the color ramp.
 */
-inline void DrawGridCellEdge_Scalar( const UniformGrid< float > & grid , const unsigned ix0 , const unsigned iy0 , const unsigned iz0
-                                                                        , const unsigned ix1 , const unsigned iy1 , const unsigned iz1
-                                                                        , float valMin , float oneOverValueRange , InteSiVis::GridDecorationsE /*gridDecorations*/ )
+template< typename ItemT > static inline void SetGridCellEdge( DiagnosticBatch::Vertex * edgeVerts , const UniformGrid< ItemT > & grid , bool hasNeighbor
+                                                             , const Vec3 & position , const Vec4 & color , unsigned neighborOffset , const Vec3 & neighborPosition
+                                                             , float valMin , float oneOverValRange )
 {
-    CheckGlError() ;
+    if( hasNeighbor )
+    {   // Edge lies inside grid.
+        DiagnosticBatch::SetVertex( edgeVerts[ 0 ] , position         , color ) ;
+        DiagnosticBatch::SetVertex( edgeVerts[ 1 ] , neighborPosition , GetColorForGridValue( grid[ neighborOffset ] , neighborPosition , valMin , oneOverValRange ) ) ;
+    }
+    else
+    {   // Edge would leave grid.
+        DiagnosticBatch::SetHiddenVertex( edgeVerts[ 0 ] , position ) ;
+        DiagnosticBatch::SetHiddenVertex( edgeVerts[ 1 ] , position ) ;
+    }
+}
+
+
+
+
+/** Assign vertices for edges of grid cells, for a slab of gridpoints.
 
-    glBegin( GL_LINES ) ;
+    Each gridpoint has 6 vertices: one edge to each of its neighbors along +x, +y and +z.
+    Together, those are all edges of all cells, each exactly once.
 
-    SetVertexForGridPoint_Scalar( grid , ix0 , iy0 , iz0 , valMin , oneOverValueRange ) ;
-    SetVertexForGridPoint_Scalar( grid , ix1 , iy1 , iz1 , valMin , oneOverValueRange ) ;
+    \param grid             Grid whose values to render.
 
-    glEnd() ;
+    \param vertices         Vertices for the whole grid, 6 per gridpoint.
 
-    CheckGlError() ;
+    \param valMin           Value (or magnitude) that maps to the start of the color ramp.
+
+    \param oneOverValRange  Reciprocal of the range of values that spans the color ramp.
+
+    \param izStart          Index of first z-layer of gridpoints to assign.
+
+    \param izEnd            One past index of last z-layer of gridpoints to assign.
+*/
+template< typename ItemT > static void FillGridCellEdgesSlice( const UniformGrid< ItemT > & grid , DiagnosticBatch::Vertex * vertices , float valMin , float oneOverValRange , size_t izStart , size_t izEnd )
+{
+    const Vec3 &    spacing = grid.GetCellSpacing() ;
+    const unsigned  npx     = grid.GetNumPoints( 0 ) ;
+    const unsigned  npy     = grid.GetNumPoints( 1 ) ;
+    const unsigned  npz     = grid.GetNumPoints( 2 ) ;
+    const unsigned  npxy    = npx * npy ;
+    unsigned        indices[ 4 ] ;
+    unsigned &      ix      = indices[ 0 ] ;
+    unsigned &      iy      = indices[ 1 ] ;
+    unsigned &      iz      = indices[ 2 ] ;
+    for( iz = unsigned( izStart ) ; iz < unsigned( izEnd ) ; ++ iz )
+    {
+        const unsigned zOffset = iz * npxy ;
+        for( iy = 0 ; iy < npy ; ++ iy )
+        {
+            const unsigned yzOffset = zOffset + iy * npx ;
+            for( ix = 0 ; ix < npx ; ++ ix )
+            {
+                const unsigned              xyzOffset   = ix + yzOffset ;
+                DiagnosticBatch::Vertex *   edgeVerts   = vertices + 6 * size_t( xyzOffset ) ;
+                const Vec3                  position    = grid.PositionFromIndices( indices ) ;
+                const Vec4                  color       = GetColorForGridValue( grid[ xyzOffset ] , position , valMin , oneOverValRange ) ;
+
+                SetGridCellEdge( edgeVerts     , grid , ix + 1 < npx , position , color , xyzOffset + 1    , position + Vec3( spacing.x , 0.0f , 0.0f ) , valMin , oneOverValRange ) ;
+                SetGridCellEdge( edgeVerts + 2 , grid , iy + 1 < npy , position , color , xyzOffset + npx  , position + Vec3( 0.0f , spacing.y , 0.0f ) , valMin , oneOverValRange ) ;
+                SetGridCellEdge( edgeVerts + 4 , grid , iz + 1 < npz , position , color , xyzOffset + npxy , position + Vec3( 0.0f , 0.0f , spacing.z ) , valMin , oneOverValRange ) ;
+            }
+        }
+    }
 }
 
 
 
 
-static bool sMakeRangeSymmetric = true ; // Make range [-r,r]
+/** Mapping from vector values to colors and line lengths, for drawing value vectors at gridpoints.
+*/
+struct GridPointVectorScale
+{
+    float   mMagMin             ;   ///< Magnitude that maps to the start of the color ramp.
+    float   mOneOverMagRange    ;   ///< Reciprocal of the range of magnitudes that spans the color ramp.
+    float   mCellLength         ;   ///< Length of line for a value with magnitude mMagMin + 1/mOneOverMagRange.
+} ;
 
 
 
 
-/** Draw grid cells, given a grid of scalar values.
+/** Assign vertices for value vectors and gridpoints, for a slab of gridpoints.
 
-    This is a rudimentary form of volumetric rendering.
+    \param grid             Grid of vector values to render.
 
-    \param grid                     Grid of scalar values to draw.
+    \param lineVerts        Vertices of lines for the whole grid, 2 per gridpoint, from each gridpoint along its value.
 
-    \param material                 Material to use to draw grid.
+    \param pointVerts       Vertices of points for the whole grid, 1 per gridpoint.
 
-    \param gridDecorations          Render mode for grid decorations.
+    \param scale            Mapping from values to colors and line lengths.
 
-    \param bRenderDiagnosticText    Whether to render diagnostic text.
+    \param izStart          Index of first z-layer of gridpoints to assign.
 
-    \see DrawGridCells_VectorMagnitude
+    \param izEnd            One past index of last z-layer of gridpoints to assign.
 */
-//#error TODO: Add a mode that renders cube faces, not just edges.
-static void DrawGridCells_Scalar( const UniformGrid< float > & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool /*bRenderDiagnosticText*/ )
+static void FillGridPointVectorsSlice( const UniformGrid< Vec3 > & grid , DiagnosticBatch::Vertex * lineVerts , DiagnosticBatch::Vertex * pointVerts , const GridPointVectorScale & scale , size_t izStart , size_t izEnd )
 {
-    ASSERT( ! grid.HasZeroExtent() ) ;
+    const unsigned  npx     = grid.GetNumPoints( 0 ) ;
+    const unsigned  npy     = grid.GetNumPoints( 1 ) ;
+    const unsigned  npxy    = npx * npy ;
+    unsigned        indices[ 4 ] ;
+    unsigned &      ix      = indices[ 0 ] ;
+    unsigned &      iy      = indices[ 1 ] ;
+    unsigned &      iz      = indices[ 2 ] ;
+    for( iz = unsigned( izStart ) ; iz < unsigned( izEnd ) ; ++ iz )
+    {
+        const unsigned zOffset = iz * npxy ;
+        for( iy = 0 ; iy < npy ; ++ iy )
+        {
+            const unsigned yzOffset = zOffset + iy * npx ;
+            for( ix = 0 ; ix < npx ; ++ ix )
+            {
+                const unsigned xyzOffset = ix + yzOffset ;
 
-    material.UseMaterial() ;
+                const Vec3 & value              = grid[ xyzOffset ] ;
+                const float  val0to1            = ( value.Magnitude() - scale.mMagMin ) * scale.mOneOverMagRange ;
+                const Vec3   gridpointPosition  = grid.PositionFromIndices( indices ) ;
+                const Vec4   color              = GetColorForGridPoint( val0to1 , gridpointPosition ) ;
 
-    // Gather min and max statistics for grid contents
-    float magMin ;
-    float magMax ;
-    FindValueRange( grid , magMin , magMax ) ;
-    if( sMakeRangeSymmetric && ( magMin < 0.0f ) && ( magMax > 0.0f ) )
-    {
-        magMax = Max2( -magMin , magMax ) ;
-        magMin = - magMax ;
+                // Line indicating value direction and magnitude.
+                // Scale line according to cell size and magnitude.
+                const Vec3 arrowEnd( gridpointPosition + value.GetDir() * val0to1 * scale.mCellLength ) ;
+                DiagnosticBatch::SetVertex( lineVerts[ 2 * xyzOffset     ] , gridpointPosition , color ) ;
+                DiagnosticBatch::SetVertex( lineVerts[ 2 * xyzOffset + 1 ] , arrowEnd          , color ) ;
+
+                // Point indicating gridpoint location.
+                DiagnosticBatch::SetVertex( pointVerts[ xyzOffset ] , gridpointPosition , color ) ;
+            }
+        }
     }
-    const float oneOverMagRange = 1.0f / ( magMax - magMin + FLT_EPSILON ) ;    // Add FLT_EPSILON to avoid divide-by-zero when domain is empty.
-    const bool speedRangeIsNonZero = magMax != magMin ;
+}
+
+
+
+
+/** Assign vertices for gridpoints, for a slab of gridpoints.
+
+    \param grid             Grid of scalar values to render.
 
-    const Vec3  cellSize   = grid.GetCellSpacing() /* shrink cell to visualize each, otherwise edges overlap */ * 0.99f ;
+    \param pointVerts       Vertices of points for the whole grid, 1 per gridpoint.
 
+    \param valMin           Value that maps to the start of the color ramp.
+
+    \param oneOverValRange  Reciprocal of the range of values that spans the color ramp.
+
+    \param izStart          Index of first z-layer of gridpoints to assign.
+
+    \param izEnd            One past index of last z-layer of gridpoints to assign.
+*/
+static void FillGridPointScalarsSlice( const UniformGrid< float > & grid , DiagnosticBatch::Vertex * pointVerts , float valMin , float oneOverValRange , size_t izStart , size_t izEnd )
+{
+    const unsigned  npx     = grid.GetNumPoints( 0 ) ;
+    const unsigned  npy     = grid.GetNumPoints( 1 ) ;
+    const unsigned  npxy    = npx * npy ;
+    unsigned        indices[ 4 ] ;
+    unsigned &      ix      = indices[ 0 ] ;
+    unsigned &      iy      = indices[ 1 ] ;
+    unsigned &      iz      = indices[ 2 ] ;
+    for( iz = unsigned( izStart ) ; iz < unsigned( izEnd ) ; ++ iz )
     {
-        // Draw each grid cell.
-        Vec4            color   = material.GetColor() ;
-        const unsigned  nx      = grid.GetNumCells( 0 ) ;
-        const unsigned  ny      = grid.GetNumCells( 1 ) ;
-        const unsigned  nz      = grid.GetNumCells( 2 ) ;
-        unsigned        indices[ 4 ] ;
-        unsigned &      ix      = indices[ 0 ] ;
-        unsigned &      iy      = indices[ 1 ] ;
-        unsigned &      iz      = indices[ 2 ] ;
-        for( iz = 0 ; iz < nz ; ++ iz )
+        const unsigned zOffset = iz * npxy ;
+        for( iy = 0 ; iy < npy ; ++ iy )
         {
-            for( iy = 0 ; iy < ny ; ++ iy )
+            const unsigned yzOffset = zOffset + iy * npx ;
+            for( ix = 0 ; ix < npx ; ++ ix )
             {
-                for( ix = 0 ; ix < nx ; ++ ix )
-                {
-                    if( speedRangeIsNonZero )
-                    {
-                        glLineWidth( material.GetLineWidth() ) ;
-
-                        // Draw 3 faces of the current grid cell.
-                        DrawGridCellEdge_Scalar( grid , ix   , iy   , iz   , ix+1 , iy   , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix   , iy+1 , iz   , ix+1 , iy+1 , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix   , iy   , iz   , ix   , iy+1 , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix+1 , iy   , iz   , ix+1 , iy+1 , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-
-                        DrawGridCellEdge_Scalar( grid , ix   , iy   , iz+1 , ix+1 , iy   , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix   , iy+1 , iz+1 , ix+1 , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix   , iy   , iz+1 , ix   , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix+1 , iy   , iz+1 , ix+1 , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-
-                        DrawGridCellEdge_Scalar( grid , ix   , iy   , iz   , ix   , iy   , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix+1 , iy   , iz   , ix+1 , iy   , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix   , iy+1 , iz   , ix   , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Scalar( grid , ix+1 , iy+1 , iz   , ix+1 , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                    }
-                }
+                const unsigned  xyzOffset           = ix + yzOffset ;
+                const Vec3      gridpointPosition   = grid.PositionFromIndices( indices ) ;
+                const Vec4      color               = GetColorForGridValue( grid[ xyzOffset ] , gridpointPosition , valMin , oneOverValRange ) ;
+                DiagnosticBatch::SetVertex( pointVerts[ xyzOffset ] , gridpointPosition , color ) ;
             }
         }
     }
@@ -555,76 +518,80 @@ static void DrawGridCells_Scalar( const UniformGrid< float > & grid , const QdMa
 
 
 
-static inline Vec4 GetColorForGridPoint_Scalar( const UniformGrid< float > & grid , const unsigned ix , const unsigned iy , const unsigned iz , float magMin , float oneOverMagRange )
-{
-    const float &   value               = grid.Get( ix , iy , iz ) ;
-    const float     valMag              = value ;
-    const float     val0to1             = ( valMag - magMin ) * oneOverMagRange ;
-    const Vec3      gridpointPosition   = grid.PositionFromIndices( ix , iy , iz ) ;
+/** Draw edges of grid cells, as a single batch.
 
-    const Vec4 color = GetColorForGridPoint( val0to1 , gridpointPosition ) ;
-    glColor4f( color.x , color.y , color.z , color.w ) ;
-    return color ;
-}
+    This is a rudimentary form of volumetric rendering.
 
+    \param grid     Grid of values to draw.
 
+    \param material Material to use to draw grid.
 
+    \param batch    Diagnostic batch into which to put edges.
 
-static inline Vec4 GetColorForGridPoint_VectorMagnitude( const UniformGrid<Vec3> & grid , const unsigned ix , const unsigned iy , const unsigned iz , float magMin , float oneOverMagRange )
-{
-    const Vec3 &    value               = grid.Get( ix , iy , iz ) ;
-    const float     valMag              = value.Magnitude() ;
-    const float     val0to1             = ( valMag - magMin ) * oneOverMagRange ;
-    const Vec3      gridpointPosition   = grid.PositionFromIndices( ix , iy , iz ) ;
+    \param valMin   Value (or magnitude) that maps to the start of the color ramp.
 
-    const Vec4 color = GetColorForGridPoint( val0to1 , gridpointPosition ) ;
-    glColor4f( color.x , color.y , color.z , color.w ) ;
-    return color ;
-}
+    \param valMax   Value (or magnitude) that maps to the end of the color ramp.
+
+    \see DrawGridCells_Scalar, DrawGridCells_VectorMagnitude
+*/
+//#error TODO: Add a mode that renders cube faces, not just edges.
+template< typename ItemT > static void DrawGridCells( const UniformGrid< ItemT > & grid , const QdMaterial & material , DiagnosticBatch & batch , float valMin , float valMax )
+{
+    PERF_BLOCK( DrawGridCells ) ;
 
+    ASSERT( ! grid.HasZeroExtent() ) ;
 
+    if( valMax == valMin )
+    {   // Grid values are uniform so there is nothing to distinguish.
+        return ;
+    }
 
+    const float     oneOverValRange = 1.0f / ( valMax - valMin + FLT_EPSILON ) ;    // Add FLT_EPSILON to avoid divide-by-zero when domain is empty.
+    const size_t    numGridPoints   = grid.GetGridCapacity() ;
+    const size_t    numZ            = grid.GetNumPoints( 2 ) ;
 
-static inline void SetVertexForGridPoint_VectorMagnitude( const UniformGrid<Vec3> & grid , const unsigned ix , const unsigned iy , const unsigned iz , float magMin , float oneOverMagRange )
-{
-    const Vec3 &    value               = grid.Get( ix , iy , iz ) ;
-    const float     valMag              = value.Magnitude() ;
-    const float     val0to1             = ( valMag - magMin ) * oneOverMagRange ;
-    const Vec3      gridpointPosition   = grid.PositionFromIndices( ix , iy , iz ) ;
+    DiagnosticBatch::Vertex * vertices = batch.Lock( 6 * numGridPoints ) ;
+    Parallel::For( 0 , numZ , 1 , Parallel::Function( FillGridCellEdgesSlice< ItemT > , grid , vertices , valMin , oneOverValRange ) ) ;
+    batch.Unlock() ;
 
-    SetVertexForGridPoint( val0to1 , gridpointPosition ) ;
+    material.UseMaterial() ;
+    glLineWidth( material.GetLineWidth() ) ;
+    batch.Draw( GL_LINES , 0 , 6 * numGridPoints ) ;
 }
 
 
 
 
-/** Draw a single edge of a grid cell, using color appropriate to the given grid values.
+static bool sMakeRangeSymmetric = true ; // Make range [-r,r]
 
-    \param grid             Grid of vector values whose magnitude to render.
 
-    \param ix0, iy0, iz0    Indices of the first gridpoint.
 
-    \param ix1, iy1, iz1    Indices of the second gridpoint.
 
-    \param magMin           Minimum magnitude across all values in the grid.
+/** Draw grid cells, given a grid of scalar values.
 
-    \param oneOverMagRange  Reciprocal of (magMax-magMin) where magMax is the maximum magnitude across all values in the grid.
+    This is a rudimentary form of volumetric rendering.
 
-    \param gridDecorations  Render mode for grid decorations.
+    \param grid                     Grid of scalar values to draw.
 
-    \see DrawGridCells_VectorMagnitude
+    \param material                 Material to use to draw grid.
 
+    \param batch                    Diagnostic batch into which to put edges.
+
+    \see DrawGridCells_VectorMagnitude
 */
-inline void DrawGridCellEdge_Vectors( const UniformGrid<Vec3> & grid    , const unsigned ix0 , const unsigned iy0 , const unsigned iz0
-                                                                        , const unsigned ix1 , const unsigned iy1 , const unsigned iz1
-                                                                        , float magMin , float oneOverMagRange , InteSiVis::GridDecorationsE /*gridDecorations*/ )
+static void DrawGridCells_Scalar( const UniformGrid< float > & grid , const QdMaterial & material , DiagnosticBatch & batch )
 {
-    glBegin( GL_LINES ) ;
-
-    SetVertexForGridPoint_VectorMagnitude( grid , ix0 , iy0 , iz0 , magMin , oneOverMagRange ) ;
-    SetVertexForGridPoint_VectorMagnitude( grid , ix1 , iy1 , iz1 , magMin , oneOverMagRange ) ;
+    // Gather min and max statistics for grid contents
+    float magMin ;
+    float magMax ;
+    FindValueRange( grid , magMin , magMax ) ;
+    if( sMakeRangeSymmetric && ( magMin < 0.0f ) && ( magMax > 0.0f ) )
+    {
+        magMax = Max2( -magMin , magMax ) ;
+        magMin = - magMax ;
+    }
 
-    glEnd() ;
+    DrawGridCells( grid , material , batch , magMin , magMax ) ;
 }
 
 
@@ -638,70 +605,20 @@ inline void DrawGridCellEdge_Vectors( const UniformGrid<Vec3> & grid    , const
 
     \param material                 Material to use to draw grid.
 
-    \param gridDecorations          Render mode for grid decorations.
-
-    \param bRenderDiagnosticText    Whether to render diagnostic text.
+    \param batch                    Diagnostic batch into which to put edges.
 
     \see DrawGridPoints_Vectors
 */
-//#error TODO: Add a mode that renders cube faces, not just edges.
-static void DrawGridCells_VectorMagnitude( const UniformGrid<Vec3> & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool /*bRenderDiagnosticText*/ )
+static void DrawGridCells_VectorMagnitude( const UniformGrid<Vec3> & grid , const QdMaterial & material , DiagnosticBatch & batch )
 {
-    ASSERT( ! grid.HasZeroExtent() ) ;
-
-    material.UseMaterial() ;
-
     // Gather min and max statistics for grid contents (e.g. speed or density gradient)
     float magMin ;
     float magMax ;
     FindMagnitudeRange( grid , magMin , magMax ) ;
     magMin -= FLT_EPSILON * magMin ;  // Account for diff between fsqrtf and sqrtf
     magMax += FLT_EPSILON * magMax ;  // Account for diff between fsqrtf and sqrtf
-    const float oneOverMagRange = 1.0f / ( magMax - magMin + FLT_EPSILON ) ;    // Add FLT_EPSILON to avoid divide-by-zero when domain is empty.
-    const bool rangeIsNonZero = magMax != magMin ;
-
-    const Vec3  cellSize   = grid.GetCellSpacing() /* shrink cell to visualize each, otherwise edges overlap */ * 0.99f ;
 
-    {
-        // Draw each grid cell.
-        Vec4            color   = material.GetColor() ;
-        const unsigned  nx      = grid.GetNumCells( 0 ) ;
-        const unsigned  ny      = grid.GetNumCells( 1 ) ;
-        const unsigned  nz      = grid.GetNumCells( 2 ) ;
-        unsigned        indices[ 4 ] ;
-        unsigned &      ix      = indices[ 0 ] ;
-        unsigned &      iy      = indices[ 1 ] ;
-        unsigned &      iz      = indices[ 2 ] ;
-        for( iz = 0 ; iz < nz ; ++ iz )
-        {
-            for( iy = 0 ; iy < ny ; ++ iy )
-            {
-                for( ix = 0 ; ix < nx ; ++ ix )
-                {
-                    if( rangeIsNonZero )
-                    {
-                        glLineWidth( material.GetLineWidth() ) ;
-
-                        // Draw 3 faces of the current grid cell.
-                        DrawGridCellEdge_Vectors( grid , ix   , iy   , iz   , ix+1 , iy   , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix   , iy+1 , iz   , ix+1 , iy+1 , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix   , iy   , iz   , ix   , iy+1 , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix+1 , iy   , iz   , ix+1 , iy+1 , iz   , magMin , oneOverMagRange , gridDecorations ) ;
-
-                        DrawGridCellEdge_Vectors( grid , ix   , iy   , iz+1 , ix+1 , iy   , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix   , iy+1 , iz+1 , ix+1 , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix   , iy   , iz+1 , ix   , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix+1 , iy   , iz+1 , ix+1 , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-
-                        DrawGridCellEdge_Vectors( grid , ix   , iy   , iz   , ix   , iy   , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix+1 , iy   , iz   , ix+1 , iy   , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix   , iy+1 , iz   , ix   , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                        DrawGridCellEdge_Vectors( grid , ix+1 , iy+1 , iz   , ix+1 , iy+1 , iz+1 , magMin , oneOverMagRange , gridDecorations ) ;
-                    }
-                }
-            }
-        }
-    }
+    DrawGridCells( grid , material , batch , magMin , magMax ) ;
 }
 
 
@@ -719,14 +636,15 @@ static void DrawGridCells_VectorMagnitude( const UniformGrid<Vec3> & grid , cons
 
     \param bRenderDiagnosticText    Whether to render diagnostic text.
 
+    \param batch                    Diagnostic batch into which to put lines and points.
+
     \see DrawGridCells_VectorMagnitude
 */
-static void DrawGridPoints_Vectors( const UniformGrid<Vec3> & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText )
+static void DrawGridPoints_Vectors( const UniformGrid<Vec3> & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText , DiagnosticBatch & batch )
 {
-    ASSERT( ! grid.HasZeroExtent() ) ;
+    PERF_BLOCK( DrawGridPoints_Vectors ) ;
 
-    // Draw bounding box
-    material.UseMaterial() ;
+    ASSERT( ! grid.HasZeroExtent() ) ;
 
     // Gather min and max statistics for grid contents (speeds)
     float magMin ;
@@ -736,77 +654,48 @@ static void DrawGridPoints_Vectors( const UniformGrid<Vec3> & grid , const QdMat
     magMax += FLT_EPSILON * magMax ;  // Account for diff between fsqrtf and sqrtf
     const float oneOverMagRange = 1.0f / ( magMax - magMin + FLT_EPSILON ) ;    // Add FLT_EPSILON to avoid divide-by-zero when domain is empty.
 
-    const Vec3  cellSize   = grid.GetCellSpacing() /* shrink cell to visualize each, otherwise edges overlap */ * 0.99f ;
     const float cellLength = powf( grid.GetCellVolume() , 0.33333333333333333f ) ;
 
     const float lineWidth = ( ( InteSiVis::GRID_DECO_POINTS == gridDecorations ) ? 3.0f :  5.0f ) ; // thinner for just points, thicker for points and cells.
     const float pointSize = ( ( InteSiVis::GRID_DECO_POINTS == gridDecorations ) ? 5.0f : 11.0f ) ; // thinner for just points, thicker for points and cells.
 
-    {
-        // Draw each grid cell.
-        const unsigned  nx      = grid.GetNumPoints( 0 ) ;
-        const unsigned  ny      = grid.GetNumPoints( 1 ) ;
-        const unsigned  nz      = grid.GetNumPoints( 2 ) ;
-        const unsigned  npx     = grid.GetNumPoints( 0 ) ;
-        const unsigned  npy     = grid.GetNumPoints( 1 ) ;
-        const unsigned  npxy    = npx * npy ;
-        unsigned        indices[ 4 ] ;
-        unsigned &      ix      = indices[ 0 ] ;
-        unsigned &      iy      = indices[ 1 ] ;
-        unsigned &      iz      = indices[ 2 ] ;
-        for( iz = 0 ; iz < nz ; ++ iz )
-        {
-            const unsigned zOffset = iz * npxy ;
-            for( iy = 0 ; iy < ny ; ++ iy )
-            {
-                const unsigned yzOffset = zOffset + iy * npx ;
-                for( ix = 0 ; ix < nx ; ++ ix )
-                {
-                    const unsigned xyzOffset = ix + yzOffset ;
-
-                    {
-                        DEBUG_ONLY( unsigned testIndices[ 4 ] ) ;
-                        DEBUG_ONLY( grid.IndicesFromOffset( testIndices , xyzOffset ) ) ;
-                        ASSERT( ( testIndices[0] == ix ) && ( testIndices[1] == iy ) && ( testIndices[2] == iz ) ) ;
-                    }
-
-                    const Vec3 & value  = grid[ xyzOffset ] ;
-                    const float valMag  = value.Magnitude() ;
-                    const float val0to1 = ( valMag - magMin ) * oneOverMagRange ;
-                    const Vec3 gridpointPosition = grid.PositionFromIndices( indices ) ;
-
-                    const Vec4 color = GetColorForGridPoint_VectorMagnitude( grid , ix , iy , iz , magMin , oneOverMagRange ) ;
-
-                    if( bRenderDiagnosticText && color.w > 0.01f )
-                    {   // Diagnostic text is enabled and opacity is sufficient to render it.
-                    #if 1
-                        // Draw value magnitude
-                        oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g" , value.Magnitude() ) ;
-                    #else
-                        // Draw position and value.
-                        oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g,%g,%g %g,%g,%g"
-                            , gridpointPosition.x , gridpointPosition.y , gridpointPosition.z
-                            , value.x , value.y , value.z
-                            ) ;
-                    #endif
-                    }
-                    {
-                        // Draw an arrow indicating value direction and magnitude.
-                        // Scale arrow according to cell size and speed.
-                        Vec3 arrowEnd( gridpointPosition + value.GetDir() * val0to1 * cellLength ) ;
-                        glLineWidth( lineWidth ) ;
-                        glBegin( GL_LINES ) ;
-                        glVertex3fv( reinterpret_cast< const GLfloat * >( & gridpointPosition ) ) ;
-                        glVertex3fv( reinterpret_cast< const GLfloat * >( & arrowEnd  ) ) ;
-                        glEnd() ;
-                    }
-                    {
-                        glPointSize( pointSize ) ;
-                        glBegin( GL_POINTS ) ;
-                        glVertex3fv( reinterpret_cast< const GLfloat * >( & gridpointPosition ) ) ;
-                        glEnd() ;
-                    }
-                }
+    // Batch holds 2 vertices per gridpoint for lines, followed by 1 per gridpoint for points.
+    const size_t    numGridPoints   = grid.GetGridCapacity() ;
+    const size_t    numZ            = grid.GetNumPoints( 2 ) ;
+
+    DiagnosticBatch::Vertex * vertices      = batch.Lock( 3 * numGridPoints ) ;
+    DiagnosticBatch::Vertex * pointVertices = vertices + 2 * numGridPoints ;
+    const GridPointVectorScale scale = { magMin , oneOverMagRange , cellLength } ;
+    Parallel::For( 0 , numZ , 1 , Parallel::Function( FillGridPointVectorsSlice , grid , vertices , pointVertices , scale ) ) ;
+    batch.Unlock() ;
+
+    material.UseMaterial() ;
+    glLineWidth( lineWidth ) ;
+    batch.Draw( GL_LINES , 0 , 2 * numGridPoints ) ;
+    glPointSize( pointSize ) ;
+    batch.Draw( GL_POINTS , 2 * numGridPoints , numGridPoints ) ;
+
+    if( bRenderDiagnosticText )
+    {   // Diagnostic text is enabled.
+        for( unsigned offset = 0 ; offset < numGridPoints ; ++ offset )
+        {   // For each gridpoint...
+            unsigned indices[ 4 ] ;
+            grid.IndicesFromOffset( indices , offset ) ;
+            const Vec3 & value              = grid[ offset ] ;
+            const Vec3   gridpointPosition  = grid.PositionFromIndices( indices ) ;
+            const Vec4   color              = GetColorForGridValue( value , gridpointPosition , magMin , oneOverMagRange ) ;
+            if( color.w > 0.01f )
+            {   // Opacity is sufficient to render text.
+            #if 1
+                // Draw value magnitude
+                oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g" , value.Magnitude() ) ;
+            #else
+                // Draw position and value.
+                oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g,%g,%g %g,%g,%g"
+                    , gridpointPosition.x , gridpointPosition.y , gridpointPosition.z
+                    , value.x , value.y , value.z
+                    ) ;
+            #endif
             }
         }
     }
@@ -827,14 +716,15 @@ static void DrawGridPoints_Vectors( const UniformGrid<Vec3> & grid , const QdMat
 
     \param bRenderDiagnosticText    Whether to render diagnostic text.
 
+    \param batch                    Diagnostic batch into which to put points.
+
     \see DrawGridCells_VectorMagnitude
 */
-static void DrawGridPoints_Scalars( const UniformGrid< float > & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText )
+static void DrawGridPoints_Scalars( const UniformGrid< float > & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText , DiagnosticBatch & batch )
 {
-    ASSERT( ! grid.HasZeroExtent() ) ;
+    PERF_BLOCK( DrawGridPoints_Scalars ) ;
 
-    // Draw bounding box
-    material.UseMaterial() ;
+    ASSERT( ! grid.HasZeroExtent() ) ;
 
     // Gather min and max statistics for grid contents (speeds)
     float magMin ;
@@ -847,64 +737,41 @@ static void DrawGridPoints_Scalars( const UniformGrid< float > & grid , const Qd
     }
     const float oneOverMagRange = 1.0f / ( magMax - magMin + FLT_EPSILON ) ;    // Add FLT_EPSILON to avoid divide-by-zero when domain is empty.
 
-    const Vec3  cellSize   = grid.GetCellSpacing() /* shrink cell to visualize each, otherwise edges overlap */ * 0.99f ;
-
     const float pointSize = ( ( InteSiVis::GRID_DECO_POINTS == gridDecorations ) ? 5.0f : 11.0f ) ; // thinner for just points, thicker for points and cells.
     //const float pointSize = ( ( InteSiVis::GRID_DECO_POINTS == gridDecorations ) ? 8.0f : 4.0f  ) ; // thicker for just points, thinner for points and cells.
 
-    {
-        // Draw each grid point.
-        const unsigned  nx      = grid.GetNumPoints( 0 ) ;
-        const unsigned  ny      = grid.GetNumPoints( 1 ) ;
-        const unsigned  nz      = grid.GetNumPoints( 2 ) ;
-        const unsigned  npx     = grid.GetNumPoints( 0 ) ;
-        const unsigned  npy     = grid.GetNumPoints( 1 ) ;
-        const unsigned  npxy    = npx * npy ;
-        unsigned        indices[ 4 ] ;
-        unsigned &      ix      = indices[ 0 ] ;
-        unsigned &      iy      = indices[ 1 ] ;
-        unsigned &      iz      = indices[ 2 ] ;
-        for( iz = 0 ; iz < nz ; ++ iz )
-        {
-            const unsigned zOffset = iz * npxy ;
-            for( iy = 0 ; iy < ny ; ++ iy )
-            {
-                const unsigned yzOffset = zOffset + iy * npx ;
-                for( ix = 0 ; ix < nx ; ++ ix )
-                {
-                    const unsigned xyzOffset = ix + yzOffset ;
-
-                    {
-                        DEBUG_ONLY( unsigned testIndices[ 4 ] ) ;
-                        DEBUG_ONLY( grid.IndicesFromOffset( testIndices , xyzOffset ) ) ;
-                        ASSERT( ( testIndices[0] == ix ) && ( testIndices[1] == iy ) && ( testIndices[2] == iz ) ) ;
-                    }
-
-                    const float & value  = grid[ xyzOffset ] ;
-                    const Vec3 gridpointPosition = grid.PositionFromIndices( indices ) ;
-
-                    const Vec4 color = GetColorForGridPoint_Scalar( grid , ix , iy , iz , magMin , oneOverMagRange ) ;
-
-                    if( bRenderDiagnosticText && color.w > 0.01f )
-                    {   // Diagnostic text is enabled and opacity is sufficient to render it.
-                    #if 1
-                        // Draw value
-                        oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g" , value ) ;
-                    #else
-                        // Draw position and value.
-                        oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g,%g,%g %g"
-                            , gridpointPosition.x , gridpointPosition.y , gridpointPosition.z
-                            , value
-                            ) ;
-                    #endif
-                    }
-                    {
-                        glPointSize( pointSize ) ;
-                        glBegin( GL_POINTS ) ;
-                        glVertex3fv( reinterpret_cast< const GLfloat * >( & gridpointPosition ) ) ;
-                        glEnd() ;
-                    }
-                }
+    const size_t    numGridPoints   = grid.GetGridCapacity() ;
+    const size_t    numZ            = grid.GetNumPoints( 2 ) ;
+
+    DiagnosticBatch::Vertex * vertices = batch.Lock( numGridPoints ) ;
+    Parallel::For( 0 , numZ , 1 , Parallel::Function( FillGridPointScalarsSlice , grid , vertices , magMin , oneOverMagRange ) ) ;
+    batch.Unlock() ;
+
+    material.UseMaterial() ;
+    glPointSize( pointSize ) ;
+    batch.Draw( GL_POINTS , 0 , numGridPoints ) ;
+
+    if( bRenderDiagnosticText )
+    {   // Diagnostic text is enabled.
+        for( unsigned offset = 0 ; offset < numGridPoints ; ++ offset )
+        {   // For each gridpoint...
+            unsigned indices[ 4 ] ;
+            grid.IndicesFromOffset( indices , offset ) ;
+            const float & value             = grid[ offset ] ;
+            const Vec3    gridpointPosition = grid.PositionFromIndices( indices ) ;
+            const Vec4    color             = GetColorForGridValue( value , gridpointPosition , magMin , oneOverMagRange ) ;
+            if( color.w > 0.01f )
+            {   // Opacity is sufficient to render text.
+            #if 1
+                // Draw value
+                oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g" , value ) ;
+            #else
+                // Draw position and value.
+                oglRenderStringWorld( gridpointPosition , GLUT_BITMAP_HELVETICA_10 , 2.0f * color , "%g,%g,%g %g"
+                    , gridpointPosition.x , gridpointPosition.y , gridpointPosition.z
+                    , value
+                    ) ;
+            #endif
             }
         }
     }
@@ -953,9 +820,13 @@ static void DrawBoundingBox( const UniformGridGeometry & gridGeometry , const Qd
 
     \param bRenderDiagnosticText    Whether to render diagnostic text.
 
+    \param cellsBatch               Diagnostic batch into which to put edges of grid cells.
+
+    \param pointsBatch              Diagnostic batch into which to put gridpoints.
+
     \see DrawBoundingBox, DrawGridCells_VectorMagnitude, DrawGridPoints_Vectors
 */
-static void DrawGrid_Vectors( const UniformGrid<Vec3> & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText )
+static void DrawGrid_Vectors( const UniformGrid<Vec3> & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText , DiagnosticBatch & cellsBatch , DiagnosticBatch & pointsBatch )
 {
     if( grid.HasZeroExtent() )
     {   // Grid has no size.
@@ -976,12 +847,12 @@ static void DrawGrid_Vectors( const UniformGrid<Vec3> & grid , const QdMaterial
     if(     ( InteSiVis::GRID_DECO_CELLS            == gridDecorations )
         ||  ( InteSiVis::GRID_DECO_CELLS_AND_POINTS == gridDecorations ) )
     {
-        DrawGridCells_VectorMagnitude( grid , material , gridDecorations , bRenderDiagnosticText ) ;
+        DrawGridCells_VectorMagnitude( grid , material , cellsBatch ) ;
     }
     if(     ( InteSiVis::GRID_DECO_POINTS           == gridDecorations )
         ||  ( InteSiVis::GRID_DECO_CELLS_AND_POINTS == gridDecorations ) )
     {
-        DrawGridPoints_Vectors( grid , material , gridDecorations , bRenderDiagnosticText ) ;
+        DrawGridPoints_Vectors( grid , material , gridDecorations , bRenderDiagnosticText , pointsBatch ) ;
     }
 }
 
@@ -1000,9 +871,13 @@ static void DrawGrid_Vectors( const UniformGrid<Vec3> & grid , const QdMaterial
 
     \param bRenderDiagnosticText    Whether to render diagnostic text.
 
+    \param cellsBatch               Diagnostic batch into which to put edges of grid cells.
+
+    \param pointsBatch              Diagnostic batch into which to put gridpoints.
+
     \see DrawBoundingBox, DrawGridCells_VectorMagnitude, DrawGridPoints_Vectors
 */
-static void DrawGrid_Scalars( const UniformGrid< float > & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText )
+static void DrawGrid_Scalars( const UniformGrid< float > & grid , const QdMaterial & material , InteSiVis::GridDecorationsE gridDecorations , bool bRenderDiagnosticText , DiagnosticBatch & cellsBatch , DiagnosticBatch & pointsBatch )
 {
     if( grid.HasZeroExtent() )
     {   // Grid has no size.
@@ -1023,12 +898,12 @@ static void DrawGrid_Scalars( const UniformGrid< float > & grid , const QdMateri
     if(     ( InteSiVis::GRID_DECO_CELLS            == gridDecorations )
         ||  ( InteSiVis::GRID_DECO_CELLS_AND_POINTS == gridDecorations ) )
     {
-        DrawGridCells_Scalar( grid , material , gridDecorations , bRenderDiagnosticText ) ;
+        DrawGridCells_Scalar( grid , material , cellsBatch ) ;
     }
     if(     ( InteSiVis::GRID_DECO_POINTS           == gridDecorations )
         ||  ( InteSiVis::GRID_DECO_CELLS_AND_POINTS == gridDecorations ) )
     {
-        DrawGridPoints_Scalars( grid , material , gridDecorations , bRenderDiagnosticText ) ;
+        DrawGridPoints_Scalars( grid , material , gridDecorations , bRenderDiagnosticText , pointsBatch ) ;
     }
 }
 
@@ -1222,244 +1097,298 @@ void InteSiVis::QdRenderVortonDiagnosticText()
 
 
 #if ENABLE_PARTICLE_POSITION_HISTORY
-/** Render particle pathlines.
+/// Number of vertices per sampled particle for its pathline: 2 per segment between consecutive historical positions.
+static const size_t sNumPathlineVertsPerParticle = 2 * ( ParticlePositionHistory::NUM_HISTORICAL_POSITIONS - 1 ) ;
+
+
+
+
+/** Assign vertices for pathlines of a subset of sampled particles.
+
+    \param history          Recent positions of sampled particles whose pathlines to render.
+
+    \param materialColor    Color of pathlines, before fading.
+
+    \param vertices         Vertices for pathlines of all samples, sNumPathlineVertsPerParticle per sample.
+
+    \param iSampleStart     Index of first sample whose pathline to assign.
+
+    \param iSampleEnd       One past index of last sample whose pathline to assign.
 */
-void InteSiVis::QdRenderDiagnosticPathlines( VECTOR< Particle > & particles )
+static void FillDiagnosticPathlinesSlice( const ParticlePositionHistory & history , const Vec4 & materialColor , DiagnosticBatch::Vertex * vertices , size_t iSampleStart , size_t iSampleEnd )
 {
-    PERF_BLOCK( InteSiVis__QdRenderDiagnosticPathlines ) ;
-
-    mPathlineMaterial.UseMaterial() ;
+    static const float  oneOverNumHistoryPositions  = 1.0f / float( ParticlePositionHistory::NUM_HISTORICAL_POSITIONS ) ;
+    static const size_t lastSegmentIndex            = ParticlePositionHistory::NUM_HISTORICAL_POSITIONS - 2 ;
 
-    // ASSERT( particles.empty() || particles.data() == & particles[0] ) ; // Modern STL supports vector.data() but not older versions like MSVS7.
+    const size_t iHistoryBegin  = history.HistoryBegin() ;
+    const size_t iHistoryEnd    = history.HistoryEnd() ;
 
-    size_t numParticles = particles.size() ;
-    for( size_t iVort = 0 ; iVort < numParticles ; ++ iVort )
-    {   // For each particle...
-        const Particle & pcl = particles[ iVort ] ;
+    for( size_t iSample = iSampleStart ; iSample < iSampleEnd ; ++ iSample )
+    {   // For each sampled particle...
+        const Vec3 &                position    = history.GetPosition( iHistoryEnd , iSample ) ;
+        DiagnosticBatch::Vertex *   pclVerts    = vertices + sNumPathlineVertsPerParticle * iSample ;
 
-        Vec4   color( mPathlineMaterial.GetColor() ) ;
+        Vec4   color( materialColor ) ;
 
         // Modulate opacity based on distance to camera target.
-        color.w *= CameraFocusEmphasis( pcl.mPosition ) ;
-
-        // Render pathline for current particle.
-        glBegin( GL_LINE_STRIP ) ;
+        color.w *= InteSiVis::GetInstance()->CameraFocusEmphasis( position ) ;
 
-        static const float oneOverNumHistoryPositions = 1.0f / float( Particle::NUM_HISTORICAL_POSITIONS ) ;
         size_t segmentIndex = 0 ;
-        const size_t iHistoryEnd = pcl.HistoryEnd() ;
-        for( size_t iHistory = pcl.HistoryBegin() ; iHistory != iHistoryEnd ; iHistory = Particle::NextHistoryIndex( iHistory ) )
-        {   // For each element in the particle position history...
-            // Fade each segment: more recent is more opaque.
-            const float fade = float( segmentIndex ) * oneOverNumHistoryPositions ;
-            glColor4f( color.x , color.y , color.z , color.w * fade ) ;
-            if( pcl.mPositionHistory[ iHistory ].x != Particle::sNaN )
+        ASSERT( ! IsNan( position.x ) ) ; // Last element should always be valid.
+        for( size_t iHistory = iHistoryBegin ; iHistory != iHistoryEnd ; iHistory = ParticlePositionHistory::NextHistoryIndex( iHistory ) )
+        {   // For each segment, from each element in the particle position history to the next...
+            DiagnosticBatch::Vertex *   segmentVerts    = pclVerts + 2 * segmentIndex ;
+            const Vec3 &                segmentBegin    = history.GetPosition( iHistory , iSample ) ;
+            if( ! IsNan( segmentBegin.x ) )
             {   // This history element is valid.
-                // (Invalid element could come from particles too young to have full history.)
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & pcl.mPositionHistory[ iHistory ] ) ) ;
+                // Fade each segment: more recent is more opaque.  Newest position has the same opacity as the one before it.
+                const float fadeBegin   = float( segmentIndex ) * oneOverNumHistoryPositions ;
+                const float fadeEnd     = float( Min2( segmentIndex + 1 , lastSegmentIndex ) ) * oneOverNumHistoryPositions ;
+                DiagnosticBatch::SetVertex( segmentVerts[ 0 ] , segmentBegin                                                                     , Vec4( color.x , color.y , color.z , color.w * fadeBegin ) ) ;
+                DiagnosticBatch::SetVertex( segmentVerts[ 1 ] , history.GetPosition( ParticlePositionHistory::NextHistoryIndex( iHistory ) , iSample ) , Vec4( color.x , color.y , color.z , color.w * fadeEnd   ) ) ;
+            }
+            else
+            {   // Invalid element could come from particles too young to have full history.
+                DiagnosticBatch::SetHiddenVertex( segmentVerts[ 0 ] , position ) ;
+                DiagnosticBatch::SetHiddenVertex( segmentVerts[ 1 ] , position ) ;
             }
             ++ segmentIndex ;
         }
-        ASSERT( pcl.mPositionHistory[ iHistoryEnd ].x != Particle::sNaN ) ; // Last element should always be valid.
-        glVertex3fv( reinterpret_cast< const GLfloat * >( & pcl.mPositionHistory[ iHistoryEnd ] ) ) ;
-        glEnd() ;
+        ASSERT( 2 * segmentIndex == sNumPathlineVertsPerParticle ) ;
     }
 }
-#endif
 
 
 
 
-/** Render diagnostic vectors for vortex particles.
+/** Render pathlines of sampled particles.
+
+    This reads positions directly from the history store, which only holds
+    a sampled subset of particles, so cost scales with the number of samples.
 */
-void InteSiVis::QdRenderVortonDiagnosticVectors()
+void InteSiVis::QdRenderDiagnosticPathlines( const ParticlePositionHistory & history )
 {
-    PERF_BLOCK( InteSiVis__QdRenderVortonDiagnosticVectors ) ;
+    PERF_BLOCK( InteSiVis__QdRenderDiagnosticPathlines ) ;
 
-    ASSERT(     ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_VECTORS )
-            ||  ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_PARTICLES_AND_VECTORS )
-            ||  ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_ALL ) ) ;
+    const size_t numSamples = history.GetNumSamples() ;
+    if( 0 == numSamples )
+    {   // Nothing recorded yet.
+        return ;
+    }
+
+    DiagnosticBatch::Vertex * vertices = mPathlineBatch.Lock( sNumPathlineVertsPerParticle * numSamples ) ;
+    // Estimate grain size based on size of problem and number of processors.
+    const size_t grainSize = Max2( size_t( 1 ) , numSamples / gNumberOfProcessors ) ;
+    Parallel::For( 0 , numSamples , grainSize , Parallel::Function( FillDiagnosticPathlinesSlice , history , mPathlineMaterial.GetColor() , vertices ) ) ;
+    mPathlineBatch.Unlock() ;
 
     mPathlineMaterial.UseMaterial() ;
+    mPathlineBatch.Draw( GL_LINES , 0 , sNumPathlineVertsPerParticle * numSamples ) ;
+}
+#endif
 
-    VortonSim &                 rVortonSim  = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
-    VECTOR< Vorton > &          vortons     = * rVortonSim.GetVortons() ;
-    const UniformGrid< Vec3 > & velGrid     = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
 
-    float rangeScale ;
-    SetDiagnosticPropertyValueRangeScale( rangeScale ) ;
 
-    static const float lineWidth = 1.0f ;
-    static const float pointSize = 3.0f ;
 
-    size_t numVortons = vortons.size() ;
-    for( size_t iVort = 0 ; iVort < numVortons ; ++ iVort )
-    {   // For each vorton...
-        const Vorton & vort = vortons[ iVort ] ;
+/// Number of vertices per vorton for diagnostic lines: 2 for a property vector, plus 6 for axes indicating boundary hits.
+#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
+static const size_t sNumDiagnosticLineVertsPerVorton = 8 ;
+#else
+static const size_t sNumDiagnosticLineVertsPerVorton = 2 ;
+#endif
 
-        Vec4   color( 1.0f , 1.0f , 1.0f , 0.5f ) ;
 
-        // Make opacity depend on distance to gridpoint.
-        //color.w = 0.25f * Min2( vort.GetRadius() / distToNearestGridPoint , 1.0f ) ;
 
-        // Modulate opacity based on distance to camera target.
-        float emphasis = CameraFocusEmphasis( vort.mPosition ) ;
-
-        if( emphasis > 0.01f )
-        {   // Diagnostic information is opaque enough to render.
-
-            if( ( mGridDecorations == GRID_DECO_CELLS ) || ( mGridDecorations == GRID_DECO_CELLS_AND_POINTS ) )
-            {   // Grid cell rendering is enabled.
-                if( velGrid.Encompasses( vort.mPosition ) && ( VORTON_PROPERTY_POSITION == mVortonProperty ) )
-                {   // Vorton is still inside grid.
-                    // Note that since this gets rendered after vorton advected, the
-                    // vorton is no longer necessarily near the gridpoint it was nearest
-                    // pre-advect. That means some of this diagnostic information is
-                    // suspect and has a good chance of being wrong fairly often.
-
-                    unsigned    nearestGridPointIndices[ 4 ]    ; // indices of grid cell containing vorton.
-                    velGrid.IndicesOfNearestGridPoint( nearestGridPointIndices , vort.mPosition ) ; // Get indices of grid cell containing vorton.
-                    const Vec3  nearestGridPointPosition        = velGrid.PositionFromIndices( nearestGridPointIndices ) ;
-                    // Draw a line from the vorton to the nearest gridpoint.
-                    glLineWidth( lineWidth ) ;
-                    glBegin( GL_LINES ) ;
-                    glColor4f( 1.0f , 0.0f , 1.0f , emphasis * color.w ) ; // Magenta
-                    glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition           ) ) ;
-                    glVertex3fv( reinterpret_cast< const GLfloat * >( & nearestGridPointPosition ) ) ;
-                    glEnd() ;
-                    glPointSize( pointSize ) ;
-                    glBegin( GL_POINTS ) ;
-                    glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                    glEnd() ;
-                }
-            }
 
-            if( mVortonProperty == VORTON_PROPERTY_VELOCITY )
-            {
-                const float val0to1 = vort.mVelocity.Magnitude() * rangeScale ;
-                color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
-                glColor4f( color.x , color.y , color.z , emphasis * color.w ) ;
-                // Draw a line indicating velocity direction.
-                Vec3 velDirEnd = vort.mPosition + vort.mVelocity * vort.GetRadius() * rangeScale ;
-                glLineWidth( lineWidth ) ;
-                glBegin( GL_LINES ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & velDirEnd       ) ) ;
-                glEnd() ;
-                glPointSize( pointSize ) ;
-                glBegin( GL_POINTS ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glEnd() ;
-            }
+/** Assign vertices for diagnostic vectors of a subset of vortons.
 
-            if( VORTON_PROPERTY_VORTICITY == mVortonProperty )
-            {
-                const float val0to1 = vort.GetVorticity().Magnitude() * rangeScale ;
-                color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
-                glColor4f( color.x , color.y , color.z , emphasis * color.w ) ;
-                // Draw a line indicating vorticity.
-                Vec3 vortDirEnd = vort.mPosition + vort.GetVorticity() * vort.GetRadius() * rangeScale ;
-                glLineWidth( lineWidth ) ;
-                glBegin( GL_LINES ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vortDirEnd      ) ) ;
-                glEnd() ;
-                glPointSize( pointSize ) ;
-                glBegin( GL_POINTS ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glEnd() ;
-            }
+    \param lineVerts    Vertices of lines for all vortons, sNumDiagnosticLineVertsPerVorton per vorton.
 
-            if( mVortonProperty == VORTON_PROPERTY_DENSITY )
-            {
-                const float val0to1 = vort.GetDensity() * rangeScale ;
-                color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
-                glColor4f( color.x , color.y , color.z , emphasis * color.w ) ;
+    \param pointVerts   Vertices of points for all vortons, 1 per vorton.
 
-                // Draw a point indicating vorton position.
-                glPointSize( pointSize ) ;
-                glBegin( GL_POINTS ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glEnd() ;
-            }
+    \param rangeScale   Reciprocal of range of diagnostic property values.
 
-            if( ( mVortonProperty == VORTON_PROPERTY_DENSITY_SPH ) && ! rVortonSim.GetFluidDensitiesAtPcls().Empty() )
-            {
-                const float & densitySph = rVortonSim.GetFluidDensitiesAtPcls()[ iVort ].mMassDensity ;
-                const float val0to1 = densitySph * rangeScale ;
-                color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
-                glColor4f( color.x , color.y , color.z , emphasis * color.w ) ;
+    \param iVortStart   Index of first vorton whose vertices to assign.
 
-                // Draw a point indicating vorton position.
-                glPointSize( pointSize ) ;
-                glBegin( GL_POINTS ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glEnd() ;
-            }
+    \param iVortEnd     One past index of last vorton whose vertices to assign.
 
-#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
-            if( ( VORTON_PROPERTY_DENSITY_GRADIENT == mVortonProperty ) && ! rVortonSim.GetDensityGradientsAtPcls().Empty()  )
-            {
-                const Vec3 & densGrad = rVortonSim.GetDensityGradientsAtPcls()[ iVort ] ;
-                const float val0to1 = densGrad.Magnitude() * rangeScale ;
-                color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
-                glColor4f( color.x , color.y , color.z , emphasis * color.w ) ;
-                // Draw a line indicating density gradient.
-                Vec3 densGradDirEnd = vort.mPosition + densGrad * vort.GetRadius() * rangeScale ;
-                glLineWidth( lineWidth ) ;
-                glBegin( GL_LINES ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & densGradDirEnd  ) ) ;
-                glEnd() ;
-                glPointSize( pointSize ) ;
-                glBegin( GL_POINTS ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glEnd() ;
-            }
-#endif
+    Lines and points a vorton does not use are hidden.
+*/
+void InteSiVis::FillVortonDiagnosticVectorsSlice( DiagnosticBatch::Vertex * lineVerts , DiagnosticBatch::Vertex * pointVerts , float rangeScale , size_t iVortStart , size_t iVortEnd ) const
+{
+    VortonSim &                 rVortonSim  = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    const VECTOR< Vorton > &    vortons     = * rVortonSim.GetVortons() ;
+    const UniformGrid< Vec3 > & velGrid     = rVortonSim.GetVelocityGrid() ;
 
-            if( ( mVortonProperty == VORTON_PROPERTY_PROXIMITY ) && ! rVortonSim.GetProximities().Empty() )
-            {
-                const float & proximity = rVortonSim.GetProximities()[ iVort ] ;
-                const float val0to1     = proximity * rangeScale ;
-                color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
-                glColor4f( color.x , color.y , color.z , emphasis * color.w ) ;
+    for( size_t iVort = iVortStart ; iVort < iVortEnd ; ++ iVort )
+    {   // For each vorton...
+        const Vorton &              vort            = vortons[ iVort ] ;
+        DiagnosticBatch::Vertex *   vortLineVerts   = lineVerts + sNumDiagnosticLineVertsPerVorton * iVort ;
+        DiagnosticBatch::Vertex &   vortPointVert   = pointVerts[ iVort ] ;
 
-                // Draw a point indicating vorton position.
-                glPointSize( pointSize ) ;
-                glBegin( GL_POINTS ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glEnd() ;
-            }
+        for( size_t iVert = 0 ; iVert < sNumDiagnosticLineVertsPerVorton ; ++ iVert )
+        {   // Hide each line vertex unless a diagnostic below uses it.
+            DiagnosticBatch::SetHiddenVertex( vortLineVerts[ iVert ] , vort.mPosition ) ;
+        }
+        DiagnosticBatch::SetHiddenVertex( vortPointVert , vort.mPosition ) ;
 
-#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
-            if( vort.mHitBoundary )
-            {   // Vorton hit boundary. Draw a line indicating hit state.
-                glPushAttrib( GL_ENABLE_BIT | GL_LINE_BIT ) ;
-                glEnable( GL_LINE_SMOOTH ) ;
-                //glLineWidth( 3.0f ) ;
-                glBegin( GL_LINES ) ;
-                glColor4f( 0.0f , 0.0f , 0.0f , emphasis * color.w ) ;
-                Vec3 velHitEnd = vort.mPosition + Vec3( 1.0f , 0.0f , 0.0f ) * vort.GetRadius() * 0.5f;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & velHitEnd       ) ) ;
-                velHitEnd = vort.mPosition + Vec3( 0.0f , 1.0f , 0.0f ) * vort.GetRadius() * 0.5f;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & velHitEnd       ) ) ;
-                velHitEnd = vort.mPosition + Vec3( 0.0f , 0.0f , 1.0f ) * vort.GetRadius() * 0.5f;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & vort.mPosition  ) ) ;
-                glVertex3fv( reinterpret_cast< const GLfloat * >( & velHitEnd       ) ) ;
-                glEnd() ;
-                glPopAttrib() ;
+        // Modulate opacity based on distance to camera target.
+        const float emphasis = CameraFocusEmphasis( vort.mPosition ) ;
+
+        if( emphasis <= 0.01f )
+        {   // Diagnostic information is too transparent to render.
+            continue ;
+        }
+
+        Vec4    color( 1.0f , 1.0f , 1.0f , 0.5f ) ;
+        Vec3    lineEnd ;
+        bool    drawLine    = false ;
+        bool    drawPoint   = false ;
+
+        if( VORTON_PROPERTY_POSITION == mVortonProperty )
+        {
+            if(     ( ( mGridDecorations == GRID_DECO_CELLS ) || ( mGridDecorations == GRID_DECO_CELLS_AND_POINTS ) )
+                &&  velGrid.Encompasses( vort.mPosition ) )
+            {   // Grid cell rendering is enabled and vorton is still inside grid.
+                // Note that since this gets rendered after vorton advected, the
+                // vorton is no longer necessarily near the gridpoint it was nearest
+                // pre-advect. That means some of this diagnostic information is
+                // suspect and has a good chance of being wrong fairly often.
+
+                unsigned    nearestGridPointIndices[ 4 ]    ; // indices of grid cell containing vorton.
+                velGrid.IndicesOfNearestGridPoint( nearestGridPointIndices , vort.mPosition ) ; // Get indices of grid cell containing vorton.
+                // Draw a line from the vorton to the nearest gridpoint.
+                lineEnd     = velGrid.PositionFromIndices( nearestGridPointIndices ) ;
+                color       = Vec4( 1.0f , 0.0f , 1.0f , color.w ) ; // Magenta
+                drawLine    = true ;
+                drawPoint   = true ;
             }
+        }
+        else if( VORTON_PROPERTY_VELOCITY == mVortonProperty )
+        {
+            const float val0to1 = vort.mVelocity.Magnitude() * rangeScale ;
+            color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
+            // Draw a line indicating velocity direction.
+            lineEnd     = vort.mPosition + vort.mVelocity * vort.GetRadius() * rangeScale ;
+            drawLine    = true ;
+            drawPoint   = true ;
+        }
+        else if( VORTON_PROPERTY_VORTICITY == mVortonProperty )
+        {
+            const float val0to1 = vort.GetVorticity().Magnitude() * rangeScale ;
+            color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
+            // Draw a line indicating vorticity.
+            lineEnd     = vort.mPosition + vort.GetVorticity() * vort.GetRadius() * rangeScale ;
+            drawLine    = true ;
+            drawPoint   = true ;
+        }
+        else if( VORTON_PROPERTY_DENSITY == mVortonProperty )
+        {
+            const float val0to1 = vort.GetDensity() * rangeScale ;
+            color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
+            // Draw a point indicating vorton position.
+            drawPoint   = true ;
+        }
+        else if( ( VORTON_PROPERTY_DENSITY_SPH == mVortonProperty ) && ! rVortonSim.GetFluidDensitiesAtPcls().Empty() )
+        {
+            const float & densitySph = rVortonSim.GetFluidDensitiesAtPcls()[ iVort ].mMassDensity ;
+            const float val0to1 = densitySph * rangeScale ;
+            color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
+            // Draw a point indicating vorton position.
+            drawPoint   = true ;
+        }
+#if COMPUTE_DENSITY_AND_GRADIENT_AT_AND_WITH_VORTONS_USING_SPH || USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
+        else if( ( VORTON_PROPERTY_DENSITY_GRADIENT == mVortonProperty ) && ! rVortonSim.GetDensityGradientsAtPcls().Empty()  )
+        {
+            const Vec3 & densGrad = rVortonSim.GetDensityGradientsAtPcls()[ iVort ] ;
+            const float val0to1 = densGrad.Magnitude() * rangeScale ;
+            color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
+            // Draw a line indicating density gradient.
+            lineEnd     = vort.mPosition + densGrad * vort.GetRadius() * rangeScale ;
+            drawLine    = true ;
+            drawPoint   = true ;
+        }
 #endif
+        else if( ( VORTON_PROPERTY_PROXIMITY == mVortonProperty ) && ! rVortonSim.GetProximities().Empty() )
+        {
+            const float & proximity = rVortonSim.GetProximities()[ iVort ] ;
+            const float val0to1     = proximity * rangeScale ;
+            color = GetColorFromRamp( sVortonColorRamp , val0to1 ) ;
+            // Draw a point indicating vorton position.
+            drawPoint   = true ;
+        }
+
+        const Vec4 emphasizedColor( color.x , color.y , color.z , emphasis * color.w ) ;
+        if( drawLine )
+        {
+            DiagnosticBatch::SetVertex( vortLineVerts[ 0 ] , vort.mPosition , emphasizedColor ) ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 1 ] , lineEnd        , emphasizedColor ) ;
         }
+        if( drawPoint )
+        {
+            DiagnosticBatch::SetVertex( vortPointVert , vort.mPosition , emphasizedColor ) ;
+        }
+
+#if POISON_DENSITY_GRADIENT_BASED_ON_VORTONS_HITTING_WALLS
+        if( vort.mHitBoundary )
+        {   // Vorton hit boundary. Draw lines along each axis indicating hit state.
+            const Vec4  hitColor( 0.0f , 0.0f , 0.0f , emphasis * color.w ) ;
+            const float hitLength = vort.GetRadius() * 0.5f ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 2 ] , vort.mPosition                                   , hitColor ) ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 3 ] , vort.mPosition + Vec3( hitLength , 0.0f , 0.0f ) , hitColor ) ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 4 ] , vort.mPosition                                   , hitColor ) ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 5 ] , vort.mPosition + Vec3( 0.0f , hitLength , 0.0f ) , hitColor ) ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 6 ] , vort.mPosition                                   , hitColor ) ;
+            DiagnosticBatch::SetVertex( vortLineVerts[ 7 ] , vort.mPosition + Vec3( 0.0f , 0.0f , hitLength ) , hitColor ) ;
+        }
+#endif
     }
 }
 
 
 
 
+/** Render diagnostic vectors for vortex particles.
+
+    This draws all lines with one draw call and all points with another.
+*/
+void InteSiVis::QdRenderVortonDiagnosticVectors()
+{
+    PERF_BLOCK( InteSiVis__QdRenderVortonDiagnosticVectors ) ;
+
+    ASSERT(     ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_VECTORS )
+            ||  ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_PARTICLES_AND_VECTORS )
+            ||  ( mFluidScene.GetVortonRenderingStyle() == FluidScene::VORTON_RENDER_ALL ) ) ;
+
+    VortonSim &                 rVortonSim  = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    const size_t                numVortons  = rVortonSim.GetVortons()->Size() ;
+
+    float rangeScale ;
+    SetDiagnosticPropertyValueRangeScale( rangeScale ) ;
+
+    static const float lineWidth = 1.0f ;
+    static const float pointSize = 3.0f ;
+
+    // Batch holds line vertices for all vortons, followed by point vertices for all vortons.
+    const size_t numLineVerts = sNumDiagnosticLineVertsPerVorton * numVortons ;
+
+    DiagnosticBatch::Vertex * vertices      = mVortonDiagnosticBatch.Lock( numLineVerts + numVortons ) ;
+    DiagnosticBatch::Vertex * pointVertices = vertices + numLineVerts ;
+    // Estimate grain size based on size of problem and number of processors.
+    const size_t grainSize = Max2( size_t( 1 ) , numVortons / gNumberOfProcessors ) ;
+    Parallel::For( 0 , numVortons , grainSize , Parallel::Method( this , & InteSiVis::FillVortonDiagnosticVectorsSlice , vertices , pointVertices , rangeScale ) ) ;
+    mVortonDiagnosticBatch.Unlock() ;
+
+    mPathlineMaterial.UseMaterial() ;
+    glLineWidth( lineWidth ) ;
+    mVortonDiagnosticBatch.Draw( GL_LINES , 0 , numLineVerts ) ;
+    glPointSize( pointSize ) ;
+    mVortonDiagnosticBatch.Draw( GL_POINTS , numLineVerts , numVortons ) ;
+}
+
+
+
+
 /** Render grid to visualize values.
 */
 void InteSiVis::QdRenderDiagnosticGrid()
@@ -1477,16 +1406,16 @@ void InteSiVis::QdRenderDiagnosticGrid()
         // Render bounding box -- intentionally before all opaque objects, with depth write disabled, so grid is behind everything else.
         if( GRID_FIELD_VELOCITY == mGridField )
         {
-            DrawGrid_Vectors( vortonSim.GetVelocityGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+            DrawGrid_Vectors( vortonSim.GetVelocityGridSnapshot() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
         }
         else if( GRID_FIELD_DENSITY_GRADIENT == mGridField )
         {
-            DrawGrid_Vectors( vortonSim.GetDensityGradientGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+            DrawGrid_Vectors( vortonSim.GetDensityGradientGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
         }
 #if COMPUTE_PRESSURE_GRADIENT
         else if( GRID_FIELD_PRESSURE_GRADIENT == mGridField )
         {
-            DrawGrid_Vectors( vortonSim.GetPressureGradientGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+            DrawGrid_Vectors( vortonSim.GetPressureGradientGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
         }
 #endif
         else if( GRID_FIELD_NEGATIVE_VORTICITY == mGridField )
@@ -1496,7 +1425,7 @@ void InteSiVis::QdRenderDiagnosticGrid()
             {
                 sNestedGridLayerToRender = Clamp( sNestedGridLayerToRender , size_t( 0 ) , negVorticityMultiGrid.GetDepth() - 1 ) ;
                 const UniformGrid< Vec3 > & negVorticityGrid = negVorticityMultiGrid[ sNestedGridLayerToRender ] ;
-                DrawGrid_Vectors( negVorticityGrid , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+                DrawGrid_Vectors( negVorticityGrid , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
             }
         }
         else if( GRID_FIELD_VECTOR_POTENTIAL == mGridField )
@@ -1514,16 +1443,16 @@ void InteSiVis::QdRenderDiagnosticGrid()
                 {   // Upsample nested grid.  Populate this layer (sNestedGridLayerToRender ) with upsampled data from coarser layer (sNestedGridLayerToRender+1)
                     vecPotMultiGrid.UpSampleFrom( unsigned( sNestedGridLayerToRender + 1 ) ) ;
                 }
-                DrawGrid_Vectors( vecPotGrid , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+                DrawGrid_Vectors( vecPotGrid , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
             }
         }
         else if( GRID_FIELD_DENSITY == mGridField )
         {
-            DrawGrid_Scalars( vortonSim.GetDensityGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+            DrawGrid_Scalars( vortonSim.GetDensityGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
         }
         else if( GRID_FIELD_SIGNED_DISTANCE == mGridField )
         {
-            DrawGrid_Scalars( vortonSim.GetSignedDistanceGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText ) ;
+            DrawGrid_Scalars( vortonSim.GetSignedDistanceGrid() , mBoundingBoxMaterial , mGridDecorations , bRenderDiagnosticText , mGridCellsBatch , mGridPointsBatch ) ;
         }
     }
 }
@@ -1610,15 +1539,14 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
             RenderDiagnosticIntegralsText( 110.0f , "difs" , di.mAfterBaroclinic , di.mAfterDiffuse     ) ;
             RenderDiagnosticIntegralsText( 120.0f , "heat" , di.mAfterDiffuse    , di.mAfterHeat        ) ;
         }
+        // Gather statistics of all vorton properties in one pass.
+        VortonSim::VortonStatistics stats ;
+        vortonSim.GatherStatistics( stats ) ;
         // Render vorticity statistics.
         {
-            float vorticityMin , vorticityMax , vorticityMean , vorticityStdDev ;
-            Vec3 centerOfVorticity ;
-
-            vortonSim.GatherVorticityStats( vorticityMin , vorticityMax , vorticityMean , vorticityStdDev , centerOfVorticity ) ;
             oglRenderString( Vec3( 10.0f , 130.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "omega:[%.0f,%.0f]<%g>+-%-.0f #=%i CoV=%g,%g,%g"
-                , vorticityMin , vorticityMax , vorticityMean , vorticityStdDev , vortonSim.GetVortons()->size()
-                , centerOfVorticity.x , centerOfVorticity.y , centerOfVorticity.z
+                , stats.mVorticity.mMin , stats.mVorticity.mMax , stats.mVorticity.mMean , stats.mVorticity.mStdDev , vortonSim.GetVortons()->size()
+                , stats.mCenterOfVorticity.x , stats.mCenterOfVorticity.y , stats.mCenterOfVorticity.z
                 ) ;
             const VortonSim::VorticityTermsStatistics & vortTermStats = vortonSim.GetVorticityTermsStatistics() ;
 
@@ -1635,60 +1563,35 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
         }
         // Render vorton velocity statistics.
         {
-            float velocityMin , velocityMax , velocityMean , velocityStdDev ;
-            Vec3 centerOfVelocity ;
-            Particles::ComputeVelocityStats( * reinterpret_cast< VECTOR< Particle > * >( vortonSim.GetVortons() ) , velocityMin , velocityMax , velocityMean , velocityStdDev , centerOfVelocity ) ;
-
             oglRenderString( Vec3( 10.0f , 170.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "vel:[%.3f,%.3f]<%.3f>+-%-.3f"
-                , velocityMin , velocityMax , velocityMean , velocityStdDev
+                , stats.mVelocity.mMin , stats.mVelocity.mMax , stats.mVelocity.mMean , stats.mVelocity.mStdDev
                 ) ;
         }
         // Render vorton fluid temperature statistics.
         {
-            float temperatureMin , temperatureMax , temperatureMean , temperatureStdDev ;
-            vortonSim.GatherTemperatureStats( temperatureMin , temperatureMax , temperatureMean , temperatureStdDev ) ;
-
             oglRenderString( Vec3( 10.0f , 180.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "Temp:[%.0f,%.0f]<%.0f>+-%-.0f"
-                , temperatureMin , temperatureMax , temperatureMean , temperatureStdDev
+                , stats.mTemperature.mMin , stats.mTemperature.mMax , stats.mTemperature.mMean , stats.mTemperature.mStdDev
                 ) ;
         }
         // Render vorton fluid density statistics.
         {
-            float densityMin , densityMax , densityMean , densityStdDev ;
-            vortonSim.GatherDensityStats( densityMin , densityMax , densityMean , densityStdDev ) ;
-
-            float densitySphMin , densitySphMax , densitySphMean , densitySphStdDev ;
-            vortonSim.GatherDensitySphStats( densitySphMin , densitySphMax , densitySphMean , densitySphStdDev ) ;
-
-            float numDensSphMin , numDensSphMax , numDensSphMean , numDensSphStdDev ;
-            vortonSim.GatherNumberDensitySphStats( numDensSphMin , numDensSphMax , numDensSphMean , numDensSphStdDev ) ;
-
-            float densGradSphMin , densGradSphMax , densGradSphMean , densGradSphStdDev ;
-            vortonSim.GatherDensityGradientStats( densGradSphMin , densGradSphMax , densGradSphMean , densGradSphStdDev ) ;
-
             oglRenderString( Vec3( 10.0f , 190.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "dens:[%.3f,%.3f]<%.3f>+-%-.3f    densSph:[%.3f,%.3f]<%.3f>+-%-.3f    #densSph:[%.3f,%.3f]<%.3f>+-%-.3f    densGradSph:[%.3f,%.3f]<%.3f>+-%-.3f"
-                , densityMin , densityMax , densityMean , densityStdDev
-                , densitySphMin , densitySphMax , densitySphMean , densitySphStdDev
-                , numDensSphMin , numDensSphMax , numDensSphMean , numDensSphStdDev
-                , densGradSphMin , densGradSphMax , densGradSphMean , densGradSphStdDev
+                , stats.mDensity.mMin           , stats.mDensity.mMax           , stats.mDensity.mMean          , stats.mDensity.mStdDev
+                , stats.mDensitySph.mMin        , stats.mDensitySph.mMax        , stats.mDensitySph.mMean       , stats.mDensitySph.mStdDev
+                , stats.mNumberDensitySph.mMin  , stats.mNumberDensitySph.mMax  , stats.mNumberDensitySph.mMean , stats.mNumberDensitySph.mStdDev
+                , stats.mDensityGradient.mMin   , stats.mDensityGradient.mMax   , stats.mDensityGradient.mMean  , stats.mDensityGradient.mStdDev
                 ) ;
         }
         // Render fluid signed distance function statistics.
         {
-            float sdfMin , sdfMax , sdfMean , sdfStdDev ;
-            vortonSim.GatherSignedDistanceStats( sdfMin , sdfMax , sdfMean , sdfStdDev ) ;
-
             oglRenderString( Vec3( 10.0f , 200.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "sdf:[%.3f,%.3f]<%.3f>+-%-.3f"
-                , sdfMin , sdfMax , sdfMean , sdfStdDev
+                , stats.mSignedDistance.mMin , stats.mSignedDistance.mMax , stats.mSignedDistance.mMean , stats.mSignedDistance.mStdDev
                 ) ;
         }
         // Render vorton fluid proximity-to-walls statistics.
         {
-            float proximityMin , proximityMax , proximityMean , proximityStdDev ;
-            vortonSim.GatherProximityStats( proximityMin , proximityMax , proximityMean , proximityStdDev ) ;
-
             oglRenderString( Vec3( 10.0f , 210.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "proximity:[%.3f,%.3f]<%.3f>+-%-.3f"
-                , proximityMin , proximityMax , proximityMean , proximityStdDev
+                , stats.mProximity.mMin , stats.mProximity.mMax , stats.mProximity.mMean , stats.mProximity.mStdDev
                 ) ;
         }
         {
@@ -1698,12 +1601,25 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
                 , gVortonSim_DisplacementMax
                 , gVortonSim_NumRelaxationIters ) ;
         }
-        // Render tracer count and other info.
+        // Render tracer count, memory usage and other info.
         {
-            oglRenderString( Vec3( 10.0f , 230.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "tracers: #=%i    layer=%i  resample=%i"
+            // Summarize memory each subsystem uses, in MiB.  '!' marks subsystems over their caps.
+            char memoryText[ 512 ] ;
+            int  memoryTextLength = 0 ;
+            for( int subsystem = 0 ; subsystem < MemoryBudget::NUM_SUBSYSTEMS ; ++ subsystem )
+            {   // For each subsystem whose memory the budget accounts for...
+                const MemoryBudget::SubsystemE subsystemE = MemoryBudget::SubsystemE( subsystem ) ;
+                memoryTextLength += sprintf( memoryText + memoryTextLength , "%s=%.1f%s  "
+                    , MemoryBudget::GetSubsystemName( subsystemE )
+                    , float( mMemoryBudget.GetUsage( subsystemE ) ) / float( 1 << 20 )
+                    , mMemoryBudget.IsOverCap( subsystemE ) ? "!" : "" ) ;
+            }
+            oglRenderString( Vec3( 10.0f , 230.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "tracers: #=%i    layer=%i  resample=%i    MiB: %stotal=%.1f"
                 , mTracerPclGrpInfo.mParticleGroup->GetParticles().Size()
                 , sNestedGridLayerToRender
                 , sNestedGridLayerReSample
+                , memoryText
+                , float( mMemoryBudget.GetTotalUsage() ) / float( 1 << 20 )
                 ) ;
         }
         // Render diagnostic state.
@@ -1735,6 +1651,8 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
 
 #elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_MONOPOLES // No longer supported
             static const char sVelTeq[] = "VELOCITY_TECHNIQUE_MONOPOLES" ;
+#elif VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM
+            static const char sVelTeq[] = "VELOCITY_TECHNIQUE_FMM" ;
 #else
 #           error "VELOCITY_TECHNIQUE invalid or not supported in this piece of code."
 #endif
@@ -1742,9 +1660,11 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
             // As of 2016 May these stats are neither thread-safe nor deterministic when run with TBB.  Currently only meaningful for ProfileWithoutTbb build.
             const Stats_Float & residuStats       = vortonSim.GetPoissonResidualStats() ;
             const Stats_Float & residuStats_xTime = vortonSim.GetPoissonResidualStats_AcrossTime() ;
-            oglRenderString( Vec3( 10.0f , 250.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "simTeq=%s    velTeq=%s    poissonResidual=[%g,%g] %g+-%g    residualAcrossTime=[%g,%g] %g+-%g"
+            oglRenderString( Vec3( 10.0f , 250.0f , 0.0f ) , GLUT_BITMAP_HELVETICA_10 , "simTeq=%s    velTeq=%s    velFromVort=%s(%s)    poissonResidual=[%g,%g] %g+-%g    residualAcrossTime=[%g,%g] %g+-%g"
                 , FluidSimulationTechniqueString()
                 , sVelTeq
+                , VortonSim::GetVelocityFromVorticityTechniqueName( vortonSim.GetVelocityFromVorticityTechniqueInEffect() )
+                , VortonSim::GetVelocityFromVorticityTechniqueName( vortonSim.GetVelocityFromVorticityTechnique() )
                 , residuStats.mMin , residuStats.mMax , residuStats.mMean , residuStats.mStdDev
                 , residuStats_xTime.mMin , residuStats_xTime.mMax , residuStats_xTime.mMean , residuStats_xTime.mStdDev
                 ) ;
@@ -1796,6 +1716,8 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
                 strcat( filename , "-TREE" ) ;
             #elif ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL )
                 strcat( filename , "-POISSON" ) ;
+            #elif ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM )
+                strcat( filename , "-FMM" ) ;
             #endif
             #if COMPUTE_VELOCITY_AT_VORTONS
                 strcat( filename , "-VAV" ) ;
@@ -1820,6 +1742,8 @@ void InteSiVis::QdRenderSummaryDiagnosticText()
                 fprintf( jerkFile , "TREE " ) ;
             #elif ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_POISSON_GAUSS_SEIDEL )
                 fprintf( jerkFile , "POISSON " ) ;
+            #elif ( VELOCITY_TECHNIQUE == VELOCITY_TECHNIQUE_FMM )
+                fprintf( jerkFile , "FMM " ) ;
             #endif
             #if COMPUTE_VELOCITY_AT_VORTONS
                 fprintf( jerkFile , "COMPUTE_VELOCITY_AT_VORTONS " ) ;
@@ -21,3 +21,23 @@ void Entity::Update()
         mSceneNode->SetOrientation( mPhysicalObject->GetBody()->GetOrientation() ) ;
     }
 }
+
+
+
+
+/** Transfer given pose, rather than that of the physical object, into the render model.
+
+    This lets rendering use a pose recorded earlier, for example in a FrameSnapshot,
+    while the physical object moves on.
+*/
+void Entity::Update( const Vec3 & position , const Mat33 & orientation )
+{
+    PERF_BLOCK( Entity__Update_FromPose ) ;
+
+    ASSERT( mSceneNode ) ;
+    if( mSceneNode )
+    {
+        mSceneNode->SetPosition( position ) ;
+        mSceneNode->SetOrientation( orientation ) ;
+    }
+}
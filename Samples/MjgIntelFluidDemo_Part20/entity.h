@@ -21,6 +21,8 @@ namespace PeGaSys
 } ;
 
 class QdModel ;
+struct Vec3 ;
+struct Mat33 ;
 
 
 
@@ -38,6 +40,7 @@ class Entity
         ~Entity() {}
 
         void Update() ;
+        void Update( const Vec3 & position , const Mat33 & orientation ) ;
 
         Impulsion::PhysicalObject  *        mPhysicalObject ;   /// Physics simulation object associated with this entity, but this entity does not own it.
         PeGaSys::Render::ModelNode  *       mSceneNode      ;   /// Scene associated with this entity, but this entity does not own it; a SceneManager does.
@@ -0,0 +1,104 @@
+/** \file fixedStepScheduler.cpp
+
+    \brief Scheduler that runs simulation steps of fixed duration at the pace of real time, independent of display rate.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "fixedStepScheduler.h"
+
+#include <Core/Utility/macros.h>
+
+#include <math.h>
+
+// Public variables --------------------------------------------------------------
+
+const float FixedStepScheduler::sDefaultBudgetSeconds = 0.05f ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct a scheduler that owes no steps.
+*/
+FixedStepScheduler::FixedStepScheduler()
+    : mStepDuration( 0.0f )
+    , mAccumulator( 0.0f )
+    , mBudgetSeconds( sDefaultBudgetSeconds )
+    , mInterpolationFraction( 1.0f )
+    , mMaxStepsPerFrame( sDefaultMaxStepsPerFrame )
+    , mStepsThisFrame( 0 )
+    , mNumOverruns( 0 )
+{
+}
+
+
+
+
+/** Forget accumulated time, so rendering shows the state after the most recent step.
+
+    Call this when simulation does not run on the clock, for example while
+    paused or single-stepping, so resuming does not try to catch up.
+*/
+void FixedStepScheduler::Reset()
+{
+    mAccumulator            = 0.0f ;
+    mInterpolationFraction  = 1.0f ;
+    mStepsThisFrame         = 0 ;
+}
+
+
+
+
+/** Add the real time the most recent frame took, to be consumed by ShouldStep.
+
+    \param realSeconds  Real time since the previous call.
+*/
+void FixedStepScheduler::Accumulate( float realSeconds )
+{
+    mAccumulator    += Max2( realSeconds , 0.0f ) ;
+    mStepsThisFrame  = 0 ;
+}
+
+
+
+
+/** Return whether to run another simulation step this frame, and if so, account for it.
+
+    \param realSecondsSpentStepping Real time that steps this frame have taken so far.
+
+    Call this in a loop, running one step each time it returns true.  Once
+    it returns false, GetInterpolationFraction tells rendering how far past
+    the most recent step real time has gone.
+*/
+bool FixedStepScheduler::ShouldStep( float realSecondsSpentStepping )
+{
+    if( mStepDuration <= 0.0f )
+    {   // Steps have no duration, so no amount of time would ever consume them.
+        mAccumulator            = 0.0f ;
+        mInterpolationFraction  = 1.0f ;
+        return false ;
+    }
+
+    if( mAccumulator >= mStepDuration )
+    {   // Real time has run at least one step ahead of simulation.
+        const bool reachedStepLimit = mStepsThisFrame >= mMaxStepsPerFrame ;
+        const bool exceededBudget   = ( mStepsThisFrame > 0 ) && ( realSecondsSpentStepping >= mBudgetSeconds ) ;
+        if( ! reachedStepLimit && ! exceededBudget )
+        {   // This frame can afford another step.
+            mAccumulator -= mStepDuration ;
+            ++ mStepsThisFrame ;
+            return true ;
+        }
+
+        // Simulation cannot keep up with real time.  Discard whole steps it owes, so the backlog does not grow each frame.
+        mAccumulator = fmodf( mAccumulator , mStepDuration ) ;
+        ++ mNumOverruns ;
+    }
+
+    mInterpolationFraction = Clamp( mAccumulator / mStepDuration , 0.0f , 1.0f ) ;
+    return false ;
+}
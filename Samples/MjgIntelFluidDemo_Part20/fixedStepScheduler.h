@@ -0,0 +1,82 @@
+/** \file fixedStepScheduler.h
+
+    \brief Scheduler that runs simulation steps of fixed duration at the pace of real time, independent of display rate.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FIXED_STEP_SCHEDULER_H
+#define FIXED_STEP_SCHEDULER_H
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Scheduler that runs simulation steps of fixed duration at the pace of real time, independent of display rate.
+
+    Each displayed frame, Accumulate adds the real time that frame took to
+    an accumulator, then the caller runs one simulation step per call to
+    ShouldStep that returns true, each of which consumes one step duration.
+    So a fast display runs zero steps on some frames, and a slow display
+    runs several steps on some frames, and simulation advances at the same
+    rate either way.
+
+    When simulation cannot keep up with real time, each frame would owe more
+    steps than the last, which would slow display further.  To avoid that,
+    ShouldStep stops after a maximum number of steps per frame, or once
+    steps this frame have taken longer than a budget, then discards the
+    backlog, so simulation runs slower than real time instead.
+
+    Whatever remains in the accumulator is time that has passed but that no
+    step has simulated yet.  GetInterpolationFraction expresses that as a
+    fraction of a step, by which rendering blends the state before the most
+    recent step toward the state after it, so motion appears smooth even
+    when frames run unequal numbers of steps.
+*/
+class FixedStepScheduler
+{
+    public:
+        static const unsigned   sDefaultMaxStepsPerFrame    = 4         ;   ///< Most steps to run per frame, unless SetMaxStepsPerFrame says otherwise.
+        static const float      sDefaultBudgetSeconds                   ;   ///< Real time steps may take per frame, unless SetBudgetSeconds says otherwise.
+
+        FixedStepScheduler() ;
+
+        void        Reset() ;
+        void        Accumulate( float realSeconds ) ;
+        bool        ShouldStep( float realSecondsSpentStepping ) ;
+
+        /// Set virtual time each step simulates, which is also the real time each step accounts for.
+        void        SetStepDuration( float stepDuration )               { mStepDuration = stepDuration ; }
+        float       GetStepDuration() const                             { return mStepDuration ; }
+
+        /// Set most steps to run per frame, beyond which simulation falls behind real time.
+        void        SetMaxStepsPerFrame( unsigned maxStepsPerFrame )    { mMaxStepsPerFrame = maxStepsPerFrame ; }
+        unsigned    GetMaxStepsPerFrame() const                         { return mMaxStepsPerFrame ; }
+
+        /// Set real time steps may take per frame, after which ShouldStep runs no more steps that frame.
+        void        SetBudgetSeconds( float budgetSeconds )             { mBudgetSeconds = budgetSeconds ; }
+        float       GetBudgetSeconds() const                            { return mBudgetSeconds ; }
+
+        /// Return fraction, in [0,1], of the way from the state before the most recent step to the state after it, that rendering should show.
+        float       GetInterpolationFraction() const                    { return mInterpolationFraction ; }
+
+        /// Return number of steps ShouldStep allowed since the most recent Accumulate.
+        unsigned    GetStepsThisFrame() const                           { return mStepsThisFrame ; }
+
+        /// Return number of times ShouldStep discarded backlog because simulation fell behind real time.
+        unsigned    GetNumOverruns() const                              { return mNumOverruns ; }
+
+    private:
+        float       mStepDuration           ;   ///< Virtual time each step simulates.
+        float       mAccumulator            ;   ///< Real time that has passed but that no step has simulated yet.
+        float       mBudgetSeconds          ;   ///< Real time steps may take per frame.
+        float       mInterpolationFraction  ;   ///< Fraction of a step by which real time leads the most recent step.
+        unsigned    mMaxStepsPerFrame       ;   ///< Most steps to run per frame.
+        unsigned    mStepsThisFrame         ;   ///< Number of steps ShouldStep allowed since the most recent Accumulate.
+        unsigned    mNumOverruns            ;   ///< Number of frames on which simulation fell behind real time.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
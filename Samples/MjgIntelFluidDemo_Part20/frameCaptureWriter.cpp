@@ -0,0 +1,272 @@
+/** \file frameCaptureWriter.cpp
+
+    \brief Recorder that writes captured screen frames to numbered image files, on a background thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "frameCaptureWriter.h"
+
+#include <Core/Performance/perfBlock.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const size_t sFileBufferSize = 1 << 20 ;    ///< Number of bytes stdio buffers before writing, so each frame writes in few system calls.
+
+// Functions --------------------------------------------------------------
+
+
+
+
+FrameCaptureWriter::FrameCaptureWriter( size_t capacity )
+    :
+#if FRAME_CAPTURE_WRITER_ASYNC
+      mWriterThread( NULL ) ,
+#endif
+      mIsOpen( false )
+    , mNumDroppedFrames( 0 )
+    , mHadWriteError( false )
+{
+    mFilenamePrefix[ 0 ] = '\0' ;
+#if FRAME_CAPTURE_WRITER_ASYNC
+    ASSERT( capacity >= 1 ) ;
+    mFree.set_capacity( capacity ) ;
+    mPending.set_capacity( capacity + 1 ) ; // Room for the NULL that tells the writer thread to exit.
+#else
+    capacity = 1 ;  // SubmitFrame writes each frame before returning, so one frame suffices.
+#endif
+    mFrames.Reserve( capacity ) ;
+    for( size_t iFrame = 0 ; iFrame < capacity ; ++ iFrame )
+    {   // For each frame to own...
+        mFrames.PushBack( new Frame ) ;
+    }
+}
+
+
+
+
+FrameCaptureWriter::~FrameCaptureWriter()
+{
+    Close() ;
+    const size_t numFrames = mFrames.Size() ;
+    for( size_t iFrame = 0 ; iFrame < numFrames ; ++ iFrame )
+    {   // For each frame this writer owns...
+        delete mFrames[ iFrame ] ;
+    }
+}
+
+
+
+
+/** Start the thread that writes frames into files whose names start with the given prefix.
+
+    \param filenamePrefix   Start of each frame's file name, which can include a directory.
+                            Frame N goes to filenamePrefixNNNNN.tga, overwriting any existing file.
+
+    \return Whether the prefix fit.
+*/
+bool FrameCaptureWriter::Open( const char * filenamePrefix )
+{
+    PERF_BLOCK( FrameCaptureWriter__Open ) ;
+
+    Close() ;
+
+    if( strlen( filenamePrefix ) + 16 > sizeof( mFilenamePrefix ) )
+    {   // Prefix leaves no room for frame index and extension.
+        return false ;
+    }
+    strcpy( mFilenamePrefix , filenamePrefix ) ;
+
+    mNumDroppedFrames   = 0 ;
+    mHadWriteError      = false ;
+    mIsOpen             = true ;
+
+#if FRAME_CAPTURE_WRITER_ASYNC
+    const size_t numFrames = mFrames.Size() ;
+    for( size_t iFrame = 0 ; iFrame < numFrames ; ++ iFrame )
+    {   // For each frame this writer owns...
+        mFree.push( mFrames[ iFrame ] ) ;
+    }
+    mWriterThread = CreateThread( NULL , 0 , WriterThreadMain , this , 0 , NULL ) ;
+    ASSERT( mWriterThread ) ;
+#endif
+    return true ;
+}
+
+
+
+
+/** Write all pending frames and stop the writer thread.
+*/
+void FrameCaptureWriter::Close()
+{
+    PERF_BLOCK( FrameCaptureWriter__Close ) ;
+
+    if( ! mIsOpen )
+    {   // Not open.
+        return ;
+    }
+
+#if FRAME_CAPTURE_WRITER_ASYNC
+    mPending.push( NULLPTR ) ;  // Tell writer thread to exit once it writes the frames ahead of this.
+    WaitForSingleObject( mWriterThread , INFINITE ) ;
+    CloseHandle( mWriterThread ) ;
+    mWriterThread = NULL ;
+    mFree.clear() ;
+#endif
+
+    mIsOpen = false ;
+}
+
+
+
+
+/** Copy the given frame, and queue it for writing.
+
+    \param frameImage   RGBA image of frame, bottom row first, such as OpenGL_FrameReadback::Collect provides.
+
+    \param frameIndex   Index of frame, which names its file.
+
+    This costs the caller only a copy of the image.  It never waits for the
+    disk: If every frame still awaits writing, this drops this frame.
+
+    \return Whether this queued the frame.  False means either the writer is not open, or it fell behind.
+*/
+bool FrameCaptureWriter::SubmitFrame( const PeGaSys::Image & frameImage , unsigned frameIndex )
+{
+    PERF_BLOCK( FrameCaptureWriter__SubmitFrame ) ;
+
+    ASSERT( ( 4 == frameImage.GetNumChannels() ) && ( 1 == frameImage.GetNumPages() ) ) ;
+
+    if( ! IsOpen() )
+    {
+        return false ;
+    }
+
+#if FRAME_CAPTURE_WRITER_ASYNC
+    Frame * frame = NULLPTR ;
+    if( ! mFree.try_pop( frame ) )
+    {   // Writer thread fell behind.  Drop this frame rather than stall the caller.
+        ++ mNumDroppedFrames ;
+        return false ;
+    }
+#else
+    Frame * frame = mFrames[ 0 ] ;
+#endif
+
+    if( ( frame->mImage.GetWidth() != frameImage.GetWidth() ) || ( frame->mImage.GetHeight() != frameImage.GetHeight() ) || ( frame->mImage.GetNumChannels() != frameImage.GetNumChannels() ) )
+    {   // Pooled image has a different shape than frame (or this is its first use), so reallocate it.
+        frame->mImage.CopyShape( frameImage ) ;
+    }
+    frame->mImage.CopyImageData( frameImage ) ;
+    frame->mFrameIndex = frameIndex ;
+
+#if FRAME_CAPTURE_WRITER_ASYNC
+    mPending.push( frame ) ;
+#else
+    WriteFrame( frame ) ;
+#endif
+    return true ;
+}
+
+
+
+
+/** Write the given frame to its own uncompressed 32-bit TGA file, remembering whether that failed.
+
+    TGA stores pixels as BGRA, so this reorders each row into a scanline before writing it.
+*/
+void FrameCaptureWriter::WriteFrame( Frame * frame )
+{
+    PERF_BLOCK( FrameCaptureWriter__WriteFrame ) ;
+
+    if( mHadWriteError )
+    {   // Disk full, or similar.  Stop writing, since later frames would likely fail too.
+        return ;
+    }
+
+    char filename[ sizeof( mFilenamePrefix ) ] ;
+    sprintf( filename , "%s%05u.tga" , mFilenamePrefix , frame->mFrameIndex ) ;
+
+    FILE * file = fopen( filename , "wb" ) ;
+    if( NULLPTR == file )
+    {
+        mHadWriteError = true ;
+        return ;
+    }
+    setvbuf( file , NULL , _IOFBF , sFileBufferSize ) ;
+
+    const PeGaSys::Image &  image   = frame->mImage ;
+    const unsigned          width   = image.GetWidth() ;
+    const unsigned          height  = image.GetHeight() ;
+
+    unsigned char header[ 18 ] ;
+    memset( header , 0 , sizeof( header ) ) ;
+    header[  2 ] = 2 ;                                              // Uncompressed true-color.
+    header[ 12 ] = static_cast< unsigned char >( width          ) ;
+    header[ 13 ] = static_cast< unsigned char >( width  >> 8    ) ;
+    header[ 14 ] = static_cast< unsigned char >( height         ) ;
+    header[ 15 ] = static_cast< unsigned char >( height >> 8    ) ;
+    header[ 16 ] = 32 ;                                             // Bits per pixel.
+    header[ 17 ] = 8 ;                                              // Alpha bits, and bottom-left origin, which matches OpenGL row order.
+    bool ok = fwrite( header , sizeof( header ) , 1 , file ) == 1 ;
+
+    mScanline.Resize( width * 4 ) ;
+    const unsigned xStride = image.GetXStride() ;
+    const unsigned yStride = image.GetYStride() ;
+    for( unsigned iy = 0 ; ok && ( iy < height ) ; ++ iy )
+    {   // For each row, bottom first...
+        const unsigned char *   src = image.GetImageData() + iy * yStride ;
+        unsigned char *         dst = & mScanline[ 0 ] ;
+        for( unsigned ix = 0 ; ix < width ; ++ ix )
+        {   // For each pixel in row...
+            dst[ 0 ] = src[ 2 ] ;
+            dst[ 1 ] = src[ 1 ] ;
+            dst[ 2 ] = src[ 0 ] ;
+            dst[ 3 ] = src[ 3 ] ;
+            src += xStride ;
+            dst += 4 ;
+        }
+        ok = fwrite( & mScanline[ 0 ] , mScanline.Size() , 1 , file ) == 1 ;
+    }
+
+    if( ( fclose( file ) != 0 ) || ! ok )
+    {
+        mHadWriteError = true ;
+    }
+}
+
+
+
+
+#if FRAME_CAPTURE_WRITER_ASYNC
+
+/** Write pending frames as they arrive, until Close says to exit.
+
+    \param context  Address of the FrameCaptureWriter instance.
+*/
+/* static */ DWORD WINAPI FrameCaptureWriter::WriterThreadMain( LPVOID context )
+{
+    FrameCaptureWriter * writer = reinterpret_cast< FrameCaptureWriter * >( context ) ;
+
+    for( ;; )
+    {   // For each frame submitted...
+        Frame * frame = NULLPTR ;
+        writer->mPending.pop( frame ) ;
+        if( NULLPTR == frame )
+        {   // Close wants this thread to exit.
+            break ;
+        }
+        writer->WriteFrame( frame ) ;
+        writer->mFree.push( frame ) ;
+    }
+
+    return 0 ;
+}
+
+#endif
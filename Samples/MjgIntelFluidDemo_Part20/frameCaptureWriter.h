@@ -0,0 +1,105 @@
+/** \file frameCaptureWriter.h
+
+    \brief Recorder that writes captured screen frames to numbered image files, on a background thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FRAME_CAPTURE_WRITER_H
+#define FRAME_CAPTURE_WRITER_H
+
+#include <Core/useTbb.h>
+
+#include <Core/Containers/vector.h>
+
+#include <Image/image.h>
+
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
+#if USE_TBB
+#   include "tbb/concurrent_queue.h"
+#endif
+
+// Macros --------------------------------------------------------------
+
+/** Whether FrameCaptureWriter encodes and writes on a background thread.
+
+    Otherwise, SubmitFrame writes synchronously, which stalls the caller
+    for the duration of the write, but produces the same files.
+*/
+#if USE_TBB && defined( WIN32 )
+#   define FRAME_CAPTURE_WRITER_ASYNC 1
+#else
+#   define FRAME_CAPTURE_WRITER_ASYNC 0
+#endif
+
+// Types --------------------------------------------------------------
+
+/** Recorder that writes captured screen frames to numbered image files, on a background thread.
+
+    Each frame becomes one uncompressed 32-bit TGA file, named by the prefix
+    given to Open followed by the frame index, which most video encoders
+    accept as an image sequence.  SubmitFrame only copies the frame into a
+    pooled image, so the render thread never waits for encoding or the disk.
+    If every pooled image still awaits writing, SubmitFrame drops the frame.
+
+    Frames use OpenGL row order (first row is the bottom), as
+    OpenGL_FrameReadback provides, which TGA stores without flipping.
+*/
+class FrameCaptureWriter
+{
+    public:
+        explicit FrameCaptureWriter( size_t capacity = 4 ) ;
+        ~FrameCaptureWriter() ;
+
+        bool    Open( const char * filenamePrefix ) ;
+        void    Close() ;
+
+        /// Return whether Open succeeded and Close has not happened since.
+        bool    IsOpen() const { return mIsOpen ; }
+
+        bool    SubmitFrame( const PeGaSys::Image & frameImage , unsigned frameIndex ) ;
+
+        /// Return number of frames SubmitFrame dropped because the writer fell behind, since Open.
+        size_t  GetNumDroppedFrames() const { return mNumDroppedFrames ; }
+
+        /// Return whether the writer failed to write some frame, since Open.
+        bool    GetHadWriteError() const { return mHadWriteError ; }
+
+    private:
+        /** Captured frame awaiting writing.
+        */
+        struct Frame
+        {
+            PeGaSys::Image  mImage      ;   ///< RGBA pixels of frame, bottom row first.
+            unsigned        mFrameIndex ;   ///< Caller-supplied index of frame, which names its file.
+        } ;
+
+        FrameCaptureWriter( const FrameCaptureWriter & ) ;              // Disallow copy
+        FrameCaptureWriter & operator=( const FrameCaptureWriter & ) ;  // Disallow assignment
+
+        void    WriteFrame( Frame * frame ) ;
+    #if FRAME_CAPTURE_WRITER_ASYNC
+        static DWORD WINAPI WriterThreadMain( LPVOID context ) ;
+    #endif
+
+        VECTOR< Frame * >                           mFrames             ;   ///< All frames this writer owns.
+    #if FRAME_CAPTURE_WRITER_ASYNC
+        tbb::concurrent_bounded_queue< Frame * >    mFree               ;   ///< Frames available for SubmitFrame to fill.
+        tbb::concurrent_bounded_queue< Frame * >    mPending            ;   ///< Frames SubmitFrame filled, oldest first, awaiting the writer thread.  NULL tells the thread to exit.
+        HANDLE                                      mWriterThread       ;   ///< Thread that writes pending frames.
+    #endif
+        VECTOR< unsigned char >                     mScanline           ;   ///< Pixels of one row, reordered for the file.  Only the writer uses this.
+        char                                        mFilenamePrefix[ 256 ] ;   ///< Start of each frame's file name.
+        bool                                        mIsOpen             ;   ///< Whether Open succeeded and Close has not happened since.
+        size_t                                      mNumDroppedFrames   ;   ///< Number of frames dropped because the writer fell behind.
+        volatile bool                               mHadWriteError      ;   ///< Whether writing some frame failed.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,490 @@
+/** \file frameSequenceReader.cpp
+
+    \brief Player that reads a frame sequence file and reconstructs particles and grids at any time it spans.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "frameSequenceReader.h"
+
+#include <Particles/particleSystem.h>
+
+#include <Core/Performance/perfBlock.h>
+
+#include <algorithm>
+
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const size_t sNoFrame = ~ size_t( 0 ) ;  ///< Value of FrameSequenceReader::mFrameIndices for an element of mFrames that holds no frame.
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Move the file position of the given file to the given offset from its start, which can lie beyond 2 gigabytes.
+*/
+static bool SeekTo( FILE * fp , long long offset )
+{
+#if defined( WIN32 )
+    return _fseeki64( fp , offset , SEEK_SET ) == 0 ;
+#else
+    return fseeko( fp , static_cast< off_t >( offset ) , SEEK_SET ) == 0 ;
+#endif
+}
+
+
+
+
+/** Return size of the given file, in bytes.
+*/
+static long long FileSize( FILE * fp )
+{
+#if defined( WIN32 )
+    _fseeki64( fp , 0 , SEEK_END ) ;
+    return _ftelli64( fp ) ;
+#else
+    fseeko( fp , 0 , SEEK_END ) ;
+    return ftello( fp ) ;
+#endif
+}
+
+
+
+
+/** Return whether the first given index entry comes earlier in time than the second.
+*/
+static bool IsEarlier( const FrameSequenceIndexEntry & a , const FrameSequenceIndexEntry & b )
+{
+    return a.mTimeNow < b.mTimeNow ;
+}
+
+
+
+
+/** Return index of the stream in the given frame with the given kind, id and group, or -1 if it has none.
+*/
+static int FindStream( const FrameSequenceFrame & frame , unsigned kind , unsigned id , unsigned groupIndex )
+{
+    for( unsigned iStream = 0 ; iStream < frame.mHeader.mNumStreams ; ++ iStream )
+    {   // For each stream in frame...
+        const FrameSequenceStreamHeader & streamHeader = frame.mStreamHeaders[ iStream ] ;
+        if( ( streamHeader.mKind == kind ) && ( streamHeader.mId == id ) && ( streamHeader.mGroupIndex == groupIndex ) )
+        {
+            return static_cast< int >( iStream ) ;
+        }
+    }
+    return -1 ;
+}
+
+
+
+
+/** Return number of particles the given frame has in the given group, or sNoFrame if the frame has no streams for that group.
+*/
+static size_t GroupPopulation( const FrameSequenceFrame & frame , unsigned groupIndex )
+{
+    for( unsigned iStream = 0 ; iStream < frame.mHeader.mNumStreams ; ++ iStream )
+    {   // For each stream in frame...
+        const FrameSequenceStreamHeader & streamHeader = frame.mStreamHeaders[ iStream ] ;
+        if( ( FRAME_SEQUENCE_STREAM_PARTICLE_ATTRIBUTE == streamHeader.mKind ) && ( streamHeader.mGroupIndex == groupIndex ) )
+        {   // Every attribute stream of a group has the same count.
+            return static_cast< size_t >( streamHeader.mCount ) ;
+        }
+    }
+    return sNoFrame ;
+}
+
+
+
+
+/** Return whether the given grid streams have the same shape, so their values can blend point by point.
+*/
+static bool HaveSameShape( const FrameSequenceStreamHeader & a , const FrameSequenceStreamHeader & b )
+{
+    return      ( a.mCount == b.mCount ) && ( a.mNumComponents == b.mNumComponents )
+            &&  ( memcmp( a.mGridMinCorner , b.mGridMinCorner , sizeof( a.mGridMinCorner ) ) == 0 )
+            &&  ( memcmp( a.mGridExtent    , b.mGridExtent    , sizeof( a.mGridExtent    ) ) == 0 )
+            &&  ( memcmp( a.mGridNumPoints , b.mGridNumPoints , sizeof( a.mGridNumPoints ) ) == 0 ) ;
+}
+
+
+
+
+/** Reconstruct the given grid from the given frames, blending them where they have the same shape.
+
+    \param tween    Fraction of the way from frame0 to frame1.
+
+    \return Whether either frame had the given grid.
+*/
+template< class ItemT > static bool SampleGrid( const FrameSequenceFrame & frame0 , const FrameSequenceFrame & frame1 , float tween , FrameSequenceGridE gridId , UniformGrid< ItemT > & grid )
+{
+    const int iStream0 = FindStream( frame0 , FRAME_SEQUENCE_STREAM_GRID , gridId , 0 ) ;
+    const int iStream1 = FindStream( frame1 , FRAME_SEQUENCE_STREAM_GRID , gridId , 0 ) ;
+    if( ( iStream0 < 0 ) && ( iStream1 < 0 ) )
+    {   // Neither frame has this grid.
+        return false ;
+    }
+
+    const bool                          canBlend    = ( iStream0 >= 0 ) && ( iStream1 >= 0 ) && HaveSameShape( frame0.mStreamHeaders[ iStream0 ] , frame1.mStreamHeaders[ iStream1 ] ) ;
+    const bool                          useFrame1   = ( iStream0 < 0 ) || ( ! canBlend && ( iStream1 >= 0 ) && ( tween >= 0.5f ) ) ;
+    const FrameSequenceFrame &          source      = useFrame1 ? frame1 : frame0 ;
+    const int                           iSource     = useFrame1 ? iStream1 : iStream0 ;
+    const FrameSequenceStreamHeader &   header      = source.mStreamHeaders[ iSource ] ;
+    const unsigned long long            numPoints   = static_cast< unsigned long long >( header.mGridNumPoints[ 0 ] ) * header.mGridNumPoints[ 1 ] * header.mGridNumPoints[ 2 ] ;
+    if(     ( header.mNumComponents * sizeof( float ) != sizeof( ItemT ) )
+        ||  ( header.mGridNumPoints[ 0 ] < 2 ) || ( header.mGridNumPoints[ 1 ] < 2 ) || ( header.mGridNumPoints[ 2 ] < 2 )
+        ||  ( numPoints != header.mCount ) )
+    {   // Stream does not describe a grid of this type.
+        return false ;
+    }
+
+    grid.DefineShapeFromPoints( Vec3( header.mGridMinCorner[ 0 ] , header.mGridMinCorner[ 1 ] , header.mGridMinCorner[ 2 ] )
+                              , Vec3( header.mGridExtent[ 0 ]    , header.mGridExtent[ 1 ]    , header.mGridExtent[ 2 ]    )
+                              , header.mGridNumPoints ) ;
+    grid.Init() ;
+
+    float *         destination = reinterpret_cast< float * >( grid.Data() ) ;
+    const float *   values0     = & source.mStreamData[ iSource ][ 0 ] ;
+    const float *   values1     = canBlend ? & frame1.mStreamData[ iStream1 ][ 0 ] : values0 ;
+    const size_t    numFloats   = static_cast< size_t >( header.mCount ) * header.mNumComponents ;
+    for( size_t iFloat = 0 ; iFloat < numFloats ; ++ iFloat )
+    {   // For each component of each grid point...
+        destination[ iFloat ] = values0[ iFloat ] + tween * ( values1[ iFloat ] - values0[ iFloat ] ) ;
+    }
+    return true ;
+}
+
+
+
+
+FrameSequenceReader::FrameSequenceReader()
+    : mFile( NULLPTR )
+    , mParticleAttributeMask( 0 )
+{
+    mFrameIndices[ 0 ] = mFrameIndices[ 1 ] = sNoFrame ;
+}
+
+
+
+
+FrameSequenceReader::~FrameSequenceReader()
+{
+    Close() ;
+}
+
+
+
+
+/** Open the given frame sequence file and index its frames.
+
+    \param filename Name of file that FrameSequenceWriter wrote.
+
+    \return Whether the file exists and is a frame sequence of the layout this reads.
+*/
+bool FrameSequenceReader::Open( const char * filename )
+{
+    PERF_BLOCK( FrameSequenceReader__Open ) ;
+
+    Close() ;
+
+    mFile = fopen( filename , "rb" ) ;
+    if( NULLPTR == mFile )
+    {
+        return false ;
+    }
+
+    FrameSequenceFileHeader fileHeader ;
+    if(     ( fread( & fileHeader , sizeof( fileHeader ) , 1 , mFile ) != 1 )
+        ||  ( fileHeader.mMagic   != FrameSequenceFileHeader::sMagic   )
+        ||  ( fileHeader.mVersion != FrameSequenceFileHeader::sVersion ) )
+    {   // Not a frame sequence, or some other version of the layout.
+        fclose( mFile ) ;
+        mFile = NULLPTR ;
+        return false ;
+    }
+
+    mParticleAttributeMask = fileHeader.mParticleAttributeMask ;
+    return BuildIndex() ;
+}
+
+
+
+
+/** Close the file, and forget its index and frames.
+*/
+void FrameSequenceReader::Close()
+{
+    if( NULLPTR == mFile )
+    {   // Not open.
+        return ;
+    }
+
+    fclose( mFile ) ;
+    mFile = NULLPTR ;
+    mIndex.Clear() ;
+    mFrameIndices[ 0 ] = mFrameIndices[ 1 ] = sNoFrame ;
+    mParticleAttributeMask = 0 ;
+}
+
+
+
+
+/** Record the location and time of each frame chunk in the file, skipping chunks of other kinds.
+
+    This reads only chunk and frame headers, and seeks past everything else.
+    A chunk that the end of the file truncates ends the index, so a
+    sequence that a crash cut short still plays up to its last whole frame.
+
+    Frames sort by time, since exporting while stepping backward writes
+    frames out of time order.
+*/
+bool FrameSequenceReader::BuildIndex()
+{
+    PERF_BLOCK( FrameSequenceReader__BuildIndex ) ;
+
+    const long long fileSize    = FileSize( mFile ) ;
+    long long       chunkOffset = sizeof( FrameSequenceFileHeader ) ;
+    mIndex.Clear() ;
+    for( ;; )
+    {   // For each chunk in file...
+        FrameSequenceChunkHeader chunkHeader ;
+        if( ! SeekTo( mFile , chunkOffset ) || ( fread( & chunkHeader , sizeof( chunkHeader ) , 1 , mFile ) != 1 ) )
+        {   // Reached end of file.
+            break ;
+        }
+        const long long payloadOffset = chunkOffset + static_cast< long long >( sizeof( chunkHeader ) ) ;
+        if( chunkHeader.mSizeInBytes > static_cast< unsigned long long >( fileSize - payloadOffset ) )
+        {   // Chunk is truncated.
+            break ;
+        }
+        if( FrameSequenceChunkHeader::sTagFrame == chunkHeader.mTag )
+        {   // Chunk is a frame.
+            FrameSequenceFrameHeader frameHeader ;
+            if( ( chunkHeader.mSizeInBytes < sizeof( frameHeader ) ) || ( fread( & frameHeader , sizeof( frameHeader ) , 1 , mFile ) != 1 ) )
+            {   // Frame chunk too small to hold a frame.
+                break ;
+            }
+            FrameSequenceIndexEntry entry ;
+            entry.mChunkOffset  = chunkOffset ;
+            entry.mTimeNow      = frameHeader.mTimeNow ;
+            entry.mFrame        = frameHeader.mFrame ;
+            mIndex.PushBack( entry ) ;
+        }
+        chunkOffset = payloadOffset + static_cast< long long >( chunkHeader.mSizeInBytes ) ;
+    }
+
+    std::stable_sort( mIndex.begin() , mIndex.end() , IsEarlier ) ;
+    return true ;
+}
+
+
+
+
+/** Return index, into the frame index, of the latest frame no later than the given time, or of the earliest frame if all are later.
+
+    Call this only when GetNumFrames is nonzero.
+*/
+size_t FrameSequenceReader::FindFrame( double timeNow ) const
+{
+    ASSERT( ! mIndex.Empty() ) ;
+    size_t lo = 0 ;
+    size_t hi = mIndex.Size() ;
+    while( hi - lo > 1 )
+    {   // Invariant: mIndex[ lo ] is no later than timeNow, or lo is 0.
+        const size_t mid = ( lo + hi ) / 2 ;
+        if( mIndex[ mid ].mTimeNow <= timeNow )
+        {
+            lo = mid ;
+        }
+        else
+        {
+            hi = mid ;
+        }
+    }
+    return lo ;
+}
+
+
+
+
+/** Return the given frame, reading it from the file unless it is one of the two most recently read.
+
+    \param frameIndexToKeep Index of another frame the caller still needs, which reading must not evict.
+
+    \return Address of frame, or NULL if reading failed.
+*/
+const FrameSequenceFrame * FrameSequenceReader::AcquireFrame( size_t frameIndex , size_t frameIndexToKeep )
+{
+    for( size_t iSlot = 0 ; iSlot < 2 ; ++ iSlot )
+    {   // For each frame already read...
+        if( mFrameIndices[ iSlot ] == frameIndex )
+        {   // Already have the requested frame.
+            return & mFrames[ iSlot ] ;
+        }
+    }
+
+    const size_t iSlot = ( mFrameIndices[ 0 ] == frameIndexToKeep ) ? 1 : 0 ;
+    mFrameIndices[ iSlot ] = sNoFrame ;
+    if( ! ReadFrame( frameIndex , mFrames[ iSlot ] ) )
+    {
+        return NULLPTR ;
+    }
+    mFrameIndices[ iSlot ] = frameIndex ;
+    return & mFrames[ iSlot ] ;
+}
+
+
+
+
+/** Read the given frame from the file into the given frame object.
+
+    This reuses storage the frame object already holds, so once stream sizes settle, reading does not allocate.
+
+    \return Whether reading succeeded.  False means the chunk is corrupt or the file became unreadable.
+*/
+bool FrameSequenceReader::ReadFrame( size_t frameIndex , FrameSequenceFrame & frame )
+{
+    PERF_BLOCK( FrameSequenceReader__ReadFrame ) ;
+
+    FrameSequenceChunkHeader chunkHeader ;
+    if(     ! SeekTo( mFile , mIndex[ frameIndex ].mChunkOffset )
+        ||  ( fread( & chunkHeader   , sizeof( chunkHeader )   , 1 , mFile ) != 1 )
+        ||  ( fread( & frame.mHeader , sizeof( frame.mHeader ) , 1 , mFile ) != 1 ) )
+    {
+        return false ;
+    }
+
+    unsigned long long bytesLeft = chunkHeader.mSizeInBytes - sizeof( frame.mHeader ) ;
+    if( frame.mStreamHeaders.Size() < frame.mHeader.mNumStreams )
+    {   // This frame never had this many streams before.
+        frame.mStreamHeaders.Resize( frame.mHeader.mNumStreams ) ;
+        frame.mStreamData.Resize( frame.mHeader.mNumStreams ) ;
+    }
+    for( unsigned iStream = 0 ; iStream < frame.mHeader.mNumStreams ; ++ iStream )
+    {   // For each stream in frame...
+        FrameSequenceStreamHeader & streamHeader = frame.mStreamHeaders[ iStream ] ;
+        if( ( bytesLeft < sizeof( streamHeader ) ) || ( fread( & streamHeader , sizeof( streamHeader ) , 1 , mFile ) != 1 ) )
+        {
+            return false ;
+        }
+        bytesLeft -= sizeof( streamHeader ) ;
+        const unsigned long long numFloats = streamHeader.mCount * streamHeader.mNumComponents ;
+        if( numFloats > bytesLeft / sizeof( float ) )
+        {   // Stream claims more data than its chunk holds.
+            return false ;
+        }
+        bytesLeft -= numFloats * sizeof( float ) ;
+        VECTOR< float > & streamData = frame.mStreamData[ iStream ] ;
+        streamData.Resize( static_cast< size_t >( numFloats ) ) ;
+        if( ( numFloats > 0 ) && ( fread( & streamData[ 0 ] , sizeof( float ) , streamData.Size() , mFile ) != streamData.Size() ) )
+        {
+            return false ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Reconstruct particles and grids at the given time, from the frames that bracket it.
+
+    \param timeNow          Virtual time to reconstruct.  Times before the first frame or after the last take that frame.
+
+    \param particleSystem   Particle system whose groups receive particles.  Group i receives the particles the file recorded for group i.
+                            Each group gets exactly as many particles as the file recorded, and every attribute the file has.
+                            Other attributes keep whatever values they had, or the default for particles this adds.
+
+    \param velocityGrid     Grid to receive recorded velocity, or NULL to skip it.
+
+    \param densityGrid      Grid to receive recorded density, or NULL to skip it.
+
+    \return Whether a frame was available.
+*/
+bool FrameSequenceReader::Sample( double timeNow , ParticleSystem & particleSystem , UniformGrid< Vec3 > * velocityGrid , UniformGrid< float > * densityGrid )
+{
+    PERF_BLOCK( FrameSequenceReader__Sample ) ;
+
+    if( ! IsOpen() || mIndex.Empty() )
+    {
+        return false ;
+    }
+
+    const size_t    iFrame0 = FindFrame( timeNow ) ;
+    const size_t    iFrame1 = Min2( iFrame0 + 1 , mIndex.Size() - 1 ) ;
+    const double    time0   = mIndex[ iFrame0 ].mTimeNow ;
+    const double    time1   = mIndex[ iFrame1 ].mTimeNow ;
+    const float     tween   = ( time1 > time0 ) ? float( Clamp( ( timeNow - time0 ) / ( time1 - time0 ) , 0.0 , 1.0 ) ) : 0.0f ;
+
+    const FrameSequenceFrame * frame0 = AcquireFrame( iFrame0 , iFrame1 ) ;
+    const FrameSequenceFrame * frame1 = AcquireFrame( iFrame1 , iFrame0 ) ;
+    if( ( NULLPTR == frame0 ) || ( NULLPTR == frame1 ) )
+    {   // File became unreadable.
+        return false ;
+    }
+
+    const size_t numGroups = particleSystem.GetNumGroups() ;
+    for( unsigned iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        const size_t population0 = GroupPopulation( * frame0 , iGroup ) ;
+        const size_t population1 = GroupPopulation( * frame1 , iGroup ) ;
+        const bool   canBlend    = ( population0 == population1 ) ;
+        const FrameSequenceFrame & source = ( canBlend || ( tween < 0.5f ) || ( sNoFrame == population1 ) ) ? * frame0 : * frame1 ;
+        const float  sourceTween = canBlend ? tween : 0.0f ;
+        const size_t population  = GroupPopulation( source , iGroup ) ;
+        if( sNoFrame == population )
+        {   // File did not record this group.
+            continue ;
+        }
+
+        VECTOR< Particle > & particles = particleSystem.GetGroup( iGroup )->GetParticles() ;
+        particles.Resize( population ) ;
+        for( unsigned iStream = 0 ; iStream < source.mHeader.mNumStreams ; ++ iStream )
+        {   // For each stream in frame...
+            const FrameSequenceStreamHeader & streamHeader = source.mStreamHeaders[ iStream ] ;
+            if(     ( streamHeader.mKind != FRAME_SEQUENCE_STREAM_PARTICLE_ATTRIBUTE )
+                ||  ( streamHeader.mGroupIndex != iGroup )
+                ||  ( streamHeader.mId >= NUM_PARTICLE_ATTRIBUTES ) )
+            {   // Stream belongs to some other group, or is not a particle attribute this build knows.
+                continue ;
+            }
+            const ParticleAttributeStream destination = Particles::GetAttributeStream( particles , ParticleAttributeE( streamHeader.mId ) ) ;
+            if( destination.mNumComponents != streamHeader.mNumComponents )
+            {   // Recorded attribute has a different layout than this build uses.
+                continue ;
+            }
+            const unsigned  numComponents   = streamHeader.mNumComponents ;
+            const int       iStream1        = canBlend ? FindStream( * frame1 , streamHeader.mKind , streamHeader.mId , iGroup ) : -1 ;
+            const bool      hasValues1      = ( iStream1 >= 0 ) && ( frame1->mStreamHeaders[ iStream1 ].mNumComponents == numComponents ) ;
+            const float *   values0         = population ? & source.mStreamData[ iStream ][ 0 ] : NULLPTR ;
+            const float *   values1         = ( hasValues1 && population ) ? & frame1->mStreamData[ iStream1 ][ 0 ] : values0 ;
+            // ParticleAttributeStream addresses particles read-only, but particles is mutable, as in ParticleAttributeView.
+            char *          destinationBase = const_cast< char * >( destination.mBase ) ;
+            for( size_t iPcl = 0 ; iPcl < population ; ++ iPcl )
+            {   // For each particle...
+                float * attributeValue = reinterpret_cast< float * >( destinationBase + iPcl * destination.mStrideInBytes ) ;
+                for( unsigned iComponent = 0 ; iComponent < numComponents ; ++ iComponent )
+                {
+                    const float value0 = * values0 ++ ;
+                    const float value1 = * values1 ++ ;
+                    attributeValue[ iComponent ] = value0 + sourceTween * ( value1 - value0 ) ;
+                }
+            }
+        }
+    }
+
+    if( velocityGrid )
+    {
+        SampleGrid( * frame0 , * frame1 , tween , FRAME_SEQUENCE_GRID_VELOCITY , * velocityGrid ) ;
+    }
+    if( densityGrid )
+    {
+        SampleGrid( * frame0 , * frame1 , tween , FRAME_SEQUENCE_GRID_DENSITY , * densityGrid ) ;
+    }
+    return true ;
+}
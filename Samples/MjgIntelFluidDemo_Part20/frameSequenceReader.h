@@ -0,0 +1,91 @@
+/** \file frameSequenceReader.h
+
+    \brief Player that reads a frame sequence file and reconstructs particles and grids at any time it spans.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FRAME_SEQUENCE_READER_H
+#define FRAME_SEQUENCE_READER_H
+
+#include "frameSequenceWriter.h"
+
+// Forward declarations
+class ParticleSystem ;
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Location and time of one frame in a frame sequence file.
+*/
+struct FrameSequenceIndexEntry
+{
+    long long   mChunkOffset    ;   ///< Offset, in bytes from the start of the file, of the frame's FrameSequenceChunkHeader.
+    double      mTimeNow        ;   ///< Virtual time of frame.
+    unsigned    mFrame          ;   ///< Frame counter of frame.
+} ;
+
+
+
+
+/** Player that reads a frame sequence file, which FrameSequenceWriter wrote, and reconstructs particles and grids at any time it spans.
+
+    Open scans the file once, reading only chunk headers, to build an index
+    of frames, so seeking to any frame costs one file seek.  Sample then
+    finds the two frames that bracket the requested time, and blends them:
+    particle attributes and grid values interpolate linearly, so playback
+    runs smoothly at any speed, forward or backward, without simulating.
+
+    This keeps the two most recently read frames, so playing forward or
+    backward reads each frame from the file once.
+
+    Particles interpolate by index, which assumes particle i in one frame is
+    particle i in the next.  That holds while a group neither gains nor
+    loses particles.  When a group's population changes between two
+    frames, that group takes the nearer frame instead of blending.
+*/
+class FrameSequenceReader
+{
+    public:
+        FrameSequenceReader() ;
+        ~FrameSequenceReader() ;
+
+        bool    Open( const char * filename ) ;
+        void    Close() ;
+
+        /// Return whether Open succeeded and Close has not happened since.
+        bool    IsOpen() const { return mFile != NULLPTR ; }
+
+        /// Return number of frames the file contains.
+        size_t  GetNumFrames() const { return mIndex.Size() ; }
+
+        /// Return location and time of the given frame.
+        const FrameSequenceIndexEntry & GetIndexEntry( size_t frameIndex ) const { return mIndex[ frameIndex ] ; }
+
+        /// Return bit (1 << a) set for each ParticleAttributeE a that frames contain.
+        unsigned GetParticleAttributeMask() const { return mParticleAttributeMask ; }
+
+        size_t  FindFrame( double timeNow ) const ;
+
+        bool    Sample( double timeNow , ParticleSystem & particleSystem , UniformGrid< Vec3 > * velocityGrid , UniformGrid< float > * densityGrid ) ;
+
+    private:
+        FrameSequenceReader( const FrameSequenceReader & ) ;                // Disallow copy
+        FrameSequenceReader & operator=( const FrameSequenceReader & ) ;    // Disallow assignment
+
+        bool    BuildIndex() ;
+        const FrameSequenceFrame * AcquireFrame( size_t frameIndex , size_t frameIndexToKeep ) ;
+        bool    ReadFrame( size_t frameIndex , FrameSequenceFrame & frame ) ;
+
+        VECTOR< FrameSequenceIndexEntry >   mIndex                  ;   ///< Location and time of each frame, in file order.
+        FrameSequenceFrame                  mFrames[ 2 ]            ;   ///< Most recently read frames.
+        size_t                              mFrameIndices[ 2 ]      ;   ///< Index, into mIndex, of frame each element of mFrames holds, or ~0 if it holds none.
+        FILE *                              mFile                   ;   ///< File frames come from, or NULL if none is open.
+        unsigned                            mParticleAttributeMask  ;   ///< Bit (1 << a) is set for each ParticleAttributeE a that frames contain.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
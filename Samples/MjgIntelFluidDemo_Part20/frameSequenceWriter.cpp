@@ -0,0 +1,386 @@
+/** \file frameSequenceWriter.cpp
+
+    \brief Exporter that streams per-frame particle and grid data into one chunked file, on a background thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "frameSequenceWriter.h"
+
+#include <Particles/particleSystem.h>
+
+#include <Core/Performance/perfBlock.h>
+
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const size_t sFileBufferSize = 1 << 20 ;    ///< Number of bytes stdio buffers before writing, so large frames write in few system calls.
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Append a stream to this frame, and return its header so the caller can fill in kind-specific members.
+
+    This reuses stream storage a previous Capture left, so once stream sizes settle, capturing does not allocate.
+*/
+FrameSequenceStreamHeader & FrameSequenceFrame::AppendStream( FrameSequenceStreamE kind , unsigned id , unsigned numComponents , size_t count )
+{
+    const size_t iStream = mHeader.mNumStreams ++ ;
+    if( mStreamHeaders.Size() <= iStream )
+    {   // This frame never had this many streams before.
+        mStreamHeaders.Resize( iStream + 1 ) ;
+        mStreamData.Resize( iStream + 1 ) ;
+    }
+
+    FrameSequenceStreamHeader & streamHeader = mStreamHeaders[ iStream ] ;
+    memset( & streamHeader , 0 , sizeof( streamHeader ) ) ;
+    streamHeader.mKind          = kind ;
+    streamHeader.mId            = id ;
+    streamHeader.mNumComponents = numComponents ;
+    streamHeader.mCount         = count ;
+    mStreamData[ iStream ].Resize( count * numComponents ) ;
+    return streamHeader ;
+}
+
+
+
+
+/** Copy geometry of the given grid into the given stream header.
+*/
+static void CopyGridGeometry( FrameSequenceStreamHeader & streamHeader , const UniformGridGeometry & grid )
+{
+    const Vec3 & minCorner = grid.GetMinCorner() ;
+    const Vec3 & extent    = grid.GetExtent() ;
+    streamHeader.mGridMinCorner[ 0 ] = minCorner.x ;
+    streamHeader.mGridMinCorner[ 1 ] = minCorner.y ;
+    streamHeader.mGridMinCorner[ 2 ] = minCorner.z ;
+    streamHeader.mGridExtent[ 0 ]    = extent.x ;
+    streamHeader.mGridExtent[ 1 ]    = extent.y ;
+    streamHeader.mGridExtent[ 2 ]    = extent.z ;
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {
+        streamHeader.mGridNumPoints[ axis ] = grid.GetNumPoints( axis ) ;
+    }
+}
+
+
+
+
+/** Copy the data to export for one frame.
+
+    \param particleSystem           Particle system whose particles to export, one set of streams per group.
+
+    \param particleAttributeMask    Bit (1 << a) is set for each ParticleAttributeE a to export.
+
+    \param velocityGrid             Velocity grid to export, or NULL to omit it.
+
+    \param densityGrid              Density grid to export, or NULL to omit it.
+
+    \param frame                    Frame counter.
+
+    \param timeNow                  Virtual time.
+
+    Particles live as an array of structures; this gathers each attribute
+    into its own contiguous stream, so the writer thread only has to write
+    contiguous blocks.
+*/
+void FrameSequenceFrame::Capture( const ParticleSystem & particleSystem , unsigned particleAttributeMask , const UniformGrid< Vec3 > * velocityGrid , const UniformGrid< float > * densityGrid , unsigned frame , double timeNow )
+{
+    PERF_BLOCK( FrameSequenceFrame__Capture ) ;
+
+    mHeader.mFrame      = frame ;
+    mHeader.mNumStreams = 0 ;
+    mHeader.mTimeNow    = timeNow ;
+
+    const size_t numGroups = particleSystem.GetNumGroups() ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        const ParticleGroup &       group           = * particleSystem.GetGroup( iGroup ) ;
+        const VECTOR< Particle > &  particles       = group.GetParticles() ;
+        const ParticleAttributeMask groupAttributes = particleAttributeMask & group.GetAttributesUsed() ;
+        for( unsigned attribute = 0 ; attribute < NUM_PARTICLE_ATTRIBUTES ; ++ attribute )
+        {   // For each particle attribute...
+            if( 0 == ( groupAttributes & ( 1u << attribute ) ) )
+            {   // Caller did not ask for this attribute, or no operation in this group uses it.
+                continue ;
+            }
+            const ParticleAttributeStream   source          = Particles::GetAttributeStream( particles , ParticleAttributeE( attribute ) ) ;
+            const unsigned                  numComponents   = static_cast< unsigned >( source.mNumComponents ) ;
+            FrameSequenceStreamHeader &     streamHeader    = AppendStream( FRAME_SEQUENCE_STREAM_PARTICLE_ATTRIBUTE , attribute , numComponents , source.mCount ) ;
+            streamHeader.mGroupIndex = static_cast< unsigned >( iGroup ) ;
+            float * destination = mStreamData[ mHeader.mNumStreams - 1 ].Empty() ? NULLPTR : & mStreamData[ mHeader.mNumStreams - 1 ][ 0 ] ;
+            for( size_t iPcl = 0 ; iPcl < source.mCount ; ++ iPcl )
+            {   // For each particle...
+                const float * attributeValue = reinterpret_cast< const float * >( source.mBase + iPcl * source.mStrideInBytes ) ;
+                for( unsigned iComponent = 0 ; iComponent < numComponents ; ++ iComponent )
+                {
+                    * destination ++ = attributeValue[ iComponent ] ;
+                }
+            }
+        }
+    }
+
+    if( velocityGrid && velocityGrid->Size() )
+    {   // Caller wants to export velocity grid.
+        FrameSequenceStreamHeader & streamHeader = AppendStream( FRAME_SEQUENCE_STREAM_GRID , FRAME_SEQUENCE_GRID_VELOCITY , 3 , velocityGrid->Size() ) ;
+        CopyGridGeometry( streamHeader , * velocityGrid ) ;
+        memcpy( & mStreamData[ mHeader.mNumStreams - 1 ][ 0 ] , velocityGrid->Data() , velocityGrid->Size() * sizeof( Vec3 ) ) ;
+    }
+
+    if( densityGrid && densityGrid->Size() )
+    {   // Caller wants to export density grid.
+        FrameSequenceStreamHeader & streamHeader = AppendStream( FRAME_SEQUENCE_STREAM_GRID , FRAME_SEQUENCE_GRID_DENSITY , 1 , densityGrid->Size() ) ;
+        CopyGridGeometry( streamHeader , * densityGrid ) ;
+        memcpy( & mStreamData[ mHeader.mNumStreams - 1 ][ 0 ] , densityGrid->Data() , densityGrid->Size() * sizeof( float ) ) ;
+    }
+}
+
+
+
+
+/** Write this frame, as one chunk, to the given file.
+
+    \return Whether writing succeeded.
+*/
+bool FrameSequenceFrame::Write( FILE * fp ) const
+{
+    PERF_BLOCK( FrameSequenceFrame__Write ) ;
+
+    FrameSequenceChunkHeader chunkHeader ;
+    chunkHeader.mTag            = FrameSequenceChunkHeader::sTagFrame ;
+    chunkHeader.mPad            = 0 ;
+    chunkHeader.mSizeInBytes    = sizeof( mHeader ) ;
+    for( unsigned iStream = 0 ; iStream < mHeader.mNumStreams ; ++ iStream )
+    {   // For each stream...
+        chunkHeader.mSizeInBytes += sizeof( FrameSequenceStreamHeader ) + mStreamData[ iStream ].Size() * sizeof( float ) ;
+    }
+
+    bool ok =       ( fwrite( & chunkHeader , sizeof( chunkHeader ) , 1 , fp ) == 1 )
+                &&  ( fwrite( & mHeader     , sizeof( mHeader )     , 1 , fp ) == 1 ) ;
+    for( unsigned iStream = 0 ; ok && ( iStream < mHeader.mNumStreams ) ; ++ iStream )
+    {   // For each stream...
+        const VECTOR< float > & streamData = mStreamData[ iStream ] ;
+        ok = ( fwrite( & mStreamHeaders[ iStream ] , sizeof( FrameSequenceStreamHeader ) , 1 , fp ) == 1 )
+            && ( streamData.Empty() || ( fwrite( & streamData[ 0 ] , sizeof( float ) , streamData.Size() , fp ) == streamData.Size() ) ) ;
+    }
+    return ok ;
+}
+
+
+
+
+/** Construct writer that owns the given number of frames.
+
+    \param capacity Number of frames that can await writing before SubmitFrame starts dropping frames.
+*/
+FrameSequenceWriter::FrameSequenceWriter( size_t capacity )
+    :
+#if FRAME_SEQUENCE_WRITER_ASYNC
+      mWriterThread( NULL ) ,
+#endif
+      mFile( NULLPTR )
+    , mParticleAttributeMask( 0 )
+    , mNumDroppedFrames( 0 )
+    , mHadWriteError( false )
+{
+#if FRAME_SEQUENCE_WRITER_ASYNC
+    ASSERT( capacity >= 1 ) ;
+    mFree.set_capacity( capacity ) ;
+    mPending.set_capacity( capacity + 1 ) ; // Room for the NULL that tells the writer thread to exit.
+#else
+    capacity = 1 ;  // SubmitFrame writes each frame before returning, so one frame suffices.
+#endif
+    mFrames.Reserve( capacity ) ;
+    for( size_t iFrame = 0 ; iFrame < capacity ; ++ iFrame )
+    {   // For each frame to own...
+        mFrames.PushBack( new FrameSequenceFrame ) ;
+    }
+}
+
+
+
+
+FrameSequenceWriter::~FrameSequenceWriter()
+{
+    Close() ;
+    const size_t numFrames = mFrames.Size() ;
+    for( size_t iFrame = 0 ; iFrame < numFrames ; ++ iFrame )
+    {   // For each frame this writer owns...
+        delete mFrames[ iFrame ] ;
+    }
+}
+
+
+
+
+/** Create the given file and start the thread that writes frames into it.
+
+    \param filename                 Name of file to create.  This overwrites any existing file.
+
+    \param particleAttributeMask    Bit (1 << a) is set for each ParticleAttributeE a to export.
+
+    \return Whether creating the file succeeded.
+*/
+bool FrameSequenceWriter::Open( const char * filename , unsigned particleAttributeMask )
+{
+    PERF_BLOCK( FrameSequenceWriter__Open ) ;
+
+    Close() ;
+
+    mFile = fopen( filename , "wb" ) ;
+    if( NULLPTR == mFile )
+    {
+        return false ;
+    }
+    setvbuf( mFile , NULL , _IOFBF , sFileBufferSize ) ;
+
+    FrameSequenceFileHeader fileHeader ;
+    fileHeader.mMagic                   = FrameSequenceFileHeader::sMagic ;
+    fileHeader.mVersion                 = FrameSequenceFileHeader::sVersion ;
+    fileHeader.mParticleAttributeMask   = particleAttributeMask ;
+    fileHeader.mPad                     = 0 ;
+    if( fwrite( & fileHeader , sizeof( fileHeader ) , 1 , mFile ) != 1 )
+    {
+        fclose( mFile ) ;
+        mFile = NULLPTR ;
+        return false ;
+    }
+
+    mParticleAttributeMask  = particleAttributeMask ;
+    mNumDroppedFrames       = 0 ;
+    mHadWriteError          = false ;
+
+#if FRAME_SEQUENCE_WRITER_ASYNC
+    const size_t numFrames = mFrames.Size() ;
+    for( size_t iFrame = 0 ; iFrame < numFrames ; ++ iFrame )
+    {   // For each frame this writer owns...
+        mFree.push( mFrames[ iFrame ] ) ;
+    }
+    mWriterThread = CreateThread( NULL , 0 , WriterThreadMain , this , 0 , NULL ) ;
+    ASSERT( mWriterThread ) ;
+#endif
+    return true ;
+}
+
+
+
+
+/** Write all pending frames, stop the writer thread, and close the file.
+*/
+void FrameSequenceWriter::Close()
+{
+    PERF_BLOCK( FrameSequenceWriter__Close ) ;
+
+    if( NULLPTR == mFile )
+    {   // Not open.
+        return ;
+    }
+
+#if FRAME_SEQUENCE_WRITER_ASYNC
+    mPending.push( NULLPTR ) ;  // Tell writer thread to exit once it writes the frames ahead of this.
+    WaitForSingleObject( mWriterThread , INFINITE ) ;
+    CloseHandle( mWriterThread ) ;
+    mWriterThread = NULL ;
+    mFree.clear() ;
+#endif
+
+    if( fclose( mFile ) != 0 )
+    {
+        mHadWriteError = true ;
+    }
+    mFile = NULLPTR ;
+}
+
+
+
+
+/** Copy the given data for one frame, and queue it for writing.
+
+    \param particleSystem   Particle system whose particles to export.
+
+    \param velocityGrid     Velocity grid to export, or NULL to omit it.
+
+    \param densityGrid      Density grid to export, or NULL to omit it.
+
+    \param frame            Frame counter.
+
+    \param timeNow          Virtual time.
+
+    This costs the caller only a copy of the exported data.  It never waits
+    for the file: If every frame still awaits writing, this drops this frame.
+
+    \return Whether this queued the frame.  False means either no file is open, or the writer fell behind.
+*/
+bool FrameSequenceWriter::SubmitFrame( const ParticleSystem & particleSystem , const UniformGrid< Vec3 > * velocityGrid , const UniformGrid< float > * densityGrid , unsigned frame , double timeNow )
+{
+    PERF_BLOCK( FrameSequenceWriter__SubmitFrame ) ;
+
+    if( ! IsOpen() )
+    {
+        return false ;
+    }
+
+#if FRAME_SEQUENCE_WRITER_ASYNC
+    FrameSequenceFrame * exportFrame = NULLPTR ;
+    if( ! mFree.try_pop( exportFrame ) )
+    {   // Writer thread fell behind.  Drop this frame rather than stall the caller.
+        ++ mNumDroppedFrames ;
+        return false ;
+    }
+    exportFrame->Capture( particleSystem , mParticleAttributeMask , velocityGrid , densityGrid , frame , timeNow ) ;
+    mPending.push( exportFrame ) ;
+#else
+    FrameSequenceFrame * exportFrame = mFrames[ 0 ] ;
+    exportFrame->Capture( particleSystem , mParticleAttributeMask , velocityGrid , densityGrid , frame , timeNow ) ;
+    WriteFrame( exportFrame ) ;
+#endif
+    return true ;
+}
+
+
+
+
+/** Write the given frame to the file, remembering whether that failed.
+*/
+void FrameSequenceWriter::WriteFrame( FrameSequenceFrame * frame )
+{
+    if( ! mHadWriteError && ! frame->Write( mFile ) )
+    {   // Disk full, or similar.  Stop writing, since a partial chunk makes everything after it unreadable.
+        mHadWriteError = true ;
+    }
+}
+
+
+
+
+#if FRAME_SEQUENCE_WRITER_ASYNC
+
+/** Write pending frames as they arrive, until Close says to exit.
+
+    \param context  Address of the FrameSequenceWriter instance.
+*/
+/* static */ DWORD WINAPI FrameSequenceWriter::WriterThreadMain( LPVOID context )
+{
+    FrameSequenceWriter * writer = reinterpret_cast< FrameSequenceWriter * >( context ) ;
+
+    for( ;; )
+    {   // For each frame submitted...
+        FrameSequenceFrame * exportFrame = NULLPTR ;
+        writer->mPending.pop( exportFrame ) ;
+        if( NULLPTR == exportFrame )
+        {   // Close wants this thread to exit.
+            break ;
+        }
+        writer->WriteFrame( exportFrame ) ;
+        writer->mFree.push( exportFrame ) ;
+    }
+
+    return 0 ;
+}
+
+#endif
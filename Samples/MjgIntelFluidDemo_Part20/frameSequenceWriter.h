@@ -0,0 +1,210 @@
+/** \file frameSequenceWriter.h
+
+    \brief Exporter that streams per-frame particle and grid data into one chunked file, on a background thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FRAME_SEQUENCE_WRITER_H
+#define FRAME_SEQUENCE_WRITER_H
+
+#include <Core/useTbb.h>
+
+#include <Core/Containers/vector.h>
+#include <Core/SpatialPartition/uniformGrid.h>
+
+#include <Particles/particleAttributeView.h>
+
+#include <stdio.h>
+
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
+#if USE_TBB
+#   include "tbb/concurrent_queue.h"
+#endif
+
+// Forward declarations
+class ParticleSystem ;
+
+// Macros --------------------------------------------------------------
+
+/** Whether FrameSequenceWriter writes on a background thread.
+
+    Otherwise, SubmitFrame writes synchronously, which stalls the caller
+    for the duration of the write, but produces the same file.
+*/
+#if USE_TBB && defined( WIN32 )
+#   define FRAME_SEQUENCE_WRITER_ASYNC 1
+#else
+#   define FRAME_SEQUENCE_WRITER_ASYNC 0
+#endif
+
+// Types --------------------------------------------------------------
+
+/** Grids a frame sequence can contain.
+*/
+enum FrameSequenceGridE
+{
+    FRAME_SEQUENCE_GRID_VELOCITY    ,   ///< Vec3 velocity grid.
+    FRAME_SEQUENCE_GRID_DENSITY     ,   ///< Scalar density grid.
+} ;
+
+
+
+
+/** Kinds of stream a frame chunk contains.
+*/
+enum FrameSequenceStreamE
+{
+    FRAME_SEQUENCE_STREAM_PARTICLE_ATTRIBUTE    ,   ///< One attribute of every particle in one group.  mId is a ParticleAttributeE.
+    FRAME_SEQUENCE_STREAM_GRID                  ,   ///< Every point of one grid.  mId is a FrameSequenceGridE.
+} ;
+
+
+
+
+/** Header at the start of a frame sequence file.
+
+    A frame sequence file has this header, followed by chunks.  Each chunk
+    starts with a FrameSequenceChunkHeader that gives its size, so readers
+    can skip chunks they do not understand, and a truncated file (for example
+    from a crash) loses at most its last chunk.
+*/
+struct FrameSequenceFileHeader
+{
+    static const unsigned sMagic    = 0x53474a4d ;  ///< "MJGS" in little-endian byte order.
+    static const unsigned sVersion  = 1 ;           ///< Increment this whenever the file layout changes.
+
+    unsigned    mMagic                  ;   ///< Identifies file as a frame sequence.  Must equal sMagic.
+    unsigned    mVersion                ;   ///< Version of file layout.  Must equal sVersion.
+    unsigned    mParticleAttributeMask  ;   ///< Bit (1 << a) is set for each ParticleAttributeE a that frames contain.
+    unsigned    mPad                    ;   ///< Unused; keeps size a multiple of 8.
+} ;
+
+
+
+
+/** Header at the start of each chunk in a frame sequence file.
+*/
+struct FrameSequenceChunkHeader
+{
+    static const unsigned sTagFrame = 0x4d415246 ;  ///< "FRAM" in little-endian byte order.  Payload is a FrameSequenceFrameHeader then its streams.
+
+    unsigned            mTag            ;   ///< Kind of chunk.
+    unsigned            mPad            ;   ///< Unused; keeps mSizeInBytes naturally aligned.
+    unsigned long long  mSizeInBytes    ;   ///< Number of bytes in chunk payload, which follows this header.
+} ;
+
+
+
+
+/** Payload header of a frame chunk.
+*/
+struct FrameSequenceFrameHeader
+{
+    unsigned    mFrame          ;   ///< Frame counter.
+    unsigned    mNumStreams     ;   ///< Number of streams that follow.
+    double      mTimeNow        ;   ///< Virtual time.
+} ;
+
+
+
+
+/** Header of each stream in a frame chunk.
+
+    Stream data, which follows this header, holds mCount elements of
+    mNumComponents floats each, as a structure of arrays: every element of
+    one attribute is contiguous, so each stream has uniform type and
+    smoothly varying values, which offline tools compress well.
+*/
+struct FrameSequenceStreamHeader
+{
+    unsigned            mKind               ;   ///< Kind of stream; one of FrameSequenceStreamE.
+    unsigned            mId                 ;   ///< Which attribute or grid; see FrameSequenceStreamE.
+    unsigned            mGroupIndex         ;   ///< For particle attribute streams, index of particle group.
+    unsigned            mNumComponents      ;   ///< Number of floats per element: 1 for scalars, 3 for Vec3.
+    unsigned long long  mCount              ;   ///< Number of elements.
+    float               mGridMinCorner[ 3 ] ;   ///< For grid streams, location of first grid point.
+    float               mGridExtent[ 3 ]    ;   ///< For grid streams, size of region the grid spans.
+    unsigned            mGridNumPoints[ 3 ] ;   ///< For grid streams, number of grid points along each axis.
+    unsigned            mPad                ;   ///< Unused; keeps size a multiple of 8.
+} ;
+
+
+
+
+/** Copy of one frame's worth of exported data, awaiting writing.
+*/
+struct FrameSequenceFrame
+{
+    void Capture( const ParticleSystem & particleSystem , unsigned particleAttributeMask , const UniformGrid< Vec3 > * velocityGrid , const UniformGrid< float > * densityGrid , unsigned frame , double timeNow ) ;
+    bool Write( FILE * fp ) const ;
+
+    FrameSequenceFrameHeader            mHeader         ;   ///< Frame counter, time and number of streams.
+    VECTOR< FrameSequenceStreamHeader > mStreamHeaders  ;   ///< Description of each stream.
+    VECTOR< VECTOR< float > >           mStreamData     ;   ///< Contents of each stream.  Reused from frame to frame, so capturing stops allocating once sizes settle.
+
+    private:
+        FrameSequenceStreamHeader & AppendStream( FrameSequenceStreamE kind , unsigned id , unsigned numComponents , size_t count ) ;
+} ;
+
+
+
+
+/** Exporter that streams per-frame particle and grid data into one chunked file, for offline rendering.
+
+    SubmitFrame copies the requested data into a frame the writer owns, then
+    hands it to a background thread, which writes it.  A bounded pool of
+    frames circulates between the caller and the writer thread.  When the
+    writer falls behind and no frame is free, SubmitFrame drops the frame
+    instead of waiting, so exporting never stalls the simulation on I/O.
+    GetNumDroppedFrames reports how often that happened.
+*/
+class FrameSequenceWriter
+{
+    public:
+        explicit FrameSequenceWriter( size_t capacity = 4 ) ;
+        ~FrameSequenceWriter() ;
+
+        bool    Open( const char * filename , unsigned particleAttributeMask ) ;
+        void    Close() ;
+
+        /// Return whether Open succeeded and Close has not happened since.
+        bool    IsOpen() const { return mFile != NULLPTR ; }
+
+        bool    SubmitFrame( const ParticleSystem & particleSystem , const UniformGrid< Vec3 > * velocityGrid , const UniformGrid< float > * densityGrid , unsigned frame , double timeNow ) ;
+
+        /// Return number of frames SubmitFrame dropped because the writer fell behind, since Open.
+        size_t  GetNumDroppedFrames() const { return mNumDroppedFrames ; }
+
+        /// Return whether the writer failed to write some frame, since Open.
+        bool    GetHadWriteError() const { return mHadWriteError ; }
+
+    private:
+        FrameSequenceWriter( const FrameSequenceWriter & ) ;                // Disallow copy
+        FrameSequenceWriter & operator=( const FrameSequenceWriter & ) ;    // Disallow assignment
+
+        void    WriteFrame( FrameSequenceFrame * frame ) ;
+    #if FRAME_SEQUENCE_WRITER_ASYNC
+        static DWORD WINAPI WriterThreadMain( LPVOID context ) ;
+    #endif
+
+        VECTOR< FrameSequenceFrame * >                          mFrames                 ;   ///< All frames this writer owns.
+    #if FRAME_SEQUENCE_WRITER_ASYNC
+        tbb::concurrent_bounded_queue< FrameSequenceFrame * >   mFree                   ;   ///< Frames available for SubmitFrame to fill.
+        tbb::concurrent_bounded_queue< FrameSequenceFrame * >   mPending                ;   ///< Frames SubmitFrame filled, oldest first, awaiting the writer thread.  NULL tells the thread to exit.
+        HANDLE                                                  mWriterThread           ;   ///< Thread that writes pending frames.
+    #endif
+        FILE *                                                  mFile                   ;   ///< File frames go to, or NULL if none is open.
+        unsigned                                                mParticleAttributeMask  ;   ///< Bit (1 << a) is set for each ParticleAttributeE a to export.
+        size_t                                                  mNumDroppedFrames       ;   ///< Number of frames dropped because the writer fell behind.
+        volatile bool                                           mHadWriteError          ;   ///< Whether writing some frame failed.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
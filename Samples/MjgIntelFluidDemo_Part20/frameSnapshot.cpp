@@ -0,0 +1,185 @@
+/** \file frameSnapshot.cpp
+
+    \brief Copy of the simulation state that rendering reads, and a bounded queue that hands those copies from a simulation thread to a render thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "frameSnapshot.h"
+
+#include <Particles/particleSystem.h>
+
+#include <VortonFluid/vortonSim.h>
+
+#include <Impulsion/physicalObject.h>
+
+#include <Core/Performance/perfBlock.h>
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Copy the state that rendering reads.
+
+    \param particleSystem   Particle system whose particles to copy, one array per group.
+
+    \param vortonSim        Simulation whose signed distance grid to copy.  Non-const, since that grid can be computed on demand.
+
+    \param physicalObjects  Physical objects whose poses to copy.
+
+    \param frame            Frame counter when this simulation step finished.
+
+    \param timeNow          Virtual time when this simulation step finished.
+
+    \note Assigning to arrays that already hold a previous snapshot reuses their
+            storage, so once particle counts settle, this only copies.
+*/
+void FrameSnapshot::Capture( const ParticleSystem & particleSystem , VortonSim & vortonSim , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , unsigned frame , double timeNow )
+{
+    PERF_BLOCK( FrameSnapshot__Capture ) ;
+
+    const size_t numGroups = particleSystem.GetNumGroups() ;
+    mParticlesPerGroup.Resize( numGroups ) ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        mParticlesPerGroup[ iGroup ] = particleSystem.GetGroup( iGroup )->GetParticles() ;
+    }
+
+#if FRAME_SNAPSHOT_PACK_SIGNED_DISTANCE
+    mSignedDistanceGrid.CopyFromDense( vortonSim.GetSignedDistanceGrid() ) ;
+#else
+    mSignedDistanceGrid = vortonSim.GetSignedDistanceGrid() ;
+#endif
+
+    const size_t numBodies = physicalObjects.Size() ;
+    mBodies.Resize( numBodies ) ;
+    mBodyPositions.Resize( numBodies ) ;
+    mBodyOrientations.Resize( numBodies ) ;
+    for( size_t iBody = 0 ; iBody < numBodies ; ++ iBody )
+    {   // For each physical object...
+        const Impulsion::PhysicalObject * physicalObject = physicalObjects[ iBody ] ;
+        mBodies[ iBody ]            = physicalObject ;
+        mBodyPositions[ iBody ]     = physicalObject->GetBody()->GetPosition() ;
+        mBodyOrientations[ iBody ]  = physicalObject->GetBody()->GetOrientation() ;
+    }
+
+    mFrame      = frame ;
+    mTimeNow    = timeNow ;
+}
+
+
+
+
+/** Find the pose this snapshot holds for the given physical object.
+
+    \return Whether this snapshot holds a pose for physicalObject.
+*/
+bool FrameSnapshot::FindBody( const Impulsion::PhysicalObject * physicalObject , Vec3 & position , Mat33 & orientation ) const
+{
+    const size_t numBodies = mBodies.Size() ;
+    for( size_t iBody = 0 ; iBody < numBodies ; ++ iBody )
+    {   // For each body in this snapshot...  Scenes have few bodies, so a linear search suffices.
+        if( mBodies[ iBody ] == physicalObject )
+        {   // Found sought body.
+            position    = mBodyPositions[ iBody ] ;
+            orientation = mBodyOrientations[ iBody ] ;
+            return true ;
+        }
+    }
+    return false ;
+}
+
+
+
+
+#if USE_TBB
+
+/** Construct queue that owns the given number of snapshots, all initially free for writing.
+*/
+FrameSnapshotQueue::FrameSnapshotQueue( size_t capacity )
+{
+    ASSERT( capacity >= 2 ) ;   // Reader holds one snapshot while writer fills another.
+    mFree.set_capacity( capacity ) ;
+    mPublished.set_capacity( capacity ) ;
+    mSnapshots.Reserve( capacity ) ;
+    for( size_t iSnapshot = 0 ; iSnapshot < capacity ; ++ iSnapshot )
+    {   // For each snapshot to own...
+        mSnapshots.PushBack( new FrameSnapshot ) ;
+        mFree.push( mSnapshots.Back() ) ;
+    }
+}
+
+
+
+
+FrameSnapshotQueue::~FrameSnapshotQueue()
+{
+    const size_t numSnapshots = mSnapshots.Size() ;
+    for( size_t iSnapshot = 0 ; iSnapshot < numSnapshots ; ++ iSnapshot )
+    {   // For each snapshot this queue owns...
+        delete mSnapshots[ iSnapshot ] ;
+    }
+}
+
+
+
+
+/** Return a snapshot for the writer to fill, waiting until the reader releases one if none is free.
+*/
+FrameSnapshot * FrameSnapshotQueue::AcquireForWriting()
+{
+    FrameSnapshot * snapshot = NULLPTR ;
+    mFree.pop( snapshot ) ;
+    return snapshot ;
+}
+
+
+
+
+/** Hand a snapshot the writer filled to the reader.
+*/
+void FrameSnapshotQueue::Publish( FrameSnapshot * snapshot )
+{
+    ASSERT( snapshot ) ;
+    mPublished.push( snapshot ) ;
+}
+
+
+
+
+/** Return the oldest published snapshot, waiting until the writer publishes one if none awaits.
+*/
+FrameSnapshot * FrameSnapshotQueue::AcquireForReading()
+{
+    FrameSnapshot * snapshot = NULLPTR ;
+    mPublished.pop( snapshot ) ;
+    return snapshot ;
+}
+
+
+
+
+/** Obtain the oldest published snapshot, if any, without waiting.
+
+    \return Whether a snapshot was available.
+*/
+bool FrameSnapshotQueue::TryAcquireForReading( FrameSnapshot * & snapshot )
+{
+    return mPublished.try_pop( snapshot ) ;
+}
+
+
+
+
+/** Return a snapshot the reader has finished with, so the writer can reuse it.
+*/
+void FrameSnapshotQueue::Release( FrameSnapshot * snapshot )
+{
+    ASSERT( snapshot ) ;
+    mFree.push( snapshot ) ;
+}
+
+#endif
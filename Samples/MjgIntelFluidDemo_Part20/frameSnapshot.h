@@ -0,0 +1,112 @@
+/** \file frameSnapshot.h
+
+    \brief Copy of the simulation state that rendering reads, and a bounded queue that hands those copies from a simulation thread to a render thread.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+#include <Core/useTbb.h>
+
+#include <Core/Containers/vector.h>
+#include <Core/SpatialPartition/uniformGrid.h>
+#include <Core/SpatialPartition/packedUniformGrid.h>
+#include <Core/Math/mat33.h>
+
+#include <Particles/particle.h>
+
+#if USE_TBB
+#   include "tbb/concurrent_queue.h"
+#endif
+
+// Forward declarations
+class ParticleSystem ;
+class VortonSim ;
+namespace Impulsion
+{
+    class PhysicalObject ;
+} ;
+
+// Macros --------------------------------------------------------------
+
+/** Whether FrameSnapshot stores the signed distance grid in half precision.
+
+    Rendering only extracts an isosurface from that grid, which tolerates
+    half precision, so packing halves the bytes the simulation thread writes
+    and the render thread reads each frame.  The render thread decodes the
+    grid before extracting the isosurface.
+*/
+#define FRAME_SNAPSHOT_PACK_SIGNED_DISTANCE 1
+
+// Types --------------------------------------------------------------
+
+/** Copy of the simulation state that rendering reads, taken when a simulation step finishes.
+
+    Rendering reads a snapshot instead of the live simulation state, so the
+    next simulation step can run while the previous one renders.
+*/
+struct FrameSnapshot
+{
+    FrameSnapshot()
+        : mFrame( 0 )
+        , mTimeNow( 0.0 )
+    {}
+
+    void Capture( const ParticleSystem & particleSystem , VortonSim & vortonSim , const VECTOR< Impulsion::PhysicalObject * > & physicalObjects , unsigned frame , double timeNow ) ;
+    bool FindBody( const Impulsion::PhysicalObject * physicalObject , Vec3 & position , Mat33 & orientation ) const ;
+
+    VECTOR< VECTOR< Particle > >                mParticlesPerGroup  ;   ///< Copy of particles in each group of the particle system.
+#if FRAME_SNAPSHOT_PACK_SIGNED_DISTANCE
+    PackedUniformGrid< float , UniformGridCodecFloat16 > mSignedDistanceGrid ;  ///< Half-precision copy of signed distance grid, from which rendering extracts the fluid isosurface.
+#else
+    UniformGrid< float >                        mSignedDistanceGrid ;   ///< Copy of signed distance grid, from which rendering extracts the fluid isosurface.
+#endif
+    VECTOR< const Impulsion::PhysicalObject * > mBodies             ;   ///< Physical objects whose poses this snapshot holds.  Only for identification; do not dereference.
+    VECTOR< Vec3 >                              mBodyPositions      ;   ///< Position of each body in mBodies.
+    VECTOR< Mat33 >                             mBodyOrientations   ;   ///< Orientation of each body in mBodies.
+    unsigned                                    mFrame              ;   ///< Frame counter when simulation step finished.
+    double                                      mTimeNow            ;   ///< Virtual time when simulation step finished.
+} ;
+
+
+
+
+#if USE_TBB
+/** Bounded queue that hands frame snapshots from a simulation thread to a render thread.
+
+    This owns a fixed number of snapshots, which circulate between the
+    writer (simulation) and the reader (render).  The writer blocks when all
+    snapshots await reading, and the reader blocks until a snapshot arrives,
+    so neither side runs more than the queue capacity ahead of the other.
+    Snapshots get reused, so once their contents reach steady-state size,
+    capturing does not allocate memory.
+*/
+class FrameSnapshotQueue
+{
+    public:
+        explicit FrameSnapshotQueue( size_t capacity = 2 ) ;
+        ~FrameSnapshotQueue() ;
+
+        FrameSnapshot * AcquireForWriting() ;
+        void            Publish( FrameSnapshot * snapshot ) ;
+        FrameSnapshot * AcquireForReading() ;
+        bool            TryAcquireForReading( FrameSnapshot * & snapshot ) ;
+        void            Release( FrameSnapshot * snapshot ) ;
+
+    private:
+        FrameSnapshotQueue( const FrameSnapshotQueue & ) ;              // Disallow copy
+        FrameSnapshotQueue & operator=( const FrameSnapshotQueue & ) ;  // Disallow assignment
+
+        VECTOR< FrameSnapshot * >                           mSnapshots  ;   ///< All snapshots this queue owns.
+        tbb::concurrent_bounded_queue< FrameSnapshot * >    mFree       ;   ///< Snapshots available for the writer to fill.
+        tbb::concurrent_bounded_queue< FrameSnapshot * >    mPublished  ;   ///< Snapshots the writer filled, oldest first, awaiting the reader.
+} ;
+#endif
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
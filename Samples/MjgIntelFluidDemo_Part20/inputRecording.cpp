@@ -0,0 +1,141 @@
+/** \file inputRecording.cpp
+
+    \brief Recording of interactive input events, stamped by simulation step, for replaying a session repeatably.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "inputRecording.h"
+
+#include <Core/Performance/perfBlock.h>
+#include <Core/Utility/macros.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const char sFileTag[] = "InputRecording" ;   ///< First word of each recording file.
+
+// Functions --------------------------------------------------------------
+
+
+
+
+InputRecording::InputRecording()
+    : mScenario( 0 )
+{
+}
+
+
+
+
+/** Discard all events and start recording anew, from the given scenario.
+
+    \param scenario Initial conditions that just began.  See InteSiVis::InitialConditions.
+*/
+void InputRecording::Start( int scenario )
+{
+    mEvents.Clear() ;
+    mScenario = scenario ;
+}
+
+
+
+
+/** Append the given event, which must not precede the previous event.
+*/
+void InputRecording::Append( const InputEvent & inputEvent )
+{
+    ASSERT( inputEvent.mType < NUM_INPUT_EVENT_TYPES ) ;
+    ASSERT( mEvents.Empty() || ( mEvents.Back().mStep <= inputEvent.mStep ) ) ;
+    mEvents.PushBack( inputEvent ) ;
+}
+
+
+
+
+/** Write recording into the given file, replacing its contents.
+
+    \return Whether writing succeeded.
+
+    The file starts with a line holding sFileTag, the file format version
+    and the scenario, followed by one line per event, holding step, type,
+    key, state, mouse position and modifier keys, as decimal integers.
+*/
+bool InputRecording::Save( const char * filename ) const
+{
+    PERF_BLOCK( InputRecording__Save ) ;
+
+    FILE * fp = fopen( filename , "w" ) ;
+    if( NULLPTR == fp )
+    {
+        return false ;
+    }
+
+    fprintf( fp , "%s %u %d\n" , sFileTag , sVersion , mScenario ) ;
+    const size_t numEvents = mEvents.Size() ;
+    for( size_t iEvent = 0 ; iEvent < numEvents ; ++ iEvent )
+    {   // For each event...
+        const InputEvent & inputEvent = mEvents[ iEvent ] ;
+        fprintf( fp , "%u %u %d %d %d %d %d\n" , inputEvent.mStep , inputEvent.mType , inputEvent.mKey , inputEvent.mState , inputEvent.mX , inputEvent.mY , inputEvent.mModifierKeys ) ;
+    }
+
+    const bool succeeded = ( 0 == ferror( fp ) ) ;
+    return ( 0 == fclose( fp ) ) && succeeded ;
+}
+
+
+
+
+/** Read recording from the given file, which Save wrote.
+
+    \return Whether the file was a valid recording.  Otherwise this recording is empty.
+*/
+bool InputRecording::Load( const char * filename )
+{
+    PERF_BLOCK( InputRecording__Load ) ;
+
+    Start( 0 ) ;
+
+    FILE * fp = fopen( filename , "r" ) ;
+    if( NULLPTR == fp )
+    {
+        return false ;
+    }
+
+    char        tag[ sizeof( sFileTag ) + 1 ] ;
+    unsigned    version = 0 ;
+    int         scenario = 0 ;
+    if(     ( 3 != fscanf( fp , "%15s %u %d" , tag , & version , & scenario ) )
+        ||  ( 0 != strcmp( tag , sFileTag ) )
+        ||  ( version != sVersion ) )
+    {   // File is not a recording, or is from an incompatible version.
+        fclose( fp ) ;
+        return false ;
+    }
+    mScenario = scenario ;
+
+    InputEvent inputEvent ;
+    int numFields ;
+    while( 7 == ( numFields = fscanf( fp , "%u %u %d %d %d %d %d" , & inputEvent.mStep , & inputEvent.mType , & inputEvent.mKey , & inputEvent.mState , & inputEvent.mX , & inputEvent.mY , & inputEvent.mModifierKeys ) ) )
+    {   // For each event in file...
+        if(     ( inputEvent.mType >= NUM_INPUT_EVENT_TYPES )
+            ||  ( ! mEvents.Empty() && ( inputEvent.mStep < mEvents.Back().mStep ) ) )
+        {   // Event is malformed or out of order.
+            numFields = 0 ;
+            break ;
+        }
+        mEvents.PushBack( inputEvent ) ;
+    }
+    fclose( fp ) ;
+
+    if( numFields != EOF )
+    {   // File ended with something other than a whole event.
+        Start( 0 ) ;
+        return false ;
+    }
+    return true ;
+}
@@ -0,0 +1,117 @@
+/** \file inputRecording.h
+
+    \brief Recording of interactive input events, stamped by simulation step, for replaying a session repeatably.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include <Core/Containers/vector.h>
+
+#include <stddef.h>
+
+// Types --------------------------------------------------------------
+
+/** Kinds of input event a recording can contain, one per GLUT input callback that changes application state.
+*/
+enum InputEventTypeE
+{
+    INPUT_EVENT_KEY             ,   ///< Regular key pressed.  mKey is the character.
+    INPUT_EVENT_SPECIAL_KEY     ,   ///< Special key (function or arrow key) pressed.  mKey is a GLUT_KEY_* value.
+    INPUT_EVENT_MOUSE_BUTTON    ,   ///< Mouse button pressed or released.  mKey is the button; mState is GLUT_DOWN or GLUT_UP.
+    INPUT_EVENT_MOUSE_MOTION    ,   ///< Mouse moved, with or without buttons held.
+    NUM_INPUT_EVENT_TYPES
+} ;
+
+
+
+
+/** One input event, as a GLUT callback received it.
+*/
+struct InputEvent
+{
+    InputEvent()
+        : mStep( 0 )
+        , mType( INPUT_EVENT_KEY )
+        , mKey( 0 )
+        , mState( 0 )
+        , mX( 0 )
+        , mY( 0 )
+        , mModifierKeys( 0 )
+    {}
+
+    InputEvent( unsigned step , InputEventTypeE type , int key , int state , int x , int y , int modifierKeys )
+        : mStep( step )
+        , mType( type )
+        , mKey( key )
+        , mState( state )
+        , mX( x )
+        , mY( y )
+        , mModifierKeys( modifierKeys )
+    {}
+
+    unsigned    mStep           ;   ///< Number of simulation steps since the scenario began, when event arrived.  Replay applies the event after that many steps.
+    unsigned    mType           ;   ///< Kind of event; one of InputEventTypeE.
+    int         mKey            ;   ///< Key or mouse button, depending on mType.
+    int         mState          ;   ///< For mouse button events, GLUT_DOWN or GLUT_UP.
+    int         mX              ;   ///< Window-relative mouse position when event arrived.
+    int         mY              ;   ///< Window-relative mouse position when event arrived.
+    int         mModifierKeys   ;   ///< Modifier (shift, control, alt) keys held, as glutGetModifiers reports them.
+} ;
+
+
+
+
+/** Recording of interactive input events, stamped by simulation step, for replaying a session repeatably.
+
+    Input handlers change simulation state (for example, dragging a rigid
+    body, or changing the simulation technique) at whatever moment the user
+    acts, so a session that stuttered cannot otherwise be reproduced.  A
+    recording holds the scenario it started from, and each event along
+    with the number of simulation steps that preceded it.  Replaying the
+    events after the same steps, starting from the same initial conditions,
+    reproduces the session.
+
+    Stamps count steps rather than using the frame counter, because the frame
+    counter stands still while paused and runs backward while stepping
+    backward, whereas the number of steps only grows.  Events that arrive
+    while paused share a stamp, so replay applies them together, before the
+    next step, which is when they first affect the simulation.
+
+    Files are plain text, one event per line, so people can read, trim or
+    author them.
+*/
+class InputRecording
+{
+    public:
+        InputRecording() ;
+
+        void    Start( int scenario ) ;
+        void    Append( const InputEvent & inputEvent ) ;
+
+        bool    Save( const char * filename ) const ;
+        bool    Load( const char * filename ) ;
+
+        /// Return scenario that was running when recording began.
+        int     GetScenario() const { return mScenario ; }
+
+        /// Return number of events recorded.
+        size_t  GetNumEvents() const { return mEvents.Size() ; }
+
+        /// Return event with the given index, in order of arrival.
+        const InputEvent & GetEvent( size_t iEvent ) const { return mEvents[ iEvent ] ; }
+
+    private:
+        static const unsigned sVersion = 1 ;    ///< Increment this whenever the file format changes.
+
+        VECTOR< InputEvent >    mEvents     ;   ///< Events in order of arrival, hence nondecreasing in mStep.
+        int                     mScenario   ;   ///< Scenario that was running when recording began.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -13,6 +13,7 @@
 #include <Sim/Vorton/vorticityDistribution.h>
 
 #include <Render/Scene/light.h>
+#include <Render/Device/gpuTimer.h>
 
 #include <Particles/Operation/pclOpFindBoundingBox.h>
 #include <Particles/Operation/pclOpWind.h>
@@ -30,7 +31,9 @@
 #include <Core/Math/vec4.h>
 #include <Core/Math/mat4.h>
 
+#include <Core/Performance/perfBaseline.h>
 #include <Core/Performance/perfBlock.h>
+#include <Core/Performance/timer.h>
 
 #if defined( _DEBUG )
     #define UNIT_TEST
@@ -48,6 +51,7 @@
 #include <assert.h>
 
 #include <stdarg.h>
+#include <string.h>
 
 #pragma comment(lib, "glut32.lib")
 
@@ -63,21 +67,7 @@ static const float  sTimeStep               = sOneOver30 ;
 
 static InteSiVis * sInstance = 0 ;
 
-static const size_t vortonStride                = sizeof( Vorton ) ;
-static const size_t vortonOffsetToAngVel        = offsetof( Vorton , mAngularVelocity   ) ;
-static const size_t vortonOffsetToSize          = offsetof( Vorton , mSize              ) ;
-static const size_t vortonOffsetToDensity       = offsetof( Vorton , mDensity           ) ;
-
-static const size_t tracerStride                = sizeof( Particle ) ;
-static const size_t tracerOffsetToAngVel        = offsetof( Particle , mAngularVelocity ) ;
-static const size_t tracerOffsetToSize          = offsetof( Particle , mSize            ) ;
-
-static const size_t tracerOffsetToDensity       = offsetof( Particle , mDensity         ) ;
-#if ENABLE_FIRE
-static const size_t tracerOffsetToFuelFraction  = offsetof( Particle , mFuelFraction    ) ;
-static const size_t tracerOffsetToFlameFraction = offsetof( Particle , mFlameFraction   ) ;
-static const size_t tracerOffsetToSmokeFraction = offsetof( Particle , mSmokeFraction   ) ;
-#endif
+static const char * sCheckpointFilename = "simulation.checkpoint" ;   ///< File that F10 saves to and F12 restores from.
 
 static int sMousePrevX = -999 ;
 static int sMousePrevY = -999 ;
@@ -86,6 +76,7 @@ static const float gScale = 1.0f ;
 
 #if defined( PROFILE )
 static const int sFrameCountMax = 600   ;   // In profile builds, run for a fixed number of frames
+static const int sTraceFrameCount = 60  ;   // In profile builds, number of frames to record a timeline for, upon request.
 static size_t    sNumTracersSum = 0     ;   // Sum of current number of tracers
 static size_t    sNumVortonsSum = 0     ;   // Sum of current number of vortons
 #endif
@@ -95,8 +86,13 @@ static size_t    sNumVortonsSum = 0     ;   // Sum of current number of vortons
 // Functions --------------------------------------------------------------
 
 /** Construct application for interactive simulation and visualization.
+
+    \param renderApi           Render API, or NULL to run headless, as the benchmark does.
+                                Headless, there is no window and no simulation thread; callers step the simulation directly.
+
+    \param parallelSettings    How many worker threads parallel work uses, and where they run.
 */
-InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi )
+InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi , const Parallel::Settings & parallelSettings )
     : mRenderSystem( renderApi )
     , mFluidScene( & mRenderSystem , & mPclSysMgr )
 
@@ -105,6 +101,8 @@ InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi )
 
     , mFrameDurSecAvg( sTimeStep )
     , mFrame( 0 )
+    , mNumStepsSimulated( 0 )
+    , mNumScenariosBegun( 0 )
     , mTimeNow( 0.0 )
     , mTimeStep( sTimeStep )
     , mTimeStepMin( FLT_MAX )
@@ -122,6 +120,15 @@ InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi )
     , mDiagnosticText( DIAG_TEXT_TIMING )
 #endif
     , mEmphasizeCameraTarget( true )
+    , mParallelExecutor( parallelSettings )
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    , mRenderSnapshot( NULLPTR )
+    , mSimulationThread( NULL )
+    , mSimulationStepRequested( NULL )
+    , mSimulationThreadQuit( false )
+    , mMainThreadFloatingPointControlWord( 0 )
+    , mMainThreadMmxControlStatusRegister( 0 )
+#endif
 {
     PERF_BLOCK_ENABLE_PROFILING( sFrameCountMax ) ;   // Profile specified number of frames.
 
@@ -130,6 +137,20 @@ InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi )
     ASSERT( 0 == sInstance ) ;
     sInstance = this ;
 
+    RegisterTelemetry() ;
+
+#if INTE_SI_VIS_REMOTE_VIEWER
+    if( ! mRemoteViewClient.Connect( INTE_SI_VIS_REMOTE_VIEW_HOST , INTE_SI_VIS_REMOTE_VIEW_PORT ) )
+    {
+        fprintf( stderr , "InteSiVis: cannot connect to remote view at %s:%u\n" , INTE_SI_VIS_REMOTE_VIEW_HOST , unsigned( INTE_SI_VIS_REMOTE_VIEW_PORT ) ) ;
+    }
+#elif INTE_SI_VIS_REMOTE_VIEW_PORT
+    if( ! mRemoteViewServer.StartServer( INTE_SI_VIS_REMOTE_VIEW_PORT ) )
+    {
+        fprintf( stderr , "InteSiVis: cannot serve remote view on port %u\n" , unsigned( INTE_SI_VIS_REMOTE_VIEW_PORT ) ) ;
+    }
+#endif
+
 #if defined( _DEBUG )
     mGridDecorations = GRID_DECO_CELLS   ; // Render grid cells.
     mDiagnosticText  = DIAG_TEXT_SUMMARY ; // Render summary diagnostic text.
@@ -150,7 +171,10 @@ InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi )
     // Set the camera in motion.
     //mQdCamera.SetOrbitalTrajectory( Vec3( -0.002f , -0.000f , 0.0f ) ) ;
 
-    glutReshapeWindow( 1920 , 1080 ) ;
+    if( renderApi )
+    {   // Not headless.
+        glutReshapeWindow( 1920 , 1080 ) ;
+    }
 
     // Initialize system timer used inside Idle. 
     QueryPerformanceCounter( & mSystemTimeBefore ) ; // This is probably redundant with the call inside InitialConditions
@@ -164,6 +188,15 @@ InteSiVis::InteSiVis( PeGaSys::Render::ApiBase * renderApi )
     UnitTestPoisson1D() ;
     extern void UnitTestPoisson2D() ;
     UnitTestPoisson2D() ;
+    extern void UnitTestVectorPoissonMultiGrid() ;
+    UnitTestVectorPoissonMultiGrid() ;
+#endif
+
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    if( renderApi )
+    {   // Not headless.
+        StartSimulationThread() ;
+    }
 #endif
 }
 
@@ -176,6 +209,20 @@ InteSiVis::~InteSiVis()
 {
     PERF_BLOCK( InteSiVis__dtor) ;
 
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    StopSimulationThread() ;
+#endif
+
+#if INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_FIXED_TIMESTEP
+    // ParticleSystem::Clear does not delete groups, but this application allocated the render-side groups, so delete them here.
+    VECTOR< ParticleGroup * > renderParticleGroups( mRenderParticleSystem.Begin() , mRenderParticleSystem.End() ) ;
+    mRenderParticleSystem.Clear() ;
+    for( size_t iGroup = 0 ; iGroup < renderParticleGroups.Size() ; ++ iGroup )
+    {   // For each render-side particle group...
+        delete renderParticleGroups[ iGroup ] ;
+    }
+#endif
+
     sInstance = 0 ;
 }
 
@@ -241,7 +288,13 @@ void InteSiVis::CreateRigidBodyModelsAndEntities()
 
     // Populate the rest of the fluid scene AFTER adding the solid models above, because PopulateScene adds
     // fluid surface and particles which are translucent, therefore must render after all opaque objects.
+#if INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_FIXED_TIMESTEP
+    // Render particles from snapshots or interpolated copies, not from the live simulation, which the simulation thread modifies while this renders, or which leads real time by up to a step.
+    MatchRenderParticleSystemToFluidParticleSystem() ;
+    mFluidScene.PopulateSceneWithFluidSurfaceAndParticles( & mRenderParticleSystem ) ;
+#else
     mFluidScene.PopulateSceneWithFluidSurfaceAndParticles( mFluidParticleSystem ) ;
+#endif
 
     CopyLightsFromQdToPeGaSys() ;
 }
@@ -273,12 +326,31 @@ void InteSiVis::InitialConditions( unsigned ic )
 
     ASSERT( Impulsion::PhysicalObject::sAmbientTemperature == Particle_sAmbientTemperature ) ; // This is not a necessary condition but I have not tested it otherwise.  If one changes without the other, probably should test a bunch of code to make sure it behaves as intended.
 
+#if INTE_SI_VIS_RECORD_INPUT
+    if( mNumScenariosBegun > 0 )
+    {   // Keep input of the previous scenario, so the benchmark can replay it.
+        SaveInputRecording() ;
+    }
+    mInputRecording.Start( int( ic ) ) ;
+#endif
+
     mScenario               = ic  ;
     sInstance->mFrame       = 0   ;
+    mNumStepsSimulated      = 0   ;
     sInstance->mTimeNow     = 0.0 ;
     sInstance->mTimeStep    = sTimeStep ;
     sInstance->mTimeStepMin =   FLT_MAX ;
     sInstance->mTimeStepMax = - FLT_MAX ;
+    ++ mNumScenariosBegun ;
+
+    // Reset input state that would otherwise carry over from the previous scenario, so replaying a recording of this scenario starts from the same state.
+    mPhysObjFocus           = 0   ;
+    sMousePrevX             = -999 ;
+    sMousePrevY             = -999 ;
+
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    DiscardFrameSnapshot() ; // Snapshot describes previous scenario.
+#endif
 
     mPclSysMgr.Clear() ; // Clear all particle systems to have a fresh start.  Code below adds them.
     mFluidParticleSystem = NULLPTR ;
@@ -327,6 +399,16 @@ void InteSiVis::InitialConditions( unsigned ic )
     const VECTOR< Particle > *  vortonsImplyingTracers      = 0 ;
     Vec3                        tracerGridScale             ( 1.0f , 1.0f , 1.0f ) ;
 
+#if INTE_SI_VIS_GPU_VORTON_VELOCITY
+    // CreateFluidParticleSystem made a new VortonSim, so hand it the GPU evaluator, if that has initialized.
+    vortonSim.SetVelocityEvaluator( mVortonVelocityGpu.IsValid() ? & mVortonVelocityGpu : NULLPTR ) ;
+#endif
+
+#if INTE_SI_VIS_GPU_TRACERS
+    // Tracers from the previous scenario do not belong in this one.  This scenario emits its own, below, which the next frame adopts.
+    mTracerAdvectionGpu.RemoveAllTracers() ;
+#endif
+
     mVortonPclGrpInfo.mPclOpKillAge->mAgeMax    = INT_MAX ;                                     // By default, disable vorton killing.
     mTracerPclGrpInfo.mPclOpKillAge->mAgeMax    = mVortonPclGrpInfo.mPclOpKillAge->mAgeMax ;    // By default, disable tracer killing.
     mVortonPclGrpInfo.mPclOpEmit->mEmitRate     = 0.0f ;                                        // By default, disable vorton emission.
@@ -1429,11 +1511,19 @@ mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.SetSpecificHeatCapacity( 1.0f ) ;
 
     }
 
+    bool importedTracers = false ;
+    {   // Let an initial state file, if this scenario has one, replace procedural vortons and tracers, so large setups can be authored elsewhere.
+        char filename[ 64 ] ;
+        sprintf( filename , "scenario%02u.initialstate" , ic ) ;
+        ImportInitialParticles( filename , importedTracers ) ;
+    }
+
     // Apply same wind to tracers that vortons experience.
     * mTracerPclGrpInfo.mPclOpWind = * mVortonPclGrpInfo.mPclOpWind ;
 
     // Tell Fluid-Body simulation about rigid bodies.
     GetPhysicalObjects().Clear() ;
+    mContactSolver.Clear() ;
     for( size_t iSphere = 0 ; iSphere < GetSpheres().Size() ; ++ iSphere )
     {   // For each sphere in the simulation...
         RbSphere * pSphere = & GetSpheres()[ iSphere ] ;
@@ -1467,7 +1557,10 @@ mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.SetSpecificHeatCapacity( 1.0f ) ;
         UniformGridGeometry tracerGrid( vortonSim.GetGrid() ) ;
         tracerGrid.Scale( vortonSim.GetGrid() , tracerGridScale ) ;
 
-        if( systemTracksFluidSurfaceUsingSdf )
+        if( importedTracers )
+        {   // Initial state file supplied tracers, so emit none.
+        }
+        else if( systemTracksFluidSurfaceUsingSdf )
         {   // This case uses SDF to track fluid surface.
             // Emit initial tracers near SDF zero-crossing.
             PclOpSeedSurfaceTracers::Emit( mTracerPclGrpInfo.mParticleGroup->GetParticles() , 4 , mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetSignedDistanceGrid() , PclOpSeedSurfaceTracers::sBandWidthAutomatic , ambientFluidDensity ) ;
@@ -1493,6 +1586,57 @@ mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.SetSpecificHeatCapacity( 1.0f ) ;
 
     QueryPerformanceCounter( & mSystemTimeBefore ) ; // Reset system timer
 
+#if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+    {   // Start a new frame sequence for this scenario.  This finishes writing the previous scenario's sequence.
+        char filename[ 64 ] ;
+        sprintf( filename , "scenario%02u.framesequence" , ic ) ;
+        unsigned particleAttributeMask =    ( 1u << PARTICLE_ATTRIBUTE_POSITION )
+                                        |   ( 1u << PARTICLE_ATTRIBUTE_VELOCITY )
+                                        |   ( 1u << PARTICLE_ATTRIBUTE_DENSITY  )
+                                        |   ( 1u << PARTICLE_ATTRIBUTE_SIZE     ) ;
+    #if ENABLE_FIRE
+        particleAttributeMask |=    ( 1u << PARTICLE_ATTRIBUTE_FUEL_FRACTION  )
+                                |   ( 1u << PARTICLE_ATTRIBUTE_FLAME_FRACTION )
+                                |   ( 1u << PARTICLE_ATTRIBUTE_SMOKE_FRACTION ) ;
+    #endif
+        if( ! mFrameSequenceWriter.Open( filename , particleAttributeMask ) )
+        {
+            printf( "InteSiVis::InitialConditions: could not create %s\n" , filename ) ;
+        }
+    }
+#endif
+
+#if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE
+    {   // Play back this scenario's recording, if it has one, instead of simulating it.
+        char filename[ 64 ] ;
+        sprintf( filename , "scenario%02u.framesequence" , ic ) ;
+        if( mFrameSequenceReader.Open( filename ) && ( mFrameSequenceReader.GetNumFrames() > 0 ) )
+        {
+            SeekPlayback( 0 ) ;
+        }
+        else
+        {
+            printf( "InteSiVis::InitialConditions: no recording in %s, so simulating\n" , filename ) ;
+            mFrameSequenceReader.Close() ;
+        }
+    }
+#endif
+
+#if INTE_SI_VIS_CAPTURE_FRAMES
+    {   // Start a new frame recording for this scenario.  This finishes writing the previous scenario's frames.
+        char filenamePrefix[ 64 ] ;
+        sprintf( filenamePrefix , "scenario%02u_frame" , ic ) ;
+        if( ! mFrameCaptureWriter.Open( filenamePrefix ) )
+        {
+            printf( "InteSiVis::InitialConditions: could not record frames to %s\n" , filenamePrefix ) ;
+        }
+    }
+#endif
+
+#if INTE_SI_VIS_VOLUME_RENDER
+    PreferVolumeRendering() ;
+#endif
+
 #if PROFILE
     printf( "Initial condition %i, simulation objects: %i tracers    %i vortons    %i spheres %i boxes\n"
             , ic , mTracerPclGrpInfo.mParticleGroup->GetNumParticles() , vortons.Size() , GetSpheres().Size() , GetBoxes().size() ) ;
@@ -1503,6 +1647,279 @@ mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.SetSpecificHeatCapacity( 1.0f ) ;
 
 
 
+/** Write a checkpoint of the current simulation state to the given file.
+
+    \return Whether writing succeeded.
+
+    \see RestoreCheckpoint, SimulationCheckpoint_Save.
+*/
+bool InteSiVis::SaveCheckpoint( const char * filename ) const
+{
+    PERF_BLOCK( InteSiVis__SaveCheckpoint ) ;
+
+    if( NULLPTR == mFluidParticleSystem )
+    {   // No scenario is running.
+        return false ;
+    }
+
+    SimulationCheckpointContents contents ;
+    contents.mParticleSystem    = mFluidParticleSystem ;
+    contents.mPhysicalObjects   = & mPhysicalObjects ;
+    contents.mVelocityGrid      = & mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
+    contents.mScenario          = mScenario ;
+    contents.mFrame             = mFrame ;
+    contents.mTimeNow           = mTimeNow ;
+
+    const bool saved = SimulationCheckpoint_Save( filename , contents ) ;
+    printf( "InteSiVis::SaveCheckpoint: %s frame %u to %s\n" , saved ? "saved" : "FAILED to save" , mFrame , filename ) ;
+    return saved ;
+}
+
+
+
+
+/** Resume simulation from a checkpoint that SaveCheckpoint wrote.
+
+    This rebuilds the checkpointed scenario with InitialConditions, which sets
+    up everything that does not change while simulating (particle operations,
+    emitters, render models), then overwrites particles, rigid bodies and the
+    clock with checkpointed values, copying them straight out of the mapped
+    file.  The next Update recomputes the velocity grid from the restored
+    vortons, so this does not copy the checkpointed grid.
+
+    \return Whether restoring succeeded.  Upon failure, this leaves the current simulation running as it was.
+*/
+bool InteSiVis::RestoreCheckpoint( const char * filename )
+{
+    PERF_BLOCK( InteSiVis__RestoreCheckpoint ) ;
+
+    SimulationCheckpointReader reader ;
+    if( ! reader.Open( filename ) )
+    {
+        printf( "InteSiVis::RestoreCheckpoint: %s is missing, or is not a checkpoint this build can read\n" , filename ) ;
+        return false ;
+    }
+    const SimulationCheckpointHeader & header = reader.GetHeader() ;
+
+    InitialConditions( header.mScenario ) ;
+
+    const size_t numGroups = mFluidParticleSystem->GetNumGroups() ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        const SimulationCheckpointSection * section = reader.FindSection( SIMULATION_CHECKPOINT_SECTION_PARTICLE_GROUP , static_cast< unsigned >( iGroup ) ) ;
+        if( section )
+        {   // Checkpoint has this group.
+            reader.CopyParticles( * section , mFluidParticleSystem->GetGroup( iGroup )->GetParticles() ) ;
+        }
+    }
+
+    const SimulationCheckpointSection * bodySection = reader.FindSection( SIMULATION_CHECKPOINT_SECTION_RIGID_BODIES ) ;
+    if( bodySection && ( bodySection->mNumElements == mPhysicalObjects.Size() ) )
+    {   // Checkpoint has a body for each physical object InitialConditions created.  Otherwise the scenario changed since checkpointing, so keep initial bodies.
+        const Impulsion::RigidBody * bodies = reinterpret_cast< const Impulsion::RigidBody * >( reader.GetSectionData( * bodySection ) ) ;
+        for( size_t iBody = 0 ; iBody < mPhysicalObjects.Size() ; ++ iBody )
+        {   // For each physical object...
+            * mPhysicalObjects[ iBody ]->GetBody() = bodies[ iBody ] ;
+        }
+    }
+
+    mFrame      = header.mFrame ;
+    mTimeNow    = header.mTimeNow ;
+
+    printf( "InteSiVis::RestoreCheckpoint: restored scenario %i frame %u from %s\n" , mScenario , mFrame , filename ) ;
+    return true ;
+}
+
+
+
+
+/** Replace vortons and tracers of the scenario InitialConditions is building, with those of the given initial state file.
+
+    \param filename         Name of file in the layout SimulationCheckpointHeader describes, for example
+                            authored by a tool outside this application, or a checkpoint SaveCheckpoint wrote.
+
+    \param importedTracers  (out) Whether the file had tracers, in which case the caller should not emit them.
+
+    This maps the file, then copies each particle array straight out of the
+    mapping into its particle group, in one pass per group.  It looks for
+    VORTONS and TRACERS sections, which suit any scenario, else for the
+    PARTICLE_GROUP sections at the indices of the vorton and tracer groups,
+    as a checkpoint of the same scenario has.  Everything else about the
+    scenario (operations, emitters, rigid bodies, camera) stays as
+    InitialConditions set it up.
+
+    VortonSim refers to the vorton group's particle array, which this
+    overwrites in place, so VortonSim sees imported vortons without being
+    told.
+
+    \return Whether the file existed and had vortons or tracers this build can read.
+*/
+bool InteSiVis::ImportInitialParticles( const char * filename , bool & importedTracers )
+{
+    PERF_BLOCK( InteSiVis__ImportInitialParticles ) ;
+
+    importedTracers = false ;
+
+    SimulationCheckpointReader reader ;
+    if( ! reader.Open( filename ) )
+    {   // No such file, or not one this build can read.  Usual case, for scenarios built purely procedurally.
+        return false ;
+    }
+
+    ParticleGroup * const               groups[ 2 ]     = { mVortonPclGrpInfo.mParticleGroup , mTracerPclGrpInfo.mParticleGroup } ;
+    const SimulationCheckpointSectionE  roles[ 2 ]      = { SIMULATION_CHECKPOINT_SECTION_VORTONS , SIMULATION_CHECKPOINT_SECTION_TRACERS } ;
+    bool                                imported[ 2 ]   = { false , false } ;
+
+    for( size_t iRole = 0 ; iRole < 2 ; ++ iRole )
+    {   // For vortons, then tracers...
+        const SimulationCheckpointSection * section = reader.FindSection( roles[ iRole ] ) ;
+        for( size_t iGroup = 0 ; ! section && ( iGroup < mFluidParticleSystem->GetNumGroups() ) ; ++ iGroup )
+        {   // For each fluid particle group, until finding a section...
+            if( mFluidParticleSystem->GetGroup( iGroup ) == groups[ iRole ] )
+            {   // This is the group for this role, so try a checkpoint section for its index.
+                section = reader.FindSection( SIMULATION_CHECKPOINT_SECTION_PARTICLE_GROUP , static_cast< unsigned >( iGroup ) ) ;
+            }
+        }
+        if( section )
+        {   // File has particles for this role.
+            imported[ iRole ] = reader.CopyParticles( * section , groups[ iRole ]->GetParticles() ) ;
+        }
+    }
+
+    importedTracers = imported[ 1 ] ;
+
+    printf( "InteSiVis::ImportInitialParticles: imported %u vortons and %u tracers from %s\n"
+        , imported[ 0 ] ? unsigned( groups[ 0 ]->GetNumParticles() ) : 0u
+        , imported[ 1 ] ? unsigned( groups[ 1 ]->GetNumParticles() ) : 0u
+        , filename ) ;
+    return imported[ 0 ] || imported[ 1 ] ;
+}
+
+
+
+
+/** Run the given scenario for the given number of frames, without rendering, and report how long each part took.
+
+    This runs on the calling thread, so only call it on an application constructed headless,
+    which has no simulation thread.
+
+    \param ic          Which initial conditions to run.  See InitialConditions.
+
+    \param numFrames   Number of frames to simulate, with a fixed time step.
+
+    \param treeOpeningCriterion    Rule by which treecodes open clusters.
+
+    \param velocityTechnique   Technique to obtain velocity from vorticity, or VELOCITY_FROM_VORTICITY_NUM to keep the current one.
+
+    \param numErrorSamples Number of gridpoints at which to compare treecode, and the velocity grid, against direct summation, during the final frame, or zero for none.
+
+    \param result      Timings, particle counts, and treecode and velocity grid error.
+
+    \param perfSamples Per-frame statistics of profiled blocks to sample into, in its current context, or NULL for none.
+
+    \param inputReplay Recording of input to apply while simulating, or NULL for none.
+                        Its scenario must be ic.  Each event applies after as many
+                        steps as preceded it when recorded, so it affects the
+                        simulation as it did interactively.  Recordings
+                        longer than numFrames get cut short.
+*/
+void InteSiVis::RunBenchmarkScenario( unsigned ic , unsigned numFrames , const VortonSim::TreeOpeningCriterion & treeOpeningCriterion , VortonSim::VelocityFromVorticityTechniqueE velocityTechnique , unsigned numErrorSamples , BenchmarkScenarioResult & result , PerfBaseline * perfSamples , const InputRecording * inputReplay )
+{
+    PERF_BLOCK( InteSiVis__RunBenchmarkScenario ) ;
+
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    ASSERT( NULL == mSimulationThread ) ;   // Simulation thread would race with this.
+#endif
+
+    InitialConditions( ic ) ;   // Also seeds the pseudo-random number generator, so each run is repeatable.
+    mTimeStepping = PLAY ;
+
+    VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    vortonSim.SetTreeOpeningCriterion( treeOpeningCriterion ) ;
+    const VortonSim::VelocityFromVorticityTechniqueE previousVelocityTechnique = vortonSim.GetVelocityFromVorticityTechnique() ;
+    if( velocityTechnique < VortonSim::VELOCITY_FROM_VORTICITY_NUM )
+    {
+        vortonSim.SetVelocityFromVorticityTechnique( velocityTechnique ) ;
+    }
+
+    result.mScenario                = ic ;
+    result.mNumThreads              = mParallelExecutor.GetNumThreads() ;
+    result.mNumFrames               = numFrames ;
+    result.mTreeOpeningCriterion    = treeOpeningCriterion ;
+
+    if( perfSamples )
+    {   // Exclude durations that blocks recorded before this scenario.
+        perfSamples->BeginSampling() ;
+    }
+
+    size_t iReplayEvent = 0 ;
+    if( inputReplay )
+    {   // Input recording began with no buttons held, as far as its events reveal.
+        ASSERT( inputReplay->GetScenario() == int( ic ) ) ;
+        mMouseButtons[0] = mMouseButtons[1] = mMouseButtons[2] = 0 ;
+        mModifierKeys = 0 ;
+    }
+
+    Timer timerTotal ;
+    Timer timerPart ;
+    timerTotal.StartTimer() ;
+    for( unsigned iFrame = 0 ; iFrame < numFrames ; ++ iFrame )
+    {   // For each frame to simulate...
+        if( inputReplay )
+        {   // Apply events that arrived after as many steps as have run.
+            while( ( iReplayEvent < inputReplay->GetNumEvents() ) && ( inputReplay->GetEvent( iReplayEvent ).mStep <= mNumStepsSimulated ) )
+            {   // For each event due...
+                DispatchInputEvent( inputReplay->GetEvent( iReplayEvent ) ) ;
+                ++ iReplayEvent ;
+            }
+        }
+
+        // Measure treecode error only during the final frame, so measuring barely skews timings.
+        vortonSim.SetNumTreecodeErrorSamples( ( iFrame + 1 == numFrames ) ? numErrorSamples : 0 ) ;
+
+        PerfCounterValues countersBegin ;
+        PerfCounters::ReadThisProcess( countersBegin ) ;
+        timerPart.StartTimer() ;
+        UpdateParticleSystems() ;
+        result.mSecondsParticleSystems += timerPart.GetElapsedTimeSeconds() ;
+        PerfCounterValues countersEnd ;
+        PerfCounters::ReadThisProcess( countersEnd ) ;
+        result.mCountersParticleSystems.AccumulateDifference( countersEnd , countersBegin ) ;
+        for( unsigned iStage = 0 ; iStage < VortonSim::NUM_UPDATE_STAGES ; ++ iStage )
+        {   // For each VortonSim update stage...
+            result.mSecondsUpdateStages[ iStage ] += vortonSim.GetUpdateStageDuration( VortonSim::UpdateStageE( iStage ) ) ;
+        }
+
+        timerPart.StartTimer() ;
+        UpdateRigidBodies() ;
+        result.mSecondsRigidBodies += timerPart.GetElapsedTimeSeconds() ;
+
+        result.mNumVortonsSum += double( vortonSim.GetVortons()->Size() ) ;
+        result.mNumTracersSum += double( mTracerPclGrpInfo.mParticleGroup->GetNumParticles() ) ;
+
+        ++ mFrame ;
+        mTimeNow += mTimeStep ;
+
+        if( perfSamples )
+        {
+            perfSamples->SampleFrame() ;
+        }
+    }
+    result.mSecondsTotal    = timerTotal.GetElapsedTimeSeconds() ;
+    result.mTreecodeError   = vortonSim.GetTreecodeErrorStatistics() ;
+    result.mVelocityTechnique = vortonSim.GetVelocityFromVorticityTechniqueInEffect() ;
+    if( numErrorSamples > 0 )
+    {
+        result.mVelocityGridError = vortonSim.GetVelocityGridError() ;
+    }
+    vortonSim.SetNumTreecodeErrorSamples( 0 ) ;
+    vortonSim.SetTreeOpeningCriterion( VortonSim::TreeOpeningCriterion() ) ;
+    vortonSim.SetVelocityFromVorticityTechnique( previousVelocityTechnique ) ;
+}
+
+
+
+
 /** Update particle systems.
 */
 void InteSiVis::UpdateParticleSystems()
@@ -1511,42 +1928,32 @@ void InteSiVis::UpdateParticleSystems()
 
     if( mTimeStepping == PLAY || mTimeStepping == SINGLE_STEP )
     {
-        #if USE_SMOOTHED_PARTICLE_HYDRODYNAMICS
-        if(     ( VortonSim::FLUID_SIM_SMOOTHED_PARTICLE_HYDRODYNAMICS == mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
-            ||  ( VortonSim::FLUID_SIM_VPM_SPH_HYBRID                  == mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
-            //||  ( VortonSim::FLUID_SIM_VORTEX_PARTICLE_METHOD          == mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
-            )
-        {
-            // Set up particle operation to re-populate velocity grid from SPH particles, to take into account SPH particle velocity after satisfying boundary conditions.
-            // This is meant to keep tracers from heading where they should not.
-            // In principle this should also occur for VPM, but it's only implemented for SPH, because of the problems created by not assigning densities, which the comments below describe.
-            ASSERT( mVortonPclGrpInfo.mPclOpPopulateVelocityGrid ) ;
-            mVortonPclGrpInfo.mPclOpPopulateVelocityGrid->mVelocityGrid = & mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVelocityGrid() ;
-
-            // In SPH mode, the density grid isn't updated, so has invalid bounds, which would make AssignScalarFromGrid fail.
-            // Clear density grids to avoid that problem.
-            // Note that in this mode, because density grid is not populated, tracers do not get their densities updated from vortons.
-            // That has 2 effects: linear impulses are different, and rendering is different.
-            const_cast< UniformGrid< float > & >( mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetDensityGrid() ) .Clear() ;
+        ++ mNumStepsSimulated ; // Input that arrives after this step gets stamped with this count.  See InputRecording.
 
-        #if ENABLE_FIRE
-            const_cast< UniformGrid< float > & >( mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFuelGrid() ).Clear() ;
-            const_cast< UniformGrid< float > & >( mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFlameGrid() ).Clear() ;
-            const_cast< UniformGrid< float > & >( mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetSmokeGrid() ).Clear() ;
-        #endif
+        PrepareFluidParticleSystemUpdate( mVortonPclGrpInfo ) ;
+
+    #if ENABLE_VORTON_LOD
+        {   // Keep full vorton detail nearer the eye than half the distance to what it looks at.
+            const float viewDistance = ( mQdCamera.GetTarget() - mQdCamera.GetEye() ).Magnitude() ;
+            mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.SetLodFocus( mQdCamera.GetEye() , 0.5f * viewDistance ) ;
         }
-        else
-        #endif
-        {
-            ASSERT( VortonSim::FLUID_SIM_VORTEX_PARTICLE_METHOD == mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() ) ;
-            if( mVortonPclGrpInfo.mPclOpPopulateVelocityGrid )
-            {
-                mVortonPclGrpInfo.mPclOpPopulateVelocityGrid->mVelocityGrid = 0 ;
-            }
+    #endif
+
+        {   // Emit tracers, which only affect appearance, in proportion to how much of the screen their emitters cover.
+            // Vorton emitters ignore the view, so the simulation does not depend on it.
+            mTracerPclGrpInfo.mPclOpEmit->mLod.SetView( mQdCamera.GetEye() , mQdCamera.GetTarget() , mQdCamera.GetFieldOfViewVertical() , mQdCamera.GetAspectRatio() ) ;
+            mTracerPclGrpInfo.mPclOpSeedSurfaceTracers->mLod.SetView( mQdCamera.GetEye() , mQdCamera.GetTarget() , mQdCamera.GetFieldOfViewVertical() , mQdCamera.GetAspectRatio() ) ;
         }
 
         mPclSysMgr.Update( mTimeStep , mFrame ) ;
 
+    #if INTE_SI_VIS_GPU_TRACERS
+        if( mTracerPclGrpInfo.mPclOpAssignVelocityFromField->mVelocityGrid )
+        {   // Advect tracers that live on the GPU, the same way the tracer particle group advects tracers that live on the CPU.
+            mTracerAdvectionGpu.Advect( * mTracerPclGrpInfo.mPclOpAssignVelocityFromField->mVelocityGrid , mTracerPclGrpInfo.mPclOpAssignVelocityFromField->mGridWeight , mTimeStep ) ;
+        }
+    #endif
+
         #if 0 && USE_SMOOTHED_PARTICLE_HYDRODYNAMICS // Silly VPM-SPH hybrid: Alternate between VPM and SPH.  This yields about the same results as running SPH after VPM each frame.
         if( VortonSim::FLUID_SIM_SMOOTHED_PARTICLE_HYDRODYNAMICS == mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetFluidSimulationTechnique() )
         {   // Previous fluid simulation update used SPH.
@@ -1575,6 +1982,108 @@ void InteSiVis::UpdateParticleSystems()
 
 
 
+#if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+/** Hand the frame that just got simulated to the frame sequence exporter.
+
+    This copies particles and grids, but does not wait for them to get written.
+*/
+void InteSiVis::ExportFrame()
+{
+    PERF_BLOCK( InteSiVis__ExportFrame ) ;
+
+    if( ( mTimeStepping == PLAY || mTimeStepping == SINGLE_STEP ) && mFluidParticleSystem )
+    {   // Simulation advanced.
+        const VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+        mFrameSequenceWriter.SubmitFrame( * mFluidParticleSystem , & vortonSim.GetVelocityGrid() , & vortonSim.GetDensityGrid() , mFrame , mTimeNow ) ;
+    }
+}
+#endif
+
+
+
+
+#if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE
+/** Reconstruct particles and grids at the current virtual time, from the recording, in place of simulating.
+
+    This writes recorded tracers and vortons into the fluid particle system,
+    and recorded grids into VortonSim, where renderers read them.
+*/
+void InteSiVis::PlaybackFrame()
+{
+    PERF_BLOCK( InteSiVis__PlaybackFrame ) ;
+
+    if( mFluidParticleSystem )
+    {
+        VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+        mFrameSequenceReader.Sample( mTimeNow , * mFluidParticleSystem , & vortonSim.GetVelocityGrid() , & vortonSim.GetDensityGrid() ) ;
+    }
+}
+
+
+
+
+/** Jump playback to the given recorded frame, clamped to the recording.
+*/
+void InteSiVis::SeekPlayback( size_t frameIndex )
+{
+    if( mFrameSequenceReader.GetNumFrames() > 0 )
+    {
+        const FrameSequenceIndexEntry & entry = mFrameSequenceReader.GetIndexEntry( Min2( frameIndex , mFrameSequenceReader.GetNumFrames() - 1 ) ) ;
+        mFrame      = entry.mFrame ;
+        mTimeNow    = entry.mTimeNow ;
+    }
+}
+#endif
+
+
+
+
+#if INTE_SI_VIS_REMOTE_VIEW_PORT && ! INTE_SI_VIS_REMOTE_VIEWER
+/** Hand the frame that just got simulated to the remote view streamer.
+
+    This quantizes and encodes particles, but does not wait for them to get sent.
+*/
+void InteSiVis::StreamFrame()
+{
+    PERF_BLOCK( InteSiVis__StreamFrame ) ;
+
+    if( ( mTimeStepping == PLAY || mTimeStepping == SINGLE_STEP ) && mFluidParticleSystem )
+    {   // Simulation advanced.
+        const VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+        mRemoteViewServer.SubmitFrame( * mFluidParticleSystem , vortonSim.GetVelocityGrid() , mFrame , mTimeNow ) ;
+    }
+}
+#endif
+
+
+
+
+#if INTE_SI_VIS_CAPTURE_FRAMES
+/** Start reading back the frame that just got rendered, and hand older frames that finished reading back to the frame recorder.
+
+    Call this after rendering, before swapping buffers.  This never waits
+    for the GPU; each frame arrives a few calls after its request.
+*/
+void InteSiVis::CaptureFrame()
+{
+    PERF_BLOCK( InteSiVis__CaptureFrame ) ;
+
+    unsigned frameIndex = 0 ;
+    while( mFrameReadback.Collect( mCapturedFrame , frameIndex ) )
+    {   // For each frame that finished reading back...
+        mFrameCaptureWriter.SubmitFrame( mCapturedFrame , frameIndex ) ;
+    }
+
+    if( ( mTimeStepping == PLAY || mTimeStepping == SINGLE_STEP ) && mFrameCaptureWriter.IsOpen() )
+    {   // Simulation advanced, so this frame differs from the previous.
+        // If every pixel buffer still awaits the GPU, this drops the frame rather than stall.
+        mFrameReadback.Request( 0 , 0 , glutGet( GLUT_WINDOW_WIDTH ) , glutGet( GLUT_WINDOW_HEIGHT ) , mFrame ) ;
+    }
+}
+#endif
+
+
+
 /** Update rigid bodies.
 */
 void InteSiVis::UpdateRigidBodies()
@@ -1623,6 +2132,9 @@ void InteSiVis::UpdateRigidBodies()
                 rigidBody->SetPosition( position ) ;
             }
         }
+#if USE_RIGID_BODY_CONTACTS
+        mContactSolver.Solve( GetPhysicalObjects() , mTimeStep ) ;
+#endif
         PhysicalObject_UpdateSystem( GetPhysicalObjects() , mTimeStep , mFrame ) ;
     }
 }
@@ -1678,7 +2190,17 @@ void InteSiVis::UpdateRigidBodyModelsFromPhysics()
     for( size_t idxEntity = 0 ; idxEntity < numEntities ; ++ idxEntity )
     {
         Entity & entity = mEntities[ idxEntity ] ;
+    #if INTE_SI_VIS_PIPELINE_FRAMES
+        // Take pose from snapshot, since simulation thread might be moving the physical object right now.
+        Vec3    position    ;
+        Mat33   orientation ;
+        if( mRenderSnapshot && mRenderSnapshot->FindBody( entity.mPhysicalObject , position , orientation ) )
+        {   // Snapshot has a pose for this entity.
+            entity.Update( position , orientation ) ;
+        }
+    #else
         entity.Update() ;
+    #endif
         //entity.mRenderModel->Render( & mQdLights , static_cast< float >( mTimeNow ) ) ; OBSOLETE QdRender
     }
 }
@@ -1686,34 +2208,361 @@ void InteSiVis::UpdateRigidBodyModelsFromPhysics()
 
 
 
-/** Gather and record performance profile data.
+#if INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_FIXED_TIMESTEP
+
+/** Give render-side particle system as many groups as the fluid particle system has.
+
+    Render-side groups have no operations; they only hold particles copied
+    from snapshots, or interpolated from the fluid particle system.  The
+    fluid scene binds to these groups once, so they persist across scenarios.
 */
-void InteSiVis::GatherAndRecordProfileData()
+void InteSiVis::MatchRenderParticleSystemToFluidParticleSystem()
 {
-    PERF_BLOCK( InteSiVis__GatherAndRecordProfileData ) ;
+    PERF_BLOCK( InteSiVis__MatchRenderParticleSystemToFluidParticleSystem ) ;
 
-#if defined( PROFILE )
-    VortonSim & rVortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+    ASSERT( mFluidParticleSystem ) ;
 
-    if( mFrame >= sFrameCountMax )
-    {   // Reached maximum number of frames, so exit.
-        printf( "InteSiVis Ran %i frames\n" , mFrame ) ;
-        printf( "region: { %g , %g , %g } , { %g , %g , %g } \n"
-            , rVortonSim.GetMinCornerEternal().x
-            , rVortonSim.GetMinCornerEternal().y
-            , rVortonSim.GetMinCornerEternal().z
-            , rVortonSim.GetMaxCornerEternal().x
-            , rVortonSim.GetMaxCornerEternal().y
-            , rVortonSim.GetMaxCornerEternal().z
-            ) ;
-        const float tracersPerFrame = (float) sNumTracersSum / (float) ( mFrame - 1 ) ;
-        const float vortonsPerFrame = (float) sNumVortonsSum / (float) ( mFrame - 1 ) ;
-        printf( "Particles, average per frame: %g tracers    %g vortons\n" , tracersPerFrame , vortonsPerFrame ) ;
+    while( mRenderParticleSystem.GetNumGroups() < mFluidParticleSystem->GetNumGroups() )
+    {   // Render-side system lacks groups.
+        mRenderParticleSystem.PushBack( new ParticleGroup ) ;
+    }
+}
 
-        const float tracerHitsPerFrame = (float) FluidBodySim::GetNumTracerBodyHits() / (float) ( mFrame - 1 ) ;
-        const float vortonHitsPerFrame = (float) FluidBodySim::GetNumVortonBodyHits() / (float) ( mFrame - 1 ) ;
-        printf( "Particles-body hits, average per frame: %g tracers    %g vortons\n" , tracerHitsPerFrame , vortonHitsPerFrame ) ;
-        printf( "InteSiVis benchmark DONE: build " __DATE__ " " __TIME__ "\n\n" ) ;
+#endif
+
+
+
+
+#if INTE_SI_VIS_PIPELINE_FRAMES
+
+/** Make the given snapshot the one that rendering reads, and return the previous one to the queue.
+
+    This swaps particles into render-side groups instead of copying them, so
+    the snapshot keeps the previous particle arrays, whose storage the next
+    capture reuses.
+*/
+void InteSiVis::AdoptFrameSnapshot( FrameSnapshot * snapshot )
+{
+    PERF_BLOCK( InteSiVis__AdoptFrameSnapshot ) ;
+
+    ASSERT( snapshot ) ;
+
+    const size_t numGroups = Min2( mRenderParticleSystem.GetNumGroups() , snapshot->mParticlesPerGroup.Size() ) ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        std::swap( mRenderParticleSystem.GetGroup( iGroup )->GetParticles() , snapshot->mParticlesPerGroup[ iGroup ] ) ;
+    }
+
+    DiscardFrameSnapshot() ;
+    mRenderSnapshot = snapshot ;
+}
+
+
+
+
+/** Return snapshot that rendering reads, if any, to the queue.
+*/
+void InteSiVis::DiscardFrameSnapshot()
+{
+    if( mRenderSnapshot )
+    {   // Main thread holds a snapshot.
+        mFrameSnapshots.Release( mRenderSnapshot ) ;
+        mRenderSnapshot = NULLPTR ;
+    }
+}
+
+
+
+
+/** Start thread that runs simulation steps while the main thread renders.
+*/
+void InteSiVis::StartSimulationThread()
+{
+    PERF_BLOCK( InteSiVis__StartSimulationThread ) ;
+
+    ASSERT( NULL == mSimulationThread ) ;
+
+    // Simulation code expects the floating point modes the main thread set up.
+    mMainThreadFloatingPointControlWord = GetFloatingPointControlWord() ;
+    mMainThreadMmxControlStatusRegister = GetMmxControlStatusRegister() ;
+
+    mSimulationThreadQuit    = false ;
+    mSimulationStepRequested = CreateEvent( NULL , FALSE , FALSE , NULL ) ;
+    mSimulationThread        = CreateThread( NULL , 0 , SimulationThreadMain , this , 0 , NULL ) ;
+    ASSERT( mSimulationStepRequested && mSimulationThread ) ;
+}
+
+
+
+
+/** Stop thread that runs simulation steps.
+
+    This must not get called while a simulation step runs.
+*/
+void InteSiVis::StopSimulationThread()
+{
+    PERF_BLOCK( InteSiVis__StopSimulationThread ) ;
+
+    if( mSimulationThread )
+    {   // Simulation thread exists.
+        mSimulationThreadQuit = true ;
+        SetEvent( mSimulationStepRequested ) ;
+        WaitForSingleObject( mSimulationThread , INFINITE ) ;
+        CloseHandle( mSimulationThread ) ;
+        CloseHandle( mSimulationStepRequested ) ;
+        mSimulationThread        = NULL ;
+        mSimulationStepRequested = NULL ;
+    }
+    DiscardFrameSnapshot() ;
+}
+
+
+
+
+/** Run simulation steps on request, publishing a snapshot after each.
+
+    \param context  Address of the InteSiVis instance.
+*/
+/* static */ DWORD WINAPI InteSiVis::SimulationThreadMain( LPVOID context )
+{
+    InteSiVis * inteSiVis = reinterpret_cast< InteSiVis * >( context ) ;
+
+    SetFloatingPointControlWord( inteSiVis->mMainThreadFloatingPointControlWord ) ;
+    SetMmxControlStatusRegister( inteSiVis->mMainThreadMmxControlStatusRegister ) ;
+
+    for( ;; )
+    {   // For each simulation step...
+        WaitForSingleObject( inteSiVis->mSimulationStepRequested , INFINITE ) ;
+        if( inteSiVis->mSimulationThreadQuit )
+        {   // Main thread wants this thread to exit.
+            break ;
+        }
+
+        inteSiVis->UpdateParticleSystems() ;
+        inteSiVis->UpdateRigidBodies() ;
+    #if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+        inteSiVis->ExportFrame() ;
+    #endif
+    #if INTE_SI_VIS_REMOTE_VIEW_PORT
+        inteSiVis->StreamFrame() ;
+    #endif
+
+        FrameSnapshot * snapshot = inteSiVis->mFrameSnapshots.AcquireForWriting() ;
+        snapshot->Capture( * inteSiVis->mFluidParticleSystem , inteSiVis->mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim , inteSiVis->mPhysicalObjects , inteSiVis->mFrame , inteSiVis->mTimeNow ) ;
+        inteSiVis->mFrameSnapshots.Publish( snapshot ) ;
+    }
+
+    return 0 ;
+}
+
+#endif
+
+
+
+
+#if INTE_SI_VIS_FIXED_TIMESTEP
+
+/** Run as many simulation steps as the real time of the most recent frame covers, within the scheduler budget.
+
+    \param realFrameDuration    Real time the most recent frame took, or zero unless playing forward.
+
+    Playing forward runs zero or more steps of mTimeStep, as mSimStepScheduler
+    decides.  Pausing, single-stepping and stepping backward do not follow
+    real time, so they run one step, as without scheduling.
+*/
+void InteSiVis::RunScheduledSimulationSteps( float realFrameDuration )
+{
+    PERF_BLOCK( InteSiVis__RunScheduledSimulationSteps ) ;
+
+    if( ( PLAY != mTimeStepping ) || ( mTimeStep <= 0.0f ) )
+    {   // Simulation is not playing forward, so clock does not follow real time.
+        mSimStepScheduler.Reset() ;
+        SimulateStep() ;
+        return ;
+    }
+
+    LARGE_INTEGER   qwTicksPerSec ;
+    QueryPerformanceFrequency( & qwTicksPerSec ) ;
+    const float     secondsPerTick = 1.0f / float( qwTicksPerSec.QuadPart ) ;
+    LARGE_INTEGER   stepsBegin ;
+    QueryPerformanceCounter( & stepsBegin ) ;
+
+    mSimStepScheduler.SetStepDuration( mTimeStep ) ;
+    mSimStepScheduler.Accumulate( realFrameDuration ) ;
+
+    float secondsSpentStepping = 0.0f ;
+    while( mSimStepScheduler.ShouldStep( secondsSpentStepping ) )
+    {   // For each step real time owes...
+        SimulateStep() ;
+
+        LARGE_INTEGER systemTimeNow ;
+        QueryPerformanceCounter( & systemTimeNow ) ;
+        secondsSpentStepping = secondsPerTick * static_cast< float >( systemTimeNow.QuadPart - stepsBegin.QuadPart ) ;
+    }
+}
+
+
+
+
+/** Run one simulation step, including everything that happens once per step, and advance the clock.
+*/
+void InteSiVis::SimulateStep()
+{
+    PERF_BLOCK( InteSiVis__SimulateStep ) ;
+
+    RecordPreviousParticlePositions() ;
+
+    UpdateParticleSystems() ;
+    UpdateRigidBodies() ;
+
+#if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+    ExportFrame() ;
+#endif
+#if INTE_SI_VIS_REMOTE_VIEW_PORT && ! INTE_SI_VIS_REMOTE_VIEWER
+    StreamFrame() ;
+#endif
+
+    AdvanceClock() ;
+}
+
+
+
+
+/** Remember position of each fluid particle, by identifier, so rendering can interpolate from it after the next step.
+
+    Identifiers are those of the Sync at the end of the previous step, which
+    still name these particles, since nothing moves particles between steps.
+*/
+void InteSiVis::RecordPreviousParticlePositions()
+{
+    PERF_BLOCK( InteSiVis__RecordPreviousParticlePositions ) ;
+
+    if( ! mFluidParticleSystem )
+    {   // No fluid to record.
+        return ;
+    }
+
+    const size_t numGroups = mFluidParticleSystem->GetNumGroups() ;
+    mPreviousPositionsPerGroup.Resize( numGroups ) ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each fluid particle group...
+        const ParticleGroup &       group               = * mFluidParticleSystem->GetGroup( iGroup ) ;
+        const VECTOR< Particle > &  particles           = group.GetParticles() ;
+        VECTOR< Vec3 > &            previousPositions   = mPreviousPositionsPerGroup[ iGroup ] ;
+        previousPositions.Resize( group.GetIdMap().GetIdCapacity() ) ;
+        const size_t numParticles = particles.Size() ;
+        for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+        {   // For each particle...
+            const unsigned id = particles[ iPcl ].mId ;
+            if( id < previousPositions.Size() )
+            {   // Particle has an identifier the map assigned.
+                previousPositions[ id ] = particles[ iPcl ].mPosition ;
+            }
+        }
+    }
+}
+
+
+
+
+/** Copy fluid particles into render-side groups, with positions blended from before the most recent step toward after it.
+
+    \param fraction Fraction of the way from previous to current position, where 1 shows current state as is.
+
+    Particles that the most recent step emitted, or whose identifier
+    recycles one of a dead particle, have no previous position, so this
+    shows them where they are.
+*/
+void InteSiVis::InterpolateRenderParticles( float fraction )
+{
+    PERF_BLOCK( InteSiVis__InterpolateRenderParticles ) ;
+
+    if( ! mFluidParticleSystem )
+    {   // No fluid to render.
+        return ;
+    }
+
+    MatchRenderParticleSystemToFluidParticleSystem() ;
+
+    const size_t numGroups = mFluidParticleSystem->GetNumGroups() ;
+    mPreviousPositionsPerGroup.Resize( numGroups ) ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each fluid particle group...
+        const ParticleGroup &       group               = * mFluidParticleSystem->GetGroup( iGroup ) ;
+        const ParticleIdMap &       idMap               = group.GetIdMap() ;
+        const VECTOR< Particle > &  particles           = group.GetParticles() ;
+        VECTOR< Particle > &        renderParticles     = mRenderParticleSystem.GetGroup( iGroup )->GetParticles() ;
+        VECTOR< Vec3 > &            previousPositions   = mPreviousPositionsPerGroup[ iGroup ] ;
+
+        renderParticles = particles ; // Reuses storage once particle counts settle.
+
+        if( fraction >= 1.0f )
+        {   // Show current state as is.
+            continue ;
+        }
+
+        previousPositions.Resize( idMap.GetIdCapacity() ) ;
+        const VECTOR< unsigned > & born = idMap.GetBorn() ;
+        for( size_t iBorn = 0 ; iBorn < born.Size() ; ++ iBorn )
+        {   // For each particle that arrived during the most recent step...
+            const size_t slot = idMap.GetSlot( born[ iBorn ] ) ;
+            if( slot < particles.Size() )
+            {   // Particle still occupies the slot Sync recorded, so it has not moved since.
+                previousPositions[ born[ iBorn ] ] = particles[ slot ].mPosition ;
+            }
+        }
+
+        const size_t numParticles = renderParticles.Size() ;
+        for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+        {   // For each particle...
+            Particle &      pcl = renderParticles[ iPcl ] ;
+            const unsigned  id  = pcl.mId ;
+            if( ( id != ParticleIdMap::INVALID_ID ) && ( id < previousPositions.Size() ) )
+            {   // Particle has a previous position.
+                pcl.mPosition = previousPositions[ id ] + fraction * ( pcl.mPosition - previousPositions[ id ] ) ;
+            }
+        }
+    }
+
+    for( size_t iGroup = numGroups ; iGroup < mRenderParticleSystem.GetNumGroups() ; ++ iGroup )
+    {   // For each render-side group without a fluid counterpart, e.g. left over from a scenario with more groups...
+        mRenderParticleSystem.GetGroup( iGroup )->GetParticles().Clear() ;
+    }
+}
+
+#endif
+
+
+
+
+/** Gather and record performance profile data.
+*/
+void InteSiVis::GatherAndRecordProfileData()
+{
+    PERF_BLOCK( InteSiVis__GatherAndRecordProfileData ) ;
+
+#if defined( PROFILE )
+    VortonSim & rVortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+
+    if( mFrame >= sFrameCountMax )
+    {   // Reached maximum number of frames, so exit.
+        printf( "InteSiVis Ran %i frames\n" , mFrame ) ;
+        printf( "region: { %g , %g , %g } , { %g , %g , %g } \n"
+            , rVortonSim.GetMinCornerEternal().x
+            , rVortonSim.GetMinCornerEternal().y
+            , rVortonSim.GetMinCornerEternal().z
+            , rVortonSim.GetMaxCornerEternal().x
+            , rVortonSim.GetMaxCornerEternal().y
+            , rVortonSim.GetMaxCornerEternal().z
+            ) ;
+        const float tracersPerFrame = (float) sNumTracersSum / (float) ( mFrame - 1 ) ;
+        const float vortonsPerFrame = (float) sNumVortonsSum / (float) ( mFrame - 1 ) ;
+        printf( "Particles, average per frame: %g tracers    %g vortons\n" , tracersPerFrame , vortonsPerFrame ) ;
+
+        const float tracerHitsPerFrame = (float) FluidBodySim::GetNumTracerBodyHits() / (float) ( mFrame - 1 ) ;
+        const float vortonHitsPerFrame = (float) FluidBodySim::GetNumVortonBodyHits() / (float) ( mFrame - 1 ) ;
+        printf( "Particles-body hits, average per frame: %g tracers    %g vortons\n" , tracerHitsPerFrame , vortonHitsPerFrame ) ;
+        printf( "InteSiVis benchmark DONE: build " __DATE__ " " __TIME__ "\n\n" ) ;
 
         exit( 0 ) ;
     }
@@ -1723,6 +2572,95 @@ void InteSiVis::GatherAndRecordProfileData()
 
 
 
+/** Register metrics PublishTelemetry publishes, and start serving them.
+
+    Metrics that share a name register consecutively, as Telemetry requires.
+*/
+void InteSiVis::RegisterTelemetry()
+{
+    mTelemetryFrames    = mTelemetry.Register( Telemetry::KIND_COUNTER , "fluid_frames_total"   , "Number of frames simulated." ) ;
+    mTelemetryFrameMs   = mTelemetry.Register( Telemetry::KIND_GAUGE   , "fluid_frame_ms"       , "Average wall-clock duration of a frame, in milliseconds." ) ;
+    mTelemetryVortons   = mTelemetry.Register( Telemetry::KIND_GAUGE   , "fluid_vortons"        , "Number of vortons." ) ;
+    mTelemetryTracers   = mTelemetry.Register( Telemetry::KIND_GAUGE   , "fluid_tracers"        , "Number of tracers." ) ;
+
+    for( int stage = 0 ; stage < VortonSim::NUM_UPDATE_STAGES ; ++ stage )
+    {   // For each vorton simulation stage...
+        const char * stageName = VortonSim::GetUpdateStageName( VortonSim::UpdateStageE( stage ) ) ;
+        mTelemetryStageMs[ stage ] = mTelemetry.Register( Telemetry::KIND_GAUGE , "fluid_update_stage_ms" , "Wall-clock duration of a vorton simulation stage during the most recent update, in milliseconds." , "stage" , stageName ) ;
+    }
+
+    static const char * sGridNames[ NUM_TELEMETRY_GRIDS ] = { "velocity" , "density" , "density_gradient" , "signed_distance" } ;
+    for( int grid = 0 ; grid < NUM_TELEMETRY_GRIDS ; ++ grid )
+    {   // For each grid telemetry reports...
+        mTelemetryGridBytes[ grid ] = mTelemetry.Register( Telemetry::KIND_GAUGE , "fluid_grid_bytes" , "Memory a simulation grid uses for its values, in bytes." , "grid" , sGridNames[ grid ] ) ;
+    }
+
+    for( int subsystem = 0 ; subsystem < MemoryBudget::NUM_SUBSYSTEMS ; ++ subsystem )
+    {   // For each subsystem whose memory the budget accounts for...
+        const char * subsystemName = MemoryBudget::GetSubsystemName( MemoryBudget::SubsystemE( subsystem ) ) ;
+        mTelemetryMemoryBytes[ subsystem ] = mTelemetry.Register( Telemetry::KIND_GAUGE , "fluid_memory_bytes" , "Memory a subsystem occupies, including memory retained for reuse, in bytes." , "subsystem" , subsystemName ) ;
+    }
+    for( int subsystem = 0 ; subsystem < MemoryBudget::NUM_SUBSYSTEMS ; ++ subsystem )
+    {   // For each subsystem whose memory the budget accounts for...
+        const char * subsystemName = MemoryBudget::GetSubsystemName( MemoryBudget::SubsystemE( subsystem ) ) ;
+        mTelemetryMemoryCapBytes[ subsystem ] = mTelemetry.Register( Telemetry::KIND_GAUGE , "fluid_memory_cap_bytes" , "Memory above which a subsystem lowers quality, in bytes.  Zero means unlimited." , "subsystem" , subsystemName ) ;
+    }
+
+#if PROFILE
+    mTelemetryVortonBodyHits = mTelemetry.Register( Telemetry::KIND_COUNTER , "fluid_body_hits_total" , "Number of particle collisions with rigid bodies." , "particle" , "vorton" ) ;
+    mTelemetryTracerBodyHits = mTelemetry.Register( Telemetry::KIND_COUNTER , "fluid_body_hits_total" , "Number of particle collisions with rigid bodies." , "particle" , "tracer" ) ;
+#endif
+
+#if INTE_SI_VIS_TELEMETRY_PORT
+    if( ! mTelemetry.StartServer( INTE_SI_VIS_TELEMETRY_PORT ) )
+    {
+        fprintf( stderr , "InteSiVis: cannot serve telemetry on port %u\n" , unsigned( INTE_SI_VIS_TELEMETRY_PORT ) ) ;
+    }
+#endif
+}
+
+
+
+
+/** Publish metrics of the most recent frame into telemetry.
+
+    This only stores a few dozen values, so runs every frame.
+*/
+void InteSiVis::PublishTelemetry()
+{
+    const VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+
+    mTelemetry.SetCounter( mTelemetryFrames , mFrame ) ;
+    mTelemetry.SetGauge( mTelemetryFrameMs , 1000.0f * mFrameDurSecAvg ) ;
+    mTelemetry.SetGauge( mTelemetryVortons , float( vortonSim.GetVortons()->Size() ) ) ;
+    mTelemetry.SetGauge( mTelemetryTracers , float( mTracerPclGrpInfo.mParticleGroup->GetNumParticles() ) ) ;
+
+    for( int stage = 0 ; stage < VortonSim::NUM_UPDATE_STAGES ; ++ stage )
+    {   // For each vorton simulation stage...
+        mTelemetry.SetGauge( mTelemetryStageMs[ stage ] , 1000.0f * vortonSim.GetUpdateStageDuration( VortonSim::UpdateStageE( stage ) ) ) ;
+    }
+
+    mTelemetry.SetGauge( mTelemetryGridBytes[ TELEMETRY_GRID_VELOCITY         ] , float( vortonSim.GetVelocityGrid().Size()           * sizeof( Vec3  ) ) ) ;
+    mTelemetry.SetGauge( mTelemetryGridBytes[ TELEMETRY_GRID_DENSITY          ] , float( vortonSim.GetDensityGrid().Size()            * sizeof( float ) ) ) ;
+    mTelemetry.SetGauge( mTelemetryGridBytes[ TELEMETRY_GRID_DENSITY_GRADIENT ] , float( vortonSim.GetDensityGradientGrid().Size()    * sizeof( Vec3  ) ) ) ;
+    mTelemetry.SetGauge( mTelemetryGridBytes[ TELEMETRY_GRID_SIGNED_DISTANCE  ] , float( vortonSim.GetSignedDistanceGrid().Size()     * sizeof( float ) ) ) ;
+
+    ReportFluidMemoryUsage( mMemoryBudget , mVortonPclGrpInfo , mTracerPclGrpInfo ) ;
+    for( int subsystem = 0 ; subsystem < MemoryBudget::NUM_SUBSYSTEMS ; ++ subsystem )
+    {   // For each subsystem whose memory the budget accounts for...
+        mTelemetry.SetGauge( mTelemetryMemoryBytes[ subsystem ]     , float( mMemoryBudget.GetUsage( MemoryBudget::SubsystemE( subsystem ) ) ) ) ;
+        mTelemetry.SetGauge( mTelemetryMemoryCapBytes[ subsystem ]  , float( mMemoryBudget.GetCap( MemoryBudget::SubsystemE( subsystem ) ) ) ) ;
+    }
+
+#if PROFILE
+    mTelemetry.SetCounter( mTelemetryVortonBodyHits , FluidBodySim::GetNumVortonBodyHits() ) ;
+    mTelemetry.SetCounter( mTelemetryTracerBodyHits , FluidBodySim::GetNumTracerBodyHits() ) ;
+#endif
+}
+
+
+
+
 /** Function that GLUT calls when window resizes.
 */
 /* static */ void InteSiVis::GlutReshapeGlutCallback(int width, int height)
@@ -1757,6 +2695,97 @@ void InteSiVis::CopyCameraFromQdToPeGaSys()
 
 
 
+/** Extract fluid isosurface from the given signed distance grid, on the GPU if INTE_SI_VIS_GPU_ISOSURFACE and the driver allow, else on the CPU into FluidScene.
+
+    \param densityGradientGrid  Density gradient grid the simulation already computed, from which CPU extraction takes vertex normals, or NULL to difference signed distances.
+*/
+void InteSiVis::UpdateFluidIsosurface( const UniformGrid< float > & signedDistanceGrid , const UniformGrid< Vec3 > * densityGradientGrid )
+{
+    PERF_BLOCK( InteSiVis__UpdateFluidIsosurface ) ;
+
+#if INTE_SI_VIS_GPU_ISOSURFACE
+    if( mIsosurfaceExtractorGpu.IsValid() )
+    {   // Extract on the GPU, so FluidScene keeps its empty placeholder isosurface.
+        mIsosurfaceExtractorGpu.Extract( signedDistanceGrid , 0.0f ) ;
+        return ;
+    }
+#endif
+    // Density increases toward the fluid interior, where signed distance is negative, so its gradient points inward.
+    mFluidScene.UpdateFluidIsosurface( signedDistanceGrid , densityGradientGrid , true ) ;
+}
+
+
+
+
+#if INTE_SI_VIS_VOLUME_RENDER
+/** Switch tracer rendering to the volume rendering style that draws the same quantities, if volume rendering works.
+
+    Scenarios choose tracer rendering styles, so this runs after they do, and
+    again once rendering initializes, since only then can volume rendering
+    know whether the driver supports it.
+*/
+void InteSiVis::PreferVolumeRendering()
+{
+    if( ! mVolumeRendererGpu.IsValid() )
+    {   // Volume rendering does not work, so keep drawing tracers.
+        return ;
+    }
+
+    switch( mFluidScene.GetTracerRenderingStyle() )
+    {
+    case FluidScene::TRACER_RENDER_FLAME:
+    case FluidScene::TRACER_RENDER_SMOKE:
+    case FluidScene::TRACER_RENDER_FIRE :
+        mFluidScene.SetTracerRenderingStyle( FluidScene::TRACER_RENDER_VOLUME_FIRE ) ;
+        break ;
+    case FluidScene::TRACER_RENDER_DYE  :
+        mFluidScene.SetTracerRenderingStyle( FluidScene::TRACER_RENDER_VOLUME_DYE ) ;
+        break ;
+    default:
+        break ;
+    }
+}
+
+
+
+
+/** Upload flame, smoke and density grids, and ray-march them, if the tracer rendering style says to.
+
+    This draws after the opaque scene, so rays stop at rigid bodies and the fluid isosurface.
+*/
+void InteSiVis::RenderFluidVolume()
+{
+    PERF_BLOCK( InteSiVis__RenderFluidVolume ) ;
+
+    unsigned channels = 0 ;
+    switch( mFluidScene.GetTracerRenderingStyle() )
+    {
+    case FluidScene::TRACER_RENDER_VOLUME_FIRE: channels = VolumeRendererGpu::CHANNEL_FLAME | VolumeRendererGpu::CHANNEL_SMOKE ; break ;
+    case FluidScene::TRACER_RENDER_VOLUME_DYE : channels = VolumeRendererGpu::CHANNEL_DENSITY ; break ;
+    default: return ;
+    }
+
+    const VortonSim & vortonSim = mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
+#if VORTON_SIM_GRID_DYE
+    if( ( FluidScene::TRACER_RENDER_VOLUME_DYE == mFluidScene.GetTracerRenderingStyle() ) && vortonSim.GetGridDye().IsActive() )
+    {   // Scenario carries dye on a grid, so draw that instead of density.
+        mVolumeRendererGpu.UploadDye( vortonSim.GetGridDye().GetConcentrationGrid() ) ;
+        mVolumeRendererGpu.Render( VolumeRendererGpu::CHANNEL_SMOKE ) ;
+        return ;
+    }
+#endif
+#if ENABLE_FIRE
+    mVolumeRendererGpu.Upload( vortonSim.GetDensityGrid() , vortonSim.GetAmbientDensity() , & vortonSim.GetFlameGrid() , & vortonSim.GetSmokeGrid() ) ;
+#else
+    mVolumeRendererGpu.Upload( vortonSim.GetDensityGrid() , vortonSim.GetAmbientDensity() , NULLPTR , NULLPTR ) ;
+#endif
+    mVolumeRendererGpu.Render( channels ) ;
+}
+#endif
+
+
+
+
 /** Function that GLUT calls to display contents of window.
 */
 /* static */ void InteSiVis::GlutDisplayCallback()
@@ -1768,6 +2797,26 @@ void InteSiVis::CopyCameraFromQdToPeGaSys()
         {   // This is the first frame this app has tried to display anything.
             sInstance->InitializeQdRendering() ;
             sInstance->CreateRigidBodyModelsAndEntities() ;
+        #if INTE_SI_VIS_GPU_VORTON_VELOCITY
+            if( sInstance->mVortonVelocityGpu.Initialize() )
+            {   // Render context supports compute shaders, so compute vorton velocity on the GPU from now on.
+                sInstance->mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.SetVelocityEvaluator( & sInstance->mVortonVelocityGpu ) ;
+            }
+        #endif
+        #if INTE_SI_VIS_GPU_TRACERS
+            static const size_t maxGpuTracers = 1 << 21 ;
+            sInstance->mTracerAdvectionGpu.Initialize( maxGpuTracers ) ;
+        #endif
+        #if INTE_SI_VIS_GPU_ISOSURFACE
+            static const size_t maxGpuIsosurfaceTriangles = 1 << 20 ;
+            sInstance->mIsosurfaceExtractorGpu.Initialize( maxGpuIsosurfaceTriangles ) ;
+        #endif
+        #if INTE_SI_VIS_VOLUME_RENDER
+            if( sInstance->mVolumeRendererGpu.Initialize() )
+            {   // Render context supports volume rendering, so let the current scenario use it.
+                sInstance->PreferVolumeRendering() ;
+            }
+        #endif
         }
 
         CheckGlError() ;
@@ -1781,17 +2830,38 @@ void InteSiVis::CopyCameraFromQdToPeGaSys()
     sInstance->mFluidScene.AnimateLights( sInstance->mTimeNow ) ;
 
     // Update fluid isosurface model.
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    if( sInstance->mRenderSnapshot && ! sInstance->mRenderSnapshot->mSignedDistanceGrid.Empty() )
+    {
+    #if FRAME_SNAPSHOT_PACK_SIGNED_DISTANCE
+        sInstance->mRenderSnapshot->mSignedDistanceGrid.CopyToDense( sInstance->mRenderSignedDistanceGrid ) ;
+        sInstance->UpdateFluidIsosurface( sInstance->mRenderSignedDistanceGrid , NULLPTR ) ;
+    #else
+        sInstance->UpdateFluidIsosurface( sInstance->mRenderSnapshot->mSignedDistanceGrid , NULLPTR ) ;
+    #endif
+    }
+#else
     {
         VortonSim & vortonSim = sInstance->mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim ;
         if( ! vortonSim.GetSignedDistanceGrid().Empty() )
         {
-            sInstance->mFluidScene.UpdateFluidIsosurface( vortonSim.GetSignedDistanceGrid() ) ;
+            sInstance->UpdateFluidIsosurface( vortonSim.GetSignedDistanceGrid() , vortonSim.IsDensityGradientGridCurrent() ? & vortonSim.GetDensityGradientGrid() : NULLPTR ) ;
         }
         //else if( ! vortonSim.GetDensityGrid().Empty() )
         //{
         //    sInstance->mFluidScene.UpdateFluidIsosurface( vortonSim.GetDensityGrid() ) ;
         //}
     }
+#endif
+
+#if INTE_SI_VIS_GPU_TRACERS
+    // Move tracers emitted since the previous frame onto the GPU, so CPU particle operations and FluidScene see none.
+    sInstance->mTracerAdvectionGpu.AdoptTracers( sInstance->mTracerPclGrpInfo.mParticleGroup->GetParticles() ) ;
+#endif
+
+    // Measure GPU passes of this frame.  Resolves passes of earlier frames whose results the GPU has finished.
+    PeGaSys::Render::GpuTimerBase * gpuTimer = sInstance->mRenderSystem.GetApi()->GetGpuTimer() ;
+    gpuTimer->BeginFrame() ;
 
     // Render scene using PeGaSys::Render.
     sInstance->mRenderSystem.UpdateTargets( sInstance->mTimeNow ) ;
@@ -1802,16 +2872,45 @@ void InteSiVis::CopyCameraFromQdToPeGaSys()
         CheckGlError() ;
 
         sInstance->mQdCamera.SetCamera() ;
-        sInstance->QdRenderDiagnosticGrid() ;
-        sInstance->QdRenderParticleDiagnostics() ;
-        sInstance->QdRenderSummaryDiagnosticText() ;
+    #if INTE_SI_VIS_GPU_ISOSURFACE
+        {   // Draw opaque isosurface before translucent tracers and volumes, so they depth-test against it.
+            RENDER_GPU_PASS( gpuTimer , IsosurfaceExtractorGpu__Render ) ;
+            sInstance->mIsosurfaceExtractorGpu.Render() ;
+        }
+    #endif
+    #if INTE_SI_VIS_GPU_TRACERS
+        {
+            RENDER_GPU_PASS( gpuTimer , TracerAdvectionGpu__Render ) ;
+            sInstance->mTracerAdvectionGpu.Render( sInstance->mTimeNow ) ;
+        }
+    #endif
+    #if INTE_SI_VIS_VOLUME_RENDER
+        {
+            RENDER_GPU_PASS( gpuTimer , RenderFluidVolume ) ;
+            sInstance->RenderFluidVolume() ;
+        }
+    #endif
+    #if ! INTE_SI_VIS_PIPELINE_FRAMES // QdRender diagnostics read live simulation state, which simulation thread modifies while this renders.
+        {
+            RENDER_GPU_PASS( gpuTimer , QdRenderDiagnostics ) ;
+            sInstance->QdRenderDiagnosticGrid() ;
+            sInstance->QdRenderParticleDiagnostics() ;
+            sInstance->QdRenderSummaryDiagnosticText() ;
+            sInstance->mDiagnosticTextBatch.Flush() ;   // Draw text every QdRender diagnostic above queued, at once.
+        }
+    #endif
 
         CheckGlError() ;
     }
 
+    gpuTimer->EndFrame() ;
+
     {
         // TODO: This call to glutSwapBuffers probably ought to happen in a render routine.  Likewise see call to Present in D3D version.
         // For now it is useful not to swap buffers within UpdateTargets because it lets QdRender composite into same screen buffer.
+    #if INTE_SI_VIS_CAPTURE_FRAMES
+        sInstance->CaptureFrame() ;
+    #endif
         PERF_BLOCK( glutSwapBuffers ) ;
         glutSwapBuffers() ;
     }
@@ -1900,11 +2999,8 @@ Impulsion::PhysicalObject * InteSiVis::GetPhysicalObjectInFocus()
             Impulsion::PhysicalObject * physObj     = GetPhysicalObjectInFocus() ;
             if( physObj )
             {
-                Mat44 viewMatrix ;
-                glGetFloatv( GL_MODELVIEW_MATRIX , (GLfloat *) & viewMatrix ) ;
-                Vec3 viewRight  ( viewMatrix.m[0][0] , viewMatrix.m[1][0] , viewMatrix.m[2][0] ) ;
-                Vec3 viewUp     ( viewMatrix.m[0][1] , viewMatrix.m[1][1] , viewMatrix.m[2][1] ) ;
-                Vec3 viewForward( viewMatrix.m[0][2] , viewMatrix.m[1][2] , viewMatrix.m[2][2] ) ;
+                Vec3 viewRight , viewUp , viewForward ;
+                mQdCamera.GetViewAxes( viewRight , viewUp , viewForward ) ;
                 Vec3 delta      = 1.0f * viewForward * ( dx + dy ) ;
 
                 Impulsion::RigidBody *  rigidBody   = physObj->GetBody() ;
@@ -1927,14 +3023,10 @@ Impulsion::PhysicalObject * InteSiVis::GetPhysicalObjectInFocus()
     }
     else if( mMouseButtons[1] )
     {   // User is middle-click-dragging mouse
-        // Extract world space direction vectors associated with view (used to compute camera-facing coordinates).
-        // Note that these vectors are the unit vectors of the inverse of the view matrix.
-        // They are the world-space unit vectors of the view transformation.
-        Mat44 viewMatrix ;
-        glGetFloatv( GL_MODELVIEW_MATRIX , (GLfloat *) & viewMatrix ) ;
-        Vec3 viewRight  ( viewMatrix.m[0][0] , viewMatrix.m[1][0] , viewMatrix.m[2][0] ) ;
-        Vec3 viewUp     ( viewMatrix.m[0][1] , viewMatrix.m[1][1] , viewMatrix.m[2][1] ) ;
-        Vec3 viewForward( viewMatrix.m[0][2] , viewMatrix.m[1][2] , viewMatrix.m[2][2] ) ;
+        // Obtain world space direction vectors associated with view (used to compute camera-facing coordinates).
+        // These come from the camera rather than the OpenGL modelview matrix, so replaying recorded input works headless.
+        Vec3 viewRight , viewUp , viewForward ;
+        mQdCamera.GetViewAxes( viewRight , viewUp , viewForward ) ;
         Vec3 delta      = 1.0f * ( - viewRight * dx + viewUp * dy ) ;
         if( GLUT_ACTIVE_SHIFT == modifierKeys )
         {   // Shift (only) held.
@@ -1966,6 +3058,31 @@ Impulsion::PhysicalObject * InteSiVis::GetPhysicalObjectInFocus()
 
 
 
+/** Advance frame counter and virtual time by one step, if the simulation clock runs.
+*/
+void InteSiVis::AdvanceClock()
+{
+    if( mTimeStepping == PLAY || mTimeStepping == SINGLE_STEP )
+    {   // Step time by 1.
+        if( mTimeStep > 0.0f )
+        {   // Step time forward.
+            ++ mFrame ;
+        }
+        else if( mTimeStep < 0.0f )
+        {   // Step time backward.
+            -- mFrame ;
+        }
+        mTimeNow += mTimeStep ;
+        if( mTimeStepping == SINGLE_STEP )
+        {   // Now that simulation single-stepped, return to pause mode.
+            mTimeStepping = PAUSE ;
+        }
+    }
+}
+
+
+
+
 /** Function to run to handle "idle" event, that is, when not doing anything else.
 */
 void InteSiVis::Idle()
@@ -1979,6 +3096,8 @@ void InteSiVis::Idle()
 #endif
 
     const float originalTimeStep = mTimeStep ; // Remember dictated timeStep in case this changes it and we need to restore it.
+    float realFrameDuration = 0.0f ; // Real time since previous frame, while playing forward.
+    bool  clockAdvanced     = false ; // Whether scheduled steps advanced the clock as they ran.
     if( ( PLAY == mTimeStepping ) && ( mTimeStep > 0.0f ) )
     {   // Simulation is playing forward normally.
 
@@ -1995,6 +3114,7 @@ void InteSiVis::Idle()
         frameDurationInTicks.QuadPart = systemTimeNow.QuadPart - mSystemTimeBefore.QuadPart ;
         mSystemTimeBefore = systemTimeNow ;
         const float frameDurationInSeconds = secondsPerTick * static_cast< float >( frameDurationInTicks.QuadPart ) ;
+        realFrameDuration = frameDurationInSeconds ;
 
         const float delta = frameDurationInSeconds - mFrameDurSecAvg ;
         const float gain = 0.125f ;
@@ -2005,34 +3125,69 @@ void InteSiVis::Idle()
     mTimeStepMin = Min2( mTimeStepMin , mTimeStep ) ;
     mTimeStepMax = Max2( mTimeStepMax , mTimeStep ) ;
 
-    UpdateParticleSystems() ;
+#if INTE_SI_VIS_PIPELINE_FRAMES
+    // Simulate next step on simulation thread while this thread renders the previous step.
+    SetEvent( mSimulationStepRequested ) ;
 
-#if USE_TBB
-    tbb::tick_count timeFinal = tbb::tick_count::now() ;
-    //printf( " tbb duration=%g second\n" , (timeFinal - time0).seconds() ) ;
+    mQdCamera.Update() ;
+
+    InteSiVis::GlutDisplayCallback() ;
+
+    {   // Wait for simulation step to finish, so input handlers, which modify simulation state, do not run concurrently with it.
+        PERF_BLOCK( InteSiVis__Idle_WaitForSimulation ) ;
+        AdoptFrameSnapshot( mFrameSnapshots.AcquireForReading() ) ;
+    }
+#else
+#if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE
+    if( mFrameSequenceReader.IsOpen() )
+    {   // Scenario has a recording, so reconstruct it instead of simulating.
+        PlaybackFrame() ;
+    }
+    else
 #endif
+#if INTE_SI_VIS_REMOTE_VIEWER
+    if( mRemoteViewClient.IsConnected() && mFluidParticleSystem )
+    {   // A remote simulation streams particles, so render those instead of simulating.
+        mRemoteViewClient.Update( * mFluidParticleSystem , mFrame , mTimeNow ) ;
+    }
+    else
+#endif
+    {
+    #if INTE_SI_VIS_FIXED_TIMESTEP
+        RunScheduledSimulationSteps( realFrameDuration ) ;
+        clockAdvanced = true ;
+    #else
+        UpdateParticleSystems() ;
+
+    #if USE_TBB
+        tbb::tick_count timeFinal = tbb::tick_count::now() ;
+        //printf( " tbb duration=%g second\n" , (timeFinal - time0).seconds() ) ;
+    #endif
 
-    UpdateRigidBodies() ;
+        UpdateRigidBodies() ;
+    #endif
+    }
+
+#if INTE_SI_VIS_FIXED_TIMESTEP
+    // Scheduled steps export and stream as they run.  Playback and remote particles show as is.
+    InterpolateRenderParticles( clockAdvanced ? mSimStepScheduler.GetInterpolationFraction() : 1.0f ) ;
+#else
+#if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+    ExportFrame() ;
+#endif
+#if INTE_SI_VIS_REMOTE_VIEW_PORT && ! INTE_SI_VIS_REMOTE_VIEWER
+    StreamFrame() ;
+#endif
+#endif
 
     mQdCamera.Update() ;
 
     InteSiVis::GlutDisplayCallback() ;
+#endif
 
-    if( mTimeStepping == PLAY || mTimeStepping == SINGLE_STEP )
-    {   // Step time by 1.
-        if( mTimeStep > 0.0f )
-        {   // Step time forward.
-            ++ mFrame ;
-        }
-        else if( mTimeStep < 0.0f )
-        {   // Step time backward.
-            -- mFrame ;
-        }
-        mTimeNow += mTimeStep ;
-        if( mTimeStepping == SINGLE_STEP )
-        {   // Now that simulation single-stepped, return to pause mode.
-            mTimeStepping = PAUSE ;
-        }
+    if( ! clockAdvanced )
+    {   // Nothing above advanced the clock per step.
+        AdvanceClock() ;
     }
 
 #if PROFILE
@@ -2040,6 +3195,8 @@ void InteSiVis::Idle()
     sNumVortonsSum += mVortonPclGrpInfo.mPclOpVortonSim->mVortonSim.GetVortons()->Size() ;
 #endif
 
+    PublishTelemetry() ;
+
     mTimeStep = originalTimeStep ;
 }
 
@@ -2080,12 +3237,21 @@ void InteSiVis::Idle()
             case GLUT_KEY_F8 : InitialConditions(  8 ) ; break;
             case GLUT_KEY_F9 : InitialConditions(  9 ) ; break;
             case GLUT_KEY_F11: InitialConditions( 10 ) ; break;
+            case GLUT_KEY_F10: SaveCheckpoint( sCheckpointFilename ) ; break;
+            case GLUT_KEY_F12: RestoreCheckpoint( sCheckpointFilename ) ; break;
 
             case GLUT_KEY_UP   : mTimeStep =  sTimeStep * timeFactor ; mTimeStepping   = PLAY  ; break ;
             case GLUT_KEY_DOWN : mTimeStep =  sTimeStep * timeFactor ; mTimeStepping   = PAUSE ; break ;
             case GLUT_KEY_RIGHT: mTimeStep =  sTimeStep * timeFactor ; if( mTimeStepping == PAUSE ) mTimeStepping = SINGLE_STEP ; break ;
             case GLUT_KEY_LEFT : mTimeStep = -sTimeStep * timeFactor ; if( mTimeStepping == PAUSE ) mTimeStepping = SINGLE_STEP ; break ;
 
+        #if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE
+            case GLUT_KEY_HOME     : SeekPlayback( 0 ) ; break ;
+            case GLUT_KEY_END      : SeekPlayback( ~ size_t( 0 ) ) ; break ;
+            case GLUT_KEY_PAGE_UP  : if( mFrameSequenceReader.GetNumFrames() ) SeekPlayback( mFrameSequenceReader.FindFrame( mTimeNow ) + 30 ) ; break ;
+            case GLUT_KEY_PAGE_DOWN: if( mFrameSequenceReader.GetNumFrames() ) SeekPlayback( Max2( size_t( 30 ) , mFrameSequenceReader.FindFrame( mTimeNow ) ) - 30 ) ; break ;
+        #endif
+
             default:
             return;
             break;
@@ -2194,7 +3360,7 @@ void InteSiVis::Idle()
 
     sInstance->mModifierKeys = glutGetModifiers() ;
 
-    sInstance->SpecialKeyHandler( key , sInstance->mModifierKeys , windowRelativeMouseX , windowRelativeMouseY ) ;
+    sInstance->ProcessInputEvent( InputEvent( sInstance->mNumStepsSimulated , INPUT_EVENT_SPECIAL_KEY , key , 0 , windowRelativeMouseX , windowRelativeMouseY , sInstance->mModifierKeys ) ) ;
 
     glutPostRedisplay() ;
 }
@@ -2203,13 +3369,13 @@ void InteSiVis::Idle()
 
 
 /** Function to handle a regular key.
+
+    mModifierKeys must hold the modifier keys pressed along with this key.
 */
 void InteSiVis::KeyboardHandler( unsigned char key , int /* mouseX */ , int /* mouseY */ )
 {
     PERF_BLOCK( InteSiVis__KeyboardHandler ) ;
 
-    mModifierKeys = glutGetModifiers() ;
-
     QdCamera & cam = mQdCamera ;
     float azimuth , elevation , radius ;
     static bool animateCamera = false ;
@@ -2317,6 +3483,15 @@ void InteSiVis::KeyboardHandler( unsigned char key , int /* mouseX */ , int /* m
         }
         break ;
 
+#   if PROFILE
+        case 'k':   // Record a timeline of the next few frames, viewable in chrome://tracing or Perfetto.
+        case 'K':
+        {
+            PERF_BLOCK_ENABLE_TRACING( sTraceFrameCount , "perfTrace.json" ) ;
+        }
+        break ;
+#   endif
+
         case 'l':   // Cycle through color maps for grid
         {
             if( GLUT_ACTIVE_ALT & mModifierKeys )
@@ -2450,6 +3625,9 @@ void InteSiVis::KeyboardHandler( unsigned char key , int /* mouseX */ , int /* m
         case 127 /* delete */ : ; break;
 
         case 27 /* escape */ :
+#       if INTE_SI_VIS_RECORD_INPUT
+            SaveInputRecording() ;
+#       endif
 #       if PROFILE
             PerfBlock::TerminateAndLogAllThreads() ;
 #       endif
@@ -2473,7 +3651,9 @@ void InteSiVis::KeyboardHandler( unsigned char key , int /* mouseX */ , int /* m
 {
     PERF_BLOCK( InteSiVis__GlutKeyboardHandler ) ;
 
-    sInstance->KeyboardHandler( key , mouseX , mouseY ) ;
+    sInstance->mModifierKeys = glutGetModifiers() ;
+
+    sInstance->ProcessInputEvent( InputEvent( sInstance->mNumStepsSimulated , INPUT_EVENT_KEY , key , 0 , mouseX , mouseY , sInstance->mModifierKeys ) ) ;
 }
 
 
@@ -2487,13 +3667,30 @@ void InteSiVis::KeyboardHandler( unsigned char key , int /* mouseX */ , int /* m
 
     sInstance->mModifierKeys = glutGetModifiers() ;
 
+    sInstance->ProcessInputEvent( InputEvent( sInstance->mNumStepsSimulated , INPUT_EVENT_MOUSE_BUTTON , button , state , x , y , sInstance->mModifierKeys ) ) ;
+}
+
+
+
+
+/** Function to handle a mouse button press or release.
+*/
+void InteSiVis::MouseButtonHandler( int button , int state , int x , int y )
+{
+    PERF_BLOCK( InteSiVis__MouseButtonHandler ) ;
+
+    if( ( button < 0 ) || ( button >= int( sizeof( mMouseButtons ) / sizeof( mMouseButtons[0] ) ) ) )
+    {   // Button is one that nothing uses, such as a wheel, which some GLUT implementations report as buttons 3 and 4.
+        return ;
+    }
+
     if( GLUT_DOWN == state )
     {   // User is clicking a mouse button
-        sInstance->mMouseButtons[ button ] = 1 ;
+        mMouseButtons[ button ] = 1 ;
     }
     else
     {   // User released a mouse button
-        sInstance->mMouseButtons[ button ] = 0 ;
+        mMouseButtons[ button ] = 0 ;
     }
     sMousePrevX = x ;
     sMousePrevY = y ;
@@ -2508,12 +3705,93 @@ void InteSiVis::KeyboardHandler( unsigned char key , int /* mouseX */ , int /* m
 {
     PERF_BLOCK( InteSiVis__GlutMouseMotionHandler ) ;
 
-    sInstance->MouseMotionHandler( x , y , sInstance->mModifierKeys ) ;
+    sInstance->ProcessInputEvent( InputEvent( sInstance->mNumStepsSimulated , INPUT_EVENT_MOUSE_MOTION , 0 , 0 , x , y , sInstance->mModifierKeys ) ) ;
+}
+
+
+
+
+/** Apply the given input event, which just arrived from the user, and record it, if recording.
+
+    Events that begin a scenario do not get recorded, since they end the
+    recording they would belong to, and replaying them would abandon the
+    scenario being replayed.
+*/
+void InteSiVis::ProcessInputEvent( const InputEvent & inputEvent )
+{
+#if INTE_SI_VIS_RECORD_INPUT
+    const unsigned numScenariosBegunBefore = mNumScenariosBegun ;
+#endif
+
+    DispatchInputEvent( inputEvent ) ;
+
+#if INTE_SI_VIS_RECORD_INPUT
+    if( mNumScenariosBegun == numScenariosBegunBefore )
+    {   // Event did not begin a scenario.
+        mInputRecording.Append( inputEvent ) ;
+    }
+#endif
+}
+
+
+
+
+/** Apply the given input event, whether it just arrived from the user, or came from a recording.
+
+    This calls only handlers that work without a window, so the benchmark can replay recordings headless.
+*/
+void InteSiVis::DispatchInputEvent( const InputEvent & inputEvent )
+{
+    PERF_BLOCK( InteSiVis__DispatchInputEvent ) ;
+
+    mModifierKeys = inputEvent.mModifierKeys ;
+
+    switch( inputEvent.mType )
+    {
+        case INPUT_EVENT_KEY         : KeyboardHandler( static_cast< unsigned char >( inputEvent.mKey ) , inputEvent.mX , inputEvent.mY ) ; break ;
+        case INPUT_EVENT_SPECIAL_KEY : SpecialKeyHandler( inputEvent.mKey , inputEvent.mModifierKeys , inputEvent.mX , inputEvent.mY ) ; break ;
+        case INPUT_EVENT_MOUSE_BUTTON: MouseButtonHandler( inputEvent.mKey , inputEvent.mState , inputEvent.mX , inputEvent.mY ) ; break ;
+        case INPUT_EVENT_MOUSE_MOTION: MouseMotionHandler( inputEvent.mX , inputEvent.mY , inputEvent.mModifierKeys ) ; break ;
+        default: FAIL() ; break ;
+    }
 }
 
 
 
 
+#if INTE_SI_VIS_RECORD_INPUT
+
+/** Write input events of the current scenario into scenarioNN.inputrecording, unless there were none.
+
+    Skipping empty recordings keeps a session that merely passes through a
+    scenario from overwriting a recording of that scenario someone wanted.
+*/
+void InteSiVis::SaveInputRecording() const
+{
+    PERF_BLOCK( InteSiVis__SaveInputRecording ) ;
+
+    if( 0 == mInputRecording.GetNumEvents() )
+    {   // Nothing to replay.
+        return ;
+    }
+
+    char filename[ 64 ] ;
+    sprintf( filename , "scenario%02d.inputrecording" , mInputRecording.GetScenario() ) ;
+    if( mInputRecording.Save( filename ) )
+    {
+        printf( "InteSiVis::SaveInputRecording: wrote %u input events to %s\n" , unsigned( mInputRecording.GetNumEvents() ) , filename ) ;
+    }
+    else
+    {
+        printf( "InteSiVis::SaveInputRecording: could not write %s\n" , filename ) ;
+    }
+}
+
+#endif
+
+
+
+
 /** Function that GLUT calls when the window obtains focus.
 */
 /* static */ void InteSiVis::GlutEntryHandler( int state )
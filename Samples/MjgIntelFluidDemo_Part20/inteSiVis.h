@@ -23,7 +23,7 @@
 
 #include "entity.h"
 
-#include "particleSystemConfiguration.h"
+#include <FluidEngine/particleSystemConfiguration.h>
 
 #include <Scene/fluidScene.h>
 
@@ -43,6 +43,258 @@
 
 #include <Impulsion/rbSphere.h>
 #include <Impulsion/rbBox.h>
+#include <Impulsion/contactSolver.h>
+
+#include <Core/parallelExecution.h>
+
+#include "frameSnapshot.h"
+#include "fixedStepScheduler.h"
+#include "vortonVelocityGpu.h"
+#include "tracerAdvectionGpu.h"
+#include "isosurfaceExtractorGpu.h"
+#include "volumeRendererGpu.h"
+#include "diagnosticBatch.h"
+#include "simulationCheckpoint.h"
+#include "frameSequenceWriter.h"
+#include "frameSequenceReader.h"
+#include "remoteView.h"
+#include "frameCaptureWriter.h"
+#include "inputRecording.h"
+#include <Render/Platform/OpenGL/OpenGL_frameReadback.h>
+#include <Render/Platform/OpenGL/OpenGL_textBatch.h>
+#include "benchmark.h"
+#include <Core/Performance/telemetry.h>
+#include <Core/Performance/memoryBudget.h>
+
+// Macros --------------------------------------------------------------
+
+/** Whether Idle overlaps rendering one frame with simulating the next.
+
+    When enabled, a simulation thread advances particle systems and rigid
+    bodies, then publishes a FrameSnapshot of the state rendering reads.
+    Meanwhile the main thread renders the previous snapshot.  That hides
+    simulation time behind render time, at the cost of displaying state one
+    step old, and of skipping QdRender diagnostics, which read the live
+    simulation.
+
+    Idle waits for each simulation step before returning, so input handlers,
+    which modify simulation state, never run concurrently with simulation.
+
+    This requires TBB (for the snapshot queue) and Windows (for the thread).
+*/
+#define INTE_SI_VIS_PIPELINE_FRAMES 0
+
+#if INTE_SI_VIS_PIPELINE_FRAMES && ! ( USE_TBB && defined( WIN32 ) )
+#   error INTE_SI_VIS_PIPELINE_FRAMES requires USE_TBB and WIN32.
+#endif
+
+
+/** Whether Idle runs simulation steps at the pace of real time, rather than one step per displayed frame.
+
+    When enabled, a FixedStepScheduler accumulates real time each frame and
+    runs as many steps of mTimeStep as that time covers: zero on frames
+    faster than a step, several on slower frames, up to a limit and budget
+    beyond which simulation slows instead of stalling display.  So
+    simulation cost and display rate become independent, and simulation
+    spends no work on steps nobody sees.
+
+    Since a frame rarely lands exactly on a step, the fluid scene renders
+    copies of fluid particles whose positions blend from before the most
+    recent step toward after it, by how far real time has gone past that
+    step.  That displays state up to one step old, and costs a copy of each
+    particle per frame.  Rigid bodies, grids and diagnostics show the most
+    recent step as is.
+
+    Pausing, single-stepping and stepping backward run one step per frame, as without this.
+
+    This keys per-particle history by stable identifier, so it requires
+    PARTICLE_GROUP_STABLE_IDS, and it simulates on the render thread, so it
+    cannot work with INTE_SI_VIS_PIPELINE_FRAMES.
+*/
+#define INTE_SI_VIS_FIXED_TIMESTEP 1
+
+#if INTE_SI_VIS_FIXED_TIMESTEP && INTE_SI_VIS_PIPELINE_FRAMES
+#   error INTE_SI_VIS_FIXED_TIMESTEP schedules steps on the render thread, so disable INTE_SI_VIS_PIPELINE_FRAMES.
+#endif
+
+#if INTE_SI_VIS_FIXED_TIMESTEP && ! PARTICLE_GROUP_STABLE_IDS
+#   error INTE_SI_VIS_FIXED_TIMESTEP tracks particles across steps by identifier, so enable PARTICLE_GROUP_STABLE_IDS.
+#endif
+
+
+/** Whether to compute vorton velocity at gridpoints on the GPU, using OpenGL compute shaders.
+
+    When enabled, and the graphics driver supports OpenGL 4.3, VortonSim
+    hands velocity-from-vorticity to VortonVelocityGpu instead of running the
+    CPU treecode.  That frees CPU threads for the rest of the simulation.
+    This only affects VELOCITY_TECHNIQUE_TREE; other techniques ignore it.
+
+    The compute shader needs the render thread's OpenGL context, so this
+    cannot work with INTE_SI_VIS_PIPELINE_FRAMES, which simulates on
+    another thread.
+*/
+#define INTE_SI_VIS_GPU_VORTON_VELOCITY 0
+
+#if INTE_SI_VIS_GPU_VORTON_VELOCITY && INTE_SI_VIS_PIPELINE_FRAMES
+#   error INTE_SI_VIS_GPU_VORTON_VELOCITY requires simulating on the render thread, so disable INTE_SI_VIS_PIPELINE_FRAMES.
+#endif
+
+
+/** Whether tracers live, advect and get drawn on the GPU, using OpenGL compute shaders.
+
+    When enabled, and the graphics driver supports OpenGL 4.3, each frame
+    moves newly emitted tracers into TracerAdvectionGpu, which advects them
+    through the velocity grid and draws them without copying them back, so
+    only the velocity grid crosses the bus.  That lets scenarios use millions
+    of tracers.
+
+    Tracers on the GPU only follow the fluid.  They do not get killed by age,
+    carry density or fire scalars, feel wind or interact with bodies, and
+    they render with a single color instead of FluidScene tracer materials.
+
+    Like INTE_SI_VIS_GPU_VORTON_VELOCITY, this needs the render thread's
+    OpenGL context, so it cannot work with INTE_SI_VIS_PIPELINE_FRAMES.
+*/
+#define INTE_SI_VIS_GPU_TRACERS 0
+
+#if INTE_SI_VIS_GPU_TRACERS && INTE_SI_VIS_PIPELINE_FRAMES
+#   error INTE_SI_VIS_GPU_TRACERS requires simulating on the render thread, so disable INTE_SI_VIS_PIPELINE_FRAMES.
+#endif
+
+
+/** Whether to extract and draw the fluid isosurface on the GPU, using OpenGL compute shaders.
+
+    When enabled, and the graphics driver supports OpenGL 4.3, each frame
+    uploads the signed distance grid to IsosurfaceExtractorGpu, which
+    extracts the isosurface into a vertex buffer that stays on the GPU, and
+    draws it from there, instead of FluidScene extracting it on the CPU with
+    Mesh_MakeFromVolume and uploading the triangles.
+
+    The isosurface on the GPU renders with simple lighting instead of the
+    FluidScene isosurface material.
+
+    This only reads the grid the render thread already has, so unlike other
+    GPU options it also works with INTE_SI_VIS_PIPELINE_FRAMES.
+*/
+#define INTE_SI_VIS_GPU_ISOSURFACE 0
+
+
+/** Whether to draw flame, smoke and density by ray-marching their grids on the GPU, instead of drawing tracers.
+
+    When enabled, and the graphics driver supports OpenGL 4.3, scenarios that
+    would draw fire or dye tracers instead use TRACER_RENDER_VOLUME_FIRE or
+    TRACER_RENDER_VOLUME_DYE, and each frame VolumeRendererGpu uploads the
+    grids and ray-marches them.  Render cost then depends on screen resolution
+    and grid size, not on the number of tracers.  Cycling the tracer rendering
+    style still reaches the styles that draw tracers.
+
+    Volume rendering reads live simulation grids, so this cannot work with
+    INTE_SI_VIS_PIPELINE_FRAMES.
+*/
+#define INTE_SI_VIS_VOLUME_RENDER 0
+
+#if INTE_SI_VIS_VOLUME_RENDER && INTE_SI_VIS_PIPELINE_FRAMES
+#   error INTE_SI_VIS_VOLUME_RENDER reads grids while simulation runs on the render thread, so disable INTE_SI_VIS_PIPELINE_FRAMES.
+#endif
+
+
+/** Whether to export every simulated frame into a frame sequence file, for offline rendering.
+
+    When enabled, each scenario writes scenarioNN.framesequence, holding
+    particle positions, velocities, densities and sizes (and fire fractions,
+    if ENABLE_FIRE), plus the velocity and density grids.  Each step only
+    copies that data; FrameSequenceWriter writes it on a background thread,
+    and drops frames rather than stall simulation if the disk falls behind.
+*/
+#define INTE_SI_VIS_EXPORT_FRAME_SEQUENCE 0
+
+/** Whether to play back recorded frame sequences instead of simulating.
+
+    When enabled, each scenario reads scenarioNN.framesequence, as
+    INTE_SI_VIS_EXPORT_FRAME_SEQUENCE wrote it, and each frame reconstructs
+    particles and grids at the current virtual time, blending the recorded
+    frames on either side, instead of running particle operations,
+    VortonSim or rigid body physics.  Time stepping keys still pause,
+    single-step and reverse, and Home, End, Page Up and Page Down seek.
+    Scenarios without a recording simulate as usual.
+*/
+#define INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE 0
+
+#if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE && INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+#   error INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE reads the files INTE_SI_VIS_EXPORT_FRAME_SEQUENCE would overwrite, so enable only one.
+#endif
+
+#if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE && ( INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_GPU_TRACERS )
+#   error INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE writes particles on the render thread, into the CPU particle system, so disable INTE_SI_VIS_PIPELINE_FRAMES and INTE_SI_VIS_GPU_TRACERS.
+#endif
+
+/** TCP port on which to stream particle state to a remote viewer, or, if INTE_SI_VIS_REMOTE_VIEWER, to receive it from a simulation, or 0 for neither.
+
+    When streaming, each simulated frame, RemoteViewServer quantizes tracer
+    and vorton positions, densities, sizes and fire fractions, and encodes
+    them as differences from the previous frame, which costs a few bytes per
+    particle, or less for particles that barely move.  A background thread
+    sends those to one viewer at a time, and drops frames rather than stall
+    simulation if the viewer or network falls behind.
+*/
+#define INTE_SI_VIS_REMOTE_VIEW_PORT 0
+
+/** Whether to render particle state streamed from a simulation on another machine, instead of simulating.
+
+    When enabled, the application connects to INTE_SI_VIS_REMOTE_VIEW_HOST
+    on INTE_SI_VIS_REMOTE_VIEW_PORT, and each frame swaps in the newest
+    particles received, instead of running particle operations, VortonSim
+    or rigid body physics.  The viewer must run the same scenario as the
+    simulation, so its particle groups correspond.  Simulation resumes
+    locally if the connection closes.
+*/
+#define INTE_SI_VIS_REMOTE_VIEWER 0
+#define INTE_SI_VIS_REMOTE_VIEW_HOST "localhost"   ///< Name or dotted address of machine that INTE_SI_VIS_REMOTE_VIEWER connects to.
+
+#if INTE_SI_VIS_REMOTE_VIEWER && ! INTE_SI_VIS_REMOTE_VIEW_PORT
+#   error INTE_SI_VIS_REMOTE_VIEWER connects to INTE_SI_VIS_REMOTE_VIEW_PORT, so set it.
+#endif
+
+#if INTE_SI_VIS_REMOTE_VIEWER && ( INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_GPU_TRACERS || INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE )
+#   error INTE_SI_VIS_REMOTE_VIEWER writes particles on the render thread, into the CPU particle system, so disable INTE_SI_VIS_PIPELINE_FRAMES, INTE_SI_VIS_GPU_TRACERS and INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE.
+#endif
+
+/** Whether to record every rendered frame into numbered image files, for making videos.
+
+    When enabled, each scenario writes scenarioNN_frameNNNNN.tga.
+    OpenGL_FrameReadback copies each frame into a pixel buffer without
+    waiting for the GPU, and collects it a few frames later, then
+    FrameCaptureWriter encodes and writes it on a background thread, so
+    recording costs the render thread about one copy of each frame.
+*/
+#define INTE_SI_VIS_CAPTURE_FRAMES 0
+
+/** Whether to record interactive input, so the benchmark can replay it.
+
+    When enabled, each scenario writes scenarioNN.inputrecording, holding
+    each key, mouse button and mouse motion event, stamped by the number of
+    simulation steps that preceded it.  Recording costs one small copy per
+    event.  "VorteGrid -benchmark -replay scenarioNN.inputrecording" then
+    runs that scenario headless, applying each event after the same step,
+    so profiling can examine exactly the sequence that made a session
+    stutter.  See InputRecording.
+*/
+#define INTE_SI_VIS_RECORD_INPUT 0
+
+/** TCP port on which to serve telemetry, or 0 to serve none.
+
+    Each frame, Idle publishes frame rate, particle counts, simulation stage
+    durations and grid memory into a Telemetry registry, which costs a few
+    dozen stores.  A background thread answers HTTP requests on this port
+    with those metrics, in the Prometheus text format, so monitoring can
+    scrape a running simulation, for example "curl localhost:9464/metrics".
+*/
+#define INTE_SI_VIS_TELEMETRY_PORT 9464
+
+// Types --------------------------------------------------------------
+
+class ParticlePositionHistory ; // Forward declaration.
+class PerfBaseline ; // Forward declaration.
 
 
 
@@ -63,16 +315,23 @@ class InteSiVis
             GRID_DECO_CELLS_AND_POINTS  ,   ///< Draw grid cells and points.
         } ;
 
-        InteSiVis( PeGaSys::Render::ApiBase * renderApi ) ;
+        InteSiVis( PeGaSys::Render::ApiBase * renderApi , const Parallel::Settings & parallelSettings = Parallel::SettingsFromEnvironment() ) ;
         ~InteSiVis() ;
 
         static InteSiVis * GetInstance() ;
 
         void InitializeDisplayAndInputDevices() ;
         void InitialConditions( unsigned ic ) ;
+        bool SaveCheckpoint( const char * filename ) const ;
+        bool RestoreCheckpoint( const char * filename ) ;
+        bool ImportInitialParticles( const char * filename , bool & importedTracers ) ;
+        void RunBenchmarkScenario( unsigned ic , unsigned numFrames , const VortonSim::TreeOpeningCriterion & treeOpeningCriterion , VortonSim::VelocityFromVorticityTechniqueE velocityTechnique , unsigned numErrorSamples , BenchmarkScenarioResult & result , PerfBaseline * perfSamples , const InputRecording * inputReplay = NULLPTR ) ;
 
         float CameraFocusEmphasis( const Vec3 position ) const ;
 
+        /// Return text batch that QdRender diagnostic text queues into, which GlutDisplayCallback flushes after QdRender diagnostics.
+        PeGaSys::Render::OpenGL_TextBatch & GetDiagnosticTextBatch() { return mDiagnosticTextBatch ; }
+
     private:
         /** Diagnostic text rendering options.
         */
@@ -126,21 +385,64 @@ class InteSiVis
         void            CreateRigidBodyModelsAndEntities() ;
         void            SetDiagnosticPropertyValueRangeScale( float & rangeScale ) const ;
         void            GatherAndRecordProfileData() ;
+        void            RegisterTelemetry() ;
+        void            PublishTelemetry() ;
         void            UpdateParticleSystems() ;
         void            CopyCameraFromQdToPeGaSys() ;
         void            CopyLightsFromQdToPeGaSys() ;
         void            UpdateRigidBodies() ;
         void            UpdateRigidBodyModelsFromPhysics() ;
+        void            AdvanceClock() ;
+    #if INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_FIXED_TIMESTEP
+        void            MatchRenderParticleSystemToFluidParticleSystem() ;
+    #endif
+    #if INTE_SI_VIS_FIXED_TIMESTEP
+        void            RunScheduledSimulationSteps( float realFrameDuration ) ;
+        void            SimulateStep() ;
+        void            RecordPreviousParticlePositions() ;
+        void            InterpolateRenderParticles( float fraction ) ;
+    #endif
+    #if INTE_SI_VIS_PIPELINE_FRAMES
+        void            AdoptFrameSnapshot( FrameSnapshot * snapshot ) ;
+        void            DiscardFrameSnapshot() ;
+        void            StartSimulationThread() ;
+        void            StopSimulationThread() ;
+        static DWORD WINAPI SimulationThreadMain( LPVOID context ) ;
+    #endif
         const char *    FluidSimulationTechniqueString() const ;
         const char *    GridDecorationString() const ;
         const char *    GridFieldString() const ;
         const char *    VortonPropertyString() const ;
 
         void            SetTallyDiagnosticIntegrals() ;
+    #if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+        void            ExportFrame() ;
+    #endif
+    #if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE
+        void            PlaybackFrame() ;
+        void            SeekPlayback( size_t frameIndex ) ;
+    #endif
+    #if INTE_SI_VIS_REMOTE_VIEW_PORT && ! INTE_SI_VIS_REMOTE_VIEWER
+        void            StreamFrame() ;
+    #endif
+    #if INTE_SI_VIS_CAPTURE_FRAMES
+        void            CaptureFrame() ;
+    #endif
+        void            UpdateFluidIsosurface( const UniformGrid< float > & signedDistanceGrid , const UniformGrid< Vec3 > * densityGradientGrid ) ;
+    #if INTE_SI_VIS_VOLUME_RENDER
+        void            PreferVolumeRendering() ;
+        void            RenderFluidVolume() ;
+    #endif
 
         void            KeyboardHandler( unsigned char key , int mouseX , int mouseY ) ;
         void            SpecialKeyHandler ( int key , int modifierKeys , int windowRelativeMouseX , int windowRelativeMouseY ) ;
+        void            MouseButtonHandler( int button , int state , int x , int y ) ;
         void            MouseMotionHandler( int x , int y , int modifierKeys) ;
+        void            ProcessInputEvent( const InputEvent & inputEvent ) ;
+        void            DispatchInputEvent( const InputEvent & inputEvent ) ;
+    #if INTE_SI_VIS_RECORD_INPUT
+        void            SaveInputRecording() const ;
+    #endif
         void            Idle() ;
 
 // TODO: Remove all these QD render methods and/or replace them with PeGaSys::Render analogs.
@@ -148,9 +450,10 @@ class InteSiVis
         void            CreateQdMaterials() ;
         void            QdRenderVortonDiagnosticText() ;
         void            QdRenderVortonDiagnosticVectors() ;
+        void            FillVortonDiagnosticVectorsSlice( DiagnosticBatch::Vertex * lineVerts , DiagnosticBatch::Vertex * pointVerts , float rangeScale , size_t iVortStart , size_t iVortEnd ) const ;
         void            QdRenderVortonDiagnostics() ;
         void            QdRenderNonFluidParticles() ;
-        void            QdRenderDiagnosticPathlines( VECTOR< Particle > & Particles ) ;
+        void            QdRenderDiagnosticPathlines( const ParticlePositionHistory & history ) ;
         void            QdRenderDiagnosticGrid() ;
         void            QdRenderParticleDiagnostics() ;
         void            QdRenderSummaryDiagnosticText() ;
@@ -175,6 +478,7 @@ class InteSiVis
         VECTOR< RbBox >                         mBoxes                      ;   ///< Box-shaped physical objects.
         VECTOR< Impulsion::PhysicalObject * >   mPhysicalObjects            ;   ///< Dynamic array of physical object addresses.
         size_t                                  mPhysObjFocus               ;   ///< Index info mPhysicalObjects that currently has user focus.
+        Impulsion::ContactSolver                mContactSolver              ;   ///< Resolves contacts between physical objects.
 
         ParticleSystemManager       mPclSysMgr                  ;   ///< Particle system manager.
         FluidVortonPclGrpInfo       mVortonPclGrpInfo           ;   ///< Fluid vorton particle system configuration
@@ -189,6 +493,11 @@ class InteSiVis
         VECTOR< QdLight >           mQdLights                   ;   ///< Lights for QD scene
         QdMaterial                  mBoundingBoxMaterial        ;   ///< Material used to render bounding box
         QdMaterial                  mPathlineMaterial           ;   ///< Material used to render pathlines
+        DiagnosticBatch             mGridCellsBatch             ;   ///< Lines of diagnostic grid cells
+        DiagnosticBatch             mGridPointsBatch            ;   ///< Lines and points of diagnostic gridpoints
+        DiagnosticBatch             mVortonDiagnosticBatch      ;   ///< Lines and points of vorton diagnostic vectors
+        DiagnosticBatch             mPathlineBatch              ;   ///< Lines of particle pathlines
+        PeGaSys::Render::OpenGL_TextBatch   mDiagnosticTextBatch ;  ///< Diagnostic text of grids, vortons and summary
 // END of members to remove
 
         VECTOR< Entity >            mEntities                   ;   ///< Simulation entities.
@@ -196,6 +505,8 @@ class InteSiVis
         LARGE_INTEGER               mSystemTimeBefore           ;   ///< System time at previous update
         float                       mFrameDurSecAvg             ;   ///< Average frame duration
         unsigned                    mFrame                      ;   ///< Frame counter
+        unsigned                    mNumStepsSimulated          ;   ///< Number of simulation steps since InitialConditions.  Unlike mFrame, this never decreases, so it stamps recorded input.
+        unsigned                    mNumScenariosBegun          ;   ///< Number of times InitialConditions ran, so input handling can tell whether an event began a scenario.
         double                      mTimeNow                    ;   ///< Current virtual time
         float                       mTimeStep                   ;   ///< Amount by which to increment virtual time
         float                       mTimeStepMin                ;   ///< Smallest time step taken
@@ -216,8 +527,95 @@ class InteSiVis
         DiagnosticTextE             mDiagnosticText             ;   ///< Which diagnostic text to render, if any.
         bool                        mEmphasizeCameraTarget      ;   ///< Whether to emphasize objects near the camera look-at location.
 
-    #if USE_TBB
-        tbb::task_scheduler_init tbb_init ;
+        Parallel::Executor          mParallelExecutor           ;   ///< Worker threads that run parallel work, configured from the environment unless the constructor says otherwise.
+
+    #if INTE_SI_VIS_GPU_VORTON_VELOCITY
+        VortonVelocityGpu           mVortonVelocityGpu          ;   ///< Evaluator of vorton velocity on the GPU.  Valid once rendering initializes, if the driver supports compute shaders.
+    #endif
+
+    #if INTE_SI_VIS_GPU_TRACERS
+        TracerAdvectionGpu          mTracerAdvectionGpu         ;   ///< Tracers that live on the GPU.  Valid once rendering initializes, if the driver supports compute shaders.
+    #endif
+
+    #if INTE_SI_VIS_GPU_ISOSURFACE
+        IsosurfaceExtractorGpu      mIsosurfaceExtractorGpu     ;   ///< Extractor and renderer of fluid isosurface on the GPU.  Valid once rendering initializes, if the driver supports compute shaders.
+    #endif
+
+    #if INTE_SI_VIS_VOLUME_RENDER
+        VolumeRendererGpu           mVolumeRendererGpu          ;   ///< Ray-marcher of flame, smoke and density grids.  Valid once rendering initializes, if the driver supports shaders and 3D textures.
+    #endif
+
+    #if INTE_SI_VIS_EXPORT_FRAME_SEQUENCE
+        FrameSequenceWriter         mFrameSequenceWriter        ;   ///< Exporter of simulated frames, for offline rendering.
+    #endif
+
+    #if INTE_SI_VIS_PLAYBACK_FRAME_SEQUENCE
+        FrameSequenceReader         mFrameSequenceReader        ;   ///< Player of recorded frames, which replaces simulation while it has a file open.
+    #endif
+
+    #if INTE_SI_VIS_REMOTE_VIEW_PORT && ! INTE_SI_VIS_REMOTE_VIEWER
+        RemoteViewServer            mRemoteViewServer           ;   ///< Streamer of simulated particles to a remote viewer.
+    #endif
+
+    #if INTE_SI_VIS_REMOTE_VIEWER
+        RemoteViewClient            mRemoteViewClient           ;   ///< Receiver of particles from a remote simulation, which replaces simulation while it has a connection.
+    #endif
+
+    #if INTE_SI_VIS_CAPTURE_FRAMES
+        PeGaSys::Render::OpenGL_FrameReadback   mFrameReadback  ;   ///< Ring of pixel buffers that read back rendered frames without stalling.
+        FrameCaptureWriter          mFrameCaptureWriter         ;   ///< Recorder of rendered frames, for making videos.
+        PeGaSys::Image              mCapturedFrame              ;   ///< Most recently read back frame.
+    #endif
+
+    #if INTE_SI_VIS_RECORD_INPUT
+        InputRecording              mInputRecording             ;   ///< Input events since the current scenario began.
+    #endif
+
+        /// Grids whose memory telemetry reports.
+        enum TelemetryGridE
+        {
+            TELEMETRY_GRID_VELOCITY         ,
+            TELEMETRY_GRID_DENSITY          ,
+            TELEMETRY_GRID_DENSITY_GRADIENT ,
+            TELEMETRY_GRID_SIGNED_DISTANCE  ,
+            NUM_TELEMETRY_GRIDS
+        } ;
+
+        Telemetry                   mTelemetry                  ;   ///< Metrics this application publishes each frame, and server that exports them.
+        Telemetry::MetricId         mTelemetryFrames            ;   ///< Counter of frames simulated.
+        Telemetry::MetricId         mTelemetryFrameMs           ;   ///< Gauge of average frame duration.
+        Telemetry::MetricId         mTelemetryVortons           ;   ///< Gauge of number of vortons.
+        Telemetry::MetricId         mTelemetryTracers           ;   ///< Gauge of number of tracers.
+        Telemetry::MetricId         mTelemetryStageMs[ VortonSim::NUM_UPDATE_STAGES ]  ;   ///< Gauges of duration of each vorton simulation stage.
+        Telemetry::MetricId         mTelemetryGridBytes[ NUM_TELEMETRY_GRIDS ]      ;   ///< Gauges of memory each grid uses.
+        Telemetry::MetricId         mTelemetryMemoryBytes[ MemoryBudget::NUM_SUBSYSTEMS ]       ;   ///< Gauges of memory each subsystem uses.
+        Telemetry::MetricId         mTelemetryMemoryCapBytes[ MemoryBudget::NUM_SUBSYSTEMS ]    ;   ///< Gauges of memory cap of each subsystem.
+        MemoryBudget                mMemoryBudget               ;   ///< Memory each subsystem uses, as of the most recent PublishTelemetry, and caps.
+    #if PROFILE
+        Telemetry::MetricId         mTelemetryVortonBodyHits    ;   ///< Counter of vorton collisions with rigid bodies.
+        Telemetry::MetricId         mTelemetryTracerBodyHits    ;   ///< Counter of tracer collisions with rigid bodies.
+    #endif
+
+    #if INTE_SI_VIS_PIPELINE_FRAMES || INTE_SI_VIS_FIXED_TIMESTEP
+        ParticleSystem              mRenderParticleSystem       ;   ///< Particle groups that hold particles from mRenderSnapshot, or interpolated from mFluidParticleSystem, which the fluid scene renders instead of mFluidParticleSystem.
+    #endif
+
+    #if INTE_SI_VIS_FIXED_TIMESTEP
+        FixedStepScheduler          mSimStepScheduler           ;   ///< Decides how many simulation steps each frame runs, and how far rendering interpolates past the most recent.
+        VECTOR< VECTOR< Vec3 > >    mPreviousPositionsPerGroup  ;   ///< Per fluid particle group, per particle identifier, position before the most recent step.
+    #endif
+
+    #if INTE_SI_VIS_PIPELINE_FRAMES
+        FrameSnapshotQueue          mFrameSnapshots             ;   ///< Snapshots circulating between simulation thread and main thread.
+        FrameSnapshot *             mRenderSnapshot             ;   ///< Snapshot the main thread renders, or NULL if none yet.
+    #if FRAME_SNAPSHOT_PACK_SIGNED_DISTANCE
+        UniformGrid< float >        mRenderSignedDistanceGrid   ;   ///< Signed distance grid decoded from mRenderSnapshot, from which fluid scene extracts isosurface.
+    #endif
+        HANDLE                      mSimulationThread           ;   ///< Thread that runs simulation steps.
+        HANDLE                      mSimulationStepRequested    ;   ///< Event that tells simulation thread to run a step.
+        volatile bool               mSimulationThreadQuit       ;   ///< Whether simulation thread should exit instead of running a step.
+        WORD                        mMainThreadFloatingPointControlWord ;   ///< Floating point control word for simulation thread to adopt.
+        unsigned                    mMainThreadMmxControlStatusRegister ;   ///< MXCSR for simulation thread to adopt.
     #endif
 } ;
 
@@ -0,0 +1,543 @@
+/** \file isosurfaceExtractorGpu.cpp
+
+    \brief Isosurface extraction that runs and draws entirely on the GPU, using OpenGL compute shaders.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "isosurfaceExtractorGpu.h"
+
+#include <Render/Resource/marchingCubes.h>
+
+#include <Render/Platform/OpenGL/OpenGL_Api.h>
+#include <Render/Platform/OpenGL/OpenGL_extensions.h>
+
+#include <Core/Performance/perfBlock.h>
+
+// Private variables --------------------------------------------------------------
+
+static const unsigned sClassifyGroupSize    = 4     ; ///< Must match local_size_x, y and z in sClassifySource.
+static const unsigned sReduceGroupSize      = 256   ; ///< Must match local_size_x in sReduceSource.
+static const unsigned sPyramidFanIn         = 8     ; ///< Number of elements of one pyramid level that each element of the next level sums.  Must match sReduceSource and sGenerateSource.
+static const unsigned sNumWordsPerVertex    = 6     ; ///< 32-bit words in GL_N3F_V3F: 3 normal coordinates, then 3 position coordinates.
+static const unsigned sNumIndirectWords     = 8     ; ///< 32-bit words in mIndirectBuffer: 4 for draw command, 3 for dispatch command, 1 for number of triangles.
+static const unsigned sDispatchCommandWord  = 4     ; ///< Index, in mIndirectBuffer, of first word of dispatch command.
+
+/** GLSL source of compute shader that finds configuration and number of triangles of each cell.
+
+    This classifies corners the same way CubeIndexOfCell does.
+*/
+static const char sClassifySource[] =
+    "#version 430\n"
+    "layout( local_size_x = 4 , local_size_y = 4 , local_size_z = 4 ) in ;\n"
+    "\n"
+    "layout( std430 , binding = 0 ) readonly  buffer TriangleTableBlock { int  triTable[] ; } ;\n"
+    "layout( std430 , binding = 1 ) writeonly buffer CubeIndexBlock     { uint cubeIndices[] ; } ;\n"
+    "layout( std430 , binding = 2 ) writeonly buffer PyramidBlock       { uint pyramid[] ; } ;\n"
+    "\n"
+    "uniform sampler3D uValues ;\n"
+    "uniform uvec3     uNumCells ;\n"
+    "uniform float     uIsoLevel ;\n"
+    "\n"
+    "uint InsideBit( ivec3 point , uint bit )\n"
+    "{\n"
+    "    return ( texelFetch( uValues , point , 0 ).r < uIsoLevel ) ? bit : 0u ;\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uvec3 cell = gl_GlobalInvocationID ;\n"
+    "    if( any( greaterThanEqual( cell , uNumCells ) ) )\n"
+    "    {\n"
+    "        return ;\n"
+    "    }\n"
+    "    ivec3 corner    = ivec3( cell ) ;\n"
+    "    uint  cubeIndex = InsideBit( corner + ivec3( 0 , 0 , 0 ) ,   1u )\n"
+    "                    | InsideBit( corner + ivec3( 1 , 0 , 0 ) ,   2u )\n"
+    "                    | InsideBit( corner + ivec3( 1 , 1 , 0 ) ,   4u )\n"
+    "                    | InsideBit( corner + ivec3( 0 , 1 , 0 ) ,   8u )\n"
+    "                    | InsideBit( corner + ivec3( 0 , 0 , 1 ) ,  16u )\n"
+    "                    | InsideBit( corner + ivec3( 1 , 0 , 1 ) ,  32u )\n"
+    "                    | InsideBit( corner + ivec3( 1 , 1 , 1 ) ,  64u )\n"
+    "                    | InsideBit( corner + ivec3( 0 , 1 , 1 ) , 128u ) ;\n"
+    "    uint  numTriangles = 0u ;\n"
+    "    while( triTable[ cubeIndex * 16u + numTriangles * 3u ] != -1 )\n"
+    "    {\n"
+    "        ++ numTriangles ;\n"
+    "    }\n"
+    "    uint  offset    = cell.x + uNumCells.x * ( cell.y + uNumCells.y * cell.z ) ;\n"
+    "    cubeIndices[ offset ] = cubeIndex ;\n"
+    "    pyramid    [ offset ] = numTriangles ;\n"
+    "}\n"
+    ;
+
+/** GLSL source of compute shader that sums groups of 8 elements of one histogram pyramid level into the next level.
+*/
+static const char sReduceSource[] =
+    "#version 430\n"
+    "layout( local_size_x = 256 ) in ;\n"
+    "\n"
+    "layout( std430 , binding = 2 ) buffer PyramidBlock { uint pyramid[] ; } ;\n"
+    "\n"
+    "uniform uint uInputOffset ;\n"
+    "uniform uint uInputCount ;\n"
+    "uniform uint uOutputOffset ;\n"
+    "uniform uint uOutputCount ;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint iOutput = gl_GlobalInvocationID.x ;\n"
+    "    if( iOutput >= uOutputCount )\n"
+    "    {\n"
+    "        return ;\n"
+    "    }\n"
+    "    uint first = iOutput * 8u ;\n"
+    "    uint last  = min( first + 8u , uInputCount ) ;\n"
+    "    uint sum   = 0u ;\n"
+    "    for( uint iInput = first ; iInput < last ; ++ iInput )\n"
+    "    {\n"
+    "        sum += pyramid[ uInputOffset + iInput ] ;\n"
+    "    }\n"
+    "    pyramid[ uOutputOffset + iOutput ] = sum ;\n"
+    "}\n"
+    ;
+
+/** GLSL source of compute shader that writes indirect draw and dispatch commands from the total at the top of the histogram pyramid.
+
+    Words 0-3 are a DrawArraysIndirectCommand, words 4-6 a DispatchIndirectCommand
+    with 64 triangles per work group, and word 7 the number of triangles.
+*/
+static const char sFinishSource[] =
+    "#version 430\n"
+    "layout( local_size_x = 1 ) in ;\n"
+    "\n"
+    "layout( std430 , binding = 2 ) readonly  buffer PyramidBlock  { uint pyramid[] ; } ;\n"
+    "layout( std430 , binding = 3 ) writeonly buffer IndirectBlock { uint commands[ 8 ] ; } ;\n"
+    "\n"
+    "uniform uint uTopOffset ;\n"
+    "uniform uint uMaxTriangles ;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint numTriangles = min( pyramid[ uTopOffset ] , uMaxTriangles ) ;\n"
+    "    commands[ 0 ] = numTriangles * 3u ;\n"
+    "    commands[ 1 ] = 1u ;\n"
+    "    commands[ 2 ] = 0u ;\n"
+    "    commands[ 3 ] = 0u ;\n"
+    "    commands[ 4 ] = ( numTriangles + 63u ) / 64u ;\n"
+    "    commands[ 5 ] = 1u ;\n"
+    "    commands[ 6 ] = 1u ;\n"
+    "    commands[ 7 ] = numTriangles ;\n"
+    "}\n"
+    ;
+
+/** GLSL source of compute shader that writes vertices of each isosurface triangle.
+
+    Each invocation descends the histogram pyramid to find which cell, and which
+    triangle of that cell, it owns.  Vertex positions interpolate along cell
+    edges, as VertexInterp does, and normals interpolate gradients at edge
+    endpoints, as NumberIsoSurfaceVerticesInLayer does, using the same
+    differences as GridGradientAtPoint.  Triangles wind the same way as
+    PolygoniseCellWithNormal.
+*/
+static const char sGenerateSource[] =
+    "#version 430\n"
+    "layout( local_size_x = 64 ) in ;\n"
+    "\n"
+    "layout( std430 , binding = 0 ) readonly  buffer TriangleTableBlock { int   triTable[] ; } ;\n"
+    "layout( std430 , binding = 1 ) readonly  buffer CubeIndexBlock     { uint  cubeIndices[] ; } ;\n"
+    "layout( std430 , binding = 2 ) readonly  buffer PyramidBlock       { uint  pyramid[] ; } ;\n"
+    "layout( std430 , binding = 3 ) readonly  buffer IndirectBlock      { uint  commands[ 8 ] ; } ;\n"
+    "layout( std430 , binding = 4 ) readonly  buffer LevelBlock         { uvec2 levels[] ; } ;\n"
+    "layout( std430 , binding = 5 ) writeonly buffer VertexBlock        { float vertexFloats[] ; } ;\n"
+    "\n"
+    "uniform sampler3D uValues ;\n"
+    "uniform uvec3     uNumCells ;\n"
+    "uniform uint      uNumLevels ;\n"
+    "uniform vec3      uMinCorner ;\n"
+    "uniform vec3      uCellSpacing ;\n"
+    "uniform float     uIsoLevel ;\n"
+    "\n"
+    "// Corner offset (xyz) and axis (w) of each cell edge, as sCellEdges in marchingCubes.cpp.\n"
+    "const ivec4 sCellEdges[ 12 ] = ivec4[ 12 ](\n"
+    "    ivec4( 0 , 0 , 0 , 0 ) , ivec4( 1 , 0 , 0 , 1 ) , ivec4( 0 , 1 , 0 , 0 ) , ivec4( 0 , 0 , 0 , 1 ) ,\n"
+    "    ivec4( 0 , 0 , 1 , 0 ) , ivec4( 1 , 0 , 1 , 1 ) , ivec4( 0 , 1 , 1 , 0 ) , ivec4( 0 , 0 , 1 , 1 ) ,\n"
+    "    ivec4( 0 , 0 , 0 , 2 ) , ivec4( 1 , 0 , 0 , 2 ) , ivec4( 1 , 1 , 0 , 2 ) , ivec4( 0 , 1 , 0 , 2 ) ) ;\n"
+    "\n"
+    "float ValueAt( ivec3 point )\n"
+    "{\n"
+    "    return texelFetch( uValues , point , 0 ).r ;\n"
+    "}\n"
+    "\n"
+    "vec3 GradientAt( ivec3 point )\n"
+    "{\n"
+    "    ivec3 numPoints = ivec3( uNumCells ) + ivec3( 1 ) ;\n"
+    "    vec3  gradient ;\n"
+    "    for( int axis = 0 ; axis < 3 ; ++ axis )\n"
+    "    {\n"
+    "        ivec3 axisStep   = ivec3( 0 ) ;\n"
+    "        axisStep[ axis ] = 1 ;\n"
+    "        bool  hasMinus   = point[ axis ] > 0 ;\n"
+    "        bool  hasPlus    = point[ axis ] + 1 < numPoints[ axis ] ;\n"
+    "        float valueMinus = ValueAt( hasMinus ? point - axisStep : point ) ;\n"
+    "        float valuePlus  = ValueAt( hasPlus  ? point + axisStep : point ) ;\n"
+    "        float numSpans   = float( int( hasMinus ) + int( hasPlus ) ) ;\n"
+    "        gradient[ axis ] = ( valuePlus - valueMinus ) / ( numSpans * uCellSpacing[ axis ] ) ;\n"
+    "    }\n"
+    "    return gradient ;\n"
+    "}\n"
+    "\n"
+    "void WriteVertex( uint iVert , ivec3 cell , int edge )\n"
+    "{\n"
+    "    ivec4 cellEdge  = sCellEdges[ edge ] ;\n"
+    "    ivec3 axisStep  = ivec3( 0 ) ;\n"
+    "    axisStep[ cellEdge.w ] = 1 ;\n"
+    "    ivec3 point0    = cell + cellEdge.xyz ;\n"
+    "    ivec3 point1    = point0 + axisStep ;\n"
+    "    float value0    = ValueAt( point0 ) ;\n"
+    "    float value1    = ValueAt( point1 ) ;\n"
+    "    float tween     = clamp( ( uIsoLevel - value0 ) / ( value1 - value0 ) , 0.0 , 1.0 ) ;\n"
+    "    vec3  position  = uMinCorner + ( vec3( point0 ) + tween * vec3( axisStep ) ) * uCellSpacing ;\n"
+    "    // Values increase outward (e.g. signed distance) so the gradient points away from the interior.\n"
+    "    vec3  normal    = normalize( mix( GradientAt( point0 ) , GradientAt( point1 ) , tween ) ) ;\n"
+    "    uint  iFloat    = iVert * 6u ;\n"
+    "    vertexFloats[ iFloat     ] = normal.x ;\n"
+    "    vertexFloats[ iFloat + 1 ] = normal.y ;\n"
+    "    vertexFloats[ iFloat + 2 ] = normal.z ;\n"
+    "    vertexFloats[ iFloat + 3 ] = position.x ;\n"
+    "    vertexFloats[ iFloat + 4 ] = position.y ;\n"
+    "    vertexFloats[ iFloat + 5 ] = position.z ;\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint iTriangle = gl_GlobalInvocationID.x ;\n"
+    "    if( iTriangle >= commands[ 7 ] )\n"
+    "    {\n"
+    "        return ;\n"
+    "    }\n"
+    "    // Descend pyramid from its single top element to the cell that owns this triangle.\n"
+    "    uint remainder = iTriangle ;\n"
+    "    uint index     = 0u ;\n"
+    "    for( int level = int( uNumLevels ) - 2 ; level >= 0 ; -- level )\n"
+    "    {\n"
+    "        uvec2 offsetAndCount = levels[ level ] ;\n"
+    "        uint  first          = index * 8u ;\n"
+    "        uint  last           = min( first + 8u , offsetAndCount.y ) ;\n"
+    "        index = first ;\n"
+    "        for( uint child = first ; child < last ; ++ child )\n"
+    "        {\n"
+    "            uint count = pyramid[ offsetAndCount.x + child ] ;\n"
+    "            if( remainder < count )\n"
+    "            {\n"
+    "                index = child ;\n"
+    "                break ;\n"
+    "            }\n"
+    "            remainder -= count ;\n"
+    "        }\n"
+    "    }\n"
+    "    ivec3 cell      = ivec3( index % uNumCells.x , ( index / uNumCells.x ) % uNumCells.y , index / ( uNumCells.x * uNumCells.y ) ) ;\n"
+    "    uint  iEdge     = cubeIndices[ index ] * 16u + remainder * 3u ;\n"
+    "    uint  iVert     = iTriangle * 3u ;\n"
+    "    WriteVertex( iVert      , cell , triTable[ iEdge + 1u ] ) ;\n"
+    "    WriteVertex( iVert + 1u , cell , triTable[ iEdge      ] ) ;\n"
+    "    WriteVertex( iVert + 2u , cell , triTable[ iEdge + 2u ] ) ;\n"
+    "}\n"
+    ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct isosurface extractor that runs on the GPU.
+
+    \note This does not touch OpenGL, so it can run before a render context exists.  Call Initialize after.
+*/
+IsosurfaceExtractorGpu::IsosurfaceExtractorGpu()
+    : mValuesTextureName( 0 )
+    , mNumCells( 0 )
+    , mMaxTriangles( 0 )
+    , mHasSurface( false )
+{
+    mNumPoints[ 0 ] = mNumPoints[ 1 ] = mNumPoints[ 2 ] = 0 ;
+}
+
+
+
+
+IsosurfaceExtractorGpu::~IsosurfaceExtractorGpu()
+{
+    if( mValuesTextureName )
+    {
+        glDeleteTextures( 1 , & mValuesTextureName ) ;
+    }
+}
+
+
+
+
+/** Compile compute shaders and allocate GPU memory for isosurface triangles.
+
+    \param maxTriangles Number of triangles the vertex buffer holds.  Extract drops triangles beyond that.
+
+    \return Whether the OpenGL driver supports compute shaders, 3D textures and
+            indirect drawing, and the shaders compiled.  When this returns
+            false, the caller should extract isosurfaces on the CPU.
+
+    \note This requires a current OpenGL context, after OpenGL_Extensions::GetProcAddresses.
+*/
+bool IsosurfaceExtractorGpu::Initialize( size_t maxTriangles )
+{
+    PERF_BLOCK( IsosurfaceExtractorGpu__Initialize ) ;
+
+    ASSERT( maxTriangles > 0 ) ;
+
+    if(     ! PeGaSys::Render::OpenGL_ComputeShader::IsSupported()
+        ||  ! glTexImage3D || ! glTexSubImage3D || ! glActiveTexture || ! glUniform1i
+        ||  ! glDispatchComputeIndirect || ! glDrawArraysIndirect )
+    {   // Driver lacks OpenGL 4.3.
+        return false ;
+    }
+
+    if(     ! mClassifyShader.Compile( sClassifySource )
+        ||  ! mReduceShader.Compile( sReduceSource )
+        ||  ! mFinishShader.Compile( sFinishSource )
+        ||  ! mGenerateShader.Compile( sGenerateSource ) )
+    {
+        mClassifyShader.Deallocate() ;
+        mReduceShader.Deallocate() ;
+        mFinishShader.Deallocate() ;
+        mGenerateShader.Deallocate() ;
+        return false ;
+    }
+
+    mMaxTriangles = maxTriangles ;
+    mTriangleTableBuffer.Upload( PeGaSys::Render::triTable , sizeof( PeGaSys::Render::triTable ) ) ;
+    mVertexBuffer.Allocate( mMaxTriangles * 3 * sNumWordsPerVertex * sizeof( GLuint ) ) ;
+    {   // Start with commands that draw and dispatch nothing.
+        const GLuint noCommands[ sNumIndirectWords ] = { 0 , 1 , 0 , 0 , 0 , 1 , 1 , 0 } ;
+        mIndirectBuffer.Upload( noCommands , sizeof( noCommands ) ) ;
+    }
+
+    glGenTextures( 1 , & mValuesTextureName ) ;
+    glBindTexture( GL_TEXTURE_3D , mValuesTextureName ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_MIN_FILTER , GL_NEAREST ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_MAG_FILTER , GL_NEAREST ) ;
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+
+    return ! RENDER_CHECK_ERROR( IsosurfaceExtractorGpu_Initialize ) ;
+}
+
+
+
+
+/** Copy grid values into 3D texture, reallocating it if the number of grid points changed.
+*/
+void IsosurfaceExtractorGpu::UploadValues( const UniformGrid< float > & gridOfValues )
+{
+    PERF_BLOCK( IsosurfaceExtractorGpu__UploadValues ) ;
+
+    glBindTexture( GL_TEXTURE_3D , mValuesTextureName ) ;
+    glPixelStorei( GL_UNPACK_ALIGNMENT , 4 ) ;
+    if(     ( gridOfValues.GetNumPoints( 0 ) != mNumPoints[ 0 ] )
+        ||  ( gridOfValues.GetNumPoints( 1 ) != mNumPoints[ 1 ] )
+        ||  ( gridOfValues.GetNumPoints( 2 ) != mNumPoints[ 2 ] ) )
+    {   // Grid changed shape.
+        mNumPoints[ 0 ] = gridOfValues.GetNumPoints( 0 ) ;
+        mNumPoints[ 1 ] = gridOfValues.GetNumPoints( 1 ) ;
+        mNumPoints[ 2 ] = gridOfValues.GetNumPoints( 2 ) ;
+        glTexImage3D( GL_TEXTURE_3D , 0 , GL_R32F , mNumPoints[ 0 ] , mNumPoints[ 1 ] , mNumPoints[ 2 ] , 0 , GL_RED , GL_FLOAT , gridOfValues.Data() ) ;
+    }
+    else
+    {
+        glTexSubImage3D( GL_TEXTURE_3D , 0 , 0 , 0 , 0 , mNumPoints[ 0 ] , mNumPoints[ 1 ] , mNumPoints[ 2 ] , GL_RED , GL_FLOAT , gridOfValues.Data() ) ;
+    }
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+    RENDER_CHECK_ERROR( IsosurfaceExtractorGpu_UploadValues ) ;
+}
+
+
+
+
+/** Lay out levels of histogram pyramid for the given number of cells, and allocate GPU memory for them.
+
+    Level 0 holds the number of triangles in each cell.  Each element of each
+    higher level holds the sum of sPyramidFanIn elements of the level below,
+    up to the top level, which has a single element: the total number of
+    triangles.
+*/
+void IsosurfaceExtractorGpu::AllocatePyramid( size_t numCells )
+{
+    PERF_BLOCK( IsosurfaceExtractorGpu__AllocatePyramid ) ;
+
+    ASSERT( numCells > 0 ) ;
+
+    mNumCells = numCells ;
+    mLevels.Clear() ;
+    size_t offset = 0 ;
+    size_t count  = numCells ;
+    while( true )
+    {   // For each level, finest first...
+        mLevels.PushBack( static_cast< unsigned >( offset ) ) ;
+        mLevels.PushBack( static_cast< unsigned >( count  ) ) ;
+        offset += count ;
+        if( 1 == count )
+        {   // Reached top.
+            break ;
+        }
+        count = ( count + sPyramidFanIn - 1 ) / sPyramidFanIn ;
+    }
+    ASSERT( mLevels.Size() / 2 <= MAX_PYRAMID_LEVELS ) ;
+
+    mCubeIndexBuffer.Allocate( numCells * sizeof( GLuint ) ) ;
+    mPyramidBuffer.Allocate( offset * sizeof( GLuint ) ) ;
+    mLevelBuffer.Upload( mLevels.Data() , mLevels.Size() * sizeof( unsigned ) ) ;
+}
+
+
+
+
+/** Extract isosurface from the given grid, on the GPU, into a vertex buffer that Render draws.
+
+    \param gridOfValues Uniform grid of values, such as signed distance.  This uploads only this grid.
+
+    \param isoLevel     Value that the isosurface has, as in Mesh_MakeFromVolume.
+*/
+void IsosurfaceExtractorGpu::Extract( const UniformGrid< float > & gridOfValues , float isoLevel )
+{
+    PERF_BLOCK( IsosurfaceExtractorGpu__Extract ) ;
+
+    if( ! IsValid() || gridOfValues.HasZeroExtent() || gridOfValues.Empty() )
+    {
+        return ;
+    }
+
+    UploadValues( gridOfValues ) ;
+
+    const unsigned  numCells[ 3 ]   = { mNumPoints[ 0 ] - 1 , mNumPoints[ 1 ] - 1 , mNumPoints[ 2 ] - 1 } ;
+    const size_t    numCellsTotal   = size_t( numCells[ 0 ] ) * numCells[ 1 ] * numCells[ 2 ] ;
+    if( 0 == numCellsTotal )
+    {   // Grid is too thin to have cells.
+        return ;
+    }
+    if( numCellsTotal != mNumCells )
+    {
+        AllocatePyramid( numCellsTotal ) ;
+    }
+
+    const GLuint numLevels = static_cast< GLuint >( mLevels.Size() / 2 ) ;
+
+    glActiveTexture( GL_TEXTURE0 ) ;
+    glBindTexture( GL_TEXTURE_3D , mValuesTextureName ) ;
+    mTriangleTableBuffer.BindBase( 0 ) ;
+    mCubeIndexBuffer.BindBase( 1 ) ;
+    mPyramidBuffer.BindBase( 2 ) ;
+    mIndirectBuffer.BindBase( 3 ) ;
+    mLevelBuffer.BindBase( 4 ) ;
+    mVertexBuffer.BindBase( 5 ) ;
+
+    {   // Classify cells.
+        PERF_BLOCK( IsosurfaceExtractorGpu__Extract_Classify ) ;
+        mClassifyShader.Use() ;
+        glUniform1i ( mClassifyShader.GetUniformLocation( "uValues"   ) , 0 ) ;
+        glUniform3ui( mClassifyShader.GetUniformLocation( "uNumCells" ) , numCells[ 0 ] , numCells[ 1 ] , numCells[ 2 ] ) ;
+        glUniform1f ( mClassifyShader.GetUniformLocation( "uIsoLevel" ) , isoLevel ) ;
+        mClassifyShader.Dispatch(   ( numCells[ 0 ] + sClassifyGroupSize - 1 ) / sClassifyGroupSize
+                                ,   ( numCells[ 1 ] + sClassifyGroupSize - 1 ) / sClassifyGroupSize
+                                ,   ( numCells[ 2 ] + sClassifyGroupSize - 1 ) / sClassifyGroupSize
+                                ,   GL_SHADER_STORAGE_BARRIER_BIT ) ;
+    }
+
+    {   // Build histogram pyramid, one level per dispatch, since each level reads the one below.
+        PERF_BLOCK( IsosurfaceExtractorGpu__Extract_Reduce ) ;
+        mReduceShader.Use() ;
+        for( GLuint level = 1 ; level < numLevels ; ++ level )
+        {   // For each level above the finest...
+            const GLuint outputCount = mLevels[ level * 2 + 1 ] ;
+            glUniform1ui( mReduceShader.GetUniformLocation( "uInputOffset"  ) , mLevels[ level * 2 - 2 ] ) ;
+            glUniform1ui( mReduceShader.GetUniformLocation( "uInputCount"   ) , mLevels[ level * 2 - 1 ] ) ;
+            glUniform1ui( mReduceShader.GetUniformLocation( "uOutputOffset" ) , mLevels[ level * 2     ] ) ;
+            glUniform1ui( mReduceShader.GetUniformLocation( "uOutputCount"  ) , outputCount ) ;
+            mReduceShader.Dispatch( ( outputCount + sReduceGroupSize - 1 ) / sReduceGroupSize , 1 , 1 , GL_SHADER_STORAGE_BARRIER_BIT ) ;
+        }
+    }
+
+    {   // Turn total number of triangles into commands, without the CPU reading it.
+        PERF_BLOCK( IsosurfaceExtractorGpu__Extract_Finish ) ;
+        mFinishShader.Use() ;
+        glUniform1ui( mFinishShader.GetUniformLocation( "uTopOffset"    ) , mLevels[ ( numLevels - 1 ) * 2 ] ) ;
+        glUniform1ui( mFinishShader.GetUniformLocation( "uMaxTriangles" ) , static_cast< GLuint >( mMaxTriangles ) ) ;
+        mFinishShader.Dispatch( 1 , 1 , 1 , GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT ) ;
+    }
+
+    {   // Write vertices of each triangle.
+        PERF_BLOCK( IsosurfaceExtractorGpu__Extract_Generate ) ;
+        const Vec3 & vMinCorner   = gridOfValues.GetMinCorner() ;
+        const Vec3 & vCellSpacing = gridOfValues.GetCellSpacing() ;
+        mGenerateShader.Use() ;
+        glUniform1i ( mGenerateShader.GetUniformLocation( "uValues"      ) , 0 ) ;
+        glUniform3ui( mGenerateShader.GetUniformLocation( "uNumCells"    ) , numCells[ 0 ] , numCells[ 1 ] , numCells[ 2 ] ) ;
+        glUniform1ui( mGenerateShader.GetUniformLocation( "uNumLevels"   ) , numLevels ) ;
+        glUniform3f ( mGenerateShader.GetUniformLocation( "uMinCorner"   ) , vMinCorner.x , vMinCorner.y , vMinCorner.z ) ;
+        glUniform3f ( mGenerateShader.GetUniformLocation( "uCellSpacing" ) , vCellSpacing.x , vCellSpacing.y , vCellSpacing.z ) ;
+        glUniform1f ( mGenerateShader.GetUniformLocation( "uIsoLevel"    ) , isoLevel ) ;
+        mGenerateShader.DispatchIndirect( mIndirectBuffer.GetBufferName() , sDispatchCommandWord * sizeof( GLuint ) , GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT ) ;
+    }
+
+    glUseProgram( 0 ) ;
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+    mHasSurface = true ;
+}
+
+
+
+
+/** Draw isosurface that Extract most recently wrote, without the CPU reading how many triangles it has.
+
+    This shades with fixed-function lighting, from a light at the camera.
+
+    \note This draws in world space, so call this after setting the camera, for example with QdCamera::SetCamera.
+*/
+void IsosurfaceExtractorGpu::Render()
+{
+    PERF_BLOCK( IsosurfaceExtractorGpu__Render ) ;
+
+    if( ! IsValid() || ! mHasSurface )
+    {
+        return ;
+    }
+
+    glPushAttrib( GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_CURRENT_BIT ) ;
+    glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT ) ;
+
+    glDisable( GL_TEXTURE_2D ) ;
+    glDisable( GL_BLEND ) ;
+    glDisable( GL_CULL_FACE ) ;
+    glEnable( GL_DEPTH_TEST ) ;
+    glEnable( GL_LIGHTING ) ;
+    glEnable( GL_LIGHT0 ) ;
+    glEnable( GL_COLOR_MATERIAL ) ;
+    {   // Place light at camera.  OpenGL transforms light position by the modelview matrix, so set it in view space.
+        const GLfloat lightDirection[ 4 ] = { 0.0f , 0.0f , 1.0f , 0.0f } ;
+        glMatrixMode( GL_MODELVIEW ) ;
+        glPushMatrix() ;
+        glLoadIdentity() ;
+        glLightfv( GL_LIGHT0 , GL_POSITION , lightDirection ) ;
+        glPopMatrix() ;
+    }
+    glColor4f( 0.3f , 0.5f , 0.9f , 1.0f ) ;
+
+    glBindBuffer( GL_ARRAY_BUFFER , mVertexBuffer.GetBufferName() ) ;
+    glInterleavedArrays( GL_N3F_V3F , 0 , 0 ) ;
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER , mIndirectBuffer.GetBufferName() ) ;
+    glDrawArraysIndirect( GL_TRIANGLES , 0 ) ;
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER , 0 ) ;
+    glBindBuffer( GL_ARRAY_BUFFER , 0 ) ;
+
+    glPopClientAttrib() ;
+    glPopAttrib() ;
+    RENDER_CHECK_ERROR( IsosurfaceExtractorGpu_Render ) ;
+}
@@ -0,0 +1,90 @@
+/** \file isosurfaceExtractorGpu.h
+
+    \brief Isosurface extraction that runs and draws entirely on the GPU, using OpenGL compute shaders.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef ISOSURFACE_EXTRACTOR_GPU_H
+#define ISOSURFACE_EXTRACTOR_GPU_H
+
+#include <Render/Platform/OpenGL/OpenGL_computeShader.h>
+
+#include <Core/SpatialPartition/uniformGrid.h>
+#include <Core/Containers/vector.h>
+
+// Types --------------------------------------------------------------
+
+/** Isosurface extraction that runs and draws entirely on the GPU, using OpenGL 4.3 compute shaders.
+
+    This does what Mesh_MakeFromVolume does on the CPU, with marching cubes
+    compacted through a histogram pyramid:
+
+    -   Extract uploads grid values into a 3D texture.  That is the only data
+        that crosses the bus.
+
+    -   A classification pass finds which corners of each cell lie inside the
+        isosurface, and how many triangles the cell therefore generates.
+
+    -   Reduction passes build a histogram pyramid: each level sums groups of
+        8 counts from the level below, until one element holds the total.
+
+    -   A generation pass runs one invocation per triangle.  Each invocation
+        descends the pyramid to find which cell, and which of its triangles,
+        it owns, then writes that triangle's vertices into a vertex buffer,
+        with normals interpolated from grid gradients, as
+        NumberIsoSurfaceVerticesInLayer computes them.
+
+    The GPU writes the number of triangles into indirect dispatch and draw
+    commands, so the CPU never waits to read how many triangles there are.
+    Render draws that vertex buffer in place.
+
+    Every method requires that the OpenGL context that created this object be
+    current on the calling thread.
+*/
+class IsosurfaceExtractorGpu
+{
+    public:
+        IsosurfaceExtractorGpu() ;
+        ~IsosurfaceExtractorGpu() ;
+
+        bool    Initialize( size_t maxTriangles ) ;
+
+        /// Return whether Initialize succeeded, i.e. whether this can extract and render isosurfaces.
+        bool    IsValid() const { return mClassifyShader.IsValid() && mReduceShader.IsValid() && mFinishShader.IsValid() && mGenerateShader.IsValid() ; }
+
+        void    Extract( const UniformGrid< float > & gridOfValues , float isoLevel ) ;
+        void    Render() ;
+
+    private:
+        static const unsigned MAX_PYRAMID_LEVELS = 16 ; ///< Maximum number of levels in histogram pyramid, which suffices for 8^15 cells.
+
+        IsosurfaceExtractorGpu( const IsosurfaceExtractorGpu & ) ;              // Disallow copy
+        IsosurfaceExtractorGpu & operator=( const IsosurfaceExtractorGpu & ) ;  // Disallow assignment
+
+        void    UploadValues( const UniformGrid< float > & gridOfValues ) ;
+        void    AllocatePyramid( size_t numCells ) ;
+
+        PeGaSys::Render::OpenGL_ComputeShader       mClassifyShader     ;   ///< Program that computes configuration and number of triangles of each cell.
+        PeGaSys::Render::OpenGL_ComputeShader       mReduceShader       ;   ///< Program that sums groups of 8 elements of one pyramid level into the next.
+        PeGaSys::Render::OpenGL_ComputeShader       mFinishShader       ;   ///< Program that writes indirect dispatch and draw commands from the pyramid total.
+        PeGaSys::Render::OpenGL_ComputeShader       mGenerateShader     ;   ///< Program that writes vertices of each triangle.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mTriangleTableBuffer;   ///< GPU copy of triTable.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mCubeIndexBuffer    ;   ///< Configuration of corners inside the isosurface, per cell.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mPyramidBuffer      ;   ///< Every level of histogram pyramid, finest (triangles per cell) first.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mLevelBuffer        ;   ///< Offset into mPyramidBuffer, and number of elements, of each pyramid level.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mIndirectBuffer     ;   ///< Indirect draw command for Render, followed by indirect dispatch command for generation pass.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mVertexBuffer       ;   ///< Isosurface vertices, as normal then position, in GL_N3F_V3F layout, which Render draws.
+        VECTOR< unsigned >                          mLevels             ;   ///< CPU copy of mLevelBuffer, as offset then number of elements, per level.
+        GLuint                                      mValuesTextureName  ;   ///< Identifier of 3D texture holding grid values.
+        unsigned                                    mNumPoints[ 3 ]     ;   ///< Number of grid points along each axis, which mValuesTextureName holds.
+        size_t                                      mNumCells           ;   ///< Number of cells that mPyramidBuffer spans.
+        size_t                                      mMaxTriangles       ;   ///< Capacity of mVertexBuffer, in triangles.
+        bool                                        mHasSurface         ;   ///< Whether Extract has run since Initialize, so mVertexBuffer and mIndirectBuffer hold something to draw.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -8,8 +8,11 @@
 */
 
 #include "inteSiVis.h"
+#include "benchmark.h"
+#include "microbenchmark.h"
 
 #include "Core/Performance/perfBlock.h"
+#include "Core/File/asyncLog.h"
 
 #include "Render/Platform/OpenGL/OpenGL_api.h"
 
@@ -37,9 +40,13 @@ static time_t sStartTime = 0 ;  // Time when process started.  Used to disambigu
 
 static void AtExitHandler()
 {
+    AsyncLog::Stop() ;  // Write pending log messages, so they precede any written while exiting.
 #if PROFILE
     printf( "Terminated: built " __DATE__ " " __TIME__ " ran %i\n\n" , sStartTime ) ;
 #endif
+#if PERF_SAMPLING
+    PerfSampler::WriteFoldedStacks( "perfSamples.txt" ) ;   // Feed to a flame graph tool.
+#endif
 }
 
 
@@ -84,15 +91,30 @@ int main( int argc , char ** argv )
 {
     char mainPerfBlockName[ 256 ] ;
     SetUpLogFiles( mainPerfBlockName , argv ) ;
+    AsyncLog::Start() ; // Format and write log messages on a background thread, so threads that log do not wait.
     PERF_BLOCK_MAIN( mainPerfBlockName ) ;  // Must have exactly one PERF_BLOCK_MAIN per thread.
 
     atexit( AtExitHandler ) ;
 
+#if PERF_SAMPLING
+    PerfSampler::Start( PERF_SAMPLE_DEFAULT_RATE ) ;
+#endif
+
     // Set floating-point unit options to ensure speed and consistency.
     XMM_Set_FlushToZero_DenormalAreZero() ;
     Setx87Precision( PRECISION_SINGLE ) ;
     //Unmaskx87FpExceptions() ;
 
+    if( Benchmark_IsRequested( argc , argv ) )
+    {   // Run stock scenarios headless and report timings, instead of running interactively.
+        return Benchmark_Main( argc , argv ) ;
+    }
+
+    if( Microbenchmark_IsRequested( argc , argv ) )
+    {   // Time individual kernels headless and report statistics, instead of running interactively.
+        return Microbenchmark_Main( argc , argv ) ;
+    }
+
     PeGaSys::Render::ApiBase * renderApi = NEW PeGaSys::Render::OpenGL_Api ;
 
     glutInit( & argc , argv ) ;
@@ -0,0 +1,597 @@
+/** \file microbenchmark.cpp
+
+    \brief Headless microbenchmark that measures throughput of individual kernels, reusing the setup of unit tests.
+
+    Run "VorteGrid -microbenchmark" to time each of the following kernels in
+    isolation, then report statistics of their durations as CSV, one row per
+    kernel:
+
+        Interpolate         UniformGrid::Interpolate at random query points.
+        Accumulate          UniformGrid::Accumulate at random query points.
+        DownSample          UniformGrid::DownSample from a grid into its decimation by 2.
+        RedBlackSweep       One red-black Gauss-Seidel sweep of SolveVectorPoisson.
+        MarchingCubes       Isosurface extraction from the signed distance field of a sphere.
+        BiotSavartPairs     Velocity due to each vorton at each other vorton, by direct summation.
+
+    Options:
+
+        -repeats N          Time each kernel N times, after one untimed warm-up run.
+        -gridpoints N       Use about N gridpoints in grid kernels.
+        -queries N          Use N query points for Interpolate and Accumulate.
+        -vortons N          Evaluate Biot-Savart for N vortons, i.e. N^2 pairs.
+        -isogrid N          Extract the isosurface from a grid with N points along each axis.
+        -threads N          Run parallel kernels with N threads.
+        -out filename       Write CSV to the given file instead of stdout.
+
+    Grid kernels reuse the test function that UniformGrid::UnitTest and
+    NestedGrid::UnitTest use (UniformGrid_AssignTestValues), and marching cubes
+    reuses the sphere that its demonstrations use, so inputs match those that
+    the unit tests already check for correctness.
+
+    Each row reports the minimum, median, mean and standard deviation of the
+    duration of each run, and throughput in items per second, based on the
+    median.  Each row also reports a checksum of kernel output, so a change
+    meant only to speed up a kernel can be checked for changing its results.
+
+    Pseudo-random inputs come from an identically seeded generator, so runs
+    are repeatable and comparable across builds.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "microbenchmark.h"
+
+#include "Core/SpatialPartition/uniformGrid.h"
+#include "Core/SpatialPartition/uniformGridMath.h"
+#include "Core/Performance/timer.h"
+#include "Core/Performance/perfBlock.h"
+#include "Core/parallelExecution.h"
+
+#include "Render/Resource/marchingCubes.h"
+
+#include "VortonFluid/vorton.h"
+
+#include <algorithm>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const Vec3 sGridRange( 2.0f , 3.0f , 5.0f ) ;    ///< Size of domain of grid kernels, the same as NestedGrid::UnitTest uses.
+
+// Types --------------------------------------------------------------
+
+/** Common state of kernels that operate on a UniformGrid of Vec3 values at random query points.
+*/
+class GridQueryKernelBase
+{
+    protected:
+        GridQueryKernelBase( const MicrobenchmarkSettings & settings )
+            : mChecksum( 0.0 )
+        {
+            const Vec3 vMin( -0.5f * sGridRange ) ;
+            const Vec3 vMax(  0.5f * sGridRange ) ;
+            mGrid.DefineShape( settings.mNumGridPoints , vMin , vMax , true ) ;
+            mGrid.Init() ;
+            extern void UniformGrid_AssignTestValues( UniformGrid< Vec3 > & ) ;
+            UniformGrid_AssignTestValues( mGrid ) ;
+
+            // Keep query points strictly inside the grid, where Interpolate and Accumulate require them.
+            const Vec3 queryRange( 0.99f * sGridRange ) ;
+            mQueryPositions.Reserve( settings.mNumQueries ) ;
+            for( unsigned iQuery = 0 ; iQuery < settings.mNumQueries ; ++ iQuery )
+            {   // For each query point...
+                mQueryPositions.PushBack( RandomSpread( queryRange ) ) ;
+            }
+        }
+
+    public:
+        size_t GetNumItems() const { return mQueryPositions.Size() ; }
+
+        double                  mChecksum       ;   ///< Sum of kernel outputs from the most recent run.
+
+    protected:
+        UniformGrid< Vec3 >     mGrid           ;   ///< Grid the kernel reads or writes.
+        VECTOR< Vec3 >          mQueryPositions ;   ///< Positions at which to query mGrid.
+} ;
+
+
+
+
+/** Kernel that interpolates a grid at random query points.
+*/
+class InterpolateKernel : public GridQueryKernelBase
+{
+    public:
+        InterpolateKernel( const MicrobenchmarkSettings & settings ) : GridQueryKernelBase( settings ) {}
+
+        void Run()
+        {
+            Vec3 sum( 0.0f , 0.0f , 0.0f ) ;
+            const size_t numQueries = mQueryPositions.Size() ;
+            for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+            {   // For each query point...
+                Vec3 value ;
+                mGrid.Interpolate( value , mQueryPositions[ iQuery ] ) ;
+                sum += value ;
+            }
+            mChecksum = double( sum.x ) + double( sum.y ) + double( sum.z ) ;
+        }
+} ;
+
+
+
+
+/** Kernel that accumulates values into a grid at random query points.
+*/
+class AccumulateKernel : public GridQueryKernelBase
+{
+    public:
+        AccumulateKernel( const MicrobenchmarkSettings & settings ) : GridQueryKernelBase( settings ) {}
+
+        void Run()
+        {
+            mGrid.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;  // Costs far less than accumulating, and keeps each run identical.
+            const Vec3 value( 1.0f , 2.0f , 3.0f ) ;
+            const size_t numQueries = mQueryPositions.Size() ;
+            for( size_t iQuery = 0 ; iQuery < numQueries ; ++ iQuery )
+            {   // For each query point...
+                mGrid.Accumulate( mQueryPositions[ iQuery ] , value ) ;
+            }
+            double sum = 0.0 ;
+            const size_t numPoints = mGrid.GetGridCapacity() ;
+            for( size_t offset = 0 ; offset < numPoints ; ++ offset )
+            {   // For each gridpoint...
+                sum += double( mGrid[ offset ].x ) ;
+            }
+            mChecksum = sum ;
+        }
+} ;
+
+
+
+
+/** Kernel that down-samples a grid into its decimation by 2.
+*/
+class DownSampleKernel
+{
+    public:
+        DownSampleKernel( const MicrobenchmarkSettings & settings )
+            : mChecksum( 0.0 )
+        {
+            const Vec3 vMin( -0.5f * sGridRange ) ;
+            const Vec3 vMax(  0.5f * sGridRange ) ;
+            mHiRes.DefineShape( settings.mNumGridPoints , vMin , vMax , true ) ;
+            mHiRes.Init() ;
+            extern void UniformGrid_AssignTestValues( UniformGrid< Vec3 > & ) ;
+            UniformGrid_AssignTestValues( mHiRes ) ;
+            mLoRes.Decimate( mHiRes , 2 ) ;
+            mLoRes.Init() ;
+        }
+
+        size_t GetNumItems() const { return mHiRes.GetGridCapacity() ; }
+
+        void Run()
+        {
+            mLoRes.DownSample( mHiRes , UniformGridGeometry::SLOWER_MORE_ACCURATE ) ;
+            mChecksum = double( mLoRes[ mLoRes.GetGridCapacity() / 2 ].z ) ;
+        }
+
+        double                  mChecksum   ;   ///< Central value of down-sampled grid from the most recent run.
+
+    private:
+        UniformGrid< Vec3 >     mHiRes      ;   ///< Grid to down-sample.
+        UniformGrid< Vec3 >     mLoRes      ;   ///< Down-sampled grid.
+} ;
+
+
+
+
+/** Kernel that applies one red-black Gauss-Seidel sweep toward solving a vector Poisson equation.
+*/
+class RedBlackSweepKernel
+{
+    public:
+        RedBlackSweepKernel( const MicrobenchmarkSettings & settings )
+            : mChecksum( 0.0 )
+        {
+            const Vec3 vMin( -0.5f * sGridRange ) ;
+            const Vec3 vMax(  0.5f * sGridRange ) ;
+            mLaplacian.DefineShape( settings.mNumGridPoints , vMin , vMax , true ) ;
+            mLaplacian.Init() ;
+            extern void UniformGrid_AssignTestValues( UniformGrid< Vec3 > & ) ;
+            UniformGrid_AssignTestValues( mLaplacian ) ;
+            mSolution.CopyShape( mLaplacian ) ;
+        }
+
+        size_t GetNumItems() const { return mSolution.GetGridCapacity() ; }
+
+        void Run()
+        {
+            mSolution.Init( Vec3( 0.0f , 0.0f , 0.0f ) ) ;  // Start each run from the same guess, so runs do identical work.
+            Stats_Float residualStats ;
+            SolveVectorPoisson( mSolution , mLaplacian , 1 , BC_DIRICHLET , residualStats ) ;
+            mChecksum = double( residualStats.mMean ) ;
+        }
+
+        double                  mChecksum   ;   ///< Mean residual from the most recent run.
+
+    private:
+        UniformGrid< Vec3 >     mLaplacian  ;   ///< Right-hand side of the Poisson equation.
+        UniformGrid< Vec3 >     mSolution   ;   ///< Approximate solution.
+} ;
+
+
+
+
+/** Kernel that extracts an isosurface from a grid of signed distances.
+*/
+class MarchingCubesKernel
+{
+    public:
+        MarchingCubesKernel( const MicrobenchmarkSettings & settings )
+            : mChecksum( 0.0 )
+            , mRadius( 1.0f )
+            , mNumCells( 0 )
+        {
+            using namespace PeGaSys::Render ;
+            GridWrapper_Init( & mSdfGrid ) ;
+            GridWrapper_Init( & mGradGrid ) ;
+            GridWrapper_MakeSphere( & mSdfGrid , & mGradGrid , Max2( settings.mIsoGridDim , 4u ) , mRadius ) ;
+            mNumCells = ( mSdfGrid.number[ 0 ] - 1 ) * ( mSdfGrid.number[ 1 ] - 1 ) * ( mSdfGrid.number[ 2 ] - 1 ) ;
+
+            // Interleave positions and normals, as vertex buffers do.  Mesh_UpdateFromVolume also provides one vertex per cell.
+            static const size_t numFloatsPerVertex = 6 ;
+            mVertices.Resize( mNumCells * numFloatsPerVertex ) ;
+            mVertexBuffer.positions = & mVertices[ 0 ] ;
+            mVertexBuffer.normals   = & mVertices[ 3 ] ;
+            mVertexBuffer.count     = 0 ;
+            mVertexBuffer.capacity  = mNumCells ;
+            mVertexBuffer.stride    = numFloatsPerVertex * sizeof( float ) ;
+        }
+
+        ~MarchingCubesKernel()
+        {
+            PeGaSys::Render::GridWrapper_Free( & mSdfGrid ) ;
+            PeGaSys::Render::GridWrapper_Free( & mGradGrid ) ;
+        }
+
+        size_t GetNumItems() const { return mNumCells ; }
+
+        void Run()
+        {
+            mVertexBuffer.count = 0 ;
+            const PeGaSys::Render::ResultCodeE resultCode = PeGaSys::Render::ExtractIsoLevel( & mVertexBuffer , mRadius , & mSdfGrid ) ;
+            if( resultCode != PeGaSys::Render::RESULT_OKAY )
+            {   // Vertex buffer overflowed, so this did not measure extracting the whole surface.
+                fprintf( stderr , "Microbenchmark: MarchingCubes vertex buffer lacks capacity\n" ) ;
+            }
+            mChecksum = double( size_t( mVertexBuffer.count ) ) ;
+        }
+
+        double                                  mChecksum       ;   ///< Number of vertices the most recent run extracted.
+
+    private:
+        MarchingCubesKernel( const MarchingCubesKernel & ) ;                ///< Disallow copy construction, since this owns grid memory.
+        MarchingCubesKernel & operator=( const MarchingCubesKernel & ) ;    ///< Disallow assignment, since this owns grid memory.
+
+        float                                   mRadius         ;   ///< Radius of sphere, and therefore isolevel to extract.
+        size_t                                  mNumCells       ;   ///< Number of cells in mSdfGrid.
+        PeGaSys::Render::GridWrapper            mSdfGrid        ;   ///< Signed distances from center of sphere.
+        PeGaSys::Render::GridWrapper            mGradGrid       ;   ///< Gradient of mSdfGrid.  GridWrapper_MakeSphere requires it.
+        PeGaSys::Render::VertexBufferWrapper    mVertexBuffer   ;   ///< Place for marching cubes to write vertices.
+        VECTOR< float >                         mVertices       ;   ///< Memory that mVertexBuffer wraps.
+} ;
+
+
+
+
+/** Kernel that evaluates the regularized Biot-Savart law for each pair of vortons.
+*/
+class BiotSavartPairsKernel
+{
+    public:
+        BiotSavartPairsKernel( const MicrobenchmarkSettings & settings )
+            : mChecksum( 0.0 )
+            , mVortonSize( 0.0f )
+        {
+            const unsigned numVortons = Max2( settings.mNumVortons , 1u ) ;
+            mPositions.Reserve( numVortons ) ;
+            mAngularVelocities.Reserve( numVortons ) ;
+            for( unsigned iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+            {   // For each vorton...
+                mPositions.PushBack( RandomSpread( sGridRange ) ) ;
+                mAngularVelocities.PushBack( RandomSpread( Vec3( 2.0f , 2.0f , 2.0f ) ) ) ;
+            }
+            // Size vortons so each occupies about its share of the domain, so some pairs fall within cores and others outside.
+            mVortonSize = powf( sGridRange.x * sGridRange.y * sGridRange.z / float( numVortons ) , 1.0f / 3.0f ) ;
+        }
+
+        size_t GetNumItems() const { return mPositions.Size() * mPositions.Size() ; }
+
+        void Run()
+        {
+            const float spreadingRangeFactor        = 1.0f ;
+            const float spreadingCirculationFactor  = 1.0f / Pow3( spreadingRangeFactor ) ;
+            Vec3 sum( 0.0f , 0.0f , 0.0f ) ;
+            const size_t numVortons = mPositions.Size() ;
+            for( size_t iQuery = 0 ; iQuery < numVortons ; ++ iQuery )
+            {   // For each query point...
+                const Vec3 & vPosQuery = mPositions[ iQuery ] ;
+                Vec3 velocity( 0.0f , 0.0f , 0.0f ) ;
+                for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+                {   // For each vorton...
+                    VORTON_ACCUMULATE_VELOCITY_private( velocity , vPosQuery , mPositions[ iVorton ] , mAngularVelocities[ iVorton ] , mVortonSize , spreadingRangeFactor , spreadingCirculationFactor ) ;
+                }
+                sum += velocity ;
+            }
+            mChecksum = double( sum.x ) + double( sum.y ) + double( sum.z ) ;
+        }
+
+        double          mChecksum           ;   ///< Sum of velocities from the most recent run.
+
+    private:
+        VECTOR< Vec3 >  mPositions          ;   ///< Vorton positions, which also serve as query points.
+        VECTOR< Vec3 >  mAngularVelocities  ;   ///< Vorton angular velocities.
+        float           mVortonSize         ;   ///< Vorton diameter.
+} ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+MicrobenchmarkResult::MicrobenchmarkResult()
+    : mKernel( "" )
+    , mNumItems( 0 )
+    , mNumRepeats( 0 )
+    , mSecondsMin( 0.0 )
+    , mSecondsMedian( 0.0 )
+    , mSecondsMean( 0.0 )
+    , mSecondsStdDev( 0.0 )
+    , mChecksum( 0.0 )
+{
+}
+
+
+
+
+MicrobenchmarkSettings::MicrobenchmarkSettings()
+    : mNumRepeats( sDefaultNumRepeats )
+    , mNumGridPoints( sDefaultNumGridPoints )
+    , mNumQueries( sDefaultNumQueries )
+    , mNumVortons( sDefaultNumVortons )
+    , mIsoGridDim( sDefaultIsoGridDim )
+    , mNumThreads( 0 )
+    , mOutputFilename( NULLPTR )
+{
+}
+
+
+
+
+/** Amend settings from command-line options.
+
+    \return Whether all options made sense.  Otherwise this prints what did not.
+*/
+bool MicrobenchmarkSettings::ParseCommandLine( int argc , char ** argv )
+{
+    for( int iArg = 1 ; iArg < argc ; ++ iArg )
+    {   // For each command-line argument...
+        const char * arg        = argv[ iArg ] ;
+        const char * nextArg    = ( iArg + 1 < argc ) ? argv[ iArg + 1 ] : NULLPTR ;
+        if( 0 == strcmp( arg , "-microbenchmark" ) )
+        {   // Microbenchmark_IsRequested already handled this.
+            continue ;
+        }
+        if( NULLPTR == nextArg )
+        {   // All other options take a value.
+            fprintf( stderr , "Microbenchmark: option %s lacks a value\n" , arg ) ;
+            return false ;
+        }
+        ++ iArg ;
+        unsigned * target = NULLPTR ;   // Setting this option assigns.
+        if(      0 == strcmp( arg , "-repeats"    ) ) target = & mNumRepeats ;
+        else if( 0 == strcmp( arg , "-gridpoints" ) ) target = & mNumGridPoints ;
+        else if( 0 == strcmp( arg , "-queries"    ) ) target = & mNumQueries ;
+        else if( 0 == strcmp( arg , "-vortons"    ) ) target = & mNumVortons ;
+        else if( 0 == strcmp( arg , "-isogrid"    ) ) target = & mIsoGridDim ;
+        else if( 0 == strcmp( arg , "-threads"    ) ) target = & mNumThreads ;
+        else if( 0 == strcmp( arg , "-out" ) )
+        {
+            mOutputFilename = nextArg ;
+            continue ;
+        }
+        else
+        {
+            fprintf( stderr , "Microbenchmark: unknown option %s\n" , arg ) ;
+            return false ;
+        }
+        * target = unsigned( strtoul( nextArg , NULLPTR , 10 ) ) ;
+        if( ( 0 == * target ) && ( target != & mNumThreads ) )
+        {   // Only thread count may be zero, meaning default.
+            fprintf( stderr , "Microbenchmark: invalid value %s for option %s\n" , nextArg , arg ) ;
+            return false ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Return whether the command line asks to run the microbenchmark instead of the interactive application.
+*/
+bool Microbenchmark_IsRequested( int argc , char ** argv )
+{
+    for( int iArg = 1 ; iArg < argc ; ++ iArg )
+    {   // For each command-line argument...
+        if( 0 == strcmp( argv[ iArg ] , "-microbenchmark" ) )
+        {
+            return true ;
+        }
+    }
+    return false ;
+}
+
+
+
+
+/** Run the given kernel once to warm caches, then repeatedly, timing each run, and compute statistics of those timings.
+
+    \param kernel       Kernel to run.  It must provide Run, GetNumItems and mChecksum.
+
+    \param kernelName   Name of kernel, to report.
+
+    \param numRepeats   Number of timed runs.
+
+    \param result       (out) Statistics of timed runs.
+*/
+template< class KernelT > static void MeasureKernel( KernelT & kernel , const char * kernelName , unsigned numRepeats , MicrobenchmarkResult & result )
+{
+    PERF_BLOCK( MeasureKernel ) ;
+
+    kernel.Run() ;  // Warm up caches and let lazily allocated memory settle, so timings exclude one-time costs.
+
+    VECTOR< double > durations ;
+    durations.Reserve( numRepeats ) ;
+    for( unsigned iRepeat = 0 ; iRepeat < numRepeats ; ++ iRepeat )
+    {   // For each timed run...
+        Timer timer ;
+        kernel.Run() ;
+        durations.PushBack( double( timer.GetElapsedTimeSeconds() ) ) ;
+    }
+
+    double sum = 0.0 ;
+    for( unsigned iRepeat = 0 ; iRepeat < numRepeats ; ++ iRepeat )
+    {   // For each timed run...
+        sum += durations[ iRepeat ] ;
+    }
+    const double mean = sum / double( numRepeats ) ;
+    double sumOfSquaredDeviations = 0.0 ;
+    for( unsigned iRepeat = 0 ; iRepeat < numRepeats ; ++ iRepeat )
+    {   // For each timed run...
+        sumOfSquaredDeviations += Pow2( durations[ iRepeat ] - mean ) ;
+    }
+
+    std::sort( durations.Begin() , durations.End() ) ;
+
+    result.mKernel          = kernelName ;
+    result.mNumItems        = kernel.GetNumItems() ;
+    result.mNumRepeats      = numRepeats ;
+    result.mSecondsMin      = durations[ 0 ] ;
+    result.mSecondsMedian   = ( numRepeats % 2 ) ? durations[ numRepeats / 2 ] : 0.5 * ( durations[ numRepeats / 2 - 1 ] + durations[ numRepeats / 2 ] ) ;
+    result.mSecondsMean     = mean ;
+    result.mSecondsStdDev   = ( numRepeats > 1 ) ? sqrt( sumOfSquaredDeviations / double( numRepeats - 1 ) ) : 0.0 ;
+    result.mChecksum        = kernel.mChecksum ;
+}
+
+
+
+
+/** Write column names of the microbenchmark report.
+*/
+static void WriteCsvHeader( FILE * fp )
+{
+    fprintf( fp , "kernel,threads,items,repeats,minSeconds,medianSeconds,meanSeconds,stdDevSeconds,itemsPerSecond,checksum\n" ) ;
+}
+
+
+
+
+/** Write one row of the microbenchmark report.
+
+    Throughput uses the median duration, which resists outliers from
+    preemption better than the mean does.
+*/
+static void WriteCsvRow( FILE * fp , const MicrobenchmarkResult & result )
+{
+    const double itemsPerSecond = ( result.mSecondsMedian > 0.0 ) ? double( result.mNumItems ) / result.mSecondsMedian : 0.0 ;
+    fprintf( fp , "%s,%u,%lu,%u,%g,%g,%g,%g,%g,%.9g\n"
+        , result.mKernel
+        , Parallel::GetNumThreads()
+        , static_cast< unsigned long >( result.mNumItems )
+        , result.mNumRepeats
+        , result.mSecondsMin
+        , result.mSecondsMedian
+        , result.mSecondsMean
+        , result.mSecondsStdDev
+        , itemsPerSecond
+        , result.mChecksum
+        ) ;
+    fflush( fp ) ;  // Keep partial results if a later kernel crashes.
+}
+
+
+
+
+/** Set up, measure and report one kernel, then tear it down, so only one kernel occupies memory at a time.
+*/
+template< class KernelT > static void MeasureAndReportKernel( FILE * fp , const MicrobenchmarkSettings & settings , const char * kernelName )
+{
+    KernelT kernel( settings ) ;
+    MicrobenchmarkResult result ;
+    MeasureKernel( kernel , kernelName , settings.mNumRepeats , result ) ;
+    WriteCsvRow( fp , result ) ;
+}
+
+
+
+
+/** Run the microbenchmark that the command line describes.
+
+    \return Process exit code: zero upon success.
+*/
+int Microbenchmark_Main( int argc , char ** argv )
+{
+    PERF_BLOCK( Microbenchmark_Main ) ;
+
+    MicrobenchmarkSettings settings ;
+    if( ! settings.ParseCommandLine( argc , argv ) )
+    {
+        fprintf( stderr , "usage: %s -microbenchmark [-repeats N] [-gridpoints N] [-queries N] [-vortons N] [-isogrid N] [-threads N] [-out filename]\n" , argv[ 0 ] ) ;
+        return 1 ;
+    }
+
+    FILE * fp = stdout ;
+    if( settings.mOutputFilename )
+    {
+        fp = fopen( settings.mOutputFilename , "w" ) ;
+        if( NULLPTR == fp )
+        {
+            fprintf( stderr , "Microbenchmark: could not create %s\n" , settings.mOutputFilename ) ;
+            return 1 ;
+        }
+    }
+
+    Parallel::Settings parallelSettings = Parallel::SettingsFromEnvironment() ;
+    if( settings.mNumThreads > 0 )
+    {
+        parallelSettings.mNumThreads = settings.mNumThreads ;
+    }
+    Parallel::Executor parallelExecutor( parallelSettings ) ;
+#if USE_TBB
+    gNumberOfProcessors = Parallel::GetNumThreads() ; // Grain sizes divide work among the threads the executor actually uses.  VortonSim::Initialize would normally assign this.
+#endif
+
+    srand( 1 ) ;    // Make pseudo-random inputs identical across runs.
+
+    WriteCsvHeader( fp ) ;
+    MeasureAndReportKernel< InterpolateKernel     >( fp , settings , "Interpolate"     ) ;
+    MeasureAndReportKernel< AccumulateKernel      >( fp , settings , "Accumulate"      ) ;
+    MeasureAndReportKernel< DownSampleKernel      >( fp , settings , "DownSample"      ) ;
+    MeasureAndReportKernel< RedBlackSweepKernel   >( fp , settings , "RedBlackSweep"   ) ;
+    MeasureAndReportKernel< MarchingCubesKernel   >( fp , settings , "MarchingCubes"   ) ;
+    MeasureAndReportKernel< BiotSavartPairsKernel >( fp , settings , "BiotSavartPairs" ) ;
+
+    if( fp != stdout )
+    {
+        fclose( fp ) ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,65 @@
+/** \file microbenchmark.h
+
+    \brief Headless microbenchmark that measures throughput of individual kernels, reusing the setup of unit tests.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef MICROBENCHMARK_H
+#define MICROBENCHMARK_H
+
+#include <stddef.h>
+
+// Macros --------------------------------------------------------------
+// Types --------------------------------------------------------------
+
+/** Statistics of durations from running one kernel repeatedly.
+*/
+struct MicrobenchmarkResult
+{
+    MicrobenchmarkResult() ;
+
+    const char *    mKernel             ;   ///< Name of kernel that ran.
+    size_t          mNumItems           ;   ///< Number of items (query points, gridpoints, cells or pairs) each run processed.
+    unsigned        mNumRepeats         ;   ///< Number of timed runs, not counting the warm-up run.
+    double          mSecondsMin         ;   ///< Wall-clock seconds the fastest run took.
+    double          mSecondsMedian      ;   ///< Median wall-clock seconds per run.
+    double          mSecondsMean        ;   ///< Mean wall-clock seconds per run.
+    double          mSecondsStdDev      ;   ///< Standard deviation of wall-clock seconds per run.
+    double          mChecksum           ;   ///< Sum of kernel outputs from the final run, to compare results across builds and to keep compilers from discarding the work.
+} ;
+
+
+
+
+/** What a microbenchmark run should do.
+*/
+struct MicrobenchmarkSettings
+{
+    MicrobenchmarkSettings() ;
+
+    bool ParseCommandLine( int argc , char ** argv ) ;
+
+    static const unsigned sDefaultNumRepeats        = 32        ;   ///< Number of timed runs per kernel, unless the command line says otherwise.
+    static const unsigned sDefaultNumGridPoints     = 65536     ;   ///< Number of gridpoints in grid kernels, unless the command line says otherwise.
+    static const unsigned sDefaultNumQueries        = 1048576   ;   ///< Number of query points for Interpolate and Accumulate, unless the command line says otherwise.
+    static const unsigned sDefaultNumVortons        = 2048      ;   ///< Number of vortons for Biot-Savart pair evaluation, unless the command line says otherwise.
+    static const unsigned sDefaultIsoGridDim        = 64        ;   ///< Number of gridpoints along each axis for marching cubes, unless the command line says otherwise.
+
+    unsigned        mNumRepeats         ;   ///< Number of timed runs per kernel.
+    unsigned        mNumGridPoints      ;   ///< Approximate number of gridpoints in grids that Interpolate, Accumulate, DownSample and red-black sweep use.
+    unsigned        mNumQueries         ;   ///< Number of query points for Interpolate and Accumulate.
+    unsigned        mNumVortons         ;   ///< Number of vortons for Biot-Savart pair evaluation, which evaluates the square of this many pairs.
+    unsigned        mIsoGridDim         ;   ///< Number of gridpoints along each axis of the grid from which marching cubes extracts an isosurface.
+    unsigned        mNumThreads         ;   ///< Number of threads parallel kernels use, including the main thread.  Zero means the executor default.
+    const char *    mOutputFilename     ;   ///< File to write CSV report into, or NULL for stdout.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+extern bool Microbenchmark_IsRequested( int argc , char ** argv ) ;
+extern int  Microbenchmark_Main( int argc , char ** argv ) ;
+
+#endif
@@ -0,0 +1,1057 @@
+/** \file remoteView.cpp
+
+    \brief Streaming of quantized, delta-encoded particle state from a simulation to remote viewers.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#if defined( WIN32 )
+    #include <winsock2.h>   // Must precede windows.h, which otherwise includes the older winsock.h.
+    #pragma comment( lib , "ws2_32.lib" )
+#endif
+
+#include "remoteView.h"
+
+#include <Particles/particleSystem.h>
+
+#include <Core/Performance/perfBlock.h>
+
+#include <algorithm>
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const float sRangeMargin = 0.25f ;   ///< Fraction of span by which quantization ranges grow beyond values they must cover, so they change rarely.
+
+/// Number of bits each channel quantizes to.
+static const unsigned sChannelBits[ NUM_REMOTE_VIEW_CHANNELS ] = { 16 , 16 , 16 , 8 , 8 , 8 , 8 , 8 } ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Return the given quantization level of the given value, within the given range, clamped to [0,maxLevel].
+*/
+static inline unsigned short Quantize( float value , float rangeMin , float levelsPerUnit , unsigned maxLevel )
+{
+    const int level = int( ( value - rangeMin ) * levelsPerUnit + 0.5f ) ;
+    return static_cast< unsigned short >( Clamp( level , 0 , int( maxLevel ) ) ) ;
+}
+
+
+
+
+/** Return number of quantization levels per unit, for the given range, or zero for an empty range.
+*/
+static inline float LevelsPerUnit( float rangeMin , float rangeMax , unsigned maxLevel )
+{
+    return ( rangeMax > rangeMin ) ? float( maxLevel ) / ( rangeMax - rangeMin ) : 0.0f ;
+}
+
+
+
+
+/** Grow the given range, with margin, until it covers the given values.
+
+    \return Whether the range changed.
+*/
+static bool CoverRange( float range[ 2 ] , bool hasRange , float valueMin , float valueMax )
+{
+    if( hasRange && ( valueMin >= range[ 0 ] ) && ( valueMax <= range[ 1 ] ) )
+    {   // Range already covers values.
+        return false ;
+    }
+    const float lo      = hasRange ? Min2( valueMin , range[ 0 ] ) : valueMin ;
+    const float hi      = hasRange ? Max2( valueMax , range[ 1 ] ) : valueMax ;
+    const float margin  = sRangeMargin * ( hi - lo ) + FLT_EPSILON * Max2( fabsf( lo ) , fabsf( hi ) ) ;
+    range[ 0 ] = lo - margin ;
+    range[ 1 ] = hi + margin ;
+    return true ;
+}
+
+
+
+
+/** Append the given value to the given bytes, as a variable-length integer: 7 bits per byte, least significant first, high bit set on all but the last.
+*/
+static inline void AppendVarint( VECTOR< unsigned char > & bytes , unsigned value )
+{
+    while( value >= 0x80 )
+    {
+        bytes.PushBack( static_cast< unsigned char >( value | 0x80 ) ) ;
+        value >>= 7 ;
+    }
+    bytes.PushBack( static_cast< unsigned char >( value ) ) ;
+}
+
+
+
+
+/** Read a variable-length integer, as AppendVarint wrote it, and advance the cursor past it.
+
+    \return Whether the integer lay entirely before end.
+*/
+static inline bool ReadVarint( const unsigned char * & cursor , const unsigned char * end , unsigned & value )
+{
+    value = 0 ;
+    for( unsigned shift = 0 ; shift < 32 ; shift += 7 )
+    {
+        if( cursor >= end )
+        {
+            return false ;
+        }
+        const unsigned char byte = * cursor ++ ;
+        value |= unsigned( byte & 0x7f ) << shift ;
+        if( 0 == ( byte & 0x80 ) )
+        {
+            return true ;
+        }
+    }
+    return false ;
+}
+
+
+
+
+/** Encode one channel of one group, as differences from the previous values, or from zero if previous is NULL.
+
+    Differences wrap modulo the number of levels, so decoding reproduces
+    current values exactly.  Each nonzero difference becomes a zigzag
+    variable-length integer; each run of zero differences becomes a zero
+    followed by the run length minus one.
+*/
+static void EncodeChannel( VECTOR< unsigned char > & bytes , const unsigned short * current , const unsigned short * previous , size_t count , unsigned bits )
+{
+    const int numLevels = 1 << bits ;
+    size_t iPcl = 0 ;
+    while( iPcl < count )
+    {   // For each particle...
+        int delta = int( current[ iPcl ] ) - ( previous ? int( previous[ iPcl ] ) : 0 ) ;
+        if( 0 == delta )
+        {   // Value did not change.  Collapse run of unchanged values.
+            size_t runLength = 1 ;
+            while( ( iPcl + runLength < count ) && ( current[ iPcl + runLength ] == ( previous ? previous[ iPcl + runLength ] : 0 ) ) )
+            {
+                ++ runLength ;
+            }
+            AppendVarint( bytes , 0 ) ;
+            AppendVarint( bytes , static_cast< unsigned >( runLength - 1 ) ) ;
+            iPcl += runLength ;
+        }
+        else
+        {   // Value changed.  Wrap difference to its shortest signed form, then zigzag it so small magnitudes encode small.
+            if( delta >= numLevels / 2 )
+            {
+                delta -= numLevels ;
+            }
+            else if( delta < - numLevels / 2 )
+            {
+                delta += numLevels ;
+            }
+            AppendVarint( bytes , ( unsigned( delta ) << 1 ) ^ unsigned( delta >> 31 ) ) ;
+            ++ iPcl ;
+        }
+    }
+}
+
+
+
+
+/** Decode one channel of one group, as EncodeChannel encoded it, adding differences to the given values in place.
+
+    \return Whether the encoded channel was well formed and lay entirely before end.
+*/
+static bool DecodeChannel( const unsigned char * & cursor , const unsigned char * end , unsigned short * values , size_t count , unsigned bits )
+{
+    const unsigned levelMask = ( 1u << bits ) - 1u ;
+    size_t iPcl = 0 ;
+    while( iPcl < count )
+    {   // For each particle...
+        unsigned zigzag ;
+        if( ! ReadVarint( cursor , end , zigzag ) )
+        {
+            return false ;
+        }
+        if( 0 == zigzag )
+        {   // Run of unchanged values.
+            unsigned runLengthMinusOne ;
+            if( ! ReadVarint( cursor , end , runLengthMinusOne ) || ( runLengthMinusOne >= count - iPcl ) )
+            {
+                return false ;
+            }
+            iPcl += size_t( runLengthMinusOne ) + 1 ;
+        }
+        else
+        {
+            const int delta = int( zigzag >> 1 ) ^ - int( zigzag & 1 ) ;
+            values[ iPcl ] = static_cast< unsigned short >( ( int( values[ iPcl ] ) + delta ) & int( levelMask ) ) ;
+            ++ iPcl ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Quantize the given channel of the given particles.
+*/
+static void QuantizeChannel( VECTOR< unsigned short > & quantized , const VECTOR< Particle > & particles , RemoteViewChannelE channel , const Vec3 & boundsMin , const Vec3 & boundsMax , const RemoteViewGroupState & state )
+{
+    const size_t    numParticles    = particles.Size() ;
+    const unsigned  maxLevel        = ( 1u << sChannelBits[ channel ] ) - 1u ;
+    quantized.Resize( numParticles ) ;
+    switch( channel )
+    {
+        case REMOTE_VIEW_CHANNEL_POSITION_X:
+        case REMOTE_VIEW_CHANNEL_POSITION_Y:
+        case REMOTE_VIEW_CHANNEL_POSITION_Z:
+        {
+            const int   axis            = channel - REMOTE_VIEW_CHANNEL_POSITION_X ;
+            const float axisMin         = ( & boundsMin.x )[ axis ] ;
+            const float levelsPerUnit   = LevelsPerUnit( axisMin , ( & boundsMax.x )[ axis ] , maxLevel ) ;
+            for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+            {
+                quantized[ iPcl ] = Quantize( ( & particles[ iPcl ].mPosition.x )[ axis ] , axisMin , levelsPerUnit , maxLevel ) ;
+            }
+        }
+        break ;
+
+        case REMOTE_VIEW_CHANNEL_DENSITY:
+        {
+            const float levelsPerUnit = LevelsPerUnit( state.mDensityRange[ 0 ] , state.mDensityRange[ 1 ] , maxLevel ) ;
+            for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+            {
+                quantized[ iPcl ] = Quantize( particles[ iPcl ].mDensity , state.mDensityRange[ 0 ] , levelsPerUnit , maxLevel ) ;
+            }
+        }
+        break ;
+
+        case REMOTE_VIEW_CHANNEL_SIZE:
+        {
+            const float levelsPerUnit = LevelsPerUnit( state.mSizeRange[ 0 ] , state.mSizeRange[ 1 ] , maxLevel ) ;
+            for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+            {
+                quantized[ iPcl ] = Quantize( particles[ iPcl ].mSize , state.mSizeRange[ 0 ] , levelsPerUnit , maxLevel ) ;
+            }
+        }
+        break ;
+
+    #if ENABLE_FIRE
+        case REMOTE_VIEW_CHANNEL_FUEL_FRACTION:
+            for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+            {
+                quantized[ iPcl ] = Quantize( particles[ iPcl ].mFuelFraction , 0.0f , float( maxLevel ) , maxLevel ) ;
+            }
+        break ;
+
+        case REMOTE_VIEW_CHANNEL_FLAME_FRACTION:
+            for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+            {
+                quantized[ iPcl ] = Quantize( particles[ iPcl ].mFlameFraction , 0.0f , float( maxLevel ) , maxLevel ) ;
+            }
+        break ;
+
+        case REMOTE_VIEW_CHANNEL_SMOKE_FRACTION:
+            for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+            {
+                quantized[ iPcl ] = Quantize( particles[ iPcl ].mSmokeFraction , 0.0f , float( maxLevel ) , maxLevel ) ;
+            }
+        break ;
+    #endif
+
+        default:
+            // Particles lack this attribute in this build, so send zeros, which each collapse into one run.
+            std::fill( quantized.begin() , quantized.end() , static_cast< unsigned short >( 0 ) ) ;
+        break ;
+    }
+}
+
+
+
+
+RemoteViewEncoder::RemoteViewEncoder()
+    : mBoundsMin( 0.0f , 0.0f , 0.0f )
+    , mBoundsMax( 0.0f , 0.0f , 0.0f )
+    , mHasBounds( false )
+    , mNeedKeyframe( true )
+{
+}
+
+
+
+
+/** Grow the quantization box, with margin, until it covers the given grid geometry.
+
+    \return Whether the box changed.
+*/
+bool RemoteViewEncoder::CoverBounds( const UniformGridGeometry & geometry )
+{
+    const Vec3      gridMin     = geometry.GetMinCorner() ;
+    const Vec3      gridMax     = geometry.GetMaxCorner() ;
+    float * const   boundsMin   = & mBoundsMin.x ;
+    float * const   boundsMax   = & mBoundsMax.x ;
+    bool changed = false ;
+    for( int axis = 0 ; axis < 3 ; ++ axis )
+    {   // For each axis...
+        float range[ 2 ] = { boundsMin[ axis ] , boundsMax[ axis ] } ;
+        if( CoverRange( range , mHasBounds , ( & gridMin.x )[ axis ] , ( & gridMax.x )[ axis ] ) )
+        {
+            boundsMin[ axis ] = range[ 0 ] ;
+            boundsMax[ axis ] = range[ 1 ] ;
+            changed = true ;
+        }
+    }
+    mHasBounds = true ;
+    return changed ;
+}
+
+
+
+
+/** Encode the given particle system into a message, relative to the previous message this encoded.
+
+    \param particleSystem   Particle system whose groups to encode.
+
+    \param geometry         Geometry of a grid that spans the particles, such as the velocity grid.  Positions outside it clamp to its box.
+
+    \param frame            Frame counter.
+
+    \param timeNow          Virtual time.
+
+    \param message          (out) Header and payload.
+*/
+void RemoteViewEncoder::Encode( const ParticleSystem & particleSystem , const UniformGridGeometry & geometry , unsigned frame , double timeNow , VECTOR< unsigned char > & message )
+{
+    PERF_BLOCK( RemoteViewEncoder__Encode ) ;
+
+    const bool      boundsChanged   = CoverBounds( geometry ) ;
+    const bool      isKeyframe      = mNeedKeyframe || boundsChanged ;
+    const size_t    numGroups       = particleSystem.GetNumGroups() ;
+    mNeedKeyframe = false ;
+
+    message.Clear() ;
+    message.Resize( sizeof( RemoteViewMessageHeader ) ) ;
+    mGroups.Resize( numGroups ) ;
+
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        const VECTOR< Particle > &  particles       = particleSystem.GetGroup( iGroup )->GetParticles() ;
+        const size_t                numParticles    = particles.Size() ;
+        RemoteViewGroupState &      state           = mGroups[ iGroup ] ;
+
+        bool rangesChanged = false ;
+        if( numParticles > 0 )
+        {   // Group has particles.  Make sure quantization ranges cover their densities and sizes.
+            float densityMin = particles[ 0 ].mDensity ;
+            float densityMax = densityMin ;
+            float sizeMin    = particles[ 0 ].mSize ;
+            float sizeMax    = sizeMin ;
+            for( size_t iPcl = 1 ; iPcl < numParticles ; ++ iPcl )
+            {   // For each particle...
+                densityMin  = Min2( densityMin , particles[ iPcl ].mDensity ) ;
+                densityMax  = Max2( densityMax , particles[ iPcl ].mDensity ) ;
+                sizeMin     = Min2( sizeMin    , particles[ iPcl ].mSize    ) ;
+                sizeMax     = Max2( sizeMax    , particles[ iPcl ].mSize    ) ;
+            }
+            const bool densityRangeChanged  = CoverRange( state.mDensityRange , state.mHasRanges , densityMin , densityMax ) ;
+            const bool sizeRangeChanged     = CoverRange( state.mSizeRange    , state.mHasRanges , sizeMin    , sizeMax    ) ;
+            rangesChanged       = densityRangeChanged || sizeRangeChanged ;
+            state.mHasRanges    = true ;
+        }
+        else if( ! state.mHasRanges )
+        {   // Group has never had particles.
+            state.mDensityRange[ 0 ] = state.mDensityRange[ 1 ] = 0.0f ;
+            state.mSizeRange[ 0 ]    = state.mSizeRange[ 1 ]    = 0.0f ;
+        }
+
+        const bool isGroupKeyframe = isKeyframe || rangesChanged || ( state.mChannels[ 0 ].Size() != numParticles ) ;
+
+        const size_t groupHeaderOffset = message.Size() ;
+        message.Resize( groupHeaderOffset + sizeof( RemoteViewGroupHeader ) ) ;
+        for( unsigned channel = 0 ; channel < NUM_REMOTE_VIEW_CHANNELS ; ++ channel )
+        {   // For each channel...
+            QuantizeChannel( mQuantized , particles , RemoteViewChannelE( channel ) , mBoundsMin , mBoundsMax , state ) ;
+            const unsigned short * previous = ( isGroupKeyframe || ( 0 == numParticles ) ) ? NULLPTR : & state.mChannels[ channel ][ 0 ] ;
+            EncodeChannel( message , mQuantized.Empty() ? NULLPTR : & mQuantized[ 0 ] , previous , numParticles , sChannelBits[ channel ] ) ;
+            std::swap( state.mChannels[ channel ] , mQuantized ) ;  // Keep current values for next message, and reuse previous storage as scratch.
+        }
+
+        RemoteViewGroupHeader groupHeader ;
+        groupHeader.mNumParticles       = static_cast< unsigned >( numParticles ) ;
+        groupHeader.mIsKeyframe         = isGroupKeyframe ;
+        groupHeader.mSizeInBytes        = static_cast< unsigned >( message.Size() - groupHeaderOffset - sizeof( groupHeader ) ) ;
+        groupHeader.mDensityRange[ 0 ]  = state.mDensityRange[ 0 ] ;
+        groupHeader.mDensityRange[ 1 ]  = state.mDensityRange[ 1 ] ;
+        groupHeader.mSizeRange[ 0 ]     = state.mSizeRange[ 0 ] ;
+        groupHeader.mSizeRange[ 1 ]     = state.mSizeRange[ 1 ] ;
+        memcpy( & message[ groupHeaderOffset ] , & groupHeader , sizeof( groupHeader ) ) ;
+    }
+
+    RemoteViewMessageHeader header ;
+    header.mMagic       = RemoteViewMessageHeader::sMagic ;
+    header.mSizeInBytes = static_cast< unsigned >( message.Size() - sizeof( header ) ) ;
+    header.mFrame       = frame ;
+    header.mNumGroups   = static_cast< unsigned >( numGroups ) ;
+    header.mIsKeyframe  = isKeyframe ;
+    header.mPad         = 0 ;
+    header.mTimeNow     = timeNow ;
+    const Vec3 boundsExtent = mBoundsMax - mBoundsMin ;
+    memcpy( header.mBoundsMin    , & mBoundsMin   , sizeof( header.mBoundsMin    ) ) ;
+    memcpy( header.mBoundsExtent , & boundsExtent , sizeof( header.mBoundsExtent ) ) ;
+    memcpy( & message[ 0 ] , & header , sizeof( header ) ) ;
+}
+
+
+
+
+RemoteViewDecoder::RemoteViewDecoder()
+    : mBoundsMin( 0.0f , 0.0f , 0.0f )
+    , mBoundsExtent( 0.0f , 0.0f , 0.0f )
+    , mHasKeyframe( false )
+{
+}
+
+
+
+
+/** Decode the given message, updating quantized state.
+
+    \param header   Header of message.
+
+    \param payload  Bytes after header, numbering header.mSizeInBytes.
+
+    \return Whether decoding succeeded.  False means the message is malformed, or is not a keyframe and no keyframe preceded it; either way decoding resumes at the next keyframe.
+*/
+bool RemoteViewDecoder::Decode( const RemoteViewMessageHeader & header , const unsigned char * payload )
+{
+    PERF_BLOCK( RemoteViewDecoder__Decode ) ;
+
+    if( ! header.mIsKeyframe && ! mHasKeyframe )
+    {   // Message encodes differences from state this decoder lacks.
+        return false ;
+    }
+    mHasKeyframe = false ;  // Until this message decodes successfully.
+
+    mBoundsMin      = Vec3( header.mBoundsMin[ 0 ]    , header.mBoundsMin[ 1 ]    , header.mBoundsMin[ 2 ]    ) ;
+    mBoundsExtent   = Vec3( header.mBoundsExtent[ 0 ] , header.mBoundsExtent[ 1 ] , header.mBoundsExtent[ 2 ] ) ;
+    mGroups.Resize( header.mNumGroups ) ;
+
+    const unsigned char *       cursor  = payload ;
+    const unsigned char * const end     = payload + header.mSizeInBytes ;
+    for( unsigned iGroup = 0 ; iGroup < header.mNumGroups ; ++ iGroup )
+    {   // For each particle group...
+        RemoteViewGroupHeader groupHeader ;
+        if( size_t( end - cursor ) < sizeof( groupHeader ) )
+        {
+            return false ;
+        }
+        memcpy( & groupHeader , cursor , sizeof( groupHeader ) ) ;
+        cursor += sizeof( groupHeader ) ;
+        if( groupHeader.mSizeInBytes > size_t( end - cursor ) )
+        {
+            return false ;
+        }
+        const unsigned char * const groupEnd     = cursor + groupHeader.mSizeInBytes ;
+        const size_t                numParticles = groupHeader.mNumParticles ;
+
+        RemoteViewGroupState & state = mGroups[ iGroup ] ;
+        if( groupHeader.mIsKeyframe )
+        {   // Group encodes differences from zero.
+            for( unsigned channel = 0 ; channel < NUM_REMOTE_VIEW_CHANNELS ; ++ channel )
+            {
+                state.mChannels[ channel ].assign( numParticles , static_cast< unsigned short >( 0 ) ) ;
+            }
+        }
+        else if( state.mChannels[ 0 ].Size() != numParticles )
+        {   // Group encodes differences from a population this decoder does not have.
+            return false ;
+        }
+
+        for( unsigned channel = 0 ; channel < NUM_REMOTE_VIEW_CHANNELS ; ++ channel )
+        {   // For each channel...
+            unsigned short * values = state.mChannels[ channel ].Empty() ? NULLPTR : & state.mChannels[ channel ][ 0 ] ;
+            if( ! DecodeChannel( cursor , groupEnd , values , numParticles , sChannelBits[ channel ] ) )
+            {
+                return false ;
+            }
+        }
+        cursor = groupEnd ;
+
+        state.mDensityRange[ 0 ]    = groupHeader.mDensityRange[ 0 ] ;
+        state.mDensityRange[ 1 ]    = groupHeader.mDensityRange[ 1 ] ;
+        state.mSizeRange[ 0 ]       = groupHeader.mSizeRange[ 0 ] ;
+        state.mSizeRange[ 1 ]       = groupHeader.mSizeRange[ 1 ] ;
+        state.mHasRanges            = true ;
+    }
+
+    mHasKeyframe = true ;
+    return true ;
+}
+
+
+
+
+/** Convert quantized state into particles, one array per group.
+
+    This sets position, density, size and fire fractions of each particle,
+    and leaves other attributes as they were, or default for particles this
+    adds.
+*/
+void RemoteViewDecoder::Dequantize( VECTOR< VECTOR< Particle > > & particlesPerGroup ) const
+{
+    PERF_BLOCK( RemoteViewDecoder__Dequantize ) ;
+
+    const size_t numGroups = mGroups.Size() ;
+    particlesPerGroup.Resize( numGroups ) ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        const RemoteViewGroupState &    state           = mGroups[ iGroup ] ;
+        VECTOR< Particle > &            particles       = particlesPerGroup[ iGroup ] ;
+        const size_t                    numParticles    = state.mChannels[ 0 ].Size() ;
+        particles.Resize( numParticles ) ;
+
+        const Vec3  unitsPerPositionLevel( mBoundsExtent.x / 65535.0f , mBoundsExtent.y / 65535.0f , mBoundsExtent.z / 65535.0f ) ;
+        const float unitsPerDensityLevel    = ( state.mDensityRange[ 1 ] - state.mDensityRange[ 0 ] ) / 255.0f ;
+        const float unitsPerSizeLevel       = ( state.mSizeRange[ 1 ]    - state.mSizeRange[ 0 ]    ) / 255.0f ;
+        for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+        {   // For each particle...
+            Particle & pcl = particles[ iPcl ] ;
+            pcl.mPosition.x     = mBoundsMin.x + unitsPerPositionLevel.x * float( state.mChannels[ REMOTE_VIEW_CHANNEL_POSITION_X ][ iPcl ] ) ;
+            pcl.mPosition.y     = mBoundsMin.y + unitsPerPositionLevel.y * float( state.mChannels[ REMOTE_VIEW_CHANNEL_POSITION_Y ][ iPcl ] ) ;
+            pcl.mPosition.z     = mBoundsMin.z + unitsPerPositionLevel.z * float( state.mChannels[ REMOTE_VIEW_CHANNEL_POSITION_Z ][ iPcl ] ) ;
+            pcl.mDensity        = state.mDensityRange[ 0 ] + unitsPerDensityLevel * float( state.mChannels[ REMOTE_VIEW_CHANNEL_DENSITY ][ iPcl ] ) ;
+            pcl.mSize           = state.mSizeRange[ 0 ]    + unitsPerSizeLevel    * float( state.mChannels[ REMOTE_VIEW_CHANNEL_SIZE    ][ iPcl ] ) ;
+        #if ENABLE_FIRE
+            pcl.mFuelFraction   = float( state.mChannels[ REMOTE_VIEW_CHANNEL_FUEL_FRACTION  ][ iPcl ] ) * ( 1.0f / 255.0f ) ;
+            pcl.mFlameFraction  = float( state.mChannels[ REMOTE_VIEW_CHANNEL_FLAME_FRACTION ][ iPcl ] ) * ( 1.0f / 255.0f ) ;
+            pcl.mSmokeFraction  = float( state.mChannels[ REMOTE_VIEW_CHANNEL_SMOKE_FRACTION ][ iPcl ] ) * ( 1.0f / 255.0f ) ;
+        #endif
+        }
+    }
+}
+
+
+
+
+#if REMOTE_VIEW_ASYNC
+
+/** Send all the given bytes, as many calls to send as that takes.
+
+    \return Whether sending succeeded.  False means the peer disconnected.
+*/
+static bool SendAll( SOCKET connection , const unsigned char * bytes , size_t numBytes )
+{
+    while( numBytes > 0 )
+    {
+        const int numSent = send( connection , reinterpret_cast< const char * >( bytes ) , int( Min2( numBytes , size_t( 1 << 20 ) ) ) , 0 ) ;
+        if( numSent <= 0 )
+        {
+            return false ;
+        }
+        bytes       += numSent ;
+        numBytes    -= size_t( numSent ) ;
+    }
+    return true ;
+}
+
+
+
+
+/** Receive exactly the given number of bytes, as many calls to recv as that takes.
+
+    \return Whether receiving succeeded.  False means the peer disconnected.
+*/
+static bool ReceiveAll( SOCKET connection , unsigned char * bytes , size_t numBytes )
+{
+    while( numBytes > 0 )
+    {
+        const int numReceived = recv( connection , reinterpret_cast< char * >( bytes ) , int( Min2( numBytes , size_t( 1 << 20 ) ) ) , 0 ) ;
+        if( numReceived <= 0 )
+        {
+            return false ;
+        }
+        bytes       += numReceived ;
+        numBytes    -= size_t( numReceived ) ;
+    }
+    return true ;
+}
+
+#endif
+
+
+
+
+/** Construct server that owns the given number of messages.
+
+    \param capacity Number of messages that can await sending before SubmitFrame starts dropping frames.
+*/
+RemoteViewServer::RemoteViewServer( size_t capacity )
+    : mEncoder()
+#if REMOTE_VIEW_ASYNC
+    , mSenderThread( NULL )
+    , mListenSocket( INVALID_SOCKET )
+    , mKeyframeRequested( 0 )
+#endif
+    , mIsViewerConnected( false )
+    , mIsServing( false )
+    , mNumDroppedFrames( 0 )
+{
+#if REMOTE_VIEW_ASYNC
+    ASSERT( capacity >= 1 ) ;
+    mFree.set_capacity( capacity ) ;
+    mPending.set_capacity( capacity + 1 ) ; // Room for the NULL that tells the sender thread to exit.
+    mMessages.Reserve( capacity ) ;
+    for( size_t iMessage = 0 ; iMessage < capacity ; ++ iMessage )
+    {   // For each message to own...
+        mMessages.PushBack( new Message ) ;
+    }
+#else
+    (void) capacity ;
+#endif
+}
+
+
+
+
+RemoteViewServer::~RemoteViewServer()
+{
+    StopServer() ;
+    const size_t numMessages = mMessages.Size() ;
+    for( size_t iMessage = 0 ; iMessage < numMessages ; ++ iMessage )
+    {   // For each message this server owns...
+        delete mMessages[ iMessage ] ;
+    }
+}
+
+
+
+
+/** Start a thread that accepts viewers on the given port and streams frames to them.
+
+    \param port     TCP port on which to listen, on every network interface.
+
+    \return Whether server started.  False means sockets are unavailable or the port is in use.
+*/
+bool RemoteViewServer::StartServer( unsigned short port )
+{
+#if REMOTE_VIEW_ASYNC
+    StopServer() ;
+
+    WSADATA wsaData ;
+    if( WSAStartup( MAKEWORD( 2 , 2 ) , & wsaData ) != 0 )
+    {
+        return false ;
+    }
+
+    const SOCKET listenSocket = socket( AF_INET , SOCK_STREAM , IPPROTO_TCP ) ;
+    if( INVALID_SOCKET == listenSocket )
+    {
+        WSACleanup() ;
+        return false ;
+    }
+
+    sockaddr_in address ;
+    memset( & address , 0 , sizeof( address ) ) ;
+    address.sin_family      = AF_INET ;
+    address.sin_addr.s_addr = htonl( INADDR_ANY ) ;
+    address.sin_port        = htons( port ) ;
+    if(     ( bind( listenSocket , reinterpret_cast< sockaddr * >( & address ) , sizeof( address ) ) != 0 )
+        ||  ( listen( listenSocket , 1 ) != 0 ) )
+    {   // Port is in use, or similar.
+        closesocket( listenSocket ) ;
+        WSACleanup() ;
+        return false ;
+    }
+
+    const size_t numMessages = mMessages.Size() ;
+    for( size_t iMessage = 0 ; iMessage < numMessages ; ++ iMessage )
+    {   // For each message this server owns...
+        mFree.push( mMessages[ iMessage ] ) ;
+    }
+
+    mListenSocket       = listenSocket ;
+    mNumDroppedFrames   = 0 ;
+    mIsServing          = true ;
+    mSenderThread       = CreateThread( NULL , 0 , SenderThreadMain , this , 0 , NULL ) ;
+    ASSERT( mSenderThread ) ;
+    return true ;
+#else
+    (void) port ;
+    return false ;
+#endif
+}
+
+
+
+
+/** Disconnect any viewer and stop the sender thread, if it is running.
+*/
+void RemoteViewServer::StopServer()
+{
+#if REMOTE_VIEW_ASYNC
+    if( ! mIsServing )
+    {
+        return ;
+    }
+    mIsServing = false ;
+    closesocket( mListenSocket ) ;  // Makes accept in sender thread fail, so it exits.
+    mListenSocket = INVALID_SOCKET ;
+    mPending.push( NULLPTR ) ;      // Tells sender thread to exit, if it is sending instead of accepting.
+    WaitForSingleObject( mSenderThread , INFINITE ) ;
+    CloseHandle( mSenderThread ) ;
+    mSenderThread = NULL ;
+    mPending.clear() ;
+    mFree.clear() ;
+    WSACleanup() ;
+#endif
+}
+
+
+
+
+/** Encode the given data for one frame, and queue it for sending.
+
+    \param particleSystem   Particle system whose particles to stream.
+
+    \param geometry         Geometry of a grid that spans the particles, such as the velocity grid.
+
+    \param frame            Frame counter.
+
+    \param timeNow          Virtual time.
+
+    This never waits for the network: If every message still awaits sending, this drops this frame.
+
+    \return Whether this queued the frame.  False means either no viewer is connected, or the viewer fell behind.
+*/
+bool RemoteViewServer::SubmitFrame( const ParticleSystem & particleSystem , const UniformGridGeometry & geometry , unsigned frame , double timeNow )
+{
+    PERF_BLOCK( RemoteViewServer__SubmitFrame ) ;
+
+#if REMOTE_VIEW_ASYNC
+    if( ! mIsViewerConnected )
+    {   // Nobody is watching.
+        return false ;
+    }
+
+    Message * message = NULLPTR ;
+    if( ! mFree.try_pop( message ) )
+    {   // Sender thread fell behind.  Drop this frame rather than stall the caller.  Encoder state does not advance, so the next frame encodes differences from the last one queued.
+        ++ mNumDroppedFrames ;
+        return false ;
+    }
+
+    if( InterlockedExchange( & mKeyframeRequested , 0 ) )
+    {   // A viewer connected, so it needs a keyframe.
+        mEncoder.RequestKeyframe() ;
+    }
+    mEncoder.Encode( particleSystem , geometry , frame , timeNow , message->mBytes ) ;
+    message->mIsKeyframe = ( reinterpret_cast< const RemoteViewMessageHeader * >( & message->mBytes[ 0 ] )->mIsKeyframe != 0 ) ;
+    mPending.push( message ) ;
+    return true ;
+#else
+    (void) particleSystem ; (void) geometry ; (void) frame ; (void) timeNow ;
+    return false ;
+#endif
+}
+
+
+
+
+#if REMOTE_VIEW_ASYNC
+
+/** Accept viewers, one at a time, and send each pending messages, until StopServer says to exit.
+
+    \param context  Address of the RemoteViewServer instance.
+*/
+/* static */ DWORD WINAPI RemoteViewServer::SenderThreadMain( LPVOID context )
+{
+    RemoteViewServer * server = reinterpret_cast< RemoteViewServer * >( context ) ;
+
+    bool quit = false ;
+    while( ! quit )
+    {   // For each viewer...
+        const SOCKET connection = accept( static_cast< SOCKET >( server->mListenSocket ) , NULL , NULL ) ;
+        if( INVALID_SOCKET == connection )
+        {   // StopServer closed listen socket.
+            break ;
+        }
+
+        InterlockedExchange( & server->mKeyframeRequested , 1 ) ;
+        server->mIsViewerConnected = true ;
+
+        bool awaitingKeyframe = true ;  // Viewer has no state, so messages before the next keyframe are useless to it.
+        for( ;; )
+        {   // For each message submitted...
+            Message * message = NULLPTR ;
+            server->mPending.pop( message ) ;
+            if( NULLPTR == message )
+            {   // StopServer wants this thread to exit.
+                quit = true ;
+                break ;
+            }
+            awaitingKeyframe = awaitingKeyframe && ! message->mIsKeyframe ;
+            const bool sent = awaitingKeyframe || SendAll( connection , & message->mBytes[ 0 ] , message->mBytes.Size() ) ;
+            server->mFree.push( message ) ;
+            if( ! sent )
+            {   // Viewer disconnected.
+                break ;
+            }
+        }
+
+        server->mIsViewerConnected = false ;
+        shutdown( connection , SD_SEND ) ;
+        closesocket( connection ) ;
+    }
+
+    return 0 ;
+}
+
+#endif
+
+
+
+
+/** Construct client that owns the given number of snapshots.
+
+    \param capacity Number of snapshots that circulate between the receiver thread and Update.  Must be at least 2.
+*/
+RemoteViewClient::RemoteViewClient( size_t capacity )
+    : mHeldSnapshot( NULLPTR )
+#if REMOTE_VIEW_ASYNC
+    , mReceiverThread( NULL )
+    , mSocket( INVALID_SOCKET )
+#endif
+    , mIsConnected( false )
+{
+#if REMOTE_VIEW_ASYNC
+    ASSERT( capacity >= 2 ) ;
+    mFree.set_capacity( capacity ) ;
+    mReady.set_capacity( capacity ) ;
+    mSnapshots.Reserve( capacity ) ;
+    for( size_t iSnapshot = 0 ; iSnapshot < capacity ; ++ iSnapshot )
+    {   // For each snapshot to own...
+        mSnapshots.PushBack( new RemoteViewSnapshot ) ;
+    }
+#else
+    (void) capacity ;
+#endif
+}
+
+
+
+
+RemoteViewClient::~RemoteViewClient()
+{
+    Disconnect() ;
+    const size_t numSnapshots = mSnapshots.Size() ;
+    for( size_t iSnapshot = 0 ; iSnapshot < numSnapshots ; ++ iSnapshot )
+    {   // For each snapshot this client owns...
+        delete mSnapshots[ iSnapshot ] ;
+    }
+}
+
+
+
+
+/** Connect to the RemoteViewServer at the given host and port, and start receiving frames.
+
+    \param hostName Name or dotted address of machine running the server.
+
+    \param port     TCP port on which the server listens.
+
+    \return Whether connecting succeeded.
+*/
+bool RemoteViewClient::Connect( const char * hostName , unsigned short port )
+{
+    PERF_BLOCK( RemoteViewClient__Connect ) ;
+
+#if REMOTE_VIEW_ASYNC
+    Disconnect() ;
+
+    WSADATA wsaData ;
+    if( WSAStartup( MAKEWORD( 2 , 2 ) , & wsaData ) != 0 )
+    {
+        return false ;
+    }
+
+    sockaddr_in address ;
+    memset( & address , 0 , sizeof( address ) ) ;
+    address.sin_family      = AF_INET ;
+    address.sin_port        = htons( port ) ;
+    address.sin_addr.s_addr = inet_addr( hostName ) ;
+    if( INADDR_NONE == address.sin_addr.s_addr )
+    {   // Not a dotted address, so look up name.
+        const hostent * host = gethostbyname( hostName ) ;
+        if( ( NULLPTR == host ) || ( host->h_addrtype != AF_INET ) )
+        {
+            WSACleanup() ;
+            return false ;
+        }
+        memcpy( & address.sin_addr , host->h_addr_list[ 0 ] , sizeof( address.sin_addr ) ) ;
+    }
+
+    const SOCKET connection = socket( AF_INET , SOCK_STREAM , IPPROTO_TCP ) ;
+    if( INVALID_SOCKET == connection )
+    {
+        WSACleanup() ;
+        return false ;
+    }
+    if( connect( connection , reinterpret_cast< sockaddr * >( & address ) , sizeof( address ) ) != 0 )
+    {   // Server is not running, or unreachable.
+        closesocket( connection ) ;
+        WSACleanup() ;
+        return false ;
+    }
+
+    const size_t numSnapshots = mSnapshots.Size() ;
+    for( size_t iSnapshot = 0 ; iSnapshot < numSnapshots ; ++ iSnapshot )
+    {   // For each snapshot this client owns...
+        mFree.push( mSnapshots[ iSnapshot ] ) ;
+    }
+
+    mDecoder.Reset() ;
+    mSocket         = connection ;
+    mIsConnected    = true ;
+    mReceiverThread = CreateThread( NULL , 0 , ReceiverThreadMain , this , 0 , NULL ) ;
+    ASSERT( mReceiverThread ) ;
+    return true ;
+#else
+    (void) hostName ; (void) port ;
+    return false ;
+#endif
+}
+
+
+
+
+/** Close the connection and stop the receiver thread, if it is running.
+*/
+void RemoteViewClient::Disconnect()
+{
+#if REMOTE_VIEW_ASYNC
+    if( NULL == mReceiverThread )
+    {   // Never connected, or already disconnected.
+        return ;
+    }
+    closesocket( mSocket ) ;    // Makes recv in receiver thread fail, so it exits.
+    mSocket = INVALID_SOCKET ;
+    WaitForSingleObject( mReceiverThread , INFINITE ) ;
+    CloseHandle( mReceiverThread ) ;
+    mReceiverThread = NULL ;
+    mIsConnected    = false ;
+    mReady.clear() ;
+    mFree.clear() ;
+    mHeldSnapshot   = NULLPTR ;
+    WSACleanup() ;
+#endif
+}
+
+
+
+
+/** Swap particles of the newest received frame into the given particle system.
+
+    \param particleSystem   Particle system whose groups receive particles.  Group i receives the particles the server sent for group i.
+
+    \param frame            (out) Frame counter of frame, if this returns true.
+
+    \param timeNow          (out) Virtual time of frame, if this returns true.
+
+    \return Whether a frame arrived since the previous call.
+*/
+bool RemoteViewClient::Update( ParticleSystem & particleSystem , unsigned & frame , double & timeNow )
+{
+    PERF_BLOCK( RemoteViewClient__Update ) ;
+
+#if REMOTE_VIEW_ASYNC
+    RemoteViewSnapshot * newest = NULLPTR ;
+    RemoteViewSnapshot * snapshot = NULLPTR ;
+    while( mReady.try_pop( snapshot ) )
+    {   // For each snapshot the receiver thread filled...
+        if( newest )
+        {   // Rendering fell behind, so skip the older snapshot.
+            mFree.push( newest ) ;
+        }
+        newest = snapshot ;
+    }
+    if( NULLPTR == newest )
+    {   // Nothing new arrived.
+        return false ;
+    }
+
+    // Swap particles instead of copying them, so the snapshot keeps the previous arrays, whose storage the receiver thread reuses.
+    const size_t numGroups = Min2( particleSystem.GetNumGroups() , newest->mParticlesPerGroup.Size() ) ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        std::swap( particleSystem.GetGroup( iGroup )->GetParticles() , newest->mParticlesPerGroup[ iGroup ] ) ;
+    }
+    frame   = newest->mFrame ;
+    timeNow = newest->mTimeNow ;
+
+    if( mHeldSnapshot )
+    {
+        mFree.push( mHeldSnapshot ) ;
+    }
+    mHeldSnapshot = newest ;
+    return true ;
+#else
+    (void) particleSystem ; (void) frame ; (void) timeNow ;
+    return false ;
+#endif
+}
+
+
+
+
+#if REMOTE_VIEW_ASYNC
+
+/** Receive and decode messages until the connection closes.
+
+    \param context  Address of the RemoteViewClient instance.
+*/
+/* static */ DWORD WINAPI RemoteViewClient::ReceiverThreadMain( LPVOID context )
+{
+    RemoteViewClient *  client      = reinterpret_cast< RemoteViewClient * >( context ) ;
+    const SOCKET        connection  = static_cast< SOCKET >( client->mSocket ) ;
+
+    for( ;; )
+    {   // For each message...
+        RemoteViewMessageHeader header ;
+        if(     ! ReceiveAll( connection , reinterpret_cast< unsigned char * >( & header ) , sizeof( header ) )
+            ||  ( header.mMagic != RemoteViewMessageHeader::sMagic )
+            ||  ( header.mSizeInBytes > RemoteViewMessageHeader::sMaxPayload ) )
+        {   // Connection closed, or server speaks some other protocol.
+            break ;
+        }
+        client->mPayload.Resize( Max2( size_t( 1 ) , size_t( header.mSizeInBytes ) ) ) ;
+        if( ! ReceiveAll( connection , & client->mPayload[ 0 ] , header.mSizeInBytes ) )
+        {   // Connection closed.
+            break ;
+        }
+        if( ! client->mDecoder.Decode( header , & client->mPayload[ 0 ] ) )
+        {   // Message is malformed, or precedes the first keyframe.  Decoder resumes at the next keyframe.
+            continue ;
+        }
+
+        RemoteViewSnapshot * snapshot = NULLPTR ;
+        if( client->mFree.try_pop( snapshot ) )
+        {   // Rendering has room for another frame.
+            client->mDecoder.Dequantize( snapshot->mParticlesPerGroup ) ;
+            snapshot->mFrame    = header.mFrame ;
+            snapshot->mTimeNow  = header.mTimeNow ;
+            client->mReady.push( snapshot ) ;
+        }
+    }
+
+    client->mIsConnected = false ;
+    return 0 ;
+}
+
+#endif
@@ -0,0 +1,310 @@
+/** \file remoteView.h
+
+    \brief Streaming of quantized, delta-encoded particle state from a simulation to remote viewers.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef REMOTE_VIEW_H
+#define REMOTE_VIEW_H
+
+#include <Core/useTbb.h>
+
+#include <Core/Containers/vector.h>
+#include <Core/SpatialPartition/uniformGrid.h>
+
+#include <Particles/particle.h>
+
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
+#if USE_TBB
+#   include "tbb/concurrent_queue.h"
+#endif
+
+// Forward declarations
+class ParticleSystem ;
+
+// Macros --------------------------------------------------------------
+
+/** Whether RemoteViewServer and RemoteViewClient can run.
+
+    They use Winsock for sockets, Win32 threads, and TBB queues between
+    threads.  Without those, StartServer and Connect return false, but
+    RemoteViewEncoder and RemoteViewDecoder still work.
+*/
+#if USE_TBB && defined( WIN32 )
+#   define REMOTE_VIEW_ASYNC 1
+#else
+#   define REMOTE_VIEW_ASYNC 0
+#endif
+
+// Types --------------------------------------------------------------
+
+/** Quantized values a remote view message carries for each particle.
+*/
+enum RemoteViewChannelE
+{
+    REMOTE_VIEW_CHANNEL_POSITION_X      ,   ///< 16 bits, relative to message bounds.
+    REMOTE_VIEW_CHANNEL_POSITION_Y      ,   ///< 16 bits, relative to message bounds.
+    REMOTE_VIEW_CHANNEL_POSITION_Z      ,   ///< 16 bits, relative to message bounds.
+    REMOTE_VIEW_CHANNEL_DENSITY         ,   ///< 8 bits, relative to group density range.
+    REMOTE_VIEW_CHANNEL_SIZE            ,   ///< 8 bits, relative to group size range.
+    REMOTE_VIEW_CHANNEL_FUEL_FRACTION   ,   ///< 8 bits, over [0,1].
+    REMOTE_VIEW_CHANNEL_FLAME_FRACTION  ,   ///< 8 bits, over [0,1].
+    REMOTE_VIEW_CHANNEL_SMOKE_FRACTION  ,   ///< 8 bits, over [0,1].
+    NUM_REMOTE_VIEW_CHANNELS
+} ;
+
+
+
+
+/** Header at the start of each remote view message.
+
+    A message is this header, then, for each particle group, a
+    RemoteViewGroupHeader followed by its channels.  Each channel holds one
+    quantized value per particle, as the difference from that particle's
+    value in the previous message (or from zero, in a keyframe), encoded
+    as zigzag variable-length integers, with runs of unchanged values
+    collapsed to a zero and a run length.  Particles that barely move cost
+    about one byte per axis, and particles that do not change cost almost
+    nothing.
+*/
+struct RemoteViewMessageHeader
+{
+    static const unsigned sMagic        = 0x56474a4d ;  ///< "MJGV" in little-endian byte order.
+    static const unsigned sMaxPayload   = 1u << 28 ;    ///< Largest payload a viewer accepts, so a corrupt header cannot make it allocate without bound.
+
+    unsigned    mMagic              ;   ///< Identifies message.  Must equal sMagic.
+    unsigned    mSizeInBytes        ;   ///< Number of bytes in message after this header.
+    unsigned    mFrame              ;   ///< Frame counter of simulation.
+    unsigned    mNumGroups          ;   ///< Number of particle groups that follow.
+    unsigned    mIsKeyframe         ;   ///< Whether every group encodes values relative to zero, so a viewer can start decoding here.
+    unsigned    mPad                ;   ///< Unused; keeps mTimeNow naturally aligned.
+    double      mTimeNow            ;   ///< Virtual time of simulation.
+    float       mBoundsMin[ 3 ]     ;   ///< Minimum corner of box that quantized positions span.
+    float       mBoundsExtent[ 3 ]  ;   ///< Size of box that quantized positions span.
+} ;
+
+
+
+
+/** Header of each particle group in a remote view message.
+*/
+struct RemoteViewGroupHeader
+{
+    unsigned    mNumParticles       ;   ///< Number of particles in group.
+    unsigned    mIsKeyframe         ;   ///< Whether channels encode values relative to zero, rather than to the previous message.
+    unsigned    mSizeInBytes        ;   ///< Number of bytes of channel data that follow.
+    float       mDensityRange[ 2 ]  ;   ///< Minimum and maximum density that quantized densities span.
+    float       mSizeRange[ 2 ]     ;   ///< Minimum and maximum size that quantized sizes span.
+} ;
+
+
+
+
+/** Quantized state of one particle group, as of the most recent message, which the next message encodes differences from.
+*/
+struct RemoteViewGroupState
+{
+    RemoteViewGroupState() : mHasRanges( false ) {}
+
+    VECTOR< unsigned short >    mChannels[ NUM_REMOTE_VIEW_CHANNELS ]   ;   ///< Quantized value of each channel of each particle.
+    float                       mDensityRange[ 2 ]                      ;   ///< Minimum and maximum density that quantized densities span.
+    float                       mSizeRange[ 2 ]                         ;   ///< Minimum and maximum size that quantized sizes span.
+    bool                        mHasRanges                              ;   ///< Whether ranges hold values yet.
+} ;
+
+
+
+
+/** Encoder of particle state into remote view messages, each relative to the previous one.
+
+    Positions quantize to 16 bits per axis, relative to a box that covers the
+    given grid geometry.  That box only grows, with some margin, and only
+    when the grid leaves it, since changing it invalidates every quantized
+    position, and thereby forces a keyframe.  Densities and sizes quantize to
+    8 bits relative to per-group ranges that grow likewise.  Fire fractions
+    quantize to 8 bits over [0,1].
+
+    A group whose population changed since the previous message encodes
+    relative to zero, since particle i might no longer be the same particle.
+*/
+class RemoteViewEncoder
+{
+    public:
+        RemoteViewEncoder() ;
+
+        /// Make the next message a keyframe, for example because a new viewer connected.
+        void    RequestKeyframe()   { mNeedKeyframe = true ; }
+
+        void    Encode( const ParticleSystem & particleSystem , const UniformGridGeometry & geometry , unsigned frame , double timeNow , VECTOR< unsigned char > & message ) ;
+
+    private:
+        bool    CoverBounds( const UniformGridGeometry & geometry ) ;
+
+        VECTOR< RemoteViewGroupState >  mGroups         ;   ///< Quantized state of each group, as of the previous message.
+        VECTOR< unsigned short >        mQuantized      ;   ///< Scratch space: Quantized values of one channel of one group, for the current message.
+        Vec3                            mBoundsMin      ;   ///< Minimum corner of box that quantized positions span.
+        Vec3                            mBoundsMax      ;   ///< Maximum corner of box that quantized positions span.
+        bool                            mHasBounds      ;   ///< Whether mBoundsMin and mBoundsMax hold values yet.
+        bool                            mNeedKeyframe   ;   ///< Whether the next message must be a keyframe.
+} ;
+
+
+
+
+/** Decoder of remote view messages into particles.
+*/
+class RemoteViewDecoder
+{
+    public:
+        RemoteViewDecoder() ;
+
+        /// Forget state, so decoding resumes at the next keyframe.
+        void    Reset() { mHasKeyframe = false ; }
+
+        bool    Decode( const RemoteViewMessageHeader & header , const unsigned char * payload ) ;
+        void    Dequantize( VECTOR< VECTOR< Particle > > & particlesPerGroup ) const ;
+
+    private:
+        VECTOR< RemoteViewGroupState >  mGroups         ;   ///< Quantized state of each group, as of the most recent message.
+        Vec3                            mBoundsMin      ;   ///< Minimum corner of box that quantized positions span.
+        Vec3                            mBoundsExtent   ;   ///< Size of box that quantized positions span.
+        bool                            mHasKeyframe    ;   ///< Whether state derives from a keyframe, so later messages can decode relative to it.
+} ;
+
+
+
+
+/** Server that streams particle state, each simulated frame, to one remote viewer at a time.
+
+    SubmitFrame encodes the frame into a message from a bounded pool and
+    queues it.  A background thread accepts a viewer, then sends it queued
+    messages.  When the viewer or network falls behind and no message is
+    free, SubmitFrame drops the frame instead of waiting, so streaming never
+    stalls simulation.  Dropped frames never get encoded, so every queued
+    message still encodes differences from the one queued before it.
+
+    When a viewer connects, the next message becomes a keyframe, and the
+    sender skips queued messages ahead of it, since that viewer lacks the
+    state they encode differences from.  While no viewer is connected,
+    SubmitFrame costs nothing.
+*/
+class RemoteViewServer
+{
+    public:
+        explicit RemoteViewServer( size_t capacity = 4 ) ;
+        ~RemoteViewServer() ;
+
+        bool    StartServer( unsigned short port ) ;
+        void    StopServer() ;
+
+        /// Return whether the server is running.
+        bool    IsServing() const { return mIsServing ; }
+
+        /// Return whether a viewer is connected.
+        bool    IsViewerConnected() const { return mIsViewerConnected ; }
+
+        bool    SubmitFrame( const ParticleSystem & particleSystem , const UniformGridGeometry & geometry , unsigned frame , double timeNow ) ;
+
+        /// Return number of frames SubmitFrame dropped because the viewer fell behind, since StartServer.
+        size_t  GetNumDroppedFrames() const { return mNumDroppedFrames ; }
+
+    private:
+        /// Encoded message, awaiting sending.
+        struct Message
+        {
+            VECTOR< unsigned char > mBytes      ;   ///< Header and payload.
+            bool                    mIsKeyframe ;   ///< Whether a viewer can start decoding at this message.
+        } ;
+
+        RemoteViewServer( const RemoteViewServer & ) ;              // Disallow copy
+        RemoteViewServer & operator=( const RemoteViewServer & ) ;  // Disallow assignment
+
+    #if REMOTE_VIEW_ASYNC
+        static DWORD WINAPI SenderThreadMain( LPVOID context ) ;
+    #endif
+
+        RemoteViewEncoder                           mEncoder            ;   ///< Encoder of particle state, relative to the previous queued message.
+        VECTOR< Message * >                         mMessages           ;   ///< All messages this server owns.
+    #if REMOTE_VIEW_ASYNC
+        tbb::concurrent_bounded_queue< Message * >  mFree               ;   ///< Messages available for SubmitFrame to fill.
+        tbb::concurrent_bounded_queue< Message * >  mPending            ;   ///< Messages SubmitFrame filled, oldest first, awaiting the sender thread.  NULL tells the thread to exit.
+        HANDLE                                      mSenderThread       ;   ///< Thread that accepts viewers and sends them pending messages.
+        UINT_PTR                                    mListenSocket       ;   ///< Socket on which server accepts viewers.  Closing it tells the sender thread to exit.
+        volatile LONG                               mKeyframeRequested  ;   ///< Nonzero when a viewer connected since SubmitFrame last encoded a keyframe.
+    #endif
+        volatile bool                               mIsViewerConnected  ;   ///< Whether the sender thread has a viewer.
+        volatile bool                               mIsServing          ;   ///< Whether the server is running.
+        size_t                                      mNumDroppedFrames   ;   ///< Number of frames dropped because the viewer fell behind.
+} ;
+
+
+
+
+/** Particles that a remote viewer decoded from one message.
+*/
+struct RemoteViewSnapshot
+{
+    VECTOR< VECTOR< Particle > >    mParticlesPerGroup  ;   ///< Particles of each group.
+    unsigned                        mFrame              ;   ///< Frame counter of simulation.
+    double                          mTimeNow            ;   ///< Virtual time of simulation.
+} ;
+
+
+
+
+/** Viewer that receives particle state from a RemoteViewServer, for rendering through an ordinary particle system.
+
+    A background thread receives and decodes every message, since each
+    encodes differences from the one before, then dequantizes the newest
+    state into a snapshot from a bounded pool.  Update swaps the newest
+    snapshot's particles into the given particle system, whose groups the
+    existing ParticlesRenderModel renders.  When rendering falls behind,
+    the receiver skips dequantizing, but keeps decoding.
+
+    Messages carry positions, densities, sizes and fire fractions.  Other
+    particle attributes keep whatever values they had.
+*/
+class RemoteViewClient
+{
+    public:
+        explicit RemoteViewClient( size_t capacity = 3 ) ;
+        ~RemoteViewClient() ;
+
+        bool    Connect( const char * hostName , unsigned short port ) ;
+        void    Disconnect() ;
+
+        /// Return whether the receiver thread still has a connection.
+        bool    IsConnected() const { return mIsConnected ; }
+
+        bool    Update( ParticleSystem & particleSystem , unsigned & frame , double & timeNow ) ;
+
+    private:
+        RemoteViewClient( const RemoteViewClient & ) ;              // Disallow copy
+        RemoteViewClient & operator=( const RemoteViewClient & ) ;  // Disallow assignment
+
+    #if REMOTE_VIEW_ASYNC
+        static DWORD WINAPI ReceiverThreadMain( LPVOID context ) ;
+    #endif
+
+        RemoteViewDecoder                                       mDecoder            ;   ///< Decoder of received messages.  Only the receiver thread uses it.
+        VECTOR< unsigned char >                                 mPayload            ;   ///< Payload of most recently received message.  Only the receiver thread uses it.
+        VECTOR< RemoteViewSnapshot * >                          mSnapshots          ;   ///< All snapshots this client owns.
+        RemoteViewSnapshot *                                    mHeldSnapshot       ;   ///< Snapshot whose particles Update most recently swapped into the particle system, or NULL.
+    #if REMOTE_VIEW_ASYNC
+        tbb::concurrent_bounded_queue< RemoteViewSnapshot * >   mFree               ;   ///< Snapshots available for the receiver thread to fill.
+        tbb::concurrent_bounded_queue< RemoteViewSnapshot * >   mReady              ;   ///< Snapshots the receiver thread filled, oldest first.
+        HANDLE                                                  mReceiverThread     ;   ///< Thread that receives and decodes messages.
+        UINT_PTR                                                mSocket             ;   ///< Socket connected to the server.  Closing it tells the receiver thread to exit.
+    #endif
+        volatile bool                                           mIsConnected        ;   ///< Whether the receiver thread has a connection.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
@@ -0,0 +1,398 @@
+/** \file simulationCheckpoint.cpp
+
+    \brief Binary checkpoint of simulation state, laid out so loading can map the file instead of parsing it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "simulationCheckpoint.h"
+
+#include <Particles/particleSystem.h>
+
+#include <Impulsion/physicalObject.h>
+
+#include <Core/Performance/perfBlock.h>
+
+#if defined( WIN32 )
+    #include <windows.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+// Types --------------------------------------------------------------
+// Private functions --------------------------------------------------------------
+
+
+
+
+/** Return given offset rounded up to the next page boundary.
+*/
+static unsigned long long RoundUpToPage( unsigned long long offset )
+{
+    const unsigned long long pageSize = SimulationCheckpointHeader::sPageSize ;
+    return ( offset + pageSize - 1 ) / pageSize * pageSize ;
+}
+
+
+
+
+/** Append a section to the given header, placing it after all previous sections, at a page boundary.
+
+    \return Address of the new section description, so the caller can fill in type-specific members.
+*/
+static SimulationCheckpointSection * AppendSection( SimulationCheckpointHeader & header , SimulationCheckpointSectionE type , size_t elementSize , size_t numElements )
+{
+    ASSERT( header.mNumSections < SimulationCheckpointHeader::sMaxSections ) ;
+
+    unsigned long long offset = SimulationCheckpointHeader::sPageSize ;   // First section follows header page.
+    if( header.mNumSections > 0 )
+    {
+        const SimulationCheckpointSection & previous = header.mSections[ header.mNumSections - 1 ] ;
+        offset = RoundUpToPage( previous.mOffset + previous.mNumElements * previous.mElementSize ) ;
+    }
+
+    SimulationCheckpointSection & section = header.mSections[ header.mNumSections ++ ] ;
+    memset( & section , 0 , sizeof( section ) ) ;
+    section.mType           = type ;
+    section.mElementSize    = static_cast< unsigned >( elementSize ) ;
+    section.mOffset         = offset ;
+    section.mNumElements    = numElements ;
+    return & section ;
+}
+
+
+
+
+/** Write zeros to the given file, from the given number of bytes past a page boundary, up to the next page boundary.
+
+    \return Whether writing succeeded.
+*/
+static bool WritePadding( FILE * fp , size_t numBytesWritten )
+{
+    static const char zeros[ SimulationCheckpointHeader::sPageSize ] = { 0 } ;
+
+    const size_t numPadBytes = static_cast< size_t >( RoundUpToPage( numBytesWritten ) - numBytesWritten ) ;
+    return ( 0 == numPadBytes ) || ( fwrite( zeros , 1 , numPadBytes , fp ) == numPadBytes ) ;
+}
+
+
+
+
+/** Write the given bytes to the given file, then pad with zeros up to the next page boundary.
+
+    \return Whether writing succeeded.
+*/
+static bool WritePadded( FILE * fp , const void * data , size_t numBytes )
+{
+    if( ( numBytes > 0 ) && ( fwrite( data , 1 , numBytes , fp ) != numBytes ) )
+    {
+        return false ;
+    }
+    return WritePadding( fp , numBytes ) ;
+}
+
+// Public functions --------------------------------------------------------------
+
+
+
+
+/** Write a checkpoint of the given simulation state to the given file.
+
+    Each section is a raw copy of an in-memory array, so saving costs little
+    more than the disk bandwidth to write those arrays.
+
+    \return Whether writing succeeded.
+*/
+bool SimulationCheckpoint_Save( const char * filename , const SimulationCheckpointContents & contents )
+{
+    PERF_BLOCK( SimulationCheckpoint_Save ) ;
+
+    ASSERT( contents.mParticleSystem && contents.mPhysicalObjects ) ;
+
+    const ParticleSystem &                          particleSystem  = * contents.mParticleSystem ;
+    const VECTOR< Impulsion::PhysicalObject * > &   physicalObjects = * contents.mPhysicalObjects ;
+
+    // Describe layout.
+    SimulationCheckpointHeader header ;
+    memset( & header , 0 , sizeof( header ) ) ;
+    header.mMagic           = SimulationCheckpointHeader::sMagic ;
+    header.mVersion         = SimulationCheckpointHeader::sVersion ;
+    header.mSizeofParticle  = sizeof( Particle ) ;
+    header.mSizeofRigidBody = sizeof( Impulsion::RigidBody ) ;
+    header.mScenario        = contents.mScenario ;
+    header.mFrame           = contents.mFrame ;
+    header.mTimeNow         = contents.mTimeNow ;
+
+    const size_t numGroups = particleSystem.GetNumGroups() ;
+    for( size_t iGroup = 0 ; iGroup < numGroups ; ++ iGroup )
+    {   // For each particle group...
+        SimulationCheckpointSection * section = AppendSection( header , SIMULATION_CHECKPOINT_SECTION_PARTICLE_GROUP , sizeof( Particle ) , particleSystem.GetGroup( iGroup )->GetParticles().Size() ) ;
+        section->mGroupIndex = static_cast< unsigned >( iGroup ) ;
+    }
+
+    AppendSection( header , SIMULATION_CHECKPOINT_SECTION_RIGID_BODIES , sizeof( Impulsion::RigidBody ) , physicalObjects.Size() ) ;
+
+    if( contents.mVelocityGrid )
+    {   // Caller wants to save velocity grid.
+        const UniformGrid< Vec3 > & velGrid = * contents.mVelocityGrid ;
+        SimulationCheckpointSection * section = AppendSection( header , SIMULATION_CHECKPOINT_SECTION_VELOCITY_GRID , sizeof( Vec3 ) , velGrid.Size() ) ;
+        const Vec3 & minCorner = velGrid.GetMinCorner() ;
+        const Vec3 & extent    = velGrid.GetExtent() ;
+        section->mGridMinCorner[ 0 ] = minCorner.x ;
+        section->mGridMinCorner[ 1 ] = minCorner.y ;
+        section->mGridMinCorner[ 2 ] = minCorner.z ;
+        section->mGridExtent[ 0 ]    = extent.x ;
+        section->mGridExtent[ 1 ]    = extent.y ;
+        section->mGridExtent[ 2 ]    = extent.z ;
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {
+            section->mGridNumPoints[ axis ] = velGrid.GetNumPoints( axis ) ;
+        }
+    }
+
+    FILE * fp = fopen( filename , "wb" ) ;
+    if( NULL == fp )
+    {
+        return false ;
+    }
+
+    // Write sections in the order AppendSection laid them out.
+    bool ok = WritePadded( fp , & header , sizeof( header ) ) ;
+
+    for( size_t iGroup = 0 ; ok && ( iGroup < numGroups ) ; ++ iGroup )
+    {   // For each particle group...
+        const VECTOR< Particle > & particles = particleSystem.GetGroup( iGroup )->GetParticles() ;
+        ok = WritePadded( fp , particles.Empty() ? NULLPTR : & particles[ 0 ] , particles.Size() * sizeof( Particle ) ) ;
+    }
+
+    size_t numRigidBodyBytes = 0 ;
+    for( size_t iBody = 0 ; ok && ( iBody < physicalObjects.Size() ) ; ++ iBody )
+    {   // For each physical object...
+        // Bodies live inside their physical objects, not in one array, so write them one at a time, then pad once.
+        ok = ( fwrite( physicalObjects[ iBody ]->GetBody() , sizeof( Impulsion::RigidBody ) , 1 , fp ) == 1 ) ;
+        numRigidBodyBytes += sizeof( Impulsion::RigidBody ) ;
+    }
+    ok = ok && WritePadding( fp , numRigidBodyBytes ) ;
+
+    if( ok && contents.mVelocityGrid )
+    {   // Caller wants to save velocity grid.
+        const UniformGrid< Vec3 > & velGrid = * contents.mVelocityGrid ;
+        ok = WritePadded( fp , velGrid.Size() ? velGrid.Data() : NULLPTR , velGrid.Size() * sizeof( Vec3 ) ) ;
+    }
+
+    ok = ( 0 == fclose( fp ) ) && ok ;
+    return ok ;
+}
+
+
+
+
+/** Construct reader with no checkpoint open.
+*/
+SimulationCheckpointReader::SimulationCheckpointReader()
+    : mHeader( NULLPTR )
+    , mFileSize( 0 )
+#if defined( WIN32 )
+    , mFile( INVALID_HANDLE_VALUE )
+    , mFileMapping( NULLPTR )
+#endif
+{
+}
+
+
+
+
+/** Destruct reader, unmapping its checkpoint, if any.
+*/
+SimulationCheckpointReader::~SimulationCheckpointReader()
+{
+    Close() ;
+}
+
+
+
+
+/** Map the given checkpoint file into memory, and validate its header.
+
+    \return Whether the file exists and its header describes a checkpoint this build can load.
+*/
+bool SimulationCheckpointReader::Open( const char * filename )
+{
+    PERF_BLOCK( SimulationCheckpointReader__Open ) ;
+
+    Close() ;
+
+#if defined( WIN32 )
+    mFile = CreateFileA( filename , GENERIC_READ , FILE_SHARE_READ , NULL , OPEN_EXISTING , FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN , NULL ) ;
+    if( INVALID_HANDLE_VALUE == mFile )
+    {
+        return false ;
+    }
+    LARGE_INTEGER fileSize ;
+    if( ! GetFileSizeEx( mFile , & fileSize ) || ( fileSize.QuadPart < LONGLONG( sizeof( SimulationCheckpointHeader ) ) ) )
+    {
+        Close() ;
+        return false ;
+    }
+    mFileSize    = static_cast< size_t >( fileSize.QuadPart ) ;
+    mFileMapping = CreateFileMappingA( mFile , NULL , PAGE_READONLY , 0 , 0 , NULL ) ;
+    if( NULLPTR == mFileMapping )
+    {
+        Close() ;
+        return false ;
+    }
+    mHeader = reinterpret_cast< const SimulationCheckpointHeader * >( MapViewOfFile( mFileMapping , FILE_MAP_READ , 0 , 0 , 0 ) ) ;
+#else
+    FILE * fp = fopen( filename , "rb" ) ;
+    if( NULL == fp )
+    {
+        return false ;
+    }
+    fseek( fp , 0 , SEEK_END ) ;
+    mFileSize = static_cast< size_t >( ftell( fp ) ) ;
+    fseek( fp , 0 , SEEK_SET ) ;
+    mFileContents.Resize( mFileSize ) ;
+    const bool readAll = ( mFileSize >= sizeof( SimulationCheckpointHeader ) ) && ( fread( & mFileContents[ 0 ] , 1 , mFileSize , fp ) == mFileSize ) ;
+    fclose( fp ) ;
+    if( readAll )
+    {
+        mHeader = reinterpret_cast< const SimulationCheckpointHeader * >( & mFileContents[ 0 ] ) ;
+    }
+#endif
+
+    if( ! mHeader || ! Validate() )
+    {
+        Close() ;
+        return false ;
+    }
+    return true ;
+}
+
+
+
+
+/** Unmap checkpoint file, if any.
+
+    Afterwards, pointers GetSectionData returned are no longer valid.
+*/
+void SimulationCheckpointReader::Close()
+{
+#if defined( WIN32 )
+    if( mHeader )
+    {
+        UnmapViewOfFile( mHeader ) ;
+    }
+    if( mFileMapping )
+    {
+        CloseHandle( mFileMapping ) ;
+        mFileMapping = NULLPTR ;
+    }
+    if( INVALID_HANDLE_VALUE != mFile )
+    {
+        CloseHandle( mFile ) ;
+        mFile = INVALID_HANDLE_VALUE ;
+    }
+#else
+    mFileContents.Clear() ;
+#endif
+    mHeader     = NULLPTR ;
+    mFileSize   = 0 ;
+}
+
+
+
+
+/** Return whether the mapped header describes a checkpoint that this build can load.
+*/
+bool SimulationCheckpointReader::Validate() const
+{
+    const SimulationCheckpointHeader & header = * mHeader ;
+
+    if(     ( header.mMagic             != SimulationCheckpointHeader::sMagic   )
+        ||  ( header.mVersion           != SimulationCheckpointHeader::sVersion )
+        ||  ( header.mSizeofParticle    != sizeof( Particle )                   )
+        ||  ( header.mNumSections       >  SimulationCheckpointHeader::sMaxSections ) )
+    {   // File is not a checkpoint, or another build with different layouts wrote it.
+        return false ;
+    }
+
+    for( unsigned iSection = 0 ; iSection < header.mNumSections ; ++ iSection )
+    {   // For each section...
+        const SimulationCheckpointSection & section = header.mSections[ iSection ] ;
+        if(     ( section.mOffset % SimulationCheckpointHeader::sPageSize != 0 )
+            ||  ( section.mOffset + section.mNumElements * section.mElementSize > mFileSize ) )
+        {   // Section is misaligned or truncated.
+            return false ;
+        }
+        if(     ( SIMULATION_CHECKPOINT_SECTION_RIGID_BODIES == section.mType )
+            &&  ( header.mSizeofRigidBody != sizeof( Impulsion::RigidBody ) ) )
+        {   // Another build with a different rigid body layout wrote this section.  Files without bodies, like initial state files, need not match.
+            return false ;
+        }
+    }
+    return true ;
+}
+
+
+
+
+/** Return description of the first section with the given type (and, for particle groups, group index), or NULL if there is none.
+*/
+const SimulationCheckpointSection * SimulationCheckpointReader::FindSection( SimulationCheckpointSectionE type , unsigned groupIndex ) const
+{
+    ASSERT( IsOpen() ) ;
+    for( unsigned iSection = 0 ; iSection < mHeader->mNumSections ; ++ iSection )
+    {   // For each section...
+        const SimulationCheckpointSection & section = mHeader->mSections[ iSection ] ;
+        if(     ( unsigned( type ) == section.mType )
+            &&  ( ( type != SIMULATION_CHECKPOINT_SECTION_PARTICLE_GROUP ) || ( groupIndex == section.mGroupIndex ) ) )
+        {
+            return & section ;
+        }
+    }
+    return NULLPTR ;
+}
+
+
+
+
+/** Return address of first element of the given section, within the mapped file.
+
+    This points directly into the mapping, so it remains valid only until Close.
+*/
+const void * SimulationCheckpointReader::GetSectionData( const SimulationCheckpointSection & section ) const
+{
+    ASSERT( IsOpen() ) ;
+    return reinterpret_cast< const char * >( mHeader ) + section.mOffset ;
+}
+
+
+
+
+/** Replace the given particles with those of the given section, in one pass that reads straight from the mapping.
+
+    \param section      Section of particles, e.g. from FindSection.
+
+    \param particles    (out) Particles to replace.  Reuses their storage if it has capacity.
+
+    \return Whether the section held particles of this build's layout.  Upon failure, this leaves particles as they were.
+*/
+bool SimulationCheckpointReader::CopyParticles( const SimulationCheckpointSection & section , VECTOR< Particle > & particles ) const
+{
+    PERF_BLOCK( SimulationCheckpointReader__CopyParticles ) ;
+
+    if( section.mElementSize != sizeof( Particle ) )
+    {   // Section does not hold particles of this build.
+        return false ;
+    }
+
+    // Copy-construct from the mapped array, rather than resize then overwrite, so each particle gets written once.
+    const Particle *    first           = reinterpret_cast< const Particle * >( GetSectionData( section ) ) ;
+    const size_t        numParticles    = static_cast< size_t >( section.mNumElements ) ;
+    particles.assign( first , first + numParticles ) ;
+    return true ;
+}
@@ -0,0 +1,171 @@
+/** \file simulationCheckpoint.h
+
+    \brief Binary checkpoint of simulation state, laid out so loading can map the file instead of parsing it.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef SIMULATION_CHECKPOINT_H
+#define SIMULATION_CHECKPOINT_H
+
+#include <Core/Containers/vector.h>
+#include <Core/SpatialPartition/uniformGrid.h>
+
+#include <Particles/particle.h>
+
+#include <stddef.h>
+
+// Forward declarations
+class ParticleSystem ;
+namespace Impulsion
+{
+    class PhysicalObject ;
+    class RigidBody ;
+} ;
+
+// Types --------------------------------------------------------------
+
+/** Kinds of section a checkpoint file can contain.
+*/
+enum SimulationCheckpointSectionE
+{
+    SIMULATION_CHECKPOINT_SECTION_PARTICLE_GROUP    ,   ///< Array of Particle, for one particle group.  mGroupIndex identifies the group.
+    SIMULATION_CHECKPOINT_SECTION_RIGID_BODIES      ,   ///< Array of Impulsion::RigidBody, one per physical object, in the order of the scene's physical objects.
+    SIMULATION_CHECKPOINT_SECTION_VELOCITY_GRID     ,   ///< Array of Vec3 velocity grid points.  mGrid* describe grid geometry.
+    SIMULATION_CHECKPOINT_SECTION_VORTONS           ,   ///< Array of Particle, for the vorton group, whichever index it has.  Initial state files use this, so they suit any scenario.
+    SIMULATION_CHECKPOINT_SECTION_TRACERS           ,   ///< Array of Particle, for the tracer group, whichever index it has.
+} ;
+
+
+
+
+/** Description of one section of a checkpoint file.
+*/
+struct SimulationCheckpointSection
+{
+    unsigned            mType               ;   ///< Kind of section; one of SimulationCheckpointSectionE.
+    unsigned            mGroupIndex         ;   ///< For particle group sections, index of group in particle system.
+    unsigned            mElementSize        ;   ///< Number of bytes per element.
+    unsigned            mPad                ;   ///< Unused; keeps 64-bit members naturally aligned.
+    unsigned long long  mOffset             ;   ///< Offset, in bytes, of first element, from start of file.  Always a multiple of sPageSize.
+    unsigned long long  mNumElements        ;   ///< Number of elements in section.
+    float               mGridMinCorner[ 3 ] ;   ///< For grid sections, location of first grid point.
+    float               mGridExtent[ 3 ]    ;   ///< For grid sections, size of region the grid spans.
+    unsigned            mGridNumPoints[ 3 ] ;   ///< For grid sections, number of grid points along each axis.
+    unsigned            mPad2               ;   ///< Unused; keeps size a multiple of 8.
+} ;
+
+
+
+
+/** Header at the start of a checkpoint file.
+
+    The header occupies the whole first page of the file, and each section
+    starts on a page boundary, so a loader can map the file and use section
+    contents in place, without copying or parsing.
+
+    The file holds raw in-memory layouts, so it is only portable between
+    builds that agree on those layouts.  The header records the sizes of the
+    structures it holds, and loading refuses files whose sizes differ from
+    those of the running build (e.g. debug versus release builds).
+
+    The same layout also serves as an initial state file, which tools can
+    author outside this application: a header, then page-aligned arrays of
+    Particle in VORTONS and TRACERS sections.  Such a file needs no rigid
+    body or grid sections, and then mSizeofRigidBody does not matter.
+*/
+struct SimulationCheckpointHeader
+{
+    static const unsigned sMagic        = 0x4b43474d ;  ///< "MGCK" in little-endian byte order.
+    static const unsigned sVersion      = 1 ;           ///< Increment this whenever the file layout changes.
+    static const unsigned sPageSize     = 4096 ;        ///< Alignment of sections within file, which must be a multiple of the OS page size for mapping to work.
+    static const unsigned sMaxSections  = 32 ;          ///< Capacity of section table.
+
+    unsigned                    mMagic                      ;   ///< Identifies file as a checkpoint.  Must equal sMagic.
+    unsigned                    mVersion                    ;   ///< Version of file layout.  Must equal sVersion.
+    unsigned                    mSizeofParticle             ;   ///< sizeof( Particle ) in build that wrote this file.
+    unsigned                    mSizeofRigidBody            ;   ///< sizeof( Impulsion::RigidBody ) in build that wrote this file.
+    int                         mScenario                   ;   ///< Scenario that was running when this file was written.
+    unsigned                    mFrame                      ;   ///< Frame counter when this file was written.
+    double                      mTimeNow                    ;   ///< Virtual time when this file was written.
+    unsigned                    mNumSections                ;   ///< Number of valid entries in mSections.
+    unsigned                    mPad                        ;   ///< Unused; keeps mSections naturally aligned.
+    SimulationCheckpointSection mSections[ sMaxSections ]   ;   ///< Table describing each section in file.
+} ;
+
+
+
+
+/** Simulation state to write into a checkpoint.
+
+    This refers to live simulation state; it does not copy it.
+*/
+struct SimulationCheckpointContents
+{
+    SimulationCheckpointContents()
+        : mParticleSystem( NULLPTR )
+        , mPhysicalObjects( NULLPTR )
+        , mVelocityGrid( NULLPTR )
+        , mScenario( 0 )
+        , mFrame( 0 )
+        , mTimeNow( 0.0 )
+    {}
+
+    const ParticleSystem *                          mParticleSystem     ;   ///< Particle system whose groups to save.
+    const VECTOR< Impulsion::PhysicalObject * > *   mPhysicalObjects    ;   ///< Physical objects whose rigid body states to save.
+    const UniformGrid< Vec3 > *                     mVelocityGrid       ;   ///< Optional velocity grid to save, or NULL to omit it.
+    int                                             mScenario           ;   ///< Scenario that is running.
+    unsigned                                        mFrame              ;   ///< Frame counter.
+    double                                          mTimeNow            ;   ///< Virtual time.
+} ;
+
+
+
+
+/** Read-only view of a checkpoint file, mapped into memory.
+
+    Open maps the whole file, so section contents get paged in only when
+    read, and copying them out reads straight from the file cache.
+*/
+class SimulationCheckpointReader
+{
+    public:
+        SimulationCheckpointReader() ;
+        ~SimulationCheckpointReader() ;
+
+        bool    Open( const char * filename ) ;
+        void    Close() ;
+
+        /// Return whether Open succeeded and Close has not happened since.
+        bool    IsOpen() const { return mHeader != NULLPTR ; }
+
+        /// Return header of opened checkpoint.
+        const SimulationCheckpointHeader & GetHeader() const { ASSERT( IsOpen() ) ; return * mHeader ; }
+
+        const SimulationCheckpointSection * FindSection( SimulationCheckpointSectionE type , unsigned groupIndex = 0 ) const ;
+        const void *                        GetSectionData( const SimulationCheckpointSection & section ) const ;
+        bool                                CopyParticles( const SimulationCheckpointSection & section , VECTOR< Particle > & particles ) const ;
+
+    private:
+        SimulationCheckpointReader( const SimulationCheckpointReader & ) ;              // Disallow copy
+        SimulationCheckpointReader & operator=( const SimulationCheckpointReader & ) ;  // Disallow assignment
+
+        bool    Validate() const ;
+
+        const SimulationCheckpointHeader *  mHeader         ;   ///< Start of mapped file, or NULL if none is open.
+        size_t                              mFileSize       ;   ///< Number of bytes in mapped file.
+    #if defined( WIN32 )
+        void *                              mFile           ;   ///< Handle of opened file.
+        void *                              mFileMapping    ;   ///< Handle of file mapping object.
+    #else
+        VECTOR< char >                      mFileContents   ;   ///< Contents of file, on platforms where this does not map files.
+    #endif
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+extern bool SimulationCheckpoint_Save( const char * filename , const SimulationCheckpointContents & contents ) ;
+
+#endif
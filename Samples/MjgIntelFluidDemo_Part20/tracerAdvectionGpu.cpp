@@ -0,0 +1,413 @@
+/** \file tracerAdvectionGpu.cpp
+
+    \brief Tracer particles that live, advect and get drawn entirely on the GPU, using OpenGL compute shaders.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "tracerAdvectionGpu.h"
+
+#include <Render/Platform/OpenGL/OpenGL_Api.h>
+#include <Render/Platform/OpenGL/OpenGL_extensions.h>
+
+#include <Core/Performance/perfBlock.h>
+
+#include <math.h>
+
+// Private variables --------------------------------------------------------------
+
+static const unsigned sWorkGroupSize        = 256 ; ///< Must match local_size_x in sAdvectSource and sVertexSource.
+static const unsigned sNumVerticesPerTracer = 4   ; ///< Vertices in each tracer quadrilateral.
+static const unsigned sNumWordsPerVertex    = 6   ; ///< 32-bit words in VertexFormatPositionColor4Texture2: 2 texture coordinates, 1 packed color, 3 position coordinates.
+static const unsigned sTextureSize          = 32  ; ///< Width and height of tracer texture, in texels.
+
+/** GLSL source of compute shader that assigns tracer velocity from a velocity grid, then moves tracers.
+
+    This interpolates the same way UniformGrid::InterpolateMany does, including clamping positions outside the grid to its boundary cells.
+*/
+static const char sAdvectSource[] =
+    "#version 430\n"
+    "layout( local_size_x = 256 ) in ;\n"
+    "\n"
+    "struct Tracer\n"
+    "{\n"
+    "    vec4 mPositionAndSize ;\n"
+    "    vec4 mVelocity ;\n"
+    "    vec4 mAngularVelocity ;\n"
+    "} ;\n"
+    "\n"
+    "layout( std430 , binding = 0 )          buffer TracerBlock   { Tracer tracers[] ; } ;\n"
+    "layout( std430 , binding = 1 ) readonly buffer VelocityBlock { vec4   velocities[] ; } ;\n"
+    "\n"
+    "uniform uint  uNumTracers ;\n"
+    "uniform uvec3 uNumGridPoints ;\n"
+    "uniform vec3  uGridMinCorner ;\n"
+    "uniform vec3  uCellsPerExtent ;\n"
+    "uniform float uGridWeight ;\n"
+    "uniform float uTimeStep ;\n"
+    "\n"
+    "vec3 VelocityAt( ivec3 idx )\n"
+    "{\n"
+    "    return velocities[ uint( idx.x ) + uNumGridPoints.x * ( uint( idx.y ) + uNumGridPoints.y * uint( idx.z ) ) ].xyz ;\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint iTracer = gl_GlobalInvocationID.x ;\n"
+    "    if( iTracer >= uNumTracers )\n"
+    "    {\n"
+    "        return ;\n"
+    "    }\n"
+    "    vec3  position  = tracers[ iTracer ].mPositionAndSize.xyz ;\n"
+    "    vec3  cellCoord = ( position - uGridMinCorner ) * uCellsPerExtent ;\n"
+    "    ivec3 idx       = clamp( ivec3( floor( cellCoord ) ) , ivec3( 0 ) , ivec3( uNumGridPoints ) - ivec3( 2 ) ) ;\n"
+    "    vec3  tween     = clamp( cellCoord - vec3( idx ) , 0.0 , 1.0 ) ;\n"
+    "    vec3  v00 = mix( VelocityAt( idx                 ) , VelocityAt( idx + ivec3( 1 , 0 , 0 ) ) , tween.x ) ;\n"
+    "    vec3  v10 = mix( VelocityAt( idx + ivec3( 0 , 1 , 0 ) ) , VelocityAt( idx + ivec3( 1 , 1 , 0 ) ) , tween.x ) ;\n"
+    "    vec3  v01 = mix( VelocityAt( idx + ivec3( 0 , 0 , 1 ) ) , VelocityAt( idx + ivec3( 1 , 0 , 1 ) ) , tween.x ) ;\n"
+    "    vec3  v11 = mix( VelocityAt( idx + ivec3( 0 , 1 , 1 ) ) , VelocityAt( idx + ivec3( 1 , 1 , 1 ) ) , tween.x ) ;\n"
+    "    vec3  velocityFromGrid = mix( mix( v00 , v10 , tween.y ) , mix( v01 , v11 , tween.y ) , tween.z ) ;\n"
+    "    vec3  velocity  = tracers[ iTracer ].mVelocity.xyz ;\n"
+    "    velocity += uGridWeight * ( velocityFromGrid - velocity ) ;\n"
+    "    tracers[ iTracer ].mVelocity.xyz        = velocity ;\n"
+    "    tracers[ iTracer ].mPositionAndSize.xyz = position + velocity * uTimeStep ;\n"
+    "}\n"
+    ;
+
+/** GLSL source of compute shader that writes a camera-facing quadrilateral for each tracer.
+
+    This computes the same vertices VertexBufferFillerGeneric does, and writes them in VertexFormatPositionColor4Texture2 layout.
+*/
+static const char sVertexSource[] =
+    "#version 430\n"
+    "layout( local_size_x = 256 ) in ;\n"
+    "\n"
+    "struct Tracer\n"
+    "{\n"
+    "    vec4 mPositionAndSize ;\n"
+    "    vec4 mVelocity ;\n"
+    "    vec4 mAngularVelocity ;\n"
+    "} ;\n"
+    "\n"
+    "layout( std430 , binding = 0 ) readonly  buffer TracerBlock { Tracer tracers[] ; } ;\n"
+    "layout( std430 , binding = 1 ) writeonly buffer VertexBlock { uint   vertexWords[] ; } ;\n"
+    "\n"
+    "uniform uint  uNumTracers ;\n"
+    "uniform vec3  uViewRight ;\n"
+    "uniform vec3  uViewUp ;\n"
+    "uniform float uTimeNow ;\n"
+    "uniform vec4  uColor ;\n"
+    "\n"
+    "void WriteVertex( uint iVert , vec2 texCoord , uint color , vec3 position )\n"
+    "{\n"
+    "    uint iWord = iVert * 6u ;\n"
+    "    vertexWords[ iWord     ] = floatBitsToUint( texCoord.x ) ;\n"
+    "    vertexWords[ iWord + 1 ] = floatBitsToUint( texCoord.y ) ;\n"
+    "    vertexWords[ iWord + 2 ] = color ;\n"
+    "    vertexWords[ iWord + 3 ] = floatBitsToUint( position.x ) ;\n"
+    "    vertexWords[ iWord + 4 ] = floatBitsToUint( position.y ) ;\n"
+    "    vertexWords[ iWord + 5 ] = floatBitsToUint( position.z ) ;\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint iTracer = gl_GlobalInvocationID.x ;\n"
+    "    if( iTracer >= uNumTracers )\n"
+    "    {\n"
+    "        return ;\n"
+    "    }\n"
+    "    vec3  position  = tracers[ iTracer ].mPositionAndSize.xyz ;\n"
+    "    float halfSize  = tracers[ iTracer ].mPositionAndSize.w * 0.5 ;\n"
+    "    float angle     = length( tracers[ iTracer ].mAngularVelocity.xyz * uTimeNow ) ;\n"
+    "    float sinAngle  = sin( angle ) ;\n"
+    "    float cosAngle  = cos( angle ) ;\n"
+    "    vec3  right     = (   uViewRight * cosAngle + uViewUp * sinAngle ) * halfSize ;\n"
+    "    vec3  up        = ( - uViewRight * sinAngle + uViewUp * cosAngle ) * halfSize ;\n"
+    "    uint  color     = packUnorm4x8( uColor ) ;\n"
+    "    uint  iVert     = iTracer * 4u ;\n"
+    "    WriteVertex( iVert      , vec2( 1.0 , 0.0 ) , color , position + right + up ) ;\n"
+    "    WriteVertex( iVert + 1u , vec2( 0.0 , 0.0 ) , color , position - right + up ) ;\n"
+    "    WriteVertex( iVert + 2u , vec2( 0.0 , 1.0 ) , color , position - right - up ) ;\n"
+    "    WriteVertex( iVert + 3u , vec2( 1.0 , 1.0 ) , color , position + right - up ) ;\n"
+    "}\n"
+    ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct tracers that live on the GPU.
+
+    \note This does not touch OpenGL, so it can run before a render context exists.  Call Initialize after.
+*/
+TracerAdvectionGpu::TracerAdvectionGpu()
+    : mTextureName( 0 )
+    , mMaxTracers( 0 )
+    , mNumTracers( 0 )
+    , mNextSlot( 0 )
+{
+}
+
+
+
+
+TracerAdvectionGpu::~TracerAdvectionGpu()
+{
+    if( mTextureName )
+    {
+        glDeleteTextures( 1 , & mTextureName ) ;
+    }
+}
+
+
+
+
+/** Compile compute shaders and allocate GPU memory for tracers.
+
+    \param maxTracers   Number of tracers the GPU holds.  Once full, AdoptTracers overwrites the oldest tracers.
+
+    \return Whether the OpenGL driver supports compute shaders and the shaders compiled.
+            When this returns false, the caller should leave tracers on the CPU.
+
+    \note This requires a current OpenGL context, after OpenGL_Extensions::GetProcAddresses.
+*/
+bool TracerAdvectionGpu::Initialize( size_t maxTracers )
+{
+    PERF_BLOCK( TracerAdvectionGpu__Initialize ) ;
+
+    ASSERT( maxTracers > 0 ) ;
+
+    if( ! PeGaSys::Render::OpenGL_ComputeShader::IsSupported() )
+    {   // Driver lacks OpenGL 4.3.
+        return false ;
+    }
+
+    if( ! mAdvectShader.Compile( sAdvectSource ) || ! mVertexShader.Compile( sVertexSource ) )
+    {
+        mAdvectShader.Deallocate() ;
+        mVertexShader.Deallocate() ;
+        return false ;
+    }
+
+    mMaxTracers = maxTracers ;
+    mTracerBuffer.Allocate( mMaxTracers * sizeof( Tracer ) ) ;
+    mVertexBuffer.Allocate( mMaxTracers * sNumVerticesPerTracer * sNumWordsPerVertex * sizeof( GLuint ) ) ;
+    RemoveAllTracers() ;
+
+    {   // Make texture of a soft ball, so tracer quadrilaterals look round.
+        unsigned char texels[ sTextureSize * sTextureSize * 4 ] ;
+        for( unsigned iy = 0 ; iy < sTextureSize ; ++ iy )
+        {
+            for( unsigned ix = 0 ; ix < sTextureSize ; ++ ix )
+            {
+                const float     dx      = ( float( ix ) + 0.5f ) / float( sTextureSize ) * 2.0f - 1.0f ;
+                const float     dy      = ( float( iy ) + 0.5f ) / float( sTextureSize ) * 2.0f - 1.0f ;
+                const float     r2      = dx * dx + dy * dy ;
+                const float     alpha   = r2 < 1.0f ? expf( - 4.0f * r2 ) : 0.0f ;
+                unsigned char * texel   = & texels[ ( ix + iy * sTextureSize ) * 4 ] ;
+                texel[ 0 ] = texel[ 1 ] = texel[ 2 ] = 255 ;
+                texel[ 3 ] = static_cast< unsigned char >( alpha * 255.0f ) ;
+            }
+        }
+        glGenTextures( 1 , & mTextureName ) ;
+        glBindTexture( GL_TEXTURE_2D , mTextureName ) ;
+        glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , GL_LINEAR ) ;
+        glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , GL_LINEAR ) ;
+        glTexImage2D( GL_TEXTURE_2D , 0 , GL_RGBA , sTextureSize , sTextureSize , 0 , GL_RGBA , GL_UNSIGNED_BYTE , texels ) ;
+        glBindTexture( GL_TEXTURE_2D , 0 ) ;
+    }
+
+    return ! RENDER_CHECK_ERROR( TracerAdvectionGpu_Initialize ) ;
+}
+
+
+
+
+/** Move tracers from the given CPU array into GPU memory, then empty that array.
+
+    The CPU particle group keeps emitting tracers, so calling this every frame
+    leaves only newly emitted tracers for CPU operations to process.
+*/
+void TracerAdvectionGpu::AdoptTracers( VECTOR< Particle > & particles )
+{
+    PERF_BLOCK( TracerAdvectionGpu__AdoptTracers ) ;
+
+    if( ! IsValid() || particles.Empty() )
+    {
+        return ;
+    }
+
+    UploadTracers( & particles[ 0 ] , particles.Size() ) ;
+    particles.Clear() ;
+}
+
+
+
+
+/** Forget all tracers on the GPU, for example when initial conditions change.
+*/
+void TracerAdvectionGpu::RemoveAllTracers()
+{
+    mNumTracers = 0 ;
+    mNextSlot   = 0 ;
+}
+
+
+
+
+/** Copy the given particles into the ring buffer of tracers on the GPU, overwriting the oldest if it is full.
+*/
+void TracerAdvectionGpu::UploadTracers( const Particle * particles , size_t numParticles )
+{
+    if( numParticles > mMaxTracers )
+    {   // More new tracers than the GPU holds.  Keep only the last of them, since the others would get overwritten anyway.
+        particles    += numParticles - mMaxTracers ;
+        numParticles  = mMaxTracers ;
+    }
+
+    mTracerStaging.Resize( numParticles ) ;
+    for( size_t iPcl = 0 ; iPcl < numParticles ; ++ iPcl )
+    {   // For each particle...
+        const Particle &    pcl     = particles[ iPcl ] ;
+        Tracer &            tracer  = mTracerStaging[ iPcl ] ;
+        tracer.mPositionAndSize[ 0 ] = pcl.mPosition.x ;
+        tracer.mPositionAndSize[ 1 ] = pcl.mPosition.y ;
+        tracer.mPositionAndSize[ 2 ] = pcl.mPosition.z ;
+        tracer.mPositionAndSize[ 3 ] = pcl.mSize ;
+        tracer.mVelocity[ 0 ]        = pcl.mVelocity.x ;
+        tracer.mVelocity[ 1 ]        = pcl.mVelocity.y ;
+        tracer.mVelocity[ 2 ]        = pcl.mVelocity.z ;
+        tracer.mVelocity[ 3 ]        = 0.0f ;
+        tracer.mAngularVelocity[ 0 ] = pcl.mAngularVelocity.x ;
+        tracer.mAngularVelocity[ 1 ] = pcl.mAngularVelocity.y ;
+        tracer.mAngularVelocity[ 2 ] = pcl.mAngularVelocity.z ;
+        tracer.mAngularVelocity[ 3 ] = 0.0f ;
+    }
+
+    // Upload in up to 2 pieces: up to the end of the ring buffer, then wrapping around to its start.
+    const size_t numBeforeWrap = Min2( numParticles , mMaxTracers - mNextSlot ) ;
+    mTracerBuffer.UploadSubRange( mTracerStaging.Data() , numBeforeWrap * sizeof( Tracer ) , mNextSlot * sizeof( Tracer ) ) ;
+    mTracerBuffer.UploadSubRange( mTracerStaging.Data() + numBeforeWrap , ( numParticles - numBeforeWrap ) * sizeof( Tracer ) , 0 ) ;
+
+    mNextSlot   = ( mNextSlot + numParticles ) % mMaxTracers ;
+    mNumTracers = Min2( mNumTracers + numParticles , mMaxTracers ) ;
+}
+
+
+
+
+/** Assign tracer velocity from the given grid, then move tracers by that velocity, on the GPU.
+
+    \param velocityGrid Uniform grid of velocity values.  This uploads only this grid, not tracers.
+
+    \param gridWeight   Fraction of velocity from grid to use, as in PclOpAssignVelocityFromField::mGridWeight.
+
+    \param timeStep     Amount of virtual time by which to move tracers.
+*/
+void TracerAdvectionGpu::Advect( const UniformGrid< Vec3 > & velocityGrid , float gridWeight , float timeStep )
+{
+    PERF_BLOCK( TracerAdvectionGpu__Advect ) ;
+
+    if( ! IsValid() || ( 0 == mNumTracers ) || velocityGrid.HasZeroExtent() || velocityGrid.Empty() )
+    {
+        return ;
+    }
+
+    {
+        PERF_BLOCK( TracerAdvectionGpu__Advect_Upload ) ;
+        const unsigned numGridpoints = velocityGrid.GetGridCapacity() ;
+        mVelocityStaging.Resize( numGridpoints * 4 ) ;
+        for( unsigned offset = 0 ; offset < numGridpoints ; ++ offset )
+        {   // For each gridpoint...
+            float *         velocity    = & mVelocityStaging[ offset * 4 ] ;
+            const Vec3 &    vVelocity   = velocityGrid[ offset ] ;
+            velocity[ 0 ] = vVelocity.x ;
+            velocity[ 1 ] = vVelocity.y ;
+            velocity[ 2 ] = vVelocity.z ;
+            velocity[ 3 ] = 0.0f ;
+        }
+        mVelocityBuffer.Upload( mVelocityStaging.Data() , mVelocityStaging.Size() * sizeof( float ) ) ;
+    }
+
+    const Vec3 &    vMinCorner      = velocityGrid.GetMinCorner() ;
+    const Vec3 &    vCellsPerExtent = velocityGrid.GetCellsPerExtent() ;
+
+    mAdvectShader.Use() ;
+    glUniform1ui( mAdvectShader.GetUniformLocation( "uNumTracers"     ) , static_cast< GLuint >( mNumTracers ) ) ;
+    glUniform3ui( mAdvectShader.GetUniformLocation( "uNumGridPoints"  ) , velocityGrid.GetNumPoints( 0 ) , velocityGrid.GetNumPoints( 1 ) , velocityGrid.GetNumPoints( 2 ) ) ;
+    glUniform3f ( mAdvectShader.GetUniformLocation( "uGridMinCorner"  ) , vMinCorner.x , vMinCorner.y , vMinCorner.z ) ;
+    glUniform3f ( mAdvectShader.GetUniformLocation( "uCellsPerExtent" ) , vCellsPerExtent.x , vCellsPerExtent.y , vCellsPerExtent.z ) ;
+    glUniform1f ( mAdvectShader.GetUniformLocation( "uGridWeight"     ) , gridWeight ) ;
+    glUniform1f ( mAdvectShader.GetUniformLocation( "uTimeStep"       ) , timeStep ) ;
+    mTracerBuffer.BindBase( 0 ) ;
+    mVelocityBuffer.BindBase( 1 ) ;
+    mAdvectShader.Dispatch( static_cast< GLuint >( ( mNumTracers + sWorkGroupSize - 1 ) / sWorkGroupSize ) , 1 , 1 ) ;
+    glUseProgram( 0 ) ;
+}
+
+
+
+
+/** Write camera-facing quadrilaterals for tracers into a vertex buffer on the GPU, then draw that buffer.
+
+    \param timeNow  Current virtual time, which determines how far each tracer billboard has spun.
+
+    \note This uses the current OpenGL modelview matrix as the view, and
+            draws tracers in world space, so call this after setting the
+            camera, for example with QdCamera::SetCamera.
+*/
+void TracerAdvectionGpu::Render( double timeNow )
+{
+    PERF_BLOCK( TracerAdvectionGpu__Render ) ;
+
+    if( ! IsValid() || ( 0 == mNumTracers ) )
+    {
+        return ;
+    }
+
+    // Extract world space direction vectors associated with view, the same as VertexBufferFillerGeneric does.
+    // OpenGL stores matrices in column-major order, so these are the first two rows of the modelview matrix.
+    GLfloat modelView[ 16 ] ;
+    glGetFloatv( GL_MODELVIEW_MATRIX , modelView ) ;
+
+    {
+        PERF_BLOCK( TracerAdvectionGpu__Render_FillVertexBuffer ) ;
+        mVertexShader.Use() ;
+        glUniform1ui( mVertexShader.GetUniformLocation( "uNumTracers" ) , static_cast< GLuint >( mNumTracers ) ) ;
+        glUniform3f ( mVertexShader.GetUniformLocation( "uViewRight"  ) , modelView[ 0 ] , modelView[ 4 ] , modelView[  8 ] ) ;
+        glUniform3f ( mVertexShader.GetUniformLocation( "uViewUp"     ) , modelView[ 1 ] , modelView[ 5 ] , modelView[  9 ] ) ;
+        glUniform1f ( mVertexShader.GetUniformLocation( "uTimeNow"    ) , static_cast< float >( timeNow ) ) ;
+        glUniform4f ( mVertexShader.GetUniformLocation( "uColor"      ) , 1.0f , 1.0f , 1.0f , 0.25f ) ;
+        mTracerBuffer.BindBase( 0 ) ;
+        mVertexBuffer.BindBase( 1 ) ;
+        mVertexShader.Dispatch( static_cast< GLuint >( ( mNumTracers + sWorkGroupSize - 1 ) / sWorkGroupSize ) , 1 , 1 , GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT ) ;
+        glUseProgram( 0 ) ;
+    }
+
+    {
+        PERF_BLOCK( TracerAdvectionGpu__Render_Draw ) ;
+        glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT ) ;
+        glPushClientAttrib( GL_CLIENT_VERTEX_ARRAY_BIT ) ;
+
+        glDisable( GL_LIGHTING ) ;
+        glDisable( GL_CULL_FACE ) ;
+        glEnable( GL_TEXTURE_2D ) ;
+        glBindTexture( GL_TEXTURE_2D , mTextureName ) ;
+        glTexEnvi( GL_TEXTURE_ENV , GL_TEXTURE_ENV_MODE , GL_MODULATE ) ;
+        glEnable( GL_BLEND ) ;
+        glBlendFunc( GL_SRC_ALPHA , GL_ONE_MINUS_SRC_ALPHA ) ;
+        glDepthMask( GL_FALSE ) ;   // Tracers are translucent and unsorted, so they should not occlude each other.
+
+        glBindBuffer( GL_ARRAY_BUFFER , mVertexBuffer.GetBufferName() ) ;
+        glInterleavedArrays( GL_T2F_C4UB_V3F , 0 , 0 ) ;
+        glDrawArrays( GL_QUADS , 0 , static_cast< GLsizei >( mNumTracers * sNumVerticesPerTracer ) ) ;
+        glBindBuffer( GL_ARRAY_BUFFER , 0 ) ;
+
+        glPopClientAttrib() ;
+        glPopAttrib() ;
+        RENDER_CHECK_ERROR( TracerAdvectionGpu_Render ) ;
+    }
+}
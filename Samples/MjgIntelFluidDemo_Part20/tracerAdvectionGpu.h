@@ -0,0 +1,91 @@
+/** \file tracerAdvectionGpu.h
+
+    \brief Tracer particles that live, advect and get drawn entirely on the GPU, using OpenGL compute shaders.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef TRACER_ADVECTION_GPU_H
+#define TRACER_ADVECTION_GPU_H
+
+#include <Particles/particle.h>
+
+#include <Render/Platform/OpenGL/OpenGL_computeShader.h>
+
+#include <Core/SpatialPartition/uniformGrid.h>
+#include <Core/Containers/vector.h>
+
+// Types --------------------------------------------------------------
+
+/** Tracer particles that live, advect and get drawn entirely on the GPU, using OpenGL 4.3 compute shaders.
+
+    Tracer state stays resident in a shader storage buffer.  Each simulation
+    step uploads only the velocity grid, then a compute shader assigns tracer
+    velocity from that grid (the same way PclOpAssignVelocityFromField does)
+    and moves tracers by that velocity (the same way PclOpEvolve does).
+
+    Each frame, a second compute shader writes camera-facing quadrilaterals
+    for every tracer into a vertex buffer, in the same layout that
+    VertexBufferFillerGeneric writes, and Render draws that buffer directly.
+    So tracers never cross the bus after AdoptTracers uploads them.
+
+    The CPU particle group still emits tracers.  AdoptTracers moves them into
+    a ring buffer on the GPU, overwriting the oldest tracers once it fills.
+    Operations other than advection and evolution (killing by age, density
+    and fire scalars, wind, interaction with bodies) do not apply to tracers
+    on the GPU.
+
+    Every method requires that the OpenGL context that created this object be
+    current on the calling thread.
+*/
+class TracerAdvectionGpu
+{
+    public:
+        TracerAdvectionGpu() ;
+        ~TracerAdvectionGpu() ;
+
+        bool            Initialize( size_t maxTracers ) ;
+
+        /// Return whether Initialize succeeded, i.e. whether this can advect and render tracers.
+        bool            IsValid() const { return mAdvectShader.IsValid() && mVertexShader.IsValid() ; }
+
+        void            AdoptTracers( VECTOR< Particle > & particles ) ;
+        void            RemoveAllTracers() ;
+        void            Advect( const UniformGrid< Vec3 > & velocityGrid , float gridWeight , float timeStep ) ;
+        void            Render( double timeNow ) ;
+
+        /// Return number of tracers resident on the GPU.
+        const size_t &  GetNumTracers() const { return mNumTracers ; }
+
+    private:
+        /// Tracer laid out to match struct Tracer in the compute shaders, using std430 rules.
+        struct Tracer
+        {
+            float mPositionAndSize[ 4 ] ;   ///< Position (xyz) and size (w), i.e. diameter.
+            float mVelocity[ 4 ]        ;   ///< Velocity (xyz).  w is unused.
+            float mAngularVelocity[ 4 ] ;   ///< Angular velocity (xyz), which spins the billboard.  w is unused.
+        } ;
+
+        TracerAdvectionGpu( const TracerAdvectionGpu & ) ;              // Disallow copy
+        TracerAdvectionGpu & operator=( const TracerAdvectionGpu & ) ;  // Disallow assignment
+
+        void            UploadTracers( const Particle * particles , size_t numParticles ) ;
+
+        PeGaSys::Render::OpenGL_ComputeShader       mAdvectShader       ;   ///< Program that assigns tracer velocity from grid and moves tracers.
+        PeGaSys::Render::OpenGL_ComputeShader       mVertexShader       ;   ///< Program that writes camera-facing quadrilaterals for tracers.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mTracerBuffer       ;   ///< Tracer state, resident in GPU memory.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mVelocityBuffer     ;   ///< GPU copy of velocity grid, as 4 floats (x,y,z,0) per gridpoint.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mVertexBuffer       ;   ///< Vertices for tracers, in VertexFormatPositionColor4Texture2 layout, which Render draws.
+        VECTOR< Tracer >                            mTracerStaging      ;   ///< Tracers converted from particles, for upload.
+        VECTOR< float >                             mVelocityStaging    ;   ///< Velocity grid converted to 4 floats per gridpoint, for upload.
+        GLuint                                      mTextureName        ;   ///< Identifier of OpenGL texture applied to each tracer quadrilateral.
+        size_t                                      mMaxTracers         ;   ///< Capacity of mTracerBuffer, in tracers.
+        size_t                                      mNumTracers         ;   ///< Number of tracers in mTracerBuffer.
+        size_t                                      mNextSlot           ;   ///< Index in mTracerBuffer where AdoptTracers puts the next tracer.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
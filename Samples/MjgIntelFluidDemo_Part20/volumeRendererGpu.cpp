@@ -0,0 +1,536 @@
+/** \file volumeRendererGpu.cpp
+
+    \brief Ray-marched rendering of density, flame and smoke grids, using 3D textures and an OpenGL fragment shader.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "volumeRendererGpu.h"
+
+#include <Render/Platform/OpenGL/OpenGL_Api.h>
+#include <Render/Platform/OpenGL/OpenGL_extensions.h>
+
+#include <Core/SpatialPartition/packedUniformGrid.h>
+#include <Core/Performance/perfBlock.h>
+
+#include <math.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const unsigned   sCellsPerBrick          = 4                 ;   ///< Number of grid cells along each axis of each occupancy brick.
+static const float      sOccupancyThreshold     = 1.0f / 1024.0f    ;   ///< Magnitude below which a value counts as empty.  About the precision of half-precision floats near 1.
+static const float      sStepsPerCell           = 2.0f              ;   ///< Number of samples each ray takes per grid cell, along the narrowest cell dimension.
+
+/** GLSL source of fragment shader that marches a ray from the eye through the volume.
+
+    This runs on back faces of the grid bounding box, whose texture coordinates
+    hold world space positions.  It reads the camera from the compatibility
+    profile matrices, so the modelview matrix must hold the view, as it does
+    after QdCamera::SetCamera.
+*/
+static const char sRayMarchSource[] =
+    "#version 430 compatibility\n"
+    "\n"
+    "uniform sampler3D  uVolume ;           // Density deviation (r), flame (g) and smoke (b) at each gridpoint.\n"
+    "uniform usampler3D uOccupancy ;        // Bits of which channels have visible content in each brick.\n"
+    "uniform sampler2D  uSceneDepth ;       // Copy of depth buffer.\n"
+    "uniform vec4  uViewport ;\n"
+    "uniform vec3  uGridMinCorner ;\n"
+    "uniform vec3  uGridMaxCorner ;\n"
+    "uniform vec3  uCellsPerExtent ;\n"
+    "uniform vec3  uNumGridPoints ;\n"
+    "uniform vec3  uBrickExtent ;\n"
+    "uniform uvec3 uNumBricks ;\n"
+    "uniform uint  uChannels ;\n"
+    "uniform float uStepLength ;\n"
+    "uniform int   uMaxSteps ;\n"
+    "uniform float uDensityExtinction ;\n"
+    "uniform float uFlameEmission ;\n"
+    "uniform float uSmokeExtinction ;\n"
+    "\n"
+    "layout( location = 0 ) out vec4 oColor ;\n"
+    "\n"
+    "const vec3 cDenseColor = vec3( 0.2 , 0.4 , 1.0 ) ;\n"
+    "const vec3 cLightColor = vec3( 1.0 , 0.6 , 0.2 ) ;\n"
+    "const vec3 cFlameColor = vec3( 1.0 , 0.5 , 0.1 ) ;\n"
+    "const vec3 cSmokeColor = vec3( 0.3 , 0.3 , 0.3 ) ;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    vec3  eye       = gl_ModelViewMatrixInverse[ 3 ].xyz ;\n"
+    "    vec3  toBack    = gl_TexCoord[ 0 ].xyz - eye ;\n"
+    "    float tExit     = length( toBack ) ;\n"
+    "    vec3  dir       = toBack / tExit ;\n"
+    "    vec3  invDir    = 1.0 / mix( dir , vec3( 1.0e-8 ) , lessThan( abs( dir ) , vec3( 1.0e-8 ) ) ) ;\n"
+    "\n"
+    "    // Clip ray to grid bounding box.\n"
+    "    vec3  tA        = ( uGridMinCorner - eye ) * invDir ;\n"
+    "    vec3  tB        = ( uGridMaxCorner - eye ) * invDir ;\n"
+    "    vec3  tNear     = min( tA , tB ) ;\n"
+    "    vec3  tFar      = max( tA , tB ) ;\n"
+    "    float t         = max( max( max( tNear.x , tNear.y ) , tNear.z ) , 0.0 ) ;\n"
+    "    tExit           = min( tExit , min( min( tFar.x , tFar.y ) , tFar.z ) ) ;\n"
+    "\n"
+    "    // Clip ray to opaque geometry already drawn.\n"
+    "    float sceneDepth = texelFetch( uSceneDepth , ivec2( gl_FragCoord.xy - uViewport.xy ) , 0 ).r ;\n"
+    "    if( sceneDepth < 1.0 )\n"
+    "    {\n"
+    "        vec4 ndc   = vec4( 2.0 * ( gl_FragCoord.xy - uViewport.xy ) / uViewport.zw - 1.0 , 2.0 * sceneDepth - 1.0 , 1.0 ) ;\n"
+    "        vec4 scene = gl_ModelViewProjectionMatrixInverse * ndc ;\n"
+    "        tExit = min( tExit , dot( scene.xyz / scene.w - eye , dir ) ) ;\n"
+    "    }\n"
+    "\n"
+    "    vec3  radiance      = vec3( 0.0 ) ;\n"
+    "    float transmittance = 1.0 ;\n"
+    "    for( int iStep = 0 ; ( iStep < uMaxSteps ) && ( t < tExit ) && ( transmittance > 0.004 ) ; ++ iStep )\n"
+    "    {\n"
+    "        vec3  position  = eye + dir * t ;\n"
+    "        ivec3 brick     = clamp( ivec3( floor( ( position - uGridMinCorner ) / uBrickExtent ) ) , ivec3( 0 ) , ivec3( uNumBricks ) - ivec3( 1 ) ) ;\n"
+    "        if( 0u == ( texelFetch( uOccupancy , brick , 0 ).r & uChannels ) )\n"
+    "        {   // Brick holds nothing to draw, so skip to where ray leaves it.\n"
+    "            vec3  brickMin  = uGridMinCorner + vec3( brick ) * uBrickExtent ;\n"
+    "            vec3  tLeave    = max( ( brickMin - eye ) * invDir , ( brickMin + uBrickExtent - eye ) * invDir ) ;\n"
+    "            t = max( min( min( tLeave.x , tLeave.y ) , tLeave.z ) , t ) + 1.0e-3 * uStepLength ;\n"
+    "            continue ;\n"
+    "        }\n"
+    "        vec3  texCoord  = ( ( position - uGridMinCorner ) * uCellsPerExtent + 0.5 ) / uNumGridPoints ;\n"
+    "        vec3  values    = texture( uVolume , texCoord ).rgb ;\n"
+    "        float stepLen   = min( uStepLength , tExit - t ) ;\n"
+    "        float sigmaDye  = uDensityExtinction * abs( values.r ) ;\n"
+    "        float sigmaSmk  = uSmokeExtinction * max( values.b , 0.0 ) ;\n"
+    "        float sigma     = sigmaDye + sigmaSmk ;\n"
+    "        float alpha     = 1.0 - exp( - sigma * stepLen ) ;\n"
+    "        vec3  scattered = ( sigmaDye * ( values.r > 0.0 ? cDenseColor : cLightColor ) + sigmaSmk * cSmokeColor ) / max( sigma , 1.0e-8 ) ;\n"
+    "        vec3  emitted   = cFlameColor * ( uFlameEmission * max( values.g , 0.0 ) * stepLen ) ;\n"
+    "        radiance       += transmittance * ( alpha * scattered + emitted ) ;\n"
+    "        transmittance  *= 1.0 - alpha ;\n"
+    "        t              += stepLen ;\n"
+    "    }\n"
+    "\n"
+    "    // Premultiplied alpha: blend with ( GL_ONE , GL_ONE_MINUS_SRC_ALPHA ).\n"
+    "    oColor = vec4( radiance , 1.0 - transmittance ) ;\n"
+    "}\n"
+    ;
+
+/// Corners of each face of a box, indexed by bits (x=1, y=2, z=4), counterclockwise seen from outside.
+static const unsigned sBoxFaceCorners[ 6 ][ 4 ] =
+{
+    { 0 , 4 , 6 , 2 } , // -X
+    { 1 , 3 , 7 , 5 } , // +X
+    { 0 , 1 , 5 , 4 } , // -Y
+    { 2 , 6 , 7 , 3 } , // +Y
+    { 0 , 2 , 3 , 1 } , // -Z
+    { 4 , 5 , 7 , 6 } , // +Z
+} ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct volume renderer.
+
+    \note This does not touch OpenGL, so it can run before a render context exists.  Call Initialize after.
+*/
+VolumeRendererGpu::VolumeRendererGpu()
+    : mVolumeTextureName( 0 )
+    , mOccupancyTextureName( 0 )
+    , mDepthTextureName( 0 )
+    , mGridMinCorner( 0.0f , 0.0f , 0.0f )
+    , mGridExtent( 0.0f , 0.0f , 0.0f )
+    , mCellsPerExtent( 0.0f , 0.0f , 0.0f )
+    , mDensityExtinction( 20.0f )
+    , mFlameEmission( 4.0f )
+    , mSmokeExtinction( 8.0f )
+{
+    mNumPoints[ 0 ] = mNumPoints[ 1 ] = mNumPoints[ 2 ] = 0 ;
+    mNumBricks[ 0 ] = mNumBricks[ 1 ] = mNumBricks[ 2 ] = 0 ;
+    mDepthTextureSize[ 0 ] = mDepthTextureSize[ 1 ] = 0 ;
+}
+
+
+
+
+VolumeRendererGpu::~VolumeRendererGpu()
+{
+    const GLuint textureNames[] = { mVolumeTextureName , mOccupancyTextureName , mDepthTextureName } ;
+    for( unsigned iTex = 0 ; iTex < sizeof( textureNames ) / sizeof( textureNames[ 0 ] ) ; ++ iTex )
+    {
+        if( textureNames[ iTex ] )
+        {
+            glDeleteTextures( 1 , & textureNames[ iTex ] ) ;
+        }
+    }
+}
+
+
+
+
+/** Compile ray-marching shader and create textures.
+
+    \return Whether the OpenGL driver supports 3D textures and shaders, and the shader compiled.
+            When this returns false, the caller should keep rendering tracers.
+
+    \note This requires a current OpenGL context, after OpenGL_Extensions::GetProcAddresses.
+*/
+bool VolumeRendererGpu::Initialize()
+{
+    PERF_BLOCK( VolumeRendererGpu__Initialize ) ;
+
+    if(     ! glTexImage3D || ! glTexSubImage3D || ! glActiveTexture || ! glUniform1i
+        ||  ! glCreateShader || ! glCreateProgram || ! glGetUniformLocation )
+    {   // Driver lacks 3D textures or shaders.
+        return false ;
+    }
+
+    if( ! mRayMarchShader.Compile( sRayMarchSource , GL_FRAGMENT_SHADER ) )
+    {
+        return false ;
+    }
+
+    glGenTextures( 1 , & mVolumeTextureName ) ;
+    glBindTexture( GL_TEXTURE_3D , mVolumeTextureName ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_MIN_FILTER , GL_LINEAR ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_MAG_FILTER , GL_LINEAR ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_WRAP_S , GL_CLAMP_TO_EDGE ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_WRAP_T , GL_CLAMP_TO_EDGE ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_WRAP_R , GL_CLAMP_TO_EDGE ) ;
+
+    glGenTextures( 1 , & mOccupancyTextureName ) ;
+    glBindTexture( GL_TEXTURE_3D , mOccupancyTextureName ) ;
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_MIN_FILTER , GL_NEAREST ) ;   // Integer textures do not filter.
+    glTexParameteri( GL_TEXTURE_3D , GL_TEXTURE_MAG_FILTER , GL_NEAREST ) ;
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+
+    glGenTextures( 1 , & mDepthTextureName ) ;
+    glBindTexture( GL_TEXTURE_2D , mDepthTextureName ) ;
+    glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , GL_NEAREST ) ;
+    glTexParameteri( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , GL_NEAREST ) ;
+    glBindTexture( GL_TEXTURE_2D , 0 ) ;
+
+    return ! RENDER_CHECK_ERROR( VolumeRendererGpu_Initialize ) ;
+}
+
+
+
+
+/** Copy density, flame and smoke grids into 3D textures, and summarize them into occupancy bricks.
+
+    \param densityGrid      Uniform grid of fluid density.  Its shape determines the shape of the volume.
+
+    \param ambientDensity   Density of fluid in the absence of particles.  Render draws density relative to this.
+
+    \param flameGrid        Uniform grid of flame mass fraction, or NULL if there is none.  Ignored unless its shape matches densityGrid.
+
+    \param smokeGrid        Uniform grid of smoke mass fraction, or NULL if there is none.  Ignored unless its shape matches densityGrid.
+*/
+void VolumeRendererGpu::Upload( const UniformGrid< float > & densityGrid , float ambientDensity , const UniformGrid< float > * flameGrid , const UniformGrid< float > * smokeGrid )
+{
+    PERF_BLOCK( VolumeRendererGpu__Upload ) ;
+
+    if( ! IsValid() || densityGrid.HasZeroExtent() || densityGrid.Empty() )
+    {   // Nothing to draw.
+        mNumPoints[ 0 ] = mNumPoints[ 1 ] = mNumPoints[ 2 ] = 0 ;
+        return ;
+    }
+
+    ASSERT( ambientDensity > 0.0f ) ;
+
+    const bool      hasFlame            = flameGrid && ! flameGrid->Empty() && flameGrid->ShapeMatches( densityGrid ) ;
+    const bool      hasSmoke            = smokeGrid && ! smokeGrid->Empty() && smokeGrid->ShapeMatches( densityGrid ) ;
+    const unsigned  numGridpoints       = densityGrid.GetGridCapacity() ;
+    const float     oneOverAmbient      = 1.0f / ambientDensity ;
+    const bool      shapeChanged        = AdoptShape( densityGrid ) ;
+
+    {
+        PERF_BLOCK( VolumeRendererGpu__Upload_Convert ) ;
+        mVolumeValues.Resize( numGridpoints * 3 ) ;
+        mVolumeStaging.Resize( numGridpoints * 4 ) ;
+        for( unsigned offset = 0 ; offset < numGridpoints ; ++ offset )
+        {   // For each gridpoint...
+            float *             values  = & mVolumeValues[ offset * 3 ] ;
+            unsigned short *    halves  = & mVolumeStaging[ offset * 4 ] ;
+            values[ 0 ] = densityGrid[ offset ] * oneOverAmbient - 1.0f ;
+            values[ 1 ] = hasFlame ? ( * flameGrid )[ offset ] : 0.0f ;
+            values[ 2 ] = hasSmoke ? ( * smokeGrid )[ offset ] : 0.0f ;
+            halves[ 0 ] = UniformGridCodecFloat16::Encode( values[ 0 ] , 0.0f , 0.0f ) ;
+            halves[ 1 ] = UniformGridCodecFloat16::Encode( values[ 1 ] , 0.0f , 0.0f ) ;
+            halves[ 2 ] = UniformGridCodecFloat16::Encode( values[ 2 ] , 0.0f , 0.0f ) ;
+            halves[ 3 ] = 0 ;
+        }
+    }
+
+    ComputeOccupancy() ;
+    UploadTextures( shapeChanged ) ;
+}
+
+
+
+
+/** Copy a dye concentration grid into 3D textures, as smoke, and summarize it into occupancy bricks.
+
+    Dye lives on its own grid, whose shape need not match the density grid,
+    so this replaces whatever Upload copied.  Render dye with CHANNEL_SMOKE.
+
+    \param dyeGrid  Uniform grid of dye concentration.  Its shape determines the shape of the volume.
+*/
+void VolumeRendererGpu::UploadDye( const UniformGrid< float > & dyeGrid )
+{
+    PERF_BLOCK( VolumeRendererGpu__UploadDye ) ;
+
+    if( ! IsValid() || dyeGrid.HasZeroExtent() || dyeGrid.Empty() )
+    {   // Nothing to draw.
+        mNumPoints[ 0 ] = mNumPoints[ 1 ] = mNumPoints[ 2 ] = 0 ;
+        return ;
+    }
+
+    const unsigned  numGridpoints       = dyeGrid.GetGridCapacity() ;
+    const bool      shapeChanged        = AdoptShape( dyeGrid ) ;
+
+    {
+        PERF_BLOCK( VolumeRendererGpu__UploadDye_Convert ) ;
+        mVolumeValues.Resize( numGridpoints * 3 ) ;
+        mVolumeStaging.Resize( numGridpoints * 4 ) ;
+        for( unsigned offset = 0 ; offset < numGridpoints ; ++ offset )
+        {   // For each gridpoint...
+            float *             values  = & mVolumeValues[ offset * 3 ] ;
+            unsigned short *    halves  = & mVolumeStaging[ offset * 4 ] ;
+            values[ 0 ] = 0.0f ;
+            values[ 1 ] = 0.0f ;
+            values[ 2 ] = dyeGrid[ offset ] ;
+            halves[ 0 ] = 0 ;
+            halves[ 1 ] = 0 ;
+            halves[ 2 ] = UniformGridCodecFloat16::Encode( values[ 2 ] , 0.0f , 0.0f ) ;
+            halves[ 3 ] = 0 ;
+        }
+    }
+
+    ComputeOccupancy() ;
+    UploadTextures( shapeChanged ) ;
+}
+
+
+
+
+/** Record shape of given grid as the shape of the volume, and return whether that shape differs from before.
+*/
+bool VolumeRendererGpu::AdoptShape( const UniformGridGeometry & grid )
+{
+    const bool shapeChanged =       ( grid.GetNumPoints( 0 ) != mNumPoints[ 0 ] )
+                                ||  ( grid.GetNumPoints( 1 ) != mNumPoints[ 1 ] )
+                                ||  ( grid.GetNumPoints( 2 ) != mNumPoints[ 2 ] ) ;
+
+    for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+    {
+        mNumPoints[ axis ] = grid.GetNumPoints( axis ) ;
+        mNumBricks[ axis ] = Max2( ( mNumPoints[ axis ] - 1 + sCellsPerBrick - 1 ) / sCellsPerBrick , 1u ) ;
+    }
+    mGridMinCorner  = grid.GetMinCorner() ;
+    mGridExtent     = grid.GetExtent() ;
+    mCellsPerExtent = grid.GetCellsPerExtent() ;
+    return shapeChanged ;
+}
+
+
+
+
+/** Copy mVolumeStaging and mOccupancyStaging into their 3D textures, reallocating them if the shape changed.
+*/
+void VolumeRendererGpu::UploadTextures( bool shapeChanged )
+{
+    PERF_BLOCK( VolumeRendererGpu__Upload_Textures ) ;
+    glPushClientAttrib( GL_CLIENT_PIXEL_STORE_BIT ) ;
+    glPixelStorei( GL_UNPACK_ALIGNMENT , 1 ) ;  // Rows of occupancy bytes need not be multiples of 4 bytes.
+
+    glBindTexture( GL_TEXTURE_3D , mVolumeTextureName ) ;
+    if( shapeChanged )
+    {   // Reallocate texture to fit new grid.
+        glTexImage3D( GL_TEXTURE_3D , 0 , GL_RGBA16F , mNumPoints[ 0 ] , mNumPoints[ 1 ] , mNumPoints[ 2 ] , 0 , GL_RGBA , GL_HALF_FLOAT , mVolumeStaging.Data() ) ;
+    }
+    else
+    {   // Reuse texture.
+        glTexSubImage3D( GL_TEXTURE_3D , 0 , 0 , 0 , 0 , mNumPoints[ 0 ] , mNumPoints[ 1 ] , mNumPoints[ 2 ] , GL_RGBA , GL_HALF_FLOAT , mVolumeStaging.Data() ) ;
+    }
+
+    glBindTexture( GL_TEXTURE_3D , mOccupancyTextureName ) ;
+    if( shapeChanged )
+    {
+        glTexImage3D( GL_TEXTURE_3D , 0 , GL_R8UI , mNumBricks[ 0 ] , mNumBricks[ 1 ] , mNumBricks[ 2 ] , 0 , GL_RED_INTEGER , GL_UNSIGNED_BYTE , mOccupancyStaging.Data() ) ;
+    }
+    else
+    {
+        glTexSubImage3D( GL_TEXTURE_3D , 0 , 0 , 0 , 0 , mNumBricks[ 0 ] , mNumBricks[ 1 ] , mNumBricks[ 2 ] , GL_RED_INTEGER , GL_UNSIGNED_BYTE , mOccupancyStaging.Data() ) ;
+    }
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+
+    glPopClientAttrib() ;
+    RENDER_CHECK_ERROR( VolumeRendererGpu_Upload ) ;
+}
+
+
+
+
+/** Record, for each brick, which channels have any value large enough to see.
+
+    Trilinear interpolation within a cell reads the gridpoints at its corners,
+    so a brick spans the gridpoints on its boundary as well as those inside it.
+    Gridpoints on a boundary between bricks therefore mark both.
+*/
+void VolumeRendererGpu::ComputeOccupancy()
+{
+    PERF_BLOCK( VolumeRendererGpu__ComputeOccupancy ) ;
+
+    const unsigned numBricksXY = mNumBricks[ 0 ] * mNumBricks[ 1 ] ;
+    mOccupancyStaging.Resize( numBricksXY * mNumBricks[ 2 ] ) ;
+    memset( mOccupancyStaging.Data() , 0 , mOccupancyStaging.Size() ) ;
+
+    const unsigned numXY = mNumPoints[ 0 ] * mNumPoints[ 1 ] ;
+    unsigned idx[ 3 ] ;
+    for( idx[ 2 ] = 0 ; idx[ 2 ] < mNumPoints[ 2 ] ; ++ idx[ 2 ] )
+    for( idx[ 1 ] = 0 ; idx[ 1 ] < mNumPoints[ 1 ] ; ++ idx[ 1 ] )
+    for( idx[ 0 ] = 0 ; idx[ 0 ] < mNumPoints[ 0 ] ; ++ idx[ 0 ] )
+    {   // For each gridpoint...
+        const unsigned  offset  = idx[ 0 ] + mNumPoints[ 0 ] * idx[ 1 ] + numXY * idx[ 2 ] ;
+        const float *   values  = & mVolumeValues[ offset * 3 ] ;
+        const unsigned char bits =  ( fabsf( values[ 0 ] ) > sOccupancyThreshold ? CHANNEL_DENSITY  : 0 )
+                                 |  (        values[ 1 ]   > sOccupancyThreshold ? CHANNEL_FLAME    : 0 )
+                                 |  (        values[ 2 ]   > sOccupancyThreshold ? CHANNEL_SMOKE    : 0 ) ;
+        if( 0 == bits )
+        {   // Gridpoint is empty.
+            continue ;
+        }
+
+        // Find range of bricks whose boundaries include this gridpoint; at most 2 along each axis.
+        unsigned brickLo[ 3 ] , brickHi[ 3 ] ;
+        for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+        {
+            brickHi[ axis ] = Min2( idx[ axis ] / sCellsPerBrick , mNumBricks[ axis ] - 1 ) ;
+            brickLo[ axis ] = ( ( idx[ axis ] > 0 ) && ( 0 == idx[ axis ] % sCellsPerBrick ) ) ? idx[ axis ] / sCellsPerBrick - 1 : brickHi[ axis ] ;
+        }
+
+        for( unsigned bz = brickLo[ 2 ] ; bz <= brickHi[ 2 ] ; ++ bz )
+        for( unsigned by = brickLo[ 1 ] ; by <= brickHi[ 1 ] ; ++ by )
+        for( unsigned bx = brickLo[ 0 ] ; bx <= brickHi[ 0 ] ; ++ bx )
+        {
+            mOccupancyStaging[ bx + mNumBricks[ 0 ] * by + numBricksXY * bz ] |= bits ;
+        }
+    }
+}
+
+
+
+
+/** Ray-march the most recently uploaded volume, compositing it over what has already been drawn.
+
+    \param channels Bitwise combination of ChannelE values saying which grids to draw.
+
+    \note This uses the current OpenGL modelview matrix as the view, and
+            draws in world space, so call this after setting the camera, for
+            example with QdCamera::SetCamera, and after drawing opaque geometry,
+            since rays stop at the depth buffer.
+*/
+void VolumeRendererGpu::Render( unsigned channels )
+{
+    PERF_BLOCK( VolumeRendererGpu__Render ) ;
+
+    if( ! IsValid() || ( 0 == mNumPoints[ 0 ] ) || ( 0 == channels ) )
+    {
+        return ;
+    }
+
+    GLint viewport[ 4 ] ;
+    glGetIntegerv( GL_VIEWPORT , viewport ) ;
+
+    {   // Copy depth buffer, so rays stop at opaque geometry.
+        PERF_BLOCK( VolumeRendererGpu__Render_CopyDepth ) ;
+        glBindTexture( GL_TEXTURE_2D , mDepthTextureName ) ;
+        if( ( viewport[ 2 ] != mDepthTextureSize[ 0 ] ) || ( viewport[ 3 ] != mDepthTextureSize[ 1 ] ) )
+        {   // Window changed size, so reallocate texture.
+            glCopyTexImage2D( GL_TEXTURE_2D , 0 , GL_DEPTH_COMPONENT , viewport[ 0 ] , viewport[ 1 ] , viewport[ 2 ] , viewport[ 3 ] , 0 ) ;
+            mDepthTextureSize[ 0 ] = viewport[ 2 ] ;
+            mDepthTextureSize[ 1 ] = viewport[ 3 ] ;
+        }
+        else
+        {
+            glCopyTexSubImage2D( GL_TEXTURE_2D , 0 , 0 , 0 , viewport[ 0 ] , viewport[ 1 ] , viewport[ 2 ] , viewport[ 3 ] ) ;
+        }
+        glBindTexture( GL_TEXTURE_2D , 0 ) ;
+    }
+
+    const Vec3      cellSpacing ( 1.0f / mCellsPerExtent.x , 1.0f / mCellsPerExtent.y , 1.0f / mCellsPerExtent.z ) ;
+    const float     stepLength  = Min2( Min2( cellSpacing.x , cellSpacing.y ) , cellSpacing.z ) / sStepsPerCell ;
+    const Vec3      brickExtent = cellSpacing * float( sCellsPerBrick ) ;
+    const Vec3      gridMax     = mGridMinCorner + mGridExtent ;
+    // Bound steps by samples along the longest ray through the grid, plus one skip per brick crossed.
+    const int       maxSteps    = int( mGridExtent.Magnitude() / stepLength ) + int( mNumBricks[ 0 ] + mNumBricks[ 1 ] + mNumBricks[ 2 ] ) + 1 ;
+
+    glPushAttrib( GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT | GL_POLYGON_BIT ) ;
+
+    glActiveTexture( GL_TEXTURE0 ) ;
+    glBindTexture( GL_TEXTURE_3D , mVolumeTextureName ) ;
+    glActiveTexture( GL_TEXTURE1 ) ;
+    glBindTexture( GL_TEXTURE_3D , mOccupancyTextureName ) ;
+    glActiveTexture( GL_TEXTURE2 ) ;
+    glBindTexture( GL_TEXTURE_2D , mDepthTextureName ) ;
+    glActiveTexture( GL_TEXTURE0 ) ;
+
+    glDisable( GL_LIGHTING ) ;
+    glDisable( GL_DEPTH_TEST ) ;    // Rays clip themselves against the copy of the depth buffer.
+    glDepthMask( GL_FALSE ) ;
+    glEnable( GL_CULL_FACE ) ;
+    glFrontFace( GL_CCW ) ;
+    glCullFace( GL_FRONT ) ;        // Draw back faces, so rays start correctly even when the eye lies inside the grid.
+    glEnable( GL_BLEND ) ;
+    glBlendFunc( GL_ONE , GL_ONE_MINUS_SRC_ALPHA ) ;
+
+    mRayMarchShader.Use() ;
+    glUniform1i ( mRayMarchShader.GetUniformLocation( "uVolume"            ) , 0 ) ;
+    glUniform1i ( mRayMarchShader.GetUniformLocation( "uOccupancy"         ) , 1 ) ;
+    glUniform1i ( mRayMarchShader.GetUniformLocation( "uSceneDepth"        ) , 2 ) ;
+    glUniform4f ( mRayMarchShader.GetUniformLocation( "uViewport"          ) , float( viewport[ 0 ] ) , float( viewport[ 1 ] ) , float( viewport[ 2 ] ) , float( viewport[ 3 ] ) ) ;
+    glUniform3f ( mRayMarchShader.GetUniformLocation( "uGridMinCorner"     ) , mGridMinCorner.x , mGridMinCorner.y , mGridMinCorner.z ) ;
+    glUniform3f ( mRayMarchShader.GetUniformLocation( "uGridMaxCorner"     ) , gridMax.x , gridMax.y , gridMax.z ) ;
+    glUniform3f ( mRayMarchShader.GetUniformLocation( "uCellsPerExtent"    ) , mCellsPerExtent.x , mCellsPerExtent.y , mCellsPerExtent.z ) ;
+    glUniform3f ( mRayMarchShader.GetUniformLocation( "uNumGridPoints"     ) , float( mNumPoints[ 0 ] ) , float( mNumPoints[ 1 ] ) , float( mNumPoints[ 2 ] ) ) ;
+    glUniform3f ( mRayMarchShader.GetUniformLocation( "uBrickExtent"       ) , brickExtent.x , brickExtent.y , brickExtent.z ) ;
+    glUniform3ui( mRayMarchShader.GetUniformLocation( "uNumBricks"         ) , mNumBricks[ 0 ] , mNumBricks[ 1 ] , mNumBricks[ 2 ] ) ;
+    glUniform1ui( mRayMarchShader.GetUniformLocation( "uChannels"          ) , channels ) ;
+    glUniform1f ( mRayMarchShader.GetUniformLocation( "uStepLength"        ) , stepLength ) ;
+    glUniform1i ( mRayMarchShader.GetUniformLocation( "uMaxSteps"          ) , maxSteps ) ;
+    glUniform1f ( mRayMarchShader.GetUniformLocation( "uDensityExtinction" ) , ( channels & CHANNEL_DENSITY ) ? mDensityExtinction : 0.0f ) ;
+    glUniform1f ( mRayMarchShader.GetUniformLocation( "uFlameEmission"     ) , ( channels & CHANNEL_FLAME   ) ? mFlameEmission     : 0.0f ) ;
+    glUniform1f ( mRayMarchShader.GetUniformLocation( "uSmokeExtinction"   ) , ( channels & CHANNEL_SMOKE   ) ? mSmokeExtinction   : 0.0f ) ;
+
+    {   // Draw grid bounding box, with world space positions as texture coordinates.
+        PERF_BLOCK( VolumeRendererGpu__Render_Draw ) ;
+        glBegin( GL_QUADS ) ;
+        for( unsigned iFace = 0 ; iFace < 6 ; ++ iFace )
+        {
+            for( unsigned iCorner = 0 ; iCorner < 4 ; ++ iCorner )
+            {
+                const unsigned  corner  = sBoxFaceCorners[ iFace ][ iCorner ] ;
+                const Vec3      vertex  ( ( corner & 1 ) ? gridMax.x : mGridMinCorner.x
+                                        , ( corner & 2 ) ? gridMax.y : mGridMinCorner.y
+                                        , ( corner & 4 ) ? gridMax.z : mGridMinCorner.z ) ;
+                glTexCoord3f( vertex.x , vertex.y , vertex.z ) ;
+                glVertex3f( vertex.x , vertex.y , vertex.z ) ;
+            }
+        }
+        glEnd() ;
+    }
+
+    glUseProgram( 0 ) ;
+
+    glActiveTexture( GL_TEXTURE2 ) ;
+    glBindTexture( GL_TEXTURE_2D , 0 ) ;
+    glActiveTexture( GL_TEXTURE1 ) ;
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+    glActiveTexture( GL_TEXTURE0 ) ;
+    glBindTexture( GL_TEXTURE_3D , 0 ) ;
+
+    glPopAttrib() ;
+    RENDER_CHECK_ERROR( VolumeRendererGpu_Render ) ;
+}
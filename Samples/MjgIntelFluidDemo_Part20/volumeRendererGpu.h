@@ -0,0 +1,100 @@
+/** \file volumeRendererGpu.h
+
+    \brief Ray-marched rendering of density, flame and smoke grids, using 3D textures and an OpenGL fragment shader.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef VOLUME_RENDERER_GPU_H
+#define VOLUME_RENDERER_GPU_H
+
+#include <Render/Platform/OpenGL/OpenGL_computeShader.h>
+
+#include <Core/SpatialPartition/uniformGrid.h>
+#include <Core/Containers/vector.h>
+
+// Types --------------------------------------------------------------
+
+/** Ray-marched rendering of density, flame and smoke grids, as an alternative to drawing tracer particles.
+
+    Upload copies the grids into a single 3D texture, in half precision, with
+    density (relative to ambient), flame and smoke in separate channels.  It
+    also summarizes the grids as a coarse 3D texture of occupancy bricks, each
+    of which records which channels have any visible content within a block of
+    cells.
+
+    Render draws the back faces of the grid bounding box, with a fragment shader
+    that marches a ray from the eye through the grid.  The ray skips bricks
+    whose occupancy says they hold nothing that Render draws, so empty regions
+    cost one texture fetch per brick instead of one per step.  The ray also stops
+    at opaque geometry already drawn, found from a copy of the depth buffer.
+
+    The cost of rendering therefore depends on screen resolution and grid
+    size, not on the number of tracers.
+
+    Every method other than the constructor requires that the OpenGL context
+    that created this object be current on the calling thread.
+*/
+class VolumeRendererGpu
+{
+    public:
+        /// Which grids Render draws, as bits to combine.
+        enum ChannelE
+        {
+            CHANNEL_DENSITY = 1 ,   ///< Draw density, relative to ambient, as two-color dye.
+            CHANNEL_FLAME   = 2 ,   ///< Draw flame mass fraction, as emissive fire.
+            CHANNEL_SMOKE   = 4 ,   ///< Draw smoke mass fraction, as absorbing smoke.
+        } ;
+
+        VolumeRendererGpu() ;
+        ~VolumeRendererGpu() ;
+
+        bool            Initialize() ;
+
+        /// Return whether Initialize succeeded, i.e. whether this can render volumes.
+        bool            IsValid() const { return mRayMarchShader.IsValid() ; }
+
+        void            Upload( const UniformGrid< float > & densityGrid , float ambientDensity , const UniformGrid< float > * flameGrid , const UniformGrid< float > * smokeGrid ) ;
+        void            UploadDye( const UniformGrid< float > & dyeGrid ) ;
+        void            Render( unsigned channels ) ;
+
+        /// Set how opaque density deviation makes the volume, per unit relative density deviation, per unit length.
+        void            SetDensityExtinction( float densityExtinction ) { mDensityExtinction = densityExtinction ; }
+
+        /// Set how much light flame emits, per unit flame fraction, per unit length.
+        void            SetFlameEmission( float flameEmission )         { mFlameEmission = flameEmission ; }
+
+        /// Set how opaque smoke makes the volume, per unit smoke fraction, per unit length.
+        void            SetSmokeExtinction( float smokeExtinction )     { mSmokeExtinction = smokeExtinction ; }
+
+    private:
+        VolumeRendererGpu( const VolumeRendererGpu & ) ;              // Disallow copy
+        VolumeRendererGpu & operator=( const VolumeRendererGpu & ) ;  // Disallow assignment
+
+        bool            AdoptShape( const UniformGridGeometry & grid ) ;
+        void            ComputeOccupancy() ;
+        void            UploadTextures( bool shapeChanged ) ;
+
+        PeGaSys::Render::OpenGL_ComputeShader   mRayMarchShader         ;   ///< Fragment-only program that marches rays through the volume.
+        VECTOR< float >                         mVolumeValues           ;   ///< Scratch space: Density deviation, flame and smoke at each gridpoint, 3 floats per gridpoint, from which ComputeOccupancy reads.
+        VECTOR< unsigned short >                mVolumeStaging          ;   ///< mVolumeValues in half precision, 4 per gridpoint, for upload.
+        VECTOR< unsigned char >                 mOccupancyStaging       ;   ///< Bits, one per ChannelE, of which channels have visible content in each brick, for upload.
+        GLuint                                  mVolumeTextureName      ;   ///< Identifier of OpenGL 3D texture holding density deviation, flame and smoke.
+        GLuint                                  mOccupancyTextureName   ;   ///< Identifier of OpenGL 3D texture holding occupancy bits of each brick.
+        GLuint                                  mDepthTextureName       ;   ///< Identifier of OpenGL 2D texture holding a copy of the depth buffer.
+        unsigned                                mNumPoints[ 3 ]         ;   ///< Number of gridpoints along each axis of mVolumeTextureName, or zero if nothing has been uploaded.
+        unsigned                                mNumBricks[ 3 ]         ;   ///< Number of bricks along each axis of mOccupancyTextureName.
+        int                                     mDepthTextureSize[ 2 ]  ;   ///< Width and height of mDepthTextureName, in texels.
+        Vec3                                    mGridMinCorner          ;   ///< Minimal corner of uploaded grid.
+        Vec3                                    mGridExtent             ;   ///< Size of uploaded grid.
+        Vec3                                    mCellsPerExtent         ;   ///< Reciprocal of cell spacing of uploaded grid.
+        float                                   mDensityExtinction      ;   ///< Opacity per unit relative density deviation per unit length.
+        float                                   mFlameEmission          ;   ///< Emitted light per unit flame fraction per unit length.
+        float                                   mSmokeExtinction        ;   ///< Opacity per unit smoke fraction per unit length.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif
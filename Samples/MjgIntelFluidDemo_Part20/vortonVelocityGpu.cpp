@@ -0,0 +1,348 @@
+/** \file vortonVelocityGpu.cpp
+
+    \brief Evaluator of velocity due to vortons, using OpenGL compute shaders.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+
+#include "vortonVelocityGpu.h"
+
+#include <Render/Platform/OpenGL/OpenGL_extensions.h>
+
+#include <Core/Performance/perfBlock.h>
+
+#include <float.h>
+#include <string.h>
+
+// Private variables --------------------------------------------------------------
+
+static const unsigned sWorkGroupSizeX = 8 ;   ///< Must match local_size_x in sComputeVelocitySource.
+static const unsigned sWorkGroupSizeY = 8 ;   ///< Must match local_size_y in sComputeVelocitySource.
+
+/// Margin, as a fraction of child cell spacing, within which tree traversal descends into a cell.  Must match marginFactor in VortonSim::ComputeVelocity_Tree.
+static const float sMarginFactor = 0.0001f ;
+
+/** GLSL source of compute shader that computes velocity due to vortons at each gridpoint.
+
+    AccumulateVelocity implements the same law as VORTON_ACCUMULATE_VELOCITY_private.
+*/
+static const char sComputeVelocitySource[] =
+    "#version 430\n"
+    "layout( local_size_x = 8 , local_size_y = 8 , local_size_z = 1 ) in ;\n"
+    "\n"
+    "struct Source\n"
+    "{\n"
+    "    vec4 mPositionAndSize ;\n"
+    "    vec4 mAngularVelocity ;\n"
+    "} ;\n"
+    "\n"
+    "struct Layer\n"
+    "{\n"
+    "    uvec4 mNumPointsAndOffset ;\n"
+    "    uvec4 mDecimations ;\n"
+    "    vec4  mMinCorner ;\n"
+    "    vec4  mCellSpacing ;\n"
+    "} ;\n"
+    "\n"
+    "layout( std430 , binding = 0 ) readonly  buffer SourceBlock   { Source sources[] ; } ;\n"
+    "layout( std430 , binding = 1 ) readonly  buffer LayerBlock    { Layer  layers[] ; } ;\n"
+    "layout( std430 , binding = 2 ) writeonly buffer VelocityBlock { vec4   velocities[] ; } ;\n"
+    "\n"
+    "uniform uvec3 uNumGridPoints ;\n"
+    "uniform vec3  uGridMinCorner ;\n"
+    "uniform vec3  uGridSpacing ;\n"
+    "uniform uint  uNumSources ;\n"
+    "uniform uint  uNumLayers ;\n"
+    "uniform float uSpreadingRangeFactor ;\n"
+    "uniform float uSpreadingCirculationFactor ;\n"
+    "uniform float uMarginFactor ;\n"
+    "\n"
+    "const uint TILE_SIZE  = 64u ;  // Number of invocations per work group.\n"
+    "const uint STACK_SIZE = 64u ;  // Maximum number of tree cells awaiting traversal.\n"
+    "\n"
+    "shared Source sTile[ TILE_SIZE ] ;\n"
+    "\n"
+    "vec3 AccumulateVelocity( vec3 queryPosition , Source source )\n"
+    "{\n"
+    "    vec3  otherToSelf = queryPosition - source.mPositionAndSize.xyz ;\n"
+    "    float radius      = source.mPositionAndSize.w * 0.5 * uSpreadingRangeFactor ;\n"
+    "    float radius2     = radius * radius ;\n"
+    "    float dist2       = dot( otherToSelf , otherToSelf ) ;\n"
+    "    float distLaw     = ( dist2 < radius2 ) ? ( 1.0 / ( radius2 * radius ) ) : ( inversesqrt( dist2 ) / dist2 ) ;\n"
+    "    return ( 2.0 / 3.0 ) * radius2 * radius * cross( source.mAngularVelocity.xyz , otherToSelf ) * distLaw * uSpreadingCirculationFactor ;\n"
+    "}\n"
+    "\n"
+    "vec3 ComputeVelocity_Direct( vec3 queryPosition )\n"
+    "{\n"
+    "    vec3 velocity = vec3( 0.0 ) ;\n"
+    "    for( uint tileStart = 0u ; tileStart < uNumSources ; tileStart += TILE_SIZE )\n"
+    "    {   // For each tile of vortons, each invocation loads one vorton of the tile, then all invocations read all of them.\n"
+    "        uint iSource = tileStart + gl_LocalInvocationIndex ;\n"
+    "        if( iSource < uNumSources )\n"
+    "        {\n"
+    "            sTile[ gl_LocalInvocationIndex ] = sources[ iSource ] ;\n"
+    "        }\n"
+    "        memoryBarrierShared() ;\n"
+    "        barrier() ;\n"
+    "        uint numInTile = min( TILE_SIZE , uNumSources - tileStart ) ;\n"
+    "        for( uint iTile = 0u ; iTile < numInTile ; ++ iTile )\n"
+    "        {\n"
+    "            velocity += AccumulateVelocity( queryPosition , sTile[ iTile ] ) ;\n"
+    "        }\n"
+    "        barrier() ;\n"
+    "    }\n"
+    "    return velocity ;\n"
+    "}\n"
+    "\n"
+    "vec3 ComputeVelocity_Tree( vec3 queryPosition )\n"
+    "{\n"
+    "    vec3  velocity = vec3( 0.0 ) ;\n"
+    "    uvec4 stack[ STACK_SIZE ] ;   // xyz: cell indices.  w: layer.\n"
+    "    uint  stackSize = 0u ;\n"
+    "    stack[ stackSize ++ ] = uvec4( 0u , 0u , 0u , uNumLayers - 1u ) ;\n"
+    "    while( stackSize > 0u )\n"
+    "    {\n"
+    "        uvec4 parentCell  = stack[ -- stackSize ] ;\n"
+    "        uint  iLayer      = parentCell.w ;\n"
+    "        Layer child       = layers[ iLayer - 1u ] ;\n"
+    "        uvec3 decimations = layers[ iLayer ].mDecimations.xyz ;\n"
+    "        uvec3 clusterMin  = parentCell.xyz * decimations ;\n"
+    "        vec3  spacing     = child.mCellSpacing.xyz ;\n"
+    "        // When domain is 2D in XY plane, spacing.z is 0 so the z test below would fail unless margin.z is nonzero.\n"
+    "        vec3  margin      = uMarginFactor * spacing + ( ( 0.0 == spacing.z ) ? vec3( 0.0 , 0.0 , 1.175494351e-38 ) : vec3( 0.0 ) ) ;\n"
+    "        uvec3 increment ;\n"
+    "        for( increment.z = 0u ; increment.z < decimations.z ; ++ increment.z )\n"
+    "        for( increment.y = 0u ; increment.y < decimations.y ; ++ increment.y )\n"
+    "        for( increment.x = 0u ; increment.x < decimations.x ; ++ increment.x )\n"
+    "        {   // For each cell of child layer in this cluster...\n"
+    "            uvec3 idxChild = clusterMin + increment ;\n"
+    "            if( any( greaterThanEqual( idxChild , child.mNumPointsAndOffset.xyz ) ) )\n"
+    "            {\n"
+    "                continue ;\n"
+    "            }\n"
+    "            vec3 cellMinCorner = child.mMinCorner.xyz + vec3( idxChild      ) * spacing ;\n"
+    "            vec3 cellMaxCorner = child.mMinCorner.xyz + vec3( idxChild + 1u ) * spacing ;\n"
+    "            if(     ( iLayer > 1u )\n"
+    "                &&  all( greaterThanEqual( queryPosition , cellMinCorner - margin ) )\n"
+    "                &&  all( lessThan( queryPosition , cellMaxCorner + margin ) )\n"
+    "                &&  ( stackSize < STACK_SIZE ) )\n"
+    "            {   // Query position is inside child cell, and child is not a leaf, so traverse it.\n"
+    "                stack[ stackSize ++ ] = uvec4( idxChild , iLayer - 1u ) ;\n"
+    "            }\n"
+    "            else\n"
+    "            {   // Query position is outside child cell, or child is a leaf, so accumulate its supervorton.\n"
+    "                uint offset = child.mNumPointsAndOffset.w + idxChild.x + child.mNumPointsAndOffset.x * ( idxChild.y + child.mNumPointsAndOffset.y * idxChild.z ) ;\n"
+    "                velocity += AccumulateVelocity( queryPosition , sources[ offset ] ) ;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    return velocity ;\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uvec3 idx           = gl_GlobalInvocationID ;\n"
+    "    bool  isInGrid      = all( lessThan( idx , uNumGridPoints ) ) ;\n"
+    "    vec3  queryPosition = uGridMinCorner + vec3( idx ) * uGridSpacing ;\n"
+    "    vec3  velocity ;\n"
+    "    if( uNumLayers > 1u )\n"
+    "    {\n"
+    "        if( ! isInGrid )\n"
+    "        {\n"
+    "            return ;\n"
+    "        }\n"
+    "        velocity = ComputeVelocity_Tree( queryPosition ) ;\n"
+    "    }\n"
+    "    else\n"
+    "    {   // Every invocation in the work group must reach each barrier, so invocations outside the grid return only after summing.\n"
+    "        velocity = ComputeVelocity_Direct( queryPosition ) ;\n"
+    "        if( ! isInGrid )\n"
+    "        {\n"
+    "            return ;\n"
+    "        }\n"
+    "    }\n"
+    "    velocities[ idx.x + uNumGridPoints.x * ( idx.y + uNumGridPoints.y * idx.z ) ] = vec4( velocity , 0.0 ) ;\n"
+    "}\n"
+    ;
+
+// Functions --------------------------------------------------------------
+
+
+
+
+/** Construct evaluator of velocity due to vortons, using OpenGL compute shaders.
+
+    \note This does not touch OpenGL, so it can run before a render context exists.  Call Initialize after.
+*/
+VortonVelocityGpu::VortonVelocityGpu()
+{
+}
+
+
+
+
+VortonVelocityGpu::~VortonVelocityGpu()
+{
+}
+
+
+
+
+/** Compile the compute shader.
+
+    \return Whether the OpenGL driver supports compute shaders and the shader compiled.
+            When this returns false, ComputeVelocityAtGridpoints returns false, so VortonSim uses its CPU routines.
+
+    \note This requires a current OpenGL context, after OpenGL_Extensions::GetProcAddresses.
+*/
+bool VortonVelocityGpu::Initialize()
+{
+    PERF_BLOCK( VortonVelocityGpu__Initialize ) ;
+
+    if( ! PeGaSys::Render::OpenGL_ComputeShader::IsSupported() )
+    {   // Driver lacks OpenGL 4.3.
+        return false ;
+    }
+
+    return mComputeShader.Compile( sComputeVelocitySource ) ;
+}
+
+
+
+
+/** Append a vorton (or supervorton) to mSources.
+*/
+void VortonVelocityGpu::PushBackSource( const Vorton & vorton )
+{
+    Source source ;
+    source.mPositionAndSize[ 0 ] = vorton.mPosition.x ;
+    source.mPositionAndSize[ 1 ] = vorton.mPosition.y ;
+    source.mPositionAndSize[ 2 ] = vorton.mPosition.z ;
+    source.mPositionAndSize[ 3 ] = vorton.mSize ;
+    source.mAngularVelocity[ 0 ] = vorton.mAngularVelocity.x ;
+    source.mAngularVelocity[ 1 ] = vorton.mAngularVelocity.y ;
+    source.mAngularVelocity[ 2 ] = vorton.mAngularVelocity.z ;
+    source.mAngularVelocity[ 3 ] = 0.0f ;
+    mSources.PushBack( source ) ;
+}
+
+
+
+
+/** Compute velocity due to vortons at every gridpoint of velocityGrid, on the GPU.
+
+    \see IVortonVelocityEvaluator::ComputeVelocityAtGridpoints
+
+    \note Like the CPU recursion, the shader descends into every child cell
+            whose bounds, inflated by a margin, contain the query point.  It
+            visits them in a different order, so sums differ from the CPU
+            treecode by floating-point rounding.  If its stack fills, it
+            accumulates the supervorton of a cell instead of descending into it.
+*/
+bool VortonVelocityGpu::ComputeVelocityAtGridpoints( UniformGrid< Vec3 > & velocityGrid , const VECTOR< Vorton > & vortons , const NestedGrid< Vorton > & influenceTree , float spreadingRangeFactor , float spreadingCirculationFactor )
+{
+    PERF_BLOCK( VortonVelocityGpu__ComputeVelocityAtGridpoints ) ;
+
+    if( ! IsValid() )
+    {
+        return false ;
+    }
+
+    const size_t    numLayers       = influenceTree.GetDepth() ;
+    const unsigned  numGridpoints   = velocityGrid.GetGridCapacity() ;
+    ASSERT( velocityGrid.Size() == numGridpoints ) ;   // Caller must have initialized velocityGrid.
+
+    // Gather sources and layer descriptions into GPU layouts.
+    mSources.Clear() ;
+    mLayers.Clear() ;
+    if( numLayers > 1 )
+    {   // Traverse influence tree, so upload supervortons of every layer.
+        mLayers.Resize( numLayers ) ;
+        for( size_t iLayer = 0 ; iLayer < numLayers ; ++ iLayer )
+        {   // For each layer of the influence tree, leaf first...
+            const UniformGrid< Vorton > &   rLayer      = influenceTree[ iLayer ] ;
+            Layer &                         layer       = mLayers[ iLayer ] ;
+            const Vec3 &                    vMinCorner  = rLayer.GetMinCorner() ;
+            const Vec3 &                    vSpacing    = rLayer.GetCellSpacing() ;
+            const unsigned *                decimations = ( iLayer > 0 ) ? influenceTree.GetDecimations( iLayer ) : NULLPTR ;
+            for( unsigned axis = 0 ; axis < 3 ; ++ axis )
+            {
+                layer.mNumPointsAndOffset[ axis ]   = rLayer.GetNumPoints( axis ) ;
+                layer.mDecimations[ axis ]          = decimations ? decimations[ axis ] : 0 ;
+            }
+            layer.mNumPointsAndOffset[ 3 ]  = static_cast< unsigned >( mSources.Size() ) ;
+            layer.mDecimations[ 3 ]         = 0 ;
+            layer.mMinCorner[ 0 ]   = vMinCorner.x ;    layer.mMinCorner[ 1 ]   = vMinCorner.y ;    layer.mMinCorner[ 2 ]   = vMinCorner.z ;    layer.mMinCorner[ 3 ]   = 0.0f ;
+            layer.mCellSpacing[ 0 ] = vSpacing.x ;      layer.mCellSpacing[ 1 ] = vSpacing.y ;      layer.mCellSpacing[ 2 ] = vSpacing.z ;      layer.mCellSpacing[ 3 ] = 0.0f ;
+
+            const size_t numCells = rLayer.Size() ;
+            for( size_t offset = 0 ; offset < numCells ; ++ offset )
+            {   // For each supervorton in this layer...
+                PushBackSource( rLayer[ offset ] ) ;
+            }
+        }
+    }
+    else
+    {   // Tree has no aggregation layers, so sum vortons directly.
+        const size_t numVortons = vortons.Size() ;
+        mSources.Reserve( numVortons ) ;
+        for( size_t iVorton = 0 ; iVorton < numVortons ; ++ iVorton )
+        {   // For each vorton...
+            PushBackSource( vortons[ iVorton ] ) ;
+        }
+        mLayers.Resize( 1 ) ;   // Shader storage blocks must have a buffer bound, even if unused.
+        memset( & mLayers[ 0 ] , 0 , sizeof( Layer ) ) ;
+    }
+
+    if( mSources.Empty() || ( 0 == numGridpoints ) )
+    {   // Nothing to compute.  Caller already zeroed velocityGrid.
+        return true ;
+    }
+
+    {
+        PERF_BLOCK( VortonVelocityGpu__ComputeVelocityAtGridpoints_Upload ) ;
+        mSourceBuffer.Upload( mSources.Data() , mSources.Size() * sizeof( Source ) ) ;
+        mLayerBuffer.Upload( mLayers.Data() , mLayers.Size() * sizeof( Layer ) ) ;
+        mVelocityBuffer.Allocate( numGridpoints * 4 * sizeof( float ) ) ;
+    }
+
+    // Compute velocity at gridpoints.
+    const Vec3 &        vMinCorner  = velocityGrid.GetMinCorner() ;
+    static const float  nudge       = 1.0f - 2.0f * FLT_EPSILON ;  // Same as in VortonSim::ComputeVelocityAtGridpoints_Slice.
+    const Vec3          vSpacing    = velocityGrid.GetCellSpacing() * nudge ;
+    const unsigned      dims[3]     =   { velocityGrid.GetNumPoints( 0 )
+                                        , velocityGrid.GetNumPoints( 1 )
+                                        , velocityGrid.GetNumPoints( 2 ) } ;
+
+    mComputeShader.Use() ;
+    glUniform3ui( mComputeShader.GetUniformLocation( "uNumGridPoints"               ) , dims[0] , dims[1] , dims[2] ) ;
+    glUniform3f ( mComputeShader.GetUniformLocation( "uGridMinCorner"               ) , vMinCorner.x , vMinCorner.y , vMinCorner.z ) ;
+    glUniform3f ( mComputeShader.GetUniformLocation( "uGridSpacing"                 ) , vSpacing.x , vSpacing.y , vSpacing.z ) ;
+    glUniform1ui( mComputeShader.GetUniformLocation( "uNumSources"                  ) , static_cast< GLuint >( mSources.Size() ) ) ;
+    glUniform1ui( mComputeShader.GetUniformLocation( "uNumLayers"                   ) , static_cast< GLuint >( numLayers ) ) ;
+    glUniform1f ( mComputeShader.GetUniformLocation( "uSpreadingRangeFactor"        ) , spreadingRangeFactor ) ;
+    glUniform1f ( mComputeShader.GetUniformLocation( "uSpreadingCirculationFactor"  ) , spreadingCirculationFactor ) ;
+    glUniform1f ( mComputeShader.GetUniformLocation( "uMarginFactor"                ) , sMarginFactor ) ;
+    mSourceBuffer.BindBase( 0 ) ;
+    mLayerBuffer.BindBase( 1 ) ;
+    mVelocityBuffer.BindBase( 2 ) ;
+    mComputeShader.Dispatch( ( dims[0] + sWorkGroupSizeX - 1 ) / sWorkGroupSizeX
+                           , ( dims[1] + sWorkGroupSizeY - 1 ) / sWorkGroupSizeY
+                           , dims[2] ) ;
+    glUseProgram( 0 ) ;
+
+    {   // Copy velocity back to CPU, for particle advection.
+        PERF_BLOCK( VortonVelocityGpu__ComputeVelocityAtGridpoints_Download ) ;
+        mVelocityStaging.Resize( numGridpoints * 4 ) ;
+        mVelocityBuffer.Download( mVelocityStaging.Data() , mVelocityStaging.Size() * sizeof( float ) ) ;
+        for( unsigned offset = 0 ; offset < numGridpoints ; ++ offset )
+        {   // For each gridpoint...
+            const float * velocity = & mVelocityStaging[ offset * 4 ] ;
+            velocityGrid[ offset ] = Vec3( velocity[ 0 ] , velocity[ 1 ] , velocity[ 2 ] ) ;
+        }
+    }
+
+    return true ;
+}
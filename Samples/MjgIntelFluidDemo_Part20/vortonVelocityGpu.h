@@ -0,0 +1,87 @@
+/** \file vortonVelocityGpu.h
+
+    \brief Evaluator of velocity due to vortons, using OpenGL compute shaders.
+
+    \author Copyright 2009-2016 Dr. Michael Jason Gourlay; All rights reserved.  Contact me at mijagourlay.com for licensing.
+
+    \see http://www.mijagourlay.com/
+*/
+#ifndef VORTON_VELOCITY_GPU_H
+#define VORTON_VELOCITY_GPU_H
+
+#include <VortonFluid/vortonSim.h>
+
+#include <Render/Platform/OpenGL/OpenGL_computeShader.h>
+
+#include <Core/Containers/vector.h>
+
+// Types --------------------------------------------------------------
+
+/** Evaluator of velocity due to vortons, using OpenGL 4.3 compute shaders.
+
+    Each frame, this uploads the supervortons of every layer of the influence
+    tree to a shader storage buffer, then runs one compute shader invocation
+    per velocity gridpoint.  Each invocation traverses the tree the same way
+    VortonSim::ComputeVelocity_Tree does, using an explicit stack instead of
+    recursion.  When the tree has only one layer, invocations instead sum all
+    vortons directly, sharing tiles of vortons through work group memory.
+
+    The velocity grid stays resident in GPU memory (see GetVelocityBuffer) so
+    renderers can read it without a round trip, and this also copies it back
+    into the given UniformGrid, since particle advection runs on the CPU.
+
+    Every method requires that the OpenGL context that created this object be
+    current on the calling thread.  That rules out running VortonSim::Update
+    on a thread other than the render thread.
+*/
+class VortonVelocityGpu : public IVortonVelocityEvaluator
+{
+    public:
+        VortonVelocityGpu() ;
+        virtual ~VortonVelocityGpu() ;
+
+        bool            Initialize() ;
+
+        /// Return whether Initialize succeeded, i.e. whether this evaluator can compute velocity.
+        bool            IsValid() const { return mComputeShader.IsValid() ; }
+
+        virtual bool    ComputeVelocityAtGridpoints( UniformGrid< Vec3 > & velocityGrid , const VECTOR< Vorton > & vortons , const NestedGrid< Vorton > & influenceTree , float spreadingRangeFactor , float spreadingCirculationFactor ) ;
+
+        /// Return shader storage buffer holding velocity at each gridpoint, as 4 floats (x,y,z,0) per gridpoint, from the most recent ComputeVelocityAtGridpoints.
+        const PeGaSys::Render::OpenGL_ShaderStorageBuffer & GetVelocityBuffer() const { return mVelocityBuffer ; }
+
+    private:
+        /// Source element (vorton or supervorton) laid out to match struct Source in the compute shader, using std430 rules.
+        struct Source
+        {
+            float mPositionAndSize[ 4 ] ;   ///< Position (xyz) and size (w), i.e. diameter.
+            float mAngularVelocity[ 4 ] ;   ///< Angular velocity (xyz), i.e. half of vorticity.  w is unused.
+        } ;
+
+        /// Influence tree layer description laid out to match struct Layer in the compute shader, using std430 rules.
+        struct Layer
+        {
+            unsigned    mNumPointsAndOffset[ 4 ]    ;   ///< Number of gridpoints along each axis (xyz), and offset into mSources of first supervorton in this layer (w).
+            unsigned    mDecimations[ 4 ]           ;   ///< Number of child cells along each axis (xyz) in each cell of this layer.  Zero for the leaf layer.
+            float       mMinCorner[ 4 ]             ;   ///< Minimal corner of layer (xyz).
+            float       mCellSpacing[ 4 ]           ;   ///< Cell spacing along each axis (xyz).
+        } ;
+
+        VortonVelocityGpu( const VortonVelocityGpu & ) ;                // Disallow copy
+        VortonVelocityGpu & operator=( const VortonVelocityGpu & ) ;    // Disallow assignment
+
+        void PushBackSource( const Vorton & vorton ) ;
+
+        PeGaSys::Render::OpenGL_ComputeShader       mComputeShader      ;   ///< Program that computes velocity at gridpoints.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mSourceBuffer       ;   ///< GPU copy of mSources.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mLayerBuffer        ;   ///< GPU copy of mLayers.
+        PeGaSys::Render::OpenGL_ShaderStorageBuffer mVelocityBuffer     ;   ///< Velocity at each gridpoint, resident in GPU memory.
+        VECTOR< Source >                            mSources            ;   ///< Supervortons of every influence tree layer, leaf first, or vortons when the tree has a single layer.
+        VECTOR< Layer >                             mLayers             ;   ///< Description of each influence tree layer, leaf first.
+        VECTOR< float >                             mVelocityStaging    ;   ///< CPU copy of mVelocityBuffer, used to populate a UniformGrid.
+} ;
+
+// Public variables --------------------------------------------------------------
+// Public functions --------------------------------------------------------------
+
+#endif